@@ -0,0 +1,384 @@
+#include "bench.h"
+#include "fixtures.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_DEFAULT_WARMUP 2
+#define BENCH_DEFAULT_REPETITIONS 15
+#define BENCH_DEFAULT_MAX_SECONDS 20.0
+#define BENCH_DEFAULT_FIXTURES "/tmp/finder-plus-bench"
+#define BENCH_JSON_VERSION 1
+
+static volatile const void *g_sink;
+static FILE *g_table;                   // Where the table goes: stderr when the JSON takes stdout
+
+double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void bench_consume(const void *value)
+{
+    g_sink = value;
+}
+
+bool bench_enabled(const Bench *bench, const char *name)
+{
+    return !bench->options.filter || strstr(name, bench->options.filter) != NULL;
+}
+
+void bench_skip(const Bench *bench, const char *name, const char *reason)
+{
+    if (bench_enabled(bench, name)) {
+        fprintf(g_table, "%-20s skipped: %s\n", name, reason);
+    }
+}
+
+int bench_listing_sizes(const Bench *bench, int sizes[3])
+{
+    int count = 0;
+    sizes[count++] = 1000;
+    if (bench->options.scale >= BENCH_SCALE_DEFAULT) {
+        sizes[count++] = 100000;
+    }
+    if (bench->options.scale >= BENCH_SCALE_FULL) {
+        sizes[count++] = 1000000;
+    }
+    return count;
+}
+
+// Helper: qsort comparison for sample times
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Helper: Value below which fraction of the sorted samples lie (nearest rank)
+static double percentile(const double *sorted, int count, double fraction)
+{
+    int rank = (int)ceil(fraction * count);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+// Helper: Time batch runs of a case, in seconds
+static double time_batch(const BenchCase *bench_case, long batch)
+{
+    if (bench_case->setup) {
+        bench_case->setup(bench_case->ctx);
+    }
+    double start = bench_now();
+    for (long i = 0; i < batch; i++) {
+        bench_case->run(bench_case->ctx);
+    }
+    return bench_now() - start;
+}
+
+// Helper: Fill in the statistics of count samples (sorted in place)
+static void summarize(BenchResult *result, double *samples, int count)
+{
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) {
+        sum += samples[i];
+    }
+    double mean = sum / count;
+    double variance = 0.0;
+    for (int i = 0; i < count; i++) {
+        variance += (samples[i] - mean) * (samples[i] - mean);
+    }
+    variance = count > 1 ? variance / (count - 1) : 0.0;
+    qsort(samples, (size_t)count, sizeof(double), compare_double);
+
+    result->samples = count;
+    result->min_ns = samples[0];
+    result->median_ns = percentile(samples, count, 0.5);
+    result->p95_ns = percentile(samples, count, 0.95);
+    result->p99_ns = percentile(samples, count, 0.99);
+    result->mean_ns = mean;
+    result->stddev_ns = sqrt(variance);
+}
+
+// Helper: Table row for a result
+static void print_row(const BenchResult *result)
+{
+    const char *unit = "ns";
+    double scale = 1.0;
+    if (result->median_ns >= 1e9) {
+        unit = "s";
+        scale = 1e9;
+    } else if (result->median_ns >= 1e6) {
+        unit = "ms";
+        scale = 1e6;
+    } else if (result->median_ns >= 1e3) {
+        unit = "us";
+        scale = 1e3;
+    }
+    fprintf(g_table, "%-20s %-36s %10.3f %-2s p95 %10.3f %-2s +-%5.1f%%", result->name, result->params,
+            result->median_ns / scale, unit, result->p95_ns / scale, unit,
+            result->mean_ns > 0.0 ? 100.0 * result->stddev_ns / result->mean_ns : 0.0);
+    if (result->items > 0.0 && result->median_ns > 0.0) {
+        fprintf(g_table, "  %12.0f items/s", result->items / (result->median_ns / 1e9));
+    }
+    if (result->recall_k > 0) {
+        fprintf(g_table, "  p99 %10.3f %-2s recall@%d %.4f", result->p99_ns / scale, unit, result->recall_k,
+                result->recall);
+    }
+    if (result->memory_bytes > 0.0) {
+        fprintf(g_table, "  index %.1f MB", result->memory_bytes / (1024.0 * 1024.0));
+    }
+    fprintf(g_table, "\n");
+    fflush(g_table);
+}
+
+bool bench_record(Bench *bench, const BenchResult *result, double *samples_ns, int count)
+{
+    if (!bench_enabled(bench, result->name) || bench->result_count >= BENCH_MAX_RESULTS || count < 1) {
+        return false;
+    }
+
+    BenchResult *recorded = &bench->results[bench->result_count++];
+    *recorded = *result;
+    if (recorded->batch < 1) {
+        recorded->batch = 1;
+    }
+    summarize(recorded, samples_ns, count);
+
+    // Table row as soon as the case is done, so long runs show progress
+    print_row(recorded);
+    return true;
+}
+
+bool bench_run(Bench *bench, const BenchCase *bench_case)
+{
+    if (!bench_enabled(bench, bench_case->name) || bench->result_count >= BENCH_MAX_RESULTS) {
+        return false;
+    }
+    const BenchOptions *options = &bench->options;
+
+    // Warm caches and allocators; the last warmup sizes the batch
+    double single = 0.0;
+    int warmups = options->warmup > 0 ? options->warmup : 1;
+    for (int i = 0; i < warmups; i++) {
+        single = time_batch(bench_case, 1);
+    }
+    long batch = 1;
+    if (!bench_case->setup && single < BENCH_MIN_SAMPLE_SEC) {
+        batch = single > 0.0 ? (long)ceil(BENCH_MIN_SAMPLE_SEC / single) : BENCH_MAX_BATCH;
+        if (batch > BENCH_MAX_BATCH) batch = BENCH_MAX_BATCH;
+    }
+
+    int wanted = options->repetitions;
+    if (wanted < 1) wanted = 1;
+    if (wanted > BENCH_MAX_SAMPLES) wanted = BENCH_MAX_SAMPLES;
+    double samples[BENCH_MAX_SAMPLES];
+    int count = 0;
+    double started = bench_now();
+    while (count < wanted) {
+        samples[count++] = time_batch(bench_case, batch) / (double)batch * 1e9;
+        if (count >= 3 && options->max_seconds > 0.0 && bench_now() - started > options->max_seconds) {
+            break;
+        }
+    }
+
+    BenchResult result = { 0 };
+    snprintf(result.name, sizeof(result.name), "%s", bench_case->name);
+    snprintf(result.params, sizeof(result.params), "%s", bench_case->params ? bench_case->params : "");
+    result.batch = batch;
+    result.items = bench_case->items;
+    return bench_record(bench, &result, samples, count);
+}
+
+// Helper: Write s as a JSON string
+static void json_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fprintf(f, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+// Helper: Write every result as one JSON document
+static bool write_json(const Bench *bench, const char *file)
+{
+    FILE *f = strcmp(file, "-") == 0 ? stdout : fopen(file, "w");
+    if (!f) {
+        fprintf(stderr, "bench: cannot write %s\n", file);
+        return false;
+    }
+
+    struct utsname host;
+    if (uname(&host) != 0) {
+        memset(&host, 0, sizeof(host));
+    }
+    static const char *const scales[] = { "quick", "default", "full" };
+
+    fprintf(f, "{\n  \"version\": %d,\n  \"timestamp\": %lld,\n", BENCH_JSON_VERSION, (long long)time(NULL));
+    fprintf(f, "  \"host\": {\"system\": ");
+    json_string(f, host.sysname);
+    fprintf(f, ", \"release\": ");
+    json_string(f, host.release);
+    fprintf(f, ", \"machine\": ");
+    json_string(f, host.machine);
+    fprintf(f, ", \"cpus\": %ld},\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(f, "  \"options\": {\"warmup\": %d, \"repetitions\": %d, \"scale\": \"%s\"},\n",
+            bench->options.warmup, bench->options.repetitions, scales[bench->options.scale]);
+    fprintf(f, "  \"results\": [");
+    for (int i = 0; i < bench->result_count; i++) {
+        const BenchResult *r = &bench->results[i];
+        fprintf(f, "%s\n    {\"name\": ", i > 0 ? "," : "");
+        json_string(f, r->name);
+        fprintf(f, ", \"params\": ");
+        json_string(f, r->params);
+        fprintf(f, ", \"samples\": %d, \"batch\": %ld, \"min_ns\": %.0f, \"median_ns\": %.0f, "
+                   "\"p95_ns\": %.0f, \"p99_ns\": %.0f, \"mean_ns\": %.0f, \"stddev_ns\": %.0f",
+                r->samples, r->batch, r->min_ns, r->median_ns, r->p95_ns, r->p99_ns, r->mean_ns, r->stddev_ns);
+        if (r->items > 0.0) {
+            fprintf(f, ", \"items\": %.0f, \"items_per_sec\": %.1f", r->items,
+                    r->median_ns > 0.0 ? r->items / (r->median_ns / 1e9) : 0.0);
+        }
+        if (r->recall_k > 0) {
+            fprintf(f, ", \"k\": %d, \"recall\": %.4f", r->recall_k, r->recall);
+        }
+        if (r->memory_bytes > 0.0) {
+            fprintf(f, ", \"index_bytes\": %.0f", r->memory_bytes);
+        }
+        fprintf(f, "}");
+    }
+    fprintf(f, "\n  ]\n}\n");
+
+    if (f != stdout) {
+        return fclose(f) == 0;
+    }
+    return true;
+}
+
+// Helper: Generate the fixtures the frame benchmark scripts navigate, then print them
+static bool prepare_fixtures(const char *root)
+{
+    char path[4096];
+    bool ok = true;
+    static const int listings[] = { 1000, 10000, 100000 };
+    for (size_t i = 0; i < sizeof(listings) / sizeof(listings[0]); i++) {
+        ok = fixture_flat(root, listings[i], path, sizeof(path)) && ok;
+        printf("%s\n", path);
+    }
+    ok = fixture_tree(root, FIXTURE_TREE_DEPTH, FIXTURE_TREE_FANOUT, FIXTURE_TREE_FILES, path, sizeof(path)) && ok;
+    printf("%s\n", path);
+    ok = fixture_images(root, 500, path, sizeof(path)) && ok;
+    printf("%s\n", path);
+    if (!ok) {
+        fprintf(stderr, "bench: cannot generate the fixtures under %s\n", root);
+    }
+    return ok;
+}
+
+static void usage(const char *program)
+{
+    printf("Usage: %s [options]\n"
+           "  --filter TEXT      Only run cases whose name contains TEXT (e.g. dir.read)\n"
+           "  --scale SCALE      quick (1k files), default (1k and 100k), full (adds 1M)\n"
+           "  --repetitions N    Timed samples per case (default %d)\n"
+           "  --warmup N         Untimed runs before sampling (default %d)\n"
+           "  --max-seconds S    Stop sampling a case after S seconds (default %.0f)\n"
+           "  --fixtures DIR     Where fixtures are generated and kept (default %s)\n"
+           "  --dir PATH         Also benchmark reading PATH\n"
+           "  --json FILE        Write results as JSON to FILE (- for stdout)\n"
+           "  --prepare          Only generate the fixtures the frame benchmark navigates\n",
+           program, BENCH_DEFAULT_REPETITIONS, BENCH_DEFAULT_WARMUP, BENCH_DEFAULT_MAX_SECONDS,
+           BENCH_DEFAULT_FIXTURES);
+}
+
+int main(int argc, char *argv[])
+{
+    static Bench bench;
+    bench.options.warmup = BENCH_DEFAULT_WARMUP;
+    bench.options.repetitions = BENCH_DEFAULT_REPETITIONS;
+    bench.options.max_seconds = BENCH_DEFAULT_MAX_SECONDS;
+    bench.options.scale = BENCH_SCALE_DEFAULT;
+    bench.options.fixture_root = BENCH_DEFAULT_FIXTURES;
+    const char *json_file = NULL;
+    bool prepare = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            usage(argv[0]);
+            return 0;
+        }
+        if (strcmp(arg, "--prepare") == 0) {
+            prepare = true;
+            continue;
+        }
+        if (!value) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+        if (strcmp(arg, "--filter") == 0) {
+            bench.options.filter = value;
+        } else if (strcmp(arg, "--scale") == 0) {
+            if (strcmp(value, "quick") == 0) {
+                bench.options.scale = BENCH_SCALE_QUICK;
+            } else if (strcmp(value, "full") == 0) {
+                bench.options.scale = BENCH_SCALE_FULL;
+            } else {
+                bench.options.scale = BENCH_SCALE_DEFAULT;
+            }
+        } else if (strcmp(arg, "--repetitions") == 0) {
+            bench.options.repetitions = atoi(value);
+        } else if (strcmp(arg, "--warmup") == 0) {
+            bench.options.warmup = atoi(value);
+        } else if (strcmp(arg, "--max-seconds") == 0) {
+            bench.options.max_seconds = atof(value);
+        } else if (strcmp(arg, "--fixtures") == 0) {
+            bench.options.fixture_root = value;
+        } else if (strcmp(arg, "--dir") == 0) {
+            bench.options.dir = value;
+        } else if (strcmp(arg, "--json") == 0) {
+            json_file = value;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (prepare) {
+        return prepare_fixtures(bench.options.fixture_root) ? 0 : 1;
+    }
+
+    g_table = json_file && strcmp(json_file, "-") == 0 ? stderr : stdout;
+    fprintf(g_table, "Finder Plus Benchmarks (fixtures in %s)\n", bench.options.fixture_root);
+    fprintf(g_table, "%-20s %-36s %13s    %13s %8s\n", "case", "params", "median", "", "stddev");
+
+    bench_suite_filesystem(&bench);
+    bench_suite_search(&bench);
+    bench_suite_git(&bench);
+    bench_suite_ai(&bench);
+    bench_suite_recall(&bench);
+
+    fprintf(g_table, "%d cases\n", bench.result_count);
+    if (json_file && !write_json(&bench, json_file)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Benchmark harness. Each case runs a few untimed warmups, then is timed repeatedly;
+// runs too short for the clock are batched so a sample lasts at least
+// BENCH_MIN_SAMPLE_SEC. A case reports the minimum, median, 95th and 99th percentiles,
+// mean and standard deviation of its samples, plus throughput when it says how many items one
+// run handles. Search quality cases time each query themselves and add recall@k and
+// index memory. Results go to stdout as a table and, with --json, to a file for
+// regression tracking
+
+#define BENCH_MAX_RESULTS 256
+#define BENCH_MAX_SAMPLES 1000
+#define BENCH_MIN_SAMPLE_SEC 0.002      // Shorter runs are batched into one sample
+#define BENCH_MAX_BATCH 1000000
+
+// Fixture sizes to run: quick for a smoke run, full adds the million-file cases
+typedef enum BenchScale {
+    BENCH_SCALE_QUICK = 0,
+    BENCH_SCALE_DEFAULT,
+    BENCH_SCALE_FULL
+} BenchScale;
+
+typedef struct BenchOptions {
+    int warmup;                         // Untimed runs before sampling
+    int repetitions;                    // Samples per case
+    double max_seconds;                 // Stop sampling a case after this long (keeping at least 3)
+    BenchScale scale;
+    const char *filter;                 // Only cases whose name contains this (NULL for all)
+    const char *fixture_root;           // Where generated fixtures are kept between runs
+    const char *dir;                    // Extra directory to read, as perf_test did (may be NULL)
+} BenchOptions;
+
+typedef struct BenchResult {
+    char name[64];                      // "dir.read"
+    char params[96];                    // "files=100000"
+    int samples;
+    long batch;                         // Runs per sample
+    double min_ns;                      // Per run
+    double median_ns;
+    double p95_ns;
+    double p99_ns;
+    double mean_ns;
+    double stddev_ns;
+    double items;                       // Handled per run (0 if not counted)
+    int recall_k;                       // k of recall@k (0 if not measured)
+    double recall;                      // Share of the exact top k returned, over all queries
+    double memory_bytes;                // Index held in memory (0 if not measured)
+} BenchResult;
+
+typedef struct Bench {
+    BenchOptions options;
+    BenchResult results[BENCH_MAX_RESULTS];
+    int result_count;
+} Bench;
+
+// One case. setup runs before every timed run and is not timed; a case with setup is
+// never batched
+typedef struct BenchCase {
+    const char *name;
+    const char *params;
+    void (*setup)(void *ctx);           // May be NULL
+    void (*run)(void *ctx);
+    void *ctx;
+    double items;
+} BenchCase;
+
+// Whether name passes the filter (check before building fixtures for it)
+bool bench_enabled(const Bench *bench, const char *name);
+
+// Time a case and record its result; false if it was filtered out or the table is full
+bool bench_run(Bench *bench, const BenchCase *bench_case);
+
+// Record a case the caller timed, one sample per run (a query, say): name, params, items
+// and the recall and memory fields are taken from result, the statistics from samples
+bool bench_record(Bench *bench, const BenchResult *result, double *samples_ns, int count);
+
+// Record that a case could not run (its fixture could not be built, say)
+void bench_skip(const Bench *bench, const char *name, const char *reason);
+
+// Listing sizes the scale asks for (1k, 100k, 1M); returns how many went to sizes
+int bench_listing_sizes(const Bench *bench, int sizes[3]);
+
+// Seconds on the monotonic clock
+double bench_now(void);
+
+// Keep the compiler from dropping work whose result is unused
+void bench_consume(const void *value);
+
+// Suites, one per subsystem
+void bench_suite_filesystem(Bench *bench);
+void bench_suite_search(Bench *bench);
+void bench_suite_git(Bench *bench);
+void bench_suite_ai(Bench *bench);
+void bench_suite_recall(Bench *bench);
+
+#endif // BENCH_H
@@ -0,0 +1,214 @@
+#include "bench.h"
+#include "fixtures.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ai/duplicates.h"
+#include "ai/indexer.h"
+#include "ai/vectordb.h"
+
+#define VECTOR_QUERIES 64               // Queries cycled through, so no one result stays cached
+#define VECTOR_LIMIT 10
+#define IMAGE_FIXTURE_COUNT 500
+
+typedef struct VectorBench {
+    VectorDB *db;
+    float queries[VECTOR_QUERIES][EMBEDDING_DIMENSION];
+    int next;
+    int ef_search;                      // 0: exact scan
+} VectorBench;
+
+typedef struct IndexerBench {
+    const char *tree;
+    char db_path[4096];
+    VectorDB *db;
+    int64_t indexed;
+} IndexerBench;
+
+typedef struct DuplicateBench {
+    const char *path;
+    bool exact_only;
+    int groups;
+} DuplicateBench;
+
+// Helper: Open the database of count random vectors, filling it and linking its ANN
+// graph the first time
+static VectorDB *open_vectors(const char *root, int count)
+{
+    char db_path[4096];
+    snprintf(db_path, sizeof(db_path), "%s/vectors_%d.db", root, count);
+    VectorDB *db = vectordb_open(db_path);
+    if (db && vectordb_count_files(db) == count) {
+        return db;
+    }
+    if (db) {
+        vectordb_close(db);
+    }
+    fixture_remove_database(db_path);
+    db = vectordb_open(db_path);
+    if (!db) {
+        return NULL;
+    }
+
+    unsigned int seed = (unsigned int)count;
+    float embedding[EMBEDDING_DIMENSION];
+    vectordb_begin_batch(db);
+    for (int i = 0; i < count; i++) {
+        char path[64];
+        char name[32];
+        snprintf(name, sizeof(name), "file_%d.txt", i);
+        snprintf(path, sizeof(path), "/bench/%s", name);
+        fixture_unit_vector(embedding, EMBEDDING_DIMENSION, &seed);
+        if (vectordb_index_file(db, path, name, FILE_TYPE_TEXT, 1024, FIXTURE_EPOCH + i, embedding) !=
+            VECTORDB_STATUS_OK) {
+            vectordb_close(db);
+            return NULL;
+        }
+    }
+    vectordb_commit_batch(db);
+    while (vectordb_build_index(db, count) > 0) {
+    }
+    vectordb_save_index(db);
+    return db;
+}
+
+static void vector_run(void *ctx)
+{
+    VectorBench *bench = ctx;
+    const float *query = bench->queries[bench->next++ % VECTOR_QUERIES];
+    VectorSearchResults results = vectordb_search_ann(bench->db, query, VECTOR_LIMIT, bench->ef_search);
+    vector_search_results_free(&results);
+}
+
+static void indexer_setup(void *ctx)
+{
+    IndexerBench *bench = ctx;
+    if (bench->db) {
+        vectordb_close(bench->db);
+    }
+    fixture_remove_database(bench->db_path);
+    bench->db = vectordb_open(bench->db_path);
+}
+
+// Helper: A full pass over the tree with stub embeddings: scan, read, hash, write
+static void indexer_run(void *ctx)
+{
+    IndexerBench *bench = ctx;
+    IndexerConfig config = indexer_get_default_config();
+    config.enable_fsevents = false;
+    Indexer *indexer = indexer_create_with_config(&config);
+    indexer_set_vectordb(indexer, bench->db);
+    indexer_add_watch_dir(indexer, bench->tree);
+    if (indexer_start(indexer)) {
+        indexer_wait(indexer);
+        bench->indexed = indexer_get_stats(indexer).files_indexed;
+        indexer_stop(indexer);
+    }
+    indexer_destroy(indexer);
+}
+
+static void duplicates_run(void *ctx)
+{
+    DuplicateBench *bench = ctx;
+    DuplicateConfig config;
+    duplicate_config_init(&config);
+    if (bench->exact_only) {
+        config.detect_similar_images = false;
+        config.detect_similar_text = false;
+    }
+    DuplicateAnalysis *analysis = duplicate_analysis_create();
+    if (analysis) {
+        duplicate_scan_directory(bench->path, &config, NULL, NULL, analysis);
+        bench->groups = analysis->group_count;
+        duplicate_analysis_free(analysis);
+    }
+}
+
+// Helper: Vector search at each database size, approximate and exact
+static void bench_vectors(Bench *bench)
+{
+    if (!bench_enabled(bench, "vectordb.search")) {
+        return;
+    }
+
+    int sizes[3] = { 1000, 10000, 100000 };
+    int size_count = bench->options.scale == BENCH_SCALE_QUICK ? 1 :
+                     bench->options.scale == BENCH_SCALE_DEFAULT ? 2 : 3;
+    static VectorBench vectors;
+    unsigned int seed = 12345;
+    for (int q = 0; q < VECTOR_QUERIES; q++) {
+        fixture_unit_vector(vectors.queries[q], EMBEDDING_DIMENSION, &seed);
+    }
+
+    for (int i = 0; i < size_count; i++) {
+        vectors.db = open_vectors(bench->options.fixture_root, sizes[i]);
+        if (!vectors.db) {
+            bench_skip(bench, "vectordb.search", "cannot create the vector database");
+            continue;
+        }
+
+        char params[96];
+        vectors.ef_search = 64;
+        snprintf(params, sizeof(params), "vectors=%d ef=%d", sizes[i], vectors.ef_search);
+        bench_run(bench, &(BenchCase){ "vectordb.search", params, NULL, vector_run, &vectors, 1 });
+        vectors.ef_search = 0;
+        snprintf(params, sizeof(params), "vectors=%d exact", sizes[i]);
+        bench_run(bench, &(BenchCase){ "vectordb.search", params, NULL, vector_run, &vectors, 1 });
+        vectordb_close(vectors.db);
+    }
+}
+
+void bench_suite_ai(Bench *bench)
+{
+    const char *root = bench->options.fixture_root;
+    char params[96];
+
+    bench_vectors(bench);
+
+    char tree[4096];
+    bool have_tree = false;
+    if (bench_enabled(bench, "indexer.pass") || bench_enabled(bench, "duplicates.scan")) {
+        have_tree = fixture_tree(root, FIXTURE_TREE_DEPTH, FIXTURE_TREE_FANOUT, FIXTURE_TREE_FILES,
+                                 tree, sizeof(tree));
+    }
+    int64_t tree_files = have_tree ? fixture_count_files(tree) : 0;
+
+    if (bench_enabled(bench, "indexer.pass")) {
+        if (have_tree) {
+            IndexerBench indexer = { tree, { 0 }, NULL, 0 };
+            snprintf(indexer.db_path, sizeof(indexer.db_path), "%s/indexer_pass.db", root);
+            snprintf(params, sizeof(params), "files=%lld", (long long)tree_files);
+            bench_run(bench, &(BenchCase){ "indexer.pass", params, indexer_setup, indexer_run, &indexer,
+                                           (double)tree_files });
+            if (indexer.db) {
+                vectordb_close(indexer.db);
+            }
+            fixture_remove_database(indexer.db_path);
+        } else {
+            bench_skip(bench, "indexer.pass", "cannot create the tree fixture");
+        }
+    }
+
+    if (!bench_enabled(bench, "duplicates.scan")) {
+        return;
+    }
+    if (have_tree) {
+        DuplicateBench duplicates = { tree, true, 0 };
+        snprintf(params, sizeof(params), "files=%lld exact", (long long)tree_files);
+        bench_run(bench, &(BenchCase){ "duplicates.scan", params, NULL, duplicates_run, &duplicates,
+                                       (double)tree_files });
+    } else {
+        bench_skip(bench, "duplicates.scan", "cannot create the tree fixture");
+    }
+
+    char images[4096];
+    if (fixture_images(root, IMAGE_FIXTURE_COUNT, images, sizeof(images))) {
+        DuplicateBench duplicates = { images, false, 0 };
+        snprintf(params, sizeof(params), "images=%d similar", IMAGE_FIXTURE_COUNT);
+        bench_run(bench, &(BenchCase){ "duplicates.scan", params, NULL, duplicates_run, &duplicates,
+                                       IMAGE_FIXTURE_COUNT });
+    } else {
+        bench_skip(bench, "duplicates.scan", "cannot create the image fixture");
+    }
+}
@@ -0,0 +1,219 @@
+#include "bench.h"
+#include "fixtures.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "core/filesystem.h"
+#include "core/operations.h"
+#include "utils/perf.h"
+
+#define TEXT_FIXTURE_MB 64
+
+typedef struct ReadBench {
+    const char *path;
+    DirectoryState state;
+} ReadBench;
+
+typedef struct SortBench {
+    const DirectoryState *base;         // Listing as read (sorted by name)
+    DirectoryState work;
+    SortBy key;
+    bool ascending;
+} SortBench;
+
+typedef struct CacheBench {
+    const char *path;
+    DirCache cache;
+    DirectoryState state;
+} CacheBench;
+
+typedef struct CopyBench {
+    const char *source;
+    char dest[4096];
+    SyncMode mode;
+} CopyBench;
+
+static const char *const g_sort_names[] = { "name", "size", "modified", "type" };
+
+static void read_run(void *ctx)
+{
+    ReadBench *bench = ctx;
+    directory_read(&bench->state, bench->path);
+}
+
+static void sort_setup(void *ctx)
+{
+    SortBench *bench = ctx;
+    directory_state_free(&bench->work);
+    directory_state_copy(&bench->work, bench->base);
+}
+
+static void sort_run(void *ctx)
+{
+    SortBench *bench = ctx;
+    directory_sort(&bench->work, bench->key, bench->ascending);
+}
+
+// Helper: Flip the order every run, so each one applies a permutation already built
+static void resort_run(void *ctx)
+{
+    SortBench *bench = ctx;
+    bench->ascending = !bench->ascending;
+    directory_sort(&bench->work, bench->key, bench->ascending);
+}
+
+static void cache_run(void *ctx)
+{
+    CacheBench *bench = ctx;
+    directory_read_cached(&bench->state, bench->path, &bench->cache);
+}
+
+static void copy_setup(void *ctx)
+{
+    CopyBench *bench = ctx;
+    fixture_remove(bench->dest);
+}
+
+static void copy_run(void *ctx)
+{
+    CopyBench *bench = ctx;
+    file_copy_to(bench->source, bench->dest, NULL);
+}
+
+static void sync_run(void *ctx)
+{
+    CopyBench *bench = ctx;
+    file_sync_to(bench->source, bench->dest, bench->mode, false, NULL);
+}
+
+// Helper: Read a listing once and keep it for the cases that start from one
+static bool read_listing(const char *path, DirectoryState *state)
+{
+    directory_state_init(state);
+    if (!directory_read(state, path) || state->is_loading) {
+        directory_state_free(state);
+        return false;
+    }
+    return true;
+}
+
+// Helper: Read, sort and cache cases over one listing
+static void bench_listing(Bench *bench, const char *path, const char *label)
+{
+    char params[96];
+    DirectoryState base;
+    if (!read_listing(path, &base)) {
+        bench_skip(bench, "dir.read", "cannot read the listing");
+        return;
+    }
+
+    ReadBench read;
+    read.path = path;
+    directory_state_init(&read.state);
+    snprintf(params, sizeof(params), "%s", label);
+    bench_run(bench, &(BenchCase){ "dir.read", params, NULL, read_run, &read, base.count });
+    directory_state_free(&read.state);
+
+    for (int key = SORT_BY_NAME; key <= SORT_BY_TYPE; key++) {
+        SortBench sort = { &base, { 0 }, (SortBy)key, true };
+        directory_state_init(&sort.work);
+        snprintf(params, sizeof(params), "%s key=%s", label, g_sort_names[key]);
+        bench_run(bench, &(BenchCase){ "dir.sort", params, sort_setup, sort_run, &sort, base.count });
+
+        // Permutations kept from the first sort
+        directory_state_free(&sort.work);
+        directory_state_copy(&sort.work, &base);
+        directory_sort(&sort.work, sort.key, sort.ascending);
+        bench_run(bench, &(BenchCase){ "dir.resort", params, NULL, resort_run, &sort, base.count });
+        directory_state_free(&sort.work);
+    }
+
+    if (bench_enabled(bench, "dir.cache_hit")) {
+        CacheBench cache;
+        cache.path = path;
+        dir_cache_init(&cache.cache);
+        dir_cache_set_budget(&cache.cache, SIZE_MAX);
+        directory_state_init(&cache.state);
+        directory_read_cached(&cache.state, path, &cache.cache);
+        snprintf(params, sizeof(params), "%s", label);
+        bench_run(bench, &(BenchCase){ "dir.cache_hit", params, NULL, cache_run, &cache, 1 });
+        directory_state_free(&cache.state);
+        dir_cache_free(&cache.cache);
+    }
+
+    directory_state_free(&base);
+}
+
+// Helper: Copy engine cases: one big file, a tree of small ones, and a sync with
+// nothing to do
+static void bench_copy(Bench *bench)
+{
+    const char *root = bench->options.fixture_root;
+    char source[4096];
+    char params[96];
+
+    if (bench_enabled(bench, "copy.file")) {
+        if (fixture_text(root, TEXT_FIXTURE_MB, source, sizeof(source))) {
+            CopyBench copy = { source, { 0 }, SYNC_UPDATE };
+            snprintf(copy.dest, sizeof(copy.dest), "%s/copy_file.c", root);
+            snprintf(params, sizeof(params), "mb=%d", TEXT_FIXTURE_MB);
+            struct stat st;
+            double bytes = stat(source, &st) == 0 ? (double)st.st_size : 0.0;
+            bench_run(bench, &(BenchCase){ "copy.file", params, copy_setup, copy_run, &copy, bytes });
+            fixture_remove(copy.dest);
+        } else {
+            bench_skip(bench, "copy.file", "cannot create the text fixture");
+        }
+    }
+
+    if (!bench_enabled(bench, "copy.tree") && !bench_enabled(bench, "sync.unchanged")) {
+        return;
+    }
+    if (!fixture_tree(root, FIXTURE_TREE_DEPTH, FIXTURE_TREE_FANOUT, FIXTURE_TREE_FILES, source, sizeof(source))) {
+        bench_skip(bench, "copy.tree", "cannot create the tree fixture");
+        return;
+    }
+    int64_t files = fixture_count_files(source);
+
+    CopyBench copy = { source, { 0 }, SYNC_UPDATE };
+    snprintf(copy.dest, sizeof(copy.dest), "%s/copy_tree", root);
+    snprintf(params, sizeof(params), "files=%lld", (long long)files);
+    bench_run(bench, &(BenchCase){ "copy.tree", params, copy_setup, copy_run, &copy, (double)files });
+
+    // Every file is already there: only the walk and the stat comparisons remain
+    fixture_remove(copy.dest);
+    file_copy_to(copy.source, copy.dest, NULL);
+    bench_run(bench, &(BenchCase){ "sync.unchanged", params, NULL, sync_run, &copy, (double)files });
+    fixture_remove(copy.dest);
+}
+
+void bench_suite_filesystem(Bench *bench)
+{
+    int sizes[3];
+    int size_count = bench_listing_sizes(bench, sizes);
+    for (int i = 0; i < size_count; i++) {
+        if (!bench_enabled(bench, "dir.read") && !bench_enabled(bench, "dir.sort") &&
+            !bench_enabled(bench, "dir.resort") && !bench_enabled(bench, "dir.cache_hit")) {
+            break;
+        }
+        char path[4096];
+        char label[32];
+        snprintf(label, sizeof(label), "files=%d", sizes[i]);
+        if (!fixture_flat(bench->options.fixture_root, sizes[i], path, sizeof(path))) {
+            bench_skip(bench, "dir.read", "cannot create the listing fixture");
+            continue;
+        }
+        bench_listing(bench, path, label);
+    }
+
+    if (bench->options.dir) {
+        char label[96];
+        snprintf(label, sizeof(label), "dir=%.80s", bench->options.dir);
+        bench_listing(bench, bench->options.dir, label);
+    }
+
+    bench_copy(bench);
+}
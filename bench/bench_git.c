@@ -0,0 +1,75 @@
+#include "bench.h"
+#include "fixtures.h"
+
+#include <stdio.h>
+
+#include "core/git.h"
+
+#define GIT_FIXTURE_FILES 2000
+#define GIT_FIXTURE_FILES_FULL 20000
+
+typedef struct GitBench {
+    const char *root;
+    char dirty[4096];                   // File reported changed before each watched refresh
+    GitState state;
+    int changed;
+} GitBench;
+
+// Helper: One refresh, as the browser does on entering a directory
+static void refresh_run(void *ctx)
+{
+    GitBench *bench = ctx;
+    GitStatusResult result;
+    git_status_result_init(&result);
+    git_refresh(&bench->state, &result, bench->root);
+    bench->changed = result.count;
+    git_status_result_free(&result);
+}
+
+static void cold_setup(void *ctx)
+{
+    (void)ctx;
+    git_release_cache();
+}
+
+static void watched_setup(void *ctx)
+{
+    GitBench *bench = ctx;
+    git_status_mark_dirty(bench->dirty);
+}
+
+void bench_suite_git(Bench *bench)
+{
+    if (!bench_enabled(bench, "git.status")) {
+        return;
+    }
+
+    int count = bench->options.scale >= BENCH_SCALE_FULL ? GIT_FIXTURE_FILES_FULL : GIT_FIXTURE_FILES;
+    char root[4096];
+    if (!fixture_git_repo(bench->options.fixture_root, count, root, sizeof(root))) {
+        bench_skip(bench, "git.status", "git is not installed or the repository could not be made");
+        return;
+    }
+
+    GitBench git = { root, { 0 }, { 0 }, 0 };
+    snprintf(git.dirty, sizeof(git.dirty), "%s/module0/source_0.c", root);
+    git_state_init(&git.state);
+
+    char params[96];
+    snprintf(params, sizeof(params), "files=%d mode=cold", count);
+    bench_run(bench, &(BenchCase){ "git.status", params, cold_setup, refresh_run, &git, count });
+
+    // Repository kept open between refreshes
+    snprintf(params, sizeof(params), "files=%d mode=warm", count);
+    bench_run(bench, &(BenchCase){ "git.status", params, NULL, refresh_run, &git, count });
+
+    // Cached status, rescanning only the file reported changed
+    git_status_watch(root);
+    refresh_run(&git);
+    snprintf(params, sizeof(params), "files=%d mode=watched", count);
+    bench_run(bench, &(BenchCase){ "git.status", params, watched_setup, refresh_run, &git, count });
+    git_status_watch(NULL);
+
+    git_release_cache();
+    git_state_free(&git.state);
+}
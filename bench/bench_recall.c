@@ -0,0 +1,440 @@
+#include "bench.h"
+#include "fixtures.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ai/clip.h"
+#include "ai/embeddings.h"
+#include "ai/semantic_search.h"
+#include "ai/vectordb.h"
+#include "ai/visual_search.h"
+
+// Search quality: a labeled corpus (documents and images spread around topic centroids,
+// as real embeddings cluster) is indexed once, then a query set runs through each
+// search entry point. Every query's results are compared with a brute-force scan of
+// the corpus, giving recall@k next to the query latency and the index memory. Text
+// queries are embedded with whatever engine the build has (stub vectors without models)
+
+#define RECALL_K 10
+#define RECALL_TOPICS 64
+#define RECALL_NOISE 0.6f               // Spread of an item around its topic centroid
+#define RECALL_QUERIES 200
+#define RECALL_WARMUP_QUERIES 20
+#define RECALL_BUILD_BUDGET 4096
+
+typedef struct Corpus {
+    int dimension;
+    int count;
+    float *vectors;                     // count rows, unit length
+} Corpus;
+
+// One way of running a query: what it is called and how it is set up
+typedef struct RecallSetting {
+    const char *label;                  // "ef=64", "exact int8"
+    int ef_search;                      // 0: exact scan
+    VectorQuantization quantization;
+} RecallSetting;
+
+static const RecallSetting g_settings[] = {
+    { "ef=16", 16, VECTOR_QUANT_NONE },
+    { "ef=64", 64, VECTOR_QUANT_NONE },
+    { "ef=256", 256, VECTOR_QUANT_NONE },
+    { "exact", 0, VECTOR_QUANT_NONE },
+    { "exact int8", 0, VECTOR_QUANT_INT8 },
+    { "exact binary", 0, VECTOR_QUANT_BINARY },
+};
+
+typedef enum RecallQueryKind {
+    QUERY_TEXT,                         // semantic_search_query
+    QUERY_EMBEDDING,                    // semantic_search_by_embedding
+    QUERY_IMAGE_TEXT                    // visual_search_query
+} RecallQueryKind;
+
+// Queries of one kind, with the exact top k of each from the brute-force scan
+typedef struct QuerySet {
+    RecallQueryKind kind;
+    char text[RECALL_QUERIES][64];
+    float *embeddings;                  // RECALL_QUERIES rows of the corpus dimension
+    int truth[RECALL_QUERIES][RECALL_K];
+} QuerySet;
+
+// Helper: Vector near the centroid of topic (both corpus rows and embedding queries)
+static void topic_vector(const float *centroids, int dimension, int topic, float *out, unsigned int *seed)
+{
+    fixture_unit_vector(out, dimension, seed);
+    const float *centroid = centroids + (size_t)topic * (size_t)dimension;
+    float norm = 0.0f;
+    for (int i = 0; i < dimension; i++) {
+        out[i] = centroid[i] + RECALL_NOISE * out[i];
+        norm += out[i] * out[i];
+    }
+    norm = norm > 0.0f ? 1.0f / sqrtf(norm) : 0.0f;
+    for (int i = 0; i < dimension; i++) {
+        out[i] *= norm;
+    }
+}
+
+// Helper: Generate count items around RECALL_TOPICS centroids (item i has topic i % topics)
+static bool corpus_init(Corpus *corpus, int dimension, int count, float *centroids)
+{
+    corpus->dimension = dimension;
+    corpus->count = count;
+    corpus->vectors = malloc((size_t)count * (size_t)dimension * sizeof(float));
+    if (!corpus->vectors) {
+        return false;
+    }
+
+    unsigned int seed = (unsigned int)(dimension * 7919);
+    for (int t = 0; t < RECALL_TOPICS; t++) {
+        fixture_unit_vector(centroids + (size_t)t * (size_t)dimension, dimension, &seed);
+    }
+    seed = (unsigned int)count;
+    for (int i = 0; i < count; i++) {
+        topic_vector(centroids, dimension, i % RECALL_TOPICS, corpus->vectors + (size_t)i * (size_t)dimension,
+                     &seed);
+    }
+    return true;
+}
+
+// Helper: Exact top k of the corpus for query, by brute force (best first)
+static void brute_force(const Corpus *corpus, const float *query, int *top)
+{
+    float scores[RECALL_K];
+    int found = 0;
+    for (int i = 0; i < corpus->count; i++) {
+        const float *row = corpus->vectors + (size_t)i * (size_t)corpus->dimension;
+        float score = 0.0f;
+        for (int d = 0; d < corpus->dimension; d++) {
+            score += row[d] * query[d];
+        }
+        if (found == RECALL_K && score <= scores[RECALL_K - 1]) {
+            continue;
+        }
+        int at = found < RECALL_K ? found++ : RECALL_K - 1;
+        while (at > 0 && scores[at - 1] < score) {
+            scores[at] = scores[at - 1];
+            top[at] = top[at - 1];
+            at--;
+        }
+        scores[at] = score;
+        top[at] = i;
+    }
+}
+
+// Helper: Corpus item a result path names ("..._<id>.ext"), or -1
+static int item_from_path(const char *path)
+{
+    const char *id = strrchr(path, '_');
+    return id ? atoi(id + 1) : -1;
+}
+
+// Helper: How many of the exact top k are among the count returned items
+static int matches(const int *truth, const int *items, int count)
+{
+    int hits = 0;
+    for (int i = 0; i < RECALL_K; i++) {
+        for (int j = 0; j < count; j++) {
+            if (items[j] == truth[i]) {
+                hits++;
+                break;
+            }
+        }
+    }
+    return hits;
+}
+
+// Helper: Open the text database of the corpus, indexing it and linking its graph the
+// first time
+static VectorDB *open_text_db(const char *root, const Corpus *corpus)
+{
+    char db_path[4096];
+    snprintf(db_path, sizeof(db_path), "%s/recall_text_%d.db", root, corpus->count);
+    VectorDB *db = vectordb_open(db_path);
+    if (db && vectordb_count_files(db) == corpus->count) {
+        return db;
+    }
+    if (db) {
+        vectordb_close(db);
+    }
+    fixture_remove_database(db_path);
+    db = vectordb_open(db_path);
+    if (!db) {
+        return NULL;
+    }
+
+    vectordb_begin_batch(db);
+    for (int i = 0; i < corpus->count; i++) {
+        char path[96];
+        char name[48];
+        snprintf(name, sizeof(name), "note_%06d.txt", i);
+        snprintf(path, sizeof(path), "/recall/topic_%02d/%s", i % RECALL_TOPICS, name);
+        if (vectordb_index_file(db, path, name, FILE_TYPE_TEXT, 2048, FIXTURE_EPOCH + i,
+                                corpus->vectors + (size_t)i * (size_t)corpus->dimension) != VECTORDB_STATUS_OK) {
+            vectordb_close(db);
+            return NULL;
+        }
+    }
+    vectordb_commit_batch(db);
+    while (vectordb_build_index(db, RECALL_BUILD_BUDGET) > 0) {
+    }
+    vectordb_save_index(db);
+    return db;
+}
+
+// Helper: Open the image database of the corpus the same way; vs is attached to it
+static VectorDB *open_image_db(const char *root, const Corpus *corpus, VisualSearch *vs)
+{
+    char db_path[4096];
+    snprintf(db_path, sizeof(db_path), "%s/recall_images_%d.db", root, corpus->count);
+    VectorDB *db = vectordb_open(db_path);
+    if (db) {
+        visual_search_set_vectordb(vs, db);
+        if (visual_search_get_stats(vs).indexed_images == corpus->count) {
+            while (visual_search_build_index(vs, RECALL_BUILD_BUDGET) > 0) {
+            }
+            return db;
+        }
+        visual_search_set_vectordb(vs, NULL);
+        vectordb_close(db);
+    }
+    fixture_remove_database(db_path);
+    db = vectordb_open(db_path);
+    if (!db) {
+        return NULL;
+    }
+
+    visual_search_set_vectordb(vs, db);
+    vectordb_begin_batch(db);
+    for (int i = 0; i < corpus->count; i++) {
+        char path[96];
+        snprintf(path, sizeof(path), "/recall/topic_%02d/photo_%06d.jpg", i % RECALL_TOPICS, i);
+        if (!visual_search_index_embedding(vs, path, corpus->vectors + (size_t)i * (size_t)corpus->dimension,
+                                           640, 480, 65536, FIXTURE_EPOCH + i)) {
+            vectordb_commit_batch(db);
+            visual_search_set_vectordb(vs, NULL);
+            vectordb_close(db);
+            return NULL;
+        }
+    }
+    vectordb_commit_batch(db);
+    while (visual_search_build_index(vs, RECALL_BUILD_BUDGET) > 0) {
+    }
+    return db;
+}
+
+// Helper: Queries of one kind against corpus, with their exact answers
+static bool queries_init(QuerySet *queries, RecallQueryKind kind, const Corpus *corpus, const float *centroids,
+                         EmbeddingEngine *text_engine, CLIPEngine *clip_engine)
+{
+    queries->kind = kind;
+    queries->embeddings = malloc((size_t)RECALL_QUERIES * (size_t)corpus->dimension * sizeof(float));
+    if (!queries->embeddings) {
+        return false;
+    }
+
+    unsigned int seed = 424242u + (unsigned int)kind;
+    for (int q = 0; q < RECALL_QUERIES; q++) {
+        float *embedding = queries->embeddings + (size_t)q * (size_t)corpus->dimension;
+        int topic = (int)(fixture_random(&seed) % RECALL_TOPICS);
+        snprintf(queries->text[q], sizeof(queries->text[q]), "notes about topic %d, part %d", topic, q);
+
+        // The embedding the search will use, so the brute force ranks the same vector
+        if (kind == QUERY_EMBEDDING) {
+            topic_vector(centroids, corpus->dimension, topic, embedding, &seed);
+        } else if (kind == QUERY_TEXT) {
+            EmbeddingResult result = embedding_generate(text_engine, queries->text[q]);
+            if (result.status != EMBEDDING_STATUS_OK) {
+                return false;
+            }
+            memcpy(embedding, result.embedding, sizeof(result.embedding));
+        } else {
+            CLIPTextResult result = clip_embed_text(clip_engine, queries->text[q]);
+            if (result.status != CLIP_STATUS_OK) {
+                return false;
+            }
+            memcpy(embedding, result.embedding, sizeof(result.embedding));
+        }
+        brute_force(corpus, embedding, queries->truth[q]);
+    }
+    return true;
+}
+
+// Helper: Run query q of the set; fills items with the returned corpus ids
+static int run_query(SemanticSearch *search, VisualSearch *vs, const QuerySet *queries, int q, int dimension,
+                     int ef_search, int *items)
+{
+    int count = 0;
+    if (queries->kind == QUERY_IMAGE_TEXT) {
+        VisualSearchOptions options = visual_search_default_options();
+        options.max_results = RECALL_K;
+        options.ef_search = ef_search;
+        VisualSearchResults results = visual_search_query(vs, queries->text[q], &options);
+        for (int i = 0; i < results.count && count < RECALL_K; i++) {
+            items[count++] = item_from_path(results.results[i].path);
+        }
+        visual_search_results_free(&results);
+        return count;
+    }
+
+    // Vector ranking only, so what is measured is the index against the brute force
+    SemanticSearchOptions options = semantic_search_default_options();
+    options.max_results = RECALL_K;
+    options.ef_search = ef_search;
+    options.hybrid = false;
+    options.min_score = -1.0f;
+    SemanticSearchResults results =
+        queries->kind == QUERY_TEXT ?
+        semantic_search_query(search, queries->text[q], &options) :
+        semantic_search_by_embedding(search, queries->embeddings + (size_t)q * (size_t)dimension, &options);
+    for (int i = 0; i < results.count && count < RECALL_K; i++) {
+        items[count++] = item_from_path(results.results[i].path);
+    }
+    semantic_search_results_free(&results);
+    return count;
+}
+
+// Helper: Time every query of the set under each setting and record recall@k
+static void measure(Bench *bench, const char *name, const QuerySet *queries, int corpus_count, int dimension,
+                    SemanticSearch *search, VisualSearch *vs, VectorDB *db)
+{
+    if (!bench_enabled(bench, name)) {
+        return;
+    }
+
+    static double samples[RECALL_QUERIES];
+    for (size_t s = 0; s < sizeof(g_settings) / sizeof(g_settings[0]); s++) {
+        const RecallSetting *setting = &g_settings[s];
+        if (vs && queries->kind == QUERY_IMAGE_TEXT) {
+            visual_search_set_quantization(vs, setting->quantization);
+        } else {
+            vectordb_set_quantization(db, setting->quantization);
+        }
+
+        int items[RECALL_K];
+        for (int q = 0; q < RECALL_WARMUP_QUERIES; q++) {
+            run_query(search, vs, queries, q, dimension, setting->ef_search, items);
+        }
+
+        int found = 0;
+        for (int q = 0; q < RECALL_QUERIES; q++) {
+            double start = bench_now();
+            int count = run_query(search, vs, queries, q, dimension, setting->ef_search, items);
+            samples[q] = (bench_now() - start) * 1e9;
+            found += matches(queries->truth[q], items, count);
+        }
+
+        BenchResult result = { 0 };
+        snprintf(result.name, sizeof(result.name), "%s", name);
+        snprintf(result.params, sizeof(result.params), "items=%d %s", corpus_count, setting->label);
+        result.recall_k = RECALL_K;
+        result.recall = (double)found / (double)(RECALL_QUERIES * RECALL_K);
+        result.memory_bytes = queries->kind == QUERY_IMAGE_TEXT ? (double)visual_search_get_stats(vs).index_memory :
+                                                                  (double)vectordb_index_memory(db);
+        bench_record(bench, &result, samples, RECALL_QUERIES);
+    }
+}
+
+// Helper: Text search cases over a corpus of count documents; the text queries need
+// engine (NULL without a model), the embedding queries do not
+static void bench_text(Bench *bench, int count, EmbeddingEngine *engine)
+{
+    Corpus corpus = { 0 };
+    float *centroids = malloc((size_t)RECALL_TOPICS * EMBEDDING_DIMENSION * sizeof(float));
+    QuerySet *text = calloc(1, sizeof(QuerySet));
+    QuerySet *embedding = calloc(1, sizeof(QuerySet));
+    SemanticSearch *search = semantic_search_create();
+    VectorDB *db = NULL;
+
+    if (centroids && text && embedding && search && corpus_init(&corpus, EMBEDDING_DIMENSION, count, centroids) &&
+        (db = open_text_db(bench->options.fixture_root, &corpus)) != NULL) {
+        semantic_search_set_embedding_engine(search, engine);
+        semantic_search_set_vectordb(search, db);
+        if (!engine) {
+            bench_skip(bench, "recall.semantic_text", "no embedding model (run from where models/ is)");
+        } else if (queries_init(text, QUERY_TEXT, &corpus, centroids, engine, NULL)) {
+            measure(bench, "recall.semantic_text", text, count, EMBEDDING_DIMENSION, search, NULL, db);
+        }
+        if (queries_init(embedding, QUERY_EMBEDDING, &corpus, centroids, NULL, NULL)) {
+            measure(bench, "recall.semantic_vector", embedding, count, EMBEDDING_DIMENSION, search, NULL, db);
+        }
+    } else {
+        bench_skip(bench, "recall.semantic_vector", "cannot build the text corpus");
+    }
+
+    semantic_search_destroy(search);
+    if (db) {
+        vectordb_close(db);
+    }
+    if (text) free(text->embeddings);
+    if (embedding) free(embedding->embeddings);
+    free(text);
+    free(embedding);
+    free(centroids);
+    free(corpus.vectors);
+}
+
+// Helper: Image search cases over a corpus of count images
+static void bench_images(Bench *bench, int count, CLIPEngine *engine)
+{
+    Corpus corpus = { 0 };
+    float *centroids = malloc((size_t)RECALL_TOPICS * CLIP_EMBEDDING_DIMENSION * sizeof(float));
+    QuerySet *queries = calloc(1, sizeof(QuerySet));
+    VisualSearch *vs = visual_search_create();
+    VectorDB *db = NULL;
+
+    if (centroids && queries && vs && corpus_init(&corpus, CLIP_EMBEDDING_DIMENSION, count, centroids)) {
+        visual_search_set_clip_engine(vs, engine);
+        db = open_image_db(bench->options.fixture_root, &corpus, vs);
+    }
+    if (db && queries_init(queries, QUERY_IMAGE_TEXT, &corpus, centroids, NULL, engine)) {
+        measure(bench, "recall.visual_text", queries, count, CLIP_EMBEDDING_DIMENSION, NULL, vs, db);
+    } else {
+        bench_skip(bench, "recall.visual_text", "cannot build the image corpus");
+    }
+
+    // Saves the linked graph next to the database for the next run
+    visual_search_destroy(vs);
+    if (db) {
+        vectordb_close(db);
+    }
+    if (queries) free(queries->embeddings);
+    free(queries);
+    free(centroids);
+    free(corpus.vectors);
+}
+
+void bench_suite_recall(Bench *bench)
+{
+    bool text = bench_enabled(bench, "recall.semantic_text") || bench_enabled(bench, "recall.semantic_vector");
+    bool images = bench_enabled(bench, "recall.visual_text");
+    if (!text && !images) {
+        return;
+    }
+
+    // Above VECTOR_INDEX_EXACT_BELOW, so the graph is what answers approximate queries
+    int sizes[2] = { bench->options.scale == BENCH_SCALE_QUICK ? 5000 : 20000, 100000 };
+    int size_count = bench->options.scale >= BENCH_SCALE_FULL ? 2 : 1;
+
+    // Models are found where the app looks for them (relative to the working directory)
+    EmbeddingEngine *text_engine = embedding_engine_create();
+    CLIPEngine *clip_engine = clip_engine_create();
+    bool text_ready = text_engine && embedding_engine_load_model(text_engine, NULL) == EMBEDDING_STATUS_OK;
+    bool images_ready = clip_engine && clip_engine_load_model(clip_engine, NULL) == CLIP_STATUS_OK;
+
+    for (int i = 0; i < size_count; i++) {
+        if (text) {
+            bench_text(bench, sizes[i], text_ready ? text_engine : NULL);
+        }
+        if (images && images_ready) {
+            bench_images(bench, sizes[i], clip_engine);
+        } else if (images) {
+            bench_skip(bench, "recall.visual_text", "no CLIP model (run from where models/ is)");
+        }
+    }
+
+    embedding_engine_destroy(text_engine);
+    clip_engine_destroy(clip_engine);
+}
@@ -0,0 +1,92 @@
+#include "bench.h"
+#include "fixtures.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "core/filesystem.h"
+#include "utils/fuzzy.h"
+
+// Queries as typed: a short one that keeps most names, a longer one that keeps few
+static const char *const g_queries[] = { "rpt", "invoice_4.pdf" };
+
+typedef struct FuzzyBench {
+    const DirectoryState *dir;
+    char *folded;                       // Lower-case copy of the name arena, as search keeps
+    uint64_t *masks;
+    int *candidates;
+    const char *query;
+    int matches;
+} FuzzyBench;
+
+// Helper: What search does once per listing: fold the names and take their masks
+static void index_run(void *ctx)
+{
+    FuzzyBench *bench = ctx;
+    const DirectoryState *dir = bench->dir;
+    fuzzy_fold(bench->folded, dir->names, dir->names_size);
+    for (int i = 0; i < dir->count; i++) {
+        bench->masks[i] = fuzzy_char_mask(directory_entry_name(dir, &dir->entries[i]));
+    }
+    bench_consume(bench->masks);
+}
+
+// Helper: What search does per keystroke: compile, reject by mask, score the rest
+static void filter_run(void *ctx)
+{
+    FuzzyBench *bench = ctx;
+    const DirectoryState *dir = bench->dir;
+    FuzzyQuery query;
+    fuzzy_compile(&query, bench->query, false);
+    int count = fuzzy_prefilter(&query, bench->masks, dir->count, bench->candidates);
+    int matches = 0;
+    for (int i = 0; i < count; i++) {
+        const FileEntry *entry = &dir->entries[bench->candidates[i]];
+        if (fuzzy_score(&query, directory_entry_name(dir, entry), bench->folded + entry->name_offset,
+                        entry->name_len, NULL, 0, NULL) > 0) {
+            matches++;
+        }
+    }
+    bench->matches = matches;
+}
+
+void bench_suite_search(Bench *bench)
+{
+    if (!bench_enabled(bench, "fuzzy.index") && !bench_enabled(bench, "fuzzy.filter")) {
+        return;
+    }
+
+    int sizes[3];
+    int size_count = bench_listing_sizes(bench, sizes);
+    for (int i = 0; i < size_count; i++) {
+        char path[4096];
+        DirectoryState dir;
+        directory_state_init(&dir);
+        if (!fixture_flat(bench->options.fixture_root, sizes[i], path, sizeof(path)) ||
+            !directory_read(&dir, path)) {
+            bench_skip(bench, "fuzzy.filter", "cannot read the listing fixture");
+            directory_state_free(&dir);
+            continue;
+        }
+
+        FuzzyBench fuzzy = { &dir, malloc(dir.names_size + 1), malloc(sizeof(uint64_t) * (size_t)(dir.count + 1)),
+                             malloc(sizeof(int) * (size_t)(dir.count + 1)), NULL, 0 };
+        if (fuzzy.folded && fuzzy.masks && fuzzy.candidates) {
+            char params[96];
+            snprintf(params, sizeof(params), "names=%d", dir.count);
+            bench_run(bench, &(BenchCase){ "fuzzy.index", params, NULL, index_run, &fuzzy, dir.count });
+            index_run(&fuzzy);
+
+            for (size_t q = 0; q < sizeof(g_queries) / sizeof(g_queries[0]); q++) {
+                fuzzy.query = g_queries[q];
+                snprintf(params, sizeof(params), "names=%d query=%s", dir.count, fuzzy.query);
+                bench_run(bench, &(BenchCase){ "fuzzy.filter", params, NULL, filter_run, &fuzzy, dir.count });
+            }
+        }
+        free(fuzzy.folded);
+        free(fuzzy.masks);
+        free(fuzzy.candidates);
+        directory_state_free(&dir);
+    }
+}
@@ -0,0 +1,474 @@
+#include "fixtures.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define FIXTURE_MAX_CONTENT 16384       // Largest file fixture_tree writes
+
+static const char *const g_words[] = {
+    "report", "invoice", "photo", "notes", "draft", "backup", "index", "main",
+    "config", "readme", "budget", "summary", "holiday", "scan", "export", "design"
+};
+
+static const char *const g_extensions[] = {
+    "txt", "c", "h", "md", "json", "png", "jpg", "pdf", "csv", "log", "zip", "dat"
+};
+
+#define WORD_COUNT ((int)(sizeof(g_words) / sizeof(g_words[0])))
+#define EXTENSION_COUNT ((int)(sizeof(g_extensions) / sizeof(g_extensions[0])))
+
+unsigned int fixture_random(unsigned int *state)
+{
+    unsigned int x = *state ? *state : 0x9E3779B9u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+void fixture_remove_database(const char *db_path)
+{
+    static const char *const suffixes[] = { "", "-wal", "-shm", "-journal", ".hnsw", ".images.hnsw" };
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+        char path[4200];
+        snprintf(path, sizeof(path), "%s%s", db_path, suffixes[i]);
+        remove(path);
+    }
+}
+
+void fixture_unit_vector(float *vector, int dimension, unsigned int *state)
+{
+    float norm = 0.0f;
+    for (int i = 0; i < dimension; i++) {
+        vector[i] = (float)(fixture_random(state) % 20001) / 10000.0f - 1.0f;
+        norm += vector[i] * vector[i];
+    }
+    norm = sqrtf(norm);
+    for (int i = 0; i < dimension; i++) {
+        vector[i] = norm > 0.0f ? vector[i] / norm : 0.0f;
+    }
+}
+
+// Helper: Create path and every directory above it
+static bool make_dirs(const char *path)
+{
+    char buffer[4096];
+    size_t len = strlen(path);
+    if (len == 0 || len >= sizeof(buffer)) {
+        return false;
+    }
+    memcpy(buffer, path, len + 1);
+    for (char *p = buffer + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+                return false;
+            }
+            *p = '/';
+        }
+    }
+    return mkdir(buffer, 0755) == 0 || errno == EEXIST;
+}
+
+// Helper: nftw callback removing each entry after its children
+static int remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    (void)st;
+    (void)type;
+    (void)ftw;
+    remove(path);
+    return 0;
+}
+
+void fixture_remove(const char *path)
+{
+    nftw(path, remove_entry, 64, FTW_DEPTH | FTW_PHYS);
+}
+
+static int64_t g_counted;
+
+// Helper: nftw callback counting regular files
+static int count_entry(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    (void)path;
+    (void)ftw;
+    if (type == FTW_F && S_ISREG(st->st_mode)) {
+        g_counted++;
+    }
+    return 0;
+}
+
+int64_t fixture_count_files(const char *dir)
+{
+    g_counted = 0;
+    nftw(dir, count_entry, 64, FTW_PHYS);
+    return g_counted;
+}
+
+// Helper: Resolve a fixture's directory; true if a finished one is already there,
+// otherwise an empty directory is left for the generator
+static bool fixture_begin(const char *root, const char *name, char *out, size_t out_size, bool *ready)
+{
+    int written = snprintf(out, out_size, "%s/%s", root, name);
+    if (written < 0 || (size_t)written >= out_size) {
+        return false;
+    }
+
+    char stamp[4096];
+    snprintf(stamp, sizeof(stamp), "%s/%s", out, FIXTURE_STAMP);
+    struct stat st;
+    *ready = stat(stamp, &st) == 0;
+    if (*ready) {
+        return true;
+    }
+
+    fixture_remove(out);
+    return make_dirs(out);
+}
+
+// Helper: Mark a fixture finished
+static bool fixture_finish(const char *dir)
+{
+    char stamp[4096];
+    snprintf(stamp, sizeof(stamp), "%s/%s", dir, FIXTURE_STAMP);
+    FILE *f = fopen(stamp, "w");
+    if (!f) {
+        return false;
+    }
+    return fclose(f) == 0;
+}
+
+// Helper: Create a file of size bytes without writing them (sparse) and set its mtime
+static bool make_sized_file(const char *path, off_t size, time_t mtime)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ftruncate(fd, size) == 0;
+    close(fd);
+
+    struct timeval times[2] = { { mtime, 0 }, { mtime, 0 } };
+    utimes(path, times);
+    return ok;
+}
+
+// Helper: Write len bytes to a new file
+static bool write_file(const char *path, const void *data, size_t len)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(data, 1, len, f) == len;
+    return fclose(f) == 0 && ok;
+}
+
+// Helper: Write size bytes of text drawn from seed
+static bool write_text_file(const char *path, size_t size, unsigned int seed)
+{
+    char data[FIXTURE_MAX_CONTENT];
+    size_t used = 0;
+    while (used < size) {
+        unsigned int r = fixture_random(&seed);
+        int n = snprintf(data + used, sizeof(data) - used, "%s %s %u\n", g_words[r % WORD_COUNT],
+                         g_words[(r >> 4) % WORD_COUNT], r % 100000);
+        if (n < 0 || (size_t)n >= sizeof(data) - used) {
+            break;
+        }
+        used += (size_t)n;
+    }
+    return write_file(path, data, used < size ? used : size);
+}
+
+// Helper: Fill dir with count entries named like a user's files; one in twenty is a
+// directory. Without contents the files are sparse, of up to 4 MB; with contents they
+// hold up to FIXTURE_MAX_CONTENT bytes of text, every ninth the same as the one before
+static bool fill_directory(const char *dir, int count, bool contents, unsigned int *seed)
+{
+    char path[4096];
+    unsigned int previous = 0;
+    for (int i = 0; i < count; i++) {
+        unsigned int r = fixture_random(seed);
+        const char *word = g_words[r % WORD_COUNT];
+        if (r % 20 == 0) {
+            snprintf(path, sizeof(path), "%s/%s Folder %d", dir, word, i);
+            if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+                return false;
+            }
+            continue;
+        }
+
+        const char *extension = g_extensions[(r >> 8) % EXTENSION_COUNT];
+        snprintf(path, sizeof(path), "%s/%s_%d_%u.%s", dir, word, i, (r >> 12) % 1000, extension);
+        unsigned int size_seed = fixture_random(seed);
+        time_t mtime = FIXTURE_EPOCH + (time_t)(fixture_random(seed) % (365u * 24 * 3600));
+        bool ok;
+        if (contents) {
+            unsigned int content_seed = (i % 9 == 8 && previous) ? previous : size_seed;
+            ok = write_text_file(path, 64 + content_seed % (FIXTURE_MAX_CONTENT - 64), content_seed);
+            previous = content_seed;
+        } else {
+            ok = make_sized_file(path, (off_t)(size_seed % (4u * 1024 * 1024)), mtime);
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool fixture_flat(const char *root, int count, char *out, size_t out_size)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "flat_%d", count);
+    bool ready;
+    if (!fixture_begin(root, name, out, out_size, &ready)) {
+        return false;
+    }
+    if (ready) {
+        return true;
+    }
+
+    unsigned int seed = (unsigned int)count;
+    return fill_directory(out, count, false, &seed) && fixture_finish(out);
+}
+
+// Helper: One level of fixture_tree
+static bool fill_tree(const char *dir, int depth, int fanout, int files_per_dir, unsigned int *seed)
+{
+    if (!fill_directory(dir, files_per_dir, true, seed)) {
+        return false;
+    }
+    if (depth == 0) {
+        return true;
+    }
+    for (int i = 0; i < fanout; i++) {
+        char child[4096];
+        snprintf(child, sizeof(child), "%s/level%d_%d", dir, depth, i);
+        if (mkdir(child, 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+        if (!fill_tree(child, depth - 1, fanout, files_per_dir, seed)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool fixture_tree(const char *root, int depth, int fanout, int files_per_dir, char *out, size_t out_size)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "tree_d%d_f%d_n%d", depth, fanout, files_per_dir);
+    bool ready;
+    if (!fixture_begin(root, name, out, out_size, &ready)) {
+        return false;
+    }
+    if (ready) {
+        return true;
+    }
+
+    unsigned int seed = (unsigned int)(depth * 131 + fanout * 17 + files_per_dir);
+    return fill_tree(out, depth, fanout, files_per_dir, &seed) && fixture_finish(out);
+}
+
+bool fixture_text(const char *root, int megabytes, char *out, size_t out_size)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "text_%dmb", megabytes);
+    bool ready;
+    if (!fixture_begin(root, name, out, out_size, &ready)) {
+        return false;
+    }
+    char file[4096];
+    snprintf(file, sizeof(file), "%s/big.c", out);
+    size_t dir_len = strlen(out);
+    if (ready) {
+        snprintf(out + dir_len, out_size - dir_len, "/big.c");
+        return true;
+    }
+
+    FILE *f = fopen(file, "w");
+    if (!f) {
+        return false;
+    }
+    unsigned int seed = (unsigned int)megabytes;
+    size_t target = (size_t)megabytes * 1024 * 1024;
+    size_t written = 0;
+    for (int line = 0; written < target; line++) {
+        unsigned int r = fixture_random(&seed);
+        int n;
+        if (line % 12 == 0) {
+            n = fprintf(f, "\n// %s: %s handling for %s entries\n", g_words[r % WORD_COUNT],
+                        g_words[(r >> 4) % WORD_COUNT], g_words[(r >> 8) % WORD_COUNT]);
+        } else {
+            n = fprintf(f, "    int %s_%d = compute_%s(value, %u); // %s\n", g_words[r % WORD_COUNT], line,
+                        g_words[(r >> 4) % WORD_COUNT], r % 10000, g_extensions[(r >> 8) % EXTENSION_COUNT]);
+        }
+        if (n < 0) {
+            fclose(f);
+            return false;
+        }
+        written += (size_t)n;
+    }
+    if (fclose(f) != 0 || !fixture_finish(out)) {
+        return false;
+    }
+    snprintf(out + dir_len, out_size - dir_len, "/big.c");
+    return true;
+}
+
+#define IMAGE_SIZE 64
+
+// Helper: Write a 24-bit BMP of IMAGE_SIZE square pixels drawn from seed; altered
+// changes a handful of them
+static bool write_image(const char *path, unsigned int seed, bool altered)
+{
+    const int row_bytes = IMAGE_SIZE * 3;   // Already a multiple of 4
+    const int pixel_bytes = row_bytes * IMAGE_SIZE;
+    unsigned char data[54 + IMAGE_SIZE * IMAGE_SIZE * 3];
+    memset(data, 0, 54);
+
+    // BITMAPFILEHEADER and BITMAPINFOHEADER, little endian
+    uint32_t file_size = 54 + (uint32_t)pixel_bytes;
+    data[0] = 'B';
+    data[1] = 'M';
+    for (int i = 0; i < 4; i++) data[2 + i] = (unsigned char)(file_size >> (8 * i));
+    data[10] = 54;
+    data[14] = 40;
+    data[18] = IMAGE_SIZE;
+    data[22] = IMAGE_SIZE;
+    data[26] = 1;
+    data[28] = 24;
+    for (int i = 0; i < 4; i++) data[34 + i] = (unsigned char)((uint32_t)pixel_bytes >> (8 * i));
+
+    // Smooth gradients with a few blobs, so perceptual hashes differ between seeds
+    unsigned int r = seed;
+    int cx = (int)(fixture_random(&r) % IMAGE_SIZE);
+    int cy = (int)(fixture_random(&r) % IMAGE_SIZE);
+    unsigned char tint = (unsigned char)fixture_random(&r);
+    unsigned char *pixels = data + 54;
+    for (int y = 0; y < IMAGE_SIZE; y++) {
+        for (int x = 0; x < IMAGE_SIZE; x++) {
+            int dx = x - cx;
+            int dy = y - cy;
+            bool blob = dx * dx + dy * dy < IMAGE_SIZE * 4;
+            unsigned char *p = pixels + y * row_bytes + x * 3;
+            p[0] = (unsigned char)(x * 4);
+            p[1] = (unsigned char)(y * 4);
+            p[2] = blob ? 255 : tint;
+        }
+    }
+    if (altered) {
+        for (int i = 0; i < 8; i++) {
+            pixels[fixture_random(&r) % (unsigned int)pixel_bytes] ^= 0x10;
+        }
+    }
+    return write_file(path, data, sizeof(data));
+}
+
+bool fixture_images(const char *root, int count, char *out, size_t out_size)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "images_%d", count);
+    bool ready;
+    if (!fixture_begin(root, name, out, out_size, &ready)) {
+        return false;
+    }
+    if (ready) {
+        return true;
+    }
+
+    for (int i = 0; i < count; i++) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/image_%05d.bmp", out, i);
+        // Copies and near copies draw from the previous image's seed
+        unsigned int seed = (unsigned int)(i + 1) * 2654435761u;
+        bool altered = false;
+        if (i > 0 && i % 5 == 0) {
+            seed = (unsigned int)i * 2654435761u;
+        } else if (i > 0 && i % 7 == 0) {
+            seed = (unsigned int)i * 2654435761u;
+            altered = true;
+        }
+        if (!write_image(path, seed, altered)) {
+            return false;
+        }
+    }
+    return fixture_finish(out);
+}
+
+// Helper: Run a shell command in dir; true if it exited with 0
+static bool run_in(const char *dir, const char *command)
+{
+    char line[8192];
+    int written = snprintf(line, sizeof(line), "cd '%s' && %s >/dev/null 2>&1", dir, command);
+    if (written < 0 || (size_t)written >= sizeof(line)) {
+        return false;
+    }
+    return system(line) == 0;
+}
+
+bool fixture_git_repo(const char *root, int count, char *out, size_t out_size)
+{
+    if (system("git --version >/dev/null 2>&1") != 0) {
+        return false;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "git_%d", count);
+    bool ready;
+    if (!fixture_begin(root, name, out, out_size, &ready)) {
+        return false;
+    }
+    if (ready) {
+        return true;
+    }
+    if (strchr(out, '\'')) {
+        return false;   // Quoted with single quotes below
+    }
+
+    // Spread over a few directories like a source tree
+    char path[4096];
+    for (int i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), "%s/module%d", out, i % 16);
+        mkdir(path, 0755);
+        snprintf(path, sizeof(path), "%s/module%d/source_%d.c", out, i % 16, i);
+        char body[128];
+        int len = snprintf(body, sizeof(body), "int source_%d(void) { return %d; }\n", i, i * 7);
+        if (!write_file(path, body, (size_t)len)) {
+            return false;
+        }
+    }
+
+    // The stamp is ignored, so git status sees only what is changed below
+    if (!run_in(out, "git init -q . && echo " FIXTURE_STAMP " >> .git/info/exclude && git add -A && "
+                     "git -c user.name=bench -c user.email=bench@localhost commit -q -m fixture")) {
+        return false;
+    }
+
+    for (int i = 0; i < count; i += 10) {
+        snprintf(path, sizeof(path), "%s/module%d/source_%d.c", out, i % 16, i);
+        const char body[] = "int changed(void) { return 0; }\n";
+        if (!write_file(path, body, sizeof(body) - 1)) {
+            return false;
+        }
+    }
+    for (int i = 0; i < 16; i++) {
+        snprintf(path, sizeof(path), "%s/module%d/untracked_%d.c", out, i, i);
+        if (!write_file(path, "\n", 1)) {
+            return false;
+        }
+    }
+    return fixture_finish(out);
+}
@@ -0,0 +1,55 @@
+#ifndef BENCH_FIXTURES_H
+#define BENCH_FIXTURES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Synthetic fixtures for the benchmarks. Each one is generated under the fixture root
+// the first time it is asked for and reused afterwards: a finished fixture leaves a
+// stamp file, so an interrupted generation is redone. Contents depend only on the
+// parameters, so results stay comparable between runs and machines
+
+#define FIXTURE_STAMP ".bench-fixture"
+#define FIXTURE_EPOCH 1600000000        // Generated mtimes fall in the year after this
+
+// The tree the copy, indexer and duplicate benchmarks share (about 2000 files)
+#define FIXTURE_TREE_DEPTH 3
+#define FIXTURE_TREE_FANOUT 4
+#define FIXTURE_TREE_FILES 24
+
+// Flat directory of count files with varied names, extensions, sizes and mtimes; the
+// files are sparse, so a million of them costs inodes rather than data
+bool fixture_flat(const char *root, int count, char *out, size_t out_size);
+
+// Tree depth levels deep with fanout subdirectories and files_per_dir files at each level,
+// holding up to 16 KB of text each, some of it repeated
+bool fixture_tree(const char *root, int depth, int fanout, int files_per_dir, char *out, size_t out_size);
+
+// One text file of about megabytes MB of source-like lines
+bool fixture_text(const char *root, int megabytes, char *out, size_t out_size);
+
+// count small images (24-bit BMP): every fifth is an exact copy of another and every
+// seventh a slightly altered one, so duplicate detection has work of both kinds
+bool fixture_images(const char *root, int count, char *out, size_t out_size);
+
+// Git repository of count committed files, a tenth of them modified and a few untracked;
+// false if git is not installed
+bool fixture_git_repo(const char *root, int count, char *out, size_t out_size);
+
+// Regular files below dir (the stamp included)
+int64_t fixture_count_files(const char *dir);
+
+// Remove a directory tree (fixture copies made by the benchmarks)
+void fixture_remove(const char *path);
+
+// Remove a vector database with its journal and saved ANN indexes
+void fixture_remove_database(const char *db_path);
+
+// Deterministic pseudo-random numbers (xorshift)
+unsigned int fixture_random(unsigned int *state);
+
+// Random unit vector of dimension floats, from the same generator
+void fixture_unit_vector(float *vector, int dimension, unsigned int *state);
+
+#endif // BENCH_FIXTURES_H
@@ -4,6 +4,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
 
 #define AI_EPSILON 1e-4f
 
@@ -69,4 +70,12 @@ static inline const char* path_basename(const char *path)
     return base ? base + 1 : path;
 }
 
+// Path of a file named name in the same directory as path
+static inline void path_sibling(const char *path, const char *name, char *out, size_t size)
+{
+    const char *slash = strrchr(path, '/');
+    int dir_length = slash != NULL ? (int)(slash - path + 1) : 0;
+    snprintf(out, size, "%.*s%s", dir_length, path, name);
+}
+
 #endif // AI_COMMON_H
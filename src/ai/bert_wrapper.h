@@ -15,6 +15,9 @@ extern "C" {
 // Opaque context type
 struct bert_ctx;
 
+// Token id in the model's vocabulary
+typedef int32_t bert_vocab_id;
+
 // Load model from file
 struct bert_ctx* bert_load_from_file(const char* fname);
 
@@ -39,6 +42,32 @@ void bert_encode_batch(
     const char** texts,
     float** embeddings);
 
+// Tokenize text, including the [CLS] and [SEP] markers
+void bert_tokenize(
+    struct bert_ctx* ctx,
+    const char* text,
+    bert_vocab_id* tokens,
+    int32_t* n_tokens,
+    int32_t n_max_tokens);
+
+// Generate embedding for one tokenized text
+void bert_eval(
+    struct bert_ctx* ctx,
+    int32_t n_threads,
+    bert_vocab_id* tokens,
+    int32_t n_tokens,
+    float* embeddings);
+
+// Generate embeddings for n_batch_size tokenized texts, padded to the longest. The
+// batch may not be larger than any bert_encode_batch call has sized the context for
+void bert_eval_batch(
+    struct bert_ctx* ctx,
+    int32_t n_threads,
+    int32_t n_batch_size,
+    bert_vocab_id** batch_tokens,
+    int32_t* n_tokens,
+    float** batch_embeddings);
+
 // Get embedding dimension
 int32_t bert_n_embd(struct bert_ctx* ctx);
 
@@ -1,13 +1,30 @@
 #include "clip.h"
 #include "ai_common.h"
+#include "vector_ops.h"
+#include "compute_budget.h"
+#include "../utils/file_type.h"
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <time.h>
-#include <ctype.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 #ifdef FINDER_PLUS_AI_MODELS
 #include "clip_wrapper.h"
+#ifdef __APPLE__
+#include "../platform/coreml.h"
+#include "../platform/imageio.h"
+#define CLIP_COREML
+#endif
+#endif
+
+#ifdef CLIP_COREML
+// Core ML export of the vision tower, compiled and placed beside the gguf file. It takes
+// pixel_values (float, 1 x 3 x size x size, normalized as clip.cpp preprocesses) and
+// returns image_embeds. Text queries are short and stay on clip.cpp
+#define COREML_MODEL_NAME "clip-vision.mlmodelc"
+#define COREML_OUTPUT "image_embeds"
 #endif
 
 // Timing helper macro
@@ -18,27 +35,31 @@ struct CLIPEngine {
     CLIPConfig config;
     bool model_loaded;
     bool initialized;
+
+    // Inference holds the model shared; load and unload hold it exclusively
+    pthread_rwlock_t lock;
+    bool lazy;                  // config.model_path loads on first use (and again after a trim)
+    atomic_llong last_used;     // time() of the last inference
 #ifdef FINDER_PLUS_AI_MODELS
     struct clip_ctx *clip_ctx;
     int n_threads;
 #endif
+#ifdef CLIP_COREML
+    CoreMLModel *coreml;        // GPU/Neural Engine image path when config.use_gpu
+    int coreml_values;          // Floats in one pixel_values input
+#endif
 };
 
 // Default model path
 static const char *DEFAULT_MODEL_PATH = "models/clip-vit-b32.gguf";
 
-// Supported image extensions
-static const char * const SUPPORTED_EXTENSIONS[] = {
-    "jpg", "jpeg", "png", "bmp", "gif", "webp", "tiff", "tif", NULL
-};
-
-// Validate engine is ready for inference
+// Validate engine is ready for inference (loaded, or loads on first use)
 static CLIPStatus validate_engine_ready(const CLIPEngine *engine)
 {
     if (engine == NULL || !engine->initialized) {
         return CLIP_STATUS_NOT_INITIALIZED;
     }
-    if (!engine->model_loaded) {
+    if (!engine->model_loaded && !engine->lazy) {
         return CLIP_STATUS_NOT_INITIALIZED;
     }
     return CLIP_STATUS_OK;
@@ -61,7 +82,7 @@ CLIPEngine* clip_engine_create(void)
 {
     CLIPConfig config = {0};
     config.num_threads = 0;
-    config.use_gpu = false;
+    config.use_gpu = true;     // Core ML when its export is installed, CPU otherwise
     config.image_size = 224;  // CLIP default
     strncpy(config.model_path, DEFAULT_MODEL_PATH, sizeof(config.model_path) - 1);
 
@@ -82,11 +103,18 @@ CLIPEngine* clip_engine_create_with_config(const CLIPConfig *config)
     memcpy(&engine->config, config, sizeof(CLIPConfig));
     engine->model_loaded = false;
     engine->initialized = true;
+    pthread_rwlock_init(&engine->lock, NULL);
+    engine->lazy = false;
+    atomic_init(&engine->last_used, 0);
 
 #ifdef FINDER_PLUS_AI_MODELS
     engine->clip_ctx = NULL;
     engine->n_threads = config->num_threads > 0 ? config->num_threads : 4;
 #endif
+#ifdef CLIP_COREML
+    engine->coreml = NULL;
+    engine->coreml_values = 0;
+#endif
 
     return engine;
 }
@@ -98,19 +126,13 @@ void clip_engine_destroy(CLIPEngine *engine)
     }
 
     clip_engine_unload_model(engine);
+    pthread_rwlock_destroy(&engine->lock);
     free(engine);
 }
 
-CLIPStatus clip_engine_load_model(CLIPEngine *engine, const char *model_path)
+// Helper: load config.model_path (call with the lock held exclusively)
+static CLIPStatus load_model_locked(CLIPEngine *engine)
 {
-    if (engine == NULL) {
-        return CLIP_STATUS_NOT_INITIALIZED;
-    }
-
-    if (model_path != NULL) {
-        strncpy(engine->config.model_path, model_path, sizeof(engine->config.model_path) - 1);
-    }
-
     if (!clip_model_exists(engine->config.model_path)) {
         return CLIP_STATUS_MODEL_NOT_FOUND;
     }
@@ -121,6 +143,17 @@ CLIPStatus clip_engine_load_model(CLIPEngine *engine, const char *model_path)
     if (engine->clip_ctx == NULL) {
         return CLIP_STATUS_MODEL_LOAD_ERROR;
     }
+#ifdef CLIP_COREML
+    if (engine->config.use_gpu && engine->coreml == NULL) {
+        char path[4096];
+        path_sibling(engine->config.model_path, COREML_MODEL_NAME, path, sizeof(path));
+        engine->coreml = coreml_model_load(path, true);
+        engine->coreml_values = coreml_model_input_size(engine->coreml, "pixel_values");
+        if (engine->coreml != NULL) {
+            fprintf(stderr, "CLIP: encoding images with Core ML\n");
+        }
+    }
+#endif
     engine->model_loaded = true;
     return CLIP_STATUS_OK;
 #else
@@ -130,22 +163,84 @@ CLIPStatus clip_engine_load_model(CLIPEngine *engine, const char *model_path)
 #endif
 }
 
-void clip_engine_unload_model(CLIPEngine *engine)
+// Helper: free the model (call with the lock held exclusively)
+static void unload_model_locked(CLIPEngine *engine)
 {
-    if (engine == NULL) {
-        return;
-    }
-
 #ifdef FINDER_PLUS_AI_MODELS
     if (engine->clip_ctx != NULL) {
         clip_free(engine->clip_ctx);
         engine->clip_ctx = NULL;
     }
 #endif
+#ifdef CLIP_COREML
+    coreml_model_free(engine->coreml);
+    engine->coreml = NULL;
+#endif
 
     engine->model_loaded = false;
 }
 
+CLIPStatus clip_engine_load_model(CLIPEngine *engine, const char *model_path)
+{
+    if (engine == NULL) {
+        return CLIP_STATUS_NOT_INITIALIZED;
+    }
+
+    pthread_rwlock_wrlock(&engine->lock);
+    if (model_path != NULL) {
+        strncpy(engine->config.model_path, model_path, sizeof(engine->config.model_path) - 1);
+    }
+    engine->lazy = false;
+    if (engine->model_loaded) {
+        unload_model_locked(engine);
+    }
+    CLIPStatus status = load_model_locked(engine);
+    pthread_rwlock_unlock(&engine->lock);
+    return status;
+}
+
+CLIPStatus clip_engine_load_model_lazily(CLIPEngine *engine, const char *model_path)
+{
+    if (engine == NULL) {
+        return CLIP_STATUS_NOT_INITIALIZED;
+    }
+
+    pthread_rwlock_wrlock(&engine->lock);
+    if (model_path != NULL) {
+        strncpy(engine->config.model_path, model_path, sizeof(engine->config.model_path) - 1);
+    }
+    engine->lazy = clip_model_exists(engine->config.model_path);
+    pthread_rwlock_unlock(&engine->lock);
+    return engine->lazy ? CLIP_STATUS_OK : CLIP_STATUS_MODEL_NOT_FOUND;
+}
+
+void clip_engine_unload_model(CLIPEngine *engine)
+{
+    if (engine == NULL) {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&engine->lock);
+    unload_model_locked(engine);
+    engine->lazy = false;
+    pthread_rwlock_unlock(&engine->lock);
+}
+
+bool clip_engine_trim(CLIPEngine *engine, double idle_sec)
+{
+    // Skip an engine in use rather than wait for it
+    if (engine == NULL || pthread_rwlock_trywrlock(&engine->lock) != 0) {
+        return false;
+    }
+    bool idle = (double)(time(NULL) - atomic_load(&engine->last_used)) >= idle_sec;
+    bool unload = engine->lazy && engine->model_loaded && idle;
+    if (unload) {
+        unload_model_locked(engine);
+    }
+    pthread_rwlock_unlock(&engine->lock);
+    return unload;
+}
+
 bool clip_engine_is_loaded(const CLIPEngine *engine)
 {
     if (engine == NULL) {
@@ -154,6 +249,140 @@ bool clip_engine_is_loaded(const CLIPEngine *engine)
     return engine->model_loaded;
 }
 
+bool clip_engine_is_available(const CLIPEngine *engine)
+{
+    if (engine == NULL) {
+        return false;
+    }
+    return engine->model_loaded || engine->lazy;
+}
+
+// Helper: hold the model for one inference, loading it first if it was deferred or
+// trimmed. Returns false (lock released) if there is no model to use
+static bool begin_use(CLIPEngine *engine)
+{
+    atomic_store(&engine->last_used, (long long)time(NULL));
+
+    pthread_rwlock_rdlock(&engine->lock);
+    if (!engine->model_loaded && engine->lazy) {
+        pthread_rwlock_unlock(&engine->lock);
+        pthread_rwlock_wrlock(&engine->lock);
+        if (!engine->model_loaded && engine->lazy && load_model_locked(engine) != CLIP_STATUS_OK) {
+            engine->lazy = false;   // Do not retry a broken model on every call
+        }
+        pthread_rwlock_unlock(&engine->lock);
+        pthread_rwlock_rdlock(&engine->lock);
+    }
+
+    if (!engine->model_loaded) {
+        pthread_rwlock_unlock(&engine->lock);
+        return false;
+    }
+    return true;
+}
+
+static void end_use(CLIPEngine *engine)
+{
+    pthread_rwlock_unlock(&engine->lock);
+}
+
+#ifdef FINDER_PLUS_AI_MODELS
+#ifdef CLIP_COREML
+// Helper: encode count preprocessed images with Core ML in one batch, into embeddings
+// (count * CLIP_EMBEDDING_DIMENSION floats); false to fall back to clip.cpp
+static bool encode_images_coreml(CLIPEngine *engine, struct clip_image_f32 *const *images, int count,
+                                 float *embeddings)
+{
+    size_t values = (size_t)engine->coreml_values;
+    for (int i = 0; i < count; i++) {
+        if ((size_t)images[i]->nx * (size_t)images[i]->ny * 3 != values) {
+            return false;
+        }
+    }
+
+    float *planes = malloc((size_t)count * values * sizeof(float));
+    if (planes == NULL) {
+        return false;
+    }
+    // clip.cpp keeps pixels interleaved (RGBRGB...); the export wants one plane per channel
+    size_t pixels = values / 3;
+    for (int i = 0; i < count; i++) {
+        float *image_planes = planes + (size_t)i * values;
+        for (size_t p = 0; p < pixels; p++) {
+            for (size_t c = 0; c < 3; c++) {
+                image_planes[c * pixels + p] = images[i]->data[p * 3 + c];
+            }
+        }
+    }
+
+    CoreMLInput input = { "pixel_values", COREML_FLOAT32, planes };
+    bool ok = coreml_model_predict(engine->coreml, &input, 1, count, COREML_OUTPUT,
+                                   embeddings, CLIP_EMBEDDING_DIMENSION);
+    free(planes);
+    for (int i = 0; ok && i < count; i++) {
+        vector_normalize(embeddings + (size_t)i * CLIP_EMBEDDING_DIMENSION, CLIP_EMBEDDING_DIMENSION);
+    }
+    return ok;
+}
+#endif
+
+// Helper: encode a preprocessed image, on Core ML when available
+static bool encode_image(CLIPEngine *engine, struct clip_image_f32 *image, float *embedding)
+{
+#ifdef CLIP_COREML
+    if (engine->coreml != NULL && encode_images_coreml(engine, &image, 1, embedding)) {
+        return true;
+    }
+#endif
+    int threads = compute_budget_acquire(engine->n_threads);
+    bool ok = clip_image_encode(engine->clip_ctx, threads, image, embedding, true);
+    compute_budget_release(threads);
+    return ok;
+}
+
+// Helper: decode an image file at reduced size and preprocess it for the model, noting
+// its original size. Touches no engine state, so batches run it on several threads
+static CLIPStatus prepare_image(CLIPEngine *engine, const char *path, struct clip_image_f32 *image,
+                                int *width, int *height)
+{
+    struct clip_image_u8 *decoded = clip_image_u8_make();
+    if (decoded == NULL) {
+        return CLIP_STATUS_MEMORY_ERROR;
+    }
+
+#ifdef __APPLE__
+    // Twice the input size keeps the shorter side above it up to a 2:1 aspect ratio
+    unsigned char *rgb = NULL;
+    int w = 0;
+    int h = 0;
+    if (!platform_load_image_scaled(path, engine->config.image_size * 2, &rgb, &w, &h, width, height)) {
+        clip_image_u8_free(decoded);
+        return CLIP_STATUS_IMAGE_LOAD_ERROR;
+    }
+    decoded->nx = w;
+    decoded->ny = h;
+    decoded->size = (size_t)w * (size_t)h * 3;
+    decoded->data = rgb;
+#else
+    if (!clip_image_load_from_file(path, decoded)) {
+        clip_image_u8_free(decoded);
+        return CLIP_STATUS_IMAGE_LOAD_ERROR;
+    }
+    *width = decoded->nx;
+    *height = decoded->ny;
+#endif
+
+    bool ok = clip_image_preprocess(engine->clip_ctx, decoded, image);
+
+#ifdef __APPLE__
+    decoded->data = NULL;   // Ours, not clip.cpp's
+    free(rgb);
+#endif
+    clip_image_u8_free(decoded);
+    return ok ? CLIP_STATUS_OK : CLIP_STATUS_INFERENCE_ERROR;
+}
+#endif
+
 CLIPImageResult clip_embed_image(CLIPEngine *engine, const char *image_path)
 {
     CLIPImageResult result = {0};
@@ -181,47 +410,24 @@ CLIPImageResult clip_embed_image(CLIPEngine *engine, const char *image_path)
         return result;
     }
 
-    start = clock();
-
-#ifdef FINDER_PLUS_AI_MODELS
-    struct clip_image_u8 *img_u8 = NULL;
-    struct clip_image_f32 *img_f32 = NULL;
-
-    img_u8 = clip_image_u8_make();
-    if (img_u8 == NULL) {
-        result.status = CLIP_STATUS_MEMORY_ERROR;
-        goto cleanup;
-    }
-
-    if (!clip_image_load_from_file(image_path, img_u8)) {
-        result.status = CLIP_STATUS_IMAGE_LOAD_ERROR;
-        goto cleanup;
+    if (!begin_use(engine)) {
+        result.status = CLIP_STATUS_NOT_INITIALIZED;
+        return result;
     }
 
-    result.width = img_u8->nx;
-    result.height = img_u8->ny;
+    start = clock();
 
-    img_f32 = clip_image_f32_make();
+#ifdef FINDER_PLUS_AI_MODELS
+    struct clip_image_f32 *img_f32 = clip_image_f32_make();
     if (img_f32 == NULL) {
         result.status = CLIP_STATUS_MEMORY_ERROR;
-        goto cleanup;
-    }
-
-    if (!clip_image_preprocess(engine->clip_ctx, img_u8, img_f32)) {
-        result.status = CLIP_STATUS_INFERENCE_ERROR;
-        goto cleanup;
-    }
-
-    if (!clip_image_encode(engine->clip_ctx, engine->n_threads, img_f32, result.embedding, true)) {
-        result.status = CLIP_STATUS_INFERENCE_ERROR;
-        goto cleanup;
+    } else {
+        result.status = prepare_image(engine, image_path, img_f32, &result.width, &result.height);
+        if (result.status == CLIP_STATUS_OK && !encode_image(engine, img_f32, result.embedding)) {
+            result.status = CLIP_STATUS_INFERENCE_ERROR;
+        }
+        clip_image_f32_free(img_f32);
     }
-
-    result.status = CLIP_STATUS_OK;
-
-cleanup:
-    if (img_u8) clip_image_u8_free(img_u8);
-    if (img_f32) clip_image_f32_free(img_f32);
 #else
     // Stub: generate embedding from file path
     generate_stub_clip_embedding(hash_file_path(image_path), result.embedding);
@@ -230,6 +436,8 @@ cleanup:
     result.status = CLIP_STATUS_OK;
 #endif
 
+    end_use(engine);
+
     end = clock();
     result.inference_time_ms = ELAPSED_MS(start, end);
 
@@ -255,6 +463,11 @@ CLIPImageResult clip_embed_image_data(CLIPEngine *engine,
         return result;
     }
 
+    if (!begin_use(engine)) {
+        result.status = CLIP_STATUS_NOT_INITIALIZED;
+        return result;
+    }
+
     start = clock();
 
 #ifdef FINDER_PLUS_AI_MODELS
@@ -319,7 +532,7 @@ CLIPImageResult clip_embed_image_data(CLIPEngine *engine,
         goto cleanup_data;
     }
 
-    if (!clip_image_encode(engine->clip_ctx, engine->n_threads, img_f32, result.embedding, true)) {
+    if (!encode_image(engine, img_f32, result.embedding)) {
         result.status = CLIP_STATUS_INFERENCE_ERROR;
         goto cleanup_data;
     }
@@ -343,6 +556,8 @@ cleanup_data:
     result.status = CLIP_STATUS_OK;
 #endif
 
+    end_use(engine);
+
     end = clock();
     result.inference_time_ms = ELAPSED_MS(start, end);
 
@@ -370,6 +585,11 @@ CLIPTextResult clip_embed_text(CLIPEngine *engine, const char *text)
         return result;
     }
 
+    if (!begin_use(engine)) {
+        result.status = CLIP_STATUS_NOT_INITIALIZED;
+        return result;
+    }
+
     start = clock();
 
 #ifdef FINDER_PLUS_AI_MODELS
@@ -386,7 +606,10 @@ CLIPTextResult clip_embed_text(CLIPEngine *engine, const char *text)
         goto cleanup_text;
     }
 
-    if (!clip_text_encode(engine->clip_ctx, engine->n_threads, &tokens, result.embedding, true)) {
+    int threads = compute_budget_acquire(engine->n_threads);
+    bool encoded = clip_text_encode(engine->clip_ctx, threads, &tokens, result.embedding, true);
+    compute_budget_release(threads);
+    if (!encoded) {
         result.status = CLIP_STATUS_INFERENCE_ERROR;
         goto cleanup_text;
     }
@@ -401,12 +624,129 @@ cleanup_text:
     result.status = CLIP_STATUS_OK;
 #endif
 
+    end_use(engine);
+
     end = clock();
     result.inference_time_ms = ELAPSED_MS(start, end);
 
     return result;
 }
 
+#ifdef FINDER_PLUS_AI_MODELS
+// Most threads decoding one batch; ImageIO itself is partly parallel
+#define CLIP_BATCH_DECODE_THREADS 8
+
+// One batch being decoded: workers claim paths in turn
+typedef struct BatchDecode {
+    CLIPEngine *engine;
+    const char **paths;
+    int count;
+    atomic_int next;
+    struct clip_image_f32 **images;     // Preprocessed, NULL where it failed
+    CLIPBatchImageResult *result;
+} BatchDecode;
+
+static void* batch_decode_worker(void *arg)
+{
+    BatchDecode *job = arg;
+    int i;
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->count) {
+        const char *path = job->paths[i];
+        if (path == NULL || !clip_is_supported_image(path)) {
+            job->result->statuses[i] = CLIP_STATUS_IMAGE_FORMAT_ERROR;
+            continue;
+        }
+
+        struct clip_image_f32 *image = clip_image_f32_make();
+        CLIPStatus status = CLIP_STATUS_MEMORY_ERROR;
+        if (image != NULL) {
+            status = prepare_image(job->engine, path, image,
+                                   &job->result->widths[i], &job->result->heights[i]);
+        }
+        if (status != CLIP_STATUS_OK && image != NULL) {
+            clip_image_f32_free(image);
+            image = NULL;
+        }
+        job->result->statuses[i] = status;
+        job->images[i] = image;
+    }
+    return NULL;
+}
+
+// Helper: decode and preprocess every path, on up to CLIP_BATCH_DECODE_THREADS threads
+static void decode_batch(BatchDecode *job)
+{
+    int threads = compute_budget_size();
+    if (threads > CLIP_BATCH_DECODE_THREADS) {
+        threads = CLIP_BATCH_DECODE_THREADS;
+    }
+    if (threads > job->count) {
+        threads = job->count;
+    }
+
+    pthread_t workers[CLIP_BATCH_DECODE_THREADS];
+    int started = 0;
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&workers[started], NULL, batch_decode_worker, job) == 0) {
+            started++;
+        }
+    }
+    batch_decode_worker(job);
+    for (int t = 0; t < started; t++) {
+        pthread_join(workers[t], NULL);
+    }
+}
+
+// Helper: embed the decoded images of a batch into result
+static void encode_batch(CLIPEngine *engine, struct clip_image_f32 **images, int count,
+                         CLIPBatchImageResult *result)
+{
+#ifdef CLIP_COREML
+    // All decoded images through Core ML in one call
+    if (engine->coreml != NULL) {
+        struct clip_image_f32 **ready = malloc((size_t)count * sizeof(*ready));
+        int *slots = malloc((size_t)count * sizeof(int));
+        float *embeddings = malloc((size_t)count * CLIP_EMBEDDING_DIMENSION * sizeof(float));
+        int n = 0;
+        if (ready != NULL && slots != NULL && embeddings != NULL) {
+            for (int i = 0; i < count; i++) {
+                if (images[i] != NULL) {
+                    ready[n] = images[i];
+                    slots[n] = i;
+                    n++;
+                }
+            }
+        }
+
+        bool done = n > 0 && encode_images_coreml(engine, ready, n, embeddings);
+        for (int k = 0; done && k < n; k++) {
+            memcpy(&result->embeddings[(size_t)slots[k] * CLIP_EMBEDDING_DIMENSION],
+                   &embeddings[(size_t)k * CLIP_EMBEDDING_DIMENSION],
+                   CLIP_EMBEDDING_DIMENSION * sizeof(float));
+            result->count++;
+        }
+        free(ready);
+        free(slots);
+        free(embeddings);
+        if (done) {
+            return;
+        }
+    }
+#endif
+
+    for (int i = 0; i < count; i++) {
+        if (images[i] == NULL) {
+            continue;
+        }
+        if (encode_image(engine, images[i], &result->embeddings[(size_t)i * CLIP_EMBEDDING_DIMENSION])) {
+            result->count++;
+        } else {
+            result->statuses[i] = CLIP_STATUS_INFERENCE_ERROR;
+        }
+    }
+}
+#endif
+
 CLIPBatchImageResult clip_embed_images_batch(CLIPEngine *engine,
                                               const char **image_paths,
                                               int count)
@@ -424,27 +764,61 @@ CLIPBatchImageResult clip_embed_images_batch(CLIPEngine *engine,
     }
 
     result.embeddings = calloc((size_t)count * CLIP_EMBEDDING_DIMENSION, sizeof(float));
-    if (result.embeddings == NULL) {
+    result.statuses = calloc((size_t)count, sizeof(CLIPStatus));
+    result.widths = calloc((size_t)count, sizeof(int));
+    result.heights = calloc((size_t)count, sizeof(int));
+    if (result.embeddings == NULL || result.statuses == NULL || result.widths == NULL || result.heights == NULL) {
+        clip_batch_result_free(&result);
         result.status = CLIP_STATUS_MEMORY_ERROR;
         return result;
     }
 
+    if (!begin_use(engine)) {
+        clip_batch_result_free(&result);
+        result.status = CLIP_STATUS_NOT_INITIALIZED;
+        return result;
+    }
+
     clock_t start = clock();
 
+#ifdef FINDER_PLUS_AI_MODELS
+    BatchDecode job = {0};
+    job.engine = engine;
+    job.paths = image_paths;
+    job.count = count;
+    atomic_init(&job.next, 0);
+    job.images = calloc((size_t)count, sizeof(*job.images));
+    job.result = &result;
+
+    if (job.images == NULL) {
+        for (int i = 0; i < count; i++) {
+            result.statuses[i] = CLIP_STATUS_MEMORY_ERROR;
+        }
+    } else {
+        decode_batch(&job);
+        encode_batch(engine, job.images, count, &result);
+        for (int i = 0; i < count; i++) {
+            if (job.images[i] != NULL) {
+                clip_image_f32_free(job.images[i]);
+            }
+        }
+        free(job.images);
+    }
+#else
     for (int i = 0; i < count; i++) {
         if (image_paths[i] == NULL || !clip_is_supported_image(image_paths[i])) {
+            result.statuses[i] = CLIP_STATUS_IMAGE_FORMAT_ERROR;
             continue;
         }
-
-        // Use single-image function for real embeddings
-        CLIPImageResult img_result = clip_embed_image(engine, image_paths[i]);
-        if (img_result.status == CLIP_STATUS_OK) {
-            memcpy(&result.embeddings[result.count * CLIP_EMBEDDING_DIMENSION],
-                   img_result.embedding,
-                   CLIP_EMBEDDING_DIMENSION * sizeof(float));
-            result.count++;
-        }
+        generate_stub_clip_embedding(hash_file_path(image_paths[i]),
+                                     &result.embeddings[(size_t)i * CLIP_EMBEDDING_DIMENSION]);
+        result.widths[i] = engine->config.image_size;
+        result.heights[i] = engine->config.image_size;
+        result.count++;
     }
+#endif
+
+    end_use(engine);
 
     clock_t end = clock();
     result.total_time_ms = ELAPSED_MS(start, end);
@@ -459,16 +833,20 @@ void clip_batch_result_free(CLIPBatchImageResult *result)
         return;
     }
 
-    if (result->embeddings != NULL) {
-        free(result->embeddings);
-        result->embeddings = NULL;
-    }
+    free(result->embeddings);
+    result->embeddings = NULL;
+    free(result->statuses);
+    result->statuses = NULL;
+    free(result->widths);
+    result->widths = NULL;
+    free(result->heights);
+    result->heights = NULL;
     result->count = 0;
 }
 
 float clip_similarity(const float *image_embedding, const float *text_embedding)
 {
-    return cosine_similarity(image_embedding, text_embedding, CLIP_EMBEDDING_DIMENSION);
+    return vector_cosine(image_embedding, text_embedding, CLIP_EMBEDDING_DIMENSION);
 }
 
 bool clip_is_supported_image(const char *path)
@@ -481,21 +859,7 @@ bool clip_is_supported_image(const char *path)
     if (ext == NULL) {
         return false;
     }
-    ext++;  // Skip the dot
-
-    // Convert to lowercase for comparison
-    char ext_lower[16] = {0};
-    for (int i = 0; i < 15 && ext[i]; i++) {
-        ext_lower[i] = (char)tolower((unsigned char)ext[i]);
-    }
-
-    for (int i = 0; SUPPORTED_EXTENSIONS[i] != NULL; i++) {
-        if (strcmp(ext_lower, SUPPORTED_EXTENSIONS[i]) == 0) {
-            return true;
-        }
-    }
-
-    return false;
+    return file_type_has_trait(file_type_from_extension(ext), FILE_TRAIT_RASTER);
 }
 
 const char* clip_status_message(CLIPStatus status)
@@ -50,10 +50,13 @@ typedef struct CLIPTextResult {
     float inference_time_ms;
 } CLIPTextResult;
 
-// Batch image embedding result
+// Batch image embedding result; entry i belongs to the i-th path
 typedef struct CLIPBatchImageResult {
-    float *embeddings;          // Array of embeddings
-    int count;
+    float *embeddings;          // One embedding per path (valid where statuses[i] is OK)
+    CLIPStatus *statuses;       // Per path
+    int *widths;                // Original image size per path
+    int *heights;
+    int count;                  // Paths embedded successfully
     CLIPStatus status;
     float total_time_ms;
 } CLIPBatchImageResult;
@@ -70,12 +73,23 @@ void clip_engine_destroy(CLIPEngine *engine);
 // Load CLIP model
 CLIPStatus clip_engine_load_model(CLIPEngine *engine, const char *model_path);
 
+// Remember a CLIP model to load on first use instead of loading it now (fails only if
+// the file is missing). Such a model may be trimmed when idle and loads again when needed
+CLIPStatus clip_engine_load_model_lazily(CLIPEngine *engine, const char *model_path);
+
 // Unload CLIP model
 void clip_engine_unload_model(CLIPEngine *engine);
 
+// Unload a lazily loaded model unused for idle_sec; returns whether it was unloaded.
+// An engine busy with inference is skipped
+bool clip_engine_trim(CLIPEngine *engine, double idle_sec);
+
 // Check if model is loaded
 bool clip_engine_is_loaded(const CLIPEngine *engine);
 
+// Check if embeddings can be generated (model loaded, or loads on first use)
+bool clip_engine_is_available(const CLIPEngine *engine);
+
 // Generate embedding for an image file
 CLIPImageResult clip_embed_image(CLIPEngine *engine, const char *image_path);
 
@@ -89,7 +103,8 @@ CLIPImageResult clip_embed_image_data(CLIPEngine *engine,
 // Generate embedding for text query
 CLIPTextResult clip_embed_text(CLIPEngine *engine, const char *text);
 
-// Batch embed images
+// Batch embed images: decode and preprocess them on several threads, then run the model
+// once for the batch (Core ML) or image after image (CPU)
 CLIPBatchImageResult clip_embed_images_batch(CLIPEngine *engine,
                                               const char **image_paths,
                                               int count);
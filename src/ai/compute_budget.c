@@ -0,0 +1,51 @@
+#include "compute_budget.h"
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+static pthread_once_t g_size_once = PTHREAD_ONCE_INIT;
+static int g_size = 1;
+static atomic_int g_in_use = 0;
+
+static void init_size(void)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    g_size = cores > 0 ? (int)cores : 1;
+}
+
+int compute_budget_size(void)
+{
+    pthread_once(&g_size_once, init_size);
+    return g_size;
+}
+
+int compute_budget_acquire(int wanted)
+{
+    int size = compute_budget_size();
+    if (wanted < 1) {
+        wanted = 1;
+    }
+
+    int in_use = atomic_load(&g_in_use);
+    int granted;
+    do {
+        int available = size - in_use;
+        granted = wanted < available ? wanted : available;
+        if (granted < 1) {
+            granted = 1;
+        }
+    } while (!atomic_compare_exchange_weak(&g_in_use, &in_use, in_use + granted));
+    return granted;
+}
+
+void compute_budget_release(int threads)
+{
+    if (threads > 0) {
+        atomic_fetch_sub(&g_in_use, threads);
+    }
+}
+
+int compute_budget_in_use(void)
+{
+    return atomic_load(&g_in_use);
+}
@@ -0,0 +1,22 @@
+#ifndef COMPUTE_BUDGET_H
+#define COMPUTE_BUDGET_H
+
+// One process-wide budget of CPU inference threads, shared by the embedding and CLIP
+// engines. Each links its own ggml, which starts a fresh set of threads per graph, so
+// without a common budget text and image inference running together would put twice
+// the machine's cores to work and slow both
+
+// Threads in the budget (the online core count)
+int compute_budget_size(void);
+
+// Take up to wanted threads for one inference. Grants at least one even when the budget
+// is spent, so callers never wait; pair with compute_budget_release
+int compute_budget_acquire(int wanted);
+
+// Return threads taken by compute_budget_acquire
+void compute_budget_release(int threads);
+
+// Threads currently taken
+int compute_budget_in_use(void);
+
+#endif // COMPUTE_BUDGET_H
@@ -0,0 +1,456 @@
+#include "content_extract.h"
+#include "../utils/file_hash.h"
+#include "extract_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Bytes sniffed for binary content
+#define CONTENT_SNIFF_BYTES 4096
+
+// Reading a page of a mapped file that has since been truncated raises SIGBUS. While a
+// thread reads a mapping it points this at a jump buffer, and the handler unwinds there
+static __thread sigjmp_buf *t_fault_jump = NULL;
+static struct sigaction g_previous_sigbus;
+static pthread_once_t g_fault_once = PTHREAD_ONCE_INIT;
+
+static void fault_handler(int sig, siginfo_t *info, void *context)
+{
+    (void)info;
+    (void)context;
+
+    if (t_fault_jump != NULL) {
+        siglongjmp(*t_fault_jump, 1);
+    }
+
+    // Not one of our reads: put the previous handler back and let the access fault again
+    sigaction(sig, &g_previous_sigbus, NULL);
+}
+
+static void install_fault_handler(void)
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = fault_handler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGBUS, &action, &g_previous_sigbus);
+}
+
+// Helper: whether c continues a UTF-8 sequence
+static bool utf8_continuation(char c)
+{
+    return ((unsigned char)c & 0xC0) == 0x80;
+}
+
+// Helper: end of the line starting at pos (index of '\n', or size)
+static size_t line_end(const char *data, size_t size, size_t pos)
+{
+    const char *newline = memchr(data + pos, '\n', size - pos);
+    return newline ? (size_t)(newline - data) : size;
+}
+
+static bool line_blank(const char *data, size_t start, size_t end)
+{
+    for (size_t i = start; i < end; i++) {
+        if (!isspace((unsigned char)data[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Helper: copy a line into title, without the markers skipped in front or a trailing brace
+static void set_title(char *title, const char *data, size_t start, size_t end, const char *skip)
+{
+    while (start < end && (strchr(skip, data[start]) != NULL || isspace((unsigned char)data[start]))) {
+        start++;
+    }
+    while (end > start && (isspace((unsigned char)data[end - 1]) || data[end - 1] == '{')) {
+        end--;
+    }
+
+    size_t length = end - start;
+    if (length > CONTENT_TITLE_SIZE - 1) {
+        length = CONTENT_TITLE_SIZE - 1;
+        while (length > 0 && utf8_continuation(data[start + length])) {
+            length--;
+        }
+    }
+    memcpy(title, data + start, length);
+    title[length] = '\0';
+}
+
+// Sections are packed into chunks as they are found
+typedef struct Splitter {
+    const char *data;
+    ContentChunk *chunks;
+    int max_chunks;
+    int count;
+    size_t pending_start;       // Small sections gathered into one chunk
+    size_t pending_end;
+    char pending_title[CONTENT_TITLE_SIZE];
+    bool has_pending;
+} Splitter;
+
+static void add_chunk(Splitter *splitter, size_t start, size_t end, const char *title)
+{
+    if (splitter->count >= splitter->max_chunks || end <= start) {
+        return;
+    }
+    ContentChunk *chunk = &splitter->chunks[splitter->count++];
+    chunk->offset = start;
+    chunk->length = end - start;
+    snprintf(chunk->title, sizeof(chunk->title), "%s", title);
+}
+
+static void flush_pending(Splitter *splitter)
+{
+    if (splitter->has_pending) {
+        add_chunk(splitter, splitter->pending_start, splitter->pending_end, splitter->pending_title);
+        splitter->has_pending = false;
+    }
+}
+
+// Helper: cut a long section into overlapping windows, at line breaks where possible
+static void add_windows(Splitter *splitter, size_t start, size_t end, const char *title)
+{
+    const char *data = splitter->data;
+    size_t pos = start;
+    while (pos < end && splitter->count < splitter->max_chunks) {
+        if (end - pos <= CONTENT_CHUNK_MAX) {
+            add_chunk(splitter, pos, end, title);
+            return;
+        }
+
+        size_t cut = pos + CONTENT_CHUNK_MAX;
+        size_t lowest = pos + CONTENT_CHUNK_MAX / 2;
+        size_t best = cut;
+        for (size_t i = cut; i > lowest; i--) {
+            if (data[i - 1] == '\n') {
+                best = i;
+                break;
+            }
+            if (best == cut && data[i - 1] == ' ') {
+                best = i;   // Keep looking for a line break, settle for a space
+            }
+        }
+        cut = best;
+        while (cut > pos + 1 && utf8_continuation(data[cut])) {
+            cut--;
+        }
+        add_chunk(splitter, pos, cut, title);
+
+        size_t next = cut - pos > CONTENT_CHUNK_OVERLAP ? cut - CONTENT_CHUNK_OVERLAP : cut;
+        while (next < cut && utf8_continuation(data[next])) {
+            next++;
+        }
+        pos = next;
+    }
+}
+
+// Helper: a section [start, end) was found; pack it with its neighbours if small
+static void add_section(Splitter *splitter, size_t start, size_t end, const char *title)
+{
+    if (end <= start) {
+        return;
+    }
+
+    if (splitter->has_pending && end - splitter->pending_start <= CONTENT_CHUNK_TARGET) {
+        splitter->pending_end = end;
+        return;
+    }
+    flush_pending(splitter);
+
+    if (end - start > CONTENT_CHUNK_MAX) {
+        add_windows(splitter, start, end, title);
+        return;
+    }
+    splitter->pending_start = start;
+    splitter->pending_end = end;
+    snprintf(splitter->pending_title, sizeof(splitter->pending_title), "%s", title);
+    splitter->has_pending = true;
+}
+
+static bool markdown_heading(const char *data, size_t start, size_t end)
+{
+    size_t level = 0;
+    while (start + level < end && data[start + level] == '#') {
+        level++;
+    }
+    return level >= 1 && level <= 6 && start + level < end &&
+           (data[start + level] == ' ' || data[start + level] == '\t');
+}
+
+static bool comment_line(const char *data, size_t start, size_t end)
+{
+    while (start < end && (data[start] == ' ' || data[start] == '\t')) {
+        start++;
+    }
+    if (start >= end) {
+        return false;
+    }
+    char c = data[start];
+    char next = start + 1 < end ? data[start + 1] : '\0';
+    return (c == '/' && (next == '/' || next == '*')) || c == '*' || c == '#' ||
+           (c == '-' && next == '-');
+}
+
+// Top-level definitions start at column 0 after a blank line, a closing brace, or
+// the comment block that documents them
+static bool code_definition_start(char c)
+{
+    return isalpha((unsigned char)c) || c == '_' || c == '@';
+}
+
+typedef enum LineKind {
+    LINE_START = 0,             // Before the first line
+    LINE_BLANK,
+    LINE_CLOSE,                 // "}" or "end" at column 0
+    LINE_COMMENT,
+    LINE_OTHER
+} LineKind;
+
+int content_split(const char *data, size_t size, ContentFormat format, ContentChunk *chunks, int max_chunks)
+{
+    if (data == NULL || chunks == NULL || max_chunks <= 0 || size == 0) {
+        return 0;
+    }
+
+    Splitter splitter = { .data = data, .chunks = chunks, .max_chunks = max_chunks };
+
+    // Skip a UTF-8 byte order mark
+    size_t section_start = size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0 ? 3 : 0;
+    char title[CONTENT_TITLE_SIZE] = "";
+
+    LineKind previous = LINE_START;
+    size_t comment_start = 0;
+    bool comment_detached = false;  // Comment block follows a blank line or closing brace
+    bool in_fence = false;
+
+    for (size_t pos = section_start; pos < size && splitter.count < max_chunks;) {
+        size_t end = line_end(data, size, pos);
+        size_t boundary = SIZE_MAX;
+        const char *skip = "";
+
+        if (line_blank(data, pos, end)) {
+            previous = LINE_BLANK;
+        } else if (format == CONTENT_FORMAT_MARKDOWN) {
+            if (end - pos >= 3 && (memcmp(data + pos, "```", 3) == 0 || memcmp(data + pos, "~~~", 3) == 0)) {
+                in_fence = !in_fence;
+            } else if (!in_fence && markdown_heading(data, pos, end)) {
+                boundary = pos;
+                skip = "#";
+            }
+            previous = LINE_OTHER;
+        } else if (format == CONTENT_FORMAT_CODE) {
+            bool after_break = previous == LINE_START || previous == LINE_BLANK || previous == LINE_CLOSE;
+            if (comment_line(data, pos, end)) {
+                if (previous != LINE_COMMENT) {
+                    comment_start = pos;
+                    comment_detached = after_break;
+                }
+                previous = LINE_COMMENT;
+            } else {
+                if (code_definition_start(data[pos]) &&
+                    (after_break || (previous == LINE_COMMENT && comment_detached))) {
+                    boundary = previous == LINE_COMMENT ? comment_start : pos;
+                }
+                bool close = data[pos] == '}' || (end - pos >= 3 && memcmp(data + pos, "end", 3) == 0 &&
+                                                  line_blank(data, pos + 3, end));
+                previous = close ? LINE_CLOSE : LINE_OTHER;
+            }
+        } else {
+            if (previous == LINE_BLANK) {
+                boundary = pos;
+            }
+            previous = LINE_OTHER;
+        }
+
+        if (boundary != SIZE_MAX) {
+            add_section(&splitter, section_start, boundary, title);
+            section_start = boundary;
+            if (format == CONTENT_FORMAT_PLAIN) {
+                title[0] = '\0';
+            } else {
+                set_title(title, data, pos, end, skip);
+            }
+        }
+        pos = end < size ? end + 1 : size;
+    }
+
+    add_section(&splitter, section_start, size, title);
+    flush_pending(&splitter);
+    return splitter.count;
+}
+
+ContentFormat content_format_for_file(const char *extension, bool is_code)
+{
+    if (is_code) {
+        return CONTENT_FORMAT_CODE;
+    }
+    if (extension != NULL && (strcasecmp(extension, "md") == 0 ||
+                              strcasecmp(extension, "markdown") == 0 ||
+                              strcasecmp(extension, "mdx") == 0)) {
+        return CONTENT_FORMAT_MARKDOWN;
+    }
+    return CONTENT_FORMAT_PLAIN;
+}
+
+bool content_is_text(const char *data, size_t size)
+{
+    if (data == NULL) {
+        return false;
+    }
+
+    size_t sniff = size < CONTENT_SNIFF_BYTES ? size : CONTENT_SNIFF_BYTES;
+    size_t control = 0;
+    for (size_t i = 0; i < sniff; i++) {
+        unsigned char c = (unsigned char)data[i];
+        if (c == 0) {
+            return false;
+        }
+        if (c < 0x20 && c != '\t' && c != '\n' && c != '\r' && c != '\f' && c != '\v' &&
+            c != '\b' && c != 0x1B) {
+            control++;
+        }
+    }
+    return control * 10 <= sniff;
+}
+
+bool content_map_open(const char *path, ContentMap *map)
+{
+    if (path == NULL || map == NULL) {
+        return false;
+    }
+    map->data = NULL;
+    map->size = 0;
+    map->owned = false;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    map->data = data;
+    map->size = (size_t)st.st_size;
+    return true;
+}
+
+bool content_map_open_document(const char *path, ContentMap *map)
+{
+    if (path == NULL || map == NULL) {
+        return false;
+    }
+    map->data = NULL;
+    map->size = 0;
+    map->owned = false;
+
+    char *text = NULL;
+    size_t length = 0;
+    if (!extract_pool_text(path, CONTENT_DOCUMENT_TEXT_MAX, &text, &length)) {
+        return false;
+    }
+    map->data = text;
+    map->size = length;
+    map->owned = true;
+    return true;
+}
+
+void content_map_close(ContentMap *map)
+{
+    if (map == NULL || map->data == NULL) {
+        return;
+    }
+    if (map->owned) {
+        free((void *)map->data);
+    } else {
+        munmap((void *)map->data, map->size);
+    }
+    map->data = NULL;
+    map->size = 0;
+}
+
+int content_map_split(const ContentMap *map, ContentFormat format, ContentChunk *chunks, int max_chunks)
+{
+    if (map == NULL || map->data == NULL) {
+        return -1;
+    }
+
+    pthread_once(&g_fault_once, install_fault_handler);
+
+    sigjmp_buf jump;
+    volatile int count = -1;
+    if (sigsetjmp(jump, 1) == 0) {
+        t_fault_jump = &jump;
+        if (content_is_text(map->data, map->size)) {
+            count = content_split(map->data, map->size, format, chunks, max_chunks);
+        }
+    }
+    t_fault_jump = NULL;
+    return count;
+}
+
+bool content_map_hash(const ContentMap *map, uint64_t *hash)
+{
+    if (map == NULL || map->data == NULL || hash == NULL) {
+        return false;
+    }
+
+    pthread_once(&g_fault_once, install_fault_handler);
+
+    sigjmp_buf jump;
+    volatile bool ok = false;
+    if (sigsetjmp(jump, 1) == 0) {
+        t_fault_jump = &jump;
+        *hash = file_hash_bytes(map->data, map->size, 0);
+        ok = true;
+    }
+    t_fault_jump = NULL;
+    return ok;
+}
+
+bool content_map_copy(const ContentMap *map, const ContentChunk *chunk, char *out, size_t out_size)
+{
+    if (map == NULL || map->data == NULL || chunk == NULL || out == NULL || out_size == 0 ||
+        chunk->offset > map->size || chunk->length > map->size - chunk->offset) {
+        return false;
+    }
+
+    pthread_once(&g_fault_once, install_fault_handler);
+
+    size_t length = chunk->length < out_size - 1 ? chunk->length : out_size - 1;
+    sigjmp_buf jump;
+    volatile bool ok = false;
+    if (sigsetjmp(jump, 1) == 0) {
+        t_fault_jump = &jump;
+        memcpy(out, map->data + chunk->offset, length);
+        ok = true;
+    }
+    t_fault_jump = NULL;
+
+    out[ok ? length : 0] = '\0';
+    return ok;
+}
@@ -0,0 +1,83 @@
+#ifndef CONTENT_EXTRACT_H
+#define CONTENT_EXTRACT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Text extraction for the indexer. Files are memory-mapped instead of read into heap
+// buffers, sniffed for binary content, and split into sections (markdown headings,
+// top-level code definitions, paragraphs) that are embedded one by one, so a match deep
+// in a long document is found by its own section rather than lost past the first page
+
+// Sections aim for this many bytes (about what the embedding model reads) ...
+#define CONTENT_CHUNK_TARGET 1536
+
+// ... and longer ones are cut into windows of at most this many bytes
+#define CONTENT_CHUNK_MAX 2048
+
+// Bytes shared by consecutive windows of a cut section
+#define CONTENT_CHUNK_OVERLAP 256
+
+// Sections per file; text past the last one is not indexed
+#define CONTENT_MAX_CHUNKS 64
+
+// Text taken from a document: about what CONTENT_MAX_CHUNKS sections hold
+#define CONTENT_DOCUMENT_TEXT_MAX (CONTENT_MAX_CHUNKS * CONTENT_CHUNK_MAX)
+
+// Section title buffer size (heading or definition line)
+#define CONTENT_TITLE_SIZE 128
+
+typedef enum ContentFormat {
+    CONTENT_FORMAT_PLAIN = 0,           // Paragraphs
+    CONTENT_FORMAT_MARKDOWN,            // Headings
+    CONTENT_FORMAT_CODE                 // Top-level definitions
+} ContentFormat;
+
+// One section of a file
+typedef struct ContentChunk {
+    size_t offset;
+    size_t length;
+    char title[CONTENT_TITLE_SIZE];     // "" for plain text
+} ContentChunk;
+
+// Read-only mapping of a whole file, or the text taken from a document
+typedef struct ContentMap {
+    const char *data;
+    size_t size;
+    bool owned;                         // data is malloc'd text, not a mapping
+} ContentMap;
+
+// Format to split a file in: code files by definition, markdown by heading
+ContentFormat content_format_for_file(const char *extension, bool is_code);
+
+// Whether data looks like text (no NUL bytes, few control characters in the first 4 KB)
+bool content_is_text(const char *data, size_t size);
+
+// Split text into at most max_chunks sections; returns how many
+int content_split(const char *data, size_t size, ContentFormat format, ContentChunk *chunks, int max_chunks);
+
+// Map a file for reading (false if it cannot be opened or is empty)
+bool content_map_open(const char *path, ContentMap *map);
+
+// Take the text of a document the extractor pool reads (at most CONTENT_DOCUMENT_TEXT_MAX
+// bytes; a PDF's pages separated by form feeds) in place of a mapping; false if it has
+// none. See extract_pool.h
+bool content_map_open_document(const char *path, ContentMap *map);
+
+// Unmap a file mapped by content_map_open, or free the text of content_map_open_document
+void content_map_close(ContentMap *map);
+
+// The following read the mapping and fail, instead of crashing, if the file is
+// truncated underneath them
+
+// Split a mapped file; returns how many sections, or -1 if it is binary or was truncated
+int content_map_split(const ContentMap *map, ContentFormat format, ContentChunk *chunks, int max_chunks);
+
+// XXH64 of a mapped file (same value as file_hash_compute)
+bool content_map_hash(const ContentMap *map, uint64_t *hash);
+
+// Copy one section into out, NUL-terminated and truncated to fit
+bool content_map_copy(const ContentMap *map, const ContentChunk *chunk, char *out, size_t out_size);
+
+#endif // CONTENT_EXTRACT_H
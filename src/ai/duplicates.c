@@ -1,7 +1,14 @@
 #include "duplicates.h"
 #include "embeddings.h"
 #include "ai_common.h"
-#include "../platform/trash.h"
+#include "vector_ops.h"
+#include "vector_index.h"
+#include "../core/operations.h"
+#include "../core/stat_cache.h"
+#include "../core/undo_log.h"
+#include "../utils/file_hash.h"
+#include "../utils/file_type.h"
+#include "../utils/exclude_set.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,6 +16,28 @@
 #include <sys/stat.h>
 #include <CommonCrypto/CommonDigest.h>
 #include <time.h>
+#include <math.h>
+#include "raylib.h"
+
+#ifdef __APPLE__
+#include "../platform/imageio.h"
+#endif
+
+// Bytes hashed at each end of a file before it is worth hashing in full
+#define DUPLICATES_PARTIAL_BYTES (64 * 1024)
+
+// Files handed to the hashing pool between progress reports and cancel checks
+#define DUPLICATES_HASH_CHUNK 256
+
+// Images are reduced to this size before the DCT; the hash keeps the lowest 8x8 frequencies
+#define PHASH_SAMPLE_SIZE 32
+#define PHASH_FREQUENCIES 8
+
+// Text files embedded per inference call
+#define DUPLICATES_EMBED_BATCH 16
+
+// Nearest neighbours fetched per text file at first; doubled while they all match
+#define DUPLICATES_TEXT_NEIGHBORS 16
 
 // Internal file list for scanning
 typedef struct FileList {
@@ -17,6 +46,16 @@ typedef struct FileList {
     int capacity;
 } FileList;
 
+// File that may have an exact duplicate
+typedef struct ExactCandidate {
+    DuplicateFileInfo *file;
+    uint64_t partial;                   // Fast hash of head and tail (of everything when small)
+    uint64_t full;                      // Fast hash of everything
+    uint8_t sha256[HASH_SIZE_SHA256];   // Final verification
+    uint32_t known;                     // HASH_CACHE_HAS_* for the hashes above (md5 lives in file)
+    bool fresh;                         // Hashed this scan, not yet written to the cache
+} ExactCandidate;
+
 // Initialize configuration with defaults
 void duplicate_config_init(DuplicateConfig *config)
 {
@@ -31,6 +70,9 @@ void duplicate_config_init(DuplicateConfig *config)
     config->recursive = true;
     config->exclude_patterns = NULL;
     config->exclude_count = 0;
+    config->hash_cache = NULL;
+    config->embedding_engine = NULL;
+    config->vectordb = NULL;
     config->cancelled = false;
 }
 
@@ -117,29 +159,124 @@ bool hash_file_sha256(const char *path, uint8_t *hash_out)
     return true;
 }
 
+// Helper: MD5 and SHA256 of a whole file in one read
+static bool hash_file_full(const char *path, uint8_t *md5_out, uint8_t *sha256_out)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+
+    CC_MD5_CTX md5;
+    CC_SHA256_CTX sha256;
+    CC_MD5_Init(&md5);
+    CC_SHA256_Init(&sha256);
+
+    unsigned char buffer[65536];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        CC_MD5_Update(&md5, buffer, (CC_LONG)bytes);
+        CC_SHA256_Update(&sha256, buffer, (CC_LONG)bytes);
+    }
+
+    bool ok = !ferror(file);
+    fclose(file);
+    CC_MD5_Final(md5_out, &md5);
+    CC_SHA256_Final(sha256_out, &sha256);
+    return ok;
+}
+
 // Simple perceptual hash for images using average hash algorithm
 // This is a simplified version - in production, use a proper image library
 bool hash_image_perceptual(const char *path, uint8_t *hash_out)
 {
     if (!path || !hash_out) return false;
 
-    // Check if it's an image by extension
-    const char *ext = strrchr(path, '.');
-    if (!ext) return false;
+#ifdef __APPLE__
+    // ImageIO decodes at a few times the sample size (from the embedded preview of a RAW
+    // or HEIC file), far cheaper than the full image; other formats fall back below
+    unsigned char *rgb = NULL;
+    int w = 0;
+    int h = 0;
+    Image image = { 0 };
+    if (platform_load_image_scaled(path, PHASH_SAMPLE_SIZE * 4, &rgb, &w, &h, NULL, NULL)) {
+        image = (Image){ .data = rgb, .width = w, .height = h, .mipmaps = 1,
+                         .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8 };
+    } else {
+        image = LoadImage(path);
+    }
+#else
+    Image image = LoadImage(path);
+#endif
+    if (!image.data) return false;
+
+    // Plain 8-bit formats resize without a float copy of the full-size image
+    if (image.format != PIXELFORMAT_UNCOMPRESSED_GRAYSCALE &&
+        image.format != PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA &&
+        image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8 &&
+        image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) {
+        ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    }
+    ImageResize(&image, PHASH_SAMPLE_SIZE, PHASH_SAMPLE_SIZE);
+
+    Color *colors = LoadImageColors(image);
+    UnloadImage(image);
+    if (!colors) return false;
+
+    float luma[PHASH_SAMPLE_SIZE][PHASH_SAMPLE_SIZE];
+    for (int y = 0; y < PHASH_SAMPLE_SIZE; y++) {
+        for (int x = 0; x < PHASH_SAMPLE_SIZE; x++) {
+            Color c = colors[y * PHASH_SAMPLE_SIZE + x];
+            luma[y][x] = 0.299f * c.r + 0.587f * c.g + 0.114f * c.b;
+        }
+    }
+    UnloadImageColors(colors);
 
-    // For now, use file content hash as a fallback
-    // In a real implementation, we would:
-    // 1. Load the image
-    // 2. Resize to 8x8
-    // 3. Convert to grayscale
-    // 4. Calculate average pixel value
-    // 5. Generate hash based on above/below average
+    // Separable DCT-II, only for the low frequencies the hash keeps
+    float basis[PHASH_FREQUENCIES][PHASH_SAMPLE_SIZE];
+    for (int u = 0; u < PHASH_FREQUENCIES; u++) {
+        for (int x = 0; x < PHASH_SAMPLE_SIZE; x++) {
+            basis[u][x] = cosf((float)M_PI * (2 * x + 1) * u / (2.0f * PHASH_SAMPLE_SIZE));
+        }
+    }
+    float rows[PHASH_SAMPLE_SIZE][PHASH_FREQUENCIES];
+    for (int y = 0; y < PHASH_SAMPLE_SIZE; y++) {
+        for (int u = 0; u < PHASH_FREQUENCIES; u++) {
+            float sum = 0.0f;
+            for (int x = 0; x < PHASH_SAMPLE_SIZE; x++) sum += luma[y][x] * basis[u][x];
+            rows[y][u] = sum;
+        }
+    }
+    float dct[PHASH_FREQUENCIES * PHASH_FREQUENCIES];
+    for (int v = 0; v < PHASH_FREQUENCIES; v++) {
+        for (int u = 0; u < PHASH_FREQUENCIES; u++) {
+            float sum = 0.0f;
+            for (int y = 0; y < PHASH_SAMPLE_SIZE; y++) sum += rows[y][u] * basis[v][y];
+            dct[v * PHASH_FREQUENCIES + u] = sum;
+        }
+    }
 
-    // Simplified: use first 8 bytes of MD5 hash
-    uint8_t md5[HASH_SIZE_MD5];
-    if (!hash_file_md5(path, md5)) return false;
+    // One bit per AC coefficient, set when it is above their median. The DC term
+    // is overall brightness and left out, so exposure changes barely move the hash
+    float sorted[PHASH_FREQUENCIES * PHASH_FREQUENCIES - 1];
+    memcpy(sorted, dct + 1, sizeof(sorted));
+    int n = (int)(sizeof(sorted) / sizeof(sorted[0]));
+    for (int i = 1; i < n; i++) {
+        float value = sorted[i];
+        int j = i - 1;
+        while (j >= 0 && sorted[j] > value) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = value;
+    }
+    float median = sorted[n / 2];
 
-    memcpy(hash_out, md5, HASH_SIZE_PERCEPTUAL);
+    uint64_t bits = 0;
+    for (int i = 1; i < PHASH_FREQUENCIES * PHASH_FREQUENCIES; i++) {
+        if (dct[i] > median) bits |= 1ULL << i;
+    }
+    for (int i = 0; i < HASH_SIZE_PERCEPTUAL; i++) {
+        hash_out[i] = (uint8_t)(bits >> (8 * i));
+    }
     return true;
 }
 
@@ -150,11 +287,7 @@ int hash_hamming_distance(const uint8_t *hash1, const uint8_t *hash2, size_t len
 
     int distance = 0;
     for (size_t i = 0; i < len; i++) {
-        uint8_t xor_val = hash1[i] ^ hash2[i];
-        while (xor_val) {
-            distance += xor_val & 1;
-            xor_val >>= 1;
-        }
+        distance += __builtin_popcount((unsigned)(hash1[i] ^ hash2[i]));
     }
     return distance;
 }
@@ -165,7 +298,7 @@ bool files_are_identical(const char *path1, const char *path2)
     if (!path1 || !path2) return false;
 
     struct stat st1, st2;
-    if (stat(path1, &st1) != 0 || stat(path2, &st2) != 0) return false;
+    if (!stat_cache_stat(path1, &st1) || !stat_cache_stat(path2, &st2)) return false;
 
     // Different sizes = not identical
     if (st1.st_size != st2.st_size) return false;
@@ -206,43 +339,35 @@ void hash_to_hex(const uint8_t *hash, size_t len, char *hex_out)
     hex_out[len * 2] = '\0';
 }
 
-// Check if file should be excluded
-static bool should_exclude(const char *path, const DuplicateConfig *config)
+// Compile the exclude patterns once per scan; false when out of memory
+static bool compile_excludes(const DuplicateConfig *config, ExcludeSet **out)
 {
-    if (!config->exclude_patterns || config->exclude_count == 0) return false;
+    *out = NULL;
+    if (!config->exclude_patterns || config->exclude_count == 0) return true;
 
+    ExcludeSet *set = exclude_set_create();
+    if (!set) return false;
     for (int i = 0; i < config->exclude_count; i++) {
-        if (strstr(path, config->exclude_patterns[i])) {
-            return true;
+        if (config->exclude_patterns[i] && config->exclude_patterns[i][0] &&
+            !exclude_set_add(set, config->exclude_patterns[i])) {
+            exclude_set_destroy(set);
+            return false;
         }
     }
-    return false;
+    *out = set;
+    return true;
 }
 
-// Check if file is an image
+// Check if file is an image the platform decoder reads
 static bool is_image_file(const char *path)
 {
-    const char *ext = strrchr(path, '.');
-    if (!ext) return false;
-
-    const char *image_exts[] = {".jpg", ".jpeg", ".png", ".gif", ".bmp", ".webp", ".tiff", ".tif", NULL};
-    for (int i = 0; image_exts[i]; i++) {
-        if (strcasecmp(ext, image_exts[i]) == 0) return true;
-    }
-    return false;
+    return file_type_has_trait(file_type_from_path(path), FILE_TRAIT_RASTER);
 }
 
 // Check if file is a text file
 static bool is_text_file(const char *path)
 {
-    const char *ext = strrchr(path, '.');
-    if (!ext) return false;
-
-    const char *text_exts[] = {".txt", ".md", ".c", ".h", ".py", ".js", ".json", ".xml", ".html", ".css", ".yml", ".yaml", NULL};
-    for (int i = 0; text_exts[i]; i++) {
-        if (strcasecmp(ext, text_exts[i]) == 0) return true;
-    }
-    return false;
+    return file_type_is_text(file_type_from_path(path));
 }
 
 // Add file to list
@@ -262,6 +387,8 @@ static bool file_list_add(FileList *list, const char *path, const struct stat *s
     info->size = st->st_size;
     info->modified = st->st_mtime;
     info->accessed = st->st_atime;
+    info->device = (uint64_t)st->st_dev;
+    info->inode = (uint64_t)st->st_ino;
 
     list->count++;
     return true;
@@ -270,6 +397,7 @@ static bool file_list_add(FileList *list, const char *path, const struct stat *s
 // Recursively scan directory and collect files
 static DuplicateStatus scan_directory_recursive(const char *path,
                                                   const DuplicateConfig *config,
+                                                  const ExcludeSet *excludes,
                                                   FileList *list,
                                                   DuplicateProgressCallback progress,
                                                   void *user_data)
@@ -281,6 +409,7 @@ static DuplicateStatus scan_directory_recursive(const char *path,
 
     struct dirent *entry;
     char full_path[1024];
+    size_t path_len = strlen(path);
 
     while ((entry = readdir(dir)) != NULL) {
         if (config->cancelled) {
@@ -294,11 +423,12 @@ static DuplicateStatus scan_directory_recursive(const char *path,
         // Build full path
         snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
 
-        // Check exclusions
-        if (should_exclude(full_path, config)) continue;
+        // Check exclusions; the folders above passed already, so only the name is
+        // tested, and an excluded folder is never entered
+        if (exclude_set_match(excludes, full_path, path_len)) continue;
 
         struct stat st;
-        if (lstat(full_path, &st) != 0) continue;
+        if (!stat_cache_lstat(full_path, &st)) continue;
 
         // Skip symlinks
         if (S_ISLNK(st.st_mode)) continue;
@@ -306,7 +436,7 @@ static DuplicateStatus scan_directory_recursive(const char *path,
         if (S_ISDIR(st.st_mode)) {
             // Recurse into directory
             if (config->recursive) {
-                DuplicateStatus status = scan_directory_recursive(full_path, config, list, progress, user_data);
+                DuplicateStatus status = scan_directory_recursive(full_path, config, excludes, list, progress, user_data);
                 if (status != DUP_STATUS_OK) {
                     closedir(dir);
                     return status;
@@ -316,12 +446,6 @@ static DuplicateStatus scan_directory_recursive(const char *path,
             // Check size constraints
             if (st.st_size < config->min_file_size || st.st_size > config->max_file_size) continue;
 
-            // Check file count limit
-            if (list->count >= DUPLICATES_MAX_FILES) {
-                closedir(dir);
-                return DUP_STATUS_TOO_MANY_FILES;
-            }
-
             // Add file to list
             if (!file_list_add(list, full_path, &st)) {
                 closedir(dir);
@@ -374,69 +498,351 @@ static DuplicateGroup *add_group(DuplicateAnalysis *analysis, DuplicateType type
     return group;
 }
 
-// Find exact duplicates by hash
+// Candidate orderings: each one groups the files that are still possible duplicates
+static int compare_candidates_by_size(const void *a, const void *b)
+{
+    uint64_t size_a = ((const ExactCandidate *)a)->file->size;
+    uint64_t size_b = ((const ExactCandidate *)b)->file->size;
+    return (size_a > size_b) - (size_a < size_b);
+}
+
+static int compare_candidates_by_partial(const void *a, const void *b)
+{
+    int by_size = compare_candidates_by_size(a, b);
+    if (by_size != 0) return by_size;
+    uint64_t hash_a = ((const ExactCandidate *)a)->partial;
+    uint64_t hash_b = ((const ExactCandidate *)b)->partial;
+    return (hash_a > hash_b) - (hash_a < hash_b);
+}
+
+static int compare_candidates_by_full(const void *a, const void *b)
+{
+    int by_size = compare_candidates_by_size(a, b);
+    if (by_size != 0) return by_size;
+    uint64_t hash_a = ((const ExactCandidate *)a)->full;
+    uint64_t hash_b = ((const ExactCandidate *)b)->full;
+    return (hash_a > hash_b) - (hash_a < hash_b);
+}
+
+static int compare_candidates_by_sha256(const void *a, const void *b)
+{
+    int by_size = compare_candidates_by_size(a, b);
+    if (by_size != 0) return by_size;
+    return memcmp(((const ExactCandidate *)a)->sha256, ((const ExactCandidate *)b)->sha256, HASH_SIZE_SHA256);
+}
+
+// Helper: sort candidates and keep only those with at least one equal neighbour
+static int keep_matching_runs(ExactCandidate *candidates, int count,
+                              int (*compare)(const void *, const void *))
+{
+    qsort(candidates, (size_t)count, sizeof(ExactCandidate), compare);
+
+    int kept = 0;
+    for (int start = 0; start < count; ) {
+        int end = start + 1;
+        while (end < count && compare(&candidates[start], &candidates[end]) == 0) end++;
+        if (end - start > 1) {
+            memmove(&candidates[kept], &candidates[start], (size_t)(end - start) * sizeof(ExactCandidate));
+            kept += end - start;
+        }
+        start = end;
+    }
+    return kept;
+}
+
+// Helper: whether a file is small enough that its partial hash covers all of it
+static bool hashed_whole(const DuplicateFileInfo *file, uint64_t partial_bytes)
+{
+    return partial_bytes == 0 || file->size <= 2 * partial_bytes;
+}
+
+// Helper: fill in the hashes the cache already has for unchanged files
+static void load_cached_hashes(ExactCandidate *candidates, int count, const DuplicateConfig *config)
+{
+    if (!config->hash_cache) return;
+
+    HashCacheRecord records[DUPLICATES_HASH_CHUNK];
+    for (int start = 0; start < count; start += DUPLICATES_HASH_CHUNK) {
+        int chunk = count - start < DUPLICATES_HASH_CHUNK ? count - start : DUPLICATES_HASH_CHUNK;
+        for (int i = 0; i < chunk; i++) {
+            const DuplicateFileInfo *file = candidates[start + i].file;
+            records[i] = (HashCacheRecord){ .device = file->device, .inode = file->inode,
+                                            .size = file->size, .mtime = (int64_t)file->modified };
+        }
+        if (hash_cache_lookup_batch(config->hash_cache, records, chunk) == 0) continue;
+
+        for (int i = 0; i < chunk; i++) {
+            ExactCandidate *candidate = &candidates[start + i];
+            const HashCacheRecord *record = &records[i];
+            if (record->flags & HASH_CACHE_HAS_FULL) {
+                candidate->full = record->full;
+                candidate->known |= HASH_CACHE_HAS_FULL;
+                if (hashed_whole(candidate->file, DUPLICATES_PARTIAL_BYTES)) {
+                    candidate->partial = record->full;
+                    candidate->known |= HASH_CACHE_HAS_PARTIAL;
+                }
+            }
+            if ((record->flags & HASH_CACHE_HAS_PARTIAL) && record->partial_bytes == DUPLICATES_PARTIAL_BYTES) {
+                candidate->partial = record->partial;
+                candidate->known |= HASH_CACHE_HAS_PARTIAL;
+            }
+            if (record->flags & HASH_CACHE_HAS_DIGESTS) {
+                memcpy(candidate->file->hash_md5, record->md5, HASH_SIZE_MD5);
+                memcpy(candidate->sha256, record->sha256, HASH_SIZE_SHA256);
+                candidate->known |= HASH_CACHE_HAS_DIGESTS;
+            }
+        }
+    }
+}
+
+// Helper: write back what this scan hashed (at most DUPLICATES_HASH_CHUNK candidates)
+static void store_fresh_hashes(ExactCandidate *candidates, int count, const DuplicateConfig *config)
+{
+    if (!config->hash_cache) return;
+
+    HashCacheRecord records[DUPLICATES_HASH_CHUNK];
+    int stored = 0;
+    for (int i = 0; i < count && stored < DUPLICATES_HASH_CHUNK; i++) {
+        ExactCandidate *candidate = &candidates[i];
+        if (!candidate->fresh) continue;
+        candidate->fresh = false;
+
+        const DuplicateFileInfo *file = candidate->file;
+        HashCacheRecord *record = &records[stored++];
+        *record = (HashCacheRecord){
+            .path = file->path, .device = file->device, .inode = file->inode,
+            .size = file->size, .mtime = (int64_t)file->modified, .flags = candidate->known,
+            .partial_bytes = DUPLICATES_PARTIAL_BYTES, .partial = candidate->partial, .full = candidate->full
+        };
+        memcpy(record->md5, file->hash_md5, HASH_SIZE_MD5);
+        memcpy(record->sha256, candidate->sha256, HASH_SIZE_SHA256);
+    }
+    if (stored > 0) {
+        hash_cache_store_batch(config->hash_cache, records, stored);
+    }
+}
+
+// Helper: fast-hash candidates on the hashing pool (partial_bytes 0 = whole files)
+// unless the cache had the hash, and drop those that cannot be read. Returns how
+// many are left, or -1 if cancelled
+static int hash_candidates(ExactCandidate *candidates, int count, uint64_t partial_bytes,
+                           const DuplicateConfig *config,
+                           DuplicateProgressCallback progress, void *user_data)
+{
+    uint32_t wanted = partial_bytes == 0 ? HASH_CACHE_HAS_FULL : HASH_CACHE_HAS_PARTIAL;
+    FileHashJob jobs[DUPLICATES_HASH_CHUNK];
+    int job_index[DUPLICATES_HASH_CHUNK];
+    int kept = 0;
+    for (int start = 0; start < count; start += DUPLICATES_HASH_CHUNK) {
+        if (config->cancelled) return -1;
+
+        int chunk = count - start < DUPLICATES_HASH_CHUNK ? count - start : DUPLICATES_HASH_CHUNK;
+        int job_count = 0;
+        for (int i = 0; i < chunk; i++) {
+            job_index[i] = -1;
+            if (candidates[start + i].known & wanted) continue;
+            DuplicateFileInfo *file = candidates[start + i].file;
+            job_index[i] = job_count;
+            jobs[job_count++] = (FileHashJob){ .path = file->path, .size = file->size, .partial_bytes = partial_bytes };
+        }
+        file_hash_batch(jobs, job_count);
+
+        int chunk_kept = kept;
+        for (int i = 0; i < chunk; i++) {
+            ExactCandidate candidate = candidates[start + i];
+            if (job_index[i] >= 0) {
+                const FileHashJob *job = &jobs[job_index[i]];
+                if (!job->ok) continue;
+                if (hashed_whole(candidate.file, partial_bytes)) {
+                    candidate.full = job->hash;
+                    candidate.known |= HASH_CACHE_HAS_FULL;
+                }
+                if (partial_bytes != 0) {
+                    candidate.partial = job->hash;
+                    candidate.known |= HASH_CACHE_HAS_PARTIAL;
+                }
+                candidate.fresh = true;
+            }
+            candidates[kept++] = candidate;
+        }
+        store_fresh_hashes(&candidates[chunk_kept], kept - chunk_kept, config);
+
+        if (progress) {
+            progress(start + chunk, count, candidates[start + chunk - 1].file->path, user_data);
+        }
+    }
+    return kept;
+}
+
+// Helper: SHA256 (and MD5) for candidates the cache has no digests for, dropping
+// unreadable ones. Returns how many are left
+static int verify_candidates(ExactCandidate *candidates, int count, const DuplicateConfig *config)
+{
+    int verified = 0;
+    int unstored = 0;
+    for (int i = 0; i < count && !config->cancelled; i++) {
+        ExactCandidate *candidate = &candidates[i];
+        if (!(candidate->known & HASH_CACHE_HAS_DIGESTS)) {
+            if (!hash_file_full(candidate->file->path, candidate->file->hash_md5, candidate->sha256)) continue;
+            candidate->known |= HASH_CACHE_HAS_DIGESTS;
+            candidate->fresh = true;
+        }
+        candidates[verified++] = *candidate;
+
+        if (verified - unstored == DUPLICATES_HASH_CHUNK) {
+            store_fresh_hashes(&candidates[unstored], DUPLICATES_HASH_CHUNK, config);
+            unstored = verified;
+        }
+    }
+    store_fresh_hashes(&candidates[unstored], verified - unstored, config);
+    return verified;
+}
+
+// Find exact duplicates in stages: files with a unique size are never read, the
+// rest are narrowed by a fast hash of head and tail, then of the whole file on the
+// hashing pool. Only files that still collide are verified with SHA256
 static void find_exact_duplicates(FileList *list, DuplicateAnalysis *analysis,
+                                   const DuplicateConfig *config,
                                    DuplicateProgressCallback progress, void *user_data)
 {
-    // First pass: compute hashes
+    ExactCandidate *candidates = malloc((size_t)list->count * sizeof(ExactCandidate));
+    if (!candidates) return;
+
+    // Stage 1: size buckets
     for (int i = 0; i < list->count; i++) {
-        DuplicateFileInfo *file = &list->files[i];
-        hash_file_md5(file->path, file->hash_md5);
+        candidates[i] = (ExactCandidate){ .file = &list->files[i] };
+    }
+    int count = keep_matching_runs(candidates, list->count, compare_candidates_by_size);
+    load_cached_hashes(candidates, count, config);
 
-        if (progress) {
-            progress(i + 1, list->count, file->path, user_data);
+    // Stage 2: head and tail (files this small are hashed whole)
+    count = hash_candidates(candidates, count, DUPLICATES_PARTIAL_BYTES, config, progress, user_data);
+    if (count > 0) {
+        count = keep_matching_runs(candidates, count, compare_candidates_by_partial);
+    }
+
+    // Stage 3: whole files, for those too large to have been hashed whole already.
+    // Sorting puts them after the small ones (same order as by size)
+    int large = 0;
+    while (large < count && candidates[large].file->size <= 2 * DUPLICATES_PARTIAL_BYTES) large++;
+    if (count > large) {
+        int hashed = hash_candidates(&candidates[large], count - large, 0, config, progress, user_data);
+        count = hashed < 0 ? -1 : large + hashed;
+    }
+    if (count > 0) {
+        count = keep_matching_runs(candidates, count, compare_candidates_by_full);
+    }
+
+    // Stage 4: SHA256 before anything is reported as identical
+    int verified = count > 0 ? verify_candidates(candidates, count, config) : 0;
+    if (count < 0 || config->cancelled) {
+        free(candidates);
+        return;
+    }
+    count = keep_matching_runs(candidates, verified, compare_candidates_by_sha256);
+
+    // Runs of equal size and hash are the groups
+    for (int start = 0; start < count; ) {
+        int end = start + 1;
+        while (end < count && compare_candidates_by_sha256(&candidates[start], &candidates[end]) == 0) end++;
+
+        DuplicateGroup *group = add_group(analysis, DUP_TYPE_EXACT);
+        if (!group) break;
+        for (int i = start; i < end; i++) {
+            add_to_group(group, candidates[i].file);
         }
+
+        analysis->total_duplicates_found += group->file_count;
+        // Calculate reclaimable size (all but one copy)
+        group->reclaimable_size = group->total_size - candidates[start].file->size;
+        analysis->total_reclaimable_size += group->reclaimable_size;
+        start = end;
     }
 
-    // Group by hash
-    bool *processed = calloc(list->count, sizeof(bool));
-    if (!processed) return;
+    free(candidates);
+}
 
-    for (int i = 0; i < list->count; i++) {
-        if (processed[i]) continue;
+// BK-tree over 64-bit perceptual hashes: a node's children are keyed by their Hamming
+// distance to it, so by the triangle inequality a radius query only descends into
+// children whose key is within the radius of the query's distance to the node
+typedef struct BKNode {
+    uint64_t hash;
+    int item;               // Caller's index
+    int distance;           // To the parent
+    int first_child;        // -1 if none
+    int next_sibling;       // -1 if last
+} BKNode;
+
+typedef struct BKTree {
+    BKNode *nodes;
+    int count;
+} BKTree;
 
-        DuplicateFileInfo *file1 = &list->files[i];
-        DuplicateGroup *group = NULL;
-
-        for (int j = i + 1; j < list->count; j++) {
-            if (processed[j]) continue;
-
-            DuplicateFileInfo *file2 = &list->files[j];
-
-            // Same size is a prerequisite
-            if (file1->size != file2->size) continue;
-
-            // Compare hashes
-            if (memcmp(file1->hash_md5, file2->hash_md5, HASH_SIZE_MD5) == 0) {
-                // Verify with byte comparison for safety
-                if (files_are_identical(file1->path, file2->path)) {
-                    if (!group) {
-                        group = add_group(analysis, DUP_TYPE_EXACT);
-                        if (!group) {
-                            free(processed);
-                            return;
-                        }
-                        add_to_group(group, file1);
-                    }
-                    add_to_group(group, file2);
-                    processed[j] = true;
-                }
-            }
+static uint64_t perceptual_bits(const uint8_t *hash)
+{
+    uint64_t bits = 0;
+    for (int i = 0; i < HASH_SIZE_PERCEPTUAL; i++) {
+        bits |= (uint64_t)hash[i] << (8 * i);
+    }
+    return bits;
+}
+
+// Helper: insert into a tree whose nodes array holds room for every item
+static void bk_tree_insert(BKTree *tree, uint64_t hash, int item)
+{
+    int index = tree->count++;
+    tree->nodes[index] = (BKNode){ .hash = hash, .item = item, .first_child = -1, .next_sibling = -1 };
+    if (index == 0) return;
+
+    int node = 0;
+    for (;;) {
+        int distance = __builtin_popcountll(tree->nodes[node].hash ^ hash);
+        int child = tree->nodes[node].first_child;
+        while (child >= 0 && tree->nodes[child].distance != distance) {
+            child = tree->nodes[child].next_sibling;
+        }
+        if (child < 0) {
+            tree->nodes[index].distance = distance;
+            tree->nodes[index].next_sibling = tree->nodes[node].first_child;
+            tree->nodes[node].first_child = index;
+            return;
         }
+        node = child;
+    }
+}
 
-        if (group) {
-            processed[i] = true;
-            analysis->total_duplicates_found += group->file_count;
-            // Calculate reclaimable size (all but one copy)
-            group->reclaimable_size = group->total_size - file1->size;
-            analysis->total_reclaimable_size += group->reclaimable_size;
+// Helper: node indices within max_distance of hash. stack and out must hold tree->count entries
+static int bk_tree_query(const BKTree *tree, uint64_t hash, int max_distance, int *stack, int *out)
+{
+    if (tree->count == 0) return 0;
+
+    int found = 0;
+    int depth = 0;
+    stack[depth++] = 0;
+    while (depth > 0) {
+        const BKNode *node = &tree->nodes[stack[--depth]];
+        int distance = __builtin_popcountll(node->hash ^ hash);
+        if (distance <= max_distance) {
+            out[found++] = (int)(node - tree->nodes);
+        }
+        for (int child = node->first_child; child >= 0; child = tree->nodes[child].next_sibling) {
+            int key = tree->nodes[child].distance;
+            if (key >= distance - max_distance && key <= distance + max_distance) {
+                stack[depth++] = child;
+            }
         }
     }
+    return found;
+}
 
-    free(processed);
+static int compare_ints(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
 }
 
-// Find similar images using perceptual hash
+// Find similar images using perceptual hash. Hashes go into a BK-tree, so each
+// image only meets the few whose hash is near its own instead of every other image
 static void find_similar_images(FileList *list, DuplicateAnalysis *analysis,
                                  const DuplicateConfig *config,
                                  DuplicateProgressCallback progress, void *user_data)
@@ -457,10 +863,25 @@ static void find_similar_images(FileList *list, DuplicateAnalysis *analysis,
         return;
     }
 
-    // Compute perceptual hashes
-    for (int i = 0; i < image_count; i++) {
+    BKTree tree = { .nodes = malloc((size_t)image_count * sizeof(BKNode)) };
+    int *stack = malloc((size_t)image_count * sizeof(int));
+    int *matches = malloc((size_t)image_count * sizeof(int));
+    bool *processed = calloc((size_t)image_count, sizeof(bool));
+    if (!tree.nodes || !stack || !matches || !processed) {
+        free(tree.nodes);
+        free(stack);
+        free(matches);
+        free(processed);
+        free(image_indices);
+        return;
+    }
+
+    // Compute perceptual hashes; images that fail to decode are left out
+    for (int i = 0; i < image_count && !config->cancelled; i++) {
         DuplicateFileInfo *file = &list->files[image_indices[i]];
-        hash_image_perceptual(file->path, file->hash_perceptual);
+        if (hash_image_perceptual(file->path, file->hash_perceptual)) {
+            bk_tree_insert(&tree, perceptual_bits(file->hash_perceptual), i);
+        }
 
         if (progress) {
             progress(i + 1, image_count, file->path, user_data);
@@ -469,55 +890,99 @@ static void find_similar_images(FileList *list, DuplicateAnalysis *analysis,
 
     // Group similar images (Hamming distance threshold)
     int max_distance = (int)((1.0f - config->similarity_threshold) * 64); // 64 bits total
-    bool *processed = calloc((size_t)image_count, sizeof(bool));
-    if (!processed) {
-        free(image_indices);
-        return;
-    }
 
-    for (int i = 0; i < image_count; i++) {
+    for (int n = 0; n < tree.count && !config->cancelled; n++) {
+        int i = tree.nodes[n].item;
         if (processed[i]) continue;
 
-        DuplicateFileInfo *file1 = &list->files[image_indices[i]];
-        DuplicateGroup *group = NULL;
+        // Same order as a pairwise scan: the others by their position in the list
+        int found = bk_tree_query(&tree, tree.nodes[n].hash, max_distance, stack, matches);
+        int others = 0;
+        for (int k = 0; k < found; k++) {
+            int j = tree.nodes[matches[k]].item;
+            if (j != i && !processed[j]) matches[others++] = j;
+        }
+        if (others == 0) continue;
+        qsort(matches, (size_t)others, sizeof(int), compare_ints);
 
-        for (int j = i + 1; j < image_count; j++) {
-            if (processed[j]) continue;
+        DuplicateGroup *group = add_group(analysis, DUP_TYPE_SIMILAR_IMAGE);
+        if (!group) break;
 
-            DuplicateFileInfo *file2 = &list->files[image_indices[j]];
-            int distance = hash_hamming_distance(file1->hash_perceptual, file2->hash_perceptual, HASH_SIZE_PERCEPTUAL);
+        DuplicateFileInfo *file1 = &list->files[image_indices[i]];
+        file1->similarity_score = 1.0f;
+        add_to_group(group, file1);
+        processed[i] = true;
 
-            if (distance >= 0 && distance <= max_distance) {
-                if (!group) {
-                    group = add_group(analysis, DUP_TYPE_SIMILAR_IMAGE);
-                    if (!group) break;
-                    file1->similarity_score = 1.0f;
-                    add_to_group(group, file1);
-                }
-                file2->similarity_score = 1.0f - (float)distance / 64.0f;
-                add_to_group(group, file2);
-                processed[j] = true;
-            }
+        for (int k = 0; k < others; k++) {
+            DuplicateFileInfo *file2 = &list->files[image_indices[matches[k]]];
+            int distance = hash_hamming_distance(file1->hash_perceptual, file2->hash_perceptual, HASH_SIZE_PERCEPTUAL);
+            file2->similarity_score = 1.0f - (float)distance / 64.0f;
+            add_to_group(group, file2);
+            processed[matches[k]] = true;
         }
 
-        if (group) {
-            processed[i] = true;
-            analysis->total_duplicates_found += group->file_count;
-            // Reclaimable: keep largest
-            uint64_t max_size = 0;
-            for (int k = 0; k < group->file_count; k++) {
-                if (group->files[k].size > max_size) max_size = group->files[k].size;
-            }
-            group->reclaimable_size = group->total_size - max_size;
-            analysis->total_reclaimable_size += group->reclaimable_size;
+        analysis->total_duplicates_found += group->file_count;
+        // Reclaimable: keep largest
+        uint64_t max_size = 0;
+        for (int k = 0; k < group->file_count; k++) {
+            if (group->files[k].size > max_size) max_size = group->files[k].size;
         }
+        group->reclaimable_size = group->total_size - max_size;
+        analysis->total_reclaimable_size += group->reclaimable_size;
     }
 
+    free(tree.nodes);
+    free(stack);
+    free(matches);
     free(processed);
     free(image_indices);
 }
 
-// Find similar text files using embeddings
+// Helper: embed files in batches, writing unit vectors to embeddings and setting ok
+static void embed_text_files(EmbeddingEngine *engine, DuplicateFileInfo **files, int count,
+                             float *embeddings, bool *ok)
+{
+    char *contents[DUPLICATES_EMBED_BATCH];
+    const char *texts[DUPLICATES_EMBED_BATCH];
+    int slots[DUPLICATES_EMBED_BATCH];
+
+    for (int start = 0; start < count; start += DUPLICATES_EMBED_BATCH) {
+        int chunk = count - start < DUPLICATES_EMBED_BATCH ? count - start : DUPLICATES_EMBED_BATCH;
+        int batch = 0;
+        for (int i = 0; i < chunk; i++) {
+            FILE *f = fopen(files[start + i]->path, "r");
+            if (!f) continue;
+            char *content = malloc(EMBEDDING_MAX_TEXT_LEN + 1);
+            if (content) {
+                size_t len = fread(content, 1, EMBEDDING_MAX_TEXT_LEN, f);
+                content[len] = '\0';
+                contents[batch] = content;
+                texts[batch] = content;
+                slots[batch++] = start + i;
+            }
+            fclose(f);
+        }
+        if (batch == 0) continue;
+
+        BatchEmbeddingResult result = embedding_generate_batch(engine, texts, batch);
+        if (result.status == EMBEDDING_STATUS_OK && result.count == batch) {
+            for (int i = 0; i < batch; i++) {
+                float *embedding = &embeddings[(size_t)slots[i] * EMBEDDING_DIMENSION];
+                memcpy(embedding, &result.embeddings[(size_t)i * EMBEDDING_DIMENSION], EMBEDDING_DIMENSION * sizeof(float));
+                vector_normalize(embedding, EMBEDDING_DIMENSION);
+                ok[slots[i]] = true;
+            }
+        }
+        batch_embedding_result_free(&result);
+        for (int i = 0; i < batch; i++) {
+            free(contents[i]);
+        }
+    }
+}
+
+// Find similar text files using embeddings. Files the vector database indexed since
+// their last change reuse its embedding; the rest are embedded in batches. Groups come
+// from nearest-neighbour queries on an HNSW index rather than comparing every pair
 static void find_similar_text(FileList *list, DuplicateAnalysis *analysis,
                                const DuplicateConfig *config,
                                DuplicateProgressCallback progress, void *user_data)
@@ -538,103 +1003,147 @@ static void find_similar_text(FileList *list, DuplicateAnalysis *analysis,
         return;
     }
 
-    // Create embedding engine
-    EmbeddingEngine *engine = embedding_engine_create();
-    if (!engine) {
-        free(text_indices);
-        return;
-    }
-
-    // Allocate embeddings array
-    float *embeddings = malloc(text_count * EMBEDDING_DIMENSION * sizeof(float));
-    if (!embeddings) {
-        embedding_engine_destroy(engine);
+    float *embeddings = malloc((size_t)text_count * EMBEDDING_DIMENSION * sizeof(float));
+    bool *embedded = calloc((size_t)text_count, sizeof(bool));
+    DuplicateFileInfo **pending = malloc((size_t)text_count * sizeof(DuplicateFileInfo *));
+    int *pending_slots = malloc((size_t)text_count * sizeof(int));
+    IndexedFile *indexed = malloc(sizeof(IndexedFile));
+    if (!embeddings || !embedded || !pending || !pending_slots || !indexed) {
+        free(embeddings);
+        free(embedded);
+        free(pending);
+        free(pending_slots);
+        free(indexed);
         free(text_indices);
         return;
     }
 
-    // Generate embeddings for each text file
-    for (int i = 0; i < text_count; i++) {
+    // Embeddings already in the database
+    int pending_count = 0;
+    for (int i = 0; i < text_count && !config->cancelled; i++) {
         DuplicateFileInfo *file = &list->files[text_indices[i]];
-
-        // Read file content (up to 8KB)
-        FILE *f = fopen(file->path, "r");
-        if (f) {
-            char content[8192] = {0};
-            size_t len = fread(content, 1, sizeof(content) - 1, f);
-            content[len] = '\0';
-            fclose(f);
-
-            EmbeddingResult result = embedding_generate(engine, content);
-            if (result.status == EMBEDDING_STATUS_OK) {
-                memcpy(&embeddings[i * EMBEDDING_DIMENSION], result.embedding, EMBEDDING_DIMENSION * sizeof(float));
-            } else {
-                memset(&embeddings[i * EMBEDDING_DIMENSION], 0, EMBEDDING_DIMENSION * sizeof(float));
+        if (config->vectordb && vectordb_is_indexed(config->vectordb, file->path, (int64_t)file->modified) &&
+            vectordb_get_file(config->vectordb, file->path, indexed) == VECTORDB_STATUS_OK && indexed->has_embedding) {
+            float *embedding = &embeddings[(size_t)i * EMBEDDING_DIMENSION];
+            memcpy(embedding, indexed->embedding, EMBEDDING_DIMENSION * sizeof(float));
+            vector_normalize(embedding, EMBEDDING_DIMENSION);
+            embedded[i] = true;
+        } else {
+            pending[pending_count] = file;
+            pending_slots[pending_count++] = i;
+        }
+    }
+    free(indexed);
+
+    // The rest through the shared engine; without one they are left out
+    EmbeddingEngine *engine = config->embedding_engine;
+    float *fresh = engine && pending_count > 0 ? malloc((size_t)pending_count * EMBEDDING_DIMENSION * sizeof(float)) : NULL;
+    bool *fresh_ok = fresh ? calloc((size_t)pending_count, sizeof(bool)) : NULL;
+    if (fresh && fresh_ok) {
+        for (int start = 0; start < pending_count && !config->cancelled; start += DUPLICATES_HASH_CHUNK) {
+            int chunk = pending_count - start < DUPLICATES_HASH_CHUNK ? pending_count - start : DUPLICATES_HASH_CHUNK;
+            embed_text_files(engine, &pending[start], chunk,
+                             &fresh[(size_t)start * EMBEDDING_DIMENSION], &fresh_ok[start]);
+            if (progress) {
+                progress(start + chunk, pending_count, pending[start + chunk - 1]->path, user_data);
             }
         }
-
-        if (progress) {
-            progress(i + 1, text_count, file->path, user_data);
+        for (int k = 0; k < pending_count; k++) {
+            if (!fresh_ok[k]) continue;
+            memcpy(&embeddings[(size_t)pending_slots[k] * EMBEDDING_DIMENSION],
+                   &fresh[(size_t)k * EMBEDDING_DIMENSION], EMBEDDING_DIMENSION * sizeof(float));
+            embedded[pending_slots[k]] = true;
         }
     }
+    free(fresh);
+    free(fresh_ok);
+    free(pending);
+    free(pending_slots);
 
-    // Group similar text files
+    VectorIndex *index = vector_index_create(EMBEDDING_DIMENSION);
     bool *processed = calloc((size_t)text_count, sizeof(bool));
-    if (!processed) {
+    int *matches = malloc((size_t)text_count * sizeof(int));
+    float *match_scores = malloc((size_t)text_count * sizeof(float));
+    VectorIndexHit *hits = malloc((size_t)text_count * sizeof(VectorIndexHit));
+    if (!index || !processed || !matches || !match_scores || !hits || config->cancelled) {
+        vector_index_destroy(index);
+        free(processed);
+        free(matches);
+        free(match_scores);
+        free(hits);
         free(embeddings);
-        embedding_engine_destroy(engine);
+        free(embedded);
         free(text_indices);
         return;
     }
 
     for (int i = 0; i < text_count; i++) {
-        if (processed[i]) continue;
-
-        DuplicateFileInfo *file1 = &list->files[text_indices[i]];
-        float *emb1 = &embeddings[i * EMBEDDING_DIMENSION];
-        DuplicateGroup *group = NULL;
+        if (embedded[i]) {
+            vector_index_put(index, i, &embeddings[(size_t)i * EMBEDDING_DIMENSION]);
+        }
+    }
 
-        for (int j = i + 1; j < text_count; j++) {
-            if (processed[j]) continue;
+    // Group similar text files
+    for (int i = 0; i < text_count && !config->cancelled; i++) {
+        if (processed[i] || !embedded[i]) continue;
+
+        // Widen the query until its worst hit falls below the threshold
+        const float *query = &embeddings[(size_t)i * EMBEDDING_DIMENSION];
+        int k = DUPLICATES_TEXT_NEIGHBORS;
+        int found;
+        for (;;) {
+            if (k > text_count) k = text_count;
+            found = vector_index_search(index, query, k, VECTOR_INDEX_DEFAULT_EF, hits);
+            if (found < k || k == text_count || hits[found - 1].score < config->similarity_threshold) break;
+            k *= 2;
+        }
 
-            DuplicateFileInfo *file2 = &list->files[text_indices[j]];
-            float *emb2 = &embeddings[j * EMBEDDING_DIMENSION];
+        int others = 0;
+        for (int h = 0; h < found; h++) {
+            int j = (int)hits[h].label;
+            if (j == i || processed[j] || hits[h].score < config->similarity_threshold) continue;
+            matches[others++] = j;
+            match_scores[j] = hits[h].score;
+        }
+        if (others == 0) continue;
+        qsort(matches, (size_t)others, sizeof(int), compare_ints);
 
-            float similarity = cosine_similarity(emb1, emb2, EMBEDDING_DIMENSION);
+        DuplicateGroup *group = add_group(analysis, DUP_TYPE_SIMILAR_TEXT);
+        if (!group) break;
 
-            if (similarity >= config->similarity_threshold) {
-                if (!group) {
-                    group = add_group(analysis, DUP_TYPE_SIMILAR_TEXT);
-                    if (!group) break;
-                    file1->similarity_score = 1.0f;
-                    add_to_group(group, file1);
-                }
-                file2->similarity_score = similarity;
-                add_to_group(group, file2);
-                processed[j] = true;
-            }
+        DuplicateFileInfo *file1 = &list->files[text_indices[i]];
+        file1->similarity_score = 1.0f;
+        add_to_group(group, file1);
+        processed[i] = true;
+
+        for (int m = 0; m < others; m++) {
+            DuplicateFileInfo *file2 = &list->files[text_indices[matches[m]]];
+            file2->similarity_score = match_scores[matches[m]];
+            add_to_group(group, file2);
+            processed[matches[m]] = true;
         }
 
-        if (group) {
-            processed[i] = true;
-            analysis->total_duplicates_found += group->file_count;
-            // Reclaimable: keep newest
-            time_t newest = 0;
-            uint64_t newest_size = 0;
-            for (int k = 0; k < group->file_count; k++) {
-                if (group->files[k].modified > newest) {
-                    newest = group->files[k].modified;
-                    newest_size = group->files[k].size;
-                }
+        analysis->total_duplicates_found += group->file_count;
+        // Reclaimable: keep newest
+        time_t newest = 0;
+        uint64_t newest_size = 0;
+        for (int m = 0; m < group->file_count; m++) {
+            if (group->files[m].modified > newest) {
+                newest = group->files[m].modified;
+                newest_size = group->files[m].size;
             }
-            group->reclaimable_size = group->total_size - newest_size;
-            analysis->total_reclaimable_size += group->reclaimable_size;
         }
+        group->reclaimable_size = group->total_size - newest_size;
+        analysis->total_reclaimable_size += group->reclaimable_size;
     }
 
+    vector_index_destroy(index);
     free(processed);
+    free(matches);
+    free(match_scores);
+    free(hits);
     free(embeddings);
-    embedding_engine_destroy(engine);
+    free(embedded);
     free(text_indices);
 }
 
@@ -668,20 +1177,28 @@ DuplicateStatus duplicate_scan_directories(const char **paths,
     list.files = malloc(list.capacity * sizeof(DuplicateFileInfo));
     if (!list.files) return DUP_STATUS_MEMORY_ERROR;
 
+    ExcludeSet *excludes;
+    if (!compile_excludes(config, &excludes)) {
+        free(list.files);
+        return DUP_STATUS_MEMORY_ERROR;
+    }
+
     // Scan all directories
     for (int i = 0; i < path_count; i++) {
-        DuplicateStatus status = scan_directory_recursive(paths[i], config, &list, progress, user_data);
+        DuplicateStatus status = scan_directory_recursive(paths[i], config, excludes, &list, progress, user_data);
         if (status != DUP_STATUS_OK) {
+            exclude_set_destroy(excludes);
             free(list.files);
             return status;
         }
     }
+    exclude_set_destroy(excludes);
 
     result->total_files_scanned = list.count;
 
     // Find duplicates
     if (config->detect_exact) {
-        find_exact_duplicates(&list, result, progress, user_data);
+        find_exact_duplicates(&list, result, config, progress, user_data);
     }
 
     if (config->detect_similar_images) {
@@ -718,10 +1235,17 @@ DuplicateStatus duplicate_find_copies(const char *file_path,
 
     // Get source file info and hash
     struct stat st;
-    if (stat(file_path, &st) != 0) return DUP_STATUS_FILE_ERROR;
+    if (!stat_cache_stat(file_path, &st)) return DUP_STATUS_FILE_ERROR;
 
     uint8_t source_hash[HASH_SIZE_MD5];
-    if (!hash_file_md5(file_path, source_hash)) return DUP_STATUS_FILE_ERROR;
+    uint8_t source_sha256[HASH_SIZE_SHA256];
+    if (!hash_file_full(file_path, source_hash, source_sha256)) return DUP_STATUS_FILE_ERROR;
+
+    // Fast head/tail hash to rule out same-size files cheaply
+    uint64_t source_partial;
+    if (!file_hash_partial(file_path, (uint64_t)st.st_size, DUPLICATES_PARTIAL_BYTES, &source_partial)) {
+        return DUP_STATUS_FILE_ERROR;
+    }
 
     // Scan directory for matching files
     DuplicateConfig scan_config = *config;
@@ -733,7 +1257,13 @@ DuplicateStatus duplicate_find_copies(const char *file_path,
     list.files = malloc(list.capacity * sizeof(DuplicateFileInfo));
     if (!list.files) return DUP_STATUS_MEMORY_ERROR;
 
-    DuplicateStatus status = scan_directory_recursive(search_dir, &scan_config, &list, NULL, NULL);
+    ExcludeSet *excludes;
+    if (!compile_excludes(&scan_config, &excludes)) {
+        free(list.files);
+        return DUP_STATUS_MEMORY_ERROR;
+    }
+    DuplicateStatus status = scan_directory_recursive(search_dir, &scan_config, excludes, &list, NULL, NULL);
+    exclude_set_destroy(excludes);
     if (status != DUP_STATUS_OK) {
         free(list.files);
         return status;
@@ -754,27 +1284,34 @@ DuplicateStatus duplicate_find_copies(const char *file_path,
     memcpy(source_info.hash_md5, source_hash, HASH_SIZE_MD5);
     add_to_group(group, &source_info);
 
-    // Find duplicates
+    // Same-size files, other than the source itself
+    ExactCandidate *candidates = malloc((size_t)(list.count > 0 ? list.count : 1) * sizeof(ExactCandidate));
+    if (!candidates) {
+        free(list.files);
+        return DUP_STATUS_MEMORY_ERROR;
+    }
+    int count = 0;
     for (int i = 0; i < list.count; i++) {
         DuplicateFileInfo *file = &list.files[i];
-
-        // Skip if same path
         if (strcmp(file->path, file_path) == 0) continue;
-
-        // Check size first
         if ((uint64_t)st.st_size != file->size) continue;
-
-        // Compute hash and compare
-        if (hash_file_md5(file->path, file->hash_md5)) {
-            if (memcmp(source_hash, file->hash_md5, HASH_SIZE_MD5) == 0) {
-                if (files_are_identical(file_path, file->path)) {
-                    add_to_group(group, file);
-                    result->total_duplicates_found++;
-                }
-            }
+        candidates[count++] = (ExactCandidate){ .file = file };
+    }
+    load_cached_hashes(candidates, count, config);
+
+    // Head/tail on the hashing pool, then SHA256 for the files that match
+    count = hash_candidates(candidates, count, DUPLICATES_PARTIAL_BYTES, config, NULL, NULL);
+    for (int i = 0; i < count; i++) {
+        DuplicateFileInfo *file = candidates[i].file;
+        if (candidates[i].partial != source_partial) continue;
+        if (verify_candidates(&candidates[i], 1, config) == 1 &&
+            memcmp(source_sha256, candidates[i].sha256, HASH_SIZE_SHA256) == 0) {
+            add_to_group(group, file);
+            result->total_duplicates_found++;
         }
     }
 
+    free(candidates);
     free(list.files);
 
     // Remove group if no duplicates found
@@ -845,19 +1382,30 @@ int duplicate_cleanup_group(DuplicateGroup *group, bool use_trash)
 {
     if (!group || group->file_count <= 1) return 0;
 
+    if (use_trash) {
+        // Move to trash using native macOS API (safe from shell injection), in one batch
+        // recorded as one undo group
+        const char **paths = malloc(sizeof(const char*) * (size_t)group->file_count);
+        int count = 0;
+        if (paths) {
+            for (int i = 0; i < group->file_count; i++) {
+                if (!group->files[i].is_suggested_keep) {
+                    paths[count++] = group->files[i].path;
+                }
+            }
+        }
+        UndoLog *undo = undo_log_shared();
+        uint64_t undo_group = count > 0 ? undo_log_begin(undo, UNDO_SOURCE_DEDUPE, "Remove duplicates") : 0;
+        int deleted = file_trash_batch(paths, count, NULL, undo_group);
+        undo_log_end(undo, undo_group);
+        free(paths);
+        return deleted;
+    }
+
     int deleted = 0;
     for (int i = 0; i < group->file_count; i++) {
         if (group->files[i].is_suggested_keep) continue;
-
-        bool success;
-        if (use_trash) {
-            // Move to trash using native macOS API (safe from shell injection)
-            success = platform_move_to_trash(group->files[i].path);
-        } else {
-            success = (remove(group->files[i].path) == 0);
-        }
-
-        if (success) deleted++;
+        if (remove(group->files[i].path) == 0) deleted++;
     }
 
     return deleted;
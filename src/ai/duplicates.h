@@ -5,9 +5,9 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <time.h>
-
-// Maximum number of files to analyze in one batch
-#define DUPLICATES_MAX_FILES 10000
+#include "hash_cache.h"
+#include "embeddings.h"
+#include "vectordb.h"
 
 // Maximum number of duplicate groups
 #define DUPLICATES_MAX_GROUPS 1000
@@ -50,6 +50,8 @@ typedef struct DuplicateFileInfo {
     uint64_t size;
     time_t modified;
     time_t accessed;
+    uint64_t device;            // With inode, size and modified: the hash cache key
+    uint64_t inode;
     uint8_t hash_md5[HASH_SIZE_MD5];
     uint8_t hash_perceptual[HASH_SIZE_PERCEPTUAL];
     float similarity_score;     // 0.0 - 1.0
@@ -93,8 +95,11 @@ typedef struct DuplicateConfig {
     int min_file_size;          // Minimum file size to consider (default: 1 byte)
     int max_file_size;          // Maximum file size to scan (default: 1GB)
     bool recursive;             // Scan subdirectories (default: true)
-    const char **exclude_patterns;  // Patterns to exclude
+    const char **exclude_patterns;  // Names or globs to exclude, as for the indexer
     int exclude_count;
+    HashCache *hash_cache;      // Reuse hashes of unchanged files across scans (optional)
+    EmbeddingEngine *embedding_engine; // Embeds text files without a current vectordb embedding (optional)
+    VectorDB *vectordb;         // Reuse embeddings of files indexed since their last change (optional)
     bool cancelled;             // Set to true to cancel operation
 } DuplicateConfig;
 
@@ -1,14 +1,31 @@
 #include "embeddings.h"
 #include "ai_common.h"
+#include "vector_ops.h"
+#include "compute_budget.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <math.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 #ifdef FINDER_PLUS_AI_MODELS
 #include "bert_wrapper.h"
+#include "wordpiece.h"
+#ifdef __APPLE__
+#include "../platform/coreml.h"
+#define EMBEDDINGS_COREML
+#endif
+#endif
+
+#ifdef EMBEDDINGS_COREML
+// Core ML export of the same model, compiled and placed beside the ggml file. It takes
+// input_ids and attention_mask (int32, one row of the sequence length) and returns
+// last_hidden_state, which is mean pooled here exactly as bert.cpp pools
+#define COREML_MODEL_NAME "model.mlmodelc"
+#define COREML_OUTPUT "last_hidden_state"
 #endif
 
 // Embedding engine internal structure
@@ -16,9 +33,26 @@ struct EmbeddingEngine {
     EmbeddingConfig config;
     bool model_loaded;
     bool initialized;
+    int n_threads;
+    atomic_int batch_threads;   // Cap for batch inference (0 = n_threads)
+
+    // Inference holds the model shared; load and unload hold it exclusively
+    pthread_rwlock_t lock;
+    bool lazy;                  // config.model_path loads on first use (and again after a trim)
+    atomic_llong last_used;     // time() of the last inference
 #ifdef FINDER_PLUS_AI_MODELS
     struct bert_ctx *bert_ctx;
-    int n_threads;
+    int batch_capacity;         // Texts bert_eval_batch may take at once
+
+    // Tokenizer over the model file's vocabulary, built on first use and kept across
+    // unloads; replaced only with the model path (under the exclusive lock)
+    WordPiece *tokenizer;
+    bool tokenizer_failed;
+    pthread_mutex_t tokenizer_mutex;
+#endif
+#ifdef EMBEDDINGS_COREML
+    CoreMLModel *coreml;        // GPU/Neural Engine path when config.use_gpu (bert_ctx still tokenizes)
+    int coreml_tokens;          // Its sequence length
 #endif
 };
 
@@ -29,7 +63,7 @@ EmbeddingEngine* embedding_engine_create(void)
 {
     EmbeddingConfig config = {0};
     config.num_threads = 0;  // Auto-detect
-    config.use_gpu = false;
+    config.use_gpu = true;     // Core ML when its export is installed, CPU otherwise
     config.batch_size = 32;
     strncpy(config.model_path, DEFAULT_MODEL_PATH, sizeof(config.model_path) - 1);
 
@@ -51,15 +85,41 @@ EmbeddingEngine* embedding_engine_create_with_config(const EmbeddingConfig *conf
     engine->model_loaded = false;
     engine->initialized = true;
 
-#ifdef FINDER_PLUS_AI_MODELS
-    engine->bert_ctx = NULL;
     // Auto-detect threads if not specified
     engine->n_threads = config->num_threads > 0 ? config->num_threads : 4;
+    atomic_init(&engine->batch_threads, 0);
+    pthread_rwlock_init(&engine->lock, NULL);
+    engine->lazy = false;
+    atomic_init(&engine->last_used, 0);
+
+#ifdef FINDER_PLUS_AI_MODELS
+    engine->bert_ctx = NULL;
+    engine->batch_capacity = 0;
+    engine->tokenizer = NULL;
+    engine->tokenizer_failed = false;
+    pthread_mutex_init(&engine->tokenizer_mutex, NULL);
+#endif
+#ifdef EMBEDDINGS_COREML
+    engine->coreml = NULL;
+    engine->coreml_tokens = 0;
 #endif
 
     return engine;
 }
 
+int embedding_engine_get_threads(const EmbeddingEngine *engine)
+{
+    return engine != NULL ? engine->n_threads : 0;
+}
+
+void embedding_engine_set_batch_threads(EmbeddingEngine *engine, int threads)
+{
+    if (engine == NULL) {
+        return;
+    }
+    atomic_store(&engine->batch_threads, threads > 0 ? threads : 0);
+}
+
 void embedding_engine_destroy(EmbeddingEngine *engine)
 {
     if (engine == NULL) {
@@ -67,19 +127,196 @@ void embedding_engine_destroy(EmbeddingEngine *engine)
     }
 
     embedding_engine_unload_model(engine);
+#ifdef FINDER_PLUS_AI_MODELS
+    wordpiece_destroy(engine->tokenizer);
+    pthread_mutex_destroy(&engine->tokenizer_mutex);
+#endif
+    pthread_rwlock_destroy(&engine->lock);
     free(engine);
 }
 
-EmbeddingStatus embedding_engine_load_model(EmbeddingEngine *engine, const char *model_path)
+#ifdef FINDER_PLUS_AI_MODELS
+// Helper: the tokenizer for config.model_path, built on first use; NULL if the model
+// cannot be read (call with the lock held, shared or exclusive)
+static WordPiece* tokenizer_locked(EmbeddingEngine *engine)
 {
-    if (engine == NULL) {
-        return EMBEDDING_STATUS_NOT_INITIALIZED;
+    pthread_mutex_lock(&engine->tokenizer_mutex);
+    if (engine->tokenizer == NULL && !engine->tokenizer_failed) {
+        engine->tokenizer = wordpiece_load(engine->config.model_path);
+        engine->tokenizer_failed = engine->tokenizer == NULL;
     }
+    WordPiece *tokenizer = engine->tokenizer;
+    pthread_mutex_unlock(&engine->tokenizer_mutex);
+    return tokenizer;
+}
 
-    if (model_path != NULL) {
-        strncpy(engine->config.model_path, model_path, sizeof(engine->config.model_path) - 1);
+// Helper: point the engine at another model file, dropping the old model's tokenizer
+// (call with the lock held exclusively)
+static void set_model_path_locked(EmbeddingEngine *engine, const char *model_path)
+{
+    if (strcmp(engine->config.model_path, model_path) == 0) {
+        return;
     }
+    strncpy(engine->config.model_path, model_path, sizeof(engine->config.model_path) - 1);
+    wordpiece_destroy(engine->tokenizer);
+    engine->tokenizer = NULL;
+    engine->tokenizer_failed = false;
+}
+#else
+static void set_model_path_locked(EmbeddingEngine *engine, const char *model_path)
+{
+    strncpy(engine->config.model_path, model_path, sizeof(engine->config.model_path) - 1);
+}
+#endif
+
+#ifdef EMBEDDINGS_COREML
+// Helper: load the Core ML export if there is one; bert.cpp stays the fallback
+static void load_coreml_locked(EmbeddingEngine *engine)
+{
+    char path[4096];
+    path_sibling(engine->config.model_path, COREML_MODEL_NAME, path, sizeof(path));
+
+    engine->coreml = coreml_model_load(path, true);
+    if (engine->coreml == NULL) {
+        return;
+    }
+
+    engine->coreml_tokens = coreml_model_input_size(engine->coreml, "input_ids");
+    if (engine->coreml_tokens <= 0 || coreml_model_input_size(engine->coreml, "attention_mask") != engine->coreml_tokens) {
+        fprintf(stderr, "Embeddings: %s does not take input_ids and attention_mask; using the CPU\n", path);
+        coreml_model_free(engine->coreml);
+        engine->coreml = NULL;
+        return;
+    }
+    fprintf(stderr, "Embeddings: using Core ML (%d tokens)\n", engine->coreml_tokens);
+}
+
+// Helper: one row of ids for Core ML, cut to length with the closing [SEP] kept
+static int32_t coreml_row(EmbeddingEngine *engine, const char *text, const int32_t *tokens, int n_tokens,
+                          int32_t *row, int length)
+{
+    if (tokens == NULL) {
+        WordPiece *tokenizer = tokenizer_locked(engine);
+        if (tokenizer != NULL) {
+            return wordpiece_tokenize(tokenizer, text, strlen(text), row, length);
+        }
+        int32_t count = 0;
+        bert_tokenize(engine->bert_ctx, text, row, &count, length);
+        return count;
+    }
+
+    if (n_tokens <= length) {
+        memcpy(row, tokens, (size_t)n_tokens * sizeof(int32_t));
+        return n_tokens;
+    }
+    memcpy(row, tokens, (size_t)(length - 1) * sizeof(int32_t));
+    row[length - 1] = tokens[n_tokens - 1];
+    return length;
+}
+
+// Helper: embed count texts, or count tokenized texts when tokens is set, with Core ML
+// into out (count * EMBEDDING_DIMENSION floats). NULL entries are skipped. False if
+// Core ML failed, so the caller falls back to the CPU
+static bool encode_coreml(EmbeddingEngine *engine, const char **texts, const int32_t *const *tokens,
+                          const int *counts, int count, float *out)
+{
+    int length = engine->coreml_tokens;
+    int hidden_size = length * EMBEDDING_DIMENSION;
+    int chunk = engine->config.batch_size > 0 ? engine->config.batch_size : 32;
+
+    int32_t *ids = malloc((size_t)chunk * (size_t)length * sizeof(int32_t));
+    int32_t *mask = malloc((size_t)chunk * (size_t)length * sizeof(int32_t));
+    int *token_counts = malloc((size_t)chunk * sizeof(int));
+    int *slots = malloc((size_t)chunk * sizeof(int));
+    float *hidden = malloc((size_t)chunk * (size_t)hidden_size * sizeof(float));
+    bool ok = ids != NULL && mask != NULL && token_counts != NULL && slots != NULL && hidden != NULL;
+
+    for (int start = 0; ok && start < count; start += chunk) {
+        // Tokenize this chunk, padding each row to the model's sequence length
+        int rows = 0;
+        for (int i = start; i < count && i < start + chunk; i++) {
+            if (tokens != NULL ? tokens[i] == NULL : texts[i] == NULL) {
+                continue;
+            }
+            int32_t *row_ids = ids + (size_t)rows * (size_t)length;
+            int32_t *row_mask = mask + (size_t)rows * (size_t)length;
+            int32_t n_tokens = tokens != NULL
+                ? coreml_row(engine, NULL, tokens[i], counts[i], row_ids, length)
+                : coreml_row(engine, texts[i], NULL, 0, row_ids, length);
+            for (int t = 0; t < length; t++) {
+                if (t >= n_tokens) {
+                    row_ids[t] = 0;
+                }
+                row_mask[t] = t < n_tokens ? 1 : 0;
+            }
+            token_counts[rows] = n_tokens;
+            slots[rows] = i;
+            rows++;
+        }
+        if (rows == 0) {
+            continue;
+        }
+
+        CoreMLInput inputs[] = {
+            { "input_ids", COREML_INT32, ids },
+            { "attention_mask", COREML_INT32, mask },
+        };
+        ok = coreml_model_predict(engine->coreml, inputs, 2, rows, COREML_OUTPUT, hidden, hidden_size);
+
+        // Mean of the token states over the real tokens, then unit length
+        for (int r = 0; ok && r < rows; r++) {
+            float *embedding = out + (size_t)slots[r] * EMBEDDING_DIMENSION;
+            const float *states = hidden + (size_t)r * (size_t)hidden_size;
+            int n_tokens = token_counts[r] > 0 ? token_counts[r] : 1;
+            memset(embedding, 0, EMBEDDING_DIMENSION * sizeof(float));
+            for (int t = 0; t < n_tokens; t++) {
+                for (int d = 0; d < EMBEDDING_DIMENSION; d++) {
+                    embedding[d] += states[(size_t)t * EMBEDDING_DIMENSION + d];
+                }
+            }
+            for (int d = 0; d < EMBEDDING_DIMENSION; d++) {
+                embedding[d] /= (float)n_tokens;
+            }
+        }
+    }
+
+    free(ids);
+    free(mask);
+    free(token_counts);
+    free(slots);
+    free(hidden);
+    return ok;
+}
+#endif
 
+#ifdef FINDER_PLUS_AI_MODELS
+// Helper: only bert_encode_batch grows the context for larger batches, which
+// bert_eval_batch then relies on, so one batch_size batch of empty texts sizes it
+static void size_context_locked(EmbeddingEngine *engine)
+{
+    int batch_size = engine->config.batch_size > 0 ? engine->config.batch_size : 32;
+    const char **texts = malloc((size_t)batch_size * sizeof(const char *));
+    float **outputs = malloc((size_t)batch_size * sizeof(float *));
+    float *embeddings = malloc((size_t)batch_size * EMBEDDING_DIMENSION * sizeof(float));
+
+    engine->batch_capacity = 1;
+    if (texts != NULL && outputs != NULL && embeddings != NULL) {
+        for (int i = 0; i < batch_size; i++) {
+            texts[i] = "";
+            outputs[i] = &embeddings[(size_t)i * EMBEDDING_DIMENSION];
+        }
+        bert_encode_batch(engine->bert_ctx, 1, batch_size, batch_size, texts, outputs);
+        engine->batch_capacity = batch_size;
+    }
+    free(texts);
+    free(outputs);
+    free(embeddings);
+}
+#endif
+
+// Helper: load config.model_path (call with the lock held exclusively)
+static EmbeddingStatus load_model_locked(EmbeddingEngine *engine)
+{
     // Check if model file exists
     if (!embedding_model_exists(engine->config.model_path)) {
         return EMBEDDING_STATUS_MODEL_NOT_FOUND;
@@ -104,6 +341,13 @@ EmbeddingStatus embedding_engine_load_model(EmbeddingEngine *engine, const char
         fprintf(stderr, "Warning: Model embedding dimension (%d) differs from expected (%d)\n",
                 embd_dim, EMBEDDING_DIMENSION);
     }
+    size_context_locked(engine);
+
+#ifdef EMBEDDINGS_COREML
+    if (engine->config.use_gpu && engine->coreml == NULL) {
+        load_coreml_locked(engine);
+    }
+#endif
 
     engine->model_loaded = true;
     return EMBEDDING_STATUS_OK;
@@ -114,22 +358,81 @@ EmbeddingStatus embedding_engine_load_model(EmbeddingEngine *engine, const char
 #endif
 }
 
-void embedding_engine_unload_model(EmbeddingEngine *engine)
+// Helper: free the model (call with the lock held exclusively)
+static void unload_model_locked(EmbeddingEngine *engine)
 {
-    if (engine == NULL) {
-        return;
-    }
-
 #ifdef FINDER_PLUS_AI_MODELS
     if (engine->bert_ctx != NULL) {
         bert_free(engine->bert_ctx);
         engine->bert_ctx = NULL;
     }
 #endif
+#ifdef EMBEDDINGS_COREML
+    coreml_model_free(engine->coreml);
+    engine->coreml = NULL;
+#endif
 
     engine->model_loaded = false;
 }
 
+EmbeddingStatus embedding_engine_load_model(EmbeddingEngine *engine, const char *model_path)
+{
+    if (engine == NULL) {
+        return EMBEDDING_STATUS_NOT_INITIALIZED;
+    }
+
+    pthread_rwlock_wrlock(&engine->lock);
+    if (model_path != NULL) {
+        set_model_path_locked(engine, model_path);
+    }
+    engine->lazy = false;
+    EmbeddingStatus status = load_model_locked(engine);
+    pthread_rwlock_unlock(&engine->lock);
+    return status;
+}
+
+EmbeddingStatus embedding_engine_load_model_lazily(EmbeddingEngine *engine, const char *model_path)
+{
+    if (engine == NULL) {
+        return EMBEDDING_STATUS_NOT_INITIALIZED;
+    }
+
+    pthread_rwlock_wrlock(&engine->lock);
+    if (model_path != NULL) {
+        set_model_path_locked(engine, model_path);
+    }
+    engine->lazy = embedding_model_exists(engine->config.model_path);
+    pthread_rwlock_unlock(&engine->lock);
+    return engine->lazy ? EMBEDDING_STATUS_OK : EMBEDDING_STATUS_MODEL_NOT_FOUND;
+}
+
+void embedding_engine_unload_model(EmbeddingEngine *engine)
+{
+    if (engine == NULL) {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&engine->lock);
+    unload_model_locked(engine);
+    engine->lazy = false;
+    pthread_rwlock_unlock(&engine->lock);
+}
+
+bool embedding_engine_trim(EmbeddingEngine *engine, double idle_sec)
+{
+    // Skip an engine in use rather than wait for it
+    if (engine == NULL || pthread_rwlock_trywrlock(&engine->lock) != 0) {
+        return false;
+    }
+    bool idle = (double)(time(NULL) - atomic_load(&engine->last_used)) >= idle_sec;
+    bool unload = engine->lazy && engine->model_loaded && idle;
+    if (unload) {
+        unload_model_locked(engine);
+    }
+    pthread_rwlock_unlock(&engine->lock);
+    return unload;
+}
+
 bool embedding_engine_is_loaded(const EmbeddingEngine *engine)
 {
     if (engine == NULL) {
@@ -138,6 +441,43 @@ bool embedding_engine_is_loaded(const EmbeddingEngine *engine)
     return engine->model_loaded;
 }
 
+bool embedding_engine_is_available(const EmbeddingEngine *engine)
+{
+    if (engine == NULL) {
+        return false;
+    }
+    return engine->model_loaded || engine->lazy;
+}
+
+// Helper: hold the model for one inference, loading it first if it was deferred or
+// trimmed. Returns false (lock released) if there is no model to use
+static bool begin_use(EmbeddingEngine *engine)
+{
+    atomic_store(&engine->last_used, (long long)time(NULL));
+
+    pthread_rwlock_rdlock(&engine->lock);
+    if (!engine->model_loaded && engine->lazy) {
+        pthread_rwlock_unlock(&engine->lock);
+        pthread_rwlock_wrlock(&engine->lock);
+        if (!engine->model_loaded && engine->lazy && load_model_locked(engine) != EMBEDDING_STATUS_OK) {
+            engine->lazy = false;   // Do not retry a broken model on every call
+        }
+        pthread_rwlock_unlock(&engine->lock);
+        pthread_rwlock_rdlock(&engine->lock);
+    }
+
+    if (!engine->model_loaded) {
+        pthread_rwlock_unlock(&engine->lock);
+        return false;
+    }
+    return true;
+}
+
+static void end_use(EmbeddingEngine *engine)
+{
+    pthread_rwlock_unlock(&engine->lock);
+}
+
 // Generate a deterministic pseudo-random embedding based on text hash
 // This is a STUB - used as fallback when real models are not available
 static void generate_stub_embedding(const char *text, float *output)
@@ -145,6 +485,16 @@ static void generate_stub_embedding(const char *text, float *output)
     generate_stub_embedding_from_hash(djb2_hash(text), output, EMBEDDING_DIMENSION);
 }
 
+// Stub embedding of a tokenized text, hashed from its ids
+static void generate_stub_embedding_from_tokens(const int32_t *tokens, int count, float *output)
+{
+    unsigned long hash = 5381;
+    for (int i = 0; i < count; i++) {
+        hash = hash * 33 + (unsigned long)tokens[i];
+    }
+    generate_stub_embedding_from_hash(hash, output, EMBEDDING_DIMENSION);
+}
+
 // Normalize embedding vector to unit length
 static void normalize_embedding(float *embedding, int dimension)
 {
@@ -169,11 +519,6 @@ EmbeddingResult embedding_generate(EmbeddingEngine *engine, const char *text)
         return result;
     }
 
-    if (!engine->model_loaded) {
-        result.status = EMBEDDING_STATUS_NOT_INITIALIZED;
-        return result;
-    }
-
     if (text == NULL) {
         result.status = EMBEDDING_STATUS_INFERENCE_ERROR;
         return result;
@@ -185,13 +530,32 @@ EmbeddingResult embedding_generate(EmbeddingEngine *engine, const char *text)
         return result;
     }
 
+    if (!begin_use(engine)) {
+        result.status = EMBEDDING_STATUS_NOT_INITIALIZED;
+        return result;
+    }
+
     // Measure inference time
     clock_t start = clock();
 
 #ifdef FINDER_PLUS_AI_MODELS
+#ifdef EMBEDDINGS_COREML
+    if (engine->coreml != NULL && encode_coreml(engine, &text, NULL, NULL, 1, result.embedding)) {
+        normalize_embedding(result.embedding, EMBEDDING_DIMENSION);
+    } else
+#endif
     if (engine->bert_ctx != NULL) {
-        // Real bert.cpp inference
-        bert_encode(engine->bert_ctx, engine->n_threads, text, result.embedding);
+        // Real bert.cpp inference, tokenized here unless the vocabulary is unreadable
+        WordPiece *tokenizer = tokenizer_locked(engine);
+        int32_t tokens[EMBEDDING_MAX_TOKENS];
+        int threads = compute_budget_acquire(engine->n_threads);
+        if (tokenizer != NULL) {
+            int n_tokens = wordpiece_tokenize(tokenizer, text, text_len, tokens, EMBEDDING_MAX_TOKENS);
+            bert_eval(engine->bert_ctx, threads, tokens, n_tokens, result.embedding);
+        } else {
+            bert_encode(engine->bert_ctx, threads, text, result.embedding);
+        }
+        compute_budget_release(threads);
         // Normalize to unit vector for consistent cosine similarity
         normalize_embedding(result.embedding, EMBEDDING_DIMENSION);
     } else {
@@ -203,6 +567,8 @@ EmbeddingResult embedding_generate(EmbeddingEngine *engine, const char *text)
     generate_stub_embedding(text, result.embedding);
 #endif
 
+    end_use(engine);
+
     clock_t end = clock();
     result.inference_time_ms = (float)(end - start) * 1000.0f / CLOCKS_PER_SEC;
     result.status = EMBEDDING_STATUS_OK;
@@ -210,26 +576,20 @@ EmbeddingResult embedding_generate(EmbeddingEngine *engine, const char *text)
     return result;
 }
 
-BatchEmbeddingResult embedding_generate_batch(EmbeddingEngine *engine,
-                                               const char **texts,
-                                               int count)
+// Helper: inference threads for a batch, within the cap indexing set
+static int batch_threads(EmbeddingEngine *engine)
 {
-    BatchEmbeddingResult result = {0};
-
-    if (engine == NULL || !engine->initialized) {
-        result.status = EMBEDDING_STATUS_NOT_INITIALIZED;
-        return result;
-    }
-
-    if (!engine->model_loaded) {
-        result.status = EMBEDDING_STATUS_NOT_INITIALIZED;
-        return result;
+    int threads = atomic_load(&engine->batch_threads);
+    if (threads <= 0 || threads > engine->n_threads) {
+        threads = engine->n_threads;
     }
+    return threads;
+}
 
-    if (texts == NULL || count <= 0) {
-        result.status = EMBEDDING_STATUS_INFERENCE_ERROR;
-        return result;
-    }
+// Helper: batch inference with the model held
+static BatchEmbeddingResult generate_batch_locked(EmbeddingEngine *engine, const char **texts, int count)
+{
+    BatchEmbeddingResult result = {0};
 
     // Allocate memory for all embeddings
     result.embeddings = calloc((size_t)count * EMBEDDING_DIMENSION, sizeof(float));
@@ -241,6 +601,16 @@ BatchEmbeddingResult embedding_generate_batch(EmbeddingEngine *engine,
     clock_t start = clock();
 
 #ifdef FINDER_PLUS_AI_MODELS
+#ifdef EMBEDDINGS_COREML
+    if (engine->coreml != NULL && encode_coreml(engine, texts, NULL, NULL, count, result.embeddings)) {
+        for (int i = 0; i < count; i++) {
+            if (texts[i] != NULL) {
+                normalize_embedding(&result.embeddings[i * EMBEDDING_DIMENSION], EMBEDDING_DIMENSION);
+                result.count++;
+            }
+        }
+    } else
+#endif
     if (engine->bert_ctx != NULL) {
         // Allocate array of embedding pointers for bert_encode_batch
         float **emb_ptrs = malloc(count * sizeof(float*));
@@ -258,7 +628,9 @@ BatchEmbeddingResult embedding_generate_batch(EmbeddingEngine *engine,
 
         // Use bert.cpp batch encoding
         int batch_size = engine->config.batch_size > 0 ? engine->config.batch_size : 32;
-        bert_encode_batch(engine->bert_ctx, engine->n_threads, batch_size, count, texts, emb_ptrs);
+        int threads = compute_budget_acquire(batch_threads(engine));
+        bert_encode_batch(engine->bert_ctx, threads, batch_size, count, texts, emb_ptrs);
+        compute_budget_release(threads);
 
         // Normalize all embeddings
         for (int i = 0; i < count; i++) {
@@ -281,6 +653,7 @@ BatchEmbeddingResult embedding_generate_batch(EmbeddingEngine *engine,
     }
 #else
     // Stub mode: generate embeddings for each text
+    (void)engine;
     for (int i = 0; i < count; i++) {
         if (texts[i] == NULL) {
             continue;
@@ -303,6 +676,166 @@ BatchEmbeddingResult embedding_generate_batch(EmbeddingEngine *engine,
     return result;
 }
 
+BatchEmbeddingResult embedding_generate_batch(EmbeddingEngine *engine,
+                                               const char **texts,
+                                               int count)
+{
+    BatchEmbeddingResult result = {0};
+
+    if (engine == NULL || !engine->initialized) {
+        result.status = EMBEDDING_STATUS_NOT_INITIALIZED;
+        return result;
+    }
+
+    if (texts == NULL || count <= 0) {
+        result.status = EMBEDDING_STATUS_INFERENCE_ERROR;
+        return result;
+    }
+
+    if (!begin_use(engine)) {
+        result.status = EMBEDDING_STATUS_NOT_INITIALIZED;
+        return result;
+    }
+    result = generate_batch_locked(engine, texts, count);
+    end_use(engine);
+    return result;
+}
+
+int embedding_tokenize(EmbeddingEngine *engine, const char *text, size_t length,
+                       int32_t *tokens, int max_tokens)
+{
+    if (engine == NULL || !engine->initialized || text == NULL || tokens == NULL) {
+        return -1;
+    }
+
+#ifdef FINDER_PLUS_AI_MODELS
+    pthread_rwlock_rdlock(&engine->lock);
+    WordPiece *tokenizer = tokenizer_locked(engine);
+    int count = tokenizer != NULL ? wordpiece_tokenize(tokenizer, text, length, tokens, max_tokens) : -1;
+    pthread_rwlock_unlock(&engine->lock);
+    return count;
+#else
+    // Stub embeddings hash the text, so they are made from texts only
+    (void)length;
+    (void)max_tokens;
+    return -1;
+#endif
+}
+
+// Helper: inference on tokenized texts with the model held
+static BatchEmbeddingResult generate_batch_tokens_locked(EmbeddingEngine *engine, const int32_t *const *tokens,
+                                                         const int *counts, int count)
+{
+    BatchEmbeddingResult result = {0};
+    result.embeddings = calloc((size_t)count * EMBEDDING_DIMENSION, sizeof(float));
+    if (result.embeddings == NULL) {
+        result.status = EMBEDDING_STATUS_MEMORY_ERROR;
+        return result;
+    }
+
+    clock_t start = clock();
+
+#ifdef FINDER_PLUS_AI_MODELS
+#ifdef EMBEDDINGS_COREML
+    bool encoded = engine->coreml != NULL && encode_coreml(engine, NULL, tokens, counts, count, result.embeddings);
+#else
+    bool encoded = false;
+#endif
+    if (!encoded && engine->bert_ctx != NULL) {
+        int capacity = engine->batch_capacity > 0 ? engine->batch_capacity : 1;
+        bert_vocab_id **rows = malloc((size_t)capacity * sizeof(bert_vocab_id *));
+        int32_t *row_counts = malloc((size_t)capacity * sizeof(int32_t));
+        float **outputs = malloc((size_t)capacity * sizeof(float *));
+        if (rows == NULL || row_counts == NULL || outputs == NULL) {
+            free(rows);
+            free(row_counts);
+            free(outputs);
+            free(result.embeddings);
+            result.embeddings = NULL;
+            result.status = EMBEDDING_STATUS_MEMORY_ERROR;
+            return result;
+        }
+
+        int threads = compute_budget_acquire(batch_threads(engine));
+        for (int start_index = 0; start_index < count; start_index += capacity) {
+            int n = 0;
+            for (int i = start_index; i < count && i < start_index + capacity; i++) {
+                if (tokens[i] == NULL || counts[i] <= 0) {
+                    continue;
+                }
+                // bert.cpp only reads the ids
+                rows[n] = (bert_vocab_id *)tokens[i];
+                row_counts[n] = counts[i];
+                outputs[n++] = &result.embeddings[(size_t)i * EMBEDDING_DIMENSION];
+            }
+            if (n > 0) {
+                bert_eval_batch(engine->bert_ctx, threads, n, rows, row_counts, outputs);
+            }
+        }
+        compute_budget_release(threads);
+
+        free(rows);
+        free(row_counts);
+        free(outputs);
+        encoded = true;
+    }
+    for (int i = 0; i < count; i++) {
+        if (tokens[i] == NULL || counts[i] <= 0) {
+            continue;
+        }
+        float *embedding = &result.embeddings[(size_t)i * EMBEDDING_DIMENSION];
+        if (encoded) {
+            normalize_embedding(embedding, EMBEDDING_DIMENSION);
+        } else {
+            // Fallback to stub
+            generate_stub_embedding_from_tokens(tokens[i], counts[i], embedding);
+        }
+        result.count++;
+    }
+#else
+    // Stub mode: embedding_tokenize never succeeds, but ids still hash to something
+    (void)engine;
+    for (int i = 0; i < count; i++) {
+        if (tokens[i] == NULL || counts[i] <= 0) {
+            continue;
+        }
+        generate_stub_embedding_from_tokens(tokens[i], counts[i], &result.embeddings[(size_t)i * EMBEDDING_DIMENSION]);
+        result.count++;
+    }
+#endif
+
+    clock_t end = clock();
+    result.total_time_ms = (float)(end - start) * 1000.0f / CLOCKS_PER_SEC;
+    result.status = EMBEDDING_STATUS_OK;
+    return result;
+}
+
+BatchEmbeddingResult embedding_generate_batch_tokens(EmbeddingEngine *engine,
+                                                      const int32_t *const *tokens,
+                                                      const int *counts,
+                                                      int count)
+{
+    BatchEmbeddingResult result = {0};
+
+    if (engine == NULL || !engine->initialized) {
+        result.status = EMBEDDING_STATUS_NOT_INITIALIZED;
+        return result;
+    }
+
+    if (tokens == NULL || counts == NULL || count <= 0) {
+        result.status = EMBEDDING_STATUS_INFERENCE_ERROR;
+        return result;
+    }
+
+    if (!begin_use(engine)) {
+        result.status = EMBEDDING_STATUS_NOT_INITIALIZED;
+        return result;
+    }
+    result = generate_batch_tokens_locked(engine, tokens, counts, count);
+    end_use(engine);
+    return result;
+}
+
 void batch_embedding_result_free(BatchEmbeddingResult *result)
 {
     if (result == NULL) {
@@ -318,7 +851,7 @@ void batch_embedding_result_free(BatchEmbeddingResult *result)
 
 float embedding_cosine_similarity(const float *a, const float *b)
 {
-    return cosine_similarity(a, b, EMBEDDING_DIMENSION);
+    return vector_cosine(a, b, EMBEDDING_DIMENSION);
 }
 
 const char* embedding_status_message(EmbeddingStatus status)
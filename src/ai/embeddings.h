@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 // Embedding dimension for all-MiniLM-L6-v2 model
 #define EMBEDDING_DIMENSION 384
@@ -10,6 +11,9 @@
 // Maximum text length for embedding (in characters)
 #define EMBEDDING_MAX_TEXT_LEN 8192
 
+// Most tokens a text is cut to (the model's sequence length may be shorter)
+#define EMBEDDING_MAX_TOKENS 512
+
 // Embedding engine status
 typedef enum EmbeddingStatus {
     EMBEDDING_STATUS_OK = 0,
@@ -59,12 +63,30 @@ void embedding_engine_destroy(EmbeddingEngine *engine);
 // Load model (lazy loading - call before first embedding)
 EmbeddingStatus embedding_engine_load_model(EmbeddingEngine *engine, const char *model_path);
 
+// Remember a model to load on first use instead of loading it now (fails only if the
+// file is missing). Such a model may be trimmed when idle and loads again when needed
+EmbeddingStatus embedding_engine_load_model_lazily(EmbeddingEngine *engine, const char *model_path);
+
 // Unload model to free memory
 void embedding_engine_unload_model(EmbeddingEngine *engine);
 
+// Unload a lazily loaded model unused for idle_sec; returns whether it was unloaded.
+// An engine busy with inference is skipped
+bool embedding_engine_trim(EmbeddingEngine *engine, double idle_sec);
+
 // Check if model is loaded
 bool embedding_engine_is_loaded(const EmbeddingEngine *engine);
 
+// Check if embeddings can be generated (model loaded, or loads on first use)
+bool embedding_engine_is_available(const EmbeddingEngine *engine);
+
+// Inference threads the engine was configured with
+int embedding_engine_get_threads(const EmbeddingEngine *engine);
+
+// Cap the threads batch inference uses (background indexing); 0 lifts the cap.
+// Single-text queries keep the configured count. Safe to call from any thread
+void embedding_engine_set_batch_threads(EmbeddingEngine *engine, int threads);
+
 // Generate embedding for a single text
 EmbeddingResult embedding_generate(EmbeddingEngine *engine, const char *text);
 
@@ -73,6 +95,21 @@ BatchEmbeddingResult embedding_generate_batch(EmbeddingEngine *engine,
                                                const char **texts,
                                                int count);
 
+// Tokenize length bytes of text as the model reads it into at most max_tokens ids,
+// [CLS] and [SEP] included. Returns the count, or -1 without a tokenizer (stub builds,
+// or no readable model). Does not load the model, and is safe to call from any thread
+// alongside inference
+int embedding_tokenize(EmbeddingEngine *engine, const char *text, size_t length,
+                       int32_t *tokens, int max_tokens);
+
+// Generate embeddings for texts already tokenized by embedding_tokenize: counts[i] ids
+// at tokens[i] (NULL entries are skipped). Batches pad to their longest text, so texts
+// of similar length belong together
+BatchEmbeddingResult embedding_generate_batch_tokens(EmbeddingEngine *engine,
+                                                      const int32_t *const *tokens,
+                                                      const int *counts,
+                                                      int count);
+
 // Free batch embedding result
 void batch_embedding_result_free(BatchEmbeddingResult *result);
 
@@ -0,0 +1,455 @@
+#include "extract_pool.h"
+#include "platform/pdf.h"
+#include "platform/rich_text.h"
+#include "utils/file_type.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <mach-o/dyld.h>
+
+// From <sandbox.h>, whose declarations are marked deprecated; the call is still how a
+// plain executable sandboxes itself
+int sandbox_init(const char *profile, uint64_t flags, char **errorbuf);
+void sandbox_free_error(char *errorbuf);
+#endif
+
+extern char **environ;
+
+#define EXTRACT_DEFAULT_MAX_JOBS 200
+#define EXTRACT_DEFAULT_MAX_MEMORY ((size_t)512 * 1024 * 1024)
+#define EXTRACT_DEFAULT_TIMEOUT 30
+#define EXTRACT_PATH_MAX 4096
+
+// Worker profile: reads anywhere (the documents), no network, writes only to the
+// temporary folders the parsers keep caches in
+#define EXTRACT_SANDBOX_PROFILE \
+    "(version 1)" \
+    "(allow default)" \
+    "(deny network*)" \
+    "(deny file-write*)" \
+    "(allow file-write* (subpath \"/private/var/folders\") (subpath \"/private/tmp\") (literal \"/dev/null\"))"
+
+// Messages on the socket between the pool and a worker; both ends are this executable
+typedef struct ExtractRequest {
+    uint32_t path_length;               // Path bytes that follow, without a NUL
+    uint32_t reserved;
+    uint64_t max_bytes;
+} ExtractRequest;
+
+typedef struct ExtractReply {
+    uint32_t has_text;
+    uint32_t reserved;
+    uint64_t peak_memory;               // Worker's peak resident bytes so far
+    uint64_t length;                    // Text bytes that follow
+} ExtractReply;
+
+typedef struct ExtractWorker {
+    pid_t pid;                          // 0 = slot free
+    int fd;
+    int jobs;
+    bool busy;
+} ExtractWorker;
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    bool started;
+    ExtractPoolConfig config;
+    ExtractWorker workers[EXTRACT_POOL_MAX_WORKERS];
+    ExtractPoolStats stats;
+} g_pool = { .mutex = PTHREAD_MUTEX_INITIALIZER, .changed = PTHREAD_COND_INITIALIZER };
+
+void extract_pool_default_config(ExtractPoolConfig *config)
+{
+    if (!config) return;
+    memset(config, 0, sizeof(*config));
+    config->max_workers = 0;
+    config->max_jobs = EXTRACT_DEFAULT_MAX_JOBS;
+    config->max_memory = EXTRACT_DEFAULT_MAX_MEMORY;
+    config->timeout_sec = EXTRACT_DEFAULT_TIMEOUT;
+}
+
+// Helper: Write all of length bytes; false on error, timeout or a closed peer
+static bool extract_write_all(int fd, const void *data, size_t length)
+{
+    const char *p = data;
+    while (length > 0) {
+#ifdef MSG_NOSIGNAL
+        ssize_t written = send(fd, p, length, MSG_NOSIGNAL);
+#else
+        ssize_t written = write(fd, p, length);
+#endif
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        p += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+// Helper: Read exactly length bytes; false on error, timeout or end of stream
+static bool extract_read_all(int fd, void *data, size_t length)
+{
+    char *p = data;
+    while (length > 0) {
+        ssize_t got = read(fd, p, length);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        p += got;
+        length -= (size_t)got;
+    }
+    return true;
+}
+
+// Helper: Take a document's text in this process
+static bool extract_here(const char *path, size_t max_bytes, char **text, size_t *length)
+{
+    uint8_t traits = file_type_info(file_type_from_path(path))->traits;
+    if (traits & FILE_TRAIT_PDF) {
+        return platform_pdf_text(path, max_bytes, text, length);
+    }
+    if (traits & FILE_TRAIT_RICH_TEXT) {
+        return platform_rich_text(path, max_bytes, text, length);
+    }
+    return false;
+}
+
+bool extract_pool_handles(const char *path)
+{
+    if (!path) return false;
+    const char *slash = strrchr(path, '/');
+    const char *dot = strrchr(slash ? slash + 1 : path, '.');
+    if (!dot) return false;
+    return (file_type_info(file_type_from_extension(dot))->traits & (FILE_TRAIT_PDF | FILE_TRAIT_RICH_TEXT)) != 0;
+}
+
+// Helper: Full path of this executable
+static bool extract_own_executable(char *out, size_t size)
+{
+#ifdef __APPLE__
+    char raw[EXTRACT_PATH_MAX];
+    uint32_t raw_size = sizeof(raw);
+    if (_NSGetExecutablePath(raw, &raw_size) != 0) return false;
+    char resolved[PATH_MAX];
+    if (!realpath(raw, resolved) || strlen(resolved) >= size) return false;
+    strcpy(out, resolved);
+    return true;
+#else
+    ssize_t n = readlink("/proc/self/exe", out, size - 1);
+    if (n <= 0 || (size_t)n >= size - 1) return false;
+    out[n] = '\0';
+    return true;
+#endif
+}
+
+bool extract_pool_start(const ExtractPoolConfig *config)
+{
+    ExtractPoolConfig use;
+    if (config) {
+        use = *config;
+    } else {
+        extract_pool_default_config(&use);
+    }
+    if (use.worker_path[0] == '\0' && !extract_own_executable(use.worker_path, sizeof(use.worker_path))) {
+        return false;
+    }
+    if (use.max_workers <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        use.max_workers = cores > 0 ? (int)cores : 1;
+    }
+    if (use.max_workers > EXTRACT_POOL_MAX_WORKERS) use.max_workers = EXTRACT_POOL_MAX_WORKERS;
+    if (use.max_jobs <= 0) use.max_jobs = EXTRACT_DEFAULT_MAX_JOBS;
+    if (use.max_memory == 0) use.max_memory = EXTRACT_DEFAULT_MAX_MEMORY;
+    if (use.timeout_sec <= 0) use.timeout_sec = EXTRACT_DEFAULT_TIMEOUT;
+
+    extract_pool_stop();
+    pthread_mutex_lock(&g_pool.mutex);
+    g_pool.config = use;
+    memset(&g_pool.stats, 0, sizeof(g_pool.stats));
+    g_pool.started = true;
+    pthread_mutex_unlock(&g_pool.mutex);
+    return true;
+}
+
+// Helper: End a worker that is not reading a document (or has to be stopped mid-way)
+static void extract_retire(pid_t pid, int fd)
+{
+    close(fd);
+    kill(pid, SIGKILL);
+    while (waitpid(pid, NULL, 0) < 0 && errno == EINTR) {
+    }
+}
+
+void extract_pool_stop(void)
+{
+    ExtractWorker stopping[EXTRACT_POOL_MAX_WORKERS];
+    int count = 0;
+
+    pthread_mutex_lock(&g_pool.mutex);
+    g_pool.started = false;
+    pthread_cond_broadcast(&g_pool.changed);
+    for (;;) {
+        bool busy = false;
+        for (int i = 0; i < EXTRACT_POOL_MAX_WORKERS; i++) {
+            busy = busy || g_pool.workers[i].busy;
+        }
+        if (!busy) break;
+        pthread_cond_wait(&g_pool.changed, &g_pool.mutex);
+    }
+    for (int i = 0; i < EXTRACT_POOL_MAX_WORKERS; i++) {
+        if (g_pool.workers[i].pid > 0) {
+            stopping[count++] = g_pool.workers[i];
+        }
+        memset(&g_pool.workers[i], 0, sizeof(ExtractWorker));
+    }
+    pthread_mutex_unlock(&g_pool.mutex);
+
+    for (int i = 0; i < count; i++) {
+        extract_retire(stopping[i].pid, stopping[i].fd);
+    }
+}
+
+// Helper: Start a worker in a free slot (pool locked); false if it cannot be spawned
+static bool extract_spawn(ExtractWorker *worker)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return false;
+    }
+    // Neither end leaks into other children; the worker's copies on stdin and stdout
+    // are made by dup2, which clears the flag
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+    setsockopt(fds[1], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_init(&attr);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+#ifdef POSIX_SPAWN_CLOEXEC_DEFAULT
+    // Nothing else the app has open reaches the worker, but its stderr
+    posix_spawn_file_actions_addinherit_np(&actions, STDERR_FILENO);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_CLOEXEC_DEFAULT);
+#endif
+
+    char *argv[] = { g_pool.config.worker_path, EXTRACT_WORKER_ARG, NULL };
+    pid_t pid;
+    int rc = posix_spawn(&pid, g_pool.config.worker_path, &actions, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(fds[1]);
+    if (rc != 0) {
+        close(fds[0]);
+        return false;
+    }
+
+    // A document that takes longer than this hangs its worker
+    struct timeval timeout = { g_pool.config.timeout_sec, 0 };
+    setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    worker->pid = pid;
+    worker->fd = fds[0];
+    worker->jobs = 0;
+    worker->busy = false;
+    g_pool.stats.started++;
+    return true;
+}
+
+// Helper: Take an idle worker, starting one if there is room, or wait for one; NULL if
+// the pool is stopped or no worker can be started
+static ExtractWorker *extract_acquire(void)
+{
+    pthread_mutex_lock(&g_pool.mutex);
+    for (;;) {
+        if (!g_pool.started) {
+            pthread_mutex_unlock(&g_pool.mutex);
+            return NULL;
+        }
+
+        ExtractWorker *free_slot = NULL;
+        int live = 0;
+        for (int i = 0; i < EXTRACT_POOL_MAX_WORKERS; i++) {
+            ExtractWorker *worker = &g_pool.workers[i];
+            if (worker->pid == 0) {
+                if (!free_slot) free_slot = worker;
+                continue;
+            }
+            if (!worker->busy) {
+                worker->busy = true;
+                pthread_mutex_unlock(&g_pool.mutex);
+                return worker;
+            }
+            live++;
+        }
+
+        if (free_slot && live < g_pool.config.max_workers) {
+            bool spawned = extract_spawn(free_slot);
+            if (spawned) free_slot->busy = true;
+            pthread_mutex_unlock(&g_pool.mutex);
+            return spawned ? free_slot : NULL;
+        }
+        pthread_cond_wait(&g_pool.changed, &g_pool.mutex);
+    }
+}
+
+// Helper: Hand a worker back after a document; it is ended if it died or overran, or
+// replaced by a fresh one later if it has done its share or grown too large
+static void extract_release(ExtractWorker *worker, bool alive, uint64_t peak_memory)
+{
+    pthread_mutex_lock(&g_pool.mutex);
+    worker->jobs++;
+    bool retire = !alive || worker->jobs >= g_pool.config.max_jobs || peak_memory > g_pool.config.max_memory;
+    pid_t pid = worker->pid;
+    int fd = worker->fd;
+    if (alive) {
+        g_pool.stats.documents++;
+    }
+    if (retire) {
+        if (alive) {
+            g_pool.stats.replaced++;
+        } else {
+            g_pool.stats.failed++;
+        }
+        memset(worker, 0, sizeof(ExtractWorker));
+    }
+    worker->busy = false;
+    pthread_cond_broadcast(&g_pool.changed);
+    pthread_mutex_unlock(&g_pool.mutex);
+
+    if (retire) {
+        extract_retire(pid, fd);
+    }
+}
+
+// Helper: Have a worker read one document; *alive is false if it crashed, overran or
+// broke the protocol
+static bool extract_request(ExtractWorker *worker, const char *path, size_t max_bytes,
+                            char **text, size_t *length, bool *alive, uint64_t *peak_memory)
+{
+    *alive = false;
+    *peak_memory = 0;
+    ExtractRequest request = { (uint32_t)strlen(path), 0, max_bytes };
+    ExtractReply reply;
+    if (!extract_write_all(worker->fd, &request, sizeof(request)) ||
+        !extract_write_all(worker->fd, path, request.path_length) ||
+        !extract_read_all(worker->fd, &reply, sizeof(reply)) ||
+        reply.length > max_bytes) {
+        return false;
+    }
+    *peak_memory = reply.peak_memory;
+    if (!reply.has_text) {
+        *alive = true;
+        return false;
+    }
+
+    char *out = malloc((size_t)reply.length + 1);
+    if (!out || !extract_read_all(worker->fd, out, (size_t)reply.length)) {
+        free(out);
+        return false;
+    }
+    out[reply.length] = '\0';
+    *alive = true;
+    *text = out;
+    if (length) *length = (size_t)reply.length;
+    return true;
+}
+
+bool extract_pool_text(const char *path, size_t max_bytes, char **text, size_t *length)
+{
+    if (!text) return false;
+    *text = NULL;
+    if (!path || max_bytes == 0 || strlen(path) >= EXTRACT_PATH_MAX || !extract_pool_handles(path)) {
+        return false;
+    }
+
+    ExtractWorker *worker = extract_acquire();
+    if (!worker) {
+        return extract_here(path, max_bytes, text, length);
+    }
+    bool alive;
+    uint64_t peak_memory;
+    bool ok = extract_request(worker, path, max_bytes, text, length, &alive, &peak_memory);
+    extract_release(worker, alive, peak_memory);
+    return ok;
+}
+
+void extract_pool_get_stats(ExtractPoolStats *stats)
+{
+    if (!stats) return;
+    pthread_mutex_lock(&g_pool.mutex);
+    *stats = g_pool.stats;
+    stats->workers = 0;
+    for (int i = 0; i < EXTRACT_POOL_MAX_WORKERS; i++) {
+        stats->workers += g_pool.workers[i].pid > 0;
+    }
+    pthread_mutex_unlock(&g_pool.mutex);
+}
+
+// Helper: Peak resident bytes of this process
+static uint64_t extract_peak_memory(void)
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (uint64_t)usage.ru_maxrss;
+#else
+    return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+int extract_worker_run(void)
+{
+#ifdef __APPLE__
+    char *error = NULL;
+    if (sandbox_init(EXTRACT_SANDBOX_PROFILE, 0, &error) != 0) {
+        fprintf(stderr, "Extract worker: sandbox unavailable: %s\n", error ? error : "unknown error");
+        sandbox_free_error(error);
+        return 1;
+    }
+#endif
+
+    // Until the pool closes the socket
+    ExtractRequest request;
+    while (extract_read_all(STDIN_FILENO, &request, sizeof(request))) {
+        char path[EXTRACT_PATH_MAX];
+        if (request.path_length == 0 || request.path_length >= sizeof(path) ||
+            !extract_read_all(STDIN_FILENO, path, request.path_length)) {
+            return 1;
+        }
+        path[request.path_length] = '\0';
+
+        char *text = NULL;
+        size_t length = 0;
+        bool ok = extract_here(path, (size_t)request.max_bytes, &text, &length);
+        ExtractReply reply = { ok, 0, extract_peak_memory(), ok ? length : 0 };
+        bool sent = extract_write_all(STDOUT_FILENO, &reply, sizeof(reply)) &&
+                    (!ok || extract_write_all(STDOUT_FILENO, text, length));
+        free(text);
+        if (!sent) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef EXTRACT_POOL_H
+#define EXTRACT_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Text of documents (PDF, Word, RTF, OpenDocument) taken in worker processes. The
+// system parsers behind them read whatever a file holds, so a malformed document
+// crashes or hangs a worker instead of the app or the indexing pipeline. Workers are
+// this executable started with EXTRACT_WORKER_ARG, sandboxed without network access
+// or writes to files, one per reader at most; each reads one document at a time and is
+// replaced after a number of documents or once it has grown past a memory limit. A
+// worker that dies or overruns its time is killed and its document skipped. Until the
+// pool is started, or if no worker can be started, documents are read in this process
+
+// Argument that turns the executable into a worker (see extract_worker_run)
+#define EXTRACT_WORKER_ARG "--extract-worker"
+
+// Most workers running at once
+#define EXTRACT_POOL_MAX_WORKERS 16
+
+typedef struct ExtractPoolConfig {
+    char worker_path[4096];     // Executable to run as a worker ("" = this one)
+    int max_workers;            // 0 = one per core, at most EXTRACT_POOL_MAX_WORKERS
+    int max_jobs;               // Documents a worker reads before it is replaced
+    size_t max_memory;          // Peak resident bytes after which a worker is replaced
+    int timeout_sec;            // Longest a document may take before its worker is killed
+} ExtractPoolConfig;
+
+typedef struct ExtractPoolStats {
+    int workers;                // Running now
+    int started;                // Since the pool was started
+    int replaced;               // Retired after max_jobs documents or max_memory
+    int failed;                 // Killed after crashing or overrunning timeout_sec
+    int documents;              // Read by workers
+} ExtractPoolStats;
+
+// Get the default configuration
+void extract_pool_default_config(ExtractPoolConfig *config);
+
+// Read documents in worker processes from now on (config NULL = defaults). Workers start
+// when first needed. False if the executable cannot be found
+bool extract_pool_start(const ExtractPoolConfig *config);
+
+// Stop the workers, waiting for documents being read; later documents are read in this
+// process again
+void extract_pool_stop(void);
+
+// Whether a file is a document whose text the pool takes (by its extension)
+bool extract_pool_handles(const char *path);
+
+// Text of a document, cut at max_bytes (UTF-8). *text is malloc'd and NUL-terminated;
+// false if it has none, cannot be read, or took its worker down. Blocks while every
+// worker is busy. Thread safe
+bool extract_pool_text(const char *path, size_t max_bytes, char **text, size_t *length);
+
+// Get counts since the pool was started
+void extract_pool_get_stats(ExtractPoolStats *stats);
+
+// Body of a worker process: read requests from stdin and answer them on stdout until
+// stdin closes. Returns the exit status
+int extract_worker_run(void);
+
+#endif // EXTRACT_POOL_H
@@ -0,0 +1,240 @@
+#include "hash_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sqlite3.h>
+
+struct HashCache {
+    sqlite3 *db;
+    pthread_mutex_t mutex;      // One connection, shared by scans and the file watcher
+
+    sqlite3_stmt *stmt_lookup;
+    sqlite3_stmt *stmt_store;
+    sqlite3_stmt *stmt_invalidate;
+};
+
+// The inode is the identity; size and mtime must still match for a hit. Paths are
+// unique too, so storing a replaced file's new inode evicts the old entry
+static const char *SQL_CREATE =
+    "CREATE TABLE IF NOT EXISTS file_hashes ("
+    "  device INTEGER NOT NULL,"
+    "  inode INTEGER NOT NULL,"
+    "  size INTEGER NOT NULL,"
+    "  mtime INTEGER NOT NULL,"
+    "  path TEXT NOT NULL,"
+    "  flags INTEGER NOT NULL,"
+    "  partial_bytes INTEGER NOT NULL,"
+    "  partial INTEGER NOT NULL,"
+    "  full INTEGER NOT NULL,"
+    "  md5 BLOB,"
+    "  sha256 BLOB,"
+    "  PRIMARY KEY (device, inode)"
+    ") WITHOUT ROWID;"
+    "CREATE UNIQUE INDEX IF NOT EXISTS idx_hash_path ON file_hashes(path);";
+
+static const char *SQL_LOOKUP =
+    "SELECT flags, partial_bytes, partial, full, md5, sha256 FROM file_hashes "
+    "WHERE device = ? AND inode = ? AND size = ? AND mtime = ?;";
+
+static const char *SQL_STORE =
+    "INSERT OR REPLACE INTO file_hashes "
+    "(device, inode, size, mtime, path, flags, partial_bytes, partial, full, md5, sha256) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+
+// The path itself, then the range of paths below it ('0' sorts right after '/')
+static const char *SQL_INVALIDATE =
+    "DELETE FROM file_hashes WHERE path = ?1 "
+    "OR (path > ?1 || '/' AND path < ?1 || '0');";
+
+HashCache* hash_cache_open(const char *db_path)
+{
+    if (db_path == NULL) {
+        return NULL;
+    }
+
+    HashCache *cache = calloc(1, sizeof(HashCache));
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    if (sqlite3_open(db_path, &cache->db) != SQLITE_OK) {
+        sqlite3_close(cache->db);
+        free(cache);
+        return NULL;
+    }
+
+    // Losing the last few entries in a crash only costs a rehash
+    sqlite3_exec(cache->db, "PRAGMA journal_mode=WAL;", NULL, NULL, NULL);
+    sqlite3_exec(cache->db, "PRAGMA synchronous=NORMAL;", NULL, NULL, NULL);
+
+    if (sqlite3_exec(cache->db, SQL_CREATE, NULL, NULL, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(cache->db, SQL_LOOKUP, -1, &cache->stmt_lookup, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(cache->db, SQL_STORE, -1, &cache->stmt_store, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(cache->db, SQL_INVALIDATE, -1, &cache->stmt_invalidate, NULL) != SQLITE_OK) {
+        sqlite3_finalize(cache->stmt_lookup);
+        sqlite3_finalize(cache->stmt_store);
+        sqlite3_finalize(cache->stmt_invalidate);
+        sqlite3_close(cache->db);
+        free(cache);
+        return NULL;
+    }
+
+    pthread_mutex_init(&cache->mutex, NULL);
+    return cache;
+}
+
+void hash_cache_close(HashCache *cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+
+    sqlite3_finalize(cache->stmt_lookup);
+    sqlite3_finalize(cache->stmt_store);
+    sqlite3_finalize(cache->stmt_invalidate);
+    sqlite3_close(cache->db);
+    pthread_mutex_destroy(&cache->mutex);
+    free(cache);
+}
+
+// Helper: bind the lookup key of a record
+static void bind_key(sqlite3_stmt *stmt, const HashCacheRecord *record)
+{
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)record->device);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)record->inode);
+    sqlite3_bind_int64(stmt, 3, (sqlite3_int64)record->size);
+    sqlite3_bind_int64(stmt, 4, (sqlite3_int64)record->mtime);
+}
+
+// Helper: copy a digest column if it has the expected size
+static bool read_digest(sqlite3_stmt *stmt, int column, uint8_t *out, int size)
+{
+    if (sqlite3_column_bytes(stmt, column) != size) {
+        return false;
+    }
+    const void *blob = sqlite3_column_blob(stmt, column);
+    if (blob == NULL) {
+        return false;
+    }
+    memcpy(out, blob, (size_t)size);
+    return true;
+}
+
+int hash_cache_lookup_batch(HashCache *cache, HashCacheRecord *records, int count)
+{
+    if (cache == NULL || records == NULL || count <= 0) {
+        return 0;
+    }
+
+    int hits = 0;
+    pthread_mutex_lock(&cache->mutex);
+    sqlite3_exec(cache->db, "BEGIN;", NULL, NULL, NULL);
+
+    for (int i = 0; i < count; i++) {
+        HashCacheRecord *record = &records[i];
+        record->flags = 0;
+
+        sqlite3_reset(cache->stmt_lookup);
+        bind_key(cache->stmt_lookup, record);
+        if (sqlite3_step(cache->stmt_lookup) != SQLITE_ROW) {
+            continue;
+        }
+
+        uint32_t flags = (uint32_t)sqlite3_column_int(cache->stmt_lookup, 0);
+        record->partial_bytes = (uint64_t)sqlite3_column_int64(cache->stmt_lookup, 1);
+        record->partial = (uint64_t)sqlite3_column_int64(cache->stmt_lookup, 2);
+        record->full = (uint64_t)sqlite3_column_int64(cache->stmt_lookup, 3);
+        if ((flags & HASH_CACHE_HAS_DIGESTS) &&
+            (!read_digest(cache->stmt_lookup, 4, record->md5, (int)sizeof(record->md5)) ||
+             !read_digest(cache->stmt_lookup, 5, record->sha256, (int)sizeof(record->sha256)))) {
+            flags &= ~HASH_CACHE_HAS_DIGESTS;
+        }
+
+        record->flags = flags;
+        if (flags != 0) hits++;
+    }
+
+    sqlite3_reset(cache->stmt_lookup);
+    sqlite3_exec(cache->db, "COMMIT;", NULL, NULL, NULL);
+    pthread_mutex_unlock(&cache->mutex);
+    return hits;
+}
+
+bool hash_cache_store_batch(HashCache *cache, const HashCacheRecord *records, int count)
+{
+    if (cache == NULL || records == NULL || count <= 0) {
+        return false;
+    }
+
+    bool ok = true;
+    pthread_mutex_lock(&cache->mutex);
+    sqlite3_exec(cache->db, "BEGIN;", NULL, NULL, NULL);
+
+    for (int i = 0; i < count; i++) {
+        const HashCacheRecord *record = &records[i];
+        if (record->flags == 0 || record->path == NULL) {
+            continue;
+        }
+
+        sqlite3_stmt *stmt = cache->stmt_store;
+        sqlite3_reset(stmt);
+        bind_key(stmt, record);
+        sqlite3_bind_text(stmt, 5, record->path, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 6, (int)record->flags);
+        sqlite3_bind_int64(stmt, 7, (sqlite3_int64)record->partial_bytes);
+        sqlite3_bind_int64(stmt, 8, (sqlite3_int64)record->partial);
+        sqlite3_bind_int64(stmt, 9, (sqlite3_int64)record->full);
+        if (record->flags & HASH_CACHE_HAS_DIGESTS) {
+            sqlite3_bind_blob(stmt, 10, record->md5, (int)sizeof(record->md5), SQLITE_TRANSIENT);
+            sqlite3_bind_blob(stmt, 11, record->sha256, (int)sizeof(record->sha256), SQLITE_TRANSIENT);
+        } else {
+            sqlite3_bind_null(stmt, 10);
+            sqlite3_bind_null(stmt, 11);
+        }
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            ok = false;
+        }
+    }
+
+    sqlite3_reset(cache->stmt_store);
+    if (sqlite3_exec(cache->db, "COMMIT;", NULL, NULL, NULL) != SQLITE_OK) {
+        sqlite3_exec(cache->db, "ROLLBACK;", NULL, NULL, NULL);
+        ok = false;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return ok;
+}
+
+void hash_cache_invalidate(HashCache *cache, const char *path)
+{
+    if (cache == NULL || path == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    sqlite3_reset(cache->stmt_invalidate);
+    sqlite3_bind_text(cache->stmt_invalidate, 1, path, -1, SQLITE_TRANSIENT);
+    sqlite3_step(cache->stmt_invalidate);
+    sqlite3_reset(cache->stmt_invalidate);
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+int hash_cache_count(HashCache *cache)
+{
+    if (cache == NULL) {
+        return 0;
+    }
+
+    int count = 0;
+    sqlite3_stmt *stmt;
+    pthread_mutex_lock(&cache->mutex);
+    if (sqlite3_prepare_v2(cache->db, "SELECT COUNT(*) FROM file_hashes;", -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            count = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return count;
+}
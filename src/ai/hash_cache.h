@@ -0,0 +1,52 @@
+#ifndef HASH_CACHE_H
+#define HASH_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Persistent content hashes keyed by (device, inode, size, mtime), so duplicate
+// scans of an unchanged library never read file contents again. The indexer's
+// file watcher drops entries for paths that change
+
+// Which hashes a record holds
+#define HASH_CACHE_HAS_PARTIAL 0x1u
+#define HASH_CACHE_HAS_FULL    0x2u
+#define HASH_CACHE_HAS_DIGESTS 0x4u     // md5 and sha256
+
+// One file's key and hashes
+typedef struct HashCacheRecord {
+    const char *path;           // Used to invalidate by path; not part of the key
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime;
+    uint32_t flags;             // HASH_CACHE_HAS_*, 0 for a miss
+    uint64_t partial_bytes;     // Head/tail length the partial hash was taken with
+    uint64_t partial;           // Fast hash of head and tail
+    uint64_t full;              // Fast hash of the whole file
+    uint8_t md5[16];
+    uint8_t sha256[32];
+} HashCacheRecord;
+
+// Hash cache context (opaque)
+typedef struct HashCache HashCache;
+
+// Open or create the cache database (":memory:" for a throwaway one)
+HashCache* hash_cache_open(const char *db_path);
+
+// Close the cache
+void hash_cache_close(HashCache *cache);
+
+// Fill the hashes of each record whose key matches; others get flags 0. Returns hits
+int hash_cache_lookup_batch(HashCache *cache, HashCacheRecord *records, int count);
+
+// Store records with nonzero flags in one transaction, replacing older entries for the same file
+bool hash_cache_store_batch(HashCache *cache, const HashCacheRecord *records, int count);
+
+// Forget a path and everything below it
+void hash_cache_invalidate(HashCache *cache, const char *path);
+
+// Number of cached files
+int hash_cache_count(HashCache *cache);
+
+#endif // HASH_CACHE_H
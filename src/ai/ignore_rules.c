@@ -0,0 +1,383 @@
+#include "ignore_rules.h"
+#include "../core/git.h"
+#include "../core/stat_cache.h"
+#include "../utils/exclude_set.h"
+
+#include <fnmatch.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHEDIR_SIGNATURE "Signature: 8a477f597d28d172789f06886806bc55"
+#define SEGMENT_MAX 256                 // Longer names never match an anchored pattern
+
+typedef struct IgnoreRule {
+    char *pattern;                      // Without '!', the anchoring '/' and a trailing '/'
+    bool negate;
+    bool dir_only;
+    bool anchored;                      // Against the path below the folder, not the name
+} IgnoreRule;
+
+typedef struct IgnoreFrame {
+    char *dir;
+    size_t dir_len;
+    bool in_repo;
+    IgnoreRule *rules;                  // In file order, .ignore after .gitignore
+    int rule_count;
+    int rule_capacity;
+    bool ordered;                       // Has '!' rules: tried one by one, last first
+    ExcludeSet *names;                  // Otherwise the name rules, compiled
+    ExcludeSet *dir_names;              // and those ending in '/'
+} IgnoreFrame;
+
+struct IgnoreStack {
+    IgnoreFrame *frames;
+    int count;
+    int capacity;
+};
+
+// Helper: Match a glob against a path folder by folder, "**" standing for any number of them
+static bool match_segments(const char *pattern, const char *path)
+{
+    if (pattern[0] == '*' && pattern[1] == '*' && (pattern[2] == '/' || pattern[2] == '\0')) {
+        if (pattern[2] == '\0') {
+            return true;
+        }
+        for (const char *p = path; p != NULL; p = strchr(p, '/'), p = p ? p + 1 : NULL) {
+            if (match_segments(pattern + 3, p)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const char *pattern_end = strchr(pattern, '/');
+    const char *path_end = strchr(path, '/');
+    size_t pattern_len = pattern_end ? (size_t)(pattern_end - pattern) : strlen(pattern);
+    size_t path_len = path_end ? (size_t)(path_end - path) : strlen(path);
+    if (pattern_len >= SEGMENT_MAX || path_len >= SEGMENT_MAX) {
+        return false;
+    }
+    char pattern_segment[SEGMENT_MAX];
+    char path_segment[SEGMENT_MAX];
+    memcpy(pattern_segment, pattern, pattern_len);
+    pattern_segment[pattern_len] = '\0';
+    memcpy(path_segment, path, path_len);
+    path_segment[path_len] = '\0';
+    if (fnmatch(pattern_segment, path_segment, 0) != 0) {
+        return false;
+    }
+
+    if (pattern_end == NULL || path_end == NULL) {
+        return pattern_end == NULL && path_end == NULL;
+    }
+    return match_segments(pattern_end + 1, path_end + 1);
+}
+
+static bool rule_matches(const IgnoreRule *rule, const char *relative, const char *name, bool is_dir)
+{
+    if (rule->dir_only && !is_dir) {
+        return false;
+    }
+    if (rule->anchored) {
+        return match_segments(rule->pattern, relative);
+    }
+    return fnmatch(rule->pattern, name, 0) == 0;
+}
+
+// Helper: Parse one line of an ignore file into the frame's rules
+static void add_rule_line(IgnoreFrame *frame, char *line)
+{
+    // Trailing spaces go unless escaped
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' ||
+                       (line[len - 1] == ' ' && (len < 2 || line[len - 2] != '\\')))) {
+        line[--len] = '\0';
+    }
+    if (len == 0 || line[0] == '#') {
+        return;
+    }
+
+    IgnoreRule rule = { 0 };
+    char *pattern = line;
+    if (pattern[0] == '!') {
+        rule.negate = true;
+        pattern++;
+    }
+    len = strlen(pattern);
+    if (len > 0 && pattern[len - 1] == '/') {
+        rule.dir_only = true;
+        pattern[--len] = '\0';
+    }
+    // "**/name" matches the name at any depth, as a pattern without '/' does
+    if (strncmp(pattern, "**/", 3) == 0 && strchr(pattern + 3, '/') == NULL) {
+        pattern += 3;
+    }
+    if (strchr(pattern, '/') != NULL) {
+        rule.anchored = true;
+        if (pattern[0] == '/') {
+            pattern++;
+        }
+    }
+    if (pattern[0] == '\0') {
+        return;
+    }
+
+    if (frame->rule_count == frame->rule_capacity) {
+        int capacity = frame->rule_capacity ? frame->rule_capacity * 2 : 16;
+        IgnoreRule *rules = realloc(frame->rules, (size_t)capacity * sizeof(IgnoreRule));
+        if (rules == NULL) {
+            return;
+        }
+        frame->rules = rules;
+        frame->rule_capacity = capacity;
+    }
+    rule.pattern = strdup(pattern);
+    if (rule.pattern == NULL) {
+        return;
+    }
+    frame->rules[frame->rule_count++] = rule;
+    frame->ordered |= rule.negate;
+}
+
+static void load_rules_file(IgnoreFrame *frame, const char *name)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", frame->dir_len > 1 ? frame->dir : "", name);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        add_rule_line(frame, line);
+    }
+    fclose(file);
+}
+
+// Helper: Whether a folder holds a cache marker (its content starts with the signature)
+static bool has_cache_marker(const char *dir)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/" IGNORE_CACHEDIR_TAG, dir);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+    char signature[sizeof(CACHEDIR_SIGNATURE)];
+    size_t read = fread(signature, 1, sizeof(signature) - 1, file);
+    fclose(file);
+    return read == sizeof(signature) - 1 && memcmp(signature, CACHEDIR_SIGNATURE, read) == 0;
+}
+
+static void frame_free(IgnoreFrame *frame)
+{
+    for (int i = 0; i < frame->rule_count; i++) {
+        free(frame->rules[i].pattern);
+    }
+    free(frame->rules);
+    exclude_set_destroy(frame->names);
+    exclude_set_destroy(frame->dir_names);
+    free(frame->dir);
+}
+
+// Helper: Push the first len bytes of dir, reading its files; false if it is a cache
+// (or memory ran out, which leaves the folder out as well)
+static bool push_frame(IgnoreStack *stack, const char *dir, size_t len, bool in_repo)
+{
+    if (stack->count == stack->capacity) {
+        int capacity = stack->capacity ? stack->capacity * 2 : 16;
+        IgnoreFrame *frames = realloc(stack->frames, (size_t)capacity * sizeof(IgnoreFrame));
+        if (frames == NULL) {
+            return false;
+        }
+        stack->frames = frames;
+        stack->capacity = capacity;
+    }
+
+    IgnoreFrame frame = { 0 };
+    frame.dir = malloc(len + 1);
+    if (frame.dir == NULL) {
+        return false;
+    }
+    memcpy(frame.dir, dir, len);
+    frame.dir[len] = '\0';
+    frame.dir_len = len;
+    if (has_cache_marker(frame.dir)) {
+        free(frame.dir);
+        return false;
+    }
+
+    // A work tree root, or a nested one, brings its own exclude file
+    char git_path[PATH_MAX];
+    snprintf(git_path, sizeof(git_path), "%s/.git", len > 1 ? frame.dir : "");
+    struct stat st;
+    if (stat_cache_lstat(git_path, &st)) {
+        in_repo = true;
+        if (S_ISDIR(st.st_mode)) {
+            load_rules_file(&frame, ".git/info/exclude");
+        }
+    }
+    frame.in_repo = in_repo;
+    if (in_repo) {
+        load_rules_file(&frame, ".gitignore");
+    }
+    load_rules_file(&frame, ".ignore");
+
+    // Without '!' lines every match ignores, so the name rules need no order
+    if (!frame.ordered) {
+        for (int i = 0; i < frame.rule_count; i++) {
+            IgnoreRule *rule = &frame.rules[i];
+            if (rule->anchored) {
+                continue;
+            }
+            ExcludeSet **set = rule->dir_only ? &frame.dir_names : &frame.names;
+            if (*set == NULL) {
+                *set = exclude_set_create();
+            }
+            if (*set != NULL && exclude_set_add(*set, rule->pattern)) {
+                free(rule->pattern);
+                rule->pattern = NULL;
+            }
+        }
+    }
+
+    stack->frames[stack->count++] = frame;
+    return true;
+}
+
+IgnoreStack* ignore_stack_create(void)
+{
+    return calloc(1, sizeof(IgnoreStack));
+}
+
+void ignore_stack_destroy(IgnoreStack *stack)
+{
+    if (stack == NULL) {
+        return;
+    }
+    ignore_stack_clear(stack);
+    free(stack->frames);
+    free(stack);
+}
+
+void ignore_stack_clear(IgnoreStack *stack)
+{
+    while (stack != NULL && stack->count > 0) {
+        ignore_stack_pop(stack);
+    }
+}
+
+bool ignore_stack_enter(IgnoreStack *stack, const char *dir)
+{
+    if (stack == NULL || dir == NULL || dir[0] != '/') {
+        return true;
+    }
+    size_t len = strlen(dir);
+
+    // Keep the folders dir is in
+    while (stack->count > 0) {
+        const IgnoreFrame *top = &stack->frames[stack->count - 1];
+        if (strncmp(dir, top->dir, top->dir_len) == 0 &&
+            (dir[top->dir_len] == '\0' || dir[top->dir_len] == '/' || top->dir_len == 1)) {
+            break;
+        }
+        ignore_stack_pop(stack);
+    }
+
+    if (stack->count == 0) {
+        char root[PATH_MAX];
+        bool in_repo = git_get_repo_root(dir, root, sizeof(root));
+        size_t root_len = strlen(root);
+        bool from_root = in_repo && strncmp(dir, root, root_len) == 0 &&
+                         (dir[root_len] == '\0' || dir[root_len] == '/');
+        if (!push_frame(stack, dir, from_root ? root_len : len, in_repo)) {
+            return false;
+        }
+    }
+
+    char child[PATH_MAX];
+    while (stack->count > 0 && stack->frames[stack->count - 1].dir_len < len) {
+        const IgnoreFrame *top = &stack->frames[stack->count - 1];
+        const char *name = dir + top->dir_len + (dir[top->dir_len] == '/' ? 1 : 0);
+        const char *end = strchr(name, '/');
+        size_t child_len = end ? (size_t)(end - dir) : len;
+        if (child_len >= sizeof(child)) {
+            return true;
+        }
+        memcpy(child, dir, child_len);
+        child[child_len] = '\0';
+        if (ignore_stack_match(stack, child, true) || !ignore_stack_push(stack, child)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ignore_stack_push(IgnoreStack *stack, const char *dir)
+{
+    if (stack == NULL || dir == NULL) {
+        return true;
+    }
+    bool in_repo = stack->count > 0 && stack->frames[stack->count - 1].in_repo;
+    return push_frame(stack, dir, strlen(dir), in_repo);
+}
+
+void ignore_stack_pop(IgnoreStack *stack)
+{
+    if (stack != NULL && stack->count > 0) {
+        frame_free(&stack->frames[--stack->count]);
+    }
+}
+
+bool ignore_stack_match(const IgnoreStack *stack, const char *path, bool is_dir)
+{
+    if (stack == NULL || path == NULL) {
+        return false;
+    }
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    size_t name_len = strlen(name);
+
+    // The deepest file with a matching rule decides
+    for (int f = stack->count - 1; f >= 0; f--) {
+        const IgnoreFrame *frame = &stack->frames[f];
+        if (strncmp(path, frame->dir, frame->dir_len) != 0) {
+            continue;
+        }
+        const char *relative = path + frame->dir_len + (path[frame->dir_len] == '/' ? 1 : 0);
+
+        if (frame->ordered) {
+            for (int i = frame->rule_count - 1; i >= 0; i--) {
+                if (rule_matches(&frame->rules[i], relative, name, is_dir)) {
+                    return !frame->rules[i].negate;
+                }
+            }
+            continue;
+        }
+
+        if (exclude_set_match_name(frame->names, name, name_len) ||
+            (is_dir && exclude_set_match_name(frame->dir_names, name, name_len))) {
+            return true;
+        }
+        for (int i = 0; i < frame->rule_count; i++) {
+            if (frame->rules[i].pattern != NULL &&
+                rule_matches(&frame->rules[i], relative, name, is_dir)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool ignore_rules_file(const char *path)
+{
+    if (path == NULL) {
+        return false;
+    }
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    return strcmp(name, ".gitignore") == 0 || strcmp(name, ".ignore") == 0 ||
+           strcmp(name, IGNORE_CACHEDIR_TAG) == 0 || strstr(path, "/.git/info/exclude") != NULL;
+}
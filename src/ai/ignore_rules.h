@@ -0,0 +1,44 @@
+#ifndef IGNORE_RULES_H
+#define IGNORE_RULES_H
+
+#include <stdbool.h>
+
+// The rules of .gitignore and .ignore files and CACHEDIR.TAG cache markers along a folder
+// path, for scans that leave out what a developer's tools treat as throwaway: build
+// outputs, virtual environments, caches. .gitignore files (and .git/info/exclude) count
+// inside git work trees only; .ignore files, as ripgrep reads them, count anywhere and
+// win over them. A folder holding a CACHEDIR.TAG with the standard signature is left
+// out whole.
+//
+// Patterns follow gitignore: the last matching rule wins and deeper files win over
+// shallower ones, '!' re-includes, a trailing '/' matches folders only, any other '/'
+// anchors the pattern to the file's folder, and "**" spans folders. Rules of a file
+// without '!' lines that match by name go through an ExcludeSet. One stack per thread
+
+#define IGNORE_CACHEDIR_TAG "CACHEDIR.TAG"
+
+typedef struct IgnoreStack IgnoreStack;
+
+IgnoreStack* ignore_stack_create(void);
+void ignore_stack_destroy(IgnoreStack *stack);
+
+// Forget every folder, to read their files again
+void ignore_stack_clear(IgnoreStack *stack);
+
+// Make dir (absolute, without a trailing '/') the top, reading the rules of the folders
+// from its repository root (or dir itself outside one) down to it; folders already on
+// the stack are kept. False if dir or a folder above it is ignored or a cache
+bool ignore_stack_enter(IgnoreStack *stack, const char *dir);
+
+// Enter a folder of the top one, already checked with ignore_stack_match; false (and
+// nothing entered) if it holds a cache marker
+bool ignore_stack_push(IgnoreStack *stack, const char *dir);
+void ignore_stack_pop(IgnoreStack *stack);
+
+// Whether an entry of the top folder is ignored
+bool ignore_stack_match(const IgnoreStack *stack, const char *path, bool is_dir);
+
+// Whether a changed file may change the rules (.gitignore, .ignore or a cache marker)
+bool ignore_rules_file(const char *path);
+
+#endif // IGNORE_RULES_H
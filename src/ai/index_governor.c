@@ -0,0 +1,104 @@
+#include "index_governor.h"
+
+// Per level: share of the inference threads (0 = one thread), pause after each
+// batch, and whether pipeline threads run at background QoS
+static const struct {
+    int thread_divisor;
+    int batch_delay_ms;
+    bool background;
+} LEVELS[INDEX_GOVERNOR_LEVELS] = {
+    { 1,    0, false },     // Idle machine on power
+    { 2,   20, false },     // User nearby or slightly warm
+    { 4,  100, true  },     // User working, on battery
+    { 0,  500, true  },     // Hot, low battery or Low Power Mode
+    { 0, 2000, true  },     // Critical thermal pressure
+};
+
+static int max_int(int a, int b)
+{
+    return a > b ? a : b;
+}
+
+void index_governor_init(IndexGovernor *governor, int max_threads)
+{
+    if (governor == NULL) {
+        return;
+    }
+    governor->level = 0;
+    governor->max_threads = max_threads > 0 ? max_threads : 1;
+    governor->last_change = 0.0;
+}
+
+int index_governor_target(const IndexGovernor *governor, const IndexGovernorInput *input)
+{
+    if (governor == NULL || input == NULL) {
+        return 0;
+    }
+
+    int target = 0;
+    const PlatformLoad *load = &input->load;
+
+    switch (load->thermal) {
+        case PLATFORM_THERMAL_CRITICAL: target = 4; break;
+        case PLATFORM_THERMAL_SERIOUS:  target = 3; break;
+        case PLATFORM_THERMAL_FAIR:     target = 1; break;
+        default: break;
+    }
+
+    bool low_battery = load->on_battery && load->battery_percent >= 0 &&
+                       load->battery_percent < INDEX_GOVERNOR_LOW_BATTERY;
+    if (load->low_power_mode || low_battery) {
+        target = max_int(target, 3);
+    } else if (load->on_battery) {
+        target = max_int(target, 2);
+    }
+
+    if (input->idle_seconds < INDEX_GOVERNOR_ACTIVE_SEC) {
+        target = max_int(target, 2);
+    } else if (input->idle_seconds < INDEX_GOVERNOR_RECENT_SEC) {
+        target = max_int(target, 1);
+    }
+
+    // Dropped frames: back off further than where we are now
+    if (input->frame_budget > 0.0 && input->frame_time_p95 > input->frame_budget * 1.5) {
+        target = max_int(target, governor->level + 1);
+    } else if (load->cpu_load > INDEX_GOVERNOR_BUSY_LOAD) {
+        // Something else is using the machine: hold rather than speed up
+        target = max_int(target, governor->level);
+    }
+
+    return target < INDEX_GOVERNOR_LEVELS ? target : INDEX_GOVERNOR_LEVELS - 1;
+}
+
+IndexerThrottle index_governor_update(IndexGovernor *governor, const IndexGovernorInput *input, double now)
+{
+    IndexerThrottle throttle = {0};
+    if (governor == NULL) {
+        return throttle;
+    }
+
+    int target = index_governor_target(governor, input);
+    if (target > governor->level) {
+        governor->level = target;
+        governor->last_change = now;
+    } else if (target < governor->level && now - governor->last_change >= INDEX_GOVERNOR_RAMP_SEC) {
+        governor->level--;
+        governor->last_change = now;
+    }
+
+    return index_governor_throttle(governor);
+}
+
+IndexerThrottle index_governor_throttle(const IndexGovernor *governor)
+{
+    IndexerThrottle throttle = {0};
+    if (governor == NULL) {
+        return throttle;
+    }
+
+    int divisor = LEVELS[governor->level].thread_divisor;
+    throttle.embed_threads = divisor > 0 ? max_int(1, governor->max_threads / divisor) : 1;
+    throttle.batch_delay_ms = LEVELS[governor->level].batch_delay_ms;
+    throttle.background = LEVELS[governor->level].background;
+    return throttle;
+}
@@ -0,0 +1,58 @@
+#ifndef INDEX_GOVERNOR_H
+#define INDEX_GOVERNOR_H
+
+#include <stdbool.h>
+#include "indexer.h"
+#include "../platform/power.h"
+
+// Decides how hard background indexing may run. Fed about once a second with machine
+// load, power state and how busy the user and the UI are; backs off at once when any
+// of them calls for it and ramps back up one level at a time once things calm down
+
+// Throttle levels, from full speed to barely moving
+#define INDEX_GOVERNOR_LEVELS 5
+
+// Seconds between steps back up to a faster level
+#define INDEX_GOVERNOR_RAMP_SEC 5.0
+
+// Input since the user last touched the mouse or keyboard under which they count as
+// working (indexing moves to background QoS) ...
+#define INDEX_GOVERNOR_ACTIVE_SEC 2.0
+
+// ... or as likely to come back (indexing stays below full speed)
+#define INDEX_GOVERNOR_RECENT_SEC 30.0
+
+// Battery percentage below which indexing crawls
+#define INDEX_GOVERNOR_LOW_BATTERY 20
+
+// CPU load above which the governor does not speed up
+#define INDEX_GOVERNOR_BUSY_LOAD 0.85f
+
+// What the governor looks at
+typedef struct IndexGovernorInput {
+    PlatformLoad load;
+    double idle_seconds;                // Since the last mouse or keyboard input
+    double frame_time_p95;              // Seconds; 0 if unknown
+    double frame_budget;                // Seconds per frame at the target rate
+} IndexGovernorInput;
+
+typedef struct IndexGovernor {
+    int level;                          // 0 (full speed) .. INDEX_GOVERNOR_LEVELS - 1
+    int max_threads;                    // Inference threads at full speed
+    double last_change;                 // When level last changed
+} IndexGovernor;
+
+// Start at full speed with max_threads inference threads
+void index_governor_init(IndexGovernor *governor, int max_threads);
+
+// Level the input calls for, ignoring ramp-up pacing
+int index_governor_target(const IndexGovernor *governor, const IndexGovernorInput *input);
+
+// Move to the level the input calls for (down at once, up one step per
+// INDEX_GOVERNOR_RAMP_SEC) and return the throttle for it; now is in seconds
+IndexerThrottle index_governor_update(IndexGovernor *governor, const IndexGovernorInput *input, double now);
+
+// Throttle for the current level
+IndexerThrottle index_governor_throttle(const IndexGovernor *governor);
+
+#endif // INDEX_GOVERNOR_H
@@ -0,0 +1,84 @@
+#include "index_inbox.h"
+#include <stdlib.h>
+#include <string.h>
+
+// A Treiber stack: producers push with compare-and-swap and the consumer takes the whole
+// list with one exchange. Nothing is ever popped singly, so there is no ABA problem
+
+void index_inbox_init(IndexInbox *inbox)
+{
+    if (inbox == NULL) {
+        return;
+    }
+    atomic_init(&inbox->head, (uintptr_t)NULL);
+    atomic_init(&inbox->count, 0);
+}
+
+void index_inbox_clear(IndexInbox *inbox)
+{
+    IndexInboxItem *item = index_inbox_take(inbox);
+    while (item != NULL) {
+        IndexInboxItem *next = item->next;
+        free(item);
+        item = next;
+    }
+}
+
+bool index_inbox_post(IndexInbox *inbox, const char *path, double time, double delay, int limit)
+{
+    if (inbox == NULL || path == NULL) {
+        return false;
+    }
+
+    // Reserve a place first so concurrent posts cannot overshoot the limit
+    if (atomic_fetch_add(&inbox->count, 1) >= limit) {
+        atomic_fetch_sub(&inbox->count, 1);
+        return false;
+    }
+
+    size_t length = strlen(path);
+    IndexInboxItem *item = malloc(sizeof(IndexInboxItem) + length + 1);
+    if (item == NULL) {
+        atomic_fetch_sub(&inbox->count, 1);
+        return false;
+    }
+    item->time = time;
+    item->delay = delay;
+    memcpy(item->path, path, length + 1);
+
+    uintptr_t head = atomic_load(&inbox->head);
+    do {
+        item->next = (IndexInboxItem *)head;
+    } while (!atomic_compare_exchange_weak(&inbox->head, &head, (uintptr_t)item));
+    return true;
+}
+
+IndexInboxItem* index_inbox_take(IndexInbox *inbox)
+{
+    if (inbox == NULL) {
+        return NULL;
+    }
+
+    IndexInboxItem *item = (IndexInboxItem *)atomic_exchange(&inbox->head, (uintptr_t)NULL);
+
+    // Reverse into posting order
+    IndexInboxItem *ordered = NULL;
+    int taken = 0;
+    while (item != NULL) {
+        IndexInboxItem *next = item->next;
+        item->next = ordered;
+        ordered = item;
+        item = next;
+        taken++;
+    }
+    if (taken > 0) {
+        atomic_fetch_sub(&inbox->count, taken);
+    }
+    return ordered;
+}
+
+int index_inbox_count(const IndexInbox *inbox)
+{
+    // Older clang refuses atomic loads through a const pointer
+    return inbox != NULL ? atomic_load((atomic_int *)&inbox->count) : 0;
+}
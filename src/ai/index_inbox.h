@@ -0,0 +1,40 @@
+#ifndef INDEX_INBOX_H
+#define INDEX_INBOX_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Lock-free hand-off of paths to index from any thread (the watch bus callback, the UI)
+// to the indexer, which takes everything posted at once and moves it into its queue.
+// Posting never waits on the indexer's mutex, so a busy pipeline cannot stall the
+// thread delivering file events
+
+typedef struct IndexInboxItem {
+    struct IndexInboxItem *next;
+    double time;                        // When it was posted
+    double delay;                       // Seconds to wait after that before indexing
+    char path[];
+} IndexInboxItem;
+
+typedef struct IndexInbox {
+    atomic_uintptr_t head;              // IndexInboxItem *, newest first
+    atomic_int count;
+} IndexInbox;
+
+// Start empty
+void index_inbox_init(IndexInbox *inbox);
+
+// Free anything still posted
+void index_inbox_clear(IndexInbox *inbox);
+
+// Post a path; false if limit items are already waiting (or out of memory)
+bool index_inbox_post(IndexInbox *inbox, const char *path, double time, double delay, int limit);
+
+// Take every posted item, oldest first (NULL if none); free each with free()
+IndexInboxItem* index_inbox_take(IndexInbox *inbox);
+
+// Items posted and not yet taken
+int index_inbox_count(const IndexInbox *inbox);
+
+#endif // INDEX_INBOX_H
@@ -0,0 +1,667 @@
+#include "index_pack.h"
+#include "ai_common.h"
+#include "vector_ops.h"
+#include "../utils/file_hash.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define INDEX_PACK_MAGIC 0x50495046u    // "FPIP"
+#define INDEX_PACK_VERSION 1
+
+// Fixed header; the columns follow it, each starting on an 8-byte boundary. Written
+// in the host's byte order (every Mac the app runs on is little-endian)
+typedef struct IndexPackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;                 // Entries
+    uint32_t text_count;            // Rows of text codes
+    uint32_t image_count;           // Rows of image codes
+    uint32_t text_dimension;
+    uint32_t image_dimension;
+    uint32_t reserved;
+    uint64_t strings_size;          // Relative paths, NUL-terminated back to back
+    char text_model[INDEX_PACK_MODEL_SIZE];
+    char image_model[INDEX_PACK_MODEL_SIZE];
+} IndexPackHeader;
+
+// Byte offset of each column in the file, derived from the header
+typedef struct PackLayout {
+    size_t sizes;           // int64_t per entry
+    size_t mtimes;          // int64_t per entry
+    size_t hashes;          // uint64_t per entry, 0 if none
+    size_t path_offsets;    // uint64_t per entry, into strings
+    size_t text_rows;       // int32_t per entry, -1 if none
+    size_t image_rows;      // int32_t per entry, -1 if none
+    size_t file_types;      // uint8_t per entry
+    size_t text_scales;     // float per text row
+    size_t text_codes;      // int8_t[text_dimension] per text row
+    size_t image_scales;    // float per image row
+    size_t image_codes;     // int8_t[image_dimension] per image row
+    size_t image_widths;    // int32_t per image row
+    size_t image_heights;   // int32_t per image row
+    size_t strings;
+    size_t total;
+} PackLayout;
+
+// One file gathered for export
+typedef struct PackEntry {
+    uint64_t path_offset;
+    int64_t size;
+    int64_t modified_time;
+    uint64_t content_hash;
+    int32_t text_row;
+    int32_t image_row;
+    uint8_t file_type;
+} PackEntry;
+
+// Everything gathered for export, in memory until it is written column by column
+typedef struct PackBuilder {
+    size_t root_len;
+    PackEntry *entries;
+    int count;
+    int capacity;
+    int sorted_count;           // Entries from the text pass, in path order
+    char *strings;
+    size_t strings_size;
+    size_t strings_capacity;
+    float *text_scales;
+    int8_t *text_codes;
+    int text_count;
+    int text_capacity;
+    float *image_scales;
+    int8_t *image_codes;
+    int32_t *image_widths;
+    int32_t *image_heights;
+    int image_count;
+    int image_capacity;
+    bool failed;
+} PackBuilder;
+
+// Helper: offset of a column of bytes at *at, moving *at past it to the next boundary
+static size_t column(size_t *at, size_t bytes)
+{
+    size_t offset = *at;
+    *at = (offset + bytes + 7) & ~(size_t)7;
+    return offset;
+}
+
+static void pack_layout(const IndexPackHeader *header, PackLayout *layout)
+{
+    size_t n = header->count;
+    size_t text = header->text_count;
+    size_t image = header->image_count;
+    size_t at = sizeof(IndexPackHeader);
+
+    layout->sizes = column(&at, n * sizeof(int64_t));
+    layout->mtimes = column(&at, n * sizeof(int64_t));
+    layout->hashes = column(&at, n * sizeof(uint64_t));
+    layout->path_offsets = column(&at, n * sizeof(uint64_t));
+    layout->text_rows = column(&at, n * sizeof(int32_t));
+    layout->image_rows = column(&at, n * sizeof(int32_t));
+    layout->file_types = column(&at, n);
+    layout->text_scales = column(&at, text * sizeof(float));
+    layout->text_codes = column(&at, text * header->text_dimension);
+    layout->image_scales = column(&at, image * sizeof(float));
+    layout->image_codes = column(&at, image * header->image_dimension);
+    layout->image_widths = column(&at, image * sizeof(int32_t));
+    layout->image_heights = column(&at, image * sizeof(int32_t));
+    layout->strings = column(&at, (size_t)header->strings_size);
+    layout->total = at;
+}
+
+// Helper: make room for needed items of item_size in *array
+static bool reserve(void **array, int *capacity, int needed, size_t item_size)
+{
+    if (needed <= *capacity) {
+        return true;
+    }
+    int grown = *capacity > 0 ? *capacity * 2 : 256;
+    while (grown < needed) {
+        grown *= 2;
+    }
+    void *resized = realloc(*array, (size_t)grown * item_size);
+    if (resized == NULL) {
+        return false;
+    }
+    *array = resized;
+    *capacity = grown;
+    return true;
+}
+
+// Helper: add an entry for path (below the exported root), its path interned
+static PackEntry *add_entry(PackBuilder *builder, const char *path)
+{
+    const char *relative = path + builder->root_len + 1;
+    size_t len = strlen(relative) + 1;
+    if (builder->strings_size + len > builder->strings_capacity) {
+        size_t capacity = builder->strings_capacity > 0 ? builder->strings_capacity * 2 : 65536;
+        while (capacity < builder->strings_size + len) {
+            capacity *= 2;
+        }
+        char *strings = realloc(builder->strings, capacity);
+        if (strings == NULL) {
+            return NULL;
+        }
+        builder->strings = strings;
+        builder->strings_capacity = capacity;
+    }
+
+    int capacity = builder->capacity;
+    if (!reserve((void **)&builder->entries, &capacity, builder->count + 1, sizeof(PackEntry))) {
+        return NULL;
+    }
+    builder->capacity = capacity;
+
+    PackEntry *entry = &builder->entries[builder->count++];
+    memset(entry, 0, sizeof(PackEntry));
+    entry->path_offset = builder->strings_size;
+    entry->text_row = -1;
+    entry->image_row = -1;
+    memcpy(builder->strings + builder->strings_size, relative, len);
+    builder->strings_size += len;
+    return entry;
+}
+
+static bool pack_text_file(const IndexedFile *file, const char *content_hash, void *context)
+{
+    PackBuilder *builder = context;
+    if (!file->has_embedding) {
+        return true;
+    }
+
+    int capacity = builder->text_capacity;
+    int needed = builder->text_count + 1;
+    bool ok = reserve((void **)&builder->text_scales, &capacity, needed, sizeof(float));
+    capacity = builder->text_capacity;
+    ok = ok && reserve((void **)&builder->text_codes, &capacity, needed, EMBEDDING_DIMENSION);
+    PackEntry *entry = ok ? add_entry(builder, file->path) : NULL;
+    if (entry == NULL) {
+        builder->failed = true;
+        return false;
+    }
+    builder->text_capacity = capacity;
+
+    entry->size = file->size;
+    entry->modified_time = file->modified_time;
+    entry->file_type = (uint8_t)file->file_type;
+    if (strlen(content_hash) == FILE_HASH_HEX_SIZE - 1) {
+        entry->content_hash = strtoull(content_hash, NULL, 16);
+    }
+    entry->text_row = builder->text_count;
+    builder->text_scales[builder->text_count] =
+        vector_quantize_int8(file->embedding, EMBEDDING_DIMENSION,
+                             builder->text_codes + (size_t)builder->text_count * EMBEDDING_DIMENSION);
+    builder->text_count++;
+    builder->sorted_count = builder->count;
+    return true;
+}
+
+// Helper: entry of the text pass for a relative path, or NULL
+static PackEntry *find_entry(PackBuilder *builder, const char *relative)
+{
+    int low = 0;
+    int high = builder->sorted_count - 1;
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        int cmp = strcmp(builder->strings + builder->entries[mid].path_offset, relative);
+        if (cmp == 0) {
+            return &builder->entries[mid];
+        }
+        if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return NULL;
+}
+
+static bool pack_image(const ImageIndexEntry *image, void *context)
+{
+    PackBuilder *builder = context;
+
+    int needed = builder->image_count + 1;
+    int capacity = builder->image_capacity;
+    bool ok = reserve((void **)&builder->image_scales, &capacity, needed, sizeof(float));
+    capacity = builder->image_capacity;
+    ok = ok && reserve((void **)&builder->image_widths, &capacity, needed, sizeof(int32_t));
+    capacity = builder->image_capacity;
+    ok = ok && reserve((void **)&builder->image_heights, &capacity, needed, sizeof(int32_t));
+    capacity = builder->image_capacity;
+    ok = ok && reserve((void **)&builder->image_codes, &capacity, needed, CLIP_EMBEDDING_DIMENSION);
+
+    // Files with text too share the text pass's entry
+    PackEntry *entry = ok ? find_entry(builder, image->path + builder->root_len + 1) : NULL;
+    if (ok && entry == NULL) {
+        entry = add_entry(builder, image->path);
+        if (entry != NULL) {
+            entry->size = image->size;
+            entry->modified_time = (int64_t)image->modified_time;
+            entry->file_type = FILE_TYPE_IMAGE;
+        }
+    }
+    if (entry == NULL) {
+        builder->failed = true;
+        return false;
+    }
+    builder->image_capacity = capacity;
+
+    int row = builder->image_count++;
+    entry->image_row = row;
+    builder->image_widths[row] = image->width;
+    builder->image_heights[row] = image->height;
+    builder->image_scales[row] =
+        vector_quantize_int8(image->embedding, CLIP_EMBEDDING_DIMENSION,
+                             builder->image_codes + (size_t)row * CLIP_EMBEDDING_DIMENSION);
+    return true;
+}
+
+static void builder_free(PackBuilder *builder)
+{
+    free(builder->entries);
+    free(builder->strings);
+    free(builder->text_scales);
+    free(builder->text_codes);
+    free(builder->image_scales);
+    free(builder->image_codes);
+    free(builder->image_widths);
+    free(builder->image_heights);
+}
+
+// Helper: write bytes at offset, zero-padding from *at (the end of what was written)
+static bool write_column(FILE *f, size_t *at, size_t offset, const void *data, size_t bytes)
+{
+    static const char zeros[8] = {0};
+    if (offset - *at > sizeof(zeros) || fwrite(zeros, 1, offset - *at, f) != offset - *at) {
+        return false;
+    }
+    *at = offset + bytes;
+    return bytes == 0 || fwrite(data, 1, bytes, f) == bytes;
+}
+
+// Helper: write the builder's entries to a pack file, through a temporary renamed into place
+static IndexPackStatus write_pack(const PackBuilder *builder, const IndexPackModels *models, const char *pack_path)
+{
+    IndexPackHeader header = {
+        .magic = INDEX_PACK_MAGIC,
+        .version = INDEX_PACK_VERSION,
+        .count = (uint32_t)builder->count,
+        .text_count = (uint32_t)builder->text_count,
+        .image_count = (uint32_t)builder->image_count,
+        .text_dimension = EMBEDDING_DIMENSION,
+        .image_dimension = CLIP_EMBEDDING_DIMENSION,
+        .strings_size = builder->strings_size
+    };
+    if (models != NULL && models->text != NULL) {
+        strncpy(header.text_model, models->text, sizeof(header.text_model) - 1);
+    }
+    if (models != NULL && models->image != NULL) {
+        strncpy(header.image_model, models->image, sizeof(header.image_model) - 1);
+    }
+    PackLayout layout;
+    pack_layout(&header, &layout);
+
+    // Per-entry columns are gathered one at a time into scratch
+    size_t n = (size_t)builder->count;
+    uint64_t *scratch = malloc(n > 0 ? n * sizeof(uint64_t) : 1);
+    if (scratch == NULL) {
+        return INDEX_PACK_STATUS_MEMORY_ERROR;
+    }
+
+    char tmp_path[4096 + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", pack_path);
+    FILE *f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        free(scratch);
+        return INDEX_PACK_STATUS_IO_ERROR;
+    }
+
+    size_t at = sizeof(header);
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+
+    int64_t *int64s = (int64_t *)scratch;
+    for (size_t i = 0; i < n; i++) int64s[i] = builder->entries[i].size;
+    ok = ok && write_column(f, &at, layout.sizes, scratch, n * sizeof(int64_t));
+    for (size_t i = 0; i < n; i++) int64s[i] = builder->entries[i].modified_time;
+    ok = ok && write_column(f, &at, layout.mtimes, scratch, n * sizeof(int64_t));
+    for (size_t i = 0; i < n; i++) scratch[i] = builder->entries[i].content_hash;
+    ok = ok && write_column(f, &at, layout.hashes, scratch, n * sizeof(uint64_t));
+    for (size_t i = 0; i < n; i++) scratch[i] = builder->entries[i].path_offset;
+    ok = ok && write_column(f, &at, layout.path_offsets, scratch, n * sizeof(uint64_t));
+
+    int32_t *int32s = (int32_t *)scratch;
+    for (size_t i = 0; i < n; i++) int32s[i] = builder->entries[i].text_row;
+    ok = ok && write_column(f, &at, layout.text_rows, scratch, n * sizeof(int32_t));
+    for (size_t i = 0; i < n; i++) int32s[i] = builder->entries[i].image_row;
+    ok = ok && write_column(f, &at, layout.image_rows, scratch, n * sizeof(int32_t));
+    uint8_t *bytes = (uint8_t *)scratch;
+    for (size_t i = 0; i < n; i++) bytes[i] = builder->entries[i].file_type;
+    ok = ok && write_column(f, &at, layout.file_types, scratch, n);
+
+    size_t text = (size_t)builder->text_count;
+    size_t image = (size_t)builder->image_count;
+    ok = ok && write_column(f, &at, layout.text_scales, builder->text_scales, text * sizeof(float)) &&
+         write_column(f, &at, layout.text_codes, builder->text_codes, text * EMBEDDING_DIMENSION) &&
+         write_column(f, &at, layout.image_scales, builder->image_scales, image * sizeof(float)) &&
+         write_column(f, &at, layout.image_codes, builder->image_codes, image * CLIP_EMBEDDING_DIMENSION) &&
+         write_column(f, &at, layout.image_widths, builder->image_widths, image * sizeof(int32_t)) &&
+         write_column(f, &at, layout.image_heights, builder->image_heights, image * sizeof(int32_t)) &&
+         write_column(f, &at, layout.strings, builder->strings, builder->strings_size) &&
+         write_column(f, &at, layout.total, NULL, 0);
+    free(scratch);
+
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+    if (!ok || rename(tmp_path, pack_path) != 0) {
+        remove(tmp_path);
+        return INDEX_PACK_STATUS_IO_ERROR;
+    }
+    return INDEX_PACK_STATUS_OK;
+}
+
+IndexPackStatus index_pack_export(VectorDB *db, VisualSearch *vs, const char *root,
+                                  const IndexPackModels *models, const char *pack_path,
+                                  IndexPackStats *stats)
+{
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(IndexPackStats));
+    }
+    if (root == NULL || pack_path == NULL) {
+        return INDEX_PACK_STATUS_IO_ERROR;
+    }
+
+    PackBuilder builder;
+    memset(&builder, 0, sizeof(builder));
+    builder.root_len = strlen(root);
+    while (builder.root_len > 0 && root[builder.root_len - 1] == '/') {
+        builder.root_len--;
+    }
+
+    // Text rows come in path order, so the image pass finds files it shares by bisection
+    if (db != NULL) {
+        vectordb_each_file(db, root, pack_text_file, &builder);
+    }
+    if (vs != NULL && !builder.failed) {
+        visual_search_each_image(vs, root, pack_image, &builder);
+    }
+
+    IndexPackStatus status = builder.failed ? INDEX_PACK_STATUS_MEMORY_ERROR
+                                            : write_pack(&builder, models, pack_path);
+    if (stats != NULL) {
+        stats->entries = builder.count;
+        stats->text_entries = builder.text_count;
+        stats->image_entries = builder.image_count;
+    }
+    builder_free(&builder);
+    return status;
+}
+
+// A pack mapped read-only, its columns checked to lie inside the file
+typedef struct PackMap {
+    void *base;
+    size_t size;
+    const IndexPackHeader *header;
+    const int64_t *sizes;
+    const int64_t *mtimes;
+    const uint64_t *hashes;
+    const uint64_t *path_offsets;
+    const int32_t *text_rows;
+    const int32_t *image_rows;
+    const uint8_t *file_types;
+    const float *text_scales;
+    const int8_t *text_codes;
+    const float *image_scales;
+    const int8_t *image_codes;
+    const int32_t *image_widths;
+    const int32_t *image_heights;
+    const char *strings;
+} PackMap;
+
+static void pack_unmap(PackMap *map)
+{
+    if (map->base != NULL) {
+        munmap(map->base, map->size);
+        map->base = NULL;
+    }
+}
+
+static IndexPackStatus pack_map(const char *pack_path, PackMap *map)
+{
+    memset(map, 0, sizeof(PackMap));
+    int fd = open(pack_path, O_RDONLY);
+    if (fd < 0) {
+        return INDEX_PACK_STATUS_IO_ERROR;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return INDEX_PACK_STATUS_IO_ERROR;
+    }
+    if ((size_t)st.st_size < sizeof(IndexPackHeader)) {
+        close(fd);
+        return INDEX_PACK_STATUS_INVALID;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return INDEX_PACK_STATUS_IO_ERROR;
+    }
+    map->base = base;
+    map->size = (size_t)st.st_size;
+
+    const IndexPackHeader *header = base;
+    PackLayout layout;
+    bool ok = header->magic == INDEX_PACK_MAGIC && header->version == INDEX_PACK_VERSION &&
+              header->text_dimension == EMBEDDING_DIMENSION &&
+              header->image_dimension == CLIP_EMBEDDING_DIMENSION &&
+              header->count <= INT32_MAX && header->text_count <= header->count &&
+              header->image_count <= header->count && header->strings_size <= map->size;
+    if (ok) {
+        pack_layout(header, &layout);
+        ok = layout.total <= map->size &&
+             (header->strings_size == 0 || ((const char *)base)[layout.strings + header->strings_size - 1] == '\0');
+    }
+    if (!ok) {
+        pack_unmap(map);
+        return INDEX_PACK_STATUS_INVALID;
+    }
+
+    const char *bytes = base;
+    map->header = header;
+    map->sizes = (const int64_t *)(const void *)(bytes + layout.sizes);
+    map->mtimes = (const int64_t *)(const void *)(bytes + layout.mtimes);
+    map->hashes = (const uint64_t *)(const void *)(bytes + layout.hashes);
+    map->path_offsets = (const uint64_t *)(const void *)(bytes + layout.path_offsets);
+    map->text_rows = (const int32_t *)(const void *)(bytes + layout.text_rows);
+    map->image_rows = (const int32_t *)(const void *)(bytes + layout.image_rows);
+    map->file_types = (const uint8_t *)(bytes + layout.file_types);
+    map->text_scales = (const float *)(const void *)(bytes + layout.text_scales);
+    map->text_codes = (const int8_t *)(bytes + layout.text_codes);
+    map->image_scales = (const float *)(const void *)(bytes + layout.image_scales);
+    map->image_codes = (const int8_t *)(bytes + layout.image_codes);
+    map->image_widths = (const int32_t *)(const void *)(bytes + layout.image_widths);
+    map->image_heights = (const int32_t *)(const void *)(bytes + layout.image_heights);
+    map->strings = bytes + layout.strings;
+    return INDEX_PACK_STATUS_OK;
+}
+
+// Helper: whether a pack's model for one kind of embedding is usable with ours. A kind
+// the pack has no rows of, or that is not in use here, does not matter
+static bool models_match(const char *packed, uint32_t rows, const char *ours)
+{
+    if (rows == 0 || ours == NULL || ours[0] == '\0') {
+        return true;
+    }
+    return strncmp(packed, ours, INDEX_PACK_MODEL_SIZE - 1) == 0;
+}
+
+// Helper: whether the file at path is the one entry i describes; counts a hash match
+static bool entry_current(const PackMap *map, int i, const char *path, const struct stat *st,
+                          IndexPackStats *stats)
+{
+    if ((int64_t)st->st_size != map->sizes[i]) {
+        return false;
+    }
+    if ((int64_t)st->st_mtime == map->mtimes[i]) {
+        return true;
+    }
+
+    // Copied or restored files keep their content but not their mtime
+    uint64_t hash;
+    if (map->hashes[i] != 0 && file_hash_compute(path, &hash) && hash == map->hashes[i]) {
+        stats->hashed++;
+        return true;
+    }
+    return false;
+}
+
+IndexPackStatus index_pack_import(VectorDB *db, VisualSearch *vs, const char *pack_path,
+                                  const char *root, const IndexPackModels *models,
+                                  IndexPackStats *stats)
+{
+    IndexPackStats local;
+    if (stats == NULL) {
+        stats = &local;
+    }
+    memset(stats, 0, sizeof(IndexPackStats));
+    if (pack_path == NULL || root == NULL) {
+        return INDEX_PACK_STATUS_IO_ERROR;
+    }
+
+    PackMap map;
+    IndexPackStatus status = pack_map(pack_path, &map);
+    if (status != INDEX_PACK_STATUS_OK) {
+        return status;
+    }
+    const IndexPackHeader *header = map.header;
+    stats->entries = (int)header->count;
+    stats->text_entries = (int)header->text_count;
+    stats->image_entries = (int)header->image_count;
+
+    const char *text_model = models != NULL ? models->text : NULL;
+    const char *image_model = models != NULL ? models->image : NULL;
+    if (!models_match(header->text_model, header->text_count, text_model) ||
+        !models_match(header->image_model, header->image_count, image_model)) {
+        pack_unmap(&map);
+        return INDEX_PACK_STATUS_MODEL_MISMATCH;
+    }
+    bool use_text = db != NULL && text_model != NULL && text_model[0] != '\0';
+    bool use_images = vs != NULL && image_model != NULL && image_model[0] != '\0';
+
+    size_t root_len = strlen(root);
+    while (root_len > 0 && root[root_len - 1] == '/') {
+        root_len--;
+    }
+
+    if (db != NULL) {
+        vectordb_begin_batch(db);
+    }
+    int pending = 0;
+    char path[4096];
+    for (int i = 0; i < (int)header->count && status == INDEX_PACK_STATUS_OK; i++) {
+        int32_t text_row = map.text_rows[i];
+        int32_t image_row = map.image_rows[i];
+        if (map.path_offsets[i] >= header->strings_size || text_row >= (int32_t)header->text_count ||
+            image_row >= (int32_t)header->image_count) {
+            status = INDEX_PACK_STATUS_INVALID;
+            break;
+        }
+        bool text = use_text && text_row >= 0;
+        bool image = use_images && image_row >= 0;
+        if (!text && !image) {
+            continue;
+        }
+
+        const char *relative = map.strings + map.path_offsets[i];
+        struct stat st;
+        if (snprintf(path, sizeof(path), "%.*s/%s", (int)root_len, root, relative) >= (int)sizeof(path) ||
+            stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            stats->missing++;
+            continue;
+        }
+        if (!entry_current(&map, i, path, &st, stats)) {
+            stats->stale++;
+            continue;
+        }
+
+        // What was indexed here stands: it may be newer than the pack
+        if (text && vectordb_is_indexed(db, path, (int64_t)st.st_mtime)) {
+            text = false;
+        }
+        if (!text && !image) {
+            stats->current++;
+            continue;
+        }
+
+        bool stored = true;
+        if (text) {
+            float embedding[EMBEDDING_DIMENSION];
+            const int8_t *codes = map.text_codes + (size_t)text_row * EMBEDDING_DIMENSION;
+            for (int d = 0; d < EMBEDDING_DIMENSION; d++) {
+                embedding[d] = (float)codes[d] * map.text_scales[text_row];
+            }
+            vector_normalize(embedding, EMBEDDING_DIMENSION);
+
+            char hex[FILE_HASH_HEX_SIZE] = "";
+            if (map.hashes[i] != 0) {
+                file_hash_to_hex(map.hashes[i], hex);
+            }
+            stored = vectordb_index_file_with_hash(db, path, path_basename(path),
+                                                   (IndexedFileType)map.file_types[i], (int64_t)st.st_size,
+                                                   (int64_t)st.st_mtime, hex, embedding) == VECTORDB_STATUS_OK;
+        }
+        if (image) {
+            float embedding[CLIP_EMBEDDING_DIMENSION];
+            const int8_t *codes = map.image_codes + (size_t)image_row * CLIP_EMBEDDING_DIMENSION;
+            for (int d = 0; d < CLIP_EMBEDDING_DIMENSION; d++) {
+                embedding[d] = (float)codes[d] * map.image_scales[image_row];
+            }
+            stored = visual_search_index_embedding(vs, path, embedding, map.image_widths[image_row],
+                                                   map.image_heights[image_row], (int64_t)st.st_size,
+                                                   st.st_mtime) && stored;
+        }
+        if (!stored) {
+            status = INDEX_PACK_STATUS_DB_ERROR;
+            break;
+        }
+        stats->imported++;
+
+        if (db != NULL && ++pending >= INDEX_PACK_IMPORT_BATCH) {
+            vectordb_commit_batch(db);
+            vectordb_begin_batch(db);
+            pending = 0;
+        }
+    }
+    if (db != NULL && vectordb_commit_batch(db) != VECTORDB_STATUS_OK && status == INDEX_PACK_STATUS_OK) {
+        status = INDEX_PACK_STATUS_DB_ERROR;
+    }
+
+    pack_unmap(&map);
+    return status;
+}
+
+const char* index_pack_status_message(IndexPackStatus status)
+{
+    switch (status) {
+        case INDEX_PACK_STATUS_OK:
+            return "Success";
+        case INDEX_PACK_STATUS_IO_ERROR:
+            return "Index pack could not be read or written";
+        case INDEX_PACK_STATUS_INVALID:
+            return "Not a valid index pack";
+        case INDEX_PACK_STATUS_MODEL_MISMATCH:
+            return "Index pack was made with different models";
+        case INDEX_PACK_STATUS_MEMORY_ERROR:
+            return "Out of memory";
+        case INDEX_PACK_STATUS_DB_ERROR:
+            return "Database error";
+        default:
+            return "Unknown error";
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef INDEX_PACK_H
+#define INDEX_PACK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "vectordb.h"
+#include "visual_search.h"
+
+// Index packs: the semantic index of one folder tree (typically a shared network
+// volume) exported to a single file, so one machine embeds the share and everyone who
+// mounts it imports the result instead of embedding it again. Entries are stored
+// column by column with paths relative to the exported folder, each file's size,
+// modification time and content hash, its text and image embeddings as int8 codes
+// with a scale, and the names of the models that made them. The pack is read through
+// a read-only mapping; an entry is taken only for a file whose size and mtime still
+// match, or whose content still hashes the same, and only from the same models
+
+// Longest model name a pack records
+#define INDEX_PACK_MODEL_SIZE 64
+
+// Entries written to the database per transaction while importing
+#define INDEX_PACK_IMPORT_BATCH 512
+
+typedef enum IndexPackStatus {
+    INDEX_PACK_STATUS_OK = 0,
+    INDEX_PACK_STATUS_IO_ERROR,             // Pack could not be written, opened or mapped
+    INDEX_PACK_STATUS_INVALID,              // Not a pack, another version, or truncated
+    INDEX_PACK_STATUS_MODEL_MISMATCH,       // Made by models other than the ones in use
+    INDEX_PACK_STATUS_MEMORY_ERROR,
+    INDEX_PACK_STATUS_DB_ERROR
+} IndexPackStatus;
+
+// Models an index was made with (a name per model; "" or NULL when unused)
+typedef struct IndexPackModels {
+    const char *text;
+    const char *image;
+} IndexPackModels;
+
+// What an export or import did
+typedef struct IndexPackStats {
+    int entries;            // Files in the pack
+    int text_entries;       // With a text embedding
+    int image_entries;      // With an image embedding
+    int imported;           // Files taken from the pack
+    int hashed;             // Of those, matched by content hash after their mtime changed
+    int current;            // Already indexed here, left as they were
+    int stale;              // Changed since the pack was made
+    int missing;            // Not found under the import folder
+} IndexPackStats;
+
+// Write the index of everything under root (text from db, images from vs; either may
+// be NULL) to pack_path. stats may be NULL
+IndexPackStatus index_pack_export(VectorDB *db, VisualSearch *vs, const char *root,
+                                  const IndexPackModels *models, const char *pack_path,
+                                  IndexPackStats *stats);
+
+// Index the files of a pack found under root, the folder the packed tree is mounted at
+// here, without embedding them. Files indexed here already are left alone. stats may
+// be NULL
+IndexPackStatus index_pack_import(VectorDB *db, VisualSearch *vs, const char *pack_path,
+                                  const char *root, const IndexPackModels *models,
+                                  IndexPackStats *stats);
+
+// Get status message
+const char* index_pack_status_message(IndexPackStatus status);
+
+#endif // INDEX_PACK_H
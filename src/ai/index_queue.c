@@ -0,0 +1,344 @@
+#include "index_queue.h"
+#include "../utils/hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define NIL (-1)
+
+// Entries due now are handed out from the first two lanes; waiting ones sit in the
+// third, ordered by when they fall due
+enum {
+    LANE_VISIBLE = 0,
+    LANE_NORMAL,
+    LANE_WAITING,
+    LANE_COUNT
+};
+
+typedef struct QueueEntry {
+    char *path;                 // NULL when the slot is free
+    uint32_t hash;
+    int chain;                  // Next entry in the bucket, or next free slot
+    int prev;                   // Lane neighbours
+    int next;
+    int lane;
+    bool visible;
+    double due;                 // When a waiting entry may be handed out
+    double first_added;         // Caps how long a hot path can wait
+} QueueEntry;
+
+struct IndexQueue {
+    QueueEntry *entries;
+    int capacity;
+    int count;
+    int free_head;
+
+    int *buckets;               // Power of two, at least twice capacity
+    uint32_t bucket_mask;
+
+    int head[LANE_COUNT];
+    int tail[LANE_COUNT];
+
+    char *visible_dirs[INDEX_QUEUE_MAX_VISIBLE_DIRS];
+    size_t visible_lens[INDEX_QUEUE_MAX_VISIBLE_DIRS];
+    int visible_count;
+};
+
+static void lane_unlink(IndexQueue *queue, int index)
+{
+    QueueEntry *entry = &queue->entries[index];
+    if (entry->prev != NIL) {
+        queue->entries[entry->prev].next = entry->next;
+    } else {
+        queue->head[entry->lane] = entry->next;
+    }
+    if (entry->next != NIL) {
+        queue->entries[entry->next].prev = entry->prev;
+    } else {
+        queue->tail[entry->lane] = entry->prev;
+    }
+    entry->prev = NIL;
+    entry->next = NIL;
+}
+
+// Insert after the entry at `after` (NIL for the front of the lane)
+static void lane_insert_after(IndexQueue *queue, int lane, int after, int index)
+{
+    QueueEntry *entry = &queue->entries[index];
+    entry->lane = lane;
+    entry->prev = after;
+    entry->next = after == NIL ? queue->head[lane] : queue->entries[after].next;
+    if (entry->next != NIL) {
+        queue->entries[entry->next].prev = index;
+    } else {
+        queue->tail[lane] = index;
+    }
+    if (after != NIL) {
+        queue->entries[after].next = index;
+    } else {
+        queue->head[lane] = index;
+    }
+}
+
+// Waiting entries stay sorted by due time; with one delay for all, that is the tail
+static void lane_insert_waiting(IndexQueue *queue, int index)
+{
+    int after = queue->tail[LANE_WAITING];
+    while (after != NIL && queue->entries[after].due > queue->entries[index].due) {
+        after = queue->entries[after].prev;
+    }
+    lane_insert_after(queue, LANE_WAITING, after, index);
+}
+
+static int ready_lane(const QueueEntry *entry)
+{
+    return entry->visible ? LANE_VISIBLE : LANE_NORMAL;
+}
+
+// Whether path sits directly in one of the visible folders
+static bool path_visible(const IndexQueue *queue, const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    if (slash == NULL) {
+        return false;
+    }
+    size_t dir_len = slash == path ? 1 : (size_t)(slash - path);
+    for (int i = 0; i < queue->visible_count; i++) {
+        if (queue->visible_lens[i] == dir_len && memcmp(queue->visible_dirs[i], path, dir_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int find_entry(const IndexQueue *queue, const char *path, uint32_t hash)
+{
+    for (int i = queue->buckets[hash & queue->bucket_mask]; i != NIL; i = queue->entries[i].chain) {
+        if (queue->entries[i].hash == hash && strcmp(queue->entries[i].path, path) == 0) {
+            return i;
+        }
+    }
+    return NIL;
+}
+
+static void remove_entry(IndexQueue *queue, int index)
+{
+    QueueEntry *entry = &queue->entries[index];
+    lane_unlink(queue, index);
+
+    int *link = &queue->buckets[entry->hash & queue->bucket_mask];
+    while (*link != index) {
+        link = &queue->entries[*link].chain;
+    }
+    *link = entry->chain;
+
+    free(entry->path);
+    entry->path = NULL;
+    entry->chain = queue->free_head;
+    queue->free_head = index;
+    queue->count--;
+}
+
+IndexQueue* index_queue_create(int capacity)
+{
+    if (capacity <= 0) {
+        return NULL;
+    }
+
+    IndexQueue *queue = calloc(1, sizeof(IndexQueue));
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    uint32_t bucket_count = 16;
+    while (bucket_count < (uint32_t)capacity * 2) {
+        bucket_count *= 2;
+    }
+
+    queue->entries = malloc((size_t)capacity * sizeof(QueueEntry));
+    queue->buckets = malloc((size_t)bucket_count * sizeof(int));
+    if (queue->entries == NULL || queue->buckets == NULL) {
+        free(queue->entries);
+        free(queue->buckets);
+        free(queue);
+        return NULL;
+    }
+
+    queue->capacity = capacity;
+    queue->bucket_mask = bucket_count - 1;
+    memset(queue->buckets, 0xff, (size_t)bucket_count * sizeof(int));
+    for (int i = 0; i < capacity; i++) {
+        queue->entries[i].path = NULL;
+        queue->entries[i].chain = i + 1 < capacity ? i + 1 : NIL;
+    }
+    queue->free_head = 0;
+    for (int lane = 0; lane < LANE_COUNT; lane++) {
+        queue->head[lane] = NIL;
+        queue->tail[lane] = NIL;
+    }
+    return queue;
+}
+
+void index_queue_destroy(IndexQueue *queue)
+{
+    if (queue == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < queue->capacity; i++) {
+        free(queue->entries[i].path);
+    }
+    for (int i = 0; i < queue->visible_count; i++) {
+        free(queue->visible_dirs[i]);
+    }
+    free(queue->entries);
+    free(queue->buckets);
+    free(queue);
+}
+
+IndexQueueResult index_queue_push(IndexQueue *queue, const char *path, double now, double delay)
+{
+    if (queue == NULL || path == NULL) {
+        return INDEX_QUEUE_FULL;
+    }
+
+    uint32_t hash = hash_fnv1a(path);
+    int index = find_entry(queue, path, hash);
+    if (index != NIL) {
+        // Still changing: push the wait back, but not forever
+        QueueEntry *entry = &queue->entries[index];
+        if (entry->lane == LANE_WAITING && delay > 0) {
+            double due = now + delay;
+            double limit = entry->first_added + INDEX_QUEUE_MAX_DEFER;
+            entry->due = due < limit ? due : limit;
+            lane_unlink(queue, index);
+            lane_insert_waiting(queue, index);
+        }
+        return INDEX_QUEUE_MERGED;
+    }
+
+    if (queue->free_head == NIL) {
+        return INDEX_QUEUE_FULL;
+    }
+    char *copy = strdup(path);
+    if (copy == NULL) {
+        return INDEX_QUEUE_FULL;
+    }
+
+    index = queue->free_head;
+    QueueEntry *entry = &queue->entries[index];
+    queue->free_head = entry->chain;
+
+    entry->path = copy;
+    entry->hash = hash;
+    entry->chain = queue->buckets[hash & queue->bucket_mask];
+    queue->buckets[hash & queue->bucket_mask] = index;
+    entry->visible = path_visible(queue, path);
+    entry->first_added = now;
+    entry->due = now + (delay > 0 ? delay : 0);
+    if (delay > 0) {
+        lane_insert_waiting(queue, index);
+    } else {
+        int lane = ready_lane(entry);
+        lane_insert_after(queue, lane, queue->tail[lane], index);
+    }
+    queue->count++;
+    return INDEX_QUEUE_ADDED;
+}
+
+bool index_queue_pop(IndexQueue *queue, double now, char *path, size_t path_size)
+{
+    if (queue == NULL || queue->count == 0) {
+        return false;
+    }
+
+    // Waiting entries whose time has come join their lane
+    while (queue->head[LANE_WAITING] != NIL && queue->entries[queue->head[LANE_WAITING]].due <= now) {
+        int index = queue->head[LANE_WAITING];
+        int lane = ready_lane(&queue->entries[index]);
+        lane_unlink(queue, index);
+        lane_insert_after(queue, lane, queue->tail[lane], index);
+    }
+
+    int index = queue->head[LANE_VISIBLE] != NIL ? queue->head[LANE_VISIBLE] : queue->head[LANE_NORMAL];
+    if (index == NIL) {
+        return false;
+    }
+
+    snprintf(path, path_size, "%s", queue->entries[index].path);
+    remove_entry(queue, index);
+    return true;
+}
+
+double index_queue_next_due(const IndexQueue *queue, double now)
+{
+    if (queue == NULL || queue->head[LANE_WAITING] == NIL) {
+        return -1.0;
+    }
+
+    double wait = queue->entries[queue->head[LANE_WAITING]].due - now;
+    return wait > 0 ? wait : 0;
+}
+
+int index_queue_count(const IndexQueue *queue)
+{
+    return queue ? queue->count : 0;
+}
+
+void index_queue_set_visible(IndexQueue *queue, const char *const *dirs, int count)
+{
+    if (queue == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < queue->visible_count; i++) {
+        free(queue->visible_dirs[i]);
+    }
+    queue->visible_count = 0;
+
+    for (int i = 0; i < count && queue->visible_count < INDEX_QUEUE_MAX_VISIBLE_DIRS; i++) {
+        if (dirs[i] == NULL || dirs[i][0] == '\0') {
+            continue;
+        }
+        char *dir = strdup(dirs[i]);
+        if (dir == NULL) {
+            break;
+        }
+        size_t len = strlen(dir);
+        while (len > 1 && dir[len - 1] == '/') {
+            dir[--len] = '\0';
+        }
+        queue->visible_dirs[queue->visible_count] = dir;
+        queue->visible_lens[queue->visible_count] = len;
+        queue->visible_count++;
+    }
+
+    // No longer visible: back to the front of the normal lane, ahead of the backlog
+    int after = NIL;
+    for (int index = queue->head[LANE_VISIBLE]; index != NIL;) {
+        int next = queue->entries[index].next;
+        if (!path_visible(queue, queue->entries[index].path)) {
+            queue->entries[index].visible = false;
+            lane_unlink(queue, index);
+            lane_insert_after(queue, LANE_NORMAL, after, index);
+            after = index;
+        }
+        index = next;
+    }
+
+    // Newly visible: to the visible lane, keeping their order
+    for (int index = queue->head[LANE_NORMAL]; index != NIL;) {
+        int next = queue->entries[index].next;
+        if (path_visible(queue, queue->entries[index].path)) {
+            queue->entries[index].visible = true;
+            lane_unlink(queue, index);
+            lane_insert_after(queue, LANE_VISIBLE, queue->tail[LANE_VISIBLE], index);
+        }
+        index = next;
+    }
+
+    for (int index = queue->head[LANE_WAITING]; index != NIL; index = queue->entries[index].next) {
+        queue->entries[index].visible = path_visible(queue, queue->entries[index].path);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef INDEX_QUEUE_H
+#define INDEX_QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bounded set of paths waiting to be indexed. A path is queued at most once: adding it
+// again merges into the queued entry. Files directly in a visible folder (the browsed
+// one, open tabs) are handed out before the rest, and files added with a delay wait
+// until they stop changing. Not thread-safe; the indexer guards it with its mutex
+
+// Maximum visible folders
+#define INDEX_QUEUE_MAX_VISIBLE_DIRS 64
+
+// Seconds a path that keeps changing can keep putting itself off
+#define INDEX_QUEUE_MAX_DEFER 30.0
+
+typedef enum IndexQueueResult {
+    INDEX_QUEUE_ADDED = 0,
+    INDEX_QUEUE_MERGED,                 // Already queued
+    INDEX_QUEUE_FULL
+} IndexQueueResult;
+
+// Index queue (opaque)
+typedef struct IndexQueue IndexQueue;
+
+// Create a queue holding at most capacity paths
+IndexQueue* index_queue_create(int capacity);
+
+// Free the queue and any paths still in it
+void index_queue_destroy(IndexQueue *queue);
+
+// Queue path to be due delay seconds after now (0 = right away). Adding a path that is
+// still waiting restarts its delay, up to INDEX_QUEUE_MAX_DEFER after it was first added
+IndexQueueResult index_queue_push(IndexQueue *queue, const char *path, double now, double delay);
+
+// Take the next due path: visible ones first, otherwise in the order they fell due
+bool index_queue_pop(IndexQueue *queue, double now, char *path, size_t path_size);
+
+// Seconds until a waiting path falls due (0 if one is due, -1 if none is waiting)
+double index_queue_next_due(const IndexQueue *queue, double now);
+
+// Queued paths, waiting ones included
+int index_queue_count(const IndexQueue *queue);
+
+// Make files directly inside dirs visible (replaces the previous set)
+void index_queue_set_visible(IndexQueue *queue, const char *const *dirs, int count);
+
+#endif // INDEX_QUEUE_H
@@ -0,0 +1,111 @@
+#include "index_shards.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// One sync at a time: two would open the same shard twice
+static pthread_mutex_t g_sync_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Volumes mounted now that have a shard
+typedef struct ShardVolumes {
+    VectorDB *db;
+    VolumeInfo volumes[VOLUMES_MAX];
+    int count;
+} ShardVolumes;
+
+// Helper: whether a volume keeps its own shard
+static bool has_shard(const VolumeInfo *volume)
+{
+    return strcmp(volume->path, "/") != 0 && !volume->remote && volume->uuid[0] != '\0';
+}
+
+// Helper: create a directory unless it exists
+static bool make_directory(const char *path)
+{
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+bool index_shards_path(const VolumeInfo *volume, bool on_volume, char *path, size_t size)
+{
+    if (volume == NULL || path == NULL || !has_shard(volume)) {
+        return false;
+    }
+
+    if (on_volume) {
+        snprintf(path, size, "%s/.finder-plus", volume->path);
+        if (make_directory(path) && access(path, W_OK) == 0) {
+            snprintf(path, size, "%s/.finder-plus/index.db", volume->path);
+            return true;
+        }
+    }
+
+    // Read-only volumes keep theirs in the home folder
+    const char *home = getenv("HOME");
+    if (home == NULL) {
+        return false;
+    }
+    snprintf(path, size, "%s/.config", home);
+    make_directory(path);
+    snprintf(path, size, "%s/.config/finder-plus", home);
+    make_directory(path);
+    snprintf(path, size, "%s/.config/finder-plus/shards", home);
+    if (!make_directory(path)) {
+        return false;
+    }
+    snprintf(path, size, "%s/.config/finder-plus/shards/%s.db", home, volume->uuid);
+    return true;
+}
+
+// Helper: detach a shard whose volume is no longer mounted (VectorDBPathFn)
+static bool detach_if_unmounted(const char *root, void *context)
+{
+    ShardVolumes *mounted = (ShardVolumes *)context;
+    for (int i = 0; i < mounted->count; i++) {
+        if (strcmp(mounted->volumes[i].path, root) == 0) {
+            return true;
+        }
+    }
+    vectordb_detach_shard(mounted->db, root);
+    return true;
+}
+
+int index_shards_sync(VectorDB *db, Volumes *volumes, bool on_volume)
+{
+    if (db == NULL || volumes == NULL) {
+        return 0;
+    }
+
+    ShardVolumes *mounted = malloc(sizeof(ShardVolumes));
+    if (mounted == NULL) {
+        return 0;
+    }
+    mounted->db = db;
+    mounted->count = 0;
+
+    VolumeInfo *listed = malloc(sizeof(VolumeInfo) * VOLUMES_MAX);
+    int count = listed != NULL ? volumes_list(volumes, listed, VOLUMES_MAX) : 0;
+    for (int i = 0; i < count; i++) {
+        if (has_shard(&listed[i])) {
+            mounted->volumes[mounted->count++] = listed[i];
+        }
+    }
+    free(listed);
+
+    pthread_mutex_lock(&g_sync_mutex);
+    vectordb_each_shard(db, detach_if_unmounted, mounted);
+    for (int i = 0; i < mounted->count; i++) {
+        char path[4096];
+        if (index_shards_path(&mounted->volumes[i], on_volume, path, sizeof(path))) {
+            vectordb_attach_shard(db, mounted->volumes[i].path, path);
+        }
+    }
+    int attached = vectordb_each_shard(db, NULL, NULL);
+    pthread_mutex_unlock(&g_sync_mutex);
+
+    free(mounted);
+    return attached;
+}
@@ -0,0 +1,24 @@
+#ifndef INDEX_SHARDS_H
+#define INDEX_SHARDS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "vectordb.h"
+#include "../core/volumes.h"
+
+// The semantic index of each mounted external volume in a database of its own, named
+// by the volume's UUID and attached to the main index while the volume is mounted (see
+// vectordb_attach_shard): unplugging a drive takes its files out of every search at
+// once, and plugging it back in finds them still indexed. A shard is kept on the volume
+// (<mount>/.finder-plus/index.db) when asked and the volume is writable, otherwise in
+// ~/.config/finder-plus/shards/<uuid>.db. Network volumes and the startup disk have none
+
+// Path of the shard of a volume; false if it has no UUID or no place for one
+bool index_shards_path(const VolumeInfo *volume, bool on_volume, char *path, size_t size);
+
+// Attach the shards of the mounted external volumes to db and detach those whose volume
+// is gone; returns how many are attached. Call again when volumes_generation moves.
+// Thread safe
+int index_shards_sync(VectorDB *db, Volumes *volumes, bool on_volume);
+
+#endif // INDEX_SHARDS_H
@@ -1,13 +1,69 @@
 #include "indexer.h"
-#include "../platform/fsevents.h"
+#include "vector_ops.h"
+#include "../utils/file_hash.h"
+#include "../core/fs_watch.h"
+#include "../core/stat_cache.h"
+#include "index_queue.h"
+#include "index_inbox.h"
+#include "content_extract.h"
+#include "extract_pool.h"
+#include "ignore_rules.h"
+#include "../utils/trace.h"
+#include "../utils/exclude_set.h"
+#include "../utils/file_type.h"
+#include "../platform/ocr.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <dirent.h>
+#include <errno.h>
 #include <sys/stat.h>
 #include <fnmatch.h>
 #include <time.h>
 #include <unistd.h>
+#ifdef __APPLE__
+#include <pthread/qos.h>
+#endif
+
+// Embeddings linked into the ANN graph per step while idle (bounds how long a search waits)
+#define INDEXER_GRAPH_BUILD_BUDGET 256
+
+// Files embedded by an earlier model queued at a time while idle; the next batch waits
+// until these are written, so new changes never queue behind more than one batch
+#define INDEXER_MIGRATE_BATCH 64
+
+// Database upkeep runs on the first idle stretch and then at most this often; unused
+// pages are given back this many per step so a new file never waits long behind it
+#define INDEXER_MAINTENANCE_INTERVAL_SEC (6 * 3600.0)
+#define INDEXER_VACUUM_PAGES 256
+
+// Files waiting for the pipeline; beyond this, event-driven adds are dropped and their
+// folders rescanned once the queue drains (the indexer's own scans wait for room)
+#define INDEXER_QUEUE_CAPACITY 65536
+#define INDEXER_MAX_RESCAN_DIRS 1024
+
+// Paths posted to the inbox and not yet moved into the queue; past this, posting
+// falls back to taking the mutex
+#define INDEXER_INBOX_CAPACITY 4096
+
+// Seconds a changed file must stay unchanged before it is indexed
+#define INDEXER_DEBOUNCE_SEC 2.0
+
+// Text kept per file for the full-text index: what the sections can cover
+#define INDEXER_TEXT_MAX ((size_t)CONTENT_MAX_CHUNKS * CONTENT_CHUNK_MAX)
+
+// Why should_index_file turns a file away
+typedef enum SkipReason {
+    SKIP_NONE = 0,
+    SKIP_NOT_FILE,              // Folder or special file: not counted
+    SKIP_EXCLUDED,
+    SKIP_TOO_LARGE
+} SkipReason;
+
+// scan_directory flags
+#define SCAN_RECURSE 0x1        // Descend into subfolders (if config.recursive)
+#define SCAN_WAIT    0x2        // Block for room in a full queue (worker thread only)
+#define SCAN_NO_CONTENT 0x4     // Ignore files leave the folder out of the vector index
 
 // Default exclude patterns
 static const char *DEFAULT_EXCLUDE_PATTERNS[] = {
@@ -29,24 +85,84 @@ static const char *DEFAULT_EXCLUDE_PATTERNS[] = {
     NULL
 };
 
-// File queue entry
-typedef struct FileQueueEntry {
+// File moving through the read, inference and write stages
+typedef struct PendingFile {
     char path[4096];
-    struct FileQueueEntry *next;
-} FileQueueEntry;
+    const char *name;           // Points into path
+    struct stat st;
+    IndexedFileType file_type;
+    ContentMap map;             // Text to embed (data NULL if none), unmapped once embedded
+    ContentChunk *chunks;       // Sections of the mapped text
+    int chunk_count;
+    int32_t *tokens;            // Ids of every section back to back (NULL if not tokenized)
+    int *token_starts;          // Section c's ids start at token_starts[c], end at [c + 1]
+    float *chunk_embeddings;    // One per section; zero where the engine gave none
+    char *text;                 // Text the sections cover, for the full-text index (NULL if none)
+    char content_hash[VECTORDB_CONTENT_HASH_SIZE];  // "" when not hashed
+    bool needs_ocr;             // Text only in its pixels: goes through the OCR stage
+    bool has_embedding;
+    float embedding[EMBEDDING_DIMENSION];   // Whole file: mean of its sections
+} PendingFile;
+
+// Section waiting in the inference stage
+typedef struct EmbedSection {
+    PendingFile *file;
+    int chunk;
+    int length;                 // Tokens, or bytes for a file without them
+} EmbedSection;
+
+// Inference stage buffers, each for one batch (sections: every section of one)
+typedef struct EmbedScratch {
+    EmbedSection *sections;
+    char *text_buffers;
+    const char **texts;
+    const int32_t **tokens;
+    int *counts;
+    float **targets;
+} EmbedScratch;
+
+// Bounded queue between two pipeline stages
+typedef struct StageQueue {
+    PendingFile **items;        // Ring buffer
+    int capacity;
+    int head;
+    int count;
+    bool closed;                // No more pushes; pops drain what is left
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} StageQueue;
 
 // Indexer internal structure
 struct Indexer {
     IndexerConfig config;
     EmbeddingEngine *embedding_engine;
     VectorDB *vectordb;
+    PathIndex *path_index;
+    HashCache *hash_cache;
 
     // Threading
     pthread_t worker_thread;
     pthread_mutex_t mutex;
-    pthread_cond_t cond;
+    pthread_cond_t cond;        // Worker: pipeline drained, work after idle, state changes
+    pthread_cond_t work_cond;   // Readers: a queued file may be due
+    pthread_cond_t room_cond;   // Waiting scans: the queue has room again
     bool thread_running;
 
+    // Pipeline: readers -> read_queue -> inference -> write_queue -> writer, with images
+    // and scans going readers -> ocr_queue -> OCR -> read_queue
+    pthread_t reader_threads[INDEXER_MAX_READER_THREADS];
+    int reader_count;
+    pthread_t ocr_thread;
+    pthread_t embed_thread;
+    pthread_t write_thread;
+    bool pipeline_running;
+    StageQueue ocr_queue;
+    StageQueue read_queue;
+    StageQueue write_queue;
+    int64_t in_pipeline;        // Files dequeued but not yet written or dropped
+    IndexerThrottle throttle;   // Pace set by indexer_set_throttle
+
     // Status
     IndexerStatus status;
     IndexerStats stats;
@@ -59,28 +175,68 @@ struct Indexer {
     IndexerProgressCallback progress_callback;
     void *progress_user_data;
 
-    // File queue
-    FileQueueEntry *queue_head;
-    FileQueueEntry *queue_tail;
-    int queue_size;
+    // Files to index, deduplicated, visible folders first
+    IndexQueue *queue;
+    IndexQueue *rescan_dirs;    // Folders of files dropped on a full queue
+    bool rescan_roots;          // Too many dropped folders to track
+
+    // Paths posted without the mutex (watch bus, reindex requests); whoever next takes
+    // work moves them into queue. Posters only lock to wake a thread asleep for work
+    IndexInbox inbox;
+    atomic_int sleepers;
+
+    // config.exclude_patterns compiled; scans read it unlocked, so replaced sets are
+    // kept until destroy
+    atomic_uintptr_t excludes;          // ExcludeSet *
+    ExcludeSet *retired_excludes[INDEXER_MAX_EXCLUDE_PATTERNS];
+    int retired_exclude_count;
+
+    // Ignore file rules along the folders of the last changed file
+    IgnoreStack *event_ignore;
+    pthread_mutex_t ignore_mutex;
 
     // For progress tracking
     int64_t total_files_to_index;
     bool initial_scan_complete;
 
-    // FSEvents watcher
-    FSEventsWatcher *watcher;
+    // Re-embedding files an earlier model embedded: the last path queued, the count when
+    // the pass began, and whether the pass is over (worker thread only)
+    char migrate_after[4096];
+    int64_t migrate_total;
+    bool migrate_done;
+
+    // Last database upkeep (worker thread only)
+    double maintained_at;
+    bool maintained;
+
+    // Watch bus subscriptions, one per watch directory
+    FsWatch *fs_watch;
+    int watch_ids[INDEXER_MAX_WATCH_DIRS];
+    int watch_id_count;
     bool watching_enabled;
 
+    // FSEvents checkpoint: roots with one saved in the vector DB replay the journal
+    // since then on start instead of being rescanned
+    uint64_t event_id_seen;     // Newest event whose changes are queued
+    bool replay_pending;        // Replay requested, history not yet caught up
+
     // Timing
     struct timespec start_time;
+
+    // Files and bytes written per second of the clock, for the recent rates
+    int64_t rate_second[INDEXER_RATE_WINDOW_SEC];
+    int64_t rate_files[INDEXER_RATE_WINDOW_SEC];
+    int64_t rate_bytes[INDEXER_RATE_WINDOW_SEC];
 };
 
 // Forward declarations
-static void scan_directory(Indexer *indexer, const char *dir_path);
-static void process_file(Indexer *indexer, const char *path);
+static void scan_directory(Indexer *indexer, const char *dir_path, int flags);
 static bool should_index_file(const Indexer *indexer, const char *path, struct stat *st);
-static void enqueue_file(Indexer *indexer, const char *path);
+static SkipReason file_skip_reason(const Indexer *indexer, const char *path, struct stat *st);
+static bool matches_exclude_pattern(const Indexer *indexer, const char *path);
+static bool excluded_below(const Indexer *indexer, const char *path, size_t skip);
+static bool path_index_wants(const Indexer *indexer, const char *path);
+static void enqueue_file(Indexer *indexer, const char *path, double delay, bool wait);
 
 // Helper: get current time in seconds
 static double get_current_time_sec(void)
@@ -90,30 +246,164 @@ static double get_current_time_sec(void)
     return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
-// FSEvents callback - called when files change
-static void fsevents_handler(const FSEvent *event, void *user_data)
+// Helper: seconds since start (call with mutex held, or before the pipeline runs)
+static double seconds_since_start(const Indexer *indexer)
 {
-    Indexer *indexer = (Indexer *)user_data;
-    if (indexer == NULL || event == NULL) {
+    return get_current_time_sec() - (indexer->start_time.tv_sec + indexer->start_time.tv_nsec / 1e9);
+}
+
+// Helper: add a sample to a stage histogram (call with mutex held)
+static void latency_record(IndexerLatency *latency, double seconds)
+{
+    double us = seconds * 1e6;
+    int bucket = 0;
+    while (bucket < INDEXER_LATENCY_BUCKETS - 1 && us >= (double)(1u << bucket)) {
+        bucket++;
+    }
+    latency->buckets[bucket]++;
+    latency->count++;
+    latency->total_ms += seconds * 1000.0;
+}
+
+// Helper: count a written file in the second it finished (call with mutex held)
+static void rate_record(Indexer *indexer, int64_t bytes)
+{
+    int64_t second = (int64_t)get_current_time_sec();
+    int slot = (int)(second % INDEXER_RATE_WINDOW_SEC);
+    if (indexer->rate_second[slot] != second) {
+        indexer->rate_second[slot] = second;
+        indexer->rate_files[slot] = 0;
+        indexer->rate_bytes[slot] = 0;
+    }
+    indexer->rate_files[slot]++;
+    indexer->rate_bytes[slot] += bytes;
+}
+
+// Whether a path belongs in the indexes (same rules as the scan, for every folder
+// between the watch root and the path)
+static bool path_index_wants(const Indexer *indexer, const char *path)
+{
+    return !matches_exclude_pattern(indexer, path);
+}
+
+// Keep the filename index in step with a change
+static void update_path_index(Indexer *indexer, const FsWatchChange *change)
+{
+    struct stat st;
+    switch (change->type) {
+        case FSEVENT_CREATED:
+        case FSEVENT_MODIFIED:
+            if (path_index_wants(indexer, change->path)) {
+                path_index_add(indexer->path_index, change->path);
+            }
+            break;
+
+        case FSEVENT_DELETED:
+        case FSEVENT_DIR_DELETED:
+            path_index_remove(indexer->path_index, change->path);
+            break;
+
+        case FSEVENT_DIR_CREATED:
+        case FSEVENT_RENAMED:
+            if (!stat_cache_lstat(change->path, &st)) {
+                path_index_remove(indexer->path_index, change->path);
+            } else if (path_index_wants(indexer, change->path)) {
+                path_index_add(indexer->path_index, change->path);
+                // A directory moved in brings its contents along
+                if (S_ISDIR(st.st_mode) && indexer->config.recursive) {
+                    scan_directory(indexer, change->path, SCAN_RECURSE);
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Helper: whether the ignore files leave a file out of the vector index
+static bool content_ignored(Indexer *indexer, const char *path)
+{
+    if (!indexer->config.respect_ignore_files) {
+        return false;
+    }
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (slash == NULL || slash == dir) {
+        return false;
+    }
+    *slash = '\0';
+
+    pthread_mutex_lock(&indexer->ignore_mutex);
+    bool ignored = !ignore_stack_enter(indexer->event_ignore, dir) ||
+                   ignore_stack_match(indexer->event_ignore, path, false);
+    pthread_mutex_unlock(&indexer->ignore_mutex);
+    return ignored;
+}
+
+// Apply one changed path
+static void handle_change(Indexer *indexer, const FsWatchChange *change)
+{
+    // Changed rules: read them again, and rescan for the files they no longer leave out
+    if (indexer->config.respect_ignore_files && indexer->vectordb != NULL &&
+        ignore_rules_file(change->path)) {
+        pthread_mutex_lock(&indexer->ignore_mutex);
+        ignore_stack_clear(indexer->event_ignore);
+        pthread_mutex_unlock(&indexer->ignore_mutex);
+
+        char dir[4096];
+        snprintf(dir, sizeof(dir), "%s", change->path);
+        char *info = strstr(dir, "/.git/info/");
+        char *slash = info ? info : strrchr(dir, '/');
+        if (slash != NULL && slash != dir) {
+            *slash = '\0';
+            scan_directory(indexer, dir, SCAN_RECURSE);
+        }
+    }
+
+    // Events below the path were lost: rescan it
+    if (change->flags & FSEVENT_FLAG_MUST_SCAN) {
+        if (indexer->hash_cache != NULL) {
+            hash_cache_invalidate(indexer->hash_cache, change->path);
+        }
+        if (path_index_wants(indexer, change->path)) {
+            scan_directory(indexer, change->path, SCAN_RECURSE);
+        }
         return;
     }
 
+    if (indexer->path_index != NULL) {
+        update_path_index(indexer, change);
+    }
+
+    // Any event may mean new content under the path; the next scan rehashes it
+    if (indexer->hash_cache != NULL) {
+        hash_cache_invalidate(indexer->hash_cache, change->path);
+    }
+
     // Skip directories
-    if (event->flags & FSEVENT_FLAG_IS_DIR) {
+    if (change->flags & FSEVENT_FLAG_IS_DIR) {
         return;
     }
 
-    switch (event->type) {
+    // Nothing under an excluded folder is indexed, so only deletions need applying
+    bool wanted = path_index_wants(indexer, change->path) &&
+                  (change->type == FSEVENT_DELETED || !content_ignored(indexer, change->path));
+
+    switch (change->type) {
         case FSEVENT_CREATED:
         case FSEVENT_MODIFIED:
-            // Queue file for indexing
-            enqueue_file(indexer, event->path);
+            // Queue file for indexing once it stops changing
+            if (indexer->vectordb != NULL && wanted) {
+                enqueue_file(indexer, change->path, INDEXER_DEBOUNCE_SEC, false);
+            }
             break;
 
         case FSEVENT_DELETED:
             // Remove from index
             if (indexer->vectordb != NULL) {
-                vectordb_delete_file(indexer->vectordb, event->path);
+                vectordb_delete_file(indexer->vectordb, change->path);
             }
             break;
 
@@ -121,12 +411,14 @@ static void fsevents_handler(const FSEvent *event, void *user_data)
             // Handle rename: delete old, index new (if exists)
             if (indexer->vectordb != NULL) {
                 struct stat st;
-                if (stat(event->path, &st) == 0) {
+                if (stat_cache_stat(change->path, &st)) {
                     // New path exists - reindex
-                    enqueue_file(indexer, event->path);
+                    if (wanted) {
+                        enqueue_file(indexer, change->path, INDEXER_DEBOUNCE_SEC, false);
+                    }
                 } else {
                     // File was renamed away - delete from index
-                    vectordb_delete_file(indexer->vectordb, event->path);
+                    vectordb_delete_file(indexer->vectordb, change->path);
                 }
             }
             break;
@@ -136,6 +428,127 @@ static void fsevents_handler(const FSEvent *event, void *user_data)
     }
 }
 
+// Watch bus callback - called with the changes under one watch directory
+static void watch_batch_handler(const FsWatchBatch *batch, void *user_data)
+{
+    Indexer *indexer = (Indexer *)user_data;
+    if (indexer == NULL || batch == NULL) {
+        return;
+    }
+
+    if (batch->dirs_overflow) {
+        // Too much changed to say where (or the history was lost): rescan the whole directory
+        if (indexer->hash_cache != NULL) {
+            hash_cache_invalidate(indexer->hash_cache, batch->root);
+        }
+        scan_directory(indexer, batch->root, SCAN_RECURSE);
+    } else if (batch->changes_overflow) {
+        // Only the changed directories are known: rescan each of them
+        for (int i = 0; i < batch->dir_count; i++) {
+            if (indexer->hash_cache != NULL) {
+                hash_cache_invalidate(indexer->hash_cache, batch->dirs[i]);
+            }
+            scan_directory(indexer, batch->dirs[i], SCAN_RECURSE);
+        }
+    } else {
+        for (int i = 0; i < batch->change_count; i++) {
+            handle_change(indexer, &batch->changes[i]);
+        }
+    }
+
+    // Everything up to the batch's last event is queued; the checkpoint may move past it
+    // once the queue drains
+    pthread_mutex_lock(&indexer->mutex);
+    if (batch->last_event_id > indexer->event_id_seen) {
+        indexer->event_id_seen = batch->last_event_id;
+    }
+    if (batch->history_done && indexer->replay_pending) {
+        indexer->replay_pending = false;
+        pthread_cond_broadcast(&indexer->cond);
+    }
+    pthread_mutex_unlock(&indexer->mutex);
+}
+
+// Subscribe each watch directory to the bus (call with mutex held)
+static bool subscribe_watch_dirs(Indexer *indexer)
+{
+    if (indexer->fs_watch == NULL) {
+        return false;
+    }
+    if (indexer->watch_id_count > 0) {
+        return true;
+    }
+
+    for (int i = 0; i < indexer->config.watch_dir_count; i++) {
+        int id = fs_watch_subscribe(indexer->fs_watch, indexer->config.watch_dirs[i], true,
+                                    watch_batch_handler, indexer);
+        if (id > 0) {
+            indexer->watch_ids[indexer->watch_id_count++] = id;
+        }
+    }
+    return indexer->watch_id_count > 0;
+}
+
+// Drop the subscriptions (call without mutex held: a running callback may need it)
+static void unsubscribe_watch_dirs(Indexer *indexer)
+{
+    int ids[INDEXER_MAX_WATCH_DIRS];
+
+    pthread_mutex_lock(&indexer->mutex);
+    int count = indexer->watch_id_count;
+    memcpy(ids, indexer->watch_ids, (size_t)count * sizeof(int));
+    indexer->watch_id_count = 0;
+    pthread_mutex_unlock(&indexer->mutex);
+
+    for (int i = 0; i < count; i++) {
+        fs_watch_unsubscribe(indexer->fs_watch, ids[i]);
+    }
+}
+
+// Replay the journal for roots with a usable checkpoint (subscriptions must be in place);
+// marks them in replay and returns whether any will catch up that way
+static bool start_replay(Indexer *indexer, uint64_t current_id, bool *replay)
+{
+    if (indexer->vectordb == NULL || indexer->fs_watch == NULL || current_id == 0) {
+        return false;
+    }
+
+    uint64_t since = 0;
+    for (int i = 0; i < indexer->config.watch_dir_count; i++) {
+        uint64_t id;
+        // A checkpoint ahead of the journal means it was reset since
+        if (vectordb_get_watch_checkpoint(indexer->vectordb, indexer->config.watch_dirs[i], &id) &&
+            id > 0 && id <= current_id) {
+            replay[i] = true;
+            since = (since == 0 || id < since) ? id : since;
+        }
+    }
+    if (since == 0) {
+        return false;
+    }
+
+    pthread_mutex_lock(&indexer->mutex);
+    indexer->replay_pending = true;
+    pthread_mutex_unlock(&indexer->mutex);
+
+    if (!fs_watch_replay(indexer->fs_watch, since)) {
+        pthread_mutex_lock(&indexer->mutex);
+        indexer->replay_pending = false;
+        pthread_mutex_unlock(&indexer->mutex);
+        memset(replay, 0, (size_t)indexer->config.watch_dir_count * sizeof(bool));
+        return false;
+    }
+    return true;
+}
+
+// Record event_id as applied for every root (the queue must be drained)
+static void save_checkpoints(Indexer *indexer, uint64_t event_id)
+{
+    for (int i = 0; i < indexer->config.watch_dir_count; i++) {
+        vectordb_set_watch_checkpoint(indexer->vectordb, indexer->config.watch_dirs[i], event_id);
+    }
+}
+
 // Helper: update progress
 static void update_progress(Indexer *indexer)
 {
@@ -158,116 +571,168 @@ static void update_progress(Indexer *indexer)
     );
 }
 
-// Helper: check if path matches any exclude pattern
-static bool matches_exclude_pattern(const Indexer *indexer, const char *path)
+// Helper: build the matcher for the configured exclude patterns
+static ExcludeSet *compile_excludes(const IndexerConfig *config)
 {
-    const char *basename = strrchr(path, '/');
-    basename = basename ? basename + 1 : path;
-
-    for (int i = 0; i < indexer->config.exclude_pattern_count; i++) {
-        const char *pattern = indexer->config.exclude_patterns[i];
+    ExcludeSet *set = exclude_set_create();
+    if (set == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < config->exclude_pattern_count; i++) {
+        if (!exclude_set_add(set, config->exclude_patterns[i])) {
+            exclude_set_destroy(set);
+            return NULL;
+        }
+    }
+    return set;
+}
 
-        // Check both full path and basename
-        if (fnmatch(pattern, path, FNM_PATHNAME) == 0 ||
-            fnmatch(pattern, basename, 0) == 0) {
-            return true;
+// Helper: whether a name in path after the first skip bytes is hidden or excluded,
+// or the whole path matches a pattern with '/'
+static bool excluded_below(const Indexer *indexer, const char *path, size_t skip)
+{
+    if (!indexer->config.index_hidden_files) {
+        size_t len = strlen(path);
+        for (const char *c = path + (skip < len ? skip : len); *c; c++) {
+            if (c[0] == '.' && (c == path || c[-1] == '/')) {
+                return true;
+            }
         }
     }
+    return exclude_set_match((ExcludeSet *)atomic_load(&indexer->excludes), path, skip);
+}
 
-    return false;
+// Helper: check if a path is hidden or excluded anywhere below the watch directory
+// holding it (the whole path when none does)
+static bool matches_exclude_pattern(const Indexer *indexer, const char *path)
+{
+    size_t skip = 0;
+    for (int i = 0; i < indexer->config.watch_dir_count; i++) {
+        const char *root = indexer->config.watch_dirs[i];
+        size_t len = strlen(root);
+        while (len > 1 && root[len - 1] == '/') {
+            len--;
+        }
+        if (len > skip && strncmp(path, root, len) == 0 && (path[len] == '\0' || path[len] == '/')) {
+            skip = len;
+        }
+    }
+    return excluded_below(indexer, path, skip);
 }
 
-// Helper: check if file should be indexed based on type and size
-static bool should_index_file(const Indexer *indexer, const char *path, struct stat *st)
+// Helper: why a file should not be indexed, based on type and size
+static SkipReason file_skip_reason(const Indexer *indexer, const char *path, struct stat *st)
 {
     // Skip directories (they're enumerated, not indexed)
     if (S_ISDIR(st->st_mode)) {
-        return false;
+        return SKIP_NOT_FILE;
     }
 
     // Skip non-regular files
     if (!S_ISREG(st->st_mode)) {
-        return false;
+        return SKIP_NOT_FILE;
     }
 
     // Skip hidden files if configured
     const char *basename = strrchr(path, '/');
     basename = basename ? basename + 1 : path;
     if (!indexer->config.index_hidden_files && basename[0] == '.') {
-        return false;
+        return SKIP_EXCLUDED;
     }
 
     // Skip files exceeding max size
     int64_t max_bytes = (int64_t)indexer->config.max_file_size_mb * 1024 * 1024;
     if (max_bytes > 0 && st->st_size > max_bytes) {
-        return false;
+        return SKIP_TOO_LARGE;
     }
 
-    // Skip excluded patterns
-    if (matches_exclude_pattern(indexer, path)) {
-        return false;
-    }
+    return SKIP_NONE;
+}
 
-    return true;
+// Helper: check if file should be indexed based on type, size and exclusions
+static bool should_index_file(const Indexer *indexer, const char *path, struct stat *st)
+{
+    return file_skip_reason(indexer, path, st) == SKIP_NONE &&
+           !matches_exclude_pattern(indexer, path);
 }
 
-// Helper: read file content for embedding
-static char* read_file_content(const char *path, size_t max_size)
+// Helper: remember the folder of a file the full queue turned away (call with mutex held)
+static void note_dropped_file(Indexer *indexer, const char *path)
 {
-    FILE *f = fopen(path, "r");
-    if (f == NULL) {
-        return NULL;
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (slash == NULL) {
+        return;
     }
+    *(slash == dir ? slash + 1 : slash) = '\0';
 
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    if (size <= 0) {
-        fclose(f);
-        return NULL;
+    if (index_queue_push(indexer->rescan_dirs, dir, 0, 0) == INDEX_QUEUE_FULL) {
+        indexer->rescan_roots = true;
     }
+}
 
-    if ((size_t)size > max_size) {
-        size = (long)max_size;
+// Helper: add a path to the queue (call with mutex held)
+static IndexQueueResult queue_path(Indexer *indexer, const char *path, double now, double delay)
+{
+    bool was_empty = index_queue_count(indexer->queue) == 0;
+    IndexQueueResult result = index_queue_push(indexer->queue, path, now, delay);
+    if (result == INDEX_QUEUE_ADDED) {
+        indexer->stats.files_pending = index_queue_count(indexer->queue);
+        indexer->stats.scan.processed++;
+
+        // One reader is enough; it passes the wakeup on while more is queued
+        pthread_cond_signal(&indexer->work_cond);
+        if (was_empty) {
+            pthread_cond_broadcast(&indexer->cond);
+        }
     }
+    return result;
+}
 
-    char *content = malloc((size_t)size + 1);
-    if (content == NULL) {
-        fclose(f);
-        return NULL;
+// Helper: move posted paths into the queue (call with mutex held)
+static void take_inbox(Indexer *indexer)
+{
+    IndexInboxItem *item = index_inbox_take(&indexer->inbox);
+    while (item != NULL) {
+        IndexInboxItem *next = item->next;
+        if (queue_path(indexer, item->path, item->time, item->delay) == INDEX_QUEUE_FULL) {
+            note_dropped_file(indexer, item->path);
+        }
+        free(item);
+        item = next;
     }
-
-    size_t read = fread(content, 1, (size_t)size, f);
-    content[read] = '\0';
-    fclose(f);
-
-    return content;
 }
 
-// Helper: enqueue a file for indexing
-static void enqueue_file(Indexer *indexer, const char *path)
+// Helper: enqueue a file for indexing, delay seconds from now; repeats merge into the
+// queued entry. Only the worker's own scans may wait for room in a full queue; other
+// callers (the watch bus, the UI) post to the inbox and return without locking unless
+// a thread is asleep waiting for work
+static void enqueue_file(Indexer *indexer, const char *path, double delay, bool wait)
 {
-    FileQueueEntry *entry = malloc(sizeof(FileQueueEntry));
-    if (entry == NULL) {
+    double now = get_current_time_sec();
+    if (!wait && index_inbox_post(&indexer->inbox, path, now, delay, INDEXER_INBOX_CAPACITY)) {
+        // Pairs with the sleepers count taken before a waiter checks the inbox
+        if (atomic_load(&indexer->sleepers) > 0) {
+            pthread_mutex_lock(&indexer->mutex);
+            take_inbox(indexer);
+            pthread_mutex_unlock(&indexer->mutex);
+        }
         return;
     }
 
-    strncpy(entry->path, path, sizeof(entry->path) - 1);
-    entry->next = NULL;
-
     pthread_mutex_lock(&indexer->mutex);
+    take_inbox(indexer);
 
-    if (indexer->queue_tail) {
-        indexer->queue_tail->next = entry;
-    } else {
-        indexer->queue_head = entry;
+    IndexQueueResult result = queue_path(indexer, path, now, delay);
+    while (result == INDEX_QUEUE_FULL && wait && indexer->thread_running) {
+        pthread_cond_wait(&indexer->room_cond, &indexer->mutex);
+        result = queue_path(indexer, path, get_current_time_sec(), delay);
+    }
+    if (result == INDEX_QUEUE_FULL) {
+        note_dropped_file(indexer, path);
     }
-    indexer->queue_tail = entry;
-    indexer->queue_size++;
-    indexer->stats.files_pending = indexer->queue_size;
 
-    pthread_cond_signal(&indexer->cond);
     pthread_mutex_unlock(&indexer->mutex);
 }
 
@@ -276,32 +741,62 @@ static bool dequeue_file(Indexer *indexer, char *path, size_t path_size)
 {
     pthread_mutex_lock(&indexer->mutex);
 
-    while (indexer->queue_head == NULL && indexer->thread_running && indexer->status != INDEXER_STATUS_STOPPED) {
-        pthread_cond_wait(&indexer->cond, &indexer->mutex);
+    bool found = false;
+    while (indexer->thread_running && indexer->status != INDEXER_STATUS_STOPPED) {
+        double now = get_current_time_sec();
+        take_inbox(indexer);
+        if (indexer->status != INDEXER_STATUS_PAUSED) {
+            bool was_full = index_queue_count(indexer->queue) == INDEXER_QUEUE_CAPACITY;
+            found = index_queue_pop(indexer->queue, now, path, path_size);
+            if (found) {
+                // A scan may be waiting for room
+                if (was_full) {
+                    pthread_cond_broadcast(&indexer->room_cond);
+                }
+                // More queued: wake another reader for it
+                if (index_queue_count(indexer->queue) > 0) {
+                    pthread_cond_signal(&indexer->work_cond);
+                }
+                break;
+            }
+        }
+
+        // Nothing due: sleep until the next debounced file is, or something is queued.
+        // Counting as a sleeper before looking at the inbox again means a poster either
+        // sees us and wakes us, or we see its path
+        double wait = indexer->status == INDEXER_STATUS_PAUSED ? -1.0
+                                                               : index_queue_next_due(indexer->queue, now);
+        atomic_fetch_add(&indexer->sleepers, 1);
+        if (index_inbox_count(&indexer->inbox) == 0) {
+            if (wait < 0) {
+                pthread_cond_wait(&indexer->work_cond, &indexer->mutex);
+            } else {
+                struct timespec deadline;
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                long long nsec = deadline.tv_nsec + (long long)(wait * 1e9) + 1000000LL;
+                deadline.tv_sec += (time_t)(nsec / 1000000000LL);
+                deadline.tv_nsec = (long)(nsec % 1000000000LL);
+                pthread_cond_timedwait(&indexer->work_cond, &indexer->mutex, &deadline);
+            }
+        }
+        atomic_fetch_sub(&indexer->sleepers, 1);
     }
 
-    if (indexer->queue_head == NULL) {
+    if (!found || !indexer->thread_running) {
         pthread_mutex_unlock(&indexer->mutex);
         return false;
     }
 
-    FileQueueEntry *entry = indexer->queue_head;
-    indexer->queue_head = entry->next;
-    if (indexer->queue_head == NULL) {
-        indexer->queue_tail = NULL;
-    }
-    indexer->queue_size--;
-    indexer->stats.files_pending = indexer->queue_size;
-
-    strncpy(path, entry->path, path_size - 1);
-    free(entry);
+    indexer->stats.files_pending = index_queue_count(indexer->queue);
+    indexer->in_pipeline++;
 
     pthread_mutex_unlock(&indexer->mutex);
     return true;
 }
 
-// Helper: scan directory and enqueue files
-static void scan_directory(Indexer *indexer, const char *dir_path)
+// Helper: scan a folder and enqueue files (SCAN_* flags), ignore holding the ignore
+// file rules down to dir_path (NULL when not honored or the folder is left out)
+static void scan_tree(Indexer *indexer, const char *dir_path, int flags, IgnoreStack *ignore)
 {
     if (indexer->status == INDEXER_STATUS_STOPPED) {
         return;
@@ -312,6 +807,11 @@ static void scan_directory(Indexer *indexer, const char *dir_path)
         return;
     }
 
+    // Counted here, added to the stats once per folder
+    int64_t excluded = 0;
+    int64_t too_large = 0;
+    size_t dir_len = strlen(dir_path);
+
     struct dirent *entry;
     while ((entry = readdir(dir)) != NULL) {
         if (indexer->status == INDEXER_STATUS_STOPPED) {
@@ -327,178 +827,1233 @@ static void scan_directory(Indexer *indexer, const char *dir_path)
         char full_path[4096];
         snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
 
+        // Hidden or excluded entries stay out of both indexes, and excluded folders are
+        // never entered. The folders above passed already, so only the name is tested
+        if (excluded_below(indexer, full_path, dir_len)) {
+            excluded++;
+            continue;
+        }
+
         // Get file info
         struct stat st;
-        if (lstat(full_path, &st) != 0) {
+        if (!stat_cache_lstat(full_path, &st)) {
             continue;
         }
 
+        if (indexer->path_index != NULL) {
+            path_index_add(indexer->path_index, full_path);
+        }
+
+        // What the ignore files leave out stays in the filename index only
+        bool is_dir = S_ISDIR(st.st_mode);
+        bool ignored = ignore != NULL && ignore_stack_match(ignore, full_path, is_dir);
+
         // Handle directories
-        if (S_ISDIR(st.st_mode)) {
-            if (indexer->config.recursive && !matches_exclude_pattern(indexer, full_path)) {
-                scan_directory(indexer, full_path);
+        if (is_dir) {
+            if ((flags & SCAN_RECURSE) && indexer->config.recursive) {
+                bool entered = !ignored && ignore != NULL && ignore_stack_push(ignore, full_path);
+                if (ignore != NULL && !entered) {
+                    excluded++;
+                    if (indexer->path_index == NULL) {
+                        continue;
+                    }
+                }
+                scan_tree(indexer, full_path, entered || ignore == NULL ? flags : flags | SCAN_NO_CONTENT,
+                          entered ? ignore : NULL);
+                if (entered) {
+                    ignore_stack_pop(ignore);
+                }
             }
             continue;
         }
 
+        if (ignored) {
+            excluded++;
+            continue;
+        }
+
         // Check if file should be indexed
-        if (should_index_file(indexer, full_path, &st)) {
-            enqueue_file(indexer, full_path);
+        if (indexer->vectordb != NULL && !(flags & SCAN_NO_CONTENT)) {
+            SkipReason reason = file_skip_reason(indexer, full_path, &st);
+            if (reason == SKIP_NONE) {
+                enqueue_file(indexer, full_path, 0, (flags & SCAN_WAIT) != 0);
+            } else if (reason == SKIP_EXCLUDED) {
+                excluded++;
+            } else if (reason == SKIP_TOO_LARGE) {
+                too_large++;
+            }
         }
     }
 
     closedir(dir);
+
+    // The filename index alone skips nothing the vector index would count
+    if (indexer->vectordb != NULL && (excluded > 0 || too_large > 0)) {
+        pthread_mutex_lock(&indexer->mutex);
+        indexer->stats.skipped.excluded += excluded;
+        indexer->stats.skipped.too_large += too_large;
+        pthread_mutex_unlock(&indexer->mutex);
+    }
 }
 
-// Helper: process a single file
-static void process_file(Indexer *indexer, const char *path)
+// Helper: scan directory and enqueue files (SCAN_* flags)
+static void scan_directory(Indexer *indexer, const char *dir_path, int flags)
 {
-    struct stat st;
-    if (stat(path, &st) != 0) {
+    if (!indexer->config.respect_ignore_files || indexer->vectordb == NULL) {
+        scan_tree(indexer, dir_path, flags, NULL);
+        return;
+    }
+
+    IgnoreStack *ignore = ignore_stack_create();
+    if (ignore != NULL && !ignore_stack_enter(ignore, dir_path)) {
+        flags |= SCAN_NO_CONTENT;
+        ignore_stack_destroy(ignore);
+        ignore = NULL;
+    }
+    if (indexer->path_index != NULL || !(flags & SCAN_NO_CONTENT)) {
+        scan_tree(indexer, dir_path, flags, ignore);
+    }
+    ignore_stack_destroy(ignore);
+}
+
+// Stage queues
+
+// Helper: drop the mapped text and sections of a file (its embeddings stay)
+static void release_content(PendingFile *file)
+{
+    content_map_close(&file->map);
+    free(file->chunks);
+    free(file->tokens);
+    free(file->token_starts);
+    file->chunks = NULL;
+    file->tokens = NULL;
+    file->token_starts = NULL;
+    file->chunk_count = 0;
+}
+
+static void free_pending(PendingFile *file)
+{
+    if (file == NULL) {
+        return;
+    }
+    release_content(file);
+    free(file->chunk_embeddings);
+    free(file->text);
+    free(file);
+}
+
+static bool stage_queue_init(StageQueue *queue, int capacity)
+{
+    memset(queue, 0, sizeof(StageQueue));
+    queue->items = malloc((size_t)capacity * sizeof(PendingFile *));
+    if (queue->items == NULL) {
+        return false;
+    }
+    queue->capacity = capacity;
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    return true;
+}
+
+static void stage_queue_destroy(StageQueue *queue)
+{
+    if (queue->items == NULL) {
+        return;
+    }
+
+    // Files left behind by a failed start
+    for (int i = 0; i < queue->count; i++) {
+        PendingFile *file = queue->items[(queue->head + i) % queue->capacity];
+        free_pending(file);
+    }
+    free(queue->items);
+    queue->items = NULL;
+    pthread_mutex_destroy(&queue->mutex);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+}
+
+// Helper: block while the queue is full; false once it is closed
+static bool stage_queue_push(StageQueue *queue, PendingFile *file)
+{
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == queue->capacity && !queue->closed) {
+        pthread_cond_wait(&queue->not_full, &queue->mutex);
+    }
+    if (queue->closed) {
+        pthread_mutex_unlock(&queue->mutex);
+        return false;
+    }
+
+    queue->items[(queue->head + queue->count) % queue->capacity] = file;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+    return true;
+}
+
+// Helper: wait for at least one file, then take up to max of those available.
+// Returns 0 once the queue is closed and empty
+static int stage_queue_pop_batch(StageQueue *queue, PendingFile **files, int max)
+{
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == 0 && !queue->closed) {
+        pthread_cond_wait(&queue->not_empty, &queue->mutex);
+    }
+
+    int taken = 0;
+    while (taken < max && queue->count > 0) {
+        files[taken++] = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+    }
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->mutex);
+    return taken;
+}
+
+// Helper: let consumers drain what is left, then see the end
+static void stage_queue_close(StageQueue *queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+    queue->closed = true;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+static int stage_queue_depth(StageQueue *queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+    int count = queue->count;
+    pthread_mutex_unlock(&queue->mutex);
+    return count;
+}
+
+// Helper: a dequeued file left the pipeline (written or dropped)
+static void finish_files(Indexer *indexer, int count)
+{
+    pthread_mutex_lock(&indexer->mutex);
+    indexer->in_pipeline -= count;
+    // The worker only waits for the pipeline to drain
+    if (indexer->in_pipeline == 0 && index_queue_count(indexer->queue) == 0) {
+        pthread_cond_broadcast(&indexer->cond);
+    }
+    pthread_mutex_unlock(&indexer->mutex);
+}
+
+// Helper: current throttle; moves the calling pipeline thread to the QoS class it asks
+// for when that changed since this thread last looked (*qos starts at -1)
+static IndexerThrottle follow_throttle(Indexer *indexer, int *qos)
+{
+    pthread_mutex_lock(&indexer->mutex);
+    IndexerThrottle throttle = indexer->throttle;
+    pthread_mutex_unlock(&indexer->mutex);
+
+    int wanted = throttle.background ? 1 : 0;
+    if (wanted != *qos) {
+        *qos = wanted;
+#ifdef __APPLE__
+        // Background QoS also throttles the thread's disk I/O
+        pthread_set_qos_class_self_np(throttle.background ? QOS_CLASS_BACKGROUND : QOS_CLASS_UTILITY, 0);
+#endif
+    }
+    return throttle;
+}
+
+// Helper: pause the inference stage between batches; cut short by indexer_stop
+static void throttle_sleep(Indexer *indexer, int delay_ms)
+{
+    if (delay_ms <= 0) {
+        return;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    long long nsec = deadline.tv_nsec + (long long)delay_ms * 1000000LL;
+    deadline.tv_sec += (time_t)(nsec / 1000000000LL);
+    deadline.tv_nsec = (long)(nsec % 1000000000LL);
+
+    pthread_mutex_lock(&indexer->mutex);
+    while (indexer->thread_running &&
+           pthread_cond_timedwait(&indexer->cond, &indexer->mutex, &deadline) == 0) {
+    }
+    pthread_mutex_unlock(&indexer->mutex);
+}
+
+// Helper: split the text in a file's map into sections to embed; leaves none if it is
+// binary or was truncated
+static void split_content(PendingFile *pending, const char *ext)
+{
+    ContentFormat format = content_format_for_file(ext, pending->file_type == FILE_TYPE_CODE);
+    pending->chunks = malloc(CONTENT_MAX_CHUNKS * sizeof(ContentChunk));
+    int count = pending->chunks != NULL
+        ? content_map_split(&pending->map, format, pending->chunks, CONTENT_MAX_CHUNKS) : -1;
+    if (count <= 0) {
+        release_content(pending);
+        return;
+    }
+    pending->chunk_count = count;
+
+    // Copied now: a copy of content already embedded is released before the
+    // inference stage, but still needs its own text searchable
+    const ContentChunk *last = &pending->chunks[count - 1];
+    ContentChunk covered = { 0, last->offset + last->length, "" };
+    if (covered.length > INDEXER_TEXT_MAX) {
+        covered.length = INDEXER_TEXT_MAX;
+    }
+    pending->text = malloc(covered.length + 1);
+    if (pending->text != NULL && !content_map_copy(&pending->map, &covered, pending->text, covered.length + 1)) {
+        free(pending->text);
+        pending->text = NULL;
+    }
+}
+
+// Helper: map a text file, or take a document's text from the extractor pool, and split
+// it into sections to embed; leaves none if it is binary or unreadable
+static void extract_content(PendingFile *pending, const char *ext)
+{
+    bool document = pending->file_type == FILE_TYPE_DOCUMENT;
+    if (document ? content_map_open_document(pending->path, &pending->map)
+                 : content_map_open(pending->path, &pending->map)) {
+        split_content(pending, ext);
+    }
+}
+
+// Helper: tokenize the sections in the read stage, so inference gets ids ready to batch
+// by length; leaves none if the engine has no tokenizer
+static void tokenize_sections(Indexer *indexer, PendingFile *pending)
+{
+    int32_t *tokens = malloc((size_t)pending->chunk_count * EMBEDDING_MAX_TOKENS * sizeof(int32_t));
+    int *starts = malloc((size_t)(pending->chunk_count + 1) * sizeof(int));
+    bool ok = tokens != NULL && starts != NULL;
+
+    char text[CONTENT_CHUNK_MAX + 1];
+    int used = 0;
+    for (int c = 0; ok && c < pending->chunk_count; c++) {
+        starts[c] = used;
+        text[0] = '\0';
+        content_map_copy(&pending->map, &pending->chunks[c], text, sizeof(text));
+        int count = embedding_tokenize(indexer->embedding_engine, text, strlen(text),
+                                       tokens + used, EMBEDDING_MAX_TOKENS);
+        ok = count >= 0;
+        used += ok ? count : 0;
+    }
+    if (!ok) {
+        free(tokens);
+        free(starts);
+        return;
+    }
+
+    starts[pending->chunk_count] = used;
+    int32_t *fitted = realloc(tokens, (size_t)(used > 0 ? used : 1) * sizeof(int32_t));
+    pending->tokens = fitted != NULL ? fitted : tokens;
+    pending->token_starts = starts;
+}
+
+// Helper: take the embedding of a file with the same content if one is stored, else
+// tokenize the sections still to embed; returns the seconds spent tokenizing
+static double finish_content(Indexer *indexer, PendingFile *pending)
+{
+    // Byte-identical files (vendored copies, duplicated datasets) reuse one embedding.
+    // Hashing the mapping spares a second read of the file
+    uint64_t hash;
+    if (pending->chunk_count > 0 && content_map_hash(&pending->map, &hash)) {
+        file_hash_to_hex(hash, pending->content_hash);
+        if (vectordb_get_content_embedding(indexer->vectordb, pending->content_hash, pending->embedding)) {
+            pending->has_embedding = true;
+            release_content(pending);
+
+            pthread_mutex_lock(&indexer->mutex);
+            indexer->stats.files_deduplicated++;
+            pthread_mutex_unlock(&indexer->mutex);
+        }
+    }
+
+    if (pending->chunk_count == 0) {
+        return 0.0;
+    }
+    double tokenize_start = get_current_time_sec();
+    tokenize_sections(indexer, pending);
+    return get_current_time_sec() - tokenize_start;
+}
+
+// Helper: stat and read a queued file; returns false if it needs no write
+static bool prepare_file(Indexer *indexer, const char *path, PendingFile *pending)
+{
+    TRACE_SCOPE("indexer_prepare_file");
+    if (indexer->vectordb == NULL) {
+        return false;
+    }
+
+    double start = get_current_time_sec();
+    bool exists = stat_cache_stat(path, &pending->st);
+    if (!exists || vectordb_is_indexed(indexer->vectordb, path, pending->st.st_mtime)) {
+        pthread_mutex_lock(&indexer->mutex);
+        indexer->stats.files_skipped++;
+        if (exists) {
+            indexer->stats.skipped.unchanged++;
+        } else {
+            indexer->stats.skipped.failed++;
+        }
+        pthread_mutex_unlock(&indexer->mutex);
+        return false;
+    }
+
+    strncpy(pending->path, path, sizeof(pending->path) - 1);
+    pending->path[sizeof(pending->path) - 1] = '\0';
+
+    // Get file info
+    const char *basename = strrchr(pending->path, '/');
+    pending->name = basename ? basename + 1 : pending->path;
+
+    const char *ext = strrchr(pending->name, '.');
+    ext = ext ? ext + 1 : "";
+    pending->file_type = vectordb_file_type_from_extension(ext);
+
+    // Map and split file content for embedding (text, code and documents); images and
+    // scans are left to the OCR stage
+    pending->map.data = NULL;
+    pending->map.size = 0;
+    pending->map.owned = false;
+    pending->chunks = NULL;
+    pending->chunk_count = 0;
+    pending->tokens = NULL;
+    pending->token_starts = NULL;
+    pending->chunk_embeddings = NULL;
+    pending->text = NULL;
+    pending->content_hash[0] = '\0';
+    pending->needs_ocr = false;
+    pending->has_embedding = false;
+    double extract_time = -1.0;
+    bool can_embed = indexer->embedding_engine != NULL && embedding_engine_is_available(indexer->embedding_engine);
+    uint8_t traits = file_type_info(file_type_from_extension(ext))->traits;
+    if (can_embed && (pending->file_type == FILE_TYPE_TEXT || pending->file_type == FILE_TYPE_CODE ||
+                      (pending->file_type == FILE_TYPE_DOCUMENT && extract_pool_handles(pending->path)))) {
+        double extract_start = get_current_time_sec();
+        extract_content(pending, ext);
+        extract_time = get_current_time_sec() - extract_start;
+        // A PDF without a text layer is a scan
+        pending->needs_ocr = indexer->config.ocr && pending->chunk_count == 0 && (traits & FILE_TRAIT_PDF);
+    } else if (can_embed && indexer->config.ocr && (traits & FILE_TRAIT_RASTER)) {
+        pending->needs_ocr = true;
+    }
+
+    // Content still to embed is tokenized here, counted as extraction
+    if (!pending->needs_ocr) {
+        extract_time += finish_content(indexer, pending);
+    }
+
+    // Hashing counts as reading: it walks the mapped pages
+    double read_time = get_current_time_sec() - start - (extract_time > 0.0 ? extract_time : 0.0);
+    pthread_mutex_lock(&indexer->mutex);
+    latency_record(&indexer->stats.read_latency, read_time);
+    if (extract_time >= 0.0) {
+        latency_record(&indexer->stats.extract_latency, extract_time);
+        if (pending->chunk_count == 0 && !pending->needs_ocr) {
+            indexer->stats.skipped.binary++;
+        }
+    }
+    pthread_mutex_unlock(&indexer->mutex);
+    return true;
+}
+
+// Read stage: several threads so disk reads overlap with inference
+static void* reader_thread_func(void *arg)
+{
+    Indexer *indexer = (Indexer *)arg;
+    trace_set_thread_name("indexer reader");
+    char path[4096];
+    int qos = -1;
+
+    follow_throttle(indexer, &qos);
+    while (dequeue_file(indexer, path, sizeof(path))) {
+        follow_throttle(indexer, &qos);
+        PendingFile *file = malloc(sizeof(PendingFile));
+        if (file == NULL || !prepare_file(indexer, path, file)) {
+            free(file);
+            finish_files(indexer, 1);
+            continue;
+        }
+
+        pthread_mutex_lock(&indexer->mutex);
+        indexer->stats.read.processed++;
+        pthread_mutex_unlock(&indexer->mutex);
+
+        if (!stage_queue_push(file->needs_ocr ? &indexer->ocr_queue : &indexer->read_queue, file)) {
+            free_pending(file);
+            finish_files(indexer, 1);
+        }
+    }
+    return NULL;
+}
+
+// Helper: recognize the text of a batch of images and scans and split it into sections
+// like text read from a file; files without any are left with none
+static void recognize_batch(PendingFile **files, int count)
+{
+    TRACE_SCOPE("indexer_recognize_batch");
+    const char *paths[INDEXER_OCR_BATCH];
+    PendingFile *images[INDEXER_OCR_BATCH];
+    int image_count = 0;
+    for (int i = 0; i < count; i++) {
+        PendingFile *file = files[i];
+        if (file->file_type != FILE_TYPE_DOCUMENT) {
+            paths[image_count] = file->path;
+            images[image_count++] = file;
+            continue;
+        }
+        char *text = NULL;
+        size_t length = 0;
+        if (platform_ocr_pdf(file->path, INDEXER_OCR_MAX_PAGES, true, CONTENT_DOCUMENT_TEXT_MAX, &text, &length)) {
+            file->map.data = text;
+            file->map.size = length;
+            file->map.owned = true;
+        }
+    }
+
+    // Images go through Vision together, sharing one request
+    char *texts[INDEXER_OCR_BATCH];
+    size_t lengths[INDEXER_OCR_BATCH];
+    platform_ocr_images(paths, image_count, true, CONTENT_DOCUMENT_TEXT_MAX, texts, lengths);
+    for (int i = 0; i < image_count; i++) {
+        if (texts[i] != NULL) {
+            images[i]->map.data = texts[i];
+            images[i]->map.size = lengths[i];
+            images[i]->map.owned = true;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (files[i]->map.data != NULL) {
+            split_content(files[i], "");
+        }
+    }
+}
+
+// OCR stage: images and scans a batch at a time, paced like inference, so their text
+// is embedded and searchable like any other file's
+static void* ocr_thread_func(void *arg)
+{
+    Indexer *indexer = (Indexer *)arg;
+    trace_set_thread_name("indexer ocr");
+    PendingFile *batch[INDEXER_OCR_BATCH];
+    int qos = -1;
+    IndexerThrottle throttle = follow_throttle(indexer, &qos);
+    int count;
+    while ((count = stage_queue_pop_batch(&indexer->ocr_queue, batch, INDEXER_OCR_BATCH)) > 0) {
+        throttle = follow_throttle(indexer, &qos);
+
+        double start = get_current_time_sec();
+        recognize_batch(batch, count);
+        double elapsed = get_current_time_sec() - start;
+        for (int i = 0; i < count; i++) {
+            finish_content(indexer, batch[i]);
+        }
+
+        pthread_mutex_lock(&indexer->mutex);
+        indexer->stats.ocr.processed += count;
+        latency_record(&indexer->stats.ocr_latency, elapsed);
+        pthread_mutex_unlock(&indexer->mutex);
+
+        for (int i = 0; i < count; i++) {
+            if (!stage_queue_push(&indexer->read_queue, batch[i])) {
+                free_pending(batch[i]);
+                finish_files(indexer, 1);
+            }
+        }
+
+        int delay_ms = indexer->config.delay_between_batches_ms;
+        throttle_sleep(indexer, throttle.batch_delay_ms > delay_ms ? throttle.batch_delay_ms : delay_ms);
+    }
+    return NULL;
+}
+
+// Helper: index of an earlier file in the batch with the same content to embed, or -1
+static int find_same_content(PendingFile **files, int index)
+{
+    const PendingFile *file = files[index];
+    if (file->content_hash[0] == '\0') {
+        return -1;
+    }
+    for (int i = 0; i < index; i++) {
+        if (files[i]->chunk_count > 0 && strcmp(files[i]->content_hash, file->content_hash) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Helper: shorter sections first, tokenized ones before the rest
+static int compare_sections(const void *a, const void *b)
+{
+    const EmbedSection *x = (const EmbedSection *)a;
+    const EmbedSection *y = (const EmbedSection *)b;
+    bool x_tokens = x->file->tokens != NULL;
+    bool y_tokens = y->file->tokens != NULL;
+    if (x_tokens != y_tokens) {
+        return x_tokens ? -1 : 1;
+    }
+    return (x->length > y->length) - (x->length < y->length);
+}
+
+// Helper: embed one batch of sections (all tokenized, or none) into their files'
+// section vectors (left zero where the engine fails)
+static void embed_sections(Indexer *indexer, const EmbedSection *sections, int count, EmbedScratch *scratch)
+{
+    TRACE_SCOPE("indexer_embed_texts");
+    bool tokenized = sections[0].file->tokens != NULL;
+    for (int i = 0; i < count; i++) {
+        PendingFile *file = sections[i].file;
+        int c = sections[i].chunk;
+        scratch->targets[i] = &file->chunk_embeddings[(size_t)c * EMBEDDING_DIMENSION];
+        if (tokenized) {
+            scratch->tokens[i] = file->tokens + file->token_starts[c];
+            scratch->counts[i] = file->token_starts[c + 1] - file->token_starts[c];
+        } else {
+            // Sections are copied out of the mappings one batch at a time, never whole files
+            char *text = &scratch->text_buffers[(size_t)i * (CONTENT_CHUNK_MAX + 1)];
+            content_map_copy(&file->map, &file->chunks[c], text, CONTENT_CHUNK_MAX + 1);
+            scratch->texts[i] = text;
+        }
+    }
+
+    double start = get_current_time_sec();
+    BatchEmbeddingResult result = tokenized
+        ? embedding_generate_batch_tokens(indexer->embedding_engine, scratch->tokens, scratch->counts, count)
+        : embedding_generate_batch(indexer->embedding_engine, scratch->texts, count);
+    double elapsed = get_current_time_sec() - start;
+    for (int i = 0; i < count && result.status == EMBEDDING_STATUS_OK && result.embeddings != NULL; i++) {
+        memcpy(scratch->targets[i], &result.embeddings[(size_t)i * EMBEDDING_DIMENSION],
+               EMBEDDING_DIMENSION * sizeof(float));
+    }
+    batch_embedding_result_free(&result);
+
+    pthread_mutex_lock(&indexer->mutex);
+    latency_record(&indexer->stats.infer_latency, elapsed);
+    indexer->stats.infer_batches++;
+    indexer->stats.infer_texts += count;
+    pthread_mutex_unlock(&indexer->mutex);
+}
+
+// Helper: the whole-file embedding is the mean of the sections the engine could encode
+static void combine_sections(PendingFile *file, int count)
+{
+    float sum[EMBEDDING_DIMENSION] = {0};
+    int used = 0;
+    for (int c = 0; c < count; c++) {
+        const float *section = &file->chunk_embeddings[(size_t)c * EMBEDDING_DIMENSION];
+        if (vector_dot(section, section, EMBEDDING_DIMENSION) > 0.0f) {
+            for (int d = 0; d < EMBEDDING_DIMENSION; d++) {
+                sum[d] += section[d];
+            }
+            used++;
+        }
+    }
+    if (used > 0 && vector_dot(sum, sum, EMBEDDING_DIMENSION) > 0.0f) {
+        memcpy(file->embedding, sum, sizeof(file->embedding));
+        vector_normalize(file->embedding, EMBEDDING_DIMENSION);
+        file->has_embedding = true;
+    }
+}
+
+// Inference stage: sections of the files read go to the engine batch_size at a time.
+// A batch is padded to its longest section, so the sections of all the files taken are
+// sorted by length first and batched in that order, short with short and long with
+// long. The engine is not reentrant, so a single thread drives it, with as many
+// inference threads as the throttle allows. This is the costly stage, so the pause
+// between batches is taken here
+static void* embed_thread_func(void *arg)
+{
+    Indexer *indexer = (Indexer *)arg;
+    trace_set_thread_name("indexer embed");
+    int batch_size = indexer->config.batch_size > 0 ? indexer->config.batch_size : 1;
+    PendingFile **files = malloc((size_t)batch_size * sizeof(PendingFile *));
+
+    EmbedScratch scratch;
+    scratch.sections = malloc((size_t)batch_size * CONTENT_MAX_CHUNKS * sizeof(EmbedSection));
+    scratch.text_buffers = malloc((size_t)batch_size * (CONTENT_CHUNK_MAX + 1));
+    scratch.texts = malloc((size_t)batch_size * sizeof(const char *));
+    scratch.tokens = malloc((size_t)batch_size * sizeof(const int32_t *));
+    scratch.counts = malloc((size_t)batch_size * sizeof(int));
+    scratch.targets = malloc((size_t)batch_size * sizeof(float *));
+    bool can_embed = scratch.sections != NULL && scratch.text_buffers != NULL && scratch.texts != NULL &&
+                     scratch.tokens != NULL && scratch.counts != NULL && scratch.targets != NULL;
+    if (files == NULL) {
+        // Pass everything through unembedded rather than stall the readers
+        batch_size = 1;
+        can_embed = false;
+    }
+
+    PendingFile *single = NULL;
+    PendingFile **batch = files != NULL ? files : &single;
+    int qos = -1;
+    IndexerThrottle throttle = follow_throttle(indexer, &qos);
+    int count;
+    while ((count = stage_queue_pop_batch(&indexer->read_queue, batch, batch_size)) > 0) {
+        throttle = follow_throttle(indexer, &qos);
+        embedding_engine_set_batch_threads(indexer->embedding_engine, throttle.embed_threads);
+
+        // Copies of a file already in the batch take its embedding afterwards
+        int section_count = 0;
+        for (int i = 0; i < count && can_embed; i++) {
+            PendingFile *file = batch[i];
+            if (file->chunk_count == 0 || find_same_content(batch, i) >= 0) {
+                continue;
+            }
+            file->chunk_embeddings = calloc((size_t)file->chunk_count * EMBEDDING_DIMENSION, sizeof(float));
+            if (file->chunk_embeddings == NULL) {
+                release_content(file);
+                continue;
+            }
+
+            for (int c = 0; c < file->chunk_count; c++) {
+                EmbedSection *section = &scratch.sections[section_count++];
+                section->file = file;
+                section->chunk = c;
+                section->length = file->tokens != NULL
+                    ? file->token_starts[c + 1] - file->token_starts[c] : (int)file->chunks[c].length;
+            }
+        }
+
+        qsort(scratch.sections, (size_t)section_count, sizeof(EmbedSection), compare_sections);
+        for (int start = 0; start < section_count;) {
+            bool tokenized = scratch.sections[start].file->tokens != NULL;
+            int end = start + 1;
+            while (end < section_count && end - start < batch_size &&
+                   (scratch.sections[end].file->tokens != NULL) == tokenized) {
+                end++;
+            }
+            embed_sections(indexer, &scratch.sections[start], end - start, &scratch);
+            start = end;
+        }
+
+        for (int i = 0; i < count; i++) {
+            PendingFile *file = batch[i];
+            content_map_close(&file->map);
+            if (file->chunk_embeddings != NULL) {
+                combine_sections(file, file->chunk_count);
+                continue;
+            }
+
+            int source = file->chunk_count > 0 ? find_same_content(batch, i) : -1;
+            if (source >= 0 && batch[source]->has_embedding) {
+                memcpy(file->embedding, batch[source]->embedding, sizeof(file->embedding));
+                file->has_embedding = true;
+
+                pthread_mutex_lock(&indexer->mutex);
+                indexer->stats.files_deduplicated++;
+                pthread_mutex_unlock(&indexer->mutex);
+            }
+            // Sections are stored only with the copy that was embedded
+            release_content(file);
+        }
+
+        pthread_mutex_lock(&indexer->mutex);
+        indexer->stats.embed.processed += count;
+        pthread_mutex_unlock(&indexer->mutex);
+
+        for (int i = 0; i < count; i++) {
+            if (!stage_queue_push(&indexer->write_queue, batch[i])) {
+                free_pending(batch[i]);
+                finish_files(indexer, 1);
+            }
+        }
+
+        int delay_ms = indexer->config.delay_between_batches_ms;
+        throttle_sleep(indexer, throttle.batch_delay_ms > delay_ms ? throttle.batch_delay_ms : delay_ms);
+    }
+
+    free(files);
+    free(scratch.sections);
+    free(scratch.text_buffers);
+    free(scratch.texts);
+    free(scratch.tokens);
+    free(scratch.counts);
+    free(scratch.targets);
+    return NULL;
+}
+
+// Helper: store the sections of a file long enough to have several
+static int write_sections(Indexer *indexer, const PendingFile *file)
+{
+    TRACE_SCOPE("indexer_write_sections");
+    if (file->chunk_count < 2 || file->chunk_embeddings == NULL) {
+        return 0;
+    }
+
+    VectorDBChunk sections[CONTENT_MAX_CHUNKS];
+    int stored = 0;
+    for (int c = 0; c < file->chunk_count; c++) {
+        const float *embedding = &file->chunk_embeddings[(size_t)c * EMBEDDING_DIMENSION];
+        bool encoded = vector_dot(embedding, embedding, EMBEDDING_DIMENSION) > 0.0f;
+        sections[c].offset = (int64_t)file->chunks[c].offset;
+        sections[c].length = (int64_t)file->chunks[c].length;
+        sections[c].title = file->chunks[c].title;
+        sections[c].embedding = encoded ? embedding : NULL;
+        stored += encoded ? 1 : 0;
+    }
+
+    if (vectordb_set_chunks(indexer->vectordb, file->path, sections, file->chunk_count) != VECTORDB_STATUS_OK) {
+        return 0;
+    }
+    return stored;
+}
+
+// Write stage: the only thread writing embeddings, one transaction per batch
+static void* write_thread_func(void *arg)
+{
+    Indexer *indexer = (Indexer *)arg;
+    trace_set_thread_name("indexer write");
+    int batch_size = indexer->config.batch_size > 0 ? indexer->config.batch_size : 1;
+    PendingFile **files = malloc((size_t)batch_size * sizeof(PendingFile *));
+    PendingFile *single = NULL;
+    PendingFile **batch = files != NULL ? files : &single;
+    if (files == NULL) {
+        batch_size = 1;
+    }
+
+    int qos = -1;
+    follow_throttle(indexer, &qos);
+    int count;
+    while ((count = stage_queue_pop_batch(&indexer->write_queue, batch, batch_size)) > 0) {
+        follow_throttle(indexer, &qos);
+        double start = get_current_time_sec();
+        vectordb_begin_batch(indexer->vectordb);
+        for (int i = 0; i < count; i++) {
+            PendingFile *file = batch[i];
+            VectorDBStatus status = vectordb_index_file_with_hash(
+                indexer->vectordb,
+                file->path,
+                file->name,
+                file->file_type,
+                file->st.st_size,
+                file->st.st_mtime,
+                file->content_hash,
+                file->has_embedding ? file->embedding : NULL
+            );
+
+            int sections = status == VECTORDB_STATUS_OK ? write_sections(indexer, file) : 0;
+            if (status == VECTORDB_STATUS_OK && file->text != NULL) {
+                vectordb_set_text(indexer->vectordb, file->path, file->text);
+            }
+
+            pthread_mutex_lock(&indexer->mutex);
+            if (status == VECTORDB_STATUS_OK) {
+                indexer->stats.files_indexed++;
+                indexer->stats.sections_indexed += sections;
+                indexer->stats.total_bytes += file->st.st_size;
+                rate_record(indexer, file->st.st_size);
+            } else {
+                indexer->stats.files_skipped++;
+                indexer->stats.skipped.failed++;
+            }
+            indexer->stats.write.processed++;
+
+            // Update timing stats
+            double elapsed = seconds_since_start(indexer);
+            indexer->stats.elapsed_time_sec = elapsed;
+            if (indexer->stats.files_indexed > 0) {
+                indexer->stats.avg_time_per_file_ms = (elapsed * 1000.0) / indexer->stats.files_indexed;
+            }
+
+            pthread_mutex_unlock(&indexer->mutex);
+
+            // Update progress
+            update_progress(indexer);
+
+            // Call callback if set
+            if (indexer->callback) {
+                indexer->callback(file->path, indexer->status, indexer->callback_user_data);
+            }
+        }
+        vectordb_commit_batch(indexer->vectordb);
+
+        double elapsed = get_current_time_sec() - start;
+        pthread_mutex_lock(&indexer->mutex);
+        latency_record(&indexer->stats.write_latency, elapsed);
+        pthread_mutex_unlock(&indexer->mutex);
+
+        for (int i = 0; i < count; i++) {
+            free_pending(batch[i]);
+        }
+        finish_files(indexer, count);
+    }
+
+    free(files);
+    return NULL;
+}
+
+// Helper: start the read, inference and write stages
+static bool start_pipeline(Indexer *indexer)
+{
+    int batch_size = indexer->config.batch_size > 0 ? indexer->config.batch_size : 1;
+    if (!stage_queue_init(&indexer->read_queue, 2 * batch_size)) {
+        return false;
+    }
+    if (!stage_queue_init(&indexer->write_queue, 2 * batch_size)) {
+        stage_queue_destroy(&indexer->read_queue);
+        return false;
+    }
+    if (!stage_queue_init(&indexer->ocr_queue, 2 * INDEXER_OCR_BATCH)) {
+        stage_queue_destroy(&indexer->read_queue);
+        stage_queue_destroy(&indexer->write_queue);
+        return false;
+    }
+
+    int readers = indexer->config.reader_threads;
+    readers = readers < 1 ? 1 : (readers > INDEXER_MAX_READER_THREADS ? INDEXER_MAX_READER_THREADS : readers);
+
+    indexer->reader_count = 0;
+    bool ok = pthread_create(&indexer->write_thread, NULL, write_thread_func, indexer) == 0;
+    if (ok && pthread_create(&indexer->embed_thread, NULL, embed_thread_func, indexer) != 0) {
+        stage_queue_close(&indexer->write_queue);
+        pthread_join(indexer->write_thread, NULL);
+        ok = false;
+    }
+    if (ok && pthread_create(&indexer->ocr_thread, NULL, ocr_thread_func, indexer) != 0) {
+        stage_queue_close(&indexer->read_queue);
+        pthread_join(indexer->embed_thread, NULL);
+        stage_queue_close(&indexer->write_queue);
+        pthread_join(indexer->write_thread, NULL);
+        ok = false;
+    }
+    if (!ok) {
+        stage_queue_destroy(&indexer->ocr_queue);
+        stage_queue_destroy(&indexer->read_queue);
+        stage_queue_destroy(&indexer->write_queue);
+        return false;
+    }
+
+    while (indexer->reader_count < readers &&
+           pthread_create(&indexer->reader_threads[indexer->reader_count], NULL, reader_thread_func, indexer) == 0) {
+        indexer->reader_count++;
+    }
+    indexer->pipeline_running = true;
+    return true;
+}
+
+// Helper: stop the stages in order; files already read are still written
+static void stop_pipeline(Indexer *indexer)
+{
+    if (!indexer->pipeline_running) {
+        return;
+    }
+
+    for (int i = 0; i < indexer->reader_count; i++) {
+        pthread_join(indexer->reader_threads[i], NULL);
+    }
+    stage_queue_close(&indexer->ocr_queue);
+    pthread_join(indexer->ocr_thread, NULL);
+    stage_queue_close(&indexer->read_queue);
+    pthread_join(indexer->embed_thread, NULL);
+    stage_queue_close(&indexer->write_queue);
+    pthread_join(indexer->write_thread, NULL);
+
+    stage_queue_destroy(&indexer->ocr_queue);
+    stage_queue_destroy(&indexer->read_queue);
+    stage_queue_destroy(&indexer->write_queue);
+    indexer->reader_count = 0;
+    indexer->pipeline_running = false;
+}
+
+// Helper: scan again for files a full queue turned away (worker thread)
+static void rescan_dropped(Indexer *indexer)
+{
+    char dir[4096];
+
+    pthread_mutex_lock(&indexer->mutex);
+    bool roots = indexer->rescan_roots;
+    indexer->rescan_roots = false;
+    pthread_mutex_unlock(&indexer->mutex);
+
+    if (roots) {
+        // Too many folders to say which: every root, which covers the listed ones too
         pthread_mutex_lock(&indexer->mutex);
-        indexer->stats.files_skipped++;
+        while (index_queue_pop(indexer->rescan_dirs, get_current_time_sec(), dir, sizeof(dir))) {
+        }
         pthread_mutex_unlock(&indexer->mutex);
+
+        for (int i = 0; i < indexer->config.watch_dir_count && indexer->thread_running; i++) {
+            scan_directory(indexer, indexer->config.watch_dirs[i], SCAN_RECURSE | SCAN_WAIT);
+        }
         return;
     }
 
-    // Check if already indexed and up-to-date
-    if (vectordb_is_indexed(indexer->vectordb, path, st.st_mtime)) {
+    while (indexer->thread_running) {
         pthread_mutex_lock(&indexer->mutex);
-        indexer->stats.files_skipped++;
+        bool found = index_queue_pop(indexer->rescan_dirs, get_current_time_sec(), dir, sizeof(dir));
         pthread_mutex_unlock(&indexer->mutex);
-        return;
+        if (!found) {
+            break;
+        }
+        // Subfolders with dropped files are listed themselves
+        scan_directory(indexer, dir, SCAN_WAIT);
     }
+}
 
-    // Get file info
-    const char *basename = strrchr(path, '/');
-    basename = basename ? basename + 1 : path;
+// Helper: queue one file embedded by another model (vectordb_each_stale callback)
+static bool queue_stale_file(const char *path, void *context)
+{
+    Indexer *indexer = (Indexer *)context;
+    snprintf(indexer->migrate_after, sizeof(indexer->migrate_after), "%s", path);
+    enqueue_file(indexer, path, 0, false);
+    return true;
+}
 
-    const char *ext = strrchr(basename, '.');
-    ext = ext ? ext + 1 : "";
+// Helper: queue the next batch of files an earlier model embedded (worker thread);
+// returns how many, 0 once the pass is over. Until a file is embedded again its old
+// row stays, found by name and text
+static int queue_stale(Indexer *indexer)
+{
+    // Without a model to embed with, the pass is over before it starts
+    int64_t stale = 0;
+    int queued = 0;
+    if (indexer->vectordb != NULL && indexer->embedding_engine != NULL &&
+        embedding_engine_is_available(indexer->embedding_engine)) {
+        stale = vectordb_count_stale(indexer->vectordb);
+        if (stale > 0) {
+            queued = vectordb_each_stale(indexer->vectordb, indexer->migrate_after, INDEXER_MIGRATE_BATCH,
+                                         queue_stale_file, indexer);
+        }
+    }
 
-    IndexedFileType file_type = vectordb_file_type_from_extension(ext);
+    pthread_mutex_lock(&indexer->mutex);
+    if (stale > indexer->migrate_total) {
+        indexer->migrate_total = stale;
+    }
+    indexer->stats.files_stale = stale;
+    indexer->stats.files_migrated = indexer->migrate_total - stale;
+    indexer->migrate_done = queued == 0;
+    pthread_mutex_unlock(&indexer->mutex);
+    return queued;
+}
 
-    // Read file content for embedding (text and code files only)
-    float *embedding = NULL;
-    float embedding_data[EMBEDDING_DIMENSION];
+// Paths of indexed files found missing
+typedef struct MissingFiles {
+    char **paths;
+    int count;
+    int capacity;
+} MissingFiles;
 
-    if ((file_type == FILE_TYPE_TEXT || file_type == FILE_TYPE_CODE) &&
-        indexer->embedding_engine != NULL &&
-        embedding_engine_is_loaded(indexer->embedding_engine)) {
+// Helper: note an indexed file that no longer exists (vectordb_each_file callback)
+static bool note_missing_file(const IndexedFile *file, const char *content_hash, void *context)
+{
+    (void)content_hash;
+    MissingFiles *missing = (MissingFiles *)context;
+    struct stat st;
+    if (stat(file->path, &st) == 0 || errno != ENOENT) {
+        return true;
+    }
 
-        char *content = read_file_content(path, EMBEDDING_MAX_TEXT_LEN);
-        if (content != NULL) {
-            EmbeddingResult result = embedding_generate(indexer->embedding_engine, content);
-            if (result.status == EMBEDDING_STATUS_OK) {
-                memcpy(embedding_data, result.embedding, sizeof(embedding_data));
-                embedding = embedding_data;
-            }
-            free(content);
+    if (missing->count == missing->capacity) {
+        int capacity = missing->capacity > 0 ? missing->capacity * 2 : 64;
+        char **paths = realloc(missing->paths, (size_t)capacity * sizeof(char *));
+        if (paths == NULL) {
+            return false;
         }
+        missing->paths = paths;
+        missing->capacity = capacity;
     }
+    missing->paths[missing->count] = strdup(file->path);
+    if (missing->paths[missing->count] != NULL) {
+        missing->count++;
+    }
+    return true;
+}
 
-    // Index the file
-    VectorDBStatus status = vectordb_index_file(
-        indexer->vectordb,
-        path,
-        basename,
-        file_type,
-        st.st_size,
-        st.st_mtime,
-        embedding
-    );
-
-    pthread_mutex_lock(&indexer->mutex);
-    if (status == VECTORDB_STATUS_OK) {
-        indexer->stats.files_indexed++;
-        indexer->stats.total_bytes += st.st_size;
-    } else {
-        indexer->stats.files_skipped++;
+// Helper: remove the entries of files under the watch roots that no longer exist, such
+// as ones deleted while nothing was watching (worker thread). A root that is gone
+// itself, like an unmounted volume, is left alone. Returns how many were removed
+static int purge_missing(Indexer *indexer)
+{
+    MissingFiles missing = {0};
+    for (int i = 0; i < indexer->config.watch_dir_count && indexer->thread_running; i++) {
+        struct stat st;
+        if (stat(indexer->config.watch_dirs[i], &st) == 0) {
+            vectordb_each_file(indexer->vectordb, indexer->config.watch_dirs[i], note_missing_file, &missing);
+        }
     }
 
-    // Update timing stats
-    double elapsed = get_current_time_sec() - (indexer->start_time.tv_sec + indexer->start_time.tv_nsec / 1e9);
-    indexer->stats.elapsed_time_sec = elapsed;
-    if (indexer->stats.files_indexed > 0) {
-        indexer->stats.avg_time_per_file_ms = (elapsed * 1000.0) / indexer->stats.files_indexed;
+    int purged = 0;
+    for (int i = 0; i < missing.count; i++) {
+        if (vectordb_delete_file(indexer->vectordb, missing.paths[i]) == VECTORDB_STATUS_OK) {
+            purged++;
+        }
+        free(missing.paths[i]);
     }
+    free(missing.paths);
+    return purged;
+}
 
-    pthread_mutex_unlock(&indexer->mutex);
+// Helper: upkeep of the vector database (worker thread, idle): drop entries of files
+// that are gone, compact the resident index and refresh statistics, then give unused
+// pages back a step at a time for as long as nothing else is queued
+static void maintain_database(Indexer *indexer)
+{
+    TRACE_SCOPE("indexer_maintain_database");
+    int purged = purge_missing(indexer);
+    vectordb_optimize(indexer->vectordb);
+
+    int64_t reclaimed = 0;
+    int64_t freed;
+    bool idle = true;
+    while (idle && indexer->thread_running &&
+           (freed = vectordb_vacuum(indexer->vectordb, INDEXER_VACUUM_PAGES)) > 0) {
+        reclaimed += freed;
+        pthread_mutex_lock(&indexer->mutex);
+        idle = index_queue_count(indexer->queue) == 0 && indexer->in_pipeline == 0;
+        pthread_mutex_unlock(&indexer->mutex);
+    }
 
-    // Update progress
-    update_progress(indexer);
+    int64_t db_bytes = 0;
+    vectordb_file_usage(indexer->vectordb, &db_bytes, NULL);
 
-    // Call callback if set
-    if (indexer->callback) {
-        indexer->callback(path, indexer->status, indexer->callback_user_data);
-    }
+    pthread_mutex_lock(&indexer->mutex);
+    indexer->stats.files_purged += purged;
+    indexer->stats.bytes_reclaimed += reclaimed;
+    indexer->stats.db_bytes = db_bytes;
+    pthread_mutex_unlock(&indexer->mutex);
 }
 
-// Worker thread function
+// Worker thread function: scans, then spends idle time on the ANN graph, on files
+// embedded by an earlier model and on upkeep of the database
 static void* worker_thread_func(void *arg)
 {
     Indexer *indexer = (Indexer *)arg;
+    int qos = -1;
+    follow_throttle(indexer, &qos);
 
-    // Initial scan of all watch directories
-    for (int i = 0; i < indexer->config.watch_dir_count; i++) {
+    // Subscribe before scanning so no change made during the scan is missed
+    pthread_mutex_lock(&indexer->mutex);
+    bool watching = indexer->config.enable_fsevents && subscribe_watch_dirs(indexer);
+    pthread_mutex_unlock(&indexer->mutex);
+
+    // Roots with a checkpoint catch up from the journal; the rest get the full scan, unless
+    // the index is kept current elsewhere and only changes from now on are followed
+    bool follow_only = indexer->config.follow_only;
+    uint64_t scan_id = fsevents_current_event_id();
+    bool replay[INDEXER_MAX_WATCH_DIRS] = {false};
+    bool replaying = !follow_only && watching && start_replay(indexer, scan_id, replay);
+
+    // Initial scan of the other watch directories (the pipeline indexes files as they are found)
+    if (!replaying && !follow_only) {
+        path_index_begin_scan(indexer->path_index);
+    }
+    for (int i = 0; i < indexer->config.watch_dir_count && !follow_only; i++) {
         if (indexer->status == INDEXER_STATUS_STOPPED) {
             break;
         }
-        scan_directory(indexer, indexer->config.watch_dirs[i]);
+        if (!replay[i]) {
+            scan_directory(indexer, indexer->config.watch_dirs[i], SCAN_RECURSE | SCAN_WAIT);
+        }
     }
+    bool scanned = !follow_only && indexer->status != INDEXER_STATUS_STOPPED;
 
-    // Record total files for progress tracking
-    pthread_mutex_lock(&indexer->mutex);
-    indexer->total_files_to_index = indexer->queue_size;
-    pthread_mutex_unlock(&indexer->mutex);
+    // Drop paths that disappeared since the index was saved (only after a full pass)
+    if (indexer->path_index != NULL && !replaying && scanned) {
+        path_index_end_scan(indexer->path_index);
+        path_index_save(indexer->path_index);
+    }
+    uint64_t saved_id = 0;
 
-    // Process files from queue
-    char path[4096];
+    // Record total files for progress tracking (those already read included)
+    pthread_mutex_lock(&indexer->mutex);
+    indexer->total_files_to_index = index_queue_count(indexer->queue) + indexer->in_pipeline +
+                                    indexer->stats.files_indexed + indexer->stats.files_skipped;
     while (indexer->thread_running) {
-        if (!dequeue_file(indexer, path, sizeof(path))) {
-            // Queue is empty - initial scan complete
+        take_inbox(indexer);
+        if (index_queue_count(indexer->queue) > 0 || indexer->in_pipeline > 0) {
+            // Pipeline busy: wake up when it drains
+            pthread_cond_wait(&indexer->cond, &indexer->mutex);
+            continue;
+        }
+        if (indexer->rescan_roots || index_queue_count(indexer->rescan_dirs) > 0) {
+            // Files were turned away by a full queue: find them again now there is room
+            pthread_mutex_unlock(&indexer->mutex);
+            follow_throttle(indexer, &qos);
+            rescan_dropped(indexer);
             pthread_mutex_lock(&indexer->mutex);
-            if (!indexer->initial_scan_complete) {
-                indexer->initial_scan_complete = true;
+            continue;
+        }
+        // Until a replay catches up, only the events it delivered so far are applied
+        uint64_t checkpoint_id = indexer->event_id_seen;
+        if (!indexer->replay_pending && scan_id > checkpoint_id) {
+            checkpoint_id = scan_id;
+        }
+        pthread_mutex_unlock(&indexer->mutex);
+        follow_throttle(indexer, &qos);
 
-                // Start FSEvents watcher if enabled
-                if (indexer->config.enable_fsevents && indexer->watcher != NULL) {
-                    indexer->status = INDEXER_STATUS_WATCHING;
-                    fsevents_start(indexer->watcher);
-                }
+        // Everything up to checkpoint_id is written: a restart can replay from there
+        if (indexer->vectordb != NULL && scanned && checkpoint_id > saved_id) {
+            save_checkpoints(indexer, checkpoint_id);
+            saved_id = checkpoint_id;
+        }
+
+        // Everything is written: spend the idle time linking new embeddings into the ANN graph
+        if (indexer->vectordb != NULL) {
+            bool idle = true;
+            while (idle && indexer->thread_running &&
+                   vectordb_build_index(indexer->vectordb, INDEXER_GRAPH_BUILD_BUDGET) > 0) {
+                pthread_mutex_lock(&indexer->mutex);
+                idle = index_queue_count(indexer->queue) == 0 && indexer->in_pipeline == 0;
+                pthread_mutex_unlock(&indexer->mutex);
             }
-            pthread_mutex_unlock(&indexer->mutex);
 
-            // Wait for more files (from FSEvents or reindex requests)
-            pthread_mutex_lock(&indexer->mutex);
-            while (indexer->queue_head == NULL && indexer->thread_running) {
-                struct timespec timeout;
-                clock_gettime(CLOCK_REALTIME, &timeout);
-                timeout.tv_sec += 1;  // Check every second
-                pthread_cond_timedwait(&indexer->cond, &indexer->mutex, &timeout);
+            // Persist once the initial pass is in; vectordb_close saves later changes
+            if (!indexer->initial_scan_complete) {
+                vectordb_save_index(indexer->vectordb);
             }
-            pthread_mutex_unlock(&indexer->mutex);
-            continue;
         }
 
-        // Handle pause
+        // Queue is empty - initial scan complete
         pthread_mutex_lock(&indexer->mutex);
-        while (indexer->status == INDEXER_STATUS_PAUSED && indexer->thread_running) {
-            pthread_cond_wait(&indexer->cond, &indexer->mutex);
+        if (!indexer->initial_scan_complete && !indexer->replay_pending) {
+            indexer->initial_scan_complete = true;
+
+            // Start watching for changes if enabled
+            if (indexer->config.enable_fsevents && subscribe_watch_dirs(indexer)) {
+                indexer->status = INDEXER_STATUS_WATCHING;
+            }
         }
-        pthread_mutex_unlock(&indexer->mutex);
 
-        if (!indexer->thread_running) {
-            break;
+        // Nothing else to do: re-embed a batch of files an earlier model embedded, and
+        // come back for the next once it is written
+        if (indexer->initial_scan_complete && !indexer->migrate_done) {
+            pthread_mutex_unlock(&indexer->mutex);
+            int queued = queue_stale(indexer);
+            pthread_mutex_lock(&indexer->mutex);
+            if (queued > 0) {
+                continue;
+            }
         }
 
-        process_file(indexer, path);
+        // Then upkeep of the database, on the first idle stretch and at most every
+        // INDEXER_MAINTENANCE_INTERVAL_SEC after. Back to the top afterwards: a compacted
+        // resident index needs its graph linked again
+        double now = get_current_time_sec();
+        if (indexer->initial_scan_complete && indexer->migrate_done && indexer->vectordb != NULL &&
+            (!indexer->maintained || now - indexer->maintained_at >= INDEXER_MAINTENANCE_INTERVAL_SEC)) {
+            indexer->maintained = true;
+            indexer->maintained_at = now;
+            pthread_mutex_unlock(&indexer->mutex);
+            maintain_database(indexer);
+            pthread_mutex_lock(&indexer->mutex);
+            continue;
+        }
 
-        // Delay between batches if configured
-        if (indexer->config.delay_between_batches_ms > 0) {
-            usleep((useconds_t)indexer->config.delay_between_batches_ms * 1000);
+        // Wait for more files (from the watch bus or reindex requests), or for a replay to
+        // finish. No timeout: an idle indexer does not wake until there is something to do
+        atomic_fetch_add(&indexer->sleepers, 1);
+        take_inbox(indexer);
+        while (index_queue_count(indexer->queue) == 0 && indexer->thread_running &&
+               (indexer->initial_scan_complete || indexer->replay_pending)) {
+            pthread_cond_wait(&indexer->cond, &indexer->mutex);
         }
+        atomic_fetch_sub(&indexer->sleepers, 1);
     }
+    pthread_mutex_unlock(&indexer->mutex);
 
     return NULL;
 }
@@ -514,6 +2069,8 @@ IndexerConfig indexer_get_default_config(void)
     config.max_file_size_mb = 10;  // Skip files > 10MB
     config.batch_size = 32;
     config.delay_between_batches_ms = 10;
+    config.reader_threads = 4;
+    config.ocr = true;
 
     // Add default exclude patterns
     for (int i = 0; DEFAULT_EXCLUDE_PATTERNS[i] != NULL; i++) {
@@ -547,27 +2104,31 @@ Indexer* indexer_create_with_config(const IndexerConfig *config)
 
     memcpy(&indexer->config, config, sizeof(IndexerConfig));
 
+    indexer->queue = index_queue_create(INDEXER_QUEUE_CAPACITY);
+    indexer->rescan_dirs = index_queue_create(INDEXER_MAX_RESCAN_DIRS);
+    ExcludeSet *excludes = compile_excludes(&indexer->config);
+    if (indexer->queue == NULL || indexer->rescan_dirs == NULL || excludes == NULL) {
+        index_queue_destroy(indexer->queue);
+        index_queue_destroy(indexer->rescan_dirs);
+        exclude_set_destroy(excludes);
+        free(indexer);
+        return NULL;
+    }
+
     pthread_mutex_init(&indexer->mutex, NULL);
     pthread_cond_init(&indexer->cond, NULL);
+    pthread_cond_init(&indexer->work_cond, NULL);
+    pthread_cond_init(&indexer->room_cond, NULL);
+    index_inbox_init(&indexer->inbox);
+    atomic_init(&indexer->sleepers, 0);
+    atomic_init(&indexer->excludes, (uintptr_t)excludes);
+    indexer->event_ignore = ignore_stack_create();
+    pthread_mutex_init(&indexer->ignore_mutex, NULL);
 
     indexer->status = INDEXER_STATUS_STOPPED;
     indexer->thread_running = false;
     indexer->initial_scan_complete = false;
 
-    // Create FSEvents watcher if enabled
-    if (config->enable_fsevents) {
-        indexer->watcher = fsevents_create();
-        if (indexer->watcher != NULL) {
-            fsevents_set_callback(indexer->watcher, fsevents_handler, indexer);
-            fsevents_set_latency(indexer->watcher, 0.5);
-
-            // Add watch directories
-            for (int i = 0; i < config->watch_dir_count; i++) {
-                fsevents_add_path(indexer->watcher, config->watch_dirs[i]);
-            }
-        }
-    }
-
     return indexer;
 }
 
@@ -579,22 +2140,20 @@ void indexer_destroy(Indexer *indexer)
 
     indexer_stop(indexer);
 
-    // Stop and destroy FSEvents watcher
-    if (indexer->watcher != NULL) {
-        fsevents_destroy(indexer->watcher);
-        indexer->watcher = NULL;
-    }
-
-    // Free remaining queue entries
-    FileQueueEntry *entry = indexer->queue_head;
-    while (entry) {
-        FileQueueEntry *next = entry->next;
-        free(entry);
-        entry = next;
+    index_queue_destroy(indexer->queue);
+    index_queue_destroy(indexer->rescan_dirs);
+    index_inbox_clear(&indexer->inbox);
+    exclude_set_destroy((ExcludeSet *)atomic_load(&indexer->excludes));
+    for (int i = 0; i < indexer->retired_exclude_count; i++) {
+        exclude_set_destroy(indexer->retired_excludes[i]);
     }
+    ignore_stack_destroy(indexer->event_ignore);
+    pthread_mutex_destroy(&indexer->ignore_mutex);
 
     pthread_mutex_destroy(&indexer->mutex);
     pthread_cond_destroy(&indexer->cond);
+    pthread_cond_destroy(&indexer->work_cond);
+    pthread_cond_destroy(&indexer->room_cond);
 
     free(indexer);
 }
@@ -615,6 +2174,33 @@ void indexer_set_vectordb(Indexer *indexer, VectorDB *db)
     indexer->vectordb = db;
 }
 
+void indexer_set_fs_watch(Indexer *indexer, struct FsWatch *watch)
+{
+    if (indexer == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&indexer->mutex);
+    indexer->fs_watch = watch;
+    pthread_mutex_unlock(&indexer->mutex);
+}
+
+void indexer_set_path_index(Indexer *indexer, PathIndex *index)
+{
+    if (indexer == NULL) {
+        return;
+    }
+    indexer->path_index = index;
+}
+
+void indexer_set_hash_cache(Indexer *indexer, HashCache *cache)
+{
+    if (indexer == NULL) {
+        return;
+    }
+    indexer->hash_cache = cache;
+}
+
 bool indexer_add_watch_dir(Indexer *indexer, const char *path)
 {
     if (indexer == NULL || path == NULL) {
@@ -679,10 +2265,30 @@ bool indexer_add_exclude_pattern(Indexer *indexer, const char *pattern)
             pattern, sizeof(indexer->config.exclude_patterns[0]) - 1);
     indexer->config.exclude_pattern_count++;
 
+    ExcludeSet *excludes = compile_excludes(&indexer->config);
+    if (excludes == NULL) {
+        indexer->config.exclude_pattern_count--;
+        pthread_mutex_unlock(&indexer->mutex);
+        return false;
+    }
+    indexer->retired_excludes[indexer->retired_exclude_count++] =
+        (ExcludeSet *)atomic_exchange(&indexer->excludes, (uintptr_t)excludes);
+
     pthread_mutex_unlock(&indexer->mutex);
     return true;
 }
 
+void indexer_set_respect_ignore_files(Indexer *indexer, bool respect)
+{
+    if (indexer == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&indexer->mutex);
+    indexer->config.respect_ignore_files = respect;
+    pthread_mutex_unlock(&indexer->mutex);
+}
+
 void indexer_set_callback(Indexer *indexer, IndexerCallback callback, void *user_data)
 {
     if (indexer == NULL) {
@@ -707,6 +2313,17 @@ void indexer_set_progress_callback(Indexer *indexer, IndexerProgressCallback cal
     pthread_mutex_unlock(&indexer->mutex);
 }
 
+void indexer_set_visible_dirs(Indexer *indexer, const char *const *dirs, int count)
+{
+    if (indexer == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&indexer->mutex);
+    index_queue_set_visible(indexer->queue, dirs, count);
+    pthread_mutex_unlock(&indexer->mutex);
+}
+
 bool indexer_enable_watching(Indexer *indexer, bool enable)
 {
     if (indexer == NULL) {
@@ -722,25 +2339,15 @@ bool indexer_enable_watching(Indexer *indexer, bool enable)
     }
 
     if (enable) {
-        // Create watcher if it doesn't exist
-        if (indexer->watcher == NULL) {
-            indexer->watcher = fsevents_create();
-            if (indexer->watcher == NULL) {
-                pthread_mutex_unlock(&indexer->mutex);
-                return false;
-            }
-            fsevents_set_callback(indexer->watcher, fsevents_handler, indexer);
-            fsevents_set_latency(indexer->watcher, 0.5);
-
-            // Add watch directories
-            for (int i = 0; i < indexer->config.watch_dir_count; i++) {
-                fsevents_add_path(indexer->watcher, indexer->config.watch_dirs[i]);
-            }
+        // Changes come from the app's watch bus
+        if (indexer->fs_watch == NULL) {
+            pthread_mutex_unlock(&indexer->mutex);
+            return false;
         }
 
         // Start watching if initial scan is complete
         if (indexer->initial_scan_complete) {
-            if (!fsevents_start(indexer->watcher)) {
+            if (!subscribe_watch_dirs(indexer)) {
                 pthread_mutex_unlock(&indexer->mutex);
                 return false;
             }
@@ -749,21 +2356,21 @@ bool indexer_enable_watching(Indexer *indexer, bool enable)
 
         indexer->watching_enabled = true;
         indexer->config.enable_fsevents = true;
-    } else {
-        // Stop watching
-        if (indexer->watcher != NULL && fsevents_is_running(indexer->watcher)) {
-            fsevents_stop(indexer->watcher);
-        }
-
-        if (indexer->status == INDEXER_STATUS_WATCHING) {
-            indexer->status = INDEXER_STATUS_RUNNING;
-        }
-
-        indexer->watching_enabled = false;
-        indexer->config.enable_fsevents = false;
+        pthread_mutex_unlock(&indexer->mutex);
+        return true;
     }
 
+    if (indexer->status == INDEXER_STATUS_WATCHING) {
+        indexer->status = INDEXER_STATUS_RUNNING;
+    }
+    indexer->replay_pending = false;  // Its end would never be delivered
+    pthread_cond_broadcast(&indexer->cond);
+    indexer->watching_enabled = false;
+    indexer->config.enable_fsevents = false;
     pthread_mutex_unlock(&indexer->mutex);
+
+    // Stop watching
+    unsubscribe_watch_dirs(indexer);
     return true;
 }
 
@@ -773,7 +2380,7 @@ bool indexer_start(Indexer *indexer)
         return false;
     }
 
-    if (indexer->vectordb == NULL) {
+    if (indexer->vectordb == NULL && indexer->path_index == NULL) {
         return false;
     }
 
@@ -786,24 +2393,47 @@ bool indexer_start(Indexer *indexer)
 
     // Reset stats
     memset(&indexer->stats, 0, sizeof(IndexerStats));
+    memset(indexer->rate_files, 0, sizeof(indexer->rate_files));
+    memset(indexer->rate_bytes, 0, sizeof(indexer->rate_bytes));
     clock_gettime(CLOCK_MONOTONIC, &indexer->start_time);
+    indexer->migrate_after[0] = '\0';
+    indexer->migrate_total = 0;
+    indexer->migrate_done = false;
+    indexer->maintained = false;
 
     indexer->status = INDEXER_STATUS_RUNNING;
     indexer->thread_running = true;
 
     pthread_mutex_unlock(&indexer->mutex);
 
-    if (pthread_create(&indexer->worker_thread, NULL, worker_thread_func, indexer) != 0) {
+    // Only the vectordb needs the read/inference/write stages
+    bool started = indexer->vectordb == NULL || start_pipeline(indexer);
+    if (!started || pthread_create(&indexer->worker_thread, NULL, worker_thread_func, indexer) != 0) {
         pthread_mutex_lock(&indexer->mutex);
         indexer->status = INDEXER_STATUS_ERROR;
         indexer->thread_running = false;
+        pthread_cond_broadcast(&indexer->cond);
+        pthread_cond_broadcast(&indexer->work_cond);
+        pthread_cond_broadcast(&indexer->room_cond);
         pthread_mutex_unlock(&indexer->mutex);
+        stop_pipeline(indexer);
         return false;
     }
 
     return true;
 }
 
+void indexer_set_throttle(Indexer *indexer, const IndexerThrottle *throttle)
+{
+    if (indexer == NULL || throttle == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&indexer->mutex);
+    indexer->throttle = *throttle;
+    pthread_mutex_unlock(&indexer->mutex);
+}
+
 void indexer_stop(Indexer *indexer)
 {
     if (indexer == NULL) {
@@ -814,17 +2444,20 @@ void indexer_stop(Indexer *indexer)
     indexer->status = INDEXER_STATUS_STOPPED;
     indexer->thread_running = false;
     pthread_cond_broadcast(&indexer->cond);
+    pthread_cond_broadcast(&indexer->work_cond);
+    pthread_cond_broadcast(&indexer->room_cond);
     pthread_mutex_unlock(&indexer->mutex);
 
-    // Stop FSEvents watcher
-    if (indexer->watcher != NULL && fsevents_is_running(indexer->watcher)) {
-        fsevents_stop(indexer->watcher);
-    }
+    // Stop watching
+    unsubscribe_watch_dirs(indexer);
 
     if (indexer->worker_thread) {
         pthread_join(indexer->worker_thread, NULL);
         indexer->worker_thread = 0;
     }
+
+    // Readers stop at the queue; files they already read are still written
+    stop_pipeline(indexer);
 }
 
 void indexer_pause(Indexer *indexer)
@@ -849,7 +2482,7 @@ void indexer_resume(Indexer *indexer)
     pthread_mutex_lock(&indexer->mutex);
     if (indexer->status == INDEXER_STATUS_PAUSED) {
         indexer->status = INDEXER_STATUS_RUNNING;
-        pthread_cond_broadcast(&indexer->cond);
+        pthread_cond_broadcast(&indexer->work_cond);
     }
     pthread_mutex_unlock(&indexer->mutex);
 }
@@ -870,13 +2503,177 @@ IndexerStats indexer_get_stats(Indexer *indexer)
         return stats;
     }
 
+    // Writes in the seconds of the window, the current one included
+    int64_t second = (int64_t)get_current_time_sec();
+    int64_t recent_files = 0;
+    int64_t recent_bytes = 0;
+
     pthread_mutex_lock(&indexer->mutex);
     memcpy(&stats, &indexer->stats, sizeof(IndexerStats));
+    for (int i = 0; i < INDEXER_RATE_WINDOW_SEC; i++) {
+        if (second - indexer->rate_second[i] < INDEXER_RATE_WINDOW_SEC) {
+            recent_files += indexer->rate_files[i];
+            recent_bytes += indexer->rate_bytes[i];
+        }
+    }
     pthread_mutex_unlock(&indexer->mutex);
+    stats.files_pending += index_inbox_count(&indexer->inbox);
+
+    // Depth of the queue in front of each stage
+    stats.scan.queued = 0;
+    stats.read.queued = stats.files_pending;
+    stats.ocr.queued = indexer->pipeline_running ? stage_queue_depth(&indexer->ocr_queue) : 0;
+    stats.embed.queued = indexer->pipeline_running ? stage_queue_depth(&indexer->read_queue) : 0;
+    stats.write.queued = indexer->pipeline_running ? stage_queue_depth(&indexer->write_queue) : 0;
+
+    double elapsed = seconds_since_start(indexer);
+    if (indexer->thread_running && elapsed > 0.0) {
+        stats.scan.files_per_sec = stats.scan.processed / elapsed;
+        stats.read.files_per_sec = stats.read.processed / elapsed;
+        stats.ocr.files_per_sec = stats.ocr.processed / elapsed;
+        stats.embed.files_per_sec = stats.embed.processed / elapsed;
+        stats.write.files_per_sec = stats.write.processed / elapsed;
+
+        // A window longer than the run so far would understate the rate
+        double window = elapsed < INDEXER_RATE_WINDOW_SEC ? elapsed : INDEXER_RATE_WINDOW_SEC;
+        stats.recent_files_per_sec = recent_files / window;
+        stats.recent_bytes_per_sec = recent_bytes / window;
+    }
+
+    int batch_size = indexer->config.batch_size > 0 ? indexer->config.batch_size : 1;
+    if (stats.infer_batches > 0) {
+        stats.batch_utilization = (float)((double)stats.infer_texts / ((double)stats.infer_batches * batch_size));
+    }
 
     return stats;
 }
 
+double indexer_latency_percentile(const IndexerLatency *latency, float percentile)
+{
+    if (latency == NULL || latency->count == 0) {
+        return 0.0;
+    }
+
+    int64_t target = (int64_t)(percentile * (float)latency->count);
+    if (target >= latency->count) {
+        target = latency->count - 1;
+    }
+    int64_t seen = 0;
+    for (int i = 0; i < INDEXER_LATENCY_BUCKETS; i++) {
+        seen += latency->buckets[i];
+        if (seen > target) {
+            // Upper edge of the bucket
+            return (double)(1u << i) / 1000.0;
+        }
+    }
+    return (double)(1u << (INDEXER_LATENCY_BUCKETS - 1)) / 1000.0;
+}
+
+void indexer_stats_string(const IndexerStats *stats, char *buffer, size_t size)
+{
+    if (stats == NULL || buffer == NULL || size == 0) {
+        return;
+    }
+
+    snprintf(buffer, size,
+             "Index: %.1f files/s %.2f MB/s | p95 read %.2f extract %.2f infer %.1f write %.1f ms | "
+             "queue %lld/%lld/%lld | batch %.0f%% | skip %lld unchanged %lld excluded %lld large %lld binary",
+             stats->recent_files_per_sec, stats->recent_bytes_per_sec / (1024.0 * 1024.0),
+             indexer_latency_percentile(&stats->read_latency, 0.95f),
+             indexer_latency_percentile(&stats->extract_latency, 0.95f),
+             indexer_latency_percentile(&stats->infer_latency, 0.95f),
+             indexer_latency_percentile(&stats->write_latency, 0.95f),
+             (long long)stats->read.queued, (long long)stats->embed.queued, (long long)stats->write.queued,
+             stats->batch_utilization * 100.0f,
+             (long long)stats->skipped.unchanged, (long long)stats->skipped.excluded,
+             (long long)stats->skipped.too_large, (long long)stats->skipped.binary);
+
+    // Only while files of an earlier model are left
+    size_t used = strlen(buffer);
+    if (stats->files_stale > 0 && used < size) {
+        snprintf(buffer + used, size - used, " | re-embed %lld/%lld",
+                 (long long)stats->files_migrated, (long long)(stats->files_migrated + stats->files_stale));
+    }
+}
+
+// Helper: one stage histogram as a JSON object
+static void write_latency_json(FILE *file, const char *name, const IndexerLatency *latency)
+{
+    fprintf(file, "\"%s\":{\"count\":%lld,\"mean_ms\":%.3f,\"p50_ms\":%.3f,\"p95_ms\":%.3f,\"p99_ms\":%.3f,\"buckets\":[",
+            name, (long long)latency->count,
+            latency->count > 0 ? latency->total_ms / (double)latency->count : 0.0,
+            indexer_latency_percentile(latency, 0.50f),
+            indexer_latency_percentile(latency, 0.95f),
+            indexer_latency_percentile(latency, 0.99f));
+    for (int i = 0; i < INDEXER_LATENCY_BUCKETS; i++) {
+        fprintf(file, "%s%u", i > 0 ? "," : "", latency->buckets[i]);
+    }
+    fprintf(file, "]}");
+}
+
+bool indexer_write_metrics(const IndexerStats *stats, const char *path)
+{
+    if (stats == NULL || path == NULL) {
+        return false;
+    }
+
+    // Keep one previous file rather than growing without bound
+    struct stat st;
+    if (stat_cache_stat(path, &st) && st.st_size > INDEXER_METRICS_MAX_BYTES) {
+        char previous[4096];
+        snprintf(previous, sizeof(previous), "%s.1", path);
+        rename(path, previous);
+    }
+
+    FILE *file = fopen(path, "a");
+    if (file == NULL) {
+        return false;
+    }
+
+    // Host names need no escaping beyond dropping quotes and backslashes
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+    for (char *c = host; *c; c++) {
+        if (*c == '"' || *c == '\\' || (unsigned char)*c < 0x20) {
+            *c = '_';
+        }
+    }
+
+    fprintf(file, "{\"time\":%lld,\"host\":\"%s\",\"elapsed_sec\":%.1f,", (long long)time(NULL), host,
+            stats->elapsed_time_sec);
+    fprintf(file, "\"files_indexed\":%lld,\"files_pending\":%lld,\"files_skipped\":%lld,\"total_bytes\":%lld,",
+            (long long)stats->files_indexed, (long long)stats->files_pending,
+            (long long)stats->files_skipped, (long long)stats->total_bytes);
+    fprintf(file, "\"files_stale\":%lld,\"files_migrated\":%lld,",
+            (long long)stats->files_stale, (long long)stats->files_migrated);
+    fprintf(file, "\"files_purged\":%lld,\"bytes_reclaimed\":%lld,\"db_bytes\":%lld,",
+            (long long)stats->files_purged, (long long)stats->bytes_reclaimed, (long long)stats->db_bytes);
+    fprintf(file, "\"files_per_sec\":%.2f,\"bytes_per_sec\":%.0f,",
+            stats->recent_files_per_sec, stats->recent_bytes_per_sec);
+    fprintf(file, "\"queued\":{\"read\":%lld,\"ocr\":%lld,\"embed\":%lld,\"write\":%lld},",
+            (long long)stats->read.queued, (long long)stats->ocr.queued, (long long)stats->embed.queued,
+            (long long)stats->write.queued);
+    fprintf(file, "\"skipped\":{\"excluded\":%lld,\"too_large\":%lld,\"unchanged\":%lld,\"binary\":%lld,\"failed\":%lld},",
+            (long long)stats->skipped.excluded, (long long)stats->skipped.too_large,
+            (long long)stats->skipped.unchanged, (long long)stats->skipped.binary, (long long)stats->skipped.failed);
+    fprintf(file, "\"infer_batches\":%lld,\"infer_texts\":%lld,\"batch_utilization\":%.3f,",
+            (long long)stats->infer_batches, (long long)stats->infer_texts, stats->batch_utilization);
+    fprintf(file, "\"latency\":{");
+    write_latency_json(file, "read", &stats->read_latency);
+    fputc(',', file);
+    write_latency_json(file, "extract", &stats->extract_latency);
+    fputc(',', file);
+    write_latency_json(file, "ocr", &stats->ocr_latency);
+    fputc(',', file);
+    write_latency_json(file, "infer", &stats->infer_latency);
+    fputc(',', file);
+    write_latency_json(file, "write", &stats->write_latency);
+    fprintf(file, "}}\n");
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
 bool indexer_reindex_file(Indexer *indexer, const char *path)
 {
     if (indexer == NULL || path == NULL) {
@@ -885,7 +2682,7 @@ bool indexer_reindex_file(Indexer *indexer, const char *path)
 
     // Delete existing entry and re-queue
     vectordb_delete_file(indexer->vectordb, path);
-    enqueue_file(indexer, path);
+    enqueue_file(indexer, path, 0, false);
 
     return true;
 }
@@ -900,7 +2697,7 @@ bool indexer_reindex_directory(Indexer *indexer, const char *path)
     vectordb_delete_directory(indexer->vectordb, path);
 
     // Re-scan directory
-    scan_directory(indexer, path);
+    scan_directory(indexer, path, SCAN_RECURSE);
 
     return true;
 }
@@ -912,27 +2709,103 @@ bool indexer_should_index_file(const Indexer *indexer, const char *path)
     }
 
     struct stat st;
-    if (stat(path, &st) != 0) {
+    if (!stat_cache_stat(path, &st)) {
         return false;
     }
 
     return should_index_file(indexer, path, &st);
 }
 
+bool indexer_path_index_covers(Indexer *indexer, const char *dir, const char *name_pattern)
+{
+    if (indexer == NULL || dir == NULL || indexer->path_index == NULL ||
+        indexer->status != INDEXER_STATUS_WATCHING) {
+        return false;
+    }
+
+    // Hidden or excluded names are never added, so a pattern that could name one is
+    // not answered by the index
+    if (name_pattern != NULL) {
+        if (!indexer->config.index_hidden_files && name_pattern[0] == '.') {
+            return false;
+        }
+        for (int i = 0; i < indexer->config.exclude_pattern_count; i++) {
+            if (fnmatch(indexer->config.exclude_patterns[i], name_pattern, 0) == 0) {
+                return false;
+            }
+        }
+    }
+
+    pthread_mutex_lock(&indexer->mutex);
+    const char *below = NULL;
+    for (int i = 0; i < indexer->config.watch_dir_count && below == NULL; i++) {
+        const char *root = indexer->config.watch_dirs[i];
+        size_t len = strlen(root);
+        while (len > 1 && root[len - 1] == '/') {
+            len--;
+        }
+        if (strncmp(dir, root, len) == 0 && (dir[len] == '\0' || dir[len] == '/')) {
+            below = dir + len;
+        }
+    }
+    pthread_mutex_unlock(&indexer->mutex);
+    if (below == NULL || !indexer->config.recursive) {
+        return false;
+    }
+
+    // Every folder from the watch root down to dir must have been scanned
+    char path[4096];
+    size_t dir_len = strlen(dir);
+    if (dir_len >= sizeof(path)) {
+        return false;
+    }
+    memcpy(path, dir, dir_len + 1);
+    for (char *p = path + (below - dir); *p == '/'; ) {
+        char *next = strchr(p + 1, '/');
+        if (next) {
+            *next = '\0';
+        }
+        bool wanted = p[1] == '\0' || path_index_wants(indexer, path);
+        if (next) {
+            *next = '/';
+        }
+        if (!wanted) {
+            return false;
+        }
+        if (!next) {
+            break;
+        }
+        p = next;
+    }
+    return true;
+}
+
 bool indexer_is_busy(const Indexer *indexer)
 {
     if (indexer == NULL) {
         return false;
     }
 
-    return indexer->status == INDEXER_STATUS_RUNNING && indexer->queue_size > 0;
+    return indexer->status == INDEXER_STATUS_RUNNING &&
+           (indexer->stats.files_pending > 0 || indexer->in_pipeline > 0 ||
+            index_inbox_count(&indexer->inbox) > 0);
 }
 
 void indexer_wait(Indexer *indexer)
 {
-    if (indexer == NULL || !indexer->thread_running) {
+    if (indexer == NULL) {
         return;
     }
 
-    pthread_join(indexer->worker_thread, NULL);
+    // The worker outlives the initial pass (it sleeps until more files arrive), so wait
+    // for the pass to drain rather than for the thread
+    pthread_mutex_lock(&indexer->mutex);
+    while (indexer->thread_running &&
+           (!indexer->initial_scan_complete || index_queue_count(indexer->queue) > 0 ||
+            indexer->in_pipeline > 0)) {
+        pthread_mutex_unlock(&indexer->mutex);
+        usleep(1000);
+        pthread_mutex_lock(&indexer->mutex);
+    }
+    pthread_mutex_unlock(&indexer->mutex);
 }
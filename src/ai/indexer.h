@@ -2,10 +2,15 @@
 #define INDEXER_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <pthread.h>
 #include "embeddings.h"
 #include "vectordb.h"
+#include "path_index.h"
+#include "hash_cache.h"
+
+struct FsWatch;
 
 // Maximum number of directories to watch
 #define INDEXER_MAX_WATCH_DIRS 32
@@ -13,6 +18,25 @@
 // Maximum exclude patterns
 #define INDEXER_MAX_EXCLUDE_PATTERNS 64
 
+// Maximum file reader threads in the indexing pipeline
+#define INDEXER_MAX_READER_THREADS 8
+
+// Images and scanned PDFs whose text is recognized together in the OCR stage
+#define INDEXER_OCR_BATCH 8
+
+// Pages of a scanned PDF recognized; later pages are not indexed
+#define INDEXER_OCR_MAX_PAGES 16
+
+// Seconds of writes behind the recent files/sec and bytes/sec
+#define INDEXER_RATE_WINDOW_SEC 10
+
+// Latency histogram buckets: bucket 0 holds samples under 1 us, bucket i those under
+// 2^i us, and the last one everything slower (about 8 s and up)
+#define INDEXER_LATENCY_BUCKETS 24
+
+// Metrics files are moved aside to PATH.1 once they grow past this
+#define INDEXER_METRICS_MAX_BYTES (4 * 1024 * 1024)
+
 // Indexer status
 typedef enum IndexerStatus {
     INDEXER_STATUS_STOPPED = 0,
@@ -22,15 +46,73 @@ typedef enum IndexerStatus {
     INDEXER_STATUS_ERROR
 } IndexerStatus;
 
+// Per-stage pipeline statistics
+typedef struct IndexerStageStats {
+    int64_t queued;             // Files waiting in front of the stage
+    int64_t processed;          // Files the stage has passed on
+    double files_per_sec;       // Since indexer_start
+} IndexerStageStats;
+
+// Latency of one pipeline stage
+typedef struct IndexerLatency {
+    uint32_t buckets[INDEXER_LATENCY_BUCKETS];
+    int64_t count;
+    double total_ms;
+} IndexerLatency;
+
+// Why files were left out of the vector index
+typedef struct IndexerSkipStats {
+    int64_t excluded;           // Hidden or matching an exclude pattern (a pruned folder counts once)
+    int64_t too_large;          // Over max_file_size_mb
+    int64_t unchanged;          // Already indexed at this modification time
+    int64_t binary;             // Text or code file stored by name only: binary or unreadable
+    int64_t failed;             // Gone before it was read, or its write failed
+} IndexerSkipStats;
+
 // Indexer statistics
 typedef struct IndexerStats {
     int64_t files_indexed;
     int64_t files_pending;
     int64_t files_skipped;
+    int64_t files_deduplicated;  // Embedding reused from a file with identical content
+    int64_t sections_indexed;    // Sections of long files stored on their own
+    int64_t files_stale;         // Embedded by an earlier model, re-embedded while idle
+    int64_t files_migrated;      // Re-embedded for the current model since start
+
+    // Database upkeep while idle
+    int64_t files_purged;        // Entries of files that no longer exist, removed
+    int64_t bytes_reclaimed;     // Unused space given back to the file system
+    int64_t db_bytes;            // Database file size after the last upkeep
     int64_t total_bytes;
     float progress;             // 0.0 to 1.0
     double elapsed_time_sec;
     double avg_time_per_file_ms;
+
+    // Pipeline: scan -> read -> (ocr) -> embed -> write
+    IndexerStageStats scan;
+    IndexerStageStats read;
+    IndexerStageStats ocr;      // Images and scanned PDFs only
+    IndexerStageStats embed;
+    IndexerStageStats write;
+
+    // Writes over the last INDEXER_RATE_WINDOW_SEC seconds
+    double recent_files_per_sec;
+    double recent_bytes_per_sec;
+
+    // Per file: stat and read (read), split into sections (extract); per recognized
+    // batch (ocr); per engine batch (infer); per write transaction (write)
+    IndexerLatency read_latency;
+    IndexerLatency extract_latency;
+    IndexerLatency ocr_latency;
+    IndexerLatency infer_latency;
+    IndexerLatency write_latency;
+
+    // Sections sent to the engine, and how full its batches were
+    int64_t infer_batches;
+    int64_t infer_texts;
+    float batch_utilization;    // infer_texts / (infer_batches * batch_size)
+
+    IndexerSkipStats skipped;   // files_skipped is unchanged + failed
 } IndexerStats;
 
 // Indexer configuration
@@ -45,9 +127,24 @@ typedef struct IndexerConfig {
     int max_file_size_mb;                             // Skip files larger than this
     int batch_size;                                   // Files per batch
     int delay_between_batches_ms;                     // Throttle indexing
-    bool enable_fsevents;                             // Use FSEvents for real-time watching
+    int reader_threads;                               // Parallel file readers (1..INDEXER_MAX_READER_THREADS)
+    bool enable_fsevents;                             // Watch for changes through the watch bus
+    bool follow_only;                                 // Skip the initial scan and only follow
+                                                      // changes (the index daemon keeps it current)
+    bool respect_ignore_files;                        // Leave what .gitignore/.ignore files and
+                                                      // CACHEDIR.TAG markers exclude out of the
+                                                      // vector index (names are still indexed)
+    bool ocr;                                         // Index the text recognized in images and
+                                                      // PDFs without a text layer (scans)
 } IndexerConfig;
 
+// How hard the pipeline may run, set from outside as load and power change
+typedef struct IndexerThrottle {
+    int embed_threads;          // Inference threads for a batch (0 = engine default)
+    int batch_delay_ms;         // Pause after each embedded batch, on top of the configured one
+    bool background;            // Run pipeline threads at background QoS (slower CPU and disk)
+} IndexerThrottle;
+
 // Progress callback for indexing status updates
 typedef void (*IndexerProgressCallback)(int64_t files_indexed, int64_t files_total,
                                           float progress, void *user_data);
@@ -73,6 +170,15 @@ void indexer_set_embedding_engine(Indexer *indexer, EmbeddingEngine *engine);
 // Set the vector database (must be called before start)
 void indexer_set_vectordb(Indexer *indexer, VectorDB *db);
 
+// Set the filename index fed by scans and file events (optional; enough to start without a vectordb)
+void indexer_set_path_index(Indexer *indexer, PathIndex *index);
+
+// Set a content hash cache to invalidate on file events (optional)
+void indexer_set_hash_cache(Indexer *indexer, HashCache *cache);
+
+// Set the watch bus that reports changes under the watch directories (before start)
+void indexer_set_fs_watch(Indexer *indexer, struct FsWatch *watch);
+
 // Add directory to watch list
 bool indexer_add_watch_dir(Indexer *indexer, const char *path);
 
@@ -82,6 +188,10 @@ bool indexer_remove_watch_dir(Indexer *indexer, const char *path);
 // Add exclude pattern (e.g., "node_modules", "*.log")
 bool indexer_add_exclude_pattern(Indexer *indexer, const char *pattern);
 
+// Honor .gitignore/.ignore files and cache markers (see respect_ignore_files); applies
+// to scans and changes from then on
+void indexer_set_respect_ignore_files(Indexer *indexer, bool respect);
+
 // Set callback for indexer events
 void indexer_set_callback(Indexer *indexer, IndexerCallback callback, void *user_data);
 
@@ -91,9 +201,15 @@ void indexer_set_progress_callback(Indexer *indexer, IndexerProgressCallback cal
 // Start indexing (spawns background thread)
 bool indexer_start(Indexer *indexer);
 
-// Enable/disable real-time file watching (uses FSEvents on macOS)
+// Enable/disable real-time file watching (needs a watch bus)
 bool indexer_enable_watching(Indexer *indexer, bool enable);
 
+// Files directly in these folders (the browsed one, open tabs) are indexed first
+void indexer_set_visible_dirs(Indexer *indexer, const char *const *dirs, int count);
+
+// Pace the pipeline (takes effect from the next batch)
+void indexer_set_throttle(Indexer *indexer, const IndexerThrottle *throttle);
+
 // Stop indexing
 void indexer_stop(Indexer *indexer);
 
@@ -109,6 +225,16 @@ IndexerStatus indexer_get_status(const Indexer *indexer);
 // Get statistics (requires lock, so not const-correct)
 IndexerStats indexer_get_stats(Indexer *indexer);
 
+// Latency below which a share of the samples fall, in milliseconds (bucket resolution;
+// 0 with no samples)
+double indexer_latency_percentile(const IndexerLatency *latency, float percentile);
+
+// One-line summary for the performance overlay
+void indexer_stats_string(const IndexerStats *stats, char *buffer, size_t size);
+
+// Append the stats to a metrics file as one JSON line, stamped with the time and host
+bool indexer_write_metrics(const IndexerStats *stats, const char *path);
+
 // Force re-index a specific file
 bool indexer_reindex_file(Indexer *indexer, const char *path);
 
@@ -121,10 +247,15 @@ bool indexer_should_index_file(const Indexer *indexer, const char *path);
 // Get default indexer configuration
 IndexerConfig indexer_get_default_config(void);
 
+// Whether the filename index answers for dir: its initial scan is done, dir lies under
+// a watched folder and no folder on the way is hidden or excluded. With name_pattern,
+// also that the pattern cannot name a file the index leaves out
+bool indexer_path_index_covers(Indexer *indexer, const char *dir, const char *name_pattern);
+
 // Check if indexer is busy
 bool indexer_is_busy(const Indexer *indexer);
 
-// Wait for indexing to complete (blocking)
+// Block until the initial pass has been written (or the indexer stopped)
 void indexer_wait(Indexer *indexer);
 
 #endif // INDEXER_H
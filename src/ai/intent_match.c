@@ -0,0 +1,574 @@
+#include "intent_match.h"
+#include "../utils/jobs.h"
+#include "../../external/cJSON/cJSON.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define INTENT_FILE_HEADER "finder-plus-intents 1"
+
+// A phrasing of a palette command
+typedef struct IntentTemplate {
+    const char *command_id;
+    const char *phrase;
+} IntentTemplate;
+
+static const IntentTemplate INTENT_TEMPLATES[] = {
+    {"view.hidden", "show hidden files"}, {"view.hidden", "hide hidden files"},
+    {"view.hidden", "toggle hidden files"}, {"view.hidden", "show dotfiles"},
+    {"view.list", "list view"}, {"view.list", "show as list"},
+    {"view.grid", "grid view"}, {"view.grid", "show as icons"}, {"view.grid", "show thumbnails"},
+    {"view.columns", "column view"}, {"view.columns", "show as columns"},
+    {"view.treemap", "disk usage view"}, {"view.treemap", "show disk usage"},
+    {"view.treemap", "what is taking up space"},
+    {"view.preview", "toggle preview"}, {"view.preview", "show preview"}, {"view.preview", "hide preview"},
+    {"view.sidebar", "toggle sidebar"}, {"view.sidebar", "show sidebar"}, {"view.sidebar", "hide sidebar"},
+    {"view.fullscreen", "toggle fullscreen"}, {"view.fullscreen", "full screen"},
+    {"view.theme", "toggle theme"}, {"view.theme", "dark mode"}, {"view.theme", "light mode"},
+    {"nav.back", "go back"}, {"nav.forward", "go forward"},
+    {"nav.parent", "go up"}, {"nav.parent", "go parent folder"}, {"nav.parent", "up one level"},
+    {"nav.home", "go home"}, {"nav.home", "go home folder"},
+    {"nav.refresh", "refresh"}, {"nav.refresh", "reload folder"},
+    {"tab.new", "new tab"}, {"tab.new", "open new tab"}, {"tab.close", "close tab"},
+    {"edit.select_all", "select all"}, {"edit.select_all", "select everything"},
+    {"window.queue", "show operation queue"}, {"window.queue", "show queue"},
+    {"window.queue", "show file operations"},
+};
+
+#define INTENT_TEMPLATE_COUNT ((int)(sizeof(INTENT_TEMPLATES) / sizeof(INTENT_TEMPLATES[0])))
+
+// Words that do not change what a command means
+static const char *INTENT_FILLER[] = {
+    "please", "pls", "the", "a", "an", "me", "my", "can", "could", "would", "you", "just",
+    "now", "i", "want", "to", "of", "in", "lets", "let", "us", NULL
+};
+
+// Openings of "go to NAME"
+static const char *INTENT_NAVIGATE_PREFIXES[] = {
+    "go to ", "goto ", "cd ", "open folder ", "open ", "navigate to ", "jump to ",
+    "take me to ", "switch to ", NULL
+};
+
+// A learned prompt
+typedef struct IntentEntry {
+    char prompt[INTENT_PROMPT_LEN];     // Normalized
+    char cwd[1024];
+    int uses;
+    time_t last_used;
+    IntentCall *calls;
+    int call_count;
+} IntentEntry;
+
+struct IntentMatcher {
+    pthread_mutex_t mutex;              // Guards everything below
+    IntentEntry entries[INTENT_CACHE_MAX];
+    int count;
+
+    EmbeddingEngine *engine;
+    float *template_embeddings;         // INTENT_TEMPLATE_COUNT rows once embedded
+    bool embedding_templates;           // Job running
+    JobToken *embed_token;
+};
+
+void intent_normalize(const char *prompt, char *out, size_t out_size)
+{
+    if (!out || out_size == 0) return;
+    out[0] = '\0';
+    if (!prompt) return;
+
+    size_t j = 0;
+    const char *p = prompt;
+    while (*p) {
+        while (*p && !isalnum((unsigned char)*p)) p++;
+        char word[64];
+        size_t len = 0;
+        while (*p && (isalnum((unsigned char)*p) || *p == '\'')) {
+            if (*p != '\'' && len < sizeof(word) - 1) {
+                word[len++] = (char)tolower((unsigned char)*p);
+            }
+            p++;
+        }
+        word[len] = '\0';
+        if (len == 0) continue;
+
+        bool filler = false;
+        for (int i = 0; INTENT_FILLER[i] && !filler; i++) {
+            filler = strcmp(word, INTENT_FILLER[i]) == 0;
+        }
+        if (filler || j + len + 2 > out_size) continue;
+        if (j > 0) out[j++] = ' ';
+        memcpy(out + j, word, len);
+        j += len;
+    }
+    out[j] = '\0';
+}
+
+// Helper: share of distinct words the two normalized strings have in common (Jaccard)
+static float word_overlap(const char *a, const char *b)
+{
+    char words[2][16][32];
+    int counts[2] = {0, 0};
+    const char *texts[2] = {a, b};
+    for (int t = 0; t < 2; t++) {
+        const char *p = texts[t];
+        while (*p && counts[t] < 16) {
+            size_t len = strcspn(p, " ");
+            if (len > 0 && len < 32) {
+                bool seen = false;
+                for (int k = 0; k < counts[t] && !seen; k++) {
+                    seen = strncmp(words[t][k], p, len) == 0 && words[t][k][len] == '\0';
+                }
+                if (!seen) {
+                    memcpy(words[t][counts[t]], p, len);
+                    words[t][counts[t]++][len] = '\0';
+                }
+            }
+            p += len + (p[len] == ' ');
+        }
+    }
+    if (counts[0] == 0 || counts[1] == 0) return 0.0f;
+
+    int shared = 0;
+    for (int i = 0; i < counts[0]; i++) {
+        for (int k = 0; k < counts[1]; k++) {
+            if (strcmp(words[0][i], words[1][k]) == 0) {
+                shared++;
+                break;
+            }
+        }
+    }
+    return (float)shared / (float)(counts[0] + counts[1] - shared);
+}
+
+IntentMatcher *intent_matcher_create(void)
+{
+    IntentMatcher *matcher = calloc(1, sizeof(IntentMatcher));
+    if (!matcher) return NULL;
+    pthread_mutex_init(&matcher->mutex, NULL);
+    return matcher;
+}
+
+// Helper: stop a template embedding job and wait for it
+static void stop_embedding(IntentMatcher *matcher)
+{
+    if (matcher->embed_token) {
+        job_token_cancel(matcher->embed_token);
+        job_token_wait(matcher->embed_token);
+        job_token_release(matcher->embed_token);
+        matcher->embed_token = NULL;
+    }
+}
+
+void intent_matcher_free(IntentMatcher *matcher)
+{
+    if (!matcher) return;
+    stop_embedding(matcher);
+    for (int i = 0; i < matcher->count; i++) {
+        free(matcher->entries[i].calls);
+    }
+    free(matcher->template_embeddings);
+    pthread_mutex_destroy(&matcher->mutex);
+    free(matcher);
+}
+
+// Helper: embed every template phrase (runs on a worker)
+static void embed_templates_run(void *arg, JobToken *token)
+{
+    IntentMatcher *matcher = arg;
+    float *embeddings = malloc(sizeof(float) * EMBEDDING_DIMENSION * INTENT_TEMPLATE_COUNT);
+    bool ok = embeddings != NULL;
+    for (int i = 0; ok && i < INTENT_TEMPLATE_COUNT; i++) {
+        if (job_token_cancelled(token)) {
+            ok = false;
+            break;
+        }
+        EmbeddingResult result = embedding_generate(matcher->engine, INTENT_TEMPLATES[i].phrase);
+        ok = result.status == EMBEDDING_STATUS_OK;
+        if (ok) {
+            memcpy(&embeddings[i * EMBEDDING_DIMENSION], result.embedding, sizeof(result.embedding));
+        }
+    }
+
+    pthread_mutex_lock(&matcher->mutex);
+    if (ok) {
+        free(matcher->template_embeddings);
+        matcher->template_embeddings = embeddings;
+        embeddings = NULL;
+    }
+    matcher->embedding_templates = false;
+    pthread_mutex_unlock(&matcher->mutex);
+    free(embeddings);
+}
+
+void intent_matcher_set_engine(IntentMatcher *matcher, EmbeddingEngine *engine)
+{
+    if (!matcher) return;
+    stop_embedding(matcher);
+
+    pthread_mutex_lock(&matcher->mutex);
+    matcher->engine = engine;
+    free(matcher->template_embeddings);
+    matcher->template_embeddings = NULL;
+    matcher->embedding_templates = false;
+    pthread_mutex_unlock(&matcher->mutex);
+}
+
+// Helper: start embedding the templates if the model is loaded and nobody has yet
+// (matching never loads the model itself, which takes far longer than asking Claude)
+static void start_embedding(IntentMatcher *matcher)
+{
+    pthread_mutex_lock(&matcher->mutex);
+    bool start = matcher->engine && !matcher->template_embeddings && !matcher->embedding_templates &&
+                 !matcher->embed_token && embedding_engine_is_loaded(matcher->engine);
+    if (start) {
+        matcher->embedding_templates = true;
+    }
+    pthread_mutex_unlock(&matcher->mutex);
+    if (!start) return;
+
+    matcher->embed_token = job_token_create();
+    jobs_submit(JOB_QOS_BACKGROUND, embed_templates_run, NULL, matcher, matcher->embed_token);
+}
+
+// Helper: look for a folder called name (any case) in dir; true and its path in out
+static bool find_folder(const char *dir, const char *name, char *out, size_t out_size)
+{
+    DIR *d = opendir(dir);
+    if (!d) return false;
+
+    bool found = false;
+    struct dirent *entry;
+    while (!found && (entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.' || strcasecmp(entry->d_name, name) != 0) continue;
+        snprintf(out, out_size, "%s/%s", dir, entry->d_name);
+        struct stat st;
+        found = stat(out, &st) == 0 && S_ISDIR(st.st_mode);
+    }
+    closedir(d);
+    return found;
+}
+
+// Helper: "go to NAME" where NAME is a folder in cwd or the home folder, or a path
+static bool match_navigation(const char *prompt, const char *cwd, IntentMatch *match)
+{
+    char text[1024];
+    size_t len = 0;
+    while (*prompt && isspace((unsigned char)*prompt)) prompt++;
+    for (; prompt[len] && len < sizeof(text) - 1; len++) {
+        text[len] = prompt[len];
+    }
+    while (len > 0 && (isspace((unsigned char)text[len - 1]) || text[len - 1] == '.' ||
+                       text[len - 1] == '!')) {
+        len--;
+    }
+    text[len] = '\0';
+
+    const char *name = NULL;
+    for (int i = 0; INTENT_NAVIGATE_PREFIXES[i] && !name; i++) {
+        size_t prefix = strlen(INTENT_NAVIGATE_PREFIXES[i]);
+        if (strncasecmp(text, INTENT_NAVIGATE_PREFIXES[i], prefix) == 0) {
+            name = text + prefix;
+        }
+    }
+    if (!name) return false;
+
+    // "the Downloads folder", "my projects directory"
+    if (strncasecmp(name, "the ", 4) == 0 || strncasecmp(name, "my ", 3) == 0) {
+        name = strchr(name, ' ') + 1;
+    }
+    len = strlen(name);
+    const char *suffixes[] = {" folder", " directory", NULL};
+    for (int i = 0; suffixes[i]; i++) {
+        size_t suffix = strlen(suffixes[i]);
+        if (len > suffix && strcasecmp(name + len - suffix, suffixes[i]) == 0) {
+            text[(name - text) + len - suffix] = '\0';
+            break;
+        }
+    }
+    if (!name[0]) return false;
+
+    const char *home = getenv("HOME");
+    struct stat st;
+    if (name[0] == '/' || (name[0] == '~' && (name[1] == '/' || name[1] == '\0'))) {
+        if (name[0] == '~' && !home) return false;
+        snprintf(match->path, sizeof(match->path), "%s%s", name[0] == '~' ? home : "", name[0] == '~' ? name + 1 : name);
+        if (stat(match->path, &st) != 0 || !S_ISDIR(st.st_mode)) return false;
+    } else if (!(cwd && find_folder(cwd, name, match->path, sizeof(match->path))) &&
+               !(home && find_folder(home, name, match->path, sizeof(match->path)))) {
+        return false;
+    }
+
+    match->kind = INTENT_NAVIGATE;
+    match->confidence = 1.0f;
+    return true;
+}
+
+// Helper: the palette command whose phrasing is closest to the normalized prompt
+static bool match_template(IntentMatcher *matcher, const char *prompt, const char *normalized,
+                           IntentMatch *match)
+{
+    // Embeddings are compared only once the templates have them
+    float query[EMBEDDING_DIMENSION];
+    pthread_mutex_lock(&matcher->mutex);
+    bool semantic = matcher->template_embeddings != NULL;
+    pthread_mutex_unlock(&matcher->mutex);
+    if (semantic) {
+        EmbeddingResult result = embedding_generate(matcher->engine, prompt);
+        semantic = result.status == EMBEDDING_STATUS_OK;
+        if (semantic) {
+            memcpy(query, result.embedding, sizeof(query));
+        }
+    }
+
+    float scores[INTENT_TEMPLATE_COUNT];
+    for (int i = 0; i < INTENT_TEMPLATE_COUNT; i++) {
+        char phrase[INTENT_PROMPT_LEN];
+        intent_normalize(INTENT_TEMPLATES[i].phrase, phrase, sizeof(phrase));
+        scores[i] = word_overlap(normalized, phrase);
+        if (semantic) {
+            float similarity = embedding_cosine_similarity(query, &matcher->template_embeddings[i * EMBEDDING_DIMENSION]);
+            if (similarity > scores[i]) scores[i] = similarity;
+        }
+    }
+
+    int best = 0;
+    for (int i = 1; i < INTENT_TEMPLATE_COUNT; i++) {
+        if (scores[i] > scores[best]) best = i;
+    }
+    float runner_up = 0.0f;
+    for (int i = 0; i < INTENT_TEMPLATE_COUNT; i++) {
+        if (strcmp(INTENT_TEMPLATES[i].command_id, INTENT_TEMPLATES[best].command_id) != 0 &&
+            scores[i] > runner_up) {
+            runner_up = scores[i];
+        }
+    }
+    if (scores[best] < INTENT_MIN_CONFIDENCE || scores[best] - runner_up < INTENT_MARGIN) {
+        return false;
+    }
+
+    match->kind = INTENT_COMMAND;
+    match->confidence = scores[best];
+    snprintf(match->command_id, sizeof(match->command_id), "%s", INTENT_TEMPLATES[best].command_id);
+    return true;
+}
+
+// Helper: index of the entry for prompt in cwd (caller holds the mutex); -1 if none
+static int find_entry(const IntentMatcher *matcher, const char *normalized, const char *cwd)
+{
+    for (int i = 0; i < matcher->count; i++) {
+        if (strcmp(matcher->entries[i].prompt, normalized) == 0 && strcmp(matcher->entries[i].cwd, cwd) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool intent_match(IntentMatcher *matcher, const char *prompt, const char *cwd, IntentMatch *match)
+{
+    if (!match) return false;
+    match->kind = INTENT_NONE;
+    match->confidence = 0.0f;
+    match->call_count = 0;
+    if (!matcher || !prompt) return false;
+    if (!cwd) cwd = "";
+
+    char normalized[INTENT_PROMPT_LEN];
+    intent_normalize(prompt, normalized, sizeof(normalized));
+    if (!normalized[0]) return false;
+
+    pthread_mutex_lock(&matcher->mutex);
+    int index = find_entry(matcher, normalized, cwd);
+    if (index >= 0) {
+        IntentEntry *entry = &matcher->entries[index];
+        entry->uses++;
+        entry->last_used = time(NULL);
+        memcpy(match->calls, entry->calls, sizeof(IntentCall) * (size_t)entry->call_count);
+        match->call_count = entry->call_count;
+        match->kind = INTENT_TOOLS;
+        match->confidence = 1.0f;
+    }
+    pthread_mutex_unlock(&matcher->mutex);
+    if (index >= 0) return true;
+
+    if (match_navigation(prompt, cwd[0] ? cwd : NULL, match)) return true;
+
+    start_embedding(matcher);
+    return match_template(matcher, prompt, normalized, match);
+}
+
+// Helper: slot for a new entry (caller holds the mutex): a free one, or else the least
+// used, oldest first among equals
+static IntentEntry *take_entry(IntentMatcher *matcher)
+{
+    if (matcher->count < INTENT_CACHE_MAX) {
+        return &matcher->entries[matcher->count++];
+    }
+    IntentEntry *victim = &matcher->entries[0];
+    for (int i = 1; i < matcher->count; i++) {
+        IntentEntry *entry = &matcher->entries[i];
+        if (entry->uses < victim->uses || (entry->uses == victim->uses && entry->last_used < victim->last_used)) {
+            victim = entry;
+        }
+    }
+    free(victim->calls);
+    victim->calls = NULL;
+    return victim;
+}
+
+// Helper: add or refresh an entry (caller holds the mutex)
+static bool store_entry(IntentMatcher *matcher, const char *normalized, const char *cwd,
+                        const IntentCall *calls, int count, int uses, time_t last_used)
+{
+    IntentCall *copy = malloc(sizeof(IntentCall) * (size_t)count);
+    if (!copy) return false;
+    memcpy(copy, calls, sizeof(IntentCall) * (size_t)count);
+
+    int index = find_entry(matcher, normalized, cwd);
+    IntentEntry *entry = index >= 0 ? &matcher->entries[index] : take_entry(matcher);
+    if (index >= 0) {
+        free(entry->calls);
+        uses += entry->uses;
+    }
+    snprintf(entry->prompt, sizeof(entry->prompt), "%s", normalized);
+    snprintf(entry->cwd, sizeof(entry->cwd), "%s", cwd);
+    entry->calls = copy;
+    entry->call_count = count;
+    entry->uses = uses;
+    entry->last_used = last_used;
+    return true;
+}
+
+bool intent_matcher_learn(IntentMatcher *matcher, const char *prompt, const char *cwd,
+                          const IntentCall *calls, int count)
+{
+    if (!matcher || !prompt || !calls || count <= 0 || count > INTENT_MAX_CALLS) return false;
+    if (!cwd) cwd = "";
+
+    // Tabs and newlines would break the saved file
+    if (strlen(cwd) >= sizeof(((IntentEntry *)0)->cwd) || strpbrk(cwd, "\t\n")) return false;
+    for (int i = 0; i < count; i++) {
+        if (!calls[i].name[0] || strlen(calls[i].input_json) >= INTENT_INPUT_LEN - 1) return false;
+    }
+
+    char normalized[INTENT_PROMPT_LEN];
+    intent_normalize(prompt, normalized, sizeof(normalized));
+    if (!normalized[0]) return false;
+
+    pthread_mutex_lock(&matcher->mutex);
+    bool ok = store_entry(matcher, normalized, cwd, calls, count, 1, time(NULL));
+    pthread_mutex_unlock(&matcher->mutex);
+    return ok;
+}
+
+int intent_matcher_count(IntentMatcher *matcher)
+{
+    if (!matcher) return 0;
+    pthread_mutex_lock(&matcher->mutex);
+    int count = matcher->count;
+    pthread_mutex_unlock(&matcher->mutex);
+    return count;
+}
+
+// Helper: one saved line: USES TAB LAST_USED TAB PROMPT TAB CWD TAB [{"name","input"}...]
+static void load_line(IntentMatcher *matcher, char *line)
+{
+    char *fields[5];
+    for (int i = 0; i < 5; i++) {
+        fields[i] = line;
+        char *tab = i < 4 ? strchr(line, '\t') : NULL;
+        if (i < 4 && !tab) return;
+        if (tab) {
+            *tab = '\0';
+            line = tab + 1;
+        }
+    }
+
+    cJSON *array = cJSON_Parse(fields[4]);
+    IntentCall calls[INTENT_MAX_CALLS];
+    int count = 0;
+    const cJSON *item;
+    cJSON_ArrayForEach(item, array) {
+        const cJSON *name = cJSON_GetObjectItemCaseSensitive(item, "name");
+        const cJSON *input = cJSON_GetObjectItemCaseSensitive(item, "input");
+        if (count == INTENT_MAX_CALLS || !cJSON_IsString(name) || !cJSON_IsString(input)) {
+            count = 0;
+            break;
+        }
+        snprintf(calls[count].name, sizeof(calls[count].name), "%s", name->valuestring);
+        snprintf(calls[count].input_json, sizeof(calls[count].input_json), "%s", input->valuestring);
+        count++;
+    }
+    cJSON_Delete(array);
+
+    if (count > 0 && fields[2][0] && matcher->count < INTENT_CACHE_MAX) {
+        store_entry(matcher, fields[2], fields[3], calls, count, atoi(fields[0]), (time_t)atoll(fields[1]));
+    }
+}
+
+bool intent_matcher_load(IntentMatcher *matcher, const char *path)
+{
+    if (!matcher || !path) return false;
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+
+    size_t capacity = INTENT_INPUT_LEN * INTENT_MAX_CALLS * 2;
+    char *line = malloc(capacity);
+    bool ok = line && fgets(line, (int)capacity, f) && strncmp(line, INTENT_FILE_HEADER, strlen(INTENT_FILE_HEADER)) == 0;
+
+    pthread_mutex_lock(&matcher->mutex);
+    while (ok && fgets(line, (int)capacity, f)) {
+        line[strcspn(line, "\n")] = '\0';
+        load_line(matcher, line);
+    }
+    pthread_mutex_unlock(&matcher->mutex);
+
+    free(line);
+    fclose(f);
+    return ok;
+}
+
+bool intent_matcher_save(IntentMatcher *matcher, const char *path)
+{
+    if (!matcher || !path) return false;
+
+    char temp[4096];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE *f = fopen(temp, "w");
+    if (!f) return false;
+
+    fprintf(f, "%s\n", INTENT_FILE_HEADER);
+    pthread_mutex_lock(&matcher->mutex);
+    for (int i = 0; i < matcher->count; i++) {
+        const IntentEntry *entry = &matcher->entries[i];
+        cJSON *array = cJSON_CreateArray();
+        for (int k = 0; array && k < entry->call_count; k++) {
+            cJSON *call = cJSON_CreateObject();
+            cJSON_AddStringToObject(call, "name", entry->calls[k].name);
+            cJSON_AddStringToObject(call, "input", entry->calls[k].input_json);
+            cJSON_AddItemToArray(array, call);
+        }
+        char *json = array ? cJSON_PrintUnformatted(array) : NULL;
+        if (json) {
+            fprintf(f, "%d\t%lld\t%s\t%s\t%s\n", entry->uses, (long long)entry->last_used,
+                    entry->prompt, entry->cwd, json);
+        }
+        cJSON_free(json);
+        cJSON_Delete(array);
+    }
+    pthread_mutex_unlock(&matcher->mutex);
+
+    bool ok = fflush(f) == 0 && !ferror(f);
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(temp, path) != 0) {
+        unlink(temp);
+        return false;
+    }
+    return true;
+}
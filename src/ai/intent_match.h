@@ -0,0 +1,77 @@
+#ifndef INTENT_MATCH_H
+#define INTENT_MATCH_H
+
+#include <stdbool.h>
+#include "embeddings.h"
+
+// Local intent matching for typed commands, so frequent ones resolve in milliseconds
+// instead of a round trip to Claude. Tried in order:
+//   - a learned cache of prompts Claude resolved before, and the user ran, to the tool
+//     calls it chose; keyed by the normalized prompt and the folder it was typed in
+//   - "go to NAME" and its variants, when NAME is a folder here or in the home folder
+//   - a table of phrasings of the command palette's commands ("show hidden files"),
+//     compared by embedding similarity once the BERT engine is loaded and by word
+//     overlap otherwise
+// Anything below INTENT_MIN_CONFIDENCE is left to Claude
+
+#define INTENT_MIN_CONFIDENCE 0.86f     // Template score needed to skip Claude
+#define INTENT_MARGIN 0.04f             // ... by this much over the best other command
+#define INTENT_MAX_CALLS 8              // Tool calls in a learned chain
+#define INTENT_INPUT_LEN 4096           // Longest tool input kept; longer chains are not learned
+#define INTENT_CACHE_MAX 256            // Learned prompts; least used dropped first
+#define INTENT_PROMPT_LEN 256           // Normalized prompt
+
+typedef enum IntentKind {
+    INTENT_NONE = 0,
+    INTENT_COMMAND,                     // Run palette command command_id
+    INTENT_NAVIGATE,                    // Open folder path
+    INTENT_TOOLS                        // Run calls, as if Claude had asked for them
+} IntentKind;
+
+// One tool call of a learned chain
+typedef struct IntentCall {
+    char name[64];
+    char input_json[INTENT_INPUT_LEN];
+} IntentCall;
+
+typedef struct IntentMatch {
+    IntentKind kind;
+    float confidence;                   // 1 for cache hits and folders found
+    char command_id[64];
+    char path[1024];
+    IntentCall calls[INTENT_MAX_CALLS];
+    int call_count;
+} IntentMatch;
+
+// Intent matcher (opaque)
+typedef struct IntentMatcher IntentMatcher;
+
+IntentMatcher *intent_matcher_create(void);
+
+// Wait for template embedding to stop and free the matcher
+void intent_matcher_free(IntentMatcher *matcher);
+
+// Compare by meaning with engine (may be NULL) once its model is loaded; the templates
+// are embedded in the background
+void intent_matcher_set_engine(IntentMatcher *matcher, EmbeddingEngine *engine);
+
+// Read learned prompts saved by intent_matcher_save (false if there is no file)
+bool intent_matcher_load(IntentMatcher *matcher, const char *path);
+
+// Write the learned prompts to path, replacing it atomically
+bool intent_matcher_save(IntentMatcher *matcher, const char *path);
+
+// Resolve prompt typed in cwd; false (match->kind INTENT_NONE) if Claude should
+bool intent_match(IntentMatcher *matcher, const char *prompt, const char *cwd, IntentMatch *match);
+
+// Remember that prompt in cwd ran calls; false if it cannot be kept
+bool intent_matcher_learn(IntentMatcher *matcher, const char *prompt, const char *cwd,
+                          const IntentCall *calls, int count);
+
+// Learned prompts
+int intent_matcher_count(IntentMatcher *matcher);
+
+// Lowercase prompt, with punctuation and filler words ("please", "the") dropped
+void intent_normalize(const char *prompt, char *out, size_t out_size);
+
+#endif // INTENT_MATCH_H
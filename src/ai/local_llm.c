@@ -0,0 +1,355 @@
+#include "local_llm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#ifdef FINDER_PLUS_LOCAL_LLM
+#include "llama.h"
+#endif
+
+// Local model engine internal structure
+struct LocalLLM {
+    LocalLLMConfig config;
+    bool model_loaded;
+    bool initialized;
+
+    // Held for a whole load, reply or unload; the llama context serves one at a time
+    pthread_mutex_t lock;
+    bool lazy;                  // config.model_path loads on first use (and again after a trim)
+    atomic_llong last_used;     // time() of the last reply
+#ifdef FINDER_PLUS_LOCAL_LLM
+    struct llama_model *model;
+    struct llama_context *ctx;
+    const struct llama_vocab *vocab;
+    const char *chat_template;  // Owned by model; NULL falls back to llama.cpp's default
+#endif
+};
+
+// Default model path
+static const char *DEFAULT_MODEL_PATH = "models/summary-llm.gguf";
+
+// Helper: Whether a model file exists
+static bool model_exists(const char *model_path)
+{
+    struct stat st;
+    return model_path != NULL && model_path[0] != '\0' && stat(model_path, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+#ifdef FINDER_PLUS_LOCAL_LLM
+static pthread_once_t g_backend_once = PTHREAD_ONCE_INIT;
+
+// Keep llama.cpp's per-layer load chatter out of stderr
+static void log_callback(enum ggml_log_level level, const char *text, void *context)
+{
+    (void)context;
+    if (level >= GGML_LOG_LEVEL_WARN) {
+        fputs(text, stderr);
+    }
+}
+
+static void backend_init(void)
+{
+    llama_log_set(log_callback, NULL);
+    llama_backend_init();
+}
+#endif
+
+LocalLLM* local_llm_create(void)
+{
+    LocalLLMConfig config = {0};
+    config.num_threads = 0;
+    config.use_gpu = true;      // Metal on Apple silicon, ignored elsewhere
+    strncpy(config.model_path, DEFAULT_MODEL_PATH, sizeof(config.model_path) - 1);
+
+    return local_llm_create_with_config(&config);
+}
+
+LocalLLM* local_llm_create_with_config(const LocalLLMConfig *config)
+{
+    if (config == NULL) {
+        return NULL;
+    }
+
+    LocalLLM *engine = calloc(1, sizeof(LocalLLM));
+    if (engine == NULL) {
+        return NULL;
+    }
+
+    memcpy(&engine->config, config, sizeof(LocalLLMConfig));
+    engine->model_loaded = false;
+    engine->initialized = true;
+    pthread_mutex_init(&engine->lock, NULL);
+    engine->lazy = false;
+    atomic_init(&engine->last_used, 0);
+
+    return engine;
+}
+
+// Helper: free the model (call with the lock held)
+static void unload_model_locked(LocalLLM *engine)
+{
+#ifdef FINDER_PLUS_LOCAL_LLM
+    if (engine->ctx != NULL) {
+        llama_free(engine->ctx);
+        engine->ctx = NULL;
+    }
+    if (engine->model != NULL) {
+        llama_model_free(engine->model);
+        engine->model = NULL;
+    }
+    engine->vocab = NULL;
+    engine->chat_template = NULL;
+#endif
+
+    engine->model_loaded = false;
+}
+
+void local_llm_destroy(LocalLLM *engine)
+{
+    if (engine == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&engine->lock);
+    unload_model_locked(engine);
+    pthread_mutex_unlock(&engine->lock);
+    pthread_mutex_destroy(&engine->lock);
+    free(engine);
+}
+
+// Helper: load config.model_path (call with the lock held)
+static LocalLLMStatus load_model_locked(LocalLLM *engine)
+{
+    if (!model_exists(engine->config.model_path)) {
+        return LOCAL_LLM_STATUS_MODEL_NOT_FOUND;
+    }
+
+#ifdef FINDER_PLUS_LOCAL_LLM
+    pthread_once(&g_backend_once, backend_init);
+
+    struct llama_model_params model_params = llama_model_default_params();
+    model_params.n_gpu_layers = engine->config.use_gpu ? 999 : 0;
+    engine->model = llama_model_load_from_file(engine->config.model_path, model_params);
+    if (engine->model == NULL) {
+        return LOCAL_LLM_STATUS_MODEL_LOAD_ERROR;
+    }
+
+    int threads = engine->config.num_threads > 0 ? engine->config.num_threads : 4;
+    struct llama_context_params context_params = llama_context_default_params();
+    context_params.n_ctx = LOCAL_LLM_CONTEXT;
+    context_params.n_batch = LOCAL_LLM_CONTEXT;
+    context_params.n_threads = threads;
+    context_params.n_threads_batch = threads;
+    engine->ctx = llama_init_from_model(engine->model, context_params);
+    if (engine->ctx == NULL) {
+        llama_model_free(engine->model);
+        engine->model = NULL;
+        return LOCAL_LLM_STATUS_MODEL_LOAD_ERROR;
+    }
+
+    engine->vocab = llama_model_get_vocab(engine->model);
+    engine->chat_template = llama_model_chat_template(engine->model, NULL);
+    engine->model_loaded = true;
+    return LOCAL_LLM_STATUS_OK;
+#else
+    return LOCAL_LLM_STATUS_NOT_BUILT;
+#endif
+}
+
+LocalLLMStatus local_llm_load_model_lazily(LocalLLM *engine, const char *model_path)
+{
+    if (engine == NULL) {
+        return LOCAL_LLM_STATUS_NOT_INITIALIZED;
+    }
+
+    pthread_mutex_lock(&engine->lock);
+    if (model_path != NULL) {
+        strncpy(engine->config.model_path, model_path, sizeof(engine->config.model_path) - 1);
+    }
+    LocalLLMStatus status = LOCAL_LLM_STATUS_OK;
+#ifdef FINDER_PLUS_LOCAL_LLM
+    if (!model_exists(engine->config.model_path)) {
+        status = LOCAL_LLM_STATUS_MODEL_NOT_FOUND;
+    }
+#else
+    status = LOCAL_LLM_STATUS_NOT_BUILT;
+#endif
+    engine->lazy = status == LOCAL_LLM_STATUS_OK;
+    pthread_mutex_unlock(&engine->lock);
+    return status;
+}
+
+bool local_llm_trim(LocalLLM *engine, double idle_sec)
+{
+    // Skip an engine in use rather than wait for it
+    if (engine == NULL || pthread_mutex_trylock(&engine->lock) != 0) {
+        return false;
+    }
+    bool idle = (double)(time(NULL) - atomic_load(&engine->last_used)) >= idle_sec;
+    bool unload = engine->lazy && engine->model_loaded && idle;
+    if (unload) {
+        unload_model_locked(engine);
+    }
+    pthread_mutex_unlock(&engine->lock);
+    return unload;
+}
+
+bool local_llm_is_loaded(const LocalLLM *engine)
+{
+    if (engine == NULL) {
+        return false;
+    }
+    return engine->model_loaded;
+}
+
+bool local_llm_is_available(const LocalLLM *engine)
+{
+    if (engine == NULL) {
+        return false;
+    }
+    return engine->model_loaded || engine->lazy;
+}
+
+#ifdef FINDER_PLUS_LOCAL_LLM
+// Helper: Run the chat through the model and collect the reply (call with the lock held
+// and the model loaded)
+static LocalLLMStatus generate_locked(LocalLLM *engine, const char *system_prompt, const char *prompt,
+                                      int max_tokens, char *out, size_t out_size)
+{
+    struct llama_chat_message messages[2];
+    int message_count = 0;
+    if (system_prompt != NULL && system_prompt[0] != '\0') {
+        messages[message_count++] = (struct llama_chat_message){ "system", system_prompt };
+    }
+    messages[message_count++] = (struct llama_chat_message){ "user", prompt };
+
+    size_t chat_size = strlen(prompt) + (system_prompt ? strlen(system_prompt) : 0) + 512;
+    char *chat = malloc(chat_size);
+    if (chat == NULL) {
+        return LOCAL_LLM_STATUS_INFERENCE_ERROR;
+    }
+    int chat_len = llama_chat_apply_template(engine->chat_template, messages, (size_t)message_count, true,
+                                             chat, (int32_t)chat_size);
+    if (chat_len > (int)chat_size) {
+        char *larger = realloc(chat, (size_t)chat_len + 1);
+        if (larger == NULL) {
+            free(chat);
+            return LOCAL_LLM_STATUS_INFERENCE_ERROR;
+        }
+        chat = larger;
+        chat_size = (size_t)chat_len + 1;
+        chat_len = llama_chat_apply_template(engine->chat_template, messages, (size_t)message_count, true,
+                                             chat, (int32_t)chat_size);
+    }
+    if (chat_len < 0) {
+        free(chat);
+        return LOCAL_LLM_STATUS_INFERENCE_ERROR;
+    }
+
+    llama_token *tokens = malloc(LOCAL_LLM_CONTEXT * sizeof(llama_token));
+    int token_count = tokens ? llama_tokenize(engine->vocab, chat, chat_len, tokens, LOCAL_LLM_CONTEXT, true, true) : -1;
+    free(chat);
+    if (token_count < 0 || token_count + max_tokens > LOCAL_LLM_CONTEXT) {
+        free(tokens);
+        return tokens ? LOCAL_LLM_STATUS_PROMPT_TOO_LONG : LOCAL_LLM_STATUS_INFERENCE_ERROR;
+    }
+
+    // Each reply starts from an empty context
+    llama_memory_clear(llama_get_memory(engine->ctx), true);
+
+    struct llama_sampler *sampler = llama_sampler_chain_init(llama_sampler_chain_default_params());
+    llama_sampler_chain_add(sampler, llama_sampler_init_greedy());
+
+    LocalLLMStatus status = LOCAL_LLM_STATUS_OK;
+    size_t len = 0;
+    out[0] = '\0';
+    struct llama_batch batch = llama_batch_get_one(tokens, token_count);
+    for (int generated = 0; generated < max_tokens; generated++) {
+        if (llama_decode(engine->ctx, batch) != 0) {
+            status = LOCAL_LLM_STATUS_INFERENCE_ERROR;
+            break;
+        }
+
+        llama_token token = llama_sampler_sample(sampler, engine->ctx, -1);
+        if (llama_vocab_is_eog(engine->vocab, token)) {
+            break;
+        }
+
+        char piece[128];
+        int n = llama_token_to_piece(engine->vocab, token, piece, sizeof(piece), 0, false);
+        if (n > 0 && len + (size_t)n < out_size) {
+            memcpy(out + len, piece, (size_t)n);
+            len += (size_t)n;
+            out[len] = '\0';
+        }
+
+        tokens[0] = token;
+        batch = llama_batch_get_one(tokens, 1);
+    }
+
+    llama_sampler_free(sampler);
+    free(tokens);
+    return status;
+}
+#endif
+
+LocalLLMStatus local_llm_generate(LocalLLM *engine, const char *system_prompt, const char *prompt,
+                                  int max_tokens, char *out, size_t out_size)
+{
+    if (engine == NULL || !engine->initialized || prompt == NULL || out == NULL || out_size == 0) {
+        return LOCAL_LLM_STATUS_NOT_INITIALIZED;
+    }
+    out[0] = '\0';
+    if (strlen(prompt) > LOCAL_LLM_MAX_PROMPT) {
+        return LOCAL_LLM_STATUS_PROMPT_TOO_LONG;
+    }
+
+#ifdef FINDER_PLUS_LOCAL_LLM
+    atomic_store(&engine->last_used, (long long)time(NULL));
+
+    pthread_mutex_lock(&engine->lock);
+    if (!engine->model_loaded && engine->lazy && load_model_locked(engine) != LOCAL_LLM_STATUS_OK) {
+        engine->lazy = false;   // Do not retry a broken model on every call
+    }
+    LocalLLMStatus status = engine->model_loaded
+        ? generate_locked(engine, system_prompt, prompt, max_tokens, out, out_size)
+        : LOCAL_LLM_STATUS_NOT_INITIALIZED;
+    pthread_mutex_unlock(&engine->lock);
+    return status;
+#else
+    (void)system_prompt;
+    (void)max_tokens;
+    return LOCAL_LLM_STATUS_NOT_BUILT;
+#endif
+}
+
+const char* local_llm_status_message(LocalLLMStatus status)
+{
+    switch (status) {
+        case LOCAL_LLM_STATUS_OK:
+            return "OK";
+        case LOCAL_LLM_STATUS_NOT_INITIALIZED:
+            return "Local model not initialized";
+        case LOCAL_LLM_STATUS_MODEL_NOT_FOUND:
+            return "Local model file not found";
+        case LOCAL_LLM_STATUS_MODEL_LOAD_ERROR:
+            return "Failed to load local model";
+        case LOCAL_LLM_STATUS_PROMPT_TOO_LONG:
+            return "Prompt too long for local model";
+        case LOCAL_LLM_STATUS_INFERENCE_ERROR:
+            return "Local model inference failed";
+        case LOCAL_LLM_STATUS_NOT_BUILT:
+            return "Built without local model support";
+        default:
+            return "Unknown error";
+    }
+}
+
+const char* local_llm_get_default_model_path(void)
+{
+    return DEFAULT_MODEL_PATH;
+}
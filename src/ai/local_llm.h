@@ -0,0 +1,70 @@
+#ifndef LOCAL_LLM_H
+#define LOCAL_LLM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Small instruct model run on the device (llama.cpp, Metal on Apple silicon) for text
+// short enough not to need Claude: one-line hover summaries. Built only with
+// FINDER_PLUS_LOCAL_LLM; otherwise no model is ever available and callers fall back
+
+// Context the model runs with (prompt and reply together, in tokens)
+#define LOCAL_LLM_CONTEXT 4096
+
+// Longest prompt, in bytes, generation accepts; longer text should be cut first
+#define LOCAL_LLM_MAX_PROMPT 8192
+
+typedef enum LocalLLMStatus {
+    LOCAL_LLM_STATUS_OK = 0,
+    LOCAL_LLM_STATUS_NOT_INITIALIZED,
+    LOCAL_LLM_STATUS_MODEL_NOT_FOUND,
+    LOCAL_LLM_STATUS_MODEL_LOAD_ERROR,
+    LOCAL_LLM_STATUS_PROMPT_TOO_LONG,
+    LOCAL_LLM_STATUS_INFERENCE_ERROR,
+    LOCAL_LLM_STATUS_NOT_BUILT          // Compiled without FINDER_PLUS_LOCAL_LLM
+} LocalLLMStatus;
+
+typedef struct LocalLLMConfig {
+    char model_path[4096];      // Path to a GGUF instruct model (1-3B parameters)
+    int num_threads;            // CPU threads for what is not offloaded (0 = auto)
+    bool use_gpu;               // Offload every layer to Metal
+} LocalLLMConfig;
+
+// Local model engine (opaque). Generation is serialized: one reply at a time
+typedef struct LocalLLM LocalLLM;
+
+// Create an engine with the default configuration
+LocalLLM* local_llm_create(void);
+
+// Create an engine with a custom configuration
+LocalLLM* local_llm_create_with_config(const LocalLLMConfig *config);
+
+// Destroy an engine
+void local_llm_destroy(LocalLLM *engine);
+
+// Remember a model to load on first use instead of loading it now (fails only if the
+// file is missing or support is not built). Such a model may be trimmed when idle
+LocalLLMStatus local_llm_load_model_lazily(LocalLLM *engine, const char *model_path);
+
+// Unload a model unused for idle_sec; returns whether it was unloaded. An engine busy
+// generating is skipped
+bool local_llm_trim(LocalLLM *engine, double idle_sec);
+
+// Check if a model is loaded
+bool local_llm_is_loaded(const LocalLLM *engine);
+
+// Check if replies can be generated (model loaded, or loads on first use)
+bool local_llm_is_available(const LocalLLM *engine);
+
+// Generate a reply to one user message under a system prompt, greedily, stopping after
+// max_tokens tokens. out receives the reply NUL-terminated (truncated to fit)
+LocalLLMStatus local_llm_generate(LocalLLM *engine, const char *system_prompt, const char *prompt,
+                                  int max_tokens, char *out, size_t out_size);
+
+// Get status message
+const char* local_llm_status_message(LocalLLMStatus status);
+
+// Get default model path
+const char* local_llm_get_default_model_path(void);
+
+#endif // LOCAL_LLM_H
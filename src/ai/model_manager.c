@@ -0,0 +1,206 @@
+#include "model_manager.h"
+#include <pthread.h>
+#include <stdio.h>
+
+#ifdef __APPLE__
+#include <dispatch/dispatch.h>
+#endif
+
+static struct {
+    pthread_mutex_t mutex;
+    EmbeddingEngine *embedding;
+    int embedding_refs;
+    CLIPEngine *clip;
+    int clip_refs;
+    LocalLLM *llm;
+    int llm_refs;
+#ifdef __APPLE__
+    dispatch_source_t pressure;         // Memory pressure: unload everything idle
+    dispatch_source_t idle_timer;       // Periodic: unload models idle too long
+#endif
+} g_models = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+#ifdef __APPLE__
+static void on_memory_pressure(void *context)
+{
+    (void)context;
+    int unloaded = model_manager_trim(0.0);
+    if (unloaded > 0) {
+        fprintf(stderr, "Memory pressure: unloaded %d model(s)\n", unloaded);
+    }
+}
+
+static void on_idle_timer(void *context)
+{
+    (void)context;
+    model_manager_trim(MODEL_MANAGER_IDLE_SEC);
+}
+#endif
+
+// Helper: watch memory pressure and idle time while any engine is held (call with mutex held)
+static void start_trimming(void)
+{
+#ifdef __APPLE__
+    if (g_models.pressure != NULL) {
+        return;
+    }
+    dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+
+    g_models.pressure = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                                               DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL,
+                                               queue);
+    if (g_models.pressure != NULL) {
+        dispatch_source_set_event_handler_f(g_models.pressure, on_memory_pressure);
+        dispatch_resume(g_models.pressure);
+    }
+
+    // Checked twice per idle period, with generous leeway so the wakeups coalesce
+    uint64_t interval = (uint64_t)(MODEL_MANAGER_IDLE_SEC / 2 * NSEC_PER_SEC);
+    g_models.idle_timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue);
+    if (g_models.idle_timer != NULL) {
+        dispatch_source_set_timer(g_models.idle_timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)interval),
+                                  interval, interval / 4);
+        dispatch_source_set_event_handler_f(g_models.idle_timer, on_idle_timer);
+        dispatch_resume(g_models.idle_timer);
+    }
+#endif
+}
+
+// Helper: stop watching once no engine is held (call with mutex held)
+static void stop_trimming(void)
+{
+#ifdef __APPLE__
+    if (g_models.embedding != NULL || g_models.clip != NULL || g_models.llm != NULL) {
+        return;
+    }
+    // A handler already running only finds no engines to trim
+    if (g_models.pressure != NULL) {
+        dispatch_source_cancel(g_models.pressure);
+        dispatch_release(g_models.pressure);
+        g_models.pressure = NULL;
+    }
+    if (g_models.idle_timer != NULL) {
+        dispatch_source_cancel(g_models.idle_timer);
+        dispatch_release(g_models.idle_timer);
+        g_models.idle_timer = NULL;
+    }
+#endif
+}
+
+EmbeddingEngine* model_manager_acquire_embedding(void)
+{
+    pthread_mutex_lock(&g_models.mutex);
+    if (g_models.embedding == NULL) {
+        g_models.embedding = embedding_engine_create();
+        if (g_models.embedding != NULL) {
+            // Default model path; it loads on the first embedding
+            embedding_engine_load_model_lazily(g_models.embedding, NULL);
+            start_trimming();
+        }
+    }
+    EmbeddingEngine *engine = g_models.embedding;
+    if (engine != NULL) {
+        g_models.embedding_refs++;
+    }
+    pthread_mutex_unlock(&g_models.mutex);
+    return engine;
+}
+
+void model_manager_release_embedding(EmbeddingEngine *engine)
+{
+    if (engine == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_models.mutex);
+    if (engine == g_models.embedding && --g_models.embedding_refs == 0) {
+        embedding_engine_destroy(g_models.embedding);
+        g_models.embedding = NULL;
+        stop_trimming();
+    }
+    pthread_mutex_unlock(&g_models.mutex);
+}
+
+CLIPEngine* model_manager_acquire_clip(void)
+{
+    pthread_mutex_lock(&g_models.mutex);
+    if (g_models.clip == NULL) {
+        g_models.clip = clip_engine_create();
+        if (g_models.clip != NULL) {
+            clip_engine_load_model_lazily(g_models.clip, NULL);
+            start_trimming();
+        }
+    }
+    CLIPEngine *engine = g_models.clip;
+    if (engine != NULL) {
+        g_models.clip_refs++;
+    }
+    pthread_mutex_unlock(&g_models.mutex);
+    return engine;
+}
+
+void model_manager_release_clip(CLIPEngine *engine)
+{
+    if (engine == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_models.mutex);
+    if (engine == g_models.clip && --g_models.clip_refs == 0) {
+        clip_engine_destroy(g_models.clip);
+        g_models.clip = NULL;
+        stop_trimming();
+    }
+    pthread_mutex_unlock(&g_models.mutex);
+}
+
+LocalLLM* model_manager_acquire_llm(void)
+{
+    pthread_mutex_lock(&g_models.mutex);
+    if (g_models.llm == NULL) {
+        g_models.llm = local_llm_create();
+        if (g_models.llm != NULL) {
+            local_llm_load_model_lazily(g_models.llm, NULL);
+            start_trimming();
+        }
+    }
+    LocalLLM *engine = g_models.llm;
+    if (engine != NULL) {
+        g_models.llm_refs++;
+    }
+    pthread_mutex_unlock(&g_models.mutex);
+    return engine;
+}
+
+void model_manager_release_llm(LocalLLM *engine)
+{
+    if (engine == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_models.mutex);
+    if (engine == g_models.llm && --g_models.llm_refs == 0) {
+        local_llm_destroy(g_models.llm);
+        g_models.llm = NULL;
+        stop_trimming();
+    }
+    pthread_mutex_unlock(&g_models.mutex);
+}
+
+int model_manager_trim(double idle_sec)
+{
+    int unloaded = 0;
+
+    pthread_mutex_lock(&g_models.mutex);
+    if (g_models.embedding != NULL && embedding_engine_trim(g_models.embedding, idle_sec)) {
+        unloaded++;
+    }
+    if (g_models.clip != NULL && clip_engine_trim(g_models.clip, idle_sec)) {
+        unloaded++;
+    }
+    if (g_models.llm != NULL && local_llm_trim(g_models.llm, idle_sec)) {
+        unloaded++;
+    }
+    pthread_mutex_unlock(&g_models.mutex);
+    return unloaded;
+}
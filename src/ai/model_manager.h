@@ -0,0 +1,39 @@
+#ifndef MODEL_MANAGER_H
+#define MODEL_MANAGER_H
+
+#include "embeddings.h"
+#include "clip.h"
+#include "local_llm.h"
+
+// Process-wide owner of the local models. Each engine is created once and shared by
+// everyone who acquires it. Weights load on the first inference rather than at startup,
+// and are dropped again after sitting idle or when the system reports memory pressure;
+// the next inference loads them back
+
+// Seconds a model may sit unused before it is unloaded
+#define MODEL_MANAGER_IDLE_SEC 300.0
+
+// Shared text embedding engine (NULL if it cannot be created); pair with
+// model_manager_release_embedding. is_available tells whether its model exists
+EmbeddingEngine* model_manager_acquire_embedding(void);
+
+// Drop a reference; the last one destroys the engine
+void model_manager_release_embedding(EmbeddingEngine *engine);
+
+// Shared CLIP engine; pair with model_manager_release_clip
+CLIPEngine* model_manager_acquire_clip(void);
+
+// Drop a reference; the last one destroys the engine
+void model_manager_release_clip(CLIPEngine *engine);
+
+// Shared local instruct model (NULL if it cannot be created); pair with
+// model_manager_release_llm. is_available tells whether its model exists and is built in
+LocalLLM* model_manager_acquire_llm(void);
+
+// Drop a reference; the last one destroys the engine
+void model_manager_release_llm(LocalLLM *engine);
+
+// Unload models unused for idle_sec (0 = every model not mid-inference); returns how many
+int model_manager_trim(double idle_sec);
+
+#endif // MODEL_MANAGER_H
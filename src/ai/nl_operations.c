@@ -2,6 +2,8 @@
 #include "../api/claude_client.h"
 #include "../tools/tool_registry.h"
 #include "../tools/tool_executor.h"
+#include "../core/undo_log.h"
+#include "intent_match.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -43,7 +45,9 @@ NLOperationType nl_get_operation_type(const char *tool_name)
     if (strcmp(tool_name, "file_create") == 0) return NL_OP_FILE_CREATE;
     if (strcmp(tool_name, "batch_rename") == 0) return NL_OP_BATCH_RENAME;
     if (strcmp(tool_name, "batch_move") == 0) return NL_OP_BATCH_MOVE;
+    if (strcmp(tool_name, "bulk_operation") == 0) return NL_OP_BATCH_MOVE;
     if (strcmp(tool_name, "file_search") == 0) return NL_OP_SEARCH;
+    if (strcmp(tool_name, "content_search") == 0) return NL_OP_SEARCH;
     if (strcmp(tool_name, "semantic_search") == 0) return NL_OP_SEARCH;
     if (strcmp(tool_name, "organize") == 0) return NL_OP_ORGANIZE;
     if (strcmp(tool_name, "find_duplicates") == 0) return NL_OP_FIND_DUPLICATES;
@@ -128,6 +132,57 @@ const char *nl_status_message(NLOperationStatus status)
     }
 }
 
+// Helper: Set up operation index of a chain to call tool name (name_len bytes)
+static void init_operation(NLOperation *op, int index, const char *name, size_t name_len)
+{
+    memset(op, 0, sizeof(NLOperation));
+    memcpy(op->tool_name, name, name_len);
+
+    op->type = nl_get_operation_type(op->tool_name);
+    op->risk = nl_get_risk_level(op->type);
+    op->requires_confirmation = (op->risk >= NL_RISK_MEDIUM);
+
+    // Generate description
+    snprintf(op->description, sizeof(op->description), "%s operation",
+             nl_operation_type_name(op->type));
+
+    // Generate unique ID
+    snprintf(op->tool_id, sizeof(op->tool_id), "op_%d_%ld", index, time(NULL));
+}
+
+// Helper: Overall risk of a parsed chain
+static void finish_chain(NLOperationChain *chain)
+{
+    chain->overall_risk = NL_RISK_NONE;
+    for (int i = 0; i < chain->count; i++) {
+        if (chain->operations[i].risk > chain->overall_risk) {
+            chain->overall_risk = chain->operations[i].risk;
+        }
+    }
+}
+
+// Helper: Fill chain from the learned calls for command; false if there are none
+static bool parse_from_intents(const char *command, const NLOperationsConfig *config, NLOperationChain *chain)
+{
+    IntentMatch *match = malloc(sizeof(IntentMatch));
+    bool found = match && intent_match(config->intents, command, config->current_directory, match) &&
+                 match->kind == INTENT_TOOLS && match->call_count <= NL_MAX_OPERATIONS;
+    for (int i = 0; found && i < match->call_count; i++) {
+        NLOperation *op = &chain->operations[i];
+        size_t name_len = strlen(match->calls[i].name);
+        if (name_len >= sizeof(op->tool_name)) name_len = sizeof(op->tool_name) - 1;
+        init_operation(op, i, match->calls[i].name, name_len);
+        snprintf(op->input_json, sizeof(op->input_json), "%s", match->calls[i].input_json);
+    }
+    if (found) {
+        chain->count = match->call_count;
+        snprintf(chain->ai_interpretation, sizeof(chain->ai_interpretation), "Ran before in this folder");
+        finish_chain(chain);
+    }
+    free(match);
+    return found;
+}
+
 // Parse tool use from Claude response
 static int parse_tool_uses(const char *response, NLOperationChain *chain, int max_ops)
 {
@@ -150,15 +205,9 @@ static int parse_tool_uses(const char *response, NLOperationChain *chain, int ma
         if (!name_end) break;
 
         NLOperation *op = &chain->operations[count];
-        memset(op, 0, sizeof(NLOperation));
-
         size_t name_len = name_end - name_start;
         if (name_len >= sizeof(op->tool_name)) name_len = sizeof(op->tool_name) - 1;
-        strncpy(op->tool_name, name_start, name_len);
-
-        op->type = nl_get_operation_type(op->tool_name);
-        op->risk = nl_get_risk_level(op->type);
-        op->requires_confirmation = (op->risk >= NL_RISK_MEDIUM);
+        init_operation(op, count, name_start, name_len);
 
         // Look for input JSON
         const char *input_start = strstr(name_end, "\"input\"");
@@ -180,13 +229,6 @@ static int parse_tool_uses(const char *response, NLOperationChain *chain, int ma
             }
         }
 
-        // Generate description
-        snprintf(op->description, sizeof(op->description), "%s operation",
-                 nl_operation_type_name(op->type));
-
-        // Generate unique ID
-        snprintf(op->tool_id, sizeof(op->tool_id), "op_%d_%ld", count, time(NULL));
-
         count++;
         p = name_end;
     }
@@ -206,6 +248,12 @@ NLOperationStatus nl_parse_command(const char *command,
     memset(chain, 0, sizeof(NLOperationChain));
     strncpy(chain->original_command, command, sizeof(chain->original_command) - 1);
 
+    // Commands run before need no round trip
+    if (config->intents && parse_from_intents(command, config, chain)) {
+        chain->status = NL_STATUS_OK;
+        return NL_STATUS_OK;
+    }
+
     // Check for API key
     if (strlen(config->api_key) == 0) {
         chain->status = NL_STATUS_API_ERROR;
@@ -234,6 +282,7 @@ NLOperationStatus nl_parse_command(const char *command,
         "- batch_rename: Rename multiple files (params: files, pattern)\n"
         "- batch_move: Move multiple files (params: files, destination)\n"
         "- file_search: Search for files (params: query, path)\n"
+        "- content_search: Search text inside files (params: path, pattern, regex)\n"
         "- organize: Organize files (params: path, categories)\n"
         "- find_duplicates: Find duplicate files (params: path)\n"
         "- summarize: Summarize file contents (params: path)\n\n"
@@ -246,6 +295,7 @@ NLOperationStatus nl_parse_command(const char *command,
     ClaudeMessageResponse resp;
     claude_request_init(&req);
     claude_response_init(&resp);
+    claude_request_set_feature(&req, CLAUDE_FEATURE_NL_OPERATIONS);
 
     claude_request_set_system_prompt(&req, system_prompt);
     claude_request_add_user_message(&req, command);
@@ -265,13 +315,7 @@ NLOperationStatus nl_parse_command(const char *command,
         if (chain->count == 0) {
             status = NL_STATUS_NO_OPERATIONS;
         } else {
-            // Calculate overall risk
-            chain->overall_risk = NL_RISK_NONE;
-            for (int i = 0; i < chain->count; i++) {
-                if (chain->operations[i].risk > chain->overall_risk) {
-                    chain->overall_risk = chain->operations[i].risk;
-                }
-            }
+            finish_chain(chain);
         }
     } else {
         status = NL_STATUS_API_ERROR;
@@ -445,6 +489,31 @@ bool nl_create_reverse_operation(const NLOperation *op, NLUndoEntry *undo)
     return undo->can_undo;
 }
 
+// Helper: Store a tool result on its operation, recording undo information on success
+static void nl_record_result(NLOperation *op, const ToolResult *result, const NLOperationsConfig *config,
+                             NLUndoHistory *undo_history, uint64_t undo_group)
+{
+    op->executed = true;
+    op->success = result->success;
+
+    if (result->success) {
+        strncpy(op->result, result->output ? result->output : "Success",
+                sizeof(op->result) - 1);
+
+        // Add to undo history if enabled
+        if (config->enable_undo && undo_history) {
+            NLUndoEntry undo;
+            if (nl_create_reverse_operation(op, &undo) && undo_group != 0) {
+                undo.undo_group = undo_group;
+                add_to_undo_history(undo_history, &undo);
+            }
+        }
+    } else {
+        strncpy(op->error, result->error ? result->error : "Unknown error",
+                sizeof(op->error) - 1);
+    }
+}
+
 // Execute single operation
 NLOperationStatus nl_execute_operation(NLOperation *op,
                                         const NLOperationsConfig *config,
@@ -472,35 +541,69 @@ NLOperationStatus nl_execute_operation(NLOperation *op,
 
     tool_executor_set_cwd(executor, config->current_directory);
 
+    // Everything the tool does is undone together
+    UndoLog *undo = undo_log_shared();
+    uint64_t undo_group = 0;
+    if (config->enable_undo && undo_history && !tool_executor_is_read_only(op->tool_name)) {
+        undo_group = undo_log_begin(undo, UNDO_SOURCE_NL, op->description);
+        tool_executor_set_undo_group(executor, undo_group);
+    }
+
     // Execute the tool
     ToolResult result = tool_executor_execute(executor, op->tool_name, op->input_json);
+    undo_log_end(undo, undo_group);
+    nl_record_result(op, &result, config, undo_history, undo_group);
 
-    op->executed = true;
-    op->success = result.success;
+    // Cleanup
+    tool_result_cleanup(&result);
+    tool_executor_destroy(executor);
+    tool_registry_destroy(registry);
 
-    if (result.success) {
-        strncpy(op->result, result.output ? result.output : "Success",
-                sizeof(op->result) - 1);
+    return op->success ? NL_STATUS_OK : NL_STATUS_EXECUTION_ERROR;
+}
 
-        // Add to undo history if enabled
-        if (config->enable_undo && undo_history) {
-            NLUndoEntry undo;
-            if (nl_create_reverse_operation(op, &undo)) {
-                add_to_undo_history(undo_history, &undo);
-            }
+// Helper: Execute consecutive read-only operations side by side, stopping the chain at the
+// first one (in order) that failed
+static NLOperationStatus nl_execute_reads(NLOperation *ops, int count, const NLOperationsConfig *config)
+{
+    ToolRegistry *registry = tool_registry_create();
+    if (!registry) return NL_STATUS_EXECUTION_ERROR;
+    tool_registry_register_file_tools(registry);
+
+    ToolExecutor *executor = tool_executor_create(registry);
+    if (!executor) {
+        tool_registry_destroy(registry);
+        return NL_STATUS_EXECUTION_ERROR;
+    }
+    tool_executor_set_cwd(executor, config->current_directory);
+
+    ToolCall calls[NL_MAX_OPERATIONS];
+    for (int i = 0; i < count; i++) {
+        calls[i].tool_name = ops[i].tool_name;
+        calls[i].input_json = ops[i].input_json;
+        tool_result_init(&calls[i].result);
+    }
+    tool_executor_execute_batch(executor, calls, count);
+
+    // Reads leave nothing to undo
+    NLOperationStatus status = NL_STATUS_OK;
+    for (int i = 0; i < count; i++) {
+        nl_record_result(&ops[i], &calls[i].result, config, NULL, 0);
+        tool_result_cleanup(&calls[i].result);
+        if (!ops[i].success && status == NL_STATUS_OK) {
+            status = NL_STATUS_EXECUTION_ERROR;
         }
-    } else {
-        strncpy(op->error, result.error ? result.error : "Unknown error",
-                sizeof(op->error) - 1);
     }
 
-    // Cleanup
-    if (result.output) free(result.output);
-    if (result.error) free(result.error);
     tool_executor_destroy(executor);
     tool_registry_destroy(registry);
+    return status;
+}
 
-    return op->success ? NL_STATUS_OK : NL_STATUS_EXECUTION_ERROR;
+// Helper: Whether an operation can join a parallel run of reads
+static bool nl_is_parallel_read(const NLOperation *op)
+{
+    return tool_executor_is_read_only(op->tool_name) && !(op->requires_confirmation && !op->confirmed);
 }
 
 // Execute operation chain
@@ -545,6 +648,26 @@ NLOperationStatus nl_execute_chain(NLOperationChain *chain,
             }
         }
 
+        // Reads that follow each other run together; the rest run one at a time
+        int run = 1;
+        while (nl_is_parallel_read(op) && i + run < chain->count &&
+               nl_is_parallel_read(&chain->operations[i + run])) {
+            if (progress) {
+                progress(i + run, chain->count, chain->operations[i + run].description, user_data);
+            }
+            run++;
+        }
+        if (run > 1) {
+            NLOperationStatus status = nl_execute_reads(op, run, config);
+            i += run - 1;
+            chain->current_index = i;
+            if (status != NL_STATUS_OK) {
+                overall_status = status;
+                break;
+            }
+            continue;
+        }
+
         // Execute operation
         NLOperationStatus status = nl_execute_operation(op, config, undo_history);
         if (status != NL_STATUS_OK) {
@@ -555,6 +678,24 @@ NLOperationStatus nl_execute_chain(NLOperationChain *chain,
         }
     }
 
+    // Remember what the command turned into, once all of it ran
+    bool all_ran = overall_status == NL_STATUS_OK;
+    for (int i = 0; i < chain->count && all_ran; i++) {
+        all_ran = chain->operations[i].executed && chain->operations[i].success;
+    }
+    if (all_ran && config->intents && chain->count <= INTENT_MAX_CALLS) {
+        IntentCall *calls = calloc((size_t)chain->count, sizeof(IntentCall));
+        for (int i = 0; calls && i < chain->count; i++) {
+            snprintf(calls[i].name, sizeof(calls[i].name), "%s", chain->operations[i].tool_name);
+            snprintf(calls[i].input_json, sizeof(calls[i].input_json), "%s", chain->operations[i].input_json);
+        }
+        if (calls) {
+            intent_matcher_learn(config->intents, chain->original_command, config->current_directory,
+                                 calls, chain->count);
+        }
+        free(calls);
+    }
+
     chain->status = overall_status;
     return overall_status;
 }
@@ -570,9 +711,10 @@ bool nl_undo_last(NLUndoHistory *history)
 
     if (!entry->can_undo) return false;
 
-    // Execute reverse operation
-    // This is simplified - real implementation would execute reverse_json
-    // For now, just mark as undone
+    UndoResult result;
+    if (!undo_log_undo(undo_log_shared(), entry->undo_group, &result)) {
+        return false;
+    }
     history->count--;
 
     return true;
@@ -588,8 +730,10 @@ bool nl_undo_operation(NLUndoHistory *history, int index)
 
     if (!entry->can_undo) return false;
 
-    // Execute reverse operation
-    // Simplified implementation
+    UndoResult result;
+    if (!undo_log_undo(undo_log_shared(), entry->undo_group, &result)) {
+        return false;
+    }
     entry->can_undo = false;
 
     return true;
@@ -6,6 +6,9 @@
 #include <stdint.h>
 #include <time.h>
 
+// Forward declaration
+struct IntentMatcher;
+
 // Maximum operations in a chain
 #define NL_MAX_OPERATIONS 16
 
@@ -80,11 +83,11 @@ typedef struct NLOperationChain {
     NLOperationStatus status;
 } NLOperationChain;
 
-// Undo entry
+// Undo entry: what the operation did is in its undo log group
 typedef struct NLUndoEntry {
     NLOperation operation;
     char reverse_action[256];
-    char reverse_json[4096];
+    uint64_t undo_group;
     time_t timestamp;
     bool can_undo;
 } NLUndoEntry;
@@ -115,6 +118,7 @@ typedef struct NLOperationsConfig {
     bool verbose_preview;
     int max_files_without_confirmation;
     char current_directory[1024];
+    struct IntentMatcher *intents;      // Commands run before resolve without Claude (optional)
 } NLOperationsConfig;
 
 // Progress callback
@@ -129,7 +133,9 @@ void nl_operations_config_init(NLOperationsConfig *config);
 // Initialize undo history
 void nl_undo_history_init(NLUndoHistory *history);
 
-// Parse natural language command into operation chain
+// Parse natural language command into operation chain. A command config->intents has
+// learned (in the same folder) is answered from it; a chain that runs through
+// nl_execute_chain without failing is learned
 NLOperationStatus nl_parse_command(const char *command,
                                     const NLOperationsConfig *config,
                                     NLOperationChain *chain);
@@ -157,7 +163,7 @@ NLOperationStatus nl_execute_operation(NLOperation *op,
                                         const NLOperationsConfig *config,
                                         NLUndoHistory *undo_history);
 
-// Undo last operation
+// Undo last operation from the undo log; it stays in the history if that fails
 bool nl_undo_last(NLUndoHistory *history);
 
 // Undo specific operation (by index from head)
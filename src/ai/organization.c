@@ -1,5 +1,11 @@
 #include "organization.h"
 #include "../api/claude_client.h"
+#include "../core/move_batch.h"
+#include "../core/operation_queue.h"
+#include "../core/stat_cache.h"
+#include "../core/undo_log.h"
+#include "../utils/file_type.h"
+#include "../../external/cJSON/cJSON.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,127 +14,30 @@
 #include <time.h>
 #include <ctype.h>
 #include <errno.h>
-
-// Undo history
-static struct {
-    char original_paths[1000][1024];
-    char new_paths[1000][1024];
-    int count;
-    bool valid;
-} org_undo_history = {0};
-
-// File extension to category mapping
-typedef struct ExtMapping {
-    const char *ext;
-    FileCategory category;
-    const char *subcategory;
-} ExtMapping;
-
-static const ExtMapping EXT_MAP[] = {
-    // Documents
-    {".pdf", CAT_DOCUMENTS, "PDFs"},
-    {".doc", CAT_DOCUMENTS, "Word Documents"},
-    {".docx", CAT_DOCUMENTS, "Word Documents"},
-    {".txt", CAT_DOCUMENTS, "Text Files"},
-    {".rtf", CAT_DOCUMENTS, "Text Files"},
-    {".md", CAT_DOCUMENTS, "Markdown"},
-    {".odt", CAT_DOCUMENTS, "Documents"},
-    {".pages", CAT_DOCUMENTS, "Documents"},
-    {".xls", CAT_DOCUMENTS, "Spreadsheets"},
-    {".xlsx", CAT_DOCUMENTS, "Spreadsheets"},
-    {".csv", CAT_DATA, "Data Files"},
-    {".ppt", CAT_DOCUMENTS, "Presentations"},
-    {".pptx", CAT_DOCUMENTS, "Presentations"},
-    {".key", CAT_DOCUMENTS, "Presentations"},
-
-    // Images
-    {".jpg", CAT_IMAGES, "Photos"},
-    {".jpeg", CAT_IMAGES, "Photos"},
-    {".png", CAT_IMAGES, "Images"},
-    {".gif", CAT_IMAGES, "GIFs"},
-    {".bmp", CAT_IMAGES, "Images"},
-    {".webp", CAT_IMAGES, "Images"},
-    {".svg", CAT_IMAGES, "Vector Graphics"},
-    {".ico", CAT_IMAGES, "Icons"},
-    {".heic", CAT_IMAGES, "Photos"},
-    {".raw", CAT_IMAGES, "RAW Photos"},
-    {".psd", CAT_IMAGES, "Design Files"},
-    {".ai", CAT_IMAGES, "Design Files"},
-    {".sketch", CAT_IMAGES, "Design Files"},
-    {".fig", CAT_IMAGES, "Design Files"},
-
-    // Videos
-    {".mp4", CAT_VIDEOS, "Videos"},
-    {".mov", CAT_VIDEOS, "Videos"},
-    {".avi", CAT_VIDEOS, "Videos"},
-    {".mkv", CAT_VIDEOS, "Videos"},
-    {".wmv", CAT_VIDEOS, "Videos"},
-    {".webm", CAT_VIDEOS, "Videos"},
-    {".m4v", CAT_VIDEOS, "Videos"},
-
-    // Audio
-    {".mp3", CAT_AUDIO, "Music"},
-    {".wav", CAT_AUDIO, "Audio"},
-    {".flac", CAT_AUDIO, "Music"},
-    {".aac", CAT_AUDIO, "Audio"},
-    {".m4a", CAT_AUDIO, "Audio"},
-    {".ogg", CAT_AUDIO, "Audio"},
-    {".wma", CAT_AUDIO, "Audio"},
-
-    // Archives
-    {".zip", CAT_ARCHIVES, "Archives"},
-    {".rar", CAT_ARCHIVES, "Archives"},
-    {".7z", CAT_ARCHIVES, "Archives"},
-    {".tar", CAT_ARCHIVES, "Archives"},
-    {".gz", CAT_ARCHIVES, "Archives"},
-    {".bz2", CAT_ARCHIVES, "Archives"},
-    {".dmg", CAT_APPLICATIONS, "Installers"},
-    {".pkg", CAT_APPLICATIONS, "Installers"},
-    {".iso", CAT_ARCHIVES, "Disk Images"},
-
-    // Code
-    {".c", CAT_CODE, "C"},
-    {".h", CAT_CODE, "C"},
-    {".cpp", CAT_CODE, "C++"},
-    {".hpp", CAT_CODE, "C++"},
-    {".py", CAT_CODE, "Python"},
-    {".js", CAT_CODE, "JavaScript"},
-    {".ts", CAT_CODE, "TypeScript"},
-    {".java", CAT_CODE, "Java"},
-    {".go", CAT_CODE, "Go"},
-    {".rs", CAT_CODE, "Rust"},
-    {".rb", CAT_CODE, "Ruby"},
-    {".php", CAT_CODE, "PHP"},
-    {".swift", CAT_CODE, "Swift"},
-    {".kt", CAT_CODE, "Kotlin"},
-    {".html", CAT_CODE, "Web"},
-    {".css", CAT_CODE, "Web"},
-    {".scss", CAT_CODE, "Web"},
-    {".vue", CAT_CODE, "Web"},
-    {".jsx", CAT_CODE, "React"},
-    {".tsx", CAT_CODE, "React"},
-
-    // Data
-    {".json", CAT_DATA, "JSON"},
-    {".xml", CAT_DATA, "XML"},
-    {".yaml", CAT_DATA, "Config"},
-    {".yml", CAT_DATA, "Config"},
-    {".toml", CAT_DATA, "Config"},
-    {".sql", CAT_DATA, "Database"},
-    {".db", CAT_DATA, "Database"},
-    {".sqlite", CAT_DATA, "Database"},
-
-    // Fonts
-    {".ttf", CAT_FONTS, "Fonts"},
-    {".otf", CAT_FONTS, "Fonts"},
-    {".woff", CAT_FONTS, "Web Fonts"},
-    {".woff2", CAT_FONTS, "Web Fonts"},
-
-    // Applications
-    {".app", CAT_APPLICATIONS, "Applications"},
-    {".exe", CAT_APPLICATIONS, "Executables"},
-
-    {NULL, CAT_OTHER, NULL}
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Journal of the last organization's moves, for undo
+#define ORG_JOURNAL_NAME "organize.journal"
+
+// Categories by file type class; subcategories are the file type's group
+static const FileCategory CATEGORIES[FILE_CLASS_COUNT] = {
+    [FILE_CLASS_NONE] = CAT_OTHER,
+    [FILE_CLASS_TEXT] = CAT_DOCUMENTS,
+    [FILE_CLASS_MARKDOWN] = CAT_DOCUMENTS,
+    [FILE_CLASS_CODE] = CAT_CODE,
+    [FILE_CLASS_DATA] = CAT_DATA,
+    [FILE_CLASS_DOCUMENT] = CAT_DOCUMENTS,
+    [FILE_CLASS_SPREADSHEET] = CAT_DOCUMENTS,
+    [FILE_CLASS_PRESENTATION] = CAT_DOCUMENTS,
+    [FILE_CLASS_IMAGE] = CAT_IMAGES,
+    [FILE_CLASS_VIDEO] = CAT_VIDEOS,
+    [FILE_CLASS_AUDIO] = CAT_AUDIO,
+    [FILE_CLASS_ARCHIVE] = CAT_ARCHIVES,
+    [FILE_CLASS_INSTALLER] = CAT_APPLICATIONS,
+    [FILE_CLASS_DATABASE] = CAT_DATA,
+    [FILE_CLASS_FONT] = CAT_FONTS,
+    [FILE_CLASS_APPLICATION] = CAT_APPLICATIONS,
 };
 
 // Initialize default configuration
@@ -171,20 +80,9 @@ void organization_analysis_free(OrganizationAnalysis *analysis)
 // Get category from file extension
 static FileCategory get_category_from_extension(const char *ext, const char **subcategory)
 {
-    if (!ext) {
-        if (subcategory) *subcategory = "Other";
-        return CAT_OTHER;
-    }
-
-    for (int i = 0; EXT_MAP[i].ext; i++) {
-        if (strcasecmp(ext, EXT_MAP[i].ext) == 0) {
-            if (subcategory) *subcategory = EXT_MAP[i].subcategory;
-            return EXT_MAP[i].category;
-        }
-    }
-
-    if (subcategory) *subcategory = "Other";
-    return CAT_OTHER;
+    const FileTypeInfo *info = file_type_info(file_type_from_extension(ext));
+    if (subcategory) *subcategory = info->group;
+    return CATEGORIES[info->type_class];
 }
 
 // Get category name
@@ -218,104 +116,125 @@ static bool is_screenshot(const char *name)
     return false;
 }
 
-// Add file to analysis
-static bool add_file_to_analysis(OrganizationAnalysis *analysis, const char *path,
-                                  const struct stat *st, const OrganizationConfig *config)
+// Helper: a file's category stats, created on first use (NULL when all are taken)
+static CategoryStats *find_category(OrganizationAnalysis *analysis, FileCategory category)
 {
-    if (analysis->file_count >= analysis->file_capacity) {
-        int new_capacity = analysis->file_capacity * 2;
-        if (new_capacity > ORG_MAX_FILES_PER_CATEGORY * ORG_MAX_CATEGORIES) {
-            return false;
+    for (int i = 0; i < analysis->category_count; i++) {
+        if (analysis->categories[i].category == category) {
+            return &analysis->categories[i];
         }
-        OrganizedFile *new_files = realloc(analysis->files, new_capacity * sizeof(OrganizedFile));
-        if (!new_files) return false;
-        analysis->files = new_files;
-        analysis->file_capacity = new_capacity;
+    }
+    if (analysis->category_count >= ORG_MAX_CATEGORIES) {
+        return NULL;
     }
 
-    OrganizedFile *file = &analysis->files[analysis->file_count];
-    memset(file, 0, sizeof(OrganizedFile));
+    CategoryStats *stats = &analysis->categories[analysis->category_count++];
+    memset(stats, 0, sizeof(CategoryStats));
+    stats->category = category;
+    strncpy(stats->name, organization_category_name(category), sizeof(stats->name) - 1);
+    return stats;
+}
 
-    strncpy(file->path, path, sizeof(file->path) - 1);
+// Helper: index of a subcategory within its category, created on first use (-1 when all
+// are taken)
+static int find_subcategory(CategoryStats *stats, const char *name)
+{
+    for (int i = 0; i < stats->subcategory_count; i++) {
+        if (strcmp(stats->subcategories[i].name, name) == 0) {
+            return i;
+        }
+    }
+    if (stats->subcategory_count >= ORG_MAX_SUBCATEGORIES) {
+        return -1;
+    }
+
+    SubCategory *sub = &stats->subcategories[stats->subcategory_count];
+    memset(sub, 0, sizeof(SubCategory));
+    strncpy(sub->name, name, sizeof(sub->name) - 1);
+    snprintf(sub->folder_name, sizeof(sub->folder_name), "%s", name);
+    return stats->subcategory_count++;
+}
 
-    // Extract filename
+// Add file to analysis: counted in the statistics always, listed while there is room
+static void add_file_to_analysis(OrganizationAnalysis *analysis, const char *path,
+                                 uint64_t size, time_t modified, time_t now,
+                                 const OrganizationConfig *config)
+{
     const char *name = strrchr(path, '/');
     name = name ? name + 1 : path;
-    strncpy(file->name, name, sizeof(file->name) - 1);
-
-    file->size = st->st_size;
 
     // Categorize
     const char *ext = strrchr(name, '.');
     const char *subcategory = NULL;
-    file->category = get_category_from_extension(ext, &subcategory);
+    FileCategory category = get_category_from_extension(ext, &subcategory);
 
     // Special case: screenshots
-    if (file->category == CAT_IMAGES && is_screenshot(name)) {
+    if (category == CAT_IMAGES && is_screenshot(name)) {
         subcategory = "Screenshots";
     }
 
     // Check if old
-    time_t now = time(NULL);
-    int days_old = (now - st->st_mtime) / (24 * 3600);
-    file->is_old = (days_old > config->old_file_days);
+    int days_old = (int)((now - modified) / (24 * 3600));
+    bool is_old = days_old > config->old_file_days;
 
-    // Build suggested folder
-    if (config->create_subfolders && subcategory) {
-        snprintf(file->suggested_folder, sizeof(file->suggested_folder),
-                 "%s/%s", organization_category_name(file->category), subcategory);
-    } else {
-        strncpy(file->suggested_folder, organization_category_name(file->category),
-                sizeof(file->suggested_folder) - 1);
-    }
-
-    file->should_move = true;
-    analysis->file_count++;
-    analysis->total_size += st->st_size;
+    analysis->total_size += size;
     analysis->total_files++;
-
-    if (file->is_old) {
+    if (is_old) {
         analysis->old_file_count++;
-        analysis->old_file_size += st->st_size;
+        analysis->old_file_size += size;
     }
 
-    return true;
-}
-
-// Update category statistics
-static void update_category_stats(OrganizationAnalysis *analysis)
-{
-    // Reset stats
-    for (int i = 0; i < ORG_MAX_CATEGORIES; i++) {
-        memset(&analysis->categories[i], 0, sizeof(CategoryStats));
-    }
-    analysis->category_count = 0;
-
-    // Aggregate by category
-    for (int i = 0; i < analysis->file_count; i++) {
-        OrganizedFile *file = &analysis->files[i];
-        FileCategory cat = file->category;
-
-        // Find or create category stats
-        CategoryStats *stats = NULL;
-        for (int j = 0; j < analysis->category_count; j++) {
-            if (analysis->categories[j].category == cat) {
-                stats = &analysis->categories[j];
-                break;
+    int subcategory_index = -1;
+    CategoryStats *stats = find_category(analysis, category);
+    if (stats) {
+        stats->file_count++;
+        stats->total_size += size;
+        subcategory_index = find_subcategory(stats, subcategory);
+        if (subcategory_index >= 0) {
+            SubCategory *sub = &stats->subcategories[subcategory_index];
+            sub->file_count++;
+            sub->total_size += size;
+            if (sub->sample_count < ORG_SUBCATEGORY_SAMPLES) {
+                strncpy(sub->samples[sub->sample_count], name, sizeof(sub->samples[0]) - 1);
+                sub->samples[sub->sample_count][sizeof(sub->samples[0]) - 1] = '\0';
+                sub->sample_count++;
             }
         }
+    }
 
-        if (!stats && analysis->category_count < ORG_MAX_CATEGORIES) {
-            stats = &analysis->categories[analysis->category_count++];
-            stats->category = cat;
-            strncpy(stats->name, organization_category_name(cat), sizeof(stats->name) - 1);
+    if (analysis->file_count >= analysis->file_capacity) {
+        int new_capacity = analysis->file_capacity * 2;
+        if (new_capacity > ORG_MAX_FILES) {
+            new_capacity = ORG_MAX_FILES;
         }
-
-        if (stats) {
-            stats->file_count++;
-            stats->total_size += file->size;
+        OrganizedFile *new_files = new_capacity > analysis->file_capacity
+            ? realloc(analysis->files, new_capacity * sizeof(OrganizedFile)) : NULL;
+        if (!new_files) {
+            analysis->files_truncated = true;
+            return;
         }
+        analysis->files = new_files;
+        analysis->file_capacity = new_capacity;
+    }
+
+    OrganizedFile *file = &analysis->files[analysis->file_count++];
+    memset(file, 0, sizeof(OrganizedFile));
+    strncpy(file->path, path, sizeof(file->path) - 1);
+    strncpy(file->name, name, sizeof(file->name) - 1);
+    file->size = size;
+    file->category = category;
+    file->subcategory_index = subcategory_index;
+    file->is_old = is_old;
+
+    // Build suggested folder
+    if (config->create_subfolders && subcategory) {
+        snprintf(file->suggested_folder, sizeof(file->suggested_folder),
+                 "%s/%s", organization_category_name(category), subcategory);
+    } else {
+        strncpy(file->suggested_folder, organization_category_name(category),
+                sizeof(file->suggested_folder) - 1);
     }
+    file->should_move = true;
 }
 
 // Generate suggested folders
@@ -353,76 +272,272 @@ static void generate_suggested_folders(OrganizationAnalysis *analysis)
             snprintf(full_path, sizeof(full_path), "%s/%s",
                      analysis->source_path, file->suggested_folder);
             struct stat st;
-            folder->exists = (stat(full_path, &st) == 0);
+            folder->exists = stat_cache_stat(full_path, &st);
         }
     }
 }
 
-// Analyze directory
-OrganizationStatus organization_analyze(const char *path,
-                                         const OrganizationConfig *config,
-                                         OrganizationProgressCallback progress,
-                                         void *user_data,
-                                         OrganizationAnalysis *result)
+// Parallel scan
+
+// Directory waiting to be read
+typedef struct ScanDir {
+    char *path;
+    int depth;
+} ScanDir;
+
+// File read by a worker, not yet merged into the analysis
+typedef struct ScanFile {
+    char path[1024];
+    uint64_t size;
+    time_t modified;
+} ScanFile;
+
+// State shared by the threads of one scan; everything below mutex is guarded by it
+typedef struct ScanShared {
+    const OrganizationConfig *config;
+    OrganizationProgressCallback progress;
+    void *user_data;
+    const atomic_bool *cancel;  // NULL: runs to the end
+    time_t now;
+
+    pthread_mutex_t *mutex;     // Also taken by organization_scan_poll
+    pthread_cond_t work;        // Directory pushed, or the scan is over
+    OrganizationAnalysis *result;
+    ScanDir *dirs;              // Stack, so the walk goes depth first and stays short
+    int dir_count;
+    int dir_capacity;
+    int active;                 // Threads reading a directory
+    bool failed;                // Out of memory: part of the tree was not read
+} ScanShared;
+
+// A thread's files and subdirectories since its last merge
+typedef struct ScanBatch {
+    ScanFile *files;
+    int file_count;
+    ScanDir *dirs;
+    int dir_count;
+    int dir_capacity;
+} ScanBatch;
+
+// Helper: whether the scan was asked to stop
+static bool scan_cancelled(const ScanShared *scan)
 {
-    if (!path || !config || !result) {
-        return ORG_STATUS_NOT_INITIALIZED;
+    return scan->cancel && atomic_load(scan->cancel);
+}
+
+// Helper: whether a name matches an exclude pattern
+static bool scan_excluded(const OrganizationConfig *config, const char *name)
+{
+    for (int i = 0; config->exclude_patterns && i < config->exclude_count; i++) {
+        if (strstr(name, config->exclude_patterns[i])) {
+            return true;
+        }
     }
+    return false;
+}
 
-    clock_t start = clock();
+// Helper: queue a directory (call with mutex held)
+static bool scan_push_dir(ScanShared *scan, char *path, int depth)
+{
+    if (scan->dir_count == scan->dir_capacity) {
+        int capacity = scan->dir_capacity ? scan->dir_capacity * 2 : 64;
+        ScanDir *dirs = realloc(scan->dirs, capacity * sizeof(ScanDir));
+        if (!dirs) {
+            scan->failed = true;
+            return false;
+        }
+        scan->dirs = dirs;
+        scan->dir_capacity = capacity;
+    }
+    scan->dirs[scan->dir_count++] = (ScanDir){ path, depth };
+    pthread_cond_signal(&scan->work);
+    return true;
+}
 
-    strncpy(result->source_path, path, sizeof(result->source_path) - 1);
+// Helper: merge a thread's batch into the analysis and hand its subdirectories to
+// whichever thread is free
+static void scan_merge(ScanShared *scan, ScanBatch *batch)
+{
+    pthread_mutex_lock(scan->mutex);
+    for (int i = 0; i < batch->dir_count; i++) {
+        if (!scan_push_dir(scan, batch->dirs[i].path, batch->dirs[i].depth)) {
+            free(batch->dirs[i].path);
+        }
+    }
+    for (int i = 0; i < batch->file_count; i++) {
+        const ScanFile *file = &batch->files[i];
+        add_file_to_analysis(scan->result, file->path, file->size, file->modified, scan->now, scan->config);
+    }
+    if (scan->progress && batch->file_count > 0) {
+        const char *name = strrchr(batch->files[batch->file_count - 1].path, '/');
+        scan->progress(scan->result->total_files, scan->result->total_files,
+                       name ? name + 1 : batch->files[batch->file_count - 1].path, scan->user_data);
+    }
+    pthread_mutex_unlock(scan->mutex);
 
-    DIR *dir = opendir(path);
-    if (!dir) return ORG_STATUS_FILE_ERROR;
+    batch->file_count = 0;
+    batch->dir_count = 0;
+}
 
-    // First pass: count files
-    int total_files = 0;
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_name[0] == '.') continue;
-        if (entry->d_type == DT_REG) total_files++;
+// Helper: read one directory: regular files go to the batch, subdirectories to the queue
+static void scan_read_dir(ScanShared *scan, const ScanDir *dir, ScanBatch *batch)
+{
+    DIR *handle = opendir(dir->path);
+    if (!handle) {
+        return;
     }
-    rewinddir(dir);
 
-    // Second pass: analyze files
-    int processed = 0;
-    while ((entry = readdir(dir)) != NULL) {
+    const OrganizationConfig *config = scan->config;
+    bool descend = config->recursive && dir->depth < ORG_SCAN_MAX_DEPTH;
+    struct dirent *entry;
+    while ((entry = readdir(handle)) != NULL && !scan_cancelled(scan)) {
         if (entry->d_name[0] == '.') continue;
+        if (scan_excluded(config, entry->d_name)) continue;
 
         char full_path[1024];
-        snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
+        int length = snprintf(full_path, sizeof(full_path), "%s/%s", dir->path, entry->d_name);
+        if (length < 0 || (size_t)length >= sizeof(full_path)) continue;
 
+        // Folders are known from the entry type, without a stat
+        bool is_dir = entry->d_type == DT_DIR;
         struct stat st;
-        if (lstat(full_path, &st) != 0) continue;
-
-        // Skip directories and symlinks for now
-        if (!S_ISREG(st.st_mode)) continue;
-
-        // Check exclusions
-        bool excluded = false;
-        if (config->exclude_patterns) {
-            for (int i = 0; i < config->exclude_count; i++) {
-                if (strstr(entry->d_name, config->exclude_patterns[i])) {
-                    excluded = true;
-                    break;
-                }
+        if (!is_dir) {
+            if (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN) continue;
+            if (!stat_cache_lstat(full_path, &st)) continue;
+            is_dir = S_ISDIR(st.st_mode);
+
+            // Skip symlinks and special files
+            if (!is_dir && !S_ISREG(st.st_mode)) continue;
+        }
+
+        if (is_dir) {
+            if (!descend) continue;
+            if (batch->dir_count == batch->dir_capacity) {
+                int capacity = batch->dir_capacity ? batch->dir_capacity * 2 : 16;
+                ScanDir *dirs = realloc(batch->dirs, capacity * sizeof(ScanDir));
+                if (!dirs) continue;
+                batch->dirs = dirs;
+                batch->dir_capacity = capacity;
             }
+            char *copy = strdup(full_path);
+            if (copy) {
+                batch->dirs[batch->dir_count++] = (ScanDir){ copy, dir->depth + 1 };
+            }
+            continue;
         }
-        if (excluded) continue;
 
-        add_file_to_analysis(result, full_path, &st, config);
+        ScanFile *file = &batch->files[batch->file_count++];
+        memcpy(file->path, full_path, (size_t)length + 1);
+        file->size = st.st_size;
+        file->modified = st.st_mtime;
+        if (batch->file_count == ORG_SCAN_BATCH) {
+            scan_merge(scan, batch);
+        }
+    }
+    closedir(handle);
 
-        processed++;
-        if (progress) {
-            progress(processed, total_files, entry->d_name, user_data);
+    scan_merge(scan, batch);
+}
+
+// Scan thread: read queued directories until none are left and no thread can add more
+static void *scan_worker(void *arg)
+{
+    ScanShared *scan = arg;
+    ScanBatch batch = {0};
+    batch.files = malloc(ORG_SCAN_BATCH * sizeof(ScanFile));
+
+    pthread_mutex_lock(scan->mutex);
+    if (!batch.files) {
+        scan->failed = true;
+    }
+    while (batch.files) {
+        while (scan->dir_count == 0 && scan->active > 0 && !scan_cancelled(scan)) {
+            pthread_cond_wait(&scan->work, scan->mutex);
         }
+        if (scan->dir_count == 0 || scan_cancelled(scan)) {
+            break;
+        }
+
+        ScanDir dir = scan->dirs[--scan->dir_count];
+        scan->active++;
+        scan->result->directories_scanned++;
+        pthread_mutex_unlock(scan->mutex);
+
+        scan_read_dir(scan, &dir, &batch);
+        free(dir.path);
+
+        pthread_mutex_lock(scan->mutex);
+        scan->active--;
     }
+    // Wake the others: either the tree is done or the scan is stopping
+    pthread_cond_broadcast(&scan->work);
+    pthread_mutex_unlock(scan->mutex);
+
+    free(batch.files);
+    free(batch.dirs);
+    return NULL;
+}
 
-    closedir(dir);
+// Helper: scan a tree into result, on the calling thread and (if recursive) helpers;
+// mutex guards result while it runs
+static OrganizationStatus run_scan(const char *path, const OrganizationConfig *config,
+                                   OrganizationProgressCallback progress, void *user_data,
+                                   const atomic_bool *cancel, pthread_mutex_t *mutex,
+                                   OrganizationAnalysis *result)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
 
-    // Update statistics
-    update_category_stats(result);
+    struct stat st;
+    if (!stat_cache_stat(path, &st) || !S_ISDIR(st.st_mode)) {
+        return ORG_STATUS_FILE_ERROR;
+    }
+
+    ScanShared scan = {0};
+    scan.config = config;
+    scan.progress = progress;
+    scan.user_data = user_data;
+    scan.cancel = cancel;
+    scan.now = time(NULL);
+    scan.mutex = mutex;
+    scan.result = result;
+    pthread_cond_init(&scan.work, NULL);
+
+    pthread_mutex_lock(mutex);
+    strncpy(result->source_path, path, sizeof(result->source_path) - 1);
+    char *root = strdup(path);
+    bool queued = root && scan_push_dir(&scan, root, 0);
+    pthread_mutex_unlock(mutex);
+    if (!queued) {
+        free(root);
+        pthread_cond_destroy(&scan.work);
+        return ORG_STATUS_MEMORY_ERROR;
+    }
+
+    // One folder needs no helpers
+    pthread_t threads[ORG_SCAN_THREADS - 1];
+    int started = 0;
+    while (config->recursive && started < ORG_SCAN_THREADS - 1 &&
+           pthread_create(&threads[started], NULL, scan_worker, &scan) == 0) {
+        started++;
+    }
+    scan_worker(&scan);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Cancelled with folders still queued
+    for (int i = 0; i < scan.dir_count; i++) {
+        free(scan.dirs[i].path);
+    }
+    free(scan.dirs);
+    pthread_cond_destroy(&scan.work);
+
+    if (scan_cancelled(&scan)) {
+        return ORG_STATUS_CANCELLED;
+    }
+
+    pthread_mutex_lock(mutex);
 
     // Generate folder suggestions
     generate_suggested_folders(result);
@@ -431,11 +546,142 @@ OrganizationStatus organization_analyze(const char *path,
     result->suggested_cleanup_size = result->old_file_size + result->duplicate_size;
     result->suggested_cleanup_count = result->old_file_count + result->duplicate_count;
 
-    clock_t end = clock();
-    result->analysis_time_ms = (float)(end - start) / CLOCKS_PER_SEC * 1000.0f;
-    result->status = ORG_STATUS_OK;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result->analysis_time_ms = (float)((end.tv_sec - start.tv_sec) * 1000.0 +
+                                       (end.tv_nsec - start.tv_nsec) / 1000000.0);
+    result->status = scan.failed ? ORG_STATUS_MEMORY_ERROR : ORG_STATUS_OK;
+    OrganizationStatus status = result->status;
+    pthread_mutex_unlock(mutex);
+    return status;
+}
+
+// Analyze directory
+OrganizationStatus organization_analyze(const char *path,
+                                         const OrganizationConfig *config,
+                                         OrganizationProgressCallback progress,
+                                         void *user_data,
+                                         OrganizationAnalysis *result)
+{
+    if (!path || !config || !result) {
+        return ORG_STATUS_NOT_INITIALIZED;
+    }
+
+    pthread_mutex_t mutex;
+    pthread_mutex_init(&mutex, NULL);
+    OrganizationStatus status = run_scan(path, config, progress, user_data, NULL, &mutex, result);
+    pthread_mutex_destroy(&mutex);
+    return status;
+}
+
+// Background scan
+struct OrganizationScan {
+    pthread_t thread;
+    pthread_mutex_t mutex;      // Guards analysis while the scan runs
+    atomic_bool cancel;
+    atomic_bool done;
+    char path[1024];
+    OrganizationConfig config;
+    OrganizationAnalysis *analysis;
+    OrganizationStatus status;
+};
 
-    return ORG_STATUS_OK;
+static void *scan_thread(void *arg)
+{
+    OrganizationScan *scan = arg;
+    scan->status = run_scan(scan->path, &scan->config, NULL, NULL, &scan->cancel, &scan->mutex, scan->analysis);
+    atomic_store(&scan->done, true);
+    return NULL;
+}
+
+OrganizationScan *organization_scan_start(const char *path, const OrganizationConfig *config)
+{
+    if (!path || !config) return NULL;
+
+    OrganizationScan *scan = calloc(1, sizeof(OrganizationScan));
+    if (!scan) return NULL;
+
+    scan->analysis = organization_analysis_create();
+    if (!scan->analysis) {
+        free(scan);
+        return NULL;
+    }
+    strncpy(scan->path, path, sizeof(scan->path) - 1);
+    scan->config = *config;
+    atomic_init(&scan->cancel, false);
+    atomic_init(&scan->done, false);
+    pthread_mutex_init(&scan->mutex, NULL);
+
+    if (pthread_create(&scan->thread, NULL, scan_thread, scan) != 0) {
+        pthread_mutex_destroy(&scan->mutex);
+        organization_analysis_free(scan->analysis);
+        free(scan);
+        return NULL;
+    }
+    return scan;
+}
+
+bool organization_scan_poll(OrganizationScan *scan, OrganizationAnalysis *snapshot)
+{
+    if (!scan) return true;
+
+    if (snapshot) {
+        pthread_mutex_lock(&scan->mutex);
+        memcpy(snapshot, scan->analysis, sizeof(OrganizationAnalysis));
+        pthread_mutex_unlock(&scan->mutex);
+        snapshot->files = NULL;
+        snapshot->file_count = 0;
+        snapshot->file_capacity = 0;
+    }
+    return atomic_load(&scan->done);
+}
+
+void organization_scan_cancel(OrganizationScan *scan)
+{
+    if (scan) {
+        atomic_store(&scan->cancel, true);
+    }
+}
+
+OrganizationAnalysis *organization_scan_finish(OrganizationScan *scan, OrganizationStatus *status)
+{
+    if (!scan) {
+        if (status) *status = ORG_STATUS_NOT_INITIALIZED;
+        return NULL;
+    }
+
+    pthread_join(scan->thread, NULL);
+    pthread_mutex_destroy(&scan->mutex);
+
+    OrganizationAnalysis *analysis = scan->analysis;
+    if (scan->status != ORG_STATUS_OK) {
+        organization_analysis_free(analysis);
+        analysis = NULL;
+    }
+    if (status) *status = scan->status;
+    free(scan);
+    return analysis;
+}
+
+// Helper: the group a file falls in for the AI summary ("Images/Screenshots")
+static void file_group(const OrganizationAnalysis *analysis, const OrganizedFile *file, char *group, size_t size)
+{
+    const char *category = organization_category_name(file->category);
+    snprintf(group, size, "%s", category);
+    for (int i = 0; i < analysis->category_count; i++) {
+        const CategoryStats *stats = &analysis->categories[i];
+        if (stats->category == file->category && file->subcategory_index >= 0 &&
+            file->subcategory_index < stats->subcategory_count) {
+            snprintf(group, size, "%s/%s", category, stats->subcategories[file->subcategory_index].name);
+            return;
+        }
+    }
+}
+
+// Helper: whether a folder from the response stays inside the source folder
+static bool is_safe_folder(const char *folder)
+{
+    return folder[0] != '\0' && folder[0] != '/' && strstr(folder, "..") == NULL;
 }
 
 // Generate AI-powered organization suggestions
@@ -446,74 +692,98 @@ OrganizationStatus organization_ai_suggest(OrganizationAnalysis *analysis,
         return ORG_STATUS_NOT_INITIALIZED;
     }
 
-    // Build prompt for Claude
-    char prompt[8192];
-    char *p = prompt;
-    size_t remaining = sizeof(prompt);
+    // Build prompt for Claude: one line per group, however many files there are
+    int groups = 0;
+    for (int i = 0; i < analysis->category_count; i++) {
+        groups += analysis->categories[i].subcategory_count;
+    }
+    size_t size = 2048 + (size_t)groups * (160 + ORG_SUBCATEGORY_SAMPLES * 72);
+    char *prompt = malloc(size);
+    if (!prompt) return ORG_STATUS_MEMORY_ERROR;
 
+    char *p = prompt;
+    size_t remaining = size;
     int written = snprintf(p, remaining,
-        "Analyze this directory and suggest how to organize the files better.\n"
-        "Current files:\n");
+        "Suggest how to organize this folder.\n"
+        "%d files, %.1f MB in total; %d not modified in %d days.\n"
+        "Files by group (category/kind: count, size, examples):\n",
+        analysis->total_files, (double)analysis->total_size / (1024 * 1024),
+        analysis->old_file_count, config->old_file_days);
     p += written;
     remaining -= written;
 
-    // List files (limit to avoid token overflow)
-    int listed = 0;
-    for (int i = 0; i < analysis->file_count && listed < 50 && remaining > 256; i++) {
-        written = snprintf(p, remaining, "- %s (%llu bytes, category: %s)\n",
-                           analysis->files[i].name,
-                           (unsigned long long)analysis->files[i].size,
-                           organization_category_name(analysis->files[i].category));
-        p += written;
-        remaining -= written;
-        listed++;
+    for (int i = 0; i < analysis->category_count; i++) {
+        const CategoryStats *stats = &analysis->categories[i];
+        for (int j = 0; j < stats->subcategory_count && remaining > 512; j++) {
+            const SubCategory *sub = &stats->subcategories[j];
+            written = snprintf(p, remaining, "- %s/%s: %d files, %.1f MB, e.g.",
+                               stats->name, sub->name, sub->file_count,
+                               (double)sub->total_size / (1024 * 1024));
+            p += written;
+            remaining -= written;
+            for (int k = 0; k < sub->sample_count; k++) {
+                written = snprintf(p, remaining, "%s \"%s\"", k > 0 ? "," : "", sub->samples[k]);
+                p += written;
+                remaining -= written;
+            }
+            written = snprintf(p, remaining, "\n");
+            p += written;
+            remaining -= written;
+        }
     }
 
     snprintf(p, remaining,
-        "\nSuggest a folder structure and where each file should go. "
+        "\nSuggest a folder, relative to this one, for each group. "
         "Consider grouping by type, date, or project. "
-        "Respond with JSON: [{\"file\": \"filename\", \"folder\": \"suggested/path\", \"reason\": \"why\"}]");
+        "Respond with JSON: [{\"group\": \"Category/Kind\", \"folder\": \"suggested/path\", \"reason\": \"why\"}]");
 
     // Send to Claude
     ClaudeClient *client = claude_client_create(config->api_key);
-    if (!client) return ORG_STATUS_API_ERROR;
+    if (!client) {
+        free(prompt);
+        return ORG_STATUS_API_ERROR;
+    }
 
     ClaudeMessageRequest req;
     ClaudeMessageResponse resp;
     claude_request_init(&req);
     claude_response_init(&resp);
+    claude_request_set_priority(&req, API_PRIORITY_BACKGROUND);
+    claude_request_set_feature(&req, CLAUDE_FEATURE_ORGANIZE);
 
     claude_request_set_system_prompt(&req, "You are a file organization assistant. Suggest clean folder structures.");
     claude_request_add_user_message(&req, prompt);
+    free(prompt);
 
     bool success = claude_send_message(client, &req, &resp);
 
     if (success && resp.stop_reason != CLAUDE_STOP_ERROR) {
-        // Parse suggestions and update files
-        // Simple parsing - look for folder suggestions in JSON
-        const char *response = resp.content;
-        for (int i = 0; i < analysis->file_count; i++) {
-            // Look for this file in response
-            const char *file_match = strstr(response, analysis->files[i].name);
-            if (file_match) {
-                // Look for folder suggestion
-                const char *folder_key = strstr(file_match, "\"folder\"");
-                if (folder_key) {
-                    const char *folder_start = strchr(folder_key + 8, '"');
-                    if (folder_start) {
-                        folder_start++;
-                        const char *folder_end = strchr(folder_start, '"');
-                        if (folder_end) {
-                            size_t len = folder_end - folder_start;
-                            if (len < sizeof(analysis->files[i].suggested_folder)) {
-                                strncpy(analysis->files[i].suggested_folder, folder_start, len);
-                                analysis->files[i].suggested_folder[len] = '\0';
-                            }
-                        }
-                    }
+        // The array may come wrapped in prose
+        const char *array_start = strchr(resp.content, '[');
+        const char *array_end = strrchr(resp.content, ']');
+        cJSON *suggestions = NULL;
+        if (array_start && array_end && array_end > array_start) {
+            suggestions = cJSON_ParseWithLength(array_start, (size_t)(array_end - array_start + 1));
+        }
+
+        const cJSON *item;
+        cJSON_ArrayForEach(item, suggestions) {
+            const cJSON *group = cJSON_GetObjectItem(item, "group");
+            const cJSON *folder = cJSON_GetObjectItem(item, "folder");
+            if (!cJSON_IsString(group) || !cJSON_IsString(folder) || !is_safe_folder(folder->valuestring)) {
+                continue;
+            }
+            for (int i = 0; i < analysis->file_count; i++) {
+                OrganizedFile *file = &analysis->files[i];
+                char name[128];
+                file_group(analysis, file, name, sizeof(name));
+                if (strcmp(name, group->valuestring) == 0) {
+                    strncpy(file->suggested_folder, folder->valuestring, sizeof(file->suggested_folder) - 1);
+                    file->suggested_folder[sizeof(file->suggested_folder) - 1] = '\0';
                 }
             }
         }
+        cJSON_Delete(suggestions);
 
         // Regenerate folder suggestions
         generate_suggested_folders(analysis);
@@ -594,21 +864,44 @@ char *organization_preview_plan(const OrganizationAnalysis *analysis)
     return plan;
 }
 
-// Create directory recursively
-static bool create_directory_recursive(const char *path)
+// Helper: Plan every confirmed move as one batch in a new undo group and save it as
+// the journal. move_files gets the file index of each move; duplicates headed for the
+// Trash are left out
+static MoveBatch *plan_organization(const OrganizationAnalysis *analysis, bool use_trash_for_duplicates,
+                                    int *move_files, char *journal, size_t journal_size)
 {
-    char tmp[1024];
-    strncpy(tmp, path, sizeof(tmp) - 1);
-    tmp[sizeof(tmp) - 1] = '\0';
+    if (!move_batch_journal_path(ORG_JOURNAL_NAME, journal, journal_size)) {
+        return NULL;
+    }
+    MoveBatch *batch = move_batch_create();
+    if (!batch) {
+        return NULL;
+    }
+    // Never replace a file already in a destination folder
+    move_batch_set_keep_both(batch, true);
+
+    for (int i = 0; i < analysis->file_count; i++) {
+        const OrganizedFile *file = &analysis->files[i];
+        if (!file->should_move || (file->is_duplicate && use_trash_for_duplicates)) continue;
+
+        char dest_path[2048];
+        snprintf(dest_path, sizeof(dest_path), "%s/%s/%s",
+                 analysis->source_path, file->suggested_folder, file->name);
+        if (strcmp(file->path, dest_path) == 0) continue;
 
-    for (char *p = tmp + 1; *p; p++) {
-        if (*p == '/') {
-            *p = '\0';
-            mkdir(tmp, 0755);
-            *p = '/';
+        move_files[move_batch_count(batch)] = i;
+        if (!move_batch_add(batch, file->path, dest_path)) {
+            move_batch_free(batch);
+            return NULL;
         }
     }
-    return mkdir(tmp, 0755) == 0 || errno == EEXIST;
+
+    move_batch_set_undo_group(batch, undo_log_begin(undo_log_shared(), UNDO_SOURCE_ORGANIZE, "Organize"));
+    if (!move_batch_save(batch, journal)) {
+        move_batch_free(batch);
+        return NULL;
+    }
+    return batch;
 }
 
 // Execute organization plan
@@ -621,98 +914,107 @@ OrganizationResult organization_execute(OrganizationAnalysis *analysis, bool use
         return result;
     }
 
-    // Clear undo history
-    org_undo_history.count = 0;
-    org_undo_history.valid = false;
-
-    // Create folders
-    for (int i = 0; i < analysis->folder_count; i++) {
-        SuggestedFolder *folder = &analysis->suggested_folders[i];
-        if (!folder->selected || folder->exists) continue;
-
-        char full_path[1024];
-        snprintf(full_path, sizeof(full_path), "%s/%s",
-                 analysis->source_path, folder->path);
-
-        if (create_directory_recursive(full_path)) {
-            result.folders_created++;
-        }
+    char journal[1024];
+    int *move_files = malloc((size_t)(analysis->file_count + 1) * sizeof(int));
+    MoveBatch *batch = move_files ? plan_organization(analysis, use_trash_for_duplicates, move_files,
+                                                      journal, sizeof(journal)) : NULL;
+    if (!batch) {
+        free(move_files);
+        snprintf(result.error_message, sizeof(result.error_message), "Cannot write the move journal");
+        result.status = ORG_STATUS_FILE_ERROR;
+        return result;
     }
 
-    // Move files
-    for (int i = 0; i < analysis->file_count; i++) {
-        OrganizedFile *file = &analysis->files[i];
-        if (!file->should_move) continue;
-
-        // Skip duplicates if using trash
-        if (file->is_duplicate && use_trash_for_duplicates) {
-            // Move to trash
-            char cmd[2048];
-            snprintf(cmd, sizeof(cmd),
-                     "osascript -e 'tell app \"Finder\" to delete POSIX file \"%s\"' 2>/dev/null",
-                     file->path);
-            if (system(cmd) == 0) {
-                result.files_moved++;
-                result.bytes_moved += file->size;
+    // Duplicates go to the Trash together, in the same undo group as the moves
+    if (use_trash_for_duplicates) {
+        const char **paths = malloc((size_t)(analysis->file_count + 1) * sizeof(const char *));
+        int *path_files = malloc((size_t)(analysis->file_count + 1) * sizeof(int));
+        OperationResult *outcomes = malloc((size_t)(analysis->file_count + 1) * sizeof(OperationResult));
+        int count = 0;
+        for (int i = 0; paths && path_files && outcomes && i < analysis->file_count; i++) {
+            const OrganizedFile *file = &analysis->files[i];
+            if (file->should_move && file->is_duplicate) {
+                path_files[count] = i;
+                paths[count++] = file->path;
             }
-            continue;
         }
+        if (count > 0) {
+            file_trash_batch(paths, count, outcomes, move_batch_undo_group(batch));
+            for (int i = 0; i < count; i++) {
+                if (outcomes[i] == OP_SUCCESS) {
+                    result.files_moved++;
+                    result.bytes_moved += analysis->files[path_files[i]].size;
+                } else {
+                    result.errors++;
+                }
+            }
+        }
+        free(paths);
+        free(path_files);
+        free(outcomes);
+    }
 
-        // Build destination path
-        char dest_dir[1024];
-        snprintf(dest_dir, sizeof(dest_dir), "%s/%s",
-                 analysis->source_path, file->suggested_folder);
-
-        char dest_path[1024];
-        snprintf(dest_path, sizeof(dest_path), "%s/%s", dest_dir, file->name);
-
-        // Skip if same location
-        if (strcmp(file->path, dest_path) == 0) continue;
-
-        // Move file
-        if (rename(file->path, dest_path) == 0) {
+    MoveBatchResult moved;
+    move_batch_run(batch, journal, NULL, &moved);
+    for (int m = 0; m < move_batch_count(batch); m++) {
+        if (move_batch_done(batch, m, NULL, 0)) {
+            OrganizedFile *file = &analysis->files[move_files[m]];
             result.files_moved++;
             result.bytes_moved += file->size;
 
-            // Store in undo history
-            if (org_undo_history.count < 1000) {
-                strncpy(org_undo_history.original_paths[org_undo_history.count],
-                        file->path, 1023);
-                strncpy(org_undo_history.new_paths[org_undo_history.count],
-                        dest_path, 1023);
-                org_undo_history.count++;
-            }
-
             // Learn from this organization
             organization_learn(file->path, file->suggested_folder);
-        } else {
-            result.errors++;
         }
     }
+    result.folders_created = moved.folders_created;
+    result.errors += moved.failed;
+    if (moved.error_message[0] != '\0') {
+        snprintf(result.error_message, sizeof(result.error_message), "%s", moved.error_message);
+    }
+    move_batch_free(batch);
+    free(move_files);
 
-    org_undo_history.valid = (org_undo_history.count > 0);
     result.status = (result.errors == 0) ? ORG_STATUS_OK : ORG_STATUS_FILE_ERROR;
     return result;
 }
 
-// Undo last organization
-bool organization_undo(void)
+int organization_queue_execute(OrganizationAnalysis *analysis, bool use_trash_for_duplicates,
+                               OperationQueue *queue)
 {
-    if (!org_undo_history.valid || org_undo_history.count == 0) {
-        return false;
+    if (!analysis || !queue) {
+        return -1;
     }
 
-    int undone = 0;
-    for (int i = 0; i < org_undo_history.count; i++) {
-        if (rename(org_undo_history.new_paths[i],
-                   org_undo_history.original_paths[i]) == 0) {
-            undone++;
+    char journal[1024];
+    int *move_files = malloc((size_t)(analysis->file_count + 1) * sizeof(int));
+    MoveBatch *batch = move_files ? plan_organization(analysis, use_trash_for_duplicates, move_files,
+                                                      journal, sizeof(journal)) : NULL;
+    if (!batch) {
+        free(move_files);
+        return -1;
+    }
+    for (int m = 0; m < move_batch_count(batch); m++) {
+        const OrganizedFile *file = &analysis->files[move_files[m]];
+        organization_learn(file->path, file->suggested_folder);
+    }
+    move_batch_free(batch);
+    free(move_files);
+
+    // Pending deletes on one device are sent to the Trash together
+    for (int i = 0; use_trash_for_duplicates && i < analysis->file_count; i++) {
+        const OrganizedFile *file = &analysis->files[i];
+        if (file->should_move && file->is_duplicate) {
+            operation_queue_delete(queue, file->path);
         }
     }
+    return operation_queue_move_batch(queue, journal, analysis->source_path);
+}
 
-    org_undo_history.valid = false;
-    org_undo_history.count = 0;
-    return undone > 0;
+// Undo last organization
+bool organization_undo(void)
+{
+    UndoResult result;
+    return undo_log_undo_last(undo_log_shared(), UNDO_SOURCE_ORGANIZE, &result);
 }
 
 // Selection helpers
@@ -5,15 +5,31 @@
 #include <stddef.h>
 #include <stdint.h>
 
+// Forward declaration
+struct OperationQueue;
+
 // Maximum number of categories
 #define ORG_MAX_CATEGORIES 32
 
 // Maximum files per category
 #define ORG_MAX_FILES_PER_CATEGORY 1000
 
+// Files kept in OrganizationAnalysis.files; the statistics count every file
+#define ORG_MAX_FILES (ORG_MAX_FILES_PER_CATEGORY * ORG_MAX_CATEGORIES)
+
 // Maximum suggested folders
 #define ORG_MAX_FOLDERS 64
 
+// Subcategories per category, and example names kept for each
+#define ORG_MAX_SUBCATEGORIES 16
+#define ORG_SUBCATEGORY_SAMPLES 3
+
+// Scans read directories on this many threads (the caller's included), merging what a
+// thread found into the analysis every ORG_SCAN_BATCH files
+#define ORG_SCAN_THREADS 4
+#define ORG_SCAN_BATCH 256
+#define ORG_SCAN_MAX_DEPTH 64
+
 // Organization status
 typedef enum OrganizationStatus {
     ORG_STATUS_OK = 0,
@@ -44,6 +60,8 @@ typedef struct SubCategory {
     char folder_name[64];       // Suggested folder name
     int file_count;
     uint64_t total_size;
+    char samples[ORG_SUBCATEGORY_SAMPLES][64];  // First file names seen, for the AI summary
+    int sample_count;
 } SubCategory;
 
 // Organized file entry
@@ -51,7 +69,7 @@ typedef struct OrganizedFile {
     char path[1024];
     char name[256];
     FileCategory category;
-    int subcategory_index;      // Index into subcategories array
+    int subcategory_index;      // Index into its category's subcategories (-1: none)
     uint64_t size;
     char suggested_folder[256]; // Where to move this file
     bool should_move;           // User confirmed move
@@ -65,7 +83,7 @@ typedef struct CategoryStats {
     char name[32];
     int file_count;
     uint64_t total_size;
-    SubCategory subcategories[16];
+    SubCategory subcategories[ORG_MAX_SUBCATEGORIES];
     int subcategory_count;
 } CategoryStats;
 
@@ -84,10 +102,11 @@ typedef struct OrganizationAnalysis {
     // Source directory
     char source_path[1024];
 
-    // All files analyzed
+    // Files analyzed, up to ORG_MAX_FILES
     OrganizedFile *files;
     int file_count;
     int file_capacity;
+    bool files_truncated;       // More files than files holds; the statistics cover all
 
     // Category breakdown
     CategoryStats categories[ORG_MAX_CATEGORIES];
@@ -100,6 +119,7 @@ typedef struct OrganizationAnalysis {
     // Summary statistics
     uint64_t total_size;
     int total_files;
+    int directories_scanned;
     int duplicate_count;
     uint64_t duplicate_size;
     int old_file_count;         // Files older than threshold
@@ -120,16 +140,20 @@ typedef struct OrganizationConfig {
     bool analyze_content;       // Use AI to analyze file content
     bool detect_duplicates;     // Mark duplicates
     int old_file_days;          // Files older than this are "old" (default: 365)
-    bool recursive;             // Scan subdirectories
+    bool recursive;             // Scan subdirectories (in parallel)
     const char **exclude_patterns;
     int exclude_count;
     char api_key[256];          // For AI-powered categorization
     bool create_subfolders;     // Create detailed subfolder structure
 } OrganizationConfig;
 
-// Progress callback
+// Progress callback, from the scan threads one call at a time. total_files is the count
+// found so far: the scan reads each directory once, so it is not known ahead
 typedef void (*OrganizationProgressCallback)(int files_analyzed, int total_files, const char *current_file, void *user_data);
 
+// Scan running in the background (opaque)
+typedef struct OrganizationScan OrganizationScan;
+
 // Initialize default configuration
 void organization_config_init(OrganizationConfig *config);
 
@@ -146,7 +170,24 @@ OrganizationStatus organization_analyze(const char *path,
                                          void *user_data,
                                          OrganizationAnalysis *result);
 
-// Generate AI-powered organization suggestions (uses Claude)
+// Analyze in the background. config is copied, but its exclude_patterns must outlive
+// the scan. NULL on failure
+OrganizationScan *organization_scan_start(const char *path, const OrganizationConfig *config);
+
+// Copy the statistics gathered so far into snapshot, for the UI to show while the scan
+// runs (files is left NULL). Returns true once the scan has finished
+bool organization_scan_poll(OrganizationScan *scan, OrganizationAnalysis *snapshot);
+
+// Ask the scan to stop early
+void organization_scan_cancel(OrganizationScan *scan);
+
+// Wait for the scan, free it and hand over its analysis (the caller frees it); NULL if
+// it failed or was cancelled. status, if given, receives how it ended
+OrganizationAnalysis *organization_scan_finish(OrganizationScan *scan, OrganizationStatus *status);
+
+// Generate AI-powered organization suggestions (uses Claude). Claude is sent the
+// statistics per category and subcategory with a few example names, not the file list,
+// and its folder for each group applies to every file in it
 OrganizationStatus organization_ai_suggest(OrganizationAnalysis *analysis,
                                             const OrganizationConfig *config);
 
@@ -163,9 +204,17 @@ typedef struct OrganizationResult {
     OrganizationStatus status;
 } OrganizationResult;
 
+// Moves run as one batch (see move_batch.h) into folders created up front; a name
+// already taken in a folder gets a unique one. Duplicates go to the Trash together
 OrganizationResult organization_execute(OrganizationAnalysis *analysis, bool use_trash_for_duplicates);
 
-// Undo last organization
+// Queue the same work on the operation queue: the moves as one batch operation and the
+// duplicates as deletes. Returns the batch's operation ID, or -1
+int organization_queue_execute(OrganizationAnalysis *analysis, bool use_trash_for_duplicates,
+                               struct OperationQueue *queue);
+
+// Undo last organization from the undo log: moves every file back, puts duplicates
+// back from the Trash and removes the folders it created that are empty again
 bool organization_undo(void);
 
 // Selection helpers
@@ -0,0 +1,1179 @@
+#include "path_index.h"
+#include "../utils/hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fnmatch.h>
+#include <pthread.h>
+
+// Trigrams are keyed on 6 bits per character (case folded), so 2^18 posting lists
+#define TRIGRAM_BITS 18
+#define TRIGRAM_COUNT (1u << TRIGRAM_BITS)
+
+#define PATH_INDEX_MAGIC 0x58495046u    // "FPIX"
+#define PATH_INDEX_VERSION 1
+
+#define NO_RECORD UINT32_MAX
+#define MAX_QUERY_TERMS 8
+#define MAX_QUERY_TRIGRAMS 64
+#define MAX_PATH_DEPTH (PATH_INDEX_MAX_PATH / 2)
+
+// Compact once this many dead records accumulate (and they outnumber live ones)
+#define COMPACT_MIN_DEAD 4096
+
+// One path component; the full path is rebuilt by walking parents
+typedef struct PathRecord {
+    uint32_t parent;        // Containing directory, or NO_RECORD below "/"
+    uint32_t name;          // Offset of the NUL-terminated name in the arena
+    uint32_t hash;          // Of (parent, name)
+    uint32_t epoch;         // Scan that last saw this path
+    uint16_t name_length;
+    uint8_t depth;          // Components above this one (capped at 255)
+    bool live;              // Cleared on removal; descendants die with it
+    bool listed;            // Added explicitly (otherwise only an ancestor of one)
+} PathRecord;
+
+// Ascending record ids whose name contains one trigram, as varint deltas
+typedef struct Posting {
+    uint8_t *bytes;
+    uint32_t size;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t last;
+} Posting;
+
+struct PathIndex {
+    char file_path[PATH_INDEX_MAX_PATH];
+    pthread_mutex_t mutex;
+
+    char *arena;
+    size_t arena_size;
+    size_t arena_capacity;
+
+    PathRecord *records;
+    uint32_t record_count;
+    uint32_t record_capacity;
+    uint32_t dead_count;
+
+    uint32_t *slots;        // Open-addressed table of record id + 1 by hash (0 = empty)
+    uint32_t slot_capacity; // Power of two
+
+    Posting *postings;      // TRIGRAM_COUNT lists
+    uint32_t epoch;
+    uint64_t changes;       // Paths added or removed since opened
+};
+
+static uint32_t hash_component(uint32_t parent, const char *name, size_t len)
+{
+    return hash_fnv1a_bytes((HASH_FNV1A_INIT ^ parent) * HASH_FNV1A_PRIME, name, len);
+}
+
+static unsigned char fold_char(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+static uint32_t trigram_bits(unsigned char c)
+{
+    c = fold_char(c);
+    if (c >= 'a' && c <= 'z') return c - 'a';
+    if (c >= '0' && c <= '9') return 26 + (c - '0');
+    return 36 + c % 28;
+}
+
+static uint32_t trigram_key(const char *p)
+{
+    return trigram_bits((unsigned char)p[0]) << 12 |
+           trigram_bits((unsigned char)p[1]) << 6 |
+           trigram_bits((unsigned char)p[2]);
+}
+
+static const char *record_name(const PathIndex *index, const PathRecord *record)
+{
+    return index->arena + record->name;
+}
+
+// A path is present only while it and every ancestor are live
+static bool record_alive(const PathIndex *index, uint32_t id)
+{
+    if (index->dead_count == 0) {
+        return true;
+    }
+    while (id != NO_RECORD) {
+        if (!index->records[id].live) {
+            return false;
+        }
+        id = index->records[id].parent;
+    }
+    return true;
+}
+
+// Write the full path of a record; returns its length, or -1 if it does not fit
+static int build_path(const PathIndex *index, uint32_t id, char *out, size_t out_size)
+{
+    uint32_t chain[MAX_PATH_DEPTH];
+    int depth = 0;
+    while (id != NO_RECORD && depth < MAX_PATH_DEPTH) {
+        chain[depth++] = id;
+        id = index->records[id].parent;
+    }
+
+    size_t len = 0;
+    for (int i = depth - 1; i >= 0; i--) {
+        const PathRecord *record = &index->records[chain[i]];
+        if (len + 1 + record->name_length + 1 > out_size) {
+            return -1;
+        }
+        out[len++] = '/';
+        memcpy(out + len, record_name(index, record), record->name_length);
+        len += record->name_length;
+    }
+    out[len] = '\0';
+    return (int)len;
+}
+
+// Slot holding (parent, name), or the empty slot where it would go
+static uint32_t find_slot(const PathIndex *index, uint32_t parent, const char *name, size_t len, uint32_t hash)
+{
+    uint32_t mask = index->slot_capacity - 1;
+    uint32_t i = hash & mask;
+    while (index->slots[i] != 0) {
+        const PathRecord *record = &index->records[index->slots[i] - 1];
+        if (record->hash == hash && record->parent == parent && record->name_length == len &&
+            memcmp(record_name(index, record), name, len) == 0) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static bool grow_slots(PathIndex *index)
+{
+    uint32_t capacity = index->slot_capacity ? index->slot_capacity * 2 : 1024;
+    uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+    if (slots == NULL) {
+        return false;
+    }
+
+    uint32_t *old = index->slots;
+    uint32_t old_capacity = index->slot_capacity;
+    index->slots = slots;
+    index->slot_capacity = capacity;
+
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (old[i] == 0) continue;
+        uint32_t j = index->records[old[i] - 1].hash & (capacity - 1);
+        while (slots[j] != 0) {
+            j = (j + 1) & (capacity - 1);
+        }
+        slots[j] = old[i];
+    }
+    free(old);
+    return true;
+}
+
+static bool posting_push(Posting *posting, uint32_t id)
+{
+    // Ids arrive in ascending order, so a repeated trigram is always the last entry
+    if (posting->count > 0 && posting->last == id) {
+        return true;
+    }
+    if (posting->size + 5 > posting->capacity) {
+        uint32_t capacity = posting->capacity ? posting->capacity * 2 : 16;
+        uint8_t *bytes = realloc(posting->bytes, capacity);
+        if (bytes == NULL) {
+            return false;
+        }
+        posting->bytes = bytes;
+        posting->capacity = capacity;
+    }
+
+    uint32_t delta = posting->count > 0 ? id - posting->last : id;
+    while (delta >= 0x80) {
+        posting->bytes[posting->size++] = (uint8_t)(delta | 0x80);
+        delta >>= 7;
+    }
+    posting->bytes[posting->size++] = (uint8_t)delta;
+    posting->last = id;
+    posting->count++;
+    return true;
+}
+
+// Sequential decoder over a posting list
+typedef struct PostingCursor {
+    const Posting *posting;
+    uint32_t offset;
+    uint32_t value;
+    bool valid;
+} PostingCursor;
+
+static void cursor_next(PostingCursor *cursor)
+{
+    const Posting *posting = cursor->posting;
+    if (cursor->offset >= posting->size) {
+        cursor->valid = false;
+        return;
+    }
+    uint32_t delta = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = posting->bytes[cursor->offset++];
+        delta |= (uint32_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    cursor->value = cursor->valid ? cursor->value + delta : delta;
+    cursor->valid = true;
+}
+
+static void cursor_init(PostingCursor *cursor, const Posting *posting)
+{
+    cursor->posting = posting;
+    cursor->offset = 0;
+    cursor->value = 0;
+    cursor->valid = false;
+    cursor_next(cursor);
+}
+
+// Advance to the first id >= target; true if target is present
+static bool cursor_seek(PostingCursor *cursor, uint32_t target)
+{
+    while (cursor->valid && cursor->value < target) {
+        cursor_next(cursor);
+    }
+    return cursor->valid && cursor->value == target;
+}
+
+static uint32_t new_record(PathIndex *index, uint32_t parent, const char *name, size_t len,
+                           uint32_t hash, uint32_t slot)
+{
+    if (index->record_count == NO_RECORD - 1 || index->arena_size + len + 1 > UINT32_MAX) {
+        return NO_RECORD;
+    }
+
+    if (index->record_count == index->record_capacity) {
+        uint32_t capacity = index->record_capacity ? index->record_capacity * 2 : 1024;
+        PathRecord *records = realloc(index->records, capacity * sizeof(PathRecord));
+        if (records == NULL) {
+            return NO_RECORD;
+        }
+        index->records = records;
+        index->record_capacity = capacity;
+    }
+    if (index->arena_size + len + 1 > index->arena_capacity) {
+        size_t capacity = index->arena_capacity ? index->arena_capacity * 2 : 64 * 1024;
+        while (capacity < index->arena_size + len + 1) {
+            capacity *= 2;
+        }
+        char *arena = realloc(index->arena, capacity);
+        if (arena == NULL) {
+            return NO_RECORD;
+        }
+        index->arena = arena;
+        index->arena_capacity = capacity;
+    }
+
+    uint32_t id = index->record_count++;
+    PathRecord *record = &index->records[id];
+    record->parent = parent;
+    record->name = (uint32_t)index->arena_size;
+    record->hash = hash;
+    record->epoch = index->epoch;
+    record->name_length = (uint16_t)len;
+    record->depth = 0;
+    if (parent != NO_RECORD) {
+        uint8_t parent_depth = index->records[parent].depth;
+        record->depth = parent_depth < UINT8_MAX ? parent_depth + 1 : UINT8_MAX;
+    }
+    record->live = true;
+    record->listed = false;
+
+    memcpy(index->arena + index->arena_size, name, len);
+    index->arena[index->arena_size + len] = '\0';
+    index->arena_size += len + 1;
+
+    // A dead record in this slot is superseded; its descendants stay unreachable
+    index->slots[slot] = id + 1;
+
+    for (size_t i = 0; i + 3 <= len; i++) {
+        posting_push(&index->postings[trigram_key(name + i)], id);
+    }
+    return id;
+}
+
+// Walk (or with create, build) the records for each component of an absolute path
+static uint32_t resolve_locked(PathIndex *index, const char *path, bool create)
+{
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') {
+        len--;
+    }
+    if (path[0] != '/' || len < 2 || len >= PATH_INDEX_MAX_PATH) {
+        return NO_RECORD;
+    }
+
+    uint32_t id = NO_RECORD;
+    size_t start = 1;
+    while (start < len) {
+        size_t end = start;
+        while (end < len && path[end] != '/') {
+            end++;
+        }
+        if (end > start) {
+            if (create && (index->record_count + 1) * 2 > index->slot_capacity && !grow_slots(index)) {
+                return NO_RECORD;
+            }
+            if (index->slot_capacity == 0) {
+                return NO_RECORD;
+            }
+
+            const char *name = path + start;
+            size_t name_len = end - start;
+            uint32_t hash = hash_component(id, name, name_len);
+            uint32_t slot = find_slot(index, id, name, name_len, hash);
+            uint32_t found = index->slots[slot];
+
+            if (found != 0 && index->records[found - 1].live) {
+                id = found - 1;
+                if (create) {
+                    index->records[id].epoch = index->epoch;  // A seen child means its parent exists
+                }
+            } else if (!create) {
+                return NO_RECORD;
+            } else {
+                id = new_record(index, id, name, name_len, hash, slot);
+                if (id == NO_RECORD) {
+                    return NO_RECORD;
+                }
+            }
+        }
+        start = end + 1;
+    }
+    return id;
+}
+
+static bool add_locked(PathIndex *index, const char *path)
+{
+    uint32_t count = index->record_count;
+    uint32_t id = resolve_locked(index, path, true);
+    if (id == NO_RECORD) {
+        return false;
+    }
+    if (id >= count || !index->records[id].listed) {
+        index->changes++;
+    }
+    index->records[id].listed = true;
+    index->records[id].epoch = index->epoch;
+    return true;
+}
+
+static void free_storage(PathIndex *index)
+{
+    if (index->postings) {
+        for (uint32_t i = 0; i < TRIGRAM_COUNT; i++) {
+            free(index->postings[i].bytes);
+        }
+    }
+    free(index->postings);
+    free(index->slots);
+    free(index->records);
+    free(index->arena);
+    index->postings = NULL;
+    index->slots = NULL;
+    index->records = NULL;
+    index->arena = NULL;
+    index->arena_size = index->arena_capacity = 0;
+    index->record_count = index->record_capacity = index->slot_capacity = 0;
+    index->dead_count = 0;
+}
+
+// Rebuild from the paths still present, dropping dead records and their postings
+static void compact_locked(PathIndex *index)
+{
+    Posting *postings = calloc(TRIGRAM_COUNT, sizeof(Posting));
+    if (postings == NULL) {
+        return;
+    }
+
+    PathIndex old = *index;
+    index->postings = postings;
+    index->arena = NULL;
+    index->records = NULL;
+    index->slots = NULL;
+    index->arena_size = index->arena_capacity = 0;
+    index->record_count = index->record_capacity = index->slot_capacity = 0;
+    index->dead_count = 0;
+
+    char path[PATH_INDEX_MAX_PATH];
+    for (uint32_t id = 0; id < old.record_count; id++) {
+        const PathRecord *record = &old.records[id];
+        if (record->listed && record_alive(&old, id) && build_path(&old, id, path, sizeof(path)) > 0) {
+            add_locked(index, path);
+            uint32_t new_id = resolve_locked(index, path, false);
+            if (new_id != NO_RECORD) {
+                index->records[new_id].epoch = record->epoch;
+            }
+        }
+    }
+
+    free_storage(&old);
+}
+
+static void kill_record(PathIndex *index, uint32_t id)
+{
+    index->records[id].live = false;
+    index->dead_count++;
+}
+
+static void maybe_compact(PathIndex *index)
+{
+    if (index->dead_count >= COMPACT_MIN_DEAD &&
+        index->dead_count > index->record_count - index->dead_count) {
+        compact_locked(index);
+    }
+}
+
+static bool load_file(PathIndex *index, FILE *f)
+{
+    uint32_t header[3];
+    if (fread(header, sizeof(uint32_t), 3, f) != 3 ||
+        header[0] != PATH_INDEX_MAGIC || header[1] != PATH_INDEX_VERSION) {
+        return false;
+    }
+
+    char path[PATH_INDEX_MAX_PATH];
+    for (uint32_t i = 0; i < header[2]; i++) {
+        uint16_t len;
+        if (fread(&len, sizeof(len), 1, f) != 1 || len == 0 || len >= sizeof(path) ||
+            fread(path, 1, len, f) != len) {
+            return false;
+        }
+        path[len] = '\0';
+        add_locked(index, path);
+    }
+    return true;
+}
+
+PathIndex* path_index_open(const char *file_path)
+{
+    PathIndex *index = calloc(1, sizeof(PathIndex));
+    if (index == NULL) {
+        return NULL;
+    }
+
+    index->postings = calloc(TRIGRAM_COUNT, sizeof(Posting));
+    if (index->postings == NULL) {
+        free(index);
+        return NULL;
+    }
+    pthread_mutex_init(&index->mutex, NULL);
+
+    if (file_path != NULL) {
+        strncpy(index->file_path, file_path, sizeof(index->file_path) - 1);
+
+        FILE *f = fopen(file_path, "rb");
+        if (f != NULL) {
+            if (!load_file(index, f)) {
+                // Corrupt or from another version: start empty and rebuild on the next scan
+                free_storage(index);
+                index->postings = calloc(TRIGRAM_COUNT, sizeof(Posting));
+            }
+            fclose(f);
+        }
+    }
+
+    if (index->postings == NULL) {
+        path_index_close(index);
+        return NULL;
+    }
+    return index;
+}
+
+void path_index_close(PathIndex *index)
+{
+    if (index == NULL) {
+        return;
+    }
+    free_storage(index);
+    pthread_mutex_destroy(&index->mutex);
+    free(index);
+}
+
+bool path_index_save(PathIndex *index)
+{
+    if (index == NULL || index->file_path[0] == '\0') {
+        return false;
+    }
+
+    char tmp_path[PATH_INDEX_MAX_PATH + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", index->file_path);
+    FILE *f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&index->mutex);
+
+    uint32_t count = 0;
+    for (uint32_t id = 0; id < index->record_count; id++) {
+        if (index->records[id].listed && record_alive(index, id)) count++;
+    }
+
+    // Paths are written in id order, so parents precede their children on load
+    uint32_t header[3] = {PATH_INDEX_MAGIC, PATH_INDEX_VERSION, count};
+    bool ok = fwrite(header, sizeof(uint32_t), 3, f) == 3;
+    char path[PATH_INDEX_MAX_PATH];
+    for (uint32_t id = 0; ok && id < index->record_count; id++) {
+        if (!index->records[id].listed || !record_alive(index, id)) continue;
+        // Rebuilt paths are never longer than the (length-checked) path that was added
+        uint16_t len = (uint16_t)build_path(index, id, path, sizeof(path));
+        ok = fwrite(&len, sizeof(len), 1, f) == 1 && fwrite(path, 1, len, f) == len;
+    }
+
+    pthread_mutex_unlock(&index->mutex);
+
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+    if (!ok || rename(tmp_path, index->file_path) != 0) {
+        remove(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+bool path_index_add(PathIndex *index, const char *path)
+{
+    if (index == NULL || path == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&index->mutex);
+    bool added = add_locked(index, path);
+    pthread_mutex_unlock(&index->mutex);
+    return added;
+}
+
+void path_index_remove(PathIndex *index, const char *path)
+{
+    if (index == NULL || path == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&index->mutex);
+
+    // Descendants hang off this record, so marking it hides the whole subtree
+    uint32_t id = resolve_locked(index, path, false);
+    if (id != NO_RECORD) {
+        kill_record(index, id);
+        index->changes++;
+        maybe_compact(index);
+    }
+
+    pthread_mutex_unlock(&index->mutex);
+}
+
+int path_index_count(PathIndex *index)
+{
+    if (index == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&index->mutex);
+    int count = 0;
+    for (uint32_t id = 0; id < index->record_count; id++) {
+        if (index->records[id].listed && record_alive(index, id)) count++;
+    }
+    pthread_mutex_unlock(&index->mutex);
+    return count;
+}
+
+uint64_t path_index_changes(PathIndex *index)
+{
+    if (index == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&index->mutex);
+    uint64_t changes = index->changes;
+    pthread_mutex_unlock(&index->mutex);
+    return changes;
+}
+
+void path_index_begin_scan(PathIndex *index)
+{
+    if (index == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&index->mutex);
+    index->epoch++;
+    pthread_mutex_unlock(&index->mutex);
+}
+
+void path_index_end_scan(PathIndex *index)
+{
+    if (index == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&index->mutex);
+    // Unlisted ancestors (above the scanned roots) are never re-seen, so keep them
+    for (uint32_t id = 0; id < index->record_count; id++) {
+        PathRecord *record = &index->records[id];
+        if (record->live && record->listed && record->epoch != index->epoch) {
+            kill_record(index, id);
+            index->changes++;
+        }
+    }
+    maybe_compact(index);
+    pthread_mutex_unlock(&index->mutex);
+}
+
+// Case-insensitive search for a folded needle
+static int find_folded(const char *text, int text_len, const char *needle, int needle_len)
+{
+    for (int i = 0; i + needle_len <= text_len; i++) {
+        int j = 0;
+        while (j < needle_len && fold_char((unsigned char)text[i + j]) == (unsigned char)needle[j]) {
+            j++;
+        }
+        if (j == needle_len) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// A term without '/' must occur in the name; "dir/na" means a name starting
+// with "na" inside a directory whose path ends with "dir"
+typedef struct QueryTerm {
+    char text[PATH_INDEX_MAX_PATH];
+    int length;
+    int name_start;         // Offset of the part matched against the name
+} QueryTerm;
+
+typedef struct QueryMatch {
+    uint32_t id;
+    int score;
+} QueryMatch;
+
+static bool term_matches(const PathIndex *index, uint32_t id, const QueryTerm *term, char *scratch)
+{
+    const PathRecord *record = &index->records[id];
+    const char *name = record_name(index, record);
+    const char *part = term->text + term->name_start;
+    int part_len = term->length - term->name_start;
+
+    if (term->name_start == 0) {
+        return find_folded(name, record->name_length, part, part_len) >= 0;
+    }
+
+    if (part_len > record->name_length || find_folded(name, part_len, part, part_len) != 0) {
+        return false;
+    }
+
+    // The text before the last '/' must end the parent's path
+    int dir_len = term->name_start - 1;
+    if (dir_len == 0) {
+        return true;
+    }
+    int parent_len = 0;
+    if (record->parent != NO_RECORD) {
+        parent_len = build_path(index, record->parent, scratch, PATH_INDEX_MAX_PATH);
+        if (parent_len < 0) return false;
+    }
+    return parent_len >= dir_len &&
+           find_folded(scratch + parent_len - dir_len, dir_len, term->text, dir_len) == 0;
+}
+
+// Prefix and exact name hits rank first, then shallower paths
+static int score_match(const PathIndex *index, uint32_t id, const QueryTerm *terms, int term_count)
+{
+    const PathRecord *record = &index->records[id];
+    const char *name = record_name(index, record);
+
+    int depth = record->depth;
+    int score = 1000 - 20 * (depth < 40 ? depth : 40) - (record->name_length < 200 ? record->name_length : 200);
+    for (int t = 0; t < term_count; t++) {
+        const char *part = terms[t].text + terms[t].name_start;
+        int part_len = terms[t].length - terms[t].name_start;
+        int pos = find_folded(name, record->name_length, part, part_len);
+        if (pos == 0) score += 200;
+        if (pos == 0 && part_len == record->name_length) score += 300;
+    }
+    return score;
+}
+
+static bool match_worse(const QueryMatch *a, const QueryMatch *b)
+{
+    return a->score < b->score || (a->score == b->score && a->id > b->id);
+}
+
+// Keep the best max_results matches in a min-heap (worst at the root)
+static void heap_offer(QueryMatch *heap, int *count, int max, QueryMatch match)
+{
+    int i;
+    if (*count < max) {
+        i = (*count)++;
+        while (i > 0 && match_worse(&match, &heap[(i - 1) / 2])) {
+            heap[i] = heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        heap[i] = match;
+        return;
+    }
+    if (!match_worse(&heap[0], &match)) {
+        return;
+    }
+    i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= max) break;
+        if (child + 1 < max && match_worse(&heap[child + 1], &heap[child])) child++;
+        if (!match_worse(&heap[child], &match)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = match;
+}
+
+static int match_compare(const void *a, const void *b)
+{
+    const QueryMatch *ma = a;
+    const QueryMatch *mb = b;
+    if (match_worse(ma, mb)) return 1;
+    if (match_worse(mb, ma)) return -1;
+    return 0;
+}
+
+static int posting_compare(const void *a, const void *b)
+{
+    const Posting *pa = *(const Posting *const *)a;
+    const Posting *pb = *(const Posting *const *)b;
+    return (pa->count > pb->count) - (pa->count < pb->count);
+}
+
+typedef struct QueryState {
+    const QueryTerm *terms;
+    int term_count;
+    QueryMatch *heap;
+    int heap_count;
+    int max_results;
+    int total;
+    char *scratch;
+} QueryState;
+
+static void consider(const PathIndex *index, uint32_t id, QueryState *query)
+{
+    const PathRecord *record = &index->records[id];
+    if (!record->listed) {
+        return;
+    }
+    for (int t = 0; t < query->term_count; t++) {
+        if (!term_matches(index, id, &query->terms[t], query->scratch)) {
+            return;
+        }
+    }
+    if (!record_alive(index, id)) {
+        return;
+    }
+    query->total++;
+    QueryMatch match = {id, score_match(index, id, query->terms, query->term_count)};
+    heap_offer(query->heap, &query->heap_count, query->max_results, match);
+}
+
+// Record whose name covers an arena offset, searching forward from *cursor
+// (names are laid out in id order, and each pass moves forward through them)
+static uint32_t record_at_offset(const PathIndex *index, uint32_t *cursor, uint32_t offset)
+{
+    uint32_t lo = *cursor;
+    uint32_t step = 1;
+    uint32_t hi = lo + 1;
+    while (hi < index->record_count && index->records[hi].name <= offset) {
+        lo = hi;
+        hi += step;
+        step *= 2;
+    }
+    if (hi > index->record_count) hi = index->record_count;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (index->records[mid].name <= offset) lo = mid;
+        else hi = mid;
+    }
+    *cursor = lo;
+    return lo;
+}
+
+// Terms too short for trigrams: find names holding the lead character with
+// memchr over the arena instead of visiting every record
+static void scan_short_terms(const PathIndex *index, QueryState *query)
+{
+    const QueryTerm *lead = NULL;
+    for (int t = 0; t < query->term_count; t++) {
+        const QueryTerm *term = &query->terms[t];
+        if (term->length > term->name_start &&
+            (lead == NULL || term->length - term->name_start > lead->length - lead->name_start)) {
+            lead = term;
+        }
+    }
+
+    uint8_t *seen = lead ? calloc(index->record_count / 8 + 1, 1) : NULL;
+    if (seen == NULL) {
+        for (uint32_t id = 0; id < index->record_count; id++) {
+            consider(index, id, query);
+        }
+        return;
+    }
+
+    unsigned char c = (unsigned char)lead->text[lead->name_start];
+    unsigned char variants[2] = {c, (unsigned char)(c - ('a' - 'A'))};
+    int variant_count = (c >= 'a' && c <= 'z') ? 2 : 1;
+
+    const char *end = index->arena + index->arena_size;
+    for (int v = 0; v < variant_count; v++) {
+        const char *p = index->arena;
+        uint32_t cursor = 0;
+        while (p < end && (p = memchr(p, variants[v], (size_t)(end - p))) != NULL) {
+            uint32_t id = record_at_offset(index, &cursor, (uint32_t)(p - index->arena));
+            if (!(seen[id / 8] & (1u << (id % 8)))) {
+                seen[id / 8] |= (uint8_t)(1u << (id % 8));
+                consider(index, id, query);
+            }
+            // The whole name has been checked, so skip past it
+            const PathRecord *record = &index->records[id];
+            p = index->arena + record->name + record->name_length + 1;
+        }
+    }
+    free(seen);
+}
+
+// Split into folded terms; returns the count
+static int parse_terms(const char *query, QueryTerm *terms)
+{
+    int term_count = 0;
+    const char *p = query;
+    while (*p && term_count < MAX_QUERY_TERMS) {
+        while (*p == ' ') p++;
+        QueryTerm *term = &terms[term_count];
+        int len = 0;
+        term->name_start = 0;
+        while (p[len] && p[len] != ' ' && len < PATH_INDEX_MAX_PATH - 1) {
+            term->text[len] = (char)fold_char((unsigned char)p[len]);
+            if (p[len] == '/') term->name_start = len + 1;
+            len++;
+        }
+        if (len == 0) break;
+        term->text[len] = '\0';
+        term->length = len;
+        term_count++;
+        p += len;
+        while (*p && *p != ' ') p++;
+    }
+    return term_count;
+}
+
+bool path_index_query(PathIndex *index, const char *query, int max_results, PathIndexResults *results)
+{
+    if (results == NULL) {
+        return false;
+    }
+    memset(results, 0, sizeof(*results));
+    if (index == NULL || query == NULL || max_results <= 0) {
+        return false;
+    }
+
+    QueryTerm *terms = malloc(MAX_QUERY_TERMS * sizeof(QueryTerm));
+    QueryMatch *heap = malloc(max_results * sizeof(QueryMatch));
+    char *scratch = malloc(PATH_INDEX_MAX_PATH);
+    int term_count = terms ? parse_terms(query, terms) : 0;
+    if (heap == NULL || scratch == NULL || term_count == 0) {
+        free(terms);
+        free(heap);
+        free(scratch);
+        return false;
+    }
+
+    QueryState state = {terms, term_count, heap, 0, max_results, 0, scratch};
+
+    pthread_mutex_lock(&index->mutex);
+
+    // Posting lists of every trigram a matching name must contain
+    const Posting *lists[MAX_QUERY_TRIGRAMS];
+    int list_count = 0;
+    for (int t = 0; t < term_count; t++) {
+        const char *part = terms[t].text + terms[t].name_start;
+        int part_len = terms[t].length - terms[t].name_start;
+        for (int i = 0; i + 3 <= part_len && list_count < MAX_QUERY_TRIGRAMS; i++) {
+            const Posting *posting = &index->postings[trigram_key(part + i)];
+            bool seen = false;
+            for (int j = 0; j < list_count; j++) {
+                if (lists[j] == posting) seen = true;
+            }
+            if (!seen) lists[list_count++] = posting;
+        }
+    }
+
+    if (list_count == 0) {
+        scan_short_terms(index, &state);
+    } else {
+        // Walk the shortest list, advancing the others in step
+        qsort(lists, list_count, sizeof(lists[0]), posting_compare);
+        PostingCursor cursors[MAX_QUERY_TRIGRAMS];
+        for (int j = 0; j < list_count; j++) {
+            cursor_init(&cursors[j], lists[j]);
+        }
+        for (; cursors[0].valid; cursor_next(&cursors[0])) {
+            uint32_t id = cursors[0].value;
+            bool in_all = true;
+            for (int j = 1; j < list_count && in_all; j++) {
+                in_all = cursor_seek(&cursors[j], id);
+            }
+            if (in_all) {
+                consider(index, id, &state);
+            }
+        }
+    }
+
+    qsort(heap, state.heap_count, sizeof(QueryMatch), match_compare);
+
+    results->paths = calloc(state.heap_count > 0 ? state.heap_count : 1, sizeof(char *));
+    results->scores = calloc(state.heap_count > 0 ? state.heap_count : 1, sizeof(int));
+    bool ok = results->paths != NULL && results->scores != NULL;
+    for (int i = 0; ok && i < state.heap_count; i++) {
+        if (build_path(index, heap[i].id, scratch, PATH_INDEX_MAX_PATH) < 0 ||
+            (results->paths[i] = strdup(scratch)) == NULL) {
+            ok = false;
+            break;
+        }
+        results->scores[i] = heap[i].score;
+        results->count++;
+    }
+    results->total = state.total;
+
+    pthread_mutex_unlock(&index->mutex);
+
+    free(terms);
+    free(heap);
+    free(scratch);
+    if (!ok) {
+        path_index_results_free(results);
+        return false;
+    }
+    return true;
+}
+
+// Longest run of literal characters in a glob (outside brackets and escapes); its
+// trigrams narrow the records a pattern can match. Returns its length
+static int glob_literal(const char *pattern, char *out, int out_size)
+{
+    int best_start = 0;
+    int best_len = 0;
+    int run_start = 0;
+    int run_len = 0;
+    int i = 0;
+    while (pattern[i]) {
+        char c = pattern[i];
+        if (c == '*' || c == '?' || c == '[' || c == '\\') {
+            if (run_len > best_len) {
+                best_start = run_start;
+                best_len = run_len;
+            }
+            run_len = 0;
+            if (c == '[') {
+                // Skip the bracket expression ("[]...]" and "[!]...]" include the ])
+                i++;
+                if (pattern[i] == '!' || pattern[i] == '^') i++;
+                if (pattern[i] == ']') i++;
+                while (pattern[i] && pattern[i] != ']') i++;
+            } else if (c == '\\' && pattern[i + 1]) {
+                i++;
+            }
+            if (pattern[i]) i++;
+            run_start = i;
+            continue;
+        }
+        run_len++;
+        i++;
+    }
+    if (run_len > best_len) {
+        best_start = run_start;
+        best_len = run_len;
+    }
+    if (best_len >= out_size) {
+        best_len = out_size - 1;
+    }
+    memcpy(out, pattern + best_start, (size_t)best_len);
+    out[best_len] = '\0';
+    return best_len;
+}
+
+// Whether ancestor is the parent of id (direct) or any directory above it
+static bool record_under(const PathIndex *index, uint32_t id, uint32_t ancestor, bool direct)
+{
+    uint32_t parent = index->records[id].parent;
+    if (direct) {
+        return parent == ancestor;
+    }
+    while (parent != NO_RECORD) {
+        if (parent == ancestor) {
+            return true;
+        }
+        parent = index->records[parent].parent;
+    }
+    return false;
+}
+
+// Helper: Name test of path_index_find
+static bool glob_matches(const char *name, void *context)
+{
+    return fnmatch((const char *)context, name, 0) == 0;
+}
+
+// Helper: Take id as a find result if its name matches and it sits under root.
+// Returns false once the results are full
+static bool find_consider(const PathIndex *index, uint32_t id, uint32_t root, PathIndexNameMatch match,
+                          void *context, bool recursive, int max_results, uint32_t *found, int *found_count,
+                          bool *more)
+{
+    const PathRecord *record = &index->records[id];
+    if (!record->listed || id == root ||
+        !match(record_name(index, record), context) ||
+        !record_under(index, id, root, !recursive) || !record_alive(index, id)) {
+        return true;
+    }
+    if (*found_count == max_results) {
+        *more = true;
+        return false;
+    }
+    found[(*found_count)++] = id;
+    return true;
+}
+
+// Helper: path_index_find with any name test; literal (literal_len bytes) is text every
+// matching name contains, used to narrow the scan through the trigram lists when long enough
+static bool find_matching(PathIndex *index, const char *root, PathIndexNameMatch match, void *context,
+                          const char *literal, int literal_len, bool recursive, int max_results,
+                          PathIndexResults *results)
+{
+    if (results == NULL) {
+        return false;
+    }
+    memset(results, 0, sizeof(*results));
+    if (index == NULL || root == NULL || match == NULL || max_results <= 0) {
+        return false;
+    }
+
+    uint32_t *found = malloc((size_t)max_results * sizeof(uint32_t));
+    char *scratch = malloc(PATH_INDEX_MAX_PATH);
+    if (found == NULL || scratch == NULL) {
+        free(found);
+        free(scratch);
+        return false;
+    }
+
+    pthread_mutex_lock(&index->mutex);
+
+    uint32_t root_id = resolve_locked(index, root, false);
+    if (root_id == NO_RECORD || !record_alive(index, root_id)) {
+        pthread_mutex_unlock(&index->mutex);
+        free(found);
+        free(scratch);
+        return false;
+    }
+
+    int found_count = 0;
+    bool more = false;
+    if (literal_len >= 3) {
+        // Only records holding every trigram of the literal can match
+        const Posting *lists[MAX_QUERY_TRIGRAMS];
+        int list_count = 0;
+        for (int i = 0; i + 3 <= literal_len && list_count < MAX_QUERY_TRIGRAMS; i++) {
+            const Posting *posting = &index->postings[trigram_key(literal + i)];
+            bool seen = false;
+            for (int j = 0; j < list_count; j++) {
+                if (lists[j] == posting) seen = true;
+            }
+            if (!seen) lists[list_count++] = posting;
+        }
+        qsort(lists, list_count, sizeof(lists[0]), posting_compare);
+        PostingCursor cursors[MAX_QUERY_TRIGRAMS];
+        for (int j = 0; j < list_count; j++) {
+            cursor_init(&cursors[j], lists[j]);
+        }
+        for (; cursors[0].valid; cursor_next(&cursors[0])) {
+            uint32_t id = cursors[0].value;
+            bool in_all = true;
+            for (int j = 1; j < list_count && in_all; j++) {
+                in_all = cursor_seek(&cursors[j], id);
+            }
+            if (in_all && !find_consider(index, id, root_id, match, context, recursive, max_results,
+                                         found, &found_count, &more)) {
+                break;
+            }
+        }
+    } else {
+        for (uint32_t id = 0; id < index->record_count; id++) {
+            if (!find_consider(index, id, root_id, match, context, recursive, max_results,
+                               found, &found_count, &more)) {
+                break;
+            }
+        }
+    }
+
+    results->paths = calloc(found_count > 0 ? found_count : 1, sizeof(char *));
+    results->scores = calloc(found_count > 0 ? found_count : 1, sizeof(int));
+    bool ok = results->paths != NULL && results->scores != NULL;
+    for (int i = 0; ok && i < found_count; i++) {
+        if (build_path(index, found[i], scratch, PATH_INDEX_MAX_PATH) < 0 ||
+            (results->paths[i] = strdup(scratch)) == NULL) {
+            ok = false;
+            break;
+        }
+        results->count++;
+    }
+    results->total = found_count + (more ? 1 : 0);
+
+    pthread_mutex_unlock(&index->mutex);
+
+    free(found);
+    free(scratch);
+    if (!ok) {
+        path_index_results_free(results);
+        return false;
+    }
+    return true;
+}
+
+bool path_index_find(PathIndex *index, const char *root, const char *pattern, bool recursive,
+                     int max_results, PathIndexResults *results)
+{
+    if (pattern == NULL) {
+        if (results) memset(results, 0, sizeof(*results));
+        return false;
+    }
+    char literal[PATH_INDEX_MAX_PATH];
+    int literal_len = glob_literal(pattern, literal, sizeof(literal));
+    return find_matching(index, root, glob_matches, (void *)pattern, literal, literal_len, recursive,
+                         max_results, results);
+}
+
+bool path_index_find_names(PathIndex *index, const char *root, PathIndexNameMatch match, void *context,
+                           bool recursive, int max_results, PathIndexResults *results)
+{
+    return find_matching(index, root, match, context, NULL, 0, recursive, max_results, results);
+}
+
+void path_index_results_free(PathIndexResults *results)
+{
+    if (results == NULL) {
+        return;
+    }
+    for (int i = 0; i < results->count; i++) {
+        free(results->paths[i]);
+    }
+    free(results->paths);
+    free(results->scores);
+    memset(results, 0, sizeof(*results));
+}
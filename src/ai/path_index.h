@@ -0,0 +1,71 @@
+#ifndef PATH_INDEX_H
+#define PATH_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Recursive filename index of every path under the indexer's watch roots.
+// Names are searched by case-insensitive substring through trigram posting lists
+
+// Maximum stored path length
+#define PATH_INDEX_MAX_PATH 4096
+
+// Query results (paths are owned by the results)
+typedef struct PathIndexResults {
+    char **paths;           // Best matches, highest score first
+    int *scores;
+    int count;
+    int total;              // All matching paths, including those beyond count
+} PathIndexResults;
+
+// Path index context (opaque)
+typedef struct PathIndex PathIndex;
+
+// Create an index backed by file_path, loading it if it exists (NULL keeps it in memory only)
+PathIndex* path_index_open(const char *file_path);
+
+// Free the index (does not save)
+void path_index_close(PathIndex *index);
+
+// Write the index to its backing file
+bool path_index_save(PathIndex *index);
+
+// Add a path (no-op if already present)
+bool path_index_add(PathIndex *index, const char *path);
+
+// Remove a path and everything below it
+void path_index_remove(PathIndex *index, const char *path);
+
+// Number of indexed paths
+int path_index_count(PathIndex *index);
+
+// Paths added or removed since the index was opened (it moves whenever there is
+// something new to save)
+uint64_t path_index_changes(PathIndex *index);
+
+// Start a full rescan: paths not re-added before path_index_end_scan are dropped
+void path_index_begin_scan(PathIndex *index);
+void path_index_end_scan(PathIndex *index);
+
+// Find paths whose name contains every space-separated term of query (case-insensitive);
+// a term with "/" matches a name prefix after it and a parent path suffix before it
+bool path_index_query(PathIndex *index, const char *query, int max_results, PathIndexResults *results);
+
+// Find paths below root (only its direct children unless recursive) whose name matches
+// the fnmatch glob pattern, stopping once max_results are found; total is then one more
+// than count if any were left. Results are unordered and unscored. False if root is not
+// in the index
+bool path_index_find(PathIndex *index, const char *root, const char *pattern, bool recursive,
+                     int max_results, PathIndexResults *results);
+
+// Name test for path_index_find_names
+typedef bool (*PathIndexNameMatch)(const char *name, void *context);
+
+// path_index_find with a name test of the caller's instead of a glob (every name is tested)
+bool path_index_find_names(PathIndex *index, const char *root, PathIndexNameMatch match, void *context,
+                           bool recursive, int max_results, PathIndexResults *results);
+
+// Free query results
+void path_index_results_free(PathIndexResults *results);
+
+#endif // PATH_INDEX_H
@@ -0,0 +1,310 @@
+#include "query_cache.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct QueryCacheEntry {
+    char *text;
+    uint64_t used;              // Tick of the last lookup or store
+} QueryCacheEntry;
+
+struct QueryCache {
+    int dimension;
+    int capacity;
+    QueryEncodeFn encode;
+    void *context;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        // Prefetch posted, encode finished, or stopping
+
+    QueryCacheEntry *entries;
+    float *vectors;             // capacity * dimension, entry i at i * dimension
+    int count;
+    uint64_t tick;
+
+    // Prefetch thread, started by the first prefetch
+    pthread_t thread;
+    bool thread_started;
+    bool stopping;
+    char *pending;              // Text waiting out the debounce (NULL if none)
+    struct timespec pending_due;
+    char *encoding;             // Text the thread is encoding (NULL when idle)
+    float *scratch;             // The thread's output vector
+};
+
+// Helper: realtime clock plus sec, as pthread_cond_timedwait takes it
+static struct timespec deadline_after(double sec)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    long long nsec = ts.tv_nsec + (long long)(sec * 1e9);
+    ts.tv_sec += (time_t)(nsec / 1000000000LL);
+    ts.tv_nsec = (long)(nsec % 1000000000LL);
+    return ts;
+}
+
+static bool deadline_passed(const struct timespec *due)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec > due->tv_sec || (now.tv_sec == due->tv_sec && now.tv_nsec >= due->tv_nsec);
+}
+
+// Helper: index of text, or -1 (call with mutex held)
+static int find_locked(const QueryCache *cache, const char *text)
+{
+    for (int i = 0; i < cache->count; i++) {
+        if (strcmp(cache->entries[i].text, text) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Helper: copy entry i out and mark it used (call with mutex held)
+static void read_locked(QueryCache *cache, int i, float *out)
+{
+    cache->entries[i].used = ++cache->tick;
+    memcpy(out, cache->vectors + (size_t)i * (size_t)cache->dimension,
+           (size_t)cache->dimension * sizeof(float));
+}
+
+// Helper: insert or refresh text, evicting the least recently used entry when full
+// (call with mutex held)
+static void store_locked(QueryCache *cache, const char *text, const float *vector)
+{
+    int slot = find_locked(cache, text);
+    if (slot < 0) {
+        char *copy = strdup(text);
+        if (copy == NULL) {
+            return;
+        }
+        if (cache->count < cache->capacity) {
+            slot = cache->count++;
+        } else {
+            slot = 0;
+            for (int i = 1; i < cache->count; i++) {
+                if (cache->entries[i].used < cache->entries[slot].used) {
+                    slot = i;
+                }
+            }
+            free(cache->entries[slot].text);
+        }
+        cache->entries[slot].text = copy;
+    }
+    cache->entries[slot].used = ++cache->tick;
+    memcpy(cache->vectors + (size_t)slot * (size_t)cache->dimension, vector,
+           (size_t)cache->dimension * sizeof(float));
+}
+
+static void *prefetch_thread(void *arg)
+{
+    QueryCache *cache = arg;
+
+    pthread_mutex_lock(&cache->mutex);
+    while (!cache->stopping) {
+        if (cache->pending == NULL) {
+            pthread_cond_wait(&cache->cond, &cache->mutex);
+            continue;
+        }
+        if (!deadline_passed(&cache->pending_due)) {
+            // A newer prefetch moves the deadline, so check again after waking
+            struct timespec due = cache->pending_due;
+            pthread_cond_timedwait(&cache->cond, &cache->mutex, &due);
+            continue;
+        }
+
+        char *text = cache->pending;
+        cache->pending = NULL;
+        if (find_locked(cache, text) >= 0) {
+            free(text);
+            continue;
+        }
+
+        cache->encoding = text;
+        pthread_mutex_unlock(&cache->mutex);
+        bool ok = cache->encode(cache->context, text, cache->scratch);
+        pthread_mutex_lock(&cache->mutex);
+
+        if (ok) {
+            store_locked(cache, text, cache->scratch);
+        }
+        cache->encoding = NULL;
+        free(text);
+        pthread_cond_broadcast(&cache->cond);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return NULL;
+}
+
+QueryCache* query_cache_create(int dimension, int capacity, QueryEncodeFn encode, void *context)
+{
+    if (dimension <= 0 || capacity <= 0 || encode == NULL) {
+        return NULL;
+    }
+
+    QueryCache *cache = calloc(1, sizeof(QueryCache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    cache->dimension = dimension;
+    cache->capacity = capacity;
+    cache->encode = encode;
+    cache->context = context;
+    cache->entries = calloc((size_t)capacity, sizeof(QueryCacheEntry));
+    cache->vectors = malloc((size_t)capacity * (size_t)dimension * sizeof(float));
+    cache->scratch = malloc((size_t)dimension * sizeof(float));
+    if (cache->entries == NULL || cache->vectors == NULL || cache->scratch == NULL) {
+        free(cache->entries);
+        free(cache->vectors);
+        free(cache->scratch);
+        free(cache);
+        return NULL;
+    }
+
+    pthread_mutex_init(&cache->mutex, NULL);
+    pthread_cond_init(&cache->cond, NULL);
+    return cache;
+}
+
+void query_cache_destroy(QueryCache *cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    cache->stopping = true;
+    pthread_cond_broadcast(&cache->cond);
+    pthread_mutex_unlock(&cache->mutex);
+    if (cache->thread_started) {
+        pthread_join(cache->thread, NULL);
+    }
+
+    for (int i = 0; i < cache->count; i++) {
+        free(cache->entries[i].text);
+    }
+    free(cache->pending);
+    free(cache->entries);
+    free(cache->vectors);
+    free(cache->scratch);
+    pthread_cond_destroy(&cache->cond);
+    pthread_mutex_destroy(&cache->mutex);
+    free(cache);
+}
+
+bool query_cache_lookup(QueryCache *cache, const char *text, float *out)
+{
+    if (cache == NULL || text == NULL || out == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    int i = find_locked(cache, text);
+    if (i >= 0) {
+        read_locked(cache, i, out);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return i >= 0;
+}
+
+bool query_cache_encode(QueryCache *cache, const char *text, float *out)
+{
+    if (cache == NULL || text == NULL || out == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    while (cache->encoding != NULL && strcmp(cache->encoding, text) == 0) {
+        pthread_cond_wait(&cache->cond, &cache->mutex);
+    }
+    int i = find_locked(cache, text);
+    if (i >= 0) {
+        read_locked(cache, i, out);
+        pthread_mutex_unlock(&cache->mutex);
+        return true;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    if (!cache->encode(cache->context, text, out)) {
+        return false;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    store_locked(cache, text, out);
+    pthread_mutex_unlock(&cache->mutex);
+    return true;
+}
+
+void query_cache_prefetch(QueryCache *cache, const char *text)
+{
+    if (cache == NULL || text == NULL || text[0] == '\0') {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    free(cache->pending);
+    cache->pending = NULL;
+
+    bool queued = false;
+    if (find_locked(cache, text) < 0 &&
+        (cache->encoding == NULL || strcmp(cache->encoding, text) != 0)) {
+        cache->pending = strdup(text);
+        cache->pending_due = deadline_after(QUERY_CACHE_DEBOUNCE_SEC);
+        queued = cache->pending != NULL;
+    }
+
+    if (queued && !cache->thread_started) {
+        cache->thread_started = pthread_create(&cache->thread, NULL, prefetch_thread, cache) == 0;
+    }
+    if (queued) {
+        pthread_cond_broadcast(&cache->cond);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+bool query_cache_contains(QueryCache *cache, const char *text)
+{
+    if (cache == NULL || text == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    bool found = find_locked(cache, text) >= 0;
+    pthread_mutex_unlock(&cache->mutex);
+    return found;
+}
+
+void query_cache_clear(QueryCache *cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    free(cache->pending);
+    cache->pending = NULL;
+    while (cache->encoding != NULL) {
+        pthread_cond_wait(&cache->cond, &cache->mutex);
+    }
+    for (int i = 0; i < cache->count; i++) {
+        free(cache->entries[i].text);
+        cache->entries[i].text = NULL;
+    }
+    cache->count = 0;
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+int query_cache_count(QueryCache *cache)
+{
+    if (cache == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    int count = cache->count;
+    pthread_mutex_unlock(&cache->mutex);
+    return count;
+}
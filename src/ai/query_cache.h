@@ -0,0 +1,51 @@
+#ifndef QUERY_CACHE_H
+#define QUERY_CACHE_H
+
+#include <stdbool.h>
+
+// Embeddings of recent search queries, least recently used dropped first, so retyping a
+// query or switching search type skips the encoder. A background thread can also encode
+// a query ahead of time, once the text stops changing, so the search itself only looks
+// the embedding up
+
+// Queries kept per cache
+#define QUERY_CACHE_CAPACITY 64
+
+// Seconds the text must stay unchanged before a prefetch starts encoding
+#define QUERY_CACHE_DEBOUNCE_SEC 0.15
+
+// Encode text into out (dimension floats); false on failure. Called from the prefetch
+// thread as well as the caller's
+typedef bool (*QueryEncodeFn)(void *context, const char *text, float *out);
+
+// Query cache context (opaque)
+typedef struct QueryCache QueryCache;
+
+// Create a cache of capacity embeddings of dimension floats made by encode
+QueryCache* query_cache_create(int dimension, int capacity, QueryEncodeFn encode, void *context);
+
+// Stop the prefetch thread and free the cache
+void query_cache_destroy(QueryCache *cache);
+
+// Copy a cached embedding to out; false on a miss
+bool query_cache_lookup(QueryCache *cache, const char *text, float *out);
+
+// Cached embedding, or encode and cache it. If a prefetch is already encoding the
+// same text, waits for it instead of encoding twice
+bool query_cache_encode(QueryCache *cache, const char *text, float *out);
+
+// Encode text in the background after QUERY_CACHE_DEBOUNCE_SEC without another
+// prefetch. A newer prefetch replaces one still waiting
+void query_cache_prefetch(QueryCache *cache, const char *text);
+
+// Whether text is cached, so query_cache_encode returns without encoding
+bool query_cache_contains(QueryCache *cache, const char *text);
+
+// Drop every embedding and any pending prefetch, after waiting out one being encoded
+// (call before changing what encode uses)
+void query_cache_clear(QueryCache *cache);
+
+// Number of cached embeddings
+int query_cache_count(QueryCache *cache);
+
+#endif // QUERY_CACHE_H
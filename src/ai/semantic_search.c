@@ -1,4 +1,6 @@
 #include "semantic_search.h"
+#include "vector_index.h"
+#include "query_cache.h"
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -8,9 +10,25 @@ struct SemanticSearch {
     EmbeddingEngine *embedding_engine;
     VectorDB *vectordb;
     Indexer *indexer;
+    QueryCache *queries;    // Recent query embeddings
     bool initialized;
 };
 
+// Helper: query encoder for the cache (normalized, as the stored embeddings are)
+static bool encode_query(void *context, const char *text, float *out)
+{
+    SemanticSearch *search = context;
+    if (search->embedding_engine == NULL) {
+        return false;
+    }
+    EmbeddingResult result = embedding_generate(search->embedding_engine, text);
+    if (result.status != EMBEDDING_STATUS_OK) {
+        return false;
+    }
+    memcpy(out, result.embedding, sizeof(result.embedding));
+    return true;
+}
+
 SemanticSearch* semantic_search_create(void)
 {
     SemanticSearch *search = calloc(1, sizeof(SemanticSearch));
@@ -18,6 +36,7 @@ SemanticSearch* semantic_search_create(void)
         return NULL;
     }
 
+    search->queries = query_cache_create(EMBEDDING_DIMENSION, QUERY_CACHE_CAPACITY, encode_query, search);
     search->initialized = true;
     return search;
 }
@@ -28,6 +47,9 @@ void semantic_search_destroy(SemanticSearch *search)
         return;
     }
 
+    // Stops the prefetch thread before the engine can go away
+    query_cache_destroy(search->queries);
+
     // We don't own the engine, db, or indexer - just clear refs
     search->embedding_engine = NULL;
     search->vectordb = NULL;
@@ -41,6 +63,8 @@ void semantic_search_set_embedding_engine(SemanticSearch *search, EmbeddingEngin
     if (search == NULL) {
         return;
     }
+    // Embeddings from another engine would not match
+    query_cache_clear(search->queries);
     search->embedding_engine = engine;
 }
 
@@ -67,7 +91,9 @@ SemanticSearchOptions semantic_search_default_options(void)
         .min_score = 0.0f,
         .directory = NULL,
         .file_type = FILE_TYPE_UNKNOWN,
-        .sort_by_score = true
+        .sort_by_score = true,
+        .ef_search = VECTOR_INDEX_DEFAULT_EF,
+        .hybrid = true
     };
     return options;
 }
@@ -81,6 +107,25 @@ static SemanticSearchResults create_error_result(const char *error)
 }
 
 // Helper function to get time in milliseconds
+static SemanticSearchResults search_embedding(SemanticSearch *search,
+                                              const float *embedding,
+                                              const char *text,
+                                              const SemanticSearchOptions *options);
+
+// Helper: embedding of a query through the cache
+static EmbeddingStatus query_embedding(SemanticSearch *search, const char *query, float *out)
+{
+    if (query_cache_encode(search->queries, query, out)) {
+        return EMBEDDING_STATUS_OK;
+    }
+    // No cache, or encoding failed: encode directly, which also says why
+    EmbeddingResult result = embedding_generate(search->embedding_engine, query);
+    if (result.status == EMBEDDING_STATUS_OK) {
+        memcpy(out, result.embedding, sizeof(result.embedding));
+    }
+    return result.status;
+}
+
 static float get_time_ms(void)
 {
     struct timespec ts;
@@ -100,7 +145,7 @@ SemanticSearchResults semantic_search_query(SemanticSearch *search,
         return create_error_result("No embedding engine set");
     }
 
-    if (!embedding_engine_is_loaded(search->embedding_engine)) {
+    if (!embedding_engine_is_available(search->embedding_engine)) {
         return create_error_result("Embedding model not loaded");
     }
 
@@ -122,14 +167,15 @@ SemanticSearchResults semantic_search_query(SemanticSearch *search,
 
     float start_time = get_time_ms();
 
-    // Generate query embedding
-    EmbeddingResult embed_result = embedding_generate(search->embedding_engine, query);
-    if (embed_result.status != EMBEDDING_STATUS_OK) {
-        return create_error_result(embedding_status_message(embed_result.status));
+    // Query embedding, from the cache when typed before or prefetched
+    float embedding[EMBEDDING_DIMENSION];
+    EmbeddingStatus status = query_embedding(search, query, embedding);
+    if (status != EMBEDDING_STATUS_OK) {
+        return create_error_result(embedding_status_message(status));
     }
 
     // Perform search
-    SemanticSearchResults results = semantic_search_by_embedding(search, embed_result.embedding, &opts);
+    SemanticSearchResults results = search_embedding(search, embedding, opts.hybrid ? query : NULL, &opts);
 
     // Store query and timing
     strncpy(results.query, query, sizeof(results.query) - 1);
@@ -141,6 +187,15 @@ SemanticSearchResults semantic_search_query(SemanticSearch *search,
 SemanticSearchResults semantic_search_by_embedding(SemanticSearch *search,
                                                     const float *embedding,
                                                     const SemanticSearchOptions *options)
+{
+    return search_embedding(search, embedding, NULL, options);
+}
+
+// Helper: search by embedding, fused with a full-text match of text when given
+static SemanticSearchResults search_embedding(SemanticSearch *search,
+                                              const float *embedding,
+                                              const char *text,
+                                              const SemanticSearchOptions *options)
 {
     SemanticSearchResults results = {0};
 
@@ -168,11 +223,14 @@ SemanticSearchResults semantic_search_by_embedding(SemanticSearch *search,
 
     // Perform vector search
     VectorSearchResults vresults;
-    if (opts.directory != NULL) {
+    if (text != NULL) {
+        vresults = vectordb_search_hybrid(search->vectordb, embedding, text, opts.directory,
+                                          opts.max_results, opts.ef_search);
+    } else if (opts.directory != NULL) {
         vresults = vectordb_search_in_directory(search->vectordb, embedding,
                                                  opts.directory, opts.max_results);
     } else {
-        vresults = vectordb_search(search->vectordb, embedding, opts.max_results);
+        vresults = vectordb_search_ann(search->vectordb, embedding, opts.max_results, opts.ef_search);
     }
 
     if (vresults.status != VECTORDB_STATUS_OK) {
@@ -190,8 +248,8 @@ SemanticSearchResults semantic_search_by_embedding(SemanticSearch *search,
     for (int i = 0; i < vresults.count; i++) {
         VectorSearchResult *vr = &vresults.results[i];
 
-        // Apply filters
-        if (vr->similarity < opts.min_score) {
+        // Apply filters; a word-for-word match stands on its own
+        if (vr->similarity < opts.min_score && !vr->text_match) {
             continue;
         }
 
@@ -206,6 +264,9 @@ SemanticSearchResults semantic_search_by_embedding(SemanticSearch *search,
         sr->file_type = vr->file.file_type;
         sr->size = vr->file.size;
         sr->score = vr->similarity;
+        sr->section_offset = vr->has_section ? vr->section_offset : -1;
+        strncpy(sr->section, vr->section_title, sizeof(sr->section) - 1);
+        sr->text_match = vr->text_match;
         results.count++;
     }
 
@@ -263,6 +324,20 @@ SemanticSearchResults semantic_search_similar_to_file(SemanticSearch *search,
     return results;
 }
 
+void semantic_search_prefetch(SemanticSearch *search, const char *query)
+{
+    if (search == NULL || search->embedding_engine == NULL ||
+        !embedding_engine_is_available(search->embedding_engine)) {
+        return;
+    }
+    query_cache_prefetch(search->queries, query);
+}
+
+bool semantic_search_is_prefetched(SemanticSearch *search, const char *query)
+{
+    return search != NULL && query_cache_contains(search->queries, query);
+}
+
 void semantic_search_results_free(SemanticSearchResults *results)
 {
     if (results == NULL) {
@@ -283,7 +358,7 @@ bool semantic_search_is_ready(const SemanticSearch *search)
         return false;
     }
 
-    if (search->embedding_engine == NULL || !embedding_engine_is_loaded(search->embedding_engine)) {
+    if (search->embedding_engine == NULL || !embedding_engine_is_available(search->embedding_engine)) {
         return false;
     }
 
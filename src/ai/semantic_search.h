@@ -17,6 +17,9 @@ typedef struct SemanticSearchResult {
     IndexedFileType file_type;
     int64_t size;
     float score;           // Similarity score (0-1)
+    char section[VECTORDB_SECTION_TITLE_SIZE];  // Best-matching heading or definition ("" if none)
+    int64_t section_offset;                     // Byte offset of the matching section, -1 for the whole file
+    bool text_match;                            // Query words found in its name or text
 } SemanticSearchResult;
 
 // Search results array
@@ -37,6 +40,9 @@ typedef struct SemanticSearchOptions {
     const char *directory;     // Limit search to this directory (NULL for all)
     IndexedFileType file_type; // Filter by file type (FILE_TYPE_UNKNOWN for all)
     bool sort_by_score;        // Sort by score (default: true)
+    int ef_search;             // ANN recall/latency knob: higher = better recall (default: 64, 0 = exact)
+    bool hybrid;               // Text queries also match names and text word for word, fused
+                               // with the vector ranking (default: true)
 } SemanticSearchOptions;
 
 // Semantic search context (opaque)
@@ -72,6 +78,13 @@ SemanticSearchResults semantic_search_similar_to_file(SemanticSearch *search,
                                                        const char *file_path,
                                                        const SemanticSearchOptions *options);
 
+// Encode a query in the background once typing pauses, so a following
+// semantic_search_query for the same text skips the encoder
+void semantic_search_prefetch(SemanticSearch *search, const char *query);
+
+// Whether the query's embedding is ready, so semantic_search_query only searches
+bool semantic_search_is_prefetched(SemanticSearch *search, const char *query);
+
 // Free search results
 void semantic_search_results_free(SemanticSearchResults *results);
 
@@ -1,5 +1,14 @@
 #include "smart_rename.h"
 #include "../api/claude_client.h"
+#include "../core/move_batch.h"
+#include "../core/operation_queue.h"
+#include "../core/stat_cache.h"
+#include "../core/undo_log.h"
+#include "../platform/imageio.h"
+#include "../utils/jobs.h"
+#include "../utils/file_type.h"
+#include "content_extract.h"
+#include "vectordb.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,14 +16,44 @@
 #include <sys/stat.h>
 #include <time.h>
 #include <libgen.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
-// Undo history for last batch rename
-static struct {
-    char original_paths[RENAME_MAX_FILES][1024];
-    char new_paths[RENAME_MAX_FILES][1024];
+// Journal of the last batch rename, for undo
+#define RENAME_JOURNAL_NAME "rename.journal"
+
+// Files read by one hint extraction job
+#define RENAME_HINT_BATCH 8
+
+// Longest heading, line or folder name put in a hint
+#define RENAME_HINT_TEXT_LEN 96
+
+// Nearest indexed files looked at for a file's cluster
+#define RENAME_NEIGHBOURS 8
+
+// Prompt space for one file: its number, name and hint
+#define RENAME_PROMPT_LINE_LEN (RENAME_MAX_NAME_LEN + 32 + RENAME_HINT_LEN + 16)
+
+// Upper bound on config->max_concurrent
+#define RENAME_MAX_CONCURRENT 8
+
+// Files whose hints one job extracts
+typedef struct HintJob {
+    RenameSuggestion *suggestions;
+    int count;
+    int max_bytes;
+    bool use_content;
+    bool use_metadata;
+} HintJob;
+
+// Chunks of one batch, shared by the threads sending them
+typedef struct RenameRequests {
+    RenameSuggestion *suggestions;
     int count;
-    bool valid;
-} undo_history = {0};
+    const char *api_key;
+    atomic_int next_chunk;              // Next chunk to send
+    atomic_int succeeded;               // Chunks whose request succeeded
+} RenameRequests;
 
 // Initialize configuration with defaults
 void smart_rename_config_init(SmartRenameConfig *config)
@@ -65,7 +104,7 @@ bool smart_rename_request_add_file(BatchRenameRequest *request, const char *path
 
     // Check if file exists
     struct stat st;
-    if (stat(path, &st) != 0) return false;
+    if (!stat_cache_stat(path, &st)) return false;
 
     // Expand capacity if needed
     if (request->count >= request->capacity) {
@@ -247,21 +286,215 @@ void smart_rename_format_name(const char *name, RenameFormat format, char *outpu
     }
 }
 
-// Read file content preview
-static bool read_file_preview(const char *path, char *buffer, size_t max_size)
+// Read the start of a file; returns how many bytes (buffer is NUL-terminated)
+static size_t read_file_preview(const char *path, char *buffer, size_t max_size)
 {
-    FILE *f = fopen(path, "r");
-    if (!f) return false;
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
 
     size_t len = fread(buffer, 1, max_size - 1, f);
     buffer[len] = '\0';
     fclose(f);
-    return len > 0;
+    return len;
+}
+
+// Helper: copy length bytes of text into out as one line, control characters as spaces
+// and runs of spaces collapsed; cut to fit out_size
+static void copy_one_line(char *out, size_t out_size, const char *text, size_t length)
+{
+    size_t j = 0;
+    for (size_t i = 0; i < length && text[i] && j < out_size - 1; i++) {
+        char c = text[i];
+        if (iscntrl((unsigned char)c) || c == '"') c = ' ';
+        if (c == ' ' && (j == 0 || out[j - 1] == ' ')) continue;
+        out[j++] = c;
+    }
+    while (j > 0 && out[j - 1] == ' ') j--;
+    out[j] = '\0';
+}
+
+// Helper: add "label text" to a hint, separated by "; "
+static void append_hint(char *hint, size_t hint_size, const char *label, const char *text)
+{
+    if (!text[0]) return;
+    size_t used = strlen(hint);
+    snprintf(hint + used, hint_size - used, "%s%s %s", used > 0 ? "; " : "", label, text);
+}
+
+// Helper: hint from the start of a text file: the first heading of markdown, otherwise
+// the first line with something on it
+static void text_hint(RenameSuggestion *s, const char *ext, int max_bytes)
+{
+    char *buffer = malloc((size_t)max_bytes + 1);
+    if (!buffer) return;
+
+    size_t len = read_file_preview(s->original_path, buffer, (size_t)max_bytes + 1);
+    if (len == 0 || !content_is_text(buffer, len)) {
+        free(buffer);
+        return;
+    }
+
+    bool markdown = content_format_for_file(ext, false) == CONTENT_FORMAT_MARKDOWN;
+    char line[RENAME_HINT_TEXT_LEN];
+    char first[RENAME_HINT_TEXT_LEN] = "";
+    bool in_fence = false;
+    for (const char *p = buffer; *p;) {
+        size_t line_len = strcspn(p, "\n");
+        if (markdown && (strncmp(p, "```", 3) == 0 || strncmp(p, "~~~", 3) == 0)) {
+            in_fence = !in_fence;
+        } else if (markdown && !in_fence && *p == '#') {
+            size_t skip = strspn(p, "#");
+            copy_one_line(line, sizeof(line), p + skip, line_len - skip);
+            if (line[0]) {
+                append_hint(s->hint, sizeof(s->hint), "heading", line);
+                break;
+            }
+        }
+        if (!first[0]) {
+            copy_one_line(first, sizeof(first), p, line_len);
+            if (first[0] && !markdown) break;
+        }
+        p += line_len + (p[line_len] == '\n');
+    }
+    if (!s->hint[0]) {
+        append_hint(s->hint, sizeof(s->hint), "starts", first);
+    }
+    free(buffer);
+}
+
+// Helper: hint for one file from its own bytes (capture info for photos, text for text)
+static void file_hint(RenameSuggestion *s, const HintJob *job)
+{
+    char ext[16] = "";
+    if (s->extension[0] == '.') {
+        for (int i = 0; s->extension[i + 1] && i < (int)sizeof(ext) - 1; i++) {
+            ext[i] = (char)tolower((unsigned char)s->extension[i + 1]);
+            ext[i + 1] = '\0';
+        }
+    }
+
+    IndexedFileType type = vectordb_file_type_from_extension(ext);
+    if (type == FILE_TYPE_IMAGE) {
+        char date[32], camera[128];
+        if (job->use_metadata && platform_image_capture_info(s->original_path, date, sizeof(date),
+                                                             camera, sizeof(camera))) {
+            append_hint(s->hint, sizeof(s->hint), "taken", date);
+            append_hint(s->hint, sizeof(s->hint), "with", camera);
+        }
+    } else if (job->use_content && (type == FILE_TYPE_TEXT || type == FILE_TYPE_CODE ||
+                                    type == FILE_TYPE_UNKNOWN)) {
+        text_hint(s, ext, job->max_bytes);
+    }
+}
+
+// Helper: extract the hints of one job's files (runs on a worker)
+static void hint_job_run(void *arg, JobToken *token)
+{
+    HintJob *job = arg;
+    for (int i = 0; i < job->count && !job_token_cancelled(token); i++) {
+        job->suggestions[i].hint[0] = '\0';
+        file_hint(&job->suggestions[i], job);
+    }
+}
+
+// Helper: name of the folder holding path, without the rest of its path
+static void parent_folder_name(const char *path, char *out, size_t out_size)
+{
+    const char *end = strrchr(path, '/');
+    const char *start = end;
+    while (start && start > path && start[-1] != '/') start--;
+    size_t len = start && end ? (size_t)(end - start) : 0;
+    if (len >= out_size) len = out_size - 1;
+    memcpy(out, start ? start : "", len);
+    out[len] = '\0';
 }
 
-// Build prompt for Claude to suggest names
+// Helper: the folder that at least two of a file's nearest indexed neighbours elsewhere
+// share (its cluster in the vector DB); false if it is not indexed or they scatter
+static bool cluster_hint(VectorDB *db, const char *path, char *out, size_t out_size)
+{
+    IndexedFile file;
+    if (vectordb_get_file(db, path, &file) != VECTORDB_STATUS_OK || !file.has_embedding) {
+        return false;
+    }
+
+    const char *own_slash = strrchr(path, '/');
+    size_t own_dir_len = own_slash ? (size_t)(own_slash - path) : 0;
+
+    VectorSearchResults results = vectordb_search(db, file.embedding, RENAME_NEIGHBOURS);
+    char folders[RENAME_NEIGHBOURS][RENAME_HINT_TEXT_LEN];
+    int folder_count = 0;
+    for (int i = 0; i < results.count && folder_count < RENAME_NEIGHBOURS; i++) {
+        const char *neighbour = results.results[i].file.path;
+        const char *slash = strrchr(neighbour, '/');
+        if (slash && (size_t)(slash - neighbour) == own_dir_len && strncmp(neighbour, path, own_dir_len) == 0) {
+            continue;
+        }
+        parent_folder_name(neighbour, folders[folder_count], sizeof(folders[0]));
+        if (folders[folder_count][0]) folder_count++;
+    }
+    vector_search_results_free(&results);
+
+    int best = -1, best_votes = 1;
+    for (int i = 0; i < folder_count; i++) {
+        int votes = 0;
+        for (int j = 0; j < folder_count; j++) {
+            votes += strcmp(folders[i], folders[j]) == 0;
+        }
+        if (votes > best_votes) {
+            best = i;
+            best_votes = votes;
+        }
+    }
+    if (best < 0) return false;
+    copy_one_line(out, out_size, folders[best], sizeof(folders[0]));
+    return true;
+}
+
+// Fill in each file's hint
+void smart_rename_extract_hints(BatchRenameRequest *request, const SmartRenameConfig *config)
+{
+    if (!request || !config || request->count == 0) return;
+
+    // Files are read in batches on the job scheduler (inline before it starts)
+    int job_count = (request->count + RENAME_HINT_BATCH - 1) / RENAME_HINT_BATCH;
+    HintJob *jobs = calloc(job_count, sizeof(HintJob));
+    JobToken *token = job_token_create();
+    for (int j = 0; jobs && j < job_count; j++) {
+        HintJob *job = &jobs[j];
+        job->suggestions = &request->suggestions[j * RENAME_HINT_BATCH];
+        job->count = request->count - j * RENAME_HINT_BATCH;
+        if (job->count > RENAME_HINT_BATCH) job->count = RENAME_HINT_BATCH;
+        job->max_bytes = config->max_content_bytes > 0 ? config->max_content_bytes : 4096;
+        job->use_content = request->use_content;
+        job->use_metadata = request->use_metadata;
+        if (token) {
+            jobs_submit(JOB_QOS_USER_INITIATED, hint_job_run, NULL, job, token);
+        } else {
+            hint_job_run(job, NULL);
+        }
+    }
+    if (token) {
+        job_token_wait(token);
+        job_token_release(token);
+    }
+    free(jobs);
+
+    // The database is asked on this thread, after the files are read
+    if (config->vectordb && request->use_content) {
+        for (int i = 0; i < request->count; i++) {
+            RenameSuggestion *s = &request->suggestions[i];
+            char folder[RENAME_HINT_TEXT_LEN];
+            if (cluster_hint(config->vectordb, s->original_path, folder, sizeof(folder))) {
+                append_hint(s->hint, sizeof(s->hint), "similar files in", folder);
+            }
+        }
+    }
+}
+
+// Build prompt for Claude to suggest names for count files
 static void build_rename_prompt(const RenameSuggestion *suggestions, int count,
-                                 bool use_content, char *prompt, size_t prompt_size)
+                                 char *prompt, size_t prompt_size)
 {
     char *p = prompt;
     size_t remaining = prompt_size;
@@ -278,28 +511,16 @@ static void build_rename_prompt(const RenameSuggestion *suggestions, int count,
     p += written;
     remaining -= written;
 
-    for (int i = 0; i < count && remaining > 512; i++) {
+    for (int i = 0; i < count && remaining > RENAME_PROMPT_LINE_LEN + 256; i++) {
         written = snprintf(p, remaining, "%d. \"%s%s\"",
                            i + 1, suggestions[i].original_name, suggestions[i].extension);
         p += written;
         remaining -= written;
 
-        // Add content preview if available and requested
-        if (use_content) {
-            char content[512];
-            if (read_file_preview(suggestions[i].original_path, content, sizeof(content))) {
-                // Truncate and sanitize content
-                for (int j = 0; content[j]; j++) {
-                    if (content[j] == '\n' || content[j] == '\r') content[j] = ' ';
-                }
-                if (strlen(content) > 100) {
-                    content[100] = '\0';
-                    strcat(content, "...");
-                }
-                written = snprintf(p, remaining, " (content: %s)", content);
-                p += written;
-                remaining -= written;
-            }
+        if (suggestions[i].hint[0]) {
+            written = snprintf(p, remaining, " (%s)", suggestions[i].hint);
+            p += written;
+            remaining -= written;
         }
 
         written = snprintf(p, remaining, "\n");
@@ -384,6 +605,62 @@ static int parse_rename_response(const char *response, RenameSuggestion *suggest
     return parsed;
 }
 
+// Helper: ask for names for one chunk of files and merge them in; false if the request failed
+static bool send_rename_chunk(ClaudeClient *client, RenameSuggestion *suggestions, int count,
+                              char *prompt, ClaudeMessageRequest *req, ClaudeMessageResponse *resp)
+{
+    build_rename_prompt(suggestions, count, prompt, CLAUDE_MAX_MESSAGE_LEN);
+
+    claude_request_init(req);
+    claude_response_init(resp);
+    claude_request_set_priority(req, API_PRIORITY_BACKGROUND);
+    claude_request_set_feature(req, CLAUDE_FEATURE_RENAME);
+    claude_request_set_system_prompt(req, "You are a helpful file naming assistant. Respond only with valid JSON.");
+    claude_request_add_user_message(req, prompt);
+
+    bool success = claude_send_message(client, req, resp) && resp->stop_reason != CLAUDE_STOP_ERROR;
+    if (success) {
+        // Indexes in the response count from the chunk's first file
+        parse_rename_response(resp->content, suggestions, count);
+    }
+
+    claude_request_cleanup(req);
+    claude_response_cleanup(resp);
+    return success;
+}
+
+// Helper: send chunks until none are left (runs on the calling thread and helpers)
+static void *rename_request_worker(void *arg)
+{
+    RenameRequests *work = arg;
+
+    ClaudeClient *client = claude_client_create(work->api_key);
+    char *prompt = malloc(CLAUDE_MAX_MESSAGE_LEN);
+    ClaudeMessageRequest *req = malloc(sizeof(ClaudeMessageRequest));
+    ClaudeMessageResponse *resp = malloc(sizeof(ClaudeMessageResponse));
+
+    for (;;) {
+        int start = atomic_fetch_add(&work->next_chunk, 1) * RENAME_CHUNK_FILES;
+        if (start >= work->count) break;
+        int count = work->count - start < RENAME_CHUNK_FILES ? work->count - start : RENAME_CHUNK_FILES;
+
+        if (client && prompt && req && resp &&
+            send_rename_chunk(client, &work->suggestions[start], count, prompt, req, resp)) {
+            atomic_fetch_add(&work->succeeded, 1);
+        } else {
+            for (int i = start; i < start + count; i++) {
+                work->suggestions[i].status = RENAME_STATUS_API_ERROR;
+            }
+        }
+    }
+
+    free(resp);
+    free(req);
+    free(prompt);
+    claude_client_destroy(client);
+    return NULL;
+}
+
 // Generate AI suggestions for files
 SmartRenameStatus smart_rename_generate_suggestions(BatchRenameRequest *request,
                                                      const SmartRenameConfig *config)
@@ -398,33 +675,33 @@ SmartRenameStatus smart_rename_generate_suggestions(BatchRenameRequest *request,
         return smart_rename_apply_pattern(request, "%name%");
     }
 
-    // Build prompt
-    char prompt[8192];
-    build_rename_prompt(request->suggestions, request->count, request->use_content, prompt, sizeof(prompt));
-
-    // Create Claude client and send request
-    ClaudeClient *client = claude_client_create(config->api_key);
-    if (!client) {
-        return RENAME_STATUS_API_ERROR;
+    // Compact features instead of file text keep every chunk's prompt small
+    if (request->use_content || request->use_metadata) {
+        smart_rename_extract_hints(request, config);
     }
 
-    ClaudeMessageRequest req;
-    ClaudeMessageResponse resp;
-    claude_request_init(&req);
-    claude_response_init(&resp);
-
-    claude_request_set_system_prompt(&req, "You are a helpful file naming assistant. Respond only with valid JSON.");
-    claude_request_add_user_message(&req, prompt);
-
-    bool success = claude_send_message(client, &req, &resp);
-
-    if (success && resp.stop_reason != CLAUDE_STOP_ERROR) {
-        parse_rename_response(resp.content, request->suggestions, request->count);
+    RenameRequests work = {0};
+    work.suggestions = request->suggestions;
+    work.count = request->count;
+    work.api_key = config->api_key;
+    atomic_init(&work.next_chunk, 0);
+    atomic_init(&work.succeeded, 0);
+
+    int chunks = (request->count + RENAME_CHUNK_FILES - 1) / RENAME_CHUNK_FILES;
+    int concurrent = config->max_concurrent < chunks ? config->max_concurrent : chunks;
+    if (concurrent > RENAME_MAX_CONCURRENT) concurrent = RENAME_MAX_CONCURRENT;
+
+    // One chunk needs no helpers
+    pthread_t threads[RENAME_MAX_CONCURRENT];
+    int started = 0;
+    while (started < concurrent - 1 &&
+           pthread_create(&threads[started], NULL, rename_request_worker, &work) == 0) {
+        started++;
+    }
+    rename_request_worker(&work);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
     }
-
-    claude_request_cleanup(&req);
-    claude_response_cleanup(&resp);
-    claude_client_destroy(client);
 
     // Apply format if specified
     if (request->format != RENAME_FORMAT_ORIGINAL) {
@@ -437,7 +714,7 @@ SmartRenameStatus smart_rename_generate_suggestions(BatchRenameRequest *request,
         }
     }
 
-    return success ? RENAME_STATUS_OK : RENAME_STATUS_API_ERROR;
+    return atomic_load(&work.succeeded) > 0 ? RENAME_STATUS_OK : RENAME_STATUS_API_ERROR;
 }
 
 // Generate suggestions using a pattern
@@ -473,7 +750,7 @@ void smart_rename_expand_pattern(const char *pattern, const char *path, int inde
     if (!pattern || !path || !output || output_size == 0) return;
 
     struct stat st;
-    if (stat(path, &st) != 0) {
+    if (!stat_cache_stat(path, &st)) {
         strncpy(output, pattern, output_size - 1);
         output[output_size - 1] = '\0';
         return;
@@ -508,10 +785,13 @@ void smart_rename_expand_pattern(const char *pattern, const char *path, int inde
     const char *type = "file";
     if (S_ISDIR(st.st_mode)) type = "folder";
     else if (ext) {
-        if (strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".png") == 0) type = "image";
-        else if (strcasecmp(ext, ".mp4") == 0 || strcasecmp(ext, ".mov") == 0) type = "video";
-        else if (strcasecmp(ext, ".pdf") == 0) type = "document";
-        else if (strcasecmp(ext, ".c") == 0 || strcasecmp(ext, ".py") == 0) type = "code";
+        switch (file_type_class(file_type_from_extension(ext))) {
+            case FILE_CLASS_IMAGE: type = "image"; break;
+            case FILE_CLASS_VIDEO: type = "video"; break;
+            case FILE_CLASS_DOCUMENT: type = "document"; break;
+            case FILE_CLASS_CODE: type = "code"; break;
+            default: break;
+        }
     }
 
     // Get size string
@@ -608,41 +888,36 @@ bool smart_rename_preview(BatchRenameRequest *request)
     return !has_conflicts;
 }
 
-// Execute rename operation
-BatchRenameResult smart_rename_execute(BatchRenameRequest *request)
+// Helper: Plan every accepted rename as one batch in a new undo group and save it as
+// the journal. move_suggestions gets the suggestion index of each move; the rest are counted in skipped
+static MoveBatch *plan_renames(const BatchRenameRequest *request, int *move_suggestions, int *skipped,
+                               char *journal, size_t journal_size)
 {
-    BatchRenameResult result = {0};
-    if (!request) {
-        result.status = RENAME_STATUS_NOT_INITIALIZED;
-        return result;
+    if (!move_batch_journal_path(RENAME_JOURNAL_NAME, journal, journal_size)) {
+        return NULL;
+    }
+    MoveBatch *batch = move_batch_create();
+    if (!batch) {
+        return NULL;
     }
 
-    result.total_files = request->count;
-
-    // Clear undo history
-    undo_history.count = 0;
-    undo_history.valid = false;
-
+    *skipped = 0;
     for (int i = 0; i < request->count; i++) {
-        RenameSuggestion *s = &request->suggestions[i];
+        const RenameSuggestion *s = &request->suggestions[i];
 
-        if (!s->accepted) {
-            result.skipped_count++;
-            continue;
-        }
-
-        if (s->has_conflict) {
-            result.skipped_count++;
+        if (!s->accepted || s->has_conflict) {
+            (*skipped)++;
             continue;
         }
 
         // Build new path
         char dir[1024];
         strncpy(dir, s->original_path, sizeof(dir) - 1);
+        dir[sizeof(dir) - 1] = '\0';
         char *last_slash = strrchr(dir, '/');
         if (last_slash) *last_slash = '\0';
 
-        char new_path[1024];
+        char new_path[2048];
         if (request->preserve_extension) {
             snprintf(new_path, sizeof(new_path), "%s/%s%s", dir, s->suggested_name, s->extension);
         } else {
@@ -651,20 +926,54 @@ BatchRenameResult smart_rename_execute(BatchRenameRequest *request)
 
         // Skip if same name
         if (strcmp(new_path, s->original_path) == 0) {
-            result.skipped_count++;
+            (*skipped)++;
             continue;
         }
 
-        // Perform rename
-        if (rename(s->original_path, new_path) == 0) {
-            result.renamed_count++;
+        move_suggestions[move_batch_count(batch)] = i;
+        if (!move_batch_add(batch, s->original_path, new_path)) {
+            move_batch_free(batch);
+            return NULL;
+        }
+    }
 
-            // Store in undo history
-            if (undo_history.count < RENAME_MAX_FILES) {
-                strncpy(undo_history.original_paths[undo_history.count], s->original_path, 1023);
-                strncpy(undo_history.new_paths[undo_history.count], new_path, 1023);
-                undo_history.count++;
-            }
+    move_batch_set_undo_group(batch, undo_log_begin(undo_log_shared(), UNDO_SOURCE_RENAME, "Batch rename"));
+    if (!move_batch_save(batch, journal)) {
+        move_batch_free(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+// Execute rename operation
+BatchRenameResult smart_rename_execute(BatchRenameRequest *request)
+{
+    BatchRenameResult result = {0};
+    if (!request) {
+        result.status = RENAME_STATUS_NOT_INITIALIZED;
+        return result;
+    }
+
+    result.total_files = request->count;
+
+    char journal[1024];
+    int *move_suggestions = malloc((size_t)(request->count + 1) * sizeof(int));
+    MoveBatch *batch = move_suggestions ? plan_renames(request, move_suggestions, &result.skipped_count,
+                                                       journal, sizeof(journal)) : NULL;
+    if (!batch) {
+        free(move_suggestions);
+        snprintf(result.error_message, sizeof(result.error_message), "Cannot write the rename journal");
+        result.status = RENAME_STATUS_FILE_ERROR;
+        return result;
+    }
+
+    // A name taken since the preview fails that rename instead of replacing the file
+    MoveBatchResult renamed;
+    move_batch_run(batch, journal, NULL, &renamed);
+    for (int m = 0; m < move_batch_count(batch); m++) {
+        RenameSuggestion *s = &request->suggestions[move_suggestions[m]];
+        if (move_batch_done(batch, m, NULL, 0)) {
+            result.renamed_count++;
 
             // Learn from this rename
             smart_rename_learn(s->original_name, s->suggested_name);
@@ -673,29 +982,52 @@ BatchRenameResult smart_rename_execute(BatchRenameRequest *request)
             s->status = RENAME_STATUS_FILE_ERROR;
         }
     }
+    if (renamed.error_message[0] != '\0') {
+        snprintf(result.error_message, sizeof(result.error_message), "%s", renamed.error_message);
+    }
+    move_batch_free(batch);
+    free(move_suggestions);
 
-    undo_history.valid = (undo_history.count > 0);
     result.status = (result.error_count == 0) ? RENAME_STATUS_OK : RENAME_STATUS_FILE_ERROR;
     return result;
 }
 
-// Undo last batch rename
-bool smart_rename_undo(void)
+int smart_rename_queue_execute(BatchRenameRequest *request, OperationQueue *queue)
 {
-    if (!undo_history.valid || undo_history.count == 0) {
-        return false;
+    if (!request || !queue || request->count == 0) {
+        return -1;
     }
 
-    int undone = 0;
-    for (int i = 0; i < undo_history.count; i++) {
-        if (rename(undo_history.new_paths[i], undo_history.original_paths[i]) == 0) {
-            undone++;
-        }
+    char journal[1024];
+    int skipped;
+    int *move_suggestions = malloc((size_t)(request->count + 1) * sizeof(int));
+    MoveBatch *batch = move_suggestions ? plan_renames(request, move_suggestions, &skipped,
+                                                       journal, sizeof(journal)) : NULL;
+    if (!batch) {
+        free(move_suggestions);
+        return -1;
+    }
+    for (int m = 0; m < move_batch_count(batch); m++) {
+        const RenameSuggestion *s = &request->suggestions[move_suggestions[m]];
+        smart_rename_learn(s->original_name, s->suggested_name);
     }
+    move_batch_free(batch);
+    free(move_suggestions);
+
+    // Shown in the queue as the folder of the first file
+    char folder[1024];
+    strncpy(folder, request->suggestions[0].original_path, sizeof(folder) - 1);
+    folder[sizeof(folder) - 1] = '\0';
+    char *last_slash = strrchr(folder, '/');
+    if (last_slash) *last_slash = '\0';
+    return operation_queue_move_batch(queue, journal, folder);
+}
 
-    undo_history.valid = false;
-    undo_history.count = 0;
-    return undone > 0;
+// Undo last batch rename
+bool smart_rename_undo(void)
+{
+    UndoResult result;
+    return undo_log_undo_last(undo_log_shared(), UNDO_SOURCE_RENAME, &result);
 }
 
 // Accept suggestion
@@ -4,8 +4,18 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+// Forward declarations
+struct OperationQueue;
+struct VectorDB;
+
 // Maximum number of files for batch rename
-#define RENAME_MAX_FILES 100
+#define RENAME_MAX_FILES 1000
+
+// Files per suggestion request; larger batches are split and sent concurrently
+#define RENAME_CHUNK_FILES 40
+
+// Length of a file's content hint in the prompt
+#define RENAME_HINT_LEN 160
 
 // Maximum length of suggested name
 #define RENAME_MAX_NAME_LEN 256
@@ -37,6 +47,7 @@ typedef struct RenameSuggestion {
     char suggested_name[RENAME_MAX_NAME_LEN]; // AI-suggested name
     char extension[32];             // File extension (preserved)
     char reason[256];               // Why this name was suggested
+    char hint[RENAME_HINT_LEN];     // What the file holds, for the prompt (see smart_rename_extract_hints)
     float confidence;               // 0.0 - 1.0 confidence score
     bool accepted;                  // User accepted this suggestion
     bool has_conflict;              // Would conflict with existing file
@@ -73,6 +84,7 @@ typedef struct SmartRenameConfig {
     int max_content_bytes;          // Max bytes to read for content context
     int max_concurrent;             // Max concurrent API requests
     float min_confidence;           // Minimum confidence to suggest (0.0 - 1.0)
+    struct VectorDB *vectordb;      // Names files by their nearest indexed neighbours (optional)
 } SmartRenameConfig;
 
 // Initialize configuration with defaults
@@ -87,7 +99,15 @@ void smart_rename_request_free(BatchRenameRequest *request);
 // Add file to batch rename request
 bool smart_rename_request_add_file(BatchRenameRequest *request, const char *path);
 
-// Generate AI suggestions for files (uses Claude API)
+// Fill in each file's hint from a few signals rather than its text: capture date and
+// camera for photos, the first heading or line of text files, and the
+// folder its nearest neighbours in config->vectordb share. Files are read in parallel
+// on the job scheduler, at most config->max_content_bytes each
+void smart_rename_extract_hints(BatchRenameRequest *request, const SmartRenameConfig *config);
+
+// Generate AI suggestions for files (uses Claude API). Files go out RENAME_CHUNK_FILES
+// per request, up to config->max_concurrent requests at once; a file whose request
+// failed keeps its name and gets RENAME_STATUS_API_ERROR
 SmartRenameStatus smart_rename_generate_suggestions(BatchRenameRequest *request,
                                                      const SmartRenameConfig *config);
 
@@ -101,10 +121,15 @@ void smart_rename_format_name(const char *name, RenameFormat format, char *outpu
 // Preview rename operation (check for conflicts)
 bool smart_rename_preview(BatchRenameRequest *request);
 
-// Execute rename operation
+// Execute rename operation: the renames run as one batch (see move_batch.h); one whose
+// new name was taken since the preview fails rather than replacing the file
 BatchRenameResult smart_rename_execute(BatchRenameRequest *request);
 
-// Undo last batch rename (if within session)
+// Queue the renames on the operation queue as one batch operation. Returns its
+// operation ID, or -1
+int smart_rename_queue_execute(BatchRenameRequest *request, struct OperationQueue *queue);
+
+// Undo last batch rename, from the undo log
 bool smart_rename_undo(void);
 
 // Accept/reject individual suggestions
@@ -1,5 +1,13 @@
 #include "summarize.h"
+#include "content_extract.h"
 #include "../api/claude_client.h"
+#include "../utils/file_hash.h"
+#include "../utils/file_type.h"
+#include "../utils/jobs.h"
+#include "model_manager.h"
+#include "extract_pool.h"
+#include "../../external/cJSON/cJSON.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,68 +17,99 @@
 #include <sqlite3.h>
 #include <CommonCrypto/CommonDigest.h>
 
-// File extension to type mapping
-typedef struct TypeMapping {
-    const char *ext;
-    SummaryFileType type;
-} TypeMapping;
-
-static const TypeMapping TYPE_MAP[] = {
-    // Text
-    {".txt", SUMM_TYPE_TEXT},
-    {".rtf", SUMM_TYPE_TEXT},
-    {".log", SUMM_TYPE_TEXT},
-
-    // Code
-    {".c", SUMM_TYPE_CODE},
-    {".h", SUMM_TYPE_CODE},
-    {".cpp", SUMM_TYPE_CODE},
-    {".hpp", SUMM_TYPE_CODE},
-    {".py", SUMM_TYPE_CODE},
-    {".js", SUMM_TYPE_CODE},
-    {".ts", SUMM_TYPE_CODE},
-    {".java", SUMM_TYPE_CODE},
-    {".go", SUMM_TYPE_CODE},
-    {".rs", SUMM_TYPE_CODE},
-    {".rb", SUMM_TYPE_CODE},
-    {".php", SUMM_TYPE_CODE},
-    {".swift", SUMM_TYPE_CODE},
-    {".kt", SUMM_TYPE_CODE},
-    {".cs", SUMM_TYPE_CODE},
-    {".sh", SUMM_TYPE_CODE},
-    {".bash", SUMM_TYPE_CODE},
-    {".zsh", SUMM_TYPE_CODE},
-
-    // Documents
-    {".pdf", SUMM_TYPE_DOCUMENT},
-    {".doc", SUMM_TYPE_DOCUMENT},
-    {".docx", SUMM_TYPE_DOCUMENT},
-    {".odt", SUMM_TYPE_DOCUMENT},
-
-    // Markdown
-    {".md", SUMM_TYPE_MARKDOWN},
-    {".markdown", SUMM_TYPE_MARKDOWN},
-    {".rst", SUMM_TYPE_MARKDOWN},
-
-    // Data
-    {".json", SUMM_TYPE_DATA},
-    {".xml", SUMM_TYPE_DATA},
-    {".yaml", SUMM_TYPE_DATA},
-    {".yml", SUMM_TYPE_DATA},
-    {".csv", SUMM_TYPE_DATA},
-    {".toml", SUMM_TYPE_DATA},
-
-    // Images
-    {".jpg", SUMM_TYPE_IMAGE},
-    {".jpeg", SUMM_TYPE_IMAGE},
-    {".png", SUMM_TYPE_IMAGE},
-    {".gif", SUMM_TYPE_IMAGE},
-    {".webp", SUMM_TYPE_IMAGE},
-    {".bmp", SUMM_TYPE_IMAGE},
-
-    {NULL, SUMM_TYPE_UNKNOWN}
+// Summary file types by file type class
+static const SummaryFileType SUMMARY_TYPES[FILE_CLASS_COUNT] = {
+    [FILE_CLASS_NONE] = SUMM_TYPE_UNKNOWN,
+    [FILE_CLASS_TEXT] = SUMM_TYPE_TEXT,
+    [FILE_CLASS_MARKDOWN] = SUMM_TYPE_MARKDOWN,
+    [FILE_CLASS_CODE] = SUMM_TYPE_CODE,
+    [FILE_CLASS_DATA] = SUMM_TYPE_DATA,
+    [FILE_CLASS_DOCUMENT] = SUMM_TYPE_DOCUMENT,
+    [FILE_CLASS_SPREADSHEET] = SUMM_TYPE_UNKNOWN,
+    [FILE_CLASS_PRESENTATION] = SUMM_TYPE_UNKNOWN,
+    [FILE_CLASS_IMAGE] = SUMM_TYPE_IMAGE,
+    [FILE_CLASS_VIDEO] = SUMM_TYPE_UNKNOWN,
+    [FILE_CLASS_AUDIO] = SUMM_TYPE_UNKNOWN,
+    [FILE_CLASS_ARCHIVE] = SUMM_TYPE_UNKNOWN,
+    [FILE_CLASS_INSTALLER] = SUMM_TYPE_UNKNOWN,
+    [FILE_CLASS_DATABASE] = SUMM_TYPE_UNKNOWN,
+    [FILE_CLASS_FONT] = SUMM_TYPE_UNKNOWN,
+    [FILE_CLASS_APPLICATION] = SUMM_TYPE_UNKNOWN,
 };
 
+// Claude client shared by every summary with the same API key
+typedef struct SharedClient {
+    ClaudeClient *client;
+    struct SharedClient *next;
+} SharedClient;
+
+// Shared clients live until summarize_shutdown, so a summary in flight never loses its
+// client to a request made with another key
+static struct {
+    pthread_mutex_t mutex;
+    SharedClient *clients;
+    LocalLLM *llm;                      // On-device model, acquired on the first brief summary
+    bool llm_acquired;
+} g_summarize = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+// Helper: Get the shared client for api_key, creating it on first use; NULL on failure
+static ClaudeClient *summarize_client(const char *api_key)
+{
+    pthread_mutex_lock(&g_summarize.mutex);
+    ClaudeClient *client = NULL;
+    for (SharedClient *shared = g_summarize.clients; shared; shared = shared->next) {
+        if (strcmp(shared->client->api_key, api_key) == 0) {
+            client = shared->client;
+            break;
+        }
+    }
+
+    if (!client) {
+        SharedClient *shared = calloc(1, sizeof(SharedClient));
+        if (shared) {
+            shared->client = claude_client_create(api_key);
+            if (shared->client) {
+                shared->next = g_summarize.clients;
+                g_summarize.clients = shared;
+                client = shared->client;
+            } else {
+                free(shared);
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_summarize.mutex);
+
+    return client;
+}
+
+// Helper: The shared on-device model, or NULL if none is installed or built in
+static LocalLLM *summarize_llm(void)
+{
+    pthread_mutex_lock(&g_summarize.mutex);
+    if (!g_summarize.llm_acquired) {
+        g_summarize.llm = model_manager_acquire_llm();
+        g_summarize.llm_acquired = true;
+    }
+    LocalLLM *llm = local_llm_is_available(g_summarize.llm) ? g_summarize.llm : NULL;
+    pthread_mutex_unlock(&g_summarize.mutex);
+    return llm;
+}
+
+void summarize_shutdown(void)
+{
+    pthread_mutex_lock(&g_summarize.mutex);
+    while (g_summarize.clients) {
+        SharedClient *shared = g_summarize.clients;
+        g_summarize.clients = shared->next;
+        claude_client_destroy(shared->client);
+        free(shared);
+    }
+    model_manager_release_llm(g_summarize.llm);
+    g_summarize.llm = NULL;
+    g_summarize.llm_acquired = false;
+    pthread_mutex_unlock(&g_summarize.mutex);
+}
+
 // Initialize default configuration
 void summarize_config_init(SummarizeConfig *config)
 {
@@ -85,8 +124,80 @@ void summarize_config_init(SummarizeConfig *config)
     config->max_file_size = 10 * 1024 * 1024; // 10MB
     config->extract_key_points = true;
     config->include_metadata = false;
+    config->chunked = true;
+    config->local_brief = true;
 }
 
+// Summary kept in memory, valid while its file keeps the same mtime and size
+typedef struct SummaryMemorySlot {
+    char path[1024];
+    time_t file_modified;
+    uint64_t file_size;
+    char summary[SUMMARY_MAX_LENGTH];
+    SummaryLevel level;
+    uint64_t last_used;         // Tick of the latest hit; 0 for an empty slot
+} SummaryMemorySlot;
+
+struct SummaryCache {
+    sqlite3 *db;
+    bool initialized;
+    pthread_mutex_t mutex;      // Hover lookups on the UI thread, writes from summary workers
+
+    sqlite3_stmt *stmt_lookup;
+    sqlite3_stmt *stmt_store;
+    sqlite3_stmt *stmt_touch;
+    sqlite3_stmt *stmt_invalidate;
+    sqlite3_stmt *stmt_chunk_lookup;
+    sqlite3_stmt *stmt_chunk_store;
+
+    SummaryMemorySlot slots[SUMMARY_CACHE_MEMORY_SLOTS];
+    uint64_t tick;
+
+    // Writes waiting in the open transaction
+    int pending_writes;
+    time_t batch_started;
+};
+
+static const char *SQL_CREATE =
+    "CREATE TABLE IF NOT EXISTS summaries ("
+    "  path TEXT PRIMARY KEY,"
+    "  hash TEXT NOT NULL,"
+    "  summary TEXT NOT NULL,"
+    "  level INTEGER NOT NULL,"
+    "  created INTEGER NOT NULL,"
+    "  file_modified INTEGER NOT NULL,"
+    "  file_size INTEGER NOT NULL"
+    ");";
+
+// Summaries of the parts of long documents, by the hash of the part's text
+static const char *SQL_CREATE_CHUNKS =
+    "CREATE TABLE IF NOT EXISTS chunk_summaries ("
+    "  hash TEXT PRIMARY KEY,"
+    "  summary TEXT NOT NULL,"
+    "  created INTEGER NOT NULL"
+    ");";
+
+static const char *SQL_LOOKUP =
+    "SELECT hash, summary, level, file_modified, file_size FROM summaries WHERE path = ?;";
+
+static const char *SQL_STORE =
+    "INSERT OR REPLACE INTO summaries "
+    "(path, hash, summary, level, created, file_modified, file_size) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?);";
+
+// A file touched without changing keeps its summary under the new mtime and size
+static const char *SQL_TOUCH =
+    "UPDATE summaries SET file_modified = ?, file_size = ? WHERE path = ? AND hash = ?;";
+
+static const char *SQL_INVALIDATE =
+    "DELETE FROM summaries WHERE path = ?;";
+
+static const char *SQL_CHUNK_LOOKUP =
+    "SELECT summary FROM chunk_summaries WHERE hash = ?;";
+
+static const char *SQL_CHUNK_STORE =
+    "INSERT OR REPLACE INTO chunk_summaries (hash, summary, created) VALUES (?, ?, ?);";
+
 // Initialize summary cache
 SummaryCache *summary_cache_create(const char *cache_path)
 {
@@ -137,49 +248,177 @@ SummaryCache *summary_cache_create(const char *cache_path)
     free(dir);
 
     // Open SQLite database
-    sqlite3 *db;
-    if (sqlite3_open(expanded_path, &db) != SQLITE_OK) {
+    if (sqlite3_open(expanded_path, &cache->db) != SQLITE_OK) {
+        sqlite3_close(cache->db);
         free(cache);
         return NULL;
     }
 
-    // Create table
-    const char *create_sql =
-        "CREATE TABLE IF NOT EXISTS summaries ("
-        "  path TEXT PRIMARY KEY,"
-        "  hash TEXT NOT NULL,"
-        "  summary TEXT NOT NULL,"
-        "  level INTEGER NOT NULL,"
-        "  created INTEGER NOT NULL,"
-        "  file_modified INTEGER NOT NULL,"
-        "  file_size INTEGER NOT NULL"
-        ");";
-
-    char *err = NULL;
-    if (sqlite3_exec(db, create_sql, NULL, NULL, &err) != SQLITE_OK) {
-        sqlite3_free(err);
-        sqlite3_close(db);
+    // Losing the last batch of writes in a crash only costs regenerating those summaries
+    sqlite3_exec(cache->db, "PRAGMA journal_mode=WAL;", NULL, NULL, NULL);
+    sqlite3_exec(cache->db, "PRAGMA synchronous=NORMAL;", NULL, NULL, NULL);
+
+    if (sqlite3_exec(cache->db, SQL_CREATE, NULL, NULL, NULL) != SQLITE_OK ||
+        sqlite3_exec(cache->db, SQL_CREATE_CHUNKS, NULL, NULL, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(cache->db, SQL_LOOKUP, -1, &cache->stmt_lookup, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(cache->db, SQL_STORE, -1, &cache->stmt_store, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(cache->db, SQL_TOUCH, -1, &cache->stmt_touch, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(cache->db, SQL_INVALIDATE, -1, &cache->stmt_invalidate, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(cache->db, SQL_CHUNK_LOOKUP, -1, &cache->stmt_chunk_lookup, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(cache->db, SQL_CHUNK_STORE, -1, &cache->stmt_chunk_store, NULL) != SQLITE_OK) {
+        sqlite3_finalize(cache->stmt_lookup);
+        sqlite3_finalize(cache->stmt_store);
+        sqlite3_finalize(cache->stmt_touch);
+        sqlite3_finalize(cache->stmt_invalidate);
+        sqlite3_finalize(cache->stmt_chunk_lookup);
+        sqlite3_finalize(cache->stmt_chunk_store);
+        sqlite3_close(cache->db);
         free(cache);
         return NULL;
     }
 
-    cache->db = db;
+    pthread_mutex_init(&cache->mutex, NULL);
     cache->initialized = true;
     return cache;
 }
 
+// Helper: Commit the open write batch, if any (cache locked)
+static void commit_writes(SummaryCache *cache)
+{
+    if (cache->pending_writes > 0) {
+        sqlite3_exec(cache->db, "COMMIT;", NULL, NULL, NULL);
+        cache->pending_writes = 0;
+    }
+}
+
+// Helper: Count a write into the open batch, opening one first if needed (cache locked).
+// Call before the write's statement runs
+static void begin_write(SummaryCache *cache)
+{
+    if (cache->pending_writes == 0) {
+        sqlite3_exec(cache->db, "BEGIN;", NULL, NULL, NULL);
+        cache->batch_started = time(NULL);
+    }
+    cache->pending_writes++;
+}
+
+// Helper: Commit the batch if it is full or old enough (cache locked)
+static void maybe_commit_writes(SummaryCache *cache)
+{
+    if (cache->pending_writes >= SUMMARY_CACHE_BATCH_WRITES ||
+        (cache->pending_writes > 0 &&
+         time(NULL) - cache->batch_started >= SUMMARY_CACHE_BATCH_SECONDS)) {
+        commit_writes(cache);
+    }
+}
+
 // Close summary cache
 void summary_cache_destroy(SummaryCache *cache)
 {
     if (!cache) return;
-    if (cache->db) {
-        sqlite3_close(cache->db);
-    }
+
+    commit_writes(cache);
+    sqlite3_finalize(cache->stmt_lookup);
+    sqlite3_finalize(cache->stmt_store);
+    sqlite3_finalize(cache->stmt_touch);
+    sqlite3_finalize(cache->stmt_invalidate);
+    sqlite3_finalize(cache->stmt_chunk_lookup);
+    sqlite3_finalize(cache->stmt_chunk_store);
+    sqlite3_close(cache->db);
+    pthread_mutex_destroy(&cache->mutex);
     free(cache);
 }
 
+// Commit batched writes
+void summary_cache_flush(SummaryCache *cache)
+{
+    if (!cache || !cache->initialized) return;
+
+    pthread_mutex_lock(&cache->mutex);
+    commit_writes(cache);
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+size_t summary_cache_memory(SummaryCache *cache)
+{
+    if (!cache || !cache->initialized) return 0;
+
+    int current = 0;
+    int highwater = 0;
+    pthread_mutex_lock(&cache->mutex);
+    sqlite3_db_status(cache->db, SQLITE_DBSTATUS_CACHE_USED, &current, &highwater, 0);
+    pthread_mutex_unlock(&cache->mutex);
+    return current > 0 ? (size_t)current : 0;
+}
+
+void summary_cache_release_memory(SummaryCache *cache)
+{
+    if (!cache || !cache->initialized) return;
+
+    // Pages of the open write batch stay until it commits
+    pthread_mutex_lock(&cache->mutex);
+    commit_writes(cache);
+    sqlite3_db_release_memory(cache->db);
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+// Helper: The memory slot holding path, NULL if none (cache locked)
+static SummaryMemorySlot *find_slot(SummaryCache *cache, const char *path)
+{
+    for (int i = 0; i < SUMMARY_CACHE_MEMORY_SLOTS; i++) {
+        SummaryMemorySlot *slot = &cache->slots[i];
+        if (slot->last_used != 0 && strcmp(slot->path, path) == 0) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+// Helper: Keep a summary in memory, in the slot of its path or else the least recently
+// used one (cache locked)
+static void remember_summary(SummaryCache *cache, const char *path, time_t file_modified,
+                             uint64_t file_size, const char *summary, SummaryLevel level)
+{
+    SummaryMemorySlot *slot = find_slot(cache, path);
+    if (!slot) {
+        slot = &cache->slots[0];
+        for (int i = 1; i < SUMMARY_CACHE_MEMORY_SLOTS; i++) {
+            if (cache->slots[i].last_used < slot->last_used) {
+                slot = &cache->slots[i];
+            }
+        }
+    }
+
+    snprintf(slot->path, sizeof(slot->path), "%s", path);
+    slot->file_modified = file_modified;
+    slot->file_size = file_size;
+    snprintf(slot->summary, sizeof(slot->summary), "%s", summary);
+    slot->level = level;
+    slot->last_used = ++cache->tick;
+}
+
+// Helper: Fill result from a cache hit
+static void fill_hit(SummaryResult *result, const char *path, const char *summary, SummaryLevel level)
+{
+    strncpy(result->path, path, sizeof(result->path) - 1);
+    strncpy(result->summary, summary, sizeof(result->summary) - 1);
+    result->level = level;
+    result->file_type = summarize_detect_file_type(path);
+    result->from_cache = true;
+    result->status = SUMM_STATUS_OK;
+}
+
 // Compute file hash for cache validation
 static bool compute_file_hash(const char *path, char *hash_out)
+{
+    uint64_t hash;
+    if (!file_hash_compute(path, &hash)) return false;
+    file_hash_to_hex(hash, hash_out);
+    return true;
+}
+
+// SHA256 hash written by older versions of the cache (64 hex digits)
+static bool compute_legacy_file_hash(const char *path, char *hash_out)
 {
     FILE *f = fopen(path, "rb");
     if (!f) return false;
@@ -216,42 +455,74 @@ bool summary_cache_get(SummaryCache *cache, const char *path, SummaryResult *res
     struct stat st;
     if (stat(path, &st) != 0) return false;
 
-    // Query cache
-    sqlite3 *db = cache->db;
-    const char *sql = "SELECT hash, summary, level, created, file_modified, file_size "
-                      "FROM summaries WHERE path = ?";
+    pthread_mutex_lock(&cache->mutex);
+    maybe_commit_writes(cache);
 
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) return false;
+    SummaryMemorySlot *slot = find_slot(cache, path);
+    if (slot && slot->file_modified == st.st_mtime && slot->file_size == (uint64_t)st.st_size) {
+        slot->last_used = ++cache->tick;
+        fill_hit(result, path, slot->summary, slot->level);
+        pthread_mutex_unlock(&cache->mutex);
+        return true;
+    }
 
-    sqlite3_bind_text(stmt, 1, path, -1, SQLITE_STATIC);
+    // Query cache
+    sqlite3_stmt *stmt = cache->stmt_lookup;
+    sqlite3_reset(stmt);
+    sqlite3_bind_text(stmt, 1, path, -1, SQLITE_TRANSIENT);
 
     bool found = false;
+    bool changed = false;
+    char cached_hash[65] = "";
+    char *summary = NULL;
+    SummaryLevel level = SUMM_LEVEL_STANDARD;
     if (sqlite3_step(stmt) == SQLITE_ROW) {
-        const char *cached_hash = (const char *)sqlite3_column_text(stmt, 0);
-        time_t file_modified = sqlite3_column_int64(stmt, 4);
-        uint64_t file_size = sqlite3_column_int64(stmt, 5);
-
-        // Check if file has changed
-        if (file_modified == st.st_mtime && file_size == (uint64_t)st.st_size) {
-            // Verify hash for extra safety
-            char current_hash[65];
-            if (compute_file_hash(path, current_hash) &&
-                strcmp(current_hash, cached_hash) == 0) {
-                // Cache hit
-                strncpy(result->path, path, sizeof(result->path) - 1);
-                strncpy(result->summary, (const char *)sqlite3_column_text(stmt, 1),
-                        sizeof(result->summary) - 1);
-                result->level = sqlite3_column_int(stmt, 2);
-                result->file_type = summarize_detect_file_type(path);
-                result->from_cache = true;
-                result->status = SUMM_STATUS_OK;
-                found = true;
-            }
+        const char *hash = (const char *)sqlite3_column_text(stmt, 0);
+        const char *text = (const char *)sqlite3_column_text(stmt, 1);
+        level = sqlite3_column_int(stmt, 2);
+        time_t file_modified = sqlite3_column_int64(stmt, 3);
+        uint64_t file_size = sqlite3_column_int64(stmt, 4);
+
+        if (hash && text) {
+            snprintf(cached_hash, sizeof(cached_hash), "%s", hash);
+            summary = strdup(text);
+            found = summary != NULL;
+            changed = file_modified != st.st_mtime || file_size != (uint64_t)st.st_size;
+        }
+    }
+    sqlite3_reset(stmt);
+    pthread_mutex_unlock(&cache->mutex);
+
+    if (found && changed) {
+        // Touched or rewritten: only the content can tell (entries written before the
+        // fast hash keep SHA256)
+        char current_hash[65];
+        bool legacy = strlen(cached_hash) == 64;
+        bool hashed = legacy ? compute_legacy_file_hash(path, current_hash)
+                             : compute_file_hash(path, current_hash);
+        found = hashed && strcmp(current_hash, cached_hash) == 0;
+    }
+
+    if (found) {
+        pthread_mutex_lock(&cache->mutex);
+        if (changed) {
+            begin_write(cache);
+            stmt = cache->stmt_touch;
+            sqlite3_reset(stmt);
+            sqlite3_bind_int64(stmt, 1, st.st_mtime);
+            sqlite3_bind_int64(stmt, 2, st.st_size);
+            sqlite3_bind_text(stmt, 3, path, -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 4, cached_hash, -1, SQLITE_TRANSIENT);
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
         }
+        remember_summary(cache, path, st.st_mtime, (uint64_t)st.st_size, summary, level);
+        pthread_mutex_unlock(&cache->mutex);
+
+        fill_hit(result, path, summary, level);
     }
 
-    sqlite3_finalize(stmt);
+    free(summary);
     return found;
 }
 
@@ -268,42 +539,96 @@ bool summary_cache_put(SummaryCache *cache, const SummaryResult *result)
     char hash[65];
     if (!compute_file_hash(result->path, hash)) return false;
 
-    sqlite3 *db = cache->db;
-    const char *sql = "INSERT OR REPLACE INTO summaries "
-                      "(path, hash, summary, level, created, file_modified, file_size) "
-                      "VALUES (?, ?, ?, ?, ?, ?, ?)";
+    pthread_mutex_lock(&cache->mutex);
+    begin_write(cache);
 
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) return false;
-
-    sqlite3_bind_text(stmt, 1, result->path, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, hash, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, result->summary, -1, SQLITE_STATIC);
+    sqlite3_stmt *stmt = cache->stmt_store;
+    sqlite3_reset(stmt);
+    sqlite3_bind_text(stmt, 1, result->path, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, hash, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, result->summary, -1, SQLITE_TRANSIENT);
     sqlite3_bind_int(stmt, 4, result->level);
     sqlite3_bind_int64(stmt, 5, time(NULL));
     sqlite3_bind_int64(stmt, 6, st.st_mtime);
     sqlite3_bind_int64(stmt, 7, st.st_size);
 
     bool success = sqlite3_step(stmt) == SQLITE_DONE;
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
+
+    if (success) {
+        remember_summary(cache, result->path, st.st_mtime, (uint64_t)st.st_size,
+                         result->summary, result->level);
+    }
+    maybe_commit_writes(cache);
+    pthread_mutex_unlock(&cache->mutex);
 
     return success;
 }
 
+bool summary_cache_get_chunk(SummaryCache *cache, uint64_t hash, char *summary_out, size_t summary_size)
+{
+    if (!cache || !cache->initialized || !summary_out || summary_size == 0) return false;
+
+    char key[FILE_HASH_HEX_SIZE];
+    file_hash_to_hex(hash, key);
+
+    pthread_mutex_lock(&cache->mutex);
+    sqlite3_stmt *stmt = cache->stmt_chunk_lookup;
+    sqlite3_reset(stmt);
+    sqlite3_bind_text(stmt, 1, key, -1, SQLITE_TRANSIENT);
+    bool found = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *text = (const char *)sqlite3_column_text(stmt, 0);
+        if (text) {
+            snprintf(summary_out, summary_size, "%s", text);
+            found = true;
+        }
+    }
+    sqlite3_reset(stmt);
+    pthread_mutex_unlock(&cache->mutex);
+    return found;
+}
+
+bool summary_cache_put_chunk(SummaryCache *cache, uint64_t hash, const char *summary)
+{
+    if (!cache || !cache->initialized || !summary) return false;
+
+    char key[FILE_HASH_HEX_SIZE];
+    file_hash_to_hex(hash, key);
+
+    pthread_mutex_lock(&cache->mutex);
+    begin_write(cache);
+    sqlite3_stmt *stmt = cache->stmt_chunk_store;
+    sqlite3_reset(stmt);
+    sqlite3_bind_text(stmt, 1, key, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, summary, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 3, time(NULL));
+    bool success = sqlite3_step(stmt) == SQLITE_DONE;
+    sqlite3_reset(stmt);
+    maybe_commit_writes(cache);
+    pthread_mutex_unlock(&cache->mutex);
+    return success;
+}
+
 // Invalidate cache entry
 void summary_cache_invalidate(SummaryCache *cache, const char *path)
 {
     if (!cache || !cache->initialized || !path) return;
 
-    sqlite3 *db = cache->db;
-    const char *sql = "DELETE FROM summaries WHERE path = ?";
-
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-        sqlite3_bind_text(stmt, 1, path, -1, SQLITE_STATIC);
-        sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
+    pthread_mutex_lock(&cache->mutex);
+    SummaryMemorySlot *slot = find_slot(cache, path);
+    if (slot) {
+        memset(slot, 0, sizeof(SummaryMemorySlot));
     }
+
+    begin_write(cache);
+    sqlite3_stmt *stmt = cache->stmt_invalidate;
+    sqlite3_reset(stmt);
+    sqlite3_bind_text(stmt, 1, path, -1, SQLITE_TRANSIENT);
+    sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    maybe_commit_writes(cache);
+    pthread_mutex_unlock(&cache->mutex);
 }
 
 // Clear entire cache
@@ -311,25 +636,19 @@ void summary_cache_clear(SummaryCache *cache)
 {
     if (!cache || !cache->initialized) return;
 
-    sqlite3 *db = cache->db;
-    sqlite3_exec(db, "DELETE FROM summaries", NULL, NULL, NULL);
+    pthread_mutex_lock(&cache->mutex);
+    memset(cache->slots, 0, sizeof(cache->slots));
+    commit_writes(cache);
+    sqlite3_exec(cache->db, "DELETE FROM summaries", NULL, NULL, NULL);
+    sqlite3_exec(cache->db, "DELETE FROM chunk_summaries", NULL, NULL, NULL);
+    pthread_mutex_unlock(&cache->mutex);
 }
 
 // Get file type for summarization
 SummaryFileType summarize_detect_file_type(const char *path)
 {
     if (!path) return SUMM_TYPE_UNKNOWN;
-
-    const char *ext = strrchr(path, '.');
-    if (!ext) return SUMM_TYPE_UNKNOWN;
-
-    for (int i = 0; TYPE_MAP[i].ext; i++) {
-        if (strcasecmp(ext, TYPE_MAP[i].ext) == 0) {
-            return TYPE_MAP[i].type;
-        }
-    }
-
-    return SUMM_TYPE_UNKNOWN;
+    return SUMMARY_TYPES[file_type_class(file_type_from_path(path))];
 }
 
 // Check if file type is supported
@@ -339,9 +658,19 @@ bool summarize_is_supported(const char *path)
     return type != SUMM_TYPE_UNKNOWN && type != SUMM_TYPE_IMAGE;
 }
 
-// Read file content for summarization
+// Read file content for summarization; a document gives its text from the extractor pool
 static bool read_file_content(const char *path, char *content, size_t max_size, size_t *actual_size)
 {
+    if (extract_pool_handles(path)) {
+        char *text = NULL;
+        size_t len = 0;
+        if (!extract_pool_text(path, max_size - 1, &text, &len)) return false;
+        memcpy(content, text, len + 1);
+        free(text);
+        if (actual_size) *actual_size = len;
+        return true;
+    }
+
     FILE *f = fopen(path, "r");
     if (!f) return false;
 
@@ -353,6 +682,33 @@ static bool read_file_content(const char *path, char *content, size_t max_size,
     return len > 0;
 }
 
+// Helper: How long a summary of the given level should be
+static const char *length_instruction(SummaryLevel level)
+{
+    switch (level) {
+        case SUMM_LEVEL_BRIEF:
+            return "Provide a 1-2 sentence summary.";
+        case SUMM_LEVEL_STANDARD:
+            return "Provide a concise paragraph summary.";
+        case SUMM_LEVEL_DETAILED:
+            return "Provide a detailed summary with multiple paragraphs.";
+    }
+    return "";
+}
+
+// Helper: The Claude feature a summary of the given level is routed as
+static ClaudeFeature summary_feature(SummaryLevel level)
+{
+    switch (level) {
+        case SUMM_LEVEL_BRIEF:
+            return CLAUDE_FEATURE_HOVER_SUMMARY;
+        case SUMM_LEVEL_DETAILED:
+            return CLAUDE_FEATURE_DETAILED_SUMMARY;
+        default:
+            return CLAUDE_FEATURE_SUMMARY;
+    }
+}
+
 // Build summarization prompt
 static void build_summary_prompt(const char *content, SummaryFileType type, SummaryLevel level,
                                   bool extract_key_points, char *prompt, size_t prompt_size)
@@ -376,19 +732,6 @@ static void build_summary_prompt(const char *content, SummaryFileType type, Summ
             break;
     }
 
-    const char *length_instruction = "";
-    switch (level) {
-        case SUMM_LEVEL_BRIEF:
-            length_instruction = "Provide a 1-2 sentence summary.";
-            break;
-        case SUMM_LEVEL_STANDARD:
-            length_instruction = "Provide a concise paragraph summary.";
-            break;
-        case SUMM_LEVEL_DETAILED:
-            length_instruction = "Provide a detailed summary with multiple paragraphs.";
-            break;
-    }
-
     const char *key_points_instruction = "";
     if (extract_key_points) {
         key_points_instruction = "\n\nAlso list 3-5 key points as bullet points.";
@@ -396,7 +739,392 @@ static void build_summary_prompt(const char *content, SummaryFileType type, Summ
 
     snprintf(prompt, prompt_size,
              "%s\n\n%s%s\n\nContent to summarize:\n\n%s",
-             type_context, length_instruction, key_points_instruction, content);
+             type_context, length_instruction(level), key_points_instruction, content);
+}
+
+// Sections content_split is asked for at a time while cutting a document into parts
+#define SPLIT_SECTIONS 256
+
+// A part may end at a section whose opening bytes hash to 0 modulo this, once it holds
+// half of SUMMARY_CHUNK_TARGET
+#define CHUNK_BOUNDARY_ODDS 8
+
+// Bytes of a section's opening hashed to pick part boundaries
+#define CHUNK_BOUNDARY_BYTES 32
+
+// Longest summary kept for one part, and the reply size asked for
+#define CHUNK_SUMMARY_MAX 1536
+#define CHUNK_SUMMARY_TOKENS 300
+
+// Part summaries reduced in one request at most this many bytes at a time; more are
+// first combined in groups
+#define CHUNK_REDUCE_INPUT_MAX 24576
+
+// Helper: Whether a part may end before the section starting at text
+static bool chunk_boundary(const char *text, size_t length)
+{
+    size_t n = length < CHUNK_BOUNDARY_BYTES ? length : CHUNK_BOUNDARY_BYTES;
+    return file_hash_bytes(text, n, 0) % CHUNK_BOUNDARY_ODDS == 0;
+}
+
+// Helper: Add part [start, end) of data; false once chunks is full
+static bool add_part(const char *data, size_t start, size_t end, SummaryChunk *chunks, int *count, int max_chunks)
+{
+    if (end <= start) return true;
+    if (*count >= max_chunks) return false;
+    SummaryChunk *chunk = &chunks[(*count)++];
+    chunk->offset = start;
+    chunk->length = end - start;
+    chunk->hash = file_hash_bytes(data + start, chunk->length, 0);
+    return *count < max_chunks;
+}
+
+int summarize_split(const char *data, size_t size, SummaryFileType type,
+                    SummaryChunk *chunks, int max_chunks)
+{
+    if (!data || size == 0 || !chunks || max_chunks <= 0) return 0;
+
+    ContentFormat format = type == SUMM_TYPE_CODE ? CONTENT_FORMAT_CODE
+                         : type == SUMM_TYPE_MARKDOWN ? CONTENT_FORMAT_MARKDOWN : CONTENT_FORMAT_PLAIN;
+    ContentChunk *sections = malloc(SPLIT_SECTIONS * sizeof(ContentChunk));
+    if (!sections) return 0;
+
+    // Sections come a batch at a time; the last of a full batch may be cut short, so the
+    // next batch starts over from it
+    int count = 0;
+    size_t part_start = 0;
+    size_t base = 0;
+    bool room = true;
+    while (room && base < size) {
+        int n = content_split(data + base, size - base, format, sections, SPLIT_SECTIONS);
+        if (n <= 0) break;
+        bool full = n == SPLIT_SECTIONS;
+        int usable = full ? n - 1 : n;
+
+        for (int i = 0; room && i < usable; i++) {
+            size_t start = base + sections[i].offset;
+            size_t length = sections[i].length;
+            size_t held = start > part_start ? start - part_start : 0;
+            if (held > 0 && ((held >= SUMMARY_CHUNK_TARGET / 2 && chunk_boundary(data + start, length)) ||
+                             held + length > 2 * SUMMARY_CHUNK_TARGET)) {
+                room = add_part(data, part_start, start, chunks, &count, max_chunks);
+                part_start = start;
+            }
+        }
+        base = full ? base + sections[n - 1].offset : size;
+    }
+    if (room) {
+        add_part(data, part_start, size, chunks, &count, max_chunks);
+    }
+
+    free(sections);
+    return count;
+}
+
+// One request of a chunked summary: a part of the document, or a group of part
+// summaries to combine
+typedef struct ChunkJob {
+    const char *text;
+    size_t length;
+    uint64_t hash;                  // Cache key (parts only)
+    bool combine;                   // text is part summaries, not document text
+    int index;
+    int count;
+    SummaryFileType type;
+    ApiPriority priority;
+    ClaudeClient *client;
+    SummaryCache *cache;
+    char summary[CHUNK_SUMMARY_MAX];
+    int tokens_used;
+    bool ok;
+    char error[256];
+} ChunkJob;
+
+// Helper: Summarize one part, or combine one group of part summaries
+static void chunk_job_run(void *arg, JobToken *token)
+{
+    ChunkJob *job = (ChunkJob *)arg;
+    if (token && job_token_cancelled(token)) return;
+
+    const char *kind = summarize_file_type_name(job->type);
+    size_t prompt_size = job->length + 512;
+    char *prompt = malloc(prompt_size);
+    if (!prompt) {
+        snprintf(job->error, sizeof(job->error), "Out of memory");
+        return;
+    }
+    if (job->combine) {
+        snprintf(prompt, prompt_size,
+                 "Below are summaries of consecutive parts of one long %s document, in order. "
+                 "Combine them into one summary of this stretch of the document in a short "
+                 "paragraph, keeping the names, figures and conclusions.\n\n%.*s",
+                 kind, (int)job->length, job->text);
+    } else {
+        snprintf(prompt, prompt_size,
+                 "This is part %d of %d of a long %s document. Summarize what this part covers "
+                 "in a few sentences, keeping the names, figures and conclusions it holds. Other "
+                 "parts are summarized separately.\n\n%.*s",
+                 job->index + 1, job->count, kind, (int)job->length, job->text);
+    }
+
+    ClaudeMessageRequest req;
+    ClaudeMessageResponse resp;
+    claude_request_init(&req);
+    claude_response_init(&resp);
+    claude_request_set_priority(&req, job->priority);
+    claude_request_set_feature(&req, CLAUDE_FEATURE_SUMMARY);
+    claude_request_set_max_tokens(&req, CHUNK_SUMMARY_TOKENS);
+    claude_request_set_system_prompt(&req, "You are a helpful assistant that summarizes documents concisely and accurately.");
+    claude_request_add_user_message(&req, prompt);
+    free(prompt);
+
+    if (claude_send_message(job->client, &req, &resp) && resp.stop_reason != CLAUDE_STOP_ERROR) {
+        snprintf(job->summary, sizeof(job->summary), "%s", resp.content);
+        job->tokens_used = resp.input_tokens + resp.output_tokens;
+        job->ok = true;
+        if (!job->combine) {
+            summary_cache_put_chunk(job->cache, job->hash, job->summary);
+        }
+    } else {
+        snprintf(job->error, sizeof(job->error), "%s", resp.error ? resp.error : "API request failed");
+    }
+
+    claude_request_cleanup(&req);
+    claude_response_cleanup(&resp);
+}
+
+// Helper: Run jobs side by side on the job scheduler (inline before it starts); false
+// with result's error set if any failed
+static bool run_chunk_jobs(ChunkJob *jobs, int count, JobQos qos, SummaryResult *result)
+{
+    JobToken *token = job_token_create();
+    for (int i = 0; i < count; i++) {
+        if (jobs[i].ok) continue;
+        if (token) {
+            jobs_submit(qos, chunk_job_run, NULL, &jobs[i], token);
+        } else {
+            chunk_job_run(&jobs[i], NULL);
+        }
+    }
+    if (token) {
+        job_token_wait(token);
+        job_token_release(token);
+    }
+
+    bool ok = true;
+    for (int i = 0; i < count; i++) {
+        result->tokens_used += jobs[i].tokens_used;
+        jobs[i].tokens_used = 0;
+        if (!jobs[i].ok && ok) {
+            snprintf(result->error_message, sizeof(result->error_message), "%s", jobs[i].error);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// Helper: Join summaries[first, first + n) as "Part i: ..." paragraphs; returns the length
+static size_t join_summaries(const ChunkJob *jobs, int first, int n, char *out, size_t out_size)
+{
+    size_t len = 0;
+    out[0] = '\0';
+    for (int i = first; i < first + n && len + 1 < out_size; i++) {
+        int written = snprintf(out + len, out_size - len, "%sPart %d: %s", len > 0 ? "\n\n" : "",
+                               i + 1, jobs[i].summary);
+        if (written < 0) break;
+        len += (size_t)written < out_size - len ? (size_t)written : out_size - len - 1;
+    }
+    return len;
+}
+
+// Helper: Summarize a long document in parts: parts missing from the cache are summarized
+// side by side, groups of part summaries are combined until they fit one request, and
+// that request (streamed when on_text is set) gives the summary
+static SummarizeStatus summarize_chunked(const char *text, size_t size, const SummarizeConfig *config,
+                                         SummaryCache *cache, ClaudeClient *client, SummaryResult *result,
+                                         SummarizeStreamFn on_text, void *context)
+{
+    SummaryChunk *chunks = malloc(SUMMARY_MAX_CHUNKS * sizeof(SummaryChunk));
+    ChunkJob *jobs = calloc(SUMMARY_MAX_CHUNKS, sizeof(ChunkJob));
+    char *joined = malloc(CHUNK_REDUCE_INPUT_MAX + CHUNK_SUMMARY_MAX + 64);
+    if (!chunks || !jobs || !joined) {
+        free(chunks);
+        free(jobs);
+        free(joined);
+        result->status = SUMM_STATUS_FILE_ERROR;
+        return SUMM_STATUS_FILE_ERROR;
+    }
+
+    // Someone waiting on a streamed summary gets their parts first
+    JobQos qos = on_text ? JOB_QOS_USER_INITIATED : JOB_QOS_UTILITY;
+    ApiPriority priority = on_text ? API_PRIORITY_INTERACTIVE : API_PRIORITY_BACKGROUND;
+
+    int count = summarize_split(text, size, result->file_type, chunks, SUMMARY_MAX_CHUNKS);
+    for (int i = 0; i < count; i++) {
+        ChunkJob *job = &jobs[i];
+        job->text = text + chunks[i].offset;
+        job->length = chunks[i].length;
+        job->hash = chunks[i].hash;
+        job->index = i;
+        job->count = count;
+        job->type = result->file_type;
+        job->priority = priority;
+        job->client = client;
+        job->cache = config->use_cache ? cache : NULL;
+        job->ok = job->cache && summary_cache_get_chunk(job->cache, job->hash, job->summary, sizeof(job->summary));
+    }
+    bool ok = run_chunk_jobs(jobs, count, qos, result);
+
+    // Combine groups of part summaries until the rest fit one request
+    int remaining = count;
+    while (ok && join_summaries(jobs, 0, remaining, joined, CHUNK_REDUCE_INPUT_MAX + 1) >= CHUNK_REDUCE_INPUT_MAX) {
+        ChunkJob *groups = calloc((size_t)remaining, sizeof(ChunkJob));
+        char *texts = malloc((size_t)remaining * (CHUNK_REDUCE_INPUT_MAX + 1));
+        int group_count = 0;
+        for (int first = 0; groups && texts && first < remaining; group_count++) {
+            int n = 0;
+            size_t len = 0;
+            while (first + n < remaining && (n == 0 || len + strlen(jobs[first + n].summary) + 16 < CHUNK_REDUCE_INPUT_MAX)) {
+                len += strlen(jobs[first + n].summary) + 16;
+                n++;
+            }
+            ChunkJob *group = &groups[group_count];
+            char *group_text = texts + (size_t)group_count * (CHUNK_REDUCE_INPUT_MAX + 1);
+            group->length = join_summaries(jobs, first, n, group_text, CHUNK_REDUCE_INPUT_MAX + 1);
+            group->text = group_text;
+            group->combine = true;
+            group->type = result->file_type;
+            group->priority = priority;
+            group->client = client;
+            first += n;
+        }
+        ok = groups && texts && group_count < remaining && run_chunk_jobs(groups, group_count, qos, result);
+        for (int i = 0; ok && i < group_count; i++) {
+            snprintf(jobs[i].summary, sizeof(jobs[i].summary), "%s", groups[i].summary);
+        }
+        remaining = group_count;
+        free(groups);
+        free(texts);
+    }
+
+    if (ok) {
+        char *prompt = malloc(CHUNK_REDUCE_INPUT_MAX + 1024);
+        ok = prompt != NULL;
+        if (prompt) {
+            snprintf(prompt, CHUNK_REDUCE_INPUT_MAX + 1024,
+                     "Below are summaries of the consecutive parts of one long %s document, in "
+                     "order. Summarize the whole document from them. %s%s\n\n%s",
+                     summarize_file_type_name(result->file_type), length_instruction(config->default_level),
+                     config->extract_key_points ? "\n\nAlso list 3-5 key points as bullet points." : "",
+                     joined);
+
+            ClaudeMessageRequest req;
+            ClaudeMessageResponse resp;
+            claude_request_init(&req);
+            claude_response_init(&resp);
+            claude_request_set_priority(&req, priority);
+            claude_request_set_feature(&req, summary_feature(config->default_level));
+            claude_request_set_system_prompt(&req, "You are a helpful assistant that summarizes documents concisely and accurately.");
+            claude_request_add_user_message(&req, prompt);
+            free(prompt);
+
+            if (on_text) {
+                ClaudeStreamCallbacks callbacks = { .on_text = on_text, .context = context };
+                ok = claude_send_message_stream(client, &req, &callbacks, &resp);
+            } else {
+                ok = claude_send_message(client, &req, &resp);
+            }
+            ok = ok && resp.stop_reason != CLAUDE_STOP_ERROR;
+            if (ok) {
+                strncpy(result->summary, resp.content, sizeof(result->summary) - 1);
+                result->tokens_used += resp.input_tokens + resp.output_tokens;
+            } else {
+                snprintf(result->error_message, sizeof(result->error_message), "%s",
+                         resp.error ? resp.error : "API request failed");
+            }
+            claude_request_cleanup(&req);
+            claude_response_cleanup(&resp);
+        }
+    }
+
+    free(chunks);
+    free(jobs);
+    free(joined);
+
+    if (!ok) {
+        result->status = SUMM_STATUS_API_ERROR;
+        return SUMM_STATUS_API_ERROR;
+    }
+    result->level = config->default_level;
+    result->from_cache = false;
+    result->status = SUMM_STATUS_OK;
+    if (config->use_cache && cache) {
+        summary_cache_put(cache, result);
+    }
+    return SUMM_STATUS_OK;
+}
+
+// Helper: A document's whole text, NUL-terminated: a copy of the file, or the text the
+// extractor pool takes from it. NULL if it cannot be read
+static char *read_document(const char *path, size_t *length)
+{
+    ContentMap map;
+    bool document = extract_pool_handles(path);
+    if (!(document ? content_map_open_document(path, &map) : content_map_open(path, &map))) return NULL;
+
+    ContentChunk whole = { .offset = 0, .length = map.size };
+    char *text = malloc(map.size + 1);
+    if (text && !content_map_copy(&map, &whole, text, map.size + 1)) {
+        free(text);
+        text = NULL;
+    }
+    content_map_close(&map);
+    if (text) *length = whole.length;
+    return text;
+}
+
+// Helper: Write a brief summary with the on-device model; false (result untouched) if no
+// model is installed or it fails, leaving the summary to Claude
+static bool summarize_local(const char *path, const SummarizeConfig *config, SummaryCache *cache,
+                            SummaryResult *result, SummarizeStreamFn on_text, void *context)
+{
+    LocalLLM *llm = summarize_llm();
+    if (!llm) return false;
+
+    char *content = malloc(SUMMARY_LOCAL_CONTENT + 1);
+    char *prompt = malloc(LOCAL_LLM_MAX_PROMPT + 1);
+    bool ok = content && prompt && read_file_content(path, content, SUMMARY_LOCAL_CONTENT + 1, NULL);
+    if (ok) {
+        snprintf(prompt, LOCAL_LLM_MAX_PROMPT + 1,
+                 "Summarize the following %s in one short sentence. Reply with the sentence only.\n\n%s",
+                 summarize_file_type_name(result->file_type), content);
+    }
+    free(content);
+
+    char summary[SUMMARY_MAX_LENGTH];
+    clock_t start = clock();
+    ok = ok && local_llm_generate(llm, "You summarize files concisely and accurately.", prompt,
+                                  SUMMARY_LOCAL_TOKENS, summary, sizeof(summary)) == LOCAL_LLM_STATUS_OK;
+    free(prompt);
+
+    // Small models sometimes open with blank lines
+    const char *text = summary;
+    while (ok && (*text == ' ' || *text == '\n')) text++;
+    if (!ok || *text == '\0') return false;
+
+    snprintf(result->summary, sizeof(result->summary), "%s", text);
+    result->generation_time_ms = (float)(clock() - start) / CLOCKS_PER_SEC * 1000.0f;
+    result->level = SUMM_LEVEL_BRIEF;
+    result->from_cache = false;
+    result->tokens_used = 0;
+    result->status = SUMM_STATUS_OK;
+    if (config->use_cache && cache) {
+        summary_cache_put(cache, result);
+    }
+    if (on_text) {
+        on_text(context, result->summary);
+    }
+    return true;
 }
 
 // Summarize a file
@@ -404,6 +1132,16 @@ SummarizeStatus summarize_file(const char *path,
                                 const SummarizeConfig *config,
                                 SummaryCache *cache,
                                 SummaryResult *result)
+{
+    return summarize_file_stream(path, config, cache, result, NULL, NULL);
+}
+
+SummarizeStatus summarize_file_stream(const char *path,
+                                       const SummarizeConfig *config,
+                                       SummaryCache *cache,
+                                       SummaryResult *result,
+                                       SummarizeStreamFn on_text,
+                                       void *context)
 {
     if (!path || !config || !result) {
         return SUMM_STATUS_NOT_INITIALIZED;
@@ -450,6 +1188,12 @@ SummarizeStatus summarize_file(const char *path,
         }
     }
 
+    // Brief summaries stay on the device when a model is installed; Claude writes the rest
+    if (config->local_brief && config->default_level == SUMM_LEVEL_BRIEF &&
+        summarize_local(path, config, cache, result, on_text, context)) {
+        return SUMM_STATUS_OK;
+    }
+
     // Check API key
     if (strlen(config->api_key) == 0) {
         result->status = SUMM_STATUS_API_ERROR;
@@ -458,18 +1202,34 @@ SummarizeStatus summarize_file(const char *path,
     }
 
     // Read file content
-    char *content = malloc(SUMMARY_MAX_CONTENT);
+    size_t content_len = 0;
+    char *content = read_document(path, &content_len);
     if (!content) {
         result->status = SUMM_STATUS_FILE_ERROR;
+        strncpy(result->error_message, "Could not read file", sizeof(result->error_message) - 1);
         return SUMM_STATUS_FILE_ERROR;
     }
 
-    size_t content_len;
-    if (!read_file_content(path, content, SUMMARY_MAX_CONTENT, &content_len)) {
+    // Long documents are summarized in parts rather than cut off
+    if (config->chunked && content_len > SUMMARY_CHUNKED_MIN) {
+        ClaudeClient *client = summarize_client(config->api_key);
+        if (!client) {
+            free(content);
+            result->status = SUMM_STATUS_API_ERROR;
+            strncpy(result->error_message, "Failed to create API client",
+                    sizeof(result->error_message) - 1);
+            return SUMM_STATUS_API_ERROR;
+        }
+
+        clock_t start = clock();
+        SummarizeStatus status = summarize_chunked(content, content_len, config, cache, client,
+                                                   result, on_text, context);
+        result->generation_time_ms = (float)(clock() - start) / CLOCKS_PER_SEC * 1000.0f;
         free(content);
-        result->status = SUMM_STATUS_FILE_ERROR;
-        strncpy(result->error_message, "Could not read file", sizeof(result->error_message) - 1);
-        return SUMM_STATUS_FILE_ERROR;
+        return status;
+    }
+    if (content_len >= SUMMARY_MAX_CONTENT) {
+        content[SUMMARY_MAX_CONTENT - 1] = '\0';
     }
 
     // Build prompt
@@ -488,7 +1248,7 @@ SummarizeStatus summarize_file(const char *path,
     // Send to Claude
     clock_t start = clock();
 
-    ClaudeClient *client = claude_client_create(config->api_key);
+    ClaudeClient *client = summarize_client(config->api_key);
     if (!client) {
         free(prompt);
         result->status = SUMM_STATUS_API_ERROR;
@@ -501,13 +1261,20 @@ SummarizeStatus summarize_file(const char *path,
     ClaudeMessageResponse resp;
     claude_request_init(&req);
     claude_response_init(&resp);
+    claude_request_set_feature(&req, summary_feature(config->default_level));
 
     claude_request_set_system_prompt(&req, "You are a helpful assistant that summarizes documents concisely and accurately.");
     claude_request_add_user_message(&req, prompt);
 
     free(prompt);
 
-    bool success = claude_send_message(client, &req, &resp);
+    bool success;
+    if (on_text) {
+        ClaudeStreamCallbacks callbacks = { .on_text = on_text, .context = context };
+        success = claude_send_message_stream(client, &req, &callbacks, &resp);
+    } else {
+        success = claude_send_message(client, &req, &resp);
+    }
 
     clock_t end = clock();
     result->generation_time_ms = (float)(end - start) / CLOCKS_PER_SEC * 1000.0f;
@@ -534,11 +1301,123 @@ SummarizeStatus summarize_file(const char *path,
 
     claude_request_cleanup(&req);
     claude_response_cleanup(&resp);
-    claude_client_destroy(client);
 
     return result->status;
 }
 
+// Helper: Summarize the small files paths[batch[0..n)] in one request, asking for a JSON
+// array with one summary per file. False if the request fails or the reply does not
+// parse, leaving those results for the caller to summarize one by one
+static bool summarize_batch(const char **paths, const int *batch, int n,
+                            const SummarizeConfig *config, SummaryCache *cache,
+                            SummaryResult *results)
+{
+    size_t prompt_size = (size_t)n * (SUMMARY_BATCH_FILE_MAX + 1024) + 1024;
+    char *prompt = malloc(prompt_size);
+    char *content = malloc(SUMMARY_BATCH_FILE_MAX + 1);
+    if (!prompt || !content) {
+        free(prompt);
+        free(content);
+        return false;
+    }
+
+    int len = snprintf(prompt, prompt_size,
+                       "Summarize each of the %d files below separately. For each file: %s%s\n\n"
+                       "Respond with ONLY a JSON array of %d strings, the summary of file 1 first.",
+                       n, length_instruction(config->default_level),
+                       config->extract_key_points ? " Also list 3-5 key points as bullet points." : "",
+                       n);
+    for (int i = 0; i < n; i++) {
+        const char *path = paths[batch[i]];
+        if (!read_file_content(path, content, SUMMARY_BATCH_FILE_MAX + 1, NULL)) {
+            content[0] = '\0';
+        }
+        const char *name = strrchr(path, '/');
+        len += snprintf(prompt + len, prompt_size - (size_t)len,
+                        "\n\n--- File %d: %s (%s) ---\n%s",
+                        i + 1, name ? name + 1 : path,
+                        summarize_file_type_name(summarize_detect_file_type(path)), content);
+    }
+    free(content);
+
+    ClaudeClient *client = summarize_client(config->api_key);
+    if (!client) {
+        free(prompt);
+        return false;
+    }
+
+    ClaudeMessageRequest req;
+    ClaudeMessageResponse resp;
+    claude_request_init(&req);
+    claude_response_init(&resp);
+    claude_request_set_priority(&req, API_PRIORITY_BACKGROUND);
+    claude_request_set_feature(&req, summary_feature(config->default_level));
+
+    claude_request_set_max_tokens(&req, n * 512 > CLAUDE_DEFAULT_MAX_TOKENS ? n * 512
+                                                                          : CLAUDE_DEFAULT_MAX_TOKENS);
+    claude_request_set_system_prompt(&req, "You are a helpful assistant that summarizes documents concisely and accurately. Respond only with valid JSON.");
+    claude_request_add_user_message(&req, prompt);
+
+    free(prompt);
+
+    clock_t start = clock();
+    bool success = claude_send_message(client, &req, &resp) && resp.stop_reason != CLAUDE_STOP_ERROR;
+    float elapsed_ms = (float)(clock() - start) / CLOCKS_PER_SEC * 1000.0f;
+
+    // The array may come wrapped in prose or a code fence
+    cJSON *summaries = NULL;
+    char *array_start = success ? strchr(resp.content, '[') : NULL;
+    char *array_end = array_start ? strrchr(array_start, ']') : NULL;
+    if (array_end) {
+        summaries = cJSON_ParseWithLength(array_start, (size_t)(array_end - array_start + 1));
+    }
+    bool parsed = cJSON_IsArray(summaries) && cJSON_GetArraySize(summaries) == n;
+    for (int i = 0; parsed && i < n; i++) {
+        parsed = cJSON_IsString(cJSON_GetArrayItem(summaries, i));
+    }
+
+    for (int i = 0; parsed && i < n; i++) {
+        SummaryResult *result = &results[batch[i]];
+        strncpy(result->summary, cJSON_GetArrayItem(summaries, i)->valuestring,
+                sizeof(result->summary) - 1);
+        result->file_type = summarize_detect_file_type(result->path);
+        result->level = config->default_level;
+        result->from_cache = false;
+        result->generation_time_ms = elapsed_ms / n;
+        result->tokens_used = (resp.input_tokens + resp.output_tokens) / n;
+        result->status = SUMM_STATUS_OK;
+
+        if (config->use_cache && cache) {
+            summary_cache_put(cache, result);
+        }
+    }
+
+    cJSON_Delete(summaries);
+    claude_request_cleanup(&req);
+    claude_response_cleanup(&resp);
+
+    return parsed;
+}
+
+// Helper: Summarize the pending batch (or its files one by one if it cannot be), then
+// empty it
+static void flush_batch(const char **paths, int *batch, int *n, const SummarizeConfig *config,
+                        SummaryCache *cache, SummaryResult *results, SummarizeStatus *overall_status)
+{
+    if (*n >= 2 && summarize_batch(paths, batch, *n, config, cache, results)) {
+        *n = 0;
+        return;
+    }
+
+    for (int i = 0; i < *n; i++) {
+        SummarizeStatus status = summarize_file(paths[batch[i]], config, cache, &results[batch[i]]);
+        if (status != SUMM_STATUS_OK) {
+            *overall_status = status;
+        }
+    }
+    *n = 0;
+}
+
 // Summarize multiple files
 SummarizeStatus summarize_files(const char **paths,
                                  int count,
@@ -551,13 +1430,38 @@ SummarizeStatus summarize_files(const char **paths,
     }
 
     SummarizeStatus overall_status = SUMM_STATUS_OK;
+    int batch[SUMMARY_BATCH_MAX_FILES];
+    int batch_count = 0;
 
     for (int i = 0; i < count; i++) {
-        SummarizeStatus status = summarize_file(paths[i], config, cache, &results[i]);
-        if (status != SUMM_STATUS_OK) {
-            overall_status = status;
+        SummaryResult *result = &results[i];
+        memset(result, 0, sizeof(SummaryResult));
+        strncpy(result->path, paths[i], sizeof(result->path) - 1);
+
+        if (config->use_cache && cache && summary_cache_get(cache, paths[i], result)) {
+            continue;
+        }
+
+        // Small files share a request; anything else (including every error case) goes
+        // through summarize_file
+        struct stat st;
+        bool small = strlen(config->api_key) > 0 && summarize_is_supported(paths[i]) &&
+                     stat(paths[i], &st) == 0 && S_ISREG(st.st_mode) &&
+                     st.st_size > 0 && st.st_size <= SUMMARY_BATCH_FILE_MAX;
+        if (!small) {
+            SummarizeStatus status = summarize_file(paths[i], config, cache, result);
+            if (status != SUMM_STATUS_OK) {
+                overall_status = status;
+            }
+            continue;
+        }
+
+        batch[batch_count++] = i;
+        if (batch_count == SUMMARY_BATCH_MAX_FILES) {
+            flush_batch(paths, batch, &batch_count, config, cache, results, &overall_status);
         }
     }
+    flush_batch(paths, batch, &batch_count, config, cache, results, &overall_status);
 
     return overall_status;
 }
@@ -627,7 +1531,7 @@ SummarizeStatus summarize_text(const char *content,
                          config->extract_key_points, prompt, SUMMARY_MAX_CONTENT + 1024);
 
     // Send to Claude
-    ClaudeClient *client = claude_client_create(config->api_key);
+    ClaudeClient *client = summarize_client(config->api_key);
     if (!client) {
         free(prompt);
         result->status = SUMM_STATUS_API_ERROR;
@@ -638,6 +1542,7 @@ SummarizeStatus summarize_text(const char *content,
     ClaudeMessageResponse resp;
     claude_request_init(&req);
     claude_response_init(&resp);
+    claude_request_set_feature(&req, summary_feature(config->default_level));
 
     claude_request_set_system_prompt(&req, "You are a helpful assistant that summarizes content.");
     claude_request_add_user_message(&req, prompt);
@@ -655,7 +1560,6 @@ SummarizeStatus summarize_text(const char *content,
 
     claude_request_cleanup(&req);
     claude_response_cleanup(&resp);
-    claude_client_destroy(client);
 
     return result->status;
 }
@@ -690,13 +1594,14 @@ SummarizeStatus summarize_extract_key_points(const char *path,
     free(content);
 
     // Send to Claude
-    ClaudeClient *client = claude_client_create(config->api_key);
+    ClaudeClient *client = summarize_client(config->api_key);
     if (!client) return SUMM_STATUS_API_ERROR;
 
     ClaudeMessageRequest req;
     ClaudeMessageResponse resp;
     claude_request_init(&req);
     claude_response_init(&resp);
+    claude_request_set_feature(&req, CLAUDE_FEATURE_SUMMARY);
 
     claude_request_add_user_message(&req, prompt);
 
@@ -709,7 +1614,6 @@ SummarizeStatus summarize_extract_key_points(const char *path,
 
     claude_request_cleanup(&req);
     claude_response_cleanup(&resp);
-    claude_client_destroy(client);
 
     return success ? SUMM_STATUS_OK : SUMM_STATUS_API_ERROR;
 }
@@ -759,7 +1663,7 @@ SummarizeStatus summarize_compare(const char *path1,
     free(content2);
 
     // Send to Claude
-    ClaudeClient *client = claude_client_create(config->api_key);
+    ClaudeClient *client = summarize_client(config->api_key);
     if (!client) {
         free(prompt);
         return SUMM_STATUS_API_ERROR;
@@ -769,6 +1673,7 @@ SummarizeStatus summarize_compare(const char *path1,
     ClaudeMessageResponse resp;
     claude_request_init(&req);
     claude_response_init(&resp);
+    claude_request_set_feature(&req, CLAUDE_FEATURE_DETAILED_SUMMARY);
 
     claude_request_add_user_message(&req, prompt);
 
@@ -783,7 +1688,6 @@ SummarizeStatus summarize_compare(const char *path1,
 
     claude_request_cleanup(&req);
     claude_response_cleanup(&resp);
-    claude_client_destroy(client);
 
     return success ? SUMM_STATUS_OK : SUMM_STATUS_API_ERROR;
 }
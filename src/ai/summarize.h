@@ -12,6 +12,25 @@
 // Maximum content to send to API (512KB)
 #define SUMMARY_MAX_CONTENT 524288
 
+// Documents with more text than this are summarized in parts when config->chunked: each
+// part (cut at section boundaries by the indexer's splitter) is summarized on its own,
+// concurrently, and the part summaries are then reduced to one. Part summaries are cached
+// by the hash of their text, so an edited document only has its changed parts redone
+#define SUMMARY_CHUNKED_MIN 65536
+
+// Parts aim for this many bytes and hold at most twice as many (one request each);
+// text past the last part is left out
+#define SUMMARY_CHUNK_TARGET 12288
+#define SUMMARY_MAX_CHUNKS 256
+
+// summarize_files packs files up to this size into shared requests, this many at most
+#define SUMMARY_BATCH_FILE_MAX 16384
+#define SUMMARY_BATCH_MAX_FILES 16
+
+// Bytes of a file the on-device model reads for a brief summary, and the longest reply
+#define SUMMARY_LOCAL_CONTENT 6144
+#define SUMMARY_LOCAL_TOKENS 64
+
 // Summarization status
 typedef enum SummarizeStatus {
     SUMM_STATUS_OK = 0,
@@ -75,13 +94,26 @@ typedef struct SummarizeConfig {
     int max_file_size;          // Max file size to summarize (bytes)
     bool extract_key_points;    // Include bullet points
     bool include_metadata;      // Include file metadata in summary
+    bool chunked;               // Summarize long documents in parts (SUMMARY_CHUNKED_MIN)
+    bool local_brief;           // Write brief summaries with the on-device model when installed
 } SummarizeConfig;
 
-// Summary cache
-typedef struct SummaryCache {
-    void *db;                   // SQLite database handle
-    bool initialized;
-} SummaryCache;
+// One part of a long document
+typedef struct SummaryChunk {
+    size_t offset;
+    size_t length;
+    uint64_t hash;              // XXH64 of the part's text, its cache key
+} SummaryChunk;
+
+// Summaries kept in memory in front of the SQLite cache
+#define SUMMARY_CACHE_MEMORY_SLOTS 64
+
+// Cache writes share a transaction, committed after this many writes or seconds
+#define SUMMARY_CACHE_BATCH_WRITES 16
+#define SUMMARY_CACHE_BATCH_SECONDS 2
+
+// Summary cache (opaque). Safe to use from several threads
+typedef struct SummaryCache SummaryCache;
 
 // Initialize default configuration
 void summarize_config_init(SummarizeConfig *config);
@@ -92,12 +124,29 @@ SummaryCache *summary_cache_create(const char *cache_path);
 // Close summary cache
 void summary_cache_destroy(SummaryCache *cache);
 
-// Get cached summary (if exists and valid)
+// Get cached summary (if exists and valid). An entry whose file keeps its mtime and size
+// is trusted as is; the file is hashed only when they changed, and a matching hash keeps
+// the entry
 bool summary_cache_get(SummaryCache *cache, const char *path, SummaryResult *result);
 
-// Store summary in cache
+// Store summary in cache (committed with the next batch of writes)
 bool summary_cache_put(SummaryCache *cache, const SummaryResult *result);
 
+// Commit cache writes still waiting for their batch
+void summary_cache_flush(SummaryCache *cache);
+
+// Bytes of SQLite page cache the summary cache holds
+size_t summary_cache_memory(SummaryCache *cache);
+
+// Give the page cache back (commits pending writes first); pages are read again on demand
+void summary_cache_release_memory(SummaryCache *cache);
+
+// Get the cached summary of a document part by the hash of its text
+bool summary_cache_get_chunk(SummaryCache *cache, uint64_t hash, char *summary_out, size_t summary_size);
+
+// Store the summary of a document part (committed with the next batch of writes)
+bool summary_cache_put_chunk(SummaryCache *cache, uint64_t hash, const char *summary);
+
 // Invalidate cache entry
 void summary_cache_invalidate(SummaryCache *cache, const char *path);
 
@@ -110,13 +159,30 @@ SummaryFileType summarize_detect_file_type(const char *path);
 // Check if file type is supported
 bool summarize_is_supported(const char *path);
 
+// Cut a document's text into parts for a chunked summary; returns how many. Parts end at
+// section boundaries picked by their content, so an edit moves only the boundaries near it
+int summarize_split(const char *data, size_t size, SummaryFileType type,
+                    SummaryChunk *chunks, int max_chunks);
+
 // Summarize a file (uses cache if available)
 SummarizeStatus summarize_file(const char *path,
                                 const SummarizeConfig *config,
                                 SummaryCache *cache,
                                 SummaryResult *result);
 
-// Summarize multiple files
+// Called with each piece of a summary as it is generated; return false to stop
+typedef bool (*SummarizeStreamFn)(void *context, const char *text);
+
+// Summarize a file like summarize_file, streaming the summary to on_text as it is
+// generated (a cached summary is returned without calls)
+SummarizeStatus summarize_file_stream(const char *path,
+                                       const SummarizeConfig *config,
+                                       SummaryCache *cache,
+                                       SummaryResult *result,
+                                       SummarizeStreamFn on_text,
+                                       void *context);
+
+// Summarize multiple files; cached ones are skipped and small ones share requests
 SummarizeStatus summarize_files(const char **paths,
                                  int count,
                                  const SummarizeConfig *config,
@@ -156,6 +222,10 @@ SummarizeStatus summarize_compare(const char *path1,
                                    char *comparison_out,
                                    size_t comparison_size);
 
+// Free the Claude clients and the on-device model shared by summaries (call once no
+// summary is running)
+void summarize_shutdown(void);
+
 // Get status message
 const char *summarize_status_message(SummarizeStatus status);
 
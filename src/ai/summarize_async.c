@@ -1,29 +1,207 @@
 #include "summarize_async.h"
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 
-// Worker thread function
-static void *summarize_worker(void *arg)
+// One queued or running summarization
+typedef struct SummaryJob {
+    AsyncSummaryRequest *request;
+    uint32_t generation;        // request->generation when queued
+    SummaryPriority priority;
+    char path[ASYNC_PATH_MAX];
+    SummarizeConfig config;
+    SummaryCache *cache;
+    SummaryResult result;
+    SummaryExecutor *executor;
+    struct SummaryJob *next;
+} SummaryJob;
+
+struct SummaryExecutor {
+    pthread_t workers[SUMMARY_EXECUTOR_WORKERS];
+    int worker_count;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    atomic_bool stopping;
+
+    SummaryJob *queue;          // Oldest first; at most one job per request
+};
+
+// Helper: Free a job, clearing the API key it copied
+static void free_job(SummaryJob *job)
 {
-    AsyncSummaryRequest *req = (AsyncSummaryRequest *)arg;
+    memset(job->config.api_key, 0, sizeof(job->config.api_key));
+    free(job);
+}
 
-    // Initialize result
-    memset(&req->result, 0, sizeof(SummaryResult));
+// Helper: Unlink and return the queued job of request, NULL if none (executor locked)
+static SummaryJob *unqueue_request(SummaryExecutor *executor, AsyncSummaryRequest *request)
+{
+    for (SummaryJob **link = &executor->queue; *link; link = &(*link)->next) {
+        if ((*link)->request == request) {
+            SummaryJob *job = *link;
+            *link = job->next;
+            return job;
+        }
+    }
+    return NULL;
+}
 
-    // Perform synchronous summarization
-    SummarizeStatus status = summarize_file(req->path, &req->config, req->cache, &req->result);
+// Helper: Unlink and return the oldest job of the highest priority (executor locked)
+static SummaryJob *take_job(SummaryExecutor *executor)
+{
+    SummaryJob **best = NULL;
+    for (SummaryJob **link = &executor->queue; *link; link = &(*link)->next) {
+        if (!best || (*link)->priority > (*best)->priority) {
+            best = link;
+        }
+    }
+    if (!best) {
+        return NULL;
+    }
+
+    SummaryJob *job = *best;
+    *best = job->next;
+    return job;
+}
+
+// Helper: Whether the job is still the latest run of its request (request locked)
+static bool job_is_current(const SummaryJob *job)
+{
+    return job->request->generation == job->generation &&
+           !atomic_load(&job->executor->stopping);
+}
+
+// Append a streamed piece of the summary; stop the stream once superseded or cancelled
+static bool summarize_stream_text(void *context, const char *text)
+{
+    SummaryJob *job = (SummaryJob *)context;
+    AsyncSummaryRequest *req = job->request;
 
-    // Mark complete (thread-safe)
     pthread_mutex_lock(req->mutex);
-    if (!req->cancelled) {
-        req->completed = true;
-        req->result.status = status;
+    bool keep_going = job_is_current(job);
+    if (keep_going) {
+        size_t len = strlen(text);
+        size_t room = sizeof(req->partial) - 1 - req->partial_len;
+        if (len > room) {
+            len = room;
+        }
+        memcpy(req->partial + req->partial_len, text, len);
+        req->partial_len += len;
+        req->partial[req->partial_len] = '\0';
     }
     pthread_mutex_unlock(req->mutex);
 
+    return keep_going;
+}
+
+// Helper: Summarize, streaming the text so the UI shows it as it is generated, and hand
+// the result to the request unless a newer run superseded this one
+static void run_job(SummaryJob *job)
+{
+    AsyncSummaryRequest *req = job->request;
+
+    SummarizeStatus status = summarize_file_stream(job->path, &job->config, job->cache, &job->result,
+                                                   summarize_stream_text, job);
+
+    pthread_mutex_lock(req->mutex);
+    if (req->generation == job->generation) {
+        // A run stopped by the executor shutting down never completes
+        if (!atomic_load(&job->executor->stopping)) {
+            req->result = job->result;
+            req->result.status = status;
+            req->completed = true;
+        }
+        req->busy = false;
+    }
+    pthread_mutex_unlock(req->mutex);
+}
+
+// Worker thread function
+static void *summarize_worker(void *arg)
+{
+    SummaryExecutor *executor = (SummaryExecutor *)arg;
+
+    pthread_mutex_lock(&executor->mutex);
+    while (!atomic_load(&executor->stopping)) {
+        SummaryJob *job = take_job(executor);
+        if (!job) {
+            pthread_cond_wait(&executor->cond, &executor->mutex);
+            continue;
+        }
+        pthread_mutex_unlock(&executor->mutex);
+
+        run_job(job);
+        free_job(job);
+
+        pthread_mutex_lock(&executor->mutex);
+    }
+    pthread_mutex_unlock(&executor->mutex);
+
     return NULL;
 }
 
+SummaryExecutor *summarize_executor_create(void)
+{
+    SummaryExecutor *executor = calloc(1, sizeof(SummaryExecutor));
+    if (!executor) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&executor->mutex, NULL);
+    pthread_cond_init(&executor->cond, NULL);
+    atomic_init(&executor->stopping, false);
+
+    for (int i = 0; i < SUMMARY_EXECUTOR_WORKERS; i++) {
+        if (pthread_create(&executor->workers[i], NULL, summarize_worker, executor) != 0) {
+            break;
+        }
+        executor->worker_count++;
+    }
+
+    if (executor->worker_count == 0) {
+        pthread_cond_destroy(&executor->cond);
+        pthread_mutex_destroy(&executor->mutex);
+        free(executor);
+        return NULL;
+    }
+    return executor;
+}
+
+void summarize_executor_destroy(SummaryExecutor *executor)
+{
+    if (!executor) {
+        return;
+    }
+
+    pthread_mutex_lock(&executor->mutex);
+    atomic_store(&executor->stopping, true);
+    SummaryJob *queue = executor->queue;
+    executor->queue = NULL;
+    pthread_cond_broadcast(&executor->cond);
+    pthread_mutex_unlock(&executor->mutex);
+
+    for (int i = 0; i < executor->worker_count; i++) {
+        pthread_join(executor->workers[i], NULL);
+    }
+
+    // Queued runs never started
+    while (queue) {
+        SummaryJob *job = queue;
+        queue = job->next;
+
+        pthread_mutex_lock(job->request->mutex);
+        if (job->request->generation == job->generation) {
+            job->request->busy = false;
+        }
+        pthread_mutex_unlock(job->request->mutex);
+        free_job(job);
+    }
+
+    pthread_cond_destroy(&executor->cond);
+    pthread_mutex_destroy(&executor->mutex);
+    free(executor);
+}
+
 void summarize_async_init(AsyncSummaryRequest *request, pthread_mutex_t *mutex)
 {
     memset(request, 0, sizeof(AsyncSummaryRequest));
@@ -32,29 +210,68 @@ void summarize_async_init(AsyncSummaryRequest *request, pthread_mutex_t *mutex)
     request->cancelled = false;
 }
 
-bool summarize_async_start(AsyncSummaryRequest *request, pthread_t *thread,
-                           const char *path, SummarizeConfig *config, SummaryCache *cache)
+bool summarize_async_start(SummaryExecutor *executor, AsyncSummaryRequest *request,
+                           const char *path, const SummarizeConfig *config,
+                           SummaryCache *cache, SummaryPriority priority)
 {
-    if (!request || !thread || !path || !config) {
+    if (!executor || !request || !request->mutex || !path || !config) {
+        return false;
+    }
+
+    SummaryJob *job = calloc(1, sizeof(SummaryJob));
+    if (!job) {
         return false;
     }
+    strncpy(job->path, path, ASYNC_PATH_MAX - 1);
+    memcpy(&job->config, config, sizeof(SummarizeConfig));
+    job->cache = cache;
+    job->priority = priority;
+    job->request = request;
+    job->executor = executor;
 
-    // Reset state
+    // Reset state; any earlier run is now stale
     pthread_mutex_lock(request->mutex);
+    job->generation = ++request->generation;
     request->completed = false;
     request->cancelled = false;
+    request->busy = true;
     memset(&request->result, 0, sizeof(SummaryResult));
-    pthread_mutex_unlock(request->mutex);
-
-    // Copy input parameters
+    request->partial[0] = '\0';
+    request->partial_len = 0;
     strncpy(request->path, path, ASYNC_PATH_MAX - 1);
     request->path[ASYNC_PATH_MAX - 1] = '\0';
-    memcpy(&request->config, config, sizeof(SummarizeConfig));
-    request->cache = cache;
+    SummaryExecutor *previous = request->executor;
+    request->executor = executor;
+    pthread_mutex_unlock(request->mutex);
 
-    // Start worker thread
-    int rc = pthread_create(thread, NULL, summarize_worker, request);
-    return (rc == 0);
+    if (previous && previous != executor) {
+        pthread_mutex_lock(&previous->mutex);
+        SummaryJob *stale = unqueue_request(previous, request);
+        pthread_mutex_unlock(&previous->mutex);
+        if (stale) {
+            free_job(stale);
+        }
+    }
+
+    // Replace a queued run of this request, keeping its place in line
+    pthread_mutex_lock(&executor->mutex);
+    SummaryJob **tail = &executor->queue;
+    SummaryJob *stale = NULL;
+    for (; *tail; tail = &(*tail)->next) {
+        if ((*tail)->request == request) {
+            stale = *tail;
+            job->next = stale->next;
+            break;
+        }
+    }
+    *tail = job;
+    pthread_cond_signal(&executor->cond);
+    pthread_mutex_unlock(&executor->mutex);
+
+    if (stale) {
+        free_job(stale);
+    }
+    return true;
 }
 
 void summarize_async_cancel(AsyncSummaryRequest *request)
@@ -65,7 +282,20 @@ void summarize_async_cancel(AsyncSummaryRequest *request)
 
     pthread_mutex_lock(request->mutex);
     request->cancelled = true;
+    request->completed = false;
+    request->busy = false;
+    request->generation++;
+    SummaryExecutor *executor = request->executor;
     pthread_mutex_unlock(request->mutex);
+
+    if (executor) {
+        pthread_mutex_lock(&executor->mutex);
+        SummaryJob *job = unqueue_request(executor, request);
+        pthread_mutex_unlock(&executor->mutex);
+        if (job) {
+            free_job(job);
+        }
+    }
 }
 
 bool summarize_async_is_complete(AsyncSummaryRequest *request)
@@ -94,16 +324,32 @@ bool summarize_async_is_ready(AsyncSummaryRequest *request)
     return ready;
 }
 
-void summarize_async_cleanup(AsyncSummaryRequest *request)
+bool summarize_async_is_busy(AsyncSummaryRequest *request)
 {
-    if (!request) {
-        return;
+    if (!request || !request->mutex) {
+        return false;
     }
 
-    // Clear sensitive data
-    memset(request->config.api_key, 0, sizeof(request->config.api_key));
+    pthread_mutex_lock(request->mutex);
+    bool busy = request->busy;
+    pthread_mutex_unlock(request->mutex);
 
-    // Reset state
-    request->completed = false;
-    request->cancelled = false;
+    return busy;
+}
+
+bool summarize_async_partial(AsyncSummaryRequest *request, char *out, size_t out_size)
+{
+    if (!request || !request->mutex || !out || out_size == 0) {
+        return false;
+    }
+
+    pthread_mutex_lock(request->mutex);
+    bool any = request->partial_len > 0;
+    if (any) {
+        strncpy(out, request->partial, out_size - 1);
+        out[out_size - 1] = '\0';
+    }
+    pthread_mutex_unlock(request->mutex);
+
+    return any;
 }
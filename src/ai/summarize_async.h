@@ -3,40 +3,71 @@
 
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "summarize.h"
 
+// Summaries run on a small pool of long-lived worker threads shared by every request,
+// so hovering quickly across many files queues work instead of spawning a thread per
+// file. Starting a request again supersedes its previous run: a queued run is replaced
+// and a running one stops at its next streamed piece, its result dropped
+
 // Path length (matches summarize.h)
 #define ASYNC_PATH_MAX 1024
 
+// Worker threads in the summary executor
+#define SUMMARY_EXECUTOR_WORKERS 2
+
+// Queued requests of higher priority are taken first, oldest first within a priority
+typedef enum SummaryPriority {
+    SUMM_PRIORITY_PREFETCH = 0, // Guessed ahead of the user, only warms the cache
+    SUMM_PRIORITY_NORMAL,       // Requested from a menu, shown when done
+    SUMM_PRIORITY_HOVER,        // The item under the pointer, shown as it streams
+} SummaryPriority;
+
+// Summary executor (opaque)
+typedef struct SummaryExecutor SummaryExecutor;
+
 // Async summary request structure
 typedef struct AsyncSummaryRequest {
     // Input
     char path[ASYNC_PATH_MAX];
     char file_path[ASYNC_PATH_MAX];  // Alternative path field (for context menu)
-    SummarizeConfig config;
-    SummaryCache *cache;
 
-    // Output (written by worker thread)
+    // Output (written by a worker thread)
     SummaryResult result;
+    char partial[SUMMARY_MAX_LENGTH];  // Summary text streamed so far
+    size_t partial_len;
     bool completed;
     bool cancelled;
+    bool busy;                  // Queued or running, neither finished nor cancelled
 
     // UI flags
     bool from_context_menu;  // If true, show summary in dialog when complete
 
     // Synchronization
-    pthread_mutex_t *mutex;  // Shared with App
+    pthread_mutex_t *mutex;     // Shared with App
+    uint32_t generation;        // Bumped by start and cancel; older runs are dropped
+    SummaryExecutor *executor;  // Executor of the latest start
 } AsyncSummaryRequest;
 
+// Create an executor and start its workers; NULL on failure
+SummaryExecutor *summarize_executor_create(void);
+
+// Stop the workers and free the executor. Queued runs are dropped and running ones stop
+// at their next streamed piece; neither completes
+void summarize_executor_destroy(SummaryExecutor *executor);
+
 // Initialize an async summary request
 void summarize_async_init(AsyncSummaryRequest *request, pthread_mutex_t *mutex);
 
-// Start async summarization (call from main thread)
-// Returns true if thread started successfully
-bool summarize_async_start(AsyncSummaryRequest *request, pthread_t *thread,
-                           const char *path, SummarizeConfig *config, SummaryCache *cache);
+// Queue summarization of path (call from main thread), superseding any earlier run of
+// the same request. Returns true if queued
+bool summarize_async_start(SummaryExecutor *executor, AsyncSummaryRequest *request,
+                           const char *path, const SummarizeConfig *config,
+                           SummaryCache *cache, SummaryPriority priority);
 
-// Cancel async summarization (sets cancelled flag)
+// Cancel async summarization: a queued run is dropped, a running one stops at its next
+// streamed piece and a finished one is no longer complete
 void summarize_async_cancel(AsyncSummaryRequest *request);
 
 // Check if async operation completed (call from main thread)
@@ -45,7 +76,11 @@ bool summarize_async_is_complete(AsyncSummaryRequest *request);
 // Check if result is ready and valid (completed and not cancelled)
 bool summarize_async_is_ready(AsyncSummaryRequest *request);
 
-// Clean up async request (call after pthread_join)
-void summarize_async_cleanup(AsyncSummaryRequest *request);
+// Check if the request is queued or running
+bool summarize_async_is_busy(AsyncSummaryRequest *request);
+
+// Copy the summary text streamed so far into out (call from main thread while the
+// request runs). Returns false if none has arrived yet
+bool summarize_async_partial(AsyncSummaryRequest *request, char *out, size_t out_size);
 
 #endif // SUMMARIZE_ASYNC_H
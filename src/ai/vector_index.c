@@ -0,0 +1,1039 @@
+#include "vector_index.h"
+#include "vector_ops.h"
+#include "../utils/perf.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VECTOR_INDEX_MAGIC 0x49565046u  // "FPVI"
+#define VECTOR_INDEX_VERSION 1
+
+// Row alignment of the vector store
+#define ROW_ALIGNMENT 64
+
+// Rows scored per kernel call in exact scans
+#define SCAN_BLOCK_ROWS 256
+
+// HNSW parameters: links per node above level 0, links at level 0, build-time candidate list
+#define HNSW_M 16
+#define HNSW_M0 32
+#define HNSW_EF_CONSTRUCTION 100
+#define HNSW_MAX_LEVEL 15
+
+// Compact once this many removed rows accumulate (and they outnumber live ones)
+#define COMPACT_MIN_DEAD 4096
+
+typedef struct Candidate {
+    float score;
+    int node;
+} Candidate;
+
+struct VectorIndex {
+    int dimension;
+
+    // Rows are append-only so graph node ids stay stable; removal only clears the label
+    float *rows;
+    int64_t *labels;            // -1 for removed rows
+    int count;
+    int capacity;
+    int live;
+
+    // Quantized rows for the exact-scan prefilter (only the selected kind is kept)
+    VectorQuantization quantization;
+    int8_t *codes;              // dimension codes per row (int8)
+    float *code_scales;
+    uint64_t *bits;             // VECTOR_BINARY_WORDS(dimension) words per row (binary)
+
+    int *slots;                 // Open-addressed label -> row + 1 (0 = empty)
+    int slot_mask;
+
+    // HNSW graph over rows [0, linked)
+    int linked;
+    int entry;                  // Entry point, or -1 while the graph is empty
+    int max_level;
+    uint8_t *levels;
+    int *links0;                // Per row: count, then up to HNSW_M0 neighbours
+    int **upper;                // Per row: levels[row] blocks of count + HNSW_M neighbours
+
+    // Scratch for graph searches
+    uint32_t *visited;
+    uint32_t visit_tag;
+    Candidate *queue;
+    int queue_capacity;
+    Candidate *found;
+    int found_capacity;
+
+    uint64_t rng;
+};
+
+static inline uint32_t label_hash(int64_t label)
+{
+    uint64_t h = (uint64_t)label * 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)(h >> 32);
+}
+
+static inline const float* row_at(const VectorIndex *index, int row)
+{
+    return index->rows + (size_t)row * (size_t)index->dimension;
+}
+
+// Helper: refresh the quantized copy of a row
+static void encode_row(VectorIndex *index, int row)
+{
+    if (index->quantization == VECTOR_QUANT_INT8) {
+        index->code_scales[row] = vector_quantize_int8(row_at(index, row), index->dimension,
+                                                       index->codes + (size_t)row * (size_t)index->dimension);
+    } else if (index->quantization == VECTOR_QUANT_BINARY) {
+        vector_binarize(row_at(index, row), index->dimension,
+                        index->bits + (size_t)row * VECTOR_BINARY_WORDS(index->dimension));
+    }
+}
+
+static inline float score_rows(const VectorIndex *index, int a, int b)
+{
+    return vector_dot(row_at(index, a), row_at(index, b), index->dimension);
+}
+
+// Helper: neighbour list of row at level (first element is the count)
+static inline int* links_at(const VectorIndex *index, int row, int level)
+{
+    if (level == 0) {
+        return index->links0 + (size_t)row * (HNSW_M0 + 1);
+    }
+    return index->upper[row] + (size_t)(level - 1) * (HNSW_M + 1);
+}
+
+// Slot table
+
+static int find_slot(const VectorIndex *index, int64_t label)
+{
+    if (index->slots == NULL) {
+        return -1;
+    }
+
+    for (int i = (int)(label_hash(label) & (uint32_t)index->slot_mask); ; i = (i + 1) & index->slot_mask) {
+        int row = index->slots[i] - 1;
+        if (row < 0) {
+            return -1;
+        }
+        if (index->labels[row] == label) {
+            return i;
+        }
+    }
+}
+
+static void insert_slot(VectorIndex *index, int row)
+{
+    int i = (int)(label_hash(index->labels[row]) & (uint32_t)index->slot_mask);
+    while (index->slots[i] != 0) {
+        i = (i + 1) & index->slot_mask;
+    }
+    index->slots[i] = row + 1;
+}
+
+// Helper: clear a slot, shifting later entries of its probe chain back
+static void erase_slot(VectorIndex *index, int slot)
+{
+    int hole = slot;
+    for (int i = (hole + 1) & index->slot_mask; index->slots[i] != 0; i = (i + 1) & index->slot_mask) {
+        int home = (int)(label_hash(index->labels[index->slots[i] - 1]) & (uint32_t)index->slot_mask);
+        // Move the entry unless its home lies cyclically in (hole, i]
+        bool stays = (hole <= i) ? (home > hole && home <= i) : (home > hole || home <= i);
+        if (!stays) {
+            index->slots[hole] = index->slots[i];
+            hole = i;
+        }
+    }
+    index->slots[hole] = 0;
+}
+
+static bool rehash(VectorIndex *index, int slot_count)
+{
+    int *slots = memory_calloc(MEMORY_TAG_AI, (size_t)slot_count, sizeof(int));
+    if (slots == NULL) {
+        return false;
+    }
+
+    memory_free(MEMORY_TAG_AI, index->slots);
+    index->slots = slots;
+    index->slot_mask = slot_count - 1;
+    for (int row = 0; row < index->count; row++) {
+        if (index->labels[row] >= 0) {
+            insert_slot(index, row);
+        }
+    }
+    return true;
+}
+
+// Storage
+
+static bool grow_array(void **array, size_t element_size, int old_count, int new_count)
+{
+    void *grown = memory_realloc(MEMORY_TAG_AI, *array, (size_t)new_count * element_size);
+    if (grown == NULL) {
+        return false;
+    }
+    memset((char *)grown + (size_t)old_count * element_size, 0,
+           (size_t)(new_count - old_count) * element_size);
+    *array = grown;
+    return true;
+}
+
+static bool reserve(VectorIndex *index, int needed)
+{
+    if (needed > index->capacity) {
+        int capacity = index->capacity > 0 ? index->capacity : 1024;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+
+        size_t row_bytes = (size_t)index->dimension * sizeof(float);
+        float *rows = memory_aligned_alloc(MEMORY_TAG_AI, ROW_ALIGNMENT, (size_t)capacity * row_bytes);
+        if (rows == NULL) {
+            return false;
+        }
+        if (index->count > 0) {
+            memcpy(rows, index->rows, (size_t)index->count * row_bytes);
+        }
+        memory_free(MEMORY_TAG_AI, index->rows);
+        index->rows = rows;
+
+        int old = index->capacity;
+        if (!grow_array((void **)&index->labels, sizeof(int64_t), old, capacity) ||
+            !grow_array((void **)&index->levels, sizeof(uint8_t), old, capacity) ||
+            !grow_array((void **)&index->links0, (HNSW_M0 + 1) * sizeof(int), old, capacity) ||
+            !grow_array((void **)&index->upper, sizeof(int *), old, capacity) ||
+            !grow_array((void **)&index->visited, sizeof(uint32_t), old, capacity) ||
+            (index->quantization == VECTOR_QUANT_INT8 &&
+             (!grow_array((void **)&index->codes, (size_t)index->dimension, old, capacity) ||
+              !grow_array((void **)&index->code_scales, sizeof(float), old, capacity))) ||
+            (index->quantization == VECTOR_QUANT_BINARY &&
+             !grow_array((void **)&index->bits, VECTOR_BINARY_WORDS(index->dimension) * sizeof(uint64_t),
+                         old, capacity))) {
+            // Arrays that did grow stay valid; capacity is only raised once all have
+            return false;
+        }
+        index->capacity = capacity;
+    }
+
+    // Keep the slot table at most half full
+    if (index->slots == NULL || needed * 2 > index->slot_mask + 1) {
+        int slot_count = 2048;
+        while (slot_count < needed * 2) {
+            slot_count *= 2;
+        }
+        return rehash(index, slot_count);
+    }
+    return true;
+}
+
+static void reset_graph(VectorIndex *index)
+{
+    for (int row = 0; row < index->linked; row++) {
+        memory_free(MEMORY_TAG_AI, index->upper[row]);
+        index->upper[row] = NULL;
+    }
+    index->linked = 0;
+    index->entry = -1;
+    index->max_level = 0;
+}
+
+// Graph search
+
+static bool ensure_scratch(Candidate **array, int *capacity, int needed)
+{
+    if (needed <= *capacity) {
+        return true;
+    }
+
+    int grown = *capacity > 0 ? *capacity : 256;
+    while (grown < needed) {
+        grown *= 2;
+    }
+    Candidate *resized = memory_realloc(MEMORY_TAG_AI, *array, (size_t)grown * sizeof(Candidate));
+    if (resized == NULL) {
+        return false;
+    }
+    *array = resized;
+    *capacity = grown;
+    return true;
+}
+
+static void next_visit_tag(VectorIndex *index)
+{
+    if (++index->visit_tag == 0) {
+        memset(index->visited, 0, (size_t)index->capacity * sizeof(uint32_t));
+        index->visit_tag = 1;
+    }
+}
+
+// Max-heap (best first) when max_heap, otherwise min-heap (worst first)
+static void heap_push(Candidate *heap, int *count, Candidate c, bool max_heap)
+{
+    int i = (*count)++;
+    heap[i] = c;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        bool swap = max_heap ? heap[parent].score < heap[i].score : heap[parent].score > heap[i].score;
+        if (!swap) {
+            return;
+        }
+        Candidate tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+static void heap_sift_down(Candidate *heap, int count, int i, bool max_heap)
+{
+    for (;;) {
+        int best = i;
+        for (int child = 2 * i + 1; child <= 2 * i + 2 && child < count; child++) {
+            bool better = max_heap ? heap[child].score > heap[best].score : heap[child].score < heap[best].score;
+            if (better) {
+                best = child;
+            }
+        }
+        if (best == i) {
+            return;
+        }
+        Candidate tmp = heap[i];
+        heap[i] = heap[best];
+        heap[best] = tmp;
+        i = best;
+    }
+}
+
+static Candidate heap_pop(Candidate *heap, int *count, bool max_heap)
+{
+    Candidate top = heap[0];
+    heap[0] = heap[--(*count)];
+    heap_sift_down(heap, *count, 0, max_heap);
+    return top;
+}
+
+// Helper: follow the best neighbour at level until no neighbour improves
+static Candidate greedy_descend(const VectorIndex *index, const float *query, Candidate current, int level)
+{
+    bool improved = true;
+    while (improved) {
+        improved = false;
+        const int *links = links_at(index, current.node, level);
+        for (int i = 1; i <= links[0]; i++) {
+            float score = vector_dot(query, row_at(index, links[i]), index->dimension);
+            if (score > current.score) {
+                current.score = score;
+                current.node = links[i];
+                improved = true;
+            }
+        }
+    }
+    return current;
+}
+
+// Best-first search of one level; leaves up to ef nodes in index->found (min-heap).
+// With live_only, removed rows are walked through but not collected, so a region
+// of removed rows doesn't end the search early
+static int search_level(VectorIndex *index, const float *query, Candidate entry, int ef, int level,
+                        bool live_only)
+{
+    if (!ensure_scratch(&index->found, &index->found_capacity, ef + 1) ||
+        !ensure_scratch(&index->queue, &index->queue_capacity, ef + 1)) {
+        return 0;
+    }
+
+    next_visit_tag(index);
+    index->visited[entry.node] = index->visit_tag;
+
+    int queued = 0;
+    int found = 0;
+    heap_push(index->queue, &queued, entry, true);
+    if (!live_only || index->labels[entry.node] >= 0) {
+        heap_push(index->found, &found, entry, false);
+    }
+
+    while (queued > 0) {
+        Candidate current = heap_pop(index->queue, &queued, true);
+        if (found >= ef && current.score < index->found[0].score) {
+            break;
+        }
+
+        const int *links = links_at(index, current.node, level);
+        for (int i = 1; i <= links[0]; i++) {
+            int node = links[i];
+            if (index->visited[node] == index->visit_tag) {
+                continue;
+            }
+            index->visited[node] = index->visit_tag;
+
+            float score = vector_dot(query, row_at(index, node), index->dimension);
+            if (found < ef || score > index->found[0].score) {
+                Candidate c = {score, node};
+                if (!ensure_scratch(&index->queue, &index->queue_capacity, queued + 1)) {
+                    continue;
+                }
+                heap_push(index->queue, &queued, c, true);
+                if (live_only && index->labels[node] < 0) {
+                    continue;
+                }
+                if (found < ef) {
+                    heap_push(index->found, &found, c, false);
+                } else {
+                    index->found[0] = c;
+                    heap_sift_down(index->found, found, 0, false);
+                }
+            }
+        }
+    }
+    return found;
+}
+
+static int compare_candidates_desc(const void *a, const void *b)
+{
+    float sa = ((const Candidate *)a)->score;
+    float sb = ((const Candidate *)b)->score;
+    return (sa < sb) - (sa > sb);
+}
+
+// Pick up to max neighbours, skipping candidates closer to an already chosen one
+// than to the base node (keeps links spread out, which is what makes HNSW navigable)
+static int select_neighbours(const VectorIndex *index, Candidate *candidates, int count, int max, int *out)
+{
+    qsort(candidates, (size_t)count, sizeof(Candidate), compare_candidates_desc);
+
+    int selected = 0;
+    for (int i = 0; i < count && selected < max; i++) {
+        bool keep = true;
+        for (int j = 0; j < selected; j++) {
+            if (score_rows(index, candidates[i].node, out[j]) > candidates[i].score) {
+                keep = false;
+                break;
+            }
+        }
+        if (keep) {
+            out[selected++] = candidates[i].node;
+        }
+    }
+    return selected;
+}
+
+// Helper: add a link from neighbour back to node, re-pruning a full list
+static void link_back(VectorIndex *index, int neighbour, int node, int level)
+{
+    int *links = links_at(index, neighbour, level);
+    int max = level == 0 ? HNSW_M0 : HNSW_M;
+    if (links[0] < max) {
+        links[++links[0]] = node;
+        return;
+    }
+
+    Candidate candidates[HNSW_M0 + 1];
+    int count = 0;
+    for (int i = 1; i <= links[0]; i++) {
+        candidates[count].node = links[i];
+        candidates[count].score = score_rows(index, neighbour, links[i]);
+        count++;
+    }
+    candidates[count].node = node;
+    candidates[count].score = score_rows(index, neighbour, node);
+    count++;
+
+    links[0] = select_neighbours(index, candidates, count, max, links + 1);
+}
+
+static int random_level(VectorIndex *index)
+{
+    // xorshift64*
+    index->rng ^= index->rng >> 12;
+    index->rng ^= index->rng << 25;
+    index->rng ^= index->rng >> 27;
+    uint64_t bits = index->rng * 0x2545F4914F6CDD1DULL;
+
+    double u = ((double)(bits >> 11) + 1.0) / 9007199254740993.0;
+    int level = (int)(-log(u) / log((double)HNSW_M));
+    return level > HNSW_MAX_LEVEL ? HNSW_MAX_LEVEL : level;
+}
+
+static void link_node(VectorIndex *index, int node)
+{
+    int level = random_level(index);
+    if (level > 0) {
+        index->upper[node] = memory_calloc(MEMORY_TAG_AI, (size_t)level * (HNSW_M + 1), sizeof(int));
+        if (index->upper[node] == NULL) {
+            level = 0;
+        }
+    }
+    index->levels[node] = (uint8_t)level;
+    index->links0[(size_t)node * (HNSW_M0 + 1)] = 0;
+
+    if (index->entry < 0) {
+        index->entry = node;
+        index->max_level = level;
+        return;
+    }
+
+    const float *query = row_at(index, node);
+    Candidate current = {vector_dot(query, row_at(index, index->entry), index->dimension), index->entry};
+    for (int l = index->max_level; l > level; l--) {
+        current = greedy_descend(index, query, current, l);
+    }
+
+    Candidate candidates[HNSW_EF_CONSTRUCTION];
+    int neighbours[HNSW_M];
+    for (int l = (level < index->max_level ? level : index->max_level); l >= 0; l--) {
+        int found = search_level(index, query, current, HNSW_EF_CONSTRUCTION, l, false);
+        memcpy(candidates, index->found, (size_t)found * sizeof(Candidate));
+
+        for (int i = 0; i < found; i++) {
+            if (candidates[i].score > current.score) {
+                current = candidates[i];
+            }
+        }
+
+        int count = select_neighbours(index, candidates, found, HNSW_M, neighbours);
+        int *links = links_at(index, node, l);
+        links[0] = count;
+        memcpy(links + 1, neighbours, (size_t)count * sizeof(int));
+        for (int i = 0; i < count; i++) {
+            link_back(index, neighbours[i], node, l);
+        }
+    }
+
+    if (level > index->max_level) {
+        index->max_level = level;
+        index->entry = node;
+    }
+}
+
+// Helper: rewrite the store without removed rows; the graph is rebuilt by vector_index_build
+static void compact(VectorIndex *index)
+{
+    reset_graph(index);
+
+    int kept = 0;
+    for (int row = 0; row < index->count; row++) {
+        if (index->labels[row] < 0) {
+            continue;
+        }
+        if (kept != row) {
+            memcpy(index->rows + (size_t)kept * (size_t)index->dimension, row_at(index, row),
+                   (size_t)index->dimension * sizeof(float));
+            index->labels[kept] = index->labels[row];
+            encode_row(index, kept);
+        }
+        kept++;
+    }
+    index->count = kept;
+    rehash(index, index->slot_mask + 1);
+}
+
+VectorIndex* vector_index_create(int dimension)
+{
+    if (dimension <= 0) {
+        return NULL;
+    }
+
+    VectorIndex *index = memory_calloc(MEMORY_TAG_AI, 1, sizeof(VectorIndex));
+    if (index == NULL) {
+        return NULL;
+    }
+
+    index->dimension = dimension;
+    index->entry = -1;
+    index->rng = 0x9E3779B97F4A7C15ULL;
+    return index;
+}
+
+void vector_index_destroy(VectorIndex *index)
+{
+    if (index == NULL) {
+        return;
+    }
+
+    reset_graph(index);
+    memory_free(MEMORY_TAG_AI, index->rows);
+    memory_free(MEMORY_TAG_AI, index->labels);
+    memory_free(MEMORY_TAG_AI, index->levels);
+    memory_free(MEMORY_TAG_AI, index->links0);
+    memory_free(MEMORY_TAG_AI, index->upper);
+    memory_free(MEMORY_TAG_AI, index->codes);
+    memory_free(MEMORY_TAG_AI, index->code_scales);
+    memory_free(MEMORY_TAG_AI, index->bits);
+    memory_free(MEMORY_TAG_AI, index->slots);
+    memory_free(MEMORY_TAG_AI, index->visited);
+    memory_free(MEMORY_TAG_AI, index->queue);
+    memory_free(MEMORY_TAG_AI, index->found);
+    memory_free(MEMORY_TAG_AI, index);
+}
+
+void vector_index_clear(VectorIndex *index)
+{
+    if (index == NULL) {
+        return;
+    }
+
+    reset_graph(index);
+    index->count = 0;
+    index->live = 0;
+    if (index->slots != NULL) {
+        memset(index->slots, 0, (size_t)(index->slot_mask + 1) * sizeof(int));
+    }
+}
+
+static bool store_vector(VectorIndex *index, int64_t label, const float *vector, bool link)
+{
+    if (index == NULL || vector == NULL || label < 0) {
+        return false;
+    }
+
+    // Linked rows can't change their vector in place, so replacing is remove + append
+    vector_index_remove(index, label);
+    if (!reserve(index, index->count + 1)) {
+        return false;
+    }
+
+    int row = index->count++;
+    float *dest = index->rows + (size_t)row * (size_t)index->dimension;
+    memcpy(dest, vector, (size_t)index->dimension * sizeof(float));
+    vector_normalize(dest, index->dimension);
+    encode_row(index, row);
+    index->labels[row] = label;
+    index->upper[row] = NULL;
+    insert_slot(index, row);
+    index->live++;
+
+    if (link && index->linked == row) {
+        link_node(index, row);
+        index->linked++;
+    }
+    return true;
+}
+
+bool vector_index_put(VectorIndex *index, int64_t label, const float *vector)
+{
+    return store_vector(index, label, vector, true);
+}
+
+bool vector_index_append(VectorIndex *index, int64_t label, const float *vector)
+{
+    return store_vector(index, label, vector, false);
+}
+
+void vector_index_remove(VectorIndex *index, int64_t label)
+{
+    if (index == NULL) {
+        return;
+    }
+
+    int slot = find_slot(index, label);
+    if (slot < 0) {
+        return;
+    }
+
+    // The row stays in the graph as a waypoint but never appears in results
+    int row = index->slots[slot] - 1;
+    erase_slot(index, slot);
+    index->labels[row] = -1;
+    index->live--;
+
+    int dead = index->count - index->live;
+    if (dead >= COMPACT_MIN_DEAD && dead > index->live) {
+        compact(index);
+    }
+}
+
+const float* vector_index_get(VectorIndex *index, int64_t label)
+{
+    if (index == NULL) {
+        return NULL;
+    }
+
+    int slot = find_slot(index, label);
+    return slot < 0 ? NULL : row_at(index, index->slots[slot] - 1);
+}
+
+bool vector_index_set_quantization(VectorIndex *index, VectorQuantization quantization)
+{
+    if (index == NULL) {
+        return false;
+    }
+    if (quantization == index->quantization) {
+        return true;
+    }
+
+    memory_free(MEMORY_TAG_AI, index->codes);
+    memory_free(MEMORY_TAG_AI, index->code_scales);
+    memory_free(MEMORY_TAG_AI, index->bits);
+    index->codes = NULL;
+    index->code_scales = NULL;
+    index->bits = NULL;
+    index->quantization = VECTOR_QUANT_NONE;
+
+    // Arrays follow the row capacity; reserve grows them from here on
+    size_t capacity = (size_t)index->capacity;
+    if (capacity > 0 && quantization == VECTOR_QUANT_INT8) {
+        index->codes = memory_alloc(MEMORY_TAG_AI, capacity * (size_t)index->dimension);
+        index->code_scales = memory_alloc(MEMORY_TAG_AI, capacity * sizeof(float));
+        if (index->codes == NULL || index->code_scales == NULL) {
+            memory_free(MEMORY_TAG_AI, index->codes);
+            memory_free(MEMORY_TAG_AI, index->code_scales);
+            index->codes = NULL;
+            index->code_scales = NULL;
+            return false;
+        }
+    } else if (capacity > 0 && quantization == VECTOR_QUANT_BINARY) {
+        index->bits = memory_alloc(MEMORY_TAG_AI, capacity * VECTOR_BINARY_WORDS(index->dimension) * sizeof(uint64_t));
+        if (index->bits == NULL) {
+            return false;
+        }
+    }
+
+    index->quantization = quantization;
+    for (int row = 0; row < index->count; row++) {
+        encode_row(index, row);
+    }
+    return true;
+}
+
+int vector_index_count(VectorIndex *index)
+{
+    return index != NULL ? index->live : 0;
+}
+
+int vector_index_dead_count(const VectorIndex *index)
+{
+    return index != NULL ? index->count - index->live : 0;
+}
+
+bool vector_index_compact(VectorIndex *index)
+{
+    if (vector_index_dead_count(index) == 0) {
+        return false;
+    }
+    compact(index);
+    return true;
+}
+
+size_t vector_index_memory(const VectorIndex *index)
+{
+    if (index == NULL) {
+        return 0;
+    }
+
+    size_t capacity = (size_t)index->capacity;
+    size_t per_row = (size_t)index->dimension * sizeof(float) + sizeof(int64_t) + sizeof(uint8_t) +
+                     (HNSW_M0 + 1) * sizeof(int) + sizeof(int *) + sizeof(uint32_t);
+    if (index->codes != NULL) {
+        per_row += (size_t)index->dimension + sizeof(float);
+    }
+    if (index->bits != NULL) {
+        per_row += VECTOR_BINARY_WORDS(index->dimension) * sizeof(uint64_t);
+    }
+
+    size_t bytes = sizeof(*index) + capacity * per_row;
+    bytes += index->slots != NULL ? (size_t)(index->slot_mask + 1) * sizeof(int) : 0;
+    for (int row = 0; row < index->linked; row++) {
+        bytes += (size_t)index->levels[row] * (HNSW_M + 1) * sizeof(int);
+    }
+    bytes += (size_t)(index->queue_capacity + index->found_capacity) * sizeof(Candidate);
+    return bytes;
+}
+
+int vector_index_build(VectorIndex *index, int budget)
+{
+    if (index == NULL) {
+        return 0;
+    }
+
+    while (index->linked < index->count && budget-- > 0) {
+        int row = index->linked;
+        if (index->labels[row] >= 0) {
+            link_node(index, row);
+        } else {
+            // Removed before it was linked: leave it unreachable
+            index->levels[row] = 0;
+            index->links0[(size_t)row * (HNSW_M0 + 1)] = 0;
+        }
+        index->linked++;
+    }
+    return index->count - index->linked;
+}
+
+// Helper: offer a hit to the top-k min-heap
+static void offer_hit(Candidate *top, int *count, int k, Candidate c)
+{
+    if (*count < k) {
+        heap_push(top, count, c, false);
+    } else if (c.score > top[0].score) {
+        top[0] = c;
+        heap_sift_down(top, *count, 0, false);
+    }
+}
+
+// Helper: score rows [from, count) in float32
+static void scan_exact(const VectorIndex *index, const float *query, int from, Candidate *top, int *count, int k)
+{
+    float scores[SCAN_BLOCK_ROWS];
+    for (int block = from; block < index->count; block += SCAN_BLOCK_ROWS) {
+        int block_rows = index->count - block < SCAN_BLOCK_ROWS ? index->count - block : SCAN_BLOCK_ROWS;
+        vector_dot_rows(row_at(index, block), block_rows, index->dimension, query, scores);
+
+        for (int i = 0; i < block_rows; i++) {
+            if (index->labels[block + i] >= 0) {
+                Candidate c = {scores[i], block + i};
+                offer_hit(top, count, k, c);
+            }
+        }
+    }
+}
+
+// Helper: shortlist rows [from, count) by their quantized codes, then rescore the
+// shortlist in float32. Returns false when the scan is too small to be worth it
+static bool scan_quantized(const VectorIndex *index, const float *query, int from, Candidate *top, int *count, int k)
+{
+    if (index->quantization == VECTOR_QUANT_NONE) {
+        return false;
+    }
+
+    int rescore = index->quantization == VECTOR_QUANT_BINARY ? 4 * VECTOR_INDEX_RESCORE : VECTOR_INDEX_RESCORE;
+    if (rescore < k) {
+        rescore = k;
+    }
+    if (index->count - from <= 2 * rescore) {
+        return false;
+    }
+
+    int dim = index->dimension;
+    int words = VECTOR_BINARY_WORDS(dim);
+    Candidate *shortlist = malloc((size_t)rescore * sizeof(Candidate));
+    void *code = malloc(index->quantization == VECTOR_QUANT_INT8 ? (size_t)dim : (size_t)words * sizeof(uint64_t));
+    if (shortlist == NULL || code == NULL) {
+        free(shortlist);
+        free(code);
+        return false;
+    }
+    int listed = 0;
+
+    if (index->quantization == VECTOR_QUANT_INT8) {
+        float query_scale = vector_quantize_int8(query, dim, code);
+        for (int row = from; row < index->count; row++) {
+            if (index->labels[row] >= 0) {
+                int32_t dot = vector_dot_int8(index->codes + (size_t)row * (size_t)dim, code, dim);
+                Candidate c = {(float)dot * index->code_scales[row] * query_scale, row};
+                offer_hit(shortlist, &listed, rescore, c);
+            }
+        }
+    } else {
+        vector_binarize(query, dim, code);
+        for (int row = from; row < index->count; row++) {
+            if (index->labels[row] >= 0) {
+                Candidate c = {-(float)vector_hamming(index->bits + (size_t)row * (size_t)words, code, words), row};
+                offer_hit(shortlist, &listed, rescore, c);
+            }
+        }
+    }
+
+    for (int i = 0; i < listed; i++) {
+        Candidate c = {vector_dot(row_at(index, shortlist[i].node), query, dim), shortlist[i].node};
+        offer_hit(top, count, k, c);
+    }
+
+    free(shortlist);
+    free(code);
+    return true;
+}
+
+int vector_index_search(VectorIndex *index, const float *query, int k, int ef, VectorIndexHit *hits)
+{
+    if (index == NULL || query == NULL || hits == NULL || k <= 0 || index->live == 0) {
+        return 0;
+    }
+
+    Candidate *top = malloc((size_t)k * sizeof(Candidate));
+    if (top == NULL) {
+        return 0;
+    }
+    int count = 0;
+
+    int exact_from = 0;
+    if (ef > 0 && index->entry >= 0 && index->live >= VECTOR_INDEX_EXACT_BELOW) {
+        Candidate current = {vector_dot(query, row_at(index, index->entry), index->dimension), index->entry};
+        for (int l = index->max_level; l > 0; l--) {
+            current = greedy_descend(index, query, current, l);
+        }
+
+        int found = search_level(index, query, current, ef > k ? ef : k, 0, true);
+        for (int i = 0; i < found; i++) {
+            offer_hit(top, &count, k, index->found[i]);
+        }
+        exact_from = index->linked;
+    }
+
+    // Exact pass over everything the graph doesn't cover
+    if (!scan_quantized(index, query, exact_from, top, &count, k)) {
+        scan_exact(index, query, exact_from, top, &count, k);
+    }
+
+    qsort(top, (size_t)count, sizeof(Candidate), compare_candidates_desc);
+    for (int i = 0; i < count; i++) {
+        hits[i].label = index->labels[top[i].node];
+        hits[i].score = top[i].score;
+    }
+
+    free(top);
+    return count;
+}
+
+// Persistence
+
+typedef struct IndexFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dimension;
+    uint32_t count;
+    uint32_t linked;
+    int32_t entry;
+    uint32_t max_level;
+    uint32_t reserved;
+    uint64_t signature;
+} IndexFileHeader;
+
+bool vector_index_save(VectorIndex *index, const char *file_path, uint64_t signature)
+{
+    if (index == NULL || file_path == NULL) {
+        return false;
+    }
+
+    char tmp_path[4096 + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", file_path);
+    FILE *f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        return false;
+    }
+
+    IndexFileHeader header = {
+        .magic = VECTOR_INDEX_MAGIC,
+        .version = VECTOR_INDEX_VERSION,
+        .dimension = (uint32_t)index->dimension,
+        .count = (uint32_t)index->count,
+        .linked = (uint32_t)index->linked,
+        .entry = index->entry,
+        .max_level = (uint32_t)index->max_level,
+        .signature = signature
+    };
+
+    size_t n = (size_t)index->count;
+    size_t linked = (size_t)index->linked;
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              (n == 0 || (fwrite(index->labels, sizeof(int64_t), n, f) == n &&
+                          fwrite(index->rows, sizeof(float) * (size_t)index->dimension, n, f) == n)) &&
+              (linked == 0 || (fwrite(index->levels, sizeof(uint8_t), linked, f) == linked &&
+                               fwrite(index->links0, (HNSW_M0 + 1) * sizeof(int), linked, f) == linked));
+    for (int row = 0; ok && row < index->linked; row++) {
+        size_t ints = (size_t)index->levels[row] * (HNSW_M + 1);
+        ok = ints == 0 || fwrite(index->upper[row], sizeof(int), ints, f) == ints;
+    }
+
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+    if (!ok || rename(tmp_path, file_path) != 0) {
+        remove(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+// Helper: check that a loaded neighbour list only points at linked rows
+static bool links_valid(const int *links, int max, int linked)
+{
+    if (links[0] < 0 || links[0] > max) {
+        return false;
+    }
+    for (int i = 1; i <= links[0]; i++) {
+        if (links[i] < 0 || links[i] >= linked) {
+            return false;
+        }
+    }
+    return true;
+}
+
+VectorIndex* vector_index_load(const char *file_path, int dimension, uint64_t signature)
+{
+    if (file_path == NULL) {
+        return NULL;
+    }
+
+    FILE *f = fopen(file_path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+
+    IndexFileHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        header.magic != VECTOR_INDEX_MAGIC || header.version != VECTOR_INDEX_VERSION ||
+        header.dimension != (uint32_t)dimension || header.signature != signature ||
+        header.count > INT32_MAX / 2 || header.linked > header.count ||
+        header.max_level > HNSW_MAX_LEVEL || header.entry >= (int32_t)header.linked ||
+        (header.linked > 0) != (header.entry >= 0)) {
+        fclose(f);
+        return NULL;
+    }
+
+    VectorIndex *index = vector_index_create(dimension);
+    if (index == NULL || !reserve(index, (int)header.count)) {
+        vector_index_destroy(index);
+        fclose(f);
+        return NULL;
+    }
+
+    size_t n = header.count;
+    size_t linked = header.linked;
+    bool ok = (n == 0 || (fread(index->labels, sizeof(int64_t), n, f) == n &&
+                          fread(index->rows, sizeof(float) * (size_t)dimension, n, f) == n)) &&
+              (linked == 0 || (fread(index->levels, sizeof(uint8_t), linked, f) == linked &&
+                               fread(index->links0, (HNSW_M0 + 1) * sizeof(int), linked, f) == linked));
+
+    index->count = (int)header.count;
+    index->entry = header.entry;
+    index->max_level = (int)header.max_level;
+    for (int row = 0; ok && row < (int)linked; row++) {
+        int level = index->levels[row];
+        if (level > index->max_level) {
+            ok = false;
+            break;
+        }
+        ok = links_valid(links_at(index, row, 0), HNSW_M0, (int)linked);
+        if (ok && level > 0) {
+            index->upper[row] = memory_alloc(MEMORY_TAG_AI, (size_t)level * (HNSW_M + 1) * sizeof(int));
+            ok = index->upper[row] != NULL &&
+                 fread(index->upper[row], sizeof(int), (size_t)level * (HNSW_M + 1), f) ==
+                     (size_t)level * (HNSW_M + 1);
+            for (int l = 1; ok && l <= level; l++) {
+                ok = links_valid(links_at(index, row, l), HNSW_M, (int)linked);
+            }
+        }
+        // Rows count as linked as they load, so a failure frees what was read
+        index->linked = row + 1;
+    }
+    fclose(f);
+
+    if (ok && index->entry >= 0 && index->levels[index->entry] != index->max_level) {
+        ok = false;
+    }
+    if (!ok) {
+        vector_index_destroy(index);
+        return NULL;
+    }
+
+    index->linked = (int)header.linked;
+    for (int row = 0; row < index->count; row++) {
+        if (index->labels[row] >= 0) {
+            insert_slot(index, row);
+            index->live++;
+        }
+    }
+    return index;
+}
@@ -0,0 +1,89 @@
+#ifndef VECTOR_INDEX_H
+#define VECTOR_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Resident store of unit-length vectors keyed by a 64-bit label, with an HNSW graph
+// (hierarchical navigable small world) for approximate nearest-neighbour queries.
+// Not thread-safe: callers serialize access
+
+// Default HNSW candidate list size for queries (higher = better recall, slower)
+#define VECTOR_INDEX_DEFAULT_EF 64
+
+// Below this many vectors queries always scan exactly
+#define VECTOR_INDEX_EXACT_BELOW 4096
+
+// Candidates rescored with full-precision vectors after a quantized prefilter
+#define VECTOR_INDEX_RESCORE 256
+
+// Compressed copy of the vectors that exact scans prefilter with
+typedef enum VectorQuantization {
+    VECTOR_QUANT_NONE = 0,      // Score every vector in float32
+    VECTOR_QUANT_INT8,          // int8 codes (4x smaller), rescore the best VECTOR_INDEX_RESCORE
+    VECTOR_QUANT_BINARY         // Sign bits (32x smaller), rescore 4x as many
+} VectorQuantization;
+
+// Query hit
+typedef struct VectorIndexHit {
+    int64_t label;
+    float score;            // Dot product with the query
+} VectorIndexHit;
+
+// Vector index context (opaque)
+typedef struct VectorIndex VectorIndex;
+
+// Create an empty index for vectors of the given dimension
+VectorIndex* vector_index_create(int dimension);
+
+// Free the index
+void vector_index_destroy(VectorIndex *index);
+
+// Drop every vector
+void vector_index_clear(VectorIndex *index);
+
+// Insert or replace the vector for label (stored normalized); links it into the graph
+// immediately when the graph is caught up
+bool vector_index_put(VectorIndex *index, int64_t label, const float *vector);
+
+// Like vector_index_put, but never links: for bulk loads that vector_index_build finishes later
+bool vector_index_append(VectorIndex *index, int64_t label, const float *vector);
+
+// Remove the vector for label (no-op if absent)
+void vector_index_remove(VectorIndex *index, int64_t label);
+
+// Stored unit vector for label, or NULL (valid until the next write)
+const float* vector_index_get(VectorIndex *index, int64_t label);
+
+// Choose the prefilter used by exact scans (codes are rebuilt for stored vectors)
+bool vector_index_set_quantization(VectorIndex *index, VectorQuantization quantization);
+
+// Number of stored vectors
+int vector_index_count(VectorIndex *index);
+
+// Removed vectors whose rows are still held (as graph waypoints) until a compaction
+int vector_index_dead_count(const VectorIndex *index);
+
+// Rewrite the store without removed rows now instead of when they outnumber live ones;
+// the graph is unlinked and vector_index_build links it again. False if none were removed
+bool vector_index_compact(VectorIndex *index);
+
+// Bytes held by the index: vectors, quantized codes, label table and graph
+size_t vector_index_memory(const VectorIndex *index);
+
+// Link up to budget vectors that are not in the graph yet; returns how many are left
+int vector_index_build(VectorIndex *index, int budget);
+
+// Best k vectors by dot product with a unit query, highest first; ef <= 0 scans exactly.
+// Vectors not linked into the graph yet are always scanned exactly (through the
+// quantized prefilter when one is set and the scan is large)
+int vector_index_search(VectorIndex *index, const float *query, int k, int ef, VectorIndexHit *hits);
+
+// Write the index to file_path, tagged with a caller-defined signature of its source data
+bool vector_index_save(VectorIndex *index, const char *file_path, uint64_t signature);
+
+// Load an index saved with the same dimension and signature (NULL if missing or stale)
+VectorIndex* vector_index_load(const char *file_path, int dimension, uint64_t signature);
+
+#endif // VECTOR_INDEX_H
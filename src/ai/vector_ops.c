@@ -0,0 +1,286 @@
+#include "vector_ops.h"
+#include "ai_common.h"
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__APPLE__)
+#include <Accelerate/Accelerate.h>
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VECTOR_OPS_X86 1
+#endif
+
+// Portable kernel: eight independent lanes so the compiler can vectorize without -ffast-math
+static float dot_scalar(const float *a, const float *b, int dimension)
+{
+    float lanes[8] = {0};
+    int i = 0;
+    for (; i + 8 <= dimension; i += 8) {
+        for (int k = 0; k < 8; k++) {
+            lanes[k] += a[i + k] * b[i + k];
+        }
+    }
+
+    float dot = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) +
+                ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    for (; i < dimension; i++) {
+        dot += a[i] * b[i];
+    }
+    return dot;
+}
+
+#if defined(__ARM_NEON)
+static float dot_neon(const float *a, const float *b, int dimension)
+{
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x4_t acc2 = vdupq_n_f32(0.0f);
+    float32x4_t acc3 = vdupq_n_f32(0.0f);
+
+    int i = 0;
+    for (; i + 16 <= dimension; i += 16) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        acc2 = vfmaq_f32(acc2, vld1q_f32(a + i + 8), vld1q_f32(b + i + 8));
+        acc3 = vfmaq_f32(acc3, vld1q_f32(a + i + 12), vld1q_f32(b + i + 12));
+    }
+
+    float dot = vaddvq_f32(vaddq_f32(vaddq_f32(acc0, acc1), vaddq_f32(acc2, acc3)));
+    for (; i < dimension; i++) {
+        dot += a[i] * b[i];
+    }
+    return dot;
+}
+#endif
+
+#if defined(__ARM_NEON)
+static int32_t dot_int8_neon(const int8_t *a, const int8_t *b, int dimension)
+{
+    int32x4_t acc0 = vdupq_n_s32(0);
+    int32x4_t acc1 = vdupq_n_s32(0);
+
+    int i = 0;
+    for (; i + 16 <= dimension; i += 16) {
+        int8x16_t va = vld1q_s8(a + i);
+        int8x16_t vb = vld1q_s8(b + i);
+        acc0 = vpadalq_s16(acc0, vmull_s8(vget_low_s8(va), vget_low_s8(vb)));
+        acc1 = vpadalq_s16(acc1, vmull_s8(vget_high_s8(va), vget_high_s8(vb)));
+    }
+
+    int32_t dot = vaddvq_s32(vaddq_s32(acc0, acc1));
+    for (; i < dimension; i++) {
+        dot += (int32_t)a[i] * b[i];
+    }
+    return dot;
+}
+#endif
+
+#if defined(VECTOR_OPS_X86)
+__attribute__((target("avx2,fma")))
+static float dot_avx2(const float *a, const float *b, int dimension)
+{
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+
+    int i = 0;
+    for (; i + 32 <= dimension; i += 32) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+    }
+    for (; i + 8 <= dimension; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+
+    __m256 sum = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+
+    float dot = _mm_cvtss_f32(half);
+    for (; i < dimension; i++) {
+        dot += a[i] * b[i];
+    }
+    return dot;
+}
+
+__attribute__((target("avx2")))
+static int32_t dot_int8_avx2(const int8_t *a, const int8_t *b, int dimension)
+{
+    __m256i acc = _mm256_setzero_si256();
+
+    int i = 0;
+    for (; i + 16 <= dimension; i += 16) {
+        __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(a + i)));
+        __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(b + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+
+    int32_t lanes[8];
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    int32_t dot = lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+    for (; i < dimension; i++) {
+        dot += (int32_t)a[i] * b[i];
+    }
+    return dot;
+}
+
+// AVX2 is not part of the x86-64 baseline, so pick the kernel at runtime
+static bool has_avx2(void)
+{
+    static int supported = -1;
+    if (supported < 0) {
+        supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    }
+    return supported != 0;
+}
+#endif
+
+float vector_dot(const float *a, const float *b, int dimension)
+{
+    if (a == NULL || b == NULL || dimension <= 0) {
+        return 0.0f;
+    }
+
+#if defined(__ARM_NEON)
+    return dot_neon(a, b, dimension);
+#elif defined(VECTOR_OPS_X86)
+    if (has_avx2()) {
+        return dot_avx2(a, b, dimension);
+    }
+    return dot_scalar(a, b, dimension);
+#else
+    return dot_scalar(a, b, dimension);
+#endif
+}
+
+void vector_dot_rows(const float *rows, int row_count, int dimension,
+                     const float *query, float *scores)
+{
+    if (rows == NULL || query == NULL || scores == NULL || row_count <= 0 || dimension <= 0) {
+        return;
+    }
+
+#if defined(__APPLE__)
+    // One matrix-vector product streams the whole block through the AMX/SIMD units
+    cblas_sgemv(CblasRowMajor, CblasNoTrans, row_count, dimension,
+                1.0f, rows, dimension, query, 1, 0.0f, scores, 1);
+#else
+    for (int i = 0; i < row_count; i++) {
+        scores[i] = vector_dot(rows + (size_t)i * (size_t)dimension, query, dimension);
+    }
+#endif
+}
+
+void vector_normalize(float *v, int dimension)
+{
+    if (v == NULL || dimension <= 0) {
+        return;
+    }
+
+    float norm = sqrtf(vector_dot(v, v, dimension));
+    if (norm < AI_EPSILON) {
+        return;
+    }
+
+    float inv = 1.0f / norm;
+    for (int i = 0; i < dimension; i++) {
+        v[i] *= inv;
+    }
+}
+
+float vector_cosine(const float *a, const float *b, int dimension)
+{
+    if (a == NULL || b == NULL) {
+        return 0.0f;
+    }
+
+    float denom = sqrtf(vector_dot(a, a, dimension)) * sqrtf(vector_dot(b, b, dimension));
+    if (denom < AI_EPSILON) {
+        return 0.0f;
+    }
+    return vector_dot(a, b, dimension) / denom;
+}
+
+float vector_quantize_int8(const float *v, int dimension, int8_t *codes)
+{
+    if (v == NULL || codes == NULL || dimension <= 0) {
+        return 0.0f;
+    }
+
+    float max_abs = 0.0f;
+    for (int i = 0; i < dimension; i++) {
+        float a = fabsf(v[i]);
+        if (a > max_abs) {
+            max_abs = a;
+        }
+    }
+    if (max_abs < AI_EPSILON) {
+        memset(codes, 0, (size_t)dimension);
+        return 0.0f;
+    }
+
+    // Per-vector scale uses the full code range
+    float inv = 127.0f / max_abs;
+    for (int i = 0; i < dimension; i++) {
+        codes[i] = (int8_t)lrintf(v[i] * inv);
+    }
+    return max_abs / 127.0f;
+}
+
+int32_t vector_dot_int8(const int8_t *a, const int8_t *b, int dimension)
+{
+    if (a == NULL || b == NULL || dimension <= 0) {
+        return 0;
+    }
+
+#if defined(__ARM_NEON)
+    return dot_int8_neon(a, b, dimension);
+#else
+#if defined(VECTOR_OPS_X86)
+    if (has_avx2()) {
+        return dot_int8_avx2(a, b, dimension);
+    }
+#endif
+    int32_t dot = 0;
+    for (int i = 0; i < dimension; i++) {
+        dot += (int32_t)a[i] * b[i];
+    }
+    return dot;
+#endif
+}
+
+void vector_binarize(const float *v, int dimension, uint64_t *bits)
+{
+    if (v == NULL || bits == NULL || dimension <= 0) {
+        return;
+    }
+
+    memset(bits, 0, (size_t)VECTOR_BINARY_WORDS(dimension) * sizeof(uint64_t));
+    for (int i = 0; i < dimension; i++) {
+        if (v[i] > 0.0f) {
+            bits[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+}
+
+int vector_hamming(const uint64_t *a, const uint64_t *b, int words)
+{
+    if (a == NULL || b == NULL) {
+        return 0;
+    }
+
+    int distance = 0;
+    for (int i = 0; i < words; i++) {
+        distance += __builtin_popcountll(a[i] ^ b[i]);
+    }
+    return distance;
+}
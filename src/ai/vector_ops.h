@@ -0,0 +1,37 @@
+#ifndef VECTOR_OPS_H
+#define VECTOR_OPS_H
+
+#include <stdint.h>
+
+// Dense float vector kernels shared by the embedding searches.
+// Stored embeddings are L2-normalized, so cosine similarity reduces to a dot product
+
+// 64-bit words in the binary (sign bit) code of a vector
+#define VECTOR_BINARY_WORDS(dimension) (((dimension) + 63) / 64)
+
+// Dot product of two vectors (no alignment requirement)
+float vector_dot(const float *a, const float *b, int dimension);
+
+// Dot product of query against each of row_count contiguous rows: scores[i] = rows[i] . query
+void vector_dot_rows(const float *rows, int row_count, int dimension,
+                     const float *query, float *scores);
+
+// Scale v to unit length (zero vectors are left as they are)
+void vector_normalize(float *v, int dimension);
+
+// Cosine similarity of two vectors that are not known to be normalized
+float vector_cosine(const float *a, const float *b, int dimension);
+
+// Quantize v to int8 codes; returns the scale with v[i] ~= codes[i] * scale
+float vector_quantize_int8(const float *v, int dimension, int8_t *codes);
+
+// Dot product of two int8 code vectors
+int32_t vector_dot_int8(const int8_t *a, const int8_t *b, int dimension);
+
+// One sign bit per component (set for positive), VECTOR_BINARY_WORDS(dimension) words
+void vector_binarize(const float *v, int dimension, uint64_t *bits);
+
+// Number of differing bits between two binary codes
+int vector_hamming(const uint64_t *a, const uint64_t *b, int words);
+
+#endif // VECTOR_OPS_H
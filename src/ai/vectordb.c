@@ -1,24 +1,137 @@
 #include "vectordb.h"
+#include "ai_common.h"
+#include "vector_ops.h"
+#include "vector_index.h"
+#include "../utils/trace.h"
+#include "../utils/file_type.h"
+#include "../utils/jobs.h"
+#include "../utils/hash.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <time.h>
+#include <pthread.h>
 #include <sqlite3.h>
 
 // VectorDB internal structure
+// Path of one resident embedding, for directory-scoped searches
+typedef struct DirectoryEntry {
+    char *path;
+    int64_t id;
+} DirectoryEntry;
+
+// Read statements prepared on one connection
+typedef struct VectorDBReader {
+    sqlite3 *db;
+    sqlite3_stmt *stmt_get_by_path;
+    sqlite3_stmt *stmt_check_indexed;
+    sqlite3_stmt *stmt_get_by_id;
+    sqlite3_stmt *stmt_get_content;
+    sqlite3_stmt *stmt_get_chunk;
+    sqlite3_stmt *stmt_search_text;     // NULL without the full-text index
+    bool in_use;
+} VectorDBReader;
+
+// Database of the files under one mount point (see vectordb_attach_shard)
+typedef struct VectorDBShard {
+    VectorDB *db;
+    char *root;                 // Without a trailing slash
+    size_t root_length;
+    int users;                  // Calls using it; detaching waits for none
+} VectorDBShard;
+
 struct VectorDB {
     sqlite3 *db;
     char db_path[4096];
     bool initialized;
 
+    // Model whose embeddings are written and searched ("" = none set; see
+    // vectordb_set_model); SQL reads it through embedding_model()
+    char model[VECTORDB_MODEL_SIZE];
+
     // Prepared statements for performance
     sqlite3_stmt *stmt_insert;
     sqlite3_stmt *stmt_update_embedding;
     sqlite3_stmt *stmt_delete;
-    sqlite3_stmt *stmt_get_by_path;
-    sqlite3_stmt *stmt_check_indexed;
-    sqlite3_stmt *stmt_get_all_embeddings;
+    sqlite3_stmt *stmt_get_id;
+    sqlite3_stmt *stmt_put_content;
+    sqlite3_stmt *stmt_release_content;
+    sqlite3_stmt *stmt_insert_chunk;
+    sqlite3_stmt *stmt_get_file_chunks;
+    sqlite3_stmt *stmt_delete_file_chunks;
+    sqlite3_stmt *stmt_insert_text;
+    sqlite3_stmt *stmt_set_text;
+    sqlite3_stmt *stmt_delete_text;
+    bool has_fulltext;          // file_text exists (SQLite built with FTS5)
+
+    // Reads go through a pool of read-only connections, each reading one committed
+    // snapshot, so searches never wait on the writer's transaction. The thread with a
+    // batch open reads through the writer instead, seeing its own uncommitted rows
+    VectorDBReader writer_reads;
+    VectorDBReader readers[VECTORDB_READERS];
+    pthread_mutex_t readers_mutex;
+    pthread_cond_t reader_free;
+
+    // Resident embeddings and their ANN graph: loaded on first use, then kept in
+    // sync by every write and saved to index_path
+    VectorIndex *vectors;
+    bool vectors_dirty;
+    VectorQuantization quantization;
+    char index_path[4096 + 8];
+    pthread_mutex_t vectors_mutex;
+
+    // Open write transaction from vectordb_begin_batch, and the thread that opened it
+    bool in_batch;
+    pthread_t batch_thread;
+
+    // Paths of the resident embeddings, loaded by the first scoped search. Sorted the
+    // way LIKE compares (ASCII case-insensitive), a directory is one contiguous range.
+    // Entries whose id has no vector any more are dropped at the next sort
+    DirectoryEntry *dir_entries;
+    int dir_count;
+    int dir_capacity;
+    bool dir_loaded;
+    bool dir_sorted;
+
+    // Attached volume databases. A call routed to one holds it (users) without holding
+    // shards_mutex, so callbacks may call back in; shards never have shards of their own
+    VectorDBShard *shards[VECTORDB_MAX_SHARDS];
+    int shard_count;
+    pthread_mutex_t shards_mutex;
+    pthread_cond_t shard_idle;
 };
 
+// Databases one call spans: db itself unless the call is about files inside a shard,
+// and the shards it holds
+typedef struct VectorDBScope {
+    bool self;
+    VectorDBShard *shards[VECTORDB_MAX_SHARDS];
+    int count;
+} VectorDBScope;
+
+// Sections share the resident index with whole files: their label is their row ID
+// plus this, above any file ID
+#define CHUNK_LABEL_BASE (INT64_C(1) << 62)
+
+// Hybrid search: full-text matches whose vectors are rescored, vector hits taken into
+// the fusion, and the reciprocal rank fusion constant (damps the weight of top ranks)
+#define HYBRID_LEXICAL_CANDIDATES 2000
+#define HYBRID_VECTOR_DEPTH (VECTORDB_MAX_RESULTS * 2)
+#define HYBRID_RRF_K 60.0f
+
+// Longest FTS5 query built from the search text
+#define HYBRID_MATCH_SIZE 2048
+
+// Upkeep: the resident index is compacted once deleted embeddings are this share of it,
+// and a database made before incremental vacuum is converted by a full VACUUM once
+// this share of its pages is unused
+#define MAINTAIN_COMPACT_PERCENT 10
+#define MAINTAIN_CONVERT_PERCENT 25
+
+// Rows ANALYZE samples per index, bounding how long it takes on a large database
+#define MAINTAIN_ANALYSIS_LIMIT 1000
+
 // SQL statements
 static const char *SQL_CREATE_TABLE =
     "CREATE TABLE IF NOT EXISTS indexed_files ("
@@ -29,18 +142,63 @@ static const char *SQL_CREATE_TABLE =
     "  size INTEGER NOT NULL,"
     "  modified_time INTEGER NOT NULL,"
     "  indexed_time INTEGER NOT NULL,"
-    "  embedding BLOB"
+    "  embedding BLOB,"
+    "  content_hash TEXT"
     ");"
     "CREATE INDEX IF NOT EXISTS idx_path ON indexed_files(path);"
-    "CREATE INDEX IF NOT EXISTS idx_modified ON indexed_files(modified_time);";
+    "CREATE INDEX IF NOT EXISTS idx_modified ON indexed_files(modified_time);"
+    "CREATE TABLE IF NOT EXISTS content_embeddings ("
+    "  content_hash TEXT PRIMARY KEY,"
+    "  embedding BLOB NOT NULL"
+    ");";
+
+// Rows with a content hash share one embedding in content_embeddings; the column on
+// the row itself is only set for unhashed files and vectordb_update_embedding
+#define SQL_STORED_EMBEDDING \
+    "COALESCE(f.embedding, (SELECT e.embedding FROM content_embeddings e " \
+    "WHERE e.content_hash = f.content_hash))"
+
+// The stored embedding if the current model made it: every read and search goes
+// through this, so vectors of another model are never compared with a query
+#define SQL_FILE_EMBEDDING \
+    "(CASE WHEN f.embedding IS NOT NULL AND f.model IS embedding_model() THEN f.embedding " \
+    "ELSE (SELECT e.embedding FROM content_embeddings e " \
+    "WHERE e.content_hash = f.content_hash AND e.model IS embedding_model()) END)"
+
+// Embedded, or split into sections, by another model: to be embedded again
+#define SQL_FILE_STALE \
+    "((" SQL_FILE_EMBEDDING " IS NULL AND " SQL_STORED_EMBEDDING " IS NOT NULL) OR " \
+    "EXISTS (SELECT 1 FROM file_chunks c WHERE c.file_id = f.id AND c.model IS NOT embedding_model()))"
 
 static const char *SQL_INSERT =
     "INSERT OR REPLACE INTO indexed_files "
-    "(path, name, file_type, size, modified_time, indexed_time, embedding) "
-    "VALUES (?, ?, ?, ?, ?, ?, ?);";
+    "(path, name, file_type, size, modified_time, indexed_time, embedding, content_hash, model) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?, ?, embedding_model());";
+
+// Identical content keeps the embedding stored first, unless another model made it
+static const char *SQL_PUT_CONTENT =
+    "INSERT INTO content_embeddings (content_hash, embedding, model) VALUES (?, ?, embedding_model()) "
+    "ON CONFLICT(content_hash) DO UPDATE SET embedding = excluded.embedding, model = excluded.model "
+    "WHERE model IS NOT excluded.model;";
+
+static const char *SQL_GET_CONTENT =
+    "SELECT embedding FROM content_embeddings WHERE content_hash = ? AND model IS embedding_model();";
+
+// Rows sharing a content embedding that was just replaced
+static const char *SQL_GET_CONTENT_FILES =
+    "SELECT id, path FROM indexed_files WHERE content_hash = ? AND id != ?;";
+
+// Drop a shared embedding once no row refers to it
+static const char *SQL_RELEASE_CONTENT =
+    "DELETE FROM content_embeddings WHERE content_hash = ?1 "
+    "AND NOT EXISTS (SELECT 1 FROM indexed_files WHERE content_hash = ?1);";
+
+static const char *SQL_PRUNE_CONTENT =
+    "DELETE FROM content_embeddings WHERE NOT EXISTS "
+    "(SELECT 1 FROM indexed_files f WHERE f.content_hash = content_embeddings.content_hash);";
 
 static const char *SQL_UPDATE_EMBEDDING =
-    "UPDATE indexed_files SET embedding = ?, indexed_time = ? WHERE path = ?;";
+    "UPDATE indexed_files SET embedding = ?, indexed_time = ?, model = embedding_model() WHERE path = ?;";
 
 static const char *SQL_DELETE =
     "DELETE FROM indexed_files WHERE path = ?;";
@@ -49,28 +207,131 @@ static const char *SQL_DELETE_DIR =
     "DELETE FROM indexed_files WHERE path LIKE ? || '%';";
 
 static const char *SQL_GET_BY_PATH =
-    "SELECT id, path, name, file_type, size, modified_time, indexed_time, embedding "
-    "FROM indexed_files WHERE path = ?;";
+    "SELECT id, path, name, file_type, size, modified_time, indexed_time, " SQL_FILE_EMBEDDING " "
+    "FROM indexed_files f WHERE path = ?;";
+
+// Everything under a directory in path order: the two bounds are "<dir>/" and "<dir>0"
+// ('0' follows '/'), a range the path index answers
+static const char *SQL_GET_FILES_UNDER =
+    "SELECT id, path, name, file_type, size, modified_time, indexed_time, " SQL_FILE_EMBEDDING ", "
+    "content_hash FROM indexed_files f WHERE path > ? AND path < ? ORDER BY path;";
 
 static const char *SQL_CHECK_INDEXED =
-    "SELECT 1 FROM indexed_files WHERE path = ? AND modified_time >= ?;";
+    "SELECT 1 FROM indexed_files f WHERE path = ? AND modified_time >= ? AND NOT " SQL_FILE_STALE ";";
+
+static const char *SQL_GET_ALL_VECTORS =
+    "SELECT id, " SQL_FILE_EMBEDDING " FROM indexed_files f "
+    "WHERE " SQL_FILE_EMBEDDING " IS NOT NULL;";
+
+static const char *SQL_GET_BY_ID =
+    "SELECT id, path, name, file_type, size, modified_time, indexed_time, " SQL_FILE_EMBEDDING " "
+    "FROM indexed_files f WHERE id = ?;";
+
+static const char *SQL_GET_ID =
+    "SELECT id, content_hash FROM indexed_files WHERE path = ?;";
+
+static const char *SQL_GET_DIR_IDS =
+    "SELECT id FROM indexed_files WHERE path LIKE ? || '%';";
+
+static const char *SQL_GET_EMBEDDED_PATHS =
+    "SELECT id, path FROM indexed_files f WHERE " SQL_FILE_EMBEDDING " IS NOT NULL;";
+
+// Any insert gets a new id, any delete changes the count, any update bumps indexed_time
+static const char *SQL_EMBEDDING_SIGNATURE =
+    "SELECT COUNT(*), COALESCE(MAX(id), 0), COALESCE(MAX(indexed_time), 0) "
+    "FROM indexed_files f WHERE " SQL_FILE_EMBEDDING " IS NOT NULL;";
+
+// Sections are only ever inserted or deleted, never updated
+static const char *SQL_CHUNK_SIGNATURE =
+    "SELECT COUNT(*), COALESCE(MAX(id), 0) FROM file_chunks;";
+
+static const char *SQL_INSERT_CHUNK =
+    "INSERT INTO file_chunks (file_id, byte_offset, byte_length, title, embedding, model) "
+    "VALUES (?, ?, ?, ?, ?, embedding_model());";
+
+static const char *SQL_GET_FILE_CHUNKS =
+    "SELECT id FROM file_chunks WHERE file_id = ?;";
 
-static const char *SQL_GET_ALL_EMBEDDINGS =
-    "SELECT id, path, name, file_type, size, modified_time, indexed_time, embedding "
-    "FROM indexed_files WHERE embedding IS NOT NULL;";
+static const char *SQL_DELETE_FILE_CHUNKS =
+    "DELETE FROM file_chunks WHERE file_id = ?;";
 
-static const char *SQL_GET_DIR_EMBEDDINGS =
-    "SELECT id, path, name, file_type, size, modified_time, indexed_time, embedding "
-    "FROM indexed_files WHERE embedding IS NOT NULL AND path LIKE ? || '%';";
+static const char *SQL_GET_CHUNK =
+    "SELECT file_id, byte_offset, byte_length, title FROM file_chunks WHERE id = ?;";
+
+static const char *SQL_GET_ALL_CHUNK_VECTORS =
+    "SELECT id, embedding FROM file_chunks WHERE model IS embedding_model();";
+
+static const char *SQL_GET_CHUNK_PATHS =
+    "SELECT c.id, f.path FROM file_chunks c JOIN indexed_files f ON f.id = c.file_id "
+    "WHERE c.model IS embedding_model();";
+
+static const char *SQL_GET_DIR_CHUNK_IDS =
+    "SELECT c.id FROM file_chunks c JOIN indexed_files f ON f.id = c.file_id "
+    "WHERE f.path LIKE ? || '%';";
+
+static const char *SQL_DELETE_DIR_CHUNKS =
+    "DELETE FROM file_chunks WHERE file_id IN "
+    "(SELECT id FROM indexed_files WHERE path LIKE ? || '%');";
+
+static const char *SQL_INSERT_TEXT =
+    "INSERT INTO file_text (rowid, name) VALUES (?, ?);";
+
+static const char *SQL_SET_TEXT =
+    "UPDATE file_text SET body = ? WHERE rowid = ?;";
+
+static const char *SQL_DELETE_TEXT =
+    "DELETE FROM file_text WHERE rowid = ?;";
+
+static const char *SQL_DELETE_DIR_TEXT =
+    "DELETE FROM file_text WHERE rowid IN "
+    "(SELECT id FROM indexed_files WHERE path LIKE ? || '%');";
+
+// Names weigh more than body text: a term in the file name is the stronger signal
+static const char *SQL_SEARCH_TEXT =
+    "SELECT file_text.rowid FROM file_text JOIN indexed_files f ON f.id = file_text.rowid "
+    "WHERE file_text MATCH ?1 AND (?2 IS NULL OR f.path LIKE ?2 || '%') "
+    "ORDER BY bm25(file_text, 4.0, 1.0) LIMIT ?3;";
+
+static const char *SQL_CLEAR_TEXT =
+    "DELETE FROM file_text;";
+
+static const char *SQL_COUNT_CHUNKS =
+    "SELECT COUNT(*) FROM file_chunks;";
 
 static const char *SQL_COUNT =
     "SELECT COUNT(*) FROM indexed_files;";
 
+static const char *SQL_COUNT_STALE =
+    "SELECT COUNT(*) FROM indexed_files f WHERE " SQL_FILE_STALE ";";
+
+static const char *SQL_GET_STALE =
+    "SELECT path FROM indexed_files f WHERE path > ? AND " SQL_FILE_STALE " ORDER BY path LIMIT ?;";
+
+// Paths outside a directory: below "<dir>/" or from "<dir>0" on
+static const char *SQL_GET_PATHS_OUTSIDE =
+    "SELECT path FROM indexed_files WHERE path < ? OR path >= ?;";
+
+// Embeddings stored before models were recorded (or before one was set) are taken to
+// be the current model's
+static const char *SQL_ADOPT_UNTAGGED =
+    "UPDATE indexed_files SET model = embedding_model() WHERE model IS NULL AND embedding IS NOT NULL;"
+    "UPDATE content_embeddings SET model = embedding_model() WHERE model IS NULL;"
+    "UPDATE file_chunks SET model = embedding_model() WHERE model IS NULL;";
+
 static const char *SQL_TOTAL_SIZE =
     "SELECT COALESCE(SUM(size), 0) FROM indexed_files;";
 
 static const char *SQL_CLEAR =
-    "DELETE FROM indexed_files;";
+    "DELETE FROM indexed_files;"
+    "DELETE FROM file_chunks;"
+    "DELETE FROM content_embeddings;"
+    "DELETE FROM watch_checkpoints;";
+
+static const char *SQL_GET_CHECKPOINT =
+    "SELECT event_id FROM watch_checkpoints WHERE root = ?;";
+
+static const char *SQL_SET_CHECKPOINT =
+    "INSERT OR REPLACE INTO watch_checkpoints (root, event_id) VALUES (?, ?);";
 
 // Schema version table
 static const char *SQL_CREATE_VERSION_TABLE =
@@ -85,14 +346,53 @@ static const char *SQL_SET_VERSION =
     "INSERT OR REPLACE INTO schema_version (version) VALUES (?);";
 
 // Current schema version
-#define CURRENT_SCHEMA_VERSION 2
+#define CURRENT_SCHEMA_VERSION 7
 
 // Migration 1: Initial schema (already applied if table exists)
 // Migration 2: Add content_hash column for duplicate detection
 static const char *MIGRATION_2 =
-    "ALTER TABLE indexed_files ADD COLUMN content_hash TEXT;"
+    "ALTER TABLE indexed_files ADD COLUMN content_hash TEXT;";
+
+// Migration 3: Index content_hash (version 2 databases created fresh never got the column)
+static const char *MIGRATION_3 =
     "CREATE INDEX IF NOT EXISTS idx_content_hash ON indexed_files(content_hash);";
 
+// Migration 4: Last FSEvents ID applied per watch root, for catch-up on launch
+static const char *MIGRATION_4 =
+    "CREATE TABLE IF NOT EXISTS watch_checkpoints ("
+    "  root TEXT PRIMARY KEY,"
+    "  event_id INTEGER NOT NULL"
+    ");";
+
+// Migration 5: Sections of long files, embedded separately
+static const char *MIGRATION_5 =
+    "CREATE TABLE IF NOT EXISTS file_chunks ("
+    "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    "  file_id INTEGER NOT NULL,"
+    "  byte_offset INTEGER NOT NULL,"
+    "  byte_length INTEGER NOT NULL,"
+    "  title TEXT,"
+    "  embedding BLOB NOT NULL"
+    ");"
+    "CREATE INDEX IF NOT EXISTS idx_chunk_file ON file_chunks(file_id);";
+
+// Migration 6: Full-text index of names and extracted text (rowid is the file ID), for
+// identifiers and names the embeddings miss. Files already indexed get their names now
+// and their text when next reindexed. SQLite without FTS5 fails this; search then
+// stays vector-only
+static const char *MIGRATION_6 =
+    "CREATE VIRTUAL TABLE IF NOT EXISTS file_text USING fts5("
+    "  name, body, tokenize = 'unicode61 remove_diacritics 2'"
+    ");"
+    "INSERT INTO file_text (rowid, name) SELECT id, name FROM indexed_files;";
+
+// Migration 7: The model that made each embedding (NULL until vectordb_set_model
+// claims it), so a new model searches only its own vectors while the rest are redone
+static const char *MIGRATION_7 =
+    "ALTER TABLE indexed_files ADD COLUMN model TEXT;"
+    "ALTER TABLE content_embeddings ADD COLUMN model TEXT;"
+    "ALTER TABLE file_chunks ADD COLUMN model TEXT;";
+
 // Helper: deserialize embedding from blob
 static bool deserialize_embedding(const void *blob, int blob_size, float *output)
 {
@@ -135,549 +435,2801 @@ static void fill_indexed_file(sqlite3_stmt *stmt, IndexedFile *file)
     file->has_embedding = deserialize_embedding(embedding_blob, embedding_size, file->embedding);
 }
 
-VectorDB* vectordb_open(const char *db_path)
+// Helper: fingerprint of the stored embeddings, used to tell whether a saved index is current
+static uint64_t embedding_signature(VectorDB *db)
 {
-    if (db_path == NULL) {
-        return NULL;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db->db, SQL_EMBEDDING_SIGNATURE, -1, &stmt, NULL) != SQLITE_OK) {
+        return 0;
     }
 
-    VectorDB *db = calloc(1, sizeof(VectorDB));
-    if (db == NULL) {
-        return NULL;
+    // A saved index of another model's vectors never matches
+    uint64_t signature = hash_fnv1a64_string(HASH_FNV1A64_INIT, db->model);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        for (int i = 0; i < 3; i++) {
+            signature ^= (uint64_t)sqlite3_column_int64(stmt, i);
+            signature *= HASH_FNV1A64_PRIME;
+        }
     }
+    sqlite3_finalize(stmt);
 
-    strncpy(db->db_path, db_path, sizeof(db->db_path) - 1);
-
-    int rc = sqlite3_open(db_path, &db->db);
-    if (rc != SQLITE_OK) {
-        free(db);
-        return NULL;
+    if (sqlite3_prepare_v2(db->db, SQL_CHUNK_SIGNATURE, -1, &stmt, NULL) != SQLITE_OK) {
+        return 0;
     }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        for (int i = 0; i < 2; i++) {
+            signature ^= (uint64_t)sqlite3_column_int64(stmt, i);
+            signature *= HASH_FNV1A64_PRIME;
+        }
+    }
+    sqlite3_finalize(stmt);
+    return signature;
+}
 
-    // Enable WAL mode for better performance
-    sqlite3_exec(db->db, "PRAGMA journal_mode=WAL;", NULL, NULL, NULL);
-    sqlite3_exec(db->db, "PRAGMA synchronous=NORMAL;", NULL, NULL, NULL);
-
-    // Initialize schema
-    if (vectordb_init_schema(db) != VECTORDB_STATUS_OK) {
-        vectordb_close(db);
-        return NULL;
+// Helper: add the (id, embedding) rows of query to vectors, labelled id + label_base
+static bool append_vectors(VectorDB *db, VectorIndex *vectors, const char *query, int64_t label_base)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db->db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
     }
 
-    // Prepare statements
-    sqlite3_prepare_v2(db->db, SQL_INSERT, -1, &db->stmt_insert, NULL);
-    sqlite3_prepare_v2(db->db, SQL_UPDATE_EMBEDDING, -1, &db->stmt_update_embedding, NULL);
-    sqlite3_prepare_v2(db->db, SQL_DELETE, -1, &db->stmt_delete, NULL);
-    sqlite3_prepare_v2(db->db, SQL_GET_BY_PATH, -1, &db->stmt_get_by_path, NULL);
-    sqlite3_prepare_v2(db->db, SQL_CHECK_INDEXED, -1, &db->stmt_check_indexed, NULL);
-    sqlite3_prepare_v2(db->db, SQL_GET_ALL_EMBEDDINGS, -1, &db->stmt_get_all_embeddings, NULL);
+    bool ok = true;
+    while (ok && sqlite3_step(stmt) == SQLITE_ROW) {
+        const void *blob = sqlite3_column_blob(stmt, 1);
+        int blob_size = sqlite3_column_bytes(stmt, 1);
+        if (blob == NULL || (size_t)blob_size != EMBEDDING_DIMENSION * sizeof(float)) {
+            continue;
+        }
 
-    db->initialized = true;
-    return db;
+        // Copy through a local buffer: BLOB memory is not guaranteed float-aligned
+        float embedding[EMBEDDING_DIMENSION];
+        memcpy(embedding, blob, sizeof(embedding));
+        ok = vector_index_append(vectors, label_base + sqlite3_column_int64(stmt, 0), embedding);
+    }
+    sqlite3_finalize(stmt);
+    return ok;
 }
 
-void vectordb_close(VectorDB *db)
+// Helper: make db->vectors available (caller holds vectors_mutex). Uses the saved
+// index when it matches the database, otherwise reads every embedding; the graph
+// over those is linked later by vectordb_build_index
+static bool load_vectors(VectorDB *db)
 {
-    if (db == NULL) {
-        return;
+    if (db->vectors != NULL) {
+        return true;
     }
 
-    // Finalize prepared statements
-    if (db->stmt_insert) sqlite3_finalize(db->stmt_insert);
-    if (db->stmt_update_embedding) sqlite3_finalize(db->stmt_update_embedding);
-    if (db->stmt_delete) sqlite3_finalize(db->stmt_delete);
-    if (db->stmt_get_by_path) sqlite3_finalize(db->stmt_get_by_path);
-    if (db->stmt_check_indexed) sqlite3_finalize(db->stmt_check_indexed);
-    if (db->stmt_get_all_embeddings) sqlite3_finalize(db->stmt_get_all_embeddings);
+    uint64_t signature = embedding_signature(db);
+    db->vectors = vector_index_load(db->index_path, EMBEDDING_DIMENSION, signature);
+    if (db->vectors != NULL) {
+        vector_index_set_quantization(db->vectors, db->quantization);
+        db->vectors_dirty = false;
+        return true;
+    }
 
-    if (db->db) {
-        sqlite3_close(db->db);
+    // Whole files, then sections
+    VectorIndex *vectors = vector_index_create(EMBEDDING_DIMENSION);
+    bool ok = vectors != NULL &&
+              append_vectors(db, vectors, SQL_GET_ALL_VECTORS, 0) &&
+              append_vectors(db, vectors, SQL_GET_ALL_CHUNK_VECTORS, CHUNK_LABEL_BASE);
+
+    if (!ok) {
+        vector_index_destroy(vectors);
+        return false;
     }
 
-    free(db);
+    vector_index_set_quantization(vectors, db->quantization);
+    db->vectors = vectors;
+    db->vectors_dirty = true;
+    return true;
 }
 
-VectorDBStatus vectordb_init_schema(VectorDB *db)
+static void free_directory_entries(VectorDB *db)
 {
-    if (db == NULL || db->db == NULL) {
-        return VECTORDB_STATUS_NOT_INITIALIZED;
+    for (int i = 0; i < db->dir_count; i++) {
+        free(db->dir_entries[i].path);
     }
+    free(db->dir_entries);
+    db->dir_entries = NULL;
+    db->dir_count = 0;
+    db->dir_capacity = 0;
+    db->dir_loaded = false;
+}
 
-    char *err_msg = NULL;
+// Helper: drop the resident vectors and paths, to be reloaded on next use
+static void drop_vectors(VectorDB *db)
+{
+    vector_index_destroy(db->vectors);
+    db->vectors = NULL;
+    free_directory_entries(db);
+}
 
-    // Create version table first
-    int rc = sqlite3_exec(db->db, SQL_CREATE_VERSION_TABLE, NULL, NULL, &err_msg);
-    if (rc != SQLITE_OK) {
-        if (err_msg) sqlite3_free(err_msg);
-        return VECTORDB_STATUS_DB_ERROR;
+// Helper: remember the path of a new resident embedding (no-op until paths are loaded)
+static bool add_directory_entry(VectorDB *db, int64_t id, const char *path)
+{
+    if (!db->dir_loaded) {
+        return true;
     }
 
-    // Create main table
-    rc = sqlite3_exec(db->db, SQL_CREATE_TABLE, NULL, NULL, &err_msg);
-    if (rc != SQLITE_OK) {
-        if (err_msg) sqlite3_free(err_msg);
-        return VECTORDB_STATUS_DB_ERROR;
+    if (db->dir_count == db->dir_capacity) {
+        int capacity = db->dir_capacity > 0 ? db->dir_capacity * 2 : 1024;
+        DirectoryEntry *grown = realloc(db->dir_entries, (size_t)capacity * sizeof(DirectoryEntry));
+        if (grown == NULL) {
+            free_directory_entries(db);
+            return false;
+        }
+        db->dir_entries = grown;
+        db->dir_capacity = capacity;
     }
 
-    // Run migrations
-    return vectordb_migrate(db);
+    char *copy = strdup(path);
+    if (copy == NULL) {
+        free_directory_entries(db);
+        return false;
+    }
+
+    db->dir_entries[db->dir_count].path = copy;
+    db->dir_entries[db->dir_count].id = id;
+    db->dir_count++;
+    db->dir_sorted = false;
+    return true;
 }
 
-int vectordb_get_version(VectorDB *db)
+static int compare_directory_entries(const void *a, const void *b)
 {
-    if (db == NULL || db->db == NULL) {
-        return -1;
-    }
+    return strcasecmp(((const DirectoryEntry *)a)->path, ((const DirectoryEntry *)b)->path);
+}
 
-    sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db->db, SQL_GET_VERSION, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        return -1;
+// Helper: make the sorted path list available (caller holds vectors_mutex, vectors loaded)
+static bool load_directory_entries(VectorDB *db)
+{
+    if (!db->dir_loaded) {
+        // Sections are listed under their file's path
+        const char *queries[2] = { SQL_GET_EMBEDDED_PATHS, SQL_GET_CHUNK_PATHS };
+        const int64_t label_bases[2] = { 0, CHUNK_LABEL_BASE };
+
+        db->dir_loaded = true;
+        for (int q = 0; q < 2 && db->dir_loaded; q++) {
+            sqlite3_stmt *stmt;
+            if (sqlite3_prepare_v2(db->db, queries[q], -1, &stmt, NULL) != SQLITE_OK) {
+                free_directory_entries(db);
+                return false;
+            }
+            while (db->dir_loaded && sqlite3_step(stmt) == SQLITE_ROW) {
+                const char *path = (const char *)sqlite3_column_text(stmt, 1);
+                if (path != NULL) {
+                    add_directory_entry(db, label_bases[q] + sqlite3_column_int64(stmt, 0), path);
+                }
+            }
+            sqlite3_finalize(stmt);
+        }
+
+        if (!db->dir_loaded) {
+            return false;
+        }
     }
 
-    int version = 0;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        version = sqlite3_column_int(stmt, 0);
+    if (!db->dir_sorted) {
+        int kept = 0;
+        for (int i = 0; i < db->dir_count; i++) {
+            if (vector_index_get(db->vectors, db->dir_entries[i].id) == NULL) {
+                free(db->dir_entries[i].path);
+            } else {
+                db->dir_entries[kept++] = db->dir_entries[i];
+            }
+        }
+        db->dir_count = kept;
+        if (db->dir_count > 0) {
+            qsort(db->dir_entries, (size_t)db->dir_count, sizeof(DirectoryEntry), compare_directory_entries);
+        }
+        db->dir_sorted = true;
     }
+    return true;
+}
 
-    sqlite3_finalize(stmt);
-    return version;
+// Helper: record a new embedding for id, dropping the resident copy if that fails
+static void put_vector(VectorDB *db, int64_t id, const char *path, const float *embedding)
+{
+    bool known = vector_index_get(db->vectors, id) != NULL;
+    if (!vector_index_put(db->vectors, id, embedding)) {
+        // Out of memory: reload from the database on next use
+        drop_vectors(db);
+    } else if (!known) {
+        add_directory_entry(db, id, path);
+    }
 }
 
-static VectorDBStatus set_version(VectorDB *db, int version)
+// Helper: put the embedding just stored for content_hash in place of the vectors of the
+// other files with that content (caller holds vectors_mutex). Only a model change
+// replaces a shared embedding; for new content there are no others
+static void share_content_vector(VectorDB *db, const char *content_hash, int64_t id, const float *embedding)
 {
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db->db, SQL_SET_VERSION, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        return VECTORDB_STATUS_DB_ERROR;
+    if (sqlite3_prepare_v2(db->db, SQL_GET_CONTENT_FILES, -1, &stmt, NULL) != SQLITE_OK) {
+        return;
+    }
+    sqlite3_bind_text(stmt, 1, content_hash, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, id);
+    while (db->vectors != NULL && sqlite3_step(stmt) == SQLITE_ROW) {
+        put_vector(db, sqlite3_column_int64(stmt, 0), (const char *)sqlite3_column_text(stmt, 1), embedding);
     }
-
-    sqlite3_bind_int(stmt, 1, version);
-    rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
-
-    return (rc == SQLITE_DONE) ? VECTORDB_STATUS_OK : VECTORDB_STATUS_DB_ERROR;
 }
 
-VectorDBStatus vectordb_migrate(VectorDB *db)
+// Helper: database ID stored for path, or -1; copies its content hash ("" if none)
+// into content_hash when given
+static int64_t lookup_id(VectorDB *db, const char *path, char *content_hash)
 {
-    if (db == NULL || db->db == NULL) {
-        return VECTORDB_STATUS_NOT_INITIALIZED;
+    if (content_hash != NULL) {
+        content_hash[0] = '\0';
     }
 
-    int current_version = vectordb_get_version(db);
-    if (current_version < 0) {
-        return VECTORDB_STATUS_DB_ERROR;
+    sqlite3_reset(db->stmt_get_id);
+    sqlite3_bind_text(db->stmt_get_id, 1, path, -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(db->stmt_get_id) != SQLITE_ROW) {
+        return -1;
     }
 
-    // If this is a fresh database, set version to current
-    if (current_version == 0) {
-        return set_version(db, CURRENT_SCHEMA_VERSION);
+    const char *hash = (const char *)sqlite3_column_text(db->stmt_get_id, 1);
+    if (content_hash != NULL && hash != NULL) {
+        strncpy(content_hash, hash, VECTORDB_CONTENT_HASH_SIZE - 1);
+        content_hash[VECTORDB_CONTENT_HASH_SIZE - 1] = '\0';
     }
+    return sqlite3_column_int64(db->stmt_get_id, 0);
+}
 
-    char *err_msg = NULL;
+// Helper: drop the shared embedding for content_hash if no file has that content any more
+static void release_content(VectorDB *db, const char *content_hash)
+{
+    if (content_hash == NULL || content_hash[0] == '\0') {
+        return;
+    }
 
-    // Apply migrations
-    if (current_version < 2) {
-        // Try to apply migration 2 (add content_hash column)
-        // SQLite's ALTER TABLE will error if column exists; we ignore the error
-        sqlite3_exec(db->db, MIGRATION_2, NULL, NULL, &err_msg);
-        if (err_msg) {
-            sqlite3_free(err_msg);
-            err_msg = NULL;
+    sqlite3_reset(db->stmt_release_content);
+    sqlite3_bind_text(db->stmt_release_content, 1, content_hash, -1, SQLITE_TRANSIENT);
+    sqlite3_step(db->stmt_release_content);
+}
+
+// Helper: delete the sections of a file and their resident vectors
+static void drop_chunks(VectorDB *db, int64_t file_id)
+{
+    if (file_id < 0) {
+        return;
+    }
+
+    if (db->vectors != NULL) {
+        sqlite3_reset(db->stmt_get_file_chunks);
+        sqlite3_bind_int64(db->stmt_get_file_chunks, 1, file_id);
+        while (sqlite3_step(db->stmt_get_file_chunks) == SQLITE_ROW) {
+            vector_index_remove(db->vectors, CHUNK_LABEL_BASE + sqlite3_column_int64(db->stmt_get_file_chunks, 0));
         }
+        sqlite3_reset(db->stmt_get_file_chunks);
     }
 
-    // Update to current version
-    return set_version(db, CURRENT_SCHEMA_VERSION);
+    sqlite3_reset(db->stmt_delete_file_chunks);
+    sqlite3_bind_int64(db->stmt_delete_file_chunks, 1, file_id);
+    sqlite3_step(db->stmt_delete_file_chunks);
 }
 
-VectorDBStatus vectordb_index_file(VectorDB *db,
-                                    const char *path,
-                                    const char *name,
-                                    IndexedFileType file_type,
-                                    int64_t size,
-                                    int64_t modified_time,
-                                    const float *embedding)
+// Helper: drop a file's full-text row
+static void delete_text(VectorDB *db, int64_t file_id)
 {
-    if (db == NULL || !db->initialized) {
-        return VECTORDB_STATUS_NOT_INITIALIZED;
+    if (!db->has_fulltext || file_id < 0) {
+        return;
     }
 
-    if (path == NULL || name == NULL) {
-        return VECTORDB_STATUS_INVALID_EMBEDDING;
-    }
+    sqlite3_reset(db->stmt_delete_text);
+    sqlite3_bind_int64(db->stmt_delete_text, 1, file_id);
+    sqlite3_step(db->stmt_delete_text);
+}
 
-    sqlite3_reset(db->stmt_insert);
+// Helper: give a new file row its full-text row, holding the name until text is set
+static void insert_text(VectorDB *db, int64_t file_id, const char *name)
+{
+    if (!db->has_fulltext) {
+        return;
+    }
 
-    sqlite3_bind_text(db->stmt_insert, 1, path, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(db->stmt_insert, 2, name, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(db->stmt_insert, 3, (int)file_type);
-    sqlite3_bind_int64(db->stmt_insert, 4, size);
-    sqlite3_bind_int64(db->stmt_insert, 5, modified_time);
-    sqlite3_bind_int64(db->stmt_insert, 6, time(NULL));
+    sqlite3_reset(db->stmt_insert_text);
+    sqlite3_bind_int64(db->stmt_insert_text, 1, file_id);
+    sqlite3_bind_text(db->stmt_insert_text, 2, name, -1, SQLITE_TRANSIENT);
+    sqlite3_step(db->stmt_insert_text);
+}
 
-    if (embedding != NULL) {
-        sqlite3_bind_blob(db->stmt_insert, 7, embedding,
-                          EMBEDDING_DIMENSION * sizeof(float), SQLITE_TRANSIENT);
+// Helper: embedding_model() in SQL, the model set on the database (NULL if none)
+static void sql_embedding_model(sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+    (void)argc;
+    (void)argv;
+    const VectorDB *db = sqlite3_user_data(context);
+    if (db->model[0] != '\0') {
+        sqlite3_result_text(context, db->model, -1, SQLITE_TRANSIENT);
     } else {
-        sqlite3_bind_null(db->stmt_insert, 7);
+        sqlite3_result_null(context);
     }
+}
 
-    int rc = sqlite3_step(db->stmt_insert);
-    if (rc != SQLITE_DONE) {
-        return VECTORDB_STATUS_DB_ERROR;
-    }
+// Helper: make embedding_model() available on a connection
+static bool register_functions(VectorDB *db, sqlite3 *conn)
+{
+    return sqlite3_create_function(conn, "embedding_model", 0, SQLITE_UTF8, db,
+                                   sql_embedding_model, NULL, NULL) == SQLITE_OK;
+}
 
-    return VECTORDB_STATUS_OK;
+// Helper: prepare the read statements on a connection
+static bool reader_prepare(VectorDBReader *reader, sqlite3 *conn)
+{
+    reader->db = conn;
+    bool ok = sqlite3_prepare_v2(conn, SQL_GET_BY_PATH, -1, &reader->stmt_get_by_path, NULL) == SQLITE_OK &&
+              sqlite3_prepare_v2(conn, SQL_CHECK_INDEXED, -1, &reader->stmt_check_indexed, NULL) == SQLITE_OK &&
+              sqlite3_prepare_v2(conn, SQL_GET_BY_ID, -1, &reader->stmt_get_by_id, NULL) == SQLITE_OK &&
+              sqlite3_prepare_v2(conn, SQL_GET_CONTENT, -1, &reader->stmt_get_content, NULL) == SQLITE_OK &&
+              sqlite3_prepare_v2(conn, SQL_GET_CHUNK, -1, &reader->stmt_get_chunk, NULL) == SQLITE_OK;
+
+    // Optional, like the full-text index itself
+    if (sqlite3_prepare_v2(conn, SQL_SEARCH_TEXT, -1, &reader->stmt_search_text, NULL) != SQLITE_OK) {
+        reader->stmt_search_text = NULL;
+    }
+    return ok;
 }
 
-VectorDBStatus vectordb_update_embedding(VectorDB *db,
-                                          const char *path,
-                                          const float *embedding)
+// Helper: finalize a connection's read statements (and close it if close_db is set)
+static void reader_close(VectorDBReader *reader, bool close_db)
 {
-    if (db == NULL || !db->initialized) {
-        return VECTORDB_STATUS_NOT_INITIALIZED;
+    sqlite3_finalize(reader->stmt_get_by_path);
+    sqlite3_finalize(reader->stmt_check_indexed);
+    sqlite3_finalize(reader->stmt_get_by_id);
+    sqlite3_finalize(reader->stmt_get_content);
+    sqlite3_finalize(reader->stmt_get_chunk);
+    sqlite3_finalize(reader->stmt_search_text);
+    if (close_db && reader->db != NULL) {
+        sqlite3_close(reader->db);
     }
+    memset(reader, 0, sizeof(*reader));
+}
 
-    if (path == NULL || embedding == NULL) {
-        return VECTORDB_STATUS_INVALID_EMBEDDING;
+// Helper: open a read-only connection into a free pool slot
+static bool reader_open(VectorDB *db, VectorDBReader *reader)
+{
+    sqlite3 *conn = NULL;
+    if (sqlite3_open_v2(db->db_path, &conn, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK) {
+        sqlite3_close(conn);
+        return false;
     }
+    sqlite3_busy_timeout(conn, 1000);
+    sqlite3_exec(conn, "PRAGMA cache_size=-8192;", NULL, NULL, NULL);
+    sqlite3_exec(conn, "PRAGMA mmap_size=268435456;", NULL, NULL, NULL);
+    sqlite3_exec(conn, "PRAGMA temp_store=MEMORY;", NULL, NULL, NULL);
 
-    sqlite3_reset(db->stmt_update_embedding);
+    if (!register_functions(db, conn)) {
+        sqlite3_close(conn);
+        return false;
+    }
+    if (!reader_prepare(reader, conn)) {
+        reader_close(reader, true);
+        return false;
+    }
+    return true;
+}
 
-    sqlite3_bind_blob(db->stmt_update_embedding, 1, embedding,
-                      EMBEDDING_DIMENSION * sizeof(float), SQLITE_TRANSIENT);
-    sqlite3_bind_int64(db->stmt_update_embedding, 2, time(NULL));
-    sqlite3_bind_text(db->stmt_update_embedding, 3, path, -1, SQLITE_TRANSIENT);
+// Helper: the connection for a read (caller must not hold vectors_mutex): the writer's
+// own if this thread has a batch open, else a pool reader, opened on first use and
+// waited for when all are busy. Pool reads run in one transaction, one snapshot, until
+// release_reader. NULL if no reader could be opened
+static VectorDBReader *acquire_reader(VectorDB *db)
+{
+    pthread_mutex_lock(&db->vectors_mutex);
+    bool own_batch = db->in_batch && pthread_equal(db->batch_thread, pthread_self());
+    pthread_mutex_unlock(&db->vectors_mutex);
+    if (own_batch) {
+        return &db->writer_reads;
+    }
 
-    int rc = sqlite3_step(db->stmt_update_embedding);
-    if (rc != SQLITE_DONE) {
+    pthread_mutex_lock(&db->readers_mutex);
+    VectorDBReader *reader = NULL;
+    while (reader == NULL) {
+        VectorDBReader *unopened = NULL;
+        bool any_open = false;
+        for (int i = 0; i < VECTORDB_READERS && reader == NULL; i++) {
+            VectorDBReader *candidate = &db->readers[i];
+            if (candidate->db == NULL) {
+                unopened = unopened != NULL ? unopened : candidate;
+            } else if (!candidate->in_use) {
+                reader = candidate;
+            } else {
+                any_open = true;
+            }
+        }
+        if (reader == NULL && unopened != NULL && reader_open(db, unopened)) {
+            reader = unopened;
+        }
+        if (reader == NULL) {
+            if (!any_open) {
+                break;
+            }
+            pthread_cond_wait(&db->reader_free, &db->readers_mutex);
+        }
+    }
+    if (reader != NULL) {
+        reader->in_use = true;
+    }
+    pthread_mutex_unlock(&db->readers_mutex);
+
+    if (reader != NULL) {
+        sqlite3_exec(reader->db, "BEGIN;", NULL, NULL, NULL);
+    }
+    return reader;
+}
+
+static void release_reader(VectorDB *db, VectorDBReader *reader)
+{
+    if (reader == NULL || reader == &db->writer_reads) {
+        return;
+    }
+
+    sqlite3_exec(reader->db, "COMMIT;", NULL, NULL, NULL);
+    pthread_mutex_lock(&db->readers_mutex);
+    reader->in_use = false;
+    pthread_cond_signal(&db->reader_free);
+    pthread_mutex_unlock(&db->readers_mutex);
+}
+
+// Helper: whether path is root or below it (ASCII case-insensitive, as LIKE compares)
+static bool path_under(const char *path, const char *root, size_t root_length)
+{
+    return strncasecmp(path, root, root_length) == 0 &&
+           (path[root_length] == '/' || path[root_length] == '\0');
+}
+
+// Helper: the shard holding path, held until shard_release (NULL if db holds it)
+static VectorDBShard *shard_acquire(VectorDB *db, const char *path)
+{
+    if (db == NULL || !db->initialized || path == NULL) {
+        return NULL;
+    }
+
+    VectorDBShard *found = NULL;
+    pthread_mutex_lock(&db->shards_mutex);
+    for (int i = 0; i < db->shard_count && found == NULL; i++) {
+        if (path_under(path, db->shards[i]->root, db->shards[i]->root_length)) {
+            found = db->shards[i];
+            found->users++;
+        }
+    }
+    pthread_mutex_unlock(&db->shards_mutex);
+    return found;
+}
+
+static void shard_release(VectorDB *db, VectorDBShard *shard)
+{
+    pthread_mutex_lock(&db->shards_mutex);
+    if (--shard->users == 0) {
+        pthread_cond_broadcast(&db->shard_idle);
+    }
+    pthread_mutex_unlock(&db->shards_mutex);
+}
+
+// Helper: hold the databases that can have files under directory (NULL for all): the
+// shard holding the directory alone, else db and the shards whose root the directory
+// is a prefix of (as for LIKE 'dir%')
+static void scope_acquire(VectorDB *db, const char *directory, VectorDBScope *scope)
+{
+    scope->self = true;
+    scope->count = 0;
+
+    pthread_mutex_lock(&db->shards_mutex);
+    size_t length = directory != NULL ? strlen(directory) : 0;
+    for (int i = 0; i < db->shard_count; i++) {
+        VectorDBShard *shard = db->shards[i];
+        if (directory != NULL && path_under(directory, shard->root, shard->root_length)) {
+            scope->self = false;
+            scope->shards[0] = shard;
+            scope->count = 1;
+            break;
+        }
+        if (directory == NULL || strncasecmp(shard->root, directory, length) == 0) {
+            scope->shards[scope->count++] = shard;
+        }
+    }
+    for (int i = 0; i < scope->count; i++) {
+        scope->shards[i]->users++;
+    }
+    pthread_mutex_unlock(&db->shards_mutex);
+}
+
+static void scope_release(VectorDB *db, VectorDBScope *scope)
+{
+    for (int i = 0; i < scope->count; i++) {
+        shard_release(db, scope->shards[i]);
+    }
+    scope->count = 0;
+}
+
+// Helper: close a shard no call holds any more
+static void close_shard(VectorDBShard *shard)
+{
+    vectordb_close(shard->db);
+    free(shard->root);
+    free(shard);
+}
+
+VectorDB* vectordb_open(const char *db_path)
+{
+    if (db_path == NULL) {
+        return NULL;
+    }
+
+    VectorDB *db = calloc(1, sizeof(VectorDB));
+    if (db == NULL) {
+        return NULL;
+    }
+
+    strncpy(db->db_path, db_path, sizeof(db->db_path) - 1);
+    snprintf(db->index_path, sizeof(db->index_path), "%s.hnsw", db->db_path);
+    db->quantization = VECTOR_QUANT_INT8;
+    pthread_mutex_init(&db->vectors_mutex, NULL);
+    pthread_mutex_init(&db->readers_mutex, NULL);
+    pthread_cond_init(&db->reader_free, NULL);
+    pthread_mutex_init(&db->shards_mutex, NULL);
+    pthread_cond_init(&db->shard_idle, NULL);
+
+    int rc = sqlite3_open(db_path, &db->db);
+    if (rc != SQLITE_OK) {
+        sqlite3_close(db->db);
+        pthread_cond_destroy(&db->shard_idle);
+        pthread_mutex_destroy(&db->shards_mutex);
+        pthread_cond_destroy(&db->reader_free);
+        pthread_mutex_destroy(&db->readers_mutex);
+        pthread_mutex_destroy(&db->vectors_mutex);
+        free(db);
+        return NULL;
+    }
+
+    // WAL with NORMAL sync only fsyncs at checkpoints; a bigger page cache and memory
+    // mapping keep lookups during bulk indexing off the read() path
+    sqlite3_exec(db->db, "PRAGMA journal_mode=WAL;", NULL, NULL, NULL);
+    sqlite3_exec(db->db, "PRAGMA synchronous=NORMAL;", NULL, NULL, NULL);
+    sqlite3_exec(db->db, "PRAGMA cache_size=-32768;", NULL, NULL, NULL);
+    sqlite3_exec(db->db, "PRAGMA mmap_size=268435456;", NULL, NULL, NULL);
+    sqlite3_exec(db->db, "PRAGMA temp_store=MEMORY;", NULL, NULL, NULL);
+
+    // Freed pages are given back by vectordb_vacuum a step at a time (only takes effect
+    // on a new database; older ones are converted there)
+    sqlite3_exec(db->db, "PRAGMA auto_vacuum=INCREMENTAL;", NULL, NULL, NULL);
+
+    // Initialize schema (the statements below need embedding_model())
+    if (!register_functions(db, db->db) || vectordb_init_schema(db) != VECTORDB_STATUS_OK) {
+        vectordb_close(db);
+        return NULL;
+    }
+
+    // Prepare statements
+    sqlite3_prepare_v2(db->db, SQL_INSERT, -1, &db->stmt_insert, NULL);
+    sqlite3_prepare_v2(db->db, SQL_UPDATE_EMBEDDING, -1, &db->stmt_update_embedding, NULL);
+    sqlite3_prepare_v2(db->db, SQL_DELETE, -1, &db->stmt_delete, NULL);
+    sqlite3_prepare_v2(db->db, SQL_GET_ID, -1, &db->stmt_get_id, NULL);
+    sqlite3_prepare_v2(db->db, SQL_PUT_CONTENT, -1, &db->stmt_put_content, NULL);
+    sqlite3_prepare_v2(db->db, SQL_RELEASE_CONTENT, -1, &db->stmt_release_content, NULL);
+    sqlite3_prepare_v2(db->db, SQL_INSERT_CHUNK, -1, &db->stmt_insert_chunk, NULL);
+    sqlite3_prepare_v2(db->db, SQL_GET_FILE_CHUNKS, -1, &db->stmt_get_file_chunks, NULL);
+    sqlite3_prepare_v2(db->db, SQL_DELETE_FILE_CHUNKS, -1, &db->stmt_delete_file_chunks, NULL);
+    reader_prepare(&db->writer_reads, db->db);
+
+    // All or nothing: the full-text index is optional
+    if (sqlite3_prepare_v2(db->db, SQL_INSERT_TEXT, -1, &db->stmt_insert_text, NULL) == SQLITE_OK &&
+        sqlite3_prepare_v2(db->db, SQL_SET_TEXT, -1, &db->stmt_set_text, NULL) == SQLITE_OK &&
+        sqlite3_prepare_v2(db->db, SQL_DELETE_TEXT, -1, &db->stmt_delete_text, NULL) == SQLITE_OK &&
+        db->writer_reads.stmt_search_text != NULL) {
+        db->has_fulltext = true;
+    }
+
+    db->initialized = true;
+    return db;
+}
+
+void vectordb_close(VectorDB *db)
+{
+    if (db == NULL) {
+        return;
+    }
+
+    // No call can still be using a shard once db itself is being closed
+    while (db->shard_count > 0) {
+        close_shard(db->shards[--db->shard_count]);
+    }
+
+    if (db->initialized) {
+        vectordb_commit_batch(db);
+        vectordb_save_index(db);
+    }
+
+    // Finalize prepared statements
+    if (db->stmt_insert) sqlite3_finalize(db->stmt_insert);
+    if (db->stmt_update_embedding) sqlite3_finalize(db->stmt_update_embedding);
+    if (db->stmt_delete) sqlite3_finalize(db->stmt_delete);
+    if (db->stmt_get_id) sqlite3_finalize(db->stmt_get_id);
+    if (db->stmt_put_content) sqlite3_finalize(db->stmt_put_content);
+    if (db->stmt_release_content) sqlite3_finalize(db->stmt_release_content);
+    if (db->stmt_insert_chunk) sqlite3_finalize(db->stmt_insert_chunk);
+    if (db->stmt_get_file_chunks) sqlite3_finalize(db->stmt_get_file_chunks);
+    if (db->stmt_delete_file_chunks) sqlite3_finalize(db->stmt_delete_file_chunks);
+    if (db->stmt_insert_text) sqlite3_finalize(db->stmt_insert_text);
+    if (db->stmt_set_text) sqlite3_finalize(db->stmt_set_text);
+    if (db->stmt_delete_text) sqlite3_finalize(db->stmt_delete_text);
+    reader_close(&db->writer_reads, false);
+    for (int i = 0; i < VECTORDB_READERS; i++) {
+        reader_close(&db->readers[i], true);
+    }
+
+    if (db->db) {
+        sqlite3_close(db->db);
+    }
+
+    drop_vectors(db);
+    pthread_cond_destroy(&db->shard_idle);
+    pthread_mutex_destroy(&db->shards_mutex);
+    pthread_cond_destroy(&db->reader_free);
+    pthread_mutex_destroy(&db->readers_mutex);
+    pthread_mutex_destroy(&db->vectors_mutex);
+    free(db);
+}
+
+VectorDBStatus vectordb_init_schema(VectorDB *db)
+{
+    if (db == NULL || db->db == NULL) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+
+    char *err_msg = NULL;
+
+    // Create version table first
+    int rc = sqlite3_exec(db->db, SQL_CREATE_VERSION_TABLE, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        if (err_msg) sqlite3_free(err_msg);
         return VECTORDB_STATUS_DB_ERROR;
     }
 
-    if (sqlite3_changes(db->db) == 0) {
-        return VECTORDB_STATUS_NOT_FOUND;
+    // Create main table
+    rc = sqlite3_exec(db->db, SQL_CREATE_TABLE, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        if (err_msg) sqlite3_free(err_msg);
+        return VECTORDB_STATUS_DB_ERROR;
+    }
+
+    // Run migrations
+    return vectordb_migrate(db);
+}
+
+int vectordb_get_version(VectorDB *db)
+{
+    if (db == NULL || db->db == NULL) {
+        return -1;
+    }
+
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db->db, SQL_GET_VERSION, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        return -1;
+    }
+
+    int version = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+
+    sqlite3_finalize(stmt);
+    return version;
+}
+
+static VectorDBStatus set_version(VectorDB *db, int version)
+{
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db->db, SQL_SET_VERSION, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        return VECTORDB_STATUS_DB_ERROR;
+    }
+
+    sqlite3_bind_int(stmt, 1, version);
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    return (rc == SQLITE_DONE) ? VECTORDB_STATUS_OK : VECTORDB_STATUS_DB_ERROR;
+}
+
+VectorDBStatus vectordb_migrate(VectorDB *db)
+{
+    if (db == NULL || db->db == NULL) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+
+    int current_version = vectordb_get_version(db);
+    if (current_version < 0) {
+        return VECTORDB_STATUS_DB_ERROR;
+    }
+
+    char *err_msg = NULL;
+
+    // If this is a fresh database, set version to current
+    if (current_version == 0) {
+        if (sqlite3_exec(db->db, MIGRATION_3, NULL, NULL, NULL) != SQLITE_OK ||
+            sqlite3_exec(db->db, MIGRATION_4, NULL, NULL, NULL) != SQLITE_OK ||
+            sqlite3_exec(db->db, MIGRATION_5, NULL, NULL, NULL) != SQLITE_OK ||
+            sqlite3_exec(db->db, MIGRATION_7, NULL, NULL, NULL) != SQLITE_OK) {
+            return VECTORDB_STATUS_DB_ERROR;
+        }
+        sqlite3_exec(db->db, MIGRATION_6, NULL, NULL, NULL);
+        return set_version(db, CURRENT_SCHEMA_VERSION);
+    }
+
+    // Apply migrations
+    if (current_version < 3) {
+        // Try to apply migration 2 (add content_hash column)
+        // SQLite's ALTER TABLE will error if column exists; we ignore the error
+        sqlite3_exec(db->db, MIGRATION_2, NULL, NULL, &err_msg);
+        if (err_msg) {
+            sqlite3_free(err_msg);
+            err_msg = NULL;
+        }
+
+        if (sqlite3_exec(db->db, MIGRATION_3, NULL, NULL, NULL) != SQLITE_OK) {
+            return VECTORDB_STATUS_DB_ERROR;
+        }
+    }
+    if (current_version < 4) {
+        if (sqlite3_exec(db->db, MIGRATION_4, NULL, NULL, NULL) != SQLITE_OK) {
+            return VECTORDB_STATUS_DB_ERROR;
+        }
+    }
+    if (current_version < 5) {
+        if (sqlite3_exec(db->db, MIGRATION_5, NULL, NULL, NULL) != SQLITE_OK) {
+            return VECTORDB_STATUS_DB_ERROR;
+        }
+    }
+    if (current_version < 6) {
+        // Without FTS5 the table is simply absent
+        sqlite3_exec(db->db, MIGRATION_6, NULL, NULL, NULL);
+    }
+    if (current_version < 7) {
+        if (sqlite3_exec(db->db, MIGRATION_7, NULL, NULL, NULL) != SQLITE_OK) {
+            return VECTORDB_STATUS_DB_ERROR;
+        }
+    }
+
+    // Update to current version
+    return set_version(db, CURRENT_SCHEMA_VERSION);
+}
+
+VectorDBStatus vectordb_index_file(VectorDB *db,
+                                    const char *path,
+                                    const char *name,
+                                    IndexedFileType file_type,
+                                    int64_t size,
+                                    int64_t modified_time,
+                                    const float *embedding)
+{
+    return vectordb_index_file_with_hash(db, path, name, file_type, size, modified_time, NULL, embedding);
+}
+
+VectorDBStatus vectordb_index_file_with_hash(VectorDB *db,
+                                              const char *path,
+                                              const char *name,
+                                              IndexedFileType file_type,
+                                              int64_t size,
+                                              int64_t modified_time,
+                                              const char *content_hash,
+                                              const float *embedding)
+{
+    VectorDBShard *shard = shard_acquire(db, path);
+    if (shard != NULL) {
+        VectorDBStatus status = vectordb_index_file_with_hash(shard->db, path, name, file_type, size,
+                                                              modified_time, content_hash, embedding);
+        shard_release(db, shard);
+        return status;
+    }
+
+    if (db == NULL || !db->initialized) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+
+    if (path == NULL || name == NULL) {
+        return VECTORDB_STATUS_INVALID_EMBEDDING;
+    }
+
+    pthread_mutex_lock(&db->vectors_mutex);
+
+    // Loading before the write keeps a saved index in step with the database
+    load_vectors(db);
+
+    // INSERT OR REPLACE gives the path a new ID, so the old row has to go
+    char old_hash[VECTORDB_CONTENT_HASH_SIZE];
+    int64_t old_id = lookup_id(db, path, old_hash);
+    if (content_hash != NULL && content_hash[0] == '\0') {
+        content_hash = NULL;
+    }
+
+    sqlite3_reset(db->stmt_insert);
+
+    sqlite3_bind_text(db->stmt_insert, 1, path, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(db->stmt_insert, 2, name, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(db->stmt_insert, 3, (int)file_type);
+    sqlite3_bind_int64(db->stmt_insert, 4, size);
+    sqlite3_bind_int64(db->stmt_insert, 5, modified_time);
+    sqlite3_bind_int64(db->stmt_insert, 6, time(NULL));
+
+    // Store unit vectors so similarity is a plain dot product
+    float normalized[EMBEDDING_DIMENSION];
+    if (embedding != NULL) {
+        memcpy(normalized, embedding, sizeof(normalized));
+        vector_normalize(normalized, EMBEDDING_DIMENSION);
+    }
+    bool content_stored = false;
+
+    if (content_hash != NULL) {
+        // Identical content keeps the embedding stored first, unless another model made it
+        if (embedding != NULL) {
+            sqlite3_reset(db->stmt_put_content);
+            sqlite3_bind_text(db->stmt_put_content, 1, content_hash, -1, SQLITE_TRANSIENT);
+            sqlite3_bind_blob(db->stmt_put_content, 2, normalized,
+                              EMBEDDING_DIMENSION * sizeof(float), SQLITE_TRANSIENT);
+            if (sqlite3_step(db->stmt_put_content) != SQLITE_DONE) {
+                pthread_mutex_unlock(&db->vectors_mutex);
+                return VECTORDB_STATUS_DB_ERROR;
+            }
+            content_stored = sqlite3_changes(db->db) > 0;
+        }
+        sqlite3_bind_null(db->stmt_insert, 7);
+        sqlite3_bind_text(db->stmt_insert, 8, content_hash, -1, SQLITE_TRANSIENT);
+    } else {
+        if (embedding != NULL) {
+            sqlite3_bind_blob(db->stmt_insert, 7, normalized,
+                              EMBEDDING_DIMENSION * sizeof(float), SQLITE_TRANSIENT);
+        } else {
+            sqlite3_bind_null(db->stmt_insert, 7);
+        }
+        sqlite3_bind_null(db->stmt_insert, 8);
+    }
+
+    int rc = sqlite3_step(db->stmt_insert);
+    if (rc != SQLITE_DONE) {
+        pthread_mutex_unlock(&db->vectors_mutex);
+        return VECTORDB_STATUS_DB_ERROR;
+    }
+    int64_t id = sqlite3_last_insert_rowid(db->db);
+
+    if (content_hash == NULL || strcmp(old_hash, content_hash) != 0) {
+        release_content(db, old_hash);
+    }
+    drop_chunks(db, old_id);
+    delete_text(db, old_id);
+    insert_text(db, id, name);
+
+    if (db->vectors != NULL) {
+        vector_index_remove(db->vectors, old_id);
+        if (embedding != NULL) {
+            put_vector(db, id, path, normalized);
+        }
+        if (content_stored) {
+            share_content_vector(db, content_hash, id, normalized);
+        }
+        db->vectors_dirty = true;
+    }
+
+    pthread_mutex_unlock(&db->vectors_mutex);
+    return VECTORDB_STATUS_OK;
+}
+
+VectorDBStatus vectordb_set_chunks(VectorDB *db, const char *path, const VectorDBChunk *chunks, int count)
+{
+    VectorDBShard *shard = shard_acquire(db, path);
+    if (shard != NULL) {
+        VectorDBStatus status = vectordb_set_chunks(shard->db, path, chunks, count);
+        shard_release(db, shard);
+        return status;
+    }
+
+    if (db == NULL || !db->initialized) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+
+    if (path == NULL || (chunks == NULL && count > 0)) {
+        return VECTORDB_STATUS_NOT_FOUND;
+    }
+
+    pthread_mutex_lock(&db->vectors_mutex);
+    load_vectors(db);
+
+    int64_t file_id = lookup_id(db, path, NULL);
+    if (file_id < 0) {
+        pthread_mutex_unlock(&db->vectors_mutex);
+        return VECTORDB_STATUS_NOT_FOUND;
+    }
+    drop_chunks(db, file_id);
+
+    VectorDBStatus status = VECTORDB_STATUS_OK;
+    for (int i = 0; i < count; i++) {
+        if (chunks[i].embedding == NULL) {
+            continue;
+        }
+
+        float normalized[EMBEDDING_DIMENSION];
+        memcpy(normalized, chunks[i].embedding, sizeof(normalized));
+        vector_normalize(normalized, EMBEDDING_DIMENSION);
+
+        sqlite3_reset(db->stmt_insert_chunk);
+        sqlite3_bind_int64(db->stmt_insert_chunk, 1, file_id);
+        sqlite3_bind_int64(db->stmt_insert_chunk, 2, chunks[i].offset);
+        sqlite3_bind_int64(db->stmt_insert_chunk, 3, chunks[i].length);
+        if (chunks[i].title != NULL && chunks[i].title[0] != '\0') {
+            sqlite3_bind_text(db->stmt_insert_chunk, 4, chunks[i].title, -1, SQLITE_TRANSIENT);
+        } else {
+            sqlite3_bind_null(db->stmt_insert_chunk, 4);
+        }
+        sqlite3_bind_blob(db->stmt_insert_chunk, 5, normalized,
+                          EMBEDDING_DIMENSION * sizeof(float), SQLITE_TRANSIENT);
+        if (sqlite3_step(db->stmt_insert_chunk) != SQLITE_DONE) {
+            status = VECTORDB_STATUS_DB_ERROR;
+            break;
+        }
+
+        if (db->vectors != NULL) {
+            put_vector(db, CHUNK_LABEL_BASE + sqlite3_last_insert_rowid(db->db), path, normalized);
+        }
+    }
+    if (db->vectors != NULL) {
+        db->vectors_dirty = true;
+    }
+
+    pthread_mutex_unlock(&db->vectors_mutex);
+    return status;
+}
+
+VectorDBStatus vectordb_set_text(VectorDB *db, const char *path, const char *text)
+{
+    VectorDBShard *shard = shard_acquire(db, path);
+    if (shard != NULL) {
+        VectorDBStatus status = vectordb_set_text(shard->db, path, text);
+        shard_release(db, shard);
+        return status;
+    }
+
+    if (db == NULL || !db->initialized) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+
+    if (path == NULL) {
+        return VECTORDB_STATUS_NOT_FOUND;
+    }
+
+    pthread_mutex_lock(&db->vectors_mutex);
+
+    int64_t file_id = lookup_id(db, path, NULL);
+    if (file_id < 0) {
+        pthread_mutex_unlock(&db->vectors_mutex);
+        return VECTORDB_STATUS_NOT_FOUND;
+    }
+
+    VectorDBStatus status = VECTORDB_STATUS_OK;
+    if (db->has_fulltext) {
+        sqlite3_reset(db->stmt_set_text);
+        if (text != NULL) {
+            sqlite3_bind_text(db->stmt_set_text, 1, text, -1, SQLITE_TRANSIENT);
+        } else {
+            sqlite3_bind_null(db->stmt_set_text, 1);
+        }
+        sqlite3_bind_int64(db->stmt_set_text, 2, file_id);
+        if (sqlite3_step(db->stmt_set_text) != SQLITE_DONE) {
+            status = VECTORDB_STATUS_DB_ERROR;
+        }
+    }
+
+    pthread_mutex_unlock(&db->vectors_mutex);
+    return status;
+}
+
+bool vectordb_has_fulltext(const VectorDB *db)
+{
+    return db != NULL && db->has_fulltext;
+}
+
+// Helper: open a batch on one database
+static VectorDBStatus begin_batch_in(VectorDB *db)
+{
+    if (db == NULL || !db->initialized) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+
+    pthread_mutex_lock(&db->vectors_mutex);
+
+    VectorDBStatus status = VECTORDB_STATUS_OK;
+    if (!db->in_batch) {
+        if (sqlite3_exec(db->db, "BEGIN IMMEDIATE;", NULL, NULL, NULL) == SQLITE_OK) {
+            db->in_batch = true;
+            db->batch_thread = pthread_self();
+        } else {
+            status = VECTORDB_STATUS_DB_ERROR;
+        }
+    }
+
+    pthread_mutex_unlock(&db->vectors_mutex);
+    return status;
+}
+
+// Helper: commit the open batch of one database
+static VectorDBStatus commit_batch_in(VectorDB *db)
+{
+    if (db == NULL || !db->initialized) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+
+    pthread_mutex_lock(&db->vectors_mutex);
+
+    VectorDBStatus status = VECTORDB_STATUS_OK;
+    if (db->in_batch) {
+        if (sqlite3_exec(db->db, "COMMIT;", NULL, NULL, NULL) != SQLITE_OK) {
+            // The resident vectors already hold the batch; reload them from what was kept
+            sqlite3_exec(db->db, "ROLLBACK;", NULL, NULL, NULL);
+            drop_vectors(db);
+            status = VECTORDB_STATUS_DB_ERROR;
+        }
+        db->in_batch = false;
+    }
+
+    pthread_mutex_unlock(&db->vectors_mutex);
+    return status;
+}
+
+VectorDBStatus vectordb_begin_batch(VectorDB *db)
+{
+    if (db == NULL || !db->initialized) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+
+    VectorDBScope scope;
+    scope_acquire(db, NULL, &scope);
+    VectorDBStatus status = begin_batch_in(db);
+    for (int i = 0; i < scope.count; i++) {
+        begin_batch_in(scope.shards[i]->db);
+    }
+    scope_release(db, &scope);
+    return status;
+}
+
+VectorDBStatus vectordb_commit_batch(VectorDB *db)
+{
+    if (db == NULL || !db->initialized) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+
+    VectorDBScope scope;
+    scope_acquire(db, NULL, &scope);
+    VectorDBStatus status = commit_batch_in(db);
+    for (int i = 0; i < scope.count; i++) {
+        VectorDBStatus shard_status = commit_batch_in(scope.shards[i]->db);
+        if (status == VECTORDB_STATUS_OK) {
+            status = shard_status;
+        }
+    }
+    scope_release(db, &scope);
+    return status;
+}
+
+VectorDBStatus vectordb_update_embedding(VectorDB *db,
+                                          const char *path,
+                                          const float *embedding)
+{
+    VectorDBShard *shard = shard_acquire(db, path);
+    if (shard != NULL) {
+        VectorDBStatus status = vectordb_update_embedding(shard->db, path, embedding);
+        shard_release(db, shard);
+        return status;
+    }
+
+    if (db == NULL || !db->initialized) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+
+    if (path == NULL || embedding == NULL) {
+        return VECTORDB_STATUS_INVALID_EMBEDDING;
+    }
+
+    float normalized[EMBEDDING_DIMENSION];
+    memcpy(normalized, embedding, sizeof(normalized));
+    vector_normalize(normalized, EMBEDDING_DIMENSION);
+
+    pthread_mutex_lock(&db->vectors_mutex);
+    load_vectors(db);
+
+    sqlite3_reset(db->stmt_update_embedding);
+
+    sqlite3_bind_blob(db->stmt_update_embedding, 1, normalized,
+                      EMBEDDING_DIMENSION * sizeof(float), SQLITE_TRANSIENT);
+    sqlite3_bind_int64(db->stmt_update_embedding, 2, time(NULL));
+    sqlite3_bind_text(db->stmt_update_embedding, 3, path, -1, SQLITE_TRANSIENT);
+
+    int rc = sqlite3_step(db->stmt_update_embedding);
+    if (rc != SQLITE_DONE) {
+        pthread_mutex_unlock(&db->vectors_mutex);
+        return VECTORDB_STATUS_DB_ERROR;
+    }
+
+    if (sqlite3_changes(db->db) == 0) {
+        pthread_mutex_unlock(&db->vectors_mutex);
+        return VECTORDB_STATUS_NOT_FOUND;
+    }
+
+    if (db->vectors != NULL) {
+        int64_t id = lookup_id(db, path, NULL);
+        if (id >= 0) {
+            put_vector(db, id, path, normalized);
+        }
+        db->vectors_dirty = true;
+    }
+
+    pthread_mutex_unlock(&db->vectors_mutex);
+    return VECTORDB_STATUS_OK;
+}
+
+VectorDBStatus vectordb_delete_file(VectorDB *db, const char *path)
+{
+    VectorDBShard *shard = shard_acquire(db, path);
+    if (shard != NULL) {
+        VectorDBStatus status = vectordb_delete_file(shard->db, path);
+        shard_release(db, shard);
+        return status;
+    }
+
+    if (db == NULL || !db->initialized) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+
+    if (path == NULL) {
+        return VECTORDB_STATUS_NOT_FOUND;
+    }
+
+    pthread_mutex_lock(&db->vectors_mutex);
+    load_vectors(db);
+
+    char old_hash[VECTORDB_CONTENT_HASH_SIZE];
+    int64_t id = lookup_id(db, path, old_hash);
+
+    sqlite3_reset(db->stmt_delete);
+    sqlite3_bind_text(db->stmt_delete, 1, path, -1, SQLITE_TRANSIENT);
+
+    int rc = sqlite3_step(db->stmt_delete);
+    if (rc != SQLITE_DONE) {
+        pthread_mutex_unlock(&db->vectors_mutex);
+        return VECTORDB_STATUS_DB_ERROR;
+    }
+    release_content(db, old_hash);
+    drop_chunks(db, id);
+    delete_text(db, id);
+
+    if (db->vectors != NULL && id >= 0) {
+        vector_index_remove(db->vectors, id);
+        db->vectors_dirty = true;
+    }
+
+    pthread_mutex_unlock(&db->vectors_mutex);
+    return VECTORDB_STATUS_OK;
+}
+
+// Helper: delete the files under dir_path from one database
+static VectorDBStatus delete_directory_in(VectorDB *db, const char *dir_path)
+{
+    if (db == NULL || !db->initialized) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+
+    if (dir_path == NULL) {
+        return VECTORDB_STATUS_NOT_FOUND;
+    }
+
+    pthread_mutex_lock(&db->vectors_mutex);
+    load_vectors(db);
+
+    sqlite3_stmt *stmt;
+    if (db->vectors != NULL) {
+        sqlite3_prepare_v2(db->db, SQL_GET_DIR_IDS, -1, &stmt, NULL);
+        sqlite3_bind_text(stmt, 1, dir_path, -1, SQLITE_TRANSIENT);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            vector_index_remove(db->vectors, sqlite3_column_int64(stmt, 0));
+        }
+        sqlite3_finalize(stmt);
+
+        sqlite3_prepare_v2(db->db, SQL_GET_DIR_CHUNK_IDS, -1, &stmt, NULL);
+        sqlite3_bind_text(stmt, 1, dir_path, -1, SQLITE_TRANSIENT);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            vector_index_remove(db->vectors, CHUNK_LABEL_BASE + sqlite3_column_int64(stmt, 0));
+        }
+        sqlite3_finalize(stmt);
+        db->vectors_dirty = true;
+    }
+
+    // Sections and text first, while their files still match the prefix
+    sqlite3_prepare_v2(db->db, SQL_DELETE_DIR_CHUNKS, -1, &stmt, NULL);
+    sqlite3_bind_text(stmt, 1, dir_path, -1, SQLITE_TRANSIENT);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    if (db->has_fulltext) {
+        sqlite3_prepare_v2(db->db, SQL_DELETE_DIR_TEXT, -1, &stmt, NULL);
+        sqlite3_bind_text(stmt, 1, dir_path, -1, SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+
+    sqlite3_prepare_v2(db->db, SQL_DELETE_DIR, -1, &stmt, NULL);
+    sqlite3_bind_text(stmt, 1, dir_path, -1, SQLITE_TRANSIENT);
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_DONE) {
+        // Rows may or may not be gone; reload on next use
+        drop_vectors(db);
+        pthread_mutex_unlock(&db->vectors_mutex);
+        return VECTORDB_STATUS_DB_ERROR;
+    }
+    sqlite3_exec(db->db, SQL_PRUNE_CONTENT, NULL, NULL, NULL);
+
+    pthread_mutex_unlock(&db->vectors_mutex);
+    return VECTORDB_STATUS_OK;
+}
+
+VectorDBStatus vectordb_delete_directory(VectorDB *db, const char *dir_path)
+{
+    if (db == NULL || !db->initialized) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+
+    if (dir_path == NULL) {
+        return VECTORDB_STATUS_NOT_FOUND;
+    }
+
+    VectorDBScope scope;
+    scope_acquire(db, dir_path, &scope);
+    VectorDBStatus status = scope.self ? delete_directory_in(db, dir_path) : VECTORDB_STATUS_OK;
+    for (int i = 0; i < scope.count; i++) {
+        VectorDBStatus shard_status = delete_directory_in(scope.shards[i]->db, dir_path);
+        if (status == VECTORDB_STATUS_OK) {
+            status = shard_status;
+        }
+    }
+    scope_release(db, &scope);
+    return status;
+}
+
+// Helper: stored embedding for content_hash in one database
+static bool get_content_embedding_in(VectorDB *db, const char *content_hash, float *embedding)
+{
+    if (db == NULL || !db->initialized || content_hash == NULL || embedding == NULL) {
+        return false;
+    }
+
+    VectorDBReader *reader = acquire_reader(db);
+    if (reader == NULL) {
+        return false;
+    }
+    sqlite3_reset(reader->stmt_get_content);
+    sqlite3_bind_text(reader->stmt_get_content, 1, content_hash, -1, SQLITE_TRANSIENT);
+
+    bool found = sqlite3_step(reader->stmt_get_content) == SQLITE_ROW &&
+                 deserialize_embedding(sqlite3_column_blob(reader->stmt_get_content, 0),
+                                       sqlite3_column_bytes(reader->stmt_get_content, 0), embedding);
+    sqlite3_reset(reader->stmt_get_content);
+    release_reader(db, reader);
+    return found;
+}
+
+bool vectordb_get_content_embedding(VectorDB *db, const char *content_hash, float *embedding)
+{
+    if (db == NULL || !db->initialized || content_hash == NULL || embedding == NULL) {
+        return false;
+    }
+
+    // The same content may have been embedded on another volume
+    VectorDBScope scope;
+    scope_acquire(db, NULL, &scope);
+    bool found = get_content_embedding_in(db, content_hash, embedding);
+    for (int i = 0; i < scope.count && !found; i++) {
+        found = get_content_embedding_in(scope.shards[i]->db, content_hash, embedding);
+    }
+    scope_release(db, &scope);
+    return found;
+}
+
+bool vectordb_is_indexed(VectorDB *db, const char *path, int64_t modified_time)
+{
+    VectorDBShard *shard = shard_acquire(db, path);
+    if (shard != NULL) {
+        bool indexed = vectordb_is_indexed(shard->db, path, modified_time);
+        shard_release(db, shard);
+        return indexed;
+    }
+
+    if (db == NULL || !db->initialized || path == NULL) {
+        return false;
+    }
+
+    VectorDBReader *reader = acquire_reader(db);
+    if (reader == NULL) {
+        return false;
+    }
+    sqlite3_reset(reader->stmt_check_indexed);
+    sqlite3_bind_text(reader->stmt_check_indexed, 1, path, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(reader->stmt_check_indexed, 2, modified_time);
+
+    int rc = sqlite3_step(reader->stmt_check_indexed);
+    sqlite3_reset(reader->stmt_check_indexed);
+    release_reader(db, reader);
+    return rc == SQLITE_ROW;
+}
+
+VectorDBStatus vectordb_get_file(VectorDB *db, const char *path, IndexedFile *file)
+{
+    VectorDBShard *shard = shard_acquire(db, path);
+    if (shard != NULL) {
+        VectorDBStatus status = vectordb_get_file(shard->db, path, file);
+        shard_release(db, shard);
+        return status;
+    }
+
+    if (db == NULL || !db->initialized) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+
+    if (path == NULL || file == NULL) {
+        return VECTORDB_STATUS_NOT_FOUND;
+    }
+
+    memset(file, 0, sizeof(IndexedFile));
+
+    VectorDBReader *reader = acquire_reader(db);
+    if (reader == NULL) {
+        return VECTORDB_STATUS_DB_ERROR;
+    }
+    sqlite3_reset(reader->stmt_get_by_path);
+    sqlite3_bind_text(reader->stmt_get_by_path, 1, path, -1, SQLITE_TRANSIENT);
+
+    VectorDBStatus status = VECTORDB_STATUS_NOT_FOUND;
+    if (sqlite3_step(reader->stmt_get_by_path) == SQLITE_ROW) {
+        fill_indexed_file(reader->stmt_get_by_path, file);
+        status = VECTORDB_STATUS_OK;
+    }
+    sqlite3_reset(reader->stmt_get_by_path);
+    release_reader(db, reader);
+    return status;
+}
+
+// Helper: allocate an empty result set, validating the common arguments
+static VectorSearchResults begin_search(VectorDB *db, const float *query_embedding, int *limit)
+{
+    VectorSearchResults results = {0};
+
+    if (db == NULL || !db->initialized) {
+        results.status = VECTORDB_STATUS_NOT_INITIALIZED;
+        return results;
+    }
+
+    if (query_embedding == NULL || *limit <= 0) {
+        results.status = VECTORDB_STATUS_INVALID_EMBEDDING;
+        return results;
+    }
+
+    if (*limit > VECTORDB_MAX_RESULTS) {
+        *limit = VECTORDB_MAX_RESULTS;
+    }
+
+    results.capacity = *limit;
+    results.results = calloc((size_t)*limit, sizeof(VectorSearchResult));
+    results.status = results.results != NULL ? VECTORDB_STATUS_OK : VECTORDB_STATUS_MEMORY_ERROR;
+    return results;
+}
+
+// Helper: read the winning rows back from SQLite (hits are best first). A file and
+// several of its sections can all be among the hits; the file is listed once, at the best
+static void fill_results(VectorDBReader *reader, const VectorIndexHit *hits, int hit_count,
+                         VectorSearchResults *results)
+{
+    if (reader == NULL) {
+        results->status = VECTORDB_STATUS_DB_ERROR;
+        return;
+    }
+
+    int filled = 0;
+    for (int i = 0; i < hit_count && filled < results->capacity; i++) {
+        VectorSearchResult *result = &results->results[filled];
+        memset(result, 0, sizeof(*result));
+
+        int64_t file_id = hits[i].label;
+        if (file_id >= CHUNK_LABEL_BASE) {
+            sqlite3_reset(reader->stmt_get_chunk);
+            sqlite3_bind_int64(reader->stmt_get_chunk, 1, file_id - CHUNK_LABEL_BASE);
+            if (sqlite3_step(reader->stmt_get_chunk) != SQLITE_ROW) {
+                continue;   // Deleted since the scan
+            }
+            file_id = sqlite3_column_int64(reader->stmt_get_chunk, 0);
+            result->has_section = true;
+            result->section_offset = sqlite3_column_int64(reader->stmt_get_chunk, 1);
+            result->section_length = sqlite3_column_int64(reader->stmt_get_chunk, 2);
+            const char *title = (const char *)sqlite3_column_text(reader->stmt_get_chunk, 3);
+            if (title != NULL) {
+                strncpy(result->section_title, title, sizeof(result->section_title) - 1);
+            }
+        }
+
+        bool listed = false;
+        for (int j = 0; j < filled && !listed; j++) {
+            listed = results->results[j].file.id == file_id;
+        }
+        if (listed) {
+            continue;
+        }
+
+        sqlite3_reset(reader->stmt_get_by_id);
+        sqlite3_bind_int64(reader->stmt_get_by_id, 1, file_id);
+        if (sqlite3_step(reader->stmt_get_by_id) != SQLITE_ROW) {
+            continue;   // Deleted since the scan
+        }
+
+        fill_indexed_file(reader->stmt_get_by_id, &result->file);
+        result->similarity = hits[i].score;
+        filled++;
+    }
+    sqlite3_reset(reader->stmt_get_chunk);
+    sqlite3_reset(reader->stmt_get_by_id);
+    results->count = filled;
+}
+
+VectorSearchResults vectordb_search(VectorDB *db,
+                                     const float *query_embedding,
+                                     int limit)
+{
+    TRACE_SCOPE("vectordb_search");
+    return vectordb_search_ann(db, query_embedding, limit, VECTOR_INDEX_DEFAULT_EF);
+}
+
+// Helper: ANN search of one database
+static VectorSearchResults search_ann(VectorDB *db, const float *query_embedding, int limit, int ef_search)
+{
+    VectorSearchResults results = begin_search(db, query_embedding, &limit);
+    if (results.status != VECTORDB_STATUS_OK) {
+        return results;
+    }
+
+    float query[EMBEDDING_DIMENSION];
+    memcpy(query, query_embedding, sizeof(query));
+    vector_normalize(query, EMBEDDING_DIMENSION);
+
+    pthread_mutex_lock(&db->vectors_mutex);
+
+    if (!load_vectors(db)) {
+        pthread_mutex_unlock(&db->vectors_mutex);
+        vector_search_results_free(&results);
+        results.status = VECTORDB_STATUS_MEMORY_ERROR;
+        return results;
+    }
+
+    // Twice the hits asked for: a file's sections can take several of them
+    VectorIndexHit hits[VECTORDB_MAX_RESULTS * 2];
+    int hit_count = vector_index_search(db->vectors, query, limit * 2, ef_search, hits);
+
+    pthread_mutex_unlock(&db->vectors_mutex);
+
+    // Only the winners are read back from SQLite
+    VectorDBReader *reader = acquire_reader(db);
+    fill_results(reader, hits, hit_count, &results);
+    release_reader(db, reader);
+    return results;
+}
+
+// Min-heap on score, so the weakest kept hit is at the root
+static void hit_sift_down(VectorIndexHit *heap, int count, int i)
+{
+    for (;;) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < count && heap[left].score < heap[smallest].score) smallest = left;
+        if (right < count && heap[right].score < heap[smallest].score) smallest = right;
+        if (smallest == i) {
+            return;
+        }
+        VectorIndexHit tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void hit_sift_up(VectorIndexHit *heap, int i)
+{
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap[parent].score <= heap[i].score) {
+            return;
+        }
+        VectorIndexHit tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+static int compare_hits_desc(const void *a, const void *b)
+{
+    float sa = ((const VectorIndexHit *)a)->score;
+    float sb = ((const VectorIndexHit *)b)->score;
+    return (sa < sb) - (sa > sb);
+}
+
+// Helper: best max_hits of the resident vectors under directory, best first (caller
+// holds vectors_mutex, paths loaded). Exact over the directory's range of the sorted
+// paths, a prefix match like LIKE 'dir%'
+static int scan_directory(VectorDB *db, const float *query, const char *directory,
+                          VectorIndexHit *heap, int max_hits)
+{
+    int collected = 0;
+
+    size_t prefix_length = strlen(directory);
+    int lo = 0;
+    int hi = db->dir_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcasecmp(db->dir_entries[mid].path, directory) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (int i = lo; i < db->dir_count && strncasecmp(db->dir_entries[i].path, directory, prefix_length) == 0; i++) {
+        VectorIndexHit hit = {db->dir_entries[i].id, 0.0f};
+        const float *vector = vector_index_get(db->vectors, hit.label);
+        if (vector == NULL) {
+            continue;
+        }
+
+        hit.score = vector_dot(query, vector, EMBEDDING_DIMENSION);
+        if (collected < max_hits) {
+            heap[collected] = hit;
+            hit_sift_up(heap, collected++);
+        } else if (hit.score > heap[0].score) {
+            heap[0] = hit;
+            hit_sift_down(heap, collected, 0);
+        }
+    }
+
+    qsort(heap, (size_t)collected, sizeof(VectorIndexHit), compare_hits_desc);
+    return collected;
+}
+
+// Helper: exact search of one database within directory
+static VectorSearchResults search_directory(VectorDB *db, const float *query_embedding,
+                                            const char *directory, int limit)
+{
+    if (directory == NULL) {
+        VectorSearchResults results = {0};
+        results.status = db != NULL && db->initialized ? VECTORDB_STATUS_INVALID_EMBEDDING
+                                                       : VECTORDB_STATUS_NOT_INITIALIZED;
+        return results;
+    }
+
+    VectorSearchResults results = begin_search(db, query_embedding, &limit);
+    if (results.status != VECTORDB_STATUS_OK) {
+        return results;
+    }
+
+    float query[EMBEDDING_DIMENSION];
+    memcpy(query, query_embedding, sizeof(query));
+    vector_normalize(query, EMBEDDING_DIMENSION);
+
+    pthread_mutex_lock(&db->vectors_mutex);
+
+    if (!load_vectors(db)) {
+        pthread_mutex_unlock(&db->vectors_mutex);
+        vector_search_results_free(&results);
+        results.status = VECTORDB_STATUS_MEMORY_ERROR;
+        return results;
+    }
+
+    if (!load_directory_entries(db)) {
+        pthread_mutex_unlock(&db->vectors_mutex);
+        vector_search_results_free(&results);
+        results.status = VECTORDB_STATUS_MEMORY_ERROR;
+        return results;
+    }
+
+    VectorIndexHit hits[VECTORDB_MAX_RESULTS * 2];
+    int hit_count = scan_directory(db, query, directory, hits, limit * 2);
+
+    pthread_mutex_unlock(&db->vectors_mutex);
+
+    VectorDBReader *reader = acquire_reader(db);
+    fill_results(reader, hits, hit_count, &results);
+    release_reader(db, reader);
+    return results;
+}
+
+// One file in a hybrid search, with its place in each ranking (0 = not ranked there)
+typedef struct FusionCandidate {
+    int64_t file_id;
+    int64_t label;              // Best vector hit: the file or one of its sections
+    float score;                // Cosine similarity of that hit
+    bool has_vector;
+    int vector_rank;
+    int lexical_rank;
+    float fused;
+} FusionCandidate;
+
+// Helper: FTS5 query matching any word of text, the last as a prefix while it may
+// still be typed. Words are quoted so punctuation cannot form query syntax. False if
+// text has no word to match
+static bool build_match_query(const char *text, char *out, size_t out_size)
+{
+    size_t length = 0;
+    bool any = false;
+    const char *p = text;
+
+    while (*p != '\0') {
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+        const char *start = p;
+        bool has_word = false;
+        while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+            unsigned char c = (unsigned char)*p;
+            has_word = has_word || c >= 0x80 || (c >= '0' && c <= '9') ||
+                       ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+            p++;
+        }
+        if (!has_word) {
+            continue;
+        }
+
+        // Worst case: separator, quotes doubled, closing quote and prefix star
+        size_t needed = 4 + (size_t)(p - start) * 2 + 3;
+        if (length + needed >= out_size) {
+            break;
+        }
+        if (any) {
+            memcpy(out + length, " OR ", 4);
+            length += 4;
+        }
+        out[length++] = '"';
+        for (const char *c = start; c < p; c++) {
+            if (*c == '"') {
+                out[length++] = '"';
+            }
+            out[length++] = *c;
+        }
+        out[length++] = '"';
+        if (*p == '\0') {
+            out[length++] = '*';
+        }
+        any = true;
+    }
+
+    out[length] = '\0';
+    return any;
+}
+
+// Helper: candidate for file_id, or -1
+static int find_candidate(const FusionCandidate *candidates, int count, int64_t file_id)
+{
+    for (int i = 0; i < count; i++) {
+        if (candidates[i].file_id == file_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int compare_candidates_by_score(const void *a, const void *b)
+{
+    const FusionCandidate *ca = a;
+    const FusionCandidate *cb = b;
+    if (ca->has_vector != cb->has_vector) {
+        return ca->has_vector ? -1 : 1;
+    }
+    return (ca->score < cb->score) - (ca->score > cb->score);
+}
+
+static int compare_candidates_by_fused(const void *a, const void *b)
+{
+    float fa = ((const FusionCandidate *)a)->fused;
+    float fb = ((const FusionCandidate *)b)->fused;
+    return (fa < fb) - (fa > fb);
+}
+
+// Helper: gather the vector hits and full-text matches as one candidate per file
+// (caller holds vectors_mutex, vectors loaded and, for a directory, paths loaded)
+static int gather_candidates(VectorDB *db, VectorDBReader *reader, const float *query, const char *match,
+                             const char *directory, int ef_search, FusionCandidate *candidates)
+{
+    VectorIndexHit hits[HYBRID_VECTOR_DEPTH];
+    int hit_count = directory != NULL
+        ? scan_directory(db, query, directory, hits, HYBRID_VECTOR_DEPTH)
+        : vector_index_search(db->vectors, query, HYBRID_VECTOR_DEPTH, ef_search, hits);
+
+    // A file's best hit comes first; its other sections add nothing
+    int count = 0;
+    for (int i = 0; i < hit_count; i++) {
+        int64_t file_id = hits[i].label;
+        if (file_id >= CHUNK_LABEL_BASE) {
+            sqlite3_reset(reader->stmt_get_chunk);
+            sqlite3_bind_int64(reader->stmt_get_chunk, 1, file_id - CHUNK_LABEL_BASE);
+            file_id = sqlite3_step(reader->stmt_get_chunk) == SQLITE_ROW ? sqlite3_column_int64(reader->stmt_get_chunk, 0) : -1;
+            sqlite3_reset(reader->stmt_get_chunk);
+        }
+        if (file_id < 0 || find_candidate(candidates, count, file_id) >= 0) {
+            continue;
+        }
+        candidates[count++] = (FusionCandidate){ file_id, hits[i].label, hits[i].score, true, 0, 0, 0.0f };
+    }
+
+    // Full-text matches the vector search did not reach are rescored from their vectors
+    if (reader->stmt_search_text == NULL) {
+        return count;
+    }
+    sqlite3_reset(reader->stmt_search_text);
+    sqlite3_bind_text(reader->stmt_search_text, 1, match, -1, SQLITE_TRANSIENT);
+    if (directory != NULL) {
+        sqlite3_bind_text(reader->stmt_search_text, 2, directory, -1, SQLITE_TRANSIENT);
+    } else {
+        sqlite3_bind_null(reader->stmt_search_text, 2);
+    }
+    sqlite3_bind_int(reader->stmt_search_text, 3, HYBRID_LEXICAL_CANDIDATES);
+
+    int rank = 0;
+    while (sqlite3_step(reader->stmt_search_text) == SQLITE_ROW) {
+        int64_t file_id = sqlite3_column_int64(reader->stmt_search_text, 0);
+        int i = find_candidate(candidates, count, file_id);
+        if (i < 0) {
+            const float *vector = vector_index_get(db->vectors, file_id);
+            i = count++;
+            candidates[i] = (FusionCandidate){ file_id, file_id, 0.0f, vector != NULL, 0, 0, 0.0f };
+            if (vector != NULL) {
+                candidates[i].score = vector_dot(query, vector, EMBEDDING_DIMENSION);
+            }
+        }
+        candidates[i].lexical_rank = ++rank;
+    }
+    sqlite3_reset(reader->stmt_search_text);
+    return count;
+}
+
+// Helper: hybrid search of one database; fused gets each result's fused score, by
+// which they are ordered (their vector rank's share alone for a plain vector search)
+static VectorSearchResults search_hybrid(VectorDB *db, const float *query_embedding, const char *query_text,
+                                         const char *directory, int limit, int ef_search, float *fused)
+{
+    char match[HYBRID_MATCH_SIZE];
+    if (db == NULL || !db->has_fulltext || query_text == NULL ||
+        !build_match_query(query_text, match, sizeof(match))) {
+        VectorSearchResults results = directory != NULL
+            ? search_directory(db, query_embedding, directory, limit)
+            : search_ann(db, query_embedding, limit, ef_search);
+        for (int i = 0; i < results.count; i++) {
+            fused[i] = 1.0f / (HYBRID_RRF_K + (float)(i + 1));
+        }
+        return results;
+    }
+
+    VectorSearchResults results = begin_search(db, query_embedding, &limit);
+    if (results.status != VECTORDB_STATUS_OK) {
+        return results;
+    }
+
+    FusionCandidate *candidates = malloc((HYBRID_VECTOR_DEPTH + HYBRID_LEXICAL_CANDIDATES) * sizeof(FusionCandidate));
+    if (candidates == NULL) {
+        vector_search_results_free(&results);
+        results.status = VECTORDB_STATUS_MEMORY_ERROR;
+        return results;
+    }
+
+    float query[EMBEDDING_DIMENSION];
+    memcpy(query, query_embedding, sizeof(query));
+    vector_normalize(query, EMBEDDING_DIMENSION);
+
+    // One snapshot for the full-text matches and the rows read back
+    VectorDBReader *reader = acquire_reader(db);
+    if (reader == NULL) {
+        free(candidates);
+        vector_search_results_free(&results);
+        results.status = VECTORDB_STATUS_DB_ERROR;
+        return results;
+    }
+
+    pthread_mutex_lock(&db->vectors_mutex);
+
+    if (!load_vectors(db) || (directory != NULL && !load_directory_entries(db))) {
+        pthread_mutex_unlock(&db->vectors_mutex);
+        release_reader(db, reader);
+        free(candidates);
+        vector_search_results_free(&results);
+        results.status = VECTORDB_STATUS_MEMORY_ERROR;
+        return results;
+    }
+
+    int count = gather_candidates(db, reader, query, match, directory, ef_search, candidates);
+
+    pthread_mutex_unlock(&db->vectors_mutex);
+
+    // Reciprocal rank fusion: each ranking a file appears in adds 1 / (k + rank)
+    qsort(candidates, (size_t)count, sizeof(FusionCandidate), compare_candidates_by_score);
+    for (int i = 0; i < count; i++) {
+        FusionCandidate *candidate = &candidates[i];
+        candidate->vector_rank = candidate->has_vector ? i + 1 : 0;
+        candidate->fused = 0.0f;
+        if (candidate->vector_rank > 0) {
+            candidate->fused += 1.0f / (HYBRID_RRF_K + (float)candidate->vector_rank);
+        }
+        if (candidate->lexical_rank > 0) {
+            candidate->fused += 1.0f / (HYBRID_RRF_K + (float)candidate->lexical_rank);
+        }
+    }
+    qsort(candidates, (size_t)count, sizeof(FusionCandidate), compare_candidates_by_fused);
+
+    // Results keep the cosine similarity as their score, in fused order
+    int hit_count = count < limit ? count : limit;
+    VectorIndexHit hits[VECTORDB_MAX_RESULTS];
+    for (int i = 0; i < hit_count; i++) {
+        hits[i].label = candidates[i].label;
+        hits[i].score = candidates[i].score;
+    }
+    fill_results(reader, hits, hit_count, &results);
+    release_reader(db, reader);
+
+    for (int i = 0; i < results.count; i++) {
+        int c = find_candidate(candidates, hit_count, results.results[i].file.id);
+        results.results[i].text_match = c >= 0 && candidates[c].lexical_rank > 0;
+        fused[i] = c >= 0 ? candidates[c].fused : 0.0f;
+    }
+
+    free(candidates);
+    return results;
+}
+
+// One database's part of a search spanning shards
+typedef struct ShardSearch {
+    VectorDB *db;
+    const float *query;
+    const char *text;
+    const char *directory;
+    int limit;
+    int ef_search;
+    bool hybrid;
+    VectorSearchResults results;
+    float scores[VECTORDB_MAX_RESULTS];     // What the parts are merged by, best first
+} ShardSearch;
+
+// Helper: search one database (a job, or inline)
+static void shard_search_run(void *arg, JobToken *token)
+{
+    (void)token;
+    ShardSearch *search = (ShardSearch *)arg;
+    if (search->hybrid) {
+        search->results = search_hybrid(search->db, search->query, search->text, search->directory,
+                                        search->limit, search->ef_search, search->scores);
+        return;
+    }
+
+    search->results = search->directory != NULL
+        ? search_directory(search->db, search->query, search->directory, search->limit)
+        : search_ann(search->db, search->query, search->limit, search->ef_search);
+    for (int i = 0; i < search->results.count; i++) {
+        search->scores[i] = search->results.results[i].similarity;
+    }
+}
+
+// Helper: search the databases that can hold files under directory (NULL for all):
+// the shards side by side on the job scheduler while db is searched here, then the
+// best limit of all their results
+static VectorSearchResults search_scope(VectorDB *db, const float *query_embedding, const char *query_text,
+                                        const char *directory, int limit, int ef_search, bool hybrid)
+{
+    ShardSearch first = {
+        .db = db, .query = query_embedding, .text = query_text, .directory = directory,
+        .limit = limit, .ef_search = ef_search, .hybrid = hybrid
+    };
+    VectorDBScope scope = {0};
+    if (db != NULL && db->initialized) {
+        scope_acquire(db, directory, &scope);
+    }
+    if (scope.count == 0) {
+        shard_search_run(&first, NULL);
+        return first.results;
+    }
+
+    int count = scope.count + (scope.self ? 1 : 0);
+    ShardSearch *searches = malloc((size_t)count * sizeof(ShardSearch));
+    VectorSearchResults results = begin_search(db, query_embedding, &limit);
+    if (searches == NULL || results.status != VECTORDB_STATUS_OK) {
+        scope_release(db, &scope);
+        free(searches);
+        if (results.status == VECTORDB_STATUS_OK) {
+            vector_search_results_free(&results);
+            results.status = VECTORDB_STATUS_MEMORY_ERROR;
+        }
+        return results;
+    }
+
+    for (int i = 0; i < count; i++) {
+        searches[i] = first;
+        if (!scope.self || i > 0) {
+            searches[i].db = scope.shards[scope.self ? i - 1 : i]->db;
+        }
+    }
+
+    JobToken *token = job_token_create();
+    for (int i = 1; i < count; i++) {
+        if (token != NULL) {
+            jobs_submit(JOB_QOS_USER_INITIATED, shard_search_run, NULL, &searches[i], token);
+        } else {
+            shard_search_run(&searches[i], NULL);
+        }
+    }
+    shard_search_run(&searches[0], NULL);
+    if (token != NULL) {
+        job_token_wait(token);
+        job_token_release(token);
+    }
+    scope_release(db, &scope);
+
+    // Each part is best first: take the best next one until limit
+    int next[VECTORDB_MAX_SHARDS + 1] = {0};
+    while (results.count < limit) {
+        int best = -1;
+        for (int i = 0; i < count; i++) {
+            if (next[i] < searches[i].results.count &&
+                (best < 0 || searches[i].scores[next[i]] > searches[best].scores[next[best]])) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        results.results[results.count++] = searches[best].results.results[next[best]++];
+    }
+
+    // Failed only if every part did
+    bool failed = true;
+    for (int i = 0; i < count; i++) {
+        failed = failed && searches[i].results.status != VECTORDB_STATUS_OK;
+        vector_search_results_free(&searches[i].results);
+    }
+    if (failed) {
+        results.status = searches[0].results.status;
+    }
+    free(searches);
+    return results;
+}
+
+VectorSearchResults vectordb_search_ann(VectorDB *db,
+                                         const float *query_embedding,
+                                         int limit,
+                                         int ef_search)
+{
+    return search_scope(db, query_embedding, NULL, NULL, limit, ef_search, false);
+}
+
+VectorSearchResults vectordb_search_in_directory(VectorDB *db,
+                                                   const float *query_embedding,
+                                                   const char *directory,
+                                                   int limit)
+{
+    if (directory == NULL) {
+        return search_directory(db, query_embedding, NULL, limit);
+    }
+    return search_scope(db, query_embedding, NULL, directory, limit, 0, false);
+}
+
+VectorSearchResults vectordb_search_hybrid(VectorDB *db,
+                                            const float *query_embedding,
+                                            const char *query_text,
+                                            const char *directory,
+                                            int limit,
+                                            int ef_search)
+{
+    return search_scope(db, query_embedding, query_text, directory, limit, ef_search, true);
+}
+
+// Helper: link up to budget embeddings of one database
+static int build_index_in(VectorDB *db, int budget)
+{
+    if (db == NULL || !db->initialized) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&db->vectors_mutex);
+
+    int remaining = 0;
+    if (load_vectors(db)) {
+        int before = vector_index_build(db->vectors, 0);
+        remaining = vector_index_build(db->vectors, budget);
+        if (remaining != before) {
+            db->vectors_dirty = true;
+        }
+    }
+
+    pthread_mutex_unlock(&db->vectors_mutex);
+    return remaining;
+}
+
+// Helper: upkeep of one database
+static int optimize_in(VectorDB *db)
+{
+    if (db == NULL || !db->initialized) {
+        return 0;
+    }
+
+    // Rows of deleted embeddings linger in the resident index as graph waypoints
+    int compacted = 0;
+    pthread_mutex_lock(&db->vectors_mutex);
+    int dead = vector_index_dead_count(db->vectors);
+    if (dead > 0 && (int64_t)dead * 100 >= (int64_t)(dead + vector_index_count(db->vectors)) * MAINTAIN_COMPACT_PERCENT &&
+        vector_index_compact(db->vectors)) {
+        compacted = dead;
+        db->vectors_dirty = true;
+    }
+    bool in_batch = db->in_batch;
+    pthread_mutex_unlock(&db->vectors_mutex);
+    if (in_batch) {
+        return compacted;
+    }
+
+    // Merge the full-text segments deletions left behind, and refresh the statistics the
+    // query planner chooses indexes by
+    if (db->has_fulltext) {
+        sqlite3_exec(db->db, "INSERT INTO file_text(file_text) VALUES('optimize');", NULL, NULL, NULL);
+    }
+    char sql[64];
+    snprintf(sql, sizeof(sql), "PRAGMA analysis_limit=%d; ANALYZE;", MAINTAIN_ANALYSIS_LIMIT);
+    sqlite3_exec(db->db, sql, NULL, NULL, NULL);
+    return compacted;
+}
+
+// Helper: the integer a PRAGMA returns on the writer connection; -1 on failure
+static int64_t pragma_int64(VectorDB *db, const char *pragma)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db->db, pragma, -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    int64_t value = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+// Helper: give back unused pages of one database
+static int64_t vacuum_in(VectorDB *db, int max_pages)
+{
+    if (db == NULL || !db->initialized || max_pages <= 0) {
+        return 0;
+    }
+
+    // Not inside someone's batch: a full VACUUM cannot run in a transaction, and
+    // freeing pages there would make the batch wait
+    pthread_mutex_lock(&db->vectors_mutex);
+    bool in_batch = db->in_batch;
+    pthread_mutex_unlock(&db->vectors_mutex);
+    if (in_batch) {
+        return 0;
+    }
+
+    int64_t page_size = pragma_int64(db, "PRAGMA page_size;");
+    int64_t pages = pragma_int64(db, "PRAGMA page_count;");
+    int64_t free_pages = pragma_int64(db, "PRAGMA freelist_count;");
+    if (page_size <= 0 || pages <= 0 || free_pages <= 0) {
+        return 0;
+    }
+
+    if (pragma_int64(db, "PRAGMA auto_vacuum;") != 2) {
+        // Made before incremental vacuum: one full VACUUM converts it, once enough is
+        // unused to be worth rewriting the file
+        if (free_pages * 100 < pages * MAINTAIN_CONVERT_PERCENT ||
+            sqlite3_exec(db->db, "PRAGMA auto_vacuum=INCREMENTAL; VACUUM;", NULL, NULL, NULL) != SQLITE_OK) {
+            return 0;
+        }
+    } else {
+        char sql[64];
+        snprintf(sql, sizeof(sql), "PRAGMA incremental_vacuum(%d);", max_pages);
+        if (sqlite3_exec(db->db, sql, NULL, NULL, NULL) != SQLITE_OK) {
+            return 0;
+        }
+    }
+
+    // The file only shrinks once the freed pages are checkpointed out of the WAL
+    sqlite3_exec(db->db, "PRAGMA wal_checkpoint(TRUNCATE);", NULL, NULL, NULL);
+    int64_t after = pragma_int64(db, "PRAGMA page_count;");
+    return after >= 0 && after < pages ? (pages - after) * page_size : 0;
+}
+
+// Helper: file size and unused bytes of one database
+static void file_usage_in(VectorDB *db, int64_t *total, int64_t *unused)
+{
+    int64_t page_size = db != NULL && db->initialized ? pragma_int64(db, "PRAGMA page_size;") : -1;
+    int64_t pages = page_size > 0 ? pragma_int64(db, "PRAGMA page_count;") : -1;
+    int64_t free_pages = page_size > 0 ? pragma_int64(db, "PRAGMA freelist_count;") : -1;
+    if (total != NULL) {
+        *total = pages > 0 ? pages * page_size : 0;
+    }
+    if (unused != NULL) {
+        *unused = free_pages > 0 ? free_pages * page_size : 0;
+    }
+}
+
+// Helper: save the ANN index of one database
+static bool save_index_in(VectorDB *db)
+{
+    if (db == NULL || !db->initialized) {
+        return false;
+    }
+
+    pthread_mutex_lock(&db->vectors_mutex);
+
+    // Mid-batch the signature would describe rows that are not committed yet
+    bool ok = true;
+    if (db->vectors != NULL && db->vectors_dirty && !db->in_batch) {
+        ok = vector_index_save(db->vectors, db->index_path, embedding_signature(db));
+        if (ok) {
+            db->vectors_dirty = false;
+        }
+    }
+
+    pthread_mutex_unlock(&db->vectors_mutex);
+    return ok;
+}
+
+// Helper: free the saved resident embeddings of one database
+static bool release_index_in(VectorDB *db)
+{
+    if (db == NULL || !db->initialized) {
+        return false;
+    }
+
+    // Only a saved index is dropped: the file brings it back without relinking the graph
+    pthread_mutex_lock(&db->vectors_mutex);
+    bool release = db->vectors != NULL && !db->vectors_dirty && !db->in_batch;
+    if (release) {
+        drop_vectors(db);
+    }
+    pthread_mutex_unlock(&db->vectors_mutex);
+    return release;
+}
+
+// Helper: set the scan prefilter of one database
+static void set_quantization_in(VectorDB *db, VectorQuantization quantization)
+{
+    if (db == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&db->vectors_mutex);
+    db->quantization = quantization;
+    if (db->vectors != NULL && !vector_index_set_quantization(db->vectors, quantization)) {
+        // Out of memory for the codes: fall back to plain float scans
+        db->quantization = VECTOR_QUANT_NONE;
+    }
+    pthread_mutex_unlock(&db->vectors_mutex);
+}
+
+// Helper: set the model of one database
+static void set_model_in(VectorDB *db, const char *model)
+{
+    if (db == NULL || !db->initialized) {
+        return;
+    }
+
+    pthread_mutex_lock(&db->vectors_mutex);
+    if (strcmp(db->model, model != NULL ? model : "") != 0) {
+        snprintf(db->model, sizeof(db->model), "%s", model != NULL ? model : "");
+        // The resident vectors belong to the previous model
+        drop_vectors(db);
+    }
+    if (db->model[0] != '\0') {
+        sqlite3_exec(db->db, SQL_ADOPT_UNTAGGED, NULL, NULL, NULL);
+    }
+    pthread_mutex_unlock(&db->vectors_mutex);
+}
+
+int vectordb_build_index(VectorDB *db, int budget)
+{
+    if (db == NULL || !db->initialized) {
+        return 0;
+    }
+
+    // The budget goes to one database at a time, so a slice takes no longer with shards
+    VectorDBScope scope;
+    scope_acquire(db, NULL, &scope);
+    int remaining = build_index_in(db, budget);
+    for (int i = 0; i < scope.count; i++) {
+        remaining += build_index_in(scope.shards[i]->db, remaining > 0 ? 0 : budget);
+    }
+    scope_release(db, &scope);
+    return remaining;
+}
+
+int vectordb_optimize(VectorDB *db)
+{
+    if (db == NULL || !db->initialized) {
+        return 0;
     }
 
-    return VECTORDB_STATUS_OK;
+    VectorDBScope scope;
+    scope_acquire(db, NULL, &scope);
+    int compacted = optimize_in(db);
+    for (int i = 0; i < scope.count; i++) {
+        compacted += optimize_in(scope.shards[i]->db);
+    }
+    scope_release(db, &scope);
+    return compacted;
 }
 
-VectorDBStatus vectordb_delete_file(VectorDB *db, const char *path)
+int64_t vectordb_vacuum(VectorDB *db, int max_pages)
 {
     if (db == NULL || !db->initialized) {
-        return VECTORDB_STATUS_NOT_INITIALIZED;
+        return 0;
     }
 
-    if (path == NULL) {
-        return VECTORDB_STATUS_NOT_FOUND;
+    VectorDBScope scope;
+    scope_acquire(db, NULL, &scope);
+    int64_t reclaimed = vacuum_in(db, max_pages);
+    for (int i = 0; i < scope.count; i++) {
+        reclaimed += vacuum_in(scope.shards[i]->db, max_pages);
     }
+    scope_release(db, &scope);
+    return reclaimed;
+}
 
-    sqlite3_reset(db->stmt_delete);
-    sqlite3_bind_text(db->stmt_delete, 1, path, -1, SQLITE_TRANSIENT);
+void vectordb_file_usage(VectorDB *db, int64_t *total, int64_t *unused)
+{
+    int64_t file_total = 0;
+    int64_t file_unused = 0;
+    file_usage_in(db, &file_total, &file_unused);
+    if (db != NULL && db->initialized) {
+        VectorDBScope scope;
+        scope_acquire(db, NULL, &scope);
+        for (int i = 0; i < scope.count; i++) {
+            int64_t shard_total;
+            int64_t shard_unused;
+            file_usage_in(scope.shards[i]->db, &shard_total, &shard_unused);
+            file_total += shard_total;
+            file_unused += shard_unused;
+        }
+        scope_release(db, &scope);
+    }
+    if (total != NULL) {
+        *total = file_total;
+    }
+    if (unused != NULL) {
+        *unused = file_unused;
+    }
+}
 
-    int rc = sqlite3_step(db->stmt_delete);
-    if (rc != SQLITE_DONE) {
-        return VECTORDB_STATUS_DB_ERROR;
+bool vectordb_save_index(VectorDB *db)
+{
+    if (db == NULL || !db->initialized) {
+        return false;
     }
 
-    return VECTORDB_STATUS_OK;
+    VectorDBScope scope;
+    scope_acquire(db, NULL, &scope);
+    bool ok = save_index_in(db);
+    for (int i = 0; i < scope.count; i++) {
+        ok = save_index_in(scope.shards[i]->db) && ok;
+    }
+    scope_release(db, &scope);
+    return ok;
 }
 
-VectorDBStatus vectordb_delete_directory(VectorDB *db, const char *dir_path)
+bool vectordb_release_index(VectorDB *db)
 {
     if (db == NULL || !db->initialized) {
-        return VECTORDB_STATUS_NOT_INITIALIZED;
+        return false;
     }
 
-    if (dir_path == NULL) {
-        return VECTORDB_STATUS_NOT_FOUND;
+    VectorDBScope scope;
+    scope_acquire(db, NULL, &scope);
+    bool released = release_index_in(db);
+    for (int i = 0; i < scope.count; i++) {
+        released = release_index_in(scope.shards[i]->db) || released;
     }
+    scope_release(db, &scope);
+    return released;
+}
 
-    sqlite3_stmt *stmt;
-    sqlite3_prepare_v2(db->db, SQL_DELETE_DIR, -1, &stmt, NULL);
-    sqlite3_bind_text(stmt, 1, dir_path, -1, SQLITE_TRANSIENT);
+void vectordb_set_quantization(VectorDB *db, VectorQuantization quantization)
+{
+    if (db == NULL) {
+        return;
+    }
 
-    int rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    // Shards attached later take the database's setting
+    VectorDBScope scope;
+    scope_acquire(db, NULL, &scope);
+    set_quantization_in(db, quantization);
+    for (int i = 0; i < scope.count; i++) {
+        set_quantization_in(scope.shards[i]->db, quantization);
+    }
+    scope_release(db, &scope);
+}
 
-    if (rc != SQLITE_DONE) {
-        return VECTORDB_STATUS_DB_ERROR;
+void vectordb_set_model(VectorDB *db, const char *model)
+{
+    if (db == NULL || !db->initialized) {
+        return;
     }
 
-    return VECTORDB_STATUS_OK;
+    VectorDBScope scope;
+    scope_acquire(db, NULL, &scope);
+    set_model_in(db, model);
+    for (int i = 0; i < scope.count; i++) {
+        set_model_in(scope.shards[i]->db, model);
+    }
+    scope_release(db, &scope);
 }
 
-bool vectordb_is_indexed(VectorDB *db, const char *path, int64_t modified_time)
+void vector_search_results_free(VectorSearchResults *results)
 {
-    if (db == NULL || !db->initialized || path == NULL) {
-        return false;
+    if (results == NULL) {
+        return;
     }
 
-    sqlite3_reset(db->stmt_check_indexed);
-    sqlite3_bind_text(db->stmt_check_indexed, 1, path, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int64(db->stmt_check_indexed, 2, modified_time);
-
-    int rc = sqlite3_step(db->stmt_check_indexed);
-    return rc == SQLITE_ROW;
+    if (results->results != NULL) {
+        free(results->results);
+        results->results = NULL;
+    }
+    results->count = 0;
+    results->capacity = 0;
 }
 
-VectorDBStatus vectordb_get_file(VectorDB *db, const char *path, IndexedFile *file)
+// Helper: the single integer a query returns, read through a reader; 0 on failure
+// Helper: the integer a query returns from one database
+static int64_t read_int64_in(VectorDB *db, const char *sql)
 {
     if (db == NULL || !db->initialized) {
-        return VECTORDB_STATUS_NOT_INITIALIZED;
+        return 0;
     }
 
-    if (path == NULL || file == NULL) {
-        return VECTORDB_STATUS_NOT_FOUND;
+    VectorDBReader *reader = acquire_reader(db);
+    if (reader == NULL) {
+        return 0;
     }
 
-    memset(file, 0, sizeof(IndexedFile));
-
-    sqlite3_reset(db->stmt_get_by_path);
-    sqlite3_bind_text(db->stmt_get_by_path, 1, path, -1, SQLITE_TRANSIENT);
-
-    int rc = sqlite3_step(db->stmt_get_by_path);
-    if (rc != SQLITE_ROW) {
-        return VECTORDB_STATUS_NOT_FOUND;
+    int64_t value = 0;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(reader->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            value = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
     }
-
-    fill_indexed_file(db->stmt_get_by_path, file);
-    return VECTORDB_STATUS_OK;
+    release_reader(db, reader);
+    return value;
 }
 
-// Comparison function for sorting search results by similarity (descending)
-static int compare_search_results(const void *a, const void *b)
+// Helper: the integer a query returns, summed over the database and its shards
+static int64_t read_int64(VectorDB *db, const char *sql)
 {
-    const VectorSearchResult *ra = (const VectorSearchResult *)a;
-    const VectorSearchResult *rb = (const VectorSearchResult *)b;
-
-    if (rb->similarity > ra->similarity) return 1;
-    if (rb->similarity < ra->similarity) return -1;
-    return 0;
+    int64_t value = read_int64_in(db, sql);
+    if (db != NULL && db->initialized) {
+        VectorDBScope scope;
+        scope_acquire(db, NULL, &scope);
+        for (int i = 0; i < scope.count; i++) {
+            value += read_int64_in(scope.shards[i]->db, sql);
+        }
+        scope_release(db, &scope);
+    }
+    return value;
 }
 
-VectorSearchResults vectordb_search(VectorDB *db,
-                                     const float *query_embedding,
-                                     int limit)
+// Helper: hand the files of one database under directory to fn; *stopped is set if fn
+// asked to stop
+static int each_file_in(VectorDB *db, const char *directory, VectorDBFileFn fn, void *context, bool *stopped)
 {
-    VectorSearchResults results = {0};
 
-    if (db == NULL || !db->initialized) {
-        results.status = VECTORDB_STATUS_NOT_INITIALIZED;
-        return results;
+    // The bounds of the range below directory (a trailing slash is not doubled)
+    char low[4096];
+    char high[4096];
+    size_t len = strlen(directory);
+    while (len > 0 && directory[len - 1] == '/') {
+        len--;
     }
-
-    if (query_embedding == NULL || limit <= 0) {
-        results.status = VECTORDB_STATUS_INVALID_EMBEDDING;
-        return results;
+    if (len + 2 > sizeof(low)) {
+        return 0;
     }
-
-    if (limit > VECTORDB_MAX_RESULTS) {
-        limit = VECTORDB_MAX_RESULTS;
+    memcpy(low, directory, len);
+    memcpy(high, directory, len);
+    low[len] = '/';
+    high[len] = '0';
+    low[len + 1] = high[len + 1] = '\0';
+
+    VectorDBReader *reader = acquire_reader(db);
+    IndexedFile *file = malloc(sizeof(IndexedFile));
+    sqlite3_stmt *stmt = NULL;
+    int handed = 0;
+    if (reader != NULL && file != NULL &&
+        sqlite3_prepare_v2(reader->db, SQL_GET_FILES_UNDER, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, low, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, high, -1, SQLITE_STATIC);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            memset(file, 0, sizeof(IndexedFile));
+            fill_indexed_file(stmt, file);
+            const char *content_hash = (const char *)sqlite3_column_text(stmt, 8);
+            handed++;
+            if (!fn(file, content_hash != NULL ? content_hash : "", context)) {
+                *stopped = true;
+                break;
+            }
+        }
     }
-
-    // Allocate results array
-    results.capacity = limit;
-    results.results = calloc((size_t)limit, sizeof(VectorSearchResult));
-    if (results.results == NULL) {
-        results.status = VECTORDB_STATUS_MEMORY_ERROR;
-        return results;
+    sqlite3_finalize(stmt);
+    if (reader != NULL) {
+        release_reader(db, reader);
     }
+    free(file);
+    return handed;
+}
 
-    // Brute-force search through all embeddings
-    sqlite3_reset(db->stmt_get_all_embeddings);
+int vectordb_each_file(VectorDB *db, const char *directory, VectorDBFileFn fn, void *context)
+{
+    if (db == NULL || !db->initialized || directory == NULL || fn == NULL) {
+        return 0;
+    }
 
-    int collected = 0;
-    float min_similarity = 0.0f;
+    VectorDBScope scope;
+    scope_acquire(db, directory, &scope);
+    bool stopped = false;
+    int handed = scope.self ? each_file_in(db, directory, fn, context, &stopped) : 0;
+    for (int i = 0; i < scope.count && !stopped; i++) {
+        handed += each_file_in(scope.shards[i]->db, directory, fn, context, &stopped);
+    }
+    scope_release(db, &scope);
+    return handed;
+}
 
-    while (sqlite3_step(db->stmt_get_all_embeddings) == SQLITE_ROW) {
-        const void *blob = sqlite3_column_blob(db->stmt_get_all_embeddings, 7);
-        int blob_size = sqlite3_column_bytes(db->stmt_get_all_embeddings, 7);
+// Paths read from several databases
+typedef struct PathList {
+    char **paths;
+    int count;
+    int capacity;
+} PathList;
 
-        float file_embedding[EMBEDDING_DIMENSION];
-        if (!deserialize_embedding(blob, blob_size, file_embedding)) {
-            continue;
+// Helper: add a copy of path to a list (VectorDBPathFn)
+static bool path_list_add(const char *path, void *context)
+{
+    PathList *list = (PathList *)context;
+    if (list->count == list->capacity) {
+        int capacity = list->capacity > 0 ? list->capacity * 2 : 64;
+        char **paths = realloc(list->paths, (size_t)capacity * sizeof(char *));
+        if (paths == NULL) {
+            return false;
         }
+        list->paths = paths;
+        list->capacity = capacity;
+    }
+    char *copy = strdup(path);
+    if (copy == NULL) {
+        return false;
+    }
+    list->paths[list->count++] = copy;
+    return true;
+}
 
-        float similarity = embedding_cosine_similarity(query_embedding, file_embedding);
-
-        // If we haven't filled the results yet, or this is better than the worst
-        if (collected < limit || similarity > min_similarity) {
-            int insert_index;
+static void path_list_free(PathList *list)
+{
+    for (int i = 0; i < list->count; i++) {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+    memset(list, 0, sizeof(*list));
+}
 
-            if (collected < limit) {
-                insert_index = collected;
-                collected++;
-            } else {
-                // Find the index with minimum similarity
-                insert_index = 0;
-                for (int i = 1; i < collected; i++) {
-                    if (results.results[i].similarity < results.results[insert_index].similarity) {
-                        insert_index = i;
-                    }
-                }
-            }
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
 
-            fill_indexed_file(db->stmt_get_all_embeddings, &results.results[insert_index].file);
-            results.results[insert_index].similarity = similarity;
+// Helper: hand up to limit stale files of one database after after_path to fn
+static int each_stale_in(VectorDB *db, const char *after_path, int limit, VectorDBPathFn fn, void *context)
+{
+    VectorDBReader *reader = acquire_reader(db);
+    if (reader == NULL) {
+        return 0;
+    }
 
-            // Update minimum similarity
-            min_similarity = results.results[0].similarity;
-            for (int i = 1; i < collected; i++) {
-                if (results.results[i].similarity < min_similarity) {
-                    min_similarity = results.results[i].similarity;
-                }
+    sqlite3_stmt *stmt = NULL;
+    int handed = 0;
+    if (sqlite3_prepare_v2(reader->db, SQL_GET_STALE, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, after_path, -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, limit);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char *path = (const char *)sqlite3_column_text(stmt, 0);
+            handed++;
+            if (!fn(path != NULL ? path : "", context)) {
+                break;
             }
         }
     }
+    sqlite3_finalize(stmt);
+    release_reader(db, reader);
+    return handed;
+}
+
+int vectordb_each_stale(VectorDB *db, const char *after_path, int limit, VectorDBPathFn fn, void *context)
+{
+    if (db == NULL || !db->initialized || fn == NULL || limit <= 0) {
+        return 0;
+    }
+    if (after_path == NULL) {
+        after_path = "";
+    }
 
-    results.count = collected;
+    VectorDBScope scope;
+    scope_acquire(db, NULL, &scope);
+    if (scope.count == 0) {
+        return each_stale_in(db, after_path, limit, fn, context);
+    }
 
-    // Sort by similarity (descending)
-    if (collected > 1) {
-        qsort(results.results, (size_t)collected, sizeof(VectorSearchResult), compare_search_results);
+    // The first limit of each database, merged into path order
+    PathList list = {0};
+    each_stale_in(db, after_path, limit, path_list_add, &list);
+    for (int i = 0; i < scope.count; i++) {
+        each_stale_in(scope.shards[i]->db, after_path, limit, path_list_add, &list);
     }
+    scope_release(db, &scope);
 
-    results.status = VECTORDB_STATUS_OK;
-    return results;
+    if (list.count > 1) {
+        qsort(list.paths, (size_t)list.count, sizeof(char *), compare_paths);
+    }
+    int handed = 0;
+    while (handed < list.count && handed < limit) {
+        if (!fn(list.paths[handed++], context)) {
+            break;
+        }
+    }
+    path_list_free(&list);
+    return handed;
 }
 
-VectorSearchResults vectordb_search_in_directory(VectorDB *db,
-                                                   const float *query_embedding,
-                                                   const char *directory,
-                                                   int limit)
+int64_t vectordb_count_stale(VectorDB *db)
 {
-    VectorSearchResults results = {0};
+    return read_int64(db, SQL_COUNT_STALE);
+}
+
+int64_t vectordb_count_files(VectorDB *db)
+{
+    return read_int64(db, SQL_COUNT);
+}
+
+int64_t vectordb_count_chunks(VectorDB *db)
+{
+    return read_int64(db, SQL_COUNT_CHUNKS);
+}
 
+size_t vectordb_index_memory(VectorDB *db)
+{
     if (db == NULL || !db->initialized) {
-        results.status = VECTORDB_STATUS_NOT_INITIALIZED;
-        return results;
+        return 0;
     }
 
-    if (query_embedding == NULL || directory == NULL || limit <= 0) {
-        results.status = VECTORDB_STATUS_INVALID_EMBEDDING;
-        return results;
+    VectorDBScope scope;
+    scope_acquire(db, NULL, &scope);
+    pthread_mutex_lock(&db->vectors_mutex);
+    size_t bytes = vector_index_memory(db->vectors);
+    pthread_mutex_unlock(&db->vectors_mutex);
+    for (int i = 0; i < scope.count; i++) {
+        bytes += vectordb_index_memory(scope.shards[i]->db);
     }
+    scope_release(db, &scope);
+    return bytes;
+}
 
-    if (limit > VECTORDB_MAX_RESULTS) {
-        limit = VECTORDB_MAX_RESULTS;
-    }
+int64_t vectordb_total_size(VectorDB *db)
+{
+    return read_int64(db, SQL_TOTAL_SIZE);
+}
 
-    // Allocate results array
-    results.capacity = limit;
-    results.results = calloc((size_t)limit, sizeof(VectorSearchResult));
-    if (results.results == NULL) {
-        results.status = VECTORDB_STATUS_MEMORY_ERROR;
-        return results;
+bool vectordb_get_watch_checkpoint(VectorDB *db, const char *root, uint64_t *event_id)
+{
+    if (db == NULL || !db->initialized || root == NULL || event_id == NULL) {
+        return false;
     }
 
-    // Search within directory
     sqlite3_stmt *stmt;
-    sqlite3_prepare_v2(db->db, SQL_GET_DIR_EMBEDDINGS, -1, &stmt, NULL);
-    sqlite3_bind_text(stmt, 1, directory, -1, SQLITE_TRANSIENT);
+    if (sqlite3_prepare_v2(db->db, SQL_GET_CHECKPOINT, -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
+    }
 
-    int collected = 0;
-    float min_similarity = 0.0f;
+    sqlite3_bind_text(stmt, 1, root, -1, SQLITE_STATIC);
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    if (found) {
+        *event_id = (uint64_t)sqlite3_column_int64(stmt, 0);
+    }
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        const void *blob = sqlite3_column_blob(stmt, 7);
-        int blob_size = sqlite3_column_bytes(stmt, 7);
+    sqlite3_finalize(stmt);
+    return found;
+}
 
-        float file_embedding[EMBEDDING_DIMENSION];
-        if (!deserialize_embedding(blob, blob_size, file_embedding)) {
-            continue;
-        }
+VectorDBStatus vectordb_set_watch_checkpoint(VectorDB *db, const char *root, uint64_t event_id)
+{
+    if (db == NULL || !db->initialized) {
+        return VECTORDB_STATUS_NOT_INITIALIZED;
+    }
+    if (root == NULL) {
+        return VECTORDB_STATUS_NOT_FOUND;
+    }
 
-        float similarity = embedding_cosine_similarity(query_embedding, file_embedding);
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db->db, SQL_SET_CHECKPOINT, -1, &stmt, NULL) != SQLITE_OK) {
+        return VECTORDB_STATUS_DB_ERROR;
+    }
 
-        if (collected < limit || similarity > min_similarity) {
-            int insert_index;
+    sqlite3_bind_text(stmt, 1, root, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)event_id);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
 
-            if (collected < limit) {
-                insert_index = collected;
-                collected++;
-            } else {
-                insert_index = 0;
-                for (int i = 1; i < collected; i++) {
-                    if (results.results[i].similarity < results.results[insert_index].similarity) {
-                        insert_index = i;
-                    }
-                }
-            }
+    return (rc == SQLITE_DONE) ? VECTORDB_STATUS_OK : VECTORDB_STATUS_DB_ERROR;
+}
 
-            fill_indexed_file(stmt, &results.results[insert_index].file);
-            results.results[insert_index].similarity = similarity;
+// Helper: stop at the first file (VectorDBFileFn)
+static bool stop_at_file(const IndexedFile *file, const char *content_hash, void *context)
+{
+    (void)file;
+    (void)content_hash;
+    (void)context;
+    return false;
+}
 
-            min_similarity = results.results[0].similarity;
-            for (int i = 1; i < collected; i++) {
-                if (results.results[i].similarity < min_similarity) {
-                    min_similarity = results.results[i].similarity;
-                }
-            }
+// Helper: whether a shard is attached at root (1), none could be (-1: root overlaps
+// another's, or there are VECTORDB_MAX_SHARDS), or it can be (0). Caller holds
+// shards_mutex
+static int shard_slot(VectorDB *db, const char *root, size_t root_length)
+{
+    for (int i = 0; i < db->shard_count; i++) {
+        const VectorDBShard *shard = db->shards[i];
+        if (shard->root_length == root_length && strncmp(shard->root, root, root_length) == 0) {
+            return 1;
+        }
+        if (path_under(root, shard->root, shard->root_length) || path_under(shard->root, root, root_length)) {
+            return -1;
         }
     }
+    return db->shard_count < VECTORDB_MAX_SHARDS ? 0 : -1;
+}
 
-    sqlite3_finalize(stmt);
+bool vectordb_attach_shard(VectorDB *db, const char *root, const char *shard_path)
+{
+    if (db == NULL || !db->initialized || root == NULL || root[0] != '/' || shard_path == NULL) {
+        return false;
+    }
 
-    results.count = collected;
+    // The startup disk is the database itself
+    size_t root_length = strlen(root);
+    while (root_length > 1 && root[root_length - 1] == '/') {
+        root_length--;
+    }
+    if (root_length <= 1 || root_length + 2 > 4096) {
+        return false;
+    }
 
-    if (collected > 1) {
-        qsort(results.results, (size_t)collected, sizeof(VectorSearchResult), compare_search_results);
+    pthread_mutex_lock(&db->shards_mutex);
+    int slot = shard_slot(db, root, root_length);
+    pthread_mutex_unlock(&db->shards_mutex);
+    if (slot != 0) {
+        return slot > 0;
     }
 
-    results.status = VECTORDB_STATUS_OK;
-    return results;
-}
+    VectorDBShard *shard = calloc(1, sizeof(VectorDBShard));
+    char *shard_root = strndup(root, root_length);
+    VectorDB *shard_db = shard != NULL && shard_root != NULL ? vectordb_open(shard_path) : NULL;
+    if (shard_db == NULL) {
+        free(shard_root);
+        free(shard);
+        return false;
+    }
+    shard->db = shard_db;
+    shard->root = shard_root;
+    shard->root_length = root_length;
+    set_quantization_in(shard_db, db->quantization);
+    set_model_in(shard_db, db->model);
+
+    // Rows of a volume last mounted elsewhere point nowhere now
+    char low[4096];
+    char high[4096];
+    snprintf(low, sizeof(low), "%s/", shard_root);
+    snprintf(high, sizeof(high), "%s0", shard_root);
+    PathList outside = {0};
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(shard_db->db, SQL_GET_PATHS_OUTSIDE, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, low, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, high, -1, SQLITE_STATIC);
+        while (sqlite3_step(stmt) == SQLITE_ROW &&
+               path_list_add((const char *)sqlite3_column_text(stmt, 0), &outside)) {
+        }
+        sqlite3_finalize(stmt);
+    }
+    for (int i = 0; i < outside.count; i++) {
+        vectordb_delete_file(shard_db, outside.paths[i]);
+    }
+    path_list_free(&outside);
 
-void vector_search_results_free(VectorSearchResults *results)
-{
-    if (results == NULL) {
-        return;
+    pthread_mutex_lock(&db->shards_mutex);
+    slot = shard_slot(db, root, root_length);
+    if (slot == 0) {
+        db->shards[db->shard_count++] = shard;
+    }
+    pthread_mutex_unlock(&db->shards_mutex);
+    if (slot != 0) {
+        close_shard(shard);
+        return slot > 0;
     }
 
-    if (results->results != NULL) {
-        free(results->results);
-        results->results = NULL;
+    // Files db indexed while the volume had no shard are indexed again into it; left in
+    // db they would be found twice
+    bool stopped = false;
+    if (each_file_in(db, shard_root, stop_at_file, NULL, &stopped) > 0) {
+        delete_directory_in(db, low);
     }
-    results->count = 0;
-    results->capacity = 0;
+    return true;
 }
 
-int64_t vectordb_count_files(VectorDB *db)
+bool vectordb_detach_shard(VectorDB *db, const char *root)
 {
-    if (db == NULL || !db->initialized) {
-        return 0;
+    if (db == NULL || !db->initialized || root == NULL) {
+        return false;
     }
 
-    sqlite3_stmt *stmt;
-    sqlite3_prepare_v2(db->db, SQL_COUNT, -1, &stmt, NULL);
+    size_t root_length = strlen(root);
+    while (root_length > 1 && root[root_length - 1] == '/') {
+        root_length--;
+    }
 
-    int64_t count = 0;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        count = sqlite3_column_int64(stmt, 0);
+    // Taken out of the list first, so no new call reaches it while the last ones finish
+    VectorDBShard *shard = NULL;
+    pthread_mutex_lock(&db->shards_mutex);
+    for (int i = 0; i < db->shard_count && shard == NULL; i++) {
+        if (db->shards[i]->root_length == root_length && strncmp(db->shards[i]->root, root, root_length) == 0) {
+            shard = db->shards[i];
+            db->shards[i] = db->shards[--db->shard_count];
+        }
     }
+    while (shard != NULL && shard->users > 0) {
+        pthread_cond_wait(&db->shard_idle, &db->shards_mutex);
+    }
+    pthread_mutex_unlock(&db->shards_mutex);
 
-    sqlite3_finalize(stmt);
-    return count;
+    if (shard == NULL) {
+        return false;
+    }
+    close_shard(shard);
+    return true;
 }
 
-int64_t vectordb_total_size(VectorDB *db)
+int vectordb_each_shard(VectorDB *db, VectorDBPathFn fn, void *context)
 {
     if (db == NULL || !db->initialized) {
         return 0;
     }
 
-    sqlite3_stmt *stmt;
-    sqlite3_prepare_v2(db->db, SQL_TOTAL_SIZE, -1, &stmt, NULL);
-
-    int64_t total = 0;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        total = sqlite3_column_int64(stmt, 0);
+    // Copied, so fn may attach or detach
+    PathList roots = {0};
+    pthread_mutex_lock(&db->shards_mutex);
+    for (int i = 0; i < db->shard_count; i++) {
+        path_list_add(db->shards[i]->root, &roots);
     }
+    pthread_mutex_unlock(&db->shards_mutex);
 
-    sqlite3_finalize(stmt);
-    return total;
+    for (int i = 0; i < roots.count && fn != NULL; i++) {
+        if (!fn(roots.paths[i], context)) {
+            break;
+        }
+    }
+    int count = roots.count;
+    path_list_free(&roots);
+    return count;
 }
 
 VectorDBStatus vectordb_clear(VectorDB *db)
@@ -686,7 +3238,26 @@ VectorDBStatus vectordb_clear(VectorDB *db)
         return VECTORDB_STATUS_NOT_INITIALIZED;
     }
 
+    pthread_mutex_lock(&db->vectors_mutex);
+
     int rc = sqlite3_exec(db->db, SQL_CLEAR, NULL, NULL, NULL);
+    if (rc == SQLITE_OK && db->has_fulltext) {
+        rc = sqlite3_exec(db->db, SQL_CLEAR_TEXT, NULL, NULL, NULL);
+    }
+    drop_vectors(db);
+    remove(db->index_path);
+
+    pthread_mutex_unlock(&db->vectors_mutex);
+
+    VectorDBScope scope;
+    scope_acquire(db, NULL, &scope);
+    for (int i = 0; i < scope.count; i++) {
+        if (vectordb_clear(scope.shards[i]->db) != VECTORDB_STATUS_OK) {
+            rc = SQLITE_ERROR;
+        }
+    }
+    scope_release(db, &scope);
+
     if (rc != SQLITE_OK) {
         return VECTORDB_STATUS_DB_ERROR;
     }
@@ -716,55 +3287,25 @@ const char* vectordb_status_message(VectorDBStatus status)
     }
 }
 
-// Extension to file type lookup table
-typedef struct {
-    const char *ext;
-    IndexedFileType type;
-} ExtensionMapping;
-
-static const ExtensionMapping EXTENSION_MAP[] = {
-    // Text
-    {"txt", FILE_TYPE_TEXT}, {"md", FILE_TYPE_TEXT}, {"rst", FILE_TYPE_TEXT}, {"org", FILE_TYPE_TEXT},
-    // Code
-    {"c", FILE_TYPE_CODE}, {"h", FILE_TYPE_CODE}, {"cpp", FILE_TYPE_CODE}, {"hpp", FILE_TYPE_CODE},
-    {"py", FILE_TYPE_CODE}, {"js", FILE_TYPE_CODE}, {"ts", FILE_TYPE_CODE}, {"go", FILE_TYPE_CODE},
-    {"rs", FILE_TYPE_CODE}, {"java", FILE_TYPE_CODE}, {"swift", FILE_TYPE_CODE}, {"rb", FILE_TYPE_CODE},
-    {"sh", FILE_TYPE_CODE}, {"json", FILE_TYPE_CODE}, {"yaml", FILE_TYPE_CODE}, {"yml", FILE_TYPE_CODE},
-    {"xml", FILE_TYPE_CODE}, {"html", FILE_TYPE_CODE}, {"css", FILE_TYPE_CODE},
-    // Documents
-    {"pdf", FILE_TYPE_DOCUMENT}, {"doc", FILE_TYPE_DOCUMENT}, {"docx", FILE_TYPE_DOCUMENT},
-    {"odt", FILE_TYPE_DOCUMENT}, {"rtf", FILE_TYPE_DOCUMENT}, {"xls", FILE_TYPE_DOCUMENT},
-    {"xlsx", FILE_TYPE_DOCUMENT}, {"ppt", FILE_TYPE_DOCUMENT}, {"pptx", FILE_TYPE_DOCUMENT},
-    // Images
-    {"jpg", FILE_TYPE_IMAGE}, {"jpeg", FILE_TYPE_IMAGE}, {"png", FILE_TYPE_IMAGE},
-    {"gif", FILE_TYPE_IMAGE}, {"bmp", FILE_TYPE_IMAGE}, {"svg", FILE_TYPE_IMAGE},
-    {"webp", FILE_TYPE_IMAGE}, {"ico", FILE_TYPE_IMAGE}, {"tiff", FILE_TYPE_IMAGE}, {"heic", FILE_TYPE_IMAGE},
-    // Audio
-    {"mp3", FILE_TYPE_AUDIO}, {"wav", FILE_TYPE_AUDIO}, {"flac", FILE_TYPE_AUDIO},
-    {"aac", FILE_TYPE_AUDIO}, {"ogg", FILE_TYPE_AUDIO}, {"m4a", FILE_TYPE_AUDIO},
-    // Video
-    {"mp4", FILE_TYPE_VIDEO}, {"mkv", FILE_TYPE_VIDEO}, {"avi", FILE_TYPE_VIDEO},
-    {"mov", FILE_TYPE_VIDEO}, {"webm", FILE_TYPE_VIDEO}, {"wmv", FILE_TYPE_VIDEO},
-    // Archive
-    {"zip", FILE_TYPE_ARCHIVE}, {"tar", FILE_TYPE_ARCHIVE}, {"gz", FILE_TYPE_ARCHIVE},
-    {"bz2", FILE_TYPE_ARCHIVE}, {"xz", FILE_TYPE_ARCHIVE}, {"7z", FILE_TYPE_ARCHIVE},
-    {"rar", FILE_TYPE_ARCHIVE}, {"dmg", FILE_TYPE_ARCHIVE},
-    {NULL, FILE_TYPE_UNKNOWN}  // Sentinel
+// Indexed file types by file type class
+static const IndexedFileType INDEXED_TYPES[FILE_CLASS_COUNT] = {
+    [FILE_CLASS_TEXT] = FILE_TYPE_TEXT,
+    [FILE_CLASS_MARKDOWN] = FILE_TYPE_TEXT,
+    [FILE_CLASS_CODE] = FILE_TYPE_CODE,
+    [FILE_CLASS_DATA] = FILE_TYPE_CODE,
+    [FILE_CLASS_DOCUMENT] = FILE_TYPE_DOCUMENT,
+    [FILE_CLASS_SPREADSHEET] = FILE_TYPE_DOCUMENT,
+    [FILE_CLASS_PRESENTATION] = FILE_TYPE_DOCUMENT,
+    [FILE_CLASS_IMAGE] = FILE_TYPE_IMAGE,
+    [FILE_CLASS_AUDIO] = FILE_TYPE_AUDIO,
+    [FILE_CLASS_VIDEO] = FILE_TYPE_VIDEO,
+    [FILE_CLASS_ARCHIVE] = FILE_TYPE_ARCHIVE,
+    [FILE_CLASS_INSTALLER] = FILE_TYPE_ARCHIVE,
 };
 
 IndexedFileType vectordb_file_type_from_extension(const char *extension)
 {
-    if (extension == NULL || extension[0] == '\0') {
-        return FILE_TYPE_UNKNOWN;
-    }
-
-    for (const ExtensionMapping *m = EXTENSION_MAP; m->ext != NULL; m++) {
-        if (strcmp(extension, m->ext) == 0) {
-            return m->type;
-        }
-    }
-
-    return FILE_TYPE_UNKNOWN;
+    return INDEXED_TYPES[file_type_class(file_type_from_extension(extension))];
 }
 
 sqlite3* vectordb_get_db_handle(VectorDB *db)
@@ -6,10 +6,24 @@
 #include <stdint.h>
 #include <sqlite3.h>
 #include "embeddings.h"
+#include "vector_index.h"
 
 // Maximum number of search results
 #define VECTORDB_MAX_RESULTS 100
 
+// Section title buffer size
+#define VECTORDB_SECTION_TITLE_SIZE 128
+
+// Read-only connections that lookups and searches use, so they read the last commit
+// instead of waiting on a batch being written
+#define VECTORDB_READERS 4
+
+// Longest embedding model name recorded with each embedding
+#define VECTORDB_MODEL_SIZE 64
+
+// Most volume databases attached at once (see vectordb_attach_shard)
+#define VECTORDB_MAX_SHARDS 16
+
 // VectorDB status codes
 typedef enum VectorDBStatus {
     VECTORDB_STATUS_OK = 0,
@@ -50,8 +64,21 @@ typedef struct IndexedFile {
 typedef struct VectorSearchResult {
     IndexedFile file;
     float similarity;                   // Cosine similarity score (0-1)
+    bool has_section;                   // Best match was a section, not the whole file
+    int64_t section_offset;             // Byte range of that section
+    int64_t section_length;
+    char section_title[VECTORDB_SECTION_TITLE_SIZE];
+    bool text_match;                    // Query words found in its name or text (hybrid search)
 } VectorSearchResult;
 
+// One section of a file (heading, function, run of paragraphs), embedded on its own
+typedef struct VectorDBChunk {
+    int64_t offset;                     // Byte range in the file
+    int64_t length;
+    const char *title;                  // Heading or definition line, or NULL
+    const float *embedding;             // NULL sections are not stored
+} VectorDBChunk;
+
 // Search results array
 typedef struct VectorSearchResults {
     VectorSearchResult *results;
@@ -87,6 +114,42 @@ VectorDBStatus vectordb_index_file(VectorDB *db,
                                     int64_t modified_time,
                                     const float *embedding);
 
+// Hex content hash of a file plus terminator (room for SHA256; the indexer uses file_hash)
+#define VECTORDB_CONTENT_HASH_SIZE 65
+
+// Index a file whose content hashes to content_hash: files with identical content
+// share one stored embedding (NULL or "" hash behaves like vectordb_index_file)
+VectorDBStatus vectordb_index_file_with_hash(VectorDB *db,
+                                              const char *path,
+                                              const char *name,
+                                              IndexedFileType file_type,
+                                              int64_t size,
+                                              int64_t modified_time,
+                                              const char *content_hash,
+                                              const float *embedding);
+
+// Stored embedding for content already indexed under content_hash (false if none)
+bool vectordb_get_content_embedding(VectorDB *db, const char *content_hash, float *embedding);
+
+// Store the sections of an indexed file, replacing any it had. Searches return each
+// file once, with its best-matching section if that beat the file as a whole
+VectorDBStatus vectordb_set_chunks(VectorDB *db, const char *path, const VectorDBChunk *chunks, int count);
+
+// Store the extracted text of an indexed file in the full-text index, replacing any it
+// had (NULL clears it). Every indexed file is findable there by name regardless
+VectorDBStatus vectordb_set_text(VectorDB *db, const char *path, const char *text);
+
+// Whether the full-text index is available (SQLite built with FTS5)
+bool vectordb_has_fulltext(const VectorDB *db);
+
+// Group the writes that follow into one transaction until vectordb_commit_batch
+// (no-op if a batch is already open). Only the thread that began it sees its rows
+// before the commit
+VectorDBStatus vectordb_begin_batch(VectorDB *db);
+
+// Commit the open batch (no-op if none is open)
+VectorDBStatus vectordb_commit_batch(VectorDB *db);
+
 // Update file embedding
 VectorDBStatus vectordb_update_embedding(VectorDB *db,
                                           const char *path,
@@ -104,27 +167,127 @@ bool vectordb_is_indexed(VectorDB *db, const char *path, int64_t modified_time);
 // Get indexed file by path
 VectorDBStatus vectordb_get_file(VectorDB *db, const char *path, IndexedFile *file);
 
-// Search for similar files using embedding (brute-force cosine similarity)
+// Search for similar files using embedding (cosine similarity, default ANN recall)
 VectorSearchResults vectordb_search(VectorDB *db,
                                      const float *query_embedding,
                                      int limit);
 
-// Search for similar files within a directory
+// Search with an explicit HNSW candidate list size: larger = better recall, slower (0 = exact)
+VectorSearchResults vectordb_search_ann(VectorDB *db,
+                                         const float *query_embedding,
+                                         int limit,
+                                         int ef_search);
+
+// Search for similar files within a directory (exact)
 VectorSearchResults vectordb_search_in_directory(VectorDB *db,
                                                    const float *query_embedding,
                                                    const char *directory,
                                                    int limit);
 
+// Search by meaning and by words at once: vector hits and the files whose name or text
+// match the words of query_text (BM25, vectors of the best few thousand rescored) are
+// merged by reciprocal rank fusion. Results are in fused order and keep their cosine
+// similarity. directory limits both (NULL for all, exact within it). Without a
+// full-text index, or words to match, this is a plain vector search
+VectorSearchResults vectordb_search_hybrid(VectorDB *db,
+                                            const float *query_embedding,
+                                            const char *query_text,
+                                            const char *directory,
+                                            int limit,
+                                            int ef_search);
+
+// Link up to budget embeddings into the ANN graph; returns how many are still unlinked
+int vectordb_build_index(VectorDB *db, int budget);
+
+// Save the ANN index next to the database (<db_path>.hnsw) if it changed
+bool vectordb_save_index(VectorDB *db);
+
+// Free the resident embeddings and their ANN graph if they match the saved index, to be
+// loaded from it on next use; false if nothing was freed (not loaded, or changed since
+// the last save)
+bool vectordb_release_index(VectorDB *db);
+
+// Upkeep after churn, for idle time: compact the resident index once enough of it is
+// deleted embeddings (vectordb_build_index links its graph again), merge the full-text
+// index and refresh the query planner's statistics (ANALYZE). Returns the deleted
+// embeddings dropped
+int vectordb_optimize(VectorDB *db);
+
+// Give up to max_pages unused pages of the database file back to the file system; call
+// again while it returns more than 0 (the bytes reclaimed). A database made before
+// incremental vacuum is converted by one full VACUUM, once a quarter of it is unused.
+// Does nothing while a batch is open
+int64_t vectordb_vacuum(VectorDB *db, int max_pages);
+
+// Size of the database file and how much of it is unused pages, in bytes
+void vectordb_file_usage(VectorDB *db, int64_t *total, int64_t *unused);
+
+// Choose the compressed prefilter for exact scans of the resident embeddings (default: int8)
+void vectordb_set_quantization(VectorDB *db, VectorQuantization quantization);
+
+// Name the embedding model in use (e.g. its file name). New embeddings are recorded as
+// this model's, and reads and searches only see embeddings it made: files embedded by
+// another model are still found by name and text until embedded again. Embeddings from
+// before any model was named are taken to be this one's. Call before the database is
+// shared between threads
+void vectordb_set_model(VectorDB *db, const char *model);
+
 // Free search results
 void vector_search_results_free(VectorSearchResults *results);
 
+// Receives each file vectordb_each_file reads, with its content hash ("" if none);
+// return false to stop
+typedef bool (*VectorDBFileFn)(const IndexedFile *file, const char *content_hash, void *context);
+
+// Hand every indexed file under directory to fn in path order, read from one snapshot
+// (per database: the shards' files follow db's own); returns how many were handed over
+int vectordb_each_file(VectorDB *db, const char *directory, VectorDBFileFn fn, void *context);
+
+// Receives each path read; return false to stop
+typedef bool (*VectorDBPathFn)(const char *path, void *context);
+
+// Hand up to limit files embedded (or split into sections) by another model than the
+// one set to fn, in path order after after_path (NULL or "" to start); returns how many
+// were handed over. Passing the last path back visits each file once
+int vectordb_each_stale(VectorDB *db, const char *after_path, int limit, VectorDBPathFn fn, void *context);
+
+// Get number of files embedded by another model than the one set
+int64_t vectordb_count_stale(VectorDB *db);
+
 // Get number of indexed files
 int64_t vectordb_count_files(VectorDB *db);
 
+// Get number of stored sections
+int64_t vectordb_count_chunks(VectorDB *db);
+
 // Get total size of indexed files
 int64_t vectordb_total_size(VectorDB *db);
 
-// Clear all indexed files
+// Bytes held by the resident embeddings and their ANN graph (0 until first loaded)
+size_t vectordb_index_memory(VectorDB *db);
+
+// Last FSEvents ID whose changes under root are in the index (false if none recorded)
+bool vectordb_get_watch_checkpoint(VectorDB *db, const char *root, uint64_t *event_id);
+
+// Record the last FSEvents ID applied under root
+VectorDBStatus vectordb_set_watch_checkpoint(VectorDB *db, const char *root, uint64_t event_id);
+
+// Keep the files under root (a volume's mount point) in their own database at
+// shard_path, created if missing, until vectordb_detach_shard. Every call on db about a
+// path under root goes to the shard; searches, counts, batches and upkeep span db and
+// its shards, each shard searched side by side with db, and directory-scoped searches
+// only those that can hold the directory. Rows the shard holds from another mount point,
+// and any db holds under root, are dropped. True if attached, or already was
+bool vectordb_attach_shard(VectorDB *db, const char *root, const char *shard_path);
+
+// Close the shard attached at root once calls using it have returned (its volume was
+// unmounted); false if none is attached there
+bool vectordb_detach_shard(VectorDB *db, const char *root);
+
+// Hand the root of each attached shard to fn; returns how many there are
+int vectordb_each_shard(VectorDB *db, VectorDBPathFn fn, void *context);
+
+// Clear all indexed files (in the attached shards too)
 VectorDBStatus vectordb_clear(VectorDB *db);
 
 // Get status message
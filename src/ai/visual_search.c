@@ -1,7 +1,12 @@
 #include "visual_search.h"
 #include "ai_common.h"
+#include "vector_ops.h"
+#include "vector_index.h"
+#include "query_cache.h"
+#include "../utils/hash.h"
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
 #include <dirent.h>
 #include <sys/stat.h>
@@ -24,12 +29,11 @@ static const char *SQL_INSERT_IMAGE =
     "(path, name, embedding, width, height, size, modified_time) "
     "VALUES (?, ?, ?, ?, ?, ?, ?);";
 
-static const char *SQL_GET_ALL_IMAGES =
-    "SELECT path, name, embedding, width, height, size FROM image_index;";
+static const char *SQL_GET_ALL_IMAGE_EMBEDDINGS =
+    "SELECT rowid, embedding FROM image_index;";
 
-static const char *SQL_GET_IMAGES_IN_DIR =
-    "SELECT path, name, embedding, width, height, size FROM image_index "
-    "WHERE path LIKE ? || '%';";
+static const char *SQL_GET_IMAGE_EMBEDDINGS_IN_DIR =
+    "SELECT rowid, embedding FROM image_index WHERE path LIKE ? || '%';";
 
 static const char *SQL_COUNT_IMAGES =
     "SELECT COUNT(*) FROM image_index;";
@@ -37,16 +41,89 @@ static const char *SQL_COUNT_IMAGES =
 static const char *SQL_IS_IMAGE_INDEXED =
     "SELECT 1 FROM image_index WHERE path = ? AND modified_time >= ?;";
 
+static const char *SQL_GET_IMAGE_VECTORS =
+    "SELECT rowid, embedding FROM image_index WHERE embedding IS NOT NULL;";
+
+static const char *SQL_GET_IMAGE_ROWID =
+    "SELECT rowid FROM image_index WHERE path = ?;";
+
+static const char *SQL_GET_IMAGE_BY_ROWID =
+    "SELECT path, name, width, height, size FROM image_index WHERE rowid = ?;";
+
+// Images under a directory in path order, between "<dir>/" and "<dir>0"
+static const char *SQL_GET_IMAGES_UNDER =
+    "SELECT path, embedding, width, height, size, modified_time FROM image_index "
+    "WHERE path > ? AND path < ? AND embedding IS NOT NULL ORDER BY path;";
+
+static const char *SQL_GET_IMAGE_PATHS =
+    "SELECT rowid, path FROM image_index WHERE embedding IS NOT NULL;";
+
+// Re-indexing a path can reuse its rowid, but never with the same modified_time
+static const char *SQL_IMAGE_SIGNATURE =
+    "SELECT COUNT(*), COALESCE(MAX(rowid), 0), COALESCE(SUM(modified_time), 0) "
+    "FROM image_index WHERE embedding IS NOT NULL;";
+
+// Images linked into the ANN graph per query or index call while it catches up
+#define VISUAL_GRAPH_BUILD_BUDGET 256
+
+// Path of one resident image embedding, for directory-scoped searches
+typedef struct ImageEntry {
+    char *path;
+    int64_t rowid;
+} ImageEntry;
+
 // Visual search internal structure
 struct VisualSearch {
     CLIPEngine *clip_engine;
     VectorDB *vectordb;
     sqlite3 *db;        // Direct DB handle for image-specific queries
     bool initialized;
+
+    // Prepared statements on db
+    sqlite3_stmt *stmt_insert;
+    sqlite3_stmt *stmt_is_indexed;
+    sqlite3_stmt *stmt_get_rowid;
+    sqlite3_stmt *stmt_get_by_rowid;
+
+    // Resident image embeddings and their ANN graph, saved to index_path
+    VectorIndex *vectors;
+    bool vectors_dirty;
+    VectorQuantization quantization;
+    char index_path[4096 + 16];
+
+    // Paths of the resident embeddings, loaded by the first scoped or unlimited search.
+    // Sorted the way LIKE compares (ASCII case-insensitive), a directory is one
+    // contiguous range. Entries whose rowid has no vector any more drop at the next sort
+    ImageEntry *entries;
+    int entry_count;
+    int entry_capacity;
+    bool entries_loaded;
+    bool entries_sorted;
+
+    QueryCache *queries;    // Recent text query embeddings
 };
 
-// Forward declaration
+// Forward declarations
 static bool init_image_table(VisualSearch *vs);
+static void save_vectors(VisualSearch *vs);
+static void free_entries(VisualSearch *vs);
+static void finalize_statements(VisualSearch *vs);
+
+// Helper: text query encoder for the cache (normalized, as the stored embeddings are)
+static bool encode_query(void *context, const char *text, float *out)
+{
+    VisualSearch *vs = context;
+    if (vs->clip_engine == NULL) {
+        return false;
+    }
+    CLIPTextResult result = clip_embed_text(vs->clip_engine, text);
+    if (result.status != CLIP_STATUS_OK) {
+        return false;
+    }
+    vector_normalize(result.embedding, CLIP_EMBEDDING_DIMENSION);
+    memcpy(out, result.embedding, sizeof(result.embedding));
+    return true;
+}
 
 VisualSearch* visual_search_create(void)
 {
@@ -55,6 +132,8 @@ VisualSearch* visual_search_create(void)
         return NULL;
     }
 
+    vs->queries = query_cache_create(CLIP_EMBEDDING_DIMENSION, QUERY_CACHE_CAPACITY, encode_query, vs);
+    vs->quantization = VECTOR_QUANT_INT8;
     vs->initialized = true;
     return vs;
 }
@@ -65,6 +144,16 @@ void visual_search_destroy(VisualSearch *vs)
         return;
     }
 
+    // Stops the prefetch thread before the engine can go away
+    query_cache_destroy(vs->queries);
+
+    if (vs->vectors != NULL && vs->vectors_dirty) {
+        save_vectors(vs);
+    }
+    vector_index_destroy(vs->vectors);
+    free_entries(vs);
+    finalize_statements(vs);
+
     // We don't own the engine or db - just clear refs
     vs->clip_engine = NULL;
     vs->vectordb = NULL;
@@ -78,6 +167,8 @@ void visual_search_set_clip_engine(VisualSearch *vs, CLIPEngine *engine)
     if (vs == NULL) {
         return;
     }
+    // Embeddings from another engine would not match
+    query_cache_clear(vs->queries);
     vs->clip_engine = engine;
 }
 
@@ -88,11 +179,491 @@ void visual_search_set_vectordb(VisualSearch *vs, VectorDB *db)
     }
     vs->vectordb = db;
 
+    // Vectors belong to the previous database
+    if (vs->vectors != NULL && vs->vectors_dirty) {
+        save_vectors(vs);
+    }
+    vector_index_destroy(vs->vectors);
+    vs->vectors = NULL;
+    free_entries(vs);
+    finalize_statements(vs);
+    vs->db = NULL;
+
     // Get direct DB handle and initialize image table
     if (db != NULL) {
         vs->db = vectordb_get_db_handle(db);
-        init_image_table(vs);
+        const char *db_file = sqlite3_db_filename(vs->db, "main");
+        snprintf(vs->index_path, sizeof(vs->index_path), "%s.images.hnsw", db_file ? db_file : "");
+        if (init_image_table(vs)) {
+            sqlite3_prepare_v2(vs->db, SQL_INSERT_IMAGE, -1, &vs->stmt_insert, NULL);
+            sqlite3_prepare_v2(vs->db, SQL_IS_IMAGE_INDEXED, -1, &vs->stmt_is_indexed, NULL);
+            sqlite3_prepare_v2(vs->db, SQL_GET_IMAGE_ROWID, -1, &vs->stmt_get_rowid, NULL);
+            sqlite3_prepare_v2(vs->db, SQL_GET_IMAGE_BY_ROWID, -1, &vs->stmt_get_by_rowid, NULL);
+        }
+    }
+}
+
+void visual_search_set_quantization(VisualSearch *vs, VectorQuantization quantization)
+{
+    if (vs == NULL) {
+        return;
+    }
+
+    vs->quantization = quantization;
+    if (vs->vectors != NULL && !vector_index_set_quantization(vs->vectors, quantization)) {
+        vs->quantization = VECTOR_QUANT_NONE;
+    }
+}
+
+// Helper: fingerprint of the image table, used to tell whether a saved index is current
+static uint64_t image_signature(VisualSearch *vs)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(vs->db, SQL_IMAGE_SIGNATURE, -1, &stmt, NULL) != SQLITE_OK) {
+        return 0;
+    }
+
+    uint64_t signature = HASH_FNV1A64_INIT;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        for (int i = 0; i < 3; i++) {
+            signature ^= (uint64_t)sqlite3_column_int64(stmt, i);
+            signature *= HASH_FNV1A64_PRIME;
+        }
+    }
+    sqlite3_finalize(stmt);
+    return signature;
+}
+
+static void save_vectors(VisualSearch *vs)
+{
+    if (vs->db != NULL && vs->index_path[0] != '\0' &&
+        vector_index_save(vs->vectors, vs->index_path, image_signature(vs))) {
+        vs->vectors_dirty = false;
+    }
+}
+
+// Helper: make vs->vectors available, from the saved index when it is current or
+// else from the table (the graph over those is linked a budget at a time)
+static bool ensure_vectors(VisualSearch *vs)
+{
+    if (vs->vectors != NULL) {
+        return true;
+    }
+
+    vs->vectors = vector_index_load(vs->index_path, CLIP_EMBEDDING_DIMENSION, image_signature(vs));
+    if (vs->vectors != NULL) {
+        vector_index_set_quantization(vs->vectors, vs->quantization);
+        vs->vectors_dirty = false;
+        return true;
+    }
+
+    VectorIndex *vectors = vector_index_create(CLIP_EMBEDDING_DIMENSION);
+    sqlite3_stmt *stmt;
+    if (vectors == NULL || sqlite3_prepare_v2(vs->db, SQL_GET_IMAGE_VECTORS, -1, &stmt, NULL) != SQLITE_OK) {
+        vector_index_destroy(vectors);
+        return false;
+    }
+
+    bool ok = true;
+    while (ok && sqlite3_step(stmt) == SQLITE_ROW) {
+        const void *blob = sqlite3_column_blob(stmt, 1);
+        if (blob == NULL || sqlite3_column_bytes(stmt, 1) != (int)(CLIP_EMBEDDING_DIMENSION * sizeof(float))) {
+            continue;
+        }
+
+        float embedding[CLIP_EMBEDDING_DIMENSION];
+        memcpy(embedding, blob, sizeof(embedding));
+        ok = vector_index_append(vectors, sqlite3_column_int64(stmt, 0), embedding);
+    }
+    sqlite3_finalize(stmt);
+
+    if (!ok) {
+        vector_index_destroy(vectors);
+        return false;
+    }
+
+    vector_index_set_quantization(vectors, vs->quantization);
+    vs->vectors = vectors;
+    vs->vectors_dirty = true;
+    return true;
+}
+
+static void finalize_statements(VisualSearch *vs)
+{
+    sqlite3_stmt **statements[] = {
+        &vs->stmt_insert, &vs->stmt_is_indexed, &vs->stmt_get_rowid, &vs->stmt_get_by_rowid
+    };
+    for (size_t i = 0; i < sizeof(statements) / sizeof(statements[0]); i++) {
+        sqlite3_finalize(*statements[i]);
+        *statements[i] = NULL;
+    }
+}
+
+static void free_entries(VisualSearch *vs)
+{
+    for (int i = 0; i < vs->entry_count; i++) {
+        free(vs->entries[i].path);
     }
+    free(vs->entries);
+    vs->entries = NULL;
+    vs->entry_count = 0;
+    vs->entry_capacity = 0;
+    vs->entries_loaded = false;
+}
+
+// Helper: remember the path of a new resident embedding (no-op until paths are loaded)
+static void add_entry(VisualSearch *vs, int64_t rowid, const char *path)
+{
+    if (!vs->entries_loaded) {
+        return;
+    }
+
+    if (vs->entry_count == vs->entry_capacity) {
+        int capacity = vs->entry_capacity > 0 ? vs->entry_capacity * 2 : 1024;
+        ImageEntry *grown = realloc(vs->entries, (size_t)capacity * sizeof(ImageEntry));
+        if (grown == NULL) {
+            free_entries(vs);
+            return;
+        }
+        vs->entries = grown;
+        vs->entry_capacity = capacity;
+    }
+
+    char *copy = strdup(path);
+    if (copy == NULL) {
+        free_entries(vs);
+        return;
+    }
+
+    vs->entries[vs->entry_count].path = copy;
+    vs->entries[vs->entry_count].rowid = rowid;
+    vs->entry_count++;
+    vs->entries_sorted = false;
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+    return strcasecmp(((const ImageEntry *)a)->path, ((const ImageEntry *)b)->path);
+}
+
+// Helper: make the sorted path list available (vectors loaded)
+static bool load_entries(VisualSearch *vs)
+{
+    if (!vs->entries_loaded) {
+        sqlite3_stmt *stmt;
+        if (sqlite3_prepare_v2(vs->db, SQL_GET_IMAGE_PATHS, -1, &stmt, NULL) != SQLITE_OK) {
+            return false;
+        }
+        vs->entries_loaded = true;
+        while (vs->entries_loaded && sqlite3_step(stmt) == SQLITE_ROW) {
+            const char *path = (const char *)sqlite3_column_text(stmt, 1);
+            if (path != NULL) {
+                add_entry(vs, sqlite3_column_int64(stmt, 0), path);
+            }
+        }
+        sqlite3_finalize(stmt);
+
+        if (!vs->entries_loaded) {
+            return false;
+        }
+    }
+
+    if (!vs->entries_sorted) {
+        int kept = 0;
+        for (int i = 0; i < vs->entry_count; i++) {
+            if (vector_index_get(vs->vectors, vs->entries[i].rowid) == NULL) {
+                free(vs->entries[i].path);
+            } else {
+                vs->entries[kept++] = vs->entries[i];
+            }
+        }
+        vs->entry_count = kept;
+        qsort(vs->entries, (size_t)vs->entry_count, sizeof(ImageEntry), compare_entries);
+        vs->entries_sorted = true;
+    }
+    return true;
+}
+
+// Helper: link part of any backlog into the graph
+static void build_vectors(VisualSearch *vs)
+{
+    if (vector_index_build(vs->vectors, 0) > 0) {
+        vector_index_build(vs->vectors, VISUAL_GRAPH_BUILD_BUDGET);
+        vs->vectors_dirty = true;
+    }
+}
+
+// Helper: hydrate hits (best first) into results, skipping exclude_path and hits below
+// min_score, up to max_results when that is set
+static void fill_results(VisualSearch *vs, const VectorIndexHit *hits, int hit_count, const char *exclude_path,
+                         const VisualSearchOptions *opts, VisualSearchResults *results)
+{
+    sqlite3_stmt *stmt = vs->stmt_get_by_rowid;
+    if (stmt == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < hit_count && results->count < results->capacity; i++) {
+        if (hits[i].score < opts->min_score) {
+            break;
+        }
+
+        sqlite3_reset(stmt);
+        sqlite3_bind_int64(stmt, 1, hits[i].label);
+        if (sqlite3_step(stmt) != SQLITE_ROW) {
+            continue;
+        }
+
+        const char *path = (const char *)sqlite3_column_text(stmt, 0);
+        const char *name = (const char *)sqlite3_column_text(stmt, 1);
+        if (path == NULL || (exclude_path != NULL && strcmp(path, exclude_path) == 0)) {
+            continue;
+        }
+
+        VisualSearchResult *r = &results->results[results->count++];
+        strncpy(r->path, path, sizeof(r->path) - 1);
+        if (name != NULL) {
+            strncpy(r->name, name, sizeof(r->name) - 1);
+        }
+        r->score = hits[i].score;
+        r->width = sqlite3_column_int(stmt, 2);
+        r->height = sqlite3_column_int(stmt, 3);
+        r->size = sqlite3_column_int64(stmt, 4);
+    }
+
+    sqlite3_reset(stmt);
+}
+
+// Helper: room for max_results of hit_count hits (all of them when max_results is 0)
+static bool alloc_results(const VisualSearchOptions *opts, int hit_count, VisualSearchResults *results)
+{
+    int capacity = opts->max_results > 0 && opts->max_results < hit_count ? opts->max_results : hit_count;
+    results->results = calloc((size_t)(capacity > 0 ? capacity : 1), sizeof(VisualSearchResult));
+    results->capacity = capacity;
+    return results->results != NULL;
+}
+
+// Helper: top matches for a unit query from the resident vectors (best first)
+static bool search_vectors(VisualSearch *vs, const float *query, const char *exclude_path,
+                           const VisualSearchOptions *opts, VisualSearchResults *results)
+{
+    build_vectors(vs);
+
+    // One extra hit leaves room for skipping the query image itself
+    int k = opts->max_results + (exclude_path != NULL ? 1 : 0);
+    VectorIndexHit *hits = malloc((size_t)k * sizeof(VectorIndexHit));
+    if (hits == NULL) {
+        return false;
+    }
+
+    int hit_count = vector_index_search(vs->vectors, query, k, opts->ef_search, hits);
+    if (!alloc_results(opts, hit_count, results)) {
+        free(hits);
+        return false;
+    }
+    fill_results(vs, hits, hit_count, exclude_path, opts, results);
+
+    free(hits);
+    return true;
+}
+
+// Min-heap on score, so the weakest kept hit is at the root
+static void hit_sift_down(VectorIndexHit *heap, int count, int i)
+{
+    while (true) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = 2 * i + 2;
+        if (left < count && heap[left].score < heap[smallest].score) smallest = left;
+        if (right < count && heap[right].score < heap[smallest].score) smallest = right;
+        if (smallest == i) {
+            return;
+        }
+        VectorIndexHit tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void hit_sift_up(VectorIndexHit *heap, int i)
+{
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap[parent].score <= heap[i].score) {
+            return;
+        }
+        VectorIndexHit tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+static int compare_hits_desc(const void *a, const void *b)
+{
+    float sa = ((const VectorIndexHit *)a)->score;
+    float sb = ((const VectorIndexHit *)b)->score;
+    return (sa < sb) - (sa > sb);
+}
+
+// Best hits of an exact scan. Bounded queries keep a min-heap of the top limit;
+// unlimited ones keep every hit above min_score
+typedef struct HitCollector {
+    VectorIndexHit *hits;
+    int count;
+    int capacity;
+    int limit;          // 0 = unbounded
+    float min_score;
+} HitCollector;
+
+static bool collector_init(HitCollector *collector, const char *exclude_path, const VisualSearchOptions *opts)
+{
+    // One extra hit leaves room for skipping the query image itself
+    collector->limit = opts->max_results > 0 ? opts->max_results + (exclude_path != NULL ? 1 : 0) : 0;
+    collector->capacity = collector->limit > 0 ? collector->limit : 256;
+    collector->count = 0;
+    collector->min_score = opts->min_score;
+    collector->hits = malloc((size_t)collector->capacity * sizeof(VectorIndexHit));
+    return collector->hits != NULL;
+}
+
+static void collector_add(HitCollector *collector, int64_t label, float score)
+{
+    if (score < collector->min_score) {
+        return;
+    }
+
+    VectorIndexHit hit = {label, score};
+    if (collector->limit > 0) {
+        if (collector->count < collector->limit) {
+            collector->hits[collector->count] = hit;
+            hit_sift_up(collector->hits, collector->count++);
+        } else if (score > collector->hits[0].score) {
+            collector->hits[0] = hit;
+            hit_sift_down(collector->hits, collector->count, 0);
+        }
+        return;
+    }
+
+    if (collector->count == collector->capacity) {
+        VectorIndexHit *grown = realloc(collector->hits, (size_t)collector->capacity * 2 * sizeof(VectorIndexHit));
+        if (grown == NULL) {
+            return;
+        }
+        collector->hits = grown;
+        collector->capacity *= 2;
+    }
+    collector->hits[collector->count++] = hit;
+}
+
+// Helper: rank the collected hits and read only those back in full
+static bool collector_finish(VisualSearch *vs, HitCollector *collector, const char *exclude_path,
+                             const VisualSearchOptions *opts, VisualSearchResults *results)
+{
+    qsort(collector->hits, (size_t)collector->count, sizeof(VectorIndexHit), compare_hits_desc);
+    bool ok = alloc_results(opts, collector->count, results);
+    if (ok) {
+        fill_results(vs, collector->hits, collector->count, exclude_path, opts, results);
+    }
+    free(collector->hits);
+    collector->hits = NULL;
+    return ok;
+}
+
+// Helper: exact scan of the resident vectors, over one directory's range of the sorted
+// paths (a prefix match, like LIKE 'dir%') or all of them
+static bool scan_vectors(VisualSearch *vs, const float *query, const char *exclude_path,
+                         const VisualSearchOptions *opts, VisualSearchResults *results)
+{
+    if (!load_entries(vs)) {
+        return false;
+    }
+
+    HitCollector collector;
+    if (!collector_init(&collector, exclude_path, opts)) {
+        return false;
+    }
+
+    int lo = 0;
+    size_t prefix_length = 0;
+    if (opts->directory != NULL) {
+        prefix_length = strlen(opts->directory);
+        int hi = vs->entry_count;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (strcasecmp(vs->entries[mid].path, opts->directory) < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+    }
+
+    for (int i = lo; i < vs->entry_count; i++) {
+        if (prefix_length > 0 && strncasecmp(vs->entries[i].path, opts->directory, prefix_length) != 0) {
+            break;
+        }
+        const float *vector = vector_index_get(vs->vectors, vs->entries[i].rowid);
+        if (vector != NULL) {
+            collector_add(&collector, vs->entries[i].rowid, vector_dot(vector, query, CLIP_EMBEDDING_DIMENSION));
+        }
+    }
+
+    return collector_finish(vs, &collector, exclude_path, opts, results);
+}
+
+// Helper: exact scan of the image table (optionally one directory), for when the
+// resident vectors cannot be loaded
+static bool scan_images(VisualSearch *vs, const float *query, const char *exclude_path,
+                        const VisualSearchOptions *opts, VisualSearchResults *results)
+{
+    sqlite3_stmt *stmt;
+    const char *sql = (opts->directory != NULL) ? SQL_GET_IMAGE_EMBEDDINGS_IN_DIR : SQL_GET_ALL_IMAGE_EMBEDDINGS;
+    if (sqlite3_prepare_v2(vs->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
+    }
+    if (opts->directory != NULL) {
+        sqlite3_bind_text(stmt, 1, opts->directory, -1, SQLITE_STATIC);
+    }
+
+    HitCollector collector;
+    if (!collector_init(&collector, exclude_path, opts)) {
+        sqlite3_finalize(stmt);
+        return false;
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const void *blob = sqlite3_column_blob(stmt, 1);
+        if (blob == NULL || sqlite3_column_bytes(stmt, 1) != (int)(CLIP_EMBEDDING_DIMENSION * sizeof(float))) {
+            continue;
+        }
+
+        // Stored embeddings are unit length, so cosine is a dot product
+        collector_add(&collector, sqlite3_column_int64(stmt, 0),
+                      vector_dot((const float *)blob, query, CLIP_EMBEDDING_DIMENSION));
+    }
+    sqlite3_finalize(stmt);
+
+    return collector_finish(vs, &collector, exclude_path, opts, results);
+}
+
+// Helper: top matches for a unit query: ANN for library-wide top K, exact over the
+// resident vectors for directory-scoped or unlimited queries, and the table only as
+// a fallback when the vectors cannot be held in memory
+static bool search_images(VisualSearch *vs, const float *query, const char *exclude_path,
+                          const VisualSearchOptions *opts, VisualSearchResults *results)
+{
+    if (ensure_vectors(vs)) {
+        if (opts->directory == NULL && opts->max_results > 0) {
+            return search_vectors(vs, query, exclude_path, opts, results);
+        }
+        if (scan_vectors(vs, query, exclude_path, opts, results)) {
+            return true;
+        }
+        visual_search_results_free(results);
+    }
+    return scan_images(vs, query, exclude_path, opts, results);
 }
 
 static bool init_image_table(VisualSearch *vs)
@@ -116,7 +687,8 @@ VisualSearchOptions visual_search_default_options(void)
     VisualSearchOptions options = {
         .max_results = 20,
         .min_score = 0.0f,
-        .directory = NULL
+        .directory = NULL,
+        .ef_search = VECTOR_INDEX_DEFAULT_EF
     };
     return options;
 }
@@ -137,16 +709,6 @@ static float get_time_ms(void)
 }
 
 // Comparison function for sorting by score (descending)
-static int compare_results_by_score(const void *a, const void *b)
-{
-    const VisualSearchResult *ra = (const VisualSearchResult *)a;
-    const VisualSearchResult *rb = (const VisualSearchResult *)b;
-
-    if (rb->score > ra->score) return 1;
-    if (rb->score < ra->score) return -1;
-    return 0;
-}
-
 VisualSearchResults visual_search_query(VisualSearch *vs,
                                          const char *query,
                                          const VisualSearchOptions *options)
@@ -159,7 +721,7 @@ VisualSearchResults visual_search_query(VisualSearch *vs,
         return create_error_result("No CLIP engine set");
     }
 
-    if (!clip_engine_is_loaded(vs->clip_engine)) {
+    if (!clip_engine_is_available(vs->clip_engine)) {
         return create_error_result("CLIP model not loaded");
     }
 
@@ -181,98 +743,21 @@ VisualSearchResults visual_search_query(VisualSearch *vs,
 
     float start_time = get_time_ms();
 
-    // Generate text embedding
-    CLIPTextResult text_result = clip_embed_text(vs->clip_engine, query);
-    if (text_result.status != CLIP_STATUS_OK) {
-        return create_error_result(clip_status_message(text_result.status));
-    }
-
-    // Query images from database
-    sqlite3_stmt *stmt;
-    const char *sql = (opts.directory != NULL) ? SQL_GET_IMAGES_IN_DIR : SQL_GET_ALL_IMAGES;
-
-    int rc = sqlite3_prepare_v2(vs->db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        return create_error_result("Database query error");
-    }
-
-    if (opts.directory != NULL) {
-        sqlite3_bind_text(stmt, 1, opts.directory, -1, SQLITE_STATIC);
-    }
-
-    // Allocate results array
-    int capacity = opts.max_results > 0 ? opts.max_results * 2 : 100;
-    VisualSearchResults results = {0};
-    results.results = calloc((size_t)capacity, sizeof(VisualSearchResult));
-    if (results.results == NULL) {
-        sqlite3_finalize(stmt);
-        return create_error_result("Memory allocation error");
-    }
-    results.capacity = capacity;
-
-    // Iterate through images and compute similarities
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        const char *path = (const char *)sqlite3_column_text(stmt, 0);
-        const char *name = (const char *)sqlite3_column_text(stmt, 1);
-        const void *embedding_blob = sqlite3_column_blob(stmt, 2);
-        int blob_size = sqlite3_column_bytes(stmt, 2);
-        int width = sqlite3_column_int(stmt, 3);
-        int height = sqlite3_column_int(stmt, 4);
-        int64_t size = sqlite3_column_int64(stmt, 5);
-
-        if (path == NULL || embedding_blob == NULL) {
-            continue;
+    // Text embedding, from the cache when typed before or prefetched
+    float embedding[CLIP_EMBEDDING_DIMENSION];
+    if (!query_cache_encode(vs->queries, query, embedding)) {
+        // No cache, or encoding failed: encode directly, which also says why
+        CLIPTextResult text_result = clip_embed_text(vs->clip_engine, query);
+        if (text_result.status != CLIP_STATUS_OK) {
+            return create_error_result(clip_status_message(text_result.status));
         }
-
-        // Deserialize embedding
-        if (blob_size != (int)(CLIP_EMBEDDING_DIMENSION * sizeof(float))) {
-            continue;
-        }
-
-        const float *img_embedding = (const float *)embedding_blob;
-
-        // Compute similarity
-        float score = clip_similarity(img_embedding, text_result.embedding);
-
-        // Filter by minimum score
-        if (score < opts.min_score) {
-            continue;
-        }
-
-        // Add to results
-        if (results.count >= results.capacity) {
-            // Expand capacity
-            int new_capacity = results.capacity * 2;
-            VisualSearchResult *new_results = realloc(results.results,
-                                                       (size_t)new_capacity * sizeof(VisualSearchResult));
-            if (new_results == NULL) {
-                break;
-            }
-            results.results = new_results;
-            results.capacity = new_capacity;
-        }
-
-        VisualSearchResult *r = &results.results[results.count];
-        strncpy(r->path, path, sizeof(r->path) - 1);
-        strncpy(r->name, name, sizeof(r->name) - 1);
-        r->score = score;
-        r->width = width;
-        r->height = height;
-        r->size = size;
-        results.count++;
+        vector_normalize(text_result.embedding, CLIP_EMBEDDING_DIMENSION);
+        memcpy(embedding, text_result.embedding, sizeof(embedding));
     }
 
-    sqlite3_finalize(stmt);
-
-    // Sort by score
-    if (results.count > 1) {
-        qsort(results.results, (size_t)results.count, sizeof(VisualSearchResult),
-              compare_results_by_score);
-    }
-
-    // Limit to max_results
-    if (opts.max_results > 0 && results.count > opts.max_results) {
-        results.count = opts.max_results;
+    VisualSearchResults results = {0};
+    if (!search_images(vs, embedding, NULL, &opts, &results)) {
+        return create_error_result("Database query error");
     }
 
     strncpy(results.query, query, sizeof(results.query) - 1);
@@ -282,6 +767,19 @@ VisualSearchResults visual_search_query(VisualSearch *vs,
     return results;
 }
 
+void visual_search_prefetch(VisualSearch *vs, const char *query)
+{
+    if (vs == NULL || vs->clip_engine == NULL || !clip_engine_is_available(vs->clip_engine)) {
+        return;
+    }
+    query_cache_prefetch(vs->queries, query);
+}
+
+bool visual_search_is_prefetched(VisualSearch *vs, const char *query)
+{
+    return vs != NULL && query_cache_contains(vs->queries, query);
+}
+
 VisualSearchResults visual_search_similar(VisualSearch *vs,
                                            const char *image_path,
                                            const VisualSearchOptions *options)
@@ -290,7 +788,7 @@ VisualSearchResults visual_search_similar(VisualSearch *vs,
         return create_error_result("Visual search not initialized");
     }
 
-    if (vs->clip_engine == NULL || !clip_engine_is_loaded(vs->clip_engine)) {
+    if (vs->clip_engine == NULL || !clip_engine_is_available(vs->clip_engine)) {
         return create_error_result("CLIP engine not ready");
     }
 
@@ -303,6 +801,7 @@ VisualSearchResults visual_search_similar(VisualSearch *vs,
     if (img_result.status != CLIP_STATUS_OK) {
         return create_error_result(clip_status_message(img_result.status));
     }
+    vector_normalize(img_result.embedding, CLIP_EMBEDDING_DIMENSION);
 
     // Use default options if not provided
     VisualSearchOptions opts;
@@ -314,116 +813,91 @@ VisualSearchResults visual_search_similar(VisualSearch *vs,
 
     float start_time = get_time_ms();
 
-    // Query all images from database
-    sqlite3_stmt *stmt;
-    const char *sql = (opts.directory != NULL) ? SQL_GET_IMAGES_IN_DIR : SQL_GET_ALL_IMAGES;
-
-    int rc = sqlite3_prepare_v2(vs->db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
+    VisualSearchResults results = {0};
+    if (!search_images(vs, img_result.embedding, image_path, &opts, &results)) {
         return create_error_result("Database query error");
     }
 
-    if (opts.directory != NULL) {
-        sqlite3_bind_text(stmt, 1, opts.directory, -1, SQLITE_STATIC);
-    }
-
-    // Allocate results
-    int capacity = opts.max_results > 0 ? opts.max_results * 2 : 100;
-    VisualSearchResults results = {0};
-    results.results = calloc((size_t)capacity, sizeof(VisualSearchResult));
-    if (results.results == NULL) {
-        sqlite3_finalize(stmt);
-        return create_error_result("Memory allocation error");
-    }
-    results.capacity = capacity;
+    snprintf(results.query, sizeof(results.query), "similar:%s", path_basename(image_path));
+    results.search_time_ms = get_time_ms() - start_time;
+    results.success = true;
 
-    // Iterate and compute similarities
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        const char *path = (const char *)sqlite3_column_text(stmt, 0);
-        const char *name = (const char *)sqlite3_column_text(stmt, 1);
-        const void *embedding_blob = sqlite3_column_blob(stmt, 2);
-        int blob_size = sqlite3_column_bytes(stmt, 2);
-        int width = sqlite3_column_int(stmt, 3);
-        int height = sqlite3_column_int(stmt, 4);
-        int64_t size = sqlite3_column_int64(stmt, 5);
+    return results;
+}
 
-        if (path == NULL || embedding_blob == NULL) {
-            continue;
-        }
+// Helper: whether an image still needs indexing (not indexed at its current mtime)
+static bool needs_indexing(VisualSearch *vs, const char *image_path, const struct stat *st)
+{
+    sqlite3_stmt *stmt = vs->stmt_is_indexed;
+    if (stmt == NULL) {
+        return true;
+    }
 
-        // Skip the query image itself
-        if (strcmp(path, image_path) == 0) {
-            continue;
-        }
+    sqlite3_bind_text(stmt, 1, image_path, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)st->st_mtime);
+    bool indexed = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_reset(stmt);
+    return !indexed;
+}
 
-        if (blob_size != (int)(CLIP_EMBEDDING_DIMENSION * sizeof(float))) {
-            continue;
+// Helper: store an image's embedding (normalized in place) and its vector
+static bool store_image(VisualSearch *vs, const char *image_path, const struct stat *st,
+                        float *embedding, int width, int height)
+{
+    vector_normalize(embedding, CLIP_EMBEDDING_DIMENSION);
+
+    // INSERT OR REPLACE may give the path a new rowid, so find the old one first
+    int64_t old_rowid = -1;
+    if (ensure_vectors(vs) && vs->stmt_get_rowid != NULL) {
+        sqlite3_bind_text(vs->stmt_get_rowid, 1, image_path, -1, SQLITE_STATIC);
+        if (sqlite3_step(vs->stmt_get_rowid) == SQLITE_ROW) {
+            old_rowid = sqlite3_column_int64(vs->stmt_get_rowid, 0);
         }
+        sqlite3_reset(vs->stmt_get_rowid);
+    }
 
-        const float *db_embedding = (const float *)embedding_blob;
-        float score = clip_similarity(db_embedding, img_result.embedding);
+    // Insert into database
+    sqlite3_stmt *stmt = vs->stmt_insert;
+    if (stmt == NULL) {
+        return false;
+    }
 
-        if (score < opts.min_score) {
-            continue;
-        }
+    const char *name = path_basename(image_path);
 
-        // Add to results
-        if (results.count >= results.capacity) {
-            int new_capacity = results.capacity * 2;
-            VisualSearchResult *new_results = realloc(results.results,
-                                                       (size_t)new_capacity * sizeof(VisualSearchResult));
-            if (new_results == NULL) {
-                break;
+    sqlite3_bind_text(stmt, 1, image_path, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, name, -1, SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 3, embedding,
+                      (int)(CLIP_EMBEDDING_DIMENSION * sizeof(float)), SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 4, width);
+    sqlite3_bind_int(stmt, 5, height);
+    sqlite3_bind_int64(stmt, 6, (sqlite3_int64)st->st_size);
+    sqlite3_bind_int64(stmt, 7, (sqlite3_int64)st->st_mtime);
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+
+    if (rc == SQLITE_DONE && vs->vectors != NULL) {
+        int64_t rowid = sqlite3_last_insert_rowid(vs->db);
+        vector_index_remove(vs->vectors, old_rowid);
+        if (!vector_index_put(vs->vectors, rowid, embedding)) {
+            vector_index_destroy(vs->vectors);
+            vs->vectors = NULL;
+            free_entries(vs);
+        } else {
+            if (rowid != old_rowid) {
+                add_entry(vs, rowid, image_path);
             }
-            results.results = new_results;
-            results.capacity = new_capacity;
+            build_vectors(vs);
         }
-
-        VisualSearchResult *r = &results.results[results.count];
-        strncpy(r->path, path, sizeof(r->path) - 1);
-        strncpy(r->name, name, sizeof(r->name) - 1);
-        r->score = score;
-        r->width = width;
-        r->height = height;
-        r->size = size;
-        results.count++;
+        vs->vectors_dirty = true;
     }
 
-    sqlite3_finalize(stmt);
-
-    // Sort by score
-    if (results.count > 1) {
-        qsort(results.results, (size_t)results.count, sizeof(VisualSearchResult),
-              compare_results_by_score);
-    }
-
-    // Limit results
-    if (opts.max_results > 0 && results.count > opts.max_results) {
-        results.count = opts.max_results;
-    }
-
-    snprintf(results.query, sizeof(results.query), "similar:%s", path_basename(image_path));
-    results.search_time_ms = get_time_ms() - start_time;
-    results.success = true;
-
-    return results;
+    return rc == SQLITE_DONE;
 }
 
 bool visual_search_index_image(VisualSearch *vs, const char *image_path)
 {
-    if (vs == NULL || !vs->initialized) {
-        return false;
-    }
-
-    if (vs->clip_engine == NULL || !clip_engine_is_loaded(vs->clip_engine)) {
-        return false;
-    }
-
-    if (vs->db == NULL) {
-        return false;
-    }
-
-    if (image_path == NULL) {
+    if (!visual_search_is_ready(vs) || image_path == NULL) {
         return false;
     }
 
@@ -438,17 +912,8 @@ bool visual_search_index_image(VisualSearch *vs, const char *image_path)
     }
 
     // Check if already indexed with same modified time
-    sqlite3_stmt *check_stmt;
-    int rc = sqlite3_prepare_v2(vs->db, SQL_IS_IMAGE_INDEXED, -1, &check_stmt, NULL);
-    if (rc == SQLITE_OK) {
-        sqlite3_bind_text(check_stmt, 1, image_path, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(check_stmt, 2, (sqlite3_int64)st.st_mtime);
-
-        if (sqlite3_step(check_stmt) == SQLITE_ROW) {
-            sqlite3_finalize(check_stmt);
-            return true;  // Already indexed
-        }
-        sqlite3_finalize(check_stmt);
+    if (!needs_indexing(vs, image_path, &st)) {
+        return true;
     }
 
     // Generate embedding
@@ -456,43 +921,86 @@ bool visual_search_index_image(VisualSearch *vs, const char *image_path)
     if (img_result.status != CLIP_STATUS_OK) {
         return false;
     }
+    return store_image(vs, image_path, &st, img_result.embedding, img_result.width, img_result.height);
+}
 
-    // Insert into database
-    sqlite3_stmt *stmt;
-    rc = sqlite3_prepare_v2(vs->db, SQL_INSERT_IMAGE, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
+bool visual_search_index_embedding(VisualSearch *vs, const char *image_path, const float *embedding,
+                                   int width, int height, int64_t size, time_t modified_time)
+{
+    if (vs == NULL || !vs->initialized || vs->db == NULL || image_path == NULL || embedding == NULL) {
         return false;
     }
 
-    const char *name = path_basename(image_path);
-
-    sqlite3_bind_text(stmt, 1, image_path, -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, name, -1, SQLITE_STATIC);
-    sqlite3_bind_blob(stmt, 3, img_result.embedding,
-                      (int)(CLIP_EMBEDDING_DIMENSION * sizeof(float)), SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 4, img_result.width);
-    sqlite3_bind_int(stmt, 5, img_result.height);
-    sqlite3_bind_int64(stmt, 6, (sqlite3_int64)st.st_size);
-    sqlite3_bind_int64(stmt, 7, (sqlite3_int64)st.st_mtime);
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    st.st_size = (off_t)size;
+    st.st_mtime = modified_time;
+    float normalized[CLIP_EMBEDDING_DIMENSION];
+    memcpy(normalized, embedding, sizeof(normalized));
+    return store_image(vs, image_path, &st, normalized, width, height);
+}
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+int visual_search_build_index(VisualSearch *vs, int budget)
+{
+    if (vs == NULL || !vs->initialized || vs->db == NULL || !ensure_vectors(vs)) {
+        return 0;
+    }
 
-    return rc == SQLITE_DONE;
+    int before = vector_index_build(vs->vectors, 0);
+    int remaining = vector_index_build(vs->vectors, budget);
+    if (remaining != before) {
+        vs->vectors_dirty = true;
+    }
+    return remaining;
 }
 
-int visual_search_index_directory(VisualSearch *vs, const char *directory)
+// Images gathered before one batched embedding pass
+#define INDEX_BATCH_SIZE 32
+
+// Images found by a directory walk, waiting for a batch
+typedef struct IndexBatch {
+    char *paths[INDEX_BATCH_SIZE];
+    struct stat stats[INDEX_BATCH_SIZE];
+    int count;
+    int indexed;
+} IndexBatch;
+
+// Helper: embed and store every image gathered so far
+static void flush_batch(VisualSearch *vs, IndexBatch *batch)
 {
-    if (vs == NULL || directory == NULL) {
-        return 0;
+    if (batch->count == 0) {
+        return;
     }
 
+    CLIPBatchImageResult result = clip_embed_images_batch(vs->clip_engine, (const char **)batch->paths, batch->count);
+    if (result.status == CLIP_STATUS_OK) {
+        sqlite3_exec(vs->db, "BEGIN;", NULL, NULL, NULL);
+        for (int i = 0; i < batch->count; i++) {
+            if (result.statuses[i] == CLIP_STATUS_OK &&
+                store_image(vs, batch->paths[i], &batch->stats[i],
+                            &result.embeddings[(size_t)i * CLIP_EMBEDDING_DIMENSION],
+                            result.widths[i], result.heights[i])) {
+                batch->indexed++;
+            }
+        }
+        sqlite3_exec(vs->db, "COMMIT;", NULL, NULL, NULL);
+    }
+    clip_batch_result_free(&result);
+
+    for (int i = 0; i < batch->count; i++) {
+        free(batch->paths[i]);
+    }
+    batch->count = 0;
+}
+
+// Helper: walk a directory, batching images that need indexing
+static void gather_directory(VisualSearch *vs, const char *directory, IndexBatch *batch)
+{
     DIR *dir = opendir(directory);
     if (dir == NULL) {
-        return 0;
+        return;
     }
 
-    int count = 0;
     struct dirent *entry;
 
     while ((entry = readdir(dir)) != NULL) {
@@ -511,17 +1019,37 @@ int visual_search_index_directory(VisualSearch *vs, const char *directory)
 
         if (S_ISDIR(st.st_mode)) {
             // Recurse into subdirectory
-            count += visual_search_index_directory(vs, path);
-        } else if (S_ISREG(st.st_mode)) {
-            // Try to index if it's an image
-            if (visual_search_index_image(vs, path)) {
-                count++;
+            gather_directory(vs, path, batch);
+        } else if (S_ISREG(st.st_mode) && clip_is_supported_image(path)) {
+            if (!needs_indexing(vs, path, &st)) {
+                batch->indexed++;
+                continue;
+            }
+            char *copy = strdup(path);
+            if (copy == NULL) {
+                continue;
+            }
+            batch->paths[batch->count] = copy;
+            batch->stats[batch->count] = st;
+            if (++batch->count == INDEX_BATCH_SIZE) {
+                flush_batch(vs, batch);
             }
         }
     }
 
     closedir(dir);
-    return count;
+}
+
+int visual_search_index_directory(VisualSearch *vs, const char *directory)
+{
+    if (!visual_search_is_ready(vs) || directory == NULL) {
+        return 0;
+    }
+
+    IndexBatch batch = {0};
+    gather_directory(vs, directory, &batch);
+    flush_batch(vs, &batch);
+    return batch.indexed;
 }
 
 void visual_search_results_free(VisualSearchResults *results)
@@ -538,13 +1066,67 @@ void visual_search_results_free(VisualSearchResults *results)
     results->capacity = 0;
 }
 
+int visual_search_each_image(VisualSearch *vs, const char *directory, VisualSearchImageFn fn, void *context)
+{
+    if (vs == NULL || !vs->initialized || vs->db == NULL || directory == NULL || fn == NULL) {
+        return 0;
+    }
+
+    char low[4096];
+    size_t len = strlen(directory);
+    while (len > 0 && directory[len - 1] == '/') {
+        len--;
+    }
+    if (len + 2 > sizeof(low)) {
+        return 0;
+    }
+    memcpy(low, directory, len);
+    low[len] = '/';
+    low[len + 1] = '\0';
+    char high[4096];
+    memcpy(high, low, len + 2);
+    high[len] = '0';
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(vs->db, SQL_GET_IMAGES_UNDER, -1, &stmt, NULL) != SQLITE_OK) {
+        return 0;
+    }
+    sqlite3_bind_text(stmt, 1, low, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, high, -1, SQLITE_STATIC);
+
+    ImageIndexEntry *entry = malloc(sizeof(ImageIndexEntry));
+    int handed = 0;
+    while (entry != NULL && sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *path = (const char *)sqlite3_column_text(stmt, 0);
+        const void *blob = sqlite3_column_blob(stmt, 1);
+        if (path == NULL || blob == NULL ||
+            sqlite3_column_bytes(stmt, 1) != (int)(CLIP_EMBEDDING_DIMENSION * sizeof(float))) {
+            continue;
+        }
+        memset(entry, 0, sizeof(ImageIndexEntry));
+        strncpy(entry->path, path, sizeof(entry->path) - 1);
+        memcpy(entry->embedding, blob, sizeof(entry->embedding));
+        entry->width = sqlite3_column_int(stmt, 2);
+        entry->height = sqlite3_column_int(stmt, 3);
+        entry->size = sqlite3_column_int64(stmt, 4);
+        entry->modified_time = (time_t)sqlite3_column_int64(stmt, 5);
+        handed++;
+        if (!fn(entry, context)) {
+            break;
+        }
+    }
+    sqlite3_finalize(stmt);
+    free(entry);
+    return handed;
+}
+
 bool visual_search_is_ready(const VisualSearch *vs)
 {
     if (vs == NULL || !vs->initialized) {
         return false;
     }
 
-    if (vs->clip_engine == NULL || !clip_engine_is_loaded(vs->clip_engine)) {
+    if (vs->clip_engine == NULL || !clip_engine_is_available(vs->clip_engine)) {
         return false;
     }
 
@@ -566,6 +1148,7 @@ VisualSearchStats visual_search_get_stats(const VisualSearch *vs)
     if (vs->clip_engine != NULL) {
         stats.engine_loaded = clip_engine_is_loaded(vs->clip_engine);
     }
+    stats.index_memory = vector_index_memory(vs->vectors);
 
     if (vs->db != NULL) {
         sqlite3_stmt *stmt;
@@ -36,6 +36,7 @@ typedef struct VisualSearchOptions {
     int max_results;           // Maximum number of results (default: 20)
     float min_score;           // Minimum similarity score (default: 0.0)
     const char *directory;     // Limit search to this directory (NULL for all)
+    int ef_search;             // ANN recall/latency knob: higher = better recall (default: 64, 0 = exact)
 } VisualSearchOptions;
 
 // Image index entry
@@ -60,14 +61,25 @@ void visual_search_destroy(VisualSearch *vs);
 // Set the CLIP engine (required)
 void visual_search_set_clip_engine(VisualSearch *vs, CLIPEngine *engine);
 
-// Set the vector database (required)
+// Set the vector database (required). Statements stay prepared on it, so detach
+// (NULL) or destroy the visual search before closing the database
 void visual_search_set_vectordb(VisualSearch *vs, VectorDB *db);
 
+// Choose the compressed prefilter for exact scans of the image embeddings (default: int8)
+void visual_search_set_quantization(VisualSearch *vs, VectorQuantization quantization);
+
 // Search for images matching a text query
 VisualSearchResults visual_search_query(VisualSearch *vs,
                                          const char *query,
                                          const VisualSearchOptions *options);
 
+// Encode a text query in the background once typing pauses, so a following
+// visual_search_query for the same text skips the encoder
+void visual_search_prefetch(VisualSearch *vs, const char *query);
+
+// Whether the query's embedding is ready, so visual_search_query only searches
+bool visual_search_is_prefetched(VisualSearch *vs, const char *query);
+
 // Search for similar images given an image path
 VisualSearchResults visual_search_similar(VisualSearch *vs,
                                            const char *image_path,
@@ -79,6 +91,20 @@ bool visual_search_index_image(VisualSearch *vs, const char *image_path);
 // Index all images in a directory (recursive)
 int visual_search_index_directory(VisualSearch *vs, const char *directory);
 
+// Index an image whose embedding is already computed (stored normalized)
+bool visual_search_index_embedding(VisualSearch *vs, const char *image_path, const float *embedding,
+                                   int width, int height, int64_t size, time_t modified_time);
+
+// Link up to budget image embeddings into the ANN graph; returns how many are still unlinked
+int visual_search_build_index(VisualSearch *vs, int budget);
+
+// Receives each image visual_search_each_image reads; return false to stop
+typedef bool (*VisualSearchImageFn)(const ImageIndexEntry *image, void *context);
+
+// Hand every indexed image under directory to fn in path order; returns how many were
+// handed over
+int visual_search_each_image(VisualSearch *vs, const char *directory, VisualSearchImageFn fn, void *context);
+
 // Free search results
 void visual_search_results_free(VisualSearchResults *results);
 
@@ -93,6 +119,7 @@ typedef struct VisualSearchStats {
     int64_t total_images;
     int64_t indexed_images;
     bool engine_loaded;
+    size_t index_memory;    // Resident embeddings and their ANN graph, in bytes
 } VisualSearchStats;
 
 VisualSearchStats visual_search_get_stats(const VisualSearch *vs);
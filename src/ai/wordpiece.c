@@ -0,0 +1,418 @@
+#include "wordpiece.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// bert.cpp model files: magic, seven int32 hyperparameters starting with the vocabulary
+// size and sequence length, then each token as a uint32 length and its bytes
+#define GGML_MAGIC 0x67676d6c
+#define GGML_HPARAMS 7
+#define VOCAB_MAX (1 << 20)
+#define VOCAB_TOKEN_MAX 1024
+
+// Trie roots: pieces that start a word, and the "##" pieces that continue one
+#define TRIE_ROOT 0
+#define TRIE_CONTINUATION 1
+
+// Child of a node along one byte, in an open-addressed table (child 0 marks a free
+// slot; the root is no one's child)
+typedef struct TrieEdge {
+    uint32_t parent;
+    uint32_t child;
+    uint8_t byte;
+} TrieEdge;
+
+struct WordPiece {
+    int32_t *node_ids;          // Token ending at each node, -1 if none
+    uint32_t node_count;
+    TrieEdge *edges;
+    uint32_t edge_mask;         // Table size - 1 (a power of two)
+    int32_t cls_id;
+    int32_t sep_id;
+    int32_t unk_id;
+    int max_tokens;
+};
+
+// Tokenizing one text: the ids so far and the word being gathered
+typedef struct Tokenizing {
+    const WordPiece *wp;
+    int32_t *ids;
+    int count;
+    int limit;                  // Ids before the closing [SEP]
+    unsigned char word[WORDPIECE_MAX_WORD * 4];
+    int word_length;            // Bytes
+    int word_chars;
+    bool too_long;
+} Tokenizing;
+
+// Helper: slot of the edge from parent along byte, or of the free slot it would take
+static uint32_t edge_slot(const WordPiece *wp, uint32_t parent, uint8_t byte)
+{
+    uint32_t h = parent * 0x9E3779B1u + byte * 0x85EBCA77u;
+    uint32_t slot = (h ^ (h >> 15)) & wp->edge_mask;
+    while (wp->edges[slot].child != 0 &&
+           (wp->edges[slot].parent != parent || wp->edges[slot].byte != byte)) {
+        slot = (slot + 1) & wp->edge_mask;
+    }
+    return slot;
+}
+
+// Helper: add a token under root; an earlier token with the same text keeps its id
+static void trie_insert(WordPiece *wp, uint32_t root, const char *text, int32_t id)
+{
+    uint32_t node = root;
+    for (const unsigned char *p = (const unsigned char *)text; *p != '\0'; p++) {
+        uint32_t slot = edge_slot(wp, node, *p);
+        if (wp->edges[slot].child == 0) {
+            wp->edges[slot].parent = node;
+            wp->edges[slot].byte = *p;
+            wp->edges[slot].child = wp->node_count;
+            wp->node_ids[wp->node_count++] = -1;
+        }
+        node = wp->edges[slot].child;
+    }
+    if (node != root && wp->node_ids[node] < 0) {
+        wp->node_ids[node] = id;
+    }
+}
+
+// Helper: id of the token with this exact text, or fallback
+static int32_t special_id(const WordPiece *wp, const char *text, int32_t fallback)
+{
+    uint32_t node = TRIE_ROOT;
+    for (const unsigned char *p = (const unsigned char *)text; *p != '\0'; p++) {
+        uint32_t slot = edge_slot(wp, node, *p);
+        if (wp->edges[slot].child == 0) {
+            return fallback;
+        }
+        node = wp->edges[slot].child;
+    }
+    return wp->node_ids[node] >= 0 ? wp->node_ids[node] : fallback;
+}
+
+WordPiece* wordpiece_create(const char *const *tokens, int count, int max_tokens)
+{
+    if (tokens == NULL || count <= 0 || max_tokens < 2) {
+        return NULL;
+    }
+
+    // Every byte may need its own node and edge
+    size_t bytes = 0;
+    for (int i = 0; i < count; i++) {
+        bytes += tokens[i] != NULL ? strlen(tokens[i]) : 0;
+    }
+    uint32_t edge_capacity = 16;
+    while (edge_capacity < 2 * bytes) {
+        edge_capacity *= 2;
+    }
+
+    WordPiece *wp = calloc(1, sizeof(WordPiece));
+    if (wp == NULL) {
+        return NULL;
+    }
+    wp->node_ids = malloc((bytes + 2) * sizeof(int32_t));
+    wp->edges = calloc(edge_capacity, sizeof(TrieEdge));
+    if (wp->node_ids == NULL || wp->edges == NULL) {
+        wordpiece_destroy(wp);
+        return NULL;
+    }
+    wp->edge_mask = edge_capacity - 1;
+    wp->node_ids[TRIE_ROOT] = -1;
+    wp->node_ids[TRIE_CONTINUATION] = -1;
+    wp->node_count = 2;
+    wp->max_tokens = max_tokens;
+
+    for (int i = 0; i < count; i++) {
+        const char *token = tokens[i];
+        if (token == NULL || token[0] == '\0') {
+            continue;
+        }
+        if (token[0] == '#' && token[1] == '#' && token[2] != '\0') {
+            trie_insert(wp, TRIE_CONTINUATION, token + 2, i);
+        } else {
+            trie_insert(wp, TRIE_ROOT, token, i);
+        }
+    }
+
+    // The ids BERT vocabularies give them, should the vocabulary lack the names
+    wp->unk_id = special_id(wp, "[UNK]", 100);
+    wp->cls_id = special_id(wp, "[CLS]", 101);
+    wp->sep_id = special_id(wp, "[SEP]", 102);
+    return wp;
+}
+
+WordPiece* wordpiece_load(const char *model_path)
+{
+    if (model_path == NULL) {
+        return NULL;
+    }
+    FILE *file = fopen(model_path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    uint32_t magic = 0;
+    int32_t hparams[GGML_HPARAMS] = {0};
+    if (fread(&magic, sizeof(magic), 1, file) != 1 || magic != GGML_MAGIC ||
+        fread(hparams, sizeof(hparams), 1, file) != 1 ||
+        hparams[0] <= 0 || hparams[0] > VOCAB_MAX || hparams[1] < 2) {
+        fclose(file);
+        return NULL;
+    }
+    int count = hparams[0];
+
+    // Tokens are read into one buffer, each NUL-terminated
+    char **tokens = malloc((size_t)count * sizeof(char *));
+    size_t *offsets = malloc((size_t)count * sizeof(size_t));
+    size_t capacity = (size_t)count * 8;
+    char *text = malloc(capacity);
+    size_t used = 0;
+    bool ok = tokens != NULL && offsets != NULL && text != NULL;
+
+    for (int i = 0; ok && i < count; i++) {
+        uint32_t length = 0;
+        ok = fread(&length, sizeof(length), 1, file) == 1 && length <= VOCAB_TOKEN_MAX;
+        if (ok && used + length + 1 > capacity) {
+            capacity = (used + length + 1) * 2;
+            char *grown = realloc(text, capacity);
+            ok = grown != NULL;
+            text = ok ? grown : text;
+        }
+        ok = ok && (length == 0 || fread(text + used, 1, length, file) == length);
+        if (ok) {
+            offsets[i] = used;
+            text[used + length] = '\0';
+            used += length + 1;
+        }
+    }
+    fclose(file);
+
+    WordPiece *wp = NULL;
+    if (ok) {
+        for (int i = 0; i < count; i++) {
+            tokens[i] = text + offsets[i];
+        }
+        wp = wordpiece_create((const char *const *)tokens, count, hparams[1]);
+    }
+    free(tokens);
+    free(offsets);
+    free(text);
+    return wp;
+}
+
+void wordpiece_destroy(WordPiece *wp)
+{
+    if (wp == NULL) {
+        return;
+    }
+    free(wp->node_ids);
+    free(wp->edges);
+    free(wp);
+}
+
+int wordpiece_max_tokens(const WordPiece *wp)
+{
+    return wp != NULL ? wp->max_tokens : 0;
+}
+
+// Helper: decode the UTF-8 character at text (0xFFFD for a malformed byte); returns
+// its length in bytes
+static int decode_utf8(const unsigned char *text, size_t length, uint32_t *cp)
+{
+    unsigned char c = text[0];
+    int extra = c < 0x80 ? 0 : (c & 0xE0) == 0xC0 ? 1 : (c & 0xF0) == 0xE0 ? 2 : (c & 0xF8) == 0xF0 ? 3 : -1;
+    if (extra < 0 || (size_t)extra >= length) {
+        *cp = extra == 0 ? c : 0xFFFD;
+        return 1;
+    }
+
+    uint32_t value = extra == 0 ? c : (uint32_t)(c & (0x3F >> extra));
+    for (int i = 1; i <= extra; i++) {
+        if ((text[i] & 0xC0) != 0x80) {
+            *cp = 0xFFFD;
+            return 1;
+        }
+        value = (value << 6) | (text[i] & 0x3F);
+    }
+    *cp = value;
+    return extra + 1;
+}
+
+static bool is_whitespace(uint32_t cp)
+{
+    return cp == ' ' || cp == '\t' || cp == '\n' || cp == '\r' || cp == 0xA0 || cp == 0x1680 ||
+           (cp >= 0x2000 && cp <= 0x200A) || cp == 0x2028 || cp == 0x2029 || cp == 0x202F ||
+           cp == 0x205F || cp == 0x3000;
+}
+
+// Dropped: control and format characters, and malformed bytes
+static bool is_control(uint32_t cp)
+{
+    return cp < 0x20 || (cp >= 0x7F && cp <= 0x9F) || cp == 0xAD || (cp >= 0x200B && cp <= 0x200F) ||
+           (cp >= 0x202A && cp <= 0x202E) || (cp >= 0x2060 && cp <= 0x2064) || cp == 0xFEFF || cp == 0xFFFD;
+}
+
+// All ASCII symbols, as BERT treats them, and the common Unicode punctuation
+static bool is_punctuation(uint32_t cp)
+{
+    if (cp < 0x80) {
+        return (cp >= 33 && cp <= 47) || (cp >= 58 && cp <= 64) || (cp >= 91 && cp <= 96) ||
+               (cp >= 123 && cp <= 126);
+    }
+    return cp == 0xA1 || cp == 0xA7 || cp == 0xAB || cp == 0xB6 || cp == 0xB7 || cp == 0xBB || cp == 0xBF ||
+           (cp >= 0x2010 && cp <= 0x2027) || (cp >= 0x2030 && cp <= 0x205E) ||
+           (cp >= 0x3001 && cp <= 0x3003) || (cp >= 0x3008 && cp <= 0x3011) || (cp >= 0x3014 && cp <= 0x301F) ||
+           (cp >= 0xFF01 && cp <= 0xFF0F) || (cp >= 0xFF1A && cp <= 0xFF20) ||
+           (cp >= 0xFF3B && cp <= 0xFF40) || (cp >= 0xFF5B && cp <= 0xFF65);
+}
+
+// CJK ideographs are tokenized one by one
+static bool is_cjk(uint32_t cp)
+{
+    return (cp >= 0x4E00 && cp <= 0x9FFF) || (cp >= 0x3400 && cp <= 0x4DBF) || (cp >= 0xF900 && cp <= 0xFAFF) ||
+           (cp >= 0x20000 && cp <= 0x2CEAF) || (cp >= 0x2F800 && cp <= 0x2FA1F);
+}
+
+// Helper: lowercase a character and strip its accent (Latin-1 letters)
+static uint32_t fold_case(uint32_t cp)
+{
+    // Base letters of U+00E0..U+00FF; 0 keeps the character (æ, ð, ÷, ø, þ)
+    static const char latin1[32] = {
+        'a', 'a', 'a', 'a', 'a', 'a', 0, 'c', 'e', 'e', 'e', 'e', 'i', 'i', 'i', 'i',
+        0, 'n', 'o', 'o', 'o', 'o', 'o', 0, 0, 'u', 'u', 'u', 'u', 'y', 0, 'y'
+    };
+    if (cp >= 'A' && cp <= 'Z') {
+        return cp + 32;
+    }
+    if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) {
+        cp += 0x20;
+    }
+    if (cp >= 0xE0 && cp <= 0xFF && latin1[cp - 0xE0] != 0) {
+        return (uint32_t)latin1[cp - 0xE0];
+    }
+    return cp;
+}
+
+// Helper: add a character to the word being gathered
+static void append_char(Tokenizing *state, uint32_t cp)
+{
+    if (state->word_chars >= WORDPIECE_MAX_WORD) {
+        state->too_long = true;
+        return;
+    }
+
+    unsigned char *out = state->word + state->word_length;
+    if (cp < 0x80) {
+        out[0] = (unsigned char)cp;
+        state->word_length += 1;
+    } else if (cp < 0x800) {
+        out[0] = (unsigned char)(0xC0 | (cp >> 6));
+        out[1] = (unsigned char)(0x80 | (cp & 0x3F));
+        state->word_length += 2;
+    } else if (cp < 0x10000) {
+        out[0] = (unsigned char)(0xE0 | (cp >> 12));
+        out[1] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (unsigned char)(0x80 | (cp & 0x3F));
+        state->word_length += 3;
+    } else {
+        out[0] = (unsigned char)(0xF0 | (cp >> 18));
+        out[1] = (unsigned char)(0x80 | ((cp >> 12) & 0x3F));
+        out[2] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+        out[3] = (unsigned char)(0x80 | (cp & 0x3F));
+        state->word_length += 4;
+    }
+    state->word_chars++;
+}
+
+// Helper: split the gathered word into its longest pieces, or [UNK] if some part of
+// it matches none
+static void flush_word(Tokenizing *state)
+{
+    const WordPiece *wp = state->wp;
+    if (state->word_chars == 0) {
+        return;
+    }
+
+    int start = state->count;
+    bool unknown = state->too_long;
+    int pos = 0;
+    uint32_t root = TRIE_ROOT;
+    while (!unknown && pos < state->word_length && state->count < state->limit) {
+        // Walk the trie as far as the word goes, remembering the last token passed
+        int32_t id = -1;
+        int end = pos;
+        uint32_t node = root;
+        for (int i = pos; i < state->word_length; i++) {
+            uint32_t slot = edge_slot(wp, node, state->word[i]);
+            node = wp->edges[slot].child;
+            if (node == 0) {
+                break;
+            }
+            if (wp->node_ids[node] >= 0) {
+                id = wp->node_ids[node];
+                end = i + 1;
+            }
+        }
+        if (id < 0) {
+            unknown = true;
+            break;
+        }
+        state->ids[state->count++] = id;
+        pos = end;
+        root = TRIE_CONTINUATION;
+    }
+
+    if (unknown) {
+        state->count = start;
+        if (state->count < state->limit) {
+            state->ids[state->count++] = wp->unk_id;
+        }
+    }
+    state->word_length = 0;
+    state->word_chars = 0;
+    state->too_long = false;
+}
+
+int wordpiece_tokenize(const WordPiece *wp, const char *text, size_t length, int32_t *ids, int max_ids)
+{
+    if (wp == NULL || ids == NULL) {
+        return 0;
+    }
+    if (max_ids > wp->max_tokens) {
+        max_ids = wp->max_tokens;
+    }
+    if (max_ids < 2) {
+        return 0;
+    }
+
+    Tokenizing state;
+    state.wp = wp;
+    state.ids = ids;
+    state.count = 0;
+    state.limit = max_ids - 1;
+    state.word_length = 0;
+    state.word_chars = 0;
+    state.too_long = false;
+    ids[state.count++] = wp->cls_id;
+
+    const unsigned char *bytes = (const unsigned char *)text;
+    size_t pos = 0;
+    while (text != NULL && pos < length && state.count < state.limit) {
+        uint32_t cp;
+        pos += (size_t)decode_utf8(bytes + pos, length - pos, &cp);
+        if (is_whitespace(cp) || is_control(cp)) {
+            flush_word(&state);
+        } else if (is_punctuation(cp) || is_cjk(cp)) {
+            flush_word(&state);
+            append_char(&state, cp);
+            flush_word(&state);
+        } else {
+            append_char(&state, fold_case(cp));
+        }
+    }
+    flush_word(&state);
+
+    ids[state.count++] = wp->sep_id;
+    return state.count;
+}
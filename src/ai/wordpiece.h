@@ -0,0 +1,37 @@
+#ifndef WORDPIECE_H
+#define WORDPIECE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// WordPiece tokenizer for uncased BERT models, built from the vocabulary stored in the
+// model file itself. Text is lowercased, Latin accents are stripped, and it is split on
+// whitespace, punctuation and CJK characters as BERT's own tokenizer does. Each word is
+// then matched greedily, longest piece first, by walking a byte trie of the vocabulary.
+// A word that cannot be matched, or one longer than WORDPIECE_MAX_WORD characters,
+// becomes [UNK]. The tokenizer is read-only once built, so any number of threads may
+// share one
+
+// Characters in the longest word that is split into pieces
+#define WORDPIECE_MAX_WORD 100
+
+// Tokenizer context (opaque)
+typedef struct WordPiece WordPiece;
+
+// Build from the vocabulary of a bert.cpp (ggml) model file; NULL if it cannot be read
+WordPiece* wordpiece_load(const char *model_path);
+
+// Build from count tokens, token i getting id i ("##" starts a piece that continues a
+// word). max_tokens is the model's sequence length; NULL on allocation failure
+WordPiece* wordpiece_create(const char *const *tokens, int count, int max_tokens);
+
+void wordpiece_destroy(WordPiece *wp);
+
+// Sequence length of the model, the most ids a text is cut to
+int wordpiece_max_tokens(const WordPiece *wp);
+
+// Tokenize length bytes of UTF-8 text into at most max_ids ids (and at most the model's
+// sequence length), [CLS] first and [SEP] last. Returns the count
+int wordpiece_tokenize(const WordPiece *wp, const char *text, size_t length, int32_t *ids, int max_ids);
+
+#endif // WORDPIECE_H
@@ -0,0 +1,433 @@
+#include "api_scheduler.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Seconds covered by the local requests and tokens per minute count
+#define WINDOW_SECONDS 60
+
+// Longest a Retry-After or reset header may hold a provider back (seconds)
+#define MAX_HOLD_SECONDS 600.0
+
+// What the scheduler knows about one provider
+typedef struct ProviderState {
+    bool ready;
+    int concurrency;
+    int clean;                          // Clean responses since the window last changed
+    int throttle_streak;                // Throttled responses in a row
+    int in_flight;
+    int waiting[2];                     // By ApiPriority
+    double blocked_until;               // Monotonic seconds; nothing is sent before
+    int requests_limit;                 // Per minute, from headers (0: unknown)
+    int tokens_limit;
+    int requests_remaining;             // From headers, less what was sent since (-1: unknown)
+    int tokens_remaining;
+    double requests_reset;              // Monotonic seconds when the remaining counts refill
+    double tokens_reset;
+    long window_second[WINDOW_SECONDS]; // Per-second buckets of what this process sent
+    int window_requests[WINDOW_SECONDS];
+    int window_tokens[WINDOW_SECONDS];
+    int throttled;
+    int retries;
+} ProviderState;
+
+static struct {
+    pthread_mutex_t mutex;              // Guards everything below
+    pthread_cond_t changed;             // A slot was freed or a hold may have lifted
+    uint64_t seed;                      // Jitter
+    ProviderState providers[API_PROVIDER_COUNT];
+} g_sched = { .mutex = PTHREAD_MUTEX_INITIALIZER, .changed = PTHREAD_COND_INITIALIZER };
+
+// Prefix of each provider's rate-limit headers (NULL: it sends none)
+static const char *const RATE_LIMIT_PREFIX[API_PROVIDER_COUNT] = {
+    "anthropic-ratelimit-",
+    NULL
+};
+
+static double monotonic_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Helper: A provider's state, set up on first use (call with mutex held)
+static ProviderState *provider_state(ApiProvider provider)
+{
+    ProviderState *p = &g_sched.providers[provider];
+    if (!p->ready) {
+        memset(p, 0, sizeof(*p));
+        p->ready = true;
+        p->concurrency = API_SCHEDULER_START_CONCURRENCY;
+        p->requests_remaining = -1;
+        p->tokens_remaining = -1;
+    }
+    return p;
+}
+
+// Helper: Requests and tokens sent in the last minute
+static void window_totals(const ProviderState *p, long now_second, int *requests, int *tokens)
+{
+    *requests = 0;
+    *tokens = 0;
+    for (int i = 0; i < WINDOW_SECONDS; i++) {
+        if (p->window_second[i] > now_second - WINDOW_SECONDS) {
+            *requests += p->window_requests[i];
+            *tokens += p->window_tokens[i];
+        }
+    }
+}
+
+static void window_add(ProviderState *p, long now_second, int tokens)
+{
+    int slot = (int)(now_second % WINDOW_SECONDS);
+    if (p->window_second[slot] != now_second) {
+        p->window_second[slot] = now_second;
+        p->window_requests[slot] = 0;
+        p->window_tokens[slot] = 0;
+    }
+    p->window_requests[slot]++;
+    p->window_tokens[slot] += tokens;
+}
+
+// Helper: How long a request must wait before it may be sent: 0 to go now, a positive
+// number of seconds, or -1 to wait for a slot to be freed
+static double gate_wait(ProviderState *p, ApiPriority priority, int tokens, double now)
+{
+    bool background = priority == API_PRIORITY_BACKGROUND;
+
+    if (now < p->blocked_until) {
+        return p->blocked_until - now;
+    }
+
+    // The server's own counts, with a little kept back for interactive requests
+    if (p->requests_remaining >= 0 && now < p->requests_reset &&
+        p->requests_remaining <= (background ? 1 : 0)) {
+        return p->requests_reset - now;
+    }
+    if (p->tokens_remaining >= 0 && now < p->tokens_reset) {
+        int reserve = background ? p->tokens_limit / 10 : 0;
+        if (p->tokens_remaining - reserve < tokens) {
+            return p->tokens_reset - now;
+        }
+    }
+
+    // What this process sent in the last minute, against the limits the server named
+    int sent_requests, sent_tokens;
+    window_totals(p, (long)now, &sent_requests, &sent_tokens);
+    if (p->requests_limit > 0 && sent_requests >= p->requests_limit) {
+        return 1.0;
+    }
+    if (p->tokens_limit > 0 && sent_tokens > 0 && sent_tokens + tokens > p->tokens_limit) {
+        return 1.0;
+    }
+
+    if (background) {
+        int slots = p->concurrency > 1 ? p->concurrency - 1 : 1;
+        if (p->waiting[API_PRIORITY_INTERACTIVE] > 0 || p->in_flight >= slots) {
+            return -1;
+        }
+    } else if (p->in_flight >= p->concurrency) {
+        return -1;
+    }
+    return 0;
+}
+
+void api_scheduler_acquire(ApiProvider provider, ApiPriority priority, int tokens, ApiTicket *ticket)
+{
+    if (!ticket) return;
+    if (tokens < 1) tokens = 1;
+    ticket->provider = provider;
+    ticket->priority = priority;
+    ticket->tokens = tokens;
+
+    pthread_mutex_lock(&g_sched.mutex);
+    ProviderState *p = provider_state(provider);
+    p->waiting[priority]++;
+    for (;;) {
+        double now = monotonic_seconds();
+        double wait = gate_wait(p, priority, tokens, now);
+        if (wait == 0) break;
+        if (wait < 0) {
+            pthread_cond_wait(&g_sched.changed, &g_sched.mutex);
+            continue;
+        }
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        long long nanos = (long long)deadline.tv_nsec + (long long)(wait * 1e9);
+        deadline.tv_sec += (time_t)(nanos / 1000000000LL);
+        deadline.tv_nsec = (long)(nanos % 1000000000LL);
+        pthread_cond_timedwait(&g_sched.changed, &g_sched.mutex, &deadline);
+    }
+    p->waiting[priority]--;
+    p->in_flight++;
+    window_add(p, (long)monotonic_seconds(), tokens);
+
+    // Count the request against the server's budget until its answer brings new counts
+    if (p->requests_remaining > 0) p->requests_remaining--;
+    if (p->tokens_remaining > 0) {
+        p->tokens_remaining = p->tokens_remaining > tokens ? p->tokens_remaining - tokens : 0;
+    }
+
+    // A waiting interactive request may hold background ones back; let them look again
+    pthread_cond_broadcast(&g_sched.changed);
+    pthread_mutex_unlock(&g_sched.mutex);
+}
+
+// Helper: Days since 1970-01-01 of a proleptic Gregorian date (for UTC without timegm)
+static long days_from_civil(int y, int m, int d)
+{
+    y -= m <= 2;
+    long era = (y >= 0 ? y : y - 399) / 400;
+    long yoe = y - era * 400;
+    long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// Helper: Seconds from now until a reset header's time, given as an RFC 3339 UTC
+// timestamp or as seconds; -1 if unreadable
+static double parse_reset(const char *value)
+{
+    int y, mo, d, h, mi;
+    double s;
+    if (sscanf(value, "%d-%d-%dT%d:%d:%lf", &y, &mo, &d, &h, &mi, &s) == 6) {
+        double epoch = (double)days_from_civil(y, mo, d) * 86400.0 + h * 3600.0 + mi * 60.0 + s;
+        double in = epoch - (double)time(NULL);
+        return in > 0 ? in : 0;
+    }
+    char *end;
+    double seconds = strtod(value, &end);
+    return end != value && seconds >= 0 ? seconds : -1;
+}
+
+// Helper: Read a number header; false if absent
+static bool header_int(const HttpResponse *resp, const char *prefix, const char *name, int *out)
+{
+    char key[96];
+    char value[64];
+    snprintf(key, sizeof(key), "%s%s", prefix, name);
+    if (!http_response_header(resp, key, value, sizeof(value))) return false;
+    char *end;
+    long n = strtol(value, &end, 10);
+    if (end == value || n < 0) return false;
+    *out = n > INT32_MAX ? INT32_MAX : (int)n;
+    return true;
+}
+
+// Helper: Take in a response's rate-limit headers (call with mutex held)
+static void read_rate_limits(ProviderState *p, const char *prefix, const HttpResponse *resp, double now)
+{
+    char value[64];
+    char key[96];
+    double in;
+
+    header_int(resp, prefix, "requests-limit", &p->requests_limit);
+    if (header_int(resp, prefix, "requests-remaining", &p->requests_remaining)) {
+        snprintf(key, sizeof(key), "%srequests-reset", prefix);
+        in = http_response_header(resp, key, value, sizeof(value)) ? parse_reset(value) : -1;
+        p->requests_reset = now + (in >= 0 ? (in < WINDOW_SECONDS ? in : WINDOW_SECONDS) : WINDOW_SECONDS);
+    }
+
+    // Input and output tokens share one budget; older responses only split them
+    const char *tokens = "tokens-";
+    if (!header_int(resp, prefix, "tokens-remaining", &p->tokens_remaining)) {
+        tokens = "input-tokens-";
+        snprintf(key, sizeof(key), "%sremaining", tokens);
+        if (!header_int(resp, prefix, key, &p->tokens_remaining)) return;
+    }
+    snprintf(key, sizeof(key), "%slimit", tokens);
+    header_int(resp, prefix, key, &p->tokens_limit);
+    snprintf(key, sizeof(key), "%s%sreset", prefix, tokens);
+    in = http_response_header(resp, key, value, sizeof(value)) ? parse_reset(value) : -1;
+    p->tokens_reset = now + (in >= 0 ? (in < WINDOW_SECONDS ? in : WINDOW_SECONDS) : WINDOW_SECONDS);
+}
+
+// Helper: Jittered exponential backoff before the given retry (1 for the first), in
+// seconds: between half and all of the doubled base (call with mutex held)
+static double backoff_seconds(int retry)
+{
+    long delay = API_SCHEDULER_BACKOFF_MS;
+    for (int i = 1; i < retry && delay < API_SCHEDULER_MAX_BACKOFF_MS; i++) {
+        delay *= 2;
+    }
+    if (delay > API_SCHEDULER_MAX_BACKOFF_MS) delay = API_SCHEDULER_MAX_BACKOFF_MS;
+
+    // xorshift64, seeded from the clock on first use
+    if (g_sched.seed == 0) {
+        g_sched.seed = (uint64_t)(monotonic_seconds() * 1e9) | 1;
+    }
+    g_sched.seed ^= g_sched.seed << 13;
+    g_sched.seed ^= g_sched.seed >> 7;
+    g_sched.seed ^= g_sched.seed << 17;
+    long jittered = delay / 2 + (long)(g_sched.seed % (uint64_t)(delay / 2 + 1));
+    return (double)jittered / 1000.0;
+}
+
+// Helper: Whether a status means the provider is over its limits or overloaded
+static bool is_throttle(int status_code)
+{
+    return status_code == 429 || status_code == 503 || status_code == 529;
+}
+
+void api_scheduler_release(ApiTicket *ticket, const HttpResponse *resp)
+{
+    if (!ticket) return;
+
+    pthread_mutex_lock(&g_sched.mutex);
+    ProviderState *p = provider_state(ticket->provider);
+    double now = monotonic_seconds();
+    if (p->in_flight > 0) p->in_flight--;
+
+    if (resp && resp->status_code > 0) {
+        if (RATE_LIMIT_PREFIX[ticket->provider]) {
+            read_rate_limits(p, RATE_LIMIT_PREFIX[ticket->provider], resp, now);
+        }
+
+        if (is_throttle(resp->status_code)) {
+            // Halve the window and hold every request back for a while
+            p->throttled++;
+            p->throttle_streak++;
+            p->clean = 0;
+            p->concurrency = p->concurrency > 1 ? p->concurrency / 2 : 1;
+
+            char value[64];
+            double hold = -1;
+            if (http_response_header(resp, "retry-after", value, sizeof(value))) {
+                hold = parse_reset(value);
+            }
+            if (hold < 0) {
+                hold = backoff_seconds(p->throttle_streak);
+            }
+            if (hold > MAX_HOLD_SECONDS) hold = MAX_HOLD_SECONDS;
+            if (now + hold > p->blocked_until) {
+                p->blocked_until = now + hold;
+            }
+        } else if (resp->status_code >= 200 && resp->status_code < 300) {
+            // Grow by one after a window's worth of clean responses
+            p->throttle_streak = 0;
+            if (++p->clean >= p->concurrency) {
+                p->clean = 0;
+                if (p->concurrency < API_SCHEDULER_MAX_CONCURRENCY) p->concurrency++;
+            }
+        }
+    }
+
+    pthread_cond_broadcast(&g_sched.changed);
+    pthread_mutex_unlock(&g_sched.mutex);
+}
+
+bool api_scheduler_should_retry(int status_code)
+{
+    return is_throttle(status_code) || status_code == 500 || status_code == 502 || status_code == 504;
+}
+
+// A body handed on, noting whether any of it was
+typedef struct ScheduledSink {
+    HttpBodyFn on_body;
+    void *context;
+    bool fed;
+} ScheduledSink;
+
+static bool scheduled_body(void *context, const char *bytes, size_t len)
+{
+    ScheduledSink *sink = (ScheduledSink *)context;
+    sink->fed = true;
+    return sink->on_body(sink->context, bytes, len);
+}
+
+static void sleep_seconds(double seconds)
+{
+    struct timespec ts = { (time_t)seconds, (long)((seconds - (double)(time_t)seconds) * 1e9) };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+// Helper: Send req through the gate until it succeeds, fails for good, or runs out of
+// attempts
+static bool scheduled_perform(ApiProvider provider, ApiPriority priority, HttpClient *client,
+                              const HttpRequest *req, HttpBodyFn on_body, void *context, HttpResponse *resp)
+{
+    if (!client || !req || !resp) return false;
+    int tokens = (int)(req->body_len / API_SCHEDULER_BYTES_PER_TOKEN);
+
+    for (int attempt = 1; ; attempt++) {
+        ApiTicket ticket;
+        api_scheduler_acquire(provider, priority, tokens, &ticket);
+        ScheduledSink sink = { .on_body = on_body, .context = context, .fed = false };
+        bool success = on_body ? http_client_execute_sink(client, req, scheduled_body, &sink, resp)
+                               : http_client_execute(client, req, resp);
+        api_scheduler_release(&ticket, success ? resp : NULL);
+
+        // A body already handed over cannot be taken back
+        bool retry = attempt < API_SCHEDULER_MAX_ATTEMPTS && !sink.fed &&
+                     (!success || api_scheduler_should_retry(resp->status_code));
+        if (!retry) return success;
+
+        // Throttles already hold the provider back; other failures wait here
+        pthread_mutex_lock(&g_sched.mutex);
+        provider_state(provider)->retries++;
+        double wait = success && is_throttle(resp->status_code) ? 0 : backoff_seconds(attempt);
+        pthread_mutex_unlock(&g_sched.mutex);
+
+        http_response_cleanup(resp);
+        http_response_init(resp);
+        if (wait > 0) sleep_seconds(wait);
+    }
+}
+
+bool api_scheduler_execute(ApiProvider provider, ApiPriority priority, HttpClient *client,
+                           const HttpRequest *req, HttpResponse *resp)
+{
+    return scheduled_perform(provider, priority, client, req, NULL, NULL, resp);
+}
+
+bool api_scheduler_execute_sink(ApiProvider provider, ApiPriority priority, HttpClient *client,
+                                const HttpRequest *req, HttpBodyFn on_body, void *context,
+                                HttpResponse *resp)
+{
+    if (!on_body) return false;
+    return scheduled_perform(provider, priority, client, req, on_body, context, resp);
+}
+
+// Helper: adapt the SSE parser to a body feed
+static bool sse_body(void *context, const char *bytes, size_t len)
+{
+    return http_sse_feed((HttpSseParser *)context, bytes, len);
+}
+
+bool api_scheduler_execute_stream(ApiProvider provider, ApiPriority priority, HttpClient *client,
+                                  const HttpRequest *req, HttpSseParser *parser, HttpResponse *resp)
+{
+    if (!parser) return false;
+    return scheduled_perform(provider, priority, client, req, sse_body, parser, resp);
+}
+
+void api_scheduler_get_stats(ApiProvider provider, ApiSchedulerStats *stats)
+{
+    if (!stats) return;
+    pthread_mutex_lock(&g_sched.mutex);
+    ProviderState *p = provider_state(provider);
+    stats->concurrency = p->concurrency;
+    stats->in_flight = p->in_flight;
+    stats->waiting = p->waiting[API_PRIORITY_INTERACTIVE] + p->waiting[API_PRIORITY_BACKGROUND];
+    window_totals(p, (long)monotonic_seconds(), &stats->requests_last_minute, &stats->tokens_last_minute);
+    stats->requests_remaining = p->requests_remaining;
+    stats->tokens_remaining = p->tokens_remaining;
+    stats->throttled = p->throttled;
+    stats->retries = p->retries;
+    pthread_mutex_unlock(&g_sched.mutex);
+}
+
+void api_scheduler_reset(ApiProvider provider)
+{
+    pthread_mutex_lock(&g_sched.mutex);
+    g_sched.providers[provider].ready = false;
+    provider_state(provider);
+    pthread_cond_broadcast(&g_sched.changed);
+    pthread_mutex_unlock(&g_sched.mutex);
+}
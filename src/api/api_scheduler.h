@@ -0,0 +1,92 @@
+#ifndef API_SCHEDULER_H
+#define API_SCHEDULER_H
+
+#include "http_client.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Process-wide gate in front of http_client_execute for the AI providers. Each provider
+// has a concurrency window that grows by one after a window's worth of clean responses
+// and halves on a 429 or overload; the rate-limit headers (remaining requests and tokens,
+// and when they reset) and Retry-After hold new requests back before the server has to
+// refuse them. Failed requests that are safe to resend are retried with jittered
+// exponential backoff. Interactive requests go first: background ones wait while any
+// interactive request is waiting, and leave one slot and a little of the remaining
+// budget free for them
+
+// Most requests one provider runs at once, and where the window starts
+#define API_SCHEDULER_MAX_CONCURRENCY 16
+#define API_SCHEDULER_START_CONCURRENCY 4
+
+// Sends of one request before giving up (the first try and its retries)
+#define API_SCHEDULER_MAX_ATTEMPTS 4
+
+// Backoff before the first retry, doubling each time up to the cap (milliseconds)
+#define API_SCHEDULER_BACKOFF_MS 500
+#define API_SCHEDULER_MAX_BACKOFF_MS 30000
+
+// Request body bytes counted as one token when estimating a request's size
+#define API_SCHEDULER_BYTES_PER_TOKEN 4
+
+typedef enum ApiProvider {
+    API_PROVIDER_CLAUDE = 0,
+    API_PROVIDER_GEMINI,
+    API_PROVIDER_COUNT
+} ApiProvider;
+
+typedef enum ApiPriority {
+    API_PRIORITY_INTERACTIVE = 0,   // Someone is waiting on it (command bar, hover, preview)
+    API_PRIORITY_BACKGROUND         // Batch work (bulk summaries, smart rename, suggestions)
+} ApiPriority;
+
+// A provider's state, for status display and tests
+typedef struct ApiSchedulerStats {
+    int concurrency;                // Current window
+    int in_flight;
+    int waiting;
+    int requests_last_minute;       // Sent by this process
+    int tokens_last_minute;         // Estimated from request sizes
+    int requests_remaining;         // From the last response's headers (-1: unknown)
+    int tokens_remaining;
+    int throttled;                  // 429 and overload responses seen
+    int retries;
+} ApiSchedulerStats;
+
+// A slot held by one request in flight
+typedef struct ApiTicket {
+    ApiProvider provider;
+    ApiPriority priority;
+    int tokens;                     // Estimated tokens the request uses
+} ApiTicket;
+
+// Wait until a request of about tokens tokens may be sent, and take a slot for it
+void api_scheduler_acquire(ApiProvider provider, ApiPriority priority, int tokens, ApiTicket *ticket);
+
+// Give the slot back, learning from the response: its status, rate-limit headers and any
+// Retry-After (resp NULL when the request failed in transport)
+void api_scheduler_release(ApiTicket *ticket, const HttpResponse *resp);
+
+// Whether a response status is worth sending the request again for (429, 5xx overloads)
+bool api_scheduler_should_retry(int status_code);
+
+// Send req through the scheduler, retrying as above; as http_client_execute otherwise
+bool api_scheduler_execute(ApiProvider provider, ApiPriority priority, HttpClient *client,
+                           const HttpRequest *req, HttpResponse *resp);
+
+// As api_scheduler_execute, handing a 2xx body to on_body as http_client_execute_sink
+// does. Once any of a body was handed over the request is not sent again
+bool api_scheduler_execute_sink(ApiProvider provider, ApiPriority priority, HttpClient *client,
+                                const HttpRequest *req, HttpBodyFn on_body, void *context,
+                                HttpResponse *resp);
+
+// As api_scheduler_execute_sink, feeding the body to an SSE parser
+bool api_scheduler_execute_stream(ApiProvider provider, ApiPriority priority, HttpClient *client,
+                                  const HttpRequest *req, HttpSseParser *parser, HttpResponse *resp);
+
+// A provider's current state
+void api_scheduler_get_stats(ApiProvider provider, ApiSchedulerStats *stats);
+
+// Forget everything learned about a provider (for tests)
+void api_scheduler_reset(ApiProvider provider);
+
+#endif // API_SCHEDULER_H
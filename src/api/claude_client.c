@@ -3,7 +3,30 @@
 #include "../../external/cJSON/cJSON.h"
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
+#include <pthread.h>
+
+static const char *const TIER_NAMES[CLAUDE_TIER_COUNT] = { "fast", "balanced", "capable" };
+static const char *const DEFAULT_TIER_MODELS[CLAUDE_TIER_COUNT] = {
+    CLAUDE_FAST_MODEL, CLAUDE_BALANCED_MODEL, CLAUDE_CAPABLE_MODEL
+};
+
+static const char *const FEATURE_NAMES[CLAUDE_FEATURE_COUNT] = {
+    "agent", "hover_summary", "summary", "detailed_summary", "rename", "organize", "nl_operations", "text_edit"
+};
+static const ClaudeTier DEFAULT_FEATURE_TIERS[CLAUDE_FEATURE_COUNT] = {
+    CLAUDE_TIER_BALANCED, CLAUDE_TIER_FAST, CLAUDE_TIER_FAST, CLAUDE_TIER_BALANCED,
+    CLAUDE_TIER_FAST, CLAUDE_TIER_FAST, CLAUDE_TIER_BALANCED, CLAUDE_TIER_BALANCED
+};
+
+// Routing policy; models[i][0] == '\0' means the tier's default
+static struct {
+    pthread_mutex_t mutex;
+    char models[CLAUDE_TIER_COUNT][CLAUDE_MAX_MODEL_LEN];
+    ClaudeTier tiers[CLAUDE_FEATURE_COUNT];
+    bool customized;                    // tiers holds routes (otherwise the defaults apply)
+} g_routing = { .mutex = PTHREAD_MUTEX_INITIALIZER };
 
 ClaudeClient *claude_client_create(const char *api_key)
 {
@@ -61,6 +84,105 @@ void claude_request_set_model(ClaudeMessageRequest *req, const char *model)
     if (!req || !model) return;
     strncpy(req->model, model, CLAUDE_MAX_MODEL_LEN - 1);
     req->model[CLAUDE_MAX_MODEL_LEN - 1] = '\0';
+    req->routed = false;
+}
+
+void claude_request_set_feature(ClaudeMessageRequest *req, ClaudeFeature feature)
+{
+    if (!req || feature < 0 || feature >= CLAUDE_FEATURE_COUNT) return;
+    req->tier = claude_routing_tier(feature);
+    claude_routing_model(req->tier, req->model);
+    req->routed = true;
+}
+
+void claude_routing_set_model(ClaudeTier tier, const char *model)
+{
+    if (tier < 0 || tier >= CLAUDE_TIER_COUNT) return;
+    pthread_mutex_lock(&g_routing.mutex);
+    snprintf(g_routing.models[tier], sizeof(g_routing.models[tier]), "%s", model ? model : "");
+    pthread_mutex_unlock(&g_routing.mutex);
+}
+
+void claude_routing_set_tier(ClaudeFeature feature, ClaudeTier tier)
+{
+    if (feature < 0 || feature >= CLAUDE_FEATURE_COUNT || tier < 0 || tier >= CLAUDE_TIER_COUNT) return;
+    pthread_mutex_lock(&g_routing.mutex);
+    if (!g_routing.customized) {
+        memcpy(g_routing.tiers, DEFAULT_FEATURE_TIERS, sizeof(g_routing.tiers));
+        g_routing.customized = true;
+    }
+    g_routing.tiers[feature] = tier;
+    pthread_mutex_unlock(&g_routing.mutex);
+}
+
+ClaudeTier claude_routing_tier(ClaudeFeature feature)
+{
+    if (feature < 0 || feature >= CLAUDE_FEATURE_COUNT) return CLAUDE_TIER_FAST;
+    pthread_mutex_lock(&g_routing.mutex);
+    ClaudeTier tier = g_routing.customized ? g_routing.tiers[feature] : DEFAULT_FEATURE_TIERS[feature];
+    pthread_mutex_unlock(&g_routing.mutex);
+    return tier;
+}
+
+void claude_routing_model(ClaudeTier tier, char *model)
+{
+    if (!model) return;
+    if (tier < 0 || tier >= CLAUDE_TIER_COUNT) tier = CLAUDE_TIER_FAST;
+    pthread_mutex_lock(&g_routing.mutex);
+    const char *name = g_routing.models[tier][0] ? g_routing.models[tier] : DEFAULT_TIER_MODELS[tier];
+    snprintf(model, CLAUDE_MAX_MODEL_LEN, "%s", name);
+    pthread_mutex_unlock(&g_routing.mutex);
+}
+
+// Helper: Index of name in names, or -1
+static int find_name(const char *const *names, int count, const char *name, size_t length)
+{
+    for (int i = 0; i < count; i++) {
+        if (strlen(names[i]) == length && strncasecmp(names[i], name, length) == 0) return i;
+    }
+    return -1;
+}
+
+bool claude_routing_parse(const char *spec)
+{
+    if (!spec) return true;
+
+    bool ok = true;
+    const char *p = spec;
+    while (*p) {
+        p += strspn(p, ", \t");
+        if (!*p) break;
+        size_t length = strcspn(p, ", \t");
+        const char *equals = memchr(p, '=', length);
+
+        int feature = equals ? find_name(FEATURE_NAMES, CLAUDE_FEATURE_COUNT, p, (size_t)(equals - p)) : -1;
+        int tier = equals ? find_name(TIER_NAMES, CLAUDE_TIER_COUNT, equals + 1, length - (size_t)(equals - p) - 1) : -1;
+        if (feature >= 0 && tier >= 0) {
+            claude_routing_set_tier((ClaudeFeature)feature, (ClaudeTier)tier);
+        } else {
+            ok = false;
+        }
+        p += length;
+    }
+    return ok;
+}
+
+void claude_routing_reset(void)
+{
+    pthread_mutex_lock(&g_routing.mutex);
+    memset(g_routing.models, 0, sizeof(g_routing.models));
+    g_routing.customized = false;
+    pthread_mutex_unlock(&g_routing.mutex);
+}
+
+const char *claude_feature_name(ClaudeFeature feature)
+{
+    return feature >= 0 && feature < CLAUDE_FEATURE_COUNT ? FEATURE_NAMES[feature] : "unknown";
+}
+
+const char *claude_tier_name(ClaudeTier tier)
+{
+    return tier >= 0 && tier < CLAUDE_TIER_COUNT ? TIER_NAMES[tier] : "unknown";
 }
 
 void claude_request_set_max_tokens(ClaudeMessageRequest *req, int max_tokens)
@@ -138,17 +260,53 @@ void claude_request_set_tools(ClaudeMessageRequest *req, cJSON *tools)
     req->tools = tools;
 }
 
-static cJSON *build_message_request_json(const ClaudeMessageRequest *req)
+void claude_request_set_cache_prompt(ClaudeMessageRequest *req, bool cache)
+{
+    if (!req) return;
+    req->cache_prompt = cache;
+}
+
+void claude_request_set_priority(ClaudeMessageRequest *req, ApiPriority priority)
+{
+    if (!req) return;
+    req->priority = priority;
+}
+
+// Helper: mark a content block or tool as the end of a cached prompt prefix
+static void add_cache_breakpoint(cJSON *item)
+{
+    cJSON *cache_control = cJSON_CreateObject();
+    if (cache_control) {
+        cJSON_AddStringToObject(cache_control, "type", "ephemeral");
+        cJSON_AddItemToObject(item, "cache_control", cache_control);
+    }
+}
+
+static cJSON *build_message_request_json(const ClaudeMessageRequest *req, const char *model)
 {
     if (!req) return NULL;
 
     cJSON *root = cJSON_CreateObject();
     if (!root) return NULL;
 
-    cJSON_AddStringToObject(root, "model", req->model);
+    cJSON_AddStringToObject(root, "model", model);
     cJSON_AddNumberToObject(root, "max_tokens", req->max_tokens);
 
-    if (req->system_prompt[0] != '\0') {
+    if (req->system_prompt[0] != '\0' && req->cache_prompt) {
+        // Cache control needs the block form of the system prompt
+        cJSON *system = cJSON_CreateArray();
+        cJSON *block = cJSON_CreateObject();
+        if (system && block) {
+            cJSON_AddStringToObject(block, "type", "text");
+            cJSON_AddStringToObject(block, "text", req->system_prompt);
+            add_cache_breakpoint(block);
+            cJSON_AddItemToArray(system, block);
+            cJSON_AddItemToObject(root, "system", system);
+        } else {
+            cJSON_Delete(system);
+            cJSON_Delete(block);
+        }
+    } else if (req->system_prompt[0] != '\0') {
         cJSON_AddStringToObject(root, "system", req->system_prompt);
     }
 
@@ -182,6 +340,12 @@ static cJSON *build_message_request_json(const ClaudeMessageRequest *req)
     if (req->tools) {
         cJSON *tools_copy = cJSON_Duplicate(req->tools, 1);
         if (tools_copy) {
+            // Tools come first in the prompt, so their breakpoint holds even when the
+            // system prompt changes
+            cJSON *last_tool = cJSON_GetArrayItem(tools_copy, cJSON_GetArraySize(tools_copy) - 1);
+            if (req->cache_prompt && last_tool) {
+                add_cache_breakpoint(last_tool);
+            }
             cJSON_AddItemToObject(root, "tools", tools_copy);
         }
     }
@@ -209,6 +373,45 @@ void claude_response_cleanup(ClaudeMessageResponse *resp)
     resp->tool_use_count = 0;
 }
 
+// Helper: read the token counts present in a usage object
+static void read_usage(const cJSON *usage, ClaudeMessageResponse *resp)
+{
+    cJSON *input_tokens = cJSON_GetObjectItem(usage, "input_tokens");
+    cJSON *output_tokens = cJSON_GetObjectItem(usage, "output_tokens");
+    cJSON *cache_creation = cJSON_GetObjectItem(usage, "cache_creation_input_tokens");
+    cJSON *cache_read = cJSON_GetObjectItem(usage, "cache_read_input_tokens");
+    if (input_tokens && cJSON_IsNumber(input_tokens)) {
+        resp->input_tokens = input_tokens->valueint;
+    }
+    if (output_tokens && cJSON_IsNumber(output_tokens)) {
+        resp->output_tokens = output_tokens->valueint;
+    }
+    if (cache_creation && cJSON_IsNumber(cache_creation)) {
+        resp->cache_creation_tokens = cache_creation->valueint;
+    }
+    if (cache_read && cJSON_IsNumber(cache_read)) {
+        resp->cache_read_tokens = cache_read->valueint;
+    }
+}
+
+// Helper: append text to the response content, truncating at its capacity
+static void append_content(ClaudeMessageResponse *resp, const char *text)
+{
+    size_t current_len = strlen(resp->content);
+    size_t available = CLAUDE_MAX_RESPONSE_LEN - current_len - 1;
+    if (available > 0) {
+        strncat(resp->content, text, available);
+        resp->content[CLAUDE_MAX_RESPONSE_LEN - 1] = '\0';
+    }
+}
+
+// Helper: string member of a JSON object, or NULL
+static const char *json_string(const cJSON *object, const char *name)
+{
+    cJSON *item = object ? cJSON_GetObjectItem(object, name) : NULL;
+    return item && cJSON_IsString(item) ? item->valuestring : NULL;
+}
+
 bool claude_parse_response(const char *json, ClaudeMessageResponse *resp)
 {
     if (!json || !resp) return false;
@@ -252,14 +455,7 @@ bool claude_parse_response(const char *json, ClaudeMessageResponse *resp)
     // Parse usage
     cJSON *usage = cJSON_GetObjectItem(root, "usage");
     if (usage) {
-        cJSON *input_tokens = cJSON_GetObjectItem(usage, "input_tokens");
-        cJSON *output_tokens = cJSON_GetObjectItem(usage, "output_tokens");
-        if (input_tokens && cJSON_IsNumber(input_tokens)) {
-            resp->input_tokens = input_tokens->valueint;
-        }
-        if (output_tokens && cJSON_IsNumber(output_tokens)) {
-            resp->output_tokens = output_tokens->valueint;
-        }
+        read_usage(usage, resp);
     }
 
     // Parse content blocks
@@ -298,12 +494,7 @@ bool claude_parse_response(const char *json, ClaudeMessageResponse *resp)
             if (strcmp(type->valuestring, "text") == 0) {
                 cJSON *text = cJSON_GetObjectItem(block, "text");
                 if (text && cJSON_IsString(text)) {
-                    size_t current_len = strlen(resp->content);
-                    size_t available = CLAUDE_MAX_RESPONSE_LEN - current_len - 1;
-                    if (available > 0) {
-                        strncat(resp->content, text->valuestring, available);
-                        resp->content[CLAUDE_MAX_RESPONSE_LEN - 1] = '\0';
-                    }
+                    append_content(resp, text->valuestring);
                 }
             } else if (strcmp(type->valuestring, "tool_use") == 0 && resp->tool_uses && tool_idx < tool_use_count) {
                 cJSON *tool_id = cJSON_GetObjectItem(block, "id");
@@ -360,15 +551,130 @@ bool claude_response_has_tool_use(const ClaudeMessageResponse *resp)
     return resp && resp->tool_use_count > 0 && resp->tool_uses != NULL;
 }
 
-bool claude_send_message(ClaudeClient *client, const ClaudeMessageRequest *req, ClaudeMessageResponse *resp)
+// Streamed response being assembled from server-sent events
+typedef struct ClaudeStream {
+    ClaudeMessageResponse *resp;
+    const ClaudeStreamCallbacks *callbacks;
+    bool finished;                  // message_stop seen
+    bool in_tool;                   // The open content block is a tool_use
+    ClaudeToolUse tool;             // That block, its input gathered from JSON deltas
+    size_t tool_input_len;
+    int tool_capacity;
+} ClaudeStream;
+
+// Helper: finish the open tool_use block and hand it to the callback
+static bool stream_end_tool(ClaudeStream *stream)
 {
-    if (!client || !req || !resp) return false;
-    if (!claude_client_is_valid(client)) {
-        resp->error = strdup("Claude client not initialized or invalid API key");
+    ClaudeMessageResponse *resp = stream->resp;
+    stream->in_tool = false;
+    if (stream->tool_input_len == 0) {
+        strcpy(stream->tool.input, "{}");
+    }
+
+    if (resp->tool_use_count == stream->tool_capacity) {
+        int capacity = stream->tool_capacity > 0 ? stream->tool_capacity * 2 : 4;
+        ClaudeToolUse *grown = (ClaudeToolUse *)realloc(resp->tool_uses, (size_t)capacity * sizeof(ClaudeToolUse));
+        if (!grown) {
+            resp->error = strdup("Memory allocation failed for tool uses");
+            resp->stop_reason = CLAUDE_STOP_ERROR;
+            return false;
+        }
+        resp->tool_uses = grown;
+        stream->tool_capacity = capacity;
+    }
+    resp->tool_uses[resp->tool_use_count++] = stream->tool;
+
+    const ClaudeStreamCallbacks *callbacks = stream->callbacks;
+    return !callbacks || !callbacks->on_tool_use || callbacks->on_tool_use(callbacks->context, &stream->tool);
+}
+
+// Server-sent event handler: message_start, content_block_start/delta/stop,
+// message_delta, message_stop, ping and error
+static bool on_stream_event(void *context, const char *event, const char *data)
+{
+    ClaudeStream *stream = (ClaudeStream *)context;
+    ClaudeMessageResponse *resp = stream->resp;
+    const ClaudeStreamCallbacks *callbacks = stream->callbacks;
+
+    if (strcmp(event, "ping") == 0) return true;
+
+    cJSON *root = cJSON_Parse(data);
+    if (!root) return true;
+
+    bool keep_going = true;
+    if (strcmp(event, "message_start") == 0) {
+        cJSON *message = cJSON_GetObjectItem(root, "message");
+        const char *id = json_string(message, "id");
+        if (id) {
+            strncpy(resp->id, id, 63);
+            resp->id[63] = '\0';
+        }
+        cJSON *usage = message ? cJSON_GetObjectItem(message, "usage") : NULL;
+        if (usage) {
+            read_usage(usage, resp);
+        }
+    } else if (strcmp(event, "content_block_start") == 0) {
+        cJSON *block = cJSON_GetObjectItem(root, "content_block");
+        const char *type = json_string(block, "type");
+        if (type && strcmp(type, "tool_use") == 0) {
+            const char *id = json_string(block, "id");
+            const char *name = json_string(block, "name");
+            memset(&stream->tool, 0, sizeof(ClaudeToolUse));
+            strncpy(stream->tool.id, id ? id : "", 63);
+            strncpy(stream->tool.name, name ? name : "", CLAUDE_MAX_TOOL_NAME_LEN - 1);
+            stream->tool_input_len = 0;
+            stream->in_tool = true;
+        }
+    } else if (strcmp(event, "content_block_delta") == 0) {
+        cJSON *delta = cJSON_GetObjectItem(root, "delta");
+        const char *type = json_string(delta, "type");
+        const char *text = json_string(delta, "text");
+        const char *partial_json = json_string(delta, "partial_json");
+        if (type && strcmp(type, "text_delta") == 0 && text) {
+            append_content(resp, text);
+            if (callbacks && callbacks->on_text) {
+                keep_going = callbacks->on_text(callbacks->context, text);
+            }
+        } else if (type && strcmp(type, "input_json_delta") == 0 && partial_json && stream->in_tool) {
+            size_t len = strlen(partial_json);
+            if (stream->tool_input_len + len < CLAUDE_MAX_MESSAGE_LEN) {
+                memcpy(stream->tool.input + stream->tool_input_len, partial_json, len + 1);
+                stream->tool_input_len += len;
+            }
+        }
+    } else if (strcmp(event, "content_block_stop") == 0) {
+        if (stream->in_tool) {
+            keep_going = stream_end_tool(stream);
+        }
+    } else if (strcmp(event, "message_delta") == 0) {
+        const char *stop_reason = json_string(cJSON_GetObjectItem(root, "delta"), "stop_reason");
+        if (stop_reason) {
+            resp->stop_reason = claude_stop_reason_from_string(stop_reason);
+        }
+        cJSON *usage = cJSON_GetObjectItem(root, "usage");
+        if (usage) {
+            read_usage(usage, resp);
+        }
+    } else if (strcmp(event, "message_stop") == 0) {
+        stream->finished = true;
+    } else if (strcmp(event, "error") == 0) {
+        const char *message = json_string(cJSON_GetObjectItem(root, "error"), "message");
+        if (!resp->error) {
+            resp->error = strdup(message ? message : "Unknown API error");
+        }
         resp->stop_reason = CLAUDE_STOP_ERROR;
-        return false;
+        keep_going = false;
     }
 
+    cJSON_Delete(root);
+    return keep_going;
+}
+
+// Helper: POST the request to model, parsing the whole body (stream NULL) or its events
+// as they arrive. status receives the HTTP status (0 if none came back)
+static bool send_to_model(ClaudeClient *client, const ClaudeMessageRequest *req, const char *model,
+                          ClaudeStream *stream, ClaudeMessageResponse *resp, int *status)
+{
     HttpClient *http_client = http_client_create();
     if (!http_client) {
         resp->error = strdup("Failed to create HTTP client");
@@ -376,13 +682,16 @@ bool claude_send_message(ClaudeClient *client, const ClaudeMessageRequest *req,
         return false;
     }
 
-    cJSON *request_json = build_message_request_json(req);
+    cJSON *request_json = build_message_request_json(req, model);
     if (!request_json) {
         http_client_destroy(http_client);
         resp->error = strdup("Failed to build request JSON");
         resp->stop_reason = CLAUDE_STOP_ERROR;
         return false;
     }
+    if (stream) {
+        cJSON_AddBoolToObject(request_json, "stream", 1);
+    }
 
     char *request_body = cJSON_PrintUnformatted(request_json);
     cJSON_Delete(request_json);
@@ -408,12 +717,25 @@ bool claude_send_message(ClaudeClient *client, const ClaudeMessageRequest *req,
     HttpResponse http_resp;
     http_response_init(&http_resp);
 
-    bool success = http_client_execute(http_client, &http_req, &http_resp);
+    bool success;
+    if (stream) {
+        HttpSseParser parser;
+        http_sse_init(&parser, on_stream_event, stream);
+        success = api_scheduler_execute_stream(API_PROVIDER_CLAUDE, req->priority, http_client, &http_req,
+                                               &parser, &http_resp);
+        http_sse_cleanup(&parser);
+    } else {
+        success = api_scheduler_execute(API_PROVIDER_CLAUDE, req->priority, http_client, &http_req, &http_resp);
+    }
     http_request_cleanup(&http_req);
     http_client_destroy(http_client);
+    *status = http_resp.status_code;
 
     if (!success) {
-        resp->error = http_resp.error ? strdup(http_resp.error) : strdup("HTTP request failed");
+        // An error event explains a stopped stream better than the transport does
+        if (!resp->error) {
+            resp->error = http_resp.error ? strdup(http_resp.error) : strdup("HTTP request failed");
+        }
         resp->stop_reason = CLAUDE_STOP_ERROR;
         http_response_cleanup(&http_resp);
         return false;
@@ -436,6 +758,16 @@ bool claude_send_message(ClaudeClient *client, const ClaudeMessageRequest *req,
         return false;
     }
 
+    if (stream) {
+        http_response_cleanup(&http_resp);
+        if (!stream->finished) {
+            resp->error = strdup("Response stream ended early");
+            resp->stop_reason = CLAUDE_STOP_ERROR;
+            return false;
+        }
+        return true;
+    }
+
     if (!http_resp.body || http_resp.body_len == 0) {
         resp->error = strdup("Empty response from API");
         resp->stop_reason = CLAUDE_STOP_ERROR;
@@ -448,3 +780,64 @@ bool claude_send_message(ClaudeClient *client, const ClaudeMessageRequest *req,
 
     return success;
 }
+
+// Helper: Tier to try when a routed request's model is overloaded
+static ClaudeTier fallback_tier(ClaudeTier tier)
+{
+    return tier == CLAUDE_TIER_FAST ? CLAUDE_TIER_BALANCED : (ClaudeTier)(tier - 1);
+}
+
+// Helper: Send the request, moving a routed request whose model is overloaded to the
+// fallback tier's model once
+static bool send_request(ClaudeClient *client, const ClaudeMessageRequest *req,
+                         ClaudeStream *stream, ClaudeMessageResponse *resp)
+{
+    if (!client || !req || !resp) return false;
+    if (!claude_client_is_valid(client)) {
+        resp->error = strdup("Claude client not initialized or invalid API key");
+        resp->stop_reason = CLAUDE_STOP_ERROR;
+        return false;
+    }
+
+    int status = 0;
+    bool success = send_to_model(client, req, req->model, stream, resp, &status);
+    if (success || !req->routed || (status != 529 && status != 503)) {
+        return success;
+    }
+
+    char fallback[CLAUDE_MAX_MODEL_LEN];
+    claude_routing_model(fallback_tier(req->tier), fallback);
+    if (strcmp(fallback, req->model) == 0) {
+        return false;
+    }
+
+    // Nothing of an error response reached the stream, so it starts over clean
+    free(resp->error);
+    resp->error = NULL;
+    resp->stop_reason = CLAUDE_STOP_END_TURN;
+    return send_to_model(client, req, fallback, stream, resp, &status);
+}
+
+bool claude_send_message(ClaudeClient *client, const ClaudeMessageRequest *req, ClaudeMessageResponse *resp)
+{
+    return send_request(client, req, NULL, resp);
+}
+
+bool claude_send_message_stream(ClaudeClient *client, const ClaudeMessageRequest *req,
+                                const ClaudeStreamCallbacks *callbacks, ClaudeMessageResponse *resp)
+{
+    if (!resp) return false;
+
+    ClaudeStream *stream = (ClaudeStream *)calloc(1, sizeof(ClaudeStream));
+    if (!stream) {
+        resp->error = strdup("Memory allocation failed for stream");
+        resp->stop_reason = CLAUDE_STOP_ERROR;
+        return false;
+    }
+    stream->resp = resp;
+    stream->callbacks = callbacks;
+
+    bool success = send_request(client, req, stream, resp);
+    free(stream);
+    return success;
+}
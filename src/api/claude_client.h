@@ -1,6 +1,7 @@
 #ifndef CLAUDE_CLIENT_H
 #define CLAUDE_CLIENT_H
 
+#include "api_scheduler.h"
 #include <stdbool.h>
 #include <stddef.h>
 
@@ -17,6 +18,34 @@
 #define CLAUDE_DEFAULT_MODEL "claude-haiku-4-5-20251001"
 #define CLAUDE_DEFAULT_MAX_TOKENS 4096
 
+// Models behind each tier until claude_routing_set_model changes them
+#define CLAUDE_FAST_MODEL CLAUDE_DEFAULT_MODEL
+#define CLAUDE_BALANCED_MODEL "claude-sonnet-4-5-20250929"
+#define CLAUDE_CAPABLE_MODEL "claude-opus-4-1-20250805"
+
+// Model tiers, fastest first. A request routed to a tier whose model is overloaded
+// (529, 503 after the scheduler's retries) is sent once more to the next tier down, or
+// from the fast tier up to the balanced one
+typedef enum ClaudeTier {
+    CLAUDE_TIER_FAST = 0,
+    CLAUDE_TIER_BALANCED,
+    CLAUDE_TIER_CAPABLE,
+    CLAUDE_TIER_COUNT
+} ClaudeTier;
+
+// Features that talk to Claude, each routed to a tier (default in parentheses)
+typedef enum ClaudeFeature {
+    CLAUDE_FEATURE_AGENT = 0,           // Command bar tool runs (balanced)
+    CLAUDE_FEATURE_HOVER_SUMMARY,       // Brief summaries (fast)
+    CLAUDE_FEATURE_SUMMARY,             // Standard summaries, key points (fast)
+    CLAUDE_FEATURE_DETAILED_SUMMARY,    // Detailed summaries, comparisons (balanced)
+    CLAUDE_FEATURE_RENAME,              // Smart rename suggestions (fast)
+    CLAUDE_FEATURE_ORGANIZE,            // Folder classification (fast)
+    CLAUDE_FEATURE_NL_OPERATIONS,       // Natural-language file operations (balanced)
+    CLAUDE_FEATURE_TEXT_EDIT,           // AI text edits (balanced)
+    CLAUDE_FEATURE_COUNT
+} ClaudeFeature;
+
 // Stop reasons
 typedef enum ClaudeStopReason {
     CLAUDE_STOP_END_TURN = 0,
@@ -49,6 +78,10 @@ typedef struct ClaudeMessageRequest {
     int message_count;
     int message_capacity;
     struct cJSON *tools;
+    bool cache_prompt;          // Mark tools and system prompt as a cached prefix
+    ApiPriority priority;       // Where the request queues behind rate limits (interactive by default)
+    bool routed;                // model came from tier (claude_request_set_feature)
+    ClaudeTier tier;
 } ClaudeMessageRequest;
 
 // Message response
@@ -58,6 +91,8 @@ typedef struct ClaudeMessageResponse {
     ClaudeStopReason stop_reason;
     int input_tokens;
     int output_tokens;
+    int cache_creation_tokens;  // Input tokens written to the prompt cache
+    int cache_read_tokens;      // Input tokens read from the prompt cache
     ClaudeToolUse *tool_uses;
     int tool_use_count;
     char *error;
@@ -85,6 +120,39 @@ void claude_request_add_assistant_message(ClaudeMessageRequest *req, const char
 void claude_request_add_tool_result(ClaudeMessageRequest *req, const char *tool_id, const char *result);
 void claude_request_set_tools(ClaudeMessageRequest *req, struct cJSON *tools);
 
+// Add prompt-cache breakpoints after the tools and the system prompt, so requests that
+// resend them unchanged within a few minutes read that prefix from the cache. Worth it
+// only for prefixes past the model's minimum cacheable length, which the API otherwise
+// ignores
+void claude_request_set_cache_prompt(ClaudeMessageRequest *req, bool cache);
+
+// Queue the request as background batch work, behind interactive requests (api_scheduler.h)
+void claude_request_set_priority(ClaudeMessageRequest *req, ApiPriority priority);
+
+// Use the model of the tier feature is routed to, falling back to another tier on
+// overload. claude_request_set_model afterwards pins a model instead
+void claude_request_set_feature(ClaudeMessageRequest *req, ClaudeFeature feature);
+
+// Routing policy, process-wide. Change the model behind a tier (NULL or "" restores its
+// default) or the tier a feature uses
+void claude_routing_set_model(ClaudeTier tier, const char *model);
+void claude_routing_set_tier(ClaudeFeature feature, ClaudeTier tier);
+ClaudeTier claude_routing_tier(ClaudeFeature feature);
+
+// Copy the model behind a tier into model (CLAUDE_MAX_MODEL_LEN bytes)
+void claude_routing_model(ClaudeTier tier, char *model);
+
+// Apply routes written as "feature=tier" pairs separated by commas or spaces, e.g.
+// "agent=capable, rename=fast"; false if any pair is not understood (the rest still apply)
+bool claude_routing_parse(const char *spec);
+
+// Restore the default routes and models
+void claude_routing_reset(void);
+
+// Names used in routing specs ("agent", "hover_summary", ...; "fast", "balanced", "capable")
+const char *claude_feature_name(ClaudeFeature feature);
+const char *claude_tier_name(ClaudeTier tier);
+
 // Response functions
 void claude_response_init(ClaudeMessageResponse *resp);
 void claude_response_cleanup(ClaudeMessageResponse *resp);
@@ -92,6 +160,19 @@ void claude_response_cleanup(ClaudeMessageResponse *resp);
 // Send message
 bool claude_send_message(ClaudeClient *client, const ClaudeMessageRequest *req, ClaudeMessageResponse *resp);
 
+// Streaming callbacks, called on the sending thread as the response arrives. Either may
+// be NULL; returning false stops the stream (the call then fails)
+typedef struct ClaudeStreamCallbacks {
+    bool (*on_text)(void *context, const char *text);               // Next text delta
+    bool (*on_tool_use)(void *context, const ClaudeToolUse *tool);  // Complete tool_use block
+    void *context;
+} ClaudeStreamCallbacks;
+
+// Send message with stream: true, delivering text and tool uses as they arrive. resp is
+// filled as claude_send_message fills it once the stream ends
+bool claude_send_message_stream(ClaudeClient *client, const ClaudeMessageRequest *req,
+                                const ClaudeStreamCallbacks *callbacks, ClaudeMessageResponse *resp);
+
 // Parse response JSON
 bool claude_parse_response(const char *json, ClaudeMessageResponse *resp);
 
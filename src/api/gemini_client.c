@@ -1,12 +1,17 @@
 #include "gemini_client.h"
 #include "http_client.h"
-#include "../../external/cJSON/cJSON.h"
+#include "api_scheduler.h"
+#include "json_stream.h"
+#include "image_upload.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
-#include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #if GEMINI_DEBUG
 #define GEMINI_LOG(fmt, ...) fprintf(stderr, "[GEMINI] " fmt "\n", ##__VA_ARGS__)
@@ -14,6 +19,9 @@
 #define GEMINI_LOG(fmt, ...) ((void)0)
 #endif
 
+// Decoded bytes buffered before they are written out, when decoding to a file
+#define GEMINI_DECODE_CHUNK (256 * 1024)
+
 // Base64 decoding table
 static const unsigned char base64_decode_table[256] = {
     64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
@@ -34,154 +42,124 @@ static const unsigned char base64_decode_table[256] = {
     64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64
 };
 
-static size_t base64_decode(const char *input, unsigned char **output)
-{
-    if (!input || !output) return 0;
-
-    size_t input_len = strlen(input);
-    if (input_len == 0) return 0;
-
-    // Calculate output size (approximately 3/4 of input)
-    size_t output_len = (input_len * 3) / 4;
-
-    // Account for padding
-    if (input_len >= 1 && input[input_len - 1] == '=') output_len--;
-    if (input_len >= 2 && input[input_len - 2] == '=') output_len--;
-
-    *output = (unsigned char *)malloc(output_len + 1);
-    if (!*output) return 0;
-
-    size_t i = 0, j = 0;
+// Response being parsed: the error or the first image of the first candidate, decoded
+// from base64 as its pieces arrive (into memory, or a buffer at a time into a file)
+typedef struct GeminiParse {
+    GeminiImageResponse *resp;
+    bool has_error;
+    int error_code;
+    int candidate;                  // Index of the candidate being read, -1 before the first
+    bool has_parts;
+    bool filtered;
+    char finish_reason[32];
+    bool has_image;
+
+    // inlineData of the part being read
+    char mime[64];
+    bool has_mime;
+    bool has_data;
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
     unsigned char sextet[4];
-    int count = 0;
+    int sextet_count;
+    bool padded;                    // '=' seen: the rest of the data is ignored
+    FILE *file;                     // Where the image goes, if not memory
+    size_t written;                 // Bytes of the image written to file
+    bool write_failed;
+} GeminiParse;
+
+// Helper: Append a string piece to a fixed buffer, clipped to fit
+static void append_piece(char *dest, size_t dest_size, const char *text, size_t len)
+{
+    size_t used = strlen(dest);
+    if (used + 1 >= dest_size) return;
+    if (len > dest_size - 1 - used) len = dest_size - 1 - used;
+    memcpy(dest + used, text, len);
+    dest[used + len] = '\0';
+}
 
-    while (i < input_len) {
-        unsigned char c = (unsigned char)input[i++];
+// Helper: Decode base64 text into the buffer
+static bool decode_slice(GeminiParse *parse, const char *text, size_t len)
+{
+    size_t needed = parse->size + (len / 4 + 1) * 3;
+    if (needed > parse->capacity) {
+        size_t capacity = parse->capacity ? parse->capacity * 2 : 65536;
+        while (capacity < needed) capacity *= 2;
+        unsigned char *grown = (unsigned char *)realloc(parse->data, capacity);
+        if (!grown) return false;
+        parse->data = grown;
+        parse->capacity = capacity;
+    }
 
-        // Skip whitespace
-        if (c == '\n' || c == '\r' || c == ' ' || c == '\t') continue;
+    for (size_t i = 0; i < len && !parse->padded; i++) {
+        unsigned char c = (unsigned char)text[i];
 
         // Stop at padding
-        if (c == '=') break;
+        if (c == '=') {
+            parse->padded = true;
+            break;
+        }
 
         unsigned char val = base64_decode_table[c];
-        if (val == 64) continue; // Invalid character, skip
-
-        sextet[count++] = val;
-
-        if (count == 4) {
-            if (j + 3 <= output_len) {
-                (*output)[j++] = (sextet[0] << 2) | (sextet[1] >> 4);
-                (*output)[j++] = (sextet[1] << 4) | (sextet[2] >> 2);
-                (*output)[j++] = (sextet[2] << 6) | sextet[3];
-            }
-            count = 0;
+        if (val == 64) continue; // Whitespace or invalid character, skip
+
+        parse->sextet[parse->sextet_count++] = val;
+        if (parse->sextet_count == 4) {
+            unsigned char *sextet = parse->sextet;
+            parse->data[parse->size++] = (sextet[0] << 2) | (sextet[1] >> 4);
+            parse->data[parse->size++] = (sextet[1] << 4) | (sextet[2] >> 2);
+            parse->data[parse->size++] = (sextet[2] << 6) | sextet[3];
+            parse->sextet_count = 0;
         }
     }
-
-    // Handle remaining bytes
-    if (count >= 2 && j < output_len) {
-        (*output)[j++] = (sextet[0] << 2) | (sextet[1] >> 4);
-    }
-    if (count >= 3 && j < output_len) {
-        (*output)[j++] = (sextet[1] << 4) | (sextet[2] >> 2);
-    }
-
-    return j;
+    return true;
 }
 
-// Base64 encoding table
-static const char base64_encode_table[] =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
-static char *base64_encode(const unsigned char *input, size_t input_len)
+// Helper: Write out the decoded bytes buffered, when decoding to a file
+static bool decode_flush(GeminiParse *parse)
 {
-    if (!input || input_len == 0) return NULL;
-
-    // Calculate output size (4 bytes for every 3 input bytes, plus padding)
-    size_t output_len = 4 * ((input_len + 2) / 3);
-    char *output = (char *)malloc(output_len + 1);
-    if (!output) return NULL;
-
-    size_t i = 0, j = 0;
-    while (i < input_len) {
-        uint32_t octet_a = i < input_len ? input[i++] : 0;
-        uint32_t octet_b = i < input_len ? input[i++] : 0;
-        uint32_t octet_c = i < input_len ? input[i++] : 0;
-
-        uint32_t triple = (octet_a << 16) | (octet_b << 8) | octet_c;
-
-        output[j++] = base64_encode_table[(triple >> 18) & 0x3F];
-        output[j++] = base64_encode_table[(triple >> 12) & 0x3F];
-        output[j++] = base64_encode_table[(triple >> 6) & 0x3F];
-        output[j++] = base64_encode_table[triple & 0x3F];
-    }
-
-    // Add padding
-    int padding = (3 - (int)(input_len % 3)) % 3;
-    for (int p = 0; p < padding; p++) {
-        output[output_len - 1 - p] = '=';
+    if (!parse->file || parse->size == 0) return true;
+    if (fwrite(parse->data, 1, parse->size, parse->file) != parse->size) {
+        parse->write_failed = true;
+        return false;
     }
-
-    output[output_len] = '\0';
-    return output;
+    parse->written += parse->size;
+    parse->size = 0;
+    return true;
 }
 
-// Read file into memory
-static unsigned char *read_file_binary(const char *path, size_t *size_out)
+// Helper: Decode the next piece of base64 image data; a file takes it a chunk at a time
+static bool decode_piece(GeminiParse *parse, const char *text, size_t len)
 {
-    if (!path || !size_out) return NULL;
-
-    FILE *f = fopen(path, "rb");
-    if (!f) return NULL;
-
-    fseek(f, 0, SEEK_END);
-    long file_size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    if (file_size <= 0) {
-        fclose(f);
-        return NULL;
-    }
-
-    unsigned char *data = (unsigned char *)malloc((size_t)file_size);
-    if (!data) {
-        fclose(f);
-        return NULL;
-    }
-
-    size_t read_size = fread(data, 1, (size_t)file_size, f);
-    fclose(f);
-
-    if (read_size != (size_t)file_size) {
-        free(data);
-        return NULL;
+    size_t slice = parse->file ? GEMINI_DECODE_CHUNK / 3 * 4 : len;
+    for (size_t at = 0; at < len; at += slice) {
+        size_t piece = len - at < slice ? len - at : slice;
+        if (!decode_slice(parse, text + at, piece) || !decode_flush(parse)) {
+            return false;
+        }
     }
-
-    *size_out = (size_t)file_size;
-    return data;
+    return true;
 }
 
-// Get MIME type from file extension
-static const char *get_mime_from_extension(const char *path)
+// Helper: Decode the bytes of a final partial group
+static bool decode_finish(GeminiParse *parse)
 {
-    if (!path) return "application/octet-stream";
-
-    const char *ext = strrchr(path, '.');
-    if (!ext) return "application/octet-stream";
-
-    ext++; // Skip the dot
-    if (strcasecmp(ext, "png") == 0) return "image/png";
-    if (strcasecmp(ext, "jpg") == 0 || strcasecmp(ext, "jpeg") == 0) return "image/jpeg";
-    if (strcasecmp(ext, "gif") == 0) return "image/gif";
-    if (strcasecmp(ext, "webp") == 0) return "image/webp";
-    if (strcasecmp(ext, "bmp") == 0) return "image/bmp";
-
-    return "application/octet-stream";
+    unsigned char *sextet = parse->sextet;
+    if (parse->sextet_count >= 2) {
+        parse->data[parse->size++] = (sextet[0] << 2) | (sextet[1] >> 4);
+    }
+    if (parse->sextet_count >= 3) {
+        parse->data[parse->size++] = (sextet[1] << 4) | (sextet[2] >> 2);
+    }
+    parse->sextet_count = 0;
+    return decode_flush(parse);
 }
 
-// Forward declaration for response parsing
-static bool gemini_parse_image_response(const char *json, GeminiImageResponse *resp);
+// Forward declarations for building and sending requests
+static void write_generation_config(JsonWriter *body);
+static bool gemini_send(GeminiClient *client, const char *url, JsonWriter *body,
+                        long transfer_timeout, const char *output_dir, GeminiImageResponse *resp);
 
 GeminiClient *gemini_client_create(const char *api_key)
 {
@@ -240,6 +218,13 @@ void gemini_request_set_model(GeminiImageRequest *req, const char *model)
     req->model[GEMINI_MAX_MODEL_LEN - 1] = '\0';
 }
 
+void gemini_request_set_output_dir(GeminiImageRequest *req, const char *dir)
+{
+    if (!req || !dir) return;
+    strncpy(req->output_dir, dir, GEMINI_MAX_PATH_LEN - 1);
+    req->output_dir[GEMINI_MAX_PATH_LEN - 1] = '\0';
+}
+
 void gemini_response_init(GeminiImageResponse *resp)
 {
     if (!resp) return;
@@ -254,6 +239,10 @@ void gemini_response_cleanup(GeminiImageResponse *resp)
         free(resp->image_data);
         resp->image_data = NULL;
     }
+    if (resp->image_path[0]) {
+        unlink(resp->image_path);
+        resp->image_path[0] = '\0';
+    }
     resp->image_size = 0;
 }
 
@@ -296,260 +285,376 @@ bool gemini_generate_image(GeminiClient *client,
     GEMINI_LOG("Model: %s", model);
 
     // Build request body
-    cJSON *root = cJSON_CreateObject();
-    cJSON *contents = cJSON_CreateArray();
-    cJSON *content = cJSON_CreateObject();
-    cJSON *parts = cJSON_CreateArray();
-    cJSON *part = cJSON_CreateObject();
-
-    cJSON_AddStringToObject(part, "text", req->prompt);
-    cJSON_AddItemToArray(parts, part);
-    cJSON_AddItemToObject(content, "parts", parts);
-    cJSON_AddItemToArray(contents, content);
-    cJSON_AddItemToObject(root, "contents", contents);
-
-    // Add generationConfig for image output (TEXT required with IMAGE per API docs)
-    cJSON *gen_config = cJSON_CreateObject();
-    cJSON *modalities = cJSON_CreateArray();
-    cJSON_AddItemToArray(modalities, cJSON_CreateString("TEXT"));
-    cJSON_AddItemToArray(modalities, cJSON_CreateString("IMAGE"));
-    cJSON_AddItemToObject(gen_config, "responseModalities", modalities);
-    cJSON_AddItemToObject(root, "generationConfig", gen_config);
-
-    char *request_body = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-
-    if (!request_body) {
-        GEMINI_LOG("ERROR: Failed to build request JSON");
-        strncpy(resp->error, "Failed to build request JSON", GEMINI_MAX_ERROR_LEN - 1);
-        resp->result_type = GEMINI_RESULT_ERROR;
-        return false;
+    JsonWriter body;
+    json_writer_init(&body);
+    json_writer_begin_object(&body);
+    json_writer_key(&body, "contents");
+    json_writer_begin_array(&body);
+    json_writer_begin_object(&body);
+    json_writer_key(&body, "parts");
+    json_writer_begin_array(&body);
+    json_writer_begin_object(&body);
+    json_writer_key(&body, "text");
+    json_writer_string(&body, req->prompt);
+    json_writer_end_object(&body);
+    json_writer_end_array(&body);
+    json_writer_end_object(&body);
+    json_writer_end_array(&body);
+    write_generation_config(&body);
+    json_writer_end_object(&body);
+
+    GEMINI_LOG("Request body length: %zu", json_writer_length(&body));
+
+    // Longer timeout for image generation (60 seconds)
+    bool success = gemini_send(client, url, &body, 60, req->output_dir, resp);
+    json_writer_free(&body);
+
+    GEMINI_LOG("=== gemini_generate_image END (success=%d) ===", success);
+    return success;
+}
+
+// Helper: Add generationConfig asking for image output (TEXT required with IMAGE per API docs)
+static void write_generation_config(JsonWriter *body)
+{
+    json_writer_key(body, "generationConfig");
+    json_writer_begin_object(body);
+    json_writer_key(body, "responseModalities");
+    json_writer_begin_array(body);
+    json_writer_string(body, "TEXT");
+    json_writer_string(body, "IMAGE");
+    json_writer_end_array(body);
+    json_writer_end_object(body);
+}
+
+static size_t read_request_body(void *context, size_t offset, char *buffer, size_t size)
+{
+    return json_writer_read_at((JsonWriter *)context, offset, buffer, size);
+}
+
+// Helper: Set up the part being read for its inlineData
+static void parse_begin_inline_data(GeminiParse *parse)
+{
+    parse->mime[0] = '\0';
+    parse->has_mime = false;
+    parse->has_data = false;
+    parse->size = 0;
+    parse->sextet_count = 0;
+    parse->padded = false;
+    if (parse->file) {
+        // An earlier part left nothing worth keeping
+        rewind(parse->file);
+        parse->written = 0;
     }
+}
 
-    GEMINI_LOG("Request body: %.500s%s", request_body, strlen(request_body) > 500 ? "..." : "");
+// Helper: A part's inlineData is complete; keep the first image
+static void parse_end_inline_data(GeminiParse *parse)
+{
+    GeminiImageResponse *resp = parse->resp;
+    size_t size = parse->written + parse->size;
+    GEMINI_LOG("inlineData: mimeType=%s, decoded size=%zu", parse->mime, size);
+    if (parse->has_image || !parse->has_mime || !parse->has_data || size == 0) {
+        return;
+    }
+
+    strncpy(resp->mime_type, parse->mime, sizeof(resp->mime_type) - 1);
+    resp->format = gemini_format_from_mime(parse->mime);
+    resp->image_size = size;
+    parse->has_image = true;
+    if (parse->file) {
+        // Done with the file: cut what an earlier, longer part left behind
+        bool ok = fflush(parse->file) == 0 && ftruncate(fileno(parse->file), (off_t)size) == 0;
+        ok = fclose(parse->file) == 0 && ok;
+        parse->file = NULL;
+        parse->has_image = ok;
+        parse->write_failed = !ok;
+        return;
+    }
+    resp->image_data = parse->data;
+    parse->data = NULL;
+    parse->size = 0;
+    parse->capacity = 0;
+}
 
-    // Make HTTP request
-    HttpClient *http_client = http_client_create();
-    if (!http_client) {
-        GEMINI_LOG("ERROR: Failed to create HTTP client");
-        strncpy(resp->error, "Failed to create HTTP client", GEMINI_MAX_ERROR_LEN - 1);
-        resp->result_type = GEMINI_RESULT_ERROR;
-        free(request_body);
-        return false;
+// Reader event handler for a generateContent response
+static bool on_response_event(void *context, JsonEvent event, const char *path,
+                              const char *text, size_t len, bool last)
+{
+    GeminiParse *parse = (GeminiParse *)context;
+
+    // API error
+    if (strncmp(path, "error", 5) == 0) {
+        if (event == JSON_EVENT_BEGIN_OBJECT && strcmp(path, "error") == 0) {
+            parse->has_error = true;
+            parse->resp->error[0] = '\0';
+        } else if (event == JSON_EVENT_STRING && strcmp(path, "error.message") == 0) {
+            append_piece(parse->resp->error, sizeof(parse->resp->error), text, len);
+        } else if (event == JSON_EVENT_NUMBER && strcmp(path, "error.code") == 0) {
+            parse->error_code = atoi(text);
+        }
+        return true;
     }
 
-    // Set longer timeout for image generation (60 seconds)
-    http_client_set_timeout(http_client, 30, 60);
+    if (strncmp(path, "candidates[]", 12) != 0) {
+        return true;
+    }
+    if (event == JSON_EVENT_BEGIN_OBJECT && strcmp(path, "candidates[]") == 0) {
+        parse->candidate++;
+        return true;
+    }
 
-    HttpRequest http_req;
-    http_request_init(&http_req);
-    http_request_set_method(&http_req, HTTP_POST);
-    http_request_set_url(&http_req, url);
-    http_request_add_header(&http_req, "Content-Type", "application/json");
-    http_request_add_header(&http_req, "x-goog-api-key", client->api_key);
-    http_request_set_body_string(&http_req, request_body);
-    free(request_body);
+    // Only the first candidate is used
+    if (parse->candidate != 0) {
+        return true;
+    }
+    const char *field = path + 12;
 
-    HttpResponse http_resp;
-    http_response_init(&http_resp);
+    if (strcmp(field, ".finishReason") == 0 && event == JSON_EVENT_STRING) {
+        append_piece(parse->finish_reason, sizeof(parse->finish_reason), text, len);
+        if (last) {
+            GEMINI_LOG("Finish reason: %s", parse->finish_reason);
+            parse->filtered = strcmp(parse->finish_reason, "SAFETY") == 0 ||
+                              strcmp(parse->finish_reason, "BLOCKED") == 0;
+        }
+    } else if (strcmp(field, ".content.parts") == 0 && event == JSON_EVENT_BEGIN_ARRAY) {
+        parse->has_parts = true;
+    } else if (strcmp(field, ".content.parts[].inlineData") == 0) {
+        if (event == JSON_EVENT_BEGIN_OBJECT) {
+            parse_begin_inline_data(parse);
+        } else if (event == JSON_EVENT_END_OBJECT) {
+            parse_end_inline_data(parse);
+        }
+    } else if (strcmp(field, ".content.parts[].inlineData.mimeType") == 0 && event == JSON_EVENT_STRING) {
+        append_piece(parse->mime, sizeof(parse->mime), text, len);
+        parse->has_mime = last;
+    } else if (strcmp(field, ".content.parts[].inlineData.data") == 0 && event == JSON_EVENT_STRING) {
+        // Once an image is kept the rest are skipped rather than decoded
+        if (!parse->has_image) {
+            if (!decode_piece(parse, text, len)) {
+                return false;
+            }
+            if (last) {
+                if (!decode_finish(parse)) {
+                    return false;
+                }
+                parse->has_data = true;
+            }
+        }
+    }
+    return true;
+}
 
-    GEMINI_LOG("Sending HTTP request...");
-    bool success = http_client_execute(http_client, &http_req, &http_resp);
-    http_request_cleanup(&http_req);
-    http_client_destroy(http_client);
+static bool on_response_body(void *context, const char *bytes, size_t len)
+{
+    return json_reader_feed((JsonReader *)context, bytes, len);
+}
 
-    GEMINI_LOG("HTTP request complete, success=%d", success);
+// Helper: Set the result from what the response held
+static bool gemini_parse_finish(GeminiParse *parse, bool complete)
+{
+    GeminiImageResponse *resp = parse->resp;
+
+    if (parse->has_error) {
+        GEMINI_LOG("API ERROR: %s (code %d)", resp->error, parse->error_code);
+        if (parse->error_code == 401 || parse->error_code == 403) {
+            resp->result_type = GEMINI_RESULT_INVALID_KEY;
+        } else if (parse->error_code == 429) {
+            resp->result_type = GEMINI_RESULT_RATE_LIMIT;
+        } else {
+            resp->result_type = GEMINI_RESULT_ERROR;
+        }
+        return false;
+    }
 
-    if (!success) {
-        GEMINI_LOG("ERROR: HTTP request failed: %s", http_resp.error ? http_resp.error : "unknown");
-        snprintf(resp->error, sizeof(resp->error), "HTTP request failed: %s",
-                 http_resp.error ? http_resp.error : "unknown");
+    if (parse->write_failed) {
+        GEMINI_LOG("ERROR: Failed to write image to %s", resp->image_path);
+        strncpy(resp->error, "Failed to write image to disk", GEMINI_MAX_ERROR_LEN - 1);
         resp->result_type = GEMINI_RESULT_ERROR;
-        http_response_cleanup(&http_resp);
         return false;
     }
 
-    GEMINI_LOG("HTTP status code: %d", http_resp.status_code);
-    if (http_resp.body) {
-        GEMINI_LOG("Response body length: %zu", strlen(http_resp.body));
-        GEMINI_LOG("Response body (first 1000 chars): %.1000s", http_resp.body);
-    } else {
-        GEMINI_LOG("Response body: NULL");
+    if (!complete) {
+        GEMINI_LOG("ERROR: Failed to parse JSON");
+        strncpy(resp->error, "Failed to parse response JSON", GEMINI_MAX_ERROR_LEN - 1);
+        resp->result_type = GEMINI_RESULT_ERROR;
+        return false;
     }
 
-    // Check HTTP status
-    if (http_resp.status_code == 401 || http_resp.status_code == 403) {
-        GEMINI_LOG("ERROR: Invalid API key (HTTP %d)", http_resp.status_code);
-        strncpy(resp->error, "Invalid API key", GEMINI_MAX_ERROR_LEN - 1);
-        resp->result_type = GEMINI_RESULT_INVALID_KEY;
-        http_response_cleanup(&http_resp);
+    if (parse->candidate < 0) {
+        GEMINI_LOG("ERROR: No candidates in response");
+        strncpy(resp->error, "No candidates in response", GEMINI_MAX_ERROR_LEN - 1);
+        resp->result_type = GEMINI_RESULT_ERROR;
         return false;
     }
 
-    if (http_resp.status_code == 429) {
-        GEMINI_LOG("ERROR: Rate limit exceeded");
-        strncpy(resp->error, "Rate limit exceeded", GEMINI_MAX_ERROR_LEN - 1);
-        resp->result_type = GEMINI_RESULT_RATE_LIMIT;
-        http_response_cleanup(&http_resp);
+    if (parse->filtered) {
+        GEMINI_LOG("ERROR: Content blocked by safety filters");
+        strncpy(resp->error, "Content was blocked by safety filters", GEMINI_MAX_ERROR_LEN - 1);
+        resp->result_type = GEMINI_RESULT_CONTENT_FILTERED;
         return false;
     }
 
-    if (http_resp.status_code != 200) {
-        GEMINI_LOG("ERROR: HTTP error %d", http_resp.status_code);
-        snprintf(resp->error, sizeof(resp->error), "HTTP error: %d", http_resp.status_code);
+    if (!parse->has_parts) {
+        GEMINI_LOG("ERROR: No parts in response");
+        strncpy(resp->error, "No parts in response", GEMINI_MAX_ERROR_LEN - 1);
         resp->result_type = GEMINI_RESULT_ERROR;
-        http_response_cleanup(&http_resp);
         return false;
     }
 
-    // Parse response
-    GEMINI_LOG("Parsing response...");
-    success = gemini_parse_image_response(http_resp.body, resp);
-    GEMINI_LOG("Parse result: success=%d, result_type=%d", success, resp->result_type);
-    if (!success && resp->error[0]) {
-        GEMINI_LOG("Parse error: %s", resp->error);
+    if (!parse->has_image) {
+        GEMINI_LOG("ERROR: No image data found in any part");
+        strncpy(resp->error, "No image data in response", GEMINI_MAX_ERROR_LEN - 1);
+        resp->result_type = GEMINI_RESULT_ERROR;
+        return false;
     }
-    http_response_cleanup(&http_resp);
 
-    GEMINI_LOG("=== gemini_generate_image END (success=%d) ===", success);
-    return success;
+    resp->result_type = GEMINI_RESULT_SUCCESS;
+    GEMINI_LOG("SUCCESS: Image decoded, %zu bytes", resp->image_size);
+    return true;
 }
 
-static bool gemini_parse_image_response(const char *json, GeminiImageResponse *resp)
+// Helper: Create a hidden file in dir for an image to be decoded into, its path in path
+static FILE *open_image_file(const char *dir, char *path, size_t path_size)
 {
-    GEMINI_LOG("=== gemini_parse_image_response START ===");
-
-    if (!json || !resp) {
-        GEMINI_LOG("ERROR: NULL parameter");
-        return false;
+    static atomic_uint counter;
+    for (int attempt = 0; attempt < 16; attempt++) {
+        snprintf(path, path_size, "%s/.gemini-%d-%u.part", dir, (int)getpid(), atomic_fetch_add(&counter, 1));
+        int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+        if (fd >= 0) {
+            FILE *file = fdopen(fd, "wb");
+            if (!file) {
+                close(fd);
+                unlink(path);
+            }
+            return file;
+        }
+        if (errno != EEXIST) break;
     }
+    path[0] = '\0';
+    return NULL;
+}
 
-    cJSON *root = cJSON_Parse(json);
-    if (!root) {
-        GEMINI_LOG("ERROR: Failed to parse JSON");
-        strncpy(resp->error, "Failed to parse response JSON", GEMINI_MAX_ERROR_LEN - 1);
+// Helper: Send a generateContent request. The body is read from the writer as curl
+// uploads it, and a successful response is parsed as it arrives, so neither the request
+// nor the response (nor a DOM of it) is ever held in full
+static bool gemini_send(GeminiClient *client, const char *url, JsonWriter *body,
+                        long transfer_timeout, const char *output_dir, GeminiImageResponse *resp)
+{
+    if (!json_writer_ok(body)) {
+        GEMINI_LOG("ERROR: Failed to build request JSON");
+        strncpy(resp->error, "Failed to build request JSON", GEMINI_MAX_ERROR_LEN - 1);
         resp->result_type = GEMINI_RESULT_ERROR;
         return false;
     }
 
-    // Check for API error
-    cJSON *error = cJSON_GetObjectItem(root, "error");
-    if (error) {
-        cJSON *message = cJSON_GetObjectItem(error, "message");
-        if (message && cJSON_IsString(message)) {
-            GEMINI_LOG("API ERROR: %s", message->valuestring);
-            strncpy(resp->error, message->valuestring, GEMINI_MAX_ERROR_LEN - 1);
-        }
-        cJSON *code = cJSON_GetObjectItem(error, "code");
-        if (code && cJSON_IsNumber(code)) {
-            GEMINI_LOG("API ERROR code: %d", code->valueint);
-            if (code->valueint == 401 || code->valueint == 403) {
-                resp->result_type = GEMINI_RESULT_INVALID_KEY;
-            } else if (code->valueint == 429) {
-                resp->result_type = GEMINI_RESULT_RATE_LIMIT;
-            } else {
-                resp->result_type = GEMINI_RESULT_ERROR;
-            }
-        } else {
-            resp->result_type = GEMINI_RESULT_ERROR;
-        }
-        cJSON_Delete(root);
+    HttpClient *http_client = http_client_create();
+    if (!http_client) {
+        GEMINI_LOG("ERROR: Failed to create HTTP client");
+        strncpy(resp->error, "Failed to create HTTP client", GEMINI_MAX_ERROR_LEN - 1);
+        resp->result_type = GEMINI_RESULT_ERROR;
         return false;
     }
+    http_client_set_timeout(http_client, 30, transfer_timeout);
 
-    // Navigate: candidates[0].content.parts[*].inlineData
-    cJSON *candidates = cJSON_GetObjectItem(root, "candidates");
-    if (!candidates || !cJSON_IsArray(candidates) || cJSON_GetArraySize(candidates) == 0) {
-        GEMINI_LOG("ERROR: No candidates in response");
-        strncpy(resp->error, "No candidates in response", GEMINI_MAX_ERROR_LEN - 1);
+    HttpRequest http_req;
+    http_request_init(&http_req);
+    http_request_set_method(&http_req, HTTP_POST);
+    http_request_set_url(&http_req, url);
+    http_request_add_header(&http_req, "Content-Type", "application/json");
+    http_request_add_header(&http_req, "x-goog-api-key", client->api_key);
+    http_request_set_body_reader(&http_req, read_request_body, body, json_writer_length(body));
+
+    GeminiParse *parse = (GeminiParse *)calloc(1, sizeof(GeminiParse));
+    JsonReader *reader = (JsonReader *)malloc(sizeof(JsonReader));
+    if (!parse || !reader) {
+        free(parse);
+        free(reader);
+        http_request_cleanup(&http_req);
+        http_client_destroy(http_client);
+        strncpy(resp->error, "Out of memory", GEMINI_MAX_ERROR_LEN - 1);
         resp->result_type = GEMINI_RESULT_ERROR;
-        cJSON_Delete(root);
         return false;
     }
+    parse->resp = resp;
+    parse->candidate = -1;
+    json_reader_init(reader, on_response_event, parse);
 
-    GEMINI_LOG("Found %d candidates", cJSON_GetArraySize(candidates));
-    cJSON *candidate = cJSON_GetArrayItem(candidates, 0);
-
-    // Check for content filtering
-    cJSON *finish_reason = cJSON_GetObjectItem(candidate, "finishReason");
-    if (finish_reason && cJSON_IsString(finish_reason)) {
-        GEMINI_LOG("Finish reason: %s", finish_reason->valuestring);
-        if (strcmp(finish_reason->valuestring, "SAFETY") == 0 ||
-            strcmp(finish_reason->valuestring, "BLOCKED") == 0) {
-            GEMINI_LOG("ERROR: Content blocked by safety filters");
-            strncpy(resp->error, "Content was blocked by safety filters", GEMINI_MAX_ERROR_LEN - 1);
-            resp->result_type = GEMINI_RESULT_CONTENT_FILTERED;
-            cJSON_Delete(root);
+    if (output_dir && output_dir[0]) {
+        parse->file = open_image_file(output_dir, resp->image_path, sizeof(resp->image_path));
+        if (!parse->file) {
+            GEMINI_LOG("ERROR: Cannot create an image file in %s", output_dir);
+            snprintf(resp->error, sizeof(resp->error), "Cannot write to %s", output_dir);
+            resp->result_type = GEMINI_RESULT_ERROR;
+            free(parse);
+            free(reader);
+            http_request_cleanup(&http_req);
+            http_client_destroy(http_client);
             return false;
         }
     }
 
-    cJSON *content = cJSON_GetObjectItem(candidate, "content");
-    cJSON *parts = content ? cJSON_GetObjectItem(content, "parts") : NULL;
-
-    if (!parts || !cJSON_IsArray(parts)) {
-        GEMINI_LOG("ERROR: No parts in response (content=%p, parts=%p)", (void*)content, (void*)parts);
-        strncpy(resp->error, "No parts in response", GEMINI_MAX_ERROR_LEN - 1);
-        resp->result_type = GEMINI_RESULT_ERROR;
-        cJSON_Delete(root);
-        return false;
-    }
+    HttpResponse http_resp;
+    http_response_init(&http_resp);
 
-    // Find inlineData in parts
-    int parts_count = cJSON_GetArraySize(parts);
-    GEMINI_LOG("Found %d parts in response", parts_count);
+    GEMINI_LOG("Sending HTTP request...");
+    // Image requests are always asked for by someone waiting on them
+    bool success = api_scheduler_execute_sink(API_PROVIDER_GEMINI, API_PRIORITY_INTERACTIVE, http_client,
+                                              &http_req, on_response_body, reader, &http_resp);
+    http_request_cleanup(&http_req);
+    http_client_destroy(http_client);
 
-    for (int i = 0; i < parts_count; i++) {
-        cJSON *p = cJSON_GetArrayItem(parts, i);
-        cJSON *inline_data = cJSON_GetObjectItem(p, "inlineData");
+    GEMINI_LOG("HTTP request complete, success=%d, status=%d", success, http_resp.status_code);
 
-        // Log what's in this part
-        cJSON *text_part = cJSON_GetObjectItem(p, "text");
-        if (text_part && cJSON_IsString(text_part)) {
-            GEMINI_LOG("Part %d: text=%.100s%s", i, text_part->valuestring,
-                       strlen(text_part->valuestring) > 100 ? "..." : "");
-        }
-
-        if (inline_data) {
-            GEMINI_LOG("Part %d: found inlineData", i);
-            cJSON *mime = cJSON_GetObjectItem(inline_data, "mimeType");
-            cJSON *data = cJSON_GetObjectItem(inline_data, "data");
-
-            if (mime && cJSON_IsString(mime) && data && cJSON_IsString(data)) {
-                GEMINI_LOG("Part %d: mimeType=%s, data length=%zu", i,
-                           mime->valuestring, strlen(data->valuestring));
-
-                strncpy(resp->mime_type, mime->valuestring, sizeof(resp->mime_type) - 1);
-                resp->format = gemini_format_from_mime(mime->valuestring);
-
-                // Decode base64
-                resp->image_size = base64_decode(data->valuestring, &resp->image_data);
-                GEMINI_LOG("Decoded image size: %zu bytes", resp->image_size);
-
-                if (resp->image_size > 0 && resp->image_data) {
-                    resp->result_type = GEMINI_RESULT_SUCCESS;
-                    GEMINI_LOG("SUCCESS: Image decoded successfully");
-                    cJSON_Delete(root);
-                    return true;
-                } else {
-                    GEMINI_LOG("ERROR: Base64 decode failed or empty");
-                }
-            } else {
-                GEMINI_LOG("Part %d: inlineData missing mime or data", i);
-            }
-        }
+    if (!success && !reader->failed) {
+        GEMINI_LOG("ERROR: HTTP request failed: %s", http_resp.error ? http_resp.error : "unknown");
+        snprintf(resp->error, sizeof(resp->error), "HTTP request failed: %s",
+                 http_resp.error ? http_resp.error : "unknown");
+        resp->result_type = GEMINI_RESULT_ERROR;
+    } else if (http_resp.status_code == 401 || http_resp.status_code == 403) {
+        GEMINI_LOG("ERROR: Invalid API key (HTTP %d)", http_resp.status_code);
+        strncpy(resp->error, "Invalid API key", GEMINI_MAX_ERROR_LEN - 1);
+        resp->result_type = GEMINI_RESULT_INVALID_KEY;
+        success = false;
+    } else if (http_resp.status_code == 429) {
+        GEMINI_LOG("ERROR: Rate limit exceeded");
+        strncpy(resp->error, "Rate limit exceeded", GEMINI_MAX_ERROR_LEN - 1);
+        resp->result_type = GEMINI_RESULT_RATE_LIMIT;
+        success = false;
+    } else if (http_resp.status_code != 200) {
+        GEMINI_LOG("ERROR: HTTP error %d", http_resp.status_code);
+        snprintf(resp->error, sizeof(resp->error), "HTTP error: %d", http_resp.status_code);
+        resp->result_type = GEMINI_RESULT_ERROR;
+        success = false;
+    } else {
+        success = gemini_parse_finish(parse, json_reader_finish(reader));
     }
 
-    GEMINI_LOG("ERROR: No image data found in any part");
-    strncpy(resp->error, "No image data in response", GEMINI_MAX_ERROR_LEN - 1);
-    resp->result_type = GEMINI_RESULT_ERROR;
-    cJSON_Delete(root);
-    return false;
+    http_response_cleanup(&http_resp);
+    if (parse->file) {
+        fclose(parse->file);
+    }
+    if (!success && resp->image_path[0]) {
+        unlink(resp->image_path);
+        resp->image_path[0] = '\0';
+    }
+    free(parse->data);
+    free(parse);
+    free(reader);
+    return success;
 }
 
-bool gemini_save_image(const GeminiImageResponse *resp, const char *path)
+bool gemini_save_image(GeminiImageResponse *resp, const char *path)
 {
-    if (!resp || !resp->image_data || resp->image_size == 0 || !path) {
+    if (!resp || !path) {
+        return false;
+    }
+    if (resp->image_path[0]) {
+        // Decoded to disk already: move it into place
+        if (rename(resp->image_path, path) != 0) return false;
+        resp->image_path[0] = '\0';
+        return true;
+    }
+    if (!resp->image_data || resp->image_size == 0) {
         return false;
     }
 
@@ -625,6 +730,13 @@ void gemini_edit_request_set_model(GeminiImageEditRequest *req, const char *mode
     req->model[GEMINI_MAX_MODEL_LEN - 1] = '\0';
 }
 
+void gemini_edit_request_set_output_dir(GeminiImageEditRequest *req, const char *dir)
+{
+    if (!req || !dir) return;
+    strncpy(req->output_dir, dir, GEMINI_MAX_PATH_LEN - 1);
+    req->output_dir[GEMINI_MAX_PATH_LEN - 1] = '\0';
+}
+
 bool gemini_edit_image(GeminiClient *client,
                        const GeminiImageEditRequest *req,
                        GeminiImageResponse *resp)
@@ -659,34 +771,17 @@ bool gemini_edit_image(GeminiClient *client,
         return false;
     }
 
-    // Read source image
-    size_t image_size = 0;
-    unsigned char *image_data = read_file_binary(req->source_image_path, &image_size);
-    if (!image_data) {
+    // The source image, downsized for upload (usually prepared while the prompt was typed);
+    // the writer encodes it straight into the upload buffer
+    ImageUpload *image = image_upload_acquire(req->source_image_path);
+    if (!image) {
         GEMINI_LOG("ERROR: Could not read source image: %s", req->source_image_path);
         strncpy(resp->error, "Could not read source image", GEMINI_MAX_ERROR_LEN - 1);
         resp->result_type = GEMINI_RESULT_ERROR;
         return false;
     }
 
-    GEMINI_LOG("Read source image: %zu bytes", image_size);
-
-    // Base64 encode the image
-    char *base64_image = base64_encode(image_data, image_size);
-    free(image_data);
-
-    if (!base64_image) {
-        GEMINI_LOG("ERROR: Base64 encoding failed");
-        strncpy(resp->error, "Failed to encode source image", GEMINI_MAX_ERROR_LEN - 1);
-        resp->result_type = GEMINI_RESULT_ERROR;
-        return false;
-    }
-
-    GEMINI_LOG("Base64 encoded image: %zu chars", strlen(base64_image));
-
-    // Get MIME type
-    const char *mime_type = get_mime_from_extension(req->source_image_path);
-    GEMINI_LOG("Source image MIME type: %s", mime_type);
+    GEMINI_LOG("Source image payload: %zu bytes, %s", image->size, image->mime_type);
 
     // Build URL
     char url[512];
@@ -694,119 +789,43 @@ bool gemini_edit_image(GeminiClient *client,
     snprintf(url, sizeof(url), "%s/%s:generateContent", GEMINI_API_BASE_URL, model);
     GEMINI_LOG("URL: %s", url);
 
-    // Build request body with image and text
-    cJSON *root = cJSON_CreateObject();
-    cJSON *contents = cJSON_CreateArray();
-    cJSON *content = cJSON_CreateObject();
-    cJSON *parts = cJSON_CreateArray();
-
-    // Add image part first
-    cJSON *image_part = cJSON_CreateObject();
-    cJSON *inline_data = cJSON_CreateObject();
-    cJSON_AddStringToObject(inline_data, "mimeType", mime_type);
-    cJSON_AddStringToObject(inline_data, "data", base64_image);
-    cJSON_AddItemToObject(image_part, "inlineData", inline_data);
-    cJSON_AddItemToArray(parts, image_part);
-
-    // Add text prompt
-    cJSON *text_part = cJSON_CreateObject();
-    cJSON_AddStringToObject(text_part, "text", req->prompt);
-    cJSON_AddItemToArray(parts, text_part);
-
-    cJSON_AddItemToObject(content, "parts", parts);
-    cJSON_AddItemToArray(contents, content);
-    cJSON_AddItemToObject(root, "contents", contents);
-
-    // Add generation config for image output
-    cJSON *gen_config = cJSON_CreateObject();
-    cJSON *modalities = cJSON_CreateArray();
-    cJSON_AddItemToArray(modalities, cJSON_CreateString("TEXT"));
-    cJSON_AddItemToArray(modalities, cJSON_CreateString("IMAGE"));
-    cJSON_AddItemToObject(gen_config, "responseModalities", modalities);
-    cJSON_AddItemToObject(root, "generationConfig", gen_config);
-
-    char *request_body = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    free(base64_image);
-
-    if (!request_body) {
-        GEMINI_LOG("ERROR: Failed to build request JSON");
-        strncpy(resp->error, "Failed to build request JSON", GEMINI_MAX_ERROR_LEN - 1);
-        resp->result_type = GEMINI_RESULT_ERROR;
-        return false;
-    }
-
-    GEMINI_LOG("Request body length: %zu", strlen(request_body));
-
-    // Make HTTP request
-    HttpClient *http_client = http_client_create();
-    if (!http_client) {
-        GEMINI_LOG("ERROR: Failed to create HTTP client");
-        strncpy(resp->error, "Failed to create HTTP client", GEMINI_MAX_ERROR_LEN - 1);
-        resp->result_type = GEMINI_RESULT_ERROR;
-        free(request_body);
-        return false;
-    }
-
-    // Set longer timeout for image editing (90 seconds)
-    http_client_set_timeout(http_client, 30, 90);
-
-    HttpRequest http_req;
-    http_request_init(&http_req);
-    http_request_set_method(&http_req, HTTP_POST);
-    http_request_set_url(&http_req, url);
-    http_request_add_header(&http_req, "Content-Type", "application/json");
-    http_request_add_header(&http_req, "x-goog-api-key", client->api_key);
-    http_request_set_body_string(&http_req, request_body);
-    free(request_body);
-
-    HttpResponse http_resp;
-    http_response_init(&http_resp);
-
-    GEMINI_LOG("Sending HTTP request...");
-    bool success = http_client_execute(http_client, &http_req, &http_resp);
-    http_request_cleanup(&http_req);
-    http_client_destroy(http_client);
-
-    GEMINI_LOG("HTTP request complete, success=%d", success);
-
-    if (!success) {
-        GEMINI_LOG("ERROR: HTTP request failed: %s", http_resp.error ? http_resp.error : "unknown");
-        snprintf(resp->error, sizeof(resp->error), "HTTP request failed: %s",
-                 http_resp.error ? http_resp.error : "unknown");
-        resp->result_type = GEMINI_RESULT_ERROR;
-        http_response_cleanup(&http_resp);
-        return false;
-    }
-
-    GEMINI_LOG("HTTP status code: %d", http_resp.status_code);
-
-    // Check HTTP status
-    if (http_resp.status_code == 401 || http_resp.status_code == 403) {
-        strncpy(resp->error, "Invalid API key", GEMINI_MAX_ERROR_LEN - 1);
-        resp->result_type = GEMINI_RESULT_INVALID_KEY;
-        http_response_cleanup(&http_resp);
-        return false;
-    }
-
-    if (http_resp.status_code == 429) {
-        strncpy(resp->error, "Rate limit exceeded", GEMINI_MAX_ERROR_LEN - 1);
-        resp->result_type = GEMINI_RESULT_RATE_LIMIT;
-        http_response_cleanup(&http_resp);
-        return false;
-    }
-
-    if (http_resp.status_code != 200) {
-        snprintf(resp->error, sizeof(resp->error), "HTTP error: %d", http_resp.status_code);
-        resp->result_type = GEMINI_RESULT_ERROR;
-        http_response_cleanup(&http_resp);
-        return false;
-    }
-
-    // Parse response
-    GEMINI_LOG("Parsing response...");
-    success = gemini_parse_image_response(http_resp.body, resp);
-    http_response_cleanup(&http_resp);
+    // Build request body: image part first, then the text prompt
+    JsonWriter body;
+    json_writer_init(&body);
+    json_writer_begin_object(&body);
+    json_writer_key(&body, "contents");
+    json_writer_begin_array(&body);
+    json_writer_begin_object(&body);
+    json_writer_key(&body, "parts");
+    json_writer_begin_array(&body);
+
+    json_writer_begin_object(&body);
+    json_writer_key(&body, "inlineData");
+    json_writer_begin_object(&body);
+    json_writer_key(&body, "mimeType");
+    json_writer_string(&body, image->mime_type);
+    json_writer_key(&body, "data");
+    json_writer_base64(&body, image->data, image->size);
+    json_writer_end_object(&body);
+    json_writer_end_object(&body);
+
+    json_writer_begin_object(&body);
+    json_writer_key(&body, "text");
+    json_writer_string(&body, req->prompt);
+    json_writer_end_object(&body);
+
+    json_writer_end_array(&body);
+    json_writer_end_object(&body);
+    json_writer_end_array(&body);
+    write_generation_config(&body);
+    json_writer_end_object(&body);
+
+    GEMINI_LOG("Request body length: %zu", json_writer_length(&body));
+
+    // Longer timeout for image editing (90 seconds)
+    bool success = gemini_send(client, url, &body, 90, req->output_dir, resp);
+    json_writer_free(&body);
+    image_upload_release(image);
 
     GEMINI_LOG("=== gemini_edit_image END (success=%d) ===", success);
     return success;
@@ -43,6 +43,7 @@ typedef struct GeminiImageEditRequest {
     char model[GEMINI_MAX_MODEL_LEN];
     char prompt[GEMINI_MAX_PROMPT_LEN];
     char source_image_path[GEMINI_MAX_PATH_LEN];
+    char output_dir[GEMINI_MAX_PATH_LEN];   // See GeminiImageRequest
 } GeminiImageEditRequest;
 
 // Image generation request
@@ -52,6 +53,9 @@ typedef struct GeminiImageRequest {
     // Reserved for future API features (not yet supported by Gemini)
     int width;
     int height;
+    // Folder the image is decoded into as it arrives (GeminiImageResponse.image_path);
+    // empty keeps it in memory (image_data)
+    char output_dir[GEMINI_MAX_PATH_LEN];
 } GeminiImageRequest;
 
 // Image generation response
@@ -59,6 +63,9 @@ typedef struct GeminiImageResponse {
     GeminiResultType result_type;
     unsigned char *image_data;
     size_t image_size;
+    char image_path[GEMINI_MAX_PATH_LEN];   // Hidden temporary file holding the image, when
+                                            // decoded to disk; gemini_save_image moves it
+                                            // into place and cleanup deletes it otherwise
     GeminiImageFormat format;
     char mime_type[64];
     char error[GEMINI_MAX_ERROR_LEN];
@@ -81,6 +88,7 @@ void gemini_client_set_model(GeminiClient *client, const char *model);
 void gemini_request_init(GeminiImageRequest *req);
 void gemini_request_set_prompt(GeminiImageRequest *req, const char *prompt);
 void gemini_request_set_model(GeminiImageRequest *req, const char *model);
+void gemini_request_set_output_dir(GeminiImageRequest *req, const char *dir);
 
 // Response functions
 void gemini_response_init(GeminiImageResponse *resp);
@@ -96,6 +104,7 @@ void gemini_edit_request_init(GeminiImageEditRequest *req);
 void gemini_edit_request_set_prompt(GeminiImageEditRequest *req, const char *prompt);
 void gemini_edit_request_set_source_image(GeminiImageEditRequest *req, const char *path);
 void gemini_edit_request_set_model(GeminiImageEditRequest *req, const char *model);
+void gemini_edit_request_set_output_dir(GeminiImageEditRequest *req, const char *dir);
 
 // Edit image (takes source image and edit prompt, outputs edited image)
 bool gemini_edit_image(GeminiClient *client,
@@ -105,8 +114,9 @@ bool gemini_edit_image(GeminiClient *client,
 // Generate versioned output path (e.g., image.png -> image_edited_1.png)
 bool gemini_generate_edited_path(const char *source_path, char *output_path, size_t output_size);
 
-// Save image to file
-bool gemini_save_image(const GeminiImageResponse *resp, const char *path);
+// Save image to file (an image decoded to disk is renamed there, so path must be on the
+// same volume as the output folder)
+bool gemini_save_image(GeminiImageResponse *resp, const char *path);
 
 // Utility functions
 const char *gemini_result_to_string(GeminiResultType result);
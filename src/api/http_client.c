@@ -1,26 +1,130 @@
 #include "http_client.h"
+#include "../utils/perf.h"
+#include "../utils/trace.h"
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
+#include <pthread.h>
 #include <curl/curl.h>
 
+// Process-wide connection state. Callers make a client per call, so connections, TLS
+// sessions and DNS answers live here rather than in HttpClient. Each pooled easy handle
+// keeps its own live connections between requests; sessions and DNS are shared by all
+// of them through the share handle (connections themselves are not, as curl cannot share
+// those between threads safely)
+static struct {
+    pthread_mutex_t mutex;                  // Guards everything below
+    bool ready;                             // curl_global_init done and share made
+    CURLSH *share;
+    pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+    CURL *idle[HTTP_POOL_SIZE];             // Handles free for the next request
+    int idle_count;
+} g_http = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+static void share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userp)
+{
+    (void)handle;
+    (void)access;
+    (void)userp;
+    pthread_mutex_lock(&g_http.share_locks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userp)
+{
+    (void)handle;
+    (void)userp;
+    pthread_mutex_unlock(&g_http.share_locks[data]);
+}
+
+// Helper: initialize curl and the share handle once (call with mutex held)
+static bool http_global_init_locked(void)
+{
+    if (g_http.ready) {
+        return true;
+    }
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+        return false;
+    }
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&g_http.share_locks[i], NULL);
+    }
+    g_http.share = curl_share_init();
+    if (g_http.share) {
+        curl_share_setopt(g_http.share, CURLSHOPT_LOCKFUNC, share_lock);
+        curl_share_setopt(g_http.share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+        curl_share_setopt(g_http.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(g_http.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+    g_http.idle_count = 0;
+    g_http.ready = true;
+    return true;
+}
+
+// Helper: an idle pooled handle, or a new one; NULL on failure
+static CURL *http_handle_acquire(void)
+{
+    pthread_mutex_lock(&g_http.mutex);
+    CURL *curl = NULL;
+    if (g_http.ready) {
+        curl = g_http.idle_count > 0 ? g_http.idle[--g_http.idle_count] : curl_easy_init();
+    }
+    pthread_mutex_unlock(&g_http.mutex);
+    return curl;
+}
+
+// Helper: return a handle to the pool with its connections open, or close it when the
+// pool is full
+static void http_handle_release(CURL *curl)
+{
+    // Drops the request's options but keeps live connections and caches
+    curl_easy_reset(curl);
+
+    pthread_mutex_lock(&g_http.mutex);
+    if (g_http.ready && g_http.idle_count < HTTP_POOL_SIZE) {
+        g_http.idle[g_http.idle_count++] = curl;
+        curl = NULL;
+    }
+    pthread_mutex_unlock(&g_http.mutex);
+
+    if (curl) {
+        curl_easy_cleanup(curl);
+    }
+}
+
 typedef struct ResponseBuffer {
     char *data;
     size_t size;
     size_t capacity;
 } ResponseBuffer;
 
-static size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp)
+// Where a response body goes: the buffer, or for a streamed 2xx response the feed
+typedef struct ResponseSink {
+    ResponseBuffer buffer;
+    ResponseBuffer headers;
+    HttpBodyFn feed;
+    void *feed_context;
+    CURL *curl;
+    int streaming;                  // -1 until the status is known, then 0 or 1
+    bool stopped;                   // The feed returned false
+} ResponseSink;
+
+// Where an uploaded body comes from when it is produced on demand
+typedef struct RequestSource {
+    const HttpRequest *req;
+    size_t offset;
+} RequestSource;
+
+static size_t buffer_append(ResponseBuffer *buf, const void *contents, size_t real_size)
 {
-    size_t real_size = size * nmemb;
-    ResponseBuffer *buf = (ResponseBuffer *)userp;
 
     if (buf->size + real_size + 1 > buf->capacity) {
         size_t new_capacity = buf->capacity * 2;
         if (new_capacity < buf->size + real_size + 1) {
             new_capacity = buf->size + real_size + 1;
         }
-        char *new_data = (char *)realloc(buf->data, new_capacity);
+        char *new_data = (char *)memory_realloc(MEMORY_TAG_NETWORK, buf->data, new_capacity);
         if (!new_data) {
             return 0;
         }
@@ -35,13 +139,99 @@ static size_t write_callback(void *contents, size_t size, size_t nmemb, void *us
     return real_size;
 }
 
+static size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp)
+{
+    size_t real_size = size * nmemb;
+    ResponseSink *sink = (ResponseSink *)userp;
+
+    if (sink->streaming < 0) {
+        // Headers are in by the first body bytes; errors arrive as one JSON body
+        long http_code = 0;
+        curl_easy_getinfo(sink->curl, CURLINFO_RESPONSE_CODE, &http_code);
+        sink->streaming = sink->feed && http_code >= 200 && http_code < 300;
+    }
+    if (sink->streaming) {
+        // Returning short aborts the transfer
+        if (!sink->feed(sink->feed_context, (const char *)contents, real_size)) {
+            sink->stopped = true;
+            return 0;
+        }
+        return real_size;
+    }
+    return buffer_append(&sink->buffer, contents, real_size);
+}
+
+static size_t header_callback(char *contents, size_t size, size_t nitems, void *userp)
+{
+    size_t real_size = size * nitems;
+    ResponseBuffer *headers = &((ResponseSink *)userp)->headers;
+
+    // Each response (after a redirect or a 100 Continue) starts over at its status line
+    if (real_size >= 5 && strncmp(contents, "HTTP/", 5) == 0) {
+        headers->size = 0;
+        return real_size;
+    }
+    if (!headers->data) {
+        headers->capacity = 1024;
+        headers->data = (char *)malloc(headers->capacity);
+        if (!headers->data) return 0;
+    }
+    if (headers->size + real_size + 1 > headers->capacity) {
+        size_t new_capacity = headers->capacity * 2;
+        while (new_capacity < headers->size + real_size + 1) new_capacity *= 2;
+        char *grown = (char *)realloc(headers->data, new_capacity);
+        if (!grown) return 0;
+        headers->data = grown;
+        headers->capacity = new_capacity;
+    }
+    memcpy(headers->data + headers->size, contents, real_size);
+    headers->size += real_size;
+    headers->data[headers->size] = '\0';
+    return real_size;
+}
+
+static size_t read_callback(char *buffer, size_t size, size_t nitems, void *userp)
+{
+    RequestSource *source = (RequestSource *)userp;
+    const HttpRequest *req = source->req;
+    if (source->offset >= req->body_len) return 0;
+
+    size_t want = size * nitems;
+    if (want > req->body_len - source->offset) {
+        want = req->body_len - source->offset;
+    }
+    size_t got = req->body_reader(req->body_context, source->offset, buffer, want);
+    if (got == 0) return CURL_READFUNC_ABORT;
+    source->offset += got;
+    return got;
+}
+
+// Redirects and retries rewind the upload
+static int seek_callback(void *userp, curl_off_t offset, int origin)
+{
+    RequestSource *source = (RequestSource *)userp;
+    if (origin != SEEK_SET || offset < 0 || (size_t)offset > source->req->body_len) {
+        return CURL_SEEKFUNC_CANTSEEK;
+    }
+    source->offset = (size_t)offset;
+    return CURL_SEEKFUNC_OK;
+}
+
+// Helper: adapt the SSE parser to a body feed
+static bool sse_body_feed(void *context, const char *bytes, size_t len)
+{
+    return http_sse_feed((HttpSseParser *)context, bytes, len);
+}
+
 HttpClient *http_client_create(void)
 {
     HttpClient *client = (HttpClient *)calloc(1, sizeof(HttpClient));
     if (!client) return NULL;
 
-    CURLcode res = curl_global_init(CURL_GLOBAL_DEFAULT);
-    if (res != CURLE_OK) {
+    pthread_mutex_lock(&g_http.mutex);
+    bool ready = http_global_init_locked();
+    pthread_mutex_unlock(&g_http.mutex);
+    if (!ready) {
         free(client);
         return NULL;
     }
@@ -55,12 +245,29 @@ HttpClient *http_client_create(void)
 
 void http_client_destroy(HttpClient *client)
 {
-    if (client) {
-        if (client->initialized) {
-            curl_global_cleanup();
+    // Connections stay pooled for the next client
+    free(client);
+}
+
+void http_client_shutdown(void)
+{
+    pthread_mutex_lock(&g_http.mutex);
+    if (g_http.ready) {
+        for (int i = 0; i < g_http.idle_count; i++) {
+            curl_easy_cleanup(g_http.idle[i]);
         }
-        free(client);
+        g_http.idle_count = 0;
+        if (g_http.share) {
+            curl_share_cleanup(g_http.share);
+            g_http.share = NULL;
+        }
+        for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+            pthread_mutex_destroy(&g_http.share_locks[i]);
+        }
+        curl_global_cleanup();
+        g_http.ready = false;
     }
+    pthread_mutex_unlock(&g_http.mutex);
 }
 
 void http_client_set_timeout(HttpClient *client, long connect_timeout, long transfer_timeout)
@@ -81,10 +288,12 @@ void http_request_cleanup(HttpRequest *req)
 {
     if (!req) return;
     if (req->body) {
-        free(req->body);
+        memory_free(MEMORY_TAG_NETWORK, req->body);
         req->body = NULL;
     }
     req->body_len = 0;
+    req->body_reader = NULL;
+    req->body_context = NULL;
 }
 
 void http_request_set_method(HttpRequest *req, HttpMethod method)
@@ -114,12 +323,14 @@ void http_request_set_body(HttpRequest *req, const char *body, size_t len)
     if (!req) return;
 
     if (req->body) {
-        free(req->body);
+        memory_free(MEMORY_TAG_NETWORK, req->body);
         req->body = NULL;
     }
+    req->body_len = 0;
+    req->body_reader = NULL;
 
     if (body && len > 0) {
-        req->body = (char *)malloc(len + 1);
+        req->body = (char *)memory_alloc(MEMORY_TAG_NETWORK, len + 1);
         if (req->body) {
             memcpy(req->body, body, len);
             req->body[len] = '\0';
@@ -134,6 +345,15 @@ void http_request_set_body_string(HttpRequest *req, const char *body)
     http_request_set_body(req, body, strlen(body));
 }
 
+void http_request_set_body_reader(HttpRequest *req, HttpBodyReadFn reader, void *context, size_t len)
+{
+    if (!req) return;
+    http_request_set_body(req, NULL, 0);
+    req->body_reader = reader;
+    req->body_context = context;
+    req->body_len = reader ? len : 0;
+}
+
 void http_response_init(HttpResponse *resp)
 {
     if (!resp) return;
@@ -144,18 +364,63 @@ void http_response_cleanup(HttpResponse *resp)
 {
     if (!resp) return;
     if (resp->body) {
-        free(resp->body);
+        memory_free(MEMORY_TAG_NETWORK, resp->body);
         resp->body = NULL;
     }
     if (resp->error) {
         free(resp->error);
         resp->error = NULL;
     }
+    free(resp->headers);
+    resp->headers = NULL;
     resp->status_code = 0;
     resp->body_len = 0;
 }
 
-bool http_client_execute(HttpClient *client, const HttpRequest *req, HttpResponse *resp)
+bool http_response_header(const HttpResponse *resp, const char *name, char *value, size_t size)
+{
+    if (!resp || !resp->headers || !name || !value || size == 0) return false;
+
+    size_t name_len = strlen(name);
+    for (const char *line = resp->headers; *line; ) {
+        const char *end = strchr(line, '\n');
+        if (!end) end = line + strlen(line);
+        if ((size_t)(end - line) > name_len && line[name_len] == ':' && strncasecmp(line, name, name_len) == 0) {
+            const char *start = line + name_len + 1;
+            while (start < end && (*start == ' ' || *start == '\t')) start++;
+            const char *stop = end;
+            while (stop > start && (stop[-1] == '\r' || stop[-1] == ' ' || stop[-1] == '\t')) stop--;
+            size_t len = (size_t)(stop - start) < size - 1 ? (size_t)(stop - start) : size - 1;
+            memcpy(value, start, len);
+            value[len] = '\0';
+            return true;
+        }
+        line = *end ? end + 1 : end;
+    }
+    return false;
+}
+
+// Helper: attach the request body, copied in by curl or read from the request's reader
+static void http_set_body(CURL *curl, const HttpRequest *req, RequestSource *source)
+{
+    if (req->body_len == 0) return;
+    if (req->body_reader) {
+        // Read into curl's upload buffer as it sends, so the body is never held whole
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_callback);
+        curl_easy_setopt(curl, CURLOPT_READDATA, source);
+        curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, seek_callback);
+        curl_easy_setopt(curl, CURLOPT_SEEKDATA, source);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)req->body_len);
+    } else if (req->body) {
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req->body);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)req->body_len);
+    }
+}
+
+// Helper: run the request, streaming a 2xx body into feed when there is one
+static bool http_perform(HttpClient *client, const HttpRequest *req, HttpBodyFn feed, void *feed_context,
+                         HttpResponse *resp)
 {
     if (!client || !req || !resp) return false;
     if (!client->initialized) {
@@ -163,47 +428,56 @@ bool http_client_execute(HttpClient *client, const HttpRequest *req, HttpRespons
         return false;
     }
 
-    CURL *curl = curl_easy_init();
+    CURL *curl = http_handle_acquire();
     if (!curl) {
         resp->error = strdup("Failed to initialize curl");
         return false;
     }
 
-    ResponseBuffer buffer = {0};
-    buffer.capacity = 4096;
-    buffer.data = (char *)malloc(buffer.capacity);
-    if (!buffer.data) {
-        curl_easy_cleanup(curl);
+    ResponseSink sink = { .feed = feed, .feed_context = feed_context, .curl = curl, .streaming = -1 };
+    RequestSource source = { .req = req, .offset = 0 };
+    ResponseBuffer *buffer = &sink.buffer;
+    buffer->capacity = 4096;
+    buffer->data = (char *)memory_alloc(MEMORY_TAG_NETWORK, buffer->capacity);
+    if (!buffer->data) {
+        http_handle_release(curl);
         resp->error = strdup("Failed to allocate response buffer");
         return false;
     }
-    buffer.data[0] = '\0';
+    buffer->data[0] = '\0';
 
     curl_easy_setopt(curl, CURLOPT_URL, req->url);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sink);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &sink);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, client->timeout_transfer);
     curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, client->timeout_connect);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
     curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 5L);
 
+    // Keep the connection for the next request: HTTP/2 over TLS where the server offers
+    // it, TCP keep-alive so idle pooled connections survive, shared DNS and TLS sessions
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, HTTP_KEEPALIVE_IDLE);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, HTTP_KEEPALIVE_IDLE);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    if (g_http.share) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, g_http.share);
+    }
+
     // Set HTTP method
     switch (req->method) {
         case HTTP_GET:
             break;
         case HTTP_POST:
             curl_easy_setopt(curl, CURLOPT_POST, 1L);
-            if (req->body && req->body_len > 0) {
-                curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req->body);
-                curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)req->body_len);
-            }
+            http_set_body(curl, req, &source);
             break;
         case HTTP_PUT:
             curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
-            if (req->body && req->body_len > 0) {
-                curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req->body);
-                curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)req->body_len);
-            }
+            http_set_body(curl, req, &source);
             break;
         case HTTP_DELETE:
             curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
@@ -223,10 +497,12 @@ bool http_client_execute(HttpClient *client, const HttpRequest *req, HttpRespons
     CURLcode res = curl_easy_perform(curl);
 
     if (res != CURLE_OK) {
-        resp->error = strdup(curl_easy_strerror(res));
-        free(buffer.data);
+        bool stopped = res == CURLE_WRITE_ERROR && sink.stopped;
+        resp->error = strdup(stopped ? "Stream stopped" : curl_easy_strerror(res));
+        memory_free(MEMORY_TAG_NETWORK, buffer->data);
+        free(sink.headers.data);
         if (headers) curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+        http_handle_release(curl);
         return false;
     }
 
@@ -234,15 +510,145 @@ bool http_client_execute(HttpClient *client, const HttpRequest *req, HttpRespons
     long http_code = 0;
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
     resp->status_code = (int)http_code;
-    resp->body = buffer.data;
-    resp->body_len = buffer.size;
+    resp->body = buffer->data;
+    resp->body_len = buffer->size;
+    resp->headers = sink.headers.data;
 
     if (headers) curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+    http_handle_release(curl);
+
+    return true;
+}
+
+bool http_client_execute(HttpClient *client, const HttpRequest *req, HttpResponse *resp)
+{
+    TRACE_SCOPE("http_client_execute");
+    return http_perform(client, req, NULL, NULL, resp);
+}
+
+bool http_client_execute_stream(HttpClient *client, const HttpRequest *req,
+                                HttpSseParser *parser, HttpResponse *resp)
+{
+    if (!parser) return false;
+    return http_perform(client, req, sse_body_feed, parser, resp);
+}
+
+bool http_client_execute_sink(HttpClient *client, const HttpRequest *req,
+                              HttpBodyFn on_body, void *context, HttpResponse *resp)
+{
+    if (!on_body) return false;
+    return http_perform(client, req, on_body, context, resp);
+}
+
+void http_sse_init(HttpSseParser *parser, HttpSseEventFn on_event, void *context)
+{
+    if (!parser) return;
+    memset(parser, 0, sizeof(HttpSseParser));
+    parser->on_event = on_event;
+    parser->context = context;
+}
+
+void http_sse_cleanup(HttpSseParser *parser)
+{
+    if (!parser) return;
+    free(parser->line);
+    free(parser->data);
+    parser->line = NULL;
+    parser->data = NULL;
+    parser->line_len = parser->line_capacity = 0;
+    parser->data_len = parser->data_capacity = 0;
+}
 
+// Helper: grow a parser buffer to hold needed bytes
+static bool sse_reserve(char **buf, size_t *capacity, size_t needed)
+{
+    if (needed <= *capacity) return true;
+    size_t new_capacity = *capacity > 0 ? *capacity * 2 : 1024;
+    while (new_capacity < needed) new_capacity *= 2;
+    char *grown = (char *)realloc(*buf, new_capacity);
+    if (!grown) return false;
+    *buf = grown;
+    *capacity = new_capacity;
     return true;
 }
 
+// Helper: dispatch the event gathered so far (on a blank line)
+static void sse_dispatch(HttpSseParser *parser)
+{
+    if (parser->has_data && parser->on_event) {
+        const char *event = parser->event[0] ? parser->event : "message";
+        if (!parser->on_event(parser->context, event, parser->data)) {
+            parser->stopped = true;
+        }
+    }
+    parser->has_data = false;
+    parser->data_len = 0;
+    parser->event[0] = '\0';
+}
+
+// Helper: apply one complete line ("field: value", a comment, or blank)
+static void sse_line(HttpSseParser *parser, char *line, size_t len)
+{
+    if (len == 0) {
+        sse_dispatch(parser);
+        return;
+    }
+    if (line[0] == ':') return;
+
+    char *colon = memchr(line, ':', len);
+    size_t field_len = colon ? (size_t)(colon - line) : len;
+    const char *value = colon ? colon + 1 : line + len;
+    size_t value_len = len - (size_t)(value - line);
+    if (value_len > 0 && value[0] == ' ') {
+        value++;
+        value_len--;
+    }
+
+    if (field_len == 4 && strncmp(line, "data", 4) == 0) {
+        size_t needed = parser->data_len + value_len + 2;
+        if (!sse_reserve(&parser->data, &parser->data_capacity, needed)) {
+            parser->stopped = true;
+            return;
+        }
+        if (parser->has_data) {
+            parser->data[parser->data_len++] = '\n';
+        }
+        memcpy(parser->data + parser->data_len, value, value_len);
+        parser->data_len += value_len;
+        parser->data[parser->data_len] = '\0';
+        parser->has_data = true;
+    } else if (field_len == 5 && strncmp(line, "event", 5) == 0) {
+        size_t n = value_len < sizeof(parser->event) - 1 ? value_len : sizeof(parser->event) - 1;
+        memcpy(parser->event, value, n);
+        parser->event[n] = '\0';
+    }
+}
+
+bool http_sse_feed(HttpSseParser *parser, const char *bytes, size_t len)
+{
+    if (!parser) return false;
+
+    for (size_t i = 0; i < len && !parser->stopped; i++) {
+        char c = bytes[i];
+        if (c == '\n' && parser->after_cr) {
+            parser->after_cr = false;
+            continue;
+        }
+        parser->after_cr = c == '\r';
+        if (c == '\n' || c == '\r') {
+            sse_line(parser, parser->line, parser->line_len);
+            parser->line_len = 0;
+            continue;
+        }
+        if (!sse_reserve(&parser->line, &parser->line_capacity, parser->line_len + 1)) {
+            parser->stopped = true;
+            break;
+        }
+        parser->line[parser->line_len++] = c;
+    }
+    return !parser->stopped;
+}
+
 const char *http_method_to_string(HttpMethod method)
 {
     switch (method) {
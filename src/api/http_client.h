@@ -9,6 +9,8 @@
 #define HTTP_MAX_HEADER_LEN 512
 #define HTTP_TIMEOUT_CONNECT 30L
 #define HTTP_TIMEOUT_TRANSFER 120L
+#define HTTP_POOL_SIZE 4            // Idle connections kept open between requests
+#define HTTP_KEEPALIVE_IDLE 30L     // Seconds before an idle connection is probed
 
 typedef enum HttpMethod {
     HTTP_GET = 0,
@@ -17,32 +19,65 @@ typedef enum HttpMethod {
     HTTP_DELETE
 } HttpMethod;
 
+// Produces request body bytes [offset, offset + size) on demand; returns how many
+typedef size_t (*HttpBodyReadFn)(void *context, size_t offset, char *buffer, size_t size);
+
+// Receives a response body as it arrives. Return false to stop the transfer
+typedef bool (*HttpBodyFn)(void *context, const char *bytes, size_t len);
+
 typedef struct HttpRequest {
     HttpMethod method;
     char url[HTTP_MAX_URL_LEN];
     char headers[HTTP_MAX_HEADERS][HTTP_MAX_HEADER_LEN];
     int header_count;
     char *body;
-    size_t body_len;
+    size_t body_len;                // Also the total when body_reader is set
+    HttpBodyReadFn body_reader;     // Body sent from here instead of body, if set
+    void *body_context;
 } HttpRequest;
 
 typedef struct HttpResponse {
     int status_code;
-    char *body;
+    char *body;                     // MEMORY_TAG_NETWORK block, freed by http_response_cleanup
     size_t body_len;
+    char *headers;                  // Header lines of the final response ("Name: value\r\n" each)
     char *error;
 } HttpResponse;
 
+// Called for each complete server-sent event (event is "message" when the stream names
+// none). Return false to stop reading the stream
+typedef bool (*HttpSseEventFn)(void *context, const char *event, const char *data);
+
+// Incremental text/event-stream parser, fed the body as it arrives
+typedef struct HttpSseParser {
+    HttpSseEventFn on_event;
+    void *context;
+    char *line;                 // Current line, unterminated so far
+    size_t line_len;
+    size_t line_capacity;
+    bool after_cr;              // Last byte ended a line with '\r' (skip a following '\n')
+    char *data;                 // Data lines of the current event, joined by '\n'
+    size_t data_len;
+    size_t data_capacity;
+    bool has_data;
+    char event[64];
+    bool stopped;               // on_event returned false (or out of memory)
+} HttpSseParser;
+
 typedef struct HttpClient {
     bool initialized;
     long timeout_connect;
     long timeout_transfer;
 } HttpClient;
 
-// Create and destroy HTTP client
+// Create and destroy HTTP client. Connections outlive the client: they are pooled per
+// process, so the next request to the same host skips DNS, TCP and TLS setup
 HttpClient *http_client_create(void);
 void http_client_destroy(HttpClient *client);
 
+// Close pooled connections and release curl (call at exit, once no request is running)
+void http_client_shutdown(void);
+
 // Configure client
 void http_client_set_timeout(HttpClient *client, long connect_timeout, long transfer_timeout);
 
@@ -55,13 +90,37 @@ void http_request_add_header(HttpRequest *req, const char *name, const char *val
 void http_request_set_body(HttpRequest *req, const char *body, size_t len);
 void http_request_set_body_string(HttpRequest *req, const char *body);
 
+// Send a body of len bytes produced by reader while uploading, instead of a copy held in
+// the request. The reader may be asked for the same bytes again if curl rewinds
+void http_request_set_body_reader(HttpRequest *req, HttpBodyReadFn reader, void *context, size_t len);
+
 // Response functions
 void http_response_init(HttpResponse *resp);
 void http_response_cleanup(HttpResponse *resp);
 
+// Copy the value of the response header name (any case) into value; false if absent
+bool http_response_header(const HttpResponse *resp, const char *name, char *value, size_t size);
+
 // Execute request
 bool http_client_execute(HttpClient *client, const HttpRequest *req, HttpResponse *resp);
 
+// Execute request, feeding a 2xx response body to parser as it arrives instead of
+// keeping it; any other response is kept in resp->body as usual. False on transport
+// failure or when the parser stopped the stream
+bool http_client_execute_stream(HttpClient *client, const HttpRequest *req,
+                                HttpSseParser *parser, HttpResponse *resp);
+
+// Execute request, handing a 2xx response body to on_body as it arrives, as with
+// http_client_execute_stream
+bool http_client_execute_sink(HttpClient *client, const HttpRequest *req,
+                              HttpBodyFn on_body, void *context, HttpResponse *resp);
+
+// Server-sent events
+void http_sse_init(HttpSseParser *parser, HttpSseEventFn on_event, void *context);
+void http_sse_cleanup(HttpSseParser *parser);
+// Parse the next bytes of the stream; false once stopped
+bool http_sse_feed(HttpSseParser *parser, const char *bytes, size_t len);
+
 // Utility
 const char *http_method_to_string(HttpMethod method);
 
@@ -0,0 +1,257 @@
+#include "image_upload.h"
+#include "../platform/imageio.h"
+#include "../utils/jobs.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Process-wide cache; the entries are referenced by requests in flight, so an entry is
+// only evicted or freed once nothing holds it
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t prepared;        // An entry finished preparing
+    ImageUpload *entries[IMAGE_UPLOAD_CACHE_SIZE];
+    uint64_t clock;
+} g_uploads = { .mutex = PTHREAD_MUTEX_INITIALIZER, .prepared = PTHREAD_COND_INITIALIZER };
+
+const char *image_upload_mime_type(const char *path)
+{
+    if (!path) return "application/octet-stream";
+
+    const char *ext = strrchr(path, '.');
+    if (!ext) return "application/octet-stream";
+
+    ext++; // Skip the dot
+    if (strcasecmp(ext, "png") == 0) return "image/png";
+    if (strcasecmp(ext, "jpg") == 0 || strcasecmp(ext, "jpeg") == 0) return "image/jpeg";
+    if (strcasecmp(ext, "gif") == 0) return "image/gif";
+    if (strcasecmp(ext, "webp") == 0) return "image/webp";
+    if (strcasecmp(ext, "bmp") == 0) return "image/bmp";
+    if (strcasecmp(ext, "heic") == 0) return "image/heic";
+    if (strcasecmp(ext, "heif") == 0) return "image/heif";
+
+    return "application/octet-stream";
+}
+
+// Helper: Whether a file can be sent unchanged
+static bool can_pass_through(const char *mime_type, long long file_size)
+{
+    if (file_size > IMAGE_UPLOAD_PASSTHROUGH_BYTES) return false;
+    return strcmp(mime_type, "image/png") == 0 || strcmp(mime_type, "image/jpeg") == 0 ||
+           strcmp(mime_type, "image/webp") == 0;
+}
+
+// Helper: Map the original file as the payload
+static bool map_original(ImageUpload *upload)
+{
+    int fd = open(upload->path, O_RDONLY);
+    if (fd < 0) return false;
+
+    void *data = mmap(NULL, (size_t)upload->file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    upload->data = (const unsigned char *)data;
+    upload->size = (size_t)upload->file_size;
+    upload->mapped = true;
+    return true;
+}
+
+// Helper: Fill in the payload (slow: runs without the lock)
+static bool prepare(ImageUpload *upload)
+{
+    const char *mime_type = image_upload_mime_type(upload->path);
+
+    if (!can_pass_through(mime_type, upload->file_size)) {
+        unsigned char *encoded = NULL;
+        size_t encoded_size = 0;
+        if (platform_encode_image_jpeg(upload->path, IMAGE_UPLOAD_MAX_SIDE, IMAGE_UPLOAD_QUALITY,
+                                       &encoded, &encoded_size)) {
+            upload->data = encoded;
+            upload->size = encoded_size;
+            strncpy(upload->mime_type, "image/jpeg", sizeof(upload->mime_type) - 1);
+            return true;
+        }
+        // Formats ImageIO cannot read go up as they are
+    }
+
+    strncpy(upload->mime_type, mime_type, sizeof(upload->mime_type) - 1);
+    return map_original(upload);
+}
+
+// Helper: Free an entry's payload and the entry
+static void upload_free(ImageUpload *upload)
+{
+    if (upload->data) {
+        if (upload->mapped) {
+            munmap((void *)upload->data, upload->size);
+        } else {
+            free((void *)upload->data);
+        }
+    }
+    free(upload);
+}
+
+// Helper: Take an entry out of the cache (call with mutex held)
+static void cache_remove(ImageUpload *upload)
+{
+    for (int i = 0; i < IMAGE_UPLOAD_CACHE_SIZE; i++) {
+        if (g_uploads.entries[i] == upload) {
+            g_uploads.entries[i] = NULL;
+        }
+    }
+    upload->cached = false;
+}
+
+// Helper: A slot for a new entry: empty, or the least recently used one nothing holds
+// (call with mutex held); -1 if every entry is in use
+static int cache_slot(void)
+{
+    int slot = -1;
+    for (int i = 0; i < IMAGE_UPLOAD_CACHE_SIZE; i++) {
+        ImageUpload *entry = g_uploads.entries[i];
+        if (!entry) return i;
+        if (entry->refs == 0 && (slot < 0 || entry->last_used < g_uploads.entries[slot]->last_used)) {
+            slot = i;
+        }
+    }
+    if (slot >= 0) {
+        ImageUpload *evicted = g_uploads.entries[slot];
+        cache_remove(evicted);
+        upload_free(evicted);
+    }
+    return slot;
+}
+
+// Helper: Drop a reference (call with mutex held)
+static void release_locked(ImageUpload *upload)
+{
+    upload->refs--;
+    if (upload->refs > 0) return;
+    if (upload->failed) {
+        cache_remove(upload);
+    }
+    if (!upload->cached) {
+        upload_free(upload);
+    }
+}
+
+ImageUpload *image_upload_acquire(const char *path)
+{
+    if (!path) return NULL;
+
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&g_uploads.mutex);
+
+    ImageUpload *upload = NULL;
+    for (int i = 0; i < IMAGE_UPLOAD_CACHE_SIZE; i++) {
+        ImageUpload *entry = g_uploads.entries[i];
+        if (entry && !entry->failed && entry->mtime == st.st_mtime &&
+            entry->file_size == (long long)st.st_size && strcmp(entry->path, path) == 0) {
+            upload = entry;
+            break;
+        }
+    }
+
+    if (upload) {
+        // Cached, or being prepared by another thread
+        upload->refs++;
+        upload->last_used = ++g_uploads.clock;
+        while (!upload->ready) {
+            pthread_cond_wait(&g_uploads.prepared, &g_uploads.mutex);
+        }
+        if (upload->failed) {
+            release_locked(upload);
+            upload = NULL;
+        }
+        pthread_mutex_unlock(&g_uploads.mutex);
+        return upload;
+    }
+
+    upload = (ImageUpload *)calloc(1, sizeof(ImageUpload));
+    if (!upload) {
+        pthread_mutex_unlock(&g_uploads.mutex);
+        return NULL;
+    }
+    strncpy(upload->path, path, sizeof(upload->path) - 1);
+    upload->mtime = st.st_mtime;
+    upload->file_size = (long long)st.st_size;
+    upload->refs = 1;
+    upload->last_used = ++g_uploads.clock;
+
+    // With every entry in use, prepare this one uncached
+    int slot = cache_slot();
+    if (slot >= 0) {
+        g_uploads.entries[slot] = upload;
+        upload->cached = true;
+    }
+    pthread_mutex_unlock(&g_uploads.mutex);
+
+    bool ok = prepare(upload);
+
+    pthread_mutex_lock(&g_uploads.mutex);
+    upload->ready = true;
+    upload->failed = !ok;
+    pthread_cond_broadcast(&g_uploads.prepared);
+    if (!ok) {
+        release_locked(upload);
+        upload = NULL;
+    }
+    pthread_mutex_unlock(&g_uploads.mutex);
+    return upload;
+}
+
+void image_upload_release(ImageUpload *upload)
+{
+    if (!upload) return;
+    pthread_mutex_lock(&g_uploads.mutex);
+    release_locked(upload);
+    pthread_mutex_unlock(&g_uploads.mutex);
+}
+
+// Job: Prepare a payload so it is cached when the request is made
+static void prefetch_job(void *arg, JobToken *token)
+{
+    (void)token;
+    image_upload_release(image_upload_acquire((const char *)arg));
+}
+
+// Completion: Free the prefetched path
+static void prefetch_done(void *arg, bool cancelled)
+{
+    (void)cancelled;
+    free(arg);
+}
+
+void image_upload_prefetch(const char *path)
+{
+    if (!path || !path[0]) return;
+
+    char *copy = strdup(path);
+    if (!copy) return;
+
+    jobs_submit(JOB_QOS_UTILITY, prefetch_job, prefetch_done, copy, NULL);
+}
+
+void image_upload_shutdown(void)
+{
+    pthread_mutex_lock(&g_uploads.mutex);
+    for (int i = 0; i < IMAGE_UPLOAD_CACHE_SIZE; i++) {
+        ImageUpload *entry = g_uploads.entries[i];
+        if (entry && entry->refs == 0) {
+            g_uploads.entries[i] = NULL;
+            upload_free(entry);
+        }
+    }
+    pthread_mutex_unlock(&g_uploads.mutex);
+}
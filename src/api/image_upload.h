@@ -0,0 +1,51 @@
+#ifndef IMAGE_UPLOAD_H
+#define IMAGE_UPLOAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Images prepared for sending to an image API. A large photo is decoded at reduced size
+// and re-encoded as JPEG, so a 48 MP original goes up as a few hundred KB instead of
+// tens of MB of base64; a small file goes up as it is. Prepared payloads are cached by
+// path and modification time, and can be prepared in the background ahead of use
+
+#define IMAGE_UPLOAD_MAX_SIDE 2048              // Longest side of a re-encoded image
+#define IMAGE_UPLOAD_QUALITY 0.85f              // JPEG quality of a re-encoded image
+#define IMAGE_UPLOAD_PASSTHROUGH_BYTES (1536 * 1024)  // Smaller files are sent unchanged
+#define IMAGE_UPLOAD_CACHE_SIZE 4
+
+typedef struct ImageUpload {
+    const unsigned char *data;      // Bytes to send
+    size_t size;
+    char mime_type[32];
+
+    // Cache bookkeeping
+    char path[4096];
+    time_t mtime;
+    long long file_size;
+    bool mapped;                    // data is the original file, mapped
+    bool ready;                     // Preparation finished
+    bool failed;
+    bool cached;                    // Held in the cache (else freed on last release)
+    int refs;
+    uint64_t last_used;
+} ImageUpload;
+
+// The payload for an image file, prepared now or taken from the cache; waits when it
+// is being prepared by another thread. NULL if the file cannot be read. Release it after
+// the request has been sent
+ImageUpload *image_upload_acquire(const char *path);
+void image_upload_release(ImageUpload *upload);
+
+// Start preparing the payload for an image file as a background job
+void image_upload_prefetch(const char *path);
+
+// MIME type for an image file's extension
+const char *image_upload_mime_type(const char *path);
+
+// Drop cached payloads not in use (call at exit)
+void image_upload_shutdown(void);
+
+#endif // IMAGE_UPLOAD_H
@@ -0,0 +1,690 @@
+#include "json_stream.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char base64_table[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+void json_writer_init(JsonWriter *writer)
+{
+    if (!writer) return;
+    memset(writer, 0, sizeof(JsonWriter));
+}
+
+void json_writer_free(JsonWriter *writer)
+{
+    if (!writer) return;
+    free(writer->text);
+    free(writer->spans);
+    memset(writer, 0, sizeof(JsonWriter));
+}
+
+// Helper: Add a span to the output
+static JsonWriterSpan *writer_push_span(JsonWriter *writer)
+{
+    if (writer->span_count == writer->span_capacity) {
+        int capacity = writer->span_capacity ? writer->span_capacity * 2 : 8;
+        JsonWriterSpan *spans = realloc(writer->spans, (size_t)capacity * sizeof(JsonWriterSpan));
+        if (!spans) {
+            writer->failed = true;
+            return NULL;
+        }
+        writer->spans = spans;
+        writer->span_capacity = capacity;
+    }
+    JsonWriterSpan *span = &writer->spans[writer->span_count++];
+    memset(span, 0, sizeof(*span));
+    span->offset = writer->length;
+    return span;
+}
+
+// Helper: Append output text, extending the last span when it is text too
+static void writer_text(JsonWriter *writer, const char *text, size_t len)
+{
+    if (writer->failed || len == 0) return;
+
+    if (writer->text_len + len > writer->text_capacity) {
+        size_t capacity = writer->text_capacity ? writer->text_capacity * 2 : 256;
+        while (capacity < writer->text_len + len) capacity *= 2;
+        char *grown = realloc(writer->text, capacity);
+        if (!grown) {
+            writer->failed = true;
+            return;
+        }
+        writer->text = grown;
+        writer->text_capacity = capacity;
+    }
+
+    JsonWriterSpan *span = writer->span_count > 0 ? &writer->spans[writer->span_count - 1] : NULL;
+    if (!span || span->data) {
+        span = writer_push_span(writer);
+        if (!span) return;
+        span->source = writer->text_len;
+    }
+    memcpy(writer->text + writer->text_len, text, len);
+    writer->text_len += len;
+    span->length += len;
+    writer->length += len;
+}
+
+// Helper: Append a quoted, escaped string
+static void writer_quoted(JsonWriter *writer, const char *value)
+{
+    writer_text(writer, "\"", 1);
+
+    const char *run = value;
+    for (const char *p = value; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        writer_text(writer, run, (size_t)(p - run));
+        run = p + 1;
+
+        char escape[8];
+        switch (c) {
+            case '"':  writer_text(writer, "\\\"", 2); break;
+            case '\\': writer_text(writer, "\\\\", 2); break;
+            case '\n': writer_text(writer, "\\n", 2); break;
+            case '\r': writer_text(writer, "\\r", 2); break;
+            case '\t': writer_text(writer, "\\t", 2); break;
+            case '\b': writer_text(writer, "\\b", 2); break;
+            case '\f': writer_text(writer, "\\f", 2); break;
+            default:
+                escape[0] = '\\';
+                escape[1] = 'u';
+                escape[2] = '0';
+                escape[3] = '0';
+                escape[4] = "0123456789abcdef"[c >> 4];
+                escape[5] = "0123456789abcdef"[c & 0xF];
+                writer_text(writer, escape, 6);
+                break;
+        }
+    }
+    writer_text(writer, run, strlen(run));
+    writer_text(writer, "\"", 1);
+}
+
+// Helper: Place the comma due before a key or value
+static void writer_separate(JsonWriter *writer)
+{
+    if (writer->after_key) {
+        writer->after_key = false;
+        return;
+    }
+    if (writer->depth > 0) {
+        if (writer->has_items[writer->depth - 1]) {
+            writer_text(writer, ",", 1);
+        }
+        writer->has_items[writer->depth - 1] = true;
+    }
+}
+
+// Helper: Open a container
+static void writer_open(JsonWriter *writer, const char *bracket)
+{
+    writer_separate(writer);
+    if (writer->depth == JSON_STREAM_MAX_DEPTH) {
+        writer->failed = true;
+        return;
+    }
+    writer_text(writer, bracket, 1);
+    writer->has_items[writer->depth++] = false;
+}
+
+// Helper: Close a container
+static void writer_close(JsonWriter *writer, const char *bracket)
+{
+    if (writer->depth == 0 || writer->after_key) {
+        writer->failed = true;
+        return;
+    }
+    writer->depth--;
+    writer_text(writer, bracket, 1);
+}
+
+void json_writer_begin_object(JsonWriter *writer)
+{
+    if (writer) writer_open(writer, "{");
+}
+
+void json_writer_end_object(JsonWriter *writer)
+{
+    if (writer) writer_close(writer, "}");
+}
+
+void json_writer_begin_array(JsonWriter *writer)
+{
+    if (writer) writer_open(writer, "[");
+}
+
+void json_writer_end_array(JsonWriter *writer)
+{
+    if (writer) writer_close(writer, "]");
+}
+
+void json_writer_key(JsonWriter *writer, const char *key)
+{
+    if (!writer || !key) return;
+    writer_separate(writer);
+    writer_quoted(writer, key);
+    writer_text(writer, ":", 1);
+    writer->after_key = true;
+}
+
+void json_writer_string(JsonWriter *writer, const char *value)
+{
+    if (!writer) return;
+    writer_separate(writer);
+    writer_quoted(writer, value ? value : "");
+}
+
+void json_writer_base64(JsonWriter *writer, const void *data, size_t len)
+{
+    if (!writer) return;
+    writer_separate(writer);
+    writer_text(writer, "\"", 1);
+    if (data && len > 0 && !writer->failed) {
+        JsonWriterSpan *span = writer_push_span(writer);
+        if (span) {
+            span->data = (const unsigned char *)data;
+            span->source = len;
+            span->length = 4 * ((len + 2) / 3);
+            writer->length += span->length;
+        }
+    }
+    writer_text(writer, "\"", 1);
+}
+
+size_t json_writer_length(const JsonWriter *writer)
+{
+    return writer ? writer->length : 0;
+}
+
+bool json_writer_ok(const JsonWriter *writer)
+{
+    return writer && !writer->failed && writer->depth == 0 && !writer->after_key && writer->length > 0;
+}
+
+// Helper: Encode the group of three bytes that makes base64 characters 4*group..4*group+3
+static void base64_group(const unsigned char *data, size_t len, size_t group, char *out)
+{
+    size_t i = group * 3;
+    size_t remaining = len - i;
+    uint32_t a = data[i];
+    uint32_t b = remaining > 1 ? data[i + 1] : 0;
+    uint32_t c = remaining > 2 ? data[i + 2] : 0;
+
+    out[0] = base64_table[a >> 2];
+    out[1] = base64_table[((a & 0x3) << 4) | (b >> 4)];
+    out[2] = remaining > 1 ? base64_table[((b & 0xF) << 2) | (c >> 6)] : '=';
+    out[3] = remaining > 2 ? base64_table[c & 0x3F] : '=';
+}
+
+// Helper: Produce base64 characters [start, start + count) of data
+static void base64_range(const unsigned char *data, size_t len, size_t start, char *out, size_t count)
+{
+    size_t pos = start;
+    size_t end = start + count;
+    while (pos < end) {
+        size_t from = pos % 4;
+        if (from == 0 && end - pos >= 4) {
+            base64_group(data, len, pos / 4, out);
+            out += 4;
+            pos += 4;
+            continue;
+        }
+        char quad[4];
+        base64_group(data, len, pos / 4, quad);
+        size_t take = 4 - from;
+        if (take > end - pos) take = end - pos;
+        memcpy(out, quad + from, take);
+        out += take;
+        pos += take;
+    }
+}
+
+size_t json_writer_read_at(JsonWriter *writer, size_t offset, char *buffer, size_t size)
+{
+    if (!writer || writer->failed || !buffer || offset >= writer->length) return 0;
+
+    // Reads are nearly always sequential: start from the span the last one ended in
+    int i = writer->cursor;
+    if (i >= writer->span_count || writer->spans[i].offset > offset) {
+        i = 0;
+    }
+    while (i < writer->span_count && offset >= writer->spans[i].offset + writer->spans[i].length) {
+        i++;
+    }
+
+    size_t copied = 0;
+    while (copied < size && i < writer->span_count) {
+        const JsonWriterSpan *span = &writer->spans[i];
+        size_t within = offset + copied - span->offset;
+        size_t n = span->length - within;
+        if (n > size - copied) n = size - copied;
+
+        if (span->data) {
+            base64_range(span->data, span->source, within, buffer + copied, n);
+        } else {
+            memcpy(buffer + copied, writer->text + span->source + within, n);
+        }
+        copied += n;
+        if (within + n == span->length) {
+            i++;
+        }
+    }
+    writer->cursor = i < writer->span_count ? i : 0;
+    return copied;
+}
+
+// ============================================================================
+// Reader
+// ============================================================================
+
+enum {
+    READ_VALUE,             // Expecting a value
+    READ_VALUE_OR_END,      // After '['
+    READ_KEY_OR_END,        // After '{'
+    READ_KEY,               // After ',' in an object
+    READ_COLON,
+    READ_AFTER_VALUE,       // Expecting ',' or the container's end
+    READ_STRING,
+    READ_ESCAPE,
+    READ_UNICODE,
+    READ_NUMBER,
+    READ_LITERAL,
+    READ_END                // Top-level value done; only whitespace may follow
+};
+
+void json_reader_init(JsonReader *reader, JsonEventFn on_event, void *context)
+{
+    if (!reader) return;
+    memset(reader, 0, sizeof(JsonReader));
+    reader->on_event = on_event;
+    reader->context = context;
+    reader->state = READ_VALUE;
+}
+
+// Helper: Report an event
+static void reader_emit(JsonReader *reader, JsonEvent event, const char *text, size_t len, bool last)
+{
+    if (reader->on_event && !reader->on_event(reader->context, event, reader->path, text, len, last)) {
+        reader->stopped = true;
+    }
+}
+
+// Helper: Append to the path, clipped to fit
+static void reader_path_append(JsonReader *reader, const char *text, size_t len)
+{
+    size_t room = JSON_READER_MAX_PATH - 1 - reader->path_len;
+    if (len > room) len = room;
+    memcpy(reader->path + reader->path_len, text, len);
+    reader->path_len += len;
+    reader->path[reader->path_len] = '\0';
+}
+
+// Helper: A value has ended; what comes next depends on where it was
+static void reader_value_done(JsonReader *reader)
+{
+    if (reader->depth == 0) {
+        reader->done = true;
+        reader->state = READ_END;
+    } else {
+        reader->state = READ_AFTER_VALUE;
+    }
+}
+
+// Helper: Open an object or array at the current path
+static void reader_open(JsonReader *reader, char bracket)
+{
+    if (reader->depth == JSON_STREAM_MAX_DEPTH) {
+        reader->failed = true;
+        return;
+    }
+    reader_emit(reader, bracket == '{' ? JSON_EVENT_BEGIN_OBJECT : JSON_EVENT_BEGIN_ARRAY, NULL, 0, true);
+    reader->containers[reader->depth] = bracket;
+    reader->path_base[reader->depth] = reader->path_len;
+    reader->depth++;
+    if (bracket == '[') {
+        reader_path_append(reader, "[]", 2);
+        reader->state = READ_VALUE_OR_END;
+    } else {
+        reader->state = READ_KEY_OR_END;
+    }
+}
+
+// Helper: Close the innermost container if bracket matches it
+static void reader_close(JsonReader *reader, char bracket)
+{
+    char open = bracket == '}' ? '{' : '[';
+    if (reader->depth == 0 || reader->containers[reader->depth - 1] != open) {
+        reader->failed = true;
+        return;
+    }
+    reader->depth--;
+    reader->path_len = reader->path_base[reader->depth];
+    reader->path[reader->path_len] = '\0';
+    reader_emit(reader, bracket == '}' ? JSON_EVENT_END_OBJECT : JSON_EVENT_END_ARRAY, NULL, 0, true);
+    reader_value_done(reader);
+}
+
+// Helper: Hand over the string piece read so far
+static void reader_flush(JsonReader *reader, bool last)
+{
+    reader_emit(reader, JSON_EVENT_STRING, reader->piece, reader->piece_len, last);
+    reader->piece_len = 0;
+}
+
+// Helper: Add bytes to the key or string value being read
+static void reader_string_bytes(JsonReader *reader, const char *bytes, size_t len)
+{
+    if (reader->in_key) {
+        for (size_t i = 0; i < len && reader->key_len < JSON_READER_MAX_KEY - 1; i++) {
+            reader->key[reader->key_len++] = bytes[i];
+        }
+        return;
+    }
+    if (reader->piece_len + len > JSON_READER_PIECE) {
+        reader_flush(reader, false);
+    }
+    memcpy(reader->piece + reader->piece_len, bytes, len);
+    reader->piece_len += len;
+}
+
+// Helper: Add a code point as UTF-8
+static void reader_code_point(JsonReader *reader, unsigned int cp)
+{
+    char utf8[4];
+    size_t len;
+    if (cp < 0x80) {
+        utf8[0] = (char)cp;
+        len = 1;
+    } else if (cp < 0x800) {
+        utf8[0] = (char)(0xC0 | (cp >> 6));
+        utf8[1] = (char)(0x80 | (cp & 0x3F));
+        len = 2;
+    } else if (cp < 0x10000) {
+        utf8[0] = (char)(0xE0 | (cp >> 12));
+        utf8[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        utf8[2] = (char)(0x80 | (cp & 0x3F));
+        len = 3;
+    } else {
+        utf8[0] = (char)(0xF0 | (cp >> 18));
+        utf8[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        utf8[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        utf8[3] = (char)(0x80 | (cp & 0x3F));
+        len = 4;
+    }
+    reader_string_bytes(reader, utf8, len);
+}
+
+// Helper: A lone high surrogate becomes the replacement character
+static void reader_drop_surrogate(JsonReader *reader)
+{
+    if (reader->high_surrogate) {
+        reader->high_surrogate = 0;
+        reader_code_point(reader, 0xFFFD);
+    }
+}
+
+// Helper: A \uXXXX escape is complete
+static void reader_unicode_done(JsonReader *reader)
+{
+    unsigned int u = reader->unicode;
+    if (u >= 0xDC00 && u <= 0xDFFF) {
+        if (reader->high_surrogate) {
+            unsigned int cp = 0x10000 + ((reader->high_surrogate - 0xD800) << 10) + (u - 0xDC00);
+            reader->high_surrogate = 0;
+            reader_code_point(reader, cp);
+        } else {
+            reader_code_point(reader, 0xFFFD);
+        }
+    } else if (u >= 0xD800 && u <= 0xDBFF) {
+        reader_drop_surrogate(reader);
+        reader->high_surrogate = u;
+    } else {
+        reader_drop_surrogate(reader);
+        reader_code_point(reader, u);
+    }
+}
+
+// Helper: A string has ended
+static void reader_string_done(JsonReader *reader)
+{
+    reader_drop_surrogate(reader);
+    if (!reader->in_key) {
+        reader_flush(reader, true);
+        reader_value_done(reader);
+        return;
+    }
+
+    // The key names what follows: replace the previous key in the path
+    reader->key[reader->key_len] = '\0';
+    reader->path_len = reader->path_base[reader->depth - 1];
+    reader->path[reader->path_len] = '\0';
+    if (reader->path_len > 0) {
+        reader_path_append(reader, ".", 1);
+    }
+    reader_path_append(reader, reader->key, reader->key_len);
+    reader->in_key = false;
+    reader->state = READ_COLON;
+}
+
+// Helper: Start reading a value at character c; false if c cannot begin one
+static bool reader_begin_value(JsonReader *reader, char c)
+{
+    switch (c) {
+        case '{':
+        case '[':
+            reader_open(reader, c);
+            return true;
+        case '"':
+            reader->in_key = false;
+            reader->piece_len = 0;
+            reader->state = READ_STRING;
+            return true;
+        case 't':
+            reader->literal = "true";
+            break;
+        case 'f':
+            reader->literal = "false";
+            break;
+        case 'n':
+            reader->literal = "null";
+            break;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                reader->piece[0] = c;
+                reader->piece_len = 1;
+                reader->state = READ_NUMBER;
+                return true;
+            }
+            return false;
+    }
+    reader->literal_pos = 1;
+    reader->state = READ_LITERAL;
+    return true;
+}
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool json_reader_feed(JsonReader *reader, const char *bytes, size_t len)
+{
+    if (!reader) return false;
+
+    size_t i = 0;
+    while (i < len && !reader->stopped && !reader->failed) {
+        char c = bytes[i];
+
+        switch (reader->state) {
+            case READ_VALUE:
+                if (!is_space(c) && !reader_begin_value(reader, c)) {
+                    reader->failed = true;
+                }
+                break;
+
+            case READ_VALUE_OR_END:
+                if (c == ']') {
+                    reader_close(reader, c);
+                } else if (!is_space(c) && !reader_begin_value(reader, c)) {
+                    reader->failed = true;
+                }
+                break;
+
+            case READ_KEY_OR_END:
+            case READ_KEY:
+                if (c == '"') {
+                    reader->in_key = true;
+                    reader->key_len = 0;
+                    reader->state = READ_STRING;
+                } else if (c == '}' && reader->state == READ_KEY_OR_END) {
+                    reader_close(reader, c);
+                } else if (!is_space(c)) {
+                    reader->failed = true;
+                }
+                break;
+
+            case READ_COLON:
+                if (c == ':') {
+                    reader->state = READ_VALUE;
+                } else if (!is_space(c)) {
+                    reader->failed = true;
+                }
+                break;
+
+            case READ_AFTER_VALUE:
+                if (c == ',') {
+                    reader->state = reader->containers[reader->depth - 1] == '{' ? READ_KEY : READ_VALUE;
+                } else if (c == '}' || c == ']') {
+                    reader_close(reader, c);
+                } else if (!is_space(c)) {
+                    reader->failed = true;
+                }
+                break;
+
+            case READ_STRING: {
+                // Copy the run of plain characters in one go
+                size_t run = i;
+                while (run < len && bytes[run] != '"' && bytes[run] != '\\' &&
+                       (unsigned char)bytes[run] >= 0x20) {
+                    run++;
+                }
+                if (run > i) {
+                    reader_drop_surrogate(reader);
+                    while (i < run) {
+                        size_t n = run - i;
+                        if (n > JSON_READER_PIECE) n = JSON_READER_PIECE;
+                        reader_string_bytes(reader, bytes + i, n);
+                        i += n;
+                    }
+                    continue;
+                }
+                if (c == '"') {
+                    reader_string_done(reader);
+                } else if (c == '\\') {
+                    reader->state = READ_ESCAPE;
+                } else {
+                    reader->failed = true;
+                }
+                break;
+            }
+
+            case READ_ESCAPE: {
+                const char *escapes = "\"\\/bfnrt";
+                const char *values = "\"\\/\b\f\n\r\t";
+                const char *found = c ? strchr(escapes, c) : NULL;
+                reader->state = READ_STRING;
+                if (c == 'u') {
+                    reader->unicode = 0;
+                    reader->unicode_digits = 0;
+                    reader->state = READ_UNICODE;
+                } else if (found) {
+                    reader_drop_surrogate(reader);
+                    reader_string_bytes(reader, values + (found - escapes), 1);
+                } else {
+                    reader->failed = true;
+                }
+                break;
+            }
+
+            case READ_UNICODE: {
+                int digit = hex_value(c);
+                if (digit < 0) {
+                    reader->failed = true;
+                    break;
+                }
+                reader->unicode = (reader->unicode << 4) | (unsigned int)digit;
+                if (++reader->unicode_digits == 4) {
+                    reader->state = READ_STRING;
+                    reader_unicode_done(reader);
+                }
+                break;
+            }
+
+            case READ_NUMBER:
+                if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                    if (reader->piece_len < 64) {
+                        reader->piece[reader->piece_len++] = c;
+                    } else {
+                        reader->failed = true;
+                    }
+                    break;
+                }
+                // The number ends before this character, which is read again
+                reader_emit(reader, JSON_EVENT_NUMBER, reader->piece, reader->piece_len, true);
+                reader->piece_len = 0;
+                reader_value_done(reader);
+                continue;
+
+            case READ_LITERAL:
+                if (c != reader->literal[reader->literal_pos]) {
+                    reader->failed = true;
+                    break;
+                }
+                if (reader->literal[++reader->literal_pos] == '\0') {
+                    JsonEvent event = reader->literal[0] == 't' ? JSON_EVENT_TRUE
+                                    : reader->literal[0] == 'f' ? JSON_EVENT_FALSE : JSON_EVENT_NULL;
+                    reader_emit(reader, event, reader->literal, strlen(reader->literal), true);
+                    reader_value_done(reader);
+                }
+                break;
+
+            case READ_END:
+                if (!is_space(c)) {
+                    reader->failed = true;
+                }
+                break;
+        }
+        i++;
+    }
+    return !reader->stopped && !reader->failed;
+}
+
+bool json_reader_finish(JsonReader *reader)
+{
+    if (!reader) return false;
+
+    // A bare top-level number has no terminator of its own
+    if (reader->state == READ_NUMBER && reader->depth == 0 && !reader->failed && !reader->stopped) {
+        reader_emit(reader, JSON_EVENT_NUMBER, reader->piece, reader->piece_len, true);
+        reader->piece_len = 0;
+        reader_value_done(reader);
+    }
+    return reader->done && !reader->failed && !reader->stopped;
+}
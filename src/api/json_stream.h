@@ -0,0 +1,114 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Streaming JSON for API payloads. The writer lays a request body out as spans of text
+// and of raw bytes that are base64-encoded only as the body is sent, so an image goes
+// from its mapping straight into the upload buffer. The reader is fed a response as it
+// arrives and reports values as events, handing long strings over in pieces, so a large
+// base64 field can be decoded without the body or a DOM ever being held
+
+#define JSON_STREAM_MAX_DEPTH 64
+#define JSON_READER_MAX_PATH 512
+#define JSON_READER_MAX_KEY 128
+#define JSON_READER_PIECE 4096
+
+// A run of output: text from the writer's buffer, or bytes emitted as base64
+typedef struct JsonWriterSpan {
+    size_t offset;                  // Where the span starts in the output
+    size_t length;                  // Output bytes it produces
+    const unsigned char *data;      // Bytes to encode, or NULL for text
+    size_t source;                  // Text position, or byte count when data is set
+} JsonWriterSpan;
+
+typedef struct JsonWriter {
+    char *text;
+    size_t text_len;
+    size_t text_capacity;
+    JsonWriterSpan *spans;
+    int span_count;
+    int span_capacity;
+    size_t length;                  // Total output bytes
+    int depth;
+    bool has_items[JSON_STREAM_MAX_DEPTH];  // Per open container: a comma goes before the next item
+    bool after_key;
+    bool failed;                    // Out of memory or unbalanced; the output is unusable
+    int cursor;                     // Span the last read ended in
+} JsonWriter;
+
+void json_writer_init(JsonWriter *writer);
+void json_writer_free(JsonWriter *writer);
+
+// Structure and values; commas and colons are placed automatically
+void json_writer_begin_object(JsonWriter *writer);
+void json_writer_end_object(JsonWriter *writer);
+void json_writer_begin_array(JsonWriter *writer);
+void json_writer_end_array(JsonWriter *writer);
+void json_writer_key(JsonWriter *writer, const char *key);
+void json_writer_string(JsonWriter *writer, const char *value);
+
+// A string value holding data base64-encoded. data is referenced, not copied, and must
+// stay valid until the output has been read
+void json_writer_base64(JsonWriter *writer, const void *data, size_t len);
+
+// Output length, and whether the document is complete and usable
+size_t json_writer_length(const JsonWriter *writer);
+bool json_writer_ok(const JsonWriter *writer);
+
+// Copy up to size output bytes starting at offset; returns how many
+size_t json_writer_read_at(JsonWriter *writer, size_t offset, char *buffer, size_t size);
+
+// Reader events. Strings arrive in pieces of at most JSON_READER_PIECE bytes, unescaped,
+// with last set on the final piece; numbers arrive whole as their text
+typedef enum JsonEvent {
+    JSON_EVENT_BEGIN_OBJECT,
+    JSON_EVENT_END_OBJECT,
+    JSON_EVENT_BEGIN_ARRAY,
+    JSON_EVENT_END_ARRAY,
+    JSON_EVENT_STRING,
+    JSON_EVENT_NUMBER,
+    JSON_EVENT_TRUE,
+    JSON_EVENT_FALSE,
+    JSON_EVENT_NULL
+} JsonEvent;
+
+// path names the value: object keys joined by '.', with "[]" for each array level, e.g.
+// "candidates[].content.parts[].text". Return false to stop reading
+typedef bool (*JsonEventFn)(void *context, JsonEvent event, const char *path,
+                            const char *text, size_t len, bool last);
+
+typedef struct JsonReader {
+    JsonEventFn on_event;
+    void *context;
+    int state;
+    int depth;
+    char containers[JSON_STREAM_MAX_DEPTH];     // '{' or '['
+    size_t path_base[JSON_STREAM_MAX_DEPTH];    // Path length of each open container
+    char path[JSON_READER_MAX_PATH];
+    size_t path_len;
+    bool in_key;                    // The string being read is an object key
+    char key[JSON_READER_MAX_KEY];
+    size_t key_len;
+    char piece[JSON_READER_PIECE];  // String value (or number) read so far
+    size_t piece_len;
+    unsigned int unicode;           // \uXXXX being read
+    int unicode_digits;
+    unsigned int high_surrogate;    // First half of a surrogate pair, 0 if none
+    const char *literal;            // "true", "false" or "null" being matched
+    int literal_pos;
+    bool done;                      // A complete top-level value was read
+    bool stopped;                   // on_event returned false
+    bool failed;                    // Malformed input
+} JsonReader;
+
+void json_reader_init(JsonReader *reader, JsonEventFn on_event, void *context);
+
+// Parse the next bytes of the document; false once stopped or malformed
+bool json_reader_feed(JsonReader *reader, const char *bytes, size_t len);
+
+// Whether a complete document was read (call after the last feed)
+bool json_reader_finish(JsonReader *reader);
+
+#endif // JSON_STREAM_H
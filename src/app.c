@@ -11,21 +11,40 @@
 #include "utils/config.h"
 #include "utils/font.h"
 #include "utils/perf.h"
+#include "utils/cache_registry.h"
+#include "utils/trace.h"
+#include "core/session.h"
+#include "core/stat_cache.h"
 #include "ai/embeddings.h"
 #include "ai/vectordb.h"
 #include "ai/clip.h"
 #include "ai/indexer.h"
 #include "ai/semantic_search.h"
 #include "ai/visual_search.h"
+#include "ai/model_manager.h"
+#include "ai/index_governor.h"
+#include "ai/extract_pool.h"
+#include "ai/ai_common.h"
+#include "ai/index_shards.h"
+#include "platform/power.h"
 #include "api/gemini_client.h"
 #include "api/claude_client.h"
+#include "api/http_client.h"
+#include "api/image_upload.h"
 #include "ui/progress_indicator.h"
 #include "ui/file_view_modal.h"
+#include "platform/wake.h"
+#include "platform/memory_pressure.h"
+#include "platform/instance.h"
+#include "tools/query_server.h"
+#include "daemon.h"
+#include "utils/jobs.h"
+#include "utils/arena.h"
+#include "rlgl.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <dirent.h>
 #include <sys/stat.h>
 #include <pthread.h>
 #include <stdatomic.h>
@@ -39,6 +58,15 @@
 // Time window for gg command (in seconds)
 #define GG_TIMEOUT 0.5f
 
+// Seconds between indexing throttle updates
+#define INDEX_THROTTLE_INTERVAL 1.0
+
+// Seconds between lines appended to the indexer metrics file
+#define INDEX_METRICS_INTERVAL 10.0
+
+// Seconds between checks of the shared cache budget (memory pressure is handled at once)
+#define CACHE_TRIM_INTERVAL 1.0
+
 // Grid view constants
 #define GRID_ITEM_WIDTH 100
 #define GRID_ITEM_HEIGHT 90
@@ -46,63 +74,811 @@
 // Forward declaration
 static void app_update_git_status(App *app);
 
-// Initialize AI subsystem components
-static void ai_subsystem_init(App *app)
+// Helper: Queue a changed name for the next frame's patch (watch_mutex held); false if
+// too many are waiting, so the folder is better read again
+static bool app_watch_queue_name(App *app, const char *root, const char *name)
 {
-    // Get database path from config or use default
-    const char *home = getenv("HOME");
-    char db_path[4096];
-    snprintf(db_path, sizeof(db_path), "%s/.config/finder-plus/index.db",
-             home ? home : "/tmp");
-
-    // Initialize core components
-    app->vectordb = vectordb_open(db_path);
-    app->embedding_engine = embedding_engine_create();
-    app->clip_engine = clip_engine_create();
-    app->indexer = indexer_create();
+    if (app->watch_name_count > 0 && strcmp(app->watch_names_root, root) != 0) {
+        app->watch_name_count = 0;      // Queued for a folder no longer shown
+        app->watch_names_size = 0;
+    }
+    if (app->watch_name_count >= FS_WATCH_MAX_CHANGES) {
+        return false;
+    }
 
-    // Load AI models
-    if (app->embedding_engine) {
-        EmbeddingStatus emb_status = embedding_engine_load_model(
-            app->embedding_engine, "models/all-MiniLM-L6-v2/ggml-model-q4_0.bin");
-        if (emb_status == EMBEDDING_STATUS_OK) {
-            TraceLog(LOG_INFO, "Loaded embedding model");
+    size_t len = strlen(name) + 1;
+    if (app->watch_names_size + len > app->watch_names_capacity) {
+        size_t capacity = app->watch_names_capacity ? app->watch_names_capacity * 2 : 4096;
+        while (capacity < app->watch_names_size + len) {
+            capacity *= 2;
         }
+        char *names = realloc(app->watch_names, capacity);
+        if (!names) {
+            return false;
+        }
+        app->watch_names = names;
+        app->watch_names_capacity = capacity;
+    }
+    if (app->watch_name_count == 0) {
+        snprintf(app->watch_names_root, sizeof(app->watch_names_root), "%s", root);
     }
-    if (app->clip_engine) {
-        CLIPStatus clip_status = clip_engine_load_model(
-            app->clip_engine, "models/clip-vit-b32.gguf");
-        if (clip_status == CLIP_STATUS_OK) {
-            TraceLog(LOG_INFO, "Loaded CLIP model");
+    memcpy(app->watch_names + app->watch_names_size, name, len);
+    app->watch_names_size += len;
+    app->watch_name_count++;
+    return true;
+}
+
+// Watch bus callbacks run on its dispatch thread; app_update picks the changes up
+static void app_watch_dir_batch(const FsWatchBatch *batch, void *user_data)
+{
+    App *app = user_data;
+    bool reread = batch->dirs_overflow || batch->changes_overflow;
+    if (!reread) {
+        size_t root_len = strlen(batch->root);
+        pthread_mutex_lock(&app->watch_mutex);
+        for (int i = 0; i < batch->change_count && !reread; i++) {
+            const FsWatchChange *change = &batch->changes[i];
+            const char *name = change->path + root_len;
+            if (*name == '/') {
+                name++;
+            }
+            if (*name == '\0') {
+                // The folder itself: only its going away changes the listing
+                reread = change->type == FSEVENT_DELETED || change->type == FSEVENT_RENAMED;
+            } else {
+                reread = !app_watch_queue_name(app, batch->root, name);
+            }
         }
+        pthread_mutex_unlock(&app->watch_mutex);
+    }
+    if (reread) {
+        atomic_store(&app->watch_dir_changed, true);
     }
+    platform_wake_main_loop();
+}
 
-    // Configure indexer if all core components available
-    if (app->indexer && app->embedding_engine && app->vectordb) {
-        indexer_set_embedding_engine(app->indexer, app->embedding_engine);
-        indexer_set_vectordb(app->indexer, app->vectordb);
-        const char *excludes[] = {"node_modules", ".git", ".DS_Store", "*.pyc", "__pycache__"};
-        for (int i = 0; i < 5; i++) {
-            indexer_add_exclude_pattern(app->indexer, excludes[i]);
+// Whether a change inside .git moves the status (HEAD, the index, a ref or the excludes);
+// rest is the path below .git
+static bool git_internal_path_matters(const char *rest)
+{
+    return strcmp(rest, "/HEAD") == 0 || strcmp(rest, "/index") == 0 ||
+           strcmp(rest, "/packed-refs") == 0 || strcmp(rest, "/info/exclude") == 0 ||
+           strncmp(rest, "/refs/", 6) == 0;
+}
+
+// Tell git what a change under the repository root means for its cached status;
+// false if nothing
+static bool app_git_report_change(const char *path, const char *root)
+{
+    const char *rest = path + strlen(root);
+    if (strncmp(rest, "/.git", 5) != 0 || (rest[5] != '/' && rest[5] != '\0')) {
+        git_status_mark_dirty(path);
+        return true;
+    }
+    if (git_internal_path_matters(rest + 5)) {
+        git_status_invalidate();
+        return true;
+    }
+    return false;
+}
+
+static void app_watch_git_batch(const FsWatchBatch *batch, void *user_data)
+{
+    bool changed = false;
+    if (batch->dirs_overflow) {
+        git_status_invalidate();
+        changed = true;
+    } else if (batch->changes_overflow) {
+        // Too many paths to list, but every directory holding one is
+        for (int i = 0; i < batch->dir_count; i++) {
+            changed |= app_git_report_change(batch->dirs[i], batch->root);
+        }
+    } else {
+        for (int i = 0; i < batch->change_count; i++) {
+            changed |= app_git_report_change(batch->changes[i].path, batch->root);
         }
     }
+    if (changed) {
+        atomic_store(&((App *)user_data)->watch_git_changed, true);
+        platform_wake_main_loop();
+    }
+}
+
+// Subscribe to the repository at root ("" for none) and let git cache its status, which
+// stays valid because every change under root is reported from here on
+static void app_watch_git_root(App *app, const char *root)
+{
+    if (!app->fs_watch || strcmp(app->watched_git_root, root) == 0) {
+        return;
+    }
+
+    strncpy(app->watched_git_root, root, PATH_MAX_LEN - 1);
+    app->watched_git_root[PATH_MAX_LEN - 1] = '\0';
+    if (root[0] == '\0') {
+        fs_watch_unsubscribe(app->fs_watch, app->watch_git_id);
+        app->watch_git_id = 0;
+    } else if (app->watch_git_id > 0) {
+        fs_watch_set_root(app->fs_watch, app->watch_git_id, root);
+    } else {
+        app->watch_git_id = fs_watch_subscribe(app->fs_watch, root, true, app_watch_git_batch, app);
+    }
+    git_status_watch(app->fs_watch_live && app->watch_git_id > 0 ? root : NULL);
+}
+
+// Point the browser subscription at the current directory (app_update_git_status follows
+// the repository)
+static void app_watch_sync(App *app)
+{
+    if (!app->fs_watch) {
+        return;
+    }
+
+    const char *dir = app->directory.current_path;
+    if (strcmp(app->watched_dir, dir) != 0) {
+        strncpy(app->watched_dir, dir, PATH_MAX_LEN - 1);
+        app->watched_dir[PATH_MAX_LEN - 1] = '\0';
+        if (app->watch_dir_id > 0) {
+            fs_watch_set_root(app->fs_watch, app->watch_dir_id, dir);
+        } else {
+            app->watch_dir_id = fs_watch_subscribe(app->fs_watch, dir, false, app_watch_dir_batch, app);
+        }
+    }
+}
+
+// Let the indexers put files in the browsed folder and open tabs first
+static void app_sync_visible_dirs(App *app)
+{
+    const char *dir = app->directory.current_path;
+    if (strcmp(app->visible_dir, dir) == 0 && app->visible_tab_count == app->tabs.count) {
+        return;
+    }
+    strncpy(app->visible_dir, dir, PATH_MAX_LEN - 1);
+    app->visible_dir[PATH_MAX_LEN - 1] = '\0';
+    app->visible_tab_count = app->tabs.count;
+
+    const char *dirs[MAX_TABS + 1];
+    int count = 0;
+    dirs[count++] = dir;
+    for (int i = 0; i < app->tabs.count && i < MAX_TABS; i++) {
+        dirs[count++] = app->tabs.tabs[i].path;
+    }
+    if (app->indexer) {
+        indexer_set_visible_dirs(app->indexer, dirs, count);
+    }
+    if (app->path_indexer) {
+        indexer_set_visible_dirs(app->path_indexer, dirs, count);
+    }
+}
+
+// Helper: Read the shown folder again
+static void app_reread_listing(App *app)
+{
+    treemap_rescan(app->treemap);
+    directory_read(&app->directory, app->directory.current_path);
+    app->cached_listing_path[0] = '\0';
+    if (app->selected_index >= app->directory.count) {
+        app->selected_index = app->directory.count > 0 ? app->directory.count - 1 : 0;
+    }
+}
+
+// Helper: Run a change that may reorder the listing, keeping the cursor, anchor and
+// selection on their entries (found again by name) and the cursor's row where it was on
+// screen. Returns what change returned: how many entries changed, 0 for none, or -1
+static int app_keep_marks(App *app, int (*change)(DirectoryState *dir, void *context), void *context)
+{
+    DirectoryState *dir = &app->directory;
+    SelectionState *sel = &app->selection;
+
+    // The cursor, the anchor, then every selected entry
+    int count = 0;
+    int *indices = malloc((size_t)(sel->count + 2) * sizeof(int));
+    ListingMarks *marks = NULL;
+    if (indices) {
+        indices[count++] = app->selected_index;
+        indices[count++] = sel->anchor_index;
+        for (int index = selection_next(sel, 0); index >= 0 && index < dir->count && count < sel->count + 2;
+             index = selection_next(sel, index + 1)) {
+            indices[count++] = index;
+        }
+        marks = listing_marks_take(dir, indices, count);
+    }
+
+    int old_cursor = app->selected_index;
+    int changed = change(dir, context);
+    if (changed > 0 && marks) {
+        listing_marks_find(marks, dir, indices);
+        selection_clear(sel);
+        for (int i = 2; i < count; i++) {
+            if (indices[i] >= 0) {
+                selection_add(sel, indices[i]);
+            }
+        }
+        sel->anchor_index = indices[1];
+        if (indices[0] >= 0) {
+            app->scroll_offset += indices[0] - old_cursor;
+            if (app->scroll_offset < 0) {
+                app->scroll_offset = 0;
+            }
+            app->selected_index = indices[0];
+        }
+    } else if (changed > 0) {
+        // Out of memory: nothing may act on entries that moved
+        selection_clear(sel);
+    }
+    if (changed > 0 && app->selected_index >= dir->count) {
+        app->selected_index = dir->count > 0 ? dir->count - 1 : 0;
+    }
+
+    listing_marks_free(marks);
+    free(indices);
+    return changed;
+}
+
+typedef struct ListingPatch {
+    const char **names;
+    int count;
+} ListingPatch;
+
+static int listing_patch_apply(DirectoryState *dir, void *context)
+{
+    const ListingPatch *patch = context;
+    return directory_apply_changes(dir, patch->names, patch->count);
+}
+
+static int listing_stream_merge(DirectoryState *dir, void *context)
+{
+    (void)context;
+    return directory_stream_poll(dir) ? 1 : 0;
+}
+
+// Helper: Patch the named changes into the listing, keeping the cursor, anchor and
+// selection on their entries. Returns how many entries changed, or -1 if the folder has
+// to be read again
+static int app_patch_listing(App *app, const char *names, int count)
+{
+    ListingPatch patch = { malloc((size_t)count * sizeof(const char *)), count };
+    if (!patch.names) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        patch.names[i] = names;
+        names += strlen(names) + 1;
+    }
+
+    int changed = app_keep_marks(app, listing_patch_apply, &patch);
+    if (changed > 0) {
+        treemap_rescan(app->treemap);
+        app->cached_listing_path[0] = '\0';
+    }
+    free(patch.names);
+    return changed;
+}
+
+// Patch the listing with the changes the watch bus named (or read it again when it could
+// not name them), and reload git status, once per frame
+static void app_apply_watch_changes(App *app)
+{
+    app_watch_sync(app);
+    app_sync_visible_dirs(app);
+
+    bool dir_changed = atomic_exchange(&app->watch_dir_changed, false);
+    bool git_changed = atomic_exchange(&app->watch_git_changed, false);
+    if (app->directory.is_loading || app->rename_mode) {
+        // Keep the flags for a frame where the listing can be replaced
+        if (dir_changed) atomic_store(&app->watch_dir_changed, true);
+        if (git_changed) atomic_store(&app->watch_git_changed, true);
+        return;
+    }
+
+    // Take every name queued since the last frame as one patch
+    pthread_mutex_lock(&app->watch_mutex);
+    char *names = app->watch_names;
+    int name_count = app->watch_name_count;
+    bool names_current = strcmp(app->watch_names_root, app->directory.current_path) == 0;
+    if (name_count > 0) {
+        app->watch_names = NULL;
+        app->watch_names_size = 0;
+        app->watch_names_capacity = 0;
+        app->watch_name_count = 0;
+    }
+    pthread_mutex_unlock(&app->watch_mutex);
+
+    if (app->smart_folder_open >= 0) {
+        dir_changed = false;
+    } else if (dir_changed) {
+        app_reread_listing(app);
+    } else if (name_count > 0 && names_current) {
+        int patched = app_patch_listing(app, names, name_count);
+        if (patched < 0) {
+            app_reread_listing(app);
+        }
+        dir_changed = patched != 0;
+    }
+    if (name_count > 0) {
+        free(names);
+    }
+    if (dir_changed || git_changed) {
+        dirty_full(&app->perf.dirty);
+        app_update_git_status(app);
+    }
+}
+
+// Helper: Where the smart folder definitions are kept
+static bool smart_folders_file(char *out, size_t size)
+{
+    const char *home = getenv("HOME");
+    if (!home) {
+        return false;
+    }
+    snprintf(out, size, "%s/.config/finder-plus", home);
+    mkdir(out, 0755);
+    snprintf(out, size, "%s/.config/finder-plus/smart_folders", home);
+    return true;
+}
+
+// Helper: Where the running instance listens for later launches
+static bool instance_socket_file(char *out, size_t size)
+{
+    const char *home = getenv("HOME");
+    if (!home) {
+        return false;
+    }
+    snprintf(out, size, "%s/.config/finder-plus", home);
+    mkdir(out, 0755);
+    snprintf(out, size, "%s/.config/finder-plus/instance.sock", home);
+    return true;
+}
+
+static void app_save_smart_folders(App *app)
+{
+    char file[PATH_MAX_LEN];
+    if (smart_folders_file(file, sizeof(file)) && !smart_folders_save(app->smart_folders, file)) {
+        TraceLog(LOG_WARNING, "Could not save smart folders to %s", file);
+    }
+}
+
+// Helper: Copy a smart folder's members into the browser
+static bool app_show_smart_folder(App *app, int index, bool keep_position)
+{
+    if (!smart_folders_open(app->smart_folders, index, &app->directory)) {
+        return false;
+    }
+    directory_sort(&app->directory, SORT_BY_NAME, true);
+    app->smart_folder_open = index;
+    app->smart_folder_generation = smart_folders_generation(app->smart_folders, index);
+    app->cached_listing_path[0] = '\0';
+
+    if (!keep_position) {
+        app->selected_index = 0;
+        app->scroll_offset = 0;
+        selection_clear(&app->selection);
+    } else if (app->selected_index >= app->directory.count) {
+        app->selected_index = app->directory.count > 0 ? app->directory.count - 1 : 0;
+    }
+    dirty_full(&app->perf.dirty);
+    return true;
+}
+
+bool app_open_smart_folder(App *app, int index)
+{
+    return app_show_smart_folder(app, index, false);
+}
+
+bool app_save_search_as_smart_folder(App *app)
+{
+    const char *query = app->search.query;
+    if (query[0] == '\0') {
+        return false;
+    }
+
+    SmartFolderKind kind = SMART_FOLDER_FILTER;
+    if (app->search.search_type == SEARCH_TYPE_SEMANTIC) {
+        kind = SMART_FOLDER_SEMANTIC;
+    } else if (strpbrk(query, "*?[")) {
+        kind = SMART_FOLDER_PATTERN;
+    }
+
+    // Saved from inside a smart folder, the new one covers the same root
+    SmartFolderInfo info;
+    const char *root = app->directory.current_path;
+    if (app->smart_folder_open >= 0 && smart_folders_info(app->smart_folders, app->smart_folder_open, &info)) {
+        root = info.root;
+    }
+
+    char name[SMART_FOLDER_NAME_MAX];
+    snprintf(name, sizeof(name), "%s", query);
+    int index = smart_folders_add(app->smart_folders, name, kind, root, query);
+    if (index < 0) {
+        TraceLog(LOG_WARNING, "Could not save \"%s\" as a smart folder", query);
+        return false;
+    }
+    app_save_smart_folders(app);
+    search_stop(&app->search);
+    app_show_smart_folder(app, index, false);
+    return true;
+}
+
+void app_remove_smart_folder(App *app)
+{
+    int index = app->smart_folder_open;
+    SmartFolderInfo info;
+    if (index < 0 || !smart_folders_info(app->smart_folders, index, &info)) {
+        return;
+    }
+    app->smart_folder_open = -1;
+    smart_folders_remove(app->smart_folders, index);
+    app_save_smart_folders(app);
+    directory_read(&app->directory, info.root);
+    app->selected_index = 0;
+    app->scroll_offset = 0;
+    selection_clear(&app->selection);
+    dirty_full(&app->perf.dirty);
+}
+
+// Follow the smart folder the browser shows: copy its members again when they change,
+// and let it go once the browser has moved on to another folder
+static void app_sync_smart_folder(App *app)
+{
+    if (app->smart_folder_open < 0) {
+        return;
+    }
+    SmartFolderInfo info;
+    if (!smart_folders_info(app->smart_folders, app->smart_folder_open, &info) ||
+        strcmp(info.root, app->directory.current_path) != 0) {
+        app->smart_folder_open = -1;
+        return;
+    }
+    if (app->directory.is_loading || app->rename_mode) {
+        return;
+    }
+    uint32_t generation = smart_folders_generation(app->smart_folders, app->smart_folder_open);
+    if (generation != 0 && generation != app->smart_folder_generation) {
+        app_show_smart_folder(app, app->smart_folder_open, true);
+    }
+}
+
+// Semantic smart folders hold the best matches below their root above this score
+#define SMART_FOLDER_SEMANTIC_RESULTS 500
+#define SMART_FOLDER_SEMANTIC_MIN_SCORE 0.35f
+
+static int app_smart_semantic_query(const char *query, const char *root, char ***paths, void *context)
+{
+    App *app = context;
+    if (!app->semantic_search || !semantic_search_is_ready(app->semantic_search)) {
+        return -1;
+    }
+
+    SemanticSearchOptions options = semantic_search_default_options();
+    options.max_results = SMART_FOLDER_SEMANTIC_RESULTS;
+    options.min_score = SMART_FOLDER_SEMANTIC_MIN_SCORE;
+    options.directory = root;
+    SemanticSearchResults results = semantic_search_query(app->semantic_search, query, &options);
+    int count = results.success ? results.count : -1;
+    *paths = count > 0 ? malloc((size_t)count * sizeof(char *)) : NULL;
+    if (count > 0 && !*paths) {
+        count = -1;
+    }
+    for (int i = 0; i < count; i++) {
+        (*paths)[i] = strdup(results.results[i].path);
+        if (!(*paths)[i]) {
+            count = i;
+        }
+    }
+    semantic_search_results_free(&results);
+    return count;
+}
+
+// A file just indexed joins a semantic folder if it ranks among the matches in its own
+// folder (the query's embedding is cached after the first search)
+static bool app_smart_semantic_match(const char *path, const char *query, void *context)
+{
+    App *app = context;
+    if (!app->semantic_search || !semantic_search_is_ready(app->semantic_search)) {
+        return false;
+    }
+
+    char dir[PATH_MAX_LEN];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (!slash) {
+        return false;
+    }
+    *slash = '\0';
+
+    SemanticSearchOptions options = semantic_search_default_options();
+    options.max_results = VECTORDB_MAX_RESULTS;
+    options.min_score = SMART_FOLDER_SEMANTIC_MIN_SCORE;
+    options.directory = dir;
+    SemanticSearchResults results = semantic_search_query(app->semantic_search, query, &options);
+    bool found = false;
+    for (int i = 0; results.success && i < results.count && !found; i++) {
+        found = strcmp(results.results[i].path, path) == 0;
+    }
+    semantic_search_results_free(&results);
+    return found;
+}
+
+// Runs on the indexer's writer thread for every file it stores
+static void app_indexer_file_done(const char *path, IndexerStatus status, void *user_data)
+{
+    (void)status;
+    smart_folders_indexed(((App *)user_data)->smart_folders, path);
+}
+
+// Cache registry clients: each cache measured and shrunk through its own API
+static size_t app_listings_bytes(void *cache) { return ((DirCache *)cache)->bytes; }
+static void app_listings_trim(void *cache, size_t target) { dir_cache_trim((DirCache *)cache, target); }
+static size_t app_tabs_bytes(void *cache) { return tabs_resident_bytes((TabState *)cache); }
+static void app_tabs_trim(void *cache, size_t target) { tabs_trim_resident((TabState *)cache, target); }
+static size_t app_textures_bytes(void *cache) { (void)cache; return texture_budget_used(); }
+static void app_textures_trim(void *cache, size_t target) { (void)cache; texture_budget_release(target); }
+static size_t app_attributes_bytes(void *cache) { (void)cache; return stat_cache_bytes(); }
+static void app_attributes_trim(void *cache, size_t target) { (void)cache; stat_cache_trim(target); }
+static size_t app_summaries_bytes(void *cache) { return summary_cache_memory((SummaryCache *)cache); }
+static size_t app_embeddings_bytes(void *cache) { return vectordb_index_memory((VectorDB *)cache); }
+
+// Helper: The page cache goes back whole; it is read again from disk
+static void app_summaries_trim(void *cache, size_t target)
+{
+    (void)target;
+    summary_cache_release_memory((SummaryCache *)cache);
+}
+
+// Helper: The resident index goes whole, and only once it is saved
+static void app_embeddings_trim(void *cache, size_t target)
+{
+    (void)target;
+    vectordb_release_index((VectorDB *)cache);
+}
+
+// Initialize AI subsystem components
+static void ai_subsystem_init(App *app)
+{
+    // The vector database opens on the startup thread, see ai_subsystem_attach_vectordb
+    app->vectordb = NULL;
+    if (!extract_pool_start(NULL)) {
+        TraceLog(LOG_WARNING, "Document extractor workers unavailable, documents are read in process");
+    }
+    app->indexer = indexer_create();
+    if (app->indexer) {
+        indexer_set_callback(app->indexer, app_indexer_file_done, app);
+    }
+
+    // Shared engines; their models load on first use, not here
+    app->embedding_engine = model_manager_acquire_embedding();
+    app->clip_engine = model_manager_acquire_clip();
+    if (embedding_engine_is_available(app->embedding_engine)) {
+        TraceLog(LOG_INFO, "Embedding model found (loads on first use)");
+    }
+    if (clip_engine_is_available(app->clip_engine)) {
+        TraceLog(LOG_INFO, "CLIP model found (loads on first use)");
+    }
 
     // Initialize semantic search
     app->semantic_search = semantic_search_create();
     if (app->semantic_search) {
         semantic_search_set_embedding_engine(app->semantic_search, app->embedding_engine);
-        semantic_search_set_vectordb(app->semantic_search, app->vectordb);
         semantic_search_set_indexer(app->semantic_search, app->indexer);
     }
 
+    SmartFolderSemantic semantic = { app_smart_semantic_query, app_smart_semantic_match, app };
+    smart_folders_set_semantic(app->smart_folders, &semantic);
+
     // Initialize visual search
     app->visual_search = visual_search_create();
     if (app->visual_search) {
         visual_search_set_clip_engine(app->visual_search, app->clip_engine);
-        visual_search_set_vectordb(app->visual_search, app->vectordb);
+        visual_search_set_quantization(app->visual_search, (VectorQuantization)g_config.performance.vector_quantization);
+    }
+}
+
+// Helper: Attach the index databases of the mounted external volumes (a job: detaching
+// one waits for the searches still reading it)
+static void app_sync_shards_run(void *arg, JobToken *token)
+{
+    (void)token;
+    App *app = (App *)arg;
+    index_shards_sync(app->vectordb, app->volumes, g_config.ai.index_on_volumes);
+}
+
+static void app_sync_index_shards(App *app)
+{
+    if (!app->vectordb || !app->volumes) {
+        return;
+    }
+    if (!app->shards_sync) {
+        app->shards_sync = job_token_create();
+    }
+    jobs_submit(JOB_QOS_UTILITY, app_sync_shards_run, NULL, app, app->shards_sync);
+}
+
+// Hand the vector database opened at startup to the indexer and searches
+static void ai_subsystem_attach_vectordb(App *app, VectorDB *vectordb)
+{
+    app->vectordb = vectordb;
+    if (!vectordb) {
+        return;
+    }
+    cache_registry_add(&(CacheClient){ "embeddings", CACHE_COST_HIGH, app_embeddings_bytes,
+                                       app_embeddings_trim, vectordb });
+    vectordb_set_quantization(vectordb, (VectorQuantization)g_config.performance.vector_quantization);
+    vectordb_set_model(vectordb, path_basename(embedding_get_default_model_path()));
+    app_sync_index_shards(app);
+
+    // Configure indexer if all core components available
+    if (app->indexer && app->embedding_engine) {
+        indexer_set_embedding_engine(app->indexer, app->embedding_engine);
+        indexer_set_vectordb(app->indexer, vectordb);
+        indexer_set_fs_watch(app->indexer, app->fs_watch);
+        const char *excludes[] = {"node_modules", ".git", ".DS_Store", "*.pyc", "__pycache__"};
+        for (int i = 0; i < 5; i++) {
+            indexer_add_exclude_pattern(app->indexer, excludes[i]);
+        }
+        indexer_set_respect_ignore_files(app->indexer, g_config.ai.respect_ignore_files);
+    }
+
+    semantic_search_set_vectordb(app->semantic_search, vectordb);
+    visual_search_set_vectordb(app->visual_search, vectordb);
+}
+
+// Start the indexer that keeps the filename index loaded at startup current
+static void path_index_subsystem_init(App *app, PathIndex *path_index, HashCache *hash_cache)
+{
+    app->path_index = path_index;
+    app->path_indexer = NULL;
+    app->hash_cache = hash_cache;
+
+    const char *home = getenv("HOME");
+    if (!app->path_index || !home) {
+        return;
+    }
+
+    IndexerConfig config = indexer_get_default_config();
+    strncpy(config.watch_dirs[0], home, sizeof(config.watch_dirs[0]) - 1);
+    config.watch_dir_count = 1;
+    config.enable_fsevents = true;
+    config.delay_between_batches_ms = 0;
+    config.follow_only = app->index_daemon;
+
+    app->path_indexer = indexer_create_with_config(&config);
+    if (app->path_indexer) {
+        indexer_set_path_index(app->path_indexer, app->path_index);
+        indexer_set_hash_cache(app->path_indexer, app->hash_cache);
+        indexer_set_fs_watch(app->path_indexer, app->fs_watch);
+        indexer_start(app->path_indexer);
     }
 }
 
+static void path_index_subsystem_free(App *app)
+{
+    if (app->path_indexer) {
+        indexer_stop(app->path_indexer);
+        indexer_destroy(app->path_indexer);
+        app->path_indexer = NULL;
+    }
+    if (app->path_index) {
+        if (!app->index_daemon) {
+            path_index_save(app->path_index);
+        }
+        path_index_close(app->path_index);
+        app->path_index = NULL;
+    }
+    if (app->hash_cache) {
+        hash_cache_close(app->hash_cache);
+        app->hash_cache = NULL;
+    }
+}
+
+// Open the stores the first directory does not need: the vector database, the filename
+// index (a saved index is searchable right away; the rescan then catches up) and the
+// summary cache. Runs on the startup thread
+static void *app_startup_thread(void *arg)
+{
+    AppStartup *startup = (AppStartup *)arg;
+    trace_set_thread_name("startup");
+    const char *home = getenv("HOME");
+
+    double start = startup_phase_begin();
+    startup->summary_cache = summary_cache_create(NULL);  // Uses default path
+    startup_phase_end("summaries", start, true);
+
+    start = startup_phase_begin();
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/.config/finder-plus/index.db", home ? home : "/tmp");
+    startup->vectordb = vectordb_open(path);
+    startup_phase_end("vectordb", start, true);
+
+    if (g_config.performance.path_index && home) {
+        start = startup_phase_begin();
+        snprintf(path, sizeof(path), "%s/.config/finder-plus", home);
+        mkdir(path, 0755);
+        snprintf(path, sizeof(path), "%s/.config/finder-plus/paths.idx", home);
+        startup->path_index = path_index_open(path);
+        if (startup->path_index) {
+            snprintf(path, sizeof(path), "%s/.config/finder-plus/hashes.db", home);
+            startup->hash_cache = hash_cache_open(path);
+        }
+        startup_phase_end("paths", start, true);
+    }
+
+    atomic_store(&startup->done, true);
+    return NULL;
+}
+
+// Start opening the stores in the background (in place if no thread can be started)
+static void app_startup_begin(App *app)
+{
+    AppStartup *startup = &app->startup;
+    memset(startup, 0, sizeof(*startup));
+    atomic_store(&startup->done, false);
+    startup->running = pthread_create(&startup->thread, NULL, app_startup_thread, startup) == 0;
+    if (!startup->running) {
+        TraceLog(LOG_WARNING, "Startup thread could not be started");
+        app_startup_thread(startup);
+    }
+}
+
+// Serve the indexes to the CLI and editors; only the instance owning the windows does,
+// once the stores are adopted, and only while no index daemon serves them
+static void app_start_query_server(App *app)
+{
+    const char *home = getenv("HOME");
+    if (app->query_server || !app->instance || !app->startup.adopted || app->index_daemon || !home) {
+        return;
+    }
+
+    char socket_path[PATH_MAX_LEN];
+    snprintf(socket_path, sizeof(socket_path), "%s/" QUERY_SERVER_SOCKET, home);
+    QueryServerSources sources = {
+        .semantic_search = app->semantic_search,
+        .visual_search = app->visual_search,
+        .path_index = app->path_index,
+        .path_indexer = app->path_indexer,
+    };
+    app->query_server = query_server_start(socket_path, &sources);
+    if (!app->query_server) {
+        TraceLog(LOG_WARNING, "Query server unavailable at %s", socket_path);
+    }
+}
+
+// Adopt the stores once opened; wait for them if asked to. True once adopted
+static bool app_startup_finish(App *app, bool wait)
+{
+    AppStartup *startup = &app->startup;
+    if (startup->adopted) {
+        return true;
+    }
+    if (!wait && !atomic_load(&startup->done)) {
+        return false;
+    }
+    if (startup->running) {
+        pthread_join(startup->thread, NULL);
+        startup->running = false;
+    }
+
+    app->summary_cache = startup->summary_cache;
+    if (app->summary_cache) {
+        cache_registry_add(&(CacheClient){ "summaries", CACHE_COST_LOW, app_summaries_bytes,
+                                           app_summaries_trim, app->summary_cache });
+    }
+    ai_subsystem_attach_vectordb(app, startup->vectordb);
+    path_index_subsystem_init(app, startup->path_index, startup->hash_cache);
+    command_bar_set_path_index(&app->command_bar, app->path_index, app->path_indexer);
+
+    // Smart folders materialize from the filename index
+    char smart_file[PATH_MAX_LEN];
+    smart_folders_set_path_index(app->smart_folders, app->path_index);
+    if (smart_folders_file(smart_file, sizeof(smart_file))) {
+        smart_folders_load(app->smart_folders, smart_file);
+    }
+    startup->adopted = true;
+    app_start_query_server(app);
+
+    startup_mark_ready();
+    TraceLog(LOG_INFO, "Startup finished loading in the background");
+    return true;
+}
+
 // Free AI subsystem components
 static void ai_subsystem_free(App *app)
 {
@@ -123,18 +899,15 @@ static void ai_subsystem_free(App *app)
         app->semantic_search = NULL;
     }
 
-    // Free engines
-    if (app->clip_engine) {
-        clip_engine_destroy(app->clip_engine);
-        app->clip_engine = NULL;
-    }
-    if (app->embedding_engine) {
-        embedding_engine_destroy(app->embedding_engine);
-        app->embedding_engine = NULL;
-    }
+    // Release engines
+    model_manager_release_clip(app->clip_engine);
+    app->clip_engine = NULL;
+    model_manager_release_embedding(app->embedding_engine);
+    app->embedding_engine = NULL;
 
     // Close database last
     if (app->vectordb) {
+        cache_registry_remove(app->vectordb);
         vectordb_close(app->vectordb);
         app->vectordb = NULL;
     }
@@ -145,13 +918,13 @@ static void perform_delete_confirmed(App *app)
 {
     if (app->directory.count == 0) return;
 
-    // Delete selected items
+    // Delete selected items, in Trash batches
     if (app->selection.count > 0) {
-        for (int i = 0; i < app->selection.count; i++) {
-            file_delete(app->directory.entries[app->selection.indices[i]].path);
-        }
+        app_trash_selection(app);
     } else {
-        file_delete(app->directory.entries[app->selected_index].path);
+        char path[PATH_MAX_LEN];
+        file_delete(directory_entry_path(&app->directory, &app->directory.entries[app->selected_index],
+                                         path, sizeof(path)));
     }
 
     // Refresh directory
@@ -164,85 +937,112 @@ static void perform_delete_confirmed(App *app)
     }
 }
 
+// Callback for delete-immediately confirmation dialog
+static void perform_erase_confirmed(App *app)
+{
+    if (app->directory.count == 0) return;
+
+    if (app->selection.count > 0) {
+        app_erase_selection(app);
+    } else {
+        char path[PATH_MAX_LEN];
+        operation_queue_remove(&app->op_queue,
+                               directory_entry_path(&app->directory,
+                                                    &app->directory.entries[app->selected_index],
+                                                    path, sizeof(path)),
+                               true);
+    }
+
+    // Refresh directory (the items are already aside in tombstones)
+    directory_read(&app->directory, app->directory.current_path);
+    selection_clear(&app->selection);
+    app_update_git_status(app);
+
+    if (app->selected_index >= app->directory.count) {
+        app->selected_index = app->directory.count > 0 ? app->directory.count - 1 : 0;
+    }
+}
+
 // Selection functions implementation
+// Source of SelectionState.generation values (main thread only)
+static uint32_t g_selection_generation = 1;
+
+static void selection_changed(SelectionState *sel)
+{
+    sel->generation = g_selection_generation++;
+}
+
 void selection_init(SelectionState *sel)
 {
-    sel->indices = NULL;
+    sel->bits = NULL;
+    sel->words = 0;
     sel->count = 0;
-    sel->capacity = 0;
     sel->anchor_index = -1;
+    selection_changed(sel);
 }
 
 void selection_free(SelectionState *sel)
 {
-    if (sel->indices) {
-        free(sel->indices);
-        sel->indices = NULL;
-    }
+    free(sel->bits);
+    sel->bits = NULL;
+    sel->words = 0;
     sel->count = 0;
-    sel->capacity = 0;
     sel->anchor_index = -1;
+    selection_changed(sel);
 }
 
 void selection_clear(SelectionState *sel)
 {
-    sel->count = 0;
+    if (sel->count > 0) {
+        memset(sel->bits, 0, (size_t)sel->words * sizeof(uint64_t));
+        sel->count = 0;
+        selection_changed(sel);
+    }
     sel->anchor_index = -1;
 }
 
-static bool selection_ensure_capacity(SelectionState *sel, int needed)
+// Helper: Make room for bit index (new words start clear)
+static bool selection_ensure_capacity(SelectionState *sel, int index)
 {
-    if (needed <= sel->capacity) {
+    int needed = index / 64 + 1;
+    if (needed <= sel->words) {
         return true;
     }
 
-    int new_capacity = sel->capacity == 0 ? 16 : sel->capacity * 2;
-    while (new_capacity < needed) {
-        new_capacity *= 2;
-    }
-    if (new_capacity > MAX_SELECTION) {
-        new_capacity = MAX_SELECTION;
+    int new_words = sel->words == 0 ? 16 : sel->words * 2;
+    while (new_words < needed) {
+        new_words *= 2;
     }
 
-    int *new_indices = realloc(sel->indices, new_capacity * sizeof(int));
-    if (!new_indices) {
+    uint64_t *new_bits = realloc(sel->bits, (size_t)new_words * sizeof(uint64_t));
+    if (!new_bits) {
         return false;
     }
+    memset(new_bits + sel->words, 0, (size_t)(new_words - sel->words) * sizeof(uint64_t));
 
-    sel->indices = new_indices;
-    sel->capacity = new_capacity;
+    sel->bits = new_bits;
+    sel->words = new_words;
     return true;
 }
 
 void selection_add(SelectionState *sel, int index)
 {
-    // Check if already selected
-    for (int i = 0; i < sel->count; i++) {
-        if (sel->indices[i] == index) {
-            return;
-        }
-    }
-
-    if (!selection_ensure_capacity(sel, sel->count + 1)) {
+    if (index < 0 || selection_contains(sel, index) || !selection_ensure_capacity(sel, index)) {
         return;
     }
-
-    sel->indices[sel->count] = index;
+    sel->bits[index / 64] |= 1ULL << (index % 64);
     sel->count++;
+    selection_changed(sel);
 }
 
 void selection_remove(SelectionState *sel, int index)
 {
-    for (int i = 0; i < sel->count; i++) {
-        if (sel->indices[i] == index) {
-            // Shift remaining elements
-            for (int j = i; j < sel->count - 1; j++) {
-                sel->indices[j] = sel->indices[j + 1];
-            }
-            sel->count--;
-            return;
-        }
+    if (!selection_contains(sel, index)) {
+        return;
     }
+    sel->bits[index / 64] &= ~(1ULL << (index % 64));
+    sel->count--;
+    selection_changed(sel);
 }
 
 void selection_toggle(SelectionState *sel, int index)
@@ -254,38 +1054,150 @@ void selection_toggle(SelectionState *sel, int index)
     }
 }
 
-bool selection_contains(SelectionState *sel, int index)
+bool selection_contains(const SelectionState *sel, int index)
 {
-    for (int i = 0; i < sel->count; i++) {
-        if (sel->indices[i] == index) {
-            return true;
-        }
+    if (index < 0 || index / 64 >= sel->words) {
+        return false;
     }
-    return false;
+    return (sel->bits[index / 64] >> (index % 64)) & 1;
 }
 
-void selection_range(SelectionState *sel, int from, int to)
+void selection_add_range(SelectionState *sel, int from, int to)
 {
-    selection_clear(sel);
-
     int start = from < to ? from : to;
     int end = from < to ? to : from;
+    if (start < 0) start = 0;
+    if (end < start || !selection_ensure_capacity(sel, end)) {
+        return;
+    }
 
-    for (int i = start; i <= end; i++) {
-        selection_add(sel, i);
+    // Whole words at a time, masking the partial ones at either end
+    for (int w = start / 64; w <= end / 64; w++) {
+        uint64_t mask = ~0ULL;
+        if (w == start / 64) mask &= ~0ULL << (start % 64);
+        if (w == end / 64) mask &= ~0ULL >> (63 - end % 64);
+        sel->count += __builtin_popcountll(mask & ~sel->bits[w]);
+        sel->bits[w] |= mask;
     }
+    selection_changed(sel);
+}
+
+void selection_range(SelectionState *sel, int from, int to)
+{
+    selection_clear(sel);
+    selection_add_range(sel, from, to);
 }
 
 void selection_select_all(App *app)
 {
     selection_clear(&app->selection);
-    for (int i = 0; i < app->directory.count; i++) {
-        selection_add(&app->selection, i);
+    if (app->directory.count > 0) {
+        selection_add_range(&app->selection, 0, app->directory.count - 1);
+    }
+}
+
+int selection_next(const SelectionState *sel, int from)
+{
+    if (from < 0) from = 0;
+    int w = from / 64;
+    if (sel->count == 0 || w >= sel->words) {
+        return -1;
+    }
+
+    uint64_t word = sel->bits[w] & (~0ULL << (from % 64));
+    while (word == 0) {
+        if (++w >= sel->words) {
+            return -1;
+        }
+        word = sel->bits[w];
+    }
+    return w * 64 + __builtin_ctzll(word);
+}
+
+int selection_collect(const SelectionState *sel, int *cursor, int *indices, int max)
+{
+    int count = 0;
+    int index = selection_next(sel, *cursor);
+    while (index >= 0 && count < max) {
+        indices[count++] = index;
+        index = selection_next(sel, index + 1);
+    }
+    *cursor = index >= 0 ? index : sel->words * 64;
+    return count;
+}
+
+// Helper: Full paths of the next (up to) max selected entries, built in arena, with
+// *cursor as for selection_collect
+static int app_selection_paths(App *app, int *cursor, const char **paths, int max, Arena *arena)
+{
+    int indices[MAX_SELECTION];
+    if (max > MAX_SELECTION) max = MAX_SELECTION;
+    int count = selection_collect(&app->selection, cursor, indices, max);
+
+    // Bits past the end of the listing are ignored (they come last)
+    while (count > 0 && indices[count - 1] >= app->directory.count) {
+        count--;
+    }
+    if (count == 0 || !directory_collect_paths(&app->directory, indices, count, paths, arena)) {
+        return 0;
+    }
+    return count;
+}
+
+void app_trash_selection(App *app)
+{
+    // One Trash batch per chunk, reusing the same arena space
+    const char *paths[MAX_SELECTION];
+    Arena *arena = frame_arena();
+    int cursor = 0;
+    for (;;) {
+        ArenaMark mark = arena_mark(arena);
+        int count = app_selection_paths(app, &cursor, paths, MAX_SELECTION, arena);
+        if (count > 0) {
+            file_delete_batch(paths, count, NULL);
+        }
+        arena_release(arena, mark);
+        if (count == 0) {
+            break;
+        }
+    }
+}
+
+void app_erase_selection(App *app)
+{
+    const char *paths[MAX_SELECTION];
+    Arena *arena = frame_arena();
+    int cursor = 0;
+    for (;;) {
+        ArenaMark mark = arena_mark(arena);
+        int count = app_selection_paths(app, &cursor, paths, MAX_SELECTION, arena);
+        for (int i = 0; i < count; i++) {
+            operation_queue_remove(&app->op_queue, paths[i], true);
+        }
+        arena_release(arena, mark);
+        if (count == 0) {
+            break;
+        }
     }
 }
 
+void app_clipboard_take_selection(App *app, OperationType op)
+{
+    // Straight into the clipboard's own buffer: no path array of the selection's size
+    char path[PATH_MAX_LEN];
+    clipboard_begin(&app->clipboard, op);
+    for (int i = selection_next(&app->selection, 0); i >= 0 && i < app->directory.count;
+         i = selection_next(&app->selection, i + 1)) {
+        directory_entry_path(&app->directory, &app->directory.entries[i], path, sizeof(path));
+        if (!clipboard_add(&app->clipboard, path)) {
+            break;
+        }
+    }
+    clipboard_publish(&app->clipboard);
+}
+
 // Sidebar functions implementation
-void sidebar_init(SidebarState *sidebar)
+void sidebar_init(SidebarState *sidebar, Volumes *volumes)
 {
     sidebar->favorite_count = 0;
     sidebar->volume_count = 0;
@@ -327,40 +1239,31 @@ void sidebar_init(SidebarState *sidebar)
         sidebar->favorite_count++;
     }
 
-    // Refresh volumes
-    sidebar_refresh_volumes(sidebar);
+    // Mounted volumes
+    sidebar_refresh_volumes(sidebar, volumes);
 }
 
-void sidebar_refresh_volumes(SidebarState *sidebar)
+void sidebar_refresh_volumes(SidebarState *sidebar, Volumes *volumes)
 {
-    sidebar->volume_count = 0;
-
-    // Add root
-    strncpy(sidebar->volumes[sidebar->volume_count].name, "Macintosh HD", 63);
-    strncpy(sidebar->volumes[sidebar->volume_count].path, "/", PATH_MAX_LEN - 1);
-    sidebar->volumes[sidebar->volume_count].is_volume = true;
-    sidebar->volume_count++;
+    VolumeInfo listed[16];
+    int count = volumes_list(volumes, listed, 16);
 
-    // Scan /Volumes for mounted volumes
-    DIR *dir = opendir("/Volumes");
-    if (dir) {
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL && sidebar->volume_count < 16) {
-            if (entry->d_name[0] == '.') continue;
-            if (strcmp(entry->d_name, "Macintosh HD") == 0) continue;
+    // Root is listed even before the volume service has read the mounts
+    if (count == 0) {
+        snprintf(listed[0].name, sizeof(listed[0].name), "Macintosh HD");
+        snprintf(listed[0].path, sizeof(listed[0].path), "/");
+        count = 1;
+    }
 
-            char path[PATH_MAX_LEN];
-            snprintf(path, sizeof(path), "/Volumes/%s", entry->d_name);
-
-            struct stat st;
-            if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
-                strncpy(sidebar->volumes[sidebar->volume_count].name, entry->d_name, 63);
-                strncpy(sidebar->volumes[sidebar->volume_count].path, path, PATH_MAX_LEN - 1);
-                sidebar->volumes[sidebar->volume_count].is_volume = true;
-                sidebar->volume_count++;
-            }
-        }
-        closedir(dir);
+    sidebar->volume_count = 0;
+    for (int i = 0; i < count; i++) {
+        SidebarItem *item = &sidebar->volumes[sidebar->volume_count++];
+        snprintf(item->name, sizeof(item->name), "%s", listed[i].name);
+        snprintf(item->path, sizeof(item->path), "%s", listed[i].path);
+        item->is_volume = true;
+    }
+    if (sidebar->hovered_index >= 100 + sidebar->volume_count) {
+        sidebar->hovered_index = -1;
     }
 }
 
@@ -416,29 +1319,156 @@ bool history_can_go_back(HistoryState *history)
     return history->current > 0;
 }
 
-bool history_can_go_forward(HistoryState *history)
-{
-    return history->current < history->count - 1;
+bool history_can_go_forward(HistoryState *history)
+{
+    return history->current < history->count - 1;
+}
+
+// View mode helpers
+const char* view_mode_name(ViewMode mode)
+{
+    switch (mode) {
+        case VIEW_LIST: return "List View";
+        case VIEW_GRID: return "Grid View";
+        case VIEW_COLUMN: return "Column View";
+        case VIEW_TREEMAP: return "Disk Usage";
+        default: return "Unknown";
+    }
+}
+
+// Write the tabs and their listings for the next launch to show at once
+static void app_save_session(App *app)
+{
+    char file[PATH_MAX_LEN];
+    if (!session_default_path(file, sizeof(file))) {
+        return;
+    }
+
+    tabs_sync_from_app(&app->tabs, app);
+
+    SessionTab saved[SESSION_MAX_TABS];
+    const DirectoryState *listings[SESSION_MAX_LISTINGS];
+    int tab_count = 0;
+    int listing_count = 0;
+    int current = 0;
+    if (!app->directory.is_loading && app->directory.error_message[0] == '\0' && app->smart_folder_open < 0) {
+        listings[listing_count++] = &app->directory;
+    }
+    for (int i = 0; i < MAX_TABS && tab_count < SESSION_MAX_TABS; i++) {
+        const Tab *tab = &app->tabs.tabs[i];
+        if (!tab->active) continue;
+        if (i == app->tabs.current) current = tab_count;
+        SessionTab *out = &saved[tab_count++];
+        snprintf(out->path, sizeof(out->path), "%s", tab->path);
+        out->selected_index = tab->selected_index;
+        out->scroll_offset = tab->scroll_offset;
+
+        // Other tabs' listings, if still cached (and so still current)
+        if (strcmp(tab->path, app->directory.current_path) != 0 && listing_count < SESSION_MAX_LISTINGS) {
+            const DirectoryState *cached = dir_cache_get(&app->perf.dir_cache, tab->path);
+            if (cached) listings[listing_count++] = cached;
+        }
+    }
+
+    uint64_t event_id = app->fs_watch_live ? fsevents_current_event_id() : 0;
+    if (!session_save(file, saved, tab_count, current, listings, listing_count, event_id)) {
+        TraceLog(LOG_WARNING, "Could not save the session to %s", file);
+    }
 }
 
-// View mode helpers
-const char* view_mode_name(ViewMode mode)
+// Reopen the tabs of the last session, showing their saved listings at once; the
+// FSEvents journal then replays what changed since, which reloads any listing it
+// touched. False if there is no usable snapshot
+static bool app_restore_session(App *app)
 {
-    switch (mode) {
-        case VIEW_LIST: return "List View";
-        case VIEW_GRID: return "Grid View";
-        case VIEW_COLUMN: return "Column View";
-        default: return "Unknown";
+    char file[PATH_MAX_LEN];
+    if (!session_default_path(file, sizeof(file))) {
+        return false;
+    }
+    Session *session = session_open(file);
+    if (!session) {
+        return false;
+    }
+    int current = session_current_tab(session);
+    const SessionTab *current_tab = session_tab(session, current);
+    if (!current_tab) {
+        session_close(session);
+        return false;
     }
+
+    // Saved listings are only trusted while the journal can say what changed since
+    uint64_t since = session_event_id(session);
+    bool replay = app->fs_watch_live && since > 0 && since <= fsevents_current_event_id();
+
+    int current_index = -1;
+    for (int i = 0; i < session_tab_count(session); i++) {
+        const SessionTab *saved = session_tab(session, i);
+        int index = tabs_new(&app->tabs, saved->path);
+        if (index < 0) continue;
+        app->tabs.tabs[index].selected_index = saved->selected_index;
+        app->tabs.tabs[index].scroll_offset = saved->scroll_offset;
+        if (i == current) current_index = index;
+
+        DirectoryState listing;
+        directory_state_init(&listing);
+        int found = session_find_listing(session, saved->path);
+        if (replay && i != current && found >= 0 && session_restore_listing(session, found, &listing)) {
+            dir_cache_put(&app->perf.dir_cache, saved->path, &listing);
+        }
+        directory_state_free(&listing);
+    }
+    if (current_index >= 0) {
+        app->tabs.current = current_index;
+    }
+
+    int found = session_find_listing(session, current_tab->path);
+    DirectoryState listing;
+    directory_state_init(&listing);
+    bool shown = found >= 0 && session_restore_listing(session, found, &listing);
+    if (shown) {
+        directory_state_free(&app->directory);
+        directory_state_copy(&app->directory, &listing);
+        app->directory.streaming = true;
+        if (replay) {
+            dir_cache_put(&app->perf.dir_cache, listing.current_path, &listing);
+        }
+    }
+    directory_state_free(&listing);
+    if (!shown && !directory_read(&app->directory, current_tab->path)) {
+        session_close(session);
+        return false;
+    }
+    tabs_sync_to_app(&app->tabs, app);
+    session_close(session);
+
+    if (shown && replay) {
+        // Subscribe to the shown folder first so its replayed changes reload it
+        app_watch_sync(app);
+        replay = fs_watch_replay(app->fs_watch, since);
+    }
+    if (shown && !replay) {
+        // No journal to go by: read the folder again on the first frame
+        atomic_store(&app->watch_dir_changed, true);
+    }
+    TraceLog(LOG_INFO, "Restored %d tab(s) from the last session%s", app->tabs.count,
+             shown ? (replay ? ", replaying changes since" : ", rereading") : "");
+    return true;
 }
 
 void app_init(App *app, const char *start_path)
 {
+    // Stores open in the background while the first directory is shown
+    app->index_daemon = index_daemon_running();
+    app_startup_begin(app);
+
     // Initialize theme (default to dark)
+    double phase = startup_phase_begin();
     theme_init(THEME_DARK);
 
     // Initialize custom font (falls back to default if not found)
     font_init("assets/fonts/cozette.ttf");
+    startup_phase_end("fonts", phase, false);
+    phase = startup_phase_begin();
 
     // Window settings
     app->width = DEFAULT_WIDTH;
@@ -449,8 +1479,9 @@ void app_init(App *app, const char *start_path)
     // View mode - load from config if available
     app->view_mode = (ViewMode)g_config.appearance.view_mode;
 
-    // Browser state
+    // Browser state (large folders stream in from a background thread)
     directory_state_init(&app->directory);
+    app->directory.streaming = true;
     app->selected_index = 0;
     app->scroll_offset = 0;
     app->visible_rows = 0;
@@ -458,8 +1489,12 @@ void app_init(App *app, const char *start_path)
     // Multi-selection
     selection_init(&app->selection);
 
+    // Mounted volumes, read in the background
+    app->volumes = volumes_create(0);
+    app->volumes_generation = volumes_generation(app->volumes);
+
     // Sidebar
-    sidebar_init(&app->sidebar);
+    sidebar_init(&app->sidebar, app->volumes);
 
     // Column view
     memset(&app->columns, 0, sizeof(app->columns));
@@ -485,13 +1520,29 @@ void app_init(App *app, const char *start_path)
     app->browser_state.summary_text[0] = '\0';
     app->browser_state.summary_path[0] = '\0';
     app->browser_state.summary_error[0] = '\0';
+    app->browser_state.prefetch_selected = -1;
+    app->browser_state.prefetch_hovered = -1;
+    app->browser_state.prefetch_dir[0] = '\0';
+    app->browser_state.treemap_path[0] = '\0';
 
     // Async summary threading
     pthread_mutex_init(&app->summary_mutex, NULL);
-    atomic_store(&app->summary_thread_active, false);
+    app->summary_executor = summarize_executor_create();
+    if (!app->summary_executor) {
+        TraceLog(LOG_WARNING, "Summary workers could not be started");
+    }
+
+    // Claude model for each feature
+    claude_routing_set_model(CLAUDE_TIER_FAST, g_config.ai.model_fast);
+    claude_routing_set_model(CLAUDE_TIER_BALANCED, g_config.ai.model_balanced);
+    claude_routing_set_model(CLAUDE_TIER_CAPABLE, g_config.ai.model_capable);
+    if (!claude_routing_parse(g_config.ai.model_routing)) {
+        TraceLog(LOG_WARNING, "Ignoring unknown entries in model_routing: %s", g_config.ai.model_routing);
+    }
 
     // Summary system
     summarize_config_init(&app->summary_config);
+    app->summary_config.local_brief = g_config.ai.local_summaries;
 
     // Load API key for summarization from environment variable
     const char *api_key = getenv("CLAUDE_API_KEY");
@@ -501,7 +1552,11 @@ void app_init(App *app, const char *start_path)
     }
 
     summarize_async_init(&app->async_summary_request, &app->summary_mutex);
-    app->summary_cache = summary_cache_create(NULL);  // Uses default path
+    summarize_async_init(&app->menu_summary_request, &app->summary_mutex);
+    for (int i = 0; i < PREFETCH_REQUESTS; i++) {
+        summarize_async_init(&app->prefetch_requests[i], &app->summary_mutex);
+    }
+    app->summary_cache = NULL;  // Opened on the startup thread
     progress_indicator_init(&app->summary_progress, PROGRESS_SPINNER);
     progress_indicator_set_message(&app->summary_progress, "Summarizing...");
 
@@ -533,10 +1588,89 @@ void app_init(App *app, const char *start_path)
     // Git integration
     git_state_init(&app->git);
     git_status_result_init(&app->git_status);
+    app->git_status_path[0] = '\0';
     app->git_enabled = true;
-
-    // Operation queue
+    app->git_async = git_async_create();
+    if (!app->git_async) {
+        TraceLog(LOG_WARNING, "Git status will be read on the UI thread");
+    }
+
+    // Grid view thumbnails, decoded in the background (not from network volumes)
+    app->thumbnails = thumbnails_create();
+    thumbnails_set_volumes(app->thumbnails, app->volumes);
+
+    // Column view listings, read in the background
+    app->listing_prefetch = listing_prefetch_create();
+    if (!app->listing_prefetch) {
+        TraceLog(LOG_WARNING, "Column view listings will be read on the UI thread");
+    }
+
+    // Redraw pacing (the frame texture is created on first draw)
+    app->last_mouse = GetMousePosition();
+    app->last_active_time = GetTime();
+    app->idle = false;
+    platform_wake_start();
+
+    // Shared workers for one-shot background jobs; completions wake the loop
+    jobs_set_wake(platform_wake_main_loop);
+    if (!jobs_start(0)) {
+        TraceLog(LOG_WARNING, "Job workers unavailable, background jobs run inline");
+    }
+
+    // File system watch bus: one stream for every subsystem that follows changes
+    app->fs_watch = fs_watch_create(FS_WATCH_DEFAULT_COALESCE);
+    app->fs_watch_live = app->fs_watch && fs_watch_start(app->fs_watch);
+    tabs_set_watch(&app->tabs, app->fs_watch_live ? app->fs_watch : NULL);
+    if (app->fs_watch && !app->fs_watch_live) {
+        TraceLog(LOG_WARNING, "File system watching unavailable");
+    }
+    app->watch_dir_id = 0;
+    app->watch_git_id = 0;
+    app->watched_dir[0] = '\0';
+    app->watched_git_root[0] = '\0';
+    atomic_store(&app->watch_dir_changed, false);
+    atomic_store(&app->watch_git_changed, false);
+    pthread_mutex_init(&app->watch_mutex, NULL);
+    app->watch_names_root[0] = '\0';
+    app->watch_names = NULL;
+    app->watch_names_size = 0;
+    app->watch_names_capacity = 0;
+    app->watch_name_count = 0;
+
+    // Smart folders follow the bus too; their definitions load with the filename index
+    app->smart_folders = smart_folders_create(app->fs_watch);
+    app->smart_folder_open = -1;
+    app->smart_folder_generation = 0;
+
+    // Folder sizes, kept current by the watch bus
+    app->dir_sizes = dir_sizes_create();
+    dir_sizes_watch(app->dir_sizes, app->fs_watch);
+    app->treemap = app->dir_sizes ? treemap_create(app->dir_sizes) : NULL;
+
+    // Operation queue, and the undo log it records into with the other mutating paths
     operation_queue_init(&app->op_queue);
+    operation_queue_set_dir_sizes(&app->op_queue, app->dir_sizes);
+    operation_queue_set_volumes(&app->op_queue, app->volumes);
+    app->undo_log = NULL;
+    const char *queue_home = getenv("HOME");
+    if (queue_home) {
+        char history_path[4096];
+        snprintf(history_path, sizeof(history_path), "%s/.config/finder-plus", queue_home);
+        mkdir(history_path, 0755);
+        snprintf(history_path, sizeof(history_path), "%s/.config/finder-plus/queue_history.bin", queue_home);
+        operation_queue_set_history_file(&app->op_queue, history_path);
+        snprintf(history_path, sizeof(history_path), "%s/.config/finder-plus", queue_home);
+        int restored = operation_queue_set_tombstone_dir(&app->op_queue, history_path);
+        if (restored > 0) {
+            TraceLog(LOG_WARNING, "Put back %d items an interrupted erase left aside", restored);
+        }
+        snprintf(history_path, sizeof(history_path), "%s/.config/finder-plus/undo.log", queue_home);
+        app->undo_log = undo_log_open(history_path);
+        if (!app->undo_log) {
+            TraceLog(LOG_WARNING, "Undo log could not be opened: %s", history_path);
+        }
+        undo_log_set_shared(app->undo_log);
+    }
     operation_queue_start(&app->op_queue);
     queue_panel_init(&app->queue_panel);
 
@@ -559,28 +1693,60 @@ void app_init(App *app, const char *start_path)
     // Dual pane mode (Phase 8)
     dual_pane_init(&app->dual_pane);
 
-    // Network locations (Phase 8)
+    // Network locations (Phase 8), with their saved profiles
     network_init(&app->network);
-    network_load_profiles(&app->network);
 
     // AI Command bar (Cmd+K)
     command_bar_init(&app->command_bar);
     command_bar_load_auth(&app->command_bar, NULL);
     command_bar_load_gemini_auth(&app->command_bar, NULL);
 
-    // Local AI (Phase 5)
+    startup_phase_end("services", phase, false);
+
+    // Local AI (Phase 5): engines only, their models load on first use and the
+    // database and filename index once the startup thread has them
+    phase = startup_phase_begin();
     app->ai_enabled = true;
     app->ai_indexing = false;
     ai_subsystem_init(app);
+    app->path_index = NULL;
+    app->path_indexer = NULL;
+    app->hash_cache = NULL;
+    index_governor_init(&app->index_governor, embedding_engine_get_threads(app->embedding_engine));
+    app->last_input_time = GetTime();
+    app->index_throttle_next = 0.0;
+    app->index_metrics_next = 0.0;
 
     // Connect AI search to command bar
     command_bar_set_semantic_search(&app->command_bar, app->semantic_search);
     command_bar_set_visual_search(&app->command_bar, app->visual_search);
+    command_bar_set_operation_queue(&app->command_bar, &app->op_queue);
+    command_bar_set_result_budget(&app->command_bar, g_config.ai.tool_result_tokens);
+    char intents_path[4096] = "";
+    if (queue_home) {
+        snprintf(intents_path, sizeof(intents_path), "%s/.config/finder-plus/intents.cache", queue_home);
+    }
+    command_bar_set_intents(&app->command_bar, intents_path[0] ? intents_path : NULL, app->embedding_engine);
 
     // Performance (Phase 8)
+    trace_set_thread_name("main");
     perf_init(&app->perf);
+    dir_cache_watch(&app->perf.dir_cache, app->fs_watch);
+    cache_registry_add(&(CacheClient){ "listings", CACHE_COST_MEDIUM, app_listings_bytes,
+                                       app_listings_trim, &app->perf.dir_cache });
+    cache_registry_add(&(CacheClient){ "tabs", CACHE_COST_MEDIUM, app_tabs_bytes, app_tabs_trim, &app->tabs });
+    cache_registry_add(&(CacheClient){ "textures", CACHE_COST_MEDIUM, app_textures_bytes,
+                                       app_textures_trim, app });
+    cache_registry_add(&(CacheClient){ "attributes", CACHE_COST_LOW, app_attributes_bytes,
+                                       app_attributes_trim, app });
+    app->cache_trim_next = 0.0;
+    if (!platform_memory_pressure_start()) {
+        TraceLog(LOG_WARNING, "Memory pressure notifications unavailable");
+    }
+    app->cached_listing_path[0] = '\0';
     app->fps = 0.0f;
     app->show_perf_stats = false;
+    startup_phase_end("ai", phase, false);
 
     // Text edit state (Phase 8 - context menu)
     app->text_edit_state = TEXT_EDIT_NONE;
@@ -592,8 +1758,10 @@ void app_init(App *app, const char *start_path)
     progress_indicator_init(&app->text_edit_progress, PROGRESS_SPINNER);
     progress_indicator_set_message(&app->text_edit_progress, "Editing with AI...");
 
-    // Load initial directory
+    // Load initial directory: the one asked for, else the last session's tabs
+    phase = startup_phase_begin();
     const char *path = start_path;
+    bool restored = (!path || path[0] == '\0') && app_restore_session(app);
     if (!path || path[0] == '\0') {
         path = getenv("HOME");
         if (!path) {
@@ -601,7 +1769,7 @@ void app_init(App *app, const char *start_path)
         }
     }
 
-    if (!directory_read(&app->directory, path)) {
+    if (!restored && !directory_read(&app->directory, path)) {
         // Fall back to home directory if provided path fails
         const char *home = getenv("HOME");
         if (home && strcmp(path, home) != 0) {
@@ -616,91 +1784,216 @@ void app_init(App *app, const char *start_path)
     history_push(&app->history, app->directory.current_path);
 
     // Create first tab
-    tabs_new(&app->tabs, app->directory.current_path);
+    if (!restored) {
+        tabs_new(&app->tabs, app->directory.current_path);
+    }
 
     // Update breadcrumb with initial path
     breadcrumb_update(&app->breadcrumb, app->directory.current_path);
+    startup_phase_end("directory", phase, false);
+}
+
+bool app_forward_to_running(const char *start_path)
+{
+    char socket_path[PATH_MAX_LEN];
+    if (!instance_socket_file(socket_path, sizeof(socket_path))) {
+        return false;
+    }
+
+    // Resolved here, where a relative path means something; "" asks for the default
+    char resolved[PATH_MAX_LEN] = "";
+    if (start_path && start_path[0] != '\0' && !realpath(start_path, resolved)) {
+        resolved[0] = '\0';
+    }
+    return instance_forward(socket_path, resolved);
+}
+
+void app_accept_windows(App *app)
+{
+    char socket_path[PATH_MAX_LEN];
+    app->instance = NULL;
+    if (instance_socket_file(socket_path, sizeof(socket_path))) {
+        app->instance = instance_listen(socket_path, platform_wake_main_loop);
+    }
+    if (!app->instance) {
+        TraceLog(LOG_WARNING, "Another instance owns the window socket, later launches open their own");
+    }
+    app_start_query_server(app);
 }
 
 void app_free(App *app)
 {
+    // No more launches or queries are taken while shutting down
+    query_server_stop(app->query_server);
+    app->query_server = NULL;
+    instance_stop(app->instance);
+    app->instance = NULL;
+
+    // Whatever the startup thread opened is freed with the rest
+    app_startup_finish(app, true);
+
+    if (!app->replaying) {
+        app_save_session(app);
+    }
+
+    // Builds and watch callbacks stop before the index and search they use go away
+    smart_folders_destroy(app->smart_folders);
+    app->smart_folders = NULL;
+
+    platform_memory_pressure_stop();
+    cache_registry_remove(&app->tabs);
+    cache_registry_remove(app);
+    tabs_free(&app->tabs);
+    search_stop(&app->search);          // Waits out a running content search
     directory_state_free(&app->directory);
     selection_free(&app->selection);
+    clipboard_free(&app->clipboard);
     preview_free(&app->preview);
     file_view_modal_free(&app->file_view_modal);
+    git_async_destroy(app->git_async);
+    app->git_async = NULL;
+    listing_prefetch_destroy(app->listing_prefetch);
+    app->listing_prefetch = NULL;
     git_state_free(&app->git);
     git_status_result_free(&app->git_status);
+    git_release_cache();
     operation_queue_free(&app->op_queue);
+    undo_log_close(app->undo_log);
+    app->undo_log = NULL;
+    treemap_destroy(app->treemap);
+    app->treemap = NULL;
+    dir_sizes_destroy(app->dir_sizes);
+    app->dir_sizes = NULL;
     palette_free(&app->palette);
     keybindings_free(&app->keybindings);
     dual_pane_free(&app->dual_pane);
     network_shutdown(&app->network);
     command_bar_free(&app->command_bar);
+    thumbnails_destroy(app->thumbnails);
+    app->thumbnails = NULL;
+    if (app->shards_sync) {
+        // The volumes' index databases are attached by a job reading both
+        job_token_wait(app->shards_sync);
+        job_token_release(app->shards_sync);
+        app->shards_sync = NULL;
+    }
+    volumes_destroy(app->volumes);
+    app->volumes = NULL;
+    platform_wake_stop();
+    if (app->frame.id != 0) {
+        UnloadRenderTexture(app->frame);
+        app->frame.id = 0;
+    }
 
     // Free custom font
     font_free();
 
     // Clean up Local AI (Phase 5)
     ai_subsystem_free(app);
+    path_index_subsystem_free(app);
 
-    // Clean up async summary thread
-    if (atomic_load(&app->summary_thread_active)) {
-        summarize_async_cancel(&app->async_summary_request);
-        pthread_join(app->summary_thread, NULL);
-        atomic_store(&app->summary_thread_active, false);
+    // Clean up async summary workers
+    summarize_async_cancel(&app->async_summary_request);
+    summarize_async_cancel(&app->menu_summary_request);
+    for (int i = 0; i < PREFETCH_REQUESTS; i++) {
+        summarize_async_cancel(&app->prefetch_requests[i]);
     }
+    summarize_executor_destroy(app->summary_executor);
+    app->summary_executor = NULL;
+    summarize_shutdown();
     pthread_mutex_destroy(&app->summary_mutex);
 
     // Clean up summary cache
     if (app->summary_cache) {
+        cache_registry_remove(app->summary_cache);
         summary_cache_destroy(app->summary_cache);
         app->summary_cache = NULL;
     }
 
+    // Queued jobs are cancelled, running ones finish
+    jobs_stop();
+    extract_pool_stop();
+
+    // No request is running any more: close pooled connections, drop prepared uploads
+    http_client_shutdown();
+    image_upload_shutdown();
+
+    arena_free(frame_arena());
+    cache_registry_remove(&app->perf.dir_cache);
     perf_free(&app->perf);
+
+    // Last: the indexers and dir cache above held subscriptions on it
+    if (app->fs_watch) {
+        fs_watch_destroy(app->fs_watch);
+        app->fs_watch = NULL;
+    }
+    free(app->watch_names);             // No dispatch thread can queue more
+    app->watch_names = NULL;
+    pthread_mutex_destroy(&app->watch_mutex);
+}
+
+// Entries may be shared with the directory cache: only copy them when a status changes
+static void app_set_entry_git_status(App *app, int index, FileGitStatus status)
+{
+    directory_set_git_status(&app->directory, index, (uint8_t)status);
 }
 
-// Update git status for the current directory
+// Badge each entry from app->git_status, if it was read for the listed directory
+static void app_annotate_git_status(App *app)
+{
+    bool current = app->git.is_repo && strcmp(app->git_status_path, app->directory.current_path) == 0;
+
+    // One indexed lookup per entry; folders take the status of what they hold
+    for (int i = 0; i < app->directory.count; i++) {
+        FileEntry *entry = &app->directory.entries[i];
+        GitFileStatus status = current ? git_get_file_status(&app->git_status,
+                                                             directory_entry_name(&app->directory, entry))
+                                       : GIT_STATUS_NONE;
+
+        // Map GitFileStatus to FileGitStatus
+        FileGitStatus mapped;
+        switch (status) {
+            case GIT_STATUS_UNTRACKED: mapped = FILE_GIT_UNTRACKED; break;
+            case GIT_STATUS_MODIFIED:  mapped = FILE_GIT_MODIFIED; break;
+            case GIT_STATUS_STAGED:    mapped = FILE_GIT_STAGED; break;
+            case GIT_STATUS_DELETED:   mapped = FILE_GIT_DELETED; break;
+            case GIT_STATUS_RENAMED:   mapped = FILE_GIT_RENAMED; break;
+            case GIT_STATUS_CONFLICT:  mapped = FILE_GIT_CONFLICT; break;
+            case GIT_STATUS_IGNORED:   mapped = FILE_GIT_IGNORED; break;
+            default: mapped = FILE_GIT_NONE; break;
+        }
+        app_set_entry_git_status(app, i, mapped);
+    }
+}
+
+// Update git status for the current directory. It is read in the background and badges
+// fill in when it arrives (app_update); until then a re-read listing keeps the badges of
+// the last status read for it
 static void app_update_git_status(App *app)
 {
+    TRACE_SCOPE("app_update_git_status");
     if (!app->git_enabled) {
         app->git.is_repo = false;
         return;
     }
 
-    // Update repository state
-    git_update_state(&app->git, app->directory.current_path);
-
-    // Get file statuses
-    git_status_result_free(&app->git_status);
-    git_status_result_init(&app->git_status);
+    // Watch the repository before reading it, so a change during the scan is reported
+    char root[GIT_PATH_MAX_LEN];
+    if (!git_get_repo_root(app->directory.current_path, root, sizeof(root))) {
+        root[0] = '\0';
+    }
+    app_watch_git_root(app, root);
 
-    if (app->git.is_repo) {
-        git_get_status(app->directory.current_path, &app->git_status);
-
-        // Update git_status for each file entry
-        for (int i = 0; i < app->directory.count; i++) {
-            FileEntry *entry = &app->directory.entries[i];
-            GitFileStatus status = git_get_file_status(&app->git_status, entry->name);
-
-            // Map GitFileStatus to FileGitStatus
-            switch (status) {
-                case GIT_STATUS_UNTRACKED: entry->git_status = FILE_GIT_UNTRACKED; break;
-                case GIT_STATUS_MODIFIED:  entry->git_status = FILE_GIT_MODIFIED; break;
-                case GIT_STATUS_STAGED:    entry->git_status = FILE_GIT_STAGED; break;
-                case GIT_STATUS_DELETED:   entry->git_status = FILE_GIT_DELETED; break;
-                case GIT_STATUS_RENAMED:   entry->git_status = FILE_GIT_RENAMED; break;
-                case GIT_STATUS_CONFLICT:  entry->git_status = FILE_GIT_CONFLICT; break;
-                case GIT_STATUS_IGNORED:   entry->git_status = FILE_GIT_IGNORED; break;
-                default: entry->git_status = FILE_GIT_NONE; break;
-            }
-        }
+    if (app->git_async) {
+        git_async_request(app->git_async, app->directory.current_path);
     } else {
-        // Clear git status for all entries
-        for (int i = 0; i < app->directory.count; i++) {
-            app->directory.entries[i].git_status = FILE_GIT_NONE;
-        }
+        // No reader thread: repository state and file statuses in one pass, here
+        git_status_result_free(&app->git_status);
+        git_refresh(&app->git, &app->git_status, app->directory.current_path);
+        strncpy(app->git_status_path, app->directory.current_path, PATH_MAX_LEN - 1);
+        app->git_status_path[PATH_MAX_LEN - 1] = '\0';
     }
+    app_annotate_git_status(app);
 }
 
 // Helper to enter rename mode
@@ -711,7 +2004,7 @@ static void app_enter_rename_mode(App *app)
     FileEntry *entry = &app->directory.entries[app->selected_index];
     app->rename_mode = true;
     app->rename_index = app->selected_index;
-    strncpy(app->rename_buffer, entry->name, NAME_MAX_LEN - 1);
+    strncpy(app->rename_buffer, directory_entry_name(&app->directory, entry), NAME_MAX_LEN - 1);
     app->rename_buffer[NAME_MAX_LEN - 1] = '\0';
     app->rename_cursor = (int)strlen(app->rename_buffer);
 }
@@ -724,8 +2017,11 @@ static void app_exit_rename_mode(App *app, bool apply)
     if (apply && app->rename_index >= 0 && app->rename_index < app->directory.count) {
         // Apply rename if name changed
         FileEntry *entry = &app->directory.entries[app->rename_index];
-        if (strcmp(entry->name, app->rename_buffer) != 0 && app->rename_buffer[0] != '\0') {
-            OperationResult result = file_rename(entry->path, app->rename_buffer);
+        if (strcmp(directory_entry_name(&app->directory, entry), app->rename_buffer) != 0 &&
+            app->rename_buffer[0] != '\0') {
+            char path[PATH_MAX_LEN];
+            directory_entry_path(&app->directory, entry, path, sizeof(path));
+            OperationResult result = file_rename(path, app->rename_buffer);
             if (result == OP_SUCCESS) {
                 // Refresh directory to show new name
                 directory_read(&app->directory, app->directory.current_path);
@@ -851,8 +2147,8 @@ static bool app_handle_text_edit_input(App *app)
     // Handle success/error states - dismiss on any key
     if (app->text_edit_state == TEXT_EDIT_SUCCESS ||
         app->text_edit_state == TEXT_EDIT_ERROR) {
-        int key = GetKeyPressed();
-        if (key != 0 || IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+        const int *keys;
+        if (keybindings_frame_keys(&keys) > 0 || IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
             app->text_edit_state = TEXT_EDIT_NONE;
             app->text_edit_path[0] = '\0';
             app->text_edit_prompt[0] = '\0';
@@ -943,6 +2239,8 @@ static bool app_handle_text_edit_input(App *app)
 
 void app_handle_input(App *app)
 {
+    keybindings_poll_keys();
+
     // Handle dialog input first (modal, blocks everything else)
     if (dialog_handle_input(app)) {
         return; // Dialog is active, don't process other input
@@ -1031,12 +2329,15 @@ void app_handle_input(App *app)
         theme_toggle();
     }
 
-    // Toggle performance stats display: Cmd+Shift+P
-    if (cmd_down && shift_down && IsKeyPressed(KEY_P)) {
+    // Start/stop a trace recording: Cmd+Alt+Shift+P; toggle performance stats display: Cmd+Shift+P
+    bool alt_down = IsKeyDown(KEY_LEFT_ALT) || IsKeyDown(KEY_RIGHT_ALT);
+    if (cmd_down && shift_down && alt_down && IsKeyPressed(KEY_P)) {
+        app_toggle_trace(app);
+    } else if (cmd_down && shift_down && IsKeyPressed(KEY_P)) {
         app->show_perf_stats = !app->show_perf_stats;
     }
 
-    // View mode switching: Cmd+1/2/3
+    // View mode switching: Cmd+1/2/3/4
     if (cmd_down && IsKeyPressed(KEY_ONE)) {
         app->view_mode = VIEW_LIST;
         g_config.appearance.view_mode = CONFIG_VIEW_LIST;
@@ -1052,6 +2353,11 @@ void app_handle_input(App *app)
         g_config.appearance.view_mode = CONFIG_VIEW_COLUMN;
         config_save(&g_config);
     }
+    if (cmd_down && IsKeyPressed(KEY_FOUR)) {
+        app->view_mode = VIEW_TREEMAP;
+        g_config.appearance.view_mode = CONFIG_VIEW_TREEMAP;
+        config_save(&g_config);
+    }
 
     // Toggle dual pane mode: F3 or Cmd+Shift+D
     if (IsKeyPressed(KEY_F3) || (cmd_down && shift_down && IsKeyPressed(KEY_D))) {
@@ -1090,7 +2396,7 @@ void app_handle_input(App *app)
     if (cmd_down && IsKeyPressed(KEY_LEFT_BRACKET)) {
         const char *path = history_back(&app->history);
         if (path) {
-            directory_read(&app->directory, path);
+            directory_read_cached(&app->directory, path, &app->perf.dir_cache);
             app->selected_index = 0;
             app->scroll_offset = 0;
             selection_clear(&app->selection);
@@ -1101,7 +2407,7 @@ void app_handle_input(App *app)
     if (cmd_down && IsKeyPressed(KEY_RIGHT_BRACKET)) {
         const char *path = history_forward(&app->history);
         if (path) {
-            directory_read(&app->directory, path);
+            directory_read_cached(&app->directory, path, &app->perf.dir_cache);
             app->selected_index = 0;
             app->scroll_offset = 0;
             selection_clear(&app->selection);
@@ -1116,36 +2422,30 @@ void app_handle_input(App *app)
     if ((cmd_down && IsKeyPressed(KEY_C)) || (!cmd_down && !shift_down && IsKeyPressed(KEY_Y))) {
         if (app->directory.count > 0) {
             // Collect selected paths
-            const char *paths[MAX_SELECTION];
-            int path_count = 0;
-
             if (app->selection.count > 0) {
-                for (int i = 0; i < app->selection.count && i < MAX_SELECTION; i++) {
-                    paths[path_count++] = app->directory.entries[app->selection.indices[i]].path;
-                }
+                app_clipboard_take_selection(app, OP_COPY);
             } else {
-                paths[path_count++] = app->directory.entries[app->selected_index].path;
+                char path[PATH_MAX_LEN];
+                const char *paths[] = { directory_entry_path(&app->directory,
+                                                             &app->directory.entries[app->selected_index],
+                                                             path, sizeof(path)) };
+                clipboard_copy(&app->clipboard, paths, 1);
             }
-
-            clipboard_copy(&app->clipboard, paths, path_count);
         }
     }
 
     // Cut: Cmd+X or dd
     if ((cmd_down && IsKeyPressed(KEY_X)) || (!cmd_down && !shift_down && IsKeyPressed(KEY_D))) {
         if (app->directory.count > 0) {
-            const char *paths[MAX_SELECTION];
-            int path_count = 0;
-
             if (app->selection.count > 0) {
-                for (int i = 0; i < app->selection.count && i < MAX_SELECTION; i++) {
-                    paths[path_count++] = app->directory.entries[app->selection.indices[i]].path;
-                }
+                app_clipboard_take_selection(app, OP_CUT);
             } else {
-                paths[path_count++] = app->directory.entries[app->selected_index].path;
+                char path[PATH_MAX_LEN];
+                const char *paths[] = { directory_entry_path(&app->directory,
+                                                             &app->directory.entries[app->selected_index],
+                                                             path, sizeof(path)) };
+                clipboard_cut(&app->clipboard, paths, 1);
             }
-
-            clipboard_cut(&app->clipboard, paths, path_count);
         }
     }
 
@@ -1155,7 +2455,7 @@ void app_handle_input(App *app)
         clipboard_sync_from_system(&app->clipboard);
 
         if (clipboard_has_items(&app->clipboard)) {
-            clipboard_paste(&app->clipboard, app->directory.current_path);
+            operation_queue_paste(&app->op_queue, &app->clipboard, app->directory.current_path);
             // Refresh directory
             directory_read(&app->directory, app->directory.current_path);
             selection_clear(&app->selection);
@@ -1163,7 +2463,7 @@ void app_handle_input(App *app)
         }
     }
 
-    // Delete: Cmd+Backspace - show confirmation dialog
+    // Delete: Cmd+Backspace (Trash) or Cmd+Alt+Backspace (immediately) - show confirmation dialog
     if (cmd_down && IsKeyPressed(KEY_BACKSPACE)) {
         if (app->directory.count > 0) {
             // Build confirmation message
@@ -1173,18 +2473,32 @@ void app_handle_input(App *app)
             if (count == 1) {
                 const char *name;
                 if (app->selection.count > 0) {
-                    name = app->directory.entries[app->selection.indices[0]].name;
+                    name = directory_entry_name(&app->directory,
+                                                &app->directory.entries[selection_next(&app->selection, 0)]);
                 } else {
-                    name = app->directory.entries[app->selected_index].name;
+                    name = directory_entry_name(&app->directory,
+                                                &app->directory.entries[app->selected_index]);
                 }
+                if (alt_down) {
+                    snprintf(message, sizeof(message),
+                             "Delete \"%s\" immediately? This can't be undone.", name);
+                } else {
+                    snprintf(message, sizeof(message),
+                             "Move \"%s\" to Trash?", name);
+                }
+            } else if (alt_down) {
                 snprintf(message, sizeof(message),
-                         "Move \"%s\" to Trash?", name);
+                         "Delete %d items immediately? This can't be undone.", count);
             } else {
                 snprintf(message, sizeof(message),
                          "Move %d items to Trash?", count);
             }
 
-            dialog_confirm(&app->dialog, "Delete", message, perform_delete_confirmed);
+            if (alt_down) {
+                dialog_confirm(&app->dialog, "Delete Immediately", message, perform_erase_confirmed);
+            } else {
+                dialog_confirm(&app->dialog, "Delete", message, perform_delete_confirmed);
+            }
         }
     }
 
@@ -1206,11 +2520,12 @@ void app_handle_input(App *app)
         OperationResult result = file_create_directory(app->directory.current_path, new_name);
         if (result == OP_SUCCESS) {
             directory_read(&app->directory, app->directory.current_path);
+            directory_stream_wait(&app->directory);  // New folder may be past the first batch
             app_update_git_status(app);
 
             // Find the new folder and select it
             for (int i = 0; i < app->directory.count; i++) {
-                if (strcmp(app->directory.entries[i].name, new_name) == 0) {
+                if (strcmp(directory_entry_name(&app->directory, &app->directory.entries[i]), new_name) == 0) {
                     app->selected_index = i;
                     selection_clear(&app->selection);
                     browser_ensure_visible(app);
@@ -1226,12 +2541,17 @@ void app_handle_input(App *app)
     // Duplicate: Cmd+D
     if (cmd_down && IsKeyPressed(KEY_D)) {
         if (app->directory.count > 0) {
+            char path[PATH_MAX_LEN];
             if (app->selection.count > 0) {
-                for (int i = 0; i < app->selection.count; i++) {
-                    file_duplicate(app->directory.entries[app->selection.indices[i]].path);
+                for (int i = selection_next(&app->selection, 0); i >= 0 && i < app->directory.count;
+                     i = selection_next(&app->selection, i + 1)) {
+                    file_duplicate(directory_entry_path(&app->directory, &app->directory.entries[i],
+                                                        path, sizeof(path)));
                 }
             } else {
-                file_duplicate(app->directory.entries[app->selected_index].path);
+                file_duplicate(directory_entry_path(&app->directory,
+                                                    &app->directory.entries[app->selected_index],
+                                                    path, sizeof(path)));
             }
             directory_read(&app->directory, app->directory.current_path);
             app_update_git_status(app);
@@ -1287,7 +2607,7 @@ void app_handle_input(App *app)
     if (IsKeyPressed(KEY_L) || IsKeyPressed(KEY_RIGHT) || IsKeyPressed(KEY_ENTER)) {
         if (app->directory.count > 0) {
             FileEntry *entry = &app->directory.entries[app->selected_index];
-            if (entry->is_directory) {
+            if (directory_entry_enterable(&app->directory, entry)) {
                 if (directory_enter(&app->directory, app->selected_index)) {
                     app->selected_index = 0;
                     app->scroll_offset = 0;
@@ -1365,12 +2685,14 @@ void app_handle_input(App *app)
     // Handle tabs input
     tabs_handle_input(app);
 
-    // Update preview if selection changed
+    // Follow the selection; contents load once the cursor rests (see preview_select)
     if (preview_is_visible(&app->preview) && app->directory.count > 0) {
         FileEntry *entry = &app->directory.entries[app->selected_index];
         if (!entry->is_directory) {
-            preview_load(&app->preview, entry->path);
-        } else {
+            char path[PATH_MAX_LEN];
+            directory_entry_path(&app->directory, entry, path, sizeof(path));
+            preview_select(&app->preview, path, entry->modified, entry->size, GetTime());
+        } else if (app->preview.type != PREVIEW_NONE) {
             preview_clear(&app->preview);
         }
     }
@@ -1379,12 +2701,371 @@ void app_handle_input(App *app)
     tabs_sync_from_app(&app->tabs, app);
 }
 
+// Keep a copy of each fully loaded listing so history and tab switches are instant
+static void app_cache_listing(App *app)
+{
+    DirectoryState *dir = &app->directory;
+    if (dir->is_loading || dir->error_message[0] != '\0' || app->smart_folder_open >= 0 ||
+        strcmp(app->cached_listing_path, dir->current_path) == 0) {
+        return;
+    }
+
+    if (!dir_cache_get(&app->perf.dir_cache, dir->current_path)) {
+        dir_cache_put(&app->perf.dir_cache, dir->current_path, dir);
+    }
+    strncpy(app->cached_listing_path, dir->current_path, PATH_MAX_LEN - 1);
+    app->cached_listing_path[PATH_MAX_LEN - 1] = '\0';
+}
+
+// Whether the user touched the mouse or keyboard this frame (leaves the key queue alone)
+static bool app_has_input(void)
+{
+    Vector2 delta = GetMouseDelta();
+    if (delta.x != 0.0f || delta.y != 0.0f || GetMouseWheelMove() != 0.0f) {
+        return true;
+    }
+    if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) || IsMouseButtonDown(MOUSE_BUTTON_RIGHT) ||
+        IsMouseButtonDown(MOUSE_BUTTON_MIDDLE)) {
+        return true;
+    }
+    for (int key = KEY_SPACE; key <= KEY_GRAVE; key++) {
+        if (IsKeyDown(key)) return true;
+    }
+    for (int key = KEY_ESCAPE; key <= KEY_KB_MENU; key++) {
+        if (IsKeyDown(key)) return true;
+    }
+    return false;
+}
+
+// Whether something on screen moves or waits on background work, so every frame is drawn
+static bool app_is_animating(App *app)
+{
+    return app->directory.is_loading ||
+           app->rubber_band_active ||
+           app->preview.video_playing ||
+           (app->preview.video_inpane_active && !app->preview.video_paused) ||
+           app->preview.edit_state == IMAGE_EDIT_LOADING ||
+           app->text_edit_state == TEXT_EDIT_LOADING ||
+           summarize_async_is_busy(&app->menu_summary_request) ||
+           summarize_async_is_busy(&app->async_summary_request) ||
+           command_bar_is_active(&app->command_bar) ||
+           operation_queue_is_processing(&app->op_queue) ||
+           thumbnails_is_busy(app->thumbnails) ||
+           preview_is_loading(&app->preview) ||
+           dual_pane_is_comparing(&app->dual_pane) ||
+           dir_sizes_is_busy(app->dir_sizes) ||
+           (app->view_mode == VIEW_TREEMAP && treemap_is_busy(app->treemap)) ||
+           browser_treemap_is_stale(app) ||
+           listing_prefetch_is_busy(app->listing_prefetch);
+}
+
+// Helper: Mark the pane under a point for redraw (sidebar, content or status bar)
+static void app_dirty_pane_at(App *app, Vector2 point)
+{
+    int content_x = sidebar_get_content_x(app);
+    int status_y = app->height - STATUSBAR_HEIGHT;
+    if (point.y >= status_y) {
+        dirty_add(&app->perf.dirty, 0, status_y, app->width, STATUSBAR_HEIGHT);
+    } else if (point.x < content_x) {
+        dirty_add(&app->perf.dirty, 0, 0, content_x, status_y);
+    } else {
+        dirty_add(&app->perf.dirty, content_x, 0, app->width - content_x, status_y);
+    }
+}
+
+// Decide what to redraw this frame, and whether the loop may sleep until the next event
+static void app_update_redraw(App *app)
+{
+    DirtyRectTracker *dirty = &app->perf.dirty;
+    double now = GetTime();
+    Vector2 mouse = GetMousePosition();
+
+    bool pressed = IsWindowResized() || GetMouseWheelMove() != 0.0f;
+    for (int button = MOUSE_BUTTON_LEFT; button <= MOUSE_BUTTON_MIDDLE && !pressed; button++) {
+        pressed = IsMouseButtonDown(button) || IsMouseButtonReleased(button);
+    }
+    for (int key = KEY_SPACE; key <= KEY_KB_MENU && !pressed; key++) {
+        pressed = IsKeyDown(key) || IsKeyReleased(key);
+    }
+    bool moved = mouse.x != app->last_mouse.x || mouse.y != app->last_mouse.y;
+    bool busy = app_is_animating(app);
+
+    // Overlays span the panes, so hovering them redraws everything
+    bool overlay = dialog_is_visible(&app->dialog) || context_menu_is_visible(&app->context_menu) ||
+                   palette_is_visible(&app->palette) || file_view_modal_is_visible(&app->file_view_modal) ||
+                   app->text_edit_state != TEXT_EDIT_NONE;
+
+    // Background results applied earlier this frame have already marked the screen
+    if (pressed || moved || busy || dirty_needs_redraw(dirty)) {
+        app->last_active_time = now;
+    }
+
+    if (app->idle || pressed || busy || (moved && overlay)) {
+        // Woken from sleep (input, a background change or the heartbeat), or anything that
+        // may touch more than the pane under the mouse
+        dirty_full(dirty);
+    } else if (moved) {
+        // Hover only changes the panes the mouse left and entered
+        app_dirty_pane_at(app, app->last_mouse);
+        app_dirty_pane_at(app, mouse);
+    }
+    app->last_mouse = mouse;
+
+    // Sleep once nothing has happened for a moment; the heartbeat keeps blinking cursors
+    // and polled work going
+    bool idle = now - app->last_active_time > REDRAW_ACTIVE_SECONDS;
+    if (idle != app->idle) {
+        app->idle = idle;
+        if (idle) {
+            EnableEventWaiting();
+        } else {
+            DisableEventWaiting();
+        }
+        platform_wake_set_idle(idle ? REDRAW_HEARTBEAT : 0.0);
+
+        // Frames while asleep measure the wait for events, not the work
+        timing_set_paused(&app->perf.timings, idle);
+    }
+}
+
+// Pace frames to the display the window is on: its refresh rate, or the configured cap.
+// Checked periodically, as the window can move to another display
+static void app_update_frame_pacing(App *app)
+{
+    double now = GetTime();
+    if (now < app->pacing_check_time) {
+        return;
+    }
+    app->pacing_check_time = now + FRAME_PACING_CHECK_SECONDS;
+
+    int refresh_rate = GetMonitorRefreshRate(GetCurrentMonitor());
+    if (refresh_rate <= 0) refresh_rate = 60;
+
+    int cap = g_config.performance.frame_rate;
+    int frame_rate = (cap < 0) ? 0 : (cap > 0) ? cap : refresh_rate;
+    if (frame_rate == app->frame_rate && refresh_rate == app->refresh_rate) {
+        return;
+    }
+
+    app->frame_rate = frame_rate;
+    app->refresh_rate = refresh_rate;
+    SetTargetFPS(frame_rate);
+    timing_set_target(&app->perf.timings,
+                      (frame_rate > 0 && frame_rate < refresh_rate) ? frame_rate : refresh_rate);
+}
+
+// Pace the indexers to the machine: back off while the user works, on battery or when
+// hot, and speed up again once the machine is left alone
+static void app_update_index_throttle(App *app)
+{
+    double now = GetTime();
+    if (app_has_input()) {
+        app->last_input_time = now;
+    }
+    if (now < app->index_throttle_next || (!app->indexer && !app->path_indexer)) {
+        return;
+    }
+    app->index_throttle_next = now + INDEX_THROTTLE_INTERVAL;
+
+    IndexGovernorInput input = {0};
+    platform_sample_load(&input.load);
+    input.idle_seconds = now - app->last_input_time;
+    input.frame_time_p95 = timing_get_percentile(&app->perf.timings, 0.95f);
+    input.frame_budget = timing_target_frame_time(&app->perf.timings);
+
+    IndexerThrottle throttle = index_governor_update(&app->index_governor, &input, now);
+    if (app->indexer) {
+        indexer_set_throttle(app->indexer, &throttle);
+    }
+    if (app->path_indexer) {
+        indexer_set_throttle(app->path_indexer, &throttle);
+    }
+}
+
+// Folders handed over by later launches: each opens in a new tab, and the window comes
+// to the front
+static void app_open_forwarded(App *app)
+{
+    char path[PATH_MAX_LEN];
+    bool opened = false;
+    while (instance_take(app->instance, path, sizeof(path))) {
+        // Nothing asked for (or gone since) opens home; a file opens its folder
+        struct stat st;
+        if (path[0] == '\0' || stat(path, &st) != 0) {
+            const char *home = getenv("HOME");
+            snprintf(path, sizeof(path), "%s", home ? home : "/");
+        } else if (!S_ISDIR(st.st_mode)) {
+            char *slash = strrchr(path, '/');
+            if (slash == path) {
+                slash[1] = '\0';
+            } else {
+                *slash = '\0';
+            }
+        }
+
+        if (tabs_open(app, path) < 0) {
+            TraceLog(LOG_WARNING, "No free tab to open %s", path);
+            continue;
+        }
+        opened = true;
+    }
+
+    if (opened) {
+        if (IsWindowMinimized()) {
+            RestoreWindow();
+        }
+        SetWindowFocused();
+        dirty_full(&app->perf.dirty);
+    }
+}
+
+// Keep the caches within their shared budget, and give memory back at once when the
+// system runs short
+static void app_trim_caches(App *app)
+{
+    PlatformMemoryPressure level = platform_memory_pressure_take();
+    double now = GetTime();
+    if (level == PLATFORM_MEMORY_NORMAL && now < app->cache_trim_next) {
+        return;
+    }
+    app->cache_trim_next = now + CACHE_TRIM_INTERVAL;
+
+    CachePressure pressure = level == PLATFORM_MEMORY_CRITICAL ? CACHE_PRESSURE_CRITICAL
+                           : level == PLATFORM_MEMORY_WARN ? CACHE_PRESSURE_WARN
+                           : CACHE_PRESSURE_NONE;
+    size_t released = cache_registry_update(pressure);
+    if (pressure != CACHE_PRESSURE_NONE) {
+        TraceLog(LOG_INFO, "Memory pressure: released %.1f MB of caches", released / (1024.0 * 1024.0));
+    }
+    if (released > 0) {
+        dirty_full(&app->perf.dirty);
+    }
+}
+
+// While the semantic indexer works (or the performance stats are shown), append its
+// stats to ~/.config/finder-plus/indexer-metrics.jsonl for graphing across machines
+static void app_export_index_metrics(App *app)
+{
+    double now = GetTime();
+    if (!app->indexer || now < app->index_metrics_next) {
+        return;
+    }
+    app->index_metrics_next = now + INDEX_METRICS_INTERVAL;
+    if (!indexer_is_busy(app->indexer) && !app->show_perf_stats) {
+        return;
+    }
+
+    const char *home = getenv("HOME");
+    if (!home) {
+        return;
+    }
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/.config/finder-plus/indexer-metrics.jsonl", home);
+    IndexerStats stats = indexer_get_stats(app->indexer);
+    indexer_write_metrics(&stats, path);
+}
+
+// Helper: Select an edited image in the listing and preview it at once, decoded in the
+// background, rather than once the cursor rests on it
+static void app_show_edited_image(App *app, const char *path)
+{
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    directory_stream_wait(&app->directory);  // New file may be past the first batch
+    for (int i = 0; i < app->directory.count; i++) {
+        FileEntry *entry = &app->directory.entries[i];
+        if (strcmp(directory_entry_name(&app->directory, entry), name) == 0) {
+            app->selected_index = i;
+            selection_clear(&app->selection);
+            browser_ensure_visible(app);
+            preview_load(&app->preview, path);
+            app->preview.file_mtime = entry->modified;
+            app->preview.file_size = entry->size;
+            return;
+        }
+    }
+}
+
 void app_update(App *app)
 {
+    TRACE_SCOPE("app_update");
     app->fps = GetFPS();
+    app_update_frame_pacing(app);
+
+    timing_section_begin(&app->perf.timings, FRAME_SECTION_ASYNC);
+    // Background results this frame takes on, measured against the pacing target
+    frame_work_begin(timing_work_budget(&app->perf.timings));
+
+    // Merge entries from a background directory enumeration, badged from the status at
+    // hand; read the status again once complete. Each batch is merged in sorted, moving
+    // the entries already listed, so the cursor and selection follow their files by name
+    if (app->directory.stream && app_keep_marks(app, listing_stream_merge, NULL) > 0) {
+        dirty_full(&app->perf.dirty);
+        if (app->directory.is_loading) {
+            app_annotate_git_status(app);
+        } else {
+            app_update_git_status(app);
+        }
+    }
+
+    // Badge the listing once the background git read arrives
+    if (git_async_poll(app->git_async, &app->git, &app->git_status,
+                       app->git_status_path, sizeof(app->git_status_path))) {
+        app_annotate_git_status(app);
+        dirty_full(&app->perf.dirty);
+    }
+
+    // Keep column view listings read in the background
+    char listing_path[PATH_MAX_LEN];
+    DirectoryState listing;
+    while (listing_prefetch_poll(app->listing_prefetch, listing_path, sizeof(listing_path), &listing)) {
+        dir_cache_put(&app->perf.dir_cache, listing_path, &listing);
+        directory_state_free(&listing);
+        dirty_full(&app->perf.dirty);
+    }
+
+    // Follow changes made outside the app
+    app_apply_watch_changes(app);
+    app_sync_smart_folder(app);
+
+    // Finished background jobs, the most urgent first, within this frame's allowance
+    double work_left = frame_work_remaining();
+    jobs_drain_completions(work_left > 0 ? work_left : FRAME_WORK_MIN);
+
+    // Later launches of the app
+    app_open_forwarded(app);
+
+    // Volumes mounted or unmounted
+    uint64_t mounts_generation = volumes_generation(app->volumes);
+    if (mounts_generation != app->volumes_generation) {
+        app->volumes_generation = mounts_generation;
+        sidebar_refresh_volumes(&app->sidebar, app->volumes);
+        app_sync_index_shards(app);
+        dirty_full(&app->perf.dirty);
+    }
+
+    // Network sessions checked, and reconnected in the background when lost
+    if (network_update(&app->network)) {
+        dirty_full(&app->perf.dirty);
+    }
+
+    // Stores opened in the background since startup
+    if (!app->startup.adopted && app_startup_finish(app, false)) {
+        dirty_full(&app->perf.dirty);
+    }
 
     // Update performance systems
     perf_update(&app->perf, GetFrameTime());
+    if (thumbnails_begin_frame(app->thumbnails)) {
+        dirty_full(&app->perf.dirty);
+    }
+    app_cache_listing(app);
+    timing_section_end(&app->perf.timings, FRAME_SECTION_ASYNC);
+
+    timing_section_begin(&app->perf.timings, FRAME_SECTION_INPUT);
+    app_update_index_throttle(app);
+    app_export_index_metrics(app);
+    app_trim_caches(app);
 
     // Calculate content area dimensions
     int content_width = sidebar_get_content_width(app);
@@ -1410,7 +3091,7 @@ void app_update(App *app)
     command_bar_update(&app->command_bar, GetFrameTime());
 
     // Update summary progress indicator animation
-    if (atomic_load(&app->summary_thread_active)) {
+    if (summarize_async_is_busy(&app->menu_summary_request)) {
         progress_indicator_update(&app->summary_progress, GetFrameTime());
     }
 
@@ -1424,6 +3105,22 @@ void app_update(App *app)
         progress_indicator_update(&app->text_edit_progress, GetFrameTime());
     }
 
+    // Commands the bar resolved without Claude
+    char local_command[1024];
+    if (command_bar_take_command(&app->command_bar, local_command, sizeof(local_command))) {
+        palette_execute(app, local_command);
+    }
+    if (command_bar_take_path(&app->command_bar, local_command, sizeof(local_command)) &&
+        directory_read(&app->directory, local_command)) {
+        app->selected_index = 0;
+        app->scroll_offset = 0;
+        selection_clear(&app->selection);
+        history_push(&app->history, app->directory.current_path);
+        breadcrumb_update(&app->breadcrumb, app->directory.current_path);
+        app_update_git_status(app);
+        command_bar_set_current_dir(&app->command_bar, app->directory.current_path);
+    }
+
     // Check if command bar operations require directory refresh
     if (command_bar_needs_refresh(&app->command_bar)) {
         directory_read(&app->directory, app->directory.current_path);
@@ -1451,24 +3148,35 @@ void app_update(App *app)
             gemini_edit_request_set_prompt(&req, app->preview.edit_buffer);
             gemini_edit_request_set_source_image(&req, app->preview.file_path);
 
+            // The result is decoded straight into a file next to the source
+            char output_dir[4096];
+            snprintf(output_dir, sizeof(output_dir), "%s", app->preview.file_path);
+            char *slash = strrchr(output_dir, '/');
+            if (slash) {
+                *(slash == output_dir ? slash + 1 : slash) = '\0';
+                gemini_edit_request_set_output_dir(&req, output_dir);
+            }
+
             GeminiImageResponse resp;
             gemini_response_init(&resp);
 
             // Execute edit
             bool success = gemini_edit_image(gemini, &req, &resp);
 
-            if (success && resp.result_type == GEMINI_RESULT_SUCCESS && resp.image_data) {
+            if (success && resp.result_type == GEMINI_RESULT_SUCCESS && (resp.image_path[0] || resp.image_data)) {
                 // Generate output path
                 char output_path[4096];
                 if (gemini_generate_edited_path(app->preview.file_path, output_path, sizeof(output_path))) {
                     // Save the edited image
                     if (gemini_save_image(&resp, output_path)) {
-                        strncpy(app->preview.edit_result_path, output_path, sizeof(app->preview.edit_result_path) - 1);
-                        app->preview.edit_state = IMAGE_EDIT_SUCCESS;
-
                         // Refresh directory to show new file
                         directory_read(&app->directory, app->directory.current_path);
                         app_update_git_status(app);
+
+                        // Select the result and preview it; it decodes in the background
+                        app_show_edited_image(app, output_path);
+                        strncpy(app->preview.edit_result_path, output_path, sizeof(app->preview.edit_result_path) - 1);
+                        app->preview.edit_state = IMAGE_EDIT_SUCCESS;
                     } else {
                         strncpy(app->preview.edit_error, "Failed to save edited image", sizeof(app->preview.edit_error) - 1);
                         app->preview.edit_state = IMAGE_EDIT_ERROR;
@@ -1493,32 +3201,26 @@ void app_update(App *app)
     }
 
     // Handle async summary completion (from context menu)
-    if (summarize_async_is_complete(&app->async_summary_request)) {
+    if (summarize_async_is_complete(&app->menu_summary_request)) {
         pthread_mutex_lock(&app->summary_mutex);
-        if (app->async_summary_request.from_context_menu &&
-            app->async_summary_request.result.status == SUMM_STATUS_OK) {
+        if (app->menu_summary_request.from_context_menu &&
+            app->menu_summary_request.result.status == SUMM_STATUS_OK) {
             // Show summary in dialog
-            const char *filename = strrchr(app->async_summary_request.file_path, '/');
-            filename = filename ? filename + 1 : app->async_summary_request.file_path;
+            const char *filename = strrchr(app->menu_summary_request.file_path, '/');
+            filename = filename ? filename + 1 : app->menu_summary_request.file_path;
             char title[128];
             snprintf(title, sizeof(title), "Summary: %s", filename);
-            dialog_summary(&app->dialog, title, app->async_summary_request.result.summary);
-        } else if (app->async_summary_request.from_context_menu &&
-                   app->async_summary_request.result.status != SUMM_STATUS_OK) {
+            dialog_summary(&app->dialog, title, app->menu_summary_request.result.summary);
+        } else if (app->menu_summary_request.from_context_menu &&
+                   app->menu_summary_request.result.status != SUMM_STATUS_OK) {
             // Show error dialog
             dialog_error(&app->dialog, "Summary Error",
-                        app->async_summary_request.result.error_message);
+                        app->menu_summary_request.result.error_message);
         }
         // Clear the request
-        app->async_summary_request.from_context_menu = false;
-        app->async_summary_request.completed = false;
+        app->menu_summary_request.from_context_menu = false;
+        app->menu_summary_request.completed = false;
         pthread_mutex_unlock(&app->summary_mutex);
-
-        // Join thread if still active
-        if (atomic_load(&app->summary_thread_active)) {
-            pthread_join(app->summary_thread, NULL);
-            atomic_store(&app->summary_thread_active, false);
-        }
     }
 
     // Handle text edit with Claude
@@ -1563,6 +3265,7 @@ void app_update(App *app)
                         // Build Claude request
                         ClaudeMessageRequest req;
                         claude_request_init(&req);
+                        claude_request_set_feature(&req, CLAUDE_FEATURE_TEXT_EDIT);
                         claude_request_set_system_prompt(&req,
                             "You are a text editing assistant. The user will provide a text file "
                             "and an edit instruction. Apply the edit and output ONLY the edited "
@@ -1648,6 +3351,9 @@ void app_update(App *app)
             }
         }
     }
+
+    app_update_redraw(app);
+    timing_section_end(&app->perf.timings, FRAME_SECTION_INPUT);
 }
 
 // Draw text edit overlay UI
@@ -1785,37 +3491,70 @@ static void app_draw_text_edit_overlay(App *app)
     }
 }
 
-void app_draw(App *app)
+// Helper: Whether a rectangle overlaps the area being redrawn
+static bool app_area_overlaps(Rectangle area, int x, int y, int width, int height)
 {
-    BeginDrawing();
+    return x < area.x + area.width && x + width > area.x &&
+           y < area.y + area.height && y + height > area.y;
+}
+
+void app_toggle_trace(App *app)
+{
+    (void)app;
+    if (!trace_is_recording()) {
+        trace_start();
+        TraceLog(LOG_INFO, "Trace recording started");
+        return;
+    }
 
+    char path[1200];
+    if (trace_stop_and_save(path, sizeof(path))) {
+        TraceLog(LOG_INFO, "Trace written to %s", path);
+    } else {
+        TraceLog(LOG_WARNING, "Trace could not be written");
+    }
+}
+
+// Helper: Draw the UI; panes outside area are left as they are
+static void app_draw_ui(App *app, Rectangle area)
+{
+    TRACE_SCOPE("app_draw_ui");
     ClearBackground(g_theme.background);
 
+    int content_x = sidebar_get_content_x(app);
+    int status_y = app->height - STATUSBAR_HEIGHT;
+
     // Draw sidebar
-    sidebar_draw(app);
+    if (app_area_overlaps(area, 0, 0, content_x, status_y)) {
+        sidebar_draw(app);
+    }
 
-    // Draw tab bar
-    tabs_draw(app);
+    if (app_area_overlaps(area, content_x, 0, app->width - content_x, status_y)) {
+        // Draw tab bar
+        tabs_draw(app);
 
-    // Draw search bar if active
-    search_draw(app);
+        // Draw search bar if active
+        search_draw(app);
 
-    // Draw breadcrumb bar
-    breadcrumb_draw(app);
+        // Draw breadcrumb bar
+        breadcrumb_draw(app);
 
-    // Draw file browser or dual pane (depends on mode)
-    if (dual_pane_is_enabled(&app->dual_pane)) {
-        dual_pane_draw(app);
-    } else {
-        browser_draw(app);
-        // Draw rubber band selection overlay
-        browser_draw_rubber_band(app);
-        // Draw preview panel (only in normal mode)
-        preview_draw(app);
+        // Draw file browser or dual pane (depends on mode)
+        if (dual_pane_is_enabled(&app->dual_pane)) {
+            dual_pane_draw(app);
+        } else {
+            browser_draw(app);
+            // Draw rubber band selection overlay
+            browser_draw_rubber_band(app);
+            // Draw preview panel (only in normal mode)
+            preview_draw(app);
+        }
     }
 
     // Draw status bar
-    statusbar_draw(app);
+    if (app_area_overlaps(area, 0, status_y, app->width, STATUSBAR_HEIGHT)) {
+        statusbar_draw(app);
+    }
 
     // Draw dialog on top of everything (modal)
     dialog_draw(app);
@@ -1832,11 +3571,83 @@ void app_draw(App *app)
     // Draw AI command bar (on top of everything)
     command_bar_draw(&app->command_bar, app->width, app->height);
 
-    // Draw summary progress overlay (when summarizing)
-    if (atomic_load(&app->summary_thread_active)) {
+    // Draw summary progress overlay (when summarizing from the context menu; hover
+    // summaries stream into the preview instead)
+    if (summarize_async_is_busy(&app->menu_summary_request)) {
         Rectangle full_screen = {0, 0, (float)app->width, (float)app->height};
         progress_indicator_draw_overlay(&app->summary_progress, full_screen, g_theme.aiAccent);
     }
+}
+
+void app_draw(App *app)
+{
+    TRACE_SCOPE("app_draw");
+    DirtyRectTracker *dirty = &app->perf.dirty;
+    Rectangle screen = {0, 0, (float)app->width, (float)app->height};
+
+    // The last frame's temporaries are done with
+    arena_reset(frame_arena());
+
+    // The frame texture follows the window size
+    if (app->frame.id != 0 && (app->frame.texture.width != app->width ||
+                               app->frame.texture.height != app->height)) {
+        UnloadRenderTexture(app->frame);
+        app->frame.id = 0;
+    }
+    if (app->frame.id == 0) {
+        app->frame = LoadRenderTexture(app->width, app->height);
+        dirty_full(dirty);
+    }
+
+    // Without a frame texture, draw straight to the screen every frame
+    if (app->frame.id == 0) {
+        BeginDrawing();
+        timing_section_begin(&app->perf.timings, FRAME_SECTION_LAYOUT);
+        app_draw_ui(app, screen);
+        timing_section_end(&app->perf.timings, FRAME_SECTION_LAYOUT);
+        EndDrawing();
+        dirty_clear(dirty);
+        return;
+    }
+
+    if (dirty_needs_redraw(dirty)) {
+        timing_section_begin(&app->perf.timings, FRAME_SECTION_LAYOUT);
+        BeginTextureMode(app->frame);
+        if (!dirty->enabled || dirty->full_redraw) {
+            app_draw_ui(app, screen);
+        } else {
+            // Redraw the panes within the bounds of the changes; the scissor keeps the
+            // clear and everything drawn inside them
+            int left = app->width, top = app->height, right = 0, bottom = 0;
+            for (int i = 0; i < dirty->count; i++) {
+                const DirtyRect *r = &dirty->rects[i];
+                if (r->x < left) left = r->x;
+                if (r->y < top) top = r->y;
+                if (r->x + r->width > right) right = r->x + r->width;
+                if (r->y + r->height > bottom) bottom = r->y + r->height;
+            }
+            Rectangle area = {(float)left, (float)top, (float)(right - left), (float)(bottom - top)};
+            BeginScissorMode(left, top, right - left, bottom - top);
+            app_draw_ui(app, area);
+            EndScissorMode();
+        }
+        EndTextureMode();
+        timing_section_end(&app->perf.timings, FRAME_SECTION_LAYOUT);
+        dirty_clear(dirty);
+    }
 
+    // Copy the frame as it is, translucent pixels included (render textures are stored
+    // upside down)
+    timing_section_begin(&app->perf.timings, FRAME_SECTION_DRAW);
+    BeginDrawing();
+    rlSetBlendFactors(RL_ONE, RL_ZERO, RL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM);
+    DrawTextureRec(app->frame.texture, (Rectangle){0, 0, screen.width, -screen.height},
+                   (Vector2){0, 0}, WHITE);
+    EndBlendMode();
+    rlDrawRenderBatchActive();
+    timing_section_end(&app->perf.timings, FRAME_SECTION_DRAW);
+
+    // Presents, then waits for the frame's turn
     EndDrawing();
 }
@@ -6,7 +6,15 @@
 #include "core/operations.h"
 #include "core/search.h"
 #include "core/git.h"
+#include "core/git_async.h"
+#include "core/listing_prefetch.h"
 #include "core/operation_queue.h"
+#include "core/undo_log.h"
+#include "core/fs_watch.h"
+#include "core/smart_folder.h"
+#include "core/dir_size.h"
+#include "core/treemap.h"
+#include "core/volumes.h"
 #include "ui/tabs.h"
 #include "ui/queue_panel.h"
 #include "ui/palette.h"
@@ -25,11 +33,13 @@
 #include "ai/vectordb.h"
 #include "ai/clip.h"
 #include "ai/indexer.h"
+#include "ai/index_governor.h"
 #include "ai/semantic_search.h"
 #include "ai/visual_search.h"
 #include "ai/summarize.h"
 #include "ai/summarize_async.h"
 #include "ui/browser.h"
+#include "ui/thumbnails.h"
 #include "ui/progress_indicator.h"
 
 #include <stdbool.h>
@@ -39,17 +49,27 @@
 #define APP_NAME "Finder Plus"
 #define DEFAULT_WIDTH 1280
 #define DEFAULT_HEIGHT 720
-#define MAX_SELECTION 4096
+#define MAX_SELECTION 4096          // Paths handed to one file operation at a time
 #define MAX_HISTORY 64
 #define SIDEBAR_DEFAULT_WIDTH 200
 #define SIDEBAR_MIN_WIDTH 120
 #define SIDEBAR_MAX_WIDTH 400
 
+// Redraw pacing: the UI is drawn every frame while the user works or something animates,
+// and otherwise the loop sleeps until input, waking on a heartbeat to poll background work
+#define REDRAW_ACTIVE_SECONDS 0.5    // Keep drawing every frame this long after input
+#define REDRAW_HEARTBEAT 0.5         // Seconds between wakes while idle (cursor blink rate)
+
+// Frame pacing: frames are paced to the refresh rate of the display the window is on
+// (120 Hz on ProMotion panels) unless the config caps it; vsync does the waiting
+#define FRAME_PACING_CHECK_SECONDS 1.0  // How often to look for a display change
+
 // View modes
 typedef enum ViewMode {
     VIEW_LIST,
     VIEW_GRID,
-    VIEW_COLUMN
+    VIEW_COLUMN,
+    VIEW_TREEMAP                         // Disk usage map of the current folder
 } ViewMode;
 
 // Text edit state (AI-powered text editing)
@@ -61,12 +81,14 @@ typedef enum TextEditState {
     TEXT_EDIT_ERROR        // Edit failed
 } TextEditState;
 
-// Selection state for multi-select
+// Selection state for multi-select: one bit per entry of the current listing, so
+// membership is O(1) and select-all, ranges and walks cost a word per 64 entries
 typedef struct SelectionState {
-    int *indices;           // Array of selected indices
+    uint64_t *bits;         // Bit i set when entry i is selected
+    int words;              // Words allocated in bits
     int count;              // Number of selected items
-    int capacity;           // Capacity of indices array
     int anchor_index;       // Anchor for range selection
+    uint32_t generation;    // Changes whenever the selection does
 } SelectionState;
 
 // Sidebar favorite item
@@ -85,7 +107,8 @@ typedef struct SidebarState {
     int width;
     bool collapsed;
     bool resizing;
-    int hovered_index;          // -1 if none, 0+ for favorites, 100+ for volumes
+    int hovered_index;          // -1 if none, 0+ for favorites, 100+ for volumes, 200+ for
+                                // network locations, 300+ for smart folders
 } SidebarState;
 
 // Column view state (Miller columns)
@@ -107,6 +130,19 @@ typedef struct HistoryState {
     int current;
 } HistoryState;
 
+// Stores opened on a background thread at startup, so the first directory shows without
+// waiting on them; app_update adopts them into the App once the thread is done
+typedef struct AppStartup {
+    pthread_t thread;
+    bool running;              // Started and not yet joined
+    atomic_bool done;          // Set by the thread when every store is open
+    bool adopted;              // The stores below have been handed to the App
+    VectorDB *vectordb;
+    PathIndex *path_index;
+    HashCache *hash_cache;
+    SummaryCache *summary_cache;
+} AppStartup;
+
 // Application state
 typedef struct App {
     // Window
@@ -114,6 +150,7 @@ typedef struct App {
     int height;
     bool fullscreen;
     bool should_close;
+    bool replaying;              // Driven by a frame benchmark script: the session is not saved
 
     // View mode
     ViewMode view_mode;
@@ -139,6 +176,7 @@ typedef struct App {
     // Grid view
     int grid_cols;               // Number of columns in grid
     int grid_rows;               // Visible rows in grid
+    ThumbnailCache *thumbnails;  // Image thumbnails (NULL: icons only)
 
     // Rubber band selection (grid view)
     bool rubber_band_active;     // Is rubber band selection in progress
@@ -173,11 +211,54 @@ typedef struct App {
     // Git integration
     GitState git;
     GitStatusResult git_status;
+    char git_status_path[PATH_MAX_LEN];  // Directory git_status was read for
+    GitAsync *git_async;                 // Reads git status off the UI thread (NULL: inline)
     bool git_enabled;
 
+    // Folder sizes for the list view and the operation queue's totals
+    DirSizes *dir_sizes;
+    Treemap *treemap;                    // Disk usage layouts for the treemap view
+
+    // Mounted volumes: free space for the status bar, the sidebar's list
+    Volumes *volumes;
+    uint64_t volumes_generation;         // Mount set the sidebar lists
+    struct JobToken *shards_sync;        // Attaching the volumes' index databases to vectordb
+
+    // Column view listings read ahead of the cursor (NULL: read on the UI thread)
+    ListingPrefetch *listing_prefetch;
+
+    // Folders handed over by later launches, opened here as tabs (NULL: not listening)
+    struct InstanceServer *instance;
+
+    // Index queries from the CLI and editors (NULL: not serving)
+    struct QueryServer *query_server;
+
+    // File system watch bus shared by the dir cache, browser, git status and indexers
+    FsWatch *fs_watch;
+    bool fs_watch_live;                  // FSEvents stream running, so changes get reported
+    int watch_dir_id;                    // Current directory, set to watched_dir
+    int watch_git_id;                    // Whole repository, set to watched_git_root
+    char watched_dir[PATH_MAX_LEN];
+    char watched_git_root[PATH_MAX_LEN];
+    atomic_bool watch_dir_changed;       // Set on the dispatch thread, taken in app_update:
+                                         // read the folder again
+    atomic_bool watch_git_changed;
+
+    // Names changed directly inside watch_names_root, queued by the dispatch thread and
+    // patched into the listing once per frame (guarded by watch_mutex)
+    pthread_mutex_t watch_mutex;
+    char watch_names_root[PATH_MAX_LEN];
+    char *watch_names;                   // NUL-separated
+    size_t watch_names_size;
+    size_t watch_names_capacity;
+    int watch_name_count;
+    char visible_dir[PATH_MAX_LEN];      // Browsed folder last given to the indexers
+    int visible_tab_count;
+
     // Operation queue
     OperationQueue op_queue;
     QueuePanelState queue_panel;
+    UndoLog *undo_log;         // Shared by every mutating path (undo_log_shared)
 
     // Command palette
     PaletteState palette;
@@ -200,6 +281,9 @@ typedef struct App {
     // AI Command bar (Cmd+K)
     CommandBar command_bar;
 
+    // Background stage of startup
+    AppStartup startup;
+
     // Local AI (Phase 5)
     EmbeddingEngine *embedding_engine;
     VectorDB *vectordb;
@@ -210,21 +294,51 @@ typedef struct App {
     bool ai_enabled;           // Whether AI features are enabled
     bool ai_indexing;          // Whether background indexing is active
 
+    // Recursive filename index of $HOME (SEARCH_TYPE_PATHS)
+    PathIndex *path_index;
+    Indexer *path_indexer;     // Scans into path_index and keeps it current
+    bool index_daemon;         // The index daemon keeps it current and saved; only follow changes
+    HashCache *hash_cache;     // Duplicate scan hashes, invalidated by path_indexer
+
+    // Saved searches in the sidebar, kept current from fs_watch and the indexer
+    SmartFolders *smart_folders;
+    int smart_folder_open;     // Smart folder the browser shows, -1 for none
+    uint32_t smart_folder_generation;  // Its members when the listing was copied
+
+    // Indexing pace from machine load, power and user activity
+    IndexGovernor index_governor;
+    double last_input_time;    // GetTime() of the last mouse or keyboard input
+    double index_throttle_next;
+    double index_metrics_next; // GetTime() of the next line in the indexer metrics file
+    double cache_trim_next;    // GetTime() of the next check of the shared cache budget
+
     // Performance (Phase 8)
     PerfManager perf;
     float fps;
     bool show_perf_stats;    // Toggle to display detailed performance stats
 
+    // Redraw pacing: the UI is drawn into frame, only where perf.dirty marks it changed,
+    // and frame is copied to the screen
+    RenderTexture2D frame;
+    Vector2 last_mouse;        // Mouse position last frame, to redraw hover changes
+    double last_active_time;   // GetTime() of the last input or redraw-worthy change
+    bool idle;                 // Sleeping between frames until an event arrives
+    int frame_rate;            // Rate frames are paced to (SetTargetFPS; 0 = vsync only)
+    int refresh_rate;          // Refresh rate of the window's display
+    double pacing_check_time;  // GetTime() of the next display check
+    char cached_listing_path[PATH_MAX_LEN];  // Last listing stored in perf.dir_cache
+
     // Browser mouse/hover state (Phase 8)
     BrowserState browser_state;
 
     // Async summary threading (Phase 8)
-    pthread_t summary_thread;
+    SummaryExecutor *summary_executor;  // Worker pool running every summary
     pthread_mutex_t summary_mutex;
-    atomic_bool summary_thread_active;  // Thread-safe flag
 
     // Summary system (Phase 8)
-    AsyncSummaryRequest async_summary_request;
+    AsyncSummaryRequest async_summary_request;  // Hovered or previewed file
+    AsyncSummaryRequest menu_summary_request;   // Context menu, shown in a dialog
+    AsyncSummaryRequest prefetch_requests[PREFETCH_REQUESTS];  // Rows around the selection
     SummarizeConfig summary_config;
     SummaryCache *summary_cache;
     ProgressIndicator summary_progress;  // Progress indicator for summarization
@@ -245,6 +359,13 @@ typedef struct App {
 // Initialize the application
 void app_init(App *app, const char *start_path);
 
+// Hand start_path to an instance already running, to open in a tab there; true when it
+// took it and this process should exit without opening a window
+bool app_forward_to_running(const char *start_path);
+
+// Take folders handed over by later launches (after app_init, windowed runs only)
+void app_accept_windows(App *app);
+
 // Free application resources
 void app_free(App *app);
 
@@ -257,6 +378,9 @@ void app_draw(App *app);
 // Handle keyboard input
 void app_handle_input(App *app);
 
+// Start a trace recording, or stop the one running and save it as Chrome trace JSON
+void app_toggle_trace(App *app);
+
 // Selection functions
 void selection_init(SelectionState *sel);
 void selection_free(SelectionState *sel);
@@ -264,13 +388,40 @@ void selection_clear(SelectionState *sel);
 void selection_add(SelectionState *sel, int index);
 void selection_remove(SelectionState *sel, int index);
 void selection_toggle(SelectionState *sel, int index);
-bool selection_contains(SelectionState *sel, int index);
+bool selection_contains(const SelectionState *sel, int index);
 void selection_range(SelectionState *sel, int from, int to);
+void selection_add_range(SelectionState *sel, int from, int to);  // Keeps what is selected
 void selection_select_all(App *app);
 
+// First selected index at or after from, or -1
+int selection_next(const SelectionState *sel, int from);
+
+// Fill indices with up to max selected indices from *cursor on, advancing *cursor past
+// them (start it at 0); returns how many, 0 once the selection is exhausted
+int selection_collect(const SelectionState *sel, int *cursor, int *indices, int max);
+
+// Move every selected entry to the Trash
+void app_trash_selection(App *app);
+
+// Queue a permanent delete of every selected entry; each leaves its folder at once and
+// is erased in the background (see operation_queue_remove)
+void app_erase_selection(App *app);
+
+// Put every selected entry on the clipboard (op: OP_COPY or OP_CUT)
+void app_clipboard_take_selection(App *app, OperationType op);
+
+// Show smart folder index in the browser; false while its members are still being found
+bool app_open_smart_folder(App *app, int index);
+
+// Save the search query as a smart folder below the current folder, and show it
+bool app_save_search_as_smart_folder(App *app);
+
+// Delete the smart folder the browser shows and go back to its root folder
+void app_remove_smart_folder(App *app);
+
 // Sidebar functions
-void sidebar_init(SidebarState *sidebar);
-void sidebar_refresh_volumes(SidebarState *sidebar);
+void sidebar_init(SidebarState *sidebar, Volumes *volumes);
+void sidebar_refresh_volumes(SidebarState *sidebar, Volumes *volumes);
 
 // History functions
 void history_init(HistoryState *history);
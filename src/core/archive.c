@@ -0,0 +1,1651 @@
+#include "archive.h"
+#include "../utils/hash.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <zlib.h>
+
+#define ARCHIVE_WINDOW 32768                // Deflate history an access point needs
+#define ARCHIVE_READ_CHUNK (256 * 1024)     // Compressed bytes read at a time
+#define ARCHIVE_ZIP_TAIL (22 + 65535)       // End of central directory record and comment
+#define ARCHIVE_TAR_META_MAX (1024 * 1024)  // Longest GNU long name or pax header read
+#define ARCHIVE_INDEX_VERSION 1
+
+#define ITEM_DIRECTORY 0x01
+#define ITEM_ENCRYPTED 0x02
+
+typedef enum ArchiveFormat {
+    ARCHIVE_FORMAT_ZIP,
+    ARCHIVE_FORMAT_TAR,
+    ARCHIVE_FORMAT_TAR_GZIP
+} ArchiveFormat;
+
+// One member, in path order with every folder right before what it holds
+typedef struct ArchiveItem {
+    uint64_t offset;            // Zip: local header; tar: contents, in the uncompressed tar
+    uint64_t size;
+    uint64_t packed;            // Zip: compressed size
+    int64_t modified;
+    uint32_t name;              // Offset of the path in names
+    uint32_t end;               // Index after the item and everything below it
+    uint32_t crc;               // Zip: CRC-32 of the contents
+    uint16_t mode;
+    uint8_t method;             // Zip: compression method
+    uint8_t flags;              // ITEM_*
+} ArchiveItem;
+
+// Where decompression of a gzip stream can start
+typedef struct ArchivePoint {
+    uint64_t in;                // Compressed offset of the first whole byte
+    uint64_t out;               // Uncompressed offset
+    uint64_t window;            // Offset of the compressed window in windows
+    uint32_t window_size;       // Window bytes (up to ARCHIVE_WINDOW)
+    uint32_t packed_size;       // Compressed window bytes
+    uint32_t bits;              // Bits of the byte before in still to be read
+    uint32_t reserved;
+} ArchivePoint;
+
+struct Archive {
+    char path[PATH_MAX];
+    uint64_t file_size;
+    int64_t file_mtime;
+    ArchiveFormat format;
+    int fd;
+    int refs;                   // Guarded by g_archives.mutex
+
+    ArchiveItem *items;
+    int count;
+    char *names;
+    size_t names_size;
+
+    ArchivePoint *points;
+    int point_count;
+    unsigned char *windows;
+    size_t windows_size;
+};
+
+struct ArchiveReader {
+    Archive *archive;
+    const ArchiveItem *item;
+    uint64_t in;                // Next byte to read from the file
+    uint64_t packed_left;       // Zip: compressed bytes not read yet
+    uint64_t skip;              // Gzip: output before the member still to discard
+    uint64_t remaining;         // Member bytes not returned yet
+    bool inflating;
+    bool raw;                   // Gzip: inside deflate data entered from an access point
+    bool check_crc;
+    uint32_t crc;
+    z_stream strm;
+    unsigned char input[ARCHIVE_READ_CHUNK];
+};
+
+// Saved listing of a tar, followed by its items, names, points and windows
+typedef struct ArchiveIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t format;
+    uint64_t file_size;
+    int64_t file_mtime;
+    uint64_t count;
+    uint64_t names_size;
+    uint64_t point_count;
+    uint64_t windows_size;
+} ArchiveIndexHeader;
+
+static const char INDEX_MAGIC[8] = "FPARCHIX";
+
+// Archives open now, most recently used first; each holds a reference
+static struct {
+    pthread_mutex_t mutex;
+    Archive *open[ARCHIVE_OPEN_MAX];
+} g_archives = { PTHREAD_MUTEX_INITIALIZER, { NULL } };
+
+//=============================================================================
+// Paths
+//=============================================================================
+
+static bool ends_with(const char *text, size_t length, const char *suffix)
+{
+    size_t suffix_length = strlen(suffix);
+    return length >= suffix_length && strncasecmp(text + length - suffix_length, suffix, suffix_length) == 0;
+}
+
+// Helper: format from a name's extension; false if it is no archive
+static bool format_of_name(const char *name, size_t length, ArchiveFormat *format)
+{
+    if (ends_with(name, length, ".zip")) {
+        *format = ARCHIVE_FORMAT_ZIP;
+    } else if (ends_with(name, length, ".tar")) {
+        *format = ARCHIVE_FORMAT_TAR;
+    } else if (ends_with(name, length, ".tar.gz") || ends_with(name, length, ".tgz")) {
+        *format = ARCHIVE_FORMAT_TAR_GZIP;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool archive_is_archive_name(const char *name)
+{
+    ArchiveFormat format;
+    return name != NULL && format_of_name(name, strlen(name), &format);
+}
+
+bool archive_split_path(const char *path, char *archive_path, size_t archive_size, const char **inner)
+{
+    if (path == NULL || path[0] == '\0') {
+        return false;
+    }
+
+    // The outermost archive on the path; names are checked before anything is stat'ed
+    const char *part = path;
+    for (;;) {
+        const char *slash = strchr(part, '/');
+        size_t end = slash != NULL ? (size_t)(slash - path) : strlen(path);
+        ArchiveFormat format;
+        if (end > (size_t)(part - path) && end < archive_size && format_of_name(path, end, &format)) {
+            memcpy(archive_path, path, end);
+            archive_path[end] = '\0';
+            struct stat st;
+            if (stat(archive_path, &st) == 0 && S_ISREG(st.st_mode)) {
+                *inner = slash != NULL ? slash + 1 : path + end;
+                return true;
+            }
+        }
+        if (slash == NULL) {
+            return false;
+        }
+        part = slash + 1;
+    }
+}
+
+// Order of paths in an archive: '/' before any other byte, so a folder's contents
+// follow it without anything in between
+static int path_compare(const char *a, const char *b)
+{
+    for (;; a++, b++) {
+        unsigned char ca = (unsigned char)*a;
+        unsigned char cb = (unsigned char)*b;
+        if (ca != cb) {
+            if (ca == '/') return cb == '\0' ? 1 : -1;
+            if (cb == '/') return ca == '\0' ? -1 : 1;
+            return ca < cb ? -1 : 1;
+        }
+        if (ca == '\0') {
+            return 0;
+        }
+    }
+}
+
+// Helper: the cache directory (with sub, if not NULL), created with its parents
+static bool cache_dir(const char *sub, char *path, size_t size)
+{
+    const char *home = getenv("HOME");
+    int written = sub != NULL
+        ? snprintf(path, size, "%s/%s/%s", home ? home : "/tmp", ARCHIVE_CACHE_DIR, sub)
+        : snprintf(path, size, "%s/%s", home ? home : "/tmp", ARCHIVE_CACHE_DIR);
+    if (written < 0 || (size_t)written >= size) {
+        return false;
+    }
+    for (char *p = path + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(path, 0755);  // Ignore EEXIST
+            *p = '/';
+        }
+    }
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+//=============================================================================
+// Listing: members are gathered in archive order, then sorted into path order
+// with the folders no member names made up
+//=============================================================================
+
+typedef struct ArchiveBuilder {
+    ArchiveItem *items;
+    int count;
+    int capacity;
+    char *names;
+    size_t names_size;
+    size_t names_capacity;
+    ArchivePoint *points;
+    int point_count;
+    int point_capacity;
+    unsigned char *windows;
+    size_t windows_size;
+    size_t windows_capacity;
+} ArchiveBuilder;
+
+static void builder_free(ArchiveBuilder *builder)
+{
+    free(builder->items);
+    free(builder->names);
+    free(builder->points);
+    free(builder->windows);
+    memset(builder, 0, sizeof(ArchiveBuilder));
+}
+
+static bool grow(void **data, size_t element, size_t needed, size_t *capacity)
+{
+    if (needed <= *capacity) {
+        return true;
+    }
+    size_t wanted = *capacity > 0 ? *capacity * 2 : 256;
+    while (wanted < needed) {
+        wanted *= 2;
+    }
+    void *grown = realloc(*data, wanted * element);
+    if (grown == NULL) {
+        errno = ENOMEM;
+        return false;
+    }
+    *data = grown;
+    *capacity = wanted;
+    return true;
+}
+
+// Helper: intern a path of length bytes; its offset, or UINT32_MAX on OOM
+static uint32_t builder_name(ArchiveBuilder *builder, const char *name, size_t length)
+{
+    if (builder->names_size + length + 1 > UINT32_MAX ||
+        !grow((void **)&builder->names, 1, builder->names_size + length + 1, &builder->names_capacity)) {
+        errno = ENOMEM;
+        return UINT32_MAX;
+    }
+    uint32_t offset = (uint32_t)builder->names_size;
+    memcpy(builder->names + offset, name, length);
+    builder->names[offset + length] = '\0';
+    builder->names_size += length + 1;
+    return offset;
+}
+
+// Helper: whether a path of length bytes has a "." or ".." component
+static bool name_has_dots(const char *name, size_t length)
+{
+    size_t start = 0;
+    for (size_t i = 0; i <= length; i++) {
+        if (i == length || name[i] == '/') {
+            size_t part = i - start;
+            if ((part == 1 && name[start] == '.') ||
+                (part == 2 && name[start] == '.' && name[start + 1] == '.')) {
+                return true;
+            }
+            start = i + 1;
+        }
+    }
+    return false;
+}
+
+// Add a member named name (leading "./" and slashes, and a trailing slash, are dropped;
+// a member with a "." or ".." component is skipped, so none can name a place outside
+// the archive)
+static bool builder_add(ArchiveBuilder *builder, const char *name, size_t length, const ArchiveItem *item)
+{
+    while (length > 0 && name[0] == '/') {
+        name++;
+        length--;
+    }
+    while (length >= 2 && name[0] == '.' && name[1] == '/') {
+        name += 2;
+        length -= 2;
+    }
+    ArchiveItem added = *item;
+    while (length > 0 && name[length - 1] == '/') {
+        added.flags |= ITEM_DIRECTORY;
+        length--;
+    }
+    if (length == 0 || name_has_dots(name, length) || memchr(name, '\0', length) != NULL) {
+        return true;
+    }
+    if (added.flags & ITEM_DIRECTORY) {
+        added.mode = (uint16_t)((added.mode & 07777) | S_IFDIR);
+        added.size = 0;
+    } else if ((added.mode & S_IFMT) == 0) {
+        added.mode |= S_IFREG;
+    }
+
+    size_t capacity = (size_t)builder->capacity;
+    if (!grow((void **)&builder->items, sizeof(ArchiveItem), (size_t)builder->count + 1, &capacity)) {
+        return false;
+    }
+    builder->capacity = (int)capacity;
+    added.name = builder_name(builder, name, length);
+    if (added.name == UINT32_MAX) {
+        return false;
+    }
+    builder->items[builder->count++] = added;
+    return true;
+}
+
+typedef struct SortKey {
+    const char *name;
+    int index;
+} SortKey;
+
+static int compare_keys(const void *a, const void *b)
+{
+    const SortKey *ka = a;
+    const SortKey *kb = b;
+    int order = path_compare(ka->name, kb->name);
+    if (order != 0) {
+        return order;
+    }
+    return ka->index < kb->index ? -1 : ka->index > kb->index;
+}
+
+// Helper: append an item named name to the finished list
+static bool finish_append(ArchiveBuilder *out, const ArchiveItem *item, const char *name, size_t length)
+{
+    size_t capacity = (size_t)out->capacity;
+    if (!grow((void **)&out->items, sizeof(ArchiveItem), (size_t)out->count + 1, &capacity)) {
+        return false;
+    }
+    out->capacity = (int)capacity;
+    ArchiveItem added = *item;
+    added.name = builder_name(out, name, length);
+    if (added.name == UINT32_MAX) {
+        return false;
+    }
+    added.end = (uint32_t)out->count + 1;
+    out->items[out->count++] = added;
+    return true;
+}
+
+// Sort the members into path order, keep the last of members with the same path, make
+// up folders that only appear in paths, and record where each folder's contents end
+static bool builder_finish(ArchiveBuilder *builder)
+{
+    ArchiveBuilder out = { 0 };
+    SortKey *keys = malloc((size_t)(builder->count > 0 ? builder->count : 1) * sizeof(SortKey));
+    int *stack = malloc((size_t)(builder->count > 0 ? builder->count : 1) * 2 * sizeof(int) + sizeof(int));
+    int stack_capacity = (builder->count > 0 ? builder->count : 1) * 2 + 1;
+    if (keys == NULL || stack == NULL) {
+        free(keys);
+        free(stack);
+        errno = ENOMEM;
+        return false;
+    }
+    for (int i = 0; i < builder->count; i++) {
+        keys[i].name = builder->names + builder->items[i].name;
+        keys[i].index = i;
+    }
+    qsort(keys, (size_t)builder->count, sizeof(SortKey), compare_keys);
+
+    bool ok = true;
+    int depth = 0;
+    for (int k = 0; ok && k < builder->count; k++) {
+        const char *name = keys[k].name;
+        if (k + 1 < builder->count && strcmp(keys[k + 1].name, name) == 0) {
+            continue;
+        }
+
+        // Close the folders this path is not in
+        while (depth > 0) {
+            const char *folder = out.names + out.items[stack[depth - 1]].name;
+            size_t folder_length = strlen(folder);
+            if (strncmp(folder, name, folder_length) == 0 && name[folder_length] == '/') {
+                break;
+            }
+            out.items[stack[--depth]].end = (uint32_t)out.count;
+        }
+
+        // Folders between the innermost open one and this path that no member names
+        size_t from = depth > 0 ? strlen(out.names + out.items[stack[depth - 1]].name) + 1 : 0;
+        for (const char *slash = strchr(name + from, '/'); ok && slash != NULL; slash = strchr(slash + 1, '/')) {
+            ArchiveItem folder = { .mode = S_IFDIR | 0755, .flags = ITEM_DIRECTORY,
+                                   .modified = builder->items[keys[k].index].modified };
+            ok = depth < stack_capacity && finish_append(&out, &folder, name, (size_t)(slash - name));
+            if (ok) {
+                stack[depth++] = out.count - 1;
+            }
+        }
+
+        const ArchiveItem *item = &builder->items[keys[k].index];
+        ok = ok && finish_append(&out, item, name, strlen(name));
+        if (ok && (item->flags & ITEM_DIRECTORY) && depth < stack_capacity) {
+            stack[depth++] = out.count - 1;
+        }
+    }
+    while (ok && depth > 0) {
+        out.items[stack[--depth]].end = (uint32_t)out.count;
+    }
+    free(keys);
+    free(stack);
+    if (!ok) {
+        builder_free(&out);
+        errno = ENOMEM;
+        return false;
+    }
+
+    // The access points carry over as they are
+    out.points = builder->points;
+    out.point_count = builder->point_count;
+    out.point_capacity = builder->point_capacity;
+    out.windows = builder->windows;
+    out.windows_size = builder->windows_size;
+    out.windows_capacity = builder->windows_capacity;
+    builder->points = NULL;
+    builder->windows = NULL;
+    builder_free(builder);
+    *builder = out;
+    return true;
+}
+
+//=============================================================================
+// Zip: the central directory at the end of the file lists every member
+//=============================================================================
+
+static uint16_t le16(const unsigned char *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t le32(const unsigned char *p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint64_t le64(const unsigned char *p) { return (uint64_t)le32(p) | ((uint64_t)le32(p + 4) << 32); }
+
+static bool read_at(int fd, void *buffer, size_t length, uint64_t offset)
+{
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(fd, (char *)buffer + done, length - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (n == 0) errno = EIO;
+            return false;
+        }
+        done += (size_t)n;
+    }
+    return true;
+}
+
+static int64_t dos_time(uint16_t date, uint16_t time)
+{
+    struct tm tm = { 0 };
+    tm.tm_year = ((date >> 9) & 0x7f) + 80;
+    tm.tm_mon = ((date >> 5) & 0x0f) - 1;
+    tm.tm_mday = date & 0x1f;
+    tm.tm_hour = (time >> 11) & 0x1f;
+    tm.tm_min = (time >> 5) & 0x3f;
+    tm.tm_sec = (time & 0x1f) * 2;
+    tm.tm_isdst = -1;
+    return (int64_t)mktime(&tm);
+}
+
+static bool zip_scan(ArchiveBuilder *builder, int fd, uint64_t file_size)
+{
+    // End of central directory record: the last signature in the file's tail
+    size_t tail_size = file_size < ARCHIVE_ZIP_TAIL ? (size_t)file_size : ARCHIVE_ZIP_TAIL;
+    uint64_t tail_offset = file_size - tail_size;
+    unsigned char *tail = malloc(tail_size > 0 ? tail_size : 1);
+    if (tail == NULL || tail_size < 22 || !read_at(fd, tail, tail_size, tail_offset)) {
+        free(tail);
+        errno = tail == NULL ? ENOMEM : EINVAL;
+        return false;
+    }
+    long end = -1;
+    for (long i = (long)tail_size - 22; i >= 0; i--) {
+        if (le32(tail + i) == 0x06054b50) {
+            end = i;
+            break;
+        }
+    }
+    if (end < 0) {
+        free(tail);
+        errno = EINVAL;
+        return false;
+    }
+    uint64_t entries = le16(tail + end + 10);
+    uint64_t directory_size = le32(tail + end + 12);
+    uint64_t directory_offset = le32(tail + end + 16);
+
+    // Zip64 keeps the real values in a record the locator before this one points at
+    if ((entries == 0xffff || directory_size == 0xffffffff || directory_offset == 0xffffffff) &&
+        end >= 20 && le32(tail + end - 20) == 0x07064b50) {
+        unsigned char record[56];
+        if (!read_at(fd, record, sizeof(record), le64(tail + end - 20 + 8)) || le32(record) != 0x06064b50) {
+            free(tail);
+            errno = EINVAL;
+            return false;
+        }
+        entries = le64(record + 32);
+        directory_size = le64(record + 40);
+        directory_offset = le64(record + 48);
+    }
+    free(tail);
+    if (directory_offset > file_size || directory_size > file_size - directory_offset) {
+        errno = EINVAL;
+        return false;
+    }
+
+    unsigned char *directory = malloc(directory_size > 0 ? (size_t)directory_size : 1);
+    if (directory == NULL) {
+        errno = ENOMEM;
+        return false;
+    }
+    if (!read_at(fd, directory, (size_t)directory_size, directory_offset)) {
+        free(directory);
+        return false;
+    }
+
+    bool ok = true;
+    size_t at = 0;
+    for (uint64_t n = 0; ok && n < entries && at + 46 <= directory_size; n++) {
+        const unsigned char *header = directory + at;
+        if (le32(header) != 0x02014b50) {
+            break;
+        }
+        uint16_t name_length = le16(header + 28);
+        uint16_t extra_length = le16(header + 30);
+        uint16_t comment_length = le16(header + 32);
+        if (at + 46 + name_length + extra_length + comment_length > directory_size) {
+            break;
+        }
+        const char *name = (const char *)header + 46;
+        const unsigned char *extra = header + 46 + name_length;
+
+        ArchiveItem item = { 0 };
+        item.method = (uint8_t)le16(header + 10);
+        item.flags = (le16(header + 8) & 0x0001) ? ITEM_ENCRYPTED : 0;
+        item.modified = dos_time(le16(header + 14), le16(header + 12));
+        item.crc = le32(header + 16);
+        item.packed = le32(header + 20);
+        item.size = le32(header + 24);
+        item.offset = le32(header + 42);
+        uint32_t attributes = le32(header + 38);
+        if ((header[5] == 3 || header[5] == 19) && (attributes >> 16) != 0) {
+            item.mode = (uint16_t)(attributes >> 16);  // Made on Unix: st_mode
+        } else {
+            item.mode = (attributes & 0x10) ? (S_IFDIR | 0755) : (S_IFREG | 0644);
+        }
+        if (S_ISDIR(item.mode)) {
+            item.flags |= ITEM_DIRECTORY;
+        }
+
+        for (size_t e = 0; e + 4 <= extra_length;) {
+            uint16_t id = le16(extra + e);
+            uint16_t size = le16(extra + e + 2);
+            const unsigned char *field = extra + e + 4;
+            if (e + 4 + size > extra_length) {
+                break;
+            }
+            if (id == 0x0001) {
+                // Zip64: the values that did not fit, in this order
+                size_t f = 0;
+                if (item.size == 0xffffffff && f + 8 <= size) { item.size = le64(field + f); f += 8; }
+                if (item.packed == 0xffffffff && f + 8 <= size) { item.packed = le64(field + f); f += 8; }
+                if (item.offset == 0xffffffff && f + 8 <= size) { item.offset = le64(field + f); }
+            } else if (id == 0x5455 && size >= 5 && (field[0] & 1)) {
+                item.modified = (int32_t)le32(field + 1);  // Extended timestamp (UTC)
+            }
+            e += 4 + (size_t)size;
+        }
+
+        ok = builder_add(builder, name, name_length, &item);
+        at += 46 + (size_t)name_length + extra_length + comment_length;
+    }
+    free(directory);
+    return ok;
+}
+
+//=============================================================================
+// Tar: headers are read one after another, skipping over the contents. A
+// compressed tar is inflated in order, recording access points as it goes
+//=============================================================================
+
+typedef struct GzipScan {
+    int fd;
+    uint64_t file_size;
+    uint64_t in;                // Next compressed byte to read
+    uint64_t out;               // Uncompressed bytes so far
+    uint64_t last_point;        // Output offset of the last access point
+    bool ended;
+    z_stream strm;
+    ArchiveBuilder *builder;
+    unsigned char window[ARCHIVE_WINDOW];   // Output ring: byte o is at o % ARCHIVE_WINDOW
+    unsigned char input[ARCHIVE_READ_CHUNK];
+} GzipScan;
+
+// Helper: record an access point at the current block boundary
+static bool gzip_add_point(GzipScan *scan)
+{
+    ArchiveBuilder *builder = scan->builder;
+    size_t capacity = (size_t)builder->point_capacity;
+    if (!grow((void **)&builder->points, sizeof(ArchivePoint), (size_t)builder->point_count + 1, &capacity)) {
+        return false;
+    }
+    builder->point_capacity = (int)capacity;
+
+    // The history in order, oldest first
+    unsigned char history[ARCHIVE_WINDOW];
+    size_t history_size = scan->out < ARCHIVE_WINDOW ? (size_t)scan->out : ARCHIVE_WINDOW;
+    size_t at = (size_t)(scan->out % ARCHIVE_WINDOW);
+    if (history_size == ARCHIVE_WINDOW) {
+        memcpy(history, scan->window + at, ARCHIVE_WINDOW - at);
+        memcpy(history + ARCHIVE_WINDOW - at, scan->window, at);
+    } else {
+        memcpy(history, scan->window, history_size);
+    }
+
+    uLongf packed_size = compressBound(ARCHIVE_WINDOW);
+    if (!grow((void **)&builder->windows, 1, builder->windows_size + packed_size, &builder->windows_capacity) ||
+        compress2(builder->windows + builder->windows_size, &packed_size, history, history_size, 1) != Z_OK) {
+        errno = ENOMEM;
+        return false;
+    }
+
+    ArchivePoint *point = &builder->points[builder->point_count++];
+    memset(point, 0, sizeof(ArchivePoint));
+    point->in = scan->in - scan->strm.avail_in;
+    point->out = scan->out;
+    point->bits = (uint32_t)(scan->strm.data_type & 7);
+    point->window = builder->windows_size;
+    point->window_size = (uint32_t)history_size;
+    point->packed_size = (uint32_t)packed_size;
+    builder->windows_size += packed_size;
+    scan->last_point = scan->out;
+    return true;
+}
+
+// Helper: inflate the next piece of output into the ring; 1 while there may be more,
+// 0 at the end, -1 with errno set on error
+static int gzip_step(GzipScan *scan)
+{
+    if (scan->ended) {
+        return 0;
+    }
+    z_stream *strm = &scan->strm;
+    if (strm->avail_out == 0) {
+        strm->next_out = scan->window;
+        strm->avail_out = ARCHIVE_WINDOW;
+    }
+    if (strm->avail_in == 0) {
+        ssize_t n = pread(scan->fd, scan->input, sizeof(scan->input), (off_t)scan->in);
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            scan->ended = true;     // Truncated: what was listed so far stands
+            return 0;
+        }
+        scan->in += (uint64_t)n;
+        strm->next_in = scan->input;
+        strm->avail_in = (uInt)n;
+    }
+
+    uInt before = strm->avail_out;
+    int ret = inflate(strm, Z_BLOCK);
+    scan->out += before - strm->avail_out;
+    if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR) {
+        errno = ret == Z_MEM_ERROR ? ENOMEM : EIO;
+        return -1;
+    }
+    if (ret == Z_STREAM_END) {
+        // Another gzip member may follow
+        if (strm->avail_in == 0 && scan->in >= scan->file_size) {
+            scan->ended = true;
+        } else {
+            inflateReset(strm);
+        }
+        return 1;
+    }
+
+    // Between deflate blocks, but not after the last one
+    if ((strm->data_type & 128) && !(strm->data_type & 64) &&
+        (scan->builder->point_count == 0 || scan->out - scan->last_point >= ARCHIVE_GZIP_SPAN)) {
+        if (!gzip_add_point(scan)) {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+// Source of the uncompressed tar: fill buffer with length bytes at offset, which never
+// goes back before what was read last. 1, 0 past the end, -1 with errno set
+typedef int (*TarReadFn)(void *context, uint64_t offset, unsigned char *buffer, size_t length);
+
+static int tar_read_file(void *context, uint64_t offset, unsigned char *buffer, size_t length)
+{
+    int fd = *(int *)context;
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(fd, buffer + done, length - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            return 0;
+        }
+        done += (size_t)n;
+    }
+    return 1;
+}
+
+static int tar_read_gzip(void *context, uint64_t offset, unsigned char *buffer, size_t length)
+{
+    GzipScan *scan = context;
+    size_t filled = 0;
+    while (filled < length) {
+        uint64_t want = offset + filled;
+        if (want < scan->out) {
+            if (scan->out - want > ARCHIVE_WINDOW) {
+                errno = EINVAL;
+                return -1;
+            }
+            size_t at = (size_t)(want % ARCHIVE_WINDOW);
+            size_t n = length - filled;
+            if (n > scan->out - want) n = (size_t)(scan->out - want);
+            if (n > ARCHIVE_WINDOW - at) n = ARCHIVE_WINDOW - at;
+            memcpy(buffer + filled, scan->window + at, n);
+            filled += n;
+            continue;
+        }
+        int status = gzip_step(scan);
+        if (status <= 0) {
+            return status;
+        }
+    }
+    return 1;
+}
+
+// Helper: a header number, octal or (for large values) base-256
+static uint64_t tar_number(const unsigned char *field, size_t length)
+{
+    uint64_t value = 0;
+    if (field[0] & 0x80) {
+        for (size_t i = 1; i < length; i++) {
+            value = (value << 8) | field[i];
+        }
+        return value;
+    }
+    size_t i = 0;
+    while (i < length && (field[i] == ' ' || field[i] == '\0')) i++;
+    for (; i < length && field[i] >= '0' && field[i] <= '7'; i++) {
+        value = (value << 3) | (uint64_t)(field[i] - '0');
+    }
+    return value;
+}
+
+static bool tar_checksum_ok(const unsigned char *header)
+{
+    uint64_t sum = 0;
+    for (int i = 0; i < 512; i++) {
+        sum += (i >= 148 && i < 156) ? ' ' : header[i];
+    }
+    return sum == tar_number(header + 148, 8);
+}
+
+// Helper: the values of a pax extended header that matter here
+static void tar_pax(const char *records, size_t length, char **path, uint64_t *size, int64_t *mtime)
+{
+    size_t at = 0;
+    while (at < length) {
+        // "<length> <key>=<value>\n"
+        char *space = memchr(records + at, ' ', length - at);
+        size_t record_length = (size_t)strtoull(records + at, NULL, 10);
+        if (space == NULL || record_length == 0 || at + record_length > length) {
+            return;
+        }
+        const char *key = space + 1;
+        const char *record_end = records + at + record_length - 1;   // The newline
+        const char *equals = memchr(key, '=', (size_t)(record_end - key));
+        if (equals != NULL) {
+            const char *value = equals + 1;
+            size_t key_length = (size_t)(equals - key);
+            size_t value_length = (size_t)(record_end - value);
+            if (key_length == 4 && strncmp(key, "path", 4) == 0) {
+                free(*path);
+                *path = strndup(value, value_length);
+            } else if (key_length == 4 && strncmp(key, "size", 4) == 0) {
+                *size = strtoull(value, NULL, 10);
+            } else if (key_length == 5 && strncmp(key, "mtime", 5) == 0) {
+                *mtime = strtoll(value, NULL, 10);
+            }
+        }
+        at += record_length;
+    }
+}
+
+static bool tar_scan(ArchiveBuilder *builder, TarReadFn read, void *context, const atomic_bool *cancel)
+{
+    unsigned char header[512];
+    uint64_t offset = 0;
+    char *long_name = NULL;     // From a GNU long name or pax header, for the next member
+    uint64_t pax_size = UINT64_MAX;
+    int64_t pax_mtime = INT64_MIN;
+    bool ok = true;
+
+    for (;;) {
+        if (cancel != NULL && atomic_load(cancel)) {
+            errno = ECANCELED;
+            ok = false;
+            break;
+        }
+        int status = read(context, offset, header, sizeof(header));
+        if (status <= 0) {
+            ok = status == 0 && (offset > 0 || (errno = EINVAL, false));
+            break;
+        }
+        bool empty = true;
+        for (int i = 0; i < 512 && empty; i++) {
+            empty = header[i] == 0;
+        }
+        if (empty) {
+            break;      // End of archive
+        }
+        if (!tar_checksum_ok(header)) {
+            if (offset == 0) {
+                errno = EINVAL;
+                ok = false;
+            }
+            break;
+        }
+
+        char type = (char)header[156];
+        uint64_t size = tar_number(header + 124, 12);
+        if (pax_size != UINT64_MAX && type != 'x' && type != 'g' && type != 'L' && type != 'K') {
+            size = pax_size;
+        }
+        uint64_t data = offset + 512;
+        uint64_t next = data + ((size + 511) & ~(uint64_t)511);
+
+        if (type == 'L' || type == 'x') {
+            // Metadata for the member that follows
+            size_t length = size < ARCHIVE_TAR_META_MAX ? (size_t)size : ARCHIVE_TAR_META_MAX;
+            char *text = malloc(length + 1);
+            if (text == NULL || read(context, data, (unsigned char *)text, length) <= 0) {
+                free(text);
+                errno = text == NULL ? ENOMEM : EIO;
+                ok = false;
+                break;
+            }
+            text[length] = '\0';
+            if (type == 'L') {
+                free(long_name);
+                long_name = strndup(text, strnlen(text, length));
+            } else {
+                tar_pax(text, length, &long_name, &pax_size, &pax_mtime);
+            }
+            free(text);
+        } else if (type != 'g' && type != 'K' && type != 'V') {
+            char name[256 + 1 + 100 + 1];
+            const char *path = long_name;
+            if (path == NULL) {
+                size_t name_length = strnlen((const char *)header, 100);
+                if (memcmp(header + 257, "ustar\0", 6) == 0 && header[345] != '\0') {
+                    snprintf(name, sizeof(name), "%.*s/%.*s", (int)strnlen((const char *)header + 345, 155),
+                             (const char *)header + 345, (int)name_length, (const char *)header);
+                } else {
+                    snprintf(name, sizeof(name), "%.*s", (int)name_length, (const char *)header);
+                }
+                path = name;
+            }
+
+            ArchiveItem item = { 0 };
+            item.offset = data;
+            item.mode = (uint16_t)(tar_number(header + 100, 8) & 07777);
+            item.modified = pax_mtime != INT64_MIN ? pax_mtime : (int64_t)tar_number(header + 136, 12);
+            if (type == '5') {
+                item.flags = ITEM_DIRECTORY;
+            } else if (type == '2') {
+                item.mode |= S_IFLNK;
+            } else if (type == '0' || type == '\0' || type == '7') {
+                item.mode |= S_IFREG;
+                item.size = size;
+            } else {
+                item.mode |= S_IFREG;   // Hard links and special files list empty
+            }
+            ok = builder_add(builder, path, strlen(path), &item);
+            free(long_name);
+            long_name = NULL;
+            pax_size = UINT64_MAX;
+            pax_mtime = INT64_MIN;
+            if (!ok) {
+                break;
+            }
+        }
+        offset = next;
+    }
+    free(long_name);
+    return ok;
+}
+
+static bool tar_gzip_scan(ArchiveBuilder *builder, int fd, uint64_t file_size, const atomic_bool *cancel)
+{
+    GzipScan *scan = calloc(1, sizeof(GzipScan));
+    if (scan == NULL) {
+        errno = ENOMEM;
+        return false;
+    }
+    scan->fd = fd;
+    scan->file_size = file_size;
+    scan->builder = builder;
+    scan->strm.next_out = scan->window;
+    scan->strm.avail_out = ARCHIVE_WINDOW;
+    if (inflateInit2(&scan->strm, 15 + 32) != Z_OK) {     // Expect a gzip header
+        free(scan);
+        errno = ENOMEM;
+        return false;
+    }
+    bool ok = tar_scan(builder, tar_read_gzip, scan, cancel);
+    inflateEnd(&scan->strm);
+    free(scan);
+    return ok;
+}
+
+//=============================================================================
+// Saved tar indexes
+//=============================================================================
+
+static void index_path(const Archive *archive, char *path, size_t size)
+{
+    char dir[PATH_MAX];
+    path[0] = '\0';
+    if (cache_dir(NULL, dir, sizeof(dir))) {
+        uint64_t hash = hash_fnv1a64_bytes(HASH_FNV1A64_INIT, archive->path, strlen(archive->path));
+        snprintf(path, size, "%s/%016llx.index", dir, (unsigned long long)hash);
+    }
+}
+
+static bool index_load(Archive *archive)
+{
+    char path[PATH_MAX];
+    index_path(archive, path, sizeof(path));
+    FILE *file = path[0] ? fopen(path, "rb") : NULL;
+    if (file == NULL) {
+        return false;
+    }
+
+    ArchiveIndexHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+              header.version == ARCHIVE_INDEX_VERSION && header.format == (uint32_t)archive->format &&
+              header.file_size == archive->file_size && header.file_mtime == archive->file_mtime &&
+              header.count <= INT32_MAX && header.point_count <= INT32_MAX &&
+              header.names_size <= UINT32_MAX;
+    if (ok) {
+        archive->count = (int)header.count;
+        archive->point_count = (int)header.point_count;
+        archive->names_size = (size_t)header.names_size;
+        archive->windows_size = (size_t)header.windows_size;
+        archive->items = malloc(header.count > 0 ? header.count * sizeof(ArchiveItem) : 1);
+        archive->names = malloc(header.names_size > 0 ? (size_t)header.names_size : 1);
+        archive->points = malloc(header.point_count > 0 ? header.point_count * sizeof(ArchivePoint) : 1);
+        archive->windows = malloc(header.windows_size > 0 ? (size_t)header.windows_size : 1);
+        ok = archive->items && archive->names && archive->points && archive->windows &&
+             fread(archive->items, sizeof(ArchiveItem), (size_t)header.count, file) == header.count &&
+             fread(archive->names, 1, (size_t)header.names_size, file) == header.names_size &&
+             fread(archive->points, sizeof(ArchivePoint), (size_t)header.point_count, file) == header.point_count &&
+             fread(archive->windows, 1, (size_t)header.windows_size, file) == header.windows_size;
+    }
+    fclose(file);
+
+    // Anything pointing outside what was read means the index is damaged
+    for (int i = 0; ok && i < archive->count; i++) {
+        ok = archive->items[i].name < archive->names_size && archive->items[i].end > (uint32_t)i &&
+             archive->items[i].end <= (uint32_t)archive->count;
+    }
+    for (int i = 0; ok && i < archive->point_count; i++) {
+        ok = archive->points[i].window + archive->points[i].packed_size <= archive->windows_size;
+    }
+    ok = ok && (archive->names_size == 0 || archive->names[archive->names_size - 1] == '\0');
+    if (!ok) {
+        free(archive->items);
+        free(archive->names);
+        free(archive->points);
+        free(archive->windows);
+        archive->items = NULL;
+        archive->names = NULL;
+        archive->points = NULL;
+        archive->windows = NULL;
+        archive->count = 0;
+        archive->point_count = 0;
+    }
+    return ok;
+}
+
+static bool write_all(FILE *file, const void *data, size_t length)
+{
+    return length == 0 || fwrite(data, 1, length, file) == length;
+}
+
+static void index_save(const Archive *archive)
+{
+    char path[PATH_MAX];
+    index_path(archive, path, sizeof(path));
+    if (!path[0]) {
+        return;
+    }
+    char temp_path[PATH_MAX + 16];
+    snprintf(temp_path, sizeof(temp_path), "%s.%d.tmp", path, (int)getpid());
+    FILE *file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        return;
+    }
+
+    ArchiveIndexHeader header = { .version = ARCHIVE_INDEX_VERSION, .format = (uint32_t)archive->format,
+                                  .file_size = archive->file_size, .file_mtime = archive->file_mtime,
+                                  .count = (uint64_t)archive->count, .names_size = archive->names_size,
+                                  .point_count = (uint64_t)archive->point_count,
+                                  .windows_size = archive->windows_size };
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              write_all(file, archive->items, sizeof(ArchiveItem) * (size_t)archive->count) &&
+              write_all(file, archive->names, archive->names_size) &&
+              write_all(file, archive->points, sizeof(ArchivePoint) * (size_t)archive->point_count) &&
+              write_all(file, archive->windows, archive->windows_size);
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temp_path, path) != 0) {
+        unlink(temp_path);
+    }
+}
+
+//=============================================================================
+// Open archives
+//=============================================================================
+
+static void archive_free(Archive *archive)
+{
+    if (archive->fd >= 0) {
+        close(archive->fd);
+    }
+    free(archive->items);
+    free(archive->names);
+    free(archive->points);
+    free(archive->windows);
+    free(archive);
+}
+
+// Helper: list an archive; false with errno set
+static bool archive_load(Archive *archive, bool scan, const atomic_bool *cancel)
+{
+    if (archive->format != ARCHIVE_FORMAT_ZIP && index_load(archive)) {
+        return true;
+    }
+    if (archive->format != ARCHIVE_FORMAT_ZIP && !scan) {
+        errno = EAGAIN;
+        return false;
+    }
+
+    ArchiveBuilder builder = { 0 };
+    bool ok;
+    if (archive->format == ARCHIVE_FORMAT_ZIP) {
+        ok = zip_scan(&builder, archive->fd, archive->file_size);
+    } else if (archive->format == ARCHIVE_FORMAT_TAR) {
+        ok = tar_scan(&builder, tar_read_file, &archive->fd, cancel);
+    } else {
+        ok = tar_gzip_scan(&builder, archive->fd, archive->file_size, cancel);
+    }
+    if (!ok || !builder_finish(&builder)) {
+        int error = errno;
+        builder_free(&builder);
+        errno = error;
+        return false;
+    }
+
+    archive->items = builder.items;
+    archive->count = builder.count;
+    archive->names = builder.names;
+    archive->names_size = builder.names_size;
+    archive->points = builder.points;
+    archive->point_count = builder.point_count;
+    archive->windows = builder.windows;
+    archive->windows_size = builder.windows_size;
+    if (archive->format != ARCHIVE_FORMAT_ZIP) {
+        index_save(archive);
+    }
+    return true;
+}
+
+// Helper: drop a reference (call with g_archives.mutex held)
+static void archive_unref(Archive *archive)
+{
+    if (--archive->refs == 0) {
+        archive_free(archive);
+    }
+}
+
+Archive *archive_open(const char *path, bool scan, const atomic_bool *cancel)
+{
+    ArchiveFormat format;
+    char real[PATH_MAX];
+    struct stat st;
+    if (!format_of_name(path, strlen(path), &format)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (realpath(path, real) == NULL || stat(real, &st) != 0) {
+        return NULL;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // Open already, and unchanged since
+    pthread_mutex_lock(&g_archives.mutex);
+    for (int i = 0; i < ARCHIVE_OPEN_MAX && g_archives.open[i] != NULL; i++) {
+        Archive *open = g_archives.open[i];
+        if (strcmp(open->path, real) == 0 && open->file_size == (uint64_t)st.st_size &&
+            open->file_mtime == (int64_t)st.st_mtime) {
+            memmove(&g_archives.open[1], &g_archives.open[0], (size_t)i * sizeof(Archive *));
+            g_archives.open[0] = open;
+            open->refs++;
+            pthread_mutex_unlock(&g_archives.mutex);
+            return open;
+        }
+    }
+    pthread_mutex_unlock(&g_archives.mutex);
+
+    Archive *archive = calloc(1, sizeof(Archive));
+    if (archive == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    snprintf(archive->path, sizeof(archive->path), "%s", real);
+    archive->file_size = (uint64_t)st.st_size;
+    archive->file_mtime = (int64_t)st.st_mtime;
+    archive->format = format;
+    archive->fd = open(real, O_RDONLY | O_CLOEXEC);
+    if (archive->fd < 0 || !archive_load(archive, scan, cancel)) {
+        int error = errno;
+        archive_free(archive);
+        errno = error;
+        return NULL;
+    }
+
+    // One reference for the caller, one for the open list; the least recently used
+    // archive leaves it
+    archive->refs = 2;
+    pthread_mutex_lock(&g_archives.mutex);
+    Archive *evicted = g_archives.open[ARCHIVE_OPEN_MAX - 1];
+    memmove(&g_archives.open[1], &g_archives.open[0], (ARCHIVE_OPEN_MAX - 1) * sizeof(Archive *));
+    g_archives.open[0] = archive;
+    if (evicted != NULL) {
+        archive_unref(evicted);
+    }
+    pthread_mutex_unlock(&g_archives.mutex);
+    return archive;
+}
+
+void archive_release(Archive *archive)
+{
+    if (archive == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&g_archives.mutex);
+    archive_unref(archive);
+    pthread_mutex_unlock(&g_archives.mutex);
+}
+
+int archive_find(const Archive *archive, const char *inner)
+{
+    int low = 0;
+    int high = archive->count - 1;
+    while (low <= high) {
+        int middle = low + (high - low) / 2;
+        int order = path_compare(archive->names + archive->items[middle].name, inner);
+        if (order == 0) {
+            return middle;
+        }
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return -1;
+}
+
+bool archive_folder(const Archive *archive, const char *inner, int *first, int *end)
+{
+    if (inner[0] == '\0') {
+        *first = 0;
+        *end = archive->count;
+        return true;
+    }
+    int index = archive_find(archive, inner);
+    if (index < 0 || !(archive->items[index].flags & ITEM_DIRECTORY)) {
+        return false;
+    }
+    *first = index + 1;
+    *end = (int)archive->items[index].end;
+    return true;
+}
+
+int archive_next(const Archive *archive, int index)
+{
+    return (int)archive->items[index].end;
+}
+
+void archive_entry(const Archive *archive, int index, ArchiveEntry *entry)
+{
+    const ArchiveItem *item = &archive->items[index];
+    entry->path = archive->names + item->name;
+    const char *slash = strrchr(entry->path, '/');
+    entry->name = slash != NULL ? slash + 1 : entry->path;
+    entry->size = item->size;
+    entry->modified = (time_t)item->modified;
+    entry->mode = (mode_t)item->mode;
+    entry->is_directory = (item->flags & ITEM_DIRECTORY) != 0;
+}
+
+//=============================================================================
+// Reading members
+//=============================================================================
+
+// Helper: start inflating a compressed tar at the access point before the member
+static bool reader_seek_gzip(ArchiveReader *reader)
+{
+    const Archive *archive = reader->archive;
+    int low = 0;
+    int high = archive->point_count - 1;
+    int found = -1;
+    while (low <= high) {
+        int middle = low + (high - low) / 2;
+        if (archive->points[middle].out <= reader->item->offset) {
+            found = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    if (found < 0) {
+        errno = EIO;
+        return false;
+    }
+    const ArchivePoint *point = &archive->points[found];
+
+    unsigned char window[ARCHIVE_WINDOW];
+    uLongf window_size = sizeof(window);
+    if (uncompress(window, &window_size, archive->windows + point->window, point->packed_size) != Z_OK ||
+        window_size != point->window_size) {
+        errno = EIO;
+        return false;
+    }
+    if (inflateInit2(&reader->strm, -15) != Z_OK) {
+        errno = ENOMEM;
+        return false;
+    }
+    reader->inflating = true;
+    reader->raw = true;
+    if (point->bits > 0) {
+        unsigned char byte;
+        if (point->in == 0 || !read_at(archive->fd, &byte, 1, point->in - 1)) {
+            errno = EIO;
+            return false;
+        }
+        inflatePrime(&reader->strm, (int)point->bits, byte >> (8 - point->bits));
+    }
+    if (window_size > 0) {
+        inflateSetDictionary(&reader->strm, window, (uInt)window_size);
+    }
+    reader->in = point->in;
+    reader->skip = reader->item->offset - point->out;
+    reader->packed_left = UINT64_MAX;
+    return true;
+}
+
+ArchiveReader *archive_reader_open(Archive *archive, int index)
+{
+    if (index < 0 || index >= archive->count || (archive->items[index].flags & ITEM_DIRECTORY)) {
+        errno = EISDIR;
+        return NULL;
+    }
+    const ArchiveItem *item = &archive->items[index];
+    if (archive->format == ARCHIVE_FORMAT_ZIP &&
+        ((item->flags & ITEM_ENCRYPTED) || (item->method != 0 && item->method != 8))) {
+        errno = ENOTSUP;
+        return NULL;
+    }
+
+    ArchiveReader *reader = calloc(1, sizeof(ArchiveReader));
+    if (reader == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    reader->archive = archive;
+    reader->item = item;
+    reader->remaining = item->size;
+
+    bool ok = true;
+    if (archive->format == ARCHIVE_FORMAT_ZIP) {
+        // The contents follow the local header, whose name and extra field may differ
+        // in length from the central directory's
+        unsigned char local[30];
+        ok = read_at(archive->fd, local, sizeof(local), item->offset) && le32(local) == 0x04034b50;
+        if (ok) {
+            reader->in = item->offset + 30 + le16(local + 26) + le16(local + 28);
+            reader->packed_left = item->packed;
+            reader->check_crc = true;
+            reader->crc = (uint32_t)crc32(0L, Z_NULL, 0);
+            if (item->method == 8) {
+                ok = inflateInit2(&reader->strm, -15) == Z_OK;
+                reader->inflating = ok;
+            }
+        }
+        if (!ok) {
+            errno = EIO;
+        }
+    } else if (archive->format == ARCHIVE_FORMAT_TAR) {
+        reader->in = item->offset;
+    } else {
+        ok = item->size == 0 || reader_seek_gzip(reader);
+    }
+
+    // The archive stays open while the reader uses it
+    pthread_mutex_lock(&g_archives.mutex);
+    archive->refs++;
+    pthread_mutex_unlock(&g_archives.mutex);
+    if (!ok) {
+        int error = errno;
+        archive_reader_close(reader);
+        errno = error;
+        return NULL;
+    }
+    return reader;
+}
+
+// Helper: next compressed input; false with errno set at the end of the data
+static bool reader_fill(ArchiveReader *reader)
+{
+    size_t want = sizeof(reader->input);
+    if (reader->packed_left < want) {
+        want = (size_t)reader->packed_left;
+    }
+    ssize_t n = want > 0 ? pread(reader->archive->fd, reader->input, want, (off_t)reader->in) : 0;
+    if (n <= 0) {
+        errno = EIO;
+        return false;
+    }
+    reader->in += (uint64_t)n;
+    if (reader->packed_left != UINT64_MAX) {
+        reader->packed_left -= (uint64_t)n;
+    }
+    reader->strm.next_in = reader->input;
+    reader->strm.avail_in = (uInt)n;
+    return true;
+}
+
+// Helper: inflate up to length bytes into buffer; how many, or -1 with errno set
+static ssize_t reader_inflate(ArchiveReader *reader, unsigned char *buffer, size_t length)
+{
+    z_stream *strm = &reader->strm;
+    strm->next_out = buffer;
+    strm->avail_out = (uInt)length;
+    while (strm->avail_out > 0) {
+        if (strm->avail_in == 0 && !reader_fill(reader)) {
+            return -1;
+        }
+        int ret = inflate(strm, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            if (reader->archive->format == ARCHIVE_FORMAT_ZIP) {
+                break;
+            }
+            // The next gzip member: from an access point the trailer is ours to skip
+            for (int trailer = reader->raw ? 8 : 0; trailer > 0;) {
+                if (strm->avail_in == 0 && !reader_fill(reader)) {
+                    return -1;
+                }
+                uInt take = strm->avail_in < (uInt)trailer ? strm->avail_in : (uInt)trailer;
+                strm->next_in += take;
+                strm->avail_in -= take;
+                trailer -= (int)take;
+            }
+            inflateReset2(strm, 15 + 16);
+            reader->raw = false;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            errno = ret == Z_MEM_ERROR ? ENOMEM : EIO;
+            return -1;
+        }
+    }
+    return (ssize_t)(length - strm->avail_out);
+}
+
+ssize_t archive_reader_read(ArchiveReader *reader, void *buffer, size_t length)
+{
+    if (reader->remaining == 0) {
+        return 0;
+    }
+    if (length > reader->remaining) {
+        length = (size_t)reader->remaining;
+    }
+    if (length > UINT_MAX) {
+        length = UINT_MAX;
+    }
+
+    ssize_t n;
+    if (!reader->inflating) {
+        n = pread(reader->archive->fd, buffer, length, (off_t)reader->in);
+        if (n == 0) {
+            errno = EIO;    // Truncated archive
+            n = -1;
+        }
+        if (n > 0) {
+            reader->in += (uint64_t)n;
+        }
+    } else {
+        // Output between the access point and the member goes through buffer and is dropped
+        while (reader->skip > 0) {
+            size_t step = reader->skip < length ? (size_t)reader->skip : length;
+            n = reader_inflate(reader, buffer, step);
+            if (n <= 0) {
+                if (n == 0) errno = EIO;
+                return -1;
+            }
+            reader->skip -= (uint64_t)n;
+        }
+        n = reader_inflate(reader, buffer, length);
+        if (n == 0) {
+            errno = EIO;    // The data ended before the member did
+            n = -1;
+        }
+    }
+    if (n < 0) {
+        return -1;
+    }
+
+    reader->remaining -= (uint64_t)n;
+    if (reader->check_crc) {
+        reader->crc = (uint32_t)crc32(reader->crc, buffer, (uInt)n);
+        if (reader->remaining == 0 && reader->crc != reader->item->crc) {
+            errno = EIO;
+            return -1;
+        }
+    }
+    return n;
+}
+
+void archive_reader_close(ArchiveReader *reader)
+{
+    if (reader == NULL) {
+        return;
+    }
+    if (reader->inflating) {
+        inflateEnd(&reader->strm);
+    }
+    archive_release(reader->archive);
+    free(reader);
+}
+
+//=============================================================================
+// Member copies and sizes
+//=============================================================================
+
+typedef struct CachedCopy {
+    char name[NAME_MAX + 1];
+    time_t used;
+    off_t size;
+} CachedCopy;
+
+static int compare_copies(const void *a, const void *b)
+{
+    const CachedCopy *ca = a;
+    const CachedCopy *cb = b;
+    return (ca->used > cb->used) - (ca->used < cb->used);
+}
+
+// Helper: remove the least recently used copies while they take more than the budget
+static void prune_copies(const char *dir)
+{
+    DIR *handle = opendir(dir);
+    if (handle == NULL) {
+        return;
+    }
+    CachedCopy *copies = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    uint64_t total = 0;
+    struct dirent *entry;
+    while ((entry = readdir(handle)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char path[PATH_MAX];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode) ||
+            !grow((void **)&copies, sizeof(CachedCopy), count + 1, &capacity)) {
+            continue;
+        }
+        snprintf(copies[count].name, sizeof(copies[count].name), "%s", entry->d_name);
+        copies[count].used = st.st_mtime;
+        copies[count].size = st.st_size;
+        total += (uint64_t)st.st_size;
+        count++;
+    }
+    closedir(handle);
+
+    if (count > 0) {
+        qsort(copies, count, sizeof(CachedCopy), compare_copies);
+    }
+    for (size_t i = 0; i < count && total > ARCHIVE_MEMBER_CACHE_BYTES; i++) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", dir, copies[i].name);
+        if (unlink(path) == 0) {
+            total -= (uint64_t)copies[i].size;
+        }
+    }
+    free(copies);
+}
+
+// Helper: write the member at index to fd, closing it; false with errno set
+static bool extract_to(Archive *archive, int index, int fd)
+{
+    ArchiveReader *reader = archive_reader_open(archive, index);
+    if (reader == NULL) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return false;
+    }
+    unsigned char *buffer = malloc(ARCHIVE_READ_CHUNK);
+    bool ok = fd >= 0 && buffer != NULL;
+    while (ok) {
+        ssize_t n = archive_reader_read(reader, buffer, ARCHIVE_READ_CHUNK);
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        ok = write(fd, buffer, (size_t)n) == n;
+    }
+    int error = errno;
+    if (fd >= 0 && close(fd) != 0) {
+        ok = false;
+    }
+    free(buffer);
+    archive_reader_close(reader);
+    errno = error;
+    return ok;
+}
+
+bool archive_member_copy(const char *path, uint64_t max_size, char *local, size_t local_size)
+{
+    char archive_path[PATH_MAX];
+    const char *inner;
+    if (!archive_split_path(path, archive_path, sizeof(archive_path), &inner) || inner[0] == '\0') {
+        return false;
+    }
+    Archive *archive = archive_open(archive_path, false, NULL);
+    if (archive == NULL) {
+        return false;
+    }
+    int index = archive_find(archive, inner);
+    if (index < 0 || (archive->items[index].flags & ITEM_DIRECTORY) || archive->items[index].size > max_size) {
+        archive_release(archive);
+        return false;
+    }
+
+    // Keyed by the archive's version and the member; the name keeps the extension
+    char dir[PATH_MAX];
+    char version[64];
+    snprintf(version, sizeof(version), "|%llu|%lld|", (unsigned long long)archive->file_size,
+             (long long)archive->file_mtime);
+    uint64_t hash = hash_fnv1a64_bytes(HASH_FNV1A64_INIT, archive->path, strlen(archive->path));
+    hash = hash_fnv1a64_bytes(hash_fnv1a64_bytes(hash, version, strlen(version)), inner, strlen(inner));
+    const char *name = strrchr(inner, '/');
+    name = name != NULL ? name + 1 : inner;
+    int written = cache_dir("members", dir, sizeof(dir))
+        ? snprintf(local, local_size, "%s/%016llx-%s", dir, (unsigned long long)hash, name) : -1;
+    bool ok = written > 0 && (size_t)written < local_size;
+
+    struct stat st;
+    if (ok && stat(local, &st) == 0 && (uint64_t)st.st_size == archive->items[index].size) {
+        utimes(local, NULL);    // Recently used
+    } else if (ok) {
+        // A name of its own, so threads extracting the same member do not share it
+        char temp_path[PATH_MAX + 32];
+        snprintf(temp_path, sizeof(temp_path), "%s/.%016llx.XXXXXX", dir, (unsigned long long)hash);
+        int fd = mkstemp(temp_path);
+        ok = fd >= 0 && fcntl(fd, F_SETFD, FD_CLOEXEC) == 0 && fchmod(fd, 0644) == 0;
+        if (fd >= 0 && !ok) {
+            close(fd);
+        }
+        ok = ok && extract_to(archive, index, fd) && rename(temp_path, local) == 0;
+        if (!ok && fd >= 0) {
+            unlink(temp_path);
+        } else if (ok) {
+            prune_copies(dir);
+        }
+    }
+    archive_release(archive);
+    return ok;
+}
+
+bool archive_path_size(const char *path, uint64_t *bytes)
+{
+    char archive_path[PATH_MAX];
+    const char *inner;
+    if (!archive_split_path(path, archive_path, sizeof(archive_path), &inner)) {
+        return false;
+    }
+    Archive *archive = archive_open(archive_path, false, NULL);
+    if (archive == NULL) {
+        return false;
+    }
+    int first = 0;
+    int end = 0;
+    int index = inner[0] != '\0' ? archive_find(archive, inner) : -1;
+    bool ok = true;
+    if (index >= 0 && !(archive->items[index].flags & ITEM_DIRECTORY)) {
+        *bytes = archive->items[index].size;
+    } else if ((ok = archive_folder(archive, inner, &first, &end))) {
+        *bytes = 0;
+        for (int i = first; i < end; i++) {
+            *bytes += archive->items[i].size;
+        }
+    }
+    archive_release(archive);
+    return ok;
+}
@@ -0,0 +1,88 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include <time.h>
+
+// Archives browsed as folders. A path through an archive file, as in
+// "/data/set.zip/images/a.png", names one of its members. Zip archives are listed from
+// their central directory and tar archives from their headers, without reading any
+// member. A gzip-compressed tar is decompressed once to be listed; that pass also keeps
+// an access point (the deflate position and the 32 KiB of output before it) every
+// ARCHIVE_GZIP_SPAN bytes, and tar listings and access points are saved to an index in
+// the cache, so the next open reads only the index and a member is decompressed from
+// the access point before it. Archives are read-only. Thread safe
+
+#define ARCHIVE_CACHE_DIR ".cache/finder-plus/archives"
+#define ARCHIVE_OPEN_MAX 4                              // Archives kept open between listings
+#define ARCHIVE_GZIP_SPAN (16 * 1024 * 1024)            // Uncompressed bytes between access points
+#define ARCHIVE_PREVIEW_MAX (16 * 1024 * 1024)          // Largest member copied out for a preview
+#define ARCHIVE_MEMBER_CACHE_BYTES (256 * 1024 * 1024)  // Member copies kept before the oldest go
+
+// Open archive (opaque, shared by everyone who opened the same file)
+typedef struct Archive Archive;
+
+// Contents of one member being read (opaque)
+typedef struct ArchiveReader ArchiveReader;
+
+typedef struct ArchiveEntry {
+    const char *path;           // In the archive, without leading or trailing slash
+    const char *name;           // Last part of path
+    uint64_t size;
+    time_t modified;
+    mode_t mode;                // Type and permission bits
+    bool is_directory;
+} ArchiveEntry;
+
+// Whether a file name is that of an archive browsed as a folder (.zip, .tar, .tar.gz, .tgz)
+bool archive_is_archive_name(const char *name);
+
+// Split a path through an archive file into the archive's path and the member path in it
+// (*inner points into path; "" for the archive itself). False if no archive is on the path
+bool archive_split_path(const char *path, char *archive_path, size_t archive_size, const char **inner);
+
+// Open an archive, or take it from the ones open already. A tar without a saved index
+// has to be read through to be listed: unless scan is set that fails with EAGAIN, and
+// cancel (may be NULL) stops it with ECANCELED. NULL with errno set on failure
+Archive *archive_open(const char *path, bool scan, const atomic_bool *cancel);
+
+// Drop a reference taken by archive_open
+void archive_release(Archive *archive);
+
+// Items of folder inner ("" for the top) run from *first to *end, stepping with
+// archive_next. False if the archive has no such folder
+bool archive_folder(const Archive *archive, const char *inner, int *first, int *end);
+
+// Item after index and everything below it
+int archive_next(const Archive *archive, int index);
+
+// Item at path inner, or -1
+int archive_find(const Archive *archive, const char *inner);
+
+// Describe the item at index; strings stay valid while the archive is open
+void archive_entry(const Archive *archive, int index, ArchiveEntry *entry);
+
+// Read the contents of the file at index from the start. NULL with errno set for folders
+// and members that cannot be read (encrypted, unknown compression)
+ArchiveReader *archive_reader_open(Archive *archive, int index);
+
+// Read the next bytes: how many, 0 at the end, -1 with errno set on error (a damaged
+// member fails with EIO, a zip member also when its checksum does not match)
+ssize_t archive_reader_read(ArchiveReader *reader, void *buffer, size_t length);
+
+void archive_reader_close(ArchiveReader *reader);
+
+// Path of a copy of the member at path on local disk, extracted into the cache unless one
+// is there already. False for paths outside archives, folders, members over max_size,
+// archives not listed yet, and failures
+bool archive_member_copy(const char *path, uint64_t max_size, char *local, size_t local_size);
+
+// Bytes of the member at path, or of every file below it for a folder. False for paths
+// outside archives and archives not listed yet
+bool archive_path_size(const char *path, uint64_t *bytes);
+
+#endif // ARCHIVE_H
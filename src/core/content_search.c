@@ -0,0 +1,936 @@
+#include "content_search.h"
+#include "dir_walk.h"
+#include "../ai/ignore_rules.h"
+#include "../utils/exclude_set.h"
+#include "../utils/simd.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <regex.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Files this large are mapped; smaller ones are read into the thread's buffer
+#define CONTENT_SEARCH_MMAP_MIN (1024 * 1024)
+
+// Bytes checked for a NUL before a file is searched
+#define CONTENT_SEARCH_BINARY_PROBE 8192
+
+#define NOT_FOUND ((size_t)-1)
+
+// Left out unless the caller names its own patterns
+static const char *DEFAULT_EXCLUDE_PATTERNS[] = {
+    "node_modules", ".git", ".svn", ".hg", "__pycache__",
+};
+
+// Bytes of text and code from most to least common; the rest count as rare
+static const char COMMON_BYTES[] =
+    " etaoinsr\nhldcum.fp_(),=g;wy\"bv01/-{}:'*#<>2k3456789\txjqz";
+
+// A literal found by a vectorized test of two of its rarest bytes at once, then
+// checked in full where both are in place
+typedef struct Prefilter {
+    uint8_t *needle;                    // Lower case when folding
+    size_t len;
+    size_t offset1, offset2;            // Where the two bytes sit in the needle
+    uint8_t byte1, byte2;
+    uint8_t fold1, fold2;               // 0x20 for a letter matched in either case
+    bool fold;
+} Prefilter;
+
+typedef struct ContentSearch ContentSearch;
+
+// One thread's state
+typedef struct SearchWorker {
+    ContentSearch *search;
+    regex_t regex;                      // Own copy, so threads do not share its lock
+    bool regex_compiled;
+    IgnoreStack *ignore;
+    char *buffer;                       // File contents of small files
+    size_t buffer_size;
+    ContentSearchStats stats;
+} SearchWorker;
+
+struct ContentSearch {
+    const char *pattern;
+    ContentSearchOptions options;
+    ExcludeSet *excludes;
+    Prefilter prefilter;
+    bool has_prefilter;                 // Regex without a required literal: none
+    DirWalk *walk;                      // Stopped by the cap, the callback or the job's owner
+
+    ContentMatchCallback callback;
+    void *user_data;
+    pthread_mutex_t results_mutex;
+    int result_count;
+    bool truncated;
+
+    SearchWorker workers[CONTENT_SEARCH_MAX_THREADS];
+    int thread_count;
+};
+
+struct ContentSearchJob {
+    pthread_t thread;
+    char *root;
+    char *pattern;
+    ContentSearchOptions options;
+    char **excludes;                    // Own copies of options.exclude_patterns
+    atomic_bool cancel;
+    atomic_bool done;
+
+    pthread_mutex_t mutex;
+    ContentSearchResults found;         // Not polled yet
+    bool truncated;
+    ContentSearchStats stats;
+};
+
+ContentSearchOptions content_search_default_options(void)
+{
+    ContentSearchOptions options = {0};
+    options.respect_ignore_files = true;
+    options.max_results = 1000;
+    options.max_per_file = 16;
+    options.max_file_size = 64LL * 1024 * 1024;
+    return options;
+}
+
+//=============================================================================
+// Literal prefilter
+//=============================================================================
+
+static inline uint8_t fold_byte(uint8_t c)
+{
+    return (c >= 'A' && c <= 'Z') ? (uint8_t)(c + ('a' - 'A')) : c;
+}
+
+// Helper: How common a byte is in text (0 for rare ones)
+static int byte_frequency(uint8_t c, bool fold)
+{
+    if (fold) {
+        c = fold_byte(c);
+    }
+    const char *at = c ? memchr(COMMON_BYTES, c, sizeof(COMMON_BYTES) - 1) : NULL;
+    return at ? (int)(sizeof(COMMON_BYTES) - (size_t)(at - COMMON_BYTES)) : 0;
+}
+
+static bool prefilter_init(Prefilter *filter, const char *literal, size_t len, bool fold)
+{
+    memset(filter, 0, sizeof(*filter));
+    filter->needle = malloc(len + 1);
+    if (!filter->needle) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        filter->needle[i] = fold ? fold_byte((uint8_t)literal[i]) : (uint8_t)literal[i];
+    }
+    filter->len = len;
+    filter->fold = fold;
+
+    // The rarest byte, then the rarest other byte (another value when there is one)
+    size_t first = 0;
+    for (size_t i = 1; i < len; i++) {
+        if (byte_frequency(filter->needle[i], fold) < byte_frequency(filter->needle[first], fold)) {
+            first = i;
+        }
+    }
+    size_t second = first;
+    for (size_t i = 0; i < len; i++) {
+        if (i == first) {
+            continue;
+        }
+        bool distinct = filter->needle[i] != filter->needle[first];
+        bool second_distinct = second != first && filter->needle[second] != filter->needle[first];
+        if (second == first || (distinct && !second_distinct) ||
+            (distinct == second_distinct &&
+             byte_frequency(filter->needle[i], fold) < byte_frequency(filter->needle[second], fold))) {
+            second = i;
+        }
+    }
+
+    filter->offset1 = first;
+    filter->offset2 = second;
+    filter->byte1 = filter->needle[first];
+    filter->byte2 = filter->needle[second];
+    if (fold) {
+        filter->fold1 = (filter->byte1 >= 'a' && filter->byte1 <= 'z') ? 0x20 : 0;
+        filter->fold2 = (filter->byte2 >= 'a' && filter->byte2 <= 'z') ? 0x20 : 0;
+    }
+    return true;
+}
+
+// Helper: Whether the whole needle sits at text
+static inline bool prefilter_verify(const Prefilter *filter, const uint8_t *text)
+{
+    if (!filter->fold) {
+        return memcmp(text, filter->needle, filter->len) == 0;
+    }
+    for (size_t i = 0; i < filter->len; i++) {
+        if (fold_byte(text[i]) != filter->needle[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Offset of the first occurrence of the needle in data[start, end), or NOT_FOUND.
+// Sixteen candidate starts are tested per step: both rare bytes must be in place
+static size_t prefilter_find(const Prefilter *filter, const uint8_t *data, size_t start, size_t end)
+{
+    if (end < start || end - start < filter->len) {
+        return NOT_FOUND;
+    }
+    size_t last = end - filter->len;        // Last start the needle fits at
+    size_t pos = start;
+
+    if (filter->len == 1 && !filter->fold1) {
+        const uint8_t *hit = memchr(data + start, filter->byte1, end - start);
+        return hit ? (size_t)(hit - data) : NOT_FOUND;
+    }
+
+    SimdBytes byte1 = simd_splat(filter->byte1), byte2 = simd_splat(filter->byte2);
+    SimdBytes fold1 = simd_splat(filter->fold1), fold2 = simd_splat(filter->fold2);
+    for (; pos + 15 <= last; pos += 16) {
+        SimdBytes v1 = simd_or(simd_load(data + pos + filter->offset1), fold1);
+        SimdBytes v2 = simd_or(simd_load(data + pos + filter->offset2), fold2);
+        uint32_t bits = simd_mask(simd_and(simd_eq(v1, byte1), simd_eq(v2, byte2)));
+        while (bits) {
+            size_t at = pos + (size_t)__builtin_ctz(bits);
+            if (prefilter_verify(filter, data + at)) {
+                return at;
+            }
+            bits &= bits - 1;
+        }
+    }
+
+    for (; pos <= last; pos++) {
+        if ((data[pos + filter->offset1] | filter->fold1) == filter->byte1 &&
+            (data[pos + filter->offset2] | filter->fold2) == filter->byte2 &&
+            prefilter_verify(filter, data + pos)) {
+            return pos;
+        }
+    }
+    return NOT_FOUND;
+}
+
+// Helper: The longest run of literal characters every match of an extended regex must
+// contain, or 0 bytes when there is none (alternation at the top, say). Groups, bracket
+// expressions, classes and optional characters end a run
+static size_t regex_required_literal(const char *pattern, char *out, size_t out_size)
+{
+    char run[256];
+    size_t run_len = 0, best_len = 0;
+    bool after_literal = false;         // A quantifier here applies to the run's last character
+    int depth = 0;
+
+    for (const char *c = pattern; ; c++) {
+        bool literal = false;
+        char value = 0;
+
+        if (*c == '\\') {
+            if (c[1] == '|') {
+                return 0;                       // GNU alternation
+            }
+            if (c[1] == '\0') {
+                // A trailing backslash ends the pattern
+            } else if ((c[1] >= '0' && c[1] <= '9') || (c[1] >= 'a' && c[1] <= 'z') ||
+                       (c[1] >= 'A' && c[1] <= 'Z') || c[1] == '<' || c[1] == '>' ||
+                       c[1] == '`' || c[1] == '\'') {
+                c++;                            // A class, anchor or back reference
+            } else {
+                literal = true;
+                value = *++c;
+            }
+        } else if (*c == '[') {
+            // Skip the bracket expression: a ']' first is part of it
+            c++;
+            if (*c == '^') c++;
+            if (*c == ']') c++;
+            while (*c && *c != ']') {
+                if (c[0] == '[' && (c[1] == ':' || c[1] == '.' || c[1] == '=')) {
+                    const char *close = strchr(c + 2, ']');
+                    c = close ? close : c + 1;
+                }
+                if (*c) c++;
+            }
+            if (*c == '\0') c--;
+        } else if (*c == '(') {
+            depth++;
+        } else if (*c == ')') {
+            if (depth > 0) depth--;
+        } else if (*c == '|' && depth == 0) {
+            return 0;
+        } else if (*c == '*' || *c == '?' || *c == '{') {
+            // The character before may be absent
+            if (after_literal && run_len > 0) {
+                run_len--;
+            }
+            if (*c == '{') {
+                const char *close = strchr(c, '}');
+                c = close ? close : c;
+            }
+        } else if (*c != '\0' && !strchr("+.^$|", *c)) {
+            literal = true;
+            value = *c;
+        }
+
+        if (literal && depth == 0) {
+            if (run_len < sizeof(run)) {
+                run[run_len++] = value;
+            }
+            after_literal = true;
+            continue;
+        }
+
+        // The run ends here; keep the longest
+        if (run_len > best_len) {
+            best_len = run_len < out_size ? run_len : out_size;
+            memcpy(out, run, best_len);
+        }
+        run_len = 0;
+        after_literal = false;
+        if (*c == '\0') {
+            break;
+        }
+    }
+    return best_len;
+}
+
+//=============================================================================
+// Searching one file
+//=============================================================================
+
+static inline bool search_stopped(const ContentSearch *search)
+{
+    return dir_walk_stopped(search->walk);
+}
+
+// Helper: Report one match; false once the search should stop
+static bool search_report(ContentSearch *search, const char *path, int line, const char *text,
+                          size_t line_len, size_t match_offset)
+{
+    // Long lines are cut to a window around the match, on character boundaries
+    size_t from = 0, to = line_len;
+    if (line_len > CONTENT_SEARCH_MAX_LINE) {
+        from = match_offset > CONTENT_SEARCH_MAX_LINE / 4 ? match_offset - CONTENT_SEARCH_MAX_LINE / 4 : 0;
+        to = from + CONTENT_SEARCH_MAX_LINE;
+        if (to > line_len) {
+            to = line_len;
+            from = to - CONTENT_SEARCH_MAX_LINE;
+        }
+        while (from > 0 && ((uint8_t)text[from] & 0xC0) == 0x80) from++;
+        while (to < line_len && to > from && ((uint8_t)text[to] & 0xC0) == 0x80) to--;
+    }
+    while (to > from && (text[to - 1] == '\r' || text[to - 1] == '\n')) {
+        to--;
+    }
+
+    char snippet[CONTENT_SEARCH_MAX_LINE + 1];
+    memcpy(snippet, text + from, to - from);
+    snippet[to - from] = '\0';
+
+    ContentMatch match = {
+        .path = (char *)path,
+        .line = line,
+        .column = (int)match_offset + 1,
+        .text = snippet,
+    };
+
+    bool keep_going = true;
+    pthread_mutex_lock(&search->results_mutex);
+    if (search_stopped(search)) {
+        keep_going = false;
+    } else if (search->result_count >= search->options.max_results) {
+        search->truncated = true;
+        keep_going = false;
+    } else {
+        search->result_count++;
+        keep_going = search->callback(&match, search->user_data);
+    }
+    pthread_mutex_unlock(&search->results_mutex);
+
+    if (!keep_going) {
+        dir_walk_stop(search->walk);
+    }
+    return keep_going;
+}
+
+// Helper: Search a file's bytes line by line; false once the search stops
+static bool search_buffer(ContentSearch *search, SearchWorker *worker, const char *path,
+                          const char *data, size_t len)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    size_t pos = 0;             // Start of the first line not searched yet
+    size_t counted = 0;         // Newlines before here are counted in line
+    int line = 1;
+    int reported = 0;
+
+    while (pos < len) {
+        if (search_stopped(search)) {
+            return false;
+        }
+
+        size_t match;
+        if (search->has_prefilter) {
+            match = prefilter_find(&search->prefilter, bytes, pos, len);
+            if (match == NOT_FOUND) {
+                break;
+            }
+        } else {
+            regmatch_t found = { .rm_so = (regoff_t)pos, .rm_eo = (regoff_t)len };
+            if (regexec(&worker->regex, data, 1, &found, REG_STARTEND) != 0) {
+                break;
+            }
+            match = (size_t)found.rm_so;
+        }
+
+        size_t line_start = match;
+        while (line_start > pos && bytes[line_start - 1] != '\n') {
+            line_start--;
+        }
+        const uint8_t *newline = memchr(bytes + match, '\n', len - match);
+        size_t line_end = newline ? (size_t)(newline - bytes) : len;
+
+        // The literal is only a candidate: the whole line goes to the regex
+        if (search->has_prefilter && search->options.regex) {
+            regmatch_t found = { .rm_so = (regoff_t)line_start, .rm_eo = (regoff_t)line_end };
+            if (regexec(&worker->regex, data, 1, &found, REG_STARTEND) != 0) {
+                pos = line_end + 1;
+                continue;
+            }
+            match = (size_t)found.rm_so;
+        }
+
+        for (size_t i = counted; i < line_start; i++) {
+            line += bytes[i] == '\n';
+        }
+        counted = line_start;
+
+        if (!search_report(search, path, line, data + line_start, line_end - line_start, match - line_start)) {
+            return false;
+        }
+        if (search->options.max_per_file > 0 && ++reported >= search->options.max_per_file) {
+            break;
+        }
+        pos = line_end + 1;
+    }
+    return true;
+}
+
+// Helper: Read or map a regular file and search it unless it looks binary
+static void search_file(ContentSearch *search, SearchWorker *worker, const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        worker->stats.files_skipped++;
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        (search->options.max_file_size > 0 && st.st_size > search->options.max_file_size)) {
+        worker->stats.files_skipped++;
+        close(fd);
+        return;
+    }
+
+    size_t size = (size_t)st.st_size;
+    const char *data = NULL;
+    void *mapped = MAP_FAILED;
+    if (size >= CONTENT_SEARCH_MMAP_MIN) {
+        mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            data = mapped;
+        }
+    }
+    if (!data && size > 0) {
+        // One byte more for a terminating NUL, so the text is a string as well
+        if (size + 1 > worker->buffer_size) {
+            char *buffer = realloc(worker->buffer, size + 1);
+            if (!buffer) {
+                worker->stats.files_skipped++;
+                close(fd);
+                return;
+            }
+            worker->buffer = buffer;
+            worker->buffer_size = size + 1;
+        }
+        size_t filled = 0;
+        while (filled < size) {
+            ssize_t got = read(fd, worker->buffer + filled, size - filled);
+            if (got <= 0) {
+                break;
+            }
+            filled += (size_t)got;
+        }
+        worker->buffer[filled] = '\0';
+        size = filled;
+        data = worker->buffer;
+    }
+    close(fd);
+
+    size_t probe = size < CONTENT_SEARCH_BINARY_PROBE ? size : CONTENT_SEARCH_BINARY_PROBE;
+    if (size > 0 && memchr(data, '\0', probe)) {
+        worker->stats.files_binary++;
+    } else {
+        worker->stats.files_searched++;
+        worker->stats.bytes_searched += (int64_t)size;
+        if (size > 0) {
+            search_buffer(search, worker, path, data, size);
+        }
+    }
+
+    if (mapped != MAP_FAILED) {
+        munmap(mapped, (size_t)st.st_size);
+    }
+}
+
+//=============================================================================
+// Walking the tree
+//=============================================================================
+
+// Helper: Read one folder, searching its files and pushing subfolders
+static void search_read_dir(DirWalk *walk, int index, const char *path, int depth, void *user_data)
+{
+    ContentSearch *search = (ContentSearch *)user_data;
+    SearchWorker *worker = &search->workers[index];
+    if (worker->ignore && !ignore_stack_enter(worker->ignore, path)) {
+        return;
+    }
+
+    DIR *handle = opendir(path);
+    if (!handle) {
+        return;
+    }
+
+    size_t dir_len = strlen(path);
+    bool at_root = dir_len == 1 && path[0] == '/';
+    struct dirent *entry;
+    while (!search_stopped(search) && (entry = readdir(handle)) != NULL) {
+        const char *name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+            continue;
+        }
+        if (name[0] == '.' && !search->options.include_hidden) {
+            continue;
+        }
+
+        char full_path[4096];
+        int len = snprintf(full_path, sizeof(full_path), "%s/%s", at_root ? "" : path, name);
+        if (len < 0 || len >= (int)sizeof(full_path)) {
+            continue;
+        }
+        if (exclude_set_match(search->excludes, full_path, at_root ? 0 : dir_len)) {
+            continue;
+        }
+
+        // The entry type usually comes with the name; only ask when it does not.
+        // Symbolic links are not followed
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN) {
+            struct stat st;
+            if (lstat(full_path, &st) != 0) {
+                continue;
+            }
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_LNK;
+        }
+        if (type != DT_DIR && type != DT_REG) {
+            continue;
+        }
+        if (worker->ignore && ignore_stack_match(worker->ignore, full_path, type == DT_DIR)) {
+            continue;
+        }
+
+        if (type == DT_REG) {
+            search_file(search, worker, full_path);
+            continue;
+        }
+        if (depth < CONTENT_SEARCH_MAX_DEPTH) {
+            dir_walk_push(walk, index, full_path, depth + 1);
+        }
+    }
+    closedir(handle);
+}
+
+//=============================================================================
+// Entry points
+//=============================================================================
+
+// Helper: Compile a pattern under options into the search (or just check it)
+static bool search_compile(ContentSearch *search, const char *pattern, const ContentSearchOptions *options,
+                           char *error, size_t error_size)
+{
+    if (!pattern || pattern[0] == '\0') {
+        snprintf(error, error_size, "Empty pattern");
+        return false;
+    }
+
+    const char *literal = pattern;
+    size_t literal_len = strlen(pattern);
+    char required[256];
+    if (options->regex) {
+        regex_t regex;
+        int flags = REG_EXTENDED | REG_NEWLINE | REG_NOSUB | (options->case_sensitive ? 0 : REG_ICASE);
+        int status = regcomp(&regex, pattern, flags);
+        if (status != 0) {
+            regerror(status, &regex, error, error_size);
+            return false;
+        }
+        regfree(&regex);
+        literal = required;
+        literal_len = regex_required_literal(pattern, required, sizeof(required));
+    }
+
+    if (search && literal_len > 0) {
+        if (!prefilter_init(&search->prefilter, literal, literal_len, !options->case_sensitive)) {
+            snprintf(error, error_size, "Out of memory");
+            return false;
+        }
+        search->has_prefilter = true;
+    }
+    return true;
+}
+
+bool content_search_validate(const char *pattern, const ContentSearchOptions *options,
+                             char *error, size_t error_size)
+{
+    char scratch[256];
+    if (!error || error_size == 0) {
+        error = scratch;
+        error_size = sizeof(scratch);
+    }
+    error[0] = '\0';
+    ContentSearchOptions defaults = content_search_default_options();
+    return search_compile(NULL, pattern, options ? options : &defaults, error, error_size);
+}
+
+// Helper: Build the exclude set of options (the defaults when it names none)
+static ExcludeSet *search_excludes(const ContentSearchOptions *options)
+{
+    ExcludeSet *set = exclude_set_create();
+    if (!set) {
+        return NULL;
+    }
+    const char *const *patterns = options->exclude_patterns;
+    int count = options->exclude_count;
+    if (!patterns) {
+        patterns = DEFAULT_EXCLUDE_PATTERNS;
+        count = (int)(sizeof(DEFAULT_EXCLUDE_PATTERNS) / sizeof(DEFAULT_EXCLUDE_PATTERNS[0]));
+    }
+    for (int i = 0; i < count; i++) {
+        if (patterns[i] && patterns[i][0] && !exclude_set_add(set, patterns[i])) {
+            exclude_set_destroy(set);
+            return NULL;
+        }
+    }
+    return set;
+}
+
+// Helper: Run a search, stopping early when cancel is set
+static bool search_run(const char *root, const char *pattern, const ContentSearchOptions *options,
+                       ContentMatchCallback callback, void *user_data, const atomic_bool *cancel,
+                       ContentSearchStats *stats, bool *truncated)
+{
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+    }
+    if (truncated) {
+        *truncated = false;
+    }
+    if (!root || !callback) {
+        return false;
+    }
+    ContentSearchOptions defaults = content_search_default_options();
+    if (!options) {
+        options = &defaults;
+    }
+
+    struct stat st;
+    if (stat(root, &st) != 0 || (!S_ISDIR(st.st_mode) && !S_ISREG(st.st_mode))) {
+        return false;
+    }
+
+    char root_path[4096];
+    if (!dir_walk_root(root, root_path, sizeof(root_path))) {
+        return false;
+    }
+
+    ContentSearch *search = calloc(1, sizeof(ContentSearch));
+    if (!search) {
+        return false;
+    }
+    char error[256];
+    search->pattern = pattern;
+    search->options = *options;
+    if (search->options.max_results <= 0) {
+        search->options.max_results = defaults.max_results;
+    }
+    search->callback = callback;
+    search->user_data = user_data;
+    search->excludes = search_excludes(options);
+    // One file needs no helpers
+    search->walk = dir_walk_create(S_ISDIR(st.st_mode) ? CONTENT_SEARCH_MAX_THREADS : 1, cancel);
+    if (!search->excludes || !search->walk ||
+        !search_compile(search, pattern, options, error, sizeof(error))) {
+        exclude_set_destroy(search->excludes);
+        dir_walk_destroy(search->walk);
+        free(search);
+        return false;
+    }
+    pthread_mutex_init(&search->results_mutex, NULL);
+
+    int threads = dir_walk_thread_count(search->walk);
+    search->thread_count = threads;
+
+    bool ready = true;
+    int regex_flags = REG_EXTENDED | REG_NEWLINE | (options->case_sensitive ? 0 : REG_ICASE);
+    for (int i = 0; i < threads; i++) {
+        SearchWorker *worker = &search->workers[i];
+        worker->search = search;
+        if (options->regex) {
+            worker->regex_compiled = regcomp(&worker->regex, pattern, regex_flags) == 0;
+            ready = ready && worker->regex_compiled;
+        }
+        if (options->respect_ignore_files && S_ISDIR(st.st_mode)) {
+            worker->ignore = ignore_stack_create();
+            ready = ready && worker->ignore;
+        }
+    }
+
+    if (ready && S_ISREG(st.st_mode)) {
+        search_file(search, &search->workers[0], root_path);
+    } else if (ready) {
+        dir_walk_run(search->walk, root_path, search_read_dir, search);
+    }
+
+    for (int i = 0; i < threads; i++) {
+        SearchWorker *worker = &search->workers[i];
+        if (stats) {
+            stats->files_searched += worker->stats.files_searched;
+            stats->files_binary += worker->stats.files_binary;
+            stats->files_skipped += worker->stats.files_skipped;
+            stats->bytes_searched += worker->stats.bytes_searched;
+        }
+        if (worker->regex_compiled) {
+            regfree(&worker->regex);
+        }
+        ignore_stack_destroy(worker->ignore);
+        free(worker->buffer);
+    }
+    if (truncated) {
+        *truncated = search->truncated;
+    }
+
+    pthread_mutex_destroy(&search->results_mutex);
+    dir_walk_destroy(search->walk);
+    exclude_set_destroy(search->excludes);
+    free(search->prefilter.needle);
+    free(search);
+    return ready;
+}
+
+bool content_search_run(const char *root, const char *pattern, const ContentSearchOptions *options,
+                        ContentMatchCallback callback, void *user_data, ContentSearchStats *stats)
+{
+    return search_run(root, pattern, options, callback, user_data, NULL, stats, NULL);
+}
+
+// Helper: Append a copy of a match to results
+static bool results_append(ContentSearchResults *results, const ContentMatch *match)
+{
+    if (results->count == results->capacity) {
+        int capacity = results->capacity ? results->capacity * 2 : 64;
+        ContentMatch *matches = realloc(results->matches, (size_t)capacity * sizeof(ContentMatch));
+        if (!matches) {
+            return false;
+        }
+        results->matches = matches;
+        results->capacity = capacity;
+    }
+    ContentMatch *copy = &results->matches[results->count];
+    copy->path = strdup(match->path);
+    copy->text = strdup(match->text);
+    copy->line = match->line;
+    copy->column = match->column;
+    if (!copy->path || !copy->text) {
+        free(copy->path);
+        free(copy->text);
+        return false;
+    }
+    results->count++;
+    return true;
+}
+
+// Callback: Collect into a ContentSearchResults
+static bool collect_match(const ContentMatch *match, void *user_data)
+{
+    return results_append((ContentSearchResults *)user_data, match);
+}
+
+static int match_compare(const void *a, const void *b)
+{
+    const ContentMatch *ma = (const ContentMatch *)a;
+    const ContentMatch *mb = (const ContentMatch *)b;
+    int order = strcmp(ma->path, mb->path);
+    return order != 0 ? order : (ma->line > mb->line) - (ma->line < mb->line);
+}
+
+bool content_search(const char *root, const char *pattern, const ContentSearchOptions *options,
+                    ContentSearchResults *results)
+{
+    if (!results) {
+        return false;
+    }
+    memset(results, 0, sizeof(*results));
+    bool searched = search_run(root, pattern, options, collect_match, results, NULL,
+                               &results->stats, &results->truncated);
+
+    // Threads finish in any order; sort for a stable answer
+    if (results->count > 1) {
+        qsort(results->matches, (size_t)results->count, sizeof(ContentMatch), match_compare);
+    }
+    return searched;
+}
+
+void content_search_results_free(ContentSearchResults *results)
+{
+    if (!results) {
+        return;
+    }
+    for (int i = 0; i < results->count; i++) {
+        free(results->matches[i].path);
+        free(results->matches[i].text);
+    }
+    free(results->matches);
+    memset(results, 0, sizeof(*results));
+}
+
+// Callback: Queue a match for the job's next poll
+static bool job_collect_match(const ContentMatch *match, void *user_data)
+{
+    ContentSearchJob *job = (ContentSearchJob *)user_data;
+    pthread_mutex_lock(&job->mutex);
+    bool added = results_append(&job->found, match);
+    pthread_mutex_unlock(&job->mutex);
+    return added && !atomic_load(&job->cancel);
+}
+
+// Thread function: Run the job's search
+static void *job_thread(void *arg)
+{
+    ContentSearchJob *job = (ContentSearchJob *)arg;
+    ContentSearchStats stats;
+    bool truncated = false;
+    search_run(job->root, job->pattern, &job->options, job_collect_match, job, &job->cancel,
+               &stats, &truncated);
+
+    pthread_mutex_lock(&job->mutex);
+    job->stats = stats;
+    job->truncated = truncated;
+    pthread_mutex_unlock(&job->mutex);
+    atomic_store(&job->done, true);
+    return NULL;
+}
+
+// Helper: Free a job's own copies and matches
+static void job_free(ContentSearchJob *job)
+{
+    for (int i = 0; job->excludes && i < job->options.exclude_count; i++) {
+        free(job->excludes[i]);
+    }
+    free(job->excludes);
+    content_search_results_free(&job->found);
+    pthread_mutex_destroy(&job->mutex);
+    free(job->root);
+    free(job->pattern);
+    free(job);
+}
+
+ContentSearchJob* content_search_start(const char *root, const char *pattern,
+                                       const ContentSearchOptions *options)
+{
+    ContentSearchOptions defaults = content_search_default_options();
+    if (!options) {
+        options = &defaults;
+    }
+    if (!root || !content_search_validate(pattern, options, NULL, 0)) {
+        return NULL;
+    }
+
+    ContentSearchJob *job = calloc(1, sizeof(ContentSearchJob));
+    if (!job) {
+        return NULL;
+    }
+    pthread_mutex_init(&job->mutex, NULL);
+    job->options = *options;
+    job->root = strdup(root);
+    job->pattern = strdup(pattern);
+    bool copied = job->root && job->pattern;
+
+    // The caller's patterns may not outlive the call
+    if (copied && options->exclude_patterns && options->exclude_count > 0) {
+        job->excludes = calloc((size_t)options->exclude_count, sizeof(char *));
+        copied = job->excludes != NULL;
+        for (int i = 0; copied && i < options->exclude_count; i++) {
+            job->excludes[i] = strdup(options->exclude_patterns[i] ? options->exclude_patterns[i] : "");
+            copied = job->excludes[i] != NULL;
+        }
+        job->options.exclude_patterns = (const char *const *)job->excludes;
+    }
+    if (!copied || pthread_create(&job->thread, NULL, job_thread, job) != 0) {
+        job_free(job);
+        return NULL;
+    }
+    return job;
+}
+
+int content_search_poll(ContentSearchJob *job, ContentSearchResults *results)
+{
+    if (!job || !results) {
+        return 0;
+    }
+    int moved = 0;
+    pthread_mutex_lock(&job->mutex);
+    for (int i = 0; i < job->found.count; i++) {
+        ContentMatch *match = &job->found.matches[i];
+        if (results->count == results->capacity) {
+            int capacity = results->capacity ? results->capacity * 2 : 64;
+            ContentMatch *matches = realloc(results->matches, (size_t)capacity * sizeof(ContentMatch));
+            if (!matches) {
+                free(match->path);
+                free(match->text);
+                continue;
+            }
+            results->matches = matches;
+            results->capacity = capacity;
+        }
+        results->matches[results->count++] = *match;
+        moved++;
+    }
+    job->found.count = 0;
+    results->truncated = job->truncated;
+    results->stats = job->stats;
+    pthread_mutex_unlock(&job->mutex);
+    return moved;
+}
+
+bool content_search_is_done(ContentSearchJob *job)
+{
+    return !job || atomic_load(&job->done);
+}
+
+void content_search_cancel(ContentSearchJob *job)
+{
+    if (!job) {
+        return;
+    }
+    atomic_store(&job->cancel, true);
+    pthread_join(job->thread, NULL);
+    job_free(job);
+}
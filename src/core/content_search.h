@@ -0,0 +1,104 @@
+#ifndef CONTENT_SEARCH_H
+#define CONTENT_SEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Literal or regex search of file contents below a folder, after ripgrep. A small pool
+// of threads walks the tree (dir_walk.h), leaving out hidden entries, the exclude
+// patterns and, when asked, what .gitignore/.ignore files and cache markers exclude.
+// Small files are read into a per-thread buffer and large ones mapped; a file with a
+// NUL byte in its first block is taken as binary and skipped. Lines are found by a
+// vectorized scan for two rare bytes of the literal (for a regex, a literal every match
+// must contain), and only the lines holding candidates are checked in full or handed
+// to the regex engine. One match is reported per line
+
+// Folders deeper than this below the root are not entered
+#define CONTENT_SEARCH_MAX_DEPTH 32
+
+// Threads walking one search (the caller's or the job's is one of them)
+#define CONTENT_SEARCH_MAX_THREADS 8
+
+// Longest line text kept for a match; longer lines are cut around the match
+#define CONTENT_SEARCH_MAX_LINE 256
+
+typedef struct ContentSearchOptions {
+    bool regex;                         // POSIX extended regex instead of a literal
+    bool case_sensitive;
+    bool include_hidden;                // Search dot files and enter dot folders
+    bool respect_ignore_files;          // Leave out what .gitignore/.ignore and CACHEDIR.TAG exclude
+    const char *const *exclude_patterns;  // Names or globs to leave out, as for the indexer
+    int exclude_count;                  // NULL patterns with 0: the defaults (node_modules, ...)
+    int max_results;                    // Stop after this many matches
+    int max_per_file;                   // Matches reported per file (0: no limit)
+    int64_t max_file_size;              // Larger files are skipped (0: no limit)
+} ContentSearchOptions;
+
+// One matching line
+typedef struct ContentMatch {
+    char *path;
+    int line;                           // 1-based
+    int column;                         // 1-based byte offset of the match in the line
+    char *text;                         // The line (cut to CONTENT_SEARCH_MAX_LINE bytes)
+} ContentMatch;
+
+typedef struct ContentSearchStats {
+    int files_searched;
+    int files_binary;                   // Skipped for a NUL byte
+    int files_skipped;                  // Too large or unreadable
+    int64_t bytes_searched;
+} ContentSearchStats;
+
+// Matches in the order they were found (files finish in any order across threads)
+typedef struct ContentSearchResults {
+    ContentMatch *matches;
+    int count;
+    int capacity;
+    bool truncated;                     // The cap was reached and the walk stopped early
+    ContentSearchStats stats;
+} ContentSearchResults;
+
+// Called for each match, one call at a time; false stops the search. The match is only
+// valid during the call
+typedef bool (*ContentMatchCallback)(const ContentMatch *match, void *user_data);
+
+// A search running on its own thread, for the search bar
+typedef struct ContentSearchJob ContentSearchJob;
+
+// Defaults: literal, case-insensitive, ignore files respected, 1000 results, 16 per file,
+// files up to 64 MB
+ContentSearchOptions content_search_default_options(void);
+
+// Check that pattern compiles under options (a regex, or a non-empty literal); writes
+// the reason to error when it does not
+bool content_search_validate(const char *pattern, const ContentSearchOptions *options,
+                             char *error, size_t error_size);
+
+// Search root (a folder, or a single file) for pattern, calling callback for each match.
+// Stats may be NULL. False if the pattern is invalid or root cannot be read
+bool content_search_run(const char *root, const char *pattern, const ContentSearchOptions *options,
+                        ContentMatchCallback callback, void *user_data, ContentSearchStats *stats);
+
+// Search root and collect the matches, sorted by path and line
+bool content_search(const char *root, const char *pattern, const ContentSearchOptions *options,
+                    ContentSearchResults *results);
+
+// Free collected matches
+void content_search_results_free(ContentSearchResults *results);
+
+// Start searching on a background thread; NULL if the pattern is invalid
+ContentSearchJob* content_search_start(const char *root, const char *pattern,
+                                       const ContentSearchOptions *options);
+
+// Move the matches found since the last poll to the end of results; returns how many.
+// results->truncated and stats are filled in once the job is done
+int content_search_poll(ContentSearchJob *job, ContentSearchResults *results);
+
+// Whether the job has finished (all of its matches may not have been polled yet)
+bool content_search_is_done(ContentSearchJob *job);
+
+// Stop the job, wait for its threads and free it
+void content_search_cancel(ContentSearchJob *job);
+
+#endif // CONTENT_SEARCH_H
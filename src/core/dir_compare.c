@@ -0,0 +1,641 @@
+#include "dir_compare.h"
+#include "../utils/file_hash.h"
+#include "../utils/hash.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Open addressing table from names to their index in a names array
+typedef struct NameIndex {
+    int *slots;                         // Index + 1, 0 when empty
+    uint32_t mask;
+} NameIndex;
+
+// Two files to compare by content
+typedef struct FilePair {
+    char *left_path;
+    char *right_path;
+    uint64_t size;
+    bool same;                          // Result
+} FilePair;
+
+typedef struct FilePairList {
+    FilePair *items;
+    int count;
+    int capacity;
+} FilePairList;
+
+// Entries in both listings the thread decides
+typedef struct ComparePair {
+    int left_index;
+    int right_index;
+    bool is_directory;
+    uint64_t size;
+    char *left_path;
+    char *right_path;
+} ComparePair;
+
+typedef struct CompareUpdate {
+    int left_index;
+    int right_index;
+    CompareResult result;
+} CompareUpdate;
+
+// One entry of a directory read while walking a tree
+typedef struct TreeEntry {
+    char *name;
+    mode_t mode;
+    off_t size;
+    time_t mtime;
+} TreeEntry;
+
+typedef struct TreeListing {
+    TreeEntry *entries;
+    const char **names;
+    int count;
+    int capacity;
+} TreeListing;
+
+struct DirCompare {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool stopping;
+
+    // Guarded by mutex
+    uint32_t requested;                 // Generation of the latest request
+    uint32_t started;                   // Generation the thread last began
+    uint32_t finished;                  // Generation the thread last finished
+    ComparePair *pairs;                 // Latest request, until the thread takes it
+    int pair_count;
+    bool content;
+    int left_count;                     // Listing sizes of the latest request
+    int right_count;
+    CompareUpdate *updates;             // Decided since the last poll
+    int update_count;
+    int update_capacity;
+};
+
+// Helper: Index names[0..count); false if out of memory
+static bool name_index_build(NameIndex *index, const char *const *names, int count)
+{
+    uint32_t capacity = 16;
+    while (capacity < (uint32_t)count * 2) capacity <<= 1;
+
+    index->slots = calloc(capacity, sizeof(int));
+    if (!index->slots) return false;
+    index->mask = capacity - 1;
+
+    for (int i = 0; i < count; i++) {
+        uint32_t slot = hash_fnv1a(names[i]) & index->mask;
+        while (index->slots[slot] != 0) slot = (slot + 1) & index->mask;
+        index->slots[slot] = i + 1;
+    }
+    return true;
+}
+
+// Helper: Index of name in the indexed names, -1 if absent
+static int name_index_find(const NameIndex *index, const char *const *names, const char *name)
+{
+    uint32_t slot = hash_fnv1a(name) & index->mask;
+    while (index->slots[slot] != 0) {
+        int i = index->slots[slot] - 1;
+        if (strcmp(names[i], name) == 0) return i;
+        slot = (slot + 1) & index->mask;
+    }
+    return -1;
+}
+
+// Helper: Names of a listing's entries; NULL if out of memory
+static const char **listing_names(const DirectoryState *dir)
+{
+    const char **names = malloc((dir->count > 0 ? dir->count : 1) * sizeof(char *));
+    if (!names) return NULL;
+    for (int i = 0; i < dir->count; i++) {
+        names[i] = directory_entry_name(dir, &dir->entries[i]);
+    }
+    return names;
+}
+
+void dir_compare_listings(const DirectoryState *left, const DirectoryState *right, bool content,
+                          CompareResult *left_out, CompareResult *right_out, int *left_match)
+{
+    for (int i = 0; i < left->count; i++) {
+        left_out[i] = COMPARE_LEFT_ONLY;
+        left_match[i] = -1;
+    }
+    for (int j = 0; j < right->count; j++) {
+        right_out[j] = COMPARE_RIGHT_ONLY;
+    }
+    if (left->count == 0 || right->count == 0) return;
+
+    const char **left_names = listing_names(left);
+    const char **right_names = listing_names(right);
+    NameIndex index = { 0 };
+    if (!left_names || !right_names || !name_index_build(&index, right_names, right->count)) {
+        free(left_names);
+        free(right_names);
+        return;
+    }
+
+    for (int i = 0; i < left->count; i++) {
+        int j = name_index_find(&index, right_names, left_names[i]);
+        if (j < 0) continue;
+
+        const FileEntry *l = &left->entries[i];
+        const FileEntry *r = &right->entries[j];
+        CompareResult result;
+        if (l->is_directory != r->is_directory || l->is_symlink != r->is_symlink) {
+            result = COMPARE_DIFFERENT;
+        } else if (l->is_directory) {
+            result = COMPARE_DIR;
+        } else if (l->size != r->size) {
+            result = COMPARE_DIFFERENT;
+        } else if (content) {
+            result = l->size > 0 ? COMPARE_DIR : COMPARE_SAME;
+        } else {
+            result = l->modified == r->modified ? COMPARE_SAME : COMPARE_DIFFERENT;
+        }
+
+        left_out[i] = result;
+        right_out[j] = result;
+        left_match[i] = j;
+    }
+
+    free(index.slots);
+    free(left_names);
+    free(right_names);
+}
+
+// Helper: Whether the request of generation has been replaced or the comparer is stopping
+static bool is_cancelled(DirCompare *cmp, uint32_t generation)
+{
+    pthread_mutex_lock(&cmp->mutex);
+    bool cancelled = cmp->stopping || cmp->requested != generation;
+    pthread_mutex_unlock(&cmp->mutex);
+    return cancelled;
+}
+
+// Helper: Hand a decided entry to the main thread, unless its request was replaced
+static void publish(DirCompare *cmp, uint32_t generation, const ComparePair *pair, CompareResult result)
+{
+    pthread_mutex_lock(&cmp->mutex);
+    if (cmp->requested == generation) {
+        if (cmp->update_count == cmp->update_capacity) {
+            int capacity = cmp->update_capacity ? cmp->update_capacity * 2 : 64;
+            CompareUpdate *updates = realloc(cmp->updates, capacity * sizeof(CompareUpdate));
+            if (!updates) {
+                pthread_mutex_unlock(&cmp->mutex);
+                return;
+            }
+            cmp->updates = updates;
+            cmp->update_capacity = capacity;
+        }
+        cmp->updates[cmp->update_count++] = (CompareUpdate){
+            .left_index = pair->left_index,
+            .right_index = pair->right_index,
+            .result = result
+        };
+    }
+    pthread_mutex_unlock(&cmp->mutex);
+}
+
+// Helper: Join a directory and a name into a new string
+static char *join_path(const char *dir, const char *name)
+{
+    size_t length = strlen(dir) + strlen(name) + 2;
+    char *path = malloc(length);
+    if (path) snprintf(path, length, "%s/%s", dir, name);
+    return path;
+}
+
+static bool file_pairs_add(FilePairList *list, char *left_path, char *right_path, uint64_t size)
+{
+    if (!left_path || !right_path) {
+        free(left_path);
+        free(right_path);
+        return false;
+    }
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 64;
+        FilePair *items = realloc(list->items, capacity * sizeof(FilePair));
+        if (!items) {
+            free(left_path);
+            free(right_path);
+            return false;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = (FilePair){ left_path, right_path, size, false };
+    return true;
+}
+
+static void file_pairs_free(FilePairList *list)
+{
+    for (int i = 0; i < list->count; i++) {
+        free(list->items[i].left_path);
+        free(list->items[i].right_path);
+    }
+    free(list->items);
+    list->items = NULL;
+    list->count = list->capacity = 0;
+}
+
+// Helper: Hash both sides of count pairs on the hasher pool and set their same flags;
+// false if any differ
+static bool hash_file_pairs(FilePair *pairs, int count)
+{
+    FileHashJob *jobs = calloc(count * 2, sizeof(FileHashJob));
+    if (!jobs) return false;
+
+    for (int i = 0; i < count; i++) {
+        jobs[i * 2] = (FileHashJob){ .path = pairs[i].left_path, .size = pairs[i].size };
+        jobs[i * 2 + 1] = (FileHashJob){ .path = pairs[i].right_path, .size = pairs[i].size };
+    }
+    file_hash_batch(jobs, count * 2);
+
+    bool all_same = true;
+    for (int i = 0; i < count; i++) {
+        const FileHashJob *l = &jobs[i * 2];
+        const FileHashJob *r = &jobs[i * 2 + 1];
+        pairs[i].same = l->ok && r->ok && l->hash == r->hash;
+        if (!pairs[i].same) all_same = false;
+    }
+    free(jobs);
+    return all_same;
+}
+
+static void tree_listing_free(TreeListing *listing)
+{
+    for (int i = 0; i < listing->count; i++) {
+        free(listing->entries[i].name);
+    }
+    free(listing->entries);
+    free(listing->names);
+    memset(listing, 0, sizeof(*listing));
+}
+
+// Helper: Read a directory's entries without following symlinks; false if unreadable
+static bool tree_listing_read(const char *path, TreeListing *listing)
+{
+    memset(listing, 0, sizeof(*listing));
+    DIR *dir = opendir(path);
+    if (!dir) return false;
+
+    int fd = dirfd(dir);
+    bool ok = true;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        const char *name = ent->d_name;
+        // Finder metadata differs between copies of the same tree
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0 || strcmp(name, ".DS_Store") == 0) {
+            continue;
+        }
+
+        struct stat st;
+        if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+
+        if (listing->count == listing->capacity) {
+            int capacity = listing->capacity ? listing->capacity * 2 : 32;
+            TreeEntry *entries = realloc(listing->entries, capacity * sizeof(TreeEntry));
+            if (!entries) {
+                ok = false;
+                break;
+            }
+            listing->entries = entries;
+            listing->capacity = capacity;
+        }
+        TreeEntry *entry = &listing->entries[listing->count];
+        entry->name = strdup(name);
+        if (!entry->name) {
+            ok = false;
+            break;
+        }
+        entry->mode = st.st_mode;
+        entry->size = st.st_size;
+        entry->mtime = st.st_mtime;
+        listing->count++;
+    }
+    closedir(dir);
+
+    if (ok) {
+        listing->names = malloc((listing->count > 0 ? listing->count : 1) * sizeof(char *));
+        ok = listing->names != NULL;
+        for (int i = 0; ok && i < listing->count; i++) {
+            listing->names[i] = listing->entries[i].name;
+        }
+    }
+    if (!ok) tree_listing_free(listing);
+    return ok;
+}
+
+// Helper: Whether two symlinks point at the same target
+static bool same_link(const char *left_path, const char *right_path)
+{
+    char left_target[PATH_MAX];
+    char right_target[PATH_MAX];
+    ssize_t l = readlink(left_path, left_target, sizeof(left_target));
+    ssize_t r = readlink(right_path, right_target, sizeof(right_target));
+    return l >= 0 && l == r && memcmp(left_target, right_target, (size_t)l) == 0;
+}
+
+// Helper: Compare two trees by structure, sizes and (unless content) mtimes. Same-size
+// files are added to hash instead when content is set. COMPARE_DIR if cancelled
+static CompareResult compare_trees(DirCompare *cmp, uint32_t generation, const char *left_path,
+                                   const char *right_path, bool content, int depth,
+                                   FilePairList *hash)
+{
+    if (depth > DIR_COMPARE_MAX_DEPTH) return COMPARE_DIFFERENT;
+    if (is_cancelled(cmp, generation)) return COMPARE_DIR;
+
+    TreeListing left;
+    TreeListing right;
+    if (!tree_listing_read(left_path, &left)) return COMPARE_DIFFERENT;
+    if (!tree_listing_read(right_path, &right)) {
+        tree_listing_free(&left);
+        return COMPARE_DIFFERENT;
+    }
+
+    CompareResult result = COMPARE_SAME;
+    NameIndex index = { 0 };
+    if (left.count != right.count) {
+        result = COMPARE_DIFFERENT;
+    } else if (!name_index_build(&index, right.names, right.count)) {
+        result = COMPARE_DIFFERENT;
+    }
+
+    for (int i = 0; result == COMPARE_SAME && i < left.count; i++) {
+        const TreeEntry *l = &left.entries[i];
+        int j = name_index_find(&index, right.names, l->name);
+        if (j < 0) {
+            result = COMPARE_DIFFERENT;
+            break;
+        }
+        const TreeEntry *r = &right.entries[j];
+        if ((l->mode & S_IFMT) != (r->mode & S_IFMT)) {
+            result = COMPARE_DIFFERENT;
+            break;
+        }
+
+        char *l_path = join_path(left_path, l->name);
+        char *r_path = join_path(right_path, r->name);
+        if (!l_path || !r_path) {
+            result = COMPARE_DIFFERENT;
+        } else if (S_ISDIR(l->mode)) {
+            result = compare_trees(cmp, generation, l_path, r_path, content, depth + 1, hash);
+        } else if (S_ISLNK(l->mode)) {
+            if (!same_link(l_path, r_path)) result = COMPARE_DIFFERENT;
+        } else if (S_ISREG(l->mode)) {
+            if (l->size != r->size) {
+                result = COMPARE_DIFFERENT;
+            } else if (content && l->size > 0) {
+                if (!file_pairs_add(hash, l_path, r_path, (uint64_t)l->size)) {
+                    result = COMPARE_DIFFERENT;
+                }
+                l_path = r_path = NULL;     // Owned by hash
+            } else if (!content && l->mtime != r->mtime) {
+                result = COMPARE_DIFFERENT;
+            }
+        }
+        free(l_path);
+        free(r_path);
+    }
+
+    free(index.slots);
+    tree_listing_free(&left);
+    tree_listing_free(&right);
+    return result;
+}
+
+// Helper: Decide a directory pair: walk both trees, then hash the files collected,
+// stopping at the first difference
+static CompareResult compare_directory_pair(DirCompare *cmp, uint32_t generation,
+                                            const ComparePair *pair, bool content)
+{
+    FilePairList hash = { 0 };
+    CompareResult result = compare_trees(cmp, generation, pair->left_path, pair->right_path,
+                                         content, 0, &hash);
+
+    for (int start = 0; result == COMPARE_SAME && start < hash.count; start += DIR_COMPARE_HASH_BATCH) {
+        if (is_cancelled(cmp, generation)) {
+            result = COMPARE_DIR;
+            break;
+        }
+        int count = hash.count - start;
+        if (count > DIR_COMPARE_HASH_BATCH) count = DIR_COMPARE_HASH_BATCH;
+        if (!hash_file_pairs(hash.items + start, count)) result = COMPARE_DIFFERENT;
+    }
+
+    file_pairs_free(&hash);
+    return result;
+}
+
+// Helper: Decide the file pairs of a request by content, a batch at a time
+static void compare_file_pairs(DirCompare *cmp, uint32_t generation, const ComparePair *pairs, int count)
+{
+    FilePairList files = { 0 };
+    int *owners = malloc((count > 0 ? count : 1) * sizeof(int));
+    if (!owners) return;
+
+    for (int i = 0; i < count; i++) {
+        if (pairs[i].is_directory) continue;
+        owners[files.count] = i;
+        if (!file_pairs_add(&files, strdup(pairs[i].left_path), strdup(pairs[i].right_path), pairs[i].size)) {
+            publish(cmp, generation, &pairs[i], COMPARE_DIFFERENT);
+        }
+    }
+
+    for (int start = 0; start < files.count; start += DIR_COMPARE_HASH_BATCH) {
+        if (is_cancelled(cmp, generation)) break;
+        int batch = files.count - start;
+        if (batch > DIR_COMPARE_HASH_BATCH) batch = DIR_COMPARE_HASH_BATCH;
+        hash_file_pairs(files.items + start, batch);
+        for (int i = start; i < start + batch; i++) {
+            publish(cmp, generation, &pairs[owners[i]], files.items[i].same ? COMPARE_SAME : COMPARE_DIFFERENT);
+        }
+    }
+
+    file_pairs_free(&files);
+    free(owners);
+}
+
+static void compare_pairs_free(ComparePair *pairs, int count)
+{
+    for (int i = 0; i < count; i++) {
+        free(pairs[i].left_path);
+        free(pairs[i].right_path);
+    }
+    free(pairs);
+}
+
+// Thread function: Decide the entries of the latest request
+static void *dir_compare_thread(void *arg)
+{
+    DirCompare *cmp = arg;
+
+    pthread_mutex_lock(&cmp->mutex);
+    while (!cmp->stopping) {
+        if (cmp->started == cmp->requested) {
+            pthread_cond_wait(&cmp->cond, &cmp->mutex);
+            continue;
+        }
+        uint32_t generation = cmp->requested;
+        cmp->started = generation;
+        ComparePair *pairs = cmp->pairs;
+        int count = cmp->pair_count;
+        bool content = cmp->content;
+        cmp->pairs = NULL;
+        cmp->pair_count = 0;
+        pthread_mutex_unlock(&cmp->mutex);
+
+        // Files first: they are cheaper than whole trees
+        if (content) {
+            compare_file_pairs(cmp, generation, pairs, count);
+        }
+        for (int i = 0; i < count; i++) {
+            if (!pairs[i].is_directory) continue;
+            CompareResult result = compare_directory_pair(cmp, generation, &pairs[i], content);
+            if (result == COMPARE_DIR) break;
+            publish(cmp, generation, &pairs[i], result);
+        }
+        compare_pairs_free(pairs, count);
+
+        pthread_mutex_lock(&cmp->mutex);
+        cmp->finished = generation;
+    }
+    pthread_mutex_unlock(&cmp->mutex);
+    return NULL;
+}
+
+DirCompare *dir_compare_create(void)
+{
+    DirCompare *cmp = calloc(1, sizeof(DirCompare));
+    if (!cmp) return NULL;
+
+    pthread_mutex_init(&cmp->mutex, NULL);
+    pthread_cond_init(&cmp->cond, NULL);
+    if (pthread_create(&cmp->thread, NULL, dir_compare_thread, cmp) != 0) {
+        pthread_cond_destroy(&cmp->cond);
+        pthread_mutex_destroy(&cmp->mutex);
+        free(cmp);
+        return NULL;
+    }
+    return cmp;
+}
+
+void dir_compare_destroy(DirCompare *cmp)
+{
+    if (!cmp) return;
+
+    pthread_mutex_lock(&cmp->mutex);
+    cmp->stopping = true;
+    pthread_cond_signal(&cmp->cond);
+    pthread_mutex_unlock(&cmp->mutex);
+    pthread_join(cmp->thread, NULL);
+
+    compare_pairs_free(cmp->pairs, cmp->pair_count);
+    free(cmp->updates);
+    pthread_cond_destroy(&cmp->cond);
+    pthread_mutex_destroy(&cmp->mutex);
+    free(cmp);
+}
+
+// Helper: Replace the request with pairs (NULL to cancel) and wake the thread
+static void submit(DirCompare *cmp, ComparePair *pairs, int count, bool content,
+                   int left_count, int right_count)
+{
+    pthread_mutex_lock(&cmp->mutex);
+    compare_pairs_free(cmp->pairs, cmp->pair_count);
+    cmp->requested++;
+    cmp->pairs = pairs;
+    cmp->pair_count = count;
+    cmp->content = content;
+    cmp->left_count = left_count;
+    cmp->right_count = right_count;
+    cmp->update_count = 0;
+    pthread_cond_signal(&cmp->cond);
+    pthread_mutex_unlock(&cmp->mutex);
+}
+
+void dir_compare_request(DirCompare *cmp, const DirectoryState *left, const DirectoryState *right,
+                         const CompareResult *left_results, const int *left_match, bool content)
+{
+    if (!cmp) return;
+
+    int count = 0;
+    for (int i = 0; i < left->count; i++) {
+        if (left_results[i] == COMPARE_DIR) count++;
+    }
+    ComparePair *pairs = calloc(count > 0 ? count : 1, sizeof(ComparePair));
+    if (!pairs) {
+        submit(cmp, NULL, 0, content, left->count, right->count);
+        return;
+    }
+
+    int n = 0;
+    char path[PATH_MAX_LEN];
+    for (int i = 0; i < left->count; i++) {
+        if (left_results[i] != COMPARE_DIR) continue;
+        const FileEntry *entry = &left->entries[i];
+        ComparePair *pair = &pairs[n++];
+        pair->left_index = i;
+        pair->right_index = left_match[i];
+        pair->is_directory = entry->is_directory;
+        pair->size = (uint64_t)entry->size;
+        directory_entry_path(left, entry, path, sizeof(path));
+        pair->left_path = strdup(path);
+        directory_entry_path(right, &right->entries[left_match[i]], path, sizeof(path));
+        pair->right_path = strdup(path);
+        if (!pair->left_path || !pair->right_path) {
+            compare_pairs_free(pairs, n);
+            submit(cmp, NULL, 0, content, left->count, right->count);
+            return;
+        }
+    }
+    submit(cmp, pairs, n, content, left->count, right->count);
+}
+
+void dir_compare_cancel(DirCompare *cmp)
+{
+    if (!cmp) return;
+    submit(cmp, NULL, 0, false, 0, 0);
+}
+
+bool dir_compare_poll(DirCompare *cmp, CompareResult *left_out, int left_count,
+                      CompareResult *right_out, int right_count)
+{
+    if (!cmp) return false;
+
+    pthread_mutex_lock(&cmp->mutex);
+    bool changed = cmp->update_count > 0;
+    // Results for listings of another size belong to a request the arrays no longer match
+    if (changed && cmp->left_count == left_count && cmp->right_count == right_count) {
+        for (int i = 0; i < cmp->update_count; i++) {
+            const CompareUpdate *update = &cmp->updates[i];
+            left_out[update->left_index] = update->result;
+            right_out[update->right_index] = update->result;
+        }
+    }
+    cmp->update_count = 0;
+    pthread_mutex_unlock(&cmp->mutex);
+    return changed;
+}
+
+bool dir_compare_is_busy(DirCompare *cmp)
+{
+    if (!cmp) return false;
+
+    pthread_mutex_lock(&cmp->mutex);
+    bool busy = cmp->finished != cmp->requested;
+    pthread_mutex_unlock(&cmp->mutex);
+    return busy;
+}
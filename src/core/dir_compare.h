@@ -0,0 +1,57 @@
+#ifndef DIR_COMPARE_H
+#define DIR_COMPARE_H
+
+#include <stdbool.h>
+#include "filesystem.h"
+
+// Directory comparison for the dual pane view. The two listings are matched by name
+// through a hash join and files compared by the size and modification time already in
+// their entries, so the first pass never touches the disk. Directories present on both
+// sides are then compared recursively on a background thread, and a content mode checks
+// same-size files by hashing them on the shared hasher pool instead of trusting mtimes
+
+// Comparison result for a single entry
+typedef enum {
+    COMPARE_SAME,                 // Exists in both with the same content
+    COMPARE_DIFFERENT,            // Exists in both but different
+    COMPARE_LEFT_ONLY,            // Only exists in the left pane
+    COMPARE_RIGHT_ONLY,           // Only exists in the right pane
+    COMPARE_DIR                   // In both, still being compared
+} CompareResult;
+
+#define DIR_COMPARE_MAX_DEPTH 64        // Deeper trees are reported different
+#define DIR_COMPARE_HASH_BATCH 256      // File pairs hashed per file_hash_batch call
+
+// Background comparer (opaque)
+typedef struct DirCompare DirCompare;
+
+// Create a comparer and start its thread; NULL on failure
+DirCompare *dir_compare_create(void);
+
+// Stop a comparison in progress, stop the thread and free the comparer
+void dir_compare_destroy(DirCompare *cmp);
+
+// Match the entries of two listings by name and fill left_out/right_out (one result per
+// entry). left_match receives, for each left entry, the index of the right entry with the
+// same name or -1. Entries in both are COMPARE_DIR when dir_compare_request still has to
+// decide them: directories, and same-size files when content is set
+void dir_compare_listings(const DirectoryState *left, const DirectoryState *right, bool content,
+                          CompareResult *left_out, CompareResult *right_out, int *left_match);
+
+// Decide the COMPARE_DIR entries left by dir_compare_listings in the background,
+// replacing any comparison in progress
+void dir_compare_request(DirCompare *cmp, const DirectoryState *left, const DirectoryState *right,
+                         const CompareResult *left_results, const int *left_match, bool content);
+
+// Stop the comparison in progress; its results are dropped
+void dir_compare_cancel(DirCompare *cmp);
+
+// Apply the results decided since the last poll to the arrays of the latest request.
+// True if any changed
+bool dir_compare_poll(DirCompare *cmp, CompareResult *left_out, int left_count,
+                      CompareResult *right_out, int right_count);
+
+// Whether the latest request still has entries to decide
+bool dir_compare_is_busy(DirCompare *cmp);
+
+#endif // DIR_COMPARE_H
@@ -0,0 +1,634 @@
+#include "dir_size.h"
+#include "fs_watch.h"
+#include "../utils/perf.h"
+#include "../utils/hash.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <errno.h>
+#include <sys/attr.h>
+#include <sys/vnode.h>
+#endif
+
+#ifdef __APPLE__
+#define SIZE_BULK_BUFFER (64 * 1024)
+
+// Attributes fetched per entry by getattrlistbulk (order matters, see enumerate_bulk)
+#define SIZE_BULK_COMMON_ATTRS (ATTR_CMN_RETURNED_ATTRS | ATTR_CMN_NAME | ATTR_CMN_ERROR | \
+                                ATTR_CMN_OBJTYPE | ATTR_CMN_MODTIME | ATTR_CMN_FILEID)
+#define SIZE_BULK_FILE_ATTRS   (ATTR_FILE_DATALENGTH)
+#endif
+
+// Cached rollup of one directory
+typedef struct SizeNode {
+    struct SizeNode *next;              // Hash chain
+    uint32_t hash;
+    ino_t ino;                          // Identity the total was counted for
+    time_t mtime;
+    off_t total;
+    bool has_total;                     // total holds a count, perhaps an old one
+    bool valid;                         // total is current
+    bool computing;                     // A thread is counting it
+    bool stale;                         // Changed while being counted
+    char path[];
+} SizeNode;
+
+// A subdirectory found while reading its parent
+typedef struct SubDir {
+    char *name;
+    ino_t ino;
+    time_t mtime;
+} SubDir;
+
+typedef struct SubDirList {
+    SubDir *items;
+    int count;
+    int capacity;
+} SubDirList;
+
+struct DirSizes {
+    pthread_mutex_t mutex;
+    pthread_cond_t work;                // Request queued, or stopping
+    pthread_cond_t counted;             // A directory finished counting
+    pthread_t threads[DIR_SIZE_THREADS];
+    int thread_count;
+    atomic_bool stopping;               // Read by walkers without the lock
+    atomic_uint_fast64_t generation;    // Rollups stored
+
+    // Guarded by mutex
+    SizeNode **buckets;
+    int bucket_count;
+    int node_count;
+    char *pending[DIR_SIZE_PENDING_MAX]; // Requests, newest last
+    int pending_count;
+    int active;                         // Requests being counted
+
+    struct FsWatch *watch;
+    int watch_id;
+};
+
+static off_t tree_size(DirSizes *sizes, const char *path, ino_t ino, time_t mtime,
+                       int depth, bool split);
+
+//=============================================================================
+// Cache (callers hold the mutex)
+//=============================================================================
+
+static SizeNode *node_find(DirSizes *sizes, const char *path, uint32_t hash)
+{
+    SizeNode *node = sizes->buckets[hash & (sizes->bucket_count - 1)];
+    while (node) {
+        if (node->hash == hash && strcmp(node->path, path) == 0) {
+            return node;
+        }
+        node = node->next;
+    }
+    return NULL;
+}
+
+// Helper: Drop every node nobody is counting; the cache refills as sizes are asked for
+static void cache_drop(DirSizes *sizes)
+{
+    for (int i = 0; i < sizes->bucket_count; i++) {
+        SizeNode **link = &sizes->buckets[i];
+        while (*link) {
+            SizeNode *node = *link;
+            if (node->computing) {
+                link = &node->next;
+                continue;
+            }
+            *link = node->next;
+            memory_free(MEMORY_TAG_CACHE, node);
+            sizes->node_count--;
+        }
+    }
+}
+
+// Helper: Double the bucket array once the chains average more than one node
+static void cache_grow(DirSizes *sizes)
+{
+    int count = sizes->bucket_count * 2;
+    SizeNode **buckets = memory_calloc(MEMORY_TAG_CACHE, count, sizeof(SizeNode *));
+    if (!buckets) return;
+
+    for (int i = 0; i < sizes->bucket_count; i++) {
+        SizeNode *node = sizes->buckets[i];
+        while (node) {
+            SizeNode *next = node->next;
+            uint32_t slot = node->hash & (count - 1);
+            node->next = buckets[slot];
+            buckets[slot] = node;
+            node = next;
+        }
+    }
+    memory_free(MEMORY_TAG_CACHE, sizes->buckets);
+    sizes->buckets = buckets;
+    sizes->bucket_count = count;
+}
+
+static SizeNode *node_insert(DirSizes *sizes, const char *path, uint32_t hash)
+{
+    if (sizes->node_count >= DIR_SIZE_CACHE_MAX) {
+        cache_drop(sizes);
+    }
+    if (sizes->node_count >= sizes->bucket_count) {
+        cache_grow(sizes);
+    }
+
+    size_t len = strlen(path);
+    SizeNode *node = memory_calloc(MEMORY_TAG_CACHE, 1, sizeof(SizeNode) + len + 1);
+    if (!node) return NULL;
+    memcpy(node->path, path, len + 1);
+    node->hash = hash;
+
+    uint32_t slot = hash & (sizes->bucket_count - 1);
+    node->next = sizes->buckets[slot];
+    sizes->buckets[slot] = node;
+    sizes->node_count++;
+    return node;
+}
+
+// Helper: Mark one cached directory for a recount
+static void node_invalidate(SizeNode *node)
+{
+    node->valid = false;
+    if (node->computing) {
+        node->stale = true;
+    }
+}
+
+//=============================================================================
+// Counting
+//=============================================================================
+
+static bool subdirs_add(SubDirList *list, const char *name, ino_t ino, time_t mtime)
+{
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 16;
+        SubDir *items = realloc(list->items, capacity * sizeof(SubDir));
+        if (!items) return false;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    char *copy = strdup(name);
+    if (!copy) return false;
+    list->items[list->count++] = (SubDir){ copy, ino, mtime };
+    return true;
+}
+
+static void subdirs_free(SubDirList *list)
+{
+    for (int i = 0; i < list->count; i++) {
+        free(list->items[i].name);
+    }
+    free(list->items);
+}
+
+#ifdef __APPLE__
+// Helper: Read a directory with getattrlistbulk: one call returns the name, type, identity
+// and size of many entries at once. False if the volume does not support it
+static bool enumerate_bulk(const char *path, off_t *bytes, SubDirList *subdirs)
+{
+    int fd = open(path, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return true;  // Unreadable: counts as empty
+    char *buf = malloc(SIZE_BULK_BUFFER);
+    if (!buf) {
+        close(fd);
+        return false;
+    }
+
+    struct attrlist attrs;
+    memset(&attrs, 0, sizeof(attrs));
+    attrs.bitmapcount = ATTR_BIT_MAP_COUNT;
+    attrs.commonattr = SIZE_BULK_COMMON_ATTRS;
+    attrs.fileattr = SIZE_BULK_FILE_ATTRS;
+
+    bool supported = true;
+    bool first = true;
+    int n;
+    while ((n = getattrlistbulk(fd, &attrs, buf, SIZE_BULK_BUFFER, 0)) > 0) {
+        first = false;
+        const char *record = buf;
+        for (int i = 0; i < n; i++) {
+            uint32_t record_len;
+            memcpy(&record_len, record, sizeof(record_len));
+
+            // Layout: length, returned attribute set, then each returned attribute in
+            // bitmap order (error, name, objtype, modtime, fileid, datalength)
+            const char *field = record + sizeof(uint32_t);
+            attribute_set_t returned;
+            memcpy(&returned, field, sizeof(returned));
+            field += sizeof(attribute_set_t);
+            record += record_len;
+
+            if (returned.commonattr & ATTR_CMN_ERROR) {
+                uint32_t error;
+                memcpy(&error, field, sizeof(error));
+                field += sizeof(uint32_t);
+                if (error != 0) continue;
+            }
+            if (!(returned.commonattr & ATTR_CMN_NAME)) continue;
+            attrreference_t name_ref;
+            memcpy(&name_ref, field, sizeof(name_ref));
+            const char *name = field + name_ref.attr_dataoffset;
+            field += sizeof(attrreference_t);
+
+            fsobj_type_t obj_type = VNON;
+            if (returned.commonattr & ATTR_CMN_OBJTYPE) {
+                memcpy(&obj_type, field, sizeof(obj_type));
+                field += sizeof(fsobj_type_t);
+            }
+            struct timespec modtime = {0, 0};
+            if (returned.commonattr & ATTR_CMN_MODTIME) {
+                memcpy(&modtime, field, sizeof(modtime));
+                field += sizeof(struct timespec);
+            }
+            uint64_t fileid = 0;
+            if (returned.commonattr & ATTR_CMN_FILEID) {
+                memcpy(&fileid, field, sizeof(fileid));
+                field += sizeof(uint64_t);
+            }
+
+            if (obj_type == VDIR) {
+                if (!subdirs_add(subdirs, name, (ino_t)fileid, modtime.tv_sec)) break;
+            } else if (returned.fileattr & ATTR_FILE_DATALENGTH) {
+                off_t size;
+                memcpy(&size, field, sizeof(size));
+                *bytes += size;
+            }
+        }
+    }
+    if (n < 0 && first && (errno == ENOTSUP || errno == EINVAL)) {
+        supported = false;
+    }
+
+    free(buf);
+    close(fd);
+    return supported;
+}
+#endif
+
+// Helper: Add up the files directly in path and list its subdirectories. Symlinks count
+// as themselves and are never followed
+static off_t enumerate(const char *path, SubDirList *subdirs)
+{
+    off_t bytes = 0;
+#ifdef __APPLE__
+    if (enumerate_bulk(path, &bytes, subdirs)) {
+        return bytes;
+    }
+#endif
+
+    DIR *dir = opendir(path);
+    if (!dir) return 0;
+    int fd = dirfd(dir);
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        const char *name = ent->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+
+        struct stat st;
+        if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            if (!subdirs_add(subdirs, name, st.st_ino, st.st_mtime)) break;
+        } else {
+            bytes += st.st_size;
+        }
+    }
+    closedir(dir);
+    return bytes;
+}
+
+// Helper: Queue a request, dropping the oldest when full. Caller holds the mutex
+static void request_locked(DirSizes *sizes, const char *path)
+{
+    for (int i = 0; i < sizes->pending_count; i++) {
+        if (strcmp(sizes->pending[i], path) == 0) return;
+    }
+    char *copy = strdup(path);
+    if (!copy) return;
+
+    if (sizes->pending_count == DIR_SIZE_PENDING_MAX) {
+        free(sizes->pending[0]);
+        memmove(sizes->pending, sizes->pending + 1, (DIR_SIZE_PENDING_MAX - 1) * sizeof(char *));
+        sizes->pending_count--;
+    }
+    sizes->pending[sizes->pending_count++] = copy;
+    pthread_cond_signal(&sizes->work);
+}
+
+// Helper: Sum the files in path and every subdirectory's rollup. With split, the
+// subdirectories are also queued so idle workers count some of them meanwhile
+static off_t walk(DirSizes *sizes, const char *path, int depth, bool split)
+{
+    SubDirList subdirs = {0};
+    off_t total = enumerate(path, &subdirs);
+
+    if (split && subdirs.count > 1) {
+        pthread_mutex_lock(&sizes->mutex);
+        // Last first, so the workers start from the far end of the list
+        for (int i = 0; i < subdirs.count; i++) {
+            char child[PATH_MAX];
+            snprintf(child, sizeof(child), "%s/%s", strcmp(path, "/") == 0 ? "" : path,
+                     subdirs.items[i].name);
+            request_locked(sizes, child);
+        }
+        pthread_mutex_unlock(&sizes->mutex);
+    }
+
+    for (int i = 0; i < subdirs.count && !atomic_load(&sizes->stopping); i++) {
+        char child[PATH_MAX];
+        snprintf(child, sizeof(child), "%s/%s", strcmp(path, "/") == 0 ? "" : path,
+                 subdirs.items[i].name);
+        total += tree_size(sizes, child, subdirs.items[i].ino, subdirs.items[i].mtime,
+                           depth + 1, false);
+    }
+    subdirs_free(&subdirs);
+    return total;
+}
+
+// Helper: Rollup of the directory at path (identified by ino and mtime): the cached total
+// if still current, else counted here. A directory another thread is counting is waited for
+static off_t tree_size(DirSizes *sizes, const char *path, ino_t ino, time_t mtime,
+                       int depth, bool split)
+{
+    if (depth > DIR_SIZE_MAX_DEPTH) return 0;
+    uint32_t hash = hash_fnv1a(path);
+
+    pthread_mutex_lock(&sizes->mutex);
+    SizeNode *node = node_find(sizes, path, hash);
+    while (node && node->computing && !atomic_load(&sizes->stopping)) {
+        pthread_cond_wait(&sizes->counted, &sizes->mutex);
+        node = node_find(sizes, path, hash);  // The cache may have started over
+    }
+    if (atomic_load(&sizes->stopping)) {
+        pthread_mutex_unlock(&sizes->mutex);
+        return 0;
+    }
+    if (node && node->valid && node->ino == ino && node->mtime == mtime) {
+        off_t total = node->total;
+        pthread_mutex_unlock(&sizes->mutex);
+        return total;
+    }
+    if (!node) {
+        node = node_insert(sizes, path, hash);
+    }
+    if (node) {
+        node->computing = true;
+        node->stale = false;
+    }
+    pthread_mutex_unlock(&sizes->mutex);
+
+    off_t total = walk(sizes, path, depth, split);
+
+    pthread_mutex_lock(&sizes->mutex);
+    if (node) {
+        // A count cut short by shutdown is never stored as current
+        bool complete = !atomic_load(&sizes->stopping);
+        if (complete || !node->has_total) {
+            node->total = total;
+            node->has_total = true;
+        }
+        node->ino = ino;
+        node->mtime = mtime;
+        node->valid = complete && !node->stale;
+        node->computing = false;
+        atomic_fetch_add(&sizes->generation, 1);
+        pthread_cond_broadcast(&sizes->counted);
+    }
+    pthread_mutex_unlock(&sizes->mutex);
+    return total;
+}
+
+// Thread function: Count queued directories, newest request first
+static void *dir_sizes_thread(void *arg)
+{
+    DirSizes *sizes = arg;
+
+    pthread_mutex_lock(&sizes->mutex);
+    while (!atomic_load(&sizes->stopping)) {
+        if (sizes->pending_count == 0) {
+            pthread_cond_wait(&sizes->work, &sizes->mutex);
+            continue;
+        }
+        char *path = sizes->pending[--sizes->pending_count];
+        sizes->active++;
+        pthread_mutex_unlock(&sizes->mutex);
+
+        struct stat st;
+        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+            tree_size(sizes, path, st.st_ino, st.st_mtime, 0, true);
+        }
+        free(path);
+
+        pthread_mutex_lock(&sizes->mutex);
+        sizes->active--;
+    }
+    pthread_mutex_unlock(&sizes->mutex);
+    return NULL;
+}
+
+//=============================================================================
+// Public API
+//=============================================================================
+
+DirSizes *dir_sizes_create(void)
+{
+    DirSizes *sizes = calloc(1, sizeof(DirSizes));
+    if (!sizes) return NULL;
+
+    sizes->bucket_count = 1024;
+    sizes->buckets = memory_calloc(MEMORY_TAG_CACHE, sizes->bucket_count, sizeof(SizeNode *));
+    if (!sizes->buckets) {
+        free(sizes);
+        return NULL;
+    }
+    pthread_mutex_init(&sizes->mutex, NULL);
+    pthread_cond_init(&sizes->work, NULL);
+    pthread_cond_init(&sizes->counted, NULL);
+    atomic_init(&sizes->stopping, false);
+    atomic_init(&sizes->generation, 0);
+
+    for (int i = 0; i < DIR_SIZE_THREADS; i++) {
+        if (pthread_create(&sizes->threads[i], NULL, dir_sizes_thread, sizes) != 0) break;
+        sizes->thread_count++;
+    }
+    if (sizes->thread_count == 0) {
+        dir_sizes_destroy(sizes);
+        return NULL;
+    }
+    return sizes;
+}
+
+void dir_sizes_destroy(DirSizes *sizes)
+{
+    if (!sizes) return;
+
+    if (sizes->watch_id > 0) {
+        fs_watch_unsubscribe(sizes->watch, sizes->watch_id);
+    }
+
+    pthread_mutex_lock(&sizes->mutex);
+    atomic_store(&sizes->stopping, true);
+    pthread_cond_broadcast(&sizes->work);
+    pthread_cond_broadcast(&sizes->counted);
+    pthread_mutex_unlock(&sizes->mutex);
+    for (int i = 0; i < sizes->thread_count; i++) {
+        pthread_join(sizes->threads[i], NULL);
+    }
+
+    for (int i = 0; i < sizes->bucket_count; i++) {
+        SizeNode *node = sizes->buckets[i];
+        while (node) {
+            SizeNode *next = node->next;
+            memory_free(MEMORY_TAG_CACHE, node);
+            node = next;
+        }
+    }
+    for (int i = 0; i < sizes->pending_count; i++) {
+        free(sizes->pending[i]);
+    }
+    memory_free(MEMORY_TAG_CACHE, sizes->buckets);
+    pthread_cond_destroy(&sizes->counted);
+    pthread_cond_destroy(&sizes->work);
+    pthread_mutex_destroy(&sizes->mutex);
+    free(sizes);
+}
+
+// Helper: Mark every cached directory for a recount
+static void invalidate_all(DirSizes *sizes)
+{
+    pthread_mutex_lock(&sizes->mutex);
+    for (int i = 0; i < sizes->bucket_count; i++) {
+        for (SizeNode *node = sizes->buckets[i]; node; node = node->next) {
+            node_invalidate(node);
+        }
+    }
+    pthread_mutex_unlock(&sizes->mutex);
+}
+
+static void dir_sizes_watch_batch(const FsWatchBatch *batch, void *user_data)
+{
+    DirSizes *sizes = user_data;
+
+    if (batch->dirs_overflow) {
+        invalidate_all(sizes);
+        return;
+    }
+    // Every change lists its parent directory, which is all a rollup depends on
+    for (int i = 0; i < batch->dir_count; i++) {
+        dir_sizes_invalidate(sizes, batch->dirs[i]);
+    }
+}
+
+bool dir_sizes_watch(DirSizes *sizes, struct FsWatch *watch)
+{
+    if (!sizes || !watch) return false;
+    if (sizes->watch_id > 0) return true;
+
+    sizes->watch_id = fs_watch_subscribe(watch, "/", true, dir_sizes_watch_batch, sizes);
+    if (sizes->watch_id < 0) {
+        sizes->watch_id = 0;
+        return false;
+    }
+    sizes->watch = watch;
+    return true;
+}
+
+bool dir_sizes_query(DirSizes *sizes, const char *path, off_t *size)
+{
+    if (!sizes || !path) return false;
+
+    bool known = false;
+    pthread_mutex_lock(&sizes->mutex);
+    SizeNode *node = node_find(sizes, path, hash_fnv1a(path));
+    if (node && node->has_total) {
+        *size = node->total;
+        known = true;
+    }
+    if (!node || (!node->valid && !node->computing)) {
+        request_locked(sizes, path);
+    }
+    pthread_mutex_unlock(&sizes->mutex);
+    return known;
+}
+
+bool dir_sizes_peek(DirSizes *sizes, const char *path, off_t *size)
+{
+    if (!sizes || !path) return false;
+
+    bool known = false;
+    pthread_mutex_lock(&sizes->mutex);
+    SizeNode *node = node_find(sizes, path, hash_fnv1a(path));
+    if (node && node->has_total) {
+        *size = node->total;
+        known = true;
+    }
+    pthread_mutex_unlock(&sizes->mutex);
+    return known;
+}
+
+off_t dir_sizes_compute(DirSizes *sizes, const char *path)
+{
+    if (!sizes || !path) return 0;
+
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) return 0;
+    return tree_size(sizes, path, st.st_ino, st.st_mtime, 0, true);
+}
+
+void dir_sizes_invalidate(DirSizes *sizes, const char *path)
+{
+    if (!sizes || !path) return;
+
+    char dir[PATH_MAX];
+    strncpy(dir, path, sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = '\0';
+    size_t len = strlen(dir);
+    while (len > 1 && dir[len - 1] == '/') {
+        dir[--len] = '\0';
+    }
+
+    pthread_mutex_lock(&sizes->mutex);
+    for (;;) {
+        SizeNode *node = node_find(sizes, dir, hash_fnv1a(dir));
+        if (node) {
+            node_invalidate(node);
+        }
+
+        char *slash = strrchr(dir, '/');
+        if (!slash || strcmp(dir, "/") == 0) break;
+        if (slash == dir) {
+            dir[1] = '\0';  // Parent is the root
+        } else {
+            *slash = '\0';
+        }
+    }
+    pthread_mutex_unlock(&sizes->mutex);
+}
+
+uint64_t dir_sizes_generation(DirSizes *sizes)
+{
+    return sizes ? atomic_load(&sizes->generation) : 0;
+}
+
+bool dir_sizes_is_busy(DirSizes *sizes)
+{
+    if (!sizes) return false;
+
+    pthread_mutex_lock(&sizes->mutex);
+    bool busy = sizes->pending_count > 0 || sizes->active > 0;
+    pthread_mutex_unlock(&sizes->mutex);
+    return busy;
+}
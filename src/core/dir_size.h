@@ -0,0 +1,55 @@
+#ifndef DIR_SIZE_H
+#define DIR_SIZE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+struct FsWatch;
+
+// Folder sizes: the bytes of every file below a directory, summed by worker threads that
+// read each directory with one bulk attribute enumeration (getattrlistbulk on macOS) and
+// split a tree's subfolders between them. Every directory's rollup is cached by path and
+// checked against its inode and modification time; file change events mark a changed
+// directory and its ancestors stale, so a recount re-reads only that chain and reuses
+// every other subtree. The list view shows the sizes and the operation queue takes its
+// copy totals from the cache
+
+#define DIR_SIZE_THREADS 4
+#define DIR_SIZE_CACHE_MAX 262144       // Directories cached before the cache starts over
+#define DIR_SIZE_PENDING_MAX 512        // Queued requests before the oldest are dropped
+#define DIR_SIZE_MAX_DEPTH 256          // Deeper directories are not counted
+
+// Size service (opaque)
+typedef struct DirSizes DirSizes;
+
+// Create the service and start its workers; NULL on failure
+DirSizes *dir_sizes_create(void);
+
+// Stop the workers (abandoning counts in progress) and free the service
+void dir_sizes_destroy(DirSizes *sizes);
+
+// Follow file changes on watch to keep cached sizes current
+bool dir_sizes_watch(DirSizes *sizes, struct FsWatch *watch);
+
+// Last counted size of the directory at path; false if it was never counted. A size that
+// is not known to be current is recounted in the background. Main thread, every frame
+bool dir_sizes_query(DirSizes *sizes, const char *path, off_t *size);
+
+// Last counted size of the directory at path, without asking for a count; false if none
+bool dir_sizes_peek(DirSizes *sizes, const char *path, off_t *size);
+
+// Size of the directory at path, counted now on the caller's thread (with the workers'
+// help) unless the cache already has it
+off_t dir_sizes_compute(DirSizes *sizes, const char *path);
+
+// Mark the directory at path, and every directory above it, for a recount
+void dir_sizes_invalidate(DirSizes *sizes, const char *path);
+
+// Count of rollups stored so far: a change means some size moved since it was last read
+uint64_t dir_sizes_generation(DirSizes *sizes);
+
+// Whether requested sizes are still being counted
+bool dir_sizes_is_busy(DirSizes *sizes);
+
+#endif // DIR_SIZE_H
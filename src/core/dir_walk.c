@@ -0,0 +1,287 @@
+#include "dir_walk.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// An idle thread looks for work again after this long even without a wakeup
+#define DIR_WALK_IDLE_NS 2000000
+
+// A folder waiting to be read
+typedef struct WalkDir {
+    char *path;
+    int depth;
+} WalkDir;
+
+// One thread's folders: the owner pushes and pops at the top (depth first), other
+// threads steal from the bottom, where the shallowest and so largest subtrees wait
+typedef struct WalkStack {
+    pthread_mutex_t mutex;
+    WalkDir *items;
+    int bottom;
+    int top;
+    int capacity;
+} WalkStack;
+
+typedef struct WalkWorker {
+    DirWalk *walk;
+    int index;
+} WalkWorker;
+
+struct DirWalk {
+    WalkStack stacks[DIR_WALK_MAX_THREADS];
+    int thread_count;
+    const atomic_bool *cancel;          // Set by the walk's owner
+    atomic_int pending;                 // Folders queued or being read
+    atomic_bool stop;
+
+    DirWalkVisit visit;
+    void *user_data;
+
+    pthread_mutex_t idle_mutex;
+    pthread_cond_t idle_cond;           // Work arrived, or the walk is over
+    atomic_int idle;
+};
+
+// Helper: Push a folder on a stack
+static bool stack_push(WalkStack *stack, char *path, int depth)
+{
+    pthread_mutex_lock(&stack->mutex);
+    if (stack->bottom == stack->top) {
+        stack->bottom = stack->top = 0;
+    }
+    if (stack->top == stack->capacity) {
+        int capacity = stack->capacity ? stack->capacity * 2 : 64;
+        WalkDir *items = realloc(stack->items, (size_t)capacity * sizeof(WalkDir));
+        if (!items) {
+            pthread_mutex_unlock(&stack->mutex);
+            return false;
+        }
+        stack->items = items;
+        stack->capacity = capacity;
+    }
+    stack->items[stack->top].path = path;
+    stack->items[stack->top].depth = depth;
+    stack->top++;
+    pthread_mutex_unlock(&stack->mutex);
+    return true;
+}
+
+// Helper: Take the newest folder (owner) or the oldest (thief)
+static bool stack_take(WalkStack *stack, bool steal, WalkDir *out)
+{
+    pthread_mutex_lock(&stack->mutex);
+    bool found = stack->bottom < stack->top;
+    if (found) {
+        *out = steal ? stack->items[stack->bottom++] : stack->items[--stack->top];
+    }
+    pthread_mutex_unlock(&stack->mutex);
+    return found;
+}
+
+// Helper: Drop the folders left on a stack
+static void stack_clear(WalkStack *stack)
+{
+    for (int i = stack->bottom; i < stack->top; i++) {
+        free(stack->items[i].path);
+    }
+    stack->bottom = stack->top = 0;
+}
+
+// Helper: Whether any stack holds work
+static bool walk_has_work(DirWalk *walk)
+{
+    for (int i = 0; i < walk->thread_count; i++) {
+        WalkStack *stack = &walk->stacks[i];
+        pthread_mutex_lock(&stack->mutex);
+        bool has = stack->bottom < stack->top;
+        pthread_mutex_unlock(&stack->mutex);
+        if (has) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Helper: Wake idle threads (new work, or the walk is over)
+static void walk_wake(DirWalk *walk)
+{
+    if (atomic_load(&walk->idle) > 0) {
+        pthread_mutex_lock(&walk->idle_mutex);
+        pthread_cond_broadcast(&walk->idle_cond);
+        pthread_mutex_unlock(&walk->idle_mutex);
+    }
+}
+
+// Thread function: Read folders from own stack, then steal, until none are left anywhere
+static void *walk_worker(void *arg)
+{
+    WalkWorker *worker = (WalkWorker *)arg;
+    DirWalk *walk = worker->walk;
+    WalkStack *own = &walk->stacks[worker->index];
+
+    while (!dir_walk_stopped(walk)) {
+        WalkDir dir;
+        bool found = stack_take(own, false, &dir);
+        for (int i = 1; !found && i < walk->thread_count; i++) {
+            found = stack_take(&walk->stacks[(worker->index + i) % walk->thread_count], true, &dir);
+        }
+
+        if (found) {
+            walk->visit(walk, worker->index, dir.path, dir.depth, walk->user_data);
+            free(dir.path);
+            if (atomic_fetch_sub(&walk->pending, 1) == 1) {
+                walk_wake(walk);
+            }
+            continue;
+        }
+
+        if (atomic_load(&walk->pending) == 0) {
+            break;
+        }
+
+        // Nothing to take yet: another thread is still reading a folder
+        pthread_mutex_lock(&walk->idle_mutex);
+        atomic_fetch_add(&walk->idle, 1);
+        if (!walk_has_work(walk) && atomic_load(&walk->pending) > 0 && !dir_walk_stopped(walk)) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += DIR_WALK_IDLE_NS;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&walk->idle_cond, &walk->idle_mutex, &deadline);
+        }
+        atomic_fetch_sub(&walk->idle, 1);
+        pthread_mutex_unlock(&walk->idle_mutex);
+    }
+    return NULL;
+}
+
+DirWalk *dir_walk_create(int max_threads, const atomic_bool *cancel)
+{
+    DirWalk *walk = calloc(1, sizeof(DirWalk));
+    if (!walk) {
+        return NULL;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cores > 0 ? (int)cores : 1;
+    if (threads > max_threads) {
+        threads = max_threads;
+    }
+    if (threads > DIR_WALK_MAX_THREADS) {
+        threads = DIR_WALK_MAX_THREADS;
+    }
+    walk->thread_count = threads > 0 ? threads : 1;
+    walk->cancel = cancel;
+    for (int i = 0; i < walk->thread_count; i++) {
+        pthread_mutex_init(&walk->stacks[i].mutex, NULL);
+    }
+    pthread_mutex_init(&walk->idle_mutex, NULL);
+    pthread_cond_init(&walk->idle_cond, NULL);
+    return walk;
+}
+
+void dir_walk_destroy(DirWalk *walk)
+{
+    if (!walk) {
+        return;
+    }
+    for (int i = 0; i < walk->thread_count; i++) {
+        stack_clear(&walk->stacks[i]);
+        free(walk->stacks[i].items);
+        pthread_mutex_destroy(&walk->stacks[i].mutex);
+    }
+    pthread_mutex_destroy(&walk->idle_mutex);
+    pthread_cond_destroy(&walk->idle_cond);
+    free(walk);
+}
+
+int dir_walk_thread_count(const DirWalk *walk)
+{
+    return walk ? walk->thread_count : 0;
+}
+
+bool dir_walk_run(DirWalk *walk, const char *root, DirWalkVisit visit, void *user_data)
+{
+    if (!walk || !root || !visit) {
+        return false;
+    }
+    char *first = strdup(root);
+    if (!first) {
+        return false;
+    }
+    walk->visit = visit;
+    walk->user_data = user_data;
+    atomic_store(&walk->pending, 1);
+    if (!stack_push(&walk->stacks[0], first, 0)) {
+        free(first);
+        atomic_store(&walk->pending, 0);
+        return false;
+    }
+
+    WalkWorker workers[DIR_WALK_MAX_THREADS];
+    pthread_t thread_ids[DIR_WALK_MAX_THREADS];
+    bool started[DIR_WALK_MAX_THREADS] = {false};
+    for (int i = 0; i < walk->thread_count; i++) {
+        workers[i].walk = walk;
+        workers[i].index = i;
+    }
+    for (int i = 1; i < walk->thread_count; i++) {
+        started[i] = pthread_create(&thread_ids[i], NULL, walk_worker, &workers[i]) == 0;
+    }
+    walk_worker(&workers[0]);
+    for (int i = 1; i < walk->thread_count; i++) {
+        if (started[i]) {
+            pthread_join(thread_ids[i], NULL);
+        }
+    }
+
+    // Folders left behind by an early stop
+    for (int i = 0; i < walk->thread_count; i++) {
+        stack_clear(&walk->stacks[i]);
+    }
+    return true;
+}
+
+bool dir_walk_push(DirWalk *walk, int worker, const char *path, int depth)
+{
+    char *copy = strdup(path);
+    atomic_fetch_add(&walk->pending, 1);
+    if (!copy || !stack_push(&walk->stacks[worker], copy, depth)) {
+        free(copy);
+        atomic_fetch_sub(&walk->pending, 1);
+        return false;
+    }
+    walk_wake(walk);
+    return true;
+}
+
+void dir_walk_stop(DirWalk *walk)
+{
+    atomic_store(&walk->stop, true);
+    walk_wake(walk);
+}
+
+bool dir_walk_stopped(const DirWalk *walk)
+{
+    return atomic_load(&walk->stop) || (walk->cancel && atomic_load(walk->cancel));
+}
+
+bool dir_walk_root(const char *root, char *out, size_t out_size)
+{
+    size_t len = strlen(root);
+    while (len > 1 && root[len - 1] == '/') {
+        len--;
+    }
+    if (len >= out_size) {
+        return false;
+    }
+    memcpy(out, root, len);
+    out[len] = '\0';
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef DIR_WALK_H
+#define DIR_WALK_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Parallel walk of a directory tree, shared by file_find and content_search. Each
+// thread reads folders from its own stack depth first, and a thread that runs out
+// takes the shallowest folder waiting on another's stack, so one deep subtree does not
+// leave the others idle. What a folder's entries mean is up to the visit callback,
+// which pushes the subfolders to enter
+
+// Most threads one walk runs (the caller is one of them)
+#define DIR_WALK_MAX_THREADS 8
+
+typedef struct DirWalk DirWalk;
+
+// Read one folder on thread worker (0 to the thread count), pushing subfolders with
+// dir_walk_push and checking dir_walk_stopped between entries
+typedef void (*DirWalkVisit)(DirWalk *walk, int worker, const char *path, int depth, void *user_data);
+
+// Create a walk on up to max_threads threads, no more than there are cores; set
+// cancel (may be NULL) to stop it from outside. NULL if out of memory
+DirWalk *dir_walk_create(int max_threads, const atomic_bool *cancel);
+void dir_walk_destroy(DirWalk *walk);
+
+// Threads the walk runs on, so the caller can set up per-thread state
+int dir_walk_thread_count(const DirWalk *walk);
+
+// Visit root (depth 0) and every folder pushed below it, returning once all are read
+// or the walk is stopped. False if out of memory
+bool dir_walk_run(DirWalk *walk, const char *root, DirWalkVisit visit, void *user_data);
+
+// Queue a folder (copied) on worker's own stack; false if out of memory
+bool dir_walk_push(DirWalk *walk, int worker, const char *path, int depth);
+
+// Stop the walk: folders still queued are dropped
+void dir_walk_stop(DirWalk *walk);
+bool dir_walk_stopped(const DirWalk *walk);
+
+// Copy root into out without trailing slashes, so paths come out as root/name; false
+// if it does not fit
+bool dir_walk_root(const char *root, char *out, size_t out_size);
+
+#endif // DIR_WALK_H
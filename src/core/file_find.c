@@ -0,0 +1,162 @@
+#include "file_find.h"
+#include "dir_walk.h"
+
+#include <dirent.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+typedef struct FindSearch {
+    const char *pattern;
+    bool recursive;
+    int max_results;
+    DirWalk *walk;
+
+    pthread_mutex_t results_mutex;
+    FileFindResults *results;
+    int results_capacity;
+} FindSearch;
+
+// Helper: Record a match; false once the cap is reached
+static bool search_add_result(FindSearch *search, const char *path)
+{
+    FileFindResults *results = search->results;
+    bool added = false;
+
+    pthread_mutex_lock(&search->results_mutex);
+    if (results->count >= search->max_results) {
+        results->truncated = true;
+    } else {
+        if (results->count == search->results_capacity) {
+            int capacity = search->results_capacity ? search->results_capacity * 2 : 64;
+            if (capacity > search->max_results) {
+                capacity = search->max_results;
+            }
+            char **paths = realloc(results->paths, (size_t)capacity * sizeof(char *));
+            if (paths) {
+                results->paths = paths;
+                search->results_capacity = capacity;
+            }
+        }
+        if (results->count < search->results_capacity) {
+            results->paths[results->count] = strdup(path);
+            if (results->paths[results->count]) {
+                results->count++;
+            }
+        }
+        added = true;
+    }
+    pthread_mutex_unlock(&search->results_mutex);
+
+    if (!added) {
+        dir_walk_stop(search->walk);
+    }
+    return added;
+}
+
+// Helper: Read one folder, recording matches and pushing subfolders
+static void search_read_dir(DirWalk *walk, int worker, const char *path, int depth, void *user_data)
+{
+    FindSearch *search = (FindSearch *)user_data;
+    DIR *handle = opendir(path);
+    if (!handle) {
+        return;
+    }
+
+    size_t dir_len = strlen(path);
+    bool at_root = dir_len == 1 && path[0] == '/';
+    struct dirent *entry;
+    while (!dir_walk_stopped(walk) && (entry = readdir(handle)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        char full_path[4096];
+        int len = snprintf(full_path, sizeof(full_path), "%s/%s", at_root ? "" : path, entry->d_name);
+        if (len < 0 || len >= (int)sizeof(full_path)) {
+            continue;
+        }
+
+        if (fnmatch(search->pattern, entry->d_name, 0) == 0 && !search_add_result(search, full_path)) {
+            break;
+        }
+
+        if (!search->recursive || depth >= FILE_FIND_MAX_DEPTH) {
+            continue;
+        }
+
+        // The entry type usually comes with the name; only ask when it does not
+        bool is_dir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN) {
+            struct stat st;
+            is_dir = lstat(full_path, &st) == 0 && S_ISDIR(st.st_mode);
+        }
+        if (is_dir) {
+            dir_walk_push(walk, worker, full_path, depth + 1);
+        }
+    }
+    closedir(handle);
+}
+
+static int path_compare(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+bool file_find(const char *root, const char *pattern, bool recursive, int max_results,
+               FileFindResults *results)
+{
+    if (results == NULL) {
+        return false;
+    }
+    memset(results, 0, sizeof(*results));
+    if (root == NULL || pattern == NULL || max_results <= 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (stat(root, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return false;
+    }
+
+    char root_path[4096];
+    if (!dir_walk_root(root, root_path, sizeof(root_path))) {
+        return false;
+    }
+
+    // One folder needs no helpers
+    FindSearch search = {0};
+    search.pattern = pattern;
+    search.recursive = recursive;
+    search.max_results = max_results;
+    search.results = results;
+    search.walk = dir_walk_create(recursive ? FILE_FIND_MAX_THREADS : 1, NULL);
+    if (!search.walk) {
+        return false;
+    }
+    pthread_mutex_init(&search.results_mutex, NULL);
+    dir_walk_run(search.walk, root_path, search_read_dir, &search);
+    pthread_mutex_destroy(&search.results_mutex);
+    dir_walk_destroy(search.walk);
+
+    // Threads finish in any order; sort for a stable answer
+    if (results->count > 1) {
+        qsort(results->paths, (size_t)results->count, sizeof(char *), path_compare);
+    }
+    return true;
+}
+
+void file_find_results_free(FileFindResults *results)
+{
+    if (results == NULL) {
+        return;
+    }
+    for (int i = 0; i < results->count; i++) {
+        free(results->paths[i]);
+    }
+    free(results->paths);
+    memset(results, 0, sizeof(*results));
+}
@@ -0,0 +1,31 @@
+#ifndef FILE_FIND_H
+#define FILE_FIND_H
+
+#include <stdbool.h>
+
+// Glob search of a directory tree by a small pool of threads, on the work-stealing
+// walk of dir_walk.h. The walk stops as soon as the result cap is reached
+
+// Folders deeper than this below the root are not entered
+#define FILE_FIND_MAX_DEPTH 32
+
+// Threads walking one search (the caller is one of them)
+#define FILE_FIND_MAX_THREADS 8
+
+// Matching paths (owned by the results), sorted by path
+typedef struct FileFindResults {
+    char **paths;
+    int count;
+    bool truncated;         // The cap was reached and the walk stopped early
+} FileFindResults;
+
+// Find entries below root (only its direct children unless recursive) whose name
+// matches the fnmatch glob pattern, up to max_results. Symlinked folders are listed
+// but not entered. False if root cannot be opened
+bool file_find(const char *root, const char *pattern, bool recursive, int max_results,
+               FileFindResults *results);
+
+// Free find results
+void file_find_results_free(FileFindResults *results);
+
+#endif // FILE_FIND_H
@@ -1,5 +1,10 @@
 #include "filesystem.h"
+#include "stat_cache.h"
+#include "archive.h"
 #include "../utils/perf.h"
+#include "../utils/trace.h"
+#include "../utils/arena.h"
+#include "../utils/file_type.h"
 
 #include <dirent.h>
 #include <stdio.h>
@@ -9,260 +14,2087 @@
 #include <sys/statvfs.h>
 #include <unistd.h>
 #include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#ifdef __APPLE__
+#include <sys/attr.h>
+#include <sys/vnode.h>
+#endif
 
 #define INITIAL_CAPACITY 256
+#define INITIAL_NAMES_CAPACITY (INITIAL_CAPACITY * 32)
+
+// Shared by every DirectoryState whose entries/names point at the same buffers
+typedef struct DirectoryStorage {
+    atomic_int refs;
+} DirectoryStorage;
+
+#define SORT_KINDS (SORT_BY_TYPE + 1)
+
+// Entry positions are recorded against a fixed "base" order (the order the
+// cache was created in), so a permutation stays usable after the entries move
+typedef struct DirectorySortCache {
+    int count;
+    uint32_t *order;                // Base index of each entry, in current order
+    uint32_t *perms[SORT_KINDS];    // Ascending order as base indices (NULL until built)
+    int dir_count;                  // Directories lead every order
+} DirectorySortCache;
+
+// Source of DirectoryState.generation values, unique across all states
+static atomic_uint g_next_generation = 1;
+
+static void bump_generation(DirectoryState *state)
+{
+    state->generation = atomic_fetch_add(&g_next_generation, 1);
+}
+
+static void sort_cache_drop(DirectoryState *state)
+{
+    DirectorySortCache *cache = state->sort_cache;
+    if (!cache) {
+        return;
+    }
+    free(cache->order);
+    for (int i = 0; i < SORT_KINDS; i++) {
+        free(cache->perms[i]);
+    }
+    free(cache);
+    state->sort_cache = NULL;
+}
+
+static void columns_drop(DirectoryState *state)
+{
+    DirectoryColumns *columns = state->columns;
+    if (!columns) {
+        return;
+    }
+    memory_free(MEMORY_TAG_DIRECTORY, columns->sizes);
+    memory_free(MEMORY_TAG_DIRECTORY, columns->mtimes);
+    memory_free(MEMORY_TAG_DIRECTORY, columns->name_offsets);
+    memory_free(MEMORY_TAG_DIRECTORY, columns->flags);
+    memory_free(MEMORY_TAG_DIRECTORY, columns->file_types);
+    memory_free(MEMORY_TAG_DIRECTORY, columns->git_status);
+    memory_free(MEMORY_TAG_DIRECTORY, columns);
+    state->columns = NULL;
+}
+
+// Helper: Columns if they were built from the current entries, else NULL
+static const DirectoryColumns *columns_current(const DirectoryState *state)
+{
+    const DirectoryColumns *columns = state->columns;
+    if (columns && columns->generation == state->generation && columns->count == state->count) {
+        return columns;
+    }
+    return NULL;
+}
 
 void directory_state_init(DirectoryState *state)
 {
     state->entries = NULL;
     state->count = 0;
+    state->hidden_count = 0;
+    state->view_mask = NULL;
     state->capacity = 0;
+    state->names = NULL;
+    state->names_size = 0;
+    state->names_capacity = 0;
+    state->storage = NULL;
     state->current_path[0] = '\0';
     state->show_hidden = false;
+    state->hidden_listed = false;
     state->is_loading = false;
+    state->streaming = false;
+    state->stream = NULL;
+    state->sort_cache = NULL;
+    state->generation = 0;
+    state->columns = NULL;
     state->error_message[0] = '\0';
 }
 
 void directory_state_free(DirectoryState *state)
 {
-    if (state->entries) {
-        free(state->entries);
-        state->entries = NULL;
+    directory_stream_cancel(state);
+    sort_cache_drop(state);
+    columns_drop(state);
+    bump_generation(state);
+
+    // Buffers go away with their last reference
+    if (!state->storage || atomic_fetch_sub(&state->storage->refs, 1) == 1) {
+        memory_free(MEMORY_TAG_DIRECTORY, state->entries);
+        memory_free(MEMORY_TAG_DIRECTORY, state->names);
+        memory_free(MEMORY_TAG_DIRECTORY, state->storage);
     }
+    memory_free(MEMORY_TAG_DIRECTORY, state->view_mask);
+    state->entries = NULL;
+    state->names = NULL;
+    state->storage = NULL;
+    state->view_mask = NULL;
     state->count = 0;
+    state->hidden_count = 0;
     state->capacity = 0;
+    state->names_size = 0;
+    state->names_capacity = 0;
+}
+
+bool directory_state_make_writable(DirectoryState *state)
+{
+    DirectoryStorage *shared = state->storage;
+    if (shared && atomic_load(&shared->refs) == 1) {
+        return true;
+    }
+
+    DirectoryStorage *storage = memory_alloc(MEMORY_TAG_DIRECTORY, sizeof(DirectoryStorage));
+    if (!storage) {
+        return false;
+    }
+    atomic_init(&storage->refs, 1);
+
+    if (!shared) {
+        // First write to a fresh state: nothing to copy
+        state->storage = storage;
+        return true;
+    }
+
+    // Copy on write: take private buffers and leave the originals to the other holders
+    FileEntry *entries = memory_alloc(MEMORY_TAG_DIRECTORY, state->capacity * sizeof(FileEntry));
+    char *names = memory_alloc(MEMORY_TAG_DIRECTORY, state->names_capacity);
+    if (!entries || !names) {
+        memory_free(MEMORY_TAG_DIRECTORY, entries);
+        memory_free(MEMORY_TAG_DIRECTORY, names);
+        memory_free(MEMORY_TAG_DIRECTORY, storage);
+        return false;
+    }
+    memcpy(entries, state->entries, (size_t)(state->count + state->hidden_count) * sizeof(FileEntry));
+    memcpy(names, state->names, state->names_size);
+
+    if (atomic_fetch_sub(&shared->refs, 1) == 1) {
+        // The other holders let go in the meantime
+        memory_free(MEMORY_TAG_DIRECTORY, state->entries);
+        memory_free(MEMORY_TAG_DIRECTORY, state->names);
+        memory_free(MEMORY_TAG_DIRECTORY, shared);
+    }
+
+    state->entries = entries;
+    state->names = names;
+    state->storage = storage;
+    return true;
+}
+
+static bool ensure_capacity(DirectoryState *state, int needed)
+{
+    if (!directory_state_make_writable(state)) {
+        return false;
+    }
+    if (needed <= state->capacity) {
+        return true;
+    }
+
+    int new_capacity = state->capacity == 0 ? INITIAL_CAPACITY : state->capacity * 2;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+
+    FileEntry *new_entries = memory_realloc(MEMORY_TAG_DIRECTORY, state->entries, new_capacity * sizeof(FileEntry));
+    if (!new_entries) {
+        return false;
+    }
+
+    state->entries = new_entries;
+    state->capacity = new_capacity;
+    return true;
+}
+
+static bool ensure_names_capacity(DirectoryState *state, size_t needed)
+{
+    if (!directory_state_make_writable(state)) {
+        return false;
+    }
+    if (needed <= state->names_capacity) {
+        return true;
+    }
+
+    size_t new_capacity = state->names_capacity == 0 ? INITIAL_NAMES_CAPACITY : state->names_capacity * 2;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+
+    char *new_names = memory_realloc(MEMORY_TAG_DIRECTORY, state->names, new_capacity);
+    if (!new_names) {
+        return false;
+    }
+
+    state->names = new_names;
+    state->names_capacity = new_capacity;
+    return true;
+}
+
+// Helper: Whether the view leaves fe out (further view filters belong here)
+static bool view_excludes(const DirectoryState *state, const FileEntry *fe)
+{
+    return fe->is_hidden && !state->show_hidden;
+}
+
+// Move the entries the view leaves out behind the rest, keeping both in order, and
+// record where they were so view_restore can put them back. Expects the full order
+// (hidden_count 0). Returns false on OOM, leaving every entry in the view
+static bool view_filter(DirectoryState *state)
+{
+    int total = state->count;
+    int excluded = 0;
+    for (int i = 0; i < total; i++) {
+        excluded += view_excludes(state, &state->entries[i]);
+    }
+    if (excluded == 0) {
+        return true;
+    }
+
+    uint64_t *mask = memory_calloc(MEMORY_TAG_DIRECTORY, (size_t)(total + 63) / 64, sizeof(uint64_t));
+    FileEntry *out = malloc((size_t)excluded * sizeof(FileEntry));
+    if (!mask || !out || !directory_state_make_writable(state)) {
+        memory_free(MEMORY_TAG_DIRECTORY, mask);
+        free(out);
+        return false;
+    }
+
+    int kept = 0, moved = 0;
+    for (int i = 0; i < total; i++) {
+        const FileEntry *fe = &state->entries[i];
+        if (view_excludes(state, fe)) {
+            mask[i / 64] |= 1ULL << (i % 64);
+            out[moved++] = *fe;
+        } else {
+            state->entries[kept++] = *fe;
+        }
+    }
+    memcpy(state->entries + kept, out, (size_t)excluded * sizeof(FileEntry));
+    free(out);
+
+    memory_free(MEMORY_TAG_DIRECTORY, state->view_mask);
+    state->view_mask = mask;
+    state->count = kept;
+    state->hidden_count = excluded;
+    bump_generation(state);
+    return true;
+}
+
+// Put entries left out of the view back where view_filter found them (O(n))
+// Returns false on OOM, leaving the view as it was
+static bool view_restore(DirectoryState *state)
+{
+    int excluded = state->hidden_count;
+    if (excluded == 0) {
+        return true;
+    }
+
+    FileEntry *out = malloc((size_t)excluded * sizeof(FileEntry));
+    if (!out || !directory_state_make_writable(state)) {
+        free(out);
+        return false;
+    }
+    memcpy(out, state->entries + state->count, (size_t)excluded * sizeof(FileEntry));
+
+    // Fill from the end so no visible entry is overwritten before it moves
+    int kept = state->count;
+    int moved = excluded;
+    for (int i = kept + excluded - 1; i >= 0; i--) {
+        if (state->view_mask[i / 64] & (1ULL << (i % 64))) {
+            state->entries[i] = out[--moved];
+        } else {
+            state->entries[i] = state->entries[--kept];
+        }
+    }
+    free(out);
+
+    memory_free(MEMORY_TAG_DIRECTORY, state->view_mask);
+    state->view_mask = NULL;
+    state->count += excluded;
+    state->hidden_count = 0;
+    bump_generation(state);
+    return true;
+}
+
+// Write the lowercase extension of name into dest, returns its length
+static size_t extract_extension(const char *name, char *dest, size_t ext_size)
+{
+    // Names may be paths relative to the listing (smart folders): only the last part counts
+    const char *slash = strrchr(name, '/');
+    if (slash) {
+        name = slash + 1;
+    }
+    const char *dot = strrchr(name, '.');
+    if (!dot || dot == name) {
+        return 0;
+    }
+
+    // Skip the dot and copy extension in lowercase
+    const char *src = dot + 1;
+    size_t i = 0;
+    while (*src && i < ext_size - 1) {
+        char c = *src;
+        if (c >= 'A' && c <= 'Z') {
+            c = c + ('a' - 'A');
+        }
+        dest[i] = c;
+        i++;
+        src++;
+    }
+    return i;
+}
+
+FileEntry *directory_append_entry(DirectoryState *state, const char *name)
+{
+    size_t name_len = strlen(name);
+    if (name_len >= NAME_MAX_LEN) {
+        name_len = NAME_MAX_LEN - 1;
+    }
+
+    // New entries go after the full order; the next directory_sort filters the view again
+    if (!view_restore(state)) {
+        return NULL;
+    }
+    sort_cache_drop(state);
+    bump_generation(state);
+
+    // Layout: name, NUL, extension (up to EXTENSION_MAX_LEN - 1), NUL
+    size_t needed = state->names_size + name_len + EXTENSION_MAX_LEN + 1;
+    if (!ensure_capacity(state, state->count + 1) || !ensure_names_capacity(state, needed)) {
+        return NULL;
+    }
+
+    FileEntry *fe = &state->entries[state->count];
+    memset(fe, 0, sizeof(FileEntry));
+
+    char *dest = state->names + state->names_size;
+    memcpy(dest, name, name_len);
+    dest[name_len] = '\0';
+
+    char *ext = dest + name_len + 1;
+    size_t ext_len = extract_extension(dest, ext, EXTENSION_MAX_LEN);
+    ext[ext_len] = '\0';
+
+    fe->name_offset = (uint32_t)state->names_size;
+    fe->name_len = (uint16_t)name_len;
+    fe->ext_len = (uint8_t)ext_len;
+    fe->file_type = file_type_from_extension(ext);
+
+    state->names_size += name_len + ext_len + 2;
+    state->count++;
+    return fe;
+}
+
+const char *directory_entry_path(const DirectoryState *state, const FileEntry *entry,
+                                 char *buffer, size_t buffer_size)
+{
+    const char *name = directory_entry_name(state, entry);
+    size_t dir_len = strlen(state->current_path);
+
+    if (dir_len > 0 && state->current_path[dir_len - 1] == '/') {
+        snprintf(buffer, buffer_size, "%s%s", state->current_path, name);
+    } else {
+        snprintf(buffer, buffer_size, "%s/%s", state->current_path, name);
+    }
+    return buffer;
+}
+
+char *directory_collect_paths(const DirectoryState *state, const int *indices, int count,
+                              const char **paths, struct Arena *arena)
+{
+    if (count <= 0) {
+        return NULL;
+    }
+
+    size_t dir_len = strlen(state->current_path);
+    size_t total = 0;
+    for (int i = 0; i < count; i++) {
+        total += dir_len + 1 + state->entries[indices[i]].name_len + 1;
+    }
+
+    char *block = arena ? arena_alloc(arena, total) : malloc(total);
+    if (!block) {
+        return NULL;
+    }
+
+    char *p = block;
+    for (int i = 0; i < count; i++) {
+        const FileEntry *fe = &state->entries[indices[i]];
+        size_t len = dir_len + 1 + fe->name_len + 1;
+        directory_entry_path(state, fe, p, len);
+        paths[i] = p;
+        p += len;
+    }
+    return block;
+}
+
+size_t directory_state_bytes(const DirectoryState *state)
+{
+    return (size_t)state->capacity * sizeof(FileEntry) + state->names_capacity;
+}
+
+const DirectoryColumns *directory_columns(DirectoryState *state)
+{
+    const DirectoryColumns *current = columns_current(state);
+    if (current) {
+        return current;
+    }
+
+    // Arrays are sized to the count, so a different count means new ones
+    DirectoryColumns *columns = state->columns;
+    if (columns && columns->count != state->count) {
+        columns_drop(state);
+        columns = NULL;
+    }
+    if (!columns) {
+        columns = memory_calloc(MEMORY_TAG_DIRECTORY, 1, sizeof(DirectoryColumns));
+        if (!columns) {
+            return NULL;
+        }
+        size_t n = state->count > 0 ? (size_t)state->count : 1;
+        columns->count = state->count;
+        columns->sizes = memory_alloc(MEMORY_TAG_DIRECTORY, n * sizeof(off_t));
+        columns->mtimes = memory_alloc(MEMORY_TAG_DIRECTORY, n * sizeof(time_t));
+        columns->name_offsets = memory_alloc(MEMORY_TAG_DIRECTORY, n * sizeof(uint32_t));
+        columns->flags = memory_alloc(MEMORY_TAG_DIRECTORY, n);
+        columns->file_types = memory_alloc(MEMORY_TAG_DIRECTORY, n);
+        columns->git_status = memory_alloc(MEMORY_TAG_DIRECTORY, n);
+        state->columns = columns;
+        if (!columns->sizes || !columns->mtimes || !columns->name_offsets || !columns->flags ||
+            !columns->file_types || !columns->git_status) {
+            columns_drop(state);
+            return NULL;
+        }
+    }
+
+    for (int i = 0; i < state->count; i++) {
+        const FileEntry *fe = &state->entries[i];
+        columns->sizes[i] = fe->size;
+        columns->mtimes[i] = fe->modified;
+        columns->name_offsets[i] = fe->name_offset;
+        columns->flags[i] = (uint8_t)((fe->is_directory ? DIR_COLUMN_DIRECTORY : 0) |
+                                      (fe->is_hidden ? DIR_COLUMN_HIDDEN : 0) |
+                                      (fe->is_symlink ? DIR_COLUMN_SYMLINK : 0));
+        columns->file_types[i] = fe->file_type;
+        columns->git_status[i] = fe->git_status;
+    }
+    columns->generation = state->generation;
+    return columns;
+}
+
+bool directory_set_git_status(DirectoryState *state, int index, uint8_t status)
+{
+    if (index < 0 || index >= state->count) {
+        return false;
+    }
+    if (state->entries[index].git_status == status) {
+        return true;
+    }
+    if (!directory_state_make_writable(state)) {
+        return false;
+    }
+    state->entries[index].git_status = status;
+
+    // Badges change without moving entries, so current columns are patched, not rebuilt
+    if (columns_current(state)) {
+        state->columns->git_status[index] = status;
+    }
+    return true;
+}
+
+off_t directory_sum_sizes(DirectoryState *state, const uint64_t *mask, int words, int *files)
+{
+    const DirectoryColumns *columns = directory_columns(state);
+    off_t total = 0;
+    int file_count = 0;
+    int max_words = (state->count + 63) / 64;
+    if (words > max_words) {
+        words = max_words;
+    }
+    for (int w = 0; w < words; w++) {
+        uint64_t word = mask[w];
+        while (word) {
+            int index = w * 64 + __builtin_ctzll(word);
+            word &= word - 1;
+            if (index >= state->count) {
+                break;
+            }
+            bool is_directory = columns ? (columns->flags[index] & DIR_COLUMN_DIRECTORY) != 0
+                                        : state->entries[index].is_directory;
+            if (!is_directory) {
+                total += columns ? columns->sizes[index] : state->entries[index].size;
+                file_count++;
+            }
+        }
+    }
+    if (files) {
+        *files = file_count;
+    }
+    return total;
+}
+
+// Append one readdir() result with defaults taken from d_type
+// Returns false only on allocation failure (skipped entries return true)
+static bool append_dirent(DirectoryState *state, const struct dirent *entry)
+{
+    // Skip . and ..
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+        return true;
+    }
+
+    bool is_hidden = entry->d_name[0] == '.';
+    FileEntry *fe = directory_append_entry(state, entry->d_name);
+    if (!fe) {
+        return false;
+    }
+
+    fe->is_hidden = is_hidden;
+    fe->is_directory = (entry->d_type == DT_DIR);
+    fe->is_symlink = (entry->d_type == DT_LNK);
+    return true;
+}
+
+// Fill in an appended entry's metadata with lstat (and stat for symlinks); false if lstat failed
+// Touches only *fe, so different entries may be filled from different threads
+static bool stat_entry(const DirectoryState *state, const char *dir_path, FileEntry *fe)
+{
+    // Build full path for stat
+    char full_path[PATH_MAX_LEN];
+    snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, directory_entry_name(state, fe));
+
+    // Get file info with stat
+    struct stat st;
+    bool found = stat_cache_lstat(full_path, &st);
+    if (found) {
+        fe->is_symlink = S_ISLNK(st.st_mode);
+
+        // For symlinks, stat the target
+        if (fe->is_symlink) {
+            struct stat target_st;
+            if (stat_cache_stat(full_path, &target_st)) {
+                fe->is_directory = S_ISDIR(target_st.st_mode);
+                fe->size = target_st.st_size;
+            } else {
+                // Broken symlink
+                fe->is_directory = false;
+                fe->size = 0;
+            }
+        } else {
+            fe->is_directory = S_ISDIR(st.st_mode);
+            fe->size = st.st_size;
+        }
+
+        fe->modified = st.st_mtime;
+        fe->created = st.st_birthtime;
+        fe->permissions = st.st_mode;
+    }
+    // Stat failed: keep the d_type defaults from append_dirent
+
+    // Directories carry no extension
+    if (fe->is_directory) {
+        fe->ext_len = 0;
+        fe->file_type = FILE_TYPE_ID_NONE;
+        state->names[fe->name_offset + fe->name_len + 1] = '\0';
+    }
+    return found;
+}
+
+FileEntry *directory_append_file(DirectoryState *state, const char *name)
+{
+    size_t names_size = state->names_size;
+    FileEntry *fe = directory_append_entry(state, name);
+    if (!fe) {
+        return NULL;
+    }
+
+    const char *slash = strrchr(name, '/');
+    fe->is_hidden = (slash ? slash[1] : name[0]) == '.';
+    if (!stat_entry(state, state->current_path, fe)) {
+        // Gone already: take the entry and its name back
+        state->count--;
+        state->names_size = names_size;
+        return NULL;
+    }
+    return fe;
+}
+
+bool directory_remove_entry(DirectoryState *state, int index)
+{
+    if (!view_restore(state) || !directory_state_make_writable(state)) {
+        return false;
+    }
+    if (index < 0 || index >= state->count) {
+        return false;
+    }
+
+    state->entries[index] = state->entries[state->count - 1];
+    state->count--;
+    sort_cache_drop(state);
+    bump_generation(state);
+    return true;
+}
+
+//=============================================================================
+// Parallel metadata fetch: on NFS/FUSE each lstat is a round trip, so a
+// batch of entries is split across a small pool of threads. The pool lives as
+// long as the reader, so a streamed read hands it batch after batch instead of
+// starting threads for each
+//=============================================================================
+
+#define PARALLEL_STAT_MIN 32    // Smaller batches are stated on the caller's thread
+#define PARALLEL_STAT_CHUNK 8   // Entries claimed per atomic increment
+
+static atomic_int g_metadata_threads = DIR_METADATA_THREADS_DEFAULT;
+
+typedef struct StatPool {
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;           // A batch was posted, or the pool is closing
+    pthread_cond_t idle_cond;           // The last helper left a batch
+    pthread_t helpers[DIR_METADATA_THREADS_MAX];
+    int helper_count;
+    bool closing;
+
+    // The batch being stated: helpers take a copy of it when they join
+    const DirectoryState *state;
+    const char *dir_path;
+    FileEntry *entries;
+    int end;
+    unsigned batch;                     // Bumped for each batch posted
+    int busy;                           // Helpers working on the batch
+    atomic_int next;
+} StatPool;
+
+void directory_set_metadata_threads(int threads)
+{
+    if (threads < 1) threads = 1;
+    if (threads > DIR_METADATA_THREADS_MAX) threads = DIR_METADATA_THREADS_MAX;
+    atomic_store(&g_metadata_threads, threads);
+}
+
+// Helper: Claim and stat chunks of the batch until none are left
+static void stat_pool_work(StatPool *pool, const DirectoryState *state, const char *dir_path,
+                           FileEntry *entries, int end)
+{
+    for (;;) {
+        int start = atomic_fetch_add(&pool->next, PARALLEL_STAT_CHUNK);
+        if (start >= end) {
+            break;
+        }
+        int stop = start + PARALLEL_STAT_CHUNK < end ? start + PARALLEL_STAT_CHUNK : end;
+        for (int i = start; i < stop; i++) {
+            stat_entry(state, dir_path, &entries[i]);
+        }
+    }
+}
+
+// Thread function: Join each batch posted until the pool closes
+static void *stat_pool_helper(void *arg)
+{
+    StatPool *pool = (StatPool *)arg;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->closing && pool->batch == seen) {
+            pthread_cond_wait(&pool->work_cond, &pool->mutex);
+        }
+        if (pool->closing) {
+            break;
+        }
+        seen = pool->batch;
+        const DirectoryState *state = pool->state;
+        const char *dir_path = pool->dir_path;
+        FileEntry *entries = pool->entries;
+        int end = pool->end;
+        pool->busy++;
+        pthread_mutex_unlock(&pool->mutex);
+
+        stat_pool_work(pool, state, dir_path, entries, end);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->busy == 0) {
+            pthread_cond_signal(&pool->idle_cond);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+static StatPool *stat_pool_create(void)
+{
+    StatPool *pool = calloc(1, sizeof(StatPool));
+    if (!pool) {
+        return NULL;
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->idle_cond, NULL);
+    atomic_init(&pool->next, 0);
+    return pool;
+}
+
+static void stat_pool_destroy(StatPool *pool)
+{
+    if (!pool) {
+        return;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    pool->closing = true;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < pool->helper_count; i++) {
+        pthread_join(pool->helpers[i], NULL);
+    }
+    pthread_cond_destroy(&pool->idle_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+// Stat entries [start, state->count); the caller's thread works alongside the pool,
+// which is created on the first batch large enough and its helpers on demand
+static void stat_entries(StatPool **pool_slot, DirectoryState *state, const char *dir_path, int start)
+{
+    int pending = state->count - start;
+    int threads = atomic_load(&g_metadata_threads);
+    if (threads > pending / PARALLEL_STAT_CHUNK) {
+        threads = pending / PARALLEL_STAT_CHUNK;
+    }
+
+    StatPool *pool = *pool_slot;
+    if (pending >= PARALLEL_STAT_MIN && threads > 1 && !pool) {
+        pool = *pool_slot = stat_pool_create();
+    }
+    if (pending < PARALLEL_STAT_MIN || threads <= 1 || !pool) {
+        for (int i = start; i < state->count; i++) {
+            stat_entry(state, dir_path, &state->entries[i]);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->helper_count < threads - 1 &&
+           pthread_create(&pool->helpers[pool->helper_count], NULL, stat_pool_helper, pool) == 0) {
+        pool->helper_count++;  // Run with however many threads we got
+    }
+    pool->state = state;
+    pool->dir_path = dir_path;
+    pool->entries = state->entries;
+    pool->end = state->count;
+    atomic_store(&pool->next, start);
+    pool->batch++;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    stat_pool_work(pool, state, dir_path, state->entries, state->count);
+
+    // A helper that wakes after this joins an empty batch
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->busy > 0) {
+        pthread_cond_wait(&pool->idle_cond, &pool->mutex);
+    }
+    pool->end = 0;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+//=============================================================================
+// Directory reader: getattrlistbulk on macOS, readdir + lstat elsewhere
+//=============================================================================
+
+#ifdef __APPLE__
+#define BULK_BUFFER_SIZE (256 * 1024)
+
+// Attributes fetched per entry by getattrlistbulk (order matters, see below)
+#define BULK_COMMON_ATTRS (ATTR_CMN_RETURNED_ATTRS | ATTR_CMN_NAME | ATTR_CMN_ERROR | \
+                           ATTR_CMN_OBJTYPE | ATTR_CMN_CRTIME | ATTR_CMN_MODTIME | \
+                           ATTR_CMN_ACCESSMASK)
+#define BULK_FILE_ATTRS   (ATTR_FILE_DATALENGTH)
+#endif
+
+typedef struct DirReader {
+    char path[PATH_MAX_LEN];
+    DIR *dir;                       // readdir fallback (NULL when using bulk)
+#ifdef __APPLE__
+    int bulk_fd;                    // getattrlistbulk fd (-1 when using readdir)
+    char *bulk_buf;
+    char *bulk_cursor;              // Next unparsed entry in bulk_buf
+    int bulk_remaining;             // Entries left in bulk_buf
+#endif
+    // A folder in an archive (path is archive file + "/" + folder): members are listed
+    // from the archive, opened on the first fill
+    bool in_archive;
+    Archive *archive;
+    int archive_next;               // Next item to list
+    int archive_end;
+    bool background;                // On the stream worker: a tar may be read through
+    const atomic_bool *cancel;      // Stops that read (may be NULL)
+    StatPool *stat_pool;            // lstat helpers for the readdir fallback (NULL until needed)
+} DirReader;
+
+static bool reader_open(DirReader *reader, const char *path)
+{
+    memset(reader, 0, sizeof(DirReader));
+    strncpy(reader->path, path, sizeof(reader->path) - 1);
+
+    char archive_path[PATH_MAX_LEN];
+    const char *inner;
+    if (archive_split_path(reader->path, archive_path, sizeof(archive_path), &inner)) {
+        reader->in_archive = true;
+#ifdef __APPLE__
+        reader->bulk_fd = -1;
+#endif
+        // A tar not listed yet is left for the first fill; anything else fails here
+        Archive *archive = archive_open(archive_path, false, NULL);
+        if (archive == NULL) {
+            return errno == EAGAIN;
+        }
+        int first, end;
+        if (!archive_folder(archive, inner, &first, &end)) {
+            archive_release(archive);
+            errno = ENOTDIR;
+            return false;
+        }
+        reader->archive = archive;
+        reader->archive_next = first;
+        reader->archive_end = end;
+        return true;
+    }
+
+#ifdef __APPLE__
+    reader->bulk_fd = open(path, O_RDONLY | O_DIRECTORY);
+    if (reader->bulk_fd >= 0) {
+        reader->bulk_buf = malloc(BULK_BUFFER_SIZE);
+        if (reader->bulk_buf) {
+            return true;
+        }
+        close(reader->bulk_fd);
+    }
+    reader->bulk_fd = -1;
+#endif
+
+    reader->dir = opendir(path);
+    return reader->dir != NULL;
+}
+
+static void reader_close(DirReader *reader)
+{
+    stat_pool_destroy(reader->stat_pool);
+    reader->stat_pool = NULL;
+    if (reader->archive) {
+        archive_release(reader->archive);
+        reader->archive = NULL;
+    }
+#ifdef __APPLE__
+    if (reader->bulk_fd >= 0) {
+        close(reader->bulk_fd);
+        reader->bulk_fd = -1;
+    }
+    free(reader->bulk_buf);
+    reader->bulk_buf = NULL;
+#endif
+    if (reader->dir) {
+        closedir(reader->dir);
+        reader->dir = NULL;
+    }
+}
+
+#ifdef __APPLE__
+// Parse one getattrlistbulk record and append it to state
+static bool append_bulk_entry(DirectoryState *state, const char *dir_path, const char *record)
+{
+    // Layout: length, returned attribute set, then each returned attribute
+    // in bitmap order (error, name, objtype, crtime, modtime, accessmask, datalength)
+    // Attributes are only 4-byte aligned, so copy fields out with memcpy
+    const char *field = record + sizeof(uint32_t);
+    attribute_set_t returned;
+    memcpy(&returned, field, sizeof(returned));
+    field += sizeof(attribute_set_t);
+
+    if (returned.commonattr & ATTR_CMN_ERROR) {
+        uint32_t error;
+        memcpy(&error, field, sizeof(error));
+        field += sizeof(uint32_t);
+        if (error != 0) {
+            return true;  // Skip entries the volume could not describe
+        }
+    }
+
+    if (!(returned.commonattr & ATTR_CMN_NAME)) {
+        return true;
+    }
+    attrreference_t name_ref;
+    memcpy(&name_ref, field, sizeof(name_ref));
+    const char *name = field + name_ref.attr_dataoffset;
+    field += sizeof(attrreference_t);
+
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+        return true;
+    }
+
+    bool is_hidden = name[0] == '.';
+    fsobj_type_t obj_type = VNON;
+    if (returned.commonattr & ATTR_CMN_OBJTYPE) {
+        memcpy(&obj_type, field, sizeof(obj_type));
+        field += sizeof(fsobj_type_t);
+    }
+
+    struct timespec crtime = {0, 0};
+    if (returned.commonattr & ATTR_CMN_CRTIME) {
+        memcpy(&crtime, field, sizeof(crtime));
+        field += sizeof(struct timespec);
+    }
+
+    struct timespec modtime = {0, 0};
+    if (returned.commonattr & ATTR_CMN_MODTIME) {
+        memcpy(&modtime, field, sizeof(modtime));
+        field += sizeof(struct timespec);
+    }
+
+    uint32_t access = 0;
+    if (returned.commonattr & ATTR_CMN_ACCESSMASK) {
+        memcpy(&access, field, sizeof(access));
+        field += sizeof(uint32_t);
+    }
+
+    off_t size = 0;
+    if (returned.fileattr & ATTR_FILE_DATALENGTH) {
+        memcpy(&size, field, sizeof(size));
+    }
+
+    FileEntry *fe = directory_append_entry(state, name);
+    if (!fe) {
+        return false;
+    }
+
+    mode_t type_bits = obj_type == VDIR ? S_IFDIR : (obj_type == VLNK ? S_IFLNK : S_IFREG);
+    fe->is_hidden = is_hidden;
+    fe->is_symlink = (obj_type == VLNK);
+    fe->is_directory = (obj_type == VDIR);
+    fe->size = size;
+    fe->modified = modtime.tv_sec;
+    fe->created = crtime.tv_sec;
+    fe->permissions = (mode_t)((access & ~S_IFMT) | type_bits);
+
+    // Symlinks still need the target's type and size
+    if (fe->is_symlink) {
+        char full_path[PATH_MAX_LEN];
+        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, name);
+        struct stat target_st;
+        if (stat_cache_stat(full_path, &target_st)) {
+            fe->is_directory = S_ISDIR(target_st.st_mode);
+            fe->size = target_st.st_size;
+        } else {
+            fe->size = 0;  // Broken symlink
+        }
+    }
+
+    if (fe->is_directory) {
+        fe->ext_len = 0;
+        fe->file_type = FILE_TYPE_ID_NONE;
+        state->names[fe->name_offset + fe->name_len + 1] = '\0';
+    }
+
+    return true;
+}
+#endif
+
+// Helper: reader_fill for a folder in an archive. A tar that has to be read through
+// to be listed is only read on the stream worker (or when the whole listing is wanted)
+static int archive_fill(DirReader *reader, DirectoryState *state, int limit)
+{
+    if (reader->archive == NULL) {
+        if (!reader->background && limit != INT_MAX) {
+            return 1;   // Nothing yet: the stream worker carries on
+        }
+        char archive_path[PATH_MAX_LEN];
+        const char *inner;
+        if (!archive_split_path(reader->path, archive_path, sizeof(archive_path), &inner)) {
+            return 0;
+        }
+        reader->archive = archive_open(archive_path, true, reader->cancel);
+        if (reader->archive == NULL ||
+            !archive_folder(reader->archive, inner, &reader->archive_next, &reader->archive_end)) {
+            return 0;
+        }
+    }
+
+    while (state->count < limit && reader->archive_next < reader->archive_end) {
+        ArchiveEntry member;
+        archive_entry(reader->archive, reader->archive_next, &member);
+        reader->archive_next = archive_next(reader->archive, reader->archive_next);
+
+        FileEntry *fe = directory_append_entry(state, member.name);
+        if (!fe) {
+            return -1;
+        }
+        fe->is_hidden = member.name[0] == '.';
+        fe->is_symlink = S_ISLNK(member.mode);
+        fe->is_directory = member.is_directory;
+        fe->size = (off_t)member.size;
+        fe->modified = member.modified;
+        fe->created = member.modified;
+        fe->permissions = (uint16_t)member.mode;
+        if (fe->is_directory) {
+            fe->ext_len = 0;
+            fe->file_type = FILE_TYPE_ID_NONE;
+            state->names[fe->name_offset + fe->name_len + 1] = '\0';
+        }
+    }
+    return reader->archive_next < reader->archive_end ? 1 : 0;
+}
+
+// Read entries into state until it holds `limit` entries or the directory ends
+// Returns 1 if entries may remain, 0 at end of directory, -1 on allocation failure
+static int reader_fill(DirReader *reader, DirectoryState *state, int limit)
+{
+    // Entries are appended after the full order, not the view
+    if (!view_restore(state)) {
+        return -1;
+    }
+
+    if (reader->in_archive) {
+        return archive_fill(reader, state, limit);
+    }
+
+#ifdef __APPLE__
+    if (reader->bulk_fd >= 0) {
+        while (state->count < limit) {
+            if (reader->bulk_remaining == 0) {
+                struct attrlist attrs;
+                memset(&attrs, 0, sizeof(attrs));
+                attrs.bitmapcount = ATTR_BIT_MAP_COUNT;
+                attrs.commonattr = BULK_COMMON_ATTRS;
+                attrs.fileattr = BULK_FILE_ATTRS;
+
+                int n = getattrlistbulk(reader->bulk_fd, &attrs, reader->bulk_buf, BULK_BUFFER_SIZE, 0);
+                if (n <= 0) {
+                    if (n < 0 && state->count == 0 && (errno == ENOTSUP || errno == EINVAL)) {
+                        // Volume without bulk support: fall back to readdir
+                        close(reader->bulk_fd);
+                        reader->bulk_fd = -1;
+                        reader->dir = opendir(reader->path);
+                        if (reader->dir) {
+                            return reader_fill(reader, state, limit);
+                        }
+                    }
+                    return 0;
+                }
+                reader->bulk_cursor = reader->bulk_buf;
+                reader->bulk_remaining = n;
+            }
+
+            const char *record = reader->bulk_cursor;
+            uint32_t record_len;
+            memcpy(&record_len, record, sizeof(record_len));
+            reader->bulk_cursor += record_len;
+            reader->bulk_remaining--;
+
+            if (!append_bulk_entry(state, reader->path, record)) {
+                return -1;
+            }
+        }
+        return 1;
+    }
+#endif
+
+    // Collect names first so the arena stops moving, then stat them in parallel
+    int start = state->count;
+    int status = 1;
+    struct dirent *entry;
+    while (state->count < limit) {
+        entry = readdir(reader->dir);
+        if (!entry) {
+            status = 0;
+            break;
+        }
+        if (!append_dirent(state, entry)) {
+            status = -1;
+            break;
+        }
+    }
+    stat_entries(&reader->stat_pool, state, reader->path, start);
+    return status;
+}
+
+static bool stream_start(DirectoryState *state, DirReader *reader);
+
+bool directory_read(DirectoryState *state, const char *path)
+{
+    TRACE_SCOPE("directory_read");
+    // A new read supersedes any enumeration still running on this state
+    directory_stream_cancel(state);
+
+    state->is_loading = true;
+    state->error_message[0] = '\0';
+
+    // Resolve path and handle special cases
+    char resolved_path[PATH_MAX_LEN];
+    char archive_path[PATH_MAX_LEN];
+    const char *inner;
+    if (path[0] == '~') {
+        const char *home = getenv("HOME");
+        if (home) {
+            snprintf(resolved_path, sizeof(resolved_path), "%s%s", home, path + 1);
+        } else {
+            strncpy(resolved_path, path, sizeof(resolved_path) - 1);
+            resolved_path[sizeof(resolved_path) - 1] = '\0';
+        }
+    } else if (archive_split_path(path, archive_path, sizeof(archive_path), &inner)) {
+        // A folder in an archive: only the archive file is resolved
+        if (realpath(archive_path, resolved_path) == NULL) {
+            snprintf(state->error_message, sizeof(state->error_message),
+                     "Cannot resolve path: %s", strerror(errno));
+            state->is_loading = false;
+            return false;
+        }
+        size_t length = strlen(resolved_path);
+        if (inner[0] != '\0') {
+            snprintf(resolved_path + length, sizeof(resolved_path) - length, "/%s", inner);
+            length = strlen(resolved_path);
+        }
+        while (length > 1 && resolved_path[length - 1] == '/') {
+            resolved_path[--length] = '\0';
+        }
+    } else {
+        if (realpath(path, resolved_path) == NULL) {
+            snprintf(state->error_message, sizeof(state->error_message),
+                     "Cannot resolve path: %s", strerror(errno));
+            state->is_loading = false;
+            return false;
+        }
+    }
+
+    DirReader reader;
+    if (!reader_open(&reader, resolved_path)) {
+        snprintf(state->error_message, sizeof(state->error_message),
+                 "Cannot open directory: %s", strerror(errno));
+        state->is_loading = false;
+        return false;
+    }
+
+    // Clear existing entries (a shared snapshot is dropped, not copied)
+    if (state->storage && atomic_load(&state->storage->refs) > 1) {
+        directory_state_free(state);
+    }
+    state->count = 0;
+    state->hidden_count = 0;
+    state->names_size = 0;
+    state->hidden_listed = true;
+    bump_generation(state);
+
+    strncpy(state->current_path, resolved_path, sizeof(state->current_path) - 1);
+    state->current_path[sizeof(state->current_path) - 1] = '\0';
+
+    // Large directory: paint the first batch, enumerate the rest in the background
+    int limit = state->streaming ? DIR_STREAM_FIRST_BATCH : INT_MAX;
+    int status = reader_fill(&reader, state, limit);
+    if (status < 0) {
+        reader_close(&reader);
+        snprintf(state->error_message, sizeof(state->error_message),
+                 "Out of memory");
+        state->is_loading = false;
+        return false;
+    }
+
+    // Sort by default (folders first, then alphabetically)
+    directory_sort(state, SORT_BY_NAME, true);
+
+    if (status > 0) {
+        if (stream_start(state, &reader)) {
+            return true;  // is_loading stays set until the worker finishes
+        }
+
+        // No worker thread available: finish synchronously
+        reader_fill(&reader, state, INT_MAX);
+        directory_sort(state, SORT_BY_NAME, true);
+    }
+
+    reader_close(&reader);
+
+    state->is_loading = false;
+    return true;
+}
+
+// Sort context (using globals since qsort doesn't have context parameter); listings
+// are also read off the main thread, so the globals are held while a sort uses them
+static pthread_mutex_t g_sort_mutex = PTHREAD_MUTEX_INITIALIZER;
+static SortBy g_sort_by = SORT_BY_NAME;
+static bool g_sort_ascending = true;
+static const char *g_sort_names = NULL;
+
+static int compare_entries_qsort(const void *a, const void *b)
+{
+    const FileEntry *fa = (const FileEntry *)a;
+    const FileEntry *fb = (const FileEntry *)b;
+
+    // Directories always come first
+    if (fa->is_directory && !fb->is_directory) {
+        return -1;
+    }
+    if (!fa->is_directory && fb->is_directory) {
+        return 1;
+    }
+
+    int result = 0;
+
+    switch (g_sort_by) {
+        case SORT_BY_NAME:
+            result = strcasecmp(g_sort_names + fa->name_offset, g_sort_names + fb->name_offset);
+            break;
+        case SORT_BY_SIZE:
+            if (fa->size < fb->size) result = -1;
+            else if (fa->size > fb->size) result = 1;
+            else result = 0;
+            break;
+        case SORT_BY_MODIFIED:
+            if (fa->modified < fb->modified) result = -1;
+            else if (fa->modified > fb->modified) result = 1;
+            else result = 0;
+            break;
+        case SORT_BY_TYPE:
+            result = strcasecmp(g_sort_names + fa->name_offset + fa->name_len + 1,
+                                g_sort_names + fb->name_offset + fb->name_len + 1);
+            if (result == 0) {
+                result = strcasecmp(g_sort_names + fa->name_offset, g_sort_names + fb->name_offset);
+            }
+            break;
+    }
+
+    return g_sort_ascending ? result : -result;
+}
+
+static void sort_entries_internal(FileEntry *entries, int count, const char *names,
+                                  SortBy sort_by, bool ascending)
+{
+    if (count <= 1) return;
+
+    // Set global sort parameters
+    pthread_mutex_lock(&g_sort_mutex);
+    g_sort_by = sort_by;
+    g_sort_ascending = ascending;
+    g_sort_names = names;
+
+    // Use standard qsort for O(n log n) performance
+    qsort(entries, count, sizeof(FileEntry), compare_entries_qsort);
+    pthread_mutex_unlock(&g_sort_mutex);
+}
+
+//=============================================================================
+// Key-based sorting: each entry gets a 64-bit key (directory bit, then the
+// sort field or a case-folded name/extension prefix), 4-byte indices are
+// radix sorted by key, and only runs of equal string prefixes fall back to
+// a full comparison
+//=============================================================================
+
+#define KEY_FILE_BIT (1ULL << 63)   // Clear for directories so they sort first
+#define KEY_PREFIX_BYTES 7
+
+// Case-folded first KEY_PREFIX_BYTES bytes of s, big-endian so keys compare like strcasecmp
+static uint64_t fold_prefix(const char *s, bool *truncated)
+{
+    uint64_t key = 0;
+    int i = 0;
+    for (; i < KEY_PREFIX_BYTES && s[i]; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c >= 'A' && c <= 'Z') {
+            c = c + ('a' - 'A');
+        }
+        key = (key << 8) | c;
+    }
+    *truncated = i == KEY_PREFIX_BYTES && s[i] != '\0';
+    return key << (8 * (KEY_PREFIX_BYTES - i));
+}
+
+// Keys that are a single number, from the columns or the entry
+static uint64_t size_key(off_t size)
+{
+    return size > 0 ? (uint64_t)size & ~KEY_FILE_BIT : 0;
+}
+
+static uint64_t time_key(time_t modified)
+{
+    // Bias signed times into unsigned order
+    return ((uint64_t)(int64_t)modified + (1ULL << 62)) & ~KEY_FILE_BIT;
+}
+
+static uint64_t entry_sort_key(const DirectoryState *state, const FileEntry *fe,
+                               SortBy sort_by, bool *inexact)
+{
+    uint64_t key = 0;
+    *inexact = false;
+
+    switch (sort_by) {
+        case SORT_BY_NAME:
+            key = fold_prefix(directory_entry_name(state, fe), inexact);
+            break;
+        case SORT_BY_SIZE:
+            key = size_key(fe->size);
+            break;
+        case SORT_BY_MODIFIED:
+            key = time_key(fe->modified);
+            break;
+        case SORT_BY_TYPE:
+            // Equal extensions still need the name as a tie-breaker
+            key = fold_prefix(directory_entry_extension(state, fe), inexact);
+            *inexact = true;
+            break;
+    }
+
+    return fe->is_directory ? key : key | KEY_FILE_BIT;
+}
+
+// LSD radix sort of idx by keys, skipping bytes that are the same for every key
+static void radix_sort_indices(uint64_t *keys, uint32_t *idx, int n)
+{
+    uint64_t *tmp_keys = malloc(n * sizeof(uint64_t));
+    uint32_t *tmp_idx = malloc(n * sizeof(uint32_t));
+    if (!tmp_keys || !tmp_idx) {
+        free(tmp_keys);
+        free(tmp_idx);
+        // Insertion sort keeps the result correct if scratch space is unavailable
+        for (int i = 1; i < n; i++) {
+            uint64_t k = keys[i];
+            uint32_t v = idx[i];
+            int j = i - 1;
+            while (j >= 0 && keys[j] > k) {
+                keys[j + 1] = keys[j];
+                idx[j + 1] = idx[j];
+                j--;
+            }
+            keys[j + 1] = k;
+            idx[j + 1] = v;
+        }
+        return;
+    }
+
+    uint64_t *src_keys = keys, *dst_keys = tmp_keys;
+    uint32_t *src_idx = idx, *dst_idx = tmp_idx;
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {0};
+        for (int i = 0; i < n; i++) {
+            counts[(src_keys[i] >> shift) & 0xFF]++;
+        }
+        if (counts[(src_keys[0] >> shift) & 0xFF] == (size_t)n) {
+            continue;
+        }
+
+        size_t pos = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t c = counts[b];
+            counts[b] = pos;
+            pos += c;
+        }
+        for (int i = 0; i < n; i++) {
+            size_t slot = counts[(src_keys[i] >> shift) & 0xFF]++;
+            dst_keys[slot] = src_keys[i];
+            dst_idx[slot] = src_idx[i];
+        }
+
+        uint64_t *tk = src_keys; src_keys = dst_keys; dst_keys = tk;
+        uint32_t *ti = src_idx; src_idx = dst_idx; dst_idx = ti;
+    }
+
+    if (src_keys != keys) {
+        memcpy(keys, src_keys, n * sizeof(uint64_t));
+        memcpy(idx, src_idx, n * sizeof(uint32_t));
+    }
+    free(tmp_keys);
+    free(tmp_idx);
+}
+
+// Entries addressed by base index, for tie-breaking comparisons
+static const FileEntry *g_sort_base_entries = NULL;
+static const uint32_t *g_sort_base_pos = NULL;
+
+static int compare_base_indices(const void *a, const void *b)
+{
+    const FileEntry *fa = &g_sort_base_entries[g_sort_base_pos[*(const uint32_t *)a]];
+    const FileEntry *fb = &g_sort_base_entries[g_sort_base_pos[*(const uint32_t *)b]];
+    return compare_entries_qsort(fa, fb);
+}
+
+// Build the ascending permutation (as base indices) for sort_by
+static uint32_t *build_sort_perm(DirectoryState *state, const uint32_t *pos, SortBy sort_by)
+{
+    int n = state->count;
+    uint64_t *keys = malloc(n * sizeof(uint64_t));
+    uint32_t *perm = malloc(n * sizeof(uint32_t));
+    bool *inexact = malloc(n * sizeof(bool));
+    if (!keys || !perm || !inexact) {
+        free(keys);
+        free(perm);
+        free(inexact);
+        return NULL;
+    }
+
+    bool any_inexact = false;
+    const DirectoryColumns *columns = columns_current(state);
+    if (columns && (sort_by == SORT_BY_SIZE || sort_by == SORT_BY_MODIFIED)) {
+        // Numeric keys need only one column and the flags
+        for (int b = 0; b < n; b++) {
+            uint32_t i = pos[b];
+            uint64_t key = sort_by == SORT_BY_SIZE ? size_key(columns->sizes[i]) : time_key(columns->mtimes[i]);
+            keys[b] = (columns->flags[i] & DIR_COLUMN_DIRECTORY) ? key : key | KEY_FILE_BIT;
+            inexact[b] = false;
+            perm[b] = (uint32_t)b;
+        }
+    } else {
+        for (int b = 0; b < n; b++) {
+            keys[b] = entry_sort_key(state, &state->entries[pos[b]], sort_by, &inexact[b]);
+            any_inexact |= inexact[b];
+            perm[b] = (uint32_t)b;
+        }
+    }
+
+    radix_sort_indices(keys, perm, n);
+
+    // Order runs of equal keys whose prefix did not decide the comparison
+    if (any_inexact) {
+        pthread_mutex_lock(&g_sort_mutex);
+        g_sort_by = sort_by;
+        g_sort_ascending = true;
+        g_sort_names = state->names;
+        g_sort_base_entries = state->entries;
+        g_sort_base_pos = pos;
+
+        int run = 0;
+        bool run_inexact = inexact[perm[0]];
+        for (int i = 1; i <= n; i++) {
+            if (i == n || keys[i] != keys[run]) {
+                if (i - run > 1 && run_inexact) {
+                    qsort(perm + run, i - run, sizeof(uint32_t), compare_base_indices);
+                }
+                run = i;
+                run_inexact = i < n && inexact[perm[i]];
+            } else {
+                run_inexact |= inexact[perm[i]];
+            }
+        }
+        pthread_mutex_unlock(&g_sort_mutex);
+    }
+
+    free(keys);
+    free(inexact);
+    return perm;
+}
+
+// Set up position tracking for the current order of state
+static DirectorySortCache *sort_cache_get(DirectoryState *state)
+{
+    DirectorySortCache *cache = state->sort_cache;
+    if (cache && cache->count == state->count) {
+        return cache;
+    }
+    sort_cache_drop(state);
+
+    cache = calloc(1, sizeof(DirectorySortCache));
+    if (!cache) {
+        return NULL;
+    }
+    cache->count = state->count;
+    cache->order = malloc(state->count * sizeof(uint32_t));
+    if (!cache->order) {
+        free(cache);
+        return NULL;
+    }
+    for (int i = 0; i < state->count; i++) {
+        cache->order[i] = (uint32_t)i;
+        if (state->entries[i].is_directory) {
+            cache->dir_count++;
+        }
+    }
+    state->sort_cache = cache;
+    return cache;
+}
+
+static void sort_full(DirectoryState *state, SortBy sort_by, bool ascending);
+
+// Rearrange entries into target order (base indices); falls back to qsort on OOM
+static bool apply_sort_order(DirectoryState *state, DirectorySortCache *cache,
+                             const uint32_t *pos, const uint32_t *target)
+{
+    int n = state->count;
+    FileEntry *sorted = memory_alloc(MEMORY_TAG_DIRECTORY, state->capacity * sizeof(FileEntry));
+    if (!sorted) {
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        sorted[i] = state->entries[pos[target[i]]];
+    }
+    memory_free(MEMORY_TAG_DIRECTORY, state->entries);
+    state->entries = sorted;
+    memcpy(cache->order, target, n * sizeof(uint32_t));
+    return true;
+}
+
+void directory_sort(DirectoryState *state, SortBy sort_by, bool ascending)
+{
+    TRACE_SCOPE("directory_sort");
+    // Sort the full order, so the sort cache outlives a change of view
+    view_restore(state);
+    sort_full(state, sort_by, ascending);
+    view_filter(state);
+}
+
+// Helper: Sort all of state's entries (see directory_sort)
+static void sort_full(DirectoryState *state, SortBy sort_by, bool ascending)
+{
+    if (state->count <= 1 || !directory_state_make_writable(state)) {
+        return;
+    }
+
+    int n = state->count;
+    DirectorySortCache *cache = sort_cache_get(state);
+    uint32_t *pos = malloc(n * sizeof(uint32_t));
+    uint32_t *target = malloc(n * sizeof(uint32_t));
+    bool sorted = false;
+
+    if (cache && pos && target) {
+        // Where each base entry currently sits
+        for (int i = 0; i < n; i++) {
+            pos[cache->order[i]] = (uint32_t)i;
+        }
+
+        if (!cache->perms[sort_by]) {
+            cache->perms[sort_by] = build_sort_perm(state, pos, sort_by);
+        }
+
+        const uint32_t *perm = cache->perms[sort_by];
+        if (perm) {
+            if (ascending) {
+                memcpy(target, perm, n * sizeof(uint32_t));
+            } else {
+                // Descending keeps directories first: reverse each group
+                int dirs = cache->dir_count;
+                for (int i = 0; i < dirs; i++) {
+                    target[i] = perm[dirs - 1 - i];
+                }
+                for (int i = dirs; i < n; i++) {
+                    target[i] = perm[n - 1 - (i - dirs)];
+                }
+            }
+            sorted = apply_sort_order(state, cache, pos, target);
+        }
+    }
+
+    free(pos);
+    free(target);
+
+    if (!sorted) {
+        sort_cache_drop(state);
+        sort_entries_internal(state->entries, state->count, state->names, sort_by, ascending);
+    }
+    bump_generation(state);
+}
+
+//=============================================================================
+// Streaming enumeration
+//=============================================================================
+
+typedef struct DirectoryStream {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    DirReader reader;               // Owned by the worker until it exits
+    DirectoryState pending;         // Published, not yet merged (guarded by mutex)
+    bool done;                      // Worker finished (guarded by mutex)
+    atomic_bool cancelled;
+} DirectoryStream;
+
+// Append a copy of src_entry (from src) to dest, re-interning its name
+static bool append_entry_copy(DirectoryState *dest, const DirectoryState *src, const FileEntry *src_entry)
+{
+    FileEntry *fe = directory_append_entry(dest, directory_entry_name(src, src_entry));
+    if (!fe) {
+        return false;
+    }
+
+    uint32_t name_offset = fe->name_offset;
+    uint16_t name_len = fe->name_len;
+    *fe = *src_entry;
+    fe->name_offset = name_offset;
+    fe->name_len = name_len;
+    if (fe->ext_len == 0) {
+        dest->names[name_offset + name_len + 1] = '\0';
+    }
+    return true;
 }
 
-static bool ensure_capacity(DirectoryState *state, int needed)
+// Append incoming entries to state, sort them and merge with the sorted prefix
+static void merge_sorted_entries(DirectoryState *state, const DirectoryState *incoming)
 {
-    if (needed <= state->capacity) {
-        return true;
+    int old_count = state->count;
+    for (int i = 0; i < incoming->count; i++) {
+        if (!append_entry_copy(state, incoming, &incoming->entries[i])) {
+            break;
+        }
     }
 
-    int new_capacity = state->capacity == 0 ? INITIAL_CAPACITY : state->capacity * 2;
-    while (new_capacity < needed) {
-        new_capacity *= 2;
+    int added = state->count - old_count;
+    if (added <= 0) {
+        return;
     }
 
-    FileEntry *new_entries = realloc(state->entries, new_capacity * sizeof(FileEntry));
-    if (!new_entries) {
-        return false;
+    sort_entries_internal(state->entries + old_count, added, state->names, SORT_BY_NAME, true);
+    if (old_count == 0) {
+        return;
     }
 
-    state->entries = new_entries;
-    state->capacity = new_capacity;
-    return true;
+    FileEntry *merged = malloc(state->count * sizeof(FileEntry));
+    if (!merged) {
+        sort_entries_internal(state->entries, state->count, state->names, SORT_BY_NAME, true);
+        return;
+    }
+
+    pthread_mutex_lock(&g_sort_mutex);
+    g_sort_by = SORT_BY_NAME;
+    g_sort_ascending = true;
+    g_sort_names = state->names;
+
+    int a = 0, b = old_count, out = 0;
+    while (a < old_count && b < state->count) {
+        if (compare_entries_qsort(&state->entries[a], &state->entries[b]) <= 0) {
+            merged[out++] = state->entries[a++];
+        } else {
+            merged[out++] = state->entries[b++];
+        }
+    }
+    pthread_mutex_unlock(&g_sort_mutex);
+    while (a < old_count) merged[out++] = state->entries[a++];
+    while (b < state->count) merged[out++] = state->entries[b++];
+
+    memcpy(state->entries, merged, state->count * sizeof(FileEntry));
+    free(merged);
 }
 
-static void extract_extension(const char *name, char *extension, size_t ext_size)
+static void merge_entries(DirectoryState *state, const DirectoryState *incoming)
 {
-    extension[0] = '\0';
+    // Merge into the full order, then filter the view again
+    view_restore(state);
+    merge_sorted_entries(state, incoming);
+    view_filter(state);
+    bump_generation(state);  // Entries moved after the appends bumped it
+}
 
-    const char *dot = strrchr(name, '.');
-    if (!dot || dot == name) {
+// Hand a filled batch over to the main thread
+static void stream_publish(DirectoryStream *ds, DirectoryState *batch)
+{
+    if (batch->count == 0) {
         return;
     }
 
-    // Skip the dot and copy extension in lowercase
-    const char *src = dot + 1;
-    size_t i = 0;
-    while (*src && i < ext_size - 1) {
-        char c = *src;
-        if (c >= 'A' && c <= 'Z') {
-            c = c + ('a' - 'A');
+    pthread_mutex_lock(&ds->mutex);
+    if (ds->pending.count == 0) {
+        // Swap buffers instead of copying
+        DirectoryState tmp = ds->pending;
+        ds->pending = *batch;
+        *batch = tmp;
+    } else {
+        for (int i = 0; i < batch->count; i++) {
+            if (!append_entry_copy(&ds->pending, batch, &batch->entries[i])) {
+                break;
+            }
         }
-        extension[i] = c;
-        i++;
-        src++;
     }
-    extension[i] = '\0';
+    pthread_mutex_unlock(&ds->mutex);
+
+    batch->count = 0;
+    batch->names_size = 0;
 }
 
-bool directory_read(DirectoryState *state, const char *path)
+static void *stream_worker(void *arg)
 {
-    state->is_loading = true;
-    state->error_message[0] = '\0';
+    DirectoryStream *ds = (DirectoryStream *)arg;
 
-    // Resolve path and handle special cases
-    char resolved_path[PATH_MAX_LEN];
-    if (path[0] == '~') {
-        const char *home = getenv("HOME");
-        if (home) {
-            snprintf(resolved_path, sizeof(resolved_path), "%s%s", home, path + 1);
-        } else {
-            strncpy(resolved_path, path, sizeof(resolved_path) - 1);
-            resolved_path[sizeof(resolved_path) - 1] = '\0';
+    DirectoryState batch;
+    directory_state_init(&batch);
+
+    // Fill in small steps so cancellation is noticed promptly on slow volumes
+    while (!atomic_load(&ds->cancelled)) {
+        if (reader_fill(&ds->reader, &batch, batch.count + 64) <= 0) {
+            break;
         }
-    } else {
-        if (realpath(path, resolved_path) == NULL) {
-            snprintf(state->error_message, sizeof(state->error_message),
-                     "Cannot resolve path: %s", strerror(errno));
-            state->is_loading = false;
-            return false;
+        if (batch.count >= DIR_STREAM_BATCH) {
+            stream_publish(ds, &batch);
         }
     }
+    stream_publish(ds, &batch);
 
-    DIR *dir = opendir(resolved_path);
-    if (!dir) {
-        snprintf(state->error_message, sizeof(state->error_message),
-                 "Cannot open directory: %s", strerror(errno));
-        state->is_loading = false;
+    reader_close(&ds->reader);
+    directory_state_free(&batch);
+
+    pthread_mutex_lock(&ds->mutex);
+    ds->done = true;
+    pthread_mutex_unlock(&ds->mutex);
+
+    return NULL;
+}
+
+static bool stream_start(DirectoryState *state, DirReader *reader)
+{
+    DirectoryStream *ds = calloc(1, sizeof(DirectoryStream));
+    if (!ds) {
         return false;
     }
 
-    // Clear existing entries
-    state->count = 0;
+    ds->reader = *reader;
+    ds->reader.background = true;
+    ds->reader.cancel = &ds->cancelled;
+    directory_state_init(&ds->pending);
+    atomic_init(&ds->cancelled, false);
+    pthread_mutex_init(&ds->mutex, NULL);
 
-    strncpy(state->current_path, resolved_path, sizeof(state->current_path) - 1);
-    state->current_path[sizeof(state->current_path) - 1] = '\0';
+    if (pthread_create(&ds->thread, NULL, stream_worker, ds) != 0) {
+        pthread_mutex_destroy(&ds->mutex);
+        free(ds);
+        return false;
+    }
 
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip . and ..
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
+    state->stream = ds;
+    return true;
+}
 
-        bool is_hidden = entry->d_name[0] == '.';
-        if (is_hidden && !state->show_hidden) {
-            continue;
-        }
+// Release a stream whose worker has been joined
+static void stream_destroy(DirectoryState *state)
+{
+    DirectoryStream *ds = state->stream;
+    directory_state_free(&ds->pending);
+    pthread_mutex_destroy(&ds->mutex);
+    free(ds);
+    state->stream = NULL;
+    state->is_loading = false;
+}
 
-        if (!ensure_capacity(state, state->count + 1)) {
-            closedir(dir);
-            snprintf(state->error_message, sizeof(state->error_message),
-                     "Out of memory");
-            state->is_loading = false;
-            return false;
-        }
+bool directory_stream_poll(DirectoryState *state)
+{
+    DirectoryStream *ds = state->stream;
+    if (!ds) {
+        return false;
+    }
 
-        FileEntry *fe = &state->entries[state->count];
+    DirectoryState incoming;
+    directory_state_init(&incoming);
 
-        // Build full path
-        snprintf(fe->path, sizeof(fe->path), "%s/%s", resolved_path, entry->d_name);
+    pthread_mutex_lock(&ds->mutex);
+    DirectoryState tmp = ds->pending;
+    ds->pending = incoming;
+    incoming = tmp;
+    bool done = ds->done;
+    pthread_mutex_unlock(&ds->mutex);
 
-        // Copy name
-        strncpy(fe->name, entry->d_name, sizeof(fe->name) - 1);
-        fe->name[sizeof(fe->name) - 1] = '\0';
+    bool changed = false;
+    if (incoming.count > 0) {
+        merge_entries(state, &incoming);
+        changed = true;
+    }
+    directory_state_free(&incoming);
 
-        fe->is_hidden = is_hidden;
+    if (done) {
+        pthread_join(ds->thread, NULL);
+        stream_destroy(state);
+        changed = true;
+    }
 
-        // Get file info with stat
-        struct stat st;
-        if (lstat(fe->path, &st) == 0) {
-            fe->is_symlink = S_ISLNK(st.st_mode);
+    return changed;
+}
 
-            // For symlinks, stat the target
-            if (fe->is_symlink) {
-                struct stat target_st;
-                if (stat(fe->path, &target_st) == 0) {
-                    fe->is_directory = S_ISDIR(target_st.st_mode);
-                    fe->size = target_st.st_size;
-                } else {
-                    // Broken symlink
-                    fe->is_directory = false;
-                    fe->size = 0;
-                }
-            } else {
-                fe->is_directory = S_ISDIR(st.st_mode);
-                fe->size = st.st_size;
-            }
+void directory_stream_wait(DirectoryState *state)
+{
+    DirectoryStream *ds = state->stream;
+    if (!ds) {
+        return;
+    }
 
-            fe->modified = st.st_mtime;
-            fe->created = st.st_birthtime;
-            fe->permissions = st.st_mode;
-        } else {
-            // Stat failed, use defaults
-            fe->is_directory = (entry->d_type == DT_DIR);
-            fe->is_symlink = (entry->d_type == DT_LNK);
-            fe->size = 0;
-            fe->modified = 0;
-            fe->created = 0;
-            fe->permissions = 0;
-        }
-
-        // Extract extension for files
-        if (!fe->is_directory) {
-            extract_extension(fe->name, fe->extension, sizeof(fe->extension));
-        } else {
-            fe->extension[0] = '\0';
-        }
+    pthread_join(ds->thread, NULL);
+    if (ds->pending.count > 0) {
+        merge_entries(state, &ds->pending);
+    }
+    stream_destroy(state);
+}
 
-        state->count++;
+void directory_stream_cancel(DirectoryState *state)
+{
+    DirectoryStream *ds = state->stream;
+    if (!ds) {
+        return;
     }
 
-    closedir(dir);
+    atomic_store(&ds->cancelled, true);
+    pthread_join(ds->thread, NULL);
+    stream_destroy(state);
+}
 
-    // Sort by default (folders first, then alphabetically)
-    directory_sort(state, SORT_BY_NAME, true);
+//=============================================================================
+// Incremental patches: the watch bus names the entries that changed, so only
+// those are stat'ed and moved instead of reading and sorting the whole folder
+//=============================================================================
 
-    state->is_loading = false;
+static int compare_name_ptrs(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// Helper: Index of name in sorted (count names), or -1
+static int find_name(const char *const *sorted, int count, const char *name)
+{
+    const char *const *hit = bsearch(&name, sorted, count, sizeof(const char *), compare_name_ptrs);
+    return hit ? (int)(hit - sorted) : -1;
+}
+
+// Copy the names of the current entries into a fresh arena, leaving behind those of
+// entries that were removed. Returns false on OOM, changing nothing
+static bool names_repack(DirectoryState *state)
+{
+    int total = state->count + state->hidden_count;
+    char *names = memory_alloc(MEMORY_TAG_DIRECTORY, state->names_capacity);
+    if (!names) {
+        return false;
+    }
+    size_t size = 0;
+    for (int i = 0; i < total; i++) {
+        FileEntry *fe = &state->entries[i];
+        size_t bytes = (size_t)fe->name_len + fe->ext_len + 2;
+        memcpy(names + size, state->names + fe->name_offset, bytes);
+        fe->name_offset = (uint32_t)size;
+        size += bytes;
+    }
+    memory_free(MEMORY_TAG_DIRECTORY, state->names);
+    state->names = names;
+    state->names_size = size;
     return true;
 }
 
-// Sort context (using globals since qsort doesn't have context parameter)
-static SortBy g_sort_by = SORT_BY_NAME;
-static bool g_sort_ascending = true;
+// Merge the name-sorted entries from first on into the sorted ones before it: each goes
+// where a binary search of the rest puts it. Returns false on OOM
+static bool merge_tail(DirectoryState *state, int first)
+{
+    int count = state->count;
+    sort_entries_internal(state->entries + first, count - first, state->names, SORT_BY_NAME, true);
+    FileEntry *merged = malloc((size_t)count * sizeof(FileEntry));
+    if (!merged) {
+        return false;
+    }
 
-static int compare_entries_qsort(const void *a, const void *b)
+    pthread_mutex_lock(&g_sort_mutex);
+    g_sort_by = SORT_BY_NAME;
+    g_sort_ascending = true;
+    g_sort_names = state->names;
+
+    int from = 0, out = 0;
+    for (int t = first; t < count; t++) {
+        // First of entries[from..first) that sorts after the new entry
+        int lo = from, hi = first;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (compare_entries_qsort(&state->entries[mid], &state->entries[t]) <= 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        memcpy(merged + out, state->entries + from, (size_t)(lo - from) * sizeof(FileEntry));
+        out += lo - from;
+        merged[out++] = state->entries[t];
+        from = lo;
+    }
+    pthread_mutex_unlock(&g_sort_mutex);
+    memcpy(merged + out, state->entries + from, (size_t)(first - from) * sizeof(FileEntry));
+
+    memcpy(state->entries, merged, (size_t)count * sizeof(FileEntry));
+    free(merged);
+    return true;
+}
+
+int directory_apply_changes(DirectoryState *state, const char *const *names, int count)
 {
-    const FileEntry *fa = (const FileEntry *)a;
-    const FileEntry *fb = (const FileEntry *)b;
+    TRACE_SCOPE("directory_apply_changes");
+    if (count <= 0) {
+        return 0;
+    }
+    if (state->stream) {
+        return -1;  // Still being read: the read sees the changes
+    }
 
-    // Directories always come first
-    if (fa->is_directory && !fb->is_directory) {
+    // The changed names, sorted without repeats, and the entry each one names (-1: new)
+    const char **sorted = malloc((size_t)count * sizeof(const char *));
+    int *found = malloc((size_t)count * sizeof(int));
+    if (!sorted || !found || !view_restore(state) || !directory_state_make_writable(state)) {
+        free(sorted);
+        free(found);
         return -1;
     }
-    if (!fa->is_directory && fb->is_directory) {
-        return 1;
+    memcpy(sorted, names, (size_t)count * sizeof(const char *));
+    qsort(sorted, count, sizeof(const char *), compare_name_ptrs);
+    int unique = 0;
+    for (int k = 0; k < count; k++) {
+        if (unique == 0 || strcmp(sorted[unique - 1], sorted[k]) != 0) {
+            sorted[unique++] = sorted[k];
+        }
+    }
+    count = unique;
+    for (int k = 0; k < count; k++) {
+        found[k] = -1;
     }
 
-    int result = 0;
+    size_t live_bytes = 0;
+    for (int i = 0; i < state->count; i++) {
+        const FileEntry *fe = &state->entries[i];
+        live_bytes += (size_t)fe->name_len + fe->ext_len + 2;
+        int k = find_name(sorted, count, directory_entry_name(state, fe));
+        if (k >= 0) {
+            found[k] = i;
+        }
+    }
 
-    switch (g_sort_by) {
-        case SORT_BY_NAME:
-            result = strcasecmp(fa->name, fb->name);
-            break;
-        case SORT_BY_SIZE:
-            if (fa->size < fb->size) result = -1;
-            else if (fa->size > fb->size) result = 1;
-            else result = 0;
-            break;
-        case SORT_BY_MODIFIED:
-            if (fa->modified < fb->modified) result = -1;
-            else if (fa->modified > fb->modified) result = 1;
-            else result = 0;
-            break;
-        case SORT_BY_TYPE:
-            result = strcasecmp(fa->extension, fb->extension);
-            if (result == 0) {
-                result = strcasecmp(fa->name, fb->name);
+    // Update entries still there in place; the rest leave, and those that became or
+    // stopped being directories come back in below at their new place
+    int changed = 0;
+    int removed = 0;
+    for (int k = 0; k < count; k++) {
+        if (found[k] < 0) {
+            continue;
+        }
+        FileEntry *fe = &state->entries[found[k]];
+        FileEntry updated = *fe;
+        if (stat_entry(state, state->current_path, &updated) && updated.is_directory == fe->is_directory) {
+            if (memcmp(&updated, fe, sizeof(FileEntry)) != 0) {
+                *fe = updated;
+                changed++;
             }
-            break;
+            found[k] = -2;      // Done with it
+        } else {
+            fe->name_len = 0;   // Marks it for removal
+            removed++;
+        }
+    }
+    if (removed > 0) {
+        int kept = 0;
+        for (int i = 0; i < state->count; i++) {
+            if (state->entries[i].name_len > 0) {
+                state->entries[kept++] = state->entries[i];
+            }
+        }
+        state->count = kept;
+        changed += removed;
     }
 
-    return g_sort_ascending ? result : -result;
+    // Drop the names of removed entries once they are most of the arena
+    if (state->names_size > INITIAL_NAMES_CAPACITY && live_bytes < state->names_size / 2) {
+        names_repack(state);
+    }
+
+    // New entries (and moved ones) are appended, then merged into the order
+    int first = state->count;
+    bool ok = true;
+    for (int k = 0; k < count && ok; k++) {
+        if (found[k] == -2 || strchr(sorted[k], '/') || sorted[k][0] == '\0') {
+            continue;
+        }
+        size_t names_size = state->names_size;
+        if (!ensure_names_capacity(state, names_size + strlen(sorted[k]) + EXTENSION_MAX_LEN + 1) ||
+            !ensure_capacity(state, state->count + 1)) {
+            ok = false;
+        } else if (directory_append_file(state, sorted[k]) && found[k] < 0) {
+            changed++;          // Moved entries were counted when they left
+        }
+    }
+    ok = ok && (state->count == first || merge_tail(state, first));
+
+    free(sorted);
+    free(found);
+    if (changed > 0 || !ok) {
+        sort_cache_drop(state);
+        bump_generation(state);
+    }
+    view_filter(state);
+    return ok ? changed : -1;
 }
 
-static void sort_entries_internal(FileEntry *entries, int count, SortBy sort_by, bool ascending)
+typedef struct ListingMark {
+    const char *name;                   // Into ListingMarks.names
+    int slot;                           // Position in the indices taken
+} ListingMark;
+
+struct ListingMarks {
+    int count;                          // Indices taken
+    int mark_count;                     // Of them, entries that existed
+    ListingMark *marks;                 // Sorted by name
+    char *names;
+};
+
+static int listing_mark_compare(const void *a, const void *b)
 {
-    if (count <= 1) return;
+    return strcmp(((const ListingMark *)a)->name, ((const ListingMark *)b)->name);
+}
 
-    // Set global sort parameters
-    g_sort_by = sort_by;
-    g_sort_ascending = ascending;
+ListingMarks *listing_marks_take(const DirectoryState *state, const int *indices, int count)
+{
+    size_t names_size = 1;
+    for (int i = 0; i < count; i++) {
+        if (indices[i] >= 0 && indices[i] < state->count) {
+            names_size += strlen(directory_entry_name(state, &state->entries[indices[i]])) + 1;
+        }
+    }
+    ListingMarks *marks = calloc(1, sizeof(ListingMarks));
+    if (marks == NULL) {
+        return NULL;
+    }
+    marks->marks = malloc((size_t)(count > 0 ? count : 1) * sizeof(ListingMark));
+    marks->names = malloc(names_size);
+    if (marks->marks == NULL || marks->names == NULL) {
+        listing_marks_free(marks);
+        return NULL;
+    }
 
-    // Use standard qsort for O(n log n) performance
-    qsort(entries, count, sizeof(FileEntry), compare_entries_qsort);
+    // The names move (or are repacked) with the change, so the marks hold copies
+    marks->count = count;
+    size_t used = 0;
+    for (int i = 0; i < count; i++) {
+        if (indices[i] < 0 || indices[i] >= state->count) {
+            continue;
+        }
+        const char *name = directory_entry_name(state, &state->entries[indices[i]]);
+        size_t length = strlen(name) + 1;
+        memcpy(marks->names + used, name, length);
+        marks->marks[marks->mark_count++] = (ListingMark){ marks->names + used, i };
+        used += length;
+    }
+    qsort(marks->marks, (size_t)marks->mark_count, sizeof(ListingMark), listing_mark_compare);
+    return marks;
 }
 
-void directory_sort(DirectoryState *state, SortBy sort_by, bool ascending)
+void listing_marks_find(const ListingMarks *marks, const DirectoryState *state, int *indices)
 {
-    if (state->count <= 1) {
-        return;
+    for (int i = 0; i < marks->count; i++) {
+        indices[i] = -1;
     }
 
-    sort_entries_internal(state->entries, state->count, sort_by, ascending);
+    // One pass over the new order finds every marked name; names are unique in a folder
+    int found = 0;
+    for (int i = 0; i < state->count && found < marks->mark_count; i++) {
+        ListingMark key = { .name = directory_entry_name(state, &state->entries[i]) };
+        ListingMark *hit = bsearch(&key, marks->marks, (size_t)marks->mark_count, sizeof(ListingMark),
+                                   listing_mark_compare);
+        if (hit == NULL) {
+            continue;
+        }
+        while (hit > marks->marks && strcmp(hit[-1].name, key.name) == 0) {
+            hit--;
+        }
+        for (; hit < marks->marks + marks->mark_count && strcmp(hit->name, key.name) == 0; hit++) {
+            indices[hit->slot] = i;
+            found++;
+        }
+    }
+}
+
+void listing_marks_free(ListingMarks *marks)
+{
+    if (marks == NULL) {
+        return;
+    }
+    free(marks->marks);
+    free(marks->names);
+    free(marks);
 }
 
 bool directory_go_parent(DirectoryState *state)
@@ -286,6 +2118,11 @@ bool directory_go_parent(DirectoryState *state)
     return directory_read(state, parent_path);
 }
 
+bool directory_entry_enterable(const DirectoryState *state, const FileEntry *entry)
+{
+    return entry->is_directory || archive_is_archive_name(directory_entry_name(state, entry));
+}
+
 bool directory_enter(DirectoryState *state, int index)
 {
     if (index < 0 || index >= state->count) {
@@ -293,17 +2130,41 @@ bool directory_enter(DirectoryState *state, int index)
     }
 
     FileEntry *entry = &state->entries[index];
-    if (!entry->is_directory) {
+    if (!directory_entry_enterable(state, entry)) {
+        return false;
+    }
+
+    char path[PATH_MAX_LEN];
+    directory_entry_path(state, entry, path, sizeof(path));
+    return directory_read(state, path);
+}
+
+bool directory_set_show_hidden(DirectoryState *state, bool show_hidden)
+{
+    if (!directory_view_available(state, show_hidden)) {
         return false;
     }
+    if (show_hidden == state->show_hidden) {
+        return true;
+    }
 
-    return directory_read(state, entry->path);
+    // The hidden entries are in memory, in order: only the view changes
+    state->show_hidden = show_hidden;
+    bool ok = show_hidden ? view_restore(state) : view_filter(state);
+    if (!ok) {
+        state->show_hidden = !show_hidden;
+    }
+    return ok;
 }
 
 void directory_toggle_hidden(DirectoryState *state)
 {
+    if (directory_set_show_hidden(state, !state->show_hidden)) {
+        return;
+    }
+
+    // Hidden entries were not kept (or no memory to move them): re-read current directory
     state->show_hidden = !state->show_hidden;
-    // Re-read current directory
     if (state->current_path[0] != '\0') {
         directory_read(state, state->current_path);
     }
@@ -339,6 +2200,40 @@ void format_modified_time(time_t time_val, char *buffer, size_t buffer_size)
     }
 }
 
+// Memoized strings, direct-mapped by value (main thread only)
+static struct {
+    struct { off_t size; bool used; char text[24]; } sizes[FORMAT_CACHE_SLOTS];
+    struct { time_t time; bool used; char text[32]; } dates[FORMAT_CACHE_SLOTS];
+} g_format_cache;
+
+// Helper: Slot for a value in a memo table
+static unsigned int format_cache_slot(uint64_t value)
+{
+    return (unsigned int)((value * 0x9E3779B97F4A7C15ull) >> 32) & (FORMAT_CACHE_SLOTS - 1);
+}
+
+const char *format_file_size_cached(off_t size)
+{
+    unsigned int slot = format_cache_slot((uint64_t)size);
+    if (!g_format_cache.sizes[slot].used || g_format_cache.sizes[slot].size != size) {
+        format_file_size(size, g_format_cache.sizes[slot].text, sizeof(g_format_cache.sizes[slot].text));
+        g_format_cache.sizes[slot].size = size;
+        g_format_cache.sizes[slot].used = true;
+    }
+    return g_format_cache.sizes[slot].text;
+}
+
+const char *format_modified_time_cached(time_t time_val)
+{
+    unsigned int slot = format_cache_slot((uint64_t)time_val);
+    if (!g_format_cache.dates[slot].used || g_format_cache.dates[slot].time != time_val) {
+        format_modified_time(time_val, g_format_cache.dates[slot].text, sizeof(g_format_cache.dates[slot].text));
+        g_format_cache.dates[slot].time = time_val;
+        g_format_cache.dates[slot].used = true;
+    }
+    return g_format_cache.dates[slot].text;
+}
+
 off_t get_free_disk_space(const char *path)
 {
     struct statvfs stat;
@@ -354,14 +2249,73 @@ void directory_state_copy(DirectoryState *dest, const DirectoryState *src)
     strncpy(dest->current_path, src->current_path, PATH_MAX_LEN - 1);
     dest->current_path[PATH_MAX_LEN - 1] = '\0';
     dest->show_hidden = src->show_hidden;
+    dest->hidden_listed = src->hidden_listed;
     dest->is_loading = false;
 
-    if (src->count > 0 && src->entries) {
-        if (ensure_capacity(dest, src->count)) {
-            memcpy(dest->entries, src->entries, src->count * sizeof(FileEntry));
-            dest->count = src->count;
+    if (src->count + src->hidden_count > 0 && src->entries && src->storage) {
+        // Share the buffers; whichever side writes first copies them
+        atomic_fetch_add(&src->storage->refs, 1);
+        dest->entries = src->entries;
+        dest->names = src->names;
+        dest->storage = src->storage;
+        dest->count = src->count;
+        dest->hidden_count = src->hidden_count;
+        dest->capacity = src->capacity;
+        dest->names_size = src->names_size;
+        dest->names_capacity = src->names_capacity;
+        dest->generation = src->generation;
+    }
+
+    if (dest->hidden_count > 0) {
+        // The view is private. Without its mask the left-out entries cannot be put
+        // back in place, so dest lists them all, the left-out ones last
+        size_t mask_bytes = (size_t)(src->count + src->hidden_count + 63) / 64 * sizeof(uint64_t);
+        dest->view_mask = memory_alloc(MEMORY_TAG_DIRECTORY, mask_bytes);
+        if (dest->view_mask) {
+            memcpy(dest->view_mask, src->view_mask, mask_bytes);
+        } else {
+            dest->count += dest->hidden_count;
+            dest->hidden_count = 0;
+            dest->show_hidden = true;
+            bump_generation(dest);
+        }
+    }
+}
+
+bool directory_state_restore(DirectoryState *state, const char *path, const FileEntry *entries,
+                             int count, const char *names, size_t names_size)
+{
+    strncpy(state->current_path, path, PATH_MAX_LEN - 1);
+    state->current_path[PATH_MAX_LEN - 1] = '\0';
+    if (count < 0 || (count > 0 && (!entries || !names))) {
+        return false;
+    }
+
+    // Every name and extension must end inside the arena
+    for (int i = 0; i < count; i++) {
+        const FileEntry *fe = &entries[i];
+        size_t end = (size_t)fe->name_offset + fe->name_len + fe->ext_len + 2;
+        if (end > names_size || names[end - 1] != '\0' || names[fe->name_offset + fe->name_len] != '\0') {
+            return false;
         }
     }
+
+    if (count == 0) {
+        state->hidden_listed = state->show_hidden;
+        bump_generation(state);
+        return true;
+    }
+    if (!ensure_capacity(state, count) || !ensure_names_capacity(state, names_size)) {
+        directory_state_free(state);
+        return false;
+    }
+    memcpy(state->entries, entries, (size_t)count * sizeof(FileEntry));
+    memcpy(state->names, names, names_size);
+    state->count = count;
+    state->names_size = names_size;
+    state->hidden_listed = state->show_hidden;
+    bump_generation(state);
+    return true;
 }
 
 bool directory_read_cached(DirectoryState *state, const char *path, struct DirCache *cache)
@@ -371,20 +2325,24 @@ bool directory_read_cached(DirectoryState *state, const char *path, struct DirCa
         return directory_read(state, path);
     }
 
-    // Try to get from cache
+    // Try to get from cache (any hidden-file setting, as long as the view can change to ours)
     DirectoryState *cached = dir_cache_get(cache, path);
-    if (cached) {
+    if (cached && directory_view_available(cached, state->show_hidden)) {
         // Copy cached result to state
+        bool streaming = state->streaming;
+        bool show_hidden = state->show_hidden;
         directory_state_free(state);
         directory_state_copy(state, cached);
+        directory_set_show_hidden(state, show_hidden);
+        state->streaming = streaming;
         return true;
     }
 
     // Not in cache, read from disk
     bool result = directory_read(state, path);
 
-    // Store in cache if successful
-    if (result) {
+    // Store in cache if successful (partial listings are not cached)
+    if (result && !state->is_loading) {
         dir_cache_put(cache, path, state);
     }
 
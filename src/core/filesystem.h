@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <time.h>
 #include <sys/types.h>
 
@@ -10,6 +11,14 @@
 #define NAME_MAX_LEN 256
 #define EXTENSION_MAX_LEN 32
 
+// Streaming directory reads (see DirectoryState.streaming)
+#define DIR_STREAM_FIRST_BATCH 500  // Entries read synchronously before handing off
+#define DIR_STREAM_BATCH 2000       // Entries per batch published by the worker
+#define DIR_METADATA_THREADS_DEFAULT 8  // lstat workers when no bulk API is available
+#define DIR_METADATA_THREADS_MAX 64
+
+#define FORMAT_CACHE_SLOTS 512          // Memoized size and date strings (each)
+
 // Git file status (matches git.h GitFileStatus)
 typedef enum FileGitStatus {
     FILE_GIT_NONE = 0,
@@ -23,31 +32,94 @@ typedef enum FileGitStatus {
 } FileGitStatus;
 
 // File entry representing a single file or directory
+// Strings live in the owning DirectoryState's name arena; use the
+// directory_entry_* accessors below to read them.
 typedef struct FileEntry {
-    char path[PATH_MAX_LEN];        // Full path
-    char name[NAME_MAX_LEN];        // File/folder name
-    char extension[EXTENSION_MAX_LEN]; // File extension (lowercase, no dot)
-    bool is_directory;
-    bool is_hidden;
-    bool is_symlink;
+    // Hot: read for every entry by sorting, totals and the list rows
     off_t size;                     // Size in bytes
     time_t modified;                // Last modified time
+    uint32_t name_offset;           // Offset of the name in DirectoryState.names
+    uint16_t name_len;              // Name length in bytes (excluding NUL)
+    uint8_t ext_len;                // Extension length (stored right after the name)
+    bool is_directory : 1;
+    bool is_hidden : 1;
+    bool is_symlink : 1;
+    uint8_t git_status;             // FileGitStatus
+    uint8_t file_type;              // FileTypeId of the extension (utils/file_type.h)
+    // Cold: only read for a single entry (info panel, attributes)
+    uint16_t permissions;           // st_mode (type and permission bits fit in 16)
     time_t created;                 // Creation time (if available)
-    mode_t permissions;
-    FileGitStatus git_status;       // Git status for this file
 } FileEntry;
 
-// Directory state holding all entries
+// Background enumeration of a directory (private to filesystem.c)
+struct DirectoryStream;
+
+// Reference count for entries/names (private to filesystem.c)
+struct DirectoryStorage;
+
+// Sort keys and permutations kept between directory_sort calls (private to filesystem.c)
+struct DirectorySortCache;
+
+// Temporary allocations (utils/arena.h)
+struct Arena;
+
+// DirectoryColumns.flags bits
+#define DIR_COLUMN_DIRECTORY 0x01
+#define DIR_COLUMN_HIDDEN 0x02
+#define DIR_COLUMN_SYMLINK 0x04
+
+// The hot entry fields as parallel arrays in current entry order, for passes over a
+// whole listing that want one field (sizes for totals, times, flags) without striding
+// over the rest of each entry. Built on demand and rebuilt once entries change
+typedef struct DirectoryColumns {
+    int count;
+    uint32_t generation;            // DirectoryState.generation they were built from
+    off_t *sizes;
+    time_t *mtimes;
+    uint32_t *name_offsets;
+    uint8_t *flags;                 // DIR_COLUMN_* bits
+    uint8_t *file_types;            // FileTypeId
+    uint8_t *git_status;            // FileGitStatus (kept current by directory_set_git_status)
+} DirectoryColumns;
+
+// Directory state holding all entries. Hidden entries are always read and kept; the
+// view shows entries[0..count) and keeps the ones it filters out (hidden files while
+// show_hidden is off) in entries[count..count + hidden_count), so changing what the
+// view shows is O(n) in memory and never reads the directory again
 typedef struct DirectoryState {
     FileEntry *entries;
-    int count;
+    int count;                      // Entries in the view
+    int hidden_count;               // Entries filtered out of the view, kept after them
+    uint64_t *view_mask;            // Bit i set if position i of the full order is filtered out
     int capacity;
+    char *names;                    // String arena: "name\0ext\0" per entry
+    size_t names_size;              // Bytes used in names
+    size_t names_capacity;          // Bytes allocated for names
+    struct DirectoryStorage *storage; // Shared with copies; read-only while shared
     char current_path[PATH_MAX_LEN];
     bool show_hidden;
-    bool is_loading;
+    bool hidden_listed;             // Hidden entries were read (not so for a restored view)
+    bool is_loading;                // True while a background enumeration is running
+    bool streaming;                 // Read large directories in the background
+    struct DirectoryStream *stream; // In-flight enumeration (NULL if none)
+    struct DirectorySortCache *sort_cache; // Dropped whenever entries are added
+    uint32_t generation;            // Changes whenever entries change; copies keep it
+    DirectoryColumns *columns;      // Built by directory_columns (NULL until then)
     char error_message[256];
 } DirectoryState;
 
+// Entry name (e.g. "main.c")
+static inline const char *directory_entry_name(const DirectoryState *state, const FileEntry *entry)
+{
+    return state->names + entry->name_offset;
+}
+
+// Entry extension (lowercase, no dot, "" if none)
+static inline const char *directory_entry_extension(const DirectoryState *state, const FileEntry *entry)
+{
+    return state->names + entry->name_offset + entry->name_len + 1;
+}
+
 // Sort options for directory entries
 typedef enum SortBy {
     SORT_BY_NAME,
@@ -64,18 +136,111 @@ void directory_state_free(DirectoryState *state);
 
 // Read directory contents into state
 // Returns true on success, false on error (check state->error_message)
+// With state->streaming set, only the first DIR_STREAM_FIRST_BATCH entries are
+// read before returning; the rest arrive through directory_stream_poll()
 bool directory_read(DirectoryState *state, const char *path);
 
-// Sort entries in directory state
+// Merge entries published by a background enumeration (call once per frame)
+// Returns true if entries were added or loading finished
+bool directory_stream_poll(DirectoryState *state);
+
+// Block until a background enumeration finishes and merge all its entries
+void directory_stream_wait(DirectoryState *state);
+
+// Stop a background enumeration, keeping the entries merged so far
+void directory_stream_cancel(DirectoryState *state);
+
+// Set how many threads stat entries in parallel on the readdir path
+// (clamped to 1..DIR_METADATA_THREADS_MAX; 1 disables the pool)
+void directory_set_metadata_threads(int threads);
+
+// Give state its own entries/names before writing to them in place
+// (copies them only if another state still shares them). Returns false on OOM
+bool directory_state_make_writable(DirectoryState *state);
+
+// Append an entry named `name` (name and extension interned in the arena)
+// Returns the zeroed entry for the caller to fill in, or NULL on OOM
+FileEntry *directory_append_entry(DirectoryState *state, const char *name);
+
+// Append name (a path below current_path may have several parts) and fill in its metadata
+// with lstat. Returns the entry, or NULL on OOM or if there is nothing at that path
+FileEntry *directory_append_file(DirectoryState *state, const char *name);
+
+// Remove the entry at index of the full order (the view, when nothing is filtered out of
+// it), moving the last entry into its place; its name stays in the arena. False on OOM
+// or a bad index
+bool directory_remove_entry(DirectoryState *state, int index);
+
+// Patch a listing in directory_read's order for names directly inside current_path that
+// were created, deleted, modified or renamed: only those are stat'ed, entries gone from
+// disk are removed, changed ones updated in place and new ones inserted at their place
+// by binary search. Returns how many entries changed, or -1 if the folder should be read
+// again instead (OOM, or still streaming in)
+int directory_apply_changes(DirectoryState *state, const char *const *names, int count);
+
+// Entries followed by name across a change that reorders the listing (a streamed batch
+// merged in, a patch), so a cursor or selection stays on the same files
+typedef struct ListingMarks ListingMarks;
+
+// Remember the names of the entries at indices (ones out of range are remembered as
+// gone); NULL if out of memory
+ListingMarks *listing_marks_take(const DirectoryState *state, const int *indices, int count);
+
+// Where each remembered entry is now, in the order taken (-1: gone)
+void listing_marks_find(const ListingMarks *marks, const DirectoryState *state, int *indices);
+
+void listing_marks_free(ListingMarks *marks);
+
+// Build the full path of an entry (current_path + "/" + name) into buffer
+// Returns buffer for convenience
+const char *directory_entry_path(const DirectoryState *state, const FileEntry *entry,
+                                 char *buffer, size_t buffer_size);
+
+// Build full paths for the given entry indices into one allocation from arena
+// (malloc'd when arena is NULL: free() it)
+// Fills paths[0..count-1] with pointers into the returned block
+// Returns NULL on OOM or if count is 0
+char *directory_collect_paths(const DirectoryState *state, const int *indices, int count,
+                              const char **paths, struct Arena *arena);
+
+// Bytes held by the entries and name arena of a directory state
+size_t directory_state_bytes(const DirectoryState *state);
+
+// Column arrays for the current entries (built now if missing or stale); NULL on OOM
+const DirectoryColumns *directory_columns(DirectoryState *state);
+
+// Set the git badge of entry index (copying shared entries first); false on OOM
+bool directory_set_git_status(DirectoryState *state, int index, uint8_t status);
+
+// Total size of the files whose bits are set in mask (bit i for entry i, words 64-bit
+// words; directories add nothing); *files (may be NULL) gets how many files there were
+off_t directory_sum_sizes(DirectoryState *state, const uint64_t *mask, int words, int *files);
+
+// Sort entries in directory state (directories first), including those filtered out of the view
+// Switching back to an order already computed for this listing is O(n)
 void directory_sort(DirectoryState *state, SortBy sort_by, bool ascending);
 
 // Navigate to parent directory
 bool directory_go_parent(DirectoryState *state);
 
-// Navigate into a subdirectory (by index)
+// Whether an entry opens as a folder: directories, and archives browsed as folders
+// (core/archive.h), whose paths list their members
+bool directory_entry_enterable(const DirectoryState *state, const FileEntry *entry);
+
+// Navigate into a subdirectory or archive (by index)
 bool directory_enter(DirectoryState *state, int index);
 
-// Toggle showing hidden files
+// Show or filter out hidden files without reading the directory again
+// Returns false, changing nothing, if state was restored without its hidden entries
+bool directory_set_show_hidden(DirectoryState *state, bool show_hidden);
+
+// Whether state can show hidden files as asked without reading the directory again
+static inline bool directory_view_available(const DirectoryState *state, bool show_hidden)
+{
+    return show_hidden == state->show_hidden || state->hidden_listed;
+}
+
+// Toggle showing hidden files (reads again only if the hidden entries are not kept)
 void directory_toggle_hidden(DirectoryState *state);
 
 // Get file size as human-readable string (e.g., "4.2 KB")
@@ -84,6 +249,11 @@ void format_file_size(off_t size, char *buffer, size_t buffer_size);
 // Get modified time as human-readable string (e.g., "Jan 10, 2024")
 void format_modified_time(time_t time, char *buffer, size_t buffer_size);
 
+// The same strings, formatted once per value and kept for the rows drawn every frame.
+// Main thread; the string is valid until the next call
+const char *format_file_size_cached(off_t size);
+const char *format_modified_time_cached(time_t time);
+
 // Get free disk space for a path
 off_t get_free_disk_space(const char *path);
 
@@ -94,7 +264,14 @@ struct DirCache;
 // Checks cache first, reads from disk if not cached, then stores in cache
 bool directory_read_cached(DirectoryState *state, const char *path, struct DirCache *cache);
 
-// Copy directory state (deep copy)
+// Copy directory state; dest shares src's entries until either is modified
 void directory_state_copy(DirectoryState *dest, const DirectoryState *src);
 
+// Fill a freshly initialized state with a listing saved earlier: count entries in
+// their saved order and the name arena they point into (both copied). The entries are
+// taken as the whole view, so hidden files are only kept if show_hidden was set. Returns false,
+// leaving state empty, on OOM or if an entry points outside names
+bool directory_state_restore(DirectoryState *state, const char *path, const FileEntry *entries,
+                             int count, const char *names, size_t names_size);
+
 #endif // FILESYSTEM_H
@@ -0,0 +1,758 @@
+#include "filter_query.h"
+#include "../utils/file_type.h"
+#include "../utils/simd.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+// 64-bit compares for the range kernel (byte kernels go through simd.h)
+#if defined(SIMD_SSE2) && defined(__SSE4_2__)
+#include <nmmintrin.h>
+#define FILTER_SSE42 1
+#endif
+
+#define DAY_SECONDS 86400
+
+// Names accepted by kind:, by FileTypeClass
+static const char *const CLASS_NAMES[FILE_CLASS_COUNT] = {
+    [FILE_CLASS_TEXT] = "text",
+    [FILE_CLASS_MARKDOWN] = "markdown",
+    [FILE_CLASS_CODE] = "code",
+    [FILE_CLASS_DATA] = "data",
+    [FILE_CLASS_DOCUMENT] = "document",
+    [FILE_CLASS_SPREADSHEET] = "spreadsheet",
+    [FILE_CLASS_PRESENTATION] = "presentation",
+    [FILE_CLASS_IMAGE] = "image",
+    [FILE_CLASS_VIDEO] = "video",
+    [FILE_CLASS_AUDIO] = "audio",
+    [FILE_CLASS_ARCHIVE] = "archive",
+    [FILE_CLASS_INSTALLER] = "installer",
+    [FILE_CLASS_DATABASE] = "database",
+    [FILE_CLASS_FONT] = "font",
+    [FILE_CLASS_APPLICATION] = "application",
+};
+
+// Names accepted by git:, by FileGitStatus
+static const char *const GIT_NAMES[] = {
+    [FILE_GIT_NONE] = "clean",
+    [FILE_GIT_UNTRACKED] = "untracked",
+    [FILE_GIT_MODIFIED] = "modified",
+    [FILE_GIT_STAGED] = "staged",
+    [FILE_GIT_DELETED] = "deleted",
+    [FILE_GIT_RENAMED] = "renamed",
+    [FILE_GIT_CONFLICT] = "conflict",
+    [FILE_GIT_IGNORED] = "ignored",
+};
+
+// One file's fields, for checking terms outside a listing
+typedef struct FilterRow {
+    int64_t size;
+    int64_t modified;
+    uint8_t flags;                      // DIR_COLUMN_* bits
+    uint8_t file_type;
+    uint8_t git_status;
+    const char *extension;              // Lower case, "" if none
+} FilterRow;
+
+//=============================================================================
+// Compiling
+//=============================================================================
+
+// Helper: Record why a term was skipped (the first reason only)
+static void set_error(FilterQuery *query, const char *word, const char *reason)
+{
+    if (query->error[0] == '\0') {
+        snprintf(query->error, sizeof(query->error), "%s: %s", word, reason);
+    }
+}
+
+// Helper: Parse "50MB", "1.5g", "200" into bytes
+static bool parse_size(const char *text, int64_t *bytes)
+{
+    char *end;
+    double number = strtod(text, &end);
+    if (end == text || number < 0) {
+        return false;
+    }
+
+    // "", "b", or a prefix with an optional "b" or "ib": "k", "kb", "kib"
+    double scale = 1;
+    const char *prefix = *end ? strchr("kmgt", tolower((unsigned char)*end)) : NULL;
+    if (prefix) {
+        for (const char *p = "kmgt"; p <= prefix; p++) {
+            scale *= 1024.0;
+        }
+        end++;
+        if (tolower((unsigned char)*end) == 'i' && tolower((unsigned char)end[1]) == 'b') end++;
+    }
+    if (tolower((unsigned char)*end) == 'b') end++;
+    if (*end != '\0' || number * scale > (double)INT64_MAX / 2) {
+        return false;
+    }
+    *bytes = (int64_t)(number * scale + 0.5);
+    return true;
+}
+
+// Helper: Parse "30d", "2w", "90min" into seconds
+static bool parse_age(const char *text, int64_t *seconds)
+{
+    char *end;
+    double number = strtod(text, &end);
+    if (end == text || number < 0) {
+        return false;
+    }
+
+    double unit;
+    if (strcasecmp(end, "s") == 0) unit = 1;
+    else if (strcasecmp(end, "m") == 0 || strcasecmp(end, "min") == 0) unit = 60;
+    else if (strcasecmp(end, "h") == 0) unit = 3600;
+    else if (strcasecmp(end, "d") == 0 || *end == '\0') unit = DAY_SECONDS;
+    else if (strcasecmp(end, "w") == 0) unit = 7.0 * DAY_SECONDS;
+    else if (strcasecmp(end, "mo") == 0) unit = 30.0 * DAY_SECONDS;
+    else if (strcasecmp(end, "y") == 0) unit = 365.0 * DAY_SECONDS;
+    else return false;
+
+    if (number * unit > (double)INT32_MAX * 64) {
+        return false;
+    }
+    *seconds = (int64_t)(number * unit);
+    return true;
+}
+
+// Helper: Parse "2024-01-31" into local midnight
+static bool parse_date(const char *text, int64_t *start)
+{
+    int year, month, day;
+    char tail;
+    if (sscanf(text, "%4d-%2d-%2d%c", &year, &month, &day, &tail) != 3 ||
+        month < 1 || month > 12 || day < 1 || day > 31) {
+        return false;
+    }
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_isdst = -1;
+    time_t t = mktime(&tm);
+    if (t == (time_t)-1) {
+        return false;
+    }
+    *start = (int64_t)t;
+    return true;
+}
+
+// Helper: Range [min, max] of values that compare to value as op (a span of values for dates)
+static void set_range(FilterTerm *term, const char *op, int64_t value, int64_t span)
+{
+    int64_t last = value + span - 1;
+    if (strcmp(op, "<") == 0) {
+        term->min = INT64_MIN;
+        term->max = value - 1;
+    } else if (strcmp(op, "<=") == 0) {
+        term->min = INT64_MIN;
+        term->max = last;
+    } else if (strcmp(op, ">") == 0) {
+        term->min = last + 1;
+        term->max = INT64_MAX;
+    } else if (strcmp(op, ">=") == 0) {
+        term->min = value;
+        term->max = INT64_MAX;
+    } else {
+        term->min = value;
+        term->max = last;
+    }
+}
+
+// Helper: Split a comma-separated value list; false if empty or too long
+static bool each_value(FilterQuery *query, const char *word, const char *values,
+                       bool (*add)(FilterTerm *, const char *), FilterTerm *term)
+{
+    char copy[FILTER_MAX_TEXT];
+    snprintf(copy, sizeof(copy), "%s", values);
+    char *save = NULL;
+    bool any = false;
+    for (char *value = strtok_r(copy, ",", &save); value; value = strtok_r(NULL, ",", &save)) {
+        if (!add(term, value)) {
+            set_error(query, word, "unknown value");
+            return false;
+        }
+        any = true;
+    }
+    if (!any) {
+        set_error(query, word, "missing value");
+    }
+    return any;
+}
+
+static bool add_extension(FilterTerm *term, const char *value)
+{
+    if (*value == '.') value++;
+    if (*value == '\0' || strlen(value) >= EXTENSION_MAX_LEN) {
+        return false;
+    }
+    FileTypeId id = file_type_from_extension(value);
+    if (id != FILE_TYPE_ID_NONE) {
+        if (term->value_count == FILTER_MAX_VALUES) return false;
+        term->values[term->value_count++] = id;
+        return true;
+    }
+    if (term->extension_count == FILTER_MAX_VALUES) return false;
+    char *dest = term->extensions[term->extension_count++];
+    for (int i = 0; value[i]; i++) {
+        dest[i] = (char)tolower((unsigned char)value[i]);
+        dest[i + 1] = '\0';
+    }
+    return true;
+}
+
+static bool add_kind(FilterTerm *term, const char *value)
+{
+    if (strcasecmp(value, "folder") == 0 || strcasecmp(value, "dir") == 0) {
+        term->flags |= DIR_COLUMN_DIRECTORY;
+        return true;
+    }
+    size_t len = strlen(value);
+    for (int c = 1; c < FILE_CLASS_COUNT; c++) {
+        // Plurals too ("images")
+        size_t name_len = strlen(CLASS_NAMES[c]);
+        if (strncasecmp(value, CLASS_NAMES[c], name_len) == 0 &&
+            (len == name_len || (len == name_len + 1 && tolower((unsigned char)value[name_len]) == 's'))) {
+            if (term->value_count == FILTER_MAX_VALUES) return false;
+            term->values[term->value_count++] = (uint8_t)c;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool add_git(FilterTerm *term, const char *value)
+{
+    for (int s = 0; s < (int)(sizeof(GIT_NAMES) / sizeof(GIT_NAMES[0])); s++) {
+        if (strcasecmp(value, GIT_NAMES[s]) == 0) {
+            if (term->value_count == FILTER_MAX_VALUES) return false;
+            term->values[term->value_count++] = (uint8_t)s;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool add_is(FilterTerm *term, const char *value)
+{
+    if (strcasecmp(value, "dir") == 0 || strcasecmp(value, "folder") == 0) {
+        term->flags |= DIR_COLUMN_DIRECTORY;
+    } else if (strcasecmp(value, "hidden") == 0) {
+        term->flags |= DIR_COLUMN_HIDDEN;
+    } else if (strcasecmp(value, "link") == 0 || strcasecmp(value, "symlink") == 0) {
+        term->flags |= DIR_COLUMN_SYMLINK;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Helper: Compile one "field<op>value" word; returns false if it is not a filter term
+static bool compile_term(FilterQuery *query, const char *word, time_t now)
+{
+    const char *p = word;
+    bool negate = false;
+    if (*p == '-' && p[1]) {
+        negate = true;
+        p++;
+    }
+
+    static const struct { const char *name; FilterField field; } FIELDS[] = {
+        {"ext", FILTER_FIELD_EXT}, {"kind", FILTER_FIELD_KIND}, {"size", FILTER_FIELD_SIZE},
+        {"modified", FILTER_FIELD_MODIFIED}, {"mod", FILTER_FIELD_MODIFIED},
+        {"git", FILTER_FIELD_GIT}, {"is", FILTER_FIELD_IS},
+    };
+    size_t name_len = strcspn(p, ":<>=");
+    if (p[name_len] == '\0') {
+        return false;
+    }
+    int found = -1;
+    for (int i = 0; i < (int)(sizeof(FIELDS) / sizeof(FIELDS[0])); i++) {
+        if (strlen(FIELDS[i].name) == name_len && strncasecmp(p, FIELDS[i].name, name_len) == 0) {
+            found = i;
+            break;
+        }
+    }
+    if (found < 0) {
+        return false;
+    }
+
+    // Operator: ':' alone, or ':' followed by a comparison, or a comparison alone
+    const char *op_start = p + name_len;
+    if (*op_start == ':') op_start++;
+    char op[3] = "=";
+    size_t op_len = strspn(op_start, "<>=");
+    if (op_len > 0 && op_len <= 2) {
+        memcpy(op, op_start, op_len);
+        op[op_len] = '\0';
+    } else if (op_len > 2) {
+        set_error(query, word, "unknown comparison");
+        return true;
+    }
+    const char *value = op_start + op_len;
+
+    if (query->term_count == FILTER_MAX_TERMS) {
+        set_error(query, word, "too many filters");
+        return true;
+    }
+    FilterTerm *term = &query->terms[query->term_count];
+    memset(term, 0, sizeof(*term));
+    term->field = FIELDS[found].field;
+    term->negate = negate;
+
+    if (*value == '\0') {
+        set_error(query, word, "missing value");
+        return true;
+    }
+
+    bool ok = false;
+    bool comparison = op[0] == '<' || op[0] == '>';
+    switch (term->field) {
+        case FILTER_FIELD_SIZE: {
+            int64_t bytes;
+            ok = parse_size(value, &bytes);
+            if (ok) {
+                set_range(term, op, bytes, 1);
+            } else {
+                set_error(query, word, "expected a size like 50MB");
+            }
+            break;
+        }
+        case FILTER_FIELD_MODIFIED: {
+            int64_t when, age;
+            if (parse_date(value, &when)) {
+                set_range(term, op, when, DAY_SECONDS);
+                ok = true;
+            } else if (parse_age(value, &age)) {
+                // An age compares the other way round: newer than 30 days is after now - 30d
+                int64_t cutoff = (int64_t)now - age;
+                if (op[0] == '>') {
+                    term->min = INT64_MIN;
+                    term->max = op[1] == '=' ? cutoff : cutoff - 1;
+                } else {
+                    term->min = op[1] == '=' || op[0] == '=' ? cutoff : cutoff + 1;
+                    term->max = INT64_MAX;
+                }
+                ok = true;
+            } else {
+                set_error(query, word, "expected an age like 30d or a date like 2024-01-31");
+            }
+            break;
+        }
+        case FILTER_FIELD_EXT:
+        case FILTER_FIELD_KIND:
+        case FILTER_FIELD_GIT:
+        case FILTER_FIELD_IS:
+            if (comparison) {
+                set_error(query, word, "expected ':'");
+                break;
+            }
+            ok = each_value(query, word, value,
+                            term->field == FILTER_FIELD_EXT ? add_extension :
+                            term->field == FILTER_FIELD_KIND ? add_kind :
+                            term->field == FILTER_FIELD_GIT ? add_git : add_is, term);
+            break;
+    }
+
+    if (ok) {
+        query->term_count++;
+    }
+    return true;
+}
+
+bool filter_query_compile(FilterQuery *query, const char *text, time_t now)
+{
+    query->term_count = 0;
+    query->text[0] = '\0';
+    query->error[0] = '\0';
+    if (!text) {
+        return true;
+    }
+
+    size_t text_len = 0;
+    const char *p = text;
+    while (*p) {
+        while (*p == ' ') p++;
+        size_t len = strcspn(p, " ");
+        if (len == 0) break;
+
+        char word[FILTER_MAX_TEXT];
+        size_t copy = len < sizeof(word) - 1 ? len : sizeof(word) - 1;
+        memcpy(word, p, copy);
+        word[copy] = '\0';
+        p += len;
+
+        if (!compile_term(query, word, now) && text_len + copy + 2 < sizeof(query->text)) {
+            if (text_len > 0) query->text[text_len++] = ' ';
+            memcpy(query->text + text_len, word, copy + 1);
+            text_len += copy;
+        }
+    }
+    return query->error[0] == '\0';
+}
+
+//=============================================================================
+// Kernels: each turns one column into bits, 64 entries per output word. Full
+// words go through the vector paths; the last partial word is done per entry
+//=============================================================================
+
+// Bits of the entries whose byte equals any of values
+static void kernel_bytes_any(const uint8_t *column, int count, const uint8_t *values, int value_count,
+                             uint64_t *out)
+{
+    int w = 0;
+    for (; (w + 1) * 64 <= count; w++) {
+        const uint8_t *block = column + w * 64;
+        uint64_t word = 0;
+        for (int k = 0; k < 4; k++) {
+            SimdBytes v = simd_load(block + 16 * k);
+            SimdBytes hit = simd_splat(0);
+            for (int j = 0; j < value_count; j++) {
+                hit = simd_or(hit, simd_eq(v, simd_splat(values[j])));
+            }
+            word |= (uint64_t)simd_mask(hit) << (16 * k);
+        }
+        out[w] = word;
+    }
+    for (int i = w * 64; i < count; i++) {
+        if (i % 64 == 0) out[i / 64] = 0;
+        for (int j = 0; j < value_count; j++) {
+            if (column[i] == values[j]) {
+                out[i / 64] |= 1ULL << (i % 64);
+                break;
+            }
+        }
+    }
+}
+
+// Bits of the entries whose byte shares a bit with bits
+static void kernel_bytes_test(const uint8_t *column, int count, uint8_t bits, uint64_t *out)
+{
+    int w = 0;
+    for (; (w + 1) * 64 <= count; w++) {
+        const uint8_t *block = column + w * 64;
+        uint64_t word = 0;
+        for (int k = 0; k < 4; k++) {
+            SimdBytes hit = simd_test(simd_load(block + 16 * k), simd_splat(bits));
+            word |= (uint64_t)simd_mask(hit) << (16 * k);
+        }
+        out[w] = word;
+    }
+    for (int i = w * 64; i < count; i++) {
+        if (i % 64 == 0) out[i / 64] = 0;
+        if (column[i] & bits) {
+            out[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+}
+
+// Bits of the entries whose value is in [min, max]. column holds 64-bit signed
+// values (off_t or time_t), read through vector loads or memcpy
+static void kernel_range(const void *column, int count, int64_t min, int64_t max, uint64_t *out)
+{
+    const unsigned char *bytes = column;
+    int w = 0;
+#if defined(SIMD_NEON) || defined(FILTER_SSE42)
+    for (; (w + 1) * 64 <= count; w++) {
+        const unsigned char *block = bytes + (size_t)w * 64 * sizeof(int64_t);
+        uint64_t word = 0;
+#if defined(SIMD_NEON)
+        int64x2_t lo = vdupq_n_s64(min);
+        int64x2_t hi = vdupq_n_s64(max);
+        for (int k = 0; k < 64; k += 2) {
+            int64x2_t v = vld1q_s64((const int64_t *)(const void *)(block + k * sizeof(int64_t)));
+            uint64x2_t in = vshrq_n_u64(vandq_u64(vcgeq_s64(v, lo), vcleq_s64(v, hi)), 63);
+            word |= (vgetq_lane_u64(in, 0) | vgetq_lane_u64(in, 1) << 1) << k;
+        }
+#else
+        __m128i lo = _mm_set1_epi64x(min);
+        __m128i hi = _mm_set1_epi64x(max);
+        for (int k = 0; k < 64; k += 2) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(block + k * sizeof(int64_t)));
+            __m128i outside = _mm_or_si128(_mm_cmpgt_epi64(lo, v), _mm_cmpgt_epi64(v, hi));
+            word |= (uint64_t)(~_mm_movemask_pd(_mm_castsi128_pd(outside)) & 3) << k;
+        }
+#endif
+        out[w] = word;
+    }
+#endif
+    for (int i = w * 64; i < count; i++) {
+        if (i % 64 == 0) out[i / 64] = 0;
+        int64_t value;
+        memcpy(&value, bytes + (size_t)i * sizeof(int64_t), sizeof(value));
+        if (value >= min && value <= max) {
+            out[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+}
+
+// Helper: Bits of the entries term holds for (before negation)
+static void term_bits(const FilterTerm *term, const DirectoryState *dir, const DirectoryColumns *columns,
+                      uint64_t *bits, int words)
+{
+    int count = dir->count;
+    switch (term->field) {
+        case FILTER_FIELD_EXT: {
+            kernel_bytes_any(columns->file_types, count, term->values, term->value_count, bits);
+            // Extensions without a table entry compare the stored extension itself
+            for (int e = 0; e < term->extension_count; e++) {
+                for (int i = 0; i < count; i++) {
+                    const FileEntry *fe = &dir->entries[i];
+                    if (fe->file_type == FILE_TYPE_ID_NONE &&
+                        strcmp(directory_entry_extension(dir, fe), term->extensions[e]) == 0) {
+                        bits[i / 64] |= 1ULL << (i % 64);
+                    }
+                }
+            }
+            break;
+        }
+        case FILTER_FIELD_KIND: {
+            // Classes become the table ids they cover
+            uint8_t ids[256];
+            int id_count = 0;
+            for (int id = 1; id < 256; id++) {
+                FileTypeClass type_class = file_type_class((FileTypeId)id);
+                if (type_class == FILE_CLASS_NONE) {
+                    break;
+                }
+                for (int j = 0; j < term->value_count; j++) {
+                    if (type_class == term->values[j]) {
+                        ids[id_count++] = (uint8_t)id;
+                        break;
+                    }
+                }
+            }
+            memset(bits, 0, (size_t)words * sizeof(uint64_t));
+            uint64_t *chunk = malloc((size_t)words * sizeof(uint64_t));
+            for (int start = 0; chunk && start < id_count; start += FILTER_MAX_VALUES) {
+                int n = id_count - start < FILTER_MAX_VALUES ? id_count - start : FILTER_MAX_VALUES;
+                kernel_bytes_any(columns->file_types, count, ids + start, n, chunk);
+                for (int w = 0; w < words; w++) bits[w] |= chunk[w];
+            }
+            if (chunk && term->flags) {
+                kernel_bytes_test(columns->flags, count, term->flags, chunk);
+                for (int w = 0; w < words; w++) bits[w] |= chunk[w];
+            }
+            free(chunk);
+            break;
+        }
+        case FILTER_FIELD_SIZE: {
+            kernel_range(columns->sizes, count, term->min, term->max, bits);
+            // Sizes are about files: folders never match
+            uint64_t *folders = malloc((size_t)words * sizeof(uint64_t));
+            if (folders) {
+                kernel_bytes_test(columns->flags, count, DIR_COLUMN_DIRECTORY, folders);
+                for (int w = 0; w < words; w++) bits[w] &= ~folders[w];
+                free(folders);
+            }
+            break;
+        }
+        case FILTER_FIELD_MODIFIED:
+            kernel_range(columns->mtimes, count, term->min, term->max, bits);
+            break;
+        case FILTER_FIELD_GIT:
+            kernel_bytes_any(columns->git_status, count, term->values, term->value_count, bits);
+            break;
+        case FILTER_FIELD_IS:
+            kernel_bytes_test(columns->flags, count, term->flags, bits);
+            break;
+    }
+}
+
+int filter_query_run(const FilterQuery *query, DirectoryState *dir, uint64_t *mask, int words)
+{
+    int count = dir->count;
+    int needed = (count + 63) / 64;
+    for (int w = 0; w < words; w++) {
+        mask[w] = w < needed ? ~0ULL : 0;
+    }
+    if (count % 64 != 0 && needed <= words) {
+        mask[needed - 1] = (1ULL << (count % 64)) - 1;
+    }
+    if (words > needed) {
+        words = needed;
+    }
+
+    if (query->term_count > 0 && count > 0) {
+        const DirectoryColumns *columns = directory_columns(dir);
+        uint64_t *bits = malloc((size_t)needed * sizeof(uint64_t));
+        if (!columns || !bits) {
+            free(bits);
+            return -1;
+        }
+        for (int t = 0; t < query->term_count; t++) {
+            const FilterTerm *term = &query->terms[t];
+            term_bits(term, dir, columns, bits, needed);
+            uint64_t flip = term->negate ? ~0ULL : 0;
+            for (int w = 0; w < words; w++) {
+                mask[w] &= bits[w] ^ flip;
+            }
+        }
+        free(bits);
+    }
+
+    int passed = 0;
+    for (int w = 0; w < words; w++) {
+        passed += __builtin_popcountll(mask[w]);
+    }
+    return passed;
+}
+
+//=============================================================================
+// Single files
+//=============================================================================
+
+// Helper: Whether row passes term (before negation)
+static bool term_holds(const FilterTerm *term, const FilterRow *row)
+{
+    switch (term->field) {
+        case FILTER_FIELD_EXT:
+            for (int j = 0; j < term->value_count; j++) {
+                if (row->file_type == term->values[j]) return true;
+            }
+            for (int e = 0; e < term->extension_count; e++) {
+                if (row->file_type == FILE_TYPE_ID_NONE && strcmp(row->extension, term->extensions[e]) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        case FILTER_FIELD_KIND:
+            if (row->flags & term->flags) return true;
+            for (int j = 0; j < term->value_count; j++) {
+                if (row->file_type != FILE_TYPE_ID_NONE && file_type_class(row->file_type) == term->values[j]) {
+                    return true;
+                }
+            }
+            return false;
+        case FILTER_FIELD_SIZE:
+            return !(row->flags & DIR_COLUMN_DIRECTORY) && row->size >= term->min && row->size <= term->max;
+        case FILTER_FIELD_MODIFIED:
+            return row->modified >= term->min && row->modified <= term->max;
+        case FILTER_FIELD_GIT:
+            for (int j = 0; j < term->value_count; j++) {
+                if (row->git_status == term->values[j]) return true;
+            }
+            return false;
+        case FILTER_FIELD_IS:
+            return (row->flags & term->flags) != 0;
+    }
+    return false;
+}
+
+// Helper: Fill the name-derived fields of row; ext receives the lower-case extension
+static void row_from_name(FilterRow *row, const char *name, char *ext, size_t ext_size)
+{
+    memset(row, 0, sizeof(*row));
+    ext[0] = '\0';
+    const char *dot = strrchr(name, '.');
+    if (dot && dot != name && strlen(dot + 1) < ext_size) {
+        size_t i = 0;
+        for (; dot[1 + i]; i++) ext[i] = (char)tolower((unsigned char)dot[1 + i]);
+        ext[i] = '\0';
+    }
+    row->extension = ext;
+    row->file_type = file_type_from_extension(ext);
+    if (name[0] == '.') {
+        row->flags |= DIR_COLUMN_HIDDEN;
+    }
+}
+
+static bool is_name_term(const FilterTerm *term)
+{
+    return term->field == FILTER_FIELD_EXT || (term->field == FILTER_FIELD_KIND && term->flags == 0);
+}
+
+bool filter_query_match_name(const FilterQuery *query, const char *name)
+{
+    FilterRow row;
+    char ext[EXTENSION_MAX_LEN];
+    row_from_name(&row, name, ext, sizeof(ext));
+    for (int t = 0; t < query->term_count; t++) {
+        const FilterTerm *term = &query->terms[t];
+        if (is_name_term(term) && term_holds(term, &row) == term->negate) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool filter_query_needs_stat(const FilterQuery *query)
+{
+    for (int t = 0; t < query->term_count; t++) {
+        FilterField field = query->terms[t].field;
+        if (!is_name_term(&query->terms[t]) && field != FILTER_FIELD_GIT) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool filter_query_match_path(const FilterQuery *query, const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    const char *name = slash ? slash + 1 : path;
+
+    FilterRow row;
+    char ext[EXTENSION_MAX_LEN];
+    row_from_name(&row, name, ext, sizeof(ext));
+
+    if (filter_query_needs_stat(query)) {
+        struct stat st;
+        if (lstat(path, &st) != 0) {
+            return false;
+        }
+        if (S_ISLNK(st.st_mode)) {
+            row.flags |= DIR_COLUMN_SYMLINK;
+            struct stat target;
+            if (stat(path, &target) == 0) {
+                st.st_size = target.st_size;
+                st.st_mode = target.st_mode;
+            }
+        }
+        if (S_ISDIR(st.st_mode)) {
+            row.flags |= DIR_COLUMN_DIRECTORY;
+            row.file_type = FILE_TYPE_ID_NONE;
+        }
+        row.size = (int64_t)st.st_size;
+        row.modified = (int64_t)st.st_mtime;
+    }
+
+    for (int t = 0; t < query->term_count; t++) {
+        const FilterTerm *term = &query->terms[t];
+        if (term_holds(term, &row) == term->negate) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool filter_query_match_entry(const FilterQuery *query, const DirectoryState *dir, const FileEntry *entry)
+{
+    FilterRow row = {
+        .size = (int64_t)entry->size,
+        .modified = (int64_t)entry->modified,
+        .flags = (uint8_t)((entry->is_directory ? DIR_COLUMN_DIRECTORY : 0) |
+                           (entry->is_hidden ? DIR_COLUMN_HIDDEN : 0) |
+                           (entry->is_symlink ? DIR_COLUMN_SYMLINK : 0)),
+        .file_type = entry->file_type,
+        .git_status = entry->git_status,
+        .extension = directory_entry_extension(dir, entry),
+    };
+    for (int t = 0; t < query->term_count; t++) {
+        const FilterTerm *term = &query->terms[t];
+        if (term_holds(term, &row) == term->negate) {
+            return false;
+        }
+    }
+    return true;
+}
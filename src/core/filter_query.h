@@ -0,0 +1,78 @@
+#ifndef FILTER_QUERY_H
+#define FILTER_QUERY_H
+
+#include "filesystem.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// Filter terms typed with a search: "ext:raw size>50MB modified<30d git:modified".
+// A query compiles into one predicate per term; over a listing each predicate is a
+// kernel that compares a single DirectoryColumns array for every entry (vectorized
+// with NEON or SSE where available) into a bitmask, and the masks are ANDed. Words
+// that are not filter terms are kept as text for the name search.
+//
+//   ext:jpg,png           Extension is any of these
+//   kind:image            File type class (utils/file_type.h), or "folder"
+//   size>50MB  size<=1k   Files only; B, K, M, G, T (1024-based), "=" or ":" for exact
+//   modified<30d          Changed within 30 days (s, min, h, d, w, mo, y)
+//   modified>2024-01-31   Changed after a date
+//   git:modified,staged   Git badge, or "clean" for none
+//   is:dir is:file is:hidden is:link
+//
+// A leading '-' negates a term ("-ext:log")
+
+#define FILTER_MAX_TERMS 16
+#define FILTER_MAX_VALUES 8             // Alternatives in one term ("ext:jpg,png")
+#define FILTER_MAX_TEXT 256
+
+typedef enum FilterField {
+    FILTER_FIELD_EXT,
+    FILTER_FIELD_KIND,
+    FILTER_FIELD_SIZE,
+    FILTER_FIELD_MODIFIED,
+    FILTER_FIELD_GIT,
+    FILTER_FIELD_IS
+} FilterField;
+
+typedef struct FilterTerm {
+    FilterField field;
+    bool negate;
+    int64_t min, max;                   // Size and modified terms: the range that passes
+    uint8_t values[FILTER_MAX_VALUES];  // FileTypeIds, classes or git statuses
+    int value_count;
+    uint8_t flags;                      // DIR_COLUMN_* bits (is: terms)
+    char extensions[FILTER_MAX_VALUES][EXTENSION_MAX_LEN];  // Extensions with no table entry
+    int extension_count;
+} FilterTerm;
+
+typedef struct FilterQuery {
+    FilterTerm terms[FILTER_MAX_TERMS];
+    int term_count;
+    char text[FILTER_MAX_TEXT];         // The words that are not filter terms
+    char error[128];                    // First term that could not be compiled
+} FilterQuery;
+
+// Compile the filter terms of text (ages count back from now). Terms with a known
+// field but a bad value are skipped, so half-typed terms filter nothing; returns false
+// if there were any, with error describing the first
+bool filter_query_compile(FilterQuery *query, const char *text, time_t now);
+
+// Set bit i of mask (words 64-bit words) for each entry of dir that passes every term
+// (all entries without terms). Returns how many passed, or -1 on OOM
+int filter_query_run(const FilterQuery *query, DirectoryState *dir, uint64_t *mask, int words);
+
+// Whether a name passes the terms that need nothing else (ext and kind)
+bool filter_query_match_name(const FilterQuery *query, const char *name);
+
+// Whether any term needs the file's metadata (size, modified or is:)
+bool filter_query_needs_stat(const FilterQuery *query);
+
+// Whether a file passes every term, by its name and lstat (false if it is gone). Files
+// outside a listing have no git badge
+bool filter_query_match_path(const FilterQuery *query, const char *path);
+
+// Whether an entry of dir passes every term
+bool filter_query_match_entry(const FilterQuery *query, const DirectoryState *dir, const FileEntry *entry);
+
+#endif // FILTER_QUERY_H
@@ -0,0 +1,643 @@
+#include "fs_watch.h"
+#include "stat_cache.h"
+#include "../utils/hash.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#define FS_WATCH_PATH_MAX 4096
+#define CHANGE_SET_INITIAL 256
+
+// Paths collected between dispatches, deduplicated through an open-addressing table
+typedef struct ChangeSet {
+    FsWatchChange *entries;
+    uint32_t *hashes;
+    int count;
+    int capacity;
+    int *slots;                         // Index into entries, -1 when empty
+    int slot_count;                     // Power of two, twice capacity
+    int limit;
+    bool overflow;                      // Paths were dropped at the limit
+} ChangeSet;
+
+typedef struct Subscriber {
+    int id;                             // 0 when the slot is free
+    char root[FS_WATCH_PATH_MAX];
+    size_t root_len;
+    bool recursive;
+    FsWatchCallback callback;
+    void *user_data;
+} Subscriber;
+
+struct FsWatch {
+    FSEventsWatcher *watcher;
+    double coalesce;
+    pthread_mutex_t stream_mutex;       // Serializes starting, stopping and replaying the stream
+
+    // Guards the pending sets and the subscribers
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;                // Events arrived on an empty batch, or stop
+    ChangeSet pending_changes;
+    ChangeSet pending_dirs;
+    uint64_t pending_event_id;
+    bool pending_history_done;
+    uint64_t replay_from;               // Start ID of the replay in progress, 0 when none
+    struct timespec first_pending;      // When the pending batch got its first event
+    Subscriber subscribers[FS_WATCH_MAX_SUBSCRIBERS];
+    int next_id;
+    bool stop;
+    pthread_t thread;
+    bool thread_started;
+    bool caching;                       // Holds a stat_cache_begin for the running stream
+
+    // Held for a whole dispatch (taken before mutex); owns everything below
+    pthread_mutex_t dispatch_mutex;
+    ChangeSet ready_changes;
+    ChangeSet ready_dirs;
+    uint64_t ready_event_id;
+    bool ready_history_done;
+    Subscriber targets[FS_WATCH_MAX_SUBSCRIBERS];
+    FsWatchChange *scratch_changes;
+    const char **scratch_dirs;
+    int scratch_capacity;
+};
+
+static void change_set_init(ChangeSet *set, int limit)
+{
+    memset(set, 0, sizeof(ChangeSet));
+    set->limit = limit;
+}
+
+static void change_set_clear(ChangeSet *set)
+{
+    for (int i = 0; i < set->count; i++) {
+        free((char *)set->entries[i].path);
+    }
+    set->count = 0;
+    set->overflow = false;
+    if (set->slots) {
+        memset(set->slots, 0xff, (size_t)set->slot_count * sizeof(int));
+    }
+}
+
+static void change_set_free(ChangeSet *set)
+{
+    change_set_clear(set);
+    free(set->entries);
+    free(set->hashes);
+    free(set->slots);
+    set->entries = NULL;
+    set->hashes = NULL;
+    set->slots = NULL;
+    set->capacity = 0;
+    set->slot_count = 0;
+}
+
+static void change_set_place(ChangeSet *set, int index)
+{
+    uint32_t mask = (uint32_t)set->slot_count - 1;
+    uint32_t slot = set->hashes[index] & mask;
+    while (set->slots[slot] >= 0) {
+        slot = (slot + 1) & mask;
+    }
+    set->slots[slot] = index;
+}
+
+static bool change_set_grow(ChangeSet *set)
+{
+    int capacity = set->capacity ? set->capacity * 2 : CHANGE_SET_INITIAL;
+    FsWatchChange *entries = realloc(set->entries, (size_t)capacity * sizeof(FsWatchChange));
+    if (!entries) return false;
+    set->entries = entries;
+    uint32_t *hashes = realloc(set->hashes, (size_t)capacity * sizeof(uint32_t));
+    if (!hashes) return false;
+    set->hashes = hashes;
+    int *slots = malloc((size_t)capacity * 2 * sizeof(int));
+    if (!slots) return false;
+
+    free(set->slots);
+    set->slots = slots;
+    set->slot_count = capacity * 2;
+    set->capacity = capacity;
+    memset(set->slots, 0xff, (size_t)set->slot_count * sizeof(int));
+    for (int i = 0; i < set->count; i++) {
+        change_set_place(set, i);
+    }
+    return true;
+}
+
+// Add a path or merge it into its earlier entry
+static void change_set_add(ChangeSet *set, const char *path, FSEventType type, uint32_t flags)
+{
+    uint32_t hash = hash_fnv1a(path);
+    if (set->slot_count > 0) {
+        uint32_t mask = (uint32_t)set->slot_count - 1;
+        for (uint32_t slot = hash & mask; set->slots[slot] >= 0; slot = (slot + 1) & mask) {
+            FsWatchChange *entry = &set->entries[set->slots[slot]];
+            if (set->hashes[set->slots[slot]] == hash && strcmp(entry->path, path) == 0) {
+                entry->type = type;
+                entry->flags |= flags;
+                return;
+            }
+        }
+    }
+
+    if (set->count >= set->limit) {
+        set->overflow = true;
+        return;
+    }
+    char *copy = NULL;
+    if ((set->count < set->capacity || change_set_grow(set)) && (copy = strdup(path)) != NULL) {
+        int index = set->count++;
+        set->entries[index] = (FsWatchChange){ .path = copy, .type = type, .flags = flags };
+        set->hashes[index] = hash;
+        change_set_place(set, index);
+    } else {
+        set->overflow = true;
+    }
+}
+
+static bool change_set_empty(const ChangeSet *set)
+{
+    return set->count == 0 && !set->overflow;
+}
+
+// Nothing waiting for dispatch (call with mutex held)
+static bool pending_empty(const FsWatch *watch)
+{
+    return change_set_empty(&watch->pending_changes) && change_set_empty(&watch->pending_dirs) &&
+           !watch->pending_history_done;
+}
+
+// Copy a path without a trailing slash. Events under the "/" stream may arrive with
+// the data volume's firmlink prefix, which is dropped
+static void normalize_path(const char *path, char *out)
+{
+    static const char data_prefix[] = "/System/Volumes/Data";
+    size_t prefix_len = sizeof(data_prefix) - 1;
+    if (strncmp(path, data_prefix, prefix_len) == 0 && (path[prefix_len] == '/' || path[prefix_len] == '\0')) {
+        path += prefix_len;
+    }
+    snprintf(out, FS_WATCH_PATH_MAX, "%s", path[0] ? path : "/");
+
+    size_t len = strlen(out);
+    while (len > 1 && out[len - 1] == '/') {
+        out[--len] = '\0';
+    }
+}
+
+// Directory holding a normalized absolute path
+static void parent_path(const char *path, char *out)
+{
+    snprintf(out, FS_WATCH_PATH_MAX, "%s", path);
+    char *slash = strrchr(out, '/');
+    if (!slash || slash == out) {
+        strcpy(out, "/");
+    } else {
+        *slash = '\0';
+    }
+}
+
+// path is root or lies under it
+static bool path_under(const char *path, const Subscriber *sub)
+{
+    if (sub->root_len == 1 && sub->root[0] == '/') {
+        return path[0] == '/';
+    }
+    return strncmp(path, sub->root, sub->root_len) == 0 &&
+           (path[sub->root_len] == '\0' || path[sub->root_len] == '/');
+}
+
+static bool change_matches(const char *path, const Subscriber *sub)
+{
+    if (!path_under(path, sub)) return false;
+    if (sub->recursive) return true;
+
+    // Root itself or directly inside it
+    const char *rest = path + sub->root_len;
+    if (*rest == '/') rest++;
+    return strchr(rest, '/') == NULL;
+}
+
+static bool dir_matches(const char *dir, const Subscriber *sub)
+{
+    return sub->recursive ? path_under(dir, sub) : strcmp(dir, sub->root) == 0;
+}
+
+// path is the subscriber's root or a directory above it
+static bool path_covers_root(const char *path, const Subscriber *sub)
+{
+    size_t len = strlen(path);
+    if (len == 1 && path[0] == '/') {
+        return true;
+    }
+    return strncmp(sub->root, path, len) == 0 && (sub->root[len] == '\0' || sub->root[len] == '/');
+}
+
+static void deliver(FsWatch *watch, const Subscriber *sub)
+{
+    FsWatchBatch batch = {
+        .root = sub->root,
+        .changes = watch->scratch_changes,
+        .dirs = watch->scratch_dirs,
+        .changes_overflow = watch->ready_changes.overflow,
+        .dirs_overflow = watch->ready_dirs.overflow,
+        .last_event_id = watch->ready_event_id,
+        .history_done = watch->ready_history_done,
+    };
+
+    if (watch->scratch_capacity == 0) {
+        // No room to filter into: report everything as changed
+        batch.changes_overflow = true;
+        batch.dirs_overflow = true;
+    } else {
+        for (int i = 0; i < watch->ready_changes.count; i++) {
+            const FsWatchChange *change = &watch->ready_changes.entries[i];
+            if ((change->flags & FSEVENT_FLAG_MUST_SCAN) && path_covers_root(change->path, sub)) {
+                batch.dirs_overflow = true;
+            } else if (change_matches(change->path, sub)) {
+                watch->scratch_changes[batch.change_count++] = *change;
+            }
+        }
+        for (int i = 0; i < watch->ready_dirs.count; i++) {
+            if (dir_matches(watch->ready_dirs.entries[i].path, sub)) {
+                watch->scratch_dirs[batch.dir_count++] = watch->ready_dirs.entries[i].path;
+            }
+        }
+    }
+
+    if (batch.change_count == 0 && batch.dir_count == 0 &&
+        !batch.changes_overflow && !batch.dirs_overflow && !batch.history_done) {
+        return;
+    }
+    sub->callback(&batch, sub->user_data);
+}
+
+// Hand the pending batch to the subscribers; false if there was none
+static bool dispatch_pending(FsWatch *watch)
+{
+    pthread_mutex_lock(&watch->dispatch_mutex);
+    pthread_mutex_lock(&watch->mutex);
+
+    if (pending_empty(watch)) {
+        pthread_mutex_unlock(&watch->mutex);
+        pthread_mutex_unlock(&watch->dispatch_mutex);
+        return false;
+    }
+
+    // Swap in the empty ready sets so events keep collecting during the callbacks
+    ChangeSet swap = watch->ready_changes;
+    watch->ready_changes = watch->pending_changes;
+    watch->pending_changes = swap;
+    swap = watch->ready_dirs;
+    watch->ready_dirs = watch->pending_dirs;
+    watch->pending_dirs = swap;
+    watch->ready_event_id = watch->pending_event_id;
+    watch->ready_history_done = watch->pending_history_done;
+    watch->pending_event_id = 0;
+    watch->pending_history_done = false;
+
+    int target_count = 0;
+    for (int i = 0; i < FS_WATCH_MAX_SUBSCRIBERS; i++) {
+        if (watch->subscribers[i].id != 0) {
+            watch->targets[target_count++] = watch->subscribers[i];
+        }
+    }
+    pthread_mutex_unlock(&watch->mutex);
+
+    int needed = watch->ready_changes.count > watch->ready_dirs.count
+                 ? watch->ready_changes.count : watch->ready_dirs.count;
+    if (needed > watch->scratch_capacity) {
+        FsWatchChange *changes = realloc(watch->scratch_changes, (size_t)needed * sizeof(FsWatchChange));
+        if (changes) watch->scratch_changes = changes;
+        const char **dirs = realloc(watch->scratch_dirs, (size_t)needed * sizeof(const char *));
+        if (dirs) watch->scratch_dirs = dirs;
+        watch->scratch_capacity = changes && dirs ? needed : 0;
+    }
+
+    for (int i = 0; i < target_count; i++) {
+        deliver(watch, &watch->targets[i]);
+    }
+
+    change_set_clear(&watch->ready_changes);
+    change_set_clear(&watch->ready_dirs);
+    pthread_mutex_unlock(&watch->dispatch_mutex);
+    return true;
+}
+
+static void* dispatch_thread_func(void *arg)
+{
+    FsWatch *watch = (FsWatch *)arg;
+
+    pthread_mutex_lock(&watch->mutex);
+    while (!watch->stop) {
+        if (pending_empty(watch)) {
+            pthread_cond_wait(&watch->cond, &watch->mutex);
+            continue;
+        }
+
+        // Let the burst run on: dispatch coalesce seconds after its first event
+        struct timespec deadline = watch->first_pending;
+        long long nsec = deadline.tv_nsec + (long long)(watch->coalesce * 1e9);
+        deadline.tv_sec += (time_t)(nsec / 1000000000LL);
+        deadline.tv_nsec = (long)(nsec % 1000000000LL);
+        if (pthread_cond_timedwait(&watch->cond, &watch->mutex, &deadline) != ETIMEDOUT) {
+            continue;
+        }
+
+        pthread_mutex_unlock(&watch->mutex);
+        dispatch_pending(watch);
+        pthread_mutex_lock(&watch->mutex);
+    }
+    pthread_mutex_unlock(&watch->mutex);
+    return NULL;
+}
+
+FsWatch* fs_watch_create(double coalesce)
+{
+    FsWatch *watch = calloc(1, sizeof(FsWatch));
+    if (!watch) {
+        return NULL;
+    }
+
+    watch->coalesce = coalesce > 0 ? coalesce : 0;
+    change_set_init(&watch->pending_changes, FS_WATCH_MAX_CHANGES);
+    change_set_init(&watch->pending_dirs, FS_WATCH_MAX_DIRS);
+    change_set_init(&watch->ready_changes, FS_WATCH_MAX_CHANGES);
+    change_set_init(&watch->ready_dirs, FS_WATCH_MAX_DIRS);
+    pthread_mutex_init(&watch->mutex, NULL);
+    pthread_mutex_init(&watch->dispatch_mutex, NULL);
+    pthread_mutex_init(&watch->stream_mutex, NULL);
+    pthread_cond_init(&watch->cond, NULL);
+
+    if (pthread_create(&watch->thread, NULL, dispatch_thread_func, watch) != 0) {
+        fs_watch_destroy(watch);
+        return NULL;
+    }
+    watch->thread_started = true;
+    return watch;
+}
+
+void fs_watch_destroy(FsWatch *watch)
+{
+    if (!watch) {
+        return;
+    }
+
+    // Stop the stream first so no event races the teardown
+    if (watch->watcher) {
+        fsevents_destroy(watch->watcher);
+        watch->watcher = NULL;
+    }
+    if (watch->caching) {
+        stat_cache_end();
+    }
+
+    if (watch->thread_started) {
+        pthread_mutex_lock(&watch->mutex);
+        watch->stop = true;
+        pthread_cond_broadcast(&watch->cond);
+        pthread_mutex_unlock(&watch->mutex);
+        pthread_join(watch->thread, NULL);
+    }
+
+    change_set_free(&watch->pending_changes);
+    change_set_free(&watch->pending_dirs);
+    change_set_free(&watch->ready_changes);
+    change_set_free(&watch->ready_dirs);
+    free(watch->scratch_changes);
+    free(watch->scratch_dirs);
+    pthread_cond_destroy(&watch->cond);
+    pthread_mutex_destroy(&watch->stream_mutex);
+    pthread_mutex_destroy(&watch->dispatch_mutex);
+    pthread_mutex_destroy(&watch->mutex);
+    free(watch);
+}
+
+// Queue a change for the next dispatch; event_id is 0 for reports not from FSEvents
+static void queue_change(FsWatch *watch, const char *path, FSEventType type, uint32_t flags,
+                         uint64_t event_id)
+{
+    if (!watch || !path || path[0] != '/') {
+        return;
+    }
+
+    char normalized[FS_WATCH_PATH_MAX];
+    char parent[FS_WATCH_PATH_MAX];
+    normalize_path(path, normalized);
+    parent_path(normalized, parent);
+
+    // Cached attributes go now, before any subscriber reads them back. Below a directory
+    // that went away or moved, and wherever events were lost, everything goes
+    bool subtree = (flags & FSEVENT_FLAG_MUST_SCAN) ||
+                   ((flags & FSEVENT_FLAG_IS_DIR) && (type == FSEVENT_DIR_DELETED || type == FSEVENT_RENAMED));
+    stat_cache_invalidate(normalized, subtree);
+    stat_cache_invalidate(parent, false);
+
+    pthread_mutex_lock(&watch->mutex);
+
+    bool was_empty = pending_empty(watch);
+    if (event_id > watch->pending_event_id) {
+        watch->pending_event_id = event_id;
+    }
+
+    // The listing holding the path changed, and a directory's own listing with it
+    change_set_add(&watch->pending_changes, normalized, type, flags);
+    change_set_add(&watch->pending_dirs, parent, FSEVENT_MODIFIED, FSEVENT_FLAG_IS_DIR);
+    if (flags & FSEVENT_FLAG_IS_DIR) {
+        change_set_add(&watch->pending_dirs, normalized, type, flags);
+    }
+
+    if (was_empty) {
+        clock_gettime(CLOCK_REALTIME, &watch->first_pending);
+        pthread_cond_signal(&watch->cond);
+    }
+
+    pthread_mutex_unlock(&watch->mutex);
+}
+
+static void fs_watch_fsevent(const FSEvent *event, void *user_data)
+{
+    FsWatch *watch = (FsWatch *)user_data;
+
+    if (event->flags & FSEVENT_FLAG_HISTORY_DONE) {
+        pthread_mutex_lock(&watch->mutex);
+        bool was_empty = pending_empty(watch);
+        watch->pending_history_done = true;
+        watch->replay_from = 0;
+        if (was_empty) {
+            clock_gettime(CLOCK_REALTIME, &watch->first_pending);
+            pthread_cond_signal(&watch->cond);
+        }
+        pthread_mutex_unlock(&watch->mutex);
+        return;
+    }
+
+    queue_change(watch, event->path, event->type, event->flags, event->event_id);
+}
+
+bool fs_watch_start(FsWatch *watch)
+{
+    if (!watch) {
+        return false;
+    }
+
+    pthread_mutex_lock(&watch->stream_mutex);
+    if (!watch->watcher) {
+        // Subscribers can be anywhere, so the one stream covers the whole tree
+        watch->watcher = fsevents_create();
+        if (!watch->watcher) {
+            pthread_mutex_unlock(&watch->stream_mutex);
+            return false;
+        }
+        fsevents_set_callback(watch->watcher, fs_watch_fsevent, watch);
+        fsevents_set_latency(watch->watcher, 0.1);
+        if (!fsevents_add_path(watch->watcher, "/")) {
+            fsevents_destroy(watch->watcher);
+            watch->watcher = NULL;
+            pthread_mutex_unlock(&watch->stream_mutex);
+            return false;
+        }
+    }
+    bool running = fsevents_is_running(watch->watcher) || fsevents_start(watch->watcher);
+    if (running && !watch->caching) {
+        stat_cache_begin();
+        watch->caching = true;
+    }
+    pthread_mutex_unlock(&watch->stream_mutex);
+    return running;
+}
+
+void fs_watch_stop(FsWatch *watch)
+{
+    if (!watch) {
+        return;
+    }
+
+    pthread_mutex_lock(&watch->stream_mutex);
+    if (watch->watcher) {
+        fsevents_stop(watch->watcher);
+    }
+    if (watch->caching) {
+        stat_cache_end();
+        watch->caching = false;
+    }
+    pthread_mutex_unlock(&watch->stream_mutex);
+}
+
+bool fs_watch_replay(FsWatch *watch, uint64_t event_id)
+{
+    if (!watch || event_id == 0) {
+        return false;
+    }
+
+    pthread_mutex_lock(&watch->stream_mutex);
+    if (!watch->watcher || !fsevents_is_running(watch->watcher)) {
+        pthread_mutex_unlock(&watch->stream_mutex);
+        return false;
+    }
+
+    // Restarting from a later ID would cut short a replay still in progress
+    pthread_mutex_lock(&watch->mutex);
+    if (watch->replay_from != 0 && watch->replay_from < event_id) {
+        event_id = watch->replay_from;
+    }
+    watch->replay_from = event_id;
+    pthread_mutex_unlock(&watch->mutex);
+
+    // Events between the old stream's last one and the restart are replayed twice,
+    // which subscribers already take as a no-op
+    fsevents_stop(watch->watcher);
+    fsevents_set_since(watch->watcher, event_id);
+    bool started = fsevents_start(watch->watcher);
+    fsevents_set_since(watch->watcher, 0);
+    if (!started) {
+        pthread_mutex_lock(&watch->mutex);
+        watch->replay_from = 0;
+        pthread_mutex_unlock(&watch->mutex);
+    }
+    pthread_mutex_unlock(&watch->stream_mutex);
+    return started;
+}
+
+static void set_subscriber_root(Subscriber *sub, const char *root)
+{
+    normalize_path(root ? root : "/", sub->root);
+    sub->root_len = strlen(sub->root);
+}
+
+int fs_watch_subscribe(FsWatch *watch, const char *root, bool recursive,
+                       FsWatchCallback callback, void *user_data)
+{
+    if (!watch || !callback) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&watch->mutex);
+    for (int i = 0; i < FS_WATCH_MAX_SUBSCRIBERS; i++) {
+        Subscriber *sub = &watch->subscribers[i];
+        if (sub->id == 0) {
+            sub->id = ++watch->next_id;
+            set_subscriber_root(sub, root);
+            sub->recursive = recursive;
+            sub->callback = callback;
+            sub->user_data = user_data;
+            pthread_mutex_unlock(&watch->mutex);
+            return sub->id;
+        }
+    }
+    pthread_mutex_unlock(&watch->mutex);
+    return -1;
+}
+
+void fs_watch_unsubscribe(FsWatch *watch, int id)
+{
+    if (!watch || id <= 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&watch->mutex);
+    for (int i = 0; i < FS_WATCH_MAX_SUBSCRIBERS; i++) {
+        if (watch->subscribers[i].id == id) {
+            watch->subscribers[i].id = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&watch->mutex);
+
+    // A dispatch that started before the removal may still be calling it
+    pthread_mutex_lock(&watch->dispatch_mutex);
+    pthread_mutex_unlock(&watch->dispatch_mutex);
+}
+
+void fs_watch_set_root(FsWatch *watch, int id, const char *root)
+{
+    if (!watch || id <= 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&watch->mutex);
+    for (int i = 0; i < FS_WATCH_MAX_SUBSCRIBERS; i++) {
+        if (watch->subscribers[i].id == id) {
+            set_subscriber_root(&watch->subscribers[i], root);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&watch->mutex);
+}
+
+void fs_watch_notify(FsWatch *watch, const char *path, FSEventType type, uint32_t flags)
+{
+    queue_change(watch, path, type, flags, 0);
+}
+
+void fs_watch_flush(FsWatch *watch)
+{
+    if (watch) {
+        dispatch_pending(watch);
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef FS_WATCH_H
+#define FS_WATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../platform/fsevents.h"
+
+// One FSEvents stream for the whole app. Events are coalesced into per-path and
+// per-directory sets and handed to subscribers in batches from a dedicated thread
+
+#define FS_WATCH_MAX_SUBSCRIBERS 64
+#define FS_WATCH_MAX_CHANGES 16384      // Changed paths per batch before only directories are kept
+#define FS_WATCH_MAX_DIRS 4096          // Changed directories per batch before everything counts as changed
+#define FS_WATCH_DEFAULT_COALESCE 0.3   // Seconds a burst is collected before dispatch
+
+// A changed path; repeated events for one path merge (flags OR'd, last type wins)
+typedef struct FsWatchChange {
+    const char *path;
+    FSEventType type;
+    uint32_t flags;
+} FsWatchChange;
+
+// What a subscriber receives: only the changes under its root
+typedef struct FsWatchBatch {
+    const char *root;
+    const FsWatchChange *changes;
+    int change_count;
+    const char *const *dirs;            // Directories whose listing changed
+    int dir_count;
+    bool changes_overflow;              // Too many paths to list; dirs is still complete
+    bool dirs_overflow;                 // Too many directories too, or history lost above root:
+                                        // treat all of root as changed
+    uint64_t last_event_id;             // Newest FSEvents ID in the batch, 0 for none
+    bool history_done;                  // A replay requested with fs_watch_replay caught up
+} FsWatchBatch;
+
+// Called on the dispatch thread; the batch is only valid during the call
+typedef void (*FsWatchCallback)(const FsWatchBatch *batch, void *user_data);
+
+// Watch bus (opaque)
+typedef struct FsWatch FsWatch;
+
+// Create the bus and its dispatch thread; coalesce is seconds to collect a burst
+FsWatch* fs_watch_create(double coalesce);
+
+// Stop the stream and the dispatch thread and free the bus
+void fs_watch_destroy(FsWatch *watch);
+
+// Start the FSEvents stream on "/"
+bool fs_watch_start(FsWatch *watch);
+
+// Stop the FSEvents stream (fs_watch_notify still works)
+void fs_watch_stop(FsWatch *watch);
+
+// Restart the stream to replay changes after event_id to every subscriber; false without a
+// running stream. Overlapping requests replay from the oldest of them
+bool fs_watch_replay(FsWatch *watch, uint64_t event_id);
+
+// Subscribe to changes at root, and below it if recursive; returns an ID or -1
+int fs_watch_subscribe(FsWatch *watch, const char *root, bool recursive,
+                       FsWatchCallback callback, void *user_data);
+
+// Unsubscribe; waits out a callback in progress, so never call it from one
+void fs_watch_unsubscribe(FsWatch *watch, int id);
+
+// Point a subscription at a new root
+void fs_watch_set_root(FsWatch *watch, int id, const char *root);
+
+// Report a change (thread-safe); FSEvents reports come through here too. A change flagged
+// FSEVENT_FLAG_MUST_SCAN at or above a subscriber's root reaches it as dirs_overflow
+void fs_watch_notify(FsWatch *watch, const char *path, FSEventType type, uint32_t flags);
+
+// Dispatch whatever is pending now, on the caller's thread
+void fs_watch_flush(FsWatch *watch);
+
+#endif // FS_WATCH_H
@@ -4,16 +4,82 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "git_repo_cache.h"
+#include "../utils/hash.h"
+
+// Room for a file name under one of the directories below
+#define GIT_FILE_PATH_LEN (GIT_PATH_MAX_LEN + 32)
+
+// Where a work tree keeps its repository
+typedef struct GitRepoPaths {
+    char root[GIT_PATH_MAX_LEN];            // Work tree root
+    char git_dir[GIT_PATH_MAX_LEN];         // .git, or a linked worktree's own directory
+    char common_dir[GIT_PATH_MAX_LEN];      // Shared refs (git_dir outside linked worktrees)
+} GitRepoPaths;
+
+// Identity of a file, to notice it was rewritten
+typedef struct FileStamp {
+    bool exists;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+} FileStamp;
+
+// One changed path with its porcelain XY codes
+// X = index status (staged), Y = worktree status (unstaged), '?' in both when untracked
+typedef struct StatusEntry {
+    char *path;                             // Relative to the work tree root
+    char index_status;
+    char worktree_status;
+    int added;                              // Lines against HEAD, -1 if not counted
+    int removed;
+} StatusEntry;
+
+// Changed paths of a work tree, sorted by path once complete
+typedef struct StatusList {
+    StatusEntry *entries;
+    int count;
+    int capacity;
+    int ahead;
+    int behind;
+} StatusList;
+
+static struct {
+    pthread_mutex_t mutex;
+
+    // packed-refs last scanned for refs/stash
+    char packed_path[GIT_PATH_MAX_LEN];
+    time_t packed_mtime;
+    off_t packed_size;
+    bool packed_has_stash;
+
+    // Status of the watched repository, kept between refreshes. The watcher reports
+    // changed paths, which the next refresh rescans; the rest is reused
+    char watched_root[GIT_PATH_MAX_LEN];
+    char cached_root[GIT_PATH_MAX_LEN];     // Empty when nothing is cached
+    StatusList cached;
+    FileStamp cached_index;                 // .git/index when cached was read
+    char cached_head[GIT_BRANCH_MAX_LEN];   // Branch (or detached commit) then
+    char **dirty;                           // Paths to rescan, relative to the root
+    int dirty_count;
+    bool rescan_all;                        // Changes were lost or refs moved
+} g_git = { .mutex = PTHREAD_MUTEX_INITIALIZER };
 
 // Run a git command and capture output
 static bool run_git_command(const char *repo_path, const char *args, char *output, size_t output_size)
 {
     char command[GIT_PATH_MAX_LEN * 2];
 
+    // No optional locks: a status run must not rewrite the index and wake the watch bus
     if (repo_path && repo_path[0] != '\0') {
-        snprintf(command, sizeof(command), "cd \"%s\" && git %s 2>/dev/null", repo_path, args);
+        snprintf(command, sizeof(command), "cd \"%s\" && git --no-optional-locks %s 2>/dev/null", repo_path, args);
     } else {
-        snprintf(command, sizeof(command), "git %s 2>/dev/null", args);
+        snprintf(command, sizeof(command), "git --no-optional-locks %s 2>/dev/null", args);
     }
 
     FILE *fp = popen(command, "r");
@@ -42,6 +108,52 @@ static bool run_git_command(const char *repo_path, const char *args, char *outpu
     return (status == 0);
 }
 
+// Run a git command and capture all of its output, NUL bytes included (caller frees)
+static char* run_git_capture(const char *repo_path, const char *args, size_t *length)
+{
+    size_t command_size = strlen(repo_path) + strlen(args) + 64;
+    char *command = malloc(command_size);
+    if (command == NULL) {
+        return NULL;
+    }
+    snprintf(command, command_size, "cd \"%s\" && git --no-optional-locks %s 2>/dev/null", repo_path, args);
+
+    FILE *fp = popen(command, "r");
+    free(command);
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    size_t capacity = 65536;
+    size_t total = 0;
+    char *output = malloc(capacity + 1);
+    while (output != NULL) {
+        size_t bytes_read = fread(output + total, 1, capacity - total, fp);
+        total += bytes_read;
+        if (bytes_read == 0) {
+            break;
+        }
+        if (total == capacity) {
+            char *grown = realloc(output, capacity * 2 + 1);
+            if (grown == NULL) {
+                free(output);
+                output = NULL;
+                break;
+            }
+            output = grown;
+            capacity *= 2;
+        }
+    }
+
+    if (pclose(fp) != 0 || output == NULL) {
+        free(output);
+        return NULL;
+    }
+    output[total] = '\0';
+    *length = total;
+    return output;
+}
+
 // Check if git command succeeded (ignoring output)
 static bool run_git_check(const char *repo_path, const char *args)
 {
@@ -49,161 +161,377 @@ static bool run_git_check(const char *repo_path, const char *args)
     return run_git_command(repo_path, args, output, sizeof(output));
 }
 
-void git_state_init(GitState *state)
+// Helper: read a small file such as HEAD, without the trailing newline
+static bool read_line_file(const char *path, char *out, size_t out_size)
 {
-    memset(state, 0, sizeof(GitState));
-}
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return false;
+    }
+    bool ok = fgets(out, (int)out_size, fp) != NULL;
+    fclose(fp);
 
-void git_state_free(GitState *state)
-{
-    // Currently no dynamic allocation, but keep for future
-    memset(state, 0, sizeof(GitState));
+    if (ok) {
+        size_t len = strlen(out);
+        while (len > 0 && isspace((unsigned char)out[len - 1])) {
+            out[--len] = '\0';
+        }
+    }
+    return ok;
 }
 
-bool git_is_repo(const char *path)
+// Helper: target of a gitdir or commondir pointer, relative to base unless absolute
+static void resolve_pointer(const char *base, const char *target, char *out, size_t out_size)
 {
-    char output[256];
-    return run_git_command(path, "rev-parse --is-inside-work-tree", output, sizeof(output)) &&
-           strcmp(output, "true") == 0;
+    char joined[GIT_PATH_MAX_LEN * 2];
+    if (target[0] == '/') {
+        snprintf(joined, sizeof(joined), "%s", target);
+    } else {
+        snprintf(joined, sizeof(joined), "%s/%s", base, target);
+    }
+
+    char resolved[PATH_MAX];
+    snprintf(out, out_size, "%s", realpath(joined, resolved) != NULL ? resolved : joined);
 }
 
-bool git_get_repo_root(const char *path, char *root, size_t root_size)
+// Helper: find the work tree containing path the way git does, by walking up to the first
+// .git directory or gitdir file, without running git
+static bool find_repo(const char *path, GitRepoPaths *paths)
 {
-    return run_git_command(path, "rev-parse --show-toplevel", root, root_size);
+    char dir[PATH_MAX];
+    if (path == NULL || realpath(path, dir) == NULL) {
+        return false;
+    }
+
+    // Inside .git itself there is no work tree, as git rev-parse --is-inside-work-tree says
+    size_t dir_len = strlen(dir);
+    if (strstr(dir, "/.git/") != NULL || (dir_len >= 5 && strcmp(dir + dir_len - 5, "/.git") == 0)) {
+        return false;
+    }
+
+    for (;;) {
+        bool at_top = strcmp(dir, "/") == 0;
+        char candidate[GIT_FILE_PATH_LEN];
+        snprintf(candidate, sizeof(candidate), "%s/.git", at_top ? "" : dir);
+
+        struct stat st;
+        bool found = false;
+        if (stat(candidate, &st) == 0) {
+            if (S_ISDIR(st.st_mode)) {
+                snprintf(paths->git_dir, sizeof(paths->git_dir), "%s", candidate);
+                found = true;
+            } else if (S_ISREG(st.st_mode)) {
+                // Linked worktrees and submodules: "gitdir: <path>"
+                char line[GIT_PATH_MAX_LEN];
+                if (read_line_file(candidate, line, sizeof(line)) && strncmp(line, "gitdir: ", 8) == 0) {
+                    resolve_pointer(at_top ? "" : dir, line + 8, paths->git_dir, sizeof(paths->git_dir));
+                    found = true;
+                }
+            }
+        }
+
+        // A .git without HEAD is not a repository, so keep looking above it
+        char head[GIT_FILE_PATH_LEN];
+        if (found) {
+            snprintf(head, sizeof(head), "%s/HEAD", paths->git_dir);
+            found = stat(head, &st) == 0;
+        }
+        if (found) {
+            snprintf(paths->root, sizeof(paths->root), "%s", dir);
+
+            char commondir[GIT_FILE_PATH_LEN];
+            char line[GIT_PATH_MAX_LEN];
+            snprintf(commondir, sizeof(commondir), "%s/commondir", paths->git_dir);
+            if (read_line_file(commondir, line, sizeof(line))) {
+                resolve_pointer(paths->git_dir, line, paths->common_dir, sizeof(paths->common_dir));
+            } else {
+                snprintf(paths->common_dir, sizeof(paths->common_dir), "%s", paths->git_dir);
+            }
+            return true;
+        }
+
+        if (at_top) {
+            return false;
+        }
+        char *slash = strrchr(dir, '/');
+        if (slash == dir) {
+            dir[1] = '\0';
+        } else {
+            *slash = '\0';
+        }
+    }
 }
 
-bool git_get_branch(const char *repo_path, char *branch, size_t branch_size)
+// Helper: branch name from HEAD, or "(abc1234)" when detached
+static bool read_head(const GitRepoPaths *paths, char *branch, size_t branch_size, bool *detached)
 {
-    // Try to get symbolic ref first (normal branch)
-    if (run_git_command(repo_path, "symbolic-ref --short HEAD", branch, branch_size)) {
-        return true;
+    char head_path[GIT_FILE_PATH_LEN];
+    char head[GIT_PATH_MAX_LEN];
+    snprintf(head_path, sizeof(head_path), "%s/HEAD", paths->git_dir);
+    if (!read_line_file(head_path, head, sizeof(head))) {
+        return false;
     }
 
-    // If that fails, we're in detached HEAD state - get short hash
-    if (run_git_command(repo_path, "rev-parse --short HEAD", branch, branch_size)) {
-        // Prepend indicator for detached state
-        char temp[GIT_BRANCH_MAX_LEN];
-        strncpy(temp, branch, sizeof(temp) - 1);
-        temp[sizeof(temp) - 1] = '\0';
-        snprintf(branch, branch_size, "(%s)", temp);
+    if (strncmp(head, "ref: ", 5) == 0) {
+        const char *name = head + 5;
+        if (strncmp(name, "refs/heads/", 11) == 0) {
+            name += 11;
+        }
+        snprintf(branch, branch_size, "%s", name);
+        *detached = false;
         return true;
     }
 
-    return false;
+    size_t hex = strspn(head, "0123456789abcdef");
+    if (hex < 7) {
+        return false;
+    }
+    snprintf(branch, branch_size, "(%.7s)", head);
+    *detached = true;
+    return true;
 }
 
-bool git_update_state(GitState *state, const char *path)
+// Helper: whether refs/stash exists, loose or packed. The packed-refs scan is cached
+// until the file changes, since a large repository packs thousands of refs
+static bool has_stash_ref(const GitRepoPaths *paths)
 {
-    git_state_init(state);
+    char path[GIT_FILE_PATH_LEN];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/refs/stash", paths->common_dir);
+    if (stat(path, &st) == 0) {
+        return true;
+    }
 
-    // Check if in a git repo
-    if (!git_is_repo(path)) {
+    snprintf(path, sizeof(path), "%s/packed-refs", paths->common_dir);
+    if (stat(path, &st) != 0) {
         return false;
     }
-    state->is_repo = true;
 
-    // Get repo root
-    if (!git_get_repo_root(path, state->repo_root, sizeof(state->repo_root))) {
-        return false;
+    pthread_mutex_lock(&g_git.mutex);
+    bool cached = strcmp(g_git.packed_path, path) == 0 &&
+                  g_git.packed_mtime == st.st_mtime &&
+                  g_git.packed_size == st.st_size;
+    if (!cached) {
+        bool found = false;
+        FILE *fp = fopen(path, "r");
+        if (fp != NULL) {
+            char line[1024];
+            while (!found && fgets(line, sizeof(line), fp) != NULL) {
+                // "<oid> refs/stash"
+                const char *ref = strchr(line, ' ');
+                found = ref != NULL && strncmp(ref, " refs/stash", 11) == 0 && isspace((unsigned char)ref[11]);
+            }
+            fclose(fp);
+        }
+        snprintf(g_git.packed_path, sizeof(g_git.packed_path), "%s", path);
+        g_git.packed_mtime = st.st_mtime;
+        g_git.packed_size = st.st_size;
+        g_git.packed_has_stash = found;
     }
+    bool has_stash = g_git.packed_has_stash;
+    pthread_mutex_unlock(&g_git.mutex);
+    return has_stash;
+}
 
-    // Get current branch (reuse git_get_branch to avoid duplication)
-    if (git_get_branch(path, state->branch, sizeof(state->branch))) {
-        state->is_detached = (state->branch[0] == '(');
+// Helper: object id a ref points at in packed-refs
+static bool read_packed_ref(const GitRepoPaths *paths, const char *ref, char *id, size_t id_size)
+{
+    char path[GIT_FILE_PATH_LEN];
+    snprintf(path, sizeof(path), "%s/packed-refs", paths->common_dir);
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return false;
     }
 
-    // Get ahead/behind counts from tracking branch
-    char ahead_behind[128];
-    if (run_git_command(path, "rev-list --left-right --count @{upstream}...HEAD", ahead_behind, sizeof(ahead_behind))) {
-        sscanf(ahead_behind, "%d\t%d", &state->behind, &state->ahead);
+    bool found = false;
+    size_t ref_len = strlen(ref);
+    char line[GIT_PATH_MAX_LEN];
+    while (!found && fgets(line, sizeof(line), fp) != NULL) {
+        // "<oid> <ref>"
+        char *space = strchr(line, ' ');
+        if (space != NULL && strncmp(space + 1, ref, ref_len) == 0 && isspace((unsigned char)space[1 + ref_len])) {
+            *space = '\0';
+            snprintf(id, id_size, "%s", line);
+            found = true;
+        }
     }
+    fclose(fp);
+    return found;
+}
 
-    // Check for stash
-    char stash_output[64];
-    state->has_stash = run_git_command(path, "stash list", stash_output, sizeof(stash_output)) &&
-                       stash_output[0] != '\0';
+void git_state_init(GitState *state)
+{
+    memset(state, 0, sizeof(GitState));
+}
 
-    // Check for staged/modified/untracked using status
-    char status_output[4096];
-    if (run_git_command(path, "status --porcelain", status_output, sizeof(status_output))) {
-        char *line = status_output;
-        while (*line) {
-            if (line[0] != ' ' && line[0] != '?') {
-                state->has_staged = true;
-            }
-            if (line[1] == 'M' || line[1] == 'D') {
-                state->has_modified = true;
-            }
-            if (line[0] == '?') {
-                state->has_untracked = true;
-            }
+void git_state_free(GitState *state)
+{
+    // Currently no dynamic allocation, but keep for future
+    memset(state, 0, sizeof(GitState));
+}
+
+bool git_is_repo(const char *path)
+{
+    GitRepoPaths paths;
+    return find_repo(path, &paths);
+}
 
-            // Move to next line
-            char *newline = strchr(line, '\n');
-            if (newline == NULL) break;
-            line = newline + 1;
+bool git_get_repo_root(const char *path, char *root, size_t root_size)
+{
+    GitRepoPaths paths;
+    if (!find_repo(path, &paths)) {
+        return false;
+    }
+    snprintf(root, root_size, "%s", paths.root);
+    return true;
+}
+
+bool git_head_commit(const char *path, char *id, size_t id_size)
+{
+    GitRepoPaths paths;
+    char head_path[GIT_FILE_PATH_LEN];
+    char head[GIT_PATH_MAX_LEN];
+    if (!find_repo(path, &paths)) {
+        return false;
+    }
+    snprintf(head_path, sizeof(head_path), "%s/HEAD", paths.git_dir);
+    if (!read_line_file(head_path, head, sizeof(head))) {
+        return false;
+    }
+
+    // Follow symbolic refs (a branch, rarely a ref pointing at another) to an object id
+    for (int depth = 0; depth < 5 && strncmp(head, "ref: ", 5) == 0; depth++) {
+        char ref[GIT_PATH_MAX_LEN];
+        char ref_path[GIT_FILE_PATH_LEN];
+        snprintf(ref, sizeof(ref), "%s", head + 5);
+        snprintf(ref_path, sizeof(ref_path), "%s/%s", paths.common_dir, ref);
+        if (!read_line_file(ref_path, head, sizeof(head)) && !read_packed_ref(&paths, ref, head, sizeof(head))) {
+            return false;       // A branch without commits yet
         }
     }
 
+    size_t hex = strspn(head, "0123456789abcdef");
+    if (hex < 40 || head[hex] != '\0') {
+        return false;
+    }
+    snprintf(id, id_size, "%s", head);
     return true;
 }
 
+bool git_get_branch(const char *repo_path, char *branch, size_t branch_size)
+{
+    GitRepoPaths paths;
+    bool detached;
+    return find_repo(repo_path, &paths) && read_head(&paths, branch, branch_size, &detached);
+}
+
 void git_status_result_init(GitStatusResult *result)
 {
-    result->entries = NULL;
-    result->count = 0;
-    result->capacity = 0;
+    memset(result, 0, sizeof(GitStatusResult));
 }
 
 void git_status_result_free(GitStatusResult *result)
 {
     free(result->entries);
-    result->entries = NULL;
-    result->count = 0;
-    result->capacity = 0;
+    free(result->slots);
+    free(result->buckets);
+    memset(result, 0, sizeof(GitStatusResult));
 }
 
-// Parse a single status line from git status --porcelain
-static bool parse_status_line(const char *line, GitFileStatusEntry *entry)
+static StatusEntry* status_list_add(StatusList *list, const char *path, char index_status, char worktree_status)
 {
-    if (strlen(line) < 4) {
-        return false;
+    if (list->count == list->capacity) {
+        int capacity = list->capacity > 0 ? list->capacity * 2 : 64;
+        StatusEntry *grown = realloc(list->entries, (size_t)capacity * sizeof(StatusEntry));
+        if (grown == NULL) {
+            return NULL;
+        }
+        list->entries = grown;
+        list->capacity = capacity;
     }
 
-    // Format: XY filename
-    // X = index status (staged)
-    // Y = worktree status (unstaged)
-    char index_status = line[0];
-    char worktree_status = line[1];
-    const char *filename = line + 3;
+    char *copy = strdup(path);
+    if (copy == NULL) {
+        return NULL;
+    }
+    list->entries[list->count] = (StatusEntry){ copy, index_status, worktree_status, -1, -1 };
+    return &list->entries[list->count++];
+}
 
-    // Skip the space
-    if (line[2] != ' ') {
-        return false;
+static void status_list_free(StatusList *list)
+{
+    for (int i = 0; i < list->count; i++) {
+        free(list->entries[i].path);
     }
+    free(list->entries);
+    memset(list, 0, sizeof(StatusList));
+}
 
-    // Copy filename (handle quoted paths and renames)
-    const char *arrow = strstr(filename, " -> ");
-    if (arrow != NULL) {
-        // Rename: use the new name
-        filename = arrow + 4;
+static int compare_status_entries(const void *a, const void *b)
+{
+    return strcmp(((const StatusEntry *)a)->path, ((const StatusEntry *)b)->path);
+}
+
+static void status_list_sort(StatusList *list)
+{
+    if (list->count > 1) {
+        qsort(list->entries, (size_t)list->count, sizeof(StatusEntry), compare_status_entries);
     }
+}
 
-    // Remove quotes if present
-    if (filename[0] == '"') {
-        filename++;
-        size_t len = strlen(filename);
-        strncpy(entry->path, filename, sizeof(entry->path) - 1);
-        if (len > 0 && entry->path[len - 1] == '"') {
-            entry->path[len - 1] = '\0';
+// Helper: entry for path in a sorted list, or NULL
+static StatusEntry* status_list_find(const StatusList *list, const char *path)
+{
+    StatusEntry key = { (char *)path, 0, 0, 0, 0 };
+    return list->count > 0 ? bsearch(&key, list->entries, (size_t)list->count, sizeof(StatusEntry),
+                                     compare_status_entries) : NULL;
+}
+
+// Helper: whether path is dir or below it ("" is the whole tree)
+static bool path_under(const char *path, const char *dir)
+{
+    size_t len = strlen(dir);
+    return len == 0 || (strncmp(path, dir, len) == 0 && (path[len] == '\0' || path[len] == '/'));
+}
+
+// Helper: drop every entry at or under one of the dirs
+static void status_list_remove_under(StatusList *list, char *const *dirs, int dir_count)
+{
+    int kept = 0;
+    for (int i = 0; i < list->count; i++) {
+        bool drop = false;
+        for (int d = 0; d < dir_count && !drop; d++) {
+            drop = path_under(list->entries[i].path, dirs[d]);
+        }
+        if (drop) {
+            free(list->entries[i].path);
+        } else {
+            list->entries[kept++] = list->entries[i];
         }
-    } else {
-        strncpy(entry->path, filename, sizeof(entry->path) - 1);
     }
-    entry->path[sizeof(entry->path) - 1] = '\0';
+    list->count = kept;
+}
+
+// Helper: append one file's status to a result
+static void add_result_entry(GitStatusResult *result, const StatusEntry *status)
+{
+    if (result->count == result->capacity) {
+        int capacity = result->capacity > 0 ? result->capacity * 2 : 64;
+        GitFileStatusEntry *grown = realloc(result->entries, (size_t)capacity * sizeof(GitFileStatusEntry));
+        if (grown == NULL) {
+            return;
+        }
+        result->entries = grown;
+        result->capacity = capacity;
+    }
+
+    GitFileStatusEntry *entry = &result->entries[result->count++];
+    snprintf(entry->path, sizeof(entry->path), "%s", status->path);
+    entry->added = status->added;
+    entry->removed = status->removed;
 
     // Parse index (staged) status
-    switch (index_status) {
+    switch (status->index_status) {
         case 'A': entry->staged_status = GIT_STATUS_STAGED; break;
         case 'M': entry->staged_status = GIT_STATUS_STAGED; break;
         case 'D': entry->staged_status = GIT_STATUS_DELETED; break;
@@ -214,7 +542,7 @@ static bool parse_status_line(const char *line, GitFileStatusEntry *entry)
     }
 
     // Parse worktree (unstaged) status
-    switch (worktree_status) {
+    switch (status->worktree_status) {
         case 'M': entry->status = GIT_STATUS_MODIFIED; break;
         case 'D': entry->status = GIT_STATUS_DELETED; break;
         case 'U': entry->status = GIT_STATUS_CONFLICT; break;
@@ -222,112 +550,657 @@ static bool parse_status_line(const char *line, GitFileStatusEntry *entry)
         case '!': entry->status = GIT_STATUS_IGNORED; break;
         default:
             // If no worktree status but has staged status, show as staged
-            if (entry->staged_status != GIT_STATUS_NONE) {
-                entry->status = entry->staged_status;
-            } else {
-                entry->status = GIT_STATUS_NONE;
-            }
+            entry->status = entry->staged_status;
             break;
     }
 
     // Untracked files have '?' in both columns
-    if (index_status == '?' && worktree_status == '?') {
+    if (status->index_status == '?') {
         entry->status = GIT_STATUS_UNTRACKED;
         entry->staged_status = GIT_STATUS_NONE;
     }
+}
 
+// Helper: repository-wide flags from every entry, and the entries under dir into result
+static void apply_status(const StatusList *list, GitState *state, GitStatusResult *result, const char *dir)
+{
+    state->ahead = list->ahead;
+    state->behind = list->behind;
+
+    for (int i = 0; i < list->count; i++) {
+        const StatusEntry *status = &list->entries[i];
+        if (status->index_status != ' ' && status->index_status != '?') {
+            state->has_staged = true;
+        }
+        if (status->worktree_status == 'M' || status->worktree_status == 'D') {
+            state->has_modified = true;
+        }
+        if (status->index_status == '?') {
+            state->has_untracked = true;
+        }
+        if (result != NULL && path_under(status->path, dir)) {
+            add_result_entry(result, status);
+        }
+    }
+}
+
+// Helper: how strongly a status should show on the directory holding it
+static int status_rank(GitFileStatus status)
+{
+    switch (status) {
+        case GIT_STATUS_CONFLICT:  return 6;
+        case GIT_STATUS_MODIFIED:  return 5;
+        case GIT_STATUS_DELETED:   return 4;
+        case GIT_STATUS_RENAMED:   return 3;
+        case GIT_STATUS_STAGED:    return 2;
+        case GIT_STATUS_UNTRACKED: return 1;
+        default:                   return 0;
+    }
+}
+
+// Helper: slot holding key, or -1
+static int find_slot(const GitStatusResult *result, const char *key, int length, uint32_t hash)
+{
+    for (int i = result->buckets[hash & result->bucket_mask]; i >= 0; i = result->slots[i].chain) {
+        const GitStatusIndexSlot *slot = &result->slots[i];
+        if (slot->hash == hash && slot->length == length && memcmp(slot->path, key, (size_t)length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Helper: add key with a file's status and line counts, or raise the status already
+// there and add the counts to it
+static void index_key(GitStatusResult *result, const char *key, int length, const GitFileStatusEntry *entry)
+{
+    uint32_t hash = hash_fnv1a_bytes(HASH_FNV1A_INIT, key, (size_t)length);
+    int found = find_slot(result, key, length, hash);
+    if (found >= 0) {
+        GitStatusIndexSlot *slot = &result->slots[found];
+        if (status_rank(entry->status) > status_rank(slot->status)) {
+            slot->status = entry->status;
+        }
+        if (entry->added >= 0) {
+            slot->added = (slot->added > 0 ? slot->added : 0) + entry->added;
+            slot->removed = (slot->removed > 0 ? slot->removed : 0) + entry->removed;
+        }
+        return;
+    }
+
+    int *bucket = &result->buckets[hash & result->bucket_mask];
+    result->slots[result->slot_count] = (GitStatusIndexSlot){ key, length, hash, entry->status,
+                                                              entry->added, entry->removed, *bucket };
+    *bucket = result->slot_count++;
+}
+
+// Helper: hash every entry by its path below the directory read, and every directory
+// between them by the statuses it holds, so lookups take no scan of the entries
+static void index_result(GitStatusResult *result)
+{
+    // A key per path component below the base bounds the slots needed
+    int keys = 0;
+    for (int i = 0; i < result->count; i++) {
+        keys++;
+        for (const char *c = result->entries[i].path + result->base_length; *c != '\0'; c++) {
+            keys += *c == '/';
+        }
+    }
+    if (keys == 0) {
+        return;
+    }
+
+    uint32_t bucket_count = 16;
+    while (bucket_count < (uint32_t)keys * 2) {
+        bucket_count *= 2;
+    }
+    result->slots = malloc((size_t)keys * sizeof(GitStatusIndexSlot));
+    result->buckets = malloc(bucket_count * sizeof(int));
+    if (result->slots == NULL || result->buckets == NULL) {
+        free(result->slots);
+        free(result->buckets);
+        result->slots = NULL;
+        result->buckets = NULL;
+        return;
+    }
+    memset(result->buckets, 0xff, bucket_count * sizeof(int));
+    result->bucket_mask = bucket_count - 1;
+    result->slot_count = 0;
+
+    for (int i = 0; i < result->count; i++) {
+        const GitFileStatusEntry *entry = &result->entries[i];
+        const char *key = entry->path + result->base_length;
+        for (const char *c = key; *c != '\0'; c++) {
+            if (*c == '/') {
+                index_key(result, key, (int)(c - key), entry);
+            }
+        }
+        index_key(result, key, (int)strlen(key), entry);
+    }
+}
+
+// Helper: the path of a porcelain v2 record, after its fixed fields
+static const char* skip_fields(const char *record, int fields)
+{
+    for (int i = 0; i < fields && record != NULL; i++) {
+        record = strchr(record, ' ');
+        if (record != NULL) {
+            record++;
+        }
+    }
+    return record;
+}
+
+// Helper: append text to args in single quotes for the shell
+static bool append_quoted(char **args, size_t *length, size_t *capacity, const char *text)
+{
+    size_t needed = *length + strlen(text) * 4 + 4;
+    if (needed > *capacity) {
+        size_t grown_capacity = needed * 2;
+        char *grown = realloc(*args, grown_capacity);
+        if (grown == NULL) {
+            return false;
+        }
+        *args = grown;
+        *capacity = grown_capacity;
+    }
+
+    char *out = *args + *length;
+    *out++ = ' ';
+    *out++ = '\'';
+    for (const char *c = text; *c; c++) {
+        if (*c == '\'') {
+            memcpy(out, "'\\''", 4);
+            out += 4;
+        } else {
+            *out++ = *c;
+        }
+    }
+    *out++ = '\'';
+    *out = '\0';
+    *length = (size_t)(out - *args);
     return true;
 }
 
-bool git_get_status(const char *path, GitStatusResult *result)
+// Helper: ahead/behind and file status from a single git status process, limited to
+// specs (paths relative to the root) when spec_count > 0
+static bool read_status_process(const GitRepoPaths *paths, char *const *specs, int spec_count,
+                                bool recurse_untracked, StatusList *list)
 {
-    git_status_result_init(result);
+    // -z leaves paths unquoted; untracked directories are only listed file by file when
+    // the caller wants files
+    size_t capacity = 128;
+    char *args = malloc(capacity);
+    if (args == NULL) {
+        return false;
+    }
+    size_t length = (size_t)snprintf(args, capacity, "status --porcelain=v2 --branch -z%s%s",
+                                     recurse_untracked ? " -uall" : "", spec_count > 0 ? " --" : "");
+    for (int i = 0; i < spec_count; i++) {
+        char spec[GIT_FILE_PATH_LEN];
+        snprintf(spec, sizeof(spec), ":(literal)%s", specs[i]);
+        if (!append_quoted(&args, &length, &capacity, spec)) {
+            free(args);
+            return false;
+        }
+    }
 
-    // Get status output
-    char status_output[65536];  // Large buffer for directories with many files
-    if (!run_git_command(path, "status --porcelain -uall", status_output, sizeof(status_output))) {
+    size_t output_length = 0;
+    char *output = run_git_capture(paths->root, args, &output_length);
+    free(args);
+    if (output == NULL) {
         return false;
     }
 
-    // Count lines to pre-allocate
-    int line_count = 0;
-    for (const char *p = status_output; *p; p++) {
-        if (*p == '\n') line_count++;
+    const char *end = output + output_length;
+    const char *record = output;
+    while (record < end) {
+        size_t record_len = strlen(record);
+        const char *next = record + record_len + 1;
+        char x = record_len > 3 ? (record[2] == '.' ? ' ' : record[2]) : ' ';
+        char y = record_len > 3 ? (record[3] == '.' ? ' ' : record[3]) : ' ';
+
+        switch (record[0]) {
+            case '#': {
+                int ahead, behind;
+                if (sscanf(record, "# branch.ab +%d -%d", &ahead, &behind) == 2) {
+                    list->ahead = ahead;
+                    list->behind = behind;
+                }
+                break;
+            }
+            case '1': {
+                // 1 XY sub mH mI mW hH hI path
+                const char *path = skip_fields(record, 8);
+                if (path != NULL) {
+                    status_list_add(list, path, x, y);
+                }
+                break;
+            }
+            case '2': {
+                // 2 XY sub mH mI mW hH hI Xscore path, then the original path
+                const char *path = skip_fields(record, 9);
+                if (path != NULL) {
+                    status_list_add(list, path, x, y);
+                }
+                if (next < end) {
+                    next += strlen(next) + 1;
+                }
+                break;
+            }
+            case 'u': {
+                // u XY sub m1 m2 m3 mW h1 h2 h3 path
+                const char *path = skip_fields(record, 10);
+                if (path != NULL) {
+                    status_list_add(list, path, 'U', 'U');
+                }
+                break;
+            }
+            case '?':
+                if (record_len > 2) {
+                    status_list_add(list, record + 2, '?', '?');
+                }
+                break;
+            default:
+                break;
+        }
+        record = next;
     }
-    if (status_output[0] != '\0' && status_output[strlen(status_output) - 1] != '\n') {
-        line_count++;  // Last line without newline
+
+    free(output);
+    return true;
+}
+
+static void on_repo_status(void *context, const char *path, char index_status, char worktree_status)
+{
+    status_list_add(context, path, index_status, worktree_status);
+}
+
+static void on_repo_numstat(void *context, const char *path, int added, int removed)
+{
+    StatusEntry *entry = status_list_find(context, path);
+    if (entry != NULL) {
+        entry->added = added;
+        entry->removed = removed;
     }
+}
 
-    if (line_count == 0) {
-        return true;  // No changes, success
+// Helper: lines added and removed against HEAD for the tracked entries of a sorted list,
+// from one git diff --numstat process over the tree (or specs). Binary files, untracked
+// files and a repository without commits stay uncounted
+static void read_numstat_process(const GitRepoPaths *paths, char *const *specs, int spec_count,
+                                 StatusList *list)
+{
+    size_t capacity = 128;
+    char *args = malloc(capacity);
+    if (args == NULL) {
+        return;
+    }
+    size_t length = (size_t)snprintf(args, capacity, "diff HEAD --numstat -z%s", spec_count > 0 ? " --" : "");
+    for (int i = 0; i < spec_count; i++) {
+        char spec[GIT_FILE_PATH_LEN];
+        snprintf(spec, sizeof(spec), ":(literal)%s", specs[i]);
+        if (!append_quoted(&args, &length, &capacity, spec)) {
+            free(args);
+            return;
+        }
     }
 
-    // Allocate entries
-    result->entries = calloc(line_count, sizeof(GitFileStatusEntry));
-    if (result->entries == NULL) {
-        return false;
+    size_t output_length = 0;
+    char *output = run_git_capture(paths->root, args, &output_length);
+    free(args);
+    if (output == NULL) {
+        return;
     }
-    result->capacity = line_count;
 
-    // Parse each line
-    char *line = status_output;
-    while (*line) {
-        char *newline = strchr(line, '\n');
-        if (newline != NULL) {
-            *newline = '\0';
+    // "added\tremoved\tpath" records; a rename leaves path empty and follows with the old
+    // and new paths. Binary files count "-"
+    const char *end = output + output_length;
+    const char *record = output;
+    while (record < end) {
+        const char *next = record + strlen(record) + 1;
+        const char *path = strchr(record, '\t') != NULL ? strchr(strchr(record, '\t') + 1, '\t') : NULL;
+        if (path != NULL && *++path == '\0' && next < end) {
+            next += strlen(next) + 1;
+            path = next < end ? next : NULL;
+            next = path != NULL ? path + strlen(path) + 1 : end;
         }
 
-        if (strlen(line) > 0) {
-            GitFileStatusEntry entry;
-            if (parse_status_line(line, &entry)) {
-                result->entries[result->count++] = entry;
-            }
+        int added, removed;
+        if (path != NULL && sscanf(record, "%d\t%d", &added, &removed) == 2) {
+            on_repo_numstat(list, path, added, removed);
         }
+        record = next;
+    }
+    free(output);
+}
 
-        if (newline == NULL) break;
-        line = newline + 1;
+// Helper: line counts for a sorted list, in-process through libgit2 when built with it
+static void read_numstat(const GitRepoPaths *paths, char *const *specs, int spec_count, StatusList *list)
+{
+    bool tracked = false;
+    for (int i = 0; i < list->count && !tracked; i++) {
+        tracked = list->entries[i].index_status != '?';
+    }
+    if (!tracked) {
+        return;
+    }
+    if (!git_repo_cache_numstat(paths->root, (const char *const *)specs, spec_count, on_repo_numstat, list)) {
+        read_numstat_process(paths, specs, spec_count, list);
     }
+}
 
+// Helper: ahead/behind and file status from the open libgit2 repository, or from git
+// when built without libgit2. With spec_count > 0 only paths at or under specs are
+// read, and ahead/behind is left alone. With line_counts, changed files are counted too
+static bool read_status(const GitRepoPaths *paths, char *const *specs, int spec_count,
+                        bool recurse_untracked, bool line_counts, StatusList *list)
+{
+    bool whole_tree = spec_count == 0;
+    if (!git_repo_cache_status(paths->root, (const char *const *)specs, spec_count, recurse_untracked,
+                               whole_tree ? &list->ahead : NULL, whole_tree ? &list->behind : NULL,
+                               on_repo_status, list)) {
+        // Start over in case libgit2 failed partway
+        status_list_free(list);
+        if (!read_status_process(paths, specs, spec_count, recurse_untracked, list)) {
+            return false;
+        }
+    }
+    status_list_sort(list);
+    if (line_counts) {
+        read_numstat(paths, specs, spec_count, list);
+    }
     return true;
 }
 
-GitFileStatus git_get_file_status(const GitStatusResult *result, const char *filename)
+// Helper: identity of a file, to notice it was rewritten
+static FileStamp file_stamp(const char *path)
 {
-    if (result == NULL || result->entries == NULL || filename == NULL) {
-        return GIT_STATUS_NONE;
+    FileStamp stamp = { 0 };
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        stamp.exists = true;
+        stamp.ino = st.st_ino;
+        stamp.size = st.st_size;
+        stamp.mtime = st.st_mtime;
     }
+    return stamp;
+}
 
-    // Look for exact match or match at end of path
-    for (int i = 0; i < result->count; i++) {
-        const char *entry_path = result->entries[i].path;
+static bool same_stamp(const FileStamp *a, const FileStamp *b)
+{
+    return a->exists == b->exists && a->ino == b->ino && a->size == b->size && a->mtime == b->mtime;
+}
 
-        // Exact match
-        if (strcmp(entry_path, filename) == 0) {
-            return result->entries[i].status;
+// Helper: forget the cached status (call with mutex held)
+static void drop_cache_locked(void)
+{
+    status_list_free(&g_git.cached);
+    for (int i = 0; i < g_git.dirty_count; i++) {
+        free(g_git.dirty[i]);
+    }
+    g_git.dirty_count = 0;
+    g_git.cached_root[0] = '\0';
+    g_git.rescan_all = false;
+}
+
+// Helper: status of the repository, from the cache when its root is watched. A full scan
+// runs when the index, HEAD or refs moved or changes were lost; otherwise only the paths
+// reported dirty since the last refresh are rescanned, and nothing at all when none were
+static bool load_status(const GitRepoPaths *paths, const char *head, GitState *state,
+                        GitStatusResult *result, const char *dir)
+{
+    pthread_mutex_lock(&g_git.mutex);
+    bool watched = strcmp(g_git.watched_root, paths->root) == 0;
+    pthread_mutex_unlock(&g_git.mutex);
+
+    if (!watched) {
+        StatusList list = { 0 };
+        bool ok = read_status(paths, NULL, 0, result != NULL, result != NULL, &list);
+        if (ok) {
+            apply_status(&list, state, result, dir);
         }
+        status_list_free(&list);
+        return ok;
+    }
+
+    char index_path[GIT_FILE_PATH_LEN];
+    snprintf(index_path, sizeof(index_path), "%s/index", paths->git_dir);
+    FileStamp index = file_stamp(index_path);
+
+    // Take the dirty paths; any reported during the scan wait for the next refresh
+    pthread_mutex_lock(&g_git.mutex);
+    bool reuse = strcmp(g_git.cached_root, paths->root) == 0 && !g_git.rescan_all &&
+                 same_stamp(&g_git.cached_index, &index) && strcmp(g_git.cached_head, head) == 0;
+    char **dirty = NULL;
+    int dirty_count = 0;
+    if (reuse) {
+        dirty = g_git.dirty;
+        dirty_count = g_git.dirty_count;
+        g_git.dirty = NULL;
+        g_git.dirty_count = 0;
+    } else {
+        drop_cache_locked();
+    }
+    pthread_mutex_unlock(&g_git.mutex);
 
-        // Match filename at end of path (for when we have full path but entry has relative)
-        size_t filename_len = strlen(filename);
-        size_t entry_len = strlen(entry_path);
+    StatusList fresh = { 0 };
+    bool ok = true;
+    if (dirty_count > 0) {
+        ok = read_status(paths, dirty, dirty_count, true, true, &fresh);
+    }
+    if (!reuse || !ok) {
+        // A path git refuses (inside a submodule, say) falls back to the whole tree
+        status_list_free(&fresh);
+        reuse = false;
+        ok = read_status(paths, NULL, 0, true, true, &fresh);
+    }
 
-        if (entry_len < filename_len) {
-            // Check if filename ends with entry_path
-            const char *suffix = filename + filename_len - entry_len;
-            if (suffix > filename && suffix[-1] == '/' && strcmp(suffix, entry_path) == 0) {
-                return result->entries[i].status;
+    pthread_mutex_lock(&g_git.mutex);
+    if (!ok) {
+        drop_cache_locked();
+    } else if (!reuse) {
+        status_list_free(&g_git.cached);
+        g_git.cached = fresh;
+        memset(&fresh, 0, sizeof(fresh));
+        snprintf(g_git.cached_root, sizeof(g_git.cached_root), "%s", paths->root);
+        snprintf(g_git.cached_head, sizeof(g_git.cached_head), "%s", head);
+        g_git.cached_index = index;
+    } else if (dirty_count > 0 && strcmp(g_git.cached_root, paths->root) == 0) {
+        status_list_remove_under(&g_git.cached, dirty, dirty_count);
+        for (int i = 0; i < fresh.count; i++) {
+            StatusEntry *entry = status_list_add(&g_git.cached, fresh.entries[i].path,
+                                                 fresh.entries[i].index_status, fresh.entries[i].worktree_status);
+            if (entry != NULL) {
+                entry->added = fresh.entries[i].added;
+                entry->removed = fresh.entries[i].removed;
             }
-        } else if (entry_len > filename_len) {
-            // Check if entry_path ends with filename
-            const char *suffix = entry_path + entry_len - filename_len;
-            if (suffix > entry_path && suffix[-1] == '/' && strcmp(suffix, filename) == 0) {
-                return result->entries[i].status;
+        }
+        status_list_sort(&g_git.cached);
+    }
+    if (ok) {
+        apply_status(&g_git.cached, state, result, dir);
+    }
+    pthread_mutex_unlock(&g_git.mutex);
+
+    status_list_free(&fresh);
+    for (int i = 0; i < dirty_count; i++) {
+        free(dirty[i]);
+    }
+    free(dirty);
+    return ok;
+}
+
+bool git_refresh(GitState *state, GitStatusResult *result, const char *path)
+{
+    git_state_init(state);
+    if (result != NULL) {
+        git_status_result_init(result);
+    }
+
+    GitRepoPaths paths;
+    char resolved[PATH_MAX];
+    if (!find_repo(path, &paths) || realpath(path, resolved) == NULL) {
+        return false;
+    }
+    state->is_repo = true;
+    snprintf(state->repo_root, sizeof(state->repo_root), "%s", paths.root);
+
+    read_head(&paths, state->branch, sizeof(state->branch), &state->is_detached);
+    state->has_stash = has_stash_ref(&paths);
+
+    // Files are listed relative to the root; keep those under path
+    const char *dir = resolved + strlen(paths.root);
+    if (*dir == '/') {
+        dir++;
+    }
+    if (!load_status(&paths, state->branch, state, result, dir)) {
+        return false;
+    }
+    if (result != NULL) {
+        result->base_length = dir[0] != '\0' ? (int)strlen(dir) + 1 : 0;
+        index_result(result);
+    }
+    return true;
+}
+
+bool git_update_state(GitState *state, const char *path)
+{
+    git_refresh(state, NULL, path);
+    return state->is_repo;
+}
+
+bool git_get_status(const char *path, GitStatusResult *result)
+{
+    GitState state;
+    return git_refresh(&state, result, path);
+}
+
+void git_status_watch(const char *root)
+{
+    char resolved[PATH_MAX];
+    if (root == NULL || root[0] == '\0' || realpath(root, resolved) == NULL) {
+        resolved[0] = '\0';
+    }
+
+    pthread_mutex_lock(&g_git.mutex);
+    if (strcmp(g_git.watched_root, resolved) != 0) {
+        // Changes to the old root went unreported from here on, and the new one's were
+        // never reported, so neither can use what is cached
+        snprintf(g_git.watched_root, sizeof(g_git.watched_root), "%s", resolved);
+        drop_cache_locked();
+    }
+    pthread_mutex_unlock(&g_git.mutex);
+}
+
+void git_status_mark_dirty(const char *path)
+{
+    if (path == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_git.mutex);
+    size_t root_len = strlen(g_git.watched_root);
+    if (root_len == 0 || g_git.rescan_all || strncmp(path, g_git.watched_root, root_len) != 0 ||
+        (path[root_len] != '/' && path[root_len] != '\0')) {
+        pthread_mutex_unlock(&g_git.mutex);
+        return;
+    }
+
+    char relative[GIT_PATH_MAX_LEN];
+    snprintf(relative, sizeof(relative), "%s", path[root_len] == '/' ? path + root_len + 1 : "");
+
+    // A .gitignore decides the status of everything beside and below it
+    char *slash = strrchr(relative, '/');
+    const char *name = slash != NULL ? slash + 1 : relative;
+    if (strcmp(name, ".gitignore") == 0) {
+        if (slash != NULL) {
+            *slash = '\0';
+        } else {
+            relative[0] = '\0';
+        }
+    }
+
+    bool covered = false;
+    for (int i = 0; i < g_git.dirty_count && !covered; i++) {
+        covered = path_under(relative, g_git.dirty[i]);
+    }
+    if (!covered) {
+        if (relative[0] == '\0' || g_git.dirty_count >= GIT_STATUS_DIRTY_MAX) {
+            g_git.rescan_all = true;
+        } else {
+            if (g_git.dirty == NULL) {
+                g_git.dirty = malloc(GIT_STATUS_DIRTY_MAX * sizeof(char *));
+            }
+            char *copy = g_git.dirty != NULL ? strdup(relative) : NULL;
+            if (copy != NULL) {
+                g_git.dirty[g_git.dirty_count++] = copy;
+            } else {
+                g_git.rescan_all = true;
             }
         }
     }
+    pthread_mutex_unlock(&g_git.mutex);
+}
+
+void git_status_invalidate(void)
+{
+    pthread_mutex_lock(&g_git.mutex);
+    g_git.rescan_all = true;
+    pthread_mutex_unlock(&g_git.mutex);
+}
 
+void git_release_cache(void)
+{
+    pthread_mutex_lock(&g_git.mutex);
+    drop_cache_locked();
+    free(g_git.dirty);
+    g_git.dirty = NULL;
+    g_git.watched_root[0] = '\0';
+    pthread_mutex_unlock(&g_git.mutex);
+
+    git_repo_cache_release();
+}
+
+GitFileStatus git_get_file_status(const GitStatusResult *result, const char *filename)
+{
+    if (result == NULL || result->entries == NULL || filename == NULL) {
+        return GIT_STATUS_NONE;
+    }
+
+    int length = (int)strlen(filename);
+    if (result->buckets != NULL) {
+        int found = find_slot(result, filename, length, hash_fnv1a_bytes(HASH_FNV1A_INIT, filename, (size_t)length));
+        return found >= 0 ? result->slots[found].status : GIT_STATUS_NONE;
+    }
+
+    // Not indexed (out of memory): scan for the file itself
+    for (int i = 0; i < result->count; i++) {
+        if (strcmp(result->entries[i].path + result->base_length, filename) == 0) {
+            return result->entries[i].status;
+        }
+    }
     return GIT_STATUS_NONE;
 }
 
+bool git_get_file_stats(const GitStatusResult *result, const char *filename, int *added, int *removed)
+{
+    *added = 0;
+    *removed = 0;
+    if (result == NULL || result->buckets == NULL || filename == NULL) {
+        return false;
+    }
+
+    int length = (int)strlen(filename);
+    int found = find_slot(result, filename, length, hash_fnv1a_bytes(HASH_FNV1A_INIT, filename, (size_t)length));
+    if (found < 0 || result->slots[found].added < 0) {
+        return false;
+    }
+    *added = result->slots[found].added;
+    *removed = result->slots[found].removed;
+    return true;
+}
+
 bool git_get_diff(const char *repo_path, const char *file_path, char *diff, size_t diff_size)
 {
     char args[GIT_PATH_MAX_LEN + 32];
@@ -347,24 +1220,37 @@ bool git_get_diff_stats(const char *repo_path, const char *file_path, int *added
     *added = 0;
     *removed = 0;
 
-    char args[GIT_PATH_MAX_LEN + 64];
-    snprintf(args, sizeof(args), "diff --numstat -- \"%s\"", file_path);
-
-    char output[256];
-    if (run_git_command(repo_path, args, output, sizeof(output))) {
-        if (sscanf(output, "%d\t%d", added, removed) == 2) {
+    // The watched repository's counts are cached with its status
+    char resolved[PATH_MAX];
+    if (repo_path != NULL && realpath(repo_path, resolved) != NULL) {
+        pthread_mutex_lock(&g_git.mutex);
+        size_t root_len = strlen(g_git.cached_root);
+        const char *relative = NULL;
+        if (root_len > 0 && strcmp(resolved, g_git.cached_root) == 0) {
+            relative = file_path;
+            if (strncmp(file_path, g_git.cached_root, root_len) == 0 && file_path[root_len] == '/') {
+                relative = file_path + root_len + 1;
+            }
+        }
+        const StatusEntry *entry = relative != NULL ? status_list_find(&g_git.cached, relative) : NULL;
+        bool cached = entry != NULL && entry->added >= 0;
+        if (cached) {
+            *added = entry->added;
+            *removed = entry->removed;
+        }
+        pthread_mutex_unlock(&g_git.mutex);
+        if (cached) {
             return true;
         }
     }
 
-    // Try staged diff
-    snprintf(args, sizeof(args), "diff --cached --numstat -- \"%s\"", file_path);
-    if (run_git_command(repo_path, args, output, sizeof(output))) {
-        sscanf(output, "%d\t%d", added, removed);
-        return true;
-    }
+    // Staged and unstaged changes together
+    char args[GIT_PATH_MAX_LEN + 64];
+    snprintf(args, sizeof(args), "diff HEAD --numstat -- \"%s\"", file_path);
 
-    return false;
+    char output[256];
+    return run_git_command(repo_path, args, output, sizeof(output)) &&
+           sscanf(output, "%d\t%d", added, removed) == 2;
 }
 
 bool git_quick_commit(const char *repo_path, const char *message)
@@ -3,9 +3,11 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #define GIT_BRANCH_MAX_LEN 128
 #define GIT_PATH_MAX_LEN 4096
+#define GIT_STATUS_DIRTY_MAX 256    // Dirty paths kept before the whole tree is rescanned
 
 // Git file status (matches git status --porcelain output)
 typedef enum GitFileStatus {
@@ -38,13 +40,31 @@ typedef struct GitFileStatusEntry {
     char path[GIT_PATH_MAX_LEN];
     GitFileStatus status;
     GitFileStatus staged_status;            // Status in index (staged area)
+    int added;                              // Lines against HEAD, staged and not; -1 if not
+    int removed;                            // counted (untracked or binary)
 } GitFileStatusEntry;
 
+// One key of a status result's index: a changed file, or a directory holding changed files
+typedef struct GitStatusIndexSlot {
+    const char *path;                       // Into an entry's path, relative to the directory read
+    int length;                             // Key bytes (not NUL-terminated for directories)
+    uint32_t hash;
+    GitFileStatus status;                   // The file's, or the most pressing one below the directory
+    int added;                              // The file's line counts, or the sum of those below
+    int removed;                            // the directory; -1 if none were counted
+    int chain;                              // Next slot in the same bucket, or -1
+} GitStatusIndexSlot;
+
 // Git status result for a directory
 typedef struct GitStatusResult {
-    GitFileStatusEntry *entries;
+    GitFileStatusEntry *entries;            // Paths relative to the repository root
     int count;
     int capacity;
+    int base_length;                        // Leading "dir/" of every path, left out of lookups
+    GitStatusIndexSlot *slots;              // Built once the entries are read
+    int slot_count;
+    int *buckets;
+    uint32_t bucket_mask;
 } GitStatusResult;
 
 // Initialize git state
@@ -59,9 +79,36 @@ bool git_is_repo(const char *path);
 // Get the root directory of the git repository containing path
 bool git_get_repo_root(const char *path, char *root, size_t root_size);
 
+// Update git state and, unless result is NULL, the status and line counts of every
+// changed file under path in one pass. Repository, branch and stash are read from .git directly; ahead/behind
+// and file status come from libgit2 when built with it (the repository stays open between
+// calls), otherwise from a single git status process. In the watched repository the
+// status is cached instead, and only rescanned where changes were reported. False if path
+// is outside a repository or the status could not be read
+bool git_refresh(GitState *state, GitStatusResult *result, const char *path);
+
+// Cache the status of the repository at root between refreshes (NULL or "" to stop).
+// From now on the caller must report every change under root, with
+// git_status_mark_dirty or git_status_invalidate
+void git_status_watch(const char *root);
+
+// A path under the watched root changed: the next refresh rescans it and everything below
+// it. Changes to the index and HEAD are noticed without a report
+void git_status_mark_dirty(const char *path);
+
+// Rescan the whole watched repository on the next refresh (changes were lost, or refs moved)
+void git_status_invalidate(void);
+
+// Close the repository git_refresh keeps open and drop the cached status
+void git_release_cache(void);
+
 // Update git state for the given directory
 bool git_update_state(GitState *state, const char *path);
 
+// Get the commit HEAD points at (hex object id) for the repository containing path,
+// read from .git without running git. False outside a repository and before its first commit
+bool git_head_commit(const char *path, char *id, size_t id_size);
+
 // Get current branch name
 bool git_get_branch(const char *repo_path, char *branch, size_t branch_size);
 
@@ -74,13 +121,21 @@ void git_status_result_free(GitStatusResult *result);
 // Get git status for files in a directory
 bool git_get_status(const char *path, GitStatusResult *result);
 
-// Get status for a single file (relative to repo root)
+// Get status for a file or directory, by its path relative to the directory the status was
+// read for (a bare name for its direct children). A directory reports the most pressing
+// status of the files below it: conflict, then modified, deleted, renamed, staged, untracked
 GitFileStatus git_get_file_status(const GitStatusResult *result, const char *filename);
 
+// Get the lines added and removed against HEAD for a file or directory, by the same
+// relative path as git_get_file_status (a directory sums the files below it). False if
+// none were counted: nothing changed, or only untracked or binary files
+bool git_get_file_stats(const GitStatusResult *result, const char *filename, int *added, int *removed);
+
 // Get diff for a file
 bool git_get_diff(const char *repo_path, const char *file_path, char *diff, size_t diff_size);
 
-// Get diff stats (lines added/removed)
+// Get diff stats (lines added/removed against HEAD), from the watched repository's cached
+// status when it has them, otherwise from a git process
 bool git_get_diff_stats(const char *repo_path, const char *file_path, int *added, int *removed);
 
 // Quick commit (stage all and commit)
@@ -0,0 +1,139 @@
+#include "git_async.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct GitAsync {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool stopping;
+
+    // Requests (main thread)
+    uint32_t requested;                 // Generation of the latest request
+    uint32_t started;                   // Generation the thread last began reading
+    char path[GIT_PATH_MAX_LEN];        // Directory of the latest request
+
+    // Finished read, waiting to be taken
+    bool ready;
+    char ready_path[GIT_PATH_MAX_LEN];
+    GitState state;
+    GitStatusResult result;
+
+    char reading[GIT_PATH_MAX_LEN];     // Directory being read (thread only)
+};
+
+static void *git_async_thread(void *arg)
+{
+    GitAsync *async = arg;
+
+    pthread_mutex_lock(&async->mutex);
+    while (!async->stopping) {
+        if (async->started == async->requested) {
+            pthread_cond_wait(&async->cond, &async->mutex);
+            continue;
+        }
+        async->started = async->requested;
+        snprintf(async->reading, sizeof(async->reading), "%s", async->path);
+        pthread_mutex_unlock(&async->mutex);
+
+        GitState state;
+        GitStatusResult result;
+        git_refresh(&state, &result, async->reading);
+
+        pthread_mutex_lock(&async->mutex);
+        if (strcmp(async->reading, async->path) != 0) {
+            // Navigated elsewhere meanwhile: nobody wants this directory any more
+            git_status_result_free(&result);
+            continue;
+        }
+
+        // A newer request for the same directory still gets its own read, but this one
+        // is shown meanwhile, so a steady stream of changes cannot starve the badges
+        git_status_result_free(&async->result);
+        async->state = state;
+        async->result = result;
+        snprintf(async->ready_path, sizeof(async->ready_path), "%s", async->reading);
+        async->ready = true;
+    }
+    pthread_mutex_unlock(&async->mutex);
+    return NULL;
+}
+
+GitAsync* git_async_create(void)
+{
+    GitAsync *async = calloc(1, sizeof(GitAsync));
+    if (async == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&async->mutex, NULL);
+    pthread_cond_init(&async->cond, NULL);
+    git_status_result_init(&async->result);
+
+    if (pthread_create(&async->thread, NULL, git_async_thread, async) != 0) {
+        pthread_cond_destroy(&async->cond);
+        pthread_mutex_destroy(&async->mutex);
+        free(async);
+        return NULL;
+    }
+    return async;
+}
+
+void git_async_destroy(GitAsync *async)
+{
+    if (async == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&async->mutex);
+    async->stopping = true;
+    pthread_cond_signal(&async->cond);
+    pthread_mutex_unlock(&async->mutex);
+    pthread_join(async->thread, NULL);
+
+    git_status_result_free(&async->result);
+    pthread_cond_destroy(&async->cond);
+    pthread_mutex_destroy(&async->mutex);
+    free(async);
+}
+
+void git_async_request(GitAsync *async, const char *path)
+{
+    if (async == NULL || path == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&async->mutex);
+    async->requested++;
+    snprintf(async->path, sizeof(async->path), "%s", path);
+    if (async->ready && strcmp(async->ready_path, path) != 0) {
+        git_status_result_free(&async->result);
+        async->ready = false;
+    }
+    pthread_cond_signal(&async->cond);
+    pthread_mutex_unlock(&async->mutex);
+}
+
+bool git_async_poll(GitAsync *async, GitState *state, GitStatusResult *result,
+                    char *path, size_t path_size)
+{
+    if (async == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&async->mutex);
+    bool ready = async->ready;
+    if (ready) {
+        git_status_result_free(result);
+        *state = async->state;
+        *result = async->result;
+        git_status_result_init(&async->result);
+        snprintf(path, path_size, "%s", async->ready_path);
+        async->ready = false;
+    }
+    pthread_mutex_unlock(&async->mutex);
+    return ready;
+}
@@ -0,0 +1,31 @@
+#ifndef GIT_ASYNC_H
+#define GIT_ASYNC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "git.h"
+
+// Git state and file status read by git_refresh on a background thread, so navigating
+// never waits on git. Requests are numbered by generation and only the latest is read;
+// a read that finishes after the request moved to another directory is dropped
+
+// Git reader context (opaque)
+typedef struct GitAsync GitAsync;
+
+// Create a reader and start its thread; NULL on failure
+GitAsync* git_async_create(void);
+
+// Wait out a read in progress, stop the thread and free the reader
+void git_async_destroy(GitAsync *async);
+
+// Read the git state and status of path in the background, replacing any request not
+// yet started
+void git_async_request(GitAsync *async, const char *path);
+
+// Take the finished read of the latest requested directory: state and *result are
+// replaced (the old result freed) and path set to the directory read. False while the
+// read is in progress or once it has been taken
+bool git_async_poll(GitAsync *async, GitState *state, GitStatusResult *result,
+                    char *path, size_t path_size);
+
+#endif // GIT_ASYNC_H
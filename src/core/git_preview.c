@@ -0,0 +1,448 @@
+#include "git_preview.h"
+#include "git.h"
+
+#include <CommonCrypto/CommonDigest.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+struct GitPreviewText {
+    atomic_int refs;
+    char *data;
+    size_t size;
+};
+
+// A finished text and what it was read for
+typedef struct CacheSlot {
+    GitPreviewText *text;                   // NULL when free
+    GitPreviewMode mode;
+    char path[GIT_PATH_MAX_LEN];
+    char head[GIT_PREVIEW_ID_LEN];
+    char blob[GIT_PREVIEW_ID_LEN];          // Diffs only: the file's content
+    ino_t ino;                              // Stat of the file when blob was hashed
+    off_t size;
+    time_t mtime;
+    uint64_t used;
+} CacheSlot;
+
+// Output read so far, in pages that never move
+typedef struct PageList {
+    char **pages;
+    int count;
+    int capacity;
+    size_t last_used;                       // Bytes in the last page
+    size_t total;
+} PageList;
+
+struct GitPreview {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool stopping;
+
+    // Requests (main thread)
+    uint32_t requested;
+    uint32_t started;                       // Request the thread last took
+    char path[GIT_PATH_MAX_LEN];
+    GitPreviewMode mode;
+
+    // Result of the latest request
+    GitPreviewStatus status;
+    GitPreviewText *ready;
+
+    // Thread only
+    CacheSlot cache[GIT_PREVIEW_CACHE];
+    uint64_t clock;
+};
+
+// Helper: New text owning data, with one reference
+static GitPreviewText* text_create(char *data, size_t size)
+{
+    GitPreviewText *text = malloc(sizeof(GitPreviewText));
+    if (!text) {
+        free(data);
+        return NULL;
+    }
+    atomic_init(&text->refs, 1);
+    text->data = data;
+    text->size = size;
+    return text;
+}
+
+static GitPreviewText* text_retain(GitPreviewText *text)
+{
+    if (text) {
+        atomic_fetch_add(&text->refs, 1);
+    }
+    return text;
+}
+
+void git_preview_text_release(GitPreviewText *text)
+{
+    if (text && atomic_fetch_sub(&text->refs, 1) == 1) {
+        free(text->data);
+        free(text);
+    }
+}
+
+const char* git_preview_text_data(const GitPreviewText *text)
+{
+    return text ? text->data : "";
+}
+
+size_t git_preview_text_size(const GitPreviewText *text)
+{
+    return text ? text->size : 0;
+}
+
+bool git_preview_blob_id(const char *path, char *id, size_t id_size)
+{
+    FILE *fp = fopen(path, "rb");
+    struct stat st;
+    if (!fp || fstat(fileno(fp), &st) != 0 || !S_ISREG(st.st_mode) || id_size < CC_SHA1_DIGEST_LENGTH * 2 + 1) {
+        if (fp) fclose(fp);
+        return false;
+    }
+
+    // "blob <size>\0" and the content, as git hashes a file it stores
+    CC_SHA1_CTX ctx;
+    CC_SHA1_Init(&ctx);
+    char header[32];
+    int header_len = snprintf(header, sizeof(header), "blob %lld", (long long)st.st_size);
+    CC_SHA1_Update(&ctx, header, (CC_LONG)header_len + 1);
+
+    char *buffer = malloc(GIT_PREVIEW_PAGE);
+    size_t bytes;
+    while (buffer && (bytes = fread(buffer, 1, GIT_PREVIEW_PAGE, fp)) > 0) {
+        CC_SHA1_Update(&ctx, buffer, (CC_LONG)bytes);
+    }
+    bool ok = buffer && !ferror(fp);
+    free(buffer);
+    fclose(fp);
+
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1_Final(digest, &ctx);
+    for (int i = 0; ok && i < CC_SHA1_DIGEST_LENGTH; i++) {
+        snprintf(id + i * 2, 3, "%02x", digest[i]);
+    }
+    return ok;
+}
+
+// Helper: Append text to command in single quotes for the shell; false if it does not fit
+static bool append_quoted(char *command, size_t size, const char *text)
+{
+    size_t length = strlen(command);
+    if (length + 3 >= size) {
+        return false;
+    }
+    command[length++] = ' ';
+    command[length++] = '\'';
+    for (const char *c = text; *c; c++) {
+        const char *piece = *c == '\'' ? "'\\''" : NULL;
+        size_t piece_len = piece ? 4 : 1;
+        if (length + piece_len + 2 >= size) {
+            return false;
+        }
+        if (piece) {
+            memcpy(command + length, piece, piece_len);
+        } else {
+            command[length] = *c;
+        }
+        length += piece_len;
+    }
+    command[length++] = '\'';
+    command[length] = '\0';
+    return true;
+}
+
+// Helper: Whether the request being read has been replaced (or the loader is stopping)
+static bool superseded(GitPreview *preview)
+{
+    pthread_mutex_lock(&preview->mutex);
+    bool gone = preview->stopping || preview->started != preview->requested;
+    pthread_mutex_unlock(&preview->mutex);
+    return gone;
+}
+
+static void page_list_free(PageList *list)
+{
+    for (int i = 0; i < list->count; i++) {
+        free(list->pages[i]);
+    }
+    free(list->pages);
+    memset(list, 0, sizeof(PageList));
+}
+
+// Helper: Room for more output at the end of the last page (a fresh one when it is full)
+static char* page_list_tail(PageList *list, size_t *room)
+{
+    if (list->count == 0 || list->last_used == GIT_PREVIEW_PAGE) {
+        if (list->count == list->capacity) {
+            int capacity = list->capacity ? list->capacity * 2 : 16;
+            char **grown = realloc(list->pages, (size_t)capacity * sizeof(char *));
+            if (!grown) {
+                return NULL;
+            }
+            list->pages = grown;
+            list->capacity = capacity;
+        }
+        char *page = malloc(GIT_PREVIEW_PAGE);
+        if (!page) {
+            return NULL;
+        }
+        list->pages[list->count++] = page;
+        list->last_used = 0;
+    }
+    *room = GIT_PREVIEW_PAGE - list->last_used;
+    return list->pages[list->count - 1] + list->last_used;
+}
+
+// Helper: The pages as one NUL-terminated block (NULL when out of memory)
+static char* page_list_join(const PageList *list)
+{
+    char *joined = malloc(list->total + 1);
+    if (!joined) {
+        return NULL;
+    }
+    size_t at = 0;
+    for (int i = 0; i < list->count; i++) {
+        size_t used = i == list->count - 1 ? list->last_used : GIT_PREVIEW_PAGE;
+        memcpy(joined + at, list->pages[i], used);
+        at += used;
+    }
+    joined[at] = '\0';
+    return joined;
+}
+
+// Helper: Run git in root and collect all it prints. NULL if it failed or the request
+// was replaced while it ran (checked between reads, so a long log is left unread)
+static GitPreviewText* run_git(GitPreview *preview, const char *root, const char *relative, GitPreviewMode mode)
+{
+    char command[GIT_PATH_MAX_LEN * 3] = "cd";
+    if (!append_quoted(command, sizeof(command), root)) {
+        return NULL;
+    }
+    size_t length = strlen(command);
+    if (mode == GIT_PREVIEW_DIFF) {
+        snprintf(command + length, sizeof(command) - length,
+                 " && git --no-optional-locks diff HEAD --no-color --no-ext-diff --");
+    } else {
+        snprintf(command + length, sizeof(command) - length,
+                 " && git --no-optional-locks log --follow --no-color --date=short -n %d"
+                 " '--format=commit %%h%%nAuthor: %%an%%nDate:   %%ad%%n%%n    %%s%%n' --",
+                 GIT_PREVIEW_LOG_MAX);
+    }
+    if (!append_quoted(command, sizeof(command), relative) ||
+        strlen(command) + 16 >= sizeof(command)) {
+        return NULL;
+    }
+    strcat(command, " 2>/dev/null");
+
+    FILE *fp = popen(command, "r");
+    if (!fp) {
+        return NULL;
+    }
+
+    PageList list = { 0 };
+    bool ok = true;
+    for (;;) {
+        size_t room = 0;
+        char *tail = page_list_tail(&list, &room);
+        if (!tail) {
+            ok = false;
+            break;
+        }
+        size_t bytes = fread(tail, 1, room, fp);
+        list.last_used += bytes;
+        list.total += bytes;
+        if (bytes < room) {
+            break;
+        }
+        if (superseded(preview)) {
+            ok = false;
+            break;
+        }
+    }
+    ok = pclose(fp) == 0 && ok;
+
+    char *joined = ok ? page_list_join(&list) : NULL;
+    size_t total = list.total;
+    page_list_free(&list);
+    return joined ? text_create(joined, total) : NULL;
+}
+
+// Helper: Blob id of the file, reused from a cached diff while its stat is unchanged
+static bool file_blob(GitPreview *preview, const char *path, const struct stat *st, char *blob)
+{
+    for (int i = 0; i < GIT_PREVIEW_CACHE; i++) {
+        const CacheSlot *slot = &preview->cache[i];
+        if (slot->text && slot->mode == GIT_PREVIEW_DIFF && strcmp(slot->path, path) == 0 &&
+            slot->ino == st->st_ino && slot->size == st->st_size && slot->mtime == st->st_mtime) {
+            memcpy(blob, slot->blob, GIT_PREVIEW_ID_LEN);
+            return true;
+        }
+    }
+    return git_preview_blob_id(path, blob, GIT_PREVIEW_ID_LEN);
+}
+
+// Helper: Publish the outcome of the request being read, unless it was replaced
+static void publish(GitPreview *preview, GitPreviewStatus status, GitPreviewText *text)
+{
+    pthread_mutex_lock(&preview->mutex);
+    if (preview->started == preview->requested) {
+        git_preview_text_release(preview->ready);
+        preview->ready = text_retain(text);
+        preview->status = status;
+    }
+    pthread_mutex_unlock(&preview->mutex);
+}
+
+// Helper: Read one request: from the cache when the file and HEAD are as they were
+static void load(GitPreview *preview, const char *path, GitPreviewMode mode)
+{
+    char resolved[PATH_MAX];
+    char root[GIT_PATH_MAX_LEN];
+    struct stat st;
+    if (!realpath(path, resolved) || stat(resolved, &st) != 0 ||
+        !git_get_repo_root(resolved, root, sizeof(root))) {
+        publish(preview, GIT_PREVIEW_FAILED, NULL);
+        return;
+    }
+    size_t root_len = strlen(root);
+    const char *relative = resolved[root_len] == '/' ? resolved + root_len + 1 : "";
+
+    // No HEAD yet: nothing to diff against or look back on
+    CacheSlot key = { .mode = mode, .ino = st.st_ino, .size = st.st_size, .mtime = st.st_mtime };
+    snprintf(key.path, sizeof(key.path), "%s", resolved);
+    if (!git_head_commit(resolved, key.head, sizeof(key.head)) ||
+        (mode == GIT_PREVIEW_DIFF && !file_blob(preview, resolved, &st, key.blob))) {
+        publish(preview, GIT_PREVIEW_FAILED, NULL);
+        return;
+    }
+
+    CacheSlot *victim = &preview->cache[0];
+    for (int i = 0; i < GIT_PREVIEW_CACHE; i++) {
+        CacheSlot *slot = &preview->cache[i];
+        if (slot->text && slot->mode == mode && strcmp(slot->path, key.path) == 0 &&
+            strcmp(slot->head, key.head) == 0 && strcmp(slot->blob, key.blob) == 0) {
+            slot->used = ++preview->clock;
+            publish(preview, GIT_PREVIEW_READY, slot->text);
+            return;
+        }
+        if (!slot->text || (victim->text && slot->used < victim->used)) {
+            victim = slot;
+        }
+    }
+
+    GitPreviewText *text = run_git(preview, root, relative, mode);
+    if (!text) {
+        publish(preview, GIT_PREVIEW_FAILED, NULL);
+        return;
+    }
+
+    git_preview_text_release(victim->text);
+    *victim = key;
+    victim->text = text;
+    victim->used = ++preview->clock;
+    publish(preview, GIT_PREVIEW_READY, text);
+}
+
+static void *git_preview_thread(void *arg)
+{
+    GitPreview *preview = arg;
+    char path[GIT_PATH_MAX_LEN];
+
+    pthread_mutex_lock(&preview->mutex);
+    while (!preview->stopping) {
+        if (preview->started == preview->requested) {
+            pthread_cond_wait(&preview->cond, &preview->mutex);
+            continue;
+        }
+        preview->started = preview->requested;
+        snprintf(path, sizeof(path), "%s", preview->path);
+        GitPreviewMode mode = preview->mode;
+        pthread_mutex_unlock(&preview->mutex);
+
+        load(preview, path, mode);
+
+        pthread_mutex_lock(&preview->mutex);
+    }
+    pthread_mutex_unlock(&preview->mutex);
+    return NULL;
+}
+
+GitPreview* git_preview_create(void)
+{
+    GitPreview *preview = calloc(1, sizeof(GitPreview));
+    if (!preview) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&preview->mutex, NULL);
+    pthread_cond_init(&preview->cond, NULL);
+    if (pthread_create(&preview->thread, NULL, git_preview_thread, preview) != 0) {
+        pthread_cond_destroy(&preview->cond);
+        pthread_mutex_destroy(&preview->mutex);
+        free(preview);
+        return NULL;
+    }
+    return preview;
+}
+
+void git_preview_destroy(GitPreview *preview)
+{
+    if (!preview) {
+        return;
+    }
+
+    pthread_mutex_lock(&preview->mutex);
+    preview->stopping = true;
+    pthread_cond_signal(&preview->cond);
+    pthread_mutex_unlock(&preview->mutex);
+    pthread_join(preview->thread, NULL);
+
+    for (int i = 0; i < GIT_PREVIEW_CACHE; i++) {
+        git_preview_text_release(preview->cache[i].text);
+    }
+    git_preview_text_release(preview->ready);
+    pthread_cond_destroy(&preview->cond);
+    pthread_mutex_destroy(&preview->mutex);
+    free(preview);
+}
+
+void git_preview_request(GitPreview *preview, const char *path, GitPreviewMode mode)
+{
+    if (!preview || !path) {
+        return;
+    }
+
+    pthread_mutex_lock(&preview->mutex);
+    preview->requested++;
+    snprintf(preview->path, sizeof(preview->path), "%s", path);
+    preview->mode = mode;
+    preview->status = GIT_PREVIEW_LOADING;
+    git_preview_text_release(preview->ready);
+    preview->ready = NULL;
+    pthread_cond_signal(&preview->cond);
+    pthread_mutex_unlock(&preview->mutex);
+}
+
+GitPreviewStatus git_preview_poll(GitPreview *preview, GitPreviewText **text)
+{
+    if (!preview) {
+        return GIT_PREVIEW_NONE;
+    }
+
+    pthread_mutex_lock(&preview->mutex);
+    GitPreviewStatus status = preview->status;
+    if (text) {
+        *text = status == GIT_PREVIEW_READY ? text_retain(preview->ready) : NULL;
+    }
+    pthread_mutex_unlock(&preview->mutex);
+    return status;
+}
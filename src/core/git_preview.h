@@ -0,0 +1,61 @@
+#ifndef GIT_PREVIEW_H
+#define GIT_PREVIEW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// A file's diff against HEAD and its history (git log --follow), for the preview pane.
+// Requests are read on a background thread, only the latest one; git's output streams
+// into fixed pages as it arrives, so nothing is cut off however long it runs, and is
+// joined into one text when complete. Finished texts are cached by the file's blob id
+// (hashed as git hash-object would, and only again once the file's stat changes) and the
+// HEAD commit, so coming back to a file runs no git at all
+
+#define GIT_PREVIEW_PAGE (64 * 1024)        // Bytes read into each page
+#define GIT_PREVIEW_CACHE 16                // Finished texts kept
+#define GIT_PREVIEW_LOG_MAX 1000            // Commits of history read
+#define GIT_PREVIEW_ID_LEN 65               // Hex object id (SHA-1 or SHA-256) and NUL
+
+typedef enum GitPreviewMode {
+    GIT_PREVIEW_DIFF,                       // git diff HEAD: staged and unstaged changes
+    GIT_PREVIEW_LOG                         // Commits that touched the file, across renames
+} GitPreviewMode;
+
+typedef enum GitPreviewStatus {
+    GIT_PREVIEW_NONE,                       // Nothing requested
+    GIT_PREVIEW_LOADING,
+    GIT_PREVIEW_READY,
+    GIT_PREVIEW_FAILED                      // Not in a repository, or git failed
+} GitPreviewStatus;
+
+// Finished output, shared between the cache and its readers (opaque)
+typedef struct GitPreviewText GitPreviewText;
+
+// Loader with its thread (opaque)
+typedef struct GitPreview GitPreview;
+
+// Create a loader and start its thread; NULL on failure
+GitPreview* git_preview_create(void);
+
+// Stop the thread (reading no further from a git process in progress) and free the
+// loader and its cache
+void git_preview_destroy(GitPreview *preview);
+
+// Read the diff or history of the file at path, replacing any earlier request
+void git_preview_request(GitPreview *preview, const char *path, GitPreviewMode mode);
+
+// State of the latest request. Once READY, *text (unless NULL) gets a reference to its
+// output, which stays valid until released
+GitPreviewStatus git_preview_poll(GitPreview *preview, GitPreviewText **text);
+
+// Output bytes (NUL-terminated) and their count
+const char* git_preview_text_data(const GitPreviewText *text);
+size_t git_preview_text_size(const GitPreviewText *text);
+
+// Drop a reference from git_preview_poll
+void git_preview_text_release(GitPreviewText *text);
+
+// Git's blob id of the file at path (hex into id); false if it cannot be read
+bool git_preview_blob_id(const char *path, char *id, size_t id_size);
+
+#endif // GIT_PREVIEW_H
@@ -0,0 +1,260 @@
+#include "git_repo_cache.h"
+
+#ifdef FINDER_PLUS_LIBGIT2
+
+#include <git2.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define REPO_ROOT_MAX_LEN 4096
+
+static struct {
+    pthread_mutex_t mutex;              // A git_repository is used by one thread at a time
+    bool initialized;
+    git_repository *repo;
+    char root[REPO_ROOT_MAX_LEN];
+} g_cache = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+// Helper: the repository at root, kept open until another one is asked for
+// (call with mutex held)
+static git_repository* open_locked(const char *root)
+{
+    if (!g_cache.initialized) {
+        g_cache.initialized = git_libgit2_init() > 0;
+        if (!g_cache.initialized) {
+            return NULL;
+        }
+    }
+    if (g_cache.repo != NULL && strcmp(g_cache.root, root) == 0) {
+        return g_cache.repo;
+    }
+
+    git_repository_free(g_cache.repo);
+    g_cache.repo = NULL;
+    g_cache.root[0] = '\0';
+    if (strlen(root) >= sizeof(g_cache.root) || git_repository_open(&g_cache.repo, root) != 0) {
+        g_cache.repo = NULL;
+        return NULL;
+    }
+    snprintf(g_cache.root, sizeof(g_cache.root), "%s", root);
+    return g_cache.repo;
+}
+
+// Helper: ahead/behind counts against the branch's upstream (left alone without one)
+static void read_ahead_behind(git_repository *repo, int *ahead, int *behind)
+{
+    git_reference *head = NULL;
+    git_reference *upstream = NULL;
+
+    if (git_repository_head(&head, repo) == 0 && git_reference_is_branch(head) &&
+        git_branch_upstream(&upstream, head) == 0) {
+        const git_oid *local = git_reference_target(head);
+        const git_oid *remote = git_reference_target(upstream);
+        size_t local_only = 0;
+        size_t remote_only = 0;
+        if (local != NULL && remote != NULL &&
+            git_graph_ahead_behind(&local_only, &remote_only, repo, local, remote) == 0) {
+            *ahead = (int)local_only;
+            *behind = (int)remote_only;
+        }
+    }
+
+    git_reference_free(upstream);
+    git_reference_free(head);
+}
+
+// Helper: porcelain XY codes for a libgit2 status
+static void status_codes(unsigned int flags, char *index_status, char *worktree_status)
+{
+    *index_status = ' ';
+    *worktree_status = ' ';
+
+    if (flags & GIT_STATUS_CONFLICTED) {
+        *index_status = 'U';
+        *worktree_status = 'U';
+        return;
+    }
+    if (flags & GIT_STATUS_WT_NEW) {
+        *index_status = '?';
+        *worktree_status = '?';
+        return;
+    }
+
+    if (flags & GIT_STATUS_INDEX_NEW)              *index_status = 'A';
+    else if (flags & GIT_STATUS_INDEX_MODIFIED)    *index_status = 'M';
+    else if (flags & GIT_STATUS_INDEX_DELETED)     *index_status = 'D';
+    else if (flags & GIT_STATUS_INDEX_RENAMED)     *index_status = 'R';
+    else if (flags & GIT_STATUS_INDEX_TYPECHANGE)  *index_status = 'T';
+
+    if (flags & GIT_STATUS_WT_MODIFIED)            *worktree_status = 'M';
+    else if (flags & GIT_STATUS_WT_DELETED)        *worktree_status = 'D';
+    else if (flags & GIT_STATUS_WT_RENAMED)        *worktree_status = 'R';
+    else if (flags & GIT_STATUS_WT_TYPECHANGE)     *worktree_status = 'T';
+}
+
+bool git_repo_cache_status(const char *root, const char *const *paths, int path_count,
+                           bool recurse_untracked, int *ahead, int *behind,
+                           GitRepoStatusFn fn, void *context)
+{
+    if (root == NULL || fn == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&g_cache.mutex);
+    git_repository *repo = open_locked(root);
+    if (repo == NULL) {
+        pthread_mutex_unlock(&g_cache.mutex);
+        return false;
+    }
+
+    if (ahead != NULL && behind != NULL) {
+        read_ahead_behind(repo, ahead, behind);
+    }
+
+    // Like git status: never writes the refreshed index back
+    git_status_options options;
+    git_status_options_init(&options, GIT_STATUS_OPTIONS_VERSION);
+    options.show = GIT_STATUS_SHOW_INDEX_AND_WORKDIR;
+    options.flags = GIT_STATUS_OPT_INCLUDE_UNTRACKED | GIT_STATUS_OPT_RENAMES_HEAD_TO_INDEX;
+    if (recurse_untracked) {
+        options.flags |= GIT_STATUS_OPT_RECURSE_UNTRACKED_DIRS;
+    }
+    if (path_count > 0) {
+        // Literal paths, each matching itself and everything below it
+        options.flags |= GIT_STATUS_OPT_DISABLE_PATHSPEC_MATCH;
+        options.pathspec.strings = (char **)paths;
+        options.pathspec.count = (size_t)path_count;
+    }
+
+    git_status_list *list = NULL;
+    bool ok = git_status_list_new(&list, repo, &options) == 0;
+    if (ok) {
+        size_t count = git_status_list_entrycount(list);
+        for (size_t i = 0; i < count; i++) {
+            const git_status_entry *status = git_status_byindex(list, i);
+            if (status == NULL || status->status == GIT_STATUS_CURRENT) {
+                continue;
+            }
+
+            // Renames report the new name, as porcelain does
+            const git_diff_delta *delta = status->index_to_workdir != NULL ? status->index_to_workdir
+                                                                           : status->head_to_index;
+            if (delta == NULL || delta->new_file.path == NULL) {
+                continue;
+            }
+
+            char index_status, worktree_status;
+            status_codes(status->status, &index_status, &worktree_status);
+            fn(context, delta->new_file.path, index_status, worktree_status);
+        }
+        git_status_list_free(list);
+    }
+
+    pthread_mutex_unlock(&g_cache.mutex);
+    return ok;
+}
+
+bool git_repo_cache_numstat(const char *root, const char *const *paths, int path_count,
+                            GitRepoNumstatFn fn, void *context)
+{
+    if (root == NULL || fn == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&g_cache.mutex);
+    git_repository *repo = open_locked(root);
+    if (repo == NULL) {
+        pthread_mutex_unlock(&g_cache.mutex);
+        return false;
+    }
+
+    // HEAD's tree; none yet in a repository without commits
+    git_object *head_tree = NULL;
+    git_reference *head = NULL;
+    if (git_repository_head(&head, repo) == 0) {
+        git_reference_peel(&head_tree, head, GIT_OBJECT_TREE);
+    }
+    git_reference_free(head);
+
+    git_diff_options options;
+    git_diff_options_init(&options, GIT_DIFF_OPTIONS_VERSION);
+    if (path_count > 0) {
+        options.flags |= GIT_DIFF_DISABLE_PATHSPEC_MATCH;
+        options.pathspec.strings = (char **)paths;
+        options.pathspec.count = (size_t)path_count;
+    }
+
+    git_diff *diff = NULL;
+    bool ok = git_diff_tree_to_workdir_with_index(&diff, repo, (git_tree *)head_tree, &options) == 0 &&
+              git_diff_find_similar(diff, NULL) == 0;
+    if (ok) {
+        size_t count = git_diff_num_deltas(diff);
+        for (size_t i = 0; i < count; i++) {
+            git_patch *patch = NULL;
+            if (git_patch_from_diff(&patch, diff, i) != 0 || patch == NULL) {
+                continue;
+            }
+            const git_diff_delta *delta = git_patch_get_delta(patch);
+            size_t added = 0;
+            size_t removed = 0;
+            if (delta != NULL && !(delta->flags & GIT_DIFF_FLAG_BINARY) && delta->new_file.path != NULL &&
+                git_patch_line_stats(NULL, &added, &removed, patch) == 0) {
+                fn(context, delta->new_file.path, (int)added, (int)removed);
+            }
+            git_patch_free(patch);
+        }
+    }
+    git_diff_free(diff);
+    git_object_free(head_tree);
+
+    pthread_mutex_unlock(&g_cache.mutex);
+    return ok;
+}
+
+void git_repo_cache_release(void)
+{
+    pthread_mutex_lock(&g_cache.mutex);
+    git_repository_free(g_cache.repo);
+    g_cache.repo = NULL;
+    g_cache.root[0] = '\0';
+    if (g_cache.initialized) {
+        git_libgit2_shutdown();
+        g_cache.initialized = false;
+    }
+    pthread_mutex_unlock(&g_cache.mutex);
+}
+
+#else
+
+bool git_repo_cache_status(const char *root, const char *const *paths, int path_count,
+                           bool recurse_untracked, int *ahead, int *behind,
+                           GitRepoStatusFn fn, void *context)
+{
+    (void)root;
+    (void)paths;
+    (void)path_count;
+    (void)recurse_untracked;
+    (void)ahead;
+    (void)behind;
+    (void)fn;
+    (void)context;
+    return false;
+}
+
+bool git_repo_cache_numstat(const char *root, const char *const *paths, int path_count,
+                            GitRepoNumstatFn fn, void *context)
+{
+    (void)root;
+    (void)paths;
+    (void)path_count;
+    (void)fn;
+    (void)context;
+    return false;
+}
+
+void git_repo_cache_release(void)
+{
+}
+
+#endif // FINDER_PLUS_LIBGIT2
@@ -0,0 +1,37 @@
+#ifndef GIT_REPO_CACHE_H
+#define GIT_REPO_CACHE_H
+
+#include <stdbool.h>
+
+// In-process git status through libgit2, with the last repository kept open so moving
+// between its directories reopens nothing. Kept apart from git.c because libgit2's
+// headers define names (GIT_STATUS_IGNORED, ...) that clash with GitFileStatus.
+// Without FINDER_PLUS_LIBGIT2 every call fails and git.c runs git instead
+
+// One changed path (relative to the work tree root) with its porcelain XY codes:
+// index_status is the staged column, worktree_status the unstaged one, '?' in both
+// when untracked and 'U' in both when conflicted
+typedef void (*GitRepoStatusFn)(void *context, const char *path, char index_status, char worktree_status);
+
+// Report ahead/behind against the upstream (unless ahead and behind are NULL) and every
+// changed path of the work tree at root, or only those at or under the path_count paths
+// given (relative to root). Untracked directories are reported file by file only with
+// recurse_untracked. False if libgit2 is unavailable or cannot read the repository
+bool git_repo_cache_status(const char *root, const char *const *paths, int path_count,
+                           bool recurse_untracked, int *ahead, int *behind,
+                           GitRepoStatusFn fn, void *context);
+
+// One changed file (relative to root) with its lines added and removed against HEAD
+typedef void (*GitRepoNumstatFn)(void *context, const char *path, int added, int removed);
+
+// Report line counts for every file whose work tree or index differs from HEAD, or only
+// those at or under the path_count paths given, as git diff HEAD --numstat would (renames
+// under the new name; binary files are left out). False if libgit2 is unavailable or
+// cannot read the repository
+bool git_repo_cache_numstat(const char *root, const char *const *paths, int path_count,
+                            GitRepoNumstatFn fn, void *context);
+
+// Close the open repository
+void git_repo_cache_release(void);
+
+#endif // GIT_REPO_CACHE_H
@@ -0,0 +1,269 @@
+#include "listing_prefetch.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Listing wanted from the thread
+typedef struct PrefetchRequest {
+    char path[PATH_MAX_LEN];
+    bool show_hidden;
+    bool debounced;
+    double not_before;                  // Realtime seconds; 0 = right away
+} PrefetchRequest;
+
+// Listing read, waiting to be taken
+typedef struct PrefetchResult {
+    char path[PATH_MAX_LEN];
+    DirectoryState listing;
+} PrefetchResult;
+
+struct ListingPrefetch {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool stopping;
+
+    PrefetchRequest pending[LISTING_PREFETCH_MAX];  // Oldest first
+    int pending_count;
+
+    PrefetchResult done[LISTING_PREFETCH_MAX];      // Oldest first
+    int done_count;
+
+    char failed[LISTING_PREFETCH_MAX][PATH_MAX_LEN];  // Unreadable paths, not retried
+    int failed_next;                    // Ring position of the next failure
+
+    char reading[PATH_MAX_LEN];         // Path being read ("" when idle)
+};
+
+// Helper: Realtime clock in seconds (the clock pthread_cond_timedwait waits on)
+static double prefetch_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Helper: Whether reading path failed recently (call with mutex held)
+static bool failed_locked(ListingPrefetch *prefetch, const char *path)
+{
+    for (int i = 0; i < LISTING_PREFETCH_MAX; i++) {
+        if (strcmp(prefetch->failed[i], path) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Helper: Remove a pending request (call with mutex held)
+static void pending_remove(ListingPrefetch *prefetch, int index)
+{
+    memmove(&prefetch->pending[index], &prefetch->pending[index + 1],
+            (size_t)(prefetch->pending_count - index - 1) * sizeof(PrefetchRequest));
+    prefetch->pending_count--;
+}
+
+// Helper: The next request due, or -1 with *wake_at set to when a debounced one
+// will be (0 if none is waiting) (call with mutex held)
+static int pending_next(ListingPrefetch *prefetch, double now, double *wake_at)
+{
+    *wake_at = 0;
+    for (int i = 0; i < prefetch->pending_count; i++) {
+        double due = prefetch->pending[i].not_before;
+        if (due <= now) {
+            return i;
+        }
+        if (*wake_at == 0 || due < *wake_at) {
+            *wake_at = due;
+        }
+    }
+    return -1;
+}
+
+// Thread function: Read requested listings, oldest due request first
+static void *prefetch_thread(void *arg)
+{
+    ListingPrefetch *prefetch = arg;
+
+    pthread_mutex_lock(&prefetch->mutex);
+    while (!prefetch->stopping) {
+        double wake_at;
+        int next = pending_next(prefetch, prefetch_now(), &wake_at);
+        if (next < 0) {
+            if (wake_at > 0) {
+                struct timespec deadline;
+                deadline.tv_sec = (time_t)wake_at;
+                deadline.tv_nsec = (long)((wake_at - (double)deadline.tv_sec) * 1e9);
+                pthread_cond_timedwait(&prefetch->cond, &prefetch->mutex, &deadline);
+            } else {
+                pthread_cond_wait(&prefetch->cond, &prefetch->mutex);
+            }
+            continue;
+        }
+
+        PrefetchRequest request = prefetch->pending[next];
+        pending_remove(prefetch, next);
+        snprintf(prefetch->reading, sizeof(prefetch->reading), "%s", request.path);
+        pthread_mutex_unlock(&prefetch->mutex);
+
+        DirectoryState listing;
+        directory_state_init(&listing);
+        listing.show_hidden = request.show_hidden;
+        bool ok = directory_read(&listing, request.path);
+
+        pthread_mutex_lock(&prefetch->mutex);
+        prefetch->reading[0] = '\0';
+        if (!ok) {
+            snprintf(prefetch->failed[prefetch->failed_next], PATH_MAX_LEN, "%s", request.path);
+            prefetch->failed_next = (prefetch->failed_next + 1) % LISTING_PREFETCH_MAX;
+        }
+        if (!ok || prefetch->stopping) {
+            directory_state_free(&listing);
+            continue;
+        }
+
+        // Full of listings nobody took: drop the oldest
+        if (prefetch->done_count == LISTING_PREFETCH_MAX) {
+            directory_state_free(&prefetch->done[0].listing);
+            memmove(&prefetch->done[0], &prefetch->done[1],
+                    (LISTING_PREFETCH_MAX - 1) * sizeof(PrefetchResult));
+            prefetch->done_count--;
+        }
+        PrefetchResult *result = &prefetch->done[prefetch->done_count++];
+        snprintf(result->path, sizeof(result->path), "%s", request.path);
+        result->listing = listing;
+    }
+    pthread_mutex_unlock(&prefetch->mutex);
+    return NULL;
+}
+
+ListingPrefetch* listing_prefetch_create(void)
+{
+    ListingPrefetch *prefetch = calloc(1, sizeof(ListingPrefetch));
+    if (prefetch == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&prefetch->mutex, NULL);
+    pthread_cond_init(&prefetch->cond, NULL);
+
+    if (pthread_create(&prefetch->thread, NULL, prefetch_thread, prefetch) != 0) {
+        pthread_cond_destroy(&prefetch->cond);
+        pthread_mutex_destroy(&prefetch->mutex);
+        free(prefetch);
+        return NULL;
+    }
+    return prefetch;
+}
+
+void listing_prefetch_destroy(ListingPrefetch *prefetch)
+{
+    if (prefetch == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&prefetch->mutex);
+    prefetch->stopping = true;
+    pthread_cond_signal(&prefetch->cond);
+    pthread_mutex_unlock(&prefetch->mutex);
+    pthread_join(prefetch->thread, NULL);
+
+    for (int i = 0; i < prefetch->done_count; i++) {
+        directory_state_free(&prefetch->done[i].listing);
+    }
+    pthread_cond_destroy(&prefetch->cond);
+    pthread_mutex_destroy(&prefetch->mutex);
+    free(prefetch);
+}
+
+void listing_prefetch_request(ListingPrefetch *prefetch, const char *path, bool show_hidden,
+                              bool debounce)
+{
+    if (prefetch == NULL || path == NULL || path[0] == '\0') {
+        return;
+    }
+
+    pthread_mutex_lock(&prefetch->mutex);
+
+    bool known = strcmp(prefetch->reading, path) == 0 || failed_locked(prefetch, path);
+    for (int i = 0; i < prefetch->done_count && !known; i++) {
+        known = strcmp(prefetch->done[i].path, path) == 0;
+    }
+    for (int i = 0; i < prefetch->pending_count && !known; i++) {
+        known = strcmp(prefetch->pending[i].path, path) == 0;
+    }
+    if (known) {
+        pthread_mutex_unlock(&prefetch->mutex);
+        return;
+    }
+
+    // The cursor moved on: the folder it left is no longer wanted
+    if (debounce) {
+        for (int i = 0; i < prefetch->pending_count; i++) {
+            if (prefetch->pending[i].debounced) {
+                pending_remove(prefetch, i);
+                break;
+            }
+        }
+    }
+
+    if (prefetch->pending_count == LISTING_PREFETCH_MAX) {
+        pending_remove(prefetch, 0);
+    }
+    PrefetchRequest *request = &prefetch->pending[prefetch->pending_count++];
+    snprintf(request->path, sizeof(request->path), "%s", path);
+    request->show_hidden = show_hidden;
+    request->debounced = debounce;
+    request->not_before = debounce ? prefetch_now() + LISTING_PREFETCH_DEBOUNCE : 0;
+
+    pthread_cond_signal(&prefetch->cond);
+    pthread_mutex_unlock(&prefetch->mutex);
+}
+
+bool listing_prefetch_poll(ListingPrefetch *prefetch, char *path, size_t path_size,
+                           DirectoryState *listing)
+{
+    if (prefetch == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&prefetch->mutex);
+    bool ready = prefetch->done_count > 0;
+    if (ready) {
+        snprintf(path, path_size, "%s", prefetch->done[0].path);
+        *listing = prefetch->done[0].listing;
+        memmove(&prefetch->done[0], &prefetch->done[1],
+                (size_t)(prefetch->done_count - 1) * sizeof(PrefetchResult));
+        prefetch->done_count--;
+    }
+    pthread_mutex_unlock(&prefetch->mutex);
+    return ready;
+}
+
+bool listing_prefetch_failed(ListingPrefetch *prefetch, const char *path)
+{
+    if (prefetch == NULL || path == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&prefetch->mutex);
+    bool failed = failed_locked(prefetch, path);
+    pthread_mutex_unlock(&prefetch->mutex);
+    return failed;
+}
+
+bool listing_prefetch_is_busy(ListingPrefetch *prefetch)
+{
+    if (prefetch == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&prefetch->mutex);
+    bool busy = prefetch->pending_count > 0 || prefetch->reading[0] != '\0' ||
+                prefetch->done_count > 0;
+    pthread_mutex_unlock(&prefetch->mutex);
+    return busy;
+}
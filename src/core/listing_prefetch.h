@@ -0,0 +1,45 @@
+#ifndef LISTING_PREFETCH_H
+#define LISTING_PREFETCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesystem.h"
+
+// Directory listings read on a background thread ahead of use, for views that show
+// listings other than the current directory (the Miller columns). The view draws a
+// placeholder until the listing arrives; the owner takes finished listings with
+// listing_prefetch_poll() and puts them in the directory cache. Debounced requests wait
+// a moment and replace the previous debounced request, so moving the cursor quickly
+// through folders only reads the one it rests on
+
+#define LISTING_PREFETCH_MAX 16             // Pending (and finished) listings kept
+#define LISTING_PREFETCH_DEBOUNCE 0.1       // Seconds a debounced request waits
+
+// Prefetcher context (opaque)
+typedef struct ListingPrefetch ListingPrefetch;
+
+// Create a prefetcher and start its thread; NULL on failure
+ListingPrefetch* listing_prefetch_create(void);
+
+// Wait out a read in progress, stop the thread and free the prefetcher
+void listing_prefetch_destroy(ListingPrefetch *prefetch);
+
+// Read path in the background unless it is already pending, being read, finished or
+// recently failed.
+// Past LISTING_PREFETCH_MAX pending requests the oldest is dropped
+void listing_prefetch_request(ListingPrefetch *prefetch, const char *path, bool show_hidden,
+                              bool debounce);
+
+// Take a finished listing: *listing receives it (free with directory_state_free) and path
+// the path it was requested under. False when none is waiting
+bool listing_prefetch_poll(ListingPrefetch *prefetch, char *path, size_t path_size,
+                           DirectoryState *listing);
+
+// Whether listings are pending, being read or waiting to be taken
+bool listing_prefetch_is_busy(ListingPrefetch *prefetch);
+
+// Whether path could not be read recently (the last LISTING_PREFETCH_MAX failures are
+// remembered, so an unreadable folder is not read again every frame)
+bool listing_prefetch_failed(ListingPrefetch *prefetch, const char *path);
+
+#endif // LISTING_PREFETCH_H
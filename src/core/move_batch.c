@@ -0,0 +1,625 @@
+#include "move_batch.h"
+#include "undo_log.h"
+#include "../utils/arena.h"
+#include "../utils/string_set.h"
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define MOVE_BATCH_MAGIC "finder-plus-moves"
+#define MOVE_BATCH_VERSION 1
+#define MOVE_BATCH_PAUSE_POLL_US 50000
+#define MOVE_BATCH_PATH_MAX 4096
+
+typedef struct MoveEntry {
+    int src_dir;
+    int dst_dir;
+    const char *name;
+    const char *new_name;
+    const char *final_name;             // Name it ended at once done (new_name unless renamed)
+    bool done;
+} MoveEntry;
+
+struct MoveBatch {
+    Arena arena;                        // Every string
+    const char **dirs;
+    int dir_count;
+    int dir_capacity;
+    StringSet dir_set;                  // Over dirs
+    MoveEntry *moves;
+    int count;
+    int capacity;
+    bool keep_both;
+    uint64_t undo_group;                // Undo log group runs record into (0: none)
+};
+
+// Directory fds opened by one run
+typedef struct DirFds {
+    int dirs[MOVE_BATCH_MAX_FDS];
+    int fds[MOVE_BATCH_MAX_FDS];
+    int count;
+    int next;                           // Slot reused next once all are open
+} DirFds;
+
+// Helper: Folder index as the string set's key
+static const char *dir_key(const void *batch, int index)
+{
+    return ((const MoveBatch *)batch)->dirs[index];
+}
+
+// Helper: Index of folder path, added if new; -1 if out of memory
+static int dir_intern(MoveBatch *batch, const char *path)
+{
+    size_t len = strlen(path);
+    int found = string_set_find(&batch->dir_set, path, len, dir_key, batch);
+    if (found >= 0) {
+        return found;
+    }
+
+    if (batch->dir_count == batch->dir_capacity) {
+        int capacity = batch->dir_capacity ? batch->dir_capacity * 2 : 16;
+        const char **dirs = realloc(batch->dirs, (size_t)capacity * sizeof(const char *));
+        if (!dirs) {
+            return -1;
+        }
+        batch->dirs = dirs;
+        batch->dir_capacity = capacity;
+    }
+    const char *copy = arena_strdup(&batch->arena, path);
+    if (!copy || !string_set_add(&batch->dir_set, batch->dir_count, path, len)) {
+        return -1;
+    }
+    batch->dirs[batch->dir_count] = copy;
+    return batch->dir_count++;
+}
+
+// Helper: Append a move; NULL if out of memory
+static MoveEntry *add_entry(MoveBatch *batch, int src_dir, int dst_dir, const char *name, const char *new_name)
+{
+    if (batch->count == batch->capacity) {
+        int capacity = batch->capacity ? batch->capacity * 2 : 64;
+        MoveEntry *moves = realloc(batch->moves, (size_t)capacity * sizeof(MoveEntry));
+        if (!moves) {
+            return NULL;
+        }
+        batch->moves = moves;
+        batch->capacity = capacity;
+    }
+    MoveEntry *entry = &batch->moves[batch->count];
+    entry->src_dir = src_dir;
+    entry->dst_dir = dst_dir;
+    entry->name = arena_strdup(&batch->arena, name);
+    entry->new_name = strcmp(name, new_name) == 0 ? entry->name : arena_strdup(&batch->arena, new_name);
+    entry->final_name = entry->new_name;
+    entry->done = false;
+    if (!entry->name || !entry->new_name) {
+        return NULL;
+    }
+    batch->count++;
+    return entry;
+}
+
+MoveBatch *move_batch_create(void)
+{
+    MoveBatch *batch = calloc(1, sizeof(MoveBatch));
+    if (batch) {
+        arena_init(&batch->arena, ARENA_DEFAULT_BLOCK);
+        string_set_init(&batch->dir_set);
+    }
+    return batch;
+}
+
+void move_batch_free(MoveBatch *batch)
+{
+    if (!batch) {
+        return;
+    }
+    arena_free(&batch->arena);
+    free(batch->dirs);
+    string_set_free(&batch->dir_set);
+    free(batch->moves);
+    free(batch);
+}
+
+void move_batch_set_keep_both(MoveBatch *batch, bool keep_both)
+{
+    batch->keep_both = keep_both;
+}
+
+void move_batch_set_undo_group(MoveBatch *batch, uint64_t group)
+{
+    batch->undo_group = group;
+}
+
+uint64_t move_batch_undo_group(const MoveBatch *batch)
+{
+    return batch->undo_group;
+}
+
+// Helper: Split path into its folder (in dir) and name; false if it has no folder
+static bool split_path(const char *path, char *dir, size_t dir_size, const char **name)
+{
+    const char *slash = strrchr(path, '/');
+    if (!slash || slash[1] == '\0') {
+        return false;
+    }
+    size_t len = slash == path ? 1 : (size_t)(slash - path);
+    if (len >= dir_size) {
+        return false;
+    }
+    memcpy(dir, path, len);
+    dir[len] = '\0';
+    *name = slash + 1;
+    return true;
+}
+
+bool move_batch_add(MoveBatch *batch, const char *source, const char *dest_path)
+{
+    char src_dir[MOVE_BATCH_PATH_MAX];
+    char dst_dir[MOVE_BATCH_PATH_MAX];
+    const char *name;
+    const char *new_name;
+    if (!split_path(source, src_dir, sizeof(src_dir), &name) ||
+        !split_path(dest_path, dst_dir, sizeof(dst_dir), &new_name)) {
+        return false;
+    }
+    int src = dir_intern(batch, src_dir);
+    int dst = src >= 0 ? dir_intern(batch, dst_dir) : -1;
+    return dst >= 0 && add_entry(batch, src, dst, name, new_name) != NULL;
+}
+
+int move_batch_count(const MoveBatch *batch)
+{
+    return batch->count;
+}
+
+// Helper: Folder path joined with a name
+static void join_path(char *out, size_t size, const char *dir, const char *name)
+{
+    snprintf(out, size, "%s%s%s", dir, strcmp(dir, "/") == 0 ? "" : "/", name);
+}
+
+bool move_batch_done(const MoveBatch *batch, int index, char *dest_path, size_t dest_size)
+{
+    if (index < 0 || index >= batch->count || !batch->moves[index].done) {
+        return false;
+    }
+    if (dest_path) {
+        const MoveEntry *entry = &batch->moves[index];
+        join_path(dest_path, dest_size, batch->dirs[entry->dst_dir], entry->final_name);
+    }
+    return true;
+}
+
+// Helper: Write a field with '%', tab and newline escaped
+static void write_field(FILE *file, const char *text)
+{
+    fputc('\t', file);
+    for (const char *c = text; *c; c++) {
+        if (*c == '%' || *c == '\t' || *c == '\n' || *c == '\r') {
+            fprintf(file, "%%%02X", (unsigned char)*c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+}
+
+// Helper: Undo write_field in place
+static void unescape_field(char *text)
+{
+    char *out = text;
+    for (char *c = text; *c; c++) {
+        unsigned value;
+        if (*c == '%' && c[1] && c[2] && sscanf(c + 1, "%2x", &value) == 1) {
+            *out++ = (char)value;
+            c += 2;
+        } else {
+            *out++ = *c;
+        }
+    }
+    *out = '\0';
+}
+
+static void write_done(FILE *file, int index, const char *name)
+{
+    fprintf(file, "x\t%d", index);
+    write_field(file, name);
+    fputc('\n', file);
+}
+
+bool move_batch_save(const MoveBatch *batch, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "%s %d %d %d %" PRIu64 "\n", MOVE_BATCH_MAGIC, MOVE_BATCH_VERSION, batch->count,
+            batch->keep_both ? 1 : 0, batch->undo_group);
+    for (int i = 0; i < batch->dir_count; i++) {
+        fputc('d', file);
+        write_field(file, batch->dirs[i]);
+        fputc('\n', file);
+    }
+    for (int i = 0; i < batch->count; i++) {
+        const MoveEntry *entry = &batch->moves[i];
+        fprintf(file, "m\t%d\t%d", entry->src_dir, entry->dst_dir);
+        write_field(file, entry->name);
+        write_field(file, entry->new_name);
+        fputc('\n', file);
+    }
+    for (int i = 0; i < batch->count; i++) {
+        if (batch->moves[i].done) {
+            write_done(file, i, batch->moves[i].final_name);
+        }
+    }
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+// Helper: Read the header; false if it is not a journal this version reads
+static bool read_header(FILE *file, int *count, int *flags, uint64_t *group)
+{
+    char magic[32];
+    int version;
+    return fscanf(file, "%31s %d %d %d %" SCNu64 "\n", magic, &version, count, flags, group) == 5 &&
+           strcmp(magic, MOVE_BATCH_MAGIC) == 0 && version == MOVE_BATCH_VERSION;
+}
+
+int move_batch_journal_count(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    int count;
+    int flags;
+    uint64_t group;
+    bool ok = read_header(file, &count, &flags, &group);
+    fclose(file);
+    return ok ? count : -1;
+}
+
+// Helper: Split a record at tabs into at most max fields, unescaping each
+static int split_fields(char *line, char **fields, int max)
+{
+    int count = 0;
+    char *next = line;
+    while (next && count < max) {
+        fields[count] = next;
+        next = strchr(next, '\t');
+        if (next) {
+            *next++ = '\0';
+        }
+        unescape_field(fields[count++]);
+    }
+    return count;
+}
+
+MoveBatch *move_batch_load(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return NULL;
+    }
+    int planned;
+    int flags;
+    uint64_t group;
+    MoveBatch *batch = read_header(file, &planned, &flags, &group) ? move_batch_create() : NULL;
+    if (!batch) {
+        fclose(file);
+        return NULL;
+    }
+    batch->keep_both = (flags & 1) != 0;
+    batch->undo_group = group;
+
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+    bool ok = true;
+    while (ok && (len = getline(&line, &line_size, file)) > 0) {
+        if (line[len - 1] == '\n') {
+            line[len - 1] = '\0';
+        }
+        char *fields[5];
+        int count = split_fields(line, fields, 5);
+        switch (line[0]) {
+            case 'd':
+                ok = count == 2 && dir_intern(batch, fields[1]) == batch->dir_count - 1;
+                break;
+            case 'm': {
+                int src = count == 5 ? atoi(fields[1]) : -1;
+                int dst = count == 5 ? atoi(fields[2]) : -1;
+                ok = src >= 0 && src < batch->dir_count && dst >= 0 && dst < batch->dir_count &&
+                     add_entry(batch, src, dst, fields[3], fields[4]) != NULL;
+                break;
+            }
+            case 'x': {
+                // A run cut short may leave a partial last record
+                int index = count == 3 ? atoi(fields[1]) : -1;
+                if (index >= 0 && index < batch->count && fields[2][0] != '\0') {
+                    MoveEntry *entry = &batch->moves[index];
+                    entry->done = true;
+                    entry->final_name = strcmp(fields[2], entry->new_name) == 0 ?
+                                        entry->new_name : arena_strdup(&batch->arena, fields[2]);
+                    ok = entry->final_name != NULL;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    free(line);
+    fclose(file);
+
+    if (!ok || batch->count != planned) {
+        move_batch_free(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+// Helper: Open fd of folder index, kept for the rest of the run; -1 if it cannot be opened
+static int dir_fd(const MoveBatch *batch, DirFds *fds, int dir)
+{
+    for (int i = 0; i < fds->count; i++) {
+        if (fds->dirs[i] == dir) {
+            return fds->fds[i];
+        }
+    }
+    int fd = open(batch->dirs[dir], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    int slot;
+    if (fds->count < MOVE_BATCH_MAX_FDS) {
+        slot = fds->count++;
+    } else {
+        slot = fds->next;
+        fds->next = (fds->next + 1) % MOVE_BATCH_MAX_FDS;
+        close(fds->fds[slot]);
+    }
+    fds->dirs[slot] = dir;
+    fds->fds[slot] = fd;
+    return fd;
+}
+
+static void close_dir_fds(DirFds *fds)
+{
+    for (int i = 0; i < fds->count; i++) {
+        close(fds->fds[i]);
+    }
+    fds->count = 0;
+}
+
+// Helper: Note the first failure
+static void note_error(MoveBatchResult *result, const char *what, const char *path, int err)
+{
+    if (result->error_message[0] == '\0') {
+        snprintf(result->error_message, sizeof(result->error_message), "%s %s: %s", what, path, strerror(err));
+    }
+}
+
+// Helper: Create folder path and any missing parents, recording each one created
+static bool make_folder(MoveBatch *batch, const char *path, MoveBatchResult *result, int depth)
+{
+    if (mkdir(path, 0755) == 0) {
+        undo_log_folder(undo_log_shared(), batch->undo_group, path);
+        result->folders_created++;
+        return true;
+    }
+    if (errno == EEXIST) {
+        struct stat st;
+        return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+    }
+    char parent[MOVE_BATCH_PATH_MAX];
+    const char *name;
+    if (errno != ENOENT || depth > 64 || !split_path(path, parent, sizeof(parent), &name) ||
+        !make_folder(batch, parent, result, depth + 1)) {
+        return false;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        return false;
+    }
+    undo_log_folder(undo_log_shared(), batch->undo_group, path);
+    result->folders_created++;
+    return true;
+}
+
+// Helper: Wait out a pause; false once cancelled
+static bool checkpoint(CopyControl *control)
+{
+    if (control == NULL) {
+        return true;
+    }
+    while (atomic_load(&control->pause) && !atomic_load(&control->cancel)) {
+        usleep(MOVE_BATCH_PAUSE_POLL_US);
+    }
+    return !atomic_load(&control->cancel);
+}
+
+// Helper: Do one move; final gets the name it ended at
+static bool run_move(MoveBatch *batch, const MoveEntry *entry, DirFds *fds, char *final, size_t final_size,
+                     MoveBatchResult *result)
+{
+    const char *src_dir = batch->dirs[entry->src_dir];
+    const char *dst_dir = batch->dirs[entry->dst_dir];
+    char source[MOVE_BATCH_PATH_MAX];
+    char dest[MOVE_BATCH_PATH_MAX];
+    join_path(source, sizeof(source), src_dir, entry->name);
+    snprintf(final, final_size, "%s", entry->new_name);
+
+    int from_fd = dir_fd(batch, fds, entry->src_dir);
+    int to_fd = from_fd >= 0 ? dir_fd(batch, fds, entry->dst_dir) : -1;
+    if (from_fd < 0 || to_fd < 0) {
+        note_error(result, "Cannot open folder of", source, errno);
+        return false;
+    }
+
+    int err = 0;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (file_rename_at(from_fd, entry->name, to_fd, final) == 0) {
+            return true;
+        }
+        err = errno;
+        join_path(dest, sizeof(dest), dst_dir, final);
+        if (err == EXDEV) {
+            // Across devices: a copy, then the source is deleted
+            char unique[MOVE_BATCH_PATH_MAX];
+            if (batch->keep_both) {
+                generate_unique_name(dest, unique, sizeof(unique));
+            } else {
+                snprintf(unique, sizeof(unique), "%s", dest);
+                struct stat st;
+                if (lstat(unique, &st) == 0) {
+                    err = EEXIST;
+                    break;
+                }
+            }
+            if (file_move_to(source, unique, NULL) == OP_SUCCESS) {
+                const char *slash = strrchr(unique, '/');
+                snprintf(final, final_size, "%s", slash ? slash + 1 : unique);
+                return true;
+            }
+            note_error(result, "Cannot move", source, EIO);
+            return false;
+        }
+        if (err != EEXIST || !batch->keep_both) {
+            break;
+        }
+        // Name taken: "name 2.ext" and so on, as a copy would get
+        char unique[MOVE_BATCH_PATH_MAX];
+        generate_unique_name(dest, unique, sizeof(unique));
+        const char *slash = strrchr(unique, '/');
+        snprintf(final, final_size, "%s", slash ? slash + 1 : unique);
+    }
+    note_error(result, "Cannot move", source, err);
+    return false;
+}
+
+OperationResult move_batch_run(MoveBatch *batch, const char *path, CopyControl *control,
+                               MoveBatchResult *result)
+{
+    memset(result, 0, sizeof(MoveBatchResult));
+    FILE *journal = fopen(path, "a");
+    if (!journal) {
+        note_error(result, "Cannot write", path, errno);
+        return OP_ERROR_PERMISSION;
+    }
+
+    // Every destination folder once, before any move
+    unsigned char *dir_state = calloc((size_t)batch->dir_count + 1, 1);     // 1: needed, 2: ready, 3: failed
+    if (!dir_state) {
+        fclose(journal);
+        return OP_ERROR_UNKNOWN;
+    }
+    for (int i = 0; i < batch->count; i++) {
+        if (!batch->moves[i].done) {
+            dir_state[batch->moves[i].dst_dir] = 1;
+        }
+    }
+    for (int d = 0; d < batch->dir_count; d++) {
+        if (dir_state[d] == 1) {
+            dir_state[d] = make_folder(batch, batch->dirs[d], result, 0) ? 2 : 3;
+            if (dir_state[d] == 3) {
+                note_error(result, "Cannot create", batch->dirs[d], errno);
+            }
+        }
+    }
+    UndoLog *undo = undo_log_shared();
+    DirFds fds = { .count = 0, .next = 0 };
+    int unflushed = 0;
+    for (int i = 0; i < batch->count; i++) {
+        MoveEntry *entry = &batch->moves[i];
+        if (entry->done) {
+            result->skipped++;
+            continue;
+        }
+        if (!checkpoint(control)) {
+            result->cancelled = true;
+            break;
+        }
+        char final[MOVE_BATCH_PATH_MAX];
+        if (dir_state[entry->dst_dir] != 2 || !run_move(batch, entry, &fds, final, sizeof(final), result)) {
+            result->failed++;
+            continue;
+        }
+
+        entry->done = true;
+        if (strcmp(final, entry->new_name) != 0) {
+            entry->final_name = arena_strdup(&batch->arena, final);
+            if (!entry->final_name) {
+                entry->final_name = entry->new_name;
+            }
+        }
+        write_done(journal, i, final);
+        if (undo && batch->undo_group != 0) {
+            char source[MOVE_BATCH_PATH_MAX];
+            char dest[MOVE_BATCH_PATH_MAX];
+            join_path(source, sizeof(source), batch->dirs[entry->src_dir], entry->name);
+            join_path(dest, sizeof(dest), batch->dirs[entry->dst_dir], final);
+            undo_log_moved(undo, batch->undo_group, source, dest);
+        }
+        if (++unflushed >= MOVE_BATCH_FLUSH_EVERY) {
+            fflush(journal);
+            unflushed = 0;
+        }
+        result->moved++;
+        if (control) {
+            atomic_fetch_add(&control->bytes_done, 1);
+        }
+    }
+
+    close_dir_fds(&fds);
+    free(dir_state);
+    bool written = !ferror(journal);
+    if (fclose(journal) != 0 || !written) {
+        note_error(result, "Cannot write", path, errno);
+    }
+
+    // A group cut short stays open for a resumed run, but what it did can be undone
+    if (result->cancelled || result->failed > 0) {
+        undo_log_commit(undo);
+    } else {
+        undo_log_end(undo, batch->undo_group);
+    }
+
+    if (result->cancelled) {
+        snprintf(result->error_message, sizeof(result->error_message), "Cancelled");
+        return OP_ERROR_CANCELLED;
+    }
+    return result->failed == 0 ? OP_SUCCESS : OP_ERROR_UNKNOWN;
+}
+
+OperationResult move_batch_execute(const char *path, CopyControl *control, MoveBatchResult *result)
+{
+    MoveBatch *batch = move_batch_load(path);
+    if (!batch) {
+        memset(result, 0, sizeof(MoveBatchResult));
+        note_error(result, "Cannot read", path, errno ? errno : EINVAL);
+        return OP_ERROR_NOT_FOUND;
+    }
+    OperationResult status = move_batch_run(batch, path, control, result);
+    move_batch_free(batch);
+    return status;
+}
+
+bool move_batch_journal_path(const char *name, char *path, size_t path_size)
+{
+    const char *home = getenv("HOME");
+    char dir[MOVE_BATCH_PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/.config", home ? home : "/tmp");
+    mkdir(dir, 0755);
+    snprintf(dir, sizeof(dir), "%s/.config/finder-plus", home ? home : "/tmp");
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        return false;
+    }
+    snprintf(path, path_size, "%s/%s", dir, name);
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef MOVE_BATCH_H
+#define MOVE_BATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "operations.h"
+
+// Batched moves: many renames planned together and run as one job. The plan is saved
+// to a journal first; a run creates every destination folder once up front, renames
+// relative to directory fds it keeps open (renameatx_np on macOS) without replacing
+// anything, and appends each finished step to the same journal. A cancelled or failed
+// run resumes from the journal. Folders created and moves done are recorded in the
+// batch's undo log group, which undo_log_undo reverses. Journal format, one record per
+// line, fields separated by tabs with '%', tab and newline escaped as %XX:
+//
+//   finder-plus-moves 1 MOVES FLAGS GROUP   Header (FLAGS 1: keep both names on a clash;
+//                                           GROUP: undo log group, 0 for none)
+//   d PATH                                  Folder; numbered in order from 0
+//   m SRC_DIR DST_DIR NAME NEW_NAME         Planned move; numbered in order from 0
+//   x MOVE NAME                             Move done, under NAME in DST_DIR
+
+#define MOVE_BATCH_MAX_FDS 64           // Directory fds a run keeps open
+#define MOVE_BATCH_FLUSH_EVERY 256      // Journal records buffered before a flush
+
+// Planned moves (opaque)
+typedef struct MoveBatch MoveBatch;
+
+// Outcome of a run
+typedef struct MoveBatchResult {
+    int moved;                          // Moves done by this call
+    int skipped;                        // Already done by an earlier run
+    int failed;
+    int folders_created;
+    bool cancelled;
+    char error_message[256];            // First failure
+} MoveBatchResult;
+
+MoveBatch *move_batch_create(void);
+void move_batch_free(MoveBatch *batch);
+
+// A name taken at the destination gets a unique one instead of failing the move
+void move_batch_set_keep_both(MoveBatch *batch, bool keep_both);
+
+// Record runs into this group of undo_log_shared() (from undo_log_begin), ending it
+// once every move is done
+void move_batch_set_undo_group(MoveBatch *batch, uint64_t group);
+uint64_t move_batch_undo_group(const MoveBatch *batch);
+
+// Plan moving source to dest_path (absolute paths); false if out of memory
+bool move_batch_add(MoveBatch *batch, const char *source, const char *dest_path);
+
+int move_batch_count(const MoveBatch *batch);
+
+// Whether move index is done, and the path it ended at (may be NULL)
+bool move_batch_done(const MoveBatch *batch, int index, char *dest_path, size_t dest_size);
+
+// Write the plan as a new journal at path
+bool move_batch_save(const MoveBatch *batch, const char *path);
+
+// Read a journal, with the moves it records as done; NULL if it cannot be read
+MoveBatch *move_batch_load(const char *path);
+
+// Moves planned in the journal at path, from its header; -1 if it cannot be read
+int move_batch_journal_count(const char *path);
+
+// Run the moves not yet done, appending to the journal at path. control (may be NULL)
+// gets one unit of bytes_done per move and is polled for pause and cancel
+OperationResult move_batch_run(MoveBatch *batch, const char *path, CopyControl *control,
+                               MoveBatchResult *result);
+
+// Load the journal at path and run it (what the operation queue does)
+OperationResult move_batch_execute(const char *path, CopyControl *control, MoveBatchResult *result);
+
+// ~/.config/finder-plus/NAME, creating the folder; false if it cannot be created
+bool move_batch_journal_path(const char *name, char *path, size_t path_size);
+
+#endif // MOVE_BATCH_H
@@ -1,5 +1,9 @@
 #include "network.h"
+#include "network_io.h"
+#include "remote_blocks.h"
 #include "../utils/config.h"
+#include "../utils/perf.h"
+#include "../utils/jobs.h"
 #include "../../external/cJSON/cJSON.h"
 
 #include <stdio.h>
@@ -9,10 +13,16 @@
 #include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <fcntl.h>
 #include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <CommonCrypto/CommonDigest.h>
 
 #include <libssh2.h>
 #include <libssh2_sftp.h>
@@ -21,10 +31,36 @@
 #define SFTP_DEFAULT_PORT 22
 #define SMB_DEFAULT_PORT 445
 
-// Reconnection settings
+// Reconnection settings; background retries wait RECONNECT_DELAY_MS, doubling each time
 #define MAX_RECONNECT_ATTEMPTS 3
 #define RECONNECT_DELAY_MS 1000
 
+// Unanswered TCP keepalive probes, NETWORK_KEEPALIVE_INTERVAL / this apart, before the
+// kernel drops the connection
+#define TCP_KEEPALIVE_PROBES 3
+
+// Pause polling while a lost transfer segment waits to be resumed
+#define SFTP_PAUSE_POLL_US 50000
+
+// Files at least this large are split into segments sent over parallel connections
+#define SFTP_PARALLEL_MIN_SIZE (64ULL * 1024 * 1024)
+
+// Sync compares files in blocks of this size, hashed on both ends; files smaller than
+// SFTP_SYNC_MIN_SIZE are sent whole
+#define SFTP_SYNC_BLOCK (1024 * 1024)
+#define SFTP_SYNC_MIN_SIZE (4ULL * SFTP_SYNC_BLOCK)
+
+// Parallel streams per large transfer (network_set_transfer_streams)
+static atomic_int g_transfer_streams = SFTP_DEFAULT_STREAMS;
+
+// Helper: Monotonic clock in seconds
+static double network_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
 // Config file path for saved profiles
 static const char* get_profiles_path(void)
 {
@@ -38,9 +74,50 @@ static const char* get_profiles_path(void)
     return path;
 }
 
-// Create a TCP socket and connect to host:port
-static int connect_to_host(const char *hostname, int port)
+// Helper: Connect a TCP socket to addr; -1 on failure. Small SFTP requests go out at
+// once, and the kernel keeps probing the peer so a silent one is noticed
+static int connect_address(const struct sockaddr *addr, socklen_t addr_len)
+{
+    int sockfd = socket(addr->sa_family, SOCK_STREAM, 0);
+    if (sockfd < 0) {
+        return -1;
+    }
+    if (connect(sockfd, addr, addr_len) != 0) {
+        close(sockfd);
+        return -1;
+    }
+
+    int on = 1;
+    int idle = NETWORK_KEEPALIVE_INTERVAL;
+    int interval = NETWORK_KEEPALIVE_INTERVAL / TCP_KEEPALIVE_PROBES;
+    int probes = TCP_KEEPALIVE_PROBES;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    setsockopt(sockfd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+#ifdef TCP_KEEPALIVE
+    setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPALIVE, &idle, sizeof(idle));
+#else
+    setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+#endif
+    setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes));
+    return sockfd;
+}
+
+// Create a TCP socket and connect to the connection's host:port, trying the address
+// that answered last time before looking the name up again. The connect's round trip
+// is the link's RTT
+static int connect_to_host(NetworkConnection *conn, int port)
 {
+    if (conn->address_len > 0) {
+        double start = network_now();
+        int sockfd = connect_address((const struct sockaddr *)&conn->address, conn->address_len);
+        if (sockfd >= 0) {
+            conn->link_rtt = network_now() - start;
+            return sockfd;
+        }
+        conn->address_len = 0;
+    }
+
     struct addrinfo hints, *res, *p;
     int sockfd = -1;
     char port_str[16];
@@ -51,27 +128,356 @@ static int connect_to_host(const char *hostname, int port)
 
     snprintf(port_str, sizeof(port_str), "%d", port);
 
-    int status = getaddrinfo(hostname, port_str, &hints, &res);
+    int status = getaddrinfo(conn->profile.host, port_str, &hints, &res);
     if (status != 0) {
         return -1;
     }
 
     for (p = res; p != NULL; p = p->ai_next) {
-        sockfd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
-        if (sockfd < 0) continue;
-
-        if (connect(sockfd, p->ai_addr, p->ai_addrlen) == 0) {
+        double start = network_now();
+        sockfd = connect_address(p->ai_addr, p->ai_addrlen);
+        if (sockfd >= 0) {
+            conn->link_rtt = network_now() - start;
+        }
+        if (sockfd >= 0 && p->ai_addrlen <= sizeof(conn->address)) {
+            memcpy(&conn->address, p->ai_addr, p->ai_addrlen);
+            conn->address_len = p->ai_addrlen;
+        }
+        if (sockfd >= 0) {
             break;
         }
-
-        close(sockfd);
-        sockfd = -1;
     }
 
     freeaddrinfo(res);
     return sockfd;
 }
 
+// Listing cache of one connection, used from the thread that browses it. Prefetches are
+// listing requests on the connection's network thread, collected on the next read
+struct RemoteListings {
+    DirCache cache;
+
+    NetworkRequest prefetch[NETWORK_PREFETCH_CHILDREN];
+    bool in_flight[NETWORK_PREFETCH_CHILDREN];
+    uint32_t prefetch_generation[NETWORK_PREFETCH_CHILDREN]; // generation when submitted
+    uint32_t generation;                // Bumped by every invalidation
+};
+
+// Helper: Parent directory of a remote path ("/" for top-level entries)
+static void remote_parent_path(const char *path, char *parent, size_t parent_size)
+{
+    const char *slash = strrchr(path, '/');
+    size_t len = slash && slash != path ? (size_t)(slash - path) : 1;
+    if (len >= parent_size) {
+        len = parent_size - 1;
+    }
+    memcpy(parent, slash ? path : "/", len);
+    parent[len] = '\0';
+}
+
+// Helper: The connection's listing cache, created on first use
+static struct RemoteListings *remote_listings(NetworkConnection *conn)
+{
+    if (!conn->listings) {
+        struct RemoteListings *rl = calloc(1, sizeof(struct RemoteListings));
+        if (!rl) {
+            return NULL;
+        }
+        dir_cache_init(&rl->cache);
+        dir_cache_set_budget(&rl->cache, NETWORK_LISTING_BUDGET);
+        dir_cache_set_max_age(&rl->cache, NETWORK_LISTING_TTL);
+        conn->listings = rl;
+    }
+    return conn->listings;
+}
+
+// Helper: Free the connection's cached listings, waiting out prefetches still running
+static void remote_listings_destroy(NetworkConnection *conn)
+{
+    struct RemoteListings *rl = conn->listings;
+    if (!rl) {
+        return;
+    }
+
+    for (int i = 0; i < NETWORK_PREFETCH_CHILDREN; i++) {
+        if (rl->in_flight[i]) {
+            if (conn->io) {
+                network_io_wait(conn->io, &rl->prefetch[i]);
+            }
+            network_request_free(&rl->prefetch[i]);
+        }
+    }
+
+    dir_cache_free(&rl->cache);
+    free(rl);
+    conn->listings = NULL;
+}
+
+// Helper: Free the connection's probe, once the network thread that had it is stopped
+static void probe_free(NetworkConnection *conn)
+{
+    if (conn->probe) {
+        network_request_free(conn->probe);
+        free(conn->probe);
+        conn->probe = NULL;
+    }
+}
+
+// Helper: Cache the prefetches that finished, skipping any an invalidation made stale
+static void remote_listings_collect(struct RemoteListings *rl)
+{
+    for (int i = 0; i < NETWORK_PREFETCH_CHILDREN; i++) {
+        NetworkRequest *req = &rl->prefetch[i];
+        if (!rl->in_flight[i] || !network_request_is_complete(req)) {
+            continue;
+        }
+        if (req->ok && rl->prefetch_generation[i] == rl->generation) {
+            dir_cache_put(&rl->cache, req->path, &req->listing);
+        }
+        network_request_free(req);
+        rl->in_flight[i] = false;
+    }
+}
+
+// Helper: Whether a prefetch of path is running
+static bool remote_listings_fetching(struct RemoteListings *rl, const char *path)
+{
+    for (int i = 0; i < NETWORK_PREFETCH_CHILDREN; i++) {
+        if (rl->in_flight[i] && strcmp(rl->prefetch[i].path, path) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Helper: List the subdirectories of a listing that are not cached, as far as free
+// prefetch slots allow
+static void remote_listings_prefetch(NetworkConnection *conn, struct RemoteListings *rl,
+                                     const DirectoryState *dir)
+{
+    if (!conn->io) {
+        return;
+    }
+
+    int slot = 0;
+    for (int i = 0; i < dir->count; i++) {
+        const FileEntry *entry = &dir->entries[i];
+        if (!entry->is_directory || entry->is_symlink) {
+            continue;
+        }
+
+        char child[PATH_MAX_LEN];
+        directory_entry_path(dir, entry, child, sizeof(child));
+        if (strlen(child) >= NETWORK_PATH_MAX || dir_cache_get(&rl->cache, child) ||
+            remote_listings_fetching(rl, child)) {
+            continue;
+        }
+
+        while (slot < NETWORK_PREFETCH_CHILDREN && rl->in_flight[slot]) {
+            slot++;
+        }
+        if (slot == NETWORK_PREFETCH_CHILDREN) {
+            break;
+        }
+
+        NetworkRequest *req = &rl->prefetch[slot];
+        network_request_init(req, NET_OP_LIST);
+        memcpy(req->path, child, strlen(child) + 1);
+        rl->prefetch_generation[slot] = rl->generation;
+        rl->in_flight[slot] = true;
+        network_io_submit(conn->io, req);
+    }
+}
+
+// Helper: Drop the cached listing of path and below, and any being prefetched
+static void remote_listings_invalidate(NetworkConnection *conn, const char *path)
+{
+    struct RemoteListings *rl = conn->listings;
+    if (!rl) {
+        return;
+    }
+
+    rl->generation++;
+    dir_cache_invalidate(&rl->cache, path);
+}
+
+// Helper: Drop the listing of the directory holding path, after a change to path
+static void remote_listings_invalidate_parent(NetworkConnection *conn, const char *path)
+{
+    char parent[NETWORK_PATH_MAX];
+    remote_parent_path(path, parent, sizeof(parent));
+    remote_listings_invalidate(conn, parent);
+}
+
+// Background reconnection of a lost SFTP session. The job shuts the old session down
+// and connects a scratch copy of the connection; network_update swaps the new session in
+struct NetworkReconnect {
+    NetworkConnection old;              // The lost session, handed over to be shut down
+    NetworkConnection scratch;          // Profile and hints in, new session out
+    JobToken *token;
+    atomic_bool done;
+    bool ok;
+};
+
+// Helper: Hand what connecting learned (auth method, address, link measurements) from
+// src to dest, so dest connects in one attempt and tunes its transport the same way
+static void connection_copy_hints(NetworkConnection *dest, const NetworkConnection *src)
+{
+    dest->auth_method = src->auth_method;
+    dest->address = src->address;
+    dest->address_len = src->address_len;
+    dest->link_rtt = src->link_rtt;
+    dest->link_throughput = src->link_throughput;
+}
+
+// Helper: Move a connection's session (and its network thread) into dest
+static void sftp_take_session(NetworkConnection *dest, NetworkConnection *src)
+{
+    dest->ssh_session = src->ssh_session;
+    dest->sftp_session = src->sftp_session;
+    dest->socket = src->socket;
+    dest->io = src->io;
+    dest->compressed = src->compressed;
+    src->ssh_session = NULL;
+    src->sftp_session = NULL;
+    src->socket = -1;
+    src->io = NULL;
+}
+
+// Job: shut the lost session down, then connect again
+static void reconnect_run(void *arg, JobToken *token)
+{
+    struct NetworkReconnect *rc = (struct NetworkReconnect *)arg;
+
+    sftp_disconnect(&rc->old);
+
+    if (!job_token_cancelled(token)) {
+        rc->ok = sftp_connect(&rc->scratch);
+    }
+    atomic_store(&rc->done, true);
+}
+
+// Helper: Start rebuilding the connection's session in the background. Requests still
+// on the old one complete (not ok) as it shuts down
+static void reconnect_start(NetworkConnection *conn)
+{
+    struct NetworkReconnect *rc = calloc(1, sizeof(struct NetworkReconnect));
+    JobToken *token = rc ? job_token_create() : NULL;
+    if (!token) {
+        free(rc);
+        conn->status = CONN_STATUS_ERROR;
+        strncpy(conn->error_message, "Failed to start reconnecting", sizeof(conn->error_message) - 1);
+        return;
+    }
+
+    rc->old.socket = -1;
+    sftp_take_session(&rc->old, conn);
+
+    rc->scratch.profile = conn->profile;
+    rc->scratch.socket = -1;
+    connection_copy_hints(&rc->scratch, conn);
+    rc->token = token;
+    atomic_init(&rc->done, false);
+
+    conn->status = CONN_STATUS_RECONNECTING;
+    conn->reconnect = rc;
+    jobs_submit(JOB_QOS_USER_INITIATED, reconnect_run, NULL, rc, token);
+}
+
+// Helper: Wait out the connection's reconnect and free it; its new session (if any)
+// is returned in place of the connection's when adopt is set, else shut down
+static bool reconnect_end(NetworkConnection *conn, bool adopt)
+{
+    struct NetworkReconnect *rc = conn->reconnect;
+    if (!rc) {
+        return false;
+    }
+
+    if (!adopt) {
+        job_token_cancel(rc->token);
+    }
+    job_token_wait(rc->token);
+    job_token_release(rc->token);
+
+    bool ok = rc->ok;
+    if (ok && adopt) {
+        sftp_take_session(conn, &rc->scratch);
+        connection_copy_hints(conn, &rc->scratch);
+    } else if (ok) {
+        sftp_disconnect(&rc->scratch);
+    } else {
+        memcpy(conn->error_message, rc->scratch.error_message, sizeof(conn->error_message));
+    }
+    free(rc);
+    conn->reconnect = NULL;
+
+    // The old network thread is stopped, so its requests are complete
+    probe_free(conn);
+    if (conn->listings) {
+        remote_listings_collect(conn->listings);
+    }
+    return ok;
+}
+
+// Helper: Swap a finished reconnect in, or schedule the next try
+static void reconnect_finish(NetworkConnection *conn, double now)
+{
+    if (reconnect_end(conn, true)) {
+        conn->status = CONN_STATUS_CONNECTED;
+        conn->reconnect_attempts = 0;
+        conn->last_activity = now;
+        conn->error_message[0] = '\0';
+        return;
+    }
+
+    conn->reconnect_attempts++;
+    if (conn->reconnect_attempts >= MAX_RECONNECT_ATTEMPTS) {
+        conn->status = CONN_STATUS_ERROR;
+        return;
+    }
+    conn->retry_at = now + (RECONNECT_DELAY_MS / 1000.0) * (double)(1 << (conn->reconnect_attempts - 1));
+}
+
+// Helper: After a gap in updates, check the session with a round trip; one that does not
+// come back in time is taken as lost
+static void sftp_probe(NetworkConnection *conn, double now, bool woke)
+{
+    if (conn->probe) {
+        if (network_request_is_complete(conn->probe)) {
+            probe_free(conn);
+        } else if (now - conn->probe_sent > NETWORK_PROBE_TIMEOUT) {
+            network_io_set_lost(conn->io);
+        }
+        return;
+    }
+
+    if (woke) {
+        conn->probe = malloc(sizeof(NetworkRequest));
+        if (conn->probe) {
+            network_request_init(conn->probe, NET_OP_STAT);
+            strcpy(conn->probe->path, ".");
+            conn->probe_sent = now;
+            network_io_submit(conn->io, conn->probe);
+        }
+    }
+}
+
+// Helper: A live connection to the same server as profile, if any
+static NetworkConnection *find_live_connection(NetworkManager *mgr, const ConnectionProfile *profile,
+                                               int port)
+{
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        NetworkConnection *conn = &mgr->connections[i];
+        bool live = conn->status == CONN_STATUS_CONNECTED || conn->status == CONN_STATUS_RECONNECTING;
+        if (conn->id != 0 && live && conn->profile.type == profile->type && conn->profile.port == port &&
+            strcmp(conn->profile.host, profile->host) == 0 &&
+            strcmp(conn->profile.username, profile->username) == 0) {
+            return conn;
+        }
+    }
+    return NULL;
+}
+
 bool network_init(NetworkManager *mgr)
 {
     memset(mgr, 0, sizeof(NetworkManager));
@@ -85,6 +491,12 @@ bool network_init(NetworkManager *mgr)
 
     mgr->initialized = true;
 
+    // Ranged reads share one block cache on disk
+    const char *home = getenv("HOME");
+    char blocks_dir[PATH_MAX_LEN];
+    snprintf(blocks_dir, sizeof(blocks_dir), "%s/.cache/finder-plus/remote_blocks", home ? home : "/tmp");
+    mgr->blocks = remote_blocks_create(blocks_dir, REMOTE_BLOCKS_BUDGET);
+
     // Load saved profiles
     network_load_profiles(mgr);
 
@@ -93,12 +505,18 @@ bool network_init(NetworkManager *mgr)
 
 void network_shutdown(NetworkManager *mgr)
 {
-    // Disconnect all connections
-    for (int i = 0; i < mgr->connection_count; i++) {
-        if (mgr->connections[i].status == CONN_STATUS_CONNECTED) {
+    // Disconnect all connections, stopping reconnects in progress
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        if (mgr->connections[i].id != 0) {
             network_disconnect(mgr, mgr->connections[i].id);
         }
     }
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        remote_listings_destroy(&mgr->connections[i]);
+    }
+
+    remote_blocks_destroy(mgr->blocks);
+    mgr->blocks = NULL;
 
     // Save profiles
     network_save_profiles(mgr);
@@ -179,6 +597,8 @@ bool network_load_profiles(NetworkManager *mgr)
         cJSON *remote_path = cJSON_GetObjectItem(item, "remote_path");
         cJSON *save_pass = cJSON_GetObjectItem(item, "save_password");
         cJSON *auto_conn = cJSON_GetObjectItem(item, "auto_connect");
+        cJSON *compression = cJSON_GetObjectItem(item, "compression");
+        cJSON *ciphers = cJSON_GetObjectItem(item, "ciphers");
 
         if (cJSON_IsString(name)) {
             strncpy(p->name, name->valuestring, sizeof(p->name) - 1);
@@ -210,6 +630,13 @@ bool network_load_profiles(NetworkManager *mgr)
         if (cJSON_IsBool(auto_conn)) {
             p->auto_connect = cJSON_IsTrue(auto_conn);
         }
+        if (cJSON_IsNumber(compression) && compression->valueint >= SSH_COMPRESSION_AUTO &&
+            compression->valueint <= SSH_COMPRESSION_OFF) {
+            p->compression = (SshCompression)compression->valueint;
+        }
+        if (cJSON_IsString(ciphers)) {
+            strncpy(p->ciphers, ciphers->valuestring, sizeof(p->ciphers) - 1);
+        }
 
         mgr->profile_count++;
     }
@@ -251,6 +678,10 @@ bool network_save_profiles(NetworkManager *mgr)
             fprintf(f, "      \"password\": \"%s\",\n", p->password);
         }
         fprintf(f, "      \"remote_path\": \"%s\",\n", p->remote_path);
+        fprintf(f, "      \"compression\": %d,\n", p->compression);
+        if (p->ciphers[0]) {
+            fprintf(f, "      \"ciphers\": \"%s\",\n", p->ciphers);
+        }
         fprintf(f, "      \"auto_connect\": %s\n", p->auto_connect ? "true" : "false");
         fprintf(f, "    }%s\n", (i < mgr->profile_count - 1) ? "," : "");
     }
@@ -314,6 +745,17 @@ static int next_connection_id = 1;
 
 int network_connect(NetworkManager *mgr, const ConnectionProfile *profile)
 {
+    // One session per server: a second connect costs nothing
+    int port = profile->port;
+    if (port == 0) {
+        port = profile->type == CONN_TYPE_SFTP ? SFTP_DEFAULT_PORT :
+               profile->type == CONN_TYPE_SMB ? SMB_DEFAULT_PORT : 0;
+    }
+    NetworkConnection *live = find_live_connection(mgr, profile, port);
+    if (live) {
+        return live->id;
+    }
+
     if (mgr->connection_count >= MAX_CONNECTIONS) {
         return -1;
     }
@@ -338,15 +780,7 @@ int network_connect(NetworkManager *mgr, const ConnectionProfile *profile)
     conn->profile = *profile;
     conn->status = CONN_STATUS_CONNECTING;
     conn->socket = -1;
-
-    // Set default port if not specified
-    if (conn->profile.port == 0) {
-        switch (conn->profile.type) {
-            case CONN_TYPE_SFTP: conn->profile.port = SFTP_DEFAULT_PORT; break;
-            case CONN_TYPE_SMB: conn->profile.port = SMB_DEFAULT_PORT; break;
-            default: break;
-        }
-    }
+    conn->profile.port = port;
 
     // Copy initial path
     if (profile->remote_path[0] != '\0') {
@@ -390,6 +824,7 @@ bool network_disconnect(NetworkManager *mgr, int conn_id)
         return false;
     }
 
+    reconnect_end(conn, false);
     switch (conn->profile.type) {
         case CONN_TYPE_SFTP:
             sftp_disconnect(conn);
@@ -401,6 +836,8 @@ bool network_disconnect(NetworkManager *mgr, int conn_id)
             break;
     }
 
+    probe_free(conn);
+    remote_listings_destroy(conn);
     conn->status = CONN_STATUS_DISCONNECTED;
 
     // Clear the slot
@@ -430,7 +867,8 @@ bool network_reconnect(NetworkManager *mgr, int conn_id)
     conn->status = CONN_STATUS_RECONNECTING;
     conn->reconnect_attempts++;
 
-    // Disconnect first
+    // Disconnect first (from a background reconnect's session too)
+    reconnect_end(conn, false);
     switch (conn->profile.type) {
         case CONN_TYPE_SFTP:
             sftp_disconnect(conn);
@@ -442,6 +880,13 @@ bool network_reconnect(NetworkManager *mgr, int conn_id)
             break;
     }
 
+    // Cached listings stay, and expire as usual: whatever the user was looking at can be
+    // shown again without waiting on the server
+    probe_free(conn);
+    if (conn->listings) {
+        remote_listings_collect(conn->listings);
+    }
+
     // Reconnect
     bool success = false;
     switch (conn->profile.type) {
@@ -466,6 +911,39 @@ bool network_reconnect(NetworkManager *mgr, int conn_id)
     return success;
 }
 
+bool network_update(NetworkManager *mgr)
+{
+    double now = (double)time(NULL);
+    bool woke = mgr->last_update > 0 && now - mgr->last_update > NETWORK_WAKE_GAP;
+    mgr->last_update = now;
+    bool changed = false;
+
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        NetworkConnection *conn = &mgr->connections[i];
+        if (conn->id == 0 || conn->profile.type != CONN_TYPE_SFTP) {
+            continue;
+        }
+        ConnectionStatus status = conn->status;
+
+        if (conn->reconnect) {
+            if (atomic_load(&conn->reconnect->done)) {
+                reconnect_finish(conn, now);
+            }
+        } else if (conn->status == CONN_STATUS_RECONNECTING) {
+            if (now >= conn->retry_at) {
+                reconnect_start(conn);
+            }
+        } else if (conn->status == CONN_STATUS_CONNECTED && conn->io) {
+            sftp_probe(conn, now, woke);
+            if (network_io_lost(conn->io)) {
+                reconnect_start(conn);
+            }
+        }
+        changed = changed || conn->status != status;
+    }
+    return changed;
+}
+
 NetworkConnection* network_get_connection(NetworkManager *mgr, int conn_id)
 {
     for (int i = 0; i < MAX_CONNECTIONS; i++) {
@@ -511,31 +989,103 @@ bool network_is_remote_active(NetworkManager *mgr)
 
 bool network_read_directory(NetworkManager *mgr, int conn_id, const char *path, DirectoryState *dir)
 {
+    // While reconnecting, cached listings are still served
     NetworkConnection *conn = network_get_connection(mgr, conn_id);
-    if (!conn || conn->status != CONN_STATUS_CONNECTED) {
+    if (!conn || (conn->status != CONN_STATUS_CONNECTED && conn->status != CONN_STATUS_RECONNECTING)) {
         return false;
     }
+    bool connected = conn->status == CONN_STATUS_CONNECTED;
 
+    struct RemoteListings *rl = remote_listings(conn);
     bool success = false;
-    switch (conn->profile.type) {
-        case CONN_TYPE_SFTP:
-            success = sftp_read_directory(conn, path, dir);
-            break;
-        case CONN_TYPE_SMB:
-            success = smb_read_directory(conn, path, dir);
-            break;
-        default:
-            break;
+
+    if (rl) {
+        remote_listings_collect(rl);
+        DirectoryState *cached = dir_cache_get(&rl->cache, path);
+        if (cached) {
+            bool streaming = dir->streaming;
+            directory_state_free(dir);
+            directory_state_copy(dir, cached);
+            dir->streaming = streaming;
+            success = true;
+        }
+    }
+
+    if (!success && connected) {
+        switch (conn->profile.type) {
+            case CONN_TYPE_SFTP:
+                success = sftp_read_directory(conn, path, dir);
+                break;
+            case CONN_TYPE_SMB:
+                success = smb_read_directory(conn, path, dir);
+                break;
+            default:
+                break;
+        }
+        if (success && rl) {
+            dir_cache_put(&rl->cache, path, dir);
+        }
+        if (success) {
+            conn->last_activity = (double)time(NULL);
+        }
     }
 
     if (success) {
         strncpy(conn->current_path, path, NETWORK_PATH_MAX - 1);
-        conn->last_activity = (double)time(NULL);
+        if (rl) {
+            remote_listings_prefetch(conn, rl, dir);
+        }
     }
 
     return success;
 }
 
+bool network_submit(NetworkManager *mgr, int conn_id, NetworkRequest *req)
+{
+    NetworkConnection *conn = network_get_connection(mgr, conn_id);
+    if (!conn || conn->status != CONN_STATUS_CONNECTED || !conn->io) {
+        req->ok = false;
+        atomic_store(&req->completed, true);
+        return false;
+    }
+
+    switch (req->op) {
+        case NET_OP_RENAME:
+            remote_listings_invalidate(conn, req->path);
+            remote_listings_invalidate_parent(conn, req->target);
+            remote_listings_invalidate_parent(conn, req->path);
+            break;
+        case NET_OP_RMDIR:
+            remote_listings_invalidate(conn, req->path);
+            remote_listings_invalidate_parent(conn, req->path);
+            break;
+        case NET_OP_CREATE:
+        case NET_OP_WRITE:
+        case NET_OP_SETSTAT:
+        case NET_OP_MKDIR:
+        case NET_OP_UNLINK:
+            remote_listings_invalidate_parent(conn, req->path);
+            break;
+        case NET_OP_EXEC:
+            // A command may change anything
+            remote_listings_invalidate(conn, "/");
+            break;
+        default:
+            break;
+    }
+
+    conn->last_activity = (double)time(NULL);
+    return network_io_submit(conn->io, req);
+}
+
+void network_invalidate_directory(NetworkManager *mgr, int conn_id, const char *path)
+{
+    NetworkConnection *conn = network_get_connection(mgr, conn_id);
+    if (conn) {
+        remote_listings_invalidate(conn, path);
+    }
+}
+
 bool network_change_directory(NetworkManager *mgr, int conn_id, const char *path)
 {
     NetworkConnection *conn = network_get_connection(mgr, conn_id);
@@ -560,11 +1110,15 @@ bool network_make_directory(NetworkManager *mgr, int conn_id, const char *path)
         case CONN_TYPE_SFTP:
             success = sftp_mkdir(conn, path);
             break;
+        case CONN_TYPE_SMB:
+            success = smb_mkdir(conn, path);
+            break;
         default:
             break;
     }
 
     if (success) {
+        remote_listings_invalidate_parent(conn, path);
         conn->last_activity = (double)time(NULL);
     }
 
@@ -583,56 +1137,367 @@ bool network_remove_directory(NetworkManager *mgr, int conn_id, const char *path
         case CONN_TYPE_SFTP:
             success = sftp_rmdir(conn, path);
             break;
+        case CONN_TYPE_SMB:
+            success = smb_rmdir(conn, path);
+            break;
         default:
             break;
     }
 
     if (success) {
+        remote_listings_invalidate(conn, path);
+        remote_listings_invalidate_parent(conn, path);
         conn->last_activity = (double)time(NULL);
     }
 
     return success;
 }
 
-bool network_download_file(NetworkManager *mgr, int conn_id, const char *remote_path, const char *local_path)
+// Helper: Size and mtime of a remote file, from its cached listing if it has one, else
+// (when ask is set) from the server
+static bool remote_file_version(NetworkConnection *conn, const char *path, bool ask,
+                                uint64_t *size, int64_t *mtime)
 {
-    NetworkConnection *conn = network_get_connection(mgr, conn_id);
-    if (!conn || conn->status != CONN_STATUS_CONNECTED) {
+    if (conn->listings) {
+        char parent[NETWORK_PATH_MAX];
+        remote_parent_path(path, parent, sizeof(parent));
+        const char *slash = strrchr(path, '/');
+        const char *name = slash ? slash + 1 : path;
+        DirectoryState *listing = dir_cache_get(&conn->listings->cache, parent);
+        for (int i = 0; listing && i < listing->count; i++) {
+            const FileEntry *entry = &listing->entries[i];
+            if (!entry->is_directory && strcmp(directory_entry_name(listing, entry), name) == 0) {
+                *size = (uint64_t)entry->size;
+                *mtime = (int64_t)entry->modified;
+                return true;
+            }
+        }
+    }
+    if (!ask || !conn->io) {
         return false;
     }
 
-    bool success = false;
-    switch (conn->profile.type) {
-        case CONN_TYPE_SFTP:
-            success = sftp_download(conn, remote_path, local_path);
-            break;
-        default:
-            break;
+    NetworkRequest stat;
+    network_request_init(&stat, NET_OP_STAT);
+    memcpy(stat.path, path, strlen(path) + 1);
+    bool found = network_io_run(conn->io, &stat) && stat.size != UINT64_MAX;
+    *size = stat.size;
+    *mtime = stat.mtime;
+    network_request_free(&stat);
+    return found;
+}
+
+// Helper: Block cache key of a remote file: its server and path
+static void remote_block_key(const NetworkConnection *conn, const char *path, char *key, size_t key_size)
+{
+    snprintf(key, key_size, "sftp://%s@%s:%d%s", conn->profile.username, conn->profile.host,
+             conn->profile.port, path);
+}
+
+// Helper: The connection's blocks of a remote SFTP file at its current version
+static RemoteBlockFile *remote_range_open(NetworkManager *mgr, NetworkConnection *conn, const char *path)
+{
+    uint64_t size;
+    int64_t mtime;
+    if (!mgr->blocks || conn->profile.type != CONN_TYPE_SFTP || conn->status != CONN_STATUS_CONNECTED ||
+        strlen(path) >= NETWORK_PATH_MAX || !remote_file_version(conn, path, true, &size, &mtime)) {
+        return NULL;
     }
 
-    if (success) {
-        conn->last_activity = (double)time(NULL);
+    char key[NETWORK_PATH_MAX + 256];
+    remote_block_key(conn, path, key, sizeof(key));
+    return remote_blocks_open(mgr->blocks, key, size, mtime);
+}
+
+// Helper: Fetch the runs of [offset, offset + length) the cache lacks straight into it,
+// NETWORK_RANGE_REQUESTS at a time
+static bool remote_range_fetch(NetworkConnection *conn, RemoteBlockFile *file, const char *path,
+                               uint64_t offset, uint64_t length)
+{
+    NetworkRequest *reqs = NULL;
+    uint64_t end = length > UINT64_MAX - offset ? UINT64_MAX : offset + length;
+    uint64_t at = offset;
+    uint64_t run_offset, run_length;
+    bool ok = true;
+
+    while (ok && remote_blocks_missing(file, at, end - at, &run_offset, &run_length)) {
+        if (!conn->io || (!reqs && !(reqs = calloc(NETWORK_RANGE_REQUESTS, sizeof(NetworkRequest))))) {
+            ok = false;
+            break;
+        }
+
+        int count = 0;
+        do {
+            NetworkRequest *req = &reqs[count++];
+            network_request_init(req, NET_OP_READ);
+            memcpy(req->path, path, strlen(path) + 1);
+            req->fd = remote_blocks_fd(file);
+            req->offset = run_offset;
+            req->length = run_length;
+            network_io_submit(conn->io, req);
+            at = run_offset + run_length;
+        } while (count < NETWORK_RANGE_REQUESTS && remote_blocks_missing(file, at, end - at, &run_offset, &run_length));
+
+        for (int i = 0; i < count; i++) {
+            ok = network_io_wait(conn->io, &reqs[i]) && ok;
+            remote_blocks_fill(file, reqs[i].offset, reqs[i].done);
+            network_request_free(&reqs[i]);
+        }
     }
 
-    return success;
+    free(reqs);
+    return ok;
 }
 
-bool network_upload_file(NetworkManager *mgr, int conn_id, const char *local_path, const char *remote_path)
+int64_t network_read_range(NetworkManager *mgr, int conn_id, const char *path, uint64_t offset,
+                           void *buf, size_t length)
 {
     NetworkConnection *conn = network_get_connection(mgr, conn_id);
-    if (!conn || conn->status != CONN_STATUS_CONNECTED) {
-        return false;
+    RemoteBlockFile *file = conn ? remote_range_open(mgr, conn, path) : NULL;
+    if (!file) {
+        return -1;
     }
 
-    bool success = false;
-    switch (conn->profile.type) {
+    int64_t n = -1;
+    if (remote_range_fetch(conn, file, path, offset, length)) {
+        n = remote_blocks_read(file, offset, buf, length);
+        conn->last_activity = (double)time(NULL);
+    }
+    remote_blocks_close(file);
+    return n;
+}
+
+// Helper: Unsigned value of bytes bytes at p in TIFF byte order
+static uint32_t exif_value(const unsigned char *p, int bytes, bool little)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint32_t)p[little ? i : bytes - 1 - i] << (8 * (little ? i : bytes - 1 - i));
+    }
+    return value;
+}
+
+// Helper: Find the thumbnail in the TIFF data of an EXIF segment (at base in the JPEG):
+// IFD1, the IFD after the main image's, gives its offset and length
+static bool exif_thumbnail(const unsigned char *tiff, size_t size, size_t base, size_t *offset, size_t *length)
+{
+    if (size < 8 || !(memcmp(tiff, "II", 2) == 0 || memcmp(tiff, "MM", 2) == 0)) {
+        return false;
+    }
+    bool little = tiff[0] == 'I';
+
+    size_t ifd0 = exif_value(tiff + 4, 4, little);
+    if (ifd0 > size - 2) {
+        return false;
+    }
+    size_t entries = exif_value(tiff + ifd0, 2, little);
+    size_t next_at = ifd0 + 2 + entries * 12;
+    if (next_at > size - 4) {
+        return false;
+    }
+    size_t ifd1 = exif_value(tiff + next_at, 4, little);
+    if (ifd1 == 0 || ifd1 > size - 2) {
+        return false;
+    }
+
+    entries = exif_value(tiff + ifd1, 2, little);
+    uint32_t thumb_offset = 0, thumb_length = 0;
+    for (size_t i = 0; i < entries; i++) {
+        size_t at = ifd1 + 2 + i * 12;
+        if (at > size - 12) {
+            return false;
+        }
+        uint32_t tag = exif_value(tiff + at, 2, little);
+        uint32_t value = exif_value(tiff + at + 8, 4, little);
+        if (tag == 0x0201) {
+            thumb_offset = value;
+        } else if (tag == 0x0202) {
+            thumb_length = value;
+        }
+    }
+
+    // The thumbnail is itself a JPEG
+    if (thumb_offset == 0 || thumb_length < 2 || thumb_offset > size || thumb_length > size - thumb_offset ||
+        tiff[thumb_offset] != 0xFF || tiff[thumb_offset + 1] != 0xD8) {
+        return false;
+    }
+    *offset = base + thumb_offset;
+    *length = thumb_length;
+    return true;
+}
+
+bool network_jpeg_thumbnail(const unsigned char *data, size_t size, size_t *offset, size_t *length)
+{
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        return false;
+    }
+
+    // Walk the segments before the image data for the EXIF one (APP1)
+    size_t pos = 2;
+    while (pos + 4 <= size && data[pos] == 0xFF) {
+        unsigned marker = data[pos + 1];
+        size_t segment = ((size_t)data[pos + 2] << 8) | data[pos + 3];
+        if (marker == 0xDA || marker == 0xD9 || segment < 2) {
+            break;
+        }
+        if (marker == 0xE1 && segment >= 2 + 6 && pos + 2 + segment <= size &&
+            memcmp(data + pos + 4, "Exif\0\0", 6) == 0) {
+            size_t tiff = pos + 4 + 6;
+            return exif_thumbnail(data + tiff, segment - 2 - 6, tiff, offset, length);
+        }
+        pos += 2 + segment;
+    }
+    return false;
+}
+
+bool network_read_image_preview(NetworkManager *mgr, int conn_id, const char *path,
+                                unsigned char **data, size_t *size, bool *thumbnail)
+{
+    NetworkConnection *conn = network_get_connection(mgr, conn_id);
+    RemoteBlockFile *file = conn ? remote_range_open(mgr, conn, path) : NULL;
+    if (!file) {
+        return false;
+    }
+
+    // The first block holds a JPEG's EXIF data, thumbnail included
+    uint64_t file_size = remote_blocks_size(file);
+    size_t head = file_size < NETWORK_PREVIEW_BYTES ? (size_t)file_size : NETWORK_PREVIEW_BYTES;
+    unsigned char *bytes = malloc(head > 0 ? head : 1);
+    bool ok = bytes && remote_range_fetch(conn, file, path, 0, head) &&
+              remote_blocks_read(file, 0, bytes, head) == (ssize_t)head;
+
+    size_t at, length;
+    *thumbnail = ok && network_jpeg_thumbnail(bytes, head, &at, &length);
+    if (*thumbnail) {
+        memmove(bytes, bytes + at, length);
+        *size = length;
+    } else if (ok && head < file_size) {
+        // No thumbnail: the whole image
+        unsigned char *whole = file_size <= NETWORK_IMAGE_PREVIEW_MAX ? realloc(bytes, (size_t)file_size) : NULL;
+        ok = whole && remote_range_fetch(conn, file, path, head, file_size - head) &&
+             remote_blocks_read(file, head, whole + head, (size_t)(file_size - head)) == (ssize_t)(file_size - head);
+        bytes = whole ? whole : bytes;
+        *size = (size_t)file_size;
+    } else {
+        *size = head;
+    }
+
+    remote_blocks_close(file);
+    if (!ok) {
+        free(bytes);
+        return false;
+    }
+    conn->last_activity = (double)time(NULL);
+    *data = bytes;
+    return true;
+}
+
+// Helper: The blocks of a remote SFTP file if the cache holds every one, else NULL
+static RemoteBlockFile *remote_blocks_cached(NetworkManager *mgr, NetworkConnection *conn, const char *remote)
+{
+    uint64_t size;
+    int64_t mtime;
+    if (!mgr->blocks || conn->profile.type != CONN_TYPE_SFTP || strlen(remote) >= NETWORK_PATH_MAX ||
+        !remote_file_version(conn, remote, true, &size, &mtime)) {
+        return NULL;
+    }
+
+    char key[NETWORK_PATH_MAX + 256];
+    remote_block_key(conn, remote, key, sizeof(key));
+    RemoteBlockFile *file = remote_blocks_find(mgr->blocks, key, size, mtime);
+    if (file && !remote_blocks_complete(file)) {
+        remote_blocks_close(file);
+        return NULL;
+    }
+    return file;
+}
+
+// Helper: Copy cached blocks to a local file, reporting into control and stopping if
+// it is cancelled
+static bool remote_blocks_copy(RemoteBlockFile *file, const char *local, CopyControl *control)
+{
+    int fd = open(local, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    char *buffer = malloc(SFTP_TRANSFER_BUFFER);
+    bool ok = buffer != NULL;
+    uint64_t size = remote_blocks_size(file);
+    for (uint64_t at = 0; ok && at < size; ) {
+        ssize_t n = remote_blocks_read(file, at, buffer, SFTP_TRANSFER_BUFFER);
+        ok = n > 0 && !(control && atomic_load(&control->cancel)) && write(fd, buffer, (size_t)n) == n;
+        if (ok) {
+            at += (uint64_t)n;
+            if (control) {
+                atomic_fetch_add(&control->bytes_done, (long long)n);
+            }
+        }
+    }
+    free(buffer);
+
+    if (close(fd) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        unlink(local);
+    }
+    return ok;
+}
+
+bool network_download_file(NetworkManager *mgr, int conn_id, const char *remote_path, const char *local_path,
+                           CopyControl *control)
+{
+    NetworkConnection *conn = network_get_connection(mgr, conn_id);
+    if (!conn || conn->status != CONN_STATUS_CONNECTED) {
+        return false;
+    }
+
+    bool success = false;
+    switch (conn->profile.type) {
+        case CONN_TYPE_SFTP: {
+            RemoteBlockFile *cached = remote_blocks_cached(mgr, conn, remote_path);
+            success = cached ? remote_blocks_copy(cached, local_path, control)
+                             : sftp_download(conn, remote_path, local_path, control);
+            remote_blocks_close(cached);
+            break;
+        }
+        case CONN_TYPE_SMB:
+            success = smb_download(conn, remote_path, local_path, control);
+            break;
+        default:
+            break;
+    }
+
+    if (success) {
+        conn->last_activity = (double)time(NULL);
+    }
+
+    return success;
+}
+
+bool network_upload_file(NetworkManager *mgr, int conn_id, const char *local_path, const char *remote_path,
+                         CopyControl *control)
+{
+    NetworkConnection *conn = network_get_connection(mgr, conn_id);
+    if (!conn || conn->status != CONN_STATUS_CONNECTED) {
+        return false;
+    }
+
+    bool success = false;
+    switch (conn->profile.type) {
         case CONN_TYPE_SFTP:
-            success = sftp_upload(conn, local_path, remote_path);
+            success = sftp_upload(conn, local_path, remote_path, control);
+            break;
+        case CONN_TYPE_SMB:
+            success = smb_upload(conn, local_path, remote_path, control);
             break;
         default:
             break;
     }
 
+    // Even a failed upload may have created or truncated the remote file
+    remote_listings_invalidate_parent(conn, remote_path);
     if (success) {
         conn->last_activity = (double)time(NULL);
     }
@@ -652,11 +1517,15 @@ bool network_delete_file(NetworkManager *mgr, int conn_id, const char *path)
         case CONN_TYPE_SFTP:
             success = sftp_unlink(conn, path);
             break;
+        case CONN_TYPE_SMB:
+            success = smb_unlink(conn, path);
+            break;
         default:
             break;
     }
 
     if (success) {
+        remote_listings_invalidate_parent(conn, path);
         conn->last_activity = (double)time(NULL);
     }
 
@@ -675,10 +1544,160 @@ bool network_rename_file(NetworkManager *mgr, int conn_id, const char *old_path,
         case CONN_TYPE_SFTP:
             success = sftp_rename(conn, old_path, new_path);
             break;
+        case CONN_TYPE_SMB:
+            success = smb_rename(conn, old_path, new_path);
+            break;
+        default:
+            break;
+    }
+
+    if (success) {
+        remote_listings_invalidate(conn, old_path);
+        remote_listings_invalidate_parent(conn, old_path);
+        remote_listings_invalidate_parent(conn, new_path);
+        conn->last_activity = (double)time(NULL);
+    }
+
+    return success;
+}
+
+bool network_copy_remote(NetworkManager *mgr, int conn_id, const char *source, const char *dest)
+{
+    NetworkConnection *conn = network_get_connection(mgr, conn_id);
+    if (!conn || conn->status != CONN_STATUS_CONNECTED) {
+        return false;
+    }
+
+    bool success = false;
+    switch (conn->profile.type) {
+        case CONN_TYPE_SFTP:
+            success = sftp_copy_remote(conn, source, dest);
+            break;
+        default:
+            break;
+    }
+
+    // A failed copy may have left part of dest behind
+    remote_listings_invalidate(conn, dest);
+    remote_listings_invalidate_parent(conn, dest);
+    if (success) {
+        conn->last_activity = (double)time(NULL);
+    }
+
+    return success;
+}
+
+// Helper: Add a walked file to a folder size
+static bool folder_size_add(void *context, const RemoteWalkEntry *entry)
+{
+    uint64_t *totals = context;
+    if (!entry->is_directory) {
+        totals[0] += entry->size;
+        totals[1]++;
+    }
+    return true;
+}
+
+bool network_remote_walk(NetworkManager *mgr, int conn_id, const char *path, RemoteWalkFn fn, void *context)
+{
+    NetworkConnection *conn = network_get_connection(mgr, conn_id);
+    if (!conn || conn->status != CONN_STATUS_CONNECTED || conn->profile.type != CONN_TYPE_SFTP) {
+        return false;
+    }
+
+    bool success = sftp_remote_walk(conn, path, fn, context);
+    if (success) {
+        conn->last_activity = (double)time(NULL);
+    }
+    return success;
+}
+
+bool network_remote_folder_size(NetworkManager *mgr, int conn_id, const char *path,
+                                uint64_t *bytes, uint64_t *files)
+{
+    uint64_t totals[2] = {0, 0};
+    if (!network_remote_walk(mgr, conn_id, path, folder_size_add, totals)) {
+        return false;
+    }
+    *bytes = totals[0];
+    *files = totals[1];
+    return true;
+}
+
+bool network_remote_hashes(NetworkManager *mgr, int conn_id, const char *const *paths, int count,
+                           char (*hashes)[NETWORK_HASH_HEX + 1])
+{
+    NetworkConnection *conn = network_get_connection(mgr, conn_id);
+    if (!conn || conn->status != CONN_STATUS_CONNECTED || conn->profile.type != CONN_TYPE_SFTP) {
+        return false;
+    }
+
+    bool success = sftp_remote_hashes(conn, paths, count, hashes);
+    if (success) {
+        conn->last_activity = (double)time(NULL);
+    }
+    return success;
+}
+
+bool network_remote_thumbnail(NetworkManager *mgr, int conn_id, const char *path, int max_size,
+                              unsigned char **data, size_t *size)
+{
+    NetworkConnection *conn = network_get_connection(mgr, conn_id);
+    if (!conn || conn->status != CONN_STATUS_CONNECTED || conn->profile.type != CONN_TYPE_SFTP) {
+        return false;
+    }
+
+    bool success = sftp_remote_thumbnail(conn, path, max_size, data, size);
+    if (success) {
+        conn->last_activity = (double)time(NULL);
+    }
+    return success;
+}
+
+bool network_sync_file(NetworkManager *mgr, int conn_id, const char *local_path, const char *remote_path,
+                       CopyControl *control)
+{
+    NetworkConnection *conn = network_get_connection(mgr, conn_id);
+    if (!conn || conn->status != CONN_STATUS_CONNECTED) {
+        return false;
+    }
+
+    bool success = false;
+    switch (conn->profile.type) {
+        case CONN_TYPE_SFTP:
+            success = sftp_sync_file(conn, local_path, remote_path, control);
+            break;
+        default:
+            break;
+    }
+
+    remote_listings_invalidate_parent(conn, remote_path);
+    if (success) {
+        conn->last_activity = (double)time(NULL);
+    }
+
+    return success;
+}
+
+bool network_sync_directory(NetworkManager *mgr, int conn_id, const char *local_dir, const char *remote_dir,
+                            CopyControl *control)
+{
+    NetworkConnection *conn = network_get_connection(mgr, conn_id);
+    if (!conn || conn->status != CONN_STATUS_CONNECTED) {
+        return false;
+    }
+
+    bool success = false;
+    switch (conn->profile.type) {
+        case CONN_TYPE_SFTP:
+            success = sftp_sync_directory(conn, local_dir, remote_dir, control);
+            break;
         default:
             break;
     }
 
+    remote_listings_invalidate(conn, remote_dir);
+    remote_listings_invalidate_parent(conn, remote_dir);
     if (success) {
         conn->last_activity = (double)time(NULL);
     }
@@ -730,11 +1749,89 @@ bool network_validate_profile(const ConnectionProfile *profile, char *error, siz
 
 // SFTP Implementation
 
+// Helper: Try one way of authenticating the session (skipped if the profile lacks what
+// it needs)
+static bool sftp_authenticate(LIBSSH2_SESSION *session, NetworkConnection *conn, AuthMethod method)
+{
+    const ConnectionProfile *profile = &conn->profile;
+
+    switch (method) {
+        case AUTH_PASSWORD:
+            return profile->password[0] != '\0' &&
+                   libssh2_userauth_password(session, profile->username, profile->password) == 0;
+
+        case AUTH_PUBLICKEY: {
+            if (profile->private_key_path[0] == '\0') {
+                return false;
+            }
+            char pub_key_path[PATH_MAX_LEN];
+            snprintf(pub_key_path, sizeof(pub_key_path), "%s.pub", profile->private_key_path);
+            return libssh2_userauth_publickey_fromfile(session, profile->username, pub_key_path,
+                                                       profile->private_key_path, profile->password) == 0;
+        }
+
+        case AUTH_AGENT: {
+            bool ok = false;
+            LIBSSH2_AGENT *agent = libssh2_agent_init(session);
+            if (agent) {
+                if (libssh2_agent_connect(agent) == 0) {
+                    if (libssh2_agent_list_identities(agent) == 0) {
+                        struct libssh2_agent_publickey *identity = NULL;
+                        while (libssh2_agent_get_identity(agent, &identity, identity) == 0) {
+                            if (libssh2_agent_userauth(agent, profile->username, identity) == 0) {
+                                ok = true;
+                                break;
+                            }
+                        }
+                    }
+                    libssh2_agent_disconnect(agent);
+                }
+                libssh2_agent_free(agent);
+            }
+            return ok;
+        }
+
+        default:
+            return false;
+    }
+}
+
+// Helper: Whether a connection compresses: as its profile says, else when the link is
+// far or (measured) slow
+static bool sftp_wants_compression(const NetworkConnection *conn)
+{
+    switch (conn->profile.compression) {
+        case SSH_COMPRESSION_ON:
+            return true;
+        case SSH_COMPRESSION_OFF:
+            return false;
+        default:
+            return conn->link_rtt > NETWORK_COMPRESS_RTT ||
+                   (conn->link_throughput > 0 && conn->link_throughput < NETWORK_COMPRESS_THROUGHPUT);
+    }
+}
+
+// Helper: Offer the connection's compression and ciphers in the handshake. Names this
+// libssh2 does not know are left out of what it offers
+static void sftp_tune_transport(LIBSSH2_SESSION *session, const NetworkConnection *conn)
+{
+    const char *ciphers = conn->profile.ciphers[0] ? conn->profile.ciphers : NETWORK_CIPHERS;
+    if (libssh2_session_method_pref(session, LIBSSH2_METHOD_CRYPT_CS, ciphers) != 0 ||
+        libssh2_session_method_pref(session, LIBSSH2_METHOD_CRYPT_SC, ciphers) != 0) {
+        // None known: keep libssh2's own list
+        libssh2_session_method_pref(session, LIBSSH2_METHOD_CRYPT_CS, NETWORK_CIPHERS);
+        libssh2_session_method_pref(session, LIBSSH2_METHOD_CRYPT_SC, NETWORK_CIPHERS);
+    }
+
+    bool compress = sftp_wants_compression(conn);
+    libssh2_session_flag(session, LIBSSH2_FLAG_COMPRESS, compress ? 1 : 0);
+}
+
 bool sftp_connect(NetworkConnection *conn)
 {
     // Connect socket
     int port = conn->profile.port > 0 ? conn->profile.port : SFTP_DEFAULT_PORT;
-    conn->socket = connect_to_host(conn->profile.host, port);
+    conn->socket = connect_to_host(conn, port);
     if (conn->socket < 0) {
         snprintf(conn->error_message, sizeof(conn->error_message),
                  "Failed to connect to %s:%d", conn->profile.host, port);
@@ -752,6 +1849,7 @@ bool sftp_connect(NetworkConnection *conn)
 
     // Set session to blocking mode for simplicity
     libssh2_session_set_blocking(session, 1);
+    sftp_tune_transport(session, conn);
 
     // Perform SSH handshake
     int rc = libssh2_session_handshake(session, conn->socket);
@@ -766,52 +1864,17 @@ bool sftp_connect(NetworkConnection *conn)
         return false;
     }
 
-    // Authenticate
-    bool auth_success = false;
-
-    // Try password authentication if password is provided
-    if (conn->profile.password[0] != '\0') {
-        rc = libssh2_userauth_password(session, conn->profile.username, conn->profile.password);
-        if (rc == 0) {
-            auth_success = true;
-        }
-    }
-
-    // Try public key authentication if key path is provided
-    if (!auth_success && conn->profile.private_key_path[0] != '\0') {
-        char pub_key_path[PATH_MAX_LEN];
-        snprintf(pub_key_path, sizeof(pub_key_path), "%s.pub", conn->profile.private_key_path);
-
-        rc = libssh2_userauth_publickey_fromfile(session,
-                                                  conn->profile.username,
-                                                  pub_key_path,
-                                                  conn->profile.private_key_path,
-                                                  conn->profile.password);
-        if (rc == 0) {
+    // Authenticate: password, public key, then the agent, starting with whichever worked
+    // last time so a reconnect makes one attempt
+    static const AuthMethod methods[] = { AUTH_PASSWORD, AUTH_PUBLICKEY, AUTH_AGENT };
+    bool auth_success = conn->auth_method != AUTH_NONE && sftp_authenticate(session, conn, conn->auth_method);
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]) && !auth_success; i++) {
+        if (methods[i] != conn->auth_method && sftp_authenticate(session, conn, methods[i])) {
+            conn->auth_method = methods[i];
             auth_success = true;
         }
     }
 
-    // Try agent authentication
-    if (!auth_success) {
-        LIBSSH2_AGENT *agent = libssh2_agent_init(session);
-        if (agent) {
-            if (libssh2_agent_connect(agent) == 0) {
-                if (libssh2_agent_list_identities(agent) == 0) {
-                    struct libssh2_agent_publickey *identity = NULL;
-                    while (libssh2_agent_get_identity(agent, &identity, identity) == 0) {
-                        if (libssh2_agent_userauth(agent, conn->profile.username, identity) == 0) {
-                            auth_success = true;
-                            break;
-                        }
-                    }
-                }
-                libssh2_agent_disconnect(agent);
-            }
-            libssh2_agent_free(agent);
-        }
-    }
-
     if (!auth_success) {
         strncpy(conn->error_message, "Authentication failed", sizeof(conn->error_message) - 1);
         libssh2_session_disconnect(session, "Auth failed");
@@ -837,12 +1900,33 @@ bool sftp_connect(NetworkConnection *conn)
 
     conn->ssh_session = session;
     conn->sftp_session = sftp;
+    const char *comp = libssh2_session_methods(session, LIBSSH2_METHOD_COMP_SC);
+    conn->compressed = comp && strcmp(comp, "none") != 0;
+
+    // From here on the session belongs to the connection's network thread
+    conn->io = network_io_start(session, sftp, conn->socket);
+    if (!conn->io) {
+        strncpy(conn->error_message, "Failed to start network thread", sizeof(conn->error_message) - 1);
+        sftp_disconnect(conn);
+        return false;
+    }
 
     return true;
 }
 
 void sftp_disconnect(NetworkConnection *conn)
 {
+    // A lost session's socket is cut first, so shutting it down fails at once instead of
+    // waiting on the link
+    if (conn->io && network_io_lost(conn->io) && conn->socket >= 0) {
+        shutdown(conn->socket, SHUT_RDWR);
+    }
+
+    if (conn->io) {
+        network_io_stop(conn->io);
+        conn->io = NULL;
+    }
+
     if (conn->sftp_session) {
         libssh2_sftp_shutdown((LIBSSH2_SFTP*)conn->sftp_session);
         conn->sftp_session = NULL;
@@ -860,235 +1944,698 @@ void sftp_disconnect(NetworkConnection *conn)
     }
 }
 
-bool sftp_read_directory(NetworkConnection *conn, const char *path, DirectoryState *dir)
+// Helper: Prepare a request for op on path; false if the path does not fit
+static bool sftp_request(NetworkRequest *req, NetworkOp op, const char *path)
 {
-    if (!conn->sftp_session) {
+    network_request_init(req, op);
+    if (strlen(path) >= NETWORK_PATH_MAX) {
         return false;
     }
+    strcpy(req->path, path);
+    return true;
+}
 
-    LIBSSH2_SFTP *sftp = (LIBSSH2_SFTP*)conn->sftp_session;
-    LIBSSH2_SFTP_HANDLE *handle = libssh2_sftp_opendir(sftp, path);
-    if (!handle) {
-        char *errmsg;
-        libssh2_session_last_error((LIBSSH2_SESSION*)conn->ssh_session, &errmsg, NULL, 0);
-        snprintf(conn->error_message, sizeof(conn->error_message),
-                 "Failed to open directory: %s", errmsg);
+// Helper: Run req on the connection's network thread and wait for it
+static bool sftp_run(NetworkConnection *conn, NetworkRequest *req)
+{
+    if (!conn->io) {
         return false;
     }
+    return network_io_run(conn->io, req);
+}
+
+// Helper: Run a request that only needs its paths
+static bool sftp_simple(NetworkConnection *conn, NetworkOp op, const char *path, const char *target)
+{
+    NetworkRequest req;
+    bool ok = sftp_request(&req, op, path);
+    if (ok && target) {
+        ok = strlen(target) < NETWORK_PATH_MAX;
+        if (ok) {
+            strcpy(req.target, target);
+        }
+    }
+    ok = ok && sftp_run(conn, &req);
+    network_request_free(&req);
+    return ok;
+}
 
-    // Clear existing entries
-    directory_state_free(dir);
-    directory_state_init(dir);
-    strncpy(dir->current_path, path, PATH_MAX_LEN - 1);
+bool sftp_read_directory(NetworkConnection *conn, const char *path, DirectoryState *dir)
+{
+    NetworkRequest req;
+    bool ok = sftp_request(&req, NET_OP_LIST, path) && sftp_run(conn, &req);
+    if (ok) {
+        // Hand the listing over to dir
+        directory_state_free(dir);
+        *dir = req.listing;
+        directory_state_init(&req.listing);
+    } else {
+        snprintf(conn->error_message, sizeof(conn->error_message),
+                 "Failed to open directory (error %d)", req.error);
+    }
+    network_request_free(&req);
+    return ok;
+}
 
-    char filename[512];
-    LIBSSH2_SFTP_ATTRIBUTES attrs;
+// Helper: wait out a pause; false once the transfer is cancelled
+static bool sftp_checkpoint(CopyControl *control)
+{
+    if (control == NULL) {
+        return true;
+    }
+    while (atomic_load(&control->pause) && !atomic_load(&control->cancel)) {
+        usleep(SFTP_PAUSE_POLL_US);
+    }
+    return !atomic_load(&control->cancel);
+}
 
-    while (1) {
-        int rc = libssh2_sftp_readdir(handle, filename, sizeof(filename), &attrs);
-        if (rc <= 0) {
-            break;
-        }
+// One byte range of a transfer, on a connection of its own when parallel
+typedef struct SftpSegment {
+    NetworkConnection *conn;        // The transfer's connection
+    NetworkConnection own;          // A parallel segment's own connection
+    NetworkRequest req;
+} SftpSegment;
 
-        // Skip . and ..
-        if (strcmp(filename, ".") == 0 || strcmp(filename, "..") == 0) {
-            continue;
-        }
+// Thread function: connect a parallel segment's own session, with its own network
+// thread, and run its range there
+static void *sftp_segment_worker(void *arg)
+{
+    SftpSegment *seg = (SftpSegment *)arg;
 
-        // Grow entries array if needed
-        if (dir->count >= dir->capacity) {
-            int new_capacity = dir->capacity == 0 ? 64 : dir->capacity * 2;
-            FileEntry *new_entries = realloc(dir->entries, new_capacity * sizeof(FileEntry));
-            if (!new_entries) {
-                break;
-            }
-            dir->entries = new_entries;
-            dir->capacity = new_capacity;
-        }
+    memset(&seg->own, 0, sizeof(seg->own));
+    seg->own.profile = seg->conn->profile;
+    seg->own.socket = -1;
+    connection_copy_hints(&seg->own, seg->conn);
 
-        FileEntry *entry = &dir->entries[dir->count];
-        memset(entry, 0, sizeof(FileEntry));
+    if (sftp_connect(&seg->own)) {
+        sftp_run(&seg->own, &seg->req);
+        sftp_disconnect(&seg->own);
+    }
+    return NULL;
+}
 
-        // Set name
-        strncpy(entry->name, filename, NAME_MAX_LEN - 1);
+// Helper: transfer size bytes between remote and the local fd. Large files are split
+// into segments sent in parallel over extra connections; a segment whose connection
+// could not be made, or that failed, is finished afterwards on conn
+static bool sftp_transfer(NetworkConnection *conn, const char *remote, int fd, uint64_t size,
+                          bool upload, CopyControl *control)
+{
+    int streams = atomic_load(&g_transfer_streams);
+    if (size == UINT64_MAX || size < SFTP_PARALLEL_MIN_SIZE) {
+        streams = 1;
+    }
 
-        // Set full path
-        if (strcmp(path, "/") == 0) {
-            snprintf(entry->path, PATH_MAX_LEN, "/%s", filename);
-        } else {
-            snprintf(entry->path, PATH_MAX_LEN, "%s/%s", path, filename);
+    SftpSegment *segments = calloc((size_t)streams, sizeof(SftpSegment));
+    if (!segments) {
+        return false;
+    }
+    pthread_t threads[SFTP_MAX_STREAMS];
+    bool started[SFTP_MAX_STREAMS] = {false};
+
+    // Segment boundaries fall on buffer multiples; the last segment takes the remainder
+    uint64_t per = size;
+    if (streams > 1) {
+        per = size / (uint64_t)streams;
+        per -= per % SFTP_TRANSFER_BUFFER;
+    }
+    for (int i = 0; i < streams; i++) {
+        SftpSegment *seg = &segments[i];
+        seg->conn = conn;
+        sftp_request(&seg->req, upload ? NET_OP_WRITE : NET_OP_READ, remote);
+        seg->req.fd = fd;
+        seg->req.control = control;
+        seg->req.offset = per * (uint64_t)i;
+        seg->req.length = i == streams - 1 ? size - seg->req.offset : per;
+    }
+
+    // The first segment runs on conn's network thread while the others connect
+    double start = network_now();
+    bool ok = conn->io && network_io_submit(conn->io, &segments[0].req);
+    for (int i = 1; i < streams; i++) {
+        started[i] = pthread_create(&threads[i], NULL, sftp_segment_worker, &segments[i]) == 0;
+    }
+    ok = ok && network_io_wait(conn->io, &segments[0].req);
+
+    for (int i = 1; i < streams; i++) {
+        NetworkRequest *req = &segments[i].req;
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
         }
 
-        // Set extension
-        const char *dot = strrchr(filename, '.');
-        if (dot && dot != filename) {
-            strncpy(entry->extension, dot + 1, EXTENSION_MAX_LEN - 1);
+        // Pick up where a lost segment stopped
+        if (ok && !req->ok && sftp_checkpoint(control)) {
+            req->offset += req->done;
+            req->length -= req->done;
+            sftp_run(conn, req);
         }
+        ok = ok && req->ok;
+    }
 
-        // Set type
-        entry->is_directory = LIBSSH2_SFTP_S_ISDIR(attrs.permissions);
-        entry->is_hidden = (filename[0] == '.');
-        entry->is_symlink = LIBSSH2_SFTP_S_ISLNK(attrs.permissions);
+    for (int i = 0; i < streams; i++) {
+        network_request_free(&segments[i].req);
+    }
+    free(segments);
+
+    // Compressed sessions measure what zlib made of the data, not the link
+    double elapsed = network_now() - start;
+    if (ok && !conn->compressed && size != UINT64_MAX && size >= NETWORK_MEASURE_MIN_BYTES && elapsed > 0) {
+        double throughput = (double)size / elapsed;
+        conn->link_throughput = conn->link_throughput > 0 ? (conn->link_throughput + throughput) / 2 : throughput;
+    }
+    return ok;
+}
 
-        // Set size and times
-        entry->size = (off_t)attrs.filesize;
-        entry->modified = (time_t)attrs.mtime;
-        entry->created = (time_t)attrs.mtime;
-        entry->permissions = (mode_t)attrs.permissions;
+void network_set_transfer_streams(int streams)
+{
+    if (streams < 1) {
+        streams = 1;
+    }
+    if (streams > SFTP_MAX_STREAMS) {
+        streams = SFTP_MAX_STREAMS;
+    }
+    atomic_store(&g_transfer_streams, streams);
+}
 
-        dir->count++;
+bool sftp_download(NetworkConnection *conn, const char *remote, const char *local, CopyControl *control)
+{
+    // Without a size from the server, read to the end on one stream
+    NetworkRequest stat;
+    bool found = sftp_request(&stat, NET_OP_STAT, remote) && sftp_run(conn, &stat);
+    uint64_t size = stat.size;
+    network_request_free(&stat);
+    if (!found) {
+        return false;
     }
 
-    libssh2_sftp_closedir(handle);
+    int fd = open(local, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
 
-    // Sort entries (directories first, then alphabetical by name)
-    directory_sort(dir, SORT_BY_NAME, true);
+    bool success = sftp_transfer(conn, remote, fd, size, false, control);
 
-    return true;
+    if (close(fd) != 0) {
+        success = false;
+    }
+    if (!success) {
+        unlink(local);
+    }
+    return success;
 }
 
-bool sftp_download(NetworkConnection *conn, const char *remote, const char *local)
+bool sftp_upload(NetworkConnection *conn, const char *local, const char *remote, CopyControl *control)
 {
-    if (!conn->sftp_session) {
+    int fd = open(local, O_RDONLY);
+    if (fd < 0) {
         return false;
     }
 
-    LIBSSH2_SFTP *sftp = (LIBSSH2_SFTP*)conn->sftp_session;
-    LIBSSH2_SFTP_HANDLE *handle = libssh2_sftp_open(sftp, remote,
-                                                     LIBSSH2_FXF_READ, 0);
-    if (!handle) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
         return false;
     }
 
-    FILE *f = fopen(local, "wb");
-    if (!f) {
-        libssh2_sftp_close(handle);
-        return false;
-    }
+    // Create or truncate the remote file; each segment then opens it for writing
+    bool success = sftp_simple(conn, NET_OP_CREATE, remote, NULL) &&
+                   sftp_transfer(conn, remote, fd, (uint64_t)st.st_size, true, control);
 
-    char buffer[32768];
-    ssize_t nread;
+    close(fd);
+    return success;
+}
 
-    while ((nread = libssh2_sftp_read(handle, buffer, sizeof(buffer))) > 0) {
-        if (fwrite(buffer, 1, nread, f) != (size_t)nread) {
-            fclose(f);
-            libssh2_sftp_close(handle);
-            unlink(local);
+// Helper: Quote s as one POSIX shell word; false if it does not fit in out
+static bool shell_quote(const char *s, char *out, size_t out_size)
+{
+    size_t len = 0;
+    if (out_size < 3) {
+        return false;
+    }
+    out[len++] = '\'';
+    for (; *s; s++) {
+        // A quote closes the string, adds an escaped quote and reopens it
+        const char *piece = *s == '\'' ? "'\\''" : NULL;
+        size_t piece_len = piece ? 4 : 1;
+        if (len + piece_len + 2 > out_size) {
             return false;
         }
+        if (piece) {
+            memcpy(out + len, piece, piece_len);
+        } else {
+            out[len] = *s;
+        }
+        len += piece_len;
     }
+    out[len++] = '\'';
+    out[len] = '\0';
+    return true;
+}
 
-    fclose(f);
-    libssh2_sftp_close(handle);
-
-    return nread == 0;
+// Helper: Run a shell command on the server and wait for it; req keeps its output
+static bool sftp_exec(NetworkConnection *conn, const char *command, NetworkRequest *req)
+{
+    network_request_init(req, NET_OP_EXEC);
+    req->command = command;
+    return sftp_run(conn, req);
 }
 
-bool sftp_upload(NetworkConnection *conn, const char *local, const char *remote)
+bool sftp_copy_remote(NetworkConnection *conn, const char *source, const char *dest)
 {
-    if (!conn->sftp_session) {
+    char quoted_source[NETWORK_PATH_MAX * 4 + 3];
+    char quoted_dest[NETWORK_PATH_MAX * 4 + 3];
+    if (!shell_quote(source, quoted_source, sizeof(quoted_source)) ||
+        !shell_quote(dest, quoted_dest, sizeof(quoted_dest))) {
         return false;
     }
 
-    FILE *f = fopen(local, "rb");
-    if (!f) {
+    // The server copies on its own disk; nothing but the command crosses the link
+    char command[sizeof(quoted_source) + sizeof(quoted_dest) + 32];
+    snprintf(command, sizeof(command), "cp -Rp -- %s %s", quoted_source, quoted_dest);
+
+    NetworkRequest req;
+    bool ok = sftp_exec(conn, command, &req);
+    if (!ok) {
+        snprintf(conn->error_message, sizeof(conn->error_message),
+                 "Remote copy failed (exit status %d)", req.exit_status);
+    }
+    network_request_free(&req);
+    return ok;
+}
+
+// Helper: Parse one "type<TAB>size<TAB>mtime<TAB>path" line of a walk (GNU find's %y
+// or BSD stat's mode string for the type); false for anything but files and folders
+static bool remote_walk_parse(char *line, RemoteWalkEntry *entry)
+{
+    char type = line[0];
+    char *size = strchr(line, '\t');
+    char *mtime = size ? strchr(size + 1, '\t') : NULL;
+    char *path = mtime ? strchr(mtime + 1, '\t') : NULL;
+    if (!path || (type != 'd' && type != 'f' && type != '-')) {
+        return false;
+    }
+    path++;
+    if (strncmp(path, "./", 2) == 0) {
+        path += 2;
+    }
+    if (*path == '\0') {
         return false;
     }
 
-    LIBSSH2_SFTP *sftp = (LIBSSH2_SFTP*)conn->sftp_session;
-    LIBSSH2_SFTP_HANDLE *handle = libssh2_sftp_open(sftp, remote,
-                                                     LIBSSH2_FXF_WRITE | LIBSSH2_FXF_CREAT | LIBSSH2_FXF_TRUNC,
-                                                     LIBSSH2_SFTP_S_IRUSR | LIBSSH2_SFTP_S_IWUSR |
-                                                     LIBSSH2_SFTP_S_IRGRP | LIBSSH2_SFTP_S_IROTH);
-    if (!handle) {
-        fclose(f);
+    entry->path = path;
+    entry->size = strtoull(size + 1, NULL, 10);
+    entry->mtime = strtoll(mtime + 1, NULL, 10);
+    entry->is_directory = type == 'd';
+    return true;
+}
+
+bool sftp_remote_walk(NetworkConnection *conn, const char *path, RemoteWalkFn fn, void *context)
+{
+    char quoted[NETWORK_PATH_MAX * 4 + 3];
+    if (!shell_quote(path, quoted, sizeof(quoted))) {
         return false;
     }
 
-    char buffer[32768];
-    size_t nread;
-    bool success = true;
+    // GNU find prints the fields itself; BSD find hands each batch of paths to stat.
+    // Unreadable folders are left out rather than failing the walk
+    char command[sizeof(quoted) + 320];
+    snprintf(command, sizeof(command),
+             "cd -- %s || exit 1; "
+             "if find . -maxdepth 0 -printf '' >/dev/null 2>&1; then "
+             "find . -mindepth 1 -printf '%%y\\t%%s\\t%%T@\\t%%P\\n' 2>/dev/null; "
+             "else find . -mindepth 1 -exec stat -f '%%Sp%%t%%z%%t%%m%%t%%N' {} + 2>/dev/null; fi; "
+             "exit 0",
+             quoted);
 
-    while ((nread = fread(buffer, 1, sizeof(buffer), f)) > 0) {
-        ssize_t nwritten = libssh2_sftp_write(handle, buffer, nread);
-        if (nwritten != (ssize_t)nread) {
-            success = false;
-            break;
+    FILE *listing = tmpfile();
+    if (!listing) {
+        return false;
+    }
+
+    NetworkRequest req;
+    network_request_init(&req, NET_OP_EXEC);
+    req.command = command;
+    req.fd = fileno(listing);
+    bool ok = sftp_run(conn, &req);
+    if (!ok) {
+        snprintf(conn->error_message, sizeof(conn->error_message),
+                 "Remote listing failed (exit status %d)", req.exit_status);
+    }
+    network_request_free(&req);
+
+    // Entries are handed over as they are read back, never all held at once
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+    rewind(listing);
+    while (ok && (len = getline(&line, &line_size, listing)) > 0) {
+        if (line[len - 1] == '\n') {
+            line[len - 1] = '\0';
+        }
+        RemoteWalkEntry entry;
+        if (remote_walk_parse(line, &entry)) {
+            ok = fn(context, &entry);
         }
     }
+    free(line);
+    fclose(listing);
+    return ok;
+}
 
-    // Check for file error before closing
-    bool had_error = ferror(f);
-    fclose(f);
-    libssh2_sftp_close(handle);
+bool sftp_remote_hashes(NetworkConnection *conn, const char *const *paths, int count,
+                        char (*hashes)[NETWORK_HASH_HEX + 1])
+{
+    static const char prefix[] =
+        "if command -v sha256sum >/dev/null 2>&1; then h=sha256sum; else h='shasum -a 256'; fi; "
+        "for f in";
+    // Each file is hashed from standard input, so every one prints a line, in order,
+    // and one that cannot be read prints "-"
+    static const char suffix[] = "; do $h < \"$f\" 2>/dev/null || echo -; done";
+
+    char *command = malloc(NETWORK_HASH_COMMAND_MAX);
+    char quoted[NETWORK_PATH_MAX * 4 + 3];
+    if (!command) {
+        return false;
+    }
 
-    return success && !had_error;
+    bool ok = true;
+    for (int first = 0; ok && first < count; ) {
+        // As many paths as fit in one command
+        size_t len = snprintf(command, NETWORK_HASH_COMMAND_MAX, "%s", prefix);
+        int last = first;
+        while (last < count && shell_quote(paths[last], quoted, sizeof(quoted)) &&
+               len + strlen(quoted) + sizeof(suffix) + 1 < NETWORK_HASH_COMMAND_MAX) {
+            command[len++] = ' ';
+            strcpy(command + len, quoted);
+            len += strlen(quoted);
+            last++;
+        }
+        if (last == first) {
+            // A path too long to quote
+            hashes[first++][0] = '\0';
+            continue;
+        }
+        memcpy(command + len, suffix, sizeof(suffix));
+
+        NetworkRequest req;
+        ok = sftp_exec(conn, command, &req) && req.output;
+        const char *line = ok ? req.output : NULL;
+        for (int i = first; ok && i < last; i++) {
+            const char *end = strchr(line, '\n');
+            size_t line_len = end ? (size_t)(end - line) : strlen(line);
+            bool hex = line_len >= NETWORK_HASH_HEX && strspn(line, "0123456789abcdef") >= NETWORK_HASH_HEX;
+            memcpy(hashes[i], line, hex ? NETWORK_HASH_HEX : 0);
+            hashes[i][hex ? NETWORK_HASH_HEX : 0] = '\0';
+            ok = end != NULL;
+            line = end ? end + 1 : line;
+        }
+        network_request_free(&req);
+        first = last;
+    }
+
+    free(command);
+    return ok;
 }
 
-bool sftp_mkdir(NetworkConnection *conn, const char *path)
+bool sftp_remote_thumbnail(NetworkConnection *conn, const char *path, int max_size,
+                           unsigned char **data, size_t *size)
 {
-    if (!conn->sftp_session) {
+    char quoted[NETWORK_PATH_MAX * 4 + 3];
+    if (max_size <= 0 || !shell_quote(path, quoted, sizeof(quoted))) {
         return false;
     }
 
-    LIBSSH2_SFTP *sftp = (LIBSSH2_SFTP*)conn->sftp_session;
-    int rc = libssh2_sftp_mkdir(sftp, path,
-                                 LIBSSH2_SFTP_S_IRWXU |
-                                 LIBSSH2_SFTP_S_IRGRP | LIBSSH2_SFTP_S_IXGRP |
-                                 LIBSSH2_SFTP_S_IROTH | LIBSSH2_SFTP_S_IXOTH);
-    return rc == 0;
+    // ImageMagick reads the first frame and writes to standard output; sips (macOS)
+    // needs a file to write to
+    char command[sizeof(quoted) + 640];
+    snprintf(command, sizeof(command),
+             "f=%s; "
+             "if command -v magick >/dev/null 2>&1; then c=magick; "
+             "elif command -v convert >/dev/null 2>&1; then c=convert; else c=; fi; "
+             "if [ -n \"$c\" ]; then "
+             "exec $c \"$f[0]\" -auto-orient -thumbnail %dx%d -strip -quality 80 jpg:- 2>/dev/null; fi; "
+             "command -v sips >/dev/null 2>&1 || exit 127; "
+             "t=$(mktemp) || exit 1; "
+             "sips -s format jpeg -Z %d \"$f\" --out \"$t\" >/dev/null 2>&1 && cat \"$t\"; s=$?; "
+             "rm -f \"$t\"; exit $s",
+             quoted, max_size, max_size, max_size);
+
+    NetworkRequest req;
+    bool ok = sftp_exec(conn, command, &req) && req.output_len > 2 &&
+              (unsigned char)req.output[0] == 0xFF && (unsigned char)req.output[1] == 0xD8;
+    if (ok) {
+        *data = (unsigned char *)req.output;
+        *size = req.output_len;
+        req.output = NULL;
+    }
+    network_request_free(&req);
+    return ok;
 }
 
-bool sftp_rmdir(NetworkConnection *conn, const char *path)
+// Helper: Hash the blocks of a remote file on the server, one hex SHA-256 per line.
+// Returns the output (caller frees), or NULL if the server has no way to hash them
+static char *sftp_remote_block_hashes(NetworkConnection *conn, const char *remote, uint64_t blocks)
+{
+    char quoted[NETWORK_PATH_MAX * 4 + 3];
+    if (!shell_quote(remote, quoted, sizeof(quoted))) {
+        return NULL;
+    }
+
+    char command[sizeof(quoted) + 384];
+    snprintf(command, sizeof(command),
+             "if command -v sha256sum >/dev/null 2>&1; then h=sha256sum; else h='shasum -a 256'; fi; "
+             "i=0; while [ $i -lt %llu ]; do "
+             "dd if=%s bs=%d skip=$i count=1 2>/dev/null | $h || exit 1; i=$((i+1)); done",
+             (unsigned long long)blocks, quoted, SFTP_SYNC_BLOCK);
+
+    NetworkRequest req;
+    char *hashes = NULL;
+    if (sftp_exec(conn, command, &req) && req.output) {
+        hashes = req.output;
+        req.output = NULL;
+    }
+    network_request_free(&req);
+    return hashes;
+}
+
+// Helper: Set the remote file's size (UINT64_MAX leaves it) and mtime
+static bool sftp_setstat(NetworkConnection *conn, const char *remote, uint64_t size, int64_t mtime)
 {
-    if (!conn->sftp_session) {
+    NetworkRequest req;
+    bool ok = sftp_request(&req, NET_OP_SETSTAT, remote);
+    req.size = size;
+    req.mtime = mtime;
+    ok = ok && sftp_run(conn, &req);
+    network_request_free(&req);
+    return ok;
+}
+
+// Helper: Send the blocks of fd whose hash differs from the remote one, writing each
+// run of changed blocks in place as one request. False if the hashes could not be had
+// or a write failed
+static bool sftp_sync_blocks(NetworkConnection *conn, const char *remote, int fd, uint64_t size,
+                             uint64_t remote_size, CopyControl *control)
+{
+    uint64_t remote_blocks = (remote_size + SFTP_SYNC_BLOCK - 1) / SFTP_SYNC_BLOCK;
+    char *hashes = sftp_remote_block_hashes(conn, remote, remote_blocks);
+    if (!hashes) {
+        return false;
+    }
+
+    unsigned char *block = malloc(SFTP_SYNC_BLOCK);
+    if (!block) {
+        free(hashes);
         return false;
     }
 
-    LIBSSH2_SFTP *sftp = (LIBSSH2_SFTP*)conn->sftp_session;
-    int rc = libssh2_sftp_rmdir(sftp, path);
-    return rc == 0;
+    bool ok = true;
+    const char *line = hashes;
+    uint64_t run_start = UINT64_MAX;    // Offset of the run of changed blocks, if any
+
+    for (uint64_t offset = 0; ok; offset += SFTP_SYNC_BLOCK) {
+        bool at_end = offset >= size;
+        bool changed = false;
+        size_t len = 0;
+
+        if (!at_end) {
+            len = (size - offset) < SFTP_SYNC_BLOCK ? (size_t)(size - offset) : SFTP_SYNC_BLOCK;
+            ssize_t got = pread(fd, block, len, (off_t)offset);
+            if (got != (ssize_t)len) {
+                ok = false;
+                break;
+            }
+
+            // The server's hash of this block, if it has one
+            changed = true;
+            if (line && strlen(line) >= NETWORK_HASH_HEX) {
+                unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+                char hex[NETWORK_HASH_HEX + 1];
+                CC_SHA256(block, (CC_LONG)len, digest);
+                for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+                    snprintf(hex + i * 2, 3, "%02x", digest[i]);
+                }
+                changed = strncmp(line, hex, NETWORK_HASH_HEX) != 0;
+            }
+            if (line) {
+                line = strchr(line, '\n');
+                line = line ? line + 1 : NULL;
+            }
+        }
+
+        if (changed) {
+            if (run_start == UINT64_MAX) {
+                run_start = offset;
+            }
+            continue;
+        }
+
+        // An unchanged block (or the end) closes the run before it
+        if (run_start != UINT64_MAX) {
+            ok = sftp_checkpoint(control);
+            if (ok) {
+                NetworkRequest req;
+                sftp_request(&req, NET_OP_WRITE, remote);
+                req.fd = fd;
+                req.control = control;
+                req.offset = run_start;
+                req.length = offset - run_start;
+                ok = sftp_run(conn, &req);
+                network_request_free(&req);
+            }
+            run_start = UINT64_MAX;
+        }
+        if (at_end) {
+            break;
+        }
+        if (control) {
+            atomic_fetch_add(&control->bytes_done, (long long)len);
+        }
+    }
+
+    free(block);
+    free(hashes);
+
+    // Drop what the remote file had past the local end
+    if (ok && remote_size > size) {
+        ok = sftp_setstat(conn, remote, size, 0);
+    }
+    return ok;
 }
 
-bool sftp_unlink(NetworkConnection *conn, const char *path)
+bool sftp_sync_file(NetworkConnection *conn, const char *local, const char *remote, CopyControl *control)
 {
-    if (!conn->sftp_session) {
+    int fd = open(local, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
         return false;
     }
+    uint64_t size = (uint64_t)st.st_size;
+
+    NetworkRequest stat_req;
+    bool found = sftp_request(&stat_req, NET_OP_STAT, remote) && sftp_run(conn, &stat_req);
+    uint64_t remote_size = stat_req.size;
+    int64_t remote_mtime = stat_req.mtime;
+    network_request_free(&stat_req);
+
+    // Same size and modification time: taken as already in sync
+    if (found && remote_size == size && remote_mtime == (int64_t)st.st_mtime) {
+        if (control) {
+            atomic_fetch_add(&control->bytes_done, (long long)size);
+        }
+        close(fd);
+        return true;
+    }
+
+    // Compare an existing large file block by block. If the server cannot hash its
+    // blocks, fall back to sending the file whole
+    bool success = false;
+    bool delta = found && remote_size != UINT64_MAX &&
+                 size >= SFTP_SYNC_MIN_SIZE && remote_size >= SFTP_SYNC_MIN_SIZE;
+    long long progress_before = control ? atomic_load(&control->bytes_done) : 0;
+    if (delta) {
+        success = sftp_sync_blocks(conn, remote, fd, size, remote_size, control);
+    }
+    if (!success && sftp_checkpoint(control)) {
+        if (control) {
+            atomic_store(&control->bytes_done, progress_before);
+        }
+        success = sftp_simple(conn, NET_OP_CREATE, remote, NULL) &&
+                  sftp_transfer(conn, remote, fd, size, true, control);
+    }
+
+    // Carry the local mtime over so the next sync can skip the file
+    if (success) {
+        success = sftp_setstat(conn, remote, UINT64_MAX, (int64_t)st.st_mtime);
+    }
 
-    LIBSSH2_SFTP *sftp = (LIBSSH2_SFTP*)conn->sftp_session;
-    int rc = libssh2_sftp_unlink(sftp, path);
-    return rc == 0;
+    close(fd);
+    return success;
 }
 
-bool sftp_rename(NetworkConnection *conn, const char *old_path, const char *new_path)
+bool sftp_sync_directory(NetworkConnection *conn, const char *local_dir, const char *remote_dir,
+                         CopyControl *control)
 {
-    if (!conn->sftp_session) {
+    DIR *dir = opendir(local_dir);
+    if (!dir) {
         return false;
     }
 
-    LIBSSH2_SFTP *sftp = (LIBSSH2_SFTP*)conn->sftp_session;
-    int rc = libssh2_sftp_rename(sftp, old_path, new_path);
-    return rc == 0;
+    // The folder may exist already; a real failure shows up in its files
+    sftp_simple(conn, NET_OP_MKDIR, remote_dir, NULL);
+
+    bool success = true;
+    struct dirent *ent;
+    while (success && (ent = readdir(dir)) != NULL) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+            continue;
+        }
+
+        char local_path[PATH_MAX_LEN];
+        char remote_path[NETWORK_PATH_MAX];
+        int local_len = snprintf(local_path, sizeof(local_path), "%s/%s", local_dir, ent->d_name);
+        int remote_len = snprintf(remote_path, sizeof(remote_path), "%s/%s",
+                                  strcmp(remote_dir, "/") == 0 ? "" : remote_dir, ent->d_name);
+        if (local_len >= (int)sizeof(local_path) || remote_len >= (int)sizeof(remote_path)) {
+            success = false;
+            break;
+        }
+
+        // Symlinks and special files are left out
+        struct stat st;
+        if (lstat(local_path, &st) != 0) {
+            success = false;
+        } else if (S_ISDIR(st.st_mode)) {
+            success = sftp_sync_directory(conn, local_path, remote_path, control);
+        } else if (S_ISREG(st.st_mode)) {
+            success = sftp_sync_file(conn, local_path, remote_path, control);
+        }
+        success = success && sftp_checkpoint(control);
+    }
+
+    closedir(dir);
+    return success;
 }
 
-// SMB stubs - would need samba/libsmbclient implementation
+bool sftp_mkdir(NetworkConnection *conn, const char *path)
+{
+    return sftp_simple(conn, NET_OP_MKDIR, path, NULL);
+}
 
-bool smb_connect(NetworkConnection *conn)
+bool sftp_rmdir(NetworkConnection *conn, const char *path)
 {
-    strncpy(conn->error_message, "SMB support not yet implemented", sizeof(conn->error_message) - 1);
-    return false;
+    return sftp_simple(conn, NET_OP_RMDIR, path, NULL);
 }
 
-void smb_disconnect(NetworkConnection *conn)
+bool sftp_unlink(NetworkConnection *conn, const char *path)
 {
-    (void)conn;
+    return sftp_simple(conn, NET_OP_UNLINK, path, NULL);
 }
 
-bool smb_read_directory(NetworkConnection *conn, const char *path, DirectoryState *dir)
+bool sftp_rename(NetworkConnection *conn, const char *old_path, const char *new_path)
 {
-    (void)conn;
-    (void)path;
-    (void)dir;
-    return false;
+    return sftp_simple(conn, NET_OP_RENAME, old_path, new_path);
 }
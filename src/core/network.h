@@ -2,8 +2,10 @@
 #define NETWORK_H
 
 #include "filesystem.h"
+#include "operations.h"
 #include <stdbool.h>
 #include <stdint.h>
+#include <sys/socket.h>
 
 #define MAX_CONNECTIONS 16
 #define MAX_SAVED_PROFILES 32
@@ -12,6 +14,72 @@
 #define NETWORK_PASS_MAX 256
 #define NETWORK_PATH_MAX 512
 
+// Parallel streams a large SFTP transfer is split across, each on its own connection
+#define SFTP_DEFAULT_STREAMS 4
+#define SFTP_MAX_STREAMS 8
+
+// Bytes a remote preview reads from the start of a file
+#define NETWORK_PREVIEW_BYTES (64 * 1024)
+
+// Largest remote image a preview reads whole when it has no embedded thumbnail
+#define NETWORK_IMAGE_PREVIEW_MAX (64ULL * 1024 * 1024)
+
+// Hex SHA-256 as printed by sha256sum, and the most quoted paths one remote hash
+// command carries
+#define NETWORK_HASH_HEX 64
+#define NETWORK_HASH_COMMAND_MAX (64 * 1024)
+
+// SSH transport tuning. Unless a profile says otherwise, compression is on for links
+// farther than NETWORK_COMPRESS_RTT seconds or, once a transfer has measured it, slower
+// than NETWORK_COMPRESS_THROUGHPUT bytes a second, where zlib costs less than the bytes
+// it saves. AEAD ciphers the CPU runs in hardware are preferred
+#define NETWORK_COMPRESS_RTT 0.015
+#define NETWORK_COMPRESS_THROUGHPUT (8.0 * 1024 * 1024)
+#define NETWORK_CIPHERS "aes128-gcm@openssh.com,aes256-gcm@openssh.com,chacha20-poly1305@openssh.com," \
+                        "aes128-ctr,aes256-ctr"
+#define NETWORK_CIPHERS_MAX 256
+
+// Transfers at least this large measure a connection's throughput
+#define NETWORK_MEASURE_MIN_BYTES (1024 * 1024)
+
+// Ranges of one read fetched at once, each its own request on the network thread
+#define NETWORK_RANGE_REQUESTS 8
+
+// Remote listings are cached per connection for NETWORK_LISTING_TTL seconds, or until
+// one of our own changes touches them
+#define NETWORK_LISTING_TTL 30.0
+#define NETWORK_LISTING_BUDGET (8 * 1024 * 1024)
+
+// Subdirectories of an opened remote folder listed ahead in the background
+#define NETWORK_PREFETCH_CHILDREN 16
+
+// Idle SSH sessions send a keepalive this often (seconds), and the socket's TCP
+// keepalive gives up on a silent peer after about as long again
+#define NETWORK_KEEPALIVE_INTERVAL 15
+
+// After a gap this long between network_update calls (the machine slept, or the app sat
+// idle) each SFTP session is checked with a round trip, and taken as lost when none
+// comes back within NETWORK_PROBE_TIMEOUT seconds
+#define NETWORK_WAKE_GAP 30.0
+#define NETWORK_PROBE_TIMEOUT 3.0
+
+// Blocking calls while shutting a session down give up after this long, so a dead link
+// cannot hang a disconnect
+#define NETWORK_SHUTDOWN_TIMEOUT_MS 2000
+
+// Cached listings and their prefetches (private to network.c)
+struct RemoteListings;
+
+// Session being built in the background to replace a lost one (private to network.c)
+struct NetworkReconnect;
+
+// Network thread driving a connection's session, and its requests (network_io.h)
+struct NetworkIO;
+struct NetworkRequest;
+
+// Byte-range cache of remote files on local disk (remote_blocks.h)
+struct RemoteBlocks;
+
 // Connection types
 typedef enum {
     CONN_TYPE_NONE = 0,
@@ -33,9 +101,17 @@ typedef enum {
     AUTH_NONE,
     AUTH_PASSWORD,
     AUTH_PUBLICKEY,
-    AUTH_KEYBOARD_INTERACTIVE
+    AUTH_KEYBOARD_INTERACTIVE,
+    AUTH_AGENT
 } AuthMethod;
 
+// SSH transport compression of a profile
+typedef enum {
+    SSH_COMPRESSION_AUTO,                   // Chosen from the link (NETWORK_COMPRESS_*)
+    SSH_COMPRESSION_ON,
+    SSH_COMPRESSION_OFF
+} SshCompression;
+
 // Saved connection profile
 typedef struct ConnectionProfile {
     char name[64];                          // Display name
@@ -48,6 +124,8 @@ typedef struct ConnectionProfile {
     char remote_path[NETWORK_PATH_MAX];     // Initial path
     bool save_password;                     // Whether to save password
     bool auto_connect;                      // Connect on startup
+    SshCompression compression;             // SFTP transport compression
+    char ciphers[NETWORK_CIPHERS_MAX];      // SFTP ciphers, most preferred first ("": NETWORK_CIPHERS)
 } ConnectionProfile;
 
 // Active connection
@@ -63,9 +141,27 @@ typedef struct NetworkConnection {
     void *sftp_session;                     // LIBSSH2_SFTP*
     int socket;
 
-    // Reconnect state
+    struct NetworkIO *io;                   // Runs every SFTP call on the session
+
+    // SMB session (opaque pointer, smb.c)
+    void *smb_session;
+    struct RemoteListings *listings;        // Created on the first directory read
+
+    // Reconnect state. A lost SFTP session is rebuilt in the background (network_update)
+    // while the listing cache and current path stay; what the last connect learned
+    // makes the next one quicker
     int reconnect_attempts;
     double last_activity;
+    struct NetworkReconnect *reconnect;     // Reconnect in progress, or NULL
+    double retry_at;                        // When a failed reconnect is tried again
+    struct NetworkRequest *probe;           // Round trip checking the session after a gap
+    double probe_sent;
+    AuthMethod auth_method;                 // Method that worked, tried first (AUTH_NONE: all)
+    struct sockaddr_storage address;        // Address that answered, reused without a lookup
+    socklen_t address_len;                  // 0 until connected once
+    double link_rtt;                        // Seconds the last TCP connect took (0: unknown)
+    double link_throughput;                 // Bytes a second of uncompressed transfers (0: unknown)
+    bool compressed;                        // The session negotiated compression
 } NetworkConnection;
 
 // Network manager state
@@ -77,6 +173,9 @@ typedef struct NetworkManager {
     ConnectionProfile saved_profiles[MAX_SAVED_PROFILES];
     int profile_count;
 
+    struct RemoteBlocks *blocks;            // Shared by every connection's ranged reads (NULL: none)
+
+    double last_update;                     // Wall clock at the last network_update
     bool initialized;
 } NetworkManager;
 
@@ -92,10 +191,18 @@ bool network_remove_profile(NetworkManager *mgr, int index);
 bool network_update_profile(NetworkManager *mgr, int index, const ConnectionProfile *profile);
 ConnectionProfile* network_get_profile(NetworkManager *mgr, int index);
 
-// Connection management
+// Connection management. Connecting to a server (type, host, port and user) that
+// already has a live connection returns that connection rather than opening another.
+// Reconnecting keeps the cached listings and current path
 int network_connect(NetworkManager *mgr, const ConnectionProfile *profile);
 bool network_disconnect(NetworkManager *mgr, int conn_id);
 bool network_reconnect(NetworkManager *mgr, int conn_id);
+
+// Call once per frame: checks sessions after a gap in updates, starts background
+// reconnects of lost SFTP sessions (retried a few times, further apart each time) and
+// swaps in the ones that finished. Meanwhile reconnecting connections serve
+// listings from their cache. Returns true if a connection's status changed
+bool network_update(NetworkManager *mgr);
 NetworkConnection* network_get_connection(NetworkManager *mgr, int conn_id);
 ConnectionStatus network_get_status(NetworkManager *mgr, int conn_id);
 const char* network_get_error(NetworkManager *mgr, int conn_id);
@@ -105,18 +212,106 @@ void network_set_active(NetworkManager *mgr, int conn_id);
 int network_get_active(NetworkManager *mgr);
 bool network_is_remote_active(NetworkManager *mgr);
 
-// Remote directory operations
+// Remote directory operations. Listings come from the connection's cache while fresh,
+// and opening a folder lists its subfolders ahead in the background
 bool network_read_directory(NetworkManager *mgr, int conn_id, const char *path, DirectoryState *dir);
 bool network_change_directory(NetworkManager *mgr, int conn_id, const char *path);
 bool network_make_directory(NetworkManager *mgr, int conn_id, const char *path);
 bool network_remove_directory(NetworkManager *mgr, int conn_id, const char *path);
 
-// Remote file operations
-bool network_download_file(NetworkManager *mgr, int conn_id, const char *remote_path, const char *local_path);
-bool network_upload_file(NetworkManager *mgr, int conn_id, const char *local_path, const char *remote_path);
+// Drop the cached listing of path and everything below it, so the next read goes to
+// the server (our own changes do this themselves)
+void network_invalidate_directory(NetworkManager *mgr, int conn_id, const char *path);
+
+// Queue a request (network_io.h) on the connection's network thread without waiting;
+// poll network_request_is_complete for the result. Changes drop the cached listings
+// they touch when queued. False, with req completed and not ok, if the connection is
+// not up
+bool network_submit(NetworkManager *mgr, int conn_id, struct NetworkRequest *req);
+
+// Read length bytes at offset of a remote file into buf, through the block cache on
+// local disk: only blocks no earlier read or preview fetched go over the link, each
+// missing run as its own ranged read. The file's size and mtime come from its cached
+// listing when there is one, so call it from the thread that browses the connection.
+// Returns the bytes read (short at the end of the file), or -1 on error. SFTP only
+int64_t network_read_range(NetworkManager *mgr, int conn_id, const char *path, uint64_t offset,
+                           void *buf, size_t length);
+
+// Preview bytes of a remote image, read like network_read_range: the EXIF thumbnail
+// embedded in a JPEG's first block when it has one (*thumbnail set), else the whole
+// file up to NETWORK_IMAGE_PREVIEW_MAX. malloc'd into *data; false on error
+bool network_read_image_preview(NetworkManager *mgr, int conn_id, const char *path,
+                                unsigned char **data, size_t *size, bool *thumbnail);
+
+// Where the EXIF thumbnail lies in JPEG data (offset and length within data); false if
+// there is none, or it does not lie wholly in data
+bool network_jpeg_thumbnail(const unsigned char *data, size_t size, size_t *offset, size_t *length);
+
+// Remote file operations. Downloads of files the block cache holds whole are copied
+// from it. Transfers report bytes into control and honor its pause and
+// cancel between buffers, like a local copy in the operation queue; control may be NULL
+bool network_download_file(NetworkManager *mgr, int conn_id, const char *remote_path, const char *local_path,
+                           CopyControl *control);
+bool network_upload_file(NetworkManager *mgr, int conn_id, const char *local_path, const char *remote_path,
+                         CopyControl *control);
 bool network_delete_file(NetworkManager *mgr, int conn_id, const char *path);
 bool network_rename_file(NetworkManager *mgr, int conn_id, const char *old_path, const char *new_path);
 
+// Copy source to dest (files or folders) on the server itself with cp over an SSH exec
+// channel, so nothing is sent back and forth over the link
+bool network_copy_remote(NetworkManager *mgr, int conn_id, const char *source, const char *dest);
+
+// Server-side helpers: shell pipelines run over an SSH exec channel, so only their
+// compact results cross the link instead of the files themselves. They need a POSIX
+// shell with find (GNU or BSD); each fails on a server without what it needs, and
+// callers fall back to listings and ranged reads
+
+// One entry of a recursive remote listing
+typedef struct RemoteWalkEntry {
+    const char *path;                       // Relative to the walked folder
+    uint64_t size;
+    int64_t mtime;
+    bool is_directory;
+} RemoteWalkEntry;
+
+// Called for each entry of a walk; false stops it
+typedef bool (*RemoteWalkFn)(void *context, const RemoteWalkEntry *entry);
+
+// List everything under path (not path itself) on the server, streaming the listing
+// through a temporary file however large it is. Entries whose names hold a newline are
+// skipped. False if the server could not list path or fn stopped the walk
+bool network_remote_walk(NetworkManager *mgr, int conn_id, const char *path, RemoteWalkFn fn, void *context);
+
+// Total size and file count of everything under path, from a walk
+bool network_remote_folder_size(NetworkManager *mgr, int conn_id, const char *path,
+                                uint64_t *bytes, uint64_t *files);
+
+// Hex SHA-256 of each of count remote files, hashed on the server (sha256sum or shasum)
+// in batches; a file that could not be hashed gets an empty string
+bool network_remote_hashes(NetworkManager *mgr, int conn_id, const char *const *paths, int count,
+                           char (*hashes)[NETWORK_HASH_HEX + 1]);
+
+// JPEG thumbnail of a remote image, at most max_size pixels on its long side, made on
+// the server by ImageMagick or sips. malloc'd into *data; false if the server has
+// neither, or could not read the image
+bool network_remote_thumbnail(NetworkManager *mgr, int conn_id, const char *path, int max_size,
+                              unsigned char **data, size_t *size);
+
+// Bring a remote file up to date with a local one, sending only what changed. A file
+// with the same size and mtime is skipped; an existing large one is compared block by
+// block against hashes taken on the server and only differing blocks are written.
+// Anything else, or a server that cannot hash, gets the whole file
+bool network_sync_file(NetworkManager *mgr, int conn_id, const char *local_path, const char *remote_path,
+                       CopyControl *control);
+
+// Sync a local folder tree into remote_dir the same way, creating folders as needed
+bool network_sync_directory(NetworkManager *mgr, int conn_id, const char *local_dir, const char *remote_dir,
+                            CopyControl *control);
+
+// Streams (1..SFTP_MAX_STREAMS) large transfers are split across; 1 disables parallel
+// segments
+void network_set_transfer_streams(int streams);
+
 // Utility functions
 const char* network_connection_type_name(ConnectionType type);
 const char* network_status_name(ConnectionStatus status);
@@ -126,16 +321,33 @@ bool network_validate_profile(const ConnectionProfile *profile, char *error, siz
 bool sftp_connect(NetworkConnection *conn);
 void sftp_disconnect(NetworkConnection *conn);
 bool sftp_read_directory(NetworkConnection *conn, const char *path, DirectoryState *dir);
-bool sftp_download(NetworkConnection *conn, const char *remote, const char *local);
-bool sftp_upload(NetworkConnection *conn, const char *local, const char *remote);
+bool sftp_download(NetworkConnection *conn, const char *remote, const char *local, CopyControl *control);
+bool sftp_upload(NetworkConnection *conn, const char *local, const char *remote, CopyControl *control);
 bool sftp_mkdir(NetworkConnection *conn, const char *path);
 bool sftp_rmdir(NetworkConnection *conn, const char *path);
 bool sftp_unlink(NetworkConnection *conn, const char *path);
 bool sftp_rename(NetworkConnection *conn, const char *old_path, const char *new_path);
+bool sftp_copy_remote(NetworkConnection *conn, const char *source, const char *dest);
+bool sftp_remote_walk(NetworkConnection *conn, const char *path, RemoteWalkFn fn, void *context);
+bool sftp_remote_hashes(NetworkConnection *conn, const char *const *paths, int count,
+                        char (*hashes)[NETWORK_HASH_HEX + 1]);
+bool sftp_remote_thumbnail(NetworkConnection *conn, const char *path, int max_size,
+                           unsigned char **data, size_t *size);
+bool sftp_sync_file(NetworkConnection *conn, const char *local, const char *remote, CopyControl *control);
+bool sftp_sync_directory(NetworkConnection *conn, const char *local_dir, const char *remote_dir,
+                         CopyControl *control);
 
-// SMB-specific functions (stub for now)
+// SMB-specific functions (smb.c, through libsmb2). An SMB connection is to one share,
+// named by the first component of the profile's remote_path; its paths are
+// "/share/folder/file". Without FINDER_PLUS_LIBSMB2 every call fails
 bool smb_connect(NetworkConnection *conn);
 void smb_disconnect(NetworkConnection *conn);
 bool smb_read_directory(NetworkConnection *conn, const char *path, DirectoryState *dir);
+bool smb_download(NetworkConnection *conn, const char *remote, const char *local, CopyControl *control);
+bool smb_upload(NetworkConnection *conn, const char *local, const char *remote, CopyControl *control);
+bool smb_mkdir(NetworkConnection *conn, const char *path);
+bool smb_rmdir(NetworkConnection *conn, const char *path);
+bool smb_unlink(NetworkConnection *conn, const char *path);
+bool smb_rename(NetworkConnection *conn, const char *old_path, const char *new_path);
 
 #endif // NETWORK_H
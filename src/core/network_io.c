@@ -0,0 +1,798 @@
+#include "network_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <libssh2.h>
+#include <libssh2_sftp.h>
+
+// Where a request is: handle-based requests open, run, then close
+enum {
+    NET_STAGE_OPEN,
+    NET_STAGE_EXEC,     // Exec channel open, command not yet started
+    NET_STAGE_RUN,
+    NET_STAGE_CLOSE,
+    NET_STAGE_CLOSED    // Exec channel closed our end, waiting on the server's
+};
+
+// Outcome of stepping a request once
+typedef enum NetStep {
+    NET_STEP_AGAIN,     // Waiting on the socket (or paused)
+    NET_STEP_PROGRESS,  // Moved forward; step again soon
+    NET_STEP_DONE       // Finished, ok or not
+} NetStep;
+
+struct NetworkIO {
+    LIBSSH2_SESSION *session;
+    LIBSSH2_SFTP *sftp;
+    int socket;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t done_cond;           // A request completed
+    int wake[2];                        // Pipe that wakes the thread from poll
+    bool stopping;
+    atomic_bool lost;                   // The session is dead; requests fail at once
+    NetworkRequest *submitted;          // Oldest first, taken by the thread
+    NetworkRequest **submitted_tail;
+
+    NetworkRequest *active;             // Being stepped (network thread only)
+};
+
+// Helper: Mark req complete and wake its waiters
+static void complete_request(NetworkIO *io, NetworkRequest *req)
+{
+    free(req->buffer);
+    req->buffer = NULL;
+
+    pthread_mutex_lock(&io->mutex);
+    atomic_store(&req->completed, true);
+    pthread_cond_broadcast(&io->done_cond);
+    pthread_mutex_unlock(&io->mutex);
+}
+
+// Helper: Whether a libssh2 error means the connection itself is gone
+static bool session_error(int rc)
+{
+    return rc == LIBSSH2_ERROR_SOCKET_SEND || rc == LIBSSH2_ERROR_SOCKET_RECV ||
+           rc == LIBSSH2_ERROR_SOCKET_DISCONNECT || rc == LIBSSH2_ERROR_SOCKET_TIMEOUT ||
+           rc == LIBSSH2_ERROR_TIMEOUT;
+}
+
+// Helper: Record a failed libssh2 call on req, and a dead session on io
+static void fail_request(NetworkIO *io, NetworkRequest *req, int rc)
+{
+    req->ok = false;
+    req->error = rc < 0 ? rc : libssh2_session_last_errno(io->session);
+    if (session_error(req->error)) {
+        atomic_store(&io->lost, true);
+    }
+}
+
+// Helper: Requests without a handle are one call, repeated until it stops asking to wait
+static NetStep step_call(NetworkIO *io, NetworkRequest *req)
+{
+    int rc = 0;
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+
+    switch (req->op) {
+        case NET_OP_STAT:
+            rc = libssh2_sftp_stat(io->sftp, req->path, &attrs);
+            if (rc == 0) {
+                req->size = (attrs.flags & LIBSSH2_SFTP_ATTR_SIZE) ? attrs.filesize : UINT64_MAX;
+                req->mtime = (attrs.flags & LIBSSH2_SFTP_ATTR_ACMODTIME) ? (int64_t)attrs.mtime : 0;
+            }
+            break;
+        case NET_OP_SETSTAT:
+            memset(&attrs, 0, sizeof(attrs));
+            if (req->size != UINT64_MAX) {
+                attrs.flags |= LIBSSH2_SFTP_ATTR_SIZE;
+                attrs.filesize = req->size;
+            }
+            if (req->mtime != 0) {
+                attrs.flags |= LIBSSH2_SFTP_ATTR_ACMODTIME;
+                attrs.atime = (unsigned long)req->mtime;
+                attrs.mtime = (unsigned long)req->mtime;
+            }
+            rc = libssh2_sftp_setstat(io->sftp, req->path, &attrs);
+            break;
+        case NET_OP_MKDIR:
+            rc = libssh2_sftp_mkdir(io->sftp, req->path,
+                                    LIBSSH2_SFTP_S_IRWXU |
+                                    LIBSSH2_SFTP_S_IRGRP | LIBSSH2_SFTP_S_IXGRP |
+                                    LIBSSH2_SFTP_S_IROTH | LIBSSH2_SFTP_S_IXOTH);
+            break;
+        case NET_OP_RMDIR:
+            rc = libssh2_sftp_rmdir(io->sftp, req->path);
+            break;
+        case NET_OP_UNLINK:
+            rc = libssh2_sftp_unlink(io->sftp, req->path);
+            break;
+        case NET_OP_RENAME:
+            rc = libssh2_sftp_rename(io->sftp, req->path, req->target);
+            break;
+        default:
+            break;
+    }
+
+    if (rc == LIBSSH2_ERROR_EAGAIN) {
+        return NET_STEP_AGAIN;
+    }
+    req->ok = rc == 0;
+    if (rc != 0) {
+        fail_request(io, req, rc);
+    }
+    return NET_STEP_DONE;
+}
+
+// Helper: Open the handle of a list, read, write or create request
+static NetStep step_open(NetworkIO *io, NetworkRequest *req)
+{
+    LIBSSH2_SFTP_HANDLE *handle = NULL;
+    switch (req->op) {
+        case NET_OP_LIST:
+            handle = libssh2_sftp_opendir(io->sftp, req->path);
+            break;
+        case NET_OP_READ:
+            handle = libssh2_sftp_open(io->sftp, req->path, LIBSSH2_FXF_READ, 0);
+            break;
+        case NET_OP_WRITE:
+            handle = libssh2_sftp_open(io->sftp, req->path, LIBSSH2_FXF_WRITE, 0);
+            break;
+        case NET_OP_CREATE:
+            handle = libssh2_sftp_open(io->sftp, req->path,
+                                       LIBSSH2_FXF_WRITE | LIBSSH2_FXF_CREAT | LIBSSH2_FXF_TRUNC,
+                                       LIBSSH2_SFTP_S_IRUSR | LIBSSH2_SFTP_S_IWUSR |
+                                       LIBSSH2_SFTP_S_IRGRP | LIBSSH2_SFTP_S_IROTH);
+            break;
+        default:
+            break;
+    }
+
+    if (!handle) {
+        if (libssh2_session_last_errno(io->session) == LIBSSH2_ERROR_EAGAIN) {
+            return NET_STEP_AGAIN;
+        }
+        fail_request(io, req, 0);
+        return NET_STEP_DONE;
+    }
+
+    req->handle = handle;
+    req->stage = NET_STAGE_RUN;
+    if (req->op == NET_OP_LIST) {
+        strncpy(req->listing.current_path, req->path, PATH_MAX_LEN - 1);
+    } else if (req->op == NET_OP_READ || req->op == NET_OP_WRITE) {
+        // A short range (a preview's block) needs no more buffer than its length
+        libssh2_sftp_seek64(handle, req->offset);
+        size_t buffer_size = req->length < SFTP_TRANSFER_BUFFER ? (size_t)req->length : SFTP_TRANSFER_BUFFER;
+        req->buffer = malloc(buffer_size > 0 ? buffer_size : 1);
+        if (!req->buffer) {
+            req->ok = false;
+            req->stage = NET_STAGE_CLOSE;
+        }
+    }
+    return NET_STEP_PROGRESS;
+}
+
+// Helper: Open the exec channel, then start the command on it
+static NetStep step_exec_open(NetworkIO *io, NetworkRequest *req)
+{
+    if (req->stage == NET_STAGE_OPEN) {
+        LIBSSH2_CHANNEL *channel = libssh2_channel_open_session(io->session);
+        if (!channel) {
+            if (libssh2_session_last_errno(io->session) == LIBSSH2_ERROR_EAGAIN) {
+                return NET_STEP_AGAIN;
+            }
+            fail_request(io, req, 0);
+            return NET_STEP_DONE;
+        }
+        req->handle = channel;
+        req->stage = NET_STAGE_EXEC;
+        return NET_STEP_PROGRESS;
+    }
+
+    int rc = libssh2_channel_exec((LIBSSH2_CHANNEL *)req->handle, req->command);
+    if (rc == LIBSSH2_ERROR_EAGAIN) {
+        return NET_STEP_AGAIN;
+    }
+    if (rc != 0) {
+        fail_request(io, req, rc);
+        req->stage = NET_STAGE_CLOSE;
+        return NET_STEP_PROGRESS;
+    }
+    req->stage = NET_STAGE_RUN;
+    return NET_STEP_PROGRESS;
+}
+
+// Helper: Collect the command's output (or write it to fd) until it closes its end.
+// Standard error is read and dropped so a chatty command cannot stall on a full window
+static NetStep step_exec_read(NetworkIO *io, NetworkRequest *req)
+{
+    LIBSSH2_CHANNEL *channel = (LIBSSH2_CHANNEL *)req->handle;
+    char chunk[16384];
+
+    ssize_t nerr = libssh2_channel_read_stderr(channel, chunk, sizeof(chunk));
+    ssize_t nread = libssh2_channel_read(channel, chunk, sizeof(chunk));
+
+    if (nread > 0 && req->fd >= 0) {
+        // Streamed to a file, however long it runs
+        for (ssize_t written = 0; written < nread; ) {
+            ssize_t n = write(req->fd, chunk + written, (size_t)(nread - written));
+            if (n < 0) {
+                req->stage = NET_STAGE_CLOSE;
+                return NET_STEP_PROGRESS;
+            }
+            written += n;
+        }
+        req->output_len += (size_t)nread;
+        return NET_STEP_PROGRESS;
+    }
+    if (nread > 0) {
+        if (req->output_len + (size_t)nread > NETWORK_EXEC_OUTPUT_MAX) {
+            req->stage = NET_STAGE_CLOSE;
+            req->error = LIBSSH2_ERROR_BUFFER_TOO_SMALL;
+            return NET_STEP_PROGRESS;
+        }
+        char *grown = realloc(req->output, req->output_len + (size_t)nread + 1);
+        if (!grown) {
+            req->stage = NET_STAGE_CLOSE;
+            return NET_STEP_PROGRESS;
+        }
+        req->output = grown;
+        memcpy(req->output + req->output_len, chunk, (size_t)nread);
+        req->output_len += (size_t)nread;
+        req->output[req->output_len] = '\0';
+        return NET_STEP_PROGRESS;
+    }
+    if (nread < 0 && nread != LIBSSH2_ERROR_EAGAIN) {
+        fail_request(io, req, (int)nread);
+        req->stage = NET_STAGE_CLOSE;
+        return NET_STEP_PROGRESS;
+    }
+    if (!libssh2_channel_eof(channel)) {
+        return nerr > 0 ? NET_STEP_PROGRESS : NET_STEP_AGAIN;
+    }
+
+    // The command closed its output
+    req->stage = NET_STAGE_CLOSE;
+    req->ok = true;
+    return NET_STEP_PROGRESS;
+}
+
+// Helper: Close the exec channel, and once the server has closed its end (the exit
+// status arrives before that) take the command's exit status
+static NetStep step_exec_close(NetworkIO *io, NetworkRequest *req)
+{
+    LIBSSH2_CHANNEL *channel = (LIBSSH2_CHANNEL *)req->handle;
+
+    if (req->stage == NET_STAGE_CLOSE) {
+        int rc = libssh2_channel_close(channel);
+        if (rc == LIBSSH2_ERROR_EAGAIN) {
+            return NET_STEP_AGAIN;
+        }
+        req->stage = NET_STAGE_CLOSED;
+        if (rc != 0) {
+            // Nothing more will come; free it as it is
+            libssh2_channel_free(channel);
+            req->handle = NULL;
+            if (req->ok) {
+                fail_request(io, req, rc);
+            }
+            return NET_STEP_DONE;
+        }
+        return NET_STEP_PROGRESS;
+    }
+
+    int rc = libssh2_channel_wait_closed(channel);
+    if (rc == LIBSSH2_ERROR_EAGAIN) {
+        return NET_STEP_AGAIN;
+    }
+    req->exit_status = libssh2_channel_get_exit_status(channel);
+    if (libssh2_channel_free(channel) == LIBSSH2_ERROR_EAGAIN) {
+        return NET_STEP_AGAIN;
+    }
+    req->handle = NULL;
+
+    if (req->ok && req->exit_status != 0) {
+        req->ok = false;
+        req->error = 0;
+    }
+    return NET_STEP_DONE;
+}
+
+// Helper: Go on to closing the handle with the given outcome
+static NetStep finish_run(NetworkRequest *req, bool ok)
+{
+    req->ok = ok;
+    req->stage = NET_STAGE_CLOSE;
+    return NET_STEP_PROGRESS;
+}
+
+// Helper: Read one directory entry into the listing
+static NetStep step_list(NetworkIO *io, NetworkRequest *req)
+{
+    char filename[512];
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+
+    int rc = libssh2_sftp_readdir((LIBSSH2_SFTP_HANDLE *)req->handle, filename, sizeof(filename), &attrs);
+    if (rc == LIBSSH2_ERROR_EAGAIN) {
+        return NET_STEP_AGAIN;
+    }
+    if (rc < 0) {
+        fail_request(io, req, rc);
+        return finish_run(req, false);
+    }
+    if (rc == 0) {
+        // Directories first, then alphabetical by name
+        directory_sort(&req->listing, SORT_BY_NAME, true);
+        return finish_run(req, true);
+    }
+
+    // Skip . and ..
+    if (strcmp(filename, ".") == 0 || strcmp(filename, "..") == 0) {
+        return NET_STEP_PROGRESS;
+    }
+
+    // Append entry (name and extension go into the directory's arena,
+    // the full path is derived from current_path on demand)
+    FileEntry *entry = directory_append_entry(&req->listing, filename);
+    if (!entry) {
+        return finish_run(req, false);
+    }
+
+    entry->is_directory = LIBSSH2_SFTP_S_ISDIR(attrs.permissions);
+    entry->is_hidden = (filename[0] == '.');
+    entry->is_symlink = LIBSSH2_SFTP_S_ISLNK(attrs.permissions);
+    entry->size = (off_t)attrs.filesize;
+    entry->modified = (time_t)attrs.mtime;
+    entry->created = (time_t)attrs.mtime;
+    entry->permissions = (mode_t)attrs.permissions;
+    return NET_STEP_PROGRESS;
+}
+
+// Helper: Between buffers, stop for a cancel and hold for a pause. Returns NET_STEP_DONE
+// to go on, anything else to return from the step
+static NetStep transfer_checkpoint(NetworkRequest *req)
+{
+    if (req->control == NULL) {
+        return NET_STEP_DONE;
+    }
+    if (atomic_load(&req->control->cancel)) {
+        return finish_run(req, false);
+    }
+    if (atomic_load(&req->control->pause)) {
+        return NET_STEP_AGAIN;
+    }
+    return NET_STEP_DONE;
+}
+
+// Helper: Count bytes moved by a transfer
+static void transfer_progress(NetworkRequest *req, size_t bytes)
+{
+    req->done += bytes;
+    if (req->control != NULL) {
+        atomic_fetch_add(&req->control->bytes_done, (long long)bytes);
+    }
+}
+
+// Helper: Read the next buffer of the range into the local file
+static NetStep step_read(NetworkIO *io, NetworkRequest *req)
+{
+    if (req->chunk_len == 0) {
+        NetStep check = transfer_checkpoint(req);
+        if (check != NET_STEP_DONE) {
+            return check;
+        }
+        uint64_t left = req->length - req->done;
+        if (left == 0) {
+            return finish_run(req, true);
+        }
+        req->chunk_len = left < SFTP_TRANSFER_BUFFER ? (size_t)left : SFTP_TRANSFER_BUFFER;
+    }
+
+    // After EAGAIN libssh2 must be called again with the same length
+    ssize_t nread = libssh2_sftp_read((LIBSSH2_SFTP_HANDLE *)req->handle, req->buffer, req->chunk_len);
+    if (nread == LIBSSH2_ERROR_EAGAIN) {
+        return NET_STEP_AGAIN;
+    }
+    req->chunk_len = 0;
+    if (nread < 0) {
+        fail_request(io, req, (int)nread);
+        return finish_run(req, false);
+    }
+    if (nread == 0) {
+        return finish_run(req, true);
+    }
+
+    off_t at = (off_t)(req->offset + req->done);
+    size_t written = 0;
+    while (written < (size_t)nread) {
+        ssize_t n = pwrite(req->fd, req->buffer + written, (size_t)nread - written, at + (off_t)written);
+        if (n <= 0) {
+            return finish_run(req, false);
+        }
+        written += (size_t)n;
+    }
+
+    transfer_progress(req, written);
+    return NET_STEP_PROGRESS;
+}
+
+// Helper: Send the next piece of the range from the local file
+static NetStep step_write(NetworkIO *io, NetworkRequest *req)
+{
+    if (req->chunk_len == 0) {
+        NetStep check = transfer_checkpoint(req);
+        if (check != NET_STEP_DONE) {
+            return check;
+        }
+        uint64_t left = req->length - req->done;
+        size_t want = left < SFTP_TRANSFER_BUFFER ? (size_t)left : SFTP_TRANSFER_BUFFER;
+        if (want == 0) {
+            return finish_run(req, true);
+        }
+        ssize_t nread = pread(req->fd, req->buffer, want, (off_t)(req->offset + req->done));
+        if (nread < 0) {
+            return finish_run(req, false);
+        }
+        if (nread == 0) {
+            return finish_run(req, true);
+        }
+        req->chunk_len = (size_t)nread;
+        req->chunk_sent = 0;
+    }
+
+    // A write returns once part of the buffer is acknowledged; the rest goes next step
+    ssize_t nwritten = libssh2_sftp_write((LIBSSH2_SFTP_HANDLE *)req->handle,
+                                          req->buffer + req->chunk_sent, req->chunk_len - req->chunk_sent);
+    if (nwritten == LIBSSH2_ERROR_EAGAIN) {
+        return NET_STEP_AGAIN;
+    }
+    if (nwritten <= 0) {
+        fail_request(io, req, (int)nwritten);
+        return finish_run(req, false);
+    }
+
+    req->chunk_sent += (size_t)nwritten;
+    if (req->chunk_sent == req->chunk_len) {
+        req->chunk_len = 0;
+    }
+    transfer_progress(req, (size_t)nwritten);
+    return NET_STEP_PROGRESS;
+}
+
+// Helper: Close the handle; closing flushes the writes still in flight
+static NetStep step_close(NetworkIO *io, NetworkRequest *req)
+{
+    LIBSSH2_SFTP_HANDLE *handle = (LIBSSH2_SFTP_HANDLE *)req->handle;
+    int rc = req->op == NET_OP_LIST ? libssh2_sftp_closedir(handle) : libssh2_sftp_close(handle);
+    if (rc == LIBSSH2_ERROR_EAGAIN) {
+        return NET_STEP_AGAIN;
+    }
+
+    req->handle = NULL;
+    if (rc != 0 && req->ok) {
+        fail_request(io, req, rc);
+    }
+    return NET_STEP_DONE;
+}
+
+// Helper: Advance req as far as the socket allows without blocking
+static NetStep step_request(NetworkIO *io, NetworkRequest *req)
+{
+    if (req->op == NET_OP_EXEC) {
+        switch (req->stage) {
+            case NET_STAGE_OPEN:
+            case NET_STAGE_EXEC: return step_exec_open(io, req);
+            case NET_STAGE_RUN:  return step_exec_read(io, req);
+            default:             return step_exec_close(io, req);
+        }
+    }
+
+    if (req->op != NET_OP_LIST && req->op != NET_OP_READ &&
+        req->op != NET_OP_WRITE && req->op != NET_OP_CREATE) {
+        return step_call(io, req);
+    }
+
+    switch (req->stage) {
+        case NET_STAGE_OPEN:
+            return step_open(io, req);
+        case NET_STAGE_RUN:
+            switch (req->op) {
+                case NET_OP_LIST:  return step_list(io, req);
+                case NET_OP_READ:  return step_read(io, req);
+                case NET_OP_WRITE: return step_write(io, req);
+                default:           return finish_run(req, true);
+            }
+        default:
+            return step_close(io, req);
+    }
+}
+
+// Helper: Send a keepalive when one is due; returns seconds until the next. A send that
+// fails marks the session lost
+static int send_keepalive(NetworkIO *io)
+{
+    int next = NETWORK_KEEPALIVE_INTERVAL;
+    int rc = libssh2_keepalive_send(io->session, &next);
+    if (rc != 0 && rc != LIBSSH2_ERROR_EAGAIN && session_error(rc)) {
+        atomic_store(&io->lost, true);
+    }
+    return next > 0 ? next : 1;
+}
+
+// Helper: Sleep until the socket can move in the direction libssh2 is waiting on, a
+// request arrives, or (with requests in hand) the poll interval passes. An idle session
+// wakes for its next keepalive, and watches the socket for errors and hangups only
+static void wait_for_socket(NetworkIO *io)
+{
+    struct pollfd fds[2];
+    int count = 0;
+    bool lost = atomic_load(&io->lost);
+
+    fds[count].fd = io->wake[0];
+    fds[count].events = POLLIN;
+    count++;
+
+    int directions = io->active ? libssh2_session_block_directions(io->session) : 0;
+    if (!lost && (directions || !io->active)) {
+        fds[count].fd = io->socket;
+        fds[count].events = 0;
+        if (directions & LIBSSH2_SESSION_BLOCK_INBOUND) {
+            fds[count].events |= POLLIN;
+        }
+        if (directions & LIBSSH2_SESSION_BLOCK_OUTBOUND) {
+            fds[count].events |= POLLOUT;
+        }
+        count++;
+    }
+
+    int timeout = -1;
+    if (io->active) {
+        timeout = NETWORK_IO_POLL_MS;
+    } else if (!lost) {
+        timeout = send_keepalive(io) * 1000;
+    }
+    poll(fds, (nfds_t)count, timeout);
+
+    if (count > 1 && (fds[1].revents & (POLLERR | POLLHUP | POLLNVAL))) {
+        atomic_store(&io->lost, true);
+    }
+
+    // Drain the wake pipe
+    char drain[64];
+    while (read(io->wake[0], drain, sizeof(drain)) > 0) {
+    }
+}
+
+// Thread function: step every active request in turn, polling the socket once none can
+// move
+static void *network_io_thread(void *arg)
+{
+    NetworkIO *io = (NetworkIO *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&io->mutex);
+        bool stopping = io->stopping;
+        if (io->submitted) {
+            NetworkRequest **tail = &io->active;
+            while (*tail) {
+                tail = &(*tail)->next;
+            }
+            *tail = io->submitted;
+            io->submitted = NULL;
+            io->submitted_tail = &io->submitted;
+        }
+        pthread_mutex_unlock(&io->mutex);
+
+        if (stopping) {
+            break;
+        }
+
+        // A dead session fails everything at once; its handles go with the session
+        if (atomic_load(&io->lost)) {
+            while (io->active) {
+                NetworkRequest *req = io->active;
+                io->active = req->next;
+                req->handle = NULL;
+                req->ok = false;
+                req->error = LIBSSH2_ERROR_SOCKET_DISCONNECT;
+                complete_request(io, req);
+            }
+            wait_for_socket(io);
+            continue;
+        }
+
+        bool progressed = false;
+        NetworkRequest **link = &io->active;
+        while (*link) {
+            NetworkRequest *req = *link;
+            NetStep step = step_request(io, req);
+            if (step == NET_STEP_DONE) {
+                *link = req->next;
+                complete_request(io, req);
+                progressed = true;
+                continue;
+            }
+            if (step == NET_STEP_PROGRESS) {
+                progressed = true;
+            }
+            link = &req->next;
+        }
+
+        if (!progressed) {
+            wait_for_socket(io);
+        }
+    }
+
+    // Fail what is left, closing handles with the session blocking again, under a timeout
+    // so a session whose link is gone cannot hang its shutdown. A lost one is not touched
+    libssh2_session_set_blocking(io->session, 1);
+    libssh2_session_set_timeout(io->session, NETWORK_SHUTDOWN_TIMEOUT_MS);
+    bool lost = atomic_load(&io->lost);
+    while (io->active) {
+        NetworkRequest *req = io->active;
+        io->active = req->next;
+        if (lost) {
+            req->handle = NULL;
+        } else if (req->handle && req->op == NET_OP_EXEC) {
+            libssh2_channel_free((LIBSSH2_CHANNEL *)req->handle);
+        } else if (req->handle) {
+            libssh2_sftp_close_handle((LIBSSH2_SFTP_HANDLE *)req->handle);
+        }
+        req->handle = NULL;
+        req->ok = false;
+        complete_request(io, req);
+    }
+
+    return NULL;
+}
+
+NetworkIO *network_io_start(void *ssh_session, void *sftp_session, int socket)
+{
+    NetworkIO *io = calloc(1, sizeof(NetworkIO));
+    if (!io) {
+        return NULL;
+    }
+
+    if (pipe(io->wake) != 0) {
+        free(io);
+        return NULL;
+    }
+    fcntl(io->wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(io->wake[1], F_SETFL, O_NONBLOCK);
+
+    io->session = (LIBSSH2_SESSION *)ssh_session;
+    io->sftp = (LIBSSH2_SFTP *)sftp_session;
+    io->socket = socket;
+    io->submitted_tail = &io->submitted;
+    pthread_mutex_init(&io->mutex, NULL);
+    pthread_cond_init(&io->done_cond, NULL);
+    atomic_init(&io->lost, false);
+
+    // No replies: nothing reads the socket while idle, and the kernel's TCP keepalive
+    // (set on connect) is what notices a peer that stopped answering
+    libssh2_keepalive_config(io->session, 0, NETWORK_KEEPALIVE_INTERVAL);
+    libssh2_session_set_blocking(io->session, 0);
+    if (pthread_create(&io->thread, NULL, network_io_thread, io) != 0) {
+        libssh2_session_set_blocking(io->session, 1);
+        pthread_cond_destroy(&io->done_cond);
+        pthread_mutex_destroy(&io->mutex);
+        close(io->wake[0]);
+        close(io->wake[1]);
+        free(io);
+        return NULL;
+    }
+
+    return io;
+}
+
+void network_io_stop(NetworkIO *io)
+{
+    if (!io) {
+        return;
+    }
+
+    pthread_mutex_lock(&io->mutex);
+    io->stopping = true;
+    pthread_mutex_unlock(&io->mutex);
+    (void)write(io->wake[1], "x", 1);
+    pthread_join(io->thread, NULL);
+
+    // Requests queued after the thread last looked never started
+    while (io->submitted) {
+        NetworkRequest *req = io->submitted;
+        io->submitted = req->next;
+        req->ok = false;
+        complete_request(io, req);
+    }
+
+    pthread_cond_destroy(&io->done_cond);
+    pthread_mutex_destroy(&io->mutex);
+    close(io->wake[0]);
+    close(io->wake[1]);
+    free(io);
+}
+
+bool network_io_lost(NetworkIO *io)
+{
+    return atomic_load(&io->lost);
+}
+
+void network_io_set_lost(NetworkIO *io)
+{
+    atomic_store(&io->lost, true);
+    (void)write(io->wake[1], "x", 1);
+}
+
+void network_request_init(NetworkRequest *req, NetworkOp op)
+{
+    memset(req, 0, sizeof(NetworkRequest));
+    req->op = op;
+    req->fd = -1;
+    req->length = UINT64_MAX;
+    req->size = UINT64_MAX;
+    directory_state_init(&req->listing);
+    atomic_init(&req->completed, false);
+}
+
+void network_request_free(NetworkRequest *req)
+{
+    directory_state_free(&req->listing);
+    free(req->output);
+    req->output = NULL;
+    req->output_len = 0;
+}
+
+bool network_io_submit(NetworkIO *io, NetworkRequest *req)
+{
+    req->next = NULL;
+    req->stage = NET_STAGE_OPEN;
+    req->ok = false;
+    req->done = 0;
+    atomic_store(&req->completed, false);
+
+    pthread_mutex_lock(&io->mutex);
+    bool accepted = !io->stopping;
+    if (accepted) {
+        *io->submitted_tail = req;
+        io->submitted_tail = &req->next;
+    } else {
+        atomic_store(&req->completed, true);
+    }
+    pthread_mutex_unlock(&io->mutex);
+
+    if (accepted) {
+        (void)write(io->wake[1], "x", 1);
+    }
+    return accepted;
+}
+
+bool network_request_is_complete(NetworkRequest *req)
+{
+    return atomic_load(&req->completed);
+}
+
+bool network_io_wait(NetworkIO *io, NetworkRequest *req)
+{
+    pthread_mutex_lock(&io->mutex);
+    while (!atomic_load(&req->completed)) {
+        pthread_cond_wait(&io->done_cond, &io->mutex);
+    }
+    pthread_mutex_unlock(&io->mutex);
+
+    return req->ok;
+}
+
+bool network_io_run(NetworkIO *io, NetworkRequest *req)
+{
+    if (!network_io_submit(io, req)) {
+        return false;
+    }
+    return network_io_wait(io, req);
+}
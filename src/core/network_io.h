@@ -0,0 +1,119 @@
+#ifndef NETWORK_IO_H
+#define NETWORK_IO_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "filesystem.h"
+#include "network.h"
+#include "operations.h"
+
+// Each connection's SSH session is driven by one network thread with libssh2 in
+// non-blocking mode. Requests from any thread are queued to it and stepped in turn over
+// the session's SFTP channel, so a long transfer does not hold up a listing, and no
+// caller waits on the socket unless it chooses to wait for its own request. While idle
+// the thread sends SSH keepalives, so a link that dropped is noticed before it is used
+
+// Transfer buffer: libssh2 pipelines as many read/write requests as fit in the buffer
+// it is handed, so a large buffer keeps the link busy instead of waiting a round trip
+// per 32 KB
+#define SFTP_TRANSFER_BUFFER (2 * 1024 * 1024)
+
+// Output kept from a command run on the server
+#define NETWORK_EXEC_OUTPUT_MAX (16 * 1024 * 1024)
+
+// How often the network thread looks at paused or cancelled transfers while the socket
+// is idle
+#define NETWORK_IO_POLL_MS 100
+
+// Remote operations
+typedef enum NetworkOp {
+    NET_OP_STAT,        // Size and mtime of path
+    NET_OP_SETSTAT,     // Set the size and/or mtime of path
+    NET_OP_LIST,        // Entries of the directory path
+    NET_OP_READ,        // Range of path into fd
+    NET_OP_WRITE,       // Range of fd into path (which must exist)
+    NET_OP_CREATE,      // Create or truncate path
+    NET_OP_MKDIR,
+    NET_OP_RMDIR,
+    NET_OP_UNLINK,
+    NET_OP_RENAME,      // path to target
+    NET_OP_EXEC         // Run command on the server over an SSH exec channel
+} NetworkOp;
+
+// A request owned by the caller; it must stay in place until it completes
+typedef struct NetworkRequest {
+    // Input
+    NetworkOp op;
+    char path[NETWORK_PATH_MAX];
+    char target[NETWORK_PATH_MAX];      // NET_OP_RENAME destination
+    int fd;                             // NET_OP_READ/WRITE local file; NET_OP_EXEC output, if set
+    uint64_t offset;                    // NET_OP_READ/WRITE range start
+    uint64_t length;                    // Range length; UINT64_MAX reads to the end
+    CopyControl *control;               // Progress, pause and cancel between buffers (may be NULL)
+    const char *command;                // NET_OP_EXEC shell command (caller's string)
+
+    // NET_OP_STAT output and NET_OP_SETSTAT input
+    uint64_t size;                      // UINT64_MAX: unknown, or left alone
+    int64_t mtime;                      // 0: unknown, or left alone
+
+    // Output, valid once complete
+    bool ok;                            // For NET_OP_EXEC, the command exited 0
+    int error;                          // libssh2 error code when not ok
+    uint64_t done;                      // NET_OP_READ/WRITE bytes moved
+    DirectoryState listing;             // NET_OP_LIST entries, sorted by name
+    char *output;                       // NET_OP_EXEC standard output, NUL-terminated (unless to fd)
+    size_t output_len;                  // Bytes of output, also when written to fd
+    int exit_status;                    // NET_OP_EXEC exit status
+
+    atomic_bool completed;
+
+    // Private to the network thread
+    int stage;
+    void *handle;                       // LIBSSH2_SFTP_HANDLE*, or LIBSSH2_CHANNEL* for exec
+    char *buffer;
+    size_t chunk_len;                   // Bytes of the buffer in flight, 0 between chunks
+    size_t chunk_sent;
+    struct NetworkRequest *next;
+} NetworkRequest;
+
+// Network thread of one session (opaque)
+typedef struct NetworkIO NetworkIO;
+
+// Hand a connected session to a new network thread, switching it to non-blocking mode.
+// NULL on failure, with the session left blocking
+NetworkIO *network_io_start(void *ssh_session, void *sftp_session, int socket);
+
+// Stop the thread and free it. Unfinished requests complete with ok false, and the
+// session is left in blocking mode, with a NETWORK_SHUTDOWN_TIMEOUT_MS timeout, for the
+// caller to shut down
+void network_io_stop(NetworkIO *io);
+
+// Whether the session has died: a socket error or hangup, or a keepalive that could not
+// be sent. Requests then complete at once, not ok, until the session is replaced
+bool network_io_lost(NetworkIO *io);
+
+// Mark the session dead, as when it stopped answering (any thread)
+void network_io_set_lost(NetworkIO *io);
+
+// Prepare a request for op (everything else zeroed, length to the end, size and mtime
+// unknown)
+void network_request_init(NetworkRequest *req, NetworkOp op);
+
+// Free what a completed request holds (its listing and output)
+void network_request_free(NetworkRequest *req);
+
+// Queue req on the network thread. Returns false, with req completed and not ok, when
+// the thread is stopping
+bool network_io_submit(NetworkIO *io, NetworkRequest *req);
+
+// Check if req has completed (any thread)
+bool network_request_is_complete(NetworkRequest *req);
+
+// Block until req completes; returns req->ok
+bool network_io_wait(NetworkIO *io, NetworkRequest *req);
+
+// Submit req and wait for it
+bool network_io_run(NetworkIO *io, NetworkRequest *req);
+
+#endif // NETWORK_IO_H
@@ -1,6 +1,10 @@
 #include "operation_queue.h"
 #include "operations.h"
 #include "filesystem.h"
+#include "undo_log.h"
+#include "archive.h"
+#include "../utils/jobs.h"
+#include "../utils/hash.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -9,6 +13,7 @@
 #include <sys/stat.h>
 #include <dirent.h>
 #include <errno.h>
+#include <signal.h>
 
 // Get file size for progress tracking
 static off_t get_file_size(const char *path)
@@ -50,26 +55,227 @@ static off_t get_dir_size(const char *path)
     return total;
 }
 
-// Process a single operation
-static bool process_operation(QueuedOperation *op)
+// Interned string: refcounted, found again from its text
+typedef struct QueueString {
+    struct QueueString *next;
+    unsigned hash;
+    int refs;
+    char text[];
+} QueueString;
+
+struct QueueStringPool {
+    QueueString **buckets;
+    int bucket_count;
+    int count;
+};
+
+// Shared by every empty field, never counted
+static const char g_empty_string[1] = "";
+
+static QueueStringPool* string_pool_create(void)
 {
-    op->status = OP_STATUS_IN_PROGRESS;
-    op->started_at = time(NULL);
+    QueueStringPool *pool = calloc(1, sizeof(QueueStringPool));
+    if (pool == NULL) return NULL;
+    pool->bucket_count = 256;
+    pool->buckets = calloc((size_t)pool->bucket_count, sizeof(QueueString*));
+    if (pool->buckets == NULL) {
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+static void string_pool_destroy(QueueStringPool *pool)
+{
+    if (pool == NULL) return;
+    for (int b = 0; b < pool->bucket_count; b++) {
+        QueueString *node = pool->buckets[b];
+        while (node != NULL) {
+            QueueString *next = node->next;
+            free(node);
+            node = next;
+        }
+    }
+    free(pool->buckets);
+    free(pool);
+}
+
+// Double the buckets once chains average two; a failed grow just keeps longer chains
+static void string_pool_grow(QueueStringPool *pool)
+{
+    int bucket_count = pool->bucket_count * 2;
+    QueueString **buckets = calloc((size_t)bucket_count, sizeof(QueueString*));
+    if (buckets == NULL) return;
+
+    for (int b = 0; b < pool->bucket_count; b++) {
+        QueueString *node = pool->buckets[b];
+        while (node != NULL) {
+            QueueString *next = node->next;
+            QueueString **head = &buckets[node->hash & (unsigned)(bucket_count - 1)];
+            node->next = *head;
+            *head = node;
+            node = next;
+        }
+    }
+    free(pool->buckets);
+    pool->buckets = buckets;
+    pool->bucket_count = bucket_count;
+}
+
+// Take a reference to text, or NULL if out of memory
+static const char* string_intern(QueueStringPool *pool, const char *text)
+{
+    if (text == NULL || text[0] == '\0') {
+        return g_empty_string;
+    }
+    if (pool == NULL) return NULL;
+
+    unsigned hash = hash_fnv1a(text);
+    QueueString **head = &pool->buckets[hash & (unsigned)(pool->bucket_count - 1)];
+    for (QueueString *node = *head; node != NULL; node = node->next) {
+        if (node->hash == hash && strcmp(node->text, text) == 0) {
+            node->refs++;
+            return node->text;
+        }
+    }
+
+    size_t len = strlen(text);
+    QueueString *node = malloc(sizeof(QueueString) + len + 1);
+    if (node == NULL) return NULL;
+    node->hash = hash;
+    node->refs = 1;
+    memcpy(node->text, text, len + 1);
+    node->next = *head;
+    *head = node;
+
+    if (++pool->count > pool->bucket_count * 2) {
+        string_pool_grow(pool);
+    }
+    return node->text;
+}
+
+static void string_release(QueueStringPool *pool, const char *text)
+{
+    if (text == NULL || text == g_empty_string) return;
+
+    QueueString *node = (QueueString*)(text - offsetof(QueueString, text));
+    if (--node->refs > 0) return;
 
+    QueueString **link = &pool->buckets[node->hash & (unsigned)(pool->bucket_count - 1)];
+    while (*link != node) {
+        link = &(*link)->next;
+    }
+    *link = node->next;
+    pool->count--;
+    free(node);
+}
+
+// Replace an interned field; on out of memory it is left empty
+static void string_assign(QueueStringPool *pool, const char **field, const char *text)
+{
+    const char *interned = string_intern(pool, text);
+    string_release(pool, *field);
+    *field = interned != NULL ? interned : g_empty_string;
+}
+
+// What a worker produces outside the lock, written back to the queue afterwards
+typedef struct OperationOutcome {
+    OperationStatus status;
+    char target_path[QUEUE_PATH_MAX_LEN];
+    char error_message[256];
+    time_t completed_at;
+} OperationOutcome;
+
+// Pick the destination once: a retry keeps it, so the copy resumes instead of
+// starting over under a new unique name. dest_dir NULL means next to the source
+static void resolve_target(const QueuedOperation *op, const char *dest_dir, OperationOutcome *out)
+{
+    if (op->target_path[0] != '\0') {
+        snprintf(out->target_path, sizeof(out->target_path), "%s", op->target_path);
+        return;
+    }
+
+    char path[QUEUE_PATH_MAX_LEN];
+    if (dest_dir != NULL) {
+        const char *last_slash = strrchr(op->source_path, '/');
+        const char *name = last_slash != NULL ? last_slash + 1 : op->source_path;
+        snprintf(path, sizeof(path), "%s/%s", dest_dir, name);
+    } else {
+        snprintf(path, sizeof(path), "%s", op->source_path);
+    }
+    generate_unique_name(path, out->target_path, sizeof(out->target_path));
+}
+
+// Helper: Start the undo group of an operation; 0 for those that are not undone
+// through the queue (a sync, a batch recording its own group, or a removal)
+static uint64_t begin_undo(const QueuedOperation *op)
+{
+    if (op->type == QUEUE_OP_SYNC || op->type == QUEUE_OP_MOVE_BATCH || op->type == QUEUE_OP_REMOVE) {
+        return 0;
+    }
+    const char *last_slash = strrchr(op->source_path, '/');
+    char description[UNDO_LOG_DESCRIPTION_LEN];
+    snprintf(description, sizeof(description), "%s %s", queue_op_type_name(op->type),
+             last_slash != NULL ? last_slash + 1 : op->source_path);
+    return undo_log_begin(undo_log_shared(), UNDO_SOURCE_QUEUE, description);
+}
+
+// Helper: Record what a successful operation did (deletes record their own)
+static void record_undo(const QueuedOperation *op, const OperationOutcome *out, uint64_t group)
+{
+    UndoLog *undo = undo_log_shared();
+    switch (op->type) {
+        case QUEUE_OP_COPY:
+        case QUEUE_OP_DUPLICATE:
+            undo_log_created(undo, group, out->target_path);
+            break;
+        case QUEUE_OP_MOVE:
+            undo_log_moved(undo, group, op->source_path, out->target_path);
+            break;
+        case QUEUE_OP_RENAME: {
+            char new_path[QUEUE_PATH_MAX_LEN];
+            const char *last_slash = strrchr(op->source_path, '/');
+            int dir_len = last_slash != NULL ? (int)(last_slash - op->source_path) : 1;
+            snprintf(new_path, sizeof(new_path), "%.*s/%s", dir_len,
+                     last_slash != NULL ? op->source_path : ".", op->dest_path);
+            undo_log_moved(undo, group, op->source_path, new_path);
+            break;
+        }
+        case QUEUE_OP_CREATE_DIR:
+            undo_log_folder(undo, group, op->dest_path);
+            break;
+        default:
+            break;
+    }
+}
+
+// Process a single operation
+static bool process_operation(const QueuedOperation *op, OperationOutcome *out, CopyControl *control)
+{
     OperationResult result = OP_ERROR_UNKNOWN;
+    MoveBatchResult batch;
+    const char *error = NULL;               // Set by operations that report their own
+    char removal_error[256];
+    snprintf(out->target_path, sizeof(out->target_path), "%s", op->target_path);
+    out->error_message[0] = '\0';
+    uint64_t undo_group = begin_undo(op);
 
     switch (op->type) {
         case QUEUE_OP_COPY:
-            result = file_copy(op->source_path, op->dest_path);
+            resolve_target(op, op->dest_path, out);
+            result = file_copy_to(op->source_path, out->target_path, control);
             break;
 
         case QUEUE_OP_MOVE:
-            result = file_move(op->source_path, op->dest_path);
+            resolve_target(op, op->dest_path, out);
+            result = file_move_to(op->source_path, out->target_path, control);
             break;
 
-        case QUEUE_OP_DELETE:
-            result = file_delete(op->source_path);
+        case QUEUE_OP_DELETE: {
+            const char *path = op->source_path;
+            file_trash_batch(&path, 1, &result, undo_group);
             break;
+        }
 
         case QUEUE_OP_RENAME:
             result = file_rename(op->source_path, op->dest_path);
@@ -78,7 +284,7 @@ static bool process_operation(QueuedOperation *op)
         case QUEUE_OP_CREATE_DIR: {
             // Extract parent and name from dest_path
             char parent[QUEUE_PATH_MAX_LEN];
-            char *last_slash = strrchr(op->dest_path, '/');
+            const char *last_slash = strrchr(op->dest_path, '/');
             if (last_slash != NULL) {
                 size_t parent_len = last_slash - op->dest_path;
                 strncpy(parent, op->dest_path, parent_len);
@@ -91,78 +297,532 @@ static bool process_operation(QueuedOperation *op)
         }
 
         case QUEUE_OP_DUPLICATE:
-            result = file_duplicate(op->source_path);
+            resolve_target(op, NULL, out);
+            result = file_copy_to(op->source_path, out->target_path, control);
+            break;
+
+        case QUEUE_OP_SYNC:
+            result = file_sync_to(op->source_path, op->dest_path, op->sync_mode, op->sync_by_content, control);
+            break;
+
+        case QUEUE_OP_MOVE_BATCH:
+            result = move_batch_execute(op->dest_path, control, &batch);
+            error = batch.error_message;
+            break;
+
+        case QUEUE_OP_REMOVE: {
+            if (op->target_path[0] == '\0') {
+                result = file_remove(op->source_path, control);
+                break;
+            }
+            // What a stopped removal did not reach goes back where it was, not left hidden;
+            // a retry then removes it in place
+            result = file_remove(op->target_path, control);
+            if (result != OP_SUCCESS) {
+                snprintf(removal_error, sizeof(removal_error), "%s", operations_get_error());
+                error = removal_error;
+                if (file_restore_tombstone(op->target_path, op->source_path)) {
+                    out->target_path[0] = '\0';
+                }
+            }
             break;
+        }
     }
 
-    op->completed_at = time(NULL);
+    out->completed_at = time(NULL);
+    if (result == OP_SUCCESS) {
+        record_undo(op, out, undo_group);
+    }
+    undo_log_end(undo_log_shared(), undo_group);
+    if (error == NULL) {
+        error = operations_get_error();
+    }
 
     if (result == OP_SUCCESS) {
-        op->status = OP_STATUS_COMPLETED;
-        op->progress = 100;
-        op->processed_bytes = op->total_bytes;
+        out->status = OP_STATUS_COMPLETED;
+    } else if (result == OP_ERROR_CANCELLED) {
+        out->status = OP_STATUS_CANCELLED;
+        snprintf(out->error_message, sizeof(out->error_message), "%s", error);
     } else {
-        op->status = OP_STATUS_FAILED;
-        op->can_retry = true;
-        const char *err_msg = operations_get_error();
-        if (err_msg && strlen(err_msg) > 0) {
-            snprintf(op->error_message, sizeof(op->error_message), "%s", err_msg);
+        out->status = OP_STATUS_FAILED;
+        if (error && strlen(error) > 0) {
+            snprintf(out->error_message, sizeof(out->error_message), "%s", error);
         } else {
-            snprintf(op->error_message, sizeof(op->error_message), "Operation failed: %s", strerror(errno));
+            snprintf(out->error_message, sizeof(out->error_message), "Operation failed: %s", strerror(errno));
         }
     }
 
     return result == OP_SUCCESS;
 }
 
+// Device a path lives on, from the volume service's mount table when set; otherwise
+// paths that do not exist yet use their nearest existing parent
+static dev_t path_device(OperationQueue *queue, const char *path)
+{
+    VolumeInfo volume;
+    if (volumes_lookup(queue->volumes, path, &volume)) {
+        return volume.device;
+    }
+
+    char buffer[QUEUE_PATH_MAX_LEN];
+    strncpy(buffer, path, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+
+    for (;;) {
+        struct stat st;
+        if (stat(buffer, &st) == 0) {
+            return st.st_dev;
+        }
+        char *last_slash = strrchr(buffer, '/');
+        if (last_slash == NULL) {
+            return stat(".", &st) == 0 ? st.st_dev : 0;
+        }
+        if (last_slash == buffer) {
+            return stat("/", &st) == 0 ? st.st_dev : 0;
+        }
+        *last_slash = '\0';
+    }
+}
+
+static void add_device(QueuedOperation *op, dev_t device)
+{
+    for (int i = 0; i < op->device_count; i++) {
+        if (op->devices[i] == device) return;
+    }
+    if (op->device_count < QUEUE_MAX_OP_DEVICES) {
+        op->devices[op->device_count++] = device;
+    }
+}
+
+static bool device_in(const dev_t *devices, int count, dev_t device)
+{
+    for (int i = 0; i < count; i++) {
+        if (devices[i] == device) return true;
+    }
+    return false;
+}
+
+// Operation at a queue index
+static QueuedOperation* op_at(OperationQueue *queue, int index)
+{
+    return &queue->operations[(queue->head + index) % queue->capacity];
+}
+
+// Queue index of an operation, or -1. IDs increase along the ring, so this is a binary search
+static int find_index(OperationQueue *queue, int operation_id)
+{
+    int low = 0;
+    int high = queue->count - 1;
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        int id = op_at(queue, mid)->id;
+        if (id == operation_id) return mid;
+        if (id < operation_id) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return -1;
+}
+
+static bool is_finished(OperationStatus status)
+{
+    return status == OP_STATUS_COMPLETED || status == OP_STATUS_FAILED || status == OP_STATUS_CANCELLED;
+}
+
+// Add (sign 1) or take out (sign -1) an operation's share of the queue counters;
+// every status change is bracketed by the two
+static void account(OperationQueue *queue, const QueuedOperation *op, int sign)
+{
+    if (op->status == OP_STATUS_PENDING) queue->pending_count += sign;
+    if (op->status != OP_STATUS_IN_PROGRESS) queue->settled_progress += sign * op->progress;
+    if (is_finished(op->status)) queue->finished_count += sign;
+}
+
+// Move the ring into a buffer of the given capacity, oldest operation first
+static bool resize_ring(OperationQueue *queue, int capacity)
+{
+    QueuedOperation *operations = malloc((size_t)capacity * sizeof(QueuedOperation));
+    if (operations == NULL) return false;
+
+    for (int i = 0; i < queue->count; i++) {
+        operations[i] = *op_at(queue, i);
+    }
+    free(queue->operations);
+    queue->operations = operations;
+    queue->capacity = capacity;
+    queue->head = 0;
+    return true;
+}
+
+// Room for one more operation; doubling keeps adding O(1) amortized
+static bool ensure_capacity(OperationQueue *queue)
+{
+    if (queue->count < queue->capacity) return true;
+    return resize_ring(queue, queue->capacity > 0 ? queue->capacity * 2 : QUEUE_INITIAL_CAPACITY);
+}
+
+// Drop an operation's counters and strings before it leaves the ring
+static void drop_operation(OperationQueue *queue, QueuedOperation *op)
+{
+    account(queue, op, -1);
+    string_release(queue->strings, op->source_path);
+    string_release(queue->strings, op->dest_path);
+    string_release(queue->strings, op->target_path);
+    string_release(queue->strings, op->error_message);
+}
+
+// Remove up to limit finished operations, oldest first, and give back spare memory
+static void remove_finished(OperationQueue *queue, int limit)
+{
+    int write_idx = 0;
+    for (int read_idx = 0; read_idx < queue->count; read_idx++) {
+        QueuedOperation *op = op_at(queue, read_idx);
+        if (limit > 0 && is_finished(op->status)) {
+            drop_operation(queue, op);
+            limit--;
+            continue;
+        }
+        if (write_idx != read_idx) {
+            *op_at(queue, write_idx) = *op;
+        }
+        write_idx++;
+    }
+    queue->count = write_idx;
+    queue->scan_from = 0;
+
+    if (queue->capacity > QUEUE_INITIAL_CAPACITY && queue->count < queue->capacity / 4) {
+        int capacity = queue->capacity / 2;
+        resize_ring(queue, capacity > QUEUE_INITIAL_CAPACITY ? capacity : QUEUE_INITIAL_CAPACITY);
+    }
+}
+
+// Keep at most QUEUE_MAX_FINISHED finished operations listed; they are in the history
+static void trim_finished(OperationQueue *queue)
+{
+    while (queue->finished_count > QUEUE_MAX_FINISHED && is_finished(op_at(queue, 0)->status)) {
+        drop_operation(queue, op_at(queue, 0));
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        if (queue->scan_from > 0) queue->scan_from--;
+    }
+
+    // Finished operations behind an older pending one: compact once they reach twice the limit
+    if (queue->finished_count > 2 * QUEUE_MAX_FINISHED) {
+        remove_finished(queue, queue->finished_count - QUEUE_MAX_FINISHED);
+    }
+}
+
+// Index of the next pending operation whose devices are all idle, or -1. An
+// operation never overtakes an earlier pending one on a shared device, so work on
+// one disk keeps its queue order (a new folder exists before files are copied in).
+// Only the first QUEUE_SCAN_WINDOW pending operations are considered
+static int find_runnable(OperationQueue *queue)
+{
+    dev_t blocked[QUEUE_SCAN_WINDOW * QUEUE_MAX_OP_DEVICES];
+    int blocked_count = 0;
+
+    if (queue->pending_count == 0) return -1;
+
+    while (queue->scan_from < queue->count &&
+           op_at(queue, queue->scan_from)->status != OP_STATUS_PENDING) {
+        queue->scan_from++;
+    }
+
+    int scanned = 0;
+    for (int i = queue->scan_from; i < queue->count && scanned < QUEUE_SCAN_WINDOW; i++) {
+        QueuedOperation *op = op_at(queue, i);
+        if (op->status != OP_STATUS_PENDING) continue;
+        scanned++;
+
+        bool idle = true;
+        for (int d = 0; d < op->device_count && idle; d++) {
+            idle = !device_in(queue->busy_devices, queue->busy_count, op->devices[d]) &&
+                   !device_in(blocked, blocked_count, op->devices[d]);
+        }
+        if (idle) return i;
+
+        for (int d = 0; d < op->device_count; d++) {
+            if (!device_in(blocked, blocked_count, op->devices[d])) {
+                blocked[blocked_count++] = op->devices[d];
+            }
+        }
+    }
+    return -1;
+}
+
+// Index of the control a running operation uses, or -1
+static int find_control(OperationQueue *queue, int operation_id)
+{
+    for (int c = 0; c < QUEUE_MAX_WORKERS; c++) {
+        if (queue->control_ids[c] == operation_id) return c;
+    }
+    return -1;
+}
+
+// Publish the queue summary for lock-free readers (mutex held)
+static void publish_snapshot(OperationQueue *queue)
+{
+    QueueSnapshot *snap = &queue->snapshot;
+
+    int current_type = -1;
+    if (queue->current_index >= 0 && queue->current_index < queue->count) {
+        current_type = (int)op_at(queue, queue->current_index)->type;
+    }
+
+    // Odd while writing; the release fence orders the increment before the fields
+    unsigned seq = atomic_load_explicit(&snap->seq, memory_order_relaxed);
+    atomic_store_explicit(&snap->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&snap->pending_count, queue->pending_count, memory_order_relaxed);
+    atomic_store_explicit(&snap->total_count, queue->count, memory_order_relaxed);
+    atomic_store_explicit(&snap->is_processing, queue->is_processing, memory_order_relaxed);
+    atomic_store_explicit(&snap->is_paused, queue->is_paused, memory_order_relaxed);
+    atomic_store_explicit(&snap->settled_progress, queue->settled_progress, memory_order_relaxed);
+    atomic_store_explicit(&snap->current_type, current_type, memory_order_relaxed);
+    for (int c = 0; c < QUEUE_MAX_WORKERS; c++) {
+        long long total = 0;
+        int index = queue->control_ids[c] != 0 ? find_index(queue, queue->control_ids[c]) : -1;
+        if (index >= 0) {
+            total = (long long)op_at(queue, index)->total_bytes;
+        }
+        atomic_store_explicit(&snap->running_ids[c], queue->control_ids[c], memory_order_relaxed);
+        atomic_store_explicit(&snap->running_totals[c], total, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&snap->seq, seq + 2, memory_order_release);
+}
+
+// Progress 0-99 of the operation using a control; 100 only once it has finished
+static int control_progress(OperationQueue *queue, int c, long long total)
+{
+    if (total <= 0) {
+        return 0;
+    }
+    long long percent = atomic_load(&queue->controls[c].bytes_done) * 100 / total;
+    return percent > 99 ? 99 : (int)percent;
+}
+
+// Publish the byte counts of running operations into their slots
+static void sync_progress(OperationQueue *queue)
+{
+    for (int c = 0; c < QUEUE_MAX_WORKERS; c++) {
+        if (queue->control_ids[c] == 0) continue;
+
+        int index = find_index(queue, queue->control_ids[c]);
+        if (index < 0) continue;
+
+        QueuedOperation *op = op_at(queue, index);
+        op->processed_bytes = (off_t)atomic_load(&queue->controls[c].bytes_done);
+        op->progress = control_progress(queue, c, (long long)op->total_bytes);
+    }
+}
+
+// Point current_index at the earliest running operation
+static void refresh_current(OperationQueue *queue)
+{
+    queue->current_index = -1;
+    for (int c = 0; c < QUEUE_MAX_WORKERS; c++) {
+        if (queue->control_ids[c] == 0) continue;
+
+        int index = find_index(queue, queue->control_ids[c]);
+        if (index >= 0 && (queue->current_index < 0 || index < queue->current_index)) {
+            queue->current_index = index;
+        }
+    }
+    queue->is_processing = queue->active_count > 0;
+    publish_snapshot(queue);
+}
+
+static void fill_row(QueueRow *row, const QueuedOperation *op)
+{
+    row->id = op->id;
+    row->type = op->type;
+    row->status = op->status;
+    row->progress = op->progress;
+    row->can_retry = op->can_retry;
+    row->completed_at = op->completed_at;
+    snprintf(row->source_path, sizeof(row->source_path), "%s", op->source_path);
+    snprintf(row->error_message, sizeof(row->error_message), "%s", op->error_message);
+}
+
+// Record a finished operation; the oldest in-memory record moves to the history file
+static void add_history(OperationQueue *queue, const QueuedOperation *op)
+{
+    if (queue->history_count == QUEUE_MAX_HISTORY) {
+        QueueRow *oldest = &queue->history[queue->history_head];
+        if (queue->history_file != NULL &&
+            fseek(queue->history_file, (long)queue->history_spilled * (long)sizeof(QueueRow), SEEK_SET) == 0 &&
+            fwrite(oldest, sizeof(QueueRow), 1, queue->history_file) == 1) {
+            queue->history_spilled++;
+        }
+        queue->history_head = (queue->history_head + 1) % QUEUE_MAX_HISTORY;
+        queue->history_count--;
+    }
+    fill_row(&queue->history[(queue->history_head + queue->history_count) % QUEUE_MAX_HISTORY], op);
+    queue->history_count++;
+}
+
+// Mark a pending operation running
+static void claim_operation(OperationQueue *queue, QueuedOperation *op)
+{
+    account(queue, op, -1);
+    op->status = OP_STATUS_IN_PROGRESS;
+    op->started_at = time(NULL);
+    account(queue, op, 1);
+}
+
+// Claim the pending deletes after a claimed one that can run with it: on the same
+// device, with no other pending operation on that device in between. batch[0] is
+// the claimed delete; returns the batch size
+static int claim_delete_batch(OperationQueue *queue, int index, QueuedOperation *batch)
+{
+    dev_t device = batch[0].devices[0];
+    int count = 1;
+    int scanned = 0;
+
+    for (int i = index + 1; i < queue->count && count < QUEUE_DELETE_BATCH && scanned < QUEUE_SCAN_WINDOW; i++) {
+        QueuedOperation *op = op_at(queue, i);
+        if (op->status != OP_STATUS_PENDING) continue;
+        scanned++;
+
+        if (op->type == QUEUE_OP_DELETE && op->device_count == 1 && op->devices[0] == device) {
+            claim_operation(queue, op);
+            batch[count++] = *op;
+        } else if (device_in(op->devices, op->device_count, device)) {
+            break;
+        }
+    }
+    return count;
+}
+
+// Trash a claimed batch of deletes in one go, one outcome per operation, undone together
+static void process_delete_batch(const QueuedOperation *batch, int count, OperationResult *results)
+{
+    const char *paths[QUEUE_DELETE_BATCH];
+    for (int i = 0; i < count; i++) {
+        paths[i] = batch[i].source_path;
+    }
+    char description[UNDO_LOG_DESCRIPTION_LEN];
+    snprintf(description, sizeof(description), "Delete %d items", count);
+    UndoLog *undo = undo_log_shared();
+    uint64_t undo_group = undo_log_begin(undo, UNDO_SOURCE_QUEUE, description);
+    file_trash_batch(paths, count, results, undo_group);
+    undo_log_end(undo, undo_group);
+}
+
+// Write a worker's outcome back into the queue (mutex held)
+static void finish_operation(OperationQueue *queue, int operation_id, const OperationOutcome *outcome)
+{
+    QueuedOperation *done = op_at(queue, find_index(queue, operation_id));
+    account(queue, done, -1);
+    done->status = outcome->status;
+    done->completed_at = outcome->completed_at;
+    if (outcome->status == OP_STATUS_COMPLETED) {
+        done->progress = 100;
+        done->processed_bytes = done->total_bytes;
+    } else {
+        done->progress = 0;
+        done->processed_bytes = 0;
+        done->can_retry = true;
+    }
+    string_assign(queue->strings, &done->target_path, outcome->target_path);
+    string_assign(queue->strings, &done->error_message, outcome->error_message);
+    account(queue, done, 1);
+
+    add_history(queue, done);
+}
+
 // Worker thread function
 static void* worker_thread_func(void *arg)
 {
     OperationQueue *queue = (OperationQueue*)arg;
+    OperationOutcome outcome;
+    QueuedOperation batch[QUEUE_DELETE_BATCH];
+    OperationResult results[QUEUE_DELETE_BATCH];
 
-    while (!queue->should_stop) {
-        QueuedOperation *next_op = NULL;
-
-        // Lock and find next pending operation
-        pthread_mutex_lock(&queue->mutex);
+    pthread_mutex_lock(&queue->mutex);
 
-        if (!queue->is_paused && !queue->should_stop) {
-            for (int i = 0; i < queue->count; i++) {
-                if (queue->operations[i].status == OP_STATUS_PENDING) {
-                    next_op = &queue->operations[i];
-                    queue->current_index = i;
-                    queue->is_processing = true;
-                    break;
-                }
-            }
+    for (;;) {
+        int index = -1;
+        while (!queue->should_stop && (queue->is_paused || (index = find_runnable(queue)) < 0)) {
+            pthread_cond_wait(&queue->cond, &queue->mutex);
+        }
+        if (queue->should_stop) {
+            break;
         }
 
+        // Claim the operation and its devices. Work from copies outside the lock: the
+        // ring may grow or compact meanwhile, but running operations never leave it,
+        // so their strings stay valid
+        QueuedOperation *slot = op_at(queue, index);
+        claim_operation(queue, slot);
+        batch[0] = *slot;
+        int batch_count = 1;
+        if (slot->type == QUEUE_OP_DELETE) {
+            batch_count = claim_delete_batch(queue, index, batch);
+        }
+        for (int d = 0; d < batch[0].device_count; d++) {
+            queue->busy_devices[queue->busy_count++] = batch[0].devices[d];
+        }
+        queue->active_count++;
+
+        // Each worker runs one operation, so a free control always exists
+        int c = find_control(queue, 0);
+        queue->control_ids[c] = batch[0].id;
+        CopyControl *control = &queue->controls[c];
+        copy_control_init(control);
+        refresh_current(queue);
         pthread_mutex_unlock(&queue->mutex);
 
-        if (next_op != NULL) {
-            // Process the operation (outside the lock)
-            process_operation(next_op);
+        if (batch_count > 1) {
+            process_delete_batch(batch, batch_count, results);
+        } else {
+            process_operation(&batch[0], &outcome, control);
+        }
 
-            // Add to history
-            pthread_mutex_lock(&queue->mutex);
+        pthread_mutex_lock(&queue->mutex);
+        queue->control_ids[c] = 0;
 
-            if (queue->history_count >= QUEUE_MAX_HISTORY) {
-                // Shift history
-                memmove(&queue->history[0], &queue->history[1],
-                        (QUEUE_MAX_HISTORY - 1) * sizeof(QueuedOperation));
-                queue->history_count--;
+        for (int d = 0; d < batch[0].device_count; d++) {
+            for (int b = 0; b < queue->busy_count; b++) {
+                if (queue->busy_devices[b] == batch[0].devices[d]) {
+                    queue->busy_devices[b] = queue->busy_devices[--queue->busy_count];
+                    break;
+                }
+            }
+        }
+        queue->active_count--;
+
+        if (batch_count > 1) {
+            outcome.target_path[0] = '\0';
+            outcome.completed_at = time(NULL);
+            for (int i = 0; i < batch_count; i++) {
+                outcome.status = results[i] == OP_SUCCESS ? OP_STATUS_COMPLETED : OP_STATUS_FAILED;
+                if (results[i] == OP_SUCCESS) {
+                    outcome.error_message[0] = '\0';
+                } else if (results[i] == OP_ERROR_NOT_FOUND) {
+                    snprintf(outcome.error_message, sizeof(outcome.error_message),
+                             "File does not exist: %s", batch[i].source_path);
+                } else {
+                    snprintf(outcome.error_message, sizeof(outcome.error_message),
+                             "Move to Trash failed, file not deleted");
+                }
+                finish_operation(queue, batch[i].id, &outcome);
             }
-            queue->history[queue->history_count++] = *next_op;
-            queue->is_processing = false;
-            queue->current_index = -1;
-
-            pthread_mutex_unlock(&queue->mutex);
         } else {
-            // No work to do, sleep briefly
-            usleep(100000); // 100ms
+            finish_operation(queue, batch[0].id, &outcome);
         }
+        trim_finished(queue);
+        refresh_current(queue);
+
+        // Operations waiting on the devices just released may run now
+        pthread_cond_broadcast(&queue->cond);
     }
 
+    pthread_mutex_unlock(&queue->mutex);
     return NULL;
 }
 
@@ -171,15 +831,173 @@ void operation_queue_init(OperationQueue *queue)
     memset(queue, 0, sizeof(OperationQueue));
     queue->current_index = -1;
     queue->next_id = 1;
+    queue->strings = string_pool_create();  // Adding fails with -1 if this did
+    for (int c = 0; c < QUEUE_MAX_WORKERS; c++) {
+        copy_control_init(&queue->controls[c]);
+    }
     pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->cond, NULL);
+    publish_snapshot(queue);
+}
+
+// Helper: Put a removal's tombstone back where the item was, as the removal will not run
+// (mutex held); a retry then removes it in place
+static void restore_tombstone(OperationQueue *queue, QueuedOperation *op)
+{
+    if (op->type != QUEUE_OP_REMOVE || op->target_path[0] == '\0') {
+        return;
+    }
+    if (file_restore_tombstone(op->target_path, op->source_path)) {
+        string_assign(queue->strings, &op->target_path, NULL);
+    } else {
+        string_assign(queue->strings, &op->error_message, operations_get_error());
+    }
+}
+
+// Helper: Put back the tombstones a log names that still exist; false if any could not
+// be (it stays aside, and is reported)
+static bool restore_logged_tombstones(const char *log_path, int *restored)
+{
+    FILE *log = fopen(log_path, "rb");
+    if (log == NULL) {
+        return false;
+    }
+    char tombstone[QUEUE_PATH_MAX_LEN];
+    char path[QUEUE_PATH_MAX_LEN];
+    bool all = true;
+    // Records are the tombstone and the item's path, each ending in '\0'
+    for (;;) {
+        size_t t = 0, p = 0;
+        int c;
+        while ((c = fgetc(log)) != EOF && c != '\0' && t + 1 < sizeof(tombstone)) tombstone[t++] = (char)c;
+        tombstone[t] = '\0';
+        while (c != EOF && (c = fgetc(log)) != EOF && c != '\0' && p + 1 < sizeof(path)) path[p++] = (char)c;
+        path[p] = '\0';
+        if (c == EOF) {
+            break;
+        }
+        struct stat st;
+        if (lstat(tombstone, &st) != 0) {
+            continue;                       // Removed, or put back already
+        }
+        if (file_restore_tombstone(tombstone, path)) {
+            (*restored)++;
+        } else {
+            fprintf(stderr, "Left aside as %s: %s\n", tombstone, operations_get_error());
+            all = false;
+        }
+    }
+    fclose(log);
+    return all;
+}
+
+int operation_queue_set_tombstone_dir(OperationQueue *queue, const char *dir)
+{
+    // Logs of runs no longer going, or of an earlier run with this process's ID
+    int restored = 0;
+    DIR *logs = opendir(dir);
+    struct dirent *entry;
+    while (logs != NULL && (entry = readdir(logs)) != NULL) {
+        int pid;
+        char extra;
+        if (sscanf(entry->d_name, QUEUE_TOMBSTONE_LOG "%d.log%c", &pid, &extra) != 1 || pid <= 0) {
+            continue;
+        }
+        if (pid != (int)getpid() && (kill((pid_t)pid, 0) == 0 || errno != ESRCH)) {
+            continue;
+        }
+        char log_path[QUEUE_PATH_MAX_LEN];
+        snprintf(log_path, sizeof(log_path), "%s/%s", dir, entry->d_name);
+        if (restore_logged_tombstones(log_path, &restored)) {
+            unlink(log_path);
+        }
+    }
+    if (logs != NULL) {
+        closedir(logs);
+    }
+
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->tombstone_log != NULL) {
+        fclose(queue->tombstone_log);
+    }
+    snprintf(queue->tombstone_log_path, sizeof(queue->tombstone_log_path), "%s/" QUEUE_TOMBSTONE_LOG "%d.log",
+             dir, (int)getpid());
+    queue->tombstone_log = fopen(queue->tombstone_log_path, "wb");
+    pthread_mutex_unlock(&queue->mutex);
+    return restored;
 }
 
 void operation_queue_free(OperationQueue *queue)
 {
+    // Paste jobs add to the queue: stop them before it goes
+    if (queue->paste_feeds != NULL) {
+        job_token_cancel(queue->paste_feeds);
+        job_token_wait(queue->paste_feeds);
+        job_token_release(queue->paste_feeds);
+        queue->paste_feeds = NULL;
+    }
     operation_queue_stop(queue);
+
+    // Removals that never ran leave their items where they were
+    bool aside = false;
+    for (int i = 0; i < queue->count; i++) {
+        QueuedOperation *op = op_at(queue, i);
+        if (op->status == OP_STATUS_PENDING) {
+            restore_tombstone(queue, op);
+        }
+        struct stat st;
+        aside = aside || (op->type == QUEUE_OP_REMOVE && op->target_path[0] != '\0' && lstat(op->target_path, &st) == 0);
+    }
+    if (queue->tombstone_log != NULL) {
+        fclose(queue->tombstone_log);
+        queue->tombstone_log = NULL;
+        if (!aside) {
+            unlink(queue->tombstone_log_path);
+        }
+    }
+
+    if (queue->history_file != NULL) {
+        fclose(queue->history_file);
+        queue->history_file = NULL;
+    }
+    string_pool_destroy(queue->strings);    // Frees every operation's strings
+    queue->strings = NULL;
+    free(queue->operations);
+    queue->operations = NULL;
+    queue->capacity = 0;
+    queue->count = 0;
+
+    pthread_cond_destroy(&queue->cond);
     pthread_mutex_destroy(&queue->mutex);
 }
 
+bool operation_queue_set_history_file(OperationQueue *queue, const char *path)
+{
+    FILE *file = fopen(path, "w+b");
+    if (file == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->history_file != NULL) {
+        fclose(queue->history_file);
+    }
+    queue->history_file = file;
+    queue->history_spilled = 0;
+    pthread_mutex_unlock(&queue->mutex);
+    return true;
+}
+
+void operation_queue_set_dir_sizes(OperationQueue *queue, DirSizes *sizes)
+{
+    queue->dir_sizes = sizes;
+}
+
+void operation_queue_set_volumes(OperationQueue *queue, Volumes *volumes)
+{
+    queue->volumes = volumes;
+}
+
 bool operation_queue_start(OperationQueue *queue)
 {
     if (queue->worker_running) {
@@ -187,7 +1005,14 @@ bool operation_queue_start(OperationQueue *queue)
     }
 
     queue->should_stop = false;
-    if (pthread_create(&queue->worker_thread, NULL, worker_thread_func, queue) != 0) {
+    queue->worker_count = 0;
+    for (int i = 0; i < QUEUE_MAX_WORKERS; i++) {
+        if (pthread_create(&queue->workers[i], NULL, worker_thread_func, queue) != 0) {
+            break;  // Run with however many threads we got
+        }
+        queue->worker_count++;
+    }
+    if (queue->worker_count == 0) {
         return false;
     }
 
@@ -201,23 +1026,70 @@ void operation_queue_stop(OperationQueue *queue)
         return;
     }
 
+    pthread_mutex_lock(&queue->mutex);
     queue->should_stop = true;
-    pthread_join(queue->worker_thread, NULL);
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+
+    for (int i = 0; i < queue->worker_count; i++) {
+        pthread_join(queue->workers[i], NULL);
+    }
+    queue->worker_count = 0;
     queue->worker_running = false;
 }
 
-// Helper to add an operation
-static int add_operation(OperationQueue *queue, QueueOpType type,
-                         const char *source, const char *dest)
+// Helper to add an operation. target (may be NULL) fixes a copy's destination path
+static int add_operation_to(OperationQueue *queue, QueueOpType type, const char *source,
+                            const char *dest, const char *target, SyncMode sync_mode, bool sync_by_content)
 {
+    // A removal moved aside works on its tombstone
+    const char *sized = type == QUEUE_OP_REMOVE && target != NULL ? target : source;
+
+    // Rename targets are bare names on the source's device; a batch's dest is its journal
+    dev_t source_device = path_device(queue, sized);
+    dev_t dest_device = source_device;
+    if (dest != NULL && (type == QUEUE_OP_COPY || type == QUEUE_OP_MOVE || type == QUEUE_OP_CREATE_DIR ||
+                         type == QUEUE_OP_SYNC)) {
+        dest_device = path_device(queue, dest);
+    }
+
+    // Sized before locking: walking a big tree must not hold up the workers or the UI
+    off_t total_bytes = 0;
+    struct stat st;
+    if (type == QUEUE_OP_MOVE_BATCH) {
+        // Progress counts moves
+        total_bytes = move_batch_journal_count(dest);
+    } else if (stat(sized, &st) == 0) {
+        if (!S_ISDIR(st.st_mode)) {
+            total_bytes = st.st_size;
+        } else if (queue->dir_sizes != NULL) {
+            total_bytes = dir_sizes_compute(queue->dir_sizes, sized);
+        } else {
+            total_bytes = get_dir_size(sized);
+        }
+    } else {
+        // A member of an archive is sized from its listing
+        uint64_t member_bytes;
+        if (archive_path_size(sized, &member_bytes)) {
+            total_bytes = (off_t)member_bytes;
+        }
+    }
+
     pthread_mutex_lock(&queue->mutex);
 
-    if (queue->count >= QUEUE_MAX_OPERATIONS) {
+    // Operations into one folder share its dest string
+    const char *source_str = string_intern(queue->strings, source);
+    const char *dest_str = string_intern(queue->strings, dest);
+    const char *target_str = string_intern(queue->strings, target);
+    if (source_str == NULL || dest_str == NULL || target_str == NULL || !ensure_capacity(queue)) {
+        string_release(queue->strings, source_str);
+        string_release(queue->strings, dest_str);
+        string_release(queue->strings, target_str);
         pthread_mutex_unlock(&queue->mutex);
         return -1;
     }
 
-    QueuedOperation *op = &queue->operations[queue->count];
+    QueuedOperation *op = op_at(queue, queue->count);
     memset(op, 0, sizeof(QueuedOperation));
 
     op->id = queue->next_id++;
@@ -225,34 +1097,56 @@ static int add_operation(OperationQueue *queue, QueueOpType type,
     op->status = OP_STATUS_PENDING;
     op->created_at = time(NULL);
 
-    strncpy(op->source_path, source, sizeof(op->source_path) - 1);
-    if (dest != NULL) {
-        strncpy(op->dest_path, dest, sizeof(op->dest_path) - 1);
-    }
+    op->source_path = source_str;
+    op->dest_path = dest_str;
+    op->target_path = target_str;
+    op->error_message = g_empty_string;
+    op->sync_mode = sync_mode;
+    op->sync_by_content = sync_by_content;
+    add_device(op, source_device);
+    add_device(op, dest_device);
 
-    // Calculate size for progress tracking
-    struct stat st;
-    if (stat(source, &st) == 0) {
-        if (S_ISDIR(st.st_mode)) {
-            op->total_bytes = get_dir_size(source);
-        } else {
-            op->total_bytes = st.st_size;
-        }
-    }
+    op->total_bytes = total_bytes;
 
     int id = op->id;
     queue->count++;
+    account(queue, op, 1);
+    publish_snapshot(queue);
 
+    pthread_cond_broadcast(&queue->cond);
     pthread_mutex_unlock(&queue->mutex);
 
     return id;
 }
 
+static int add_operation(OperationQueue *queue, QueueOpType type,
+                         const char *source, const char *dest)
+{
+    return add_operation_to(queue, type, source, dest, NULL, SYNC_UPDATE, false);
+}
+
 int operation_queue_copy(OperationQueue *queue, const char *source, const char *dest)
 {
     return add_operation(queue, QUEUE_OP_COPY, source, dest);
 }
 
+int operation_queue_copy_to(OperationQueue *queue, const char *source, const char *dest_path)
+{
+    char dest_dir[QUEUE_PATH_MAX_LEN];
+    snprintf(dest_dir, sizeof(dest_dir), "%s", dest_path);
+    char *last_slash = strrchr(dest_dir, '/');
+    if (last_slash != NULL && last_slash != dest_dir) {
+        *last_slash = '\0';
+    }
+    return add_operation_to(queue, QUEUE_OP_COPY, source, dest_dir, dest_path, SYNC_UPDATE, false);
+}
+
+int operation_queue_sync(OperationQueue *queue, const char *source, const char *dest_path,
+                         SyncMode mode, bool by_content)
+{
+    return add_operation_to(queue, QUEUE_OP_SYNC, source, dest_path, NULL, mode, by_content);
+}
+
 int operation_queue_move(OperationQueue *queue, const char *source, const char *dest)
 {
     return add_operation(queue, QUEUE_OP_MOVE, source, dest);
@@ -263,6 +1157,92 @@ int operation_queue_delete(OperationQueue *queue, const char *path)
     return add_operation(queue, QUEUE_OP_DELETE, path, NULL);
 }
 
+int operation_queue_remove(OperationQueue *queue, const char *path, bool in_background)
+{
+    if (!in_background) {
+        return add_operation(queue, QUEUE_OP_REMOVE, path, NULL);
+    }
+    char tombstone[QUEUE_PATH_MAX_LEN];
+    if (!file_remove_tombstone(path, tombstone, sizeof(tombstone))) {
+        return -1;
+    }
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->tombstone_log != NULL) {
+        fwrite(tombstone, 1, strlen(tombstone) + 1, queue->tombstone_log);
+        fwrite(path, 1, strlen(path) + 1, queue->tombstone_log);
+        fflush(queue->tombstone_log);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return add_operation_to(queue, QUEUE_OP_REMOVE, path, NULL, tombstone, SYNC_UPDATE, false);
+}
+
+// Clipboard items on their way into the queue
+typedef struct PasteFeed {
+    OperationQueue *queue;
+    QueueOpType type;
+    char dest[QUEUE_PATH_MAX_LEN];
+    char *paths;                            // Copy of the clipboard's "path\0" run
+    size_t paths_size;
+} PasteFeed;
+
+static void paste_feed_run(void *arg, JobToken *token)
+{
+    PasteFeed *feed = arg;
+    size_t at = 0;
+    while (at < feed->paths_size && !job_token_cancelled(token)) {
+        const char *path = feed->paths + at;
+        add_operation(feed->queue, feed->type, path, feed->dest);
+        at += strlen(path) + 1;
+    }
+}
+
+static void paste_feed_done(void *arg, bool cancelled)
+{
+    (void)cancelled;
+    PasteFeed *feed = arg;
+    free(feed->paths);
+    free(feed);
+}
+
+int operation_queue_paste(OperationQueue *queue, ClipboardState *clipboard, const char *dest_dir)
+{
+    if (!clipboard_has_items(clipboard)) {
+        return 0;
+    }
+    if (queue->paste_feeds == NULL) {
+        queue->paste_feeds = job_token_create();
+    }
+
+    PasteFeed *feed = calloc(1, sizeof(PasteFeed));
+    char *paths = malloc(clipboard->paths_size);
+    if (feed == NULL || paths == NULL || queue->paste_feeds == NULL) {
+        free(feed);
+        free(paths);
+        return 0;
+    }
+    feed->queue = queue;
+    feed->type = clipboard->operation == OP_CUT ? QUEUE_OP_MOVE : QUEUE_OP_COPY;
+    snprintf(feed->dest, sizeof(feed->dest), "%s", dest_dir);
+    memcpy(paths, clipboard->paths, clipboard->paths_size);
+    feed->paths = paths;
+    feed->paths_size = clipboard->paths_size;
+
+    int count = clipboard->count;
+    if (clipboard->operation == OP_CUT) {
+        clipboard_clear(clipboard);
+    }
+    jobs_submit(JOB_QOS_USER_INITIATED, paste_feed_run, paste_feed_done, feed, queue->paste_feeds);
+    return count;
+}
+
+int operation_queue_move_batch(OperationQueue *queue, const char *journal_path, const char *root)
+{
+    if (move_batch_journal_count(journal_path) < 0) {
+        return -1;
+    }
+    return add_operation(queue, QUEUE_OP_MOVE_BATCH, root, journal_path);
+}
+
 int operation_queue_rename(OperationQueue *queue, const char *source, const char *new_name)
 {
     return add_operation(queue, QUEUE_OP_RENAME, source, new_name);
@@ -280,10 +1260,22 @@ int operation_queue_duplicate(OperationQueue *queue, const char *source)
     return add_operation(queue, QUEUE_OP_DUPLICATE, source, NULL);
 }
 
+// Helper: hold or release running copies between chunks
+static void set_running_paused(OperationQueue *queue, bool paused)
+{
+    for (int c = 0; c < QUEUE_MAX_WORKERS; c++) {
+        if (queue->control_ids[c] != 0) {
+            atomic_store(&queue->controls[c].pause, paused);
+        }
+    }
+}
+
 void operation_queue_pause(OperationQueue *queue)
 {
     pthread_mutex_lock(&queue->mutex);
     queue->is_paused = true;
+    set_running_paused(queue, true);
+    publish_snapshot(queue);
     pthread_mutex_unlock(&queue->mutex);
 }
 
@@ -291,6 +1283,9 @@ void operation_queue_resume(OperationQueue *queue)
 {
     pthread_mutex_lock(&queue->mutex);
     queue->is_paused = false;
+    set_running_paused(queue, false);
+    publish_snapshot(queue);
+    pthread_cond_broadcast(&queue->cond);
     pthread_mutex_unlock(&queue->mutex);
 }
 
@@ -298,14 +1293,27 @@ bool operation_queue_cancel(OperationQueue *queue, int operation_id)
 {
     pthread_mutex_lock(&queue->mutex);
 
-    for (int i = 0; i < queue->count; i++) {
-        if (queue->operations[i].id == operation_id) {
-            if (queue->operations[i].status == OP_STATUS_PENDING) {
-                queue->operations[i].status = OP_STATUS_CANCELLED;
-                pthread_mutex_unlock(&queue->mutex);
-                return true;
-            }
-            break;
+    int index = find_index(queue, operation_id);
+    if (index >= 0) {
+        QueuedOperation *op = op_at(queue, index);
+        if (op->status == OP_STATUS_PENDING) {
+            account(queue, op, -1);
+            op->status = OP_STATUS_CANCELLED;
+            restore_tombstone(queue, op);
+            account(queue, op, 1);
+            trim_finished(queue);
+            refresh_current(queue);
+            pthread_mutex_unlock(&queue->mutex);
+            return true;
+        }
+        // The worker marks it cancelled once the copy stops; other operations are too quick to stop
+        int c = find_control(queue, operation_id);
+        if (c >= 0 && (op->type == QUEUE_OP_COPY || op->type == QUEUE_OP_MOVE || op->type == QUEUE_OP_DUPLICATE ||
+                       op->type == QUEUE_OP_SYNC || op->type == QUEUE_OP_MOVE_BATCH ||
+                       op->type == QUEUE_OP_REMOVE)) {
+            atomic_store(&queue->controls[c].cancel, true);
+            pthread_mutex_unlock(&queue->mutex);
+            return true;
         }
     }
 
@@ -317,11 +1325,22 @@ void operation_queue_cancel_all(OperationQueue *queue)
 {
     pthread_mutex_lock(&queue->mutex);
 
-    for (int i = 0; i < queue->count; i++) {
-        if (queue->operations[i].status == OP_STATUS_PENDING) {
-            queue->operations[i].status = OP_STATUS_CANCELLED;
+    for (int i = queue->scan_from; i < queue->count && queue->pending_count > 0; i++) {
+        QueuedOperation *op = op_at(queue, i);
+        if (op->status == OP_STATUS_PENDING) {
+            account(queue, op, -1);
+            op->status = OP_STATUS_CANCELLED;
+            restore_tombstone(queue, op);
+            account(queue, op, 1);
         }
     }
+    for (int c = 0; c < QUEUE_MAX_WORKERS; c++) {
+        if (queue->control_ids[c] != 0) {
+            atomic_store(&queue->controls[c].cancel, true);
+        }
+    }
+    trim_finished(queue);
+    refresh_current(queue);
 
     pthread_mutex_unlock(&queue->mutex);
 }
@@ -330,18 +1349,23 @@ bool operation_queue_retry(OperationQueue *queue, int operation_id)
 {
     pthread_mutex_lock(&queue->mutex);
 
-    for (int i = 0; i < queue->count; i++) {
-        if (queue->operations[i].id == operation_id) {
-            if (queue->operations[i].status == OP_STATUS_FAILED &&
-                queue->operations[i].can_retry) {
-                queue->operations[i].status = OP_STATUS_PENDING;
-                queue->operations[i].error_message[0] = '\0';
-                queue->operations[i].progress = 0;
-                queue->operations[i].processed_bytes = 0;
-                pthread_mutex_unlock(&queue->mutex);
-                return true;
+    int index = find_index(queue, operation_id);
+    if (index >= 0) {
+        QueuedOperation *op = op_at(queue, index);
+        if ((op->status == OP_STATUS_FAILED || op->status == OP_STATUS_CANCELLED) && op->can_retry) {
+            account(queue, op, -1);
+            op->status = OP_STATUS_PENDING;
+            string_assign(queue->strings, &op->error_message, NULL);
+            op->progress = 0;
+            op->processed_bytes = 0;
+            account(queue, op, 1);
+            if (index < queue->scan_from) {
+                queue->scan_from = index;
             }
-            break;
+            publish_snapshot(queue);
+            pthread_cond_broadcast(&queue->cond);
+            pthread_mutex_unlock(&queue->mutex);
+            return true;
         }
     }
 
@@ -353,17 +1377,8 @@ void operation_queue_clear_finished(OperationQueue *queue)
 {
     pthread_mutex_lock(&queue->mutex);
 
-    int write_idx = 0;
-    for (int read_idx = 0; read_idx < queue->count; read_idx++) {
-        OperationStatus status = queue->operations[read_idx].status;
-        if (status == OP_STATUS_PENDING || status == OP_STATUS_IN_PROGRESS) {
-            if (write_idx != read_idx) {
-                queue->operations[write_idx] = queue->operations[read_idx];
-            }
-            write_idx++;
-        }
-    }
-    queue->count = write_idx;
+    remove_finished(queue, queue->finished_count);
+    refresh_current(queue);
 
     pthread_mutex_unlock(&queue->mutex);
 }
@@ -371,54 +1386,165 @@ void operation_queue_clear_finished(OperationQueue *queue)
 QueuedOperation* operation_queue_get(OperationQueue *queue, int operation_id)
 {
     pthread_mutex_lock(&queue->mutex);
+    sync_progress(queue);
 
-    for (int i = 0; i < queue->count; i++) {
-        if (queue->operations[i].id == operation_id) {
-            pthread_mutex_unlock(&queue->mutex);
-            return &queue->operations[i];
-        }
-    }
+    int index = find_index(queue, operation_id);
+    QueuedOperation *op = index >= 0 ? op_at(queue, index) : NULL;
 
     pthread_mutex_unlock(&queue->mutex);
-    return NULL;
+    return op;
 }
 
 QueuedOperation* operation_queue_current(OperationQueue *queue)
 {
     pthread_mutex_lock(&queue->mutex);
 
+    sync_progress(queue);
     QueuedOperation *current = NULL;
     if (queue->current_index >= 0 && queue->current_index < queue->count) {
-        current = &queue->operations[queue->current_index];
+        current = op_at(queue, queue->current_index);
     }
 
     pthread_mutex_unlock(&queue->mutex);
     return current;
 }
 
-int operation_queue_pending_count(OperationQueue *queue)
+int operation_queue_rows(OperationQueue *queue, int first, QueueRow *rows, int max)
 {
     pthread_mutex_lock(&queue->mutex);
+    sync_progress(queue);
 
-    int count = 0;
-    for (int i = 0; i < queue->count; i++) {
-        if (queue->operations[i].status == OP_STATUS_PENDING) {
-            count++;
-        }
+    int n = 0;
+    for (int i = first > 0 ? first : 0; i < queue->count && n < max; i++) {
+        fill_row(&rows[n++], op_at(queue, i));
     }
 
     pthread_mutex_unlock(&queue->mutex);
-    return count;
+    return n;
 }
 
-int operation_queue_total_count(OperationQueue *queue)
+int operation_queue_history_count(OperationQueue *queue)
 {
     pthread_mutex_lock(&queue->mutex);
-    int count = queue->count;
+    int count = queue->history_spilled + queue->history_count;
     pthread_mutex_unlock(&queue->mutex);
     return count;
 }
 
+int operation_queue_history_page(OperationQueue *queue, int first, QueueRow *rows, int max)
+{
+    if (first < 0) first = 0;
+    if (max <= 0) return 0;
+
+    pthread_mutex_lock(&queue->mutex);
+
+    // The file holds the oldest records, in order, ahead of the in-memory ones
+    int n = 0;
+    if (first < queue->history_spilled) {
+        int want = queue->history_spilled - first < max ? queue->history_spilled - first : max;
+        if (fseek(queue->history_file, (long)first * (long)sizeof(QueueRow), SEEK_SET) == 0) {
+            n = (int)fread(rows, sizeof(QueueRow), (size_t)want, queue->history_file);
+        }
+        if (n < want) {
+            pthread_mutex_unlock(&queue->mutex);
+            return n;
+        }
+    }
+    for (int i = first + n - queue->history_spilled; n < max && i < queue->history_count; i++) {
+        rows[n++] = queue->history[(queue->history_head + i) % QUEUE_MAX_HISTORY];
+    }
+
+    pthread_mutex_unlock(&queue->mutex);
+    return n;
+}
+
+void operation_queue_status(OperationQueue *queue, QueueStatus *status)
+{
+    QueueSnapshot *snap = &queue->snapshot;
+    int settled;
+    int running_ids[QUEUE_MAX_WORKERS];
+    long long running_totals[QUEUE_MAX_WORKERS];
+    int current_type;
+
+    for (;;) {
+        unsigned seq = atomic_load_explicit(&snap->seq, memory_order_acquire);
+        if (seq & 1) {
+            continue;   // A publish is a few hundred stores; spin through it
+        }
+
+        status->pending_count = atomic_load_explicit(&snap->pending_count, memory_order_relaxed);
+        status->total_count = atomic_load_explicit(&snap->total_count, memory_order_relaxed);
+        status->is_processing = atomic_load_explicit(&snap->is_processing, memory_order_relaxed);
+        status->is_paused = atomic_load_explicit(&snap->is_paused, memory_order_relaxed);
+        settled = atomic_load_explicit(&snap->settled_progress, memory_order_relaxed);
+        current_type = atomic_load_explicit(&snap->current_type, memory_order_relaxed);
+        for (int c = 0; c < QUEUE_MAX_WORKERS; c++) {
+            running_ids[c] = atomic_load_explicit(&snap->running_ids[c], memory_order_relaxed);
+            running_totals[c] = atomic_load_explicit(&snap->running_totals[c], memory_order_relaxed);
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&snap->seq, memory_order_relaxed) == seq) {
+            break;
+        }
+    }
+
+    status->has_current = current_type >= 0;
+    status->current_type = status->has_current ? (QueueOpType)current_type : QUEUE_OP_COPY;
+
+    // Byte counts of running operations move between publishes; read them live
+    if (status->total_count == 0) {
+        status->progress = 100;
+        return;
+    }
+    int sum = settled;
+    for (int c = 0; c < QUEUE_MAX_WORKERS; c++) {
+        if (running_ids[c] != 0) {
+            sum += control_progress(queue, c, running_totals[c]);
+        }
+    }
+    status->progress = sum / status->total_count;
+}
+
+int operation_queue_operation_progress(OperationQueue *queue, int operation_id)
+{
+    QueueSnapshot *snap = &queue->snapshot;
+    for (;;) {
+        unsigned seq = atomic_load_explicit(&snap->seq, memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        }
+
+        int found = -1;
+        long long total = 0;
+        for (int c = 0; c < QUEUE_MAX_WORKERS && found < 0; c++) {
+            if (atomic_load_explicit(&snap->running_ids[c], memory_order_relaxed) == operation_id) {
+                found = c;
+                total = atomic_load_explicit(&snap->running_totals[c], memory_order_relaxed);
+            }
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&snap->seq, memory_order_relaxed) == seq) {
+            return found < 0 ? -1 : control_progress(queue, found, total);
+        }
+    }
+}
+
+int operation_queue_pending_count(OperationQueue *queue)
+{
+    QueueStatus status;
+    operation_queue_status(queue, &status);
+    return status.pending_count;
+}
+
+int operation_queue_total_count(OperationQueue *queue)
+{
+    QueueStatus status;
+    operation_queue_status(queue, &status);
+    return status.total_count;
+}
+
 bool operation_queue_is_empty(OperationQueue *queue)
 {
     return operation_queue_total_count(queue) == 0;
@@ -426,36 +1552,23 @@ bool operation_queue_is_empty(OperationQueue *queue)
 
 bool operation_queue_is_paused(OperationQueue *queue)
 {
-    pthread_mutex_lock(&queue->mutex);
-    bool paused = queue->is_paused;
-    pthread_mutex_unlock(&queue->mutex);
-    return paused;
+    QueueStatus status;
+    operation_queue_status(queue, &status);
+    return status.is_paused;
 }
 
 bool operation_queue_is_processing(OperationQueue *queue)
 {
-    pthread_mutex_lock(&queue->mutex);
-    bool processing = queue->is_processing;
-    pthread_mutex_unlock(&queue->mutex);
-    return processing;
+    QueueStatus status;
+    operation_queue_status(queue, &status);
+    return status.is_processing;
 }
 
 int operation_queue_overall_progress(OperationQueue *queue)
 {
-    pthread_mutex_lock(&queue->mutex);
-
-    if (queue->count == 0) {
-        pthread_mutex_unlock(&queue->mutex);
-        return 100;
-    }
-
-    int total_progress = 0;
-    for (int i = 0; i < queue->count; i++) {
-        total_progress += queue->operations[i].progress;
-    }
-
-    pthread_mutex_unlock(&queue->mutex);
-    return total_progress / queue->count;
+    QueueStatus status;
+    operation_queue_status(queue, &status);
+    return status.progress;
 }
 
 const char* queue_op_type_name(QueueOpType type)
@@ -467,6 +1580,9 @@ const char* queue_op_type_name(QueueOpType type)
         case QUEUE_OP_RENAME:     return "Rename";
         case QUEUE_OP_CREATE_DIR: return "Create Folder";
         case QUEUE_OP_DUPLICATE:  return "Duplicate";
+        case QUEUE_OP_SYNC:       return "Sync";
+        case QUEUE_OP_MOVE_BATCH: return "Reorganize";
+        case QUEUE_OP_REMOVE:     return "Erase";
         default: return "Unknown";
     }
 }
@@ -5,12 +5,41 @@
 #include <stddef.h>
 #include <time.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
 #include <sys/types.h>
+#include "operations.h"
+#include "move_batch.h"
+#include "dir_size.h"
+#include "volumes.h"
 
-#define QUEUE_MAX_OPERATIONS 256
 #define QUEUE_PATH_MAX_LEN 4096
+#define QUEUE_INITIAL_CAPACITY 64
+
+// Finished operations kept in memory; older history goes to the history file
 #define QUEUE_MAX_HISTORY 64
 
+// Finished operations left listed in the queue before the oldest drop out
+#define QUEUE_MAX_FINISHED 512
+
+// Pending operations considered per scheduling pass
+#define QUEUE_SCAN_WINDOW 256
+
+// Pending deletes on one device sent to the Trash together
+#define QUEUE_DELETE_BATCH 256
+
+// Path length kept in rows and history records
+#define QUEUE_ROW_PATH_LEN 512
+
+// Worker threads; operations on different devices run in parallel, one at a time per device
+#define QUEUE_MAX_WORKERS 4
+
+// Devices an operation can touch (source and destination)
+#define QUEUE_MAX_OP_DEVICES 2
+
+// Logs of tombstones made by a run: QUEUE_TOMBSTONE_LOG "<pid>.log"
+#define QUEUE_TOMBSTONE_LOG "tombstones-"
+
 // Queue operation types (distinct from clipboard OperationType in operations.h)
 typedef enum QueueOpType {
     QUEUE_OP_COPY,
@@ -18,7 +47,10 @@ typedef enum QueueOpType {
     QUEUE_OP_DELETE,
     QUEUE_OP_RENAME,
     QUEUE_OP_CREATE_DIR,
-    QUEUE_OP_DUPLICATE
+    QUEUE_OP_DUPLICATE,
+    QUEUE_OP_SYNC,
+    QUEUE_OP_MOVE_BATCH,                    // source_path: folder it works in, dest_path: journal
+    QUEUE_OP_REMOVE                         // Delete for good; target_path: tombstone, if moved aside
 } QueueOpType;
 
 // Operation status
@@ -30,43 +62,126 @@ typedef enum OperationStatus {
     OP_STATUS_CANCELLED
 } OperationStatus;
 
-// Single queued operation
+// Single queued operation. Strings are interned in the queue (shared, never NULL)
 typedef struct QueuedOperation {
-    int id;                                 // Unique operation ID
+    int id;                                 // Unique operation ID, increasing in queue order
     QueueOpType type;
     OperationStatus status;
-    char source_path[QUEUE_PATH_MAX_LEN];   // Source file/folder
-    char dest_path[QUEUE_PATH_MAX_LEN];     // Destination (for copy/move/rename)
+    const char *source_path;                // Source file/folder
+    const char *dest_path;                  // Destination (for copy/move/rename)
+    const char *target_path;                // Resolved copy/move/duplicate destination, kept so a retry resumes into it
+    const char *error_message;              // Error message if failed
     off_t total_bytes;                      // Total bytes to process
     off_t processed_bytes;                  // Bytes processed so far
     int progress;                           // Progress 0-100
-    char error_message[256];                // Error message if failed
     time_t created_at;                      // When operation was created
     time_t started_at;                      // When operation started
     time_t completed_at;                    // When operation completed
     bool can_retry;                         // Can this operation be retried
+    SyncMode sync_mode;                     // How a sync reconciles source and dest
+    bool sync_by_content;                   // Sync compares same-size files by hash
+    dev_t devices[QUEUE_MAX_OP_DEVICES];    // Devices read or written (st_dev)
+    int device_count;
 } QueuedOperation;
 
+// Self-contained copy of an operation, for drawing and history
+typedef struct QueueRow {
+    int id;
+    QueueOpType type;
+    OperationStatus status;
+    int progress;
+    bool can_retry;
+    time_t completed_at;
+    char source_path[QUEUE_ROW_PATH_LEN];
+    char error_message[128];
+} QueueRow;
+
+// Interned string pool (opaque)
+typedef struct QueueStringPool QueueStringPool;
+
+// Queue summary for drawing, from one consistent lock-free read
+typedef struct QueueStatus {
+    int pending_count;
+    int total_count;
+    bool is_processing;
+    bool is_paused;
+    int progress;                           // Overall progress 0-100
+    bool has_current;
+    QueueOpType current_type;               // Earliest running operation, if has_current
+} QueueStatus;
+
+// Published under the mutex on every state change; readers retry while seq is odd
+// or changes under them, so the UI never waits on a worker
+typedef struct QueueSnapshot {
+    atomic_uint seq;
+    atomic_int pending_count;
+    atomic_int total_count;
+    atomic_bool is_processing;
+    atomic_bool is_paused;
+    atomic_int settled_progress;            // Summed progress of operations not running
+    atomic_int current_type;                // -1 when idle
+    atomic_int running_ids[QUEUE_MAX_WORKERS];       // Operation using each control, 0 when free
+    atomic_llong running_totals[QUEUE_MAX_WORKERS];  // Its total_bytes
+} QueueSnapshot;
+
 // Operation queue state
 typedef struct OperationQueue {
-    QueuedOperation operations[QUEUE_MAX_OPERATIONS];
+    // Ring of operations in id order: index i is operations[(head + i) % capacity]
+    QueuedOperation *operations;
+    int capacity;
+    int head;
     int count;
     int next_id;
     bool is_paused;
     bool is_processing;
 
-    // Current operation being processed
+    // Kept up to date on every status change, so nothing rescans the queue
+    int pending_count;
+    int finished_count;
+    int settled_progress;                   // Summed progress of operations not running
+    int scan_from;                          // No pending operation before this index
+
+    QueueStringPool *strings;
+    DirSizes *dir_sizes;                    // Folder totals come from here when set
+    Volumes *volumes;                       // Devices come from here when set
+
+    // Earliest operation being processed (-1 when idle)
     int current_index;
+    int active_count;
+
+    // Devices held by running operations
+    dev_t busy_devices[QUEUE_MAX_WORKERS * QUEUE_MAX_OP_DEVICES];
+    int busy_count;
+
+    // Progress and cancel/pause flags of running operations
+    CopyControl controls[QUEUE_MAX_WORKERS];
+    int control_ids[QUEUE_MAX_WORKERS];     // Operation using each control, 0 when free
+
+    // What the status functions read without the mutex
+    QueueSnapshot snapshot;
 
-    // History of completed operations
-    QueuedOperation history[QUEUE_MAX_HISTORY];
+    // Recent finished operations; older ones are appended to history_file
+    QueueRow history[QUEUE_MAX_HISTORY];    // Ring starting at history_head
+    int history_head;
     int history_count;
+    int history_spilled;                    // Records in history_file
+    FILE *history_file;
+
+    // Tombstones made by this run, so a run that dies before removing them has them put
+    // back by the next (NULL: not logged)
+    FILE *tombstone_log;
+    char tombstone_log_path[QUEUE_PATH_MAX_LEN];
 
     // Thread synchronization
     pthread_mutex_t mutex;
-    pthread_t worker_thread;
+    pthread_cond_t cond;                    // New work, resume, stop, or a device freed up
+    pthread_t workers[QUEUE_MAX_WORKERS];
+    int worker_count;
     bool worker_running;
     bool should_stop;
+
+    // Paste jobs still adding clipboard items (NULL until the first paste)
+    struct JobToken *paste_feeds;
 } OperationQueue;
 
 // Initialize operation queue
@@ -75,21 +190,60 @@ void operation_queue_init(OperationQueue *queue);
 // Free operation queue resources
 void operation_queue_free(OperationQueue *queue);
 
-// Start the background worker thread
+// Keep history beyond QUEUE_MAX_HISTORY in a file (rewritten for this session)
+bool operation_queue_set_history_file(OperationQueue *queue, const char *path);
+
+// Log tombstones (see operation_queue_remove) in dir, and put back the items the logs of
+// runs no longer going name: a run that quits puts back removals that never ran, one
+// that crashed cannot. Items whose names were taken since stay aside and are reported.
+// Returns how many were put back
+int operation_queue_set_tombstone_dir(OperationQueue *queue, const char *dir);
+
+// Take folder totals from the shared size cache instead of walking each source
+void operation_queue_set_dir_sizes(OperationQueue *queue, DirSizes *sizes);
+
+// Group operations by device from the volume service's mount table instead of stat
+void operation_queue_set_volumes(OperationQueue *queue, Volumes *volumes);
+
+// Start the background worker threads
 bool operation_queue_start(OperationQueue *queue);
 
-// Stop the background worker thread
+// Stop the background worker threads (running operations finish first)
 void operation_queue_stop(OperationQueue *queue);
 
+// Add operations; each returns the new ID, or -1 if out of memory
+
 // Add a copy operation to the queue
 int operation_queue_copy(OperationQueue *queue, const char *source, const char *dest);
 
+// Add a copy to exactly dest_path (a file there is overwritten, a folder merged into)
+int operation_queue_copy_to(OperationQueue *queue, const char *source, const char *dest_path);
+
+// Add a sync of dest_path with source (see file_sync_to)
+int operation_queue_sync(OperationQueue *queue, const char *source, const char *dest_path,
+                         SyncMode mode, bool by_content);
+
 // Add a move operation to the queue
 int operation_queue_move(OperationQueue *queue, const char *source, const char *dest);
 
 // Add a delete operation to the queue
 int operation_queue_delete(OperationQueue *queue, const char *path);
 
+// Add a delete that bypasses the Trash (see file_remove). With in_background the item is
+// first moved aside to a hidden tombstone, so it leaves its folder before this returns;
+// -1 if that fails. A removal cancelled, failed or never run puts what is left of the
+// item back
+int operation_queue_remove(OperationQueue *queue, const char *path, bool in_background);
+
+// Add a copy (a move if cut) of every clipboard item into dest_dir. A background job
+// adds them, so a paste of thousands of files never waits on sizing each one; a cut
+// clipboard is emptied. Returns how many items were handed over
+int operation_queue_paste(OperationQueue *queue, ClipboardState *clipboard, const char *dest_dir);
+
+// Add a batch of moves saved with move_batch_save, run as one operation whose progress
+// counts moves. root is the folder they happen in; a retry resumes from the journal
+int operation_queue_move_batch(OperationQueue *queue, const char *journal_path, const char *root);
+
 // Add a rename operation to the queue
 int operation_queue_rename(OperationQueue *queue, const char *source, const char *new_name);
 
@@ -99,30 +253,45 @@ int operation_queue_create_dir(OperationQueue *queue, const char *parent, const
 // Add a duplicate operation to the queue
 int operation_queue_duplicate(OperationQueue *queue, const char *source);
 
-// Pause the queue
+// Pause the queue (running copies hold at their next chunk)
 void operation_queue_pause(OperationQueue *queue);
 
 // Resume the queue
 void operation_queue_resume(OperationQueue *queue);
 
-// Cancel a specific operation
+// Cancel a specific operation; a running copy stops at its next chunk
 bool operation_queue_cancel(OperationQueue *queue, int operation_id);
 
-// Cancel all pending operations
+// Cancel all pending and running operations
 void operation_queue_cancel_all(OperationQueue *queue);
 
-// Retry a failed operation
+// Retry a failed or cancelled operation; copies resume where they stopped
 bool operation_queue_retry(OperationQueue *queue, int operation_id);
 
 // Remove completed/cancelled/failed operations from queue
 void operation_queue_clear_finished(OperationQueue *queue);
 
-// Get operation by ID
+// Get operation by ID (valid until the queue next changes)
 QueuedOperation* operation_queue_get(OperationQueue *queue, int operation_id);
 
-// Get current operation being processed
+// Get the earliest operation being processed (valid until the queue next changes)
 QueuedOperation* operation_queue_current(OperationQueue *queue);
 
+// Copy up to max operations starting at queue index first; returns how many
+int operation_queue_rows(OperationQueue *queue, int first, QueueRow *rows, int max);
+
+// Finished operations recorded, in memory and in the history file
+int operation_queue_history_count(OperationQueue *queue);
+
+// Copy up to max history records, oldest first from index first; returns how many
+int operation_queue_history_page(OperationQueue *queue, int first, QueueRow *rows, int max);
+
+// Get the queue summary without blocking (for per-frame drawing)
+void operation_queue_status(OperationQueue *queue, QueueStatus *status);
+
+// Progress 0-100 of a running operation without blocking, -1 if it is not running
+int operation_queue_operation_progress(OperationQueue *queue, int operation_id);
+
 // Get pending count
 int operation_queue_pending_count(OperationQueue *queue);
 
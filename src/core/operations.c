@@ -1,47 +1,146 @@
 #include "operations.h"
 #include "filesystem.h"
+#include "undo_log.h"
+#include "stat_cache.h"
+#include "archive.h"
 #include "../platform/clipboard.h"
 #include "../platform/trash.h"
+#include "../utils/file_hash.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <dirent.h>
 #include <libgen.h>
+#include <pthread.h>
 #include <copyfile.h>
+#include <sys/clonefile.h>
 
-// Error message buffer
-static char g_error_message[512] = {0};
+// Copy chunk size: large sequential transfers, with progress, pause and cancel
+// handled between chunks
+#define COPY_BUFFER_SIZE (1024 * 1024)
+#define COPY_BUFFER_ALIGN 4096
+#define COPY_PAUSE_POLL_US 50000
+
+// Directory trees are copied by a walker feeding file workers: with many small
+// files the per-file syscalls, not bandwidth, are the cost
+#define COPY_THREADS_MAX 8
+#define COPY_PENDING_MAX 1024       // Files queued ahead of the workers
+
+// Verified moves hash source and copy in parallel from this size
+#define COPY_VERIFY_PARALLEL_BYTES (8 * 1024 * 1024)
+
+// Error message buffer, per thread: queue workers run operations concurrently
+static __thread char g_error_message[512] = {0};
+static __thread char g_result_path[4096] = {0};
+
+static atomic_bool g_verify_moves = true;
 
 void clipboard_init(ClipboardState *clipboard)
 {
-    clipboard->count = 0;
+    memset(clipboard, 0, sizeof(ClipboardState));
     clipboard->operation = OP_NONE;
+    clipboard->system_change = -1;
+}
+
+void clipboard_free(ClipboardState *clipboard)
+{
+    free(clipboard->paths);
+    free(clipboard->offsets);
+    string_set_free(&clipboard->set);
+    clipboard_init(clipboard);
 }
 
 void clipboard_clear(ClipboardState *clipboard)
 {
+    string_set_clear(&clipboard->set);
+    clipboard->paths_size = 0;
     clipboard->count = 0;
     clipboard->operation = OP_NONE;
 }
 
-// Helper to set clipboard with paths and sync to system
-static void clipboard_set(ClipboardState *clipboard, const char **paths, int count, OperationType op)
+// Helper: Item index as the string set's key
+static const char *clipboard_key(const void *clipboard, int index)
+{
+    return clipboard_path(clipboard, index);
+}
+
+void clipboard_begin(ClipboardState *clipboard, OperationType op)
 {
     clipboard_clear(clipboard);
     clipboard->operation = op;
+}
 
-    for (int i = 0; i < count && i < MAX_CLIPBOARD_ITEMS; i++) {
-        strncpy(clipboard->paths[i], paths[i], MAX_PATH_LENGTH - 1);
-        clipboard->paths[i][MAX_PATH_LENGTH - 1] = '\0';
-        clipboard->count++;
+bool clipboard_add(ClipboardState *clipboard, const char *path)
+{
+    size_t len = strlen(path) + 1;
+    if (string_set_find(&clipboard->set, path, len - 1, clipboard_key, clipboard) >= 0) {
+        return true;
+    }
+
+    if (clipboard->paths_size + len > clipboard->paths_capacity) {
+        size_t capacity = clipboard->paths_capacity ? clipboard->paths_capacity * 2 : CLIPBOARD_INITIAL_ITEMS * 256;
+        while (capacity < clipboard->paths_size + len) {
+            capacity *= 2;
+        }
+        char *paths = realloc(clipboard->paths, capacity);
+        if (!paths) {
+            return false;
+        }
+        clipboard->paths = paths;
+        clipboard->paths_capacity = capacity;
+    }
+    if (clipboard->count == clipboard->capacity) {
+        int capacity = clipboard->capacity ? clipboard->capacity * 2 : CLIPBOARD_INITIAL_ITEMS;
+        size_t *offsets = realloc(clipboard->offsets, (size_t)capacity * sizeof(size_t));
+        if (!offsets) {
+            return false;
+        }
+        clipboard->offsets = offsets;
+        clipboard->capacity = capacity;
+    }
+    if (!string_set_add(&clipboard->set, clipboard->count, path, len - 1)) {
+        return false;
+    }
+
+    memcpy(clipboard->paths + clipboard->paths_size, path, len);
+    clipboard->offsets[clipboard->count] = clipboard->paths_size;
+    clipboard->paths_size += len;
+    clipboard->count++;
+    return true;
+}
+
+void clipboard_publish(ClipboardState *clipboard)
+{
+    // Sync to system clipboard for cross-app paste
+    const char **paths = malloc((size_t)(clipboard->count > 0 ? clipboard->count : 1) * sizeof(char *));
+    if (!paths) {
+        return;
+    }
+    for (int i = 0; i < clipboard->count; i++) {
+        paths[i] = clipboard_path(clipboard, i);
+    }
+    platform_clipboard_copy_files(paths, clipboard->count);
+    clipboard->system_change = platform_clipboard_change_count();
+    free(paths);
+}
+
+static void clipboard_set(ClipboardState *clipboard, const char **paths, int count, OperationType op)
+{
+    clipboard_begin(clipboard, op);
+    for (int i = 0; i < count; i++) {
+        if (!clipboard_add(clipboard, paths[i])) {
+            break;
+        }
     }
 
     // Sync to system clipboard for cross-app paste
     platform_clipboard_copy_files(paths, count);
+    clipboard->system_change = platform_clipboard_change_count();
 }
 
 void clipboard_copy(ClipboardState *clipboard, const char **paths, int count)
@@ -54,46 +153,39 @@ void clipboard_cut(ClipboardState *clipboard, const char **paths, int count)
     clipboard_set(clipboard, paths, count, OP_CUT);
 }
 
-bool clipboard_has_items(ClipboardState *clipboard)
+bool clipboard_has_items(const ClipboardState *clipboard)
 {
     return clipboard->count > 0 && clipboard->operation != OP_NONE;
 }
 
-bool clipboard_contains(ClipboardState *clipboard, const char *path)
+bool clipboard_contains(const ClipboardState *clipboard, const char *path)
 {
-    for (int i = 0; i < clipboard->count; i++) {
-        if (strcmp(clipboard->paths[i], path) == 0) {
-            return true;
-        }
-    }
-    return false;
+    return string_set_find(&clipboard->set, path, strlen(path), clipboard_key, clipboard) >= 0;
+}
+
+// Helper: Add one path read off the system pasteboard
+static bool clipboard_take_system_file(const char *path, void *context)
+{
+    return clipboard_add(context, path);
 }
 
 void clipboard_sync_from_system(ClipboardState *clipboard)
 {
-    // Check if system clipboard has files
-    if (!platform_clipboard_has_files()) {
+    // Still what we put there: ours is the same list, and knows if it was a cut
+    if (platform_clipboard_change_count() == clipboard->system_change) {
         return;
     }
 
-    // Get count from system clipboard
-    int sys_count = platform_clipboard_get_file_count();
-    if (sys_count <= 0) {
+    // Check if system clipboard has files
+    if (!platform_clipboard_has_files()) {
         return;
     }
 
-    // Clear internal clipboard and import from system
-    clipboard_clear(clipboard);
-    clipboard->operation = OP_COPY; // Treat as copy (we don't know if source was cut)
-
-    for (int i = 0; i < sys_count && i < MAX_CLIPBOARD_ITEMS; i++) {
-        const char *path = platform_clipboard_get_file_path(i);
-        if (path) {
-            strncpy(clipboard->paths[i], path, MAX_PATH_LENGTH - 1);
-            clipboard->paths[i][MAX_PATH_LENGTH - 1] = '\0';
-            clipboard->count++;
-        }
-    }
+    // Clear internal clipboard and import from system, path by path as the pasteboard
+    // is read
+    clipboard_begin(clipboard, OP_COPY); // Treat as copy (we don't know if source was cut)
+    platform_clipboard_each_file(clipboard_take_system_file, clipboard);
+    clipboard->system_change = platform_clipboard_change_count();
 }
 
 bool clipboard_copy_paths_as_text(ClipboardState *clipboard)
@@ -102,23 +194,14 @@ bool clipboard_copy_paths_as_text(ClipboardState *clipboard)
         return false;
     }
 
-    // Calculate required size (paths + newlines + null)
-    size_t total_size = 0;
-    for (int i = 0; i < clipboard->count; i++) {
-        total_size += strlen(clipboard->paths[i]) + 1;  // +1 for newline
-    }
-
-    char *text_buffer = malloc(total_size + 1);
+    // The interned paths are already "path\0path\0...": NULs become newlines
+    char *text_buffer = malloc(clipboard->paths_size);
     if (!text_buffer) return false;
 
-    char *ptr = text_buffer;
-    for (int i = 0; i < clipboard->count; i++) {
-        if (i > 0) *ptr++ = '\n';
-        size_t len = strlen(clipboard->paths[i]);
-        memcpy(ptr, clipboard->paths[i], len);
-        ptr += len;
+    memcpy(text_buffer, clipboard->paths, clipboard->paths_size);
+    for (size_t i = 0; i + 1 < clipboard->paths_size; i++) {
+        if (text_buffer[i] == '\0') text_buffer[i] = '\n';
     }
-    *ptr = '\0';
 
     bool result = platform_clipboard_copy_text(text_buffer);
     free(text_buffer);
@@ -130,6 +213,20 @@ const char* operations_get_error(void)
     return g_error_message;
 }
 
+const char* operations_get_result_path(void)
+{
+    return g_result_path;
+}
+
+// Helper: Note where a successful operation left its item
+static OperationResult set_result_path(OperationResult result, const char *path)
+{
+    if (result == OP_SUCCESS) {
+        snprintf(g_result_path, sizeof(g_result_path), "%s", path);
+    }
+    return result;
+}
+
 // Helper to check if path exists
 static bool path_exists(const char *path)
 {
@@ -137,146 +234,1182 @@ static bool path_exists(const char *path)
     return stat(path, &st) == 0;
 }
 
-// Helper to check if path is directory
-static bool is_directory(const char *path)
+// Helper to check if path is directory
+static bool is_directory(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+    return S_ISDIR(st.st_mode);
+}
+
+// Helper to get basename from path
+static const char* get_basename(const char *path)
+{
+    const char *base = strrchr(path, '/');
+    return base ? base + 1 : path;
+}
+
+// Generate unique name for destination
+void generate_unique_name(const char *base_path, char *output, size_t output_size)
+{
+    if (!path_exists(base_path)) {
+        strncpy(output, base_path, output_size - 1);
+        output[output_size - 1] = '\0';
+        return;
+    }
+
+    // Find extension if any
+    const char *basename_part = get_basename(base_path);
+    const char *dot = strrchr(basename_part, '.');
+    size_t base_len = strlen(base_path);
+    size_t ext_len = 0;
+    char ext[64] = {0};
+
+    if (dot && dot != basename_part) {
+        ext_len = strlen(dot);
+        strncpy(ext, dot, sizeof(ext) - 1);
+        base_len = dot - base_path;
+    }
+
+    char base_without_ext[4096];
+    strncpy(base_without_ext, base_path, base_len);
+    base_without_ext[base_len] = '\0';
+
+    // Try adding suffixes until we find a unique name
+    for (int i = 1; i < 10000; i++) {
+        snprintf(output, output_size, "%s (%d)%s", base_without_ext, i, ext);
+        if (!path_exists(output)) {
+            return;
+        }
+    }
+
+    // Fallback - this shouldn't happen
+    strncpy(output, base_path, output_size - 1);
+    output[output_size - 1] = '\0';
+}
+
+// Validate parent dir and name, then build unique path
+static OperationResult validate_and_build_path(const char *parent_dir, const char *name,
+                                                const char *type_name,
+                                                char *unique_path, size_t path_size)
+{
+    if (!is_directory(parent_dir)) {
+        snprintf(g_error_message, sizeof(g_error_message),
+                 "Parent is not a directory: %s", parent_dir);
+        return OP_ERROR_INVALID;
+    }
+
+    if (!name || name[0] == '\0' || strchr(name, '/') != NULL) {
+        snprintf(g_error_message, sizeof(g_error_message),
+                 "Invalid %s name", type_name);
+        return OP_ERROR_INVALID;
+    }
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", parent_dir, name);
+    generate_unique_name(path, unique_path, path_size);
+
+    return OP_SUCCESS;
+}
+
+void copy_control_init(CopyControl *control)
+{
+    // Stores rather than atomic_init: the queue reuses controls the UI may be reading
+    atomic_store(&control->bytes_done, 0);
+    atomic_store(&control->cancel, false);
+    atomic_store(&control->pause, false);
+}
+
+// State of one copy_to call
+typedef struct CopyJob {
+    CopyControl *control;
+    char *buffer;
+    bool try_clone;     // Same volume: clone files until the filesystem says it cannot
+    bool move;          // Delete each source once its copy is done
+    bool verify;        // Compare hashes before deleting a source
+} CopyJob;
+
+void operations_set_verify_moves(bool verify)
+{
+    atomic_store(&g_verify_moves, verify);
+}
+
+// Helper: record a failed step and map errno to a result
+static OperationResult copy_fail(const char *what, const char *path)
+{
+    int err = errno;
+    snprintf(g_error_message, sizeof(g_error_message), "%s %s: %s", what, path, strerror(err));
+    switch (err) {
+        case ENOENT: return OP_ERROR_NOT_FOUND;
+        case EACCES:
+        case EPERM:  return OP_ERROR_PERMISSION;
+        case ENOSPC:
+        case EDQUOT: return OP_ERROR_DISK_FULL;
+        default:     return OP_ERROR_UNKNOWN;
+    }
+}
+
+// Helper: wait out a pause; false once the copy is cancelled
+static bool copy_checkpoint(CopyJob *job)
+{
+    if (job->control == NULL) {
+        return true;
+    }
+    while (atomic_load(&job->control->pause) && !atomic_load(&job->control->cancel)) {
+        usleep(COPY_PAUSE_POLL_US);
+    }
+    if (atomic_load(&job->control->cancel)) {
+        snprintf(g_error_message, sizeof(g_error_message), "Copy cancelled");
+        return false;
+    }
+    return true;
+}
+
+static void copy_add_progress(CopyJob *job, off_t bytes)
+{
+    if (job->control != NULL) {
+        atomic_fetch_add(&job->control->bytes_done, (long long)bytes);
+    }
+}
+
+// Helper: copy metadata once the contents are in place. The mtime goes last, so a
+// destination file whose size and mtime match its source is known to be complete
+static void copy_metadata(const char *source, const char *dest, const struct stat *st)
+{
+    copyfile(source, dest, NULL, COPYFILE_METADATA | COPYFILE_NOFOLLOW);
+
+    struct timespec times[2] = { st->st_atimespec, st->st_mtimespec };
+    if (!S_ISLNK(st->st_mode)) {
+        chmod(dest, st->st_mode & 07777);
+    }
+    utimensat(AT_FDCWD, dest, times, AT_SYMLINK_NOFOLLOW);
+}
+
+static bool copy_is_complete(const struct stat *st, const char *dest)
+{
+    struct stat dest_st;
+    return lstat(dest, &dest_st) == 0 && S_ISREG(dest_st.st_mode) &&
+           dest_st.st_size == st->st_size &&
+           dest_st.st_mtimespec.tv_sec == st->st_mtimespec.tv_sec &&
+           dest_st.st_mtimespec.tv_nsec == st->st_mtimespec.tv_nsec;
+}
+
+// Helper: whether a file has holes worth preserving
+static bool copy_is_sparse(const struct stat *st)
+{
+    return (off_t)st->st_blocks * 512 < st->st_size;
+}
+
+// Helper: start reading the next chunk while this one is written
+static void copy_read_ahead(int fd, off_t offset)
+{
+#if defined(F_RDADVISE)
+    struct radvisory advice = { .ra_offset = offset, .ra_count = COPY_BUFFER_SIZE };
+    fcntl(fd, F_RDADVISE, &advice);
+#elif defined(POSIX_FADV_WILLNEED)
+    posix_fadvise(fd, offset, COPY_BUFFER_SIZE, POSIX_FADV_WILLNEED);
+#else
+    (void)fd;
+    (void)offset;
+#endif
+}
+
+static OperationResult copy_file_contents(CopyJob *job, const char *source, const char *dest, const struct stat *st)
+{
+    if (copy_is_complete(st, dest)) {
+        copy_add_progress(job, st->st_size);
+        return OP_SUCCESS;
+    }
+
+    // On APFS a same-volume copy shares blocks with its source: instant at any size
+    if (job->try_clone) {
+        struct stat dest_st;
+        if (lstat(dest, &dest_st) == 0 && S_ISREG(dest_st.st_mode)) {
+            unlink(dest);   // Incomplete copy from an earlier run
+        }
+        if (clonefile(source, dest, CLONE_NOFOLLOW) == 0) {
+            copy_metadata(source, dest, st);
+            copy_add_progress(job, st->st_size);
+            return OP_SUCCESS;
+        }
+        if (errno == ENOTSUP || errno == EXDEV) {
+            job->try_clone = false;
+        }
+    }
+
+    int in = open(source, O_RDONLY);
+    if (in < 0) {
+        return copy_fail("Cannot open", source);
+    }
+    int out = open(dest, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, 0600);
+    if (out < 0) {
+        OperationResult result = copy_fail("Cannot create", dest);
+        close(in);
+        return result;
+    }
+
+#if defined(F_RDAHEAD)
+    fcntl(in, F_RDAHEAD, 1);
+#elif defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    // Sparse files (VM images, databases) get only their data regions copied;
+    // writes at offsets leave the holes unallocated in the destination
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    bool sparse = copy_is_sparse(st);
+#else
+    bool sparse = false;
+#endif
+    off_t region_end = -1;  // End of the data region being copied, -1 for EOF
+
+    OperationResult result = OP_SUCCESS;
+    off_t offset = 0;
+    while (result == OP_SUCCESS) {
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+        if (sparse && (region_end < 0 || offset >= region_end)) {
+            off_t data = lseek(in, offset, SEEK_DATA);
+            off_t hole = data >= 0 ? lseek(in, data, SEEK_HOLE) : -1;
+            if (data < 0 && errno == ENXIO) {
+                break;  // Only a hole is left
+            }
+            if (data < 0 || hole < 0) {
+                sparse = false;     // Filesystem cannot report holes
+                region_end = -1;
+            } else {
+                copy_add_progress(job, data - offset);
+                offset = data;
+                region_end = hole;
+            }
+        }
+#endif
+
+        if (!copy_checkpoint(job)) {
+            result = OP_ERROR_CANCELLED;
+            break;
+        }
+
+        size_t want = COPY_BUFFER_SIZE;
+        if (region_end >= 0 && region_end - offset < (off_t)want) {
+            want = (size_t)(region_end - offset);
+        }
+        ssize_t got = pread(in, job->buffer, want, offset);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            result = copy_fail("Read failed for", source);
+            break;
+        }
+        if (got == 0) {
+            break;
+        }
+        copy_read_ahead(in, offset + got);
+
+        for (ssize_t written = 0; written < got; ) {
+            ssize_t n = pwrite(out, job->buffer + written, (size_t)(got - written), offset + written);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                result = copy_fail("Write failed for", dest);
+                break;
+            }
+            written += n;
+        }
+        offset += got;
+        copy_add_progress(job, got);
+    }
+
+    // A trailing hole only exists once the length is set
+    if (result == OP_SUCCESS && sparse && offset < st->st_size) {
+        if (ftruncate(out, st->st_size) != 0) {
+            result = copy_fail("Write failed for", dest);
+        } else {
+            copy_add_progress(job, st->st_size - offset);
+        }
+    }
+
+    close(in);
+    if (close(out) != 0 && result == OP_SUCCESS) {
+        result = copy_fail("Write failed for", dest);
+    }
+    if (result == OP_SUCCESS) {
+        copy_metadata(source, dest, st);
+    }
+    return result;
+}
+
+// Helper: hash the copy and its source with the shared hashing engine. Large
+// files are read side by side; small ones are not worth a thread each
+static bool copy_verify(const char *source, const char *dest, const struct stat *st)
+{
+    FileHashJob jobs[2] = { { .path = source }, { .path = dest } };
+    if (st->st_size >= COPY_VERIFY_PARALLEL_BYTES) {
+        file_hash_batch(jobs, 2);
+    } else {
+        jobs[0].ok = file_hash_compute(source, &jobs[0].hash);
+        jobs[1].ok = file_hash_compute(dest, &jobs[1].hash);
+    }
+    return jobs[0].ok && jobs[1].ok && jobs[0].hash == jobs[1].hash;
+}
+
+static OperationResult copy_file(CopyJob *job, const char *source, const char *dest, const struct stat *st)
+{
+    OperationResult result = copy_file_contents(job, source, dest, st);
+    if (result != OP_SUCCESS || !job->move) {
+        return result;
+    }
+
+    if (job->verify && !copy_verify(source, dest, st)) {
+        // A bad copy must not look complete to a resume
+        unlink(dest);
+        snprintf(g_error_message, sizeof(g_error_message), "Copy of %s did not match its source", source);
+        return OP_ERROR_UNKNOWN;
+    }
+
+    // Sources go as soon as their copies are safe, so space frees up during the move
+    if (unlink(source) != 0) {
+        return copy_fail("Cannot remove", source);
+    }
+    return OP_SUCCESS;
+}
+
+static OperationResult copy_symlink(CopyJob *job, const char *source, const char *dest, const struct stat *st)
+{
+    char target[4096];
+    ssize_t length = readlink(source, target, sizeof(target) - 1);
+    if (length < 0) {
+        return copy_fail("Cannot read link", source);
+    }
+    target[length] = '\0';
+
+    // Keep a matching link from an earlier run; replace anything else in the way
+    struct stat dest_st;
+    if (lstat(dest, &dest_st) == 0 && !S_ISDIR(dest_st.st_mode)) {
+        char existing[4096];
+        ssize_t existing_length = S_ISLNK(dest_st.st_mode) ? readlink(dest, existing, sizeof(existing)) : -1;
+        if (existing_length == length && memcmp(existing, target, (size_t)length) == 0) {
+            if (job->move && unlink(source) != 0) {
+                return copy_fail("Cannot remove", source);
+            }
+            return OP_SUCCESS;
+        }
+        unlink(dest);
+    }
+    if (symlink(target, dest) != 0) {
+        return copy_fail("Cannot create link", dest);
+    }
+    copy_metadata(source, dest, st);
+
+    if (job->move && unlink(source) != 0) {
+        return copy_fail("Cannot remove", source);
+    }
+    return OP_SUCCESS;
+}
+
+// One file or directory found by the walk
+typedef struct CopyEntry {
+    char *source;
+    char *dest;
+    struct stat st;
+} CopyEntry;
+
+// A directory copy: the walk creates directories and symlinks and queues files,
+// which workers copy concurrently
+typedef struct CopyPool {
+    CopyControl *control;
+    bool try_clone;
+    bool move;
+    bool verify;
+    int workers;
+
+    CopyEntry pending[COPY_PENDING_MAX];    // Ring of files waiting for a worker
+    int head;
+    int pending_count;
+    bool walk_done;
+
+    CopyEntry *dirs;                        // Walk order; metadata goes on in reverse, children first
+    int dir_count;
+    int dir_capacity;
+
+    OperationResult result;                 // First failure stops everyone
+    char error[512];
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} CopyPool;
+
+// Helper: record the first failure with this thread's error message
+static void copy_pool_fail(CopyPool *pool, OperationResult result)
+{
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->result == OP_SUCCESS) {
+        pool->result = result;
+        snprintf(pool->error, sizeof(pool->error), "%s", g_error_message);
+    }
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static bool copy_pool_failed(CopyPool *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    bool failed = pool->result != OP_SUCCESS;
+    pthread_mutex_unlock(&pool->mutex);
+    return failed;
+}
+
+static void copy_entry_free(CopyEntry *entry)
+{
+    free(entry->source);
+    free(entry->dest);
+}
+
+static void *copy_pool_worker(void *arg)
+{
+    CopyPool *pool = (CopyPool *)arg;
+    CopyJob job = { .control = pool->control, .try_clone = pool->try_clone,
+                    .move = pool->move, .verify = pool->verify };
+
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, COPY_BUFFER_ALIGN, COPY_BUFFER_SIZE) != 0) {
+        snprintf(g_error_message, sizeof(g_error_message), "Out of memory");
+        copy_pool_fail(pool, OP_ERROR_UNKNOWN);
+        return NULL;
+    }
+    job.buffer = buffer;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (pool->result == OP_SUCCESS && pool->pending_count == 0 && !pool->walk_done) {
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+        }
+        if (pool->result != OP_SUCCESS || pool->pending_count == 0) {
+            break;
+        }
+
+        CopyEntry entry = pool->pending[pool->head];
+        pool->head = (pool->head + 1) % COPY_PENDING_MAX;
+        pool->pending_count--;
+        pthread_cond_broadcast(&pool->cond);    // Room for the walker
+        pthread_mutex_unlock(&pool->mutex);
+
+        OperationResult result = copy_file(&job, entry.source, entry.dest, &entry.st);
+        copy_entry_free(&entry);
+        if (result != OP_SUCCESS) {
+            copy_pool_fail(pool, result);
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    free(buffer);
+    return NULL;
+}
+
+// Helper: hand a file to the workers, waiting while they are a full ring behind.
+// Takes ownership of the entry's paths
+static void copy_pool_push(CopyPool *pool, CopyEntry *entry)
+{
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->result == OP_SUCCESS && pool->pending_count == COPY_PENDING_MAX) {
+        pthread_cond_wait(&pool->cond, &pool->mutex);
+    }
+    if (pool->result != OP_SUCCESS) {
+        pthread_mutex_unlock(&pool->mutex);
+        copy_entry_free(entry);
+        return;
+    }
+    pool->pending[(pool->head + pool->pending_count) % COPY_PENDING_MAX] = *entry;
+    pool->pending_count++;
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+// Helper: remember a directory for metadata once its files are in
+static bool copy_pool_add_dir(CopyPool *pool, const char *source, const char *dest, const struct stat *st)
+{
+    if (pool->dir_count >= pool->dir_capacity) {
+        int capacity = pool->dir_capacity > 0 ? pool->dir_capacity * 2 : 64;
+        CopyEntry *dirs = realloc(pool->dirs, (size_t)capacity * sizeof(CopyEntry));
+        if (dirs == NULL) {
+            return false;
+        }
+        pool->dirs = dirs;
+        pool->dir_capacity = capacity;
+    }
+
+    CopyEntry *entry = &pool->dirs[pool->dir_count];
+    entry->source = strdup(source);
+    entry->dest = strdup(dest);
+    entry->st = *st;
+    if (entry->source == NULL || entry->dest == NULL) {
+        copy_entry_free(entry);
+        return false;
+    }
+    pool->dir_count++;
+    return true;
+}
+
+// Walk a directory: create it, recreate symlinks, queue files, recurse. Runs on
+// the calling thread, so directories always exist before their files are copied
+static OperationResult copy_walk(CopyPool *pool, CopyJob *walker, const char *source, const char *dest,
+                                 const struct stat *st)
+{
+    // Owner-writable until the children are in; the real mode is applied after
+    if (mkdir(dest, 0700) != 0) {
+        struct stat dest_st;
+        if (errno != EEXIST || stat(dest, &dest_st) != 0 || !S_ISDIR(dest_st.st_mode)) {
+            return copy_fail("Cannot create directory", dest);
+        }
+    }
+    if (!copy_pool_add_dir(pool, source, dest, st)) {
+        snprintf(g_error_message, sizeof(g_error_message), "Out of memory");
+        return OP_ERROR_UNKNOWN;
+    }
+
+    DIR *dir = opendir(source);
+    if (!dir) {
+        return copy_fail("Cannot open directory", source);
+    }
+
+    OperationResult result = OP_SUCCESS;
+    struct dirent *entry;
+    while (result == OP_SUCCESS && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (!copy_checkpoint(walker)) {
+            result = OP_ERROR_CANCELLED;
+            break;
+        }
+        if (copy_pool_failed(pool)) {
+            break;
+        }
+
+        char child_source[4096];
+        char child_dest[4096];
+        if (snprintf(child_source, sizeof(child_source), "%s/%s", source, entry->d_name) >= (int)sizeof(child_source) ||
+            snprintf(child_dest, sizeof(child_dest), "%s/%s", dest, entry->d_name) >= (int)sizeof(child_dest)) {
+            errno = ENAMETOOLONG;
+            result = copy_fail("Cannot copy", child_source);
+            break;
+        }
+
+        struct stat child_st;
+        if (lstat(child_source, &child_st) != 0) {
+            result = copy_fail("Cannot stat", child_source);
+        } else if (S_ISDIR(child_st.st_mode)) {
+            result = copy_walk(pool, walker, child_source, child_dest, &child_st);
+        } else if (S_ISLNK(child_st.st_mode)) {
+            result = copy_symlink(walker, child_source, child_dest, &child_st);
+        } else if (S_ISREG(child_st.st_mode)) {
+            if (pool->workers == 0) {
+                result = copy_file(walker, child_source, child_dest, &child_st);
+                continue;
+            }
+            CopyEntry file = { .source = strdup(child_source), .dest = strdup(child_dest), .st = child_st };
+            if (file.source == NULL || file.dest == NULL) {
+                copy_entry_free(&file);
+                snprintf(g_error_message, sizeof(g_error_message), "Out of memory");
+                result = OP_ERROR_UNKNOWN;
+                break;
+            }
+            copy_pool_push(pool, &file);
+        }
+        // Sockets, FIFOs and devices are not copied
+    }
+    closedir(dir);
+    return result;
+}
+
+static int copy_default_threads(void)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+    if (cores > COPY_THREADS_MAX) cores = COPY_THREADS_MAX;
+    return (int)cores;
+}
+
+static OperationResult copy_directory(CopyJob *walker, const char *source, const char *dest, const struct stat *st)
+{
+    CopyPool *pool = calloc(1, sizeof(CopyPool));
+    if (pool == NULL) {
+        snprintf(g_error_message, sizeof(g_error_message), "Out of memory");
+        return OP_ERROR_UNKNOWN;
+    }
+    pool->control = walker->control;
+    pool->try_clone = walker->try_clone;
+    pool->move = walker->move;
+    pool->verify = walker->verify;
+    pool->result = OP_SUCCESS;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+
+    // The walker joins the workers once it is done, so one thread fewer is started
+    pthread_t threads[COPY_THREADS_MAX];
+    int wanted = copy_default_threads() - 1;
+    for (int i = 0; i < wanted; i++) {
+        if (pthread_create(&threads[pool->workers], NULL, copy_pool_worker, pool) != 0) {
+            break;  // Run with however many threads we got
+        }
+        pool->workers++;
+    }
+
+    OperationResult result = copy_walk(pool, walker, source, dest, st);
+    if (result != OP_SUCCESS) {
+        copy_pool_fail(pool, result);
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->walk_done = true;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    copy_pool_worker(pool);
+    for (int i = 0; i < pool->workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Files left queued after a failure
+    while (pool->pending_count > 0) {
+        copy_entry_free(&pool->pending[pool->head]);
+        pool->head = (pool->head + 1) % COPY_PENDING_MAX;
+        pool->pending_count--;
+    }
+
+    // Directory metadata in one pass, deepest first so parents get their times last.
+    // A move also drops source directories, now empty unless they held special files
+    result = pool->result;
+    for (int i = pool->dir_count - 1; i >= 0; i--) {
+        if (result == OP_SUCCESS) {
+            copy_metadata(pool->dirs[i].source, pool->dirs[i].dest, &pool->dirs[i].st);
+            if (pool->move) {
+                rmdir(pool->dirs[i].source);
+            }
+        }
+        copy_entry_free(&pool->dirs[i]);
+    }
+    if (result != OP_SUCCESS) {
+        snprintf(g_error_message, sizeof(g_error_message), "%s", pool->error);
+    }
+
+    free(pool->dirs);
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+    return result;
+}
+
+// Helper: whether dest_path would be created on the source's volume
+static bool copy_same_device(const char *source, const char *dest_path)
+{
+    char parent[4096];
+    snprintf(parent, sizeof(parent), "%s", dest_path);
+    char *last_slash = strrchr(parent, '/');
+    if (last_slash == NULL) {
+        strcpy(parent, ".");
+    } else if (last_slash == parent) {
+        parent[1] = '\0';
+    } else {
+        *last_slash = '\0';
+    }
+
+    struct stat source_st, parent_st;
+    return lstat(source, &source_st) == 0 && stat(parent, &parent_st) == 0 &&
+           source_st.st_dev == parent_st.st_dev;
+}
+
+// Helper: whether path names a member of an archive (core/archive.h), not a file on disk
+static bool is_archive_member(const char *path)
+{
+    char archive_path[4096];
+    const char *inner;
+    return !path_exists(path) && archive_split_path(path, archive_path, sizeof(archive_path), &inner) &&
+           inner[0] != '\0';
+}
+
+// Helper: extract item index of archive, a file or a folder with everything below it, to
+// dest. Files already complete at dest are skipped as for any copy; links are not made
+static OperationResult copy_archive_item(CopyJob *job, Archive *archive, int index, const char *dest)
+{
+    ArchiveEntry member;
+    archive_entry(archive, index, &member);
+    if (!copy_checkpoint(job)) {
+        return OP_ERROR_CANCELLED;
+    }
+    if (S_ISLNK(member.mode)) {
+        return OP_SUCCESS;
+    }
+    mode_t permissions = (member.mode & 07777) ? (member.mode & 07777) : (member.is_directory ? 0755 : 0644);
+    struct timespec times[2] = { { member.modified, 0 }, { member.modified, 0 } };
+
+    if (member.is_directory) {
+        if (mkdir(dest, 0755) != 0 && errno != EEXIST) {
+            return copy_fail("Cannot create", dest);
+        }
+        OperationResult result = OP_SUCCESS;
+        for (int i = index + 1; result == OP_SUCCESS && i < archive_next(archive, index);
+             i = archive_next(archive, i)) {
+            ArchiveEntry child;
+            archive_entry(archive, i, &child);
+            // Archives are read as listed; a name that leaves dest is refused
+            if (child.name[0] == '\0' || strcmp(child.name, ".") == 0 || strcmp(child.name, "..") == 0 ||
+                strchr(child.name, '/') != NULL) {
+                errno = EINVAL;
+                result = copy_fail("Cannot copy", child.path);
+                break;
+            }
+            char child_dest[4096];
+            if (snprintf(child_dest, sizeof(child_dest), "%s/%s", dest, child.name) >= (int)sizeof(child_dest)) {
+                errno = ENAMETOOLONG;
+                result = copy_fail("Cannot copy", child.path);
+                break;
+            }
+            result = copy_archive_item(job, archive, i, child_dest);
+        }
+        chmod(dest, permissions);
+        utimensat(AT_FDCWD, dest, times, 0);
+        return result;
+    }
+
+    struct stat st = { 0 };
+    st.st_mode = member.mode;
+    st.st_size = (off_t)member.size;
+    st.st_mtimespec.tv_sec = member.modified;
+    if (copy_is_complete(&st, dest)) {
+        copy_add_progress(job, st.st_size);
+        return OP_SUCCESS;
+    }
+
+    ArchiveReader *reader = archive_reader_open(archive, index);
+    if (reader == NULL) {
+        return copy_fail("Cannot read", member.path);
+    }
+    int fd = open(dest, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        archive_reader_close(reader);
+        return copy_fail("Cannot create", dest);
+    }
+    OperationResult result = OP_SUCCESS;
+    while (result == OP_SUCCESS) {
+        ssize_t got = archive_reader_read(reader, job->buffer, COPY_BUFFER_SIZE);
+        if (got < 0) {
+            result = copy_fail("Read failed for", member.path);
+            break;
+        }
+        if (got == 0) {
+            break;
+        }
+        for (ssize_t written = 0; written < got; ) {
+            ssize_t n = write(fd, job->buffer + written, (size_t)(got - written));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                result = copy_fail("Write failed for", dest);
+                break;
+            }
+            written += n;
+        }
+        copy_add_progress(job, got);
+        if (result == OP_SUCCESS && !copy_checkpoint(job)) {
+            result = OP_ERROR_CANCELLED;
+        }
+    }
+    archive_reader_close(reader);
+    if (close(fd) != 0 && result == OP_SUCCESS) {
+        result = copy_fail("Write failed for", dest);
+    }
+    if (result == OP_SUCCESS) {
+        fchmodat(AT_FDCWD, dest, permissions, 0);
+        utimensat(AT_FDCWD, dest, times, 0);
+    }
+    return result;
+}
+
+// Helper: copy_path for a member of an archive. Archives are read-only: nothing is
+// moved out of them
+static OperationResult copy_from_archive(const char *source, const char *dest_path, CopyControl *control, bool move)
+{
+    if (move) {
+        snprintf(g_error_message, sizeof(g_error_message), "Cannot move out of an archive: %s", source);
+        return OP_ERROR_PERMISSION;
+    }
+    char archive_path[4096];
+    const char *inner;
+    archive_split_path(source, archive_path, sizeof(archive_path), &inner);
+    Archive *archive = archive_open(archive_path, true, control ? &control->cancel : NULL);
+    if (archive == NULL) {
+        return errno == ECANCELED ? OP_ERROR_CANCELLED : copy_fail("Cannot open", archive_path);
+    }
+    int index = archive_find(archive, inner);
+    if (index < 0) {
+        archive_release(archive);
+        snprintf(g_error_message, sizeof(g_error_message), "Source does not exist: %s", source);
+        return OP_ERROR_NOT_FOUND;
+    }
+
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, COPY_BUFFER_ALIGN, COPY_BUFFER_SIZE) != 0) {
+        archive_release(archive);
+        snprintf(g_error_message, sizeof(g_error_message), "Out of memory");
+        return OP_ERROR_UNKNOWN;
+    }
+    CopyJob job = { .control = control, .buffer = buffer };
+    OperationResult result = copy_archive_item(&job, archive, index, dest_path);
+    free(buffer);
+    archive_release(archive);
+    stat_cache_invalidate(dest_path, true);
+    return result;
+}
+
+static OperationResult copy_path(const char *source, const char *dest_path, CopyControl *control, bool move)
+{
+    if (is_archive_member(source)) {
+        return copy_from_archive(source, dest_path, control, move);
+    }
+    if (!path_exists(source)) {
+        snprintf(g_error_message, sizeof(g_error_message),
+                 "Source does not exist: %s", source);
+        return OP_ERROR_NOT_FOUND;
+    }
+
+    struct stat st;
+    if (lstat(source, &st) != 0) {
+        return copy_fail("Cannot stat", source);
+    }
+
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, COPY_BUFFER_ALIGN, COPY_BUFFER_SIZE) != 0) {
+        snprintf(g_error_message, sizeof(g_error_message), "Out of memory");
+        return OP_ERROR_UNKNOWN;
+    }
+
+    CopyJob job = { .control = control, .buffer = buffer, .try_clone = copy_same_device(source, dest_path),
+                    .move = move, .verify = move && atomic_load(&g_verify_moves) };
+    OperationResult result = OP_SUCCESS;
+    if (!copy_checkpoint(&job)) {
+        result = OP_ERROR_CANCELLED;
+    } else if (S_ISDIR(st.st_mode)) {
+        result = copy_directory(&job, source, dest_path, &st);
+    } else if (S_ISLNK(st.st_mode)) {
+        result = copy_symlink(&job, source, dest_path, &st);
+    } else if (S_ISREG(st.st_mode)) {
+        result = copy_file(&job, source, dest_path, &st);
+    }
+    free(buffer);
+
+    // Operations drop what they changed from the attribute cache themselves: the
+    // stream only reports it a moment later
+    stat_cache_invalidate(dest_path, true);
+    return result;
+}
+
+OperationResult file_copy_to(const char *source, const char *dest_path, CopyControl *control)
+{
+    g_error_message[0] = '\0';
+    return copy_path(source, dest_path, control, false);
+}
+
+// Tree removal. Directories are read by a pool of threads through their own fds and
+// their files unlinked as they are read, with no stat unless progress is wanted. Each
+// directory counts its subdirectories still to go, plus one while it is being read,
+// and is removed by whichever thread brings that count to zero
+typedef struct RemoveDir {
+    struct RemoveDir *parent;
+    struct RemoveDir *next;                 // In the pool's queue
+    atomic_int pending;
+    char path[];
+} RemoveDir;
+
+typedef struct RemovePool {
+    CopyControl *control;
+    RemoveDir *head;                        // Directories waiting to be read
+    RemoveDir *tail;
+    int busy;                               // Threads reading one
+    atomic_bool failed;
+
+    OperationResult result;                 // First failure stops everyone
+    char error[512];
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} RemovePool;
+
+// Helper: record the first failure with this thread's error message
+static void remove_pool_fail(RemovePool *pool, OperationResult result)
+{
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->result == OP_SUCCESS) {
+        pool->result = result;
+        snprintf(pool->error, sizeof(pool->error), "%s", g_error_message);
+    }
+    atomic_store(&pool->failed, true);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+// Helper: wait out a pause; false once the removal is cancelled or has failed
+static bool remove_checkpoint(RemovePool *pool)
+{
+    if (atomic_load(&pool->failed)) {
+        return false;
+    }
+    if (pool->control == NULL) {
+        return true;
+    }
+    while (atomic_load(&pool->control->pause) && !atomic_load(&pool->control->cancel)) {
+        usleep(COPY_PAUSE_POLL_US);
+    }
+    if (atomic_load(&pool->control->cancel)) {
+        snprintf(g_error_message, sizeof(g_error_message), "Delete cancelled");
+        remove_pool_fail(pool, OP_ERROR_CANCELLED);
+        return false;
+    }
+    return true;
+}
+
+static RemoveDir* remove_dir_new(RemoveDir *parent, const char *path, const char *name)
+{
+    size_t length = strlen(path) + (name != NULL ? strlen(name) + 1 : 0);
+    RemoveDir *dir = malloc(sizeof(RemoveDir) + length + 1);
+    if (dir == NULL) {
+        return NULL;
+    }
+    dir->parent = parent;
+    dir->next = NULL;
+    atomic_init(&dir->pending, 1);
+    if (name != NULL) {
+        snprintf(dir->path, length + 1, "%s/%s", path, name);
+    } else {
+        snprintf(dir->path, length + 1, "%s", path);
+    }
+    return dir;
+}
+
+static void remove_pool_push(RemovePool *pool, RemoveDir *dir)
 {
-    struct stat st;
-    if (stat(path, &st) != 0) return false;
-    return S_ISDIR(st.st_mode);
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->tail != NULL) {
+        pool->tail->next = dir;
+    } else {
+        pool->head = dir;
+    }
+    pool->tail = dir;
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
 }
 
-// Helper to get basename from path
-static const char* get_basename(const char *path)
+// Helper: drop one count from a directory; the last one removes it (unless the
+// removal failed) and passes on to its parent
+static void remove_dir_release(RemovePool *pool, RemoveDir *dir)
 {
-    const char *base = strrchr(path, '/');
-    return base ? base + 1 : path;
+    while (dir != NULL && atomic_fetch_sub(&dir->pending, 1) == 1) {
+        if (!atomic_load(&pool->failed) && rmdir(dir->path) != 0 && errno != ENOENT) {
+            remove_pool_fail(pool, copy_fail("Cannot remove directory", dir->path));
+        }
+        RemoveDir *parent = dir->parent;
+        free(dir);
+        dir = parent;
+    }
 }
 
-// Generate unique name for destination
-void generate_unique_name(const char *base_path, char *output, size_t output_size)
+// Helper: unlink what a directory holds and queue its subdirectories
+static void remove_dir_read(RemovePool *pool, RemoveDir *dir)
 {
-    if (!path_exists(base_path)) {
-        strncpy(output, base_path, output_size - 1);
-        output[output_size - 1] = '\0';
-        return;
+    int fd = -1;
+    DIR *handle = NULL;
+    if (remove_checkpoint(pool)) {
+        fd = open(dir->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        handle = fd >= 0 ? fdopendir(fd) : NULL;
+        if (handle == NULL) {
+            remove_pool_fail(pool, copy_fail("Cannot open directory", dir->path));
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
     }
 
-    // Find extension if any
-    const char *basename_part = get_basename(base_path);
-    const char *dot = strrchr(basename_part, '.');
-    size_t base_len = strlen(base_path);
-    size_t ext_len = 0;
-    char ext[64] = {0};
+    struct dirent *entry;
+    while (handle != NULL && remove_checkpoint(pool) && (entry = readdir(handle)) != NULL) {
+        const char *name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
 
-    if (dot && dot != basename_part) {
-        ext_len = strlen(dot);
-        strncpy(ext, dot, sizeof(ext) - 1);
-        base_len = dot - base_path;
-    }
+        // Filesystems that do not fill in d_type get a stat
+        struct stat st;
+        bool have_stat = false;
+        bool is_dir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN || (pool->control != NULL && entry->d_type == DT_REG)) {
+            have_stat = fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0;
+            is_dir = have_stat && S_ISDIR(st.st_mode);
+        }
 
-    char base_without_ext[4096];
-    strncpy(base_without_ext, base_path, base_len);
-    base_without_ext[base_len] = '\0';
+        if (is_dir) {
+            RemoveDir *child = remove_dir_new(dir, dir->path, name);
+            if (child == NULL) {
+                snprintf(g_error_message, sizeof(g_error_message), "Out of memory");
+                remove_pool_fail(pool, OP_ERROR_UNKNOWN);
+                break;
+            }
+            atomic_fetch_add(&dir->pending, 1);
+            remove_pool_push(pool, child);
+            continue;
+        }
 
-    // Try adding suffixes until we find a unique name
-    for (int i = 1; i < 10000; i++) {
-        snprintf(output, output_size, "%s (%d)%s", base_without_ext, i, ext);
-        if (!path_exists(output)) {
-            return;
+        if (unlinkat(fd, name, 0) != 0) {
+            if (errno != ENOENT) {
+                char path[4096];
+                snprintf(path, sizeof(path), "%s/%s", dir->path, name);
+                remove_pool_fail(pool, copy_fail("Cannot remove file", path));
+            }
+        } else if (pool->control != NULL && have_stat && S_ISREG(st.st_mode)) {
+            atomic_fetch_add(&pool->control->bytes_done, (long long)st.st_size);
         }
     }
-
-    // Fallback - this shouldn't happen
-    strncpy(output, base_path, output_size - 1);
-    output[output_size - 1] = '\0';
+    if (handle != NULL) {
+        closedir(handle);
+    }
+    remove_dir_release(pool, dir);
 }
 
-// Validate parent dir and name, then build unique path
-static OperationResult validate_and_build_path(const char *parent_dir, const char *name,
-                                                const char *type_name,
-                                                char *unique_path, size_t path_size)
+static void* remove_pool_worker(void *arg)
 {
-    if (!is_directory(parent_dir)) {
-        snprintf(g_error_message, sizeof(g_error_message),
-                 "Parent is not a directory: %s", parent_dir);
-        return OP_ERROR_INVALID;
-    }
-
-    if (!name || name[0] == '\0' || strchr(name, '/') != NULL) {
-        snprintf(g_error_message, sizeof(g_error_message),
-                 "Invalid %s name", type_name);
-        return OP_ERROR_INVALID;
-    }
+    RemovePool *pool = arg;
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (pool->head == NULL && pool->busy > 0) {
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+        }
+        // Nothing queued and nobody reading a directory that could queue more
+        if (pool->head == NULL) {
+            break;
+        }
+        RemoveDir *dir = pool->head;
+        pool->head = dir->next;
+        if (pool->head == NULL) {
+            pool->tail = NULL;
+        }
+        pool->busy++;
+        pthread_mutex_unlock(&pool->mutex);
 
-    char path[4096];
-    snprintf(path, sizeof(path), "%s/%s", parent_dir, name);
-    generate_unique_name(path, unique_path, path_size);
+        remove_dir_read(pool, dir);
 
-    return OP_SUCCESS;
+        pthread_mutex_lock(&pool->mutex);
+        pool->busy--;
+        if (pool->head == NULL && pool->busy == 0) {
+            pthread_cond_broadcast(&pool->cond);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
 }
 
-// Recursive copy using macOS copyfile
-static bool copy_recursive(const char *source, const char *dest)
+static OperationResult remove_directory(const char *path, CopyControl *control)
 {
-    copyfile_state_t state = copyfile_state_alloc();
-    int result = copyfile(source, dest, state, COPYFILE_ALL | COPYFILE_RECURSIVE);
-    copyfile_state_free(state);
+    RemovePool *pool = calloc(1, sizeof(RemovePool));
+    RemoveDir *root = remove_dir_new(NULL, path, NULL);
+    if (pool == NULL || root == NULL) {
+        free(pool);
+        free(root);
+        snprintf(g_error_message, sizeof(g_error_message), "Out of memory");
+        return OP_ERROR_UNKNOWN;
+    }
+    pool->control = control;
+    pool->head = root;
+    pool->tail = root;
+    pool->result = OP_SUCCESS;
+    atomic_init(&pool->failed, false);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+
+    // This thread works too, so one fewer is started
+    pthread_t threads[COPY_THREADS_MAX];
+    int started = 0;
+    int wanted = copy_default_threads() - 1;
+    for (int i = 0; i < wanted; i++) {
+        if (pthread_create(&threads[started], NULL, remove_pool_worker, pool) != 0) {
+            break;
+        }
+        started++;
+    }
+    remove_pool_worker(pool);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
 
-    if (result != 0) {
-        snprintf(g_error_message, sizeof(g_error_message),
-                 "Copy failed: %s", strerror(errno));
-        return false;
+    // Every directory has been freed on the way out, removed or not
+    OperationResult result = pool->result;
+    if (result != OP_SUCCESS) {
+        snprintf(g_error_message, sizeof(g_error_message), "%s", pool->error);
     }
-    return true;
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+    return result;
 }
 
-// Recursive remove
-static bool remove_recursive(const char *path)
+OperationResult file_remove(const char *path, CopyControl *control)
 {
+    g_error_message[0] = '\0';
+
     struct stat st;
     if (lstat(path, &st) != 0) {
-        snprintf(g_error_message, sizeof(g_error_message),
-                 "Cannot stat: %s", strerror(errno));
-        return false;
+        return copy_fail("Cannot stat", path);
     }
 
-    if (S_ISDIR(st.st_mode) && !S_ISLNK(st.st_mode)) {
-        DIR *dir = opendir(path);
-        if (!dir) {
-            snprintf(g_error_message, sizeof(g_error_message),
-                     "Cannot open directory: %s", strerror(errno));
-            return false;
-        }
-
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL) {
-            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-                continue;
-            }
-
-            char child_path[4096];
-            snprintf(child_path, sizeof(child_path), "%s/%s", path, entry->d_name);
+    OperationResult result = OP_SUCCESS;
+    if (control != NULL && atomic_load(&control->cancel)) {
+        snprintf(g_error_message, sizeof(g_error_message), "Delete cancelled");
+        result = OP_ERROR_CANCELLED;
+    } else if (S_ISDIR(st.st_mode)) {
+        result = remove_directory(path, control);
+    } else if (unlink(path) != 0) {
+        result = copy_fail("Cannot remove file", path);
+    } else if (control != NULL && S_ISREG(st.st_mode)) {
+        atomic_fetch_add(&control->bytes_done, (long long)st.st_size);
+    }
+    stat_cache_invalidate(path, true);
+    return result;
+}
 
-            if (!remove_recursive(child_path)) {
-                closedir(dir);
-                return false;
-            }
-        }
-        closedir(dir);
+bool file_remove_tombstone(const char *path, char *tombstone, size_t tombstone_size)
+{
+    g_error_message[0] = '\0';
 
-        if (rmdir(path) != 0) {
-            snprintf(g_error_message, sizeof(g_error_message),
-                     "Cannot remove directory: %s", strerror(errno));
-            return false;
-        }
+    char parent[4096];
+    snprintf(parent, sizeof(parent), "%s", path);
+    char *last_slash = strrchr(parent, '/');
+    if (last_slash == NULL) {
+        strcpy(parent, ".");
+    } else if (last_slash == parent) {
+        parent[1] = '\0';
     } else {
-        if (unlink(path) != 0) {
-            snprintf(g_error_message, sizeof(g_error_message),
-                     "Cannot remove file: %s", strerror(errno));
-            return false;
+        *last_slash = '\0';
+    }
+    const char *separator = parent[strlen(parent) - 1] == '/' ? "" : "/";
+
+    // A sibling, so the rename stays on the volume; the counter keeps two at once apart
+    static atomic_uint counter;
+    for (int attempt = 0; attempt < 100; attempt++) {
+        snprintf(tombstone, tombstone_size, "%s%s%s%d-%u-%s", parent, separator, OPERATIONS_TOMBSTONE_PREFIX,
+                 (int)getpid(), atomic_fetch_add(&counter, 1), get_basename(path));
+        if (file_rename_at(AT_FDCWD, path, AT_FDCWD, tombstone) == 0) {
+            stat_cache_invalidate(path, true);
+            return true;
+        }
+        if (errno != EEXIST) {
+            break;
         }
     }
+    snprintf(g_error_message, sizeof(g_error_message), "Cannot move %s aside: %s", path, strerror(errno));
+    return false;
+}
 
+bool file_restore_tombstone(const char *tombstone, const char *path)
+{
+    g_error_message[0] = '\0';
+    if (file_rename_at(AT_FDCWD, tombstone, AT_FDCWD, path) != 0) {
+        snprintf(g_error_message, sizeof(g_error_message), "Cannot put %s back: %s", path, strerror(errno));
+        return false;
+    }
+    stat_cache_invalidate(tombstone, true);
+    stat_cache_invalidate(path, true);
     return true;
 }
 
@@ -284,7 +1417,7 @@ OperationResult file_copy(const char *source, const char *dest_dir)
 {
     g_error_message[0] = '\0';
 
-    if (!path_exists(source)) {
+    if (!path_exists(source) && !is_archive_member(source)) {
         snprintf(g_error_message, sizeof(g_error_message),
                  "Source does not exist: %s", source);
         return OP_ERROR_NOT_FOUND;
@@ -304,11 +1437,7 @@ OperationResult file_copy(const char *source, const char *dest_dir)
     char unique_dest[4096];
     generate_unique_name(dest_path, unique_dest, sizeof(unique_dest));
 
-    if (!copy_recursive(source, unique_dest)) {
-        return OP_ERROR_UNKNOWN;
-    }
-
-    return OP_SUCCESS;
+    return set_result_path(file_copy_to(source, unique_dest, NULL), unique_dest);
 }
 
 OperationResult file_move(const char *source, const char *dest_dir)
@@ -335,20 +1464,32 @@ OperationResult file_move(const char *source, const char *dest_dir)
     char unique_dest[4096];
     generate_unique_name(dest_path, unique_dest, sizeof(unique_dest));
 
+    return set_result_path(file_move_to(source, unique_dest, NULL), unique_dest);
+}
+
+OperationResult file_move_to(const char *source, const char *dest_path, CopyControl *control)
+{
+    g_error_message[0] = '\0';
+
     // Try rename first (fast for same filesystem)
-    if (rename(source, unique_dest) == 0) {
+    if (rename(source, dest_path) == 0) {
+        stat_cache_invalidate(source, true);
+        stat_cache_invalidate(dest_path, true);
         return OP_SUCCESS;
     }
 
-    // If rename fails (cross-device), copy and delete
+    // If rename fails (cross-device), copy and delete file by file
     if (errno == EXDEV) {
-        if (!copy_recursive(source, unique_dest)) {
-            return OP_ERROR_UNKNOWN;
-        }
-        if (!remove_recursive(source)) {
-            return OP_ERROR_UNKNOWN;
+        OperationResult result = copy_path(source, dest_path, control, true);
+        if (result != OP_SUCCESS) {
+            return result;
         }
-        return OP_SUCCESS;
+
+        // Whatever the copy skipped (sockets, FIFOs) still holds the source tree
+        struct stat st;
+        result = lstat(source, &st) != 0 ? OP_SUCCESS : file_remove(source, NULL);
+        stat_cache_invalidate(source, true);
+        return result;
     }
 
     snprintf(g_error_message, sizeof(g_error_message),
@@ -356,6 +1497,28 @@ OperationResult file_move(const char *source, const char *dest_dir)
     return OP_ERROR_UNKNOWN;
 }
 
+int file_rename_at(int from_fd, const char *from, int to_fd, const char *to)
+{
+#if defined(__APPLE__)
+    return renameatx_np(from_fd, from, to_fd, to, RENAME_EXCL);
+#else
+#if defined(RENAME_NOREPLACE)
+    if (renameat2(from_fd, from, to_fd, to, RENAME_NOREPLACE) == 0) {
+        return 0;
+    }
+    if (errno != EINVAL && errno != ENOSYS) {
+        return -1;
+    }
+#endif
+    // Not atomic: another process may take the name between the check and the rename
+    if (faccessat(to_fd, to, F_OK, AT_SYMLINK_NOFOLLOW) == 0) {
+        errno = EEXIST;
+        return -1;
+    }
+    return renameat(from_fd, from, to_fd, to);
+#endif
+}
+
 OperationResult file_delete(const char *path)
 {
     g_error_message[0] = '\0';
@@ -373,9 +1536,328 @@ OperationResult file_delete(const char *path)
         return OP_ERROR_UNKNOWN;
     }
 
+    stat_cache_invalidate(path, true);
+    return OP_SUCCESS;
+}
+
+int file_delete_batch(const char *const *paths, int count, OperationResult *results)
+{
+    return file_trash_batch(paths, count, results, 0);
+}
+
+int file_trash_batch(const char *const *paths, int count, OperationResult *results, uint64_t undo_group)
+{
+    g_error_message[0] = '\0';
+    if (count <= 0) {
+        return 0;
+    }
+
+    // Missing paths fail up front; the rest go to the Trash in one batch
+    const char **existing = malloc((size_t)count * sizeof(const char*));
+    int *positions = malloc((size_t)count * sizeof(int));
+    bool *trashed = malloc((size_t)count * sizeof(bool));
+    if (existing == NULL || positions == NULL || trashed == NULL) {
+        free(existing);
+        free(positions);
+        free(trashed);
+        snprintf(g_error_message, sizeof(g_error_message), "Out of memory");
+        for (int i = 0; results != NULL && i < count; i++) {
+            results[i] = OP_ERROR_UNKNOWN;
+        }
+        return 0;
+    }
+
+    int existing_count = 0;
+    for (int i = 0; i < count; i++) {
+        if (path_exists(paths[i])) {
+            positions[existing_count] = i;
+            existing[existing_count++] = paths[i];
+        } else {
+            if (results != NULL) results[i] = OP_ERROR_NOT_FOUND;
+            if (g_error_message[0] == '\0') {
+                snprintf(g_error_message, sizeof(g_error_message),
+                         "File does not exist: %s", paths[i]);
+            }
+        }
+    }
+
+    // Where each item lands is only needed to put it back
+    UndoLog *undo = undo_group != 0 ? undo_log_shared() : NULL;
+    char **locations = undo ? calloc((size_t)count, sizeof(char *)) : NULL;
+    int deleted = platform_move_to_trash_batch(existing, existing_count, trashed, locations);
+
+    for (int i = 0; i < existing_count; i++) {
+        if (results != NULL) {
+            results[positions[i]] = trashed[i] ? OP_SUCCESS : OP_ERROR_UNKNOWN;
+        }
+        if (trashed[i]) {
+            stat_cache_invalidate(existing[i], true);
+        }
+        if (locations != NULL && locations[i] != NULL) {
+            undo_log_trashed(undo, undo_group, existing[i], locations[i]);
+            free(locations[i]);
+        }
+        if (!trashed[i] && g_error_message[0] == '\0') {
+            snprintf(g_error_message, sizeof(g_error_message),
+                     "Move to Trash failed, %s not deleted", existing[i]);
+        }
+    }
+
+    free(existing);
+    free(positions);
+    free(trashed);
+    free(locations);
+    return deleted;
+}
+
+// A sync in progress
+typedef struct SyncJob {
+    CopyControl *control;
+    SyncMode mode;
+    bool by_content;
+    char **extras;                          // Mirror extras, sent to the Trash together at the end
+    int extra_count;
+    int extra_capacity;
+} SyncJob;
+
+static int sync_name_compare(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void sync_names_free(char **names, int count)
+{
+    for (int i = 0; i < count; i++) {
+        free(names[i]);
+    }
+    free(names);
+}
+
+// Helper: a directory's entry names, sorted; false if it cannot be read
+static bool sync_list(const char *path, char ***names_out, int *count_out)
+{
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return false;
+    }
+
+    char **names = NULL;
+    int count = 0;
+    int capacity = 0;
+    bool ok = true;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        // Finder metadata is not synced, as directory comparison ignores it
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0 ||
+            strcmp(entry->d_name, ".DS_Store") == 0) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 32;
+            char **grown = realloc(names, (size_t)capacity * sizeof(char*));
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            names = grown;
+        }
+        if ((names[count] = strdup(entry->d_name)) == NULL) {
+            ok = false;
+            break;
+        }
+        count++;
+    }
+    closedir(dir);
+
+    if (!ok) {
+        sync_names_free(names, count);
+        return false;
+    }
+    if (count > 1) {
+        qsort(names, (size_t)count, sizeof(char*), sync_name_compare);
+    }
+    *names_out = names;
+    *count_out = count;
+    return true;
+}
+
+// Helper: whether two entries of the same type hold different data
+static bool sync_differ(const SyncJob *job, const char *a, const char *b,
+                        const struct stat *a_st, const struct stat *b_st)
+{
+    if (S_ISLNK(a_st->st_mode)) {
+        char a_target[4096];
+        char b_target[4096];
+        ssize_t a_length = readlink(a, a_target, sizeof(a_target));
+        ssize_t b_length = readlink(b, b_target, sizeof(b_target));
+        return a_length < 0 || a_length != b_length || memcmp(a_target, b_target, (size_t)a_length) != 0;
+    }
+    if (!S_ISREG(a_st->st_mode)) {
+        return false;       // Special files are left alone
+    }
+    if (a_st->st_size != b_st->st_size) {
+        return true;
+    }
+    if (!job->by_content) {
+        return a_st->st_mtime != b_st->st_mtime;
+    }
+    if (a_st->st_size == 0) {
+        return false;
+    }
+    FileHashJob jobs[2] = { { .path = a, .size = (uint64_t)a_st->st_size },
+                            { .path = b, .size = (uint64_t)b_st->st_size } };
+    file_hash_batch(jobs, 2);
+    return !jobs[0].ok || !jobs[1].ok || jobs[0].hash != jobs[1].hash;
+}
+
+// Helper: replace to with a copy of from. A directory in the way goes to the Trash;
+// a file is overwritten
+static OperationResult sync_replace(SyncJob *job, const char *from, const char *to)
+{
+    struct stat to_st;
+    if (lstat(to, &to_st) == 0) {
+        if (S_ISDIR(to_st.st_mode)) {
+            OperationResult result = file_delete(to);
+            if (result != OP_SUCCESS) {
+                return result;
+            }
+        } else if (unlink(to) != 0) {
+            return copy_fail("Cannot replace", to);
+        }
+    }
+    return copy_path(from, to, job->control, false);
+}
+
+static OperationResult sync_directory(SyncJob *job, const char *source, const char *dest);
+
+// Helper: reconcile two paths that both exist
+static OperationResult sync_pair(SyncJob *job, const char *source, const char *dest)
+{
+    struct stat source_st, dest_st;
+    if (lstat(source, &source_st) != 0) {
+        return copy_fail("Cannot stat", source);
+    }
+    if (lstat(dest, &dest_st) != 0) {
+        return copy_fail("Cannot stat", dest);
+    }
+
+    if (S_ISDIR(source_st.st_mode) && S_ISDIR(dest_st.st_mode)) {
+        return sync_directory(job, source, dest);
+    }
+
+    bool same_type = (source_st.st_mode & S_IFMT) == (dest_st.st_mode & S_IFMT);
+    if (same_type && !sync_differ(job, source, dest, &source_st, &dest_st)) {
+        // Counted as done, so progress tracks the tree rather than the changes
+        if (job->control != NULL && S_ISREG(source_st.st_mode)) {
+            atomic_fetch_add(&job->control->bytes_done, (long long)source_st.st_size);
+        }
+        return OP_SUCCESS;
+    }
+
+    // A mirror always takes the source; otherwise the newer side wins
+    bool dest_newer = dest_st.st_mtime > source_st.st_mtime;
+    if (job->mode == SYNC_MIRROR || !dest_newer) {
+        return sync_replace(job, source, dest);
+    }
+    if (job->mode == SYNC_TWO_WAY) {
+        return sync_replace(job, dest, source);
+    }
     return OP_SUCCESS;
 }
 
+static OperationResult sync_directory(SyncJob *job, const char *source, const char *dest)
+{
+    char **source_names = NULL;
+    char **dest_names = NULL;
+    int source_count = 0;
+    int dest_count = 0;
+    if (!sync_list(source, &source_names, &source_count)) {
+        return copy_fail("Cannot open directory", source);
+    }
+    if (!sync_list(dest, &dest_names, &dest_count)) {
+        sync_names_free(source_names, source_count);
+        return copy_fail("Cannot open directory", dest);
+    }
+
+    // Both lists are sorted: walk them side by side
+    OperationResult result = OP_SUCCESS;
+    int i = 0;
+    int j = 0;
+    char source_path[4096];
+    char dest_path[4096];
+    while (result == OP_SUCCESS && (i < source_count || j < dest_count)) {
+        CopyJob checkpoint = { .control = job->control };
+        if (!copy_checkpoint(&checkpoint)) {
+            result = OP_ERROR_CANCELLED;
+            break;
+        }
+
+        int order = i >= source_count ? 1 : j >= dest_count ? -1 : strcmp(source_names[i], dest_names[j]);
+        const char *name = order <= 0 ? source_names[i] : dest_names[j];
+        snprintf(source_path, sizeof(source_path), "%s/%s", source, name);
+        snprintf(dest_path, sizeof(dest_path), "%s/%s", dest, name);
+
+        if (order == 0) {
+            result = sync_pair(job, source_path, dest_path);
+            i++;
+            j++;
+        } else if (order < 0) {
+            result = copy_path(source_path, dest_path, job->control, false);
+            i++;
+        } else {
+            if (job->mode == SYNC_TWO_WAY) {
+                result = copy_path(dest_path, source_path, job->control, false);
+            } else if (job->mode == SYNC_MIRROR) {
+                if (job->extra_count == job->extra_capacity) {
+                    int capacity = job->extra_capacity ? job->extra_capacity * 2 : 32;
+                    char **grown = realloc(job->extras, (size_t)capacity * sizeof(char*));
+                    if (grown) {
+                        job->extras = grown;
+                        job->extra_capacity = capacity;
+                    }
+                }
+                if (job->extra_count < job->extra_capacity &&
+                    (job->extras[job->extra_count] = strdup(dest_path)) != NULL) {
+                    job->extra_count++;
+                } else {
+                    snprintf(g_error_message, sizeof(g_error_message), "Out of memory");
+                    result = OP_ERROR_UNKNOWN;
+                }
+            }
+            j++;
+        }
+    }
+
+    sync_names_free(source_names, source_count);
+    sync_names_free(dest_names, dest_count);
+    return result;
+}
+
+OperationResult file_sync_to(const char *source, const char *dest_path, SyncMode mode,
+                             bool by_content, CopyControl *control)
+{
+    g_error_message[0] = '\0';
+
+    struct stat st;
+    if (lstat(dest_path, &st) != 0) {
+        return copy_path(source, dest_path, control, false);
+    }
+
+    SyncJob job = { .control = control, .mode = mode, .by_content = by_content };
+    OperationResult result = sync_pair(&job, source, dest_path);
+
+    // Extras go only once everything else is in place, so a failed sync deletes nothing
+    if (result == OP_SUCCESS && job.extra_count > 0) {
+        int trashed = file_delete_batch((const char *const *)job.extras, job.extra_count, NULL);
+        if (trashed < job.extra_count) {
+            result = OP_ERROR_UNKNOWN;
+        }
+    }
+    sync_names_free(job.extras, job.extra_count);
+    stat_cache_invalidate(dest_path, true);
+    return result;
+}
+
 OperationResult file_rename(const char *path, const char *new_name)
 {
     g_error_message[0] = '\0';
@@ -420,8 +1902,9 @@ OperationResult file_rename(const char *path, const char *new_name)
                  "Rename failed: %s", strerror(errno));
         return OP_ERROR_UNKNOWN;
     }
+    stat_cache_invalidate(path, true);
 
-    return OP_SUCCESS;
+    return set_result_path(OP_SUCCESS, new_path);
 }
 
 OperationResult file_create_directory(const char *parent_dir, const char *name)
@@ -439,7 +1922,7 @@ OperationResult file_create_directory(const char *parent_dir, const char *name)
         return OP_ERROR_UNKNOWN;
     }
 
-    return OP_SUCCESS;
+    return set_result_path(OP_SUCCESS, unique_path);
 }
 
 OperationResult file_create_file(const char *parent_dir, const char *name, const char *content)
@@ -470,7 +1953,7 @@ OperationResult file_create_file(const char *parent_dir, const char *name, const
     }
 
     fclose(f);
-    return OP_SUCCESS;
+    return set_result_path(OP_SUCCESS, unique_path);
 }
 
 OperationResult file_duplicate(const char *path)
@@ -499,11 +1982,7 @@ OperationResult file_duplicate(const char *path)
     char dest[4096];
     generate_unique_name(path, dest, sizeof(dest));
 
-    if (!copy_recursive(path, dest)) {
-        return OP_ERROR_UNKNOWN;
-    }
-
-    return OP_SUCCESS;
+    return file_copy_to(path, dest, NULL);
 }
 
 int clipboard_paste(ClipboardState *clipboard, const char *dest_dir)
@@ -518,9 +1997,9 @@ int clipboard_paste(ClipboardState *clipboard, const char *dest_dir)
         OperationResult result;
 
         if (clipboard->operation == OP_CUT) {
-            result = file_move(clipboard->paths[i], dest_dir);
+            result = file_move(clipboard_path(clipboard, i), dest_dir);
         } else {
-            result = file_copy(clipboard->paths[i], dest_dir);
+            result = file_copy(clipboard_path(clipboard, i), dest_dir);
         }
 
         if (result == OP_SUCCESS) {
@@ -2,10 +2,17 @@
 #define OPERATIONS_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stddef.h>
+#include <stdatomic.h>
+
+#include "../utils/string_set.h"
 
-#define MAX_CLIPBOARD_ITEMS 128
 #define MAX_PATH_LENGTH 1024
+#define CLIPBOARD_INITIAL_ITEMS 64
+
+// Names of items moved aside for removal start with this (hidden)
+#define OPERATIONS_TOMBSTONE_PREFIX ".finder-plus-deleting-"
 
 // Operation types
 typedef enum OperationType {
@@ -22,20 +29,39 @@ typedef enum OperationResult {
     OP_ERROR_EXISTS,
     OP_ERROR_INVALID,
     OP_ERROR_DISK_FULL,
-    OP_ERROR_UNKNOWN
+    OP_ERROR_UNKNOWN,
+    OP_ERROR_CANCELLED
 } OperationResult;
 
-// Clipboard state for file operations
+// Shared with a running copy: the copy reports bytes and polls the flags between chunks
+typedef struct CopyControl {
+    atomic_llong bytes_done;    // Bytes copied, or found already complete, so far
+    atomic_bool cancel;         // Stop at the next chunk; what was copied stays for a resume
+    atomic_bool pause;          // Hold between chunks until cleared
+} CopyControl;
+
+// Clipboard state for file operations. Any number of paths, interned back to back in
+// one buffer, with an open-addressed hash set over them: the membership test runs for
+// every drawn row
 typedef struct ClipboardState {
-    char paths[MAX_CLIPBOARD_ITEMS][MAX_PATH_LENGTH];  // Paths of copied/cut items
-    int count;                                          // Number of items
-    OperationType operation;                            // Copy or cut
+    char *paths;                // "path\0" per item
+    size_t paths_size;
+    size_t paths_capacity;
+    size_t *offsets;            // Start of each item in paths
+    int count;                  // Number of items
+    int capacity;               // Items offsets has room for
+    StringSet set;              // Over paths, for the membership test
+    OperationType operation;    // Copy or cut
+    long system_change;         // Pasteboard change count after our last publish (-1 if none)
 } ClipboardState;
 
 // Initialize clipboard state
 void clipboard_init(ClipboardState *clipboard);
 
-// Clear clipboard
+// Free the clipboard's buffers
+void clipboard_free(ClipboardState *clipboard);
+
+// Clear clipboard (keeps its buffers)
 void clipboard_clear(ClipboardState *clipboard);
 
 // Copy files to clipboard
@@ -44,14 +70,28 @@ void clipboard_copy(ClipboardState *clipboard, const char **paths, int count);
 // Cut files to clipboard
 void clipboard_cut(ClipboardState *clipboard, const char **paths, int count);
 
+// Fill the clipboard in steps, for more paths than fit in one array:
+// begin, add each path (duplicates are skipped; false on OOM), then publish
+// to the system pasteboard
+void clipboard_begin(ClipboardState *clipboard, OperationType op);
+bool clipboard_add(ClipboardState *clipboard, const char *path);
+void clipboard_publish(ClipboardState *clipboard);
+
+// Path of item index (0..count-1)
+static inline const char *clipboard_path(const ClipboardState *clipboard, int index)
+{
+    return clipboard->paths + clipboard->offsets[index];
+}
+
 // Check if clipboard has items
-bool clipboard_has_items(ClipboardState *clipboard);
+bool clipboard_has_items(const ClipboardState *clipboard);
 
 // Check if path is in clipboard (for visual feedback)
-bool clipboard_contains(ClipboardState *clipboard, const char *path);
+bool clipboard_contains(const ClipboardState *clipboard, const char *path);
 
 // Sync clipboard from system pasteboard (for cross-app paste into app)
-// Call this before paste to pick up files copied from other apps
+// Call this before paste to pick up files copied from other apps; a no-op while the
+// pasteboard still holds what this clipboard published
 void clipboard_sync_from_system(ClipboardState *clipboard);
 
 // Copy file paths as text to system clipboard
@@ -66,12 +106,66 @@ OperationResult file_copy(const char *source, const char *dest_dir);
 // Move a file or directory to destination
 OperationResult file_move(const char *source, const char *dest_dir);
 
+// Reset a copy control before handing it to a copy
+void copy_control_init(CopyControl *control);
+
+// Copy a file or directory to exactly dest_path, walking the tree in chunks.
+// Files already complete at the destination (same size and mtime) are skipped, so
+// copying again after a failure or cancel resumes. control may be NULL
+OperationResult file_copy_to(const char *source, const char *dest_path, CopyControl *control);
+
+// Move to exactly dest_path: a rename, or across devices a resumable copy that
+// deletes each source file as soon as its copy is done (and verified)
+OperationResult file_move_to(const char *source, const char *dest_path, CopyControl *control);
+
+// Hash-compare each file a cross-device move copied before deleting its source (default on)
+void operations_set_verify_moves(bool verify);
+
+// How file_sync_to reconciles two trees
+typedef enum SyncMode {
+    SYNC_UPDATE,                // Copy what is missing or newer in the source; delete nothing
+    SYNC_MIRROR,                // Make the destination match the source; extras go to the Trash
+    SYNC_TWO_WAY                // Copy what is missing on either side; the newer of two differing files wins
+} SyncMode;
+
+// Reconcile dest_path with source. Only entries missing or differing in size, mtime or
+// (when by_content) hash are copied, with the same cloning, sparse and chunked copy as
+// file_copy_to; unchanged files are never read. control may be NULL
+OperationResult file_sync_to(const char *source, const char *dest_path, SyncMode mode,
+                             bool by_content, CopyControl *control);
+
 // Delete a file or directory (move to trash)
 OperationResult file_delete(const char *path);
 
+// Move many files or directories to the Trash in one batch
+// results (may be NULL) gets each path's outcome; returns how many were deleted
+int file_delete_batch(const char *const *paths, int count, OperationResult *results);
+
+// file_delete_batch, recording where each item went in the Trash into undo_group of
+// undo_log_shared() (0: not recorded)
+int file_trash_batch(const char *const *paths, int count, OperationResult *results, uint64_t undo_group);
+
+// Delete a file or directory for good, not to the Trash. Trees are removed by several
+// threads at once, reporting the bytes of removed files and honouring cancel and pause
+// through control (may be NULL). A cancelled or failed removal leaves what it had not
+// reached yet
+OperationResult file_remove(const char *path, CopyControl *control);
+
+// Move an item aside to a hidden sibling, so it is gone from its folder at once and
+// can be removed with file_remove in the background. tombstone gets its new path
+bool file_remove_tombstone(const char *path, char *tombstone, size_t tombstone_size);
+
+// Put an item moved aside by file_remove_tombstone back at path, unless something has
+// taken its name since
+bool file_restore_tombstone(const char *tombstone, const char *path);
+
 // Rename a file or directory
 OperationResult file_rename(const char *path, const char *new_name);
 
+// Rename relative to open folders (AT_FDCWD for plain paths), failing with EEXIST rather
+// than replacing anything: renameatx_np on macOS. 0, or -1 with errno set
+int file_rename_at(int from_fd, const char *from, int to_fd, const char *to);
+
 // Create a new directory
 OperationResult file_create_directory(const char *parent_dir, const char *name);
 
@@ -90,6 +184,10 @@ int clipboard_paste(ClipboardState *clipboard, const char *dest_dir);
 // Get last error message
 const char* operations_get_error(void);
 
+// Path the last successful file_copy, file_move, file_rename or file_create_* on this
+// thread left its item at (names made unique included)
+const char* operations_get_result_path(void);
+
 // Generate a unique filename (adds suffix like " (1)", " (2)", etc.)
 void generate_unique_name(const char *base_path, char *output, size_t output_size);
 
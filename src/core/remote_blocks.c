@@ -0,0 +1,413 @@
+#include "remote_blocks.h"
+#include "filesystem.h"
+#include "../utils/hash.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Map file: header, the key, then one byte per block (1 = present)
+#define REMOTE_BLOCKS_MAGIC 0x42525046u     // "FPRB"
+#define REMOTE_BLOCKS_VERSION 1
+
+// Eviction frees down to this share of the budget, so it does not run on every fill
+#define REMOTE_BLOCKS_EVICT_TO 0.9
+
+typedef struct MapHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+    int64_t mtime;
+    uint32_t key_len;
+} MapHeader;
+
+struct RemoteBlocks {
+    char dir[PATH_MAX_LEN];
+    uint64_t budget;
+    pthread_mutex_t mutex;
+    uint64_t used;                      // Bytes of present blocks across every file
+};
+
+struct RemoteBlockFile {
+    RemoteBlocks *cache;
+    char name[32];                      // Hashed key, the file names' stem
+    int data_fd;
+    int map_fd;
+    uint64_t size;
+    uint64_t block_count;
+    uint8_t *present;
+    off_t map_blocks_at;                // Offset of the block bytes in the map file
+};
+
+// Helper: 64-bit FNV-1a of a string
+static uint64_t key_hash(const char *key)
+{
+    // Not HASH_FNV1A64_INIT: the seed the block files on disk were named with
+    return hash_fnv1a64_string(1469598103934665603ULL, key);
+}
+
+// Helper: Bytes of block index in a file of size
+static uint64_t block_bytes(uint64_t size, uint64_t index)
+{
+    uint64_t start = index * REMOTE_BLOCK_SIZE;
+    return size - start < REMOTE_BLOCK_SIZE ? size - start : REMOTE_BLOCK_SIZE;
+}
+
+// Helper: Path of a cache file
+static void cache_path(const RemoteBlocks *cache, const char *name, const char *ext, char *out, size_t out_size)
+{
+    snprintf(out, out_size, "%s/%s.%s", cache->dir, name, ext);
+}
+
+// Helper: Bytes present in a map file (0 if it is not one)
+static uint64_t map_file_bytes(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+
+    uint64_t bytes = 0;
+    MapHeader header;
+    if (pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+        header.magic == REMOTE_BLOCKS_MAGIC && header.version == REMOTE_BLOCKS_VERSION) {
+        uint64_t count = (header.size + REMOTE_BLOCK_SIZE - 1) / REMOTE_BLOCK_SIZE;
+        off_t at = (off_t)(sizeof(header) + header.key_len);
+        uint8_t chunk[4096];
+        for (uint64_t i = 0; i < count; ) {
+            size_t want = count - i < sizeof(chunk) ? (size_t)(count - i) : sizeof(chunk);
+            ssize_t n = pread(fd, chunk, want, at + (off_t)i);
+            if (n <= 0) {
+                break;
+            }
+            for (ssize_t k = 0; k < n; k++) {
+                if (chunk[k]) {
+                    bytes += block_bytes(header.size, i + (uint64_t)k);
+                }
+            }
+            i += (uint64_t)n;
+        }
+    }
+    close(fd);
+    return bytes;
+}
+
+// Helper: Remove the least recently opened files (other than keep) until the cache is
+// back under REMOTE_BLOCKS_EVICT_TO of its budget. Called with the mutex held
+static void evict(RemoteBlocks *cache, const char *keep)
+{
+    uint64_t target = (uint64_t)((double)cache->budget * REMOTE_BLOCKS_EVICT_TO);
+
+    while (cache->used > target) {
+        DIR *dir = opendir(cache->dir);
+        if (!dir) {
+            return;
+        }
+
+        char oldest[256] = "";
+        time_t oldest_time = 0;
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            size_t len = strlen(entry->d_name);
+            if (len < 5 || len >= sizeof(oldest) || strcmp(entry->d_name + len - 4, ".map") != 0 ||
+                (strncmp(entry->d_name, keep, len - 4) == 0 && keep[len - 4] == '\0')) {
+                continue;
+            }
+            char path[PATH_MAX_LEN];
+            snprintf(path, sizeof(path), "%s/%s", cache->dir, entry->d_name);
+            struct stat st;
+            if (stat(path, &st) == 0 && (oldest[0] == '\0' || st.st_mtime < oldest_time)) {
+                memcpy(oldest, entry->d_name, len - 4);
+                oldest[len - 4] = '\0';
+                oldest_time = st.st_mtime;
+            }
+        }
+        closedir(dir);
+
+        if (oldest[0] == '\0') {
+            return;
+        }
+
+        char path[PATH_MAX_LEN];
+        cache_path(cache, oldest, "map", path, sizeof(path));
+        uint64_t bytes = map_file_bytes(path);
+        unlink(path);
+        cache_path(cache, oldest, "blk", path, sizeof(path));
+        unlink(path);
+        cache->used = bytes < cache->used ? cache->used - bytes : 0;
+    }
+}
+
+RemoteBlocks* remote_blocks_create(const char *dir, uint64_t budget)
+{
+    if (strlen(dir) >= PATH_MAX_LEN - 40) {
+        return NULL;
+    }
+
+    // Create the directory and its parents
+    char path[PATH_MAX_LEN];
+    snprintf(path, sizeof(path), "%s", dir);
+    for (char *p = path + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(path, 0755);  // Ignore EEXIST
+            *p = '/';
+        }
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        return NULL;
+    }
+
+    RemoteBlocks *cache = calloc(1, sizeof(RemoteBlocks));
+    if (!cache) {
+        return NULL;
+    }
+    snprintf(cache->dir, sizeof(cache->dir), "%s", dir);
+    cache->budget = budget;
+    pthread_mutex_init(&cache->mutex, NULL);
+
+    // Count what earlier runs left
+    DIR *d = opendir(dir);
+    if (d) {
+        struct dirent *entry;
+        while ((entry = readdir(d)) != NULL) {
+            size_t len = strlen(entry->d_name);
+            if (len > 4 && strcmp(entry->d_name + len - 4, ".map") == 0) {
+                snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+                cache->used += map_file_bytes(path);
+            }
+        }
+        closedir(d);
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    evict(cache, "");
+    pthread_mutex_unlock(&cache->mutex);
+    return cache;
+}
+
+void remote_blocks_destroy(RemoteBlocks *cache)
+{
+    if (!cache) {
+        return;
+    }
+    pthread_mutex_destroy(&cache->mutex);
+    free(cache);
+}
+
+// Helper: Whether the map file holds this key at this version; reads its blocks if so
+static bool map_matches(RemoteBlockFile *file, const char *key, int64_t mtime)
+{
+    MapHeader header;
+    size_t key_len = strlen(key);
+    if (pread(file->map_fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        header.magic != REMOTE_BLOCKS_MAGIC || header.version != REMOTE_BLOCKS_VERSION ||
+        header.size != file->size || header.mtime != mtime || header.key_len != key_len) {
+        return false;
+    }
+
+    char *stored = malloc(key_len + 1);
+    bool same = stored && pread(file->map_fd, stored, key_len, sizeof(header)) == (ssize_t)key_len &&
+                memcmp(stored, key, key_len) == 0;
+    free(stored);
+    return same && pread(file->map_fd, file->present, file->block_count, file->map_blocks_at) ==
+                   (ssize_t)file->block_count;
+}
+
+// Helper: Start the file over at a new version: empty sparse data, no blocks present
+static bool map_reset(RemoteBlockFile *file, const char *key, int64_t mtime)
+{
+    MapHeader header = { REMOTE_BLOCKS_MAGIC, REMOTE_BLOCKS_VERSION, file->size, mtime, (uint32_t)strlen(key) };
+    memset(file->present, 0, file->block_count);
+
+    return ftruncate(file->map_fd, 0) == 0 &&
+           pwrite(file->map_fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+           pwrite(file->map_fd, key, header.key_len, sizeof(header)) == (ssize_t)header.key_len &&
+           ftruncate(file->map_fd, file->map_blocks_at + (off_t)file->block_count) == 0 &&
+           ftruncate(file->data_fd, 0) == 0 && ftruncate(file->data_fd, (off_t)file->size) == 0;
+}
+
+// Helper: Open the blocks of a file version, starting them over if create is set and
+// they are missing or older, else failing
+static RemoteBlockFile* open_file(RemoteBlocks *cache, const char *key, uint64_t size, int64_t mtime, bool create)
+{
+    RemoteBlockFile *file = calloc(1, sizeof(RemoteBlockFile));
+    if (!file) {
+        return NULL;
+    }
+    file->cache = cache;
+    file->size = size;
+    file->block_count = (size + REMOTE_BLOCK_SIZE - 1) / REMOTE_BLOCK_SIZE;
+    file->present = calloc(file->block_count ? file->block_count : 1, 1);
+    file->map_blocks_at = (off_t)(sizeof(MapHeader) + strlen(key));
+    file->data_fd = -1;
+    file->map_fd = -1;
+    snprintf(file->name, sizeof(file->name), "%016llx", (unsigned long long)key_hash(key));
+
+    char path[PATH_MAX_LEN];
+    cache_path(cache, file->name, "map", path, sizeof(path));
+    int flags = create ? O_RDWR | O_CREAT : O_RDWR;
+    file->map_fd = open(path, flags, 0644);
+    cache_path(cache, file->name, "blk", path, sizeof(path));
+    file->data_fd = open(path, flags, 0644);
+    if (!file->present || file->map_fd < 0 || file->data_fd < 0) {
+        remote_blocks_close(file);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    bool ok = map_matches(file, key, mtime);
+    if (!ok && create) {
+        // Whatever an older version (or another key) left no longer counts
+        cache_path(cache, file->name, "map", path, sizeof(path));
+        uint64_t stale = map_file_bytes(path);
+        cache->used = stale < cache->used ? cache->used - stale : 0;
+        ok = map_reset(file, key, mtime);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    if (!ok) {
+        remote_blocks_close(file);
+        return NULL;
+    }
+
+    // Opened most recently: evicted last
+    futimens(file->map_fd, NULL);
+    return file;
+}
+
+RemoteBlockFile* remote_blocks_open(RemoteBlocks *cache, const char *key, uint64_t size, int64_t mtime)
+{
+    return open_file(cache, key, size, mtime, true);
+}
+
+RemoteBlockFile* remote_blocks_find(RemoteBlocks *cache, const char *key, uint64_t size, int64_t mtime)
+{
+    return open_file(cache, key, size, mtime, false);
+}
+
+void remote_blocks_close(RemoteBlockFile *file)
+{
+    if (!file) {
+        return;
+    }
+    if (file->data_fd >= 0) {
+        close(file->data_fd);
+    }
+    if (file->map_fd >= 0) {
+        close(file->map_fd);
+    }
+    free(file->present);
+    free(file);
+}
+
+uint64_t remote_blocks_size(const RemoteBlockFile *file)
+{
+    return file->size;
+}
+
+bool remote_blocks_missing(const RemoteBlockFile *file, uint64_t offset, uint64_t length,
+                           uint64_t *run_offset, uint64_t *run_length)
+{
+    if (offset >= file->size || length == 0) {
+        return false;
+    }
+    uint64_t end = length > file->size - offset ? file->size : offset + length;
+    uint64_t first = offset / REMOTE_BLOCK_SIZE;
+    uint64_t last = (end - 1) / REMOTE_BLOCK_SIZE;
+
+    for (uint64_t i = first; i <= last; i++) {
+        if (file->present[i]) {
+            continue;
+        }
+        uint64_t j = i + 1;
+        while (j <= last && !file->present[j]) {
+            j++;
+        }
+        uint64_t run_end = j * REMOTE_BLOCK_SIZE < file->size ? j * REMOTE_BLOCK_SIZE : file->size;
+        *run_offset = i * REMOTE_BLOCK_SIZE;
+        *run_length = run_end - *run_offset;
+        return true;
+    }
+    return false;
+}
+
+int remote_blocks_fd(const RemoteBlockFile *file)
+{
+    return file->data_fd;
+}
+
+void remote_blocks_fill(RemoteBlockFile *file, uint64_t offset, uint64_t length)
+{
+    if (offset >= file->size || length == 0) {
+        return;
+    }
+    uint64_t end = length > file->size - offset ? file->size : offset + length;
+    uint64_t first = (offset + REMOTE_BLOCK_SIZE - 1) / REMOTE_BLOCK_SIZE;
+    uint64_t last = end == file->size ? file->block_count : end / REMOTE_BLOCK_SIZE;
+
+    uint64_t added = 0;
+    for (uint64_t i = first; i < last; i++) {
+        if (!file->present[i]) {
+            file->present[i] = 1;
+            added += block_bytes(file->size, i);
+        }
+    }
+    if (added == 0) {
+        return;
+    }
+
+    // Data first, then the map that says it is there
+    pwrite(file->map_fd, file->present + first, (size_t)(last - first), file->map_blocks_at + (off_t)first);
+
+    RemoteBlocks *cache = file->cache;
+    pthread_mutex_lock(&cache->mutex);
+    cache->used += added;
+    if (cache->used > cache->budget) {
+        evict(cache, file->name);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+ssize_t remote_blocks_read(RemoteBlockFile *file, uint64_t offset, void *buf, size_t length)
+{
+    if (offset >= file->size || length == 0) {
+        return 0;
+    }
+    uint64_t end = length > file->size - offset ? file->size : offset + length;
+    uint64_t run_offset, run_length;
+    if (remote_blocks_missing(file, offset, end - offset, &run_offset, &run_length)) {
+        return -1;
+    }
+
+    size_t total = (size_t)(end - offset);
+    size_t done = 0;
+    while (done < total) {
+        ssize_t n = pread(file->data_fd, (char *)buf + done, total - done, (off_t)(offset + done));
+        if (n <= 0) {
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return (ssize_t)done;
+}
+
+bool remote_blocks_complete(const RemoteBlockFile *file)
+{
+    uint64_t run_offset, run_length;
+    return !remote_blocks_missing(file, 0, file->size, &run_offset, &run_length);
+}
+
+uint64_t remote_blocks_used(RemoteBlocks *cache)
+{
+    pthread_mutex_lock(&cache->mutex);
+    uint64_t used = cache->used;
+    pthread_mutex_unlock(&cache->mutex);
+    return used;
+}
@@ -0,0 +1,67 @@
+#ifndef REMOTE_BLOCKS_H
+#define REMOTE_BLOCKS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// Byte-range cache of remote files on local disk. Each remote file version (its key,
+// size and mtime) gets a sparse local file holding whichever REMOTE_BLOCK_SIZE blocks
+// have been fetched, and a map of which those are, so a preview that read the first
+// block, a hash that read more and a copy that wants all of it each fetch only what no
+// one fetched before, and a later run starts where the last one stopped. A file whose
+// size or mtime changed starts empty. Files least recently opened are removed once
+// the cache holds more than its budget
+
+#define REMOTE_BLOCK_SIZE (64 * 1024)
+#define REMOTE_BLOCKS_BUDGET (512ULL * 1024 * 1024)
+
+// Cache directory and its accounting (opaque, thread-safe)
+typedef struct RemoteBlocks RemoteBlocks;
+
+// One remote file's cached blocks, used by one thread at a time (opaque)
+typedef struct RemoteBlockFile RemoteBlockFile;
+
+// Use dir (created if missing) for at most budget bytes of blocks; NULL on failure
+RemoteBlocks* remote_blocks_create(const char *dir, uint64_t budget);
+
+// Free the cache (its files stay on disk for next time); files still open stay usable
+// until closed
+void remote_blocks_destroy(RemoteBlocks *cache);
+
+// Open the blocks of the remote file named by key (server and path, any string), at
+// the version given by size and mtime; NULL on I/O error
+RemoteBlockFile* remote_blocks_open(RemoteBlocks *cache, const char *key, uint64_t size, int64_t mtime);
+
+// Open the blocks of that version only if some are already cached; NULL otherwise
+RemoteBlockFile* remote_blocks_find(RemoteBlocks *cache, const char *key, uint64_t size, int64_t mtime);
+
+void remote_blocks_close(RemoteBlockFile *file);
+
+// Size of the remote file
+uint64_t remote_blocks_size(const RemoteBlockFile *file);
+
+// The first run of missing blocks overlapping [offset, offset + length), as a byte
+// range clipped to the file; false when every block there is present
+bool remote_blocks_missing(const RemoteBlockFile *file, uint64_t offset, uint64_t length,
+                           uint64_t *run_offset, uint64_t *run_length);
+
+// Local file descriptor that fetched bytes go into, at their offset in the remote file
+int remote_blocks_fd(const RemoteBlockFile *file);
+
+// Record that [offset, offset + length) has been written to the fd; only whole blocks
+// (or the tail block, up to the end of the file) count as present
+void remote_blocks_fill(RemoteBlockFile *file, uint64_t offset, uint64_t length);
+
+// Copy present bytes at offset into buf; returns the bytes copied (short at the end of
+// the file), or -1 if a block there is missing
+ssize_t remote_blocks_read(RemoteBlockFile *file, uint64_t offset, void *buf, size_t length);
+
+// Whether every block of the file is present
+bool remote_blocks_complete(const RemoteBlockFile *file);
+
+// Bytes of blocks the cache holds
+uint64_t remote_blocks_used(RemoteBlocks *cache);
+
+#endif // REMOTE_BLOCKS_H
@@ -4,16 +4,63 @@
 #include "../ui/sidebar.h"
 #include "../utils/theme.h"
 #include "../utils/font.h"
+#include "../utils/fuzzy.h"
 #include "../ai/semantic_search.h"
+#include "../ai/path_index.h"
+#include "../utils/trace.h"
+#include "../utils/jobs.h"
+#include "filter_query.h"
+#include "spotlight_search.h"
 #include "raylib.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 
 // Search bar height
 #define SEARCH_BAR_HEIGHT 32
 
+// Rows of index results listed under the search bar
+#define SEARCH_PATH_ROWS 12
+#define SEARCH_PATH_ROW_HEIGHT 22
+
+// Blended score of a semantic result: its name score (relative to the best name match)
+// and its similarity, out of 1000 together
+#define SEARCH_BLEND_NAME 400
+#define SEARCH_BLEND_SEMANTIC 600
+
+// A semantic query running on the job scheduler, listed in SearchState.semantic_jobs
+// until its completion frees it (search and dir are only touched on the main thread)
+typedef struct SearchSemanticJob {
+    struct SearchSemanticJob *next;
+    SearchState *search;
+    const DirectoryState *dir;
+    SemanticSearch *engine;
+    JobToken *token;
+    char query[SEARCH_MAX_QUERY];
+    char directory[PATH_MAX_LEN];
+    SemanticSearchResults results;
+} SearchSemanticJob;
+
+// Cancel the semantic queries in flight, waiting for running ones when wait is set
+static void search_cancel_semantic(SearchState *search, bool wait)
+{
+    for (SearchSemanticJob *job = search->semantic_jobs; job; job = job->next) {
+        job_token_cancel(job->token);
+        if (wait) {
+            job_token_wait(job->token);
+        }
+    }
+}
+
+// Whether the newest semantic query is still running for the current query
+static bool search_semantic_running(const SearchState *search)
+{
+    return search->semantic_jobs && !job_token_cancelled(search->semantic_jobs->token);
+}
+
 void search_init(SearchState *search)
 {
     memset(search, 0, sizeof(SearchState));
@@ -30,7 +77,21 @@ void search_start(SearchState *search)
     search->query[0] = '\0';
     search->cursor = 0;
     search->result_count = 0;
+    search->match_total = 0;
     search->selected_result = 0;
+    search->semantic_pending = false;
+    search->spotlight_available = spotlight_search_available("/");  // Probe kept a minute
+}
+
+// Free match sets deeper than keep
+static void search_drop_levels(SearchState *search, int keep)
+{
+    while (search->level_count > keep) {
+        SearchLevel *level = &search->levels[--search->level_count];
+        free(level->candidates);
+        level->candidates = NULL;
+        level->count = 0;
+    }
 }
 
 void search_stop(SearchState *search)
@@ -39,7 +100,25 @@ void search_stop(SearchState *search)
     search->query[0] = '\0';
     search->cursor = 0;
     search->result_count = 0;
+    search->match_total = 0;
     search->selected_result = 0;
+    search->semantic_pending = false;
+    search_cancel_semantic(search, true);   // Their engine may be about to go away
+
+    free(search->name_masks);
+    free(search->folded_names);
+    search->name_masks = NULL;
+    search->folded_names = NULL;
+    search->name_mask_count = 0;
+    search->name_mask_generation = 0;
+
+    search_drop_levels(search, 0);
+    path_index_results_free(&search->path_results);
+    spotlight_search_cancel(search->spotlight_job);
+    search->spotlight_job = NULL;
+    content_search_cancel(search->content_job);
+    search->content_job = NULL;
+    content_search_results_free(&search->content_results);
 }
 
 void search_input_char(SearchState *search, char c)
@@ -103,144 +182,290 @@ static int result_compare(const void *a, const void *b)
 {
     const SearchResult *ra = (const SearchResult *)a;
     const SearchResult *rb = (const SearchResult *)b;
-    // Higher score first
-    return rb->score - ra->score;
+    // Higher score first, then directory order
+    if (ra->score != rb->score) {
+        return rb->score - ra->score;
+    }
+    return ra->original_index - rb->original_index;
+}
+
+//=============================================================================
+// Prefilter: a 64-bit set of the (case-folded) characters in each name. An
+// entry can only match if it contains every character of the query, which
+// is one AND per entry instead of a scoring pass over the name. The folded
+// names let the matcher memchr instead of lowering each character it reads
+//=============================================================================
+
+// (Re)build the mask and folded name tables if the listing changed since the last search
+static bool search_update_masks(SearchState *search, const DirectoryState *dir)
+{
+    if (search->name_masks && search->name_mask_count == dir->count &&
+        search->name_mask_generation == dir->generation) {
+        return true;
+    }
+
+    free(search->name_masks);
+    free(search->folded_names);
+    search->name_masks = NULL;
+    search->folded_names = NULL;
+    search->name_mask_count = 0;
+    if (dir->count == 0) {
+        return false;
+    }
+
+    search->name_masks = malloc(dir->count * sizeof(uint64_t));
+    search->folded_names = malloc(dir->names_size > 0 ? dir->names_size : 1);
+    if (!search->name_masks || !search->folded_names) {
+        free(search->name_masks);
+        free(search->folded_names);
+        search->name_masks = NULL;
+        search->folded_names = NULL;
+        return false;
+    }
+    fuzzy_fold(search->folded_names, dir->names, dir->names_size);
+    for (int i = 0; i < dir->count; i++) {
+        search->name_masks[i] = fuzzy_char_mask(directory_entry_name(dir, &dir->entries[i]));
+    }
+    search->name_mask_count = dir->count;
+    search->name_mask_generation = dir->generation;
+    return true;
+}
+
+//=============================================================================
+// Top-K results: results[] is kept as a min-heap on (score, -index) while
+// scanning, so the weakest kept match is always at the root
+//=============================================================================
+
+static bool result_worse(const SearchResult *a, const SearchResult *b)
+{
+    return a->score < b->score || (a->score == b->score && a->original_index > b->original_index);
+}
+
+static void heap_sift_down(SearchResult *heap, int count, int i)
+{
+    for (;;) {
+        int worst = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < count && result_worse(&heap[left], &heap[worst])) worst = left;
+        if (right < count && result_worse(&heap[right], &heap[worst])) worst = right;
+        if (worst == i) return;
+        SearchResult tmp = heap[i];
+        heap[i] = heap[worst];
+        heap[worst] = tmp;
+        i = worst;
+    }
+}
+
+static void heap_offer(SearchState *search, int index, int score)
+{
+    SearchResult candidate = { .original_index = index, .score = score };
+    SearchResult *heap = search->results;
+
+    if (search->result_count < SEARCH_MAX_RESULTS) {
+        int i = search->result_count++;
+        heap[i] = candidate;
+        while (i > 0) {
+            int parent = (i - 1) / 2;
+            if (!result_worse(&heap[i], &heap[parent])) break;
+            SearchResult tmp = heap[i];
+            heap[i] = heap[parent];
+            heap[parent] = tmp;
+            i = parent;
+        }
+    } else if (result_worse(&heap[0], &candidate)) {
+        heap[0] = candidate;
+        heap_sift_down(heap, search->result_count, 0);
+    }
 }
 
 int search_fuzzy_match(const char *query, const char *text, int *match_positions, int *match_count, bool case_sensitive)
 {
-    if (!query || !text || query[0] == '\0') {
+    FuzzyQuery compiled;
+    if (!text || !fuzzy_compile(&compiled, query, case_sensitive)) {
         if (match_count) *match_count = 0;
         return 0;
     }
+    return fuzzy_score(&compiled, text, NULL, -1, match_positions, SEARCH_MAX_POSITIONS, match_count);
+}
 
-    int q_len = strlen(query);
-    int t_len = strlen(text);
-    int q_idx = 0;
-    int t_idx = 0;
-    int score = 0;
-    int matches = 0;
-    int consecutive_bonus = 0;
-    int prev_match_idx = -2;
+// Case-insensitive substring search; returns the match offset or -1
+static int find_substring(const char *name, const char *query, bool case_sensitive)
+{
+    if (case_sensitive) {
+        const char *found = strstr(name, query);
+        return found ? (int)(found - name) : -1;
+    }
 
-    while (q_idx < q_len && t_idx < t_len) {
-        char q_char = case_sensitive ? query[q_idx] : tolower((unsigned char)query[q_idx]);
-        char t_char = case_sensitive ? text[t_idx] : tolower((unsigned char)text[t_idx]);
+    char lower_name[NAME_MAX_LEN];
+    char lower_query[SEARCH_MAX_QUERY];
+    strncpy(lower_name, name, NAME_MAX_LEN - 1);
+    lower_name[NAME_MAX_LEN - 1] = '\0';
+    strncpy(lower_query, query, SEARCH_MAX_QUERY - 1);
+    lower_query[SEARCH_MAX_QUERY - 1] = '\0';
 
-        if (q_char == t_char) {
-            // Matched
-            if (match_positions && matches < 64) {
-                match_positions[matches] = t_idx;
-            }
-            matches++;
+    for (int j = 0; lower_name[j]; j++) {
+        lower_name[j] = tolower((unsigned char)lower_name[j]);
+    }
+    for (int j = 0; lower_query[j]; j++) {
+        lower_query[j] = tolower((unsigned char)lower_query[j]);
+    }
 
-            // Base score for match
-            score += 10;
+    const char *found = strstr(lower_name, lower_query);
+    return found ? (int)(found - lower_name) : -1;
+}
 
-            // Bonus for consecutive matches
-            if (t_idx == prev_match_idx + 1) {
-                consecutive_bonus++;
-                score += 5 * consecutive_bonus;
-            } else {
-                consecutive_bonus = 0;
-            }
+// folded is the lower-case name arena, or NULL if it could not be built
+static int score_entry(const SearchState *search, const DirectoryState *dir, const FuzzyQuery *query,
+                       const char *folded, int index)
+{
+    const FileEntry *entry = &dir->entries[index];
+    const char *name = directory_entry_name(dir, entry);
+    const char *folded_name = folded ? folded + entry->name_offset : NULL;
+    if (search->fuzzy_enabled) {
+        return fuzzy_score(query, name, folded_name, entry->name_len, NULL, 0, NULL);
+    }
+    // Exact substring match
+    if (folded_name && !search->case_sensitive) {
+        return strstr(folded_name, query->folded) ? 100 : 0;
+    }
+    return find_substring(name, search->name_query, search->case_sensitive) >= 0 ? 100 : 0;
+}
 
-            // Bonus for match at start of word
-            if (t_idx == 0 || text[t_idx - 1] == ' ' || text[t_idx - 1] == '_' ||
-                text[t_idx - 1] == '-' || text[t_idx - 1] == '.') {
-                score += 15;
-            }
+// Keep the levels whose prefix is still a prefix of the query; returns the deepest usable one
+static SearchLevel *search_reuse_levels(SearchState *search, const DirectoryState *dir, int query_len)
+{
+    if (search->level_generation != dir->generation ||
+        search->level_fuzzy != search->fuzzy_enabled ||
+        search->level_case_sensitive != search->case_sensitive) {
+        search_drop_levels(search, 0);
+        search->level_generation = dir->generation;
+        search->level_fuzzy = search->fuzzy_enabled;
+        search->level_case_sensitive = search->case_sensitive;
+    }
 
-            // Bonus for uppercase in camelCase
-            if (t_idx > 0 && isupper((unsigned char)text[t_idx]) &&
-                islower((unsigned char)text[t_idx - 1])) {
-                score += 10;
-            }
+    int common = 0;
+    while (common < query_len && search->level_query[common] == search->query[common]) {
+        common++;
+    }
 
-            prev_match_idx = t_idx;
-            q_idx++;
-        }
-        t_idx++;
+    int keep = search->level_count;
+    while (keep > 0 && search->levels[keep - 1].query_len > common) {
+        keep--;
     }
+    search_drop_levels(search, keep);
 
-    if (match_count) *match_count = matches;
+    return keep > 0 ? &search->levels[keep - 1] : NULL;
+}
 
-    // Must match all query characters
-    if (q_idx < q_len) {
-        return 0;
+// Filter terms select entries through the column kernels; the words left are scored
+// against the survivors' names (every survivor matches, in listing order, if none are left)
+static void search_perform_filtered(SearchState *search, DirectoryState *dir, const FilterQuery *filter)
+{
+    int words = (dir->count + 63) / 64;
+    uint64_t *mask = malloc((words > 0 ? words : 1) * sizeof(uint64_t));
+    if (!mask || filter_query_run(filter, dir, mask, words) <= 0) {
+        free(mask);
+        return;
     }
 
-    // Bonus for shorter text (better match density)
-    if (t_len > 0) {
-        score += (100 * matches) / t_len;
+    FuzzyQuery query;
+    bool has_text = fuzzy_compile(&query, search->name_query, search->case_sensitive);
+    const char *folded = search_update_masks(search, dir) ? search->folded_names : NULL;
+    for (int w = 0; w < words; w++) {
+        uint64_t word = mask[w];
+        while (word) {
+            int i = w * 64 + __builtin_ctzll(word);
+            word &= word - 1;
+            int score = has_text ? score_entry(search, dir, &query, folded, i) : 1;
+            if (score > 0) {
+                search->match_total++;
+                heap_offer(search, i, score);
+            }
+        }
     }
-
-    return score;
+    free(mask);
 }
 
 void search_perform(SearchState *search, DirectoryState *dir)
 {
+    TRACE_SCOPE("search_perform");
     search->result_count = 0;
+    search->match_total = 0;
     search->selected_result = 0;
 
     if (search->query[0] == '\0') {
+        search->name_query[0] = '\0';
         return;
     }
 
-    for (int i = 0; i < dir->count && search->result_count < SEARCH_MAX_RESULTS; i++) {
-        FileEntry *entry = &dir->entries[i];
-
-        int match_positions[64];
-        int match_count = 0;
-
-        int score;
-        if (search->fuzzy_enabled) {
-            score = search_fuzzy_match(search->query, entry->name,
-                                       match_positions, &match_count,
-                                       search->case_sensitive);
-        } else {
-            // Exact substring match
-            const char *found = NULL;
-            if (search->case_sensitive) {
-                found = strstr(entry->name, search->query);
-            } else {
-                // Case-insensitive search
-                char lower_name[NAME_MAX_LEN];
-                char lower_query[SEARCH_MAX_QUERY];
-                strncpy(lower_name, entry->name, NAME_MAX_LEN - 1);
-                lower_name[NAME_MAX_LEN - 1] = '\0';
-                strncpy(lower_query, search->query, SEARCH_MAX_QUERY - 1);
-                lower_query[SEARCH_MAX_QUERY - 1] = '\0';
-
-                for (int j = 0; lower_name[j]; j++) {
-                    lower_name[j] = tolower((unsigned char)lower_name[j]);
-                }
-                for (int j = 0; lower_query[j]; j++) {
-                    lower_query[j] = tolower((unsigned char)lower_query[j]);
-                }
+    FilterQuery filter;
+    filter_query_compile(&filter, search->query, time(NULL));
+    if (filter.term_count > 0) {
+        snprintf(search->name_query, sizeof(search->name_query), "%s", filter.text);
+        search_perform_filtered(search, dir, &filter);
+        if (search->result_count > 1) {
+            qsort(search->results, search->result_count, sizeof(SearchResult), result_compare);
+        }
+        return;
+    }
+    memcpy(search->name_query, search->query, sizeof(search->name_query));
+
+    int query_len = (int)strlen(search->query);
+    SearchLevel *base = search_reuse_levels(search, dir, query_len);
+
+    // Compiled once for every entry scored below; without masks (OOM) every entry
+    // goes straight to scoring, folding as it goes
+    FuzzyQuery query;
+    fuzzy_compile(&query, search->query, search->case_sensitive);
+    const uint64_t *masks = search_update_masks(search, dir) ? search->name_masks : NULL;
+    const char *folded = masks ? search->folded_names : NULL;
+
+    if (base && base->query_len == query_len) {
+        // Same query as a kept level (e.g. after backspace): rescore its matches only
+        for (int i = 0; i < base->count; i++) {
+            heap_offer(search, base->candidates[i], score_entry(search, dir, &query, folded, base->candidates[i]));
+        }
+        search->match_total = base->count;
+    } else {
+        // Narrow the longest matched prefix, or scan the whole directory
+        int source_count = base ? base->count : dir->count;
+        int *matched = malloc((source_count > 0 ? source_count : 1) * sizeof(int));
+
+        // A full scan prefilters the mask table in one vectorized pass; the
+        // survivors are written in place of the indices they are read from
+        const int *sources = base ? base->candidates : NULL;
+        if (!base && masks && matched) {
+            source_count = fuzzy_prefilter(&query, masks, dir->count, matched);
+            sources = matched;
+            masks = NULL;
+        }
 
-                found = strstr(lower_name, lower_query);
+        for (int s = 0; s < source_count; s++) {
+            int i = sources ? sources[s] : s;
+            if (masks && !fuzzy_may_match(&query, masks[i])) {
+                continue;
             }
 
-            if (found) {
-                score = 100;
-                match_count = strlen(search->query);
-                size_t offset = found - entry->name;
-                for (int j = 0; j < match_count && j < 64; j++) {
-                    match_positions[j] = (int)(offset + j);
+            int score = score_entry(search, dir, &query, folded, i);
+            if (score > 0) {
+                if (matched) {
+                    matched[search->match_total] = i;
                 }
-            } else {
-                score = 0;
+                search->match_total++;
+                heap_offer(search, i, score);
             }
         }
 
-        if (score > 0) {
-            SearchResult *result = &search->results[search->result_count];
-            result->original_index = i;
-            result->score = score;
-            result->match_count = match_count;
-            memcpy(result->match_positions, match_positions, sizeof(match_positions));
-            search->result_count++;
+        // Remember this match set for the next keystroke
+        if (matched && search->level_count < SEARCH_MAX_LEVELS) {
+            SearchLevel *level = &search->levels[search->level_count++];
+            level->query_len = query_len;
+            level->candidates = matched;
+            level->count = search->match_total;
+            memcpy(search->level_query, search->query, query_len + 1);
+        } else {
+            free(matched);
         }
     }
 
@@ -250,6 +475,41 @@ void search_perform(SearchState *search, DirectoryState *dir)
     }
 }
 
+int search_match_positions(const SearchState *search, const DirectoryState *dir, int result_index,
+                           int *positions, int max_positions)
+{
+    if (result_index < 0 || result_index >= search->result_count || search->name_query[0] == '\0') {
+        return 0;
+    }
+    int entry_index = search->results[result_index].original_index;
+    if (entry_index < 0 || entry_index >= dir->count) {
+        return 0;
+    }
+    if (max_positions > SEARCH_MAX_POSITIONS) {
+        max_positions = SEARCH_MAX_POSITIONS;
+    }
+
+    const char *name = directory_entry_name(dir, &dir->entries[entry_index]);
+    int count = 0;
+    if (search->fuzzy_enabled) {
+        int all[SEARCH_MAX_POSITIONS];
+        if (search_fuzzy_match(search->name_query, name, all, &count, search->case_sensitive) == 0) {
+            count = 0;  // A semantic hit whose name does not match
+        }
+        if (count > max_positions) count = max_positions;
+        memcpy(positions, all, count * sizeof(int));
+    } else {
+        int offset = find_substring(name, search->name_query, search->case_sensitive);
+        if (offset >= 0) {
+            int len = (int)strlen(search->name_query);
+            for (; count < len && count < max_positions; count++) {
+                positions[count] = offset + count;
+            }
+        }
+    }
+    return count;
+}
+
 int search_get_selected_index(SearchState *search)
 {
     if (search->result_count == 0) return -1;
@@ -266,19 +526,80 @@ bool search_is_active(SearchState *search)
 static void search_perform_current(struct App *app)
 {
     SearchState *search = &app->search;
-    if (search->search_type == SEARCH_TYPE_SEMANTIC && search->semantic_available) {
-        search_perform_semantic(app, search->query);
+    search->semantic_pending = false;
+    search_cancel_semantic(search, false);
+    if (search->search_type != SEARCH_TYPE_CONTENT && search->content_job) {
+        content_search_cancel(search->content_job);
+        search->content_job = NULL;
+    }
+    if (search->search_type != SEARCH_TYPE_PATHS && search->spotlight_job) {
+        spotlight_search_cancel(search->spotlight_job);
+        search->spotlight_job = NULL;
+    }
+    if (search->search_type == SEARCH_TYPE_SEMANTIC && (search->semantic_available || search->semantic_warming)) {
+        // Names match at once. The query is encoded in the background once typing
+        // pauses (loading the model first, if need be) and searched on the scheduler
+        // when ready (or on Enter); its hits are blended in as they arrive
+        search_perform(search, &app->directory);
+        if (search->query[0] == '\0') {
+            // Nothing to search for
+        } else if (search->semantic_available && semantic_search_is_prefetched(app->semantic_search, search->query)) {
+            search_perform_semantic(app, search->query);
+        } else {
+            semantic_search_prefetch(app->semantic_search, search->query);
+            search->semantic_pending = true;
+        }
+    } else if (search->search_type == SEARCH_TYPE_PATHS && search->paths_available) {
+        search_perform_paths(app, search->query);
+    } else if (search->search_type == SEARCH_TYPE_CONTENT) {
+        search_perform_content(app, search->query);
     } else {
         search_perform(search, &app->directory);
     }
 }
 
+// Open the directory containing an index match and select it
+static void search_open_path(struct App *app, const char *path)
+{
+    char dir[PATH_MAX_LEN];
+    strncpy(dir, path, sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = '\0';
+    char *slash = strrchr(dir, '/');
+    if (slash == NULL) {
+        return;
+    }
+    const char *name = path + (slash - dir) + 1;
+    if (slash == dir) {
+        slash[1] = '\0';
+    } else {
+        *slash = '\0';
+    }
+
+    if (!directory_read(&app->directory, dir)) {
+        return;
+    }
+    directory_stream_wait(&app->directory);  // Match may be past the first batch
+
+    app->selected_index = 0;
+    app->scroll_offset = 0;
+    selection_clear(&app->selection);
+    for (int i = 0; i < app->directory.count; i++) {
+        if (strcmp(directory_entry_name(&app->directory, &app->directory.entries[i]), name) == 0) {
+            app->selected_index = i;
+            break;
+        }
+    }
+    history_push(&app->history, app->directory.current_path);
+}
+
 void search_handle_input(struct App *app)
 {
     SearchState *search = &app->search;
 
-    // Update semantic availability
+    // Update semantic and filename index availability
     search->semantic_available = search_is_semantic_available(app);
+    search->semantic_warming = search_is_semantic_warming(app);
+    search->paths_available = app->path_index != NULL || search->spotlight_available;
 
     // Start search: /
     if (!search_is_active(search) && IsKeyPressed(KEY_SLASH)) {
@@ -288,6 +609,20 @@ void search_handle_input(struct App *app)
 
     if (!search_is_active(search)) return;
 
+    // Content matches stream in while the search runs
+    if (search->content_job && search->search_type == SEARCH_TYPE_CONTENT) {
+        search_poll_content(search);
+    }
+    if (search->spotlight_job && search->search_type == SEARCH_TYPE_PATHS) {
+        search_poll_paths(search);
+    }
+
+    // The typed query's embedding is ready: search with it
+    if (search->semantic_pending && search->semantic_available && !search_semantic_running(search) &&
+        semantic_search_is_prefetched(app->semantic_search, search->query)) {
+        search_perform_semantic(app, search->query);
+    }
+
     // Exit search: Escape
     if (IsKeyPressed(KEY_ESCAPE)) {
         search_stop(search);
@@ -306,6 +641,26 @@ void search_handle_input(struct App *app)
 
     // Confirm selection: Enter
     if (IsKeyPressed(KEY_ENTER)) {
+        if (search->semantic_pending) {
+            // Results first: search now rather than once typing pauses (or, with the
+            // database still opening, once it has), and take the selection after
+            if (search->semantic_available && !search_semantic_running(search)) {
+                search_perform_semantic(app, search->query);
+            }
+            return;
+        }
+        if (search->search_type == SEARCH_TYPE_PATHS &&
+            search->selected_result < search->path_results.count) {
+            search_open_path(app, search->path_results.paths[search->selected_result]);
+            search_stop(search);
+            return;
+        }
+        if (search->search_type == SEARCH_TYPE_CONTENT &&
+            search->selected_result < search->content_results.count) {
+            search_open_path(app, search->content_results.matches[search->selected_result].path);
+            search_stop(search);
+            return;
+        }
         int selected = search_get_selected_index(search);
         if (selected >= 0) {
             app->selected_index = selected;
@@ -391,6 +746,7 @@ void search_handle_input(struct App *app)
 
 void search_draw(struct App *app)
 {
+    TRACE_SCOPE("search_draw");
     SearchState *search = &app->search;
 
     if (!search_is_active(search)) return;
@@ -433,30 +789,80 @@ void search_draw(struct App *app)
     // Result count and search type indicator
     if (search->query[0] != '\0') {
         char count_str[64];
-        snprintf(count_str, sizeof(count_str), "%d/%d", search->selected_result + 1, search->result_count);
+        if (search->match_total > search->result_count) {
+            snprintf(count_str, sizeof(count_str), "%d/%d of %d", search->selected_result + 1,
+                     search->result_count, search->match_total);
+        } else {
+            snprintf(count_str, sizeof(count_str), "%d/%d", search->selected_result + 1, search->result_count);
+        }
         int count_width = MeasureTextCustom(count_str, FONT_SIZE_SMALL);
         DrawTextCustom(count_str, bar_x + content_width - count_width - PADDING, text_y + 2, FONT_SIZE_SMALL, g_theme.textSecondary);
     }
 
     // Draw search type indicator (Tab to toggle)
-    const char *type_label = search->search_type == SEARCH_TYPE_SEMANTIC ? "[AI]" : "[Fuzzy]";
-    Color type_color = search->search_type == SEARCH_TYPE_SEMANTIC ? g_theme.aiAccent : g_theme.textSecondary;
+    bool warming = search->search_type == SEARCH_TYPE_SEMANTIC && search->semantic_warming &&
+                   (search->semantic_pending || !search->semantic_available);
+    const char *type_label = warming ? "[AI warming up]" :
+                             search->search_type == SEARCH_TYPE_SEMANTIC ? "[AI]" :
+                             search->search_type == SEARCH_TYPE_PATHS ?
+                                 (search->spotlight_job ? "[Spotlight]" : "[Index]") :
+                             search->search_type == SEARCH_TYPE_CONTENT ? "[Text]" : "[Fuzzy]";
+    Color type_color = search->search_type == SEARCH_TYPE_SEMANTIC ? g_theme.aiAccent :
+                       search->search_type == SEARCH_TYPE_PATHS ||
+                       search->search_type == SEARCH_TYPE_CONTENT ? g_theme.accent : g_theme.textSecondary;
     int type_width = MeasureTextCustom(type_label, FONT_SIZE_SMALL);
     int type_x = bar_x + content_width - type_width - PADDING - 80;
     DrawTextCustom(type_label, type_x, text_y + 2, FONT_SIZE_SMALL, type_color);
+
+    // Index and content matches are outside the listing, so show them under the bar
+    int listed = search->search_type == SEARCH_TYPE_PATHS ? search->path_results.count :
+                 search->search_type == SEARCH_TYPE_CONTENT ? search->result_count : 0;
+    if (listed > 0) {
+        int first = 0;
+        if (search->selected_result >= SEARCH_PATH_ROWS) {
+            first = search->selected_result - SEARCH_PATH_ROWS + 1;
+        }
+        int rows = listed - first;
+        if (rows > SEARCH_PATH_ROWS) rows = SEARCH_PATH_ROWS;
+
+        int list_y = bar_y + bar_height;
+        DrawRectangle(bar_x, list_y, content_width, rows * SEARCH_PATH_ROW_HEIGHT, g_theme.sidebar);
+        for (int r = 0; r < rows; r++) {
+            int i = first + r;
+            int row_y = list_y + r * SEARCH_PATH_ROW_HEIGHT;
+            if (i == search->selected_result) {
+                DrawRectangle(bar_x, row_y, content_width, SEARCH_PATH_ROW_HEIGHT, g_theme.selection);
+            }
+            const char *label = search->search_type == SEARCH_TYPE_PATHS ? search->path_results.paths[i] : NULL;
+            char row[PATH_MAX_LEN + CONTENT_SEARCH_MAX_LINE + 16];
+            if (!label) {
+                // path:line: text, the path relative to the folder searched
+                const ContentMatch *match = &search->content_results.matches[i];
+                const char *path = match->path;
+                size_t dir_len = strlen(app->directory.current_path);
+                if (strncmp(path, app->directory.current_path, dir_len) == 0 && path[dir_len] == '/') {
+                    path += dir_len + 1;
+                }
+                snprintf(row, sizeof(row), "%s:%d: %s", path, match->line, match->text);
+                label = row;
+            }
+            DrawTextCustom(label, bar_x + PADDING,
+                           row_y + (SEARCH_PATH_ROW_HEIGHT - FONT_SIZE_SMALL) / 2,
+                           FONT_SIZE_SMALL, g_theme.textPrimary);
+        }
+        DrawLine(bar_x, list_y + rows * SEARCH_PATH_ROW_HEIGHT, bar_x + content_width,
+                 list_y + rows * SEARCH_PATH_ROW_HEIGHT, g_theme.border);
+    }
 }
 
 void search_toggle_type(SearchState *search)
 {
-    if (!search->semantic_available) {
-        // Can't toggle to semantic if not available
-        return;
-    }
-    if (search->search_type == SEARCH_TYPE_FUZZY) {
-        search->search_type = SEARCH_TYPE_SEMANTIC;
-    } else {
-        search->search_type = SEARCH_TYPE_FUZZY;
-    }
+    // Content search needs no index, so there is always another type
+    bool semantic = search->semantic_available || search->semantic_warming;
+    do {
+        search->search_type = (SearchType)((search->search_type + 1) % (SEARCH_TYPE_CONTENT + 1));
+    } while ((search->search_type == SEARCH_TYPE_SEMANTIC && !semantic) ||
+             (search->search_type == SEARCH_TYPE_PATHS && !search->paths_available));
 }
 
 const char* search_type_name(SearchType type)
@@ -464,6 +870,8 @@ const char* search_type_name(SearchType type)
     switch (type) {
         case SEARCH_TYPE_FUZZY: return "Fuzzy";
         case SEARCH_TYPE_SEMANTIC: return "Semantic";
+        case SEARCH_TYPE_PATHS: return "Paths";
+        case SEARCH_TYPE_CONTENT: return "Content";
         default: return "Unknown";
     }
 }
@@ -476,42 +884,347 @@ bool search_is_semantic_available(struct App *app)
     return semantic_search_is_ready(app->semantic_search);
 }
 
+bool search_is_semantic_warming(struct App *app)
+{
+    if (!app || !app->ai_enabled || !app->semantic_search) return false;
+    if (!embedding_engine_is_available(app->embedding_engine)) return false;
+    if (app->startup.adopted && !app->vectordb) return false;  // Failed to open
+    return !app->startup.adopted || !embedding_engine_is_loaded(app->embedding_engine);
+}
+
+// Helper: Run a semantic query on a worker
+static void semantic_job_run(void *arg, JobToken *token)
+{
+    SearchSemanticJob *job = arg;
+    if (job_token_cancelled(token)) {
+        return;
+    }
+    SemanticSearchOptions opts = semantic_search_default_options();
+    opts.max_results = SEARCH_MAX_RESULTS;
+    opts.min_score = 0.1f;  // Minimum similarity threshold
+    opts.directory = job->directory;  // Limit to current directory
+    job->results = semantic_search_query(job->engine, job->query, &opts);
+}
+
+// Helper: Blend a finished query's hits in if it is still the current one, then free it
+static void semantic_job_done(void *arg, bool cancelled)
+{
+    SearchSemanticJob *job = arg;
+    SearchState *search = job->search;
+    for (SearchSemanticJob **link = &search->semantic_jobs; *link; link = &(*link)->next) {
+        if (*link == job) {
+            *link = job->next;
+            break;
+        }
+    }
+
+    if (!cancelled && !job_token_cancelled(job->token) && strcmp(search->query, job->query) == 0 &&
+        strcmp(job->dir->current_path, job->directory) == 0) {
+        if (job->results.success) {
+            search_merge_semantic(search, job->dir, &job->results);
+        }
+        search->semantic_pending = false;
+    }
+
+    semantic_search_results_free(&job->results);
+    job_token_release(job->token);
+    free(job);
+}
+
 void search_perform_semantic(struct App *app, const char *query)
 {
     if (!app || !query || query[0] == '\0') return;
     if (!app->semantic_search) return;
 
     SearchState *search = &app->search;
+    search_cancel_semantic(search, false);
+
+    SearchSemanticJob *job = calloc(1, sizeof(SearchSemanticJob));
+    JobToken *token = job ? job_token_create() : NULL;
+    if (!token) {
+        free(job);
+        return;
+    }
+    job->search = search;
+    job->dir = &app->directory;
+    job->engine = app->semantic_search;
+    job->token = token;
+    snprintf(job->query, sizeof(job->query), "%s", query);
+    snprintf(job->directory, sizeof(job->directory), "%s", app->directory.current_path);
+
+    // Listed first: without workers it completes (and unlinks itself) inside jobs_submit
+    job->next = search->semantic_jobs;
+    search->semantic_jobs = job;
+    search->semantic_pending = true;
+    jobs_submit(JOB_QOS_USER_INITIATED, semantic_job_run, semantic_job_done, job, token);
+}
+
+// A semantic hit on an entry of the listed folder
+typedef struct SemanticHit {
+    const char *name;
+    int similarity;     // Out of SEARCH_BLEND_SEMANTIC
+    bool merged;
+} SemanticHit;
+
+static int semantic_hit_compare(const void *a, const void *b)
+{
+    return strcmp(((const SemanticHit *)a)->name, ((const SemanticHit *)b)->name);
+}
+
+// Helper: Find a name among hits sorted by name
+static SemanticHit *semantic_hit_find(SemanticHit *hits, int count, const char *name)
+{
+    SemanticHit key = { .name = name };
+    return bsearch(&key, hits, count, sizeof(SemanticHit), semantic_hit_compare);
+}
+
+// Helper: The name of path if it is directly inside dir, else NULL
+static const char *semantic_hit_name(const char *path, const char *dir)
+{
+    const char *slash = strrchr(path, '/');
+    if (!slash || slash[1] == '\0') {
+        return NULL;
+    }
+    size_t dir_len = strlen(dir);
+    while (dir_len > 1 && dir[dir_len - 1] == '/') {
+        dir_len--;
+    }
+    size_t parent_len = slash == path ? 1 : (size_t)(slash - path);
+    return parent_len == dir_len && strncmp(path, dir, dir_len) == 0 ? slash + 1 : NULL;
+}
+
+void search_merge_semantic(SearchState *search, const DirectoryState *dir, const SemanticSearchResults *hits)
+{
+    if (!hits || hits->count <= 0) {
+        return;
+    }
+    SemanticHit *named = malloc(hits->count * sizeof(SemanticHit));
+    SearchResult *merged = malloc((search->result_count + hits->count) * sizeof(SearchResult));
+    if (!named || !merged) {
+        free(named);
+        free(merged);
+        return;
+    }
+
+    // Hits in this folder, by name (a file listed twice keeps its best similarity)
+    int named_count = 0;
+    for (int i = 0; i < hits->count; i++) {
+        const char *name = semantic_hit_name(hits->results[i].path, dir->current_path);
+        if (name) {
+            float score = hits->results[i].score;
+            score = score < 0.0f ? 0.0f : score > 1.0f ? 1.0f : score;
+            named[named_count++] = (SemanticHit){ name, (int)(score * SEARCH_BLEND_SEMANTIC), false };
+        }
+    }
+    qsort(named, named_count, sizeof(SemanticHit), semantic_hit_compare);
+    int unique = 0;
+    for (int i = 0; i < named_count; i++) {
+        if (unique > 0 && strcmp(named[unique - 1].name, named[i].name) == 0) {
+            if (named[i].similarity > named[unique - 1].similarity) {
+                named[unique - 1].similarity = named[i].similarity;
+            }
+        } else {
+            named[unique++] = named[i];
+        }
+    }
+    named_count = unique;
+
+    // Name matches keep their place relative to each other, lifted by any similarity
+    int selected = search_get_selected_index(search);
+    int best = search->result_count > 0 && search->results[0].score > 0 ? search->results[0].score : 1;
+    int count = 0;
+    int remaining = named_count;
+    for (int i = 0; i < search->result_count; i++) {
+        int index = search->results[i].original_index;
+        SemanticHit *hit = semantic_hit_find(named, named_count,
+                                             directory_entry_name(dir, &dir->entries[index]));
+        int similarity = 0;
+        if (hit && !hit->merged) {
+            hit->merged = true;
+            similarity = hit->similarity;
+            remaining--;
+        }
+        merged[count].original_index = index;
+        merged[count].score = (int)((int64_t)search->results[i].score * SEARCH_BLEND_NAME / best) + similarity;
+        count++;
+    }
+
+    // The other hits join on similarity alone, unless filter terms narrow the listing
+    bool filtered = strcmp(search->name_query, search->query) != 0;
+    int added = 0;
+    for (int i = 0; i < dir->count && remaining > 0 && !filtered; i++) {
+        SemanticHit *hit = semantic_hit_find(named, named_count, directory_entry_name(dir, &dir->entries[i]));
+        if (hit && !hit->merged) {
+            hit->merged = true;
+            remaining--;
+            merged[count].original_index = i;
+            merged[count].score = hit->similarity;
+            count++;
+            added++;
+        }
+    }
+
+    qsort(merged, count, sizeof(SearchResult), result_compare);
+    if (count > SEARCH_MAX_RESULTS) {
+        count = SEARCH_MAX_RESULTS;
+    }
+    memcpy(search->results, merged, count * sizeof(SearchResult));
+    search->result_count = count;
+    search->match_total += added;
+
+    search->selected_result = 0;
+    for (int i = 0; i < count; i++) {
+        if (search->results[i].original_index == selected) {
+            search->selected_result = i;
+            break;
+        }
+    }
+    free(named);
+    free(merged);
+}
+
+// Helper: Name test of search_perform_paths for filter-only queries
+static bool path_filter_name(const char *name, void *context)
+{
+    return filter_query_match_name((const FilterQuery *)context, name);
+}
+
+// Helper: Drop the paths that fail the filter (their metadata is read from disk)
+static void search_filter_paths(PathIndexResults *results, const FilterQuery *filter)
+{
+    int kept = 0;
+    for (int i = 0; i < results->count; i++) {
+        if (filter_query_match_path(filter, results->paths[i])) {
+            results->paths[kept] = results->paths[i];
+            results->scores[kept] = results->scores[i];
+            kept++;
+        } else {
+            free(results->paths[i]);
+        }
+    }
+    results->total -= results->count - kept;
+    results->count = kept;
+}
+
+void search_perform_paths(struct App *app, const char *query)
+{
+    SearchState *search = &app->search;
+    path_index_results_free(&search->path_results);
+    spotlight_search_cancel(search->spotlight_job);
+    search->spotlight_job = NULL;
     search->result_count = 0;
+    search->match_total = 0;
     search->selected_result = 0;
 
-    // Perform semantic search
-    SemanticSearchOptions opts = semantic_search_default_options();
-    opts.max_results = SEARCH_MAX_RESULTS;
-    opts.min_score = 0.1f;  // Minimum similarity threshold
-    opts.directory = app->directory.current_path;  // Limit to current directory
-
-    SemanticSearchResults results = semantic_search_query(app->semantic_search, query, &opts);
-
-    if (results.success && results.count > 0) {
-        // Convert semantic results to search results
-        for (int i = 0; i < results.count && search->result_count < SEARCH_MAX_RESULTS; i++) {
-            SemanticSearchResult *sem_result = &results.results[i];
-
-            // Find the matching file in the current directory
-            for (int j = 0; j < app->directory.count; j++) {
-                FileEntry *entry = &app->directory.entries[j];
-                if (strcmp(entry->path, sem_result->path) == 0) {
-                    SearchResult *result = &search->results[search->result_count];
-                    result->original_index = j;
-                    result->score = (int)(sem_result->score * 1000);  // Convert to int score
-                    result->match_count = 0;  // No character-level matching for semantic
-                    search->result_count++;
-                    break;
-                }
-            }
+    if (!query || query[0] == '\0') return;
+
+    FilterQuery filter;
+    filter_query_compile(&filter, query, time(NULL));
+
+    // Spotlight searches the whole disk (a query of filters alone, the current folder)
+    // with nothing to index on our side; its matches arrive through search_poll_paths
+    const char *scope = filter.term_count > 0 && filter.text[0] == '\0' ? app->directory.current_path : "/";
+    search->spotlight_job = spotlight_search_start(scope, filter.text, &filter, SEARCH_MAX_RESULTS);
+    if (search->spotlight_job) {
+        return;
+    }
+    if (!app->path_index) return;
+
+    // Names narrow through the trigram index; a query of filters alone tests every
+    // name below the current folder. Either way the filters finish on the matches
+    bool found;
+    if (filter.term_count == 0) {
+        found = path_index_query(app->path_index, query, SEARCH_MAX_RESULTS, &search->path_results);
+    } else if (filter.text[0] != '\0') {
+        found = path_index_query(app->path_index, filter.text, SEARCH_MAX_RESULTS, &search->path_results);
+    } else {
+        found = path_index_find_names(app->path_index, app->directory.current_path, path_filter_name, &filter,
+                                      true, SEARCH_MAX_RESULTS, &search->path_results);
+    }
+    if (!found) {
+        return;
+    }
+    if (filter.term_count > 0) {
+        search_filter_paths(&search->path_results, &filter);
+    }
+
+    for (int i = 0; i < search->path_results.count; i++) {
+        search->results[i].original_index = -1;
+        search->results[i].score = search->path_results.scores[i];
+    }
+    search->result_count = search->path_results.count;
+    search->match_total = search->path_results.total;
+}
+
+void search_perform_content(struct App *app, const char *query)
+{
+    SearchState *search = &app->search;
+    content_search_cancel(search->content_job);
+    search->content_job = NULL;
+    content_search_results_free(&search->content_results);
+    search->result_count = 0;
+    search->match_total = 0;
+    search->selected_result = 0;
+
+    if (!query || query[0] == '\0') return;
+
+    // Smart case, as in ripgrep: a capital asks for an exact match
+    ContentSearchOptions options = content_search_default_options();
+    options.max_results = SEARCH_MAX_RESULTS;
+    options.case_sensitive = search->case_sensitive;
+    for (const char *c = query; *c && !options.case_sensitive; c++) {
+        options.case_sensitive = isupper((unsigned char)*c) != 0;
+    }
+    search->content_job = content_search_start(app->directory.current_path, query, &options);
+}
+
+bool search_poll_paths(SearchState *search)
+{
+    if (!search->spotlight_job) return false;
+
+    // Better matches may rank above the selected one: keep it selected
+    PathIndexResults *results = &search->path_results;
+    char selected[PATH_MAX_LEN] = "";
+    if (search->selected_result < results->count) {
+        snprintf(selected, sizeof(selected), "%s", results->paths[search->selected_result]);
+    }
+    int added = spotlight_search_poll(search->spotlight_job, results);
+    if (added == 0) {
+        return false;
+    }
+
+    search->selected_result = 0;
+    for (int i = 0; i < results->count; i++) {
+        search->results[i].original_index = -1;
+        search->results[i].score = results->scores[i];
+        if (strcmp(results->paths[i], selected) == 0) {
+            search->selected_result = i;
         }
     }
+    search->result_count = results->count;
+    search->match_total = results->total;
+    return true;
+}
 
-    semantic_search_results_free(&results);
+bool search_poll_content(SearchState *search)
+{
+    if (!search->content_job) return false;
+
+    bool done = content_search_is_done(search->content_job);
+    int added = content_search_poll(search->content_job, &search->content_results);
+    if (done) {
+        // Everything has been polled: the job is no longer needed
+        content_search_cancel(search->content_job);
+        search->content_job = NULL;
+    }
+
+    int count = search->content_results.count;
+    if (count > SEARCH_MAX_RESULTS) count = SEARCH_MAX_RESULTS;
+    for (int i = search->result_count; i < count; i++) {
+        search->results[i].original_index = -1;
+        search->results[i].score = 0;
+    }
+    search->result_count = count;
+    search->match_total = search->content_results.count;
+    return added > 0;
 }
@@ -2,7 +2,11 @@
 #define SEARCH_H
 
 #include "filesystem.h"
+#include "../ai/path_index.h"
+#include "content_search.h"
+#include "../ai/semantic_search.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 #define SEARCH_MAX_QUERY 256
 #define SEARCH_MAX_RESULTS 1024
@@ -14,34 +18,83 @@ typedef enum SearchMode {
     SEARCH_RESULTS
 } SearchMode;
 
+#define SEARCH_MAX_POSITIONS 64
+#define SEARCH_MAX_LEVELS 32    // Query prefixes whose match sets are kept
+
 // Search result with match score
+// Match positions are computed on demand with search_match_positions()
 typedef struct SearchResult {
     int original_index;     // Index in the directory entries
     int score;              // Match score (higher is better)
-    int match_positions[64]; // Positions of matched characters
-    int match_count;        // Number of matched positions
 } SearchResult;
 
+// All entries matching one prefix of the query (see SearchState.levels)
+typedef struct SearchLevel {
+    int query_len;          // Length of the prefix of level_query this level matched
+    int *candidates;        // Entry indices, in directory order
+    int count;
+} SearchLevel;
+
 // Search type enum
 typedef enum SearchType {
     SEARCH_TYPE_FUZZY,       // Filename fuzzy matching (default)
-    SEARCH_TYPE_SEMANTIC     // Semantic content search (AI-powered)
+    SEARCH_TYPE_SEMANTIC,    // Semantic content search (AI-powered)
+    SEARCH_TYPE_PATHS,       // Substring search over the recursive filename index
+    SEARCH_TYPE_CONTENT      // Literal search of file contents below the current folder
 } SearchType;
 
 // Search state
 typedef struct SearchState {
     SearchMode mode;
     char query[SEARCH_MAX_QUERY];
+    char name_query[SEARCH_MAX_QUERY];  // query without its filter terms (core/filter_query.h)
     int cursor;              // Cursor position in query
 
-    SearchResult results[SEARCH_MAX_RESULTS];
+    SearchResult results[SEARCH_MAX_RESULTS];  // Best matches, highest score first
     int result_count;
+    int match_total;         // All matches, including those beyond SEARCH_MAX_RESULTS
     int selected_result;     // Currently selected result index
 
+    // Character masks of each entry name, for rejecting entries before scoring,
+    // and a lower-case copy of the directory's name arena (same offsets) to match against
+    uint64_t *name_masks;
+    char *folded_names;
+    int name_mask_count;
+    uint32_t name_mask_generation;  // DirectoryState.generation the masks describe
+
+    // Match sets for successive prefixes of level_query: typing narrows the
+    // deepest set, backspace falls back to a shallower one
+    SearchLevel levels[SEARCH_MAX_LEVELS];
+    int level_count;
+    char level_query[SEARCH_MAX_QUERY];
+    uint32_t level_generation;
+    bool level_fuzzy;
+    bool level_case_sensitive;
+
     bool case_sensitive;
     bool fuzzy_enabled;      // Use fuzzy matching
-    SearchType search_type;  // Current search type (fuzzy vs semantic)
+    SearchType search_type;  // Current search type (fuzzy, semantic or paths)
     bool semantic_available; // Whether semantic search is available
+    bool semantic_pending;   // The query's semantic hits have not been merged yet (encoding or searching)
+    bool semantic_warming;   // Semantic search will be available once its model or database loads
+    bool paths_available;    // Whether the filename index or Spotlight is available
+    bool spotlight_available; // Whether Spotlight indexes the whole disk
+
+    // SEARCH_TYPE_PATHS matches live outside the directory, so results[] only
+    // carries their scores (original_index is -1). When Spotlight answers, they stream
+    // in from spotlight_job, polled each frame, and keep arriving as files come to match
+    PathIndexResults path_results;
+    struct SpotlightSearch *spotlight_job;
+
+    // SEARCH_TYPE_CONTENT matches stream in from a background search, polled each
+    // frame; results[] mirrors them as for paths
+    ContentSearchJob *content_job;
+    ContentSearchResults content_results;
+
+    // SEARCH_TYPE_SEMANTIC shows the fuzzy name matches at once and runs the semantic
+    // query on the job scheduler, blending its hits in when it completes. Every
+    // keystroke cancels the queries before it; they stay listed until they finish
+    struct SearchSemanticJob *semantic_jobs;   // Newest first
 } SearchState;
 
 // Forward declaration
@@ -74,9 +127,15 @@ void search_next_result(SearchState *search);
 // Navigate to previous result
 void search_prev_result(SearchState *search);
 
-// Perform search on directory entries
+// Perform search on directory entries; filter terms in the query ("size>50MB") narrow
+// the listing and the rest is matched against names
 void search_perform(SearchState *search, DirectoryState *dir);
 
+// Fill positions (up to max_positions) with the matched characters of a result's name
+// Returns the number of positions written
+int search_match_positions(const SearchState *search, const DirectoryState *dir, int result_index,
+                           int *positions, int max_positions);
+
 // Calculate fuzzy match score between query and text
 // Returns score (higher is better), or 0 if no match
 int search_fuzzy_match(const char *query, const char *text, int *match_positions, int *match_count, bool case_sensitive);
@@ -93,7 +152,7 @@ void search_draw(struct App *app);
 // Check if search is active
 bool search_is_active(SearchState *search);
 
-// Toggle between fuzzy and semantic search types
+// Cycle fuzzy -> semantic -> paths -> content, skipping unavailable types
 void search_toggle_type(SearchState *search);
 
 // Get current search type name
@@ -102,7 +161,32 @@ const char* search_type_name(SearchType type);
 // Check if semantic search is available (engine loaded, etc.)
 bool search_is_semantic_available(struct App *app);
 
-// Perform semantic search (AI-powered content search)
+// Check if semantic search is still warming up: its vector database is opening or its
+// model has not loaded yet
+bool search_is_semantic_warming(struct App *app);
+
+// Start the semantic search for query on the job scheduler, cancelling any still running.
+// Its hits are blended into results[] (search_merge_semantic) by a main-thread completion
 void search_perform_semantic(struct App *app, const char *query);
 
+// Blend semantic hits into the fuzzy results of the current query: entries of dir with a
+// hit rank by a mix of their normalized name score and similarity, and hits whose name
+// did not match are added. The selected entry stays selected
+void search_merge_semantic(SearchState *search, const DirectoryState *dir, const SemanticSearchResults *hits);
+
+// Search the recursive filename index (below the current folder when the query is
+// only filter terms). Spotlight answers instead where it can (core/spotlight_search.h)
+void search_perform_paths(struct App *app, const char *query);
+
+// Take the Spotlight matches found since the last call; true if there were any
+bool search_poll_paths(SearchState *search);
+
+// Start searching the contents of the files below the current folder for query
+// (case-sensitive only when it holds a capital), replacing any search still running.
+// Matches arrive through search_poll_content
+void search_perform_content(struct App *app, const char *query);
+
+// Take the content matches found since the last call; true if there were any
+bool search_poll_content(SearchState *search);
+
 #endif // SEARCH_H
@@ -0,0 +1,298 @@
+#include "session.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SESSION_MAGIC 0x4E535046u       // "FPSN"
+#define SESSION_VERSION 1
+
+typedef struct SessionHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_size;                // sizeof(FileEntry) of the writer
+    int32_t tab_count;
+    int32_t current_tab;
+    int32_t listing_count;
+    uint64_t event_id;
+    int64_t saved_at;
+} SessionHeader;
+
+typedef struct SessionListing {
+    char path[PATH_MAX_LEN];
+    uint64_t entries_offset;            // From the start of the file
+    uint64_t names_offset;
+    uint64_t names_size;
+    int32_t count;
+    uint32_t show_hidden;
+} SessionListing;
+
+struct Session {
+    const unsigned char *data;
+    size_t size;
+    const SessionHeader *header;
+    const SessionTab *tabs;
+    const SessionListing *listings;
+};
+
+// Helper: Round up to the alignment of the records that follow
+static uint64_t session_align(uint64_t offset)
+{
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+// Helper: Write zeros up to offset
+static bool session_pad(FILE *f, uint64_t *written, uint64_t offset)
+{
+    static const unsigned char zeros[8] = {0};
+    size_t pad = (size_t)(offset - *written);
+    *written = offset;
+    return pad == 0 || fwrite(zeros, 1, pad, f) == pad;
+}
+
+bool session_save(const char *file, const SessionTab *tabs, int tab_count, int current_tab,
+                  const DirectoryState *const *listings, int listing_count, uint64_t event_id)
+{
+    if (!file || tab_count < 0 || tab_count > SESSION_MAX_TABS || listing_count < 0) {
+        return false;
+    }
+
+    // Records first, then the data they point at
+    SessionListing *records = calloc(SESSION_MAX_LISTINGS, sizeof(SessionListing));
+    if (!records) {
+        return false;
+    }
+    const DirectoryState *kept[SESSION_MAX_LISTINGS];
+    int kept_count = 0;
+    for (int i = 0; i < listing_count && kept_count < SESSION_MAX_LISTINGS; i++) {
+        const DirectoryState *dir = listings[i];
+        if (dir && !dir->is_loading && dir->current_path[0] != '\0') {
+            kept[kept_count++] = dir;
+        }
+    }
+
+    uint64_t offset = sizeof(SessionHeader) + (uint64_t)tab_count * sizeof(SessionTab) +
+                      (uint64_t)kept_count * sizeof(SessionListing);
+    for (int i = 0; i < kept_count; i++) {
+        SessionListing *record = &records[i];
+        snprintf(record->path, sizeof(record->path), "%s", kept[i]->current_path);
+        record->count = kept[i]->count;
+        record->show_hidden = kept[i]->show_hidden;
+        record->entries_offset = session_align(offset);
+        record->names_offset = record->entries_offset + (uint64_t)kept[i]->count * sizeof(FileEntry);
+        record->names_size = kept[i]->names_size;
+        offset = record->names_offset + record->names_size;
+    }
+
+    SessionHeader header = {
+        .magic = SESSION_MAGIC,
+        .version = SESSION_VERSION,
+        .entry_size = sizeof(FileEntry),
+        .tab_count = tab_count,
+        .current_tab = current_tab,
+        .listing_count = kept_count,
+        .event_id = event_id,
+        .saved_at = (int64_t)time(NULL)
+    };
+
+    char tmp_path[PATH_MAX_LEN + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", file);
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        free(records);
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              (tab_count == 0 || fwrite(tabs, sizeof(SessionTab), (size_t)tab_count, f) == (size_t)tab_count) &&
+              (kept_count == 0 || fwrite(records, sizeof(SessionListing), (size_t)kept_count, f) == (size_t)kept_count);
+    uint64_t written = sizeof(SessionHeader) + (uint64_t)tab_count * sizeof(SessionTab) +
+                       (uint64_t)kept_count * sizeof(SessionListing);
+    for (int i = 0; ok && i < kept_count; i++) {
+        const DirectoryState *dir = kept[i];
+        size_t count = (size_t)dir->count;
+        ok = session_pad(f, &written, records[i].entries_offset) &&
+             fwrite(dir->entries, sizeof(FileEntry), count, f) == count &&
+             fwrite(dir->names, 1, dir->names_size, f) == dir->names_size;
+        written = records[i].names_offset + records[i].names_size;
+    }
+    free(records);
+
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+    if (!ok || rename(tmp_path, file) != 0) {
+        remove(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+// Helper: Whether every record lies inside the file and means what it says
+static bool session_validate(const Session *session)
+{
+    const SessionHeader *header = session->header;
+    if (header->magic != SESSION_MAGIC || header->version != SESSION_VERSION ||
+        header->entry_size != sizeof(FileEntry) ||
+        header->tab_count < 0 || header->tab_count > SESSION_MAX_TABS ||
+        header->listing_count < 0 || header->listing_count > SESSION_MAX_LISTINGS) {
+        return false;
+    }
+
+    uint64_t records_end = sizeof(SessionHeader) + (uint64_t)header->tab_count * sizeof(SessionTab) +
+                           (uint64_t)header->listing_count * sizeof(SessionListing);
+    if (records_end > session->size) {
+        return false;
+    }
+
+    for (int i = 0; i < header->tab_count; i++) {
+        if (memchr(session->tabs[i].path, '\0', PATH_MAX_LEN) == NULL) return false;
+    }
+    for (int i = 0; i < header->listing_count; i++) {
+        const SessionListing *listing = &session->listings[i];
+        if (memchr(listing->path, '\0', PATH_MAX_LEN) == NULL || listing->count < 0 ||
+            listing->entries_offset % 8 != 0 || listing->entries_offset < records_end ||
+            listing->names_offset != listing->entries_offset + (uint64_t)listing->count * sizeof(FileEntry) ||
+            listing->names_size > session->size ||
+            listing->names_offset > session->size - listing->names_size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Session *session_open(const char *file)
+{
+    if (!file) {
+        return NULL;
+    }
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size < sizeof(SessionHeader)) {
+        close(fd);
+        return NULL;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    Session *session = calloc(1, sizeof(Session));
+    if (!session) {
+        munmap(data, (size_t)st.st_size);
+        return NULL;
+    }
+    session->data = data;
+    session->size = (size_t)st.st_size;
+    session->header = (const SessionHeader *)session->data;
+    session->tabs = (const SessionTab *)(session->data + sizeof(SessionHeader));
+    if (session->header->tab_count < 0 || session->header->tab_count > SESSION_MAX_TABS) {
+        session_close(session);
+        return NULL;
+    }
+    session->listings = (const SessionListing *)(session->data + sizeof(SessionHeader) +
+                                                 (size_t)session->header->tab_count * sizeof(SessionTab));
+    if (!session_validate(session)) {
+        session_close(session);
+        return NULL;
+    }
+    return session;
+}
+
+void session_close(Session *session)
+{
+    if (!session) {
+        return;
+    }
+    munmap((void *)session->data, session->size);
+    free(session);
+}
+
+int session_tab_count(const Session *session)
+{
+    return session ? session->header->tab_count : 0;
+}
+
+int session_current_tab(const Session *session)
+{
+    return session ? session->header->current_tab : -1;
+}
+
+const SessionTab *session_tab(const Session *session, int index)
+{
+    if (!session || index < 0 || index >= session->header->tab_count) {
+        return NULL;
+    }
+    return &session->tabs[index];
+}
+
+uint64_t session_event_id(const Session *session)
+{
+    return session ? session->header->event_id : 0;
+}
+
+int session_find_listing(const Session *session, const char *path)
+{
+    if (!session || !path) {
+        return -1;
+    }
+    for (int i = 0; i < session->header->listing_count; i++) {
+        if (strcmp(session->listings[i].path, path) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool session_restore_listing(const Session *session, int index, DirectoryState *state)
+{
+    if (!session || index < 0 || index >= session->header->listing_count) {
+        return false;
+    }
+
+    const SessionListing *listing = &session->listings[index];
+    state->show_hidden = listing->show_hidden != 0;
+    return directory_state_restore(state, listing->path,
+                                   (const FileEntry *)(session->data + listing->entries_offset),
+                                   listing->count,
+                                   (const char *)(session->data + listing->names_offset),
+                                   (size_t)listing->names_size);
+}
+
+bool session_default_path(char *out, size_t out_size)
+{
+    const char *home = getenv("HOME");
+    if (!home || !out) {
+        return false;
+    }
+
+    int written = snprintf(out, out_size, "%s/%s", home, SESSION_FILE);
+    if (written < 0 || (size_t)written >= out_size) {
+        return false;
+    }
+
+    // Create each directory above the file
+    char *slash = strrchr(out, '/');
+    for (char *p = out + strlen(home) + 1; p < slash; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(out, 0755);  // Ignore EEXIST
+            *p = '/';
+        }
+    }
+    *slash = '\0';
+    bool ok = mkdir(out, 0755) == 0 || errno == EEXIST;
+    *slash = '/';
+    return ok;
+}
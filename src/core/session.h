@@ -0,0 +1,54 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesystem.h"
+
+// Session snapshot for a warm restart. On quit the open tabs and the listings behind
+// them (entries with their stat data and name arena, in display order) are written to
+// one file laid out for mmap: fixed-size records, then each listing's entries and names
+// as stored in memory. On launch the file is mapped and validated, and a listing is
+// copied out in two memcpys, so the first frame can show it without reading the
+// directory. The FSEvents ID at save time lets the caller replay what changed since then
+
+#define SESSION_FILE ".cache/finder-plus/session.snap"
+#define SESSION_MAX_TABS 32
+#define SESSION_MAX_LISTINGS 32
+
+typedef struct SessionTab {
+    char path[PATH_MAX_LEN];
+    int32_t selected_index;
+    int32_t scroll_offset;
+} SessionTab;
+
+// Mapped snapshot (opaque)
+typedef struct Session Session;
+
+// Write a snapshot to file (through a temporary file, so a crash leaves the old one);
+// listings that are still loading are skipped
+bool session_save(const char *file, const SessionTab *tabs, int tab_count, int current_tab,
+                  const DirectoryState *const *listings, int listing_count, uint64_t event_id);
+
+// Map and validate a snapshot; NULL if missing, from another build or damaged
+Session *session_open(const char *file);
+void session_close(Session *session);
+
+int session_tab_count(const Session *session);
+int session_current_tab(const Session *session);
+const SessionTab *session_tab(const Session *session, int index);
+
+// FSEvents ID the listings were current at (0 if unknown)
+uint64_t session_event_id(const Session *session);
+
+// Index of the listing saved for path, or -1
+int session_find_listing(const Session *session, const char *path);
+
+// Copy a saved listing into a freshly initialized state
+bool session_restore_listing(const Session *session, int index, DirectoryState *state);
+
+// ~/SESSION_FILE, creating its directory; false without a home directory
+bool session_default_path(char *out, size_t out_size);
+
+#endif // SESSION_H
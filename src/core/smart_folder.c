@@ -0,0 +1,1059 @@
+#include "smart_folder.h"
+#include "filter_query.h"
+#include "fs_watch.h"
+#include "../ai/path_index.h"
+#include "../utils/jobs.h"
+#include "../utils/hash.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define MEMBER_SLOTS_MIN 64
+#define COMPACT_MIN_BYTES (256 * 1024)  // Dead name bytes tolerated before the arena is rebuilt
+#define AGE_REFRESH_SEC 3600            // Folders with "modified<" terms are rebuilt this often
+#define CANDIDATE_FACTOR 4              // Index matches considered per member when terms need lstat
+
+// How a folder decides membership; rebuilt with the members, so ages count from then
+typedef struct Matcher {
+    SmartFolderKind kind;
+    const char *pattern;                // SMART_FOLDER_PATTERN: the query
+    FilterQuery filter;                 // SMART_FOLDER_FILTER
+    char words[SMART_FOLDER_QUERY_MAX]; // Lower-case filter text, each word must be in the name
+    bool needs_entry;                   // Filter terms need the metadata
+    bool ages;                          // Filter terms count back from the build time
+} Matcher;
+
+// Members: a listing named by paths relative to the root, and a linear-probing hash of
+// those names (entry index + 1 per slot, 0 for empty)
+typedef struct MemberSet {
+    DirectoryState listing;
+    uint32_t *slots;
+    uint32_t slot_count;                // Power of two
+    size_t dead_bytes;                  // Arena bytes of removed entries
+    bool truncated;
+} MemberSet;
+
+// A change held while the folder rebuilds
+typedef struct PendingChange {
+    char *path;
+    FSEventType type;
+    uint32_t flags;
+} PendingChange;
+
+typedef struct SmartFolder {
+    uint32_t id;                        // Unique in the set, for finding it again after unlocking
+    char name[SMART_FOLDER_NAME_MAX];
+    char root[PATH_MAX_LEN];
+    size_t root_len;
+    SmartFolderKind kind;
+    char query[SMART_FOLDER_QUERY_MAX];
+    struct SmartFolders *owner;
+    int watch_id;
+    JobToken *token;                    // The folder's builds
+
+    pthread_mutex_t mutex;              // Everything below
+    Matcher matcher;
+    MemberSet members;
+    time_t built_at;
+    bool ready;                         // members holds a finished build
+    bool building;                      // A build job is queued or running
+    bool stale;                         // Build again once the running one is done
+    bool retry;                         // The last build failed (no search yet): build on open
+    PendingChange *pending;
+    int pending_count;
+    bool pending_overflow;
+} SmartFolder;
+
+struct SmartFolders {
+    pthread_mutex_t mutex;              // The folder list, index and semantic matching
+    SmartFolder *folders[SMART_FOLDER_MAX];
+    int count;
+    uint32_t next_id;
+    FsWatch *watch;
+    PathIndex *index;
+    SmartFolderSemantic semantic;
+    bool has_semantic;
+};
+
+static const char *const KIND_NAMES[] = {
+    [SMART_FOLDER_PATTERN] = "pattern",
+    [SMART_FOLDER_FILTER] = "filter",
+    [SMART_FOLDER_SEMANTIC] = "semantic",
+};
+
+const char *smart_folder_kind_name(SmartFolderKind kind)
+{
+    return kind <= SMART_FOLDER_SEMANTIC ? KIND_NAMES[kind] : "pattern";
+}
+
+bool smart_folder_kind_parse(const char *name, SmartFolderKind *kind)
+{
+    for (int k = 0; k <= SMART_FOLDER_SEMANTIC; k++) {
+        if (strcmp(name, KIND_NAMES[k]) == 0) {
+            *kind = (SmartFolderKind)k;
+            return true;
+        }
+    }
+    return false;
+}
+
+//=============================================================================
+// Matching
+//=============================================================================
+
+// Helper: Compile a folder's query as of now; false if a filter term is bad
+static bool matcher_init(Matcher *matcher, SmartFolderKind kind, const char *query)
+{
+    memset(matcher, 0, sizeof(*matcher));
+    matcher->kind = kind;
+    matcher->pattern = query;
+    if (kind != SMART_FOLDER_FILTER) {
+        return true;
+    }
+
+    bool ok = filter_query_compile(&matcher->filter, query, time(NULL));
+    size_t i = 0;
+    for (; matcher->filter.text[i] && i < sizeof(matcher->words) - 1; i++) {
+        matcher->words[i] = (char)tolower((unsigned char)matcher->filter.text[i]);
+    }
+    matcher->words[i] = '\0';
+    matcher->needs_entry = filter_query_needs_stat(&matcher->filter);
+    for (int t = 0; t < matcher->filter.term_count; t++) {
+        if (matcher->filter.terms[t].field == FILTER_FIELD_MODIFIED) {
+            matcher->ages = true;
+        }
+        if (matcher->filter.terms[t].field == FILTER_FIELD_GIT) {
+            matcher->needs_entry = true;
+        }
+    }
+    return ok;
+}
+
+// Helper: Whether name contains word (len bytes, lower case) ignoring case
+static bool name_contains(const char *name, const char *word, size_t len)
+{
+    for (; *name; name++) {
+        size_t i = 0;
+        while (i < len && name[i] && tolower((unsigned char)name[i]) == (unsigned char)word[i]) {
+            i++;
+        }
+        if (i == len) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Helper: Whether a name may belong to the folder (the entry may still need checking)
+static bool matcher_name(const char *name, void *context)
+{
+    const Matcher *matcher = context;
+    if (matcher->kind == SMART_FOLDER_PATTERN) {
+        return fnmatch(matcher->pattern, name, 0) == 0;
+    }
+    if (!filter_query_match_name(&matcher->filter, name)) {
+        return false;
+    }
+    for (const char *w = matcher->words; *w;) {
+        size_t len = strcspn(w, " ");
+        if (len > 0 && !name_contains(name, w, len)) {
+            return false;
+        }
+        w += len;
+        while (*w == ' ') w++;
+    }
+    return true;
+}
+
+//=============================================================================
+// Member set
+//=============================================================================
+
+static const char *member_name(const MemberSet *set, int index)
+{
+    return directory_entry_name(&set->listing, &set->listing.entries[index]);
+}
+
+static void members_init(MemberSet *set, const char *root)
+{
+    memset(set, 0, sizeof(*set));
+    directory_state_init(&set->listing);
+    strncpy(set->listing.current_path, root, PATH_MAX_LEN - 1);
+    set->listing.show_hidden = true;
+    set->listing.hidden_listed = true;
+}
+
+static void members_free(MemberSet *set)
+{
+    directory_state_free(&set->listing);
+    free(set->slots);
+    set->slots = NULL;
+    set->slot_count = 0;
+}
+
+// Helper: Index of the member named rel, or -1
+static int member_find(const MemberSet *set, const char *rel)
+{
+    if (set->slot_count == 0) {
+        return -1;
+    }
+    uint32_t mask = set->slot_count - 1;
+    for (uint32_t i = hash_fnv1a(rel) & mask;; i = (i + 1) & mask) {
+        uint32_t value = set->slots[i];
+        if (value == 0) {
+            return -1;
+        }
+        if (strcmp(member_name(set, (int)value - 1), rel) == 0) {
+            return (int)value - 1;
+        }
+    }
+}
+
+// Helper: Slot holding member index (it must be in the table)
+static uint32_t slot_of(const MemberSet *set, int index)
+{
+    uint32_t mask = set->slot_count - 1;
+    uint32_t i = hash_fnv1a(member_name(set, index)) & mask;
+    while (set->slots[i] != (uint32_t)index + 1) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void slot_insert(MemberSet *set, int index)
+{
+    uint32_t mask = set->slot_count - 1;
+    uint32_t i = hash_fnv1a(member_name(set, index)) & mask;
+    while (set->slots[i] != 0) {
+        i = (i + 1) & mask;
+    }
+    set->slots[i] = (uint32_t)index + 1;
+}
+
+// Helper: Empty slot i, shifting back the entries probed past it so lookups still find them
+static void slot_delete(MemberSet *set, uint32_t i)
+{
+    uint32_t mask = set->slot_count - 1;
+    for (;;) {
+        set->slots[i] = 0;
+        uint32_t j = i;
+        for (;;) {
+            j = (j + 1) & mask;
+            if (set->slots[j] == 0) {
+                return;
+            }
+            uint32_t home = hash_fnv1a(member_name(set, (int)set->slots[j] - 1)) & mask;
+            // The entry at j may fill the hole unless its home lies cyclically in (i, j]
+            bool stays = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+            if (!stays) {
+                set->slots[i] = set->slots[j];
+                i = j;
+                break;
+            }
+        }
+    }
+}
+
+// Helper: Make room in the hash for count members; false on OOM
+static bool members_reserve(MemberSet *set, int count)
+{
+    if ((uint64_t)count * 2 <= set->slot_count) {
+        return true;
+    }
+    uint32_t slot_count = set->slot_count ? set->slot_count * 2 : MEMBER_SLOTS_MIN;
+    while ((uint64_t)count * 2 > slot_count) {
+        slot_count *= 2;
+    }
+    uint32_t *slots = calloc(slot_count, sizeof(uint32_t));
+    if (!slots) {
+        return false;
+    }
+    free(set->slots);
+    set->slots = slots;
+    set->slot_count = slot_count;
+    for (int i = 0; i < set->listing.count; i++) {
+        slot_insert(set, i);
+    }
+    return true;
+}
+
+static void member_remove(MemberSet *set, int index)
+{
+    const FileEntry *fe = &set->listing.entries[index];
+    set->dead_bytes += (size_t)fe->name_len + fe->ext_len + 2;
+
+    slot_delete(set, slot_of(set, index));
+    int last = set->listing.count - 1;
+    if (index != last) {
+        // The last entry moves into index
+        set->slots[slot_of(set, last)] = (uint32_t)index + 1;
+    }
+    directory_remove_entry(&set->listing, index);
+}
+
+// Helper: Rebuild the name arena without the names of removed members
+static void members_compact(MemberSet *set)
+{
+    if (set->dead_bytes < COMPACT_MIN_BYTES || set->dead_bytes * 2 < set->listing.names_size) {
+        return;
+    }
+
+    MemberSet fresh;
+    members_init(&fresh, set->listing.current_path);
+    fresh.truncated = set->truncated;
+    for (int i = 0; i < set->listing.count; i++) {
+        const FileEntry *old = &set->listing.entries[i];
+        FileEntry *fe = directory_append_entry(&fresh.listing, member_name(set, i));
+        if (!fe) {
+            members_free(&fresh);
+            return;
+        }
+        uint32_t offset = fe->name_offset;
+        *fe = *old;
+        fe->name_offset = offset;
+        if (fe->ext_len == 0) {
+            fresh.listing.names[offset + fe->name_len + 1] = '\0';
+        }
+    }
+    if (!members_reserve(&fresh, fresh.listing.count)) {
+        members_free(&fresh);
+        return;
+    }
+    members_free(set);
+    *set = fresh;
+}
+
+// Helper: Drop rel's member, then add it back with fresh metadata if it exists and
+// matches. matches is 1 or 0 when the caller decided membership, -1 to test the name
+// and entry against matcher
+static void member_update(const Matcher *matcher, MemberSet *set, const char *rel, int matches)
+{
+    int index = member_find(set, rel);
+    if (index >= 0) {
+        member_remove(set, index);
+    }
+    if (matches == 0 || strlen(rel) >= NAME_MAX_LEN) {
+        return;
+    }
+
+    const char *slash = strrchr(rel, '/');
+    if (matches < 0 && !matcher_name(slash ? slash + 1 : rel, (void *)matcher)) {
+        return;
+    }
+    if (set->listing.count >= SMART_FOLDER_MAX_MEMBERS) {
+        set->truncated = true;
+        return;
+    }
+    if (!members_reserve(set, set->listing.count + 1)) {
+        return;
+    }
+
+    FileEntry *fe = directory_append_file(&set->listing, rel);
+    if (!fe) {
+        return;
+    }
+    index = set->listing.count - 1;
+    if (matches < 0 && matcher->needs_entry &&
+        !filter_query_match_entry(&matcher->filter, &set->listing, fe)) {
+        set->dead_bytes += (size_t)fe->name_len + fe->ext_len + 2;
+        directory_remove_entry(&set->listing, index);
+        return;
+    }
+    slot_insert(set, index);
+}
+
+// Helper: Remove every member below rel (a folder that went away)
+static void members_remove_below(MemberSet *set, const char *rel)
+{
+    size_t len = strlen(rel);
+    for (int i = set->listing.count - 1; i >= 0; i--) {
+        const char *name = member_name(set, i);
+        if (strncmp(name, rel, len) == 0 && name[len] == '/') {
+            member_remove(set, i);
+        }
+    }
+}
+
+//=============================================================================
+// Applying changes
+//=============================================================================
+
+// Helper: path relative to the folder's root, or NULL if it is not below it
+static const char *relative_path(const SmartFolder *folder, const char *path)
+{
+    size_t len = folder->root_len;
+    if (len == 1) {
+        return path[0] == '/' && path[1] ? path + 1 : NULL;
+    }
+    if (strncmp(path, folder->root, len) != 0 || path[len] != '/' || path[len + 1] == '\0') {
+        return NULL;
+    }
+    return path + len + 1;
+}
+
+// Helper: Consider everything below dir_path (not hidden, SMART_FOLDER_MAX_DEPTH deep)
+static void walk_below(const SmartFolder *folder, const Matcher *matcher, MemberSet *set,
+                       const char *dir_path, int depth, JobToken *token)
+{
+    if (depth >= SMART_FOLDER_MAX_DEPTH || (token && job_token_cancelled(token))) {
+        return;
+    }
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        return;
+    }
+
+    struct dirent *entry;
+    char path[PATH_MAX_LEN];
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        int written = snprintf(path, sizeof(path), "%s/%s", strcmp(dir_path, "/") == 0 ? "" : dir_path,
+                               entry->d_name);
+        if (written < 0 || (size_t)written >= sizeof(path)) {
+            continue;
+        }
+        const char *rel = relative_path(folder, path);
+        if (rel) {
+            member_update(matcher, set, rel, -1);
+        }
+
+        bool is_dir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN) {
+            struct stat st;
+            is_dir = lstat(path, &st) == 0 && S_ISDIR(st.st_mode);
+        }
+        if (is_dir) {
+            walk_below(folder, matcher, set, path, depth + 1, token);
+        }
+    }
+    closedir(dir);
+}
+
+// Helper: Whether the folder decides membership itself (-1) or only keeps what it has
+static int folder_decides(const SmartFolder *folder, const MemberSet *set, const char *rel)
+{
+    // Semantic members come from the indexer; file changes only refresh or drop them
+    if (folder->kind == SMART_FOLDER_SEMANTIC) {
+        return member_find(set, rel) >= 0;
+    }
+    return -1;
+}
+
+// Apply one changed path (folder mutex held)
+static void apply_change(SmartFolder *folder, const char *path, FSEventType type, uint32_t flags)
+{
+    const char *rel = relative_path(folder, path);
+    if (!rel) {
+        return;
+    }
+    MemberSet *set = &folder->members;
+
+    struct stat st;
+    if (lstat(path, &st) != 0) {
+        int index = member_find(set, rel);
+        if (index >= 0) {
+            member_remove(set, index);
+        }
+        if ((flags & FSEVENT_FLAG_IS_DIR) || type == FSEVENT_DIR_DELETED || type == FSEVENT_RENAMED) {
+            members_remove_below(set, rel);
+        }
+        return;
+    }
+
+    member_update(&folder->matcher, set, rel, folder_decides(folder, set, rel));
+
+    // A folder created or moved in brings its contents along
+    if (S_ISDIR(st.st_mode) && (type == FSEVENT_DIR_CREATED || type == FSEVENT_RENAMED) &&
+        folder->kind != SMART_FOLDER_SEMANTIC) {
+        walk_below(folder, &folder->matcher, set, path, 0, NULL);
+    }
+}
+
+// Re-read one directory whose changes were not listed (folder mutex held)
+static void rescan_dir(SmartFolder *folder, const char *dir_path)
+{
+    MemberSet *set = &folder->members;
+    const char *rel_dir = strcmp(dir_path, folder->root) == 0 ? "" : relative_path(folder, dir_path);
+    if (!rel_dir) {
+        return;
+    }
+
+    // Members directly inside that are gone
+    size_t len = strlen(rel_dir);
+    char path[PATH_MAX_LEN];
+    for (int i = set->listing.count - 1; i >= 0; i--) {
+        const char *name = member_name(set, i);
+        const char *slash = strrchr(name, '/');
+        size_t parent_len = slash ? (size_t)(slash - name) : 0;
+        if (parent_len != len || strncmp(name, rel_dir, len) != 0) {
+            continue;
+        }
+        struct stat st;
+        directory_entry_path(&set->listing, &set->listing.entries[i], path, sizeof(path));
+        if (lstat(path, &st) != 0) {
+            member_remove(set, i);
+        }
+    }
+
+    // And every name there now
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        int written = snprintf(path, sizeof(path), "%s/%s", strcmp(dir_path, "/") == 0 ? "" : dir_path,
+                               entry->d_name);
+        const char *rel = written > 0 && (size_t)written < sizeof(path) ? relative_path(folder, path) : NULL;
+        if (rel) {
+            member_update(&folder->matcher, set, rel, folder_decides(folder, set, rel));
+        }
+    }
+    closedir(dir);
+}
+
+static void pending_clear(SmartFolder *folder)
+{
+    for (int i = 0; i < folder->pending_count; i++) {
+        free(folder->pending[i].path);
+    }
+    free(folder->pending);
+    folder->pending = NULL;
+    folder->pending_count = 0;
+    folder->pending_overflow = false;
+}
+
+// Helper: Hold a change for after the build in progress (folder mutex held)
+static void pending_push(SmartFolder *folder, const FsWatchChange *change)
+{
+    if (folder->pending_overflow) {
+        return;
+    }
+    if (folder->pending_count >= SMART_FOLDER_PENDING_MAX) {
+        folder->pending_overflow = true;
+        return;
+    }
+    if (folder->pending_count == 0) {
+        folder->pending = malloc(SMART_FOLDER_PENDING_MAX * sizeof(PendingChange));
+    }
+    char *path = folder->pending ? strdup(change->path) : NULL;
+    if (!path) {
+        folder->pending_overflow = true;
+        return;
+    }
+    folder->pending[folder->pending_count++] = (PendingChange){ path, change->type, change->flags };
+}
+
+//=============================================================================
+// Building
+//=============================================================================
+
+// Helper: Fill set with the folder's members from scratch; false if they cannot be found
+// yet (semantic search unavailable)
+static bool materialize(SmartFolder *folder, const Matcher *matcher, MemberSet *set, JobToken *token)
+{
+    SmartFolders *owner = folder->owner;
+    pthread_mutex_lock(&owner->mutex);
+    PathIndex *index = owner->index;
+    SmartFolderSemantic semantic = owner->semantic;
+    bool has_semantic = owner->has_semantic;
+    pthread_mutex_unlock(&owner->mutex);
+
+    members_init(set, folder->root);
+
+    if (folder->kind == SMART_FOLDER_SEMANTIC) {
+        char **paths = NULL;
+        int count = has_semantic && semantic.query ?
+                    semantic.query(folder->query, folder->root, &paths, semantic.context) : -1;
+        if (count < 0) {
+            return false;
+        }
+        for (int i = 0; i < count; i++) {
+            const char *rel = relative_path(folder, paths[i]);
+            if (rel) {
+                member_update(matcher, set, rel, 1);
+            }
+            free(paths[i]);
+        }
+        free(paths);
+        return true;
+    }
+
+    // The index answers for the names; only its matches are stat'ed
+    PathIndexResults results;
+    int max = matcher->needs_entry ? SMART_FOLDER_MAX_MEMBERS * CANDIDATE_FACTOR : SMART_FOLDER_MAX_MEMBERS;
+    bool covered = index && (folder->kind == SMART_FOLDER_PATTERN ?
+        path_index_find(index, folder->root, folder->query, true, max, &results) :
+        path_index_find_names(index, folder->root, matcher_name, (void *)matcher, true, max, &results));
+    if (covered) {
+        for (int i = 0; i < results.count && !job_token_cancelled(token); i++) {
+            const char *rel = relative_path(folder, results.paths[i]);
+            if (rel) {
+                member_update(matcher, set, rel, -1);
+            }
+        }
+        set->truncated |= results.total > results.count;
+        path_index_results_free(&results);
+    } else {
+        // Outside the index: walk the tree once
+        walk_below(folder, matcher, set, folder->root, 0, token);
+    }
+    members_compact(set);
+    return true;
+}
+
+static void build_run(void *arg, JobToken *token)
+{
+    SmartFolder *folder = arg;
+    for (;;) {
+        Matcher matcher;
+        matcher_init(&matcher, folder->kind, folder->query);
+        MemberSet fresh;
+        bool ok = materialize(folder, &matcher, &fresh, token) && !job_token_cancelled(token);
+
+        pthread_mutex_lock(&folder->mutex);
+        if (ok) {
+            members_free(&folder->members);
+            folder->members = fresh;
+            folder->matcher = matcher;
+            folder->built_at = time(NULL);
+            folder->ready = true;
+
+            // Changes that arrived meanwhile
+            if (folder->pending_overflow) {
+                folder->stale = true;
+            } else {
+                for (int i = 0; i < folder->pending_count; i++) {
+                    const PendingChange *change = &folder->pending[i];
+                    apply_change(folder, change->path, change->type, change->flags);
+                }
+            }
+        } else {
+            members_free(&fresh);
+        }
+        pending_clear(folder);
+        folder->retry = !ok;
+
+        bool again = ok && folder->stale;
+        folder->stale = false;
+        if (!again) {
+            folder->building = false;
+            pthread_mutex_unlock(&folder->mutex);
+            return;
+        }
+        pthread_mutex_unlock(&folder->mutex);
+    }
+}
+
+// Start a build, or have the running one go again (folder mutex not held: jobs may run inline)
+static void request_build(SmartFolder *folder)
+{
+    pthread_mutex_lock(&folder->mutex);
+    bool start = !folder->building;
+    if (start) {
+        folder->building = true;
+    } else {
+        folder->stale = true;
+    }
+    pthread_mutex_unlock(&folder->mutex);
+
+    if (start) {
+        jobs_submit(JOB_QOS_UTILITY, build_run, NULL, folder, folder->token);
+    }
+}
+
+static void smart_folder_watch_batch(const FsWatchBatch *batch, void *user_data)
+{
+    SmartFolder *folder = user_data;
+    bool rebuild = batch->dirs_overflow ||
+                   (batch->changes_overflow && batch->dir_count > SMART_FOLDER_RESCAN_DIRS);
+
+    pthread_mutex_lock(&folder->mutex);
+    if (rebuild || !folder->ready) {
+        // Nothing to patch yet, or too much to patch
+    } else if (folder->building) {
+        folder->pending_overflow |= batch->changes_overflow;
+        for (int i = 0; i < batch->change_count; i++) {
+            if (batch->changes[i].flags & FSEVENT_FLAG_MUST_SCAN) {
+                folder->pending_overflow = true;
+            }
+            pending_push(folder, &batch->changes[i]);
+        }
+    } else {
+        for (int i = 0; i < batch->change_count && !rebuild; i++) {
+            const FsWatchChange *change = &batch->changes[i];
+            if (change->flags & FSEVENT_FLAG_MUST_SCAN) {
+                rebuild = true;
+            } else {
+                apply_change(folder, change->path, change->type, change->flags);
+            }
+        }
+        if (batch->changes_overflow && !rebuild) {
+            for (int i = 0; i < batch->dir_count; i++) {
+                rescan_dir(folder, batch->dirs[i]);
+            }
+        }
+        members_compact(&folder->members);
+    }
+    pthread_mutex_unlock(&folder->mutex);
+
+    if (rebuild) {
+        request_build(folder);
+    }
+}
+
+//=============================================================================
+// The set
+//=============================================================================
+
+SmartFolders *smart_folders_create(struct FsWatch *watch)
+{
+    SmartFolders *folders = calloc(1, sizeof(SmartFolders));
+    if (!folders) {
+        return NULL;
+    }
+    pthread_mutex_init(&folders->mutex, NULL);
+    folders->watch = watch;
+    folders->next_id = 1;
+    return folders;
+}
+
+static void smart_folder_free(SmartFolders *folders, SmartFolder *folder)
+{
+    if (folders->watch && folder->watch_id > 0) {
+        fs_watch_unsubscribe(folders->watch, folder->watch_id);
+    }
+    job_token_cancel(folder->token);
+    job_token_wait(folder->token);
+    job_token_release(folder->token);
+
+    pending_clear(folder);
+    members_free(&folder->members);
+    pthread_mutex_destroy(&folder->mutex);
+    free(folder);
+}
+
+void smart_folders_destroy(SmartFolders *folders)
+{
+    if (!folders) {
+        return;
+    }
+    for (int i = 0; i < folders->count; i++) {
+        smart_folder_free(folders, folders->folders[i]);
+    }
+    pthread_mutex_destroy(&folders->mutex);
+    free(folders);
+}
+
+// Helper: Rebuild the folders of one kind (any kind when all is set)
+static void rebuild_kind(SmartFolders *folders, SmartFolderKind kind, bool all)
+{
+    SmartFolder *rebuild[SMART_FOLDER_MAX];
+    int count = 0;
+    pthread_mutex_lock(&folders->mutex);
+    for (int i = 0; i < folders->count; i++) {
+        if (all ? folders->folders[i]->kind != SMART_FOLDER_SEMANTIC : folders->folders[i]->kind == kind) {
+            rebuild[count++] = folders->folders[i];
+        }
+    }
+    pthread_mutex_unlock(&folders->mutex);
+
+    for (int i = 0; i < count; i++) {
+        request_build(rebuild[i]);
+    }
+}
+
+void smart_folders_set_path_index(SmartFolders *folders, struct PathIndex *index)
+{
+    if (!folders) return;
+    pthread_mutex_lock(&folders->mutex);
+    bool changed = folders->index != index;
+    folders->index = index;
+    pthread_mutex_unlock(&folders->mutex);
+    if (changed) {
+        rebuild_kind(folders, SMART_FOLDER_PATTERN, true);
+    }
+}
+
+void smart_folders_set_semantic(SmartFolders *folders, const SmartFolderSemantic *semantic)
+{
+    if (!folders) return;
+    pthread_mutex_lock(&folders->mutex);
+    folders->has_semantic = semantic != NULL;
+    if (semantic) {
+        folders->semantic = *semantic;
+    } else {
+        memset(&folders->semantic, 0, sizeof(folders->semantic));
+    }
+    pthread_mutex_unlock(&folders->mutex);
+    rebuild_kind(folders, SMART_FOLDER_SEMANTIC, false);
+}
+
+// Helper: Whether a saved field fits in size and stays on its line
+static bool field_ok(const char *text, size_t size)
+{
+    return text && text[0] && strlen(text) < size && !strpbrk(text, "\t\r\n");
+}
+
+int smart_folders_add(SmartFolders *folders, const char *name, SmartFolderKind kind,
+                      const char *root, const char *query)
+{
+    if (!folders || kind > SMART_FOLDER_SEMANTIC || !field_ok(name, SMART_FOLDER_NAME_MAX) ||
+        !field_ok(root, PATH_MAX_LEN) || root[0] != '/' || !field_ok(query, SMART_FOLDER_QUERY_MAX)) {
+        return -1;
+    }
+
+    Matcher check;
+    if (!matcher_init(&check, kind, query)) {
+        return -1;
+    }
+
+    SmartFolder *folder = calloc(1, sizeof(SmartFolder));
+    JobToken *token = folder ? job_token_create() : NULL;
+    if (!token) {
+        free(folder);
+        return -1;
+    }
+    strncpy(folder->name, name, SMART_FOLDER_NAME_MAX - 1);
+    strncpy(folder->root, root, PATH_MAX_LEN - 1);
+    folder->root_len = strlen(folder->root);
+    while (folder->root_len > 1 && folder->root[folder->root_len - 1] == '/') {
+        folder->root[--folder->root_len] = '\0';
+    }
+    folder->kind = kind;
+    strncpy(folder->query, query, SMART_FOLDER_QUERY_MAX - 1);
+    folder->owner = folders;
+    folder->token = token;
+    pthread_mutex_init(&folder->mutex, NULL);
+    members_init(&folder->members, folder->root);
+
+    pthread_mutex_lock(&folders->mutex);
+    int index = folders->count;
+    if (index < SMART_FOLDER_MAX) {
+        folder->id = folders->next_id++;
+        folders->folders[folders->count++] = folder;
+    }
+    pthread_mutex_unlock(&folders->mutex);
+    if (index >= SMART_FOLDER_MAX) {
+        smart_folder_free(folders, folder);
+        return -1;
+    }
+
+    if (folders->watch) {
+        folder->watch_id = fs_watch_subscribe(folders->watch, folder->root, true, smart_folder_watch_batch, folder);
+    }
+    request_build(folder);
+    return index;
+}
+
+bool smart_folders_remove(SmartFolders *folders, int index)
+{
+    if (!folders) return false;
+    pthread_mutex_lock(&folders->mutex);
+    if (index < 0 || index >= folders->count) {
+        pthread_mutex_unlock(&folders->mutex);
+        return false;
+    }
+    SmartFolder *folder = folders->folders[index];
+    memmove(&folders->folders[index], &folders->folders[index + 1],
+            (size_t)(folders->count - index - 1) * sizeof(SmartFolder *));
+    folders->count--;
+    pthread_mutex_unlock(&folders->mutex);
+
+    smart_folder_free(folders, folder);
+    return true;
+}
+
+int smart_folders_count(SmartFolders *folders)
+{
+    if (!folders) return 0;
+    pthread_mutex_lock(&folders->mutex);
+    int count = folders->count;
+    pthread_mutex_unlock(&folders->mutex);
+    return count;
+}
+
+bool smart_folders_info(SmartFolders *folders, int index, SmartFolderInfo *info)
+{
+    if (!folders) return false;
+    pthread_mutex_lock(&folders->mutex);
+    SmartFolder *folder = index >= 0 && index < folders->count ? folders->folders[index] : NULL;
+    if (folder) {
+        memcpy(info->name, folder->name, sizeof(info->name));
+        memcpy(info->root, folder->root, sizeof(info->root));
+        info->kind = folder->kind;
+        memcpy(info->query, folder->query, sizeof(info->query));
+        pthread_mutex_lock(&folder->mutex);
+        info->member_count = folder->members.listing.count;
+        info->ready = folder->ready;
+        info->truncated = folder->members.truncated;
+        pthread_mutex_unlock(&folder->mutex);
+    }
+    pthread_mutex_unlock(&folders->mutex);
+    return folder != NULL;
+}
+
+bool smart_folders_open(SmartFolders *folders, int index, DirectoryState *state)
+{
+    if (!folders || !state) return false;
+    pthread_mutex_lock(&folders->mutex);
+    SmartFolder *folder = index >= 0 && index < folders->count ? folders->folders[index] : NULL;
+    bool opened = false;
+    bool build = false;
+    if (folder) {
+        pthread_mutex_lock(&folder->mutex);
+        opened = folder->ready;
+        if (opened) {
+            bool show_hidden = state->show_hidden;
+            bool streaming = state->streaming;
+            directory_state_free(state);
+            directory_state_copy(state, &folder->members.listing);
+            state->streaming = streaming;
+            directory_set_show_hidden(state, show_hidden);
+        }
+        // Ages have moved on since the build, or it failed
+        build = !folder->building && (folder->retry || !folder->ready ||
+                (folder->matcher.ages && time(NULL) - folder->built_at > AGE_REFRESH_SEC));
+        pthread_mutex_unlock(&folder->mutex);
+    }
+    pthread_mutex_unlock(&folders->mutex);
+
+    if (build) {
+        request_build(folder);
+    }
+    return opened;
+}
+
+uint32_t smart_folders_generation(SmartFolders *folders, int index)
+{
+    if (!folders) return 0;
+    uint32_t generation = 0;
+    pthread_mutex_lock(&folders->mutex);
+    if (index >= 0 && index < folders->count) {
+        SmartFolder *folder = folders->folders[index];
+        pthread_mutex_lock(&folder->mutex);
+        generation = folder->ready ? folder->members.listing.generation : 0;
+        pthread_mutex_unlock(&folder->mutex);
+    }
+    pthread_mutex_unlock(&folders->mutex);
+    return generation;
+}
+
+void smart_folders_indexed(SmartFolders *folders, const char *path)
+{
+    if (!folders || !path) return;
+
+    // Ask about the semantic folders covering path without holding any lock
+    struct { uint32_t id; char query[SMART_FOLDER_QUERY_MAX]; } asks[SMART_FOLDER_MAX];
+    int ask_count = 0;
+    pthread_mutex_lock(&folders->mutex);
+    SmartFolderSemantic semantic = folders->semantic;
+    if (folders->has_semantic && semantic.match) {
+        for (int i = 0; i < folders->count; i++) {
+            SmartFolder *folder = folders->folders[i];
+            if (folder->kind == SMART_FOLDER_SEMANTIC && relative_path(folder, path)) {
+                asks[ask_count].id = folder->id;
+                memcpy(asks[ask_count].query, folder->query, SMART_FOLDER_QUERY_MAX);
+                ask_count++;
+            }
+        }
+    }
+    pthread_mutex_unlock(&folders->mutex);
+
+    for (int a = 0; a < ask_count; a++) {
+        bool matches = semantic.match(path, asks[a].query, semantic.context);
+
+        pthread_mutex_lock(&folders->mutex);
+        for (int i = 0; i < folders->count; i++) {
+            SmartFolder *folder = folders->folders[i];
+            if (folder->id != asks[a].id) {
+                continue;
+            }
+            pthread_mutex_lock(&folder->mutex);
+            if (folder->ready && !folder->building) {
+                member_update(&folder->matcher, &folder->members, relative_path(folder, path), matches);
+            }
+            pthread_mutex_unlock(&folder->mutex);
+        }
+        pthread_mutex_unlock(&folders->mutex);
+    }
+}
+
+void smart_folders_wait(SmartFolders *folders)
+{
+    if (!folders) return;
+    pthread_mutex_lock(&folders->mutex);
+    int count = folders->count;
+    JobToken *tokens[SMART_FOLDER_MAX];
+    for (int i = 0; i < count; i++) {
+        tokens[i] = folders->folders[i]->token;
+    }
+    pthread_mutex_unlock(&folders->mutex);
+
+    for (int i = 0; i < count; i++) {
+        job_token_wait(tokens[i]);
+    }
+}
+
+bool smart_folders_save(SmartFolders *folders, const char *file)
+{
+    if (!folders || !file) return false;
+    FILE *f = fopen(file, "w");
+    if (!f) {
+        return false;
+    }
+
+    pthread_mutex_lock(&folders->mutex);
+    for (int i = 0; i < folders->count; i++) {
+        const SmartFolder *folder = folders->folders[i];
+        fprintf(f, "%s\t%s\t%s\t%s\n", smart_folder_kind_name(folder->kind), folder->name, folder->root,
+                folder->query);
+    }
+    pthread_mutex_unlock(&folders->mutex);
+
+    bool ok = !ferror(f);
+    return fclose(f) == 0 && ok;
+}
+
+int smart_folders_load(SmartFolders *folders, const char *file)
+{
+    if (!folders || !file) return -1;
+    FILE *f = fopen(file, "r");
+    if (!f) {
+        return -1;
+    }
+
+    // kind, name, root, query separated by tabs
+    int added = 0;
+    char line[PATH_MAX_LEN + SMART_FOLDER_NAME_MAX + SMART_FOLDER_QUERY_MAX + 32];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *fields[4];
+        char *p = line;
+        int field_count = 0;
+        while (field_count < 4 && p) {
+            fields[field_count++] = p;
+            p = strchr(p, '\t');
+            if (p) *p++ = '\0';
+        }
+        SmartFolderKind kind;
+        if (field_count == 4 && !p && smart_folder_kind_parse(fields[0], &kind) &&
+            smart_folders_add(folders, fields[1], kind, fields[2], fields[3]) >= 0) {
+            added++;
+        }
+    }
+    fclose(f);
+    return added;
+}
@@ -0,0 +1,109 @@
+#ifndef SMART_FOLDER_H
+#define SMART_FOLDER_H
+
+#include "filesystem.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+struct FsWatch;
+struct PathIndex;
+
+// Smart folders: saved searches below a root folder (a filename pattern, a filter
+// expression as in core/filter_query.h, or a semantic query). Each folder's members are
+// materialized once, from the filename index where it covers the root, into a listing
+// whose names are paths relative to the root. After that the watch bus (and the indexer,
+// for semantic queries) keeps the listing current one changed path at a time, with a
+// hash of member names to find a path's entry. Opening a folder copies the listing,
+// which shares its buffers until either side changes, so it costs no more than opening
+// a cached directory however large the index is
+
+#define SMART_FOLDER_MAX 32
+#define SMART_FOLDER_NAME_MAX 64
+#define SMART_FOLDER_QUERY_MAX 256
+#define SMART_FOLDER_MAX_MEMBERS 100000     // Members kept; matches past this are left out
+#define SMART_FOLDER_PENDING_MAX 4096       // Changes held during a rebuild before it starts over
+#define SMART_FOLDER_RESCAN_DIRS 64         // Changed directories re-read one by one; more rebuild
+#define SMART_FOLDER_MAX_DEPTH 64           // Deepest folder walked where the index does not reach
+
+typedef enum SmartFolderKind {
+    SMART_FOLDER_PATTERN,       // fnmatch glob on names ("*.psd")
+    SMART_FOLDER_FILTER,        // Filter terms; other words must appear in the name
+    SMART_FOLDER_SEMANTIC       // Natural language query through SmartFolderSemantic
+} SmartFolderKind;
+
+// Semantic matching, supplied by whoever owns the models. Both are called off the main thread
+typedef struct SmartFolderSemantic {
+    // Indexed files below root matching query, as a malloc'd array of malloc'd paths;
+    // returns the count, or -1 while search is unavailable
+    int (*query)(const char *query, const char *root, char ***paths, void *context);
+    // Whether the file at path, just indexed, matches query
+    bool (*match)(const char *path, const char *query, void *context);
+    void *context;
+} SmartFolderSemantic;
+
+// A folder's definition and state, for the sidebar
+typedef struct SmartFolderInfo {
+    char name[SMART_FOLDER_NAME_MAX];
+    char root[PATH_MAX_LEN];
+    SmartFolderKind kind;
+    char query[SMART_FOLDER_QUERY_MAX];
+    int member_count;
+    bool ready;                 // Materialized; false until the first build finishes
+    bool truncated;             // More than SMART_FOLDER_MAX_MEMBERS matched
+} SmartFolderInfo;
+
+// Set of smart folders (opaque)
+typedef struct SmartFolders SmartFolders;
+
+// Create an empty set following changes on watch (may be NULL: no live updates)
+SmartFolders *smart_folders_create(struct FsWatch *watch);
+
+// Stop following changes, cancel builds in progress and free every folder
+void smart_folders_destroy(SmartFolders *folders);
+
+// Materialize from index from now on (NULL: walk the file system); folders rebuild
+void smart_folders_set_path_index(SmartFolders *folders, struct PathIndex *index);
+
+// Set semantic matching (copied; NULL to remove); semantic folders rebuild
+void smart_folders_set_semantic(SmartFolders *folders, const SmartFolderSemantic *semantic);
+
+// Add a folder and start materializing it in the background (jobs, utils/jobs.h).
+// Returns its index, or -1 if the set is full, a field is too long or holds a tab or
+// newline, or a filter query has a term that does not compile
+int smart_folders_add(SmartFolders *folders, const char *name, SmartFolderKind kind,
+                      const char *root, const char *query);
+
+// Remove the folder at index (later folders move down one); waits out its build
+bool smart_folders_remove(SmartFolders *folders, int index);
+
+// Number of folders
+int smart_folders_count(SmartFolders *folders);
+
+// Copy out the folder at index; false if there is none
+bool smart_folders_info(SmartFolders *folders, int index, SmartFolderInfo *info);
+
+// Replace state with the folder's members (state keeps its show_hidden and streaming
+// settings). Returns false, leaving state alone, while the folder is not materialized
+// yet; a failed build is retried then
+bool smart_folders_open(SmartFolders *folders, int index, DirectoryState *state);
+
+// Changes whenever the folder's members do (0 while not materialized)
+uint32_t smart_folders_generation(SmartFolders *folders, int index);
+
+// Tell semantic folders the indexer has just embedded path (any thread)
+void smart_folders_indexed(SmartFolders *folders, const char *path);
+
+// Block until every build in progress has finished
+void smart_folders_wait(SmartFolders *folders);
+
+// Save the definitions (not the members) to file; false on I/O error
+bool smart_folders_save(SmartFolders *folders, const char *file);
+
+// Add the folders saved in file; returns how many, -1 if it could not be read
+int smart_folders_load(SmartFolders *folders, const char *file);
+
+// Kind as saved ("pattern", "filter", "semantic"), and back; false for an unknown name
+const char *smart_folder_kind_name(SmartFolderKind kind);
+bool smart_folder_kind_parse(const char *name, SmartFolderKind *kind);
+
+#endif // SMART_FOLDER_H
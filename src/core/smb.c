@@ -0,0 +1,572 @@
+#include "network.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef FINDER_PLUS_LIBSMB2
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <smb2/smb2.h>
+#include <smb2/libsmb2.h>
+
+// Reads or writes kept in flight per transfer; each takes credits for its size, so the
+// server sees a full window instead of one request per round trip
+#define SMB_PIPELINE_DEPTH 8
+
+// Cap on one read or write, under what the server negotiated (large MTU servers offer
+// 1-8 MB)
+#define SMB_MAX_IO_SIZE (8 * 1024 * 1024)
+
+// Seconds a synchronous libsmb2 call may wait on the server
+#define SMB_TIMEOUT 30
+
+// How long a transfer waits on the socket before checking pause and cancel
+#define SMB_POLL_MS 100
+
+// Session of one connection. A libsmb2 context is not thread-safe, so calls on it are
+// made one at a time
+typedef struct SmbSession {
+    struct smb2_context *smb2;
+    pthread_mutex_t mutex;
+    char share[NETWORK_PATH_MAX];
+} SmbSession;
+
+// Helper: Record the context's last error on the connection
+static void smb_set_error(NetworkConnection *conn, SmbSession *session, const char *what)
+{
+    snprintf(conn->error_message, sizeof(conn->error_message), "%s: %s", what,
+             session && session->smb2 ? smb2_get_error(session->smb2) : "no session");
+}
+
+// Helper: Map a connection path ("/share/dir/file") to one inside the share
+// ("dir/file", "" for its root). False for a path on another share
+static bool smb_share_path(const SmbSession *session, const char *path, char *out, size_t out_size)
+{
+    while (*path == '/') {
+        path++;
+    }
+    size_t share_len = strlen(session->share);
+    if (strncmp(path, session->share, share_len) != 0 ||
+        (path[share_len] != '\0' && path[share_len] != '/')) {
+        return false;
+    }
+    path += share_len;
+    while (*path == '/') {
+        path++;
+    }
+
+    size_t len = strlen(path);
+    while (len > 0 && path[len - 1] == '/') {
+        len--;
+    }
+    if (len >= out_size) {
+        return false;
+    }
+    memcpy(out, path, len);
+    out[len] = '\0';
+    return true;
+}
+
+bool smb_connect(NetworkConnection *conn)
+{
+    // The first component of the initial path names the share
+    const char *path = conn->current_path;
+    while (*path == '/') {
+        path++;
+    }
+    size_t share_len = strcspn(path, "/");
+    if (share_len == 0) {
+        strncpy(conn->error_message, "No share in the remote path (use /share/folder)",
+                sizeof(conn->error_message) - 1);
+        return false;
+    }
+
+    SmbSession *session = calloc(1, sizeof(SmbSession));
+    if (!session) {
+        return false;
+    }
+    memcpy(session->share, path, share_len);
+    session->share[share_len] = '\0';
+    pthread_mutex_init(&session->mutex, NULL);
+
+    session->smb2 = smb2_init_context();
+    if (!session->smb2) {
+        strncpy(conn->error_message, "Failed to create SMB context", sizeof(conn->error_message) - 1);
+        pthread_mutex_destroy(&session->mutex);
+        free(session);
+        return false;
+    }
+
+    smb2_set_security_mode(session->smb2, SMB2_NEGOTIATE_SIGNING_ENABLED);
+    smb2_set_version(session->smb2, SMB2_VERSION_ANY);
+    smb2_set_timeout(session->smb2, SMB_TIMEOUT);
+    if (conn->profile.password[0] != '\0') {
+        smb2_set_password(session->smb2, conn->profile.password);
+    }
+
+    char server[NETWORK_HOST_MAX + 8];
+    if (conn->profile.port != 0 && conn->profile.port != 445) {
+        snprintf(server, sizeof(server), "%s:%d", conn->profile.host, conn->profile.port);
+    } else {
+        snprintf(server, sizeof(server), "%s", conn->profile.host);
+    }
+
+    if (smb2_connect_share(session->smb2, server, session->share, conn->profile.username) < 0) {
+        smb_set_error(conn, session, "Failed to connect");
+        smb2_destroy_context(session->smb2);
+        pthread_mutex_destroy(&session->mutex);
+        free(session);
+        return false;
+    }
+
+    conn->smb_session = session;
+    return true;
+}
+
+void smb_disconnect(NetworkConnection *conn)
+{
+    SmbSession *session = (SmbSession *)conn->smb_session;
+    if (!session) {
+        return;
+    }
+
+    pthread_mutex_lock(&session->mutex);
+    smb2_disconnect_share(session->smb2);
+    smb2_destroy_context(session->smb2);
+    pthread_mutex_unlock(&session->mutex);
+
+    pthread_mutex_destroy(&session->mutex);
+    free(session);
+    conn->smb_session = NULL;
+}
+
+bool smb_read_directory(NetworkConnection *conn, const char *path, DirectoryState *dir)
+{
+    SmbSession *session = (SmbSession *)conn->smb_session;
+    char share_path[NETWORK_PATH_MAX];
+    if (!session || !smb_share_path(session, path, share_path, sizeof(share_path))) {
+        return false;
+    }
+
+    pthread_mutex_lock(&session->mutex);
+
+    // opendir sends CREATE, QUERY_DIRECTORY and CLOSE as one compound and keeps querying
+    // until the folder is done; every entry arrives with its size, times and type, so
+    // nothing is stat'ed one by one
+    struct smb2dir *handle = smb2_opendir(session->smb2, share_path);
+    if (!handle) {
+        smb_set_error(conn, session, "Failed to open directory");
+        pthread_mutex_unlock(&session->mutex);
+        return false;
+    }
+
+    DirectoryState listing;
+    directory_state_init(&listing);
+    strncpy(listing.current_path, path, PATH_MAX_LEN - 1);
+
+    bool ok = true;
+    struct smb2dirent *ent;
+    while ((ent = smb2_readdir(session->smb2, handle)) != NULL) {
+        if (strcmp(ent->name, ".") == 0 || strcmp(ent->name, "..") == 0) {
+            continue;
+        }
+
+        FileEntry *entry = directory_append_entry(&listing, ent->name);
+        if (!entry) {
+            ok = false;
+            break;
+        }
+
+        entry->is_directory = ent->st.smb2_type == SMB2_TYPE_DIRECTORY;
+        entry->is_hidden = (ent->name[0] == '.');
+        entry->is_symlink = ent->st.smb2_type == SMB2_TYPE_LINK;
+        entry->size = (off_t)ent->st.smb2_size;
+        entry->modified = (time_t)ent->st.smb2_mtime;
+        entry->created = (time_t)(ent->st.smb2_btime ? ent->st.smb2_btime : ent->st.smb2_mtime);
+        entry->permissions = entry->is_directory ? (S_IFDIR | 0755) : (S_IFREG | 0644);
+    }
+    smb2_closedir(session->smb2, handle);
+
+    pthread_mutex_unlock(&session->mutex);
+
+    if (!ok) {
+        directory_state_free(&listing);
+        return false;
+    }
+
+    // Directories first, then alphabetical by name
+    directory_sort(&listing, SORT_BY_NAME, true);
+    directory_state_free(dir);
+    *dir = listing;
+    return true;
+}
+
+// One read or write in flight
+typedef struct SmbChunk {
+    struct SmbTransfer *transfer;
+    uint8_t *buffer;
+    uint64_t offset;
+    uint32_t length;
+    bool busy;
+} SmbChunk;
+
+// A pipelined transfer between a remote file and a local fd
+typedef struct SmbTransfer {
+    struct smb2_context *smb2;
+    struct smb2fh *fh;
+    int fd;
+    bool upload;
+    uint64_t next;                      // Offset of the next chunk to send
+    uint64_t size;
+    uint32_t chunk_size;
+    int in_flight;
+    bool failed;
+    CopyControl *control;
+    SmbChunk chunks[SMB_PIPELINE_DEPTH];
+} SmbTransfer;
+
+// Helper: Send chunk's range as a read or write
+static bool smb_chunk_send(SmbChunk *chunk);
+
+// Callback: A read or write finished; status is the byte count or a negative errno.
+// A short one sends the rest of its range again
+static void smb_chunk_done(struct smb2_context *smb2, int status, void *command_data, void *cb_data)
+{
+    (void)smb2;
+    (void)command_data;
+    SmbChunk *chunk = (SmbChunk *)cb_data;
+    SmbTransfer *t = chunk->transfer;
+
+    t->in_flight--;
+    chunk->busy = false;
+    if (status <= 0 || (uint32_t)status > chunk->length) {
+        t->failed = true;
+        return;
+    }
+
+    if (!t->upload &&
+        pwrite(t->fd, chunk->buffer, (size_t)status, (off_t)chunk->offset) != (ssize_t)status) {
+        t->failed = true;
+        return;
+    }
+    if (t->control) {
+        atomic_fetch_add(&t->control->bytes_done, (long long)status);
+    }
+
+    if ((uint32_t)status < chunk->length) {
+        if (t->upload) {
+            memmove(chunk->buffer, chunk->buffer + status, chunk->length - (uint32_t)status);
+        }
+        chunk->offset += (uint64_t)status;
+        chunk->length -= (uint32_t)status;
+        if (!smb_chunk_send(chunk)) {
+            t->failed = true;
+        }
+    }
+}
+
+static bool smb_chunk_send(SmbChunk *chunk)
+{
+    SmbTransfer *t = chunk->transfer;
+    int rc = t->upload
+        ? smb2_pwrite_async(t->smb2, t->fh, chunk->buffer, chunk->length, chunk->offset,
+                            smb_chunk_done, chunk)
+        : smb2_pread_async(t->smb2, t->fh, chunk->buffer, chunk->length, chunk->offset,
+                           smb_chunk_done, chunk);
+    if (rc < 0) {
+        return false;
+    }
+    chunk->busy = true;
+    t->in_flight++;
+    return true;
+}
+
+// Helper: Start the next range on a free chunk (reading it from the local file first
+// for an upload)
+static bool smb_chunk_start(SmbTransfer *t, SmbChunk *chunk)
+{
+    uint64_t remaining = t->size - t->next;
+    chunk->offset = t->next;
+    chunk->length = remaining < t->chunk_size ? (uint32_t)remaining : t->chunk_size;
+
+    if (t->upload &&
+        pread(t->fd, chunk->buffer, chunk->length, (off_t)chunk->offset) != (ssize_t)chunk->length) {
+        return false;
+    }
+    t->next += chunk->length;
+    return smb_chunk_send(chunk);
+}
+
+// Helper: Move size bytes between fh and fd, keeping up to SMB_PIPELINE_DEPTH reads or
+// writes of the negotiated size in flight (call with the session mutex held)
+static bool smb_transfer(struct smb2_context *smb2, struct smb2fh *fh, int fd, uint64_t size,
+                         bool upload, CopyControl *control)
+{
+    SmbTransfer t;
+    memset(&t, 0, sizeof(t));
+    t.smb2 = smb2;
+    t.fh = fh;
+    t.fd = fd;
+    t.upload = upload;
+    t.size = size;
+    t.control = control;
+    t.chunk_size = upload ? smb2_get_max_write_size(smb2) : smb2_get_max_read_size(smb2);
+    if (t.chunk_size == 0 || t.chunk_size > SMB_MAX_IO_SIZE) {
+        t.chunk_size = SMB_MAX_IO_SIZE;
+    }
+
+    for (int i = 0; i < SMB_PIPELINE_DEPTH; i++) {
+        t.chunks[i].transfer = &t;
+        t.chunks[i].buffer = malloc(t.chunk_size);
+        if (!t.chunks[i].buffer) {
+            t.failed = true;
+        }
+    }
+
+    while (t.in_flight > 0 || (!t.failed && t.next < t.size)) {
+        bool cancelled = control && atomic_load(&control->cancel);
+        bool paused = control && atomic_load(&control->pause);
+        if (cancelled) {
+            t.failed = true;
+        }
+
+        // Top the window up
+        for (int i = 0; i < SMB_PIPELINE_DEPTH && !t.failed && !paused && t.next < t.size; i++) {
+            if (!t.chunks[i].busy && !smb_chunk_start(&t, &t.chunks[i])) {
+                t.failed = true;
+            }
+        }
+        if (t.in_flight == 0) {
+            if (t.failed || t.next >= t.size) {
+                break;
+            }
+            // Paused with nothing in flight
+            usleep(SMB_POLL_MS * 1000);
+            continue;
+        }
+
+        struct pollfd pfd = {
+            .fd = smb2_get_fd(smb2),
+            .events = (short)smb2_which_events(smb2),
+        };
+        if (poll(&pfd, 1, SMB_POLL_MS) < 0 && errno != EINTR) {
+            t.failed = true;
+            break;
+        }
+        if (pfd.revents && smb2_service(smb2, pfd.revents) < 0) {
+            // The connection is gone; replies still owed will not come
+            t.failed = true;
+            break;
+        }
+    }
+
+    for (int i = 0; i < SMB_PIPELINE_DEPTH; i++) {
+        free(t.chunks[i].buffer);
+    }
+    return !t.failed && t.next >= t.size;
+}
+
+bool smb_download(NetworkConnection *conn, const char *remote, const char *local, CopyControl *control)
+{
+    SmbSession *session = (SmbSession *)conn->smb_session;
+    char share_path[NETWORK_PATH_MAX];
+    if (!session || !smb_share_path(session, remote, share_path, sizeof(share_path))) {
+        return false;
+    }
+
+    int fd = open(local, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    pthread_mutex_lock(&session->mutex);
+    bool success = false;
+    struct smb2_stat_64 st;
+    struct smb2fh *fh = NULL;
+    if (smb2_stat(session->smb2, share_path, &st) == 0 &&
+        (fh = smb2_open(session->smb2, share_path, O_RDONLY)) != NULL) {
+        success = smb_transfer(session->smb2, fh, fd, st.smb2_size, false, control);
+        smb2_close(session->smb2, fh);
+    } else {
+        smb_set_error(conn, session, "Failed to open remote file");
+    }
+    pthread_mutex_unlock(&session->mutex);
+
+    if (close(fd) != 0) {
+        success = false;
+    }
+    if (!success) {
+        unlink(local);
+    }
+    return success;
+}
+
+bool smb_upload(NetworkConnection *conn, const char *local, const char *remote, CopyControl *control)
+{
+    SmbSession *session = (SmbSession *)conn->smb_session;
+    char share_path[NETWORK_PATH_MAX];
+    if (!session || !smb_share_path(session, remote, share_path, sizeof(share_path))) {
+        return false;
+    }
+
+    int fd = open(local, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+
+    pthread_mutex_lock(&session->mutex);
+    bool success = false;
+    struct smb2fh *fh = smb2_open(session->smb2, share_path, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fh) {
+        success = smb_transfer(session->smb2, fh, fd, (uint64_t)st.st_size, true, control);
+        if (smb2_close(session->smb2, fh) < 0) {
+            success = false;
+        }
+    } else {
+        smb_set_error(conn, session, "Failed to create remote file");
+    }
+    pthread_mutex_unlock(&session->mutex);
+
+    close(fd);
+    return success;
+}
+
+// Path operations
+typedef enum {
+    SMB_OP_MKDIR,
+    SMB_OP_RMDIR,
+    SMB_OP_UNLINK,
+    SMB_OP_RENAME
+} SmbPathOp;
+
+// Helper: Run a one-call operation on path (and target for a rename)
+static bool smb_path_op(NetworkConnection *conn, SmbPathOp op, const char *path, const char *target)
+{
+    SmbSession *session = (SmbSession *)conn->smb_session;
+    char share_path[NETWORK_PATH_MAX];
+    char share_target[NETWORK_PATH_MAX];
+    if (!session || !smb_share_path(session, path, share_path, sizeof(share_path)) ||
+        (target && !smb_share_path(session, target, share_target, sizeof(share_target)))) {
+        return false;
+    }
+
+    pthread_mutex_lock(&session->mutex);
+    int rc = -1;
+    switch (op) {
+        case SMB_OP_MKDIR:  rc = smb2_mkdir(session->smb2, share_path); break;
+        case SMB_OP_RMDIR:  rc = smb2_rmdir(session->smb2, share_path); break;
+        case SMB_OP_UNLINK: rc = smb2_unlink(session->smb2, share_path); break;
+        case SMB_OP_RENAME: rc = smb2_rename(session->smb2, share_path, share_target); break;
+    }
+    if (rc < 0) {
+        smb_set_error(conn, session, "SMB operation failed");
+    }
+    pthread_mutex_unlock(&session->mutex);
+    return rc >= 0;
+}
+
+bool smb_mkdir(NetworkConnection *conn, const char *path)
+{
+    return smb_path_op(conn, SMB_OP_MKDIR, path, NULL);
+}
+
+bool smb_rmdir(NetworkConnection *conn, const char *path)
+{
+    return smb_path_op(conn, SMB_OP_RMDIR, path, NULL);
+}
+
+bool smb_unlink(NetworkConnection *conn, const char *path)
+{
+    return smb_path_op(conn, SMB_OP_UNLINK, path, NULL);
+}
+
+bool smb_rename(NetworkConnection *conn, const char *old_path, const char *new_path)
+{
+    return smb_path_op(conn, SMB_OP_RENAME, old_path, new_path);
+}
+
+#else
+
+// Without libsmb2 every SMB call fails
+
+bool smb_connect(NetworkConnection *conn)
+{
+    strncpy(conn->error_message, "SMB support not available (built without libsmb2)",
+            sizeof(conn->error_message) - 1);
+    return false;
+}
+
+void smb_disconnect(NetworkConnection *conn)
+{
+    (void)conn;
+}
+
+bool smb_read_directory(NetworkConnection *conn, const char *path, DirectoryState *dir)
+{
+    (void)conn;
+    (void)path;
+    (void)dir;
+    return false;
+}
+
+bool smb_download(NetworkConnection *conn, const char *remote, const char *local, CopyControl *control)
+{
+    (void)conn;
+    (void)remote;
+    (void)local;
+    (void)control;
+    return false;
+}
+
+bool smb_upload(NetworkConnection *conn, const char *local, const char *remote, CopyControl *control)
+{
+    (void)conn;
+    (void)local;
+    (void)remote;
+    (void)control;
+    return false;
+}
+
+bool smb_mkdir(NetworkConnection *conn, const char *path)
+{
+    (void)conn;
+    (void)path;
+    return false;
+}
+
+bool smb_rmdir(NetworkConnection *conn, const char *path)
+{
+    (void)conn;
+    (void)path;
+    return false;
+}
+
+bool smb_unlink(NetworkConnection *conn, const char *path)
+{
+    (void)conn;
+    (void)path;
+    return false;
+}
+
+bool smb_rename(NetworkConnection *conn, const char *old_path, const char *new_path)
+{
+    (void)conn;
+    (void)old_path;
+    (void)new_path;
+    return false;
+}
+
+#endif // FINDER_PLUS_LIBSMB2
@@ -0,0 +1,517 @@
+#include "spotlight_search.h"
+#include "filesystem.h"
+#include "../platform/spotlight.h"
+#include "../utils/file_type.h"
+
+#include <fnmatch.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define SPOTLIGHT_QUERY_MAX 8192
+#define SPOTLIGHT_TAKE_BATCH 256
+
+struct SpotlightSearch {
+    SpotlightQuery *query;
+    char scope[PATH_MAX_LEN];
+    char names[FILTER_MAX_TEXT];
+    char glob[FILTER_MAX_TEXT];
+    FilterQuery filter;
+    int max_results;
+};
+
+// Query text being built; ok turns false once it overflows
+typedef struct QueryText {
+    char *text;
+    size_t size;
+    size_t length;
+    bool ok;
+} QueryText;
+
+//=============================================================================
+// Building queries
+//=============================================================================
+
+// Helper: Append printf-style text
+static void query_append(QueryText *query, const char *format, ...)
+{
+    if (!query->ok) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(query->text + query->length, query->size - query->length, format, args);
+    va_end(args);
+    if (written < 0 || (size_t)written >= query->size - query->length) {
+        query->ok = false;
+        return;
+    }
+    query->length += (size_t)written;
+}
+
+// Helper: Start one more clause of the conjunction
+static void query_and(QueryText *query)
+{
+    if (query->length > 0) {
+        query_append(query, " && ");
+    }
+}
+
+// Helper: Whether text can go into a quoted Spotlight string as it is
+static bool query_literal(const char *text, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '*' || text[i] == '"' || text[i] == '\\' || text[i] == '\'') {
+            return false;
+        }
+    }
+    return length > 0;
+}
+
+// Helper: Clause for names holding every term of names (as path_index_query)
+static bool query_names(QueryText *query, const char *names)
+{
+    const char *term = names;
+    while (*term) {
+        while (*term == ' ') term++;
+        size_t length = strcspn(term, " ");
+        if (length == 0) {
+            break;
+        }
+        // Path terms and hidden names are beyond Spotlight
+        if (memchr(term, '/', length) != NULL || term[0] == '.' || !query_literal(term, length)) {
+            return false;
+        }
+        query_and(query);
+        query_append(query, "kMDItemFSName == \"*%.*s*\"cd", (int)length, term);
+        term += length;
+    }
+    return true;
+}
+
+// Helper: Clause for names matching a glob: '?' and bracket sets widen to '*'
+static bool query_glob(QueryText *query, const char *glob)
+{
+    if (glob[0] == '.') {
+        return false;
+    }
+    char pattern[FILTER_MAX_TEXT];
+    size_t length = 0;
+    bool literal = false;
+    for (const char *p = glob; *p; p++) {
+        char c = *p;
+        if (c == '"' || c == '\\' || c == '\'') {
+            return false;
+        }
+        if (c == '[') {
+            const char *close = strchr(p + 1 + (p[1] == ']'), ']');
+            if (close != NULL) {
+                p = close;
+            }
+            c = '*';
+        } else if (c == '?') {
+            c = '*';
+        } else if (c != '*') {
+            literal = true;
+        }
+        if (c == '*' && length > 0 && pattern[length - 1] == '*') {
+            continue;
+        }
+        if (length + 1 >= sizeof(pattern)) {
+            return false;
+        }
+        pattern[length++] = c;
+    }
+    if (literal) {
+        pattern[length] = '\0';
+        query_and(query);
+        query_append(query, "kMDItemFSName == \"%s\"c", pattern);
+    }
+    return true;
+}
+
+// Helper: One alternative of an extension clause
+static void query_extension(QueryText *query, const char *extension, bool *first)
+{
+    if (!query_literal(extension, strlen(extension))) {
+        return;
+    }
+    query_append(query, "%skMDItemFSName == \"*.%s\"c", *first ? "" : " || ", extension);
+    *first = false;
+}
+
+// Helper: "$time.iso(...)" of a time in UTC
+static void query_time(QueryText *query, int64_t seconds)
+{
+    time_t when = (time_t)seconds;
+    struct tm utc;
+    if (gmtime_r(&when, &utc) == NULL) {
+        query->ok = false;
+        return;
+    }
+    char text[32];
+    strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    query_append(query, "$time.iso(%s)", text);
+}
+
+// Helper: Clause for one filter term; false if Spotlight cannot see what it selects
+static bool query_term(QueryText *query, const FilterTerm *term)
+{
+    // Everything a negation passes is left to the checks on each path, as are git badges
+    if (term->negate || term->field == FILTER_FIELD_GIT) {
+        return true;
+    }
+
+    switch (term->field) {
+        case FILTER_FIELD_EXT: {
+            query_and(query);
+            query_append(query, "(");
+            bool first = true;
+            for (int j = 0; j < term->value_count; j++) {
+                query_extension(query, file_type_info(term->values[j])->extension, &first);
+            }
+            for (int e = 0; e < term->extension_count; e++) {
+                query_extension(query, term->extensions[e], &first);
+            }
+            query_append(query, ")");
+            return !first;
+        }
+        case FILTER_FIELD_KIND: {
+            query_and(query);
+            query_append(query, "(");
+            bool first = true;
+            if (term->flags & DIR_COLUMN_DIRECTORY) {
+                query_append(query, "kMDItemContentTypeTree == \"public.directory\"");
+                first = false;
+            }
+            for (int j = 0; j < term->value_count; j++) {
+                // Every extension of the class
+                for (int id = 1; id <= UINT8_MAX; id++) {
+                    const FileTypeInfo *info = file_type_info((FileTypeId)id);
+                    if (info->extension[0] == '\0') {
+                        break;
+                    }
+                    if (info->type_class == term->values[j]) {
+                        query_extension(query, info->extension, &first);
+                    }
+                }
+            }
+            query_append(query, ")");
+            return !first;
+        }
+        case FILTER_FIELD_SIZE:
+            if (term->min > 0) {
+                query_and(query);
+                query_append(query, "kMDItemFSSize >= %lld", (long long)term->min);
+            }
+            if (term->max < INT64_MAX) {
+                query_and(query);
+                query_append(query, "kMDItemFSSize <= %lld", (long long)term->max);
+            }
+            return true;
+        case FILTER_FIELD_MODIFIED:
+            if (term->min > INT64_MIN) {
+                query_and(query);
+                query_append(query, "kMDItemFSContentChangeDate >= ");
+                query_time(query, term->min);
+            }
+            if (term->max < INT64_MAX) {
+                query_and(query);
+                query_append(query, "kMDItemFSContentChangeDate <= ");
+                query_time(query, term->max);
+            }
+            return true;
+        case FILTER_FIELD_IS:
+            if (term->flags & DIR_COLUMN_HIDDEN) {
+                return false;
+            }
+            // Links are not told apart by Spotlight
+            if (term->flags == DIR_COLUMN_DIRECTORY) {
+                query_and(query);
+                query_append(query, "kMDItemContentTypeTree == \"public.directory\"");
+            }
+            return true;
+        case FILTER_FIELD_GIT:
+            break;
+    }
+    return true;
+}
+
+bool spotlight_search_query(const char *names, const char *glob, const FilterQuery *filter,
+                            char *query, size_t size)
+{
+    if (query == NULL || size == 0) {
+        return false;
+    }
+    QueryText text = {query, size, 0, true};
+    query[0] = '\0';
+
+    if (names != NULL && !query_names(&text, names)) {
+        return false;
+    }
+    if (glob != NULL && !query_glob(&text, glob)) {
+        return false;
+    }
+    for (int t = 0; filter != NULL && t < filter->term_count; t++) {
+        if (!query_term(&text, &filter->terms[t])) {
+            return false;
+        }
+    }
+    return text.ok && text.length > 0;
+}
+
+//=============================================================================
+// Searching
+//=============================================================================
+
+// Helper: Whether path is below scope
+static bool path_in_scope(const char *path, const char *scope)
+{
+    size_t length = strlen(scope);
+    if (length > 0 && scope[length - 1] == '/') {
+        length--;
+    }
+    return strncmp(path, scope, length) == 0 && path[length] == '/' && path[length + 1] != '\0';
+}
+
+// Helper: Whether name holds term (ASCII case folded, as the path index compares)
+static bool name_contains(const char *name, const char *term, size_t length)
+{
+    for (; *name; name++) {
+        if (strncasecmp(name, term, length) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Helper: Whether a path Spotlight returned is a match of the search itself
+static bool search_accepts(const SpotlightSearch *search, const char *path)
+{
+    if (!path_in_scope(path, search->scope)) {
+        return false;
+    }
+    const char *slash = strrchr(path, '/');
+    const char *name = slash ? slash + 1 : path;
+
+    for (const char *p = search->names; *p; ) {
+        while (*p == ' ') p++;
+        size_t length = strcspn(p, " ");
+        if (length == 0) {
+            break;
+        }
+        if (!name_contains(name, p, length)) {
+            return false;
+        }
+        p += length;
+    }
+    if (search->glob[0] != '\0' && fnmatch(search->glob, name, 0) != 0) {
+        return false;
+    }
+    return search->filter.term_count == 0 || filter_query_match_path(&search->filter, path);
+}
+
+// Helper: Rank a match as the path index does: prefix and exact name hits first, then
+// shallower paths and shorter names
+static int search_score(const SpotlightSearch *search, const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    const char *name = slash ? slash + 1 : path;
+    int name_length = (int)strlen(name);
+    int depth = -1;
+    for (const char *p = path; *p; p++) {
+        if (*p == '/') depth++;
+    }
+
+    int score = 1000 - 20 * (depth < 40 ? depth : 40) - (name_length < 200 ? name_length : 200);
+    for (const char *p = search->names; *p; ) {
+        while (*p == ' ') p++;
+        size_t length = strcspn(p, " ");
+        if (length == 0) {
+            break;
+        }
+        if (strncasecmp(name, p, length) == 0) {
+            score += 200;
+            if ((int)length == name_length) score += 300;
+        }
+        p += length;
+    }
+    return score;
+}
+
+// Helper: Start a query for names, glob and filter below scope
+static SpotlightSearch *search_begin(const char *scope, const char *names, const char *glob,
+                                     const FilterQuery *filter, int max_results)
+{
+    if (scope == NULL || scope[0] != '/' || strlen(scope) >= PATH_MAX_LEN || max_results <= 0 ||
+        (names && strlen(names) >= FILTER_MAX_TEXT) || (glob && strlen(glob) >= FILTER_MAX_TEXT)) {
+        return NULL;
+    }
+    char *text = malloc(SPOTLIGHT_QUERY_MAX);
+    if (text == NULL) {
+        return NULL;
+    }
+    if (!spotlight_search_query(names, glob, filter, text, SPOTLIGHT_QUERY_MAX) ||
+        !platform_spotlight_indexes(scope)) {
+        free(text);
+        return NULL;
+    }
+
+    SpotlightSearch *search = calloc(1, sizeof(SpotlightSearch));
+    if (search == NULL) {
+        free(text);
+        return NULL;
+    }
+    snprintf(search->scope, sizeof(search->scope), "%s", scope);
+    snprintf(search->names, sizeof(search->names), "%s", names ? names : "");
+    snprintf(search->glob, sizeof(search->glob), "%s", glob ? glob : "");
+    if (filter != NULL) {
+        search->filter = *filter;
+    }
+    search->max_results = max_results;
+
+    int cap = max_results < INT32_MAX / SPOTLIGHT_SEARCH_OVERSCAN ? max_results * SPOTLIGHT_SEARCH_OVERSCAN
+                                                                   : INT32_MAX;
+    search->query = platform_spotlight_start(text, scope, cap);
+    free(text);
+    if (search->query == NULL) {
+        free(search);
+        return NULL;
+    }
+    return search;
+}
+
+bool spotlight_search_available(const char *scope)
+{
+    return platform_spotlight_indexes(scope);
+}
+
+SpotlightSearch *spotlight_search_start(const char *scope, const char *names, const FilterQuery *filter,
+                                        int max_results)
+{
+    return search_begin(scope, names, NULL, filter, max_results);
+}
+
+// Helper: Put a match into results, which stay sorted by score; false if it ranks too low
+static bool results_insert(PathIndexResults *results, int max_results, char *path, int score)
+{
+    if (results->paths == NULL) {
+        results->paths = calloc((size_t)max_results, sizeof(char *));
+        results->scores = calloc((size_t)max_results, sizeof(int));
+        if (results->paths == NULL || results->scores == NULL) {
+            free(results->paths);
+            free(results->scores);
+            results->paths = NULL;
+            results->scores = NULL;
+            return false;
+        }
+    }
+    if (results->count == max_results) {
+        if (score <= results->scores[results->count - 1]) {
+            return false;
+        }
+        free(results->paths[--results->count]);
+    }
+    int at = results->count;
+    while (at > 0 && results->scores[at - 1] < score) {
+        results->paths[at] = results->paths[at - 1];
+        results->scores[at] = results->scores[at - 1];
+        at--;
+    }
+    results->paths[at] = path;
+    results->scores[at] = score;
+    results->count++;
+    return true;
+}
+
+int spotlight_search_poll(SpotlightSearch *search, PathIndexResults *results)
+{
+    if (search == NULL || results == NULL) {
+        return 0;
+    }
+    int arrived = 0;
+    char *batch[SPOTLIGHT_TAKE_BATCH];
+    int taken;
+    while ((taken = platform_spotlight_take(search->query, batch, SPOTLIGHT_TAKE_BATCH)) > 0) {
+        for (int i = 0; i < taken; i++) {
+            if (!search_accepts(search, batch[i])) {
+                free(batch[i]);
+                continue;
+            }
+            arrived++;
+            results->total++;
+            if (!results_insert(results, search->max_results, batch[i], search_score(search, batch[i]))) {
+                free(batch[i]);
+            }
+        }
+    }
+    // Spotlight stopped early: there are more than were counted
+    if (platform_spotlight_truncated(search->query) && results->total == results->count) {
+        results->total++;
+    }
+    return arrived;
+}
+
+bool spotlight_search_is_done(SpotlightSearch *search)
+{
+    return search == NULL || platform_spotlight_gathered(search->query);
+}
+
+void spotlight_search_cancel(SpotlightSearch *search)
+{
+    if (search == NULL) {
+        return;
+    }
+    platform_spotlight_stop(search->query);
+    free(search);
+}
+
+// Helper: Order paths for spotlight_search_find
+static int path_compare(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+bool spotlight_search_find(const char *root, const char *pattern, const FilterQuery *filter, int max_results,
+                           FileFindResults *results)
+{
+    memset(results, 0, sizeof(*results));
+    SpotlightSearch *search = search_begin(root, NULL, pattern, filter, max_results);
+    if (search == NULL) {
+        return false;
+    }
+    platform_spotlight_wait(search->query);
+
+    results->paths = malloc((size_t)max_results * sizeof(char *));
+    bool ok = results->paths != NULL;
+    char *batch[SPOTLIGHT_TAKE_BATCH];
+    int taken;
+    while (ok && (taken = platform_spotlight_take(search->query, batch, SPOTLIGHT_TAKE_BATCH)) > 0) {
+        for (int i = 0; i < taken; i++) {
+            if (!search_accepts(search, batch[i])) {
+                free(batch[i]);
+            } else if (results->count == max_results) {
+                results->truncated = true;
+                free(batch[i]);
+            } else {
+                results->paths[results->count++] = batch[i];
+            }
+        }
+    }
+    if (platform_spotlight_truncated(search->query)) {
+        results->truncated = true;
+    }
+    spotlight_search_cancel(search);
+
+    if (!ok) {
+        return false;
+    }
+    if (results->count > 1) {
+        qsort(results->paths, (size_t)results->count, sizeof(char *), path_compare);
+    }
+    return true;
+}
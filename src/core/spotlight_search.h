@@ -0,0 +1,57 @@
+#ifndef SPOTLIGHT_SEARCH_H
+#define SPOTLIGHT_SEARCH_H
+
+#include "filter_query.h"
+#include "file_find.h"
+#include "../ai/path_index.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Recursive name and filter searches answered by the Spotlight index (platform/spotlight.h)
+// instead of our own index or a walk of the disk. Name terms, globs and the ext, kind,
+// size and modified terms of a filter become a Spotlight query that matches at least
+// everything the search does; each path it returns is then checked against the search
+// itself, so the results mean what the path index and filter_query mean. Spotlight does
+// not list hidden files, the contents of packages, or folders excluded from it, so a
+// search that could only find those (a name starting with '.', is:hidden) or a scope it
+// does not index is left to the callers' own index
+
+// Paths Spotlight may return for each result kept, for the ones the checks drop
+#define SPOTLIGHT_SEARCH_OVERSCAN 4
+
+// Search in progress (opaque)
+typedef struct SpotlightSearch SpotlightSearch;
+
+// Build the Spotlight query for files whose name holds every space-separated term of
+// names, matches the fnmatch glob and passes filter (any may be NULL). False if the
+// search cannot be put to Spotlight, or nothing in it narrows the query
+bool spotlight_search_query(const char *names, const char *glob, const FilterQuery *filter,
+                            char *query, size_t size);
+
+// Whether Spotlight indexes scope
+bool spotlight_search_available(const char *scope);
+
+// Start searching below scope for names passing filter (as spotlight_search_query).
+// NULL if Spotlight cannot answer it
+SpotlightSearch *spotlight_search_start(const char *scope, const char *names, const FilterQuery *filter,
+                                        int max_results);
+
+// Merge the matches found since the last call into results, which keeps the best
+// max_results by the path index's score (highest first) and counts every match in total.
+// Matches keep arriving after the first gathering as files come to match. Returns how
+// many matches arrived
+int spotlight_search_poll(SpotlightSearch *search, PathIndexResults *results);
+
+// Whether the first gathering is done
+bool spotlight_search_is_done(SpotlightSearch *search);
+
+// Stop a search and free it
+void spotlight_search_cancel(SpotlightSearch *search);
+
+// Find paths below root whose name matches the fnmatch glob pattern and passes filter
+// (may be NULL), up to max_results, as file_find does (sorted by path). Waits for the
+// first gathering. False if Spotlight cannot answer it
+bool spotlight_search_find(const char *root, const char *pattern, const FilterQuery *filter, int max_results,
+                           FileFindResults *results);
+
+#endif // SPOTLIGHT_SEARCH_H
@@ -0,0 +1,365 @@
+#include "stat_cache.h"
+#include "../utils/hash.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __APPLE__
+#include <sys/mount.h>
+#endif
+
+#define STAT_CACHE_MAX_DEVICES 32
+
+#define ENTRY_HAS_STAT 0x1              // st holds the path's lstat()
+#define ENTRY_DIR_CHECKED 0x2           // Whether the path is its own real path is known
+#define ENTRY_DIR_CANONICAL 0x4         // It is, so paths below it may be cached
+
+typedef struct StatEntry {
+    struct StatEntry *next;             // Bucket chain
+    struct StatEntry *newer;            // Recency list, newest at g_stat.newest
+    struct StatEntry *older;
+    uint32_t hash;
+    uint32_t flags;
+    struct stat st;
+    char path[];
+} StatEntry;
+
+typedef struct DeviceInfo {
+    dev_t dev;
+    bool local;
+} DeviceInfo;
+
+static struct {
+    pthread_mutex_t mutex;
+    int users;                          // Streams between stat_cache_begin and stat_cache_end
+    StatEntry **buckets;
+    StatEntry *newest;
+    StatEntry *oldest;
+    int count;
+    size_t bytes;
+    uint64_t generation;                // Bumped on every invalidation
+    DeviceInfo devices[STAT_CACHE_MAX_DEVICES];
+    int device_count;
+    uint64_t hits;
+    uint64_t misses;
+} g_stat = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+// Helper: Absolute, with no empty, "." or ".." components and no trailing slash, as events
+// name paths; anything else could never be invalidated
+static bool cacheable(const char *path)
+{
+    if (path[0] != '/' || path[1] == '\0') {
+        return false;
+    }
+    for (const char *c = path; *c; c++) {
+        if (*c != '/') continue;
+        if (c[1] == '/' || c[1] == '\0') return false;
+        if (c[1] == '.' && (c[2] == '/' || c[2] == '\0')) return false;
+        if (c[1] == '.' && c[2] == '.' && (c[3] == '/' || c[3] == '\0')) return false;
+    }
+    return true;
+}
+
+// Helper: Find an entry (call with mutex held)
+static StatEntry *find_locked(const char *path, size_t len, uint32_t hash)
+{
+    for (StatEntry *entry = g_stat.buckets[hash & (STAT_CACHE_BUCKETS - 1)]; entry; entry = entry->next) {
+        if (entry->hash == hash && strncmp(entry->path, path, len) == 0 && entry->path[len] == '\0') {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Helper: Move an entry to the newest end of the recency list (call with mutex held)
+static void touch_locked(StatEntry *entry)
+{
+    if (g_stat.newest == entry) {
+        return;
+    }
+    if (entry->newer) entry->newer->older = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    if (g_stat.oldest == entry) g_stat.oldest = entry->newer;
+    entry->newer = NULL;
+    entry->older = g_stat.newest;
+    if (g_stat.newest) g_stat.newest->newer = entry;
+    g_stat.newest = entry;
+    if (!g_stat.oldest) g_stat.oldest = entry;
+}
+
+static void remove_locked(StatEntry *entry)
+{
+    StatEntry **link = &g_stat.buckets[entry->hash & (STAT_CACHE_BUCKETS - 1)];
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+
+    if (entry->newer) entry->newer->older = entry->older;
+    else g_stat.newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else g_stat.oldest = entry->newer;
+
+    g_stat.count--;
+    g_stat.bytes -= sizeof(StatEntry) + strlen(entry->path) + 1;
+    free(entry);
+}
+
+static void clear_locked(void)
+{
+    while (g_stat.oldest) {
+        remove_locked(g_stat.oldest);
+    }
+    g_stat.device_count = 0;
+    g_stat.generation++;
+}
+
+// Helper: The entry for a path, created if missing; NULL when out of memory (call with mutex held)
+static StatEntry *entry_locked(const char *path, size_t len, uint32_t hash)
+{
+    StatEntry *entry = find_locked(path, len, hash);
+    if (entry) {
+        touch_locked(entry);
+        return entry;
+    }
+
+    while (g_stat.count >= STAT_CACHE_MAX_ENTRIES && g_stat.oldest) {
+        remove_locked(g_stat.oldest);
+    }
+    entry = calloc(1, sizeof(StatEntry) + len + 1);
+    if (!entry) {
+        return NULL;
+    }
+    memcpy(entry->path, path, len);
+    entry->hash = hash;
+    StatEntry **bucket = &g_stat.buckets[hash & (STAT_CACHE_BUCKETS - 1)];
+    entry->next = *bucket;
+    *bucket = entry;
+    g_stat.count++;
+    g_stat.bytes += sizeof(StatEntry) + len + 1;
+    touch_locked(entry);
+    return entry;
+}
+
+// Helper: Whether a device is a local volume, whose changes the stream sees; unknown
+// devices are looked up with statfs once
+static bool device_local(const char *path, dev_t dev)
+{
+    pthread_mutex_lock(&g_stat.mutex);
+    for (int i = 0; i < g_stat.device_count; i++) {
+        if (g_stat.devices[i].dev == dev) {
+            bool local = g_stat.devices[i].local;
+            pthread_mutex_unlock(&g_stat.mutex);
+            return local;
+        }
+    }
+    pthread_mutex_unlock(&g_stat.mutex);
+
+#ifdef __APPLE__
+    struct statfs fs;
+    bool local = statfs(path, &fs) == 0 && (fs.f_flags & MNT_LOCAL);
+#else
+    (void)path;
+    bool local = true;
+#endif
+
+    pthread_mutex_lock(&g_stat.mutex);
+    if (g_stat.device_count < STAT_CACHE_MAX_DEVICES) {
+        g_stat.devices[g_stat.device_count++] = (DeviceInfo){ dev, local };
+    }
+    pthread_mutex_unlock(&g_stat.mutex);
+    return local;
+}
+
+// Helper: Whether the directory holding path is its own real path (checked once per directory)
+static bool parent_canonical(const char *path)
+{
+    size_t len = (size_t)(strrchr(path, '/') - path);
+    if (len == 0) {
+        return true;
+    }
+    uint32_t hash = hash_fnv1a_bytes(HASH_FNV1A_INIT, path, len);
+
+    pthread_mutex_lock(&g_stat.mutex);
+    if (g_stat.users == 0) {
+        pthread_mutex_unlock(&g_stat.mutex);
+        return false;
+    }
+    StatEntry *entry = find_locked(path, len, hash);
+    if (entry && (entry->flags & ENTRY_DIR_CHECKED)) {
+        bool canonical = (entry->flags & ENTRY_DIR_CANONICAL) != 0;
+        pthread_mutex_unlock(&g_stat.mutex);
+        return canonical;
+    }
+    uint64_t generation = g_stat.generation;
+    pthread_mutex_unlock(&g_stat.mutex);
+
+    char dir[PATH_MAX];
+    char real[PATH_MAX];
+    if (len >= sizeof(dir)) {
+        return false;
+    }
+    memcpy(dir, path, len);
+    dir[len] = '\0';
+    bool canonical = realpath(dir, real) != NULL && strcmp(real, dir) == 0;
+
+    pthread_mutex_lock(&g_stat.mutex);
+    if (g_stat.users > 0 && g_stat.generation == generation) {
+        entry = entry_locked(path, len, hash);
+        if (entry) {
+            entry->flags |= ENTRY_DIR_CHECKED | (canonical ? ENTRY_DIR_CANONICAL : 0);
+        }
+    }
+    pthread_mutex_unlock(&g_stat.mutex);
+    return canonical;
+}
+
+bool stat_cache_lstat(const char *path, struct stat *st)
+{
+    if (!path || !st) {
+        errno = EINVAL;
+        return false;
+    }
+
+    size_t len = strlen(path);
+    uint32_t hash = hash_fnv1a_bytes(HASH_FNV1A_INIT, path, len);
+    pthread_mutex_lock(&g_stat.mutex);
+    if (g_stat.users == 0) {
+        pthread_mutex_unlock(&g_stat.mutex);
+        return lstat(path, st) == 0;
+    }
+    StatEntry *entry = find_locked(path, len, hash);
+    if (entry && (entry->flags & ENTRY_HAS_STAT)) {
+        touch_locked(entry);
+        *st = entry->st;
+        g_stat.hits++;
+        pthread_mutex_unlock(&g_stat.mutex);
+        return true;
+    }
+    g_stat.misses++;
+    uint64_t generation = g_stat.generation;
+    pthread_mutex_unlock(&g_stat.mutex);
+
+    // Anything reported while the syscall runs may make its result stale: the
+    // generation check then keeps it out
+    if (lstat(path, st) != 0) {
+        return false;
+    }
+    if (!cacheable(path) || !device_local(path, st->st_dev) || !parent_canonical(path)) {
+        return true;
+    }
+
+    pthread_mutex_lock(&g_stat.mutex);
+    if (g_stat.users > 0 && g_stat.generation == generation) {
+        entry = entry_locked(path, len, hash);
+        if (entry) {
+            entry->st = *st;
+            entry->flags |= ENTRY_HAS_STAT;
+        }
+    }
+    pthread_mutex_unlock(&g_stat.mutex);
+    return true;
+}
+
+bool stat_cache_stat(const char *path, struct stat *st)
+{
+    // A symlink's target can change without an event naming the link
+    if (!stat_cache_lstat(path, st)) {
+        return false;
+    }
+    return !S_ISLNK(st->st_mode) || stat(path, st) == 0;
+}
+
+void stat_cache_invalidate(const char *path, bool subtree)
+{
+    if (!path) {
+        return;
+    }
+
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') {
+        len--;
+    }
+
+    pthread_mutex_lock(&g_stat.mutex);
+    g_stat.generation++;
+    if (g_stat.count == 0) {
+        pthread_mutex_unlock(&g_stat.mutex);
+        return;
+    }
+    if (subtree && len == 1) {
+        clear_locked();
+        pthread_mutex_unlock(&g_stat.mutex);
+        return;
+    }
+
+    // A directory stays its own real path until it or a parent moves, which comes
+    // as a subtree invalidation
+    StatEntry *entry = find_locked(path, len, hash_fnv1a_bytes(HASH_FNV1A_INIT, path, len));
+    if (entry) {
+        entry->flags &= ~ENTRY_HAS_STAT;
+        if (subtree || entry->flags == 0) {
+            remove_locked(entry);
+        }
+    }
+    if (subtree) {
+        StatEntry *next;
+        for (entry = g_stat.oldest; entry; entry = next) {
+            next = entry->newer;
+            if (strncmp(entry->path, path, len) == 0 && entry->path[len] == '/') {
+                remove_locked(entry);
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_stat.mutex);
+}
+
+void stat_cache_begin(void)
+{
+    pthread_mutex_lock(&g_stat.mutex);
+    if (g_stat.users == 0 && !g_stat.buckets) {
+        g_stat.buckets = calloc(STAT_CACHE_BUCKETS, sizeof(StatEntry *));
+    }
+    if (g_stat.buckets) {
+        g_stat.users++;
+    }
+    pthread_mutex_unlock(&g_stat.mutex);
+}
+
+void stat_cache_end(void)
+{
+    pthread_mutex_lock(&g_stat.mutex);
+    if (g_stat.users > 0 && --g_stat.users == 0) {
+        clear_locked();
+        free(g_stat.buckets);
+        g_stat.buckets = NULL;
+    }
+    pthread_mutex_unlock(&g_stat.mutex);
+}
+
+void stat_cache_trim(size_t target)
+{
+    pthread_mutex_lock(&g_stat.mutex);
+    while (g_stat.bytes > target && g_stat.oldest) {
+        remove_locked(g_stat.oldest);
+    }
+    pthread_mutex_unlock(&g_stat.mutex);
+}
+
+size_t stat_cache_bytes(void)
+{
+    pthread_mutex_lock(&g_stat.mutex);
+    size_t bytes = g_stat.bytes;
+    pthread_mutex_unlock(&g_stat.mutex);
+    return bytes;
+}
+
+StatCacheStats stat_cache_get_stats(void)
+{
+    pthread_mutex_lock(&g_stat.mutex);
+    StatCacheStats stats = { g_stat.hits, g_stat.misses, g_stat.count, g_stat.bytes };
+    pthread_mutex_unlock(&g_stat.mutex);
+    return stats;
+}
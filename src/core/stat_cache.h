@@ -0,0 +1,47 @@
+#ifndef STAT_CACHE_H
+#define STAT_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+// Process-wide cache of lstat() results by path, shared by the listings, the indexers,
+// the duplicate finder, the organizer and the tools so each file is stat'ed once rather
+// than once per subsystem. It fills as they enumerate and only caches while a watch
+// stream reports every change (stat_cache_begin, done by fs_watch_start); changes are
+// dropped as soon as they are reported, before any subscriber sees them. Until then a
+// change made by another process can be seen up to the stream's latency late.
+//
+// Only paths on local volumes whose parent is their real path are cached, since events
+// name real paths; symlink targets and failed lookups are never cached. Thread-safe
+
+#define STAT_CACHE_MAX_ENTRIES 65536
+#define STAT_CACHE_BUCKETS 65536        // Power of two
+
+typedef struct StatCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    int entries;
+    size_t bytes;
+} StatCacheStats;
+
+// lstat() and stat(), answered from the cache when possible; false (errno set) on failure
+bool stat_cache_lstat(const char *path, struct stat *st);
+bool stat_cache_stat(const char *path, struct stat *st);
+
+// Drop a path, and everything below it if subtree
+void stat_cache_invalidate(const char *path, bool subtree);
+
+// Start caching, for a stream that reports changes through stat_cache_invalidate;
+// counted, and the last stat_cache_end empties the cache
+void stat_cache_begin(void);
+void stat_cache_end(void);
+
+// Shrink to at most target bytes, least recently used first
+void stat_cache_trim(size_t target);
+
+size_t stat_cache_bytes(void);
+StatCacheStats stat_cache_get_stats(void);
+
+#endif // STAT_CACHE_H
@@ -0,0 +1,359 @@
+#include "text_map.h"
+#include "../utils/jobs.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// An indexed line: its number and where it starts
+typedef struct TextMapCheckpoint {
+    int line;
+    size_t offset;
+} TextMapCheckpoint;
+
+struct TextMap {
+    const char *data;
+    size_t size;
+    bool mapped;                        // data is an mmap (else borrowed, or the empty string)
+
+    JobToken *job;                      // Stops and waits out the indexing job
+
+    // Index, filled by the job (guarded by mutex)
+    pthread_mutex_t mutex;
+    TextMapCheckpoint *checkpoints;     // Ascending; the first is line 0 at offset 0
+    int checkpoint_count;
+    int checkpoint_capacity;
+    int line_count;
+    size_t scanned;                     // Bytes indexed so far
+    bool complete;
+
+    // Last line found by text_map_line (reader only)
+    int cursor_line;
+    size_t cursor_offset;
+};
+
+// Helper: Append checkpoints (call with mutex held); false when out of memory
+static bool append_checkpoints(TextMap *map, const TextMapCheckpoint *found, int count)
+{
+    if (map->checkpoint_count + count > map->checkpoint_capacity) {
+        int capacity = map->checkpoint_capacity ? map->checkpoint_capacity : 256;
+        while (capacity < map->checkpoint_count + count) {
+            capacity *= 2;
+        }
+        TextMapCheckpoint *grown = realloc(map->checkpoints, (size_t)capacity * sizeof(TextMapCheckpoint));
+        if (!grown) {
+            return false;
+        }
+        map->checkpoints = grown;
+        map->checkpoint_capacity = capacity;
+    }
+    memcpy(&map->checkpoints[map->checkpoint_count], found, (size_t)count * sizeof(TextMapCheckpoint));
+    map->checkpoint_count += count;
+    return true;
+}
+
+// Job: Scan the file chunk by chunk, publishing the index after each
+static void index_job(void *arg, JobToken *token)
+{
+    TextMap *map = arg;
+
+    TextMapCheckpoint *found = NULL;
+    int found_capacity = 0;
+
+    int line = 0;
+    size_t last_checkpoint = 0;
+    size_t offset = 0;
+    bool ok = true;
+
+    while (ok && offset < map->size && !job_token_cancelled(token)) {
+        size_t chunk_end = map->size - offset > TEXT_MAP_CHUNK ? offset + TEXT_MAP_CHUNK : map->size;
+        int found_count = 0;
+
+        const char *p = map->data + offset;
+        const char *end = map->data + chunk_end;
+        while (p < end && (p = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+            p++;
+            if (line == INT_MAX - 1) {
+                ok = false;             // Too many lines to count; show those found
+                break;
+            }
+            line++;
+
+            size_t start = (size_t)(p - map->data);
+            if (line % TEXT_MAP_STRIDE == 0 || start - last_checkpoint >= TEXT_MAP_CHECKPOINT_BYTES) {
+                if (found_count == found_capacity) {
+                    int capacity = found_capacity ? found_capacity * 2 : 256;
+                    TextMapCheckpoint *grown = realloc(found, (size_t)capacity * sizeof(TextMapCheckpoint));
+                    if (!grown) {
+                        ok = false;
+                        break;
+                    }
+                    found = grown;
+                    found_capacity = capacity;
+                }
+                found[found_count].line = line;
+                found[found_count].offset = start;
+                found_count++;
+                last_checkpoint = start;
+            }
+        }
+        offset = chunk_end;
+
+        pthread_mutex_lock(&map->mutex);
+        if (!append_checkpoints(map, found, found_count)) {
+            ok = false;
+        }
+        map->line_count = line + 1;
+        map->scanned = offset;
+        pthread_mutex_unlock(&map->mutex);
+    }
+
+    pthread_mutex_lock(&map->mutex);
+    map->complete = true;
+    pthread_mutex_unlock(&map->mutex);
+
+    free(found);
+}
+
+// Helper: Index data, mapped or borrowed, in the background (NULL when out of memory)
+static TextMap* text_map_start(const char *data, size_t size, bool mapped)
+{
+    TextMap *map = calloc(1, sizeof(TextMap));
+    if (!map) {
+        return NULL;
+    }
+    pthread_mutex_init(&map->mutex, NULL);
+    map->data = data;
+    map->size = size;
+    map->mapped = mapped;
+
+    TextMapCheckpoint first = { 0, 0 };
+    append_checkpoints(map, &first, 1);
+    map->line_count = 1;
+
+    if (map->size == 0) {
+        map->complete = true;
+    } else {
+        // Without workers (or a token) this indexes now
+        map->job = job_token_create();
+        jobs_submit(JOB_QOS_USER_INITIATED, index_job, NULL, map, map->job);
+    }
+    return map;
+}
+
+TextMap* text_map_open(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return NULL;
+    }
+
+    const char *data = "";
+    size_t size = (size_t)st.st_size;
+    if (size > 0) {
+        void *mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            return NULL;
+        }
+        data = mapped;
+    }
+    close(fd);
+
+    TextMap *map = text_map_start(data, size, size > 0);
+    if (!map && size > 0) {
+        munmap((void *)data, size);
+    }
+    return map;
+}
+
+TextMap* text_map_open_memory(const char *data, size_t size)
+{
+    return text_map_start(data ? data : "", data ? size : 0, false);
+}
+
+void text_map_close(TextMap *map)
+{
+    if (!map) {
+        return;
+    }
+
+    if (map->job) {
+        job_token_cancel(map->job);
+        job_token_wait(map->job);
+        job_token_release(map->job);
+    }
+    if (map->mapped) {
+        munmap((void *)map->data, map->size);
+    }
+    pthread_mutex_destroy(&map->mutex);
+    free(map->checkpoints);
+    free(map);
+}
+
+const char* text_map_data(const TextMap *map)
+{
+    return map ? map->data : "";
+}
+
+size_t text_map_size(const TextMap *map)
+{
+    return map ? map->size : 0;
+}
+
+int text_map_line_count(TextMap *map, bool *complete)
+{
+    if (!map) {
+        if (complete) *complete = true;
+        return 0;
+    }
+
+    pthread_mutex_lock(&map->mutex);
+    int count = map->line_count;
+    if (complete) *complete = map->complete;
+    pthread_mutex_unlock(&map->mutex);
+    return count;
+}
+
+bool text_map_line(TextMap *map, int line, const char **start, size_t *len, size_t max_len)
+{
+    if (!map || line < 0) {
+        return false;
+    }
+
+    // Nearest indexed line at or before the one wanted
+    pthread_mutex_lock(&map->mutex);
+    if (line >= map->line_count) {
+        pthread_mutex_unlock(&map->mutex);
+        return false;
+    }
+    int lo = 0, hi = map->checkpoint_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (map->checkpoints[mid].line <= line) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    TextMapCheckpoint from = map->checkpoints[lo];
+    pthread_mutex_unlock(&map->mutex);
+
+    // The last line found may be closer
+    if (map->cursor_line <= line && map->cursor_line > from.line) {
+        from.line = map->cursor_line;
+        from.offset = map->cursor_offset;
+    }
+
+    size_t offset = from.offset;
+    for (int i = from.line; i < line; i++) {
+        const char *newline = memchr(map->data + offset, '\n', map->size - offset);
+        if (!newline) {
+            return false;
+        }
+        offset = (size_t)(newline - map->data) + 1;
+    }
+    map->cursor_line = line;
+    map->cursor_offset = offset;
+
+    size_t available = map->size - offset;
+    if (available > max_len) {
+        available = max_len;
+    }
+    const char *newline = memchr(map->data + offset, '\n', available);
+    *start = map->data + offset;
+    *len = newline ? (size_t)(newline - *start) : available;
+    return true;
+}
+
+// Helper: Start of the line holding offset
+static size_t line_start(const TextMap *map, size_t offset)
+{
+    while (offset > 0 && map->data[offset - 1] != '\n') {
+        offset--;
+    }
+    return offset;
+}
+
+size_t text_map_step(const TextMap *map, size_t offset, int lines)
+{
+    if (!map || map->size == 0) {
+        return 0;
+    }
+    if (offset > map->size) {
+        offset = map->size;
+    }
+
+    offset = line_start(map, offset);
+    for (; lines > 0; lines--) {
+        const char *newline = memchr(map->data + offset, '\n', map->size - offset);
+        if (!newline) {
+            break;
+        }
+        offset = (size_t)(newline - map->data) + 1;
+    }
+    for (; lines < 0 && offset > 0; lines++) {
+        offset = line_start(map, offset - 1);
+    }
+    return offset;
+}
+
+int text_map_line_at(TextMap *map, size_t offset, bool *exact)
+{
+    if (!map) {
+        if (exact) *exact = true;
+        return 0;
+    }
+    if (offset > map->size) {
+        offset = map->size;
+    }
+
+    pthread_mutex_lock(&map->mutex);
+    bool indexed = map->complete || offset < map->scanned;
+    if (!indexed) {
+        // Past the scan: newlines so far, plus the rest at the rate seen so far
+        int line = map->line_count - 1;
+        if (map->scanned > 0) {
+            double per_byte = (double)line / (double)map->scanned;
+            double estimate = line + per_byte * (double)(offset - map->scanned);
+            line = estimate < INT_MAX - 1 ? (int)estimate : INT_MAX - 1;
+        }
+        pthread_mutex_unlock(&map->mutex);
+        if (exact) *exact = false;
+        return line;
+    }
+
+    int lo = 0, hi = map->checkpoint_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (map->checkpoints[mid].offset <= offset) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    TextMapCheckpoint from = map->checkpoints[lo];
+    pthread_mutex_unlock(&map->mutex);
+
+    // Count the newlines from the indexed line; at most a stride or checkpoint apart
+    int line = from.line;
+    const char *p = map->data + from.offset;
+    const char *end = map->data + offset;
+    while (p < end && (p = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+        p++;
+        line++;
+    }
+    if (exact) *exact = true;
+    return line;
+}
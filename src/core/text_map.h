@@ -0,0 +1,54 @@
+#ifndef TEXT_MAP_H
+#define TEXT_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// A text file mapped into memory for previewing, so opening one costs the same at any
+// size. A background job scans it for newlines in chunks (memchr, which libc
+// vectorizes) and keeps a sparse index: the offset of every TEXT_MAP_STRIDE-th line,
+// and of the first line to start TEXT_MAP_CHECKPOINT_BYTES past the last one. Looking
+// up a line scans forward from the nearest indexed one, so the index stays small and
+// only the lines on screen are ever read. Views that must not wait for the index (the
+// file view modal) scroll by byte offset with text_map_step instead, and number lines
+// with text_map_line_at, which estimates past the part indexed so far
+
+#define TEXT_MAP_STRIDE 64                      // Lines between indexed lines
+#define TEXT_MAP_CHECKPOINT_BYTES (64 * 1024)   // Bytes between indexed lines, at most
+#define TEXT_MAP_CHUNK (1024 * 1024)            // Bytes scanned between index updates
+
+// Mapped text file (opaque)
+typedef struct TextMap TextMap;
+
+// Map a file and start indexing it; NULL if it cannot be opened or mapped
+TextMap* text_map_open(const char *path);
+
+// Index text already in memory (which must outlive the map), as text_map_open would a
+// file; NULL when out of memory
+TextMap* text_map_open_memory(const char *data, size_t size);
+
+// Stop indexing, unmap and free
+void text_map_close(TextMap *map);
+
+// The file's bytes (not NUL-terminated) and size
+const char* text_map_data(const TextMap *map);
+size_t text_map_size(const TextMap *map);
+
+// Lines found so far (newlines + 1, like a line count of the text); *complete is set
+// once the whole file has been scanned
+int text_map_line_count(TextMap *map, bool *complete);
+
+// Locate a line: *start its first byte and *len its length up to max_len bytes (without
+// the newline). False past the lines found so far. Lookups remember the last line found,
+// so stepping through consecutive lines is cheap; use from one thread
+bool text_map_line(TextMap *map, int line, const char **start, size_t *len, size_t max_len);
+
+// Offset of the start of the line lines away (negative for earlier ones) from the line
+// holding offset, stopping at the first and last line. Needs no index
+size_t text_map_step(const TextMap *map, size_t offset, int lines);
+
+// Line holding offset: counted from the index where it has been scanned (*exact set),
+// else estimated from the average line length so far
+int text_map_line_at(TextMap *map, size_t offset, bool *exact);
+
+#endif // TEXT_MAP_H
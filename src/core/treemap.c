@@ -0,0 +1,622 @@
+#include "treemap.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Compact record of one file or folder read for the map
+typedef struct UsageNode {
+    off_t size;
+    off_t base;                         // Bytes known from the listing (folded files)
+    int32_t parent;
+    int32_t first_child;                // Children are contiguous
+    int32_t child_count;
+    uint32_t name;                      // Offset into the tree's names
+    uint8_t depth;                      // 0 for the root
+    uint8_t kind;                       // TreemapKind
+} UsageNode;
+
+// The folder as read, a few levels deep; only the worker touches it
+typedef struct UsageTree {
+    UsageNode *nodes;
+    int count;
+    int capacity;
+    char *names;
+    size_t names_used;
+    size_t names_capacity;
+    char root[PATH_MAX];                // Empty until a read completes
+} UsageTree;
+
+// One published layout
+typedef struct TreemapLayout {
+    TreemapRect *rects;
+    int count;
+    int capacity;
+    char *names;
+    size_t names_used;
+    size_t names_capacity;
+    char root[PATH_MAX];
+    off_t total;
+    bool partial;
+} TreemapLayout;
+
+// An entry of a directory being read
+typedef struct ListedEntry {
+    char *name;
+    off_t size;
+    bool is_dir;
+} ListedEntry;
+
+// A child to place, by size
+typedef struct SizedChild {
+    off_t size;
+    int node;
+} SizedChild;
+
+// Area being filled
+typedef struct Box {
+    double x, y, width, height;
+} Box;
+
+struct Treemap {
+    DirSizes *sizes;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;                // New request, or stopping
+    atomic_bool stopping;
+
+    // Guarded by mutex
+    atomic_uint requested;              // Read by the worker to abandon a stale read
+    uint32_t started;
+    bool working;
+    char request_root[PATH_MAX];
+    int request_width;
+    int request_height;
+    bool rescan;
+    TreemapLayout *ready;               // Finished, not yet polled
+
+    UsageTree tree;                     // Worker only
+    TreemapLayout *current;             // Main thread only
+};
+
+//=============================================================================
+// Name arenas
+//=============================================================================
+
+// Helper: Append a string to a growing arena; returns its offset, UINT32_MAX on failure
+static uint32_t arena_add(char **arena, size_t *used, size_t *capacity, const char *text)
+{
+    size_t len = strlen(text) + 1;
+    if (*used + len > *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 4096;
+        while (grown < *used + len) grown *= 2;
+        char *names = realloc(*arena, grown);
+        if (!names) return UINT32_MAX;
+        *arena = names;
+        *capacity = grown;
+    }
+    uint32_t offset = (uint32_t)*used;
+    memcpy(*arena + *used, text, len);
+    *used += len;
+    return offset;
+}
+
+// Helper: Join a root and the names below it into path
+static bool join_path(char *path, size_t path_size, const char *root, const char **names, int count)
+{
+    size_t len = strlen(root);
+    if (len >= path_size) return false;
+    memcpy(path, root, len + 1);
+    for (int i = count - 1; i >= 0; i--) {
+        bool slash = len == 0 || path[len - 1] != '/';
+        int written = snprintf(path + len, path_size - len, "%s%s", slash ? "/" : "", names[i]);
+        if (written < 0 || (size_t)written >= path_size - len) return false;
+        len += written;
+    }
+    return true;
+}
+
+//=============================================================================
+// Reading the tree (worker)
+//=============================================================================
+
+static int tree_add(UsageTree *tree, const char *name, int parent, TreemapKind kind, off_t size)
+{
+    if (tree->count == tree->capacity) {
+        int capacity = tree->capacity ? tree->capacity * 2 : 256;
+        UsageNode *nodes = realloc(tree->nodes, capacity * sizeof(UsageNode));
+        if (!nodes) return -1;
+        tree->nodes = nodes;
+        tree->capacity = capacity;
+    }
+    uint32_t offset = arena_add(&tree->names, &tree->names_used, &tree->names_capacity, name);
+    if (offset == UINT32_MAX) return -1;
+
+    UsageNode *node = &tree->nodes[tree->count];
+    memset(node, 0, sizeof(*node));
+    node->size = size;
+    node->base = size;
+    node->parent = parent;
+    node->first_child = -1;
+    node->name = offset;
+    node->depth = parent >= 0 ? tree->nodes[parent].depth + 1 : 0;
+    node->kind = (uint8_t)kind;
+    return tree->count++;
+}
+
+static bool tree_node_path(const UsageTree *tree, const char *root, int index, char *path, size_t path_size)
+{
+    const char *names[TREEMAP_DEPTH + 1];
+    int count = 0;
+    for (int i = index; i > 0 && count <= TREEMAP_DEPTH; i = tree->nodes[i].parent) {
+        names[count++] = tree->names + tree->nodes[i].name;
+    }
+    return join_path(path, path_size, root, names, count);
+}
+
+static int compare_listed_size(const void *a, const void *b)
+{
+    off_t sa = ((const ListedEntry *)a)->size;
+    off_t sb = ((const ListedEntry *)b)->size;
+    return (sa < sb) - (sa > sb);
+}
+
+// Helper: Read one directory into children of node: every subdirectory up to
+// TREEMAP_MAX_DIRS, the largest TREEMAP_MAX_FILES files, and one node for the rest
+static bool tree_read_dir(UsageTree *tree, int node, const char *path)
+{
+    DIR *dir = opendir(path);
+    if (!dir) return true;  // Unreadable: shown without contents
+
+    ListedEntry *entries = NULL;
+    int count = 0, capacity = 0;
+    bool ok = true;
+    int fd = dirfd(dir);
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        const char *name = ent->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+
+        struct stat st;
+        if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            ListedEntry *grown = realloc(entries, capacity * sizeof(ListedEntry));
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            entries = grown;
+        }
+        entries[count].name = strdup(name);
+        if (!entries[count].name) {
+            ok = false;
+            break;
+        }
+        entries[count].is_dir = S_ISDIR(st.st_mode);
+        entries[count].size = entries[count].is_dir ? 0 : st.st_size;
+        count++;
+    }
+    closedir(dir);
+
+    // Largest files first; folders keep listing order (their sizes come later)
+    qsort(entries, count, sizeof(ListedEntry), compare_listed_size);
+
+    int first = tree->count;
+    int dirs = 0, files = 0, folded = 0;
+    off_t folded_bytes = 0;
+    for (int i = 0; ok && i < count; i++) {
+        ListedEntry *entry = &entries[i];
+        bool keep = entry->is_dir ? dirs < TREEMAP_MAX_DIRS : files < TREEMAP_MAX_FILES;
+        if (!keep) {
+            folded++;
+            folded_bytes += entry->size;
+            continue;
+        }
+        if (entry->is_dir) dirs++; else files++;
+        ok = tree_add(tree, entry->name, node, entry->is_dir ? TREEMAP_DIR : TREEMAP_FILE, entry->size) >= 0;
+    }
+    if (ok && folded > 0) {
+        // Folded folders are measured through the parent's rollup
+        char label[64];
+        snprintf(label, sizeof(label), "%d more items", folded);
+        ok = tree_add(tree, label, node, TREEMAP_OTHER, folded_bytes) >= 0;
+    }
+    if (tree->count > first) {
+        tree->nodes[node].first_child = first;
+        tree->nodes[node].child_count = tree->count - first;
+    }
+
+    for (int i = 0; i < count; i++) {
+        free(entries[i].name);
+    }
+    free(entries);
+    return ok;
+}
+
+// Helper: Read root TREEMAP_DEPTH levels deep, breadth first so every node's children
+// are contiguous. False if a newer request or shutdown cut it short
+static bool tree_read(Treemap *map, const char *root, uint32_t generation)
+{
+    UsageTree *tree = &map->tree;
+    tree->count = 0;
+    tree->names_used = 0;
+    tree->root[0] = '\0';
+    if (tree_add(tree, "", -1, TREEMAP_DIR, 0) < 0) return false;
+
+    char path[PATH_MAX];
+    for (int i = 0; i < tree->count && tree->count < TREEMAP_MAX_NODES; i++) {
+        if (atomic_load(&map->stopping) || atomic_load(&map->requested) != generation) {
+            return false;
+        }
+        if (tree->nodes[i].kind != TREEMAP_DIR || tree->nodes[i].depth >= TREEMAP_DEPTH) continue;
+        if (!tree_node_path(tree, root, i, path, sizeof(path))) continue;
+        if (!tree_read_dir(tree, i, path)) break;
+    }
+
+    strncpy(tree->root, root, sizeof(tree->root) - 1);
+    tree->root[sizeof(tree->root) - 1] = '\0';
+    return true;
+}
+
+// Helper: Size every folder from the rollup cache, children before their parents.
+// Asking for the root's size starts the count of the whole tree. True if any folder
+// has not been counted yet
+static bool tree_refresh(Treemap *map)
+{
+    UsageTree *tree = &map->tree;
+    bool partial = false;
+    char path[PATH_MAX];
+
+    for (int i = tree->count - 1; i >= 0; i--) {
+        UsageNode *node = &tree->nodes[i];
+        if (node->kind != TREEMAP_DIR) {
+            node->size = node->base;
+            continue;
+        }
+
+        off_t children = 0;
+        int other = -1;
+        for (int c = node->first_child; c >= 0 && c < node->first_child + node->child_count; c++) {
+            children += tree->nodes[c].size;
+            if (tree->nodes[c].kind == TREEMAP_OTHER) other = c;
+        }
+
+        off_t rollup = 0;
+        bool known = false;
+        if (tree_node_path(tree, tree->root, i, path, sizeof(path))) {
+            known = i == 0 ? dir_sizes_query(map->sizes, path, &rollup)
+                           : dir_sizes_peek(map->sizes, path, &rollup);
+        }
+        if (!known) {
+            partial = true;
+            node->size = children;
+        } else {
+            // Whatever the kept children do not explain belongs to the folded ones
+            if (other >= 0 && rollup > children) {
+                tree->nodes[other].size += rollup - children;
+                children = rollup;
+            }
+            node->size = rollup > children ? rollup : children;
+        }
+    }
+    return partial;
+}
+
+//=============================================================================
+// Squarified layout (worker)
+//=============================================================================
+
+static int compare_child_size(const void *a, const void *b)
+{
+    off_t sa = ((const SizedChild *)a)->size;
+    off_t sb = ((const SizedChild *)b)->size;
+    return (sa < sb) - (sa > sb);
+}
+
+static void layout_children(TreemapLayout *layout, const UsageTree *tree, int node, Box box, int parent);
+
+// Helper: Add the rectangle of one node, then lay out its children inside it
+static void layout_emit(TreemapLayout *layout, const UsageTree *tree, int node, Box box, int parent)
+{
+    if (box.width < 1.0 || box.height < 1.0 || layout->count >= TREEMAP_MAX_RECTS) return;
+
+    if (layout->count == layout->capacity) {
+        int capacity = layout->capacity ? layout->capacity * 2 : 256;
+        TreemapRect *rects = realloc(layout->rects, capacity * sizeof(TreemapRect));
+        if (!rects) return;
+        layout->rects = rects;
+        layout->capacity = capacity;
+    }
+    const UsageNode *n = &tree->nodes[node];
+    uint32_t name = arena_add(&layout->names, &layout->names_used, &layout->names_capacity,
+                              tree->names + n->name);
+    if (name == UINT32_MAX) return;
+
+    int index = layout->count++;
+    layout->rects[index] = (TreemapRect){
+        .x = (float)box.x, .y = (float)box.y,
+        .width = (float)box.width, .height = (float)box.height,
+        .size = n->size,
+        .parent = parent,
+        .name = name,
+        .depth = (uint8_t)(n->depth - 1),
+        .kind = n->kind,
+    };
+
+    if (n->kind == TREEMAP_DIR && n->child_count > 0 &&
+        box.width >= TREEMAP_MIN_NEST && box.height >= TREEMAP_MIN_NEST) {
+        Box inner = { box.x + 2, box.y + TREEMAP_HEADER, box.width - 4, box.height - TREEMAP_HEADER - 2 };
+        layout_children(layout, tree, node, inner, index);
+    }
+}
+
+// Helper: Squarify the children of node into box: rows are filled along the shorter
+// side while adding an item keeps the row's worst aspect ratio from growing
+static void layout_children(TreemapLayout *layout, const UsageTree *tree, int node, Box box, int parent)
+{
+    const UsageNode *n = &tree->nodes[node];
+    SizedChild *items = malloc(n->child_count * sizeof(SizedChild));
+    if (!items) return;
+
+    int count = 0;
+    double sum = 0;
+    for (int c = n->first_child; c < n->first_child + n->child_count; c++) {
+        if (tree->nodes[c].size <= 0) continue;
+        items[count++] = (SizedChild){ tree->nodes[c].size, c };
+        sum += (double)tree->nodes[c].size;
+    }
+    if (count == 0 || box.width <= 0 || box.height <= 0) {
+        free(items);
+        return;
+    }
+    qsort(items, count, sizeof(SizedChild), compare_child_size);
+
+    // The children fill the box even while some of the parent is uncounted
+    double scale = box.width * box.height / sum;
+    int start = 0;
+    while (start < count) {
+        double side = box.width < box.height ? box.width : box.height;
+        double largest = items[start].size * scale;
+        double row_area = 0;
+        double worst = 0;
+        int end = start;
+        while (end < count) {
+            double area = items[end].size * scale;
+            double total = row_area + area;
+            double a = side * side * largest / (total * total);
+            double b = total * total / (side * side * area);
+            double ratio = a > b ? a : b;
+            if (end > start && ratio > worst) break;
+            worst = ratio;
+            row_area = total;
+            end++;
+        }
+
+        double thickness = row_area / side;
+        double offset = 0;
+        for (int i = start; i < end; i++) {
+            double length = items[i].size * scale / thickness;
+            Box cell = box.width >= box.height
+                ? (Box){ box.x, box.y + offset, thickness, length }
+                : (Box){ box.x + offset, box.y, length, thickness };
+            offset += length;
+            layout_emit(layout, tree, items[i].node, cell, parent);
+        }
+        if (box.width >= box.height) {
+            box.x += thickness;
+            box.width -= thickness;
+        } else {
+            box.y += thickness;
+            box.height -= thickness;
+        }
+        start = end;
+    }
+    free(items);
+}
+
+static void layout_free(TreemapLayout *layout)
+{
+    if (!layout) return;
+    free(layout->rects);
+    free(layout->names);
+    free(layout);
+}
+
+static TreemapLayout *layout_build(Treemap *map, int width, int height)
+{
+    TreemapLayout *layout = calloc(1, sizeof(TreemapLayout));
+    if (!layout) return NULL;
+
+    const UsageTree *tree = &map->tree;
+    layout->partial = tree_refresh(map);
+    layout->total = tree->count > 0 ? tree->nodes[0].size : 0;
+    memcpy(layout->root, tree->root, sizeof(layout->root));
+    if (tree->count > 0) {
+        layout_children(layout, tree, 0, (Box){ 0, 0, width, height }, -1);
+    }
+    return layout;
+}
+
+// Thread function: Read the requested folder and lay it out
+static void *treemap_thread(void *arg)
+{
+    Treemap *map = arg;
+
+    pthread_mutex_lock(&map->mutex);
+    while (!atomic_load(&map->stopping)) {
+        uint32_t generation = atomic_load(&map->requested);
+        if (map->started == generation) {
+            pthread_cond_wait(&map->cond, &map->mutex);
+            continue;
+        }
+        map->started = generation;
+        map->working = true;
+        char root[PATH_MAX];
+        memcpy(root, map->request_root, sizeof(root));
+        int width = map->request_width;
+        int height = map->request_height;
+        bool rescan = map->rescan;
+        map->rescan = false;
+        pthread_mutex_unlock(&map->mutex);
+
+        bool read = !rescan && map->tree.root[0] != '\0' && strcmp(map->tree.root, root) == 0;
+        if (!read) {
+            read = tree_read(map, root, generation);
+        }
+        TreemapLayout *layout = read ? layout_build(map, width, height) : NULL;
+
+        pthread_mutex_lock(&map->mutex);
+        map->working = false;
+        if (layout && generation == atomic_load(&map->requested)) {
+            layout_free(map->ready);
+            map->ready = layout;
+        } else {
+            layout_free(layout);
+        }
+    }
+    pthread_mutex_unlock(&map->mutex);
+    return NULL;
+}
+
+//=============================================================================
+// Public API
+//=============================================================================
+
+Treemap *treemap_create(DirSizes *sizes)
+{
+    Treemap *map = calloc(1, sizeof(Treemap));
+    if (!map) return NULL;
+
+    map->sizes = sizes;
+    atomic_init(&map->stopping, false);
+    atomic_init(&map->requested, 0);
+    pthread_mutex_init(&map->mutex, NULL);
+    pthread_cond_init(&map->cond, NULL);
+    if (pthread_create(&map->thread, NULL, treemap_thread, map) != 0) {
+        pthread_cond_destroy(&map->cond);
+        pthread_mutex_destroy(&map->mutex);
+        free(map);
+        return NULL;
+    }
+    return map;
+}
+
+void treemap_destroy(Treemap *map)
+{
+    if (!map) return;
+
+    pthread_mutex_lock(&map->mutex);
+    atomic_store(&map->stopping, true);
+    pthread_cond_signal(&map->cond);
+    pthread_mutex_unlock(&map->mutex);
+    pthread_join(map->thread, NULL);
+
+    layout_free(map->ready);
+    layout_free(map->current);
+    free(map->tree.nodes);
+    free(map->tree.names);
+    pthread_cond_destroy(&map->cond);
+    pthread_mutex_destroy(&map->mutex);
+    free(map);
+}
+
+void treemap_request(Treemap *map, const char *root, int width, int height)
+{
+    if (!map || !root || width <= 0 || height <= 0) return;
+
+    pthread_mutex_lock(&map->mutex);
+    strncpy(map->request_root, root, sizeof(map->request_root) - 1);
+    map->request_root[sizeof(map->request_root) - 1] = '\0';
+    map->request_width = width;
+    map->request_height = height;
+    atomic_fetch_add(&map->requested, 1);
+    pthread_cond_signal(&map->cond);
+    pthread_mutex_unlock(&map->mutex);
+}
+
+void treemap_rescan(Treemap *map)
+{
+    if (!map) return;
+
+    pthread_mutex_lock(&map->mutex);
+    map->rescan = true;
+    pthread_mutex_unlock(&map->mutex);
+}
+
+bool treemap_poll(Treemap *map)
+{
+    if (!map) return false;
+
+    pthread_mutex_lock(&map->mutex);
+    TreemapLayout *layout = map->ready;
+    map->ready = NULL;
+    pthread_mutex_unlock(&map->mutex);
+
+    if (!layout) return false;
+    layout_free(map->current);
+    map->current = layout;
+    return true;
+}
+
+const TreemapRect *treemap_rects(const Treemap *map, int *count)
+{
+    if (!map || !map->current) {
+        *count = 0;
+        return NULL;
+    }
+    *count = map->current->count;
+    return map->current->rects;
+}
+
+const char *treemap_rect_name(const Treemap *map, int index)
+{
+    if (!map || !map->current || index < 0 || index >= map->current->count) return "";
+    return map->current->names + map->current->rects[index].name;
+}
+
+bool treemap_rect_path(const Treemap *map, int index, char *path, size_t path_size)
+{
+    if (!map || !map->current || index < 0 || index >= map->current->count) return false;
+    const TreemapLayout *layout = map->current;
+    if (layout->rects[index].kind == TREEMAP_OTHER) return false;
+
+    const char *names[TREEMAP_DEPTH];
+    int count = 0;
+    for (int i = index; i >= 0 && count < TREEMAP_DEPTH; i = layout->rects[i].parent) {
+        names[count++] = layout->names + layout->rects[i].name;
+    }
+    return join_path(path, path_size, layout->root, names, count);
+}
+
+const char *treemap_root(const Treemap *map)
+{
+    return map && map->current ? map->current->root : "";
+}
+
+off_t treemap_total(const Treemap *map)
+{
+    return map && map->current ? map->current->total : 0;
+}
+
+bool treemap_is_partial(const Treemap *map)
+{
+    return map && map->current && map->current->partial;
+}
+
+bool treemap_is_busy(Treemap *map)
+{
+    if (!map) return false;
+
+    pthread_mutex_lock(&map->mutex);
+    bool busy = map->working || map->started != atomic_load(&map->requested) || map->ready != NULL;
+    pthread_mutex_unlock(&map->mutex);
+    return busy;
+}
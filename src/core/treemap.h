@@ -0,0 +1,76 @@
+#ifndef TREEMAP_H
+#define TREEMAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "dir_size.h"
+
+// Disk usage treemap for a folder. A background thread reads the folder a few levels
+// deep into compact node records (each directory keeps its largest files and folds the
+// rest into one "more items" node, so a tree of millions of files costs a few thousand
+// records) and takes every folder's size from the shared rollup cache, so the map fills
+// in while the counts stream in. Each layout is squarified off the main thread and
+// published as a flat list of rectangles for the view to draw
+
+#define TREEMAP_DEPTH 3                 // Levels below the root that are laid out
+#define TREEMAP_MAX_FILES 64            // Largest files kept per directory
+#define TREEMAP_MAX_DIRS 256            // Subdirectories kept per directory
+#define TREEMAP_MAX_NODES 131072        // Records read before deeper folders stay closed
+#define TREEMAP_MAX_RECTS 16384
+#define TREEMAP_HEADER 16               // Label strip above a folder's contents
+#define TREEMAP_MIN_NEST 48             // Smallest folder side that shows its contents
+
+typedef enum TreemapKind {
+    TREEMAP_FILE,
+    TREEMAP_DIR,
+    TREEMAP_OTHER                       // Items too small or too many to show
+} TreemapKind;
+
+// One laid out rectangle, relative to the top left of the map
+typedef struct TreemapRect {
+    float x, y, width, height;
+    off_t size;
+    int parent;                         // Enclosing rectangle, -1 at the top level
+    uint32_t name;                      // Offset into the layout's names
+    uint8_t depth;                      // 0 for the root's own entries
+    uint8_t kind;                       // TreemapKind
+} TreemapRect;
+
+// Layout service (opaque)
+typedef struct Treemap Treemap;
+
+// Create the service and start its thread; sizes are read from (not owned); NULL on failure
+Treemap *treemap_create(DirSizes *sizes);
+
+// Stop the thread and free the service and its layouts
+void treemap_destroy(Treemap *map);
+
+// Lay out the folder at root in width x height, replacing any request in progress.
+// The folder is read again when root changes or after treemap_rescan
+void treemap_request(Treemap *map, const char *root, int width, int height);
+
+// Read the folder again on the next request (its contents changed)
+void treemap_rescan(Treemap *map);
+
+// Take the newest finished layout; true if the rectangles changed. Main thread
+bool treemap_poll(Treemap *map);
+
+// Rectangles of the current layout, parents before their children; valid until the next poll
+const TreemapRect *treemap_rects(const Treemap *map, int *count);
+
+// Name shown for a rectangle
+const char *treemap_rect_name(const Treemap *map, int index);
+
+// Full path of a rectangle's file or folder; false for TREEMAP_OTHER
+bool treemap_rect_path(const Treemap *map, int index, char *path, size_t path_size);
+
+// Root, size and whether any folder in the current layout was still being counted
+const char *treemap_root(const Treemap *map);
+off_t treemap_total(const Treemap *map);
+bool treemap_is_partial(const Treemap *map);
+
+// Whether a layout is being computed
+bool treemap_is_busy(Treemap *map);
+
+#endif // TREEMAP_H
@@ -0,0 +1,665 @@
+#include "undo_log.h"
+#include "operations.h"
+#include "../platform/trash.h"
+#include "../utils/hash.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define UNDO_FILE_MAGIC "FPUNDO01"
+#define UNDO_FILE_HEADER 16
+#define UNDO_RECORD_MAGIC 0x55444f52u      // "RODU"
+#define UNDO_RECORD_MAX (64 * 1024)
+#define UNDO_PATH_MAX 4096
+
+typedef enum RecordType {
+    RECORD_BEGIN = 1,                       // description
+    RECORD_END,
+    RECORD_MOVED,                           // from, to
+    RECORD_CREATED,                         // path
+    RECORD_FOLDER,                          // path
+    RECORD_TRASHED,                         // path, trash path
+    RECORD_UNDONE                           // The group was undone
+} RecordType;
+
+// Every record: this header, its strings (NUL-terminated), zero padding to 8 bytes,
+// then a RecordTrailer. The checksum covers everything after it up to the trailer
+typedef struct RecordHeader {
+    uint32_t magic;
+    uint32_t length;                        // Whole record, a multiple of 8
+    uint32_t checksum;                      // FNV-1a
+    uint8_t type;
+    uint8_t source;
+    uint16_t first_length;                  // First string with its NUL (0: none)
+    uint64_t group;
+    int64_t time;
+} RecordHeader;
+
+typedef struct RecordTrailer {
+    uint32_t length;                        // Same as the header's, to step backwards
+    uint32_t magic;
+} RecordTrailer;
+
+// A record copied out of the map
+typedef struct Record {
+    RecordType type;
+    UndoSource source;
+    uint64_t group;
+    time_t time;
+    const char *first;                      // Into data ("" when absent)
+    const char *second;
+    char data[UNDO_RECORD_MAX];
+} Record;
+
+struct UndoLog {
+    pthread_mutex_t mutex;
+    int fd;
+    uint8_t *base;
+    size_t mapped;
+    size_t end;                             // After the last whole record
+    size_t synced;                          // Everything before this is on disk
+    bool grown;                             // File size changed since the last commit
+    uint64_t next_group;
+    char path[UNDO_PATH_MAX];
+};
+
+static atomic_uintptr_t g_shared = 0;    // UndoLog *
+
+// Helper: FNV-1a over bytes
+static uint32_t checksum(const uint8_t *data, size_t length)
+{
+    return hash_fnv1a_bytes(HASH_FNV1A_INIT, data, length);
+}
+
+// Helper: Length of the whole record at off if it is intact, else 0
+static size_t record_at(const uint8_t *base, size_t limit, size_t off)
+{
+    if (off + sizeof(RecordHeader) + sizeof(RecordTrailer) > limit) {
+        return 0;
+    }
+    RecordHeader header;
+    memcpy(&header, base + off, sizeof(header));
+    size_t length = header.length;
+    if (header.magic != UNDO_RECORD_MAGIC || length % 8 != 0 ||
+        length < sizeof(RecordHeader) + sizeof(RecordTrailer) || length > UNDO_RECORD_MAX ||
+        off + length > limit) {
+        return 0;
+    }
+    RecordTrailer trailer;
+    memcpy(&trailer, base + off + length - sizeof(trailer), sizeof(trailer));
+    size_t body = offsetof(RecordHeader, checksum) + sizeof(uint32_t);
+    if (trailer.length != length || trailer.magic != UNDO_RECORD_MAGIC ||
+        checksum(base + off + body, length - body - sizeof(trailer)) != header.checksum) {
+        return 0;
+    }
+    return length;
+}
+
+// Helper: Map the file at its current size
+static bool map_file(UndoLog *log, size_t size)
+{
+    if (log->base) {
+        munmap(log->base, log->mapped);
+        log->base = NULL;
+    }
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, log->fd, 0);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    log->base = base;
+    log->mapped = size;
+    return true;
+}
+
+// Helper: Grow the file until needed bytes fit (mutex held)
+static bool ensure_space(UndoLog *log, size_t needed)
+{
+    if (needed <= log->mapped) {
+        return true;
+    }
+    size_t size = log->mapped;
+    while (size < needed) {
+        size += UNDO_LOG_GROW_BYTES;
+    }
+    if (ftruncate(log->fd, (off_t)size) != 0) {
+        return false;
+    }
+    log->grown = true;
+    return map_file(log, size);
+}
+
+// Helper: Sync what was appended since the last commit (mutex held)
+static bool commit_locked(UndoLog *log)
+{
+    if (log->synced >= log->end && !log->grown) {
+        return true;
+    }
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t from = log->synced / page * page;
+    bool ok = msync(log->base + from, log->end - from, MS_SYNC) == 0;
+    if (log->grown) {
+        ok = fsync(log->fd) == 0 && ok;
+        log->grown = false;
+    }
+    log->synced = log->end;
+    return ok;
+}
+
+// Helper: Keep the newest groups once the log is past UNDO_LOG_MAX_BYTES: records from
+// the first group starting in the newer half are copied to a new file that replaces it
+static void compact(UndoLog *log)
+{
+    size_t keep_from = log->end - UNDO_LOG_MAX_BYTES / 2;
+    size_t off = UNDO_FILE_HEADER;
+    size_t length;
+    while ((length = record_at(log->base, log->end, off)) != 0) {
+        RecordHeader header;
+        memcpy(&header, log->base + off, sizeof(header));
+        if (off >= keep_from && header.type == RECORD_BEGIN) {
+            break;
+        }
+        off += length;
+    }
+
+    char temp[UNDO_PATH_MAX + 8];
+    snprintf(temp, sizeof(temp), "%s.tmp", log->path);
+    int fd = open(temp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    size_t kept = log->end - off;
+    size_t size = UNDO_FILE_HEADER + kept + UNDO_LOG_GROW_BYTES;
+    bool ok = ftruncate(fd, (off_t)size) == 0 &&
+              pwrite(fd, log->base, UNDO_FILE_HEADER, 0) == UNDO_FILE_HEADER &&
+              pwrite(fd, log->base + off, kept, UNDO_FILE_HEADER) == (ssize_t)kept &&
+              fsync(fd) == 0 && rename(temp, log->path) == 0;
+    if (!ok) {
+        close(fd);
+        unlink(temp);
+        return;
+    }
+    close(log->fd);
+    log->fd = fd;
+    if (!map_file(log, size)) {
+        log->end = log->synced = UNDO_FILE_HEADER;
+        return;
+    }
+    log->end = log->synced = UNDO_FILE_HEADER + kept;
+}
+
+UndoLog *undo_log_open(const char *path)
+{
+    UndoLog *log = calloc(1, sizeof(UndoLog));
+    if (!log) {
+        return NULL;
+    }
+    snprintf(log->path, sizeof(log->path), "%s", path);
+    log->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    struct stat st;
+    if (log->fd < 0 || fstat(log->fd, &st) != 0) {
+        goto fail;
+    }
+
+    size_t size = (size_t)st.st_size;
+    bool fresh = size == 0;
+    if (!fresh && size < UNDO_FILE_HEADER) {
+        goto fail;
+    }
+    if (fresh) {
+        size = UNDO_LOG_GROW_BYTES;
+        if (ftruncate(log->fd, (off_t)size) != 0) {
+            goto fail;
+        }
+    }
+    if (!map_file(log, size)) {
+        goto fail;
+    }
+    if (fresh) {
+        memcpy(log->base, UNDO_FILE_MAGIC, 8);
+        log->grown = true;
+    } else if (memcmp(log->base, UNDO_FILE_MAGIC, 8) != 0) {
+        // Not a log: leave it alone
+        goto fail;
+    }
+
+    // Whole records up to the first torn or missing one
+    uint64_t last_group = 0;
+    size_t off = UNDO_FILE_HEADER;
+    size_t length;
+    while ((length = record_at(log->base, log->mapped, off)) != 0) {
+        RecordHeader header;
+        memcpy(&header, log->base + off, sizeof(header));
+        if (header.type == RECORD_BEGIN && header.group > last_group) {
+            last_group = header.group;
+        }
+        off += length;
+    }
+    log->end = off;
+    log->synced = off;
+    log->next_group = last_group + 1;
+
+    // A crash can leave part of a record, or records written after it, past the end;
+    // clear them so new records never join up with stale ones
+    for (size_t i = off; i < log->mapped && i < off + UNDO_RECORD_MAX; i++) {
+        if (log->base[i] != 0) {
+            memset(log->base + off, 0, log->mapped - off);
+            msync(log->base, log->mapped, MS_SYNC);
+            break;
+        }
+    }
+
+    if (log->end > UNDO_LOG_MAX_BYTES) {
+        compact(log);
+    }
+    commit_locked(log);
+    pthread_mutex_init(&log->mutex, NULL);
+    return log;
+
+fail:
+    if (log->base) {
+        munmap(log->base, log->mapped);
+    }
+    if (log->fd >= 0) {
+        close(log->fd);
+    }
+    free(log);
+    return NULL;
+}
+
+void undo_log_close(UndoLog *log)
+{
+    if (!log) {
+        return;
+    }
+    if ((UndoLog *)atomic_load(&g_shared) == log) {
+        atomic_store(&g_shared, (uintptr_t)NULL);
+    }
+    commit_locked(log);
+    munmap(log->base, log->mapped);
+    close(log->fd);
+    pthread_mutex_destroy(&log->mutex);
+    free(log);
+}
+
+void undo_log_set_shared(UndoLog *log)
+{
+    atomic_store(&g_shared, (uintptr_t)log);
+}
+
+UndoLog *undo_log_shared(void)
+{
+    return (UndoLog *)atomic_load(&g_shared);
+}
+
+// Helper: Append one record (mutex held); false if out of space
+static bool append_locked(UndoLog *log, RecordType type, UndoSource source, uint64_t group,
+                          const char *first, const char *second)
+{
+    size_t first_length = first ? strlen(first) + 1 : 0;
+    size_t second_length = second ? strlen(second) + 1 : 0;
+    size_t length = (sizeof(RecordHeader) + first_length + second_length + 7) / 8 * 8 + sizeof(RecordTrailer);
+    if (first_length > UINT16_MAX || length > UNDO_RECORD_MAX || !ensure_space(log, log->end + length)) {
+        return false;
+    }
+
+    uint8_t *record = log->base + log->end;
+    RecordHeader header = {
+        .magic = UNDO_RECORD_MAGIC,
+        .length = (uint32_t)length,
+        .type = (uint8_t)type,
+        .source = (uint8_t)source,
+        .first_length = (uint16_t)first_length,
+        .group = group,
+        .time = (int64_t)time(NULL),
+    };
+    uint8_t *p = record + sizeof(header);
+    if (first_length) {
+        memcpy(p, first, first_length);
+        p += first_length;
+    }
+    if (second_length) {
+        memcpy(p, second, second_length);
+        p += second_length;
+    }
+    RecordTrailer trailer = { (uint32_t)length, UNDO_RECORD_MAGIC };
+    memset(p, 0, (size_t)(record + length - sizeof(trailer) - p));
+    memcpy(record + length - sizeof(trailer), &trailer, sizeof(trailer));
+
+    size_t body = offsetof(RecordHeader, checksum) + sizeof(uint32_t);
+    memcpy(record, &header, sizeof(header));
+    header.checksum = checksum(record + body, length - body - sizeof(trailer));
+    memcpy(record, &header, sizeof(header));
+
+    log->end += length;
+    if (log->end - log->synced >= UNDO_LOG_COMMIT_BYTES) {
+        commit_locked(log);
+    }
+    return true;
+}
+
+static void append(UndoLog *log, RecordType type, uint64_t group, const char *first, const char *second)
+{
+    if (!log || group == 0) {
+        return;
+    }
+    pthread_mutex_lock(&log->mutex);
+    append_locked(log, type, 0, group, first, second);
+    pthread_mutex_unlock(&log->mutex);
+}
+
+uint64_t undo_log_begin(UndoLog *log, UndoSource source, const char *description)
+{
+    if (!log) {
+        return 0;
+    }
+    pthread_mutex_lock(&log->mutex);
+    uint64_t group = log->next_group;
+    char text[UNDO_LOG_DESCRIPTION_LEN];
+    snprintf(text, sizeof(text), "%s", description ? description : "");
+    if (append_locked(log, RECORD_BEGIN, source, group, text, NULL)) {
+        log->next_group++;
+    } else {
+        group = 0;
+    }
+    pthread_mutex_unlock(&log->mutex);
+    return group;
+}
+
+void undo_log_moved(UndoLog *log, uint64_t group, const char *from, const char *to)
+{
+    append(log, RECORD_MOVED, group, from, to);
+}
+
+void undo_log_created(UndoLog *log, uint64_t group, const char *path)
+{
+    append(log, RECORD_CREATED, group, path, NULL);
+}
+
+void undo_log_folder(UndoLog *log, uint64_t group, const char *path)
+{
+    append(log, RECORD_FOLDER, group, path, NULL);
+}
+
+void undo_log_trashed(UndoLog *log, uint64_t group, const char *path, const char *trash_path)
+{
+    append(log, RECORD_TRASHED, group, path, trash_path);
+}
+
+void undo_log_end(UndoLog *log, uint64_t group)
+{
+    if (!log || group == 0) {
+        return;
+    }
+    pthread_mutex_lock(&log->mutex);
+    append_locked(log, RECORD_END, 0, group, NULL, NULL);
+    commit_locked(log);
+    pthread_mutex_unlock(&log->mutex);
+}
+
+bool undo_log_commit(UndoLog *log)
+{
+    if (!log) {
+        return false;
+    }
+    pthread_mutex_lock(&log->mutex);
+    bool ok = commit_locked(log);
+    pthread_mutex_unlock(&log->mutex);
+    return ok;
+}
+
+uint64_t undo_log_size(UndoLog *log)
+{
+    if (!log) {
+        return 0;
+    }
+    pthread_mutex_lock(&log->mutex);
+    uint64_t size = log->end - UNDO_FILE_HEADER;
+    pthread_mutex_unlock(&log->mutex);
+    return size;
+}
+
+// Helper: Copy out the record that ends at *off and step *off back to its start; false
+// at the beginning of the log. Records are copied so appends may remap meanwhile
+static bool read_before(UndoLog *log, size_t *off, Record *record)
+{
+    pthread_mutex_lock(&log->mutex);
+    bool ok = false;
+    if (*off > UNDO_FILE_HEADER && *off <= log->end) {
+        RecordTrailer trailer;
+        memcpy(&trailer, log->base + *off - sizeof(trailer), sizeof(trailer));
+        size_t start = trailer.length <= *off - UNDO_FILE_HEADER ? *off - trailer.length : 0;
+        if (start >= UNDO_FILE_HEADER && record_at(log->base, log->end, start) == trailer.length) {
+            RecordHeader header;
+            memcpy(&header, log->base + start, sizeof(header));
+            size_t data_length = trailer.length - sizeof(header) - sizeof(trailer);
+            memcpy(record->data, log->base + start + sizeof(header), data_length);
+            record->data[data_length] = '\0';
+            record->type = (RecordType)header.type;
+            record->source = (UndoSource)header.source;
+            record->group = header.group;
+            record->time = (time_t)header.time;
+            record->first = header.first_length ? record->data : "";
+            record->second = header.first_length && header.first_length < data_length ?
+                             record->data + header.first_length : "";
+            *off = start;
+            ok = true;
+        }
+    }
+    pthread_mutex_unlock(&log->mutex);
+    return ok;
+}
+
+// Helper: Where undo starts reading
+static size_t end_offset(UndoLog *log)
+{
+    pthread_mutex_lock(&log->mutex);
+    size_t end = log->end;
+    pthread_mutex_unlock(&log->mutex);
+    return end;
+}
+
+// Groups seen while reading backwards
+typedef struct GroupSeen {
+    uint64_t group;
+    int actions;
+    bool ended;
+    bool undone;
+} GroupSeen;
+
+// Helper: Entry for group, added if new; NULL if out of memory
+static GroupSeen *group_seen(GroupSeen **groups, int *count, int *capacity, uint64_t group)
+{
+    // Newest groups are looked up most, and sit at the end
+    for (int i = *count - 1; i >= 0; i--) {
+        if ((*groups)[i].group == group) {
+            return &(*groups)[i];
+        }
+    }
+    if (*count == *capacity) {
+        int new_capacity = *capacity ? *capacity * 2 : 16;
+        GroupSeen *grown = realloc(*groups, (size_t)new_capacity * sizeof(GroupSeen));
+        if (!grown) {
+            return NULL;
+        }
+        *groups = grown;
+        *capacity = new_capacity;
+    }
+    GroupSeen *seen = &(*groups)[(*count)++];
+    memset(seen, 0, sizeof(GroupSeen));
+    seen->group = group;
+    return seen;
+}
+
+bool undo_log_last(UndoLog *log, UndoSource source, UndoGroupInfo *info)
+{
+    if (!log) {
+        return false;
+    }
+    Record *record = malloc(sizeof(Record));
+    GroupSeen *groups = NULL;
+    int count = 0;
+    int capacity = 0;
+    bool found = false;
+
+    size_t off = end_offset(log);
+    while (record && !found && read_before(log, &off, record)) {
+        GroupSeen *seen = group_seen(&groups, &count, &capacity, record->group);
+        if (!seen) {
+            break;
+        }
+        switch (record->type) {
+            case RECORD_UNDONE:
+                seen->undone = true;
+                break;
+            case RECORD_END:
+                seen->ended = true;
+                break;
+            case RECORD_BEGIN:
+                if (!seen->undone && seen->actions > 0 &&
+                    (source == UNDO_SOURCE_ANY || record->source == source)) {
+                    info->group = record->group;
+                    info->source = record->source;
+                    info->started_at = record->time;
+                    info->actions = seen->actions;
+                    info->complete = seen->ended;
+                    snprintf(info->description, sizeof(info->description), "%s", record->first);
+                    found = true;
+                }
+                break;
+            default:
+                seen->actions++;
+                break;
+        }
+    }
+    free(groups);
+    free(record);
+    return found;
+}
+
+// Helper: Note the first failure
+static void note_failure(UndoResult *result, const char *what, const char *path)
+{
+    result->failed++;
+    if (result->error_message[0] == '\0') {
+        snprintf(result->error_message, sizeof(result->error_message), "%s %s: %s", what, path, strerror(errno));
+    }
+}
+
+// Helper: Whether path exists (without following a last symlink)
+static bool exists(const char *path)
+{
+    struct stat st;
+    return lstat(path, &st) == 0;
+}
+
+// Helper: Move to back to from, never replacing anything; a move already undone counts
+static bool move_back(const char *from, const char *to)
+{
+    if (!exists(to) && exists(from)) {
+        return true;
+    }
+    if (file_rename_at(AT_FDCWD, to, AT_FDCWD, from) == 0) {
+        return true;
+    }
+    if (errno != EXDEV || exists(from)) {
+        return false;
+    }
+    return file_move_to(to, from, NULL) == OP_SUCCESS;
+}
+
+// Helper: Reverse one action
+static void reverse(const Record *record, UndoResult *result)
+{
+    switch (record->type) {
+        case RECORD_MOVED:
+            if (move_back(record->first, record->second)) {
+                result->undone++;
+            } else {
+                note_failure(result, "Cannot move back", record->second);
+            }
+            break;
+        case RECORD_TRASHED:
+            if (move_back(record->first, record->second)) {
+                result->undone++;
+            } else {
+                note_failure(result, "Cannot put back", record->first);
+            }
+            break;
+        case RECORD_CREATED:
+            if (!exists(record->first) || platform_move_to_trash(record->first)) {
+                result->undone++;
+            } else {
+                note_failure(result, "Cannot move to the Trash", record->first);
+            }
+            break;
+        case RECORD_FOLDER:
+            // Left in place if something else has been put in it
+            if (rmdir(record->first) == 0 || errno == ENOENT || errno == ENOTEMPTY || errno == EEXIST) {
+                result->undone++;
+            } else {
+                note_failure(result, "Cannot remove", record->first);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+bool undo_log_undo(UndoLog *log, uint64_t group, UndoResult *result)
+{
+    memset(result, 0, sizeof(UndoResult));
+    Record *record = log && group != 0 ? malloc(sizeof(Record)) : NULL;
+    if (!record) {
+        snprintf(result->error_message, sizeof(result->error_message), "Nothing to undo");
+        return false;
+    }
+
+    bool begun = false;
+    size_t off = end_offset(log);
+    while (!begun && read_before(log, &off, record)) {
+        if (record->group != group) {
+            continue;
+        }
+        if (record->type == RECORD_UNDONE) {
+            snprintf(result->error_message, sizeof(result->error_message), "Already undone");
+            free(record);
+            return false;
+        }
+        if (record->type == RECORD_BEGIN) {
+            begun = true;
+        } else {
+            reverse(record, result);
+        }
+    }
+    free(record);
+
+    // A failed undo stays open, so it can be tried again
+    if (result->failed == 0) {
+        pthread_mutex_lock(&log->mutex);
+        append_locked(log, RECORD_UNDONE, 0, group, NULL, NULL);
+        commit_locked(log);
+        pthread_mutex_unlock(&log->mutex);
+    }
+    return result->failed == 0;
+}
+
+bool undo_log_undo_last(UndoLog *log, UndoSource source, UndoResult *result)
+{
+    UndoGroupInfo info;
+    if (!undo_log_last(log, source, &info)) {
+        memset(result, 0, sizeof(UndoResult));
+        snprintf(result->error_message, sizeof(result->error_message), "Nothing to undo");
+        return false;
+    }
+    return undo_log_undo(log, info.group, result);
+}
@@ -0,0 +1,90 @@
+#ifndef UNDO_LOG_H
+#define UNDO_LOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// Undo log: one append-only journal of what every mutating path did (queue operations,
+// natural language commands, organize, batch rename, duplicate cleanup), so any of them
+// can be undone later, even after a crash. Work is recorded in groups, one per user
+// action. Records are copied into a memory-mapped file under a mutex, and made durable
+// by group commit: one sync covers every record since the last, taken when a group ends
+// or UNDO_LOG_COMMIT_BYTES have built up. Each record carries a checksum and its length
+// at both ends, so opening the log finds the end of the last whole record after a crash,
+// and undo streams it backwards without reading it all. Every function takes a NULL log
+// and does nothing, so paths can record into undo_log_shared() unconditionally
+
+#define UNDO_LOG_GROW_BYTES (4 * 1024 * 1024)       // File grows (and is remapped) in these steps
+#define UNDO_LOG_COMMIT_BYTES (256 * 1024)          // Unsynced records before a commit
+#define UNDO_LOG_MAX_BYTES (64 * 1024 * 1024)       // On open, older groups past this are dropped
+#define UNDO_LOG_DESCRIPTION_LEN 128
+
+// Who recorded a group
+typedef enum UndoSource {
+    UNDO_SOURCE_ANY = -1,                   // Matches every source in undo_log_last
+    UNDO_SOURCE_QUEUE,
+    UNDO_SOURCE_NL,
+    UNDO_SOURCE_ORGANIZE,
+    UNDO_SOURCE_RENAME,
+    UNDO_SOURCE_DEDUPE
+} UndoSource;
+
+// Undo log (opaque)
+typedef struct UndoLog UndoLog;
+
+// A group found in the log
+typedef struct UndoGroupInfo {
+    uint64_t group;
+    UndoSource source;
+    time_t started_at;
+    int actions;                            // Recorded actions
+    bool complete;                          // Ended; false if cut short by a crash or cancel
+    char description[UNDO_LOG_DESCRIPTION_LEN];
+} UndoGroupInfo;
+
+// Outcome of an undo
+typedef struct UndoResult {
+    int undone;
+    int failed;
+    char error_message[256];                // First failure
+} UndoResult;
+
+// Open (or create) the log at path; NULL if it cannot be mapped
+UndoLog *undo_log_open(const char *path);
+
+// Commit and close
+void undo_log_close(UndoLog *log);
+
+// Log the app records into (NULL: nothing is recorded)
+void undo_log_set_shared(UndoLog *log);
+UndoLog *undo_log_shared(void);
+
+// Start a group; returns its ID (0 when log is NULL or out of space)
+uint64_t undo_log_begin(UndoLog *log, UndoSource source, const char *description);
+
+// Actions, each undone by the reverse step. Group 0 records nothing
+void undo_log_moved(UndoLog *log, uint64_t group, const char *from, const char *to);     // Moved back
+void undo_log_created(UndoLog *log, uint64_t group, const char *path);                   // Sent to the Trash
+void undo_log_folder(UndoLog *log, uint64_t group, const char *path);                    // Removed if empty
+void undo_log_trashed(UndoLog *log, uint64_t group, const char *path, const char *trash_path); // Put back
+
+// End a group and commit it
+void undo_log_end(UndoLog *log, uint64_t group);
+
+// Sync every record appended so far
+bool undo_log_commit(UndoLog *log);
+
+// Most recent group from source with actions that is not undone yet; false if none
+bool undo_log_last(UndoLog *log, UndoSource source, UndoGroupInfo *info);
+
+// Reverse a group's actions, newest first, and mark it undone. false if any failed
+bool undo_log_undo(UndoLog *log, uint64_t group, UndoResult *result);
+
+// Undo the most recent group from source; false if there was none or any action failed
+bool undo_log_undo_last(UndoLog *log, UndoSource source, UndoResult *result);
+
+// Bytes of records in the log
+uint64_t undo_log_size(UndoLog *log);
+
+#endif // UNDO_LOG_H
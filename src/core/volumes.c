@@ -0,0 +1,371 @@
+#include "volumes.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#ifdef __APPLE__
+#include <sys/attr.h>
+#include <sys/mount.h>
+#include <unistd.h>
+#include <uuid/uuid.h>
+#include "../platform/mounts.h"
+#else
+#include <dirent.h>
+#include <limits.h>
+#include <mntent.h>
+#include <sys/statvfs.h>
+#endif
+
+struct Volumes {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool stop;
+    bool refresh_requested;
+    double refresh_seconds;
+
+    // Read by lookups under mutex; replaced whole by each refresh
+    VolumeInfo volumes[VOLUMES_MAX];
+    int count;
+    uint64_t generation;
+
+#ifdef __APPLE__
+    MountWatcher *watcher;
+#endif
+};
+
+// Helper: Display name of a mount point (the startup disk keeps its Finder name)
+static void volume_name(const char *path, char *name, size_t name_size)
+{
+    if (strcmp(path, "/") == 0) {
+        snprintf(name, name_size, "Macintosh HD");
+        return;
+    }
+    const char *slash = strrchr(path, '/');
+    snprintf(name, name_size, "%s", slash && slash[1] ? slash + 1 : path);
+}
+
+// Helper: Whether the sidebar lists a mount point
+static bool volume_browsable(const char *path)
+{
+    return strcmp(path, "/") == 0 ||
+           (strncmp(path, "/Volumes/", 9) == 0 && strchr(path + 9, '/') == NULL);
+}
+
+#ifdef __APPLE__
+// Helper: File system UUID of a local mount ("" if it has none)
+static void volume_uuid(const char *path, char *uuid, size_t uuid_size)
+{
+    struct attrlist request = {0};
+    request.bitmapcount = ATTR_BIT_MAP_COUNT;
+    request.volattr = ATTR_VOL_INFO | ATTR_VOL_UUID;
+    struct {
+        uint32_t length;
+        uuid_t uuid;
+    } __attribute__((packed)) reply;
+
+    uuid[0] = '\0';
+    if (uuid_size < 37 || getattrlist(path, &request, &reply, sizeof(reply), 0) != 0 ||
+        uuid_is_null(reply.uuid)) return;
+    uuid_unparse_upper(reply.uuid, uuid);
+}
+
+// Helper: Read every mount from the kernel's cached statistics (never waits on a server)
+static int volumes_read(VolumeInfo *out, int max)
+{
+    int count = getfsstat(NULL, 0, MNT_NOWAIT);
+    if (count <= 0) return 0;
+
+    struct statfs *mounts = malloc((size_t)count * sizeof(struct statfs));
+    if (!mounts) return 0;
+    count = getfsstat(mounts, count * (int)sizeof(struct statfs), MNT_NOWAIT);
+
+    int n = 0;
+    for (int i = 0; i < count && n < max; i++) {
+        const struct statfs *m = &mounts[i];
+        VolumeInfo *v = &out[n++];
+        memset(v, 0, sizeof(*v));
+        snprintf(v->path, sizeof(v->path), "%s", m->f_mntonname);
+        snprintf(v->fs_type, sizeof(v->fs_type), "%s", m->f_fstypename);
+        volume_name(v->path, v->name, sizeof(v->name));
+        v->device = (dev_t)m->f_fsid.val[0];
+        v->capacity = (off_t)m->f_blocks * (off_t)m->f_bsize;
+        v->available = (off_t)m->f_bavail * (off_t)m->f_bsize;
+        v->remote = !(m->f_flags & MNT_LOCAL);
+        v->browsable = !(m->f_flags & MNT_DONTBROWSE) && volume_browsable(v->path);
+        if (!v->remote) volume_uuid(v->path, v->uuid, sizeof(v->uuid));
+    }
+    free(mounts);
+    return n;
+}
+#else
+// Helper: Network file systems by type
+static bool volume_type_remote(const char *type)
+{
+    static const char *remote[] = { "nfs", "nfs4", "cifs", "smbfs", "smb3", "afpfs", "webdav",
+                                    "fuse.sshfs", "9p", NULL };
+    for (int i = 0; remote[i]; i++) {
+        if (strcmp(type, remote[i]) == 0) return true;
+    }
+    return false;
+}
+
+// Helper: File system UUID of a block device from /dev/disk/by-uuid ("" if none)
+static void volume_uuid(const char *device, char *uuid, size_t uuid_size)
+{
+    uuid[0] = '\0';
+    char target[PATH_MAX];
+    if (strncmp(device, "/dev/", 5) != 0 || !realpath(device, target)) return;
+
+    DIR *dir = opendir("/dev/disk/by-uuid");
+    if (!dir) return;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        char link[PATH_MAX];
+        char resolved[PATH_MAX];
+        snprintf(link, sizeof(link), "/dev/disk/by-uuid/%s", entry->d_name);
+        if (realpath(link, resolved) && strcmp(resolved, target) == 0) {
+            snprintf(uuid, uuid_size, "%s", entry->d_name);
+            break;
+        }
+    }
+    closedir(dir);
+}
+
+// Helper: Read every mount from the mount table (statvfs may wait on a remote server,
+// but only this thread does)
+static int volumes_read(VolumeInfo *out, int max)
+{
+    FILE *table = setmntent("/proc/self/mounts", "r");
+    if (!table) return 0;
+
+    int n = 0;
+    struct mntent entry;
+    char buffer[4096];
+    while (n < max && getmntent_r(table, &entry, buffer, sizeof(buffer))) {
+        VolumeInfo *v = &out[n];
+        memset(v, 0, sizeof(*v));
+        snprintf(v->path, sizeof(v->path), "%s", entry.mnt_dir);
+        snprintf(v->fs_type, sizeof(v->fs_type), "%s", entry.mnt_type);
+        volume_name(v->path, v->name, sizeof(v->name));
+        v->remote = volume_type_remote(entry.mnt_type);
+        v->browsable = volume_browsable(v->path);
+
+        struct stat st;
+        struct statvfs fs;
+        if (stat(v->path, &st) != 0 || statvfs(v->path, &fs) != 0) {
+            continue;
+        }
+        v->device = st.st_dev;
+        if (!v->remote) volume_uuid(entry.mnt_fsname, v->uuid, sizeof(v->uuid));
+        v->capacity = (off_t)fs.f_blocks * (off_t)fs.f_frsize;
+        v->available = (off_t)fs.f_bavail * (off_t)fs.f_frsize;
+
+        // A later mount over the same point hides the earlier one
+        for (int i = 0; i < n; i++) {
+            if (strcmp(out[i].path, v->path) == 0) {
+                out[i] = *v;
+                n--;
+                break;
+            }
+        }
+        n++;
+    }
+    endmntent(table);
+    return n;
+}
+#endif
+
+// Helper: Whether two readings list the same mounts
+static bool volumes_same_mounts(const VolumeInfo *a, int a_count, const VolumeInfo *b, int b_count)
+{
+    if (a_count != b_count) return false;
+    for (int i = 0; i < a_count; i++) {
+        if (a[i].device != b[i].device || strcmp(a[i].path, b[i].path) != 0) return false;
+    }
+    return true;
+}
+
+// Helper: Read the volumes and publish them
+static void volumes_update(Volumes *volumes)
+{
+    VolumeInfo *fresh = malloc(sizeof(VolumeInfo) * VOLUMES_MAX);
+    if (!fresh) return;
+    int count = volumes_read(fresh, VOLUMES_MAX);
+
+    pthread_mutex_lock(&volumes->mutex);
+    if (!volumes_same_mounts(volumes->volumes, volumes->count, fresh, count)) {
+        volumes->generation++;
+    }
+    memcpy(volumes->volumes, fresh, sizeof(VolumeInfo) * (size_t)count);
+    volumes->count = count;
+    pthread_mutex_unlock(&volumes->mutex);
+
+    free(fresh);
+}
+
+static void *volumes_thread(void *arg)
+{
+    Volumes *volumes = (Volumes *)arg;
+
+    pthread_mutex_lock(&volumes->mutex);
+    while (!volumes->stop) {
+        if (!volumes->refresh_requested) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            long long nsec = deadline.tv_nsec + (long long)(volumes->refresh_seconds * 1e9);
+            deadline.tv_sec += (time_t)(nsec / 1000000000LL);
+            deadline.tv_nsec = (long)(nsec % 1000000000LL);
+            if (pthread_cond_timedwait(&volumes->cond, &volumes->mutex, &deadline) != ETIMEDOUT &&
+                !volumes->refresh_requested) {
+                continue;  // Woken to stop, or spuriously
+            }
+        }
+        if (volumes->stop) break;
+        volumes->refresh_requested = false;
+        pthread_mutex_unlock(&volumes->mutex);
+
+        volumes_update(volumes);
+
+        pthread_mutex_lock(&volumes->mutex);
+    }
+    pthread_mutex_unlock(&volumes->mutex);
+    return NULL;
+}
+
+#ifdef __APPLE__
+// Helper: DiskArbitration saw a disk come, go or mount
+static void volumes_mounts_changed(void *context)
+{
+    volumes_refresh((Volumes *)context);
+}
+#endif
+
+Volumes *volumes_create(double refresh_seconds)
+{
+    Volumes *volumes = calloc(1, sizeof(Volumes));
+    if (!volumes) return NULL;
+
+    volumes->refresh_seconds = refresh_seconds > 0 ? refresh_seconds : VOLUMES_REFRESH_SECONDS;
+    pthread_mutex_init(&volumes->mutex, NULL);
+    pthread_cond_init(&volumes->cond, NULL);
+
+    // The first reading is on hand before anyone asks
+    volumes_update(volumes);
+
+    if (pthread_create(&volumes->thread, NULL, volumes_thread, volumes) != 0) {
+        pthread_cond_destroy(&volumes->cond);
+        pthread_mutex_destroy(&volumes->mutex);
+        free(volumes);
+        return NULL;
+    }
+
+#ifdef __APPLE__
+    volumes->watcher = mount_watch_start(volumes_mounts_changed, volumes);
+#endif
+    return volumes;
+}
+
+void volumes_destroy(Volumes *volumes)
+{
+    if (!volumes) return;
+
+#ifdef __APPLE__
+    mount_watch_stop(volumes->watcher);
+#endif
+
+    pthread_mutex_lock(&volumes->mutex);
+    volumes->stop = true;
+    pthread_cond_signal(&volumes->cond);
+    pthread_mutex_unlock(&volumes->mutex);
+    pthread_join(volumes->thread, NULL);
+
+    pthread_cond_destroy(&volumes->cond);
+    pthread_mutex_destroy(&volumes->mutex);
+    free(volumes);
+}
+
+void volumes_refresh(Volumes *volumes)
+{
+    if (!volumes) return;
+    pthread_mutex_lock(&volumes->mutex);
+    volumes->refresh_requested = true;
+    pthread_cond_signal(&volumes->cond);
+    pthread_mutex_unlock(&volumes->mutex);
+}
+
+// Helper: Index of the volume whose mount point is the longest prefix of path, or -1
+// (caller holds the mutex)
+static int volumes_find(const Volumes *volumes, const char *path)
+{
+    int best = -1;
+    size_t best_length = 0;
+    for (int i = 0; i < volumes->count; i++) {
+        const char *mount = volumes->volumes[i].path;
+        size_t length = strlen(mount);
+        bool covers = strcmp(mount, "/") == 0 ||
+                      (strncmp(path, mount, length) == 0 && (path[length] == '/' || path[length] == '\0'));
+        if (covers && (best < 0 || length > best_length)) {
+            best = i;
+            best_length = length;
+        }
+    }
+    return best;
+}
+
+bool volumes_lookup(Volumes *volumes, const char *path, VolumeInfo *info)
+{
+    if (!volumes || !path || path[0] != '/') return false;
+
+    pthread_mutex_lock(&volumes->mutex);
+    int index = volumes_find(volumes, path);
+    if (index >= 0 && info) {
+        *info = volumes->volumes[index];
+    }
+    pthread_mutex_unlock(&volumes->mutex);
+    return index >= 0;
+}
+
+bool volumes_is_remote(Volumes *volumes, const char *path)
+{
+    if (!volumes || !path || path[0] != '/') return false;
+
+    pthread_mutex_lock(&volumes->mutex);
+    int index = volumes_find(volumes, path);
+    bool remote = index >= 0 && volumes->volumes[index].remote;
+    pthread_mutex_unlock(&volumes->mutex);
+    return remote;
+}
+
+int volumes_list(Volumes *volumes, VolumeInfo *out, int max)
+{
+    if (!volumes || !out) return 0;
+
+    int n = 0;
+    pthread_mutex_lock(&volumes->mutex);
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < volumes->count && n < max; i++) {
+            const VolumeInfo *v = &volumes->volumes[i];
+            bool root = strcmp(v->path, "/") == 0;
+            if (v->browsable && root == (pass == 0)) {
+                out[n++] = *v;
+            }
+        }
+    }
+    pthread_mutex_unlock(&volumes->mutex);
+    return n;
+}
+
+uint64_t volumes_generation(Volumes *volumes)
+{
+    if (!volumes) return 0;
+    pthread_mutex_lock(&volumes->mutex);
+    uint64_t generation = volumes->generation;
+    pthread_mutex_unlock(&volumes->mutex);
+    return generation;
+}
@@ -0,0 +1,62 @@
+#ifndef VOLUMES_H
+#define VOLUMES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// Mounted volumes: capacity, free space, file system type and whether each is remote,
+// read by a background thread on a timer and whenever DiskArbitration reports a disk
+// appearing, disappearing or being mounted. On macOS the figures come from
+// getfsstat(MNT_NOWAIT), which answers from the kernel's cached statistics, so a stale
+// network mount cannot block a refresh. Lookups find the volume holding a path by its
+// longest mount point prefix, from memory and without a syscall: the status bar asks
+// every frame, the sidebar lists the browsable volumes, the operation queue groups work
+// by volume, thumbnails skip remote volumes and the semantic index keeps a database per
+// external volume by its UUID
+
+#define VOLUMES_MAX 64
+#define VOLUMES_REFRESH_SECONDS 10.0    // Free space is this stale at most
+#define VOLUME_PATH_MAX 1024
+#define VOLUME_NAME_MAX 64
+#define VOLUME_FSTYPE_MAX 16
+#define VOLUME_UUID_MAX 40
+
+typedef struct VolumeInfo {
+    char path[VOLUME_PATH_MAX];         // Mount point
+    char name[VOLUME_NAME_MAX];         // Display name
+    char fs_type[VOLUME_FSTYPE_MAX];    // "apfs", "smbfs", ...
+    char uuid[VOLUME_UUID_MAX];         // File system UUID of a local volume, "" if none
+    dev_t device;                       // st_dev of the files on it
+    off_t capacity;                     // Bytes
+    off_t available;                    // Bytes free for the user
+    bool remote;                        // Network file system
+    bool browsable;                     // Root or a /Volumes mount, listed in the sidebar
+} VolumeInfo;
+
+// Volume service (opaque)
+typedef struct Volumes Volumes;
+
+// Read the mounted volumes and start the refresh thread (refresh_seconds <= 0 for the
+// default); NULL on failure
+Volumes *volumes_create(double refresh_seconds);
+
+// Stop the thread and free the service
+void volumes_destroy(Volumes *volumes);
+
+// Read the volumes again soon, in the background
+void volumes_refresh(Volumes *volumes);
+
+// The volume holding path (absolute); false if no mount point covers it
+bool volumes_lookup(Volumes *volumes, const char *path, VolumeInfo *info);
+
+// Whether path is on a network volume
+bool volumes_is_remote(Volumes *volumes, const char *path);
+
+// Copy up to max browsable volumes, root first, to out; returns how many
+int volumes_list(Volumes *volumes, VolumeInfo *out, int max);
+
+// Count of changes to the set of mounts: the sidebar lists them again when it moves
+uint64_t volumes_generation(Volumes *volumes);
+
+#endif // VOLUMES_H
@@ -0,0 +1,316 @@
+#include "daemon.h"
+#include "raylib.h"
+#include "core/fs_watch.h"
+#include "core/volumes.h"
+#include "ai/indexer.h"
+#include "ai/path_index.h"
+#include "ai/hash_cache.h"
+#include "ai/vectordb.h"
+#include "ai/model_manager.h"
+#include "ai/semantic_search.h"
+#include "ai/visual_search.h"
+#include "ai/index_pack.h"
+#include "ai/index_shards.h"
+#include "ai/extract_pool.h"
+#include "ai/ai_common.h"
+#include "tools/query_server.h"
+#include "platform/power.h"
+#include "utils/config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DAEMON_SAVE_INTERVAL 30         // Seconds between saves of a changed filename index
+#define DAEMON_COALESCE 1.0             // Seconds of change events batched together
+
+static volatile sig_atomic_t g_daemon_stop = 0;
+
+static void daemon_signal(int sig)
+{
+    (void)sig;
+    g_daemon_stop = 1;
+}
+
+// Helper: Path of a file in ~/.config/finder-plus (created if missing)
+static bool daemon_file(const char *name, char *out, size_t size)
+{
+    const char *home = getenv("HOME");
+    if (!home) {
+        return false;
+    }
+    snprintf(out, size, "%s/.config", home);
+    mkdir(out, 0755);
+    snprintf(out, size, "%s/.config/finder-plus", home);
+    mkdir(out, 0755);
+    snprintf(out, size, "%s/.config/finder-plus/%s", home, name);
+    return true;
+}
+
+bool index_daemon_running(void)
+{
+    char lock_path[4096];
+    if (!daemon_file("daemon.lock", lock_path, sizeof(lock_path))) {
+        return false;
+    }
+    int fd = open(lock_path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool held = flock(fd, LOCK_SH | LOCK_NB) != 0 && errno == EWOULDBLOCK;
+    close(fd);
+    return held;
+}
+
+// Helper: An indexer over $HOME, following changes through the watch bus. Filename
+// batches are cheap and go unpaced; embedding batches keep the configured pause
+static Indexer *daemon_indexer(const char *home, FsWatch *watch, bool paths)
+{
+    IndexerConfig config = indexer_get_default_config();
+    strncpy(config.watch_dirs[0], home, sizeof(config.watch_dirs[0]) - 1);
+    config.watch_dir_count = 1;
+    config.enable_fsevents = true;
+    if (paths) {
+        config.delay_between_batches_ms = 0;
+    } else {
+        config.respect_ignore_files = g_config.ai.respect_ignore_files;
+    }
+    Indexer *indexer = indexer_create_with_config(&config);
+    if (indexer) {
+        indexer_set_fs_watch(indexer, watch);
+        IndexerThrottle throttle = { .background = true };
+        indexer_set_throttle(indexer, &throttle);
+    }
+    return indexer;
+}
+
+int index_pack_command(int argc, char *argv[])
+{
+    bool export = strcmp(argv[1], "--export-index-pack") == 0;
+    char path[4096];
+    if (argc < 4 || !daemon_file("index.db", path, sizeof(path))) {
+        fprintf(stderr, "Usage: %s --export-index-pack FOLDER PACK | --import-index-pack PACK FOLDER\n", argv[0]);
+        return 2;
+    }
+
+    VectorDB *vectordb = vectordb_open(path);
+    VisualSearch *visual_search = visual_search_create();
+    if (!vectordb || !visual_search) {
+        fprintf(stderr, "Cannot open the index at %s\n", path);
+        visual_search_destroy(visual_search);
+        if (vectordb) {
+            vectordb_close(vectordb);
+        }
+        return 1;
+    }
+    visual_search_set_vectordb(visual_search, vectordb);
+    vectordb_set_model(vectordb, path_basename(embedding_get_default_model_path()));
+
+    // A folder on an external volume is read from and written to the volume's database
+    config_init(&g_config);
+    config_load(&g_config, config_get_default_path());
+    Volumes *volumes = volumes_create(0);
+    index_shards_sync(vectordb, volumes, g_config.ai.index_on_volumes);
+
+    // Packs name the model files their embeddings came from
+    IndexPackModels models = {
+        .text = path_basename(embedding_get_default_model_path()),
+        .image = path_basename(clip_get_default_model_path()),
+    };
+    IndexPackStats stats;
+    IndexPackStatus status;
+    if (export) {
+        status = index_pack_export(vectordb, visual_search, argv[2], &models, argv[3], &stats);
+        if (status == INDEX_PACK_STATUS_OK) {
+            printf("Exported %d files (%d with text, %d with images) to %s\n",
+                   stats.entries, stats.text_entries, stats.image_entries, argv[3]);
+        }
+    } else {
+        status = index_pack_import(vectordb, visual_search, argv[2], argv[3], &models, &stats);
+        if (status == INDEX_PACK_STATUS_OK) {
+            printf("Imported %d of %d files (%d matched by content); %d already indexed, %d changed, %d missing\n",
+                   stats.imported, stats.entries, stats.hashed, stats.current, stats.stale, stats.missing);
+        }
+    }
+    if (status != INDEX_PACK_STATUS_OK) {
+        fprintf(stderr, "%s\n", index_pack_status_message(status));
+    }
+
+    visual_search_destroy(visual_search);
+    vectordb_close(vectordb);
+    volumes_destroy(volumes);
+    return status == INDEX_PACK_STATUS_OK ? 0 : 1;
+}
+
+int index_daemon_run(void)
+{
+    const char *home = getenv("HOME");
+    char path[4096];
+    if (!home || !daemon_file("daemon.lock", path, sizeof(path))) {
+        fprintf(stderr, "Index daemon: HOME is not set\n");
+        return 1;
+    }
+
+    // One daemon per user; the lock goes with the process
+    int lock_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lock_fd < 0) {
+        fprintf(stderr, "Index daemon: cannot open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    if (flock(lock_fd, LOCK_EX | LOCK_NB) != 0) {
+        fprintf(stderr, "Index daemon already running\n");
+        close(lock_fd);
+        return 0;
+    }
+
+    platform_set_background_priority();
+    SetTraceLogLevel(LOG_INFO);
+    config_init(&g_config);
+    config_load(&g_config, config_get_default_path());
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = daemon_signal;
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    FsWatch *watch = fs_watch_create(DAEMON_COALESCE);
+    if (!watch || !fs_watch_start(watch)) {
+        TraceLog(LOG_WARNING, "Index daemon: file system watching unavailable, indexes follow no changes");
+    }
+
+    // Filename index
+    PathIndex *path_index = NULL;
+    HashCache *hash_cache = NULL;
+    Indexer *path_indexer = NULL;
+    if (g_config.performance.path_index && daemon_file("paths.idx", path, sizeof(path))) {
+        path_index = path_index_open(path);
+        if (path_index && daemon_file("hashes.db", path, sizeof(path))) {
+            hash_cache = hash_cache_open(path);
+        }
+        path_indexer = path_index ? daemon_indexer(home, watch, true) : NULL;
+        if (path_indexer) {
+            indexer_set_path_index(path_indexer, path_index);
+            indexer_set_hash_cache(path_indexer, hash_cache);
+            indexer_start(path_indexer);
+        }
+    }
+
+    // Semantic index; models load on the first file or query, and unload when idle
+    VectorDB *vectordb = daemon_file("index.db", path, sizeof(path)) ? vectordb_open(path) : NULL;
+    EmbeddingEngine *embedding_engine = model_manager_acquire_embedding();
+    CLIPEngine *clip_engine = model_manager_acquire_clip();
+    Indexer *indexer = NULL;
+    Volumes *volumes = NULL;
+    uint64_t volumes_seen = 0;
+    if (vectordb) {
+        vectordb_set_quantization(vectordb, (VectorQuantization)g_config.performance.vector_quantization);
+        vectordb_set_model(vectordb, path_basename(embedding_get_default_model_path()));
+
+        // Files on external volumes go to the volume's own database while it is mounted
+        volumes = volumes_create(0);
+        volumes_seen = volumes_generation(volumes);
+        index_shards_sync(vectordb, volumes, g_config.ai.index_on_volumes);
+    }
+    if (vectordb && g_config.ai.semantic_search && embedding_engine_is_available(embedding_engine)) {
+        if (!extract_pool_start(NULL)) {
+            TraceLog(LOG_WARNING, "Index daemon: extractor workers unavailable, documents are read in process");
+        }
+        indexer = daemon_indexer(home, watch, false);
+        if (indexer) {
+            indexer_set_embedding_engine(indexer, embedding_engine);
+            indexer_set_vectordb(indexer, vectordb);
+            const char *excludes[] = {"node_modules", ".git", ".DS_Store", "*.pyc", "__pycache__"};
+            for (int i = 0; i < 5; i++) {
+                indexer_add_exclude_pattern(indexer, excludes[i]);
+            }
+            indexer_start(indexer);
+        }
+    }
+
+    SemanticSearch *semantic_search = semantic_search_create();
+    if (semantic_search) {
+        semantic_search_set_embedding_engine(semantic_search, embedding_engine);
+        semantic_search_set_vectordb(semantic_search, vectordb);
+        semantic_search_set_indexer(semantic_search, indexer);
+    }
+    VisualSearch *visual_search = visual_search_create();
+    if (visual_search) {
+        visual_search_set_clip_engine(visual_search, clip_engine);
+        visual_search_set_vectordb(visual_search, vectordb);
+        visual_search_set_quantization(visual_search, (VectorQuantization)g_config.performance.vector_quantization);
+    }
+
+    snprintf(path, sizeof(path), "%s/" QUERY_SERVER_SOCKET, home);
+    QueryServerSources sources = {
+        .semantic_search = semantic_search,
+        .visual_search = visual_search,
+        .path_index = path_index,
+        .path_indexer = path_indexer,
+    };
+    QueryServer *server = query_server_start(path, &sources);
+    if (!server) {
+        TraceLog(LOG_WARNING, "Index daemon: query server unavailable at %s", path);
+    }
+    TraceLog(LOG_INFO, "Index daemon running (filename index %s, semantic indexing %s)",
+             path_indexer ? "on" : "off", indexer ? "on" : "off");
+
+    // The indexers work on their own threads; this one only saves what changed
+    uint64_t saved_changes = path_index_changes(path_index);
+    int since_save = 0;
+    while (!g_daemon_stop) {
+        sleep(1);
+        uint64_t generation = volumes_generation(volumes);
+        if (generation != volumes_seen) {
+            volumes_seen = generation;
+            index_shards_sync(vectordb, volumes, g_config.ai.index_on_volumes);
+        }
+        if (++since_save < DAEMON_SAVE_INTERVAL) continue;
+        since_save = 0;
+        uint64_t changes = path_index_changes(path_index);
+        if (changes != saved_changes && path_index_save(path_index)) {
+            saved_changes = changes;
+        }
+    }
+    TraceLog(LOG_INFO, "Index daemon stopping");
+
+    // Clients first, then the indexers writing to the stores, then the stores
+    query_server_stop(server);
+    if (indexer) {
+        indexer_stop(indexer);
+        indexer_destroy(indexer);
+    }
+    extract_pool_stop();
+    if (path_indexer) {
+        indexer_stop(path_indexer);
+        indexer_destroy(path_indexer);
+    }
+    visual_search_destroy(visual_search);
+    semantic_search_destroy(semantic_search);
+    model_manager_release_clip(clip_engine);
+    model_manager_release_embedding(embedding_engine);
+    if (path_index) {
+        path_index_save(path_index);
+        path_index_close(path_index);
+    }
+    if (hash_cache) {
+        hash_cache_close(hash_cache);
+    }
+    volumes_destroy(volumes);
+    if (vectordb) {
+        vectordb_close(vectordb);
+    }
+    if (watch) {
+        fs_watch_stop(watch);
+        fs_watch_destroy(watch);
+    }
+    close(lock_fd);
+    return 0;
+}
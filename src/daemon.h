@@ -0,0 +1,26 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <stdbool.h>
+
+// Headless index daemon: `finder-plus --index-daemon`, run by launchd as a user agent
+// (assets/com.finderplus.indexer.plist). It keeps the filename index of $HOME current,
+// and the semantic index too when ai.semantic_search is set, whether or not a window
+// is open, in Darwin's background band. It serves both to the CLI and editors through
+// the query server, and saves the filename index as it changes so a window opens with
+// it current. While it runs the app's own indexer only follows changes instead of
+// rescanning at launch, and leaves saving the index to it
+
+// Run until SIGTERM or SIGINT; returns the exit status (0 if another daemon runs)
+int index_daemon_run(void);
+
+// Whether a daemon is running for this user
+bool index_daemon_running(void);
+
+// Share the semantic index of a folder tree through an index pack, without a window:
+// `finder-plus --export-index-pack FOLDER PACK` writes what is indexed under FOLDER,
+// `finder-plus --import-index-pack PACK FOLDER` indexes the packed tree mounted at
+// FOLDER here. Returns the exit status
+int index_pack_command(int argc, char *argv[]);
+
+#endif // DAEMON_H
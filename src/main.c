@@ -1,26 +1,93 @@
 #include "raylib.h"
 #include "app.h"
+#include "daemon.h"
+#include "ai/extract_pool.h"
+#include "ui/frame_bench.h"
+#include "utils/font.h"
+#include "utils/perf.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+// Replay a frame benchmark script in a hidden window:
+// --frame-bench SCRIPT [--fixtures DIR] [--json FILE] [--p99-budget MS]
+static int run_frame_bench(int argc, char *argv[])
+{
+    FrameBenchOptions options = {0};
+    options.fixture_root = FRAME_BENCH_DEFAULT_FIXTURES;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--frame-bench") == 0) {
+            options.script = argv[i + 1];
+        } else if (strcmp(argv[i], "--fixtures") == 0) {
+            options.fixture_root = argv[i + 1];
+        } else if (strcmp(argv[i], "--json") == 0) {
+            options.json = argv[i + 1];
+        } else if (strcmp(argv[i], "--p99-budget") == 0) {
+            options.p99_budget_ms = atof(argv[i + 1]);
+        }
+    }
+    if (!options.script) {
+        fprintf(stderr, "Usage: %s --frame-bench SCRIPT [--fixtures DIR] [--json FILE] [--p99-budget MS]\n",
+                argv[0]);
+        return 2;
+    }
+
+    // No vsync: frames are timed as fast as they can be drawn
+    SetTraceLogLevel(LOG_WARNING);
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(DEFAULT_WIDTH, DEFAULT_HEIGHT, APP_NAME);
+    SetExitKey(KEY_NULL);
+
+    App app = {0};
+    app_init(&app, options.fixture_root);
+    int status = frame_bench_run(&app, &options);
+    app_free(&app);
+    CloseWindow();
+    return status;
+}
+
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "--frame-bench") == 0) {
+        return run_frame_bench(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], EXTRACT_WORKER_ARG) == 0) {
+        return extract_worker_run();
+    }
+    if (argc > 1 && strcmp(argv[1], "--index-daemon") == 0) {
+        return index_daemon_run();
+    }
+    if (argc > 1 && (strcmp(argv[1], "--export-index-pack") == 0 ||
+                     strcmp(argv[1], "--import-index-pack") == 0)) {
+        return index_pack_command(argc, argv);
+    }
+
     // Parse command line arguments
     const char *start_path = NULL;
     if (argc > 1) {
         start_path = argv[1];
     }
 
+    // A window already open takes the folder as a tab, sharing its caches and models
+    if (app_forward_to_running(start_path)) {
+        return 0;
+    }
+
+    startup_begin();
+
     // Initialize window
+    double phase = startup_phase_begin();
     SetConfigFlags(FLAG_WINDOW_RESIZABLE | FLAG_VSYNC_HINT);
     InitWindow(DEFAULT_WIDTH, DEFAULT_HEIGHT, APP_NAME);
-    SetTargetFPS(60);
+    // The frame rate follows the display, see app_update_frame_pacing()
     SetExitKey(KEY_NULL); // Disable ESC to close
+    startup_phase_end("window", phase, false);
 
     // Initialize application state
     App app = {0};
     app_init(&app, start_path);
+    app_accept_windows(&app);
 
     // Update window title with current path
     char title[512];
@@ -28,11 +95,13 @@ int main(int argc, char *argv[])
     SetWindowTitle(title);
 
     // Main loop
+    bool first_frame = true;
     while (!WindowShouldClose() && !app.should_close) {
         // Handle window resize
         if (IsWindowResized()) {
             app.width = GetScreenWidth();
             app.height = GetScreenHeight();
+            font_layout_invalidate();
         }
 
         // Update window title when path changes
@@ -49,6 +118,10 @@ int main(int argc, char *argv[])
 
         // Draw
         app_draw(&app);
+        if (first_frame) {
+            startup_mark_first_frame();
+            first_frame = false;
+        }
     }
 
     // Cleanup
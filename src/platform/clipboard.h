@@ -5,16 +5,31 @@
 
 // Platform clipboard integration for cross-app copy/paste
 
+// Copies of more files than this are promised to the pasteboard rather than written:
+// each file's URL is made only when a reader asks for it. Promises end with the process,
+// so smaller copies are written out and stay pasteable after quitting
+#define PLATFORM_CLIPBOARD_PROMISE_MIN 256
+
+// Receives each file path on the system clipboard in turn; return false to stop
+typedef bool (*PlatformClipboardFileFn)(const char *path, void *context);
+
 // Initialize platform clipboard (call once at startup)
 void platform_clipboard_init(void);
 
-// Copy file paths to system clipboard (for cross-app paste)
+// Copy file paths to system clipboard (for cross-app paste); the paths are copied
 // Returns true on success
 bool platform_clipboard_copy_files(const char **paths, int count);
 
 // Check if system clipboard has files
 bool platform_clipboard_has_files(void);
 
+// Counter the system bumps whenever the clipboard's contents change
+long platform_clipboard_change_count(void);
+
+// Hand each file path on the system clipboard to fn as it is read, without collecting
+// them first; returns how many were handed over
+int platform_clipboard_each_file(PlatformClipboardFileFn fn, void *context);
+
 // Get file count from system clipboard
 int platform_clipboard_get_file_count(void);
 
@@ -5,12 +5,114 @@
 
 // Static buffers for return values
 #define MAX_PATH_LEN 4096
-#define MAX_FILES 128
 static char g_path_buffer[MAX_PATH_LEN];
 static char g_text_buffer[8192];
-static char *g_file_paths[MAX_FILES];
+static char **g_file_paths = NULL;      // Grown to however many files the pasteboard holds
+static int g_file_capacity = 0;
 static int g_file_count = 0;
 
+// Pasteboard items written per autorelease pool when promising or reading files
+#define CLIPBOARD_ITEM_CHUNK 1024
+
+// Promises a file URL per pasteboard item and makes each one only when a reader asks.
+// Holds its own copy of the paths, back to back
+@interface FPClipboardPromise : NSObject <NSPasteboardItemDataProvider>
+- (instancetype)initWithPaths:(const char **)paths count:(int)count;
+- (BOOL)writeToPasteboard:(NSPasteboard *)pasteboard;
+@end
+
+// The promise the pasteboard holds now (kept alive until it is done with it)
+static FPClipboardPromise *g_promise = nil;
+
+@implementation FPClipboardPromise {
+    char *_paths;
+    size_t *_offsets;
+    int _count;
+    NSMapTable *_indices;       // Pasteboard item (weak) -> index of its path
+}
+
+- (instancetype)initWithPaths:(const char **)paths count:(int)count
+{
+    self = [super init];
+    if (self == nil) {
+        return nil;
+    }
+
+    size_t size = 0;
+    for (int i = 0; i < count; i++) {
+        if (paths[i] != NULL) size += strlen(paths[i]) + 1;
+    }
+    _paths = malloc(size > 0 ? size : 1);
+    _offsets = malloc((size_t)count * sizeof(size_t));
+    if (_paths == NULL || _offsets == NULL) {
+        return nil;
+    }
+
+    size = 0;
+    for (int i = 0; i < count; i++) {
+        if (paths[i] == NULL) continue;
+        size_t len = strlen(paths[i]) + 1;
+        memcpy(_paths + size, paths[i], len);
+        _offsets[_count++] = size;
+        size += len;
+    }
+    _indices = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality
+                                     valueOptions:NSPointerFunctionsStrongMemory];
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_paths);
+    free(_offsets);
+}
+
+- (BOOL)writeToPasteboard:(NSPasteboard *)pasteboard
+{
+    if (_count == 0) {
+        return NO;
+    }
+
+    NSMutableArray *items = [NSMutableArray arrayWithCapacity:(NSUInteger)_count];
+    for (int start = 0; start < _count; start += CLIPBOARD_ITEM_CHUNK) {
+        @autoreleasepool {
+            int end = start + CLIPBOARD_ITEM_CHUNK < _count ? start + CLIPBOARD_ITEM_CHUNK : _count;
+            for (int i = start; i < end; i++) {
+                NSPasteboardItem *item = [[NSPasteboardItem alloc] init];
+                [item setDataProvider:self forTypes:@[NSPasteboardTypeFileURL]];
+                [_indices setObject:@(i) forKey:item];
+                [items addObject:item];
+            }
+        }
+    }
+    return [pasteboard writeObjects:items];
+}
+
+- (void)pasteboard:(NSPasteboard *)pasteboard item:(NSPasteboardItem *)item provideDataForType:(NSPasteboardType)type
+{
+    (void)pasteboard;
+    NSNumber *index = [_indices objectForKey:item];
+    if (index == nil) {
+        return;
+    }
+
+    NSString *pathStr = [NSString stringWithUTF8String:_paths + _offsets[index.intValue]];
+    NSURL *url = pathStr ? [NSURL fileURLWithPath:pathStr] : nil;
+    if (url) {
+        [item setString:[url absoluteString] forType:type];
+    }
+}
+
+- (void)pasteboardFinishedWithDataProvider:(NSPasteboard *)pasteboard
+{
+    (void)pasteboard;
+    if (g_promise == self) {
+        g_promise = nil;
+    }
+}
+
+@end
+
 void platform_clipboard_init(void)
 {
     // Nothing special needed for macOS
@@ -24,6 +126,18 @@ bool platform_clipboard_copy_files(const char **paths, int count)
 
     NSPasteboard *pasteboard = [NSPasteboard generalPasteboard];
     [pasteboard clearContents];
+    g_promise = nil;
+
+    if (count > PLATFORM_CLIPBOARD_PROMISE_MIN) {
+        @autoreleasepool {
+            FPClipboardPromise *promise = [[FPClipboardPromise alloc] initWithPaths:paths count:count];
+            if (promise == nil || ![promise writeToPasteboard:pasteboard]) {
+                return false;
+            }
+            g_promise = promise;
+            return true;
+        }
+    }
 
     NSMutableArray *urls = [NSMutableArray arrayWithCapacity:count];
 
@@ -45,6 +159,11 @@ bool platform_clipboard_copy_files(const char **paths, int count)
     return [pasteboard writeObjects:urls];
 }
 
+long platform_clipboard_change_count(void)
+{
+    return (long)[[NSPasteboard generalPasteboard] changeCount];
+}
+
 bool platform_clipboard_has_files(void)
 {
     NSPasteboard *pasteboard = [NSPasteboard generalPasteboard];
@@ -54,6 +173,33 @@ bool platform_clipboard_has_files(void)
     return [pasteboard canReadObjectForClasses:classes options:options];
 }
 
+int platform_clipboard_each_file(PlatformClipboardFileFn fn, void *context)
+{
+    NSArray<NSPasteboardItem *> *items = [[NSPasteboard generalPasteboard] pasteboardItems];
+    NSUInteger count = [items count];
+    int handed = 0;
+
+    // One item at a time, so a huge copy is never held as a list of URLs or paths
+    for (NSUInteger start = 0; start < count; start += CLIPBOARD_ITEM_CHUNK) {
+        @autoreleasepool {
+            NSUInteger end = start + CLIPBOARD_ITEM_CHUNK < count ? start + CLIPBOARD_ITEM_CHUNK : count;
+            for (NSUInteger i = start; i < end; i++) {
+                NSString *urlStr = [items[i] stringForType:NSPasteboardTypeFileURL];
+                NSURL *url = urlStr ? [NSURL URLWithString:urlStr] : nil;
+                if (url == nil || ![url isFileURL]) continue;
+
+                const char *path = [url fileSystemRepresentation];
+                if (path == NULL) continue;
+                handed++;
+                if (!fn(path, context)) {
+                    return handed;
+                }
+            }
+        }
+    }
+    return handed;
+}
+
 // Helper to clear cached file paths
 static void clear_cached_paths(void)
 {
@@ -81,8 +227,18 @@ static void load_file_paths(void)
         return;
     }
 
+    int needed = (int)[urls count];
+    if (needed > g_file_capacity) {
+        char **paths = realloc(g_file_paths, (size_t)needed * sizeof(char *));
+        if (paths == NULL) {
+            return;
+        }
+        g_file_paths = paths;
+        g_file_capacity = needed;
+    }
+
     for (NSURL *url in urls) {
-        if (g_file_count >= MAX_FILES) break;
+        if (g_file_count >= g_file_capacity) break;
 
         NSString *path = [url path];
         if (path) {
@@ -132,6 +288,7 @@ bool platform_clipboard_copy_text(const char *text)
 
     NSPasteboard *pasteboard = [NSPasteboard generalPasteboard];
     [pasteboard clearContents];
+    g_promise = nil;
 
     NSString *str = [NSString stringWithUTF8String:text];
     if (str == nil) {
@@ -165,5 +322,6 @@ void platform_clipboard_clear(void)
 {
     NSPasteboard *pasteboard = [NSPasteboard generalPasteboard];
     [pasteboard clearContents];
+    g_promise = nil;
     clear_cached_paths();
 }
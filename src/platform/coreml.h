@@ -0,0 +1,41 @@
+#ifndef PLATFORM_COREML_H
+#define PLATFORM_COREML_H
+
+#include <stdbool.h>
+
+// Core ML inference for compiled models (.mlmodelc). Core ML places the work on the
+// GPU and Neural Engine when allowed, which leaves the CPU to the UI during indexing
+
+typedef struct CoreMLModel CoreMLModel;
+
+// Element type of an input
+typedef enum CoreMLType {
+    COREML_INT32 = 0,
+    COREML_FLOAT32
+} CoreMLType;
+
+// One named input. data holds one value array per example, back to back, each shaped
+// as the model declares the input
+typedef struct CoreMLInput {
+    const char *name;
+    CoreMLType type;
+    const void *data;
+} CoreMLInput;
+
+// Load a compiled model; NULL if it is missing or Core ML rejects it. use_gpu lets
+// Core ML choose the GPU and Neural Engine, otherwise it runs on the CPU only
+CoreMLModel* coreml_model_load(const char *path, bool use_gpu);
+
+// Free a model
+void coreml_model_free(CoreMLModel *model);
+
+// Values in one example of the named input (0 if the model has no such input)
+int coreml_model_input_size(const CoreMLModel *model, const char *name);
+
+// Run count examples and copy the named output of example i, as floats, to
+// out + i * out_size. Fails if an output holds more than out_size values.
+// Predictions are serialized per model, so any thread may call this
+bool coreml_model_predict(CoreMLModel *model, const CoreMLInput *inputs, int input_count,
+                          int count, const char *output, float *out, int out_size);
+
+#endif // PLATFORM_COREML_H
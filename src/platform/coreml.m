@@ -0,0 +1,238 @@
+#import <Foundation/Foundation.h>
+#import <CoreML/CoreML.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "coreml.h"
+
+struct CoreMLModel {
+    void *model;                        // MLModel, retained across the C boundary
+    pthread_mutex_t mutex;              // One prediction at a time
+};
+
+static MLModel *model_object(const CoreMLModel *model)
+{
+    return (__bridge MLModel *)model->model;
+}
+
+CoreMLModel* coreml_model_load(const char *path, bool use_gpu)
+{
+    if (path == NULL) {
+        return NULL;
+    }
+
+    @autoreleasepool {
+        NSURL *url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:path]];
+        if (![[NSFileManager defaultManager] fileExistsAtPath:url.path]) {
+            return NULL;
+        }
+
+        MLModelConfiguration *configuration = [[MLModelConfiguration alloc] init];
+        configuration.computeUnits = use_gpu ? MLComputeUnitsAll : MLComputeUnitsCPUOnly;
+
+        NSError *error = nil;
+        MLModel *loaded = [MLModel modelWithContentsOfURL:url configuration:configuration error:&error];
+        if (loaded == nil) {
+            NSLog(@"Core ML: cannot load %s: %@", path, error.localizedDescription);
+            return NULL;
+        }
+
+        CoreMLModel *model = calloc(1, sizeof(CoreMLModel));
+        if (model == NULL) {
+            return NULL;
+        }
+        model->model = (void *)CFBridgingRetain(loaded);
+        pthread_mutex_init(&model->mutex, NULL);
+        return model;
+    }
+}
+
+void coreml_model_free(CoreMLModel *model)
+{
+    if (model == NULL) {
+        return;
+    }
+    CFBridgingRelease(model->model);
+    pthread_mutex_destroy(&model->mutex);
+    free(model);
+}
+
+// Helper: declared shape of a multiarray input (nil if there is no such input)
+static NSArray<NSNumber *> *input_shape(const CoreMLModel *model, const char *name)
+{
+    NSString *key = [NSString stringWithUTF8String:name];
+    MLFeatureDescription *description = model_object(model).modelDescription.inputDescriptionsByName[key];
+    if (description == nil || description.type != MLFeatureTypeMultiArray) {
+        return nil;
+    }
+    return description.multiArrayConstraint.shape;
+}
+
+static NSInteger shape_count(NSArray<NSNumber *> *shape)
+{
+    NSInteger count = 1;
+    for (NSNumber *dimension in shape) {
+        count *= dimension.integerValue;
+    }
+    return count;
+}
+
+int coreml_model_input_size(const CoreMLModel *model, const char *name)
+{
+    if (model == NULL || name == NULL) {
+        return 0;
+    }
+    @autoreleasepool {
+        NSArray<NSNumber *> *shape = input_shape(model, name);
+        return shape != nil ? (int)shape_count(shape) : 0;
+    }
+}
+
+// Helper: widen an IEEE half (Core ML on the Neural Engine returns these)
+static float half_to_float(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+
+    if (exponent == 0) {
+        // Zero or subnormal
+        float value = ldexpf((float)mantissa, -24);
+        return sign ? -value : value;
+    }
+    uint32_t bits = exponent == 0x1f ? sign | 0x7f800000 | (mantissa << 13)
+                                     : sign | ((exponent + 112) << 23) | (mantissa << 13);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Helper: read element offset of a multiarray as a float
+static float read_element(const void *bytes, MLMultiArrayDataType type, NSInteger offset)
+{
+    switch (type) {
+        case MLMultiArrayDataTypeDouble:  return (float)((const double *)bytes)[offset];
+        case MLMultiArrayDataTypeInt32:   return (float)((const int32_t *)bytes)[offset];
+        case MLMultiArrayDataTypeFloat16: return half_to_float(((const uint16_t *)bytes)[offset]);
+        default:                          return ((const float *)bytes)[offset];
+    }
+}
+
+// Helper: copy a multiarray to floats in row-major order, honouring its strides
+static bool copy_output(MLMultiArray *array, float *out, int out_size)
+{
+    NSInteger count = array.count;
+    NSInteger rank = (NSInteger)array.shape.count;
+    if (count > out_size || rank == 0) {
+        return false;
+    }
+
+    NSInteger shape[rank];
+    NSInteger strides[rank];
+    NSInteger index[rank];
+    for (NSInteger d = 0; d < rank; d++) {
+        shape[d] = array.shape[(NSUInteger)d].integerValue;
+        strides[d] = array.strides[(NSUInteger)d].integerValue;
+        index[d] = 0;
+    }
+
+    MLMultiArrayDataType type = array.dataType;
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+    const void *bytes = array.dataPointer;
+#pragma clang diagnostic pop
+
+    for (NSInteger n = 0; n < count; n++) {
+        NSInteger offset = 0;
+        for (NSInteger d = 0; d < rank; d++) {
+            offset += index[d] * strides[d];
+        }
+        out[n] = read_element(bytes, type, offset);
+
+        for (NSInteger d = rank - 1; d >= 0; d--) {
+            if (++index[d] < shape[d]) {
+                break;
+            }
+            index[d] = 0;
+        }
+    }
+    return true;
+}
+
+bool coreml_model_predict(CoreMLModel *model, const CoreMLInput *inputs, int input_count,
+                          int count, const char *output, float *out, int out_size)
+{
+    if (model == NULL || inputs == NULL || input_count <= 0 || count <= 0 || output == NULL || out == NULL) {
+        return false;
+    }
+
+    @autoreleasepool {
+        // Shapes and names resolved once for every example
+        NSMutableArray<NSString *> *names = [NSMutableArray arrayWithCapacity:(NSUInteger)input_count];
+        NSMutableArray<NSArray<NSNumber *> *> *shapes = [NSMutableArray arrayWithCapacity:(NSUInteger)input_count];
+        for (int i = 0; i < input_count; i++) {
+            NSArray<NSNumber *> *shape = input_shape(model, inputs[i].name);
+            if (shape == nil) {
+                return false;
+            }
+            [names addObject:[NSString stringWithUTF8String:inputs[i].name]];
+            [shapes addObject:shape];
+        }
+
+        NSMutableArray<id<MLFeatureProvider>> *examples = [NSMutableArray arrayWithCapacity:(NSUInteger)count];
+        for (int e = 0; e < count; e++) {
+            NSMutableDictionary<NSString *, MLFeatureValue *> *features =
+                [NSMutableDictionary dictionaryWithCapacity:(NSUInteger)input_count];
+
+            for (int i = 0; i < input_count; i++) {
+                bool is_int = inputs[i].type == COREML_INT32;
+                NSError *error = nil;
+                MLMultiArray *array = [[MLMultiArray alloc]
+                    initWithShape:shapes[(NSUInteger)i]
+                         dataType:is_int ? MLMultiArrayDataTypeInt32 : MLMultiArrayDataTypeFloat32
+                            error:&error];
+                if (array == nil) {
+                    return false;
+                }
+
+                // A fresh array is contiguous, so one copy fills it
+                size_t bytes = (size_t)array.count * (is_int ? sizeof(int32_t) : sizeof(float));
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+                memcpy(array.dataPointer, (const char *)inputs[i].data + bytes * (size_t)e, bytes);
+#pragma clang diagnostic pop
+                features[names[(NSUInteger)i]] = [MLFeatureValue featureValueWithMultiArray:array];
+            }
+
+            NSError *error = nil;
+            MLDictionaryFeatureProvider *provider =
+                [[MLDictionaryFeatureProvider alloc] initWithDictionary:features error:&error];
+            if (provider == nil) {
+                return false;
+            }
+            [examples addObject:provider];
+        }
+
+        MLArrayBatchProvider *batch = [[MLArrayBatchProvider alloc] initWithFeatureProviderArray:examples];
+        NSError *error = nil;
+
+        pthread_mutex_lock(&model->mutex);
+        id<MLBatchProvider> results = [model_object(model) predictionsFromBatch:batch error:&error];
+        pthread_mutex_unlock(&model->mutex);
+
+        if (results == nil || results.count != count) {
+            NSLog(@"Core ML: prediction failed: %@", error.localizedDescription);
+            return false;
+        }
+
+        NSString *output_name = [NSString stringWithUTF8String:output];
+        for (int e = 0; e < count; e++) {
+            MLMultiArray *array = [[results featuresAtIndex:e] featureValueForName:output_name].multiArrayValue;
+            if (array == nil || !copy_output(array, out + (size_t)e * (size_t)out_size, out_size)) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
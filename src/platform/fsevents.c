@@ -27,6 +27,7 @@ struct FSEventsWatcher {
 
     // Configuration
     double latency;
+    uint64_t since;             // Start ID for the next stream, 0 for now
 };
 
 // FSEvents callback function
@@ -54,6 +55,26 @@ static void fsevents_callback(ConstFSEventStreamRef streamRef,
         FSEventStreamEventFlags flags = eventFlags[i];
         bool is_dir = flags & kFSEventStreamEventFlagItemIsDir;
 
+        // End of a replay: carries no path
+        if (flags & kFSEventStreamEventFlagHistoryDone) {
+            event.path[0] = '\0';
+            event.type = FSEVENT_UNKNOWN;
+            event.flags = FSEVENT_FLAG_HISTORY_DONE;
+            watcher->callback(&event, watcher->user_data);
+            continue;
+        }
+
+        // Coalesced or dropped events, or a wrapped ID counter: only a rescan is exact
+        if (flags & (kFSEventStreamEventFlagMustScanSubDirs |
+                     kFSEventStreamEventFlagUserDropped |
+                     kFSEventStreamEventFlagKernelDropped |
+                     kFSEventStreamEventFlagEventIdsWrapped)) {
+            event.type = FSEVENT_UNKNOWN;
+            event.flags = FSEVENT_FLAG_IS_DIR | FSEVENT_FLAG_MUST_SCAN;
+            watcher->callback(&event, watcher->user_data);
+            continue;
+        }
+
         // Set file/directory flags (common to all event types)
         event.flags |= is_dir ? FSEVENT_FLAG_IS_DIR : FSEVENT_FLAG_IS_FILE;
         if (flags & kFSEventStreamEventFlagItemIsSymlink) {
@@ -110,7 +131,8 @@ static bool create_fsevents_stream(FSEventsWatcher *watcher)
                                           fsevents_callback,
                                           &context,
                                           paths_array,
-                                          kFSEventStreamEventIdSinceNow,
+                                          watcher->since ? (FSEventStreamEventId)watcher->since
+                                                         : kFSEventStreamEventIdSinceNow,
                                           watcher->latency,
                                           kFSEventStreamCreateFlagFileEvents |
                                           kFSEventStreamCreateFlagNoDefer);
@@ -318,6 +340,26 @@ void fsevents_set_latency(FSEventsWatcher *watcher, double latency)
     pthread_mutex_unlock(&watcher->mutex);
 }
 
+void fsevents_set_since(FSEventsWatcher *watcher, uint64_t event_id)
+{
+    if (watcher == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&watcher->mutex);
+
+    if (!watcher->running) {
+        watcher->since = event_id;
+    }
+
+    pthread_mutex_unlock(&watcher->mutex);
+}
+
+uint64_t fsevents_current_event_id(void)
+{
+    return (uint64_t)FSEventsGetCurrentEventId();
+}
+
 const char* fsevents_type_name(FSEventType type)
 {
     switch (type) {
@@ -24,7 +24,9 @@ typedef enum FSEventFlags {
     FSEVENT_FLAG_IS_FILE      = (1 << 1),
     FSEVENT_FLAG_IS_SYMLINK   = (1 << 2),
     FSEVENT_FLAG_ITEM_RENAMED = (1 << 3),
-    FSEVENT_FLAG_ITEM_REMOVED = (1 << 4)
+    FSEVENT_FLAG_ITEM_REMOVED = (1 << 4),
+    FSEVENT_FLAG_MUST_SCAN    = (1 << 5),  // Events below path were lost: rescan it
+    FSEVENT_FLAG_HISTORY_DONE = (1 << 6)   // Replay since the start ID is complete (no path)
 } FSEventFlags;
 
 // Event structure
@@ -68,6 +70,12 @@ bool fsevents_is_running(const FSEventsWatcher *watcher);
 // Set latency (seconds) - how long to batch events before callback
 void fsevents_set_latency(FSEventsWatcher *watcher, double latency);
 
+// Replay changes after event_id on the next start (0 = only new changes)
+void fsevents_set_since(FSEventsWatcher *watcher, uint64_t event_id);
+
+// Most recent event ID on the system; a checkpoint newer than this is from a reset journal
+uint64_t fsevents_current_event_id(void);
+
 // Get event type name
 const char* fsevents_type_name(FSEventType type);
 
@@ -0,0 +1,33 @@
+#ifndef PLATFORM_IMAGEIO_H
+#define PLATFORM_IMAGEIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Decode an image file to packed RGB with its longest side at most max_size pixels,
+// upright per its EXIF orientation. A preview embedded in the file (the JPEG inside a
+// RAW, a HEIC thumbnail) is used instead of the image when it is nearly max_size or
+// larger, so RAW files are never developed for a thumbnail; otherwise ImageIO decodes
+// straight to the reduced size (JPEG DCT scaling), which is far cheaper than decoding a
+// large photo and resizing it. *rgb is malloc'd (width * height * 3 bytes); the original
+// dimensions go to original_width/height when those are not NULL
+bool platform_load_image_scaled(const char *path, int max_size, unsigned char **rgb,
+                                int *width, int *height, int *original_width, int *original_height);
+
+// Bits per pixel of an image file as stored (24 for 8-bit RGB, 32 with alpha), read
+// from its header without decoding; 0 if unknown
+int platform_image_bit_depth(const char *path);
+
+// When a photo was taken ("YYYY-MM-DD HH:MM", from EXIF) and with what camera ("Make
+// Model", from TIFF), read from its header without decoding. Either is "" when the file
+// does not record it; false if it records neither
+bool platform_image_capture_info(const char *path, char *date, size_t date_size,
+                                 char *camera, size_t camera_size);
+
+// Re-encode an image file as JPEG with its longest side at most max_size pixels, upright
+// per its EXIF orientation, at quality 0..1. Decodes at the reduced size as above.
+// *data is malloc'd
+bool platform_encode_image_jpeg(const char *path, int max_size, float quality,
+                                unsigned char **data, size_t *size);
+
+#endif // PLATFORM_IMAGEIO_H
@@ -0,0 +1,300 @@
+#import <Foundation/Foundation.h>
+#import <ImageIO/ImageIO.h>
+#import <CoreGraphics/CoreGraphics.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "imageio.h"
+
+// Helper: read an integer image property
+static int image_property(CFDictionaryRef properties, CFStringRef key)
+{
+    int value = 0;
+    CFNumberRef number = properties != NULL ? CFDictionaryGetValue(properties, key) : NULL;
+    if (number != NULL) {
+        CFNumberGetValue(number, kCFNumberIntType, &value);
+    }
+    return value;
+}
+
+// Helper: copy a string image property into out ("" if missing); returns its length
+static size_t image_string_property(CFDictionaryRef properties, CFStringRef key, char *out, size_t out_size)
+{
+    out[0] = '\0';
+    CFStringRef value = properties != NULL ? CFDictionaryGetValue(properties, key) : NULL;
+    if (value == NULL || CFGetTypeID(value) != CFStringGetTypeID() ||
+        !CFStringGetCString(value, out, (CFIndex)out_size, kCFStringEncodingUTF8)) {
+        out[0] = '\0';
+    }
+    return strlen(out);
+}
+
+// An embedded preview this much smaller than asked for still serves; RAW previews are
+// often a little under the pane's size, and a full RAW decode costs ten times more
+#define EMBEDDED_PREVIEW_SLACK 0.75
+
+// Helper: the preview embedded in the file (a RAW camera's JPEG, a HEIC or EXIF
+// thumbnail) at reduced size, upright, if it is large enough for max_size; nothing is
+// decoded from the image itself. NULL if there is none or it is too small
+static CGImageRef create_embedded_preview(CGImageSourceRef source, int max_size, int original_longest)
+{
+    // Without either "create from image" option, ImageIO only returns an embedded thumbnail
+    NSDictionary *options = @{
+        (__bridge NSString *)kCGImageSourceCreateThumbnailWithTransform: @YES,
+        (__bridge NSString *)kCGImageSourceShouldCacheImmediately: @NO,
+        (__bridge NSString *)kCGImageSourceThumbnailMaxPixelSize: @(max_size),
+    };
+    CGImageRef image = CGImageSourceCreateThumbnailAtIndex(source, 0, (__bridge CFDictionaryRef)options);
+    if (image == NULL) {
+        return NULL;
+    }
+
+    size_t width = CGImageGetWidth(image);
+    size_t height = CGImageGetHeight(image);
+    double longest = (double)(width > height ? width : height);
+    double wanted = max_size * EMBEDDED_PREVIEW_SLACK;
+    if (original_longest > 0 && original_longest < wanted) {
+        wanted = original_longest;
+    }
+    if (longest < wanted) {
+        CGImageRelease(image);
+        return NULL;
+    }
+    return image;
+}
+
+// Helper: decode an image at reduced size, upright, from its embedded preview when that
+// is large enough; the original dimensions go to original_width/height when those are
+// not NULL. NULL on failure
+static CGImageRef create_scaled_image(const char *path, int max_size, int *original_width, int *original_height)
+{
+    NSURL *url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:path]];
+    NSDictionary *source_options = @{ (__bridge NSString *)kCGImageSourceShouldCache: @NO };
+    CGImageSourceRef source = CGImageSourceCreateWithURL((__bridge CFURLRef)url,
+                                                         (__bridge CFDictionaryRef)source_options);
+    if (source == NULL) {
+        return NULL;
+    }
+
+    CFDictionaryRef properties = CGImageSourceCopyPropertiesAtIndex(source, 0, NULL);
+    int pixel_width = image_property(properties, kCGImagePropertyPixelWidth);
+    int pixel_height = image_property(properties, kCGImagePropertyPixelHeight);
+    if (original_width != NULL) {
+        *original_width = pixel_width;
+    }
+    if (original_height != NULL) {
+        *original_height = pixel_height;
+    }
+    if (properties != NULL) {
+        CFRelease(properties);
+    }
+
+    CGImageRef preview = create_embedded_preview(source, max_size,
+                                                 pixel_width > pixel_height ? pixel_width : pixel_height);
+    if (preview != NULL) {
+        CFRelease(source);
+        return preview;
+    }
+
+    NSDictionary *thumbnail_options = @{
+        (__bridge NSString *)kCGImageSourceCreateThumbnailFromImageAlways: @YES,
+        (__bridge NSString *)kCGImageSourceCreateThumbnailWithTransform: @YES,
+        (__bridge NSString *)kCGImageSourceShouldCacheImmediately: @NO,
+        (__bridge NSString *)kCGImageSourceThumbnailMaxPixelSize: @(max_size),
+    };
+    CGImageRef image = CGImageSourceCreateThumbnailAtIndex(source, 0, (__bridge CFDictionaryRef)thumbnail_options);
+    CFRelease(source);
+    return image;
+}
+
+bool platform_load_image_scaled(const char *path, int max_size, unsigned char **rgb,
+                                int *width, int *height, int *original_width, int *original_height)
+{
+    if (path == NULL || max_size <= 0 || rgb == NULL || width == NULL || height == NULL) {
+        return false;
+    }
+    *rgb = NULL;
+
+    @autoreleasepool {
+        CGImageRef image = create_scaled_image(path, max_size, original_width, original_height);
+        if (image == NULL) {
+            return false;
+        }
+
+        size_t w = CGImageGetWidth(image);
+        size_t h = CGImageGetHeight(image);
+        unsigned char *rgba = malloc(w * h * 4);
+        if (rgba == NULL) {
+            CGImageRelease(image);
+            return false;
+        }
+
+        // Draw into a known layout whatever the source format (indexed, 16-bit, CMYK...)
+        CGColorSpaceRef space = CGColorSpaceCreateWithName(kCGColorSpaceSRGB);
+        CGContextRef context = CGBitmapContextCreate(rgba, w, h, 8, w * 4, space,
+                                                     (CGBitmapInfo)kCGImageAlphaNoneSkipLast);
+        CGColorSpaceRelease(space);
+        if (context == NULL) {
+            free(rgba);
+            CGImageRelease(image);
+            return false;
+        }
+        // Transparent areas come out white, as they look in Finder
+        CGContextSetRGBFillColor(context, 1.0, 1.0, 1.0, 1.0);
+        CGContextFillRect(context, CGRectMake(0, 0, (CGFloat)w, (CGFloat)h));
+        CGContextDrawImage(context, CGRectMake(0, 0, (CGFloat)w, (CGFloat)h), image);
+        CGContextRelease(context);
+        CGImageRelease(image);
+
+        // Pack RGBX down to RGB in place
+        for (size_t i = 0; i < w * h; i++) {
+            rgba[i * 3 + 0] = rgba[i * 4 + 0];
+            rgba[i * 3 + 1] = rgba[i * 4 + 1];
+            rgba[i * 3 + 2] = rgba[i * 4 + 2];
+        }
+
+        *rgb = rgba;
+        *width = (int)w;
+        *height = (int)h;
+        if (original_width != NULL && *original_width == 0) {
+            *original_width = (int)w;
+        }
+        if (original_height != NULL && *original_height == 0) {
+            *original_height = (int)h;
+        }
+        return true;
+    }
+}
+
+int platform_image_bit_depth(const char *path)
+{
+    if (path == NULL) {
+        return 0;
+    }
+
+    @autoreleasepool {
+        NSURL *url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:path]];
+        NSDictionary *source_options = @{ (__bridge NSString *)kCGImageSourceShouldCache: @NO };
+        CGImageSourceRef source = CGImageSourceCreateWithURL((__bridge CFURLRef)url,
+                                                             (__bridge CFDictionaryRef)source_options);
+        if (source == NULL) {
+            return 0;
+        }
+
+        CFDictionaryRef properties = CGImageSourceCopyPropertiesAtIndex(source, 0, NULL);
+        CFRelease(source);
+        if (properties == NULL) {
+            return 0;
+        }
+
+        int depth = image_property(properties, kCGImagePropertyDepth);
+        CFStringRef model = CFDictionaryGetValue(properties, kCGImagePropertyColorModel);
+        int components = 3;
+        if (model != NULL && CFEqual(model, kCGImagePropertyColorModelGray)) {
+            components = 1;
+        } else if (model != NULL && CFEqual(model, kCGImagePropertyColorModelCMYK)) {
+            components = 4;
+        }
+        CFBooleanRef alpha = CFDictionaryGetValue(properties, kCGImagePropertyHasAlpha);
+        if (alpha != NULL && CFBooleanGetValue(alpha)) {
+            components++;
+        }
+        CFRelease(properties);
+        return depth * components;
+    }
+}
+
+bool platform_image_capture_info(const char *path, char *date, size_t date_size,
+                                 char *camera, size_t camera_size)
+{
+    if (path == NULL || date == NULL || date_size == 0 || camera == NULL || camera_size == 0) {
+        return false;
+    }
+    date[0] = '\0';
+    camera[0] = '\0';
+
+    @autoreleasepool {
+        NSURL *url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:path]];
+        NSDictionary *source_options = @{ (__bridge NSString *)kCGImageSourceShouldCache: @NO };
+        CGImageSourceRef source = CGImageSourceCreateWithURL((__bridge CFURLRef)url,
+                                                             (__bridge CFDictionaryRef)source_options);
+        if (source == NULL) {
+            return false;
+        }
+
+        CFDictionaryRef properties = CGImageSourceCopyPropertiesAtIndex(source, 0, NULL);
+        CFRelease(source);
+        if (properties == NULL) {
+            return false;
+        }
+
+        // EXIF writes "YYYY:MM:DD HH:MM:SS"
+        char taken[32];
+        CFDictionaryRef exif = CFDictionaryGetValue(properties, kCGImagePropertyExifDictionary);
+        if (image_string_property(exif, kCGImagePropertyExifDateTimeOriginal, taken, sizeof(taken)) >= 16) {
+            taken[4] = '-';
+            taken[7] = '-';
+            taken[16] = '\0';
+            snprintf(date, date_size, "%s", taken);
+        }
+
+        // Most makers repeat their name in the model ("Canon" "Canon EOS R5")
+        char make[64], model[64];
+        CFDictionaryRef tiff = CFDictionaryGetValue(properties, kCGImagePropertyTIFFDictionary);
+        image_string_property(tiff, kCGImagePropertyTIFFMake, make, sizeof(make));
+        image_string_property(tiff, kCGImagePropertyTIFFModel, model, sizeof(model));
+        if (make[0] != '\0' && model[0] != '\0' && strncasecmp(model, make, strlen(make)) != 0) {
+            snprintf(camera, camera_size, "%s %s", make, model);
+        } else {
+            snprintf(camera, camera_size, "%s", model[0] != '\0' ? model : make);
+        }
+        CFRelease(properties);
+        return date[0] != '\0' || camera[0] != '\0';
+    }
+}
+
+bool platform_encode_image_jpeg(const char *path, int max_size, float quality,
+                                unsigned char **data, size_t *size)
+{
+    if (path == NULL || max_size <= 0 || data == NULL || size == NULL) {
+        return false;
+    }
+    *data = NULL;
+    *size = 0;
+
+    @autoreleasepool {
+        CGImageRef image = create_scaled_image(path, max_size, NULL, NULL);
+        if (image == NULL) {
+            return false;
+        }
+
+        CFMutableDataRef encoded = CFDataCreateMutable(kCFAllocatorDefault, 0);
+        CGImageDestinationRef destination = encoded != NULL
+            ? CGImageDestinationCreateWithData(encoded, CFSTR("public.jpeg"), 1, NULL) : NULL;
+        bool ok = false;
+        if (destination != NULL) {
+            NSDictionary *properties = @{
+                (__bridge NSString *)kCGImageDestinationLossyCompressionQuality: @(quality),
+            };
+            CGImageDestinationAddImage(destination, image, (__bridge CFDictionaryRef)properties);
+            ok = CGImageDestinationFinalize(destination);
+            CFRelease(destination);
+        }
+        CGImageRelease(image);
+
+        if (ok) {
+            size_t length = (size_t)CFDataGetLength(encoded);
+            *data = malloc(length);
+            if (*data != NULL) {
+                memcpy(*data, CFDataGetBytePtr(encoded), length);
+                *size = length;
+            }
+            ok = *data != NULL;
+        }
+        if (encoded != NULL) {
+            CFRelease(encoded);
+        }
+        return ok;
+    }
+}
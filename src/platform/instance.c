@@ -0,0 +1,312 @@
+#include "instance.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define INSTANCE_PATH_MAX 4096
+#define INSTANCE_QUEUE 8               // Folders waiting for the main loop
+#define INSTANCE_STARTUP_WAIT 2.0      // Seconds to wait for an instance still starting
+#define INSTANCE_IO_TIMEOUT 1          // Seconds either side waits for the other
+
+struct InstanceServer {
+    int listen_fd;
+    int lock_fd;
+    int stop_pipe[2];
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    void (*wake)(void);
+    char socket_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    char queue[INSTANCE_QUEUE][INSTANCE_PATH_MAX];
+    int head;
+    int count;
+};
+
+// Helper: Fill a socket address; false if the path does not fit
+static bool instance_address(const char *socket_path, struct sockaddr_un *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr->sun_path)) {
+        return false;
+    }
+    strcpy(addr->sun_path, socket_path);
+    return true;
+}
+
+// Helper: Path of the lock file held by the listening instance
+static void instance_lock_path(const char *socket_path, char *out, size_t size)
+{
+    snprintf(out, size, "%s.lock", socket_path);
+}
+
+// Helper: Bound the time a peer can hold the other side up
+static void instance_set_timeouts(int fd)
+{
+    struct timeval timeout = { INSTANCE_IO_TIMEOUT, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+}
+
+// Helper: Write all of length bytes; false on error or timeout
+static bool instance_write_all(int fd, const char *data, size_t length)
+{
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+// Helper: True while some process holds the lock file (it is listening or about to)
+static bool instance_owner_running(const char *socket_path)
+{
+    char lock_path[INSTANCE_PATH_MAX];
+    instance_lock_path(socket_path, lock_path, sizeof(lock_path));
+    int fd = open(lock_path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool held = flock(fd, LOCK_EX | LOCK_NB) != 0 && errno == EWOULDBLOCK;
+    close(fd);
+    return held;
+}
+
+// Helper: Connect to a listening instance; -1 if none accepts
+static int instance_connect(const char *socket_path)
+{
+    struct sockaddr_un addr;
+    if (!instance_address(socket_path, &addr)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    instance_set_timeouts(fd);
+    return fd;
+}
+
+bool instance_forward(const char *socket_path, const char *path)
+{
+    if (!socket_path || !path || strlen(path) >= INSTANCE_PATH_MAX) {
+        return false;
+    }
+
+    // An instance that holds the lock but has not bound its socket yet gets a moment
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int fd;
+    while ((fd = instance_connect(socket_path)) < 0) {
+        if (!instance_owner_running(socket_path)) {
+            return false;
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double waited = (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+        if (waited > INSTANCE_STARTUP_WAIT) {
+            return false;
+        }
+        nanosleep(&(struct timespec){ 0, 50 * 1000000L }, NULL);
+    }
+
+    // The folder ends with a newline; the listener answers '1' once it has taken it
+    bool sent = instance_write_all(fd, path, strlen(path)) && instance_write_all(fd, "\n", 1);
+    char reply = '0';
+    ssize_t got;
+    do {
+        got = sent ? read(fd, &reply, 1) : -1;
+    } while (got < 0 && errno == EINTR);
+    close(fd);
+    return got == 1 && reply == '1';
+}
+
+// Helper: Read one folder from a client and queue it
+static void instance_serve(InstanceServer *server, int client)
+{
+    instance_set_timeouts(client);
+
+    char path[INSTANCE_PATH_MAX];
+    size_t length = 0;
+    bool complete = false;
+    while (length < sizeof(path)) {
+        ssize_t got = read(client, path + length, sizeof(path) - length);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        char *newline = memchr(path + length, '\n', (size_t)got);
+        length += (size_t)got;
+        if (newline) {
+            *newline = '\0';
+            complete = true;
+            break;
+        }
+    }
+
+    // Only absolute paths, or "" for the default folder
+    bool valid = complete && (path[0] == '\0' || path[0] == '/');
+    bool queued = false;
+    if (valid) {
+        pthread_mutex_lock(&server->mutex);
+        if (server->count < INSTANCE_QUEUE) {
+            int slot = (server->head + server->count) % INSTANCE_QUEUE;
+            strcpy(server->queue[slot], path);
+            server->count++;
+            queued = true;
+        }
+        pthread_mutex_unlock(&server->mutex);
+    }
+
+    if (queued && server->wake) {
+        server->wake();
+    }
+    instance_write_all(client, queued ? "1" : "0", 1);
+}
+
+// Thread function: Accept clients until stopped
+static void *instance_thread(void *arg)
+{
+    InstanceServer *server = (InstanceServer *)arg;
+
+    for (;;) {
+        struct pollfd fds[2] = {
+            { .fd = server->listen_fd, .events = POLLIN },
+            { .fd = server->stop_pipe[0], .events = POLLIN },
+        };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        int client = accept(server->listen_fd, NULL, NULL);
+        if (client < 0) {
+            continue;
+        }
+        instance_serve(server, client);
+        close(client);
+    }
+    return NULL;
+}
+
+InstanceServer* instance_listen(const char *socket_path, void (*wake)(void))
+{
+    struct sockaddr_un addr;
+    if (!socket_path || !instance_address(socket_path, &addr)) {
+        return NULL;
+    }
+
+    InstanceServer *server = calloc(1, sizeof(InstanceServer));
+    if (!server) {
+        return NULL;
+    }
+    server->listen_fd = -1;
+    server->stop_pipe[0] = server->stop_pipe[1] = -1;
+    server->wake = wake;
+    strcpy(server->socket_path, socket_path);
+
+    // Whoever holds the lock owns the socket; a socket left by a crash is replaced
+    char lock_path[INSTANCE_PATH_MAX];
+    instance_lock_path(socket_path, lock_path, sizeof(lock_path));
+    server->lock_fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (server->lock_fd < 0 || flock(server->lock_fd, LOCK_EX | LOCK_NB) != 0) {
+        goto fail;
+    }
+    unlink(socket_path);
+
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server->listen_fd < 0 ||
+        bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        goto fail;
+    }
+    chmod(socket_path, 0600);
+    if (listen(server->listen_fd, INSTANCE_QUEUE) != 0 || pipe(server->stop_pipe) != 0) {
+        goto fail;
+    }
+    fcntl(server->listen_fd, F_SETFD, FD_CLOEXEC);
+    fcntl(server->stop_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(server->stop_pipe[1], F_SETFD, FD_CLOEXEC);
+
+    pthread_mutex_init(&server->mutex, NULL);
+    if (pthread_create(&server->thread, NULL, instance_thread, server) != 0) {
+        pthread_mutex_destroy(&server->mutex);
+        goto fail;
+    }
+    return server;
+
+fail:
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+        unlink(socket_path);
+    }
+    if (server->stop_pipe[0] >= 0) {
+        close(server->stop_pipe[0]);
+        close(server->stop_pipe[1]);
+    }
+    if (server->lock_fd >= 0) {
+        close(server->lock_fd);
+    }
+    free(server);
+    return NULL;
+}
+
+bool instance_take(InstanceServer *server, char *path, size_t size)
+{
+    if (!server || !path || size == 0) {
+        return false;
+    }
+
+    pthread_mutex_lock(&server->mutex);
+    bool taken = server->count > 0;
+    if (taken) {
+        snprintf(path, size, "%s", server->queue[server->head]);
+        server->head = (server->head + 1) % INSTANCE_QUEUE;
+        server->count--;
+    }
+    pthread_mutex_unlock(&server->mutex);
+    return taken;
+}
+
+void instance_stop(InstanceServer *server)
+{
+    if (!server) {
+        return;
+    }
+
+    instance_write_all(server->stop_pipe[1], "x", 1);
+    pthread_join(server->thread, NULL);
+
+    // The socket goes before the lock, so a new instance never finds ours dangling
+    close(server->listen_fd);
+    unlink(server->socket_path);
+    close(server->stop_pipe[0]);
+    close(server->stop_pipe[1]);
+    close(server->lock_fd);
+    pthread_mutex_destroy(&server->mutex);
+    free(server);
+}
@@ -0,0 +1,30 @@
+#ifndef PLATFORM_INSTANCE_H
+#define PLATFORM_INSTANCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// One process for every window the user opens. The first instance listens on a Unix
+// socket and holds a lock file next to it (socket path + ".lock"); a later launch hands
+// its folder over the socket and exits, so every window shares one set of caches,
+// models and indexes instead of loading its own. Folders arrive on a listener thread
+// and are taken by the main loop, which opens each in a tab
+
+// Listener (opaque)
+typedef struct InstanceServer InstanceServer;
+
+// Hand path (absolute, or "" for the default folder) to the instance listening on
+// socket_path; false when none is running and this process should open its own window
+bool instance_forward(const char *socket_path, const char *path);
+
+// Listen on socket_path, calling wake (from the listener thread) when a folder arrives;
+// NULL if another instance already listens there or the socket cannot be made
+InstanceServer* instance_listen(const char *socket_path, void (*wake)(void));
+
+// Take the next folder handed over; false when none is waiting
+bool instance_take(InstanceServer *server, char *path, size_t size);
+
+// Stop listening and remove the socket
+void instance_stop(InstanceServer *server);
+
+#endif // PLATFORM_INSTANCE_H
@@ -0,0 +1,61 @@
+#include "memory_pressure.h"
+#include "wake.h"
+
+#include <dispatch/dispatch.h>
+#include <stdatomic.h>
+
+static dispatch_source_t g_source = NULL;
+static atomic_int g_pending = PLATFORM_MEMORY_NORMAL;   // Highest level not yet taken
+
+// Helper: Record a pressure change (dispatch queue)
+static void memory_pressure_changed(void *context)
+{
+    unsigned long flags = dispatch_source_get_data((dispatch_source_t)context);
+    int level = (flags & DISPATCH_MEMORYPRESSURE_CRITICAL) ? PLATFORM_MEMORY_CRITICAL
+              : (flags & DISPATCH_MEMORYPRESSURE_WARN) ? PLATFORM_MEMORY_WARN
+              : PLATFORM_MEMORY_NORMAL;
+    if (level == PLATFORM_MEMORY_NORMAL) return;
+
+    int pending = atomic_load(&g_pending);
+    while (pending < level && !atomic_compare_exchange_weak(&g_pending, &pending, level)) {
+    }
+    platform_wake_main_loop();
+}
+
+// Helper: Free the source once it is cancelled and no handler runs (dispatch queue)
+static void memory_pressure_cancelled(void *context)
+{
+    dispatch_release((dispatch_source_t)context);
+}
+
+bool platform_memory_pressure_start(void)
+{
+    if (g_source) return true;
+
+    dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+    g_source = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                                      DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL,
+                                      queue);
+    if (!g_source) return false;
+
+    // The source is its own context, so a handler still running after stop has it
+    dispatch_set_context(g_source, g_source);
+    dispatch_source_set_event_handler_f(g_source, memory_pressure_changed);
+    dispatch_source_set_cancel_handler_f(g_source, memory_pressure_cancelled);
+    dispatch_resume(g_source);
+    return true;
+}
+
+void platform_memory_pressure_stop(void)
+{
+    if (!g_source) return;
+
+    dispatch_source_cancel(g_source);
+    g_source = NULL;
+    atomic_store(&g_pending, PLATFORM_MEMORY_NORMAL);
+}
+
+PlatformMemoryPressure platform_memory_pressure_take(void)
+{
+    return (PlatformMemoryPressure)atomic_exchange(&g_pending, PLATFORM_MEMORY_NORMAL);
+}
@@ -0,0 +1,25 @@
+#ifndef PLATFORM_MEMORY_PRESSURE_H
+#define PLATFORM_MEMORY_PRESSURE_H
+
+#include <stdbool.h>
+
+// System memory pressure, from a dispatch memory pressure source. Notifications arrive
+// on a dispatch queue and wake the main loop; the main thread takes the level once per
+// frame and trims its caches
+
+typedef enum PlatformMemoryPressure {
+    PLATFORM_MEMORY_NORMAL = 0,
+    PLATFORM_MEMORY_WARN,
+    PLATFORM_MEMORY_CRITICAL
+} PlatformMemoryPressure;
+
+// Start listening; false if the source could not be created
+bool platform_memory_pressure_start(void);
+
+// Stop listening and forget any level not taken
+void platform_memory_pressure_stop(void);
+
+// The highest level reported since the last call, clearing it (NORMAL if none). Thread-safe
+PlatformMemoryPressure platform_memory_pressure_take(void);
+
+#endif // PLATFORM_MEMORY_PRESSURE_H
@@ -0,0 +1,82 @@
+#include "mounts.h"
+#include <stdlib.h>
+#include <dispatch/dispatch.h>
+#include <DiskArbitration/DiskArbitration.h>
+
+struct MountWatcher {
+    DASessionRef session;
+    dispatch_queue_t queue;
+    MountCallback callback;
+    void *context;
+};
+
+// Helper: A disk appeared or disappeared
+static void mount_disk_changed(DADiskRef disk, void *context)
+{
+    (void)disk;
+    MountWatcher *watcher = (MountWatcher *)context;
+    watcher->callback(watcher->context);
+}
+
+// Helper: A disk was mounted or unmounted
+static void mount_description_changed(DADiskRef disk, CFArrayRef keys, void *context)
+{
+    (void)keys;
+    mount_disk_changed(disk, context);
+}
+
+// Helper: Runs once every callback queued before it has
+static void mount_queue_drained(void *context)
+{
+    (void)context;
+}
+
+MountWatcher* mount_watch_start(MountCallback callback, void *context)
+{
+    if (callback == NULL) {
+        return NULL;
+    }
+
+    MountWatcher *watcher = calloc(1, sizeof(MountWatcher));
+    if (watcher == NULL) {
+        return NULL;
+    }
+    watcher->callback = callback;
+    watcher->context = context;
+
+    watcher->session = DASessionCreate(kCFAllocatorDefault);
+    if (watcher->session == NULL) {
+        free(watcher);
+        return NULL;
+    }
+    watcher->queue = dispatch_queue_create("com.finderplus.mounts", DISPATCH_QUEUE_SERIAL);
+
+    // Mounting or unmounting changes a volume's path
+    CFMutableArrayRef keys = CFArrayCreateMutable(kCFAllocatorDefault, 1, &kCFTypeArrayCallBacks);
+    CFArrayAppendValue(keys, kDADiskDescriptionVolumePathKey);
+
+    DARegisterDiskAppearedCallback(watcher->session, NULL, mount_disk_changed, watcher);
+    DARegisterDiskDisappearedCallback(watcher->session, NULL, mount_disk_changed, watcher);
+    DARegisterDiskDescriptionChangedCallback(watcher->session, NULL, keys, mount_description_changed, watcher);
+    CFRelease(keys);
+
+    DASessionSetDispatchQueue(watcher->session, watcher->queue);
+    return watcher;
+}
+
+void mount_watch_stop(MountWatcher *watcher)
+{
+    if (watcher == NULL) {
+        return;
+    }
+
+    DASessionSetDispatchQueue(watcher->session, NULL);
+    DAUnregisterCallback(watcher->session, (void *)mount_disk_changed, watcher);
+    DAUnregisterCallback(watcher->session, (void *)mount_description_changed, watcher);
+
+    // Wait out a callback already running on the queue
+    dispatch_sync_f(watcher->queue, NULL, mount_queue_drained);
+    dispatch_release(watcher->queue);
+    CFRelease(watcher->session);
+    free(watcher);
+}
@@ -0,0 +1,18 @@
+#ifndef PLATFORM_MOUNTS_H
+#define PLATFORM_MOUNTS_H
+
+// Disk appearance, disappearance and mount notifications from DiskArbitration. The
+// callback runs on a private dispatch queue, and only says that something changed
+
+typedef void (*MountCallback)(void *context);
+
+// Mount watcher (opaque)
+typedef struct MountWatcher MountWatcher;
+
+// Start delivering notifications to callback; NULL if DiskArbitration is unavailable
+MountWatcher* mount_watch_start(MountCallback callback, void *context);
+
+// Stop; no callback runs once this returns
+void mount_watch_stop(MountWatcher *watcher);
+
+#endif // PLATFORM_MOUNTS_H
@@ -0,0 +1,30 @@
+#ifndef PLATFORM_OCR_H
+#define PLATFORM_OCR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Text in images through Vision's text recognition, which runs on the Neural Engine
+// where the machine has one. Fast recognition (no language correction) is meant for
+// bulk indexing, accurate recognition for a single file someone is looking at
+
+// Images recognized in one call; the request is shared across them
+#define PLATFORM_OCR_MAX_BATCH 16
+
+// Width scanned PDF pages are rendered at before they are recognized
+#define PLATFORM_OCR_PAGE_WIDTH 1600
+
+// Recognize the text of count image files (at most PLATFORM_OCR_MAX_BATCH), lines
+// separated by newlines and cut at max_bytes (UTF-8). texts[i] is malloc'd and
+// NUL-terminated, or NULL where an image has no text or cannot be read; lengths may be
+// NULL. Returns how many images had text
+int platform_ocr_images(const char *const *paths, int count, bool fast, size_t max_bytes,
+                        char **texts, size_t *lengths);
+
+// Recognize the text of a scanned PDF's first max_pages pages, rendered
+// PLATFORM_OCR_PAGE_WIDTH pixels wide; pages are separated by form feeds. *text is
+// malloc'd and NUL-terminated; false if no page has text
+bool platform_ocr_pdf(const char *path, int max_pages, bool fast, size_t max_bytes,
+                      char **text, size_t *length);
+
+#endif // PLATFORM_OCR_H
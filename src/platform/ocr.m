@@ -0,0 +1,173 @@
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+#import <Vision/Vision.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ocr.h"
+#include "pdf.h"
+
+// Helper: A text recognition request, reused for every image of a call
+static VNRecognizeTextRequest *make_request(bool fast)
+{
+    VNRecognizeTextRequest *request = [[VNRecognizeTextRequest alloc] init];
+    request.recognitionLevel = fast ? VNRequestTextRecognitionLevelFast : VNRequestTextRecognitionLevelAccurate;
+    request.usesLanguageCorrection = !fast;
+    return request;
+}
+
+// Helper: Append the lines the request last found to out, a newline between lines
+// after start, cut at max_bytes
+static void append_lines(VNRecognizeTextRequest *request, char *out, size_t *used, size_t start, size_t max_bytes)
+{
+    for (VNRecognizedTextObservation *observation in request.results) {
+        const char *utf8 = [observation topCandidates:1].firstObject.string.UTF8String;
+        if (utf8 == NULL || utf8[0] == '\0') continue;
+        if (*used > start && *used < max_bytes) {
+            out[(*used)++] = '\n';
+        }
+        size_t n = strlen(utf8);
+        if (n > max_bytes - *used) {
+            // Cut on a character boundary
+            n = max_bytes - *used;
+            while (n > 0 && ((unsigned char)utf8[n] & 0xC0) == 0x80) n--;
+        }
+        memcpy(out + *used, utf8, n);
+        *used += n;
+        if (*used >= max_bytes) break;
+    }
+}
+
+// Helper: Hand out the used bytes of out as the text, or free them if there is none
+static bool take_text(char *out, size_t used, char **text, size_t *length)
+{
+    out[used] = '\0';
+    bool has_text = false;
+    for (size_t i = 0; i < used && !has_text; i++) {
+        has_text = out[i] != '\f' && out[i] != ' ' && out[i] != '\n' && out[i] != '\r' && out[i] != '\t';
+    }
+    if (!has_text) {
+        free(out);
+        return false;
+    }
+    *text = out;
+    if (length != NULL) {
+        *length = used;
+    }
+    return true;
+}
+
+int platform_ocr_images(const char *const *paths, int count, bool fast, size_t max_bytes,
+                        char **texts, size_t *lengths)
+{
+    if (count > PLATFORM_OCR_MAX_BATCH) {
+        count = PLATFORM_OCR_MAX_BATCH;
+    }
+    for (int i = 0; i < count; i++) {
+        texts[i] = NULL;
+        if (lengths != NULL) lengths[i] = 0;
+    }
+    if (paths == NULL || count <= 0 || max_bytes == 0) {
+        return 0;
+    }
+
+    int found = 0;
+    @autoreleasepool {
+        VNRecognizeTextRequest *request = make_request(fast);
+        for (int i = 0; i < count; i++) {
+            // One image's handler and results at a time
+            @autoreleasepool {
+                if (paths[i] == NULL) continue;
+                NSURL *url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:paths[i]]];
+                VNImageRequestHandler *handler = [[VNImageRequestHandler alloc] initWithURL:url options:@{}];
+                if (![handler performRequests:@[request] error:nil]) continue;
+
+                char *out = malloc(max_bytes + 1);
+                if (out == NULL) continue;
+                size_t used = 0;
+                append_lines(request, out, &used, 0, max_bytes);
+                if (take_text(out, used, &texts[i], lengths != NULL ? &lengths[i] : NULL)) {
+                    found++;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+// Helper: Free a rendered page's pixels once the image over them is gone
+static void release_pixels(void *info, const void *data, size_t size)
+{
+    (void)info;
+    (void)size;
+    free((void *)data);
+}
+
+// Helper: A CGImage over a rendered page's pixels, which it takes over (freed here if
+// no image can be made)
+static CGImageRef image_from_rgba(unsigned char *rgba, int width, int height)
+{
+    CGDataProviderRef provider = CGDataProviderCreateWithData(NULL, rgba, (size_t)width * (size_t)height * 4,
+                                                              release_pixels);
+    if (provider == NULL) {
+        free(rgba);
+        return NULL;
+    }
+    CGColorSpaceRef space = CGColorSpaceCreateDeviceRGB();
+    CGImageRef image = CGImageCreate((size_t)width, (size_t)height, 8, 32, (size_t)width * 4, space,
+                                     kCGImageAlphaPremultipliedLast, provider, NULL, false,
+                                     kCGRenderingIntentDefault);
+    CGColorSpaceRelease(space);
+    CGDataProviderRelease(provider);
+    return image;
+}
+
+bool platform_ocr_pdf(const char *path, int max_pages, bool fast, size_t max_bytes,
+                      char **text, size_t *length)
+{
+    *text = NULL;
+    if (path == NULL || max_pages <= 0 || max_bytes == 0) {
+        return false;
+    }
+    PlatformPdf *pdf = platform_pdf_open(path);
+    if (pdf == NULL) {
+        return false;
+    }
+    char *out = malloc(max_bytes + 1);
+    if (out == NULL) {
+        platform_pdf_close(pdf);
+        return false;
+    }
+
+    size_t used = 0;
+    int pages = platform_pdf_page_count(pdf);
+    if (pages > max_pages) {
+        pages = max_pages;
+    }
+    @autoreleasepool {
+        VNRecognizeTextRequest *request = make_request(fast);
+        for (int page = 0; page < pages && used < max_bytes; page++) {
+            // One page's pixels and results at a time
+            @autoreleasepool {
+                unsigned char *rgba = NULL;
+                int width = 0, height = 0;
+                if (!platform_pdf_render_page(pdf, page, PLATFORM_OCR_PAGE_WIDTH, &rgba, &width, &height)) {
+                    continue;
+                }
+                CGImageRef image = image_from_rgba(rgba, width, height);
+                if (image != NULL) {
+                    VNImageRequestHandler *handler = [[VNImageRequestHandler alloc] initWithCGImage:image
+                                                                                            options:@{}];
+                    if ([handler performRequests:@[request] error:nil]) {
+                        if (used > 0) {
+                            out[used++] = '\f';
+                        }
+                        append_lines(request, out, &used, used, max_bytes);
+                    }
+                    CGImageRelease(image);
+                }
+            }
+        }
+    }
+    platform_pdf_close(pdf);
+    return take_text(out, used, text, length);
+}
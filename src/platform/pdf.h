@@ -0,0 +1,31 @@
+#ifndef PLATFORM_PDF_H
+#define PLATFORM_PDF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// PDF pages and text through Core Graphics and PDFKit. Pages are rasterized one at a
+// time at the width asked for, so a page costs what is drawn of it, however large the
+// document. A document is used by one thread at a time
+
+typedef struct PlatformPdf PlatformPdf;
+
+// Open a PDF file; NULL if it is not one, or is locked with a password
+PlatformPdf *platform_pdf_open(const char *path);
+void platform_pdf_close(PlatformPdf *pdf);
+
+int platform_pdf_page_count(const PlatformPdf *pdf);
+
+// Size of a page (from 0) in points, upright as it is shown; false if there is no such page
+bool platform_pdf_page_size(const PlatformPdf *pdf, int page, float *width, float *height);
+
+// Render a page upright onto white, width pixels wide and as tall as its aspect ratio
+// makes it. *rgba is malloc'd (width * height * 4 bytes, top row first)
+bool platform_pdf_render_page(PlatformPdf *pdf, int page, int width,
+                              unsigned char **rgba, int *out_width, int *out_height);
+
+// Text of a PDF file's pages in order, separated by form feeds, cut at max_bytes
+// (UTF-8). *text is malloc'd and NUL-terminated; false if the file has no text
+bool platform_pdf_text(const char *path, size_t max_bytes, char **text, size_t *length);
+
+#endif // PLATFORM_PDF_H
@@ -0,0 +1,209 @@
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+#import <PDFKit/PDFKit.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pdf.h"
+
+struct PlatformPdf {
+    CGPDFDocumentRef document;
+    int page_count;
+};
+
+PlatformPdf *platform_pdf_open(const char *path)
+{
+    if (path == NULL) {
+        return NULL;
+    }
+
+    @autoreleasepool {
+        NSURL *url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:path]];
+        CGPDFDocumentRef document = CGPDFDocumentCreateWithURL((__bridge CFURLRef)url);
+        if (document == NULL) {
+            return NULL;
+        }
+        // Many PDFs are encrypted with an empty password only to set permissions
+        if (!CGPDFDocumentIsUnlocked(document) && !CGPDFDocumentUnlockWithPassword(document, "")) {
+            CGPDFDocumentRelease(document);
+            return NULL;
+        }
+        size_t pages = CGPDFDocumentGetNumberOfPages(document);
+        if (pages == 0) {
+            CGPDFDocumentRelease(document);
+            return NULL;
+        }
+
+        PlatformPdf *pdf = calloc(1, sizeof(PlatformPdf));
+        if (pdf == NULL) {
+            CGPDFDocumentRelease(document);
+            return NULL;
+        }
+        pdf->document = document;
+        pdf->page_count = (int)pages;
+        return pdf;
+    }
+}
+
+void platform_pdf_close(PlatformPdf *pdf)
+{
+    if (pdf == NULL) {
+        return;
+    }
+    CGPDFDocumentRelease(pdf->document);
+    free(pdf);
+}
+
+int platform_pdf_page_count(const PlatformPdf *pdf)
+{
+    return pdf != NULL ? pdf->page_count : 0;
+}
+
+// Helper: a page (from 0), its crop box and its rotation (0, 90, 180 or 270)
+static CGPDFPageRef get_page(const PlatformPdf *pdf, int page, CGRect *box, int *rotation)
+{
+    if (pdf == NULL || page < 0 || page >= pdf->page_count) {
+        return NULL;
+    }
+    CGPDFPageRef ref = CGPDFDocumentGetPage(pdf->document, (size_t)page + 1);
+    if (ref == NULL) {
+        return NULL;
+    }
+    *box = CGPDFPageGetBoxRect(ref, kCGPDFCropBox);
+    *rotation = ((CGPDFPageGetRotationAngle(ref) % 360) + 360) % 360;
+    return box->size.width > 0 && box->size.height > 0 ? ref : NULL;
+}
+
+bool platform_pdf_page_size(const PlatformPdf *pdf, int page, float *width, float *height)
+{
+    CGRect box;
+    int rotation;
+    if (get_page(pdf, page, &box, &rotation) == NULL) {
+        return false;
+    }
+    bool sideways = rotation == 90 || rotation == 270;
+    *width = (float)(sideways ? box.size.height : box.size.width);
+    *height = (float)(sideways ? box.size.width : box.size.height);
+    return true;
+}
+
+bool platform_pdf_render_page(PlatformPdf *pdf, int page, int width,
+                              unsigned char **rgba, int *out_width, int *out_height)
+{
+    *rgba = NULL;
+    CGRect box;
+    int rotation;
+    CGPDFPageRef ref = get_page(pdf, page, &box, &rotation);
+    if (ref == NULL || width <= 0) {
+        return false;
+    }
+
+    bool sideways = rotation == 90 || rotation == 270;
+    double upright_width = sideways ? box.size.height : box.size.width;
+    double upright_height = sideways ? box.size.width : box.size.height;
+    double scale = width / upright_width;
+    int height = (int)lround(upright_height * scale);
+    if (height < 1) height = 1;
+
+    unsigned char *pixels = calloc((size_t)width * (size_t)height, 4);
+    if (pixels == NULL) {
+        return false;
+    }
+    CGColorSpaceRef space = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(pixels, (size_t)width, (size_t)height, 8, (size_t)width * 4,
+                                                 space, kCGImageAlphaPremultipliedLast);
+    CGColorSpaceRelease(space);
+    if (context == NULL) {
+        free(pixels);
+        return false;
+    }
+
+    CGContextSetRGBFillColor(context, 1, 1, 1, 1);
+    CGContextFillRect(context, CGRectMake(0, 0, width, height));
+    CGContextSetInterpolationQuality(context, kCGInterpolationHigh);
+
+    // Map the crop box, turned by the page's rotation (clockwise), onto the bitmap
+    CGContextScaleCTM(context, scale, scale);
+    switch (rotation) {
+        case 90:
+            CGContextTranslateCTM(context, 0, box.size.width);
+            CGContextRotateCTM(context, -M_PI_2);
+            break;
+        case 180:
+            CGContextTranslateCTM(context, box.size.width, box.size.height);
+            CGContextRotateCTM(context, M_PI);
+            break;
+        case 270:
+            CGContextTranslateCTM(context, box.size.height, 0);
+            CGContextRotateCTM(context, M_PI_2);
+            break;
+        default:
+            break;
+    }
+    CGContextTranslateCTM(context, -box.origin.x, -box.origin.y);
+    CGContextClipToRect(context, box);
+    CGContextDrawPDFPage(context, ref);
+    CGContextRelease(context);
+
+    *rgba = pixels;
+    *out_width = width;
+    *out_height = height;
+    return true;
+}
+
+bool platform_pdf_text(const char *path, size_t max_bytes, char **text, size_t *length)
+{
+    *text = NULL;
+    if (path == NULL || max_bytes == 0) {
+        return false;
+    }
+
+    @autoreleasepool {
+        NSURL *url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:path]];
+        PDFDocument *document = [[PDFDocument alloc] initWithURL:url];
+        if (document == nil || (document.isLocked && ![document unlockWithPassword:@""])) {
+            return false;
+        }
+
+        char *out = malloc(max_bytes + 1);
+        if (out == NULL) {
+            return false;
+        }
+        size_t used = 0;
+        NSInteger pages = document.pageCount;
+        for (NSInteger i = 0; i < pages && used < max_bytes; i++) {
+            // One page's strings at a time, so a long document never holds them all
+            @autoreleasepool {
+                NSString *page_text = [document pageAtIndex:(NSUInteger)i].string;
+                const char *utf8 = page_text.UTF8String;
+                if (utf8 == NULL) continue;
+                size_t n = strlen(utf8);
+                if (used > 0 && used < max_bytes) {
+                    out[used++] = '\f';
+                }
+                if (n > max_bytes - used) {
+                    // Cut on a character boundary
+                    n = max_bytes - used;
+                    while (n > 0 && ((unsigned char)utf8[n] & 0xC0) == 0x80) n--;
+                }
+                memcpy(out + used, utf8, n);
+                used += n;
+            }
+        }
+        out[used] = '\0';
+
+        bool has_text = false;
+        for (size_t i = 0; i < used && !has_text; i++) {
+            has_text = out[i] != '\f' && out[i] != ' ' && out[i] != '\n' && out[i] != '\r' && out[i] != '\t';
+        }
+        if (!has_text) {
+            free(out);
+            return false;
+        }
+        *text = out;
+        if (length != NULL) {
+            *length = used;
+        }
+        return true;
+    }
+}
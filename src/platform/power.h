@@ -0,0 +1,31 @@
+#ifndef PLATFORM_POWER_H
+#define PLATFORM_POWER_H
+
+#include <stdbool.h>
+
+// Thermal pressure, as NSProcessInfo reports it
+typedef enum PlatformThermalState {
+    PLATFORM_THERMAL_NOMINAL = 0,
+    PLATFORM_THERMAL_FAIR,
+    PLATFORM_THERMAL_SERIOUS,
+    PLATFORM_THERMAL_CRITICAL
+} PlatformThermalState;
+
+// Machine load and power state
+typedef struct PlatformLoad {
+    float cpu_load;                     // Busy share of all cores since the previous sample (0-1)
+    PlatformThermalState thermal;
+    bool on_battery;
+    int battery_percent;                // -1 without a battery
+    bool low_power_mode;                // User asked the system to save energy
+} PlatformLoad;
+
+// Sample machine load and power state. CPU load is measured between calls, so the
+// first sample reports 0; call from one thread
+void platform_sample_load(PlatformLoad *load);
+
+// Run the whole process in the background band (CPU and disk yield to everything else);
+// for headless work such as the index daemon
+void platform_set_background_priority(void);
+
+#endif // PLATFORM_POWER_H
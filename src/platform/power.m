@@ -0,0 +1,107 @@
+#import <Foundation/Foundation.h>
+#include <mach/mach.h>
+#include <mach/mach_host.h>
+#include <IOKit/ps/IOPowerSources.h>
+#include <IOKit/ps/IOPSKeys.h>
+#include <sys/resource.h>
+#include "power.h"
+
+// Tick counters at the previous sample
+static mach_port_t g_host = MACH_PORT_NULL;
+static unsigned long long g_previous_busy = 0;
+static unsigned long long g_previous_total = 0;
+
+static float sample_cpu_load(void)
+{
+    if (g_host == MACH_PORT_NULL) {
+        g_host = mach_host_self();
+    }
+
+    host_cpu_load_info_data_t info;
+    mach_msg_type_number_t count = HOST_CPU_LOAD_INFO_COUNT;
+    if (host_statistics(g_host, HOST_CPU_LOAD_INFO, (host_info_t)&info, &count) != KERN_SUCCESS) {
+        return 0.0f;
+    }
+
+    unsigned long long busy = (unsigned long long)info.cpu_ticks[CPU_STATE_USER] +
+                              info.cpu_ticks[CPU_STATE_SYSTEM] +
+                              info.cpu_ticks[CPU_STATE_NICE];
+    unsigned long long total = busy + info.cpu_ticks[CPU_STATE_IDLE];
+
+    float load = 0.0f;
+    if (g_previous_total > 0 && total > g_previous_total && busy >= g_previous_busy) {
+        load = (float)(busy - g_previous_busy) / (float)(total - g_previous_total);
+    }
+    g_previous_busy = busy;
+    g_previous_total = total;
+    return load;
+}
+
+static void sample_battery(PlatformLoad *load)
+{
+    load->on_battery = false;
+    load->battery_percent = -1;
+
+    CFTypeRef info = IOPSCopyPowerSourcesInfo();
+    if (info == NULL) {
+        return;
+    }
+
+    CFStringRef source = IOPSGetProvidingPowerSourceType(info);
+    load->on_battery = source != NULL &&
+                       CFStringCompare(source, CFSTR(kIOPMBatteryPowerKey), 0) == kCFCompareEqualTo;
+
+    CFArrayRef list = IOPSCopyPowerSourcesList(info);
+    if (list != NULL) {
+        for (CFIndex i = 0; i < CFArrayGetCount(list); i++) {
+            CFDictionaryRef description = IOPSGetPowerSourceDescription(info, CFArrayGetValueAtIndex(list, i));
+            if (description == NULL) {
+                continue;
+            }
+
+            CFNumberRef current = CFDictionaryGetValue(description, CFSTR(kIOPSCurrentCapacityKey));
+            CFNumberRef maximum = CFDictionaryGetValue(description, CFSTR(kIOPSMaxCapacityKey));
+            int current_value = 0;
+            int maximum_value = 0;
+            if (current != NULL && maximum != NULL &&
+                CFNumberGetValue(current, kCFNumberIntType, &current_value) &&
+                CFNumberGetValue(maximum, kCFNumberIntType, &maximum_value) && maximum_value > 0) {
+                load->battery_percent = current_value * 100 / maximum_value;
+                break;
+            }
+        }
+        CFRelease(list);
+    }
+    CFRelease(info);
+}
+
+void platform_sample_load(PlatformLoad *load)
+{
+    if (load == NULL) {
+        return;
+    }
+
+    load->cpu_load = sample_cpu_load();
+    sample_battery(load);
+
+    @autoreleasepool {
+        NSProcessInfo *process = [NSProcessInfo processInfo];
+        switch (process.thermalState) {
+            case NSProcessInfoThermalStateFair:     load->thermal = PLATFORM_THERMAL_FAIR; break;
+            case NSProcessInfoThermalStateSerious:  load->thermal = PLATFORM_THERMAL_SERIOUS; break;
+            case NSProcessInfoThermalStateCritical: load->thermal = PLATFORM_THERMAL_CRITICAL; break;
+            default:                                load->thermal = PLATFORM_THERMAL_NOMINAL; break;
+        }
+
+        load->low_power_mode = false;
+        if (@available(macOS 12.0, *)) {
+            load->low_power_mode = process.lowPowerModeEnabled;
+        }
+    }
+}
+
+void platform_set_background_priority(void)
+{
+    // Darwin's background band: low CPU priority, throttled disk and network I/O
+    setpriority(PRIO_DARWIN_PROCESS, 0, PRIO_DARWIN_BG);
+}
@@ -0,0 +1,15 @@
+#ifndef PLATFORM_RICH_TEXT_H
+#define PLATFORM_RICH_TEXT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Text of word processor documents through the system's importers (the ones textutil
+// uses): Word (.doc, .docx), RTF and OpenDocument text. These parsers take whatever is
+// in the file, so callers run them in a worker process, see ai/extract_pool.h
+
+// Text of a document, cut at max_bytes (UTF-8). *text is malloc'd and NUL-terminated;
+// false if it cannot be read or has no text
+bool platform_rich_text(const char *path, size_t max_bytes, char **text, size_t *length);
+
+#endif // PLATFORM_RICH_TEXT_H
@@ -0,0 +1,53 @@
+#import <AppKit/AppKit.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rich_text.h"
+
+bool platform_rich_text(const char *path, size_t max_bytes, char **text, size_t *length)
+{
+    *text = NULL;
+    if (path == NULL || max_bytes == 0) {
+        return false;
+    }
+
+    @autoreleasepool {
+        // The importer is picked from the file itself. HTML is never passed here: its
+        // importer loads WebKit and must run on the main thread
+        NSURL *url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:path]];
+        NSError *error = nil;
+        NSAttributedString *document = [[NSAttributedString alloc] initWithURL:url
+                                                                       options:@{}
+                                                            documentAttributes:NULL
+                                                                         error:&error];
+        const char *utf8 = document.string.UTF8String;
+        if (utf8 == NULL) {
+            return false;
+        }
+
+        size_t n = strlen(utf8);
+        if (n > max_bytes) {
+            // Cut on a character boundary
+            n = max_bytes;
+            while (n > 0 && ((unsigned char)utf8[n] & 0xC0) == 0x80) n--;
+        }
+        bool has_text = false;
+        for (size_t i = 0; i < n && !has_text; i++) {
+            has_text = utf8[i] != ' ' && utf8[i] != '\n' && utf8[i] != '\r' && utf8[i] != '\t' && utf8[i] != '\f';
+        }
+        if (!has_text) {
+            return false;
+        }
+
+        char *out = malloc(n + 1);
+        if (out == NULL) {
+            return false;
+        }
+        memcpy(out, utf8, n);
+        out[n] = '\0';
+        *text = out;
+        if (length != NULL) {
+            *length = n;
+        }
+        return true;
+    }
+}
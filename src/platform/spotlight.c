@@ -0,0 +1,281 @@
+#include "spotlight.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <dispatch/dispatch.h>
+#include <CoreServices/CoreServices.h>
+
+#define SPOTLIGHT_PROBE_SLOTS 16            // Scopes whose verdicts are kept
+
+struct SpotlightQuery {
+    MDQueryRef query;
+    dispatch_queue_t queue;
+    int max_results;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;                    // Gathering finished
+    char **paths;                           // Collected, not taken yet
+    int count;
+    int capacity;
+    int collected;                          // Paths collected in all
+    CFIndex seen;                           // Results of the gathering copied so far
+    bool gathered;
+    bool truncated;
+};
+
+// Verdicts of platform_spotlight_indexes, oldest replaced first
+static struct {
+    pthread_mutex_t mutex;
+    char scopes[SPOTLIGHT_PROBE_SLOTS][1024];
+    bool indexed[SPOTLIGHT_PROBE_SLOTS];
+    time_t checked[SPOTLIGHT_PROBE_SLOTS];
+} g_probes = { PTHREAD_MUTEX_INITIALIZER, {{0}}, {false}, {0} };
+
+// Helper: Search scope array of one path; NULL on failure
+static CFArrayRef spotlight_scope(const char *scope)
+{
+    CFStringRef path = CFStringCreateWithFileSystemRepresentation(kCFAllocatorDefault, scope);
+    if (path == NULL) {
+        return NULL;
+    }
+    CFArrayRef scopes = CFArrayCreate(kCFAllocatorDefault, (const void **)&path, 1, &kCFTypeArrayCallBacks);
+    CFRelease(path);
+    return scopes;
+}
+
+// Helper: Collect the path of one result (call with the mutex held); false at the cap
+static bool spotlight_collect(SpotlightQuery *sq, MDItemRef item)
+{
+    if (sq->collected >= sq->max_results) {
+        sq->truncated = true;
+        return false;
+    }
+    CFStringRef path = item ? MDItemCopyAttribute(item, kMDItemPath) : NULL;
+    if (path == NULL) {
+        return true;
+    }
+    char buffer[4096];
+    bool ok = CFStringGetFileSystemRepresentation(path, buffer, sizeof(buffer));
+    CFRelease(path);
+    if (!ok) {
+        return true;
+    }
+
+    if (sq->count == sq->capacity) {
+        int capacity = sq->capacity ? sq->capacity * 2 : 256;
+        char **paths = realloc(sq->paths, (size_t)capacity * sizeof(char *));
+        if (paths == NULL) {
+            return true;
+        }
+        sq->paths = paths;
+        sq->capacity = capacity;
+    }
+    sq->paths[sq->count] = strdup(buffer);
+    if (sq->paths[sq->count] != NULL) {
+        sq->count++;
+        sq->collected++;
+    }
+    return true;
+}
+
+// Helper: Progress, the end of gathering and live updates, on the query's queue
+static void spotlight_notified(CFNotificationCenterRef center, void *observer, CFNotificationName name,
+                               const void *object, CFDictionaryRef info)
+{
+    (void)center;
+    (void)object;
+    SpotlightQuery *sq = (SpotlightQuery *)observer;
+
+    MDQueryDisableUpdates(sq->query);
+    pthread_mutex_lock(&sq->mutex);
+    bool room = true;
+    if (CFEqual(name, kMDQueryDidUpdateNotification)) {
+        // Files that came to match after gathering
+        CFArrayRef added = info ? CFDictionaryGetValue(info, kMDQueryUpdateAddedItems) : NULL;
+        CFIndex added_count = added ? CFArrayGetCount(added) : 0;
+        for (CFIndex i = 0; i < added_count && room; i++) {
+            room = spotlight_collect(sq, (MDItemRef)CFArrayGetValueAtIndex(added, i));
+        }
+    } else {
+        // While gathering, results only grow at the end
+        CFIndex total = MDQueryGetResultCount(sq->query);
+        for (; sq->seen < total && room; sq->seen++) {
+            room = spotlight_collect(sq, (MDItemRef)MDQueryGetResultAtIndex(sq->query, sq->seen));
+        }
+    }
+    if (!room || CFEqual(name, kMDQueryDidFinishNotification)) {
+        sq->gathered = true;
+        pthread_cond_broadcast(&sq->cond);
+    }
+    pthread_mutex_unlock(&sq->mutex);
+
+    if (room) {
+        MDQueryEnableUpdates(sq->query);
+    } else {
+        MDQueryStop(sq->query);
+    }
+}
+
+// Helper: Runs once every notification queued before it has
+static void spotlight_queue_drained(void *context)
+{
+    (void)context;
+}
+
+bool platform_spotlight_indexes(const char *scope)
+{
+    if (scope == NULL || scope[0] != '/' || strlen(scope) >= sizeof(g_probes.scopes[0])) {
+        return false;
+    }
+
+    time_t now = time(NULL);
+    pthread_mutex_lock(&g_probes.mutex);
+    int oldest = 0;
+    for (int i = 0; i < SPOTLIGHT_PROBE_SLOTS; i++) {
+        if (strcmp(g_probes.scopes[i], scope) == 0 && now - g_probes.checked[i] < PLATFORM_SPOTLIGHT_PROBE_SECONDS) {
+            bool indexed = g_probes.indexed[i];
+            pthread_mutex_unlock(&g_probes.mutex);
+            return indexed;
+        }
+        if (g_probes.checked[i] < g_probes.checked[oldest]) {
+            oldest = i;
+        }
+    }
+    pthread_mutex_unlock(&g_probes.mutex);
+
+    // Any one item: an unindexed volume or an excluded folder has none
+    bool indexed = false;
+    MDQueryRef query = MDQueryCreate(kCFAllocatorDefault, CFSTR("kMDItemFSName == \"*\""), NULL, NULL);
+    CFArrayRef scopes = spotlight_scope(scope);
+    if (query != NULL && scopes != NULL) {
+        MDQuerySetSearchScope(query, scopes, 0);
+        MDQuerySetMaxCount(query, 1);
+        indexed = MDQueryExecute(query, kMDQuerySynchronous) && MDQueryGetResultCount(query) > 0;
+    }
+    if (scopes != NULL) CFRelease(scopes);
+    if (query != NULL) CFRelease(query);
+
+    pthread_mutex_lock(&g_probes.mutex);
+    snprintf(g_probes.scopes[oldest], sizeof(g_probes.scopes[oldest]), "%s", scope);
+    g_probes.indexed[oldest] = indexed;
+    g_probes.checked[oldest] = now;
+    pthread_mutex_unlock(&g_probes.mutex);
+    return indexed;
+}
+
+SpotlightQuery* platform_spotlight_start(const char *query, const char *scope, int max_results)
+{
+    if (query == NULL || scope == NULL || max_results <= 0) {
+        return NULL;
+    }
+    CFStringRef text = CFStringCreateWithCString(kCFAllocatorDefault, query, kCFStringEncodingUTF8);
+    if (text == NULL) {
+        return NULL;
+    }
+    MDQueryRef md_query = MDQueryCreate(kCFAllocatorDefault, text, NULL, NULL);
+    CFRelease(text);
+    CFArrayRef scopes = spotlight_scope(scope);
+    SpotlightQuery *sq = md_query && scopes ? calloc(1, sizeof(SpotlightQuery)) : NULL;
+    if (sq == NULL) {
+        if (scopes != NULL) CFRelease(scopes);
+        if (md_query != NULL) CFRelease(md_query);
+        return NULL;
+    }
+    MDQuerySetSearchScope(md_query, scopes, 0);
+    CFRelease(scopes);
+
+    sq->query = md_query;
+    sq->max_results = max_results;
+    pthread_mutex_init(&sq->mutex, NULL);
+    pthread_cond_init(&sq->cond, NULL);
+    sq->queue = dispatch_queue_create("com.finderplus.spotlight", DISPATCH_QUEUE_SERIAL);
+
+    CFNotificationCenterRef center = CFNotificationCenterGetLocalCenter();
+    const CFStringRef names[] = {
+        kMDQueryProgressNotification, kMDQueryDidFinishNotification, kMDQueryDidUpdateNotification
+    };
+    for (int i = 0; i < 3; i++) {
+        CFNotificationCenterAddObserver(center, sq, spotlight_notified, names[i], md_query,
+                                        CFNotificationSuspensionBehaviorDeliverImmediately);
+    }
+
+    MDQuerySetDispatchQueue(md_query, sq->queue);
+    if (!MDQueryExecute(md_query, kMDQueryWantsUpdates)) {
+        platform_spotlight_stop(sq);
+        return NULL;
+    }
+    return sq;
+}
+
+int platform_spotlight_take(SpotlightQuery *query, char **paths, int max_paths)
+{
+    if (query == NULL || paths == NULL || max_paths <= 0) {
+        return 0;
+    }
+    pthread_mutex_lock(&query->mutex);
+    int taken = query->count < max_paths ? query->count : max_paths;
+    memcpy(paths, query->paths, (size_t)taken * sizeof(char *));
+    memmove(query->paths, query->paths + taken, (size_t)(query->count - taken) * sizeof(char *));
+    query->count -= taken;
+    pthread_mutex_unlock(&query->mutex);
+    return taken;
+}
+
+bool platform_spotlight_gathered(SpotlightQuery *query)
+{
+    if (query == NULL) {
+        return true;
+    }
+    pthread_mutex_lock(&query->mutex);
+    bool gathered = query->gathered;
+    pthread_mutex_unlock(&query->mutex);
+    return gathered;
+}
+
+void platform_spotlight_wait(SpotlightQuery *query)
+{
+    if (query == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&query->mutex);
+    while (!query->gathered) {
+        pthread_cond_wait(&query->cond, &query->mutex);
+    }
+    pthread_mutex_unlock(&query->mutex);
+}
+
+bool platform_spotlight_truncated(SpotlightQuery *query)
+{
+    if (query == NULL) {
+        return false;
+    }
+    pthread_mutex_lock(&query->mutex);
+    bool truncated = query->truncated;
+    pthread_mutex_unlock(&query->mutex);
+    return truncated;
+}
+
+void platform_spotlight_stop(SpotlightQuery *query)
+{
+    if (query == NULL) {
+        return;
+    }
+
+    MDQueryStop(query->query);
+    CFNotificationCenterRemoveEveryObserver(CFNotificationCenterGetLocalCenter(), query);
+
+    // Wait out a notification already running on the queue
+    dispatch_sync_f(query->queue, NULL, spotlight_queue_drained);
+    dispatch_release(query->queue);
+    CFRelease(query->query);
+
+    for (int i = 0; i < query->count; i++) {
+        free(query->paths[i]);
+    }
+    free(query->paths);
+    pthread_mutex_destroy(&query->mutex);
+    pthread_cond_destroy(&query->cond);
+    free(query);
+}
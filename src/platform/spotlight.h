@@ -0,0 +1,43 @@
+#ifndef PLATFORM_SPOTLIGHT_H
+#define PLATFORM_SPOTLIGHT_H
+
+#include <stdbool.h>
+
+// Queries of the Spotlight index (MDQuery). A query runs on a private dispatch queue:
+// the paths it gathers are collected as they arrive and taken by the caller whenever it
+// likes, and once gathering is done the query stays live, adding files created or
+// changed to match it later. Query strings use the Spotlight query syntax
+// ("kMDItemFSName == \"*.c\"c && kMDItemFSSize > 1024")
+
+// How long a verdict on whether Spotlight indexes a folder is trusted
+#define PLATFORM_SPOTLIGHT_PROBE_SECONDS 60
+
+// Running query (opaque)
+typedef struct SpotlightQuery SpotlightQuery;
+
+// Whether Spotlight answers for scope: indexing is on for its volume and scope is not
+// excluded from it. Asks the index for one item below scope; the verdict is kept for
+// PLATFORM_SPOTLIGHT_PROBE_SECONDS. Thread safe
+bool platform_spotlight_indexes(const char *scope);
+
+// Start query below scope, collecting at most max_results paths. NULL if the query
+// cannot be parsed or started
+SpotlightQuery* platform_spotlight_start(const char *query, const char *scope, int max_results);
+
+// Move up to max_paths paths gathered since the last call into paths (malloc'd, the
+// caller frees them). Returns how many
+int platform_spotlight_take(SpotlightQuery *query, char **paths, int max_paths);
+
+// Whether the initial gathering is done (or max_results was reached)
+bool platform_spotlight_gathered(SpotlightQuery *query);
+
+// Block until the initial gathering is done
+void platform_spotlight_wait(SpotlightQuery *query);
+
+// Whether the query stopped at max_results
+bool platform_spotlight_truncated(SpotlightQuery *query);
+
+// Stop the query and free it with the paths not taken
+void platform_spotlight_stop(SpotlightQuery *query);
+
+#endif // PLATFORM_SPOTLIGHT_H
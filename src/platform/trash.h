@@ -8,4 +8,9 @@
 // Returns true on success, false on failure
 bool platform_move_to_trash(const char *path);
 
+// Move many items to the Trash at once, several in parallel
+// trashed[i] reports each path; locations (may be NULL) gets where each one went in the
+// Trash, malloc'd (NULL if not trashed). Returns how many were moved
+int platform_move_to_trash_batch(const char *const *paths, int count, bool *trashed, char **locations);
+
 #endif // PLATFORM_TRASH_H
@@ -1,37 +1,79 @@
 #import <Foundation/Foundation.h>
 #include "trash.h"
 
-bool platform_move_to_trash(const char *path)
+#include <string.h>
+
+// Paths each batch block trashes, with its own file manager and autorelease pool
+#define TRASH_BATCH_CHUNK 32
+
+// location (may be NULL) gets a malloc'd copy of where the item went
+static BOOL trash_path(NSFileManager *fileManager, const char *path, char **location)
 {
     if (path == NULL || path[0] == '\0') {
-        return false;
+        return NO;
     }
 
-    @autoreleasepool {
-        NSString *pathStr = [NSString stringWithUTF8String:path];
-        if (pathStr == nil) {
-            return false;
-        }
+    NSString *pathStr = [NSString stringWithUTF8String:path];
+    if (pathStr == nil) {
+        return NO;
+    }
 
-        NSURL *fileURL = [NSURL fileURLWithPath:pathStr];
-        if (fileURL == nil) {
-            return false;
-        }
+    NSURL *fileURL = [NSURL fileURLWithPath:pathStr];
+    if (fileURL == nil) {
+        return NO;
+    }
+
+    NSError *error = nil;
+    NSURL *resultURL = nil;
+
+    // Use trashItemAtURL which is available on macOS 10.8+
+    BOOL success = [fileManager trashItemAtURL:fileURL
+                              resultingItemURL:&resultURL
+                                         error:&error];
+
+    if (!success && error) {
+        // Log error for debugging (optional)
+        // NSLog(@"Failed to move to trash: %@", error.localizedDescription);
+        return NO;
+    }
 
-        NSFileManager *fileManager = [NSFileManager defaultManager];
-        NSError *error = nil;
+    if (success && location != NULL && resultURL != nil) {
+        const char *resultPath = resultURL.path.fileSystemRepresentation;
+        *location = resultPath ? strdup(resultPath) : NULL;
+    }
+    return success;
+}
 
-        // Use trashItemAtURL which is available on macOS 10.8+
-        BOOL success = [fileManager trashItemAtURL:fileURL
-                                  resultingItemURL:nil
-                                             error:&error];
+bool platform_move_to_trash(const char *path)
+{
+    @autoreleasepool {
+        return trash_path([NSFileManager defaultManager], path, NULL);
+    }
+}
+
+int platform_move_to_trash_batch(const char *const *paths, int count, bool *trashed, char **locations)
+{
+    if (paths == NULL || trashed == NULL || count <= 0) {
+        return 0;
+    }
 
-        if (!success && error) {
-            // Log error for debugging (optional)
-            // NSLog(@"Failed to move to trash: %@", error.localizedDescription);
-            return false;
+    // Trash calls mostly wait on the Finder; run the chunks side by side
+    size_t chunks = ((size_t)count + TRASH_BATCH_CHUNK - 1) / TRASH_BATCH_CHUNK;
+    dispatch_apply(chunks, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t chunk) {
+        @autoreleasepool {
+            NSFileManager *fileManager = [[NSFileManager alloc] init];
+            size_t end = (chunk + 1) * TRASH_BATCH_CHUNK;
+            if (end > (size_t)count) end = (size_t)count;
+            for (size_t i = chunk * TRASH_BATCH_CHUNK; i < end; i++) {
+                if (locations != NULL) locations[i] = NULL;
+                trashed[i] = trash_path(fileManager, paths[i], locations ? &locations[i] : NULL);
+            }
         }
+    });
 
-        return success;
+    int moved = 0;
+    for (int i = 0; i < count; i++) {
+        if (trashed[i]) moved++;
     }
+    return moved;
 }
@@ -0,0 +1,55 @@
+#ifndef PLATFORM_VIDEO_DECODE_H
+#define PLATFORM_VIDEO_DECODE_H
+
+#include <stdbool.h>
+
+// In-process video decoding for in-pane playback. AVFoundation reads the file and
+// VideoToolbox decodes and scales each frame on the media engine into an IOSurface-backed
+// BGRA pixel buffer; a background thread keeps a few frames decoded ahead. The main
+// thread uploads the frame due at the playback time straight from its pixel buffer into
+// a GL texture (no pipe, no intermediate copies), and frames are paced by their
+// presentation timestamps rather than a fixed sleep. Probing reads a video's metadata
+// and a keyframe thumbnail through the same framework in one open, without ffprobe
+
+#define PLATFORM_VIDEO_QUEUE 3          // Frames decoded ahead
+
+typedef struct PlatformVideo PlatformVideo;
+
+// Metadata of a video's first video track
+typedef struct PlatformVideoInfo {
+    float duration;                     // Seconds
+    int width;
+    int height;
+    float fps;
+    char codec[16];                     // Upper case (H264, HEVC, PRORES, ...)
+    int bit_depth;                      // Bits per component
+} PlatformVideoInfo;
+
+// Read a video's metadata and, when thumbnail_path is not NULL, write a PNG of the
+// keyframe nearest one second in (upright, at most max_width wide) there, all from one
+// open of the file. False if AVFoundation cannot read it
+bool platform_video_probe(const char *path, PlatformVideoInfo *info,
+                          const char *thumbnail_path, int max_width);
+
+// Write a sprite sheet of columns x rows keyframes spread evenly through a video (upright,
+// frame_width wide, in reading order) as a PNG at sheet_path. Frames are taken at the
+// nearest keyframe and decoded at sheet size. False if AVFoundation cannot read it
+bool platform_video_sprite_sheet(const char *path, const char *sheet_path,
+                                 int columns, int rows, int frame_width);
+
+// Open a video for playback scaled to width x height; NULL if AVFoundation cannot
+// read it (the caller falls back to ffmpeg)
+PlatformVideo *platform_video_open(const char *path, int width, int height);
+
+// Stop decoding and free the video
+void platform_video_close(PlatformVideo *video);
+
+// Upload the frame due at time (seconds from the first frame) into an RGBA texture of
+// the size opened with, skipping frames already late. True if the texture changed.
+// Main thread, with the GL context current
+bool platform_video_update_texture(PlatformVideo *video, double time, unsigned int texture_id);
+
+// Whether every frame has been decoded and shown
+bool platform_video_finished(PlatformVideo *video);
+
+#endif // PLATFORM_VIDEO_DECODE_H
@@ -0,0 +1,430 @@
+#define GL_SILENCE_DEPRECATION
+#import <Foundation/Foundation.h>
+#import <AVFoundation/AVFoundation.h>
+#import <CoreVideo/CoreVideo.h>
+#import <ImageIO/ImageIO.h>
+#include <ctype.h>
+#include <math.h>
+#include <OpenGL/gl3.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "video_decode.h"
+
+struct PlatformVideo {
+    void *reader;                       // AVAssetReader, retained across the C boundary
+    void *output;                       // AVAssetReaderTrackOutput
+    int width;
+    int height;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t space;               // A queued frame was taken, or stopping
+    bool stopping;
+    bool ended;                         // The reader has no more frames
+
+    // Decoded frames in presentation order (ring)
+    CVPixelBufferRef frames[PLATFORM_VIDEO_QUEUE];
+    double times[PLATFORM_VIDEO_QUEUE];
+    int head;
+    int count;
+    double origin;                      // Presentation time of the first frame
+    bool has_origin;
+};
+
+// Thread function: decode frames ahead of playback until the queue is full
+static void *decode_thread(void *arg)
+{
+    PlatformVideo *video = arg;
+    AVAssetReaderTrackOutput *output = (__bridge AVAssetReaderTrackOutput *)video->output;
+
+    for (;;) {
+        pthread_mutex_lock(&video->mutex);
+        while (!video->stopping && video->count == PLATFORM_VIDEO_QUEUE) {
+            pthread_cond_wait(&video->space, &video->mutex);
+        }
+        bool stopping = video->stopping;
+        pthread_mutex_unlock(&video->mutex);
+        if (stopping) {
+            break;
+        }
+
+        @autoreleasepool {
+            CMSampleBufferRef sample = [output copyNextSampleBuffer];
+            if (sample == NULL) {
+                pthread_mutex_lock(&video->mutex);
+                video->ended = true;
+                pthread_mutex_unlock(&video->mutex);
+                break;
+            }
+
+            CVImageBufferRef image = CMSampleBufferGetImageBuffer(sample);
+            double time = CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sample));
+            if (image != NULL) {
+                pthread_mutex_lock(&video->mutex);
+                if (!video->has_origin) {
+                    video->origin = time;
+                    video->has_origin = true;
+                }
+                int slot = (video->head + video->count) % PLATFORM_VIDEO_QUEUE;
+                video->frames[slot] = CVPixelBufferRetain(image);
+                video->times[slot] = time - video->origin;
+                video->count++;
+                pthread_mutex_unlock(&video->mutex);
+            }
+            CFRelease(sample);
+        }
+    }
+    return NULL;
+}
+
+PlatformVideo *platform_video_open(const char *path, int width, int height)
+{
+    if (path == NULL || width <= 0 || height <= 0) {
+        return NULL;
+    }
+
+    @autoreleasepool {
+        NSURL *url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:path]];
+        AVURLAsset *asset = [AVURLAsset URLAssetWithURL:url options:nil];
+        AVAssetTrack *track = [asset tracksWithMediaType:AVMediaTypeVideo].firstObject;
+        if (track == nil) {
+            return NULL;
+        }
+
+        NSError *error = nil;
+        AVAssetReader *reader = [AVAssetReader assetReaderWithAsset:asset error:&error];
+        if (reader == nil) {
+            return NULL;
+        }
+
+        // Decoded and scaled by VideoToolbox into buffers GL can read directly
+        NSDictionary *settings = @{
+            (__bridge NSString *)kCVPixelBufferPixelFormatTypeKey: @(kCVPixelFormatType_32BGRA),
+            (__bridge NSString *)kCVPixelBufferWidthKey: @(width),
+            (__bridge NSString *)kCVPixelBufferHeightKey: @(height),
+            (__bridge NSString *)kCVPixelBufferIOSurfacePropertiesKey: @{},
+            (__bridge NSString *)kCVPixelBufferOpenGLCompatibilityKey: @YES,
+        };
+        AVAssetReaderTrackOutput *output = [AVAssetReaderTrackOutput assetReaderTrackOutputWithTrack:track
+                                                                                      outputSettings:settings];
+        output.alwaysCopiesSampleData = NO;
+        if (![reader canAddOutput:output]) {
+            return NULL;
+        }
+        [reader addOutput:output];
+        if (![reader startReading]) {
+            return NULL;
+        }
+
+        PlatformVideo *video = calloc(1, sizeof(PlatformVideo));
+        if (video == NULL) {
+            [reader cancelReading];
+            return NULL;
+        }
+        video->reader = (void *)CFBridgingRetain(reader);
+        video->output = (void *)CFBridgingRetain(output);
+        video->width = width;
+        video->height = height;
+        pthread_mutex_init(&video->mutex, NULL);
+        pthread_cond_init(&video->space, NULL);
+
+        if (pthread_create(&video->thread, NULL, decode_thread, video) != 0) {
+            [reader cancelReading];
+            CFBridgingRelease(video->output);
+            CFBridgingRelease(video->reader);
+            pthread_cond_destroy(&video->space);
+            pthread_mutex_destroy(&video->mutex);
+            free(video);
+            return NULL;
+        }
+        return video;
+    }
+}
+
+void platform_video_close(PlatformVideo *video)
+{
+    if (video == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&video->mutex);
+    video->stopping = true;
+    pthread_cond_broadcast(&video->space);
+    pthread_mutex_unlock(&video->mutex);
+    pthread_join(video->thread, NULL);
+
+    @autoreleasepool {
+        [(__bridge AVAssetReader *)video->reader cancelReading];
+        CFBridgingRelease(video->output);
+        CFBridgingRelease(video->reader);
+    }
+
+    for (int i = 0; i < video->count; i++) {
+        CVPixelBufferRelease(video->frames[(video->head + i) % PLATFORM_VIDEO_QUEUE]);
+    }
+    pthread_cond_destroy(&video->space);
+    pthread_mutex_destroy(&video->mutex);
+    free(video);
+}
+
+// Helper: copy a BGRA pixel buffer into a texture; GL reads BGRA natively, so the
+// upload is a single DMA from the IOSurface
+static void upload_frame(PlatformVideo *video, CVPixelBufferRef frame, unsigned int texture_id)
+{
+    if (CVPixelBufferLockBaseAddress(frame, kCVPixelBufferLock_ReadOnly) != kCVReturnSuccess) {
+        return;
+    }
+
+    int width = (int)CVPixelBufferGetWidth(frame);
+    int height = (int)CVPixelBufferGetHeight(frame);
+    int stride = (int)CVPixelBufferGetBytesPerRow(frame);
+    if (width > video->width) width = video->width;
+    if (height > video->height) height = video->height;
+
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, stride / 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+                    CVPixelBufferGetBaseAddress(frame));
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    CVPixelBufferUnlockBaseAddress(frame, kCVPixelBufferLock_ReadOnly);
+}
+
+bool platform_video_update_texture(PlatformVideo *video, double time, unsigned int texture_id)
+{
+    if (video == NULL || texture_id == 0) {
+        return false;
+    }
+
+    // Take the latest frame that is due; earlier ones are late and dropped
+    CVPixelBufferRef due = NULL;
+    pthread_mutex_lock(&video->mutex);
+    while (video->count > 0 && video->times[video->head] <= time) {
+        if (due != NULL) {
+            CVPixelBufferRelease(due);
+        }
+        due = video->frames[video->head];
+        video->head = (video->head + 1) % PLATFORM_VIDEO_QUEUE;
+        video->count--;
+    }
+    if (due != NULL) {
+        pthread_cond_signal(&video->space);
+    }
+    pthread_mutex_unlock(&video->mutex);
+
+    if (due == NULL) {
+        return false;
+    }
+    upload_frame(video, due, texture_id);
+    CVPixelBufferRelease(due);
+    return true;
+}
+
+bool platform_video_finished(PlatformVideo *video)
+{
+    if (video == NULL) {
+        return true;
+    }
+    pthread_mutex_lock(&video->mutex);
+    bool finished = video->ended && video->count == 0;
+    pthread_mutex_unlock(&video->mutex);
+    return finished;
+}
+
+// Helper: codec name of a format description, in ffprobe's terms where known
+static void codec_name(CMFormatDescriptionRef format, char *out, size_t out_size)
+{
+    FourCharCode subtype = CMFormatDescriptionGetMediaSubType(format);
+    const char *name = NULL;
+    switch (subtype) {
+        case kCMVideoCodecType_H264: name = "H264"; break;
+        case kCMVideoCodecType_HEVC:
+        case 'hev1': name = "HEVC"; break;
+        case kCMVideoCodecType_MPEG4Video: name = "MPEG4"; break;
+        case kCMVideoCodecType_AppleProRes422:
+        case kCMVideoCodecType_AppleProRes422HQ:
+        case kCMVideoCodecType_AppleProRes422LT:
+        case kCMVideoCodecType_AppleProRes422Proxy:
+        case kCMVideoCodecType_AppleProRes4444: name = "PRORES"; break;
+        case kCMVideoCodecType_JPEG: name = "MJPEG"; break;
+        default: break;
+    }
+    if (name != NULL) {
+        snprintf(out, out_size, "%s", name);
+        return;
+    }
+
+    // Unknown: the four-character code itself
+    char code[5] = {
+        (char)((subtype >> 24) & 0xFF), (char)((subtype >> 16) & 0xFF),
+        (char)((subtype >> 8) & 0xFF), (char)(subtype & 0xFF), '\0'
+    };
+    for (int i = 0; i < 4; i++) {
+        code[i] = (char)toupper((unsigned char)code[i]);
+    }
+    snprintf(out, out_size, "%s", code);
+}
+
+// Helper: bits per component of a format description (8 when not recorded)
+static int codec_bit_depth(CMFormatDescriptionRef format)
+{
+    CFNumberRef bits = CMFormatDescriptionGetExtension(format, CFSTR("BitsPerComponent"));
+    int value = 0;
+    if (bits != NULL && CFGetTypeID(bits) == CFNumberGetTypeID()) {
+        CFNumberGetValue(bits, kCFNumberIntType, &value);
+    }
+    return value > 0 ? value : 8;
+}
+
+// Helper: write a CGImage as a PNG
+static bool write_png(CGImageRef image, const char *path)
+{
+    NSURL *url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:path]];
+    CGImageDestinationRef destination = CGImageDestinationCreateWithURL((__bridge CFURLRef)url,
+                                                                        CFSTR("public.png"), 1, NULL);
+    bool ok = false;
+    if (destination != NULL) {
+        CGImageDestinationAddImage(destination, image, NULL);
+        ok = CGImageDestinationFinalize(destination);
+        CFRelease(destination);
+    }
+    return ok;
+}
+
+// Helper: write the keyframe nearest time as a PNG no wider than max_width
+static bool write_thumbnail(AVAsset *asset, double time, int max_width, const char *path)
+{
+    AVAssetImageGenerator *generator = [AVAssetImageGenerator assetImageGeneratorWithAsset:asset];
+    generator.appliesPreferredTrackTransform = YES;
+    generator.maximumSize = CGSizeMake(max_width, max_width * 4);
+    // Any keyframe near the time will do; decoding up to an exact frame costs far more
+    generator.requestedTimeToleranceBefore = kCMTimePositiveInfinity;
+    generator.requestedTimeToleranceAfter = kCMTimePositiveInfinity;
+
+    CGImageRef image = [generator copyCGImageAtTime:CMTimeMakeWithSeconds(time, 600) actualTime:NULL error:NULL];
+    if (image == NULL) {
+        return false;
+    }
+
+    bool ok = write_png(image, path);
+    CGImageRelease(image);
+    return ok;
+}
+
+bool platform_video_probe(const char *path, PlatformVideoInfo *info,
+                          const char *thumbnail_path, int max_width)
+{
+    if (path == NULL || info == NULL) {
+        return false;
+    }
+    memset(info, 0, sizeof(*info));
+
+    @autoreleasepool {
+        NSURL *url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:path]];
+        AVURLAsset *asset = [AVURLAsset URLAssetWithURL:url options:nil];
+        AVAssetTrack *track = [asset tracksWithMediaType:AVMediaTypeVideo].firstObject;
+        if (track == nil) {
+            return false;
+        }
+
+        CGSize size = track.naturalSize;
+        info->width = (int)size.width;
+        info->height = (int)size.height;
+        info->fps = track.nominalFrameRate;
+        double duration = CMTimeGetSeconds(asset.duration);
+        info->duration = isfinite(duration) && duration > 0 ? (float)duration : 0.0f;
+
+        CMFormatDescriptionRef format = (__bridge CMFormatDescriptionRef)track.formatDescriptions.firstObject;
+        if (format != NULL) {
+            codec_name(format, info->codec, sizeof(info->codec));
+            info->bit_depth = codec_bit_depth(format);
+        } else {
+            info->bit_depth = 8;
+        }
+
+        if (thumbnail_path != NULL && max_width > 0) {
+            // One second in, past any fade from black; the start for short clips
+            double time = info->duration > 1.0f ? 1.0 : 0.0;
+            write_thumbnail(asset, time, max_width, thumbnail_path);
+        }
+        return info->width > 0 && info->height > 0;
+    }
+}
+
+bool platform_video_sprite_sheet(const char *path, const char *sheet_path,
+                                 int columns, int rows, int frame_width)
+{
+    if (path == NULL || sheet_path == NULL || columns <= 0 || rows <= 0 || frame_width <= 0) {
+        return false;
+    }
+
+    @autoreleasepool {
+        NSURL *url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:path]];
+        AVURLAsset *asset = [AVURLAsset URLAssetWithURL:url options:nil];
+        AVAssetTrack *track = [asset tracksWithMediaType:AVMediaTypeVideo].firstObject;
+        double duration = CMTimeGetSeconds(asset.duration);
+        if (track == nil || !isfinite(duration) || duration <= 0) {
+            return false;
+        }
+
+        // Frame size upright, as the generator hands the frames back
+        CGSize size = CGSizeApplyAffineTransform(track.naturalSize, track.preferredTransform);
+        double width = fabs(size.width);
+        double height = fabs(size.height);
+        if (width < 1 || height < 1) {
+            return false;
+        }
+        int frame_height = (int)lround(frame_width * height / width);
+        if (frame_height < 1) frame_height = 1;
+        if (frame_height > frame_width * 4) frame_height = frame_width * 4;
+
+        AVAssetImageGenerator *generator = [AVAssetImageGenerator assetImageGeneratorWithAsset:asset];
+        generator.appliesPreferredTrackTransform = YES;
+        generator.maximumSize = CGSizeMake(frame_width, frame_height);
+        // The keyframe nearest each time: nothing between keyframes is decoded
+        generator.requestedTimeToleranceBefore = kCMTimePositiveInfinity;
+        generator.requestedTimeToleranceAfter = kCMTimePositiveInfinity;
+
+        int sheet_width = frame_width * columns;
+        int sheet_height = frame_height * rows;
+        CGColorSpaceRef space = CGColorSpaceCreateDeviceRGB();
+        CGContextRef context = CGBitmapContextCreate(NULL, sheet_width, sheet_height, 8, 0, space,
+                                                     kCGImageAlphaPremultipliedLast);
+        CGColorSpaceRelease(space);
+        if (context == NULL) {
+            return false;
+        }
+        CGContextSetRGBFillColor(context, 0, 0, 0, 1);
+        CGContextFillRect(context, CGRectMake(0, 0, sheet_width, sheet_height));
+
+        int count = columns * rows;
+        int drawn = 0;
+        for (int i = 0; i < count; i++) {
+            // The middle of each of count equal spans, so neither end is a black frame
+            CMTime time = CMTimeMakeWithSeconds(duration * (i + 0.5) / count, 600);
+            CGImageRef image = [generator copyCGImageAtTime:time actualTime:NULL error:NULL];
+            if (image == NULL) {
+                continue;
+            }
+            // Bitmap contexts count rows from the bottom
+            CGRect cell = CGRectMake((i % columns) * frame_width,
+                                     sheet_height - (i / columns + 1) * frame_height,
+                                     frame_width, frame_height);
+            CGContextDrawImage(context, cell, image);
+            CGImageRelease(image);
+            drawn++;
+        }
+
+        bool ok = false;
+        CGImageRef sheet = drawn > 0 ? CGBitmapContextCreateImage(context) : NULL;
+        if (sheet != NULL) {
+            ok = write_png(sheet, sheet_path);
+            CGImageRelease(sheet);
+        }
+        CGContextRelease(context);
+        return ok;
+    }
+}
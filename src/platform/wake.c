@@ -0,0 +1,99 @@
+#include "wake.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+// GLFW is built into raylib; posting an empty event returns the main thread from its
+// wait, and is safe from any thread
+extern void glfwPostEmptyEvent(void);
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;         // Idle interval changed, or stopping
+    pthread_t thread;
+    bool running;
+    bool stopping;
+    double interval;                // 0: not idle
+    atomic_bool live;               // Window exists: wakes are posted
+} g_wake = { .mutex = PTHREAD_MUTEX_INITIALIZER, .changed = PTHREAD_COND_INITIALIZER };
+
+void platform_wake_main_loop(void)
+{
+    if (atomic_load(&g_wake.live)) {
+        glfwPostEmptyEvent();
+    }
+}
+
+// Thread function: Wake the main loop every interval while it is idle
+static void *wake_thread(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&g_wake.mutex);
+    while (!g_wake.stopping) {
+        if (g_wake.interval <= 0.0) {
+            pthread_cond_wait(&g_wake.changed, &g_wake.mutex);
+            continue;
+        }
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        double whole = (double)(long)g_wake.interval;
+        deadline.tv_sec += (time_t)whole;
+        deadline.tv_nsec += (long)((g_wake.interval - whole) * 1e9);
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        // Woken early when the interval changes: start over with the new one
+        if (pthread_cond_timedwait(&g_wake.changed, &g_wake.mutex, &deadline) == ETIMEDOUT &&
+            g_wake.interval > 0.0 && !g_wake.stopping) {
+            platform_wake_main_loop();
+        }
+    }
+    pthread_mutex_unlock(&g_wake.mutex);
+    return NULL;
+}
+
+bool platform_wake_start(void)
+{
+    pthread_mutex_lock(&g_wake.mutex);
+    if (!g_wake.running) {
+        g_wake.stopping = false;
+        g_wake.interval = 0.0;
+        g_wake.running = pthread_create(&g_wake.thread, NULL, wake_thread, NULL) == 0;
+    }
+    bool running = g_wake.running;
+    atomic_store(&g_wake.live, true);
+    pthread_mutex_unlock(&g_wake.mutex);
+    return running;
+}
+
+void platform_wake_stop(void)
+{
+    atomic_store(&g_wake.live, false);
+
+    pthread_mutex_lock(&g_wake.mutex);
+    bool running = g_wake.running;
+    g_wake.stopping = true;
+    g_wake.running = false;
+    pthread_cond_broadcast(&g_wake.changed);
+    pthread_mutex_unlock(&g_wake.mutex);
+
+    if (running) {
+        pthread_join(g_wake.thread, NULL);
+    }
+}
+
+void platform_wake_set_idle(double interval)
+{
+    pthread_mutex_lock(&g_wake.mutex);
+    if (g_wake.interval != interval) {
+        g_wake.interval = interval;
+        pthread_cond_broadcast(&g_wake.changed);
+    }
+    pthread_mutex_unlock(&g_wake.mutex);
+}
@@ -0,0 +1,22 @@
+#ifndef PLATFORM_WAKE_H
+#define PLATFORM_WAKE_H
+
+#include <stdbool.h>
+
+// Waking the main loop while it sleeps waiting for input (raylib's event waiting). Other
+// threads wake it when they have news for the UI, and while the app is idle a heartbeat
+// wakes it periodically so work polled once per frame still advances
+
+// Start the heartbeat thread; call once the window exists
+bool platform_wake_start(void);
+
+// Stop the heartbeat; call before the window closes (later wakes are ignored)
+void platform_wake_stop(void);
+
+// Heartbeat period while idle, in seconds; 0 while the loop runs every frame
+void platform_wake_set_idle(double interval);
+
+// Wake the main loop now (thread-safe)
+void platform_wake_main_loop(void);
+
+#endif // PLATFORM_WAKE_H
@@ -0,0 +1,207 @@
+// finder-plus-query: query the indexes of the running Finder Plus from a terminal or an
+// editor, through its query server (tools/query_server.h). Prints one path per line, or
+// the server's JSON response with --json. Exits 0 on success, 1 when the query failed,
+// 2 on bad usage and 3 when Finder Plus is not running
+#include "query_server.h"
+#include "../../external/cJSON/cJSON.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [--json] [--limit N] [--dir DIR] [--socket PATH] COMMAND ...\n"
+            "  semantic TEXT          Files whose contents match TEXT\n"
+            "  visual TEXT            Images that match TEXT\n"
+            "  similar IMAGE          Images that look like IMAGE\n"
+            "  name TEXT              Paths whose names match TEXT\n"
+            "  find DIR GLOB [FILTER] Files below DIR named GLOB, e.g. find . '*.c' 'size>10k'\n"
+            "  status                 What the index holds and which searches are ready\n"
+            "  tool NAME JSON         Any read-only tool, given its JSON input\n",
+            program);
+}
+
+// Helper: An absolute path for the server, which does not share our directory
+static const char *absolute(const char *path, char *out)
+{
+    return realpath(path, out) ? out : path;
+}
+
+// Helper: The request line for a command; NULL on bad usage (caller frees)
+static char *build_request(int argc, char **argv, int limit, const char *dir)
+{
+    if (argc < 1) return NULL;
+    const char *command = argv[0];
+    char resolved[PATH_MAX];
+    char dir_resolved[PATH_MAX];
+    const char *scope = dir ? absolute(dir, dir_resolved) : NULL;
+
+    cJSON *request = cJSON_CreateObject();
+    cJSON *input = cJSON_CreateObject();
+    const char *tool = NULL;
+    if ((strcmp(command, "semantic") == 0 || strcmp(command, "visual") == 0) && argc == 2) {
+        tool = command[0] == 's' ? "semantic_search" : "visual_search";
+        cJSON_AddStringToObject(input, "query", argv[1]);
+        cJSON_AddStringToObject(input, "directory", scope ? scope : "/");
+        if (limit > 0) cJSON_AddNumberToObject(input, "max_results", limit);
+    } else if (strcmp(command, "similar") == 0 && argc == 2) {
+        tool = "similar_images";
+        cJSON_AddStringToObject(input, "image_path", absolute(argv[1], resolved));
+        if (limit > 0) cJSON_AddNumberToObject(input, "max_results", limit);
+    } else if (strcmp(command, "name") == 0 && argc == 2) {
+        tool = "name_search";
+        cJSON_AddStringToObject(input, "query", argv[1]);
+        if (limit > 0) cJSON_AddNumberToObject(input, "max_results", limit);
+    } else if (strcmp(command, "find") == 0 && (argc == 3 || argc == 4)) {
+        tool = "file_search";
+        cJSON_AddStringToObject(input, "path", absolute(argv[1], resolved));
+        cJSON_AddStringToObject(input, "pattern", argv[2]);
+        cJSON_AddBoolToObject(input, "recursive", true);
+        if (argc == 4) cJSON_AddStringToObject(input, "filter", argv[3]);
+    } else if (strcmp(command, "status") == 0 && argc == 1) {
+        tool = "status";
+    } else if (strcmp(command, "tool") == 0 && argc == 3) {
+        tool = argv[1];
+        cJSON_Delete(input);
+        input = cJSON_Parse(argv[2]);
+        if (!input) {
+            fprintf(stderr, "Invalid JSON input: %s\n", argv[2]);
+            cJSON_Delete(request);
+            return NULL;
+        }
+    } else {
+        cJSON_Delete(input);
+        cJSON_Delete(request);
+        return NULL;
+    }
+
+    cJSON_AddStringToObject(request, "tool", tool);
+    cJSON_AddItemToObject(request, "input", input);
+    char *line = cJSON_PrintUnformatted(request);
+    cJSON_Delete(request);
+    return line;
+}
+
+// Helper: Send a request and read the response line (caller frees); NULL if unreachable
+static char *exchange(const char *socket_path, const char *request)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) return NULL;
+    strcpy(addr.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return NULL;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        write(fd, request, strlen(request)) < 0 || write(fd, "\n", 1) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t capacity = 64 * 1024;
+    size_t length = 0;
+    char *response = malloc(capacity);
+    while (response) {
+        if (length + 1 == capacity) {
+            char *grown = realloc(response, capacity * 2);
+            if (!grown) {
+                free(response);
+                response = NULL;
+                break;
+            }
+            response = grown;
+            capacity *= 2;
+        }
+        ssize_t got = read(fd, response + length, capacity - length - 1);
+        if (got <= 0) break;
+        char *newline = memchr(response + length, '\n', (size_t)got);
+        length += (size_t)got;
+        if (newline) {
+            length = (size_t)(newline - response);
+            break;
+        }
+    }
+    close(fd);
+    if (response) response[length] = '\0';
+    return response;
+}
+
+// Helper: Print the paths of a result, one per line
+static void print_paths(const cJSON *result)
+{
+    const cJSON *item;
+    cJSON_ArrayForEach(item, cJSON_GetObjectItem(result, "results")) {
+        const cJSON *path = cJSON_GetObjectItem(item, "path");
+        if (cJSON_IsString(path)) puts(path->valuestring);
+    }
+    cJSON_ArrayForEach(item, cJSON_GetObjectItem(result, "matches")) {
+        if (cJSON_IsString(item)) puts(item->valuestring);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool json = false;
+    int limit = 0;
+    const char *dir = NULL;
+    const char *socket_arg = NULL;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+            limit = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_arg = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    char *request = build_request(argc - i, argv + i, limit, dir);
+    if (!request) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    char socket_path[PATH_MAX];
+    const char *home = getenv("HOME");
+    snprintf(socket_path, sizeof(socket_path), "%s", socket_arg ? socket_arg : "");
+    if (!socket_arg && home) {
+        snprintf(socket_path, sizeof(socket_path), "%s/" QUERY_SERVER_SOCKET, home);
+    }
+    char *line = exchange(socket_path, request);
+    free(request);
+    if (!line) {
+        fprintf(stderr, "Finder Plus is not running (no query server at %s)\n", socket_path);
+        return 3;
+    }
+
+    cJSON *response = cJSON_Parse(line);
+    bool ok = response && cJSON_IsTrue(cJSON_GetObjectItem(response, "ok"));
+    if (json) {
+        puts(line);
+    } else if (ok && strcmp(argv[i], "status") == 0) {
+        char *text = cJSON_Print(cJSON_GetObjectItem(response, "result"));
+        if (text) puts(text);
+        free(text);
+    } else if (ok) {
+        print_paths(cJSON_GetObjectItem(response, "result"));
+    } else {
+        const cJSON *error = cJSON_GetObjectItem(response, "error");
+        fprintf(stderr, "%s\n", cJSON_IsString(error) ? error->valuestring : "Malformed response");
+    }
+    cJSON_Delete(response);
+    free(line);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,393 @@
+#include "query_server.h"
+#include "tool_executor.h"
+#include "../ai/semantic_search.h"
+#include "../ai/visual_search.h"
+#include "../ai/path_index.h"
+#include "../../external/cJSON/cJSON.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define QUERY_IDLE_TIMEOUT 60           // Seconds a connection may sit without a request
+
+// One connection and the thread serving it
+typedef struct QueryClient {
+    int fd;                             // -1 once its thread is done with it
+    pthread_t thread;
+    bool used;
+    struct QueryServer *server;
+} QueryClient;
+
+struct QueryServer {
+    int listen_fd;
+    int stop_pipe[2];
+    pthread_t thread;
+    pthread_mutex_t mutex;              // Guards clients
+    QueryClient clients[QUERY_SERVER_MAX_CLIENTS];
+    QueryServerSources sources;
+    ToolExecutor *executor;
+    char socket_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+};
+
+// Helper: Write all of length bytes; false on error
+static bool query_write_all(int fd, const char *data, size_t length)
+{
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+// Helper: name_search, answered from the filename index
+static bool query_name_search(QueryServer *server, cJSON *input, cJSON *response)
+{
+    cJSON *query = cJSON_GetObjectItem(input, "query");
+    cJSON *max_results = cJSON_GetObjectItem(input, "max_results");
+    if (!query || !cJSON_IsString(query)) {
+        cJSON_AddStringToObject(response, "error", "Missing or invalid 'query' parameter");
+        return false;
+    }
+    if (!server->sources.path_index) {
+        cJSON_AddStringToObject(response, "error", "The filename index is not available");
+        return false;
+    }
+
+    int limit = max_results && cJSON_IsNumber(max_results) ? (int)max_results->valuedouble
+                                                           : QUERY_SERVER_NAME_RESULTS;
+    if (limit < 1) limit = 1;
+    if (limit > 1000) limit = 1000;
+
+    PathIndexResults found;
+    if (!path_index_query(server->sources.path_index, query->valuestring, limit, &found)) {
+        cJSON_AddStringToObject(response, "error", "Name search failed");
+        return false;
+    }
+
+    cJSON *result = cJSON_AddObjectToObject(response, "result");
+    cJSON *matches = cJSON_AddArrayToObject(result, "results");
+    for (int i = 0; i < found.count; i++) {
+        cJSON *match = cJSON_CreateObject();
+        cJSON_AddStringToObject(match, "path", found.paths[i]);
+        cJSON_AddNumberToObject(match, "score", found.scores[i]);
+        cJSON_AddItemToArray(matches, match);
+    }
+    cJSON_AddNumberToObject(result, "count", found.count);
+    cJSON_AddNumberToObject(result, "total", found.total);
+    path_index_results_free(&found);
+    return true;
+}
+
+// Helper: status, what the server can answer right now
+static bool query_status(QueryServer *server, cJSON *response)
+{
+    const QueryServerSources *sources = &server->sources;
+    cJSON *result = cJSON_AddObjectToObject(response, "result");
+    cJSON_AddNumberToObject(result, "paths", sources->path_index ? path_index_count(sources->path_index) : 0);
+    cJSON_AddBoolToObject(result, "semantic_search",
+                          sources->semantic_search && semantic_search_is_ready(sources->semantic_search));
+    cJSON_AddBoolToObject(result, "visual_search",
+                          sources->visual_search && visual_search_is_ready(sources->visual_search));
+    return true;
+}
+
+// Helper: A read-only tool of the executor; its JSON output is passed through as is
+static bool query_tool(QueryServer *server, const char *tool, cJSON *input, cJSON *response)
+{
+    if (!tool_executor_is_read_only(tool)) {
+        char message[128];
+        snprintf(message, sizeof(message), "Unknown or mutating tool: %.64s", tool);
+        cJSON_AddStringToObject(response, "error", message);
+        return false;
+    }
+
+    char *input_json = input ? cJSON_PrintUnformatted(input) : NULL;
+    ToolResult result = tool_executor_execute(server->executor, tool, input_json ? input_json : "{}");
+    free(input_json);
+
+    bool ok = result.success;
+    if (ok) {
+        cJSON *output = result.output ? cJSON_Parse(result.output) : NULL;
+        cJSON_AddItemToObject(response, "result", output ? output : cJSON_CreateString(result.output ? result.output : ""));
+    } else {
+        cJSON_AddStringToObject(response, "error", result.error ? result.error : "Tool failed");
+    }
+    tool_result_cleanup(&result);
+    return ok;
+}
+
+// Helper: Answer one request line; returns the response line (caller frees)
+static char *query_respond(QueryServer *server, const char *line)
+{
+    cJSON *request = cJSON_Parse(line);
+    cJSON *response = cJSON_CreateObject();
+    cJSON *id = request ? cJSON_GetObjectItem(request, "id") : NULL;
+    if (id) {
+        cJSON_AddItemToObject(response, "id", cJSON_Duplicate(id, true));
+    }
+
+    cJSON *ok = cJSON_AddFalseToObject(response, "ok");
+    cJSON *tool = request ? cJSON_GetObjectItem(request, "tool") : NULL;
+    cJSON *input = request ? cJSON_GetObjectItem(request, "input") : NULL;
+    bool success = false;
+    if (!tool || !cJSON_IsString(tool) || (input && !cJSON_IsObject(input))) {
+        cJSON_AddStringToObject(response, "error", "Expected {\"tool\": NAME, \"input\": {...}}");
+    } else if (strcmp(tool->valuestring, "name_search") == 0) {
+        success = query_name_search(server, input, response);
+    } else if (strcmp(tool->valuestring, "status") == 0) {
+        success = query_status(server, response);
+    } else {
+        success = query_tool(server, tool->valuestring, input, response);
+    }
+    if (success) {
+        cJSON_SetBoolValue(ok, true);
+    }
+
+    char *text = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
+    cJSON_Delete(request);
+    return text;
+}
+
+// Thread function: Answer a connection's requests until it closes
+static void *query_client_thread(void *arg)
+{
+    QueryClient *client = (QueryClient *)arg;
+    QueryServer *server = client->server;
+    int fd = client->fd;
+
+    struct timeval timeout = { QUERY_IDLE_TIMEOUT, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    char *buffer = malloc(QUERY_SERVER_MAX_REQUEST + 1);
+    size_t length = 0;
+    bool open = buffer != NULL;
+    while (open) {
+        ssize_t got = read(fd, buffer + length, QUERY_SERVER_MAX_REQUEST - length);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        length += (size_t)got;
+
+        // Every complete line is a request
+        char *start = buffer;
+        char *newline;
+        while (open && (newline = memchr(start, '\n', length - (size_t)(start - buffer))) != NULL) {
+            *newline = '\0';
+            if (newline > start) {
+                char *reply = query_respond(server, start);
+                open = reply && query_write_all(fd, reply, strlen(reply)) && query_write_all(fd, "\n", 1);
+                free(reply);
+            }
+            start = newline + 1;
+        }
+        length -= (size_t)(start - buffer);
+        memmove(buffer, start, length);
+
+        // A line longer than any request is refused, and the connection with it
+        if (length == QUERY_SERVER_MAX_REQUEST) {
+            const char *refusal = "{\"ok\":false,\"error\":\"Request too long\"}\n";
+            query_write_all(fd, refusal, strlen(refusal));
+            break;
+        }
+    }
+    free(buffer);
+
+    pthread_mutex_lock(&server->mutex);
+    close(fd);
+    client->fd = -1;
+    pthread_mutex_unlock(&server->mutex);
+    return NULL;
+}
+
+// Helper: Join the threads of connections that have closed (under the mutex)
+static void query_reap_locked(QueryServer *server)
+{
+    for (int i = 0; i < QUERY_SERVER_MAX_CLIENTS; i++) {
+        QueryClient *client = &server->clients[i];
+        if (client->used && client->fd < 0) {
+            pthread_join(client->thread, NULL);
+            client->used = false;
+        }
+    }
+}
+
+// Thread function: Accept connections until stopped
+static void *query_listen_thread(void *arg)
+{
+    QueryServer *server = (QueryServer *)arg;
+
+    for (;;) {
+        struct pollfd fds[2] = {
+            { .fd = server->listen_fd, .events = POLLIN },
+            { .fd = server->stop_pipe[0], .events = POLLIN },
+        };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        pthread_mutex_lock(&server->mutex);
+        query_reap_locked(server);
+        QueryClient *client = NULL;
+        for (int i = 0; i < QUERY_SERVER_MAX_CLIENTS && !client; i++) {
+            if (!server->clients[i].used) client = &server->clients[i];
+        }
+        if (client) {
+            client->fd = fd;
+            client->server = server;
+            client->used = pthread_create(&client->thread, NULL, query_client_thread, client) == 0;
+        }
+        bool served = client && client->used;
+        pthread_mutex_unlock(&server->mutex);
+
+        if (!served) {
+            const char *busy = "{\"ok\":false,\"error\":\"Too many connections\"}\n";
+            query_write_all(fd, busy, strlen(busy));
+            close(fd);
+        }
+    }
+    return NULL;
+}
+
+// Helper: Whether a server already answers on socket_path
+static bool query_server_running(const struct sockaddr_un *addr)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    bool running = connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) == 0;
+    close(fd);
+    return running;
+}
+
+QueryServer* query_server_start(const char *socket_path, const QueryServerSources *sources)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (!socket_path || strlen(socket_path) >= sizeof(addr.sun_path)) {
+        return NULL;
+    }
+    strcpy(addr.sun_path, socket_path);
+    if (query_server_running(&addr)) {
+        return NULL;
+    }
+
+    QueryServer *server = calloc(1, sizeof(QueryServer));
+    if (!server) {
+        return NULL;
+    }
+    server->listen_fd = -1;
+    server->stop_pipe[0] = server->stop_pipe[1] = -1;
+    strcpy(server->socket_path, socket_path);
+    if (sources) {
+        server->sources = *sources;
+    }
+
+    // Searches default to the whole index rather than this process's directory
+    server->executor = tool_executor_create(NULL);
+    if (!server->executor) {
+        free(server);
+        return NULL;
+    }
+    tool_executor_set_cwd(server->executor, "/");
+    // Callers here are scripts and editors, which want whole results
+    tool_executor_set_result_budget(server->executor, TOOL_RESULT_NO_BUDGET);
+    tool_executor_set_semantic_search(server->executor, server->sources.semantic_search);
+    tool_executor_set_visual_search(server->executor, server->sources.visual_search);
+    tool_executor_set_path_index(server->executor, server->sources.path_index, server->sources.path_indexer);
+
+    unlink(socket_path);
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server->listen_fd < 0 || bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        goto fail;
+    }
+    chmod(socket_path, 0600);
+    if (listen(server->listen_fd, QUERY_SERVER_MAX_CLIENTS) != 0 || pipe(server->stop_pipe) != 0) {
+        goto fail;
+    }
+    fcntl(server->listen_fd, F_SETFD, FD_CLOEXEC);
+    fcntl(server->stop_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(server->stop_pipe[1], F_SETFD, FD_CLOEXEC);
+
+    pthread_mutex_init(&server->mutex, NULL);
+    if (pthread_create(&server->thread, NULL, query_listen_thread, server) != 0) {
+        pthread_mutex_destroy(&server->mutex);
+        goto fail;
+    }
+    return server;
+
+fail:
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+        unlink(socket_path);
+    }
+    if (server->stop_pipe[0] >= 0) {
+        close(server->stop_pipe[0]);
+        close(server->stop_pipe[1]);
+    }
+    tool_executor_destroy(server->executor);
+    free(server);
+    return NULL;
+}
+
+void query_server_stop(QueryServer *server)
+{
+    if (!server) {
+        return;
+    }
+
+    query_write_all(server->stop_pipe[1], "x", 1);
+    pthread_join(server->thread, NULL);
+    close(server->listen_fd);
+    unlink(server->socket_path);
+
+    // Connections still open are cut off; a request being answered finishes first
+    pthread_mutex_lock(&server->mutex);
+    for (int i = 0; i < QUERY_SERVER_MAX_CLIENTS; i++) {
+        if (server->clients[i].used && server->clients[i].fd >= 0) {
+            shutdown(server->clients[i].fd, SHUT_RDWR);
+        }
+    }
+    pthread_mutex_unlock(&server->mutex);
+    for (int i = 0; i < QUERY_SERVER_MAX_CLIENTS; i++) {
+        if (server->clients[i].used) {
+            pthread_join(server->clients[i].thread, NULL);
+        }
+    }
+
+    close(server->stop_pipe[0]);
+    close(server->stop_pipe[1]);
+    pthread_mutex_destroy(&server->mutex);
+    tool_executor_destroy(server->executor);
+    free(server);
+}
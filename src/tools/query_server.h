@@ -0,0 +1,52 @@
+#ifndef QUERY_SERVER_H
+#define QUERY_SERVER_H
+
+#include <stdbool.h>
+
+// Serves the app's indexes to local clients (the finder-plus-query CLI, editor plugins)
+// over a Unix socket, so they share the models and databases already loaded instead of
+// opening their own. Each request is one line of JSON and gets one line back:
+//
+//   {"id": 1, "tool": "semantic_search", "input": {"query": "tax returns"}}
+//   {"id": 1, "ok": true, "result": {"results": [...], "count": 3, ...}}
+//   {"id": 1, "ok": false, "error": "Missing or invalid 'query' parameter"}
+//
+// The read-only tools of tools/tool_executor.h are served with their usual input and
+// output (semantic_search, visual_search, similar_images, file_search with its filter,
+// file_list, file_metadata). Two more are answered here:
+//
+//   name_search  {"query": "report 2024", "max_results": 50}: the filename index's
+//                ranked name search, as the search bar does
+//   status       {}: how many paths are indexed and which searches are ready
+//
+// "id" is optional and echoed back. A connection may send any number of requests; each
+// connection is served on a thread of its own, so queries do not wait for the UI
+
+#define QUERY_SERVER_SOCKET ".config/finder-plus/query.sock"   // Below $HOME
+#define QUERY_SERVER_MAX_CLIENTS 8
+#define QUERY_SERVER_MAX_REQUEST (64 * 1024)   // Longest request line
+#define QUERY_SERVER_NAME_RESULTS 50           // name_search results by default
+
+struct SemanticSearch;
+struct VisualSearch;
+struct PathIndex;
+struct Indexer;
+
+// What the server answers from; every one is optional and must outlive the server
+typedef struct QueryServerSources {
+    struct SemanticSearch *semantic_search;
+    struct VisualSearch *visual_search;
+    struct PathIndex *path_index;
+    struct Indexer *path_indexer;       // Keeps path_index current (file_search asks it)
+} QueryServerSources;
+
+// Server (opaque)
+typedef struct QueryServer QueryServer;
+
+// Listen on socket_path (replacing one left behind); NULL if another server answers there
+QueryServer* query_server_start(const char *socket_path, const QueryServerSources *sources);
+
+// Stop listening, end every connection and remove the socket
+void query_server_stop(QueryServer *server);
+
+#endif // QUERY_SERVER_H
@@ -1,16 +1,29 @@
 #include "tool_executor.h"
 #include "../core/operations.h"
+#include "../core/operation_queue.h"
+#include "../core/stat_cache.h"
+#include "../core/undo_log.h"
 #include "../core/filesystem.h"
+#include "../core/file_find.h"
+#include "../core/content_search.h"
+#include "../core/filter_query.h"
+#include "../core/spotlight_search.h"
+#include "../utils/file_type.h"
 #include "../ai/semantic_search.h"
 #include "../ai/visual_search.h"
+#include "../ai/path_index.h"
+#include "../ai/indexer.h"
 #include "../api/gemini_client.h"
 #include "../../external/cJSON/cJSON.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include <dirent.h>
+#include <stdint.h>
 #include <sys/stat.h>
-#include <fnmatch.h>
+#include <time.h>
 #include <unistd.h>
 
 // Debug logging for tool executor (set to 1 or use -DTOOL_DEBUG=1)
@@ -55,6 +68,25 @@ void tool_executor_set_semantic_search(ToolExecutor *executor, SemanticSearch *s
     executor->semantic_search = search;
 }
 
+void tool_executor_set_path_index(ToolExecutor *executor, struct PathIndex *index, struct Indexer *indexer)
+{
+    if (!executor) return;
+    executor->path_index = index;
+    executor->path_indexer = indexer;
+}
+
+void tool_executor_set_operation_queue(ToolExecutor *executor, struct OperationQueue *queue)
+{
+    if (!executor) return;
+    executor->operation_queue = queue;
+}
+
+void tool_executor_set_undo_group(ToolExecutor *executor, uint64_t group)
+{
+    if (!executor) return;
+    executor->undo_group = group;
+}
+
 void tool_executor_set_visual_search(ToolExecutor *executor, VisualSearch *search)
 {
     if (!executor) return;
@@ -67,8 +99,266 @@ void tool_executor_set_gemini_client(ToolExecutor *executor, GeminiClient *clien
     executor->gemini_client = client;
 }
 
-// Execute file_list tool
-static ToolResult execute_file_list(ToolExecutor *executor __attribute__((unused)), cJSON *input)
+void tool_executor_set_result_budget(ToolExecutor *executor, int tokens)
+{
+    if (!executor) return;
+    executor->result_token_budget = tokens;
+}
+
+//=============================================================================
+// Result pages (see TOOL_RESULT_TOKEN_BUDGET)
+//=============================================================================
+
+// JSON bytes counted as one token when sizing a page
+#define TOOL_RESULT_BYTES_PER_TOKEN 4
+
+// Largest files, busiest folders and the like listed in a summary
+#define TOOL_RESULT_TOP_N 5
+
+// Names of FileTypeClass values in summaries
+static const char *const KIND_NAMES[FILE_CLASS_COUNT] = {
+    "other", "text", "markdown", "code", "data", "document", "spreadsheet", "presentation",
+    "image", "video", "audio", "archive", "installer", "database", "font", "application"
+};
+
+// One page of a list result being built
+typedef struct ResultPage {
+    int total;              // Entries in the whole result
+    int offset;             // First entry of the page
+    int limit;              // Most entries the call asked for
+    size_t budget;          // JSON bytes the page's entries may take
+    size_t used;
+    int returned;
+    int summary;            // 1 or 0 as asked, -1 to add one when the page is partial
+} ResultPage;
+
+// Helper: Read a page's bounds from a call's input (offset, limit, max_tokens, summary)
+static void result_page_init(ResultPage *page, const ToolExecutor *executor, cJSON *input, int total)
+{
+    cJSON *offset = cJSON_GetObjectItem(input, "offset");
+    cJSON *limit = cJSON_GetObjectItem(input, "limit");
+    cJSON *max_tokens = cJSON_GetObjectItem(input, "max_tokens");
+    cJSON *summary = cJSON_GetObjectItem(input, "summary");
+
+    memset(page, 0, sizeof(*page));
+    page->total = total;
+    page->offset = cJSON_IsNumber(offset) && offset->valuedouble > 0 ? (int)offset->valuedouble : 0;
+    if (page->offset > total) {
+        page->offset = total;
+    }
+    page->limit = cJSON_IsNumber(limit) && limit->valuedouble >= 0 && limit->valuedouble < INT_MAX
+                  ? (int)limit->valuedouble : INT_MAX;
+    page->summary = cJSON_IsBool(summary) ? cJSON_IsTrue(summary) : -1;
+
+    int tokens = executor->result_token_budget ? executor->result_token_budget : TOOL_RESULT_TOKEN_BUDGET;
+    if (cJSON_IsNumber(max_tokens) && max_tokens->valuedouble >= 1 &&
+        (tokens < 0 || max_tokens->valuedouble < tokens)) {
+        tokens = (int)max_tokens->valuedouble;
+    }
+    page->budget = tokens < 0 ? SIZE_MAX : (size_t)tokens * TOOL_RESULT_BYTES_PER_TOKEN;
+}
+
+// Helper: Add an entry to the page if it fits (taking it either way); false once full.
+// The first entry always fits, so every page moves on
+static bool result_page_add(ResultPage *page, cJSON *entries, cJSON *entry)
+{
+    if (page->returned >= page->limit) {
+        cJSON_Delete(entry);
+        return false;
+    }
+    char *text = cJSON_PrintUnformatted(entry);
+    size_t size = text ? strlen(text) + 1 : 0;
+    free(text);
+    if (page->returned > 0 && page->budget - page->used < size) {
+        cJSON_Delete(entry);
+        return false;
+    }
+    page->used += size < page->budget - page->used ? size : page->budget - page->used;
+    page->returned++;
+    cJSON_AddItemToArray(entries, entry);
+    return true;
+}
+
+// Helper: Whether the reply should carry a summary of the whole result
+static bool result_page_wants_summary(const ResultPage *page)
+{
+    return page->summary == 1 || (page->summary == -1 && page->returned < page->total);
+}
+
+// Helper: Add where the page sits in the whole result
+static void result_page_finish(const ResultPage *page, cJSON *output)
+{
+    cJSON_AddNumberToObject(output, "total", page->total);
+    cJSON_AddNumberToObject(output, "offset", page->offset);
+    cJSON_AddNumberToObject(output, "returned", page->returned);
+    if (page->offset + page->returned < page->total) {
+        cJSON_AddNumberToObject(output, "next_offset", page->offset + page->returned);
+    }
+}
+
+// Helper: Add counts per kind (only the kinds present)
+static void summary_add_kinds(cJSON *summary, const int counts[FILE_CLASS_COUNT])
+{
+    cJSON *kinds = cJSON_CreateObject();
+    for (int i = 0; i < FILE_CLASS_COUNT; i++) {
+        if (counts[i] > 0) {
+            cJSON_AddNumberToObject(kinds, KIND_NAMES[i], counts[i]);
+        }
+    }
+    cJSON_AddItemToObject(summary, "by_kind", kinds);
+}
+
+// Helper: Kind of a file by its extension alone (summaries do not read files)
+static FileTypeClass summary_kind(const char *path)
+{
+    const char *name = strrchr(path, '/');
+    const char *dot = strrchr(name ? name + 1 : path, '.');
+    return dot && dot[1] ? file_type_class(file_type_from_extension(dot + 1)) : FILE_CLASS_NONE;
+}
+
+static int string_compare(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// Helper: Add the number of distinct strings as count_key and the TOOL_RESULT_TOP_N most
+// frequent as top_key ([{name, count}]). Sorts strings
+static void summary_add_top(cJSON *summary, const char *count_key, const char *top_key,
+                            const char **strings, int count)
+{
+    qsort(strings, (size_t)count, sizeof(char *), string_compare);
+
+    const char *top[TOOL_RESULT_TOP_N];
+    int top_counts[TOOL_RESULT_TOP_N];
+    int top_count = 0;
+    int distinct = 0;
+    for (int i = 0; i < count; ) {
+        int run = 1;
+        while (i + run < count && strcmp(strings[i], strings[i + run]) == 0) {
+            run++;
+        }
+        distinct++;
+
+        // Insert into the top list, most frequent first (ties keep path order)
+        int at = top_count;
+        while (at > 0 && top_counts[at - 1] < run) {
+            at--;
+        }
+        if (at < TOOL_RESULT_TOP_N) {
+            int last = top_count < TOOL_RESULT_TOP_N ? top_count : TOOL_RESULT_TOP_N - 1;
+            for (int j = last; j > at; j--) {
+                top[j] = top[j - 1];
+                top_counts[j] = top_counts[j - 1];
+            }
+            top[at] = strings[i];
+            top_counts[at] = run;
+            if (top_count < TOOL_RESULT_TOP_N) top_count++;
+        }
+        i += run;
+    }
+
+    cJSON_AddNumberToObject(summary, count_key, distinct);
+    cJSON *list = cJSON_CreateArray();
+    for (int i = 0; i < top_count; i++) {
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "name", top[i]);
+        cJSON_AddNumberToObject(item, "count", top_counts[i]);
+        cJSON_AddItemToArray(list, item);
+    }
+    cJSON_AddItemToObject(summary, top_key, list);
+}
+
+// Helper: Summary of a set of paths: kinds by extension and the folders holding most
+static cJSON *summary_of_paths(char *const *paths, int count)
+{
+    cJSON *summary = cJSON_CreateObject();
+    int kinds[FILE_CLASS_COUNT] = {0};
+    const char **folders = malloc((size_t)(count > 0 ? count : 1) * sizeof(char *));
+    char *names = NULL;
+    size_t names_size = 0;
+    for (int i = 0; i < count; i++) {
+        kinds[summary_kind(paths[i])]++;
+        names_size += strlen(paths[i]) + 1;
+    }
+    summary_add_kinds(summary, kinds);
+
+    names = malloc(names_size > 0 ? names_size : 1);
+    if (folders && names) {
+        char *at = names;
+        for (int i = 0; i < count; i++) {
+            const char *slash = strrchr(paths[i], '/');
+            size_t len = slash ? (size_t)(slash - paths[i]) : 0;
+            if (slash == paths[i]) len = 1;
+            memcpy(at, paths[i], len);
+            at[len] = '\0';
+            folders[i] = at;
+            at += len + 1;
+        }
+        summary_add_top(summary, "folders", "top_folders", folders, count);
+    }
+    free(folders);
+    free(names);
+    return summary;
+}
+
+// Helper: Summary of a listing: folders and files, files by kind and size, the largest
+static cJSON *summary_of_listing(const DirectoryState *dir)
+{
+    cJSON *summary = cJSON_CreateObject();
+    int kinds[FILE_CLASS_COUNT] = {0};
+    int folders = 0, small = 0, medium = 0, large = 0;
+    double total_size = 0;
+    int largest[TOOL_RESULT_TOP_N];
+    int largest_count = 0;
+
+    for (int i = 0; i < dir->count; i++) {
+        const FileEntry *entry = &dir->entries[i];
+        if (entry->is_directory) {
+            folders++;
+            continue;
+        }
+        kinds[file_type_class(entry->file_type)]++;
+        total_size += (double)entry->size;
+        if (entry->size < 1024 * 1024) small++;
+        else if (entry->size < 100LL * 1024 * 1024) medium++;
+        else large++;
+
+        int at = largest_count;
+        while (at > 0 && dir->entries[largest[at - 1]].size < entry->size) {
+            at--;
+        }
+        if (at < TOOL_RESULT_TOP_N) {
+            int last = largest_count < TOOL_RESULT_TOP_N ? largest_count : TOOL_RESULT_TOP_N - 1;
+            for (int j = last; j > at; j--) {
+                largest[j] = largest[j - 1];
+            }
+            largest[at] = i;
+            if (largest_count < TOOL_RESULT_TOP_N) largest_count++;
+        }
+    }
+
+    cJSON_AddNumberToObject(summary, "folders", folders);
+    cJSON_AddNumberToObject(summary, "files", dir->count - folders);
+    cJSON_AddNumberToObject(summary, "total_size", total_size);
+    summary_add_kinds(summary, kinds);
+    cJSON *sizes = cJSON_CreateObject();
+    cJSON_AddNumberToObject(sizes, "under_1MB", small);
+    cJSON_AddNumberToObject(sizes, "1MB_to_100MB", medium);
+    cJSON_AddNumberToObject(sizes, "over_100MB", large);
+    cJSON_AddItemToObject(summary, "by_size", sizes);
+    cJSON *top = cJSON_CreateArray();
+    for (int i = 0; i < largest_count; i++) {
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "name", directory_entry_name(dir, &dir->entries[largest[i]]));
+        cJSON_AddNumberToObject(item, "size", (double)dir->entries[largest[i]].size);
+        cJSON_AddItemToArray(top, item);
+    }
+    cJSON_AddItemToObject(summary, "largest", top);
+    return summary;
+}
+
+// Execute file_list tool, a page at a time
+static ToolResult execute_file_list(ToolExecutor *executor, cJSON *input)
 {
     ToolResult result;
     tool_result_init(&result);
@@ -96,26 +386,35 @@ static ToolResult execute_file_list(ToolExecutor *executor __attribute__((unused
     // Build JSON output
     cJSON *output = cJSON_CreateObject();
     cJSON *files = cJSON_CreateArray();
+    ResultPage page;
+    result_page_init(&page, executor, input, dir.count);
 
-    for (int i = 0; i < dir.count; i++) {
+    for (int i = page.offset; i < dir.count; i++) {
         cJSON *file = cJSON_CreateObject();
-        cJSON_AddStringToObject(file, "name", dir.entries[i].name);
+        cJSON_AddStringToObject(file, "name", directory_entry_name(&dir, &dir.entries[i]));
         cJSON_AddBoolToObject(file, "is_directory", dir.entries[i].is_directory);
         cJSON_AddNumberToObject(file, "size", (double)dir.entries[i].size);
         cJSON_AddBoolToObject(file, "is_hidden", dir.entries[i].is_hidden);
 
         char date_str[32];
-        strftime(date_str, sizeof(date_str), "%Y-%m-%d %H:%M:%S", localtime(&dir.entries[i].modified));
+        struct tm tm;
+        strftime(date_str, sizeof(date_str), "%Y-%m-%d %H:%M:%S", localtime_r(&dir.entries[i].modified, &tm));
         cJSON_AddStringToObject(file, "modified", date_str);
 
-        cJSON_AddItemToArray(files, file);
+        if (!result_page_add(&page, files, file)) {
+            break;
+        }
     }
 
     cJSON_AddItemToObject(output, "files", files);
     cJSON_AddNumberToObject(output, "count", dir.count);
     cJSON_AddStringToObject(output, "path", path);
+    result_page_finish(&page, output);
+    if (result_page_wants_summary(&page)) {
+        cJSON_AddItemToObject(output, "summary", summary_of_listing(&dir));
+    }
 
-    char *json_str = cJSON_Print(output);
+    char *json_str = cJSON_PrintUnformatted(output);
     cJSON_Delete(output);
 
     tool_result_set_success(&result, json_str, dir.count);
@@ -126,7 +425,7 @@ static ToolResult execute_file_list(ToolExecutor *executor __attribute__((unused
 }
 
 // Execute file_move tool
-static ToolResult execute_file_move(cJSON *input)
+static ToolResult execute_file_move(uint64_t undo_group, cJSON *input)
 {
     ToolResult result;
     tool_result_init(&result);
@@ -146,6 +445,7 @@ static ToolResult execute_file_move(cJSON *input)
     OperationResult op_result = file_move(source->valuestring, destination->valuestring);
 
     if (op_result == OP_SUCCESS) {
+        undo_log_moved(undo_log_shared(), undo_group, source->valuestring, operations_get_result_path());
         char msg[256];
         snprintf(msg, sizeof(msg), "Moved '%s' to '%s'", source->valuestring, destination->valuestring);
         tool_result_set_success(&result, msg, 1);
@@ -157,7 +457,7 @@ static ToolResult execute_file_move(cJSON *input)
 }
 
 // Execute file_copy tool
-static ToolResult execute_file_copy(cJSON *input)
+static ToolResult execute_file_copy(uint64_t undo_group, cJSON *input)
 {
     ToolResult result;
     tool_result_init(&result);
@@ -177,6 +477,7 @@ static ToolResult execute_file_copy(cJSON *input)
     OperationResult op_result = file_copy(source->valuestring, destination->valuestring);
 
     if (op_result == OP_SUCCESS) {
+        undo_log_created(undo_log_shared(), undo_group, operations_get_result_path());
         char msg[256];
         snprintf(msg, sizeof(msg), "Copied '%s' to '%s'", source->valuestring, destination->valuestring);
         tool_result_set_success(&result, msg, 1);
@@ -188,7 +489,7 @@ static ToolResult execute_file_copy(cJSON *input)
 }
 
 // Execute file_delete tool
-static ToolResult execute_file_delete(cJSON *input)
+static ToolResult execute_file_delete(uint64_t undo_group, cJSON *input)
 {
     ToolResult result;
     tool_result_init(&result);
@@ -204,17 +505,25 @@ static ToolResult execute_file_delete(cJSON *input)
 
     if (cJSON_IsArray(paths)) {
         int count = cJSON_GetArraySize(paths);
-        for (int i = 0; i < count; i++) {
-            cJSON *path_item = cJSON_GetArrayItem(paths, i);
-            if (path_item && cJSON_IsString(path_item)) {
-                if (file_delete(path_item->valuestring) == OP_SUCCESS) {
-                    deleted_count++;
-                }
+        const char **path_list = malloc((size_t)(count > 0 ? count : 1) * sizeof(const char*));
+        if (!path_list) {
+            tool_result_set_error(&result, "Out of memory");
+            return result;
+        }
+
+        int path_count = 0;
+        cJSON *path_item;
+        cJSON_ArrayForEach(path_item, paths) {
+            if (cJSON_IsString(path_item)) {
+                path_list[path_count++] = path_item->valuestring;
             }
         }
+        deleted_count = file_trash_batch(path_list, path_count, NULL, undo_group);
+        free(path_list);
         snprintf(msg, sizeof(msg), "Moved %d item(s) to Trash", deleted_count);
     } else if (cJSON_IsString(paths)) {
-        if (file_delete(paths->valuestring) == OP_SUCCESS) {
+        const char *path = paths->valuestring;
+        if (file_trash_batch(&path, 1, NULL, undo_group) == 1) {
             deleted_count = 1;
             snprintf(msg, sizeof(msg), "Moved '%s' to Trash", paths->valuestring);
         }
@@ -230,7 +539,7 @@ static ToolResult execute_file_delete(cJSON *input)
 }
 
 // Execute file_create tool
-static ToolResult execute_file_create(cJSON *input)
+static ToolResult execute_file_create(uint64_t undo_group, cJSON *input)
 {
     ToolResult result;
     tool_result_init(&result);
@@ -273,6 +582,11 @@ static ToolResult execute_file_create(cJSON *input)
     }
 
     if (op_result == OP_SUCCESS) {
+        if (create_dir) {
+            undo_log_folder(undo_log_shared(), undo_group, operations_get_result_path());
+        } else {
+            undo_log_created(undo_log_shared(), undo_group, operations_get_result_path());
+        }
         char msg[512];
         if (create_dir) {
             snprintf(msg, sizeof(msg), "Created directory '%s'", name);
@@ -290,7 +604,7 @@ static ToolResult execute_file_create(cJSON *input)
 }
 
 // Execute file_rename tool
-static ToolResult execute_file_rename(cJSON *input)
+static ToolResult execute_file_rename(uint64_t undo_group, cJSON *input)
 {
     ToolResult result;
     tool_result_init(&result);
@@ -310,6 +624,7 @@ static ToolResult execute_file_rename(cJSON *input)
     OperationResult op_result = file_rename(path->valuestring, new_name->valuestring);
 
     if (op_result == OP_SUCCESS) {
+        undo_log_moved(undo_log_shared(), undo_group, path->valuestring, operations_get_result_path());
         char msg[256];
         snprintf(msg, sizeof(msg), "Renamed to '%s'", new_name->valuestring);
         tool_result_set_success(&result, msg, 1);
@@ -320,49 +635,139 @@ static ToolResult execute_file_rename(cJSON *input)
     return result;
 }
 
-// Helper struct for recursive search
-typedef struct {
-    const char *pattern;
-    cJSON *matches;
-    int count;
-    int max_results;  // Limit results to avoid memory issues
-} SearchContext;
+// Cap on file_search results, so a broad pattern cannot flood the reply
+#define FILE_SEARCH_MAX_RESULTS 1000
 
-// Helper for recursive directory search
-static void search_directory_recursive(const char *dir_path, SearchContext *ctx, int depth)
+// Helper: Order matches by path
+static int search_path_compare(const void *a, const void *b)
 {
-    // Limit depth to prevent stack overflow
-    if (depth > 32 || ctx->count >= ctx->max_results) return;
-
-    DIR *dir = opendir(dir_path);
-    if (!dir) return;
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
 
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL && ctx->count < ctx->max_results) {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
+// Helper: Drop the matches that fail a filter (in place); returns how many remain
+static int search_filter_matches(char **paths, int count, const FilterQuery *filter)
+{
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (filter_query_match_path(filter, paths[i])) {
+            char *tmp = paths[kept];
+            paths[kept++] = paths[i];
+            paths[i] = tmp;
         }
+    }
+    return kept;
+}
+
+// Execute file_search tool. Under a folder the filename index covers, the index answers
+// without touching the disk; elsewhere Spotlight answers a recursive search where it
+// indexes the folder, and the tree is walked in parallel where it does not. All stop at
+// the result cap. An optional filter (core/filter_query.h) then narrows the matches
+// (Spotlight checks it as it searches)
+static ToolResult execute_file_search(ToolExecutor *executor, cJSON *input)
+{
+    ToolResult result;
+    tool_result_init(&result);
+
+    cJSON *path = cJSON_GetObjectItem(input, "path");
+    cJSON *pattern = cJSON_GetObjectItem(input, "pattern");
 
-        char full_path[1024];
-        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
+    if (!path || !cJSON_IsString(path)) {
+        tool_result_set_error(&result, "Missing or invalid 'path' parameter");
+        return result;
+    }
+    if (!pattern || !cJSON_IsString(pattern)) {
+        tool_result_set_error(&result, "Missing or invalid 'pattern' parameter");
+        return result;
+    }
 
-        // Check if filename matches pattern
-        if (fnmatch(ctx->pattern, entry->d_name, 0) == 0) {
-            cJSON_AddItemToArray(ctx->matches, cJSON_CreateString(full_path));
-            ctx->count++;
+    cJSON *recursive_item = cJSON_GetObjectItem(input, "recursive");
+    bool do_recursive = recursive_item && cJSON_IsTrue(recursive_item);
+
+    FilterQuery filter;
+    cJSON *filter_item = cJSON_GetObjectItem(input, "filter");
+    const char *filter_text = filter_item && cJSON_IsString(filter_item) ? filter_item->valuestring : NULL;
+    if (!filter_query_compile(&filter, filter_text, time(NULL)) || filter.text[0] != '\0') {
+        char message[256];
+        snprintf(message, sizeof(message), "Invalid 'filter': %s",
+                 filter.error[0] ? filter.error : filter.text);
+        tool_result_set_error(&result, message);
+        return result;
+    }
+
+    char **paths = NULL;
+    int count = 0;
+    bool truncated = false;
+    const char *source = "filesystem";
+
+    PathIndexResults indexed = {0};
+    FileFindResults walked = {0};
+    if (executor->path_index && path->valuestring[0] == '/' &&
+        indexer_path_index_covers(executor->path_indexer, path->valuestring, pattern->valuestring) &&
+        path_index_find(executor->path_index, path->valuestring, pattern->valuestring, do_recursive,
+                        FILE_SEARCH_MAX_RESULTS, &indexed)) {
+        int kept = filter.term_count > 0 ? search_filter_matches(indexed.paths, indexed.count, &filter)
+                                         : indexed.count;
+        if (kept > 1) {
+            qsort(indexed.paths, (size_t)kept, sizeof(char *), search_path_compare);
         }
+        paths = indexed.paths;
+        count = kept;
+        truncated = indexed.total > indexed.count;
+        source = "index";
+    } else if (do_recursive && spotlight_search_find(path->valuestring, pattern->valuestring, &filter,
+                                                     FILE_SEARCH_MAX_RESULTS, &walked)) {
+        paths = walked.paths;
+        count = walked.count;
+        truncated = walked.truncated;
+        source = "spotlight";
+    } else if (file_find(path->valuestring, pattern->valuestring, do_recursive,
+                         FILE_SEARCH_MAX_RESULTS, &walked)) {
+        int kept = filter.term_count > 0 ? search_filter_matches(walked.paths, walked.count, &filter)
+                                         : walked.count;
+        paths = walked.paths;
+        count = kept;
+        truncated = walked.truncated;
+    }
+    TOOL_LOG("file_search %s in %s: %d matches from %s", pattern->valuestring, path->valuestring, count, source);
 
-        // Recurse into subdirectories
-        struct stat st;
-        if (stat(full_path, &st) == 0 && S_ISDIR(st.st_mode)) {
-            search_directory_recursive(full_path, ctx, depth + 1);
+    cJSON *output = cJSON_CreateObject();
+    cJSON *matches = cJSON_CreateArray();
+    ResultPage page;
+    result_page_init(&page, executor, input, count);
+    for (int i = page.offset; i < count; i++) {
+        if (!result_page_add(&page, matches, cJSON_CreateString(paths[i]))) {
+            break;
         }
     }
-    closedir(dir);
+
+    cJSON_AddItemToObject(output, "matches", matches);
+    cJSON_AddNumberToObject(output, "count", count);
+    cJSON_AddStringToObject(output, "pattern", pattern->valuestring);
+    cJSON_AddBoolToObject(output, "recursive", do_recursive);
+    cJSON_AddBoolToObject(output, "truncated", truncated);
+    cJSON_AddStringToObject(output, "source", source);
+    result_page_finish(&page, output);
+    if (result_page_wants_summary(&page)) {
+        cJSON_AddItemToObject(output, "summary", summary_of_paths(paths, count));
+    }
+    path_index_results_free(&indexed);
+    file_find_results_free(&walked);
+
+    char *json_str = cJSON_PrintUnformatted(output);
+    cJSON_Delete(output);
+
+    tool_result_set_success(&result, json_str, count);
+    free(json_str);
+
+    return result;
 }
 
-// Execute file_search tool
-static ToolResult execute_file_search(ToolExecutor *executor __attribute__((unused)), cJSON *input)
+// Default and largest number of lines content_search returns
+#define CONTENT_SEARCH_TOOL_RESULTS 200
+#define CONTENT_SEARCH_TOOL_MAX_RESULTS 2000
+
+// Execute content_search tool: grep the files below a folder (core/content_search.h)
+static ToolResult execute_content_search(ToolExecutor *executor, cJSON *input)
 {
     ToolResult result;
     tool_result_init(&result);
@@ -379,53 +784,278 @@ static ToolResult execute_file_search(ToolExecutor *executor __attribute__((unus
         return result;
     }
 
-    cJSON *recursive_item = cJSON_GetObjectItem(input, "recursive");
-    bool do_recursive = recursive_item && cJSON_IsTrue(recursive_item);
+    ContentSearchOptions options = content_search_default_options();
+    options.regex = cJSON_IsTrue(cJSON_GetObjectItem(input, "regex"));
+    options.case_sensitive = cJSON_IsTrue(cJSON_GetObjectItem(input, "case_sensitive"));
+    cJSON *max_results = cJSON_GetObjectItem(input, "max_results");
+    options.max_results = (max_results && cJSON_IsNumber(max_results)) ? (int)max_results->valuedouble
+                                                                       : CONTENT_SEARCH_TOOL_RESULTS;
+    if (options.max_results <= 0 || options.max_results > CONTENT_SEARCH_TOOL_MAX_RESULTS) {
+        options.max_results = CONTENT_SEARCH_TOOL_MAX_RESULTS;
+    }
 
-    cJSON *output = cJSON_CreateObject();
-    cJSON *matches = cJSON_CreateArray();
+    char error[256];
+    if (!content_search_validate(pattern->valuestring, &options, error, sizeof(error))) {
+        char message[320];
+        snprintf(message, sizeof(message), "Invalid 'pattern': %s", error);
+        tool_result_set_error(&result, message);
+        return result;
+    }
 
-    SearchContext ctx = {
-        .pattern = pattern->valuestring,
-        .matches = matches,
-        .count = 0,
-        .max_results = 1000  // Prevent runaway searches
-    };
+    ContentSearchResults found;
+    if (!content_search(path->valuestring, pattern->valuestring, &options, &found)) {
+        tool_result_set_error(&result, "Cannot search 'path'");
+        return result;
+    }
+    TOOL_LOG("content_search %s in %s: %d matches in %d files", pattern->valuestring, path->valuestring,
+             found.count, found.stats.files_searched);
 
-    if (do_recursive) {
-        search_directory_recursive(path->valuestring, &ctx, 0);
-    } else {
-        // Non-recursive: search only in specified directory
-        DIR *dir = opendir(path->valuestring);
-        if (dir) {
-            struct dirent *entry;
-            while ((entry = readdir(dir)) != NULL && ctx.count < ctx.max_results) {
-                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-                    continue;
-                }
-
-                if (fnmatch(pattern->valuestring, entry->d_name, 0) == 0) {
-                    char full_path[1024];
-                    snprintf(full_path, sizeof(full_path), "%s/%s", path->valuestring, entry->d_name);
-                    cJSON_AddItemToArray(matches, cJSON_CreateString(full_path));
-                    ctx.count++;
-                }
-            }
-            closedir(dir);
+    cJSON *output = cJSON_CreateObject();
+    cJSON *matches = cJSON_CreateArray();
+    ResultPage page;
+    result_page_init(&page, executor, input, found.count);
+    for (int i = page.offset; i < found.count; i++) {
+        cJSON *match = cJSON_CreateObject();
+        cJSON_AddStringToObject(match, "path", found.matches[i].path);
+        cJSON_AddNumberToObject(match, "line", found.matches[i].line);
+        cJSON_AddNumberToObject(match, "column", found.matches[i].column);
+        cJSON_AddStringToObject(match, "text", found.matches[i].text);
+        if (!result_page_add(&page, matches, match)) {
+            break;
         }
     }
-
     cJSON_AddItemToObject(output, "matches", matches);
-    cJSON_AddNumberToObject(output, "count", ctx.count);
+    cJSON_AddNumberToObject(output, "count", found.count);
     cJSON_AddStringToObject(output, "pattern", pattern->valuestring);
-    cJSON_AddBoolToObject(output, "recursive", do_recursive);
+    cJSON_AddBoolToObject(output, "truncated", found.truncated);
+    cJSON_AddNumberToObject(output, "files_searched", found.stats.files_searched);
+    result_page_finish(&page, output);
+    if (result_page_wants_summary(&page)) {
+        // Files by matches; matches come sorted by path, so files are runs
+        const char **files = malloc((size_t)(found.count > 0 ? found.count : 1) * sizeof(char *));
+        if (files) {
+            for (int i = 0; i < found.count; i++) {
+                files[i] = found.matches[i].path;
+            }
+            cJSON *summary = cJSON_CreateObject();
+            summary_add_top(summary, "files", "top_files", files, found.count);
+            cJSON_AddItemToObject(output, "summary", summary);
+            free(files);
+        }
+    }
 
-    char *json_str = cJSON_Print(output);
+    char *json_str = cJSON_PrintUnformatted(output);
     cJSON_Delete(output);
 
-    tool_result_set_success(&result, json_str, ctx.count);
+    tool_result_set_success(&result, json_str, found.count);
     free(json_str);
+    content_search_results_free(&found);
+
+    return result;
+}
+
+// Most files one bulk_operation selects
+#define BULK_MAX_FILES 10000
+
+// Files a bulk_operation selects, and their combined size
+typedef struct BulkSelection {
+    FileFindResults files;
+    off_t total_size;
+} BulkSelection;
+
+// Helper: Whether path is dir itself or somewhere below it
+static bool path_is_within(const char *path, const char *dir)
+{
+    size_t dir_len = strlen(dir);
+    while (dir_len > 1 && dir[dir_len - 1] == '/') dir_len--;
+    return strncmp(path, dir, dir_len) == 0 && (path[dir_len] == '\0' || path[dir_len] == '/');
+}
+
+// Helper: Read an optional non-negative number parameter, -1 when absent
+static double bulk_number(cJSON *input, const char *name)
+{
+    cJSON *item = cJSON_GetObjectItem(input, name);
+    return item && cJSON_IsNumber(item) && item->valuedouble >= 0 ? item->valuedouble : -1;
+}
+
+// Helper: Select the regular files below 'path' whose names match 'pattern' and that pass
+// the age and size filters, leaving out any already inside the destination. False with
+// message set if the input is unusable
+static bool bulk_select(cJSON *input, BulkSelection *selection, char *message, size_t message_size)
+{
+    memset(selection, 0, sizeof(*selection));
+
+    cJSON *path = cJSON_GetObjectItem(input, "path");
+    cJSON *pattern = cJSON_GetObjectItem(input, "pattern");
+    if (!path || !cJSON_IsString(path)) {
+        snprintf(message, message_size, "Missing or invalid 'path' parameter");
+        return false;
+    }
+    if (!pattern || !cJSON_IsString(pattern)) {
+        snprintf(message, message_size, "Missing or invalid 'pattern' parameter");
+        return false;
+    }
+
+    cJSON *recursive = cJSON_GetObjectItem(input, "recursive");
+    cJSON *destination = cJSON_GetObjectItem(input, "destination");
+    const char *dest = destination && cJSON_IsString(destination) ? destination->valuestring : NULL;
+    double older_days = bulk_number(input, "older_than_days");
+    double newer_days = bulk_number(input, "newer_than_days");
+    double min_size = bulk_number(input, "min_size");
+    double max_size = bulk_number(input, "max_size");
+
+    if (!file_find(path->valuestring, pattern->valuestring, recursive && cJSON_IsTrue(recursive),
+                   BULK_MAX_FILES, &selection->files)) {
+        snprintf(message, message_size, "Cannot read folder '%s'", path->valuestring);
+        return false;
+    }
+
+    time_t now = time(NULL);
+    FileFindResults *files = &selection->files;
+    int kept = 0;
+    for (int i = 0; i < files->count; i++) {
+        struct stat st;
+        double age_days = 0;
+        bool keep = stat_cache_lstat(files->paths[i], &st) && S_ISREG(st.st_mode);
+        if (keep) {
+            age_days = difftime(now, st.st_mtime) / 86400.0;
+        }
+        if (keep && older_days >= 0 && age_days < older_days) keep = false;
+        if (keep && newer_days >= 0 && age_days > newer_days) keep = false;
+        if (keep && min_size >= 0 && (double)st.st_size < min_size) keep = false;
+        if (keep && max_size >= 0 && (double)st.st_size > max_size) keep = false;
+        if (keep && dest && path_is_within(files->paths[i], dest)) keep = false;
+
+        if (keep) {
+            files->paths[kept++] = files->paths[i];
+            selection->total_size += st.st_size;
+        } else {
+            free(files->paths[i]);
+        }
+    }
+    files->count = kept;
+    return true;
+}
+
+// Helper: Preview a bulk_operation's selection in a pending operation's details
+static void bulk_preview(cJSON *input, PendingOperation *pending)
+{
+    BulkSelection selection;
+    char message[512];
+    if (!bulk_select(input, &selection, message, sizeof(message))) {
+        snprintf(pending->details, sizeof(pending->details), "%s", message);
+        return;
+    }
+
+    char size_str[32];
+    format_file_size(selection.total_size, size_str, sizeof(size_str));
+    size_t offset = (size_t)snprintf(pending->details, sizeof(pending->details), "%d file(s), %s%s\n",
+                                     selection.files.count, size_str,
+                                     selection.files.truncated ? " (search stopped at the limit)" : "");
+
+    // As many paths as fit, keeping room for the remainder line
+    int shown = 0;
+    for (; shown < selection.files.count; shown++) {
+        size_t need = strlen(selection.files.paths[shown]) + 1;
+        if (offset + need + 32 >= sizeof(pending->details)) break;
+        offset += (size_t)snprintf(pending->details + offset, sizeof(pending->details) - offset,
+                                   "%s\n", selection.files.paths[shown]);
+    }
+    if (shown < selection.files.count) {
+        snprintf(pending->details + offset, sizeof(pending->details) - offset,
+                 "... and %d more", selection.files.count - shown);
+    }
+
+    pending->affected_count = selection.files.count;
+    file_find_results_free(&selection.files);
+}
+
+// Execute bulk_operation tool. The files are selected here and handed to the operation
+// queue when one is set (so thousands of them run in the background), else done in place
+static ToolResult execute_bulk_operation(ToolExecutor *executor, uint64_t undo_group, cJSON *input)
+{
+    ToolResult result;
+    tool_result_init(&result);
+
+    cJSON *action_item = cJSON_GetObjectItem(input, "action");
+    const char *action = action_item && cJSON_IsString(action_item) ? action_item->valuestring : "";
+    bool is_move = strcmp(action, "move") == 0;
+    bool is_copy = strcmp(action, "copy") == 0;
+    bool is_delete = strcmp(action, "delete") == 0;
+    if (!is_move && !is_copy && !is_delete) {
+        tool_result_set_error(&result, "Missing or invalid 'action' parameter (must be 'move', 'copy', or 'delete')");
+        return result;
+    }
 
+    cJSON *destination = cJSON_GetObjectItem(input, "destination");
+    const char *dest = destination && cJSON_IsString(destination) ? destination->valuestring : NULL;
+    if (!is_delete) {
+        struct stat st;
+        if (!dest) {
+            tool_result_set_error(&result, "Missing or invalid 'destination' parameter");
+            return result;
+        }
+        if (stat(dest, &st) != 0 && mkdir(dest, 0755) != 0) {
+            tool_result_set_error(&result, "Cannot create destination folder");
+            return result;
+        }
+        if (stat(dest, &st) != 0 || !S_ISDIR(st.st_mode)) {
+            tool_result_set_error(&result, "Destination is not a folder");
+            return result;
+        }
+    }
+
+    BulkSelection selection;
+    char msg[512];
+    if (!bulk_select(input, &selection, msg, sizeof(msg))) {
+        tool_result_set_error(&result, msg);
+        return result;
+    }
+    FileFindResults *files = &selection.files;
+    if (files->count == 0) {
+        file_find_results_free(files);
+        tool_result_set_success(&result, "No files matched; nothing to do", 0);
+        return result;
+    }
+
+    int done = 0;
+    if (executor->operation_queue) {
+        for (int i = 0; i < files->count; i++) {
+            int id = is_delete ? operation_queue_delete(executor->operation_queue, files->paths[i])
+                   : is_move ? operation_queue_move(executor->operation_queue, files->paths[i], dest)
+                   : operation_queue_copy(executor->operation_queue, files->paths[i], dest);
+            if (id >= 0) done++;
+        }
+        snprintf(msg, sizeof(msg), "Queued %d file(s) to %s%s%s", done, action,
+                 dest ? " to " : "", dest ? dest : "");
+    } else if (is_delete) {
+        done = file_trash_batch((const char *const *)files->paths, files->count, NULL, undo_group);
+        snprintf(msg, sizeof(msg), "Moved %d of %d file(s) to Trash", done, files->count);
+    } else {
+        for (int i = 0; i < files->count; i++) {
+            OperationResult op = is_move ? file_move(files->paths[i], dest) : file_copy(files->paths[i], dest);
+            if (op != OP_SUCCESS) continue;
+            if (is_move) {
+                undo_log_moved(undo_log_shared(), undo_group, files->paths[i], operations_get_result_path());
+            } else {
+                undo_log_created(undo_log_shared(), undo_group, operations_get_result_path());
+            }
+            done++;
+        }
+        snprintf(msg, sizeof(msg), "%s %d of %d file(s) to %s", is_move ? "Moved" : "Copied",
+                 done, files->count, dest);
+    }
+    if (files->truncated) {
+        strncat(msg, " (search stopped at the limit; run again for the rest)", sizeof(msg) - strlen(msg) - 1);
+    }
+    TOOL_LOG("bulk_operation: %s", msg);
+    file_find_results_free(files);
+
+    if (done > 0) {
+        tool_result_set_success(&result, msg, done);
+    } else {
+        tool_result_set_error(&result, executor->operation_queue ? "Could not queue the files" : operations_get_error());
+    }
     return result;
 }
 
@@ -442,7 +1072,7 @@ static ToolResult execute_file_metadata(cJSON *input)
     }
 
     struct stat st;
-    if (stat(path->valuestring, &st) != 0) {
+    if (!stat_cache_stat(path->valuestring, &st)) {
         tool_result_set_error(&result, "File not found");
         return result;
     }
@@ -454,11 +1084,13 @@ static ToolResult execute_file_metadata(cJSON *input)
     cJSON_AddBoolToObject(output, "is_file", S_ISREG(st.st_mode));
     cJSON_AddBoolToObject(output, "is_symlink", S_ISLNK(st.st_mode));
 
+    // Reentrant time conversion: metadata for several files may be read side by side
     char date_str[32];
-    strftime(date_str, sizeof(date_str), "%Y-%m-%d %H:%M:%S", localtime(&st.st_mtime));
+    struct tm tm;
+    strftime(date_str, sizeof(date_str), "%Y-%m-%d %H:%M:%S", localtime_r(&st.st_mtime, &tm));
     cJSON_AddStringToObject(output, "modified", date_str);
 
-    strftime(date_str, sizeof(date_str), "%Y-%m-%d %H:%M:%S", localtime(&st.st_ctime));
+    strftime(date_str, sizeof(date_str), "%Y-%m-%d %H:%M:%S", localtime_r(&st.st_ctime, &tm));
     cJSON_AddStringToObject(output, "created", date_str);
 
     cJSON_AddNumberToObject(output, "permissions", st.st_mode & 0777);
@@ -473,7 +1105,7 @@ static ToolResult execute_file_metadata(cJSON *input)
 }
 
 // Execute batch_rename tool
-static ToolResult execute_batch_rename(cJSON *input)
+static ToolResult execute_batch_rename(uint64_t undo_group, cJSON *input)
 {
     ToolResult result;
     tool_result_init(&result);
@@ -517,6 +1149,7 @@ static ToolResult execute_batch_rename(cJSON *input)
             strcat(new_name, found + strlen(find_str));
 
             if (file_rename(old_path, new_name) == OP_SUCCESS) {
+                undo_log_moved(undo_log_shared(), undo_group, old_path, operations_get_result_path());
                 renamed_count++;
             }
         }
@@ -572,26 +1205,47 @@ static ToolResult execute_semantic_search(ToolExecutor *executor, cJSON *input)
         return result;
     }
 
-    // Build JSON output
+    // Build JSON output, a page of the ranked results
     cJSON *output = cJSON_CreateObject();
     cJSON *matches = cJSON_CreateArray();
+    ResultPage page;
+    result_page_init(&page, executor, input, results.count);
 
-    for (int i = 0; i < results.count; i++) {
+    for (int i = page.offset; i < results.count; i++) {
         SemanticSearchResult *r = &results.results[i];
         cJSON *match = cJSON_CreateObject();
         cJSON_AddStringToObject(match, "path", r->path);
         cJSON_AddStringToObject(match, "name", r->name);
         cJSON_AddNumberToObject(match, "score", r->score);
         cJSON_AddNumberToObject(match, "size", (double)r->size);
-        cJSON_AddItemToArray(matches, match);
+        if (r->section_offset >= 0) {
+            cJSON_AddNumberToObject(match, "section_offset", (double)r->section_offset);
+            if (r->section[0] != '\0') {
+                cJSON_AddStringToObject(match, "section", r->section);
+            }
+        }
+        if (!result_page_add(&page, matches, match)) {
+            break;
+        }
     }
 
     cJSON_AddItemToObject(output, "results", matches);
     cJSON_AddNumberToObject(output, "count", results.count);
     cJSON_AddStringToObject(output, "query", query->valuestring);
     cJSON_AddNumberToObject(output, "search_time_ms", results.search_time_ms);
+    result_page_finish(&page, output);
+    if (result_page_wants_summary(&page)) {
+        char **paths = malloc((size_t)(results.count > 0 ? results.count : 1) * sizeof(char *));
+        if (paths) {
+            for (int i = 0; i < results.count; i++) {
+                paths[i] = results.results[i].path;
+            }
+            cJSON_AddItemToObject(output, "summary", summary_of_paths(paths, results.count));
+            free(paths);
+        }
+    }
 
-    char *json_str = cJSON_Print(output);
+    char *json_str = cJSON_PrintUnformatted(output);
     cJSON_Delete(output);
 
     tool_result_set_success(&result, json_str, results.count);
@@ -810,6 +1464,7 @@ static ToolResult execute_image_generate(ToolExecutor *executor, cJSON *input)
     GeminiImageRequest req;
     gemini_request_init(&req);
     gemini_request_set_prompt(&req, prompt_item->valuestring);
+    gemini_request_set_output_dir(&req, executor->current_dir);  // Decoded to disk as it arrives
 
     // Generate image (gemini_client logs details if GEMINI_DEBUG is enabled)
     GeminiImageResponse resp;
@@ -894,24 +1549,35 @@ ToolResult tool_executor_execute(ToolExecutor *executor, const char *tool_name,
         return result;
     }
 
+    // Mutating tools record into the executor's undo group, or one of their own
+    UndoLog *undo = undo_log_shared();
+    uint64_t undo_group = executor->undo_group;
+    if (undo_group == 0 && undo != NULL && !tool_executor_is_read_only(tool_name)) {
+        undo_group = undo_log_begin(undo, UNDO_SOURCE_NL, tool_name);
+    }
+
     if (strcmp(tool_name, "file_list") == 0) {
         result = execute_file_list(executor, input);
     } else if (strcmp(tool_name, "file_move") == 0) {
-        result = execute_file_move(input);
+        result = execute_file_move(undo_group, input);
     } else if (strcmp(tool_name, "file_copy") == 0) {
-        result = execute_file_copy(input);
+        result = execute_file_copy(undo_group, input);
     } else if (strcmp(tool_name, "file_delete") == 0) {
-        result = execute_file_delete(input);
+        result = execute_file_delete(undo_group, input);
     } else if (strcmp(tool_name, "file_create") == 0) {
-        result = execute_file_create(input);
+        result = execute_file_create(undo_group, input);
     } else if (strcmp(tool_name, "file_rename") == 0) {
-        result = execute_file_rename(input);
+        result = execute_file_rename(undo_group, input);
     } else if (strcmp(tool_name, "file_search") == 0) {
         result = execute_file_search(executor, input);
+    } else if (strcmp(tool_name, "content_search") == 0) {
+        result = execute_content_search(executor, input);
     } else if (strcmp(tool_name, "file_metadata") == 0) {
         result = execute_file_metadata(input);
     } else if (strcmp(tool_name, "batch_rename") == 0) {
-        result = execute_batch_rename(input);
+        result = execute_batch_rename(undo_group, input);
+    } else if (strcmp(tool_name, "bulk_operation") == 0) {
+        result = execute_bulk_operation(executor, undo_group, input);
     } else if (strcmp(tool_name, "semantic_search") == 0) {
         result = execute_semantic_search(executor, input);
     } else if (strcmp(tool_name, "visual_search") == 0) {
@@ -926,10 +1592,96 @@ ToolResult tool_executor_execute(ToolExecutor *executor, const char *tool_name,
         tool_result_set_error(&result, err_buf);
     }
 
+    if (undo_group != executor->undo_group) {
+        undo_log_end(undo, undo_group);
+    }
     cJSON_Delete(input);
     return result;
 }
 
+bool tool_executor_is_read_only(const char *tool_name)
+{
+    static const char *const read_only[] = {
+        "file_list", "file_metadata", "file_search", "content_search",
+        "semantic_search", "visual_search", "similar_images"
+    };
+
+    if (!tool_name) return false;
+    for (size_t i = 0; i < sizeof(read_only) / sizeof(read_only[0]); i++) {
+        if (strcmp(tool_name, read_only[i]) == 0) return true;
+    }
+    return false;
+}
+
+// Read-only calls shared by the threads of one batch run
+typedef struct BatchRun {
+    ToolExecutor *executor;
+    ToolCall *calls;
+    int count;
+    atomic_int next;
+} BatchRun;
+
+// Thread function: Take calls from the run until none are left
+static void *batch_worker(void *arg)
+{
+    BatchRun *run = (BatchRun *)arg;
+    int i;
+    while ((i = atomic_fetch_add(&run->next, 1)) < run->count) {
+        ToolCall *call = &run->calls[i];
+        call->result = tool_executor_execute(run->executor, call->tool_name, call->input_json);
+    }
+    return NULL;
+}
+
+// Helper: Execute a run of read-only calls on up to TOOL_EXECUTOR_MAX_PARALLEL threads
+static void batch_execute_run(ToolExecutor *executor, ToolCall *calls, int count)
+{
+    BatchRun run = { .executor = executor, .calls = calls, .count = count };
+    atomic_init(&run.next, 0);
+
+    int threads = count < TOOL_EXECUTOR_MAX_PARALLEL ? count : TOOL_EXECUTOR_MAX_PARALLEL;
+    pthread_t thread_ids[TOOL_EXECUTOR_MAX_PARALLEL];
+    bool started[TOOL_EXECUTOR_MAX_PARALLEL] = {false};
+    for (int t = 1; t < threads; t++) {
+        started[t] = pthread_create(&thread_ids[t], NULL, batch_worker, &run) == 0;
+    }
+
+    // The caller works too, and finishes the run alone if no thread could start
+    batch_worker(&run);
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) {
+            pthread_join(thread_ids[t], NULL);
+        }
+    }
+}
+
+void tool_executor_execute_batch(ToolExecutor *executor, ToolCall *calls, int count)
+{
+    if (!calls || count <= 0) return;
+
+    int i = 0;
+    while (i < count) {
+        // A mutating call runs alone, after everything before it
+        if (!tool_executor_is_read_only(calls[i].tool_name)) {
+            calls[i].result = tool_executor_execute(executor, calls[i].tool_name, calls[i].input_json);
+            i++;
+            continue;
+        }
+
+        int end = i + 1;
+        while (end < count && tool_executor_is_read_only(calls[end].tool_name)) {
+            end++;
+        }
+        if (end - i == 1) {
+            calls[i].result = tool_executor_execute(executor, calls[i].tool_name, calls[i].input_json);
+        } else {
+            TOOL_LOG("batch: running %d read-only tools in parallel", end - i);
+            batch_execute_run(executor, calls + i, end - i);
+        }
+        i = end;
+    }
+}
+
 bool tool_executor_prepare(ToolExecutor *executor, const char *tool_name,
                            const char *tool_id, const char *input_json,
                            PendingOperation *pending)
@@ -947,16 +1699,18 @@ bool tool_executor_prepare(ToolExecutor *executor, const char *tool_name,
     // Generate description
     tool_executor_describe_operation(tool_name, input_json, pending->description, sizeof(pending->description));
 
-    // Parse input for details
+    // Parse input for details; a bulk operation previews the files it selects instead
     cJSON *input = cJSON_Parse(input_json);
-    if (input) {
+    if (input && strcmp(tool_name, "bulk_operation") == 0) {
+        bulk_preview(input, pending);
+    } else if (input) {
         char *details = cJSON_Print(input);
         if (details) {
             strncpy(pending->details, details, sizeof(pending->details) - 1);
             free(details);
         }
-        cJSON_Delete(input);
     }
+    cJSON_Delete(input);
 
     return true;
 }
@@ -1028,6 +1782,18 @@ const char *tool_executor_describe_operation(const char *tool_name, const char *
         cJSON *paths = input ? cJSON_GetObjectItem(input, "paths") : NULL;
         int count = paths && cJSON_IsArray(paths) ? cJSON_GetArraySize(paths) : 0;
         snprintf(buffer, buffer_size, "Rename %d files", count);
+    } else if (strcmp(tool_name, "bulk_operation") == 0) {
+        cJSON *action = input ? cJSON_GetObjectItem(input, "action") : NULL;
+        cJSON *pattern = input ? cJSON_GetObjectItem(input, "pattern") : NULL;
+        cJSON *path = input ? cJSON_GetObjectItem(input, "path") : NULL;
+        cJSON *dest = input ? cJSON_GetObjectItem(input, "destination") : NULL;
+        const char *verb = action && cJSON_IsString(action) ? action->valuestring : "";
+        bool to_trash = strcmp(verb, "delete") == 0;
+        snprintf(buffer, buffer_size, "%s files matching '%s' in %s to %s",
+                 to_trash ? "Move" : strcmp(verb, "copy") == 0 ? "Copy" : "Move",
+                 pattern && cJSON_IsString(pattern) ? pattern->valuestring : "*",
+                 path && cJSON_IsString(path) ? path->valuestring : "folder",
+                 to_trash ? "Trash" : dest && cJSON_IsString(dest) ? dest->valuestring : "destination");
     } else if (strcmp(tool_name, "semantic_search") == 0) {
         cJSON *query = input ? cJSON_GetObjectItem(input, "query") : NULL;
         snprintf(buffer, buffer_size, "Search for files matching '%s'",
@@ -4,11 +4,15 @@
 #include "tool_registry.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 // Forward declarations for AI modules
 typedef struct SemanticSearch SemanticSearch;
 typedef struct VisualSearch VisualSearch;
 typedef struct GeminiClient GeminiClient;
+struct PathIndex;
+struct Indexer;
+struct OperationQueue;
 
 // Tool executor
 typedef struct ToolExecutor {
@@ -19,8 +23,34 @@ typedef struct ToolExecutor {
     VisualSearch *visual_search;
     // Gemini client for image generation (optional)
     GeminiClient *gemini_client;
+    // Filename index and the indexer keeping it current (optional, speeds up file_search)
+    struct PathIndex *path_index;
+    struct Indexer *path_indexer;
+    // Background queue bulk operations hand their files to (optional, else done in place)
+    struct OperationQueue *operation_queue;
+    // Undo log group mutating tools record into (0: each call starts its own)
+    uint64_t undo_group;
+    // Estimated tokens the entries of one list result may take (0: the default, -1: no cap)
+    int result_token_budget;
 } ToolExecutor;
 
+// List results (file_list, file_search, content_search, semantic_search) come a page at
+// a time: a page ends at the call's 'limit' or once its entries would pass the token
+// budget, and says where the next one starts ('next_offset'). A partial page also
+// carries a summary of the whole set (counts by kind, the largest or busiest items)
+#define TOOL_RESULT_TOKEN_BUDGET 4000
+#define TOOL_RESULT_NO_BUDGET (-1)
+
+// Most read-only tools one batch runs side by side
+#define TOOL_EXECUTOR_MAX_PARALLEL 8
+
+// One tool call in a batch, with its result once executed (caller cleans it up)
+typedef struct ToolCall {
+    const char *tool_name;
+    const char *input_json;
+    ToolResult result;
+} ToolCall;
+
 // Pending operation for confirmation
 typedef struct PendingOperation {
     char tool_id[64];
@@ -43,12 +73,33 @@ void tool_executor_set_cwd(ToolExecutor *executor, const char *path);
 void tool_executor_set_semantic_search(ToolExecutor *executor, SemanticSearch *search);
 void tool_executor_set_visual_search(ToolExecutor *executor, VisualSearch *search);
 
+// Set the filename index (optional - file_search answers from it under folders it covers)
+void tool_executor_set_path_index(ToolExecutor *executor, struct PathIndex *index, struct Indexer *indexer);
+
+// Set the operation queue (optional - bulk_operation queues its files instead of blocking)
+void tool_executor_set_operation_queue(ToolExecutor *executor, struct OperationQueue *queue);
+
+// Record what mutating tools do into this group of undo_log_shared() (0: a group per call)
+void tool_executor_set_undo_group(ToolExecutor *executor, uint64_t group);
+
+// Cap the entries of a list result at about this many tokens (0: TOOL_RESULT_TOKEN_BUDGET,
+// TOOL_RESULT_NO_BUDGET: whole results); a call may ask for less with 'max_tokens'
+void tool_executor_set_result_budget(ToolExecutor *executor, int tokens);
+
 // Set Gemini client (optional - enables image_generate tool)
 void tool_executor_set_gemini_client(ToolExecutor *executor, GeminiClient *client);
 
 // Execute a tool directly
 ToolResult tool_executor_execute(ToolExecutor *executor, const char *tool_name, const char *input_json);
 
+// Whether a tool only reads, so it can run alongside other reads
+bool tool_executor_is_read_only(const char *tool_name);
+
+// Execute several tool calls. Consecutive read-only calls run in parallel; any other call
+// starts after every call before it has finished and completes before later calls start,
+// so mutations keep their order
+void tool_executor_execute_batch(ToolExecutor *executor, ToolCall *calls, int count);
+
 // Prepare an operation for confirmation (returns description without executing)
 bool tool_executor_prepare(ToolExecutor *executor, const char *tool_name,
                            const char *tool_id, const char *input_json,
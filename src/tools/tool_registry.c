@@ -41,6 +41,17 @@ static void add_param(ToolDefinition *tool, const char *name, const char *desc,
     tool->param_count++;
 }
 
+// Paging parameters of the tools returning lists (see tool_executor.c)
+static void add_page_params(ToolDefinition *tool)
+{
+    add_param(tool, "offset", "Index of the first entry to return, from a previous reply's next_offset (default: 0)",
+              TOOL_PARAM_INTEGER, false);
+    add_param(tool, "limit", "Most entries to return (0 for the summary alone)", TOOL_PARAM_INTEGER, false);
+    add_param(tool, "max_tokens", "Smaller token budget for this reply's entries", TOOL_PARAM_INTEGER, false);
+    add_param(tool, "summary", "Include counts by kind and the largest or busiest items (default: when paged)",
+              TOOL_PARAM_BOOLEAN, false);
+}
+
 void tool_registry_register_file_tools(ToolRegistry *registry)
 {
     if (!registry) return;
@@ -48,11 +59,12 @@ void tool_registry_register_file_tools(ToolRegistry *registry)
     // file_list - List directory contents
     ToolDefinition file_list = {0};
     strncpy(file_list.name, "file_list", TOOL_MAX_NAME_LEN - 1);
-    strncpy(file_list.description, "List files and directories in a path. Returns names, sizes, types, and modification dates.", TOOL_MAX_DESC_LEN - 1);
+    strncpy(file_list.description, "List files and directories in a path. Returns names, sizes, types, and modification dates, a page at a time.", TOOL_MAX_DESC_LEN - 1);
     file_list.requires_confirmation = false;
     add_param(&file_list, "path", "Directory path to list", TOOL_PARAM_STRING, true);
     add_param(&file_list, "show_hidden", "Include hidden files (default: false)", TOOL_PARAM_BOOLEAN, false);
     add_param(&file_list, "recursive", "List subdirectories recursively", TOOL_PARAM_BOOLEAN, false);
+    add_page_params(&file_list);
     tool_registry_add(registry, &file_list);
 
     // file_move - Move files
@@ -108,8 +120,26 @@ void tool_registry_register_file_tools(ToolRegistry *registry)
     add_param(&file_search, "path", "Directory to search in", TOOL_PARAM_STRING, true);
     add_param(&file_search, "pattern", "Filename pattern (supports wildcards)", TOOL_PARAM_STRING, true);
     add_param(&file_search, "recursive", "Search subdirectories", TOOL_PARAM_BOOLEAN, false);
+    add_param(&file_search, "filter", "Filter terms, e.g. \"ext:raw size>50MB modified<30d kind:image\"",
+              TOOL_PARAM_STRING, false);
+    add_page_params(&file_search);
     tool_registry_add(registry, &file_search);
 
+    // content_search - Search inside files
+    ToolDefinition content_search = {0};
+    strncpy(content_search.name, "content_search", TOOL_MAX_NAME_LEN - 1);
+    strncpy(content_search.description,
+            "Search the text inside files below a folder, like grep: returns each matching line with its "
+            "path and line number. Skips binary, hidden and ignored files", TOOL_MAX_DESC_LEN - 1);
+    content_search.requires_confirmation = false;
+    add_param(&content_search, "path", "Folder (or file) to search in", TOOL_PARAM_STRING, true);
+    add_param(&content_search, "pattern", "Text to find, or a POSIX extended regex with regex", TOOL_PARAM_STRING, true);
+    add_param(&content_search, "regex", "Treat pattern as a regular expression", TOOL_PARAM_BOOLEAN, false);
+    add_param(&content_search, "case_sensitive", "Match case exactly (default: ignore case)", TOOL_PARAM_BOOLEAN, false);
+    add_param(&content_search, "max_results", "Maximum matching lines to return", TOOL_PARAM_INTEGER, false);
+    add_page_params(&content_search);
+    tool_registry_add(registry, &content_search);
+
     // file_metadata - Get file information
     ToolDefinition file_metadata = {0};
     strncpy(file_metadata.name, "file_metadata", TOOL_MAX_NAME_LEN - 1);
@@ -139,6 +169,22 @@ void tool_registry_register_file_tools(ToolRegistry *registry)
     add_param(&batch_move, "organize_by", "How to organize: 'type', 'date', or 'none'", TOOL_PARAM_STRING, false);
     tool_registry_add(registry, &batch_move);
 
+    // bulk_operation - Act on every file a pattern and filters select, in one call
+    ToolDefinition bulk_operation = {0};
+    strncpy(bulk_operation.name, "bulk_operation", TOOL_MAX_NAME_LEN - 1);
+    strncpy(bulk_operation.description, "Move, copy or trash every file in a folder whose name matches a pattern, optionally filtered by age and size. Use this instead of one call per file when acting on many files.", TOOL_MAX_DESC_LEN - 1);
+    bulk_operation.requires_confirmation = true;
+    add_param(&bulk_operation, "action", "What to do with the files: 'move', 'copy', or 'delete' (to Trash)", TOOL_PARAM_STRING, true);
+    add_param(&bulk_operation, "path", "Folder to select files from", TOOL_PARAM_STRING, true);
+    add_param(&bulk_operation, "pattern", "Filename glob pattern (e.g., '*.pdf')", TOOL_PARAM_STRING, true);
+    add_param(&bulk_operation, "recursive", "Include files in subfolders (default: false)", TOOL_PARAM_BOOLEAN, false);
+    add_param(&bulk_operation, "destination", "Destination folder for move and copy (created if missing)", TOOL_PARAM_STRING, false);
+    add_param(&bulk_operation, "older_than_days", "Only files last modified more than this many days ago", TOOL_PARAM_INTEGER, false);
+    add_param(&bulk_operation, "newer_than_days", "Only files last modified within this many days", TOOL_PARAM_INTEGER, false);
+    add_param(&bulk_operation, "min_size", "Only files at least this many bytes", TOOL_PARAM_INTEGER, false);
+    add_param(&bulk_operation, "max_size", "Only files at most this many bytes", TOOL_PARAM_INTEGER, false);
+    tool_registry_add(registry, &bulk_operation);
+
     // semantic_search - AI-powered content search
     ToolDefinition semantic_search = {0};
     strncpy(semantic_search.name, "semantic_search", TOOL_MAX_NAME_LEN - 1);
@@ -148,6 +194,7 @@ void tool_registry_register_file_tools(ToolRegistry *registry)
     add_param(&semantic_search, "directory", "Directory to search in (default: current directory)", TOOL_PARAM_STRING, false);
     add_param(&semantic_search, "max_results", "Maximum number of results to return (default: 20)", TOOL_PARAM_INTEGER, false);
     add_param(&semantic_search, "file_type", "Filter by file type: 'text', 'code', 'document', 'image'", TOOL_PARAM_STRING, false);
+    add_page_params(&semantic_search);
     tool_registry_add(registry, &semantic_search);
 
     // visual_search - AI-powered image search
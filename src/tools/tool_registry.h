@@ -6,7 +6,7 @@
 
 #define TOOL_MAX_NAME_LEN 64
 #define TOOL_MAX_DESC_LEN 512
-#define MAX_TOOLS 16
+#define MAX_TOOLS 24
 #define MAX_TOOL_PARAMS 16
 
 // Tool parameter types
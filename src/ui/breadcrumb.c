@@ -6,6 +6,7 @@
 #include "../core/search.h"
 #include "../utils/theme.h"
 #include "../utils/font.h"
+#include "../utils/trace.h"
 #include "raylib.h"
 
 #include <stdio.h>
@@ -235,6 +236,7 @@ void breadcrumb_handle_input(struct App *app)
 
 void breadcrumb_draw(struct App *app)
 {
+    TRACE_SCOPE("breadcrumb_draw");
     BreadcrumbState *breadcrumb = &app->breadcrumb;
 
     int sidebar_width = app->sidebar.collapsed ? 0 : app->sidebar.width;
@@ -4,6 +4,7 @@
 #include "preview.h"
 #include "breadcrumb.h"
 #include "file_view_modal.h"
+#include "thumbnails.h"
 #include "../app.h"
 #include "../core/filesystem.h"
 #include "../core/search.h"
@@ -11,12 +12,15 @@
 #include "../core/operations.h"
 #include "../utils/theme.h"
 #include "../utils/font.h"
+#include "../utils/draw_batch.h"
+#include "../utils/trace.h"
+#include "../utils/file_type.h"
 #include "raylib.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <pthread.h>
 
 // Column widths for list view
 #define NAME_COL_WIDTH 400
@@ -28,6 +32,7 @@
 #define GRID_ITEM_HEIGHT 90
 #define GRID_ICON_SIZE 48
 #define GRID_TEXT_HEIGHT 28
+#define GRID_MAX_VISIBLE 4096   // Items tracked per frame for thumbnails
 
 // Column view constants
 #define COLUMN_VIEW_WIDTH 220
@@ -56,57 +61,36 @@ static int get_browser_width(App *app)
     return app->width - sidebar_width - preview_width;
 }
 
+// Icon characters by file type class
+static const char *const FILE_ICONS[FILE_CLASS_COUNT] = {
+    [FILE_CLASS_NONE] = "[F]",
+    [FILE_CLASS_TEXT] = "[T]",
+    [FILE_CLASS_MARKDOWN] = "[T]",
+    [FILE_CLASS_CODE] = "[C]",
+    [FILE_CLASS_DATA] = "[C]",
+    [FILE_CLASS_DOCUMENT] = "[T]",
+    [FILE_CLASS_SPREADSHEET] = "[T]",
+    [FILE_CLASS_PRESENTATION] = "[T]",
+    [FILE_CLASS_IMAGE] = "[I]",
+    [FILE_CLASS_VIDEO] = "[M]",
+    [FILE_CLASS_AUDIO] = "[M]",
+    [FILE_CLASS_ARCHIVE] = "[Z]",
+    [FILE_CLASS_INSTALLER] = "[Z]",
+    [FILE_CLASS_DATABASE] = "[F]",
+    [FILE_CLASS_FONT] = "[F]",
+    [FILE_CLASS_APPLICATION] = "[F]",
+};
+
 // Get icon character for file type
 static const char* get_file_icon(const FileEntry *entry)
 {
     if (entry->is_directory) {
         return "[D]";
     }
-
-    // Check common extensions
-    const char *ext = entry->extension;
-    if (strlen(ext) == 0) {
+    if (entry->ext_len == 0) {
         return "[.]";
     }
-
-    // Code files
-    if (strcmp(ext, "c") == 0 || strcmp(ext, "h") == 0 ||
-        strcmp(ext, "cpp") == 0 || strcmp(ext, "hpp") == 0 ||
-        strcmp(ext, "py") == 0 || strcmp(ext, "js") == 0 ||
-        strcmp(ext, "ts") == 0 || strcmp(ext, "rs") == 0 ||
-        strcmp(ext, "go") == 0 || strcmp(ext, "java") == 0) {
-        return "[C]";
-    }
-
-    // Documents
-    if (strcmp(ext, "md") == 0 || strcmp(ext, "txt") == 0 ||
-        strcmp(ext, "pdf") == 0 || strcmp(ext, "doc") == 0 ||
-        strcmp(ext, "docx") == 0) {
-        return "[T]";
-    }
-
-    // Images
-    if (strcmp(ext, "png") == 0 || strcmp(ext, "jpg") == 0 ||
-        strcmp(ext, "jpeg") == 0 || strcmp(ext, "gif") == 0 ||
-        strcmp(ext, "svg") == 0 || strcmp(ext, "bmp") == 0) {
-        return "[I]";
-    }
-
-    // Archives
-    if (strcmp(ext, "zip") == 0 || strcmp(ext, "tar") == 0 ||
-        strcmp(ext, "gz") == 0 || strcmp(ext, "rar") == 0 ||
-        strcmp(ext, "7z") == 0) {
-        return "[Z]";
-    }
-
-    // Audio/Video
-    if (strcmp(ext, "mp3") == 0 || strcmp(ext, "wav") == 0 ||
-        strcmp(ext, "mp4") == 0 || strcmp(ext, "avi") == 0 ||
-        strcmp(ext, "mkv") == 0 || strcmp(ext, "mov") == 0) {
-        return "[M]";
-    }
-
-    return "[F]";
+    return FILE_ICONS[file_type_class(entry->file_type)];
 }
 
 // Check if an entry is selected (either cursor or multi-select)
@@ -219,6 +203,12 @@ static void browser_draw_list(App *app)
     int browser_height = app->height - STATUSBAR_HEIGHT - ROW_HEIGHT - content_offset;
     int visible_count = browser_height / ROW_HEIGHT;
 
+    // Line counts come with the status, when it was read for this directory
+    bool git_current = app->git.is_repo && strcmp(app->git_status_path, dir->current_path) == 0;
+
+    // Rows are batched: backgrounds first, then all text
+    draw_batch_begin();
+
     for (int i = 0; i < visible_count && (app->scroll_offset + i) < dir->count; i++) {
         int entry_index = app->scroll_offset + i;
         FileEntry *entry = &dir->entries[entry_index];
@@ -228,12 +218,14 @@ static void browser_draw_list(App *app)
         bool is_cursor = (entry_index == app->selected_index);
 
         // Check if item is in clipboard for visual feedback
-        OperationType clipboard_op = get_clipboard_operation(app, entry->path);
+        char entry_path[PATH_MAX_LEN];
+        directory_entry_path(dir, entry, entry_path, sizeof(entry_path));
+        OperationType clipboard_op = get_clipboard_operation(app, entry_path);
 
         // Draw selection background
         if (selected) {
             Color bg_color = is_cursor ? g_theme.selection : Fade(g_theme.selection, 0.6f);
-            DrawRectangle(content_x, row_y, content_width, ROW_HEIGHT, bg_color);
+            draw_batch_rect(content_x, row_y, content_width, ROW_HEIGHT, bg_color);
         }
 
         int x = content_x + PADDING;
@@ -254,6 +246,9 @@ static void browser_draw_list(App *app)
             int field_height = ROW_HEIGHT - 4;
             int field_y = row_y + 2;
 
+            // The field is drawn directly, over the rows queued so far
+            draw_batch_flush();
+
             // Text field background
             DrawRectangle(x, field_y, field_width, field_height, g_theme.background);
             DrawRectangleLinesEx((Rectangle){(float)x, (float)field_y, (float)field_width, (float)field_height},
@@ -283,27 +278,35 @@ static void browser_draw_list(App *app)
             // Apply clipboard feedback to name color
             name_color = apply_clipboard_feedback(name_color, clipboard_op);
 
-            // Truncate name if too long
-            char display_name[128];
-            int max_name_chars = (NAME_COL_WIDTH - ICON_WIDTH - PADDING * 2) / 8;
-            if ((int)strlen(entry->name) > max_name_chars) {
-                strncpy(display_name, entry->name, max_name_chars - 3);
-                display_name[max_name_chars - 3] = '\0';
-                strcat(display_name, "...");
-            } else {
-                strncpy(display_name, entry->name, sizeof(display_name) - 1);
-                display_name[sizeof(display_name) - 1] = '\0';
-            }
-
-            DrawTextCustom(display_name, x, row_y + (ROW_HEIGHT - FONT_SIZE) / 2, FONT_SIZE, name_color);
+            // Name, cut to the column width (cached layout)
+            const char *name = directory_entry_name(dir, entry);
+            int max_name_width = NAME_COL_WIDTH - ICON_WIDTH - PADDING * 2;
+            DrawTextFit(name, x, row_y + (ROW_HEIGHT - FONT_SIZE) / 2, FONT_SIZE, max_name_width, name_color);
 
             // Draw git status indicator after filename
             if (app->git.is_repo && entry->git_status != FILE_GIT_NONE) {
                 char git_char[2] = { get_git_status_char(entry->git_status), '\0' };
-                int name_width = MeasureTextCustom(display_name, FONT_SIZE);
+                int name_width = MeasureTextFit(name, FONT_SIZE, max_name_width);
                 Color git_color = apply_clipboard_feedback(get_git_status_color(entry->git_status), clipboard_op);
                 DrawTextCustom(git_char, x + name_width + 4, row_y + (ROW_HEIGHT - FONT_SIZE) / 2,
                          FONT_SIZE, git_color);
+
+                // Lines added and removed (summed over a folder's files), while they fit
+                int added, removed;
+                if (git_current && git_get_file_stats(&app->git_status, name, &added, &removed)) {
+                    char added_text[16], removed_text[16];
+                    snprintf(added_text, sizeof(added_text), "+%d", added);
+                    snprintf(removed_text, sizeof(removed_text), "-%d", removed);
+                    int stats_x = x + name_width + 4 + MeasureTextCustom(git_char, FONT_SIZE) + 6;
+                    int removed_x = stats_x + MeasureTextCustom(added_text, FONT_SIZE_SMALL) + 4;
+                    if (removed_x + MeasureTextCustom(removed_text, FONT_SIZE_SMALL) <= x + max_name_width) {
+                        int stats_y = row_y + (ROW_HEIGHT - FONT_SIZE_SMALL) / 2;
+                        DrawTextCustom(added_text, stats_x, stats_y, FONT_SIZE_SMALL,
+                                       apply_clipboard_feedback(g_theme.gitStaged, clipboard_op));
+                        DrawTextCustom(removed_text, removed_x, stats_y, FONT_SIZE_SMALL,
+                                       apply_clipboard_feedback(g_theme.gitDeleted, clipboard_op));
+                    }
+                }
             }
         }
 
@@ -311,22 +314,24 @@ static void browser_draw_list(App *app)
 
         // Size - apply clipboard feedback
         Color size_color = apply_clipboard_feedback(g_theme.textSecondary, clipboard_op);
+        off_t folder_size = 0;
         if (!entry->is_directory) {
-            char size_str[32];
-            format_file_size(entry->size, size_str, sizeof(size_str));
-            DrawTextCustom(size_str, x, row_y + (ROW_HEIGHT - FONT_SIZE) / 2, FONT_SIZE, size_color);
+            DrawTextCustom(format_file_size_cached(entry->size), x, row_y + (ROW_HEIGHT - FONT_SIZE) / 2, FONT_SIZE, size_color);
+        } else if (!entry->is_symlink && dir_sizes_query(app->dir_sizes, entry_path, &folder_size)) {
+            // Counted in the background; shown once known
+            DrawTextCustom(format_file_size_cached(folder_size), x, row_y + (ROW_HEIGHT - FONT_SIZE) / 2, FONT_SIZE, size_color);
         } else {
             DrawTextCustom("--", x, row_y + (ROW_HEIGHT - FONT_SIZE) / 2, FONT_SIZE, size_color);
         }
         x += SIZE_COL_WIDTH;
 
         // Modified date - apply clipboard feedback
-        char date_str[32];
-        format_modified_time(entry->modified, date_str, sizeof(date_str));
         Color date_color = apply_clipboard_feedback(g_theme.textSecondary, clipboard_op);
-        DrawTextCustom(date_str, x, row_y + (ROW_HEIGHT - FONT_SIZE) / 2, FONT_SIZE, date_color);
+        DrawTextCustom(format_modified_time_cached(entry->modified), x, row_y + (ROW_HEIGHT - FONT_SIZE) / 2, FONT_SIZE, date_color);
     }
 
+    draw_batch_end();
+
     // Draw scrollbar if needed
     if (dir->count > visible_count) {
         int scrollbar_height = browser_height;
@@ -376,29 +381,96 @@ static void browser_draw_grid(App *app)
     int end_row = start_row + visible_rows + 1;
     if (end_row > total_rows) end_row = total_rows;
 
-    for (int row = start_row; row < end_row; row++) {
-        for (int col = 0; col < cols; col++) {
-            int index = row * cols + col;
-            if (index >= dir->count) break;
-
-            FileEntry *entry = &dir->entries[index];
+    int first_index = start_row * cols;
+    int end_index = end_row * cols;
+    if (end_index > dir->count) end_index = dir->count;
+    if (end_index - first_index > GRID_MAX_VISIBLE) end_index = first_index + GRID_MAX_VISIBLE;
+
+    // Drawn in three passes, so each kind of draw shares a texture and batches: selection
+    // backgrounds, thumbnails from the atlas, then icons and text from the font
+    bool has_thumbnail[GRID_MAX_VISIBLE];
+
+    for (int index = first_index; index < end_index; index++) {
+        if (!is_entry_selected(app, index)) continue;
+        int x = content_x + PADDING + (index % cols) * GRID_ITEM_WIDTH;
+        int y = content_offset + PADDING + (index / cols - scroll_row) * GRID_ITEM_HEIGHT;
+        bool is_cursor = (index == app->selected_index);
+        Color bg_color = is_cursor ? g_theme.selection : Fade(g_theme.selection, 0.6f);
+        DrawRectangle(x, y, GRID_ITEM_WIDTH - 4, GRID_ITEM_HEIGHT - 4, bg_color);
+    }
 
-            int x = content_x + PADDING + col * GRID_ITEM_WIDTH;
-            int y = content_offset + PADDING + (row - scroll_row) * GRID_ITEM_HEIGHT;
+    for (int index = first_index; index < end_index; index++) {
+        FileEntry *entry = &dir->entries[index];
+        has_thumbnail[index - first_index] = false;
+        if (!app->thumbnails || entry->is_directory ||
+            !thumbnails_is_supported(directory_entry_extension(dir, entry))) {
+            continue;
+        }
 
-            bool selected = is_entry_selected(app, index);
-            bool is_cursor = (index == app->selected_index);
+        char entry_path[PATH_MAX_LEN];
+        directory_entry_path(dir, entry, entry_path, sizeof(entry_path));
+        Texture2D atlas;
+        Rectangle source;
+        if (!thumbnails_get(app->thumbnails, entry_path, entry->modified, entry->size,
+                            index - first_index, &atlas, &source)) {
+            continue;
+        }
+        has_thumbnail[index - first_index] = true;
+        int x = content_x + PADDING + (index % cols) * GRID_ITEM_WIDTH;
+        int y = content_offset + PADDING + (index / cols - scroll_row) * GRID_ITEM_HEIGHT;
+
+        // A hovered video shows the frame under the pointer, from its sprite sheet
+        if (index == app->browser_state.hovered_index) {
+            float position = (GetMousePosition().x - x) / (float)(GRID_ITEM_WIDTH - 4);
+            thumbnails_get_scrub(app->thumbnails, entry_path, entry->modified, entry->size,
+                                 position, &atlas, &source);
+        }
 
-            // Check if item is in clipboard for visual feedback
-            OperationType clipboard_op = get_clipboard_operation(app, entry->path);
+        // Fit inside the icon box, centered, never enlarged past the cell
+        float scale = (float)GRID_ICON_SIZE / (source.width > source.height ? source.width : source.height);
+        if (scale > 1.0f) scale = 1.0f;
+        float w = source.width * scale;
+        float h = source.height * scale;
+        Rectangle dest = {
+            x + (GRID_ITEM_WIDTH - 4 - w) / 2.0f,
+            y + 6 + (GRID_ICON_SIZE - h) / 2.0f,
+            w, h
+        };
+        Color tint = apply_clipboard_feedback(WHITE, get_clipboard_operation(app, entry_path));
+        DrawTexturePro(atlas, source, dest, (Vector2){ 0, 0 }, 0.0f, tint);
+    }
 
-            // Draw selection background
-            if (selected) {
-                Color bg_color = is_cursor ? g_theme.selection : Fade(g_theme.selection, 0.6f);
-                DrawRectangle(x, y, GRID_ITEM_WIDTH - 4, GRID_ITEM_HEIGHT - 4, bg_color);
+    // Ask for the next screen below as well, behind everything visible
+    if (app->thumbnails) {
+        int prefetch_end = end_index + visible_rows * cols;
+        if (prefetch_end > dir->count) prefetch_end = dir->count;
+        for (int index = end_index; index < prefetch_end; index++) {
+            FileEntry *entry = &dir->entries[index];
+            if (entry->is_directory || !thumbnails_is_supported(directory_entry_extension(dir, entry))) {
+                continue;
             }
+            char entry_path[PATH_MAX_LEN];
+            directory_entry_path(dir, entry, entry_path, sizeof(entry_path));
+            Texture2D atlas;
+            Rectangle source;
+            thumbnails_get(app->thumbnails, entry_path, entry->modified, entry->size,
+                           index - first_index, &atlas, &source);
+        }
+    }
+
+    for (int index = first_index; index < end_index; index++) {
+        FileEntry *entry = &dir->entries[index];
+
+        int x = content_x + PADDING + (index % cols) * GRID_ITEM_WIDTH;
+        int y = content_offset + PADDING + (index / cols - scroll_row) * GRID_ITEM_HEIGHT;
 
-            // Draw icon (large, centered) - apply clipboard feedback
+        // Check if item is in clipboard for visual feedback
+        char entry_path[PATH_MAX_LEN];
+        directory_entry_path(dir, entry, entry_path, sizeof(entry_path));
+        OperationType clipboard_op = get_clipboard_operation(app, entry_path);
+
+        // Draw icon (large, centered) - apply clipboard feedback
+        if (!has_thumbnail[index - first_index]) {
             Color icon_color = entry->is_directory ? g_theme.folder : g_theme.file;
             icon_color = apply_clipboard_feedback(icon_color, clipboard_op);
             const char *icon = get_file_icon(entry);
@@ -406,39 +478,30 @@ static void browser_draw_grid(App *app)
             int icon_x = x + (GRID_ITEM_WIDTH - 4) / 2 - 12;
             int icon_y = y + 10;
             DrawTextCustom(icon, icon_x, icon_y, 20, icon_color);
+        }
 
-            // Draw name (truncated, centered)
-            char display_name[32];
-            int max_chars = (GRID_ITEM_WIDTH - 8) / 7;
-            if ((int)strlen(entry->name) > max_chars) {
-                strncpy(display_name, entry->name, max_chars - 2);
-                display_name[max_chars - 2] = '\0';
-                strcat(display_name, "..");
-            } else {
-                strncpy(display_name, entry->name, sizeof(display_name) - 1);
-                display_name[sizeof(display_name) - 1] = '\0';
-            }
-
-            int text_width = MeasureTextCustom(display_name, FONT_SIZE_SMALL);
-            int text_x = x + (GRID_ITEM_WIDTH - 4 - text_width) / 2;
-            int text_y = y + GRID_ITEM_HEIGHT - GRID_TEXT_HEIGHT;
+        // Draw name (truncated, centered)
+        const char *name = directory_entry_name(dir, entry);
+        int max_name_width = GRID_ITEM_WIDTH - 8;
+        int text_width = MeasureTextFit(name, FONT_SIZE_SMALL, max_name_width);
+        int text_x = x + (GRID_ITEM_WIDTH - 4 - text_width) / 2;
+        int text_y = y + GRID_ITEM_HEIGHT - GRID_TEXT_HEIGHT;
 
-            // Color based on git status if in repo - apply clipboard feedback
-            Color name_color = entry->is_hidden ? g_theme.textSecondary : g_theme.textPrimary;
-            if (app->git.is_repo && entry->git_status != FILE_GIT_NONE) {
-                name_color = get_git_status_color(entry->git_status);
-            }
-            name_color = apply_clipboard_feedback(name_color, clipboard_op);
-            DrawTextCustom(display_name, text_x, text_y, FONT_SIZE_SMALL, name_color);
-
-            // Draw git status indicator - apply clipboard feedback
-            if (app->git.is_repo && entry->git_status != FILE_GIT_NONE) {
-                char git_char[2] = { get_git_status_char(entry->git_status), '\0' };
-                int indicator_x = x + GRID_ITEM_WIDTH - 14;
-                int indicator_y = y + 2;
-                Color git_color = apply_clipboard_feedback(get_git_status_color(entry->git_status), clipboard_op);
-                DrawTextCustom(git_char, indicator_x, indicator_y, FONT_SIZE_SMALL, git_color);
-            }
+        // Color based on git status if in repo - apply clipboard feedback
+        Color name_color = entry->is_hidden ? g_theme.textSecondary : g_theme.textPrimary;
+        if (app->git.is_repo && entry->git_status != FILE_GIT_NONE) {
+            name_color = get_git_status_color(entry->git_status);
+        }
+        name_color = apply_clipboard_feedback(name_color, clipboard_op);
+        DrawTextFit(name, text_x, text_y, FONT_SIZE_SMALL, max_name_width, name_color);
+
+        // Draw git status indicator - apply clipboard feedback
+        if (app->git.is_repo && entry->git_status != FILE_GIT_NONE) {
+            char git_char[2] = { get_git_status_char(entry->git_status), '\0' };
+            int indicator_x = x + GRID_ITEM_WIDTH - 14;
+            int indicator_y = y + 2;
+            Color git_color = apply_clipboard_feedback(get_git_status_color(entry->git_status), clipboard_op);
+            DrawTextCustom(git_char, indicator_x, indicator_y, FONT_SIZE_SMALL, git_color);
         }
     }
 }
@@ -451,10 +514,10 @@ static void draw_column(App *app, DirectoryState *dir, int col_x, int col_width,
     int visible_count = content_height / ROW_HEIGHT;
 
     // Column background
-    DrawRectangle(col_x, content_offset, col_width, content_height, g_theme.background);
+    draw_batch_rect(col_x, content_offset, col_width, content_height, g_theme.background);
 
     // Right border
-    DrawLine(col_x + col_width - 1, content_offset, col_x + col_width - 1, content_offset + content_height, g_theme.border);
+    draw_batch_rect(col_x + col_width - 1, content_offset, 1, content_height, g_theme.border);
 
     if (dir->error_message[0] != '\0') {
         DrawTextCustom("Error", col_x + PADDING, content_offset + PADDING, FONT_SIZE_SMALL, g_theme.error);
@@ -474,7 +537,7 @@ static void draw_column(App *app, DirectoryState *dir, int col_x, int col_width,
         bool is_selected = (entry_index == selected_index);
 
         if (is_selected) {
-            DrawRectangle(col_x, row_y, col_width - 1, ROW_HEIGHT, g_theme.selection);
+            draw_batch_rect(col_x, row_y, col_width - 1, ROW_HEIGHT, g_theme.selection);
         }
 
         // Icon
@@ -482,20 +545,11 @@ static void draw_column(App *app, DirectoryState *dir, int col_x, int col_width,
         const char *icon = entry->is_directory ? ">" : " ";
         DrawTextCustom(icon, col_x + PADDING, row_y + (ROW_HEIGHT - FONT_SIZE_SMALL) / 2, FONT_SIZE_SMALL, icon_color);
 
-        // Name
-        char display_name[64];
-        int max_chars = (col_width - PADDING * 3 - 10) / 7;
-        if ((int)strlen(entry->name) > max_chars && max_chars > 3) {
-            strncpy(display_name, entry->name, max_chars - 2);
-            display_name[max_chars - 2] = '\0';
-            strcat(display_name, "..");
-        } else {
-            strncpy(display_name, entry->name, sizeof(display_name) - 1);
-            display_name[sizeof(display_name) - 1] = '\0';
-        }
-
+        // Name, cut before the directory indicator
+        const char *name = directory_entry_name(dir, entry);
         Color name_color = entry->is_hidden ? g_theme.textSecondary : g_theme.textPrimary;
-        DrawTextCustom(display_name, col_x + PADDING + 15, row_y + (ROW_HEIGHT - FONT_SIZE_SMALL) / 2, FONT_SIZE_SMALL, name_color);
+        DrawTextFit(name, col_x + PADDING + 15, row_y + (ROW_HEIGHT - FONT_SIZE_SMALL) / 2, FONT_SIZE_SMALL,
+                    col_width - PADDING - 15 - 18, name_color);
 
         // Directory indicator
         if (entry->is_directory) {
@@ -505,7 +559,7 @@ static void draw_column(App *app, DirectoryState *dir, int col_x, int col_width,
 }
 
 // Draw file preview pane in rightmost column (for column view)
-static void draw_preview_column(App *app, FileEntry *entry, int col_x, int col_width)
+static void draw_preview_column(App *app, const DirectoryState *dir, FileEntry *entry, int col_x, int col_width)
 {
     int content_offset = get_content_offset_y(app);
     int preview_height = app->height - STATUSBAR_HEIGHT - content_offset;
@@ -523,29 +577,28 @@ static void draw_preview_column(App *app, FileEntry *entry, int col_x, int col_w
     y += ROW_HEIGHT + PADDING;
 
     // Truncated filename
+    const char *name = directory_entry_name(dir, entry);
     char display_name[128];
     int max_chars = text_width / 7;
-    if ((int)strlen(entry->name) > max_chars && max_chars > 3) {
-        strncpy(display_name, entry->name, max_chars - 2);
+    if ((int)entry->name_len > max_chars && max_chars > 3) {
+        strncpy(display_name, name, max_chars - 2);
         display_name[max_chars - 2] = '\0';
         strcat(display_name, "..");
     } else {
-        strncpy(display_name, entry->name, sizeof(display_name) - 1);
+        strncpy(display_name, name, sizeof(display_name) - 1);
         display_name[sizeof(display_name) - 1] = '\0';
     }
     DrawTextCustom(display_name, x, y, FONT_SIZE_SMALL, g_theme.accent);
     y += ROW_HEIGHT;
 
     // Size
-    char size_str[32];
-    format_file_size(entry->size, size_str, sizeof(size_str));
     char info[128];
-    snprintf(info, sizeof(info), "Size: %s", size_str);
+    snprintf(info, sizeof(info), "Size: %s", format_file_size_cached(entry->size));
     DrawTextCustom(info, x, y, FONT_SIZE_SMALL, g_theme.textSecondary);
     y += ROW_HEIGHT;
 
     // Type
-    const char *ext = entry->extension;
+    const char *ext = directory_entry_extension(dir, entry);
     if (ext && ext[0] != '\0') {
         snprintf(info, sizeof(info), "Type: .%s file", ext);
     } else {
@@ -555,9 +608,7 @@ static void draw_preview_column(App *app, FileEntry *entry, int col_x, int col_w
     y += ROW_HEIGHT;
 
     // Modified date
-    char date_str[32];
-    format_modified_time(entry->modified, date_str, sizeof(date_str));
-    snprintf(info, sizeof(info), "Modified: %s", date_str);
+    snprintf(info, sizeof(info), "Modified: %s", format_modified_time_cached(entry->modified));
     DrawTextCustom(info, x, y, FONT_SIZE_SMALL, g_theme.textSecondary);
     y += ROW_HEIGHT * 2;
 
@@ -570,7 +621,9 @@ static void draw_preview_column(App *app, FileEntry *entry, int col_x, int col_w
         DrawLine(x, y, col_x + col_width - PADDING, y, g_theme.border);
         y += PADDING;
 
-        FILE *f = fopen(entry->path, "r");
+        char entry_path[PATH_MAX_LEN];
+        directory_entry_path(dir, entry, entry_path, sizeof(entry_path));
+        FILE *f = fopen(entry_path, "r");
         if (f) {
             char line[256];
             int lines_shown = 0;
@@ -651,6 +704,50 @@ static void column_state_ensure_visible(ColumnState *cols, int current_column)
     if (cols->h_scroll < 0) cols->h_scroll = 0;
 }
 
+// Helper: A column's listing (free with directory_state_free). Taken from the directory
+// cache; on a miss it is read in the background and false is returned, with *failed set
+// if it could not be read. Debounced reads wait for the cursor to rest. Without a
+// prefetcher or cache the listing is read here
+static bool column_listing(App *app, const char *path, bool debounce, DirectoryState *out, bool *failed)
+{
+    directory_state_init(out);
+    out->show_hidden = app->directory.show_hidden;
+    *failed = false;
+
+    if (!app->listing_prefetch || !app->perf.dir_cache.enabled) {
+        bool loaded = directory_read_cached(out, path, &app->perf.dir_cache);
+        *failed = !loaded;
+        return loaded;
+    }
+
+    DirectoryState *cached = dir_cache_get(&app->perf.dir_cache, path);
+    if (cached && directory_view_available(cached, out->show_hidden)) {
+        bool show_hidden = out->show_hidden;
+        directory_state_copy(out, cached);
+        directory_set_show_hidden(out, show_hidden);
+        return true;
+    }
+
+    *failed = listing_prefetch_failed(app->listing_prefetch, path);
+    if (!*failed) {
+        listing_prefetch_request(app->listing_prefetch, path, out->show_hidden, debounce);
+    }
+    return false;
+}
+
+// Helper: An empty column with an optional message
+static void draw_column_placeholder(App *app, int col_x, int col_width, const char *message, Color color)
+{
+    int content_offset = get_content_offset_y(app);
+    int content_height = app->height - STATUSBAR_HEIGHT - content_offset;
+
+    draw_batch_rect(col_x, content_offset, col_width, content_height, g_theme.background);
+    draw_batch_rect(col_x + col_width - 1, content_offset, 1, content_height, g_theme.border);
+    if (message) {
+        DrawTextCustom(message, col_x + PADDING, content_offset + PADDING, FONT_SIZE_SMALL, color);
+    }
+}
+
 // Draw column view (Miller columns) with horizontal scrolling
 static void browser_draw_column(App *app)
 {
@@ -687,16 +784,25 @@ static void browser_draw_column(App *app)
         DrawTextCustom("<", content_x + 5, content_offset + content_height / 2, FONT_SIZE, g_theme.accent);
     }
 
+    // Columns are batched: backgrounds and highlights first, then all text
+    draw_batch_begin();
+
     // Draw visible columns
     int draw_x = content_x;
     for (int i = 0; i < cols->visible_columns - 1 && (cols->h_scroll + i) < cols->column_count; i++) {
         int col_index = cols->h_scroll + i;
         bool is_current = (col_index == current_col);
 
-        // Load directory for this column
+        // The current column is the listing at hand; others come from the cache
         DirectoryState col_dir;
-        directory_state_init(&col_dir);
-        bool loaded = directory_read(&col_dir, cols->paths[col_index]);
+        bool failed = false;
+        bool loaded = true;
+        if (is_current) {
+            directory_state_init(&col_dir);
+        } else {
+            loaded = column_listing(app, cols->paths[col_index], false, &col_dir, &failed);
+        }
+        DirectoryState *shown = is_current ? dir : &col_dir;
 
         if (loaded) {
             // Determine selection for this column
@@ -708,10 +814,11 @@ static void browser_draw_column(App *app)
                 sel_index = app->selected_index;
                 scroll_off = app->scroll_offset;
             } else if (col_index < cols->column_count - 1) {
-                // For parent columns, find which entry leads to the next path
-                const char *next_path = cols->paths[col_index + 1];
-                for (int j = 0; j < col_dir.count; j++) {
-                    if (strcmp(col_dir.entries[j].path, next_path) == 0) {
+                // For parent columns, find the entry named like the next path's last component
+                const char *next_name = strrchr(cols->paths[col_index + 1], '/');
+                next_name = next_name ? next_name + 1 : cols->paths[col_index + 1];
+                for (int j = 0; j < shown->count; j++) {
+                    if (strcmp(directory_entry_name(shown, &shown->entries[j]), next_name) == 0) {
                         sel_index = j;
                         break;
                     }
@@ -719,12 +826,11 @@ static void browser_draw_column(App *app)
             }
 
             // Draw the column
-            draw_column(app, &col_dir, draw_x, col_width, sel_index, scroll_off);
+            draw_column(app, shown, draw_x, col_width, sel_index, scroll_off);
+        } else if (failed) {
+            draw_column_placeholder(app, draw_x, col_width, "Error", g_theme.error);
         } else {
-            // Draw empty column with error
-            DrawRectangle(draw_x, content_offset, col_width, content_height, g_theme.background);
-            DrawLine(draw_x + col_width - 1, content_offset, draw_x + col_width - 1, content_offset + content_height, g_theme.border);
-            DrawTextCustom("Error", draw_x + PADDING, content_offset + PADDING, FONT_SIZE_SMALL, g_theme.error);
+            draw_column_placeholder(app, draw_x, col_width, "Loading...", g_theme.textSecondary);
         }
 
         directory_state_free(&col_dir);
@@ -735,36 +841,226 @@ static void browser_draw_column(App *app)
     if (dir->count > 0) {
         FileEntry *selected = &dir->entries[app->selected_index];
         if (selected->is_directory) {
-            // Preview shows directory contents
+            // Preview shows directory contents, read once the cursor rests on it
             DirectoryState preview_dir;
-            directory_state_init(&preview_dir);
-            if (directory_read(&preview_dir, selected->path)) {
+            bool failed = false;
+            char selected_path[PATH_MAX_LEN];
+            directory_entry_path(dir, selected, selected_path, sizeof(selected_path));
+            if (column_listing(app, selected_path, true, &preview_dir, &failed)) {
                 draw_column(app, &preview_dir, draw_x, col_width, -1, 0);
+            } else if (failed) {
+                draw_column_placeholder(app, draw_x, col_width, "Empty", g_theme.textSecondary);
             } else {
-                // Empty preview column
-                DrawRectangle(draw_x, content_offset, col_width, content_height, g_theme.background);
-                DrawLine(draw_x + col_width - 1, content_offset, draw_x + col_width - 1, content_offset + content_height, g_theme.border);
-                DrawTextCustom("Empty", draw_x + PADDING, content_offset + PADDING, FONT_SIZE_SMALL, g_theme.textSecondary);
+                draw_column_placeholder(app, draw_x, col_width, "Loading...", g_theme.textSecondary);
             }
             directory_state_free(&preview_dir);
         } else {
-            // Preview shows file info
-            draw_preview_column(app, selected, draw_x, col_width);
+            // Preview shows file info (drawn directly)
+            draw_batch_flush();
+            draw_preview_column(app, dir, selected, draw_x, col_width);
         }
     } else {
         // Empty preview column
-        DrawRectangle(draw_x, content_offset, col_width, content_height, g_theme.background);
-        DrawLine(draw_x + col_width - 1, content_offset, draw_x + col_width - 1, content_offset + content_height, g_theme.border);
+        draw_column_placeholder(app, draw_x, col_width, NULL, g_theme.textSecondary);
     }
 
+    draw_batch_end();
+
     // Draw right scroll indicator if more columns exist
     if (cols->h_scroll + cols->visible_columns - 1 < cols->column_count) {
         DrawTextCustom(">", content_x + content_width - 15, content_offset + content_height / 2, FONT_SIZE, g_theme.accent);
     }
 }
 
+// ============================================================================
+// TREEMAP VIEW
+// ============================================================================
+
+// Area the map fills: the content area below the header row
+static Rectangle treemap_area(App *app)
+{
+    int y = get_content_offset_y(app) + ROW_HEIGHT;
+    return (Rectangle){ sidebar_get_content_x(app), y, get_browser_width(app),
+                        app->height - STATUSBAR_HEIGHT - y };
+}
+
+// Whether the layout at hand is of the folder being shown
+static bool treemap_is_current(App *app)
+{
+    return app->treemap && strcmp(treemap_root(app->treemap), app->directory.current_path) == 0;
+}
+
+// Deepest rectangle under a point, or -1
+static int treemap_rect_at(App *app, Vector2 point)
+{
+    if (!treemap_is_current(app)) return -1;
+
+    Rectangle area = treemap_area(app);
+    float px = point.x - area.x;
+    float py = point.y - area.y;
+    int count;
+    const TreemapRect *rects = treemap_rects(app->treemap, &count);
+    // Children follow their parents, so the last hit is the deepest
+    for (int i = count - 1; i >= 0; i--) {
+        const TreemapRect *r = &rects[i];
+        if (px >= r->x && px < r->x + r->width && py >= r->y && py < r->y + r->height) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Folder under a point (a file or the folded items stand for their folder); false if
+// the point is not inside one
+static bool treemap_folder_at(App *app, Vector2 point, char *path, size_t path_size)
+{
+    int count;
+    const TreemapRect *rects = treemap_rects(app->treemap, &count);
+    int index = treemap_rect_at(app, point);
+    while (index >= 0 && rects[index].kind != TREEMAP_DIR) {
+        index = rects[index].parent;
+    }
+    return index >= 0 && treemap_rect_path(app->treemap, index, path, path_size);
+}
+
+// Ask for a new layout when the folder or the map's size changed, or, at most every
+// TREEMAP_REFRESH_TIME, when folder sizes moved since the last one
+static void treemap_update(App *app, Rectangle area)
+{
+    BrowserState *bs = &app->browser_state;
+    treemap_poll(app->treemap);
+
+    uint64_t generation = dir_sizes_generation(app->dir_sizes);
+    double now = GetTime();
+    bool moved = strcmp(bs->treemap_path, app->directory.current_path) != 0 ||
+                 bs->treemap_width != (int)area.width || bs->treemap_height != (int)area.height;
+    bool grown = generation != bs->treemap_generation &&
+                 now - bs->treemap_request_time >= TREEMAP_REFRESH_TIME;
+    if (!moved && !grown) return;
+
+    treemap_request(app->treemap, app->directory.current_path, (int)area.width, (int)area.height);
+    snprintf(bs->treemap_path, sizeof(bs->treemap_path), "%s", app->directory.current_path);
+    bs->treemap_width = (int)area.width;
+    bs->treemap_height = (int)area.height;
+    bs->treemap_generation = generation;
+    bs->treemap_request_time = now;
+}
+
+bool browser_treemap_is_stale(App *app)
+{
+    return app->view_mode == VIEW_TREEMAP && app->treemap &&
+           dir_sizes_generation(app->dir_sizes) != app->browser_state.treemap_generation;
+}
+
+static Color treemap_fill(const TreemapRect *rects, int index)
+{
+    const TreemapRect *r = &rects[index];
+    if (r->kind == TREEMAP_OTHER) {
+        return Fade(g_theme.textSecondary, 0.35f);
+    }
+
+    // Each top level entry keeps one hue for everything inside it
+    int top = index;
+    while (rects[top].parent >= 0) top = rects[top].parent;
+    float hue = fmodf(top * 47.0f, 360.0f);
+    if (r->kind == TREEMAP_DIR) {
+        return ColorFromHSV(hue, 0.45f, 0.40f + 0.08f * r->depth);
+    }
+    return ColorFromHSV(hue, 0.30f, 0.82f);
+}
+
+static void browser_draw_treemap(App *app)
+{
+    int content_x = sidebar_get_content_x(app);
+    int content_width = get_browser_width(app);
+    int y = get_content_offset_y(app);
+
+    DrawRectangle(content_x, y, content_width, ROW_HEIGHT, g_theme.sidebar);
+    DrawLine(content_x, y + ROW_HEIGHT, content_x + content_width, y + ROW_HEIGHT, g_theme.border);
+    int header_y = y + (ROW_HEIGHT - FONT_SIZE_SMALL) / 2;
+    int header_width = content_width - PADDING * 2;
+
+    Rectangle area = treemap_area(app);
+    if (!app->treemap) {
+        DrawTextCustom("Disk usage unavailable", content_x + PADDING, header_y, FONT_SIZE_SMALL, g_theme.error);
+        return;
+    }
+    treemap_update(app, area);
+    if (!treemap_is_current(app)) {
+        DrawTextCustom("Reading folder...", content_x + PADDING, header_y, FONT_SIZE_SMALL, g_theme.textSecondary);
+        return;
+    }
+
+    int count;
+    const TreemapRect *rects = treemap_rects(app->treemap, &count);
+    int hovered = treemap_rect_at(app, GetMousePosition());
+    bool partial = treemap_is_partial(app->treemap);
+
+    // Header: what is under the mouse, else the folder's total
+    char header[PATH_MAX_LEN + 64];
+    if (hovered >= 0) {
+        snprintf(header, sizeof(header), "%s    %s", treemap_rect_name(app->treemap, hovered),
+                 format_file_size_cached(rects[hovered].size));
+    } else {
+        snprintf(header, sizeof(header), "Total %s%s", format_file_size_cached(treemap_total(app->treemap)),
+                 partial ? "    Counting..." : "");
+    }
+    DrawTextFit(header, content_x + PADDING, header_y, FONT_SIZE_SMALL, header_width, g_theme.textSecondary);
+
+    if (count == 0) {
+        DrawTextCustom(partial ? "Counting..." : "Empty folder", content_x + PADDING,
+                       (int)area.y + PADDING, FONT_SIZE, g_theme.textSecondary);
+        return;
+    }
+
+    // Fills first (parents under their children, 1px gaps as borders), then labels
+    draw_batch_begin();
+    for (int i = 0; i < count; i++) {
+        const TreemapRect *r = &rects[i];
+        Color fill = treemap_fill(rects, i);
+        if (i == hovered) {
+            fill = ColorBrightness(fill, 0.15f);
+        }
+        draw_batch_rect((int)(area.x + r->x), (int)(area.y + r->y), (int)r->width - 1, (int)r->height - 1, fill);
+    }
+    Color dark_text = { 20, 20, 20, 255 };
+    for (int i = 0; i < count; i++) {
+        const TreemapRect *r = &rects[i];
+        if (r->width < 36 || r->height < FONT_SIZE_SMALL + 4) continue;
+
+        int x = (int)(area.x + r->x) + 4;
+        int label_y = (int)(area.y + r->y) + 2;
+        int max_width = (int)r->width - 8;
+        Color color = r->kind == TREEMAP_DIR ? WHITE : dark_text;
+        DrawTextFit(treemap_rect_name(app->treemap, i), x, label_y, FONT_SIZE_SMALL, max_width, color);
+        if (r->kind != TREEMAP_DIR && r->height >= FONT_SIZE_SMALL * 2 + 6) {
+            DrawTextFit(format_file_size_cached(r->size), x, label_y + FONT_SIZE_SMALL + 2,
+                        FONT_SIZE_SMALL, max_width, Fade(color, 0.7f));
+        }
+    }
+    draw_batch_end();
+
+    // The selected entry and the one under the mouse
+    const char *selected = NULL;
+    if (app->selected_index >= 0 && app->selected_index < app->directory.count) {
+        selected = directory_entry_name(&app->directory, &app->directory.entries[app->selected_index]);
+    }
+    for (int i = 0; selected && i < count; i++) {
+        if (rects[i].parent < 0 && strcmp(treemap_rect_name(app->treemap, i), selected) == 0) {
+            Rectangle bounds = { area.x + rects[i].x, area.y + rects[i].y, rects[i].width - 1, rects[i].height - 1 };
+            DrawRectangleLinesEx(bounds, 2.0f, g_theme.accent);
+            break;
+        }
+    }
+    if (hovered >= 0) {
+        DrawRectangleLines((int)(area.x + rects[hovered].x), (int)(area.y + rects[hovered].y),
+                           (int)rects[hovered].width - 1, (int)rects[hovered].height - 1, g_theme.accent);
+    }
+}
+
 void browser_draw(App *app)
 {
+    TRACE_SCOPE("browser_draw");
     switch (app->view_mode) {
         case VIEW_LIST:
             browser_draw_list(app);
@@ -775,6 +1071,9 @@ void browser_draw(App *app)
         case VIEW_COLUMN:
             browser_draw_column(app);
             break;
+        case VIEW_TREEMAP:
+            browser_draw_treemap(app);
+            break;
     }
 }
 
@@ -934,6 +1233,24 @@ static int browser_column_hit_test(App *app, Vector2 mouse_pos)
     return (index >= 0 && index < app->directory.count) ? index : -1;
 }
 
+// Hit test for treemap view - the entry whose rectangle holds the point
+static int browser_treemap_hit_test(App *app, Vector2 mouse_pos)
+{
+    int index = treemap_rect_at(app, mouse_pos);
+    if (index < 0) return -1;
+
+    int count;
+    const TreemapRect *rects = treemap_rects(app->treemap, &count);
+    while (rects[index].parent >= 0) index = rects[index].parent;
+    const char *name = treemap_rect_name(app->treemap, index);
+    for (int i = 0; i < app->directory.count; i++) {
+        if (strcmp(directory_entry_name(&app->directory, &app->directory.entries[i]), name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 // Unified hit test - dispatches based on view mode
 static int browser_hit_test(App *app, Vector2 mouse_pos)
 {
@@ -941,6 +1258,7 @@ static int browser_hit_test(App *app, Vector2 mouse_pos)
         case VIEW_LIST:   return browser_list_hit_test(app, mouse_pos);
         case VIEW_GRID:   return browser_grid_hit_test(app, mouse_pos);
         case VIEW_COLUMN: return browser_column_hit_test(app, mouse_pos);
+        case VIEW_TREEMAP: return browser_treemap_hit_test(app, mouse_pos);
         default:          return -1;
     }
     return -1;
@@ -1020,11 +1338,9 @@ static void browser_update_hover(App *app, Vector2 mouse_pos, double current_tim
     int hovered_index = browser_hit_test(app, mouse_pos);
 
     if (hovered_index != bs->hovered_index) {
-        // Cancel any pending async request
-        if (bs->summary_state == HOVER_LOADING && atomic_load(&app->summary_thread_active)) {
+        // Cancel any pending async request; its worker moves on without waiting for it
+        if (bs->summary_state == HOVER_LOADING) {
             summarize_async_cancel(&app->async_summary_request);
-            pthread_join(app->summary_thread, NULL);
-            atomic_store(&app->summary_thread_active, false);
         }
 
         bs->hovered_index = hovered_index;
@@ -1057,16 +1373,19 @@ static void browser_update_summary_debounce(App *app, double current_time)
 
     FileEntry *entry = &app->directory.entries[bs->hovered_index];
 
-    if (entry->is_directory || !is_summarizable_extension(entry->extension)) {
+    if (entry->is_directory || !is_summarizable_extension(directory_entry_extension(&app->directory, entry))) {
         bs->summary_state = HOVER_IDLE;
         return;
     }
 
+    char entry_path[PATH_MAX_LEN];
+    directory_entry_path(&app->directory, entry, entry_path, sizeof(entry_path));
+
     // Check cache first (fast, synchronous)
     SummaryResult cached;
-    if (app->summary_cache && summary_cache_get(app->summary_cache, entry->path, &cached)) {
+    if (app->summary_cache && summary_cache_get(app->summary_cache, entry_path, &cached)) {
         safe_strcpy(bs->summary_text, cached.summary, sizeof(bs->summary_text));
-        safe_strcpy(bs->summary_path, entry->path, sizeof(bs->summary_path));
+        safe_strcpy(bs->summary_path, entry_path, sizeof(bs->summary_path));
         bs->summary_state = HOVER_READY;
 
         if (!preview_is_visible(&app->preview)) {
@@ -1077,9 +1396,9 @@ static void browser_update_summary_debounce(App *app, double current_time)
 
     // Cache miss - start async API call
     app->summary_config.default_level = SUMM_LEVEL_BRIEF;
-    if (summarize_async_start(&app->async_summary_request, &app->summary_thread,
-                              entry->path, &app->summary_config, app->summary_cache)) {
-        atomic_store(&app->summary_thread_active, true);
+    if (summarize_async_start(app->summary_executor, &app->async_summary_request,
+                              entry_path, &app->summary_config, app->summary_cache,
+                              SUMM_PRIORITY_HOVER)) {
         bs->summary_state = HOVER_LOADING;
 
         if (!preview_is_visible(&app->preview)) {
@@ -1092,23 +1411,24 @@ static void browser_update_summary_debounce(App *app, double current_time)
 }
 
 // ============================================================================
-// HOVER: Poll async summary completion
+// HOVER: Poll async summary progress and completion
 // ============================================================================
 static void browser_poll_async_summary(App *app)
 {
     BrowserState *bs = &app->browser_state;
 
-    if (bs->summary_state != HOVER_LOADING || !atomic_load(&app->summary_thread_active)) {
+    if (bs->summary_state != HOVER_LOADING) {
         return;
     }
 
     if (!summarize_async_is_complete(&app->async_summary_request)) {
+        // Show the summary as it streams in
+        if (!summarize_async_partial(&app->async_summary_request, bs->summary_text, sizeof(bs->summary_text))) {
+            bs->summary_text[0] = '\0';
+        }
         return;
     }
 
-    pthread_join(app->summary_thread, NULL);
-    atomic_store(&app->summary_thread_active, false);
-
     AsyncSummaryRequest *req = &app->async_summary_request;
     if (req->result.status == SUMM_STATUS_OK) {
         safe_strcpy(bs->summary_text, req->result.summary, sizeof(bs->summary_text));
@@ -1120,6 +1440,179 @@ static void browser_poll_async_summary(App *app)
     }
 }
 
+// ============================================================================
+// PREFETCH: Warm summaries for the rows around the selection and the hovered row, so
+// the summary pane fills the moment the selection arrives
+// ============================================================================
+
+// Helper: Path of the summarizable file at index; false for directories, other types
+// and rows out of range
+static bool prefetch_entry_path(App *app, int index, char *path, size_t path_size)
+{
+    if (index < 0 || index >= app->directory.count) {
+        return false;
+    }
+
+    FileEntry *entry = &app->directory.entries[index];
+    if (entry->is_directory || !is_summarizable_extension(directory_entry_extension(&app->directory, entry))) {
+        return false;
+    }
+
+    directory_entry_path(&app->directory, entry, path, path_size);
+    return true;
+}
+
+// Helper: Show a summary in the pane
+static void prefetch_show(BrowserState *bs, const char *path, const char *summary)
+{
+    safe_strcpy(bs->summary_text, summary, sizeof(bs->summary_text));
+    safe_strcpy(bs->summary_path, path, sizeof(bs->summary_path));
+    bs->summary_state = HOVER_READY;
+}
+
+// Helper: On arriving at a row, show its summary if one is cached and drop one shown for
+// another file. A summary being generated on request is left alone
+static void prefetch_arrive(App *app)
+{
+    BrowserState *bs = &app->browser_state;
+    if (bs->summary_state == HOVER_LOADING) {
+        return;
+    }
+
+    char path[PATH_MAX_LEN] = "";
+    SummaryResult cached;
+    if (prefetch_entry_path(app, app->selected_index, path, sizeof(path)) &&
+        app->summary_cache && summary_cache_get(app->summary_cache, path, &cached)) {
+        prefetch_show(bs, path, cached.summary);
+    } else if (bs->summary_state != HOVER_IDLE && strcmp(bs->summary_path, path) != 0) {
+        bs->summary_state = HOVER_IDLE;
+    }
+}
+
+// Helper: Take finished prefetches; one for the selected row goes straight to the pane
+static void prefetch_poll(App *app)
+{
+    BrowserState *bs = &app->browser_state;
+    char selected_path[PATH_MAX_LEN] = "";
+    prefetch_entry_path(app, app->selected_index, selected_path, sizeof(selected_path));
+
+    for (int i = 0; i < PREFETCH_REQUESTS; i++) {
+        AsyncSummaryRequest *req = &app->prefetch_requests[i];
+        if (!summarize_async_is_complete(req)) {
+            continue;
+        }
+
+        if (req->result.status == SUMM_STATUS_OK && bs->summary_state != HOVER_LOADING &&
+            strcmp(req->result.path, selected_path) == 0) {
+            prefetch_show(bs, req->result.path, req->result.summary);
+        }
+
+        pthread_mutex_lock(&app->summary_mutex);
+        req->completed = false;
+        pthread_mutex_unlock(&app->summary_mutex);
+    }
+}
+
+// Helper: Queue summaries for the uncached rows near the focus (the hovered row first,
+// then outwards from the selection) and cancel those for rows it has moved away from
+static void prefetch_plan(App *app)
+{
+    BrowserState *bs = &app->browser_state;
+    char wanted[PREFETCH_REQUESTS][PATH_MAX_LEN];
+    int wanted_count = 0;
+
+    int rows[PREFETCH_REQUESTS];
+    int row_count = 0;
+    if (bs->hovered_index >= 0 && bs->hovered_index != app->selected_index) {
+        rows[row_count++] = bs->hovered_index;
+    }
+    for (int d = 1; d <= PREFETCH_RADIUS; d++) {
+        rows[row_count++] = app->selected_index + d;
+        rows[row_count++] = app->selected_index - d;
+    }
+
+    // Cache lookups alone also pull the neighbors' summaries into memory
+    for (int i = 0; i < row_count && wanted_count < PREFETCH_REQUESTS; i++) {
+        SummaryResult cached;
+        if (prefetch_entry_path(app, rows[i], wanted[wanted_count], PATH_MAX_LEN) &&
+            !(app->summary_cache && summary_cache_get(app->summary_cache, wanted[wanted_count], &cached))) {
+            wanted_count++;
+        }
+    }
+
+    bool queued[PREFETCH_REQUESTS] = {false};
+    for (int i = 0; i < PREFETCH_REQUESTS; i++) {
+        AsyncSummaryRequest *req = &app->prefetch_requests[i];
+        if (!summarize_async_is_busy(req)) {
+            continue;
+        }
+
+        bool still_wanted = false;
+        for (int w = 0; w < wanted_count; w++) {
+            if (strcmp(req->path, wanted[w]) == 0) {
+                still_wanted = queued[w] = true;
+            }
+        }
+        if (!still_wanted) {
+            summarize_async_cancel(req);
+        }
+    }
+
+    if (app->summary_config.api_key[0] == '\0') {
+        return;
+    }
+
+    SummarizeConfig config = app->summary_config;
+    config.default_level = SUMM_LEVEL_BRIEF;
+    int slot = 0;
+    for (int w = 0; w < wanted_count && bs->prefetch_budget > 0; w++) {
+        if (queued[w]) {
+            continue;
+        }
+        while (slot < PREFETCH_REQUESTS && summarize_async_is_busy(&app->prefetch_requests[slot])) {
+            slot++;
+        }
+        if (slot == PREFETCH_REQUESTS) {
+            break;
+        }
+        if (summarize_async_start(app->summary_executor, &app->prefetch_requests[slot], wanted[w],
+                                  &config, app->summary_cache, SUMM_PRIORITY_PREFETCH)) {
+            bs->prefetch_budget--;
+        }
+        slot++;
+    }
+}
+
+// Follow the selection and hover; once both rest, run a prefetch round
+static void browser_update_prefetch(App *app, double current_time)
+{
+    BrowserState *bs = &app->browser_state;
+
+    // A new directory gets a fresh budget
+    if (strcmp(bs->prefetch_dir, app->directory.current_path) != 0) {
+        safe_strcpy(bs->prefetch_dir, app->directory.current_path, sizeof(bs->prefetch_dir));
+        bs->prefetch_budget = PREFETCH_BUDGET;
+        bs->prefetch_selected = -1;
+    }
+
+    if (app->selected_index != bs->prefetch_selected || bs->hovered_index != bs->prefetch_hovered) {
+        if (app->selected_index != bs->prefetch_selected) {
+            prefetch_arrive(app);
+        }
+        bs->prefetch_selected = app->selected_index;
+        bs->prefetch_hovered = bs->hovered_index;
+        bs->prefetch_focus_time = current_time;
+        bs->prefetch_planned = false;
+    }
+
+    prefetch_poll(app);
+
+    if (!bs->prefetch_planned && current_time - bs->prefetch_focus_time >= PREFETCH_IDLE_TIME) {
+        bs->prefetch_planned = true;
+        prefetch_plan(app);
+    }
+}
+
 // ============================================================================
 // CLICK: Handle mouse click for selection and navigation
 // ============================================================================
@@ -1136,10 +1629,23 @@ static void browser_handle_click(App *app, Vector2 mouse_pos, double current_tim
         bool is_double_click = (clicked_index == bs->last_click_index) &&
                                (current_time - bs->last_click_time) < DOUBLE_CLICK_TIME;
 
-        if (is_double_click && !cmd_down && !shift_down) {
+        char folder[PATH_MAX_LEN];
+        if (is_double_click && !cmd_down && !shift_down && app->view_mode == VIEW_TREEMAP &&
+            treemap_folder_at(app, mouse_pos, folder, sizeof(folder))) {
+            // Double-click in the treemap: open the folder under the mouse, however deep
+            if (directory_read(&app->directory, folder)) {
+                app->selected_index = 0;
+                app->scroll_offset = 0;
+                selection_clear(&app->selection);
+                history_push(&app->history, app->directory.current_path);
+                breadcrumb_update(&app->breadcrumb, app->directory.current_path);
+            }
+            bs->last_click_index = -1;
+            bs->last_click_time = 0;
+        } else if (is_double_click && !cmd_down && !shift_down) {
             // Double-click: navigate into directory or open file view modal
             FileEntry *entry = &app->directory.entries[clicked_index];
-            if (entry->is_directory) {
+            if (directory_entry_enterable(&app->directory, entry)) {
                 if (directory_enter(&app->directory, clicked_index)) {
                     app->selected_index = 0;
                     app->scroll_offset = 0;
@@ -1154,19 +1660,25 @@ static void browser_handle_click(App *app, Vector2 mouse_pos, double current_tim
             } else {
                 // Double-click on file: open file view modal
                 // Load the preview first to get content/texture
-                preview_load(&app->preview, entry->path);
+                char entry_path[PATH_MAX_LEN];
+                directory_entry_path(&app->directory, entry, entry_path, sizeof(entry_path));
+                preview_load(&app->preview, entry_path);
 
                 PreviewType ptype = app->preview.type;
                 if (ptype == PREVIEW_TEXT || ptype == PREVIEW_CODE || ptype == PREVIEW_MARKDOWN) {
-                    // Open text in modal
-                    if (app->preview.text_content) {
-                        file_view_modal_show_text(&app->file_view_modal, entry->path,
-                                                  app->preview.text_content);
+                    // Open text in modal, mapped so it opens at any size; copied (the start
+                    // of a very large file) only if it cannot be mapped
+                    if (!file_view_modal_show_file(&app->file_view_modal, entry_path)) {
+                        char *text = preview_copy_text(&app->preview, PREVIEW_MODAL_TEXT_SIZE);
+                        if (text) {
+                            file_view_modal_show_text(&app->file_view_modal, entry_path, text);
+                            free(text);
+                        }
                     }
                 } else if (ptype == PREVIEW_IMAGE) {
                     // Open image in modal
                     if (app->preview.texture_id != 0) {
-                        file_view_modal_show_image(&app->file_view_modal, entry->path,
+                        file_view_modal_show_image(&app->file_view_modal, entry_path,
                                                    app->preview.texture_id,
                                                    app->preview.image_width,
                                                    app->preview.image_height);
@@ -1201,7 +1713,9 @@ static void browser_handle_click(App *app, Vector2 mouse_pos, double current_tim
                 if (!preview_is_visible(&app->preview)) {
                     app->preview.visible = true;
                 }
-                preview_load(&app->preview, entry->path);
+                char entry_path[PATH_MAX_LEN];
+                directory_entry_path(&app->directory, entry, entry_path, sizeof(entry_path));
+                preview_load(&app->preview, entry_path);
             }
         }
 
@@ -1242,15 +1756,42 @@ static void browser_handle_rubber_band(App *app, Vector2 mouse_pos)
         selection_clear(&app->selection);
     }
 
-    for (int i = 0; i < app->directory.count; i++) {
-        Rectangle item_bounds = get_grid_item_bounds(app, i);
-        if (rects_intersect(sel_rect, item_bounds)) {
-            selection_add(&app->selection, i);
+    // Items sit on a grid: select the run of columns the band crosses in each row it
+    // crosses, instead of testing every item
+    int count = app->directory.count;
+    int cols = (get_browser_width(app) - PADDING * 2) / GRID_ITEM_WIDTH;
+    if (cols < 1) cols = 1;
+    if (count > 0) {
+        Rectangle origin = get_grid_item_bounds(app, 0);
+        int first_row = (int)floorf((sel_rect.y - origin.y - origin.height) / GRID_ITEM_HEIGHT);
+        int last_row = (int)floorf((sel_rect.y + sel_rect.height - origin.y) / GRID_ITEM_HEIGHT) + 1;
+        int first_col = (int)floorf((sel_rect.x - origin.x - origin.width) / GRID_ITEM_WIDTH);
+        int last_col = (int)floorf((sel_rect.x + sel_rect.width - origin.x) / GRID_ITEM_WIDTH) + 1;
+        if (first_row < 0) first_row = 0;
+        if (last_row > (count - 1) / cols) last_row = (count - 1) / cols;
+        if (first_col < 0) first_col = 0;
+        if (last_col > cols - 1) last_col = cols - 1;
+
+        // The estimates may be one out at each edge: check those items exactly
+        while (first_col <= last_col &&
+               !rects_intersect(sel_rect, get_grid_item_bounds(app, first_row * cols + first_col))) first_col++;
+        while (last_col >= first_col &&
+               !rects_intersect(sel_rect, get_grid_item_bounds(app, first_row * cols + last_col))) last_col--;
+        while (first_row <= last_row &&
+               !rects_intersect(sel_rect, get_grid_item_bounds(app, first_row * cols + first_col))) first_row++;
+        while (last_row >= first_row &&
+               !rects_intersect(sel_rect, get_grid_item_bounds(app, last_row * cols + first_col))) last_row--;
+
+        for (int row = first_row; first_col <= last_col && row <= last_row; row++) {
+            int start = row * cols + first_col;
+            int end = row * cols + last_col;
+            if (start >= count) break;
+            selection_add_range(&app->selection, start, end < count ? end : count - 1);
         }
     }
 
     if (app->selection.count > 0) {
-        app->selected_index = app->selection.indices[0];
+        app->selected_index = selection_next(&app->selection, 0);
     }
 }
 
@@ -1268,6 +1809,7 @@ void browser_handle_input(App *app)
     // Process async summary polling (summary now triggered by button, not auto-debounce)
     // browser_update_summary_debounce(app, current_time);  // Disabled: summary is now optional via button
     browser_poll_async_summary(app);
+    browser_update_prefetch(app, current_time);
 
     // Handle click (check if in content area first)
     ContentArea area = get_content_area(app);
@@ -3,6 +3,7 @@
 
 #include "core/filesystem.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 // Forward declaration
 struct App;
@@ -11,6 +12,15 @@ struct App;
 #define DOUBLE_CLICK_TIME 0.5    // seconds
 #define HOVER_DEBOUNCE_TIME 0.5  // seconds before triggering AI summary
 
+// Summary prefetch around the selection
+#define PREFETCH_IDLE_TIME 0.25  // seconds the selection and hover must rest first
+#define PREFETCH_RADIUS 2        // rows prefetched on each side of the selection
+#define PREFETCH_REQUESTS (PREFETCH_RADIUS * 2 + 1)  // Neighbors plus the hovered row
+#define PREFETCH_BUDGET 12       // API summaries prefetched per directory visit
+
+// Treemap view
+#define TREEMAP_REFRESH_TIME 0.25  // seconds between layouts while sizes stream in
+
 // Hover summary state for async AI summarization
 typedef enum HoverSummaryState {
     HOVER_IDLE,       // Not hovering or no summary needed
@@ -35,6 +45,21 @@ typedef struct BrowserState {
     char summary_text[4096];     // Cached summary text
     char summary_path[PATH_MAX_LEN];  // Path being/was summarized
     char summary_error[256];     // Error message if any
+
+    // Summary prefetch
+    int prefetch_selected;       // Selection and hover the current round is for
+    int prefetch_hovered;
+    double prefetch_focus_time;  // When either last moved
+    bool prefetch_planned;       // The current focus already queued its round
+    int prefetch_budget;         // API summaries left for this directory
+    char prefetch_dir[PATH_MAX_LEN];
+
+    // Treemap layout last requested
+    char treemap_path[PATH_MAX_LEN];
+    int treemap_width;
+    int treemap_height;
+    uint64_t treemap_generation;  // Folder size generation it saw
+    double treemap_request_time;
 } BrowserState;
 
 // Draw the file browser list
@@ -49,4 +74,7 @@ void browser_draw_rubber_band(struct App *app);
 // Ensure the selected item is visible (adjust scroll)
 void browser_ensure_visible(struct App *app);
 
+// Whether the treemap view still has newer folder sizes to lay out
+bool browser_treemap_is_stale(struct App *app);
+
 #endif // BROWSER_H
@@ -2,6 +2,7 @@
 #include "../utils/theme.h"
 #include "../utils/font.h"
 #include "../api/gemini_client.h"
+#include "../ai/intent_match.h"
 #include "../../external/cJSON/cJSON.h"
 #include <stdlib.h>
 #include <string.h>
@@ -25,6 +26,8 @@
 
 static char system_prompt_buffer[4096];
 
+static void command_bar_poll_request(CommandBar *bar);
+
 void command_bar_init(CommandBar *bar)
 {
     if (!bar) return;
@@ -45,10 +48,15 @@ void command_bar_init(CommandBar *bar)
     // Create tool executor
     bar->executor = tool_executor_create(bar->registry);
 
+    // Local intents (learned commands are loaded by command_bar_set_intents)
+    bar->intents = intent_matcher_create();
+
     // Initialize AI progress indicator
     progress_indicator_init(&bar->ai_progress, PROGRESS_SPINNER);
     progress_indicator_set_message(&bar->ai_progress, "Thinking...");
 
+    pthread_mutex_init(&bar->stream_mutex, NULL);
+
     auth_init(&bar->auth);
 }
 
@@ -56,6 +64,20 @@ void command_bar_free(CommandBar *bar)
 {
     if (!bar) return;
 
+    // Stop a request in flight at its next streamed piece
+    if (bar->request_active) {
+        pthread_mutex_lock(&bar->stream_mutex);
+        bar->request_cancelled = true;
+        pthread_mutex_unlock(&bar->stream_mutex);
+        pthread_join(bar->request_thread, NULL);
+        bar->request_active = false;
+        if (bar->request.tools) {
+            cJSON_Delete(bar->request.tools);
+            bar->request.tools = NULL;
+        }
+    }
+    pthread_mutex_destroy(&bar->stream_mutex);
+
     if (bar->claude) {
         claude_client_destroy(bar->claude);
         bar->claude = NULL;
@@ -76,6 +98,13 @@ void command_bar_free(CommandBar *bar)
         bar->registry = NULL;
     }
 
+    // Use counts of learned commands changed as they ran
+    if (bar->intents && bar->intent_path[0]) {
+        intent_matcher_save(bar->intents, bar->intent_path);
+    }
+    intent_matcher_free(bar->intents);
+    bar->intents = NULL;
+
     claude_request_cleanup(&bar->request);
     claude_response_cleanup(&bar->response);
     auth_clear(&bar->auth);
@@ -127,7 +156,9 @@ void command_bar_show(CommandBar *bar)
     if (!bar) return;
     bar->visible = true;
     bar->focused = true;
-    bar->state = CMD_STATE_INPUT;
+    if (bar->state != CMD_STATE_LOADING) {
+        bar->state = CMD_STATE_INPUT;
+    }
     bar->cursor_pos = (int)strlen(bar->input);
     bar->animation_progress = 0.0f;
 }
@@ -180,6 +211,9 @@ void command_bar_update(CommandBar *bar, float delta_time)
         progress_indicator_update(&bar->ai_progress, delta_time);
     }
 
+    // Finish the request once it is in, shown or not
+    command_bar_poll_request(bar);
+
     // Result timer
     if (bar->state == CMD_STATE_RESULT) {
         bar->result_timer -= delta_time;
@@ -329,9 +363,11 @@ const char *command_bar_get_system_prompt(const char *current_dir)
         "- file_create: Create new files or directories\n"
         "- file_rename: Rename a file or directory\n"
         "- file_search: Search for files by pattern\n"
+        "- content_search: Find lines of text inside files, like grep (literal or regex)\n"
         "- file_metadata: Get detailed info about a file\n"
         "- batch_rename: Rename multiple files with find/replace\n"
-        "- batch_move: Move and organize multiple files\n\n"
+        "- batch_move: Move and organize multiple files\n"
+        "- bulk_operation: Move, copy or trash every file matching a pattern, filtered by age or size, in one call\n\n"
         "AI-Powered Search Tools (use when user describes content or visual appearance):\n"
         "- semantic_search: Find files by their content meaning (e.g., 'find documents about machine learning')\n"
         "- visual_search: Find images by description (e.g., 'find photos of sunset at beach')\n"
@@ -344,6 +380,7 @@ const char *command_bar_get_system_prompt(const char *current_dir)
         "3. For ambiguous requests, list files first to understand the context\n"
         "4. Use relative paths from the current directory when possible\n"
         "5. Confirm understanding before batch operations on many files\n"
+        "   For many files chosen by name, age or size, use one bulk_operation rather than a call per file\n"
         "6. Use semantic_search for content-based queries, visual_search for image queries\n\n"
         "Always respond concisely and use tools to take action rather than just describing what you would do.",
         current_dir ? current_dir : "/");
@@ -351,47 +388,95 @@ const char *command_bar_get_system_prompt(const char *current_dir)
     return system_prompt_buffer;
 }
 
-void command_bar_submit(CommandBar *bar)
+// Streamed answer text: keep it for the loading line, stop once cancelled
+static bool command_bar_stream_text(void *context, const char *text)
 {
-    CMDBAR_LOG("=== command_bar_submit START ===");
+    CommandBar *bar = (CommandBar *)context;
 
-    if (!bar || strlen(bar->input) == 0) {
-        CMDBAR_LOG("ERROR: NULL bar or empty input");
-        return;
-    }
+    pthread_mutex_lock(&bar->stream_mutex);
+    size_t len = strlen(bar->stream_text);
+    strncat(bar->stream_text, text, sizeof(bar->stream_text) - len - 1);
+    bool keep_going = !bar->request_cancelled;
+    pthread_mutex_unlock(&bar->stream_mutex);
 
-    CMDBAR_LOG("User input: %s", bar->input);
-    CMDBAR_LOG("Gemini client configured: %s", bar->gemini ? "YES" : "NO");
+    return keep_going;
+}
 
-    // Check auth
-    if (!bar->claude || !auth_is_ready(&bar->auth)) {
-        CMDBAR_LOG("ERROR: Claude API not ready");
-        strncpy(bar->result_message, "API key not configured. Set CLAUDE_API_KEY environment variable.", sizeof(bar->result_message) - 1);
-        bar->state = CMD_STATE_ERROR;
-        bar->result_timer = RESULT_DISPLAY_TIME;
-        return;
-    }
+// Streamed tool use: name it on the loading line while the rest arrives
+static bool command_bar_stream_tool(void *context, const ClaudeToolUse *tool)
+{
+    CommandBar *bar = (CommandBar *)context;
 
-    bar->state = CMD_STATE_LOADING;
+    pthread_mutex_lock(&bar->stream_mutex);
+    strncpy(bar->stream_tool, tool->name, sizeof(bar->stream_tool) - 1);
+    bar->stream_tool[sizeof(bar->stream_tool) - 1] = '\0';
+    bool keep_going = !bar->request_cancelled;
+    pthread_mutex_unlock(&bar->stream_mutex);
 
-    // Build request
-    claude_request_init(&bar->request);
-    claude_request_set_system_prompt(&bar->request, command_bar_get_system_prompt(bar->executor ? bar->executor->current_dir : NULL));
-    claude_request_add_user_message(&bar->request, bar->input);
+    return keep_going;
+}
 
-    // Add tools
-    cJSON *tools = tool_registry_to_json(bar->registry);
-    claude_request_set_tools(&bar->request, tools);
+static void *command_bar_request_thread(void *arg)
+{
+    CommandBar *bar = (CommandBar *)arg;
 
-    CMDBAR_LOG("Sending request to Claude...");
+    ClaudeStreamCallbacks callbacks = {
+        .on_text = command_bar_stream_text,
+        .on_tool_use = command_bar_stream_tool,
+        .context = bar
+    };
+    bool success = claude_send_message_stream(bar->claude, &bar->request, &callbacks, &bar->response);
 
-    // Send request
-    claude_response_init(&bar->response);
-    bool success = claude_send_message(bar->claude, &bar->request, &bar->response);
+    pthread_mutex_lock(&bar->stream_mutex);
+    bar->request_ok = success;
+    bar->request_done = true;
+    pthread_mutex_unlock(&bar->stream_mutex);
+
+    return NULL;
+}
 
-    if (tools) cJSON_Delete(tools);
+// Add the input and the result message to history
+static void command_bar_add_history(CommandBar *bar, bool success)
+{
+    if (bar->history_count < COMMAND_BAR_MAX_HISTORY) {
+        memmove(&bar->history[1], &bar->history[0], sizeof(CommandHistoryEntry) * (size_t)bar->history_count);
+        strncpy(bar->history[0].input, bar->input, COMMAND_BAR_MAX_INPUT - 1);
+        strncpy(bar->history[0].response, bar->result_message, sizeof(bar->history[0].response) - 1);
+        bar->history[0].success = success;
+        bar->history_count++;
+    }
+}
+
+// Start confirming no operations; command_bar_add_operation adds them
+static void command_bar_begin_confirmation(CommandBar *bar, bool learn)
+{
+    bar->confirmation.operation_count = 0;
+    bar->confirmation.selected_index = 0;
+    bar->confirmation.confirmed = false;
+    bar->confirmation.cancelled = false;
+    bar->learn_on_confirm = learn;
+}
+
+static void command_bar_add_operation(CommandBar *bar, const char *name, const char *id, const char *input)
+{
+    if (bar->confirmation.operation_count >= CONFIRMATION_MAX_OPERATIONS) return;
+    tool_executor_prepare(bar->executor, name, id, input,
+                          &bar->confirmation.operations[bar->confirmation.operation_count]);
+    bar->confirmation.operation_count++;
+}
+
+// Act on the finished response: confirm tool uses, or show the answer
+static void command_bar_finish_request(CommandBar *bar, bool success)
+{
+    if (bar->request.tools) {
+        cJSON_Delete(bar->request.tools);
+        bar->request.tools = NULL;
+    }
 
     CMDBAR_LOG("Claude response: success=%d", success);
+    CMDBAR_LOG("Tokens: input=%d output=%d cache_write=%d cache_read=%d",
+               bar->response.input_tokens, bar->response.output_tokens,
+               bar->response.cache_creation_tokens, bar->response.cache_read_tokens);
 
     if (!success) {
         CMDBAR_LOG("ERROR: Claude request failed: %s", bar->response.error ? bar->response.error : "unknown");
@@ -411,11 +496,8 @@ void command_bar_submit(CommandBar *bar)
     if (claude_response_has_tool_use(&bar->response)) {
         CMDBAR_LOG("Claude wants to use %d tools", bar->response.tool_use_count);
 
-        // Prepare pending operations for confirmation
-        bar->confirmation.operation_count = 0;
-        bar->confirmation.selected_index = 0;
-        bar->confirmation.confirmed = false;
-        bar->confirmation.cancelled = false;
+        // Prepare pending operations for confirmation; all of them must fit to be learned
+        command_bar_begin_confirmation(bar, bar->response.tool_use_count <= INTENT_MAX_CALLS);
 
         for (int i = 0; i < bar->response.tool_use_count && i < CONFIRMATION_MAX_OPERATIONS; i++) {
             ClaudeToolUse *tool_use = &bar->response.tool_uses[i];
@@ -423,9 +505,7 @@ void command_bar_submit(CommandBar *bar)
             CMDBAR_LOG("Tool %d input: %.200s%s", i, tool_use->input,
                        strlen(tool_use->input) > 200 ? "..." : "");
 
-            tool_executor_prepare(bar->executor, tool_use->name, tool_use->id,
-                                  tool_use->input, &bar->confirmation.operations[i]);
-            bar->confirmation.operation_count++;
+            command_bar_add_operation(bar, tool_use->name, tool_use->id, tool_use->input);
         }
 
         bar->state = CMD_STATE_CONFIRMING;
@@ -437,18 +517,154 @@ void command_bar_submit(CommandBar *bar)
         bar->state = CMD_STATE_RESULT;
         bar->result_timer = RESULT_DISPLAY_TIME;
 
-        // Add to history
-        if (bar->history_count < COMMAND_BAR_MAX_HISTORY) {
-            memmove(&bar->history[1], &bar->history[0], sizeof(CommandHistoryEntry) * (size_t)bar->history_count);
-            strncpy(bar->history[0].input, bar->input, COMMAND_BAR_MAX_INPUT - 1);
-            strncpy(bar->history[0].response, bar->result_message, sizeof(bar->history[0].response) - 1);
-            bar->history[0].success = true;
-            bar->history_count++;
-        }
+        command_bar_add_history(bar, true);
     }
 
     claude_request_cleanup(&bar->request);
-    CMDBAR_LOG("=== command_bar_submit END ===");
+    CMDBAR_LOG("=== command_bar_finish_request END ===");
+}
+
+// Resolve the input without Claude if it is a command known locally; false to ask Claude
+static bool command_bar_submit_local(CommandBar *bar)
+{
+    IntentMatch *match = bar->intents ? malloc(sizeof(IntentMatch)) : NULL;
+    if (!match || !intent_match(bar->intents, bar->input, bar->executor ? bar->executor->current_dir : NULL, match)) {
+        free(match);
+        return false;
+    }
+    CMDBAR_LOG("Resolved locally: kind=%d confidence=%.2f", match->kind, match->confidence);
+
+    if (match->kind == INTENT_TOOLS) {
+        // Learned calls are confirmed like Claude's
+        command_bar_begin_confirmation(bar, false);
+        for (int i = 0; i < match->call_count; i++) {
+            char id[64];
+            snprintf(id, sizeof(id), "local_%d", i);
+            command_bar_add_operation(bar, match->calls[i].name, id, match->calls[i].input_json);
+        }
+        bar->state = CMD_STATE_CONFIRMING;
+    } else {
+        if (match->kind == INTENT_COMMAND) {
+            snprintf(bar->pending_command, sizeof(bar->pending_command), "%s", match->command_id);
+            snprintf(bar->result_message, sizeof(bar->result_message), "Done");
+        } else {
+            snprintf(bar->pending_path, sizeof(bar->pending_path), "%s", match->path);
+            const char *name = strrchr(match->path, '/');
+            snprintf(bar->result_message, sizeof(bar->result_message), "Opened %s",
+                     name && name[1] ? name + 1 : match->path);
+        }
+        bar->state = CMD_STATE_RESULT;
+        bar->result_timer = RESULT_DISPLAY_TIME;
+        command_bar_add_history(bar, true);
+        bar->input[0] = '\0';
+        bar->cursor_pos = 0;
+    }
+    free(match);
+    return true;
+}
+
+// Remember what the confirmed operations were asked for by, once they all succeeded
+static void command_bar_learn(CommandBar *bar)
+{
+    int count = bar->confirmation.operation_count;
+    IntentCall *calls = calloc((size_t)count, sizeof(IntentCall));
+    if (!calls) return;
+    for (int i = 0; i < count; i++) {
+        snprintf(calls[i].name, sizeof(calls[i].name), "%s", bar->confirmation.operations[i].tool_name);
+        snprintf(calls[i].input_json, sizeof(calls[i].input_json), "%s", bar->confirmation.operations[i].input_json);
+    }
+    if (intent_matcher_learn(bar->intents, bar->input, bar->executor ? bar->executor->current_dir : NULL,
+                             calls, count) && bar->intent_path[0]) {
+        intent_matcher_save(bar->intents, bar->intent_path);
+    }
+    free(calls);
+}
+
+void command_bar_submit(CommandBar *bar)
+{
+    CMDBAR_LOG("=== command_bar_submit START ===");
+
+    if (!bar || strlen(bar->input) == 0) {
+        CMDBAR_LOG("ERROR: NULL bar or empty input");
+        return;
+    }
+
+    CMDBAR_LOG("User input: %s", bar->input);
+    CMDBAR_LOG("Gemini client configured: %s", bar->gemini ? "YES" : "NO");
+
+    // Frequent commands resolve in milliseconds, without a round trip
+    if (command_bar_submit_local(bar)) {
+        CMDBAR_LOG("=== command_bar_submit END (local) ===");
+        return;
+    }
+
+    // Check auth
+    if (!bar->claude || !auth_is_ready(&bar->auth)) {
+        CMDBAR_LOG("ERROR: Claude API not ready");
+        strncpy(bar->result_message, "API key not configured. Set CLAUDE_API_KEY environment variable.", sizeof(bar->result_message) - 1);
+        bar->state = CMD_STATE_ERROR;
+        bar->result_timer = RESULT_DISPLAY_TIME;
+        return;
+    }
+
+    bar->state = CMD_STATE_LOADING;
+
+    // Build request
+    claude_request_init(&bar->request);
+    claude_request_set_feature(&bar->request, CLAUDE_FEATURE_AGENT);
+    claude_request_set_system_prompt(&bar->request, command_bar_get_system_prompt(bar->executor ? bar->executor->current_dir : NULL));
+    claude_request_add_user_message(&bar->request, bar->input);
+
+    // Add tools; their definitions are the same on every command, so cache them
+    cJSON *tools = tool_registry_to_json(bar->registry);
+    claude_request_set_tools(&bar->request, tools);
+    claude_request_set_cache_prompt(&bar->request, true);
+
+    CMDBAR_LOG("Sending request to Claude...");
+
+    // Send request in the background; command_bar_update finishes it
+    claude_response_cleanup(&bar->response);
+    claude_response_init(&bar->response);
+    bar->stream_text[0] = '\0';
+    bar->stream_tool[0] = '\0';
+    bar->request_done = false;
+    bar->request_ok = false;
+    bar->request_cancelled = false;
+    progress_indicator_set_message(&bar->ai_progress, "Thinking...");
+
+    if (pthread_create(&bar->request_thread, NULL, command_bar_request_thread, bar) != 0) {
+        CMDBAR_LOG("ERROR: Could not start request thread");
+        if (tools) cJSON_Delete(tools);
+        bar->request.tools = NULL;
+        strncpy(bar->result_message, "Error: Could not start request", sizeof(bar->result_message) - 1);
+        bar->state = CMD_STATE_ERROR;
+        bar->result_timer = RESULT_DISPLAY_TIME;
+        claude_request_cleanup(&bar->request);
+        return;
+    }
+    bar->request_active = true;
+    CMDBAR_LOG("=== command_bar_submit END (request in flight) ===");
+}
+
+static void command_bar_poll_request(CommandBar *bar)
+{
+    if (!bar->request_active) return;
+
+    pthread_mutex_lock(&bar->stream_mutex);
+    bool done = bar->request_done;
+    bool success = bar->request_ok;
+    if (bar->stream_tool[0] != '\0') {
+        char message[128];
+        snprintf(message, sizeof(message), "Preparing %s...", bar->stream_tool);
+        progress_indicator_set_message(&bar->ai_progress, message);
+    }
+    pthread_mutex_unlock(&bar->stream_mutex);
+
+    if (!done) return;
+
+    pthread_join(bar->request_thread, NULL);
+    bar->request_active = false;
+    command_bar_finish_request(bar, success);
 }
 
 void command_bar_confirm(CommandBar *bar)
@@ -466,11 +682,19 @@ void command_bar_confirm(CommandBar *bar)
     char results[2048] = "";
     size_t offset = 0;
 
+    // Independent reads among the operations run side by side; mutations keep their order
+    ToolCall calls[CONFIRMATION_MAX_OPERATIONS];
     for (int i = 0; i < bar->confirmation.operation_count; i++) {
         PendingOperation *op = &bar->confirmation.operations[i];
         CMDBAR_LOG("Executing operation %d: tool=%s", i, op->tool_name);
+        calls[i].tool_name = op->tool_name;
+        calls[i].input_json = op->input_json;
+        tool_result_init(&calls[i].result);
+    }
+    tool_executor_execute_batch(bar->executor, calls, bar->confirmation.operation_count);
 
-        ToolResult result = tool_executor_confirm(bar->executor, op);
+    for (int i = 0; i < bar->confirmation.operation_count; i++) {
+        ToolResult result = calls[i].result;
 
         CMDBAR_LOG("Operation %d result: success=%d", i, result.success);
         if (result.success) {
@@ -498,20 +722,17 @@ void command_bar_confirm(CommandBar *bar)
     bar->state = CMD_STATE_RESULT;
     bar->result_timer = RESULT_DISPLAY_TIME;
 
+    if (bar->learn_on_confirm && success_count == bar->confirmation.operation_count) {
+        command_bar_learn(bar);
+    }
+
     // Signal that directory needs to be refreshed to show new/modified files
     if (success_count > 0) {
         bar->needs_directory_refresh = true;
         CMDBAR_LOG("Directory refresh flagged");
     }
 
-    // Add to history
-    if (bar->history_count < COMMAND_BAR_MAX_HISTORY) {
-        memmove(&bar->history[1], &bar->history[0], sizeof(CommandHistoryEntry) * (size_t)bar->history_count);
-        strncpy(bar->history[0].input, bar->input, COMMAND_BAR_MAX_INPUT - 1);
-        strncpy(bar->history[0].response, bar->result_message, sizeof(bar->history[0].response) - 1);
-        bar->history[0].success = success_count == bar->confirmation.operation_count;
-        bar->history_count++;
-    }
+    command_bar_add_history(bar, success_count == bar->confirmation.operation_count);
 
     bar->input[0] = '\0';
     bar->cursor_pos = 0;
@@ -551,6 +772,34 @@ void command_bar_set_visual_search(CommandBar *bar, struct VisualSearch *search)
     tool_executor_set_visual_search(bar->executor, search);
 }
 
+void command_bar_set_path_index(CommandBar *bar, struct PathIndex *index, struct Indexer *indexer)
+{
+    if (!bar || !bar->executor) return;
+    tool_executor_set_path_index(bar->executor, index, indexer);
+}
+
+void command_bar_set_operation_queue(CommandBar *bar, struct OperationQueue *queue)
+{
+    if (!bar || !bar->executor) return;
+    tool_executor_set_operation_queue(bar->executor, queue);
+}
+
+void command_bar_set_result_budget(CommandBar *bar, int tokens)
+{
+    if (!bar || !bar->executor) return;
+    tool_executor_set_result_budget(bar->executor, tokens > 0 ? tokens : TOOL_RESULT_NO_BUDGET);
+}
+
+void command_bar_set_intents(CommandBar *bar, const char *cache_path, struct EmbeddingEngine *engine)
+{
+    if (!bar || !bar->intents) return;
+    if (cache_path) {
+        snprintf(bar->intent_path, sizeof(bar->intent_path), "%s", cache_path);
+        intent_matcher_load(bar->intents, cache_path);
+    }
+    intent_matcher_set_engine(bar->intents, engine);
+}
+
 void command_bar_draw(CommandBar *bar, int window_width, int window_height)
 {
     if (!bar || !bar->visible) return;
@@ -627,10 +876,28 @@ void command_bar_draw(CommandBar *bar, int window_width, int window_height)
             spinner_color.a = (unsigned char)(spinner_color.a * alpha);
             progress_indicator_draw_spinner(&bar->ai_progress, spinner_cx, spinner_cy, 10, spinner_color);
 
-            // Draw message to the right of spinner
+            // Draw message to the right of spinner: the answer's latest line as it
+            // streams in, trimmed from the left to fit
+            char streamed[sizeof(bar->stream_text)];
+            pthread_mutex_lock(&bar->stream_mutex);
+            strcpy(streamed, bar->stream_text);
+            pthread_mutex_unlock(&bar->stream_mutex);
+
+            const char *message = bar->ai_progress.message;
             Color text_color = theme->textSecondary;
+            if (streamed[0] != '\0') {
+                char *end = streamed + strlen(streamed);
+                while (end > streamed && (end[-1] == '\n' || end[-1] == ' ')) *--end = '\0';
+                char *line = strrchr(streamed, '\n');
+                message = line ? line + 1 : streamed;
+                int max_width = bar_width - 70;
+                while (*message && MeasureTextCustom(message, CMDBAR_FONT_SIZE) > max_width) {
+                    do message++; while ((*message & 0xC0) == 0x80);
+                }
+                text_color = theme->textPrimary;
+            }
             text_color.a = (unsigned char)(text_color.a * alpha);
-            DrawTextCustom(bar->ai_progress.message, bar_x + 55,
+            DrawTextCustom(message, bar_x + 55,
                            bar_y + (COMMAND_BAR_HEIGHT - CMDBAR_FONT_SIZE) / 2,
                            CMDBAR_FONT_SIZE, text_color);
             break;
@@ -699,3 +966,19 @@ bool command_bar_needs_refresh(CommandBar *bar)
     }
     return needs_refresh;
 }
+
+bool command_bar_take_command(CommandBar *bar, char *command_id, size_t size)
+{
+    if (!bar || !bar->pending_command[0]) return false;
+    snprintf(command_id, size, "%s", bar->pending_command);
+    bar->pending_command[0] = '\0';
+    return true;
+}
+
+bool command_bar_take_path(CommandBar *bar, char *path, size_t size)
+{
+    if (!bar || !bar->pending_path[0]) return false;
+    snprintf(path, size, "%s", bar->pending_path);
+    bar->pending_path[0] = '\0';
+    return true;
+}
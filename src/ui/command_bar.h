@@ -7,12 +7,19 @@
 #include "../tools/tool_registry.h"
 #include "../tools/tool_executor.h"
 #include "progress_indicator.h"
+#include <pthread.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 // Forward declarations for AI modules
 struct SemanticSearch;
 struct VisualSearch;
 struct GeminiClient;
+struct PathIndex;
+struct Indexer;
+struct OperationQueue;
+struct IntentMatcher;
+struct EmbeddingEngine;
 
 #define COMMAND_BAR_MAX_INPUT 1024
 #define COMMAND_BAR_MAX_HISTORY 32
@@ -65,12 +72,29 @@ typedef struct CommandBar {
     ToolRegistry *registry;
     ToolExecutor *executor;
 
-    // Current request/response
+    // Current request/response (owned by request_thread while request_active)
     ClaudeMessageRequest request;
     ClaudeMessageResponse response;
 
+    // Request streamed on a background thread, so the bar keeps drawing meanwhile
+    pthread_t request_thread;
+    bool request_active;            // Thread started and not yet joined
+    pthread_mutex_t stream_mutex;   // Guards the fields below, written by the thread
+    char stream_text[1024];         // Answer text received so far
+    char stream_tool[64];           // Last tool Claude asked for
+    bool request_done;
+    bool request_ok;
+    bool request_cancelled;
+
     // Confirmation
     ConfirmationState confirmation;
+    bool learn_on_confirm;          // Operations came from Claude: remember them once they all succeed
+
+    // Local intents: commands resolved without Claude
+    struct IntentMatcher *intents;
+    char intent_path[1024];         // Where learned commands are saved ("" for nowhere)
+    char pending_command[64];       // Palette command for the app to run
+    char pending_path[1024];        // Folder for the app to open
 
     // Result display
     char result_message[1024];
@@ -131,6 +155,19 @@ void command_bar_set_current_dir(CommandBar *bar, const char *path);
 void command_bar_set_semantic_search(CommandBar *bar, struct SemanticSearch *search);
 void command_bar_set_visual_search(CommandBar *bar, struct VisualSearch *search);
 
+// Set the filename index the file_search tool answers from under watched folders
+void command_bar_set_path_index(CommandBar *bar, struct PathIndex *index, struct Indexer *indexer);
+
+// Set the queue bulk file operations run on
+void command_bar_set_operation_queue(CommandBar *bar, struct OperationQueue *queue);
+
+// Set the rough token cap on one list tool result (0: no cap)
+void command_bar_set_result_budget(CommandBar *bar, int tokens);
+
+// Resolve commands locally first: learned ones are read from and saved to cache_path,
+// and compared by meaning with engine (may be NULL) once its model is loaded
+void command_bar_set_intents(CommandBar *bar, const char *cache_path, struct EmbeddingEngine *engine);
+
 // Load Gemini authentication and set up image generation client
 bool command_bar_load_gemini_auth(CommandBar *bar, const char *config_path);
 
@@ -149,4 +186,9 @@ const char *command_bar_get_system_prompt(const char *current_dir);
 // Check if directory refresh is needed and clear the flag
 bool command_bar_needs_refresh(CommandBar *bar);
 
+// Palette command or folder the bar resolved locally, for the app to act on; each is
+// returned once
+bool command_bar_take_command(CommandBar *bar, char *command_id, size_t size);
+bool command_bar_take_path(CommandBar *bar, char *path, size_t size);
+
 #endif // COMMAND_BAR_H
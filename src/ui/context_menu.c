@@ -2,8 +2,11 @@
 #include "../app.h"
 #include "../utils/theme.h"
 #include "../utils/font.h"
+#include "../utils/file_type.h"
 #include "../core/operations.h"
+#include "../core/archive.h"
 #include "../core/filesystem.h"
+#include "../api/image_upload.h"
 #include "raylib.h"
 
 #include <string.h>
@@ -28,64 +31,6 @@ static inline void safe_strcpy(char *dest, const char *src, size_t dest_size)
     }
 }
 
-// Case-insensitive extension comparison helper
-static bool ext_matches(const char *ext, const char *target)
-{
-    if (!ext || !target) return false;
-    while (*ext && *target) {
-        if (tolower((unsigned char)*ext) != tolower((unsigned char)*target)) {
-            return false;
-        }
-        ext++;
-        target++;
-    }
-    return *ext == '\0' && *target == '\0';
-}
-
-// Check if file is an image (supports AI image editing)
-static bool is_image_file(const char *extension)
-{
-    if (!extension || extension[0] == '\0') return false;
-    // Skip leading dot if present
-    if (extension[0] == '.') extension++;
-
-    return ext_matches(extension, "png") ||
-           ext_matches(extension, "jpg") ||
-           ext_matches(extension, "jpeg") ||
-           ext_matches(extension, "gif") ||
-           ext_matches(extension, "bmp") ||
-           ext_matches(extension, "webp");
-}
-
-// Check if file is a text file (supports AI summarization and editing)
-static bool is_text_file(const char *extension)
-{
-    if (!extension || extension[0] == '\0') return false;
-    // Skip leading dot if present
-    if (extension[0] == '.') extension++;
-
-    // Plain text
-    if (ext_matches(extension, "txt") ||
-        ext_matches(extension, "md") ||
-        ext_matches(extension, "log")) return true;
-
-    // Data formats
-    if (ext_matches(extension, "json") ||
-        ext_matches(extension, "xml") ||
-        ext_matches(extension, "csv")) return true;
-
-    // Code files
-    if (ext_matches(extension, "c") ||
-        ext_matches(extension, "h") ||
-        ext_matches(extension, "py") ||
-        ext_matches(extension, "js") ||
-        ext_matches(extension, "ts") ||
-        ext_matches(extension, "html") ||
-        ext_matches(extension, "css")) return true;
-
-    return false;
-}
-
 // Menu bounds for position adjustment
 typedef struct {
     int x;
@@ -233,8 +178,8 @@ void context_menu_show(ContextMenuState *menu, struct App *app,
     } else if (app->selection.count > 1) {
         // Multi-select context
         menu->type = CONTEXT_MULTI_SELECT;
-        safe_strcpy(menu->target_path, app->directory.entries[target_index].path,
-                sizeof(menu->target_path));
+        directory_entry_path(&app->directory, &app->directory.entries[target_index],
+                             menu->target_path, sizeof(menu->target_path));
 
         add_menu_item(menu, "Copy", "Cmd+C", true, false, action_copy);
         add_menu_item(menu, "Cut", "Cmd+X", true, false, action_cut);
@@ -244,7 +189,7 @@ void context_menu_show(ContextMenuState *menu, struct App *app,
 
     } else {
         FileEntry *entry = &app->directory.entries[target_index];
-        safe_strcpy(menu->target_path, entry->path, sizeof(menu->target_path));
+        directory_entry_path(&app->directory, entry, menu->target_path, sizeof(menu->target_path));
 
         if (entry->is_directory) {
             // Folder context
@@ -273,8 +218,8 @@ void context_menu_show(ContextMenuState *menu, struct App *app,
             add_menu_item(menu, "Move to Trash", "Cmd+Del", true, true, action_trash);
 
             // AI actions based on file type
-            bool is_image = is_image_file(entry->extension);
-            bool is_text = is_text_file(entry->extension);
+            bool is_image = file_type_has_trait(entry->file_type, FILE_TRAIT_RASTER);
+            bool is_text = file_type_is_text(entry->file_type);
 
             if (is_image) {
                 add_menu_item(menu, "Edit Image with AI", "", true, true, action_edit_image_ai);
@@ -468,32 +413,13 @@ void context_menu_draw(struct App *app)
 // Action Callbacks (only included in non-test builds)
 // ============================================================
 
-// Helper to collect paths from selection or context menu target
-static int collect_selected_paths(struct App *app, const char *paths[], int max_paths)
-{
-    int path_count = 0;
-
-    if (app->selection.count > 0) {
-        for (int i = 0; i < app->selection.count && path_count < max_paths; i++) {
-            int idx = app->selection.indices[i];
-            if (idx >= 0 && idx < app->directory.count) {
-                paths[path_count++] = app->directory.entries[idx].path;
-            }
-        }
-    } else if (app->context_menu.target_index >= 0) {
-        paths[path_count++] = app->context_menu.target_path;
-    }
-
-    return path_count;
-}
-
 static void action_open(struct App *app)
 {
     ContextMenuState *menu = &app->context_menu;
     if (menu->target_index >= 0 && menu->target_index < app->directory.count) {
         FileEntry *entry = &app->directory.entries[menu->target_index];
-        if (entry->is_directory) {
-            // Navigate into directory
+        if (directory_entry_enterable(&app->directory, entry)) {
+            // Navigate into directory (or archive)
             directory_enter(&app->directory, menu->target_index);
             app->selected_index = 0;
             app->scroll_offset = 0;
@@ -501,9 +427,15 @@ static void action_open(struct App *app)
             history_push(&app->history, app->directory.current_path);
             breadcrumb_update(&app->breadcrumb, app->directory.current_path);
         } else {
-            // Open file with default application (macOS)
+            // Open file with default application (macOS); a member of an archive is
+            // opened from a copy on disk
+            char local[PATH_MAX_LEN];
+            const char *target = menu->target_path;
+            if (archive_member_copy(target, UINT64_MAX, local, sizeof(local))) {
+                target = local;
+            }
             char cmd[4200];
-            snprintf(cmd, sizeof(cmd), "open \"%s\"", entry->path);
+            snprintf(cmd, sizeof(cmd), "open \"%s\"", target);
             system(cmd);
         }
     }
@@ -515,26 +447,28 @@ static void action_open_new_tab(struct App *app)
     if (menu->target_index >= 0 && menu->target_index < app->directory.count) {
         FileEntry *entry = &app->directory.entries[menu->target_index];
         if (entry->is_directory) {
-            tabs_new(&app->tabs, entry->path);
+            tabs_new(&app->tabs, menu->target_path);
         }
     }
 }
 
 static void action_copy(struct App *app)
 {
-    const char *paths[MAX_SELECTION];
-    int count = collect_selected_paths(app, paths, MAX_SELECTION);
-    if (count > 0) {
-        clipboard_copy(&app->clipboard, paths, count);
+    if (app->selection.count > 0) {
+        app_clipboard_take_selection(app, OP_COPY);
+    } else if (app->context_menu.target_index >= 0) {
+        const char *paths[] = { app->context_menu.target_path };
+        clipboard_copy(&app->clipboard, paths, 1);
     }
 }
 
 static void action_cut(struct App *app)
 {
-    const char *paths[MAX_SELECTION];
-    int count = collect_selected_paths(app, paths, MAX_SELECTION);
-    if (count > 0) {
-        clipboard_cut(&app->clipboard, paths, count);
+    if (app->selection.count > 0) {
+        app_clipboard_take_selection(app, OP_CUT);
+    } else if (app->context_menu.target_index >= 0) {
+        const char *paths[] = { app->context_menu.target_path };
+        clipboard_cut(&app->clipboard, paths, 1);
     }
 }
 
@@ -542,7 +476,7 @@ static void action_paste(struct App *app)
 {
     clipboard_sync_from_system(&app->clipboard);
     if (clipboard_has_items(&app->clipboard)) {
-        clipboard_paste(&app->clipboard, app->directory.current_path);
+        operation_queue_paste(&app->op_queue, &app->clipboard, app->directory.current_path);
         directory_read(&app->directory, app->directory.current_path);
         selection_clear(&app->selection);
     }
@@ -551,11 +485,11 @@ static void action_paste(struct App *app)
 static void action_duplicate(struct App *app)
 {
     if (app->selection.count > 0) {
-        for (int i = 0; i < app->selection.count; i++) {
-            int idx = app->selection.indices[i];
-            if (idx >= 0 && idx < app->directory.count) {
-                file_duplicate(app->directory.entries[idx].path);
-            }
+        for (int idx = selection_next(&app->selection, 0); idx >= 0 && idx < app->directory.count;
+             idx = selection_next(&app->selection, idx + 1)) {
+            char path[PATH_MAX_LEN];
+            file_duplicate(directory_entry_path(&app->directory, &app->directory.entries[idx],
+                                                path, sizeof(path)));
         }
     } else if (app->context_menu.target_index >= 0) {
         file_duplicate(app->context_menu.target_path);
@@ -572,7 +506,7 @@ static void action_rename(struct App *app)
         app->rename_mode = true;
         app->rename_index = menu->target_index;
         FileEntry *entry = &app->directory.entries[menu->target_index];
-        safe_strcpy(app->rename_buffer, entry->name, NAME_MAX_LEN);
+        safe_strcpy(app->rename_buffer, directory_entry_name(&app->directory, entry), NAME_MAX_LEN);
         app->rename_cursor = (int)strlen(app->rename_buffer);
     }
 }
@@ -581,15 +515,10 @@ static void action_rename(struct App *app)
 static void perform_trash_confirmed(struct App *app)
 {
     if (app->selection.count > 0) {
-        for (int i = 0; i < app->selection.count; i++) {
-            int idx = app->selection.indices[i];
-            if (idx >= 0 && idx < app->directory.count) {
-                file_delete(app->directory.entries[idx].path);
-            }
-        }
-    } else if (app->context_menu.target_index >= 0 &&
-               app->context_menu.target_path[0] != '\0') {
-        file_delete(app->context_menu.target_path);
+        app_trash_selection(app);
+    } else if (app->context_menu.target_index >= 0 && app->context_menu.target_path[0] != '\0') {
+        const char *paths[] = { app->context_menu.target_path };
+        file_delete_batch(paths, 1, NULL);
     }
     directory_read(&app->directory, app->directory.current_path);
     selection_clear(&app->selection);
@@ -605,7 +534,8 @@ static void action_trash(struct App *app)
         const char *name = "";
         if (app->context_menu.target_index >= 0 &&
             app->context_menu.target_index < app->directory.count) {
-            name = app->directory.entries[app->context_menu.target_index].name;
+            name = directory_entry_name(&app->directory,
+                                        &app->directory.entries[app->context_menu.target_index]);
         }
         snprintf(message, sizeof(message), "Move \"%s\" to Trash?", name);
     } else {
@@ -640,10 +570,11 @@ static void action_get_info(struct App *app)
         struct tm *tm_info = localtime(&entry->modified);
         strftime(date_str, sizeof(date_str), "%Y-%m-%d %H:%M", tm_info);
 
+        const char *ext = directory_entry_extension(&app->directory, entry);
         snprintf(message, sizeof(message),
                 "Name: %s\nSize: %s\nModified: %s\nType: %s",
-                entry->name, size_str, date_str,
-                entry->is_directory ? "Folder" : (entry->extension[0] ? entry->extension : "File"));
+                directory_entry_name(&app->directory, entry), size_str, date_str,
+                entry->is_directory ? "Folder" : (ext[0] ? ext : "File"));
 
         dialog_info(&app->dialog, "Info", message);
     } else {
@@ -678,10 +609,11 @@ static void action_new_folder(struct App *app)
     OperationResult result = file_create_directory(app->directory.current_path, new_name);
     if (result == OP_SUCCESS) {
         directory_read(&app->directory, app->directory.current_path);
+        directory_stream_wait(&app->directory);  // New folder may be past the first batch
 
         // Find and select the new folder, enter rename mode
         for (int i = 0; i < app->directory.count; i++) {
-            if (strcmp(app->directory.entries[i].name, new_name) == 0) {
+            if (strcmp(directory_entry_name(&app->directory, &app->directory.entries[i]), new_name) == 0) {
                 app->selected_index = i;
                 selection_clear(&app->selection);
 
@@ -720,6 +652,9 @@ static void action_edit_image_ai(struct App *app)
     app->preview.edit_buffer[0] = '\0';
     app->preview.edit_cursor = 0;
     app->preview.edit_error[0] = '\0';
+
+    // Downsize the image for upload while the prompt is typed
+    image_upload_prefetch(app->preview.file_path);
 }
 
 static void action_summarize(struct App *app)
@@ -731,12 +666,13 @@ static void action_summarize(struct App *app)
 
     // Start async summarization
     // The summary will be displayed in a dialog when complete
-    safe_strcpy(app->async_summary_request.file_path, menu->target_path,
-                sizeof(app->async_summary_request.file_path));
-    app->async_summary_request.from_context_menu = true;  // Flag to show dialog on completion
+    safe_strcpy(app->menu_summary_request.file_path, menu->target_path,
+                sizeof(app->menu_summary_request.file_path));
+    app->menu_summary_request.from_context_menu = true;  // Flag to show dialog on completion
 
-    summarize_async_start(&app->async_summary_request, &app->summary_thread,
-                          menu->target_path, &app->summary_config, app->summary_cache);
+    summarize_async_start(app->summary_executor, &app->menu_summary_request,
+                          menu->target_path, &app->summary_config, app->summary_cache,
+                          SUMM_PRIORITY_NORMAL);
 }
 
 static void action_edit_text_ai(struct App *app)
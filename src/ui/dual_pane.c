@@ -1,10 +1,13 @@
 #include "dual_pane.h"
 #include "tabs.h"
 #include "breadcrumb.h"
+#include "dialog.h"
 #include "../app.h"
 #include "../core/operations.h"
+#include "../core/operation_queue.h"
 #include "../utils/theme.h"
 #include "../utils/font.h"
+#include "../utils/trace.h"
 #include "raylib.h"
 
 // Use constants from headers to avoid linker issues in test builds
@@ -14,7 +17,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
 
 // Layout constants
 #define PANE_DIVIDER_WIDTH 4
@@ -50,6 +52,9 @@ void dual_pane_init(DualPaneState *state)
     state->active_pane = PANE_LEFT;
     state->sync_scroll = false;
     state->compare_mode = false;
+    state->compare_content = false;
+    state->comparer = NULL;
+    state->compare_match_left = NULL;
     state->compare_results_left = NULL;
     state->compare_results_right = NULL;
     state->compare_count_left = 0;
@@ -61,6 +66,11 @@ void dual_pane_free(DualPaneState *state)
     pane_free(&state->left);
     pane_free(&state->right);
 
+    dir_compare_destroy(state->comparer);
+    state->comparer = NULL;
+    free(state->compare_match_left);
+    state->compare_match_left = NULL;
+
     if (state->compare_results_left) {
         free(state->compare_results_left);
         state->compare_results_left = NULL;
@@ -84,7 +94,7 @@ void dual_pane_toggle(struct App *app)
         if (state->right.current_path[0] == '\0') {
             strncpy(state->right.current_path, state->left.current_path, PATH_MAX_LEN - 1);
             state->right.current_path[PATH_MAX_LEN - 1] = '\0';
-            directory_read(&state->right.directory, state->right.current_path);
+            directory_read_cached(&state->right.directory, state->right.current_path, &app->perf.dir_cache);
             state->right.selected_index = 0;
             state->right.scroll_offset = 0;
         }
@@ -127,7 +137,7 @@ bool dual_pane_navigate_to(struct App *app, const char *path)
     DualPaneState *state = &app->dual_pane;
     PaneState *pane = dual_pane_get_active_pane(state);
 
-    if (directory_read(&pane->directory, path)) {
+    if (directory_read_cached(&pane->directory, path, &app->perf.dir_cache)) {
         strncpy(pane->current_path, path, PATH_MAX_LEN - 1);
         pane->current_path[PATH_MAX_LEN - 1] = '\0';
         pane->selected_index = 0;
@@ -136,6 +146,7 @@ bool dual_pane_navigate_to(struct App *app, const char *path)
         // Clear comparison results when navigating
         if (state->compare_mode) {
             state->compare_mode = false;
+            dual_pane_stop_comparison(state);
         }
 
         return true;
@@ -153,7 +164,9 @@ bool dual_pane_enter_directory(struct App *app)
     FileEntry *entry = &pane->directory.entries[pane->selected_index];
     if (!entry->is_directory) return false;
 
-    return dual_pane_navigate_to(app, entry->path);
+    char path[PATH_MAX_LEN];
+    directory_entry_path(&pane->directory, entry, path, sizeof(path));
+    return dual_pane_navigate_to(app, path);
 }
 
 bool dual_pane_go_parent(struct App *app)
@@ -188,10 +201,15 @@ void dual_pane_copy_to_other(struct App *app)
     if (active->directory.count == 0) return;
 
     FileEntry *entry = &active->directory.entries[active->selected_index];
-    file_copy(entry->path, other->current_path);
+    char path[PATH_MAX_LEN];
+    directory_entry_path(&active->directory, entry, path, sizeof(path));
+    file_copy(path, other->current_path);
 
     // Refresh the other pane
     directory_read(&other->directory, other->current_path);
+    if (state->compare_mode) {
+        dual_pane_run_comparison(app);
+    }
 }
 
 void dual_pane_move_to_other(struct App *app)
@@ -203,7 +221,9 @@ void dual_pane_move_to_other(struct App *app)
     if (active->directory.count == 0) return;
 
     FileEntry *entry = &active->directory.entries[active->selected_index];
-    file_move(entry->path, other->current_path);
+    char path[PATH_MAX_LEN];
+    directory_entry_path(&active->directory, entry, path, sizeof(path));
+    file_move(path, other->current_path);
 
     // Refresh both panes
     directory_read(&active->directory, active->current_path);
@@ -213,6 +233,9 @@ void dual_pane_move_to_other(struct App *app)
     if (active->selected_index >= active->directory.count) {
         active->selected_index = active->directory.count > 0 ? active->directory.count - 1 : 0;
     }
+    if (state->compare_mode) {
+        dual_pane_run_comparison(app);
+    }
 }
 
 void dual_pane_toggle_sync_scroll(DualPaneState *state)
@@ -227,106 +250,158 @@ void dual_pane_toggle_compare(struct App *app)
 
     if (state->compare_mode) {
         dual_pane_run_comparison(app);
+    } else {
+        dual_pane_stop_comparison(state);
     }
 }
 
-// Compare two files by content (using file size and modification time for quick comparison)
-static CompareResult compare_files(const char *path1, const char *path2)
+void dual_pane_toggle_compare_content(struct App *app)
 {
-    struct stat st1, st2;
-
-    if (stat(path1, &st1) != 0) return COMPARE_RIGHT_ONLY;
-    if (stat(path2, &st2) != 0) return COMPARE_LEFT_ONLY;
+    DualPaneState *state = &app->dual_pane;
+    state->compare_content = !state->compare_content;
 
-    if (S_ISDIR(st1.st_mode) || S_ISDIR(st2.st_mode)) {
-        return COMPARE_DIR;
+    // Turning content checks on is a request to compare
+    if (state->compare_content) {
+        state->compare_mode = true;
     }
-
-    // Compare by size and mtime (quick comparison)
-    if (st1.st_size == st2.st_size && st1.st_mtime == st2.st_mtime) {
-        return COMPARE_SAME;
+    if (state->compare_mode) {
+        dual_pane_run_comparison(app);
     }
+}
 
-    return COMPARE_DIFFERENT;
+// Helper: Free comparison results
+static void free_compare_results(DualPaneState *state)
+{
+    free(state->compare_results_left);
+    free(state->compare_results_right);
+    free(state->compare_match_left);
+    state->compare_results_left = NULL;
+    state->compare_results_right = NULL;
+    state->compare_match_left = NULL;
+    state->compare_count_left = 0;
+    state->compare_count_right = 0;
 }
 
 void dual_pane_run_comparison(struct App *app)
 {
     DualPaneState *state = &app->dual_pane;
+    DirectoryState *left_dir = &state->left.directory;
+    DirectoryState *right_dir = &state->right.directory;
 
-    // Free previous comparison results
-    if (state->compare_results_left) {
-        free(state->compare_results_left);
-        state->compare_results_left = NULL;
-    }
-    if (state->compare_results_right) {
-        free(state->compare_results_right);
-        state->compare_results_right = NULL;
+    free_compare_results(state);
+
+    // One extra element keeps empty listings from allocating zero bytes
+    state->compare_results_left = malloc((left_dir->count + 1) * sizeof(CompareResult));
+    state->compare_results_right = malloc((right_dir->count + 1) * sizeof(CompareResult));
+    state->compare_match_left = malloc((left_dir->count + 1) * sizeof(int));
+    if (!state->compare_results_left || !state->compare_results_right || !state->compare_match_left) {
+        free_compare_results(state);
+        return;
     }
+    state->compare_count_left = left_dir->count;
+    state->compare_count_right = right_dir->count;
 
-    // Allocate new results
-    if (state->left.directory.count > 0) {
-        state->compare_results_left = malloc(state->left.directory.count * sizeof(CompareResult));
-        if (!state->compare_results_left) {
-            state->compare_count_left = 0;
-            return;
-        }
-        state->compare_count_left = state->left.directory.count;
-    }
-    if (state->right.directory.count > 0) {
-        state->compare_results_right = malloc(state->right.directory.count * sizeof(CompareResult));
-        if (!state->compare_results_right) {
-            // Clean up left allocation if right fails
-            if (state->compare_results_left) {
-                free(state->compare_results_left);
-                state->compare_results_left = NULL;
-                state->compare_count_left = 0;
-            }
-            state->compare_count_right = 0;
-            return;
-        }
-        state->compare_count_right = state->right.directory.count;
+    // Names matched and files compared from the listings right away
+    dir_compare_listings(left_dir, right_dir, state->compare_content,
+                         state->compare_results_left, state->compare_results_right,
+                         state->compare_match_left);
+
+    // Directories (and same-size files when checking contents) are decided in the background
+    if (!state->comparer) {
+        state->comparer = dir_compare_create();
     }
+    dir_compare_request(state->comparer, left_dir, right_dir, state->compare_results_left,
+                        state->compare_match_left, state->compare_content);
+}
 
-    // Compare left pane entries
-    for (int i = 0; i < state->left.directory.count; i++) {
-        FileEntry *left_entry = &state->left.directory.entries[i];
+void dual_pane_stop_comparison(DualPaneState *state)
+{
+    dir_compare_cancel(state->comparer);
+}
 
-        // Look for matching file in right pane
-        bool found = false;
-        for (int j = 0; j < state->right.directory.count; j++) {
-            FileEntry *right_entry = &state->right.directory.entries[j];
-            if (strcmp(left_entry->name, right_entry->name) == 0) {
-                state->compare_results_left[i] = compare_files(left_entry->path, right_entry->path);
-                found = true;
-                break;
-            }
-        }
+bool dual_pane_is_comparing(DualPaneState *state)
+{
+    return state->enabled && state->compare_mode && dir_compare_is_busy(state->comparer);
+}
 
-        if (!found) {
-            state->compare_results_left[i] = left_entry->is_directory ? COMPARE_DIR : COMPARE_LEFT_ONLY;
+// Helper: Queue the operations that reconcile the inactive pane with the active one.
+// Returns how many were queued
+static int queue_sync(struct App *app, SyncMode mode)
+{
+    DualPaneState *state = &app->dual_pane;
+    bool from_left = state->active_pane == PANE_LEFT;
+    PaneState *source = from_left ? &state->left : &state->right;
+    PaneState *dest = from_left ? &state->right : &state->left;
+    CompareResult *source_results = from_left ? state->compare_results_left : state->compare_results_right;
+    CompareResult *dest_results = from_left ? state->compare_results_right : state->compare_results_left;
+    CompareResult source_only = from_left ? COMPARE_LEFT_ONLY : COMPARE_RIGHT_ONLY;
+    CompareResult dest_only = from_left ? COMPARE_RIGHT_ONLY : COMPARE_LEFT_ONLY;
+    if (!source_results || !dest_results) return 0;
+
+    OperationQueue *queue = &app->op_queue;
+    char source_path[PATH_MAX_LEN];
+    char dest_path[PATH_MAX_LEN];
+    int queued = 0;
+
+    for (int i = 0; i < source->directory.count; i++) {
+        CompareResult result = source_results[i];
+        if (result == COMPARE_SAME) continue;
+
+        const FileEntry *entry = &source->directory.entries[i];
+        const char *name = directory_entry_name(&source->directory, entry);
+        directory_entry_path(&source->directory, entry, source_path, sizeof(source_path));
+        snprintf(dest_path, sizeof(dest_path), "%s/%s", dest->current_path, name);
+
+        // Folders still being compared are decided by the sync itself
+        int id = result == source_only
+            ? operation_queue_copy_to(queue, source_path, dest_path)
+            : operation_queue_sync(queue, source_path, dest_path, mode, state->compare_content);
+        if (id >= 0) queued++;
+    }
+
+    if (mode != SYNC_UPDATE) {
+        for (int j = 0; j < dest->directory.count; j++) {
+            if (dest_results[j] != dest_only) continue;
+
+            const FileEntry *entry = &dest->directory.entries[j];
+            const char *name = directory_entry_name(&dest->directory, entry);
+            directory_entry_path(&dest->directory, entry, dest_path, sizeof(dest_path));
+            snprintf(source_path, sizeof(source_path), "%s/%s", source->current_path, name);
+
+            int id = mode == SYNC_MIRROR
+                ? operation_queue_delete(queue, dest_path)
+                : operation_queue_copy_to(queue, dest_path, source_path);
+            if (id >= 0) queued++;
         }
     }
+    return queued;
+}
 
-    // Compare right pane entries
-    for (int i = 0; i < state->right.directory.count; i++) {
-        FileEntry *right_entry = &state->right.directory.entries[i];
+// Dialog callback: Mirror once the deletions are confirmed
+static void sync_mirror_confirmed(struct App *app)
+{
+    queue_sync(app, SYNC_MIRROR);
+}
 
-        // Look for matching file in left pane
-        bool found = false;
-        for (int j = 0; j < state->left.directory.count; j++) {
-            FileEntry *left_entry = &state->left.directory.entries[j];
-            if (strcmp(right_entry->name, left_entry->name) == 0) {
-                state->compare_results_right[i] = compare_files(left_entry->path, right_entry->path);
-                found = true;
-                break;
-            }
-        }
+void dual_pane_sync(struct App *app, SyncMode mode)
+{
+    DualPaneState *state = &app->dual_pane;
+    if (!state->enabled) return;
 
-        if (!found) {
-            state->compare_results_right[i] = right_entry->is_directory ? COMPARE_DIR : COMPARE_RIGHT_ONLY;
-        }
+    // Plan from fresh results, and show them while the queue works
+    state->compare_mode = true;
+    dual_pane_run_comparison(app);
+
+    if (mode == SYNC_MIRROR) {
+        PaneState *dest = dual_pane_get_inactive_pane(state);
+        char message[PATH_MAX_LEN + 128];
+        snprintf(message, sizeof(message),
+                 "Make \"%s\" match the active pane? Items only in it go to the Trash.", dest->current_path);
+        dialog_confirm(&app->dialog, "Mirror", message, sync_mirror_confirmed);
+        return;
     }
+
+    queue_sync(app, mode);
 }
 
 CompareResult dual_pane_get_compare_result(DualPaneState *state, PaneId pane, int index)
@@ -377,11 +452,24 @@ void dual_pane_handle_input(struct App *app)
     }
 
     // Cmd+= - toggle compare mode
-    if (cmd_down && IsKeyPressed(KEY_EQUAL)) {
+    if (cmd_down && !shift_down && IsKeyPressed(KEY_EQUAL)) {
         dual_pane_toggle_compare(app);
         return;
     }
 
+    // Cmd+Shift+= - toggle comparing file contents
+    if (cmd_down && shift_down && IsKeyPressed(KEY_EQUAL)) {
+        dual_pane_toggle_compare_content(app);
+        return;
+    }
+
+    // F7 - update the other pane, Shift+F7 - mirror into it, Option+F7 - sync both ways
+    if (IsKeyPressed(KEY_F7)) {
+        bool alt_down = IsKeyDown(KEY_LEFT_ALT) || IsKeyDown(KEY_RIGHT_ALT);
+        dual_pane_sync(app, shift_down ? SYNC_MIRROR : alt_down ? SYNC_TWO_WAY : SYNC_UPDATE);
+        return;
+    }
+
     // Cmd+Shift+S - toggle sync scroll
     if (cmd_down && shift_down && IsKeyPressed(KEY_S)) {
         dual_pane_toggle_sync_scroll(state);
@@ -569,17 +657,9 @@ static void draw_pane(struct App *app, PaneState *pane, int x, int y, int width,
         DrawTextCustom(icon, text_x, row_y + (PANE_ROW_HEIGHT - FONT_SIZE_SMALL) / 2, FONT_SIZE_SMALL, icon_color);
         text_x += PANE_ICON_WIDTH;
 
-        // Name
-        char display_name[64];
-        int max_name_chars = (width - PANE_PADDING * 2 - PANE_ICON_WIDTH - 40) / 7;
-        if ((int)strlen(entry->name) > max_name_chars && max_name_chars > 3) {
-            strncpy(display_name, entry->name, max_name_chars - 2);
-            display_name[max_name_chars - 2] = '\0';
-            strcat(display_name, "..");
-        } else {
-            strncpy(display_name, entry->name, sizeof(display_name) - 1);
-            display_name[sizeof(display_name) - 1] = '\0';
-        }
+        // Name, cut before the size column
+        const char *name = directory_entry_name(&pane->directory, entry);
+        int max_name_width = width - PANE_PADDING * 2 - PANE_ICON_WIDTH - 40;
 
         // Color based on compare result if in compare mode
         Color name_color = entry->is_hidden ? g_theme.textSecondary : g_theme.textPrimary;
@@ -587,12 +667,11 @@ static void draw_pane(struct App *app, PaneState *pane, int x, int y, int width,
             name_color = get_compare_color(compare_results[entry_index]);
         }
 
-        DrawTextCustom(display_name, text_x, row_y + (PANE_ROW_HEIGHT - FONT_SIZE_SMALL) / 2, FONT_SIZE_SMALL, name_color);
+        DrawTextFit(name, text_x, row_y + (PANE_ROW_HEIGHT - FONT_SIZE_SMALL) / 2, FONT_SIZE_SMALL, max_name_width, name_color);
 
         // Size for files
         if (!entry->is_directory) {
-            char size_str[16];
-            format_file_size(entry->size, size_str, sizeof(size_str));
+            const char *size_str = format_file_size_cached(entry->size);
             int size_width = MeasureTextCustom(size_str, FONT_SIZE_SMALL);
             DrawTextCustom(size_str, x + width - size_width - PANE_PADDING - 4, row_y + (PANE_ROW_HEIGHT - FONT_SIZE_SMALL) / 2, FONT_SIZE_SMALL, g_theme.textSecondary);
         }
@@ -614,6 +693,7 @@ static void draw_pane(struct App *app, PaneState *pane, int x, int y, int width,
 
 void dual_pane_draw(struct App *app)
 {
+    TRACE_SCOPE("dual_pane_draw");
     DualPaneState *state = &app->dual_pane;
     if (!state->enabled) return;
 
@@ -626,6 +706,12 @@ void dual_pane_draw(struct App *app)
 
     int pane_width = (content_width - PANE_DIVIDER_WIDTH) / 2;
 
+    // Take directories decided in the background since the last frame
+    if (state->compare_mode) {
+        dir_compare_poll(state->comparer, state->compare_results_left, state->compare_count_left,
+                         state->compare_results_right, state->compare_count_right);
+    }
+
     // Draw left pane
     draw_pane(app, &state->left, content_x, content_offset, pane_width, content_height,
               state->active_pane == PANE_LEFT, state->compare_results_left, state->compare_count_left);
@@ -644,8 +730,9 @@ void dual_pane_draw(struct App *app)
         DrawRectangle(content_x, legend_y, content_width, 24, Fade(g_theme.background, 0.9f));
 
         int legend_x = content_x + PANE_PADDING;
-        DrawTextCustom("Compare:", legend_x, legend_y + 4, FONT_SIZE_SMALL, g_theme.textSecondary);
-        legend_x += 60;
+        const char *label = state->compare_content ? "Compare contents:" : "Compare:";
+        DrawTextCustom(label, legend_x, legend_y + 4, FONT_SIZE_SMALL, g_theme.textSecondary);
+        legend_x += MeasureTextCustom(label, FONT_SIZE_SMALL) + 8;
 
         DrawRectangle(legend_x, legend_y + 6, 10, 10, g_theme.textSecondary);
         DrawTextCustom("Same", legend_x + 14, legend_y + 4, FONT_SIZE_SMALL, g_theme.textSecondary);
@@ -657,6 +744,12 @@ void dual_pane_draw(struct App *app)
 
         DrawRectangle(legend_x, legend_y + 6, 10, 10, g_theme.gitUntracked);
         DrawTextCustom("Unique", legend_x + 14, legend_y + 4, FONT_SIZE_SMALL, g_theme.gitUntracked);
+        legend_x += 70;
+
+        if (dir_compare_is_busy(state->comparer)) {
+            DrawRectangle(legend_x, legend_y + 6, 10, 10, g_theme.folder);
+            DrawTextCustom("Comparing...", legend_x + 14, legend_y + 4, FONT_SIZE_SMALL, g_theme.folder);
+        }
     }
 }
 
@@ -671,7 +764,7 @@ void dual_pane_sync_to_app(struct App *app)
     app->scroll_offset = active->scroll_offset;
 
     // Refresh app directory
-    directory_read(&app->directory, app->directory.current_path);
+    directory_read_cached(&app->directory, app->directory.current_path, &app->perf.dir_cache);
 }
 
 void dual_pane_sync_from_app(struct App *app)
@@ -682,7 +775,7 @@ void dual_pane_sync_from_app(struct App *app)
     // Copy app state to active pane
     strncpy(active->current_path, app->directory.current_path, PATH_MAX_LEN - 1);
     active->current_path[PATH_MAX_LEN - 1] = '\0';
-    directory_read(&active->directory, active->current_path);
+    directory_read_cached(&active->directory, active->current_path, &app->perf.dir_cache);
     active->selected_index = app->selected_index;
     active->scroll_offset = app->scroll_offset;
 }
@@ -2,6 +2,8 @@
 #define DUAL_PANE_H
 
 #include "../core/filesystem.h"
+#include "../core/dir_compare.h"
+#include "../core/operations.h"
 #include <stdbool.h>
 
 // Forward declaration
@@ -21,15 +23,6 @@ typedef struct PaneState {
     char current_path[PATH_MAX_LEN];
 } PaneState;
 
-// Directory comparison result for a single file
-typedef enum {
-    COMPARE_SAME,                 // File exists in both with same content
-    COMPARE_DIFFERENT,            // File exists in both but different
-    COMPARE_LEFT_ONLY,            // File only exists in left pane
-    COMPARE_RIGHT_ONLY,           // File only exists in right pane
-    COMPARE_DIR                   // Item is a directory (not compared)
-} CompareResult;
-
 // Dual pane mode state
 typedef struct DualPaneState {
     bool enabled;                 // Whether dual pane mode is active
@@ -38,6 +31,9 @@ typedef struct DualPaneState {
     PaneId active_pane;           // Which pane has focus
     bool sync_scroll;             // Whether to sync scroll between panes
     bool compare_mode;            // Whether to show comparison view
+    bool compare_content;         // Compare same-size files by content instead of mtime
+    DirCompare *comparer;         // Decides directories (and contents) in the background
+    int *compare_match_left;      // Right pane index of each left entry's name, or -1
     CompareResult *compare_results_left;  // Comparison results for left pane
     CompareResult *compare_results_right; // Comparison results for right pane
     int compare_count_left;
@@ -76,9 +72,18 @@ void dual_pane_toggle_sync_scroll(DualPaneState *state);
 
 // Directory comparison
 void dual_pane_toggle_compare(struct App *app);
+void dual_pane_toggle_compare_content(struct App *app);
 void dual_pane_run_comparison(struct App *app);
+void dual_pane_stop_comparison(DualPaneState *state);
+bool dual_pane_is_comparing(DualPaneState *state);
 CompareResult dual_pane_get_compare_result(DualPaneState *state, PaneId pane, int index);
 
+// Folder synchronisation: queue the copies (and, mirroring, deletions) that reconcile the
+// inactive pane with the active one, planned from the comparison results. Entries the
+// comparison found the same are skipped; differing folders are synced on the queue. A
+// mirror that would delete anything asks first
+void dual_pane_sync(struct App *app, SyncMode mode);
+
 // Handle input for dual pane mode
 void dual_pane_handle_input(struct App *app);
 
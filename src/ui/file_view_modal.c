@@ -1,7 +1,9 @@
 #include "file_view_modal.h"
 #include "../app.h"
+#include "../core/text_map.h"
 #include "../utils/theme.h"
 #include "../utils/font.h"
+#include "../utils/perf.h"
 #include "raylib.h"
 
 #include <stdio.h>
@@ -60,13 +62,19 @@ static void extract_filename(const char *path, char *filename, size_t filename_s
     }
 }
 
-// Free text content if allocated
+// Free text content if allocated, and unmap a mapped file
 static void free_text_content(FileViewModalState *modal)
 {
     if (modal->text_content) {
         free(modal->text_content);
         modal->text_content = NULL;
     }
+    if (modal->text_map) {
+        text_map_close(modal->text_map);
+        modal->text_map = NULL;
+    }
+    modal->scroll_byte = 0;
+    modal->hex = false;
 }
 
 // Calculate maximum scroll offset (clamped to 0)
@@ -76,6 +84,19 @@ static int calc_max_scroll(FileViewModalState *modal)
     return max > 0 ? max : 0;
 }
 
+// Calculate maximum scroll_byte of a mapped file: the last page's first line or row
+static size_t calc_max_scroll_byte(FileViewModalState *modal)
+{
+    size_t size = text_map_size(modal->text_map);
+    int visible = modal->visible_lines > 0 ? modal->visible_lines : 1;
+
+    if (modal->hex) {
+        size_t rows = (size + FILE_VIEW_HEX_ROW - 1) / FILE_VIEW_HEX_ROW;
+        return rows > (size_t)visible ? (rows - (size_t)visible) * FILE_VIEW_HEX_ROW : 0;
+    }
+    return text_map_step(modal->text_map, size, -(visible - 1));
+}
+
 void file_view_modal_init(FileViewModalState *modal)
 {
     // Zero-initialization sets: visible=false, type=FILE_VIEW_NONE,
@@ -122,6 +143,40 @@ void file_view_modal_show_text(FileViewModalState *modal, const char *file_path,
     }
 }
 
+bool file_view_modal_show_file(FileViewModalState *modal, const char *file_path)
+{
+    TextMap *map = text_map_open(file_path);
+    if (!map) {
+        return false;
+    }
+
+    free_text_content(modal);
+
+    modal->visible = true;
+    modal->type = FILE_VIEW_TEXT;
+    modal->scroll_offset = 0;
+    modal->total_lines = 0;
+    modal->text_map = map;
+
+    safe_strncpy(modal->file_path, file_path, sizeof(modal->file_path));
+    extract_filename(file_path, modal->filename, sizeof(modal->filename));
+    return true;
+}
+
+void file_view_modal_toggle_hex(FileViewModalState *modal)
+{
+    if (!modal->text_map) return;
+
+    modal->hex = !modal->hex;
+
+    // Keep the same place: the row or the line holding the first byte shown
+    if (modal->hex) {
+        modal->scroll_byte -= modal->scroll_byte % FILE_VIEW_HEX_ROW;
+    } else {
+        modal->scroll_byte = text_map_step(modal->text_map, modal->scroll_byte, 0);
+    }
+}
+
 void file_view_modal_show_image(FileViewModalState *modal, const char *file_path,
                                 unsigned int texture_id, int width, int height)
 {
@@ -160,6 +215,19 @@ void file_view_modal_scroll_down(FileViewModalState *modal, int lines)
 {
     if (modal->type != FILE_VIEW_TEXT) return;
 
+    if (modal->text_map) {
+        size_t max_byte = calc_max_scroll_byte(modal);
+        if (modal->hex) {
+            modal->scroll_byte += (size_t)lines * FILE_VIEW_HEX_ROW;
+        } else {
+            modal->scroll_byte = text_map_step(modal->text_map, modal->scroll_byte, lines);
+        }
+        if (modal->scroll_byte > max_byte) {
+            modal->scroll_byte = max_byte;
+        }
+        return;
+    }
+
     modal->scroll_offset += lines;
 
     int max_scroll = calc_max_scroll(modal);
@@ -172,6 +240,16 @@ void file_view_modal_scroll_up(FileViewModalState *modal, int lines)
 {
     if (modal->type != FILE_VIEW_TEXT) return;
 
+    if (modal->text_map) {
+        if (modal->hex) {
+            size_t back = (size_t)lines * FILE_VIEW_HEX_ROW;
+            modal->scroll_byte = modal->scroll_byte > back ? modal->scroll_byte - back : 0;
+        } else {
+            modal->scroll_byte = text_map_step(modal->text_map, modal->scroll_byte, -lines);
+        }
+        return;
+    }
+
     modal->scroll_offset -= lines;
     if (modal->scroll_offset < 0) {
         modal->scroll_offset = 0;
@@ -182,11 +260,16 @@ void file_view_modal_scroll_to_top(FileViewModalState *modal)
 {
     if (modal->type != FILE_VIEW_TEXT) return;
     modal->scroll_offset = 0;
+    modal->scroll_byte = 0;
 }
 
 void file_view_modal_scroll_to_bottom(FileViewModalState *modal)
 {
     if (modal->type != FILE_VIEW_TEXT) return;
+    if (modal->text_map) {
+        modal->scroll_byte = calc_max_scroll_byte(modal);
+        return;
+    }
     modal->scroll_offset = calc_max_scroll(modal);
 }
 
@@ -213,6 +296,12 @@ bool file_view_modal_handle_input(struct App *app)
 
     // Text scrolling controls
     if (modal->type == FILE_VIEW_TEXT) {
+        // h: switch a mapped file between text and hex
+        if (IsKeyPressed(KEY_H) && modal->text_map) {
+            file_view_modal_toggle_hex(modal);
+            return true;
+        }
+
         // j/Down: scroll down
         if (IsKeyPressed(KEY_J) || IsKeyPressed(KEY_DOWN)) {
             file_view_modal_scroll_down(modal, 1);
@@ -287,17 +376,139 @@ bool file_view_modal_handle_input(struct App *app)
     return true; // Modal is visible, consume all input
 }
 
+// Draw the scrollbar of a mapped file, by byte position
+static void draw_mapped_scrollbar(FileViewModalState *modal, size_t shown_bytes, int content_x,
+                                  int content_y, int content_width, int content_height)
+{
+    size_t size = text_map_size(modal->text_map);
+    if (size == 0 || shown_bytes >= size) return;
+
+    int scrollbar_x = content_x + content_width + 4;
+    int thumb_height = (int)(content_height * ((double)shown_bytes / (double)size));
+    if (thumb_height < 20) thumb_height = 20;
+
+    size_t max_byte = calc_max_scroll_byte(modal);
+    double scroll_ratio = max_byte > 0 ? (double)modal->scroll_byte / (double)max_byte : 0;
+    if (scroll_ratio > 1) scroll_ratio = 1;
+    int thumb_y = content_y + (int)((content_height - thumb_height) * scroll_ratio);
+
+    DrawRectangle(scrollbar_x, content_y, MODAL_SCROLLBAR_WIDTH, content_height,
+                  Fade(g_theme.border, 0.3f));
+    DrawRectangle(scrollbar_x, thumb_y, MODAL_SCROLLBAR_WIDTH, thumb_height,
+                  g_theme.textSecondary);
+}
+
+// Draw a mapped file as lines, numbered from the index or approximately ("~") ahead of it
+static void draw_mapped_text_view(FileViewModalState *modal, int content_x, int content_y,
+                                  int content_width, int content_height)
+{
+    const char *data = text_map_data(modal->text_map);
+    size_t size = text_map_size(modal->text_map);
+
+    bool exact = true;
+    int line_num = text_map_line_at(modal->text_map, modal->scroll_byte, &exact);
+
+    // Widen the gutter for the largest number on screen
+    char line_num_str[24];
+    snprintf(line_num_str, sizeof(line_num_str), "~%d", line_num + modal->visible_lines);
+    int gutter = MeasureTextCustom(line_num_str, FONT_SIZE_SMALL) + 12;
+    if (gutter < MODAL_LINE_NUMBER_WIDTH) gutter = MODAL_LINE_NUMBER_WIDTH;
+
+    BeginScissorMode(content_x, content_y, content_width, content_height);
+
+    size_t offset = modal->scroll_byte;
+    int draw_y = content_y;
+    while (offset <= size && draw_y < content_y + content_height) {
+        // Truncate very long lines
+        char line[1024];
+        size_t available = size - offset < sizeof(line) - 1 ? size - offset : sizeof(line) - 1;
+        const char *line_end = memchr(data + offset, '\n', available);
+        size_t line_len = line_end ? (size_t)(line_end - (data + offset)) : available;
+        memcpy(line, data + offset, line_len);
+        line[line_len] = '\0';
+
+        snprintf(line_num_str, sizeof(line_num_str), exact ? "%4d" : "~%d", line_num + 1);
+        DrawTextCustom(line_num_str, content_x, draw_y, FONT_SIZE_SMALL, g_theme.textSecondary);
+        DrawTextCustom(line, content_x + gutter, draw_y, FONT_SIZE_SMALL, g_theme.textPrimary);
+        draw_y += MODAL_LINE_HEIGHT;
+        line_num++;
+
+        const char *next = memchr(data + offset, '\n', size - offset);
+        if (!next) {
+            offset = size + 1;
+            break;
+        }
+        offset = (size_t)(next - data) + 1;
+    }
+
+    EndScissorMode();
+
+    size_t end = offset > size ? size : offset;
+    draw_mapped_scrollbar(modal, end - modal->scroll_byte, content_x, content_y, content_width, content_height);
+}
+
+// Draw a mapped file as hex rows: offset, bytes, and printable characters
+static void draw_hex_view(FileViewModalState *modal, int content_x, int content_y,
+                          int content_width, int content_height)
+{
+    const unsigned char *data = (const unsigned char *)text_map_data(modal->text_map);
+    size_t size = text_map_size(modal->text_map);
+
+    BeginScissorMode(content_x, content_y, content_width, content_height);
+
+    size_t offset = modal->scroll_byte;
+    int draw_y = content_y;
+    while (offset < size && draw_y < content_y + content_height) {
+        char row[128];
+        int n = snprintf(row, sizeof(row), "%08llx  ", (unsigned long long)offset);
+        for (size_t i = 0; i < FILE_VIEW_HEX_ROW; i++) {
+            if (offset + i < size) {
+                n += snprintf(row + n, sizeof(row) - (size_t)n, "%02x ", data[offset + i]);
+            } else {
+                n += snprintf(row + n, sizeof(row) - (size_t)n, "   ");
+            }
+            if (i == FILE_VIEW_HEX_ROW / 2 - 1) {
+                row[n++] = ' ';
+            }
+        }
+        row[n++] = ' ';
+        for (size_t i = 0; i < FILE_VIEW_HEX_ROW && offset + i < size; i++) {
+            unsigned char c = data[offset + i];
+            row[n++] = (c >= 0x20 && c < 0x7f) ? (char)c : '.';
+        }
+        row[n] = '\0';
+
+        DrawTextCustom(row, content_x, draw_y, FONT_SIZE_SMALL, g_theme.textPrimary);
+        draw_y += MODAL_LINE_HEIGHT;
+        offset += FILE_VIEW_HEX_ROW;
+    }
+
+    EndScissorMode();
+
+    size_t end = offset > size ? size : offset;
+    draw_mapped_scrollbar(modal, end - modal->scroll_byte, content_x, content_y, content_width, content_height);
+}
+
 // Draw text view
 static void draw_text_view(struct App *app, int content_x, int content_y,
                            int content_width, int content_height)
 {
     FileViewModalState *modal = &app->file_view_modal;
 
-    if (!modal->text_content) return;
-
     // Calculate visible lines
     modal->visible_lines = content_height / MODAL_LINE_HEIGHT;
 
+    if (modal->text_map) {
+        if (modal->hex) {
+            draw_hex_view(modal, content_x, content_y, content_width, content_height);
+        } else {
+            draw_mapped_text_view(modal, content_x, content_y, content_width, content_height);
+        }
+        return;
+    }
+
+    if (!modal->text_content) return;
+
     // Enable scissor mode for content clipping
     BeginScissorMode(content_x, content_y, content_width, content_height);
 
@@ -378,6 +589,7 @@ static void draw_image_view(struct App *app, int content_x, int content_y,
 
     // Draw the texture
     Texture2D tex = { modal->texture_id, modal->image_width, modal->image_height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+    texture_budget_touch(modal->texture_id);
 
     Rectangle source = { 0, 0, (float)modal->image_width, (float)modal->image_height };
     Rectangle dest = { (float)draw_x, (float)draw_y, (float)draw_width, (float)draw_height };
@@ -425,8 +637,25 @@ void file_view_modal_draw(struct App *app)
     // Title text (filename)
     DrawTextCustom(modal->filename, modal_x + MODAL_PADDING, modal_y + 10, FONT_SIZE, g_theme.textPrimary);
 
+    // Line count of a mapped file, growing while it is indexed
+    if (modal->text_map) {
+        char status[64];
+        if (modal->hex) {
+            snprintf(status, sizeof(status), "%llu bytes", (unsigned long long)text_map_size(modal->text_map));
+        } else {
+            bool complete = false;
+            int lines = text_map_line_count(modal->text_map, &complete);
+            snprintf(status, sizeof(status), complete ? "%d lines" : "%d+ lines", lines);
+        }
+        int title_width = MeasureTextCustom(modal->filename, FONT_SIZE);
+        DrawTextCustom(status, modal_x + MODAL_PADDING + title_width + 16, modal_y + 12,
+                       FONT_SIZE_SMALL, g_theme.textSecondary);
+    }
+
     // Close hint
-    const char *hint = "Press Escape or Q to close";
+    const char *hint = modal->text_map ? (modal->hex ? "H for text, Escape or Q to close"
+                                                      : "H for hex, Escape or Q to close")
+                                       : "Press Escape or Q to close";
     int hint_width = MeasureTextCustom(hint, FONT_SIZE_SMALL);
     DrawTextCustom(hint, modal_x + modal_width - hint_width - MODAL_PADDING,
                    modal_y + 12, FONT_SIZE_SMALL, g_theme.textSecondary);
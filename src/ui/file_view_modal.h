@@ -2,10 +2,16 @@
 #define FILE_VIEW_MODAL_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 // Maximum file path length
 #define FILE_VIEW_PATH_MAX 4096
 
+// Bytes per row in hex mode
+#define FILE_VIEW_HEX_ROW 16
+
+struct TextMap;
+
 // File view modal types
 typedef enum FileViewType {
     FILE_VIEW_NONE,
@@ -28,6 +34,12 @@ typedef struct FileViewModalState {
     int scroll_offset;                  // Current scroll position (line number)
     int visible_lines;                  // Number of visible lines (set during draw)
 
+    // Mapped file content (file_view_modal_show_file), scrolled by byte offset so any
+    // size opens at once; line numbers are estimates until the file is indexed
+    struct TextMap *text_map;
+    size_t scroll_byte;                 // First byte shown: a line start, or a row in hex
+    bool hex;                           // Show bytes as hex rows instead of lines
+
     // Image content
     unsigned int texture_id;            // Raylib texture ID (0 if none)
     int image_width;                    // Original image width
@@ -47,6 +59,12 @@ void file_view_modal_free(FileViewModalState *modal);
 void file_view_modal_show_text(FileViewModalState *modal, const char *file_path,
                                const char *content);
 
+// Show modal with a file mapped from disk (any size); false if it cannot be mapped
+bool file_view_modal_show_file(FileViewModalState *modal, const char *file_path);
+
+// Switch a mapped file between text lines and hex rows
+void file_view_modal_toggle_hex(FileViewModalState *modal);
+
 // Show modal with image (texture_id is an existing Raylib texture)
 void file_view_modal_show_image(FileViewModalState *modal, const char *file_path,
                                 unsigned int texture_id, int width, int height);
@@ -0,0 +1,408 @@
+#include "frame_bench.h"
+#include "browser.h"
+#include "dual_pane.h"
+#include "preview.h"
+#include "../app.h"
+#include "../utils/config.h"
+#include "../utils/perf.h"
+#include "raylib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define FRAME_BENCH_JSON_VERSION 1
+#define FRAME_BENCH_TARGET_FPS 60           // Dropped frames are counted against this
+
+typedef enum FrameStepType {
+    STEP_SCENARIO,
+    STEP_NAVIGATE,
+    STEP_VIEW,
+    STEP_MOVE,
+    STEP_SCROLL,
+    STEP_PREVIEW,
+    STEP_DUAL,
+    STEP_FRAMES,
+    STEP_WAIT
+} FrameStepType;
+
+typedef struct FrameStep {
+    FrameStepType type;
+    int line;                               // In the script, for errors
+    int count;                              // Rows or frames (negative rows: up)
+    int per_frame;                          // Rows per frame
+    int value;                              // View mode, or on/off
+    char text[PATH_MAX_LEN];                // Path, or scenario name
+} FrameStep;
+
+typedef struct FrameScenario {
+    char name[64];
+    FrameTimings timings;
+} FrameScenario;
+
+typedef struct FrameBench {
+    const FrameBenchOptions *options;
+    FrameStep *steps;
+    int step_count;
+    FrameScenario scenarios[FRAME_BENCH_MAX_SCENARIOS];
+    int scenario_count;
+} FrameBench;
+
+// Helper: Parse "on"/"off"; false if it is neither
+static bool parse_switch(const char *word, int *value)
+{
+    if (strcmp(word, "on") == 0) {
+        *value = 1;
+        return true;
+    }
+    if (strcmp(word, "off") == 0) {
+        *value = 0;
+        return true;
+    }
+    return false;
+}
+
+// Helper: Copy a path argument, expanding a leading $FIXTURES
+static bool expand_path(const char *arg, const char *fixture_root, char *out, size_t out_size)
+{
+    static const char prefix[] = "$FIXTURES";
+    int written;
+    if (strncmp(arg, prefix, sizeof(prefix) - 1) == 0) {
+        written = snprintf(out, out_size, "%s%s", fixture_root, arg + sizeof(prefix) - 1);
+    } else {
+        written = snprintf(out, out_size, "%s", arg);
+    }
+    return written >= 0 && (size_t)written < out_size;
+}
+
+// Helper: Parse one script line into step; false (with a message) if it is malformed
+static bool parse_line(char *line, int line_number, const char *fixture_root, FrameStep *step)
+{
+    char *words[4] = { NULL };
+    int word_count = 0;
+    for (char *word = strtok(line, " \t\r\n"); word && word_count < 4; word = strtok(NULL, " \t\r\n")) {
+        words[word_count++] = word;
+    }
+
+    memset(step, 0, sizeof(*step));
+    step->line = line_number;
+    step->per_frame = 1;
+    const char *command = words[0];
+    const char *arg = words[1];
+    bool ok = arg != NULL;
+
+    if (strcmp(command, "scenario") == 0 && ok) {
+        step->type = STEP_SCENARIO;
+        snprintf(step->text, sizeof(step->text), "%.63s", arg);
+    } else if (strcmp(command, "navigate") == 0 && ok) {
+        step->type = STEP_NAVIGATE;
+        ok = expand_path(arg, fixture_root, step->text, sizeof(step->text));
+    } else if (strcmp(command, "view") == 0 && ok) {
+        static const char *const views[] = { "list", "grid", "column", "treemap" };
+        step->type = STEP_VIEW;
+        step->value = -1;
+        for (int i = 0; i < 4; i++) {
+            if (strcmp(arg, views[i]) == 0) {
+                step->value = i;
+            }
+        }
+        ok = step->value >= 0;
+    } else if ((strcmp(command, "down") == 0 || strcmp(command, "up") == 0 ||
+                strcmp(command, "scroll") == 0) && ok) {
+        step->type = command[0] == 's' ? STEP_SCROLL : STEP_MOVE;
+        step->count = atoi(arg);
+        if (command[0] == 'u') {
+            step->count = -step->count;
+        }
+        if (words[2]) {
+            step->per_frame = atoi(words[2]);
+        }
+        ok = step->per_frame > 0;
+    } else if (strcmp(command, "preview") == 0 && ok) {
+        step->type = STEP_PREVIEW;
+        ok = parse_switch(arg, &step->value);
+    } else if (strcmp(command, "dual") == 0 && ok) {
+        step->type = STEP_DUAL;
+        ok = parse_switch(arg, &step->value);
+    } else if (strcmp(command, "frames") == 0 && ok) {
+        step->type = STEP_FRAMES;
+        step->count = atoi(arg);
+        ok = step->count > 0;
+    } else if (strcmp(command, "wait") == 0) {
+        step->type = STEP_WAIT;
+        ok = true;
+    } else {
+        ok = false;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "frame bench: line %d: cannot read '%s'\n", line_number, command);
+    }
+    return ok;
+}
+
+// Helper: Read the whole script before anything runs, so a typo fails at once
+static bool load_script(FrameBench *bench)
+{
+    FILE *f = fopen(bench->options->script, "r");
+    if (!f) {
+        fprintf(stderr, "frame bench: cannot open %s\n", bench->options->script);
+        return false;
+    }
+
+    bench->steps = calloc(FRAME_BENCH_MAX_STEPS, sizeof(FrameStep));
+    bool ok = bench->steps != NULL;
+    char line[PATH_MAX_LEN + 64];
+    int line_number = 0;
+    while (ok && fgets(line, sizeof(line), f)) {
+        line_number++;
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        if (strspn(line, " \t\r\n") == strlen(line)) {
+            continue;
+        }
+        if (bench->step_count >= FRAME_BENCH_MAX_STEPS) {
+            fprintf(stderr, "frame bench: more than %d steps\n", FRAME_BENCH_MAX_STEPS);
+            ok = false;
+            break;
+        }
+        ok = parse_line(line, line_number, bench->options->fixture_root, &bench->steps[bench->step_count]);
+        if (ok) {
+            bench->step_count++;
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+// Helper: Start timing frames under a new scenario
+static FrameScenario *begin_scenario(FrameBench *bench, const char *name)
+{
+    if (bench->scenario_count >= FRAME_BENCH_MAX_SCENARIOS) {
+        fprintf(stderr, "frame bench: more than %d scenarios\n", FRAME_BENCH_MAX_SCENARIOS);
+        return NULL;
+    }
+    FrameScenario *scenario = &bench->scenarios[bench->scenario_count++];
+    snprintf(scenario->name, sizeof(scenario->name), "%s", name);
+    timing_init(&scenario->timings);
+    timing_set_target(&scenario->timings, FRAME_BENCH_TARGET_FPS);
+    return scenario;
+}
+
+// Helper: Open a directory the way the sidebar does
+static bool navigate(App *app, const char *path)
+{
+    if (!directory_read(&app->directory, path)) {
+        return false;
+    }
+    app->selected_index = 0;
+    app->scroll_offset = 0;
+    selection_clear(&app->selection);
+    history_push(&app->history, app->directory.current_path);
+    return true;
+}
+
+// Helper: Apply this frame's part of a step (done frames of it already drawn); false once
+// the step needs no more frames after this one
+static bool apply_step(App *app, const FrameStep *step, int done)
+{
+    switch (step->type) {
+        case STEP_MOVE: {
+            // Rows as the arrow keys move them: the cursor, with the selection following
+            int remaining = abs(step->count) - done * step->per_frame;
+            int rows = remaining < step->per_frame ? remaining : step->per_frame;
+            int target = app->selected_index + (step->count < 0 ? -rows : rows);
+            if (target > app->directory.count - 1) target = app->directory.count - 1;
+            if (target < 0) target = 0;
+            bool moved = target != app->selected_index;
+            app->selected_index = target;
+            selection_clear(&app->selection);
+            app->selection.anchor_index = app->selected_index;
+            browser_ensure_visible(app);
+            return moved && remaining > rows;
+        }
+        case STEP_SCROLL: {
+            // Rows as the wheel scrolls them, clamped the same way
+            int remaining = abs(step->count) - done * step->per_frame;
+            int rows = remaining < step->per_frame ? remaining : step->per_frame;
+            int before = app->scroll_offset;
+            app->scroll_offset += step->count < 0 ? -rows : rows;
+            int max_scroll = app->directory.count - app->visible_rows;
+            if (max_scroll < 0) max_scroll = 0;
+            if (app->scroll_offset > max_scroll) app->scroll_offset = max_scroll;
+            if (app->scroll_offset < 0) app->scroll_offset = 0;
+            return app->scroll_offset != before && remaining > rows;
+        }
+        case STEP_VIEW:
+            app->view_mode = (ViewMode)step->value;
+            return false;
+        case STEP_PREVIEW:
+            if (app->preview.visible != (step->value != 0)) {
+                preview_toggle(&app->preview);
+            }
+            return false;
+        case STEP_DUAL:
+            if (dual_pane_is_enabled(&app->dual_pane) != (step->value != 0)) {
+                dual_pane_toggle(app);
+            }
+            return false;
+        case STEP_FRAMES:
+            return done + 1 < step->count;
+        case STEP_WAIT:
+            return app->directory.is_loading && done + 1 < FRAME_BENCH_WAIT_FRAMES;
+        default:
+            return false;
+    }
+}
+
+// Helper: One frame as the main loop draws it, with the step applied as if it were input,
+// timed from the input to the end of the draw
+static bool run_frame(App *app, FrameScenario *scenario, const FrameStep *step, int done)
+{
+    double start = GetTime();
+
+    // Stay awake and uncapped: replayed input is activity, as real input would be
+    app->last_active_time = start;
+    bool more = apply_step(app, step, done);
+    if (step->type != STEP_FRAMES && step->type != STEP_WAIT) {
+        dirty_full(&app->perf.dirty);
+    }
+
+    app_update(app);
+    app_draw(app);
+
+    // The app's own timings hold this frame's sections; keep them with the scenario
+    FrameTimings *timings = &scenario->timings;
+    memcpy(timings->section_time, app->perf.timings.section_time, sizeof(timings->section_time));
+    timing_record_frame(timings, GetTime() - start);
+    return more;
+}
+
+// Helper: Write s as a JSON string
+static void json_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fprintf(f, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+// Helper: Write every scenario as one JSON document
+static bool write_json(const FrameBench *bench, const char *file)
+{
+    FILE *f = strcmp(file, "-") == 0 ? stdout : fopen(file, "w");
+    if (!f) {
+        fprintf(stderr, "frame bench: cannot write %s\n", file);
+        return false;
+    }
+
+    fprintf(f, "{\n  \"version\": %d,\n  \"timestamp\": %lld,\n  \"script\": ", FRAME_BENCH_JSON_VERSION,
+            (long long)time(NULL));
+    json_string(f, bench->options->script);
+    fprintf(f, ",\n  \"p99_budget_ms\": %.3f,\n  \"scenarios\": [", bench->options->p99_budget_ms);
+    for (int i = 0; i < bench->scenario_count; i++) {
+        const FrameScenario *scenario = &bench->scenarios[i];
+        const FrameTimings *t = &scenario->timings;
+        fprintf(f, "%s\n    {\"name\": ", i > 0 ? "," : "");
+        json_string(f, scenario->name);
+        fprintf(f, ", \"frames\": %llu, \"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, "
+                   "\"max_ms\": %.3f, \"dropped\": %llu, \"async_ms\": %.3f, \"input_ms\": %.3f, "
+                   "\"layout_ms\": %.3f, \"draw_ms\": %.3f}",
+                (unsigned long long)t->histogram_count, timing_get_session_percentile(t, 0.50f) * 1000,
+                timing_get_session_percentile(t, 0.90f) * 1000, timing_get_session_percentile(t, 0.99f) * 1000,
+                t->max_frame_time * 1000, (unsigned long long)t->dropped_frames,
+                t->section_avg[FRAME_SECTION_ASYNC] * 1000, t->section_avg[FRAME_SECTION_INPUT] * 1000,
+                t->section_avg[FRAME_SECTION_LAYOUT] * 1000, t->section_avg[FRAME_SECTION_DRAW] * 1000);
+    }
+    fprintf(f, "\n  ]\n}\n");
+
+    if (f != stdout) {
+        return fclose(f) == 0;
+    }
+    return true;
+}
+
+// Helper: Table of the scenarios; true if every p99 is within the budget
+static bool report(const FrameBench *bench, FILE *out)
+{
+    double budget = bench->options->p99_budget_ms;
+    bool within = true;
+    fprintf(out, "%-24s %7s %8s %8s %8s %8s %8s\n", "scenario", "frames", "p50 ms", "p90 ms", "p99 ms",
+            "max ms", "dropped");
+    for (int i = 0; i < bench->scenario_count; i++) {
+        const FrameScenario *scenario = &bench->scenarios[i];
+        const FrameTimings *t = &scenario->timings;
+        double p99 = timing_get_session_percentile(t, 0.99f) * 1000;
+        bool over = budget > 0.0 && p99 > budget;
+        fprintf(out, "%-24s %7llu %8.2f %8.2f %8.2f %8.2f %8llu%s\n", scenario->name,
+                (unsigned long long)t->histogram_count, timing_get_session_percentile(t, 0.50f) * 1000,
+                timing_get_session_percentile(t, 0.90f) * 1000, p99, t->max_frame_time * 1000,
+                (unsigned long long)t->dropped_frames, over ? "  over budget" : "");
+        within = within && !over;
+    }
+    if (budget > 0.0) {
+        fprintf(out, "p99 budget %.2f ms: %s\n", budget, within ? "met" : "exceeded");
+    }
+    return within;
+}
+
+int frame_bench_run(App *app, const FrameBenchOptions *options)
+{
+    static FrameBench bench;
+    memset(&bench, 0, sizeof(bench));
+    bench.options = options;
+    if (!load_script(&bench)) {
+        free(bench.steps);
+        return 2;
+    }
+
+    // Uncapped, and never asleep between frames
+    app->replaying = true;
+    g_config.performance.frame_rate = -1;
+    app->pacing_check_time = 0;
+
+    int status = 0;
+    FrameScenario *scenario = NULL;
+    for (int i = 0; i < bench.step_count && status == 0; i++) {
+        const FrameStep *step = &bench.steps[i];
+        if (step->type == STEP_SCENARIO || !scenario) {
+            scenario = begin_scenario(&bench, step->type == STEP_SCENARIO ? step->text : "default");
+            if (!scenario) {
+                status = 2;
+                break;
+            }
+            if (step->type == STEP_SCENARIO) {
+                continue;
+            }
+        }
+        if (step->type == STEP_NAVIGATE && !navigate(app, step->text)) {
+            fprintf(stderr, "frame bench: line %d: cannot open %s\n", step->line, step->text);
+            status = 2;
+            break;
+        }
+        for (int done = 0; run_frame(app, scenario, step, done); done++) {
+        }
+    }
+
+    FILE *table = options->json && strcmp(options->json, "-") == 0 ? stderr : stdout;
+    if (status == 0) {
+        fprintf(table, "Frame benchmark: %s (%d steps)\n", options->script, bench.step_count);
+        status = report(&bench, table) ? 0 : 1;
+        if (options->json && !write_json(&bench, options->json)) {
+            status = 2;
+        }
+    }
+    free(bench.steps);
+    return status;
+}
@@ -0,0 +1,40 @@
+#ifndef FRAME_BENCH_H
+#define FRAME_BENCH_H
+
+#include <stdbool.h>
+
+// Forward declaration
+struct App;
+
+// Frame benchmark: replays a script of UI actions against the app in a hidden window,
+// one step per frame with the frame rate uncapped, and reports frame time percentiles
+// per scenario. A script is one command per line ('#' starts a comment):
+//
+//   scenario NAME          Start a new scenario; frames are timed under NAME
+//   navigate PATH          Open a directory ($FIXTURES expands to the fixture root)
+//   view list|grid|column|treemap
+//   down N [STEP]          Move the cursor N rows, STEP rows per frame (default 1)
+//   up N [STEP]
+//   scroll N [STEP]        Scroll N rows without moving the cursor (negative: up)
+//   preview on|off
+//   dual on|off            Dual pane mode
+//   frames N               Draw N frames with nothing happening
+//   wait                   Draw frames until the listing has loaded
+
+#define FRAME_BENCH_DEFAULT_FIXTURES "/tmp/finder-plus-bench"   // Where ./bench --prepare puts them
+#define FRAME_BENCH_MAX_SCENARIOS 32
+#define FRAME_BENCH_MAX_STEPS 512
+#define FRAME_BENCH_WAIT_FRAMES 3000        // A wait gives up after this many frames
+
+typedef struct FrameBenchOptions {
+    const char *script;
+    const char *fixture_root;               // What $FIXTURES expands to
+    const char *json;                       // Write results as JSON here (NULL: table only)
+    double p99_budget_ms;                   // Fail if a scenario's p99 is over this (0: no budget)
+} FrameBenchOptions;
+
+// Replay the script against an initialized app. Returns the process exit code: 0 on
+// success, 1 if a scenario went over the budget, 2 if the script or output failed
+int frame_bench_run(struct App *app, const FrameBenchOptions *options);
+
+#endif // FRAME_BENCH_H
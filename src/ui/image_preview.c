@@ -0,0 +1,462 @@
+#include "image_preview.h"
+#include "../platform/imageio.h"
+#include "../utils/perf.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+
+// A version of an image at a size
+typedef struct ImageKey {
+    char path[4096];
+    time_t mtime;
+    off_t size;
+    int max_size;                       // Longest side decoded
+} ImageKey;
+
+typedef struct DecodedImage {
+    ImageKey key;
+    bool ok;
+    Image image;                        // Base level followed by its mipmaps
+    int original_width;
+    int original_height;
+    int bit_depth;
+} DecodedImage;
+
+typedef struct PreviewEntry {
+    bool used;
+    ImageKey key;
+    uint64_t last_used;
+    ImagePreviewTexture preview;
+} PreviewEntry;
+
+struct ImagePreviewCache {
+    pthread_mutex_t mutex;
+    pthread_cond_t work;                // A request arrived, or stopping
+    pthread_t thread;
+    bool thread_started;
+    bool stopping;
+
+    // Guarded by mutex
+    ImageKey request;
+    bool request_pending;
+    ImageKey decoding;
+    bool is_decoding;
+    DecodedImage done;                  // Waiting to be uploaded
+    bool has_done;
+
+    // Main thread only
+    ImageKey wanted;                    // Last request
+    ImagePreviewStatus status;
+    PreviewEntry entries[IMAGE_PREVIEW_CACHE_SIZE];
+    uint64_t clock;
+    DecodedImage uploading;             // Being copied into partial a slice at a time
+    bool is_uploading;
+    Texture2D partial;
+    int rows_uploaded;
+};
+
+// Helper: Bit depth of a raylib pixel format
+static int bit_depth_from_format(int format)
+{
+    switch (format) {
+        case PIXELFORMAT_UNCOMPRESSED_GRAYSCALE: return 8;
+        case PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA: return 16;
+        case PIXELFORMAT_UNCOMPRESSED_R5G6B5: return 16;
+        case PIXELFORMAT_UNCOMPRESSED_R8G8B8: return 24;
+        case PIXELFORMAT_UNCOMPRESSED_R5G5B5A1: return 16;
+        case PIXELFORMAT_UNCOMPRESSED_R4G4B4A4: return 16;
+        case PIXELFORMAT_UNCOMPRESSED_R8G8B8A8: return 32;
+        case PIXELFORMAT_UNCOMPRESSED_R32: return 32;
+        case PIXELFORMAT_UNCOMPRESSED_R32G32B32: return 96;
+        case PIXELFORMAT_UNCOMPRESSED_R32G32B32A32: return 128;
+        case PIXELFORMAT_UNCOMPRESSED_R16: return 16;
+        case PIXELFORMAT_UNCOMPRESSED_R16G16B16: return 48;
+        case PIXELFORMAT_UNCOMPRESSED_R16G16B16A16: return 64;
+        default: return 0;  // Unknown/compressed
+    }
+}
+
+// Helper: Whether two keys name the same version of a file
+static bool same_file(const ImageKey *a, const ImageKey *b)
+{
+    return a->mtime == b->mtime && a->size == b->size && strcmp(a->path, b->path) == 0;
+}
+
+// Helper: Whether an image decoded for have serves want (same file, at least as large)
+static bool key_serves(const ImageKey *have, const ImageKey *want)
+{
+    return same_file(have, want) && have->max_size >= want->max_size;
+}
+
+// Helper: Whether an image is too large to upload in one frame (only uncompressed ones
+// can be copied in slices)
+static bool upload_in_slices(const Image *image)
+{
+    return image->format < PIXELFORMAT_COMPRESSED_DXT1_RGB &&
+           GetPixelDataSize(image->width, image->height, image->format) > IMAGE_PREVIEW_UPLOAD_SLICE;
+}
+
+// Helper: Decode an image at preview size with its mipmaps (slow: runs without the lock)
+static bool decode_image(DecodedImage *decoded)
+{
+    const ImageKey *key = &decoded->key;
+    unsigned char *rgb = NULL;
+    int width = 0;
+    int height = 0;
+
+    if (platform_load_image_scaled(key->path, key->max_size, &rgb, &width, &height,
+                                   &decoded->original_width, &decoded->original_height)) {
+        decoded->image = (Image){
+            .data = rgb,
+            .width = width,
+            .height = height,
+            .mipmaps = 1,
+            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8
+        };
+        decoded->bit_depth = platform_image_bit_depth(key->path);
+    } else {
+        // Formats ImageIO cannot read: decode in full, then downsize
+        if (key->size > IMAGE_PREVIEW_STB_MAX_BYTES) return false;
+
+        Image full = LoadImage(key->path);
+        if (full.data == NULL) return false;
+
+        decoded->original_width = full.width;
+        decoded->original_height = full.height;
+        decoded->bit_depth = bit_depth_from_format(full.format);
+
+        int longest = full.width > full.height ? full.width : full.height;
+        if (longest > key->max_size) {
+            int w = (int)((long long)full.width * key->max_size / longest);
+            int h = (int)((long long)full.height * key->max_size / longest);
+            ImageResize(&full, w > 0 ? w : 1, h > 0 ? h : 1);
+        }
+        decoded->image = full;
+    }
+
+    // Mipmaps keep the image smooth when drawn smaller than decoded; an image uploaded in
+    // slices gets them from the GPU once whole
+    if (!upload_in_slices(&decoded->image)) {
+        ImageMipmaps(&decoded->image);
+    }
+    return decoded->image.data != NULL;
+}
+
+// Thread function: Decode the latest request
+static void *decode_thread(void *arg)
+{
+    ImagePreviewCache *cache = (ImagePreviewCache *)arg;
+    DecodedImage decoded;
+
+    pthread_mutex_lock(&cache->mutex);
+    while (!cache->stopping) {
+        if (!cache->request_pending) {
+            pthread_cond_wait(&cache->work, &cache->mutex);
+            continue;
+        }
+
+        memset(&decoded, 0, sizeof(decoded));
+        decoded.key = cache->request;
+        cache->request_pending = false;
+        cache->decoding = decoded.key;
+        cache->is_decoding = true;
+        pthread_mutex_unlock(&cache->mutex);
+
+        decoded.ok = decode_image(&decoded);
+
+        pthread_mutex_lock(&cache->mutex);
+        cache->is_decoding = false;
+        // A result the main thread never picked up is for an image no longer wanted
+        if (cache->has_done && cache->done.ok) {
+            UnloadImage(cache->done.image);
+        }
+        cache->done = decoded;
+        cache->has_done = true;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return NULL;
+}
+
+// Helper: Drop an upload in progress
+static void upload_cancel(ImagePreviewCache *cache)
+{
+    UnloadTexture(cache->partial);
+    UnloadImage(cache->uploading.image);
+    cache->partial = (Texture2D){ 0 };
+    cache->is_uploading = false;
+}
+
+ImagePreviewCache *image_preview_create(void)
+{
+    ImagePreviewCache *cache = (ImagePreviewCache *)calloc(1, sizeof(ImagePreviewCache));
+    if (!cache) return NULL;
+
+    pthread_mutex_init(&cache->mutex, NULL);
+    pthread_cond_init(&cache->work, NULL);
+    if (pthread_create(&cache->thread, NULL, decode_thread, cache) != 0) {
+        pthread_cond_destroy(&cache->work);
+        pthread_mutex_destroy(&cache->mutex);
+        free(cache);
+        return NULL;
+    }
+    cache->thread_started = true;
+    return cache;
+}
+
+void image_preview_destroy(ImagePreviewCache *cache)
+{
+    if (!cache) return;
+
+    if (cache->thread_started) {
+        pthread_mutex_lock(&cache->mutex);
+        cache->stopping = true;
+        pthread_cond_broadcast(&cache->work);
+        pthread_mutex_unlock(&cache->mutex);
+        pthread_join(cache->thread, NULL);
+    }
+
+    if (cache->has_done && cache->done.ok) {
+        UnloadImage(cache->done.image);
+    }
+    if (cache->is_uploading) {
+        upload_cancel(cache);
+    }
+    for (int i = 0; i < IMAGE_PREVIEW_CACHE_SIZE; i++) {
+        if (cache->entries[i].used) {
+            texture_budget_untrack(cache->entries[i].preview.texture.id);
+            UnloadTexture(cache->entries[i].preview.texture);
+        }
+    }
+
+    pthread_cond_destroy(&cache->work);
+    pthread_mutex_destroy(&cache->mutex);
+    free(cache);
+}
+
+// Helper: The cached texture serving a key, marked recently used; NULL if none
+static PreviewEntry *cache_find(ImagePreviewCache *cache, const ImageKey *key)
+{
+    for (int i = 0; i < IMAGE_PREVIEW_CACHE_SIZE; i++) {
+        PreviewEntry *entry = &cache->entries[i];
+        if (entry->used && key_serves(&entry->key, key)) {
+            entry->last_used = ++cache->clock;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Helper: Slot for a new texture: one holding another version of the same file, else
+// empty, else the least recently used (its texture unloaded)
+static PreviewEntry *cache_slot(ImagePreviewCache *cache, const ImageKey *key)
+{
+    PreviewEntry *slot = NULL;
+    for (int i = 0; i < IMAGE_PREVIEW_CACHE_SIZE; i++) {
+        PreviewEntry *entry = &cache->entries[i];
+        if (entry->used && strcmp(entry->key.path, key->path) == 0) {
+            slot = entry;
+            break;
+        }
+        if (!slot || (slot->used && (!entry->used || entry->last_used < slot->last_used))) {
+            slot = entry;
+        }
+    }
+    if (slot->used) {
+        texture_budget_untrack(slot->preview.texture.id);
+        UnloadTexture(slot->preview.texture);
+        slot->used = false;
+    }
+    return slot;
+}
+
+// Helper: Give a texture back to the texture budget, unless it is the one last requested
+static bool cache_evict(void *owner, unsigned int id)
+{
+    ImagePreviewCache *cache = (ImagePreviewCache *)owner;
+    for (int i = 0; i < IMAGE_PREVIEW_CACHE_SIZE; i++) {
+        PreviewEntry *entry = &cache->entries[i];
+        if (entry->used && entry->preview.texture.id == id) {
+            if (key_serves(&entry->key, &cache->wanted)) return false;
+            UnloadTexture(entry->preview.texture);
+            entry->used = false;
+            return true;
+        }
+    }
+    return true;
+}
+
+// Helper: Cache the texture uploaded for a decoded image
+static void cache_insert(ImagePreviewCache *cache, const DecodedImage *decoded, Texture2D texture)
+{
+    SetTextureFilter(texture, TEXTURE_FILTER_TRILINEAR);
+
+    PreviewEntry *entry = cache_slot(cache, &decoded->key);
+    texture_budget_track(texture.id, GetPixelDataSize(texture.width, texture.height, texture.format),
+                         texture.mipmaps, cache_evict, cache);
+    entry->used = true;
+    entry->key = decoded->key;
+    entry->last_used = ++cache->clock;
+    entry->preview.texture = texture;
+    entry->preview.original_width = decoded->original_width;
+    entry->preview.original_height = decoded->original_height;
+    entry->preview.bit_depth = decoded->bit_depth;
+}
+
+// Helper: Upload a decoded image into the cache; false if the GPU refused it
+static bool cache_upload(ImagePreviewCache *cache, DecodedImage *decoded)
+{
+    Texture2D texture = LoadTextureFromImage(decoded->image);
+    UnloadImage(decoded->image);
+    if (texture.id == 0) return false;
+    cache_insert(cache, decoded, texture);
+    return true;
+}
+
+// Helper: Start uploading a large decoded image a slice at a time into an empty
+// texture; false if the GPU refused it
+static bool upload_begin(ImagePreviewCache *cache, DecodedImage *decoded)
+{
+    Image empty = decoded->image;
+    empty.data = NULL;
+    empty.mipmaps = 1;
+    cache->partial = LoadTextureFromImage(empty);
+    if (cache->partial.id == 0) {
+        UnloadImage(decoded->image);
+        return false;
+    }
+    cache->uploading = *decoded;
+    cache->rows_uploaded = 0;
+    cache->is_uploading = true;
+    return true;
+}
+
+// Helper: Copy slices of rows while the frame's work allowance lasts (one at least);
+// after the last, build the mipmaps and cache the texture
+static void upload_continue(ImagePreviewCache *cache)
+{
+    const Image *image = &cache->uploading.image;
+    int row_bytes = GetPixelDataSize(image->width, 1, image->format);
+    int slice_rows = row_bytes > 0 ? IMAGE_PREVIEW_UPLOAD_SLICE / row_bytes : image->height;
+    if (slice_rows < 1) slice_rows = 1;
+
+    do {
+        int rows = image->height - cache->rows_uploaded;
+        if (rows > slice_rows) rows = slice_rows;
+        Rectangle slice = { 0, (float)cache->rows_uploaded, (float)image->width, (float)rows };
+        UpdateTextureRec(cache->partial, slice,
+                         (const unsigned char *)image->data + (size_t)cache->rows_uploaded * (size_t)row_bytes);
+        cache->rows_uploaded += rows;
+    } while (cache->rows_uploaded < image->height && frame_work_remaining() > 0);
+    if (cache->rows_uploaded < image->height) return;
+
+    GenTextureMipmaps(&cache->partial);
+    UnloadImage(cache->uploading.image);
+    cache_insert(cache, &cache->uploading, cache->partial);
+    cache->partial = (Texture2D){ 0 };
+    cache->is_uploading = false;
+}
+
+ImagePreviewStatus image_preview_request(ImagePreviewCache *cache, const char *path, int max_size,
+                                         ImagePreviewTexture *out)
+{
+    struct stat st;
+    if (!path || max_size <= 0 || stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        cache->status = IMAGE_PREVIEW_FAILED;
+        return cache->status;
+    }
+
+    // Smaller while the texture budget is short; a larger texture cached earlier still serves
+    ImageKey key = { .mtime = st.st_mtime, .size = st.st_size, .max_size = texture_budget_fit_edge(max_size) };
+    snprintf(key.path, sizeof(key.path), "%s", path);
+    cache->wanted = key;
+
+    PreviewEntry *entry = cache_find(cache, &key);
+    if (entry) {
+        *out = entry->preview;
+        cache->status = IMAGE_PREVIEW_READY;
+        return cache->status;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    bool in_flight = (cache->is_decoding && key_serves(&cache->decoding, &key)) ||
+                     (cache->has_done && key_serves(&cache->done.key, &key)) ||
+                     (cache->is_uploading && key_serves(&cache->uploading.key, &key));
+    // A queued request for another image is dropped
+    cache->request_pending = !in_flight;
+    if (!in_flight) {
+        cache->request = key;
+        pthread_cond_signal(&cache->work);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    cache->status = IMAGE_PREVIEW_PENDING;
+    return cache->status;
+}
+
+bool image_preview_is_cached(ImagePreviewCache *cache, const char *path, time_t mtime, off_t size,
+                             int max_size)
+{
+    if (!cache || !path) return false;
+
+    ImageKey key = { .mtime = mtime, .size = size, .max_size = max_size };
+    snprintf(key.path, sizeof(key.path), "%s", path);
+    for (int i = 0; i < IMAGE_PREVIEW_CACHE_SIZE; i++) {
+        if (cache->entries[i].used && key_serves(&cache->entries[i].key, &key)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ImagePreviewStatus image_preview_poll(ImagePreviewCache *cache, ImagePreviewTexture *out)
+{
+    bool has_done = false;
+    DecodedImage decoded;
+
+    // An image still being uploaded in slices gives way once no longer wanted
+    if (cache->is_uploading && !key_serves(&cache->uploading.key, &cache->wanted)) {
+        upload_cancel(cache);
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    if (cache->has_done && !cache->is_uploading) {
+        decoded = cache->done;
+        cache->has_done = false;
+        has_done = true;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    // Finished decodes are cached even when no longer wanted; they are likely the
+    // images just flipped past
+    if (has_done) {
+        bool ok = decoded.ok && (upload_in_slices(&decoded.image) ? upload_begin(cache, &decoded)
+                                                                  : cache_upload(cache, &decoded));
+        if (!ok && cache->status == IMAGE_PREVIEW_PENDING && key_serves(&decoded.key, &cache->wanted)) {
+            cache->status = IMAGE_PREVIEW_FAILED;
+        }
+    }
+
+    if (cache->is_uploading) {
+        upload_continue(cache);
+    }
+
+    if (cache->status == IMAGE_PREVIEW_PENDING || cache->status == IMAGE_PREVIEW_READY) {
+        PreviewEntry *entry = cache_find(cache, &cache->wanted);
+        if (entry) {
+            *out = entry->preview;
+            cache->status = IMAGE_PREVIEW_READY;
+        }
+    }
+    return cache->status;
+}
+
+bool image_preview_is_busy(ImagePreviewCache *cache)
+{
+    return cache && cache->status == IMAGE_PREVIEW_PENDING;
+}
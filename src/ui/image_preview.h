@@ -0,0 +1,61 @@
+#ifndef IMAGE_PREVIEW_H
+#define IMAGE_PREVIEW_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <time.h>
+#include "raylib.h"
+
+// Image previews for the preview pane. A worker thread decodes the image at the size the
+// pane draws it (ImageIO decodes straight to that size; other formats fall back to a
+// full stb_image decode through raylib, then a resize) and builds its mipmap chain, so a
+// 100 MP photo never reaches the main thread or the GPU at full size. The main thread
+// only uploads finished images; one larger than IMAGE_PREVIEW_UPLOAD_SLICE is copied a
+// slice of rows at a time within each frame's work allowance (utils/perf.h) and gets
+// its mipmaps from the GPU once whole. The most recent textures are kept, keyed by path,
+// modification time and size, so flipping back to an image is instant; the texture
+// budget may take back all but the last one requested
+
+#define IMAGE_PREVIEW_CACHE_SIZE 6      // Textures kept (least recently used evicted)
+#define IMAGE_PREVIEW_STB_MAX_BYTES (64 * 1024 * 1024)  // Larger files skip the full-decode fallback
+#define IMAGE_PREVIEW_UPLOAD_SLICE (2 * 1024 * 1024)    // Bytes of rows copied to the GPU at a time
+
+typedef enum ImagePreviewStatus {
+    IMAGE_PREVIEW_NONE,                 // Nothing requested
+    IMAGE_PREVIEW_PENDING,              // Being decoded
+    IMAGE_PREVIEW_READY,
+    IMAGE_PREVIEW_FAILED                // Not an image ImageIO or stb_image can read
+} ImagePreviewStatus;
+
+// A preview texture; owned by the cache, valid until the next request or poll
+typedef struct ImagePreviewTexture {
+    Texture2D texture;                  // Downsampled, mipmapped
+    int original_width;                 // Size of the image file
+    int original_height;
+    int bit_depth;                      // Bits per pixel as stored; 0 if unknown
+} ImagePreviewTexture;
+
+typedef struct ImagePreviewCache ImagePreviewCache;
+
+// Create and destroy the cache (destroy before the window closes)
+ImagePreviewCache *image_preview_create(void);
+void image_preview_destroy(ImagePreviewCache *cache);
+
+// Ask for the preview of an image with its longest side at most max_size pixels (less
+// while the texture budget is short). Ready at once if cached; otherwise it is decoded
+// in the background, replacing any earlier request. Main thread
+ImagePreviewStatus image_preview_request(ImagePreviewCache *cache, const char *path, int max_size,
+                                         ImagePreviewTexture *out);
+
+// Whether this version of an image is cached at max_size or larger, so a request is
+// ready at once (no file system access). Main thread
+bool image_preview_is_cached(ImagePreviewCache *cache, const char *path, time_t mtime, off_t size,
+                             int max_size);
+
+// Upload a finished decode and report on the last request. Main thread
+ImagePreviewStatus image_preview_poll(ImagePreviewCache *cache, ImagePreviewTexture *out);
+
+// Whether the last request is still being decoded
+bool image_preview_is_busy(ImagePreviewCache *cache);
+
+#endif // IMAGE_PREVIEW_H
@@ -1,13 +1,13 @@
 #include "palette.h"
 #include "../app.h"
 #include "../utils/font.h"
+#include "../utils/fuzzy.h"
 #include "tabs.h"
 #include "raylib.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 
 #define PALETTE_WIDTH 600
 #define PALETTE_HEIGHT 400
@@ -30,8 +30,11 @@ static void cmd_select_all(struct App *app);
 static void cmd_view_list(struct App *app);
 static void cmd_view_grid(struct App *app);
 static void cmd_view_columns(struct App *app);
+static void cmd_view_treemap(struct App *app);
 static void cmd_toggle_hidden(struct App *app);
 static void cmd_toggle_preview(struct App *app);
+static void cmd_preview_git_diff(struct App *app);
+static void cmd_preview_git_log(struct App *app);
 static void cmd_go_back(struct App *app);
 static void cmd_go_forward(struct App *app);
 static void cmd_go_parent(struct App *app);
@@ -43,6 +46,9 @@ static void cmd_toggle_sidebar(struct App *app);
 static void cmd_toggle_fullscreen(struct App *app);
 static void cmd_toggle_theme(struct App *app);
 static void cmd_show_queue(struct App *app);
+static void cmd_toggle_trace(struct App *app);
+static void cmd_save_smart_folder(struct App *app);
+static void cmd_remove_smart_folder(struct App *app);
 
 void palette_init(PaletteState *palette)
 {
@@ -79,6 +85,16 @@ void palette_register(PaletteState *palette, const char *id, const char *name,
     cmd->callback = callback;
     cmd->requires_selection = requires_selection;
 
+    const char *fields[PALETTE_MATCH_FIELDS] = { name, category, id };
+    for (int f = 0; f < PALETTE_MATCH_FIELDS; f++) {
+        size_t len = fields[f] ? strlen(fields[f]) : 0;
+        cmd->folded[f][0] = '\0';
+        if (len < PALETTE_MATCH_MAX) {
+            fuzzy_fold(cmd->folded[f], fields[f] ? fields[f] : "", len + 1);
+        }
+        cmd->masks[f] = fields[f] ? fuzzy_char_mask(fields[f]) : 0;
+    }
+
     palette->command_count++;
 }
 
@@ -102,8 +118,11 @@ void palette_register_builtins(PaletteState *palette)
     palette_register(palette, "view.list", "List View", "View", "Cmd+1", cmd_view_list, false);
     palette_register(palette, "view.grid", "Grid View", "View", "Cmd+2", cmd_view_grid, false);
     palette_register(palette, "view.columns", "Column View", "View", "Cmd+3", cmd_view_columns, false);
+    palette_register(palette, "view.treemap", "Disk Usage View", "View", "Cmd+4", cmd_view_treemap, false);
     palette_register(palette, "view.hidden", "Toggle Hidden Files", "View", "Cmd+.", cmd_toggle_hidden, false);
     palette_register(palette, "view.preview", "Toggle Preview", "View", "Cmd+Shift+P", cmd_toggle_preview, false);
+    palette_register(palette, "view.git_diff", "Toggle Preview Git Diff", "View", NULL, cmd_preview_git_diff, false);
+    palette_register(palette, "view.git_history", "Toggle Preview Git History", "View", NULL, cmd_preview_git_log, false);
     palette_register(palette, "view.sidebar", "Toggle Sidebar", "View", "Cmd+\\", cmd_toggle_sidebar, false);
     palette_register(palette, "view.fullscreen", "Toggle Fullscreen", "View", "Cmd+Enter", cmd_toggle_fullscreen, false);
     palette_register(palette, "view.theme", "Toggle Theme", "View", NULL, cmd_toggle_theme, false);
@@ -115,12 +134,17 @@ void palette_register_builtins(PaletteState *palette)
     palette_register(palette, "nav.home", "Go to Home", "Navigate", "Cmd+Shift+H", cmd_go_home, false);
     palette_register(palette, "nav.refresh", "Refresh", "Navigate", "Cmd+R", cmd_refresh, false);
 
+    // Search commands
+    palette_register(palette, "search.save_smart_folder", "Save Search as Smart Folder", "Search", NULL, cmd_save_smart_folder, false);
+    palette_register(palette, "search.remove_smart_folder", "Remove Smart Folder", "Search", NULL, cmd_remove_smart_folder, false);
+
     // Tab commands
     palette_register(palette, "tab.new", "New Tab", "Tab", "Cmd+T", cmd_new_tab, false);
     palette_register(palette, "tab.close", "Close Tab", "Tab", "Cmd+W", cmd_close_tab, false);
 
     // Window commands
     palette_register(palette, "window.queue", "Show Operation Queue", "Window", "Cmd+Shift+Q", cmd_show_queue, false);
+    palette_register(palette, "window.trace", "Start/Stop Trace Recording", "Window", "Cmd+Alt+Shift+P", cmd_toggle_trace, false);
 }
 
 void palette_show(PaletteState *palette)
@@ -174,51 +198,12 @@ int palette_fuzzy_score(const char *query, const char *text)
         return 0; // NULL inputs return 0
     }
     if (query[0] == '\0') {
-        return text ? 1 : 0; // Empty query matches everything with low score
+        return 1; // Empty query matches everything with low score
     }
 
-    int score = 0;
-    int consecutive = 0;
-    int query_len = (int)strlen(query);
-    int text_len = (int)strlen(text);
-    int qi = 0;
-
-    for (int ti = 0; ti < text_len && qi < query_len; ti++) {
-        char qc = (char)tolower(query[qi]);
-        char tc = (char)tolower(text[ti]);
-
-        if (qc == tc) {
-            // Match found
-            score += 10;
-
-            // Bonus for consecutive matches
-            if (consecutive > 0) {
-                score += consecutive * 5;
-            }
-            consecutive++;
-
-            // Bonus for word start match
-            if (ti == 0 || text[ti - 1] == ' ' || text[ti - 1] == '_' || text[ti - 1] == '-') {
-                score += 15;
-            }
-
-            // Bonus for exact case match
-            if (query[qi] == text[ti]) {
-                score += 2;
-            }
-
-            qi++;
-        } else {
-            consecutive = 0;
-        }
-    }
-
-    // Return 0 if not all query chars matched
-    if (qi < query_len) {
-        return 0;
-    }
-
-    return score;
+    FuzzyQuery compiled;
+    fuzzy_compile(&compiled, query, false);
+    return fuzzy_score(&compiled, text, NULL, -1, NULL, 0, NULL);
 }
 
 void palette_filter(PaletteState *palette)
@@ -228,17 +213,25 @@ void palette_filter(PaletteState *palette)
     // Store scores for sorting
     int scores[PALETTE_MAX_COMMANDS];
 
+    // Compiled once per keystroke; an empty query matches everything with low score
+    FuzzyQuery query;
+    bool has_query = fuzzy_compile(&query, palette->input, false);
+
     for (int i = 0; i < palette->command_count; i++) {
         PaletteCommand *cmd = &palette->commands[i];
+        const char *fields[PALETTE_MATCH_FIELDS] = { cmd->name, cmd->category, cmd->id };
 
-        // Calculate score against name, category, and ID
-        int name_score = palette_fuzzy_score(palette->input, cmd->name);
-        int cat_score = palette_fuzzy_score(palette->input, cmd->category);
-        int id_score = palette_fuzzy_score(palette->input, cmd->id);
-
-        int best_score = name_score;
-        if (cat_score > best_score) best_score = cat_score;
-        if (id_score > best_score) best_score = id_score;
+        // Best score against name, category, and ID
+        int best_score = has_query ? 0 : 1;
+        for (int f = 0; has_query && f < PALETTE_MATCH_FIELDS; f++) {
+            if (!fields[f] || !fuzzy_may_match(&query, cmd->masks[f])) {
+                continue;
+            }
+            int len = (int)strlen(fields[f]);
+            const char *folded = len < PALETTE_MATCH_MAX ? cmd->folded[f] : NULL;
+            int score = fuzzy_score(&query, fields[f], folded, len, NULL, 0, NULL);
+            if (score > best_score) best_score = score;
+        }
 
         if (best_score > 0) {
             // Boost recent commands
@@ -537,34 +530,25 @@ static void cmd_open(struct App *app)
 {
     if (app->selected_index >= 0 && app->selected_index < app->directory.count) {
         FileEntry *entry = &app->directory.entries[app->selected_index];
-        if (entry->is_directory) {
+        if (directory_entry_enterable(&app->directory, entry)) {
             directory_enter(&app->directory, app->selected_index);
         }
     }
 }
 
-// Helper to collect selected paths and perform clipboard operation
+// Helper to put the selection (or the entry under the cursor) on the clipboard
 static void copy_or_cut_selected(struct App *app, bool is_cut)
 {
-    const char *paths[MAX_SELECTION];
-    int count = 0;
-
     if (app->selection.count > 0) {
-        for (int i = 0; i < app->selection.count && i < MAX_SELECTION; i++) {
-            int idx = app->selection.indices[i];
-            if (idx >= 0 && idx < app->directory.count) {
-                paths[count++] = app->directory.entries[idx].path;
-            }
-        }
+        app_clipboard_take_selection(app, is_cut ? OP_CUT : OP_COPY);
     } else if (app->selected_index >= 0 && app->selected_index < app->directory.count) {
-        paths[count++] = app->directory.entries[app->selected_index].path;
-    }
-
-    if (count > 0) {
+        char path[PATH_MAX_LEN];
+        const char *paths[] = { directory_entry_path(&app->directory, &app->directory.entries[app->selected_index],
+                                                     path, sizeof(path)) };
         if (is_cut) {
-            clipboard_cut(&app->clipboard, paths, count);
+            clipboard_cut(&app->clipboard, paths, 1);
         } else {
-            clipboard_copy(&app->clipboard, paths, count);
+            clipboard_copy(&app->clipboard, paths, 1);
         }
     }
 }
@@ -575,7 +559,7 @@ static void cmd_cut(struct App *app) { copy_or_cut_selected(app, true); }
 static void cmd_paste(struct App *app)
 {
     if (clipboard_has_items(&app->clipboard)) {
-        clipboard_paste(&app->clipboard, app->directory.current_path);
+        operation_queue_paste(&app->op_queue, &app->clipboard, app->directory.current_path);
         directory_read(&app->directory, app->directory.current_path);
     }
 }
@@ -583,15 +567,12 @@ static void cmd_paste(struct App *app)
 static void cmd_delete(struct App *app)
 {
     if (app->selection.count > 0) {
-        for (int i = 0; i < app->selection.count; i++) {
-            int idx = app->selection.indices[i];
-            if (idx >= 0 && idx < app->directory.count) {
-                file_delete(app->directory.entries[idx].path);
-            }
-        }
+        app_trash_selection(app);
         selection_clear(&app->selection);
     } else if (app->selected_index >= 0 && app->selected_index < app->directory.count) {
-        file_delete(app->directory.entries[app->selected_index].path);
+        char path[PATH_MAX_LEN];
+        file_delete(directory_entry_path(&app->directory, &app->directory.entries[app->selected_index],
+                                         path, sizeof(path)));
     }
     directory_read(&app->directory, app->directory.current_path);
 }
@@ -601,7 +582,9 @@ static void cmd_rename(struct App *app)
     if (app->selected_index >= 0 && app->selected_index < app->directory.count) {
         app->rename_mode = true;
         app->rename_index = app->selected_index;
-        strncpy(app->rename_buffer, app->directory.entries[app->selected_index].name, NAME_MAX_LEN - 1);
+        strncpy(app->rename_buffer,
+                directory_entry_name(&app->directory, &app->directory.entries[app->selected_index]),
+                NAME_MAX_LEN - 1);
         app->rename_cursor = (int)strlen(app->rename_buffer);
     }
 }
@@ -609,7 +592,9 @@ static void cmd_rename(struct App *app)
 static void cmd_duplicate(struct App *app)
 {
     if (app->selected_index >= 0 && app->selected_index < app->directory.count) {
-        file_duplicate(app->directory.entries[app->selected_index].path);
+        char path[PATH_MAX_LEN];
+        file_duplicate(directory_entry_path(&app->directory, &app->directory.entries[app->selected_index],
+                                            path, sizeof(path)));
         directory_read(&app->directory, app->directory.current_path);
     }
 }
@@ -634,6 +619,11 @@ static void cmd_view_columns(struct App *app)
     app->view_mode = VIEW_COLUMN;
 }
 
+static void cmd_view_treemap(struct App *app)
+{
+    app->view_mode = VIEW_TREEMAP;
+}
+
 static void cmd_toggle_hidden(struct App *app)
 {
     directory_toggle_hidden(&app->directory);
@@ -644,6 +634,20 @@ static void cmd_toggle_preview(struct App *app)
     app->preview.visible = !app->preview.visible;
 }
 
+static void cmd_preview_git_diff(struct App *app)
+{
+    PreviewGitView view = app->preview.git_view == PREVIEW_GIT_DIFF ? PREVIEW_GIT_OFF : PREVIEW_GIT_DIFF;
+    preview_set_git_view(&app->preview, view);
+    app->preview.visible = true;
+}
+
+static void cmd_preview_git_log(struct App *app)
+{
+    PreviewGitView view = app->preview.git_view == PREVIEW_GIT_LOG ? PREVIEW_GIT_OFF : PREVIEW_GIT_LOG;
+    preview_set_git_view(&app->preview, view);
+    app->preview.visible = true;
+}
+
 static void cmd_go_back(struct App *app)
 {
     const char *path = history_back(&app->history);
@@ -677,6 +681,10 @@ static void cmd_go_home(struct App *app)
 
 static void cmd_refresh(struct App *app)
 {
+    if (app->smart_folder_open >= 0 && app_open_smart_folder(app, app->smart_folder_open)) {
+        return;
+    }
+    app->smart_folder_open = -1;
     directory_read(&app->directory, app->directory.current_path);
 }
 
@@ -711,3 +719,18 @@ static void cmd_show_queue(struct App *app)
 {
     queue_panel_toggle(&app->queue_panel);
 }
+
+static void cmd_toggle_trace(struct App *app)
+{
+    app_toggle_trace(app);
+}
+
+static void cmd_save_smart_folder(struct App *app)
+{
+    app_save_search_as_smart_folder(app);
+}
+
+static void cmd_remove_smart_folder(struct App *app)
+{
+    app_remove_smart_folder(app);
+}
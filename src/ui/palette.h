@@ -2,11 +2,14 @@
 #define PALETTE_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #define PALETTE_MAX_COMMANDS 128
 #define PALETTE_MAX_RECENT 10
 #define PALETTE_INPUT_MAX 256
 #define PALETTE_VISIBLE_ITEMS 12
+#define PALETTE_MATCH_FIELDS 3      // Name, category and ID
+#define PALETTE_MATCH_MAX 64        // Longer fields are folded while matching
 
 // Forward declaration
 struct App;
@@ -22,6 +25,10 @@ typedef struct PaletteCommand {
     const char *shortcut;       // Keyboard shortcut string (e.g., "Cmd+N")
     CommandCallback callback;   // Function to execute
     bool requires_selection;    // Requires file selection to work
+
+    // Match keys built at registration, one per field
+    char folded[PALETTE_MATCH_FIELDS][PALETTE_MATCH_MAX];
+    uint64_t masks[PALETTE_MATCH_FIELDS];
 } PaletteCommand;
 
 // Command palette state
@@ -0,0 +1,463 @@
+#include "pdf_preview.h"
+#include "../platform/pdf.h"
+#include "../utils/perf.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Rendered pages waiting to be uploaded; the worker waits when this many are
+#define PDF_PREVIEW_DONE 4
+
+// page_widths of a page whose texture the texture budget took back
+#define PDF_PAGE_EVICTED -1
+
+// A page rendered by the worker
+typedef struct RenderedPage {
+    int page;
+    int width;                          // View width it was rendered for
+    Image image;                        // RGBA
+} RenderedPage;
+
+// A page texture (main thread only)
+typedef struct PageTexture {
+    bool used;
+    int page;
+    int width;                          // View width it was rendered for
+    uint64_t last_used;
+    Texture2D texture;
+} PageTexture;
+
+struct PdfPreview {
+    pthread_mutex_t mutex;
+    pthread_cond_t work;                // A document or view arrived, a page was taken, or stopping
+    pthread_t thread;
+    bool thread_started;
+    bool stopping;
+
+    // Guarded by mutex
+    char path[4096];
+    uint64_t document;                  // Bumped for each document opened
+    bool open_pending;
+    bool opening;
+    int page_count;                     // 0 until opened, -1 on failure
+    float *page_sizes;                  // Width and height of each page, in points
+    int *page_widths;                   // View width each page is rendered or being rendered at (0: none,
+                                        // PDF_PAGE_EVICTED: none, and not prefetched)
+    int view_first;
+    int view_last;
+    int view_width;
+    bool rendering;
+    RenderedPage done[PDF_PREVIEW_DONE];
+    int done_count;
+
+    // Main thread only
+    int pages;                          // Copy of page_count once taken
+    float *sizes;                       // Copy of page_sizes
+    PageTexture textures[PDF_PREVIEW_CACHE_PAGES];
+    uint64_t clock;
+};
+
+// Helper: The next page to render: those in view in order, then their neighbors nearest
+// first; -1 when all are done (call with mutex held)
+static int next_page(const PdfPreview *pdf)
+{
+    if (pdf->page_count <= 0 || pdf->view_width <= 0 || pdf->view_first > pdf->view_last) {
+        return -1;
+    }
+    for (int page = pdf->view_first; page <= pdf->view_last; page++) {
+        if (page >= 0 && page < pdf->page_count && pdf->page_widths[page] != pdf->view_width) {
+            return page;
+        }
+    }
+    for (int k = 1; k <= PDF_PREVIEW_PREFETCH; k++) {
+        int after = pdf->view_last + k;
+        int before = pdf->view_first - k;
+        // Pages the texture budget took back wait until they are in view
+        if (after < pdf->page_count && pdf->page_widths[after] != pdf->view_width &&
+            pdf->page_widths[after] != PDF_PAGE_EVICTED) {
+            return after;
+        }
+        if (before >= 0 && pdf->page_widths[before] != pdf->view_width &&
+            pdf->page_widths[before] != PDF_PAGE_EVICTED) {
+            return before;
+        }
+    }
+    return -1;
+}
+
+// Helper: Drop the document, its page sizes and pages waiting to be uploaded (call with
+// mutex held)
+static void forget_document(PdfPreview *pdf)
+{
+    free(pdf->page_sizes);
+    free(pdf->page_widths);
+    pdf->page_sizes = NULL;
+    pdf->page_widths = NULL;
+    pdf->page_count = 0;
+    for (int i = 0; i < pdf->done_count; i++) {
+        UnloadImage(pdf->done[i].image);
+    }
+    pdf->done_count = 0;
+}
+
+// Helper: Open a document and read its page sizes (slow: runs without the lock); the
+// count is -1 if it cannot be read
+static PlatformPdf *open_document(const char *path, int *count, float **sizes, int **widths)
+{
+    *count = -1;
+    *sizes = NULL;
+    *widths = NULL;
+    PlatformPdf *document = platform_pdf_open(path);
+    int pages = platform_pdf_page_count(document);
+    if (pages <= 0) {
+        platform_pdf_close(document);
+        return NULL;
+    }
+
+    *sizes = malloc((size_t)pages * 2 * sizeof(float));
+    *widths = calloc((size_t)pages, sizeof(int));
+    if (*sizes == NULL || *widths == NULL) {
+        free(*sizes);
+        free(*widths);
+        *sizes = NULL;
+        *widths = NULL;
+        platform_pdf_close(document);
+        return NULL;
+    }
+    for (int page = 0; page < pages; page++) {
+        float *size = *sizes + page * 2;
+        if (!platform_pdf_page_size(document, page, &size[0], &size[1])) {
+            // Unreadable pages keep the letter size, drawn blank
+            size[0] = 612.0f;
+            size[1] = 792.0f;
+        }
+    }
+    *count = pages;
+    return document;
+}
+
+// Helper: Render a page for a view width, kept under PDF_PREVIEW_MAX_HEIGHT (slow: runs
+// without the lock)
+static Image render_page(PlatformPdf *document, int page, int view_width, const float *size)
+{
+    int width = view_width;
+    if (size[0] > 0 && width * size[1] / size[0] > PDF_PREVIEW_MAX_HEIGHT) {
+        width = (int)(PDF_PREVIEW_MAX_HEIGHT * size[0] / size[1]);
+        if (width < 1) width = 1;
+    }
+
+    unsigned char *rgba = NULL;
+    int out_width = 0;
+    int out_height = 0;
+    if (!platform_pdf_render_page(document, page, width, &rgba, &out_width, &out_height)) {
+        return (Image){ 0 };
+    }
+    return (Image){ .data = rgba, .width = out_width, .height = out_height, .mipmaps = 1,
+                    .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+}
+
+// Thread function: Open the latest document, then render the pages the view wants
+static void *render_thread(void *arg)
+{
+    PdfPreview *pdf = (PdfPreview *)arg;
+    PlatformPdf *document = NULL;
+    uint64_t document_id = 0;
+    char path[4096];
+
+    pthread_mutex_lock(&pdf->mutex);
+    while (!pdf->stopping) {
+        if (pdf->open_pending) {
+            snprintf(path, sizeof(path), "%s", pdf->path);
+            uint64_t id = pdf->document;
+            pdf->open_pending = false;
+            pdf->opening = true;
+            pthread_mutex_unlock(&pdf->mutex);
+
+            platform_pdf_close(document);
+            int count;
+            float *sizes;
+            int *widths;
+            document = open_document(path, &count, &sizes, &widths);
+            document_id = id;
+
+            pthread_mutex_lock(&pdf->mutex);
+            pdf->opening = false;
+            if (pdf->document == id) {
+                forget_document(pdf);
+                pdf->page_count = count;
+                pdf->page_sizes = sizes;
+                pdf->page_widths = widths;
+            } else {
+                free(sizes);
+                free(widths);
+            }
+            continue;
+        }
+
+        int page = document != NULL && document_id == pdf->document && pdf->done_count < PDF_PREVIEW_DONE
+            ? next_page(pdf) : -1;
+        if (page < 0) {
+            pthread_cond_wait(&pdf->work, &pdf->mutex);
+            continue;
+        }
+
+        int width = pdf->view_width;
+        float size[2] = { pdf->page_sizes[page * 2], pdf->page_sizes[page * 2 + 1] };
+        pdf->page_widths[page] = width;
+        pdf->rendering = true;
+        pthread_mutex_unlock(&pdf->mutex);
+
+        Image image = render_page(document, page, width, size);
+
+        pthread_mutex_lock(&pdf->mutex);
+        pdf->rendering = false;
+        if (document_id != pdf->document || image.data == NULL) {
+            // Another document, or a page that will not render; it is not tried again
+            UnloadImage(image);
+            continue;
+        }
+        pdf->done[pdf->done_count++] = (RenderedPage){ page, width, image };
+    }
+    pthread_mutex_unlock(&pdf->mutex);
+
+    platform_pdf_close(document);
+    return NULL;
+}
+
+PdfPreview *pdf_preview_create(void)
+{
+    PdfPreview *pdf = (PdfPreview *)calloc(1, sizeof(PdfPreview));
+    if (!pdf) return NULL;
+
+    pthread_mutex_init(&pdf->mutex, NULL);
+    pthread_cond_init(&pdf->work, NULL);
+    if (pthread_create(&pdf->thread, NULL, render_thread, pdf) != 0) {
+        pthread_cond_destroy(&pdf->work);
+        pthread_mutex_destroy(&pdf->mutex);
+        free(pdf);
+        return NULL;
+    }
+    pdf->thread_started = true;
+    return pdf;
+}
+
+// Helper: Unload every page texture (main thread)
+static void unload_textures(PdfPreview *pdf)
+{
+    for (int i = 0; i < PDF_PREVIEW_CACHE_PAGES; i++) {
+        if (pdf->textures[i].used) {
+            texture_budget_untrack(pdf->textures[i].texture.id);
+            UnloadTexture(pdf->textures[i].texture);
+            pdf->textures[i].used = false;
+        }
+    }
+}
+
+void pdf_preview_destroy(PdfPreview *pdf)
+{
+    if (!pdf) return;
+
+    if (pdf->thread_started) {
+        pthread_mutex_lock(&pdf->mutex);
+        pdf->stopping = true;
+        pthread_cond_broadcast(&pdf->work);
+        pthread_mutex_unlock(&pdf->mutex);
+        pthread_join(pdf->thread, NULL);
+    }
+
+    forget_document(pdf);
+    unload_textures(pdf);
+    free(pdf->sizes);
+    pthread_cond_destroy(&pdf->work);
+    pthread_mutex_destroy(&pdf->mutex);
+    free(pdf);
+}
+
+void pdf_preview_open(PdfPreview *pdf, const char *path)
+{
+    if (!pdf || !path) return;
+
+    unload_textures(pdf);
+    free(pdf->sizes);
+    pdf->sizes = NULL;
+    pdf->pages = 0;
+
+    pthread_mutex_lock(&pdf->mutex);
+    forget_document(pdf);
+    snprintf(pdf->path, sizeof(pdf->path), "%s", path);
+    pdf->document++;
+    pdf->open_pending = true;
+    pdf->view_first = 0;
+    pdf->view_last = -1;
+    pdf->view_width = 0;
+    pthread_cond_signal(&pdf->work);
+    pthread_mutex_unlock(&pdf->mutex);
+}
+
+int pdf_preview_page_count(PdfPreview *pdf)
+{
+    return pdf ? pdf->pages : -1;
+}
+
+bool pdf_preview_page_size(PdfPreview *pdf, int page, float *width, float *height)
+{
+    if (!pdf || !pdf->sizes || page < 0 || page >= pdf->pages) return false;
+    *width = pdf->sizes[page * 2];
+    *height = pdf->sizes[page * 2 + 1];
+    return true;
+}
+
+void pdf_preview_set_view(PdfPreview *pdf, int first, int last, int width)
+{
+    if (!pdf) return;
+
+    // Never more pages than there are textures for, so a page in view is not reused
+    // for one beside it
+    int most = PDF_PREVIEW_CACHE_PAGES - PDF_PREVIEW_PREFETCH * 2;
+    if (last - first + 1 > most) {
+        last = first + most - 1;
+    }
+
+    pthread_mutex_lock(&pdf->mutex);
+    if (first != pdf->view_first || last != pdf->view_last || width != pdf->view_width) {
+        pdf->view_first = first;
+        pdf->view_last = last;
+        pdf->view_width = width;
+        pthread_cond_signal(&pdf->work);
+    }
+    pthread_mutex_unlock(&pdf->mutex);
+}
+
+bool pdf_preview_get_page(PdfPreview *pdf, int page, Texture2D *texture)
+{
+    if (!pdf) return false;
+
+    for (int i = 0; i < PDF_PREVIEW_CACHE_PAGES; i++) {
+        PageTexture *entry = &pdf->textures[i];
+        if (entry->used && entry->page == page) {
+            entry->last_used = ++pdf->clock;
+            *texture = entry->texture;
+            texture_budget_touch(entry->texture.id);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Helper: Slot for a page's texture: the one holding the page already, else empty,
+// else the least recently drawn, whose page is then rendered again if it comes back
+static PageTexture *texture_slot(PdfPreview *pdf, int page)
+{
+    PageTexture *slot = NULL;
+    for (int i = 0; i < PDF_PREVIEW_CACHE_PAGES; i++) {
+        PageTexture *entry = &pdf->textures[i];
+        if (entry->used && entry->page == page) {
+            slot = entry;
+            break;
+        }
+        if (!slot || (slot->used && (!entry->used || entry->last_used < slot->last_used))) {
+            slot = entry;
+        }
+    }
+    if (slot->used) {
+        texture_budget_untrack(slot->texture.id);
+        UnloadTexture(slot->texture);
+        slot->used = false;
+        if (slot->page != page) {
+            pthread_mutex_lock(&pdf->mutex);
+            if (pdf->page_widths && slot->page < pdf->page_count &&
+                pdf->page_widths[slot->page] == slot->width) {
+                pdf->page_widths[slot->page] = 0;
+            }
+            pthread_mutex_unlock(&pdf->mutex);
+        }
+    }
+    return slot;
+}
+
+// Helper: Give a page texture back to the texture budget, unless the page is in view
+static bool texture_evict(void *owner, unsigned int id)
+{
+    PdfPreview *pdf = (PdfPreview *)owner;
+    for (int i = 0; i < PDF_PREVIEW_CACHE_PAGES; i++) {
+        PageTexture *entry = &pdf->textures[i];
+        if (!entry->used || entry->texture.id != id) continue;
+
+        pthread_mutex_lock(&pdf->mutex);
+        bool in_view = entry->page >= pdf->view_first && entry->page <= pdf->view_last;
+        if (!in_view && pdf->page_widths && entry->page < pdf->page_count &&
+            pdf->page_widths[entry->page] == entry->width) {
+            pdf->page_widths[entry->page] = PDF_PAGE_EVICTED;
+        }
+        pthread_mutex_unlock(&pdf->mutex);
+        if (in_view) return false;
+
+        UnloadTexture(entry->texture);
+        entry->used = false;
+        return true;
+    }
+    return true;
+}
+
+bool pdf_preview_poll(PdfPreview *pdf)
+{
+    if (!pdf) return false;
+
+    bool changed = false;
+    RenderedPage done[PDF_PREVIEW_DONE];
+    int done_count;
+
+    pthread_mutex_lock(&pdf->mutex);
+    if (pdf->pages == 0 && pdf->page_count != 0 && !pdf->open_pending) {
+        pdf->pages = pdf->page_count;
+        if (pdf->page_count > 0) {
+            size_t bytes = (size_t)pdf->page_count * 2 * sizeof(float);
+            pdf->sizes = malloc(bytes);
+            if (pdf->sizes) {
+                memcpy(pdf->sizes, pdf->page_sizes, bytes);
+            } else {
+                pdf->pages = -1;
+            }
+        }
+        changed = true;
+    }
+    done_count = pdf->done_count;
+    memcpy(done, pdf->done, (size_t)done_count * sizeof(RenderedPage));
+    pdf->done_count = 0;
+    if (done_count > 0) {
+        pthread_cond_signal(&pdf->work);
+    }
+    pthread_mutex_unlock(&pdf->mutex);
+
+    for (int i = 0; i < done_count; i++) {
+        Texture2D texture = LoadTextureFromImage(done[i].image);
+        UnloadImage(done[i].image);
+        if (texture.id == 0) continue;
+        SetTextureFilter(texture, TEXTURE_FILTER_BILINEAR);
+
+        PageTexture *slot = texture_slot(pdf, done[i].page);
+        texture_budget_track(texture.id, GetPixelDataSize(texture.width, texture.height, texture.format),
+                             texture.mipmaps, texture_evict, pdf);
+        slot->used = true;
+        slot->page = done[i].page;
+        slot->width = done[i].width;
+        slot->last_used = ++pdf->clock;
+        slot->texture = texture;
+        changed = true;
+    }
+    return changed;
+}
+
+bool pdf_preview_is_busy(PdfPreview *pdf)
+{
+    if (!pdf) return false;
+
+    pthread_mutex_lock(&pdf->mutex);
+    bool busy = pdf->open_pending || pdf->opening || pdf->rendering || pdf->done_count > 0 ||
+                (pdf->pages == 0 && pdf->page_count != 0) || next_page(pdf) >= 0;
+    pthread_mutex_unlock(&pdf->mutex);
+    return busy;
+}
@@ -0,0 +1,48 @@
+#ifndef PDF_PREVIEW_H
+#define PDF_PREVIEW_H
+
+#include <stdbool.h>
+#include "raylib.h"
+
+// PDF previews for the preview pane. A worker thread opens the document and reads its
+// page sizes, so the pane can lay out every page at once, then renders only the pages
+// in view, at the width they are drawn, followed by a few on either side. The main
+// thread uploads finished pages into a small set of page textures, reusing the one
+// least recently drawn, so a 500-page manual costs what is on screen. Pages out of view
+// may also be taken back by the texture budget; they are rendered again once in view
+
+#define PDF_PREVIEW_CACHE_PAGES 12      // Page textures kept (least recently drawn reused)
+#define PDF_PREVIEW_PREFETCH 2          // Pages rendered ahead of and behind the view
+#define PDF_PREVIEW_MAX_HEIGHT 8192     // Tallest page texture, in pixels
+
+typedef struct PdfPreview PdfPreview;
+
+// Create and destroy the previewer (destroy before the window closes)
+PdfPreview *pdf_preview_create(void);
+void pdf_preview_destroy(PdfPreview *pdf);
+
+// Show another document, dropping the pages of the last one. Main thread
+void pdf_preview_open(PdfPreview *pdf, const char *path);
+
+// Pages of the document: 0 while it is being opened, -1 if it cannot be read
+int pdf_preview_page_count(PdfPreview *pdf);
+
+// Size of a page (from 0) in points, upright; false before the document is open
+bool pdf_preview_page_size(PdfPreview *pdf, int page, float *width, float *height);
+
+// Pages first..last are on screen, drawn width pixels wide; they are rendered first,
+// in order, then their neighbors. Main thread
+void pdf_preview_set_view(PdfPreview *pdf, int first, int last, int width);
+
+// The texture of a page if one has been rendered, at the view's width or, while that
+// renders, an earlier one. Main thread
+bool pdf_preview_get_page(PdfPreview *pdf, int page, Texture2D *texture);
+
+// Take the opened document and upload rendered pages; true if anything changed. Main
+// thread
+bool pdf_preview_poll(PdfPreview *pdf);
+
+// Whether the document is being opened or pages in view are being rendered
+bool pdf_preview_is_busy(PdfPreview *pdf);
+
+#endif // PDF_PREVIEW_H
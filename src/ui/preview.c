@@ -3,15 +3,27 @@
 #include "tabs.h"
 #include "sidebar.h"
 #include "browser.h"
+#include "image_preview.h"
+#include "pdf_preview.h"
+#include "preview_loader.h"
+#include "thumbnails.h"
 #include "../app.h"
 #include "../core/filesystem.h"
+#include "../core/archive.h"
 #include "../core/search.h"
+#include "../core/text_map.h"
+#include "../core/git_preview.h"
 #include "../ai/summarize.h"
 #include "../utils/theme.h"
 #include "../utils/text.h"
 #include "../utils/font.h"
+#include "../utils/syntax.h"
 #include "../api/gemini_client.h"
+#include "../api/image_upload.h"
 #include "../api/auth.h"
+#include "../platform/video_decode.h"
+#include "../utils/perf.h"
+#include "../utils/trace.h"
 #include "raylib.h"
 
 #include <stdio.h>
@@ -19,13 +31,12 @@
 #include <string.h>
 #include <ctype.h>
 #include <sys/wait.h>
-#include <stdatomic.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
 
-// Maximum text preview size (1MB)
-#define MAX_TEXT_SIZE (1024 * 1024)
+// Text read for the prose view (well over MAX_PREVIEW_WORDS words)
+#define PROSE_TEXT_SIZE (64 * 1024)
 
 // Maximum words to show in PREVIEW_TEXT (prose view)
 #define MAX_PREVIEW_WORDS 300
@@ -33,27 +44,6 @@
 // Maximum lines to display
 #define MAX_PREVIEW_LINES 1000
 
-// Helper: Get bit depth from Raylib pixel format
-static int preview_get_bit_depth_from_format(int format)
-{
-    switch (format) {
-        case PIXELFORMAT_UNCOMPRESSED_GRAYSCALE: return 8;
-        case PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA: return 16;
-        case PIXELFORMAT_UNCOMPRESSED_R5G6B5: return 16;
-        case PIXELFORMAT_UNCOMPRESSED_R8G8B8: return 24;
-        case PIXELFORMAT_UNCOMPRESSED_R5G5B5A1: return 16;
-        case PIXELFORMAT_UNCOMPRESSED_R4G4B4A4: return 16;
-        case PIXELFORMAT_UNCOMPRESSED_R8G8B8A8: return 32;
-        case PIXELFORMAT_UNCOMPRESSED_R32: return 32;
-        case PIXELFORMAT_UNCOMPRESSED_R32G32B32: return 96;
-        case PIXELFORMAT_UNCOMPRESSED_R32G32B32A32: return 128;
-        case PIXELFORMAT_UNCOMPRESSED_R16: return 16;
-        case PIXELFORMAT_UNCOMPRESSED_R16G16B16: return 48;
-        case PIXELFORMAT_UNCOMPRESSED_R16G16B16A16: return 64;
-        default: return 0;  // Unknown/compressed
-    }
-}
-
 // Helper: Extract format string from file extension
 static void preview_extract_format_from_extension(const char *ext, char *format_out, size_t format_size)
 {
@@ -69,46 +59,81 @@ static void preview_extract_format_from_extension(const char *ext, char *format_
     format_out[len] = '\0';
 }
 
-// Video decode thread function - continuously reads frames from ffmpeg
+// Helper: Longest side images and video frames are decoded at: the widest pane, in pixels
+static int preview_image_size(void)
+{
+    Vector2 dpi = GetWindowScaleDPI();
+    float scale = dpi.x > 1.0f ? dpi.x : 1.0f;
+    return (int)(PREVIEW_MAX_WIDTH * scale);
+}
+
+// YUV to RGB for ffmpeg frames (yuv420p, BT.601 limited range); texture0 is the Y plane
+static const char *YUV_FRAGMENT_SHADER =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "uniform sampler2D textureU;\n"
+    "uniform sampler2D textureV;\n"
+    "out vec4 finalColor;\n"
+    "void main()\n"
+    "{\n"
+    "    float y = 1.1644 * (texture(texture0, fragTexCoord).r - 0.0627);\n"
+    "    float u = texture(textureU, fragTexCoord).r - 0.5;\n"
+    "    float v = texture(textureV, fragTexCoord).r - 0.5;\n"
+    "    vec3 rgb = vec3(y + 1.5960 * v, y - 0.3918 * u - 0.8130 * v, y + 2.0172 * u);\n"
+    "    finalColor = vec4(clamp(rgb, 0.0, 1.0), 1.0) * fragColor;\n"
+    "}\n";
+
+// Shader drawing YUV frames, loaded on first use
+static struct {
+    bool loaded;
+    Shader shader;
+    int loc_u;
+    int loc_v;
+} g_yuv;
+
+// Video decode thread function - reads frames from ffmpeg into the back slot and hands
+// each one over by swapping it with the shared slot
 static void *video_decode_thread(void *arg)
 {
     PreviewState *preview = (PreviewState *)arg;
-    size_t frame_size = preview->video_frame_width * preview->video_frame_height * 3;
+    size_t frame_size = video_frame_size(preview->video_frame_width, preview->video_frame_height);
     size_t bytes_read = 0;
 
-    while (preview->video_thread_running) {
-        // Wait while paused
-        while (preview->video_paused && preview->video_thread_running) {
-            usleep(50000);  // Check every 50ms
+    while (atomic_load(&preview->video_thread_running)) {
+        // Sleep while paused, until resumed or stopped
+        pthread_mutex_lock(&preview->video_mutex);
+        while (preview->video_paused && atomic_load(&preview->video_thread_running)) {
+            pthread_cond_wait(&preview->video_resume, &preview->video_mutex);
         }
-        if (!preview->video_thread_running) break;
+        pthread_mutex_unlock(&preview->video_mutex);
+        if (!atomic_load(&preview->video_thread_running)) break;
 
         // Read a complete frame (blocking read in thread is fine)
-        while (bytes_read < frame_size && preview->video_thread_running) {
-            ssize_t n = read(preview->video_pipe_fd,
-                           preview->video_decode_buffer + bytes_read,
-                           frame_size - bytes_read);
+        unsigned char *back = preview->video_frames[preview->video_frame_back];
+        while (bytes_read < frame_size && atomic_load(&preview->video_thread_running)) {
+            ssize_t n = read(preview->video_pipe_fd, back + bytes_read, frame_size - bytes_read);
             if (n > 0) {
                 bytes_read += n;
             } else if (n == 0) {
                 // EOF - video ended
-                preview->video_eof = true;
+                atomic_store(&preview->video_eof, true);
                 return NULL;
             } else {
                 // Error (but not EAGAIN since we're blocking)
                 if (errno != EINTR) {
-                    preview->video_eof = true;
+                    atomic_store(&preview->video_eof, true);
                     return NULL;
                 }
             }
         }
 
         if (bytes_read == frame_size) {
-            // Got a complete frame - copy to display buffer
-            pthread_mutex_lock(&preview->video_mutex);
-            memcpy(preview->video_frame_buffer, preview->video_decode_buffer, frame_size);
-            preview->video_frame_ready = true;
-            pthread_mutex_unlock(&preview->video_mutex);
+            // Publish the frame; the slot it replaces (shown or skipped) is filled next
+            int previous = atomic_exchange(&preview->video_frame_shared,
+                                           preview->video_frame_back | PREVIEW_VIDEO_FRESH);
+            preview->video_frame_back = previous & ~PREVIEW_VIDEO_FRESH;
             bytes_read = 0;
 
             // Sleep to match video FPS (prevents reading too far ahead)
@@ -122,19 +147,107 @@ static void *video_decode_thread(void *arg)
     return NULL;
 }
 
+// Helper: Pause or resume in-pane playback, waking the decode thread on resume
+static void preview_set_video_paused(PreviewState *preview, bool paused)
+{
+    if (preview->video_thread_active) {
+        pthread_mutex_lock(&preview->video_mutex);
+        preview->video_paused = paused;
+        pthread_cond_signal(&preview->video_resume);
+        pthread_mutex_unlock(&preview->video_mutex);
+    } else {
+        preview->video_paused = paused;
+    }
+}
+
+// Helper: A single-channel texture for one plane of a YUV frame, filled with value
+static unsigned int preview_load_plane_texture(int width, int height, unsigned char value)
+{
+    Image plane = {
+        .data = malloc((size_t)width * (size_t)height),
+        .width = width,
+        .height = height,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE
+    };
+    if (!plane.data) return 0;
+    memset(plane.data, value, (size_t)width * (size_t)height);
+
+    Texture2D tex = LoadTextureFromImage(plane);
+    UnloadImage(plane);
+    if (tex.id != 0) {
+        SetTextureFilter(tex, TEXTURE_FILTER_BILINEAR);
+        texture_budget_track(tex.id, (size_t)width * (size_t)height, 1, NULL, NULL);
+    }
+    return tex.id;
+}
+
+// Helper: Texture of one plane of the in-pane YUV frame (0: Y, 1: U, 2: V)
+static Texture2D preview_plane_texture(const PreviewState *preview, int plane)
+{
+    unsigned int ids[3] = { preview->video_frame_texture_id, preview->video_plane_u_id, preview->video_plane_v_id };
+    int divisor = plane == 0 ? 1 : 2;
+    return (Texture2D){
+        .id = ids[plane],
+        .width = preview->video_frame_width / divisor,
+        .height = preview->video_frame_height / divisor,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE
+    };
+}
+
+// Helper: Upload the newest frame from the decode thread, if there is one
+static void preview_take_video_frame(PreviewState *preview)
+{
+    if (!(atomic_load(&preview->video_frame_shared) & PREVIEW_VIDEO_FRESH)) return;
+
+    int shared = atomic_exchange(&preview->video_frame_shared, preview->video_frame_front);
+    preview->video_frame_front = shared & ~PREVIEW_VIDEO_FRESH;
+
+    // Planes follow each other: Y, then U and V at quarter size
+    const unsigned char *frame = preview->video_frames[preview->video_frame_front];
+    size_t luma = (size_t)preview->video_frame_width * (size_t)preview->video_frame_height;
+    UpdateTexture(preview_plane_texture(preview, 0), frame);
+    UpdateTexture(preview_plane_texture(preview, 1), frame + luma);
+    UpdateTexture(preview_plane_texture(preview, 2), frame + luma + luma / 4);
+}
+
+// Helper: Draw the in-pane YUV frame, converted to RGB by a shader
+static void preview_draw_yuv_frame(const PreviewState *preview, Vector2 position, float scale)
+{
+    if (!g_yuv.loaded) {
+        g_yuv.shader = LoadShaderFromMemory(NULL, YUV_FRAGMENT_SHADER);
+        g_yuv.loc_u = GetShaderLocation(g_yuv.shader, "textureU");
+        g_yuv.loc_v = GetShaderLocation(g_yuv.shader, "textureV");
+        g_yuv.loaded = true;
+    }
+
+    BeginShaderMode(g_yuv.shader);
+    SetShaderValueTexture(g_yuv.shader, g_yuv.loc_u, preview_plane_texture(preview, 1));
+    SetShaderValueTexture(g_yuv.shader, g_yuv.loc_v, preview_plane_texture(preview, 2));
+    DrawTextureEx(preview_plane_texture(preview, 0), position, 0.0f, scale, WHITE);
+    EndShaderMode();
+}
+
 // Helper: Stop in-pane video playback and cleanup resources
 static void preview_stop_video_playback(PreviewState *preview)
 {
     if (preview->video_inpane_active) {
         // Signal thread to stop and wait for it
         if (preview->video_thread_active) {
-            preview->video_thread_running = false;
+            pthread_mutex_lock(&preview->video_mutex);
+            atomic_store(&preview->video_thread_running, false);
+            pthread_cond_signal(&preview->video_resume);
+            pthread_mutex_unlock(&preview->video_mutex);
             pthread_join(preview->video_thread, NULL);
             preview->video_thread_active = false;
+            pthread_cond_destroy(&preview->video_resume);
             pthread_mutex_destroy(&preview->video_mutex);
         }
 
         video_stop_inpane_playback(preview->video_decoder_pid, preview->video_pipe_fd);
+        platform_video_close(preview->video_decoder);
+        preview->video_decoder = NULL;
 
         if (preview->video_frame_texture_id != 0) {
             Texture2D tex = {
@@ -142,17 +255,23 @@ static void preview_stop_video_playback(PreviewState *preview)
                 .width = preview->video_frame_width,
                 .height = preview->video_frame_height
             };
+            texture_budget_untrack(tex.id);
             UnloadTexture(tex);
             preview->video_frame_texture_id = 0;
         }
 
-        if (preview->video_frame_buffer) {
-            free(preview->video_frame_buffer);
-            preview->video_frame_buffer = NULL;
+        unsigned int *planes[2] = { &preview->video_plane_u_id, &preview->video_plane_v_id };
+        for (int i = 0; i < 2; i++) {
+            if (*planes[i] != 0) {
+                texture_budget_untrack(*planes[i]);
+                UnloadTexture((Texture2D){ .id = *planes[i] });
+                *planes[i] = 0;
+            }
         }
-        if (preview->video_decode_buffer) {
-            free(preview->video_decode_buffer);
-            preview->video_decode_buffer = NULL;
+
+        for (int i = 0; i < PREVIEW_VIDEO_SLOTS; i++) {
+            memory_free(MEMORY_TAG_PREVIEW, preview->video_frames[i]);
+            preview->video_frames[i] = NULL;
         }
 
         preview->video_inpane_active = false;
@@ -161,23 +280,79 @@ static void preview_stop_video_playback(PreviewState *preview)
         preview->video_pipe_fd = -1;
         preview->video_frame_width = 0;
         preview->video_frame_height = 0;
-        preview->video_frame_ready = false;
-        preview->video_eof = false;
+        atomic_store(&preview->video_eof, false);
+    }
+}
+
+// Helper: Start in-pane playback with the in-process hardware decoder, frames scaled
+// to the widest pane
+static bool preview_start_native_playback(PreviewState *preview)
+{
+    if (preview->video_width <= 0 || preview->video_height <= 0) {
+        return false;
+    }
+
+    int frame_width = preview->video_width;
+    int frame_height = preview->video_height;
+    int max_size = preview_image_size();
+    if (frame_width > max_size) {
+        frame_height = (int)((long long)frame_height * max_size / frame_width);
+        frame_width = max_size;
+    }
+    if (frame_height < 1) frame_height = 1;
+
+    PlatformVideo *decoder = platform_video_open(preview->file_path, frame_width, frame_height);
+    if (!decoder) {
+        return false;
+    }
+
+    Image blank = GenImageColor(frame_width, frame_height, BLACK);
+    Texture2D tex = LoadTextureFromImage(blank);
+    UnloadImage(blank);
+    if (tex.id == 0) {
+        platform_video_close(decoder);
+        return false;
     }
+    SetTextureFilter(tex, TEXTURE_FILTER_BILINEAR);
+    texture_budget_track(tex.id, GetPixelDataSize(tex.width, tex.height, tex.format), 1, NULL, NULL);
+
+    preview->video_decoder = decoder;
+    preview->video_frame_texture_id = tex.id;
+    preview->video_frame_width = frame_width;
+    preview->video_frame_height = frame_height;
+    preview->video_inpane_active = true;
+    preview->video_paused = false;
+    atomic_store(&preview->video_eof, false);
+    preview->video_position = 0.0;
+    preview->video_last_frame_time = GetTime();
+    return true;
 }
 
 // Helper: Start in-pane video playback with default settings
 static bool preview_start_video_playback(PreviewState *preview)
 {
+    // Frame size and rate are not known yet
+    if (preview->video_loading || preview->deferred) {
+        return false;
+    }
+
+    // Decode in-process when AVFoundation can read the file; ffmpeg otherwise
+    if (preview_start_native_playback(preview)) {
+        return true;
+    }
+
     int frame_width = preview->video_width > 0 ? preview->video_width : 640;
     int frame_height = preview->video_height > 0 ? preview->video_height : 480;
 
-    // Scale down for performance
+    // Scale down for performance; YUV420 needs even dimensions
     if (frame_width > 480) {
         float s = 480.0f / frame_width;
         frame_width = 480;
         frame_height = (int)(frame_height * s);
     }
+    frame_width &= ~1;
+    frame_height &= ~1;
+    if (frame_height < 2) frame_height = 2;
 
     preview->video_pipe_fd = video_start_inpane_playback(
         preview->file_path, frame_width, frame_height,
@@ -190,44 +365,42 @@ static bool preview_start_video_playback(PreviewState *preview)
     // Keep pipe blocking for the thread
     preview->video_frame_width = frame_width;
     preview->video_frame_height = frame_height;
-    size_t buffer_size = (size_t)frame_width * (size_t)frame_height * 3;
-    preview->video_frame_buffer = malloc(buffer_size);
-    if (!preview->video_frame_buffer) {
-        video_stop_inpane_playback(preview->video_decoder_pid, preview->video_pipe_fd);
-        preview->video_pipe_fd = -1;
-        preview->video_decoder_pid = 0;
-        return false;
-    }
-    preview->video_decode_buffer = malloc(buffer_size);
-    if (!preview->video_decode_buffer) {
-        free(preview->video_frame_buffer);
-        preview->video_frame_buffer = NULL;
-        video_stop_inpane_playback(preview->video_decoder_pid, preview->video_pipe_fd);
-        preview->video_pipe_fd = -1;
-        preview->video_decoder_pid = 0;
-        return false;
-    }
     preview->video_inpane_active = true;
     preview->video_paused = false;
-    preview->video_frame_ready = false;
-    preview->video_eof = false;
+    atomic_store(&preview->video_eof, false);
     preview->video_last_frame_time = GetTime();
 
-    // Create texture for video frames
-    Image blank = GenImageColor(frame_width, frame_height, BLACK);
-    Texture2D tex = LoadTextureFromImage(blank);
-    SetTextureFilter(tex, TEXTURE_FILTER_BILINEAR);
-    preview->video_frame_texture_id = tex.id;
-    UnloadImage(blank);
+    // Frame slots: the thread starts on slot 0, slot 1 is shared, slot 2 is shown
+    size_t frame_size = video_frame_size(frame_width, frame_height);
+    bool ok = true;
+    for (int i = 0; i < PREVIEW_VIDEO_SLOTS; i++) {
+        preview->video_frames[i] = memory_alloc(MEMORY_TAG_PREVIEW, frame_size);
+        ok = ok && preview->video_frames[i];
+    }
+    preview->video_frame_back = 0;
+    atomic_store(&preview->video_frame_shared, 1);
+    preview->video_frame_front = 2;
+
+    // Plane textures, black until the first frame
+    preview->video_frame_texture_id = preview_load_plane_texture(frame_width, frame_height, 16);
+    preview->video_plane_u_id = preview_load_plane_texture(frame_width / 2, frame_height / 2, 128);
+    preview->video_plane_v_id = preview_load_plane_texture(frame_width / 2, frame_height / 2, 128);
+    ok = ok && preview->video_frame_texture_id && preview->video_plane_u_id && preview->video_plane_v_id;
+    if (!ok) {
+        preview_stop_video_playback(preview);
+        return false;
+    }
 
     // Start decode thread
     pthread_mutex_init(&preview->video_mutex, NULL);
-    preview->video_thread_running = true;
+    pthread_cond_init(&preview->video_resume, NULL);
+    atomic_store(&preview->video_thread_running, true);
     if (pthread_create(&preview->video_thread, NULL, video_decode_thread, preview) == 0) {
         preview->video_thread_active = true;
     } else {
         // Thread creation failed, cleanup
-        preview->video_thread_running = false;
+        atomic_store(&preview->video_thread_running, false);
+        pthread_cond_destroy(&preview->video_resume);
         pthread_mutex_destroy(&preview->video_mutex);
         preview_stop_video_playback(preview);
         return false;
@@ -280,8 +453,9 @@ void preview_init(PreviewState *preview)
     preview->resizing = false;
     preview->file_path[0] = '\0';
     preview->type = PREVIEW_NONE;
-    preview->text_content = NULL;
+    preview->text_map = NULL;
     preview->text_lines = 0;
+    preview->syntax = NULL;
     preview->scroll_offset = 0;
     preview->wrapped_content = NULL;
     preview->wrapped_total_lines = 0;
@@ -304,6 +478,8 @@ void preview_init(PreviewState *preview)
     preview->video_playing = false;
     preview->video_thumbnail_path[0] = '\0';
     preview->video_thumbnail_id = 0;
+    preview->video_sprites = (Texture2D){ 0 };
+    preview->video_sprites_loading = false;
     preview->video_width = 0;
     preview->video_height = 0;
     preview->video_duration = 0;
@@ -321,6 +497,18 @@ void preview_init(PreviewState *preview)
 void preview_free(PreviewState *preview)
 {
     preview_clear(preview);
+    git_preview_destroy(preview->git);
+    preview->git = NULL;
+    image_preview_destroy(preview->images);
+    preview->images = NULL;
+    pdf_preview_destroy(preview->pdf);
+    preview->pdf = NULL;
+    preview_loader_destroy(preview->loader);
+    preview->loader = NULL;
+    if (g_yuv.loaded) {
+        UnloadShader(g_yuv.shader);
+        g_yuv.loaded = false;
+    }
 }
 
 void preview_toggle(PreviewState *preview)
@@ -331,12 +519,75 @@ void preview_toggle(PreviewState *preview)
     }
 }
 
-void preview_clear(PreviewState *preview)
+// Helper: Drop the git text shown (the view itself stays)
+static void preview_drop_git(PreviewState *preview)
+{
+    syntax_destroy(preview->git_syntax);
+    preview->git_syntax = NULL;
+    text_map_close(preview->git_map);
+    preview->git_map = NULL;
+    git_preview_text_release(preview->git_text);
+    preview->git_text = NULL;
+    preview->git_loading = false;
+    preview->git_failed = false;
+}
+
+// Helper: Ask for the git view of the file previewed, if it is text
+static void preview_request_git(PreviewState *preview)
 {
-    if (preview->text_content) {
-        free(preview->text_content);
-        preview->text_content = NULL;
+    bool text = preview->type == PREVIEW_TEXT || preview->type == PREVIEW_CODE || preview->type == PREVIEW_MARKDOWN;
+    if (preview->git_view == PREVIEW_GIT_OFF || !text || preview->deferred || preview->file_path[0] == '\0') {
+        return;
+    }
+    if (!preview->git) {
+        preview->git = git_preview_create();
     }
+    if (preview->git) {
+        git_preview_request(preview->git, preview->file_path,
+                            preview->git_view == PREVIEW_GIT_DIFF ? GIT_PREVIEW_DIFF : GIT_PREVIEW_LOG);
+        preview->git_loading = true;
+    }
+}
+
+// Helper: Take the git text once read; it is indexed and highlighted like a code file
+static void preview_poll_git(PreviewState *preview)
+{
+    if (!preview->git_loading) {
+        return;
+    }
+    GitPreviewText *text = NULL;
+    GitPreviewStatus status = git_preview_poll(preview->git, &text);
+    if (status == GIT_PREVIEW_LOADING) {
+        return;
+    }
+    preview->git_loading = false;
+    preview->git_failed = status != GIT_PREVIEW_READY;
+    if (text) {
+        preview->git_text = text;
+        preview->git_map = text_map_open_memory(git_preview_text_data(text), git_preview_text_size(text));
+        preview->git_syntax = syntax_create(git_preview_text_data(text), git_preview_text_size(text), SYNTAX_DIFF);
+    }
+}
+
+void preview_set_git_view(PreviewState *preview, PreviewGitView view)
+{
+    if (preview->git_view == view) {
+        return;
+    }
+    preview_drop_git(preview);
+    preview->git_view = view;
+    preview->scroll_offset = 0;
+    preview->text_lines = 0;
+    preview_request_git(preview);
+}
+
+void preview_clear(PreviewState *preview)
+{
+    preview_drop_git(preview);
+    syntax_destroy(preview->syntax);
+    preview->syntax = NULL;
+    text_map_close(preview->text_map);
+    preview->text_map = NULL;
     if (preview->wrapped_content) {
         free(preview->wrapped_content);
         preview->wrapped_content = NULL;
@@ -345,12 +596,9 @@ void preview_clear(PreviewState *preview)
     preview->wrapped_total_lines = 0;
     preview->scroll_offset = 0;
 
-    if (preview->image_loaded && preview->texture_id != 0) {
-        Texture2D tex = { .id = preview->texture_id, .width = preview->image_width, .height = preview->image_height };
-        UnloadTexture(tex);
-        preview->texture_id = 0;
-        preview->image_loaded = false;
-    }
+    // The texture stays cached for when the image is previewed again
+    preview->texture_id = 0;
+    preview->image_loaded = false;
     preview->image_format[0] = '\0';
     preview->image_bit_depth = 0;
 
@@ -371,10 +619,18 @@ void preview_clear(PreviewState *preview)
     }
     if (preview->video_loaded && preview->video_thumbnail_id != 0) {
         Texture2D tex = { .id = preview->video_thumbnail_id, .width = preview->image_width, .height = preview->image_height };
+        texture_budget_untrack(tex.id);
         UnloadTexture(tex);
         preview->video_thumbnail_id = 0;
     }
+    if (preview->video_sprites.id != 0) {
+        texture_budget_untrack(preview->video_sprites.id);
+        UnloadTexture(preview->video_sprites);
+        preview->video_sprites = (Texture2D){ 0 };
+    }
     preview->video_loaded = false;
+    preview->video_loading = false;
+    preview->video_sprites_loading = false;
     preview->video_playing = false;
     preview->video_thumbnail_path[0] = '\0';
     preview->video_width = 0;
@@ -385,102 +641,172 @@ void preview_clear(PreviewState *preview)
     preview->video_format[0] = '\0';
     preview->video_bit_depth = 0;
 
+    // Loads still running for the last file are dropped when they finish
+    preview->generation++;
+    preview->deferred = false;
+    preview->file_mtime = 0;
+    preview->file_size = 0;
+
     preview->file_path[0] = '\0';
     preview->type = PREVIEW_NONE;
 }
 
-PreviewType preview_type_from_extension(const char *extension)
+// Preview types by file type class (images and documents also need a trait)
+static const PreviewType PREVIEW_TYPES[FILE_CLASS_COUNT] = {
+    [FILE_CLASS_TEXT] = PREVIEW_TEXT,
+    [FILE_CLASS_MARKDOWN] = PREVIEW_MARKDOWN,
+    [FILE_CLASS_CODE] = PREVIEW_CODE,
+    [FILE_CLASS_DATA] = PREVIEW_CODE,
+    [FILE_CLASS_DOCUMENT] = PREVIEW_PDF,
+    [FILE_CLASS_IMAGE] = PREVIEW_IMAGE,
+    [FILE_CLASS_VIDEO] = PREVIEW_VIDEO,
+};
+
+PreviewType preview_type_from_file_type(FileTypeId type)
 {
-    if (!extension || extension[0] == '\0') {
+    const FileTypeInfo *info = file_type_info(type);
+    if ((info->type_class == FILE_CLASS_IMAGE && !(info->traits & FILE_TRAIT_RASTER)) ||
+        (info->type_class == FILE_CLASS_DOCUMENT && !(info->traits & FILE_TRAIT_PDF))) {
         return PREVIEW_UNKNOWN;
     }
+    PreviewType type_for_class = PREVIEW_TYPES[info->type_class];
+    return type_for_class != PREVIEW_NONE ? type_for_class : PREVIEW_UNKNOWN;
+}
+
+PreviewType preview_type_from_extension(const char *extension)
+{
+    return preview_type_from_file_type(file_type_from_extension(extension));
+}
+
+char* preview_copy_text(const PreviewState *preview, size_t max_bytes)
+{
+    if (!preview->text_map) {
+        return NULL;
+    }
+
+    size_t size = text_map_size(preview->text_map);
+    if (size > max_bytes) {
+        size = max_bytes;
+    }
+    char *text = malloc(size + 1);
+    if (text) {
+        memcpy(text, text_map_data(preview->text_map), size);
+        text[size] = '\0';
+    }
+    return text;
+}
+
+bool preview_is_loading(PreviewState *preview)
+{
+    bool complete = true;
+    if (preview->text_map) {
+        text_map_line_count(preview->text_map, &complete);
+    }
+    return preview->deferred || preview->video_loading || preview->video_sprites_loading || !complete || syntax_is_busy(preview->syntax) ||
+           preview->git_loading || syntax_is_busy(preview->git_syntax) ||
+           (preview->type == PREVIEW_IMAGE && image_preview_is_busy(preview->images)) ||
+           (preview->type == PREVIEW_PDF && pdf_preview_is_busy(preview->pdf));
+}
+
+// Helper: Theme color of a token kind
+static Color syntax_color(int kind)
+{
+    switch (kind) {
+        case SYNTAX_KEYWORD:      return g_theme.accent;
+        case SYNTAX_STRING:       return g_theme.success;
+        case SYNTAX_COMMENT:      return g_theme.textSecondary;
+        case SYNTAX_NUMBER:       return g_theme.warning;
+        case SYNTAX_PREPROCESSOR: return g_theme.aiAccent;
+        default:                  return g_theme.textPrimary;
+    }
+}
+
+// Helper: Show a requested image once it is decoded; give up on images that fail
+static void preview_apply_image(PreviewState *preview, ImagePreviewStatus status,
+                                const ImagePreviewTexture *image)
+{
+    if (status == IMAGE_PREVIEW_READY) {
+        preview->texture_id = image->texture.id;
+        preview->image_width = image->texture.width;
+        preview->image_height = image->texture.height;
+        preview->image_original_width = image->original_width;
+        preview->image_original_height = image->original_height;
+        preview->image_bit_depth = image->bit_depth;
+        preview->image_loaded = true;
+    } else if (status == IMAGE_PREVIEW_FAILED || status == IMAGE_PREVIEW_NONE) {
+        preview->type = PREVIEW_UNKNOWN;
+    }
+}
+
+// Helper: Pick up lines indexed since the last frame (of the git text, in the git view)
+static void preview_sync_text_lines(PreviewState *preview)
+{
+    preview_poll_git(preview);
+    struct TextMap *map = preview->git_view != PREVIEW_GIT_OFF ? preview->git_map : preview->text_map;
+    if (map) {
+        preview->text_lines = text_map_line_count(map, NULL);
+    } else if (preview->git_view != PREVIEW_GIT_OFF) {
+        preview->text_lines = 0;
+    }
+}
 
-    // Convert to lowercase for comparison
-    char ext_lower[32];
-    strncpy(ext_lower, extension, sizeof(ext_lower) - 1);
-    ext_lower[sizeof(ext_lower) - 1] = '\0';
-    for (int i = 0; ext_lower[i]; i++) {
-        ext_lower[i] = tolower((unsigned char)ext_lower[i]);
-    }
-
-    // Images
-    if (strcmp(ext_lower, "png") == 0 ||
-        strcmp(ext_lower, "jpg") == 0 ||
-        strcmp(ext_lower, "jpeg") == 0 ||
-        strcmp(ext_lower, "gif") == 0 ||
-        strcmp(ext_lower, "bmp") == 0) {
-        return PREVIEW_IMAGE;
-    }
-
-    // Code files
-    if (strcmp(ext_lower, "c") == 0 ||
-        strcmp(ext_lower, "h") == 0 ||
-        strcmp(ext_lower, "cpp") == 0 ||
-        strcmp(ext_lower, "hpp") == 0 ||
-        strcmp(ext_lower, "py") == 0 ||
-        strcmp(ext_lower, "js") == 0 ||
-        strcmp(ext_lower, "ts") == 0 ||
-        strcmp(ext_lower, "go") == 0 ||
-        strcmp(ext_lower, "rs") == 0 ||
-        strcmp(ext_lower, "java") == 0 ||
-        strcmp(ext_lower, "swift") == 0 ||
-        strcmp(ext_lower, "css") == 0 ||
-        strcmp(ext_lower, "html") == 0 ||
-        strcmp(ext_lower, "json") == 0 ||
-        strcmp(ext_lower, "yaml") == 0 ||
-        strcmp(ext_lower, "yml") == 0 ||
-        strcmp(ext_lower, "toml") == 0 ||
-        strcmp(ext_lower, "xml") == 0 ||
-        strcmp(ext_lower, "sh") == 0) {
-        return PREVIEW_CODE;
-    }
-
-    // Markdown
-    if (strcmp(ext_lower, "md") == 0 ||
-        strcmp(ext_lower, "markdown") == 0) {
-        return PREVIEW_MARKDOWN;
-    }
-
-    // PDF
-    if (strcmp(ext_lower, "pdf") == 0) {
-        return PREVIEW_PDF;
-    }
-
-    // Video files
-    if (strcmp(ext_lower, "mp4") == 0 ||
-        strcmp(ext_lower, "mov") == 0 ||
-        strcmp(ext_lower, "mkv") == 0 ||
-        strcmp(ext_lower, "avi") == 0 ||
-        strcmp(ext_lower, "webm") == 0 ||
-        strcmp(ext_lower, "m4v") == 0) {
-        return PREVIEW_VIDEO;
-    }
-
-    // Plain text
-    if (strcmp(ext_lower, "txt") == 0 ||
-        strcmp(ext_lower, "log") == 0 ||
-        strcmp(ext_lower, "cfg") == 0 ||
-        strcmp(ext_lower, "conf") == 0 ||
-        strcmp(ext_lower, "ini") == 0) {
-        return PREVIEW_TEXT;
-    }
-
-    return PREVIEW_UNKNOWN;
+// Helper: Whether the word-wrapped prose view is shown rather than lines
+static bool preview_shows_prose(const PreviewState *preview)
+{
+    return preview->type == PREVIEW_TEXT && preview->wrapped_content && preview->git_view == PREVIEW_GIT_OFF;
 }
 
-static int count_lines(const char *text)
+// Helper: Take a finished video load for the file shown; its thumbnail, and later its
+// sprite sheet, are uploaded here
+static void preview_poll_video(PreviewState *preview)
 {
-    int count = 1;
-    for (const char *p = text; *p; p++) {
-        if (*p == '\n') count++;
+    PreviewVideoLoad load;
+    if ((!preview->video_loading && !preview->video_sprites_loading) ||
+        !preview_loader_poll(preview->loader, preview->generation, &load)) {
+        return;
+    }
+    preview->video_loading = false;
+    preview->video_sprites_loading = load.sprites_follow;
+
+    if (load.has_sprites) {
+        preview->video_sprites = LoadTextureFromImage(load.sprites);
+        UnloadImage(load.sprites);
+        if (preview->video_sprites.id != 0) {
+            SetTextureFilter(preview->video_sprites, TEXTURE_FILTER_BILINEAR);
+            texture_budget_track(preview->video_sprites.id, GetPixelDataSize(preview->video_sprites.width,
+                                 preview->video_sprites.height, preview->video_sprites.format), 1, NULL, NULL);
+        }
+    }
+
+    if (load.has_thumbnail) {
+        Texture2D tex = LoadTextureFromImage(load.thumbnail);
+        UnloadImage(load.thumbnail);
+        if (tex.id != 0) {
+            // Apply bilinear filtering for smooth scaling
+            SetTextureFilter(tex, TEXTURE_FILTER_BILINEAR);
+            texture_budget_track(tex.id, GetPixelDataSize(tex.width, tex.height, tex.format), 1, NULL, NULL);
+            preview->video_thumbnail_id = tex.id;
+            preview->image_width = tex.width;
+            preview->image_height = tex.height;
+            preview->video_loaded = true;
+            snprintf(preview->video_thumbnail_path, sizeof(preview->video_thumbnail_path), "%s",
+                     load.thumbnail_path);
+        }
+    }
+    if (load.has_info) {
+        preview->video_duration = load.info.duration;
+        preview->video_width = load.info.width;
+        preview->video_height = load.info.height;
+        preview->video_fps = load.info.fps;
+        snprintf(preview->video_format, sizeof(preview->video_format), "%s", load.info.codec);
+        preview->video_bit_depth = load.info.bit_depth;
     }
-    return count;
 }
 
 void preview_load(PreviewState *preview, const char *file_path)
 {
     // Skip if same file
-    if (strcmp(preview->file_path, file_path) == 0 && preview->type != PREVIEW_NONE) {
+    if (strcmp(preview->file_path, file_path) == 0 && preview->type != PREVIEW_NONE && !preview->deferred) {
         return;
     }
 
@@ -489,32 +815,31 @@ void preview_load(PreviewState *preview, const char *file_path)
     strncpy(preview->file_path, file_path, sizeof(preview->file_path) - 1);
     preview->file_path[sizeof(preview->file_path) - 1] = '\0';
 
+    // A member of an archive is previewed from a copy on disk; file_path stays its path
+    char local[PATH_MAX_LEN];
+    if (archive_member_copy(file_path, ARCHIVE_PREVIEW_MAX, local, sizeof(local))) {
+        file_path = local;
+    }
+
     // Get extension
     const char *ext = strrchr(file_path, '.');
     if (ext) ext++;
     else ext = "";
 
-    preview->type = preview_type_from_extension(ext);
+    // Files without an extension are classified by their first bytes
+    preview->type = preview_type_from_file_type(file_type_from_path(file_path));
 
     switch (preview->type) {
         case PREVIEW_IMAGE: {
-            // Load image with raylib - use LoadImage to get format info
-            Image img = LoadImage(file_path);
-            if (img.data != NULL) {
-                Texture2D tex = LoadTextureFromImage(img);
-                if (tex.id != 0) {
-                    // Apply bilinear filtering for smooth scaling
-                    SetTextureFilter(tex, TEXTURE_FILTER_BILINEAR);
-                    preview->texture_id = tex.id;
-                    preview->image_width = tex.width;
-                    preview->image_height = tex.height;
-                    preview->image_loaded = true;
-                    preview->image_bit_depth = preview_get_bit_depth_from_format(img.format);
-                    preview_extract_format_from_extension(ext, preview->image_format, sizeof(preview->image_format));
-                } else {
-                    preview->type = PREVIEW_UNKNOWN;
-                }
-                UnloadImage(img);
+            // Decoded at pane size in the background; drawn once uploaded
+            preview_extract_format_from_extension(ext, preview->image_format, sizeof(preview->image_format));
+            if (!preview->images) {
+                preview->images = image_preview_create();
+            }
+            if (preview->images) {
+                ImagePreviewTexture image;
+                preview_apply_image(preview, image_preview_request(preview->images, file_path,
+                                                                   preview_image_size(), &image), &image);
             } else {
                 preview->type = PREVIEW_UNKNOWN;
             }
@@ -524,64 +849,55 @@ void preview_load(PreviewState *preview, const char *file_path)
         case PREVIEW_TEXT:
         case PREVIEW_CODE:
         case PREVIEW_MARKDOWN: {
-            // Load text file
-            FILE *f = fopen(file_path, "r");
-            if (f) {
-                fseek(f, 0, SEEK_END);
-                long size = ftell(f);
-                fseek(f, 0, SEEK_SET);
-
-                if (size > MAX_TEXT_SIZE) {
-                    size = MAX_TEXT_SIZE;
+            // Map the file; lines are indexed in the background and only those on
+            // screen are read
+            preview->text_map = text_map_open(file_path);
+            if (preview->text_map) {
+                preview->text_lines = text_map_line_count(preview->text_map, NULL);
+
+                // Highlight code in the background, lines on screen first
+                if (preview->type == PREVIEW_CODE) {
+                    preview->syntax = syntax_create(text_map_data(preview->text_map),
+                                                    text_map_size(preview->text_map),
+                                                    syntax_language_for_extension(ext));
                 }
 
-                preview->text_content = malloc(size + 1);
-                if (preview->text_content) {
-                    size_t read = fread(preview->text_content, 1, size, f);
-                    preview->text_content[read] = '\0';
-                    preview->text_lines = count_lines(preview->text_content);
-
-                    // For PREVIEW_TEXT, create wrapped content (prose view)
-                    if (preview->type == PREVIEW_TEXT) {
-                        preview->wrapped_content = truncate_at_words(preview->text_content, MAX_PREVIEW_WORDS);
-                        if (preview->wrapped_content) {
-                            // Calculate wrapped line count for scrollbar
-                            int content_width = preview->width - PADDING * 2;
-                            preview->wrapped_total_lines = measure_text_lines(preview->wrapped_content, content_width, FONT_SIZE_SMALL);
-                        }
+                // For PREVIEW_TEXT, create wrapped content (prose view) from the start
+                if (preview->type == PREVIEW_TEXT) {
+                    char *prose = preview_copy_text(preview, PROSE_TEXT_SIZE);
+                    if (prose) {
+                        preview->wrapped_content = truncate_at_words(prose, MAX_PREVIEW_WORDS);
+                        free(prose);
+                    }
+                    if (preview->wrapped_content) {
+                        // Calculate wrapped line count for scrollbar
+                        int content_width = preview->width - PADDING * 2;
+                        preview->wrapped_total_lines = measure_text_lines(preview->wrapped_content, content_width, FONT_SIZE_SMALL);
                     }
                 }
-                fclose(f);
             }
+            preview_request_git(preview);
             break;
         }
 
         case PREVIEW_PDF:
-            // PDF preview would require additional library (e.g., poppler)
-            // For now, show file info
+            // Opened and rendered in the background, a page at a time as it comes into view
+            if (!preview->pdf) {
+                preview->pdf = pdf_preview_create();
+            }
+            pdf_preview_open(preview->pdf, file_path);
+            preview->pdf_scroll = 0.0f;
             break;
 
         case PREVIEW_VIDEO: {
-            // Generate or load cached thumbnail
-            char thumb_path[4096];
-            if (video_generate_thumbnail(file_path, thumb_path, sizeof(thumb_path))) {
-                Texture2D tex = LoadTexture(thumb_path);
-                if (tex.id != 0) {
-                    // Apply bilinear filtering for smooth scaling
-                    SetTextureFilter(tex, TEXTURE_FILTER_BILINEAR);
-                    preview->video_thumbnail_id = tex.id;
-                    preview->image_width = tex.width;
-                    preview->image_height = tex.height;
-                    preview->video_loaded = true;
-                    strncpy(preview->video_thumbnail_path, thumb_path, sizeof(preview->video_thumbnail_path) - 1);
-                }
+            // Thumbnail (which may run ffmpeg) and metadata are loaded in the background
+            if (!preview->loader) {
+                preview->loader = preview_loader_create();
+            }
+            if (preview->loader) {
+                preview_loader_request_video(preview->loader, file_path, preview->generation);
+                preview->video_loading = true;
             }
-            // Get video metadata (basic)
-            video_get_metadata(file_path, &preview->video_duration,
-                               &preview->video_width, &preview->video_height);
-            // Get extended video metadata (codec, bit depth)
-            video_get_extended_metadata(file_path, preview->video_format, sizeof(preview->video_format),
-                                        &preview->video_bit_depth);
             break;
         }
 
@@ -591,6 +907,38 @@ void preview_load(PreviewState *preview, const char *file_path)
     }
 }
 
+void preview_select(PreviewState *preview, const char *file_path, time_t mtime, off_t size, double now)
+{
+    bool same = strcmp(preview->file_path, file_path) == 0 && preview->type != PREVIEW_NONE;
+    if (same && !preview->deferred) {
+        return;
+    }
+
+    if (!same) {
+        // The selection moved: drop the last file's preview, show this one's name at once
+        preview_clear(preview);
+        snprintf(preview->file_path, sizeof(preview->file_path), "%s", file_path);
+        const char *ext = strrchr(file_path, '.');
+        preview->type = preview_type_from_extension(ext ? ext + 1 : "");
+        preview->deferred = true;
+        preview->deferred_since = now;
+        preview->file_mtime = mtime;
+        preview->file_size = size;
+
+        // Images decoded before need no waiting
+        if (preview->type != PREVIEW_IMAGE ||
+            !image_preview_is_cached(preview->images, file_path, mtime, size, preview_image_size())) {
+            return;
+        }
+    } else if (now - preview->deferred_since < PREVIEW_SETTLE_SECONDS) {
+        return;
+    }
+
+    preview_load(preview, file_path);
+    preview->file_mtime = mtime;
+    preview->file_size = size;
+}
+
 int preview_get_width(PreviewState *preview)
 {
     return preview->visible ? preview->width : 0;
@@ -690,7 +1038,9 @@ bool preview_handle_input(struct App *app)
         if (preview->visible && app->directory.count > 0) {
             FileEntry *entry = &app->directory.entries[app->selected_index];
             if (!entry->is_directory) {
-                preview_load(preview, entry->path);
+                char path[PATH_MAX_LEN];
+                directory_entry_path(&app->directory, entry, path, sizeof(path));
+                preview_load(preview, path);
             }
         }
         return false;
@@ -706,10 +1056,11 @@ bool preview_handle_input(struct App *app)
     // Scroll preview content with arrow keys (supports holding for continuous scroll)
     // Only when mouse is over preview pane
 
+    preview_sync_text_lines(preview);
     if (mouse_over_preview && (preview->type == PREVIEW_TEXT || preview->type == PREVIEW_CODE || preview->type == PREVIEW_MARKDOWN)) {
         // Calculate max scroll based on content type
         int max_scroll;
-        if (preview->type == PREVIEW_TEXT && preview->wrapped_total_lines > 0) {
+        if (preview_shows_prose(preview) && preview->wrapped_total_lines > 0) {
             max_scroll = preview->wrapped_total_lines - 1;
         } else {
             max_scroll = preview->text_lines - 1;
@@ -730,6 +1081,15 @@ bool preview_handle_input(struct App *app)
         }
     }
 
+    if (mouse_over_preview && preview->type == PREVIEW_PDF) {
+        if (IsKeyPressed(KEY_DOWN) || IsKeyPressedRepeat(KEY_DOWN)) {
+            preview->pdf_scroll += ROW_HEIGHT;
+        }
+        if ((IsKeyPressed(KEY_UP) || IsKeyPressedRepeat(KEY_UP)) && preview->pdf_scroll > 0.0f) {
+            preview->pdf_scroll -= ROW_HEIGHT;
+        }
+    }
+
     // Mouse wheel scroll in preview (reuse mouse and preview_x from above)
     if (mouse_over_preview) {
         float wheel = GetMouseWheelMove();
@@ -760,10 +1120,14 @@ bool preview_handle_input(struct App *app)
                 if (preview->summary_scroll_offset > max_scroll) {
                     preview->summary_scroll_offset = max_scroll;
                 }
+            } else if (preview->type == PREVIEW_PDF) {
+                // Clamped to the document when drawn
+                preview->pdf_scroll -= wheel * ROW_HEIGHT * 3;
+                if (preview->pdf_scroll < 0.0f) preview->pdf_scroll = 0.0f;
             } else if (preview->type == PREVIEW_TEXT || preview->type == PREVIEW_CODE || preview->type == PREVIEW_MARKDOWN) {
                 // Scroll main content
                 int max_scroll;
-                if (preview->type == PREVIEW_TEXT && preview->wrapped_total_lines > 0) {
+                if (preview_shows_prose(preview) && preview->wrapped_total_lines > 0) {
                     max_scroll = preview->wrapped_total_lines - 1;
                 } else {
                     max_scroll = preview->text_lines - 1;
@@ -819,7 +1183,7 @@ bool preview_handle_input(struct App *app)
             if (!preview->video_inpane_active) {
                 preview_start_video_playback(preview);
             } else {
-                preview->video_paused = !preview->video_paused;
+                preview_set_video_paused(preview, !preview->video_paused);
             }
         }
 
@@ -840,25 +1204,25 @@ bool preview_handle_input(struct App *app)
         }
     }
 
-    // Update video texture from decode thread (thread does the reading)
-    if (preview->video_inpane_active && preview->video_frame_texture_id != 0) {
-        // Check if thread has a new frame ready
-        pthread_mutex_lock(&preview->video_mutex);
-        if (preview->video_frame_ready) {
-            Texture2D tex = {
-                .id = preview->video_frame_texture_id,
-                .width = preview->video_frame_width,
-                .height = preview->video_frame_height,
-                .mipmaps = 1,
-                .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8
-            };
-            UpdateTexture(tex, preview->video_frame_buffer);
-            preview->video_frame_ready = false;
+    // Show the frame due at the playback position (in-process decoder)
+    if (preview->video_inpane_active && preview->video_decoder) {
+        double now = GetTime();
+        if (!preview->video_paused) {
+            preview->video_position += now - preview->video_last_frame_time;
         }
-        pthread_mutex_unlock(&preview->video_mutex);
+        preview->video_last_frame_time = now;
+
+        platform_video_update_texture(preview->video_decoder, preview->video_position,
+                                      preview->video_frame_texture_id);
+        if (platform_video_finished(preview->video_decoder)) {
+            preview_stop_video_playback(preview);
+        }
+    } else if (preview->video_inpane_active && preview->video_frame_texture_id != 0) {
+        // Upload the latest frame from the decode thread (ffmpeg pipe)
+        preview_take_video_frame(preview);
 
         // Check if video ended
-        if (preview->video_eof) {
+        if (atomic_load(&preview->video_eof)) {
             preview_stop_video_playback(preview);
         }
     }
@@ -897,8 +1261,99 @@ bool preview_handle_input(struct App *app)
     return false;
 }
 
+// Helper: Draw the grid thumbnail of the previewed image, fit to max_width x max_height,
+// while the full preview is on its way; false if the thumbnail is not ready either
+static bool preview_draw_thumbnail(struct App *app, int x, int y, int max_width, int max_height)
+{
+    PreviewState *preview = &app->preview;
+    const char *ext = strrchr(preview->file_path, '.');
+    if (preview->file_size <= 0 || !ext || !thumbnails_is_supported(ext + 1)) {
+        return false;
+    }
+
+    Texture2D atlas;
+    Rectangle source;
+    if (!thumbnails_get(app->thumbnails, preview->file_path, preview->file_mtime, preview->file_size,
+                        0, &atlas, &source)) {
+        return false;
+    }
+
+    // Stretched to the size the full preview will take, so it does not jump when it lands
+    float scale = (float)max_width / source.width;
+    if (source.height * scale > max_height) {
+        scale = (float)max_height / source.height;
+    }
+    float width = source.width * scale;
+    float height = source.height * scale;
+    Rectangle dest = { x + (max_width - width) / 2, (float)y, width, height };
+    DrawTexturePro(atlas, source, dest, (Vector2){ 0, 0 }, 0.0f, WHITE);
+    return true;
+}
+
+// Helper: Draw a PDF's pages stacked down the pane, pane wide, and tell the previewer
+// which are in view; the scroll is clamped to the document here
+static void preview_draw_pdf(PreviewState *preview, int x, int y, int width, int height)
+{
+    PdfPreview *pdf = preview->pdf;
+    pdf_preview_poll(pdf);
+    int pages = pdf_preview_page_count(pdf);
+    if (pages <= 0 || width <= 0 || height <= 0) {
+        DrawTextCustom("PDF Preview", x, y, FONT_SIZE, g_theme.textPrimary);
+        DrawTextCustom(pages == 0 ? "Loading..." : "(cannot be read)", x, y + ROW_HEIGHT,
+                       FONT_SIZE_SMALL, g_theme.textSecondary);
+        return;
+    }
+
+    float total = 0.0f;
+    for (int page = 0; page < pages; page++) {
+        float page_width, page_height;
+        pdf_preview_page_size(pdf, page, &page_width, &page_height);
+        total += width * page_height / page_width + PADDING;
+    }
+    float max_scroll = total - PADDING - height;
+    if (preview->pdf_scroll > max_scroll) preview->pdf_scroll = max_scroll;
+    if (preview->pdf_scroll < 0.0f) preview->pdf_scroll = 0.0f;
+
+    // Pages in view, drawn from their textures or as blank paper until those arrive
+    int first = -1;
+    int last = -1;
+    float top = y - preview->pdf_scroll;
+    BeginScissorMode(x, y, width, height);
+    for (int page = 0; page < pages && top < y + height; page++) {
+        float page_width, page_height;
+        pdf_preview_page_size(pdf, page, &page_width, &page_height);
+        float drawn_height = width * page_height / page_width;
+        if (top + drawn_height > y) {
+            if (first < 0) first = page;
+            last = page;
+            Rectangle dest = { (float)x, top, (float)width, drawn_height };
+            Texture2D texture;
+            if (pdf_preview_get_page(pdf, page, &texture)) {
+                DrawTexturePro(texture, (Rectangle){ 0, 0, (float)texture.width, (float)texture.height },
+                               dest, (Vector2){ 0, 0 }, 0.0f, WHITE);
+            } else {
+                DrawRectangleRec(dest, WHITE);
+            }
+            DrawRectangleLinesEx(dest, 1.0f, g_theme.border);
+        }
+        top += drawn_height + PADDING;
+    }
+    EndScissorMode();
+
+    Vector2 dpi = GetWindowScaleDPI();
+    pdf_preview_set_view(pdf, first, last, (int)(width * (dpi.x > 1.0f ? dpi.x : 1.0f)));
+
+    char label[32];
+    snprintf(label, sizeof(label), "%d / %d", first + 1, pages);
+    int label_width = MeasureTextCustom(label, FONT_SIZE_SMALL);
+    int label_x = x + width - label_width - PADDING;
+    DrawRectangle(label_x - 4, y + 4, label_width + 8, FONT_SIZE_SMALL + 4, Fade(g_theme.background, 0.8f));
+    DrawTextCustom(label, label_x, y + 6, FONT_SIZE_SMALL, g_theme.textSecondary);
+}
+
 void preview_draw(struct App *app)
 {
+    TRACE_SCOPE("preview_draw");
     PreviewState *preview = &app->preview;
     BrowserState *bs = &app->browser_state;
 
@@ -942,7 +1397,14 @@ void preview_draw(struct App *app)
     // Draw based on type
     switch (preview->type) {
         case PREVIEW_IMAGE: {
+            // Until the selection settles the cache reports on the last file's request
+            if (!preview->image_loaded && !preview->deferred && preview->images) {
+                ImagePreviewTexture image;
+                preview_apply_image(preview, image_preview_poll(preview->images, &image), &image);
+            }
+
             if (preview->image_loaded && preview->texture_id != 0) {
+                texture_budget_touch(preview->texture_id);
                 Texture2D tex = {
                     .id = preview->texture_id,
                     .width = preview->image_width,
@@ -981,7 +1443,8 @@ void preview_draw(struct App *app)
                 }
 
                 // Resolution
-                snprintf(info, sizeof(info), "Resolution: %dx%d", preview->image_width, preview->image_height);
+                snprintf(info, sizeof(info), "Resolution: %dx%d",
+                         preview->image_original_width, preview->image_original_height);
                 DrawTextCustom(info, content_x, info_y, FONT_SIZE_SMALL, g_theme.textSecondary);
                 info_y += ROW_HEIGHT;
 
@@ -1013,6 +1476,8 @@ void preview_draw(struct App *app)
                         preview->edit_state = IMAGE_EDIT_INPUT;
                         preview->edit_buffer[0] = '\0';
                         preview->edit_cursor = 0;
+                        // Downsize the image for upload while the prompt is typed
+                        image_upload_prefetch(preview->file_path);
                     }
 
                 } else if (preview->edit_state == IMAGE_EDIT_INPUT) {
@@ -1137,6 +1602,9 @@ void preview_draw(struct App *app)
                         preview->edit_state = IMAGE_EDIT_INPUT;
                     }
                 }
+            } else if (!preview_draw_thumbnail(app, content_x, content_y, content_width,
+                                               preview_height - PADDING * 2 - 200)) {
+                DrawTextCustom("Loading...", content_x, content_y, FONT_SIZE_SMALL, g_theme.textSecondary);
             }
             break;
         }
@@ -1169,14 +1637,31 @@ void preview_draw(struct App *app)
             DrawTextCustom(btn_text, btn_x + (btn_width - text_width) / 2,
                      btn_y + (btn_height - FONT_SIZE_SMALL) / 2, FONT_SIZE_SMALL, g_theme.background);
 
+            // In a repository, a button to its left cycles the file, its diff and its history
+            if (app->git.is_repo || preview->git_view != PREVIEW_GIT_OFF) {
+                static const char *git_labels[] = { "File", "Diff", "History" };
+                int git_width = 70;
+                Rectangle git_rect = {(float)(btn_x - git_width - PADDING / 2), (float)btn_y,
+                                      (float)git_width, (float)btn_height};
+                bool git_hovered = CheckCollisionPointRec(GetMousePosition(), git_rect);
+                DrawRectangleRec(git_rect, git_hovered ? g_theme.hover : g_theme.sidebar);
+                const char *git_text = git_labels[preview->git_view];
+                int git_text_width = MeasureTextCustom(git_text, FONT_SIZE_SMALL);
+                DrawTextCustom(git_text, (int)git_rect.x + (git_width - git_text_width) / 2,
+                               btn_y + (btn_height - FONT_SIZE_SMALL) / 2, FONT_SIZE_SMALL, g_theme.textPrimary);
+                if (git_hovered && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+                    preview_set_git_view(preview, (PreviewGitView)((preview->git_view + 1) % 3));
+                }
+            }
+
             // Handle button click
             if (btn_hovered && IsMouseButtonPressed(MOUSE_BUTTON_LEFT) &&
                 bs->summary_state != HOVER_LOADING) {
                 // Start async summary
                 app->summary_config.default_level = SUMM_LEVEL_BRIEF;
-                if (summarize_async_start(&app->async_summary_request, &app->summary_thread,
-                                          preview->file_path, &app->summary_config, app->summary_cache)) {
-                    atomic_store(&app->summary_thread_active, true);
+                if (summarize_async_start(app->summary_executor, &app->async_summary_request,
+                                          preview->file_path, &app->summary_config, app->summary_cache,
+                                          SUMM_PRIORITY_HOVER)) {
                     bs->summary_state = HOVER_LOADING;
                     strncpy(bs->summary_path, preview->file_path, sizeof(bs->summary_path) - 1);
                 }
@@ -1189,8 +1674,13 @@ void preview_draw(struct App *app)
             int available_height = preview_height - (text_start_y - content_offset) - PADDING;
             int visible_lines = available_height / line_height;
 
+            // The git view draws its own text in place of the file's
+            bool git = preview->git_view != PREVIEW_GIT_OFF;
+            struct TextMap *map = git ? preview->git_map : preview->text_map;
+            SyntaxHighlighter *syntax = git ? preview->git_syntax : preview->syntax;
+
             // PREVIEW_TEXT: Word-wrapped prose view (no line numbers)
-            if (preview->type == PREVIEW_TEXT && preview->wrapped_content) {
+            if (preview_shows_prose(preview)) {
                 // Draw wrapped text with scrolling
                 draw_text_wrapped_scrolled(
                     preview->wrapped_content,
@@ -1218,57 +1708,50 @@ void preview_draw(struct App *app)
                 }
             }
             // PREVIEW_CODE/PREVIEW_MARKDOWN: Line-based view with line numbers
-            else if (preview->text_content) {
-                // Get lines
-                char *line_start = preview->text_content;
-                int line_num = 0;
-
-                // Skip to scroll offset
-                while (*line_start && line_num < preview->scroll_offset) {
-                    if (*line_start == '\n') line_num++;
-                    line_start++;
-                }
+            else if (map && !(git && text_map_size(map) == 0)) {
+                preview_sync_text_lines(preview);
+
+                // Only the lines on screen are read from the file (and highlighted)
+                syntax_request(syntax, preview->scroll_offset, visible_lines);
 
                 int drawn = 0;
-                char line_buffer[256];
+                char line_buffer[SYNTAX_LINE_BYTES + 1];
+                Color byte_colors[SYNTAX_LINE_BYTES + 1];
+                SyntaxSpan spans[SYNTAX_MAX_SPANS];
                 int y = text_start_y;
+                const char *line_start;
+                size_t len;
 
-                while (*line_start && drawn < visible_lines) {
-                    char *line_end = strchr(line_start, '\n');
-                    int len = line_end ? (int)(line_end - line_start) : (int)strlen(line_start);
-
-                    if (len > (int)sizeof(line_buffer) - 1) {
-                        len = (int)sizeof(line_buffer) - 1;
-                    }
-
-                    strncpy(line_buffer, line_start, len);
+                while (drawn < visible_lines &&
+                       text_map_line(map, preview->scroll_offset + drawn,
+                                     &line_start, &len, sizeof(line_buffer) - 1)) {
+                    memcpy(line_buffer, line_start, len);
                     line_buffer[len] = '\0';
 
-                    // Truncate if too long
-                    int max_chars = (content_width - 30) / 7;
-                    if ((int)strlen(line_buffer) > max_chars && max_chars > 3) {
-                        line_buffer[max_chars - 3] = '.';
-                        line_buffer[max_chars - 2] = '.';
-                        line_buffer[max_chars - 1] = '.';
-                        line_buffer[max_chars] = '\0';
-                    }
-
                     // Line number
-                    char line_num_str[8];
+                    char line_num_str[12];
                     snprintf(line_num_str, sizeof(line_num_str), "%3d", preview->scroll_offset + drawn + 1);
                     DrawTextCustom(line_num_str, content_x, y, FONT_SIZE_SMALL, g_theme.textSecondary);
 
-                    // Line content
-                    DrawTextCustom(line_buffer, content_x + 30, y, FONT_SIZE_SMALL, g_theme.textPrimary);
+                    // Line content, plain until its highlighting is ready, cut to the pane
+                    int span_count = syntax_line_spans(syntax, preview->scroll_offset + drawn,
+                                                       spans, SYNTAX_MAX_SPANS);
+                    const Color *colors = NULL;
+                    if (span_count > 0) {
+                        for (size_t b = 0; b < len; b++) byte_colors[b] = g_theme.textPrimary;
+                        for (int k = 0; k < span_count; k++) {
+                            Color color = syntax_color(spans[k].kind);
+                            for (int b = spans[k].start; b < spans[k].start + spans[k].len && b < (int)len; b++) {
+                                byte_colors[b] = color;
+                            }
+                        }
+                        colors = byte_colors;
+                    }
+                    DrawTextFitColored(line_buffer, content_x + 30, y, FONT_SIZE_SMALL, content_width - 30,
+                                       g_theme.textPrimary, colors);
 
                     y += line_height;
                     drawn++;
-
-                    if (line_end) {
-                        line_start = line_end + 1;
-                    } else {
-                        break;
-                    }
                 }
 
                 // Scroll indicator
@@ -1282,13 +1765,20 @@ void preview_draw(struct App *app)
                     DrawRectangle(preview_x + preview->width - 8, text_start_y, 4, scrollbar_height, g_theme.sidebar);
                     DrawRectangle(preview_x + preview->width - 8, thumb_y, 4, thumb_height, g_theme.selection);
                 }
+            } else if (git && map) {
+                DrawTextCustom(preview->git_view == PREVIEW_GIT_DIFF ? "No changes against HEAD" : "No history",
+                               content_x, text_start_y, FONT_SIZE_SMALL, g_theme.textSecondary);
+            } else if (git && preview->git_failed) {
+                DrawTextCustom("Not in a git repository", content_x, text_start_y, FONT_SIZE_SMALL, g_theme.textSecondary);
+            } else if (preview->deferred || (git && preview->git_loading)) {
+                DrawTextCustom("Loading...", content_x, text_start_y, FONT_SIZE_SMALL, g_theme.textSecondary);
             }
             break;
         }
 
         case PREVIEW_PDF:
-            DrawTextCustom("PDF Preview", content_x, content_y, FONT_SIZE, g_theme.textPrimary);
-            DrawTextCustom("(not yet supported)", content_x, content_y + ROW_HEIGHT, FONT_SIZE_SMALL, g_theme.textSecondary);
+            preview_draw_pdf(preview, content_x, content_y, content_width,
+                             content_offset + preview_height - PADDING - content_y);
             break;
 
         case PREVIEW_VIDEO: {
@@ -1297,6 +1787,8 @@ void preview_draw(struct App *app)
             int draw_height = 0;
             int draw_x = content_x;
 
+            preview_poll_video(preview);
+
             // Check if in-pane playback is active and we have frames
             if (preview->video_inpane_active && preview->video_frame_texture_id != 0) {
                 // Playing video in-pane: render current frame
@@ -1305,7 +1797,7 @@ void preview_draw(struct App *app)
                     .width = preview->video_frame_width,
                     .height = preview->video_frame_height,
                     .mipmaps = 1,
-                    .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8
+                    .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
                 };
 
                 // Scale frame to fit
@@ -1322,7 +1814,12 @@ void preview_draw(struct App *app)
                 draw_height = (int)(preview->video_frame_height * scale);
                 draw_x = content_x + (content_width - draw_width) / 2;
 
-                DrawTextureEx(tex, (Vector2){(float)draw_x, (float)draw_y}, 0.0f, scale, WHITE);
+                Vector2 position = {(float)draw_x, (float)draw_y};
+                if (preview->video_decoder) {
+                    DrawTextureEx(tex, position, 0.0f, scale, WHITE);
+                } else {
+                    preview_draw_yuv_frame(preview, position, scale);
+                }
                 draw_y += draw_height + PADDING;
 
             } else if (preview->video_loaded && preview->video_thumbnail_id != 0) {
@@ -1349,10 +1846,22 @@ void preview_draw(struct App *app)
                 draw_height = (int)(preview->image_height * scale);
                 draw_x = content_x + (content_width - draw_width) / 2;
 
-                DrawTextureEx(tex, (Vector2){(float)draw_x, (float)draw_y}, 0.0f, scale, WHITE);
+                // Hovering scrubs through the sprite sheet, stretched over the thumbnail
+                Rectangle dest = { (float)draw_x, (float)draw_y, (float)draw_width, (float)draw_height };
+                Vector2 mouse = GetMousePosition();
+                bool scrubbing = preview->video_sprites.id != 0 && !preview->video_inpane_active &&
+                                 CheckCollisionPointRec(mouse, dest);
+                if (scrubbing) {
+                    Rectangle source = thumbnails_sprite_frame(preview->video_sprites.width,
+                                                               preview->video_sprites.height,
+                                                               (mouse.x - dest.x) / dest.width);
+                    DrawTexturePro(preview->video_sprites, source, dest, (Vector2){ 0, 0 }, 0.0f, WHITE);
+                } else {
+                    DrawTextureEx(tex, (Vector2){(float)draw_x, (float)draw_y}, 0.0f, scale, WHITE);
+                }
 
-                // Draw play button overlay when not playing
-                if (!preview->video_inpane_active) {
+                // Draw play button overlay when not playing (or scrubbing)
+                if (!preview->video_inpane_active && !scrubbing) {
                     int center_x = draw_x + draw_width / 2;
                     int center_y = draw_y + draw_height / 2;
                     int button_radius = 30;
@@ -1368,10 +1877,11 @@ void preview_draw(struct App *app)
 
                 draw_y += draw_height + PADDING;
             } else {
-                // No thumbnail available
+                // No thumbnail available (yet)
                 DrawTextCustom("Video Preview", content_x, draw_y, FONT_SIZE, g_theme.textPrimary);
                 draw_y += ROW_HEIGHT;
-                DrawTextCustom("(thumbnail unavailable)", content_x, draw_y, FONT_SIZE_SMALL, g_theme.textSecondary);
+                DrawTextCustom(preview->video_loading || preview->deferred ? "Loading..." : "(thumbnail unavailable)",
+                               content_x, draw_y, FONT_SIZE_SMALL, g_theme.textSecondary);
                 draw_y += ROW_HEIGHT + PADDING;
             }
 
@@ -1500,7 +2010,21 @@ void preview_draw(struct App *app)
         DrawTextCustom("AI Summary", summary_x, text_y, FONT_SIZE, g_theme.aiAccent);
         text_y += ROW_HEIGHT;
 
-        if (bs->summary_state == HOVER_LOADING) {
+        if (bs->summary_state == HOVER_LOADING && bs->summary_text[0] != '\0') {
+            // Summary streaming in: show what has arrived, keeping the newest text in view
+            int line_height = FONT_SIZE_SMALL + 2;
+            int available_height = summary_pane_height - ROW_HEIGHT - PADDING * 3;
+            int visible_lines = available_height / line_height;
+            if (visible_lines < 1) visible_lines = 1;
+
+            int total_lines = measure_text_lines(bs->summary_text, summary_width, FONT_SIZE_SMALL);
+            int first_line = total_lines > visible_lines ? total_lines - visible_lines : 0;
+            draw_text_wrapped_scrolled(bs->summary_text, summary_x, text_y,
+                                       summary_width, visible_lines, first_line,
+                                       FONT_SIZE_SMALL, g_theme.textPrimary);
+            preview->summary_scroll_offset = 0;
+            preview->summary_total_lines = 0;
+        } else if (bs->summary_state == HOVER_LOADING) {
             // Show loading indicator with animated dots
             static float dots_timer = 0.0f;
             dots_timer += GetFrameTime();
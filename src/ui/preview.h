@@ -2,14 +2,23 @@
 #define PREVIEW_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <sys/types.h>
+#include <time.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include "progress_indicator.h"
+#include "../utils/file_type.h"
 
 #define PREVIEW_DEFAULT_WIDTH 300
 #define PREVIEW_MIN_WIDTH 200
 #define PREVIEW_MAX_WIDTH 500
 #define PREVIEW_EDIT_BUFFER_SIZE 512
+#define PREVIEW_MODAL_TEXT_SIZE (1024 * 1024)   // Most text opened in the file view modal
+#define PREVIEW_VIDEO_SLOTS 3           // Frame slots: one decoding, one shared, one shown
+#define PREVIEW_VIDEO_FRESH 4           // Flag on the shared slot: holds a frame not yet shown
+#define PREVIEW_SETTLE_SECONDS 0.15     // Cursor rest before a selected file's preview loads
 
 // Summary pane constants
 #define SUMMARY_PANE_HEIGHT 150      // Default height of summary pane
@@ -28,6 +37,13 @@ typedef enum PreviewType {
     PREVIEW_UNKNOWN
 } PreviewType;
 
+// What a text preview shows: the file, or its git diff or history instead
+typedef enum PreviewGitView {
+    PREVIEW_GIT_OFF,
+    PREVIEW_GIT_DIFF,           // Changes against HEAD
+    PREVIEW_GIT_LOG             // Commits that touched the file
+} PreviewGitView;
+
 // Image edit state
 typedef enum ImageEditState {
     IMAGE_EDIT_NONE,       // Not editing
@@ -46,20 +62,44 @@ typedef struct PreviewState {
     // Cached preview content
     char file_path[4096];       // Currently previewed file
     PreviewType type;           // Type of preview
+    uint64_t generation;        // Bumped whenever the previewed file changes
+    bool deferred;              // Selected, content not loaded until the cursor rests
+    double deferred_since;      // When the selection reached file_path
+    time_t file_mtime;          // From the listing, for the grid thumbnail (size 0: unknown)
+    off_t file_size;
+    struct PreviewLoader *loader;  // Video thumbnails and metadata, loaded in the background
 
     // Text preview
-    char *text_content;         // Loaded text content (raw)
-    int text_lines;             // Number of lines (raw)
+    struct TextMap *text_map;   // Mapped file, its lines indexed in the background
+    int text_lines;             // Number of lines (raw) found so far
+    struct SyntaxHighlighter *syntax;  // Highlighting for PREVIEW_CODE (NULL: plain)
     int scroll_offset;          // Scroll position (in wrapped lines)
 
+    // Git view of a text file (core/git_preview.h), read in the background and drawn like
+    // code; the view stays on from file to file
+    PreviewGitView git_view;
+    struct GitPreview *git;     // Loader, created on first use
+    struct GitPreviewText *git_text;   // Output shown (a reference)
+    struct TextMap *git_map;    // Its lines
+    struct SyntaxHighlighter *git_syntax;
+    bool git_loading;           // Requested, not read yet
+    bool git_failed;            // Not in a repository (or no commits yet)
+
     // Wrapped text for PREVIEW_TEXT (prose display)
     char *wrapped_content;      // Word-truncated content (~300 words + "...")
     int wrapped_total_lines;    // Total wrapped lines for scrollbar
 
+    // PDF preview
+    struct PdfPreview *pdf;     // Pages rendered in the background as they come into view
+    float pdf_scroll;           // Pixels scrolled down the stacked pages
+
     // Image preview
-    unsigned int texture_id;    // Raylib texture ID (0 if none)
-    int image_width;            // Original image width
-    int image_height;           // Original image height
+    struct ImagePreviewCache *images;  // Recent preview textures, decoded in the background
+    unsigned int texture_id;    // Raylib texture ID (0 if none; owned by images)
+    int image_width;            // Texture width (downsampled to the pane)
+    int image_height;           // Texture height
+    int image_original_width;   // Image file width
+    int image_original_height;  // Image file height
     bool image_loaded;          // Whether image is loaded
     char image_format[16];      // Image format (PNG, JPEG, etc.)
     int image_bit_depth;        // Bit depth of loaded image
@@ -74,9 +114,12 @@ typedef struct PreviewState {
 
     // Video preview
     bool video_loaded;                  // Whether video thumbnail is loaded
+    bool video_loading;                 // Thumbnail and metadata still being loaded
     bool video_playing;                 // Whether video is currently playing
     char video_thumbnail_path[4096];    // Path to cached thumbnail
     unsigned int video_thumbnail_id;    // Thumbnail texture ID
+    Texture2D video_sprites;            // Hover-scrub sprite sheet (id 0 until loaded)
+    bool video_sprites_loading;         // Sprite sheet still being made after the thumbnail
     int video_width;                    // Video width
     int video_height;                   // Video height
     float video_duration;               // Video duration in seconds
@@ -86,25 +129,31 @@ typedef struct PreviewState {
     int video_bit_depth;                // Video bit depth (8, 10, 12)
 
     // In-pane video playback
-    unsigned int video_frame_texture_id;  // Texture for current video frame
-    unsigned char *video_frame_buffer;    // Raw RGB frame buffer (for texture update)
-    unsigned char *video_decode_buffer;   // Decode buffer (written by thread)
+    unsigned int video_frame_texture_id;  // Texture for current video frame (Y plane for ffmpeg)
+    unsigned int video_plane_u_id;        // U and V plane textures (ffmpeg)
+    unsigned int video_plane_v_id;
+    unsigned char *video_frames[PREVIEW_VIDEO_SLOTS];  // YUV420 frame slots (triple buffer)
+    int video_frame_back;                 // Slot the decode thread fills
+    int video_frame_front;                // Slot last uploaded by the UI thread
+    atomic_int video_frame_shared;        // Slot passed between them (| PREVIEW_VIDEO_FRESH when unseen)
     int video_frame_width;                // Frame width
     int video_frame_height;               // Frame height
     pid_t video_decoder_pid;              // ffmpeg decoder process
     int video_pipe_fd;                    // Pipe for frames
-    bool video_frame_ready;               // New frame available from thread
-    bool video_paused;                    // Playback paused
+    bool video_paused;                    // Playback paused (changed under video_mutex)
     float video_fps;                      // Video frame rate
     bool video_inpane_active;             // In-pane playback active
     double video_last_frame_time;         // Time of last frame update for FPS limiting
+    struct PlatformVideo *video_decoder;  // In-process decoder (NULL: ffmpeg pipe)
+    double video_position;                // Playback time of the in-process decoder (seconds)
 
     // Video decode thread
     pthread_t video_thread;               // Background decode thread
-    pthread_mutex_t video_mutex;          // Protects frame buffer
-    bool video_thread_running;            // Thread should keep running
+    pthread_mutex_t video_mutex;          // Guards video_paused for the thread
+    pthread_cond_t video_resume;          // Signalled on resume and stop
+    atomic_bool video_thread_running;     // Thread should keep running
     bool video_thread_active;             // Thread is currently active
-    bool video_eof;                       // Video reached end
+    atomic_bool video_eof;                // Video reached end
 
     // Summary pane state
     bool summary_pane_visible;            // Whether summary pane is expanded
@@ -128,12 +177,33 @@ void preview_toggle(PreviewState *preview);
 // Load preview for a file
 void preview_load(PreviewState *preview, const char *file_path);
 
+// Follow the selection (call every frame with the selected file and its listed mtime
+// and size). The name and type show at once, as do images already decoded and, as a
+// stand-in, the grid thumbnail; the content loads once the selection has stayed on the
+// file for PREVIEW_SETTLE_SECONDS, so holding an arrow key loads nothing it passes
+void preview_select(PreviewState *preview, const char *file_path, time_t mtime, off_t size, double now);
+
 // Clear current preview
 void preview_clear(PreviewState *preview);
 
+// Show the previewed text file's git diff or history in its place (PREVIEW_GIT_OFF: the
+// file again); stays on for the files previewed after it
+void preview_set_git_view(PreviewState *preview, PreviewGitView view);
+
+// Copy of the start of the previewed text (at most max_bytes), NUL-terminated; NULL
+// when no text is loaded. Caller frees
+char* preview_copy_text(const PreviewState *preview, size_t max_bytes);
+
+// Whether the preview is still loading in the background (a selection settling, text
+// being indexed or highlighted, an image being decoded, a video being probed)
+bool preview_is_loading(PreviewState *preview);
+
 // Determine preview type from file extension
 PreviewType preview_type_from_extension(const char *extension);
 
+// Determine preview type from a file type (utils/file_type.h)
+PreviewType preview_type_from_file_type(FileTypeId type);
+
 // Handle preview input (resize, scroll)
 // Returns true if input was consumed (blocks other input handlers)
 bool preview_handle_input(struct App *app);
@@ -0,0 +1,198 @@
+#include "preview_loader.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct PreviewLoader {
+    pthread_mutex_t mutex;
+    pthread_cond_t work;                // A request arrived, or stopping
+    pthread_t thread;
+    bool stopping;
+
+    // Guarded by mutex
+    char request[4096];
+    uint64_t request_generation;
+    bool request_pending;
+    bool loading;
+    PreviewVideoLoad done;              // Waiting to be polled
+    uint64_t done_generation;
+    bool has_done;
+};
+
+// Helper: Generate and read a video's thumbnail and probe its metadata (slow: runs
+// without the lock)
+static void load_video(const char *path, PreviewVideoLoad *load)
+{
+    memset(load, 0, sizeof(*load));
+    if (video_generate_thumbnail(path, load->thumbnail_path, sizeof(load->thumbnail_path))) {
+        load->thumbnail = LoadImage(load->thumbnail_path);
+        load->has_thumbnail = load->thumbnail.data != NULL;
+    }
+    // Cached by the thumbnail probe above
+    load->has_info = video_probe(path, &load->info);
+    load->sprites_follow = load->has_info && load->info.duration > 0.0f;
+}
+
+// Helper: Generate and read a video's sprite sheet (slow: runs without the lock)
+static void load_sprites(const char *path, PreviewVideoLoad *load)
+{
+    memset(load, 0, sizeof(*load));
+    char sheet_path[4096];
+    if (video_generate_sprite_sheet(path, sheet_path, sizeof(sheet_path))) {
+        load->sprites = LoadImage(sheet_path);
+        load->has_sprites = load->sprites.data != NULL;
+    }
+}
+
+// Helper: Drop a finished load nobody will show
+static void discard_load(PreviewVideoLoad *load)
+{
+    if (load->has_thumbnail) {
+        UnloadImage(load->thumbnail);
+        load->has_thumbnail = false;
+    }
+    if (load->has_sprites) {
+        UnloadImage(load->sprites);
+        load->has_sprites = false;
+    }
+}
+
+// Helper: Post a finished load (call with mutex held); a sprite sheet joins the
+// thumbnail load of its generation if that is still waiting to be polled
+static void post_load(PreviewLoader *loader, PreviewVideoLoad *load, uint64_t generation, bool sprites)
+{
+    if (sprites && loader->has_done && loader->done_generation == generation) {
+        loader->done.sprites_follow = false;
+        loader->done.has_sprites = load->has_sprites;
+        loader->done.sprites = load->sprites;
+        return;
+    }
+    if (loader->has_done) {
+        discard_load(&loader->done);
+    }
+    loader->done = *load;
+    loader->done_generation = generation;
+    loader->has_done = true;
+}
+
+// Thread function: Run the latest request
+static void *loader_thread(void *arg)
+{
+    PreviewLoader *loader = (PreviewLoader *)arg;
+    char path[4096];
+    PreviewVideoLoad load;
+
+    pthread_mutex_lock(&loader->mutex);
+    while (!loader->stopping) {
+        if (!loader->request_pending) {
+            pthread_cond_wait(&loader->work, &loader->mutex);
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s", loader->request);
+        uint64_t generation = loader->request_generation;
+        loader->request_pending = false;
+        loader->loading = true;
+        pthread_mutex_unlock(&loader->mutex);
+
+        load_video(path, &load);
+
+        pthread_mutex_lock(&loader->mutex);
+        post_load(loader, &load, generation, false);
+        if (!load.sprites_follow || loader->stopping) {
+            loader->loading = false;
+            continue;
+        }
+
+        // Then the sprite sheet, skipped (but still posted, empty) if the preview has
+        // moved on
+        if (loader->request_pending) {
+            memset(&load, 0, sizeof(load));
+        } else {
+            pthread_mutex_unlock(&loader->mutex);
+            load_sprites(path, &load);
+            pthread_mutex_lock(&loader->mutex);
+        }
+        loader->loading = false;
+        post_load(loader, &load, generation, true);
+    }
+    pthread_mutex_unlock(&loader->mutex);
+    return NULL;
+}
+
+PreviewLoader *preview_loader_create(void)
+{
+    PreviewLoader *loader = (PreviewLoader *)calloc(1, sizeof(PreviewLoader));
+    if (!loader) return NULL;
+
+    pthread_mutex_init(&loader->mutex, NULL);
+    pthread_cond_init(&loader->work, NULL);
+    if (pthread_create(&loader->thread, NULL, loader_thread, loader) != 0) {
+        pthread_cond_destroy(&loader->work);
+        pthread_mutex_destroy(&loader->mutex);
+        free(loader);
+        return NULL;
+    }
+    return loader;
+}
+
+void preview_loader_destroy(PreviewLoader *loader)
+{
+    if (!loader) return;
+
+    pthread_mutex_lock(&loader->mutex);
+    loader->stopping = true;
+    pthread_cond_broadcast(&loader->work);
+    pthread_mutex_unlock(&loader->mutex);
+    pthread_join(loader->thread, NULL);
+
+    if (loader->has_done) {
+        discard_load(&loader->done);
+    }
+    pthread_cond_destroy(&loader->work);
+    pthread_mutex_destroy(&loader->mutex);
+    free(loader);
+}
+
+void preview_loader_request_video(PreviewLoader *loader, const char *path, uint64_t generation)
+{
+    if (!loader || !path) return;
+
+    pthread_mutex_lock(&loader->mutex);
+    snprintf(loader->request, sizeof(loader->request), "%s", path);
+    loader->request_generation = generation;
+    loader->request_pending = true;
+    pthread_cond_signal(&loader->work);
+    pthread_mutex_unlock(&loader->mutex);
+}
+
+bool preview_loader_poll(PreviewLoader *loader, uint64_t generation, PreviewVideoLoad *out)
+{
+    if (!loader) return false;
+
+    bool found = false;
+    pthread_mutex_lock(&loader->mutex);
+    if (loader->has_done) {
+        if (loader->done_generation == generation) {
+            *out = loader->done;
+            found = true;
+        } else {
+            discard_load(&loader->done);
+        }
+        loader->has_done = false;
+    }
+    pthread_mutex_unlock(&loader->mutex);
+    return found;
+}
+
+bool preview_loader_is_busy(PreviewLoader *loader)
+{
+    if (!loader) return false;
+
+    pthread_mutex_lock(&loader->mutex);
+    bool busy = loader->request_pending || loader->loading || loader->has_done;
+    pthread_mutex_unlock(&loader->mutex);
+    return busy;
+}
@@ -0,0 +1,45 @@
+#ifndef PREVIEW_LOADER_H
+#define PREVIEW_LOADER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "raylib.h"
+#include "video.h"
+
+// Slow preview loads, run on a worker thread so the main thread never waits on them.
+// A video's thumbnail is generated (which may run ffmpeg) and read, and its metadata
+// probed, off the main thread; only the upload of the small thumbnail is left to it.
+// Its hover-scrub sprite sheet follows as a second load of the same generation, so the
+// thumbnail is never held back by it.
+// Each request carries the preview's generation: a newer request replaces one not yet
+// started, and results for an older generation are dropped rather than shown
+
+typedef struct PreviewVideoLoad {
+    bool has_thumbnail;
+    Image thumbnail;                    // RGBA; the receiver uploads and unloads it
+    char thumbnail_path[4096];
+    bool has_info;
+    VideoInfo info;
+    bool sprites_follow;                // The sprite sheet comes in a later load
+    bool has_sprites;
+    Image sprites;                      // RGBA; the receiver uploads and unloads it
+} PreviewVideoLoad;
+
+typedef struct PreviewLoader PreviewLoader;
+
+// Create and destroy the loader; NULL if its thread cannot start
+PreviewLoader *preview_loader_create(void);
+void preview_loader_destroy(PreviewLoader *loader);
+
+// Load a video's thumbnail and metadata, then its sprite sheet, for generation,
+// replacing any waiting request
+void preview_loader_request_video(PreviewLoader *loader, const char *path, uint64_t generation);
+
+// The finished load of generation, if any (true); finished loads of other
+// generations are discarded
+bool preview_loader_poll(PreviewLoader *loader, uint64_t generation, PreviewVideoLoad *out);
+
+// Whether a request is waiting, running or finished but not yet polled
+bool preview_loader_is_busy(PreviewLoader *loader);
+
+#endif // PREVIEW_LOADER_H
@@ -14,6 +14,7 @@
 #define BUTTON_WIDTH 60
 #define BUTTON_HEIGHT 24
 #define QUEUE_PADDING 8
+#define QUEUE_VISIBLE_ROWS_MAX ((PANEL_EXPANDED_HEIGHT - PANEL_COLLAPSED_HEIGHT) / QUEUE_ROW_HEIGHT + 1)
 
 void queue_panel_init(QueuePanelState *panel)
 {
@@ -134,10 +135,12 @@ void queue_panel_draw(struct App *app)
 
     // Header row
     int header_y = panel_y + 4;
-    int pending = operation_queue_pending_count(queue);
-    int total = operation_queue_total_count(queue);
-    bool is_processing = operation_queue_is_processing(queue);
-    bool is_paused = operation_queue_is_paused(queue);
+    QueueStatus queue_status;
+    operation_queue_status(queue, &queue_status);
+    int pending = queue_status.pending_count;
+    int total = queue_status.total_count;
+    bool is_processing = queue_status.is_processing;
+    bool is_paused = queue_status.is_paused;
 
     // Status text
     char status[128];
@@ -154,7 +157,7 @@ void queue_panel_draw(struct App *app)
     DrawTextCustom(status, QUEUE_PADDING, header_y + 4, 14, theme->textPrimary);
 
     // Progress bar for overall progress
-    int progress = operation_queue_overall_progress(queue);
+    int progress = queue_status.progress;
     int progress_x = QUEUE_PADDING + MeasureTextCustom(status, 14) + 20;
     int progress_width = 150;
     draw_progress_bar(progress_x, header_y + 6, progress_width, 12, progress, theme->hover, theme->accent);
@@ -205,15 +208,20 @@ void queue_panel_draw(struct App *app)
         int list_y = panel_y + PANEL_COLLAPSED_HEIGHT;
         int list_height = panel_height - PANEL_COLLAPSED_HEIGHT;
         int visible_rows = list_height / QUEUE_ROW_HEIGHT;
+        if (visible_rows > QUEUE_VISIBLE_ROWS_MAX) visible_rows = QUEUE_VISIBLE_ROWS_MAX;
 
-        // Draw operation list
-        for (int i = 0; i < queue->count && i < visible_rows + app->queue_panel.scroll_offset; i++) {
-            if (i < app->queue_panel.scroll_offset) continue;
+        // Copy just the visible rows; workers keep changing the queue while we draw
+        QueueRow rows[QUEUE_VISIBLE_ROWS_MAX];
+        int first = app->queue_panel.scroll_offset > 0 ? app->queue_panel.scroll_offset : 0;
+        int row_count = operation_queue_rows(queue, first, rows, visible_rows);
 
-            int row_y = list_y + (i - app->queue_panel.scroll_offset) * QUEUE_ROW_HEIGHT;
+        // Draw operation list
+        for (int r = 0; r < row_count; r++) {
+            int i = first + r;
+            int row_y = list_y + r * QUEUE_ROW_HEIGHT;
             if (row_y + QUEUE_ROW_HEIGHT > app->height) break;
 
-            QueuedOperation *op = &queue->operations[i];
+            QueueRow *op = &rows[r];
 
             // Highlight selected/hovered row
             if (i == app->queue_panel.selected_index) {
@@ -265,15 +273,19 @@ void queue_panel_draw(struct App *app)
 
             // Progress for in-progress operations
             if (op->status == OP_STATUS_IN_PROGRESS) {
-                draw_progress_bar(panel_width - 160, row_y + (QUEUE_ROW_HEIGHT - 10) / 2, 80, 10, op->progress, theme->hover, theme->accent);
+                int op_progress = operation_queue_operation_progress(queue, op->id);
+                if (op_progress < 0) op_progress = op->progress;
+                draw_progress_bar(panel_width - 160, row_y + (QUEUE_ROW_HEIGHT - 10) / 2, 80, 10, op_progress, theme->hover, theme->accent);
             }
 
             // Cancel/Retry button for applicable operations
-            if (op->status == OP_STATUS_PENDING) {
+            bool is_copy = op->type == QUEUE_OP_COPY || op->type == QUEUE_OP_MOVE || op->type == QUEUE_OP_DUPLICATE ||
+                           op->type == QUEUE_OP_SYNC || op->type == QUEUE_OP_MOVE_BATCH || op->type == QUEUE_OP_REMOVE;
+            if (op->status == OP_STATUS_PENDING || (op->status == OP_STATUS_IN_PROGRESS && is_copy)) {
                 if (draw_button(panel_width - 70, row_y + 2, 60, QUEUE_ROW_HEIGHT - 4, "Cancel", theme->hover, theme->error, theme->textPrimary)) {
                     operation_queue_cancel(queue, op->id);
                 }
-            } else if (op->status == OP_STATUS_FAILED && op->can_retry) {
+            } else if ((op->status == OP_STATUS_FAILED || op->status == OP_STATUS_CANCELLED) && op->can_retry) {
                 if (draw_button(panel_width - 70, row_y + 2, 60, QUEUE_ROW_HEIGHT - 4, "Retry", theme->hover, theme->warning, theme->textPrimary)) {
                     operation_queue_retry(queue, op->id);
                 }
@@ -281,9 +293,9 @@ void queue_panel_draw(struct App *app)
         }
 
         // Scrollbar if needed
-        if (queue->count > visible_rows) {
-            int scrollbar_height = (visible_rows * list_height) / queue->count;
-            int scrollbar_y = list_y + (app->queue_panel.scroll_offset * list_height) / queue->count;
+        if (total > visible_rows) {
+            int scrollbar_height = (visible_rows * list_height) / total;
+            int scrollbar_y = list_y + (app->queue_panel.scroll_offset * list_height) / total;
             DrawRectangle(panel_width - 8, scrollbar_y, 6, scrollbar_height, theme->border);
         }
     }
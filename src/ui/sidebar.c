@@ -4,6 +4,7 @@
 #include "../core/network.h"
 #include "../utils/theme.h"
 #include "../utils/font.h"
+#include "../utils/trace.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -105,6 +106,7 @@ static void draw_network_item(int x, int y, int width, const char *name, Connect
 
 void sidebar_draw(App *app)
 {
+    TRACE_SCOPE("sidebar_draw");
     if (app->sidebar.collapsed) {
         return;
     }
@@ -138,6 +140,26 @@ void sidebar_draw(App *app)
         y += SIDEBAR_ITEM_HEIGHT;
     }
 
+    // Smart folders section (only show once one is saved)
+    int smart_count = smart_folders_count(app->smart_folders);
+    if (smart_count > 0) {
+        y += PADDING * 2;
+        DrawTextCustom("Smart Folders", PADDING, y + (SECTION_HEADER_HEIGHT - FONT_SIZE_SMALL) / 2, FONT_SIZE_SMALL, g_theme.textSecondary);
+        y += SECTION_HEADER_HEIGHT;
+
+        for (int i = 0; i < smart_count; i++) {
+            SmartFolderInfo info;
+            if (!smart_folders_info(app->smart_folders, i, &info)) {
+                break;
+            }
+            bool is_hovered = (app->sidebar.hovered_index == 300 + i);
+            bool is_selected = (app->smart_folder_open == i);
+
+            draw_sidebar_item(0, y, width - RESIZE_HANDLE_WIDTH, info.name, false, is_selected, is_hovered);
+            y += SIDEBAR_ITEM_HEIGHT;
+        }
+    }
+
     // Spacing
     y += PADDING * 2;
 
@@ -241,6 +263,7 @@ void sidebar_handle_input(App *app)
 
             if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
                 // Navigate to this favorite
+                app->smart_folder_open = -1;
                 if (directory_read(&app->directory, app->sidebar.favorites[i].path)) {
                     app->selected_index = 0;
                     app->scroll_offset = 0;
@@ -253,6 +276,27 @@ void sidebar_handle_input(App *app)
         y += SIDEBAR_ITEM_HEIGHT;
     }
 
+    // Check smart folders
+    int smart_count = smart_folders_count(app->smart_folders);
+    if (smart_count > 0) {
+        y += PADDING * 2 + SECTION_HEADER_HEIGHT; // Skip spacing and "Smart Folders" header
+
+        for (int i = 0; i < smart_count; i++) {
+            if (mouse.y >= y && mouse.y < y + SIDEBAR_ITEM_HEIGHT) {
+                app->sidebar.hovered_index = 300 + i;
+
+                if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+                    // Show the folder's members in the browser
+                    if (app_open_smart_folder(app, i)) {
+                        history_push(&app->history, app->directory.current_path);
+                    }
+                }
+                return;
+            }
+            y += SIDEBAR_ITEM_HEIGHT;
+        }
+    }
+
     y += PADDING * 2 + SECTION_HEADER_HEIGHT; // Skip spacing and "Locations" header
 
     // Check volumes
@@ -262,6 +306,7 @@ void sidebar_handle_input(App *app)
 
             if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
                 // Navigate to this volume
+                app->smart_folder_open = -1;
                 if (directory_read(&app->directory, app->sidebar.volumes[i].path)) {
                     app->selected_index = 0;
                     app->scroll_offset = 0;
@@ -6,12 +6,14 @@
 #include "../utils/theme.h"
 #include "../utils/font.h"
 #include "../utils/perf.h"
+#include "../utils/trace.h"
 
 #include <stdio.h>
 #include <string.h>
 
 void statusbar_draw(App *app)
 {
+    TRACE_SCOPE("statusbar_draw");
     int y = app->height - STATUSBAR_HEIGHT;
 
     // Background
@@ -25,7 +27,9 @@ void statusbar_draw(App *app)
 
     // Item count
     char items_str[64];
-    if (app->directory.count == 1) {
+    if (app->directory.is_loading) {
+        snprintf(items_str, sizeof(items_str), "%d items (loading...)", app->directory.count);
+    } else if (app->directory.count == 1) {
         snprintf(items_str, sizeof(items_str), "1 item");
     } else {
         snprintf(items_str, sizeof(items_str), "%d items", app->directory.count);
@@ -33,13 +37,40 @@ void statusbar_draw(App *app)
     DrawTextCustom(items_str, x, text_y, FONT_SIZE_SMALL, g_theme.textSecondary);
     x += MeasureTextCustom(items_str, FONT_SIZE_SMALL) + PADDING * 2;
 
+    // Selection total: summed from the size column when the selection or the listing
+    // changes, not every frame
+    if (app->selection.count > 1 && !app->directory.is_loading) {
+        static uint32_t cached_selection = 0, cached_directory = 0;
+        static off_t total = 0;
+        static int files = 0;
+        if (cached_selection != app->selection.generation ||
+            cached_directory != app->directory.generation) {
+            total = directory_sum_sizes(&app->directory, app->selection.bits,
+                                        app->selection.words, &files);
+            cached_selection = app->selection.generation;
+            cached_directory = app->directory.generation;
+        }
+        char selected_str[64];
+        if (files > 0) {
+            char size_str[32];
+            format_file_size(total, size_str, sizeof(size_str));
+            snprintf(selected_str, sizeof(selected_str), "%d selected, %s", app->selection.count, size_str);
+        } else {
+            snprintf(selected_str, sizeof(selected_str), "%d selected", app->selection.count);
+        }
+        DrawTextCustom(selected_str, x, text_y, FONT_SIZE_SMALL, g_theme.textSecondary);
+        x += MeasureTextCustom(selected_str, FONT_SIZE_SMALL) + PADDING * 2;
+    }
+
     // Show operation queue progress if there are pending/active operations
-    int pending = operation_queue_pending_count(&app->op_queue);
-    bool is_processing = operation_queue_is_processing(&app->op_queue);
+    QueueStatus queue_status;
+    operation_queue_status(&app->op_queue, &queue_status);
+    int pending = queue_status.pending_count;
+    bool is_processing = queue_status.is_processing;
 
     if (pending > 0 || is_processing) {
         // Draw progress bar and status
-        int progress = operation_queue_overall_progress(&app->op_queue);
+        int progress = queue_status.progress;
 
         // Progress bar background
         int bar_width = 100;
@@ -55,9 +86,8 @@ void statusbar_draw(App *app)
         // Operation text
         char op_status[64];
         if (is_processing) {
-            QueuedOperation *current = operation_queue_current(&app->op_queue);
-            if (current) {
-                const char *op_name = queue_op_type_name(current->type);
+            if (queue_status.has_current) {
+                const char *op_name = queue_op_type_name(queue_status.current_type);
                 snprintf(op_status, sizeof(op_status), "%s %d%%", op_name, progress);
             } else {
                 snprintf(op_status, sizeof(op_status), "Working... %d%%", progress);
@@ -106,7 +136,10 @@ void statusbar_draw(App *app)
     // Right side: Git branch, Free disk space and FPS
     char right_info[256];
 
-    off_t free_space = get_free_disk_space(app->directory.current_path);
+    // From the volume service's last reading: no syscall per frame
+    VolumeInfo volume;
+    off_t free_space = volumes_lookup(app->volumes, app->directory.current_path, &volume)
+                       ? volume.available : -1;
     char free_space_str[32];
     if (free_space >= 0) {
         format_file_size(free_space, free_space_str, sizeof(free_space_str));
@@ -181,16 +214,44 @@ void statusbar_draw(App *app)
     // Show performance stats overlay if enabled (Cmd+Shift+P to toggle)
     if (app->show_perf_stats) {
         char perf_str[256];
+        char timing_str[256];
+        char memory_str[256];
+        char startup_str[256];
+        char index_str[320] = "";
         perf_get_stats_string(&app->perf, perf_str, sizeof(perf_str));
+        timing_get_stats_string(&app->perf.timings, timing_str, sizeof(timing_str));
+        memory_get_stats_string(memory_str, sizeof(memory_str));
+        startup_get_stats_string(startup_str, sizeof(startup_str));
+        if (app->indexer) {
+            IndexerStats index_stats = indexer_get_stats(app->indexer);
+            indexer_stats_string(&index_stats, index_str, sizeof(index_str));
+        }
+        int lines = index_str[0] ? 5 : 4;
 
-        // Draw perf stats in a box at the top-right
-        int perf_width = MeasureTextCustom(perf_str, FONT_SIZE_SMALL) + PADDING * 2;
-        int perf_height = FONT_SIZE_SMALL + PADDING * 2;
+        // Draw perf stats in a box at the top-right, frame pacing, memory, startup and indexing below
+        int perf_width = MeasureTextCustom(perf_str, FONT_SIZE_SMALL);
+        int timing_width = MeasureTextCustom(timing_str, FONT_SIZE_SMALL);
+        int memory_width = MeasureTextCustom(memory_str, FONT_SIZE_SMALL);
+        int startup_width = MeasureTextCustom(startup_str, FONT_SIZE_SMALL);
+        if (timing_width > perf_width) perf_width = timing_width;
+        if (memory_width > perf_width) perf_width = memory_width;
+        if (startup_width > perf_width) perf_width = startup_width;
+        int index_width = MeasureTextCustom(index_str, FONT_SIZE_SMALL);
+        if (index_width > perf_width) perf_width = index_width;
+        perf_width += PADDING * 2;
+        int line_height = FONT_SIZE_SMALL + 4;
+        int perf_height = line_height * (lines - 1) + FONT_SIZE_SMALL + PADDING * 2;
         int perf_x = app->width - perf_width - PADDING;
         int perf_y = y - perf_height - 4;
 
         DrawRectangle(perf_x, perf_y, perf_width, perf_height, Fade(g_theme.background, 0.9f));
         DrawRectangleLines(perf_x, perf_y, perf_width, perf_height, g_theme.accent);
         DrawTextCustom(perf_str, perf_x + PADDING, perf_y + PADDING, FONT_SIZE_SMALL, g_theme.accent);
+        DrawTextCustom(timing_str, perf_x + PADDING, perf_y + PADDING + line_height, FONT_SIZE_SMALL, g_theme.accent);
+        DrawTextCustom(memory_str, perf_x + PADDING, perf_y + PADDING + line_height * 2, FONT_SIZE_SMALL, g_theme.accent);
+        DrawTextCustom(startup_str, perf_x + PADDING, perf_y + PADDING + line_height * 3, FONT_SIZE_SMALL, g_theme.accent);
+        if (index_str[0]) {
+            DrawTextCustom(index_str, perf_x + PADDING, perf_y + PADDING + line_height * 4, FONT_SIZE_SMALL, g_theme.accent);
+        }
     }
 }
@@ -2,9 +2,12 @@
 #include "../app.h"
 #include "../utils/theme.h"
 #include "../utils/font.h"
+#include "../utils/trace.h"
+#include "../core/fs_watch.h"
 #include "raylib.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <libgen.h>
 
@@ -17,6 +20,50 @@ void tabs_init(TabState *tabs)
     tabs->close_hovered = false;
     tabs->dragging = false;
     tabs->drag_index = -1;
+    for (int i = 0; i < MAX_TABS; i++) {
+        tabs->tabs[i].watch_id = -1;
+    }
+}
+
+// Helper: Drop a tab's resident listing and stop watching it
+static void tab_release_listing(TabState *tabs, Tab *tab)
+{
+    if (tab->watch_id >= 0 && tabs->watch) {
+        fs_watch_unsubscribe(tabs->watch, tab->watch_id);
+    }
+    tab->watch_id = -1;
+    if (tab->resident) {
+        directory_state_free(&tab->directory);
+        tab->resident = false;
+    }
+    atomic_store(&tab->stale, false);
+}
+
+// Helper: Drop everything a tab keeps besides its path
+static void tab_release(TabState *tabs, Tab *tab)
+{
+    tab_release_listing(tabs, tab);
+    free(tab->columns);
+    tab->columns = NULL;
+    tab->parked = false;
+    tab->search_mode = SEARCH_INACTIVE;
+    tab->search_query[0] = '\0';
+    tab->search_cursor = 0;
+}
+
+void tabs_free(TabState *tabs)
+{
+    for (int i = 0; i < MAX_TABS; i++) {
+        tab_release(tabs, &tabs->tabs[i]);
+    }
+}
+
+void tabs_set_watch(TabState *tabs, struct FsWatch *watch)
+{
+    for (int i = 0; i < MAX_TABS; i++) {
+        tab_release_listing(tabs, &tabs->tabs[i]);
+    }
+    tabs->watch = watch;
 }
 
 void tabs_update_title(Tab *tab)
@@ -75,6 +122,7 @@ void tabs_close(TabState *tabs, int index)
     if (!tabs->tabs[index].active) return;
     if (tabs->count <= 1) return; // Keep at least one tab
 
+    tab_release(tabs, &tabs->tabs[index]);
     tabs->tabs[index].active = false;
     tabs->count--;
 
@@ -157,6 +205,96 @@ void tabs_sync_from_app(TabState *tabs, struct App *app)
     tabs_update_title(tab);
 }
 
+// Watch callback (dispatch thread): the folder behind a resident listing changed
+static void tab_watch_batch(const FsWatchBatch *batch, void *user_data)
+{
+    (void)batch;
+    atomic_store((atomic_bool *)user_data, true);
+}
+
+// Helper: Demote the least recently used background tabs to a bare path until at most
+// max_resident listings holding at most max_bytes remain
+static void tabs_trim_to(TabState *tabs, int max_resident, size_t max_bytes)
+{
+    for (;;) {
+        int resident = 0;
+        size_t bytes = 0;
+        Tab *oldest = NULL;
+        for (int i = 0; i < MAX_TABS; i++) {
+            Tab *tab = &tabs->tabs[i];
+            if (!tab->active || !tab->resident) continue;
+            resident++;
+            bytes += directory_state_bytes(&tab->directory);
+            if (!oldest || tab->last_used < oldest->last_used) {
+                oldest = tab;
+            }
+        }
+        if (!oldest || (resident <= max_resident && bytes <= max_bytes)) {
+            return;
+        }
+        tab_release_listing(tabs, oldest);
+    }
+}
+
+// Helper: Keep the resident listings within the count and byte limits
+static void tabs_enforce_budget(TabState *tabs)
+{
+    tabs_trim_to(tabs, TABS_RESIDENT_MAX, TABS_RESIDENT_BUDGET);
+}
+
+size_t tabs_resident_bytes(const TabState *tabs)
+{
+    size_t bytes = 0;
+    for (int i = 0; i < MAX_TABS; i++) {
+        const Tab *tab = &tabs->tabs[i];
+        if (tab->active && tab->resident) {
+            bytes += directory_state_bytes(&tab->directory);
+        }
+    }
+    return bytes;
+}
+
+void tabs_trim_resident(TabState *tabs, size_t target)
+{
+    tabs_trim_to(tabs, MAX_TABS, target);
+}
+
+// Helper: Save the current tab and keep what it shows for a switch back
+static void tabs_leave(TabState *tabs, struct App *app)
+{
+    tabs_sync_from_app(tabs, app);
+    if (tabs->current < 0 || tabs->current >= MAX_TABS) return;
+    Tab *tab = &tabs->tabs[tabs->current];
+    if (!tab->active) return;
+
+    tab->last_used = GetTime();
+    tab->parked = true;
+
+    // Columns and filter
+    if (!tab->columns) {
+        tab->columns = malloc(sizeof(ColumnState));
+    }
+    if (tab->columns) {
+        memcpy(tab->columns, &app->columns, sizeof(ColumnState));
+    }
+    tab->search_mode = app->search.mode;
+    memcpy(tab->search_query, app->search.query, sizeof(tab->search_query));
+    tab->search_cursor = app->search.cursor;
+
+    // The listing, shared rather than copied; a partial or failed one is read again
+    tab_release_listing(tabs, tab);
+    DirectoryState *dir = &app->directory;
+    if (dir->is_loading || dir->error_message[0] != '\0' || strcmp(dir->current_path, tab->path) != 0) {
+        return;
+    }
+    directory_state_copy(&tab->directory, dir);
+    tab->resident = true;
+    if (tabs->watch) {
+        tab->watch_id = fs_watch_subscribe(tabs->watch, tab->path, false, tab_watch_batch, &tab->stale);
+    }
+    tabs_enforce_budget(tabs);
+}
+
 void tabs_sync_to_app(TabState *tabs, struct App *app)
 {
     if (tabs->current < 0 || tabs->current >= MAX_TABS) return;
@@ -164,9 +302,38 @@ void tabs_sync_to_app(TabState *tabs, struct App *app)
 
     Tab *tab = &tabs->tabs[tabs->current];
 
-    // Only reload if path changed
-    if (strcmp(app->directory.current_path, tab->path) != 0) {
-        directory_read(&app->directory, tab->path);
+    if (tab->resident && directory_view_available(&tab->directory, app->directory.show_hidden)) {
+        // Show the kept listing now; a change seen while away reloads it in the background
+        bool streaming = app->directory.streaming;
+        bool show_hidden = app->directory.show_hidden;
+        directory_state_free(&app->directory);
+        directory_state_copy(&app->directory, &tab->directory);
+        directory_set_show_hidden(&app->directory, show_hidden);
+        app->directory.streaming = streaming;
+        if (atomic_load(&tab->stale) || !tabs->watch) {
+            atomic_store(&app->watch_dir_changed, true);
+        }
+    } else if (strcmp(app->directory.current_path, tab->path) != 0) {
+        // Only reload if path changed
+        directory_read_cached(&app->directory, tab->path, &app->perf.dir_cache);
+    }
+    tab_release_listing(tabs, tab);
+
+    // Columns and filter as the tab was left
+    if (tab->parked) {
+        tab->parked = false;
+        if (tab->columns) {
+            memcpy(&app->columns, tab->columns, sizeof(ColumnState));
+        }
+        if (tab->search_mode != SEARCH_INACTIVE) {
+            search_start(&app->search);
+            memcpy(app->search.query, tab->search_query, sizeof(app->search.query));
+            app->search.cursor = tab->search_cursor;
+            search_perform(&app->search, &app->directory);
+            app->search.mode = tab->search_mode;
+        } else if (search_is_active(&app->search)) {
+            search_stop(&app->search);
+        }
     }
 
     app->selected_index = tab->selected_index;
@@ -178,6 +345,27 @@ void tabs_sync_to_app(TabState *tabs, struct App *app)
     }
 }
 
+void tabs_activate(struct App *app, int index)
+{
+    TabState *tabs = &app->tabs;
+    if (index < 0 || index >= MAX_TABS || !tabs->tabs[index].active || index == tabs->current) return;
+
+    tabs_leave(tabs, app);
+    tabs_switch(tabs, index);
+    tabs_sync_to_app(tabs, app);
+}
+
+int tabs_open(struct App *app, const char *path)
+{
+    TabState *tabs = &app->tabs;
+    if (tabs->count >= MAX_TABS) return -1;
+
+    tabs_leave(tabs, app);
+    int index = tabs_new(tabs, path);
+    tabs_sync_to_app(tabs, app);
+    return index;
+}
+
 int tabs_get_height(TabState *tabs)
 {
     return (tabs->count > 0) ? TAB_HEIGHT : 0;
@@ -192,7 +380,7 @@ void tabs_handle_input(struct App *app)
     // New tab: Cmd+T
     if (cmd_down && IsKeyPressed(KEY_T)) {
         // Save current tab state first
-        tabs_sync_from_app(tabs, app);
+        tabs_leave(tabs, app);
         // Create new tab with current path
         tabs_new(tabs, app->directory.current_path);
     }
@@ -207,15 +395,15 @@ void tabs_handle_input(struct App *app)
     }
 
     // Next tab: Cmd+Shift+]
-    if (cmd_down && shift_down && IsKeyPressed(KEY_RIGHT_BRACKET)) {
-        tabs_sync_from_app(tabs, app);
+    if (cmd_down && shift_down && IsKeyPressed(KEY_RIGHT_BRACKET) && tabs->count > 1) {
+        tabs_leave(tabs, app);
         tabs_next(tabs);
         tabs_sync_to_app(tabs, app);
     }
 
     // Previous tab: Cmd+Shift+[
-    if (cmd_down && shift_down && IsKeyPressed(KEY_LEFT_BRACKET)) {
-        tabs_sync_from_app(tabs, app);
+    if (cmd_down && shift_down && IsKeyPressed(KEY_LEFT_BRACKET) && tabs->count > 1) {
+        tabs_leave(tabs, app);
         tabs_prev(tabs);
         tabs_sync_to_app(tabs, app);
     }
@@ -229,9 +417,7 @@ void tabs_handle_input(struct App *app)
                 for (int j = 0; j < MAX_TABS; j++) {
                     if (tabs->tabs[j].active) {
                         if (nth == i) {
-                            tabs_sync_from_app(tabs, app);
-                            tabs_switch(tabs, j);
-                            tabs_sync_to_app(tabs, app);
+                            tabs_activate(app, j);
                             break;
                         }
                         nth++;
@@ -289,9 +475,7 @@ void tabs_handle_input(struct App *app)
                         return;
                     }
                 } else if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-                    tabs_sync_from_app(tabs, app);
-                    tabs_switch(tabs, i);
-                    tabs_sync_to_app(tabs, app);
+                    tabs_activate(app, i);
                 }
 
                 break;
@@ -305,6 +489,7 @@ void tabs_handle_input(struct App *app)
 
 void tabs_draw(struct App *app)
 {
+    TRACE_SCOPE("tabs_draw");
     TabState *tabs = &app->tabs;
 
     if (tabs->count == 0) return;
@@ -407,7 +592,7 @@ void tabs_draw(struct App *app)
     DrawLine(plus_center_x, plus_center_y - 5, plus_center_x, plus_center_y + 5, plus_color);
 
     if (plus_hovered && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-        tabs_sync_from_app(tabs, app);
+        tabs_leave(tabs, app);
         tabs_new(tabs, app->directory.current_path);
     }
 }
@@ -2,7 +2,9 @@
 #define TABS_H
 
 #include "../core/filesystem.h"
+#include "../core/search.h"
 #include <stdbool.h>
+#include <stdatomic.h>
 
 #define MAX_TABS 32
 #define TAB_HEIGHT 28
@@ -10,6 +12,11 @@
 #define TAB_MAX_WIDTH 200
 #define TAB_CLOSE_SIZE 16
 
+// Background tabs keep their listing in memory; past either limit the least recently
+// used ones drop back to just a path and read it again when shown
+#define TABS_RESIDENT_MAX 8
+#define TABS_RESIDENT_BUDGET (128 * 1024 * 1024)   // Bytes of resident listings
+
 // Single tab state
 typedef struct Tab {
     char path[PATH_MAX_LEN];          // Current directory path
@@ -17,6 +24,18 @@ typedef struct Tab {
     int selected_index;                // Selected file in this tab
     int scroll_offset;                 // Scroll position
     bool active;                       // Whether this tab slot is in use
+
+    // Kept while the tab is in the background, so switching back reads nothing from disk
+    DirectoryState directory;          // Shares its buffers with the listing it was taken from
+    bool resident;                     // directory holds the listing of path
+    atomic_bool stale;                 // path changed since (set on the watch thread)
+    int watch_id;                      // Subscription on path while resident, -1 if none
+    double last_used;                  // When the tab was last left, for demotion
+    bool parked;                       // Columns and filter below wait to be restored
+    struct ColumnState *columns;       // Miller columns as left (NULL until first left)
+    SearchMode search_mode;            // Filter as left
+    char search_query[SEARCH_MAX_QUERY];
+    int search_cursor;
 } Tab;
 
 // Tab manager state
@@ -29,14 +48,29 @@ typedef struct TabState {
     bool dragging;                     // Whether dragging a tab
     int drag_index;                    // Index of tab being dragged
     int drag_offset_x;                 // X offset during drag
+    struct FsWatch *watch;             // Marks resident listings stale (NULL: never stale)
 } TabState;
 
-// Forward declaration
+// Forward declarations
 struct App;
+struct FsWatch;
 
 // Initialize tab state
 void tabs_init(TabState *tabs);
 
+// Release every tab's resident listing and saved state
+void tabs_free(TabState *tabs);
+
+// Watch resident listings for changes, so a switch back revalidates them
+void tabs_set_watch(TabState *tabs, struct FsWatch *watch);
+
+// Bytes held by background tabs' resident listings
+size_t tabs_resident_bytes(const TabState *tabs);
+
+// Demote the least recently used background tabs until their listings hold at most
+// target bytes
+void tabs_trim_resident(TabState *tabs, size_t target);
+
 // Create a new tab with the given path
 int tabs_new(TabState *tabs, const char *path);
 
@@ -58,9 +92,15 @@ void tabs_update_title(Tab *tab);
 // Sync current tab with app state
 void tabs_sync_from_app(TabState *tabs, struct App *app);
 
-// Restore app state from current tab
+// Restore app state from current tab (its resident listing if it has one)
 void tabs_sync_to_app(TabState *tabs, struct App *app);
 
+// Leave the current tab (keeping its listing, columns and filter) and show tab index
+void tabs_activate(struct App *app, int index);
+
+// Leave the current tab and show path in a new one; -1 when every tab is in use
+int tabs_open(struct App *app, const char *path);
+
 // Handle tab input (clicks, shortcuts)
 void tabs_handle_input(struct App *app);
 
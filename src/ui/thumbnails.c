@@ -0,0 +1,751 @@
+#include "thumbnails.h"
+#include "video.h"
+#include "../platform/imageio.h"
+#include "../core/archive.h"
+#include "../utils/perf.h"
+#include "../utils/hash.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define THUMB_CELLS_PER_ROW (THUMB_ATLAS_SIZE / THUMB_SIZE)
+#define THUMB_CELLS_PER_PAGE (THUMB_CELLS_PER_ROW * THUMB_CELLS_PER_ROW)
+#define THUMB_CELLS (THUMB_CELLS_PER_PAGE * THUMB_ATLAS_PAGES)
+#define THUMB_BUCKETS 8192              // Power of two
+
+// A request not repeated for this many frames has scrolled out of view
+#define THUMB_STALE_FRAMES 2
+
+typedef enum ThumbState {
+    THUMB_PENDING,                      // Waiting for a worker
+    THUMB_DECODING,
+    THUMB_DECODED,                      // Pixels waiting to be copied into the atlas
+    THUMB_READY,                        // In an atlas cell
+    THUMB_FAILED                        // Not an image ImageIO or stb_image can read
+} ThumbState;
+
+// The sprite sheet of the video under the pointer, for scrubbing it by hovering
+typedef struct ThumbScrub {
+    char *path;                         // NULL: nothing hovered yet
+    time_t mtime;
+    off_t size;
+    ThumbState state;                   // Never THUMB_READY without a texture
+    uint64_t requested_frame;
+    Image image;                        // RGBA when decoded
+    Texture2D texture;                  // Main thread only
+} ThumbScrub;
+
+typedef struct ThumbEntry {
+    char *path;                         // NULL: slot unused
+    time_t mtime;
+    off_t size;
+    uint32_t hash;
+    int next;                           // Next entry in the bucket, -1 at the end
+    ThumbState state;
+    int priority;
+    uint64_t requested_frame;           // Last frame the item was on screen
+    int cell;                           // Atlas cell when ready
+    int width;
+    int height;
+    unsigned char *pixels;              // RGBA when decoded
+} ThumbEntry;
+
+struct ThumbnailCache {
+    pthread_mutex_t mutex;
+    pthread_cond_t work;                // A request arrived, or stopping
+    pthread_t workers[THUMB_WORKERS];
+    int worker_count;
+    bool stopping;
+    uint64_t frame;
+    Volumes *volumes;                   // Files on remote volumes get no thumbnail when set
+
+    ThumbScrub scrub;
+    ThumbEntry entries[THUMB_MAX_ENTRIES];
+    int buckets[THUMB_BUCKETS];
+    int free_entries[THUMB_MAX_ENTRIES];
+    int free_count;
+
+    // Atlas (main thread only)
+    Texture2D pages[THUMB_ATLAS_PAGES];
+    int cell_owner[THUMB_CELLS];        // Entry in each cell, -1 if empty
+    uint64_t cell_used[THUMB_CELLS];    // Last frame each cell was drawn
+};
+
+static const char *SUPPORTED_EXTENSIONS[] = {
+    "jpg", "jpeg", "png", "gif", "bmp", "tif", "tiff", "heic", "heif", "webp",
+    "psd", "tga", "dng", "cr2", "cr3", "nef", "arw", "raf", "orf", "rw2", NULL
+};
+
+// Extensions stb_image reads when ImageIO cannot
+static const char *STB_EXTENSIONS[] = { "png", "gif", "jpg", "jpeg", "bmp", "tga", "psd", NULL };
+
+static bool extension_in(const char *extension, const char *const *list)
+{
+    if (!extension || !extension[0]) return false;
+    for (int i = 0; list[i]; i++) {
+        if (strcasecmp(extension, list[i]) == 0) return true;
+    }
+    return false;
+}
+
+bool thumbnails_is_supported(const char *extension)
+{
+    if (!extension || !extension[0]) return false;
+    return extension_in(extension, SUPPORTED_EXTENSIONS) || video_is_supported_format(extension);
+}
+
+// Helper: Whether a path names a video, which is shown by its sprite sheet
+static bool is_video(const char *path)
+{
+    const char *extension = strrchr(path, '.');
+    return extension && video_is_supported_format(extension + 1);
+}
+
+Rectangle thumbnails_sprite_frame(int sheet_width, int sheet_height, float position)
+{
+    int frame = video_sprite_frame(position);
+    float width = (float)(sheet_width / VIDEO_SPRITE_COLUMNS);
+    float height = (float)(sheet_height / VIDEO_SPRITE_ROWS);
+    return (Rectangle){ (frame % VIDEO_SPRITE_COLUMNS) * width, (frame / VIDEO_SPRITE_COLUMNS) * height,
+                        width, height };
+}
+
+void thumbnails_cache_path(const char *path, time_t mtime, off_t size, char *out, size_t out_size)
+{
+    if (!out || out_size == 0) return;
+    out[0] = '\0';
+    if (!path) return;
+
+    // Key on the version too, so an edited image never shows a stale thumbnail
+    char version[64];
+    snprintf(version, sizeof(version), "|%lld|%lld", (long long)mtime, (long long)size);
+    uint64_t hash = hash_fnv1a64_string(hash_fnv1a64_string(HASH_FNV1A64_INIT, path), version);
+
+    const char *home = getenv("HOME");
+    int written = snprintf(out, out_size, "%s/%s/%016llx.png", home ? home : "/tmp",
+                           THUMB_CACHE_DIR, (unsigned long long)hash);
+    if (written < 0 || (size_t)written >= out_size) {
+        out[0] = '\0';
+    }
+}
+
+// Helper: Create the cache directory and its parents
+static bool ensure_cache_dir(void)
+{
+    const char *home = getenv("HOME");
+    char path[4096];
+    int written = snprintf(path, sizeof(path), "%s/%s", home ? home : "/tmp", THUMB_CACHE_DIR);
+    if (written < 0 || (size_t)written >= sizeof(path)) return false;
+
+    for (char *p = path + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(path, 0755);  // Ignore EEXIST
+            *p = '/';
+        }
+    }
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+// Helper: Decode an image file with stb_image (raylib's loaders, minus their logging)
+static Image load_image_file(const char *path, const char *file_type)
+{
+    Image image = { 0 };
+    FILE *f = fopen(path, "rb");
+    if (!f) return image;
+
+    unsigned char *data = NULL;
+    long length = 0;
+    if (fseek(f, 0, SEEK_END) == 0 && (length = ftell(f)) > 0 && length <= THUMB_STB_MAX_BYTES &&
+        fseek(f, 0, SEEK_SET) == 0) {
+        data = (unsigned char *)malloc((size_t)length);
+        if (data && fread(data, 1, (size_t)length, f) == (size_t)length) {
+            image = LoadImageFromMemory(file_type, data, (int)length);
+        }
+    }
+    fclose(f);
+    free(data);
+    return image;
+}
+
+// Helper: Store a thumbnail in the disk cache; written aside and renamed into place so
+// another worker never reads half a file
+static void store_cached(const Image *image, const char *cache_path)
+{
+    if (!cache_path[0] || !ensure_cache_dir()) return;
+
+    int data_size = 0;
+    unsigned char *data = ExportImageToMemory(*image, ".png", &data_size);
+    if (!data) return;
+
+    static atomic_uint next_temp;
+    char temp_path[4200];
+    snprintf(temp_path, sizeof(temp_path), "%s.%u.tmp", cache_path, atomic_fetch_add(&next_temp, 1));
+    FILE *f = fopen(temp_path, "wb");
+    if (f) {
+        bool ok = fwrite(data, 1, (size_t)data_size, f) == (size_t)data_size;
+        ok = fclose(f) == 0 && ok;
+        if (!ok || rename(temp_path, cache_path) != 0) {
+            unlink(temp_path);
+        }
+    }
+    MemFree(data);
+}
+
+// Helper: Load a video's sprite sheet as RGBA, generating it if needed
+static Image load_sprite_sheet(const char *path)
+{
+    Image sheet = { 0 };
+    char sheet_path[4096];
+    if (video_generate_sprite_sheet(path, sheet_path, sizeof(sheet_path))) {
+        sheet = load_image_file(sheet_path, ".png");
+    }
+    if (sheet.data) {
+        ImageFormat(&sheet, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    }
+    return sheet;
+}
+
+// Helper: Decode the image itself at thumbnail size; for a video, the first frame of
+// its sprite sheet
+static bool decode_source(const char *path, off_t size, Image *image)
+{
+    // A member of an archive is decoded from a copy on disk
+    char local[4096];
+    if (archive_member_copy(path, ARCHIVE_PREVIEW_MAX, local, sizeof(local))) {
+        path = local;
+    }
+
+    if (is_video(path)) {
+        Image sheet = load_sprite_sheet(path);
+        if (!sheet.data) return false;
+        ImageCrop(&sheet, thumbnails_sprite_frame(sheet.width, sheet.height, 0.0f));
+        if (sheet.width <= 0 || sheet.height <= 0) {
+            UnloadImage(sheet);
+            return false;
+        }
+        float scale = (float)THUMB_SIZE / (float)(sheet.width > sheet.height ? sheet.width : sheet.height);
+        int w = (int)(sheet.width * scale);
+        int h = (int)(sheet.height * scale);
+        ImageResize(&sheet, w > 0 ? w : 1, h > 0 ? h : 1);
+        *image = sheet;
+        return true;
+    }
+
+    unsigned char *rgb = NULL;
+    int width = 0;
+    int height = 0;
+    if (platform_load_image_scaled(path, THUMB_SIZE, &rgb, &width, &height, NULL, NULL)) {
+        *image = (Image){ .data = rgb, .width = width, .height = height, .mipmaps = 1,
+                          .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8 };
+        return true;
+    }
+
+    // stb_image decodes at full size, so very large files are not worth it
+    const char *extension = strrchr(path, '.');
+    if (!extension || !extension_in(extension + 1, STB_EXTENSIONS) || size > THUMB_STB_MAX_BYTES) {
+        return false;
+    }
+    char file_type[16];
+    snprintf(file_type, sizeof(file_type), "%s", extension);
+    for (char *p = file_type; *p; p++) {
+        *p = (char)tolower((unsigned char)*p);
+    }
+    Image full = load_image_file(path, file_type);
+    if (!full.data || full.width <= 0 || full.height <= 0) {
+        UnloadImage(full);
+        return false;
+    }
+    if (full.width > THUMB_SIZE || full.height > THUMB_SIZE) {
+        float scale = (float)THUMB_SIZE / (float)(full.width > full.height ? full.width : full.height);
+        int w = (int)(full.width * scale);
+        int h = (int)(full.height * scale);
+        ImageResize(&full, w > 0 ? w : 1, h > 0 ? h : 1);
+    }
+    *image = full;
+    return true;
+}
+
+bool thumbnails_decode(const char *path, time_t mtime, off_t size,
+                       unsigned char **pixels, int *width, int *height)
+{
+    if (!path || !pixels || !width || !height) return false;
+    *pixels = NULL;
+
+    char cache_path[4096];
+    thumbnails_cache_path(path, mtime, size, cache_path, sizeof(cache_path));
+
+    Image image = { 0 };
+    struct stat st;
+    if (cache_path[0] && stat(cache_path, &st) == 0 && st.st_size > 0) {
+        image = load_image_file(cache_path, ".png");
+    }
+    if (!image.data) {
+        if (!decode_source(path, size, &image)) {
+            return false;
+        }
+        store_cached(&image, cache_path);
+    }
+
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    if (!image.data || image.width > THUMB_SIZE || image.height > THUMB_SIZE) {
+        UnloadImage(image);
+        return false;
+    }
+
+    // Image data comes from malloc (raylib's RL_MALLOC) and is handed over as it is
+    *pixels = image.data;
+    *width = image.width;
+    *height = image.height;
+    return true;
+}
+
+// Helper: Find an entry (call with mutex held); -1 if absent
+static int entry_find(ThumbnailCache *cache, const char *path, uint32_t hash)
+{
+    for (int i = cache->buckets[hash & (THUMB_BUCKETS - 1)]; i >= 0; i = cache->entries[i].next) {
+        ThumbEntry *entry = &cache->entries[i];
+        if (entry->hash == hash && strcmp(entry->path, path) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Helper: Remove an entry and free its cell (call with mutex held, main thread)
+static void entry_remove(ThumbnailCache *cache, int index)
+{
+    ThumbEntry *entry = &cache->entries[index];
+    int *link = &cache->buckets[entry->hash & (THUMB_BUCKETS - 1)];
+    while (*link != index) {
+        link = &cache->entries[*link].next;
+    }
+    *link = entry->next;
+
+    if (entry->state == THUMB_READY) {
+        cache->cell_owner[entry->cell] = -1;
+    }
+    free(entry->path);
+    free(entry->pixels);
+    memset(entry, 0, sizeof(*entry));
+    cache->free_entries[cache->free_count++] = index;
+}
+
+// Helper: Make room for an entry by dropping the one longest off screen, other than
+// those being decoded (call with mutex held); false if all are on screen
+static bool entry_evict(ThumbnailCache *cache)
+{
+    int oldest = -1;
+    for (int i = 0; i < THUMB_MAX_ENTRIES; i++) {
+        ThumbEntry *entry = &cache->entries[i];
+        if (!entry->path || entry->state == THUMB_DECODING) continue;
+        if (oldest < 0 || entry->requested_frame < cache->entries[oldest].requested_frame) {
+            oldest = i;
+        }
+    }
+    if (oldest < 0 || cache->entries[oldest].requested_frame + 1 >= cache->frame) {
+        return false;
+    }
+    entry_remove(cache, oldest);
+    return true;
+}
+
+// Helper: Whether a request is still wanted (call with mutex held)
+static bool entry_wanted(const ThumbnailCache *cache, const ThumbEntry *entry)
+{
+    return entry->requested_frame + THUMB_STALE_FRAMES >= cache->frame;
+}
+
+// Helper: Load the hovered video's sprite sheet, unlocking while it is made (call with
+// mutex held and the scrub pending)
+static void scrub_decode(ThumbnailCache *cache)
+{
+    ThumbScrub *scrub = &cache->scrub;
+    char *path = strdup(scrub->path);
+    if (!path) return;
+    time_t mtime = scrub->mtime;
+    off_t size = scrub->size;
+    scrub->state = THUMB_DECODING;
+    pthread_mutex_unlock(&cache->mutex);
+
+    Image sheet = load_sprite_sheet(path);
+
+    pthread_mutex_lock(&cache->mutex);
+    // The pointer may have moved on to another video meanwhile
+    if (scrub->path && scrub->state == THUMB_DECODING && strcmp(scrub->path, path) == 0 &&
+        scrub->mtime == mtime && scrub->size == size) {
+        scrub->image = sheet;
+        scrub->state = sheet.data ? THUMB_DECODED : THUMB_FAILED;
+    } else {
+        UnloadImage(sheet);
+    }
+    free(path);
+}
+
+// Thread function: Decode the most urgent visible request, repeatedly; the hovered
+// video comes first, since it is what the pointer is on
+static void *thumbnail_worker(void *arg)
+{
+    ThumbnailCache *cache = (ThumbnailCache *)arg;
+
+    pthread_mutex_lock(&cache->mutex);
+    while (!cache->stopping) {
+        ThumbScrub *scrub = &cache->scrub;
+        if (scrub->path && scrub->state == THUMB_PENDING &&
+            scrub->requested_frame + THUMB_STALE_FRAMES >= cache->frame) {
+            scrub_decode(cache);
+            continue;
+        }
+
+        int best = -1;
+        for (int i = 0; i < THUMB_MAX_ENTRIES; i++) {
+            ThumbEntry *entry = &cache->entries[i];
+            if (!entry->path || entry->state != THUMB_PENDING || !entry_wanted(cache, entry)) continue;
+            if (best < 0 || entry->priority < cache->entries[best].priority) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            pthread_cond_wait(&cache->work, &cache->mutex);
+            continue;
+        }
+
+        // Entries being decoded are never evicted, so the path stays put
+        ThumbEntry *entry = &cache->entries[best];
+        entry->state = THUMB_DECODING;
+        const char *path = entry->path;
+        time_t mtime = entry->mtime;
+        off_t size = entry->size;
+        pthread_mutex_unlock(&cache->mutex);
+
+        unsigned char *pixels = NULL;
+        int width = 0;
+        int height = 0;
+        bool ok = thumbnails_decode(path, mtime, size, &pixels, &width, &height);
+
+        pthread_mutex_lock(&cache->mutex);
+        entry->state = ok ? THUMB_DECODED : THUMB_FAILED;
+        entry->pixels = pixels;
+        entry->width = width;
+        entry->height = height;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return NULL;
+}
+
+ThumbnailCache *thumbnails_create(void)
+{
+    ThumbnailCache *cache = (ThumbnailCache *)calloc(1, sizeof(ThumbnailCache));
+    if (!cache) return NULL;
+
+    pthread_mutex_init(&cache->mutex, NULL);
+    pthread_cond_init(&cache->work, NULL);
+    for (int i = 0; i < THUMB_BUCKETS; i++) {
+        cache->buckets[i] = -1;
+    }
+    for (int i = 0; i < THUMB_MAX_ENTRIES; i++) {
+        cache->free_entries[i] = THUMB_MAX_ENTRIES - 1 - i;
+    }
+    cache->free_count = THUMB_MAX_ENTRIES;
+    for (int i = 0; i < THUMB_CELLS; i++) {
+        cache->cell_owner[i] = -1;
+    }
+    cache->frame = 1;
+
+    for (int i = 0; i < THUMB_WORKERS; i++) {
+        if (pthread_create(&cache->workers[cache->worker_count], NULL, thumbnail_worker, cache) == 0) {
+            cache->worker_count++;
+        }
+    }
+    return cache;
+}
+
+void thumbnails_destroy(ThumbnailCache *cache)
+{
+    if (!cache) return;
+
+    pthread_mutex_lock(&cache->mutex);
+    cache->stopping = true;
+    pthread_cond_broadcast(&cache->work);
+    pthread_mutex_unlock(&cache->mutex);
+    for (int i = 0; i < cache->worker_count; i++) {
+        pthread_join(cache->workers[i], NULL);
+    }
+
+    for (int i = 0; i < THUMB_MAX_ENTRIES; i++) {
+        free(cache->entries[i].path);
+        free(cache->entries[i].pixels);
+    }
+    free(cache->scrub.path);
+    UnloadImage(cache->scrub.image);
+    if (cache->scrub.texture.id != 0) {
+        texture_budget_untrack(cache->scrub.texture.id);
+        UnloadTexture(cache->scrub.texture);
+    }
+    for (int i = 0; i < THUMB_ATLAS_PAGES; i++) {
+        if (cache->pages[i].id != 0) {
+            texture_budget_untrack(cache->pages[i].id);
+            UnloadTexture(cache->pages[i]);
+        }
+    }
+    pthread_cond_destroy(&cache->work);
+    pthread_mutex_destroy(&cache->mutex);
+    free(cache);
+}
+
+// Helper: A cell for a new thumbnail: empty, or the one drawn longest ago and not in
+// the last frame (call with mutex held); -1 if every cell is on screen
+static int cell_allocate(ThumbnailCache *cache)
+{
+    int oldest = -1;
+    for (int i = 0; i < THUMB_CELLS; i++) {
+        if (cache->cell_owner[i] < 0) {
+            oldest = i;
+            break;
+        }
+        if (oldest < 0 || cache->cell_used[i] < cache->cell_used[oldest]) {
+            oldest = i;
+        }
+    }
+    if (oldest < 0 || (cache->cell_owner[oldest] >= 0 && cache->cell_used[oldest] + 1 >= cache->frame)) {
+        return -1;
+    }
+
+    // The evicted thumbnail is decoded again (from the disk cache) if it comes back
+    int owner = cache->cell_owner[oldest];
+    if (owner >= 0) {
+        cache->entries[owner].state = THUMB_PENDING;
+        cache->cell_owner[oldest] = -1;
+    }
+
+    int page = oldest / THUMB_CELLS_PER_PAGE;
+    if (cache->pages[page].id == 0) {
+        Image blank = GenImageColor(THUMB_ATLAS_SIZE, THUMB_ATLAS_SIZE, BLANK);
+        cache->pages[page] = LoadTextureFromImage(blank);
+        UnloadImage(blank);
+        if (cache->pages[page].id == 0) {
+            return -1;
+        }
+        SetTextureFilter(cache->pages[page], TEXTURE_FILTER_BILINEAR);
+        // Charged to the texture budget, but cells are reused rather than pages evicted
+        texture_budget_track(cache->pages[page].id, GetPixelDataSize(THUMB_ATLAS_SIZE, THUMB_ATLAS_SIZE,
+                             cache->pages[page].format), 1, NULL, NULL);
+    }
+    return oldest;
+}
+
+// Helper: Where a cell sits in its page
+static Rectangle cell_rect(int cell, int width, int height)
+{
+    int within = cell % THUMB_CELLS_PER_PAGE;
+    return (Rectangle){
+        (float)((within % THUMB_CELLS_PER_ROW) * THUMB_SIZE),
+        (float)((within / THUMB_CELLS_PER_ROW) * THUMB_SIZE),
+        (float)width, (float)height
+    };
+}
+
+bool thumbnails_begin_frame(ThumbnailCache *cache)
+{
+    if (!cache) return false;
+
+    pthread_mutex_lock(&cache->mutex);
+    cache->frame++;
+
+    // The hovered video's sprite sheet gets a texture of its own
+    bool scrub_ready = false;
+    ThumbScrub *scrub = &cache->scrub;
+    if (scrub->state == THUMB_DECODED) {
+        if (scrub->texture.id != 0) {
+            texture_budget_untrack(scrub->texture.id);
+            UnloadTexture(scrub->texture);
+        }
+        scrub->texture = LoadTextureFromImage(scrub->image);
+        UnloadImage(scrub->image);
+        scrub->image = (Image){ 0 };
+        if (scrub->texture.id != 0) {
+            SetTextureFilter(scrub->texture, TEXTURE_FILTER_BILINEAR);
+            texture_budget_track(scrub->texture.id, GetPixelDataSize(scrub->texture.width, scrub->texture.height,
+                                 scrub->texture.format), 1, NULL, NULL);
+            scrub->state = THUMB_READY;
+            scrub_ready = true;
+        } else {
+            scrub->state = THUMB_FAILED;
+        }
+    }
+
+    // Copy finished thumbnails into the atlas, most urgent first, a few per frame and
+    // within the frame's work allowance
+    int uploads = 0;
+    for (; uploads < THUMB_UPLOADS_PER_FRAME && (uploads == 0 || frame_work_remaining() > 0); uploads++) {
+        int best = -1;
+        for (int i = 0; i < THUMB_MAX_ENTRIES; i++) {
+            ThumbEntry *entry = &cache->entries[i];
+            if (!entry->path || entry->state != THUMB_DECODED) continue;
+            if (best < 0 || entry->priority < cache->entries[best].priority) {
+                best = i;
+            }
+        }
+        if (best < 0) break;
+
+        ThumbEntry *entry = &cache->entries[best];
+        int cell = cell_allocate(cache);
+        if (cell < 0) break;
+
+        UpdateTextureRec(cache->pages[cell / THUMB_CELLS_PER_PAGE],
+                         cell_rect(cell, entry->width, entry->height), entry->pixels);
+        free(entry->pixels);
+        entry->pixels = NULL;
+        entry->cell = cell;
+        entry->state = THUMB_READY;
+        cache->cell_owner[cell] = best;
+        cache->cell_used[cell] = cache->frame;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return uploads > 0 || scrub_ready;
+}
+
+bool thumbnails_is_busy(ThumbnailCache *cache)
+{
+    if (!cache) return false;
+
+    pthread_mutex_lock(&cache->mutex);
+    const ThumbScrub *scrub = &cache->scrub;
+    bool busy = scrub->state == THUMB_DECODING || scrub->state == THUMB_DECODED ||
+                (scrub->path && scrub->state == THUMB_PENDING &&
+                 scrub->requested_frame + THUMB_STALE_FRAMES >= cache->frame);
+    for (int i = 0; i < THUMB_MAX_ENTRIES && !busy; i++) {
+        const ThumbEntry *entry = &cache->entries[i];
+        if (!entry->path) continue;
+        busy = entry->state == THUMB_DECODING || entry->state == THUMB_DECODED ||
+               (entry->state == THUMB_PENDING && entry_wanted(cache, entry));
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return busy;
+}
+
+static uint32_t path_hash(const char *path)
+{
+    uint64_t hash = hash_fnv1a64_string(HASH_FNV1A64_INIT, path);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+void thumbnails_set_volumes(ThumbnailCache *cache, Volumes *volumes)
+{
+    if (cache) cache->volumes = volumes;
+}
+
+bool thumbnails_get(ThumbnailCache *cache, const char *path, time_t mtime, off_t size,
+                    int priority, Texture2D *texture, Rectangle *source)
+{
+    if (!cache || !path) return false;
+
+    // Decoding would read every image over the network
+    if (volumes_is_remote(cache->volumes, path)) return false;
+
+    uint32_t hash = path_hash(path);
+    bool ready = false;
+
+    pthread_mutex_lock(&cache->mutex);
+    int index = entry_find(cache, path, hash);
+
+    // A changed file starts over
+    if (index >= 0 && cache->entries[index].state != THUMB_DECODING &&
+        (cache->entries[index].mtime != mtime || cache->entries[index].size != size)) {
+        entry_remove(cache, index);
+        index = -1;
+    }
+
+    if (index < 0) {
+        if (cache->free_count == 0 && !entry_evict(cache)) {
+            pthread_mutex_unlock(&cache->mutex);
+            return false;
+        }
+        char *copy = strdup(path);
+        if (!copy) {
+            pthread_mutex_unlock(&cache->mutex);
+            return false;
+        }
+        index = cache->free_entries[--cache->free_count];
+        ThumbEntry *entry = &cache->entries[index];
+        entry->path = copy;
+        entry->mtime = mtime;
+        entry->size = size;
+        entry->hash = hash;
+        entry->state = THUMB_PENDING;
+        entry->cell = -1;
+        int *bucket = &cache->buckets[hash & (THUMB_BUCKETS - 1)];
+        entry->next = *bucket;
+        *bucket = index;
+    }
+
+    ThumbEntry *entry = &cache->entries[index];
+    entry->requested_frame = cache->frame;
+    entry->priority = priority;
+
+    if (entry->state == THUMB_READY) {
+        cache->cell_used[entry->cell] = cache->frame;
+        *texture = cache->pages[entry->cell / THUMB_CELLS_PER_PAGE];
+        *source = cell_rect(entry->cell, entry->width, entry->height);
+        ready = true;
+    } else if (entry->state == THUMB_PENDING) {
+        pthread_cond_signal(&cache->work);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return ready;
+}
+
+bool thumbnails_get_scrub(ThumbnailCache *cache, const char *path, time_t mtime, off_t size,
+                          float position, Texture2D *texture, Rectangle *source)
+{
+    if (!cache || !path || !is_video(path)) return false;
+
+    // Making the sheet would read the whole video over the network
+    if (volumes_is_remote(cache->volumes, path)) return false;
+
+    bool ready = false;
+    pthread_mutex_lock(&cache->mutex);
+    ThumbScrub *scrub = &cache->scrub;
+
+    // Another video, or this one changed: only one sheet is kept
+    if (!scrub->path || strcmp(scrub->path, path) != 0 || scrub->mtime != mtime || scrub->size != size) {
+        char *copy = strdup(path);
+        if (!copy) {
+            pthread_mutex_unlock(&cache->mutex);
+            return false;
+        }
+        free(scrub->path);
+        scrub->path = copy;
+        scrub->mtime = mtime;
+        scrub->size = size;
+        UnloadImage(scrub->image);
+        scrub->image = (Image){ 0 };
+        if (scrub->texture.id != 0) {
+            texture_budget_untrack(scrub->texture.id);
+            UnloadTexture(scrub->texture);
+            scrub->texture = (Texture2D){ 0 };
+        }
+        // A worker still making the old sheet drops it when it sees the path changed
+        scrub->state = THUMB_PENDING;
+    }
+    scrub->requested_frame = cache->frame;
+
+    if (scrub->state == THUMB_READY) {
+        *texture = scrub->texture;
+        *source = thumbnails_sprite_frame(scrub->texture.width, scrub->texture.height, position);
+        ready = true;
+    } else if (scrub->state == THUMB_PENDING) {
+        pthread_cond_signal(&cache->work);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return ready;
+}
@@ -0,0 +1,73 @@
+#ifndef THUMBNAILS_H
+#define THUMBNAILS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <time.h>
+#include "raylib.h"
+#include "../core/volumes.h"
+
+// Image and video thumbnails for the grid view. Worker threads decode images at thumbnail
+// size (ImageIO, falling back to stb_image through raylib), and videos by the first frame
+// of their sprite sheet, and keep each result in an on-disk cache keyed by path,
+// modification time and size. The main thread copies finished thumbnails into cells of
+// shared atlas textures, so a screen of them draws from one or two textures. Items are
+// requested every frame they are on screen, and workers always take the request nearest
+// the top of the view, skipping those that scrolled away
+
+#define THUMB_SIZE 64                   // Atlas cell edge; thumbnails fit inside it
+#define THUMB_ATLAS_SIZE 2048           // Atlas texture edge
+#define THUMB_ATLAS_PAGES 2
+#define THUMB_MAX_ENTRIES 4096          // Thumbnails tracked, drawn or not
+#define THUMB_WORKERS 3
+#define THUMB_UPLOADS_PER_FRAME 24      // Atlas copies per frame, to keep frames short
+#define THUMB_STB_MAX_BYTES (64 * 1024 * 1024)  // Larger files skip the full-decode fallback
+#define THUMB_CACHE_DIR ".cache/finder-plus/thumbnails/grid"
+
+typedef struct ThumbnailCache ThumbnailCache;
+
+// Create and destroy the cache (destroy before the window closes)
+ThumbnailCache *thumbnails_create(void);
+void thumbnails_destroy(ThumbnailCache *cache);
+
+// Start a frame: copy decoded thumbnails into the atlas (main thread); true if any
+// thumbnail became ready
+bool thumbnails_begin_frame(ThumbnailCache *cache);
+
+// Whether thumbnails on screen are still being decoded or copied
+bool thumbnails_is_busy(ThumbnailCache *cache);
+
+// Skip files on remote volumes, as told by the volume service
+void thumbnails_set_volumes(ThumbnailCache *cache, Volumes *volumes);
+
+// The thumbnail of an image file, if ready: its atlas texture and the area within it.
+// Otherwise it is requested; priority orders requests, lowest first (use the item's
+// position in the view). Main thread
+bool thumbnails_get(ThumbnailCache *cache, const char *path, time_t mtime, off_t size,
+                    int priority, Texture2D *texture, Rectangle *source);
+
+// The frame of the hovered video under the pointer, if its sprite sheet is ready: the
+// texture and the area within it. position runs from 0 at the left edge of the video's
+// item to 1 at its right. Otherwise the sheet is requested ahead of any thumbnail; one
+// video's sheet is kept at a time. Main thread
+bool thumbnails_get_scrub(ThumbnailCache *cache, const char *path, time_t mtime, off_t size,
+                          float position, Texture2D *texture, Rectangle *source);
+
+// The area of a video sprite sheet (sheet_width x sheet_height) showing the frame for a
+// hover position
+Rectangle thumbnails_sprite_frame(int sheet_width, int sheet_height, float position);
+
+// Whether files with this extension get thumbnails (images, and videos by their first
+// sprite-sheet frame)
+bool thumbnails_is_supported(const char *extension);
+
+// On-disk cache file for a version of an image
+void thumbnails_cache_path(const char *path, time_t mtime, off_t size, char *out, size_t out_size);
+
+// Decode an image to RGBA fitting THUMB_SIZE, through the on-disk cache; *pixels is
+// malloc'd. Thread-safe
+bool thumbnails_decode(const char *path, time_t mtime, off_t size,
+                       unsigned char **pixels, int *width, int *height);
+
+#endif // THUMBNAILS_H
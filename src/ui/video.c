@@ -1,4 +1,6 @@
 #include "video.h"
+#include "../platform/video_decode.h"
+#include "../utils/file_type.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,16 +8,12 @@
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <signal.h>
+#include <stdatomic.h>
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <CommonCrypto/CommonDigest.h>
 
-// Supported video extensions
-static const char *SUPPORTED_EXTENSIONS[] = {
-    "mp4", "mov", "mkv", "avi", "webm", "m4v", NULL
-};
-
 // Helper: Convert string to uppercase in place
 static void str_to_upper(char *str)
 {
@@ -142,6 +140,95 @@ static bool run_ffmpeg_thumbnail(const char *video_path, const char *output_path
     return WIFEXITED(status) && WEXITSTATUS(status) == 0;
 }
 
+// Helper: Metadata cache file beside a video's thumbnail
+static void metadata_cache_path(const char *video_path, char *out, size_t out_size)
+{
+    video_get_cache_path(video_path, out, out_size);
+    size_t len = strlen(out);
+    if (len < 4 || len + 2 > out_size) {
+        out[0] = '\0';
+        return;
+    }
+    strcpy(out + len - 4, ".meta");
+}
+
+// Helper: Whether a cached thumbnail was made from this version of the video
+static bool thumbnail_is_current(const char *thumbnail_path, const struct stat *video)
+{
+    struct stat st;
+    return stat(thumbnail_path, &st) == 0 && st.st_size > 0 && st.st_mtime >= video->st_mtime;
+}
+
+// Helper: Read cached metadata, if it was stored for this version of the video
+static bool load_cached_info(const char *cache_path, const struct stat *video, VideoInfo *info)
+{
+    FILE *f = fopen(cache_path, "r");
+    if (!f) return false;
+
+    long long mtime = 0, size = 0;
+    char codec[sizeof(info->codec)] = "";
+    VideoInfo cached = { 0 };
+    int fields = fscanf(f, "%lld %lld %d %d %f %f %d %15s", &mtime, &size,
+                        &cached.width, &cached.height, &cached.duration, &cached.fps,
+                        &cached.bit_depth, codec);
+    fclose(f);
+
+    if (fields != 8 || mtime != (long long)video->st_mtime || size != (long long)video->st_size) {
+        return false;
+    }
+    if (strcmp(codec, "-") != 0) {
+        memcpy(cached.codec, codec, sizeof(cached.codec));
+    }
+    *info = cached;
+    return true;
+}
+
+// Helper: Cache metadata for this version of the video; written aside and renamed into
+// place so a reader never sees half a file
+static void store_cached_info(const char *cache_path, const struct stat *video, const VideoInfo *info)
+{
+    if (!cache_path[0]) return;
+
+    char tmp_path[4096];
+    int written = snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", cache_path, (int)getpid());
+    if (written < 0 || (size_t)written >= sizeof(tmp_path)) return;
+
+    FILE *f = fopen(tmp_path, "w");
+    if (!f) return;
+    fprintf(f, "%lld %lld %d %d %f %f %d %s\n", (long long)video->st_mtime, (long long)video->st_size,
+            info->width, info->height, info->duration, info->fps, info->bit_depth,
+            info->codec[0] ? info->codec : "-");
+    bool ok = fclose(f) == 0;
+    if (!ok || rename(tmp_path, cache_path) != 0) {
+        unlink(tmp_path);
+    }
+}
+
+// Helper: Probe a video in process, writing its thumbnail too when thumbnail_path is not
+// NULL, and cache the metadata
+static bool probe_in_process(const char *video_path, const struct stat *video,
+                             const char *thumbnail_path, VideoInfo *info)
+{
+    PlatformVideoInfo probed;
+    if (!platform_video_probe(video_path, &probed, thumbnail_path, VIDEO_THUMBNAIL_WIDTH)) {
+        return false;
+    }
+
+    memset(info, 0, sizeof(*info));
+    info->duration = probed.duration;
+    info->width = probed.width;
+    info->height = probed.height;
+    info->fps = probed.fps;
+    info->bit_depth = probed.bit_depth;
+    memcpy(info->codec, probed.codec, sizeof(info->codec));
+    info->codec[sizeof(info->codec) - 1] = '\0';
+
+    char cache_path[4096];
+    metadata_cache_path(video_path, cache_path, sizeof(cache_path));
+    store_cached_info(cache_path, video, info);
+    return true;
+}
+
 bool video_generate_thumbnail(const char *video_path, char *thumbnail_path_out, size_t path_size)
 {
     if (!video_path || !thumbnail_path_out || path_size == 0) {
@@ -154,8 +241,13 @@ bool video_generate_thumbnail(const char *video_path, char *thumbnail_path_out,
         return false;
     }
 
+    struct stat video;
+    if (stat(video_path, &video) != 0) {
+        return false;
+    }
+
     // Check if already cached
-    if (file_exists_with_content(thumbnail_path_out)) {
+    if (thumbnail_is_current(thumbnail_path_out, &video)) {
         return true;
     }
 
@@ -164,6 +256,13 @@ bool video_generate_thumbnail(const char *video_path, char *thumbnail_path_out,
         return false;
     }
 
+    // In process: the thumbnail and all metadata from one open of the file
+    VideoInfo info;
+    if (probe_in_process(video_path, &video, thumbnail_path_out, &info) &&
+        file_exists_with_content(thumbnail_path_out)) {
+        return true;
+    }
+
     // Try to extract frame at 1 second
     if (run_ffmpeg_thumbnail(video_path, thumbnail_path_out, VIDEO_THUMBNAIL_WIDTH, "00:00:01") &&
         file_exists_with_content(thumbnail_path_out)) {
@@ -175,6 +274,109 @@ bool video_generate_thumbnail(const char *video_path, char *thumbnail_path_out,
            file_exists_with_content(thumbnail_path_out);
 }
 
+// Helper: Sprite sheet cache file beside a video's thumbnail
+static void sprite_cache_path(const char *video_path, char *out, size_t out_size)
+{
+    video_get_cache_path(video_path, out, out_size);
+    size_t len = strlen(out);
+    if (len < 4 || len + 9 > out_size) {
+        out[0] = '\0';
+        return;
+    }
+    strcpy(out + len - 4, ".sprites.png");
+}
+
+// Run ffmpeg to tile a sprite sheet in one pass over the keyframes (no shell)
+static bool run_ffmpeg_sprite_sheet(const char *video_path, const char *output_path, float duration)
+{
+    pid_t pid = fork();
+    if (pid < 0) return false;
+
+    if (pid == 0) {
+        redirect_stderr_to_null();
+
+        // Keyframes only, resampled to evenly spaced frames and tiled into one image
+        char filter[160];
+        snprintf(filter, sizeof(filter), "fps=%d/%.3f,scale=%d:-2,tile=%dx%d",
+                 VIDEO_SPRITE_FRAMES, duration, VIDEO_SPRITE_WIDTH,
+                 VIDEO_SPRITE_COLUMNS, VIDEO_SPRITE_ROWS);
+
+        execlp("ffmpeg", "ffmpeg",
+               "-y",
+               "-skip_frame", "nokey",
+               "-i", video_path,
+               "-an",
+               "-vf", filter,
+               "-frames:v", "1",
+               "-f", "image2",
+               "-c:v", "png",
+               output_path,
+               NULL);
+        _exit(1);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+bool video_generate_sprite_sheet(const char *video_path, char *sheet_path_out, size_t path_size)
+{
+    if (!video_path || !sheet_path_out || path_size == 0) {
+        return false;
+    }
+
+    sprite_cache_path(video_path, sheet_path_out, path_size);
+    if (sheet_path_out[0] == '\0') {
+        return false;
+    }
+
+    struct stat video;
+    if (stat(video_path, &video) != 0) {
+        return false;
+    }
+    if (thumbnail_is_current(sheet_path_out, &video)) {
+        return true;
+    }
+    if (!ensure_cache_dir()) {
+        return false;
+    }
+
+    // Written aside and renamed into place, so a reader never loads half a sheet; the
+    // preview and grid workers may be making the same one
+    static atomic_uint next_temp;
+    char tmp_path[4096];
+    int written = snprintf(tmp_path, sizeof(tmp_path), "%s.%d.%u.tmp", sheet_path_out, (int)getpid(),
+                           atomic_fetch_add(&next_temp, 1));
+    if (written < 0 || (size_t)written >= sizeof(tmp_path)) {
+        return false;
+    }
+
+    bool ok = platform_video_sprite_sheet(video_path, tmp_path, VIDEO_SPRITE_COLUMNS, VIDEO_SPRITE_ROWS,
+                                          VIDEO_SPRITE_WIDTH) &&
+              file_exists_with_content(tmp_path);
+    if (!ok) {
+        // ffmpeg spaces the frames by the duration, so it needs one
+        VideoInfo info;
+        ok = video_probe(video_path, &info) && info.duration > 0.0f &&
+             run_ffmpeg_sprite_sheet(video_path, tmp_path, info.duration) &&
+             file_exists_with_content(tmp_path);
+    }
+    if (!ok || rename(tmp_path, sheet_path_out) != 0) {
+        unlink(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+int video_sprite_frame(float position)
+{
+    int frame = (int)(position * VIDEO_SPRITE_FRAMES);
+    if (frame < 0) return 0;
+    if (frame >= VIDEO_SPRITE_FRAMES) return VIDEO_SPRITE_FRAMES - 1;
+    return frame;
+}
+
 // Run ffprobe and capture output (no shell, uses fork/exec with pipe)
 static bool run_ffprobe(const char *video_path, const char *const args[],
                         char *output, size_t output_size)
@@ -236,52 +438,99 @@ static bool run_ffprobe(const char *video_path, const char *const args[],
     return WIFEXITED(status) && WEXITSTATUS(status) == 0 && total_read > 0;
 }
 
-bool video_get_metadata(const char *video_path, float *duration_out, int *width_out, int *height_out)
+// Helper: Parse one run of ffprobe listing the video stream and format as key=value
+// lines; the stream's duration comes first, the container's is the fallback
+static void parse_ffprobe_info(char *output, VideoInfo *info)
+{
+    for (char *line = strtok(output, "\n"); line; line = strtok(NULL, "\n")) {
+        char *value = strchr(line, '=');
+        if (!value) continue;
+        *value++ = '\0';
+
+        if (strcmp(line, "width") == 0) {
+            info->width = atoi(value);
+        } else if (strcmp(line, "height") == 0) {
+            info->height = atoi(value);
+        } else if (strcmp(line, "codec_name") == 0) {
+            strncpy(info->codec, value, sizeof(info->codec) - 1);
+            info->codec[sizeof(info->codec) - 1] = '\0';
+            str_to_upper(info->codec);
+        } else if (strcmp(line, "bits_per_raw_sample") == 0) {
+            info->bit_depth = atoi(value);  // 0 for N/A
+        } else if (strcmp(line, "r_frame_rate") == 0) {
+            // "30/1" or "30000/1001"
+            int num = 0, den = 1;
+            if (sscanf(value, "%d/%d", &num, &den) == 2 && den > 0) {
+                info->fps = (float)num / (float)den;
+            } else if (sscanf(value, "%d", &num) == 1) {
+                info->fps = (float)num;
+            }
+        } else if (strcmp(line, "duration") == 0 && info->duration <= 0) {
+            info->duration = (float)atof(value);  // 0 for N/A
+        }
+    }
+    if (info->bit_depth <= 0) {
+        info->bit_depth = 8;  // Default to 8-bit
+    }
+}
+
+bool video_probe(const char *video_path, VideoInfo *info)
 {
-    if (!video_path) return false;
+    if (!video_path || !info) return false;
+    memset(info, 0, sizeof(*info));
+
+    struct stat video;
+    if (stat(video_path, &video) != 0) {
+        return false;
+    }
+
+    char cache_path[4096];
+    metadata_cache_path(video_path, cache_path, sizeof(cache_path));
+    if (cache_path[0] && load_cached_info(cache_path, &video, info)) {
+        return true;
+    }
+    bool have_cache_dir = ensure_cache_dir();
 
-    char output[256];
-    bool success = false;
+    // In process, making the thumbnail from the same open if it is missing
+    char thumbnail_path[4096];
+    video_get_cache_path(video_path, thumbnail_path, sizeof(thumbnail_path));
+    bool need_thumbnail = have_cache_dir && thumbnail_path[0] && !thumbnail_is_current(thumbnail_path, &video);
+    if (probe_in_process(video_path, &video, need_thumbnail ? thumbnail_path : NULL, info)) {
+        return true;
+    }
 
-    // Get stream info (width, height, duration)
-    const char *stream_args[] = {
+    // One ffprobe run for everything
+    char output[1024];
+    const char *info_args[] = {
         "ffprobe", "-v", "error",
         "-select_streams", "v:0",
-        "-show_entries", "stream=width,height,duration",
-        "-of", "csv=p=0",
+        "-show_entries", "stream=width,height,duration,codec_name,bits_per_raw_sample,r_frame_rate:format=duration",
+        "-of", "default=noprint_wrappers=1",
         NULL
     };
-
-    if (run_ffprobe(video_path, stream_args, output, sizeof(output))) {
-        int w = 0, h = 0;
-        float d = 0;
-
-        if (sscanf(output, "%d,%d,%f", &w, &h, &d) >= 2) {
-            if (width_out) *width_out = w;
-            if (height_out) *height_out = h;
-            if (duration_out) *duration_out = d;
-            success = true;
-        }
+    if (!run_ffprobe(video_path, info_args, output, sizeof(output))) {
+        return false;
+    }
+    parse_ffprobe_info(output, info);
+    if (info->width <= 0 || info->height <= 0) {
+        return false;
     }
 
-    // If duration wasn't in stream info, try format duration
-    if (success && duration_out && *duration_out <= 0) {
-        const char *format_args[] = {
-            "ffprobe", "-v", "error",
-            "-show_entries", "format=duration",
-            "-of", "csv=p=0",
-            NULL
-        };
-
-        if (run_ffprobe(video_path, format_args, output, sizeof(output))) {
-            float d = 0;
-            if (sscanf(output, "%f", &d) == 1) {
-                *duration_out = d;
-            }
-        }
+    if (have_cache_dir) {
+        store_cached_info(cache_path, &video, info);
     }
+    return true;
+}
 
-    return success;
+bool video_get_metadata(const char *video_path, float *duration_out, int *width_out, int *height_out)
+{
+    VideoInfo info;
+    if (!video_probe(video_path, &info)) return false;
+
+    if (width_out) *width_out = info.width;
+    if (height_out) *height_out = info.height;
+    if (duration_out) *duration_out = info.duration;
+    return true;
 }
 
 pid_t video_start_playback(const char *video_path)
@@ -347,75 +596,23 @@ bool video_check_ffmpeg_available(void)
 
 bool video_is_supported_format(const char *extension)
 {
-    if (!extension) return false;
-
-    // Skip leading dot if present
-    if (extension[0] == '.') extension++;
-
-    // Convert to lowercase for comparison
-    char ext_lower[16];
-    size_t len = strlen(extension);
-    if (len >= sizeof(ext_lower)) return false;
-
-    for (size_t i = 0; i <= len; i++) {
-        ext_lower[i] = (char)tolower((unsigned char)extension[i]);
-    }
-
-    // Check against supported extensions
-    for (int i = 0; SUPPORTED_EXTENSIONS[i]; i++) {
-        if (strcmp(ext_lower, SUPPORTED_EXTENSIONS[i]) == 0) {
-            return true;
-        }
-    }
-
-    return false;
+    return file_type_class(file_type_from_extension(extension)) == FILE_CLASS_VIDEO;
 }
 
 bool video_get_extended_metadata(const char *video_path, char *codec_out, size_t codec_size, int *bit_depth_out)
 {
-    if (!video_path) return false;
-
-    char output[256];
-
-    const char *codec_args[] = {
-        "ffprobe", "-v", "error",
-        "-select_streams", "v:0",
-        "-show_entries", "stream=codec_name,bits_per_raw_sample",
-        "-of", "csv=p=0",
-        NULL
-    };
-
-    if (!run_ffprobe(video_path, codec_args, output, sizeof(output))) {
+    VideoInfo info;
+    if (!video_probe(video_path, &info) || info.codec[0] == '\0') {
         return false;
     }
 
-    // Parse "h264,8" or "hevc,10" format
-    char *newline = strchr(output, '\n');
-    if (newline) *newline = '\0';
-
-    if (output[0] == '\0') {
-        return false;
+    if (bit_depth_out) {
+        *bit_depth_out = info.bit_depth;
     }
-
-    // Parse bit depth if comma present
-    char *comma = strchr(output, ',');
-    if (comma) {
-        *comma = '\0';
-        if (bit_depth_out) {
-            int bd = atoi(comma + 1);
-            *bit_depth_out = (bd > 0) ? bd : 8;
-        }
-    } else if (bit_depth_out) {
-        *bit_depth_out = 8;  // Default to 8-bit
-    }
-
-    // Copy and uppercase codec name
     if (codec_out && codec_size > 0) {
-        strncpy(codec_out, output, codec_size - 1);
+        strncpy(codec_out, info.codec, codec_size - 1);
         codec_out[codec_size - 1] = '\0';
-        str_to_upper(codec_out);
     }
-
     return true;
 }
 
@@ -423,32 +620,23 @@ bool video_get_fps(const char *video_path, float *fps_out)
 {
     if (!video_path || !fps_out) return false;
 
-    char output[256];
-
-    const char *fps_args[] = {
-        "ffprobe", "-v", "error",
-        "-select_streams", "v:0",
-        "-show_entries", "stream=r_frame_rate",
-        "-of", "csv=p=0",
-        NULL
-    };
-
-    if (run_ffprobe(video_path, fps_args, output, sizeof(output))) {
-        // Parse "30/1" or "30000/1001" format
-        int num = 0, den = 1;
-        if (sscanf(output, "%d/%d", &num, &den) == 2 && den > 0) {
-            *fps_out = (float)num / (float)den;
-            return true;
-        } else if (sscanf(output, "%d", &num) == 1) {
-            *fps_out = (float)num;
-            return true;
-        }
+    VideoInfo info;
+    if (video_probe(video_path, &info) && info.fps > 0) {
+        *fps_out = info.fps;
+        return true;
     }
 
     *fps_out = 30.0f;  // Default fallback
     return false;
 }
 
+size_t video_frame_size(int width, int height)
+{
+    if (width <= 0 || height <= 0) return 0;
+    size_t luma = (size_t)width * (size_t)height;
+    return luma + 2 * ((size_t)(width / 2) * (size_t)(height / 2));
+}
+
 int video_start_inpane_playback(const char *video_path, int width, int height, pid_t *pid_out, float *fps_out)
 {
     if (!video_path || !pid_out) return -1;
@@ -469,7 +657,7 @@ int video_start_inpane_playback(const char *video_path, int width, int height, p
     }
 
     if (pid == 0) {
-        // Child process - run ffmpeg to output raw RGB frames
+        // Child process - run ffmpeg to output raw YUV420 frames
         close(pipefd[0]);  // Close read end
         dup2(pipefd[1], STDOUT_FILENO);
         close(pipefd[1]);
@@ -484,7 +672,7 @@ int video_start_inpane_playback(const char *video_path, int width, int height, p
                "-an",                    // Disable audio
                "-vf", scale,
                "-f", "rawvideo",
-               "-pix_fmt", "rgb24",
+               "-pix_fmt", "yuv420p",
                "-vsync", "0",            // Output frames as fast as decoded
                "-",
                NULL);
@@ -501,7 +689,7 @@ bool video_read_frame(int pipe_fd, unsigned char *buffer, int width, int height)
 {
     if (pipe_fd < 0 || !buffer || width <= 0 || height <= 0) return false;
 
-    size_t frame_size = (size_t)(width * height * 3);  // RGB24
+    size_t frame_size = video_frame_size(width, height);
     size_t total_read = 0;
 
     while (total_read < frame_size) {
@@ -7,12 +7,43 @@
 
 #define VIDEO_CACHE_DIR ".cache/finder-plus/thumbnails"
 #define VIDEO_THUMBNAIL_WIDTH 400
+#define VIDEO_SPRITE_COLUMNS 4          // Sprite sheet: frames per row
+#define VIDEO_SPRITE_ROWS 4
+#define VIDEO_SPRITE_FRAMES (VIDEO_SPRITE_COLUMNS * VIDEO_SPRITE_ROWS)
+#define VIDEO_SPRITE_WIDTH 160          // Width of each frame
+
+// Everything the preview shows about a video. Probed in process (AVFoundation) with one
+// ffprobe run as the fallback, and cached beside the thumbnail (<hash>.meta) for as long
+// as the file's modification time and size are unchanged
+typedef struct VideoInfo {
+    float duration;                     // Seconds (0 if unknown)
+    int width;
+    int height;
+    float fps;                          // 0 if unknown
+    char codec[16];                     // Upper case (H264, HEVC, ...); empty if unknown
+    int bit_depth;                      // Bits per component
+} VideoInfo;
 
 // Generate thumbnail for video file
 // Returns true on success, false on failure
-// Thumbnail is cached to ~/.cache/finder-plus/thumbnails/<hash>.png
+// Thumbnail is cached to ~/.cache/finder-plus/thumbnails/<hash>.png; probing it also
+// caches the video's metadata, from the same open of the file
 bool video_generate_thumbnail(const char *video_path, char *thumbnail_path_out, size_t path_size);
 
+// Generate the hover-scrub sprite sheet of a video: VIDEO_SPRITE_FRAMES keyframes spread
+// evenly through it, VIDEO_SPRITE_COLUMNS to a row, each VIDEO_SPRITE_WIDTH wide, as one
+// PNG cached beside the thumbnail (<hash>.sprites.png). Only keyframes are decoded, in a
+// single pass. Returns true on success
+bool video_generate_sprite_sheet(const char *video_path, char *sheet_path_out, size_t path_size);
+
+// Which sprite-sheet frame to show for a pointer position running from 0 at the left
+// edge of what is hovered to 1 at its right
+int video_sprite_frame(float position);
+
+// Get all metadata of a video, through the metadata cache
+// Returns true on success
+bool video_probe(const char *video_path, VideoInfo *info);
+
 // Get video metadata (duration, dimensions)
 // Returns true on success, any output param can be NULL to skip
 bool video_get_metadata(const char *video_path, float *duration_out, int *width_out, int *height_out);
@@ -40,12 +71,16 @@ bool video_get_extended_metadata(const char *video_path, char *codec_out, size_t
 // Get video frame rate (FPS)
 bool video_get_fps(const char *video_path, float *fps_out);
 
-// Start in-pane video playback using ffmpeg frame extraction
+// Bytes in one YUV420 frame: the Y plane, then U and V at half width and height
+size_t video_frame_size(int width, int height);
+
+// Start in-pane video playback using ffmpeg frame extraction; frames are YUV420
+// (yuv420p), half the bytes of RGB24, so width and height must be even
 // Returns file descriptor for reading frames, or -1 on failure
 // Caller is responsible for closing the pipe and stopping playback
 int video_start_inpane_playback(const char *video_path, int width, int height, pid_t *pid_out, float *fps_out);
 
-// Read a single frame from the video pipe
+// Read a single YUV420 frame (video_frame_size bytes) from the video pipe
 // Returns true if a frame was read, false on EOF or error
 bool video_read_frame(int pipe_fd, unsigned char *buffer, int width, int height);
 
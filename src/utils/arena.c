@@ -0,0 +1,144 @@
+#include "arena.h"
+#include "perf.h"
+
+#include <stdint.h>
+#include <string.h>
+
+struct ArenaBlock {
+    struct ArenaBlock *prev;            // Older block
+    size_t size;                        // Usable bytes after the header
+    size_t used;
+};
+
+// Block header rounded up so the data after it is aligned
+#define ARENA_HEADER ((sizeof(struct ArenaBlock) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static Arena g_frame_arena = { NULL, FRAME_ARENA_BLOCK, 0 };
+
+// Helper: Start of a block's data
+static unsigned char *block_data(struct ArenaBlock *block)
+{
+    return (unsigned char *)block + ARENA_HEADER;
+}
+
+// Helper: Add a block with room for at least size bytes
+static struct ArenaBlock *arena_grow(Arena *arena, size_t size)
+{
+    size_t block_size = arena->block_size > 0 ? arena->block_size : ARENA_DEFAULT_BLOCK;
+    if (block_size < size) {
+        block_size = size;
+    }
+    struct ArenaBlock *block = memory_aligned_alloc(MEMORY_TAG_ARENA, ARENA_ALIGN, ARENA_HEADER + block_size);
+    if (!block) {
+        return NULL;
+    }
+    block->prev = arena->head;
+    block->size = block_size;
+    block->used = 0;
+    arena->head = block;
+    arena->reserved += block_size;
+    return block;
+}
+
+void arena_init(Arena *arena, size_t block_size)
+{
+    arena->head = NULL;
+    arena->block_size = block_size > 0 ? block_size : ARENA_DEFAULT_BLOCK;
+    arena->reserved = 0;
+}
+
+void arena_free(Arena *arena)
+{
+    struct ArenaBlock *block = arena->head;
+    while (block) {
+        struct ArenaBlock *prev = block->prev;
+        memory_free(MEMORY_TAG_ARENA, block);
+        block = prev;
+    }
+    arena->head = NULL;
+    arena->reserved = 0;
+}
+
+void *arena_alloc(Arena *arena, size_t size)
+{
+    if (size > SIZE_MAX - ARENA_HEADER - ARENA_ALIGN) {
+        return NULL;
+    }
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    struct ArenaBlock *block = arena->head;
+    if (!block || block->size - block->used < size) {
+        block = arena_grow(arena, size);
+        if (!block) {
+            return NULL;
+        }
+    }
+    void *ptr = block_data(block) + block->used;
+    block->used += size;
+    return ptr;
+}
+
+void *arena_calloc(Arena *arena, size_t count, size_t size)
+{
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void *ptr = arena_alloc(arena, count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+char *arena_strdup(Arena *arena, const char *text)
+{
+    size_t len = strlen(text);
+    char *copy = arena_alloc(arena, len + 1);
+    if (copy) {
+        memcpy(copy, text, len + 1);
+    }
+    return copy;
+}
+
+ArenaMark arena_mark(const Arena *arena)
+{
+    ArenaMark mark = { arena->head, arena->head ? arena->head->used : 0 };
+    return mark;
+}
+
+void arena_release(Arena *arena, ArenaMark mark)
+{
+    // Blocks added since the mark go; the marked one rewinds
+    while (arena->head && arena->head != mark.block) {
+        struct ArenaBlock *prev = arena->head->prev;
+        arena->reserved -= arena->head->size;
+        memory_free(MEMORY_TAG_ARENA, arena->head);
+        arena->head = prev;
+    }
+    if (arena->head) {
+        arena->head->used = mark.used;
+    }
+}
+
+void arena_reset(Arena *arena)
+{
+    if (!arena->head) {
+        return;
+    }
+    if (!arena->head->prev) {
+        arena->head->used = 0;
+        return;
+    }
+
+    // Outgrew one block: replace them all with one that holds as much
+    size_t reserved = arena->reserved;
+    arena_free(arena);
+    if (!arena_grow(arena, reserved)) {
+        arena->reserved = 0;
+    }
+}
+
+Arena *frame_arena(void)
+{
+    return &g_frame_arena;
+}
@@ -0,0 +1,56 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bump allocator for temporaries that die together. Allocations are carved from
+// chained blocks and never freed one by one: a scope takes a mark and releases back to
+// it, and a reset drops everything. A reset also merges the blocks into one as large
+// as the arena has grown, so work of the same size next time allocates nothing.
+//
+// The frame arena holds temporaries that live until the next frame is drawn (reset at
+// the start of app_draw); use it from the main thread only. Work on other threads uses
+// its own arena on the stack
+
+#define ARENA_DEFAULT_BLOCK (64 * 1024)
+#define FRAME_ARENA_BLOCK (256 * 1024)
+#define ARENA_ALIGN 16
+
+// Chained block (private to arena.c)
+struct ArenaBlock;
+
+typedef struct Arena {
+    struct ArenaBlock *head;                   // Newest block, allocated from
+    size_t block_size;                  // Smallest block to add
+    size_t reserved;                    // Bytes in every block
+} Arena;
+
+// Position to release back to
+typedef struct ArenaMark {
+    struct ArenaBlock *block;
+    size_t used;
+} ArenaMark;
+
+// Set up an empty arena; its first block is allocated on first use
+void arena_init(Arena *arena, size_t block_size);
+
+// Free every block
+void arena_free(Arena *arena);
+
+// size bytes aligned to ARENA_ALIGN, valid until released or reset; NULL if out of memory
+void *arena_alloc(Arena *arena, size_t size);
+void *arena_calloc(Arena *arena, size_t count, size_t size);
+char *arena_strdup(Arena *arena, const char *text);
+
+// Release everything allocated after mark
+ArenaMark arena_mark(const Arena *arena);
+void arena_release(Arena *arena, ArenaMark mark);
+
+// Release everything, keeping one block as large as every block was
+void arena_reset(Arena *arena);
+
+// Shared arena for this frame's temporaries (main thread)
+Arena *frame_arena(void);
+
+#endif // ARENA_H
@@ -0,0 +1,83 @@
+#include "cache_registry.h"
+
+static CacheClient g_clients[CACHE_REGISTRY_MAX];
+static int g_client_count = 0;
+static size_t g_budget = CACHE_REGISTRY_DEFAULT_BUDGET;
+
+bool cache_registry_add(const CacheClient *client)
+{
+    if (!client || !client->bytes || !client->trim || g_client_count == CACHE_REGISTRY_MAX) {
+        return false;
+    }
+    g_clients[g_client_count++] = *client;
+    return true;
+}
+
+void cache_registry_remove(void *cache)
+{
+    int kept = 0;
+    for (int i = 0; i < g_client_count; i++) {
+        if (g_clients[i].cache != cache) {
+            g_clients[kept++] = g_clients[i];
+        }
+    }
+    g_client_count = kept;
+}
+
+void cache_registry_set_budget(size_t bytes)
+{
+    g_budget = bytes > 0 ? bytes : CACHE_REGISTRY_DEFAULT_BUDGET;
+}
+
+size_t cache_registry_budget(void)
+{
+    return g_budget;
+}
+
+size_t cache_registry_used(void)
+{
+    size_t total = 0;
+    for (int i = 0; i < g_client_count; i++) {
+        total += g_clients[i].bytes(g_clients[i].cache);
+    }
+    return total;
+}
+
+size_t cache_registry_update(CachePressure pressure)
+{
+    size_t sizes[CACHE_REGISTRY_MAX];
+    size_t total = 0;
+    for (int i = 0; i < g_client_count; i++) {
+        sizes[i] = g_clients[i].bytes(g_clients[i].cache);
+        total += sizes[i];
+    }
+
+    size_t target = g_budget;
+    if (pressure == CACHE_PRESSURE_CRITICAL) {
+        target = 0;
+    } else if (pressure == CACHE_PRESSURE_WARN && total / 2 < target) {
+        target = total / 2;
+    }
+    if (total <= target) {
+        return 0;
+    }
+
+    // Cheapest to rebuild first; within a cost, in the order they registered
+    size_t released = 0;
+    for (int cost = CACHE_COST_LOW; cost < CACHE_COST_COUNT && total > target; cost++) {
+        for (int i = 0; i < g_client_count && total > target; i++) {
+            CacheClient *client = &g_clients[i];
+            if ((int)client->cost != cost || sizes[i] == 0) continue;
+
+            size_t excess = total - target;
+            client->trim(client->cache, sizes[i] > excess ? sizes[i] - excess : 0);
+            size_t after = client->bytes(client->cache);
+            if (after < sizes[i]) {
+                released += sizes[i] - after;
+                total -= sizes[i] - after;
+                sizes[i] = after;
+            }
+        }
+    }
+    return released;
+}
@@ -0,0 +1,57 @@
+#ifndef CACHE_REGISTRY_H
+#define CACHE_REGISTRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// One byte budget over the app's in-memory caches. Each cache registers how to measure
+// itself, how to shrink, and what it costs to rebuild what it drops. Every second,
+// when their total is over the budget, caches are shrunk cheapest to rebuild first
+// until it fits; each keeps its own limits besides. When the system reports memory
+// pressure the target drops to half of what they hold (a warning) or to nothing
+// (critical), so the app gives memory back to whatever else is running
+//
+// Main thread only; the callbacks lock their caches as the caches' other users do
+
+#define CACHE_REGISTRY_MAX 16
+#define CACHE_REGISTRY_DEFAULT_BUDGET ((size_t)768 * 1024 * 1024)
+
+// What dropping a cache's contents costs, cheapest first; cheaper caches are trimmed first
+typedef enum CacheCost {
+    CACHE_COST_LOW = 0,                 // Read back from local disk
+    CACHE_COST_MEDIUM,                  // Listed, decoded or queried again
+    CACHE_COST_HIGH,                    // Rebuilt with heavy work, e.g. a whole index
+    CACHE_COST_COUNT
+} CacheCost;
+
+typedef enum CachePressure {
+    CACHE_PRESSURE_NONE = 0,
+    CACHE_PRESSURE_WARN,                // Trim to half of what the caches hold
+    CACHE_PRESSURE_CRITICAL             // Empty every cache
+} CachePressure;
+
+typedef struct CacheClient {
+    const char *name;                   // Static string, e.g. "listings"
+    CacheCost cost;
+    size_t (*bytes)(void *cache);       // Bytes the cache holds now
+    void (*trim)(void *cache, size_t target);  // Shrink to at most target bytes, least useful first
+    void *cache;
+} CacheClient;
+
+// Register a cache (copied); false when the registry is full
+bool cache_registry_add(const CacheClient *client);
+
+// Unregister every client of cache (before it is freed)
+void cache_registry_remove(void *cache);
+
+// Set the byte budget (0 restores the default)
+void cache_registry_set_budget(size_t bytes);
+size_t cache_registry_budget(void);
+
+// Trim for the budget and for pressure; returns the bytes released
+size_t cache_registry_update(CachePressure pressure);
+
+// Bytes the registered caches hold now
+size_t cache_registry_used(void);
+
+#endif // CACHE_REGISTRY_H
@@ -1,5 +1,10 @@
 #include "config.h"
 #include "theme.h"
+#include "file_hash.h"
+#include "perf.h"
+#include "cache_registry.h"
+#include "../core/filesystem.h"
+#include "../core/operations.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -121,6 +126,24 @@ void config_init(Config *config)
     config->ai.api_key[0] = '\0';
     config->ai.semantic_search = false;
     config->ai.smart_rename = false;
+    config->ai.respect_ignore_files = false;
+    config->ai.index_on_volumes = false;
+    config->ai.tool_result_tokens = 4000;
+    config->ai.local_summaries = true;
+    config->ai.model_fast[0] = '\0';
+    config->ai.model_balanced[0] = '\0';
+    config->ai.model_capable[0] = '\0';
+    config->ai.model_routing[0] = '\0';
+
+    // Performance defaults
+    config->performance.metadata_threads = DIR_METADATA_THREADS_DEFAULT;
+    config->performance.path_index = true;
+    config->performance.vector_quantization = 1;
+    config->performance.hash_threads = 0;
+    config->performance.verify_moves = true;
+    config->performance.frame_rate = 0;
+    config->performance.texture_budget_mb = 0;
+    config->performance.cache_budget_mb = 0;
 
     // Get default config path
     strncpy(config->config_path, config_get_default_path(), CONFIG_PATH_MAX - 1);
@@ -221,7 +244,7 @@ bool config_load(Config *config, const char *path)
         config->appearance.theme = (ThemeType)theme_int;
     }
     int view_mode_int = json_read_int(content, "view_mode", config->appearance.view_mode);
-    if (view_mode_int >= CONFIG_VIEW_LIST && view_mode_int <= CONFIG_VIEW_COLUMN) {
+    if (view_mode_int >= CONFIG_VIEW_LIST && view_mode_int <= CONFIG_VIEW_TREEMAP) {
         config->appearance.view_mode = (ConfigViewMode)view_mode_int;
     }
     config->appearance.font_size = json_read_int(content, "font_size", config->appearance.font_size);
@@ -236,6 +259,35 @@ bool config_load(Config *config, const char *path)
     json_read_string(content, "api_key", config->ai.api_key, sizeof(config->ai.api_key), "");
     config->ai.semantic_search = json_read_bool(content, "semantic_search", config->ai.semantic_search);
     config->ai.smart_rename = json_read_bool(content, "smart_rename", config->ai.smart_rename);
+    config->ai.respect_ignore_files = json_read_bool(content, "respect_ignore_files", config->ai.respect_ignore_files);
+    config->ai.index_on_volumes = json_read_bool(content, "index_on_volumes", config->ai.index_on_volumes);
+    config->ai.tool_result_tokens = json_read_int(content, "tool_result_tokens", config->ai.tool_result_tokens);
+    config->ai.local_summaries = json_read_bool(content, "local_summaries", config->ai.local_summaries);
+    json_read_string(content, "model_fast", config->ai.model_fast, sizeof(config->ai.model_fast), "");
+    json_read_string(content, "model_balanced", config->ai.model_balanced, sizeof(config->ai.model_balanced), "");
+    json_read_string(content, "model_capable", config->ai.model_capable, sizeof(config->ai.model_capable), "");
+    json_read_string(content, "model_routing", config->ai.model_routing, sizeof(config->ai.model_routing), "");
+
+    config->performance.metadata_threads = json_read_int(content, "metadata_threads", config->performance.metadata_threads);
+    config->performance.path_index = json_read_bool(content, "path_index", config->performance.path_index);
+    int quantization = json_read_int(content, "vector_quantization", config->performance.vector_quantization);
+    if (quantization >= 0 && quantization <= 2) {
+        config->performance.vector_quantization = quantization;
+    }
+    config->performance.hash_threads = json_read_int(content, "hash_threads", config->performance.hash_threads);
+    config->performance.verify_moves = json_read_bool(content, "verify_moves", config->performance.verify_moves);
+    int frame_rate = json_read_int(content, "frame_rate", config->performance.frame_rate);
+    if (frame_rate >= -1 && frame_rate <= 480) {
+        config->performance.frame_rate = frame_rate;
+    }
+    int texture_budget = json_read_int(content, "texture_budget_mb", config->performance.texture_budget_mb);
+    if (texture_budget >= 0 && texture_budget <= 16384) {
+        config->performance.texture_budget_mb = texture_budget;
+    }
+    int cache_budget = json_read_int(content, "cache_budget_mb", config->performance.cache_budget_mb);
+    if (cache_budget >= 0 && cache_budget <= 65536) {
+        config->performance.cache_budget_mb = cache_budget;
+    }
 
     free(content);
     config->loaded = true;
@@ -279,7 +331,25 @@ bool config_save(Config *config)
     // AI (don't save api_key for security)
     json_write_bool(f, "ai_enabled", config->ai.enabled, true);
     json_write_bool(f, "semantic_search", config->ai.semantic_search, true);
-    json_write_bool(f, "smart_rename", config->ai.smart_rename, false);
+    json_write_bool(f, "smart_rename", config->ai.smart_rename, true);
+    json_write_bool(f, "respect_ignore_files", config->ai.respect_ignore_files, true);
+    json_write_bool(f, "index_on_volumes", config->ai.index_on_volumes, true);
+    json_write_int(f, "tool_result_tokens", config->ai.tool_result_tokens, true);
+    json_write_bool(f, "local_summaries", config->ai.local_summaries, true);
+    json_write_string(f, "model_fast", config->ai.model_fast, true);
+    json_write_string(f, "model_balanced", config->ai.model_balanced, true);
+    json_write_string(f, "model_capable", config->ai.model_capable, true);
+    json_write_string(f, "model_routing", config->ai.model_routing, true);
+
+    // Performance
+    json_write_int(f, "metadata_threads", config->performance.metadata_threads, true);
+    json_write_bool(f, "path_index", config->performance.path_index, true);
+    json_write_int(f, "vector_quantization", config->performance.vector_quantization, true);
+    json_write_int(f, "hash_threads", config->performance.hash_threads, true);
+    json_write_bool(f, "verify_moves", config->performance.verify_moves, true);
+    json_write_int(f, "frame_rate", config->performance.frame_rate, true);
+    json_write_int(f, "texture_budget_mb", config->performance.texture_budget_mb, true);
+    json_write_int(f, "cache_budget_mb", config->performance.cache_budget_mb, false);
 
     fprintf(f, "}\n");
     fclose(f);
@@ -293,6 +363,13 @@ void config_apply(Config *config)
     // Apply theme
     theme_set(config->appearance.theme);
 
+    // Apply directory listing tuning
+    directory_set_metadata_threads(config->performance.metadata_threads);
+    file_hash_set_threads(config->performance.hash_threads);
+    operations_set_verify_moves(config->performance.verify_moves);
+    texture_budget_set((size_t)config->performance.texture_budget_mb * 1024 * 1024);
+    cache_registry_set_budget((size_t)config->performance.cache_budget_mb * 1024 * 1024);
+
     // Other settings are applied when reading config
     // in app initialization or update
 }
@@ -20,7 +20,8 @@ typedef struct WindowConfig {
 typedef enum ConfigViewMode {
     CONFIG_VIEW_LIST = 0,
     CONFIG_VIEW_GRID = 1,
-    CONFIG_VIEW_COLUMN = 2
+    CONFIG_VIEW_COLUMN = 2,
+    CONFIG_VIEW_TREEMAP = 3
 } ConfigViewMode;
 
 // Appearance configuration
@@ -58,8 +59,28 @@ typedef struct AIConfig {
     char api_key[256];
     bool semantic_search;
     bool smart_rename;
+    bool respect_ignore_files;  // Keep what .gitignore/.ignore files and cache markers exclude out of semantic search
+    bool index_on_volumes;      // Keep an external volume's semantic index on the volume itself
+    int tool_result_tokens;     // Rough token cap on one list tool result in the AI agent (0: no cap)
+    bool local_summaries;       // Brief hover summaries from the on-device model when installed
+    char model_fast[64];        // Claude models behind each tier ("" = built-in default)
+    char model_balanced[64];
+    char model_capable[64];
+    char model_routing[256];    // "feature=tier" overrides, e.g. "agent=capable"
 } AIConfig;
 
+// Performance configuration
+typedef struct PerformanceConfig {
+    int metadata_threads;   // Parallel lstat workers for volumes without bulk listing
+    bool path_index;        // Keep a recursive filename index of $HOME for search
+    int vector_quantization; // Embedding scan prefilter: 0 = off, 1 = int8, 2 = binary
+    int hash_threads;       // Content hashing workers: 0 = one per core, 1 for spinning disks
+    bool verify_moves;      // Hash-check cross-volume moves before deleting sources
+    int frame_rate;         // Frame rate cap: 0 = the display's refresh rate, -1 = vsync only
+    int texture_budget_mb;  // GPU texture memory kept for previews and thumbnails: 0 = default
+    int cache_budget_mb;    // Memory shared by listing, summary and index caches: 0 = default
+} PerformanceConfig;
+
 // Main configuration
 typedef struct Config {
     WindowConfig window;
@@ -67,6 +88,7 @@ typedef struct Config {
     KeyboardConfig keyboard;
     BookmarksConfig bookmarks;
     AIConfig ai;
+    PerformanceConfig performance;
 
     // Internal
     char config_path[CONFIG_PATH_MAX];
@@ -0,0 +1,156 @@
+#include "draw_batch.h"
+#include "rlgl.h"
+
+// Queued rectangle
+typedef struct BatchRect {
+    float x, y, width, height;
+    Color color;
+} BatchRect;
+
+// Queued glyph quad with normalized texture coordinates
+typedef struct BatchGlyph {
+    unsigned int texture_id;
+    float u0, v0, u1, v1;
+    float x0, y0, x1, y1;
+    Color color;
+} BatchGlyph;
+
+// Layers of the open batch (main thread only)
+static struct {
+    bool open;
+    BatchRect rects[DRAW_BATCH_MAX_RECTS];
+    int rect_count;
+    BatchGlyph glyphs[DRAW_BATCH_MAX_GLYPHS];
+    int glyph_count;
+    unsigned int textures[DRAW_BATCH_MAX_TEXTURES];  // Distinct textures among the glyphs
+    int texture_count;
+} g_batch;
+
+void draw_batch_begin(void)
+{
+    g_batch.open = true;
+    g_batch.rect_count = 0;
+    g_batch.glyph_count = 0;
+    g_batch.texture_count = 0;
+}
+
+bool draw_batch_is_open(void)
+{
+    return g_batch.open;
+}
+
+// Helper: Draw the background layer with the shapes texture, as DrawRectangle does
+static void flush_rects(void)
+{
+    if (g_batch.rect_count == 0) return;
+
+    Texture2D shapes = GetShapesTexture();
+    Rectangle rec = GetShapesTextureRectangle();
+    float u0 = rec.x / (float)shapes.width;
+    float v0 = rec.y / (float)shapes.height;
+    float u1 = (rec.x + rec.width) / (float)shapes.width;
+    float v1 = (rec.y + rec.height) / (float)shapes.height;
+
+    rlSetTexture(shapes.id);
+    rlBegin(RL_QUADS);
+    rlNormal3f(0.0f, 0.0f, 1.0f);
+    for (int i = 0; i < g_batch.rect_count; i++) {
+        const BatchRect *r = &g_batch.rects[i];
+        rlColor4ub(r->color.r, r->color.g, r->color.b, r->color.a);
+        rlTexCoord2f(u0, v0);
+        rlVertex2f(r->x, r->y);
+        rlTexCoord2f(u0, v1);
+        rlVertex2f(r->x, r->y + r->height);
+        rlTexCoord2f(u1, v1);
+        rlVertex2f(r->x + r->width, r->y + r->height);
+        rlTexCoord2f(u1, v0);
+        rlVertex2f(r->x + r->width, r->y);
+    }
+    rlEnd();
+    rlSetTexture(0);
+
+    g_batch.rect_count = 0;
+}
+
+// Helper: Draw the text layer, one pass per texture
+static void flush_glyphs(void)
+{
+    if (g_batch.glyph_count == 0) return;
+
+    for (int t = 0; t < g_batch.texture_count; t++) {
+        rlSetTexture(g_batch.textures[t]);
+        rlBegin(RL_QUADS);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+        for (int i = 0; i < g_batch.glyph_count; i++) {
+            const BatchGlyph *g = &g_batch.glyphs[i];
+            if (g->texture_id != g_batch.textures[t]) continue;
+            rlColor4ub(g->color.r, g->color.g, g->color.b, g->color.a);
+            rlTexCoord2f(g->u0, g->v0);
+            rlVertex2f(g->x0, g->y0);
+            rlTexCoord2f(g->u0, g->v1);
+            rlVertex2f(g->x0, g->y1);
+            rlTexCoord2f(g->u1, g->v1);
+            rlVertex2f(g->x1, g->y1);
+            rlTexCoord2f(g->u1, g->v0);
+            rlVertex2f(g->x1, g->y0);
+        }
+        rlEnd();
+    }
+    rlSetTexture(0);
+
+    g_batch.glyph_count = 0;
+    g_batch.texture_count = 0;
+}
+
+void draw_batch_flush(void)
+{
+    flush_rects();
+    flush_glyphs();
+}
+
+void draw_batch_end(void)
+{
+    draw_batch_flush();
+    g_batch.open = false;
+}
+
+void draw_batch_rect(int x, int y, int width, int height, Color color)
+{
+    if (!g_batch.open) {
+        DrawRectangle(x, y, width, height, color);
+        return;
+    }
+    if (width <= 0 || height <= 0 || color.a == 0) return;
+    if (g_batch.rect_count >= DRAW_BATCH_MAX_RECTS) draw_batch_flush();
+
+    g_batch.rects[g_batch.rect_count++] = (BatchRect){
+        (float)x, (float)y, (float)width, (float)height, color
+    };
+}
+
+void draw_batch_glyph(Texture2D texture, Rectangle source, Rectangle dest, Color color)
+{
+    if (!g_batch.open || texture.width <= 0 || texture.height <= 0) {
+        DrawTexturePro(texture, source, dest, (Vector2){ 0, 0 }, 0.0f, color);
+        return;
+    }
+    if (g_batch.glyph_count >= DRAW_BATCH_MAX_GLYPHS) draw_batch_flush();
+
+    int t = 0;
+    while (t < g_batch.texture_count && g_batch.textures[t] != texture.id) t++;
+    if (t == g_batch.texture_count) {
+        // A texture beyond the per-flush limit is drawn after what is queued
+        if (g_batch.texture_count == DRAW_BATCH_MAX_TEXTURES) draw_batch_flush();
+        g_batch.textures[g_batch.texture_count++] = texture.id;
+    }
+
+    float width = (float)texture.width;
+    float height = (float)texture.height;
+    g_batch.glyphs[g_batch.glyph_count++] = (BatchGlyph){
+        texture.id,
+        source.x / width, source.y / height,
+        (source.x + source.width) / width, (source.y + source.height) / height,
+        dest.x, dest.y, dest.x + dest.width, dest.y + dest.height,
+        color
+    };
+}
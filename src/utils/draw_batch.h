@@ -0,0 +1,34 @@
+#ifndef DRAW_BATCH_H
+#define DRAW_BATCH_H
+
+#include "raylib.h"
+#include <stdbool.h>
+
+// Deferred drawing for views made of many rows. Between draw_batch_begin() and
+// draw_batch_end(), rectangles go into a background layer and text glyphs into a text
+// layer; the end draws the backgrounds in one pass and the text in one pass per font
+// texture. Rows that alternate between shapes and text would otherwise split rlgl's
+// batch into a draw call at every texture switch. Anything drawn directly in between
+// must be preceded by draw_batch_flush() to keep its place in the stacking order
+
+#define DRAW_BATCH_MAX_RECTS 4096       // Queued rectangles before an early flush
+#define DRAW_BATCH_MAX_GLYPHS 16384     // Queued glyph quads before an early flush
+#define DRAW_BATCH_MAX_TEXTURES 4       // Distinct textures in the text layer
+
+// Start and finish a batch (main thread, inside BeginDrawing)
+void draw_batch_begin(void);
+void draw_batch_end(void);
+
+// Whether a batch is open
+bool draw_batch_is_open(void);
+
+// Draw everything queued so far, keeping the batch open
+void draw_batch_flush(void);
+
+// Filled rectangle; drawn right away when no batch is open
+void draw_batch_rect(int x, int y, int width, int height, Color color);
+
+// Textured quad for the text layer (the font module queues glyphs here)
+void draw_batch_glyph(Texture2D texture, Rectangle source, Rectangle dest, Color color);
+
+#endif // DRAW_BATCH_H
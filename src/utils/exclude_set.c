@@ -0,0 +1,208 @@
+#include "exclude_set.h"
+#include "string_set.h"
+
+#include <fnmatch.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NAME_PATTERN_MAX 256            // Longer names are only checked by the globs
+
+// Literal strings looked up by hash
+typedef struct LiteralSet {
+    char **strings;
+    int count;
+    int capacity;
+    StringSet set;
+} LiteralSet;
+
+typedef struct PatternList {
+    char **patterns;
+    int count;
+    int capacity;
+} PatternList;
+
+struct ExcludeSet {
+    LiteralSet names;                   // "node_modules": the whole name
+    LiteralSet suffixes;                // "*.log": ".log", matched from each '.' in a name
+    PatternList name_globs;             // Other patterns without '/', against a name
+    PatternList path_globs;             // Patterns with '/', against the whole path
+    int count;
+};
+
+// Helper: String as the string set's key
+static const char *literal_key(const void *literals, int index)
+{
+    return ((const LiteralSet *)literals)->strings[index];
+}
+
+static bool literal_set_contains(const LiteralSet *literals, const char *s, size_t len)
+{
+    return string_set_find(&literals->set, s, len, literal_key, literals) >= 0;
+}
+
+static bool literal_set_add(LiteralSet *literals, const char *s)
+{
+    size_t len = strlen(s);
+    if (literal_set_contains(literals, s, len)) {
+        return true;
+    }
+
+    if (literals->count == literals->capacity) {
+        int capacity = literals->capacity ? literals->capacity * 2 : 8;
+        char **strings = realloc(literals->strings, (size_t)capacity * sizeof(char *));
+        if (!strings) {
+            return false;
+        }
+        literals->strings = strings;
+        literals->capacity = capacity;
+    }
+    char *copy = strdup(s);
+    if (!copy || !string_set_add(&literals->set, literals->count, s, len)) {
+        free(copy);
+        return false;
+    }
+    literals->strings[literals->count++] = copy;
+    return true;
+}
+
+static void literal_set_free(LiteralSet *literals)
+{
+    for (int i = 0; i < literals->count; i++) {
+        free(literals->strings[i]);
+    }
+    free(literals->strings);
+    string_set_free(&literals->set);
+}
+
+static bool pattern_list_add(PatternList *list, const char *pattern)
+{
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 8;
+        char **patterns = realloc(list->patterns, (size_t)capacity * sizeof(char *));
+        if (!patterns) {
+            return false;
+        }
+        list->patterns = patterns;
+        list->capacity = capacity;
+    }
+    char *copy = strdup(pattern);
+    if (!copy) {
+        return false;
+    }
+    list->patterns[list->count++] = copy;
+    return true;
+}
+
+static void pattern_list_free(PatternList *list)
+{
+    for (int i = 0; i < list->count; i++) {
+        free(list->patterns[i]);
+    }
+    free(list->patterns);
+}
+
+ExcludeSet* exclude_set_create(void)
+{
+    return calloc(1, sizeof(ExcludeSet));
+}
+
+void exclude_set_destroy(ExcludeSet *set)
+{
+    if (!set) {
+        return;
+    }
+    literal_set_free(&set->names);
+    literal_set_free(&set->suffixes);
+    pattern_list_free(&set->name_globs);
+    pattern_list_free(&set->path_globs);
+    free(set);
+}
+
+bool exclude_set_add(ExcludeSet *set, const char *pattern)
+{
+    if (!set || !pattern || pattern[0] == '\0') {
+        return false;
+    }
+
+    bool added;
+    const char *literal = pattern[0] == '*' ? pattern + 1 : pattern;
+    if (strchr(pattern, '/')) {
+        added = pattern_list_add(&set->path_globs, pattern);
+    } else if (strpbrk(literal, "*?[\\") || strlen(pattern) >= NAME_PATTERN_MAX) {
+        added = pattern_list_add(&set->name_globs, pattern);
+    } else if (literal == pattern) {
+        added = literal_set_add(&set->names, pattern);
+    } else if (literal[0] == '.') {
+        added = literal_set_add(&set->suffixes, literal);
+    } else {
+        added = pattern_list_add(&set->name_globs, pattern);
+    }
+    if (added) {
+        set->count++;
+    }
+    return added;
+}
+
+int exclude_set_count(const ExcludeSet *set)
+{
+    return set ? set->count : 0;
+}
+
+bool exclude_set_match_name(const ExcludeSet *set, const char *name, size_t len)
+{
+    if (!set || len == 0) {
+        return false;
+    }
+
+    if (literal_set_contains(&set->names, name, len)) {
+        return true;
+    }
+    for (size_t i = 0; set->suffixes.count > 0 && i < len; i++) {
+        if (name[i] == '.' && literal_set_contains(&set->suffixes, name + i, len - i)) {
+            return true;
+        }
+    }
+    if (set->name_globs.count > 0) {
+        char buffer[NAME_PATTERN_MAX];
+        if (len >= sizeof(buffer)) {
+            return false;
+        }
+        memcpy(buffer, name, len);
+        buffer[len] = '\0';
+        for (int i = 0; i < set->name_globs.count; i++) {
+            if (fnmatch(set->name_globs.patterns[i], buffer, 0) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool exclude_set_match(const ExcludeSet *set, const char *path, size_t skip)
+{
+    if (!set || set->count == 0 || !path) {
+        return false;
+    }
+
+    size_t len = strlen(path);
+    const char *name = path + (skip < len ? skip : len);
+    while (*name) {
+        while (*name == '/') {
+            name++;
+        }
+        const char *end = strchr(name, '/');
+        size_t name_len = end ? (size_t)(end - name) : strlen(name);
+        if (exclude_set_match_name(set, name, name_len)) {
+            return true;
+        }
+        name += name_len;
+    }
+
+    for (int i = 0; i < set->path_globs.count; i++) {
+        if (fnmatch(set->path_globs.patterns[i], path, FNM_PATHNAME) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
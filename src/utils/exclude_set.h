@@ -0,0 +1,32 @@
+#ifndef EXCLUDE_SET_H
+#define EXCLUDE_SET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Exclude patterns compiled once for scans that test every name they meet. A pattern
+// without '/' names a file or folder anywhere (fnmatch against the name, e.g.
+// "node_modules" or "*.log"); one with '/' is matched against the whole path. Plain
+// names and "*.ext" suffixes are hash lookups; only the other globs run fnmatch.
+// Building is single-threaded; a built set may be matched from any number of threads
+
+typedef struct ExcludeSet ExcludeSet;
+
+ExcludeSet* exclude_set_create(void);
+void exclude_set_destroy(ExcludeSet *set);
+
+// Compile and add a pattern; false when out of memory
+bool exclude_set_add(ExcludeSet *set, const char *pattern);
+
+// Patterns added
+int exclude_set_count(const ExcludeSet *set);
+
+// Whether a name (len bytes, no '/') matches a pattern without '/'
+bool exclude_set_match_name(const ExcludeSet *set, const char *name, size_t len);
+
+// Whether a path is excluded: any name in it after the first skip bytes matches, or
+// the whole path matches a pattern with '/'. A scan pruning excluded folders passes
+// the length of the folder it lists, so only the new name is tested
+bool exclude_set_match(const ExcludeSet *set, const char *path, size_t skip);
+
+#endif // EXCLUDE_SET_H
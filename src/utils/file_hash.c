@@ -0,0 +1,324 @@
+#include "file_hash.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Read size per call: large sequential reads keep NVMe queues busy and let
+// spinning disks stream. Plain reads rather than mmap: a file truncated while
+// being hashed must fail the job, not raise SIGBUS
+#define FILE_HASH_BUFFER_SIZE (1024 * 1024)
+#define FILE_HASH_BUFFER_ALIGN 4096
+
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static atomic_int g_hash_threads = 0;
+
+// Streaming XXH64 state
+typedef struct HashState {
+    uint64_t total_length;
+    uint64_t v[4];
+    uint8_t buffer[32];
+    size_t buffered;
+    uint64_t seed;
+} HashState;
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;   // XXH64 is defined little-endian, like every target we build for
+}
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static inline uint64_t hash_merge_round(uint64_t acc, uint64_t value)
+{
+    acc ^= hash_round(0, value);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+static void hash_init(HashState *state, uint64_t seed)
+{
+    memset(state, 0, sizeof(HashState));
+    state->seed = seed;
+    state->v[0] = seed + PRIME64_1 + PRIME64_2;
+    state->v[1] = seed + PRIME64_2;
+    state->v[2] = seed;
+    state->v[3] = seed - PRIME64_1;
+}
+
+// Helper: consume full 32-byte stripes, returns bytes consumed
+static size_t hash_stripes(HashState *state, const uint8_t *p, size_t length)
+{
+    const uint8_t *start = p;
+    uint64_t v0 = state->v[0], v1 = state->v[1], v2 = state->v[2], v3 = state->v[3];
+    while (length >= 32) {
+        v0 = hash_round(v0, read64(p));
+        v1 = hash_round(v1, read64(p + 8));
+        v2 = hash_round(v2, read64(p + 16));
+        v3 = hash_round(v3, read64(p + 24));
+        p += 32;
+        length -= 32;
+    }
+    state->v[0] = v0;
+    state->v[1] = v1;
+    state->v[2] = v2;
+    state->v[3] = v3;
+    return (size_t)(p - start);
+}
+
+static void hash_update(HashState *state, const void *data, size_t length)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    state->total_length += length;
+
+    // Top up a partial stripe first
+    if (state->buffered > 0) {
+        size_t fill = 32 - state->buffered;
+        if (fill > length) fill = length;
+        memcpy(state->buffer + state->buffered, p, fill);
+        state->buffered += fill;
+        p += fill;
+        length -= fill;
+        if (state->buffered < 32) {
+            return;
+        }
+        hash_stripes(state, state->buffer, 32);
+        state->buffered = 0;
+    }
+
+    size_t consumed = hash_stripes(state, p, length);
+    p += consumed;
+    length -= consumed;
+
+    memcpy(state->buffer, p, length);
+    state->buffered = length;
+}
+
+static uint64_t hash_final(const HashState *state)
+{
+    uint64_t h;
+    if (state->total_length >= 32) {
+        h = rotl64(state->v[0], 1) + rotl64(state->v[1], 7) +
+            rotl64(state->v[2], 12) + rotl64(state->v[3], 18);
+        for (int i = 0; i < 4; i++) {
+            h = hash_merge_round(h, state->v[i]);
+        }
+    } else {
+        h = state->seed + PRIME64_5;
+    }
+    h += state->total_length;
+
+    const uint8_t *p = state->buffer;
+    size_t length = state->buffered;
+    while (length >= 8) {
+        h ^= hash_round(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+        length -= 8;
+    }
+    if (length >= 4) {
+        h ^= (uint64_t)read32(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+        length -= 4;
+    }
+    while (length > 0) {
+        h ^= (*p) * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+        p++;
+        length--;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t file_hash_bytes(const void *data, size_t length, uint64_t seed)
+{
+    HashState state;
+    hash_init(&state, seed);
+    hash_update(&state, data, length);
+    return hash_final(&state);
+}
+
+// Helper: hash up to `length` bytes of fd from `offset` (to EOF when length is 0)
+static bool hash_fd_range(int fd, HashState *state, uint8_t *buffer, uint64_t offset, uint64_t length)
+{
+    bool to_eof = length == 0;
+    while (to_eof || length > 0) {
+        size_t want = FILE_HASH_BUFFER_SIZE;
+        if (!to_eof && length < want) want = (size_t)length;
+
+        ssize_t got = pread(fd, buffer, want, (off_t)offset);
+        if (got < 0) {
+            return false;
+        }
+        if (got == 0) {
+            return to_eof;  // A partial range ending early means the file shrank
+        }
+        hash_update(state, buffer, (size_t)got);
+        offset += (uint64_t)got;
+        if (!to_eof) length -= (uint64_t)got;
+    }
+    return true;
+}
+
+static uint8_t *alloc_buffer(void)
+{
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, FILE_HASH_BUFFER_ALIGN, FILE_HASH_BUFFER_SIZE) != 0) {
+        return NULL;
+    }
+    return buffer;
+}
+
+// Helper: hash one job's file with a caller-owned buffer
+static bool hash_job(FileHashJob *job, uint8_t *buffer)
+{
+    int fd = open(job->path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+#if defined(F_RDAHEAD)
+    fcntl(fd, F_RDAHEAD, 1);
+#elif defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    HashState state;
+    hash_init(&state, 0);
+
+    bool ok;
+    uint64_t bytes = job->partial_bytes;
+    if (bytes == 0 || job->size <= 2 * bytes) {
+        ok = hash_fd_range(fd, &state, buffer, 0, 0);
+    } else {
+        ok = hash_fd_range(fd, &state, buffer, 0, bytes) &&
+             hash_fd_range(fd, &state, buffer, job->size - bytes, bytes);
+    }
+    close(fd);
+
+    job->hash = hash_final(&state);
+    return ok;
+}
+
+bool file_hash_compute(const char *path, uint64_t *hash_out)
+{
+    FileHashJob job = { .path = path };
+    file_hash_batch(&job, 1);
+    if (job.ok && hash_out) *hash_out = job.hash;
+    return job.ok;
+}
+
+bool file_hash_partial(const char *path, uint64_t size, uint64_t bytes, uint64_t *hash_out)
+{
+    FileHashJob job = { .path = path, .size = size, .partial_bytes = bytes };
+    file_hash_batch(&job, 1);
+    if (job.ok && hash_out) *hash_out = job.hash;
+    return job.ok;
+}
+
+typedef struct HashPool {
+    FileHashJob *jobs;
+    int count;
+    atomic_int next;
+} HashPool;
+
+static void *hash_pool_worker(void *arg)
+{
+    HashPool *pool = (HashPool *)arg;
+    uint8_t *buffer = alloc_buffer();
+
+    for (;;) {
+        int i = atomic_fetch_add(&pool->next, 1);
+        if (i >= pool->count) {
+            break;
+        }
+        FileHashJob *job = &pool->jobs[i];
+        job->ok = buffer != NULL && job->path != NULL && hash_job(job, buffer);
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+static int default_threads(void)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+    if (cores > FILE_HASH_THREADS_MAX) cores = FILE_HASH_THREADS_MAX;
+    return (int)cores;
+}
+
+void file_hash_batch(FileHashJob *jobs, int count)
+{
+    if (jobs == NULL || count <= 0) {
+        return;
+    }
+
+    HashPool pool = { .jobs = jobs, .count = count };
+    atomic_init(&pool.next, 0);
+
+    int threads = atomic_load(&g_hash_threads);
+    if (threads <= 0) threads = default_threads();
+    if (threads > count) threads = count;
+
+    pthread_t workers[FILE_HASH_THREADS_MAX];
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, hash_pool_worker, &pool) != 0) {
+            break;  // Run with however many threads we got
+        }
+        started++;
+    }
+
+    hash_pool_worker(&pool);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+}
+
+void file_hash_set_threads(int threads)
+{
+    if (threads < 0) threads = 0;
+    if (threads > FILE_HASH_THREADS_MAX) threads = FILE_HASH_THREADS_MAX;
+    atomic_store(&g_hash_threads, threads);
+}
+
+void file_hash_to_hex(uint64_t hash, char *hex_out)
+{
+    if (!hex_out) return;
+    snprintf(hex_out, FILE_HASH_HEX_SIZE, "%016llx", (unsigned long long)hash);
+}
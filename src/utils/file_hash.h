@@ -0,0 +1,44 @@
+#ifndef FILE_HASH_H
+#define FILE_HASH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fast non-cryptographic content hashing (XXH64) for duplicate candidates and
+// cache keys. Not collision resistant: verify with SHA256 before acting on a match
+
+// Upper bound for the hashing worker pool
+#define FILE_HASH_THREADS_MAX 32
+
+// 16 hex digits plus terminator
+#define FILE_HASH_HEX_SIZE 17
+
+// One file for file_hash_batch
+typedef struct FileHashJob {
+    const char *path;
+    uint64_t size;              // File size, needed for partial hashes
+    uint64_t partial_bytes;     // 0 hashes the whole file, else only the first and last partial_bytes
+    uint64_t hash;              // Result
+    bool ok;                    // False if the file could not be read
+} FileHashJob;
+
+// Hash a buffer
+uint64_t file_hash_bytes(const void *data, size_t length, uint64_t seed);
+
+// Hash a whole file
+bool file_hash_compute(const char *path, uint64_t *hash_out);
+
+// Hash the first and last `bytes` of a file of the given size (the whole file if it is shorter)
+bool file_hash_partial(const char *path, uint64_t size, uint64_t bytes, uint64_t *hash_out);
+
+// Hash many files on the worker pool (the caller's thread works alongside it)
+void file_hash_batch(FileHashJob *jobs, int count);
+
+// Worker count for file_hash_batch: 0 = one per core (SSDs), 1 = sequential (spinning disks)
+void file_hash_set_threads(int threads);
+
+// Lowercase hex form of a hash
+void file_hash_to_hex(uint64_t hash, char *hex_out);
+
+#endif // FILE_HASH_H
@@ -0,0 +1,321 @@
+#include "file_type.h"
+#include "hash.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Hash seed that gives every extension below a slot of its own; if an edit to the table
+// makes two collide, the first collision-free seed after it is found on first use
+#define FILE_TYPE_SEED 0x7a128a12u
+#define FILE_TYPE_SEED_STEP 0x9e3779b9u
+
+#define FILE_TYPE_EXT_MAX 16            // Longest extension looked up, with its NUL
+
+#define R FILE_TRAIT_RASTER
+
+// Known extensions; entry 0 is the unknown type
+static const FileTypeInfo FILE_TYPES[] = {
+    {"", FILE_CLASS_NONE, "Other", 0},
+
+    // Text
+    {"txt", FILE_CLASS_TEXT, "Text Files", 0},
+    {"log", FILE_CLASS_TEXT, "Logs", 0},
+    {"cfg", FILE_CLASS_TEXT, "Config", 0},
+    {"conf", FILE_CLASS_TEXT, "Config", 0},
+    {"ini", FILE_CLASS_TEXT, "Config", 0},
+    {"org", FILE_CLASS_TEXT, "Text Files", 0},
+    {"rst", FILE_CLASS_TEXT, "Text Files", 0},
+    {"md", FILE_CLASS_MARKDOWN, "Markdown", 0},
+    {"markdown", FILE_CLASS_MARKDOWN, "Markdown", 0},
+
+    // Code
+    {"c", FILE_CLASS_CODE, "C", 0},
+    {"h", FILE_CLASS_CODE, "C", 0},
+    {"cpp", FILE_CLASS_CODE, "C++", 0},
+    {"hpp", FILE_CLASS_CODE, "C++", 0},
+    {"cc", FILE_CLASS_CODE, "C++", 0},
+    {"py", FILE_CLASS_CODE, "Python", 0},
+    {"js", FILE_CLASS_CODE, "JavaScript", 0},
+    {"ts", FILE_CLASS_CODE, "TypeScript", 0},
+    {"jsx", FILE_CLASS_CODE, "React", 0},
+    {"tsx", FILE_CLASS_CODE, "React", 0},
+    {"java", FILE_CLASS_CODE, "Java", 0},
+    {"kt", FILE_CLASS_CODE, "Kotlin", 0},
+    {"go", FILE_CLASS_CODE, "Go", 0},
+    {"rs", FILE_CLASS_CODE, "Rust", 0},
+    {"rb", FILE_CLASS_CODE, "Ruby", 0},
+    {"php", FILE_CLASS_CODE, "PHP", 0},
+    {"swift", FILE_CLASS_CODE, "Swift", 0},
+    {"cs", FILE_CLASS_CODE, "C#", 0},
+    {"sh", FILE_CLASS_CODE, "Shell", 0},
+    {"bash", FILE_CLASS_CODE, "Shell", 0},
+    {"zsh", FILE_CLASS_CODE, "Shell", 0},
+    {"html", FILE_CLASS_CODE, "Web", 0},
+    {"css", FILE_CLASS_CODE, "Web", 0},
+    {"scss", FILE_CLASS_CODE, "Web", 0},
+    {"vue", FILE_CLASS_CODE, "Web", 0},
+
+    // Data
+    {"json", FILE_CLASS_DATA, "JSON", 0},
+    {"xml", FILE_CLASS_DATA, "XML", 0},
+    {"yaml", FILE_CLASS_DATA, "Config", 0},
+    {"yml", FILE_CLASS_DATA, "Config", 0},
+    {"toml", FILE_CLASS_DATA, "Config", 0},
+    {"csv", FILE_CLASS_DATA, "Data Files", 0},
+    {"sql", FILE_CLASS_DATA, "Database", 0},
+
+    // Documents
+    {"pdf", FILE_CLASS_DOCUMENT, "PDFs", FILE_TRAIT_PDF},
+    {"doc", FILE_CLASS_DOCUMENT, "Word Documents", FILE_TRAIT_RICH_TEXT},
+    {"docx", FILE_CLASS_DOCUMENT, "Word Documents", FILE_TRAIT_RICH_TEXT},
+    {"odt", FILE_CLASS_DOCUMENT, "Documents", FILE_TRAIT_RICH_TEXT},
+    {"rtf", FILE_CLASS_DOCUMENT, "Text Files", FILE_TRAIT_RICH_TEXT},
+    {"pages", FILE_CLASS_DOCUMENT, "Documents", 0},
+    {"xls", FILE_CLASS_SPREADSHEET, "Spreadsheets", 0},
+    {"xlsx", FILE_CLASS_SPREADSHEET, "Spreadsheets", 0},
+    {"ppt", FILE_CLASS_PRESENTATION, "Presentations", 0},
+    {"pptx", FILE_CLASS_PRESENTATION, "Presentations", 0},
+    {"key", FILE_CLASS_PRESENTATION, "Presentations", 0},
+
+    // Images
+    {"jpg", FILE_CLASS_IMAGE, "Photos", R},
+    {"jpeg", FILE_CLASS_IMAGE, "Photos", R},
+    {"heic", FILE_CLASS_IMAGE, "Photos", R},
+    {"heif", FILE_CLASS_IMAGE, "Photos", R},
+    {"png", FILE_CLASS_IMAGE, "Images", R},
+    {"gif", FILE_CLASS_IMAGE, "GIFs", R},
+    {"bmp", FILE_CLASS_IMAGE, "Images", R},
+    {"webp", FILE_CLASS_IMAGE, "Images", R},
+    {"tiff", FILE_CLASS_IMAGE, "Images", R},
+    {"tif", FILE_CLASS_IMAGE, "Images", R},
+    {"svg", FILE_CLASS_IMAGE, "Vector Graphics", 0},
+    {"ico", FILE_CLASS_IMAGE, "Icons", 0},
+    {"raw", FILE_CLASS_IMAGE, "RAW Photos", 0},
+    {"psd", FILE_CLASS_IMAGE, "Design Files", 0},
+    {"ai", FILE_CLASS_IMAGE, "Design Files", 0},
+    {"sketch", FILE_CLASS_IMAGE, "Design Files", 0},
+    {"fig", FILE_CLASS_IMAGE, "Design Files", 0},
+
+    // Video
+    {"mp4", FILE_CLASS_VIDEO, "Videos", 0},
+    {"mov", FILE_CLASS_VIDEO, "Videos", 0},
+    {"avi", FILE_CLASS_VIDEO, "Videos", 0},
+    {"mkv", FILE_CLASS_VIDEO, "Videos", 0},
+    {"wmv", FILE_CLASS_VIDEO, "Videos", 0},
+    {"webm", FILE_CLASS_VIDEO, "Videos", 0},
+    {"m4v", FILE_CLASS_VIDEO, "Videos", 0},
+
+    // Audio
+    {"mp3", FILE_CLASS_AUDIO, "Music", 0},
+    {"flac", FILE_CLASS_AUDIO, "Music", 0},
+    {"wav", FILE_CLASS_AUDIO, "Audio", 0},
+    {"aac", FILE_CLASS_AUDIO, "Audio", 0},
+    {"m4a", FILE_CLASS_AUDIO, "Audio", 0},
+    {"ogg", FILE_CLASS_AUDIO, "Audio", 0},
+    {"wma", FILE_CLASS_AUDIO, "Audio", 0},
+
+    // Archives and installers
+    {"zip", FILE_CLASS_ARCHIVE, "Archives", 0},
+    {"rar", FILE_CLASS_ARCHIVE, "Archives", 0},
+    {"7z", FILE_CLASS_ARCHIVE, "Archives", 0},
+    {"tar", FILE_CLASS_ARCHIVE, "Archives", 0},
+    {"gz", FILE_CLASS_ARCHIVE, "Archives", 0},
+    {"bz2", FILE_CLASS_ARCHIVE, "Archives", 0},
+    {"xz", FILE_CLASS_ARCHIVE, "Archives", 0},
+    {"iso", FILE_CLASS_ARCHIVE, "Disk Images", 0},
+    {"dmg", FILE_CLASS_INSTALLER, "Installers", 0},
+    {"pkg", FILE_CLASS_INSTALLER, "Installers", 0},
+
+    // Databases, fonts and applications
+    {"db", FILE_CLASS_DATABASE, "Database", 0},
+    {"sqlite", FILE_CLASS_DATABASE, "Database", 0},
+    {"ttf", FILE_CLASS_FONT, "Fonts", 0},
+    {"otf", FILE_CLASS_FONT, "Fonts", 0},
+    {"woff", FILE_CLASS_FONT, "Web Fonts", 0},
+    {"woff2", FILE_CLASS_FONT, "Web Fonts", 0},
+    {"app", FILE_CLASS_APPLICATION, "Applications", 0},
+    {"exe", FILE_CLASS_APPLICATION, "Executables", 0},
+};
+
+#undef R
+
+#define FILE_TYPE_COUNT ((int)(sizeof(FILE_TYPES) / sizeof(FILE_TYPES[0])))
+
+// Slot of each extension's hash: its FileTypeId, 0 where none hashes
+static FileTypeId g_slots[FILE_TYPE_SLOTS];
+static uint32_t g_seed;
+static pthread_once_t g_slots_once = PTHREAD_ONCE_INIT;
+
+// Helper: Slot of a lower-case extension of len bytes
+static uint32_t hash_slot(const char *ext, size_t len, uint32_t seed)
+{
+    uint32_t h = hash_fnv1a_bytes(seed, ext, len);
+    return (h ^ (h >> 16)) & (FILE_TYPE_SLOTS - 1);
+}
+
+// Helper: Fill the slots, moving to the next seed until no two extensions share one
+static void build_slots(void)
+{
+    for (uint32_t seed = FILE_TYPE_SEED; ; seed += FILE_TYPE_SEED_STEP) {
+        memset(g_slots, 0, sizeof(g_slots));
+        bool perfect = true;
+        for (int i = 1; i < FILE_TYPE_COUNT && perfect; i++) {
+            const char *ext = FILE_TYPES[i].extension;
+            uint32_t slot = hash_slot(ext, strlen(ext), seed);
+            perfect = g_slots[slot] == FILE_TYPE_ID_NONE;
+            g_slots[slot] = (FileTypeId)i;
+        }
+        if (perfect) {
+            g_seed = seed;
+            return;
+        }
+    }
+}
+
+FileTypeId file_type_from_extension(const char *extension)
+{
+    if (!extension) {
+        return FILE_TYPE_ID_NONE;
+    }
+    if (extension[0] == '.') {
+        extension++;
+    }
+
+    char lower[FILE_TYPE_EXT_MAX];
+    size_t len = 0;
+    for (; extension[len]; len++) {
+        if (len == sizeof(lower) - 1) {
+            return FILE_TYPE_ID_NONE;
+        }
+        char c = extension[len];
+        lower[len] = (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+    }
+    if (len == 0) {
+        return FILE_TYPE_ID_NONE;
+    }
+    lower[len] = '\0';
+
+    pthread_once(&g_slots_once, build_slots);
+    FileTypeId id = g_slots[hash_slot(lower, len, g_seed)];
+    return strcmp(FILE_TYPES[id].extension, lower) == 0 ? id : FILE_TYPE_ID_NONE;
+}
+
+// Helper: Whether the first bytes of a file look like text: no NULs and no control
+// characters besides whitespace (UTF-8 passes)
+static bool looks_like_text(const unsigned char *bytes, size_t len)
+{
+    if (len == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = bytes[i];
+        if (c < 0x20 && c != '\n' && c != '\r' && c != '\t' && c != '\f') {
+            return false;
+        }
+    }
+    return true;
+}
+
+FileTypeId file_type_sniff(const char *path)
+{
+    // Without blocking on pipes; only regular files are read
+    int fd = open(path, O_RDONLY | O_NONBLOCK);
+    if (fd < 0) {
+        return FILE_TYPE_ID_NONE;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return FILE_TYPE_ID_NONE;
+    }
+    unsigned char b[FILE_TYPE_SNIFF_BYTES];
+    ssize_t got = read(fd, b, sizeof(b));
+    close(fd);
+    if (got <= 0) {
+        return FILE_TYPE_ID_NONE;
+    }
+    size_t n = (size_t)got;
+
+    #define HAS(offset, magic) (n >= (offset) + sizeof(magic) - 1 && \
+                                memcmp(b + (offset), magic, sizeof(magic) - 1) == 0)
+
+    const char *ext = NULL;
+    if (HAS(0, "\x89PNG")) ext = "png";
+    else if (HAS(0, "\xFF\xD8\xFF")) ext = "jpg";
+    else if (HAS(0, "GIF8")) ext = "gif";
+    else if (HAS(0, "RIFF") && HAS(8, "WEBP")) ext = "webp";
+    else if (HAS(0, "RIFF") && HAS(8, "WAVE")) ext = "wav";
+    else if (HAS(0, "RIFF") && HAS(8, "AVI ")) ext = "avi";
+    else if (HAS(0, "II*\0") || HAS(0, "MM\0*")) ext = "tiff";
+    else if (HAS(4, "ftyp")) {
+        if (HAS(8, "qt  ")) ext = "mov";
+        else if (HAS(8, "heic") || HAS(8, "heix") || HAS(8, "mif1")) ext = "heic";
+        else if (HAS(8, "M4A ")) ext = "m4a";
+        else ext = "mp4";
+    }
+    else if (HAS(0, "\x1A\x45\xDF\xA3")) ext = "mkv";
+    else if (HAS(0, "%PDF")) ext = "pdf";
+    else if (HAS(0, "PK\x03\x04")) ext = "zip";
+    else if (HAS(0, "\x1F\x8B")) ext = "gz";
+    else if (HAS(0, "BZh")) ext = "bz2";
+    else if (HAS(0, "\xFD" "7zXZ")) ext = "xz";
+    else if (HAS(0, "7z\xBC\xAF\x27\x1C")) ext = "7z";
+    else if (HAS(0, "Rar!")) ext = "rar";
+    else if (HAS(0, "ID3") || HAS(0, "\xFF\xFB")) ext = "mp3";
+    else if (HAS(0, "fLaC")) ext = "flac";
+    else if (HAS(0, "OggS")) ext = "ogg";
+    else if (HAS(0, "SQLite format 3")) ext = "sqlite";
+    else if (HAS(0, "OTTO")) ext = "otf";
+    else if (HAS(0, "\x00\x01\x00\x00\x00")) ext = "ttf";
+    else if (HAS(0, "wOFF")) ext = "woff";
+    else if (HAS(0, "wOF2")) ext = "woff2";
+    else if (HAS(0, "<?xml")) ext = "xml";
+    else if (HAS(0, "#!") && looks_like_text(b, n)) {
+        // Scripts: by interpreter
+        const unsigned char *eol = memchr(b, '\n', n);
+        size_t line_len = eol ? (size_t)(eol - b) : n;
+        char line[128];
+        if (line_len >= sizeof(line)) line_len = sizeof(line) - 1;
+        memcpy(line, b, line_len);
+        line[line_len] = '\0';
+        if (strstr(line, "python")) ext = "py";
+        else if (strstr(line, "node")) ext = "js";
+        else if (strstr(line, "ruby")) ext = "rb";
+        else ext = "sh";
+    }
+    else if (looks_like_text(b, n)) ext = "txt";
+
+    #undef HAS
+
+    return ext ? file_type_from_extension(ext) : FILE_TYPE_ID_NONE;
+}
+
+FileTypeId file_type_from_path(const char *path)
+{
+    if (!path) {
+        return FILE_TYPE_ID_NONE;
+    }
+
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    const char *dot = strrchr(name, '.');
+    if (dot && dot != name) {
+        return file_type_from_extension(dot + 1);
+    }
+    return file_type_sniff(path);
+}
+
+const FileTypeInfo* file_type_info(FileTypeId id)
+{
+    return id < FILE_TYPE_COUNT ? &FILE_TYPES[id] : &FILE_TYPES[FILE_TYPE_ID_NONE];
+}
+
+bool file_type_is_text(FileTypeId id)
+{
+    FileTypeClass type_class = file_type_class(id);
+    return type_class == FILE_CLASS_TEXT || type_class == FILE_CLASS_MARKDOWN ||
+           type_class == FILE_CLASS_CODE || type_class == FILE_CLASS_DATA;
+}
@@ -0,0 +1,80 @@
+#ifndef FILE_TYPE_H
+#define FILE_TYPE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// File types shared by every part of the app that asks "what kind of file is this": one
+// table of known extensions, each with a broad class, a finer group (used to organize
+// folders) and traits. Extensions are looked up through a perfect hash over the table
+// (built on first use; every known extension has a slot of its own), so a lookup is one
+// hash and one compare. Directory reads store the result in each FileEntry as a
+// FileTypeId, and consumers map it to their own enums by array lookup. Files without an
+// extension can be classified by their first bytes instead (file_type_from_path)
+
+#define FILE_TYPE_SLOTS 1024            // Hash slots (a power of two)
+#define FILE_TYPE_SNIFF_BYTES 512       // Bytes read to classify a file by content
+
+// Broad classes; consumers map these (and traits) to their own categories
+typedef enum FileTypeClass {
+    FILE_CLASS_NONE = 0,                // Unknown extension
+    FILE_CLASS_TEXT,                    // Plain text, logs, config
+    FILE_CLASS_MARKDOWN,
+    FILE_CLASS_CODE,
+    FILE_CLASS_DATA,                    // JSON, XML, YAML, CSV, SQL
+    FILE_CLASS_DOCUMENT,                // PDF, word processing
+    FILE_CLASS_SPREADSHEET,
+    FILE_CLASS_PRESENTATION,
+    FILE_CLASS_IMAGE,
+    FILE_CLASS_VIDEO,
+    FILE_CLASS_AUDIO,
+    FILE_CLASS_ARCHIVE,
+    FILE_CLASS_INSTALLER,               // DMG, PKG
+    FILE_CLASS_DATABASE,
+    FILE_CLASS_FONT,
+    FILE_CLASS_APPLICATION,
+    FILE_CLASS_COUNT
+} FileTypeClass;
+
+// Traits
+#define FILE_TRAIT_RASTER 0x01          // Raster image the platform decoder reads
+#define FILE_TRAIT_PDF 0x02             // Paged document the preview renders
+#define FILE_TRAIT_RICH_TEXT 0x04       // Word processor document the system importers read
+
+// Index into the table; 0 for unknown
+typedef uint8_t FileTypeId;
+#define FILE_TYPE_ID_NONE 0
+
+typedef struct FileTypeInfo {
+    const char *extension;              // Lower case, without the dot ("" for unknown)
+    FileTypeClass type_class;
+    const char *group;                  // "Photos", "C", "Spreadsheets"; "Other" for unknown
+    uint8_t traits;
+} FileTypeInfo;
+
+// Type of an extension, with or without its dot, in any case
+FileTypeId file_type_from_extension(const char *extension);
+
+// Type of a file by its extension; by its first bytes when it has none
+FileTypeId file_type_from_path(const char *path);
+
+// Type of a file by its first bytes alone (magic numbers, else text if it looks like it)
+FileTypeId file_type_sniff(const char *path);
+
+// Table entry of id (the unknown entry for ids out of range)
+const FileTypeInfo* file_type_info(FileTypeId id);
+
+static inline FileTypeClass file_type_class(FileTypeId id)
+{
+    return file_type_info(id)->type_class;
+}
+
+static inline bool file_type_has_trait(FileTypeId id, uint8_t trait)
+{
+    return (file_type_info(id)->traits & trait) != 0;
+}
+
+// Whether id is text a person reads or edits: plain text, markdown, code or data
+bool file_type_is_text(FileTypeId id);
+
+#endif // FILE_TYPE_H
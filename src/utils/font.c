@@ -1,12 +1,40 @@
 #include "font.h"
 #include "theme.h"
+#include "draw_batch.h"
+#include "hash.h"
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 Font g_font = {0};
 Font g_font_small = {0};
 static bool fonts_loaded = false;
 
+// Laid out string: the glyphs to draw and where, truncation already applied
+typedef struct TextLayout {
+    uint32_t epoch;                 // Valid while equal to g_layouts.epoch
+    uint32_t hash;
+    int font_size;
+    int max_width;
+    int text_len;
+    char text[TEXT_LAYOUT_MAX_BYTES + 1];
+    float width;                    // As MeasureTextEx reports it
+    int glyph_count;                // Drawn glyphs (spaces and tabs only advance)
+    uint16_t glyphs[TEXT_LAYOUT_MAX_GLYPHS];  // Glyph indices in the font
+    float x[TEXT_LAYOUT_MAX_GLYPHS];          // Pen offsets from the text origin
+    uint8_t bytes[TEXT_LAYOUT_MAX_GLYPHS];    // Byte of text each glyph is for (LAYOUT_NO_BYTE: "...")
+} TextLayout;
+
+#define LAYOUT_NO_BYTE 0xFF             // Texts are shorter, so no glyph starts here
+
+static struct {
+    TextLayout *slots;              // Allocated on first use
+    uint32_t epoch;
+} g_layouts = { NULL, 1 };
+
 bool font_init(const char *font_path) {
+    font_layout_invalidate();
+
     if (!font_path || font_path[0] == '\0') {
         fonts_loaded = false;
         return false;
@@ -37,6 +65,9 @@ bool font_init(const char *font_path) {
 }
 
 void font_free(void) {
+    free(g_layouts.slots);
+    g_layouts.slots = NULL;
+
     if (fonts_loaded) {
         UnloadFont(g_font);
         UnloadFont(g_font_small);
@@ -57,28 +88,221 @@ Font font_get(int fontSize) {
     return (fontSize <= FONT_SIZE_SMALL) ? g_font_small : g_font;
 }
 
-void DrawTextCustom(const char *text, int posX, int posY, int fontSize, Color color) {
-    if (!text) return;
+void font_layout_invalidate(void) {
+    // Slots from an older epoch are misses; on wrap-around clear them instead
+    if (++g_layouts.epoch == 0) {
+        if (g_layouts.slots) {
+            memset(g_layouts.slots, 0, sizeof(TextLayout) * TEXT_LAYOUT_SLOTS);
+        }
+        g_layouts.epoch = 1;
+    }
+}
+
+// Helper: The font, size and spacing text of a given size is drawn with; without custom
+// fonts these match raylib's DrawText (default font, at least 10 px, 1 px per 10)
+static Font layout_font(int fontSize, float *size, float *spacing) {
+    if (fonts_loaded) {
+        *size = (float)fontSize;
+        *spacing = 0.0f;  // Pixel-art fonts: no extra spacing
+        return font_get(fontSize);
+    }
+    if (fontSize < 10) fontSize = 10;
+    *size = (float)fontSize;
+    *spacing = (float)(fontSize / 10);
+    return GetFontDefault();
+}
+
+// Helper: Hash of a layout key
+static uint32_t layout_hash(const char *text, size_t len, int fontSize, int maxWidth) {
+    uint32_t hash = hash_fnv1a_bytes(HASH_FNV1A_INIT, text, len);
+    hash = (hash ^ (uint32_t)fontSize) * HASH_FNV1A_PRIME;
+    hash = (hash ^ (uint32_t)maxWidth) * HASH_FNV1A_PRIME;
+    return hash;
+}
+
+// Helper: Width raylib measures for the first n codepoints
+static float prefix_width(const float *measured, int n, float scale, float spacing) {
+    return n > 0 ? measured[n] * scale + (float)(n - 1) * spacing : 0.0f;
+}
+
+// Helper: Lay out text, cutting it to max_width with "..." (false if it does not fit a slot)
+static bool layout_build(TextLayout *layout, Font font, float size, float spacing,
+                         const char *text, size_t len, int max_width) {
+    float scale = size / (float)font.baseSize;
+
+    // Per codepoint: glyph, pen position before it, and raylib's measured width up to it
+    int codepoints[TEXT_LAYOUT_MAX_BYTES];
+    int indices[TEXT_LAYOUT_MAX_BYTES];
+    uint8_t starts[TEXT_LAYOUT_MAX_BYTES];
+    float pen[TEXT_LAYOUT_MAX_BYTES + 1];
+    float measured[TEXT_LAYOUT_MAX_BYTES + 1];
+    int count = 0;
+    pen[0] = 0.0f;
+    measured[0] = 0.0f;
+
+    for (size_t i = 0; i < len;) {
+        int bytes = 0;
+        int codepoint = GetCodepointNext(&text[i], &bytes);
+        int index = GetGlyphIndex(font, codepoint);
+        GlyphInfo glyph = font.glyphs[index];
+        float rec_width = font.recs[index].width;
+
+        codepoints[count] = codepoint;
+        indices[count] = index;
+        starts[count] = (uint8_t)i;
+        pen[count + 1] = pen[count] + ((glyph.advanceX == 0) ? rec_width * scale : glyph.advanceX * scale) + spacing;
+        measured[count + 1] = measured[count] + ((glyph.advanceX > 0) ? glyph.advanceX : rec_width + glyph.offsetX);
+        count++;
+        i += bytes > 0 ? (size_t)bytes : 1;
+    }
+
+    int keep = count;
+    int dots = 0;
+    float dot_advance = 0.0f;
+    float width = prefix_width(measured, count, scale, spacing);
+
+    if (max_width > 0 && width > (float)max_width) {
+        int dot = GetGlyphIndex(font, '.');
+        GlyphInfo glyph = font.glyphs[dot];
+        float rec_width = font.recs[dot].width;
+        float dot_measured = (glyph.advanceX > 0) ? glyph.advanceX : rec_width + glyph.offsetX;
+        float dots_width = 3.0f * dot_measured * scale + 2.0f * spacing;
+        dot_advance = ((glyph.advanceX == 0) ? rec_width * scale : glyph.advanceX * scale) + spacing;
+
+        while (keep > 0 && prefix_width(measured, keep, scale, spacing) + spacing + dots_width > (float)max_width) keep--;
+        while (keep > 0 && codepoints[keep - 1] == ' ') keep--;
+
+        dots = 3;
+        width = keep > 0 ? prefix_width(measured, keep, scale, spacing) + spacing + dots_width : dots_width;
+    }
+
+    int glyph_count = 0;
+    for (int i = 0; i < keep; i++) {
+        if (codepoints[i] == ' ' || codepoints[i] == '\t') continue;
+        if (glyph_count >= TEXT_LAYOUT_MAX_GLYPHS) return false;
+        layout->glyphs[glyph_count] = (uint16_t)indices[i];
+        layout->x[glyph_count] = pen[i];
+        layout->bytes[glyph_count] = starts[i];
+        glyph_count++;
+    }
+    for (int i = 0; i < dots; i++) {
+        if (glyph_count >= TEXT_LAYOUT_MAX_GLYPHS) return false;
+        layout->glyphs[glyph_count] = (uint16_t)GetGlyphIndex(font, '.');
+        layout->x[glyph_count] = pen[keep] + dot_advance * (float)i;
+        layout->bytes[glyph_count] = LAYOUT_NO_BYTE;
+        glyph_count++;
+    }
+
+    layout->glyph_count = glyph_count;
+    layout->width = width;
+    return true;
+}
+
+// Helper: The cached layout of text, built on a miss; NULL for text the cache skips
+static const TextLayout *layout_get(const char *text, int fontSize, int maxWidth,
+                                    Font *font, float *size) {
+    size_t len = strlen(text);
+    if (len > TEXT_LAYOUT_MAX_BYTES || memchr(text, '\n', len)) return NULL;
+
+    float spacing;
+    *font = layout_font(fontSize, size, &spacing);
+    if (font->texture.id == 0 || !font->glyphs || font->glyphCount > UINT16_MAX) return NULL;
+
+    if (!g_layouts.slots) {
+        g_layouts.slots = (TextLayout *)calloc(TEXT_LAYOUT_SLOTS, sizeof(TextLayout));
+        if (!g_layouts.slots) return NULL;
+    }
+
+    if (maxWidth < 0) maxWidth = 0;
+    uint32_t hash = layout_hash(text, len, fontSize, maxWidth);
+    TextLayout *layout = &g_layouts.slots[hash & (TEXT_LAYOUT_SLOTS - 1)];
+
+    if (layout->epoch == g_layouts.epoch && layout->hash == hash &&
+        layout->font_size == fontSize && layout->max_width == maxWidth &&
+        layout->text_len == (int)len && memcmp(layout->text, text, len) == 0) {
+        return layout;
+    }
+
+    layout->epoch = 0;
+    if (!layout_build(layout, *font, *size, spacing, text, len, maxWidth)) return NULL;
+
+    memcpy(layout->text, text, len);
+    layout->text[len] = '\0';
+    layout->text_len = (int)len;
+    layout->hash = hash;
+    layout->font_size = fontSize;
+    layout->max_width = maxWidth;
+    layout->epoch = g_layouts.epoch;
+    return layout;
+}
+
+// Helper: Draw a layout's glyphs the way raylib's DrawTextCodepoint does (queued when a
+// draw batch is open), colored by byte when byte_colors is given
+static void layout_draw(const TextLayout *layout, Font font, float size, Vector2 pos, Color color,
+                        const Color *byte_colors) {
+    float scale = size / (float)font.baseSize;
+    float padding = (float)font.glyphPadding;
+
+    for (int i = 0; i < layout->glyph_count; i++) {
+        int index = layout->glyphs[i];
+        Rectangle rec = font.recs[index];
+        GlyphInfo glyph = font.glyphs[index];
+
+        Rectangle src = { rec.x - padding, rec.y - padding, rec.width + 2.0f * padding, rec.height + 2.0f * padding };
+        Rectangle dst = { pos.x + layout->x[i] + (glyph.offsetX - padding) * scale,
+                          pos.y + (glyph.offsetY - padding) * scale,
+                          src.width * scale, src.height * scale };
+        bool by_byte = byte_colors && layout->bytes[i] != LAYOUT_NO_BYTE;
+        draw_batch_glyph(font.texture, src, dst, by_byte ? byte_colors[layout->bytes[i]] : color);
+    }
+}
+
+void DrawTextFitColored(const char *text, int posX, int posY, int fontSize, int maxWidth, Color color,
+                        const Color *byteColors) {
+    if (!text || text[0] == '\0') return;
+
+    Font font;
+    float size;
+    const TextLayout *layout = layout_get(text, fontSize, maxWidth, &font, &size);
+    if (layout) {
+        layout_draw(layout, font, size, (Vector2){ (float)posX, (float)posY }, color, byteColors);
+        return;
+    }
 
+    // Not cacheable: drawn whole, after anything queued beneath it
+    if (draw_batch_is_open()) draw_batch_flush();
     if (!fonts_loaded) {
         DrawText(text, posX, posY, fontSize, color);
         return;
     }
+    DrawTextEx(font_get(fontSize), text, (Vector2){ (float)posX, (float)posY }, (float)fontSize, 0.0f, color);
+}
 
-    Font font = font_get(fontSize);
-    Vector2 pos = { (float)posX, (float)posY };
-    float spacing = 0.0f;  // Pixel-art fonts: no extra spacing
-    DrawTextEx(font, text, pos, (float)fontSize, spacing, color);
+void DrawTextFit(const char *text, int posX, int posY, int fontSize, int maxWidth, Color color) {
+    DrawTextFitColored(text, posX, posY, fontSize, maxWidth, color, NULL);
 }
 
-int MeasureTextCustom(const char *text, int fontSize) {
-    if (!text) return 0;
+int MeasureTextFit(const char *text, int fontSize, int maxWidth) {
+    if (!text || text[0] == '\0') return 0;
+
+    Font font;
+    float size;
+    const TextLayout *layout = layout_get(text, fontSize, maxWidth, &font, &size);
+    if (layout) {
+        return (int)layout->width;
+    }
 
     if (!fonts_loaded) {
         return MeasureText(text, fontSize);
     }
+    Vector2 measured = MeasureTextEx(font_get(fontSize), text, (float)fontSize, 0.0f);
+    return (int)measured.x;
+}
 
-    Font font = font_get(fontSize);
-    Vector2 size = MeasureTextEx(font, text, (float)fontSize, 0.0f);
-    return (int)size.x;
+void DrawTextCustom(const char *text, int posX, int posY, int fontSize, Color color) {
+    DrawTextFit(text, posX, posY, fontSize, 0, color);
+}
+
+int MeasureTextCustom(const char *text, int fontSize) {
+    return MeasureTextFit(text, fontSize, 0);
 }
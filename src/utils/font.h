@@ -4,6 +4,13 @@
 #include "raylib.h"
 #include <stdbool.h>
 
+// Text layout cache: each string drawn or measured keeps its glyphs and their x offsets,
+// keyed by (text, font size, max width), so a string seen on the previous frame is drawn
+// without decoding or measuring it again. Longer strings and multi-line text skip it
+#define TEXT_LAYOUT_SLOTS 1024          // Direct-mapped by hash
+#define TEXT_LAYOUT_MAX_BYTES 255       // Longest text cached
+#define TEXT_LAYOUT_MAX_GLYPHS 128      // Most glyphs kept per layout (after truncation)
+
 // Global fonts - initialized in font_init(), freed in font_free()
 extern Font g_font;        // Primary font (FONT_SIZE, typically 14)
 extern Font g_font_small;  // Small font (FONT_SIZE_SMALL, typically 12)
@@ -26,4 +33,18 @@ Font font_get(int fontSize);
 void DrawTextCustom(const char *text, int posX, int posY, int fontSize, Color color);
 int MeasureTextCustom(const char *text, int fontSize);
 
+// Draw text cut to maxWidth pixels, ending in "..." when cut (maxWidth <= 0: no limit)
+void DrawTextFit(const char *text, int posX, int posY, int fontSize, int maxWidth, Color color);
+
+// DrawTextFit with each byte of text in its own color (byteColors[i] for text[i]; the
+// "..." and text the layout cache skips are drawn in color)
+void DrawTextFitColored(const char *text, int posX, int posY, int fontSize, int maxWidth, Color color,
+                        const Color *byteColors);
+
+// Width of text as DrawTextFit draws it
+int MeasureTextFit(const char *text, int fontSize, int maxWidth);
+
+// Drop cached layouts (on resize and theme change; fonts drop them when reloaded)
+void font_layout_invalidate(void);
+
 #endif // FONT_H
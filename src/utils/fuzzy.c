@@ -0,0 +1,165 @@
+#include "fuzzy.h"
+
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define FUZZY_SSE2 1
+#endif
+
+static inline unsigned char fold_char(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+static inline bool is_upper(unsigned char c)
+{
+    return c >= 'A' && c <= 'Z';
+}
+
+static inline bool is_lower(unsigned char c)
+{
+    return c >= 'a' && c <= 'z';
+}
+
+static uint64_t char_bit(unsigned char c)
+{
+    c = fold_char(c);
+    if (c >= 'a' && c <= 'z') return 1ULL << (c - 'a');
+    if (c >= '0' && c <= '9') return 1ULL << (26 + c - '0');
+    return 1ULL << (36 + c % 28);  // Everything else shares the remaining bits
+}
+
+uint64_t fuzzy_char_mask(const char *text)
+{
+    uint64_t mask = 0;
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        mask |= char_bit(*p);
+    }
+    return mask;
+}
+
+bool fuzzy_compile(FuzzyQuery *query, const char *text, bool case_sensitive)
+{
+    query->length = 0;
+    query->mask = 0;
+    query->case_sensitive = case_sensitive;
+    query->text[0] = '\0';
+    query->folded[0] = '\0';
+    if (!text) return false;
+
+    size_t length = strlen(text);
+    if (length >= FUZZY_MAX_QUERY) length = FUZZY_MAX_QUERY - 1;
+    memcpy(query->text, text, length);
+    query->text[length] = '\0';
+    fuzzy_fold(query->folded, query->text, length + 1);
+    query->length = (int)length;
+    query->mask = fuzzy_char_mask(query->text);
+    return length > 0;
+}
+
+void fuzzy_fold(char *dst, const char *src, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        dst[i] = (char)fold_char((unsigned char)src[i]);
+    }
+}
+
+int fuzzy_prefilter(const FuzzyQuery *query, const uint64_t *masks, int count, int *out)
+{
+    uint64_t need = query->mask;
+    int kept = 0;
+    int i = 0;
+
+#if defined(__ARM_NEON)
+    uint64x2_t needed = vdupq_n_u64(need);
+    for (; i + 2 <= count; i += 2) {
+        uint64x2_t missing = vbicq_u64(needed, vld1q_u64(masks + i));
+        if (vgetq_lane_u64(missing, 0) == 0) out[kept++] = i;
+        if (vgetq_lane_u64(missing, 1) == 0) out[kept++] = i + 1;
+    }
+#elif defined(FUZZY_SSE2)
+    __m128i needed = _mm_set1_epi64x((long long)need);
+    __m128i zero = _mm_setzero_si128();
+    for (; i + 2 <= count; i += 2) {
+        __m128i missing = _mm_andnot_si128(_mm_loadu_si128((const __m128i *)(masks + i)), needed);
+        // A 64-bit lane is clear when both of its 32-bit halves compare equal to zero
+        int clear = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(missing, zero)));
+        if ((clear & 0x3) == 0x3) out[kept++] = i;
+        if ((clear & 0xC) == 0xC) out[kept++] = i + 1;
+    }
+#endif
+
+    for (; i < count; i++) {
+        if ((need & ~masks[i]) == 0) out[kept++] = i;
+    }
+    return kept;
+}
+
+int fuzzy_score(const FuzzyQuery *query, const char *text, const char *folded, int length,
+                int *positions, int max_positions, int *match_count)
+{
+    if (match_count) *match_count = 0;
+    if (!text || query->length == 0) return 0;
+    if (length < 0) length = (int)strlen(text);
+
+    // Case-sensitive queries search the text itself; the others its folded copy
+    const char *haystack = query->case_sensitive ? text : folded;
+    const char *pattern = query->case_sensitive ? query->text : query->folded;
+    const unsigned char *t = (const unsigned char *)text;
+
+    int score = 0;
+    int matches = 0;
+    int run = 0;
+    int prev = -2;
+    int from = 0;
+    for (int q = 0; q < query->length; q++) {
+        int at;
+        if (haystack) {
+            const char *hit = memchr(haystack + from, pattern[q], (size_t)(length - from));
+            at = hit ? (int)(hit - haystack) : length;
+        } else {
+            at = from;
+            while (at < length && fold_char(t[at]) != (unsigned char)pattern[q]) at++;
+        }
+        if (at >= length) break;
+
+        if (positions && matches < max_positions) {
+            positions[matches] = at;
+        }
+        matches++;
+        score += 10;
+
+        // Consecutive matches earn more the longer the run
+        if (at == prev + 1) {
+            run++;
+            score += 5 * run;
+        } else {
+            run = 0;
+        }
+
+        // Start of a word, or a camelCase hump
+        if (at == 0 || t[at - 1] == ' ' || t[at - 1] == '_' || t[at - 1] == '-' || t[at - 1] == '.') {
+            score += 15;
+        }
+        if (at > 0 && is_upper(t[at]) && is_lower(t[at - 1])) {
+            score += 10;
+        }
+
+        // Typed case agrees
+        if (!query->case_sensitive && (unsigned char)query->text[q] == t[at]) {
+            score += 2;
+        }
+
+        prev = at;
+        from = at + 1;
+    }
+
+    if (match_count) *match_count = matches;
+    if (matches < query->length) return 0;
+
+    // Denser matches (shorter text) rank higher
+    return score + (100 * matches) / length;
+}
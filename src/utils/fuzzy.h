@@ -0,0 +1,50 @@
+#ifndef FUZZY_H
+#define FUZZY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Fuzzy matching shared by the command palette and the file search. A query is compiled
+// once per keystroke (case folded, with the set of characters it needs); candidates keep
+// their own folded copy and character set, so matching never folds or allocates. The
+// character sets reject most candidates with one AND (two per instruction with SIMD)
+// before the scorer walks the survivors with memchr
+
+#define FUZZY_MAX_QUERY 256
+
+// Compiled query
+typedef struct FuzzyQuery {
+    char text[FUZZY_MAX_QUERY];         // As typed
+    char folded[FUZZY_MAX_QUERY];       // ASCII lower case
+    int length;
+    uint64_t mask;                      // fuzzy_char_mask of the query
+    bool case_sensitive;
+} FuzzyQuery;
+
+// Compile text into query; false if it is empty (it then matches nothing)
+bool fuzzy_compile(FuzzyQuery *query, const char *text, bool case_sensitive);
+
+// Set of the (case-folded) characters in text: a candidate can only match a query whose
+// mask is a subset of its own
+uint64_t fuzzy_char_mask(const char *text);
+
+static inline bool fuzzy_may_match(const FuzzyQuery *query, uint64_t mask)
+{
+    return (query->mask & ~mask) == 0;
+}
+
+// Write to out the indices of the masks that may match query; returns how many
+int fuzzy_prefilter(const FuzzyQuery *query, const uint64_t *masks, int count, int *out);
+
+// Copy length bytes of src to dst in ASCII lower case (dst may be src)
+void fuzzy_fold(char *dst, const char *src, size_t length);
+
+// Score text against query (higher is better, 0 if some query character is missing).
+// folded is text in lower case, or NULL to fold while matching; length is strlen(text)
+// or -1. The first max_positions matched offsets go to positions (may be NULL), and the
+// number of query characters matched to match_count (may be NULL)
+int fuzzy_score(const FuzzyQuery *query, const char *text, const char *folded, int length,
+                int *positions, int max_positions, int *match_count);
+
+#endif // FUZZY_H
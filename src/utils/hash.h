@@ -0,0 +1,55 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// FNV-1a, the hash behind the in-memory tables and the on-disk cache keys. The _bytes
+// forms continue from a hash so several fields can be chained; start them from the
+// matching _INIT. Cache file names are made of these values, so they must not change
+
+#define HASH_FNV1A_INIT 2166136261u
+#define HASH_FNV1A_PRIME 16777619u
+#define HASH_FNV1A64_INIT 14695981039346656037ULL
+#define HASH_FNV1A64_PRIME 1099511628211ULL
+
+// Continue a 32-bit hash over len bytes
+static inline uint32_t hash_fnv1a_bytes(uint32_t hash, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * HASH_FNV1A_PRIME;
+    }
+    return hash;
+}
+
+// 32-bit hash of a string
+static inline uint32_t hash_fnv1a(const char *text)
+{
+    uint32_t hash = HASH_FNV1A_INIT;
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        hash = (hash ^ *p) * HASH_FNV1A_PRIME;
+    }
+    return hash;
+}
+
+// Continue a 64-bit hash over len bytes
+static inline uint64_t hash_fnv1a64_bytes(uint64_t hash, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * HASH_FNV1A64_PRIME;
+    }
+    return hash;
+}
+
+// Continue a 64-bit hash over a string
+static inline uint64_t hash_fnv1a64_string(uint64_t hash, const char *text)
+{
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        hash = (hash ^ *p) * HASH_FNV1A64_PRIME;
+    }
+    return hash;
+}
+
+#endif // HASH_H
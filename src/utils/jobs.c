@@ -0,0 +1,452 @@
+#include "jobs.h"
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct Job {
+    JobRun run;
+    JobComplete complete;
+    void *arg;
+    JobToken *token;
+    JobQos qos;
+    bool cancelled;                     // Set once finished: run was skipped or cancelled
+    struct Job *next;
+} Job;
+
+struct JobToken {
+    atomic_bool cancelled;
+    atomic_int refs;
+    pthread_mutex_t mutex;
+    pthread_cond_t idle;
+    int pending;                        // Submitted and not yet finished
+};
+
+// A worker's own jobs: the owner pushes and pops at tail, thieves take from head
+typedef struct JobWorker {
+    pthread_t thread;
+    int index;
+    bool running;                       // The thread started
+    pthread_mutex_t mutex;
+    Job *deque[JOBS_LOCAL_CAPACITY];
+    int head;                           // Oldest job
+    int count;
+} JobWorker;
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t work;                // A job was queued, a slot freed, or stopping
+    Job *queue_head[JOB_QOS_COUNT];     // Shared FIFO per class
+    Job *queue_tail[JOB_QOS_COUNT];
+    int running[JOB_QOS_COUNT];
+    int limit[JOB_QOS_COUNT];           // Workers a class may occupy at once
+    int local_queued;                   // Jobs waiting in worker deques
+    JobWorker workers[JOBS_MAX_WORKERS];
+    int worker_count;
+    bool started;
+    bool stopping;
+
+    pthread_mutex_t done_mutex;         // Completions waiting for the main thread, per class
+    Job *done_head[JOB_QOS_COUNT];
+    Job *done_tail[JOB_QOS_COUNT];
+    void (*wake)(void);
+} g_jobs = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .done_mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static __thread JobWorker *t_worker = NULL;
+
+//=============================================================================
+// Tokens
+//=============================================================================
+
+JobToken *job_token_create(void)
+{
+    JobToken *token = calloc(1, sizeof(JobToken));
+    if (!token) return NULL;
+    atomic_init(&token->cancelled, false);
+    atomic_init(&token->refs, 1);
+    pthread_mutex_init(&token->mutex, NULL);
+    pthread_cond_init(&token->idle, NULL);
+    return token;
+}
+
+void job_token_release(JobToken *token)
+{
+    if (!token) return;
+    if (atomic_fetch_sub(&token->refs, 1) == 1) {
+        pthread_cond_destroy(&token->idle);
+        pthread_mutex_destroy(&token->mutex);
+        free(token);
+    }
+}
+
+void job_token_cancel(JobToken *token)
+{
+    if (token) atomic_store(&token->cancelled, true);
+}
+
+bool job_token_cancelled(const JobToken *token)
+{
+    return token && atomic_load(&((JobToken *)token)->cancelled);
+}
+
+void job_token_wait(JobToken *token)
+{
+    if (!token) return;
+    pthread_mutex_lock(&token->mutex);
+    while (token->pending > 0) {
+        pthread_cond_wait(&token->idle, &token->mutex);
+    }
+    pthread_mutex_unlock(&token->mutex);
+}
+
+// Helper: A job holding token was submitted
+static void token_attach(JobToken *token)
+{
+    if (!token) return;
+    atomic_fetch_add(&token->refs, 1);
+    pthread_mutex_lock(&token->mutex);
+    token->pending++;
+    pthread_mutex_unlock(&token->mutex);
+}
+
+// Helper: A job holding token finished; wake its waiters and drop the job's reference
+static void token_detach(JobToken *token)
+{
+    if (!token) return;
+    pthread_mutex_lock(&token->mutex);
+    if (--token->pending == 0) {
+        pthread_cond_broadcast(&token->idle);
+    }
+    pthread_mutex_unlock(&token->mutex);
+    job_token_release(token);
+}
+
+//=============================================================================
+// Running
+//=============================================================================
+
+// Helper: Hand a finished job's completion to the main thread, or free it
+static void job_finish(Job *job, bool cancelled)
+{
+    job->cancelled = cancelled || job_token_cancelled(job->token);
+    token_detach(job->token);
+    job->token = NULL;
+
+    if (!job->complete) {
+        free(job);
+        return;
+    }
+    job->next = NULL;
+    pthread_mutex_lock(&g_jobs.done_mutex);
+    if (g_jobs.done_tail[job->qos]) {
+        g_jobs.done_tail[job->qos]->next = job;
+    } else {
+        g_jobs.done_head[job->qos] = job;
+    }
+    g_jobs.done_tail[job->qos] = job;
+    void (*wake)(void) = g_jobs.wake;
+    pthread_mutex_unlock(&g_jobs.done_mutex);
+    if (wake) wake();
+}
+
+// Helper: Run a job unless its token was cancelled while it waited
+static void job_execute(Job *job)
+{
+    bool skipped = job_token_cancelled(job->token);
+    if (!skipped) {
+        TRACE_SCOPE("job");
+        job->run(job->arg, job->token);
+    }
+    job_finish(job, skipped);
+}
+
+// Helper: Take the oldest shared job of the highest class with a free slot (caller
+// holds the mutex)
+static Job *take_shared_locked(void)
+{
+    for (int qos = JOB_QOS_COUNT - 1; qos >= 0; qos--) {
+        Job *job = g_jobs.queue_head[qos];
+        if (!job || g_jobs.running[qos] >= g_jobs.limit[qos]) continue;
+        g_jobs.queue_head[qos] = job->next;
+        if (!g_jobs.queue_head[qos]) g_jobs.queue_tail[qos] = NULL;
+        g_jobs.running[qos]++;
+        return job;
+    }
+    return NULL;
+}
+
+// Helper: Take the newest job from a worker's own deque
+static Job *pop_local(JobWorker *worker)
+{
+    Job *job = NULL;
+    pthread_mutex_lock(&worker->mutex);
+    if (worker->count > 0) {
+        worker->count--;
+        job = worker->deque[(worker->head + worker->count) % JOBS_LOCAL_CAPACITY];
+    }
+    pthread_mutex_unlock(&worker->mutex);
+    return job;
+}
+
+// Helper: Take the oldest job from another worker's deque
+static Job *steal(JobWorker *self)
+{
+    for (int i = 1; i < g_jobs.worker_count; i++) {
+        JobWorker *victim = &g_jobs.workers[(self->index + i) % g_jobs.worker_count];
+        pthread_mutex_lock(&victim->mutex);
+        Job *job = NULL;
+        if (victim->count > 0) {
+            job = victim->deque[victim->head];
+            victim->head = (victim->head + 1) % JOBS_LOCAL_CAPACITY;
+            victim->count--;
+        }
+        pthread_mutex_unlock(&victim->mutex);
+        if (job) return job;
+    }
+    return NULL;
+}
+
+// Helper: Count a job taken from a deque as running
+static void claim_local(Job *job)
+{
+    pthread_mutex_lock(&g_jobs.mutex);
+    g_jobs.local_queued--;
+    g_jobs.running[job->qos]++;
+    pthread_mutex_unlock(&g_jobs.mutex);
+}
+
+static void *job_worker_thread(void *arg)
+{
+    JobWorker *self = (JobWorker *)arg;
+    t_worker = self;
+
+    char name[TRACE_THREAD_NAME_MAX];
+    snprintf(name, sizeof(name), "job-worker-%d", self->index);
+    trace_set_thread_name(name);
+
+    for (;;) {
+        Job *job = pop_local(self);
+        if (!job) job = steal(self);
+        if (job) {
+            claim_local(job);
+        } else {
+            pthread_mutex_lock(&g_jobs.mutex);
+            while (!g_jobs.stopping && !(job = take_shared_locked()) && g_jobs.local_queued == 0) {
+                pthread_cond_wait(&g_jobs.work, &g_jobs.mutex);
+            }
+            bool stopping = g_jobs.stopping;
+            pthread_mutex_unlock(&g_jobs.mutex);
+            if (!job) {
+                if (stopping) break;
+                continue;               // A deque has work
+            }
+        }
+
+        JobQos qos = job->qos;
+        job_execute(job);
+
+        pthread_mutex_lock(&g_jobs.mutex);
+        g_jobs.running[qos]--;
+        pthread_cond_broadcast(&g_jobs.work);   // A class may have dropped under its limit
+        bool stopping = g_jobs.stopping;
+        pthread_mutex_unlock(&g_jobs.mutex);
+        if (stopping) break;
+    }
+    t_worker = NULL;
+    return NULL;
+}
+
+//=============================================================================
+// Scheduler
+//=============================================================================
+
+bool jobs_start(int workers)
+{
+    if (g_jobs.started) return true;
+
+    if (workers <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cores > 0 ? (int)cores : 4;
+    }
+    if (workers > JOBS_MAX_WORKERS) workers = JOBS_MAX_WORKERS;
+
+    g_jobs.limit[JOB_QOS_USER_INTERACTIVE] = workers;
+    g_jobs.limit[JOB_QOS_USER_INITIATED] = workers;
+    g_jobs.limit[JOB_QOS_UTILITY] = workers / 2 > 0 ? workers / 2 : 1;
+    g_jobs.limit[JOB_QOS_BACKGROUND] = workers / 4 > 0 ? workers / 4 : 1;
+    g_jobs.stopping = false;
+    g_jobs.local_queued = 0;
+
+    // Every deque exists before any worker can steal from it; a slot whose thread
+    // failed to start stays empty
+    for (int i = 0; i < workers; i++) {
+        JobWorker *worker = &g_jobs.workers[i];
+        memset(worker, 0, sizeof(*worker));
+        worker->index = i;
+        pthread_mutex_init(&worker->mutex, NULL);
+    }
+    g_jobs.worker_count = workers;
+
+    int started = 0;
+    for (int i = 0; i < workers; i++) {
+        JobWorker *worker = &g_jobs.workers[i];
+        worker->running = pthread_create(&worker->thread, NULL, job_worker_thread, worker) == 0;
+        if (worker->running) started++;
+    }
+    if (started == 0) {
+        for (int i = 0; i < workers; i++) {
+            pthread_mutex_destroy(&g_jobs.workers[i].mutex);
+        }
+        g_jobs.worker_count = 0;
+        return false;
+    }
+    g_jobs.started = true;
+    return true;
+}
+
+void jobs_stop(void)
+{
+    if (!g_jobs.started) {
+        jobs_drain_completions(0);
+        return;
+    }
+
+    pthread_mutex_lock(&g_jobs.mutex);
+    g_jobs.stopping = true;
+    pthread_cond_broadcast(&g_jobs.work);
+    pthread_mutex_unlock(&g_jobs.mutex);
+    for (int i = 0; i < g_jobs.worker_count; i++) {
+        if (g_jobs.workers[i].running) pthread_join(g_jobs.workers[i].thread, NULL);
+    }
+    g_jobs.started = false;
+
+    // Whatever was still queued is cancelled
+    for (int i = 0; i < g_jobs.worker_count; i++) {
+        JobWorker *worker = &g_jobs.workers[i];
+        while (worker->count > 0) {
+            worker->count--;
+            job_finish(worker->deque[(worker->head + worker->count) % JOBS_LOCAL_CAPACITY], true);
+        }
+        pthread_mutex_destroy(&worker->mutex);
+    }
+    for (int qos = 0; qos < JOB_QOS_COUNT; qos++) {
+        while (g_jobs.queue_head[qos]) {
+            Job *job = g_jobs.queue_head[qos];
+            g_jobs.queue_head[qos] = job->next;
+            job_finish(job, true);
+        }
+        g_jobs.queue_tail[qos] = NULL;
+        g_jobs.running[qos] = 0;
+    }
+    g_jobs.worker_count = 0;
+    g_jobs.local_queued = 0;
+    g_jobs.stopping = false;
+
+    jobs_drain_completions(0);
+}
+
+bool jobs_started(void)
+{
+    return g_jobs.started;
+}
+
+void jobs_set_wake(void (*wake)(void))
+{
+    pthread_mutex_lock(&g_jobs.done_mutex);
+    g_jobs.wake = wake;
+    pthread_mutex_unlock(&g_jobs.done_mutex);
+}
+
+bool jobs_submit(JobQos qos, JobRun run, JobComplete complete, void *arg, JobToken *token)
+{
+    if (!run) return false;
+    if ((int)qos < 0 || qos >= JOB_QOS_COUNT) qos = JOB_QOS_UTILITY;
+
+    Job *job = g_jobs.started ? calloc(1, sizeof(Job)) : NULL;
+    if (!job) {
+        // No workers (or no memory to queue it): run it here
+        bool skipped = job_token_cancelled(token);
+        if (!skipped) run(arg, token);
+        if (complete) complete(arg, skipped || job_token_cancelled(token));
+        return false;
+    }
+    job->run = run;
+    job->complete = complete;
+    job->arg = arg;
+    job->token = token;
+    job->qos = qos;
+    token_attach(token);
+
+    // From inside a job: onto this worker's deque, where it runs next or is stolen
+    JobWorker *worker = t_worker;
+    if (worker) {
+        pthread_mutex_lock(&worker->mutex);
+        bool pushed = worker->count < JOBS_LOCAL_CAPACITY;
+        if (pushed) {
+            worker->deque[(worker->head + worker->count) % JOBS_LOCAL_CAPACITY] = job;
+            worker->count++;
+        }
+        pthread_mutex_unlock(&worker->mutex);
+        if (pushed) {
+            pthread_mutex_lock(&g_jobs.mutex);
+            g_jobs.local_queued++;
+            pthread_cond_signal(&g_jobs.work);
+            pthread_mutex_unlock(&g_jobs.mutex);
+            return true;
+        }
+    }
+
+    pthread_mutex_lock(&g_jobs.mutex);
+    if (g_jobs.queue_tail[qos]) {
+        g_jobs.queue_tail[qos]->next = job;
+    } else {
+        g_jobs.queue_head[qos] = job;
+    }
+    g_jobs.queue_tail[qos] = job;
+    pthread_cond_signal(&g_jobs.work);
+    pthread_mutex_unlock(&g_jobs.mutex);
+    return true;
+}
+
+// Helper: Monotonic seconds
+static double jobs_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int jobs_drain_completions(double budget_seconds)
+{
+    double deadline = budget_seconds > 0 ? jobs_now() + budget_seconds : 0;
+    int ran = 0;
+    for (;;) {
+        // Most urgent class first: what the next frame shows before prefetched work
+        Job *job = NULL;
+        pthread_mutex_lock(&g_jobs.done_mutex);
+        for (int qos = JOB_QOS_COUNT - 1; qos >= 0 && !job; qos--) {
+            job = g_jobs.done_head[qos];
+            if (job) {
+                g_jobs.done_head[qos] = job->next;
+                if (!g_jobs.done_head[qos]) g_jobs.done_tail[qos] = NULL;
+            }
+        }
+        pthread_mutex_unlock(&g_jobs.done_mutex);
+        if (!job) break;
+
+        job->complete(job->arg, job->cancelled);
+        free(job);
+        ran++;
+        if (deadline > 0 && jobs_now() >= deadline) break;
+    }
+    return ran;
+}
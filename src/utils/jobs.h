@@ -0,0 +1,70 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdbool.h>
+
+// Shared job scheduler for one-shot background work. A fixed pool of workers (one per
+// core by default) takes jobs by quality of service: user-interactive first, background
+// last, and the utility and background classes may only occupy part of the pool at
+// once, so bulk work never starves what the user is waiting on. A job submitted from
+// inside another job goes to its worker's own deque and runs there next; idle workers
+// steal the oldest of those from busy ones. Each job may carry a cancellation token,
+// which is also what its owner waits on, and a completion that runs on the main thread
+// from jobs_drain_completions
+//
+// Before jobs_start (and after jobs_stop) jobs run inline on the submitting thread
+
+#define JOBS_MAX_WORKERS 32
+#define JOBS_LOCAL_CAPACITY 256         // Jobs a worker's own deque holds; more go to the shared queue
+
+typedef enum JobQos {
+    JOB_QOS_BACKGROUND = 0,             // Prefetching and indexing; at most a quarter of the pool
+    JOB_QOS_UTILITY,                    // Long work with visible progress; at most half the pool
+    JOB_QOS_USER_INITIATED,             // Something the user asked for and waits on
+    JOB_QOS_USER_INTERACTIVE,           // Needed for the next frame
+    JOB_QOS_COUNT
+} JobQos;
+
+// Cancellation token, shared by the owner and the jobs submitted with it (opaque)
+typedef struct JobToken JobToken;
+
+// Runs on a worker; long jobs should return early once job_token_cancelled(token)
+typedef void (*JobRun)(void *arg, JobToken *token);
+
+// Runs on the main thread after run, or instead of it when the job was cancelled first
+typedef void (*JobComplete)(void *arg, bool cancelled);
+
+// Start the workers (0 for one per core); false if none could start
+bool jobs_start(int workers);
+
+// Stop the workers: running jobs finish, queued ones are cancelled, and every pending
+// completion runs before this returns (call from the main thread)
+void jobs_stop(void);
+
+// Whether workers are running
+bool jobs_started(void);
+
+// Called after a completion is queued, to wake a sleeping main loop
+void jobs_set_wake(void (*wake)(void));
+
+// Queue run at qos. token (may be NULL) is retained until the job has finished;
+// complete (may be NULL) is queued for the main thread afterwards. Returns true if
+// queued, false if it ran inline
+bool jobs_submit(JobQos qos, JobRun run, JobComplete complete, void *arg, JobToken *token);
+
+// Run queued completions on the calling (main) thread, most urgent class first, for up
+// to budget_seconds (0: all of them; at least one runs). Returns how many ran
+int jobs_drain_completions(double budget_seconds);
+
+// Create a token (one reference, held by the caller)
+JobToken *job_token_create(void);
+void job_token_release(JobToken *token);
+
+// Ask the token's jobs to stop: queued ones are skipped, running ones see it
+void job_token_cancel(JobToken *token);
+bool job_token_cancelled(const JobToken *token);
+
+// Block until every job submitted with token has finished or been skipped
+void job_token_wait(JobToken *token);
+
+#endif // JOBS_H
@@ -9,6 +9,15 @@
 // Static buffer for shortcut strings
 static char shortcut_buffer[64];
 
+// Key presses taken off raylib's queue this frame (main thread)
+static struct {
+    int keys[KEYBINDINGS_FRAME_KEYS];
+    int count;
+} g_frame_keys;
+
+_Static_assert(ACTION_COUNT <= UINT8_MAX, "Actions must fit the keymap's bytes");
+_Static_assert(MAX_KEYBINDINGS < UINT8_MAX, "Binding indices must fit by_action");
+
 // Action name lookup table
 static const char *action_names[] = {
     [ACTION_NONE] = "none",
@@ -25,6 +34,7 @@ static const char *action_names[] = {
     [ACTION_VIEW_LIST] = "view_list",
     [ACTION_VIEW_GRID] = "view_grid",
     [ACTION_VIEW_COLUMNS] = "view_columns",
+    [ACTION_VIEW_TREEMAP] = "view_treemap",
     [ACTION_TOGGLE_HIDDEN] = "toggle_hidden",
     [ACTION_TOGGLE_PREVIEW] = "toggle_preview",
     [ACTION_TOGGLE_SIDEBAR] = "toggle_sidebar",
@@ -66,6 +76,7 @@ static const struct {
     { ACTION_VIEW_LIST,      KEY_ONE,   MOD_SUPER },
     { ACTION_VIEW_GRID,      KEY_TWO,   MOD_SUPER },
     { ACTION_VIEW_COLUMNS,   KEY_THREE, MOD_SUPER },
+    { ACTION_VIEW_TREEMAP,   KEY_FOUR,  MOD_SUPER },
     { ACTION_TOGGLE_HIDDEN,  KEY_PERIOD, MOD_SUPER | MOD_SHIFT },
     { ACTION_TOGGLE_PREVIEW, KEY_P, MOD_SUPER | MOD_SHIFT },
     { ACTION_TOGGLE_SIDEBAR, KEY_S, MOD_SUPER | MOD_SHIFT },
@@ -91,6 +102,22 @@ static const struct {
 
 static const int default_bindings_count = sizeof(default_bindings) / sizeof(default_bindings[0]);
 
+// Rebuild the lookups from bindings; where two bindings share a combination the first
+// one wins, as it did when the list was searched in order
+static void keymap_compile(KeyBindingConfig *config)
+{
+    memset(config->keymap, 0, sizeof(config->keymap));
+    memset(config->by_action, 0, sizeof(config->by_action));
+    for (int i = config->count - 1; i >= 0; i--) {
+        const KeyBinding *binding = &config->bindings[i];
+        if (binding->key > 0 && binding->key < KEYBINDINGS_KEY_LIMIT &&
+            binding->modifiers >= 0 && binding->modifiers < KEYBINDINGS_MOD_COMBOS) {
+            config->keymap[binding->key][binding->modifiers] = (uint8_t)binding->action;
+        }
+        config->by_action[binding->action] = (uint8_t)(i + 1);
+    }
+}
+
 void keybindings_init(KeyBindingConfig *config)
 {
     memset(config, 0, sizeof(KeyBindingConfig));
@@ -117,6 +144,7 @@ void keybindings_reset_defaults(KeyBindingConfig *config)
         };
         config->bindings[config->count++] = binding;
     }
+    keymap_compile(config);
 }
 
 bool keybindings_load(KeyBindingConfig *config, const char *path)
@@ -219,6 +247,7 @@ bool keybindings_set(KeyBindingConfig *config, KeyAction action, int key, int mo
             config->bindings[i].modifiers = modifiers;
             config->bindings[i].is_default = false;
             config->modified = true;
+            keymap_compile(config);
             return true;
         }
     }
@@ -236,6 +265,7 @@ bool keybindings_set(KeyBindingConfig *config, KeyAction action, int key, int mo
     };
     config->bindings[config->count++] = binding;
     config->modified = true;
+    keymap_compile(config);
     return true;
 }
 
@@ -249,6 +279,7 @@ bool keybindings_remove(KeyBindingConfig *config, KeyAction action)
             }
             config->count--;
             config->modified = true;
+            keymap_compile(config);
             return true;
         }
     }
@@ -257,12 +288,36 @@ bool keybindings_remove(KeyBindingConfig *config, KeyAction action)
 
 const KeyBinding *keybindings_get(const KeyBindingConfig *config, KeyAction action)
 {
-    for (int i = 0; i < config->count; i++) {
-        if (config->bindings[i].action == action) {
-            return &config->bindings[i];
+    if (action < 0 || action >= ACTION_COUNT || config->by_action[action] == 0) {
+        return NULL;
+    }
+    return &config->bindings[config->by_action[action] - 1];
+}
+
+KeyAction keybindings_lookup(const KeyBindingConfig *config, int key, int modifiers)
+{
+    if (key <= 0 || key >= KEYBINDINGS_KEY_LIMIT || modifiers < 0 || modifiers >= KEYBINDINGS_MOD_COMBOS) {
+        return ACTION_NONE;
+    }
+    return (KeyAction)config->keymap[key][modifiers];
+}
+
+void keybindings_poll_keys(void)
+{
+    g_frame_keys.count = 0;
+    int key = GetKeyPressed();
+    while (key > 0) {
+        if (g_frame_keys.count < KEYBINDINGS_FRAME_KEYS) {
+            g_frame_keys.keys[g_frame_keys.count++] = key;
         }
+        key = GetKeyPressed();
     }
-    return NULL;
+}
+
+int keybindings_frame_keys(const int **keys)
+{
+    *keys = g_frame_keys.keys;
+    return g_frame_keys.count;
 }
 
 int keybindings_get_current_modifiers(void)
@@ -285,17 +340,18 @@ int keybindings_get_current_modifiers(void)
 
 KeyAction keybindings_check_pressed(const KeyBindingConfig *config)
 {
-    int current_mods = keybindings_get_current_modifiers();
-
-    for (int i = 0; i < config->count; i++) {
-        const KeyBinding *binding = &config->bindings[i];
+    if (g_frame_keys.count == 0) {
+        return ACTION_NONE;
+    }
 
-        // Check if key is pressed and modifiers match exactly
-        if (IsKeyPressed(binding->key) && binding->modifiers == current_mods) {
-            return binding->action;
+    // Modifiers must match exactly
+    int current_mods = keybindings_get_current_modifiers();
+    for (int i = 0; i < g_frame_keys.count; i++) {
+        KeyAction action = keybindings_lookup(config, g_frame_keys.keys[i], current_mods);
+        if (action != ACTION_NONE) {
+            return action;
         }
     }
-
     return ACTION_NONE;
 }
 
@@ -2,10 +2,19 @@
 #define KEYBINDINGS_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 // Maximum number of custom keybindings
 #define MAX_KEYBINDINGS 128
 
+// Keys the compiled keymap covers (raylib's KEY_* constants are all below this) and
+// modifier combinations per key
+#define KEYBINDINGS_KEY_LIMIT 349
+#define KEYBINDINGS_MOD_COMBOS 16
+
+// Key presses kept per frame (raylib queues at most this many between frames)
+#define KEYBINDINGS_FRAME_KEYS 16
+
 // Modifier flags
 typedef enum KeyModifier {
     MOD_NONE  = 0,
@@ -33,6 +42,7 @@ typedef enum KeyAction {
     ACTION_VIEW_LIST,
     ACTION_VIEW_GRID,
     ACTION_VIEW_COLUMNS,
+    ACTION_VIEW_TREEMAP,
     ACTION_TOGGLE_HIDDEN,
     ACTION_TOGGLE_PREVIEW,
     ACTION_TOGGLE_SIDEBAR,
@@ -65,11 +75,14 @@ typedef struct KeyBinding {
     bool is_default;   // Whether this is a default binding (vs user-set)
 } KeyBinding;
 
-// Keybinding configuration
+// Keybinding configuration. Every change recompiles the bindings into direct lookups,
+// so input handling never walks the list
 typedef struct KeyBindingConfig {
     KeyBinding bindings[MAX_KEYBINDINGS];
     int count;
     bool modified;     // Whether config has unsaved changes
+    uint8_t keymap[KEYBINDINGS_KEY_LIMIT][KEYBINDINGS_MOD_COMBOS];  // KeyAction of (key, modifiers)
+    uint8_t by_action[ACTION_COUNT];    // 1 + index of each action's binding (0: unbound)
 } KeyBindingConfig;
 
 // Initialize keybindings with defaults
@@ -96,7 +109,17 @@ bool keybindings_remove(KeyBindingConfig *config, KeyAction action);
 // Get keybinding for an action (returns NULL if not bound)
 const KeyBinding *keybindings_get(const KeyBindingConfig *config, KeyAction action);
 
-// Check if a key+modifier combo is pressed and matches an action
+// Action bound to key with exactly these modifiers (ACTION_NONE if none)
+KeyAction keybindings_lookup(const KeyBindingConfig *config, int key, int modifiers);
+
+// Take this frame's key presses off raylib's queue; call once per frame before input is
+// handled. GetKeyPressed finds the queue empty afterwards: read keybindings_frame_keys
+void keybindings_poll_keys(void);
+
+// Keys pressed this frame, in order; returns how many
+int keybindings_frame_keys(const int **keys);
+
+// Action of the first key pressed this frame that is bound with the modifiers held
 KeyAction keybindings_check_pressed(const KeyBindingConfig *config);
 
 // Check for conflicts (returns action that conflicts, or ACTION_NONE)
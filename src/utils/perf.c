@@ -1,12 +1,20 @@
 #include "perf.h"
 #include "../core/filesystem.h"
+#include "../core/fs_watch.h"
+#include "hash.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
 
-// Global memory stats
-MemoryStats g_memory_stats = {0};
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#define memory_block_size(ptr) malloc_size(ptr)
+#else
+#include <malloc.h>
+#define memory_block_size(ptr) malloc_usable_size(ptr)
+#endif
 
 //=============================================================================
 // Directory Cache Implementation
@@ -15,12 +23,29 @@ MemoryStats g_memory_stats = {0};
 void dir_cache_init(DirCache *cache)
 {
     memset(cache, 0, sizeof(DirCache));
+    pthread_mutex_init(&cache->pending_mutex, NULL);
+    cache->max_bytes = DIR_CACHE_DEFAULT_BUDGET;
     cache->enabled = true;
 }
 
 void dir_cache_free(DirCache *cache)
 {
+    // Unsubscribe first so no callback races the teardown
+    if (cache->watch_id > 0) {
+        fs_watch_unsubscribe(cache->watch, cache->watch_id);
+        cache->watch_id = 0;
+        cache->watch = NULL;
+    }
+
     dir_cache_clear(cache);
+
+    for (int i = 0; i < cache->pending_count; i++) {
+        free(cache->pending[i]);
+    }
+    free(cache->pending);
+    cache->pending = NULL;
+    cache->pending_count = 0;
+    pthread_mutex_destroy(&cache->pending_mutex);
 }
 
 static double get_time_seconds(void)
@@ -30,30 +55,70 @@ static double get_time_seconds(void)
     return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
-static int find_cache_entry(DirCache *cache, const char *path)
+static DirCacheEntry *find_cache_entry(DirCache *cache, const char *path, size_t len, uint32_t hash)
 {
-    for (int i = 0; i < cache->count; i++) {
-        if (cache->entries[i].valid && strcmp(cache->entries[i].path, path) == 0) {
-            return i;
+    DirCacheEntry *entry = cache->buckets[hash & (DIR_CACHE_BUCKETS - 1)];
+    while (entry) {
+        if (entry->hash == hash && strncmp(entry->path, path, len) == 0 && entry->path[len] == '\0') {
+            return entry;
         }
+        entry = entry->bucket_next;
     }
-    return -1;
+    return NULL;
 }
 
-static int find_oldest_entry(DirCache *cache)
+static void lru_unlink(DirCache *cache, DirCacheEntry *entry)
 {
-    if (cache->count == 0) return 0;  // Defensive check
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else cache->lru_head = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else cache->lru_tail = entry->lru_prev;
+    entry->lru_prev = entry->lru_next = NULL;
+}
 
-    int oldest = 0;
-    double oldest_time = cache->entries[0].timestamp;
+static void lru_push_front(DirCache *cache, DirCacheEntry *entry)
+{
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) cache->lru_head->lru_prev = entry;
+    cache->lru_head = entry;
+    if (!cache->lru_tail) cache->lru_tail = entry;
+}
 
-    for (int i = 1; i < cache->count; i++) {
-        if (cache->entries[i].timestamp < oldest_time) {
-            oldest = i;
-            oldest_time = cache->entries[i].timestamp;
-        }
+static void remove_cache_entry(DirCache *cache, DirCacheEntry *entry)
+{
+    DirCacheEntry **link = &cache->buckets[entry->hash & (DIR_CACHE_BUCKETS - 1)];
+    while (*link && *link != entry) {
+        link = &(*link)->bucket_next;
     }
-    return oldest;
+    if (*link) {
+        *link = entry->bucket_next;
+    }
+    lru_unlink(cache, entry);
+
+    cache->bytes -= entry->bytes;
+    cache->count--;
+    memory_track_directory_cache(-(long long)entry->bytes);
+
+    if (entry->directory) {
+        directory_state_free(entry->directory);
+        free(entry->directory);
+    }
+    free(entry->path);
+    free(entry);
+}
+
+// Helper: Evict least recently used listings until at most target bytes remain
+static void evict_to(DirCache *cache, size_t target)
+{
+    while (cache->bytes > target && cache->lru_tail) {
+        remove_cache_entry(cache, cache->lru_tail);
+    }
+}
+
+static void evict_over_budget(DirCache *cache)
+{
+    evict_to(cache, cache->max_bytes);
 }
 
 DirectoryState* dir_cache_get(DirCache *cache, const char *path)
@@ -62,26 +127,25 @@ DirectoryState* dir_cache_get(DirCache *cache, const char *path)
         return NULL;
     }
 
-    int idx = find_cache_entry(cache, path);
-    if (idx < 0) {
+    dir_cache_process_events(cache);
+
+    size_t len = strlen(path);
+    DirCacheEntry *entry = find_cache_entry(cache, path, len, hash_fnv1a_bytes(HASH_FNV1A_INIT, path, len));
+    if (!entry) {
         return NULL;
     }
 
-    DirCacheEntry *entry = &cache->entries[idx];
-
-    // Check if entry is stale
-    double now = get_time_seconds();
-    if (now - entry->timestamp > DIR_CACHE_MAX_AGE) {
-        // Invalidate stale entry
-        if (entry->directory) {
-            directory_state_free(entry->directory);
-            free(entry->directory);
-            entry->directory = NULL;
-        }
-        entry->valid = false;
+    if (cache->max_age > 0 && get_time_seconds() - entry->stored_at > cache->max_age) {
+        remove_cache_entry(cache, entry);
         return NULL;
     }
 
+    // Mark as most recently used
+    if (entry != cache->lru_head) {
+        lru_unlink(cache, entry);
+        lru_push_front(cache, entry);
+    }
+
     return entry->directory;
 }
 
@@ -91,94 +155,194 @@ void dir_cache_put(DirCache *cache, const char *path, const DirectoryState *dir)
         return;
     }
 
-    // Check if already cached
-    int idx = find_cache_entry(cache, path);
+    dir_cache_process_events(cache);
 
-    if (idx < 0) {
-        // Find slot for new entry
-        if (cache->count < DIR_CACHE_MAX_ENTRIES) {
-            idx = cache->count;
-            cache->count++;
-        } else {
-            // Evict oldest entry
-            idx = find_oldest_entry(cache);
-            if (cache->entries[idx].directory) {
-                directory_state_free(cache->entries[idx].directory);
-                free(cache->entries[idx].directory);
-            }
-        }
-    } else {
-        // Update existing entry
-        if (cache->entries[idx].directory) {
-            directory_state_free(cache->entries[idx].directory);
-            free(cache->entries[idx].directory);
-        }
+    size_t len = strlen(path);
+    uint32_t hash = hash_fnv1a_bytes(HASH_FNV1A_INIT, path, len);
+
+    // Replace any existing entry for this path
+    DirCacheEntry *existing = find_cache_entry(cache, path, len, hash);
+    if (existing) {
+        remove_cache_entry(cache, existing);
     }
 
-    DirCacheEntry *entry = &cache->entries[idx];
-    strncpy(entry->path, path, sizeof(entry->path) - 1);
-    entry->path[sizeof(entry->path) - 1] = '\0';
+    DirCacheEntry *entry = calloc(1, sizeof(DirCacheEntry));
+    if (!entry) {
+        return;
+    }
+    entry->path = strdup(path);
+    entry->directory = malloc(sizeof(DirectoryState));
+    if (!entry->path || !entry->directory) {
+        free(entry->path);
+        free(entry->directory);
+        free(entry);
+        return;
+    }
 
     // Deep copy the directory state
-    entry->directory = malloc(sizeof(DirectoryState));
-    if (entry->directory) {
-        directory_state_init(entry->directory);
-        strncpy(entry->directory->current_path, dir->current_path, PATH_MAX_LEN - 1);
-        entry->directory->show_hidden = dir->show_hidden;
-        entry->directory->is_loading = false;
-
-        if (dir->count > 0 && dir->entries) {
-            entry->directory->entries = malloc(dir->count * sizeof(FileEntry));
-            if (entry->directory->entries) {
-                memcpy(entry->directory->entries, dir->entries, dir->count * sizeof(FileEntry));
-                entry->directory->count = dir->count;
-                entry->directory->capacity = dir->count;
-            }
-        }
+    directory_state_copy(entry->directory, dir);
+    entry->hash = hash;
+    entry->stored_at = get_time_seconds();
+    entry->bytes = sizeof(DirCacheEntry) + len + 1 + sizeof(DirectoryState) +
+                   directory_state_bytes(entry->directory);
+
+    size_t bucket = hash & (DIR_CACHE_BUCKETS - 1);
+    entry->bucket_next = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+    lru_push_front(cache, entry);
+
+    cache->count++;
+    cache->bytes += entry->bytes;
+    memory_track_directory_cache((long long)entry->bytes);
+
+    // A listing larger than the whole budget evicts itself last
+    evict_over_budget(cache);
+}
 
-        g_memory_stats.directory_cache_bytes += sizeof(DirectoryState) + dir->count * sizeof(FileEntry);
-    }
+void dir_cache_set_budget(DirCache *cache, size_t max_bytes)
+{
+    cache->max_bytes = max_bytes;
+    evict_over_budget(cache);
+}
+
+void dir_cache_trim(DirCache *cache, size_t target)
+{
+    evict_to(cache, target);
+}
 
-    entry->timestamp = get_time_seconds();
-    entry->valid = true;
+void dir_cache_set_max_age(DirCache *cache, double seconds)
+{
+    cache->max_age = seconds;
 }
 
 void dir_cache_invalidate(DirCache *cache, const char *path)
 {
     size_t path_len = strlen(path);
+    bool is_root = path_len == 1 && path[0] == '/';
 
-    for (int i = 0; i < cache->count; i++) {
-        DirCacheEntry *entry = &cache->entries[i];
-        if (!entry->valid) continue;
+    DirCacheEntry *entry = cache->lru_head;
+    while (entry) {
+        DirCacheEntry *next = entry->lru_next;
 
         // Invalidate if exact match or child path
-        if (strcmp(entry->path, path) == 0 ||
+        if (is_root || strcmp(entry->path, path) == 0 ||
             (strncmp(entry->path, path, path_len) == 0 && entry->path[path_len] == '/')) {
-            if (entry->directory) {
-                size_t freed = sizeof(DirectoryState) + entry->directory->count * sizeof(FileEntry);
-                g_memory_stats.directory_cache_bytes -= freed;
+            remove_cache_entry(cache, entry);
+        }
+        entry = next;
+    }
+}
+
+void dir_cache_clear(DirCache *cache)
+{
+    while (cache->lru_head) {
+        remove_cache_entry(cache, cache->lru_head);
+    }
+    cache->count = 0;
+    cache->bytes = 0;
+}
+
+void dir_cache_notify(DirCache *cache, const char *path)
+{
+    pthread_mutex_lock(&cache->pending_mutex);
+
+    if (!cache->pending_overflow) {
+        if (!cache->pending) {
+            cache->pending = malloc(DIR_CACHE_MAX_PENDING * sizeof(char *));
+        }
+        char *copy = cache->pending && cache->pending_count < DIR_CACHE_MAX_PENDING
+                     ? strdup(path) : NULL;
+        if (copy) {
+            cache->pending[cache->pending_count++] = copy;
+        } else {
+            // Too many changes to track individually: drop everything
+            cache->pending_overflow = true;
+        }
+    }
 
-                directory_state_free(entry->directory);
-                free(entry->directory);
-                entry->directory = NULL;
+    pthread_mutex_unlock(&cache->pending_mutex);
+}
+
+void dir_cache_process_events(DirCache *cache)
+{
+    pthread_mutex_lock(&cache->pending_mutex);
+    char **pending = cache->pending;
+    int pending_count = cache->pending_count;
+    bool overflow = cache->pending_overflow;
+    cache->pending = NULL;
+    cache->pending_count = 0;
+    cache->pending_overflow = false;
+    pthread_mutex_unlock(&cache->pending_mutex);
+
+    if (overflow) {
+        dir_cache_clear(cache);
+    }
+
+    for (int i = 0; i < pending_count; i++) {
+        char *path = pending[i];
+        if (cache->count > 0) {
+            // The path itself (if it was a directory) and anything under it
+            dir_cache_invalidate(cache, path);
+
+            // The listing that contains it
+            char *slash = strrchr(path, '/');
+            if (slash) {
+                size_t parent_len = slash == path ? 1 : (size_t)(slash - path);
+                DirCacheEntry *parent = find_cache_entry(cache, path, parent_len,
+                                                         hash_fnv1a_bytes(HASH_FNV1A_INIT, path, parent_len));
+                if (parent) {
+                    remove_cache_entry(cache, parent);
+                }
             }
-            entry->valid = false;
         }
+        free(path);
     }
+    free(pending);
 }
 
-void dir_cache_clear(DirCache *cache)
+void dir_cache_notify_all(DirCache *cache)
+{
+    pthread_mutex_lock(&cache->pending_mutex);
+    cache->pending_overflow = true;
+    pthread_mutex_unlock(&cache->pending_mutex);
+}
+
+static void dir_cache_watch_batch(const FsWatchBatch *batch, void *user_data)
 {
-    for (int i = 0; i < cache->count; i++) {
-        if (cache->entries[i].directory) {
-            directory_state_free(cache->entries[i].directory);
-            free(cache->entries[i].directory);
-            cache->entries[i].directory = NULL;
+    DirCache *cache = (DirCache *)user_data;
+
+    if (batch->dirs_overflow) {
+        dir_cache_notify_all(cache);
+    } else if (batch->changes_overflow) {
+        // A changed directory invalidates the listings under it as well
+        for (int i = 0; i < batch->dir_count; i++) {
+            dir_cache_notify(cache, batch->dirs[i]);
+        }
+    } else {
+        for (int i = 0; i < batch->change_count; i++) {
+            dir_cache_notify(cache, batch->changes[i].path);
         }
-        cache->entries[i].valid = false;
     }
-    cache->count = 0;
-    g_memory_stats.directory_cache_bytes = 0;
+}
+
+bool dir_cache_watch(DirCache *cache, struct FsWatch *watch)
+{
+    if (cache->watch_id > 0) {
+        return true;
+    }
+    if (!watch) {
+        return false;
+    }
+
+    // Listings can be cached from anywhere, so take the whole tree; events
+    // for uncached folders cost one queued string each
+    cache->watch_id = fs_watch_subscribe(watch, "/", true, dir_cache_watch_batch, cache);
+    if (cache->watch_id < 0) {
+        cache->watch_id = 0;
+        return false;
+    }
+    cache->watch = watch;
+    return true;
 }
 
 void dir_cache_set_enabled(DirCache *cache, bool enabled)
@@ -292,217 +456,798 @@ void dirty_set_enabled(DirtyRectTracker *tracker, bool enabled)
 void lazy_init(LazyLoadQueue *queue)
 {
     memset(queue, 0, sizeof(LazyLoadQueue));
+    for (int i = 0; i < LAZY_BUCKETS; i++) {
+        queue->buckets[i] = -1;
+    }
+    for (int i = 0; i < LAZY_QUEUE_MAX; i++) {
+        queue->free_slots[i] = LAZY_QUEUE_MAX - 1 - i;
+    }
+    queue->free_count = LAZY_QUEUE_MAX;
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->work, NULL);
     queue->enabled = true;
 }
 
+// Helper: Free a task's result and return its slot (call with mutex held)
+static void lazy_release(LazyLoadQueue *queue, int slot)
+{
+    LazyTask *task = &queue->tasks[slot];
+    if (task->result) {
+        const LazyLoader *loader = &queue->loaders[task->type];
+        if (loader->free_result) {
+            loader->free_result(task->type, task->result, loader->context);
+        } else {
+            free(task->result);
+        }
+    }
+    free(task->path);
+    memset(task, 0, sizeof(*task));
+    task->heap_index = -1;
+    queue->free_slots[queue->free_count++] = slot;
+}
+
 void lazy_free(LazyLoadQueue *queue)
 {
-    lazy_cancel_all(queue);
+    pthread_mutex_lock(&queue->mutex);
+    queue->stopping = true;
+    pthread_cond_broadcast(&queue->work);
+    pthread_mutex_unlock(&queue->mutex);
+    for (int i = 0; i < queue->worker_count; i++) {
+        pthread_join(queue->workers[i], NULL);
+    }
+    queue->worker_count = 0;
+
+    for (int i = 0; i < LAZY_QUEUE_MAX; i++) {
+        if (queue->tasks[i].path) {
+            lazy_release(queue, i);
+        }
+    }
+    queue->count = 0;
+    queue->heap_count = 0;
+    pthread_cond_destroy(&queue->work);
+    pthread_mutex_destroy(&queue->mutex);
+}
+
+static uint32_t lazy_hash(LazyTaskType type, const char *path)
+{
+    return hash_fnv1a_bytes(HASH_FNV1A_INIT, path, strlen(path)) ^ ((uint32_t)type * 0x9e3779b9u);
+}
+
+// Helper: Whether task a should run before task b
+static bool lazy_before(const LazyLoadQueue *queue, int a, int b)
+{
+    const LazyTask *ta = &queue->tasks[a];
+    const LazyTask *tb = &queue->tasks[b];
+    if (ta->priority != tb->priority) {
+        return ta->priority > tb->priority;  // Higher priority first
+    }
+    return ta->sequence < tb->sequence;
+}
+
+static void heap_swap(LazyLoadQueue *queue, int i, int j)
+{
+    int slot = queue->heap[i];
+    queue->heap[i] = queue->heap[j];
+    queue->heap[j] = slot;
+    queue->tasks[queue->heap[i]].heap_index = i;
+    queue->tasks[queue->heap[j]].heap_index = j;
+}
+
+static void heap_sift_up(LazyLoadQueue *queue, int i)
+{
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!lazy_before(queue, queue->heap[i], queue->heap[parent])) break;
+        heap_swap(queue, i, parent);
+        i = parent;
+    }
+}
+
+static void heap_sift_down(LazyLoadQueue *queue, int i)
+{
+    for (;;) {
+        int first = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < queue->heap_count && lazy_before(queue, queue->heap[left], queue->heap[first])) {
+            first = left;
+        }
+        if (right < queue->heap_count && lazy_before(queue, queue->heap[right], queue->heap[first])) {
+            first = right;
+        }
+        if (first == i) break;
+        heap_swap(queue, i, first);
+        i = first;
+    }
+}
+
+static void heap_push(LazyLoadQueue *queue, int slot)
+{
+    int i = queue->heap_count++;
+    queue->heap[i] = slot;
+    queue->tasks[slot].heap_index = i;
+    heap_sift_up(queue, i);
+}
+
+static void heap_remove(LazyLoadQueue *queue, int slot)
+{
+    int i = queue->tasks[slot].heap_index;
+    if (i < 0) return;
+    int last = --queue->heap_count;
+    if (i != last) {
+        heap_swap(queue, i, last);
+        int moved = queue->heap[i];
+        heap_sift_up(queue, i);
+        heap_sift_down(queue, queue->tasks[moved].heap_index);
+    }
+    queue->tasks[slot].heap_index = -1;
+}
+
+// Helper: Find a task (call with mutex held); -1 if absent
+static int lazy_find(LazyLoadQueue *queue, LazyTaskType type, const char *path, uint32_t hash)
+{
+    for (int i = queue->buckets[hash & (LAZY_BUCKETS - 1)]; i >= 0; i = queue->tasks[i].next) {
+        LazyTask *task = &queue->tasks[i];
+        if (task->hash == hash && task->type == type && strcmp(task->path, path) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Helper: Take a task out of the lookup table and the heap (call with mutex held)
+static void lazy_unlink(LazyLoadQueue *queue, int slot)
+{
+    LazyTask *task = &queue->tasks[slot];
+    int *link = &queue->buckets[task->hash & (LAZY_BUCKETS - 1)];
+    while (*link >= 0 && *link != slot) {
+        link = &queue->tasks[*link].next;
+    }
+    if (*link == slot) {
+        *link = task->next;
+    }
+    task->next = -1;
+    heap_remove(queue, slot);
+    queue->count--;
 }
 
-static int compare_priority(const void *a, const void *b)
+// Helper: Drop a task; one a worker holds is freed when the worker returns (call with
+// mutex held)
+static void lazy_drop(LazyLoadQueue *queue, int slot)
 {
-    const LazyTask *ta = (const LazyTask *)a;
-    const LazyTask *tb = (const LazyTask *)b;
-    return tb->priority - ta->priority;  // Higher priority first
+    LazyTask *task = &queue->tasks[slot];
+    lazy_unlink(queue, slot);
+    if (task->status == LAZY_STATUS_IN_PROGRESS) {
+        task->cancelled = true;
+        return;
+    }
+    if (task->status == LAZY_STATUS_LOADED) {
+        queue->loaded--;
+    }
+    lazy_release(queue, slot);
+}
+
+// Helper: Make room by dropping the oldest finished result, else the least urgent
+// pending task if it is less urgent than priority (call with mutex held)
+static bool lazy_evict(LazyLoadQueue *queue, int priority)
+{
+    int oldest = -1;
+    for (int i = 0; i < LAZY_QUEUE_MAX; i++) {
+        LazyTask *task = &queue->tasks[i];
+        if (!task->path || task->cancelled || task->generation != queue->generation) continue;
+        if (task->status != LAZY_STATUS_COMPLETE && task->status != LAZY_STATUS_ERROR) continue;
+        if (oldest < 0 || task->finish_time < queue->tasks[oldest].finish_time) {
+            oldest = i;
+        }
+    }
+    if (oldest < 0 && queue->heap_count > 0) {
+        // The least urgent task is a leaf of the heap
+        int least = queue->heap[queue->heap_count / 2];
+        for (int i = queue->heap_count / 2 + 1; i < queue->heap_count; i++) {
+            if (lazy_before(queue, least, queue->heap[i])) {
+                least = queue->heap[i];
+            }
+        }
+        if (queue->tasks[least].priority < priority) {
+            oldest = least;
+        }
+    }
+    if (oldest < 0) return false;
+    lazy_drop(queue, oldest);
+    return true;
+}
+
+// Helper: Record a task's result; a cancelled or stale one is freed (call with mutex held)
+static void lazy_finish(LazyLoadQueue *queue, int slot, void *result, bool loaded)
+{
+    LazyTask *task = &queue->tasks[slot];
+    task->result = result;
+    task->finish_time = get_time_seconds();
+    if (task->cancelled || task->generation != queue->generation) {
+        lazy_release(queue, slot);
+        return;
+    }
+    if (!loaded) {
+        task->status = LAZY_STATUS_COMPLETE;
+    } else if (!result) {
+        task->status = LAZY_STATUS_ERROR;
+    } else if (queue->loaders[task->type].complete) {
+        task->status = LAZY_STATUS_LOADED;
+        queue->loaded++;
+    } else {
+        task->status = LAZY_STATUS_COMPLETE;
+    }
+}
+
+// Helper: Take the most urgent pending task and load it, unlocking meanwhile (call with
+// mutex held)
+static void lazy_run_next(LazyLoadQueue *queue)
+{
+    int slot = queue->heap[0];
+    heap_remove(queue, slot);
+
+    LazyTask *task = &queue->tasks[slot];
+    task->status = LAZY_STATUS_IN_PROGRESS;
+    task->start_time = get_time_seconds();
+    queue->processing++;
+
+    // The slot stays put while the task is in progress, even if cancelled
+    LazyLoader loader = queue->loaders[task->type];
+    LazyTaskType type = task->type;
+    const char *path = task->path;
+    void *result = NULL;
+    if (loader.load) {
+        pthread_mutex_unlock(&queue->mutex);
+        result = loader.load(type, path, loader.context);
+        pthread_mutex_lock(&queue->mutex);
+    }
+
+    queue->processing--;
+    lazy_finish(queue, slot, result, loader.load != NULL);
+}
+
+// Thread function: Load pending tasks, most urgent first
+static void *lazy_worker(void *arg)
+{
+    LazyLoadQueue *queue = (LazyLoadQueue *)arg;
+
+    pthread_mutex_lock(&queue->mutex);
+    while (!queue->stopping) {
+        if (queue->heap_count == 0 || !queue->enabled) {
+            pthread_cond_wait(&queue->work, &queue->mutex);
+            continue;
+        }
+        lazy_run_next(queue);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return NULL;
+}
+
+void lazy_set_loader(LazyLoadQueue *queue, LazyTaskType type, const LazyLoader *loader)
+{
+    if ((int)type < 0 || type >= LAZY_TASK_TYPES) return;
+
+    pthread_mutex_lock(&queue->mutex);
+    if (loader) {
+        queue->loaders[type] = *loader;
+    } else {
+        memset(&queue->loaders[type], 0, sizeof(LazyLoader));
+    }
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+int lazy_start_workers(LazyLoadQueue *queue, int count)
+{
+    if (count > LAZY_MAX_WORKERS) count = LAZY_MAX_WORKERS;
+
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->worker_count < count &&
+           pthread_create(&queue->workers[queue->worker_count], NULL, lazy_worker, queue) == 0) {
+        queue->worker_count++;
+    }
+    int running = queue->worker_count;
+    pthread_mutex_unlock(&queue->mutex);
+    return running;
 }
 
 int lazy_enqueue(LazyLoadQueue *queue, LazyTaskType type, const char *path, int priority)
 {
-    if (!queue->enabled) {
+    if (!queue->enabled || !path) {
         return -1;
     }
 
-    // Check if already in queue
-    for (int i = 0; i < queue->count; i++) {
-        if (queue->tasks[i].type == type && strcmp(queue->tasks[i].path, path) == 0) {
-            // Update priority if higher
-            if (priority > queue->tasks[i].priority) {
-                queue->tasks[i].priority = priority;
-                qsort(queue->tasks, queue->count, sizeof(LazyTask), compare_priority);
+    uint32_t hash = lazy_hash(type, path);
+    pthread_mutex_lock(&queue->mutex);
+
+    // Already queued: follow the caller's latest priority
+    int slot = lazy_find(queue, type, path, hash);
+    if (slot >= 0) {
+        LazyTask *task = &queue->tasks[slot];
+        if (task->priority != priority) {
+            task->priority = priority;
+            if (task->heap_index >= 0) {
+                heap_sift_up(queue, task->heap_index);
+                heap_sift_down(queue, task->heap_index);
             }
-            return i;
         }
+        pthread_mutex_unlock(&queue->mutex);
+        return slot;
     }
 
-    if (queue->count >= LAZY_QUEUE_MAX) {
-        // Remove lowest priority task
-        queue->count--;
-        if (queue->tasks[queue->count].result) {
-            free(queue->tasks[queue->count].result);
-        }
+    char *copy = strdup(path);
+    if (!copy || (queue->free_count == 0 && !lazy_evict(queue, priority))) {
+        pthread_mutex_unlock(&queue->mutex);
+        free(copy);
+        return -1;
     }
 
-    LazyTask *task = &queue->tasks[queue->count];
+    slot = queue->free_slots[--queue->free_count];
+    LazyTask *task = &queue->tasks[slot];
     task->type = type;
     task->status = LAZY_STATUS_PENDING;
-    strncpy(task->path, path, sizeof(task->path) - 1);
-    task->path[sizeof(task->path) - 1] = '\0';
+    task->path = copy;
+    task->hash = hash;
     task->priority = priority;
+    task->sequence = ++queue->sequence;
+    task->generation = queue->generation;
+    task->cancelled = false;
     task->result = NULL;
     task->start_time = 0;
 
+    int *bucket = &queue->buckets[hash & (LAZY_BUCKETS - 1)];
+    task->next = *bucket;
+    *bucket = slot;
+    heap_push(queue, slot);
     queue->count++;
-    qsort(queue->tasks, queue->count, sizeof(LazyTask), compare_priority);
 
-    return queue->count - 1;
+    pthread_cond_signal(&queue->work);
+    pthread_mutex_unlock(&queue->mutex);
+    return slot;
 }
 
 void lazy_cancel(LazyLoadQueue *queue, const char *path)
 {
-    for (int i = 0; i < queue->count; i++) {
-        if (strcmp(queue->tasks[i].path, path) == 0) {
-            if (queue->tasks[i].result) {
-                free(queue->tasks[i].result);
-            }
-            // Move remaining tasks
-            memmove(&queue->tasks[i], &queue->tasks[i + 1],
-                    (queue->count - i - 1) * sizeof(LazyTask));
-            queue->count--;
-            i--;  // Check same index again
+    if (!path) return;
+
+    pthread_mutex_lock(&queue->mutex);
+    for (int type = 0; type < LAZY_TASK_TYPES; type++) {
+        int slot = lazy_find(queue, (LazyTaskType)type, path, lazy_hash((LazyTaskType)type, path));
+        if (slot >= 0) {
+            lazy_drop(queue, slot);
         }
     }
+    pthread_mutex_unlock(&queue->mutex);
 }
 
 void lazy_cancel_all(LazyLoadQueue *queue)
 {
-    for (int i = 0; i < queue->count; i++) {
-        if (queue->tasks[i].result) {
-            free(queue->tasks[i].result);
-            queue->tasks[i].result = NULL;
+    pthread_mutex_lock(&queue->mutex);
+
+    // Tasks in progress belong to the old generation and are freed when they return
+    queue->generation++;
+    for (int i = 0; i < LAZY_QUEUE_MAX; i++) {
+        LazyTask *task = &queue->tasks[i];
+        if (task->path && task->status != LAZY_STATUS_IN_PROGRESS) {
+            lazy_release(queue, i);
         }
     }
+    for (int i = 0; i < LAZY_BUCKETS; i++) {
+        queue->buckets[i] = -1;
+    }
+    queue->heap_count = 0;
     queue->count = 0;
-    queue->processing = 0;
+    queue->loaded = 0;
+    pthread_mutex_unlock(&queue->mutex);
 }
 
 bool lazy_process_one(LazyLoadQueue *queue)
 {
-    if (!queue->enabled || queue->count == 0) {
+    if (!queue->enabled) {
         return false;
     }
 
-    // Find first pending task
-    for (int i = 0; i < queue->count; i++) {
-        LazyTask *task = &queue->tasks[i];
-        if (task->status == LAZY_STATUS_PENDING) {
-            task->status = LAZY_STATUS_IN_PROGRESS;
-            task->start_time = get_time_seconds();
-            queue->processing++;
-
-            // Process based on type
-            switch (task->type) {
-                case LAZY_TASK_THUMBNAIL:
-                    // Placeholder: In real implementation, load and resize image
-                    task->result = NULL;
-                    task->status = LAZY_STATUS_COMPLETE;
-                    break;
-
-                case LAZY_TASK_FILE_INFO:
-                    // Placeholder: Get extended file info
-                    task->result = NULL;
-                    task->status = LAZY_STATUS_COMPLETE;
-                    break;
-
-                case LAZY_TASK_PREVIEW:
-                    // Placeholder: Generate preview
-                    task->result = NULL;
-                    task->status = LAZY_STATUS_COMPLETE;
-                    break;
-            }
-
-            queue->processing--;
-            return true;
-        }
+    pthread_mutex_lock(&queue->mutex);
+    bool processed = queue->heap_count > 0;
+    if (processed) {
+        lazy_run_next(queue);
     }
+    pthread_mutex_unlock(&queue->mutex);
+    return processed;
+}
 
-    return false;
+int lazy_poll(LazyLoadQueue *queue, int max)
+{
+    int delivered = 0;
+
+    pthread_mutex_lock(&queue->mutex);
+    for (int i = 0; i < LAZY_QUEUE_MAX && queue->loaded > 0 && delivered < max; i++) {
+        LazyTask *task = &queue->tasks[i];
+        if (!task->path || task->status != LAZY_STATUS_LOADED) continue;
+
+        // Workers leave loaded tasks alone, and only this thread cancels them
+        LazyLoader loader = queue->loaders[task->type];
+        void *loaded = task->result;
+        task->result = NULL;
+        queue->loaded--;
+        pthread_mutex_unlock(&queue->mutex);
+        void *result = loader.complete(task->type, task->path, loaded, loader.context);
+        pthread_mutex_lock(&queue->mutex);
+
+        task->result = result;
+        task->status = result ? LAZY_STATUS_COMPLETE : LAZY_STATUS_ERROR;
+        delivered++;
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return delivered;
 }
 
 void* lazy_get_result(LazyLoadQueue *queue, const char *path, LazyTaskType type)
 {
-    for (int i = 0; i < queue->count; i++) {
-        LazyTask *task = &queue->tasks[i];
-        if (task->type == type && strcmp(task->path, path) == 0) {
-            if (task->status == LAZY_STATUS_COMPLETE) {
-                return task->result;
-            }
-            break;
-        }
+    if (!path) return NULL;
+
+    void *result = NULL;
+    pthread_mutex_lock(&queue->mutex);
+    int slot = lazy_find(queue, type, path, lazy_hash(type, path));
+    if (slot >= 0 && queue->tasks[slot].status == LAZY_STATUS_COMPLETE) {
+        result = queue->tasks[slot].result;
     }
-    return NULL;
+    pthread_mutex_unlock(&queue->mutex);
+    return result;
 }
 
 bool lazy_is_complete(LazyLoadQueue *queue, const char *path, LazyTaskType type)
 {
-    for (int i = 0; i < queue->count; i++) {
-        LazyTask *task = &queue->tasks[i];
-        if (task->type == type && strcmp(task->path, path) == 0) {
-            return task->status == LAZY_STATUS_COMPLETE;
-        }
-    }
-    return false;
+    if (!path) return false;
+
+    pthread_mutex_lock(&queue->mutex);
+    int slot = lazy_find(queue, type, path, lazy_hash(type, path));
+    bool complete = slot >= 0 && queue->tasks[slot].status == LAZY_STATUS_COMPLETE;
+    pthread_mutex_unlock(&queue->mutex);
+    return complete;
 }
 
 //=============================================================================
 // Memory Profiling Implementation
 //=============================================================================
 
-static bool profiling_active = false;
+static atomic_size_t g_tag_bytes[MEMORY_TAG_COUNT];
+static atomic_size_t g_tag_peak[MEMORY_TAG_COUNT];
+static atomic_size_t g_total_bytes;
+static atomic_size_t g_total_peak;
+static atomic_size_t g_allocation_count;
+static atomic_size_t g_free_count;
+static atomic_size_t g_directory_cache_bytes;
+
+static const char *g_tag_names[MEMORY_TAG_COUNT] = {
+    [MEMORY_TAG_DIRECTORY] = "dir",
+    [MEMORY_TAG_CACHE] = "cache",
+    [MEMORY_TAG_PREVIEW] = "preview",
+    [MEMORY_TAG_AI] = "ai",
+    [MEMORY_TAG_NETWORK] = "net",
+    [MEMORY_TAG_ARENA] = "arena",
+    [MEMORY_TAG_OTHER] = "other",
+};
+
+// Helper: Raise peak to value if it is lower
+static void memory_raise_peak(atomic_size_t *peak, size_t value)
+{
+    size_t seen = atomic_load_explicit(peak, memory_order_relaxed);
+    while (seen < value &&
+           !atomic_compare_exchange_weak_explicit(peak, &seen, value, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
 
-void memory_profile_start(void)
+// Helper: Charge size bytes to tag
+static void memory_charge(MemoryTag tag, size_t size)
+{
+    size_t bytes = atomic_fetch_add_explicit(&g_tag_bytes[tag], size, memory_order_relaxed) + size;
+    size_t total = atomic_fetch_add_explicit(&g_total_bytes, size, memory_order_relaxed) + size;
+    atomic_fetch_add_explicit(&g_allocation_count, 1, memory_order_relaxed);
+    memory_raise_peak(&g_tag_peak[tag], bytes);
+    memory_raise_peak(&g_total_peak, total);
+}
+
+// Helper: Credit size bytes back to tag
+static void memory_credit(MemoryTag tag, size_t size)
+{
+    atomic_fetch_sub_explicit(&g_tag_bytes[tag], size, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&g_total_bytes, size, memory_order_relaxed);
+    atomic_fetch_add_explicit(&g_free_count, 1, memory_order_relaxed);
+}
+
+void *memory_alloc(MemoryTag tag, size_t size)
+{
+    void *ptr = malloc(size);
+    if (ptr) {
+        memory_charge(tag, memory_block_size(ptr));
+    }
+    return ptr;
+}
+
+void *memory_calloc(MemoryTag tag, size_t count, size_t size)
+{
+    void *ptr = calloc(count, size);
+    if (ptr) {
+        memory_charge(tag, memory_block_size(ptr));
+    }
+    return ptr;
+}
+
+void *memory_realloc(MemoryTag tag, void *ptr, size_t size)
+{
+    size_t old_size = ptr ? memory_block_size(ptr) : 0;
+    void *grown = realloc(ptr, size);
+    if (!grown) {
+        return NULL;  // ptr is untouched and still charged
+    }
+    if (ptr) {
+        memory_credit(tag, old_size);
+    }
+    memory_charge(tag, memory_block_size(grown));
+    return grown;
+}
+
+void *memory_aligned_alloc(MemoryTag tag, size_t alignment, size_t size)
+{
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, alignment, size) != 0) {
+        return NULL;
+    }
+    memory_charge(tag, memory_block_size(ptr));
+    return ptr;
+}
+
+char *memory_strdup(MemoryTag tag, const char *text)
 {
-    profiling_active = true;
-    memset(&g_memory_stats, 0, sizeof(g_memory_stats));
+    size_t len = strlen(text) + 1;
+    char *copy = memory_alloc(tag, len);
+    if (copy) {
+        memcpy(copy, text, len);
+    }
+    return copy;
 }
 
-void memory_profile_stop(void)
+void memory_free(MemoryTag tag, void *ptr)
+{
+    if (!ptr) return;
+    memory_credit(tag, memory_block_size(ptr));
+    free(ptr);
+}
+
+size_t memory_tag_bytes(MemoryTag tag)
+{
+    return atomic_load_explicit(&g_tag_bytes[tag], memory_order_relaxed);
+}
+
+const char *memory_tag_name(MemoryTag tag)
+{
+    return tag >= 0 && tag < MEMORY_TAG_COUNT ? g_tag_names[tag] : "?";
+}
+
+void memory_profile_start(void)
 {
-    profiling_active = false;
+    for (int t = 0; t < MEMORY_TAG_COUNT; t++) {
+        atomic_store(&g_tag_peak[t], atomic_load(&g_tag_bytes[t]));
+    }
+    atomic_store(&g_total_peak, atomic_load(&g_total_bytes));
+    atomic_store(&g_allocation_count, 0);
+    atomic_store(&g_free_count, 0);
 }
 
 void memory_profile_snapshot(MemoryStats *stats)
 {
-    memcpy(stats, &g_memory_stats, sizeof(MemoryStats));
+    memset(stats, 0, sizeof(MemoryStats));
+    for (int t = 0; t < MEMORY_TAG_COUNT; t++) {
+        stats->tag_bytes[t] = atomic_load_explicit(&g_tag_bytes[t], memory_order_relaxed);
+        stats->tag_peak[t] = atomic_load_explicit(&g_tag_peak[t], memory_order_relaxed);
+    }
+    stats->total_allocated = atomic_load_explicit(&g_total_bytes, memory_order_relaxed);
+    stats->peak_allocated = atomic_load_explicit(&g_total_peak, memory_order_relaxed);
+    stats->allocation_count = atomic_load_explicit(&g_allocation_count, memory_order_relaxed);
+    stats->free_count = atomic_load_explicit(&g_free_count, memory_order_relaxed);
+    stats->directory_cache_bytes = atomic_load_explicit(&g_directory_cache_bytes, memory_order_relaxed);
 }
 
 void memory_profile_print(void)
 {
+    MemoryStats stats;
+    memory_profile_snapshot(&stats);
+
     printf("=== Memory Profile ===\n");
     printf("Total allocated: %zu bytes (%.2f MB)\n",
-           g_memory_stats.total_allocated,
-           g_memory_stats.total_allocated / (1024.0 * 1024.0));
+           stats.total_allocated,
+           stats.total_allocated / (1024.0 * 1024.0));
     printf("Peak allocated: %zu bytes (%.2f MB)\n",
-           g_memory_stats.peak_allocated,
-           g_memory_stats.peak_allocated / (1024.0 * 1024.0));
+           stats.peak_allocated,
+           stats.peak_allocated / (1024.0 * 1024.0));
     printf("Allocations: %zu, Frees: %zu\n",
-           g_memory_stats.allocation_count,
-           g_memory_stats.free_count);
-    printf("Directory cache: %zu bytes\n", g_memory_stats.directory_cache_bytes);
-    printf("Thumbnail cache: %zu bytes\n", g_memory_stats.thumbnail_cache_bytes);
-    printf("Preview: %zu bytes\n", g_memory_stats.preview_bytes);
+           stats.allocation_count,
+           stats.free_count);
+    for (int t = 0; t < MEMORY_TAG_COUNT; t++) {
+        printf("%-8s %zu bytes (peak %zu)\n", memory_tag_name((MemoryTag)t),
+               stats.tag_bytes[t], stats.tag_peak[t]);
+    }
+    printf("Directory cache: %zu bytes\n", stats.directory_cache_bytes);
 }
 
 void memory_track_alloc(size_t size)
 {
-    if (!profiling_active) return;
+    memory_charge(MEMORY_TAG_OTHER, size);
+}
 
-    g_memory_stats.total_allocated += size;
-    g_memory_stats.allocation_count++;
+void memory_track_free(size_t size)
+{
+    memory_credit(MEMORY_TAG_OTHER, size);
+}
+
+void memory_track_directory_cache(long long delta)
+{
+    atomic_fetch_add_explicit(&g_directory_cache_bytes, (size_t)delta, memory_order_relaxed);
+}
 
-    if (g_memory_stats.total_allocated > g_memory_stats.peak_allocated) {
-        g_memory_stats.peak_allocated = g_memory_stats.total_allocated;
+void memory_get_stats_string(char *buffer, size_t buffer_size)
+{
+    MemoryStats stats;
+    memory_profile_snapshot(&stats);
+
+    int written = snprintf(buffer, buffer_size, "Mem: %.1f MB (peak %.1f)",
+                           stats.total_allocated / (1024.0 * 1024.0),
+                           stats.peak_allocated / (1024.0 * 1024.0));
+    for (int t = 0; t < MEMORY_TAG_COUNT && written >= 0 && (size_t)written < buffer_size; t++) {
+        written += snprintf(buffer + written, buffer_size - written, " | %s %.1f",
+                            memory_tag_name((MemoryTag)t), stats.tag_bytes[t] / (1024.0 * 1024.0));
     }
 }
 
-void memory_track_free(size_t size)
+//=============================================================================
+// Texture Budget Implementation
+//=============================================================================
+
+typedef struct TrackedTexture {
+    unsigned int id;
+    size_t bytes;
+    uint64_t last_drawn;                // Frame it was last drawn or created in
+    TextureEvictFn evict;
+    void *owner;
+} TrackedTexture;
+
+static TrackedTexture g_textures[TEXTURE_BUDGET_MAX_TRACKED];
+static int g_texture_count = 0;
+static size_t g_texture_bytes = 0;
+static size_t g_texture_limit = TEXTURE_BUDGET_DEFAULT;
+static uint64_t g_texture_frame = 0;
+
+// Helper: Index of a tracked texture; -1 if absent
+static int texture_find(unsigned int id)
+{
+    for (int i = 0; i < g_texture_count; i++) {
+        if (g_textures[i].id == id) return i;
+    }
+    return -1;
+}
+
+// Helper: Drop the tracked texture at index
+static void texture_remove(int index)
+{
+    g_texture_bytes -= g_textures[index].bytes;
+    g_textures[index] = g_textures[--g_texture_count];
+}
+
+// Helper: Whether a texture has been drawn too recently to give up
+static bool texture_recent(const TrackedTexture *texture)
+{
+    return texture->last_drawn + TEXTURE_BUDGET_RECENT_FRAMES > g_texture_frame;
+}
+
+void texture_budget_set(size_t bytes)
+{
+    g_texture_limit = bytes > 0 ? bytes : TEXTURE_BUDGET_DEFAULT;
+}
+
+void texture_budget_track(unsigned int id, size_t base_bytes, int mipmaps, TextureEvictFn evict, void *owner)
+{
+    if (id == 0) return;
+
+    int index = texture_find(id);
+    if (index >= 0) {
+        texture_remove(index);
+    }
+    // Past the table, textures go unaccounted rather than fail
+    if (g_texture_count == TEXTURE_BUDGET_MAX_TRACKED) return;
+
+    size_t bytes = mipmaps > 1 ? base_bytes + base_bytes / 3 : base_bytes;
+    g_textures[g_texture_count++] = (TrackedTexture){
+        .id = id, .bytes = bytes, .last_drawn = g_texture_frame, .evict = evict, .owner = owner
+    };
+    g_texture_bytes += bytes;
+}
+
+void texture_budget_untrack(unsigned int id)
+{
+    int index = texture_find(id);
+    if (index >= 0) {
+        texture_remove(index);
+    }
+}
+
+void texture_budget_touch(unsigned int id)
 {
-    if (!profiling_active) return;
+    int index = texture_find(id);
+    if (index >= 0) {
+        g_textures[index].last_drawn = g_texture_frame;
+    }
+}
 
-    if (size <= g_memory_stats.total_allocated) {
-        g_memory_stats.total_allocated -= size;
+// Helper: Evict least recently drawn textures, not drawn lately, down to target bytes
+static void texture_evict_to(size_t target)
+{
+    // Owners that keep a texture are not asked again this pass
+    bool refused[TEXTURE_BUDGET_MAX_TRACKED] = { false };
+    while (g_texture_bytes > target) {
+        int oldest = -1;
+        for (int i = 0; i < g_texture_count; i++) {
+            const TrackedTexture *texture = &g_textures[i];
+            if (!texture->evict || refused[i] || texture_recent(texture)) continue;
+            if (oldest < 0 || texture->last_drawn < g_textures[oldest].last_drawn) {
+                oldest = i;
+            }
+        }
+        if (oldest < 0) break;
+
+        // Untracked first: the owner unloads it without coming back here
+        TrackedTexture victim = g_textures[oldest];
+        texture_remove(oldest);
+        refused[oldest] = refused[g_texture_count];
+        if (!victim.evict(victim.owner, victim.id)) {
+            g_textures[g_texture_count] = victim;
+            g_texture_bytes += victim.bytes;
+            refused[g_texture_count++] = true;
+        }
     }
-    g_memory_stats.free_count++;
+}
+
+void texture_budget_trim(void)
+{
+    g_texture_frame++;
+    texture_evict_to(g_texture_limit);
+}
+
+void texture_budget_release(size_t target)
+{
+    texture_evict_to(target);
+}
+
+int texture_budget_fit_edge(int wanted)
+{
+    size_t held = 0;
+    for (int i = 0; i < g_texture_count; i++) {
+        if (!g_textures[i].evict || texture_recent(&g_textures[i])) {
+            held += g_textures[i].bytes;
+        }
+    }
+
+    int edge = wanted;
+    while (edge / 2 >= TEXTURE_BUDGET_MIN_EDGE) {
+        size_t bytes = (size_t)edge * (size_t)edge * 4;
+        if (held + bytes + bytes / 3 <= g_texture_limit) break;
+        edge /= 2;
+    }
+    return edge;
+}
+
+size_t texture_budget_used(void)
+{
+    return g_texture_bytes;
+}
+
+size_t texture_budget_limit(void)
+{
+    return g_texture_limit;
+}
+
+int texture_budget_count(void)
+{
+    return g_texture_count;
 }
 
 //=============================================================================
@@ -517,8 +1262,18 @@ void timing_init(FrameTimings *timings)
 
 void timing_record_frame(FrameTimings *timings, double frame_time)
 {
+    // Section times belong to the frame being recorded; fold them into the averages
+    for (int i = 0; i < FRAME_SECTION_COUNT; i++) {
+        timings->section_avg[i] += (timings->section_time[i] - timings->section_avg[i]) * FRAME_SECTION_SMOOTHING;
+        timings->section_time[i] = 0;
+    }
+
+    if (timings->paused || frame_time <= 0) {
+        return;
+    }
+
     timings->frame_times[timings->frame_index] = frame_time;
-    timings->frame_index = (timings->frame_index + 1) % 120;
+    timings->frame_index = (timings->frame_index + 1) % FRAME_HISTORY;
     timings->frame_count++;
 
     if (frame_time < timings->min_frame_time) {
@@ -530,11 +1285,37 @@ void timing_record_frame(FrameTimings *timings, double frame_time)
 
     // Update average
     double sum = 0;
-    int count = (timings->frame_count < 120) ? timings->frame_count : 120;
+    int count = (timings->frame_count < FRAME_HISTORY) ? timings->frame_count : FRAME_HISTORY;
     for (int i = 0; i < count; i++) {
         sum += timings->frame_times[i];
     }
     timings->avg_frame_time = sum / count;
+
+    int bucket = (int)(frame_time / FRAME_HISTOGRAM_STEP);
+    if (bucket >= FRAME_HISTOGRAM_BUCKETS) bucket = FRAME_HISTOGRAM_BUCKETS - 1;
+    timings->histogram[bucket]++;
+    timings->histogram_count++;
+
+    // A frame spanning several refresh intervals drops all but one of them
+    double target = timing_target_frame_time(timings);
+    if (frame_time > target * FRAME_DROP_FACTOR) {
+        timings->dropped_frames += (uint64_t)(frame_time / target + 0.5) - 1;
+    }
+}
+
+void timing_set_target(FrameTimings *timings, double refresh_rate)
+{
+    timings->target_frame_time = (refresh_rate > 0) ? 1.0 / refresh_rate : 0;
+}
+
+double timing_target_frame_time(const FrameTimings *timings)
+{
+    return (timings->target_frame_time > 0) ? timings->target_frame_time : 1.0 / 60.0;
+}
+
+void timing_set_paused(FrameTimings *timings, bool paused)
+{
+    timings->paused = paused;
 }
 
 double timing_get_fps(FrameTimings *timings)
@@ -558,10 +1339,10 @@ double timing_get_percentile(FrameTimings *timings, float percentile)
         return 0;
     }
 
-    int count = (timings->frame_count < 120) ? timings->frame_count : 120;
+    int count = (timings->frame_count < FRAME_HISTORY) ? timings->frame_count : FRAME_HISTORY;
 
     // Copy and sort using qsort for O(n log n) performance
-    double sorted[120];
+    double sorted[FRAME_HISTORY];
     memcpy(sorted, timings->frame_times, count * sizeof(double));
     qsort(sorted, count, sizeof(double), compare_double_qsort);
 
@@ -570,14 +1351,172 @@ double timing_get_percentile(FrameTimings *timings, float percentile)
     return sorted[idx];
 }
 
+double timing_get_session_percentile(const FrameTimings *timings, float percentile)
+{
+    if (timings->histogram_count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(percentile * timings->histogram_count);
+    if (rank >= timings->histogram_count) rank = timings->histogram_count - 1;
+
+    // Upper edge of the bucket holding the frame at that rank
+    uint64_t seen = 0;
+    for (int i = 0; i < FRAME_HISTOGRAM_BUCKETS; i++) {
+        seen += timings->histogram[i];
+        if (seen > rank) {
+            return (i + 1) * FRAME_HISTOGRAM_STEP;
+        }
+    }
+    return FRAME_HISTOGRAM_BUCKETS * FRAME_HISTOGRAM_STEP;
+}
+
 bool timing_hitting_target(FrameTimings *timings, double target_fps)
 {
-    double target_time = 1.0 / target_fps;
+    double target_time = (target_fps > 0) ? 1.0 / target_fps : timing_target_frame_time(timings);
     // Use 99th percentile to check for consistent performance
     double p99 = timing_get_percentile(timings, 0.99f);
     return p99 <= target_time * 1.1;  // Allow 10% margin
 }
 
+void timing_get_stats_string(const FrameTimings *timings, char *buffer, size_t buffer_size)
+{
+    snprintf(buffer, buffer_size,
+             "%.0f Hz | P50/P95/P99: %.1f/%.1f/%.1fms | Dropped: %llu | "
+             "Async %.2f Input %.2f Layout %.2f Draw %.2fms",
+             1.0 / timing_target_frame_time(timings),
+             timing_get_session_percentile(timings, 0.50f) * 1000,
+             timing_get_session_percentile(timings, 0.95f) * 1000,
+             timing_get_session_percentile(timings, 0.99f) * 1000,
+             (unsigned long long)timings->dropped_frames,
+             timings->section_avg[FRAME_SECTION_ASYNC] * 1000,
+             timings->section_avg[FRAME_SECTION_INPUT] * 1000,
+             timings->section_avg[FRAME_SECTION_LAYOUT] * 1000,
+             timings->section_avg[FRAME_SECTION_DRAW] * 1000);
+}
+
+void timing_section_begin(FrameTimings *timings, FrameSection section)
+{
+    timings->section_start[section] = get_time_seconds();
+}
+
+void timing_section_end(FrameTimings *timings, FrameSection section)
+{
+    if (timings->section_start[section] > 0) {
+        timings->section_time[section] += get_time_seconds() - timings->section_start[section];
+        timings->section_start[section] = 0;
+    }
+}
+
+//=============================================================================
+// Frame Work Budget Implementation
+//=============================================================================
+
+static double g_frame_work_deadline = 0.0;
+
+double timing_work_budget(const FrameTimings *timings)
+{
+    double target = timing_target_frame_time(timings);
+    double room = target - timings->section_avg[FRAME_SECTION_INPUT] -
+                  timings->section_avg[FRAME_SECTION_LAYOUT] - timings->section_avg[FRAME_SECTION_DRAW];
+    double budget = target * FRAME_WORK_SHARE;
+    if (room < budget) {
+        budget = room;
+    }
+    return (budget > FRAME_WORK_MIN) ? budget : FRAME_WORK_MIN;
+}
+
+void frame_work_begin(double seconds)
+{
+    g_frame_work_deadline = get_time_seconds() + seconds;
+}
+
+double frame_work_remaining(void)
+{
+    double left = g_frame_work_deadline - get_time_seconds();
+    return (left > 0) ? left : 0;
+}
+
+//=============================================================================
+// Startup Timing Implementation
+//=============================================================================
+
+static pthread_mutex_t g_startup_mutex = PTHREAD_MUTEX_INITIALIZER;
+static StartupTimings g_startup = {0};
+static double g_startup_begin = 0.0;
+
+void startup_begin(void)
+{
+    pthread_mutex_lock(&g_startup_mutex);
+    memset(&g_startup, 0, sizeof(g_startup));
+    g_startup_begin = get_time_seconds();
+    pthread_mutex_unlock(&g_startup_mutex);
+}
+
+double startup_phase_begin(void)
+{
+    return get_time_seconds();
+}
+
+void startup_phase_end(const char *name, double start, bool background)
+{
+    double duration = get_time_seconds() - start;
+
+    pthread_mutex_lock(&g_startup_mutex);
+    if (g_startup.count < STARTUP_MAX_PHASES) {
+        StartupPhase *phase = &g_startup.phases[g_startup.count++];
+        phase->name = name;
+        phase->duration = duration;
+        phase->background = background;
+    }
+    pthread_mutex_unlock(&g_startup_mutex);
+}
+
+void startup_mark_first_frame(void)
+{
+    pthread_mutex_lock(&g_startup_mutex);
+    if (g_startup.first_frame == 0.0) {
+        g_startup.first_frame = get_time_seconds() - g_startup_begin;
+    }
+    pthread_mutex_unlock(&g_startup_mutex);
+}
+
+void startup_mark_ready(void)
+{
+    pthread_mutex_lock(&g_startup_mutex);
+    if (g_startup.ready == 0.0) {
+        g_startup.ready = get_time_seconds() - g_startup_begin;
+    }
+    pthread_mutex_unlock(&g_startup_mutex);
+}
+
+void startup_get_timings(StartupTimings *timings)
+{
+    pthread_mutex_lock(&g_startup_mutex);
+    *timings = g_startup;
+    pthread_mutex_unlock(&g_startup_mutex);
+}
+
+void startup_get_stats_string(char *buffer, size_t buffer_size)
+{
+    StartupTimings timings;
+    startup_get_timings(&timings);
+
+    int written;
+    if (timings.ready > 0.0) {
+        written = snprintf(buffer, buffer_size, "Startup: frame %.0fms, ready %.0fms",
+                           timings.first_frame * 1000, timings.ready * 1000);
+    } else {
+        written = snprintf(buffer, buffer_size, "Startup: frame %.0fms, loading",
+                           timings.first_frame * 1000);
+    }
+    for (int i = 0; i < timings.count && written >= 0 && (size_t)written < buffer_size; i++) {
+        written += snprintf(buffer + written, buffer_size - written, " | %s%s %.0f",
+                            timings.phases[i].background ? "~" : "", timings.phases[i].name,
+                            timings.phases[i].duration * 1000);
+    }
+}
+
 //=============================================================================
 // Performance Manager Implementation
 //=============================================================================
@@ -601,12 +1540,23 @@ void perf_update(PerfManager *perf, double frame_time)
 {
     timing_record_frame(&perf->timings, frame_time);
 
-    // Process some lazy load tasks
-    for (int i = 0; i < 2; i++) {  // Process up to 2 per frame
-        if (!lazy_process_one(&perf->lazy_queue)) {
-            break;
+    // Drop listings the watcher reported as changed
+    dir_cache_process_events(&perf->dir_cache);
+
+    // Without workers, process some lazy load tasks here
+    if (perf->lazy_queue.worker_count == 0) {
+        for (int i = 0; i < 2; i++) {  // Process up to 2 per frame
+            if (!lazy_process_one(&perf->lazy_queue)) {
+                break;
+            }
         }
     }
+
+    // Hand loaded results to their owners (texture uploads happen here)
+    lazy_poll(&perf->lazy_queue, LAZY_POLL_PER_FRAME);
+
+    // Give back textures not drawn lately once the budget is exceeded
+    texture_budget_trim();
 }
 
 void perf_set_enabled(PerfManager *perf, bool enabled)
@@ -617,8 +1567,6 @@ void perf_set_enabled(PerfManager *perf, bool enabled)
 
     if (enabled) {
         memory_profile_start();
-    } else {
-        memory_profile_stop();
     }
 
     perf->profiling_enabled = enabled;
@@ -630,10 +1578,14 @@ void perf_get_stats_string(PerfManager *perf, char *buffer, size_t buffer_size)
     double p99 = timing_get_percentile(&perf->timings, 0.99f) * 1000;
 
     snprintf(buffer, buffer_size,
-             "FPS: %.1f | P99: %.1fms | Cache: %d/%d | Lazy: %d",
+             "FPS: %.1f | P99: %.1fms | Cache: %d (%.1f/%.0f MB) | Lazy: %d | Tex: %d (%.0f/%.0f MB)",
              fps,
              p99,
              perf->dir_cache.count,
-             DIR_CACHE_MAX_ENTRIES,
-             perf->lazy_queue.count);
+             perf->dir_cache.bytes / (1024.0 * 1024.0),
+             perf->dir_cache.max_bytes / (1024.0 * 1024.0),
+             perf->lazy_queue.count,
+             texture_budget_count(),
+             texture_budget_used() / (1024.0 * 1024.0),
+             texture_budget_limit() / (1024.0 * 1024.0));
 }
@@ -5,28 +5,51 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <time.h>
+#include <pthread.h>
 
 //=============================================================================
 // Directory Cache
 //=============================================================================
 
-#define DIR_CACHE_MAX_ENTRIES 32
-#define DIR_CACHE_MAX_AGE 5.0  // Seconds before cache entry is stale
+#define DIR_CACHE_BUCKETS 256                        // Hash buckets (power of two)
+#define DIR_CACHE_DEFAULT_BUDGET (64 * 1024 * 1024)   // Bytes of listings kept cached
+#define DIR_CACHE_MAX_PENDING 1024                   // Queued invalidations before a full clear
 
-// Forward declaration
+// Forward declarations
 struct DirectoryState;
+struct FsWatch;
 
 typedef struct DirCacheEntry {
-    char path[4096];
+    char *path;
+    uint32_t hash;
     struct DirectoryState *directory;
-    double timestamp;
-    bool valid;
+    size_t bytes;                       // Accounted size of directory
+    double stored_at;                   // When it was put (monotonic seconds)
+    struct DirCacheEntry *bucket_next;  // Hash chain
+    struct DirCacheEntry *lru_prev;     // Toward most recently used
+    struct DirCacheEntry *lru_next;     // Toward least recently used
 } DirCacheEntry;
 
+// Listings stay valid until a file system event touches them, or for max_age
+// seconds when one is set; the least recently used ones are evicted once the
+// byte budget is exceeded
 typedef struct DirCache {
-    DirCacheEntry entries[DIR_CACHE_MAX_ENTRIES];
+    DirCacheEntry *buckets[DIR_CACHE_BUCKETS];
+    DirCacheEntry *lru_head;
+    DirCacheEntry *lru_tail;
     int count;
+    size_t bytes;
+    size_t max_bytes;
+    double max_age;                     // Seconds a listing stays valid, 0 = no limit
     bool enabled;
+
+    // Changed paths reported from the watch thread, applied on the next access
+    pthread_mutex_t pending_mutex;
+    char **pending;
+    int pending_count;
+    bool pending_overflow;
+    struct FsWatch *watch;
+    int watch_id;                       // Subscription on watch, 0 when none
 } DirCache;
 
 // Initialize directory cache
@@ -35,12 +58,36 @@ void dir_cache_init(DirCache *cache);
 // Free directory cache
 void dir_cache_free(DirCache *cache);
 
-// Get cached directory (returns NULL if not cached or stale)
+// Get cached directory (returns NULL if not cached or invalidated)
 struct DirectoryState* dir_cache_get(DirCache *cache, const char *path);
 
-// Store directory in cache (makes a copy)
+// Store directory in cache (makes a copy), evicting LRU entries over budget
 void dir_cache_put(DirCache *cache, const char *path, const struct DirectoryState *dir);
 
+// Set the byte budget, evicting immediately if the cache is over it
+void dir_cache_set_budget(DirCache *cache, size_t max_bytes);
+
+// Evict least recently used listings until at most target bytes remain (the budget
+// itself is unchanged)
+void dir_cache_trim(DirCache *cache, size_t target);
+
+// Expire listings seconds after they were stored (0 = keep until invalidated),
+// for caches no watch keeps current
+void dir_cache_set_max_age(DirCache *cache, double seconds);
+
+// Subscribe to the watch bus so listings are invalidated when they change
+bool dir_cache_watch(DirCache *cache, struct FsWatch *watch);
+
+// Report a changed path (thread-safe); its parent listing is invalidated
+// on the next cache access
+void dir_cache_notify(DirCache *cache, const char *path);
+
+// Drop every listing on the next cache access (thread-safe)
+void dir_cache_notify_all(DirCache *cache);
+
+// Apply invalidations queued by dir_cache_notify()
+void dir_cache_process_events(DirCache *cache);
+
 // Invalidate a specific path (and its children)
 void dir_cache_invalidate(DirCache *cache, const char *path);
 
@@ -92,7 +139,11 @@ void dirty_set_enabled(DirtyRectTracker *tracker, bool enabled);
 // Lazy Loading Queue
 //=============================================================================
 
-#define LAZY_QUEUE_MAX 256
+#define LAZY_QUEUE_MAX 1024          // Tasks tracked, pending or holding a result
+#define LAZY_BUCKETS 2048            // Hash buckets (power of two)
+#define LAZY_MAX_WORKERS 4
+#define LAZY_TASK_TYPES 3
+#define LAZY_POLL_PER_FRAME 8        // Results handed over per frame
 
 typedef enum LazyTaskType {
     LAZY_TASK_THUMBNAIL,
@@ -103,44 +154,101 @@ typedef enum LazyTaskType {
 typedef enum LazyTaskStatus {
     LAZY_STATUS_PENDING,
     LAZY_STATUS_IN_PROGRESS,
+    LAZY_STATUS_LOADED,              // Waiting for lazy_poll() on the main thread
     LAZY_STATUS_COMPLETE,
     LAZY_STATUS_ERROR
 } LazyTaskStatus;
 
+// Load a result on a worker thread (NULL: failed)
+typedef void *(*LazyLoadFn)(LazyTaskType type, const char *path, void *context);
+
+// Finish a loaded result on the main thread, e.g. upload pixels to a texture; takes
+// ownership of the loaded result and returns the one to keep (NULL: failed)
+typedef void *(*LazyCompleteFn)(LazyTaskType type, const char *path, void *result, void *context);
+
+// Free a result
+typedef void (*LazyFreeFn)(LazyTaskType type, void *result, void *context);
+
+typedef struct LazyLoader {
+    LazyLoadFn load;                 // NULL: tasks complete at once with no result
+    LazyCompleteFn complete;         // Optional
+    LazyFreeFn free_result;          // NULL: free()
+    void *context;
+} LazyLoader;
+
 typedef struct LazyTask {
     LazyTaskType type;
     LazyTaskStatus status;
-    char path[4096];
+    char *path;                      // NULL: slot unused
+    uint32_t hash;
+    int next;                        // Next task in the bucket, -1 at the end
+    int heap_index;                  // Position in the pending heap, -1 if not pending
     int priority;
+    uint64_t sequence;               // Enqueue order, breaks priority ties
+    uint32_t generation;             // Queue generation the task belongs to
+    bool cancelled;                  // Dropped while a worker holds it
     void *result;
     double start_time;
+    double finish_time;
 } LazyTask;
 
+// Tasks are looked up by hash, pending ones are kept in a heap (highest priority on
+// top) that workers take from, and results loaded off the main thread are handed to
+// the loader's complete function from lazy_poll(). Cancelling everything starts a new
+// generation; work in flight from an older one is discarded when it returns
 typedef struct LazyLoadQueue {
     LazyTask tasks[LAZY_QUEUE_MAX];
-    int count;
-    int processing;
+    int buckets[LAZY_BUCKETS];
+    int heap[LAZY_QUEUE_MAX];        // Pending task slots
+    int heap_count;
+    int free_slots[LAZY_QUEUE_MAX];
+    int free_count;
+    int count;                       // Live tasks
+    int processing;                  // Tasks being loaded
+    int loaded;                      // Tasks waiting for lazy_poll()
+    uint64_t sequence;
+    uint32_t generation;
     bool enabled;
+
+    LazyLoader loaders[LAZY_TASK_TYPES];
+
+    pthread_mutex_t mutex;
+    pthread_cond_t work;             // A task is pending, or stopping
+    pthread_t workers[LAZY_MAX_WORKERS];
+    int worker_count;
+    bool stopping;
 } LazyLoadQueue;
 
 // Initialize lazy load queue
 void lazy_init(LazyLoadQueue *queue);
 
-// Free lazy load queue
+// Free lazy load queue (stops the workers)
 void lazy_free(LazyLoadQueue *queue);
 
-// Add task to queue (returns task index)
+// Set how tasks of a type are loaded; with a load function, tasks of the type run on
+// the worker threads. Set loaders before enqueueing tasks of that type
+void lazy_set_loader(LazyLoadQueue *queue, LazyTaskType type, const LazyLoader *loader);
+
+// Start worker threads (at most LAZY_MAX_WORKERS); returns the number running
+int lazy_start_workers(LazyLoadQueue *queue, int count);
+
+// Add task to queue (returns task slot, -1 if full of more urgent work). Enqueueing a
+// task again sets its priority, so callers re-prioritize as the view scrolls
 int lazy_enqueue(LazyLoadQueue *queue, LazyTaskType type, const char *path, int priority);
 
-// Cancel task by path
+// Cancel tasks for a path, of every type
 void lazy_cancel(LazyLoadQueue *queue, const char *path);
 
-// Cancel all pending tasks
+// Cancel all tasks and start a new generation (e.g. when the directory changes)
 void lazy_cancel_all(LazyLoadQueue *queue);
 
-// Process one pending task (call from main thread or worker)
+// Process one pending task on this thread (for tasks without workers)
 bool lazy_process_one(LazyLoadQueue *queue);
 
+// Deliver up to max loaded results through their complete functions (main thread);
+// returns the number delivered
+int lazy_poll(LazyLoadQueue *queue, int max);
+
 // Get completed task result (returns NULL if not ready)
 void* lazy_get_result(LazyLoadQueue *queue, const char *path, LazyTaskType type);
 
@@ -151,24 +259,47 @@ bool lazy_is_complete(LazyLoadQueue *queue, const char *path, LazyTaskType type)
 // Memory Profiling
 //=============================================================================
 
+// Subsystems allocations are charged to
+typedef enum MemoryTag {
+    MEMORY_TAG_DIRECTORY,               // Listing entries and name arenas
+    MEMORY_TAG_CACHE,                   // Folder size cache
+    MEMORY_TAG_PREVIEW,                 // Video preview frames
+    MEMORY_TAG_AI,                      // Vector index
+    MEMORY_TAG_NETWORK,                 // HTTP request and response bodies
+    MEMORY_TAG_ARENA,                   // Frame and operation arena blocks
+    MEMORY_TAG_OTHER,                   // memory_track_alloc/free
+    MEMORY_TAG_COUNT
+} MemoryTag;
+
 typedef struct MemoryStats {
-    size_t total_allocated;
-    size_t peak_allocated;
-    size_t allocation_count;
+    size_t total_allocated;             // Live bytes over every tag
+    size_t peak_allocated;              // Highest total since the profile started
+    size_t allocation_count;            // Since the profile started
     size_t free_count;
-    size_t directory_cache_bytes;
-    size_t thumbnail_cache_bytes;
-    size_t preview_bytes;
+    size_t directory_cache_bytes;       // Listings the directory cache holds (shared with their views)
+    size_t tag_bytes[MEMORY_TAG_COUNT]; // Live bytes per tag
+    size_t tag_peak[MEMORY_TAG_COUNT];  // Highest per tag since the profile started
 } MemoryStats;
 
-// Global memory stats
-extern MemoryStats g_memory_stats;
+// Tagged allocation: plain malloc blocks (free() on one only skips the accounting),
+// charged at their usable size to tag with atomic counters, so any thread may
+// allocate and the footprint per subsystem is always current. Free or reallocate a
+// block with the tag it was allocated with
+void *memory_alloc(MemoryTag tag, size_t size);
+void *memory_calloc(MemoryTag tag, size_t count, size_t size);
+void *memory_realloc(MemoryTag tag, void *ptr, size_t size);
+void *memory_aligned_alloc(MemoryTag tag, size_t alignment, size_t size);
+char *memory_strdup(MemoryTag tag, const char *text);
+void memory_free(MemoryTag tag, void *ptr);
 
-// Start memory profiling
-void memory_profile_start(void);
+// Live bytes charged to tag
+size_t memory_tag_bytes(MemoryTag tag);
 
-// Stop memory profiling
-void memory_profile_stop(void);
+// Short name of tag ("dir", "cache", ...)
+const char *memory_tag_name(MemoryTag tag);
+
+// Start a profile: peaks restart from the live footprint and the counts from zero
+void memory_profile_start(void);
 
 // Get current memory usage
 void memory_profile_snapshot(MemoryStats *stats);
@@ -176,24 +307,108 @@ void memory_profile_snapshot(MemoryStats *stats);
 // Print memory report
 void memory_profile_print(void);
 
-// Track allocation (call from malloc wrapper)
+// Account size bytes allocated elsewhere to MEMORY_TAG_OTHER
 void memory_track_alloc(size_t size);
 
-// Track deallocation (call from free wrapper)
+// Account size bytes freed elsewhere to MEMORY_TAG_OTHER
 void memory_track_free(size_t size);
 
+// Account the bytes the directory cache holds (main thread)
+void memory_track_directory_cache(long long delta);
+
+// Live footprint, total and per tag, on one line
+void memory_get_stats_string(char *buffer, size_t buffer_size);
+
+//=============================================================================
+// Texture Budget
+//=============================================================================
+
+#define TEXTURE_BUDGET_DEFAULT (384 * 1024 * 1024)   // Bytes of GPU textures kept by default
+#define TEXTURE_BUDGET_MAX_TRACKED 256               // Textures accounted at once
+#define TEXTURE_BUDGET_RECENT_FRAMES 2               // Frames a drawn texture counts as on screen
+#define TEXTURE_BUDGET_MIN_EDGE 512                  // Smallest edge new textures are shrunk to
+
+// Releases a texture the budget chose to evict: the owner unloads it and forgets it,
+// or returns false to keep it (it is still needed, e.g. on screen)
+typedef bool (*TextureEvictFn)(void *owner, unsigned int id);
+
+// Every GPU texture is accounted here when created and untracked when unloaded, so
+// preview images, PDF pages, video frames and thumbnail atlases share one budget. Once
+// per frame the least recently drawn textures that have an evict function are handed
+// back to their owners until the total fits; textures without one (atlases, video
+// planes) are charged but never evicted. Main thread only, like the textures
+
+// Set the byte budget (0 restores the default)
+void texture_budget_set(size_t bytes);
+
+// Account a texture of base_bytes (its largest level; mipmaps add a third); evict may
+// be NULL for one its owner frees itself
+void texture_budget_track(unsigned int id, size_t base_bytes, int mipmaps, TextureEvictFn evict, void *owner);
+
+// Stop accounting a texture about to be unloaded
+void texture_budget_untrack(unsigned int id);
+
+// The texture was drawn this frame
+void texture_budget_touch(unsigned int id);
+
+// Evict least recently drawn textures until within the budget (once per frame)
+void texture_budget_trim(void);
+
+// Evict textures not drawn lately until at most target bytes are accounted, or none
+// is left to evict (for memory pressure; the budget is unchanged)
+void texture_budget_release(size_t target);
+
+// Longest edge to decode a new texture at: wanted, halved (not below
+// TEXTURE_BUDGET_MIN_EDGE) while a mipmapped RGBA square of it would not fit beside
+// the textures that cannot be evicted now
+int texture_budget_fit_edge(int wanted);
+
+// Bytes accounted, the budget, and textures accounted
+size_t texture_budget_used(void);
+size_t texture_budget_limit(void);
+int texture_budget_count(void);
+
 //=============================================================================
 // Frame Timing
 //=============================================================================
 
+#define FRAME_HISTORY 120                   // Recent frames kept for min/avg/percentiles
+#define FRAME_HISTOGRAM_BUCKETS 400         // Session histogram: 0.25 ms buckets up to 100 ms
+#define FRAME_HISTOGRAM_STEP 0.00025
+#define FRAME_DROP_FACTOR 1.5               // Frames this much over the target count as dropped
+#define FRAME_SECTION_SMOOTHING 0.05        // Weight of the newest sample in section averages
+
+// Parts of a frame timed separately
+typedef enum FrameSection {
+    FRAME_SECTION_ASYNC,                    // Merging background results (listings, git, watcher)
+    FRAME_SECTION_INPUT,                    // Input handling and state updates
+    FRAME_SECTION_LAYOUT,                   // Building the UI's draw commands
+    FRAME_SECTION_DRAW,                     // Submitting and presenting (vsync wait excluded)
+    FRAME_SECTION_COUNT
+} FrameSection;
+
 typedef struct FrameTimings {
-    double frame_times[120];
+    double frame_times[FRAME_HISTORY];
     int frame_index;
     double min_frame_time;
     double max_frame_time;
     double avg_frame_time;
     double last_update;
     int frame_count;
+
+    // Pacing: the refresh interval frames are paced to, and frames that missed it
+    double target_frame_time;               // 0 until set (60 Hz assumed)
+    uint64_t dropped_frames;                // Refresh intervals missed, over the session
+    bool paused;                            // Idle: frames are waits, not work, and are skipped
+
+    // Every frame of the session, for percentiles beyond the recent history
+    uint32_t histogram[FRAME_HISTOGRAM_BUCKETS];
+    uint64_t histogram_count;
+
+    // Time per section: this frame's, and a moving average
+    double section_start[FRAME_SECTION_COUNT];
+    double section_time[FRAME_SECTION_COUNT];
+    double section_avg[FRAME_SECTION_COUNT];
 } FrameTimings;
 
 // Initialize frame timing
@@ -202,15 +417,97 @@ void timing_init(FrameTimings *timings);
 // Record a frame
 void timing_record_frame(FrameTimings *timings, double frame_time);
 
+// Set the display refresh rate frames are paced to
+void timing_set_target(FrameTimings *timings, double refresh_rate);
+
+// Frame time of the pacing target (1/60 s until set)
+double timing_target_frame_time(const FrameTimings *timings);
+
+// Stop or resume recording frames (while the app sleeps between events)
+void timing_set_paused(FrameTimings *timings, bool paused);
+
 // Get average FPS
 double timing_get_fps(FrameTimings *timings);
 
 // Get frame time percentile
 double timing_get_percentile(FrameTimings *timings, float percentile);
 
-// Check if we're hitting target FPS
+// Frame time percentile over the whole session (bucket resolution)
+double timing_get_session_percentile(const FrameTimings *timings, float percentile);
+
+// Check if we're hitting target FPS (target_fps <= 0: the pacing target)
 bool timing_hitting_target(FrameTimings *timings, double target_fps);
 
+// Pacing summary: target rate, session percentiles, dropped frames, time per section
+void timing_get_stats_string(const FrameTimings *timings, char *buffer, size_t buffer_size);
+
+// Time a section of the frame; a section may be entered several times per frame
+void timing_section_begin(FrameTimings *timings, FrameSection section);
+void timing_section_end(FrameTimings *timings, FrameSection section);
+
+//=============================================================================
+// Frame Work Budget
+//=============================================================================
+
+#define FRAME_WORK_SHARE 0.25               // Of the target frame time: 4 ms at 60 Hz
+#define FRAME_WORK_MIN 0.0005               // Allowed even when the rest of the frame leaves no room
+
+// Main-thread work on results from background threads (job completions, texture
+// uploads, merges) draws on one allowance per frame, so a burst of finished work is
+// spread over the next frames instead of dropping one. Each consumer still does one
+// unit of work a frame once the allowance is spent, so none of them starves; the most
+// visible work goes first within each. Main thread only
+
+// Seconds this frame may spend on background results: FRAME_WORK_SHARE of the target
+// frame time, less while input, layout and drawing leave less room (not below FRAME_WORK_MIN)
+double timing_work_budget(const FrameTimings *timings);
+
+// Start this frame's allowance of seconds
+void frame_work_begin(double seconds);
+
+// Seconds left of this frame's allowance (0 once spent)
+double frame_work_remaining(void);
+
+//=============================================================================
+// Startup Timing
+//=============================================================================
+
+#define STARTUP_MAX_PHASES 16
+
+// Phases are timed from startup_begin() and may be recorded from any thread: the main
+// thread's run before the first frame, background ones while the first frames draw
+typedef struct StartupPhase {
+    const char *name;                       // String literal
+    double duration;                        // Seconds
+    bool background;
+} StartupPhase;
+
+typedef struct StartupTimings {
+    StartupPhase phases[STARTUP_MAX_PHASES];
+    int count;
+    double first_frame;                     // Seconds from startup_begin, 0 until drawn
+    double ready;                           // Seconds until the background stage finished
+} StartupTimings;
+
+// Start the startup clock (first thing in main)
+void startup_begin(void);
+
+// Time a phase: pass the value startup_phase_begin returned to startup_phase_end
+double startup_phase_begin(void);
+void startup_phase_end(const char *name, double start, bool background);
+
+// The first frame was presented (only the first call counts)
+void startup_mark_first_frame(void);
+
+// Everything deferred at startup has been loaded
+void startup_mark_ready(void);
+
+// Copy of the phases recorded so far
+void startup_get_timings(StartupTimings *timings);
+
+// Time to first frame and to ready, then each phase ("~" marks background ones)
+void startup_get_stats_string(char *buffer, size_t buffer_size);
+
 //=============================================================================
 // Performance Manager (combines all systems)
 //=============================================================================
@@ -0,0 +1,121 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Sixteen-byte vectors for the scanning kernels (filter_query, content_search): NEON
+// on arm64, SSE2 on x86, and plain arrays elsewhere so the same kernel compiles
+// everywhere. A comparison sets a lane to 0xFF when it holds; simd_mask packs one bit
+// per lane (lane 0 lowest), as SSE2's movemask does
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+typedef uint8x16_t SimdBytes;
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_SSE2 1
+typedef __m128i SimdBytes;
+#else
+typedef struct SimdBytes {
+    uint8_t lane[16];
+} SimdBytes;
+#endif
+
+// Load 16 bytes from any address
+static inline SimdBytes simd_load(const uint8_t *p)
+{
+#if defined(SIMD_NEON)
+    return vld1q_u8(p);
+#elif defined(SIMD_SSE2)
+    return _mm_loadu_si128((const __m128i *)(const void *)p);
+#else
+    SimdBytes v;
+    memcpy(v.lane, p, sizeof(v.lane));
+    return v;
+#endif
+}
+
+// Every lane set to byte
+static inline SimdBytes simd_splat(uint8_t byte)
+{
+#if defined(SIMD_NEON)
+    return vdupq_n_u8(byte);
+#elif defined(SIMD_SSE2)
+    return _mm_set1_epi8((char)byte);
+#else
+    SimdBytes v;
+    memset(v.lane, byte, sizeof(v.lane));
+    return v;
+#endif
+}
+
+static inline SimdBytes simd_or(SimdBytes a, SimdBytes b)
+{
+#if defined(SIMD_NEON)
+    return vorrq_u8(a, b);
+#elif defined(SIMD_SSE2)
+    return _mm_or_si128(a, b);
+#else
+    for (int i = 0; i < 16; i++) a.lane[i] |= b.lane[i];
+    return a;
+#endif
+}
+
+static inline SimdBytes simd_and(SimdBytes a, SimdBytes b)
+{
+#if defined(SIMD_NEON)
+    return vandq_u8(a, b);
+#elif defined(SIMD_SSE2)
+    return _mm_and_si128(a, b);
+#else
+    for (int i = 0; i < 16; i++) a.lane[i] &= b.lane[i];
+    return a;
+#endif
+}
+
+// Lanes where a and b are equal
+static inline SimdBytes simd_eq(SimdBytes a, SimdBytes b)
+{
+#if defined(SIMD_NEON)
+    return vceqq_u8(a, b);
+#elif defined(SIMD_SSE2)
+    return _mm_cmpeq_epi8(a, b);
+#else
+    for (int i = 0; i < 16; i++) a.lane[i] = a.lane[i] == b.lane[i] ? 0xFF : 0;
+    return a;
+#endif
+}
+
+// Lanes where a and b share a set bit
+static inline SimdBytes simd_test(SimdBytes a, SimdBytes b)
+{
+#if defined(SIMD_NEON)
+    return vtstq_u8(a, b);
+#elif defined(SIMD_SSE2)
+    __m128i clear = _mm_cmpeq_epi8(_mm_and_si128(a, b), _mm_setzero_si128());
+    return _mm_xor_si128(clear, _mm_set1_epi8((char)0xFF));
+#else
+    for (int i = 0; i < 16; i++) a.lane[i] = (a.lane[i] & b.lane[i]) ? 0xFF : 0;
+    return a;
+#endif
+}
+
+// One bit per set lane of a comparison (lanes all ones or all zeros)
+static inline uint32_t simd_mask(SimdBytes v)
+{
+#if defined(SIMD_NEON)
+    static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t bits = vandq_u8(v, vld1q_u8(weights));
+    return vaddv_u8(vget_low_u8(bits)) | ((uint32_t)vaddv_u8(vget_high_u8(bits)) << 8);
+#elif defined(SIMD_SSE2)
+    return (uint32_t)(uint16_t)_mm_movemask_epi8(v);
+#else
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; i++) bits |= (uint32_t)(v.lane[i] >> 7) << i;
+    return bits;
+#endif
+}
+
+#endif // SIMD_H
@@ -0,0 +1,78 @@
+#include "string_set.h"
+#include "hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void string_set_init(StringSet *set)
+{
+    memset(set, 0, sizeof(StringSet));
+}
+
+void string_set_free(StringSet *set)
+{
+    free(set->slots);
+    string_set_init(set);
+}
+
+void string_set_clear(StringSet *set)
+{
+    if (set->slots) {
+        memset(set->slots, 0, (size_t)set->slot_count * sizeof(StringSetSlot));
+    }
+    set->count = 0;
+}
+
+int string_set_find(const StringSet *set, const char *text, size_t len,
+                    StringSetKey key, const void *list)
+{
+    if (set->count == 0) {
+        return -1;
+    }
+    uint32_t hash = hash_fnv1a_bytes(HASH_FNV1A_INIT, text, len);
+    uint32_t mask = (uint32_t)set->slot_count - 1;
+    for (uint32_t slot = hash & mask; set->slots[slot].index != 0; slot = (slot + 1) & mask) {
+        if (set->slots[slot].hash != hash) {
+            continue;
+        }
+        const char *held = key(list, set->slots[slot].index - 1);
+        if (strncmp(held, text, len) == 0 && held[len] == '\0') {
+            return set->slots[slot].index - 1;
+        }
+    }
+    return -1;
+}
+
+// Helper: Put an index in the first free slot from its hash (a free slot must exist)
+static void string_set_place(StringSet *set, uint32_t hash, int index)
+{
+    uint32_t mask = (uint32_t)set->slot_count - 1;
+    uint32_t slot = hash & mask;
+    while (set->slots[slot].index != 0) {
+        slot = (slot + 1) & mask;
+    }
+    set->slots[slot].hash = hash;
+    set->slots[slot].index = index + 1;
+}
+
+bool string_set_add(StringSet *set, int index, const char *text, size_t len)
+{
+    if ((set->count + 1) * 2 > set->slot_count) {
+        int slot_count = set->slot_count ? set->slot_count * 2 : 64;
+        StringSetSlot *slots = calloc((size_t)slot_count, sizeof(StringSetSlot));
+        if (!slots) {
+            return false;
+        }
+        StringSet grown = { slots, slot_count, set->count };
+        for (int i = 0; i < set->slot_count; i++) {
+            if (set->slots[i].index != 0) {
+                string_set_place(&grown, set->slots[i].hash, set->slots[i].index - 1);
+            }
+        }
+        free(set->slots);
+        *set = grown;
+    }
+    string_set_place(set, hash_fnv1a_bytes(HASH_FNV1A_INIT, text, len), index);
+    set->count++;
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef STRING_SET_H
+#define STRING_SET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Open-addressed hash set over strings the caller keeps in its own list: the set holds
+// list indices and their hashes, and reads a string back through the caller's
+// accessor only to confirm a hash match. Kept at most half full
+
+// String at index in the caller's list (NUL-terminated)
+typedef const char *(*StringSetKey)(const void *list, int index);
+
+typedef struct StringSetSlot {
+    uint32_t hash;
+    int index;                          // List index + 1, 0 when the slot is empty
+} StringSetSlot;
+
+typedef struct StringSet {
+    StringSetSlot *slots;
+    int slot_count;                     // Power of two, 0 until the first add
+    int count;
+} StringSet;
+
+void string_set_init(StringSet *set);
+void string_set_free(StringSet *set);
+
+// Forget every string, keeping the slots
+void string_set_clear(StringSet *set);
+
+// List index of the len-byte string text, or -1
+int string_set_find(const StringSet *set, const char *text, size_t len,
+                    StringSetKey key, const void *list);
+
+// Record that the list holds the len-byte string text at index; the caller has checked
+// it is not in the set yet. False if out of memory
+bool string_set_add(StringSet *set, int index, const char *text, size_t len);
+
+#endif // STRING_SET_H
@@ -0,0 +1,574 @@
+#include "syntax.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// Line-start states
+#define STATE_NORMAL 0
+#define STATE_BLOCK_COMMENT 1           // Inside /* */
+#define STATE_TRIPLE_DOUBLE 2           // Inside """ """
+#define STATE_TRIPLE_SINGLE 3           // Inside ''' '''
+#define STATE_MARKUP_COMMENT 4          // Inside <!-- -->
+
+static const char *c_keywords[] = {
+    "auto", "bool", "break", "case", "char", "class", "const", "constexpr", "continue",
+    "default", "delete", "do", "double", "else", "enum", "extern", "false", "float", "for",
+    "goto", "if", "inline", "int", "long", "namespace", "new", "nullptr", "private",
+    "protected", "public", "register", "return", "short", "signed", "sizeof", "static",
+    "struct", "switch", "template", "this", "true", "typedef", "typename", "union",
+    "unsigned", "using", "virtual", "void", "volatile", "while", NULL
+};
+
+static const char *c_like_keywords[] = {
+    "as", "async", "await", "break", "case", "catch", "class", "const", "continue", "def",
+    "default", "defer", "do", "else", "enum", "export", "extends", "false", "final", "fn",
+    "for", "func", "function", "go", "guard", "if", "impl", "import", "in", "interface",
+    "let", "match", "mod", "mut", "new", "nil", "null", "package", "private", "protected",
+    "pub", "public", "return", "self", "static", "struct", "super", "switch", "this",
+    "throw", "throws", "trait", "true", "try", "type", "typeof", "undefined", "use", "var",
+    "void", "while", "yield", NULL
+};
+
+static const char *python_keywords[] = {
+    "False", "None", "True", "and", "as", "assert", "async", "await", "break", "class",
+    "continue", "def", "del", "elif", "else", "except", "finally", "for", "from", "global",
+    "if", "import", "in", "is", "lambda", "nonlocal", "not", "or", "pass", "raise",
+    "return", "self", "try", "while", "with", "yield", NULL
+};
+
+static const char *shell_keywords[] = {
+    "case", "do", "done", "elif", "else", "esac", "export", "false", "fi", "for",
+    "function", "if", "in", "local", "null", "return", "then", "true", "while", NULL
+};
+
+SyntaxLanguage syntax_language_for_extension(const char *extension)
+{
+    static const struct {
+        const char *extension;
+        SyntaxLanguage language;
+    } languages[] = {
+        { "c", SYNTAX_C }, { "h", SYNTAX_C }, { "cpp", SYNTAX_C }, { "hpp", SYNTAX_C },
+        { "m", SYNTAX_C },
+        { "js", SYNTAX_C_LIKE }, { "ts", SYNTAX_C_LIKE }, { "go", SYNTAX_C_LIKE },
+        { "rs", SYNTAX_C_LIKE }, { "java", SYNTAX_C_LIKE }, { "swift", SYNTAX_C_LIKE },
+        { "css", SYNTAX_C_LIKE }, { "json", SYNTAX_C_LIKE },
+        { "py", SYNTAX_PYTHON },
+        { "sh", SYNTAX_SHELL }, { "yaml", SYNTAX_SHELL }, { "yml", SYNTAX_SHELL },
+        { "toml", SYNTAX_SHELL },
+        { "html", SYNTAX_MARKUP }, { "xml", SYNTAX_MARKUP },
+    };
+
+    if (!extension) return SYNTAX_NONE;
+    for (size_t i = 0; i < sizeof(languages) / sizeof(languages[0]); i++) {
+        if (strcasecmp(extension, languages[i].extension) == 0) {
+            return languages[i].language;
+        }
+    }
+    return SYNTAX_NONE;
+}
+
+// Helper: Identifier characters (ASCII only)
+static bool is_ident_start(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool is_ident_char(char c)
+{
+    return is_ident_start(c) || (c >= '0' && c <= '9');
+}
+
+// Helper: Whether a word is a keyword of the language
+static bool is_keyword(SyntaxLanguage language, const char *word, size_t len)
+{
+    const char **keywords;
+    switch (language) {
+        case SYNTAX_C:      keywords = c_keywords; break;
+        case SYNTAX_C_LIKE: keywords = c_like_keywords; break;
+        case SYNTAX_PYTHON: keywords = python_keywords; break;
+        case SYNTAX_SHELL:  keywords = shell_keywords; break;
+        default:            return false;
+    }
+    for (int i = 0; keywords[i]; i++) {
+        if (keywords[i][0] == word[0] && strlen(keywords[i]) == len &&
+            memcmp(keywords[i], word, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Helper: Position of seq in line at or after from; len if absent
+static size_t find_seq(const char *line, size_t from, size_t len, const char *seq, size_t seq_len)
+{
+    while (from + seq_len <= len) {
+        const char *hit = memchr(line + from, seq[0], len - from - seq_len + 1);
+        if (!hit) break;
+        from = (size_t)(hit - line);
+        if (memcmp(hit, seq, seq_len) == 0) return from;
+        from++;
+    }
+    return len;
+}
+
+// Spans being written for a line
+typedef struct SpanOut {
+    SyntaxSpan *spans;
+    int max;
+    int count;
+    size_t limit;
+} SpanOut;
+
+// Helper: Record a span, cut at the limit
+static void emit(SpanOut *out, size_t start, size_t end, SyntaxKind kind)
+{
+    if (!out->spans || start >= out->limit || end <= start || out->count >= out->max) return;
+    if (end > out->limit) end = out->limit;
+    out->spans[out->count].start = (uint16_t)start;
+    out->spans[out->count].len = (uint16_t)(end - start);
+    out->spans[out->count].kind = (uint8_t)kind;
+    out->count++;
+}
+
+// Helper: Whether line starts with prefix
+static bool starts_with(const char *line, size_t len, const char *prefix)
+{
+    size_t prefix_len = strlen(prefix);
+    return len >= prefix_len && memcmp(line, prefix, prefix_len) == 0;
+}
+
+// Helper: Diff and log lines are told apart by how they start; nothing carries over
+static void tokenize_diff_line(SpanOut *out, const char *line, size_t len)
+{
+    if (starts_with(line, len, "diff ") || starts_with(line, len, "index ") ||
+        starts_with(line, len, "+++ ") || starts_with(line, len, "--- ")) {
+        emit(out, 0, len, SYNTAX_PREPROCESSOR);
+    } else if (starts_with(line, len, "@@")) {
+        // Hunk range, then the enclosing function as plain text
+        size_t end = find_seq(line, 2, len, "@@", 2);
+        emit(out, 0, end < len ? end + 2 : len, SYNTAX_KEYWORD);
+    } else if (starts_with(line, len, "+")) {
+        emit(out, 0, len, SYNTAX_INSERTED);
+    } else if (starts_with(line, len, "-")) {
+        emit(out, 0, len, SYNTAX_DELETED);
+    } else if (starts_with(line, len, "commit ")) {
+        emit(out, 0, 6, SYNTAX_KEYWORD);
+        emit(out, 7, len, SYNTAX_NUMBER);
+    } else if (starts_with(line, len, "Author:") || starts_with(line, len, "Date:")) {
+        emit(out, 0, len, SYNTAX_COMMENT);
+    }
+}
+
+int syntax_tokenize_line(SyntaxLanguage language, const char *line, size_t len, uint8_t *state,
+                         SyntaxSpan *spans, int max_spans, size_t span_limit)
+{
+    SpanOut out = { spans, max_spans, 0, span_limit };
+    if (language == SYNTAX_DIFF) {
+        *state = STATE_NORMAL;
+        tokenize_diff_line(&out, line, len);
+        return out.count;
+    }
+    bool c_family = language == SYNTAX_C || language == SYNTAX_C_LIKE;
+    size_t i = 0;
+
+    // Finish a comment or string carried over from the previous line
+    if (*state != STATE_NORMAL) {
+        const char *close = "*/";
+        SyntaxKind kind = SYNTAX_COMMENT;
+        if (*state == STATE_TRIPLE_DOUBLE) { close = "\"\"\""; kind = SYNTAX_STRING; }
+        if (*state == STATE_TRIPLE_SINGLE) { close = "'''"; kind = SYNTAX_STRING; }
+        if (*state == STATE_MARKUP_COMMENT) close = "-->";
+
+        size_t close_len = strlen(close);
+        size_t end = find_seq(line, 0, len, close, close_len);
+        if (end == len) {
+            emit(&out, 0, len, kind);
+            return out.count;
+        }
+        emit(&out, 0, end + close_len, kind);
+        *state = STATE_NORMAL;
+        i = end + close_len;
+    }
+
+    size_t first_char = 0;
+    while (first_char < len && (line[first_char] == ' ' || line[first_char] == '\t')) first_char++;
+    bool in_tag = false;
+
+    while (i < len) {
+        char c = line[i];
+        char next = i + 1 < len ? line[i + 1] : '\0';
+
+        // Comments
+        if (c_family && c == '/' && next == '/') {
+            emit(&out, i, len, SYNTAX_COMMENT);
+            break;
+        }
+        if (c_family && c == '/' && next == '*') {
+            size_t end = find_seq(line, i + 2, len, "*/", 2);
+            if (end == len) {
+                emit(&out, i, len, SYNTAX_COMMENT);
+                *state = STATE_BLOCK_COMMENT;
+                break;
+            }
+            emit(&out, i, end + 2, SYNTAX_COMMENT);
+            i = end + 2;
+            continue;
+        }
+        if (language == SYNTAX_MARKUP && c == '<' && len - i >= 4 && memcmp(line + i, "<!--", 4) == 0) {
+            size_t end = find_seq(line, i + 4, len, "-->", 3);
+            if (end == len) {
+                emit(&out, i, len, SYNTAX_COMMENT);
+                *state = STATE_MARKUP_COMMENT;
+                break;
+            }
+            emit(&out, i, end + 3, SYNTAX_COMMENT);
+            i = end + 3;
+            continue;
+        }
+        if (c == '#') {
+            if (language == SYNTAX_PYTHON || language == SYNTAX_SHELL) {
+                emit(&out, i, len, SYNTAX_COMMENT);
+                break;
+            }
+            if (language == SYNTAX_C && i == first_char) {
+                // Up to a trailing comment, which may run on to later lines
+                size_t end = find_seq(line, i, len, "//", 2);
+                size_t block = find_seq(line, i, len, "/*", 2);
+                if (block < end) end = block;
+                emit(&out, i, end, SYNTAX_PREPROCESSOR);
+                i = end;
+                continue;
+            }
+        }
+
+        // Strings (in markup, only attribute values)
+        if ((c == '"' || c == '\'' || (c == '`' && c_family)) && (language != SYNTAX_MARKUP || in_tag)) {
+            if (language == SYNTAX_PYTHON && next == c && i + 2 < len && line[i + 2] == c) {
+                const char *close = c == '"' ? "\"\"\"" : "'''";
+                size_t end = find_seq(line, i + 3, len, close, 3);
+                if (end == len) {
+                    emit(&out, i, len, SYNTAX_STRING);
+                    *state = c == '"' ? STATE_TRIPLE_DOUBLE : STATE_TRIPLE_SINGLE;
+                    break;
+                }
+                emit(&out, i, end + 3, SYNTAX_STRING);
+                i = end + 3;
+                continue;
+            }
+
+            size_t j = i + 1;
+            while (j < len && line[j] != c) {
+                if (line[j] == '\\' && language != SYNTAX_MARKUP) j++;
+                j++;
+            }
+            size_t end = j < len ? j + 1 : len;
+            emit(&out, i, end, SYNTAX_STRING);
+            i = end;
+            continue;
+        }
+
+        // Numbers
+        if (c >= '0' && c <= '9' && (i == 0 || !is_ident_char(line[i - 1]))) {
+            size_t j = i + 1;
+            while (j < len && (is_ident_char(line[j]) || line[j] == '.')) j++;
+            emit(&out, i, j, SYNTAX_NUMBER);
+            i = j;
+            continue;
+        }
+
+        // Keywords (in markup, tag names)
+        if (is_ident_start(c)) {
+            size_t j = i + 1;
+            while (j < len && is_ident_char(line[j])) j++;
+            if (language == SYNTAX_MARKUP) {
+                bool tag_name = i > 0 && (line[i - 1] == '<' || (line[i - 1] == '/' && i > 1 && line[i - 2] == '<'));
+                if (tag_name) emit(&out, i, j, SYNTAX_KEYWORD);
+            } else if (is_keyword(language, line + i, j - i)) {
+                emit(&out, i, j, SYNTAX_KEYWORD);
+            }
+            i = j;
+            continue;
+        }
+
+        if (language == SYNTAX_MARKUP) {
+            if (c == '<') in_tag = true;
+            else if (c == '>') in_tag = false;
+        }
+        i++;
+    }
+
+    return out.count;
+}
+
+//=============================================================================
+// Background highlighter
+//=============================================================================
+
+// Where a line starts and the state it starts in
+typedef struct SyntaxCheckpoint {
+    size_t offset;
+    uint8_t state;
+} SyntaxCheckpoint;
+
+// Cached spans of a line
+typedef struct SyntaxLine {
+    int line;                           // -1 when empty
+    int count;
+    SyntaxSpan spans[SYNTAX_MAX_SPANS];
+} SyntaxLine;
+
+struct SyntaxHighlighter {
+    const char *data;
+    size_t size;
+    SyntaxLanguage language;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool stopping;
+
+    // States of every SYNTAX_STRIDE-th line, up to where the walk has got (guarded)
+    SyntaxCheckpoint *checkpoints;
+    int checkpoint_count;
+    int checkpoint_capacity;
+    bool walked;                        // The whole file has been walked
+
+    // Walk position (thread only)
+    size_t walk_offset;
+    int walk_line;
+    uint8_t walk_state;
+
+    // Lines wanted (guarded)
+    int request_first;
+    int request_count;
+    bool request_pending;
+    bool highlighting;
+
+    SyntaxLine cache[SYNTAX_CACHE_LINES];   // Guarded
+};
+
+// Helper: The length of the line at offset, and the offset of the next (past size at the end)
+static size_t line_at(const SyntaxHighlighter *h, size_t offset, size_t *next)
+{
+    const char *newline = memchr(h->data + offset, '\n', h->size - offset);
+    if (newline) {
+        *next = (size_t)(newline - h->data) + 1;
+        return (size_t)(newline - (h->data + offset));
+    }
+    *next = h->size + 1;
+    return h->size - offset;
+}
+
+// Helper: Walk up to SYNTAX_SCAN_LINES more lines, keeping line-start states
+static void walk_some(SyntaxHighlighter *h)
+{
+    SyntaxCheckpoint found[SYNTAX_SCAN_LINES / SYNTAX_STRIDE + 1];
+    int found_count = 0;
+
+    for (int n = 0; n < SYNTAX_SCAN_LINES && h->walk_offset <= h->size; n++) {
+        if (h->walk_line % SYNTAX_STRIDE == 0) {
+            found[found_count].offset = h->walk_offset;
+            found[found_count].state = h->walk_state;
+            found_count++;
+        }
+        size_t next;
+        size_t len = line_at(h, h->walk_offset, &next);
+        syntax_tokenize_line(h->language, h->data + h->walk_offset, len, &h->walk_state, NULL, 0, 0);
+        h->walk_offset = next;
+        h->walk_line++;
+    }
+
+    pthread_mutex_lock(&h->mutex);
+    if (h->checkpoint_count + found_count > h->checkpoint_capacity) {
+        int capacity = h->checkpoint_capacity ? h->checkpoint_capacity * 2 : 256;
+        while (capacity < h->checkpoint_count + found_count) capacity *= 2;
+        SyntaxCheckpoint *grown = realloc(h->checkpoints, (size_t)capacity * sizeof(SyntaxCheckpoint));
+        if (!grown) {
+            h->walked = true;           // Out of memory: highlight what was walked
+            pthread_mutex_unlock(&h->mutex);
+            return;
+        }
+        h->checkpoints = grown;
+        h->checkpoint_capacity = capacity;
+    }
+    memcpy(&h->checkpoints[h->checkpoint_count], found, (size_t)found_count * sizeof(SyntaxCheckpoint));
+    h->checkpoint_count += found_count;
+    if (h->walk_offset > h->size) {
+        h->walked = true;
+    }
+    pthread_mutex_unlock(&h->mutex);
+}
+
+// Helper: Highlight lines [first, first + count) from the state kept before them; stops
+// early when another range is requested
+static void highlight_lines(SyntaxHighlighter *h, SyntaxCheckpoint from, int from_line, int first, int count)
+{
+    size_t offset = from.offset;
+    uint8_t state = from.state;
+    SyntaxLine result;
+
+    for (int line = from_line; line < first + count && offset <= h->size; line++) {
+        size_t next;
+        size_t len = line_at(h, offset, &next);
+        if (line < first) {
+            syntax_tokenize_line(h->language, h->data + offset, len, &state, NULL, 0, 0);
+        } else {
+            result.line = line;
+            result.count = syntax_tokenize_line(h->language, h->data + offset, len, &state,
+                                                result.spans, SYNTAX_MAX_SPANS, SYNTAX_LINE_BYTES);
+
+            pthread_mutex_lock(&h->mutex);
+            bool superseded = h->stopping || h->request_pending;
+            h->cache[line % SYNTAX_CACHE_LINES] = result;
+            pthread_mutex_unlock(&h->mutex);
+            if (superseded) return;
+        }
+        offset = next;
+    }
+}
+
+// Thread function: Highlight requested lines as soon as the walk has passed them, and
+// walk the file in between
+static void *syntax_thread(void *arg)
+{
+    SyntaxHighlighter *h = arg;
+
+    pthread_mutex_lock(&h->mutex);
+    while (!h->stopping) {
+        if (h->request_pending) {
+            int checkpoint = h->request_first / SYNTAX_STRIDE;
+            if (checkpoint < h->checkpoint_count) {
+                SyntaxCheckpoint from = h->checkpoints[checkpoint];
+                int first = h->request_first;
+                int count = h->request_count;
+                h->request_pending = false;
+                h->highlighting = true;
+                pthread_mutex_unlock(&h->mutex);
+
+                highlight_lines(h, from, checkpoint * SYNTAX_STRIDE, first, count);
+
+                pthread_mutex_lock(&h->mutex);
+                h->highlighting = false;
+                continue;
+            }
+            if (h->walked) {
+                h->request_pending = false;     // Past the end of the file
+                continue;
+            }
+        }
+
+        if (!h->walked) {
+            pthread_mutex_unlock(&h->mutex);
+            walk_some(h);
+            pthread_mutex_lock(&h->mutex);
+            continue;
+        }
+
+        pthread_cond_wait(&h->cond, &h->mutex);
+    }
+    pthread_mutex_unlock(&h->mutex);
+    return NULL;
+}
+
+SyntaxHighlighter* syntax_create(const char *data, size_t size, SyntaxLanguage language)
+{
+    if (!data || language == SYNTAX_NONE) {
+        return NULL;
+    }
+
+    SyntaxHighlighter *h = calloc(1, sizeof(SyntaxHighlighter));
+    if (!h) {
+        return NULL;
+    }
+    h->data = data;
+    h->size = size;
+    h->language = language;
+    h->request_first = -1;
+    for (int i = 0; i < SYNTAX_CACHE_LINES; i++) {
+        h->cache[i].line = -1;
+    }
+
+    pthread_mutex_init(&h->mutex, NULL);
+    pthread_cond_init(&h->cond, NULL);
+    if (pthread_create(&h->thread, NULL, syntax_thread, h) != 0) {
+        pthread_cond_destroy(&h->cond);
+        pthread_mutex_destroy(&h->mutex);
+        free(h);
+        return NULL;
+    }
+    return h;
+}
+
+void syntax_destroy(SyntaxHighlighter *h)
+{
+    if (!h) {
+        return;
+    }
+
+    pthread_mutex_lock(&h->mutex);
+    h->stopping = true;
+    pthread_cond_signal(&h->cond);
+    pthread_mutex_unlock(&h->mutex);
+    pthread_join(h->thread, NULL);
+
+    pthread_cond_destroy(&h->cond);
+    pthread_mutex_destroy(&h->mutex);
+    free(h->checkpoints);
+    free(h);
+}
+
+void syntax_request(SyntaxHighlighter *h, int first, int count)
+{
+    if (!h || count <= 0) {
+        return;
+    }
+
+    // A screen either side, so scrolling finds lines ready
+    if (count > SYNTAX_CACHE_LINES / 3) count = SYNTAX_CACHE_LINES / 3;
+    int start = first - count > 0 ? first - count : 0;
+    int total = first + count * 2 - start;
+
+    pthread_mutex_lock(&h->mutex);
+    bool cached = true;
+    for (int line = first; line < first + count && cached; line++) {
+        cached = h->cache[line % SYNTAX_CACHE_LINES].line == line;
+    }
+    if (!cached && (start != h->request_first || total != h->request_count)) {
+        h->request_first = start;
+        h->request_count = total;
+        h->request_pending = true;
+        pthread_cond_signal(&h->cond);
+    }
+    pthread_mutex_unlock(&h->mutex);
+}
+
+int syntax_line_spans(SyntaxHighlighter *h, int line, SyntaxSpan *spans, int max_spans)
+{
+    if (!h || line < 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&h->mutex);
+    const SyntaxLine *cached = &h->cache[line % SYNTAX_CACHE_LINES];
+    int count = -1;
+    if (cached->line == line) {
+        count = cached->count < max_spans ? cached->count : max_spans;
+        memcpy(spans, cached->spans, (size_t)count * sizeof(SyntaxSpan));
+    }
+    pthread_mutex_unlock(&h->mutex);
+    return count;
+}
+
+bool syntax_is_busy(SyntaxHighlighter *h)
+{
+    if (!h) {
+        return false;
+    }
+
+    pthread_mutex_lock(&h->mutex);
+    bool busy = h->request_pending || h->highlighting;
+    pthread_mutex_unlock(&h->mutex);
+    return busy;
+}
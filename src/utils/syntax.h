@@ -0,0 +1,79 @@
+#ifndef SYNTAX_H
+#define SYNTAX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Syntax highlighting for code previews. A small tokenizer marks keywords, strings,
+// comments, numbers and preprocessor lines; its only state across lines is whether a
+// line starts inside a block comment or long string. A background thread walks the file
+// once, keeping that state every SYNTAX_STRIDE lines, and highlights the lines around
+// the viewport from the nearest kept state as soon as the walk has passed them. Token
+// spans are cached per line, so scrolling back and forth tokenizes nothing
+
+#define SYNTAX_STRIDE 64                // Lines between kept line-start states
+#define SYNTAX_CACHE_LINES 512          // Lines whose spans are cached (direct-mapped)
+#define SYNTAX_MAX_SPANS 48             // Spans kept per line
+#define SYNTAX_LINE_BYTES 255           // Bytes of a line highlighted (as many as are drawn)
+#define SYNTAX_SCAN_LINES 4096          // Lines walked between viewport checks
+
+// Languages, by how they tokenize
+typedef enum SyntaxLanguage {
+    SYNTAX_NONE,
+    SYNTAX_C,                           // C/C++: C-like with preprocessor lines
+    SYNTAX_C_LIKE,                      // Braces, // and /* */ comments (JS, Go, Rust, ...)
+    SYNTAX_PYTHON,
+    SYNTAX_SHELL,                       // # comments (shell, YAML, TOML)
+    SYNTAX_MARKUP,                      // HTML/XML: tags and <!-- --> comments
+    SYNTAX_DIFF                         // git diff and log output, a whole line at a time
+} SyntaxLanguage;
+
+// Token kinds; text outside any span is plain
+typedef enum SyntaxKind {
+    SYNTAX_PLAIN,
+    SYNTAX_KEYWORD,
+    SYNTAX_STRING,
+    SYNTAX_COMMENT,
+    SYNTAX_NUMBER,
+    SYNTAX_PREPROCESSOR,
+    SYNTAX_INSERTED,                    // Diff lines added
+    SYNTAX_DELETED                      // Diff lines removed
+} SyntaxKind;
+
+// Highlighted bytes of a line
+typedef struct SyntaxSpan {
+    uint16_t start;
+    uint16_t len;
+    uint8_t kind;                       // SyntaxKind
+} SyntaxSpan;
+
+// Highlighter for one file (opaque)
+typedef struct SyntaxHighlighter SyntaxHighlighter;
+
+// Language for a file extension (SYNTAX_NONE if not highlighted)
+SyntaxLanguage syntax_language_for_extension(const char *extension);
+
+// Tokenize one line (without its newline). *state carries over from the previous line
+// (0 for the first) and is updated for the next. Spans starting within span_limit bytes
+// are written to spans (may be NULL to track state only); returns how many
+int syntax_tokenize_line(SyntaxLanguage language, const char *line, size_t len, uint8_t *state,
+                         SyntaxSpan *spans, int max_spans, size_t span_limit);
+
+// Start highlighting data (which must outlive the highlighter); NULL on failure
+SyntaxHighlighter* syntax_create(const char *data, size_t size, SyntaxLanguage language);
+
+// Stop the thread and free the highlighter
+void syntax_destroy(SyntaxHighlighter *highlighter);
+
+// Ask for count lines from first (and a margin around them) to be highlighted; cheap
+// to call every frame
+void syntax_request(SyntaxHighlighter *highlighter, int first, int count);
+
+// Spans of a highlighted line; -1 while it is not highlighted yet
+int syntax_line_spans(SyntaxHighlighter *highlighter, int line, SyntaxSpan *spans, int max_spans);
+
+// Whether requested lines are still being highlighted
+bool syntax_is_busy(SyntaxHighlighter *highlighter);
+
+#endif // SYNTAX_H
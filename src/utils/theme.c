@@ -1,4 +1,5 @@
 #include "theme.h"
+#include "font.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -115,6 +116,9 @@ void theme_set(ThemeType type)
             }
             break;
     }
+
+    // Cached text layouts are rebuilt for the new theme
+    font_layout_invalidate();
 }
 
 void theme_toggle(void)
@@ -0,0 +1,244 @@
+#include "trace.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+typedef struct TraceEvent {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+} TraceEvent;
+
+// One thread's events. Only the owner writes them; trace_stop() waits out a write in
+// progress, after which the events can be read until the next trace_start()
+typedef struct TraceBuffer {
+    TraceEvent events[TRACE_RING_EVENTS];
+    atomic_uint_fast64_t head;          // Events written; the newest is at (head - 1) % ring
+    atomic_bool writing;
+    atomic_bool retired;                // Owner exited; the next new thread takes it over
+    int id;                             // Track in the trace
+    char name[TRACE_THREAD_NAME_MAX];
+} TraceBuffer;
+
+atomic_bool g_trace_recording = false;
+
+static pthread_mutex_t g_trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static TraceBuffer *g_trace_buffers[TRACE_MAX_THREADS];
+static int g_trace_buffer_count = 0;
+static uint64_t g_trace_start_ticks = 0;
+
+static pthread_once_t g_trace_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_trace_key;
+
+static __thread TraceBuffer *t_trace_buffer = NULL;
+static __thread bool t_trace_untraced = false;
+static __thread char t_trace_name[TRACE_THREAD_NAME_MAX] = {0};
+
+// Helper: Hand the exiting thread's ring to the next thread that needs one (its events
+// stay readable, on the same track)
+static void trace_retire_buffer(void *value)
+{
+    TraceBuffer *buffer = value;
+    atomic_store(&buffer->retired, true);
+}
+
+static void trace_create_key(void)
+{
+    pthread_key_create(&g_trace_key, trace_retire_buffer);
+}
+
+// Helper: Give the calling thread a ring (locks once per thread)
+static TraceBuffer *trace_acquire_buffer(void)
+{
+    pthread_once(&g_trace_key_once, trace_create_key);
+
+    pthread_mutex_lock(&g_trace_mutex);
+    TraceBuffer *buffer = NULL;
+    for (int i = 0; i < g_trace_buffer_count && !buffer; i++) {
+        if (atomic_load(&g_trace_buffers[i]->retired)) {
+            buffer = g_trace_buffers[i];
+            atomic_store(&buffer->retired, false);
+        }
+    }
+    if (!buffer && g_trace_buffer_count < TRACE_MAX_THREADS) {
+        buffer = calloc(1, sizeof(TraceBuffer));
+        if (buffer) {
+            buffer->id = g_trace_buffer_count + 1;
+            g_trace_buffers[g_trace_buffer_count++] = buffer;
+        }
+    }
+    if (buffer) {
+        if (t_trace_name[0]) {
+            snprintf(buffer->name, sizeof(buffer->name), "%s", t_trace_name);
+        } else {
+            snprintf(buffer->name, sizeof(buffer->name), "thread %d", buffer->id);
+        }
+    }
+    pthread_mutex_unlock(&g_trace_mutex);
+
+    if (!buffer) {
+        t_trace_untraced = true;
+        return NULL;
+    }
+    pthread_setspecific(g_trace_key, buffer);
+    t_trace_buffer = buffer;
+    return buffer;
+}
+
+void trace_record(const char *name, uint64_t start, uint64_t end)
+{
+    TraceBuffer *buffer = t_trace_buffer;
+    if (!buffer) {
+        if (t_trace_untraced || !(buffer = trace_acquire_buffer())) {
+            return;
+        }
+    }
+
+    // Announce the write before checking the flag (both sequentially consistent), so
+    // trace_stop() either sees this write or this write sees the recording stopped
+    atomic_store(&buffer->writing, true);
+    if (atomic_load(&g_trace_recording)) {
+        uint64_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+        TraceEvent *event = &buffer->events[head % TRACE_RING_EVENTS];
+        event->name = name;
+        event->start = start;
+        event->end = end;
+        atomic_store_explicit(&buffer->head, head + 1, memory_order_relaxed);
+    }
+    atomic_store_explicit(&buffer->writing, false, memory_order_release);
+}
+
+void trace_set_thread_name(const char *name)
+{
+    snprintf(t_trace_name, sizeof(t_trace_name), "%s", name ? name : "");
+    if (t_trace_buffer) {
+        pthread_mutex_lock(&g_trace_mutex);
+        snprintf(t_trace_buffer->name, sizeof(t_trace_buffer->name), "%s", t_trace_name);
+        pthread_mutex_unlock(&g_trace_mutex);
+    }
+}
+
+void trace_start(void)
+{
+    pthread_mutex_lock(&g_trace_mutex);
+    if (!atomic_load(&g_trace_recording)) {
+        // No thread writes while stopped, and each sees these resets once it sees the flag
+        for (int i = 0; i < g_trace_buffer_count; i++) {
+            atomic_store_explicit(&g_trace_buffers[i]->head, 0, memory_order_relaxed);
+        }
+        g_trace_start_ticks = trace_now();
+        atomic_store(&g_trace_recording, true);
+    }
+    pthread_mutex_unlock(&g_trace_mutex);
+}
+
+void trace_stop(void)
+{
+    atomic_store(&g_trace_recording, false);
+
+    pthread_mutex_lock(&g_trace_mutex);
+    for (int i = 0; i < g_trace_buffer_count; i++) {
+        while (atomic_load(&g_trace_buffers[i]->writing)) {
+            sched_yield();
+        }
+    }
+    pthread_mutex_unlock(&g_trace_mutex);
+}
+
+bool trace_is_recording(void)
+{
+    return atomic_load_explicit(&g_trace_recording, memory_order_relaxed);
+}
+
+// Helper: Ticks to microseconds
+static double trace_ticks_to_us(uint64_t ticks)
+{
+#if defined(__APPLE__)
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return (double)ticks * timebase.numer / timebase.denom / 1000.0;
+#else
+    return (double)ticks / 1000.0;
+#endif
+}
+
+bool trace_write(const char *path)
+{
+    if (!path || trace_is_recording()) {
+        return false;
+    }
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+
+    pthread_mutex_lock(&g_trace_mutex);
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Finder Plus\"}}");
+    for (int i = 0; i < g_trace_buffer_count; i++) {
+        TraceBuffer *buffer = g_trace_buffers[i];
+        fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                buffer->id, buffer->name);
+
+        uint64_t head = atomic_load(&buffer->head);
+        uint64_t first = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+        for (uint64_t e = first; e < head; e++) {
+            const TraceEvent *event = &buffer->events[e % TRACE_RING_EVENTS];
+            if (event->start < g_trace_start_ticks) {
+                continue;  // Began before this recording did
+            }
+            fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    event->name, buffer->id,
+                    trace_ticks_to_us(event->start - g_trace_start_ticks),
+                    trace_ticks_to_us(event->end - event->start));
+        }
+    }
+    fprintf(f, "\n]}\n");
+    pthread_mutex_unlock(&g_trace_mutex);
+
+    bool ok = !ferror(f);
+    return fclose(f) == 0 && ok;
+}
+
+bool trace_stop_and_save(char *path, size_t path_size)
+{
+    trace_stop();
+
+    const char *home = getenv("HOME");
+    char dir[1024];
+    int written = snprintf(dir, sizeof(dir), "%s/%s", home ? home : "/tmp", TRACE_DIR);
+    if (written < 0 || (size_t)written >= sizeof(dir)) {
+        return false;
+    }
+    for (char *p = dir + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(dir, 0755);  // Ignore EEXIST
+            *p = '/';
+        }
+    }
+    mkdir(dir, 0755);
+
+    char stamp[32];
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+
+    char file[1200];
+    snprintf(file, sizeof(file), "%s/trace-%s.json", dir, stamp);
+    if (!trace_write(file)) {
+        return false;
+    }
+    if (path && path_size > 0) {
+        snprintf(path, path_size, "%s", file);
+    }
+    return true;
+}
@@ -0,0 +1,96 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#if defined(__APPLE__)
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+// Hot path tracing. TRACE_SCOPE("name") times the rest of the enclosing block into a
+// ring buffer owned by the calling thread, so recording takes no locks and a busy
+// thread only overwrites its own oldest events. While nothing is recording a scope
+// costs one relaxed load; built without FINDER_PLUS_TRACE it costs nothing. A stopped
+// recording is written as Chrome trace JSON, which Perfetto (ui.perfetto.dev) and
+// chrome://tracing open
+//
+// Names must be string literals (they are kept as pointers and written unescaped)
+
+#define TRACE_RING_EVENTS 16384         // Events kept per thread
+#define TRACE_MAX_THREADS 64            // Threads that get a ring; later ones go untraced
+#define TRACE_THREAD_NAME_MAX 32
+#define TRACE_DIR ".cache/finder-plus/traces"
+
+// Scope in flight; start is 0 when nothing was recording as it began
+typedef struct TraceScope {
+    const char *name;
+    uint64_t start;
+} TraceScope;
+
+extern atomic_bool g_trace_recording;
+
+// Monotonic ticks (mach_absolute_time units on macOS, nanoseconds elsewhere)
+static inline uint64_t trace_now(void)
+{
+#if defined(__APPLE__)
+    return mach_absolute_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Record a finished span on the calling thread's ring
+void trace_record(const char *name, uint64_t start, uint64_t end);
+
+static inline TraceScope trace_scope_begin(const char *name)
+{
+    TraceScope scope = { name, 0 };
+    if (atomic_load_explicit(&g_trace_recording, memory_order_relaxed)) {
+        scope.start = trace_now();
+    }
+    return scope;
+}
+
+static inline void trace_scope_end(TraceScope *scope)
+{
+    if (scope->start != 0) {
+        trace_record(scope->name, scope->start, trace_now());
+    }
+}
+
+#ifdef FINDER_PLUS_TRACE
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) \
+    TraceScope TRACE_CONCAT(trace_scope_, __LINE__) \
+        __attribute__((cleanup(trace_scope_end), unused)) = trace_scope_begin(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#endif
+
+// Name the calling thread's track in the trace (e.g. "main")
+void trace_set_thread_name(const char *name);
+
+// Start a recording, dropping the events of the last one
+void trace_start(void);
+
+// Stop recording; returns once no thread is still writing an event
+void trace_stop(void);
+
+bool trace_is_recording(void);
+
+// Write the last recording to path as Chrome trace JSON (call after trace_stop)
+bool trace_write(const char *path);
+
+// Stop, then write to a new timestamped file under ~/TRACE_DIR; the path written
+// goes to path (may be NULL)
+bool trace_stop_and_save(char *path, size_t path_size);
+
+#endif // TRACE_H
@@ -4,14 +4,33 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "../src/ai/embeddings.h"
+#include "../src/ai/ai_common.h"
 #include "../src/ai/vectordb.h"
 #include "../src/ai/indexer.h"
+#include "../src/ai/index_queue.h"
+#include "../src/ai/index_inbox.h"
+#include "../src/ai/content_extract.h"
+#include "../src/ai/extract_pool.h"
+#include "../src/ai/ignore_rules.h"
+#include "../src/ai/index_governor.h"
+#include "../src/ai/path_index.h"
+#include "../src/ai/vector_ops.h"
+#include "../src/ai/vector_index.h"
 #include "../src/ai/semantic_search.h"
 #include "../src/ai/clip.h"
+#include "../src/ai/model_manager.h"
+#include "../src/ai/compute_budget.h"
+#include "../src/ai/query_cache.h"
+#include "../src/ai/wordpiece.h"
 #include "../src/ai/visual_search.h"
+#include "../src/ai/index_pack.h"
 #include "../src/platform/fsevents.h"
+#include "../src/platform/ocr.h"
+#include "../src/core/fs_watch.h"
+#include "../src/utils/file_hash.h"
 
 // Test helper functions
 extern void inc_tests_run(void);
@@ -77,6 +96,7 @@ static void setup_test_dir(void)
 static void cleanup_test_files(void)
 {
     unlink(TEST_DB_PATH);
+    unlink("/tmp/test_vectordb.db.hnsw");
     char cmd[512];
     snprintf(cmd, sizeof(cmd), "rm -rf %s", TEST_DIR_PATH);
     system(cmd);
@@ -197,9 +217,331 @@ static void test_embeddings(void)
             printf("\n  [Real Model Tests] - SKIPPED (model not found at %s)\n", model_path);
         }
     }
+
+    // Test: lazy loading defers the model to first use and reloads it after a trim
+    {
+        EmbeddingEngine *engine = embedding_engine_create();
+        TEST_ASSERT_EQ(EMBEDDING_STATUS_MODEL_NOT_FOUND,
+                       embedding_engine_load_model_lazily(engine, "/nonexistent/model.gguf"),
+                       "Lazy load should report a missing model");
+        TEST_ASSERT(!embedding_engine_is_available(engine), "Missing model should not be available");
+
+        const char *model_path = "models/all-MiniLM-L6-v2/ggml-model-q4_0.bin";
+        if (embedding_model_exists(model_path)) {
+            TEST_ASSERT_EQ(EMBEDDING_STATUS_OK, embedding_engine_load_model_lazily(engine, model_path),
+                           "Lazy load should accept an existing model");
+            TEST_ASSERT(embedding_engine_is_available(engine) && !embedding_engine_is_loaded(engine),
+                        "Model should be available but not loaded yet");
+            EmbeddingResult first = embedding_generate(engine, "lazy");
+            TEST_ASSERT_EQ(EMBEDDING_STATUS_OK, first.status, "First use should load the model");
+            TEST_ASSERT(embedding_engine_trim(engine, 0.0), "Idle model should be trimmed");
+            TEST_ASSERT(!embedding_engine_is_loaded(engine), "Trimmed model should be unloaded");
+            EmbeddingResult again = embedding_generate(engine, "lazy");
+            TEST_ASSERT_EQ(EMBEDDING_STATUS_OK, again.status, "Next use should load it again");
+        }
+        embedding_engine_destroy(engine);
+    }
+
+    // Test: the Core ML export is looked up beside the model and agrees with the CPU
+    {
+        char path[256];
+        path_sibling("models/all-MiniLM-L6-v2/ggml-model-q4_0.bin", "model.mlmodelc", path, sizeof(path));
+        TEST_ASSERT(strcmp(path, "models/all-MiniLM-L6-v2/model.mlmodelc") == 0, "Export should sit beside the model");
+        path_sibling("model.bin", "model.mlmodelc", path, sizeof(path));
+        TEST_ASSERT(strcmp(path, "model.mlmodelc") == 0, "Bare model name should resolve to the working directory");
+
+        const char *model_path = "models/all-MiniLM-L6-v2/ggml-model-q4_0.bin";
+        struct stat st;
+        if (embedding_model_exists(model_path) && stat("models/all-MiniLM-L6-v2/model.mlmodelc", &st) == 0) {
+            EmbeddingConfig config = {0};
+            config.batch_size = 32;
+            strncpy(config.model_path, model_path, sizeof(config.model_path) - 1);
+            EmbeddingEngine *cpu = embedding_engine_create_with_config(&config);
+            config.use_gpu = true;
+            EmbeddingEngine *gpu = embedding_engine_create_with_config(&config);
+            embedding_engine_load_model(cpu, NULL);
+            embedding_engine_load_model(gpu, NULL);
+
+            const char *text = "quarterly revenue report for the board";
+            EmbeddingResult a = embedding_generate(cpu, text);
+            EmbeddingResult b = embedding_generate(gpu, text);
+            TEST_ASSERT(embedding_cosine_similarity(a.embedding, b.embedding) > 0.98f,
+                        "Core ML embedding should match bert.cpp");
+
+            embedding_engine_destroy(cpu);
+            embedding_engine_destroy(gpu);
+        }
+    }
+
+    // Test: the model manager hands out one shared engine
+    {
+        EmbeddingEngine *first = model_manager_acquire_embedding();
+        EmbeddingEngine *second = model_manager_acquire_embedding();
+        TEST_ASSERT(first != NULL && first == second, "Should share one embedding engine");
+        TEST_ASSERT(!embedding_engine_is_loaded(first), "Shared engine should not load at acquire");
+        model_manager_release_embedding(second);
+        model_manager_release_embedding(first);
+    }
+}
+
+// Test vector kernels against a plain scalar reference
+static void test_vector_ops(void)
+{
+    printf("\n  [Vector Ops Tests]\n");
+
+    // Odd dimension exercises the SIMD tail handling
+    enum { DIM = 389, ROWS = 5 };
+    float rows[ROWS * DIM];
+    float query[DIM];
+    for (int i = 0; i < DIM; i++) {
+        query[i] = sinf((float)i * 0.37f);
+        for (int r = 0; r < ROWS; r++) {
+            rows[r * DIM + i] = cosf((float)(i + r * 7) * 0.11f);
+        }
+    }
+
+    // Test: dot products match the reference
+    {
+        float scores[ROWS];
+        vector_dot_rows(rows, ROWS, DIM, query, scores);
+
+        bool all_match = true;
+        for (int r = 0; r < ROWS; r++) {
+            double expected = 0.0;
+            for (int i = 0; i < DIM; i++) {
+                expected += (double)rows[r * DIM + i] * query[i];
+            }
+            float single = vector_dot(&rows[r * DIM], query, DIM);
+            if (fabs(single - expected) > 1e-3 || fabs(scores[r] - expected) > 1e-3) {
+                all_match = false;
+            }
+        }
+        TEST_ASSERT(all_match, "Dot kernels should match the scalar reference");
+    }
+
+    // Test: normalized vectors give cosine as a dot product
+    {
+        float a[DIM];
+        float b[DIM];
+        memcpy(a, query, sizeof(a));
+        memcpy(b, rows, sizeof(b));
+        float cosine = vector_cosine(a, b, DIM);
+
+        vector_normalize(a, DIM);
+        vector_normalize(b, DIM);
+        TEST_ASSERT(fabsf(vector_dot(a, a, DIM) - 1.0f) < 1e-4f, "Normalized vector should have unit length");
+        TEST_ASSERT(fabsf(vector_dot(a, b, DIM) - cosine) < 1e-4f, "Dot of unit vectors should equal cosine");
+
+        float zero[DIM] = {0};
+        vector_normalize(zero, DIM);
+        TEST_ASSERT(zero[0] == 0.0f && vector_cosine(zero, a, DIM) == 0.0f, "Zero vector should stay zero");
+    }
+
+    // Test: quantized codes approximate the float kernels
+    {
+        int8_t qa[DIM];
+        int8_t qb[DIM];
+        float scale_a = vector_quantize_int8(query, DIM, qa);
+        float scale_b = vector_quantize_int8(rows, DIM, qb);
+
+        int32_t expected = 0;
+        for (int i = 0; i < DIM; i++) {
+            expected += (int32_t)qa[i] * qb[i];
+        }
+        float approx = (float)vector_dot_int8(qa, qb, DIM) * scale_a * scale_b;
+        TEST_ASSERT(vector_dot_int8(qa, qb, DIM) == expected, "int8 dot should match the scalar reference");
+        float norms = sqrtf(vector_dot(query, query, DIM) * vector_dot(rows, rows, DIM));
+        TEST_ASSERT(fabsf(approx - vector_dot(query, rows, DIM)) < 0.01f * norms, "int8 dot should approximate the float dot");
+
+        uint64_t bits_a[VECTOR_BINARY_WORDS(DIM)];
+        uint64_t bits_b[VECTOR_BINARY_WORDS(DIM)];
+        vector_binarize(query, DIM, bits_a);
+        vector_binarize(rows, DIM, bits_b);
+        int differing = 0;
+        for (int i = 0; i < DIM; i++) {
+            differing += (query[i] > 0.0f) != (rows[i] > 0.0f);
+        }
+        TEST_ASSERT_EQ(0, vector_hamming(bits_a, bits_a, VECTOR_BINARY_WORDS(DIM)), "Hamming distance to itself should be 0");
+        TEST_ASSERT_EQ(differing, vector_hamming(bits_a, bits_b, VECTOR_BINARY_WORDS(DIM)), "Hamming distance should count sign flips");
+    }
+}
+
+// Test the ANN index against exact search
+static void test_vector_index(void)
+{
+    printf("\n  [Vector Index Tests]\n");
+
+    // Enough vectors that queries go through the graph
+    enum { DIM = 32, COUNT = 6000, K = 10, QUERIES = 50 };
+    const char *index_path = "/tmp/test_vector_index.hnsw";
+    unlink(index_path);
+
+    VectorIndex *index = vector_index_create(DIM);
+    TEST_ASSERT(index != NULL, "Should create vector index");
+    if (index == NULL) {
+        return;
+    }
+
+    // Clustered random vectors, like real embeddings
+    unsigned int seed = 12345;
+    float vector[DIM];
+    float centers[16][DIM];
+    for (int c = 0; c < 16; c++) {
+        for (int d = 0; d < DIM; d++) {
+            centers[c][d] = (float)rand_r(&seed) / RAND_MAX - 0.5f;
+        }
+    }
+    bool all_put = true;
+    for (int i = 0; i < COUNT; i++) {
+        for (int d = 0; d < DIM; d++) {
+            vector[d] = centers[i % 16][d] + 0.3f * ((float)rand_r(&seed) / RAND_MAX - 0.5f);
+        }
+        all_put = all_put && vector_index_append(index, 1000 + i, vector);
+    }
+    TEST_ASSERT(all_put, "Should append vectors");
+    TEST_ASSERT_EQ(COUNT, vector_index_count(index), "Count should match appended vectors");
+
+    // Test: the unlinked tail is still searched exactly
+    {
+        const float *stored = vector_index_get(index, 1000 + 77);
+        VectorIndexHit hit;
+        int n = stored ? vector_index_search(index, stored, 1, VECTOR_INDEX_DEFAULT_EF, &hit) : 0;
+        TEST_ASSERT(n == 1 && hit.label == 1000 + 77, "Unlinked vectors should be found");
+    }
+
+    size_t unlinked_memory = vector_index_memory(index);
+    TEST_ASSERT(unlinked_memory >= (size_t)COUNT * DIM * sizeof(float), "Memory should cover the stored vectors");
+
+    // Test: building in budgets finishes the graph
+    {
+        int left = vector_index_build(index, 100);
+        TEST_ASSERT(left == COUNT - 100, "Build should respect its budget");
+        while (left > 0) {
+            left = vector_index_build(index, 1000);
+        }
+        TEST_ASSERT_EQ(0, vector_index_build(index, 0), "Graph should be fully linked");
+        TEST_ASSERT(vector_index_memory(index) >= unlinked_memory, "Memory should include the graph");
+    }
+
+    // Test: approximate results mostly agree with an exact scan
+    {
+        int found = 0;
+        for (int q = 0; q < QUERIES; q++) {
+            for (int d = 0; d < DIM; d++) {
+                vector[d] = centers[q % 16][d] + 0.3f * ((float)rand_r(&seed) / RAND_MAX - 0.5f);
+            }
+            vector_normalize(vector, DIM);
+
+            VectorIndexHit exact[K];
+            VectorIndexHit approx[K];
+            int exact_count = vector_index_search(index, vector, K, 0, exact);
+            int approx_count = vector_index_search(index, vector, K, VECTOR_INDEX_DEFAULT_EF, approx);
+            for (int i = 0; i < approx_count; i++) {
+                for (int j = 0; j < exact_count; j++) {
+                    if (approx[i].label == exact[j].label) {
+                        found++;
+                        break;
+                    }
+                }
+            }
+        }
+        float recall = (float)found / (QUERIES * K);
+        TEST_ASSERT(recall >= 0.9f, "ANN recall@10 should be at least 0.9");
+    }
+
+    // Test: quantized prefilters keep exact scans accurate
+    {
+        VectorQuantization modes[] = {VECTOR_QUANT_INT8, VECTOR_QUANT_BINARY};
+        for (int m = 0; m < 2; m++) {
+            bool set = vector_index_set_quantization(index, modes[m]);
+            int found = 0;
+            for (int q = 0; q < QUERIES; q++) {
+                for (int d = 0; d < DIM; d++) {
+                    vector[d] = centers[q % 16][d] + 0.3f * ((float)rand_r(&seed) / RAND_MAX - 0.5f);
+                }
+                vector_normalize(vector, DIM);
+
+                VectorIndexHit exact[K];
+                VectorIndexHit approx[K];
+                vector_index_set_quantization(index, VECTOR_QUANT_NONE);
+                int exact_count = vector_index_search(index, vector, K, 0, exact);
+                vector_index_set_quantization(index, modes[m]);
+                int approx_count = vector_index_search(index, vector, K, 0, approx);
+                for (int i = 0; i < approx_count; i++) {
+                    for (int j = 0; j < exact_count; j++) {
+                        if (approx[i].label == exact[j].label) {
+                            found++;
+                            break;
+                        }
+                    }
+                }
+            }
+            float recall = (float)found / (QUERIES * K);
+            TEST_ASSERT(set && recall >= 0.95f,
+                        modes[m] == VECTOR_QUANT_INT8 ? "int8 prefilter recall@10 should be at least 0.95"
+                                                      : "Binary prefilter recall@10 should be at least 0.95");
+        }
+    }
+
+    // Test: removed and replaced vectors
+    {
+        const float *stored = vector_index_get(index, 1000 + 5);
+        memcpy(vector, stored, sizeof(vector));
+        vector_index_remove(index, 1000 + 5);
+        TEST_ASSERT(vector_index_get(index, 1000 + 5) == NULL, "Removed vector should be gone");
+
+        VectorIndexHit hits[K];
+        int n = vector_index_search(index, vector, K, VECTOR_INDEX_DEFAULT_EF, hits);
+        bool absent = true;
+        for (int i = 0; i < n; i++) {
+            if (hits[i].label == 1000 + 5) {
+                absent = false;
+            }
+        }
+        TEST_ASSERT(n == K && absent, "Removed vector should not be returned");
+
+        vector_index_put(index, 42, vector);
+        n = vector_index_search(index, vector, 1, VECTOR_INDEX_DEFAULT_EF, hits);
+        TEST_ASSERT(n == 1 && hits[0].label == 42, "Re-inserted vector should be found");
+        TEST_ASSERT_EQ(COUNT, vector_index_count(index), "Count should track removals");
+    }
+
+    // Test: save and load round trip
+    {
+        TEST_ASSERT(vector_index_save(index, index_path, 7), "Should save vector index");
+
+        VectorIndex *loaded = vector_index_load(index_path, DIM, 7);
+        TEST_ASSERT(loaded != NULL, "Should load saved index");
+        if (loaded != NULL) {
+            TEST_ASSERT_EQ(COUNT, vector_index_count(loaded), "Loaded index should keep its vectors");
+            VectorIndexHit hit;
+            int n = vector_index_search(loaded, vector, 1, VECTOR_INDEX_DEFAULT_EF, &hit);
+            TEST_ASSERT(n == 1 && hit.label == 42, "Loaded index should answer queries");
+            vector_index_destroy(loaded);
+        }
+
+        TEST_ASSERT(vector_index_load(index_path, DIM, 8) == NULL, "Stale signature should be rejected");
+        TEST_ASSERT(vector_index_load(index_path, DIM + 1, 7) == NULL, "Wrong dimension should be rejected");
+    }
+
+    vector_index_destroy(index);
+    unlink(index_path);
 }
 
 // Test vector database
+// Counts files from a thread other than the one writing a batch
+typedef struct {
+    VectorDB *db;
+    int64_t count;
+} VectorDBCount;
+
+static void* vectordb_count_thread(void *arg)
+{
+    VectorDBCount *count = (VectorDBCount *)arg;
+    count->count = vectordb_count_files(count->db);
+    return NULL;
+}
+
 static void test_vectordb(void)
 {
     printf("\n  [VectorDB Tests]\n");
@@ -299,150 +641,1422 @@ static void test_vectordb(void)
         TEST_ASSERT(results.count > 0, "Should have results");
         TEST_ASSERT(results.results[0].similarity > 0, "Should have positive similarity");
 
-        vector_search_results_free(&results);
-        vectordb_close(db);
+        vector_search_results_free(&results);
+        vectordb_close(db);
+    }
+
+    // Test: search sees writes made after the embeddings were loaded
+    {
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+
+        float axis_a[EMBEDDING_DIMENSION] = {0};
+        float axis_b[EMBEDDING_DIMENSION] = {0};
+        axis_a[100] = 1.0f;
+        axis_b[200] = 1.0f;
+
+        vectordb_index_file(db, "/test/matrix/a.txt", "a.txt", FILE_TYPE_TEXT, 1, 1, axis_a);
+        VectorSearchResults results = vectordb_search(db, axis_a, 1);
+        TEST_ASSERT(results.count == 1 && strcmp(results.results[0].file.path, "/test/matrix/a.txt") == 0,
+                    "Search should find the matching file");
+        TEST_ASSERT(results.results[0].similarity > 0.99f, "Exact match should score 1");
+        vector_search_results_free(&results);
+
+        // Re-index a.txt onto the other axis and add b.txt
+        vectordb_index_file(db, "/test/matrix/a.txt", "a.txt", FILE_TYPE_TEXT, 1, 2, axis_b);
+        vectordb_index_file(db, "/test/matrix/b.txt", "b.txt", FILE_TYPE_TEXT, 1, 1, axis_b);
+
+        results = vectordb_search(db, axis_a, 1);
+        TEST_ASSERT(results.count == 1 && results.results[0].similarity < 0.5f,
+                    "Re-indexed embedding should replace the old one");
+        vector_search_results_free(&results);
+
+        results = vectordb_search(db, axis_b, 3);
+        TEST_ASSERT(results.count == 3 && results.results[0].similarity > 0.99f &&
+                    results.results[1].similarity > 0.99f && results.results[2].similarity < 0.5f,
+                    "Both files should match the new axis exactly once");
+        vector_search_results_free(&results);
+
+        vectordb_delete_file(db, "/test/matrix/b.txt");
+        results = vectordb_search(db, axis_b, 2);
+        TEST_ASSERT(results.count == 2 && strcmp(results.results[0].file.path, "/test/matrix/a.txt") == 0 &&
+                    results.results[1].similarity < 0.5f, "Deleted file should leave the results");
+        vector_search_results_free(&results);
+
+        vectordb_delete_directory(db, "/test/matrix/");
+        results = vectordb_search(db, axis_b, 1);
+        TEST_ASSERT(results.count == 1 && results.results[0].similarity < 0.5f,
+                    "Deleted directory should leave the results");
+        vector_search_results_free(&results);
+
+        vectordb_close(db);
+    }
+
+    // Test: batched writes
+    {
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+        int64_t before = vectordb_count_files(db);
+
+        TEST_ASSERT_EQ(VECTORDB_STATUS_OK, vectordb_begin_batch(db), "Should begin batch");
+        TEST_ASSERT_EQ(VECTORDB_STATUS_OK, vectordb_begin_batch(db), "Nested begin should be a no-op");
+        for (int j = 0; j < 3; j++) {
+            char path[256];
+            snprintf(path, sizeof(path), "/test/batch/file%d.txt", j);
+            vectordb_index_file(db, path, path + 12, FILE_TYPE_TEXT, 1, 1, NULL);
+        }
+        TEST_ASSERT_EQ(before + 3, vectordb_count_files(db), "Batched rows should be visible before commit");
+
+        // Another thread reads the last commit without waiting for the batch
+        VectorDBCount other = { db, -1 };
+        pthread_t reader;
+        pthread_create(&reader, NULL, vectordb_count_thread, &other);
+        pthread_join(reader, NULL);
+        TEST_ASSERT_EQ(before, other.count, "Other threads should read the last commit");
+
+        TEST_ASSERT_EQ(VECTORDB_STATUS_OK, vectordb_commit_batch(db), "Should commit batch");
+        TEST_ASSERT_EQ(VECTORDB_STATUS_OK, vectordb_commit_batch(db), "Commit without a batch should be a no-op");
+
+        vectordb_delete_directory(db, "/test/batch/");
+        vectordb_close(db);
+    }
+
+    // Test: identical content shares one embedding
+    {
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+        const char *hash = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+
+        float axis[EMBEDDING_DIMENSION] = {0};
+        axis[200] = 1.0f;
+        float shared[EMBEDDING_DIMENSION];
+        TEST_ASSERT(!vectordb_get_content_embedding(db, hash, shared), "Unknown content should have no embedding");
+
+        vectordb_index_file_with_hash(db, "/test/dedup/a.txt", "a.txt", FILE_TYPE_TEXT, 1, 1, hash, axis);
+        TEST_ASSERT(vectordb_get_content_embedding(db, hash, shared) && shared[200] > 0.99f,
+                    "Should find the embedding by content hash");
+        vectordb_index_file_with_hash(db, "/test/dedup/b.txt", "b.txt", FILE_TYPE_TEXT, 1, 1, hash, shared);
+
+        IndexedFile file;
+        TEST_ASSERT(vectordb_get_file(db, "/test/dedup/b.txt", &file) == VECTORDB_STATUS_OK &&
+                    file.has_embedding && file.embedding[200] > 0.99f,
+                    "Copies should read the shared embedding");
+
+        VectorSearchResults results = vectordb_search_in_directory(db, axis, "/test/dedup/", 10);
+        TEST_ASSERT_EQ(2, results.count, "Both copies should be searchable");
+        vector_search_results_free(&results);
+
+        vectordb_delete_file(db, "/test/dedup/a.txt");
+        TEST_ASSERT(vectordb_get_content_embedding(db, hash, shared), "Shared embedding should outlive one copy");
+        vectordb_delete_file(db, "/test/dedup/b.txt");
+        TEST_ASSERT(!vectordb_get_content_embedding(db, hash, shared), "Last copy should release the embedding");
+
+        vectordb_close(db);
+    }
+
+    // Test: directory-scoped search tracks writes
+    {
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+
+        float axis[EMBEDDING_DIMENSION] = {0};
+        axis[300] = 1.0f;
+        vectordb_index_file(db, "/test/scoped/docs/a.txt", "a.txt", FILE_TYPE_TEXT, 1, 1, axis);
+        vectordb_index_file(db, "/test/scoped/docs/deep/b.txt", "b.txt", FILE_TYPE_TEXT, 1, 1, axis);
+        vectordb_index_file(db, "/test/scoped/other/c.txt", "c.txt", FILE_TYPE_TEXT, 1, 1, axis);
+
+        VectorSearchResults results = vectordb_search_in_directory(db, axis, "/test/scoped/docs/", 10);
+        TEST_ASSERT(results.count == 2 && strstr(results.results[0].file.path, "/docs/") != NULL &&
+                    strstr(results.results[1].file.path, "/docs/") != NULL,
+                    "Scoped search should return only files under the directory");
+        vector_search_results_free(&results);
+
+        // Writes after the paths were loaded
+        vectordb_index_file(db, "/test/scoped/docs/d.txt", "d.txt", FILE_TYPE_TEXT, 1, 1, axis);
+        vectordb_delete_file(db, "/test/scoped/docs/a.txt");
+        results = vectordb_search_in_directory(db, axis, "/test/scoped/DOCS/", 10);
+        bool has_a = false;
+        for (int i = 0; i < results.count; i++) {
+            has_a = has_a || strcmp(results.results[i].file.path, "/test/scoped/docs/a.txt") == 0;
+        }
+        TEST_ASSERT(results.count == 2 && !has_a, "Scoped search should see new and deleted files");
+        vector_search_results_free(&results);
+
+        vectordb_delete_directory(db, "/test/scoped/");
+        results = vectordb_search_in_directory(db, axis, "/test/scoped/", 10);
+        TEST_ASSERT_EQ(0, results.count, "Deleted directory should leave scoped results");
+        vector_search_results_free(&results);
+
+        vectordb_close(db);
+    }
+
+    // Test: delete file
+    {
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+
+        VectorDBStatus status = vectordb_delete_file(db, "/test/path/file.txt");
+        TEST_ASSERT_EQ(VECTORDB_STATUS_OK, status, "Should delete file");
+
+        IndexedFile file;
+        status = vectordb_get_file(db, "/test/path/file.txt", &file);
+        TEST_ASSERT_EQ(VECTORDB_STATUS_NOT_FOUND, status, "Deleted file should not exist");
+
+        vectordb_close(db);
+    }
+
+    // Test: count and total size
+    {
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+
+        int64_t count = vectordb_count_files(db);
+        TEST_ASSERT(count >= 0, "Should return valid count");
+
+        int64_t total = vectordb_total_size(db);
+        TEST_ASSERT(total >= 0, "Should return valid total size");
+
+        vectordb_close(db);
+    }
+
+    // Test: sections are searchable and listed under their file
+    {
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+
+        float whole[EMBEDDING_DIMENSION] = {0};
+        float intro[EMBEDDING_DIMENSION] = {0};
+        float deep[EMBEDDING_DIMENSION] = {0};
+        whole[0] = 1.0f;
+        intro[0] = 1.0f;
+        intro[1] = 0.2f;
+        deep[2] = 1.0f;
+
+        vectordb_index_file(db, "/test/long/doc.md", "doc.md", FILE_TYPE_TEXT, 9000, 1, whole);
+        VectorDBChunk chunks[3] = {
+            { 0, 1500, "Intro", intro },
+            { 1500, 1500, NULL, NULL },         // Not encoded: skipped
+            { 3000, 2000, "Deep Section", deep }
+        };
+        TEST_ASSERT_EQ(VECTORDB_STATUS_OK, vectordb_set_chunks(db, "/test/long/doc.md", chunks, 3),
+                       "Should store sections");
+        TEST_ASSERT_EQ(2, vectordb_count_chunks(db), "Should skip sections without an embedding");
+        TEST_ASSERT_EQ(VECTORDB_STATUS_NOT_FOUND, vectordb_set_chunks(db, "/test/long/missing.md", chunks, 3),
+                       "Sections need an indexed file");
+
+        VectorSearchResults results = vectordb_search_ann(db, deep, 5, 0);
+        TEST_ASSERT(results.count >= 1 && strcmp(results.results[0].file.path, "/test/long/doc.md") == 0,
+                    "Section match should find its file");
+        TEST_ASSERT(results.count >= 1 && results.results[0].has_section &&
+                    results.results[0].section_offset == 3000 &&
+                    strcmp(results.results[0].section_title, "Deep Section") == 0,
+                    "Result should carry the matching section");
+        int listed = 0;
+        for (int i = 0; i < results.count; i++) {
+            listed += strcmp(results.results[i].file.path, "/test/long/doc.md") == 0;
+        }
+        TEST_ASSERT_EQ(1, listed, "File should be listed once");
+        vector_search_results_free(&results);
+
+        results = vectordb_search_in_directory(db, deep, "/test/long/", 5);
+        TEST_ASSERT(results.count == 1 && results.results[0].has_section,
+                    "Directory search should see sections");
+        vector_search_results_free(&results);
+
+        vectordb_index_file(db, "/test/long/doc.md", "doc.md", FILE_TYPE_TEXT, 100, 2, whole);
+        TEST_ASSERT_EQ(0, vectordb_count_chunks(db), "Reindexing should drop old sections");
+
+        vectordb_set_chunks(db, "/test/long/doc.md", chunks, 3);
+        vectordb_delete_directory(db, "/test/long/");
+        TEST_ASSERT_EQ(0, vectordb_count_chunks(db), "Deleting the folder should drop sections");
+
+        vectordb_close(db);
+    }
+
+    // Test: hybrid search finds exact words the embeddings miss
+    {
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+
+        float near[EMBEDDING_DIMENSION] = {0};
+        float far[EMBEDDING_DIMENSION] = {0};
+        near[0] = 1.0f;
+        far[1] = 1.0f;
+
+        vectordb_index_file(db, "/test/hybrid/notes.txt", "notes.txt", FILE_TYPE_TEXT, 1, 1, near);
+        vectordb_index_file(db, "/test/hybrid/parser.c", "parser.c", FILE_TYPE_CODE, 1, 1, far);
+        vectordb_index_file(db, "/test/hybrid/invoice_2024.pdf", "invoice_2024.pdf", FILE_TYPE_DOCUMENT, 1, 1, far);
+        TEST_ASSERT_EQ(VECTORDB_STATUS_OK,
+                       vectordb_set_text(db, "/test/hybrid/parser.c", "static int parse_config_block(void);"),
+                       "Should store extracted text");
+        TEST_ASSERT_EQ(VECTORDB_STATUS_NOT_FOUND, vectordb_set_text(db, "/test/hybrid/missing.c", "x"),
+                       "Text needs an indexed file");
+
+        if (vectordb_has_fulltext(db)) {
+            VectorSearchResults results = vectordb_search_hybrid(db, near, "parse_config_block", NULL, 10, 0);
+            TEST_ASSERT(results.count >= 2 && strcmp(results.results[0].file.path, "/test/hybrid/parser.c") == 0 &&
+                        results.results[0].text_match,
+                        "Identifier in the text should rank its file first");
+            bool notes_listed = false;
+            for (int i = 0; i < results.count; i++) {
+                notes_listed = notes_listed || strcmp(results.results[i].file.path, "/test/hybrid/notes.txt") == 0;
+            }
+            TEST_ASSERT(notes_listed, "Vector match should still be listed");
+            vector_search_results_free(&results);
+
+            results = vectordb_search_hybrid(db, near, "invo", "/test/hybrid/", 10, 0);
+            TEST_ASSERT(results.count >= 1 && strcmp(results.results[0].file.path, "/test/hybrid/invoice_2024.pdf") == 0,
+                        "Word being typed should match a file name by prefix");
+            vector_search_results_free(&results);
+
+            vectordb_delete_file(db, "/test/hybrid/parser.c");
+            results = vectordb_search_hybrid(db, near, "parse_config_block", NULL, 10, 0);
+            bool parser_listed = false;
+            for (int i = 0; i < results.count; i++) {
+                parser_listed = parser_listed || results.results[i].text_match;
+            }
+            TEST_ASSERT(!parser_listed, "Deleted file should leave the full-text index");
+            vector_search_results_free(&results);
+        }
+
+        VectorSearchResults results = vectordb_search_hybrid(db, near, "\"*()", NULL, 10, 0);
+        TEST_ASSERT(results.count >= 1 && strcmp(results.results[0].file.path, "/test/hybrid/notes.txt") == 0,
+                    "Query without words should search by vector alone");
+        vector_search_results_free(&results);
+
+        vectordb_delete_directory(db, "/test/hybrid/");
+        vectordb_close(db);
+    }
+
+    // Test: file type from extension
+    {
+        TEST_ASSERT_EQ(FILE_TYPE_TEXT, vectordb_file_type_from_extension("txt"),
+                       "Should detect text file");
+        TEST_ASSERT_EQ(FILE_TYPE_CODE, vectordb_file_type_from_extension("c"),
+                       "Should detect code file");
+        TEST_ASSERT_EQ(FILE_TYPE_IMAGE, vectordb_file_type_from_extension("jpg"),
+                       "Should detect image file");
+        TEST_ASSERT_EQ(FILE_TYPE_DOCUMENT, vectordb_file_type_from_extension("pdf"),
+                       "Should detect document file");
+        TEST_ASSERT_EQ(FILE_TYPE_UNKNOWN, vectordb_file_type_from_extension("xyz"),
+                       "Should return unknown for unknown extension");
+    }
+
+    // Cleanup
+    unlink(TEST_DB_PATH);
+}
+
+// Test indexer
+static void test_indexer(void)
+{
+    printf("\n  [Indexer Tests]\n");
+
+    setup_test_dir();
+    unlink(TEST_DB_PATH);
+
+    // Test: create indexer
+    {
+        Indexer *indexer = indexer_create();
+        TEST_ASSERT(indexer != NULL, "Should create indexer");
+        TEST_ASSERT_EQ(INDEXER_STATUS_STOPPED, indexer_get_status(indexer),
+                       "Should be stopped initially");
+        indexer_destroy(indexer);
+    }
+
+    // Test: default config
+    {
+        IndexerConfig config = indexer_get_default_config();
+        TEST_ASSERT(config.recursive, "Should be recursive by default");
+        TEST_ASSERT(!config.index_hidden_files, "Should not index hidden files by default");
+        TEST_ASSERT(config.max_file_size_mb > 0, "Should have max file size set");
+        TEST_ASSERT(config.ocr, "Should recognize the text of images and scans by default");
+    }
+
+    // Test: add watch directory
+    {
+        Indexer *indexer = indexer_create();
+        bool added = indexer_add_watch_dir(indexer, TEST_DIR_PATH);
+        TEST_ASSERT(added, "Should add watch directory");
+        indexer_destroy(indexer);
+    }
+
+    // Test: add exclude pattern
+    {
+        Indexer *indexer = indexer_create();
+        bool added = indexer_add_exclude_pattern(indexer, "*.log");
+        TEST_ASSERT(added, "Should add exclude pattern");
+        indexer_destroy(indexer);
+    }
+
+    // Test: start without vectordb fails
+    {
+        Indexer *indexer = indexer_create();
+        indexer_add_watch_dir(indexer, TEST_DIR_PATH);
+        bool started = indexer_start(indexer);
+        TEST_ASSERT(!started, "Should not start without vectordb");
+        indexer_destroy(indexer);
+    }
+
+    // Test: start with vectordb
+    {
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+        Indexer *indexer = indexer_create();
+
+        indexer_set_vectordb(indexer, db);
+        indexer_add_watch_dir(indexer, TEST_DIR_PATH);
+
+        bool started = indexer_start(indexer);
+        TEST_ASSERT(started, "Should start with vectordb");
+
+        // Wait briefly for indexing
+        usleep(100000);  // 100ms
+
+        IndexerStats stats = indexer_get_stats(indexer);
+        TEST_ASSERT(stats.files_indexed >= 0, "Should have stats");
+        TEST_ASSERT(stats.write.processed <= stats.read.processed &&
+                    stats.read.processed <= stats.scan.processed, "Stages should never overtake the scan");
+
+        indexer_stop(indexer);
+        indexer_destroy(indexer);
+        vectordb_close(db);
+    }
+
+    // Test: skip reasons, stage latencies and the metrics file
+    {
+        char cmd[512];
+        snprintf(cmd, sizeof(cmd), "echo 'debug' > %s/trace.log && echo 'hidden' > %s/.secret", TEST_DIR_PATH, TEST_DIR_PATH);
+        system(cmd);
+        unlink(TEST_DB_PATH);
+
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+        Indexer *indexer = indexer_create();
+        indexer_set_vectordb(indexer, db);
+        indexer_add_watch_dir(indexer, TEST_DIR_PATH);
+        indexer_start(indexer);
+        indexer_wait(indexer);
+        indexer_stop(indexer);
+
+        IndexerStats stats = indexer_get_stats(indexer);
+        TEST_ASSERT_EQ(3, stats.files_indexed, "Should index the three text files");
+        TEST_ASSERT_EQ(2, stats.skipped.excluded, "Should count the hidden and the excluded file");
+        TEST_ASSERT_EQ(3, stats.read_latency.count, "Should time every file read");
+        TEST_ASSERT(stats.write_latency.count >= 1, "Should time the write transactions");
+        TEST_ASSERT(indexer_latency_percentile(&stats.read_latency, 0.5f) > 0.0, "Should report a read percentile");
+
+        // A second pass finds nothing changed
+        indexer_destroy(indexer);
+        indexer = indexer_create();
+        indexer_set_vectordb(indexer, db);
+        indexer_add_watch_dir(indexer, TEST_DIR_PATH);
+        indexer_start(indexer);
+        indexer_wait(indexer);
+        indexer_stop(indexer);
+        stats = indexer_get_stats(indexer);
+        TEST_ASSERT_EQ(3, stats.skipped.unchanged, "Should count unchanged files");
+        TEST_ASSERT_EQ(stats.files_skipped, stats.skipped.unchanged + stats.skipped.failed,
+                       "Skip reasons should add up");
+
+        const char *metrics = "/tmp/test_indexer_metrics.jsonl";
+        unlink(metrics);
+        TEST_ASSERT(indexer_write_metrics(&stats, metrics), "Should write metrics");
+        TEST_ASSERT(indexer_write_metrics(&stats, metrics), "Should append metrics");
+        FILE *file = fopen(metrics, "r");
+        int lines = 0;
+        char line[4096];
+        while (file && fgets(line, sizeof(line), file)) {
+            lines += strstr(line, "\"unchanged\":3") != NULL ? 1 : 0;
+        }
+        if (file) fclose(file);
+        TEST_ASSERT_EQ(2, lines, "Should append one JSON line per call");
+        unlink(metrics);
+
+        indexer_destroy(indexer);
+        vectordb_close(db);
+        setup_test_dir();
+    }
+
+    // Test: pause and resume
+    {
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+        Indexer *indexer = indexer_create();
+
+        indexer_set_vectordb(indexer, db);
+        indexer_add_watch_dir(indexer, TEST_DIR_PATH);
+        indexer_start(indexer);
+
+        indexer_pause(indexer);
+        TEST_ASSERT_EQ(INDEXER_STATUS_PAUSED, indexer_get_status(indexer),
+                       "Should be paused");
+
+        indexer_resume(indexer);
+        TEST_ASSERT_EQ(INDEXER_STATUS_RUNNING, indexer_get_status(indexer),
+                       "Should be running after resume");
+
+        indexer_stop(indexer);
+        indexer_destroy(indexer);
+        vectordb_close(db);
+    }
+
+    cleanup_test_files();
+}
+
+// Test text extraction and section splitting
+static void test_content_extract(void)
+{
+    printf("\n  [Content Extraction Tests]\n");
+
+    ContentChunk chunks[CONTENT_MAX_CHUNKS];
+
+    // Test: binary sniffing
+    {
+        TEST_ASSERT(content_is_text("plain text\n", 11), "Text should pass");
+        TEST_ASSERT(!content_is_text("PK\x03\x04\0\0data", 10), "NUL bytes should mark binary");
+        TEST_ASSERT(!content_is_text("\x01\x02\x03\x04" "abc", 7), "Control bytes should mark binary");
+    }
+
+    // Test: format selection
+    {
+        TEST_ASSERT_EQ(CONTENT_FORMAT_CODE, content_format_for_file("c", true), "Code splits by definition");
+        TEST_ASSERT_EQ(CONTENT_FORMAT_MARKDOWN, content_format_for_file("MD", false), "Markdown splits by heading");
+        TEST_ASSERT_EQ(CONTENT_FORMAT_PLAIN, content_format_for_file("txt", false), "Text splits by paragraph");
+    }
+
+    // Test: short text is one section
+    {
+        const char *text = "# Title\nShort note.\n";
+        int count = content_split(text, strlen(text), CONTENT_FORMAT_MARKDOWN, chunks, CONTENT_MAX_CHUNKS);
+        TEST_ASSERT_EQ(1, count, "Short text should be one section");
+        TEST_ASSERT(count == 1 && chunks[0].offset == 0 && chunks[0].length == strlen(text),
+                    "Section should cover the text");
+    }
+
+    // Test: markdown sections start at headings, not inside code fences
+    {
+        static char text[16384];
+        text[0] = '\0';
+        const char *headings[] = { "# Install", "## Usage", "## Internals" };
+        for (int h = 0; h < 3; h++) {
+            strcat(text, headings[h]);
+            strcat(text, "\n\n```\n# not a heading\n```\n");
+            for (int i = 0; i < 25; i++) {
+                strcat(text, "A sentence of body text that fills this section. ");
+            }
+            strcat(text, "\n\n");
+        }
+
+        int count = content_split(text, strlen(text), CONTENT_FORMAT_MARKDOWN, chunks, CONTENT_MAX_CHUNKS);
+        TEST_ASSERT_EQ(3, count, "Should split at each heading");
+        TEST_ASSERT(count == 3 && strcmp(chunks[1].title, "Usage") == 0, "Title should be the heading text");
+        TEST_ASSERT(count == 3 && strncmp(text + chunks[2].offset, "## Internals", 12) == 0,
+                    "Section should start at its heading");
+    }
+
+    // Test: code sections start at definitions, with their doc comments
+    {
+        static char text[16384];
+        text[0] = '\0';
+        for (int f = 0; f < 6; f++) {
+            char function[1024];
+            snprintf(function, sizeof(function),
+                     "// Helper number %d\nstatic int helper_%d(int x)\n{\n", f, f);
+            strcat(text, function);
+            for (int i = 0; i < 12; i++) {
+                strcat(text, "    x = x * 31 + 7; /* a line of arithmetic padding */\n");
+            }
+            strcat(text, "    return x;\n}\n\n");
+        }
+
+        int count = content_split(text, strlen(text), CONTENT_FORMAT_CODE, chunks, CONTENT_MAX_CHUNKS);
+        TEST_ASSERT(count > 1, "Long code should be split");
+        bool at_comments = true;
+        for (int i = 0; i < count; i++) {
+            at_comments = at_comments && strncmp(text + chunks[i].offset, "// Helper", 9) == 0 &&
+                          strncmp(chunks[i].title, "static int helper_", 18) == 0;
+        }
+        TEST_ASSERT(at_comments, "Sections should start at a doc comment, titled by the definition");
+    }
+
+    // Test: long paragraphs become overlapping windows
+    {
+        static char text[20000];
+        text[0] = '\0';
+        for (int i = 0; i < 300; i++) {
+            strcat(text, "word word word word word word word word word word. ");
+        }
+        size_t size = strlen(text);
+
+        int count = content_split(text, size, CONTENT_FORMAT_PLAIN, chunks, CONTENT_MAX_CHUNKS);
+        TEST_ASSERT(count > 1, "Long text should be cut");
+        bool bounded = true;
+        bool overlapping = true;
+        for (int i = 0; i < count; i++) {
+            bounded = bounded && chunks[i].length <= CONTENT_CHUNK_MAX;
+            if (i > 0) {
+                overlapping = overlapping && chunks[i].offset < chunks[i - 1].offset + chunks[i - 1].length;
+            }
+        }
+        TEST_ASSERT(bounded, "Windows should stay under the maximum");
+        TEST_ASSERT(overlapping, "Windows should overlap");
+        TEST_ASSERT(count > 0 && chunks[count - 1].offset + chunks[count - 1].length == size,
+                    "Windows should reach the end");
+
+        TEST_ASSERT_EQ(2, content_split(text, size, CONTENT_FORMAT_PLAIN, chunks, 2), "Should respect max_chunks");
+    }
+
+    // Test: mapped files
+    {
+        const char *path = "/tmp/test_content_extract.txt";
+        FILE *f = fopen(path, "w");
+        fputs("First paragraph.\n\nSecond paragraph.\n", f);
+        fclose(f);
+
+        ContentMap map;
+        TEST_ASSERT(content_map_open(path, &map), "Should map file");
+
+        int count = content_map_split(&map, CONTENT_FORMAT_PLAIN, chunks, CONTENT_MAX_CHUNKS);
+        TEST_ASSERT_EQ(1, count, "Short file should be one section");
+
+        char text[64];
+        TEST_ASSERT(count == 1 && content_map_copy(&map, &chunks[0], text, sizeof(text)) &&
+                    strcmp(text, "First paragraph.\n\nSecond paragraph.\n") == 0, "Should copy the section");
+
+        uint64_t mapped_hash = 0;
+        uint64_t file_hash = 1;
+        TEST_ASSERT(content_map_hash(&map, &mapped_hash) && file_hash_compute(path, &file_hash) &&
+                    mapped_hash == file_hash, "Mapped hash should match the file hash");
+        content_map_close(&map);
+
+        f = fopen(path, "wb");
+        fwrite("\x7f" "ELF\0\0\0\0", 1, 8, f);
+        fclose(f);
+        TEST_ASSERT(content_map_open(path, &map), "Should map binary file");
+        TEST_ASSERT_EQ(-1, content_map_split(&map, CONTENT_FORMAT_PLAIN, chunks, CONTENT_MAX_CHUNKS),
+                       "Binary file should not be split");
+        content_map_close(&map);
+
+        unlink(path);
+        TEST_ASSERT(!content_map_open(path, &map), "Missing file should not map");
+    }
+
+    // Test: PDF text in place of a mapping
+    {
+        const char *path = "/tmp/test_content_extract.pdf";
+        const char *objects[] = {
+            "<< /Type /Catalog /Pages 2 0 R >>",
+            "<< /Type /Pages /Kids [3 0 R] /Count 1 >>",
+            "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 300 200] /Contents 4 0 R "
+            "/Resources << /Font << /F1 5 0 R >> >> >>",
+            "<< /Length 40 >>\nstream\nBT /F1 18 Tf 20 100 Td (Hello PDF) Tj ET\nendstream",
+            "<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica >>",
+        };
+        FILE *f = fopen(path, "wb");
+        long offsets[5];
+        fputs("%PDF-1.4\n", f);
+        for (int i = 0; i < 5; i++) {
+            offsets[i] = ftell(f);
+            fprintf(f, "%d 0 obj\n%s\nendobj\n", i + 1, objects[i]);
+        }
+        long xref = ftell(f);
+        fputs("xref\n0 6\n0000000000 65535 f \n", f);
+        for (int i = 0; i < 5; i++) {
+            fprintf(f, "%010ld 00000 n \n", offsets[i]);
+        }
+        fprintf(f, "trailer\n<< /Size 6 /Root 1 0 R >>\nstartxref\n%ld\n%%%%EOF\n", xref);
+        fclose(f);
+
+        ContentMap map;
+        TEST_ASSERT(content_map_open_document(path, &map), "Should take the text of a PDF");
+        TEST_ASSERT(map.owned && map.size > 0 && strstr(map.data, "Hello PDF") != NULL,
+                    "PDF text should hold the page's words");
+        TEST_ASSERT(content_map_split(&map, CONTENT_FORMAT_PLAIN, chunks, CONTENT_MAX_CHUNKS) >= 1,
+                    "PDF text should split like a text file");
+        content_map_close(&map);
+        TEST_ASSERT(map.data == NULL, "Closing should free the PDF text");
+
+        unlink(path);
+        TEST_ASSERT(!content_map_open_document(path, &map), "Missing PDF should have no text");
+    }
+
+    // Test: text recognition skips what it cannot read
+    {
+        const char *paths[] = { "/tmp/test_content_extract_missing.png", NULL };
+        char *texts[2];
+        size_t lengths[2];
+        TEST_ASSERT_EQ(0, platform_ocr_images(paths, 2, true, 4096, texts, lengths),
+                       "Unreadable images should have no text");
+        TEST_ASSERT(texts[0] == NULL && texts[1] == NULL, "Unreadable images should get no text buffer");
+        char *text = NULL;
+        TEST_ASSERT(!platform_ocr_pdf("/tmp/test_content_extract_missing.pdf", 4, true, 4096, &text, NULL) &&
+                    text == NULL, "Missing scan should have no text");
+    }
+}
+
+// Test document extraction in worker processes
+static void test_extract_pool(void)
+{
+    printf("  Testing extractor pool...\n");
+
+    const char *path = "/tmp/test_extract_pool.rtf";
+    FILE *f = fopen(path, "w");
+    fputs("{\\rtf1\\ansi{\\fonttbl\\f0 Helvetica;}\\f0 Quarterly pipeline review\\par}", f);
+    fclose(f);
+
+    TEST_ASSERT(extract_pool_handles(path) && extract_pool_handles("/tmp/report.PDF") &&
+                extract_pool_handles("/tmp/letter.docx"), "Pool should take PDF, Word and RTF");
+    TEST_ASSERT(!extract_pool_handles("/tmp/notes.txt") && !extract_pool_handles("/tmp/pdf"),
+                "Pool should leave other files");
+
+    // Workers are this test runner, started with EXTRACT_WORKER_ARG
+    ExtractPoolConfig config;
+    extract_pool_default_config(&config);
+    config.max_workers = 2;
+    config.max_jobs = 2;
+    TEST_ASSERT(extract_pool_start(&config), "Pool should start with this executable");
+
+    char *text = NULL;
+    size_t length = 0;
+    bool ok = extract_pool_text(path, 4096, &text, &length);
+    TEST_ASSERT(ok && text != NULL && strstr(text, "Quarterly pipeline review") != NULL &&
+                length == strlen(text), "Worker should return the document's text");
+    free(text);
+
+    ExtractPoolStats stats;
+    extract_pool_get_stats(&stats);
+    TEST_ASSERT(stats.started == 1 && stats.workers == 1 && stats.documents == 1,
+                "One worker should read the first document");
+
+    for (int i = 0; i < 3; i++) {
+        text = NULL;
+        extract_pool_text(path, 4096, &text, NULL);
+        free(text);
+    }
+    extract_pool_get_stats(&stats);
+    TEST_ASSERT(stats.documents == 4 && stats.replaced == 2 && stats.failed == 0 && stats.workers == 0,
+                "Workers should be replaced after their share of documents");
+
+    TEST_ASSERT(!extract_pool_text("/tmp/test_extract_pool_missing.pdf", 4096, &text, NULL) && text == NULL,
+                "Missing document should have no text");
+    extract_pool_stop();
+    extract_pool_get_stats(&stats);
+    TEST_ASSERT(stats.workers == 0, "Stopping should end the workers");
+
+    // A worker that dies mid-document takes only that document with it
+    strcpy(config.worker_path, "/usr/bin/false");
+    extract_pool_start(&config);
+    TEST_ASSERT(!extract_pool_text(path, 4096, &text, NULL), "Document of a dead worker should be skipped");
+    extract_pool_get_stats(&stats);
+    TEST_ASSERT(stats.failed == 1 && stats.workers == 0, "Dead worker should be counted and cleared");
+    extract_pool_stop();
+
+    unlink(path);
+}
+
+// Test indexer work queue
+#define INBOX_TEST_THREADS 4
+#define INBOX_TEST_POSTS 500
+
+static void* inbox_post_thread(void *arg)
+{
+    IndexInbox *inbox = (IndexInbox *)arg;
+    char path[64];
+    for (int i = 0; i < INBOX_TEST_POSTS; i++) {
+        snprintf(path, sizeof(path), "/t/%p/%d", (void *)&path, i);
+        index_inbox_post(inbox, path, (double)i, 0, INBOX_TEST_THREADS * INBOX_TEST_POSTS);
+    }
+    return NULL;
+}
+
+static void test_index_inbox(void)
+{
+    printf("\n  [Index Inbox Tests]\n");
+
+    // Test: items come out oldest first; the limit is enforced
+    {
+        IndexInbox inbox;
+        index_inbox_init(&inbox);
+        TEST_ASSERT(index_inbox_take(&inbox) == NULL, "Empty inbox should give nothing");
+        TEST_ASSERT(index_inbox_post(&inbox, "/a", 1.0, 2.0, 2), "Should post first path");
+        TEST_ASSERT(index_inbox_post(&inbox, "/b", 1.5, 0.0, 2), "Should post second path");
+        TEST_ASSERT(!index_inbox_post(&inbox, "/c", 2.0, 0.0, 2), "Should refuse past the limit");
+        TEST_ASSERT_EQ(2, index_inbox_count(&inbox), "Should count two posted paths");
+
+        IndexInboxItem *item = index_inbox_take(&inbox);
+        TEST_ASSERT(item != NULL && strcmp(item->path, "/a") == 0 && item->delay == 2.0,
+                    "Should take the oldest first");
+        TEST_ASSERT(item != NULL && item->next != NULL && strcmp(item->next->path, "/b") == 0,
+                    "Should take the newer one after it");
+        TEST_ASSERT_EQ(0, index_inbox_count(&inbox), "Should be empty after taking");
+        while (item != NULL) {
+            IndexInboxItem *next = item->next;
+            free(item);
+            item = next;
+        }
+        index_inbox_clear(&inbox);
+    }
+
+    // Test: concurrent posters lose nothing
+    {
+        IndexInbox inbox;
+        index_inbox_init(&inbox);
+        pthread_t threads[INBOX_TEST_THREADS];
+        for (int i = 0; i < INBOX_TEST_THREADS; i++) {
+            pthread_create(&threads[i], NULL, inbox_post_thread, &inbox);
+        }
+
+        int taken = 0;
+        for (int done = 0; done <= INBOX_TEST_THREADS; ) {
+            IndexInboxItem *item = index_inbox_take(&inbox);
+            while (item != NULL) {
+                IndexInboxItem *next = item->next;
+                free(item);
+                item = next;
+                taken++;
+            }
+            if (done < INBOX_TEST_THREADS) {
+                pthread_join(threads[done], NULL);
+            }
+            done++;
+        }
+        IndexInboxItem *rest = index_inbox_take(&inbox);
+        TEST_ASSERT(rest == NULL, "Should have taken everything");
+        TEST_ASSERT_EQ(INBOX_TEST_THREADS * INBOX_TEST_POSTS, taken, "Should receive every posted path");
+    }
+}
+
+static void test_index_governor(void)
+{
+    printf("\n  [Index Governor Tests]\n");
+
+    IndexGovernorInput idle = {0};
+    idle.load.battery_percent = -1;
+    idle.idle_seconds = 600.0;
+    idle.frame_time_p95 = 1.0 / 60.0;
+    idle.frame_budget = 1.0 / 60.0;
+
+    // Test: idle machine on power runs at full speed
+    {
+        IndexGovernor governor;
+        index_governor_init(&governor, 8);
+        IndexerThrottle throttle = index_governor_update(&governor, &idle, 100.0);
+        TEST_ASSERT_EQ(8, throttle.embed_threads, "Should use every thread when idle");
+        TEST_ASSERT_EQ(0, throttle.batch_delay_ms, "Should not pause when idle");
+        TEST_ASSERT(!throttle.background, "Should not be background when idle");
+    }
+
+    // Test: user input moves indexing to background at once
+    {
+        IndexGovernor governor;
+        index_governor_init(&governor, 8);
+        IndexGovernorInput input = idle;
+        input.idle_seconds = 0.5;
+        IndexerThrottle throttle = index_governor_update(&governor, &input, 100.0);
+        TEST_ASSERT(throttle.background, "Should be background while user is active");
+        TEST_ASSERT(throttle.embed_threads < 8, "Should use fewer threads while user is active");
+    }
+
+    // Test: thermal pressure and battery
+    {
+        IndexGovernor governor;
+        index_governor_init(&governor, 8);
+        IndexGovernorInput input = idle;
+        input.load.thermal = PLATFORM_THERMAL_CRITICAL;
+        TEST_ASSERT_EQ(INDEX_GOVERNOR_LEVELS - 1, index_governor_target(&governor, &input),
+                       "Critical thermal state should crawl");
+
+        input = idle;
+        input.load.on_battery = true;
+        input.load.battery_percent = 80;
+        int on_battery = index_governor_target(&governor, &input);
+        input.load.battery_percent = 10;
+        TEST_ASSERT(on_battery > 0, "Battery should slow indexing");
+        TEST_ASSERT(index_governor_target(&governor, &input) > on_battery, "Low battery should slow it more");
+    }
+
+    // Test: dropped frames back off; ramp-up is one level per interval
+    {
+        IndexGovernor governor;
+        index_governor_init(&governor, 8);
+        IndexGovernorInput input = idle;
+        input.frame_time_p95 = 0.1;
+        index_governor_update(&governor, &input, 100.0);
+        index_governor_update(&governor, &input, 101.0);
+        TEST_ASSERT_EQ(2, governor.level, "Should back off a level per janky sample");
+
+        index_governor_update(&governor, &idle, 102.0);
+        TEST_ASSERT_EQ(2, governor.level, "Should hold within the ramp interval");
+        index_governor_update(&governor, &idle, 101.0 + INDEX_GOVERNOR_RAMP_SEC);
+        TEST_ASSERT_EQ(1, governor.level, "Should step up one level after the interval");
+
+        IndexGovernorInput busy = idle;
+        busy.load.cpu_load = 0.95f;
+        index_governor_update(&governor, &busy, 200.0);
+        TEST_ASSERT_EQ(1, governor.level, "Should not speed up on a busy machine");
+    }
+}
+
+static void test_compute_budget(void)
+{
+    printf("\n  [Compute Budget Tests]\n");
+
+    int size = compute_budget_size();
+    TEST_ASSERT(size >= 1, "Budget should hold at least one thread");
+
+    // Test: a second engine gets what is left, never less than one thread
+    {
+        int before = compute_budget_in_use();
+        int text = compute_budget_acquire(size);
+        TEST_ASSERT_EQ(size - before > 0 ? size - before : 1, text, "First caller should get what is free");
+        int image = compute_budget_acquire(4);
+        TEST_ASSERT_EQ(1, image, "Spent budget should still grant one thread");
+        compute_budget_release(image);
+        compute_budget_release(text);
+        TEST_ASSERT_EQ(before, compute_budget_in_use(), "Release should return every thread");
+
+        int small = compute_budget_acquire(0);
+        TEST_ASSERT_EQ(1, small, "Should grant one thread for a zero request");
+        compute_budget_release(small);
+    }
+}
+
+// Counting encoder for the query cache tests: [length, first character]
+static int g_query_encodes = 0;
+
+static bool count_query_encode(void *context, const char *text, float *out)
+{
+    (void)context;
+    g_query_encodes++;      // Read after the cache lock publishes the result
+    out[0] = (float)strlen(text);
+    out[1] = (float)text[0];
+    return true;
+}
+
+static void test_query_cache(void)
+{
+    printf("\n  [Query Cache Tests]\n");
+
+    float vector[2];
+
+    // Test: a repeated query is encoded once; the least recently used one is dropped
+    {
+        g_query_encodes = 0;
+        QueryCache *cache = query_cache_create(2, 2, count_query_encode, NULL);
+        TEST_ASSERT(cache != NULL, "Should create query cache");
+
+        TEST_ASSERT(query_cache_encode(cache, "beach", vector), "Should encode a new query");
+        TEST_ASSERT(query_cache_encode(cache, "beach", vector), "Should return a cached query");
+        TEST_ASSERT_EQ(1, g_query_encodes, "Cached query should not be encoded again");
+        TEST_ASSERT(vector[0] == 5.0f && vector[1] == 'b', "Cached embedding should match");
+
+        query_cache_encode(cache, "dogs", vector);
+        query_cache_lookup(cache, "beach", vector);
+        query_cache_encode(cache, "invoice", vector);
+        TEST_ASSERT_EQ(2, query_cache_count(cache), "Cache should stay at capacity");
+        TEST_ASSERT(query_cache_contains(cache, "beach"), "Recently used query should stay");
+        TEST_ASSERT(!query_cache_contains(cache, "dogs"), "Least recently used query should go");
+
+        query_cache_clear(cache);
+        TEST_ASSERT_EQ(0, query_cache_count(cache), "Clear should empty the cache");
+        query_cache_destroy(cache);
+    }
+
+    // Test: prefetch encodes the last text once typing pauses
+    {
+        g_query_encodes = 0;
+        QueryCache *cache = query_cache_create(2, QUERY_CACHE_CAPACITY, count_query_encode, NULL);
+        query_cache_prefetch(cache, "su");
+        query_cache_prefetch(cache, "sun");
+        query_cache_prefetch(cache, "sunset");
+        TEST_ASSERT(!query_cache_contains(cache, "sunset"), "Prefetch should wait out the debounce");
+
+        for (int i = 0; i < 100 && !query_cache_contains(cache, "sunset"); i++) {
+            usleep(20000);
+        }
+        TEST_ASSERT(query_cache_contains(cache, "sunset"), "Prefetched query should be cached");
+        TEST_ASSERT(!query_cache_contains(cache, "sun"), "Replaced prefetch should not be encoded");
+
+        TEST_ASSERT(query_cache_encode(cache, "sunset", vector), "Should use the prefetched query");
+        TEST_ASSERT_EQ(1, g_query_encodes, "Only the last text should be encoded");
+
+        // Destroy stops the thread with a prefetch still waiting
+        query_cache_prefetch(cache, "pending");
+        query_cache_destroy(cache);
+    }
+}
+
+static void test_wordpiece(void)
+{
+    printf("\n  [WordPiece Tests]\n");
+
+    static const char *vocab[] = {
+        "[PAD]", "[UNK]", "[CLS]", "[SEP]", "hello", "world", "##s", "un", "##aff", "##able", ",", "cafe", "the"
+    };
+    int vocab_count = (int)(sizeof(vocab) / sizeof(vocab[0]));
+    int32_t ids[16];
+
+    // Test: words split on punctuation, matched longest piece first, [UNK] when unmatched
+    {
+        WordPiece *wp = wordpiece_create(vocab, vocab_count, 512);
+        TEST_ASSERT(wp != NULL, "Should build tokenizer");
+
+        const char *text = "Hello, worlds!";
+        int count = wordpiece_tokenize(wp, text, strlen(text), ids, 16);
+        int32_t expected[] = { 2, 4, 10, 5, 6, 1, 3 };
+        TEST_ASSERT_EQ(7, count, "Should tokenize into [CLS], pieces and [SEP]");
+        TEST_ASSERT(count == 7 && memcmp(ids, expected, sizeof(expected)) == 0, "Should match the expected ids");
+
+        text = "unaffable xyz";
+        count = wordpiece_tokenize(wp, text, strlen(text), ids, 16);
+        TEST_ASSERT(count == 6 && ids[1] == 7 && ids[2] == 8 && ids[3] == 9, "Should continue words with ## pieces");
+        TEST_ASSERT(count == 6 && ids[4] == 1, "Unmatched word should be [UNK]");
+
+        text = "CAF\xC3\x89";
+        count = wordpiece_tokenize(wp, text, strlen(text), ids, 16);
+        TEST_ASSERT(count == 3 && ids[1] == 11, "Should lowercase and strip accents");
+
+        text = "hello world the hello";
+        count = wordpiece_tokenize(wp, text, strlen(text), ids, 4);
+        TEST_ASSERT(count == 4 && ids[2] == 5 && ids[3] == 3, "Should cut to max_ids and keep [SEP]");
+
+        count = wordpiece_tokenize(wp, "", 0, ids, 16);
+        TEST_ASSERT_EQ(2, count, "Empty text should be [CLS] [SEP]");
+        wordpiece_destroy(wp);
+    }
+
+    // Test: vocabulary read from a bert.cpp model file, sequence length included
+    {
+        const char *model = "/tmp/test_wordpiece.bin";
+        FILE *file = fopen(model, "wb");
+        uint32_t magic = 0x67676d6c;
+        int32_t hparams[7] = { vocab_count, 3, 384, 1536, 12, 6, 1 };
+        fwrite(&magic, sizeof(magic), 1, file);
+        fwrite(hparams, sizeof(hparams), 1, file);
+        for (int i = 0; i < vocab_count; i++) {
+            uint32_t length = (uint32_t)strlen(vocab[i]);
+            fwrite(&length, sizeof(length), 1, file);
+            fwrite(vocab[i], 1, length, file);
+        }
+        fclose(file);
+
+        WordPiece *wp = wordpiece_load(model);
+        TEST_ASSERT(wp != NULL, "Should load vocabulary from model file");
+        TEST_ASSERT_EQ(3, wordpiece_max_tokens(wp), "Should read the sequence length");
+        int count = wordpiece_tokenize(wp, "the world", 9, ids, 16);
+        TEST_ASSERT(count == 3 && ids[1] == 12, "Should cut to the model's sequence length");
+        wordpiece_destroy(wp);
+
+        TEST_ASSERT(wordpiece_load("/tmp/test_wordpiece_missing.bin") == NULL, "Missing model should fail");
+        unlink(model);
+    }
+}
+
+static void test_index_queue(void)
+{
+    printf("\n  [Index Queue Tests]\n");
+
+    char path[256];
+
+    // Test: duplicates merge, capacity is a hard limit
+    {
+        IndexQueue *queue = index_queue_create(2);
+        TEST_ASSERT(queue != NULL, "Should create queue");
+        TEST_ASSERT_EQ(INDEX_QUEUE_ADDED, index_queue_push(queue, "/a/1.txt", 0, 0), "Should add new path");
+        TEST_ASSERT_EQ(INDEX_QUEUE_MERGED, index_queue_push(queue, "/a/1.txt", 0, 0), "Should merge queued path");
+        TEST_ASSERT_EQ(INDEX_QUEUE_ADDED, index_queue_push(queue, "/a/2.txt", 0, 0), "Should add second path");
+        TEST_ASSERT_EQ(INDEX_QUEUE_FULL, index_queue_push(queue, "/a/3.txt", 0, 0), "Should refuse past capacity");
+        TEST_ASSERT_EQ(2, index_queue_count(queue), "Should hold two paths");
+
+        TEST_ASSERT(index_queue_pop(queue, 0, path, sizeof(path)) && strcmp(path, "/a/1.txt") == 0,
+                    "Should pop in order");
+        TEST_ASSERT_EQ(INDEX_QUEUE_ADDED, index_queue_push(queue, "/a/3.txt", 0, 0), "Should reuse freed slot");
+        TEST_ASSERT_EQ(INDEX_QUEUE_FULL, index_queue_push(queue, "/a/4.txt", 0, 0), "Should be full again");
+        index_queue_destroy(queue);
+    }
+
+    // Test: files in visible folders jump the queue
+    {
+        IndexQueue *queue = index_queue_create(16);
+        index_queue_push(queue, "/a/1.txt", 0, 0);
+        index_queue_push(queue, "/b/1.txt", 0, 0);
+        index_queue_push(queue, "/b/sub/1.txt", 0, 0);
+
+        const char *visible[] = { "/b/" };
+        index_queue_set_visible(queue, visible, 1);
+        index_queue_push(queue, "/b/2.txt", 0, 0);
+
+        TEST_ASSERT(index_queue_pop(queue, 0, path, sizeof(path)) && strcmp(path, "/b/1.txt") == 0,
+                    "Visible file should come first");
+        TEST_ASSERT(index_queue_pop(queue, 0, path, sizeof(path)) && strcmp(path, "/b/2.txt") == 0,
+                    "Newly queued visible file should come next");
+        TEST_ASSERT(index_queue_pop(queue, 0, path, sizeof(path)) && strcmp(path, "/a/1.txt") == 0,
+                    "Then the rest in order");
+        TEST_ASSERT(index_queue_pop(queue, 0, path, sizeof(path)) && strcmp(path, "/b/sub/1.txt") == 0,
+                    "Subfolders should not count as visible");
+        TEST_ASSERT(!index_queue_pop(queue, 0, path, sizeof(path)), "Should be empty");
+        index_queue_destroy(queue);
     }
 
-    // Test: delete file
+    // Test: delayed paths wait until they settle, but not forever
     {
-        VectorDB *db = vectordb_open(TEST_DB_PATH);
+        IndexQueue *queue = index_queue_create(16);
+        index_queue_push(queue, "/a/hot.log", 0, 2.0);
+        TEST_ASSERT(!index_queue_pop(queue, 1.0, path, sizeof(path)), "Should not pop before due");
+        TEST_ASSERT(fabs(index_queue_next_due(queue, 1.0) - 1.0) < 1e-9, "Should report time until due");
 
-        VectorDBStatus status = vectordb_delete_file(db, "/test/path/file.txt");
-        TEST_ASSERT_EQ(VECTORDB_STATUS_OK, status, "Should delete file");
+        index_queue_push(queue, "/a/hot.log", 1.5, 2.0);
+        TEST_ASSERT(!index_queue_pop(queue, 3.0, path, sizeof(path)), "Change should restart the delay");
 
-        IndexedFile file;
-        status = vectordb_get_file(db, "/test/path/file.txt", &file);
-        TEST_ASSERT_EQ(VECTORDB_STATUS_NOT_FOUND, status, "Deleted file should not exist");
+        for (double t = 3.0; t < INDEX_QUEUE_MAX_DEFER + 5; t += 1.0) {
+            index_queue_push(queue, "/a/hot.log", t, 2.0);
+        }
+        TEST_ASSERT(index_queue_pop(queue, INDEX_QUEUE_MAX_DEFER, path, sizeof(path)),
+                    "Should pop once the maximum deferral has passed");
+        TEST_ASSERT(index_queue_next_due(queue, 0) < 0, "Nothing should be waiting");
+        index_queue_destroy(queue);
+    }
+}
 
-        vectordb_close(db);
+// Helper: write a file below the ignore rules fixture
+static void write_fixture(const char *root, const char *name, const char *content)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", root, name);
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fputs(content, f);
+        fclose(f);
     }
+}
 
-    // Test: count and total size
+// Test .gitignore, .ignore and cache marker rules
+static void test_ignore_rules(void)
+{
+    printf("\n  [Ignore Rules Tests]\n");
+
+    // Paths are compared as git reports them, so the fixture lives at its real path
+    char root[1024];
+    system("rm -rf /tmp/test_ai_ignore && mkdir -p /tmp/test_ai_ignore/repo/.git/info "
+           "/tmp/test_ai_ignore/repo/app /tmp/test_ai_ignore/repo/src/x/gen "
+           "/tmp/test_ai_ignore/repo/target/debug /tmp/test_ai_ignore/repo/cache /tmp/test_ai_ignore/plain");
+    if (!realpath("/tmp/test_ai_ignore", root)) {
+        TEST_ASSERT(false, "Should create the ignore fixture");
+        return;
+    }
+    write_fixture(root, "repo/.git/HEAD", "ref: refs/heads/main\n");
+    write_fixture(root, "repo/.git/info/exclude", "local.tmp\n");
+    write_fixture(root, "repo/.gitignore", "# build outputs\ntarget/\n*.log\n/dist\nsrc/**/gen\n");
+    write_fixture(root, "repo/.ignore", "secrets.txt\n");
+    write_fixture(root, "repo/app/.gitignore", "!important.log\n");
+    write_fixture(root, "repo/cache/" IGNORE_CACHEDIR_TAG, "Signature: 8a477f597d28d172789f06886806bc55\n# cache\n");
+    write_fixture(root, "repo/keep.txt", "kept");
+    write_fixture(root, "repo/debug.log", "log");
+    write_fixture(root, "repo/target/out.txt", "built");
+    write_fixture(root, "repo/cache/blob.txt", "cached");
+    write_fixture(root, "plain/.gitignore", "*.txt\n");
+    write_fixture(root, "plain/.ignore", "skip.md\n");
+
+    char repo[1100];
+    char app[1100];
+    char x[1100];
+    char plain[1100];
+    char path[1200];
+    snprintf(repo, sizeof(repo), "%s/repo", root);
+    snprintf(app, sizeof(app), "%s/repo/app", root);
+    snprintf(x, sizeof(x), "%s/repo/src/x", root);
+    snprintf(plain, sizeof(plain), "%s/plain", root);
+
+    // Test: names, folders only, anchored patterns and "**"
     {
-        VectorDB *db = vectordb_open(TEST_DB_PATH);
-
-        int64_t count = vectordb_count_files(db);
-        TEST_ASSERT(count >= 0, "Should return valid count");
-
-        int64_t total = vectordb_total_size(db);
-        TEST_ASSERT(total >= 0, "Should return valid total size");
+        IgnoreStack *stack = ignore_stack_create();
+        TEST_ASSERT(ignore_stack_enter(stack, repo), "Should enter the repository");
+
+        snprintf(path, sizeof(path), "%s/target", repo);
+        TEST_ASSERT(ignore_stack_match(stack, path, true), "Folder rule should match a folder");
+        TEST_ASSERT(!ignore_stack_match(stack, path, false), "Folder rule should not match a file");
+        snprintf(path, sizeof(path), "%s/debug.log", repo);
+        TEST_ASSERT(ignore_stack_match(stack, path, false), "Suffix rule should match");
+        snprintf(path, sizeof(path), "%s/keep.txt", repo);
+        TEST_ASSERT(!ignore_stack_match(stack, path, false), "Other files should pass");
+        snprintf(path, sizeof(path), "%s/secrets.txt", repo);
+        TEST_ASSERT(ignore_stack_match(stack, path, false), ".ignore rules should apply");
+        snprintf(path, sizeof(path), "%s/local.tmp", repo);
+        TEST_ASSERT(ignore_stack_match(stack, path, false), "info/exclude rules should apply");
+        snprintf(path, sizeof(path), "%s/dist", repo);
+        TEST_ASSERT(ignore_stack_match(stack, path, true), "Anchored rule should match at its folder");
+
+        TEST_ASSERT(ignore_stack_enter(stack, app), "Should enter a subfolder");
+        snprintf(path, sizeof(path), "%s/dist", app);
+        TEST_ASSERT(!ignore_stack_match(stack, path, true), "Anchored rule should not match below");
+        snprintf(path, sizeof(path), "%s/important.log", app);
+        TEST_ASSERT(!ignore_stack_match(stack, path, false), "Deeper '!' rule should re-include");
+        snprintf(path, sizeof(path), "%s/other.log", app);
+        TEST_ASSERT(ignore_stack_match(stack, path, false), "Shallower rule should still apply");
+
+        TEST_ASSERT(ignore_stack_enter(stack, x), "Should move to another subfolder");
+        snprintf(path, sizeof(path), "%s/gen", x);
+        TEST_ASSERT(ignore_stack_match(stack, path, true), "\"**\" should span folders");
+
+        snprintf(path, sizeof(path), "%s/target/debug", repo);
+        TEST_ASSERT(!ignore_stack_enter(stack, path), "Folder below an ignored one should be ignored");
+        snprintf(path, sizeof(path), "%s/cache", repo);
+        TEST_ASSERT(!ignore_stack_enter(stack, path), "Folder with a cache marker should be ignored");
+        ignore_stack_destroy(stack);
+    }
 
-        vectordb_close(db);
+    // Test: .gitignore counts inside work trees only, .ignore everywhere
+    {
+        IgnoreStack *stack = ignore_stack_create();
+        TEST_ASSERT(ignore_stack_enter(stack, plain), "Should enter a plain folder");
+        snprintf(path, sizeof(path), "%s/notes.txt", plain);
+        TEST_ASSERT(!ignore_stack_match(stack, path, false), ".gitignore outside a repository should not apply");
+        snprintf(path, sizeof(path), "%s/skip.md", plain);
+        TEST_ASSERT(ignore_stack_match(stack, path, false), ".ignore outside a repository should apply");
+        ignore_stack_destroy(stack);
+
+        TEST_ASSERT(ignore_rules_file("/a/.gitignore") && ignore_rules_file("/a/" IGNORE_CACHEDIR_TAG),
+                    "Should know the files that hold rules");
+        TEST_ASSERT(!ignore_rules_file("/a/notes.txt"), "Other files hold no rules");
     }
 
-    // Test: file type from extension
+    // Test: the indexer reads and embeds only what the rules keep
     {
-        TEST_ASSERT_EQ(FILE_TYPE_TEXT, vectordb_file_type_from_extension("txt"),
-                       "Should detect text file");
-        TEST_ASSERT_EQ(FILE_TYPE_CODE, vectordb_file_type_from_extension("c"),
-                       "Should detect code file");
-        TEST_ASSERT_EQ(FILE_TYPE_IMAGE, vectordb_file_type_from_extension("jpg"),
-                       "Should detect image file");
-        TEST_ASSERT_EQ(FILE_TYPE_DOCUMENT, vectordb_file_type_from_extension("pdf"),
-                       "Should detect document file");
-        TEST_ASSERT_EQ(FILE_TYPE_UNKNOWN, vectordb_file_type_from_extension("xyz"),
-                       "Should return unknown for unknown extension");
+        unlink(TEST_DB_PATH);
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+        Indexer *indexer = indexer_create();
+        indexer_set_vectordb(indexer, db);
+        indexer_set_respect_ignore_files(indexer, true);
+        indexer_add_watch_dir(indexer, repo);
+        indexer_start(indexer);
+        indexer_wait(indexer);
+        indexer_stop(indexer);
+
+        IndexerStats stats = indexer_get_stats(indexer);
+        TEST_ASSERT_EQ(1, stats.files_indexed, "Should index only the kept file");
+        indexer_destroy(indexer);
+        vectordb_close(db);
+        unlink(TEST_DB_PATH);
     }
 
-    // Cleanup
-    unlink(TEST_DB_PATH);
+    system("rm -rf /tmp/test_ai_ignore");
 }
 
-// Test indexer
-static void test_indexer(void)
+// Test recursive filename index
+static void test_path_index(void)
 {
-    printf("\n  [Indexer Tests]\n");
+    printf("\n  [Path Index Tests]\n");
 
-    setup_test_dir();
-    unlink(TEST_DB_PATH);
+    const char *index_file = "/tmp/test_path_index.idx";
+    unlink(index_file);
 
-    // Test: create indexer
+    // Test: substring queries are case-insensitive and rank basename hits first
     {
-        Indexer *indexer = indexer_create();
-        TEST_ASSERT(indexer != NULL, "Should create indexer");
-        TEST_ASSERT_EQ(INDEXER_STATUS_STOPPED, indexer_get_status(indexer),
-                       "Should be stopped initially");
-        indexer_destroy(indexer);
+        PathIndex *index = path_index_open(NULL);
+        TEST_ASSERT(index != NULL, "Should create in-memory path index");
+
+        path_index_add(index, "/home/u/projects/Finder/src/search.c");
+        path_index_add(index, "/home/u/projects/Finder/src/search.h");
+        path_index_add(index, "/home/u/research");
+        path_index_add(index, "/home/u/research/notes.txt");
+        path_index_add(index, "/home/u/projects/Finder/src/search.c");
+        TEST_ASSERT_EQ(4, path_index_count(index), "Duplicate add should be ignored");
+
+        PathIndexResults results;
+        path_index_query(index, "SEARCH.c", 10, &results);
+        TEST_ASSERT_EQ(1, results.count, "Should match one path");
+        TEST_ASSERT(results.count == 1 && strcmp(results.paths[0], "/home/u/projects/Finder/src/search.c") == 0,
+                    "Should match case-insensitively");
+        path_index_results_free(&results);
+
+        path_index_query(index, "search", 10, &results);
+        TEST_ASSERT_EQ(3, results.total, "Should match directory names, not parent paths");
+        TEST_ASSERT(results.count == 3 && strcmp(results.paths[2], "/home/u/research") == 0,
+                    "Name prefix matches should rank first");
+        path_index_results_free(&results);
+
+        path_index_query(index, "src/ .h", 10, &results);
+        TEST_ASSERT_EQ(1, results.count, "All terms should have to match");
+        path_index_results_free(&results);
+
+        path_index_query(index, "finder/src/sea", 10, &results);
+        TEST_ASSERT_EQ(2, results.count, "Slash term should match the directory and name prefix");
+        path_index_results_free(&results);
+
+        path_index_query(index, "s", 1, &results);
+        TEST_ASSERT_EQ(1, results.count, "Should cap results");
+        TEST_ASSERT_EQ(4, results.total, "Short query should still count every match");
+        path_index_results_free(&results);
+
+        path_index_close(index);
     }
 
-    // Test: default config
+    // Test: removing a directory hides everything below it
     {
-        IndexerConfig config = indexer_get_default_config();
-        TEST_ASSERT(config.recursive, "Should be recursive by default");
-        TEST_ASSERT(!config.index_hidden_files, "Should not index hidden files by default");
-        TEST_ASSERT(config.max_file_size_mb > 0, "Should have max file size set");
+        PathIndex *index = path_index_open(NULL);
+        path_index_add(index, "/data");
+        path_index_add(index, "/data/photos");
+        path_index_add(index, "/data/photos/beach.jpg");
+        path_index_add(index, "/data/photos-old.zip");
+
+        path_index_remove(index, "/data/photos/");
+        TEST_ASSERT_EQ(2, path_index_count(index), "Subtree should be removed");
+
+        PathIndexResults results;
+        path_index_query(index, "photos", 10, &results);
+        TEST_ASSERT_EQ(1, results.count, "Sibling with shared prefix should remain");
+        path_index_results_free(&results);
+
+        // Re-adding the directory must not resurrect its old children
+        path_index_add(index, "/data/photos");
+        path_index_query(index, "beach", 10, &results);
+        TEST_ASSERT_EQ(0, results.count, "Removed child should stay removed");
+        path_index_results_free(&results);
+
+        path_index_close(index);
     }
 
-    // Test: add watch directory
+    // Test: glob find below a folder, direct children or the whole subtree
     {
-        Indexer *indexer = indexer_create();
-        bool added = indexer_add_watch_dir(indexer, TEST_DIR_PATH);
-        TEST_ASSERT(added, "Should add watch directory");
-        indexer_destroy(indexer);
+        PathIndex *index = path_index_open(NULL);
+        path_index_add(index, "/work/report.pdf");
+        path_index_add(index, "/work/notes.txt");
+        path_index_add(index, "/work/old/report-2019.pdf");
+        path_index_add(index, "/work/old/deep/summary.pdf");
+        path_index_add(index, "/other/report.pdf");
+
+        PathIndexResults results;
+        TEST_ASSERT(path_index_find(index, "/work", "*.pdf", false, 10, &results), "Should find under indexed root");
+        TEST_ASSERT(results.count == 1 && strcmp(results.paths[0], "/work/report.pdf") == 0,
+                    "Non-recursive find should only list direct children");
+        path_index_results_free(&results);
+
+        path_index_find(index, "/work", "*.pdf", true, 10, &results);
+        TEST_ASSERT_EQ(3, results.count, "Recursive find should cover the subtree only");
+        path_index_results_free(&results);
+
+        path_index_find(index, "/work", "report*", true, 10, &results);
+        TEST_ASSERT_EQ(2, results.count, "Literal part should narrow by trigram");
+        path_index_results_free(&results);
+
+        path_index_find(index, "/work", "*", true, 2, &results);
+        TEST_ASSERT_EQ(2, results.count, "Find should stop at the cap");
+        TEST_ASSERT(results.total > results.count, "Capped find should report more remaining");
+        path_index_results_free(&results);
+
+        TEST_ASSERT(!path_index_find(index, "/missing", "*", true, 10, &results), "Unknown root should fail");
+
+        path_index_close(index);
     }
 
-    // Test: add exclude pattern
+    // Test: rescans drop stale paths, and the index survives a save/load
     {
-        Indexer *indexer = indexer_create();
-        bool added = indexer_add_exclude_pattern(indexer, "*.log");
-        TEST_ASSERT(added, "Should add exclude pattern");
-        indexer_destroy(indexer);
+        PathIndex *index = path_index_open(index_file);
+        path_index_add(index, "/keep/a.txt");
+        path_index_add(index, "/gone/b.txt");
+
+        uint64_t changes = path_index_changes(index);
+        path_index_begin_scan(index);
+        path_index_add(index, "/keep/a.txt");
+        TEST_ASSERT(path_index_changes(index) == changes, "Re-adding a listed path should not count as a change");
+        path_index_end_scan(index);
+        TEST_ASSERT_EQ(1, path_index_count(index), "Rescan should drop unseen paths");
+        TEST_ASSERT(path_index_changes(index) > changes, "Dropping a path should count as a change");
+
+        TEST_ASSERT(path_index_save(index), "Should save index");
+        path_index_close(index);
+
+        index = path_index_open(index_file);
+        TEST_ASSERT_EQ(1, path_index_count(index), "Should reload saved paths");
+        PathIndexResults results;
+        path_index_query(index, "a.txt", 10, &results);
+        TEST_ASSERT_EQ(1, results.count, "Reloaded index should be searchable");
+        path_index_results_free(&results);
+        path_index_close(index);
+        unlink(index_file);
     }
 
-    // Test: start without vectordb fails
+    // Test: indexer fills the path index without a vectordb
     {
+        setup_test_dir();
+        char cmd[512];
+        snprintf(cmd, sizeof(cmd), "mkdir -p %s/sub && touch %s/sub/deep_file.md %s/.hidden",
+                 TEST_DIR_PATH, TEST_DIR_PATH, TEST_DIR_PATH);
+        system(cmd);
+
+        PathIndex *index = path_index_open(NULL);
         Indexer *indexer = indexer_create();
+        indexer_set_path_index(indexer, index);
         indexer_add_watch_dir(indexer, TEST_DIR_PATH);
-        bool started = indexer_start(indexer);
-        TEST_ASSERT(!started, "Should not start without vectordb");
+        TEST_ASSERT(indexer_start(indexer), "Should start with only a path index");
+
+        for (int i = 0; i < 100 && path_index_count(index) < 5; i++) {
+            usleep(10000);
+        }
+        indexer_stop(indexer);
         indexer_destroy(indexer);
+
+        TEST_ASSERT_EQ(5, path_index_count(index), "Should index files and directories");
+        PathIndexResults results;
+        path_index_query(index, "deep_file", 10, &results);
+        TEST_ASSERT_EQ(1, results.count, "Should find nested file");
+        path_index_results_free(&results);
+        path_index_query(index, "hidden", 10, &results);
+        TEST_ASSERT_EQ(0, results.count, "Should skip hidden files");
+        path_index_results_free(&results);
+
+        path_index_close(index);
+        cleanup_test_files();
     }
 
-    // Test: start with vectordb
+    // Test: a follow-only indexer leaves the loaded index alone instead of rescanning
     {
-        VectorDB *db = vectordb_open(TEST_DB_PATH);
-        Indexer *indexer = indexer_create();
+        setup_test_dir();
+        char cmd[512];
+        snprintf(cmd, sizeof(cmd), "touch %s/unscanned.txt", TEST_DIR_PATH);
+        system(cmd);
 
-        indexer_set_vectordb(indexer, db);
+        PathIndex *index = path_index_open(NULL);
+        path_index_add(index, "/saved/by/daemon.txt");
+        IndexerConfig config = indexer_get_default_config();
+        config.follow_only = true;
+        Indexer *indexer = indexer_create_with_config(&config);
+        indexer_set_path_index(indexer, index);
         indexer_add_watch_dir(indexer, TEST_DIR_PATH);
-
-        bool started = indexer_start(indexer);
-        TEST_ASSERT(started, "Should start with vectordb");
-
-        // Wait briefly for indexing
-        usleep(100000);  // 100ms
-
-        IndexerStats stats = indexer_get_stats(indexer);
-        TEST_ASSERT(stats.files_indexed >= 0, "Should have stats");
-
+        TEST_ASSERT(indexer_start(indexer), "Should start following");
+        usleep(200000);
         indexer_stop(indexer);
         indexer_destroy(indexer);
-        vectordb_close(db);
+
+        TEST_ASSERT_EQ(1, path_index_count(index), "Should neither scan nor drop saved paths");
+        path_index_close(index);
+        cleanup_test_files();
     }
 
-    // Test: pause and resume
+    // Test: a change inside an excluded folder stays out, whatever the file is called
     {
-        VectorDB *db = vectordb_open(TEST_DB_PATH);
-        Indexer *indexer = indexer_create();
-
-        indexer_set_vectordb(indexer, db);
+        setup_test_dir();
+        PathIndex *index = path_index_open(NULL);
+        FsWatch *watch = fs_watch_create(60.0);
+        IndexerConfig config = indexer_get_default_config();
+        config.enable_fsevents = true;
+        Indexer *indexer = indexer_create_with_config(&config);
+        indexer_set_path_index(indexer, index);
+        indexer_set_fs_watch(indexer, watch);
         indexer_add_watch_dir(indexer, TEST_DIR_PATH);
         indexer_start(indexer);
-
-        indexer_pause(indexer);
-        TEST_ASSERT_EQ(INDEXER_STATUS_PAUSED, indexer_get_status(indexer),
-                       "Should be paused");
-
-        indexer_resume(indexer);
-        TEST_ASSERT_EQ(INDEXER_STATUS_RUNNING, indexer_get_status(indexer),
-                       "Should be running after resume");
+        indexer_wait(indexer);
+        int before = path_index_count(index);
+
+        char cmd[512];
+        char excluded[512];
+        char kept[512];
+        snprintf(cmd, sizeof(cmd), "mkdir -p %s/node_modules/pkg && touch %s/node_modules/pkg/index.js %s/kept.js",
+                 TEST_DIR_PATH, TEST_DIR_PATH, TEST_DIR_PATH);
+        system(cmd);
+        snprintf(excluded, sizeof(excluded), "%s/node_modules/pkg/index.js", TEST_DIR_PATH);
+        snprintf(kept, sizeof(kept), "%s/kept.js", TEST_DIR_PATH);
+        fs_watch_notify(watch, excluded, FSEVENT_CREATED, 0);
+        fs_watch_notify(watch, kept, FSEVENT_CREATED, 0);
+        fs_watch_flush(watch);
+
+        TEST_ASSERT_EQ(before + 1, path_index_count(index), "Should add the new file outside the excluded folder only");
 
         indexer_stop(indexer);
         indexer_destroy(indexer);
-        vectordb_close(db);
+        fs_watch_destroy(watch);
+        path_index_close(index);
+        cleanup_test_files();
     }
-
-    cleanup_test_files();
 }
 
 // Test semantic search
@@ -630,6 +2244,30 @@ static void test_clip(void)
             }
         }
 
+        // Test: batch embedding reports each path and matches single embedding
+        {
+            const char *test_image = "../raylib/logo/raylib_256x256.png";
+            if (clip_is_supported_image(test_image)) {
+                CLIPEngine *engine = clip_engine_create();
+                clip_engine_load_model(engine, clip_model_path);
+
+                const char *paths[] = { test_image, NULL, "/nonexistent/photo.jpg", test_image };
+                CLIPBatchImageResult batch = clip_embed_images_batch(engine, paths, 4);
+                TEST_ASSERT_EQ(CLIP_STATUS_OK, batch.status, "Batch should succeed");
+                TEST_ASSERT_EQ(2, batch.count, "Should embed the two readable images");
+                TEST_ASSERT_EQ(CLIP_STATUS_IMAGE_FORMAT_ERROR, batch.statuses[1], "NULL path should be rejected");
+                TEST_ASSERT_EQ(CLIP_STATUS_IMAGE_LOAD_ERROR, batch.statuses[2], "Missing file should fail to load");
+                TEST_ASSERT(batch.widths[0] > 0 && batch.heights[3] > 0, "Should report original sizes");
+
+                CLIPImageResult single = clip_embed_image(engine, test_image);
+                float similarity = clip_similarity(single.embedding, &batch.embeddings[3 * CLIP_EMBEDDING_DIMENSION]);
+                TEST_ASSERT(similarity > 0.99f, "Batch embedding should match single embedding");
+
+                clip_batch_result_free(&batch);
+                clip_engine_destroy(engine);
+            }
+        }
+
         // Test: text-image similarity (semantic matching)
         {
             const char *test_image = "../raylib/logo/raylib_256x256.png";
@@ -671,6 +2309,73 @@ static void test_clip(void)
 #endif
 }
 
+static void test_local_llm(void)
+{
+    printf("\n  [Local LLM Tests]\n");
+
+    // Test: a missing model is not available and generates nothing
+    {
+        LocalLLMConfig config = {0};
+        strncpy(config.model_path, "/nonexistent/model.gguf", sizeof(config.model_path) - 1);
+        LocalLLM *engine = local_llm_create_with_config(&config);
+        TEST_ASSERT(engine != NULL, "Should create local model engine");
+        TEST_ASSERT(local_llm_load_model_lazily(engine, NULL) != LOCAL_LLM_STATUS_OK,
+                    "Missing model should not load lazily");
+        TEST_ASSERT(!local_llm_is_available(engine), "Missing model should not be available");
+
+        char reply[64];
+        TEST_ASSERT(local_llm_generate(engine, NULL, "Hello", 8, reply, sizeof(reply)) != LOCAL_LLM_STATUS_OK &&
+                    reply[0] == '\0', "Generation should fail without a model");
+        TEST_ASSERT(!local_llm_trim(engine, 0.0), "Nothing to trim without a model");
+        local_llm_destroy(engine);
+    }
+
+    // Test: overlong prompts are refused before touching the model
+    {
+        LocalLLM *engine = local_llm_create();
+        char *prompt = malloc(LOCAL_LLM_MAX_PROMPT + 2);
+        if (prompt) {
+            memset(prompt, 'a', LOCAL_LLM_MAX_PROMPT + 1);
+            prompt[LOCAL_LLM_MAX_PROMPT + 1] = '\0';
+            char reply[64];
+            TEST_ASSERT_EQ(LOCAL_LLM_STATUS_PROMPT_TOO_LONG,
+                           local_llm_generate(engine, NULL, prompt, 8, reply, sizeof(reply)),
+                           "Overlong prompt should be refused");
+            free(prompt);
+        }
+        local_llm_destroy(engine);
+    }
+
+    // Test: the model manager shares one engine
+    {
+        LocalLLM *first = model_manager_acquire_llm();
+        LocalLLM *second = model_manager_acquire_llm();
+        TEST_ASSERT(first != NULL && first == second, "Should share one local model engine");
+        TEST_ASSERT(!local_llm_is_loaded(first), "Shared local model should not load at acquire");
+        model_manager_release_llm(second);
+        model_manager_release_llm(first);
+    }
+
+#ifdef FINDER_PLUS_LOCAL_LLM
+    const char *model_path = local_llm_get_default_model_path();
+    struct stat st;
+    if (stat(model_path, &st) == 0) {
+        LocalLLM *engine = local_llm_create();
+        local_llm_load_model_lazily(engine, NULL);
+        char reply[256];
+        LocalLLMStatus status = local_llm_generate(engine, "Answer in one word.",
+                                                   "What is the capital of France?", 16,
+                                                   reply, sizeof(reply));
+        TEST_ASSERT(status == LOCAL_LLM_STATUS_OK && strstr(reply, "Paris") != NULL,
+                    "Local model should answer a simple question");
+        TEST_ASSERT(local_llm_trim(engine, 0.0) && !local_llm_is_loaded(engine), "Idle model should trim");
+        local_llm_destroy(engine);
+    } else {
+        printf("  [Skipping real local LLM tests - model not found at %s]\n", model_path);
+    }
+#endif
+}
+
 // Test FSEvents watcher
 static void test_fsevents(void)
 {
@@ -774,6 +2479,214 @@ static void test_visual_search(void)
         TEST_ASSERT_EQ(0, stats.indexed_images, "Should have no indexed images");
         visual_search_destroy(vs);
     }
+
+    // Test: precomputed embeddings are stored, linked and counted
+    {
+        unlink(TEST_DB_PATH);
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+        VisualSearch *vs = visual_search_create();
+        visual_search_set_vectordb(vs, db);
+        float embedding[CLIP_EMBEDDING_DIMENSION];
+        bool all_stored = true;
+        for (int i = 0; i < 50; i++) {
+            char path[64];
+            snprintf(path, sizeof(path), "/photos/image_%d.jpg", i);
+            for (int d = 0; d < CLIP_EMBEDDING_DIMENSION; d++) {
+                embedding[d] = (float)((i * 31 + d * 7) % 17) - 8.0f;
+            }
+            all_stored = all_stored && visual_search_index_embedding(vs, path, embedding, 64, 48, 1024, 1600000000);
+        }
+        TEST_ASSERT(all_stored, "Should store precomputed embeddings");
+        TEST_ASSERT_EQ(0, visual_search_build_index(vs, 1000), "Graph should be fully linked");
+        VisualSearchStats stats = visual_search_get_stats(vs);
+        TEST_ASSERT_EQ(50, stats.indexed_images, "Should count the stored images");
+        TEST_ASSERT(stats.index_memory >= 50 * CLIP_EMBEDDING_DIMENSION * sizeof(float),
+                    "Should report the resident index memory");
+        visual_search_destroy(vs);
+        vectordb_close(db);
+        unlink(TEST_DB_PATH);
+    }
+}
+
+// Helper: index path (an existing file) in db with an embedding along axis
+static void index_pack_test_file(VectorDB *db, const char *path, int axis)
+{
+    struct stat st;
+    stat(path, &st);
+    uint64_t hash = 0;
+    char hex[FILE_HASH_HEX_SIZE];
+    file_hash_compute(path, &hash);
+    file_hash_to_hex(hash, hex);
+    float embedding[EMBEDDING_DIMENSION] = {0};
+    embedding[axis] = 1.0f;
+    vectordb_index_file_with_hash(db, path, path_basename(path), FILE_TYPE_TEXT, (int64_t)st.st_size,
+                                  (int64_t)st.st_mtime, hex, embedding);
+}
+
+// Test exporting an index pack and importing it where the tree is mounted elsewhere
+static void test_index_pack(void)
+{
+    printf("\n  [Index Pack Tests]\n");
+
+    const char *pack_db_path = "/tmp/test_vectordb_pack.db";
+    const char *pack_path = "/tmp/test_index.fppack";
+    system("rm -rf /tmp/test_index_pack && mkdir -p /tmp/test_index_pack/share/docs");
+    system("echo 'alpha notes' > /tmp/test_index_pack/share/docs/alpha.txt");
+    system("echo 'beta notes' > /tmp/test_index_pack/share/beta.txt");
+    system("echo 'gamma notes' > /tmp/test_index_pack/share/gamma.txt");
+    system("echo 'delta notes' > /tmp/test_index_pack/share/delta.txt");
+    system("echo 'not really a jpeg' > /tmp/test_index_pack/share/photo.jpg");
+    system("echo 'outside' > /tmp/test_index_pack/outside.txt");
+
+    unlink(TEST_DB_PATH);
+    VectorDB *db = vectordb_open(TEST_DB_PATH);
+    VisualSearch *vs = visual_search_create();
+    visual_search_set_vectordb(vs, db);
+    index_pack_test_file(db, "/tmp/test_index_pack/share/docs/alpha.txt", 1);
+    index_pack_test_file(db, "/tmp/test_index_pack/share/beta.txt", 2);
+    index_pack_test_file(db, "/tmp/test_index_pack/share/gamma.txt", 3);
+    index_pack_test_file(db, "/tmp/test_index_pack/share/delta.txt", 4);
+    index_pack_test_file(db, "/tmp/test_index_pack/outside.txt", 5);
+    struct stat st;
+    stat("/tmp/test_index_pack/share/photo.jpg", &st);
+    float image[CLIP_EMBEDDING_DIMENSION] = {0};
+    image[7] = 1.0f;
+    visual_search_index_embedding(vs, "/tmp/test_index_pack/share/photo.jpg", image, 640, 480,
+                                  (int64_t)st.st_size, st.st_mtime);
+
+    IndexPackModels models = { .text = "text-model-v1", .image = "image-model-v1" };
+    IndexPackStats stats;
+    IndexPackStatus status = index_pack_export(db, vs, "/tmp/test_index_pack/share/", &models, pack_path, &stats);
+    TEST_ASSERT_EQ(INDEX_PACK_STATUS_OK, status, "Should export the shared folder");
+    TEST_ASSERT_EQ(5, stats.entries, "Pack should hold only the files under the folder");
+    TEST_ASSERT(stats.text_entries == 4 && stats.image_entries == 1, "Pack should hold text and image rows");
+    visual_search_destroy(vs);
+    vectordb_close(db);
+
+    // Mounted elsewhere: one file copied without its mtime, one rewritten, one gone
+    system("cp -Rp /tmp/test_index_pack/share /tmp/test_index_pack/mount");
+    system("touch -t 202001010000 /tmp/test_index_pack/mount/beta.txt");
+    system("echo 'gamma notes, revised' > /tmp/test_index_pack/mount/gamma.txt");
+    unlink("/tmp/test_index_pack/mount/delta.txt");
+
+    unlink(pack_db_path);
+    db = vectordb_open(pack_db_path);
+    vs = visual_search_create();
+    visual_search_set_vectordb(vs, db);
+
+    IndexPackModels other = { .text = "text-model-v2", .image = "image-model-v1" };
+    status = index_pack_import(db, vs, pack_path, "/tmp/test_index_pack/mount", &other, &stats);
+    TEST_ASSERT_EQ(INDEX_PACK_STATUS_MODEL_MISMATCH, status, "Pack from other models should be refused");
+    TEST_ASSERT_EQ(0, vectordb_count_files(db), "Refused pack should index nothing");
+
+    status = index_pack_import(db, vs, pack_path, "/tmp/test_index_pack/mount", &models, &stats);
+    TEST_ASSERT_EQ(INDEX_PACK_STATUS_OK, status, "Should import the pack");
+    TEST_ASSERT_EQ(3, stats.imported, "Unchanged files should be imported");
+    TEST_ASSERT_EQ(1, stats.hashed, "File with a new mtime should match by content hash");
+    TEST_ASSERT_EQ(1, stats.stale, "Rewritten file should be left to the indexer");
+    TEST_ASSERT_EQ(1, stats.missing, "Deleted file should be skipped");
+
+    IndexedFile file;
+    TEST_ASSERT(vectordb_get_file(db, "/tmp/test_index_pack/mount/docs/alpha.txt", &file) == VECTORDB_STATUS_OK &&
+                file.has_embedding && file.embedding[1] > 0.99f,
+                "Imported embedding should survive quantization");
+    stat("/tmp/test_index_pack/mount/beta.txt", &st);
+    TEST_ASSERT(vectordb_is_indexed(db, "/tmp/test_index_pack/mount/beta.txt", (int64_t)st.st_mtime),
+                "Imported file should count as indexed at its local mtime");
+    TEST_ASSERT(vectordb_get_file(db, "/tmp/test_index_pack/mount/gamma.txt", &file) == VECTORDB_STATUS_NOT_FOUND,
+                "Stale file should not be imported");
+    TEST_ASSERT_EQ(1, visual_search_get_stats(vs).indexed_images, "Image embedding should be imported");
+
+    status = index_pack_import(db, vs, pack_path, "/tmp/test_index_pack/mount", &models, &stats);
+    TEST_ASSERT(status == INDEX_PACK_STATUS_OK && stats.imported == 1 && stats.current == 2,
+                "Second import should leave indexed text alone");
+
+    // A truncated pack is refused
+    system("head -c 300 /tmp/test_index.fppack > /tmp/test_index_pack/truncated.fppack");
+    status = index_pack_import(db, vs, "/tmp/test_index_pack/truncated.fppack", "/tmp/test_index_pack/mount",
+                               &models, &stats);
+    TEST_ASSERT_EQ(INDEX_PACK_STATUS_INVALID, status, "Truncated pack should be refused");
+
+    visual_search_destroy(vs);
+    vectordb_close(db);
+    unlink(pack_db_path);
+    unlink(pack_path);
+    unlink(TEST_DB_PATH);
+    system("rm -rf /tmp/test_index_pack");
+}
+
+// Test per-volume shards of the vector database
+static void test_index_shards(void)
+{
+    printf("\n  [Index Shard Tests]\n");
+
+    const char *main_path = "/tmp/test_vectordb_main.db";
+    const char *shard_path = "/tmp/test_vectordb_shard.db";
+    unlink(main_path);
+    unlink(shard_path);
+
+    float first[EMBEDDING_DIMENSION] = {0};
+    float second[EMBEDDING_DIMENSION] = {0};
+    first[0] = 1.0f;
+    second[1] = 1.0f;
+
+    // A shard the volume had while mounted somewhere else
+    VectorDB *shard = vectordb_open(shard_path);
+    vectordb_index_file(shard, "/Volumes/Old/gone.txt", "gone.txt", FILE_TYPE_TEXT, 1, 1, first);
+    vectordb_close(shard);
+
+    VectorDB *db = vectordb_open(main_path);
+    vectordb_index_file(db, "/Users/test/home.txt", "home.txt", FILE_TYPE_TEXT, 1, 1, second);
+    vectordb_index_file(db, "/Volumes/Ext/early.txt", "early.txt", FILE_TYPE_TEXT, 1, 1, first);
+
+    TEST_ASSERT(!vectordb_attach_shard(db, "/", shard_path), "Startup disk should have no shard");
+    TEST_ASSERT(vectordb_attach_shard(db, "/Volumes/Ext/", shard_path), "Shard should attach");
+    TEST_ASSERT(vectordb_attach_shard(db, "/Volumes/Ext", shard_path), "Attaching again should be a no-op");
+    TEST_ASSERT(!vectordb_attach_shard(db, "/Volumes/Ext/sub", "/tmp/test_vectordb_sub.db"),
+                "Shards should not overlap");
+    TEST_ASSERT_EQ(1, vectordb_each_shard(db, NULL, NULL), "One shard should be attached");
+    TEST_ASSERT_EQ(1, vectordb_count_files(db), "Stale rows of both should be dropped");
+
+    vectordb_index_file(db, "/Volumes/Ext/docs/note.txt", "note.txt", FILE_TYPE_TEXT, 1, 5, first);
+    TEST_ASSERT(vectordb_is_indexed(db, "/Volumes/Ext/docs/note.txt", 5), "Writes should reach the shard");
+    TEST_ASSERT_EQ(2, vectordb_count_files(db), "Counts should span the shards");
+
+    VectorSearchResults results = vectordb_search(db, first, 10);
+    TEST_ASSERT_EQ(2, results.count, "Search should span the shards");
+    TEST_ASSERT(results.count == 2 && strcmp(results.results[0].file.path, "/Volumes/Ext/docs/note.txt") == 0,
+                "Shard results should merge by similarity");
+    vector_search_results_free(&results);
+
+    results = vectordb_search_in_directory(db, second, "/Volumes/Ext/docs", 10);
+    TEST_ASSERT(results.count == 1 && strcmp(results.results[0].file.path, "/Volumes/Ext/docs/note.txt") == 0,
+                "A directory in a shard should only search it");
+    vector_search_results_free(&results);
+    results = vectordb_search_in_directory(db, first, "/Users/", 10);
+    TEST_ASSERT(results.count == 1 && strcmp(results.results[0].file.path, "/Users/test/home.txt") == 0,
+                "A directory outside the shards should skip them");
+    vector_search_results_free(&results);
+
+    TEST_ASSERT(vectordb_detach_shard(db, "/Volumes/Ext"), "Shard should detach");
+    TEST_ASSERT(!vectordb_detach_shard(db, "/Volumes/Ext"), "Detaching twice should fail");
+    TEST_ASSERT(!vectordb_is_indexed(db, "/Volumes/Ext/docs/note.txt", 5), "Detached files should be gone");
+    results = vectordb_search(db, first, 10);
+    TEST_ASSERT_EQ(1, results.count, "Detached files should not be searched");
+    vector_search_results_free(&results);
+
+    TEST_ASSERT(vectordb_attach_shard(db, "/Volumes/Ext", shard_path), "Shard should attach again");
+    TEST_ASSERT(vectordb_is_indexed(db, "/Volumes/Ext/docs/note.txt", 5), "Reattached files should be indexed");
+    vectordb_close(db);
+
+    unlink(main_path);
+    unlink(shard_path);
+    system("rm -f /tmp/test_vectordb_main.db* /tmp/test_vectordb_shard.db*");
+}
+
+// vectordb_each_stale callback: remember the last path
+static bool stale_path_fn(const char *path, void *context)
+{
+    snprintf((char *)context, 256, "%s", path);
+    return true;
 }
 
 // Test database migrations
@@ -821,6 +2734,106 @@ static void test_db_migrations(void)
         vectordb_close(db);
     }
 
+    // Test: watch checkpoints persist per root and go with the index
+    {
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+        uint64_t event_id = 0;
+        TEST_ASSERT(!vectordb_get_watch_checkpoint(db, "/tmp/root", &event_id), "No checkpoint yet");
+        TEST_ASSERT_EQ(VECTORDB_STATUS_OK, vectordb_set_watch_checkpoint(db, "/tmp/root", 41),
+                       "Should save checkpoint");
+        TEST_ASSERT_EQ(VECTORDB_STATUS_OK, vectordb_set_watch_checkpoint(db, "/tmp/root", 42),
+                       "Should replace checkpoint");
+        vectordb_close(db);
+
+        db = vectordb_open(TEST_DB_PATH);
+        TEST_ASSERT(vectordb_get_watch_checkpoint(db, "/tmp/root", &event_id) && event_id == 42,
+                    "Checkpoint should survive reopen");
+        TEST_ASSERT(!vectordb_get_watch_checkpoint(db, "/tmp/other", &event_id), "Checkpoints are per root");
+        vectordb_clear(db);
+        TEST_ASSERT(!vectordb_get_watch_checkpoint(db, "/tmp/root", &event_id), "Clear should drop checkpoints");
+        vectordb_close(db);
+    }
+
+    // Test: embeddings are searched only by the model that made them until redone
+    {
+        const char *hash = "fedcba9876543210fedcba9876543210fedcba9876543210fedcba9876543210";
+        float axis[EMBEDDING_DIMENSION] = {0};
+        axis[7] = 1.0f;
+
+        // Rows from before any model was named are claimed by the first one set
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+        vectordb_index_file(db, "/test/models/a.txt", "a.txt", FILE_TYPE_TEXT, 1, 1, axis);
+        vectordb_index_file_with_hash(db, "/test/models/b.txt", "b.txt", FILE_TYPE_TEXT, 1, 1, hash, axis);
+        vectordb_set_model(db, "old.bin");
+        TEST_ASSERT_EQ(0, vectordb_count_stale(db), "Untagged embeddings should be the first model's");
+        vectordb_close(db);
+
+        db = vectordb_open(TEST_DB_PATH);
+        vectordb_set_model(db, "new.bin");
+        TEST_ASSERT_EQ(2, vectordb_count_stale(db), "Another model's embeddings should be stale");
+        TEST_ASSERT(!vectordb_is_indexed(db, "/test/models/a.txt", 1), "Stale files should be indexed again");
+        float shared[EMBEDDING_DIMENSION];
+        TEST_ASSERT(!vectordb_get_content_embedding(db, hash, shared), "Stale content should not be reused");
+        VectorSearchResults results = vectordb_search_in_directory(db, axis, "/test/models/", 10);
+        TEST_ASSERT_EQ(0, results.count, "Searches should skip another model's embeddings");
+        vector_search_results_free(&results);
+
+        char last_path[256] = "";
+        TEST_ASSERT_EQ(1, vectordb_each_stale(db, NULL, 1, stale_path_fn, last_path), "Should hand a stale file");
+        TEST_ASSERT_EQ(1, vectordb_each_stale(db, last_path, 10, stale_path_fn, last_path), "Pass should go on after it");
+
+        vectordb_index_file_with_hash(db, "/test/models/b.txt", "b.txt", FILE_TYPE_TEXT, 1, 1, hash, axis);
+        TEST_ASSERT_EQ(1, vectordb_count_stale(db), "Embedding again should migrate a file");
+        results = vectordb_search_in_directory(db, axis, "/test/models/", 10);
+        TEST_ASSERT(results.count == 1 && strcmp(results.results[0].file.path, "/test/models/b.txt") == 0,
+                    "Migrated files should be searchable");
+        vector_search_results_free(&results);
+        vectordb_close(db);
+
+        // Switching back finds the old model's vectors still in place
+        db = vectordb_open(TEST_DB_PATH);
+        vectordb_set_model(db, "old.bin");
+        TEST_ASSERT_EQ(1, vectordb_count_stale(db), "Only the migrated file should be stale to the old model");
+        vectordb_clear(db);
+        vectordb_close(db);
+    }
+
+    // Test: upkeep gives deleted rows' space back and drops them from memory
+    {
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+        float axis[EMBEDDING_DIMENSION] = {0};
+        vectordb_begin_batch(db);
+        for (int j = 0; j < 400; j++) {
+            char path[256];
+            snprintf(path, sizeof(path), "/test/churn/file%d.txt", j);
+            axis[j % EMBEDDING_DIMENSION] = 1.0f;
+            vectordb_index_file(db, path, path + 12, FILE_TYPE_TEXT, 1, 1, axis);
+            axis[j % EMBEDDING_DIMENSION] = 0.0f;
+        }
+        vectordb_commit_batch(db);
+        axis[0] = 1.0f;
+        VectorSearchResults results = vectordb_search(db, axis, 1);
+        vector_search_results_free(&results);
+        vectordb_delete_directory(db, "/test/churn/");
+
+        int64_t total = 0;
+        int64_t unused = 0;
+        vectordb_file_usage(db, &total, &unused);
+        TEST_ASSERT(unused > 0, "Deleted rows should leave unused pages");
+        TEST_ASSERT_EQ(400, vectordb_optimize(db), "Upkeep should compact deleted embeddings out");
+
+        int64_t reclaimed = 0;
+        int64_t freed;
+        while ((freed = vectordb_vacuum(db, 16)) > 0) {
+            reclaimed += freed;
+        }
+        int64_t after = 0;
+        vectordb_file_usage(db, &after, &unused);
+        TEST_ASSERT(reclaimed > 0 && after == total - reclaimed && unused == 0,
+                    "Vacuum should give the unused pages back");
+        vectordb_close(db);
+    }
+
     unlink(TEST_DB_PATH);
 }
 
@@ -873,13 +2886,43 @@ static void test_indexer_progress(void)
         vectordb_close(db);
     }
 
+    // Test: upkeep removes files deleted while nothing was watching
+    {
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+        vectordb_index_file(db, "/tmp/test_ai_indexer/gone.txt", "gone.txt", FILE_TYPE_TEXT, 1, 1, NULL);
+        Indexer *indexer = indexer_create();
+        indexer_set_vectordb(indexer, db);
+        indexer_add_watch_dir(indexer, TEST_DIR_PATH);
+        indexer_start(indexer);
+        indexer_wait(indexer);
+        for (int i = 0; i < 200 && indexer_get_stats(indexer).db_bytes == 0; i++) {
+            usleep(10000);
+        }
+        IndexerStats stats = indexer_get_stats(indexer);
+        indexer_stop(indexer);
+
+        IndexedFile file;
+        TEST_ASSERT(stats.files_purged == 1 && stats.db_bytes > 0, "Upkeep should report its work");
+        TEST_ASSERT(vectordb_get_file(db, "/tmp/test_ai_indexer/gone.txt", &file) == VECTORDB_STATUS_NOT_FOUND,
+                    "Missing files should leave the index");
+        TEST_ASSERT(vectordb_get_file(db, "/tmp/test_ai_indexer/hello.txt", &file) == VECTORDB_STATUS_OK,
+                    "Existing files should stay");
+
+        indexer_destroy(indexer);
+        vectordb_close(db);
+    }
+
     // Test: enable/disable watching
     {
         VectorDB *db = vectordb_open(TEST_DB_PATH);
         Indexer *indexer = indexer_create();
+        FsWatch *watch = fs_watch_create(FS_WATCH_DEFAULT_COALESCE);
 
         indexer_set_vectordb(indexer, db);
         indexer_add_watch_dir(indexer, TEST_DIR_PATH);
+        TEST_ASSERT(!indexer_enable_watching(indexer, true), "Should need a watch bus");
+
+        indexer_set_fs_watch(indexer, watch);
         indexer_start(indexer);
 
         usleep(200000);  // 200ms
@@ -892,6 +2935,7 @@ static void test_indexer_progress(void)
 
         indexer_stop(indexer);
         indexer_destroy(indexer);
+        fs_watch_destroy(watch);
         vectordb_close(db);
     }
 
@@ -1095,6 +3139,80 @@ static void test_visual_search_integration(void)
         vectordb_close(db);
     }
 
+#ifndef FINDER_PLUS_AI_MODELS
+    // Test: directory-scoped, unlimited and similar-image queries over the resident vectors
+    {
+        const char *root = "/tmp/finder_plus_visual_test";
+        const char *files[] = { "trips/a.jpg", "trips/b.png", "trips/c.jpg", "work/d.jpg", "work/e.png" };
+        char path[256];
+        mkdir(root, 0755);
+        snprintf(path, sizeof(path), "%s/trips", root);
+        mkdir(path, 0755);
+        snprintf(path, sizeof(path), "%s/work", root);
+        mkdir(path, 0755);
+        for (int i = 0; i < 5; i++) {
+            snprintf(path, sizeof(path), "%s/%s", root, files[i]);
+            FILE *f = fopen(path, "w");
+            if (f != NULL) {
+                fputs("image", f);
+                fclose(f);
+            }
+        }
+        // Stub engines load any existing file as their model
+        snprintf(path, sizeof(path), "%s/work/d.jpg", root);
+
+        VectorDB *db = vectordb_open(TEST_DB_PATH);
+        CLIPEngine *clip = clip_engine_create();
+        clip_engine_load_model(clip, path);
+        VisualSearch *vs = visual_search_create();
+        visual_search_set_clip_engine(vs, clip);
+        visual_search_set_vectordb(vs, db);
+
+        TEST_ASSERT_EQ(5, visual_search_index_directory(vs, root), "Should index every image");
+        TEST_ASSERT_EQ(5, visual_search_index_directory(vs, root), "Unchanged images count as indexed");
+
+        VisualSearchOptions opts = visual_search_default_options();
+        opts.min_score = -1.0f;
+        char scope[256];
+        snprintf(scope, sizeof(scope), "%s/trips/", root);
+        opts.directory = scope;
+        VisualSearchResults scoped = visual_search_query(vs, "beach", &opts);
+        TEST_ASSERT(scoped.success, "Scoped query should succeed");
+        TEST_ASSERT_EQ(3, scoped.count, "Scoped query should only see its directory");
+        for (int i = 0; i < scoped.count; i++) {
+            TEST_ASSERT(strncmp(scoped.results[i].path, scope, strlen(scope)) == 0, "Result should be in scope");
+        }
+        visual_search_results_free(&scoped);
+
+        opts.directory = NULL;
+        opts.max_results = 0;
+        VisualSearchResults all = visual_search_query(vs, "beach", &opts);
+        TEST_ASSERT_EQ(5, all.count, "Unlimited query should return every image");
+        for (int i = 1; i < all.count; i++) {
+            TEST_ASSERT(all.results[i - 1].score >= all.results[i].score, "Results should be best first");
+        }
+        visual_search_results_free(&all);
+
+        opts.max_results = 10;
+        VisualSearchResults similar = visual_search_similar(vs, path, &opts);
+        TEST_ASSERT_EQ(4, similar.count, "Similar images should exclude the query image");
+        visual_search_results_free(&similar);
+
+        visual_search_destroy(vs);
+        clip_engine_destroy(clip);
+        vectordb_close(db);
+        for (int i = 0; i < 5; i++) {
+            snprintf(path, sizeof(path), "%s/%s", root, files[i]);
+            unlink(path);
+        }
+        snprintf(path, sizeof(path), "%s/trips", root);
+        rmdir(path);
+        snprintf(path, sizeof(path), "%s/work", root);
+        rmdir(path);
+        rmdir(root);
+    }
+#endif
+
     unlink(TEST_DB_PATH);
 }
 
@@ -1104,12 +3222,27 @@ void test_ai(void)
     printf("  Setting up AI test environment...\n");
 
     test_embeddings();
+    test_vector_ops();
+    test_vector_index();
     test_vectordb();
     test_indexer();
+    test_index_queue();
+    test_index_inbox();
+    test_index_governor();
+    test_compute_budget();
+    test_query_cache();
+    test_wordpiece();
+    test_content_extract();
+    test_extract_pool();
+    test_ignore_rules();
+    test_path_index();
     test_semantic_search();
     test_clip();
+    test_local_llm();
     test_fsevents();
     test_visual_search();
+    test_index_pack();
+    test_index_shards();
     test_db_migrations();
     test_indexer_progress();
     test_search_performance();
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "api/api_scheduler.h"
+
+// Test macros from test_main.c
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Helper: Release a ticket with a made-up response
+static void release_with(ApiTicket *ticket, int status, const char *headers)
+{
+    HttpResponse resp;
+    http_response_init(&resp);
+    resp.status_code = status;
+    resp.headers = headers ? strdup(headers) : NULL;
+    api_scheduler_release(ticket, &resp);
+    http_response_cleanup(&resp);
+}
+
+static void test_adaptive_concurrency(void)
+{
+    api_scheduler_reset(API_PROVIDER_CLAUDE);
+    ApiSchedulerStats stats;
+    api_scheduler_get_stats(API_PROVIDER_CLAUDE, &stats);
+    TEST_ASSERT(stats.concurrency == API_SCHEDULER_START_CONCURRENCY, "Window starts at its default");
+    TEST_ASSERT(stats.requests_remaining == -1 && stats.tokens_remaining == -1, "Limits start unknown");
+
+    for (int i = 0; i < API_SCHEDULER_START_CONCURRENCY; i++) {
+        ApiTicket ticket;
+        api_scheduler_acquire(API_PROVIDER_CLAUDE, API_PRIORITY_INTERACTIVE, 100, &ticket);
+        release_with(&ticket, 200, NULL);
+    }
+    api_scheduler_get_stats(API_PROVIDER_CLAUDE, &stats);
+    TEST_ASSERT(stats.concurrency == API_SCHEDULER_START_CONCURRENCY + 1, "A window of clean responses grows it");
+    TEST_ASSERT(stats.requests_last_minute == API_SCHEDULER_START_CONCURRENCY &&
+                stats.tokens_last_minute == 100 * API_SCHEDULER_START_CONCURRENCY, "Sent requests are counted");
+
+    ApiTicket ticket;
+    api_scheduler_acquire(API_PROVIDER_CLAUDE, API_PRIORITY_INTERACTIVE, 100, &ticket);
+    release_with(&ticket, 429, "retry-after: 0.3\r\n");
+    api_scheduler_get_stats(API_PROVIDER_CLAUDE, &stats);
+    TEST_ASSERT(stats.concurrency == (API_SCHEDULER_START_CONCURRENCY + 1) / 2 && stats.throttled == 1,
+                "A 429 halves the window");
+
+    double start = now_seconds();
+    api_scheduler_acquire(API_PROVIDER_CLAUDE, API_PRIORITY_INTERACTIVE, 100, &ticket);
+    double waited = now_seconds() - start;
+    release_with(&ticket, 200, NULL);
+    TEST_ASSERT(waited >= 0.25, "Retry-After holds the next request back");
+}
+
+static void test_rate_limit_headers(void)
+{
+    api_scheduler_reset(API_PROVIDER_CLAUDE);
+    ApiTicket ticket;
+    api_scheduler_acquire(API_PROVIDER_CLAUDE, API_PRIORITY_INTERACTIVE, 10, &ticket);
+    release_with(&ticket, 200,
+                 "anthropic-ratelimit-requests-limit: 50\r\n"
+                 "anthropic-ratelimit-requests-remaining: 1\r\n"
+                 "anthropic-ratelimit-requests-reset: 0.3\r\n"
+                 "anthropic-ratelimit-tokens-limit: 40000\r\n"
+                 "anthropic-ratelimit-tokens-remaining: 39000\r\n"
+                 "anthropic-ratelimit-tokens-reset: 2000-01-01T00:00:00Z\r\n");
+
+    ApiSchedulerStats stats;
+    api_scheduler_get_stats(API_PROVIDER_CLAUDE, &stats);
+    TEST_ASSERT(stats.requests_remaining == 1 && stats.tokens_remaining == 39000, "Remaining counts are read");
+
+    // The last request left is kept for interactive work
+    double start = now_seconds();
+    api_scheduler_acquire(API_PROVIDER_CLAUDE, API_PRIORITY_INTERACTIVE, 10, &ticket);
+    TEST_ASSERT(now_seconds() - start < 0.1, "Interactive request takes the last one");
+    api_scheduler_release(&ticket, NULL);
+
+    start = now_seconds();
+    api_scheduler_acquire(API_PROVIDER_CLAUDE, API_PRIORITY_BACKGROUND, 10, &ticket);
+    TEST_ASSERT(now_seconds() - start >= 0.2, "Background request waits for the reset");
+    api_scheduler_release(&ticket, NULL);
+
+    TEST_ASSERT(api_scheduler_should_retry(429) && api_scheduler_should_retry(529) &&
+                api_scheduler_should_retry(503) && api_scheduler_should_retry(500), "Overloads are retried");
+    TEST_ASSERT(!api_scheduler_should_retry(400) && !api_scheduler_should_retry(401) &&
+                !api_scheduler_should_retry(200), "Client errors are not retried");
+}
+
+static void *background_acquire(void *arg)
+{
+    api_scheduler_acquire(API_PROVIDER_GEMINI, API_PRIORITY_BACKGROUND, 10, (ApiTicket *)arg);
+    return NULL;
+}
+
+static void test_priorities(void)
+{
+    api_scheduler_reset(API_PROVIDER_GEMINI);
+
+    // Background work fills all but one slot
+    ApiTicket held[API_SCHEDULER_START_CONCURRENCY];
+    for (int i = 0; i < API_SCHEDULER_START_CONCURRENCY - 1; i++) {
+        api_scheduler_acquire(API_PROVIDER_GEMINI, API_PRIORITY_BACKGROUND, 10, &held[i]);
+    }
+
+    ApiTicket queued;
+    pthread_t thread;
+    pthread_create(&thread, NULL, background_acquire, &queued);
+    usleep(50000);
+
+    ApiSchedulerStats stats;
+    api_scheduler_get_stats(API_PROVIDER_GEMINI, &stats);
+    TEST_ASSERT(stats.in_flight == API_SCHEDULER_START_CONCURRENCY - 1 && stats.waiting == 1,
+                "Background work leaves a slot free");
+
+    double start = now_seconds();
+    ApiTicket interactive;
+    api_scheduler_acquire(API_PROVIDER_GEMINI, API_PRIORITY_INTERACTIVE, 10, &interactive);
+    TEST_ASSERT(now_seconds() - start < 0.1, "Interactive request takes the free slot at once");
+
+    release_with(&interactive, 200, NULL);
+    release_with(&held[0], 200, NULL);
+    pthread_join(thread, NULL);
+    api_scheduler_get_stats(API_PROVIDER_GEMINI, &stats);
+    TEST_ASSERT(stats.waiting == 0 && stats.in_flight == API_SCHEDULER_START_CONCURRENCY - 1,
+                "Queued background request runs once a slot frees");
+
+    release_with(&queued, 200, NULL);
+    for (int i = 1; i < API_SCHEDULER_START_CONCURRENCY - 1; i++) {
+        release_with(&held[i], 200, NULL);
+    }
+    api_scheduler_reset(API_PROVIDER_GEMINI);
+}
+
+void test_api_scheduler(void)
+{
+    test_adaptive_concurrency();
+    test_rate_limit_headers();
+    test_priorities();
+    api_scheduler_reset(API_PROVIDER_CLAUDE);
+}
@@ -0,0 +1,565 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "core/archive.h"
+#include "core/filesystem.h"
+#include "core/operations.h"
+
+// External test macros from test_main.c
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#define TEST_ASSERT_EQ(expected, actual, message) do { \
+    inc_tests_run(); \
+    if ((expected) == (actual)) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s - expected %d, got %d (line %d)\n", message, (int)(expected), (int)(actual), __LINE__); \
+    } \
+} while(0)
+
+#define TEST_ASSERT_STR_EQ(expected, actual, message) do { \
+    inc_tests_run(); \
+    if (strcmp((expected), (actual)) == 0) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s - expected '%s', got '%s' (line %d)\n", message, (expected), (actual), __LINE__); \
+    } \
+} while(0)
+
+static const char *TEST_DIR = "/tmp/finder_plus_archive_test";
+
+// Lines of the large member: line i is "%09d\n", so any offset can be checked
+#define BIG_LINES (4 * 1024 * 1024)
+#define BIG_LINE 10
+
+static void write_file(const char *path, const char *text)
+{
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fputs(text, f);
+        fclose(f);
+    }
+}
+
+// Helper: a tree to pack, a zip without folder entries, a tar and a tar.gz of it
+static bool setup_archives(void)
+{
+    char cmd[1024];
+    char path[512];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s && mkdir -p %s/src/docs/notes %s/src/empty %s/home",
+             TEST_DIR, TEST_DIR, TEST_DIR, TEST_DIR);
+    if (system(cmd) != 0) {
+        return false;
+    }
+    snprintf(path, sizeof(path), "%s/src/readme.txt", TEST_DIR);
+    write_file(path, "top level\n");
+    snprintf(path, sizeof(path), "%s/src/docs/a.txt", TEST_DIR);
+    write_file(path, "alpha alpha alpha\n");
+    snprintf(path, sizeof(path), "%s/src/docs/notes/b.txt", TEST_DIR);
+    write_file(path, "beta\n");
+    snprintf(path, sizeof(path), "%s/src/docs/big.txt", TEST_DIR);
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return false;
+    }
+    for (int i = 0; i < BIG_LINES; i++) {
+        fprintf(f, "%09d\n", i);
+    }
+    fclose(f);
+
+    snprintf(cmd, sizeof(cmd),
+             "cd %s/src && zip -qrD ../set.zip . && tar cf ../set.tar docs readme.txt empty && "
+             "tar czf ../set.tar.gz docs readme.txt empty && cp ../set.tar.gz ../other.tgz",
+             TEST_DIR);
+    return system(cmd) == 0;
+}
+
+// Helper: names of the items directly in folder inner, comma separated
+static void list_folder(Archive *archive, const char *inner, char *out, size_t size)
+{
+    int first, end;
+    out[0] = '\0';
+    if (!archive_folder(archive, inner, &first, &end)) {
+        snprintf(out, size, "(none)");
+        return;
+    }
+    for (int i = first; i < end; i = archive_next(archive, i)) {
+        ArchiveEntry entry;
+        archive_entry(archive, i, &entry);
+        size_t used = strlen(out);
+        snprintf(out + used, size - used, "%s%s%s", used ? "," : "", entry.name, entry.is_directory ? "/" : "");
+    }
+}
+
+// Helper: all of a member's contents (malloc'd), or NULL
+static char *read_member(Archive *archive, const char *inner, size_t *length)
+{
+    ArchiveReader *reader = archive_reader_open(archive, archive_find(archive, inner));
+    if (reader == NULL) {
+        return NULL;
+    }
+    size_t capacity = 1 << 16;
+    size_t used = 0;
+    char *data = malloc(capacity + 1);
+    for (;;) {
+        if (used == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity + 1);
+        }
+        ssize_t n = archive_reader_read(reader, data + used, capacity - used);
+        if (n < 0) {
+            free(data);
+            archive_reader_close(reader);
+            return NULL;
+        }
+        if (n == 0) {
+            break;
+        }
+        used += (size_t)n;
+    }
+    archive_reader_close(reader);
+    data[used] = '\0';
+    *length = used;
+    return data;
+}
+
+// Helper: whether the large member read back in full, line by line
+static bool big_member_ok(Archive *archive, const char *inner)
+{
+    size_t length = 0;
+    char *data = read_member(archive, inner, &length);
+    bool ok = data != NULL && length == (size_t)BIG_LINES * BIG_LINE;
+    for (int i = 0; ok && i < BIG_LINES; i += 4099) {
+        char line[BIG_LINE + 1];
+        snprintf(line, sizeof(line), "%09d\n", i);
+        ok = memcmp(data + (size_t)i * BIG_LINE, line, BIG_LINE) == 0;
+    }
+    free(data);
+    return ok;
+}
+
+static void test_archive_paths(void)
+{
+    printf("  Testing archive paths...\n");
+    TEST_ASSERT(archive_is_archive_name("set.ZIP") && archive_is_archive_name("a.tar.gz") &&
+                archive_is_archive_name("a.tgz") && archive_is_archive_name("a.tar"),
+                "Archive extensions should be recognized");
+    TEST_ASSERT(!archive_is_archive_name("a.gz") && !archive_is_archive_name("zip"),
+                "Other names should not be archives");
+
+    char archive_path[512], path[512];
+    const char *inner = NULL;
+    snprintf(path, sizeof(path), "%s/set.zip/docs/a.txt", TEST_DIR);
+    TEST_ASSERT(archive_split_path(path, archive_path, sizeof(archive_path), &inner),
+                "A path through a zip should split");
+    TEST_ASSERT_STR_EQ("docs/a.txt", inner, "Member path should follow the archive");
+    snprintf(path, sizeof(path), "%s/set.zip", TEST_DIR);
+    TEST_ASSERT(archive_split_path(path, archive_path, sizeof(archive_path), &inner) && inner[0] == '\0',
+                "The archive itself should split with an empty member path");
+    snprintf(path, sizeof(path), "%s/src/docs/a.txt", TEST_DIR);
+    TEST_ASSERT(!archive_split_path(path, archive_path, sizeof(archive_path), &inner),
+                "A plain path should not split");
+    snprintf(path, sizeof(path), "%s/src.zip/x", TEST_DIR);
+    TEST_ASSERT(!archive_split_path(path, archive_path, sizeof(archive_path), &inner),
+                "An archive name that is no file should not split");
+}
+
+static void test_archive_zip(void)
+{
+    printf("  Testing zip listing and reads...\n");
+    char path[512], names[512];
+    snprintf(path, sizeof(path), "%s/set.zip", TEST_DIR);
+    Archive *archive = archive_open(path, false, NULL);
+    TEST_ASSERT(archive != NULL, "A zip should list without a scan");
+    if (archive == NULL) {
+        return;
+    }
+
+    list_folder(archive, "", names, sizeof(names));
+    TEST_ASSERT_STR_EQ("docs/,readme.txt", names, "Top level should hold the made-up folder and the file");
+    list_folder(archive, "docs", names, sizeof(names));
+    TEST_ASSERT_STR_EQ("a.txt,big.txt,notes/", names, "Folders should list only their own items");
+    list_folder(archive, "docs/a.txt", names, sizeof(names));
+    TEST_ASSERT_STR_EQ("(none)", names, "A file should not list as a folder");
+
+    ArchiveEntry entry;
+    archive_entry(archive, archive_find(archive, "docs/notes/b.txt"), &entry);
+    TEST_ASSERT(entry.size == 5 && !entry.is_directory, "Entries should carry their sizes");
+
+    size_t length = 0;
+    char *text = read_member(archive, "docs/a.txt", &length);
+    TEST_ASSERT(text != NULL && strcmp(text, "alpha alpha alpha\n") == 0, "A deflated member should read back");
+    free(text);
+    TEST_ASSERT(big_member_ok(archive, "docs/big.txt"), "A large member should read back whole");
+
+    errno = 0;
+    TEST_ASSERT(archive_reader_open(archive, archive_find(archive, "docs")) == NULL && errno == EISDIR,
+                "A folder should not open for reading");
+    archive_release(archive);
+}
+
+static void test_archive_tar(void)
+{
+    printf("  Testing tar and tar.gz...\n");
+    char path[512], names[512];
+    snprintf(path, sizeof(path), "%s/set.tar", TEST_DIR);
+    errno = 0;
+    TEST_ASSERT(archive_open(path, false, NULL) == NULL && errno == EAGAIN,
+                "A tar without an index should ask for a scan");
+    Archive *archive = archive_open(path, true, NULL);
+    TEST_ASSERT(archive != NULL, "A tar should list with a scan");
+    if (archive != NULL) {
+        list_folder(archive, "", names, sizeof(names));
+        TEST_ASSERT_STR_EQ("docs/,empty/,readme.txt", names, "Tar folders should list, empty ones too");
+        size_t length = 0;
+        char *text = read_member(archive, "docs/notes/b.txt", &length);
+        TEST_ASSERT(text != NULL && strcmp(text, "beta\n") == 0, "A tar member should read back");
+        free(text);
+        archive_release(archive);
+    }
+
+    snprintf(path, sizeof(path), "%s/set.tar.gz", TEST_DIR);
+    archive = archive_open(path, true, NULL);
+    TEST_ASSERT(archive != NULL, "A tar.gz should list with a scan");
+    if (archive == NULL) {
+        return;
+    }
+    list_folder(archive, "docs", names, sizeof(names));
+    TEST_ASSERT_STR_EQ("a.txt,big.txt,notes/", names, "A tar.gz should list like the tar");
+    TEST_ASSERT(big_member_ok(archive, "docs/big.txt"), "A member spanning access points should read back");
+    size_t length = 0;
+    char *text = read_member(archive, "readme.txt", &length);
+    TEST_ASSERT(text != NULL && strcmp(text, "top level\n") == 0, "A member after the large one should read back");
+    free(text);
+    archive_release(archive);
+
+    // Push it out of the open archives: the saved index lists it again without a scan
+    char other[512];
+    for (int i = 0; i < ARCHIVE_OPEN_MAX; i++) {
+        snprintf(other, sizeof(other), "%s/copy%d.zip", TEST_DIR, i);
+        char cmd[1200];
+        snprintf(cmd, sizeof(cmd), "cp %s/set.zip %s", TEST_DIR, other);
+        system(cmd);
+        archive_release(archive_open(other, false, NULL));
+    }
+    archive = archive_open(path, false, NULL);
+    TEST_ASSERT(archive != NULL, "A scanned tar.gz should open from its saved index");
+    if (archive != NULL) {
+        text = read_member(archive, "readme.txt", &length);
+        TEST_ASSERT(text != NULL && strcmp(text, "top level\n") == 0, "Reads should work from the saved index");
+        free(text);
+        archive_release(archive);
+    }
+
+    atomic_bool cancel = true;
+    snprintf(path, sizeof(path), "%s/other.tgz", TEST_DIR);
+    errno = 0;
+    TEST_ASSERT(archive_open(path, true, &cancel) == NULL && errno == ECANCELED, "A scan should stop when cancelled");
+}
+
+#define COPY_THREADS 4
+
+typedef struct CopyRace {
+    char path[512];
+    char local[1024];
+    bool ok;
+} CopyRace;
+
+static void *copy_race_thread(void *arg)
+{
+    CopyRace *race = (CopyRace *)arg;
+    race->ok = archive_member_copy(race->path, UINT64_MAX, race->local, sizeof(race->local));
+    return NULL;
+}
+
+static void test_archive_copies(void)
+{
+    printf("  Testing member copies and sizes...\n");
+    char path[512], local[1024];
+    snprintf(path, sizeof(path), "%s/set.zip/docs/a.txt", TEST_DIR);
+    TEST_ASSERT(archive_member_copy(path, ARCHIVE_PREVIEW_MAX, local, sizeof(local)), "A member should copy out");
+    FILE *f = fopen(local, "r");
+    char text[64] = "";
+    if (f) {
+        fgets(text, sizeof(text), f);
+        fclose(f);
+    }
+    TEST_ASSERT_STR_EQ("alpha alpha alpha\n", text, "The copy should hold the member");
+    TEST_ASSERT(strstr(local, "a.txt") != NULL, "The copy should keep the member's name");
+
+    snprintf(path, sizeof(path), "%s/set.zip/docs/big.txt", TEST_DIR);
+    TEST_ASSERT(!archive_member_copy(path, 1024, local, sizeof(local)), "Members over the limit should not copy");
+
+    // Threads extracting the same member at once each write their own temporary file
+    if (archive_member_copy(path, UINT64_MAX, local, sizeof(local))) {
+        unlink(local);
+    }
+    CopyRace races[COPY_THREADS];
+    pthread_t threads[COPY_THREADS];
+    for (int i = 0; i < COPY_THREADS; i++) {
+        snprintf(races[i].path, sizeof(races[i].path), "%s", path);
+        pthread_create(&threads[i], NULL, copy_race_thread, &races[i]);
+    }
+    bool all_ok = true;
+    for (int i = 0; i < COPY_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        all_ok = all_ok && races[i].ok;
+    }
+    struct stat st;
+    TEST_ASSERT(all_ok, "Concurrent copies of a member should all succeed");
+    TEST_ASSERT(stat(races[0].local, &st) == 0 && st.st_size == (off_t)BIG_LINES * BIG_LINE,
+                "Concurrent copies should leave the whole member");
+
+    uint64_t bytes = 0;
+    snprintf(path, sizeof(path), "%s/set.zip/docs", TEST_DIR);
+    TEST_ASSERT(archive_path_size(path, &bytes) && bytes == 18 + 5 + (uint64_t)BIG_LINES * BIG_LINE,
+                "A folder's size should add up its files");
+    snprintf(path, sizeof(path), "%s/set.zip/missing", TEST_DIR);
+    TEST_ASSERT(!archive_path_size(path, &bytes), "Missing members should have no size");
+}
+
+static void test_archive_browse(void)
+{
+    printf("  Testing archives as folders...\n");
+    DirectoryState state;
+    directory_state_init(&state);
+    char path[512];
+
+    TEST_ASSERT(directory_read(&state, TEST_DIR), "Test folder should list");
+    bool enterable = false;
+    for (int i = 0; i < state.count; i++) {
+        if (strcmp(directory_entry_name(&state, &state.entries[i]), "set.zip") == 0) {
+            enterable = directory_entry_enterable(&state, &state.entries[i]) && !state.entries[i].is_directory;
+        }
+    }
+    TEST_ASSERT(enterable, "An archive file should be enterable");
+
+    snprintf(path, sizeof(path), "%s/set.zip/docs/", TEST_DIR);
+    TEST_ASSERT(directory_read(&state, path), "A folder in a zip should list");
+    TEST_ASSERT_EQ(3, state.count, "It should hold its three items");
+    TEST_ASSERT(state.count == 3 && state.entries[0].is_directory &&
+                strcmp(directory_entry_name(&state, &state.entries[0]), "notes") == 0,
+                "Folders should sort first as on disk");
+    snprintf(path, sizeof(path), "%s/set.zip/docs", TEST_DIR);
+    TEST_ASSERT(strstr(state.current_path, "set.zip/docs") != NULL &&
+                state.current_path[strlen(state.current_path) - 1] != '/',
+                "The path should run through the archive");
+    TEST_ASSERT(directory_go_parent(&state) && state.count == 2, "Going up should list the archive's top");
+
+    snprintf(path, sizeof(path), "%s/set.zip/readme.txt", TEST_DIR);
+    TEST_ASSERT(!directory_read(&state, path), "A member file should not list as a folder");
+
+    // A tar.gz not listed yet is read through on the stream worker
+    state.streaming = true;
+    snprintf(path, sizeof(path), "%s/other.tgz", TEST_DIR);
+    TEST_ASSERT(directory_read(&state, path), "A tar.gz should start listing");
+    directory_stream_wait(&state);
+    TEST_ASSERT_EQ(3, state.count, "The worker should list its top level");
+    directory_state_free(&state);
+
+    // Copies out of an archive
+    char dest[512], file[600];
+    snprintf(path, sizeof(path), "%s/set.zip/docs", TEST_DIR);
+    snprintf(dest, sizeof(dest), "%s/out", TEST_DIR);
+    CopyControl control;
+    copy_control_init(&control);
+    TEST_ASSERT(file_copy_to(path, dest, &control) == OP_SUCCESS, "A folder should copy out of a zip");
+    TEST_ASSERT(atomic_load(&control.bytes_done) == 18 + 5 + (long long)BIG_LINES * BIG_LINE,
+                "Progress should count every member byte");
+    snprintf(file, sizeof(file), "%s/notes/b.txt", dest);
+    struct stat st;
+    TEST_ASSERT(stat(file, &st) == 0 && st.st_size == 5, "Nested members should be extracted");
+    TEST_ASSERT(file_move_to(path, dest, NULL) != OP_SUCCESS, "Nothing should move out of an archive");
+}
+
+// Helper: little-endian fields of a hand-built zip
+static void put16(unsigned char *at, unsigned value)
+{
+    at[0] = (unsigned char)value;
+    at[1] = (unsigned char)(value >> 8);
+}
+
+static void put32(unsigned char *at, unsigned long value)
+{
+    put16(at, (unsigned)(value & 0xffff));
+    put16(at + 2, (unsigned)(value >> 16));
+}
+
+// Helper: a zip of stored members named as given (zip(1) will not write "../" names)
+static bool write_zip(const char *path, const char *const *names, const char *const *texts, int count)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return false;
+    }
+    unsigned char directory[4096];
+    size_t directory_size = 0;
+    long offset = 0;
+    for (int i = 0; i < count; i++) {
+        size_t name_length = strlen(names[i]);
+        size_t size = strlen(texts[i]);
+        unsigned long crc = crc32(0L, (const Bytef *)texts[i], (uInt)size);
+        unsigned char header[30] = { 0 };
+        put32(header, 0x04034b50);
+        put16(header + 4, 20);
+        put16(header + 12, 0x21);
+        put32(header + 14, crc);
+        put32(header + 18, size);
+        put32(header + 22, size);
+        put16(header + 26, (unsigned)name_length);
+        fwrite(header, 1, sizeof(header), f);
+        fwrite(names[i], 1, name_length, f);
+        fwrite(texts[i], 1, size, f);
+
+        unsigned char *central = directory + directory_size;
+        memset(central, 0, 46);
+        put32(central, 0x02014b50);
+        put16(central + 4, 20);
+        put16(central + 6, 20);
+        put16(central + 14, 0x21);
+        put32(central + 16, crc);
+        put32(central + 20, size);
+        put32(central + 24, size);
+        put16(central + 28, (unsigned)name_length);
+        put32(central + 42, (unsigned long)offset);
+        memcpy(central + 46, names[i], name_length);
+        directory_size += 46 + name_length;
+        offset += (long)(sizeof(header) + name_length + size);
+    }
+    unsigned char end[22] = { 0 };
+    put32(end, 0x06054b50);
+    put16(end + 8, (unsigned)count);
+    put16(end + 10, (unsigned)count);
+    put32(end + 12, directory_size);
+    put32(end + 16, (unsigned long)offset);
+    fwrite(directory, 1, directory_size, f);
+    fwrite(end, 1, sizeof(end), f);
+    return fclose(f) == 0;
+}
+
+// Helper: a ustar archive of files named as given
+static bool write_tar(const char *path, const char *const *names, const char *const *texts, int count)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return false;
+    }
+    unsigned char block[512];
+    for (int i = 0; i < count; i++) {
+        size_t size = strlen(texts[i]);
+        memset(block, 0, sizeof(block));
+        snprintf((char *)block, 100, "%s", names[i]);
+        snprintf((char *)block + 100, 8, "%07o", 0644);
+        snprintf((char *)block + 108, 8, "%07o", 0);
+        snprintf((char *)block + 116, 8, "%07o", 0);
+        snprintf((char *)block + 124, 12, "%011o", (unsigned)size);
+        snprintf((char *)block + 136, 12, "%011o", 1700000000u);
+        block[156] = '0';
+        memcpy(block + 257, "ustar", 6);
+        memcpy(block + 263, "00", 2);
+        memset(block + 148, ' ', 8);
+        unsigned sum = 0;
+        for (int b = 0; b < 512; b++) {
+            sum += block[b];
+        }
+        snprintf((char *)block + 148, 8, "%06o", sum);
+        fwrite(block, 1, sizeof(block), f);
+        memset(block, 0, sizeof(block));
+        memcpy(block, texts[i], size);
+        fwrite(block, 1, sizeof(block), f);
+    }
+    memset(block, 0, sizeof(block));
+    fwrite(block, 1, sizeof(block), f);
+    fwrite(block, 1, sizeof(block), f);
+    return fclose(f) == 0;
+}
+
+static void test_archive_unsafe_names(void)
+{
+    printf("  Testing members named outside the archive...\n");
+    const char *zip_names[] = { "dir/ok.txt", "dir/../../../escaped.txt", "dir/./dot.txt" };
+    const char *tar_names[] = { "dir/ok.txt", "../escaped.txt", "dir/../../../escaped.txt" };
+    const char *texts[] = { "ok\n", "escaped\n", "dot\n" };
+    char path[512], names[512], dest[512], escaped[512], cmd[600];
+    snprintf(escaped, sizeof(escaped), "%s/escaped.txt", TEST_DIR);
+    snprintf(cmd, sizeof(cmd), "mkdir -p %s/work/dest", TEST_DIR);
+    system(cmd);
+
+    for (int kind = 0; kind < 2; kind++) {
+        snprintf(path, sizeof(path), "%s/evil.%s", TEST_DIR, kind == 0 ? "zip" : "tar");
+        bool written = kind == 0 ? write_zip(path, zip_names, texts, 3) : write_tar(path, tar_names, texts, 3);
+        Archive *archive = written ? archive_open(path, true, NULL) : NULL;
+        TEST_ASSERT(archive != NULL, kind == 0 ? "A zip with '..' members should open" : "A tar with '..' members should open");
+        if (archive == NULL) {
+            continue;
+        }
+        list_folder(archive, "", names, sizeof(names));
+        TEST_ASSERT_STR_EQ("dir/", names, "Members naming '..' should not list at the top");
+        list_folder(archive, "dir", names, sizeof(names));
+        TEST_ASSERT_STR_EQ("ok.txt", names, "Members with '.' or '..' parts should be dropped");
+        archive_release(archive);
+
+        snprintf(path, sizeof(path), "%s/evil.%s/dir", TEST_DIR, kind == 0 ? "zip" : "tar");
+        snprintf(dest, sizeof(dest), "%s/work/dest/dir%d", TEST_DIR, kind);
+        CopyControl control;
+        copy_control_init(&control);
+        unlink(escaped);
+        TEST_ASSERT(file_copy_to(path, dest, &control) == OP_SUCCESS, "The safe members should copy out");
+        TEST_ASSERT(access(escaped, F_OK) != 0, "Nothing should be written outside the destination");
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/ok.txt", dest);
+        TEST_ASSERT(stat(path, &st) == 0 && st.st_size == 3, "The safe member should be extracted");
+    }
+}
+
+void test_archive(void)
+{
+    if (!setup_archives()) {
+        printf("  SKIP: Failed to build test archives (zip and tar needed)\n");
+        return;
+    }
+
+    // Indexes and member copies go under HOME
+    char *home = getenv("HOME") ? strdup(getenv("HOME")) : NULL;
+    char test_home[512];
+    snprintf(test_home, sizeof(test_home), "%s/home", TEST_DIR);
+    setenv("HOME", test_home, 1);
+
+    test_archive_paths();
+    test_archive_zip();
+    test_archive_tar();
+    test_archive_copies();
+    test_archive_browse();
+    test_archive_unsafe_names();
+
+    if (home) {
+        setenv("HOME", home, 1);
+        free(home);
+    }
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", TEST_DIR);
+    system(cmd);
+}
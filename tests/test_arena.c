@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#include "../src/utils/arena.h"
+#include "../src/utils/perf.h"
+
+static void test_arena_alloc(void)
+{
+    Arena arena;
+    arena_init(&arena, 1024);
+
+    char *a = arena_alloc(&arena, 3);
+    char *b = arena_alloc(&arena, 5);
+    TEST_ASSERT(a && b && b - a == ARENA_ALIGN, "Allocations should be packed at the alignment");
+    TEST_ASSERT(((uintptr_t)a % ARENA_ALIGN) == 0 && ((uintptr_t)b % ARENA_ALIGN) == 0,
+                "Allocations should be aligned");
+
+    char *text = arena_strdup(&arena, "hello");
+    TEST_ASSERT(text && strcmp(text, "hello") == 0, "strdup should copy the string");
+
+    int *zeros = arena_calloc(&arena, 8, sizeof(int));
+    bool all_zero = zeros != NULL;
+    for (int i = 0; all_zero && i < 8; i++) all_zero = zeros[i] == 0;
+    TEST_ASSERT(all_zero, "calloc should zero its memory");
+
+    // Larger than a block: gets a block of its own
+    char *big = arena_alloc(&arena, 5000);
+    TEST_ASSERT(big != NULL, "Oversized allocations should succeed");
+    memset(big, 'x', 5000);
+    TEST_ASSERT(strcmp(text, "hello") == 0, "Earlier allocations should survive growth");
+    TEST_ASSERT(arena_alloc(&arena, SIZE_MAX) == NULL, "Impossible sizes should fail");
+
+    arena_free(&arena);
+    TEST_ASSERT(arena.head == NULL && arena.reserved == 0, "Free should drop every block");
+}
+
+static void test_arena_scopes(void)
+{
+    Arena arena;
+    arena_init(&arena, 256);
+
+    char *keep = arena_strdup(&arena, "kept");
+    ArenaMark mark = arena_mark(&arena);
+    for (int i = 0; i < 20; i++) {
+        arena_alloc(&arena, 100);
+    }
+    TEST_ASSERT(arena.reserved > 256, "Scope should have grown the arena");
+    arena_release(&arena, mark);
+    TEST_ASSERT(arena.reserved == 256 && strcmp(keep, "kept") == 0,
+                "Release should drop the scope's blocks and keep what came before");
+    char *again = arena_alloc(&arena, 16);
+    TEST_ASSERT(again == keep + ARENA_ALIGN, "Release should rewind the marked block");
+
+    // After a reset the arena is one block as large as it grew
+    for (int i = 0; i < 20; i++) {
+        arena_alloc(&arena, 100);
+    }
+    size_t grown = arena.reserved;
+    arena_reset(&arena);
+    TEST_ASSERT(arena.reserved == grown, "Reset should keep as much room as before");
+    size_t before = memory_tag_bytes(MEMORY_TAG_ARENA);
+    for (int i = 0; i < 20; i++) {
+        arena_alloc(&arena, 100);
+    }
+    TEST_ASSERT(arena.reserved == grown && memory_tag_bytes(MEMORY_TAG_ARENA) == before,
+                "The same work after a reset should allocate nothing");
+
+    arena_free(&arena);
+}
+
+void test_arena(void)
+{
+    test_arena_alloc();
+    test_arena_scopes();
+}
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#include "../src/utils/cache_registry.h"
+
+// A cache that holds bytes and shrinks to whatever it is asked, in steps of step
+typedef struct FakeCache {
+    size_t bytes;
+    size_t step;
+    int trims;
+} FakeCache;
+
+static size_t fake_bytes(void *cache)
+{
+    return ((FakeCache *)cache)->bytes;
+}
+
+static void fake_trim(void *cache, size_t target)
+{
+    FakeCache *fake = (FakeCache *)cache;
+    fake->trims++;
+    while (fake->bytes > target) {
+        fake->bytes = fake->bytes > fake->step ? fake->bytes - fake->step : 0;
+    }
+}
+
+static void test_cache_registry_budget(void)
+{
+    FakeCache cheap = { 400, 100, 0 };
+    FakeCache medium = { 400, 100, 0 };
+    FakeCache costly = { 400, 400, 0 };
+    cache_registry_set_budget(1000);
+    cache_registry_add(&(CacheClient){ "costly", CACHE_COST_HIGH, fake_bytes, fake_trim, &costly });
+    cache_registry_add(&(CacheClient){ "medium", CACHE_COST_MEDIUM, fake_bytes, fake_trim, &medium });
+    cache_registry_add(&(CacheClient){ "cheap", CACHE_COST_LOW, fake_bytes, fake_trim, &cheap });
+    TEST_ASSERT(cache_registry_used() == 1200, "Used should add up every cache");
+
+    size_t released = cache_registry_update(CACHE_PRESSURE_NONE);
+    TEST_ASSERT(released == 200, "Only the excess over the budget should be released");
+    TEST_ASSERT(cheap.bytes == 200 && medium.bytes == 400 && costly.bytes == 400,
+                "The cheapest cache to rebuild should be trimmed first");
+
+    // More than the cheap cache holds: it empties, then the next cost pays the rest
+    cache_registry_set_budget(500);
+    cache_registry_update(CACHE_PRESSURE_NONE);
+    TEST_ASSERT(cheap.bytes == 0 && medium.bytes == 100 && costly.bytes == 400,
+                "Trimming should move to costlier caches only when needed");
+
+    int trims = cheap.trims + medium.trims + costly.trims;
+    TEST_ASSERT(cache_registry_update(CACHE_PRESSURE_NONE) == 0 &&
+                cheap.trims + medium.trims + costly.trims == trims,
+                "Nothing should be trimmed within the budget");
+
+    cache_registry_remove(&cheap);
+    cache_registry_remove(&medium);
+    cache_registry_remove(&costly);
+    TEST_ASSERT(cache_registry_used() == 0, "Removed caches should not be counted");
+    cache_registry_set_budget(0);
+    TEST_ASSERT(cache_registry_budget() == CACHE_REGISTRY_DEFAULT_BUDGET, "Zero should restore the default budget");
+}
+
+static void test_cache_registry_pressure(void)
+{
+    FakeCache cheap = { 300, 100, 0 };
+    FakeCache costly = { 500, 500, 0 };
+    cache_registry_add(&(CacheClient){ "cheap", CACHE_COST_LOW, fake_bytes, fake_trim, &cheap });
+    cache_registry_add(&(CacheClient){ "costly", CACHE_COST_HIGH, fake_bytes, fake_trim, &costly });
+
+    TEST_ASSERT(cache_registry_update(CACHE_PRESSURE_NONE) == 0, "Within the default budget nothing is trimmed");
+
+    // Half of 800: the cheap cache goes first, and the costly one is whole or nothing
+    cache_registry_update(CACHE_PRESSURE_WARN);
+    TEST_ASSERT(cheap.bytes == 0 && costly.bytes == 0, "A warning should trim to half of what is held");
+
+    cheap.bytes = 300;
+    costly.bytes = 500;
+    cache_registry_update(CACHE_PRESSURE_CRITICAL);
+    TEST_ASSERT(cheap.bytes == 0 && costly.bytes == 0, "Critical pressure should empty every cache");
+
+    cache_registry_remove(&cheap);
+    cache_registry_remove(&costly);
+}
+
+static void test_cache_registry_full(void)
+{
+    FakeCache caches[CACHE_REGISTRY_MAX + 1];
+    int added = 0;
+    for (int i = 0; i <= CACHE_REGISTRY_MAX; i++) {
+        caches[i] = (FakeCache){ 0, 1, 0 };
+        if (cache_registry_add(&(CacheClient){ "fake", CACHE_COST_LOW, fake_bytes, fake_trim, &caches[i] })) {
+            added++;
+        }
+    }
+    TEST_ASSERT(added == CACHE_REGISTRY_MAX, "The registry should refuse clients once full");
+    TEST_ASSERT(!cache_registry_add(&(CacheClient){ "bad", CACHE_COST_LOW, NULL, fake_trim, &caches[0] }),
+                "A client without a size function should be refused");
+    for (int i = 0; i <= CACHE_REGISTRY_MAX; i++) {
+        cache_registry_remove(&caches[i]);
+    }
+}
+
+void test_cache_registry(void)
+{
+    test_cache_registry_budget();
+    test_cache_registry_pressure();
+    test_cache_registry_full();
+}
@@ -68,6 +68,45 @@ static void test_request_model(void)
     claude_request_cleanup(&req);
 }
 
+static void test_model_routing(void)
+{
+    claude_routing_reset();
+    ClaudeMessageRequest req;
+    claude_request_init(&req);
+
+    claude_request_set_feature(&req, CLAUDE_FEATURE_HOVER_SUMMARY);
+    TEST_ASSERT(strcmp(req.model, CLAUDE_FAST_MODEL) == 0 && req.routed && req.tier == CLAUDE_TIER_FAST,
+                "Hover summaries use the fast tier");
+    claude_request_set_feature(&req, CLAUDE_FEATURE_AGENT);
+    TEST_ASSERT(strcmp(req.model, CLAUDE_BALANCED_MODEL) == 0, "Agent runs use the balanced tier");
+
+    claude_routing_set_model(CLAUDE_TIER_BALANCED, "claude-test-model");
+    claude_request_set_feature(&req, CLAUDE_FEATURE_AGENT);
+    TEST_ASSERT(strcmp(req.model, "claude-test-model") == 0, "Tier model can be replaced");
+    claude_routing_set_model(CLAUDE_TIER_BALANCED, "");
+    claude_request_set_feature(&req, CLAUDE_FEATURE_AGENT);
+    TEST_ASSERT(strcmp(req.model, CLAUDE_BALANCED_MODEL) == 0, "Empty model restores the default");
+
+    TEST_ASSERT(claude_routing_parse("agent=capable, rename=Balanced"), "Routing spec parses");
+    TEST_ASSERT(claude_routing_tier(CLAUDE_FEATURE_AGENT) == CLAUDE_TIER_CAPABLE &&
+                claude_routing_tier(CLAUDE_FEATURE_RENAME) == CLAUDE_TIER_BALANCED &&
+                claude_routing_tier(CLAUDE_FEATURE_SUMMARY) == CLAUDE_TIER_FAST,
+                "Spec changes only the features it names");
+    TEST_ASSERT(!claude_routing_parse("agent=huge,bogus=fast,summary") &&
+                claude_routing_tier(CLAUDE_FEATURE_AGENT) == CLAUDE_TIER_CAPABLE,
+                "Unknown entries are reported and skipped");
+
+    claude_request_set_feature(&req, CLAUDE_FEATURE_HOVER_SUMMARY);
+    claude_request_set_model(&req, "claude-pinned");
+    TEST_ASSERT(!req.routed && strcmp(req.model, "claude-pinned") == 0, "Explicit model pins the request");
+
+    claude_routing_reset();
+    TEST_ASSERT(claude_routing_tier(CLAUDE_FEATURE_AGENT) == CLAUDE_TIER_BALANCED, "Reset restores routes");
+    TEST_ASSERT(strcmp(claude_feature_name(CLAUDE_FEATURE_NL_OPERATIONS), "nl_operations") == 0 &&
+                strcmp(claude_tier_name(CLAUDE_TIER_CAPABLE), "capable") == 0, "Names match the spec syntax");
+    claude_request_cleanup(&req);
+}
+
 static void test_request_max_tokens(void)
 {
     ClaudeMessageRequest req;
@@ -226,6 +265,32 @@ static void test_parse_response_error(void)
     claude_response_cleanup(&resp);
 }
 
+static void test_parse_response_cache_usage(void)
+{
+    const char *json =
+        "{"
+        "  \"id\": \"msg_456\","
+        "  \"content\": [{\"type\": \"text\", \"text\": \"Done\"}],"
+        "  \"stop_reason\": \"end_turn\","
+        "  \"usage\": {"
+        "    \"input_tokens\": 12,"
+        "    \"cache_creation_input_tokens\": 0,"
+        "    \"cache_read_input_tokens\": 2048,"
+        "    \"output_tokens\": 5"
+        "  }"
+        "}";
+
+    ClaudeMessageResponse resp;
+    bool success = claude_parse_response(json, &resp);
+
+    TEST_ASSERT(success == true, "Parse succeeds with cache usage");
+    TEST_ASSERT(resp.input_tokens == 12, "Uncached input tokens parsed");
+    TEST_ASSERT(resp.cache_creation_tokens == 0, "Cache write tokens parsed");
+    TEST_ASSERT(resp.cache_read_tokens == 2048, "Cache read tokens parsed");
+
+    claude_response_cleanup(&resp);
+}
+
 static void test_auth_from_env(void)
 {
     AuthState auth;
@@ -298,6 +363,7 @@ void test_claude_client(void)
     test_client_create_destroy();
     test_request_init();
     test_request_model();
+    test_model_routing();
     test_request_max_tokens();
     test_request_system_prompt();
     test_request_messages();
@@ -306,6 +372,7 @@ void test_claude_client(void)
     test_parse_response_success();
     test_parse_response_tool_use();
     test_parse_response_error();
+    test_parse_response_cache_usage();
     test_auth_from_env();
     test_real_api_request();
 }
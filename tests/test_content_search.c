@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "core/content_search.h"
+
+// Test helper functions
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+static char test_root[256];
+
+static void write_file(const char *name, const char *data, size_t len)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", test_root, name);
+    FILE *f = fopen(path, "wb");
+    if (f) {
+        fwrite(data, 1, len, f);
+        fclose(f);
+    }
+}
+
+static void write_text(const char *name, const char *text)
+{
+    write_file(name, text, strlen(text));
+}
+
+static void make_dir(const char *name)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", test_root, name);
+    mkdir(path, 0755);
+}
+
+// Helper: Whether results hold a match in a file (by name below the root) at a line
+static bool has_match(const ContentSearchResults *results, const char *name, int line)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", test_root, name);
+    for (int i = 0; i < results->count; i++) {
+        if (strcmp(results->matches[i].path, path) == 0 && results->matches[i].line == line) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void setup_tree(void)
+{
+    snprintf(test_root, sizeof(test_root), "/tmp/finder_plus_content_search_%d", getpid());
+    mkdir(test_root, 0755);
+    make_dir("sub");
+    make_dir(".hidden");
+    make_dir("node_modules");
+
+    write_text("a.txt", "hello world\nfoo Bar baz\nanother foo line\n");
+    write_text("sub/b.c", "int main(void) {\n    return FOO_BAR;\n}\n");
+    write_file("bin.dat", "foo\0bar\n", 8);
+    write_text(".hidden/h.txt", "foo\n");
+    write_text("node_modules/x.js", "foo\n");
+    write_text(".ignore", "ignored.txt\n");
+    write_text("ignored.txt", "foo\n");
+
+    // Past the size files are mapped at, with one match near the end
+    size_t size = 2 * 1024 * 1024;
+    char *big = malloc(size + 64);
+    if (big) {
+        size_t len = 0;
+        int lines = 0;
+        while (len + 32 < size) {
+            len += (size_t)sprintf(big + len, "filler text line %d\n", lines++);
+        }
+        len += (size_t)sprintf(big + len, "the needle_xyz is here\n");
+        write_file("big.txt", big, len);
+        free(big);
+    }
+
+    // The needle at every offset, in mixed case, for the vector and tail paths
+    char mixed[8192];
+    size_t len = 0;
+    for (int i = 0; i < 40; i++) {
+        len += (size_t)sprintf(mixed + len, "%.*sNeEdLe tail\n", i, "........................................");
+    }
+    write_file("mixed.txt", mixed, len);
+}
+
+static void test_literal_search(void)
+{
+    ContentSearchOptions options = content_search_default_options();
+    ContentSearchResults results;
+
+    TEST_ASSERT(content_search(test_root, "foo", &options, &results), "Literal search succeeds");
+    TEST_ASSERT(results.count == 3, "Case-insensitive literal finds three lines");
+    TEST_ASSERT(has_match(&results, "a.txt", 2) && has_match(&results, "a.txt", 3), "Lines are numbered from 1");
+    TEST_ASSERT(has_match(&results, "sub/b.c", 2), "Subfolders are searched and case is folded");
+    TEST_ASSERT(results.count == 3 && strcmp(results.matches[1].text, "another foo line") == 0 &&
+                results.matches[1].column == 9, "Match carries its line text and column");
+    TEST_ASSERT(results.stats.files_binary == 1, "File with a NUL is skipped as binary");
+    TEST_ASSERT(!results.truncated, "Small search is not truncated");
+    content_search_results_free(&results);
+
+    options.case_sensitive = true;
+    content_search(test_root, "foo", &options, &results);
+    TEST_ASSERT(results.count == 2 && !has_match(&results, "sub/b.c", 2), "Case-sensitive literal skips FOO");
+    content_search_results_free(&results);
+
+    options.case_sensitive = false;
+    content_search(test_root, "needle_xyz", &options, &results);
+    TEST_ASSERT(results.count == 1 && strstr(results.matches[0].path, "big.txt") != NULL,
+                "Mapped large file is searched");
+    content_search_results_free(&results);
+
+    char mixed[512];
+    snprintf(mixed, sizeof(mixed), "%s/mixed.txt", test_root);
+    options.max_per_file = 0;
+    content_search(mixed, "needle", &options, &results);
+    TEST_ASSERT(results.count == 40, "Needle found at every offset in mixed case");
+    content_search_results_free(&results);
+}
+
+static void test_regex_search(void)
+{
+    ContentSearchOptions options = content_search_default_options();
+    options.regex = true;
+    ContentSearchResults results;
+
+    TEST_ASSERT(content_search(test_root, "fo+ [a-z]ar", &options, &results), "Regex search succeeds");
+    TEST_ASSERT(results.count == 1 && has_match(&results, "a.txt", 2), "Regex with a literal matches its line");
+    content_search_results_free(&results);
+
+    content_search(test_root, "hello|return", &options, &results);
+    TEST_ASSERT(results.count == 2 && has_match(&results, "sub/b.c", 2), "Alternation finds both sides");
+    content_search_results_free(&results);
+
+    content_search(test_root, "^}$", &options, &results);
+    TEST_ASSERT(results.count == 1 && has_match(&results, "sub/b.c", 3), "Anchors match at line starts");
+    content_search_results_free(&results);
+
+    char error[128];
+    TEST_ASSERT(!content_search_validate("(unclosed", &options, error, sizeof(error)) && error[0] != '\0',
+                "Invalid regex is reported");
+    TEST_ASSERT(!content_search(test_root, "(unclosed", &options, &results) && results.count == 0,
+                "Invalid regex does not search");
+    TEST_ASSERT(!content_search_validate("", NULL, NULL, 0), "Empty pattern is refused");
+}
+
+static void test_search_scope(void)
+{
+    ContentSearchOptions options = content_search_default_options();
+    ContentSearchResults results;
+
+    options.include_hidden = true;
+    options.respect_ignore_files = false;
+    content_search(test_root, "foo", &options, &results);
+    TEST_ASSERT(has_match(&results, ".hidden/h.txt", 1), "Hidden files are searched when asked");
+    TEST_ASSERT(has_match(&results, "ignored.txt", 1), "Ignore files can be disregarded");
+    TEST_ASSERT(!has_match(&results, "node_modules/x.js", 1), "Default excludes still apply");
+    content_search_results_free(&results);
+
+    const char *excludes[] = { "sub" };
+    options = content_search_default_options();
+    options.exclude_patterns = excludes;
+    options.exclude_count = 1;
+    content_search(test_root, "foo", &options, &results);
+    TEST_ASSERT(!has_match(&results, "sub/b.c", 2) && has_match(&results, "node_modules/x.js", 1),
+                "Own exclude patterns replace the defaults");
+    content_search_results_free(&results);
+
+    options = content_search_default_options();
+    options.max_results = 1;
+    content_search(test_root, "foo", &options, &results);
+    TEST_ASSERT(results.count == 1 && results.truncated, "Result cap stops the search");
+    content_search_results_free(&results);
+
+    char file[512];
+    snprintf(file, sizeof(file), "%s/a.txt", test_root);
+    options = content_search_default_options();
+    TEST_ASSERT(content_search(file, "world", &options, &results) && results.count == 1,
+                "A single file can be searched");
+    content_search_results_free(&results);
+}
+
+static void test_search_job(void)
+{
+    ContentSearchJob *job = content_search_start(test_root, "foo", NULL);
+    TEST_ASSERT(job != NULL, "Job starts");
+
+    ContentSearchResults results = {0};
+    while (!content_search_is_done(job)) {
+        content_search_poll(job, &results);
+        usleep(1000);
+    }
+    content_search_poll(job, &results);
+    TEST_ASSERT(results.count == 3, "Polling collects every match");
+    TEST_ASSERT(results.stats.files_searched > 0, "Stats arrive with the last poll");
+    content_search_cancel(job);
+    content_search_results_free(&results);
+
+    ContentSearchOptions options = content_search_default_options();
+    options.regex = true;
+    TEST_ASSERT(content_search_start(test_root, "[", &options) == NULL, "Invalid pattern starts no job");
+
+    // Cancelling a running job stops and frees it
+    job = content_search_start("/", "zzz_unlikely_needle", NULL);
+    content_search_cancel(job);
+    TEST_ASSERT(true, "Running job cancels");
+}
+
+void test_content_search(void)
+{
+    setup_tree();
+    test_literal_search();
+    test_regex_search();
+    test_search_scope();
+    test_search_job();
+
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", test_root);
+    system(cmd);
+}
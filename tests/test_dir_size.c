@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#define TEST_ASSERT_EQ(expected, actual, message) do { \
+    inc_tests_run(); \
+    if ((expected) == (actual)) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s - expected %d, got %d (line %d)\n", message, (int)(expected), (int)(actual), __LINE__); \
+    } \
+} while(0)
+
+#include "../src/core/dir_size.h"
+#include "../src/core/fs_watch.h"
+#include "../src/core/treemap.h"
+
+// Long enough that only fs_watch_flush dispatches during a test
+#define TEST_COALESCE 60.0
+
+static char test_root[256];
+
+static void write_bytes(const char *relative, int count, const char *mode)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", test_root, relative);
+    FILE *f = fopen(path, mode);
+    if (f) {
+        for (int i = 0; i < count; i++) fputc('x', f);
+        fclose(f);
+    }
+}
+
+static void make_dir(const char *relative)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", test_root, relative);
+    mkdir(path, 0755);
+}
+
+// Tree of 100 + 200 + 300 + 400 bytes, two levels deep
+static void setup_tree(void)
+{
+    strcpy(test_root, "/tmp/finder_plus_dir_size_XXXXXX");
+    if (!mkdtemp(test_root)) return;
+    make_dir("a");
+    make_dir("a/deep");
+    make_dir("b");
+    write_bytes("top.txt", 100, "w");
+    write_bytes("a/one.txt", 200, "w");
+    write_bytes("a/deep/two.txt", 300, "w");
+    write_bytes("b/three.txt", 400, "w");
+}
+
+static void cleanup_tree(void)
+{
+    char cmd[300];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", test_root);
+    system(cmd);
+}
+
+static void wait_idle(DirSizes *sizes)
+{
+    for (int i = 0; i < 500 && dir_sizes_is_busy(sizes); i++) {
+        usleep(10000);
+    }
+}
+
+static void test_dir_size_compute(void)
+{
+    printf("  Testing folder size rollups...\n");
+    setup_tree();
+    DirSizes *sizes = dir_sizes_create();
+    TEST_ASSERT(sizes != NULL, "Size service should start");
+
+    TEST_ASSERT_EQ(1000, dir_sizes_compute(sizes, test_root), "Whole tree should be summed");
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/a", test_root);
+    TEST_ASSERT_EQ(500, dir_sizes_compute(sizes, path), "Subfolder rollup should be cached");
+    off_t size = 0;
+    TEST_ASSERT(dir_sizes_query(sizes, path, &size) && size == 500, "Query should return the cached rollup");
+
+    // Growing a file leaves its folder's mtime alone: only an invalidation recounts
+    write_bytes("a/deep/two.txt", 50, "a");
+    TEST_ASSERT_EQ(1000, dir_sizes_compute(sizes, test_root), "Unchanged folders should come from the cache");
+    snprintf(path, sizeof(path), "%s/a/deep", test_root);
+    dir_sizes_invalidate(sizes, path);
+    TEST_ASSERT_EQ(1050, dir_sizes_compute(sizes, test_root), "Invalidation should reach every ancestor");
+
+    // A new file changes the folder's mtime, which is caught without an invalidation
+    sleep(1);
+    write_bytes("b/four.txt", 10, "w");
+    snprintf(path, sizeof(path), "%s/b", test_root);
+    TEST_ASSERT_EQ(410, dir_sizes_compute(sizes, path), "Modified folder should be recounted");
+
+    dir_sizes_destroy(sizes);
+    cleanup_tree();
+}
+
+static void test_dir_size_query(void)
+{
+    printf("  Testing background size queries...\n");
+    setup_tree();
+    DirSizes *sizes = dir_sizes_create();
+    FsWatch *watch = fs_watch_create(TEST_COALESCE);
+    TEST_ASSERT(dir_sizes_watch(sizes, watch), "Size service should subscribe");
+
+    off_t size = 0;
+    TEST_ASSERT(!dir_sizes_query(sizes, test_root, &size), "Uncounted folder should be unknown");
+    wait_idle(sizes);
+    TEST_ASSERT(dir_sizes_query(sizes, test_root, &size), "Queried folder should be counted in the background");
+    TEST_ASSERT_EQ(1000, size, "Background count should match the tree");
+
+    // A change event marks the chain stale; the last size stays visible until recounted
+    write_bytes("b/three.txt", 100, "a");
+    char path[512];
+    snprintf(path, sizeof(path), "%s/b/three.txt", test_root);
+    fs_watch_notify(watch, path, FSEVENT_MODIFIED, FSEVENT_FLAG_IS_FILE);
+    fs_watch_flush(watch);
+    TEST_ASSERT(dir_sizes_query(sizes, test_root, &size) && size == 1000, "Stale size should still be shown");
+    wait_idle(sizes);
+    TEST_ASSERT(dir_sizes_query(sizes, test_root, &size), "Recounted folder should be known");
+    TEST_ASSERT_EQ(1100, size, "Change event should trigger a recount");
+
+    // Unsubscribes before the bus goes away
+    dir_sizes_destroy(sizes);
+    fs_watch_destroy(watch);
+    cleanup_tree();
+}
+
+// Lay out until a layout with every folder counted arrives
+static bool wait_treemap(Treemap *map, DirSizes *sizes, const char *root)
+{
+    for (int i = 0; i < 500; i++) {
+        wait_idle(sizes);
+        treemap_request(map, root, 800, 600);
+        while (treemap_is_busy(map) && !treemap_poll(map)) {
+            usleep(1000);
+        }
+        treemap_poll(map);
+        if (!treemap_is_partial(map) && treemap_total(map) > 0) return true;
+    }
+    return false;
+}
+
+static void test_treemap_layout(void)
+{
+    printf("  Testing treemap layout...\n");
+    setup_tree();
+    // More files than a folder keeps, folded into one rectangle
+    make_dir("many");
+    char name[64];
+    for (int i = 0; i < TREEMAP_MAX_FILES + 6; i++) {
+        snprintf(name, sizeof(name), "many/f%03d", i);
+        write_bytes(name, 100 + i, "w");
+    }
+    DirSizes *sizes = dir_sizes_create();
+    Treemap *map = treemap_create(sizes);
+    TEST_ASSERT(map != NULL, "Treemap service should start");
+
+    TEST_ASSERT(wait_treemap(map, sizes, test_root), "Layout should arrive once sizes are counted");
+    off_t expected = 1000;
+    for (int i = 0; i < TREEMAP_MAX_FILES + 6; i++) expected += 100 + i;
+    TEST_ASSERT(treemap_total(map) == expected, "Total should be the root's rollup");
+
+    int count;
+    const TreemapRect *rects = treemap_rects(map, &count);
+    double top_area = 0;
+    bool inside = true, parents_first = true;
+    int top = 0, other = -1, nested = -1;
+    for (int i = 0; i < count; i++) {
+        const TreemapRect *r = &rects[i];
+        inside &= r->x >= -0.01f && r->y >= -0.01f && r->x + r->width <= 800.01f && r->y + r->height <= 600.01f;
+        parents_first &= r->parent < i;
+        if (r->parent < 0) {
+            top++;
+            top_area += (double)r->width * r->height;
+        }
+        if (r->kind == TREEMAP_OTHER) other = i;
+        if (r->kind == TREEMAP_FILE && strcmp(treemap_rect_name(map, i), "one.txt") == 0) nested = i;
+    }
+    TEST_ASSERT_EQ(4, top, "Every root entry should get a rectangle");
+    TEST_ASSERT(top_area > 800.0 * 600.0 * 0.99, "Root entries should fill the map");
+    TEST_ASSERT(inside, "Rectangles should stay inside the map");
+    TEST_ASSERT(parents_first, "Parents should come before their children");
+    TEST_ASSERT(other >= 0 && rects[other].size == 100 + 101 + 102 + 103 + 104 + 105,
+                "Smallest files should fold into one rectangle");
+
+    char path[512], expected_path[512];
+    snprintf(expected_path, sizeof(expected_path), "%s/a/one.txt", test_root);
+    TEST_ASSERT(nested >= 0 && treemap_rect_path(map, nested, path, sizeof(path)) &&
+                strcmp(path, expected_path) == 0, "Nested rectangle should know its path");
+
+    treemap_destroy(map);
+    dir_sizes_destroy(sizes);
+    cleanup_tree();
+}
+
+void test_dir_size(void)
+{
+    test_dir_size_compute();
+    test_dir_size_query();
+    test_treemap_layout();
+}
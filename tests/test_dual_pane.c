@@ -3,6 +3,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <utime.h>
 
 // Test framework imports
 extern void inc_tests_run(void);
@@ -33,6 +34,7 @@ extern void inc_tests_failed(void);
 
 #include "../src/ui/dual_pane.h"
 #include "../src/core/filesystem.h"
+#include "../src/core/dir_compare.h"
 
 // Test directory path
 static char test_dir[PATH_MAX_LEN];
@@ -197,6 +199,126 @@ static void test_dual_pane_free(void)
     TEST_ASSERT(true, "Re-init and free should work without crash");
 }
 
+// Helper: Write a file with the given content and modification time
+static void write_file(const char *dir, const char *name, const char *content, time_t mtime)
+{
+    char path[PATH_MAX_LEN];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "w");
+    if (f) { fputs(content, f); fclose(f); }
+
+    struct utimbuf times = { mtime, mtime };
+    utime(path, &times);
+}
+
+// Helper: Index of a name in a listing, -1 if absent
+static int find_entry(DirectoryState *dir, const char *name)
+{
+    for (int i = 0; i < dir->count; i++) {
+        if (strcmp(directory_entry_name(dir, &dir->entries[i]), name) == 0) return i;
+    }
+    return -1;
+}
+
+// Helper: Wait for a background comparison and apply its results
+static void wait_for_comparison(DirCompare *cmp, DirectoryState *left, DirectoryState *right,
+                                CompareResult *left_results, CompareResult *right_results)
+{
+    for (int i = 0; i < 500 && dir_compare_is_busy(cmp); i++) {
+        usleep(10000);
+    }
+    dir_compare_poll(cmp, left_results, left->count, right_results, right->count);
+}
+
+static void test_dir_compare(void)
+{
+    char left_path[PATH_MAX_LEN];
+    char right_path[PATH_MAX_LEN];
+    char path[PATH_MAX_LEN];
+    time_t mtime = 1700000000;
+
+    snprintf(left_path, sizeof(left_path), "%s/compare_left", test_dir);
+    snprintf(right_path, sizeof(right_path), "%s/compare_right", test_dir);
+    mkdir(left_path, 0755);
+    mkdir(right_path, 0755);
+
+    write_file(left_path, "same.txt", "same", mtime);
+    write_file(right_path, "same.txt", "same", mtime);
+    write_file(left_path, "touched.txt", "abcd", mtime);
+    write_file(right_path, "touched.txt", "abcd", mtime + 60);
+    write_file(left_path, "edited.txt", "abcd", mtime);
+    write_file(right_path, "edited.txt", "abce", mtime);
+    write_file(left_path, "left.txt", "left", mtime);
+    write_file(right_path, "right.txt", "right", mtime);
+
+    // Identical trees, and trees differing two levels down
+    snprintf(path, sizeof(path), "%s/tree_same", left_path);
+    mkdir(path, 0755);
+    write_file(path, "a.txt", "a", mtime);
+    snprintf(path, sizeof(path), "%s/tree_same", right_path);
+    mkdir(path, 0755);
+    write_file(path, "a.txt", "a", mtime);
+
+    snprintf(path, sizeof(path), "%s/tree_diff", left_path);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/tree_diff/inner", left_path);
+    mkdir(path, 0755);
+    write_file(path, "b.txt", "b", mtime);
+    snprintf(path, sizeof(path), "%s/tree_diff", right_path);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/tree_diff/inner", right_path);
+    mkdir(path, 0755);
+    write_file(path, "b.txt", "bb", mtime);
+
+    DirectoryState left;
+    DirectoryState right;
+    directory_state_init(&left);
+    directory_state_init(&right);
+    directory_read(&left, left_path);
+    directory_read(&right, right_path);
+
+    CompareResult *left_results = malloc((left.count + 1) * sizeof(CompareResult));
+    CompareResult *right_results = malloc((right.count + 1) * sizeof(CompareResult));
+    int *left_match = malloc((left.count + 1) * sizeof(int));
+
+    // Metadata comparison from the listings alone
+    dir_compare_listings(&left, &right, false, left_results, right_results, left_match);
+    TEST_ASSERT_EQ(COMPARE_SAME, left_results[find_entry(&left, "same.txt")], "Same size and mtime should match");
+    TEST_ASSERT_EQ(COMPARE_DIFFERENT, left_results[find_entry(&left, "touched.txt")], "Different mtime should differ");
+    TEST_ASSERT_EQ(COMPARE_SAME, left_results[find_entry(&left, "edited.txt")], "Same size and mtime match without content checks");
+    TEST_ASSERT_EQ(COMPARE_LEFT_ONLY, left_results[find_entry(&left, "left.txt")], "Left-only file should be marked");
+    TEST_ASSERT_EQ(COMPARE_RIGHT_ONLY, right_results[find_entry(&right, "right.txt")], "Right-only file should be marked");
+    TEST_ASSERT_EQ(find_entry(&right, "same.txt"), left_match[find_entry(&left, "same.txt")], "Match should point at the right entry");
+    TEST_ASSERT_EQ(COMPARE_DIR, left_results[find_entry(&left, "tree_same")], "Directories should wait for the tree walk");
+
+    DirCompare *cmp = dir_compare_create();
+    TEST_ASSERT(cmp != NULL, "Comparer should be created");
+
+    dir_compare_request(cmp, &left, &right, left_results, left_match, false);
+    wait_for_comparison(cmp, &left, &right, left_results, right_results);
+    TEST_ASSERT(!dir_compare_is_busy(cmp), "Comparison should finish");
+    TEST_ASSERT_EQ(COMPARE_SAME, left_results[find_entry(&left, "tree_same")], "Identical trees should match");
+    TEST_ASSERT_EQ(COMPARE_DIFFERENT, left_results[find_entry(&left, "tree_diff")], "Nested difference should mark the tree");
+    TEST_ASSERT_EQ(COMPARE_DIFFERENT, right_results[find_entry(&right, "tree_diff")], "Both sides should be marked");
+
+    // Content comparison ignores mtimes and catches same-size edits
+    dir_compare_listings(&left, &right, true, left_results, right_results, left_match);
+    dir_compare_request(cmp, &left, &right, left_results, left_match, true);
+    wait_for_comparison(cmp, &left, &right, left_results, right_results);
+    TEST_ASSERT_EQ(COMPARE_SAME, left_results[find_entry(&left, "touched.txt")], "Touched file should match by content");
+    TEST_ASSERT_EQ(COMPARE_DIFFERENT, left_results[find_entry(&left, "edited.txt")], "Same-size edit should differ by content");
+    TEST_ASSERT_EQ(COMPARE_SAME, left_results[find_entry(&left, "tree_same")], "Identical trees should match by content");
+    TEST_ASSERT_EQ(COMPARE_DIFFERENT, left_results[find_entry(&left, "tree_diff")], "Nested difference should show by content");
+
+    dir_compare_cancel(cmp);
+    dir_compare_destroy(cmp);
+    free(left_results);
+    free(right_results);
+    free(left_match);
+    directory_state_free(&left);
+    directory_state_free(&right);
+}
+
 void test_dual_pane(void)
 {
     setup_test_dir();
@@ -208,6 +330,7 @@ void test_dual_pane(void)
     test_sync_scroll();
     test_compare_result_values();
     test_dual_pane_free();
+    test_dir_compare();
 
     cleanup_test_dir();
 }
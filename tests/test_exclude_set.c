@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#include "../src/utils/exclude_set.h"
+
+static bool name_matches(const ExcludeSet *set, const char *name)
+{
+    return exclude_set_match_name(set, name, strlen(name));
+}
+
+void test_exclude_set(void)
+{
+    // Test: an empty set excludes nothing
+    {
+        ExcludeSet *set = exclude_set_create();
+        TEST_ASSERT(set != NULL && exclude_set_count(set) == 0, "Should create an empty set");
+        TEST_ASSERT(!exclude_set_match(set, "/a/node_modules/b", 0), "Empty set should match nothing");
+        TEST_ASSERT(!exclude_set_match(NULL, "/a", 0), "NULL set should match nothing");
+        TEST_ASSERT(!exclude_set_add(set, ""), "Should refuse an empty pattern");
+        exclude_set_destroy(set);
+    }
+
+    ExcludeSet *set = exclude_set_create();
+    const char *patterns[] = { "node_modules", ".git", "*.log", "*.tar.gz", "build-?", "*~", "cache/*.tmp" };
+    for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+        exclude_set_add(set, patterns[i]);
+    }
+    TEST_ASSERT(exclude_set_count(set) == 7, "Should count every pattern");
+
+    // Test: literal names match the whole name only
+    {
+        TEST_ASSERT(name_matches(set, "node_modules"), "Literal name should match");
+        TEST_ASSERT(name_matches(set, ".git"), "Dotted literal should match");
+        TEST_ASSERT(!name_matches(set, "node_modules2"), "Longer name should not match");
+        TEST_ASSERT(!name_matches(set, "node"), "Prefix should not match");
+        TEST_ASSERT(!name_matches(set, ".gitignore"), "Literal is not a prefix");
+    }
+
+    // Test: "*.ext" suffixes, including ones with several dots
+    {
+        TEST_ASSERT(name_matches(set, "server.log"), "Suffix should match");
+        TEST_ASSERT(name_matches(set, "a.b.log"), "Suffix should match after several dots");
+        TEST_ASSERT(name_matches(set, ".log"), "Bare suffix should match as fnmatch does");
+        TEST_ASSERT(name_matches(set, "backup.tar.gz"), "Two-part suffix should match");
+        TEST_ASSERT(!name_matches(set, "backup.gz"), "Part of a suffix should not match");
+        TEST_ASSERT(!name_matches(set, "server.logs"), "Suffix must end the name");
+        TEST_ASSERT(!name_matches(set, "catalog"), "Suffix needs its dot");
+    }
+
+    // Test: other globs go through fnmatch
+    {
+        TEST_ASSERT(name_matches(set, "build-1"), "Question mark glob should match");
+        TEST_ASSERT(!name_matches(set, "build-12"), "Glob should match the whole name");
+        TEST_ASSERT(name_matches(set, "notes.txt~"), "Leading star glob should match");
+    }
+
+    // Test: every name after skip is checked, so whole subtrees are excluded
+    {
+        TEST_ASSERT(exclude_set_match(set, "/src/node_modules/lib/index.js", 0), "Excluded folder should exclude its contents");
+        TEST_ASSERT(exclude_set_match(set, "/src/app.log", 0), "Last name should be checked");
+        TEST_ASSERT(!exclude_set_match(set, "/src/app/index.js", 0), "Other paths should pass");
+        TEST_ASSERT(!exclude_set_match(set, "/node_modules/pkg/index.js", strlen("/node_modules")),
+                    "Names within skip should not be checked");
+        TEST_ASSERT(exclude_set_match(set, "/node_modules/pkg/.git", strlen("/node_modules/pkg")),
+                    "Only the new name should be checked after skip");
+        TEST_ASSERT(!exclude_set_match(set, "/a/b", 100), "Skip past the end should check nothing");
+    }
+
+    // Test: patterns with '/' match the whole path
+    {
+        TEST_ASSERT(exclude_set_match(set, "cache/x.tmp", 0), "Path glob should match");
+        TEST_ASSERT(!exclude_set_match(set, "cache/sub/x.tmp", 0), "Path glob star should not cross '/'");
+        TEST_ASSERT(!name_matches(set, "x.tmp"), "Path glob should not match a name alone");
+    }
+
+    exclude_set_destroy(set);
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils/file_type.h"
+#include "core/filesystem.h"
+
+// Test helper functions
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+static const char *test_file = "/tmp/finder_plus_file_type_test";
+
+// Helper: Write len bytes to the test file
+static void write_test_file(const void *bytes, size_t len)
+{
+    FILE *f = fopen(test_file, "wb");
+    fwrite(bytes, 1, len, f);
+    fclose(f);
+}
+
+static void test_file_type_extensions(void)
+{
+    // Every extension in the table finds itself, so the hash is perfect
+    bool all_found = true;
+    for (int id = 1; id < 256; id++) {
+        const FileTypeInfo *info = file_type_info((FileTypeId)id);
+        if (info->type_class == FILE_CLASS_NONE) {
+            break;
+        }
+        all_found &= file_type_from_extension(info->extension) == id;
+    }
+    TEST_ASSERT(all_found, "Every known extension should look up to its own entry");
+
+    FileTypeId jpg = file_type_from_extension("jpg");
+    TEST_ASSERT(file_type_class(jpg) == FILE_CLASS_IMAGE && file_type_has_trait(jpg, FILE_TRAIT_RASTER),
+                "jpg should be a raster image");
+    TEST_ASSERT(file_type_from_extension(".JPG") == jpg, "Lookups should ignore a dot and case");
+    TEST_ASSERT(strcmp(file_type_info(jpg)->group, "Photos") == 0, "jpg should be grouped with photos");
+    TEST_ASSERT(!file_type_has_trait(file_type_from_extension("svg"), FILE_TRAIT_RASTER),
+                "svg should not be a raster image");
+    TEST_ASSERT(file_type_is_text(file_type_from_extension("json")), "json should be text");
+    TEST_ASSERT(!file_type_is_text(file_type_from_extension("pdf")), "pdf should not be text");
+
+    TEST_ASSERT(file_type_from_extension("xyz") == FILE_TYPE_ID_NONE, "Unknown extensions should have no type");
+    TEST_ASSERT(file_type_from_extension("") == FILE_TYPE_ID_NONE, "An empty extension should have no type");
+    TEST_ASSERT(file_type_from_extension("averyveryverylongextension") == FILE_TYPE_ID_NONE,
+                "Overlong extensions should have no type");
+    TEST_ASSERT(strcmp(file_type_info(FILE_TYPE_ID_NONE)->group, "Other") == 0, "Unknown files should group as Other");
+}
+
+static void test_file_type_sniffing(void)
+{
+    write_test_file("\x89PNG\r\n\x1a\n\0\0\0\rIHDR", 16);
+    TEST_ASSERT(file_type_from_path(test_file) == file_type_from_extension("png"), "PNG bytes should sniff as png");
+
+    write_test_file("\0\0\0\x18" "ftypqt  \0\0\0\0", 16);
+    TEST_ASSERT(file_type_sniff(test_file) == file_type_from_extension("mov"), "QuickTime bytes should sniff as mov");
+
+    write_test_file("%PDF-1.7\n", 9);
+    TEST_ASSERT(file_type_sniff(test_file) == file_type_from_extension("pdf"), "PDF bytes should sniff as pdf");
+
+    const char *script = "#!/usr/bin/env python3\nprint('hi')\n";
+    write_test_file(script, strlen(script));
+    TEST_ASSERT(file_type_sniff(test_file) == file_type_from_extension("py"), "A python script should sniff as py");
+
+    const char *readme = "Finder Plus\n\nA file manager.\n";
+    write_test_file(readme, strlen(readme));
+    TEST_ASSERT(file_type_sniff(test_file) == file_type_from_extension("txt"), "Text should sniff as txt");
+
+    write_test_file("\x01\x02\x03\x00\xff", 5);
+    TEST_ASSERT(file_type_sniff(test_file) == FILE_TYPE_ID_NONE, "Unknown binary should have no type");
+    unlink(test_file);
+
+    TEST_ASSERT(file_type_sniff("/nonexistent/file") == FILE_TYPE_ID_NONE, "Missing files should have no type");
+    TEST_ASSERT(file_type_from_path("/nonexistent/photo.HEIC") == file_type_from_extension("heic"),
+                "Paths with an extension should not be read");
+}
+
+static void test_file_type_entries(void)
+{
+    DirectoryState state;
+    directory_state_init(&state);
+    FileEntry *entry = directory_append_entry(&state, "Report.Final.PDF");
+    TEST_ASSERT(entry && entry->file_type == file_type_from_extension("pdf"),
+                "Directory entries should carry their file type");
+    entry = directory_append_entry(&state, "Makefile");
+    TEST_ASSERT(entry && entry->file_type == FILE_TYPE_ID_NONE, "Entries without an extension should have no type");
+    directory_state_free(&state);
+}
+
+void test_file_type(void)
+{
+    test_file_type_extensions();
+    test_file_type_sniffing();
+    test_file_type_entries();
+}
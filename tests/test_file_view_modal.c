@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 // Test macros (implemented in test_main.c)
 extern void inc_tests_run(void);
@@ -310,4 +311,43 @@ void test_file_view_modal(void)
         TEST_ASSERT(modal.text_content == NULL, "Text content should be NULL after free");
         TEST_ASSERT_EQ(false, modal.visible, "Modal should not be visible after free");
     }
+
+    printf("  Testing file_view_modal_show_file...\n");
+    {
+        const char *path = "/tmp/finder_plus_file_view_test.txt";
+        FILE *f = fopen(path, "w");
+        for (int i = 0; i < 100; i++) fprintf(f, "row %d\n", i);
+        fclose(f);
+
+        FileViewModalState modal;
+        file_view_modal_init(&modal);
+        TEST_ASSERT(file_view_modal_show_file(&modal, path), "Should map a file");
+        TEST_ASSERT(modal.text_map != NULL && modal.text_content == NULL, "A mapped file should not be copied");
+        modal.visible_lines = 10;
+
+        file_view_modal_scroll_down(&modal, 3);
+        TEST_ASSERT_EQ(strlen("row 0\nrow 1\nrow 2\n"), modal.scroll_byte, "Should scroll by lines");
+        file_view_modal_scroll_up(&modal, 1);
+        TEST_ASSERT_EQ(strlen("row 0\nrow 1\n"), modal.scroll_byte, "Should scroll back by lines");
+
+        // 100 lines and the empty one after the last newline; ten on screen
+        file_view_modal_scroll_to_bottom(&modal);
+        size_t bottom = modal.scroll_byte;
+        file_view_modal_scroll_down(&modal, 5);
+        TEST_ASSERT(modal.scroll_byte == bottom, "Should not scroll past the last page");
+
+        file_view_modal_toggle_hex(&modal);
+        TEST_ASSERT(modal.hex && modal.scroll_byte % FILE_VIEW_HEX_ROW == 0, "Hex mode should start on a row");
+        file_view_modal_scroll_to_top(&modal);
+        file_view_modal_scroll_down(&modal, 2);
+        TEST_ASSERT_EQ(2 * FILE_VIEW_HEX_ROW, modal.scroll_byte, "Hex mode should scroll by rows");
+        file_view_modal_toggle_hex(&modal);
+        TEST_ASSERT_EQ(strlen("row 0\nrow 1\nrow 2\nrow 3\nrow 4\n"), modal.scroll_byte,
+                       "Text mode should go back to the line holding the row");
+
+        file_view_modal_hide(&modal);
+        TEST_ASSERT(modal.text_map == NULL && !modal.hex, "Hiding should unmap the file");
+        TEST_ASSERT(!file_view_modal_show_file(&modal, "/nonexistent/file.txt"), "Should fail for a missing file");
+        unlink(path);
+    }
 }
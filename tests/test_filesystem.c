@@ -1,10 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <sys/stat.h>
 
 #include "core/filesystem.h"
+#include "core/listing_prefetch.h"
 
 // Test helper functions
 extern void inc_tests_run(void);
@@ -81,6 +83,42 @@ static void teardown_test_dir(void)
     system(cmd);
 }
 
+// Check that state is ordered (directories first) by sort_by in the given direction
+static bool entries_in_order(const DirectoryState *state, SortBy sort_by, bool ascending)
+{
+    for (int i = 1; i < state->count; i++) {
+        const FileEntry *a = &state->entries[i - 1];
+        const FileEntry *b = &state->entries[i];
+        if (a->is_directory != b->is_directory) {
+            if (!a->is_directory) return false;
+            continue;
+        }
+
+        int cmp = 0;
+        switch (sort_by) {
+            case SORT_BY_NAME:
+                cmp = strcasecmp(directory_entry_name(state, a), directory_entry_name(state, b));
+                break;
+            case SORT_BY_SIZE:
+                cmp = (a->size > b->size) - (a->size < b->size);
+                break;
+            case SORT_BY_MODIFIED:
+                cmp = (a->modified > b->modified) - (a->modified < b->modified);
+                break;
+            case SORT_BY_TYPE:
+                cmp = strcasecmp(directory_entry_extension(state, a), directory_entry_extension(state, b));
+                if (cmp == 0) {
+                    cmp = strcasecmp(directory_entry_name(state, a), directory_entry_name(state, b));
+                }
+                break;
+        }
+        if (ascending ? cmp > 0 : cmp < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void test_filesystem(void)
 {
     printf("  Setting up test environment...\n");
@@ -186,7 +224,7 @@ void test_filesystem(void)
 
         bool found_symlink = false;
         for (int i = 0; i < state.count; i++) {
-            if (strcmp(state.entries[i].name, "link_to_file1.txt") == 0) {
+            if (strcmp(directory_entry_name(&state, &state.entries[i]), "link_to_file1.txt") == 0) {
                 TEST_ASSERT(state.entries[i].is_symlink, "Should detect symlink");
                 found_symlink = true;
                 break;
@@ -206,8 +244,9 @@ void test_filesystem(void)
 
         bool found_c_file = false;
         for (int i = 0; i < state.count; i++) {
-            if (strcmp(state.entries[i].name, "file2.c") == 0) {
-                TEST_ASSERT(strcmp(state.entries[i].extension, "c") == 0, "Should extract .c extension");
+            if (strcmp(directory_entry_name(&state, &state.entries[i]), "file2.c") == 0) {
+                TEST_ASSERT(strcmp(directory_entry_extension(&state, &state.entries[i]), "c") == 0,
+                            "Should extract .c extension");
                 found_c_file = true;
                 break;
             }
@@ -217,6 +256,348 @@ void test_filesystem(void)
         directory_state_free(&state);
     }
 
+    // Test: entry paths are built from current_path + name
+    {
+        DirectoryState state;
+        directory_state_init(&state);
+
+        directory_read(&state, test_dir);
+
+        bool path_ok = false;
+        for (int i = 0; i < state.count; i++) {
+            if (strcmp(directory_entry_name(&state, &state.entries[i]), "hello.txt") == 0) {
+                char path[512];
+                char expected[512];
+                snprintf(expected, sizeof(expected), "%s/hello.txt", test_dir);
+                directory_entry_path(&state, &state.entries[i], path, sizeof(path));
+                path_ok = strcmp(path, expected) == 0;
+                break;
+            }
+        }
+        TEST_ASSERT(path_ok, "Entry path should be current_path + name");
+
+        directory_state_free(&state);
+        TEST_ASSERT(state.names == NULL, "Name arena should be freed");
+    }
+
+    // Test: name arena append, copy and path collection
+    {
+        DirectoryState state;
+        directory_state_init(&state);
+        strcpy(state.current_path, "/");
+
+        FileEntry *fe = directory_append_entry(&state, "Photo.JPEG");
+        TEST_ASSERT(fe != NULL, "Should append entry");
+        TEST_ASSERT(strcmp(directory_entry_name(&state, fe), "Photo.JPEG") == 0, "Name should be interned");
+        TEST_ASSERT(strcmp(directory_entry_extension(&state, fe), "jpeg") == 0, "Extension should be lowercase");
+
+        fe = directory_append_entry(&state, "Makefile");
+        TEST_ASSERT(strcmp(directory_entry_extension(&state, fe), "") == 0, "No extension without dot");
+
+        // Force several arena reallocations
+        char name[32];
+        for (int i = 0; i < 2000; i++) {
+            snprintf(name, sizeof(name), "file_%04d.txt", i);
+            directory_append_entry(&state, name);
+        }
+        TEST_ASSERT_EQ(2002, state.count, "Should hold all appended entries");
+        TEST_ASSERT(strcmp(directory_entry_name(&state, &state.entries[0]), "Photo.JPEG") == 0,
+                    "Names should survive arena growth");
+        TEST_ASSERT(sizeof(FileEntry) < 128, "FileEntry should be compact");
+
+        DirectoryState copy;
+        directory_state_copy(&copy, &state);
+        TEST_ASSERT_EQ(state.count, copy.count, "Copy should have same count");
+        TEST_ASSERT(strcmp(directory_entry_name(&copy, &copy.entries[2001]), "file_1999.txt") == 0,
+                    "Copy should carry the name arena");
+
+        int indices[2] = {0, 2001};
+        const char *paths[2];
+        char *block = directory_collect_paths(&copy, indices, 2, paths, NULL);
+        TEST_ASSERT(block != NULL, "Should collect paths");
+        if (block) {
+            TEST_ASSERT(strcmp(paths[0], "/Photo.JPEG") == 0, "Root paths should not double the slash");
+            TEST_ASSERT(strcmp(paths[1], "/file_1999.txt") == 0, "Should build second path");
+            free(block);
+        }
+
+        TEST_ASSERT(copy.entries == state.entries, "Copy should share entries");
+
+        directory_sort(&copy, SORT_BY_NAME, true);
+        TEST_ASSERT(strcmp(directory_entry_name(&copy, &copy.entries[0]), "file_0000.txt") == 0,
+                    "Sort should order by interned names");
+        TEST_ASSERT(copy.entries != state.entries, "Sorting a shared copy should detach it");
+        TEST_ASSERT(strcmp(directory_entry_name(&state, &state.entries[0]), "Photo.JPEG") == 0,
+                    "Original should keep its order");
+
+        directory_state_free(&copy);
+        directory_state_free(&state);
+    }
+
+    // Test: copy-on-write sharing
+    {
+        DirectoryState state;
+        directory_state_init(&state);
+        directory_append_entry(&state, "a.txt");
+        directory_append_entry(&state, "b.txt");
+
+        DirectoryState first, second;
+        directory_state_copy(&first, &state);
+        directory_state_copy(&second, &first);
+        TEST_ASSERT(second.entries == state.entries, "Copies of copies should share entries");
+
+        // Writing through one holder leaves the others untouched
+        TEST_ASSERT(directory_state_make_writable(&first), "Should make copy writable");
+        TEST_ASSERT(first.entries != state.entries, "Writable copy should own its entries");
+        first.entries[0].git_status = FILE_GIT_MODIFIED;
+        TEST_ASSERT(state.entries[0].git_status == FILE_GIT_NONE, "Original should not see the write");
+        TEST_ASSERT(second.entries[0].git_status == FILE_GIT_NONE, "Other copy should not see the write");
+
+        // Appending to the original detaches it from the remaining copy
+        FileEntry *shared_entries = state.entries;
+        directory_append_entry(&state, "c.txt");
+        TEST_ASSERT_EQ(3, state.count, "Original should grow");
+        TEST_ASSERT_EQ(2, second.count, "Copy should keep its count");
+        TEST_ASSERT(second.entries == shared_entries, "Copy should keep the shared buffers");
+
+        // The last holder owns (and frees) the buffers; writing copies nothing
+        directory_state_free(&state);
+        TEST_ASSERT(directory_state_make_writable(&second), "Sole holder should be writable");
+        TEST_ASSERT(second.entries == shared_entries, "Sole holder should not copy");
+        TEST_ASSERT(strcmp(directory_entry_name(&second, &second.entries[1]), "b.txt") == 0,
+                    "Sole holder should keep names");
+
+        // Re-reading a shared state replaces its snapshot without touching the copy
+        DirectoryState reread;
+        directory_state_copy(&reread, &second);
+        directory_read(&reread, test_dir);
+        TEST_ASSERT(reread.entries != second.entries, "Re-read should not write into the snapshot");
+        TEST_ASSERT_EQ(2, second.count, "Snapshot should be unchanged");
+
+        directory_state_free(&reread);
+        directory_state_free(&first);
+        directory_state_free(&second);
+    }
+
+    // Test: key-based sort against every order, switching back and forth
+    {
+        DirectoryState state;
+        directory_state_init(&state);
+        srand(42);
+        static const char *stems[] = {"Report", "report_final", "REPORT_final_v2", "a", "Zeta", "photo_2024_", "b"};
+        static const char *exts[] = {"txt", "PDF", "jpeg", "", "md"};
+        for (int i = 0; i < 3000; i++) {
+            char name[64];
+            const char *ext = exts[rand() % 5];
+            snprintf(name, sizeof(name), "%s%d%s%s", stems[rand() % 7], rand() % 50,
+                     ext[0] ? "." : "", ext);
+            FileEntry *fe = directory_append_entry(&state, name);
+            fe->is_directory = rand() % 6 == 0;
+            fe->size = rand() % 4 == 0 ? 0 : (off_t)rand() * 1013;
+            fe->modified = (time_t)(rand() % 100000) - 50000;
+        }
+
+        bool all_ok = true;
+        SortBy orders[] = {SORT_BY_SIZE, SORT_BY_NAME, SORT_BY_TYPE, SORT_BY_MODIFIED};
+        for (int round = 0; round < 2; round++) {
+            for (int o = 0; o < 4; o++) {
+                directory_sort(&state, orders[o], true);
+                all_ok &= entries_in_order(&state, orders[o], true);
+                directory_sort(&state, orders[o], false);
+                all_ok &= entries_in_order(&state, orders[o], false);
+            }
+        }
+        TEST_ASSERT(all_ok, "Every sort order should hold, including cached reuse");
+        TEST_ASSERT_EQ(3000, state.count, "Sorting should keep every entry");
+
+        // Adding an entry invalidates cached orders
+        directory_append_entry(&state, "aaa_new");
+        directory_sort(&state, SORT_BY_NAME, true);
+        TEST_ASSERT(entries_in_order(&state, SORT_BY_NAME, true), "Sort after append should hold");
+
+        directory_state_free(&state);
+    }
+
+    // Test: column arrays, selection totals and sorting from the columns
+    {
+        DirectoryState state;
+        directory_state_init(&state);
+        srand(7);
+        for (int i = 0; i < 500; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "%sitem%d", i % 9 == 0 ? "." : "", i);
+            FileEntry *fe = directory_append_entry(&state, name);
+            fe->is_directory = i % 5 == 0;
+            fe->is_hidden = name[0] == '.';
+            fe->size = (off_t)(rand() % 100000);
+            fe->modified = (time_t)(rand() % 100000) - 50000;
+        }
+
+        const DirectoryColumns *columns = directory_columns(&state);
+        TEST_ASSERT(columns != NULL, "Should build columns");
+        bool match = columns->count == state.count;
+        for (int i = 0; match && i < state.count; i++) {
+            const FileEntry *fe = &state.entries[i];
+            match = columns->sizes[i] == fe->size && columns->mtimes[i] == fe->modified &&
+                    columns->name_offsets[i] == fe->name_offset &&
+                    ((columns->flags[i] & DIR_COLUMN_DIRECTORY) != 0) == fe->is_directory &&
+                    ((columns->flags[i] & DIR_COLUMN_HIDDEN) != 0) == fe->is_hidden;
+        }
+        TEST_ASSERT(match, "Columns should mirror the entries");
+        TEST_ASSERT(directory_columns(&state) == columns, "Unchanged entries should reuse the columns");
+
+        // Entries 0, 1, 2, 5 and 499, and a bit past the end
+        uint64_t mask[10] = {0};
+        mask[0] = (1ULL << 0) | (1ULL << 1) | (1ULL << 2) | (1ULL << 5);
+        mask[499 / 64] |= 1ULL << (499 % 64);
+        mask[9] = 1;
+        off_t expected = state.entries[1].size + state.entries[2].size + state.entries[499].size;
+        int files = 0;
+        TEST_ASSERT(directory_sum_sizes(&state, mask, 10, &files) == expected,
+                    "Total should add files only and skip bits past the end");
+        TEST_ASSERT_EQ(3, files, "Should count the files");
+
+        // Sorting with columns built reads the keys from them
+        directory_sort(&state, SORT_BY_SIZE, true);
+        bool ordered = entries_in_order(&state, SORT_BY_SIZE, true);
+        directory_columns(&state);
+        directory_sort(&state, SORT_BY_MODIFIED, false);
+        ordered &= entries_in_order(&state, SORT_BY_MODIFIED, false);
+        TEST_ASSERT(ordered, "Column-keyed sorts should hold");
+
+        // Moved entries invalidate the columns
+        columns = directory_columns(&state);
+        TEST_ASSERT(columns != NULL && columns->sizes[0] == state.entries[0].size &&
+                    columns->mtimes[state.count - 1] == state.entries[state.count - 1].modified,
+                    "Columns should follow the sorted entries");
+
+        directory_append_entry(&state, "late")->size = 11;
+        columns = directory_columns(&state);
+        TEST_ASSERT(columns != NULL && columns->count == 501 && columns->sizes[500] == 11,
+                    "Columns should be rebuilt after an append");
+
+        directory_state_free(&state);
+        TEST_ASSERT(state.columns == NULL, "Free should drop the columns");
+    }
+
+    // Test: streaming read of a large directory
+    {
+        char big_dir[600];
+        char cmd[1024];
+        snprintf(big_dir, sizeof(big_dir), "%s/big", test_dir);
+        snprintf(cmd, sizeof(cmd),
+                 "mkdir -p %s && cd %s && for i in $(seq 1 1500); do : > f$i.txt; done && mkdir zdir",
+                 big_dir, big_dir);
+        system(cmd);
+
+        DirectoryState state;
+        directory_state_init(&state);
+        state.streaming = true;
+
+        bool result = directory_read(&state, big_dir);
+        TEST_ASSERT(result, "Streaming read should succeed");
+        TEST_ASSERT(state.count >= DIR_STREAM_FIRST_BATCH, "First batch should be available immediately");
+        TEST_ASSERT(state.count <= 1501, "Should not exceed directory size");
+
+        // Follow two entries of the first batch by name while later batches sort in
+        int marked[2] = { 1, state.count - 1 };
+        char marked_names[2][64];
+        for (int m = 0; m < 2; m++) {
+            snprintf(marked_names[m], sizeof(marked_names[m]), "%s",
+                     directory_entry_name(&state, &state.entries[marked[m]]));
+        }
+        ListingMarks *marks = listing_marks_take(&state, marked, 2);
+        TEST_ASSERT(marks != NULL, "Marks should be taken on the first batch");
+
+        int polls = 0;
+        bool marks_followed = true;
+        while (state.is_loading && polls < 10000) {
+            if (directory_stream_poll(&state)) {
+                listing_marks_find(marks, &state, marked);
+                for (int m = 0; m < 2; m++) {
+                    if (marked[m] < 0 || strcmp(marked_names[m],
+                            directory_entry_name(&state, &state.entries[marked[m]])) != 0) {
+                        marks_followed = false;
+                    }
+                }
+            }
+            usleep(1000);
+            polls++;
+        }
+        listing_marks_free(marks);
+        TEST_ASSERT(marks_followed, "Marked entries should be found by name after each merge");
+        TEST_ASSERT(!state.is_loading, "Streaming read should finish");
+        TEST_ASSERT(state.stream == NULL, "Stream should be released");
+        TEST_ASSERT_EQ(1501, state.count, "Should merge all entries");
+        TEST_ASSERT(state.entries[0].is_directory, "Directory should sort first after merge");
+
+        bool sorted = true;
+        for (int i = 2; i < state.count; i++) {
+            if (strcasecmp(directory_entry_name(&state, &state.entries[i - 1]),
+                           directory_entry_name(&state, &state.entries[i])) > 0) {
+                sorted = false;
+                break;
+            }
+        }
+        TEST_ASSERT(sorted, "Merged entries should be sorted by name");
+
+        // A new read cancels an in-flight stream
+        directory_read(&state, big_dir);
+        directory_read(&state, test_dir);
+        TEST_ASSERT(state.stream == NULL, "Small directory should not start a stream");
+        TEST_ASSERT(!state.is_loading, "Small directory should load synchronously");
+
+        directory_read(&state, big_dir);
+        directory_stream_wait(&state);
+        TEST_ASSERT_EQ(1501, state.count, "Wait should merge all entries");
+
+        directory_state_free(&state);
+
+        snprintf(cmd, sizeof(cmd), "rm -rf %s", big_dir);
+        system(cmd);
+    }
+
+    // Test: parallel metadata fetch matches a single-threaded read
+    {
+        char meta_dir[600];
+        char cmd[1024];
+        snprintf(meta_dir, sizeof(meta_dir), "%s/meta", test_dir);
+        snprintf(cmd, sizeof(cmd),
+                 "mkdir -p %s && cd %s && for i in $(seq 1 200); do printf %%${i}s > f$i.dat; mkdir -p d$i; done",
+                 meta_dir, meta_dir);
+        system(cmd);
+
+        DirectoryState serial, parallel;
+        directory_state_init(&serial);
+        directory_state_init(&parallel);
+
+        directory_set_metadata_threads(1);
+        directory_read(&serial, meta_dir);
+        directory_set_metadata_threads(DIR_METADATA_THREADS_DEFAULT);
+        directory_read(&parallel, meta_dir);
+
+        TEST_ASSERT_EQ(400, serial.count, "Serial read should see all entries");
+        TEST_ASSERT_EQ(serial.count, parallel.count, "Parallel read should see the same entries");
+
+        bool same = serial.count == parallel.count;
+        for (int i = 0; same && i < serial.count; i++) {
+            const FileEntry *a = &serial.entries[i];
+            const FileEntry *b = &parallel.entries[i];
+            same = strcmp(directory_entry_name(&serial, a), directory_entry_name(&parallel, b)) == 0 &&
+                   strcmp(directory_entry_extension(&serial, a), directory_entry_extension(&parallel, b)) == 0 &&
+                   a->is_directory == b->is_directory && a->size == b->size &&
+                   a->modified == b->modified && a->permissions == b->permissions;
+        }
+        TEST_ASSERT(same, "Parallel metadata should match serial metadata");
+        TEST_ASSERT(parallel.entries[0].is_directory, "Stat'd directories should sort first");
+
+        directory_state_free(&serial);
+        directory_state_free(&parallel);
+
+        snprintf(cmd, sizeof(cmd), "rm -rf %s", meta_dir);
+        system(cmd);
+    }
+
     // Test: directory_go_parent
     {
         DirectoryState state;
@@ -245,7 +626,7 @@ void test_filesystem(void)
         // Find subdir1 index
         int subdir_index = -1;
         for (int i = 0; i < state.count; i++) {
-            if (strcmp(state.entries[i].name, "subdir1") == 0) {
+            if (strcmp(directory_entry_name(&state, &state.entries[i]), "subdir1") == 0) {
                 subdir_index = i;
                 break;
             }
@@ -285,6 +666,73 @@ void test_filesystem(void)
         TEST_ASSERT(strstr(buffer, "GB") != NULL, "Should format as GB");
     }
 
+    // Test: memoized size and date strings match the formatters
+    {
+        char buffer[32];
+
+        format_file_size(1536, buffer, sizeof(buffer));
+        TEST_ASSERT(strcmp(format_file_size_cached(1536), buffer) == 0, "Cached size should match format_file_size");
+        TEST_ASSERT(strcmp(format_file_size_cached(1536), buffer) == 0, "Cached size should be stable on a hit");
+        TEST_ASSERT(strcmp(format_file_size_cached(0), "0 B") == 0, "Cached size should format 0 bytes");
+
+        // Values sharing a slot replace each other without mixing up text
+        int mismatches = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            for (off_t size = 0; size < FORMAT_CACHE_SLOTS * 4; size += 7) {
+                format_file_size(size, buffer, sizeof(buffer));
+                if (strcmp(format_file_size_cached(size), buffer) != 0) mismatches++;
+            }
+        }
+        TEST_ASSERT(mismatches == 0, "Cached sizes should stay correct as slots are reused");
+
+        time_t now = time(NULL);
+        format_modified_time(now, buffer, sizeof(buffer));
+        TEST_ASSERT(strcmp(format_modified_time_cached(now), buffer) == 0, "Cached date should match format_modified_time");
+        TEST_ASSERT(strcmp(format_modified_time_cached(0), "--") == 0, "Cached date should show -- for no time");
+    }
+
+    // Test: listings read in the background
+    {
+        ListingPrefetch *prefetch = listing_prefetch_create();
+        TEST_ASSERT(prefetch != NULL, "Should create a listing prefetcher");
+
+        char subdir[600];
+        snprintf(subdir, sizeof(subdir), "%s/subdir1", test_dir);
+        listing_prefetch_request(prefetch, subdir, false, true);
+        listing_prefetch_request(prefetch, test_dir, true, true);   // Replaces the first
+        listing_prefetch_request(prefetch, test_dir, true, true);   // Already pending
+
+        char path[PATH_MAX_LEN];
+        DirectoryState listing;
+        bool ready = false;
+        for (int i = 0; i < 500 && !ready; i++) {
+            ready = listing_prefetch_poll(prefetch, path, sizeof(path), &listing);
+            if (!ready) usleep(10000);
+        }
+        TEST_ASSERT(ready, "Should finish a listing in the background");
+        if (ready) {
+            TEST_ASSERT(strcmp(path, test_dir) == 0, "Should hand over the folder the cursor rested on");
+            TEST_ASSERT(listing.show_hidden && listing.count > 0, "Should read with the requested hidden setting");
+            TEST_ASSERT(!listing.is_loading, "Should hand over a complete listing");
+            directory_state_free(&listing);
+        }
+
+        usleep(LISTING_PREFETCH_DEBOUNCE * 2e6);
+        TEST_ASSERT(!listing_prefetch_poll(prefetch, path, sizeof(path), &listing),
+                    "Replaced and repeated requests should not be read");
+        TEST_ASSERT(!listing_prefetch_is_busy(prefetch), "Should be idle once listings are taken");
+
+        listing_prefetch_request(prefetch, "/nonexistent/path/12345", false, false);
+        bool failed = false;
+        for (int i = 0; i < 500 && !failed; i++) {
+            failed = listing_prefetch_failed(prefetch, "/nonexistent/path/12345");
+            if (!failed) usleep(10000);
+        }
+        TEST_ASSERT(failed, "Should remember a folder that cannot be read");
+
+        listing_prefetch_destroy(prefetch);
+    }
+
     // Test: get_free_disk_space
     {
         off_t free_space = get_free_disk_space("/");
@@ -308,6 +756,107 @@ void test_filesystem(void)
         directory_state_free(&state);
     }
 
+    // Test: hidden entries are kept, so changing the view does not read the directory
+    {
+        DirectoryState state, full;
+        directory_state_init(&state);
+        directory_state_init(&full);
+        full.show_hidden = true;
+        directory_read(&state, test_dir);
+        directory_read(&full, test_dir);
+        int visible = state.count;
+        TEST_ASSERT_EQ(2, state.hidden_count, "Hidden entries should be kept out of the view");
+
+        // Only a fresh read would see this file
+        char later[1024];
+        snprintf(later, sizeof(later), "%s/.created_later", test_dir);
+        fclose(fopen(later, "w"));
+
+        TEST_ASSERT(directory_set_show_hidden(&state, true), "Showing hidden files should not need a read");
+        TEST_ASSERT_EQ(full.count, state.count, "Showing hidden files should bring back the kept entries");
+        bool same_order = state.count == full.count;
+        for (int i = 0; same_order && i < state.count; i++) {
+            same_order = strcmp(directory_entry_name(&state, &state.entries[i]),
+                                directory_entry_name(&full, &full.entries[i])) == 0;
+        }
+        TEST_ASSERT(same_order, "Hidden entries should return to their sorted places");
+
+        // Sorting while filtered sorts the kept entries too
+        directory_set_show_hidden(&state, false);
+        TEST_ASSERT_EQ(visible, state.count, "Filtering should leave the visible entries");
+        directory_sort(&state, SORT_BY_NAME, false);
+        directory_sort(&full, SORT_BY_NAME, false);
+        DirectoryState copy;
+        directory_state_copy(&copy, &state);
+        directory_set_show_hidden(&state, true);
+        same_order = state.count == full.count;
+        for (int i = 0; same_order && i < state.count; i++) {
+            same_order = strcmp(directory_entry_name(&state, &state.entries[i]),
+                                directory_entry_name(&full, &full.entries[i])) == 0;
+        }
+        TEST_ASSERT(same_order, "Entries filtered out while sorting should be sorted as well");
+        TEST_ASSERT(copy.count == visible && directory_set_show_hidden(&copy, true) && copy.count == full.count,
+                    "A copy should keep the view and its hidden entries");
+
+        unlink(later);
+        directory_state_free(&copy);
+        directory_state_free(&state);
+        directory_state_free(&full);
+    }
+
+    // Test: changes named by the watch bus patch the listing in place
+    {
+        DirectoryState state, fresh;
+        directory_state_init(&state);
+        directory_state_init(&fresh);
+        directory_read(&state, test_dir);
+        int before = state.count;
+
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/added.txt", test_dir);
+        fclose(fopen(path, "w"));
+        snprintf(path, sizeof(path), "%s/aaa_dir", test_dir);
+        mkdir(path, 0755);
+        snprintf(path, sizeof(path), "%s/file3.md", test_dir);
+        unlink(path);
+        snprintf(path, sizeof(path), "%s/.hidden_new", test_dir);
+        fclose(fopen(path, "w"));
+        snprintf(path, sizeof(path), "%s/file1.txt", test_dir);
+        FILE *grown = fopen(path, "w");
+        fputs("grown", grown);
+        fclose(grown);
+
+        const char *names[] = {"added.txt", "aaa_dir", "file3.md", ".hidden_new", "file1.txt",
+                               "added.txt", "never_existed", "sub/dir"};
+        int changed = directory_apply_changes(&state, names, 8);
+        TEST_ASSERT_EQ(5, changed, "Each real change should be counted once");
+        TEST_ASSERT_EQ(before + 1, state.count, "Two visible entries in, one out");
+        TEST_ASSERT(entries_in_order(&state, SORT_BY_NAME, true), "Patched entries should be in name order");
+
+        directory_read(&fresh, test_dir);
+        bool same = state.count == fresh.count && state.hidden_count == fresh.hidden_count;
+        for (int i = 0; same && i < state.count; i++) {
+            same = strcmp(directory_entry_name(&state, &state.entries[i]),
+                          directory_entry_name(&fresh, &fresh.entries[i])) == 0 &&
+                   (state.entries[i].size == fresh.entries[i].size || state.entries[i].is_symlink) &&
+                   state.entries[i].is_directory == fresh.entries[i].is_directory;
+        }
+        TEST_ASSERT(same, "A patched listing should match a fresh read");
+        TEST_ASSERT_EQ(0, directory_apply_changes(&state, names, 2), "Unchanged entries should not count");
+
+        fclose(fopen(path, "w"));  // Restore the fixture for the tests after
+        snprintf(path, sizeof(path), "%s/aaa_dir", test_dir);
+        rmdir(path);
+        snprintf(path, sizeof(path), "%s/added.txt", test_dir);
+        unlink(path);
+        snprintf(path, sizeof(path), "%s/.hidden_new", test_dir);
+        unlink(path);
+        snprintf(path, sizeof(path), "%s/file3.md", test_dir);
+        fclose(fopen(path, "w"));
+        directory_state_free(&fresh);
+        directory_state_free(&state);
+    }
+
     // Test: handles root directory
     {
         DirectoryState state;
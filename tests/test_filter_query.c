@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "core/filter_query.h"
+#include "utils/file_type.h"
+
+// Test helper functions
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#define NOW ((time_t)1700000000)
+#define DAY 86400
+
+// Helper: Entries matching a query in a listing, as a count; mask gets the bits
+static int run_query(DirectoryState *dir, const char *text, uint64_t *mask, int words)
+{
+    FilterQuery query;
+    filter_query_compile(&query, text, NOW);
+    return filter_query_run(&query, dir, mask, words);
+}
+
+static void test_filter_query_compile(void)
+{
+    FilterQuery query;
+    TEST_ASSERT(filter_query_compile(&query, "report ext:raw,dng size>50MB modified<30d final", NOW) &&
+                query.term_count == 3, "Filter terms should compile");
+    TEST_ASSERT(strcmp(query.text, "report final") == 0, "Other words should be kept for the name search");
+    TEST_ASSERT(query.terms[1].field == FILTER_FIELD_SIZE && query.terms[1].min == 50LL * 1024 * 1024 + 1,
+                "Sizes should be 1024-based and exclusive for >");
+    TEST_ASSERT(query.terms[2].min == NOW - 30 * DAY + 1, "Ages should count back from now");
+
+    TEST_ASSERT(!filter_query_compile(&query, "size>", NOW) && query.term_count == 0 && query.text[0] == '\0',
+                "A half-typed term should be skipped, not searched for");
+    TEST_ASSERT(!filter_query_compile(&query, "kind:spaceship", NOW) && strstr(query.error, "kind:spaceship"),
+                "Unknown values should be reported");
+    TEST_ASSERT(filter_query_compile(&query, "http://example.com todo:", NOW) && query.term_count == 0 &&
+                strcmp(query.text, "http://example.com todo:") == 0, "Unknown fields should stay text");
+    TEST_ASSERT(filter_query_compile(&query, "-ext:log", NOW) && query.terms[0].negate,
+                "A leading '-' should negate a term");
+}
+
+static void test_filter_query_listing(void)
+{
+    DirectoryState dir;
+    directory_state_init(&dir);
+
+    // 300 entries so the vector paths run over full words and the tail
+    for (int i = 0; i < 300; i++) {
+        char name[32];
+        const char *ext = i % 3 == 0 ? "raw" : (i % 3 == 1 ? "jpg" : "zzq");
+        snprintf(name, sizeof(name), "%sphoto%d.%s", i % 50 == 0 ? "." : "", i, ext);
+        FileEntry *fe = directory_append_entry(&dir, name);
+        fe->is_hidden = name[0] == '.';
+        fe->size = (off_t)i * 1024 * 1024;
+        fe->modified = NOW - (time_t)i * DAY;
+        fe->git_status = i % 7 == 0 ? FILE_GIT_MODIFIED : FILE_GIT_NONE;
+    }
+    FileEntry *folder = directory_append_entry(&dir, "Huge");
+    folder->is_directory = true;
+    folder->file_type = FILE_TYPE_ID_NONE;
+    folder->size = (off_t)1 << 40;
+    folder->modified = NOW;
+
+    uint64_t mask[5];
+    TEST_ASSERT(run_query(&dir, "", mask, 5) == 301, "No terms should pass every entry");
+    TEST_ASSERT(mask[4] == (1ULL << (301 - 256)) - 1, "Bits past the last entry should stay clear");
+
+    TEST_ASSERT(run_query(&dir, "ext:raw", mask, 5) == 100 && (mask[0] & 0xF) == 0x9,
+                "ext: should select by extension");
+    TEST_ASSERT(run_query(&dir, "ext:ZZQ", mask, 5) == 100, "Extensions without a table entry should match too");
+    TEST_ASSERT(run_query(&dir, "size>=250MB", mask, 5) == 50, "Sizes should compare files only");
+    TEST_ASSERT(run_query(&dir, "modified<10d", mask, 5) == 11, "Ages should select recent entries");
+    TEST_ASSERT(run_query(&dir, "ext:jpg size>100M modified>2w", mask, 5) == 66,
+                "Terms should combine");
+    TEST_ASSERT(run_query(&dir, "git:modified", mask, 5) == 43, "git: should select by badge");
+    TEST_ASSERT(run_query(&dir, "is:hidden", mask, 5) == 6, "is:hidden should select dotfiles");
+    TEST_ASSERT(run_query(&dir, "-is:hidden kind:image,folder", mask, 5) == 197,
+                "kind: should take classes and folders, and '-' should negate");
+
+    // Badges set after the columns were built are seen
+    directory_set_git_status(&dir, 1, FILE_GIT_MODIFIED);
+    TEST_ASSERT(run_query(&dir, "git:modified", mask, 5) == 44, "Changed badges should be filtered on");
+
+    directory_state_free(&dir);
+}
+
+static void test_filter_query_paths(void)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "/tmp/finder_plus_filter_%d.raw", getpid());
+    FILE *f = fopen(path, "w");
+    fputs("not really a photo", f);
+    fclose(f);
+
+    FilterQuery query;
+    filter_query_compile(&query, "ext:raw size<1k", NOW);
+    TEST_ASSERT(filter_query_match_path(&query, path), "A file should be checked by name and lstat");
+    filter_query_compile(&query, "ext:raw size>1k", NOW);
+    TEST_ASSERT(!filter_query_match_path(&query, path), "A file failing a term should not match");
+    TEST_ASSERT(filter_query_match_name(&query, "IMG_0001.RAW") && !filter_query_match_name(&query, "a.jpg"),
+                "Names alone should be checked against name terms");
+    filter_query_compile(&query, "is:dir", NOW);
+    TEST_ASSERT(filter_query_match_path(&query, "/tmp") && !filter_query_match_path(&query, path),
+                "is:dir should tell folders from files");
+
+    unlink(path);
+    TEST_ASSERT(!filter_query_match_path(&query, path), "A missing file should not match");
+}
+
+void test_filter_query(void)
+{
+    test_filter_query_compile();
+    test_filter_query_listing();
+    test_filter_query_paths();
+}
@@ -5,6 +5,7 @@
 
 // Font module header
 #include "../src/utils/font.h"
+#include "../src/utils/draw_batch.h"
 
 // Test helper functions
 extern void inc_tests_run(void);
@@ -89,6 +90,29 @@ void test_font(void)
         TEST_ASSERT_EQ(0, width, "MeasureTextCustom(\"\", ...) returns 0");
     }
 
+    // Test the layout cache entry points without fonts or a window
+    {
+        TEST_ASSERT_EQ(0, MeasureTextFit(NULL, 14, 100), "MeasureTextFit(NULL, ...) returns 0");
+        TEST_ASSERT_EQ(0, MeasureTextFit("", 14, 100), "MeasureTextFit(\"\", ...) returns 0");
+        DrawTextFit(NULL, 0, 0, 14, 100, (Color){255, 255, 255, 255});
+        DrawTextFit("a long file name.txt", 0, 0, 14, 40, (Color){255, 255, 255, 255});
+        font_layout_invalidate();
+        font_layout_invalidate();
+        TEST_ASSERT(true, "DrawTextFit and font_layout_invalidate do not crash without a window");
+    }
+
+    // Test draw batch state (nothing queued, so nothing reaches the GPU)
+    {
+        TEST_ASSERT_EQ(false, draw_batch_is_open(), "No draw batch is open initially");
+        draw_batch_begin();
+        TEST_ASSERT_EQ(true, draw_batch_is_open(), "draw_batch_begin opens a batch");
+        draw_batch_rect(0, 0, 0, 10, (Color){255, 255, 255, 255});
+        draw_batch_rect(0, 0, 10, 10, (Color){255, 255, 255, 0});
+        draw_batch_flush();
+        draw_batch_end();
+        TEST_ASSERT_EQ(false, draw_batch_is_open(), "draw_batch_end closes the batch");
+    }
+
     // Test font_get returns default font when not loaded
     {
         Font font = font_get(14);
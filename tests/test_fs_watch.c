@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#define TEST_ASSERT_EQ(expected, actual, message) do { \
+    inc_tests_run(); \
+    if ((expected) == (actual)) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s - expected %d, got %d (line %d)\n", message, (int)(expected), (int)(actual), __LINE__); \
+    } \
+} while(0)
+
+#include "../src/core/fs_watch.h"
+#include "../src/utils/perf.h"
+#include "../src/core/filesystem.h"
+
+// Long enough that only fs_watch_flush dispatches during a test
+#define TEST_COALESCE 60.0
+
+// Records what one subscriber was handed
+typedef struct Received {
+    int batches;
+    int changes;
+    int dirs;
+    bool changes_overflow;
+    bool dirs_overflow;
+    char last_path[256];
+    FSEventType last_type;
+    uint32_t last_flags;
+    bool saw_dir[4];
+} Received;
+
+static const char *watched_dirs[4] = { "/src", "/src/lib", "/docs", "/" };
+
+static void record_batch(const FsWatchBatch *batch, void *user_data)
+{
+    Received *received = (Received *)user_data;
+    received->batches++;
+    received->changes += batch->change_count;
+    received->dirs += batch->dir_count;
+    received->changes_overflow |= batch->changes_overflow;
+    received->dirs_overflow |= batch->dirs_overflow;
+    if (batch->change_count > 0) {
+        const FsWatchChange *change = &batch->changes[batch->change_count - 1];
+        snprintf(received->last_path, sizeof(received->last_path), "%s", change->path);
+        received->last_type = change->type;
+        received->last_flags = change->flags;
+    }
+    for (int i = 0; i < batch->dir_count; i++) {
+        for (int d = 0; d < 4; d++) {
+            if (strcmp(batch->dirs[i], watched_dirs[d]) == 0) {
+                received->saw_dir[d] = true;
+            }
+        }
+    }
+}
+
+static void test_fs_watch_coalesce(void)
+{
+    FsWatch *watch = fs_watch_create(TEST_COALESCE);
+    TEST_ASSERT(watch != NULL, "Should create watch bus");
+
+    Received received = {0};
+    int id = fs_watch_subscribe(watch, "/src", true, record_batch, &received);
+    TEST_ASSERT(id > 0, "Should subscribe");
+
+    // A burst on one file arrives as a single merged change
+    for (int i = 0; i < 100; i++) {
+        fs_watch_notify(watch, "/src/main.c", FSEVENT_MODIFIED, FSEVENT_FLAG_IS_FILE);
+    }
+    fs_watch_notify(watch, "/src/main.c", FSEVENT_RENAMED, FSEVENT_FLAG_ITEM_RENAMED);
+    fs_watch_flush(watch);
+
+    TEST_ASSERT_EQ(1, received.batches, "Burst should dispatch once");
+    TEST_ASSERT_EQ(1, received.changes, "Repeated events should merge into one change");
+    TEST_ASSERT(strcmp(received.last_path, "/src/main.c") == 0, "Change should carry the path");
+    TEST_ASSERT_EQ(FSEVENT_RENAMED, received.last_type, "Last event type should win");
+    TEST_ASSERT(received.last_flags == (FSEVENT_FLAG_IS_FILE | FSEVENT_FLAG_ITEM_RENAMED),
+                "Flags should accumulate");
+    TEST_ASSERT(received.saw_dir[0], "Parent directory should be marked dirty");
+
+    // Nothing pending: nothing dispatched
+    fs_watch_flush(watch);
+    TEST_ASSERT_EQ(1, received.batches, "Empty flush should not dispatch");
+
+    fs_watch_destroy(watch);
+}
+
+static void test_fs_watch_filter(void)
+{
+    FsWatch *watch = fs_watch_create(TEST_COALESCE);
+
+    Received tree = {0}, flat = {0}, docs = {0};
+    fs_watch_subscribe(watch, "/src/", true, record_batch, &tree);
+    fs_watch_subscribe(watch, "/src", false, record_batch, &flat);
+    fs_watch_subscribe(watch, "/docs", true, record_batch, &docs);
+
+    fs_watch_notify(watch, "/src/main.c", FSEVENT_MODIFIED, FSEVENT_FLAG_IS_FILE);
+    fs_watch_notify(watch, "/src/lib/util.c", FSEVENT_CREATED, FSEVENT_FLAG_IS_FILE);
+    fs_watch_notify(watch, "/srcfoo/other.c", FSEVENT_CREATED, FSEVENT_FLAG_IS_FILE);
+    fs_watch_flush(watch);
+
+    TEST_ASSERT_EQ(2, tree.changes, "Recursive subscriber should see the whole subtree");
+    TEST_ASSERT(tree.saw_dir[0] && tree.saw_dir[1], "Recursive subscriber should see both dirty dirs");
+    TEST_ASSERT_EQ(1, flat.changes, "Flat subscriber should only see direct children");
+    TEST_ASSERT(flat.saw_dir[0] && !flat.saw_dir[1], "Flat subscriber should only see its own dir");
+    TEST_ASSERT_EQ(0, docs.batches, "Unrelated subscriber should not be called");
+
+    fs_watch_destroy(watch);
+}
+
+static void test_fs_watch_firmlink(void)
+{
+    FsWatch *watch = fs_watch_create(TEST_COALESCE);
+
+    Received received = {0};
+    fs_watch_subscribe(watch, "/docs", true, record_batch, &received);
+
+    fs_watch_notify(watch, "/System/Volumes/Data/docs/a.txt", FSEVENT_CREATED, FSEVENT_FLAG_IS_FILE);
+    fs_watch_notify(watch, "relative/path", FSEVENT_CREATED, FSEVENT_FLAG_IS_FILE);
+    fs_watch_flush(watch);
+
+    TEST_ASSERT_EQ(1, received.changes, "Firmlinked path should reach the subscriber");
+    TEST_ASSERT(strcmp(received.last_path, "/docs/a.txt") == 0, "Data volume prefix should be dropped");
+
+    fs_watch_destroy(watch);
+}
+
+static void test_fs_watch_overflow(void)
+{
+    FsWatch *watch = fs_watch_create(TEST_COALESCE);
+
+    Received received = {0};
+    fs_watch_subscribe(watch, "/", true, record_batch, &received);
+
+    // More files than a batch lists, in few directories: only the dirs survive
+    char path[64];
+    for (int i = 0; i <= FS_WATCH_MAX_CHANGES; i++) {
+        snprintf(path, sizeof(path), "/src/file%d.c", i);
+        fs_watch_notify(watch, path, FSEVENT_MODIFIED, FSEVENT_FLAG_IS_FILE);
+    }
+    fs_watch_flush(watch);
+
+    TEST_ASSERT_EQ(1, received.batches, "Overflowing burst should still dispatch once");
+    TEST_ASSERT(received.changes_overflow, "Paths should overflow");
+    TEST_ASSERT(!received.dirs_overflow, "Directories should not overflow");
+    TEST_ASSERT(received.saw_dir[0], "Dirty directory should still be listed");
+
+    // More directories than a batch lists: the whole root counts as changed
+    memset(&received, 0, sizeof(received));
+    for (int i = 0; i <= FS_WATCH_MAX_DIRS; i++) {
+        snprintf(path, sizeof(path), "/tree/dir%d/file", i);
+        fs_watch_notify(watch, path, FSEVENT_MODIFIED, FSEVENT_FLAG_IS_FILE);
+    }
+    fs_watch_flush(watch);
+    TEST_ASSERT(received.dirs_overflow, "Directories should overflow");
+
+    fs_watch_destroy(watch);
+}
+
+static void test_fs_watch_must_scan(void)
+{
+    FsWatch *watch = fs_watch_create(TEST_COALESCE);
+
+    Received below = {0}, above = {0};
+    fs_watch_subscribe(watch, "/src", true, record_batch, &below);
+    fs_watch_subscribe(watch, "/docs/manual", true, record_batch, &above);
+
+    // Lost history under /src/lib is a change there; above /docs/manual it is the whole root
+    fs_watch_notify(watch, "/src/lib", FSEVENT_UNKNOWN, FSEVENT_FLAG_IS_DIR | FSEVENT_FLAG_MUST_SCAN);
+    fs_watch_notify(watch, "/docs", FSEVENT_UNKNOWN, FSEVENT_FLAG_IS_DIR | FSEVENT_FLAG_MUST_SCAN);
+    fs_watch_flush(watch);
+
+    TEST_ASSERT_EQ(1, below.changes, "Rescan below the root should arrive as a change");
+    TEST_ASSERT(below.last_flags & FSEVENT_FLAG_MUST_SCAN, "Change should keep the rescan flag");
+    TEST_ASSERT(!below.dirs_overflow, "Rescan below the root should not overflow");
+    TEST_ASSERT(above.dirs_overflow, "Rescan above the root should mark it all changed");
+
+    TEST_ASSERT(!fs_watch_replay(watch, 1), "Replay should need a running stream");
+
+    fs_watch_destroy(watch);
+}
+
+static void test_fs_watch_subscriptions(void)
+{
+    FsWatch *watch = fs_watch_create(TEST_COALESCE);
+
+    Received received = {0};
+    int id = fs_watch_subscribe(watch, "/src", false, record_batch, &received);
+
+    // Moving the root follows the browser to a new folder
+    fs_watch_set_root(watch, id, "/docs");
+    fs_watch_notify(watch, "/src/main.c", FSEVENT_MODIFIED, FSEVENT_FLAG_IS_FILE);
+    fs_watch_notify(watch, "/docs/readme.md", FSEVENT_MODIFIED, FSEVENT_FLAG_IS_FILE);
+    fs_watch_flush(watch);
+    TEST_ASSERT_EQ(1, received.changes, "Only the new root's change should arrive");
+    TEST_ASSERT(strcmp(received.last_path, "/docs/readme.md") == 0, "Change should be under the new root");
+
+    fs_watch_unsubscribe(watch, id);
+    fs_watch_notify(watch, "/docs/readme.md", FSEVENT_MODIFIED, FSEVENT_FLAG_IS_FILE);
+    fs_watch_flush(watch);
+    TEST_ASSERT_EQ(1, received.batches, "Unsubscribed callback should not run");
+
+    // Slots are reused after unsubscribe
+    int ids = 0;
+    for (int i = 0; i < FS_WATCH_MAX_SUBSCRIBERS + 1; i++) {
+        if (fs_watch_subscribe(watch, "/", true, record_batch, &received) > 0) {
+            ids++;
+        }
+    }
+    TEST_ASSERT_EQ(FS_WATCH_MAX_SUBSCRIBERS, ids, "Subscribers should be capped");
+
+    fs_watch_destroy(watch);
+}
+
+static void test_fs_watch_dispatch_thread(void)
+{
+    FsWatch *watch = fs_watch_create(0.05);
+
+    Received received = {0};
+    fs_watch_subscribe(watch, "/src", true, record_batch, &received);
+    fs_watch_notify(watch, "/src/main.c", FSEVENT_MODIFIED, FSEVENT_FLAG_IS_FILE);
+
+    // fs_watch_unsubscribe waits out a dispatch in progress, so poll without it
+    for (int i = 0; i < 100 && received.batches == 0; i++) {
+        usleep(10000);
+    }
+    fs_watch_flush(watch);
+    TEST_ASSERT_EQ(1, received.batches, "Dispatch thread should deliver after the coalesce delay");
+
+    fs_watch_destroy(watch);
+}
+
+static void test_fs_watch_dir_cache(void)
+{
+    FsWatch *watch = fs_watch_create(TEST_COALESCE);
+    DirCache cache;
+    dir_cache_init(&cache);
+    TEST_ASSERT(dir_cache_watch(&cache, watch), "Dir cache should subscribe");
+
+    DirectoryState dir;
+    directory_state_init(&dir);
+    dir_cache_put(&cache, "/music", &dir);
+    dir_cache_put(&cache, "/docs", &dir);
+
+    fs_watch_notify(watch, "/music/song.mp3", FSEVENT_CREATED, FSEVENT_FLAG_IS_FILE);
+    fs_watch_flush(watch);
+    TEST_ASSERT(dir_cache_get(&cache, "/music") == NULL, "Changed listing should be invalidated");
+    TEST_ASSERT(dir_cache_get(&cache, "/docs") != NULL, "Other listing should stay cached");
+
+    // Unsubscribes before the bus goes away
+    directory_state_free(&dir);
+    dir_cache_free(&cache);
+    fs_watch_destroy(watch);
+}
+
+void test_fs_watch(void)
+{
+    test_fs_watch_coalesce();
+    test_fs_watch_filter();
+    test_fs_watch_firmlink();
+    test_fs_watch_overflow();
+    test_fs_watch_must_scan();
+    test_fs_watch_subscriptions();
+    test_fs_watch_dispatch_thread();
+    test_fs_watch_dir_cache();
+}
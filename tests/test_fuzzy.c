@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#define TEST_ASSERT_EQ(expected, actual, message) do { \
+    inc_tests_run(); \
+    if ((expected) == (actual)) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s - expected %d, got %d (line %d)\n", message, (int)(expected), (int)(actual), __LINE__); \
+    } \
+} while(0)
+
+#include "../src/utils/fuzzy.h"
+
+static int score(const char *query, const char *text, bool case_sensitive)
+{
+    FuzzyQuery q;
+    fuzzy_compile(&q, query, case_sensitive);
+    return fuzzy_score(&q, text, NULL, -1, NULL, 0, NULL);
+}
+
+static void test_fuzzy_scoring(void)
+{
+    printf("  Testing fuzzy scoring...\n");
+    FuzzyQuery q;
+    TEST_ASSERT(!fuzzy_compile(&q, "", false), "Empty query should not compile");
+    TEST_ASSERT_EQ(0, fuzzy_score(&q, "anything", NULL, -1, NULL, 0, NULL), "Empty query should match nothing");
+
+    TEST_ASSERT(score("mf", "myfile.txt", false) > 0, "Subsequence should match");
+    TEST_ASSERT(score("TEST", "test", false) > 0, "Case-insensitive query should match");
+    TEST_ASSERT_EQ(0, score("TEST", "test", true), "Case-sensitive query should not match");
+    TEST_ASSERT_EQ(0, score("xyz", "abc", false), "Missing characters should not match");
+    TEST_ASSERT(score("abc", "abcdef", false) > score("abc", "axbxcx", false), "Runs should score higher");
+    TEST_ASSERT(score("d", "dir", false) > score("i", "dir", false), "Word starts should score higher");
+    TEST_ASSERT(score("fb", "fooBar", false) > score("fb", "foobar", false), "camelCase humps should score higher");
+    TEST_ASSERT(score("New", "New File", false) > score("new", "New File", false), "Typed case should score higher");
+
+    // A folded copy gives the same score and positions as folding while matching
+    const char *text = "MyDocument_Final.PDF";
+    char folded[64];
+    fuzzy_fold(folded, text, strlen(text) + 1);
+    TEST_ASSERT(strcmp(folded, "mydocument_final.pdf") == 0, "Fold should lower ASCII letters only");
+
+    int a[8], b[8], count_a, count_b;
+    fuzzy_compile(&q, "dfp", false);
+    int plain = fuzzy_score(&q, text, NULL, -1, a, 8, &count_a);
+    int cached = fuzzy_score(&q, text, folded, (int)strlen(text), b, 8, &count_b);
+    TEST_ASSERT(plain > 0 && plain == cached, "Folded copy should not change the score");
+    TEST_ASSERT(count_a == 3 && count_b == 3 && memcmp(a, b, sizeof(int) * 3) == 0,
+                "Folded copy should not change the positions");
+    TEST_ASSERT(a[0] == 2 && a[1] == 11 && a[2] == 17, "Positions should be the first in order");
+}
+
+static void test_fuzzy_prefilter(void)
+{
+    printf("  Testing fuzzy prefilter...\n");
+    const char *names[] = { "readme.md", "main.c", "Makefile", "notes.txt", "image.png",
+                            "amazing", "x", "MAIN.H", "domain", "" };
+    int count = (int)(sizeof(names) / sizeof(names[0]));
+    uint64_t masks[16];
+    for (int i = 0; i < count; i++) masks[i] = fuzzy_char_mask(names[i]);
+
+    FuzzyQuery q;
+    fuzzy_compile(&q, "main", false);
+    int kept[16];
+    int n = fuzzy_prefilter(&q, masks, count, kept);
+
+    // Every candidate that scores must survive, and the survivors stay in order
+    bool complete = true, ordered = true;
+    for (int i = 0, k = 0; i < count; i++) {
+        bool survived = k < n && kept[k] == i;
+        if (survived) k++;
+        if (fuzzy_score(&q, names[i], NULL, -1, NULL, 0, NULL) > 0 && !survived) complete = false;
+        if (survived != fuzzy_may_match(&q, masks[i])) ordered = false;
+    }
+    TEST_ASSERT(complete, "Prefilter should keep every match");
+    TEST_ASSERT(ordered, "Prefilter should agree with the scalar check");
+    TEST_ASSERT_EQ(5, n, "Prefilter should drop names missing a character");
+}
+
+void test_fuzzy(void)
+{
+    test_fuzzy_scoring();
+    test_fuzzy_prefilter();
+}
@@ -3,8 +3,10 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include "api/gemini_client.h"
 #include "api/auth.h"
+#include "api/image_upload.h"
 
 // Test framework functions from test_main.c
 extern void inc_tests_run(void);
@@ -122,6 +124,55 @@ static void test_gemini_response_init_cleanup(void)
     TEST_ASSERT(resp.image_size == 0, "Image size reset");
 }
 
+static void test_gemini_save_decoded_file(void)
+{
+    printf("\n  Testing images decoded to disk...\n");
+
+    char dir[] = "/tmp/gemini_decode_XXXXXX";
+    TEST_ASSERT(mkdtemp(dir) != NULL, "Temp dir created");
+    char part[256], saved[256];
+    snprintf(part, sizeof(part), "%s/.gemini-1-0.part", dir);
+    snprintf(saved, sizeof(saved), "%s/image.png", dir);
+
+    // As gemini_send leaves a decoded image: in a hidden file named by image_path
+    GeminiImageResponse resp;
+    gemini_response_init(&resp);
+    FILE *f = fopen(part, "wb");
+    fputs("\x89PNG", f);
+    fclose(f);
+    snprintf(resp.image_path, sizeof(resp.image_path), "%s", part);
+    resp.image_size = 4;
+
+    TEST_ASSERT(gemini_save_image(&resp, saved), "Decoded image saved");
+    TEST_ASSERT(access(saved, F_OK) == 0 && access(part, F_OK) != 0, "Decoded file moved into place");
+    TEST_ASSERT(resp.image_path[0] == '\0', "Response no longer names the moved file");
+    gemini_response_cleanup(&resp);
+    TEST_ASSERT(access(saved, F_OK) == 0, "Cleanup leaves the saved image");
+
+    // Not saved: cleanup deletes it
+    f = fopen(part, "wb");
+    fputs("\x89PNG", f);
+    fclose(f);
+    snprintf(resp.image_path, sizeof(resp.image_path), "%s", part);
+    gemini_response_cleanup(&resp);
+    TEST_ASSERT(access(part, F_OK) != 0, "Cleanup deletes an unsaved decoded file");
+
+    // A folder that cannot be written fails before anything is sent
+    GeminiClient *client = gemini_client_create("test-key");
+    GeminiImageRequest req;
+    gemini_request_init(&req);
+    gemini_request_set_prompt(&req, "A red square");
+    gemini_request_set_output_dir(&req, "/nonexistent/gemini");
+    TEST_ASSERT_STR_EQ(req.output_dir, "/nonexistent/gemini", "Output dir set");
+    TEST_ASSERT(!gemini_generate_image(client, &req, &resp) && strstr(resp.error, "/nonexistent/gemini"),
+                "Unwritable output dir reported");
+    gemini_response_cleanup(&resp);
+    gemini_client_destroy(client);
+
+    unlink(saved);
+    rmdir(dir);
+}
+
 static void test_gemini_format_helpers(void)
 {
     printf("\n  Testing format helpers...\n");
@@ -403,6 +454,53 @@ static void test_real_image_generation(void)
     auth_clear(&auth);
 }
 
+static void test_image_upload_cache(void)
+{
+    printf("\n  Testing image upload cache...\n");
+
+    TEST_ASSERT_STR_EQ(image_upload_mime_type("/a/photo.JPG"), "image/jpeg", "JPG extension maps to JPEG");
+    TEST_ASSERT_STR_EQ(image_upload_mime_type("/a/photo.heic"), "image/heic", "HEIC extension known");
+
+    // A small PNG goes up unchanged
+    const char *path = "/tmp/finder_plus_upload_test.png";
+    const unsigned char png[] = "\x89PNG\r\n\x1a\n small test payload";
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        printf("  SKIP: Could not create test image\n");
+        return;
+    }
+    fwrite(png, 1, sizeof(png) - 1, f);
+    fclose(f);
+
+    ImageUpload *first = image_upload_acquire(path);
+    TEST_ASSERT(first != NULL, "Small image prepared");
+    if (first) {
+        TEST_ASSERT(first->size == sizeof(png) - 1 && memcmp(first->data, png, first->size) == 0,
+                    "Small image sent unchanged");
+        TEST_ASSERT_STR_EQ(first->mime_type, "image/png", "Payload keeps its MIME type");
+
+        ImageUpload *second = image_upload_acquire(path);
+        TEST_ASSERT(second == first, "Unchanged file served from cache");
+        image_upload_release(second);
+        image_upload_release(first);
+    }
+
+    // A newer modification time prepares it afresh
+    struct stat st;
+    stat(path, &st);
+    struct timespec times[2] = { st.st_atimespec, st.st_mtimespec };
+    times[1].tv_sec += 10;
+    utimensat(AT_FDCWD, path, times, 0);
+    ImageUpload *changed = image_upload_acquire(path);
+    TEST_ASSERT(changed != NULL && changed->mtime == st.st_mtime + 10, "Modified file prepared again");
+    image_upload_release(changed);
+
+    TEST_ASSERT(image_upload_acquire("/nonexistent/image.png") == NULL, "Missing file has no payload");
+
+    unlink(path);
+    image_upload_shutdown();
+}
+
 void test_gemini_client(void)
 {
     printf("\n[Gemini Client Tests]\n");
@@ -412,6 +510,7 @@ void test_gemini_client(void)
     test_gemini_request_set_prompt();
     test_gemini_request_set_model();
     test_gemini_response_init_cleanup();
+    test_gemini_save_decoded_file();
     test_gemini_format_helpers();
     test_gemini_result_strings();
     test_gemini_auth_from_env();
@@ -422,5 +521,6 @@ void test_gemini_client(void)
     test_gemini_edit_request_set_model();
     test_gemini_generate_edited_path();
     test_gemini_edit_image_validation();
+    test_image_upload_cache();
     test_real_image_generation();
 }
@@ -5,6 +5,8 @@
 #include <sys/stat.h>
 
 #include "core/git.h"
+#include "core/git_async.h"
+#include "core/git_preview.h"
 
 // External test macros from test_main.c
 extern void inc_tests_run(void);
@@ -182,6 +184,293 @@ static void test_git_get_status(void)
     git_status_result_free(&result);
 }
 
+// Test git_refresh from a subdirectory: one pass fills the state and file statuses
+static void test_git_refresh(void)
+{
+    printf("  Testing git_refresh...\n");
+
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "mkdir -p %s/sub/deeper && echo 'x' > '%s/sub/deeper/with space.txt'", TEST_DIR, TEST_DIR);
+    system(cmd);
+
+    char sub[GIT_PATH_MAX_LEN];
+    snprintf(sub, sizeof(sub), "%s/sub", TEST_DIR);
+
+    GitState state;
+    GitStatusResult result;
+    git_status_result_init(&result);
+
+    bool ok = git_refresh(&state, &result, sub);
+    TEST_ASSERT(ok == true, "Should refresh from a subdirectory");
+    TEST_ASSERT(state.is_repo == true, "Subdirectory should be in the repo");
+    TEST_ASSERT(strstr(state.repo_root, "finder_plus_git_test") != NULL, "Root should be the test repo");
+    TEST_ASSERT(strlen(state.branch) > 0 && !state.is_detached, "Should read the branch from HEAD");
+    TEST_ASSERT(state.has_staged && state.has_modified && state.has_untracked, "Should set all change flags");
+    TEST_ASSERT(git_get_file_status(&result, "deeper/with space.txt") == GIT_STATUS_UNTRACKED,
+                "Untracked directory should be listed file by file, unquoted");
+    TEST_ASSERT(git_get_file_status(&result, "deeper") == GIT_STATUS_UNTRACKED,
+                "Directory should show the status of the files it holds");
+    TEST_ASSERT(git_get_file_status(&result, "with space.txt") == GIT_STATUS_NONE,
+                "Names should not match files in other directories");
+    TEST_ASSERT(git_get_file_status(&result, "file1.txt") == GIT_STATUS_NONE,
+                "Files outside the subdirectory should be left out");
+
+    git_status_result_free(&result);
+
+    // From the root, a directory shows its most pressing status
+    snprintf(cmd, sizeof(cmd), "cd %s && echo 'y' > sub/tracked.txt && git add sub/tracked.txt && "
+             "git commit -q -m 'Add sub' -- sub/tracked.txt && echo 'z' >> sub/tracked.txt", TEST_DIR);
+    system(cmd);
+    git_refresh(&state, &result, TEST_DIR);
+    TEST_ASSERT(git_get_file_status(&result, "sub") == GIT_STATUS_MODIFIED,
+                "Modified should outrank untracked in a directory");
+    TEST_ASSERT(git_get_file_status(&result, "sub/deeper") == GIT_STATUS_UNTRACKED,
+                "Nested directories should be indexed too");
+    TEST_ASSERT(git_get_file_status(&result, "su") == GIT_STATUS_NONE,
+                "Only whole path components should match");
+    git_status_result_free(&result);
+
+    snprintf(cmd, sizeof(cmd), "cd %s && git rm -q -r -f sub && git commit -q -m 'Remove sub' -- sub", TEST_DIR);
+    system(cmd);
+
+    snprintf(cmd, sizeof(cmd), "rm -rf %s/sub", TEST_DIR);
+    system(cmd);
+}
+
+// Test the watched repository's cached status: reused until a change is reported
+static void test_git_status_watch(void)
+{
+    printf("  Testing git_status_watch...\n");
+
+    char cmd[1024];
+    char path[GIT_PATH_MAX_LEN];
+    GitState state;
+    GitStatusResult result;
+
+    git_status_watch(TEST_DIR);
+    git_refresh(&state, &result, TEST_DIR);
+    git_status_result_free(&result);
+
+    // Unreported, so the cached status stands
+    snprintf(cmd, sizeof(cmd), "mkdir -p %s/watched && echo 'x' > %s/watched/quiet.txt", TEST_DIR, TEST_DIR);
+    system(cmd);
+    git_refresh(&state, &result, TEST_DIR);
+    TEST_ASSERT(git_get_file_status(&result, "watched/quiet.txt") == GIT_STATUS_NONE,
+                "Unreported change should not be rescanned");
+    git_status_result_free(&result);
+
+    // Reported: only that path is rescanned
+    snprintf(path, sizeof(path), "%s/watched/quiet.txt", TEST_DIR);
+    git_status_mark_dirty(path);
+    git_refresh(&state, &result, TEST_DIR);
+    TEST_ASSERT(git_get_file_status(&result, "watched/quiet.txt") == GIT_STATUS_UNTRACKED,
+                "Reported change should be rescanned");
+    TEST_ASSERT(git_get_file_status(&result, "untracked.txt") == GIT_STATUS_UNTRACKED,
+                "Unchanged paths should keep their cached status");
+    git_status_result_free(&result);
+
+    // Removing it and reporting the directory drops it again
+    snprintf(cmd, sizeof(cmd), "rm -rf %s/watched", TEST_DIR);
+    system(cmd);
+    snprintf(path, sizeof(path), "%s/watched", TEST_DIR);
+    git_status_mark_dirty(path);
+    git_refresh(&state, &result, TEST_DIR);
+    TEST_ASSERT(git_get_file_status(&result, "watched/quiet.txt") == GIT_STATUS_NONE,
+                "Removed file should leave the cached status");
+    git_status_result_free(&result);
+
+    // Staging rewrites the index, which is noticed without a report
+    snprintf(cmd, sizeof(cmd), "cd %s && git add untracked.txt", TEST_DIR);
+    system(cmd);
+    git_refresh(&state, &result, TEST_DIR);
+    TEST_ASSERT(git_get_file_status(&result, "untracked.txt") == GIT_STATUS_STAGED,
+                "Index change should rescan everything");
+    git_status_result_free(&result);
+
+    snprintf(cmd, sizeof(cmd), "cd %s && git reset -q untracked.txt", TEST_DIR);
+    system(cmd);
+    git_status_watch(NULL);
+}
+
+// Test line counts: one numstat pass, summed into the directories holding the files
+static void test_git_line_counts(void)
+{
+    printf("  Testing git line counts...\n");
+
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "cd %s && mkdir -p counted && printf '1\\n2\\n3\\n' > counted/a.txt && "
+             "printf 'x\\ny\\n' > counted/b.txt && git add counted && git commit -q -m 'Add counted' -- counted && "
+             "printf '1\\n3\\n4\\n5\\n' > counted/a.txt && printf 'x\\ny\\nz\\n' > counted/b.txt && "
+             "git add counted/b.txt && echo 'new' > counted/c.txt", TEST_DIR);
+    system(cmd);
+
+    GitState state;
+    GitStatusResult result;
+    int added = 0, removed = 0;
+
+    git_status_watch(TEST_DIR);
+    git_refresh(&state, &result, TEST_DIR);
+    TEST_ASSERT(git_get_file_stats(&result, "counted/a.txt", &added, &removed) && added == 2 && removed == 1,
+                "Unstaged changes should be counted");
+    TEST_ASSERT(git_get_file_stats(&result, "counted/b.txt", &added, &removed) && added == 1 && removed == 0,
+                "Staged changes should be counted against HEAD");
+    TEST_ASSERT(!git_get_file_stats(&result, "counted/c.txt", &added, &removed),
+                "Untracked files should not be counted");
+    TEST_ASSERT(git_get_file_stats(&result, "counted", &added, &removed) && added == 3 && removed == 1,
+                "A directory should sum the files below it");
+    git_status_result_free(&result);
+
+    // A reported change recounts only that file
+    char path[GIT_PATH_MAX_LEN];
+    snprintf(cmd, sizeof(cmd), "printf '1\\n' > %s/counted/a.txt", TEST_DIR);
+    system(cmd);
+    snprintf(path, sizeof(path), "%s/counted/a.txt", TEST_DIR);
+    git_status_mark_dirty(path);
+    git_refresh(&state, &result, TEST_DIR);
+    TEST_ASSERT(git_get_file_stats(&result, "counted", &added, &removed) && added == 1 && removed == 2,
+                "Rescanned paths should be recounted");
+    git_status_result_free(&result);
+
+    TEST_ASSERT(git_get_diff_stats(TEST_DIR, "counted/a.txt", &added, &removed) && added == 0 && removed == 2,
+                "Diff stats should come from the cached status");
+    git_status_watch(NULL);
+    TEST_ASSERT(git_get_diff_stats(TEST_DIR, "counted/b.txt", &added, &removed) && added == 1,
+                "Diff stats should be read without a cache too");
+
+    snprintf(cmd, sizeof(cmd), "cd %s && git rm -q -r -f counted && git commit -q -m 'Remove counted' -- counted && "
+             "rm -rf counted", TEST_DIR);
+    system(cmd);
+}
+
+// Helper: poll a git reader for up to five seconds
+static bool wait_git_async(GitAsync *async, GitState *state, GitStatusResult *result, char *path, size_t path_size)
+{
+    for (int i = 0; i < 500; i++) {
+        if (git_async_poll(async, state, result, path, path_size)) {
+            return true;
+        }
+        usleep(10000);
+    }
+    return false;
+}
+
+// Test the background reader: only the latest directory's read is handed over
+static void test_git_async(void)
+{
+    printf("  Testing git_async...\n");
+
+    GitAsync *async = git_async_create();
+    TEST_ASSERT(async != NULL, "Should create a git reader");
+    if (async == NULL) {
+        return;
+    }
+
+    GitState state;
+    GitStatusResult result;
+    char path[GIT_PATH_MAX_LEN];
+    git_state_init(&state);
+    git_status_result_init(&result);
+
+    git_async_request(async, "/tmp");
+    git_async_request(async, TEST_DIR);
+    bool ready = wait_git_async(async, &state, &result, path, sizeof(path));
+    TEST_ASSERT(ready == true, "Should finish reading in the background");
+    TEST_ASSERT_STR_EQ(TEST_DIR, path, "Should hand over the latest directory only");
+    TEST_ASSERT(state.is_repo == true, "Should read the repository state");
+    TEST_ASSERT(git_get_file_status(&result, "untracked.txt") == GIT_STATUS_UNTRACKED,
+                "Should read the file statuses");
+    TEST_ASSERT(git_async_poll(async, &state, &result, path, sizeof(path)) == false,
+                "A read should be handed over once");
+
+    git_async_request(async, "/tmp");
+    ready = wait_git_async(async, &state, &result, path, sizeof(path));
+    TEST_ASSERT(ready && !state.is_repo, "Should read a directory outside any repository");
+
+    git_status_result_free(&result);
+    git_async_destroy(async);
+}
+
+// Helper: poll a preview loader for up to five seconds
+static GitPreviewStatus wait_git_preview(GitPreview *preview, GitPreviewText **text)
+{
+    GitPreviewStatus status = GIT_PREVIEW_LOADING;
+    for (int i = 0; i < 500 && status == GIT_PREVIEW_LOADING; i++) {
+        status = git_preview_poll(preview, text);
+        if (status == GIT_PREVIEW_LOADING) {
+            usleep(10000);
+        }
+    }
+    return status;
+}
+
+// Test the preview's diff and history, and its cache
+static void test_git_preview(void)
+{
+    printf("  Testing git_preview...\n");
+
+    char cmd[1024];
+    char path[GIT_PATH_MAX_LEN];
+    snprintf(cmd, sizeof(cmd), "cd %s && printf 'one\\ntwo\\n' > previewed.txt && git add previewed.txt && "
+             "git commit -q -m 'Add previewed' -- previewed.txt && printf 'one\\nthree\\n' > previewed.txt", TEST_DIR);
+    system(cmd);
+    snprintf(path, sizeof(path), "%s/previewed.txt", TEST_DIR);
+
+    // Blob ids match git's
+    char id[GIT_PREVIEW_ID_LEN], expected[GIT_PREVIEW_ID_LEN] = "";
+    snprintf(cmd, sizeof(cmd), "git hash-object '%s'", path);
+    FILE *pipe = popen(cmd, "r");
+    if (pipe) {
+        if (fgets(expected, sizeof(expected), pipe)) expected[strcspn(expected, "\n")] = '\0';
+        pclose(pipe);
+    }
+    TEST_ASSERT(git_preview_blob_id(path, id, sizeof(id)) && strcmp(id, expected) == 0,
+                "Blob ids should match git hash-object");
+
+    GitPreview *preview = git_preview_create();
+    TEST_ASSERT(preview != NULL, "Should create a preview loader");
+    if (preview == NULL) {
+        return;
+    }
+    TEST_ASSERT(git_preview_poll(preview, NULL) == GIT_PREVIEW_NONE, "Nothing should be loading before a request");
+
+    GitPreviewText *text = NULL;
+    git_preview_request(preview, path, GIT_PREVIEW_DIFF);
+    TEST_ASSERT(wait_git_preview(preview, &text) == GIT_PREVIEW_READY && text != NULL, "The diff should be read");
+    TEST_ASSERT(text && strstr(git_preview_text_data(text), "-two\n+three\n") != NULL, "The diff should hold the change");
+    const GitPreviewText *first = text;
+    git_preview_text_release(text);
+
+    text = NULL;
+    git_preview_request(preview, path, GIT_PREVIEW_LOG);
+    TEST_ASSERT(wait_git_preview(preview, &text) == GIT_PREVIEW_READY && text != NULL &&
+                strstr(git_preview_text_data(text), "Add previewed") != NULL, "The history should be read");
+    git_preview_text_release(text);
+
+    // Coming back to an unchanged file is served from the cache
+    text = NULL;
+    git_preview_request(preview, path, GIT_PREVIEW_DIFF);
+    TEST_ASSERT(wait_git_preview(preview, &text) == GIT_PREVIEW_READY && text == first,
+                "An unchanged file's diff should come from the cache");
+    git_preview_text_release(text);
+
+    // A change to the file reads it again
+    snprintf(cmd, sizeof(cmd), "printf 'one\\nfour\\n' > '%s'", path);
+    system(cmd);
+    text = NULL;
+    git_preview_request(preview, path, GIT_PREVIEW_DIFF);
+    TEST_ASSERT(wait_git_preview(preview, &text) == GIT_PREVIEW_READY && text &&
+                strstr(git_preview_text_data(text), "+four\n") != NULL, "A changed file should be read again");
+    git_preview_text_release(text);
+
+    git_preview_request(preview, "/tmp", GIT_PREVIEW_DIFF);
+    TEST_ASSERT(wait_git_preview(preview, NULL) == GIT_PREVIEW_FAILED, "Files outside a repository should fail");
+    git_preview_destroy(preview);
+
+    snprintf(cmd, sizeof(cmd), "cd %s && git rm -q -f previewed.txt && git commit -q -m 'Remove previewed' -- previewed.txt",
+             TEST_DIR);
+    system(cmd);
+}
+
 // Test git_status_char
 static void test_git_status_char(void)
 {
@@ -242,6 +531,34 @@ static void test_git_stage_unstage(void)
     git_status_result_free(&result);
 }
 
+// Test stash detection (loose and packed) and ahead/behind against an upstream
+static void test_git_stash_and_upstream(void)
+{
+    printf("  Testing stash and upstream...\n");
+
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "cd %s && git stash -q", TEST_DIR);
+    system(cmd);
+
+    GitState state;
+    git_update_state(&state, TEST_DIR);
+    TEST_ASSERT(state.has_stash == true, "Should see the stash");
+
+    snprintf(cmd, sizeof(cmd), "cd %s && git pack-refs --all", TEST_DIR);
+    system(cmd);
+    git_update_state(&state, TEST_DIR);
+    TEST_ASSERT(state.has_stash == true, "Should see a packed stash");
+
+    snprintf(cmd, sizeof(cmd),
+             "cd %s && git stash drop -q && git branch -q base && git branch -q --set-upstream-to=base && "
+             "git commit -q --allow-empty -m ahead", TEST_DIR);
+    system(cmd);
+    git_update_state(&state, TEST_DIR);
+    TEST_ASSERT(state.has_stash == false, "Dropped stash should be gone");
+    TEST_ASSERT_EQ(1, state.ahead, "Should be one commit ahead of upstream");
+    TEST_ASSERT_EQ(0, state.behind, "Should not be behind upstream");
+}
+
 // Test state initialization and cleanup
 static void test_git_state_lifecycle(void)
 {
@@ -311,9 +628,15 @@ void test_git(void)
     test_git_get_branch();
     test_git_update_state();
     test_git_get_status();
+    test_git_refresh();
+    test_git_status_watch();
+    test_git_line_counts();
+    test_git_async();
+    test_git_preview();
     test_git_status_char();
     test_git_status_string();
     test_git_stage_unstage();
+    test_git_stash_and_upstream();
     test_git_non_repo();
 
     printf("  Cleaning up git test repo...\n");
@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include "api/http_client.h"
+#include "api/json_stream.h"
+#include "utils/perf.h"
 
 // Test macros from test_main.c
 extern void inc_tests_run(void);
@@ -155,7 +157,7 @@ static void test_response_cleanup(void)
     http_response_init(&resp);
 
     // Simulate populated response
-    resp.body = strdup("Response body");
+    resp.body = memory_strdup(MEMORY_TAG_NETWORK, "Response body");
     resp.body_len = strlen(resp.body);
     resp.error = strdup("Some error");
     resp.status_code = 200;
@@ -167,6 +169,25 @@ static void test_response_cleanup(void)
     TEST_ASSERT(resp.body_len == 0, "Body length reset");
 }
 
+static void test_response_headers(void)
+{
+    HttpResponse resp;
+    http_response_init(&resp);
+    resp.headers = strdup("Content-Type: application/json\r\nRetry-After:  7 \r\nx-empty:\r\n");
+
+    char value[32];
+    TEST_ASSERT(http_response_header(&resp, "retry-after", value, sizeof(value)) && strcmp(value, "7") == 0,
+                "Header found in any case, value trimmed");
+    TEST_ASSERT(http_response_header(&resp, "x-empty", value, sizeof(value)) && value[0] == '\0',
+                "Empty header value");
+    TEST_ASSERT(!http_response_header(&resp, "content", value, sizeof(value)), "Name prefix does not match");
+    TEST_ASSERT(http_response_header(&resp, "Content-Type", value, 5) && strcmp(value, "appl") == 0,
+                "Value cut to the buffer");
+
+    http_response_cleanup(&resp);
+    TEST_ASSERT(resp.headers == NULL, "Headers cleaned up");
+}
+
 static void test_real_http_request(void)
 {
     // Test with a real HTTP request to a reliable endpoint
@@ -204,6 +225,212 @@ static void test_real_http_request(void)
     http_client_destroy(client);
 }
 
+static void test_pooled_handles(void)
+{
+    // Handles return to the pool after failed requests too; nothing listens on port 1
+    for (int i = 0; i < HTTP_POOL_SIZE + 2; i++) {
+        HttpClient *client = http_client_create();
+        HttpRequest req;
+        http_request_init(&req);
+        http_request_set_url(&req, "http://127.0.0.1:1/");
+        http_client_set_timeout(client, 2, 2);
+
+        HttpResponse resp;
+        http_response_init(&resp);
+        bool success = http_client_execute(client, &req, &resp);
+        if (i == 0) {
+            TEST_ASSERT(success == false && resp.error != NULL, "Refused connection reports an error");
+        }
+
+        http_response_cleanup(&resp);
+        http_request_cleanup(&req);
+        http_client_destroy(client);
+    }
+
+    // Shutting the pool down leaves curl usable by the next client
+    http_client_shutdown();
+    HttpClient *client = http_client_create();
+    TEST_ASSERT(client != NULL && client->initialized, "Client created after shutdown");
+    http_client_destroy(client);
+}
+
+typedef struct SseLog {
+    char events[8][64];
+    char data[8][128];
+    int count;
+    int stop_after;
+} SseLog;
+
+static bool record_sse_event(void *context, const char *event, const char *data)
+{
+    SseLog *log = (SseLog *)context;
+    if (log->count < 8) {
+        snprintf(log->events[log->count], sizeof(log->events[0]), "%s", event);
+        snprintf(log->data[log->count], sizeof(log->data[0]), "%s", data);
+    }
+    log->count++;
+    return log->stop_after == 0 || log->count < log->stop_after;
+}
+
+static void test_sse_parser(void)
+{
+    SseLog log = {0};
+    HttpSseParser parser;
+    http_sse_init(&parser, record_sse_event, &log);
+
+    // Split mid-line and mid-CRLF, with a comment and a multi-line event
+    const char *chunks[] = {
+        ": keep-alive\n\nevent: content_block_delta\nda",
+        "ta: {\"text\":\"Hel\"}\r",
+        "\n\r\ndata: first\ndata:second\n",
+        "\n"
+    };
+    for (int i = 0; i < 4; i++) {
+        http_sse_feed(&parser, chunks[i], strlen(chunks[i]));
+    }
+
+    TEST_ASSERT(log.count == 2, "Two events parsed across chunks");
+    TEST_ASSERT(strcmp(log.events[0], "content_block_delta") == 0, "Event name kept");
+    TEST_ASSERT(strcmp(log.data[0], "{\"text\":\"Hel\"}") == 0, "Data split across chunks joined");
+    TEST_ASSERT(strcmp(log.events[1], "message") == 0, "Unnamed event defaults to message");
+    TEST_ASSERT(strcmp(log.data[1], "first\nsecond") == 0, "Data lines joined by newline");
+    http_sse_cleanup(&parser);
+
+    // A callback returning false stops the stream
+    SseLog stopping = { .stop_after = 1 };
+    http_sse_init(&parser, record_sse_event, &stopping);
+    const char *two = "data: a\n\ndata: b\n\n";
+    bool more = http_sse_feed(&parser, two, strlen(two));
+    TEST_ASSERT(more == false && stopping.count == 1, "Stopped parser delivers no more events");
+    http_sse_cleanup(&parser);
+}
+
+static void test_json_writer(void)
+{
+    const unsigned char image[] = "Many hands make light work.";
+    JsonWriter writer;
+    json_writer_init(&writer);
+    json_writer_begin_object(&writer);
+    json_writer_key(&writer, "text");
+    json_writer_string(&writer, "say \"hi\"\n\t\\ \x01");
+    json_writer_key(&writer, "parts");
+    json_writer_begin_array(&writer);
+    json_writer_base64(&writer, image, sizeof(image) - 1);
+    json_writer_base64(&writer, image, 2);
+    json_writer_begin_object(&writer);
+    json_writer_end_object(&writer);
+    json_writer_end_array(&writer);
+    json_writer_end_object(&writer);
+
+    const char *expected = "{\"text\":\"say \\\"hi\\\"\\n\\t\\\\ \\u0001\","
+                           "\"parts\":[\"TWFueSBoYW5kcyBtYWtlIGxpZ2h0IHdvcmsu\",\"TWE=\",{}]}";
+    TEST_ASSERT(json_writer_ok(&writer), "Balanced document is usable");
+    TEST_ASSERT(json_writer_length(&writer) == strlen(expected), "Length counts encoded data");
+
+    char whole[256] = {0};
+    size_t got = json_writer_read_at(&writer, 0, whole, sizeof(whole) - 1);
+    TEST_ASSERT(got == strlen(expected) && strcmp(whole, expected) == 0, "Output escapes text and encodes data");
+
+    // Read in odd-sized steps, as curl's upload buffer would, then rewind
+    char pieces[256] = {0};
+    size_t offset = 0;
+    while ((got = json_writer_read_at(&writer, offset, pieces + offset, 5)) > 0) {
+        offset += got;
+    }
+    TEST_ASSERT(offset == strlen(expected) && strcmp(pieces, expected) == 0, "Piecewise reads match");
+
+    char rewound[8] = {0};
+    got = json_writer_read_at(&writer, 23, rewound, 6);
+    TEST_ASSERT(got == 6 && strncmp(rewound, expected + 23, 6) == 0, "Read after rewinding lands in place");
+    json_writer_free(&writer);
+
+    // Unbalanced documents are refused
+    json_writer_init(&writer);
+    json_writer_begin_object(&writer);
+    json_writer_key(&writer, "open");
+    TEST_ASSERT(!json_writer_ok(&writer), "Unfinished document is not usable");
+    json_writer_free(&writer);
+}
+
+typedef struct JsonLog {
+    char text[256];
+    char paths[256];
+    int pieces;
+    double numbers;
+    int literals;
+} JsonLog;
+
+static bool record_json_event(void *context, JsonEvent event, const char *path,
+                              const char *text, size_t len, bool last)
+{
+    JsonLog *log = (JsonLog *)context;
+    if (event == JSON_EVENT_STRING && strcmp(path, "candidates[].content.parts[].inlineData.data") == 0) {
+        size_t room = sizeof(log->text) - 1 - strlen(log->text);
+        strncat(log->text, text, len < room ? len : room);
+        log->pieces++;
+    } else if (event == JSON_EVENT_STRING && strcmp(path, "candidates[].content.parts[].text") == 0 && last) {
+        strncat(log->paths, path, sizeof(log->paths) - strlen(log->paths) - 1);
+    } else if (event == JSON_EVENT_NUMBER) {
+        log->numbers += atof(text);
+    } else if (event == JSON_EVENT_TRUE || event == JSON_EVENT_FALSE || event == JSON_EVENT_NULL) {
+        log->literals++;
+    }
+    return true;
+}
+
+static void test_json_reader(void)
+{
+    const char *body =
+        "{ \"candidates\": [ { \"content\": { \"parts\": [\n"
+        "  { \"text\": \"Here\" },\n"
+        "  { \"inlineData\": { \"mimeType\": \"image/png\", \"data\": \"iVBO\\u0052w\\/0\\ud83d\\ude00\" } }\n"
+        "] }, \"index\": 2, \"finishReason\": \"STOP\", \"done\": true, \"extra\": [null, false, -1.5e3] } ] }";
+
+    // Fed one byte at a time, every value still arrives whole
+    JsonLog log = {0};
+    JsonReader reader;
+    json_reader_init(&reader, record_json_event, &log);
+    bool ok = true;
+    for (size_t i = 0; body[i] && ok; i++) {
+        ok = json_reader_feed(&reader, body + i, 1);
+    }
+    TEST_ASSERT(ok && json_reader_finish(&reader), "Document read byte by byte");
+    TEST_ASSERT(strcmp(log.text, "iVBORw/0\xF0\x9F\x98\x80") == 0, "Escapes and surrogate pairs decoded");
+    TEST_ASSERT(strcmp(log.paths, "candidates[].content.parts[].text") == 0, "Paths name keys and array levels");
+    TEST_ASSERT(log.numbers == 2 - 1500, "Numbers reported as text");
+    TEST_ASSERT(log.literals == 3, "Literals reported");
+
+    // Long strings arrive in pieces
+    size_t long_len = JSON_READER_PIECE * 2 + 10;
+    char *big = malloc(long_len + 80);
+    if (big) {
+        int prefix = sprintf(big, "{\"candidates\":[{\"content\":{\"parts\":[{\"inlineData\":{\"data\":\"");
+        memset(big + prefix, 'A', long_len);
+        strcpy(big + prefix + long_len, "\"}}]}}]}");
+
+        JsonLog *big_log = calloc(1, sizeof(JsonLog));
+        if (big_log) {
+            JsonReader *big_reader = malloc(sizeof(JsonReader));
+            json_reader_init(big_reader, record_json_event, big_log);
+            json_reader_feed(big_reader, big, strlen(big));
+            TEST_ASSERT(json_reader_finish(big_reader) && big_log->pieces == 3, "Long string split into pieces");
+            free(big_reader);
+            free(big_log);
+        }
+        free(big);
+    }
+
+    // Malformed input and trailing garbage are refused
+    json_reader_init(&reader, NULL, NULL);
+    TEST_ASSERT(!json_reader_feed(&reader, "{\"a\":]", 6), "Mismatched bracket rejected");
+    json_reader_init(&reader, NULL, NULL);
+    json_reader_feed(&reader, "{} x", 4);
+    TEST_ASSERT(!json_reader_finish(&reader), "Trailing garbage rejected");
+    json_reader_init(&reader, NULL, NULL);
+    json_reader_feed(&reader, "{\"a\":1", 6);
+    TEST_ASSERT(!json_reader_finish(&reader), "Truncated document incomplete");
+}
+
 void test_http_client(void)
 {
     test_client_create_destroy();
@@ -215,5 +442,10 @@ void test_http_client(void)
     test_request_body();
     test_response_init();
     test_response_cleanup();
+    test_response_headers();
+    test_pooled_handles();
+    test_sse_parser();
+    test_json_writer();
+    test_json_reader();
     test_real_http_request();
 }
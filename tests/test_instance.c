@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#include "../src/platform/instance.h"
+
+static int g_wakes = 0;
+
+static void count_wake(void)
+{
+    __atomic_add_fetch(&g_wakes, 1, __ATOMIC_SEQ_CST);
+}
+
+static void test_instance_forward(void)
+{
+    char socket_path[256];
+    snprintf(socket_path, sizeof(socket_path), "/tmp/finder-plus-test-%d.sock", (int)getpid());
+    char path[4096];
+
+    TEST_ASSERT(!instance_forward(socket_path, "/tmp"), "Forwarding should fail with no instance running");
+
+    InstanceServer *server = instance_listen(socket_path, count_wake);
+    TEST_ASSERT(server != NULL, "The first instance should listen");
+    TEST_ASSERT(instance_listen(socket_path, count_wake) == NULL, "A second listener should be refused");
+    TEST_ASSERT(!instance_take(server, path, sizeof(path)), "Nothing should wait before a launch");
+
+    // The listener answers once the folder is queued, so it can be taken at once
+    TEST_ASSERT(instance_forward(socket_path, "/tmp"), "A later launch should hand its folder over");
+    TEST_ASSERT(instance_forward(socket_path, ""), "A launch without a folder should be handed over too");
+    TEST_ASSERT(!instance_forward(socket_path, "relative/path"), "A relative path should be refused");
+    TEST_ASSERT(__atomic_load_n(&g_wakes, __ATOMIC_SEQ_CST) == 2, "Each folder taken should wake the main loop");
+
+    TEST_ASSERT(instance_take(server, path, sizeof(path)) && strcmp(path, "/tmp") == 0,
+                "Folders should be taken in the order they arrived");
+    TEST_ASSERT(instance_take(server, path, sizeof(path)) && path[0] == '\0', "The default folder should arrive empty");
+    TEST_ASSERT(!instance_take(server, path, sizeof(path)), "The queue should be empty once taken");
+
+    instance_stop(server);
+    TEST_ASSERT(access(socket_path, F_OK) != 0, "Stopping should remove the socket");
+    TEST_ASSERT(!instance_forward(socket_path, "/tmp"), "Forwarding should fail once the instance stopped");
+
+    // The lock is free again for the next instance
+    server = instance_listen(socket_path, NULL);
+    TEST_ASSERT(server != NULL, "A new instance should listen after the last one stopped");
+    instance_stop(server);
+
+    char lock_path[300];
+    snprintf(lock_path, sizeof(lock_path), "%s.lock", socket_path);
+    unlink(lock_path);
+}
+
+void test_instance(void)
+{
+    test_instance_forward();
+}
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#include "../src/ai/intent_match.h"
+
+static char test_dir[256];
+
+static void setup_test_dir(void)
+{
+    snprintf(test_dir, sizeof(test_dir), "/tmp/finder_plus_intent_test_%d", getpid());
+    mkdir(test_dir, 0755);
+}
+
+static void cleanup_test_dir(void)
+{
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", test_dir);
+    system(cmd);
+}
+
+static void test_intent_templates(void)
+{
+    char normalized[INTENT_PROMPT_LEN];
+    intent_normalize("Please, show me the Hidden files!", normalized, sizeof(normalized));
+    TEST_ASSERT(strcmp(normalized, "show hidden files") == 0, "Normalizing should drop case, punctuation and filler");
+
+    IntentMatcher *matcher = intent_matcher_create();
+    IntentMatch match;
+    TEST_ASSERT(intent_match(matcher, "Could you show the hidden files", "/", &match) &&
+                match.kind == INTENT_COMMAND && strcmp(match.command_id, "view.hidden") == 0,
+                "A phrasing of a palette command should resolve to it");
+    TEST_ASSERT(intent_match(matcher, "go back", "/", &match) && strcmp(match.command_id, "nav.back") == 0,
+                "Go back should resolve to nav.back");
+    TEST_ASSERT(!intent_match(matcher, "rename report.txt to final.txt", "/", &match) && match.kind == INTENT_NONE,
+                "Other commands should be left to Claude");
+    TEST_ASSERT(!intent_match(matcher, "show hidden files older than a week", "/", &match),
+                "A command with more to it should not match a template");
+    intent_matcher_free(matcher);
+}
+
+static void test_intent_navigation(void)
+{
+    setup_test_dir();
+    char folder[512];
+    snprintf(folder, sizeof(folder), "%s/Invoices", test_dir);
+    mkdir(folder, 0755);
+
+    IntentMatcher *matcher = intent_matcher_create();
+    IntentMatch match;
+    TEST_ASSERT(intent_match(matcher, "go to invoices", test_dir, &match) && match.kind == INTENT_NAVIGATE &&
+                strcmp(match.path, folder) == 0, "A folder here should be found whatever its case");
+    TEST_ASSERT(intent_match(matcher, "Open the Invoices folder.", test_dir, &match) &&
+                strcmp(match.path, folder) == 0, "Articles and a trailing 'folder' should be ignored");
+    TEST_ASSERT(intent_match(matcher, "cd /", test_dir, &match) && strcmp(match.path, "/") == 0,
+                "Absolute paths should open directly");
+    TEST_ASSERT(!intent_match(matcher, "go to receipts", test_dir, &match),
+                "A folder that does not exist should be left to Claude");
+
+    intent_matcher_free(matcher);
+    cleanup_test_dir();
+}
+
+static void test_intent_learning(void)
+{
+    setup_test_dir();
+    char path[512];
+    snprintf(path, sizeof(path), "%s/intents.cache", test_dir);
+
+    IntentCall calls[2];
+    memset(calls, 0, sizeof(calls));
+    strcpy(calls[0].name, "file_search");
+    strcpy(calls[0].input_json, "{\"query\": \"*.mov\",\n\t\"min_size\": \"1GB\"}");
+    strcpy(calls[1].name, "batch_move");
+    strcpy(calls[1].input_json, "{\"destination\": \"Videos\"}");
+
+    IntentMatcher *matcher = intent_matcher_create();
+    IntentMatch match;
+    TEST_ASSERT(!intent_match(matcher, "move big videos into Videos", test_dir, &match),
+                "An unknown command should not resolve");
+    TEST_ASSERT(intent_matcher_learn(matcher, "move big videos into Videos", test_dir, calls, 2),
+                "A command should be learned");
+    TEST_ASSERT(intent_match(matcher, "Move the big videos into videos!", test_dir, &match) &&
+                match.kind == INTENT_TOOLS && match.call_count == 2 &&
+                strcmp(match.calls[1].name, "batch_move") == 0, "Its rephrasing should resolve to the learned calls");
+    TEST_ASSERT(!intent_match(matcher, "move big videos into Videos", "/tmp", &match),
+                "Learned commands should only resolve in their folder");
+    TEST_ASSERT(intent_matcher_save(matcher, path), "Learned commands should save");
+    intent_matcher_free(matcher);
+
+    matcher = intent_matcher_create();
+    TEST_ASSERT(intent_matcher_load(matcher, path) && intent_matcher_count(matcher) == 1,
+                "Learned commands should load");
+    TEST_ASSERT(intent_match(matcher, "move big videos into Videos", test_dir, &match) &&
+                strcmp(match.calls[0].input_json, calls[0].input_json) == 0,
+                "Tool input should survive a save and load");
+    intent_matcher_free(matcher);
+    cleanup_test_dir();
+}
+
+void test_intent_match(void)
+{
+    test_intent_templates();
+    test_intent_navigation();
+    test_intent_learning();
+}
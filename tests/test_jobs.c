@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#include "../src/utils/jobs.h"
+
+static atomic_int g_ran;
+static atomic_int g_completed;
+static atomic_int g_cancelled;
+
+static void count_job(void *arg, JobToken *token)
+{
+    (void)arg;
+    (void)token;
+    atomic_fetch_add(&g_ran, 1);
+}
+
+static void count_done(void *arg, bool cancelled)
+{
+    (void)arg;
+    atomic_fetch_add(cancelled ? &g_cancelled : &g_completed, 1);
+}
+
+// Runs until cancelled (or about two seconds)
+static void spin_job(void *arg, JobToken *token)
+{
+    (void)arg;
+    for (int i = 0; i < 2000 && !job_token_cancelled(token); i++) {
+        usleep(1000);
+    }
+    atomic_fetch_add(&g_ran, 1);
+}
+
+// Submits children from inside a job, onto its worker's deque
+static void fan_out_job(void *arg, JobToken *token)
+{
+    for (int i = 0; i < 64; i++) {
+        jobs_submit(JOB_QOS_USER_INITIATED, count_job, NULL, arg, token);
+    }
+}
+
+// Records the class of the first completion to run
+static int g_first_done = -1;
+
+static void first_done(void *arg, bool cancelled)
+{
+    (void)cancelled;
+    if (g_first_done < 0) g_first_done = (int)(intptr_t)arg;
+}
+
+static void reset_counts(void)
+{
+    atomic_store(&g_ran, 0);
+    atomic_store(&g_completed, 0);
+    atomic_store(&g_cancelled, 0);
+}
+
+static void test_jobs_inline(void)
+{
+    reset_counts();
+    TEST_ASSERT(!jobs_started(), "Scheduler should not run before jobs_start");
+    TEST_ASSERT(!jobs_submit(JOB_QOS_UTILITY, count_job, count_done, NULL, NULL),
+                "Jobs should run inline without workers");
+    TEST_ASSERT(atomic_load(&g_ran) == 1 && atomic_load(&g_completed) == 1,
+                "Inline jobs should run and complete at once");
+}
+
+static void test_jobs_pool(void)
+{
+    reset_counts();
+    TEST_ASSERT(jobs_start(4) && jobs_started(), "Scheduler should start four workers");
+
+    JobToken *token = job_token_create();
+    for (int qos = 0; qos < JOB_QOS_COUNT; qos++) {
+        for (int i = 0; i < 50; i++) {
+            jobs_submit((JobQos)qos, count_job, count_done, NULL, token);
+        }
+    }
+    job_token_wait(token);
+    TEST_ASSERT(atomic_load(&g_ran) == 200, "Every queued job should run");
+    int drained = 0;
+    for (int i = 0; i < 100 && drained < 200; i++) {
+        drained += jobs_drain_completions(0);
+    }
+    TEST_ASSERT(drained == 200 && atomic_load(&g_completed) == 200,
+                "Every completion should run on the draining thread");
+
+    // Completions of the most urgent class run first, even when queued last
+    jobs_submit(JOB_QOS_BACKGROUND, count_job, first_done, (void *)(intptr_t)JOB_QOS_BACKGROUND, token);
+    job_token_wait(token);
+    jobs_submit(JOB_QOS_USER_INTERACTIVE, count_job, first_done, (void *)(intptr_t)JOB_QOS_USER_INTERACTIVE, token);
+    job_token_wait(token);
+    TEST_ASSERT(jobs_drain_completions(1e-9) == 1, "A spent budget should still run one completion");
+    TEST_ASSERT(g_first_done == JOB_QOS_USER_INTERACTIVE, "The most urgent completion should run first");
+    jobs_drain_completions(0);
+
+    // Nested submissions land on the worker's deque and are run or stolen
+    reset_counts();
+    jobs_submit(JOB_QOS_USER_INITIATED, fan_out_job, NULL, NULL, token);
+    job_token_wait(token);
+    TEST_ASSERT(atomic_load(&g_ran) == 64, "Jobs submitted from a job should all run");
+    job_token_release(token);
+
+    // Cancelling stops a running job and skips queued ones
+    reset_counts();
+    JobToken *cancel = job_token_create();
+    for (int i = 0; i < 8; i++) {
+        jobs_submit(JOB_QOS_BACKGROUND, spin_job, count_done, NULL, cancel);
+    }
+    usleep(20000);
+    job_token_cancel(cancel);
+    job_token_wait(cancel);
+    jobs_drain_completions(0);
+    TEST_ASSERT(job_token_cancelled(cancel), "Token should report cancellation");
+    TEST_ASSERT(atomic_load(&g_ran) >= 1 && atomic_load(&g_ran) <= 2,
+                "Background jobs should occupy at most a quarter of the pool");
+    TEST_ASSERT(atomic_load(&g_cancelled) == 8, "Every cancelled job should complete as cancelled");
+    job_token_release(cancel);
+
+    // Stopping cancels whatever is still queued and runs its completions
+    reset_counts();
+    JobToken *blocker = job_token_create();
+    jobs_submit(JOB_QOS_BACKGROUND, spin_job, NULL, NULL, blocker);
+    for (int i = 0; i < 10; i++) {
+        jobs_submit(JOB_QOS_BACKGROUND, count_job, count_done, NULL, NULL);
+    }
+    job_token_cancel(blocker);
+    jobs_stop();
+    TEST_ASSERT(!jobs_started(), "Scheduler should stop");
+    TEST_ASSERT(atomic_load(&g_completed) + atomic_load(&g_cancelled) == 10,
+                "Stopping should run every pending completion");
+    job_token_wait(blocker);
+    job_token_release(blocker);
+}
+
+void test_jobs(void)
+{
+    test_jobs_inline();
+    test_jobs_pool();
+}
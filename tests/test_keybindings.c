@@ -190,6 +190,41 @@ static void test_keybindings_conflict(void)
     keybindings_free(&config);
 }
 
+// Test the compiled (key, modifiers) lookup
+static void test_keybindings_lookup(void)
+{
+    printf("  Testing keybindings_lookup...\n");
+
+    KeyBindingConfig config;
+    keybindings_init(&config);
+
+    TEST_ASSERT_EQ(ACTION_COPY, keybindings_lookup(&config, KEY_C, MOD_SUPER), "Cmd+C looks up copy");
+    TEST_ASSERT_EQ(ACTION_NONE, keybindings_lookup(&config, KEY_C, MOD_SUPER | MOD_SHIFT),
+                   "Modifiers must match exactly");
+    TEST_ASSERT_EQ(ACTION_TOGGLE_PREVIEW, keybindings_lookup(&config, KEY_P, MOD_SUPER | MOD_SHIFT),
+                   "First of two bindings on one combination wins");
+    TEST_ASSERT_EQ(ACTION_NONE, keybindings_lookup(&config, 100000, MOD_SUPER), "Out-of-range key is unbound");
+    TEST_ASSERT_EQ(ACTION_NONE, keybindings_lookup(&config, KEY_C, 99), "Out-of-range modifiers are unbound");
+
+    // Rebinding moves the action to its new combination
+    keybindings_set(&config, ACTION_COPY, KEY_K, MOD_SUPER | MOD_CTRL);
+    TEST_ASSERT_EQ(ACTION_COPY, keybindings_lookup(&config, KEY_K, MOD_SUPER | MOD_CTRL), "Rebinding is looked up");
+    TEST_ASSERT_EQ(ACTION_NONE, keybindings_lookup(&config, KEY_C, MOD_SUPER), "Old combination is freed");
+
+    // Removing shifts later bindings; their lookups must follow
+    keybindings_remove(&config, ACTION_COPY);
+    TEST_ASSERT_EQ(ACTION_NONE, keybindings_lookup(&config, KEY_K, MOD_SUPER | MOD_CTRL), "Removed binding is gone");
+    TEST_ASSERT_EQ(ACTION_PASTE, keybindings_lookup(&config, KEY_V, MOD_SUPER), "Later bindings survive removal");
+    const KeyBinding *paste = keybindings_get(&config, ACTION_PASTE);
+    TEST_ASSERT(paste != NULL && paste->action == ACTION_PASTE && paste->key == KEY_V,
+                "Get follows the shifted binding");
+
+    keybindings_reset_defaults(&config);
+    TEST_ASSERT_EQ(ACTION_COPY, keybindings_lookup(&config, KEY_C, MOD_SUPER), "Reset restores the lookup");
+
+    keybindings_free(&config);
+}
+
 // Test action name lookup
 static void test_keybindings_action_name(void)
 {
@@ -368,6 +403,7 @@ void test_keybindings(void)
     test_keybindings_remove();
     test_keybindings_reset_defaults();
     test_keybindings_conflict();
+    test_keybindings_lookup();
     test_keybindings_action_name();
     test_keybindings_shortcut_string();
     test_keybindings_parse_shortcut();
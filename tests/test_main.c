@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "../src/ai/extract_pool.h"
+
 // Simple test framework
 static int tests_run = 0;
 static int tests_passed = 0;
@@ -50,6 +52,7 @@ extern void test_tabs(void);
 extern void test_tool_registry(void);
 extern void test_http_client(void);
 extern void test_claude_client(void);
+extern void test_api_scheduler(void);
 extern void test_tool_executor(void);
 extern void test_ai(void);
 extern void test_phase6(void);
@@ -61,16 +64,46 @@ extern void test_context_menu(void);
 extern void test_dual_pane(void);
 extern void test_network(void);
 extern void test_perf(void);
+extern void test_fs_watch(void);
+extern void test_dir_size(void);
+extern void test_fuzzy(void);
+extern void test_trace(void);
+extern void test_volumes(void);
+extern void test_session(void);
+extern void test_jobs(void);
+extern void test_arena(void);
+extern void test_cache_registry(void);
+extern void test_instance(void);
+extern void test_query_server(void);
+extern void test_stat_cache(void);
+extern void test_exclude_set(void);
+extern void test_string_set(void);
+extern void test_undo_log(void);
+extern void test_archive(void);
+extern void test_spotlight_search(void);
+extern void test_intent_match(void);
+extern void test_file_type(void);
+extern void test_filter_query(void);
+extern void test_smart_folder(void);
+extern void test_content_search(void);
 extern void test_phase2(void);
 extern void test_video(void);
+extern void test_thumbnails(void);
 extern void test_preview(void);
+extern void test_text_map(void);
+extern void test_syntax(void);
 extern void test_gemini_client(void);
 extern void test_font(void);
 extern void test_progress_indicator(void);
 extern void test_file_view_modal(void);
 
-int main(void)
+int main(int argc, char *argv[])
 {
+    // Document extraction tests run this binary as their worker
+    if (argc > 1 && strcmp(argv[1], EXTRACT_WORKER_ARG) == 0) {
+        return extract_worker_run();
+    }
+
     printf("\n=== Finder Plus Test Suite ===\n\n");
 
     printf("[Filesystem Tests]\n");
@@ -100,6 +133,9 @@ int main(void)
     printf("\n[Claude Client Tests]\n");
     test_claude_client();
 
+    printf("\n[API Scheduler Tests]\n");
+    test_api_scheduler();
+
     test_gemini_client();
 
     printf("\n[Tool Executor Tests]\n");
@@ -135,15 +171,90 @@ int main(void)
     printf("\n[Performance Tests]\n");
     test_perf();
 
+    printf("\n[Watch Bus Tests]\n");
+    test_fs_watch();
+
+    printf("\n[Folder Size Tests]\n");
+    test_dir_size();
+
+    printf("\n[Fuzzy Match Tests]\n");
+    test_fuzzy();
+
+    printf("\n[Trace Tests]\n");
+    test_trace();
+
+    printf("\n[Volume Tests]\n");
+    test_volumes();
+
+    printf("\n[Session Tests]\n");
+    test_session();
+
+    printf("\n[Job Tests]\n");
+    test_jobs();
+
+    printf("\n[Arena Tests]\n");
+    test_arena();
+
+    printf("\n[Cache Registry Tests]\n");
+    test_cache_registry();
+
+    printf("\n[Instance Tests]\n");
+    test_instance();
+
+    printf("\n[Query Server Tests]\n");
+    test_query_server();
+
+    printf("\n[Stat Cache Tests]\n");
+    test_stat_cache();
+
+    printf("\n[Exclude Set Tests]\n");
+    test_exclude_set();
+
+    printf("\n[String Set Tests]\n");
+    test_string_set();
+
+    printf("\n[Undo Log Tests]\n");
+    test_undo_log();
+
+    printf("\n[Archive Tests]\n");
+    test_archive();
+
+    printf("\n[Spotlight Search Tests]\n");
+    test_spotlight_search();
+
+    printf("\n[Intent Match Tests]\n");
+    test_intent_match();
+
+    printf("\n[File Type Tests]\n");
+    test_file_type();
+
+    printf("\n[Filter Query Tests]\n");
+    test_filter_query();
+
+    printf("\n[Smart Folder Tests]\n");
+    test_smart_folder();
+
+    printf("\n[Content Search Tests]\n");
+    test_content_search();
+
     printf("\n[Phase 2 Tests]\n");
     test_phase2();
 
     printf("\n[Video Tests]\n");
     test_video();
 
+    printf("\n[Thumbnail Tests]\n");
+    test_thumbnails();
+
     printf("\n[Preview Tests]\n");
     test_preview();
 
+    printf("\n[Text Map Tests]\n");
+    test_text_map();
+
+    printf("\n[Syntax Tests]\n");
+    test_syntax();
+
     printf("\n[Font Tests]\n");
     test_font();
 
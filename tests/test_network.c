@@ -41,6 +41,10 @@ extern void inc_tests_failed(void);
 } while(0)
 
 #include "../src/core/network.h"
+#include "../src/core/network_io.h"
+#include "../src/core/remote_blocks.h"
+
+#include <unistd.h>
 
 static void test_network_manager_init(void)
 {
@@ -172,6 +176,246 @@ static void test_connection_get_null(void)
     network_shutdown(&mgr);
 }
 
+static void test_transfer_without_connection(void)
+{
+    NetworkManager mgr;
+    network_init(&mgr);
+
+    CopyControl control;
+    copy_control_init(&control);
+    TEST_ASSERT(!network_download_file(&mgr, 999, "/remote/file", "/tmp/finder_plus_no_download", &control),
+                "Download should fail without a connection");
+    TEST_ASSERT(!network_upload_file(&mgr, 999, "/tmp/finder_plus_no_upload", "/remote/file", &control),
+                "Upload should fail without a connection");
+    TEST_ASSERT_EQ(0, (int)atomic_load(&control.bytes_done), "No bytes should be reported");
+
+    uint64_t bytes = 0, files = 0;
+    TEST_ASSERT(!network_remote_folder_size(&mgr, 999, "/remote/dir", &bytes, &files),
+                "Remote walk should fail without a connection");
+    const char *paths[] = { "/remote/file" };
+    char hashes[1][NETWORK_HASH_HEX + 1];
+    TEST_ASSERT(!network_remote_hashes(&mgr, 999, paths, 1, hashes),
+                "Remote hashing should fail without a connection");
+    unsigned char *data = NULL;
+    size_t size = 0;
+    TEST_ASSERT(!network_remote_thumbnail(&mgr, 999, "/remote/photo.jpg", 256, &data, &size),
+                "Remote thumbnail should fail without a connection");
+
+    network_shutdown(&mgr);
+}
+
+static void test_submit_without_connection(void)
+{
+    NetworkManager mgr;
+    network_init(&mgr);
+
+    NetworkRequest req;
+    network_request_init(&req, NET_OP_LIST);
+    TEST_ASSERT_EQ(-1, req.fd, "New request should have no local file");
+    TEST_ASSERT(req.length == UINT64_MAX, "New request should run to the end");
+    TEST_ASSERT(req.size == UINT64_MAX && req.mtime == 0, "New request should leave size and mtime alone");
+    TEST_ASSERT(!network_request_is_complete(&req), "New request should not be complete");
+
+    strncpy(req.path, "/remote", NETWORK_PATH_MAX - 1);
+    TEST_ASSERT(!network_submit(&mgr, 999, &req), "Submit should fail without a connection");
+    TEST_ASSERT(network_request_is_complete(&req), "Refused request should be complete");
+    TEST_ASSERT(!req.ok, "Refused request should not be ok");
+
+    network_request_free(&req);
+    network_shutdown(&mgr);
+}
+
+static void test_server_side_without_connection(void)
+{
+    NetworkManager mgr;
+    network_init(&mgr);
+
+    CopyControl control;
+    copy_control_init(&control);
+    TEST_ASSERT(!network_copy_remote(&mgr, 999, "/remote/a", "/remote/b"),
+                "Remote copy should fail without a connection");
+    TEST_ASSERT(!network_sync_file(&mgr, 999, "/tmp/finder_plus_no_sync", "/remote/file", &control),
+                "Sync should fail without a connection");
+    TEST_ASSERT(!network_sync_directory(&mgr, 999, "/tmp", "/remote/dir", &control),
+                "Folder sync should fail without a connection");
+    TEST_ASSERT_EQ(0, (int)atomic_load(&control.bytes_done), "No bytes should be reported");
+
+    network_shutdown(&mgr);
+}
+
+static void test_smb_connect_without_share(void)
+{
+    NetworkManager mgr;
+    network_init(&mgr);
+
+    // No share named in the remote path: refused before any network traffic
+    ConnectionProfile profile;
+    memset(&profile, 0, sizeof(profile));
+    profile.type = CONN_TYPE_SMB;
+    strncpy(profile.host, "nas.invalid", sizeof(profile.host) - 1);
+    strncpy(profile.username, "user", sizeof(profile.username) - 1);
+
+    int id = network_connect(&mgr, &profile);
+    TEST_ASSERT(id > 0, "Connection slot should be assigned");
+    TEST_ASSERT_EQ(CONN_STATUS_ERROR, network_get_status(&mgr, id), "SMB without a share should fail");
+    TEST_ASSERT(network_get_error(&mgr, id)[0] != '\0', "Failure should be explained");
+
+    DirectoryState dir;
+    directory_state_init(&dir);
+    TEST_ASSERT(!network_read_directory(&mgr, id, "/", &dir), "Failed connection should not list");
+    directory_state_free(&dir);
+
+    network_shutdown(&mgr);
+}
+
+static void test_connect_reuse(void)
+{
+    NetworkManager mgr;
+    network_init(&mgr);
+
+    // Nothing listens on port 1: each attempt fails, and a failed connection is not reused
+    ConnectionProfile profile;
+    memset(&profile, 0, sizeof(profile));
+    profile.type = CONN_TYPE_SFTP;
+    strncpy(profile.host, "127.0.0.1", sizeof(profile.host) - 1);
+    strncpy(profile.username, "user", sizeof(profile.username) - 1);
+    profile.port = 1;
+
+    int first = network_connect(&mgr, &profile);
+    int second = network_connect(&mgr, &profile);
+    TEST_ASSERT(first > 0 && second > 0 && first != second, "A failed connection should not be reused");
+    TEST_ASSERT_EQ(CONN_STATUS_ERROR, network_get_status(&mgr, first), "Refused connection should fail");
+
+    // Only lost sessions of live connections are reconnected
+    TEST_ASSERT(!network_update(&mgr), "Failed connections should be left alone");
+    TEST_ASSERT_EQ(CONN_STATUS_ERROR, network_get_status(&mgr, second), "Status should stay failed");
+
+    network_shutdown(&mgr);
+    TEST_ASSERT_EQ(0, mgr.connection_count, "Shutdown should close every connection");
+}
+
+static void test_remote_blocks(void)
+{
+    char dir[] = "/tmp/test_remote_blocks_XXXXXX";
+    TEST_ASSERT(mkdtemp(dir) != NULL, "Should create a cache directory");
+    RemoteBlocks *cache = remote_blocks_create(dir, 4 * REMOTE_BLOCK_SIZE);
+    TEST_ASSERT(cache != NULL, "Should create a block cache");
+    if (!cache) {
+        return;
+    }
+
+    // Two and a half blocks, none fetched yet
+    uint64_t size = 2 * REMOTE_BLOCK_SIZE + REMOTE_BLOCK_SIZE / 2;
+    RemoteBlockFile *file = remote_blocks_open(cache, "sftp://a@h:22/big", size, 100);
+    TEST_ASSERT(file != NULL, "Should open a file's blocks");
+    uint64_t run_offset = 1, run_length = 1;
+    TEST_ASSERT(remote_blocks_missing(file, 10, 20, &run_offset, &run_length), "New file should miss blocks");
+    TEST_ASSERT(run_offset == 0 && run_length == REMOTE_BLOCK_SIZE, "Run should be the whole first block");
+    char buf[64];
+    TEST_ASSERT(remote_blocks_read(file, 0, buf, sizeof(buf)) == -1, "Missing blocks should not read");
+
+    // Fetch the first block as a preview would
+    char *block = malloc(REMOTE_BLOCK_SIZE);
+    memset(block, 'a', REMOTE_BLOCK_SIZE);
+    pwrite(remote_blocks_fd(file), block, REMOTE_BLOCK_SIZE, 0);
+    remote_blocks_fill(file, 0, REMOTE_BLOCK_SIZE);
+    TEST_ASSERT(remote_blocks_read(file, 10, buf, sizeof(buf)) == (ssize_t)sizeof(buf) && buf[0] == 'a',
+                "Filled block should read");
+    TEST_ASSERT(remote_blocks_missing(file, 0, size, &run_offset, &run_length), "Rest should be missing");
+    TEST_ASSERT(run_offset == REMOTE_BLOCK_SIZE && run_length == size - REMOTE_BLOCK_SIZE,
+                "Run should reach the end of the file");
+    TEST_ASSERT(!remote_blocks_complete(file), "File should not be complete");
+    TEST_ASSERT(remote_blocks_used(cache) == REMOTE_BLOCK_SIZE, "Cache should count the filled block");
+    remote_blocks_close(file);
+
+    // A later open picks up what was fetched; a changed file starts over
+    file = remote_blocks_open(cache, "sftp://a@h:22/big", size, 100);
+    TEST_ASSERT(file && !remote_blocks_missing(file, 0, REMOTE_BLOCK_SIZE, &run_offset, &run_length),
+                "Reopened file should keep its blocks");
+    remote_blocks_close(file);
+    TEST_ASSERT(remote_blocks_find(cache, "sftp://a@h:22/big", size, 200) == NULL,
+                "Find should not match another version");
+    file = remote_blocks_open(cache, "sftp://a@h:22/big", size, 200);
+    TEST_ASSERT(file && remote_blocks_missing(file, 0, 1, &run_offset, &run_length),
+                "Modified file should start empty");
+    TEST_ASSERT(remote_blocks_used(cache) == 0, "Stale blocks should no longer count");
+
+    // The tail block counts once written up to the end
+    memset(block, 'b', REMOTE_BLOCK_SIZE);
+    for (uint64_t at = 0; at < size; at += REMOTE_BLOCK_SIZE) {
+        uint64_t n = size - at < REMOTE_BLOCK_SIZE ? size - at : REMOTE_BLOCK_SIZE;
+        pwrite(remote_blocks_fd(file), block, (size_t)n, (off_t)at);
+    }
+    remote_blocks_fill(file, 0, size);
+    TEST_ASSERT(remote_blocks_complete(file), "Filled file should be complete");
+    TEST_ASSERT(remote_blocks_read(file, size - 10, buf, sizeof(buf)) == 10, "Read should stop at the end");
+    remote_blocks_close(file);
+
+    // Going over the budget evicts the least recently opened file
+    file = remote_blocks_open(cache, "sftp://a@h:22/other", 2 * REMOTE_BLOCK_SIZE, 1);
+    pwrite(remote_blocks_fd(file), block, REMOTE_BLOCK_SIZE, 0);
+    pwrite(remote_blocks_fd(file), block, REMOTE_BLOCK_SIZE, REMOTE_BLOCK_SIZE);
+    remote_blocks_fill(file, 0, 2 * REMOTE_BLOCK_SIZE);
+    TEST_ASSERT(remote_blocks_used(cache) == 2 * REMOTE_BLOCK_SIZE, "Eviction should free the older file");
+    TEST_ASSERT(remote_blocks_find(cache, "sftp://a@h:22/big", size, 200) == NULL, "Evicted file should be gone");
+    TEST_ASSERT(!remote_blocks_missing(file, 0, 2 * REMOTE_BLOCK_SIZE, &run_offset, &run_length),
+                "File being filled should be kept");
+    remote_blocks_close(file);
+    remote_blocks_destroy(cache);
+
+    // A new cache counts what the last one left
+    cache = remote_blocks_create(dir, 4 * REMOTE_BLOCK_SIZE);
+    TEST_ASSERT(cache && remote_blocks_used(cache) == 2 * REMOTE_BLOCK_SIZE, "Cache should count blocks on disk");
+    remote_blocks_destroy(cache);
+
+    free(block);
+    char command[128];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    system(command);
+}
+
+// Helper: Append a 12-byte little-endian IFD entry with a LONG value
+static size_t put_ifd_entry(unsigned char *p, uint16_t tag, uint32_t value)
+{
+    unsigned char entry[12] = { tag & 0xFF, tag >> 8, 4, 0, 1, 0, 0, 0,
+                                value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, value >> 24 };
+    memcpy(p, entry, sizeof(entry));
+    return sizeof(entry);
+}
+
+static void test_jpeg_thumbnail(void)
+{
+    // SOI, then APP1 "Exif" with a TIFF header, an empty IFD0, and IFD1 pointing at a
+    // 6-byte thumbnail that follows it
+    unsigned char jpeg[128] = { 0xFF, 0xD8, 0xFF, 0xE1, 0, 0, 'E', 'x', 'i', 'f', 0, 0 };
+    size_t tiff = 12;
+    unsigned char *t = jpeg + tiff;
+    memcpy(t, "II\x2a\0\x08\0\0\0", 8);           // IFD0 at 8
+    t[8] = 0; t[9] = 0;                             // No entries
+    t[10] = 14; t[11] = 0; t[12] = 0; t[13] = 0;    // IFD1 at 14
+    t[14] = 2; t[15] = 0;                           // Two entries
+    size_t at = 16;
+    at += put_ifd_entry(t + at, 0x0201, 44);
+    at += put_ifd_entry(t + at, 0x0202, 6);
+    t[at++] = 0; t[at++] = 0; t[at++] = 0; t[at++] = 0;
+    unsigned char thumb[6] = { 0xFF, 0xD8, 1, 2, 0xFF, 0xD9 };
+    memcpy(t + at, thumb, sizeof(thumb));
+    at += sizeof(thumb);
+    size_t segment = 2 + 6 + at;
+    jpeg[4] = (unsigned char)(segment >> 8);
+    jpeg[5] = (unsigned char)segment;
+    size_t total = 4 + segment;
+
+    size_t offset = 0, length = 0;
+    TEST_ASSERT(network_jpeg_thumbnail(jpeg, total, &offset, &length), "Should find the EXIF thumbnail");
+    TEST_ASSERT(offset == tiff + 44 && length == 6 && memcmp(jpeg + offset, thumb, 6) == 0,
+                "Thumbnail should be located within the data");
+    TEST_ASSERT(!network_jpeg_thumbnail(jpeg, total - 3, &offset, &length),
+                "Truncated data should have no thumbnail");
+    TEST_ASSERT(!network_jpeg_thumbnail(thumb, sizeof(thumb), &offset, &length),
+                "JPEG without EXIF should have no thumbnail");
+}
+
 void test_network(void)
 {
     test_network_manager_init();
@@ -181,4 +425,11 @@ void test_network(void)
     test_profile_management();
     test_active_connection();
     test_connection_get_null();
+    test_transfer_without_connection();
+    test_submit_without_connection();
+    test_server_side_without_connection();
+    test_smb_connect_without_share();
+    test_connect_reuse();
+    test_remote_blocks();
+    test_jpeg_thumbnail();
 }
@@ -3,8 +3,10 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 
 #include "core/operation_queue.h"
+#include "core/undo_log.h"
 
 // External test macros from test_main.c
 extern void inc_tests_run(void);
@@ -142,6 +144,9 @@ static void test_queue_op_type_names(void)
     TEST_ASSERT_STR_EQ("Rename", queue_op_type_name(QUEUE_OP_RENAME), "Rename type name");
     TEST_ASSERT_STR_EQ("Create Folder", queue_op_type_name(QUEUE_OP_CREATE_DIR), "Create Folder type name");
     TEST_ASSERT_STR_EQ("Duplicate", queue_op_type_name(QUEUE_OP_DUPLICATE), "Duplicate type name");
+    TEST_ASSERT_STR_EQ("Sync", queue_op_type_name(QUEUE_OP_SYNC), "Sync type name");
+    TEST_ASSERT_STR_EQ("Reorganize", queue_op_type_name(QUEUE_OP_MOVE_BATCH), "Move batch type name");
+    TEST_ASSERT_STR_EQ("Erase", queue_op_type_name(QUEUE_OP_REMOVE), "Remove type name");
 }
 
 // Test operation status names
@@ -302,6 +307,7 @@ static void test_queue_worker(void)
     bool started = operation_queue_start(&queue);
     TEST_ASSERT(started == true, "Worker thread should start");
     TEST_ASSERT(queue.worker_running == true, "Worker should be marked as running");
+    TEST_ASSERT_EQ(QUEUE_MAX_WORKERS, queue.worker_count, "Every worker thread should start");
 
     // Add a copy operation - dest should be directory, not full path
     char source[512], dest_dir[512], expected_dest[512];
@@ -443,6 +449,44 @@ static void test_queue_overall_progress(void)
     operation_queue_free(&queue);
 }
 
+// Test the lock-free status snapshot
+static void test_queue_status(void)
+{
+    printf("  Testing queue status snapshot...\n");
+
+    OperationQueue queue;
+    operation_queue_init(&queue);
+
+    char source[512], dest[512];
+    snprintf(source, sizeof(source), "%s/file1.txt", TEST_DIR);
+    snprintf(dest, sizeof(dest), "%s/subdir", TEST_DIR);
+
+    int id1 = operation_queue_copy(&queue, source, dest);
+    int id2 = operation_queue_copy(&queue, source, dest);
+    operation_queue_cancel(&queue, id2);
+
+    QueueStatus status;
+    operation_queue_status(&queue, &status);
+    TEST_ASSERT_EQ(1, status.pending_count, "Snapshot should count pending operations");
+    TEST_ASSERT_EQ(2, status.total_count, "Snapshot should count all operations");
+    TEST_ASSERT(!status.is_processing && !status.has_current, "Nothing should be running yet");
+    TEST_ASSERT_EQ(0, status.progress, "Nothing should have progressed yet");
+    TEST_ASSERT_EQ(-1, operation_queue_operation_progress(&queue, id1), "A pending operation has no live progress");
+
+    operation_queue_start(&queue);
+    int wait_count = 0;
+    do {
+        usleep(100000);
+        operation_queue_status(&queue, &status);
+    } while (++wait_count < 50 && (status.pending_count > 0 || status.is_processing));
+
+    TEST_ASSERT_EQ(0, status.pending_count, "Snapshot should see the copy finish");
+    TEST_ASSERT_EQ(50, status.progress, "One finished and one cancelled operation make 50%");
+
+    operation_queue_stop(&queue);
+    operation_queue_free(&queue);
+}
+
 // Test retry operation
 static void test_queue_retry(void)
 {
@@ -475,7 +519,8 @@ static void test_queue_retry(void)
     TEST_ASSERT(op->can_retry == true, "Failed operation should be retryable");
     TEST_ASSERT(strlen(op->error_message) > 0, "Failed operation should have error message");
 
-    // Try retry
+    // Try retry (paused, or a woken worker would pick it straight up again)
+    operation_queue_pause(&queue);
     bool retried = operation_queue_retry(&queue, id);
     TEST_ASSERT(retried == true, "Should be able to retry failed operation");
 
@@ -486,7 +531,417 @@ static void test_queue_retry(void)
     operation_queue_free(&queue);
 }
 
+// Test that operations on one device keep their queue order
+static void test_queue_device_order(void)
+{
+    printf("  Testing per-device ordering...\n");
+
+    OperationQueue queue;
+    operation_queue_init(&queue);
+
+    // The copy targets a folder that only exists once the first operation has run
+    char source[512], folder[512], expected_dest[512];
+    snprintf(source, sizeof(source), "%s/file2.txt", TEST_DIR);
+    snprintf(folder, sizeof(folder), "%s/ordered", TEST_DIR);
+    snprintf(expected_dest, sizeof(expected_dest), "%s/ordered/file2.txt", TEST_DIR);
+
+    int dir_id = operation_queue_create_dir(&queue, TEST_DIR, "ordered");
+    int copy_id = operation_queue_copy(&queue, source, folder);
+    QueuedOperation *op = operation_queue_get(&queue, copy_id);
+    TEST_ASSERT(op != NULL && op->device_count == 1, "Source and destination should share one device");
+
+    operation_queue_start(&queue);
+
+    int wait_count = 0;
+    while (wait_count < 50 && operation_queue_pending_count(&queue) + (operation_queue_is_processing(&queue) ? 1 : 0) > 0) {
+        usleep(100000);
+        wait_count++;
+    }
+
+    TEST_ASSERT_EQ(OP_STATUS_COMPLETED, operation_queue_get(&queue, dir_id)->status, "Create dir should complete");
+    TEST_ASSERT_EQ(OP_STATUS_COMPLETED, operation_queue_get(&queue, copy_id)->status, "Copy into it should complete");
+    struct stat st;
+    TEST_ASSERT(stat(expected_dest, &st) == 0, "Copied file should be in the new folder");
+
+    operation_queue_stop(&queue);
+    operation_queue_free(&queue);
+}
+
+// Test that the queue grows past its initial buffer and trims finished operations
+static void test_queue_many_operations(void)
+{
+    printf("  Testing many queued operations...\n");
+
+    OperationQueue queue;
+    operation_queue_init(&queue);
+
+    char path[512];
+    int first_id = -1, last_id = -1;
+    for (int i = 0; i < 10000; i++) {
+        snprintf(path, sizeof(path), "%s/missing_%d.txt", TEST_DIR, i);
+        last_id = operation_queue_delete(&queue, path);
+        if (first_id < 0) first_id = last_id;
+    }
+
+    TEST_ASSERT(last_id > 0, "Should queue 10000 operations");
+    TEST_ASSERT_EQ(10000, operation_queue_total_count(&queue), "All operations should be listed");
+    TEST_ASSERT_EQ(10000, operation_queue_pending_count(&queue), "All operations should be pending");
+    QueuedOperation *op = operation_queue_get(&queue, first_id + 5000);
+    snprintf(path, sizeof(path), "%s/missing_5000.txt", TEST_DIR);
+    TEST_ASSERT(op != NULL && strcmp(op->source_path, path) == 0, "Lookup by ID should find the right operation");
+    TEST_ASSERT(operation_queue_get(&queue, last_id + 1) == NULL, "Unknown ID should not be found");
+
+    QueueRow rows[4];
+    int row_count = operation_queue_rows(&queue, 9998, rows, 4);
+    TEST_ASSERT_EQ(2, row_count, "Rows should stop at the end of the queue");
+    TEST_ASSERT_EQ(last_id, rows[1].id, "Last row should be the last operation");
+
+    operation_queue_cancel_all(&queue);
+    TEST_ASSERT_EQ(0, operation_queue_pending_count(&queue), "Cancel all should leave nothing pending");
+    TEST_ASSERT_EQ(QUEUE_MAX_FINISHED, operation_queue_total_count(&queue), "Only the newest finished operations should stay listed");
+    TEST_ASSERT(operation_queue_get(&queue, last_id) != NULL, "Newest operation should stay listed");
+
+    operation_queue_free(&queue);
+}
+
+// Test that history beyond QUEUE_MAX_HISTORY pages in from the history file
+static void test_queue_history_file(void)
+{
+    printf("  Testing history file...\n");
+
+    OperationQueue queue;
+    operation_queue_init(&queue);
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/history.bin", TEST_DIR);
+    TEST_ASSERT(operation_queue_set_history_file(&queue, path), "Should open history file");
+
+    int count = QUEUE_MAX_HISTORY + 36;
+    int first_id = -1, last_id = -1;
+    for (int i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), "%s/missing_%d.txt", TEST_DIR, i);
+        last_id = operation_queue_delete(&queue, path);
+        if (first_id < 0) first_id = last_id;
+    }
+
+    operation_queue_start(&queue);
+    int wait_count = 0;
+    while (wait_count < 50 && operation_queue_history_count(&queue) < count) {
+        usleep(100000);
+        wait_count++;
+    }
+
+    TEST_ASSERT_EQ(count, operation_queue_history_count(&queue), "Every finished operation should be in the history");
+
+    QueueRow rows[8];
+    int row_count = operation_queue_history_page(&queue, 0, rows, 8);
+    TEST_ASSERT_EQ(8, row_count, "Oldest page should be full");
+    TEST_ASSERT_EQ(first_id, rows[0].id, "Oldest record should come from the history file");
+    TEST_ASSERT_EQ(OP_STATUS_FAILED, rows[0].status, "Record should keep its status");
+    TEST_ASSERT(strstr(rows[0].source_path, "missing_0.txt") != NULL, "Record should keep its path");
+
+    row_count = operation_queue_history_page(&queue, count - 4, rows, 8);
+    TEST_ASSERT_EQ(4, row_count, "Newest page should stop at the end");
+    TEST_ASSERT_EQ(last_id, rows[3].id, "Newest record should be the last operation");
+
+    operation_queue_stop(&queue);
+    operation_queue_free(&queue);
+}
+
+// Test that queued deletes on one device are trashed as a batch
+static void test_queue_delete_batch(void)
+{
+    printf("  Testing batched deletes...\n");
+
+    OperationQueue queue;
+    operation_queue_init(&queue);
+
+    char path[512];
+    int count = QUEUE_DELETE_BATCH + 44;
+    int ids[QUEUE_DELETE_BATCH + 44];
+    for (int i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), "%s/trash_%d.txt", TEST_DIR, i);
+        if (i != 10) {  // One path is missing
+            FILE *f = fopen(path, "w");
+            if (f) fclose(f);
+        }
+        ids[i] = operation_queue_delete(&queue, path);
+    }
+
+    operation_queue_start(&queue);
+    int wait_count = 0;
+    while (wait_count < 50 && operation_queue_pending_count(&queue) + (operation_queue_is_processing(&queue) ? 1 : 0) > 0) {
+        usleep(100000);
+        wait_count++;
+    }
+
+    int completed = 0;
+    for (int i = 0; i < count; i++) {
+        QueuedOperation *op = operation_queue_get(&queue, ids[i]);
+        if (op && op->status == OP_STATUS_COMPLETED) completed++;
+    }
+    TEST_ASSERT_EQ(count - 1, completed, "Every existing file should be deleted");
+
+    QueuedOperation *missing = operation_queue_get(&queue, ids[10]);
+    TEST_ASSERT(missing != NULL && missing->status == OP_STATUS_FAILED, "Missing file should fail on its own");
+    TEST_ASSERT(missing != NULL && strstr(missing->error_message, "trash_10.txt") != NULL, "Failure should name the missing file");
+
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/trash_%d.txt", TEST_DIR, count - 1);
+    TEST_ASSERT(stat(path, &st) != 0, "Last file should be gone");
+
+    operation_queue_stop(&queue);
+    operation_queue_free(&queue);
+}
+
+// Test pasting a clipboard larger than any fixed array
+static void test_queue_paste(void)
+{
+    printf("  Testing clipboard paste into the queue...\n");
+
+    OperationQueue queue;
+    operation_queue_init(&queue);
+
+    ClipboardState clipboard;
+    clipboard_init(&clipboard);
+    clipboard_begin(&clipboard, OP_COPY);
+    char path[512];
+    for (int i = 0; i < 300; i++) {
+        snprintf(path, sizeof(path), "%s/paste_%d.txt", TEST_DIR, i);
+        clipboard_add(&clipboard, path);
+    }
+
+    // Without the job scheduler running, the items are added before this returns
+    int handed = operation_queue_paste(&queue, &clipboard, TEST_DIR);
+    TEST_ASSERT_EQ(300, handed, "Every clipboard item should be handed over");
+    TEST_ASSERT_EQ(300, queue.count, "Every item should become an operation");
+    QueuedOperation *last = operation_queue_get(&queue, queue.next_id - 1);
+    TEST_ASSERT(last != NULL && last->type == QUEUE_OP_COPY, "Copied items should queue copies");
+    TEST_ASSERT(last != NULL && strstr(last->source_path, "paste_299.txt") != NULL, "Items should keep their order");
+    TEST_ASSERT_EQ(300, clipboard.count, "A copy should stay on the clipboard");
+
+    clipboard.operation = OP_CUT;
+    operation_queue_paste(&queue, &clipboard, TEST_DIR);
+    last = operation_queue_get(&queue, queue.next_id - 1);
+    TEST_ASSERT(last != NULL && last->type == QUEUE_OP_MOVE, "Cut items should queue moves");
+    TEST_ASSERT_EQ(0, clipboard.count, "A cut should empty the clipboard");
+
+    clipboard_free(&clipboard);
+    operation_queue_free(&queue);
+}
+
+// Test a journaled move batch: run through the queue, resumed after a cancel, undone
+// from the undo log
+static void test_queue_move_batch(void)
+{
+    printf("  Testing move batch operation...\n");
+
+    char path[512], dest[512], journal[512];
+    snprintf(path, sizeof(path), "%s/undo.log", TEST_DIR);
+    UndoLog *undo = undo_log_open(path);
+    undo_log_set_shared(undo);
+    snprintf(path, sizeof(path), "%s/batch", TEST_DIR);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/sorted_b", TEST_DIR);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/sorted_b/item_1.txt", TEST_DIR);
+    FILE *taken = fopen(path, "w");
+    if (taken) fclose(taken);
+    snprintf(journal, sizeof(journal), "%s/moves.journal", TEST_DIR);
+
+    // Half into a folder two levels down, half into an existing one that has item_1.txt
+    MoveBatch *batch = move_batch_create();
+    move_batch_set_keep_both(batch, true);
+    for (int i = 0; i < 200; i++) {
+        snprintf(path, sizeof(path), "%s/batch/item_%d.txt", TEST_DIR, i);
+        FILE *file = fopen(path, "w");
+        if (file) fclose(file);
+        snprintf(dest, sizeof(dest), "%s/%s/item_%d.txt", TEST_DIR,
+                 i % 2 == 0 ? "sorted_a/deep" : "sorted_b", i);
+        move_batch_add(batch, path, dest);
+    }
+    TEST_ASSERT_EQ(200, move_batch_count(batch), "Every move should be planned");
+    move_batch_set_undo_group(batch, undo_log_begin(undo, UNDO_SOURCE_ORGANIZE, "Reorganize"));
+    TEST_ASSERT(move_batch_save(batch, journal), "The plan should be saved");
+    TEST_ASSERT_EQ(200, move_batch_journal_count(journal), "The header should count the moves");
+
+    // Cancelled before the first move: nothing moves, a second run does it all
+    CopyControl control;
+    copy_control_init(&control);
+    atomic_store(&control.cancel, true);
+    MoveBatchResult result;
+    TEST_ASSERT_EQ(OP_ERROR_CANCELLED, move_batch_run(batch, journal, &control, &result), "A cancelled run should say so");
+    TEST_ASSERT_EQ(0, result.moved, "A cancelled run should move nothing");
+    move_batch_free(batch);
+
+    OperationQueue queue;
+    operation_queue_init(&queue);
+    int id = operation_queue_move_batch(&queue, journal, TEST_DIR);
+    QueuedOperation *op = operation_queue_get(&queue, id);
+    TEST_ASSERT(op != NULL && op->total_bytes == 200, "A batch's progress should count moves");
+    operation_queue_start(&queue);
+    for (int wait = 0; wait < 50; wait++) {
+        op = operation_queue_get(&queue, id);
+        if (op && (op->status == OP_STATUS_COMPLETED || op->status == OP_STATUS_FAILED)) break;
+        usleep(100000);
+    }
+    op = operation_queue_get(&queue, id);
+    TEST_ASSERT(op != NULL && op->status == OP_STATUS_COMPLETED, "The batch should complete");
+    operation_queue_stop(&queue);
+    operation_queue_free(&queue);
+
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/sorted_a/deep/item_198.txt", TEST_DIR);
+    TEST_ASSERT(stat(path, &st) == 0, "Missing folders should be created for the moves");
+    snprintf(path, sizeof(path), "%s/sorted_b/item_1 (1).txt", TEST_DIR);
+    TEST_ASSERT(stat(path, &st) == 0, "A taken name should get a unique one");
+    snprintf(path, sizeof(path), "%s/batch/item_0.txt", TEST_DIR);
+    TEST_ASSERT(stat(path, &st) != 0, "Sources should be gone");
+
+    batch = move_batch_load(journal);
+    TEST_ASSERT(batch != NULL && move_batch_done(batch, 1, dest, sizeof(dest)) &&
+                strstr(dest, "item_1 (1).txt") != NULL, "The journal should record where each file went");
+    move_batch_free(batch);
+
+    UndoGroupInfo info;
+    TEST_ASSERT(undo_log_last(undo, UNDO_SOURCE_ORGANIZE, &info) && info.complete && info.actions == 202,
+                "The undo log should hold every move and both created folders");
+    UndoResult undone;
+    TEST_ASSERT(undo_log_undo(undo, info.group, &undone), "Undo should succeed");
+    TEST_ASSERT_EQ(202, undone.undone, "Undo should move every file back");
+    TEST_ASSERT(stat(path, &st) == 0, "Files should be back where they were");
+    snprintf(path, sizeof(path), "%s/sorted_b/item_1.txt", TEST_DIR);
+    TEST_ASSERT(stat(path, &st) == 0, "Files that were not moved should stay");
+    snprintf(path, sizeof(path), "%s/sorted_a", TEST_DIR);
+    TEST_ASSERT(stat(path, &st) != 0, "Folders the batch created should be removed");
+
+    undo_log_close(undo);
+}
+
 // Main test function
+// Test deleting trees for good, in place and moved aside first
+static void test_queue_remove(void)
+{
+    printf("  Testing permanent removal...\n");
+
+    // Two trees of 20 folders, 3 levels deep, 25 files each, and a link out of each
+    char path[512];
+    char keep_path[512];
+    snprintf(keep_path, sizeof(keep_path), "%s/keep.txt", TEST_DIR);
+    FILE *keep = fopen(keep_path, "w");
+    if (keep) fclose(keep);
+    for (int tree = 0; tree < 2; tree++) {
+        for (int d = 0; d < 20; d++) {
+            snprintf(path, sizeof(path), "%s/tree%d/d%d/a/b", TEST_DIR, tree, d);
+            char cmd[600];
+            snprintf(cmd, sizeof(cmd), "mkdir -p %s", path);
+            system(cmd);
+            for (int f = 0; f < 25; f++) {
+                snprintf(path, sizeof(path), "%s/tree%d/d%d/%s/f%d.txt", TEST_DIR, tree, d,
+                         f % 3 == 0 ? "a/b" : f % 3 == 1 ? "a" : ".", f);
+                FILE *file = fopen(path, "w");
+                if (file) {
+                    fputs("remove me", file);
+                    fclose(file);
+                }
+            }
+        }
+        snprintf(path, sizeof(path), "%s/tree%d/d0/link", TEST_DIR, tree);
+        symlink(keep_path, path);
+    }
+
+    OperationQueue queue;
+    operation_queue_init(&queue);
+
+    char tree0[512], tree1[512];
+    snprintf(tree0, sizeof(tree0), "%s/tree0", TEST_DIR);
+    snprintf(tree1, sizeof(tree1), "%s/tree1", TEST_DIR);
+    int in_place = operation_queue_remove(&queue, tree0, false);
+    int aside = operation_queue_remove(&queue, tree1, true);
+
+    struct stat st;
+    TEST_ASSERT(stat(tree1, &st) != 0, "Tree moved aside should leave its folder at once");
+    QueuedOperation *op = operation_queue_get(&queue, aside);
+    TEST_ASSERT(op != NULL && strstr(op->target_path, OPERATIONS_TOMBSTONE_PREFIX) != NULL,
+                "Removal should work on the tombstone");
+    TEST_ASSERT(op != NULL && op->total_bytes == 20 * 25 * 9, "Tombstone should be sized");
+
+    operation_queue_start(&queue);
+    int wait_count = 0;
+    while (wait_count < 50 && operation_queue_pending_count(&queue) + (operation_queue_is_processing(&queue) ? 1 : 0) > 0) {
+        usleep(100000);
+        wait_count++;
+    }
+
+    op = operation_queue_get(&queue, in_place);
+    TEST_ASSERT(op != NULL && op->status == OP_STATUS_COMPLETED, "Removal in place should complete");
+    TEST_ASSERT(lstat(tree0, &st) != 0, "Tree should be gone");
+    op = operation_queue_get(&queue, aside);
+    TEST_ASSERT(op != NULL && op->status == OP_STATUS_COMPLETED, "Removal moved aside should complete");
+    TEST_ASSERT(op != NULL && lstat(op->target_path, &st) != 0, "Tombstone should be gone");
+    TEST_ASSERT(stat(keep_path, &st) == 0, "Link target should be left alone");
+
+    operation_queue_stop(&queue);
+    operation_queue_free(&queue);
+
+    // A cancelled removal stops early and leaves the rest
+    snprintf(path, sizeof(path), "%s/tree2/d/e", TEST_DIR);
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "mkdir -p %s", path);
+    system(cmd);
+    CopyControl control;
+    copy_control_init(&control);
+    atomic_store(&control.cancel, true);
+    snprintf(path, sizeof(path), "%s/tree2", TEST_DIR);
+    TEST_ASSERT_EQ(OP_ERROR_CANCELLED, file_remove(path, &control), "Cancelled removal should report it");
+    TEST_ASSERT(stat(path, &st) == 0, "Cancelled removal should leave the tree");
+    TEST_ASSERT_EQ(OP_SUCCESS, file_remove(path, NULL), "Removal without a control should complete");
+    TEST_ASSERT_EQ(OP_ERROR_NOT_FOUND, file_remove(path, NULL), "Removing a missing path should fail");
+
+    // A removal cancelled before it starts puts the item back, as does one never run
+    char tree3[512], file3[600];
+    snprintf(tree3, sizeof(tree3), "%s/tree3", TEST_DIR);
+    snprintf(file3, sizeof(file3), "%s/f.txt", tree3);
+    mkdir(tree3, 0755);
+    FILE *f3 = fopen(file3, "w");
+    if (f3) fclose(f3);
+    operation_queue_init(&queue);
+    int cancelled = operation_queue_remove(&queue, tree3, true);
+    TEST_ASSERT(cancelled > 0 && stat(tree3, &st) != 0, "Removal moved aside should hide the item");
+    TEST_ASSERT(operation_queue_cancel(&queue, cancelled), "A pending removal should cancel");
+    TEST_ASSERT(stat(file3, &st) == 0, "A cancelled removal should put the item back");
+    op = operation_queue_get(&queue, cancelled);
+    TEST_ASSERT(op != NULL && op->target_path[0] == '\0', "Its retry should remove the item in place");
+    operation_queue_remove(&queue, tree3, true);
+    operation_queue_free(&queue);
+    TEST_ASSERT(stat(file3, &st) == 0, "A removal that never ran should put the item back");
+
+    // Tombstones a run that died left are put back by the next
+    char logs[512], log_path[600], tombstone[600];
+    snprintf(logs, sizeof(logs), "%s/logs", TEST_DIR);
+    mkdir(logs, 0755);
+    pid_t child = fork();
+    if (child == 0) {
+        _exit(0);
+    }
+    waitpid(child, NULL, 0);
+    snprintf(log_path, sizeof(log_path), "%s/" QUEUE_TOMBSTONE_LOG "%d.log", logs, (int)child);
+    FILE *log = fopen(log_path, "wb");
+    bool moved = file_remove_tombstone(tree3, tombstone, sizeof(tombstone));
+    if (log) {
+        fwrite(tombstone, 1, strlen(tombstone) + 1, log);
+        fwrite(tree3, 1, strlen(tree3) + 1, log);
+        fclose(log);
+    }
+    TEST_ASSERT(moved && stat(tree3, &st) != 0, "The item should be aside");
+    operation_queue_init(&queue);
+    TEST_ASSERT_EQ(1, operation_queue_set_tombstone_dir(&queue, logs), "A dead run's tombstone should be put back");
+    TEST_ASSERT(stat(file3, &st) == 0 && stat(log_path, &st) != 0, "The item should be back and the log gone");
+    operation_queue_free(&queue);
+    snprintf(log_path, sizeof(log_path), "%s/" QUEUE_TOMBSTONE_LOG "%d.log", logs, (int)getpid());
+    TEST_ASSERT(stat(log_path, &st) != 0, "A run with nothing aside should drop its log");
+}
+
 void test_operation_queue(void)
 {
     printf("\n  Setting up operation queue test directory...\n");
@@ -505,6 +960,7 @@ void test_operation_queue(void)
     test_queue_counts();
     test_queue_clear_finished();
     test_queue_overall_progress();
+    test_queue_status();
     test_queue_worker();
     test_queue_retry();
 
@@ -519,6 +975,13 @@ void test_operation_queue(void)
     setup_test_directory();
 
     test_queue_create_dir_operation();
+    test_queue_device_order();
+    test_queue_many_operations();
+    test_queue_history_file();
+    test_queue_delete_batch();
+    test_queue_paste();
+    test_queue_move_batch();
+    test_queue_remove();
 
     printf("  Cleaning up operation queue test directory...\n");
     teardown_test_directory();
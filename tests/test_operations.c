@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 
 #include "core/operations.h"
@@ -94,6 +95,8 @@ void test_operations(void)
         TEST_ASSERT(clipboard.operation == OP_COPY, "Operation should be OP_COPY");
         TEST_ASSERT(clipboard_has_items(&clipboard), "has_items should be true");
         TEST_ASSERT(clipboard_contains(&clipboard, path1), "Should contain copied path");
+
+        clipboard_free(&clipboard);
     }
 
     // Test clipboard cut
@@ -109,6 +112,8 @@ void test_operations(void)
 
         TEST_ASSERT(clipboard.count == 1, "Clipboard should have 1 item");
         TEST_ASSERT(clipboard.operation == OP_CUT, "Operation should be OP_CUT");
+
+        clipboard_free(&clipboard);
     }
 
     // Test clipboard clear
@@ -125,6 +130,39 @@ void test_operations(void)
 
         TEST_ASSERT(clipboard.count == 0, "Clipboard should be empty after clear");
         TEST_ASSERT(!clipboard_has_items(&clipboard), "has_items should be false after clear");
+        TEST_ASSERT(!clipboard_contains(&clipboard, path1), "Cleared clipboard should contain nothing");
+
+        clipboard_free(&clipboard);
+    }
+
+    // Test clipboard with many items: no cap, hashed membership, duplicates skipped
+    {
+        ClipboardState clipboard;
+        clipboard_init(&clipboard);
+
+        clipboard_begin(&clipboard, OP_COPY);
+        bool all_added = true;
+        for (int i = 0; i < 5000; i++) {
+            char path[64];
+            snprintf(path, sizeof(path), "/tmp/many/file_%d.txt", i);
+            all_added &= clipboard_add(&clipboard, path);
+        }
+        all_added &= clipboard_add(&clipboard, "/tmp/many/file_42.txt");
+        TEST_ASSERT(all_added, "Every add should succeed");
+        TEST_ASSERT(clipboard.count == 5000, "Duplicates should be skipped");
+
+        bool found = true;
+        for (int i = 0; i < 5000; i += 7) {
+            char path[64];
+            snprintf(path, sizeof(path), "/tmp/many/file_%d.txt", i);
+            found &= clipboard_contains(&clipboard, path);
+        }
+        TEST_ASSERT(found, "Should contain every added path");
+        TEST_ASSERT(!clipboard_contains(&clipboard, "/tmp/many/file_5000.txt"), "Should not contain others");
+        TEST_ASSERT(strcmp(clipboard_path(&clipboard, 4999), "/tmp/many/file_4999.txt") == 0,
+                    "Items should keep their order");
+
+        clipboard_free(&clipboard);
     }
 
     // Test file_copy
@@ -280,6 +318,267 @@ void test_operations(void)
         TEST_ASSERT(result == OP_ERROR_INVALID, "Should return INVALID for name with slash");
     }
 
+    // Test file_copy_to: progress, cancel, and resume skipping completed files
+    {
+        char source[512], dest[512], big[512], small[512], link[512];
+        snprintf(source, sizeof(source), "%s/copy_src", test_dir);
+        snprintf(dest, sizeof(dest), "%s/copy_dest", test_dir);
+        snprintf(big, sizeof(big), "%s/big.bin", source);
+        snprintf(small, sizeof(small), "%s/small.txt", source);
+        snprintf(link, sizeof(link), "%s/link", source);
+        mkdir(source, 0755);
+
+        // Several chunks' worth, not a multiple of the chunk size
+        size_t big_size = 3 * 1024 * 1024 + 123;
+        char *data = malloc(big_size);
+        for (size_t i = 0; i < big_size; i++) data[i] = (char)(i * 7);
+        FILE *f = fopen(big, "wb");
+        fwrite(data, 1, big_size, f);
+        fclose(f);
+        f = fopen(small, "w");
+        fputs("small file", f);
+        fclose(f);
+        symlink("small.txt", link);
+        long long total = (long long)big_size + (long long)strlen("small file");
+
+        CopyControl control;
+        copy_control_init(&control);
+        atomic_store(&control.cancel, true);
+        OperationResult result = file_copy_to(source, dest, &control);
+        TEST_ASSERT(result == OP_ERROR_CANCELLED, "Cancelled copy should report OP_ERROR_CANCELLED");
+
+        copy_control_init(&control);
+        result = file_copy_to(source, dest, &control);
+        TEST_ASSERT(result == OP_SUCCESS, "file_copy_to should succeed");
+        TEST_ASSERT(atomic_load(&control.bytes_done) == total, "Progress should count every byte");
+
+        char dest_big[512], dest_small[512], dest_link[512];
+        snprintf(dest_big, sizeof(dest_big), "%s/big.bin", dest);
+        snprintf(dest_small, sizeof(dest_small), "%s/small.txt", dest);
+        snprintf(dest_link, sizeof(dest_link), "%s/link", dest);
+
+        struct stat st;
+        TEST_ASSERT(stat(dest_big, &st) == 0 && st.st_size == (off_t)big_size, "Large file should be copied whole");
+        TEST_ASSERT(lstat(dest_link, &st) == 0 && S_ISLNK(st.st_mode), "Symlink should be copied as a link");
+
+        // Break the large copy, and mark the small one so a skip is visible
+        truncate(dest_big, 1000);
+        struct stat small_st;
+        stat(small, &small_st);
+        f = fopen(dest_small, "w");
+        fputs("SMALL FILE", f);
+        fclose(f);
+        struct timespec times[2] = { small_st.st_atimespec, small_st.st_mtimespec };
+        utimensat(AT_FDCWD, dest_small, times, 0);
+
+        copy_control_init(&control);
+        result = file_copy_to(source, dest, &control);
+        TEST_ASSERT(result == OP_SUCCESS, "Resumed copy should succeed");
+        TEST_ASSERT(atomic_load(&control.bytes_done) == total, "Skipped files should count as progress");
+
+        char *copied = malloc(big_size);
+        f = fopen(dest_big, "rb");
+        size_t got = fread(copied, 1, big_size, f);
+        fclose(f);
+        TEST_ASSERT(got == big_size && memcmp(copied, data, big_size) == 0, "Incomplete file should be copied again");
+
+        char small_buffer[32] = {0};
+        f = fopen(dest_small, "r");
+        fgets(small_buffer, sizeof(small_buffer), f);
+        fclose(f);
+        TEST_ASSERT_STR_EQ("SMALL FILE", small_buffer, "Complete file should be skipped");
+
+        free(copied);
+        free(data);
+    }
+
+    // Test file_copy_to with many small files across nested directories
+    {
+        char source[512], dest[512], path[600];
+        snprintf(source, sizeof(source), "%s/tree_src", test_dir);
+        snprintf(dest, sizeof(dest), "%s/tree_dest", test_dir);
+        mkdir(source, 0755);
+
+        long long total = 0;
+        for (int d = 0; d < 8; d++) {
+            snprintf(path, sizeof(path), "%s/dir%d", source, d);
+            mkdir(path, 0755);
+            for (int i = 0; i < 50; i++) {
+                snprintf(path, sizeof(path), "%s/dir%d/file%d.txt", source, d, i);
+                FILE *f = fopen(path, "w");
+                total += fprintf(f, "dir %d file %d", d, i);
+                fclose(f);
+            }
+        }
+        snprintf(path, sizeof(path), "%s/dir0", source);
+        chmod(path, 0555);
+
+        CopyControl control;
+        copy_control_init(&control);
+        OperationResult result = file_copy_to(source, dest, &control);
+        TEST_ASSERT(result == OP_SUCCESS, "Tree copy should succeed");
+        TEST_ASSERT(atomic_load(&control.bytes_done) == total, "Tree copy progress should add up across workers");
+
+        int matched = 0;
+        for (int d = 0; d < 8; d++) {
+            for (int i = 0; i < 50; i++) {
+                char expected[64], actual[64] = {0};
+                snprintf(expected, sizeof(expected), "dir %d file %d", d, i);
+                snprintf(path, sizeof(path), "%s/dir%d/file%d.txt", dest, d, i);
+                FILE *f = fopen(path, "r");
+                if (f) {
+                    fgets(actual, sizeof(actual), f);
+                    fclose(f);
+                }
+                if (strcmp(expected, actual) == 0) matched++;
+            }
+        }
+        TEST_ASSERT(matched == 400, "Every file in the tree should be copied");
+
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/dir0", dest);
+        TEST_ASSERT(stat(path, &st) == 0 && (st.st_mode & 0777) == 0555, "Directory mode should be applied after its files");
+
+        // Let teardown remove the read-only directories
+        chmod(path, 0755);
+        snprintf(path, sizeof(path), "%s/dir0", source);
+        chmod(path, 0755);
+    }
+
+    // Test file_copy_to keeps holes in sparse files
+    {
+        char source[512], dest[512];
+        snprintf(source, sizeof(source), "%s/sparse.img", test_dir);
+        snprintf(dest, sizeof(dest), "%s/sparse_copy.img", test_dir);
+
+        off_t size = 64 * 1024 * 1024;
+        int fd = open(source, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ftruncate(fd, size);
+        pwrite(fd, "data", 4, size / 2);
+        close(fd);
+
+        CopyControl control;
+        copy_control_init(&control);
+        OperationResult result = file_copy_to(source, dest, &control);
+        TEST_ASSERT(result == OP_SUCCESS, "Sparse copy should succeed");
+        TEST_ASSERT(atomic_load(&control.bytes_done) == (long long)size, "Holes should count as progress");
+
+        struct stat st;
+        char buffer[4] = {0};
+        fd = open(dest, O_RDONLY);
+        pread(fd, buffer, 4, size / 2);
+        fstat(fd, &st);
+        close(fd);
+        TEST_ASSERT(st.st_size == size && memcmp(buffer, "data", 4) == 0, "Sparse copy should match its source");
+        TEST_ASSERT((off_t)st.st_blocks * 512 < size / 4, "Sparse copy should stay sparse");
+    }
+
+    // Test file_sync_to: only missing and changed files move, in the chosen directions
+    {
+        char left[512], right[512], path[600];
+        snprintf(left, sizeof(left), "%s/sync_left", test_dir);
+        snprintf(right, sizeof(right), "%s/sync_right", test_dir);
+        mkdir(left, 0755);
+        mkdir(right, 0755);
+        snprintf(path, sizeof(path), "%s/nested", left);
+        mkdir(path, 0755);
+
+        const char *files[][3] = {
+            // name, left content, right content (NULL if absent)
+            { "same.txt", "same", "same" },
+            { "changed.txt", "new text", "old" },
+            { "left_only.txt", "left", NULL },
+            { "nested/deep.txt", "deep", NULL },
+        };
+        for (int i = 0; i < 4; i++) {
+            snprintf(path, sizeof(path), "%s/%s", left, files[i][0]);
+            FILE *f = fopen(path, "w");
+            fputs(files[i][1], f);
+            fclose(f);
+            if (files[i][2] != NULL) {
+                snprintf(path, sizeof(path), "%s/%s", right, files[i][0]);
+                f = fopen(path, "w");
+                fputs(files[i][2], f);
+                fclose(f);
+            }
+        }
+        snprintf(path, sizeof(path), "%s/right_only.txt", right);
+        FILE *f = fopen(path, "w");
+        fputs("right", f);
+        fclose(f);
+
+        // The left copies are newer, except for the file both have unchanged
+        struct timespec older[2] = { { .tv_sec = 1600000000 }, { .tv_sec = 1600000000 } };
+        struct timespec newer[2] = { { .tv_sec = 1700000000 }, { .tv_sec = 1700000000 } };
+        snprintf(path, sizeof(path), "%s/changed.txt", right);
+        utimensat(AT_FDCWD, path, older, 0);
+        snprintf(path, sizeof(path), "%s/changed.txt", left);
+        utimensat(AT_FDCWD, path, newer, 0);
+        snprintf(path, sizeof(path), "%s/same.txt", left);
+        utimensat(AT_FDCWD, path, newer, 0);
+        snprintf(path, sizeof(path), "%s/same.txt", right);
+        utimensat(AT_FDCWD, path, newer, 0);
+
+        CopyControl control;
+        copy_control_init(&control);
+        OperationResult result = file_sync_to(left, right, SYNC_UPDATE, false, &control);
+        TEST_ASSERT(result == OP_SUCCESS, "Update sync should succeed");
+
+        char buffer[32] = {0};
+        snprintf(path, sizeof(path), "%s/changed.txt", right);
+        f = fopen(path, "r");
+        if (f) { fgets(buffer, sizeof(buffer), f); fclose(f); }
+        TEST_ASSERT_STR_EQ("new text", buffer, "Newer file should replace the older one");
+        snprintf(path, sizeof(path), "%s/nested/deep.txt", right);
+        TEST_ASSERT(access(path, F_OK) == 0, "Missing folders should be copied");
+        snprintf(path, sizeof(path), "%s/right_only.txt", left);
+        TEST_ASSERT(access(path, F_OK) != 0, "Update should not copy back");
+        snprintf(path, sizeof(path), "%s/right_only.txt", right);
+        TEST_ASSERT(access(path, F_OK) == 0, "Update should delete nothing");
+
+        // An older source never overwrites a newer destination
+        snprintf(path, sizeof(path), "%s/changed.txt", left);
+        f = fopen(path, "w");
+        fputs("stale", f);
+        fclose(f);
+        utimensat(AT_FDCWD, path, older, 0);
+        result = file_sync_to(left, right, SYNC_UPDATE, false, &control);
+        memset(buffer, 0, sizeof(buffer));
+        snprintf(path, sizeof(path), "%s/changed.txt", right);
+        f = fopen(path, "r");
+        if (f) { fgets(buffer, sizeof(buffer), f); fclose(f); }
+        TEST_ASSERT_STR_EQ("new text", buffer, "Update should keep the newer destination");
+
+        // Two-way copies what each side lacks and lets the newer file win
+        result = file_sync_to(left, right, SYNC_TWO_WAY, false, &control);
+        TEST_ASSERT(result == OP_SUCCESS, "Two-way sync should succeed");
+        snprintf(path, sizeof(path), "%s/right_only.txt", left);
+        TEST_ASSERT(access(path, F_OK) == 0, "Two-way sync should copy back");
+        memset(buffer, 0, sizeof(buffer));
+        snprintf(path, sizeof(path), "%s/changed.txt", left);
+        f = fopen(path, "r");
+        if (f) { fgets(buffer, sizeof(buffer), f); fclose(f); }
+        TEST_ASSERT_STR_EQ("new text", buffer, "Two-way sync should bring back the newer file");
+
+        // Same size and mtime only differ by content
+        snprintf(path, sizeof(path), "%s/same.txt", right);
+        f = fopen(path, "w");
+        fputs("SAME", f);
+        fclose(f);
+        utimensat(AT_FDCWD, path, newer, 0);
+        result = file_sync_to(left, right, SYNC_MIRROR, false, &control);
+        memset(buffer, 0, sizeof(buffer));
+        f = fopen(path, "r");
+        if (f) { fgets(buffer, sizeof(buffer), f); fclose(f); }
+        TEST_ASSERT_STR_EQ("SAME", buffer, "Metadata sync should skip files with matching size and mtime");
+        result = file_sync_to(left, right, SYNC_MIRROR, true, &control);
+        TEST_ASSERT(result == OP_SUCCESS, "Content sync should succeed");
+        memset(buffer, 0, sizeof(buffer));
+        f = fopen(path, "r");
+        if (f) { fgets(buffer, sizeof(buffer), f); fclose(f); }
+        TEST_ASSERT_STR_EQ("same", buffer, "Content sync should replace a same-size edit");
+    }
+
     printf("  Cleaning up test environment...\n");
     teardown_test_dir();
 }
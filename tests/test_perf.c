@@ -156,6 +156,124 @@ static void test_dir_cache_disabled(void)
     dir_cache_free(&cache);
 }
 
+static void test_dir_cache_lru_budget(void)
+{
+    DirCache cache;
+    dir_cache_init(&cache);
+
+    DirectoryState dir;
+    directory_state_init(&dir);
+    for (int i = 0; i < 100; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "file%d.txt", i);
+        directory_append_entry(&dir, name);
+    }
+
+    dir_cache_put(&cache, "/a", &dir);
+    size_t one = cache.bytes;
+    TEST_ASSERT(one > directory_state_bytes(&dir), "Entry bytes should cover the listing");
+
+    // Room for two listings: touching /a makes /b the eviction victim
+    dir_cache_set_budget(&cache, one * 2 + one / 2);
+    dir_cache_put(&cache, "/b", &dir);
+    TEST_ASSERT(dir_cache_get(&cache, "/a") != NULL, "Touch /a");
+    dir_cache_put(&cache, "/c", &dir);
+
+    TEST_ASSERT_EQ(2, cache.count, "Budget should hold two listings");
+    TEST_ASSERT(cache.bytes <= cache.max_bytes, "Cache should stay within budget");
+    TEST_ASSERT(dir_cache_get(&cache, "/a") != NULL, "Recently used entry should survive");
+    TEST_ASSERT(dir_cache_get(&cache, "/b") == NULL, "Least recently used entry should be evicted");
+    TEST_ASSERT(dir_cache_get(&cache, "/c") != NULL, "Newest entry should be cached");
+
+    // Replacing an entry does not duplicate it
+    dir_cache_put(&cache, "/c", &dir);
+    TEST_ASSERT_EQ(2, cache.count, "Re-put should replace the entry");
+
+    // Many paths spread across buckets
+    dir_cache_set_budget(&cache, DIR_CACHE_DEFAULT_BUDGET);
+    DirectoryState empty;
+    directory_state_init(&empty);
+    for (int i = 0; i < 1000; i++) {
+        char path[32];
+        snprintf(path, sizeof(path), "/many/%d", i);
+        dir_cache_put(&cache, path, &empty);
+    }
+    TEST_ASSERT(dir_cache_get(&cache, "/many/0") != NULL, "Early entry should be found");
+    TEST_ASSERT(dir_cache_get(&cache, "/many/999") != NULL, "Late entry should be found");
+    TEST_ASSERT(dir_cache_get(&cache, "/many/1000") == NULL, "Missing entry should not be found");
+
+    directory_state_free(&empty);
+    directory_state_free(&dir);
+    dir_cache_free(&cache);
+}
+
+static void test_dir_cache_notify(void)
+{
+    DirCache cache;
+    dir_cache_init(&cache);
+
+    DirectoryState dir;
+    directory_state_init(&dir);
+
+    dir_cache_put(&cache, "/", &dir);
+    dir_cache_put(&cache, "/docs", &dir);
+    dir_cache_put(&cache, "/docs/old", &dir);
+    dir_cache_put(&cache, "/docs/old/deep", &dir);
+    dir_cache_put(&cache, "/music", &dir);
+    dir_cache_put(&cache, "/music/live", &dir);
+
+    // Entries do not expire on their own
+    TEST_ASSERT(dir_cache_get(&cache, "/docs") != NULL, "Entry should stay valid without events");
+
+    // A file changing invalidates only its containing listing
+    dir_cache_notify(&cache, "/music/song.mp3");
+    TEST_ASSERT(dir_cache_get(&cache, "/music") == NULL, "Parent of changed file should be invalidated");
+    TEST_ASSERT(dir_cache_get(&cache, "/music/live") != NULL, "Sibling folder should stay cached");
+    TEST_ASSERT(dir_cache_get(&cache, "/") != NULL, "Grandparent should stay cached");
+
+    // A folder changing invalidates it, its subtree and its parent
+    dir_cache_notify(&cache, "/docs/old");
+    dir_cache_process_events(&cache);
+    TEST_ASSERT(dir_cache_get(&cache, "/docs") == NULL, "Parent of changed folder should be invalidated");
+    TEST_ASSERT(dir_cache_get(&cache, "/docs/old") == NULL, "Changed folder should be invalidated");
+    TEST_ASSERT(dir_cache_get(&cache, "/docs/old/deep") == NULL, "Subfolder should be invalidated");
+
+    // Top-level item maps to the root listing
+    dir_cache_notify(&cache, "/newfile");
+    TEST_ASSERT(dir_cache_get(&cache, "/") == NULL, "Root listing should be invalidated");
+    TEST_ASSERT(dir_cache_get(&cache, "/music/live") != NULL, "Unrelated folder should stay cached");
+
+    // Too many queued changes fall back to dropping everything
+    for (int i = 0; i <= DIR_CACHE_MAX_PENDING; i++) {
+        dir_cache_notify(&cache, "/elsewhere/file");
+    }
+    dir_cache_process_events(&cache);
+    TEST_ASSERT_EQ(0, cache.count, "Overflow should clear the cache");
+
+    directory_state_free(&dir);
+    dir_cache_free(&cache);
+}
+
+static void test_dir_cache_max_age(void)
+{
+    DirCache cache;
+    dir_cache_init(&cache);
+
+    DirectoryState dir;
+    directory_state_init(&dir);
+
+    dir_cache_set_max_age(&cache, 0.05);
+    dir_cache_put(&cache, "/remote", &dir);
+    TEST_ASSERT(dir_cache_get(&cache, "/remote") != NULL, "Fresh listing should be cached");
+
+    usleep(100000);
+    TEST_ASSERT(dir_cache_get(&cache, "/remote") == NULL, "Listing past its max age should expire");
+    TEST_ASSERT_EQ(0, cache.count, "Expired listing should be removed");
+
+    directory_state_free(&dir);
+    dir_cache_free(&cache);
+}
+
 //=============================================================================
 // Dirty Rectangle Tests
 //=============================================================================
@@ -305,7 +423,116 @@ static void test_lazy_priority(void)
     lazy_enqueue(&queue, LAZY_TASK_THUMBNAIL, "/test/medium.png", 5);
 
     // First task should be high priority
-    TEST_ASSERT(queue.tasks[0].priority == 10, "Highest priority should be first");
+    TEST_ASSERT(queue.tasks[queue.heap[0]].priority == 10, "Highest priority should be first");
+
+    lazy_free(&queue);
+}
+
+static void test_lazy_reprioritize(void)
+{
+    LazyLoadQueue queue;
+    lazy_init(&queue);
+
+    lazy_enqueue(&queue, LAZY_TASK_THUMBNAIL, "/test/a.png", 10);
+    lazy_enqueue(&queue, LAZY_TASK_THUMBNAIL, "/test/b.png", 5);
+    TEST_ASSERT(strcmp(queue.tasks[queue.heap[0]].path, "/test/a.png") == 0, "a should be first");
+
+    // Scrolled: b is now in view, a is not
+    lazy_enqueue(&queue, LAZY_TASK_THUMBNAIL, "/test/a.png", 1);
+    TEST_ASSERT(strcmp(queue.tasks[queue.heap[0]].path, "/test/b.png") == 0,
+                "Lowered priority should move a behind b");
+    TEST_ASSERT_EQ(2, queue.count, "Re-enqueue should not duplicate");
+
+    // Same path, different type is a separate task
+    lazy_enqueue(&queue, LAZY_TASK_FILE_INFO, "/test/a.png", 1);
+    TEST_ASSERT_EQ(3, queue.count, "Types should be tracked separately");
+
+    lazy_free(&queue);
+}
+
+static void test_lazy_full(void)
+{
+    LazyLoadQueue queue;
+    lazy_init(&queue);
+
+    char path[64];
+    for (int i = 0; i < LAZY_QUEUE_MAX; i++) {
+        snprintf(path, sizeof(path), "/test/%d.png", i);
+        lazy_enqueue(&queue, LAZY_TASK_THUMBNAIL, path, 5);
+    }
+    TEST_ASSERT_EQ(LAZY_QUEUE_MAX, queue.count, "Queue should be full");
+
+    // Less urgent work is turned away, more urgent work displaces it
+    TEST_ASSERT(lazy_enqueue(&queue, LAZY_TASK_THUMBNAIL, "/test/low.png", 1) < 0,
+                "Low priority task should be refused when full");
+    TEST_ASSERT(lazy_enqueue(&queue, LAZY_TASK_THUMBNAIL, "/test/high.png", 9) >= 0,
+                "High priority task should displace a pending one");
+    TEST_ASSERT_EQ(LAZY_QUEUE_MAX, queue.count, "Queue should stay full");
+
+    // Finished results make way before pending work
+    lazy_process_one(&queue);
+    TEST_ASSERT(lazy_is_complete(&queue, "/test/high.png", LAZY_TASK_THUMBNAIL), "Most urgent runs first");
+    TEST_ASSERT(lazy_enqueue(&queue, LAZY_TASK_THUMBNAIL, "/test/low.png", 1) >= 0,
+                "A finished result should be evicted for new work");
+    TEST_ASSERT(!lazy_is_complete(&queue, "/test/high.png", LAZY_TASK_THUMBNAIL), "Result was evicted");
+
+    lazy_free(&queue);
+}
+
+static int g_lazy_completed;
+
+static void *lazy_test_load(LazyTaskType type, const char *path, void *context)
+{
+    (void)type;
+    (void)context;
+    if (strstr(path, "missing")) return NULL;
+    usleep(1000);
+    return strdup(path);
+}
+
+static void *lazy_test_complete(LazyTaskType type, const char *path, void *result, void *context)
+{
+    (void)type;
+    (void)path;
+    (void)context;
+    g_lazy_completed++;
+    return result;
+}
+
+static void test_lazy_workers(void)
+{
+    LazyLoadQueue queue;
+    lazy_init(&queue);
+
+    LazyLoader loader = { .load = lazy_test_load, .complete = lazy_test_complete };
+    lazy_set_loader(&queue, LAZY_TASK_PREVIEW, &loader);
+    TEST_ASSERT(lazy_start_workers(&queue, 2) == 2, "Should start two workers");
+
+    g_lazy_completed = 0;
+    lazy_enqueue(&queue, LAZY_TASK_PREVIEW, "/test/a.txt", 5);
+    lazy_enqueue(&queue, LAZY_TASK_PREVIEW, "/test/missing.txt", 5);
+
+    // Results reach the main thread only through lazy_poll()
+    int delivered = 0;
+    for (int i = 0; i < 2000 && delivered < 1; i++) {
+        delivered += lazy_poll(&queue, 8);
+        usleep(1000);
+    }
+    TEST_ASSERT_EQ(1, g_lazy_completed, "Loaded result should be completed once");
+    const char *result = (const char *)lazy_get_result(&queue, "/test/a.txt", LAZY_TASK_PREVIEW);
+    TEST_ASSERT(result && strcmp(result, "/test/a.txt") == 0, "Result should come from the loader");
+    TEST_ASSERT(!lazy_is_complete(&queue, "/test/missing.txt", LAZY_TASK_PREVIEW),
+                "Failed load should not complete");
+
+    // A new generation discards work in flight
+    lazy_enqueue(&queue, LAZY_TASK_PREVIEW, "/test/b.txt", 5);
+    lazy_cancel_all(&queue);
+    TEST_ASSERT_EQ(0, queue.count, "Cancel all should empty the queue");
+    usleep(20000);  // Let the worker return
+    lazy_poll(&queue, 8);
+    TEST_ASSERT_EQ(1, g_lazy_completed, "Cancelled work should not be completed");
+    TEST_ASSERT(lazy_get_result(&queue, "/test/b.txt", LAZY_TASK_PREVIEW) == NULL,
+                "Cancelled task should have no result");
 
     lazy_free(&queue);
 }
@@ -317,35 +544,137 @@ static void test_lazy_priority(void)
 static void test_memory_profiling(void)
 {
     memory_profile_start();
+    MemoryStats base, stats;
+    memory_profile_snapshot(&base);
+    size_t other = base.tag_bytes[MEMORY_TAG_OTHER];
 
     memory_track_alloc(1024);
-    TEST_ASSERT(g_memory_stats.total_allocated == 1024, "Should track allocation");
-    TEST_ASSERT(g_memory_stats.allocation_count == 1, "Should count allocation");
+    memory_profile_snapshot(&stats);
+    TEST_ASSERT(stats.total_allocated == base.total_allocated + 1024, "Should track allocation");
+    TEST_ASSERT(stats.allocation_count == 1, "Should count allocation");
+    TEST_ASSERT(stats.tag_bytes[MEMORY_TAG_OTHER] == other + 1024, "Untagged allocation should be charged to other");
 
     memory_track_alloc(512);
-    TEST_ASSERT(g_memory_stats.total_allocated == 1536, "Should accumulate allocations");
-    TEST_ASSERT(g_memory_stats.peak_allocated == 1536, "Peak should update");
+    memory_profile_snapshot(&stats);
+    TEST_ASSERT(stats.total_allocated == base.total_allocated + 1536, "Should accumulate allocations");
+    TEST_ASSERT(stats.peak_allocated == base.total_allocated + 1536, "Peak should update");
 
     memory_track_free(1024);
-    TEST_ASSERT(g_memory_stats.total_allocated == 512, "Should track free");
-    TEST_ASSERT(g_memory_stats.free_count == 1, "Should count free");
-    TEST_ASSERT(g_memory_stats.peak_allocated == 1536, "Peak should not decrease");
+    memory_profile_snapshot(&stats);
+    TEST_ASSERT(stats.total_allocated == base.total_allocated + 512, "Should track free");
+    TEST_ASSERT(stats.free_count == 1, "Should count free");
+    TEST_ASSERT(stats.peak_allocated == base.total_allocated + 1536, "Peak should not decrease");
 
-    memory_profile_stop();
+    memory_track_free(512);
+}
+
+static void test_memory_tags(void)
+{
+    size_t before = memory_tag_bytes(MEMORY_TAG_NETWORK);
+    size_t preview = memory_tag_bytes(MEMORY_TAG_PREVIEW);
+    char *block = memory_alloc(MEMORY_TAG_NETWORK, 1000);
+    size_t charged = memory_tag_bytes(MEMORY_TAG_NETWORK) - before;
+    TEST_ASSERT(block && charged >= 1000, "Tagged block should be charged its usable size");
+
+    block = memory_realloc(MEMORY_TAG_NETWORK, block, 100000);
+    TEST_ASSERT(block && memory_tag_bytes(MEMORY_TAG_NETWORK) - before >= 100000, "Growing should charge the new size");
+    TEST_ASSERT(memory_tag_bytes(MEMORY_TAG_PREVIEW) == preview, "Other tags should be untouched");
+
+    char *copy = memory_strdup(MEMORY_TAG_NETWORK, "tagged");
+    TEST_ASSERT(copy && strcmp(copy, "tagged") == 0, "Tagged strdup should copy");
+    memory_free(MEMORY_TAG_NETWORK, copy);
+    memory_free(MEMORY_TAG_NETWORK, block);
+    TEST_ASSERT(memory_tag_bytes(MEMORY_TAG_NETWORK) == before, "Freeing should return the tag to where it was");
+
+    char line[256];
+    memory_get_stats_string(line, sizeof(line));
+    TEST_ASSERT(strstr(line, "Mem:") && strstr(line, "net"), "Stats line should list every tag");
 }
 
 static void test_memory_snapshot(void)
 {
     memory_profile_start();
+    MemoryStats base;
+    memory_profile_snapshot(&base);
     memory_track_alloc(2048);
 
     MemoryStats snapshot;
     memory_profile_snapshot(&snapshot);
 
-    TEST_ASSERT(snapshot.total_allocated == 2048, "Snapshot should capture current state");
+    TEST_ASSERT(snapshot.total_allocated == base.total_allocated + 2048, "Snapshot should capture current state");
 
     memory_track_free(2048);
-    memory_profile_stop();
+}
+
+//=============================================================================
+// Texture Budget Tests
+//=============================================================================
+
+static unsigned int g_evicted[8];
+static int g_evicted_count = 0;
+static unsigned int g_keep_id = 0;
+
+static bool test_evict_texture(void *owner, unsigned int id)
+{
+    (void)owner;
+    if (id == g_keep_id) return false;
+    g_evicted[g_evicted_count++] = id;
+    return true;
+}
+
+static void test_texture_budget_evict(void)
+{
+    texture_budget_set(3000);
+    g_evicted_count = 0;
+    g_keep_id = 0;
+
+    texture_budget_track(9001, 1000, 1, test_evict_texture, NULL);
+    texture_budget_track(9002, 1000, 1, test_evict_texture, NULL);
+    texture_budget_track(9003, 1000, 1, NULL, NULL);
+    TEST_ASSERT(texture_budget_used() == 3000, "Tracked textures should be accounted");
+    TEST_ASSERT_EQ(3, texture_budget_count(), "Three textures tracked");
+
+    // Let every texture fall out of the recent frames, then keep 9002 drawn
+    for (int i = 0; i < TEXTURE_BUDGET_RECENT_FRAMES; i++) {
+        texture_budget_trim();
+    }
+    texture_budget_touch(9002);
+    texture_budget_track(9004, 1000, 1, test_evict_texture, NULL);
+    texture_budget_trim();
+
+    TEST_ASSERT_EQ(1, g_evicted_count, "One texture should be evicted");
+    TEST_ASSERT_EQ(9001, g_evicted[0], "The least recently drawn one goes first");
+    TEST_ASSERT(texture_budget_used() == 3000, "Usage should be back within the budget");
+
+    // An owner that keeps its texture leaves the budget exceeded
+    texture_budget_set(1000);
+    g_keep_id = 9002;
+    for (int i = 0; i < TEXTURE_BUDGET_RECENT_FRAMES + 1; i++) {
+        texture_budget_trim();
+    }
+    TEST_ASSERT_EQ(2, g_evicted_count, "Kept and unevictable textures should stay");
+    TEST_ASSERT_EQ(9004, g_evicted[1], "The evictable one not kept should go");
+    TEST_ASSERT(texture_budget_used() == 2000, "Kept textures should stay accounted");
+
+    texture_budget_untrack(9002);
+    texture_budget_untrack(9003);
+    TEST_ASSERT_EQ(0, texture_budget_count(), "Untracked textures should be forgotten");
+    TEST_ASSERT(texture_budget_used() == 0, "Untracked bytes should be credited");
+    texture_budget_set(0);
+}
+
+static void test_texture_budget_fit_edge(void)
+{
+    texture_budget_set(0);
+    TEST_ASSERT_EQ(2048, texture_budget_fit_edge(2048), "Edge should be kept while the budget has room");
+
+    // A 4096 mipmapped square takes about 85 MB
+    texture_budget_set(64 * 1024 * 1024);
+    TEST_ASSERT_EQ(2048, texture_budget_fit_edge(4096), "Edge should be halved when it does not fit");
+
+    texture_budget_set(1024);
+    TEST_ASSERT_EQ(TEXTURE_BUDGET_MIN_EDGE, texture_budget_fit_edge(4096), "Edge should not shrink below the minimum");
+    texture_budget_set(0);
 }
 
 //=============================================================================
@@ -395,6 +724,126 @@ static void test_timing_percentile(void)
     TEST_ASSERT(p50 < p99, "P99 should be higher than P50");
 }
 
+static void test_timing_pacing(void)
+{
+    FrameTimings timings;
+    timing_init(&timings);
+    timing_set_target(&timings, 120.0);
+
+    TEST_ASSERT(timing_target_frame_time(&timings) < 0.0084, "Target should follow a 120 Hz display");
+
+    // 90 frames on time, 10 taking three refresh intervals
+    for (int i = 0; i < 100; i++) {
+        timing_record_frame(&timings, (i % 10 == 0) ? 0.025 : 0.008);
+    }
+    TEST_ASSERT_EQ(20, (int)timings.dropped_frames, "Each slow frame should drop two intervals");
+    TEST_ASSERT(!timing_hitting_target(&timings, 0), "Should miss the 120 Hz target");
+
+    double p50 = timing_get_session_percentile(&timings, 0.5f);
+    double p99 = timing_get_session_percentile(&timings, 0.99f);
+    TEST_ASSERT(p50 >= 0.008 && p50 <= 0.0085, "Session P50 should be the common frame time");
+    TEST_ASSERT(p99 >= 0.025 && p99 <= 0.0255, "Session P99 should be the slow frame time");
+
+    // The session histogram outlives the recent-frame ring
+    for (int i = 0; i < FRAME_HISTORY * 2; i++) {
+        timing_record_frame(&timings, 0.008);
+    }
+    TEST_ASSERT_EQ(100 + FRAME_HISTORY * 2, (int)timings.histogram_count, "Histogram should count every frame");
+
+    // Frames while paused are waits and are not recorded
+    int recorded = timings.frame_count;
+    timing_set_paused(&timings, true);
+    timing_record_frame(&timings, 0.5);
+    timing_set_paused(&timings, false);
+    TEST_ASSERT_EQ(recorded, timings.frame_count, "Paused frames should not be recorded");
+    TEST_ASSERT_EQ(20, (int)timings.dropped_frames, "Paused frames should not count as dropped");
+}
+
+static void test_timing_sections(void)
+{
+    FrameTimings timings;
+    timing_init(&timings);
+
+    timing_section_begin(&timings, FRAME_SECTION_LAYOUT);
+    usleep(2000);
+    timing_section_end(&timings, FRAME_SECTION_LAYOUT);
+    timing_section_end(&timings, FRAME_SECTION_DRAW);  // Never begun: ignored
+
+    TEST_ASSERT(timings.section_time[FRAME_SECTION_LAYOUT] >= 0.002, "Section time should be measured");
+    TEST_ASSERT(timings.section_time[FRAME_SECTION_DRAW] == 0, "Unbegun section should stay at zero");
+
+    timing_record_frame(&timings, 0.008);
+    TEST_ASSERT(timings.section_time[FRAME_SECTION_LAYOUT] == 0, "Recording a frame should reset section times");
+    TEST_ASSERT(timings.section_avg[FRAME_SECTION_LAYOUT] > 0, "Section average should include the frame");
+
+    char buffer[256];
+    timing_get_stats_string(&timings, buffer, sizeof(buffer));
+    TEST_ASSERT(strstr(buffer, "Dropped") != NULL, "Pacing stats should include dropped frames");
+}
+
+static void test_frame_work_budget(void)
+{
+    FrameTimings timings;
+    timing_init(&timings);
+    timing_set_target(&timings, 60.0);
+    double idle = timing_work_budget(&timings);
+    TEST_ASSERT(idle > FRAME_WORK_SHARE / 60.0 - 1e-9 && idle < FRAME_WORK_SHARE / 60.0 + 1e-9,
+                "An idle frame should allow its share of the target");
+
+    timings.section_avg[FRAME_SECTION_LAYOUT] = 0.010;
+    timings.section_avg[FRAME_SECTION_DRAW] = 0.004;
+    double budget = timing_work_budget(&timings);
+    TEST_ASSERT(budget < FRAME_WORK_SHARE / 60.0 && budget > 0.002,
+                "A busy frame should allow only the room it leaves");
+    timings.section_avg[FRAME_SECTION_DRAW] = 0.020;
+    TEST_ASSERT(timing_work_budget(&timings) == FRAME_WORK_MIN, "An overrun frame should still allow the minimum");
+
+    frame_work_begin(0.05);
+    TEST_ASSERT(frame_work_remaining() > 0.04, "A fresh allowance should be nearly whole");
+    frame_work_begin(0.002);
+    usleep(3000);
+    TEST_ASSERT(frame_work_remaining() == 0, "A spent allowance should have nothing left");
+}
+
+//=============================================================================
+// Startup Timing Tests
+//=============================================================================
+
+static void test_startup_timing(void)
+{
+    startup_begin();
+
+    double start = startup_phase_begin();
+    usleep(2000);
+    startup_phase_end("window", start, false);
+    start = startup_phase_begin();
+    startup_phase_end("vectordb", start, true);
+
+    char buffer[256];
+    startup_get_stats_string(buffer, sizeof(buffer));
+    TEST_ASSERT(strstr(buffer, "loading") != NULL, "Startup should be loading until marked ready");
+
+    startup_mark_first_frame();
+    startup_mark_ready();
+    startup_mark_first_frame();  // Only the first call counts
+
+    StartupTimings timings;
+    startup_get_timings(&timings);
+    TEST_ASSERT_EQ(2, timings.count, "Both phases should be recorded");
+    TEST_ASSERT(timings.phases[0].duration >= 0.002, "Phase duration should be measured");
+    TEST_ASSERT(timings.phases[1].background, "Background phase should be marked");
+    TEST_ASSERT(timings.first_frame > 0 && timings.ready >= timings.first_frame,
+                "First frame and ready should be timed from startup");
+
+    startup_get_stats_string(buffer, sizeof(buffer));
+    TEST_ASSERT(strstr(buffer, "ready") != NULL && strstr(buffer, "~vectordb") != NULL,
+                "Report should list the phases, background ones marked");
+
+    startup_begin();
+    startup_get_timings(&timings);
+    TEST_ASSERT_EQ(0, timings.count, "Restarting should drop the phases");
+}
+
 //=============================================================================
 // Performance Manager Tests
 //=============================================================================
@@ -443,6 +892,7 @@ static void test_perf_stats_string(void)
 
     TEST_ASSERT(strlen(buffer) > 0, "Stats string should not be empty");
     TEST_ASSERT(strstr(buffer, "FPS") != NULL, "Stats should include FPS");
+    TEST_ASSERT(strstr(buffer, "Tex") != NULL, "Stats should include texture memory");
 
     perf_free(&perf);
 }
@@ -475,6 +925,9 @@ void test_perf(void)
     test_dir_cache_invalidate();
     test_dir_cache_clear();
     test_dir_cache_disabled();
+    test_dir_cache_lru_budget();
+    test_dir_cache_notify();
+    test_dir_cache_max_age();
 
     printf("  [Dirty Rectangles]\n");
     test_dirty_init();
@@ -489,15 +942,29 @@ void test_perf(void)
     test_lazy_cancel();
     test_lazy_process();
     test_lazy_priority();
+    test_lazy_reprioritize();
+    test_lazy_full();
+    test_lazy_workers();
 
     printf("  [Memory Profiling]\n");
     test_memory_profiling();
+    test_memory_tags();
     test_memory_snapshot();
 
+    printf("  [Texture Budget]\n");
+    test_texture_budget_evict();
+    test_texture_budget_fit_edge();
+
     printf("  [Frame Timing]\n");
     test_timing_init();
     test_timing_record();
     test_timing_percentile();
+    test_timing_pacing();
+    test_timing_sections();
+    test_frame_work_budget();
+
+    printf("  [Startup Timing]\n");
+    test_startup_timing();
 
     printf("  [Performance Manager]\n");
     test_perf_manager_init();
@@ -119,9 +119,34 @@ static void test_clipboard_sync(void)
     TEST_ASSERT(clipboard.operation == OP_COPY, "Synced clipboard operation is COPY");
 
     if (clipboard.count >= 2) {
-        TEST_ASSERT(strcmp(clipboard.paths[0], "/tmp") == 0, "First synced path matches");
-        TEST_ASSERT(strcmp(clipboard.paths[1], "/var") == 0, "Second synced path matches");
+        TEST_ASSERT(strcmp(clipboard_path(&clipboard, 0), "/tmp") == 0, "First synced path matches");
+        TEST_ASSERT(strcmp(clipboard_path(&clipboard, 1), "/var") == 0, "Second synced path matches");
     }
+
+    // What we published ourselves is not imported back (a cut stays a cut)
+    clipboard_cut(&clipboard, paths, 1);
+    clipboard_sync_from_system(&clipboard);
+    TEST_ASSERT(clipboard.operation == OP_CUT, "Own clipboard survives sync");
+    TEST_ASSERT_EQ(1, clipboard.count, "Own clipboard keeps its items");
+
+    // A copy large enough to be promised rather than written reads back in full
+    enum { PROMISED = PLATFORM_CLIPBOARD_PROMISE_MIN * 2 };
+    static char promised[PROMISED][32];
+    const char *promised_paths[PROMISED];
+    for (int i = 0; i < PROMISED; i++) {
+        snprintf(promised[i], sizeof(promised[i]), "/tmp/promised_%d", i);
+        promised_paths[i] = promised[i];
+    }
+    platform_clipboard_copy_files(promised_paths, PROMISED);
+    clipboard.system_change = -1;
+    clipboard_sync_from_system(&clipboard);
+    TEST_ASSERT_EQ(PROMISED, clipboard.count, "Promised files all read back");
+    if (clipboard.count == PROMISED) {
+        TEST_ASSERT(strcmp(clipboard_path(&clipboard, PROMISED - 1), promised[PROMISED - 1]) == 0,
+                    "Promised paths read back in order");
+    }
+
+    clipboard_free(&clipboard);
 }
 
 // Test clipboard copy paths as text
@@ -152,6 +177,8 @@ static void test_clipboard_paths_as_text(void)
         TEST_ASSERT(strstr(text, "/path/to/file1.txt") != NULL, "Text contains first path");
         TEST_ASSERT(strstr(text, "/path/to/file2.txt") != NULL, "Text contains second path");
     }
+
+    clipboard_free(&clipboard);
 }
 
 // Main test function
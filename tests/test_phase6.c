@@ -3,12 +3,18 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <utime.h>
 
+#include "raylib.h"
 #include "../src/ai/duplicates.h"
+#include "../src/ai/hash_cache.h"
+#include "../src/utils/file_hash.h"
 #include "../src/ai/smart_rename.h"
 #include "../src/ai/organization.h"
 #include "../src/ai/summarize.h"
+#include "../src/ai/summarize_async.h"
 #include "../src/ai/nl_operations.h"
+#include "../src/core/undo_log.h"
 
 // Test framework macros from test_main.c
 extern void inc_tests_run(void);
@@ -163,6 +169,233 @@ static void test_duplicates_scan_directory(void)
     cleanup_test_dir();
 }
 
+static void test_file_hash(void)
+{
+    TEST_ASSERT(file_hash_bytes("", 0, 0) == 0xEF46DB3751D8E999ULL, "Empty input should match XXH64");
+    const char *text = "Nobody inspects the spammish repetition";
+    TEST_ASSERT(file_hash_bytes(text, strlen(text), 0) == 0xFBCEA83C8A378BF1ULL, "Text should match XXH64");
+
+    // Larger than one read buffer, with a ragged tail
+    setup_test_dir();
+    size_t size = 3 * 1024 * 1024 + 77;
+    unsigned char *data = malloc(size);
+    for (size_t i = 0; i < size; i++) data[i] = (unsigned char)(i * 31 + (i >> 11));
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/large.bin", test_dir);
+    FILE *f = fopen(path, "wb");
+    fwrite(data, 1, size, f);
+    fclose(f);
+
+    uint64_t hash = 0;
+    TEST_ASSERT(file_hash_compute(path, &hash) && hash == file_hash_bytes(data, size, 0),
+                "Streamed file hash should equal the buffer hash");
+
+    unsigned char ends[2 * 4096];
+    memcpy(ends, data, 4096);
+    memcpy(ends + 4096, data + size - 4096, 4096);
+    TEST_ASSERT(file_hash_partial(path, size, 4096, &hash) && hash == file_hash_bytes(ends, sizeof(ends), 0),
+                "Partial hash should cover head and tail");
+
+    FileHashJob jobs[8];
+    for (int i = 0; i < 8; i++) {
+        jobs[i] = (FileHashJob){ .path = i == 5 ? "/nonexistent/file" : path };
+    }
+    file_hash_batch(jobs, 8);
+    TEST_ASSERT(jobs[0].ok && jobs[7].ok && jobs[0].hash == jobs[7].hash && jobs[0].hash == file_hash_bytes(data, size, 0),
+                "Batch should hash every job");
+    TEST_ASSERT(!jobs[5].ok, "Batch should flag unreadable files");
+
+    char hex[FILE_HASH_HEX_SIZE];
+    file_hash_to_hex(0xABCULL, hex);
+    TEST_ASSERT(strcmp(hex, "0000000000000abc") == 0, "Hex form should be zero padded");
+
+    free(data);
+    cleanup_test_dir();
+}
+
+static void test_duplicates_staged_exact(void)
+{
+    setup_test_dir();
+    create_test_file("same_size_a.txt", "aaaa");
+    create_test_file("same_size_b.txt", "bbbb");
+
+    // Large files that share their first and last 64 KB
+    size_t size = 256 * 1024;
+    char *content = malloc(size + 1);
+    memset(content, 'x', size);
+    content[size] = '\0';
+    create_test_file("big1.bin", content);
+    create_test_file("big2.bin", content);
+    content[size / 2] = 'y';
+    create_test_file("big_middle.bin", content);
+    free(content);
+
+    DuplicateConfig config;
+    duplicate_config_init(&config);
+    config.detect_similar_images = false;
+    config.detect_similar_text = false;
+
+    DuplicateAnalysis *analysis = duplicate_analysis_create();
+    DuplicateStatus status = duplicate_scan_directory(test_dir, &config, NULL, NULL, analysis);
+
+    TEST_ASSERT(status == DUP_STATUS_OK, "Staged scan should succeed");
+    TEST_ASSERT(analysis->group_count == 1 && analysis->groups[0].file_count == 2,
+                "Only the identical large files should be grouped");
+    TEST_ASSERT(analysis->group_count == 1 && strstr(analysis->groups[0].files[0].path, "big_middle") == NULL &&
+                strstr(analysis->groups[0].files[1].path, "big_middle") == NULL,
+                "A change between head and tail should be caught by the full hash");
+
+    duplicate_analysis_free(analysis);
+    cleanup_test_dir();
+}
+
+static int count_exact_groups(const char *dir, HashCache *cache)
+{
+    DuplicateConfig config;
+    duplicate_config_init(&config);
+    config.detect_similar_images = false;
+    config.detect_similar_text = false;
+    config.hash_cache = cache;
+
+    DuplicateAnalysis *analysis = duplicate_analysis_create();
+    duplicate_scan_directory(dir, &config, NULL, NULL, analysis);
+    int groups = analysis->group_count;
+    duplicate_analysis_free(analysis);
+    return groups;
+}
+
+static void test_duplicates_hash_cache(void)
+{
+    setup_test_dir();
+    create_test_file("copy1.txt", "cached content");
+    create_test_file("copy2.txt", "cached content");
+    create_test_file("other.txt", "other content!");
+
+    HashCache *cache = hash_cache_open(":memory:");
+    TEST_ASSERT(cache != NULL, "Hash cache should open");
+    TEST_ASSERT(count_exact_groups(test_dir, cache) == 1, "First scan should find the copies");
+    TEST_ASSERT(hash_cache_count(cache) == 3, "Every same-size file should be cached");
+
+    // Same size and mtime: a rescan trusts the cache and never reads the file
+    char path[512];
+    snprintf(path, sizeof(path), "%s/copy2.txt", test_dir);
+    struct stat st;
+    stat(path, &st);
+    create_test_file("copy2.txt", "changed conten");
+    struct utimbuf times = { st.st_atime, st.st_mtime };
+    utime(path, &times);
+    TEST_ASSERT(count_exact_groups(test_dir, cache) == 1, "Rescan should use cached hashes");
+
+    // The watcher invalidates changed paths
+    hash_cache_invalidate(cache, test_dir);
+    TEST_ASSERT(hash_cache_count(cache) == 0, "Invalidating a directory should drop its files");
+    TEST_ASSERT(count_exact_groups(test_dir, cache) == 0, "Rescan after invalidation should rehash");
+
+    hash_cache_close(cache);
+    cleanup_test_dir();
+}
+
+static void export_test_image(Image image, const char *name)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", test_dir, name);
+    ExportImage(image, path);
+    UnloadImage(image);
+}
+
+static void test_duplicates_perceptual_hash(void)
+{
+    setup_test_dir();
+
+    // The same picture rescaled and brightened, and an unrelated one
+    Image original = GenImageGradientLinear(256, 256, 45, DARKBLUE, RAYWHITE);
+    ImageDrawRectangle(&original, 40, 60, 90, 120, MAROON);
+    Image edited = ImageCopy(original);
+    ImageResize(&edited, 180, 180);
+    ImageColorBrightness(&edited, 20);
+    export_test_image(original, "photo.png");
+    export_test_image(edited, "photo_edited.png");
+    export_test_image(GenImageChecked(256, 256, 32, 32, BLACK, WHITE), "checks.png");
+
+    char path[512];
+    uint8_t hash_photo[HASH_SIZE_PERCEPTUAL], hash_edited[HASH_SIZE_PERCEPTUAL], hash_checks[HASH_SIZE_PERCEPTUAL];
+    snprintf(path, sizeof(path), "%s/photo.png", test_dir);
+    bool ok = hash_image_perceptual(path, hash_photo);
+    snprintf(path, sizeof(path), "%s/photo_edited.png", test_dir);
+    ok = hash_image_perceptual(path, hash_edited) && ok;
+    snprintf(path, sizeof(path), "%s/checks.png", test_dir);
+    ok = hash_image_perceptual(path, hash_checks) && ok;
+    TEST_ASSERT(ok, "Perceptual hashes should decode the images");
+    TEST_ASSERT(hash_hamming_distance(hash_photo, hash_edited, HASH_SIZE_PERCEPTUAL) <= 6,
+                "A rescaled, brightened copy should hash close to the original");
+    TEST_ASSERT(hash_hamming_distance(hash_photo, hash_checks, HASH_SIZE_PERCEPTUAL) > 16,
+                "Unrelated images should hash far apart");
+
+    create_test_file("broken.jpg", "not an image");
+    snprintf(path, sizeof(path), "%s/broken.jpg", test_dir);
+    TEST_ASSERT(!hash_image_perceptual(path, hash_checks), "Undecodable images should fail");
+
+    DuplicateConfig config;
+    duplicate_config_init(&config);
+    config.detect_exact = false;
+    config.detect_similar_text = false;
+    DuplicateAnalysis *analysis = duplicate_analysis_create();
+    duplicate_scan_directory(test_dir, &config, NULL, NULL, analysis);
+    TEST_ASSERT(analysis->group_count == 1 && analysis->groups[0].file_count == 2 &&
+                strstr(analysis->groups[0].files[0].path, "checks") == NULL &&
+                strstr(analysis->groups[0].files[1].path, "checks") == NULL,
+                "Only the two versions of the photo should be grouped");
+
+    duplicate_analysis_free(analysis);
+    cleanup_test_dir();
+}
+
+static void index_test_file(VectorDB *db, const char *name, int axis)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", test_dir, name);
+    struct stat st;
+    stat(path, &st);
+    float embedding[EMBEDDING_DIMENSION] = {0};
+    embedding[axis] = 1.0f;
+    vectordb_index_file(db, path, name, FILE_TYPE_TEXT, st.st_size, st.st_mtime, embedding);
+}
+
+static void test_duplicates_similar_text_from_index(void)
+{
+    setup_test_dir();
+    create_test_file("notes.txt", "meeting notes, first draft");
+    create_test_file("notes_copy.md", "meeting notes - final");
+    create_test_file("recipe.txt", "two eggs and flour");
+    create_test_file("unindexed.txt", "written after the last index run");
+
+    char db_path[512];
+    snprintf(db_path, sizeof(db_path), "%s/index.db", test_dir);
+    VectorDB *db = vectordb_open(db_path);
+    index_test_file(db, "notes.txt", 0);
+    index_test_file(db, "notes_copy.md", 0);
+    index_test_file(db, "recipe.txt", 1);
+
+    // No engine: only the stored embeddings can group anything
+    DuplicateConfig config;
+    duplicate_config_init(&config);
+    config.detect_exact = false;
+    config.detect_similar_images = false;
+    config.vectordb = db;
+    DuplicateAnalysis *analysis = duplicate_analysis_create();
+    DuplicateStatus status = duplicate_scan_directory(test_dir, &config, NULL, NULL, analysis);
+
+    TEST_ASSERT(status == DUP_STATUS_OK, "Similar text scan should succeed");
+    TEST_ASSERT(analysis->group_count == 1 && analysis->groups[0].file_count == 2, "Indexed embeddings should be reused");
+    TEST_ASSERT(analysis->group_count == 1 && strstr(analysis->groups[0].files[0].path, "notes") &&
+                strstr(analysis->groups[0].files[1].path, "notes"), "Only the two notes should be grouped");
+
+    duplicate_analysis_free(analysis);
+    vectordb_close(db);
+    cleanup_test_dir();
+}
+
 static void test_duplicates_status_message(void)
 {
     TEST_ASSERT(strcmp(duplicate_status_message(DUP_STATUS_OK), "OK") == 0,
@@ -265,6 +498,42 @@ static void test_smart_rename_expand_pattern(void)
     cleanup_test_dir();
 }
 
+static void test_smart_rename_extract_hints(void)
+{
+    setup_test_dir();
+    create_test_file("notes.md", "draft\n\n# Quarterly   Report\n\nRevenue grew.\n");
+    create_test_file("letter.txt", "\n\n   Dear Alice,\nThanks for the photos.\n");
+    create_test_file("blank.txt", "");
+    create_test_file("scan.pdf", "%PDF-1.4");
+
+    BatchRenameRequest *request = smart_rename_request_create();
+    const char *names[] = {"notes.md", "letter.txt", "blank.txt", "scan.pdf"};
+    for (int i = 0; i < 4; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", test_dir, names[i]);
+        smart_rename_request_add_file(request, path);
+    }
+
+    SmartRenameConfig config;
+    smart_rename_config_init(&config);
+    smart_rename_extract_hints(request, &config);
+
+    TEST_ASSERT(strcmp(request->suggestions[0].hint, "heading Quarterly Report") == 0,
+                "Markdown hint should be its first heading");
+    TEST_ASSERT(strcmp(request->suggestions[1].hint, "starts Dear Alice,") == 0,
+                "Text hint should be its first non-blank line");
+    TEST_ASSERT(request->suggestions[2].hint[0] == '\0' && request->suggestions[3].hint[0] == '\0',
+                "Empty and document files should have no hint");
+
+    // Without content the text is not read
+    request->use_content = false;
+    smart_rename_extract_hints(request, &config);
+    TEST_ASSERT(request->suggestions[0].hint[0] == '\0', "Hints should follow use_content");
+
+    smart_rename_request_free(request);
+    cleanup_test_dir();
+}
+
 static void test_smart_rename_status_message(void)
 {
     TEST_ASSERT(strcmp(smart_rename_status_message(RENAME_STATUS_OK), "OK") == 0,
@@ -331,6 +600,121 @@ static void test_organization_analyze(void)
     cleanup_test_dir();
 }
 
+static void test_organization_analyze_recursive(void)
+{
+    setup_test_dir();
+    create_test_subdir("a");
+    create_test_subdir("a/b");
+    create_test_subdir("node_modules");
+    create_test_file("top.pdf", "PDF");
+    create_test_file("a/Screenshot 1.png", "PNG");
+    create_test_file("a/b/Screenshot 2.png", "PNG");
+    create_test_file("a/b/notes.txt", "notes");
+    create_test_file("node_modules/skip.js", "x");
+
+    OrganizationConfig config;
+    organization_config_init(&config);
+    config.recursive = true;
+    const char *excludes[] = { "node_modules" };
+    config.exclude_patterns = excludes;
+    config.exclude_count = 1;
+
+    OrganizationAnalysis *analysis = organization_analysis_create();
+    OrganizationStatus status = organization_analyze(test_dir, &config, NULL, NULL, analysis);
+    TEST_ASSERT(status == ORG_STATUS_OK, "Recursive analysis should succeed");
+    TEST_ASSERT(analysis->total_files == 4, "Should find files in subfolders but not excluded ones");
+    TEST_ASSERT(analysis->directories_scanned == 3, "Should read every folder once");
+
+    bool screenshots = false;
+    for (int i = 0; i < analysis->category_count; i++) {
+        const CategoryStats *stats = &analysis->categories[i];
+        for (int j = 0; j < stats->subcategory_count; j++) {
+            if (strcmp(stats->subcategories[j].name, "Screenshots") == 0) {
+                screenshots = stats->subcategories[j].file_count == 2 && stats->subcategories[j].sample_count == 2;
+            }
+        }
+    }
+    TEST_ASSERT(screenshots, "Should aggregate subcategories with example names");
+    organization_analysis_free(analysis);
+
+    // The same in the background, watched through snapshots
+    OrganizationScan *scan = organization_scan_start(test_dir, &config);
+    TEST_ASSERT(scan != NULL, "Should start a background scan");
+    OrganizationAnalysis snapshot;
+    while (!organization_scan_poll(scan, &snapshot)) {
+        usleep(1000);
+    }
+    organization_scan_poll(scan, &snapshot);
+    TEST_ASSERT(snapshot.total_files == 4 && snapshot.files == NULL, "Snapshot should carry the statistics only");
+    analysis = organization_scan_finish(scan, &status);
+    TEST_ASSERT(analysis != NULL && status == ORG_STATUS_OK, "Should hand over the finished analysis");
+    TEST_ASSERT(analysis && analysis->file_count == 4, "Finished analysis should list the files");
+    organization_analysis_free(analysis);
+
+    cleanup_test_dir();
+}
+
+static void test_organization_execute_undo(void)
+{
+    setup_test_dir();
+    create_test_subdir("Documents");
+    create_test_file("report.pdf", "PDF");
+    create_test_file("notes.txt", "new notes");
+    create_test_file("Documents/notes.txt", "old notes");
+
+    // The move journal goes under HOME, what to undo in the shared undo log
+    const char *home = getenv("HOME");
+    char saved_home[512];
+    snprintf(saved_home, sizeof(saved_home), "%s", home ? home : "");
+    setenv("HOME", test_dir, 1);
+    char log_path[512];
+    snprintf(log_path, sizeof(log_path), "%s/.undo.log", test_dir);
+    UndoLog *undo = undo_log_open(log_path);
+    undo_log_set_shared(undo);
+
+    OrganizationConfig config;
+    organization_config_init(&config);
+    OrganizationAnalysis *analysis = organization_analysis_create();
+    organization_analyze(test_dir, &config, NULL, NULL, analysis);
+    // notes.txt goes where a file of the same name already is
+    for (int i = 0; i < analysis->file_count; i++) {
+        OrganizedFile *file = &analysis->files[i];
+        bool notes = strcmp(file->name, "notes.txt") == 0;
+        snprintf(file->suggested_folder, sizeof(file->suggested_folder), "%s", notes ? "Documents" : "Sorted/Docs");
+        file->should_move = notes || strcmp(file->name, "report.pdf") == 0;
+    }
+
+    OrganizationResult result = organization_execute(analysis, false);
+    TEST_ASSERT(result.status == ORG_STATUS_OK, "Execute should succeed");
+    TEST_ASSERT(result.files_moved == 2, "Execute should move the confirmed files");
+    TEST_ASSERT(result.folders_created == 2, "Execute should create the missing folders");
+
+    char path[512];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/Documents/notes.txt", test_dir);
+    FILE *f = fopen(path, "r");
+    char text[32] = "";
+    if (f) {
+        fgets(text, sizeof(text), f);
+        fclose(f);
+    }
+    TEST_ASSERT(strcmp(text, "old notes") == 0, "A file in the way should not be replaced");
+
+    TEST_ASSERT(organization_undo(), "Undo should move the files back");
+    snprintf(path, sizeof(path), "%s/report.pdf", test_dir);
+    TEST_ASSERT(stat(path, &st) == 0, "Undo should restore the original paths");
+    snprintf(path, sizeof(path), "%s/Sorted", test_dir);
+    TEST_ASSERT(stat(path, &st) != 0, "Undo should remove the folders it created");
+    TEST_ASSERT(!organization_undo(), "A second undo should have nothing to do");
+
+    undo_log_close(undo);
+    organization_analysis_free(analysis);
+    if (saved_home[0]) {
+        setenv("HOME", saved_home, 1);
+    }
+    cleanup_test_dir();
+}
+
 static void test_organization_preview_plan(void)
 {
     setup_test_dir();
@@ -415,6 +799,202 @@ static void test_summarize_status_message(void)
                 "Too large status message correct");
 }
 
+static void test_summary_cache(void)
+{
+    setup_test_dir();
+
+    char db_path[512], file_path[512];
+    snprintf(db_path, sizeof(db_path), "%s/summaries.db", test_dir);
+    snprintf(file_path, sizeof(file_path), "%s/notes.txt", test_dir);
+
+    create_test_file("notes.txt", "Meeting notes");
+
+    SummaryCache *cache = summary_cache_create(db_path);
+    TEST_ASSERT(cache != NULL, "Summary cache should open");
+    if (!cache) {
+        cleanup_test_dir();
+        return;
+    }
+
+    SummaryResult stored;
+    memset(&stored, 0, sizeof(stored));
+    snprintf(stored.path, sizeof(stored.path), "%s", file_path);
+    snprintf(stored.summary, sizeof(stored.summary), "Notes from a meeting");
+    stored.level = SUMM_LEVEL_BRIEF;
+    TEST_ASSERT(summary_cache_put(cache, &stored), "Summary should be stored");
+
+    SummaryResult found;
+    memset(&found, 0, sizeof(found));
+    TEST_ASSERT(summary_cache_get(cache, file_path, &found), "Stored summary should be found");
+    TEST_ASSERT(strcmp(found.summary, "Notes from a meeting") == 0, "Found summary should match");
+    TEST_ASSERT(found.from_cache, "Found summary should be marked cached");
+
+    // Touching the file changes its mtime but not its content
+    struct utimbuf times = { .actime = 1000000000, .modtime = 1000000000 };
+    utime(file_path, &times);
+    memset(&found, 0, sizeof(found));
+    TEST_ASSERT(summary_cache_get(cache, file_path, &found), "Touched file should keep its summary");
+
+    // Writes are batched; closing commits them
+    summary_cache_destroy(cache);
+    cache = summary_cache_create(db_path);
+    memset(&found, 0, sizeof(found));
+    TEST_ASSERT(cache && summary_cache_get(cache, file_path, &found),
+                "Summary should survive reopening the cache");
+
+    create_test_file("notes.txt", "Different notes");
+    TEST_ASSERT(!summary_cache_get(cache, file_path, &found), "Changed file should miss");
+
+    summary_cache_destroy(cache);
+    cleanup_test_dir();
+}
+
+// Helper: A long plain-text document of numbered paragraphs; edited changes one word
+// in the middle
+static char *make_long_document(size_t *length, bool edited)
+{
+    size_t size = 256 * 1024;
+    char *text = malloc(size + 256);
+    size_t len = 0;
+    for (int i = 0; text && len < size; i++) {
+        const char *word = (edited && i == 900) ? "changed" : "original";
+        len += (size_t)sprintf(text + len, "Paragraph %d holds an %s sentence about topic %d.\n\n",
+                               i, word, i * 7 % 13);
+    }
+    *length = len;
+    return text;
+}
+
+static void test_summarize_split(void)
+{
+    size_t len = 0, edited_len = 0;
+    char *text = make_long_document(&len, false);
+    char *edited = make_long_document(&edited_len, true);
+    SummaryChunk *chunks = malloc(SUMMARY_MAX_CHUNKS * sizeof(SummaryChunk));
+    SummaryChunk *edited_chunks = malloc(SUMMARY_MAX_CHUNKS * sizeof(SummaryChunk));
+    if (!text || !edited || !chunks || !edited_chunks) {
+        TEST_ASSERT(false, "Split test allocations should succeed");
+        free(text);
+        free(edited);
+        free(chunks);
+        free(edited_chunks);
+        return;
+    }
+
+    int count = summarize_split(text, len, SUMM_TYPE_TEXT, chunks, SUMMARY_MAX_CHUNKS);
+    TEST_ASSERT(count > 1, "Long document should split into several parts");
+
+    bool contiguous = count > 0 && chunks[0].offset == 0;
+    bool sized = true;
+    for (int i = 0; i < count; i++) {
+        if (i + 1 < count && chunks[i].offset + chunks[i].length != chunks[i + 1].offset) contiguous = false;
+        if (chunks[i].length > 2 * SUMMARY_CHUNK_TARGET) sized = false;
+    }
+    TEST_ASSERT(contiguous && chunks[count - 1].offset + chunks[count - 1].length == len,
+                "Parts should cover the document end to end");
+    TEST_ASSERT(sized, "No part should exceed twice the target size");
+
+    // Boundaries follow the content, so an edit only changes the parts around it
+    int edited_count = summarize_split(edited, edited_len, SUMM_TYPE_TEXT, edited_chunks, SUMMARY_MAX_CHUNKS);
+    int changed = 0;
+    for (int i = 0; i < edited_count; i++) {
+        bool found = false;
+        for (int j = 0; j < count && !found; j++) {
+            found = chunks[j].hash == edited_chunks[i].hash;
+        }
+        if (!found) changed++;
+    }
+    TEST_ASSERT(changed >= 1 && changed <= 2, "An edit should change only the part holding it");
+
+    int capped = summarize_split(text, len, SUMM_TYPE_TEXT, chunks, 2);
+    TEST_ASSERT(capped == 2, "Split should stop at max_chunks");
+    TEST_ASSERT(summarize_split(NULL, 0, SUMM_TYPE_TEXT, chunks, SUMMARY_MAX_CHUNKS) == 0,
+                "Empty text should give no parts");
+
+    free(text);
+    free(edited);
+    free(chunks);
+    free(edited_chunks);
+}
+
+static void test_summary_chunk_cache(void)
+{
+    setup_test_dir();
+
+    char db_path[512];
+    snprintf(db_path, sizeof(db_path), "%s/summaries.db", test_dir);
+    SummaryCache *cache = summary_cache_create(db_path);
+    TEST_ASSERT(cache != NULL, "Summary cache should open");
+    if (!cache) {
+        cleanup_test_dir();
+        return;
+    }
+
+    char summary[256];
+    TEST_ASSERT(!summary_cache_get_chunk(cache, 42, summary, sizeof(summary)), "Unknown part should miss");
+    TEST_ASSERT(summary_cache_put_chunk(cache, 42, "Part about topic four"), "Part summary should be stored");
+    TEST_ASSERT(summary_cache_get_chunk(cache, 42, summary, sizeof(summary)) &&
+                strcmp(summary, "Part about topic four") == 0, "Stored part summary should be found");
+
+    summary_cache_destroy(cache);
+    cache = summary_cache_create(db_path);
+    TEST_ASSERT(cache && summary_cache_get_chunk(cache, 42, summary, sizeof(summary)),
+                "Part summary should survive reopening the cache");
+
+    summary_cache_clear(cache);
+    TEST_ASSERT(!summary_cache_get_chunk(cache, 42, summary, sizeof(summary)), "Clearing should drop part summaries");
+
+    summary_cache_destroy(cache);
+    cleanup_test_dir();
+}
+
+// Helper: wait up to two seconds for the request to finish
+static bool wait_summary(AsyncSummaryRequest *req)
+{
+    for (int i = 0; i < 200 && summarize_async_is_busy(req); i++) {
+        usleep(10000);
+    }
+    return !summarize_async_is_busy(req);
+}
+
+static void test_summarize_executor(void)
+{
+    SummaryExecutor *executor = summarize_executor_create();
+    TEST_ASSERT(executor != NULL, "Summary executor should start");
+    if (!executor) return;
+
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    AsyncSummaryRequest req;
+    summarize_async_init(&req, &mutex);
+
+    SummarizeConfig config;
+    summarize_config_init(&config);
+    config.use_cache = false;
+
+    // Missing files fail before any API call, so runs finish quickly
+    TEST_ASSERT(summarize_async_start(executor, &req, "/nonexistent/first.txt", &config, NULL,
+                                      SUMM_PRIORITY_HOVER),
+                "Summary request should be queued");
+    TEST_ASSERT(summarize_async_start(executor, &req, "/nonexistent/second.txt", &config, NULL,
+                                      SUMM_PRIORITY_HOVER),
+                "Restarted request should be queued");
+    TEST_ASSERT(wait_summary(&req), "Summary request should finish");
+    TEST_ASSERT(summarize_async_is_ready(&req), "Finished request should be ready");
+    TEST_ASSERT(strcmp(req.result.path, "/nonexistent/second.txt") == 0,
+                "Only the latest run should deliver its result");
+    TEST_ASSERT(req.result.status == SUMM_STATUS_FILE_ERROR, "Missing file should report file error");
+
+    // A cancelled run never completes, even if a worker already took it
+    summarize_async_start(executor, &req, "/nonexistent/third.txt", &config, NULL,
+                          SUMM_PRIORITY_NORMAL);
+    summarize_async_cancel(&req);
+    TEST_ASSERT(!summarize_async_is_busy(&req), "Cancelled request should not be busy");
+    usleep(50000);
+    TEST_ASSERT(!summarize_async_is_complete(&req), "Cancelled request should never complete");
+
+    summarize_executor_destroy(executor);
+}
+
 // =============================================================================
 // Natural Language Operations Tests
 // =============================================================================
@@ -546,6 +1126,11 @@ void test_phase6(void)
     test_duplicates_files_are_identical();
     test_duplicates_hamming_distance();
     test_duplicates_scan_directory();
+    test_file_hash();
+    test_duplicates_staged_exact();
+    test_duplicates_hash_cache();
+    test_duplicates_perceptual_hash();
+    test_duplicates_similar_text_from_index();
     test_duplicates_status_message();
 
     printf("\n--- Smart Rename Tests ---\n");
@@ -554,6 +1139,7 @@ void test_phase6(void)
     test_smart_rename_format_name();
     test_smart_rename_add_file();
     test_smart_rename_expand_pattern();
+    test_smart_rename_extract_hints();
     test_smart_rename_status_message();
 
     printf("\n--- Organization Tests ---\n");
@@ -561,6 +1147,8 @@ void test_phase6(void)
     test_organization_analysis_create_free();
     test_organization_category_name();
     test_organization_analyze();
+    test_organization_analyze_recursive();
+    test_organization_execute_undo();
     test_organization_preview_plan();
     test_organization_status_message();
 
@@ -570,6 +1158,10 @@ void test_phase6(void)
     test_summarize_is_supported();
     test_summarize_file_type_name();
     test_summarize_status_message();
+    test_summary_cache();
+    test_summarize_split();
+    test_summary_chunk_cache();
+    test_summarize_executor();
 
     printf("\n--- Natural Language Operations Tests ---\n");
     test_nl_operations_config_init();
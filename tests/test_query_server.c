@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "tools/query_server.h"
+#include "ai/path_index.h"
+#include "cJSON/cJSON.h"
+
+// Test macros from test_main.c
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+static char socket_path[256];
+static char test_dir[256];
+
+// Helper: Connect to the server under test
+static int query_connect(void)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+// Helper: Send one request line and parse the response line (caller deletes)
+static cJSON *query_send(int fd, const char *request)
+{
+    if (write(fd, request, strlen(request)) < 0 || write(fd, "\n", 1) < 0) {
+        return NULL;
+    }
+    char line[65536];
+    size_t length = 0;
+    while (length < sizeof(line) - 1) {
+        ssize_t got = read(fd, line + length, 1);
+        if (got <= 0 || line[length] == '\n') break;
+        length++;
+    }
+    line[length] = '\0';
+    return cJSON_Parse(line);
+}
+
+// Helper: Whether a response succeeded
+static bool query_ok(const cJSON *response)
+{
+    return response && cJSON_IsTrue(cJSON_GetObjectItem(response, "ok"));
+}
+
+static void test_query_server_requests(void)
+{
+    snprintf(test_dir, sizeof(test_dir), "/tmp/finder_plus_query_test_%d", getpid());
+    mkdir(test_dir, 0755);
+    char path[512];
+    snprintf(path, sizeof(path), "%s/quarterly_report.txt", test_dir);
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fputs("numbers", f);
+        fclose(f);
+    }
+
+    PathIndex *index = path_index_open(NULL);
+    path_index_add(index, path);
+    snprintf(socket_path, sizeof(socket_path), "/tmp/finder_plus_query_%d.sock", getpid());
+    QueryServerSources sources = { .path_index = index };
+    QueryServer *server = query_server_start(socket_path, &sources);
+    TEST_ASSERT(server != NULL, "Server should start");
+    TEST_ASSERT(query_server_start(socket_path, &sources) == NULL, "A second server on the socket should be refused");
+
+    int fd = query_connect();
+    TEST_ASSERT(fd >= 0, "Client should connect");
+
+    cJSON *response = query_send(fd, "{\"id\":7,\"tool\":\"status\"}");
+    cJSON *result = cJSON_GetObjectItem(response, "result");
+    TEST_ASSERT(query_ok(response) && cJSON_GetObjectItem(response, "id")->valuedouble == 7,
+                "Status should answer with the request's id");
+    TEST_ASSERT(cJSON_GetObjectItem(result, "paths")->valuedouble == 1 &&
+                cJSON_IsFalse(cJSON_GetObjectItem(result, "semantic_search")),
+                "Status should report the index and searches available");
+    cJSON_Delete(response);
+
+    response = query_send(fd, "{\"tool\":\"name_search\",\"input\":{\"query\":\"quarterly\"}}");
+    cJSON *matches = cJSON_GetObjectItem(cJSON_GetObjectItem(response, "result"), "results");
+    TEST_ASSERT(query_ok(response) && cJSON_GetArraySize(matches) == 1 &&
+                strcmp(cJSON_GetObjectItem(cJSON_GetArrayItem(matches, 0), "path")->valuestring, path) == 0,
+                "Name search should answer from the filename index");
+    cJSON_Delete(response);
+
+    // A read-only tool of the executor, its output passed through as JSON
+    char request[1024];
+    snprintf(request, sizeof(request),
+             "{\"tool\":\"file_search\",\"input\":{\"path\":\"%s\",\"pattern\":\"*.txt\",\"filter\":\"size<1k\"}}",
+             test_dir);
+    response = query_send(fd, request);
+    TEST_ASSERT(query_ok(response) &&
+                cJSON_GetObjectItem(cJSON_GetObjectItem(response, "result"), "count")->valuedouble == 1,
+                "File search with a filter should be served");
+    cJSON_Delete(response);
+
+    snprintf(request, sizeof(request), "{\"tool\":\"file_delete\",\"input\":{\"path\":\"%s\"}}", path);
+    response = query_send(fd, request);
+    TEST_ASSERT(response && !query_ok(response) && access(path, F_OK) == 0, "Mutating tools should be refused");
+    cJSON_Delete(response);
+
+    response = query_send(fd, "{\"tool\":\"semantic_search\",\"input\":{\"query\":\"numbers\"}}");
+    TEST_ASSERT(response && !query_ok(response) && cJSON_IsString(cJSON_GetObjectItem(response, "error")),
+                "Semantic search without an engine should report an error");
+    cJSON_Delete(response);
+
+    response = query_send(fd, "not json");
+    TEST_ASSERT(response && !query_ok(response), "A malformed request should get an error, not a closed socket");
+    cJSON_Delete(response);
+
+    response = query_send(fd, "{\"tool\":\"status\"}");
+    TEST_ASSERT(query_ok(response), "The connection should keep serving after an error");
+    cJSON_Delete(response);
+
+    // Stopping ends connections still open
+    query_server_stop(server);
+    char byte;
+    TEST_ASSERT(read(fd, &byte, 1) == 0, "Stopping should close open connections");
+    close(fd);
+    TEST_ASSERT(access(socket_path, F_OK) != 0, "Stopping should remove the socket");
+
+    path_index_close(index);
+    unlink(path);
+    rmdir(test_dir);
+}
+
+void test_query_server(void)
+{
+    test_query_server_requests();
+}
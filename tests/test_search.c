@@ -97,6 +97,28 @@ static int search_fuzzy_match(const char *query, const char *text,
 
     return score;
 }
+// Character mask prefilter (copy of core logic)
+static unsigned long long char_bit(unsigned char c)
+{
+    if (c >= 'A' && c <= 'Z') c = c + ('a' - 'A');
+    if (c >= 'a' && c <= 'z') return 1ULL << (c - 'a');
+    if (c >= '0' && c <= '9') return 1ULL << (26 + c - '0');
+    return 1ULL << (36 + c % 28);
+}
+
+static unsigned long long char_mask(const char *text)
+{
+    unsigned long long mask = 0;
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        mask |= char_bit(*p);
+    }
+    return mask;
+}
+
+static bool mask_may_match(const char *query, const char *text)
+{
+    return (char_mask(query) & ~char_mask(text)) == 0;
+}
 
 void test_search(void)
 {
@@ -191,4 +213,46 @@ void test_search(void)
         search_fuzzy_match("tf", "test_file.txt", positions, &match_count, false);
         TEST_ASSERT_EQ(2, match_count, "Should have 2 matches");
     }
+
+    // Test prefilter never rejects a real match
+    {
+        const char *names[] = {"test_file.txt", "README.md", "photo-2024_01.JPG", "a b c", "x"};
+        const char *queries[] = {"tf", "rdm", "P2024", "abc", "txt", "md", "j", "_0", "zz", "x"};
+        bool consistent = true;
+        for (int n = 0; n < 5; n++) {
+            for (int q = 0; q < 10; q++) {
+                if (search_fuzzy_match(queries[q], names[n], NULL, NULL, false) > 0 &&
+                    !mask_may_match(queries[q], names[n])) {
+                    consistent = false;
+                }
+            }
+        }
+        TEST_ASSERT(consistent, "Prefilter should keep every fuzzy match");
+    }
+
+    // Test prefilter rejects names missing a query character
+    {
+        TEST_ASSERT(!mask_may_match("xyz", "abcdef"), "Missing characters should be rejected");
+        TEST_ASSERT(!mask_may_match("7", "file.txt"), "Missing digit should be rejected");
+        TEST_ASSERT(mask_may_match("FT", "file.txt"), "Prefilter should fold case");
+    }
+
+    // Test narrowing invariant: a match for a query also matches every prefix
+    {
+        const char *names[] = {"test_file.txt", "README.md", "photo-2024_01.JPG", "main.c"};
+        const char *query = "te_fi.tx";
+        bool narrowing_safe = true;
+        for (int n = 0; n < 4; n++) {
+            char prefix[16];
+            for (size_t len = 1; len <= strlen(query); len++) {
+                memcpy(prefix, query, len);
+                prefix[len] = '\0';
+                int longer = len < strlen(query) ? search_fuzzy_match(query, names[n], NULL, NULL, false) : 0;
+                if (longer > 0 && search_fuzzy_match(prefix, names[n], NULL, NULL, false) == 0) {
+                    narrowing_safe = false;
+                }
+            }
+        }
+        TEST_ASSERT(narrowing_safe, "Prefix of a matching query should still match");
+    }
 }
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 // Test helper functions
 extern void inc_tests_run(void);
@@ -31,100 +32,100 @@ extern void inc_tests_failed(void);
 } while(0)
 
 // Selection state (copy of app.h definition)
-#define MAX_SELECTION 4096
-
 typedef struct SelectionState {
-    int *indices;
+    uint64_t *bits;
+    int words;
     int count;
-    int capacity;
     int anchor_index;
+    uint32_t generation;
 } SelectionState;
 
 // Implement selection functions locally for testing
+static uint32_t g_selection_generation = 1;
+
+static void selection_changed(SelectionState *sel)
+{
+    sel->generation = g_selection_generation++;
+}
+
 static void selection_init(SelectionState *sel)
 {
-    sel->indices = NULL;
+    sel->bits = NULL;
+    sel->words = 0;
     sel->count = 0;
-    sel->capacity = 0;
     sel->anchor_index = -1;
+    selection_changed(sel);
 }
 
 static void selection_free(SelectionState *sel)
 {
-    if (sel->indices) {
-        free(sel->indices);
-        sel->indices = NULL;
-    }
+    free(sel->bits);
+    sel->bits = NULL;
+    sel->words = 0;
     sel->count = 0;
-    sel->capacity = 0;
     sel->anchor_index = -1;
+    selection_changed(sel);
 }
 
 static void selection_clear(SelectionState *sel)
 {
-    sel->count = 0;
+    if (sel->count > 0) {
+        memset(sel->bits, 0, (size_t)sel->words * sizeof(uint64_t));
+        sel->count = 0;
+        selection_changed(sel);
+    }
     sel->anchor_index = -1;
 }
 
-static bool selection_ensure_capacity(SelectionState *sel, int needed)
+static bool selection_ensure_capacity(SelectionState *sel, int index)
 {
-    if (needed <= sel->capacity) {
+    int needed = index / 64 + 1;
+    if (needed <= sel->words) {
         return true;
     }
 
-    int new_capacity = sel->capacity == 0 ? 16 : sel->capacity * 2;
-    while (new_capacity < needed) {
-        new_capacity *= 2;
-    }
-    if (new_capacity > MAX_SELECTION) {
-        new_capacity = MAX_SELECTION;
+    int new_words = sel->words == 0 ? 16 : sel->words * 2;
+    while (new_words < needed) {
+        new_words *= 2;
     }
 
-    int *new_indices = realloc(sel->indices, new_capacity * sizeof(int));
-    if (!new_indices) {
+    uint64_t *new_bits = realloc(sel->bits, (size_t)new_words * sizeof(uint64_t));
+    if (!new_bits) {
         return false;
     }
+    memset(new_bits + sel->words, 0, (size_t)(new_words - sel->words) * sizeof(uint64_t));
 
-    sel->indices = new_indices;
-    sel->capacity = new_capacity;
+    sel->bits = new_bits;
+    sel->words = new_words;
     return true;
 }
 
-static bool selection_contains(SelectionState *sel, int index)
+static bool selection_contains(const SelectionState *sel, int index)
 {
-    for (int i = 0; i < sel->count; i++) {
-        if (sel->indices[i] == index) {
-            return true;
-        }
+    if (index < 0 || index / 64 >= sel->words) {
+        return false;
     }
-    return false;
+    return (sel->bits[index / 64] >> (index % 64)) & 1;
 }
 
 static void selection_add(SelectionState *sel, int index)
 {
-    if (selection_contains(sel, index)) {
-        return;
-    }
-
-    if (!selection_ensure_capacity(sel, sel->count + 1)) {
+    if (index < 0 || selection_contains(sel, index) || !selection_ensure_capacity(sel, index)) {
         return;
     }
-
-    sel->indices[sel->count] = index;
+    sel->bits[index / 64] |= 1ULL << (index % 64);
     sel->count++;
+    selection_changed(sel);
 }
 
 static void selection_remove(SelectionState *sel, int index)
 {
-    for (int i = 0; i < sel->count; i++) {
-        if (sel->indices[i] == index) {
-            for (int j = i; j < sel->count - 1; j++) {
-                sel->indices[j] = sel->indices[j + 1];
-            }
-            sel->count--;
-            return;
-        }
+    if (!selection_contains(sel, index)) {
+        return;
     }
+    sel->bits[index / 64] &= ~(1ULL << (index % 64));
+    sel->count--;
+    selection_changed(sel);
 }
 
 static void selection_toggle(SelectionState *sel, int index)
@@ -136,16 +137,59 @@ static void selection_toggle(SelectionState *sel, int index)
     }
 }
 
+static void selection_add_range(SelectionState *sel, int from, int to)
+{
+    int start = from < to ? from : to;
+    int end = from < to ? to : from;
+    if (start < 0) start = 0;
+    if (end < start || !selection_ensure_capacity(sel, end)) {
+        return;
+    }
+
+    for (int w = start / 64; w <= end / 64; w++) {
+        uint64_t mask = ~0ULL;
+        if (w == start / 64) mask &= ~0ULL << (start % 64);
+        if (w == end / 64) mask &= ~0ULL >> (63 - end % 64);
+        sel->count += __builtin_popcountll(mask & ~sel->bits[w]);
+        sel->bits[w] |= mask;
+    }
+    selection_changed(sel);
+}
+
 static void selection_range(SelectionState *sel, int from, int to)
 {
     selection_clear(sel);
+    selection_add_range(sel, from, to);
+}
 
-    int start = from < to ? from : to;
-    int end = from < to ? to : from;
+static int selection_next(const SelectionState *sel, int from)
+{
+    if (from < 0) from = 0;
+    int w = from / 64;
+    if (sel->count == 0 || w >= sel->words) {
+        return -1;
+    }
+
+    uint64_t word = sel->bits[w] & (~0ULL << (from % 64));
+    while (word == 0) {
+        if (++w >= sel->words) {
+            return -1;
+        }
+        word = sel->bits[w];
+    }
+    return w * 64 + __builtin_ctzll(word);
+}
 
-    for (int i = start; i <= end; i++) {
-        selection_add(sel, i);
+static int selection_collect(const SelectionState *sel, int *cursor, int *indices, int max)
+{
+    int count = 0;
+    int index = selection_next(sel, *cursor);
+    while (index >= 0 && count < max) {
+        indices[count++] = index;
+        index = selection_next(sel, index + 1);
     }
+    *cursor = index >= 0 ? index : sel->words * 64;
+    return count;
 }
 
 void test_selection(void)
@@ -155,9 +199,9 @@ void test_selection(void)
         SelectionState sel;
         selection_init(&sel);
 
-        TEST_ASSERT(sel.indices == NULL, "Initial indices should be NULL");
+        TEST_ASSERT(sel.bits == NULL, "Initial bits should be NULL");
         TEST_ASSERT_EQ(0, sel.count, "Initial count should be 0");
-        TEST_ASSERT_EQ(0, sel.capacity, "Initial capacity should be 0");
+        TEST_ASSERT_EQ(0, sel.words, "Initial words should be 0");
         TEST_ASSERT_EQ(-1, sel.anchor_index, "Initial anchor should be -1");
 
         selection_free(&sel);
@@ -275,7 +319,7 @@ void test_selection(void)
         }
 
         TEST_ASSERT_EQ(100, sel.count, "Should have 100 items");
-        TEST_ASSERT(sel.capacity >= 100, "Capacity should be at least 100");
+        TEST_ASSERT(sel.words * 64 >= 100, "Bits should cover 100 entries");
 
         bool all_present = true;
         for (int i = 0; i < 100; i++) {
@@ -288,4 +332,71 @@ void test_selection(void)
 
         selection_free(&sel);
     }
+
+    // Test ranges across word boundaries keep an exact count
+    {
+        SelectionState sel;
+        selection_init(&sel);
+
+        selection_add(&sel, 70);
+        selection_add(&sel, 300);
+        selection_add_range(&sel, 60, 200);
+        TEST_ASSERT_EQ(142, sel.count, "Range should count only newly selected entries");
+        TEST_ASSERT(!selection_contains(&sel, 59), "Should not contain 59");
+        TEST_ASSERT(selection_contains(&sel, 64) && selection_contains(&sel, 200), "Should contain both ends");
+        TEST_ASSERT(!selection_contains(&sel, 201), "Should not contain 201");
+        TEST_ASSERT(selection_contains(&sel, 300), "Should keep earlier selection");
+
+        selection_free(&sel);
+    }
+
+    // Test walking the selection in chunks
+    {
+        SelectionState sel;
+        selection_init(&sel);
+
+        int expected[] = {0, 63, 64, 127, 1000, 4095};
+        for (int i = 0; i < 6; i++) {
+            selection_add(&sel, expected[i]);
+        }
+        TEST_ASSERT_EQ(63, selection_next(&sel, 1), "Next should skip to 63");
+        TEST_ASSERT_EQ(-1, selection_next(&sel, 4096), "Next past the last should be -1");
+
+        int indices[4];
+        int cursor = 0;
+        int got[8];
+        int total = 0;
+        int n;
+        while ((n = selection_collect(&sel, &cursor, indices, 4)) > 0) {
+            for (int i = 0; i < n && total < 8; i++) {
+                got[total++] = indices[i];
+            }
+        }
+        bool match = total == 6;
+        for (int i = 0; match && i < 6; i++) {
+            match = got[i] == expected[i];
+        }
+        TEST_ASSERT(match, "Chunks should yield every index once, in order");
+
+        selection_free(&sel);
+    }
+
+    // Test selecting a huge listing
+    {
+        SelectionState sel;
+        selection_init(&sel);
+
+        uint32_t before = sel.generation;
+        selection_range(&sel, 0, 199999);
+        TEST_ASSERT_EQ(200000, sel.count, "Select-all of 200k should count every entry");
+        TEST_ASSERT(sel.generation != before, "Generation should change");
+        selection_remove(&sel, 123456);
+        TEST_ASSERT_EQ(199999, sel.count, "Remove should update the count");
+        TEST_ASSERT(!selection_contains(&sel, 123456), "Removed entry should be clear");
+
+        selection_clear(&sel);
+        TEST_ASSERT_EQ(-1, selection_next(&sel, 0), "Cleared selection should be empty");
+
+        selection_free(&sel);
+    }
 }
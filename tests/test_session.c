@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#include "../src/core/session.h"
+
+static const char *session_dir = "/tmp/finder_plus_session_test";
+static const char *session_file = "/tmp/finder_plus_session_test.snap";
+
+// Helper: Create a directory with a few files of known sizes
+static void make_listing_dir(void)
+{
+    mkdir(session_dir, 0755);
+    const char *names[] = { "alpha.txt", "beta.c", "gamma" };
+    for (int i = 0; i < 3; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", session_dir, names[i]);
+        FILE *f = fopen(path, "w");
+        if (f) {
+            for (int j = 0; j <= i * 10; j++) fputc('x', f);
+            fclose(f);
+        }
+    }
+}
+
+static void remove_listing_dir(void)
+{
+    const char *names[] = { "alpha.txt", "beta.c", "gamma" };
+    for (int i = 0; i < 3; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", session_dir, names[i]);
+        unlink(path);
+    }
+    rmdir(session_dir);
+    unlink(session_file);
+}
+
+static void test_session_round_trip(void)
+{
+    make_listing_dir();
+
+    DirectoryState dir;
+    directory_state_init(&dir);
+    directory_read(&dir, session_dir);
+    directory_stream_wait(&dir);
+    TEST_ASSERT(dir.count == 3, "Test directory should list three files");
+
+    SessionTab tabs[2] = {0};
+    snprintf(tabs[0].path, sizeof(tabs[0].path), "%s", "/");
+    snprintf(tabs[1].path, sizeof(tabs[1].path), "%s", dir.current_path);
+    tabs[1].selected_index = 2;
+    tabs[1].scroll_offset = 1;
+    const DirectoryState *listings[1] = { &dir };
+    TEST_ASSERT(session_save(session_file, tabs, 2, 1, listings, 1, 4242), "Snapshot should save");
+
+    Session *session = session_open(session_file);
+    TEST_ASSERT(session != NULL, "Snapshot should open");
+    if (session) {
+        TEST_ASSERT(session_tab_count(session) == 2 && session_current_tab(session) == 1,
+                    "Snapshot should keep the tabs and the current one");
+        const SessionTab *tab = session_tab(session, 1);
+        TEST_ASSERT(tab && tab->selected_index == 2 && tab->scroll_offset == 1,
+                    "Snapshot should keep selection and scroll");
+        TEST_ASSERT(session_tab(session, 2) == NULL, "Out of range tabs should be NULL");
+        TEST_ASSERT(session_event_id(session) == 4242, "Snapshot should keep the event ID");
+        TEST_ASSERT(session_find_listing(session, "/nowhere") == -1, "Unsaved paths should have no listing");
+
+        int index = session_find_listing(session, dir.current_path);
+        DirectoryState restored;
+        directory_state_init(&restored);
+        TEST_ASSERT(index >= 0 && session_restore_listing(session, index, &restored),
+                    "Saved listing should restore");
+
+        bool same = restored.count == dir.count && strcmp(restored.current_path, dir.current_path) == 0;
+        for (int i = 0; same && i < dir.count; i++) {
+            same = strcmp(directory_entry_name(&restored, &restored.entries[i]),
+                          directory_entry_name(&dir, &dir.entries[i])) == 0 &&
+                   restored.entries[i].size == dir.entries[i].size;
+        }
+        TEST_ASSERT(same, "Restored listing should match names, sizes and order");
+        directory_state_free(&restored);
+        session_close(session);
+    }
+
+    directory_state_free(&dir);
+    remove_listing_dir();
+}
+
+static void test_session_damaged(void)
+{
+    TEST_ASSERT(session_open("/tmp/finder_plus_no_such_session.snap") == NULL, "Missing snapshot should not open");
+
+    make_listing_dir();
+    DirectoryState dir;
+    directory_state_init(&dir);
+    directory_read(&dir, session_dir);
+    directory_stream_wait(&dir);
+    const DirectoryState *listings[1] = { &dir };
+    session_save(session_file, NULL, 0, 0, listings, 1, 0);
+
+    // Cut the file short: the listing now points past the end
+    struct stat st;
+    if (stat(session_file, &st) == 0) {
+        TEST_ASSERT(truncate(session_file, st.st_size - 1) == 0, "Snapshot should truncate");
+    }
+    TEST_ASSERT(session_open(session_file) == NULL, "Truncated snapshot should be rejected");
+
+    // Overwrite the magic
+    FILE *f = fopen(session_file, "r+b");
+    if (f) {
+        fputs("JUNK", f);
+        fclose(f);
+    }
+    TEST_ASSERT(session_open(session_file) == NULL, "Snapshot with a bad header should be rejected");
+
+    // A name offset outside the arena must not restore
+    FileEntry entry = dir.entries[0];
+    entry.name_offset = (uint32_t)dir.names_size + 16;
+    DirectoryState restored;
+    directory_state_init(&restored);
+    TEST_ASSERT(!directory_state_restore(&restored, dir.current_path, &entry, 1, dir.names, dir.names_size),
+                "Entries naming outside the arena should be rejected");
+    directory_state_free(&restored);
+
+    directory_state_free(&dir);
+    remove_listing_dir();
+}
+
+void test_session(void)
+{
+    test_session_round_trip();
+    test_session_damaged();
+}
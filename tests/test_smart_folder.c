@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "core/smart_folder.h"
+#include "core/fs_watch.h"
+#include "ai/path_index.h"
+
+// Test helper functions
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+// Long enough that only fs_watch_flush dispatches during a test
+#define TEST_COALESCE 60.0
+
+static char test_root[256];
+
+// Helper: Full path of a name below the test root
+static const char *at(const char *relative)
+{
+    static char path[512];
+    snprintf(path, sizeof(path), "%s/%s", test_root, relative);
+    return path;
+}
+
+static void write_file(const char *relative, int bytes)
+{
+    FILE *f = fopen(at(relative), "w");
+    if (f) {
+        for (int i = 0; i < bytes; i++) fputc('x', f);
+        fclose(f);
+    }
+}
+
+// Helper: Whether a listing has an entry with this (relative) name
+static bool listed(const DirectoryState *state, const char *name)
+{
+    for (int i = 0; i < state->count; i++) {
+        if (strcmp(directory_entry_name(state, &state->entries[i]), name) == 0) return true;
+    }
+    return false;
+}
+
+static int members(SmartFolders *folders, int index)
+{
+    SmartFolderInfo info;
+    return smart_folders_info(folders, index, &info) ? info.member_count : -1;
+}
+
+static void setup_tree(void)
+{
+    strcpy(test_root, "/tmp/finder_plus_smart_XXXXXX");
+    if (!mkdtemp(test_root)) return;
+    mkdir(at("a"), 0755);
+    mkdir(at("a/b"), 0755);
+    write_file("notes.txt", 10);
+    write_file("a/photo1.jpg", 10);
+    write_file("a/b/photo2.JPG", 10);
+    write_file("a/b/scan.raw", 4096);
+    write_file("a/tiny.raw", 10);
+}
+
+static void cleanup_tree(void)
+{
+    char cmd[300];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", test_root);
+    system(cmd);
+}
+
+static void test_smart_folder_materialize(void)
+{
+    SmartFolders *folders = smart_folders_create(NULL);
+
+    // Without an index the tree is walked once
+    int txt = smart_folders_add(folders, "Text", SMART_FOLDER_PATTERN, test_root, "*.txt");
+    TEST_ASSERT(txt == 0 && members(folders, txt) == 1, "A pattern folder should be walked into being");
+
+    // With one, only its matches are stat'ed
+    PathIndex *index = path_index_open(NULL);
+    const char *paths[] = { "", "notes.txt", "a", "a/photo1.jpg", "a/b", "a/b/photo2.JPG", "a/b/scan.raw", "a/tiny.raw" };
+    for (int i = 0; i < 8; i++) {
+        path_index_add(index, paths[i][0] ? at(paths[i]) : test_root);
+    }
+    smart_folders_set_path_index(folders, index);
+    int photos = smart_folders_add(folders, "Photos", SMART_FOLDER_FILTER, test_root, "ext:jpg photo");
+    int raws = smart_folders_add(folders, "Big raws", SMART_FOLDER_FILTER, test_root, "ext:raw size>1k");
+    TEST_ASSERT(members(folders, photos) == 2, "Filter terms and words should select from the index");
+    TEST_ASSERT(members(folders, raws) == 1, "Terms needing metadata should be checked on the matches");
+    TEST_ASSERT(smart_folders_add(folders, "Bad", SMART_FOLDER_FILTER, test_root, "size>") < 0,
+                "A query that does not compile should be refused");
+
+    DirectoryState state;
+    directory_state_init(&state);
+    TEST_ASSERT(smart_folders_open(folders, photos, &state) && state.count == 2 &&
+                listed(&state, "a/photo1.jpg") && listed(&state, "a/b/photo2.JPG"),
+                "Opening should list members by their path below the root");
+    char full[512];
+    directory_entry_path(&state, &state.entries[0], full, sizeof(full));
+    TEST_ASSERT(strncmp(full, test_root, strlen(test_root)) == 0 && access(full, F_OK) == 0,
+                "Entry paths should lead to the members");
+    TEST_ASSERT(state.entries[0].file_type == state.entries[1].file_type && state.entries[0].size == 10,
+                "Members should carry their metadata and type");
+
+    directory_state_free(&state);
+    smart_folders_destroy(folders);
+    path_index_close(index);
+}
+
+static void test_smart_folder_live(void)
+{
+    FsWatch *watch = fs_watch_create(TEST_COALESCE);
+    SmartFolders *folders = smart_folders_create(watch);
+    int photos = smart_folders_add(folders, "Photos", SMART_FOLDER_PATTERN, test_root, "*.jpg");
+    TEST_ASSERT(members(folders, photos) == 1, "Pattern matching should be case-sensitive");
+
+    DirectoryState opened;
+    directory_state_init(&opened);
+    smart_folders_open(folders, photos, &opened);
+    uint32_t generation = smart_folders_generation(folders, photos);
+
+    // New files join one by one
+    write_file("a/b/photo3.jpg", 10);
+    fs_watch_notify(watch, at("a/b/photo3.jpg"), FSEVENT_CREATED, FSEVENT_FLAG_IS_FILE);
+    fs_watch_flush(watch);
+    TEST_ASSERT(members(folders, photos) == 2, "A created match should join");
+    TEST_ASSERT(smart_folders_generation(folders, photos) != generation, "Membership changes should be seen");
+    TEST_ASSERT(opened.count == 1, "An opened copy should keep its listing");
+
+    // Modified members stay once
+    fs_watch_notify(watch, at("a/b/photo3.jpg"), FSEVENT_MODIFIED, FSEVENT_FLAG_IS_FILE);
+    fs_watch_flush(watch);
+    TEST_ASSERT(members(folders, photos) == 2, "A modified member should not be listed twice");
+
+    // A folder moved in brings its matches
+    mkdir(at("moved"), 0755);
+    write_file("moved/photo4.jpg", 10);
+    write_file("moved/photo5.jpg", 10);
+    fs_watch_notify(watch, at("moved"), FSEVENT_RENAMED, FSEVENT_FLAG_IS_DIR);
+    fs_watch_flush(watch);
+    TEST_ASSERT(members(folders, photos) == 4, "A folder moved in should be walked");
+
+    // And one going away takes them along
+    cleanup_tree();
+    fs_watch_notify(watch, at("moved"), FSEVENT_DIR_DELETED, FSEVENT_FLAG_IS_DIR);
+    fs_watch_notify(watch, at("a/photo1.jpg"), FSEVENT_DELETED, FSEVENT_FLAG_IS_FILE);
+    fs_watch_flush(watch);
+    TEST_ASSERT(members(folders, photos) == 1, "Deleted members should leave, with what was below them");
+
+    directory_state_free(&opened);
+    smart_folders_destroy(folders);
+    fs_watch_destroy(watch);
+    setup_tree();
+}
+
+static void test_smart_folder_churn(void)
+{
+    // Many members added and removed keep the name hash consistent
+    FsWatch *watch = fs_watch_create(TEST_COALESCE);
+    SmartFolders *folders = smart_folders_create(watch);
+    mkdir(at("many"), 0755);
+    char name[64];
+    for (int i = 0; i < 300; i++) {
+        snprintf(name, sizeof(name), "many/file%03d.dat", i);
+        write_file(name, 1);
+    }
+    int dats = smart_folders_add(folders, "Data", SMART_FOLDER_PATTERN, test_root, "*.dat");
+    TEST_ASSERT(members(folders, dats) == 300, "Every match should be a member");
+
+    for (int i = 0; i < 300; i += 2) {
+        snprintf(name, sizeof(name), "many/file%03d.dat", i);
+        unlink(at(name));
+        fs_watch_notify(watch, at(name), FSEVENT_DELETED, FSEVENT_FLAG_IS_FILE);
+    }
+    fs_watch_flush(watch);
+    for (int i = 1; i < 300; i += 2) {
+        snprintf(name, sizeof(name), "many/file%03d.dat", i);
+        fs_watch_notify(watch, at(name), FSEVENT_MODIFIED, FSEVENT_FLAG_IS_FILE);
+    }
+    fs_watch_flush(watch);
+
+    DirectoryState state;
+    directory_state_init(&state);
+    smart_folders_open(folders, dats, &state);
+    bool odd_only = state.count == 150;
+    for (int i = 0; i < state.count && odd_only; i++) {
+        const char *entry = directory_entry_name(&state, &state.entries[i]);
+        odd_only = (entry[strlen("many/file") + 2] - '0') % 2 == 1;
+    }
+    TEST_ASSERT(odd_only, "Removals and refreshes should leave each survivor once");
+
+    directory_state_free(&state);
+    smart_folders_destroy(folders);
+    fs_watch_destroy(watch);
+}
+
+// Fake semantic search: notes match, and files with "idea" in the name once indexed
+static int fake_query(const char *query, const char *root, char ***paths, void *context)
+{
+    (void)query; (void)context;
+    *paths = malloc(sizeof(char *));
+    char path[512];
+    snprintf(path, sizeof(path), "%s/notes.txt", root);
+    (*paths)[0] = strdup(path);
+    return 1;
+}
+
+static bool fake_match(const char *path, const char *query, void *context)
+{
+    (void)query; (void)context;
+    return strstr(path, "idea") != NULL;
+}
+
+static void test_smart_folder_semantic(void)
+{
+    SmartFolders *folders = smart_folders_create(NULL);
+    int ideas = smart_folders_add(folders, "Ideas", SMART_FOLDER_SEMANTIC, test_root, "project ideas");
+    DirectoryState state;
+    directory_state_init(&state);
+    TEST_ASSERT(!smart_folders_open(folders, ideas, &state), "Without search a semantic folder should wait");
+
+    SmartFolderSemantic semantic = { fake_query, fake_match, NULL };
+    smart_folders_set_semantic(folders, &semantic);
+    TEST_ASSERT(members(folders, ideas) == 1, "Search results should become members");
+
+    write_file("idea.txt", 5);
+    smart_folders_indexed(folders, at("idea.txt"));
+    smart_folders_indexed(folders, at("a/photo1.jpg"));
+    TEST_ASSERT(members(folders, ideas) == 2, "Indexed files should be matched as they arrive");
+
+    // Definitions survive a save and load
+    char file[300];
+    snprintf(file, sizeof(file), "%s/smart_folders", test_root);
+    smart_folders_add(folders, "Photos", SMART_FOLDER_FILTER, test_root, "ext:jpg");
+    TEST_ASSERT(smart_folders_save(folders, file), "Definitions should save");
+    SmartFolders *loaded = smart_folders_create(NULL);
+    SmartFolderInfo info;
+    TEST_ASSERT(smart_folders_load(loaded, file) == 2 && smart_folders_info(loaded, 1, &info) &&
+                info.kind == SMART_FOLDER_FILTER && strcmp(info.query, "ext:jpg") == 0 && info.ready,
+                "Definitions should load and materialize again");
+    TEST_ASSERT(smart_folders_remove(loaded, 0) && smart_folders_count(loaded) == 1, "Folders should be removable");
+
+    smart_folders_destroy(loaded);
+    directory_state_free(&state);
+    smart_folders_destroy(folders);
+}
+
+void test_smart_folder(void)
+{
+    setup_tree();
+    test_smart_folder_materialize();
+    test_smart_folder_live();
+    test_smart_folder_churn();
+    test_smart_folder_semantic();
+    cleanup_tree();
+}
@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/spotlight_search.h"
+
+// Test helper functions
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#define NOW ((time_t)1700000000)
+
+// Helper: Spotlight query for names and a filter typed as a search
+static bool build(const char *text, const char *glob, char *query, size_t size)
+{
+    FilterQuery filter;
+    filter_query_compile(&filter, text, NOW);
+    return spotlight_search_query(filter.text[0] ? filter.text : NULL, glob, &filter, query, size);
+}
+
+static void test_spotlight_search_names(void)
+{
+    char query[4096];
+    TEST_ASSERT(build("report final", NULL, query, sizeof(query)) &&
+                strcmp(query, "kMDItemFSName == \"*report*\"cd && kMDItemFSName == \"*final*\"cd") == 0,
+                "Every name term should have to be in the name");
+    TEST_ASSERT(!build("src/main", NULL, query, sizeof(query)), "Path terms should be left to the path index");
+    TEST_ASSERT(!build(".zshrc", NULL, query, sizeof(query)), "Hidden names should be left to the path index");
+    TEST_ASSERT(!build("a\"b", NULL, query, sizeof(query)), "Quotes should not reach the query");
+
+    TEST_ASSERT(build("", "*.c", query, sizeof(query)) && strcmp(query, "kMDItemFSName == \"*.c\"c") == 0,
+                "A glob should match names");
+    TEST_ASSERT(build("", "img_??[0-9].*", query, sizeof(query)) &&
+                strcmp(query, "kMDItemFSName == \"img_*.*\"c") == 0,
+                "Single characters and sets should widen to '*'");
+    TEST_ASSERT(!build("", "*", query, sizeof(query)), "A glob matching everything should not narrow");
+    TEST_ASSERT(!build("", ".*", query, sizeof(query)), "Hidden globs should be left to the walk");
+}
+
+static void test_spotlight_search_filters(void)
+{
+    char query[4096];
+    TEST_ASSERT(build("ext:jpg,png", NULL, query, sizeof(query)) &&
+                strcmp(query, "(kMDItemFSName == \"*.jpg\"c || kMDItemFSName == \"*.png\"c)") == 0,
+                "Extensions should be alternatives");
+    TEST_ASSERT(build("kind:image", NULL, query, sizeof(query)) && strstr(query, "\"*.jpg\"c") &&
+                strstr(query, "\"*.png\"c") && !strstr(query, "\"*.mp4\"c"),
+                "A kind should list the extensions of its class");
+    TEST_ASSERT(build("kind:folder", NULL, query, sizeof(query)) &&
+                strcmp(query, "(kMDItemContentTypeTree == \"public.directory\")") == 0,
+                "Folders should go by content type");
+    TEST_ASSERT(build("size>1k", NULL, query, sizeof(query)) && strcmp(query, "kMDItemFSSize >= 1025") == 0,
+                "A size should bound kMDItemFSSize");
+    TEST_ASSERT(build("modified>2024-01-31", NULL, query, sizeof(query)) &&
+                strstr(query, "kMDItemFSContentChangeDate >= $time.iso(2024-0") && !strstr(query, "<="),
+                "A date should bound the content change date");
+    TEST_ASSERT(build("notes -ext:log git:modified", NULL, query, sizeof(query)) &&
+                strcmp(query, "kMDItemFSName == \"*notes*\"cd") == 0,
+                "Negated and git terms should be left to the checks on each path");
+    TEST_ASSERT(!build("git:modified", NULL, query, sizeof(query)), "A query that narrows nothing should fail");
+    TEST_ASSERT(!build("is:hidden", NULL, query, sizeof(query)), "Hidden files should be left to our own index");
+
+    char small[16];
+    TEST_ASSERT(!build("kind:image", NULL, small, sizeof(small)), "A query that does not fit should fail");
+}
+
+void test_spotlight_search(void)
+{
+    test_spotlight_search_names();
+    test_spotlight_search_filters();
+}
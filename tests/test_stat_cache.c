@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#include "../src/core/stat_cache.h"
+#include "../src/core/fs_watch.h"
+
+static void write_file(const char *path, const char *content)
+{
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fputs(content, f);
+        fclose(f);
+    }
+}
+
+void test_stat_cache(void)
+{
+    // Events name real paths, so the fixture lives at one (/tmp is a symlink on macOS)
+    char template[] = "/tmp/stat_cache_XXXXXX";
+    char dir[PATH_MAX];
+    if (!mkdtemp(template) || !realpath(template, dir)) {
+        TEST_ASSERT(false, "Should create a fixture directory");
+        return;
+    }
+    char file[PATH_MAX + 16];
+    char sub[PATH_MAX + 16];
+    char nested[PATH_MAX + 32];
+    char link[PATH_MAX + 16];
+    char dir_link[PATH_MAX + 16];
+    char through_link[PATH_MAX + 32];
+    snprintf(file, sizeof(file), "%s/a.txt", dir);
+    snprintf(sub, sizeof(sub), "%s/sub", dir);
+    snprintf(nested, sizeof(nested), "%s/sub/b.txt", dir);
+    snprintf(link, sizeof(link), "%s/link", dir);
+    snprintf(dir_link, sizeof(dir_link), "%s/dirlink", dir);
+    snprintf(through_link, sizeof(through_link), "%s/dirlink/a.txt", dir);
+    write_file(file, "12345");
+    mkdir(sub, 0755);
+    write_file(nested, "1");
+    symlink(file, link);
+    symlink(dir, dir_link);
+
+    struct stat st;
+
+    // Test: without a stream every call is the syscall
+    {
+        StatCacheStats before = stat_cache_get_stats();
+        TEST_ASSERT(stat_cache_lstat(file, &st) && st.st_size == 5, "Should stat while not caching");
+        stat_cache_lstat(file, &st);
+        StatCacheStats after = stat_cache_get_stats();
+        TEST_ASSERT(after.hits == before.hits && after.entries == 0, "Should not cache without a stream");
+        TEST_ASSERT(!stat_cache_lstat("/nonexistent/stat_cache", &st), "Missing path should fail");
+    }
+
+    stat_cache_begin();
+
+    // Test: the second lookup is served from the cache until the path is invalidated
+    {
+        StatCacheStats before = stat_cache_get_stats();
+        stat_cache_lstat(file, &st);
+        TEST_ASSERT(stat_cache_lstat(file, &st) && st.st_size == 5, "Should return the attributes");
+        StatCacheStats after = stat_cache_get_stats();
+        TEST_ASSERT(after.hits == before.hits + 1, "Second lookup should hit");
+        TEST_ASSERT(after.bytes > 0, "Should account for its entries");
+
+        write_file(file, "1234567");
+        stat_cache_invalidate(file, false);
+        TEST_ASSERT(stat_cache_lstat(file, &st) && st.st_size == 7, "Invalidated path should be read again");
+    }
+
+    // Test: a reported change drops the entry as it is queued, before any dispatch
+    {
+        FsWatch *watch = fs_watch_create(FS_WATCH_DEFAULT_COALESCE);
+        stat_cache_lstat(file, &st);
+        write_file(file, "123");
+        fs_watch_notify(watch, file, FSEVENT_MODIFIED, 0);
+        TEST_ASSERT(stat_cache_lstat(file, &st) && st.st_size == 3, "Reported change should drop the entry");
+        fs_watch_destroy(watch);
+    }
+
+    // Test: a directory that moved or went away takes everything below it
+    {
+        stat_cache_lstat(nested, &st);
+        StatCacheStats before = stat_cache_get_stats();
+        stat_cache_invalidate(sub, true);
+        stat_cache_lstat(nested, &st);
+        StatCacheStats after = stat_cache_get_stats();
+        TEST_ASSERT(after.misses == before.misses + 1, "Subtree invalidation should drop children");
+    }
+
+    // Test: symlink targets are followed every time
+    {
+        TEST_ASSERT(stat_cache_stat(link, &st) && S_ISREG(st.st_mode), "stat should follow the link");
+        write_file(file, "123456789");
+        stat_cache_invalidate(file, false);
+        TEST_ASSERT(stat_cache_stat(link, &st) && st.st_size == 9, "Target change should show through the link");
+        TEST_ASSERT(stat_cache_lstat(link, &st) && S_ISLNK(st.st_mode), "lstat should describe the link");
+    }
+
+    // Test: paths through a symlinked directory are never cached (events name the real path)
+    {
+        stat_cache_lstat(through_link, &st);
+        StatCacheStats before = stat_cache_get_stats();
+        TEST_ASSERT(stat_cache_lstat(through_link, &st) && st.st_size == 9, "Should stat through the link");
+        StatCacheStats after = stat_cache_get_stats();
+        TEST_ASSERT(after.hits == before.hits, "Path below a symlink should not be cached");
+    }
+
+    // Test: trimming and the end of the stream empty it
+    {
+        stat_cache_trim(0);
+        TEST_ASSERT(stat_cache_get_stats().entries == 0, "Trim to zero should drop every entry");
+        stat_cache_lstat(file, &st);
+        stat_cache_end();
+        TEST_ASSERT(stat_cache_get_stats().entries == 0 && stat_cache_bytes() == 0,
+                    "Last end should empty the cache");
+    }
+
+    unlink(dir_link);
+    unlink(link);
+    unlink(nested);
+    rmdir(sub);
+    unlink(file);
+    rmdir(dir);
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#include "../src/utils/hash.h"
+#include "../src/utils/string_set.h"
+
+#define NAME_COUNT 1000
+
+static const char *name_key(const void *list, int index)
+{
+    return ((const char (*)[16])list)[index];
+}
+
+void test_string_set(void)
+{
+    // Test: the hashes are FNV-1a, whose values name files on disk
+    {
+        TEST_ASSERT(hash_fnv1a("") == HASH_FNV1A_INIT, "Empty string should hash to the offset basis");
+        TEST_ASSERT(hash_fnv1a("a") == 0xe40c292cu, "32-bit hash should match the reference value");
+        TEST_ASSERT(hash_fnv1a64_string(HASH_FNV1A64_INIT, "a") == 0xaf63dc4c8601ec8cULL,
+                    "64-bit hash should match the reference value");
+        TEST_ASSERT(hash_fnv1a_bytes(hash_fnv1a_bytes(HASH_FNV1A_INIT, "fo", 2), "o", 1) == hash_fnv1a("foo"),
+                    "Chained hashes should equal one pass");
+    }
+
+    static char names[NAME_COUNT][16];
+    StringSet set;
+    string_set_init(&set);
+
+    // Test: every string added is found at its index, past several growths
+    {
+        TEST_ASSERT(string_set_find(&set, "x", 1, name_key, names) == -1, "An empty set should find nothing");
+        bool added = true;
+        for (int i = 0; i < NAME_COUNT; i++) {
+            snprintf(names[i], sizeof(names[i]), "name%d", i);
+            added = added && string_set_add(&set, i, names[i], strlen(names[i]));
+        }
+        TEST_ASSERT(added && set.count == NAME_COUNT, "Every string should be added");
+        TEST_ASSERT(set.slot_count >= 2 * NAME_COUNT, "The set should stay at most half full");
+
+        bool found = true;
+        for (int i = 0; i < NAME_COUNT; i++) {
+            found = found && string_set_find(&set, names[i], strlen(names[i]), name_key, names) == i;
+        }
+        TEST_ASSERT(found, "Every string should be found at its index");
+    }
+
+    // Test: lookups take a length, so a prefix of a longer string can be asked for
+    {
+        const char *text = "name12345";
+        TEST_ASSERT(string_set_find(&set, text, 6, name_key, names) == 12, "A length-bounded lookup should match");
+        TEST_ASSERT(string_set_find(&set, text, 9, name_key, names) == -1, "A string not added should not match");
+        TEST_ASSERT(string_set_find(&set, "name", 4, name_key, names) == -1, "A prefix of a member should not match");
+    }
+
+    // Test: clear forgets every string
+    {
+        string_set_clear(&set);
+        TEST_ASSERT(set.count == 0 && string_set_find(&set, "name1", 5, name_key, names) == -1,
+                    "A cleared set should find nothing");
+        TEST_ASSERT(string_set_add(&set, 7, names[7], strlen(names[7])) &&
+                    string_set_find(&set, "name7", 5, name_key, names) == 7,
+                    "A cleared set should take strings again");
+    }
+
+    string_set_free(&set);
+    TEST_ASSERT(set.slots == NULL && set.slot_count == 0, "Free should drop the slots");
+}
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils/syntax.h"
+
+// Test helper functions
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#define TEST_ASSERT_EQ(expected, actual, message) do { \
+    inc_tests_run(); \
+    if ((expected) == (actual)) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s - expected %d, got %d (line %d)\n", message, (int)(expected), (int)(actual), __LINE__); \
+    } \
+} while(0)
+
+// Helper: Kind of the span covering byte at, SYNTAX_PLAIN if none
+static int kind_at(const SyntaxSpan *spans, int count, int at)
+{
+    for (int i = 0; i < count; i++) {
+        if (at >= spans[i].start && at < spans[i].start + spans[i].len) return spans[i].kind;
+    }
+    return SYNTAX_PLAIN;
+}
+
+// Helper: Tokenize a line
+static int tokenize(SyntaxLanguage language, const char *line, uint8_t *state, SyntaxSpan *spans)
+{
+    return syntax_tokenize_line(language, line, strlen(line), state, spans, SYNTAX_MAX_SPANS, SYNTAX_LINE_BYTES);
+}
+
+// Helper: Poll a highlighter for up to five seconds
+static int wait_spans(SyntaxHighlighter *h, int line, SyntaxSpan *spans)
+{
+    for (int i = 0; i < 500; i++) {
+        int count = syntax_line_spans(h, line, spans, SYNTAX_MAX_SPANS);
+        if (count >= 0) return count;
+        usleep(10000);
+    }
+    return -1;
+}
+
+void test_syntax(void)
+{
+    SyntaxSpan spans[SYNTAX_MAX_SPANS];
+    uint8_t state = 0;
+
+    // Test: language detection
+    TEST_ASSERT_EQ(SYNTAX_C, syntax_language_for_extension("c"), "c uses the C tokenizer");
+    TEST_ASSERT_EQ(SYNTAX_C_LIKE, syntax_language_for_extension("RS"), "Extensions are case-insensitive");
+    TEST_ASSERT_EQ(SYNTAX_PYTHON, syntax_language_for_extension("py"), "py uses the Python tokenizer");
+    TEST_ASSERT_EQ(SYNTAX_NONE, syntax_language_for_extension("txt"), "txt is not highlighted");
+
+    // Test: C tokens
+    {
+        const char *line = "return x + 42; // \"done\"";
+        state = 0;
+        int count = tokenize(SYNTAX_C, line, &state, spans);
+        TEST_ASSERT_EQ(SYNTAX_KEYWORD, kind_at(spans, count, 0), "return is a keyword");
+        TEST_ASSERT_EQ(SYNTAX_PLAIN, kind_at(spans, count, 7), "Identifiers are plain");
+        TEST_ASSERT_EQ(SYNTAX_NUMBER, kind_at(spans, count, 11), "42 is a number");
+        TEST_ASSERT_EQ(SYNTAX_COMMENT, kind_at(spans, count, 20), "Strings in comments are comment");
+        TEST_ASSERT_EQ(0, state, "A line comment ends with the line");
+
+        line = "char *s = \"a \\\" b\"; int x2;";
+        count = tokenize(SYNTAX_C, line, &state, spans);
+        TEST_ASSERT_EQ(SYNTAX_STRING, kind_at(spans, count, 15), "Escaped quotes stay inside strings");
+        TEST_ASSERT_EQ(SYNTAX_KEYWORD, kind_at(spans, count, 20), "Tokens after a string are found");
+        TEST_ASSERT_EQ(SYNTAX_PLAIN, kind_at(spans, count, 25), "Digits inside identifiers are plain");
+
+        count = tokenize(SYNTAX_C, "  #include <stdio.h> /* a", &state, spans);
+        TEST_ASSERT_EQ(SYNTAX_PREPROCESSOR, kind_at(spans, count, 2), "Directives are preprocessor");
+        TEST_ASSERT_EQ(SYNTAX_COMMENT, kind_at(spans, count, 22), "A directive's comment is comment");
+        TEST_ASSERT(state != 0, "An open block comment carries over");
+
+        count = tokenize(SYNTAX_C, "still */ int", &state, spans);
+        TEST_ASSERT_EQ(SYNTAX_COMMENT, kind_at(spans, count, 0), "The next line starts in the comment");
+        TEST_ASSERT_EQ(SYNTAX_KEYWORD, kind_at(spans, count, 9), "Tokens after the comment are found");
+        TEST_ASSERT_EQ(0, state, "The comment closes");
+    }
+
+    // Test: Python triple-quoted strings span lines
+    {
+        state = 0;
+        int count = tokenize(SYNTAX_PYTHON, "def f(): \"\"\"doc", &state, spans);
+        TEST_ASSERT_EQ(SYNTAX_KEYWORD, kind_at(spans, count, 0), "def is a keyword");
+        TEST_ASSERT_EQ(SYNTAX_STRING, kind_at(spans, count, 12), "A docstring is a string");
+        count = tokenize(SYNTAX_PYTHON, "more\"\"\" # note", &state, spans);
+        TEST_ASSERT_EQ(SYNTAX_STRING, kind_at(spans, count, 0), "The docstring continues");
+        TEST_ASSERT_EQ(SYNTAX_COMMENT, kind_at(spans, count, 9), "# starts a comment");
+        TEST_ASSERT_EQ(0, state, "The docstring closes");
+    }
+
+    // Test: diff and log lines
+    {
+        state = 0;
+        int count = tokenize(SYNTAX_DIFF, "@@ -1,3 +1,4 @@ static int f(void)", &state, spans);
+        TEST_ASSERT_EQ(SYNTAX_KEYWORD, kind_at(spans, count, 3), "A hunk range is marked");
+        TEST_ASSERT_EQ(SYNTAX_PLAIN, kind_at(spans, count, 20), "The hunk's function is plain");
+        count = tokenize(SYNTAX_DIFF, "+/* added", &state, spans);
+        TEST_ASSERT_EQ(SYNTAX_INSERTED, kind_at(spans, count, 5), "Added lines are inserted");
+        TEST_ASSERT_EQ(0, state, "Diff lines carry nothing over");
+        count = tokenize(SYNTAX_DIFF, "--- a/file.c", &state, spans);
+        TEST_ASSERT_EQ(SYNTAX_PREPROCESSOR, kind_at(spans, count, 6), "File headers are not removed lines");
+        count = tokenize(SYNTAX_DIFF, "-gone", &state, spans);
+        TEST_ASSERT_EQ(SYNTAX_DELETED, kind_at(spans, count, 1), "Removed lines are deleted");
+        count = tokenize(SYNTAX_DIFF, "commit 1a2b3c4", &state, spans);
+        TEST_ASSERT_EQ(SYNTAX_NUMBER, kind_at(spans, count, 8), "A log's commit id is marked");
+    }
+
+    // Test: spans past the limit are dropped, state is still tracked
+    {
+        state = 0;
+        int count = syntax_tokenize_line(SYNTAX_C, "int a; /* x", 11, &state, spans, SYNTAX_MAX_SPANS, 4);
+        TEST_ASSERT_EQ(1, count, "Only spans within the limit are kept");
+        TEST_ASSERT(state != 0, "State is tracked past the limit");
+    }
+
+    // Test: background highlighting from a kept state
+    {
+        size_t cap = 64 * 1024;
+        char *text = malloc(cap);
+        size_t size = 0;
+        size += (size_t)snprintf(text + size, cap - size, "/* opening\n");
+        for (int i = 0; i < 300; i++) {
+            size += (size_t)snprintf(text + size, cap - size, "comment line %d\n", i);
+        }
+        size += (size_t)snprintf(text + size, cap - size, "*/ int x = 1;\n");
+        for (int i = 0; i < 300; i++) {
+            size += (size_t)snprintf(text + size, cap - size, "return %d;\n", i);
+        }
+
+        SyntaxHighlighter *h = syntax_create(text, size, SYNTAX_C);
+        TEST_ASSERT(h != NULL, "Should create a highlighter");
+        TEST_ASSERT_EQ(-1, syntax_line_spans(h, 200, spans, SYNTAX_MAX_SPANS), "Lines are not ready before they are asked for");
+
+        syntax_request(h, 200, 20);
+        int count = wait_spans(h, 200, spans);
+        TEST_ASSERT(count == 1 && spans[0].kind == SYNTAX_COMMENT, "A line deep in a block comment is comment");
+
+        syntax_request(h, 500, 20);
+        count = wait_spans(h, 500, spans);
+        TEST_ASSERT(count >= 1 && spans[0].kind == SYNTAX_KEYWORD, "Lines after the comment are code");
+        TEST_ASSERT(syntax_line_spans(h, 520, spans, SYNTAX_MAX_SPANS) >= 0 ||
+                    syntax_is_busy(h), "Lines past the viewport are highlighted as a margin");
+
+        syntax_request(h, 100000, 20);
+        for (int i = 0; i < 500 && syntax_is_busy(h); i++) usleep(10000);
+        TEST_ASSERT(!syntax_is_busy(h), "A request past the end finishes");
+
+        syntax_destroy(h);
+        free(text);
+    }
+}
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "core/text_map.h"
+
+// Test helper functions
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#define TEST_ASSERT_EQ(expected, actual, message) do { \
+    inc_tests_run(); \
+    if ((expected) == (actual)) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s - expected %d, got %d (line %d)\n", message, (int)(expected), (int)(actual), __LINE__); \
+    } \
+} while(0)
+
+static const char *test_file = "/tmp/finder_plus_text_map_test.txt";
+
+// Helper: Wait up to five seconds for the index to finish
+static int wait_indexed(TextMap *map)
+{
+    bool complete = false;
+    int count = 0;
+    for (int i = 0; i < 500 && !complete; i++) {
+        count = text_map_line_count(map, &complete);
+        if (!complete) usleep(10000);
+    }
+    return complete ? count : -1;
+}
+
+// Helper: Whether a line reads back as expected
+static bool line_is(TextMap *map, int line, const char *expected)
+{
+    const char *start;
+    size_t len;
+    if (!text_map_line(map, line, &start, &len, 256)) {
+        return false;
+    }
+    return len == strlen(expected) && memcmp(start, expected, len) == 0;
+}
+
+void test_text_map(void)
+{
+    // Test: lines across several index chunks and checkpoints
+    {
+        FILE *f = fopen(test_file, "w");
+        int lines = 0;
+        for (long written = 0; written < 3L * TEXT_MAP_CHUNK; lines++) {
+            written += fprintf(f, "line %d\n", lines);
+        }
+        fprintf(f, "last");
+        fclose(f);
+
+        TextMap *map = text_map_open(test_file);
+        TEST_ASSERT(map != NULL, "Should map a text file");
+        TEST_ASSERT_EQ(lines + 1, wait_indexed(map), "Should count every line");
+
+        char expected[32];
+        bool all_match = true;
+        int probes[] = { 0, 1, TEXT_MAP_STRIDE - 1, TEXT_MAP_STRIDE, TEXT_MAP_STRIDE + 1, lines / 2, lines - 1 };
+        for (size_t i = 0; i < sizeof(probes) / sizeof(probes[0]); i++) {
+            snprintf(expected, sizeof(expected), "line %d", probes[i]);
+            all_match &= line_is(map, probes[i], expected);
+        }
+        TEST_ASSERT(all_match, "Should find lines on and between indexed lines");
+        TEST_ASSERT(line_is(map, lines, "last"), "Should read a last line without a newline");
+
+        // Stepping backwards past the remembered line
+        TEST_ASSERT(line_is(map, 2, "line 2"), "Should find a line before the last one found");
+
+        const char *start;
+        size_t len;
+        TEST_ASSERT(!text_map_line(map, lines + 1, &start, &len, 256), "Should not find lines past the end");
+        TEST_ASSERT(text_map_line(map, 123, &start, &len, 4) && len == 4, "Should cut lines at max_len");
+
+        text_map_close(map);
+    }
+
+    // Test: stepping by byte offset, and numbering lines ahead of the index
+    {
+        FILE *f = fopen(test_file, "w");
+        int lines = 0;
+        for (long written = 0; written < 2L * TEXT_MAP_CHUNK; lines++) {
+            written += fprintf(f, "line %d\n", lines);
+        }
+        fclose(f);
+
+        TextMap *map = text_map_open(test_file);
+        const char *data = text_map_data(map);
+        size_t offset = text_map_step(map, 0, 1000);
+        TEST_ASSERT(strncmp(data + offset, "line 1000\n", 10) == 0, "Should step forward by lines");
+        TEST_ASSERT_EQ(offset, text_map_step(map, offset + 3, 0), "Should step to the start of a line");
+        offset = text_map_step(map, offset, -999);
+        TEST_ASSERT(strncmp(data + offset, "line 1\n", 7) == 0, "Should step back by lines");
+        TEST_ASSERT_EQ(0, text_map_step(map, offset, -5), "Should stop at the first line");
+        TEST_ASSERT_EQ(text_map_size(map), text_map_step(map, 0, lines + 10), "Should stop at the last line");
+
+        // Estimates are only promised ahead of the index; once it is done, counts are exact
+        bool exact = false;
+        wait_indexed(map);
+        offset = text_map_step(map, 0, lines - 7);
+        TEST_ASSERT_EQ(lines - 7, text_map_line_at(map, offset + 2, &exact), "Should number a line from the index");
+        TEST_ASSERT(exact, "A line in an indexed file should be numbered exactly");
+        text_map_close(map);
+    }
+
+    // Test: a single line longer than the checkpoint spacing
+    {
+        FILE *f = fopen(test_file, "w");
+        for (int i = 0; i < TEXT_MAP_CHECKPOINT_BYTES * 3; i++) fputc('x', f);
+        fprintf(f, "\nshort\n");
+        fclose(f);
+
+        TextMap *map = text_map_open(test_file);
+        TEST_ASSERT_EQ(3, wait_indexed(map), "Should count a very long line once");
+        TEST_ASSERT(line_is(map, 1, "short"), "Should find the line after a long one");
+        TEST_ASSERT(line_is(map, 2, ""), "Should find the empty line after a trailing newline");
+        text_map_close(map);
+    }
+
+    // Test: an empty file and a missing one
+    {
+        FILE *f = fopen(test_file, "w");
+        fclose(f);
+
+        TextMap *map = text_map_open(test_file);
+        TEST_ASSERT(map != NULL, "Should open an empty file");
+        bool complete = false;
+        TEST_ASSERT_EQ(1, text_map_line_count(map, &complete), "An empty file should have one line");
+        TEST_ASSERT(complete, "An empty file should be indexed at once");
+        TEST_ASSERT(line_is(map, 0, ""), "The line of an empty file should be empty");
+        text_map_close(map);
+
+        TEST_ASSERT(text_map_open("/nonexistent/file.txt") == NULL, "Should fail for a missing file");
+    }
+
+    unlink(test_file);
+}
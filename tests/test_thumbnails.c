@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ui/thumbnails.h"
+#include "ui/video.h"
+
+// Import test macros
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+void test_thumbnails(void)
+{
+    // Test 1: Image extensions get thumbnails, others do not
+    TEST_ASSERT(thumbnails_is_supported("jpg"), "jpg is supported");
+    TEST_ASSERT(thumbnails_is_supported("PNG"), "PNG (uppercase) is supported");
+    TEST_ASSERT(thumbnails_is_supported("heic"), "heic is supported");
+    TEST_ASSERT(!thumbnails_is_supported("txt"), "txt is not supported");
+    TEST_ASSERT(thumbnails_is_supported("mp4"), "mp4 is supported (by its sprite sheet)");
+    TEST_ASSERT(!thumbnails_is_supported(""), "empty extension is not supported");
+    TEST_ASSERT(!thumbnails_is_supported(NULL), "NULL extension is not supported");
+
+    // Test 2: Cache path is deterministic and keyed on the file version
+    char path1[4096], path2[4096], path3[4096], path4[4096];
+    thumbnails_cache_path("/photos/a.jpg", 1000, 5000, path1, sizeof(path1));
+    thumbnails_cache_path("/photos/a.jpg", 1000, 5000, path2, sizeof(path2));
+    thumbnails_cache_path("/photos/a.jpg", 1001, 5000, path3, sizeof(path3));
+    thumbnails_cache_path("/photos/a.jpg", 1000, 5001, path4, sizeof(path4));
+    TEST_ASSERT(path1[0] != '\0' && strcmp(path1, path2) == 0, "Same version gives same cache path");
+    TEST_ASSERT(strcmp(path1, path3) != 0, "Changed mtime gives a new cache path");
+    TEST_ASSERT(strcmp(path1, path4) != 0, "Changed size gives a new cache path");
+    TEST_ASSERT(strstr(path1, THUMB_CACHE_DIR) != NULL, "Cache path is in the thumbnail directory");
+
+    // Test 3: NULL handling in cache path
+    path4[0] = 'X';
+    thumbnails_cache_path(NULL, 0, 0, path4, sizeof(path4));
+    TEST_ASSERT(path4[0] == '\0', "NULL path returns empty cache path");
+    thumbnails_cache_path("/photos/a.jpg", 0, 0, NULL, 0);  // Should not crash
+    TEST_ASSERT(1, "NULL buffer handling does not crash");
+
+    // Test 4: Decode fits the thumbnail size and keeps the aspect ratio
+    char image_path[] = "/tmp/finder_plus_thumb_XXXXXX";
+    int fd = mkstemp(image_path);
+    TEST_ASSERT(fd >= 0, "Create temp image file");
+    if (fd >= 0) {
+        close(fd);
+        char png_path[64];
+        snprintf(png_path, sizeof(png_path), "%s.png", image_path);
+        unlink(image_path);
+
+        Image source = GenImageColor(200, 100, (Color){ 255, 0, 0, 255 });
+        int data_size = 0;
+        unsigned char *data = ExportImageToMemory(source, ".png", &data_size);
+        UnloadImage(source);
+        FILE *f = fopen(png_path, "wb");
+        if (f && data) {
+            fwrite(data, 1, (size_t)data_size, f);
+        }
+        if (f) fclose(f);
+        MemFree(data);
+
+        unsigned char *pixels = NULL;
+        int width = 0, height = 0;
+        bool ok = thumbnails_decode(png_path, 1000, data_size, &pixels, &width, &height);
+        TEST_ASSERT(ok && pixels != NULL, "Decode a PNG");
+        TEST_ASSERT(width == THUMB_SIZE && height == THUMB_SIZE / 2, "Thumbnail fits THUMB_SIZE with aspect ratio");
+        TEST_ASSERT(pixels && pixels[0] == 255 && pixels[1] == 0 && pixels[3] == 255, "Thumbnail pixels are RGBA");
+        free(pixels);
+
+        // A second decode comes from the disk cache
+        char cache_path[4096];
+        thumbnails_cache_path(png_path, 1000, data_size, cache_path, sizeof(cache_path));
+        TEST_ASSERT(access(cache_path, F_OK) == 0, "Thumbnail is stored in the disk cache");
+        pixels = NULL;
+        ok = thumbnails_decode(png_path, 1000, data_size, &pixels, &width, &height);
+        TEST_ASSERT(ok && width == THUMB_SIZE, "Decode from the disk cache");
+        free(pixels);
+
+        unlink(cache_path);
+        unlink(png_path);
+    }
+
+    // Test 5: Missing files fail cleanly
+    unsigned char *pixels = (unsigned char *)1;
+    int width = 0, height = 0;
+    TEST_ASSERT(!thumbnails_decode("/nonexistent/photo.png", 0, 0, &pixels, &width, &height),
+                "Missing file does not decode");
+    TEST_ASSERT(pixels == NULL, "Missing file leaves no pixels");
+
+    // Test 6: Hover position picks a sprite-sheet frame, in reading order
+    int sheet_w = VIDEO_SPRITE_COLUMNS * 160, sheet_h = VIDEO_SPRITE_ROWS * 90;
+    Rectangle first = thumbnails_sprite_frame(sheet_w, sheet_h, 0.0f);
+    TEST_ASSERT(first.x == 0 && first.y == 0 && first.width == 160 && first.height == 90,
+                "Left edge shows the first frame");
+    Rectangle second_row = thumbnails_sprite_frame(sheet_w, sheet_h,
+                                                   (VIDEO_SPRITE_COLUMNS + 0.5f) / VIDEO_SPRITE_FRAMES);
+    TEST_ASSERT(second_row.x == 0 && second_row.y == 90, "Frames wrap to the next row");
+    Rectangle last = thumbnails_sprite_frame(sheet_w, sheet_h, 1.0f);
+    TEST_ASSERT(last.x == sheet_w - 160 && last.y == sheet_h - 90, "Right edge shows the last frame");
+    Rectangle outside = thumbnails_sprite_frame(sheet_w, sheet_h, -0.5f);
+    TEST_ASSERT(outside.x == 0 && outside.y == 0, "Positions outside the item are clamped");
+    TEST_ASSERT(video_sprite_frame(0.99f) == VIDEO_SPRITE_FRAMES - 1, "Last frame covers the right edge");
+}
@@ -251,6 +251,282 @@ static void test_execute_file_search(void)
     tool_registry_destroy(registry);
 }
 
+static void test_execute_file_search_recursive(void)
+{
+    ToolRegistry *registry = tool_registry_create();
+    tool_registry_register_file_tools(registry);
+    ToolExecutor *executor = tool_executor_create(registry);
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/subdir/nested.txt", test_dir);
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fclose(f);
+    }
+
+    // Direct children only
+    char input[512];
+    snprintf(input, sizeof(input), "{\"path\": \"%s\", \"pattern\": \"*.txt\"}", test_dir);
+    ToolResult result = tool_executor_execute(executor, "file_search", input);
+    TEST_ASSERT(result.success == true, "file_search succeeds");
+    if (result.output) {
+        TEST_ASSERT(strstr(result.output, "nested.txt") == NULL, "Non-recursive search skips subfolders");
+        cJSON *output = cJSON_Parse(result.output);
+        TEST_ASSERT(cJSON_IsFalse(cJSON_GetObjectItem(output, "truncated")), "Small search is not truncated");
+        cJSON_Delete(output);
+    }
+    tool_result_cleanup(&result);
+
+    // Whole tree, with a trailing slash on the root
+    snprintf(input, sizeof(input), "{\"path\": \"%s/\", \"pattern\": \"*.txt\", \"recursive\": true}", test_dir);
+    result = tool_executor_execute(executor, "file_search", input);
+    TEST_ASSERT(result.success == true, "Recursive file_search succeeds");
+    TEST_ASSERT(result.output != NULL && strstr(result.output, path) != NULL, "Recursive search finds nested file");
+    TEST_ASSERT(result.output != NULL && strstr(result.output, "file1.txt") != NULL, "Recursive search keeps top-level matches");
+    tool_result_cleanup(&result);
+
+    unlink(path);
+    tool_executor_destroy(executor);
+    tool_registry_destroy(registry);
+}
+
+static void test_execute_content_search(void)
+{
+    ToolRegistry *registry = tool_registry_create();
+    tool_registry_register_file_tools(registry);
+    ToolExecutor *executor = tool_executor_create(registry);
+
+    TEST_ASSERT(tool_registry_find(registry, "content_search") != NULL, "content_search is registered");
+    TEST_ASSERT(tool_executor_is_read_only("content_search"), "content_search is read-only");
+
+    char input[512];
+    snprintf(input, sizeof(input), "{\"path\": \"%s\", \"pattern\": \"CONTENT 2\"}", test_dir);
+    ToolResult result = tool_executor_execute(executor, "content_search", input);
+    TEST_ASSERT(result.success == true, "content_search succeeds");
+    if (result.output) {
+        cJSON *output = cJSON_Parse(result.output);
+        cJSON *matches = cJSON_GetObjectItem(output, "matches");
+        cJSON *first = cJSON_GetArrayItem(matches, 0);
+        TEST_ASSERT(cJSON_GetArraySize(matches) == 1, "content_search finds one line, ignoring case");
+        TEST_ASSERT(first && strstr(cJSON_GetObjectItem(first, "path")->valuestring, "file2.txt") != NULL &&
+                    cJSON_GetObjectItem(first, "line")->valueint == 1, "Match has its path and line");
+        cJSON_Delete(output);
+    }
+    tool_result_cleanup(&result);
+
+    snprintf(input, sizeof(input), "{\"path\": \"%s\", \"pattern\": \"content [0-9]$\", \"regex\": true}", test_dir);
+    result = tool_executor_execute(executor, "content_search", input);
+    TEST_ASSERT(result.success == true && result.affected_count == 2, "Regex content_search matches both files");
+    tool_result_cleanup(&result);
+
+    snprintf(input, sizeof(input), "{\"path\": \"%s\", \"pattern\": \"(\", \"regex\": true}", test_dir);
+    result = tool_executor_execute(executor, "content_search", input);
+    TEST_ASSERT(result.success == false, "Invalid regex is an error");
+    tool_result_cleanup(&result);
+
+    tool_executor_destroy(executor);
+    tool_registry_destroy(registry);
+}
+
+static void test_result_paging(void)
+{
+    ToolRegistry *registry = tool_registry_create();
+    tool_registry_register_file_tools(registry);
+    ToolExecutor *executor = tool_executor_create(registry);
+
+    // A folder of 60 files in its own tree, so other tests' counts are unchanged
+    char dir[256];
+    char path[512];
+    snprintf(dir, sizeof(dir), "/tmp/finder_plus_executor_paging_%d", getpid());
+    mkdir(dir, 0755);
+    for (int i = 0; i < 60; i++) {
+        snprintf(path, sizeof(path), "%s/page_%02d.%s", dir, i, i % 3 == 0 ? "md" : "txt");
+        FILE *f = fopen(path, "w");
+        if (f) {
+            fprintf(f, "line of page %d\n", i);
+            fclose(f);
+        }
+    }
+
+    char input[512];
+    snprintf(input, sizeof(input), "{\"path\": \"%s\", \"limit\": 25}", dir);
+    ToolResult result = tool_executor_execute(executor, "file_list", input);
+    cJSON *output = result.output ? cJSON_Parse(result.output) : NULL;
+    cJSON *summary = cJSON_GetObjectItem(output, "summary");
+    TEST_ASSERT(cJSON_GetArraySize(cJSON_GetObjectItem(output, "files")) == 25, "file_list returns the asked page");
+    TEST_ASSERT(cJSON_GetObjectItem(output, "total") && cJSON_GetObjectItem(output, "total")->valueint == 60 &&
+                cJSON_GetObjectItem(output, "next_offset") &&
+                cJSON_GetObjectItem(output, "next_offset")->valueint == 25, "Page carries total and next_offset");
+    TEST_ASSERT(summary && cJSON_GetObjectItem(summary, "files")->valueint == 60,
+                "Partial page carries a summary of the whole listing");
+    cJSON *kinds = cJSON_GetObjectItem(summary, "by_kind");
+    TEST_ASSERT(kinds && cJSON_GetObjectItem(kinds, "markdown") &&
+                cJSON_GetObjectItem(kinds, "markdown")->valueint == 20, "Summary counts files by kind");
+    TEST_ASSERT(cJSON_GetArraySize(cJSON_GetObjectItem(summary, "largest")) == 5, "Summary lists the largest files");
+    cJSON_Delete(output);
+    tool_result_cleanup(&result);
+
+    snprintf(input, sizeof(input), "{\"path\": \"%s\", \"offset\": 50, \"limit\": 25}", dir);
+    result = tool_executor_execute(executor, "file_list", input);
+    output = result.output ? cJSON_Parse(result.output) : NULL;
+    TEST_ASSERT(cJSON_GetArraySize(cJSON_GetObjectItem(output, "files")) == 10 &&
+                !cJSON_GetObjectItem(output, "next_offset"), "Last page has the rest and no next_offset");
+    cJSON_Delete(output);
+    tool_result_cleanup(&result);
+
+    // A small budget cuts the page short, but never below one entry
+    snprintf(input, sizeof(input), "{\"path\": \"%s\", \"max_tokens\": 100}", dir);
+    result = tool_executor_execute(executor, "file_list", input);
+    output = result.output ? cJSON_Parse(result.output) : NULL;
+    int returned = cJSON_GetArraySize(cJSON_GetObjectItem(output, "files"));
+    TEST_ASSERT(returned >= 1 && returned < 10, "max_tokens bounds the page");
+    cJSON_Delete(output);
+    tool_result_cleanup(&result);
+
+    snprintf(input, sizeof(input), "{\"path\": \"%s\", \"max_tokens\": 1}", dir);
+    result = tool_executor_execute(executor, "file_list", input);
+    output = result.output ? cJSON_Parse(result.output) : NULL;
+    TEST_ASSERT(cJSON_GetArraySize(cJSON_GetObjectItem(output, "files")) == 1, "A page always moves on by one");
+    cJSON_Delete(output);
+    tool_result_cleanup(&result);
+
+    // The executor's budget pages by default; without one the result is whole
+    tool_executor_set_result_budget(executor, 100);
+    snprintf(input, sizeof(input), "{\"path\": \"%s\", \"pattern\": \"page_*\"}", dir);
+    result = tool_executor_execute(executor, "file_search", input);
+    output = result.output ? cJSON_Parse(result.output) : NULL;
+    summary = cJSON_GetObjectItem(output, "summary");
+    TEST_ASSERT(cJSON_GetArraySize(cJSON_GetObjectItem(output, "matches")) < 60 &&
+                cJSON_GetObjectItem(output, "count")->valueint == 60, "file_search pages under the budget");
+    TEST_ASSERT(summary && cJSON_GetObjectItem(summary, "folders")->valueint == 1,
+                "file_search summary counts the folders");
+    cJSON_Delete(output);
+    tool_result_cleanup(&result);
+
+    tool_executor_set_result_budget(executor, TOOL_RESULT_NO_BUDGET);
+    result = tool_executor_execute(executor, "file_search", input);
+    output = result.output ? cJSON_Parse(result.output) : NULL;
+    TEST_ASSERT(cJSON_GetArraySize(cJSON_GetObjectItem(output, "matches")) == 60 &&
+                !cJSON_GetObjectItem(output, "summary"), "Without a budget the result is whole");
+    cJSON_Delete(output);
+    tool_result_cleanup(&result);
+
+    snprintf(input, sizeof(input), "{\"path\": \"%s\", \"pattern\": \"line\", \"limit\": 0}", dir);
+    result = tool_executor_execute(executor, "content_search", input);
+    output = result.output ? cJSON_Parse(result.output) : NULL;
+    summary = cJSON_GetObjectItem(output, "summary");
+    TEST_ASSERT(cJSON_GetArraySize(cJSON_GetObjectItem(output, "matches")) == 0 && summary &&
+                cJSON_GetObjectItem(summary, "files")->valueint == 60, "limit 0 returns only the summary");
+    cJSON_Delete(output);
+    tool_result_cleanup(&result);
+
+    snprintf(path, sizeof(path), "rm -rf %s", dir);
+    system(path);
+    tool_executor_destroy(executor);
+    tool_registry_destroy(registry);
+}
+
+static void test_execute_batch(void)
+{
+    ToolRegistry *registry = tool_registry_create();
+    tool_registry_register_file_tools(registry);
+    ToolExecutor *executor = tool_executor_create(registry);
+
+    TEST_ASSERT(tool_executor_is_read_only("file_metadata"), "file_metadata is read-only");
+    TEST_ASSERT(tool_executor_is_read_only("semantic_search"), "semantic_search is read-only");
+    TEST_ASSERT(!tool_executor_is_read_only("file_create"), "file_create mutates");
+    TEST_ASSERT(!tool_executor_is_read_only("file_delete"), "file_delete mutates");
+
+    // Reads, then a create, then a read of what was created: the last read must see it
+    char inputs[6][512];
+    snprintf(inputs[0], sizeof(inputs[0]), "{\"path\": \"%s/file1.txt\"}", test_dir);
+    snprintf(inputs[1], sizeof(inputs[1]), "{\"path\": \"%s/file2.txt\"}", test_dir);
+    snprintf(inputs[2], sizeof(inputs[2]), "{\"path\": \"%s\"}", test_dir);
+    snprintf(inputs[3], sizeof(inputs[3]), "{\"path\": \"%s/missing.txt\"}", test_dir);
+    snprintf(inputs[4], sizeof(inputs[4]), "{\"path\": \"%s/batch.txt\"}", test_dir);
+    snprintf(inputs[5], sizeof(inputs[5]), "{\"path\": \"%s/batch.txt\"}", test_dir);
+    const char *names[6] = {
+        "file_metadata", "file_metadata", "file_list", "file_metadata", "file_create", "file_metadata"
+    };
+
+    ToolCall calls[6];
+    for (int i = 0; i < 6; i++) {
+        calls[i].tool_name = names[i];
+        calls[i].input_json = inputs[i];
+        tool_result_init(&calls[i].result);
+    }
+    tool_executor_execute_batch(executor, calls, 6);
+
+    TEST_ASSERT(calls[0].result.success && strstr(calls[0].result.output, "file1.txt") != NULL,
+                "First read gets its own result");
+    TEST_ASSERT(calls[1].result.success && strstr(calls[1].result.output, "file2.txt") != NULL,
+                "Second read gets its own result");
+    TEST_ASSERT(calls[2].result.success, "Listing runs alongside");
+    TEST_ASSERT(!calls[3].result.success, "Failed read reports its error");
+    TEST_ASSERT(calls[4].result.success, "Create in the batch succeeds");
+    TEST_ASSERT(calls[5].result.success, "Read after a create sees the new file");
+
+    for (int i = 0; i < 6; i++) {
+        tool_result_cleanup(&calls[i].result);
+    }
+    tool_executor_destroy(executor);
+    tool_registry_destroy(registry);
+}
+
+static void test_bulk_operation(void)
+{
+    ToolRegistry *registry = tool_registry_create();
+    tool_registry_register_file_tools(registry);
+    ToolExecutor *executor = tool_executor_create(registry);
+
+    const ToolDefinition *bulk = tool_registry_find(registry, "bulk_operation");
+    TEST_ASSERT(bulk != NULL && bulk->requires_confirmation, "bulk_operation is registered and confirmed");
+
+    // One preview covers every selected file
+    char input[1024];
+    snprintf(input, sizeof(input),
+             "{\"action\": \"copy\", \"path\": \"%s\", \"pattern\": \"file*.txt\", "
+             "\"destination\": \"%s/bulk_out\"}", test_dir, test_dir);
+    PendingOperation pending;
+    tool_executor_prepare(executor, "bulk_operation", "tool_bulk", input, &pending);
+    TEST_ASSERT(pending.affected_count == 2, "Preview counts the selected files");
+    TEST_ASSERT(strstr(pending.details, "file1.txt") != NULL, "Preview lists the selected files");
+    TEST_ASSERT(strstr(pending.description, "Copy") != NULL, "Description names the action");
+
+    ToolResult result = tool_executor_confirm(executor, &pending);
+    TEST_ASSERT(result.success, "Bulk copy succeeds");
+    TEST_ASSERT(result.affected_count == 2, "Bulk copy acts on every selected file");
+    tool_result_cleanup(&result);
+
+    char path[512];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/bulk_out", test_dir);
+    TEST_ASSERT(stat(path, &st) == 0 && S_ISDIR(st.st_mode), "Missing destination is created");
+
+    // Filters narrow the selection before anything happens
+    snprintf(input, sizeof(input),
+             "{\"action\": \"delete\", \"path\": \"%s\", \"pattern\": \"*.txt\", \"min_size\": 1000000}",
+             test_dir);
+    result = tool_executor_execute(executor, "bulk_operation", input);
+    TEST_ASSERT(result.success && result.affected_count == 0, "Size filter leaves nothing to delete");
+    tool_result_cleanup(&result);
+
+    snprintf(input, sizeof(input),
+             "{\"action\": \"delete\", \"path\": \"%s\", \"pattern\": \"*.txt\", \"older_than_days\": 365}",
+             test_dir);
+    result = tool_executor_execute(executor, "bulk_operation", input);
+    TEST_ASSERT(result.success && result.affected_count == 0, "Age filter leaves out new files");
+    tool_result_cleanup(&result);
+
+    snprintf(input, sizeof(input), "{\"action\": \"move\", \"path\": \"%s\", \"pattern\": \"*\"}", test_dir);
+    result = tool_executor_execute(executor, "bulk_operation", input);
+    TEST_ASSERT(!result.success, "Move without a destination fails");
+    tool_result_cleanup(&result);
+
+    tool_executor_destroy(executor);
+    tool_registry_destroy(registry);
+}
+
 static void test_execute_unknown_tool(void)
 {
     ToolRegistry *registry = tool_registry_create();
@@ -333,6 +609,11 @@ void test_tool_executor(void)
     test_execute_file_create_directory();
     test_execute_file_create_with_content();
     test_execute_file_search();
+    test_execute_content_search();
+    test_result_paging();
+    test_execute_file_search_recursive();
+    test_execute_batch();
+    test_bulk_operation();
     test_execute_unknown_tool();
     test_execute_invalid_json();
     test_prepare_pending_operation();
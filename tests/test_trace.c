@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#define TEST_ASSERT_EQ(expected, actual, message) do { \
+    inc_tests_run(); \
+    if ((expected) == (actual)) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s - expected %d, got %d (line %d)\n", message, (int)(expected), (int)(actual), __LINE__); \
+    } \
+} while(0)
+
+// Scopes are tested whether or not the build compiles them in elsewhere
+#ifndef FINDER_PLUS_TRACE
+#define FINDER_PLUS_TRACE
+#endif
+#include "../src/utils/trace.h"
+
+#define TEST_WORKER_SCOPES 1000
+
+static void traced_leaf(void)
+{
+    TRACE_SCOPE("test_leaf");
+}
+
+static void traced_outer(void)
+{
+    TRACE_SCOPE("test_outer");
+    traced_leaf();
+    traced_leaf();
+}
+
+static void *traced_worker(void *arg)
+{
+    (void)arg;
+    trace_set_thread_name("test worker");
+    for (int i = 0; i < TEST_WORKER_SCOPES; i++) {
+        TRACE_SCOPE("test_worker");
+    }
+    return NULL;
+}
+
+// Count occurrences of needle in the file at path
+static int count_in_file(const char *path, const char *needle)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int count = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        for (const char *p = line; (p = strstr(p, needle)) != NULL; p += strlen(needle)) {
+            count++;
+        }
+    }
+    fclose(f);
+    return count;
+}
+
+static void test_trace_record(void)
+{
+    printf("  Testing trace recording...\n");
+    char path[] = "/tmp/finder_plus_trace_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0) close(fd);
+
+    // Nothing is kept while not recording
+    traced_outer();
+    trace_start();
+    TEST_ASSERT(trace_is_recording(), "Recording should start");
+    TEST_ASSERT(!trace_write(path), "A running recording should not be written");
+
+    trace_set_thread_name("test main");
+    traced_outer();
+    pthread_t worker;
+    bool started = pthread_create(&worker, NULL, traced_worker, NULL) == 0;
+    if (started) pthread_join(worker, NULL);
+    trace_stop();
+    traced_outer();
+
+    TEST_ASSERT(!trace_is_recording(), "Recording should stop");
+    TEST_ASSERT(trace_write(path), "Stopped recording should be written");
+    TEST_ASSERT_EQ(1, count_in_file(path, "\"name\":\"test_outer\""), "Only scopes inside the recording should be kept");
+    TEST_ASSERT_EQ(2, count_in_file(path, "\"name\":\"test_leaf\""), "Nested scopes should be kept");
+    TEST_ASSERT(started && count_in_file(path, "\"name\":\"test_worker\"") == TEST_WORKER_SCOPES,
+                "Other threads should record on their own track");
+    TEST_ASSERT_EQ(1, count_in_file(path, "\"name\":\"test worker\""), "Thread names should be written");
+    TEST_ASSERT_EQ(1, count_in_file(path, "\"traceEvents\""), "Trace should be Chrome trace JSON");
+
+    // A new recording drops the last one, and the ring keeps only the newest events
+    trace_start();
+    for (int i = 0; i < TRACE_RING_EVENTS + 10; i++) {
+        traced_leaf();
+    }
+    trace_stop();
+    TEST_ASSERT(trace_write(path), "Second recording should be written");
+    TEST_ASSERT_EQ(0, count_in_file(path, "\"name\":\"test_outer\""), "Earlier recording should be dropped");
+    TEST_ASSERT_EQ(TRACE_RING_EVENTS, count_in_file(path, "\"name\":\"test_leaf\""), "Ring should keep the newest events");
+
+    unlink(path);
+}
+
+void test_trace(void)
+{
+    test_trace_record();
+}
@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#include "../src/core/undo_log.h"
+
+static char test_dir[256];
+
+static void setup_test_dir(void)
+{
+    snprintf(test_dir, sizeof(test_dir), "/tmp/finder_plus_undo_test_%d", getpid());
+    mkdir(test_dir, 0755);
+}
+
+static void cleanup_test_dir(void)
+{
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", test_dir);
+    system(cmd);
+}
+
+static void make_file(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fputs("undo", f);
+        fclose(f);
+    }
+}
+
+static bool path_exists(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+static void test_undo_log_moves(void)
+{
+    setup_test_dir();
+    char log_path[512], folder[512], from[512], to[512];
+    snprintf(log_path, sizeof(log_path), "%s/undo.log", test_dir);
+    snprintf(folder, sizeof(folder), "%s/sorted", test_dir);
+    snprintf(from, sizeof(from), "%s/a.txt", test_dir);
+    snprintf(to, sizeof(to), "%s/sorted/a.txt", test_dir);
+
+    UndoLog *log = undo_log_open(log_path);
+    TEST_ASSERT(log != NULL, "Log should open");
+
+    UndoGroupInfo info;
+    TEST_ASSERT(!undo_log_last(log, UNDO_SOURCE_ANY, &info), "A new log should have nothing to undo");
+
+    make_file(from);
+    uint64_t group = undo_log_begin(log, UNDO_SOURCE_ORGANIZE, "Organize");
+    mkdir(folder, 0755);
+    undo_log_folder(log, group, folder);
+    rename(from, to);
+    undo_log_moved(log, group, from, to);
+    undo_log_end(log, group);
+
+    // Empty groups are not offered for undo
+    uint64_t empty = undo_log_begin(log, UNDO_SOURCE_QUEUE, "Nothing");
+    undo_log_end(log, empty);
+
+    TEST_ASSERT(group != 0 && empty == group + 1, "Groups should get increasing IDs");
+    TEST_ASSERT(undo_log_last(log, UNDO_SOURCE_ANY, &info) && info.group == group,
+                "Last group should skip groups without actions");
+    TEST_ASSERT(info.actions == 2 && info.complete && strcmp(info.description, "Organize") == 0,
+                "Group info should count actions and keep the description");
+    TEST_ASSERT(!undo_log_last(log, UNDO_SOURCE_RENAME, &info), "Other sources should not match");
+
+    UndoResult result;
+    TEST_ASSERT(undo_log_undo_last(log, UNDO_SOURCE_ORGANIZE, &result), "Undo should succeed");
+    TEST_ASSERT(result.undone == 2 && result.failed == 0, "Undo should reverse both actions");
+    TEST_ASSERT(path_exists(from) && !path_exists(folder), "File should be back and the folder gone");
+    TEST_ASSERT(!undo_log_last(log, UNDO_SOURCE_ANY, &info), "An undone group should not be offered again");
+    TEST_ASSERT(!undo_log_undo(log, group, &result), "Undoing twice should fail");
+
+    // Undo never replaces a file that took the old name
+    snprintf(to, sizeof(to), "%s/renamed.txt", test_dir);
+    uint64_t second = undo_log_begin(log, UNDO_SOURCE_RENAME, "Rename");
+    rename(from, to);
+    undo_log_moved(log, second, from, to);
+    undo_log_end(log, second);
+    make_file(from);
+    TEST_ASSERT(!undo_log_undo(log, second, &result) && result.failed == 1,
+                "Undo should fail rather than overwrite");
+    TEST_ASSERT(path_exists(to), "The moved file should stay put");
+    unlink(from);
+    TEST_ASSERT(undo_log_undo(log, second, &result) && path_exists(from),
+                "A failed undo should be retryable");
+
+    undo_log_close(log);
+    cleanup_test_dir();
+}
+
+static void test_undo_log_crash(void)
+{
+    setup_test_dir();
+    char log_path[512], from[512], to[512];
+    snprintf(log_path, sizeof(log_path), "%s/undo.log", test_dir);
+    snprintf(from, sizeof(from), "%s/b.txt", test_dir);
+    snprintf(to, sizeof(to), "%s/c.txt", test_dir);
+
+    UndoLog *log = undo_log_open(log_path);
+    make_file(from);
+    uint64_t group = undo_log_begin(log, UNDO_SOURCE_QUEUE, "Move");
+    rename(from, to);
+    undo_log_moved(log, group, from, to);
+    TEST_ASSERT(undo_log_commit(log), "Commit should sync");
+    uint64_t size = undo_log_size(log);
+
+    // Crash in the middle of the next record: half of it reaches the file
+    undo_log_moved(log, group, "/nowhere/x", "/nowhere/y");
+    undo_log_close(log);
+    int fd = open(log_path, O_RDWR);
+    char zeros[16] = {0};
+    TEST_ASSERT(fd >= 0 && pwrite(fd, zeros, sizeof(zeros), 16 + (off_t)size + 24) == sizeof(zeros),
+                "Record should be torn");
+    close(fd);
+
+    log = undo_log_open(log_path);
+    TEST_ASSERT(log != NULL && undo_log_size(log) == size, "Reopen should stop before the torn record");
+
+    UndoGroupInfo info;
+    TEST_ASSERT(undo_log_last(log, UNDO_SOURCE_QUEUE, &info) && info.group == group && !info.complete,
+                "An unfinished group should still be offered");
+    uint64_t next = undo_log_begin(log, UNDO_SOURCE_QUEUE, "Next");
+    TEST_ASSERT(next == group + 1, "Group IDs should continue after a reopen");
+    undo_log_end(log, next);
+
+    UndoResult result;
+    TEST_ASSERT(undo_log_undo(log, group, &result) && result.undone == 1 && path_exists(from),
+                "The synced move should be undone");
+    undo_log_close(log);
+
+    // Whatever is not a log is left alone
+    make_file(log_path);
+    TEST_ASSERT(undo_log_open(log_path) == NULL, "A foreign file should not open");
+    cleanup_test_dir();
+}
+
+static void test_undo_log_bulk(void)
+{
+    setup_test_dir();
+    char log_path[512], folder[512];
+    snprintf(log_path, sizeof(log_path), "%s/undo.log", test_dir);
+    snprintf(folder, sizeof(folder), "%s/bulk", test_dir);
+    mkdir(folder, 0755);
+
+    // Enough records to grow the file past its first mapping (folders that were never
+    // made undo as already gone)
+    UndoLog *log = undo_log_open(log_path);
+    const int count = 50000;
+    uint64_t group = undo_log_begin(log, UNDO_SOURCE_RENAME, "Bulk");
+    char from[512], to[512];
+    for (int i = 0; i < count; i++) {
+        snprintf(from, sizeof(from), "%s/file_%05d_with_a_longer_name.txt", folder, i);
+        snprintf(to, sizeof(to), "%s/renamed_%05d_with_a_longer_name.txt", folder, i);
+        if (i < 10) {
+            make_file(from);
+            rename(from, to);
+            undo_log_moved(log, group, from, to);
+        } else {
+            undo_log_folder(log, group, to);
+        }
+    }
+    undo_log_end(log, group);
+    TEST_ASSERT(undo_log_size(log) > UNDO_LOG_GROW_BYTES, "Log should have grown");
+    undo_log_close(log);
+
+    log = undo_log_open(log_path);
+    UndoGroupInfo info;
+    TEST_ASSERT(undo_log_last(log, UNDO_SOURCE_ANY, &info) && info.actions == count,
+                "Every record should survive a reopen");
+    UndoResult result;
+    undo_log_undo(log, group, &result);
+    snprintf(from, sizeof(from), "%s/file_00000_with_a_longer_name.txt", folder);
+    TEST_ASSERT(result.undone == count && result.failed == 0 && path_exists(from),
+                "Undo should walk the whole group back");
+
+    undo_log_close(log);
+    cleanup_test_dir();
+}
+
+void test_undo_log(void)
+{
+    test_undo_log_moves();
+    test_undo_log_crash();
+    test_undo_log_bulk();
+}
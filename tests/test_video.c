@@ -117,7 +117,18 @@ void test_video(void)
     result = video_read_frame(0, buffer, 10, 0);
     TEST_ASSERT(result == false, "Frame read with zero height returns false");
 
-    // Test 14: Stop in-pane playback NULL handling (should not crash)
+    // Test 14: Probe NULL handling
+    VideoInfo info;
+    TEST_ASSERT(video_probe(NULL, &info) == false, "Probe with NULL path returns false");
+    TEST_ASSERT(video_probe("/test.mp4", NULL) == false, "Probe with NULL info returns false");
+    TEST_ASSERT(video_probe("/nonexistent/video.mp4", &info) == false, "Probe of missing file returns false");
+
+    // Test 15: YUV420 frame size (Y plane, then quarter-size U and V)
+    TEST_ASSERT(video_frame_size(640, 480) == 640 * 480 * 3 / 2, "YUV420 frame is 1.5 bytes per pixel");
+    TEST_ASSERT(video_frame_size(2, 2) == 6, "Smallest YUV420 frame is 6 bytes");
+    TEST_ASSERT(video_frame_size(0, 480) == 0, "Frame size with zero width is 0");
+
+    // Test 16: Stop in-pane playback NULL handling (should not crash)
     video_stop_inpane_playback(0, -1);
     TEST_ASSERT(1, "Stop in-pane playback with invalid params does not crash");
 }
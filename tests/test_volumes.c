@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Test framework imports
+extern void inc_tests_run(void);
+extern void inc_tests_passed(void);
+extern void inc_tests_failed(void);
+
+#define TEST_ASSERT(condition, message) do { \
+    inc_tests_run(); \
+    if (condition) { \
+        inc_tests_passed(); \
+        printf("  PASS: %s\n", message); \
+    } else { \
+        inc_tests_failed(); \
+        printf("  FAIL: %s (line %d)\n", message, __LINE__); \
+    } \
+} while(0)
+
+#include "../src/core/volumes.h"
+
+static void test_volumes_lookup(void)
+{
+    Volumes *volumes = volumes_create(0);
+    TEST_ASSERT(volumes != NULL, "Volume service should start");
+    if (!volumes) return;
+
+    VolumeInfo root;
+    TEST_ASSERT(volumes_lookup(volumes, "/", &root), "Root should be on a volume");
+    TEST_ASSERT(root.capacity > 0 && root.available >= 0 && root.available <= root.capacity,
+                "Root should report its capacity and free space");
+
+    // A path inside a mount resolves to that mount, existing or not
+    VolumeInfo nested;
+    TEST_ASSERT(volumes_lookup(volumes, "/no/such/dir/file.txt", &nested), "Missing paths should still resolve");
+    VolumeInfo parent;
+    TEST_ASSERT(volumes_lookup(volumes, "/no", &parent) && strcmp(nested.path, parent.path) == 0,
+                "A path should resolve to the same volume as its parent");
+    TEST_ASSERT(!volumes_lookup(volumes, "relative/path", NULL), "Relative paths should not resolve");
+    TEST_ASSERT(!volumes_lookup(NULL, "/", NULL), "No service should resolve nothing");
+
+    VolumeInfo list[VOLUMES_MAX];
+    int count = volumes_list(volumes, list, VOLUMES_MAX);
+    TEST_ASSERT(count >= 1 && strcmp(list[0].path, "/") == 0, "Volume list should start with the root");
+
+    uint64_t generation = volumes_generation(volumes);
+    volumes_refresh(volumes);
+    TEST_ASSERT(volumes_generation(volumes) >= generation, "Refresh should not lose the generation");
+
+    volumes_destroy(volumes);
+}
+
+void test_volumes(void)
+{
+    test_volumes_lookup();
+}